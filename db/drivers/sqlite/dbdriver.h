@@ -16,6 +16,7 @@ db_driver_finish = db__driver_finish;\
 db_driver_execute_immediate = db__driver_execute_immediate;\
 db_driver_begin_transaction = db__driver_begin_transaction;\
 db_driver_commit_transaction = db__driver_commit_transaction;\
+db_driver_update_values = db__driver_update_values;\
 db_driver_fetch = db__driver_fetch;\
 db_driver_get_num_rows = db__driver_get_num_rows;\
 db_driver_create_index = db__driver_create_index;\
@@ -144,3 +144,98 @@ int db__driver_commit_transaction(void)
 
     return DB_OK;
 }
+
+
+/**
+ * \fn int db__driver_update_values (dbString *table, dbString *key, int ncols, dbString *columns, const int *ctypes, int nrows, const int *keys, dbValue *values, int *nupdated)
+ *
+ * \brief Low level SQLite update of many rows with one prepared statement.
+ *
+ * \param[in] table table name
+ * \param[in] key key column
+ * \param[in] ncols number of columns
+ * \param[in] columns columns to update
+ * \param[in] ctypes C types of the columns
+ * \param[in] nrows number of rows
+ * \param[in] keys key values of the rows
+ * \param[in] values values of the rows
+ * \param[out] nupdated number of rows updated without error
+ * \return int DB_FAILED on error; DB_OK on success
+ */
+
+int db__driver_update_values(dbString * table, dbString * key, int ncols,
+			     dbString * columns, const int *ctypes, int nrows,
+			     const int *keys, dbValue * values, int *nupdated)
+{
+    int i, j, ret;
+    dbString sql;
+    sqlite3_stmt *stmt;
+
+    db_init_string(&sql);
+    db_set_string(&sql, "UPDATE ");
+    db_append_string(&sql, db_get_string(table));
+    db_append_string(&sql, " SET ");
+    for (j = 0; j < ncols; j++) {
+	if (j > 0)
+	    db_append_string(&sql, ", ");
+	db_append_string(&sql, db_get_string(&columns[j]));
+	db_append_string(&sql, " = ?");
+    }
+    db_append_string(&sql, " WHERE ");
+    db_append_string(&sql, db_get_string(key));
+    db_append_string(&sql, " = ?");
+
+    G_debug(3, "execute: %s", db_get_string(&sql));
+
+    ret = sqlite3_prepare(sqlite, db_get_string(&sql), -1, &stmt, NULL);
+    if (ret != SQLITE_OK) {
+	db_d_append_error("%s\n%s",
+			  _("Error in sqlite3_prepare():"),
+			  (char *)sqlite3_errmsg(sqlite));
+	db_d_report_error();
+	db_free_string(&sql);
+	return DB_FAILED;
+    }
+    db_free_string(&sql);
+
+    for (i = 0; i < nrows; i++) {
+	for (j = 0; j < ncols; j++) {
+	    dbValue *value = &values[i * ncols + j];
+
+	    if (value->isNull)
+		sqlite3_bind_null(stmt, j + 1);
+	    else if (ctypes[j] == DB_C_TYPE_INT)
+		sqlite3_bind_int(stmt, j + 1, value->i);
+	    else if (ctypes[j] == DB_C_TYPE_DOUBLE)
+		sqlite3_bind_double(stmt, j + 1, value->d);
+	    else
+		sqlite3_bind_text(stmt, j + 1, db_get_string(&value->s), -1,
+				  SQLITE_STATIC);
+	}
+	sqlite3_bind_int(stmt, ncols + 1, keys[i]);
+
+	sqlite3_step(stmt);
+	/* get real result code */
+	ret = sqlite3_reset(stmt);
+	if (ret == SQLITE_OK)
+	    (*nupdated)++;
+	else {
+	    db_d_append_error("%s\n%s",
+			      _("Error in sqlite3_step():"),
+			      (char *)sqlite3_errmsg(sqlite));
+	    db_d_report_error();
+	}
+    }
+
+    ret = sqlite3_finalize(stmt);
+
+    if (ret != SQLITE_OK) {
+	db_d_append_error("%s\n%s",
+			  _("Error in sqlite3_finalize():"),
+			  (char *)sqlite3_errmsg(sqlite));
+	db_d_report_error();
+	return DB_FAILED;
+    }
+
+    return DB_OK;
+}
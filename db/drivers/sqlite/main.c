@@ -29,6 +29,12 @@ int main(int argc, char *argv[])
     exit(db_driver(argc, argv));
 }
 
+/* assign the driver functions if the driver is loaded by the client */
+void db_driver_module_init(void)
+{
+    init_dbdriver();
+}
+
 int sqlite_busy_callback(void *arg, int n_calls)
 {
     static time_t start_time = 0;
@@ -10,11 +10,12 @@
 #include "local_proto.h"
 
 
-static int cell_draw(const char *, struct Colors *, int, int, RASTER_MAP_TYPE);
+static int cell_draw(const char *, struct Colors *, int, int, RASTER_MAP_TYPE,
+		     int);
 
 int display(const char *name,
 	    int overlay,
-	    char *bg, RASTER_MAP_TYPE data_type, int invert)
+	    char *bg, RASTER_MAP_TYPE data_type, int invert, int nprocs)
 {
     struct Colors colors;
     int r, g, b;
@@ -31,7 +32,7 @@ int display(const char *name,
     }
 
     /* Go draw the raster map */
-    cell_draw(name, &colors, overlay, invert, data_type);
+    cell_draw(name, &colors, overlay, invert, data_type, nprocs);
 
     /* release the colors now */
     Rast_free_colors(&colors);
@@ -41,7 +42,8 @@ int display(const char *name,
 
 static int cell_draw(const char *name,
 		     struct Colors *colors,
-		     int overlay, int invert, RASTER_MAP_TYPE data_type)
+		     int overlay, int invert, RASTER_MAP_TYPE data_type,
+		     int nprocs)
 {
     int cellfile;
     void *xarray;
@@ -58,6 +60,11 @@ static int cell_draw(const char *name,
     /* Make sure map is available */
     cellfile = Rast_open_old(name, "");
 
+    /* decompress the next rows on the worker threads while a row
+       is drawn */
+    if (nprocs > 1)
+	Rast_set_read_ahead(cellfile, 4 * nprocs);
+
     /* Allocate space for cell buffer */
     xarray = Rast_allocate_buf(data_type);
 
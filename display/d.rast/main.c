@@ -43,6 +43,7 @@ int main(int argc, char **argv)
     struct Option *map;
     struct Option *vallist;
     struct Option *bg;
+    struct Option *nprocs;
     struct Flag *flag_n;
     struct Flag *flag_i;
 
@@ -76,6 +77,8 @@ int main(int argc, char **argv)
     bg->label = _("Background color (for null)");
     bg->guisection = _("Null cells");
 
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag_n = G_define_flag();
     flag_n->key = 'n';
     flag_n->description = _("Make null cells opaque");
@@ -104,7 +107,8 @@ int main(int argc, char **argv)
     }
 
     /* use DCELL even if the map is FCELL */
-    display(name, overlay, bg->answer, fp ? DCELL_TYPE : CELL_TYPE, invert);
+    display(name, overlay, bg->answer, fp ? DCELL_TYPE : CELL_TYPE, invert,
+	    G_set_nprocs(nprocs));
     
     D_save_command(G_recreate_command());
     D_close_driver();
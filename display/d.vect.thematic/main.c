@@ -22,9 +22,9 @@
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/display.h>
+#include <grass/dbmi.h>
 #include <grass/vector.h>
 #include <grass/colors.h>
-#include <grass/dbmi.h>
 #include <grass/glocale.h>
 #include <grass/arraystats.h>
 #include "plot.h"
@@ -301,7 +301,7 @@ int main(int argc, char **argv)
 
     /*Get CatValArray needed for plotting and for legend calculations */
     db_CatValArray_init(&cvarr);
-    nrec = db_select_CatValArray(driver, fi->table, fi->key,
+    nrec = Vect_select_cat_values(driver, fi,
 				 column_opt->answer, where_opt->answer,
 				 &cvarr);
 
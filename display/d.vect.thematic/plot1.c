@@ -3,13 +3,13 @@
 #include <string.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
+#include <grass/dbmi.h>
 #include <grass/vector.h>
 #include <grass/display.h>
 #include "plot.h"
 #include "local_proto.h"
 #include <grass/symbol.h>
 #include <grass/glocale.h>
-#include <grass/dbmi.h>
 
 #define RENDER_POLYLINE 0
 #define RENDER_POLYGON  1
@@ -121,7 +121,7 @@ int plot1(struct Map_info *Map, int type, int area, struct cat_list *Clist,
 
 	db_CatValArray_init(&cvarr_rgb);
 
-	nrec_rgb = db_select_CatValArray(driver, fi->table, fi->key,
+	nrec_rgb = Vect_select_cat_values(driver, fi,
 					 rgb_column, NULL, &cvarr_rgb);
 
 	G_debug(3, "nrec_rgb (%s) = %d", rgb_column, nrec_rgb);
@@ -149,7 +149,7 @@ int plot1(struct Map_info *Map, int type, int area, struct cat_list *Clist,
 
 	db_CatValArray_init(&cvarr_width);
 
-	nrec_width = db_select_CatValArray(driver, fi->table, fi->key,
+	nrec_width = Vect_select_cat_values(driver, fi,
 					   width_column, NULL, &cvarr_width);
 
 	G_debug(3, "nrec_width (%s) = %d", width_column, nrec_width);
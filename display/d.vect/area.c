@@ -8,11 +8,128 @@
 #include <grass/vector.h>
 #include <grass/display.h>
 #include <grass/colors.h>
+#include <grass/rbtree.h>
 
 #include <grass/glocale.h>
 #include "plot.h"
 #include "local_proto.h"
 
+/* Each boundary is shared by two areas or an area and an isle. Its
+   (generalized) coordinates are kept after the first one is drawn
+   until the second one is, up to this number of points in total. */
+#define MAX_CACHED_POINTS (4 << 20)
+
+struct boundary
+{
+    int line;
+    int uses;			/* rings still to be drawn */
+    struct line_pnts *Points;
+};
+
+static struct RB_TREE *boundaries;
+static long cached_points;
+
+static int cmp_boundary(const void *a, const void *b)
+{
+    const struct boundary *ba = a, *bb = b;
+
+    return (ba->line > bb->line) - (ba->line < bb->line);
+}
+
+static void free_boundaries(void)
+{
+    struct RB_TRAV trav;
+    struct boundary *b;
+
+    rbtree_init_trav(&trav, boundaries);
+    while ((b = rbtree_traverse(&trav)))
+	Vect_destroy_line_struct(b->Points);
+    rbtree_destroy(boundaries);
+    boundaries = NULL;
+    cached_points = 0;
+}
+
+/* points of a ring of boundaries as Vect_get_area_points() */
+static int get_ring_points(struct Map_info *Map, const struct ilist *List,
+			   struct line_pnts *BPoints)
+{
+    static struct line_pnts *Points;
+    struct boundary key, *b;
+    const struct line_pnts *src;
+    int i, line;
+
+    if (!Points)
+	Points = Vect_new_line_struct();
+
+    Vect_reset_line(BPoints);
+    for (i = 0; i < List->n_values; i++) {
+	line = List->value[i];
+	key.line = abs(line);
+
+	b = rbtree_find(boundaries, &key);
+	if (b)
+	    src = b->Points;
+	else {
+	    if (0 > Vect_read_line(Map, Points, NULL, key.line))
+		return -1;
+	    lod_reduce(Points);
+	    src = Points;
+	}
+
+	Vect_append_points(BPoints, src, line > 0 ? GV_FORWARD : GV_BACKWARD);
+	BPoints->n_points--;	/* skip last point, avoids duplicates */
+
+	if (b) {
+	    if (--b->uses == 0) {
+		cached_points -= b->Points->n_points;
+		Vect_destroy_line_struct(b->Points);
+		rbtree_remove(boundaries, &key);
+	    }
+	}
+	else if (cached_points + Points->n_points <= MAX_CACHED_POINTS) {
+	    key.uses = 1;
+	    key.Points = Vect_new_line_struct();
+	    Vect_append_points(key.Points, Points, GV_FORWARD);
+	    rbtree_insert(boundaries, &key);
+	    cached_points += Points->n_points;
+	}
+    }
+    BPoints->n_points++;	/* close polygon */
+
+    return BPoints->n_points;
+}
+
+static int get_area_points(struct Map_info *Map, int area,
+			   struct line_pnts *BPoints)
+{
+    static struct ilist *List;
+
+    /* PostGIS topology has its own way of reading the rings */
+    if (Vect_maptype(Map) == GV_FORMAT_POSTGIS)
+	return Vect_get_area_points(Map, area, BPoints);
+
+    if (!List)
+	List = Vect_new_list();
+    Vect_get_area_boundaries(Map, area, List);
+
+    return get_ring_points(Map, List, BPoints);
+}
+
+static int get_isle_points(struct Map_info *Map, int isle,
+			   struct line_pnts *BPoints)
+{
+    static struct ilist *List;
+
+    if (Vect_maptype(Map) == GV_FORMAT_POSTGIS)
+	return Vect_get_isle_points(Map, isle, BPoints);
+
+    if (!List)
+	List = Vect_new_list();
+    Vect_get_isle_boundaries(Map, isle, List);
+
+    return get_ring_points(Map, List, BPoints);
+}
+
 int display_area(struct Map_info *Map, struct cat_list *Clist, const struct Cell_head *window,
 		 const struct color_rgb *bcolor, const struct color_rgb *fcolor, int chcat,
 		 int id_flag, int cats_color_flag, 
@@ -51,6 +168,7 @@ int display_area(struct Map_info *Map, struct cat_list *Clist, const struct Cell
 	IPoints[i] = Vect_new_line_struct();
     }
     Cats = Vect_new_cats_struct();
+    boundaries = rbtree_create(cmp_boundary, sizeof(struct boundary));
     
     num = Vect_get_num_areas(Map);
     G_debug(2, "\tn_areas = %d", num);
@@ -128,8 +246,12 @@ int display_area(struct Map_info *Map, struct cat_list *Clist, const struct Cell
 		continue;
 	}
 
+	/* only one area smaller than a pixel is drawn in each pixel */
+	if (lod_skip(&box))
+	    continue;
+
 	/* fill */
-	Vect_get_area_points(Map, area, APoints);
+	get_area_points(Map, area, APoints);
 	G_debug(3, "\tn_points = %d", APoints->n_points);
 	if (APoints->n_points < 3) {
 	    G_warning(_("Invalid area %d skipped (not enough points)"), area);
@@ -151,7 +273,7 @@ int display_area(struct Map_info *Map, struct cat_list *Clist, const struct Cell
 	}
 	for (i = 0; i < n_isles; i++) {
 	    isle = Vect_get_area_isle(Map, area, i);
-	    Vect_get_isle_points(Map, isle, IPoints[i]);
+	    get_isle_points(Map, isle, IPoints[i]);
 	    Vect_append_points(Points, IPoints[i], GV_FORWARD);
 	    Vect_append_point(Points, xl, yl, 0.0);	/* ??? */
 	}
@@ -245,6 +367,10 @@ int display_area(struct Map_info *Map, struct cat_list *Clist, const struct Cell
     }
     G_free(IPoints);
     Vect_destroy_cats_struct(Cats);
+    free_boundaries();
+
+    /* lines are not hidden by areas */
+    lod_clear();
 
     return 0;
 }
@@ -35,7 +35,7 @@ struct rgb_color palette[16] = {
 };
 
 static int draw_line(int, int, int,
-		     const struct line_pnts *, const struct line_cats *,
+		     struct line_pnts *, const struct line_cats *,
 		     const struct color_rgb *, const struct color_rgb *, int,
 		     const char *, double, int,
 		     int, int,
@@ -192,7 +192,7 @@ int display_lines(struct Map_info *Map, int type, struct cat_list *Clist,
 }
 
 int draw_line(int type, int ltype, int line,
-	      const struct line_pnts *Points, const struct line_cats *Cats,
+	      struct line_pnts *Points, const struct line_cats *Cats,
 	      const struct color_rgb *color, const struct color_rgb *fcolor, int chcat,
 	      const char *symbol_name, double size, int sqrt_flag,
 	      int id_flag, int cats_color_flag,
@@ -358,6 +358,15 @@ int draw_line(int type, int ltype, int line,
 	rotation = 0.0;
     }
     else if (color || custom_rgb || zcolors) {
+	struct bound_box box;
+
+	Vect_line_box(Points, &box);
+	if (lod_skip(&box))
+	    return 0;
+	lod_reduce(Points);
+	x = Points->x;
+	y = Points->y;
+
 	if (!cvarr_rgb && !cats_color_flag && !zcolors && !colors)
 	    D_RGB_color(color->r, color->g, color->b);
 	else {
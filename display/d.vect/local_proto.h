@@ -25,6 +25,13 @@ int display_label(struct Map_info *, int, struct cat_list *, LATTR *, int);
 void show_label(double *, double *, LATTR *, const char *);
 void show_label_line(const struct line_pnts *, int, LATTR *, const char *);
 
+/* lod.c */
+void lod_init(int);
+void lod_clear(void);
+void lod_finish(void);
+int lod_skip(const struct bound_box *);
+void lod_reduce(struct line_pnts *);
+
 /* lines.c */
 int display_lines(struct Map_info *, int, struct cat_list *,
 		  const struct color_rgb *, const struct color_rgb *, int,
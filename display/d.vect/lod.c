@@ -0,0 +1,126 @@
+/* Level of detail: vertices and features smaller than a screen pixel
+ *
+ * Vertices closer than a pixel to their neighbours are dropped before
+ * the coordinates are passed to the display library, with the same
+ * criterion as its own reduction (see D_set_reduction()). Of features
+ * smaller than a pixel only the first one drawn in each pixel is
+ * drawn, the following ones would not change the image.
+ */
+
+#include <math.h>
+#include <grass/gis.h>
+#include <grass/vector.h>
+#include <grass/display.h>
+
+#include "local_proto.h"
+
+static int enabled;
+static double xres, yres;	/* pixel size in map units */
+static double d_west, d_north;
+static int cols, rows;
+static unsigned char *drawn;	/* pixels with a small feature */
+
+void lod_init(int enable)
+{
+    if (!enable)
+	return;
+
+    xres = fabs(1.0 / D_get_u_to_d_xconv());
+    yres = fabs(1.0 / D_get_u_to_d_yconv());
+
+    d_west = D_get_d_west();
+    d_north = D_get_d_north();
+    cols = (int)ceil(D_get_d_east() - d_west);
+    rows = (int)ceil(D_get_d_south() - d_north);
+    if (cols <= 0 || rows <= 0)
+	return;
+
+    drawn = G_calloc(((size_t) cols * rows + 7) / 8, 1);
+    enabled = 1;
+}
+
+/* forgets the drawn pixels, e.g. before lines are drawn over areas */
+void lod_clear(void)
+{
+    if (enabled)
+	G_zero(drawn, ((size_t) cols * rows + 7) / 8);
+}
+
+void lod_finish(void)
+{
+    if (!enabled)
+	return;
+
+    G_free(drawn);
+    drawn = NULL;
+    enabled = 0;
+}
+
+/* returns 1 if the feature with the given box is smaller than a pixel
+ * and another such feature was already drawn in its pixel */
+int lod_skip(const struct bound_box *box)
+{
+    int col, row;
+    size_t bit;
+
+    if (!enabled)
+	return 0;
+
+    if (box->E - box->W >= xres || box->N - box->S >= yres)
+	return 0;
+
+    col = (int)floor(D_u_to_d_col((box->E + box->W) / 2) - d_west);
+    row = (int)floor(D_u_to_d_row((box->N + box->S) / 2) - d_north);
+    if (col < 0 || col >= cols || row < 0 || row >= rows)
+	return 0;
+
+    bit = (size_t) row * cols + col;
+    if (drawn[bit >> 3] & (1 << (bit & 7)))
+	return 1;
+
+    drawn[bit >> 3] |= 1 << (bit & 7);
+
+    return 0;
+}
+
+/* drops the vertices closer than a pixel to both the previous kept
+ * vertex and the next one; the end points are kept, and closed lines
+ * keep at least 4 vertices */
+void lod_reduce(struct line_pnts *Points)
+{
+    double *x = Points->x, *y = Points->y, *z = Points->z;
+    int n = Points->n_points;
+    int i, k, keep;
+
+    if (!enabled || n < 3)
+	return;
+
+    for (i = 1, k = 0, keep = 2; i < n - 1; i++) {
+	if (fabs(x[i] - x[k]) < xres && fabs(y[i] - y[k]) < yres &&
+	    fabs(x[i] - x[i + 1]) < xres && fabs(y[i] - y[i + 1]) < yres)
+	    continue;
+	k = i;
+	keep++;
+    }
+
+    if (keep == n)
+	return;
+    if (keep < 4 && x[0] == x[n - 1] && y[0] == y[n - 1])
+	return;
+
+    for (i = 1, k = 0; i < n - 1; i++) {
+	if (fabs(x[i] - x[k]) < xres && fabs(y[i] - y[k]) < yres &&
+	    fabs(x[i] - x[i + 1]) < xres && fabs(y[i] - y[i + 1]) < yres)
+	    continue;
+	k++;
+	x[k] = x[i];
+	y[k] = y[i];
+	z[k] = z[i];
+    }
+    k++;
+    x[k] = x[n - 1];
+    y[k] = y[n - 1];
+    z[k] = z[n - 1];
+
+    Points->n_points = k + 1;
+}
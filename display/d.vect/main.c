@@ -56,6 +56,7 @@ int main(int argc, char **argv)
     struct Option *leglab_opt;
     struct Option *icon_line_opt, *icon_area_opt;
     struct Flag *id_flag, *cats_acolors_flag, *sqrt_flag, *legend_flag;
+    struct Flag *full_flag;
     char *desc;
     
     struct cat_list *Clist;
@@ -330,6 +331,13 @@ int main(int argc, char **argv)
     legend_flag->label = _("Do not show this layer in vector legend");
     legend_flag->guisection = _("Legend");
 
+    full_flag = G_define_flag();
+    full_flag->key = 'f';
+    full_flag->label = _("Draw all vertices and features at full detail");
+    full_flag->description =
+	_("By default vertices closer than a pixel are dropped and of "
+	  "features smaller than a pixel only one per pixel is drawn");
+
     G_option_exclusive(zcol_opt, rgbcol_opt, cats_acolors_flag, NULL);
     
     /* Check command line */
@@ -416,6 +424,7 @@ int main(int argc, char **argv)
 
     D_setup(0);
     D_set_reduction(1.0);
+    lod_init(!full_flag->answer);
 
     G_verbose_message(_("Plotting..."));
 
@@ -492,6 +501,8 @@ int main(int argc, char **argv)
             stat += display_topo(&Map, type, &lattr, size);
     }
 
+    lod_finish();
+
     D_save_command(G_recreate_command());
     D_close_driver();
 
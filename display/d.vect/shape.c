@@ -1,5 +1,5 @@
-#include <grass/vector.h>
 #include <grass/dbmi.h>
+#include <grass/vector.h>
 #include <grass/raster.h>
 #include <grass/glocale.h>
 
@@ -59,7 +59,7 @@ int display_shape(struct Map_info *Map, int type, struct cat_list *Clist, const
 	/* read RRR:GGG:BBB color strings from table */
 	db_CatValArray_init(&cvarr_rgb);
 	
-	nrec_rgb = db_select_CatValArray(driver, fi->table, fi->key,
+	nrec_rgb = Vect_select_cat_values(driver, fi,
 					 rgb_column, NULL, &cvarr_rgb);
 	
 	G_debug(3, "nrec_rgb (%s) = %d", rgb_column, nrec_rgb);
@@ -86,7 +86,7 @@ int display_shape(struct Map_info *Map, int type, struct cat_list *Clist, const
 
 	db_CatValArray_init(&cvarr_width);
 
-	nrec_width = db_select_CatValArray(driver, fi->table, fi->key,
+	nrec_width = Vect_select_cat_values(driver, fi,
 					   width_column, NULL, &cvarr_width);
 
 	G_debug(3, "nrec_width (%s) = %d", width_column, nrec_width);
@@ -117,7 +117,7 @@ int display_shape(struct Map_info *Map, int type, struct cat_list *Clist, const
 	
 	db_CatValArray_init(&cvarr_size);
 
-	nrec_size = db_select_CatValArray(driver, fi->table, fi->key,
+	nrec_size = Vect_select_cat_values(driver, fi,
 					  size_column, NULL, &cvarr_size);
 	
 	G_debug(3, "nrec_size (%s) = %d", size_column, nrec_size);
@@ -148,7 +148,7 @@ int display_shape(struct Map_info *Map, int type, struct cat_list *Clist, const
 
 	db_CatValArray_init(&cvarr_rot);
 
-	nrec_rot = db_select_CatValArray(driver, fi->table, fi->key,
+	nrec_rot = Vect_select_cat_values(driver, fi,
 					 rot_column, NULL, &cvarr_rot);
 
 	G_debug(3, "nrec_rot (%s) = %d", rot_column, nrec_rot);
@@ -16,7 +16,6 @@ void make_list(struct elist **el, int *lcount, int *lalloc,
 	       const struct list *elem, const char *mapset,
 	       const struct Cell_head *window)
 {
-    char path[GPATH_MAX];
     const char *element, *alias;
     char **list;
     int count, i;
@@ -25,11 +24,7 @@ void make_list(struct elist **el, int *lcount, int *lalloc,
     element = elem->element[0];
     alias = elem->alias;
 
-    G_file_name(path, element, "", mapset);
-    if (access(path, 0) != 0)
-	return;
-
-    if ((list = G_ls2(path, &count)) == NULL)
+    if ((list = G_ls_element(element, mapset, &count)) == NULL)
 	return;
 
     if (strcmp(alias, "raster") == 0)
@@ -64,6 +64,7 @@ static char* STD_OPT_STRINGS[] = {"G_OPT_UNDEFINED",
                                   "G_OPT_M_DIR",
                                   "G_OPT_M_REGION",
                                   "G_OPT_M_NULL_VALUE",
+                                  "G_OPT_M_NPROCS",
                                   "G_OPT_STDS_INPUT",
                                   "G_OPT_STDS_INPUTS",
                                   "G_OPT_STDS_OUTPUT",
@@ -36,6 +36,7 @@
 ***************************************************************************/
 
 #include <cstdlib>
+#include <cstring>
 #include <map>
 #include <cmath>
 
@@ -44,7 +45,6 @@ extern "C"
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/glocale.h>
-#include <grass/rbtree.h>
 }
 
 #include "transform.h"
@@ -53,20 +53,22 @@ extern "C"
 /* MODIS surface reflectance (MOD09) uses pre-computed 6S parameters
  * for 10 aerosol optical depths. Here we use finer grain. */
 
-/* TICache: create bins for altitude and visibility */
-/* altitude range: appr. 0 - 9000
- * bin 10: change between bins is 0.05 - 0.16%
- * bin 100: change between bins is 0.5 - 1.5% 
- * bin 1000: change between bins is 6 - 13%*/
-#define BIN_ALT 10	/* unit is meters */
-/* visibility range: 0 - 50000
- * bin 10: change between bins is 0.004 - 0.16%
- * bin 100: change between bins is 0.01 - 1.6% 
- * bin 1000: change between bins is 0.1 - 13%*/
-#define BIN_VIS 100	/* unit is meters */
-
-/* uncomment to disable cache usage */
-/* #define _NO_OPTIMIZE_ */
+/* Lookup table: the 6S parameters are computed for the nodes of a 
+ * grid of elevation and visibility values and interpolated linearly
+ * in between. The default steps between the nodes are given below.
+ * altitude range: appr. 0 - 9000
+ * step 10: change between nodes is 0.05 - 0.16%
+ * step 100: change between nodes is 0.5 - 1.5% 
+ * step 1000: change between nodes is 6 - 13% */
+#define STEP_ALT "100"	/* unit is meters */
+/* visibility range: 0 - 50
+ * step 0.01: change between nodes is 0.004 - 0.16%
+ * step 0.1: change between nodes is 0.01 - 1.6% 
+ * step 1: change between nodes is 0.1 - 13% */
+#define STEP_VIS "1"	/* unit is km */
+
+/* number of rows corrected at once by several threads */
+#define BLOCK_ROWS 16
 
 /* Input options and flags */
 struct Options
@@ -81,6 +83,8 @@ struct Options
     struct Option *icnd;	/* the input conditions file */
     struct Option *oimg;	/* output image name */
     struct Option *oscl;	/* scale the output data (reflectance values) to this range */
+    struct Option *prec;	/* steps of the lookup table for elevation and visibility */
+    struct Option *nprocs;	/* number of threads */
 
     /* flags */
     struct Flag *oint;		/* output data as integer */
@@ -95,18 +99,11 @@ struct ScaleRange
     int max;
 };
 
-struct RBitem
-{
-    int alt;		/* elevation */
-    int vis;		/* visibility */
-    TransformInput ti;	/* transformation parameters */
-};
-
 /* function prototypes */
 static void adjust_region(const char *);
 static void write_fp_to_cell(int, FCELL *);
 static void process_raster(int, InputMask, ScaleRange, int, int, int, bool,
-			   ScaleRange);
+			   ScaleRange, double, double, int);
 static void copy_colors(const char *, char *);
 static void define_module(void);
 static struct Options define_options(void);
@@ -137,119 +134,274 @@ static CELL round_c(FCELL x)
     return (CELL) (-(-x + .5));
 }
 
-/* round height, input and output unit is meters */
-static int round_h(double x)
-{
-    x /= BIN_ALT;
-    x = floor(x + 0.5);
-    x *= BIN_ALT;
-
-    return x;
-}
-
-/* round visibility, input unit is km, output unit is meters */
-static int round_v(double x)
-{
-    x *= 1000. / BIN_VIS;
-    x = floor(x + 0.5);
-    x *= BIN_VIS;
-
-    return x;
-}
-
 /* Converts the buffer to cell and write it to disk */
 static void write_fp_to_cell(int ofd, FCELL *buf)
 {
-    CELL *cbuf;
+    static CELL *cbuf = NULL;
     int col;
 
-    cbuf = (CELL *) Rast_allocate_buf(CELL_TYPE);
+    if (!cbuf)
+	cbuf = (CELL *) Rast_allocate_buf(CELL_TYPE);
 
     for (col = 0; col < Rast_window_cols(); col++)
 	cbuf[col] = round_c(buf[col]);
     Rast_put_row(ofd, cbuf, CELL_TYPE);
 }
 
-/* compare function for RB tree */
-static int compare_hv(const void *ti_a, const void *ti_b)
+/* Lookup table of transformation input parameters
+ *
+ * The table grows to the elevation and visibility values met, its
+ * nodes are computed when first needed. Only the main thread may add
+ * nodes, interpolated values can be taken by several threads. */
+class TILookup
 {
-    struct RBitem *a, *b;
-
-    a = (struct RBitem *)ti_a;
-    b = (struct RBitem *)ti_b;
-
-    /* check most common case first
-     * also faster if either an altitude or a visibility map is given,
-     * but not both */
-    if (a->alt == b->alt) {
-	if (a->vis == b->vis)
-	    return 0;
-	if (a->vis > b->vis)
-	    return 1;
-	else if (a->vis < b->vis)
-	    return -1;
+    bool use_alt, use_vis;
+    double step_alt, step_vis;
+    int min_alt, min_vis;	/* index of the first node */
+    int n_alt, n_vis;		/* number of nodes */
+    TransformInput **nodes;
+    int n_computed;
+
+    /* extend the table to the nodes a0 to a1 and v0 to v1 */
+    void cover(int a0, int a1, int v0, int v1)
+    {
+	int min_a, max_a, min_v, max_v, ia, iv;
+	TransformInput **t;
+
+	if (a0 >= min_alt && a1 < min_alt + n_alt &&
+	    v0 >= min_vis && v1 < min_vis + n_vis)
+	    return;
+
+	/* leave some room for further nodes */
+	min_a = a0 < min_alt ? a0 - n_alt / 2 : min_alt;
+	max_a = a1 >= min_alt + n_alt ? a1 + n_alt / 2 : min_alt + n_alt - 1;
+	min_v = v0 < min_vis ? v0 - n_vis / 2 : min_vis;
+	max_v = v1 >= min_vis + n_vis ? v1 + n_vis / 2 : min_vis + n_vis - 1;
+	if (!nodes) {
+	    min_a = a0;
+	    max_a = a1;
+	    min_v = v0;
+	    max_v = v1;
+	}
+
+	t = (TransformInput **) G_calloc((size_t)(max_a - min_a + 1) *
+					 (max_v - min_v + 1),
+					 sizeof(TransformInput *));
+	for (ia = 0; nodes && ia < n_alt; ia++)
+	    for (iv = 0; iv < n_vis; iv++)
+		t[(size_t)(ia + min_alt - min_a) * (max_v - min_v + 1) +
+		  iv + min_vis - min_v] = nodes[(size_t)ia * n_vis + iv];
+	G_free(nodes);
+
+	nodes = t;
+	min_alt = min_a;
+	min_vis = min_v;
+	n_alt = max_a - min_a + 1;
+	n_vis = max_v - min_v + 1;
     }
-    else if (a->alt > b->alt)
-	return 1;
-    else if (a->alt < b->alt)
-	return -1;
 
-    /* should not be reached */
-    return 0;
-}
+    TransformInput *node(int ia, int iv)
+    {
+	TransformInput **t = &nodes[(size_t)ia * n_vis + iv];
+
+	if (!*t) {
+	    /* re-compute transformation inputs */
+	    double h = (min_alt + ia) * step_alt / 1000.;
+	    double v = (min_vis + iv) * step_vis;
+
+	    if (use_alt && use_vis)
+		pre_compute_hv(h, v);
+	    else if (use_vis)
+		pre_compute_v(v);
+	    else
+		pre_compute_h(h);
+
+	    *t = new TransformInput(compute());
+	    n_computed++;
+	}
 
-/* Cache for transformation input parameters */
-class TICache
-{
-    struct RB_TREE *RBTree;
-    unsigned int tree_size;
+	return *t;
+    }
 
-  private:
-    struct RBitem set_alt_vis(double alt, double vis)
+    /* position of a value in the table, returns the weight of the 
+     * following node */
+    static double position(double x, double step, int min, int &i)
     {
-	struct RBitem rbitem;
+	double f = x / step;
+
+	i = (int)floor(f);
+	f -= i;
+	i -= min;
 
-	/* alt and vis must be in meters */
-	rbitem.alt = (alt < 0 ? (int) (alt - 0.5) : (int) (alt + 0.5));
-	rbitem.vis = (int) (vis + 0.5);
-	
-	return rbitem;
+	return f;
+    }
+
+    static void add(TransformInput &ti, const TransformInput *t, double w)
+    {
+	int i, j;
+
+	for (i = 0; i < 2; i++)
+	    for (j = 0; j < 3; j++)
+		ti.ainr[i][j] += w * t->ainr[i][j];
+	ti.sb += w * t->sb;
+	ti.seb += w * t->seb;
+	ti.tgasm += w * t->tgasm;
+	ti.sutott += w * t->sutott;
+	ti.sdtott += w * t->sdtott;
+	ti.sast += w * t->sast;
+	ti.srotot += w * t->srotot;
+	ti.xmus += w * t->xmus;
     }
 
   public:
-      TICache()
+    TILookup(bool alt, double alt_step, bool vis, double vis_step)
     {
-	RBTree = rbtree_create(compare_hv, sizeof(struct RBitem));
-	tree_size = 0;
+	use_alt = alt;
+	use_vis = vis;
+	step_alt = alt_step;
+	step_vis = vis_step;
+	min_alt = min_vis = 0;
+	n_alt = n_vis = 0;
+	nodes = NULL;
+	n_computed = 0;
     }
-    int search(double alt, double vis, TransformInput *ti)
+
+    ~TILookup()
     {
-	struct RBitem search_ti = set_alt_vis(alt, vis);
-	struct RBitem *found_ti;
+	size_t i;
 
-	found_ti = (struct RBitem *)rbtree_find(RBTree, &search_ti);
-	if (found_ti) {
-	    *ti = found_ti->ti;
-	    return 1;
-	}
-	else
-	    return 0;
+	for (i = 0; i < (size_t)n_alt * n_vis; i++)
+	    delete nodes[i];
+	G_free(nodes);
+	G_verbose_message(_("%d sets of 6S parameters computed"),
+			  n_computed);
+    }
 
+    /* compute the nodes needed for an elevation (in meters) and a
+     * visibility (in km) */
+    void prepare(double alt, double vis)
+    {
+	int ia = 0, iv = 0, old_alt = min_alt, old_vis = min_vis;
+	double fa = 0, fv = 0;
+
+	if (use_alt)
+	    fa = position(alt, step_alt, min_alt, ia);
+	if (use_vis)
+	    fv = position(vis, step_vis, min_vis, iv);
+
+	cover(ia + min_alt, ia + min_alt + (fa > 0),
+	      iv + min_vis, iv + min_vis + (fv > 0));
+	ia += old_alt - min_alt;
+	iv += old_vis - min_vis;
+
+	node(ia, iv);
+	if (fa > 0)
+	    node(ia + 1, iv);
+	if (fv > 0)
+	    node(ia, iv + 1);
+	if (fa > 0 && fv > 0)
+	    node(ia + 1, iv + 1);
     }
 
-    void add(TransformInput ti, double alt, double vis)
+    /* interpolate the parameters for an elevation and a visibility,
+     * the nodes must have been prepared */
+    TransformInput get(double alt, double vis) const
     {
-	struct RBitem insert_ti = set_alt_vis(alt, vis);
+	int ia = 0, iv = 0;
+	double fa = 0, fv = 0;
+	const TransformInput *t00;
+	TransformInput ti;
+
+	if (use_alt)
+	    fa = position(alt, step_alt, min_alt, ia);
+	if (use_vis)
+	    fv = position(vis, step_vis, min_vis, iv);
+
+	t00 = nodes[(size_t)ia * n_vis + iv];
+	if (fa == 0 && fv == 0)
+	    return *t00;
+
+	ti = *t00;
+	memset(ti.ainr, 0, sizeof(ti.ainr));
+	ti.sb = ti.seb = ti.tgasm = ti.sutott = ti.sdtott = 0;
+	ti.sast = ti.srotot = ti.xmus = 0;
+
+	add(ti, t00, (1 - fa) * (1 - fv));
+	if (fa > 0)
+	    add(ti, nodes[(size_t)(ia + 1) * n_vis + iv], fa * (1 - fv));
+	if (fv > 0)
+	    add(ti, nodes[(size_t)ia * n_vis + iv + 1], (1 - fa) * fv);
+	if (fa > 0 && fv > 0)
+	    add(ti, nodes[(size_t)(ia + 1) * n_vis + iv + 1], fa * fv);
+
+	return ti;
+    }
+};
 
-	/* add safety check here */
-	tree_size++;
+/* rows corrected at once */
+struct Block
+{
+    FCELL **buf;		/* input and output values */
+    FCELL **alt;		/* elevation values, NULL if not used */
+    FCELL **vis;		/* visibility values, NULL if not used */
+    int ncols;
+    const TILookup *lookup;	/* NULL if elevation and visibility are fixed */
+    const TransformInput *ti;	/* fixed parameters */
+    InputMask imask;
+    ScaleRange iscale, oscale;
+    bool oint;
+    int *overflow;		/* per row: reflectance > 100% */
+    int unstable;		/* numerical instability */
+};
 
-	insert_ti.ti = ti;
+/* the threads share the lookup table of the 6S parameters, whose nodes
+ * are computed before the block is corrected, and only read it; each
+ * corrects the rows it was given in place and flags their overflow per
+ * row, unstable is only ever set to 1 so concurrent writes agree */
+static void correct_rows(int first, int last, void *closure)
+{
+    struct Block *blk = (struct Block *)closure;
+    int i, col;
 
-	rbtree_insert(RBTree, &insert_ti);
-    }
-};
+    for (i = first; i < last; i++) {
+	FCELL *buf = blk->buf[i];
 
+	blk->overflow[i] = 0;
+	for (col = 0; col < blk->ncols; col++) {
+	    TransformInput ti;
+
+	    if ((blk->vis && Rast_is_f_null_value(&blk->vis[i][col])) ||
+		(blk->alt && Rast_is_f_null_value(&blk->alt[i][col])) ||
+		Rast_is_f_null_value(&buf[col])) {
+		Rast_set_f_null_value(&buf[col], 1);
+		continue;
+	    }
+
+	    if (blk->lookup)
+		ti = blk->lookup->get(blk->alt ? blk->alt[i][col] : 0,
+				      blk->vis ? blk->vis[i][col] : 0);
+	    else
+		ti = *blk->ti;
+
+	    /* transform from iscale.[min,max] to [0,1] */
+	    buf[col] =
+		(buf[col] - blk->iscale.min) / ((double)blk->iscale.max -
+						(double)blk->iscale.min);
+	    buf[col] = transform(ti, blk->imask, buf[col]);
+	    if (Rast_is_f_null_value(&buf[col])) {
+		blk->unstable = 1;
+		continue;
+	    }
+	    /* transform from [0,1] to oscale.[min,max] */
+	    buf[col] =
+		buf[col] * ((double)blk->oscale.max -
+			    (double)blk->oscale.min) + blk->oscale.min;
+
+	    if (blk->oint && (buf[col] > (double)blk->oscale.max))
+		blk->overflow[i] = 1;
+	}
+    }
+}
 
 /* Process the raster and do atmospheric corrections.
    Params:
@@ -264,172 +416,136 @@ class TICache
    ofd: output file descriptor
    oflt: if true use FCELL_TYPE for output
    oscale: output file's range (default is min = 0, max = 255)
+
+   step_alt, step_vis: steps between the nodes of the lookup table
+   nprocs: number of threads
  */
 static void process_raster(int ifd, InputMask imask, ScaleRange iscale,
 			   int ialt_fd, int ivis_fd, int ofd, bool oint,
-			   ScaleRange oscale)
+			   ScaleRange oscale, double step_alt,
+			   double step_vis, int nprocs)
 {
-    FCELL *buf;			/* buffer for the input values */
-    FCELL *alt = NULL;		/* buffer for the elevation values */
-    FCELL *vis = NULL;		/* buffer for the visibility values */
-    int cur_alt = -100000;
-    int cur_vis = -100000;
-    int row, col, nrows, ncols;
-    /* switch on optimization automatically if elevation and/or visibility map is given */
-    bool optimize = (ialt_fd >= 0 || ivis_fd >= 0);
-    
-#ifdef _NO_OPTIMIZE_
-    optimize = false;
-#endif
+    int row, col, nrows, ncols, nblock, n, i;
+    struct Block blk;
+    TILookup *lookup = NULL;
 
     /* do initial computation with global elevation and visibility values */
     TransformInput ti;
 
     ti = compute();
 
-    /* use a cache to increase computation speed when an elevation map 
-     * and/or a visibility map is given */
-    TICache ticache;
-
-    /* allocate memory for buffers */
-    buf = (FCELL *) Rast_allocate_buf(FCELL_TYPE);
-    if (ialt_fd >= 0)
-	alt = (FCELL *) Rast_allocate_buf(FCELL_TYPE);
-    if (ivis_fd >= 0)
-	vis = (FCELL *) Rast_allocate_buf(FCELL_TYPE);
+    /* use a lookup table when an elevation map and/or a visibility map
+     * is given */
+    if (ialt_fd >= 0 || ivis_fd >= 0)
+	lookup = new TILookup(ialt_fd >= 0, step_alt, ivis_fd >= 0, step_vis);
 
     nrows = Rast_window_rows();
     ncols = Rast_window_cols();
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
 
-    for (row = 0; row < nrows; row++) {
+    /* allocate memory for buffers */
+    blk.buf = (FCELL **) G_malloc(nblock * sizeof(FCELL *));
+    blk.alt = ialt_fd >= 0 ? (FCELL **) G_malloc(nblock * sizeof(FCELL *))
+	: NULL;
+    blk.vis = ivis_fd >= 0 ? (FCELL **) G_malloc(nblock * sizeof(FCELL *))
+	: NULL;
+    for (i = 0; i < nblock; i++) {
+	blk.buf[i] = (FCELL *) Rast_allocate_buf(FCELL_TYPE);
+	if (blk.alt)
+	    blk.alt[i] = (FCELL *) Rast_allocate_buf(FCELL_TYPE);
+	if (blk.vis)
+	    blk.vis[i] = (FCELL *) Rast_allocate_buf(FCELL_TYPE);
+    }
+    blk.overflow = (int *)G_malloc(nblock * sizeof(int));
+    blk.ncols = ncols;
+    blk.lookup = lookup;
+    blk.ti = &ti;
+    blk.imask = imask;
+    blk.iscale = iscale;
+    blk.oscale = oscale;
+    blk.oint = oint;
+    blk.unstable = 0;
+
+    for (row = 0; row < nrows; row += nblock) {
 	G_percent(row, nrows, 1);	/* keep the user informed of our progress */
 
-	/* read the next row */
-	Rast_get_row(ifd, buf, row, FCELL_TYPE);
+	n = nrows - row < nblock ? nrows - row : nblock;
 
-	/* read the next row of elevation values */
-	if (ialt_fd >= 0)
-	    Rast_get_row(ialt_fd, alt, row, FCELL_TYPE);
+	for (i = 0; i < n; i++) {
+	    /* read the next row */
+	    Rast_get_row(ifd, blk.buf[i], row + i, FCELL_TYPE);
 
-	/* read the next row of elevation values */
-	if (ivis_fd >= 0)
-	    Rast_get_row(ivis_fd, vis, row, FCELL_TYPE);
+	    /* read the next row of elevation values */
+	    if (blk.alt)
+		Rast_get_row(ialt_fd, blk.alt[i], row + i, FCELL_TYPE);
 
-	/* loop over all the values in the row */
-	for (col = 0; col < ncols; col++) {
-	    if ((vis && Rast_is_f_null_value(&vis[col])) ||
-		(alt && Rast_is_f_null_value(&alt[col])) ||
-		Rast_is_f_null_value(&buf[col])) {
-		Rast_set_f_null_value(&buf[col], 1);
-		continue;
-	    }
-	    if (ialt_fd >= 0) {
-		alt[col] = round_h(alt[col]); /* in meters */
-	    }
-	    if (ivis_fd >= 0) {
-		if (vis[col] < 0) {
-		     /* negative visibility is invalid */
-		    G_warning(_("Negative visibility!"));
-		    vis[col] = 0;
-		}
-		if (vis[col] < 5.0) {
-		     /* too low visibility, text comes from 6S main.f L109-113 */
-		    G_warning(_("The visibility must be better than 5.0km, "
-				"for smaller values calculations might be no more valid!"));
-		}
-		vis[col] = round_v(vis[col]); /* from km to meters */
-	    }
-
-	    /* check if altitude or visibility has changed */
-	    if ((ialt_fd >= 0) && (ivis_fd >= 0) &&
-		((cur_vis != vis[col]) || (cur_alt != alt[col]))) {
-		cur_alt = alt[col];
-		cur_vis = vis[col];
-		if (optimize) {
-		    int in_cache = ticache.search(cur_alt, cur_vis, &ti);
+	    /* read the next row of visibility values */
+	    if (blk.vis)
+		Rast_get_row(ivis_fd, blk.vis[i], row + i, FCELL_TYPE);
 
-		    if (!in_cache) {
-			pre_compute_hv(alt[col] / 1000., vis[col] / 1000.);	/* re-compute transformation inputs */
-			ti = compute();	/* ... */
-
-			ticache.add(ti, cur_alt, cur_vis);
-		    }
-		}
-		else {
-		    pre_compute_hv(alt[col] / 1000., vis[col] / 1000.);	/* re-compute transformation inputs */
-		    ti = compute();	/* ... */
-		}
-	    }
-	    else {
-		if ((ivis_fd >= 0) && (cur_vis != vis[col])) {
-		    cur_vis = vis[col];
+	    if (!lookup)
+		continue;
 
-		    if (optimize) {
-			int in_cache = ticache.search(cur_alt, cur_vis, &ti);
+	    /* compute the parameters needed for the row */
+	    for (col = 0; col < ncols; col++) {
+		FCELL *vis = blk.vis ? &blk.vis[i][col] : NULL;
 
-			if (!in_cache) {
-			    pre_compute_v(vis[col] / 1000.);	/* re-compute transformation inputs */
-			    ti = compute();	/* ... */
+		if ((vis && Rast_is_f_null_value(vis)) ||
+		    (blk.alt && Rast_is_f_null_value(&blk.alt[i][col])) ||
+		    Rast_is_f_null_value(&blk.buf[i][col]))
+		    continue;
 
-			    ticache.add(ti, cur_alt, cur_vis);
-			}
+		if (vis) {
+		    if (*vis < 0) {
+			/* negative visibility is invalid */
+			G_warning(_("Negative visibility!"));
+			*vis = 0;
 		    }
-		    else {
-			pre_compute_v(vis[col] / 1000.);	/* re-compute transformation inputs */
-			ti = compute();	/* ... */
+		    if (*vis < 5.0) {
+			/* too low visibility, text comes from 6S main.f L109-113 */
+			G_warning(_("The visibility must be better than 5.0km, "
+				    "for smaller values calculations might be no more valid!"));
 		    }
 		}
 
-		if ((ialt_fd >= 0) && (cur_alt != alt[col])) {
-		    cur_alt = alt[col];
-
-		    if (optimize) {
-			int in_cache = ticache.search(alt[col], cur_vis, &ti);
+		lookup->prepare(blk.alt ? blk.alt[i][col] : 0,
+				vis ? *vis : 0);
+	    }
+	}
 
-			if (!in_cache) {
-			    pre_compute_h(alt[col] / 1000.);	/* re-compute transformation inputs */
-			    ti = compute();	/* ... */
+	/* the rows of a block are independent */
+	G_parallel_for(0, n, BLOCK_ROWS, correct_rows, &blk);
 
-			    ticache.add(ti, cur_alt, cur_vis);
-			}
-		    }
-		    else {
-			pre_compute_h(alt[col] / 1000.);	/* re-compute transformation inputs */
-			ti = compute();	/* ... */
-		    }
-		}
-	    }
-	    G_debug(3, "Computed r%d (%d), c%d (%d)", row, nrows, col, ncols);
-	    /* transform from iscale.[min,max] to [0,1] */
-	    buf[col] =
-		(buf[col] - iscale.min) / ((double)iscale.max -
-					   (double)iscale.min);
-	    buf[col] = transform(ti, imask, buf[col]);
-	    if (Rast_is_f_null_value(&buf[col]))
-		G_fatal_error(_("Numerical instability in 6S"));
-	    /* transform from [0,1] to oscale.[min,max] */
-	    buf[col] =
-		buf[col] * ((double)oscale.max - (double)oscale.min) +
-		oscale.min;
+	if (blk.unstable)
+	    G_fatal_error(_("Numerical instability in 6S"));
 
-	    if (oint && (buf[col] > (double)oscale.max))
+	/* write output */
+	for (i = 0; i < n; i++) {
+	    if (blk.overflow[i])
 		G_warning(_("The output data will overflow. Reflectance > 100%%"));
+	    if (oint)
+		write_fp_to_cell(ofd, blk.buf[i]);
+	    else
+		Rast_put_row(ofd, blk.buf[i], FCELL_TYPE);
 	}
-
-	/* write output */
-	if (oint)
-	    write_fp_to_cell(ofd, buf);
-	else
-	    Rast_put_row(ofd, buf, FCELL_TYPE);
     }
     G_percent(1, 1, 1);
 
     /* free allocated memory */
-    G_free(buf);
-    if (ialt_fd >= 0)
-	G_free(alt);
-    if (ivis_fd >= 0)
-	G_free(vis);
+    for (i = 0; i < nblock; i++) {
+	G_free(blk.buf[i]);
+	if (blk.alt)
+	    G_free(blk.alt[i]);
+	if (blk.vis)
+	    G_free(blk.vis[i]);
+    }
+    G_free(blk.buf);
+    if (blk.alt)
+	G_free(blk.alt);
+    if (blk.vis)
+	G_free(blk.vis);
+    G_free(blk.overflow);
+    delete lookup;
 }
 
 
@@ -523,6 +639,22 @@ static struct Options define_options(void)
     opts.oscl->description = _("Rescale output raster map");
     opts.oscl->guisection = _("Output");
 
+    opts.prec = G_define_option();
+    opts.prec->key = "precision";
+    opts.prec->type = TYPE_DOUBLE;
+    opts.prec->key_desc = "elevation,visibility";
+    opts.prec->answer = G_store(STEP_ALT "," STEP_VIS);
+    opts.prec->required = NO;
+    opts.prec->label =
+	_("Steps of the lookup table of 6S parameters for elevation (in m) "
+	  "and visibility (in km)");
+    opts.prec->description =
+	_("Used with elevation and/or visibility raster maps, "
+	  "the parameters are interpolated in between");
+    opts.prec->guisection = _("Input");
+
+    opts.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     opts.oint = G_define_flag();
     opts.oint->key = 'i';
     opts.oint->description = _("Output raster map as integer");
@@ -590,6 +722,8 @@ int main(int argc, char *argv[])
     int ivis_fd = -1;		/* input visibility map's file descriptor */
     struct History hist;
     struct Cell_head orig_window;
+    double step_alt, step_vis;	/* steps of the lookup table */
+    int nprocs;
 
     /* Define module */
     define_module();
@@ -602,6 +736,14 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv) < 0)
 	exit(EXIT_FAILURE);
 
+    if (sscanf(opts.prec->answers[0], "%lf", &step_alt) != 1 ||
+	sscanf(opts.prec->answers[1], "%lf", &step_vis) != 1 ||
+	step_alt <= 0 || step_vis <= 0)
+	G_fatal_error(_("Option <%s> must be two positive numbers"),
+		      opts.prec->key);
+
+    nprocs = G_set_nprocs(opts.nprocs);
+
     G_get_set_window(&orig_window);
     adjust_region(opts.iimg->answer);
 
@@ -653,7 +795,8 @@ int main(int argc, char *argv[])
     /* process the input raster and produce our atmospheric corrected output raster. */
     G_message(_("Atmospheric correction..."));
     process_raster(iimg_fd, imask, iscale, ialt_fd, ivis_fd,
-		   oimg_fd, opts.oint->answer, oscale);
+		   oimg_fd, opts.oint->answer, oscale, step_alt, step_vis,
+		   nprocs);
 
 
     /* Close the input and output file descriptors */
@@ -19,6 +19,7 @@
  *
  *****************************************************************************/
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -66,7 +67,7 @@ int main(int argc, char *argv[])
     {
 	struct Option *group_name, *subgroup_name, *out_sig, *seed_sig,
 	    *class, *sample_interval, *iterations, *separation,
-	    *convergence, *min_size, *report_file;
+	    *convergence, *min_size, *report_file, *init_means, *nprocs;
     } parm;
 
     G_gisinit(argv[0]);
@@ -152,6 +153,21 @@ int main(int argc, char *argv[])
     parm.min_size->answer = "17";
     parm.min_size->guisection = _("Settings");
 
+    parm.init_means = G_define_option();
+    parm.init_means->key = "init";
+    parm.init_means->type = TYPE_STRING;
+    parm.init_means->required = NO;
+    parm.init_means->options = "stddev,kmeanspp";
+    parm.init_means->answer = "stddev";
+    parm.init_means->description = _("Method for the initial class means");
+    G_asprintf((char **)&parm.init_means->descriptions,
+	       "stddev;%s;kmeanspp;%s",
+	       _("Equally spaced within band mean +- standard deviation"),
+	       _("k-means++ seeding with sample points"));
+    parm.init_means->guisection = _("Settings");
+
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     parm.report_file = G_define_standard_option(G_OPT_F_OUTPUT);
     parm.report_file->key = "reportfile";
     parm.report_file->required = NO;
@@ -163,6 +179,8 @@ int main(int argc, char *argv[])
     group = parm.group_name->answer;	/* a required parameter */
     subgroup = parm.subgroup_name->answer;	/* required */
     outsigfile = parm.out_sig->answer;
+
+    G_set_nprocs(parm.nprocs);
     
     /* check all the inputs */
     if (!I_find_group(group)) {
@@ -185,7 +203,8 @@ int main(int argc, char *argv[])
     ncols = Rast_window_cols();
 
     I_cluster_clear(&C);
-
+    if (strcmp(parm.init_means->answer, "kmeanspp") == 0)
+	C.init_means = I_CLUSTER_MEANS_KMEANSPP;
 
     if (sscanf(parm.class->answer, "%d", &maxclass) != 1 || maxclass < 1
 	|| maxclass > 255) {
@@ -275,6 +294,8 @@ int main(int argc, char *argv[])
     if (insigfile)
 	fprintf(report, _(" [from signature file %s]"), insigfile);
     fprintf(report, "%s", HOST_NEWLINE);
+    fprintf(report, _(" Initial class means:          %s%s"),
+	    parm.init_means->answer, HOST_NEWLINE);
     fprintf(report, _(" Minimum class size:           %d%s"), mcs, HOST_NEWLINE);
     fprintf(report, _(" Minimum class separation:     %f%s"), sep, HOST_NEWLINE);
     fprintf(report, _(" Percent convergence:          %f%s"), conv, HOST_NEWLINE);
@@ -39,8 +39,12 @@
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/gmath.h>
+#include <grass/segment.h>
 #include <grass/glocale.h>
 
+/* rows and columns of the tiles of the out-of-core mode */
+#define SEG_SIZE 64
+
 static void fft_colors(const char *name)
 {
     struct Colors wave, colors;
@@ -55,62 +59,206 @@ static void fft_colors(const char *name)
     Rast_free_colors(&colors);
 }
 
-int main(int argc, char *argv[])
+#ifdef HAVE_FFTW3_H
+
+/*
+ * The data are rotated for standard display by swapping the first and
+ * the second half of the rows and of the columns. Returns the frequency
+ * index shown at position i of n.
+ */
+static int rotate(int i, int n)
 {
-    /* Global variable & function declarations */
-    struct GModule *module;
-    struct {
-	struct Option *orig, *real, *imag;
-    } opt;
-    const char *Cellmap_real, *Cellmap_imag;
-    const char *Cellmap_orig;
-    int inputfd, realfd, imagfd;	/* the input and output file descriptors */
-    struct Cell_head window;
+    int h = n / 2;
+
+    if (i < h)
+	return i + h;
+    if (i < 2 * h)
+	return i - h;
+    return i;
+}
+
+/*
+ * Write a rotated row of the spectrum. frow and mrow are the non-redundant
+ * columns of the frequency row and of its mirrored row, the remaining
+ * columns are given by the Hermitian symmetry of the spectrum.
+ */
+static void put_spectrum_row(int realfd, int imagfd, double (*frow)[2],
+			     double (*mrow)[2], DCELL *cell_real,
+			     DCELL *cell_imag, int cols)
+{
+    int j, c;
+
+    for (j = 0; j < cols; j++) {
+	c = rotate(j, cols);
+	if (c <= cols / 2) {
+	    cell_real[j] = frow[c][0];
+	    cell_imag[j] = frow[c][1];
+	}
+	else {
+	    cell_real[j] = mrow[cols - c][0];
+	    cell_imag[j] = -mrow[cols - c][1];
+	}
+    }
+    Rast_put_d_row(realfd, cell_real);
+    Rast_put_d_row(imagfd, cell_imag);
+}
+
+/* transform the whole band in memory */
+static void fft_memory(const char *name, int inputfd, int realfd,
+		       int imagfd, int rows, int cols)
+{
+    double (*data)[2];
     DCELL *cell_real, *cell_imag;
-    int rows, cols;		/* number of rows & columns */
-    long totsize;		/* Total number of data points */
-    double (*data)[2];		/* Data structure containing real & complex values of FFT */
-    int i, j;			/* Loop control variables */
+    int hcols = cols / 2 + 1;
+    int i, r;
 
-    G_gisinit(argv[0]);
+    /* Allocate memory for the non-redundant half of the spectrum, the
+       real input rows are stored in place with 2 * hcols values each.
+     */
+    data = G_malloc((size_t)rows * hcols * 2 * sizeof(double));
 
-    module = G_define_module();
-    G_add_keyword(_("imagery"));
-    G_add_keyword(_("transformation"));
-    G_add_keyword(_("Fast Fourier Transform"));
-    module->description =
-	_("Fast Fourier Transform (FFT) for image processing.");
+    cell_real = Rast_allocate_d_buf();
+    cell_imag = Rast_allocate_d_buf();
 
-    /* define options */
-    /* define options */
-    opt.orig = G_define_standard_option(G_OPT_R_INPUT);
+    /* Read in cell map values */
+    G_message(_("Reading the raster map <%s>..."), name);
+    for (i = 0; i < rows; i++) {
+	Rast_get_d_row(inputfd, (DCELL *) (data + (size_t)i * hcols), i);
+	G_percent(i + 1, rows, 2);
+    }
 
-    opt.real = G_define_standard_option(G_OPT_R_OUTPUT);
-    opt.real->key = "real";
-    opt.real->description = _("Name for output real part arrays stored as raster map");
+    /* perform FFT */
+    G_message(_("Starting FFT..."));
+    G_math_fft2_r2c(data, cols, rows);
 
-    opt.imag = G_define_standard_option(G_OPT_R_OUTPUT);
-    opt.imag->key = "imaginary";
-    opt.imag->description = _("Name for output imaginary part arrays stored as raster map");
-    
-    if (G_parser(argc, argv))
-	exit(EXIT_FAILURE);
+    G_message(_("Writing transformed data..."));
+    for (i = 0; i < rows; i++) {
+	r = rotate(i, rows);
+	put_spectrum_row(realfd, imagfd, data + (size_t)r * hcols,
+			 data + (size_t)((rows - r) % rows) * hcols,
+			 cell_real, cell_imag, cols);
+	G_percent(i + 1, rows, 2);
+    }
 
-    Cellmap_orig = opt.orig->answer;
-    Cellmap_real = opt.real->answer;
-    Cellmap_imag = opt.imag->answer;
+    G_free(cell_real);
+    G_free(cell_imag);
+    G_free(data);
+}
 
-    inputfd = Rast_open_old(Cellmap_orig, "");
+/*
+ * Transform the band out of core: the rows are transformed and stored in
+ * a segment file, then the columns are transformed in blocks of
+ * SEG_SIZE columns. Only the non-redundant half of the spectrum is stored.
+ */
+static void fft_segment(const char *name, int inputfd, int realfd,
+			int imagfd, int rows, int cols, int memory)
+{
+    SEGMENT seg;
+    double (*buf)[2], (*row1)[2], (*row2)[2];
+    DCELL *cell_real, *cell_imag;
+    int hcols = cols / 2 + 1;
+    int nseg, nseg_total, brows, i, r, c, c0, bcols;
+    double seg_mb, norm;
+
+    /* keep at least one column of tiles in memory */
+    seg_mb = (double)SEG_SIZE * SEG_SIZE * 2 * sizeof(double) / 1048576.;
+    nseg_total = ((rows + SEG_SIZE - 1) / SEG_SIZE) *
+	((hcols + SEG_SIZE - 1) / SEG_SIZE);
+    nseg = (memory / 2) / seg_mb;
+    if (nseg < (rows + SEG_SIZE - 1) / SEG_SIZE + 1)
+	nseg = (rows + SEG_SIZE - 1) / SEG_SIZE + 1;
+    if (nseg > nseg_total)
+	nseg = nseg_total;
+
+    G_verbose_message(_("Will need at least %.2f MB of disk space"),
+		      (double)rows * hcols * 2 * sizeof(double) / 1048576.);
+    G_verbose_message(_("%d of %d segments are kept in memory"), nseg,
+		      nseg_total);
+
+    if (Segment_open(&seg, G_tempfile(), rows, hcols, SEG_SIZE, SEG_SIZE,
+		     2 * sizeof(double), nseg) != 1)
+	G_fatal_error(_("Unable to create temporary segment file"));
+
+    /* the buffer holds a block of rows or SEG_SIZE columns */
+    brows = SEG_SIZE;
+    if (brows > rows)
+	brows = rows;
+    buf = G_malloc((size_t)SEG_SIZE * (rows > hcols ? rows : hcols) *
+		   2 * sizeof(double));
 
-    if (Rast_maskfd() >= 0)
-	G_warning(_("Raster MASK found, consider to remove "
-		    "(see man-page). Will continue..."));
+    cell_real = Rast_allocate_d_buf();
+    cell_imag = Rast_allocate_d_buf();
 
-    G_get_set_window(&window);	/* get the current window for later */
+    /* transform the rows */
+    G_message(_("Reading the raster map <%s>..."), name);
+    for (r = 0; r < rows; r += brows) {
+	int n = rows - r < brows ? rows - r : brows;
+
+	for (i = 0; i < n; i++)
+	    Rast_get_d_row(inputfd, (DCELL *) (buf + (size_t)i * hcols),
+			   r + i);
+	G_math_fft_rows_r2c(buf, cols, n);
+	for (i = 0; i < n; i++)
+	    Segment_put_row(&seg, buf + (size_t)i * hcols, r + i);
+
+	G_percent(r + n, rows, 2);
+    }
+    Segment_flush(&seg);
+
+    /* transform the columns */
+    G_message(_("Transforming the columns..."));
+    norm = 1.0 / sqrt((double)rows * cols);
+    for (c0 = 0; c0 < hcols; c0 += SEG_SIZE) {
+	bcols = hcols - c0 < SEG_SIZE ? hcols - c0 : SEG_SIZE;
+
+	for (r = 0; r < rows; r++)
+	    for (c = 0; c < bcols; c++)
+		Segment_get(&seg, buf[(size_t)c * rows + r], r, c0 + c);
+	G_math_fft_rows(-1, buf, rows, bcols);
+	for (r = 0; r < rows; r++)
+	    for (c = 0; c < bcols; c++) {
+		double *v = buf[(size_t)c * rows + r];
+
+		v[0] *= norm;
+		v[1] *= norm;
+		Segment_put(&seg, v, r, c0 + c);
+	    }
+
+	G_percent(c0 + bcols, hcols, 2);
+    }
+    Segment_flush(&seg);
+
+    G_message(_("Writing transformed data..."));
+    row1 = G_malloc((size_t)hcols * 2 * sizeof(double));
+    row2 = G_malloc((size_t)hcols * 2 * sizeof(double));
+    for (i = 0; i < rows; i++) {
+	r = rotate(i, rows);
+	Segment_get_row(&seg, row1, r);
+	Segment_get_row(&seg, row2, (rows - r) % rows);
+	put_spectrum_row(realfd, imagfd, row1, row2, cell_real, cell_imag,
+			 cols);
+	G_percent(i + 1, rows, 2);
+    }
+
+    Segment_close(&seg);
+    G_free(row1);
+    G_free(row2);
+    G_free(buf);
+    G_free(cell_real);
+    G_free(cell_imag);
+}
+
+#else
+
+/* transform the whole band in memory with the complex transform */
+static void fft_memory(const char *name, int inputfd, int realfd,
+		       int imagfd, int rows, int cols)
+{
+    DCELL *cell_real, *cell_imag;
+    long totsize;		/* Total number of data points */
+    double (*data)[2];		/* Data structure containing real & complex values of FFT */
+    int i, j;			/* Loop control variables */
 
-    /* get the rows and columns in the current window */
-    rows = Rast_window_rows();
-    cols = Rast_window_cols();
     totsize = rows * cols;
 
     /* Allocate appropriate memory for the structure containing
@@ -126,8 +274,7 @@ int main(int argc, char *argv[])
 #define C(i, j) ((i) * cols + (j))
 
     /* Read in cell map values */
-    G_message(_("Reading the raster map <%s>..."),
-	      Cellmap_orig);
+    G_message(_("Reading the raster map <%s>..."), name);
     for (i = 0; i < rows; i++) {
 	Rast_get_d_row(inputfd, cell_real, i);
 	for (j = 0; j < cols; j++) {
@@ -138,17 +285,10 @@ int main(int argc, char *argv[])
 	G_percent(i+1, rows, 2);
     }
 
-    /* close input cell map */
-    Rast_close(inputfd);
-
     /* perform FFT */
     G_message(_("Starting FFT..."));
     fft2(-1, data, totsize, cols, rows);
 
-    /* open the output cell maps */
-    realfd = Rast_open_fp_new(Cellmap_real);
-    imagfd = Rast_open_fp_new(Cellmap_imag);
-
 #define SWAP1(a, b)				\
     do {					\
 	double temp = (a);			\
@@ -184,19 +324,110 @@ int main(int argc, char *argv[])
 	G_percent(i+1, rows, 2);
     }
 
-    Rast_close(realfd);
-    Rast_close(imagfd);
-
     G_free(cell_real);
     G_free(cell_imag);
 
+    /* Release memory resources */
+    G_free(data);
+}
+
+#endif /* HAVE_FFTW3_H */
+
+int main(int argc, char *argv[])
+{
+    /* Global variable & function declarations */
+    struct GModule *module;
+    struct {
+	struct Option *orig, *real, *imag, *memory, *threads;
+    } opt;
+    const char *Cellmap_real, *Cellmap_imag;
+    const char *Cellmap_orig;
+    int inputfd, realfd, imagfd;	/* the input and output file descriptors */
+    struct Cell_head window;
+    int rows, cols;		/* number of rows & columns */
+    int memory, threads;
+
+    G_gisinit(argv[0]);
+
+    module = G_define_module();
+    G_add_keyword(_("imagery"));
+    G_add_keyword(_("transformation"));
+    G_add_keyword(_("Fast Fourier Transform"));
+    module->description =
+	_("Fast Fourier Transform (FFT) for image processing.");
+
+    /* define options */
+    opt.orig = G_define_standard_option(G_OPT_R_INPUT);
+
+    opt.real = G_define_standard_option(G_OPT_R_OUTPUT);
+    opt.real->key = "real";
+    opt.real->description = _("Name for output real part arrays stored as raster map");
+
+    opt.imag = G_define_standard_option(G_OPT_R_OUTPUT);
+    opt.imag->key = "imaginary";
+    opt.imag->description = _("Name for output imaginary part arrays stored as raster map");
+
+    opt.memory = G_define_option();
+    opt.memory->key = "memory";
+    opt.memory->type = TYPE_INTEGER;
+    opt.memory->required = NO;
+    opt.memory->answer = "300";
+    opt.memory->label = _("Maximum memory to be used in MB");
+    opt.memory->description =
+	_("Larger raster maps are transformed out of core");
+
+    opt.threads = G_define_standard_option(G_OPT_M_NPROCS);
+
+    if (G_parser(argc, argv))
+	exit(EXIT_FAILURE);
+
+    Cellmap_orig = opt.orig->answer;
+    Cellmap_real = opt.real->answer;
+    Cellmap_imag = opt.imag->answer;
+
+    memory = atoi(opt.memory->answer);
+    if (memory < 1)
+	G_fatal_error(_("Illegal value for '%s' (%s)"), opt.memory->key,
+		      opt.memory->answer);
+
+    threads = G_set_nprocs(opt.threads);
+    if (G_math_fft_threads(threads) < threads)
+	G_warning(_("GRASS GIS is not compiled with FFTW threads support, "
+		    "parallel computation is disabled."));
+
+    inputfd = Rast_open_old(Cellmap_orig, "");
+
+    if (Rast_maskfd() >= 0)
+	G_warning(_("Raster MASK found, consider to remove "
+		    "(see man-page). Will continue..."));
+
+    G_get_set_window(&window);	/* get the current window for later */
+
+    /* get the rows and columns in the current window */
+    rows = Rast_window_rows();
+    cols = Rast_window_cols();
+
+    /* open the output cell maps */
+    realfd = Rast_open_fp_new(Cellmap_real);
+    imagfd = Rast_open_fp_new(Cellmap_imag);
+
+#ifdef HAVE_FFTW3_H
+    if ((double)rows * (cols / 2 + 1) * 2 * sizeof(double) / 1048576. >
+	memory)
+	fft_segment(Cellmap_orig, inputfd, realfd, imagfd, rows, cols, memory);
+    else
+#endif
+	fft_memory(Cellmap_orig, inputfd, realfd, imagfd, rows, cols);
+
+    /* close the cell maps */
+    Rast_close(inputfd);
+    Rast_close(realfd);
+    Rast_close(imagfd);
+
     /* set up the color tables */
     fft_colors(Cellmap_real);
     fft_colors(Cellmap_imag);
 
-    /* Release memory resources */
-    G_free(data);
-
     G_done_msg(_("FFT is now complete"));
 
     exit(EXIT_SUCCESS);
@@ -37,6 +37,10 @@
 #include <grass/raster.h>
 #include <grass/glocale.h>
 #include <grass/gmath.h>
+#include <grass/segment.h>
+
+/* rows and columns of the tiles of the out-of-core mode */
+#define SEG_SIZE 64
 
 static void fft_colors(const char *name)
 {
@@ -51,78 +55,258 @@ static void fft_colors(const char *name)
     Rast_write_colors(name, G_mapset(), &colors);
 }
 
-int main(int argc, char *argv[])
+#ifdef HAVE_FFTW3_H
+
+/*
+ * The input data are rotated for standard display, the first and the
+ * second half of the rows and of the columns are swapped. Returns the
+ * position of frequency index i of n in the input.
+ */
+static int rotate(int i, int n)
 {
-    /* Global variable & function declarations */
-    struct GModule *module;
-    struct {
-	struct Option *orig, *real, *imag;
-    } opt;
-    const char *Cellmap_real, *Cellmap_imag;
-    const char *Cellmap_orig;
-    int realfd, imagfd,  outputfd, maskfd;	/* the input and output file descriptors */
-    struct Cell_head realhead, imaghead;
-    DCELL *cell_real, *cell_imag;
-    CELL *maskbuf;
+    int h = n / 2;
 
-    int i, j;			/* Loop control variables */
-    int rows, cols;		/* number of rows & columns */
-    long totsize;		/* Total number of data points */
-    double (*data)[2];		/* Data structure containing real & complex values of FFT */
+    if (i < h)
+	return i + h;
+    if (i < 2 * h)
+	return i - h;
+    return i;
+}
 
-    G_gisinit(argv[0]);
+/* read a rotated row of the spectrum, cells outside the mask are zero */
+static void get_spectrum_row(int realfd, int imagfd, int maskfd, int row,
+			     DCELL *cell_real, DCELL *cell_imag,
+			     CELL *maskbuf, int cols)
+{
+    int j;
 
-    /* Set description */
-    module = G_define_module();
-    G_add_keyword(_("imagery"));
-    G_add_keyword(_("transformation"));
-    G_add_keyword(_("Fast Fourier Transform"));
-    module->description =
-	_("Inverse Fast Fourier Transform (IFFT) for image processing.");
+    Rast_get_d_row(realfd, cell_real, row);
+    Rast_get_d_row(imagfd, cell_imag, row);
+    if (maskfd >= 0) {
+	Rast_get_c_row(maskfd, maskbuf, row);
+	for (j = 0; j < cols; j++) {
+	    if (maskbuf[j] == 0) {
+		cell_real[j] = 0.0;
+		cell_imag[j] = 0.0;
+	    }
+	}
+    }
+}
 
-    /* define options */
-    opt.real = G_define_standard_option(G_OPT_R_INPUT);
-    opt.real->key = "real";
-    opt.real->description = _("Name of input raster map (image fft, real part)");
+/*
+ * The real part of the inverse transform of a spectrum X is the inverse
+ * transform of its Hermitian part (X[r][c] + conj(X[-r][-c])) / 2, of
+ * which only the non-redundant columns are needed. The Hermitian parts
+ * of the frequency row r and of its mirrored row are computed from
+ * the input rows of both.
+ */
+static void hermitian_rows(int realfd, int imagfd, int maskfd, int r,
+			   double (*frow)[2], double (*mrow)[2],
+			   DCELL *cell_real[2], DCELL *cell_imag[2],
+			   CELL *maskbuf, int rows, int cols)
+{
+    int hcols = cols / 2 + 1;
+    int m = (rows - r) % rows;
+    int c, jf, jm;
+
+    get_spectrum_row(realfd, imagfd, maskfd, rotate(r, rows), cell_real[0],
+		     cell_imag[0], maskbuf, cols);
+    get_spectrum_row(realfd, imagfd, maskfd, rotate(m, rows), cell_real[1],
+		     cell_imag[1], maskbuf, cols);
+
+    for (c = 0; c < hcols; c++) {
+	jf = rotate(c, cols);
+	jm = rotate((cols - c) % cols, cols);
+	frow[c][0] = (cell_real[0][jf] + cell_real[1][jm]) / 2.0;
+	frow[c][1] = (cell_imag[0][jf] - cell_imag[1][jm]) / 2.0;
+	if (mrow) {
+	    mrow[c][0] = (cell_real[1][jf] + cell_real[0][jm]) / 2.0;
+	    mrow[c][1] = (cell_imag[1][jf] - cell_imag[0][jm]) / 2.0;
+	}
+    }
+}
 
-    opt.imag = G_define_standard_option(G_OPT_R_INPUT);
-    opt.imag->key = "imaginary";
-    opt.imag->description = _("Name of input raster map (image fft, imaginary part");
+/* transform the whole spectrum in memory */
+static void ifft_memory(int realfd, int imagfd, int maskfd, int outputfd,
+			const char *name, int rows, int cols)
+{
+    double (*data)[2];
+    DCELL *cell_real[2], *cell_imag[2];
+    CELL *maskbuf = NULL;
+    int hcols = cols / 2 + 1;
+    int i, m;
+
+    /* Allocate memory for the non-redundant half of the spectrum, the
+       real result rows are stored in place with 2 * hcols values each.
+     */
+    data = G_malloc((size_t)rows * hcols * 2 * sizeof(double));
 
-    opt.orig = G_define_standard_option(G_OPT_R_OUTPUT);
-    opt.orig->description = _("Name for output raster map");
-    
-    /*call parser */
-    if (G_parser(argc, argv))
-	exit(EXIT_FAILURE);
+    for (i = 0; i < 2; i++) {
+	cell_real[i] = Rast_allocate_d_buf();
+	cell_imag[i] = Rast_allocate_d_buf();
+    }
+    if (maskfd >= 0)
+	maskbuf = Rast_allocate_c_buf();
 
-    Cellmap_real = opt.real->answer;
-    Cellmap_imag = opt.imag->answer;
-    Cellmap_orig = opt.orig->answer;
+    /* Read in cell map values */
+    G_message(_("Reading raster maps..."));
+    for (i = 0; i < rows; i++) {
+	m = (rows - i) % rows;
+	if (m < i)
+	    continue;
+	hermitian_rows(realfd, imagfd, maskfd, i, data + (size_t)i * hcols,
+		       m != i ? data + (size_t)m * hcols : NULL,
+		       cell_real, cell_imag, maskbuf, rows, cols);
+	G_percent(i + 1, rows / 2 + 1, 2);
+    }
 
-    /* get and compare the original window data */
-    Rast_get_cellhd(Cellmap_real, "", &realhead);
-    Rast_get_cellhd(Cellmap_imag, "", &imaghead);
+    /* perform inverse FFT */
+    G_message(_("Starting Inverse FFT..."));
+    G_math_fft2_c2r(data, cols, rows);
 
-    if (realhead.proj   != imaghead.proj   ||
-	realhead.zone   != imaghead.zone   ||
-	realhead.north  != imaghead.north  ||
-	realhead.south  != imaghead.south  ||
-	realhead.east   != imaghead.east   ||
-	realhead.west   != imaghead.west   ||
-	realhead.ew_res != imaghead.ew_res ||
-	realhead.ns_res != imaghead.ns_res)
-	G_fatal_error(_("The real and imaginary original windows did not match"));
+    /* Write out result to a new cell map */
+    G_message(_("Writing raster map <%s>..."), name);
+    for (i = 0; i < rows; i++) {
+	Rast_put_d_row(outputfd, (DCELL *) (data + (size_t)i * hcols));
+	G_percent(i + 1, rows, 2);
+    }
 
-    Rast_set_window(&realhead);	/* set the window to the whole cell map */
+    for (i = 0; i < 2; i++) {
+	G_free(cell_real[i]);
+	G_free(cell_imag[i]);
+    }
+    if (maskbuf)
+	G_free(maskbuf);
+    G_free(data);
+}
 
-    /* open input raster map */
-    realfd = Rast_open_old(Cellmap_real, "");
-    imagfd = Rast_open_old(Cellmap_imag, "");
+/*
+ * Transform the spectrum out of core: the Hermitian part is stored in a
+ * segment file, the columns are transformed in blocks of SEG_SIZE
+ * columns, then the rows are transformed and written.
+ */
+static void ifft_segment(int realfd, int imagfd, int maskfd, int outputfd,
+			 const char *name, int rows, int cols, int memory)
+{
+    SEGMENT seg;
+    double (*buf)[2], (*row1)[2], (*row2)[2];
+    DCELL *cell_real[2], *cell_imag[2];
+    CELL *maskbuf = NULL;
+    int hcols = cols / 2 + 1;
+    int nseg, nseg_total, brows, i, j, m, r, c, c0, bcols;
+    double seg_mb, norm;
+
+    /* keep at least one column of tiles in memory */
+    seg_mb = (double)SEG_SIZE * SEG_SIZE * 2 * sizeof(double) / 1048576.;
+    nseg_total = ((rows + SEG_SIZE - 1) / SEG_SIZE) *
+	((hcols + SEG_SIZE - 1) / SEG_SIZE);
+    nseg = (memory / 2) / seg_mb;
+    if (nseg < (rows + SEG_SIZE - 1) / SEG_SIZE + 1)
+	nseg = (rows + SEG_SIZE - 1) / SEG_SIZE + 1;
+    if (nseg > nseg_total)
+	nseg = nseg_total;
+
+    G_verbose_message(_("Will need at least %.2f MB of disk space"),
+		      (double)rows * hcols * 2 * sizeof(double) / 1048576.);
+    G_verbose_message(_("%d of %d segments are kept in memory"), nseg,
+		      nseg_total);
+
+    if (Segment_open(&seg, G_tempfile(), rows, hcols, SEG_SIZE, SEG_SIZE,
+		     2 * sizeof(double), nseg) != 1)
+	G_fatal_error(_("Unable to create temporary segment file"));
+
+    /* the buffer holds a block of rows or SEG_SIZE columns */
+    brows = SEG_SIZE;
+    if (brows > rows)
+	brows = rows;
+    buf = G_malloc((size_t)SEG_SIZE * (rows > hcols ? rows : hcols) *
+		   2 * sizeof(double));
+    row1 = G_malloc((size_t)hcols * 2 * sizeof(double));
+    row2 = G_malloc((size_t)hcols * 2 * sizeof(double));
+
+    for (i = 0; i < 2; i++) {
+	cell_real[i] = Rast_allocate_d_buf();
+	cell_imag[i] = Rast_allocate_d_buf();
+    }
+    if (maskfd >= 0)
+	maskbuf = Rast_allocate_c_buf();
+
+    G_message(_("Reading raster maps..."));
+    for (i = 0; i < rows; i++) {
+	m = (rows - i) % rows;
+	if (m < i)
+	    continue;
+	hermitian_rows(realfd, imagfd, maskfd, i, row1, m != i ? row2 : NULL,
+		       cell_real, cell_imag, maskbuf, rows, cols);
+	Segment_put_row(&seg, row1, i);
+	if (m != i)
+	    Segment_put_row(&seg, row2, m);
+	G_percent(i + 1, rows / 2 + 1, 2);
+    }
+    Segment_flush(&seg);
+
+    /* transform the columns */
+    G_message(_("Starting Inverse FFT..."));
+    for (c0 = 0; c0 < hcols; c0 += SEG_SIZE) {
+	bcols = hcols - c0 < SEG_SIZE ? hcols - c0 : SEG_SIZE;
+
+	for (r = 0; r < rows; r++)
+	    for (c = 0; c < bcols; c++)
+		Segment_get(&seg, buf[(size_t)c * rows + r], r, c0 + c);
+	G_math_fft_rows(1, buf, rows, bcols);
+	for (r = 0; r < rows; r++)
+	    for (c = 0; c < bcols; c++)
+		Segment_put(&seg, buf[(size_t)c * rows + r], r, c0 + c);
+
+	G_percent(c0 + bcols, hcols, 2);
+    }
+    Segment_flush(&seg);
+
+    /* transform the rows and write out the result */
+    G_message(_("Writing raster map <%s>..."), name);
+    norm = 1.0 / sqrt((double)rows * cols);
+    for (r = 0; r < rows; r += brows) {
+	int n = rows - r < brows ? rows - r : brows;
+
+	for (i = 0; i < n; i++)
+	    Segment_get_row(&seg, buf + (size_t)i * hcols, r + i);
+	G_math_fft_rows_c2r(buf, cols, n);
+	for (i = 0; i < n; i++) {
+	    DCELL *out = (DCELL *) (buf + (size_t)i * hcols);
+
+	    for (j = 0; j < cols; j++)
+		out[j] *= norm;
+	    Rast_put_d_row(outputfd, out);
+	}
+
+	G_percent(r + n, rows, 2);
+    }
+
+    Segment_close(&seg);
+    for (i = 0; i < 2; i++) {
+	G_free(cell_real[i]);
+	G_free(cell_imag[i]);
+    }
+    if (maskbuf)
+	G_free(maskbuf);
+    G_free(row1);
+    G_free(row2);
+    G_free(buf);
+}
+
+#else
+
+/* transform the whole spectrum in memory with the complex transform */
+static void ifft_memory(int realfd, int imagfd, int maskfd, int outputfd,
+			const char *name, int rows, int cols)
+{
+    DCELL *cell_real, *cell_imag;
+    CELL *maskbuf;
+
+    int i, j;			/* Loop control variables */
+    long totsize;		/* Total number of data points */
+    double (*data)[2];		/* Data structure containing real & complex values of FFT */
 
-    /* get the rows and columns in the current window */
-    rows = Rast_window_rows();
-    cols = Rast_window_cols();
     totsize = rows * cols;
 
     /* Allocate appropriate memory for the structure containing
@@ -149,13 +333,8 @@ int main(int argc, char *argv[])
 	G_percent(i+1, rows, 2);
     }
 
-    /* close input cell maps */
-    Rast_close(realfd);
-    Rast_close(imagfd);
-
     /* Read in cell map values */
     G_message(_("Masking raster maps..."));
-    maskfd = Rast_maskfd();
     if (maskfd >= 0) {
 	maskbuf = Rast_allocate_c_buf();
 
@@ -170,7 +349,6 @@ int main(int argc, char *argv[])
 	    G_percent(i+1, rows, 2);
 	}
 
-	Rast_close(maskfd);
 	G_free(maskbuf);
     }
 
@@ -200,12 +378,8 @@ int main(int argc, char *argv[])
     G_message(_("Starting Inverse FFT..."));
     fft2(1, data, totsize, cols, rows);
 
-    /* open the output cell map */
-    outputfd = Rast_open_fp_new(Cellmap_orig);
-
     /* Write out result to a new cell map */
-    G_message(_("Writing raster map <%s>..."),
-	      Cellmap_orig);
+    G_message(_("Writing raster map <%s>..."), name);
     for (i = 0; i < rows; i++) {
 	for (j = 0; j < cols; j++)
 	    cell_real[j] = data[C(i, j)][0];
@@ -214,15 +388,126 @@ int main(int argc, char *argv[])
 	G_percent(i+1, rows, 2);
     }
 
-    Rast_close(outputfd);
-
     G_free(cell_real);
     G_free(cell_imag);
 
-    fft_colors(Cellmap_orig);
-
     /* Release memory resources */
     G_free(data);
+}
+
+#endif /* HAVE_FFTW3_H */
+
+int main(int argc, char *argv[])
+{
+    /* Global variable & function declarations */
+    struct GModule *module;
+    struct {
+	struct Option *orig, *real, *imag, *memory, *threads;
+    } opt;
+    const char *Cellmap_real, *Cellmap_imag;
+    const char *Cellmap_orig;
+    int realfd, imagfd,  outputfd, maskfd;	/* the input and output file descriptors */
+    struct Cell_head realhead, imaghead;
+    int rows, cols;		/* number of rows & columns */
+    int memory, threads;
+
+    G_gisinit(argv[0]);
+
+    /* Set description */
+    module = G_define_module();
+    G_add_keyword(_("imagery"));
+    G_add_keyword(_("transformation"));
+    G_add_keyword(_("Fast Fourier Transform"));
+    module->description =
+	_("Inverse Fast Fourier Transform (IFFT) for image processing.");
+
+    /* define options */
+    opt.real = G_define_standard_option(G_OPT_R_INPUT);
+    opt.real->key = "real";
+    opt.real->description = _("Name of input raster map (image fft, real part)");
+
+    opt.imag = G_define_standard_option(G_OPT_R_INPUT);
+    opt.imag->key = "imaginary";
+    opt.imag->description = _("Name of input raster map (image fft, imaginary part");
+
+    opt.orig = G_define_standard_option(G_OPT_R_OUTPUT);
+    opt.orig->description = _("Name for output raster map");
+
+    opt.memory = G_define_option();
+    opt.memory->key = "memory";
+    opt.memory->type = TYPE_INTEGER;
+    opt.memory->required = NO;
+    opt.memory->answer = "300";
+    opt.memory->label = _("Maximum memory to be used in MB");
+    opt.memory->description =
+	_("Larger raster maps are transformed out of core");
+
+    opt.threads = G_define_standard_option(G_OPT_M_NPROCS);
+
+    /*call parser */
+    if (G_parser(argc, argv))
+	exit(EXIT_FAILURE);
+
+    Cellmap_real = opt.real->answer;
+    Cellmap_imag = opt.imag->answer;
+    Cellmap_orig = opt.orig->answer;
+
+    memory = atoi(opt.memory->answer);
+    if (memory < 1)
+	G_fatal_error(_("Illegal value for '%s' (%s)"), opt.memory->key,
+		      opt.memory->answer);
+
+    threads = G_set_nprocs(opt.threads);
+    if (G_math_fft_threads(threads) < threads)
+	G_warning(_("GRASS GIS is not compiled with FFTW threads support, "
+		    "parallel computation is disabled."));
+
+    /* get and compare the original window data */
+    Rast_get_cellhd(Cellmap_real, "", &realhead);
+    Rast_get_cellhd(Cellmap_imag, "", &imaghead);
+
+    if (realhead.proj   != imaghead.proj   ||
+	realhead.zone   != imaghead.zone   ||
+	realhead.north  != imaghead.north  ||
+	realhead.south  != imaghead.south  ||
+	realhead.east   != imaghead.east   ||
+	realhead.west   != imaghead.west   ||
+	realhead.ew_res != imaghead.ew_res ||
+	realhead.ns_res != imaghead.ns_res)
+	G_fatal_error(_("The real and imaginary original windows did not match"));
+
+    Rast_set_window(&realhead);	/* set the window to the whole cell map */
+
+    /* open input raster map */
+    realfd = Rast_open_old(Cellmap_real, "");
+    imagfd = Rast_open_old(Cellmap_imag, "");
+    maskfd = Rast_maskfd();
+
+    /* get the rows and columns in the current window */
+    rows = Rast_window_rows();
+    cols = Rast_window_cols();
+
+    /* open the output cell map */
+    outputfd = Rast_open_fp_new(Cellmap_orig);
+
+#ifdef HAVE_FFTW3_H
+    if ((double)rows * (cols / 2 + 1) * 2 * sizeof(double) / 1048576. >
+	memory)
+	ifft_segment(realfd, imagfd, maskfd, outputfd, Cellmap_orig, rows,
+		     cols, memory);
+    else
+#endif
+	ifft_memory(realfd, imagfd, maskfd, outputfd, Cellmap_orig, rows,
+		    cols);
+
+    /* close the cell maps */
+    Rast_close(realfd);
+    Rast_close(imagfd);
+    if (maskfd >= 0)
+	Rast_close(maskfd);
+    Rast_close(outputfd);
+
+    fft_colors(Cellmap_orig);
 
     G_done_msg(" ");
 
@@ -1,5 +1,6 @@
 #include <grass/gis.h>
 #include <grass/raster.h>
+#include <grass/gmath.h>
 #include "global.h"
 
 
@@ -8,87 +9,177 @@ static double chisq[] =
     3.357, 2.195, 1.649, 1.064, 0.711, 0.429, 0.297, 0.0
 };
 
+/* work arrays of a thread, one row per pixel of its part of a block */
+struct scratch
+{
+    double **X, **Y;
+    double *max;
+    int *cls;
+    int nalloc;
+};
 
-int classify(CELL * class, CELL * reject, int ncols)
+struct block
 {
-    int i, j;
+    CELL *class, *reject;
+    int chunk;			/* pixels per thread */
+    struct scratch *scratch;	/* per thread */
+};
+
+/* symmetric inverted covariance matrix of each signature */
+static double ***W;
+static struct scratch *scratch;
+static int nthreads;
+
+
+static void alloc_scratch(struct scratch *s, int npix, int nfiles)
+{
+    if (npix <= s->nalloc)
+	return;
+
+    if (s->nalloc) {
+	G_free_matrix(s->X);
+	G_free_matrix(s->Y);
+	G_free_vector(s->max);
+	G_free(s->cls);
+    }
+    s->X = G_alloc_matrix(npix, nfiles);
+    s->Y = G_alloc_matrix(npix, nfiles);
+    s->max = G_alloc_vector(npix);
+    s->cls = (int *)G_malloc(npix * sizeof(int));
+    s->nalloc = npix;
+}
+
+/* the threads share the input rows in cell[] and the inverted
+ * covariance matrices, which are only read, and write the classes of
+ * the pixels first to last - 1 of the block; the differences to the
+ * class means, their products with the matrices and the best class so
+ * far of the pixels are in the scratch of the thread */
+static void classify_pixels(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct scratch *s = &blk->scratch[first / blk->chunk];
     int nfiles = Ref.nfiles;
-    int c;
-    int cc = 0;
-    int band;
-    int col;
-    int valid_data;
-    double max, tot, sum;
+    int npix = last - first;
+    double **X, **Y, *max;
+    int *cls;
+    int i, c, band, col;
     double rej;
-    struct One_Sig *s;
 
-    for (col = 0; col < ncols; col++) {
-	valid_data = 0;
+    alloc_scratch(s, npix, nfiles);
+    X = s->X;
+    Y = s->Y;
+    max = s->max;
+    cls = s->cls;
+
+    for (col = 0; col < npix; col++) {
+	int valid_data = 0;
+
 	for (band = 0; band < nfiles; band++)
-	    if ((valid_data = !Rast_is_d_null_value(&cell[band][col])))
+	    if ((valid_data = !Rast_is_d_null_value(&cell[band][first + col])))
 		break;
 
-	if (!valid_data) {	/* all nulls are classified as nulls */
-	    Rast_set_c_null_value(class++, 1);
-	    if (reject)
-		Rast_set_c_null_value(reject++, 1);
+	/* all nulls are classified as nulls */
+	cls[col] = valid_data ? 0 : -1;
+	max[col] = -1.0e38;
+    }
+
+    for (c = 0; c < S.nsigs; c++) {
+	const struct One_Sig *sig = &S.sig[c];
+
+	/* invalid signatures are never the most probable class */
+	if (B[c] <= -1.0e38)
 	    continue;
-	}
 
-	max = -1.0e38;
-	for (c = 0; c < S.nsigs; c++) {
-	    /* The following test is designed to speed up the search for the
-	     * most probable class.  In fact if the B[] array is sorted, the
-	     * search  could  be terminated sooner.
-	     */
-	    if (B[c] <= max)
-		continue;
+	/*
+	   The maximum of B[c] - 0.5 * p W p over the classes is searched,
+	   with p the difference of the pixel to the class mean and W the
+	   inverted covariance matrix.  The quadratic forms of a class are
+	   computed for the pixels of the thread with one matrix product.
 
-	    /*
-	       The test only works if  the  covariance  matrix  is  non-negative
-	       definite (sometimes  called positve semi-definite), and this is a
-	       requirement of the maximum-likelihood estimator.  This assumption
-	       is  theorically  true  for random samples of normally distributed
-	       data, but for imagery data this is not generally the  case.   The
-	       matrix  inversion/determinanat  routine  should  enforce positive
-	       semi-definiteness. I could not tell if  it  did  this.   I  don't
-	       think  it does.  A necessary condition is that the determinant be
-	       positive but this is not sufficient. All  principal  minors  must
-	       also have non-negative determinants.
-	     */
+	   This only works if  the  covariance  matrix  is  non-negative
+	   definite (sometimes  called positve semi-definite), and this is a
+	   requirement of the maximum-likelihood estimator.  This assumption
+	   is  theorically  true  for random samples of normally distributed
+	   data, but for imagery data this is not generally the  case.   The
+	   matrix  inversion/determinanat  routine  should  enforce positive
+	   semi-definiteness. I could not tell if  it  did  this.   I  don't
+	   think  it does.  A necessary condition is that the determinant be
+	   positive but this is not sufficient. All  principal  minors  must
+	   also have non-negative determinants.
+	 */
 
+	for (col = 0; col < npix; col++)
+	    for (band = 0; band < nfiles; band++)
+		X[col][band] = cell[band][first + col] - sig->mean[band];
 
-	    s = &S.sig[c];
+	G_math_d_AB(X, W[c], Y, npix, nfiles, nfiles);
 
-	    tot = 0.0;
-	    for (band = 0; band < nfiles; band++) {
-		double p;
+	for (col = 0; col < npix; col++) {
+	    double tot = 0.0;
 
-		p = P[band] = cell[band][col] - s->mean[band];
-		tot += p * p * s->var[band][band];
-	    }
+	    if (cls[col] < 0 || B[c] <= max[col])
+		continue;
+
+	    for (band = 0; band < nfiles; band++)
+		tot += X[col][band] * Y[col][band];
 	    tot = B[c] - 0.5 * tot;
 
-	    sum = 0.0;
-	    for (i = 0; i < nfiles - 1; i++)
-		for (j = i + 1; j < nfiles; j++)
-		    sum += P[j] * P[i] * s->var[j][i];
-	    tot -= sum;
-	    if (tot > max) {
-		cc = c;
-		max = tot;
+	    if (tot > max[col]) {
+		cls[col] = c;
+		max[col] = tot;
 	    }
 	}
-	*class++ = cc + 1;
+    }
+
+    for (col = 0; col < npix; col++) {
+	CELL *class = &blk->class[first + col];
+	CELL *reject = blk->reject ? &blk->reject[first + col] : NULL;
+
+	if (cls[col] < 0) {
+	    Rast_set_c_null_value(class, 1);
+	    if (reject)
+		Rast_set_c_null_value(reject, 1);
+	    continue;
+	}
+
+	*class = cls[col] + 1;
 
 	if (reject) {
-	    rej = 2 * (B[cc] - max);
+	    rej = 2 * (B[cls[col]] - max[col]);
 	    for (i = 0; i < 16; i++)
 		if (rej >= chisq[i])
 		    break;
-	    *reject++ = i + 1;
+	    *reject = i + 1;
 	}
     }
+}
+
+/* classify npix pixels of the input rows in cell[] */
+int classify(CELL * class, CELL * reject, int npix)
+{
+    struct block blk;
+    int nfiles = Ref.nfiles;
+    int c, i, j;
+
+    if (!W) {
+	/* only the lower half of the inverted matrix is used */
+	W = (double ***)G_malloc(S.nsigs * sizeof(double **));
+	for (c = 0; c < S.nsigs; c++) {
+	    W[c] = G_alloc_matrix(nfiles, nfiles);
+	    for (i = 0; i < nfiles; i++)
+		for (j = 0; j <= i; j++)
+		    W[c][i][j] = W[c][j][i] = S.sig[c].var[i][j];
+	}
+
+	nthreads = G_num_workers() + 1;
+	scratch = (struct scratch *)G_calloc(nthreads, sizeof(struct scratch));
+    }
+
+    blk.class = class;
+    blk.reject = reject;
+    blk.chunk = (npix + nthreads - 1) / nthreads;
+    blk.scratch = scratch;
+    G_parallel_for(0, npix, blk.chunk, classify_pixels, &blk);
 
     return 0;
 }
@@ -12,4 +12,7 @@ extern int class_fd, reject_fd;
 extern char *reject_name;
 extern char class_name[GNAME_MAX];
 extern double *B;
-extern double *P;
+extern int block_rows;
+
+/* number of pixels classified at once */
+#define BLOCK_SIZE 16384
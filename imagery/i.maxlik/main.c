@@ -38,7 +38,7 @@ int class_fd, reject_fd;
 char *reject_name;
 char class_name[GNAME_MAX];
 double *B;
-double *P;
+int block_rows;
 CELL cat;
 
 int main(int argc, char *argv[])
@@ -47,13 +47,13 @@ int main(int argc, char *argv[])
     struct Colors colr;
     struct Ref group_ref;
     int nrows, ncols;
-    int row;
+    int row, r, nrows_block;
     int band;
     int i;
     struct GModule *module;
     struct
     {
-	struct Option *group, *subgroup, *sigfile, *class, *reject;
+	struct Option *group, *subgroup, *sigfile, *class, *reject, *threads;
     } parm;
     char xmapset[GMAPSET_MAX];
 
@@ -92,7 +92,9 @@ int main(int argc, char *argv[])
     parm.reject->required = NO;
     parm.reject->description =
 	_("Name for output raster map holding reject threshold results");
-    
+
+    parm.threads = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
@@ -101,6 +103,8 @@ int main(int argc, char *argv[])
     group = parm.group->answer;
     subgroup = parm.subgroup->answer;
     sigfile = parm.sigfile->answer;
+
+    G_set_nprocs(parm.threads);
     
     if (G_unqualified_name(parm.class->answer, G_mapset(), class_name, xmapset) < 0)
         G_fatal_error(_("<%s> does not match the current mapset"), xmapset);
@@ -113,16 +117,23 @@ int main(int argc, char *argv[])
     nrows = Rast_window_rows();
     ncols = Rast_window_cols();
 
-    for (row = 0; row < nrows; row++) {
+    /* the pixels of block_rows rows are classified at once */
+    for (row = 0; row < nrows; row += block_rows) {
 	G_percent(row, nrows, 2);
 
+	nrows_block = nrows - row < block_rows ? nrows - row : block_rows;
 	for (band = 0; band < Ref.nfiles; band++)
-	    Rast_get_d_row(cellfd[band], cell[band], row);
-	
-	classify(class_cell, reject_cell, ncols);
-	Rast_put_row(class_fd, class_cell, CELL_TYPE);
-	if (reject_fd > 0)
-	    Rast_put_row(reject_fd, reject_cell, CELL_TYPE);
+	    for (r = 0; r < nrows_block; r++)
+		Rast_get_d_row(cellfd[band], cell[band] + (size_t)r * ncols,
+			       row + r);
+
+	classify(class_cell, reject_cell, nrows_block * ncols);
+	for (r = 0; r < nrows_block; r++) {
+	    Rast_put_row(class_fd, class_cell + (size_t)r * ncols, CELL_TYPE);
+	    if (reject_fd > 0)
+		Rast_put_row(reject_fd, reject_cell + (size_t)r * ncols,
+			     CELL_TYPE);
+	}
     }
     G_percent(nrows, nrows, 2);
 
@@ -10,7 +10,7 @@ int open_files(void)
 {
     char *name, *mapset;
     FILE *fd;
-    int n;
+    int n, ncols;
 
     I_init_group_ref(&Ref);
     if (!I_find_group(group))
@@ -31,11 +31,19 @@ int open_files(void)
 			    "The subgroup must have at least 2 raster maps."), subgroup, group);
     }
 
+    /* buffers for a block of rows */
+    ncols = Rast_window_cols();
+    block_rows = BLOCK_SIZE / ncols;
+    if (block_rows < 1)
+	block_rows = 1;
+    if (block_rows > Rast_window_rows())
+	block_rows = Rast_window_rows();
+
     cell = (DCELL **) G_malloc(Ref.nfiles * sizeof(DCELL *));
     cellfd = (int *)G_malloc(Ref.nfiles * sizeof(int));
-    P = (double *)G_malloc(Ref.nfiles * sizeof(double));
     for (n = 0; n < Ref.nfiles; n++) {
-	cell[n] = Rast_allocate_d_buf();
+	cell[n] = (DCELL *) G_malloc((size_t)block_rows * ncols *
+				     sizeof(DCELL));
 	name = Ref.file[n].name;
 	mapset = Ref.file[n].mapset;
 	cellfd[n] = Rast_open_old(name, mapset);
@@ -61,12 +69,14 @@ int open_files(void)
     invert_signatures();
 
     class_fd = Rast_open_c_new(class_name);
-    class_cell = Rast_allocate_c_buf();
+    class_cell = (CELL *) G_malloc((size_t)block_rows * ncols *
+				   sizeof(CELL));
 
     reject_cell = NULL;
     if (reject_name) {
 	reject_fd = Rast_open_c_new(reject_name);
-	reject_cell = Rast_allocate_c_buf();
+	reject_cell = (CELL *) G_malloc((size_t)block_rows * ncols *
+					sizeof(CELL));
     }
 
     return 0;
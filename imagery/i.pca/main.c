@@ -32,10 +32,15 @@
 
 #undef PCA_DEBUG
 
+/* number of pixels read and transformed at once */
+#define BLOCK_SIZE 16384
+
 
 /* function prototypes */
 static CELL round_c(double);
 static int set_output_scale(struct Option *, int *, int *, int *);
+static int get_block_rows(int);
+static int read_block(int *, DCELL *, double **, char *, int, int, int, int);
 static int calc_mu_cov(int *, double **, double *, double *, int);
 static int write_pca(double **, double *, double *, int *, char *, int,
                      int, int, int, int);
@@ -62,7 +67,7 @@ int main(int argc, char *argv[])
     const char *mapset;
 
     struct GModule *module;
-    struct Option *opt_in, *opt_out, *opt_scale, *opt_filt;
+    struct Option *opt_in, *opt_out, *opt_scale, *opt_filt, *opt_threads;
     struct Flag *flag_norm, *flag_filt;
 
     /* initialize GIS engine */
@@ -108,6 +113,8 @@ int main(int argc, char *argv[])
 	_("Cumulative percent importance for filtering");
     opt_filt->guisection = _("Filter");
 
+    opt_threads = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag_norm = G_define_flag();
     flag_norm->key = 'n';
     flag_norm->label = (_("Normalize (center and scale) input maps"));
@@ -122,6 +129,7 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(opt_threads);
 
     /* determine number of bands passed in */
     for (bands = 0; opt_in->answers[bands] != NULL; bands++) ;
@@ -282,6 +290,21 @@ static CELL round_c(double x)
 }
 
 
+/* number of rows of a block of about BLOCK_SIZE pixels */
+static int get_block_rows(int cols)
+{
+    int block_rows = BLOCK_SIZE / cols;
+    int rows = Rast_window_rows();
+
+    if (block_rows < 1)
+	block_rows = 1;
+    if (block_rows > rows)
+	block_rows = rows;
+
+    return block_rows;
+}
+
+
 static int
 set_output_scale(struct Option *scale_opt, int *scale, int *scale_min,
 		 int *scale_max)
@@ -313,100 +336,281 @@ set_output_scale(struct Option *scale_opt, int *scale, int *scale_min,
 }
 
 
-static int calc_mu_cov(int *fds, double **covar, double *mu, 
-                           double *stddev, int bands)
+static int
+read_block(int *fds, DCELL *rowbuf, double **X, char *valid, int row,
+	   int nrows, int cols, int bands)
 {
-    int i, j;
-    int row, col;
-    int rows = Rast_window_rows();
-    int cols = Rast_window_cols();
-    off_t count = 0;
-    DCELL **rowbuf = (DCELL **) G_malloc(bands * sizeof(DCELL *));
-    double **sum2 = (double **)G_calloc(bands, sizeof(double *));
-    double *sumsq, *sd, *sum;
-
-    if (stddev) {
-	sumsq = (double *)G_calloc(bands, sizeof(double));
-	sd = (double *)G_calloc(bands, sizeof(double));
+    int i, r, col, nvalid;
+    size_t p;
+
+    for (p = 0; p < (size_t)nrows * cols; p++)
+	valid[p] = 1;
+
+    for (i = 0; i < bands; i++) {
+	for (r = 0; r < nrows; r++) {
+	    Rast_get_d_row(fds[i], rowbuf, row + r);
+	    p = (size_t)r * cols;
+	    for (col = 0; col < cols; col++, p++) {
+		/* ignore cells where any of the maps has null value */
+		if (Rast_is_d_null_value(&rowbuf[col])) {
+		    valid[p] = 0;
+		    X[p][i] = 0.0;
+		}
+		else
+		    X[p][i] = rowbuf[col];
+	    }
+	}
     }
-    else {
-	sumsq = NULL;
-	sd = NULL;
+
+    nvalid = 0;
+    for (p = 0; p < (size_t)nrows * cols; p++)
+	nvalid += valid[p];
+
+    return nvalid;
+}
+
+
+/* count, mean and lower half of the co-moment matrix
+ * sum((x - mean) * (y - mean)) of the valid pixels p0 to p1 - 1 */
+static void
+block_moments(double **X, const char *valid, int p0, int p1, int bands,
+	      double *n, double *mean, double *C)
+{
+    int i, j, p;
+    double d;
+
+    *n = 0;
+    for (i = 0; i < bands; i++)
+	mean[i] = 0.0;
+    for (i = 0; i < bands * bands; i++)
+	C[i] = 0.0;
+
+    for (p = p0; p < p1; p++) {
+	if (!valid[p])
+	    continue;
+	*n += 1;
+	for (i = 0; i < bands; i++)
+	    mean[i] += X[p][i];
     }
+    if (*n == 0)
+	return;
+    for (i = 0; i < bands; i++)
+	mean[i] /= *n;
+
+    for (p = p0; p < p1; p++) {
+	if (!valid[p])
+	    continue;
+	for (i = 0; i < bands; i++) {
+	    d = X[p][i] - mean[i];
+	    for (j = 0; j <= i; j++)
+		C[i * bands + j] += d * (X[p][j] - mean[j]);
+	}
+    }
+}
+
+
+/* merge the moments of a set b into the moments of a set a
+ * (Chan et al., 1979) */
+static void
+merge_moments(double *na, double *meana, double *Ca, double nb,
+	      const double *meanb, const double *Cb, double *delta,
+	      int bands)
+{
+    int i, j;
+    double n, f;
 
+    if (nb == 0)
+	return;
+
+    n = *na + nb;
+    f = *na * nb / n;
+    for (i = 0; i < bands; i++)
+	delta[i] = meanb[i] - meana[i];
     for (i = 0; i < bands; i++) {
-	rowbuf[i] = Rast_allocate_d_buf();
-	sum2[i] = (double *)G_calloc(bands, sizeof(double));
+	for (j = 0; j <= i; j++)
+	    Ca[i * bands + j] += Cb[i * bands + j] + f * delta[i] * delta[j];
+	meana[i] += delta[i] * nb / n;
     }
-    sum = mu;
+    *na = n;
+}
 
-    G_message(_("Computing covariance matrix..."));
 
-    for (row = 0; row < rows; row++) {
-	G_percent(row, rows, 2);
-	for (i = 0; i < bands; i++)
-	    Rast_get_d_row(fds[i], rowbuf[i], row);
+/* the pixels of a block and the moments of each part of them */
+struct moments
+{
+    double **X;
+    const char *valid;
+    int npix, bands;
+    int nparts;			/* one part per thread */
+    double *tn, **tmean, **tC;
+};
+
+/* the threads only read the pixels of the block, the moments of a part
+ * are written to its own entries of tn, tmean and tC */
+static void part_moments(int first, int last, void *closure)
+{
+    const struct moments *m = closure;
+    int t;
 
-	for (col = 0; col < cols; col++) {
-	    /* ignore cells where any of the maps has null value */
-	    for (i = 0; i < bands; i++)
-		if (Rast_is_d_null_value(&rowbuf[i][col]))
-		    break;
-	    if (i != bands)
-		continue;
-	    count++;
-	    for (i = 0; i < bands; i++) {
+    for (t = first; t < last; t++)
+	block_moments(m->X, m->valid, (int)((double)m->npix * t / m->nparts),
+		      (int)((double)m->npix * (t + 1) / m->nparts), m->bands,
+		      &m->tn[t], m->tmean[t], m->tC[t]);
+}
 
-		sum[i] += rowbuf[i][col];
-		if (stddev)
-		    sumsq[i] += rowbuf[i][col] * rowbuf[i][col];
 
-		for (j = 0; j <= i; j++)
-		    sum2[i][j] += rowbuf[i][col] * rowbuf[j][col];
-	    }
+static int calc_mu_cov(int *fds, double **covar, double *mu, 
+                           double *stddev, int bands)
+{
+    int i, j, t, row, nrows_block;
+    int rows = Rast_window_rows();
+    int cols = Rast_window_cols();
+    int block_rows = get_block_rows(cols);
+    int nthreads = G_num_workers() + 1;
+    double count = 0;
+    double **X, *C, *delta, *tn, **tmean, **tC;
+    DCELL *rowbuf = Rast_allocate_d_buf();
+    char *valid;
+    struct moments m;
+
+    X = G_alloc_matrix(block_rows * cols, bands);
+    valid = (char *)G_malloc((size_t)block_rows * cols);
+    C = G_alloc_vector(bands * bands);
+    delta = G_alloc_vector(bands);
+    tn = G_alloc_vector(nthreads);
+    tmean = G_alloc_matrix(nthreads, bands);
+    tC = G_alloc_matrix(nthreads, bands * bands);
+
+    m.X = X;
+    m.valid = valid;
+    m.bands = bands;
+    m.nparts = nthreads;
+    m.tn = tn;
+    m.tmean = tmean;
+    m.tC = tC;
+
+    for (i = 0; i < bands; i++)
+	mu[i] = 0.0;
+
+    G_message(_("Computing covariance matrix..."));
+
+    for (row = 0; row < rows; row += block_rows) {
+	G_percent(row, rows, 2);
+
+	nrows_block = rows - row < block_rows ? rows - row : block_rows;
+	m.npix = nrows_block * cols;
+	read_block(fds, rowbuf, X, valid, row, nrows_block, cols, bands);
+
+	/* the moments of the parts are merged in the order of the parts,
+	 * first within the block, then into the total, so that the result
+	 * does not depend on the scheduling of the threads */
+	G_parallel_for(0, nthreads, 1, part_moments, &m);
+
+	for (t = 1; t < nthreads; t++)
+	    merge_moments(&tn[0], tmean[0], tC[0], tn[t], tmean[t], tC[t],
+			  delta, bands);
+	if (count == 0) {
+	    count = tn[0];
+	    G_math_d_copy(tmean[0], mu, bands);
+	    G_math_d_copy(tC[0], C, bands * bands);
 	}
+	else
+	    merge_moments(&count, mu, C, tn[0], tmean[0], tC[0], delta,
+			  bands);
+
+	for (t = 0; t < nthreads; t++)
+	    tn[t] = 0;
     }
     G_percent(1, 1, 1);
-    
-    if (count < 2)
+
+    G_free_matrix(X);
+    G_free(valid);
+    G_free(rowbuf);
+    G_free_vector(delta);
+    G_free_vector(tn);
+    G_free_matrix(tmean);
+    G_free_matrix(tC);
+
+    if (count < 2) {
+	G_free_vector(C);
 	return 0;
+    }
 
     for (i = 0; i < bands; i++) {
-	if (stddev) {
-	    sd[i] = sqrt(count * sumsq[i] - sum[i] * sum[i]);
-	    stddev[i] = sqrt((sumsq[i] - sum[i] * sum[i] / count) /
-	                     (count - 1));
-	}
+	if (stddev)
+	    stddev[i] = sqrt(C[i * bands + i] / (count - 1));
 	for (j = 0; j <= i; j++) {
 	    if (stddev)
-		covar[i][j] = (count * sum2[i][j] - sum[i] * sum[j]) /
-		              (sd[i] * sd[j]);
+		covar[i][j] = C[i * bands + j] /
+		              sqrt(C[i * bands + i] * C[j * bands + j]);
 	    else
-		covar[i][j] = (sum2[i][j] - sum[i] * sum[j] / count) /
-		              (count - 1);
+		covar[i][j] = C[i * bands + j] / (count - 1);
 	    G_debug(3, "covar[%d][%d] = %f", i, j, covar[i][j]);
 	    if (j != i)
 		covar[j][i] = covar[i][j];
 	}
-
-	G_free(sum2[i]);
-	G_free(rowbuf[i]);
     }
-    for (i = 0; i < bands; i++)
-	mu[i] = sum[i] / count;
 
-    G_free(rowbuf);
-    
-    G_free(sum2);
-    if (sd)
-	G_free(sd);
-    if (sumsq)
-	G_free(sumsq);
+    G_free_vector(C);
 
     return 1;
 }
 
 
+/* the pixels of a block and the transform */
+struct transform
+{
+    double **X, **Y, **PCS;
+    const char *valid;
+    double **E, **ET;
+    const double *mu, *stddev;
+    int bands, fbands;
+};
+
+/* the threads share the eigenvectors and the pixel matrices of the
+ * block, each centers and transforms the rows first to last - 1 of the
+ * matrices, which belong to its pixels only */
+static void transform_pixels(int first, int last, void *closure)
+{
+    const struct transform *tr = closure;
+    double **X = tr->X + first, **Y = tr->Y + first;
+    int bands = tr->bands;
+    int npix = last - first;
+    int i, p;
+
+    /* center (and scale) the input */
+    for (p = 0; p < npix; p++) {
+	if (!tr->valid[first + p])
+	    continue;
+	for (i = 0; i < bands; i++) {
+	    if (tr->stddev)
+		X[p][i] = (X[p][i] - tr->mu[i]) / tr->stddev[i];
+	    else
+		X[p][i] -= tr->mu[i];
+	}
+    }
+
+    if (tr->fbands) {
+	double **PCS = tr->PCS + first;
+
+	/* calculate the PC scores and transform back */
+	G_math_d_AB(X, tr->ET, PCS, npix, bands, tr->fbands);
+	G_math_d_AB(PCS, tr->E, Y, npix, tr->fbands, bands);
+
+	for (p = 0; p < npix; p++) {
+	    for (i = 0; i < bands; i++) {
+		if (tr->stddev)
+		    Y[p][i] = Y[p][i] * tr->stddev[i] + tr->mu[i];
+		else
+		    Y[p][i] += tr->mu[i];
+	    }
+	}
+    }
+    else
+	G_math_d_AB(X, tr->ET, Y, npix, bands, bands);
+}
+
+
 static int
 write_pca(double **eigmat, double *mu, double *stddev,
           int *inp_fd, char *out_basename, int bands, 
@@ -414,7 +618,6 @@ write_pca(double **eigmat, double *mu, double *stddev,
 {
     int i, j;
     void **outbuf = (void **) G_malloc(bands * sizeof(void *));
-    void **outptr = (void **) G_malloc(bands * sizeof(void *));
     double *min = (double *) G_malloc(bands * sizeof(double));
     double *max = (double *) G_malloc(bands * sizeof(double));
     double *old_range = (double *) G_calloc(bands, sizeof(double));
@@ -422,18 +625,56 @@ write_pca(double **eigmat, double *mu, double *stddev,
     int pass;
     int rows = Rast_window_rows();
     int cols = Rast_window_cols();
+    int block_rows = get_block_rows(cols);
     /* why CELL_TYPE when scaling output ? */
     int outmap_type = (scale) ? CELL_TYPE : DCELL_TYPE;
     int outcell_mapsiz = Rast_cell_size(outmap_type);
     int *out_fd = (int *) G_malloc(bands * sizeof(int));
-    DCELL **inbuf = (DCELL **) G_malloc(bands * sizeof(DCELL *));
-    DCELL *pcs = NULL;
+    DCELL *rowbuf = Rast_allocate_d_buf();
+    double **X, **Y, **PCS = NULL, **E, **ET;
+    char *valid, *first = (char *) G_malloc(bands);
+    int nthreads = G_num_workers() + 1;
+    struct transform tr;
 
     /* 2 passes for rescale.  1 pass for no rescale */
     int PASSES = (scale) ? 2 : 1;
 
-    if (fbands)
-	pcs = (DCELL *) G_malloc(fbands * sizeof(DCELL));
+    X = G_alloc_matrix(block_rows * cols, bands);
+    Y = G_alloc_matrix(block_rows * cols, bands);
+    valid = (char *)G_malloc((size_t)block_rows * cols);
+
+    /* the scores of a block are X E^T with a row of X for each pixel,
+     * the filtered bands are (X Ef^T) Ef with the first fbands
+     * eigenvectors Ef */
+    if (fbands) {
+	PCS = G_alloc_matrix(block_rows * cols, fbands);
+	ET = G_alloc_matrix(bands, fbands);
+	E = G_alloc_matrix(fbands, bands);
+	for (i = 0; i < fbands; i++) {
+	    for (j = 0; j < bands; j++) {
+		ET[j][i] = eigmat[i][j];
+		E[i][j] = eigmat[i][j];
+	    }
+	}
+    }
+    else {
+	ET = G_alloc_matrix(bands, bands);
+	E = NULL;
+	for (i = 0; i < bands; i++)
+	    for (j = 0; j < bands; j++)
+		ET[j][i] = eigmat[i][j];
+    }
+
+    tr.X = X;
+    tr.Y = Y;
+    tr.PCS = PCS;
+    tr.valid = valid;
+    tr.E = E;
+    tr.ET = ET;
+    tr.mu = mu;
+    tr.stddev = stddev;
+    tr.bands = bands;
+    tr.fbands = fbands;
 
     /* allocate memory for row buffers */
     for (i = 0; i < bands; i++) {
@@ -443,14 +684,15 @@ write_pca(double **eigmat, double *mu, double *stddev,
 	sprintf(name, "%s.%d", out_basename, i + 1);
 	out_fd[i] = Rast_open_new(name, outmap_type);
 
-	inbuf[i] = Rast_allocate_d_buf();
 	outbuf[i] = Rast_allocate_buf(outmap_type);
 	min[i] = max[i] = old_range[i] = 0;
     }
 
     for (pass = 1; pass <= PASSES; pass++) {
-	int row, col;
-	int first = 1;
+	int row, r, nrows_block, npix, p;
+
+	for (i = 0; i < bands; i++)
+	    first[i] = 1;
 
 	if (scale && (pass == PASSES)) {
 	    G_message(_("Rescaling to range %d,%d..."),
@@ -464,108 +706,69 @@ write_pca(double **eigmat, double *mu, double *stddev,
 	    G_message(_("Calculating principal components..."));
 	}
 
-	for (row = 0; row < rows; row++) {
+	for (row = 0; row < rows; row += block_rows) {
 
 	    G_percent(row, rows, 2);
 
-	    for (i = 0; i < bands; i++) {
-		Rast_get_d_row(inp_fd[i], inbuf[i], row);
-		outptr[i] = outbuf[i];
-	    }
-	    for (col = 0; col < cols; col++) {
-		/* ignore cells where any of the maps has null value */
-		for (i = 0; i < bands; i++)
-		    if (Rast_is_d_null_value(&inbuf[i][col]))
-			break;
-			
-		if (i != bands) {
-		    for (i = 0; i < bands; i++) {
-			Rast_set_null_value(outptr[i], 1, outmap_type);
-			outptr[i] =
-			    G_incr_void_ptr(outptr[i], outcell_mapsiz);
-		    }
-		    continue;
-		}
-		
-		if (fbands) {
-		    /* calculate all PC scores */
-		    for (i = 0; i < fbands; i++) {
-			DCELL dval = 0.;
-
-			for (j = 0; j < bands; j++) {
-			    /* corresp. cell of j-th band */
-			    if (stddev)
-				dval += eigmat[i][j] * 
-					((inbuf[j][col] - mu[j]) / stddev[j]);
-			    else
-				dval += eigmat[i][j] * (inbuf[j][col] - mu[j]);
-			}
-			pcs[i] = dval;
-		    }
-		}
-
-		for (i = 0; i < bands; i++) {
-		    DCELL dval = 0.;
+	    nrows_block = rows - row < block_rows ? rows - row : block_rows;
+	    npix = nrows_block * cols;
+	    read_block(inp_fd, rowbuf, X, valid, row, nrows_block, cols,
+		       bands);
 
-		    if (fbands) {
-			for (j = 0; j < fbands; j++) {
-			    /* corresp. PC score of j-th band */
-			    dval += eigmat[j][i] * pcs[j];
-			}
-			if (stddev)
-			    dval = dval * stddev[i] + mu[i];
-			else
-			    dval += mu[i];
-		    }
-		    else {
-			for (j = 0; j < bands; j++) {
-			    /* corresp. cell of j-th band */
-			    if (stddev)
-				dval += eigmat[i][j] * 
-					((inbuf[j][col] - mu[j]) / stddev[j]);
-			    else
-				dval += eigmat[i][j] * (inbuf[j][col] - mu[j]);
-			}
-		    }
+	    G_parallel_for(0, npix, (npix + nthreads - 1) / nthreads,
+			   transform_pixels, &tr);
 
-		    /* the cell entry is complete */
-		    if (scale && (pass == 1)) {
-			if (first)
-			    min[i] = max[i] = dval;
-			if (dval < min[i])
-			    min[i] = dval;
+	    for (r = 0; r < nrows_block; r++) {
+		void *outptr;
+		int col;
 
-			if (dval > max[i])
-			    max[i] = dval;
-		    }
-		    else if (scale) {
+		for (i = 0; i < bands; i++) {
+		    outptr = outbuf[i];
+		    p = r * cols;
+		    for (col = 0; col < cols; col++, p++) {
+			DCELL dval = Y[p][i];
 
-			if (min[i] == max[i]) {
-			    Rast_set_c_value(outptr[i], 1,
-						 CELL_TYPE);
+			if (!valid[p]) {
+			    Rast_set_null_value(outptr, 1, outmap_type);
 			}
-			else {
-			    /* map data to 0, (new_range-1) and then adding new_min */
-			    CELL tmpcell =
-				round_c((new_range * (dval - min[i]) /
-				         old_range[i]) + scale_min);
-
-			    Rast_set_c_value(outptr[i], tmpcell,
+			/* the cell entry is complete */
+			else if (scale && (pass == 1)) {
+			    if (first[i]) {
+				min[i] = max[i] = dval;
+				first[i] = 0;
+			    }
+			    if (dval < min[i])
+				min[i] = dval;
+
+			    if (dval > max[i])
+				max[i] = dval;
+			}
+			else if (scale) {
+
+			    if (min[i] == max[i]) {
+				Rast_set_c_value(outptr, 1, CELL_TYPE);
+			    }
+			    else {
+				/* map data to 0, (new_range-1) and then adding new_min */
+				CELL tmpcell =
+				    round_c((new_range * (dval - min[i]) /
+					     old_range[i]) + scale_min);
+
+				Rast_set_c_value(outptr, tmpcell,
 						 outmap_type);
+			    }
 			}
-		    }
-		    else {	/* (!scale) */
+			else {	/* (!scale) */
 
-			Rast_set_d_value(outptr[i], dval,
-					     outmap_type);
+			    Rast_set_d_value(outptr, dval, outmap_type);
+			}
+			outptr = G_incr_void_ptr(outptr, outcell_mapsiz);
 		    }
-		    outptr[i] = G_incr_void_ptr(outptr[i], outcell_mapsiz);
 		}
-		first = 0;
-	    }
-	    if (pass == PASSES) {
-		for (i = 0; i < bands; i++)
-		    Rast_put_row(out_fd[i], outbuf[i], outmap_type);
+		if (pass == PASSES) {
+		    for (i = 0; i < bands; i++)
+			Rast_put_row(out_fd[i], outbuf[i], outmap_type);
+		}
 	    }
 	}
 	G_percent(1, 1, 1);
@@ -574,15 +777,22 @@ write_pca(double **eigmat, double *mu, double *stddev,
 	if (pass == PASSES) {
 	    for (i = 0; i < bands; i++) {
 		Rast_close(out_fd[i]);
-		G_free(inbuf[i]);
 		G_free(outbuf[i]);
 	    }
 	}
     }
 
-    G_free(inbuf);
+    G_free_matrix(X);
+    G_free_matrix(Y);
+    G_free_matrix(ET);
+    if (fbands) {
+	G_free_matrix(PCS);
+	G_free_matrix(E);
+    }
+    G_free(valid);
+    G_free(first);
+    G_free(rowbuf);
     G_free(outbuf);
-    G_free(outptr);
     G_free(min);
     G_free(max);
     G_free(old_range);
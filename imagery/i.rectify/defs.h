@@ -19,11 +19,15 @@ typedef DCELL block[BDIM][BDIM];   /* FCELL sufficient ? */
 struct cache
 {
     int fd;
+    char *fname;
     int stride;
-    int nblocks;
+    int ngrid;			/* number of blocks in the map */
+    int nblocks;		/* number of blocks kept in memory */
     block **grid;
     block *blocks;
     int *refs;
+    unsigned int seed;		/* state of block replacement */
+    int owner;			/* removes the temporary file */
 };
 
 typedef void (*func) (struct cache *, void *, int, double *, double *, struct Cell_head *);
@@ -6,6 +6,8 @@
 extern func interpolate;	/* interpolation routine */
 
 extern int seg_mb_img;
+extern int nprocs;		/* number of threads */
+extern double max_err;		/* error of approximate transformation */
 
 struct Image_Group
 {
@@ -18,10 +18,15 @@ int georef_window(struct Image_Group *, struct Cell_head *, struct Cell_head *,
 int rectify(struct Image_Group *, char *, char *, char *, int, char *);
 
 /* readcell.c */
-struct cache *readcell(int, int);
+struct cache *readcell(int, int, int);
+struct cache *clone_cache(struct cache *, unsigned int);
 block *get_block(struct cache *, int);
 void release_cache(struct cache *);
 
+/* transform.c */
+void transform_row(struct Image_Group *, int, double, double, double, int,
+		   double, const struct Cell_head *, double *, double *);
+
 /* report.c */
 int report(time_t, int);
 
@@ -28,6 +28,8 @@
 #include "global.h"
 
 int seg_mb_img;
+int nprocs;
+double max_err;
 
 func interpolate;
 
@@ -72,8 +74,10 @@ int main(int argc, char *argv[])
      *ext,			/* extension */
      *tres,			/* target resolution */
      *mem,			/* amount of memory for cache */
-     *interpol;			/* interpolation method:
+     *interpol,			/* interpolation method:
 				   nearest neighbor, bilinear, cubic */
+     *error,			/* approximation threshold */
+     *procs;			/* number of threads */
     struct Flag *c, *a, *t;
     struct GModule *module;
 
@@ -131,6 +135,17 @@ int main(int argc, char *argv[])
     interpol->options = ipolname;
     interpol->description = _("Interpolation method to use");
 
+    error = G_define_option();
+    error->key = "error";
+    error->type = TYPE_DOUBLE;
+    error->required = NO;
+    error->answer = "0";
+    error->label =
+	_("Error threshold for approximate transformation (in source cells)");
+    error->description = _("Zero transforms every cell exactly");
+
+    procs = G_define_standard_option(G_OPT_M_NPROCS);
+
     c = G_define_flag();
     c->key = 'c';
     c->description =
@@ -157,6 +172,11 @@ int main(int argc, char *argv[])
 		      interpol->key, interpol->answer, interpol->key);
     interpolate = menu[method].method;
 
+    max_err = atof(error->answer);
+    if (max_err < 0)
+	G_fatal_error(_("<%s> must be zero or positive"), error->key);
+    nprocs = G_set_nprocs(procs);
+
     G_strip(grp->answer);
     strcpy(group.name, grp->answer);
     strcpy(extension, ext->answer);
@@ -12,20 +12,18 @@
 #include <unistd.h>
 #include "global.h"
 
-struct cache *readcell(int fdi, int size)
+struct cache *readcell(int fdi, int size, int nthreads)
 {
     DCELL *tmpbuf;
     struct cache *c;
     int nrows;
     int ncols;
     int row;
-    char *filename;
     int nx, ny;
     int nblocks;
+    int partial;
     int i;
 
-    G_srand48(0);
-
     nrows = Rast_input_window_rows();
     ncols = Rast_input_window_cols();
 
@@ -37,28 +35,42 @@ struct cache *readcell(int fdi, int size)
     else
 	nblocks = (nx + ny) * 2;	/* guess */
 
-    if (nblocks > nx * ny)
+    if (nblocks >= nx * ny) {
 	nblocks = nx * ny;
+	partial = 0;
+    }
+    else {
+	partial = 1;
+	/* every thread gets its own share of the cache, see clone_cache() */
+	nblocks /= nthreads;
+	if (nblocks < 1)
+	    nblocks = 1;
+    }
 
     c = G_malloc(sizeof(struct cache));
     c->stride = nx;
+    c->ngrid = nx * ny;
     c->nblocks = nblocks;
+    c->seed = 0;
+    c->owner = 1;
     c->grid = (block **) G_calloc(nx * ny, sizeof(block *));
     c->blocks = (block *) G_malloc(nblocks * sizeof(block));
     c->refs = (int *)G_malloc(nblocks * sizeof(int));
 
-    if (nblocks < nx * ny) {
+    if (partial) {
 	/* Temporary file must be created in input location */
-	filename = G_tempfile();
-	c->fd = open(filename, O_RDWR | O_CREAT | O_EXCL, 0600);
+	c->fname = G_tempfile();
+	c->fd = open(c->fname, O_RDWR | O_CREAT | O_EXCL, 0600);
 	if (c->fd < 0)
 	    G_fatal_error(_("Unable to open temporary file"));
-	remove(filename);
     }
-    else
+    else {
 	c->fd = -1;
-	
-    G_debug(1, "%d of %d blocks in memory", nblocks, nx * ny);
+	c->fname = NULL;
+    }
+
+    G_debug(1, "%d of %d blocks in memory",
+	    nblocks * (partial ? nthreads : 1), nx * ny);
 
     G_important_message(_("Allocating memory and reading input map..."));
     G_percent(0, nrows, 5);
@@ -107,14 +119,20 @@ struct cache *readcell(int fdi, int size)
 
 block *get_block(struct cache * c, int idx)
 {
-    int replace = G_lrand48() % c->nblocks;
-    block *p = &c->blocks[replace];
-    int cref = c->refs[replace];
+    int replace;
+    block *p;
+    int cref;
     off_t offset = (off_t) idx * sizeof(DCELL) << L2BSIZE;
 
     if (c->fd < 0)
 	G_fatal_error(_("Internal error: cache miss on fully-cached map"));
 
+    /* random replacement with a per cache generator (thread safe) */
+    c->seed = c->seed * 1103515245 + 12345;
+    replace = (c->seed >> 16) % c->nblocks;
+    p = &c->blocks[replace];
+    cref = c->refs[replace];
+
     if (cref >= 0)
 	c->grid[cref] = NULL;
 
@@ -130,8 +148,41 @@ block *get_block(struct cache * c, int idx)
     return p;
 }
 
+struct cache *clone_cache(struct cache *c, unsigned int seed)
+{
+    /* A fully cached map is read-only and can be shared by all threads.
+     * Otherwise the clone has its own blocks and file descriptor on the
+     * same temporary file. */
+    struct cache *n;
+    int i;
+
+    if (c->fd < 0)
+	return c;
+
+    n = G_malloc(sizeof(struct cache));
+    *n = *c;
+    n->seed = seed;
+    n->owner = 0;
+    n->fd = open(c->fname, O_RDONLY);
+    if (n->fd < 0)
+	G_fatal_error(_("Unable to open temporary file"));
+    n->grid = (block **) G_calloc(c->ngrid, sizeof(block *));
+    n->blocks = (block *) G_malloc(c->nblocks * sizeof(block));
+    n->refs = (int *)G_malloc(c->nblocks * sizeof(int));
+    for (i = 0; i < n->nblocks; i++)
+	n->refs[i] = -1;
+
+    return n;
+}
+
 void release_cache(struct cache *c)
 {
+    if (c->fd >= 0)
+	close(c->fd);
+    if (c->owner && c->fname) {
+	remove(c->fname);
+	G_free(c->fname);
+    }
     G_free(c->refs);
     G_free(c->blocks);
     G_free(c->grid);
@@ -11,18 +11,66 @@
 #include <unistd.h>
 #include "global.h"
 
+/* number of rows processed at once by a thread */
+#define BLOCK_ROWS 8
+
+struct band
+{
+    struct Image_Group *group;
+    int order;
+    struct Cell_head *cellhd;	/* source region */
+    int row0;			/* first target row of the band */
+    int ncols;
+    RASTER_MAP_TYPE map_type;
+    int cell_size;
+    void **trast;		/* target rows of the band */
+    int chunk;			/* rows per thread */
+    struct cache **caches;	/* per thread views of the source map */
+    double **row_idx, **col_idx;	/* per thread source indices */
+};
+
+/* transform and resample the rows first to last - 1 of a band */
+static void rectify_rows(int first, int last, void *closure)
+{
+    const struct band *b = closure;
+    int s = first / b->chunk;
+    struct cache *ibuffer = b->caches[s];
+    double *row_idx = b->row_idx[s], *col_idx = b->col_idx[s];
+    int i, col;
+
+    for (i = first; i < last; i++) {
+	int row = b->row0 + i;
+	double n1 = target_window.north - (row + 0.5) * target_window.ns_res;
+	void *tptr = b->trast[i];
+
+	/* backwards transformation of target cell centers */
+	transform_row(b->group, b->order,
+		      target_window.west + 0.5 * target_window.ew_res,
+		      target_window.ew_res, n1, b->ncols, max_err, b->cellhd,
+		      row_idx, col_idx);
+
+	Rast_set_null_value(tptr, b->ncols, b->map_type);
+	for (col = 0; col < b->ncols; col++) {
+	    /* resample data point */
+	    interpolate(ibuffer, tptr, b->map_type, &row_idx[col],
+			&col_idx[col], b->cellhd);
+
+	    tptr = G_incr_void_ptr(tptr, b->cell_size);
+	}
+    }
+}
+
 int rectify(struct Image_Group *group, char *name, char *mapset,
             char *result, int order, char *interp_method)
 {
     struct Cell_head cellhd;
     int ncols, nrows;
-    int row, col;
-    double row_idx, col_idx;
+    int row, i;
     int infd, outfd;
     RASTER_MAP_TYPE map_type;
     int cell_size;
-    void *trast, *tptr;
-    double n1, e1, nx, ex;
+    int nblock, nchunks;
+    struct band b;
     struct cache *ibuffer;
 
     select_current_env();
@@ -36,7 +84,7 @@ int rectify(struct Image_Group *group, char *name, char *mapset,
     map_type = Rast_get_map_type(infd);
     cell_size = Rast_cell_size(map_type);
 
-    ibuffer = readcell(infd, seg_mb_img);
+    ibuffer = readcell(infd, seg_mb_img, nprocs);
 
     Rast_close(infd);		/* (pmx) 17 april 2000 */
 
@@ -61,41 +109,58 @@ int rectify(struct Image_Group *group, char *name, char *mapset,
      */
 
     outfd = Rast_open_new(result, map_type);
-    trast = Rast_allocate_output_buf(map_type);
-
-    for (row = 0; row < nrows; row++) {
-	n1 = target_window.north - (row + 0.5) * target_window.ns_res;
 
-	G_percent(row, nrows, 2);
-
-	Rast_set_null_value(trast, ncols, map_type);
-	tptr = trast;
-	for (col = 0; col < ncols; col++) {
-	    e1 = target_window.west + (col + 0.5) * target_window.ew_res;
+    /* the target rows are processed in bands, the rows of a band by
+     * several threads */
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    nchunks = (nblock + BLOCK_ROWS - 1) / BLOCK_ROWS;
+
+    b.group = group;
+    b.order = order;
+    b.cellhd = &cellhd;
+    b.ncols = ncols;
+    b.map_type = map_type;
+    b.cell_size = cell_size;
+    b.chunk = BLOCK_ROWS;
+    b.trast = G_malloc(nblock * sizeof(void *));
+    for (i = 0; i < nblock; i++)
+	b.trast[i] = Rast_allocate_output_buf(map_type);
+    b.caches = G_malloc(nchunks * sizeof(struct cache *));
+    b.row_idx = G_malloc(nchunks * sizeof(double *));
+    b.col_idx = G_malloc(nchunks * sizeof(double *));
+    for (i = 0; i < nchunks; i++) {
+	b.caches[i] = i ? clone_cache(ibuffer, i) : ibuffer;
+	b.row_idx[i] = G_malloc(ncols * sizeof(double));
+	b.col_idx[i] = G_malloc(ncols * sizeof(double));
+    }
 
-	    /* backwards transformation of target cell center */
-	    if (order == 0)
-		I_georef_tps(e1, n1, &ex, &nx, group->E21_t, group->N21_t, &group->control_points, 0);
-	    else
-		I_georef(e1, n1, &ex, &nx, group->E21, group->N21, order);
+    for (row = 0; row < nrows; row += nblock) {
+	int n = nrows - row < nblock ? nrows - row : nblock;
 
-	    /* convert to row/column indices of source raster */
-	    row_idx = (cellhd.north - nx) / cellhd.ns_res;
-	    col_idx = (ex - cellhd.west) / cellhd.ew_res;
+	G_percent(row, nrows, 2);
 
-	    /* resample data point */
-	    interpolate(ibuffer, tptr, map_type, &row_idx, &col_idx, &cellhd);
+	b.row0 = row;
+	G_parallel_for(0, n, b.chunk, rectify_rows, &b);
 
-	    tptr = G_incr_void_ptr(tptr, cell_size);
-	}
-	Rast_put_row(outfd, trast, map_type);
+	for (i = 0; i < n; i++)
+	    Rast_put_row(outfd, b.trast[i], map_type);
     }
     G_percent(1, 1, 1);
 
     Rast_close(outfd);		/* (pmx) 17 april 2000 */
-    G_free(trast);
+    for (i = 0; i < nblock; i++)
+	G_free(b.trast[i]);
+    G_free(b.trast);
+    for (i = 0; i < nchunks; i++) {
+	if (i && b.caches[i] != ibuffer)
+	    release_cache(b.caches[i]);
+	G_free(b.row_idx[i]);
+	G_free(b.col_idx[i]);
+    }
+    G_free(b.caches);
+    G_free(b.row_idx);
+    G_free(b.col_idx);
 
-    close(ibuffer->fd);
     release_cache(ibuffer);
 
     Rast_get_cellhd(result, G_mapset(), &cellhd);
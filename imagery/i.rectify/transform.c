@@ -0,0 +1,118 @@
+/*
+ * transform.c - backwards transformation of the cell centers of a
+ *               whole target row
+ *
+ * The cell centers of one target row are transformed to row and column
+ * indices of the source raster either exactly, cell by cell, or
+ * approximately: the row is split recursively until linear
+ * interpolation between the end points of a segment differs from the
+ * exact transformation of its middle point by no more than the given
+ * threshold (in source cells), like GDAL's approximating transformer
+ * does. This saves most of the evaluations of thin plate splines, whose
+ * cost grows with the number of control points.
+ */
+
+#include <math.h>
+#include "global.h"
+
+struct row_info
+{
+    struct Image_Group *group;
+    int order;
+    double e0, de, n1;
+    double threshold;
+    const struct Cell_head *cellhd;
+    double *row_idx, *col_idx;
+};
+
+static void transform_point(const struct row_info *r, int col)
+{
+    double e1 = r->e0 + col * r->de;
+    double ex, nx;
+
+    if (r->order == 0)
+	I_georef_tps(e1, r->n1, &ex, &nx, r->group->E21_t, r->group->N21_t,
+		     &r->group->control_points, 0);
+    else
+	I_georef(e1, r->n1, &ex, &nx, r->group->E21, r->group->N21,
+		 r->order);
+
+    /* convert to row/column indices of source raster */
+    r->row_idx[col] = (r->cellhd->north - nx) / r->cellhd->ns_res;
+    r->col_idx[col] = (ex - r->cellhd->west) / r->cellhd->ew_res;
+}
+
+static void transform_segment(const struct row_info *r, int a, int b)
+{
+    /* a and b are already transformed */
+    int col, m = (a + b) / 2;
+    double t;
+
+    if (b - a < 2)
+	return;
+
+    transform_point(r, m);
+
+    t = (double)(m - a) / (b - a);
+    if (fabs(r->row_idx[a] + t * (r->row_idx[b] - r->row_idx[a]) -
+	     r->row_idx[m]) <= r->threshold &&
+	fabs(r->col_idx[a] + t * (r->col_idx[b] - r->col_idx[a]) -
+	     r->col_idx[m]) <= r->threshold) {
+	for (col = a + 1; col < b; col++) {
+	    if (col == m)
+		continue;
+	    t = (double)(col - a) / (b - a);
+	    r->row_idx[col] =
+		r->row_idx[a] + t * (r->row_idx[b] - r->row_idx[a]);
+	    r->col_idx[col] =
+		r->col_idx[a] + t * (r->col_idx[b] - r->col_idx[a]);
+	}
+	return;
+    }
+
+    transform_segment(r, a, m);
+    transform_segment(r, m, b);
+}
+
+/*!
+ * \brief Transform the cell centers of one target row to source indices
+ *
+ * \param group imagery group with the transformation coefficients
+ * \param order order of the polynomial, 0 for thin plate splines
+ * \param e0 easting of the center of the first cell
+ * \param de east-west resolution of the target region
+ * \param n1 northing of the row
+ * \param n number of cells
+ * \param threshold maximum error in source cells, 0 for exact
+ * \param cellhd source region
+ * \param[out] row_idx row indices in the source raster
+ * \param[out] col_idx column indices in the source raster
+ */
+void transform_row(struct Image_Group *group, int order, double e0,
+		   double de, double n1, int n, double threshold,
+		   const struct Cell_head *cellhd, double *row_idx,
+		   double *col_idx)
+{
+    struct row_info r;
+    int col;
+
+    r.group = group;
+    r.order = order;
+    r.e0 = e0;
+    r.de = de;
+    r.n1 = n1;
+    r.threshold = threshold;
+    r.cellhd = cellhd;
+    r.row_idx = row_idx;
+    r.col_idx = col_idx;
+
+    if (threshold > 0 && n > 1) {
+	transform_point(&r, 0);
+	transform_point(&r, n - 1);
+	transform_segment(&r, 0, n - 1);
+    }
+    else {
+	for (col = 0; col < n; col++)
+	    transform_point(&r, col);
+    }
+}
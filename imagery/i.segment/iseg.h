@@ -83,6 +83,7 @@ struct globals
 
     /* region growing */
     int min_segment_size;	/* smallest number of pixels/cells allowed in a final segment */
+    int tilesize;		/* rows and columns of tiles segmented in parallel, 0 for no tiles */
     int *new_id;
 
     /* inactive options for region growing */
@@ -111,6 +112,9 @@ struct globals
 
     /* maximum used region ID */
     CELL max_rid;
+    /* IDs of merged regions, used again for new regions */
+    int *free_ids;
+    int nfree_ids, nalloc_free_ids;
 
     /* region growing internal structure */
     struct RG_TREE *reg_tree;   /* search tree with region stats */
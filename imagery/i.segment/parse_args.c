@@ -15,7 +15,7 @@ int parse_args(int argc, char *argv[], struct globals *globals)
 #ifdef _OR_SHAPE_
 		  *shape_weight, *smooth_weight,
 #endif
-		   *mem;
+		   *mem, *tilesize, *nprocs;
     struct Flag *diagonal, *weighted, *ms_a, *ms_p;
     struct Option *gof, *endt;
     int bands;
@@ -119,6 +119,17 @@ int parse_args(int argc, char *argv[], struct globals *globals)
     mem->answer = "300";
     mem->description = _("Memory in MB");
 
+    tilesize = G_define_option();
+    tilesize->key = "tilesize";
+    tilesize->type = TYPE_INTEGER;
+    tilesize->required = NO;
+    tilesize->answer = "0";
+    tilesize->label = _("Number of rows and columns of tiles for parallel region growing");
+    tilesize->description = _("Regions touching tile borders are merged afterwards, 0 disables tiling");
+    tilesize->guisection = _("Settings");
+
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     /* TODO input for distance function */
 
     /* debug parameters */
@@ -181,6 +192,8 @@ int parse_args(int argc, char *argv[], struct globals *globals)
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs);
+
     /* Check and save parameters */
 
     for (bands = 0; group->answers[bands] != NULL; bands++) ;
@@ -388,6 +401,19 @@ int parse_args(int argc, char *argv[], struct globals *globals)
 	}
     }
 
+    globals->tilesize = atoi(tilesize->answer);
+    if (globals->tilesize < 0)
+	G_fatal_error(_("Option '%s' must be >= 0"), tilesize->key);
+    if (globals->tilesize > 0 && globals->method != ORM_RG) {
+	G_warning(_("Option '%s' is only used for region growing"),
+	          tilesize->key);
+	globals->tilesize = 0;
+    }
+    if (globals->tilesize > 0 && globals->seeds) {
+	G_warning(_("Tiles can not be used with seeds, disabling tiles"));
+	globals->tilesize = 0;
+    }
+
     if (mem->answer && atoi(mem->answer) > 10)
 	globals->mb = atoi(mem->answer);
     else {
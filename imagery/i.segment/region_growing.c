@@ -25,15 +25,6 @@
 #endif
 #define MIN(a,b) ( ((a) < (b)) ? (a) : (b) )
 
-struct idlist
-{
-    int *ids;
-    int nids, nalloc;
-    CELL cellmax;
-};
-
-static struct idlist idlist;
-
 /* internal functions */
 static int merge_regions(struct ngbr_stats *, struct reg_stats *, /* Ri */
                          struct ngbr_stats *, struct reg_stats *, /* Rk */
@@ -53,43 +44,51 @@ static int find_best_neighbor(struct ngbr_stats *, struct reg_stats *,
 			      struct globals *);
 static int calculate_reg_stats(int, int, struct reg_stats *, 
                          struct globals *);
+static int grow_regions(struct globals *, double, FLAG *, int);
+static int grow_tiles(struct globals *, double);
+static int set_seam_flag(FLAG *, struct globals *);
 
-void init_free_ids(void)
+/* the free IDs are kept in globals, which is private to the thread
+ * growing the regions of a tile */
+void init_free_ids(struct globals *globals)
 {
-    idlist.nalloc = 10;
-    idlist.nids = 0;
+    globals->nalloc_free_ids = 10;
+    globals->nfree_ids = 0;
     
-    idlist.ids = G_malloc(idlist.nalloc * sizeof(int));
-
-    idlist.cellmax = ((CELL)1 << (sizeof(CELL) * 8 - 2)) - 1;
-    idlist.cellmax += ((CELL)1 << (sizeof(CELL) * 8 - 2));
+    globals->free_ids = G_malloc(globals->nalloc_free_ids * sizeof(int));
 
     return;
 }
 
-void add_free_id(int id)
+void add_free_id(int id, struct globals *globals)
 {
     if (id <= 0)
 	return;
 
-    if (idlist.nalloc <= idlist.nids) {
-	idlist.nalloc = idlist.nids + 10;
-	idlist.ids = G_realloc(idlist.ids, idlist.nalloc * sizeof(int));
+    if (globals->nalloc_free_ids <= globals->nfree_ids) {
+	globals->nalloc_free_ids = globals->nfree_ids + 10;
+	globals->free_ids = G_realloc(globals->free_ids,
+				      globals->nalloc_free_ids * sizeof(int));
     }
-    idlist.ids[idlist.nids++] = id;
+    globals->free_ids[globals->nfree_ids++] = id;
 
     return;
 }
 
 int get_free_id(struct globals *globals)
 {
-    if (idlist.nids > 0) {
-	idlist.nids--;
+    CELL cellmax;
 
-	return idlist.ids[idlist.nids];
+    if (globals->nfree_ids > 0) {
+	globals->nfree_ids--;
+
+	return globals->free_ids[globals->nfree_ids];
     }
 
-    if (globals->max_rid == idlist.cellmax)
+    cellmax = ((CELL)1 << (sizeof(CELL) * 8 - 2)) - 1;
+    cellmax += ((CELL)1 << (sizeof(CELL) * 8 - 2));
+
+    if (globals->max_rid == cellmax)
 	G_fatal_error(_("Too many objects: integer overflow"));
 
     globals->max_rid++;
@@ -97,13 +96,13 @@ int get_free_id(struct globals *globals)
     return globals->max_rid;
 }
 
-void free_free_ids(void)
+void free_free_ids(struct globals *globals)
 {
-    if (idlist.nalloc) {
-	G_free(idlist.ids);
-	idlist.ids = NULL;
-	idlist.nalloc = 0;
-	idlist.nids = 0;
+    if (globals->nalloc_free_ids) {
+	G_free(globals->free_ids);
+	globals->free_ids = NULL;
+	globals->nalloc_free_ids = 0;
+	globals->nfree_ids = 0;
     }
     
     return;
@@ -194,10 +193,34 @@ static int dump_Ri(struct ngbr_stats *Ri, struct reg_stats *Ri_rs, double *Ri_si
 
 
 int region_growing(struct globals *globals)
+{
+    struct Cell_head cellhd;
+    double divisor;
+
+    G_verbose_message("Running region growing algorithm");
+
+    Rast_get_cellhd(globals->Ref.file[0].name, globals->Ref.file[0].mapset, &cellhd);
+    divisor = cellhd.rows + cellhd.cols;
+
+    if (globals->tilesize > 0 &&
+        (globals->row_max - globals->row_min > globals->tilesize ||
+	 globals->col_max - globals->col_min > globals->tilesize))
+	return grow_tiles(globals, divisor);
+
+    return grow_regions(globals, divisor, NULL, 0);
+}
+
+/* region growing in the current processing window
+ * if seam_flag is not NULL, only regions touching the borders of tiles
+ * are used as starting regions
+ * in_tile: the window is a tile, the threshold is not ignored for small
+ *          segments and no messages are printed */
+static int grow_regions(struct globals *globals, double divisor,
+                        FLAG *seam_flag, int in_tile)
 {
     int row, col, t;
     double threshold, adjthresh, Ri_similarity, Rk_similarity;
-    double alpha2, divisor;		/* threshold parameters */
+    double alpha2;		/* threshold parameters */
     int n_merges, do_merge;		/* number of merges on that iteration */
     int pathflag;		/* =1 if we didn't find mutually best neighbors, continue with Rk */
     int candidates_only;
@@ -213,14 +236,11 @@ int region_growing(struct globals *globals)
     double *dp;
     struct NB_TREE *tmpnbtree;
     CELL cellmax;
-    struct Cell_head cellhd;
-
-    G_verbose_message("Running region growing algorithm");
 
     cellmax = ((CELL)1 << (sizeof(CELL) * 8 - 2)) - 1;
     cellmax += ((CELL)1 << (sizeof(CELL) * 8 - 2));
 
-    init_free_ids();
+    init_free_ids(globals);
 
     /* init neighbor stats */
     Ri.mean = G_malloc(globals->datasize);
@@ -246,14 +266,13 @@ int region_growing(struct globals *globals)
     threshold = alpha2;
     G_debug(1, "Squared threshold: %g", threshold);
 
-    Rast_get_cellhd(globals->Ref.file[0].name, globals->Ref.file[0].mapset, &cellhd);
-    divisor = cellhd.rows + cellhd.cols;
-
     /* TODO: renumber seeds */
 
     while (t < globals->end_t && n_merges > 1) {
 
-	G_message(_("Processing pass %d..."), ++t);
+	t++;
+	if (!in_tile)
+	    G_message(_("Processing pass %d..."), t);
 
 	n_merges = 0;
 	globals->candidate_count = 0;
@@ -270,17 +289,25 @@ int region_growing(struct globals *globals)
 	    }
 	}
 
+	/* start only with regions touching tile borders */
+	if (seam_flag)
+	    set_seam_flag(seam_flag, globals);
+
 	G_debug(4, "Starting to process %"PRI_LONG" candidate cells",
 		globals->candidate_count);
 
 	/*process candidate cells */
-	G_percent_reset();
+	if (!in_tile)
+	    G_percent_reset();
 	for (row = globals->row_min; row < globals->row_max; row++) {
-	    G_percent(row - globals->row_min,
-	              globals->row_max - globals->row_min, 4);
+	    if (!in_tile)
+		G_percent(row - globals->row_min,
+			  globals->row_max - globals->row_min, 4);
 	    for (col = globals->col_min; col < globals->col_max; col++) {
 		if (!(FLAG_GET(globals->candidate_flag, row, col)))
 		    continue;
+		if (seam_flag && !(FLAG_GET(seam_flag, row, col)))
+		    continue;
 
 		pathflag = TRUE;
 		candidates_only = TRUE;
@@ -521,25 +548,31 @@ int region_growing(struct globals *globals)
 		}    /* end pathflag */
 	    }    /* next col */
 	}    /* next row */
-        G_percent(1, 1, 1);
+	if (!in_tile) {
+	    G_percent(1, 1, 1);
 
-	/* finished one pass for processing candidate pixels */
-	G_verbose_message("%d merges", n_merges);
+	    /* finished one pass for processing candidate pixels */
+	    G_verbose_message("%d merges", n_merges);
+	}
 
 	G_debug(4, "Finished pass %d", t);
     }
 
     /*end t loop *//*TODO, should there be a max t that it can iterate for?  Include t in G_message? */
-    if (n_merges > 1)
+    if (in_tile)
+	G_debug(1, "Tile segmentation stopped after %d iterations", t);
+    else if (n_merges > 1)
 	G_message(_("Segmentation processes stopped at %d due to reaching max iteration limit, more merges may be possible"), t);
     else
 	G_message(_("Segmentation converged after %d iterations"), t);
 
     /* assign region IDs to remaining 0 IDs */
-    G_message(_("Assigning region IDs to remaining single-cell regions..."));
+    if (!in_tile)
+	G_message(_("Assigning region IDs to remaining single-cell regions..."));
     for (row = globals->row_min; row < globals->row_max; row++) {
-	G_percent(row - globals->row_min,
-		  globals->row_max - globals->row_min, 4);
+	if (!in_tile)
+	    G_percent(row - globals->row_min,
+		      globals->row_max - globals->row_min, 4);
 	for (col = globals->col_min; col < globals->col_max; col++) {
 	    if (!(FLAG_GET(globals->null_flag, row, col))) {
 		/* get segment id */
@@ -551,15 +584,17 @@ int region_growing(struct globals *globals)
 	    }
 	}
     }
-    G_percent(1, 1, 1);
+    if (!in_tile)
+	G_percent(1, 1, 1);
 
-    free_free_ids();
+    free_free_ids(globals);
 
     /* ****************************************************************************************** */
     /* final pass, ignore threshold and force a merge for small segments with their best neighbor */
     /* ****************************************************************************************** */
     
-    if (globals->min_segment_size > 1) {
+    /* for tiles, this is done after merging across tile borders */
+    if (!in_tile && globals->min_segment_size > 1) {
 	G_message(_("Merging segments smaller than %d cells..."), globals->min_segment_size);
 
 	threshold = globals->alpha * globals->alpha;
@@ -677,6 +712,298 @@ int region_growing(struct globals *globals)
     return TRUE;
 }
 
+/* mark the cells of all regions touching a tile border */
+static int set_seam_flag(FLAG *seam_flag, struct globals *globals)
+{
+    int row, col, n, rid, R_id;
+    int rseam, cseam;
+    int ts = globals->tilesize;
+    struct rc next, ngbr_rc;
+    struct rclist rlist;
+    int neighbors[8][2];
+    LARGEINT nseam = 0;
+
+    flag_clear_all(seam_flag);
+
+    for (row = globals->row_min; row < globals->row_max; row++) {
+	n = (row - globals->row_min) % ts;
+	rseam = ((n == 0 && row > globals->row_min) ||
+	         (n == ts - 1 && row < globals->row_max - 1));
+
+	for (col = globals->col_min; col < globals->col_max; col++) {
+	    if (!rseam) {
+		n = (col - globals->col_min) % ts;
+		cseam = ((n == 0 && col > globals->col_min) ||
+			 (n == ts - 1 && col < globals->col_max - 1));
+		if (!cseam)
+		    continue;
+	    }
+	    if (FLAG_GET(globals->null_flag, row, col))
+		continue;
+	    if (FLAG_GET(seam_flag, row, col))
+		continue;
+
+	    FLAG_SET(seam_flag, row, col);
+	    nseam++;
+
+	    Segment_get(&globals->rid_seg, (void *) &rid, row, col);
+	    if (rid <= 0)
+		continue;
+
+	    /* go through region, spreading outwards from head */
+	    rclist_init(&rlist);
+	    rclist_add(&rlist, row, col);
+
+	    while (rclist_drop(&rlist, &next)) {
+
+		globals->find_neighbors(next.row, next.col, neighbors);
+
+		n = globals->nn - 1;
+		do {
+
+		    ngbr_rc.row = neighbors[n][0];
+		    ngbr_rc.col = neighbors[n][1];
+
+		    if (ngbr_rc.row >= globals->row_min &&
+			ngbr_rc.row < globals->row_max &&
+			ngbr_rc.col >= globals->col_min &&
+			ngbr_rc.col < globals->col_max) {
+
+			if (!(FLAG_GET(globals->null_flag, ngbr_rc.row, ngbr_rc.col)) &&
+			    !(FLAG_GET(seam_flag, ngbr_rc.row, ngbr_rc.col))) {
+
+			    Segment_get(&globals->rid_seg, (void *) &R_id,
+					ngbr_rc.row, ngbr_rc.col);
+
+			    if (R_id == rid) {
+				FLAG_SET(seam_flag, ngbr_rc.row, ngbr_rc.col);
+				nseam++;
+
+				/* want to check this neighbor's neighbors */
+				rclist_add(&rlist, ngbr_rc.row, ngbr_rc.col);
+			    }
+			}
+		    }
+		} while (n--);
+	    }
+	    rclist_destroy(&rlist);
+	}
+    }
+
+    G_debug(1, "%"PRI_LONG" cells of regions touching tile borders", nseam);
+
+    return 1;
+}
+
+/* a copy of globals for a tile with local row and col coordinates
+ * and its own segment structures, flags and search tree */
+static void init_tile_globals(struct globals *tg, struct globals *globals)
+{
+    int nrows, ncols;
+
+    *tg = *globals;
+
+    nrows = MIN(globals->tilesize, globals->row_max - globals->row_min);
+    ncols = MIN(globals->tilesize, globals->col_max - globals->col_min);
+
+    /* all in memory */
+    if (Segment_open(&tg->bands_seg, NULL, nrows, ncols, nrows, ncols,
+                     globals->datasize, 1) != 1 ||
+        Segment_open(&tg->rid_seg, NULL, nrows, ncols, nrows, ncols,
+                     sizeof(CELL), 1) != 1)
+	G_fatal_error(_("Unable to create tile segment structures"));
+
+    tg->null_flag = flag_create(nrows, ncols);
+    tg->candidate_flag = flag_create(nrows, ncols);
+    tg->reg_tree = rgtree_create(globals->nbands, globals->datasize);
+
+    tg->bands_val = G_malloc(globals->datasize);
+    tg->second_val = G_malloc(globals->datasize);
+    tg->rs.sum = G_malloc(globals->datasize);
+    tg->rs.mean = G_malloc(globals->datasize);
+}
+
+static void free_tile_globals(struct globals *tg)
+{
+    Segment_close(&tg->bands_seg);
+    Segment_close(&tg->rid_seg);
+    flag_destroy(tg->null_flag);
+    flag_destroy(tg->candidate_flag);
+    rgtree_destroy(tg->reg_tree);
+    G_free(tg->bands_val);
+    G_free(tg->second_val);
+    G_free(tg->rs.sum);
+    G_free(tg->rs.mean);
+}
+
+/* copy the input of the tile starting at row0, col0 to the tile globals */
+static int load_tile(struct globals *tg, struct globals *globals,
+                     int row0, int col0)
+{
+    int row, col, have_data = 0;
+    CELL id;
+
+    tg->nrows = MIN(globals->tilesize, globals->row_max - row0);
+    tg->ncols = MIN(globals->tilesize, globals->col_max - col0);
+    tg->row_min = tg->col_min = 0;
+    tg->row_max = tg->nrows;
+    tg->col_max = tg->ncols;
+    tg->max_rid = 0;
+    tg->candidate_count = 0;
+
+    flag_clear_all(tg->null_flag);
+
+    for (row = 0; row < tg->nrows; row++) {
+	for (col = 0; col < tg->ncols; col++) {
+	    if (FLAG_GET(globals->null_flag, row0 + row, col0 + col)) {
+		FLAG_SET(tg->null_flag, row, col);
+		Rast_set_c_null_value(&id, 1);
+	    }
+	    else {
+		have_data = 1;
+		id = 0;
+		Segment_get(&globals->bands_seg, (void *)tg->bands_val,
+			    row0 + row, col0 + col);
+		Segment_put(&tg->bands_seg, (void *)tg->bands_val, row, col);
+	    }
+	    Segment_put(&tg->rid_seg, (void *)&id, row, col);
+	}
+    }
+
+    return have_data;
+}
+
+/* copy the regions of a tile back to globals with unique region IDs */
+static int store_tile(struct globals *tg, struct globals *globals,
+                      int row0, int col0)
+{
+    int row, col;
+    CELL id, offset, cellmax;
+    struct RG_TRAV trav;
+    struct reg_stats *rs;
+
+    cellmax = ((CELL)1 << (sizeof(CELL) * 8 - 2)) - 1;
+    cellmax += ((CELL)1 << (sizeof(CELL) * 8 - 2));
+
+    offset = globals->max_rid;
+    if (tg->max_rid > cellmax - offset)
+	G_fatal_error(_("Too many objects: integer overflow"));
+
+    for (row = 0; row < tg->nrows; row++) {
+	for (col = 0; col < tg->ncols; col++) {
+	    if (FLAG_GET(tg->null_flag, row, col))
+		continue;
+
+	    Segment_get(&tg->rid_seg, (void *)&id, row, col);
+	    id += offset;
+	    Segment_put(&globals->rid_seg, (void *)&id,
+			row0 + row, col0 + col);
+
+	    /* band values of small regions are the sums of the region */
+	    Segment_get(&tg->bands_seg, (void *)tg->bands_val, row, col);
+	    Segment_put(&globals->bands_seg, (void *)tg->bands_val,
+			row0 + row, col0 + col);
+	}
+    }
+
+    /* the order of the IDs does not change */
+    rgtree_init_trav(&trav, tg->reg_tree);
+    while ((rs = rgtree_traverse(&trav)) != NULL) {
+	rs->id += offset;
+	rgtree_insert(globals->reg_tree, rs);
+    }
+
+    globals->max_rid += tg->max_rid;
+
+    rgtree_destroy(tg->reg_tree);
+    tg->reg_tree = rgtree_create(tg->nbands, tg->datasize);
+
+    return 1;
+}
+
+/* the tiles of a round of tiles */
+struct round
+{
+    struct globals *tg;		/* per tile */
+    int *have_data;
+    double divisor;
+};
+
+/* the threads grow the regions of the tiles first to last - 1 of a
+ * round, each tile in its own copy of globals with in-memory segments,
+ * flags, search tree and free IDs; globals itself is only used by the
+ * main thread, which loads and stores the tiles */
+static void grow_round(int first, int last, void *closure)
+{
+    const struct round *rd = closure;
+    int i;
+
+    for (i = first; i < last; i++)
+	if (rd->have_data[i])
+	    grow_regions(&rd->tg[i], rd->divisor, NULL, 1);
+}
+
+/* grow regions in tiles in parallel, then merge across tile borders */
+static int grow_tiles(struct globals *globals, double divisor)
+{
+    int i, tile, ntiles, tile_cols;
+    int nthreads = G_num_workers() + 1;
+    int ts = globals->tilesize;
+    struct round rd;
+    FLAG *seam_flag;
+
+    tile_cols = (globals->col_max - globals->col_min + ts - 1) / ts;
+    ntiles = tile_cols *
+             ((globals->row_max - globals->row_min + ts - 1) / ts);
+
+    G_message(_("Growing regions in %d tiles..."), ntiles);
+
+    /* a round has a tile for each thread, the segment structures of
+     * globals are not thread-safe, the tiles are loaded and stored in
+     * the order of the tiles */
+    rd.tg = G_malloc(nthreads * sizeof(struct globals));
+    rd.have_data = G_malloc(nthreads * sizeof(int));
+    rd.divisor = divisor;
+    for (i = 0; i < nthreads; i++)
+	init_tile_globals(&rd.tg[i], globals);
+
+    for (tile = 0; tile < ntiles; tile += nthreads) {
+	int n = ntiles - tile < nthreads ? ntiles - tile : nthreads;
+
+	G_percent(tile, ntiles, 4);
+
+	for (i = 0; i < n; i++)
+	    rd.have_data[i] =
+		load_tile(&rd.tg[i], globals,
+			  globals->row_min + ((tile + i) / tile_cols) * ts,
+			  globals->col_min + ((tile + i) % tile_cols) * ts);
+
+	G_parallel_for(0, n, 1, grow_round, &rd);
+
+	for (i = 0; i < n; i++)
+	    if (rd.have_data[i])
+		store_tile(&rd.tg[i], globals,
+			   globals->row_min + ((tile + i) / tile_cols) * ts,
+			   globals->col_min + ((tile + i) % tile_cols) * ts);
+    }
+    G_percent(1, 1, 1);
+
+    for (i = 0; i < nthreads; i++)
+	free_tile_globals(&rd.tg[i]);
+    G_free(rd.tg);
+    G_free(rd.have_data);
+
+    /* regions touching a tile border have not been compared to the
+     * regions across the border */
+    G_message(_("Merging regions across tile borders..."));
+
+    seam_flag = flag_create(globals->nrows, globals->ncols);
+    grow_regions(globals, divisor, seam_flag, 0);
+    flag_destroy(seam_flag);
+
+    return TRUE;
+}
+
 static void free_item(void *p)
 {
     G_free(p);
@@ -1180,7 +1507,7 @@ static int merge_regions(struct ngbr_stats *Ri, struct reg_stats *Ri_rs,
 	    /* remove from tree */
 	    rgtree_remove(globals->reg_tree, Rk_rs);
 	}
-	add_free_id(Rk->id);
+	add_free_id(Rk->id, globals);
     }
     else {
 
@@ -1190,7 +1517,7 @@ static int merge_regions(struct ngbr_stats *Ri, struct reg_stats *Ri_rs,
 	    /* remove from tree */
 	    rgtree_remove(globals->reg_tree, Ri_rs);
 	}
-	add_free_id(Ri->id);
+	add_free_id(Ri->id, globals);
 
 	/* magic switch */
 	Ri_rs->id = Rk->id;
@@ -2,15 +2,14 @@
 #include <math.h>
 #include "bouman.h"
 
-/* Global Variables: These variables are required as inputs  *
- * to the function called by ``solve''. Since the function is   *
- * called by a pointer, side inputs must be passed as global    *
- * variables root finding                                       */
-static double ***N_glb;		/* N_glb[2][3][2] rate statistics */
-static double *b_glb;		/* line search direction */
-static double eps_glb;		/* precision */
-static int M_glb;		/* number of classes */
-
+/* side inputs of the function called by ``solve'', passed as its *
+ * closure, since blocks are segmented concurrently              */
+struct line
+{
+    double ***N;		/* N[2][3][2] rate statistics */
+    double *b;			/* line search direction */
+    int M;			/* number of classes */
+};
 
 
 void alpha_max(double ***N,	/* Transition probability statistics; N2[2][3][2] */
@@ -45,6 +44,7 @@ void line_search(
     int code;			/* error code for solve subroutine */
     double x;			/* distance along line */
     double max;			/* maximum value for x */
+    struct line line;		/* inputs of func */
 
     normalize(b);
 
@@ -55,14 +55,13 @@ void line_search(
     /* enforce condition [1,2,1][a[0],a[1],a[2]]^t <1-eps */
     max = (1 - eps) / (b[0] + 2 * b[1] + b[2]);
 
-    /* set global variables for solve routine */
-    N_glb = N;
-    b_glb = b;
-    eps_glb = eps;
-    M_glb = M;
+    /* set inputs for solve routine */
+    line.N = N;
+    line.b = b;
+    line.M = M;
 
     /* minimize on line. Avoid singular boundary */
-    x = solve(func, eps, max, eps, &code);
+    x = solve(func, &line, eps, max, eps, &code);
 
     /* If derivative was positive on line, x=max. */
     if (code == 1)
@@ -95,16 +94,18 @@ int normalize(
     return (1);
 }
 
-double func(double x)
+double func(double x, void *closure)
 {
+    const struct line *line = closure;
+    const double *b = line->b;
     double tmp[3], grad[3];
 
-    tmp[0] = x * b_glb[0];
-    tmp[1] = x * b_glb[1];
-    tmp[2] = x * b_glb[2];
+    tmp[0] = x * b[0];
+    tmp[1] = x * b[1];
+    tmp[2] = x * b[2];
 
-    gradient(grad, N_glb, tmp, M_glb);
-    return (b_glb[0] * grad[0] + b_glb[1] * grad[1] + b_glb[2] * grad[2]);
+    gradient(grad, line->N, tmp, line->M);
+    return (b[0] * grad[0] + b[1] * grad[1] + b[2] * grad[2]);
 }
 
 double log_like(
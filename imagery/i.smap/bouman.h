@@ -42,7 +42,7 @@ int openfiles(struct parms *, struct files *);
 void alpha_max(double ***, double *, int, double);
 void line_search(double ***, double *, int, double *, double);
 int normalize(double[3]);
-double func(double);
+double func(double, void *);
 double log_like(double ***, double[3], int);
 void gradient(double[3], double ***, double[3], int);
 
@@ -53,7 +53,8 @@ unsigned char **get_img(int, int, size_t);
 void free_img(unsigned char **);
 
 /* Subroutine in solve.c */
-double solve(double (*)(double), double, double, double, int *);
+double solve(double (*)(double, void *), void *, double, double, double,
+	     int *);
 
 /* Subroutine in invert.c */
 int invert(double **, int);
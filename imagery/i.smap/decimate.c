@@ -7,6 +7,14 @@ static void decimate(LIKELIHOOD ***, struct Region *, int, LIKELIHOOD ***,
 		     double);
 static void up_ll(LIKELIHOOD *, int, double, LIKELIHOOD *);
 
+struct decimate
+{
+    LIKELIHOOD ***ll1, ***ll2;
+    int xmin, xmax;		/* columns at coarse resolution */
+    int M;
+    double alpha;
+};
+
 
 void make_pyramid(LIKELIHOOD **** ll_pym,	/* log likelihood pyramid, ll_pym[scale][i][j][class] */
 		  struct Region *region,	/* specifies image subregion */
@@ -36,6 +44,34 @@ void make_pyramid(LIKELIHOOD **** ll_pym,	/* log likelihood pyramid, ll_pym[scal
     copy_reg(&region_buff, region);
 }
 
+/* decimate the coarse resolution rows first to last - 1; ll1 is shared
+ * and only read, each row of ll2 is written by one thread */
+static void decimate_rows(int first, int last, void *closure)
+{
+    const struct decimate *d = closure;
+    LIKELIHOOD ***ll1 = d->ll1;
+    int i, j, m;
+    LIKELIHOOD *node;		/* coarse resolution point */
+    LIKELIHOOD *pt1, *pt2, *pt3, *pt4;	/* fine resolution neighbors */
+
+    for (i = first; i < last; i++)
+	for (j = d->xmin; j < d->xmax; j++) {
+	    pt1 = ll1[2 * i][2 * j];
+	    pt2 = ll1[2 * i][2 * j + 1];
+	    pt3 = ll1[2 * i + 1][2 * j];
+	    pt4 = ll1[2 * i + 1][2 * j + 1];
+
+	    node = d->ll2[i][j];
+	    for (m = 0; m < d->M; m++)
+		node[m] = 0.0;
+
+	    up_ll(pt1, d->M, d->alpha, node);
+	    up_ll(pt2, d->M, d->alpha, node);
+	    up_ll(pt3, d->M, d->alpha, node);
+	    up_ll(pt4, d->M, d->alpha, node);
+	}
+}
+
 static void decimate(
 			/* decimate statistics ll1 to form ll2 */
 			LIKELIHOOD *** ll1,	/* log likelihood ll1[i][j][class], at fine resolution */
@@ -49,7 +85,8 @@ static void decimate(
     int wflag, hflag;		/* flags indicate odd number of pixels */
     int i, j, m;
     LIKELIHOOD *node;		/* coarse resolution point */
-    LIKELIHOOD *pt1, *pt2, *pt3, *pt4;	/* fine resolution neighbors */
+    LIKELIHOOD *pt1, *pt2;	/* fine resolution neighbors */
+    struct decimate d;
 
     region2 = &reg_spc;
 
@@ -59,22 +96,13 @@ static void decimate(
     wflag = region1->xmax & 1;
     hflag = region1->ymax & 1;
 
-    for (i = region2->ymin; i < region2->ymax; i++)
-	for (j = region2->xmin; j < region2->xmax; j++) {
-	    pt1 = ll1[2 * i][2 * j];
-	    pt2 = ll1[2 * i][2 * j + 1];
-	    pt3 = ll1[2 * i + 1][2 * j];
-	    pt4 = ll1[2 * i + 1][2 * j + 1];
-
-	    node = ll2[i][j];
-	    for (m = 0; m < M; m++)
-		node[m] = 0.0;
-
-	    up_ll(pt1, M, alpha, node);
-	    up_ll(pt2, M, alpha, node);
-	    up_ll(pt3, M, alpha, node);
-	    up_ll(pt4, M, alpha, node);
-	}
+    d.ll1 = ll1;
+    d.ll2 = ll2;
+    d.xmin = region2->xmin;
+    d.xmax = region2->xmax;
+    d.M = M;
+    d.alpha = alpha;
+    G_parallel_for(region2->ymin, region2->ymax, 0, decimate_rows, &d);
 
     if (wflag) {
 	for (i = region2->ymin; i < region2->ymax; i++) {
@@ -117,8 +145,8 @@ static void up_ll(LIKELIHOOD * pt1,	/* array of log likelihood values, pt1[class
 		  int M, double alpha, LIKELIHOOD * pt2	/* array of log likelihood values, pt2[class] */
     )
 {
-    static int m;
-    static double sum, max, cprob[256];
+    int m;
+    double sum, max, cprob[256];
 
     if (alpha != 1.0) {
 	max = pt1[0];
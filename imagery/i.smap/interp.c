@@ -19,6 +19,26 @@ void MLE(unsigned char **, LIKELIHOOD ***, struct Region *, int, float **);
 static int up_char(int, int, struct Region *, unsigned char **,
 		   unsigned char **);
 
+struct interp
+{
+    unsigned char **sf1, **sf2;
+    struct Region *region;
+    LIKELIHOOD ***ll;
+    int M, period;
+    double (*log_tbl)[3][2];
+    double *N_row;		/* NULL without transition statistics */
+    float **goodness;
+};
+
+struct mle
+{
+    unsigned char **sf;
+    LIKELIHOOD ***ll;
+    int xmin, xmax;
+    int M;
+    float **goodness;
+};
+
 
 void seq_MAP(unsigned char ***sf_pym,	/* pyramid of segmentations */
 	     struct Region *region,	/* specifies image subregion */
@@ -189,34 +209,27 @@ static void print_alpha(
 }
 
 
-static void interp(
-		      /* Estimates finer resolution segmentation from coarser resolution
-		         segmentation and texture statistics. */
-		      unsigned char **sf1,	/* finer resolution segmentation */
-		      struct Region *region,	/* image region */
-		      unsigned char **sf2,	/* coarser resolution segmentation */
-		      LIKELIHOOD *** ll,	/* Log likelihood ll[i][j][class] */
-		      int M,	/* number of classes */
-		      double *alpha,	/* transition probability parameters; alpha[3] */
-		      int period,	/* sampling period of interpolation */
-		      double ***N,	/* transition probability statistics; N[2][3][2] */
-		      int statflag,	/* compute transition statistics if == 1 */
-		      float **goodness  /* cost of best class */
-    )
+/* classify the sampled rows first to last - 1; the coarser segmentation
+ * and the log likelihoods are shared and only read, each row of the
+ * finer segmentation and of the statistics is written by one thread */
+static void interp_rows(int first, int last, void *closure)
 {
-    int i, j;			/* pixel index */
+    const struct interp *ip = closure;
+    struct Region *region = ip->region;
+    LIKELIHOOD ***ll = ip->ll;
+    int M = ip->M;
+    int i, r;			/* pixel row index, sampled row index */
+    int j;			/* pixel column index */
     int m;			/* class index */
-    int bflag;			/* boundary flag */
     int nn0, nn1, nn2;		/* transition counts */
+    int bflag;			/* boundary flag */
     int *n0, *n1, *n2;		/* transition counts for each possible pixel class */
     unsigned char *nbr[8];	/* pointers to neighbors at courser resolution */
     double cost, mincost;	/* cost of class selection; minimum cost */
     int best = 0;		/* class of minimum cost selection */
-    double Constant, tmp;
     double *pdf;		/* propability density function of class selections */
     double Z;			/* normalizing costant for pdf */
-    double alpha0, alpha1, alpha2;	/* transition probabilities */
-    double log_tbl[2][3][2];	/* log of transition probability */
+    double *Nr;
 
     /* allocate memory for pdf */
     pdf = (double *)G_malloc(M * sizeof(double));
@@ -224,51 +237,32 @@ static void interp(
     n1 = (int *)G_malloc(M * sizeof(int));
     n2 = (int *)G_malloc(M * sizeof(int));
 
-    /* set constants */
-    alpha0 = alpha[0];
-    alpha1 = alpha[1];
-    alpha2 = alpha[2];
-    Constant = (1 - alpha0 - 2 * alpha1 - alpha2) / M;
-    if (Constant < 0)
-	G_fatal_error(_("Invalid parameter values"));
-
-    /* precompute logs and zero static vector */
-    for (nn0 = 0; nn0 < 2; nn0++)
-	for (nn1 = 0; nn1 < 3; nn1++)
-	    for (nn2 = 0; nn2 < 2; nn2++) {
-		tmp = (alpha0 * nn0 + alpha1 * nn1 + alpha2 * nn2) + Constant;
-		if (tmp == 0)
-		    log_tbl[nn0][nn1][nn2] = HUGE_VAL;
-		else
-		    log_tbl[nn0][nn1][nn2] = -log(tmp);
-		if (statflag)
-		    N[nn0][nn1][nn2] = 0;
-	    }
+    for (r = first; r < last; r++) {
+	i = region->ymin + r * ip->period;
+	Nr = ip->N_row ? ip->N_row + (size_t)r * 12 : NULL;
 
-    /* classify points and compute expectation of N */
-    for (i = region->ymin; i < region->ymax; i += period)
-	for (j = region->xmin; j < region->xmax; j += period) {
+	for (j = region->xmin; j < region->xmax; j += ip->period) {
 	    /* compute minimum cost class */
 	    mincost = HUGE_VAL;
-	    bflag = up_char(i, j, region, sf2, nbr);
+	    bflag = up_char(i, j, region, ip->sf2, nbr);
 	    for (m = 0; m < M; m++) {
 		nn0 = n0[m] = (m == (*nbr[0]));
 		nn1 = n1[m] = (m == (*nbr[1])) + (m == (*nbr[2]));
 		nn2 = n2[m] = (m == (*nbr[3]));
 
-		pdf[m] = cost = log_tbl[nn0][nn1][nn2] - ll[i][j][m];
+		pdf[m] = cost = ip->log_tbl[nn0][nn1][nn2] - ll[i][j][m];
 		if (cost < mincost) {
 		    mincost = cost;
 		    best = m;
 		}
 	    }
-	    sf1[i][j] = best;
+	    ip->sf1[i][j] = best;
 	    /* save cost as best fit indicator */
-	    if (goodness)
-		goodness[i][j] = mincost;
+	    if (ip->goodness)
+		ip->goodness[i][j] = mincost;
 
 	    /* if not on boundary, compute expectation of N */
-	    if ((!bflag) && (statflag)) {
+	    if ((!bflag) && Nr) {
 		Z = 0.0;
 		for (m = 0; m < M; m++) {
 		    if (pdf[m] == HUGE_VAL)
@@ -278,9 +272,10 @@ static void interp(
 		    Z += pdf[m];
 		}
 		for (m = 0; m < M; m++)
-		    N[n0[m]][n1[m]][n2[m]] += pdf[m] / Z;
+		    Nr[(n0[m] * 3 + n1[m]) * 2 + n2[m]] += pdf[m] / Z;
 	    }
 	}
+    }
 
     G_free((char *)pdf);
     G_free((char *)n0);
@@ -288,33 +283,124 @@ static void interp(
     G_free((char *)n2);
 }
 
-void MLE(			/* computes maximum likelihood classification */
-	    unsigned char **sf,	/* segmentation classes */
-	    LIKELIHOOD *** ll,	/* texture statistics */
-	    struct Region *region,	/* image region */
-	    int M,		/* number of classes */
-	    float **goodness    /* goodness of fit */
+static void interp(
+		      /* Estimates finer resolution segmentation from coarser resolution
+		         segmentation and texture statistics. */
+		      unsigned char **sf1,	/* finer resolution segmentation */
+		      struct Region *region,	/* image region */
+		      unsigned char **sf2,	/* coarser resolution segmentation */
+		      LIKELIHOOD *** ll,	/* Log likelihood ll[i][j][class] */
+		      int M,	/* number of classes */
+		      double *alpha,	/* transition probability parameters; alpha[3] */
+		      int period,	/* sampling period of interpolation */
+		      double ***N,	/* transition probability statistics; N[2][3][2] */
+		      int statflag,	/* compute transition statistics if == 1 */
+		      float **goodness  /* cost of best class */
     )
 {
+    int r;			/* sampled row index */
+    int nrows;			/* number of sampled rows */
+    int nn0, nn1, nn2;		/* transition counts */
+    double Constant, tmp;
+    double alpha0, alpha1, alpha2;	/* transition probabilities */
+    double log_tbl[2][3][2];	/* log of transition probability */
+    double *N_row = NULL;	/* expectation of N of each sampled row */
+    struct interp ip;
+
+    /* set constants */
+    alpha0 = alpha[0];
+    alpha1 = alpha[1];
+    alpha2 = alpha[2];
+    Constant = (1 - alpha0 - 2 * alpha1 - alpha2) / M;
+    if (Constant < 0)
+	G_fatal_error(_("Invalid parameter values"));
+
+    /* precompute logs and zero static vector */
+    for (nn0 = 0; nn0 < 2; nn0++)
+	for (nn1 = 0; nn1 < 3; nn1++)
+	    for (nn2 = 0; nn2 < 2; nn2++) {
+		tmp = (alpha0 * nn0 + alpha1 * nn1 + alpha2 * nn2) + Constant;
+		if (tmp == 0)
+		    log_tbl[nn0][nn1][nn2] = HUGE_VAL;
+		else
+		    log_tbl[nn0][nn1][nn2] = -log(tmp);
+		if (statflag)
+		    N[nn0][nn1][nn2] = 0;
+	    }
+
+    /* the expectation of N is summed by rows, in the order of the rows
+     * in the end, thus it does not depend on the number of threads */
+    nrows = (region->ymax - region->ymin + period - 1) / period;
+    if (statflag)
+	N_row = (double *)G_calloc((size_t)nrows * 12, sizeof(double));
+
+    /* classify points and compute expectation of N */
+    ip.sf1 = sf1;
+    ip.sf2 = sf2;
+    ip.region = region;
+    ip.ll = ll;
+    ip.M = M;
+    ip.period = period;
+    ip.log_tbl = log_tbl;
+    ip.N_row = N_row;
+    ip.goodness = goodness;
+    G_parallel_for(0, nrows, 0, interp_rows, &ip);
+
+    if (statflag) {
+	for (r = 0; r < nrows; r++)
+	    for (nn0 = 0; nn0 < 2; nn0++)
+		for (nn1 = 0; nn1 < 3; nn1++)
+		    for (nn2 = 0; nn2 < 2; nn2++)
+			N[nn0][nn1][nn2] +=
+			    N_row[(size_t)r * 12 + (nn0 * 3 + nn1) * 2 + nn2];
+	G_free(N_row);
+    }
+}
+
+/* classify the rows first to last - 1; ll is shared and only read, each
+ * row of sf and goodness is written by one thread */
+static void mle_rows(int first, int last, void *closure)
+{
+    const struct mle *ml = closure;
+    LIKELIHOOD ***ll = ml->ll;
     int i, j, m, best;
     double max;
 
-    for (i = region->ymin; i < region->ymax; i++)
-	for (j = region->xmin; j < region->xmax; j++) {
+    for (i = first; i < last; i++)
+	for (j = ml->xmin; j < ml->xmax; j++) {
 	    max = ll[i][j][0];
 	    best = 0;
-	    for (m = 1; m < M; m++) {
+	    for (m = 1; m < ml->M; m++) {
 		if (max < ll[i][j][m]) {
 		    max = ll[i][j][m];
 		    best = m;
 		}
 	    }
-	    sf[i][j] = best;
-	    if (goodness)
-		goodness[i][j] = max;
+	    ml->sf[i][j] = best;
+	    if (ml->goodness)
+		ml->goodness[i][j] = max;
 	}
 }
 
+void MLE(			/* computes maximum likelihood classification */
+	    unsigned char **sf,	/* segmentation classes */
+	    LIKELIHOOD *** ll,	/* texture statistics */
+	    struct Region *region,	/* image region */
+	    int M,		/* number of classes */
+	    float **goodness    /* goodness of fit */
+    )
+{
+    struct mle ml;
+
+    ml.sf = sf;
+    ml.ll = ll;
+    ml.xmin = region->xmin;
+    ml.xmax = region->xmax;
+    ml.M = M;
+    ml.goodness = goodness;
+    G_parallel_for(region->ymin, region->ymax, 0, mle_rows, &ml);
+}
+
 
 static int up_char(
 		      /* Computes list of pointers to nieghbors at next coarser resolution. *
@@ -325,10 +411,10 @@ static int up_char(
 		      unsigned char **pt	/* list of pointers */
     )
 {
-    static int xmax, ymax;
-    static int bflag;		/* =1 when on boundary */
-    static int i2, j2;		/* base indices at coarser level */
-    static int di, dj;		/* displacements at coarser level */
+    int xmax, ymax;
+    int bflag;			/* =1 when on boundary */
+    int i2, j2;			/* base indices at coarser level */
+    int di, dj;			/* displacements at coarser level */
 
     /* create new xmax and ymax */
     xmax = region->xmax;
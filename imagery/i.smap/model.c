@@ -71,19 +71,30 @@ void extract_init(struct SigSet *S)
 }
 
 
-void extract(DCELL *** img,	/* multispectral image, img[band][i][j] */
-	     struct Region *region,	/* region to extract */
-	     LIKELIHOOD *** ll,	/* log likelihood, ll[i][j][class] */
-	     struct SigSet *S	/* class signatures */
-    )
+struct extract
+{
+    DCELL ***img;
+    LIKELIHOOD ***ll;
+    struct SigSet *S;
+    int xmin, xmax;
+    int max_nsubclasses;
+};
+
+/* compute the log likelihoods of the rows first to last - 1; the image
+ * and signatures are shared and only read, each row of ll is written by
+ * one thread */
+static void extract_rows(int first, int last, void *closure)
 {
-    int i, j;			/* column and row indexes */
+    const struct extract *e = closure;
+    DCELL ***img = e->img;
+    LIKELIHOOD ***ll = e->ll;
+    struct SigSet *S = e->S;
+    int nbands = S->nbands;
+    int i, j;			/* row and column index */
     int m;			/* class index */
     int k;			/* subclass index */
     int b1, b2;			/* spectral index */
     int no_data;		/* no data flag */
-    int max_nsubclasses;	/* maximum number of subclasses */
-    int nbands;			/* number of spectral bands */
     double *subll;		/* log likelihood of subclasses */
     double *diff;
     double maxlike = 0.0L;
@@ -91,23 +102,12 @@ void extract(DCELL *** img,	/* multispectral image, img[band][i][j] */
     struct ClassSig *C;
     struct SubSig *SubS;
 
-    nbands = S->nbands;
-
-    /* determine the maximum number of subclasses */
-    max_nsubclasses = 0;
-    for (m = 0; m < S->nclasses; m++)
-	if (S->ClassSig[m].nsubclasses > max_nsubclasses)
-	    max_nsubclasses = S->ClassSig[m].nsubclasses;
-
     /* allocate memory */
     diff = (double *)G_malloc(nbands * sizeof(double));
-    subll = (double *)G_malloc(max_nsubclasses * sizeof(double));
+    subll = (double *)G_malloc(e->max_nsubclasses * sizeof(double));
 
-    /* Compute log likelihood at each pixel and for every class. */
-
-    /* for each pixel */
-    for (i = region->ymin; i < region->ymax; i++)
-	for (j = region->xmin; j < region->xmax; j++) {
+    for (i = first; i < last; i++)
+	for (j = e->xmin; j < e->xmax; j++) {
 
 	    /* Check for no data condition */
 	    no_data = 1;
@@ -164,6 +164,32 @@ void extract(DCELL *** img,	/* multispectral image, img[band][i][j] */
 		}
 	    }
 	}
+
     G_free((char *)diff);
     G_free((char *)subll);
 }
+
+void extract(DCELL *** img,	/* multispectral image, img[band][i][j] */
+	     struct Region *region,	/* region to extract */
+	     LIKELIHOOD *** ll,	/* log likelihood, ll[i][j][class] */
+	     struct SigSet *S	/* class signatures */
+    )
+{
+    int m;			/* class index */
+    struct extract e;
+
+    e.img = img;
+    e.ll = ll;
+    e.S = S;
+    e.xmin = region->xmin;
+    e.xmax = region->xmax;
+
+    /* determine the maximum number of subclasses */
+    e.max_nsubclasses = 0;
+    for (m = 0; m < S->nclasses; m++)
+	if (S->ClassSig[m].nsubclasses > e.max_nsubclasses)
+	    e.max_nsubclasses = S->ClassSig[m].nsubclasses;
+
+    /* Compute log likelihood at each pixel and for every class. */
+    G_parallel_for(region->ymin, region->ymax, 0, extract_rows, &e);
+}
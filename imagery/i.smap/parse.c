@@ -8,7 +8,7 @@
 int parse(int argc, char *argv[], struct parms *parms)
 {
     struct Option *group, *subgroup, *sigfile, *output, *goodness;
-    struct Option *blocksize;
+    struct Option *blocksize, *nprocs;
     struct Flag *ml;
 
     group = G_define_standard_option(G_OPT_I_GROUP);
@@ -39,6 +39,8 @@ int parse(int argc, char *argv[], struct parms *parms)
     blocksize->type = TYPE_INTEGER;
     blocksize->answer = "1024";
 
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     ml = G_define_flag();
     ml->key = 'm';
     ml->description =
@@ -47,6 +49,8 @@ int parse(int argc, char *argv[], struct parms *parms)
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs);
+
     parms->ml = ml->answer;
 
     parms->output_map = output->answer;
@@ -19,11 +19,30 @@
 #include "bouman.h"
 #include "region.h"
 
+/* block buffers of one thread */
+struct block_buf
+{
+    DCELL ***img;		/* multispectral image, img[band][i][j] */
+    LIKELIHOOD ****ll_pym;	/* pyramid of log likelihoods */
+    double *alpha_dec;		/* class transition probabilities */
+    int xoffset[21], yoffset[21];	/* pointer offsets, ll_pym and img */
+};
 
-static void init_reg(struct Region *, int, int, int);
-static int increment_reg(struct Region *, int, int, int);
-static int shift_img(DCELL ***, int, struct Region *, int);
-static int shift_ll(LIKELIHOOD ****, struct Region *, int);
+/* the blocks of a round of blocks */
+struct round
+{
+    struct block_buf *bufs;	/* per block */
+    struct Region *regions;
+    unsigned char ***sf_pym;
+    float **goodness;
+    struct SigSet *S;
+    int ml, D;
+};
+
+static void segment_round(int, int, void *);
+static void set_reg(struct Region *, int, int, int, int, int);
+static void shift_img(DCELL ***, int, struct Region *, int, int *, int *);
+static void shift_ll(LIKELIHOOD ****, struct Region *, int, int *, int *);
 
 
 int segment(struct SigSet *S,	/* class parameters */
@@ -32,18 +51,18 @@ int segment(struct SigSet *S,	/* class parameters */
     int block_size;		/* size of subregion blocks */
     int ml;			/* max likelihood? */
     
-    DCELL ***img;		/* multispectral image, img[band][i][j] */
-    int last_row;               
     int wd, ht;			/* image width and height */
-    struct Region region;	/* specifies image subregion */
     int nbands;			/* number of bands */
     int nclasses;		/* number of classes */
-    LIKELIHOOD ****ll_pym;	/* pyramid of log likelihoods */
     unsigned char ***sf_pym;	/* pyramid of segmentations */
     int D;			/* number of levels in pyramid */
     float **goodness;          /* goodness of fit */
-    double *alpha_dec;		/* class transition probabilities */
-    int i;
+    int i, k;
+    int nblock_rows, nblock_cols;	/* number of blocks */
+    int diag, ndiags;		/* anti-diagonal of blocks */
+    int nbufs;			/* number of block buffers */
+    struct block_buf *bufs;
+    struct round rd;
 
     ml = parms->ml;		/* use maxl? */
     block_size = parms->blocksize;
@@ -66,19 +85,37 @@ int segment(struct SigSet *S,	/* class parameters */
     if (nclasses > 256)
 	G_fatal_error(_("Number of classes must be < 256"));
 
-    /* allocate alpha_dec parameters */
     D = levels(block_size, block_size);
-    alpha_dec = (double *)G_malloc(D * sizeof(double));
-
-    /* allocate image block */
-    img =
-	(DCELL ***) multialloc(sizeof(DCELL), 3, nbands, block_size,
-			       block_size);
 
-    /* allocate memory for log likelihood pyramid */
-    ll_pym =
-	(LIKELIHOOD ****) get_cubic_pyramid(block_size, block_size, nclasses,
-					    sizeof(LIKELIHOOD));
+    nblock_cols = (wd + block_size - 1) / block_size;
+    nblock_rows = (ht + block_size - 1) / block_size;
+    ndiags = nblock_rows + nblock_cols - 1;
+
+    /* one set of block buffers for each thread working on a block */
+    nbufs = G_num_workers() + 1;
+    if (nbufs > nblock_rows)
+	nbufs = nblock_rows;
+    if (nbufs > nblock_cols)
+	nbufs = nblock_cols;
+
+    bufs = (struct block_buf *)G_malloc(nbufs * sizeof(struct block_buf));
+    for (i = 0; i < nbufs; i++) {
+	/* allocate alpha_dec parameters */
+	bufs[i].alpha_dec = (double *)G_malloc(D * sizeof(double));
+
+	/* allocate image block */
+	bufs[i].img =
+	    (DCELL ***) multialloc(sizeof(DCELL), 3, nbands, block_size,
+				   block_size);
+
+	/* allocate memory for log likelihood pyramid */
+	bufs[i].ll_pym =
+	    (LIKELIHOOD ****) get_cubic_pyramid(block_size, block_size,
+						nclasses, sizeof(LIKELIHOOD));
+
+	for (k = 0; k <= D + 1; k++)
+	    bufs[i].xoffset[k] = bufs[i].yoffset[k] = 0;
+    }
 
     /* allocate memory for segmentation pyramid */
     sf_pym = (unsigned char ***)get_pyramid(wd, ht, sizeof(char));
@@ -93,116 +130,122 @@ int segment(struct SigSet *S,	/* class parameters */
     else
 	goodness = NULL;
 
-    /* tiled segmentation */
-    init_reg(&region, wd, ht, block_size);
+    rd.bufs = bufs;
+    rd.regions = (struct Region *)G_malloc(nbufs * sizeof(struct Region));
+    rd.sf_pym = sf_pym;
+    rd.goodness = goodness;
+    rd.S = S;
+    rd.ml = ml;
+    rd.D = D;
+
+    /* tiled segmentation
+     *
+     * A block only depends on the segmentations of the blocks to the
+     * left, top and top left at the coarser resolutions, so the blocks
+     * of an anti-diagonal are segmented concurrently, in rounds of one
+     * block per thread. The blocks of a round are read before by the
+     * calling thread. If only one block is processed at a time, the
+     * threads work on the loops within the block instead. */
     extract_init(S);
-    last_row = -1;
-    do {
-	if (last_row != region.ymin)
-	    G_message(_("Processing rows %d-%d (of %d)..."),
-		      region.ymin + 1, region.ymax, ht);
-	last_row = region.ymin;
-	shift_img(img, nbands, &region, block_size);
-	/* this reads grass images into the block defined in region */
-	read_block(img, &region, files);
-
-	shift_ll(ll_pym, &region, block_size);
-	extract(img, &region, ll_pym[0], S);
-
-	if (ml)
-	    MLE(sf_pym[0], ll_pym[0], &region, nclasses, goodness);
-	else {
-	    for (i = 0; i < D; i++)
-		alpha_dec[i] = 1.0;
-	    seq_MAP(sf_pym, &region, ll_pym, nclasses, alpha_dec, goodness);
-	}
+    G_message(_("Processing %d blocks..."), nblock_rows * nblock_cols);
+    for (diag = 0; diag < ndiags; diag++) {
+	int b, nblocks, row0;
 
+	G_percent(diag, ndiags, 2);
 
-    } while (increment_reg(&region, wd, ht, block_size));
+	row0 = diag - nblock_cols + 1;
+	if (row0 < 0)
+	    row0 = 0;
+	nblocks = (diag < nblock_rows ? diag : nblock_rows - 1) - row0 + 1;
 
-    write_img(sf_pym[0], goodness, wd, ht, S, parms, files);
+	for (b = 0; b < nblocks; b += nbufs) {
+	    int n = nblocks - b < nbufs ? nblocks - b : nbufs;
 
-    return 0;
-}
+	    for (i = 0; i < n; i++) {
+		struct block_buf *buf = &bufs[i];
+		struct Region *region = &rd.regions[i];
 
-static void init_reg(struct Region *region, int wd, int ht, int block_size)
-{
-    region->xmin = 0;
-    region->ymin = 0;
+		set_reg(region, row0 + b + i, diag - row0 - b - i, wd, ht,
+			block_size);
 
-    region->xmax = block_size;
-    if (region->xmax > wd)
-	region->xmax = wd;
+		shift_img(buf->img, nbands, region, block_size,
+			  &buf->xoffset[0], &buf->yoffset[0]);
+		/* this reads grass images into the block defined in region */
+		read_block(buf->img, region, files);
 
-    region->ymax = block_size;
-    if (region->ymax > ht)
-	region->ymax = ht;
+		shift_ll(buf->ll_pym, region, block_size, buf->xoffset + 1,
+			 buf->yoffset + 1);
+	    }
 
-    region->free.left = 1;
-    region->free.top = 1;
-    region->free.right = 1;
-    region->free.bottom = 1;
+	    G_parallel_for(0, n, 1, segment_round, &rd);
+	}
+    }
+    G_percent(1, 1, 1);
+    G_free(rd.regions);
+
+    write_img(sf_pym[0], goodness, wd, ht, S, parms, files);
+
+    return 0;
 }
 
-static int increment_reg(struct Region *region, int wd, int ht,
-			 int block_size)
+/* the threads segment the blocks first to last - 1 of a round, each
+ * block in its own buffers; the signatures are shared and only read, a
+ * block writes only its own part of the segmentations and goodness */
+static void segment_round(int first, int last, void *closure)
 {
+    const struct round *rd = closure;
+    int i, level;
 
-    /* shift one block to right */
-    if (region->xmax < wd) {
-	region->xmin = region->xmax;
-	region->xmax = region->xmin + block_size;
-	if (region->xmax > wd)
-	    region->xmax = wd;
-    }
-    else {
-	/* shift one block down */
-	if (region->ymax < ht) {
-	    region->xmin = 0;
-	    region->xmax = region->xmin + block_size;
-	    if (region->xmax > wd)
-		region->xmax = wd;
-
-	    region->ymin = region->ymax;
-	    region->ymax = region->ymax + block_size;
-	    if (region->ymax > ht)
-		region->ymax = ht;
-	}
-	/* finished shifting */
+    for (i = first; i < last; i++) {
+	struct block_buf *buf = &rd->bufs[i];
+	struct Region *region = &rd->regions[i];
+
+	extract(buf->img, region, buf->ll_pym[0], rd->S);
+
+	if (rd->ml)
+	    MLE(rd->sf_pym[0], buf->ll_pym[0], region, rd->S->nclasses,
+		rd->goodness);
 	else {
-	    return (0);
+	    for (level = 0; level < rd->D; level++)
+		buf->alpha_dec[level] = 1.0;
+	    seq_MAP(rd->sf_pym, region, buf->ll_pym, rd->S->nclasses,
+		    buf->alpha_dec, rd->goodness);
 	}
     }
+}
 
-    if (region->xmin == 0)
-	region->free.left = 1;
-    else
-	region->free.left = 0;
+/* set the region of the block in block row brow and block column bcol */
+static void set_reg(struct Region *region, int brow, int bcol, int wd,
+		    int ht, int block_size)
+{
+    region->xmin = bcol * block_size;
+    region->xmax = region->xmin + block_size;
+    if (region->xmax > wd)
+	region->xmax = wd;
 
-    if (region->ymin == 0)
-	region->free.top = 1;
-    else
-	region->free.top = 0;
+    region->ymin = brow * block_size;
+    region->ymax = region->ymin + block_size;
+    if (region->ymax > ht)
+	region->ymax = ht;
 
+    region->free.left = (region->xmin == 0);
+    region->free.top = (region->ymin == 0);
     region->free.right = 1;
     region->free.bottom = 1;
-
-    return (1);
 }
 
-static int shift_img(DCELL *** img, int nbands,
-		     struct Region *region, int block_size)
+static void shift_img(DCELL *** img, int nbands,
+		      struct Region *region, int block_size,
+		      int *xoffset, int *yoffset)
 {
-    static int xoffset = 0;
-    static int yoffset = 0;
     int xdelta;
     int ystart, ystop, ydelta;
     int b, i;
 
-    xdelta = region->xmin - xoffset;
-    ydelta = region->ymin - yoffset;
-    xoffset = region->xmin;
-    yoffset = region->ymin;
+    xdelta = region->xmin - *xoffset;
+    ydelta = region->ymin - *yoffset;
+    *xoffset = region->xmin;
+    *yoffset = region->ymin;
 
     ystart = region->ymin;
     ystop = ystart + block_size;
@@ -212,17 +255,12 @@ static int shift_img(DCELL *** img, int nbands,
 	for (i = ystart; i < ystop; i++)
 	    img[b][i] -= xdelta;
     }
-
-    return 0;
 }
 
-static int shift_ll(LIKELIHOOD **** ll_pym,
-		    struct Region *region, int block_size)
+static void shift_ll(LIKELIHOOD **** ll_pym,
+		     struct Region *region, int block_size,
+		     int *xoffset, int *yoffset)
 {
-    static int first = 1;
-    static int xoffset[20];
-    static int yoffset[20];
-
     int xdelta;
     int ystart, ystop, ydelta;
     int D;
@@ -230,14 +268,6 @@ static int shift_ll(LIKELIHOOD **** ll_pym,
     int block_size_k;
     struct Region region_buff;
 
-    /* if first time, set offsets to 0 */
-    if (first) {
-	D = levels(block_size, block_size);
-	for (k = 0; k <= D; k++)
-	    xoffset[k] = yoffset[k] = 0;
-	first = 0;
-    }
-
     /* save region information */
     copy_reg(region, &region_buff);
 
@@ -262,8 +292,6 @@ static int shift_ll(LIKELIHOOD **** ll_pym,
 
     /* replace region information */
     copy_reg(&region_buff, region);
-
-    return 0;
 }
 
 
@@ -5,7 +5,8 @@ double solve(
 		/* Returns code=0 if signs are opposite.                                */
 		/* Returns code=1 if signs are both positive.                           */
 		/* Returns code=1 if signs are both negative.                           */
-		double (*f) (double),	/* pointer to function to be solved */
+		double (*f) (double, void *),	/* pointer to function to be solved */
+		void *closure,	/* side inputs of the function */
 		double a,	/* minimum value of solution */
 		double b,	/* maximum value of solution */
 		double err,	/* accuarcy of solution */
@@ -16,9 +17,9 @@ double solve(
     double fa, fb, fc, c, signaling_nan();
     double dist;
 
-    fa = (*f) (a);
+    fa = (*f) (a, closure);
     signa = fa > 0;
-    fb = (*f) (b);
+    fb = (*f) (b, closure);
     signb = fb > 0;
 
     /* check starting conditions */
@@ -37,7 +38,7 @@ double solve(
 	dist = -dist;
     while (dist > err) {
 	c = (b + a) / 2;
-	fc = (*f) (c);
+	fc = (*f) (c, closure);
 	signc = fc > 0;
 	if (signa == signc) {
 	    a = c;
@@ -24,6 +24,7 @@
  * Changelog:	 Added EVI on 20080718 (Yann)
  * 		 Added VARI on 20081014 (Yann)
  * 		 Added EVI2 on 20130208 (NikosA)
+ * 		 Several indices from one pass over the bands
  *
  *****************************************************************************/
 
@@ -54,33 +55,197 @@ double ga_ri(double redchan, double nirchan, double bluechan,
 	      double greenchan);
 double va_ri(double redchan, double greenchan, double bluechan);
 
+/* number of rows processed at once by a thread */
+#define BLOCK_ROWS 16
+
+enum
+{
+    BAND_RED,
+    BAND_NIR,
+    BAND_GREEN,
+    BAND_BLUE,
+    BAND_CHAN5,
+    BAND_CHAN7,
+    NUM_BANDS
+};
+
+#define RN ((1 << BAND_RED) | (1 << BAND_NIR))
+#define RNB (RN | (1 << BAND_BLUE))
+#define RGB ((1 << BAND_RED) | (1 << BAND_GREEN) | (1 << BAND_BLUE))
+#define RNGB (RNB | (1 << BAND_GREEN))
+#define ALL ((1 << NUM_BANDS) - 1)
+
+enum
+{
+    VI_ARVI, VI_DVI, VI_EVI, VI_EVI2, VI_GVI, VI_GARI, VI_GEMI, VI_IPVI,
+    VI_MSAVI, VI_MSAVI2, VI_NDVI, VI_PVI, VI_SAVI, VI_SR, VI_VARI, VI_WDVI,
+    NUM_VI
+};
+
+/* in the order of the options of viname */
+static const struct
+{
+    const char *name;
+    int bands;			/* required bands */
+    const char *band_names;
+} vis[NUM_VI] = {
+    {"arvi", RNB, "blue, red and nir"},
+    {"dvi", RN, "red and nir"},
+    {"evi", RNB, "blue, red and nir"},
+    {"evi2", RN, "red and nir"},
+    {"gvi", ALL, "blue, green, red, nir, chan5 and chan7"},
+    {"gari", RNGB, "blue, green, red and nir"},
+    {"gemi", RN, "red and nir"},
+    {"ipvi", RN, "red and nir"},
+    {"msavi", RN, "red and nir"},
+    {"msavi2", RN, "red and nir"},
+    {"ndvi", RN, "red and nir"},
+    {"pvi", RN, "red and nir"},
+    {"savi", RN, "red and nir"},
+    {"sr", RN, "red and nir"},
+    {"vari", RGB, "blue, green and red"},
+    {"wdvi", RN, "red and nir"}
+};
+
+struct block
+{
+    int ncols;
+    DCELL **band[NUM_BANDS];	/* rows of the bands, NULL if not given */
+    int nvi;
+    const int *vi;		/* indices to compute */
+    DCELL ***out;		/* their rows */
+    double msavip[3];		/* soil line parameters of msavi */
+};
+
+/* compute an index for a row, without regard to nulls */
+static void compute_vi(const struct block *blk, int vi, int i, DCELL *out)
+{
+    const DCELL *r = blk->band[BAND_RED][i];
+    const DCELL *n = blk->band[BAND_NIR] ? blk->band[BAND_NIR][i] : NULL;
+    const DCELL *g = blk->band[BAND_GREEN] ? blk->band[BAND_GREEN][i] : NULL;
+    const DCELL *b = blk->band[BAND_BLUE] ? blk->band[BAND_BLUE][i] : NULL;
+    const DCELL *c5 = blk->band[BAND_CHAN5] ? blk->band[BAND_CHAN5][i] : NULL;
+    const DCELL *c7 = blk->band[BAND_CHAN7] ? blk->band[BAND_CHAN7][i] : NULL;
+    int col, ncols = blk->ncols;
+
+    switch (vi) {
+    case VI_ARVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = ar_vi(r[col], n[col], b[col]);
+	break;
+    case VI_DVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = d_vi(r[col], n[col]);
+	break;
+    case VI_EVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = e_vi(b[col], r[col], n[col]);
+	break;
+    case VI_EVI2:
+	for (col = 0; col < ncols; col++)
+	    out[col] = e_vi2(r[col], n[col]);
+	break;
+    case VI_GVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = g_vi(b[col], g[col], r[col], n[col], c5[col], c7[col]);
+	break;
+    case VI_GARI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = ga_ri(r[col], n[col], b[col], g[col]);
+	break;
+    case VI_GEMI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = ge_mi(r[col], n[col]);
+	break;
+    case VI_IPVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = ip_vi(r[col], n[col]);
+	break;
+    case VI_MSAVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = msa_vi(r[col], n[col], blk->msavip[0], blk->msavip[1],
+			      blk->msavip[2]);
+	break;
+    case VI_MSAVI2:
+	for (col = 0; col < ncols; col++)
+	    out[col] = msa_vi2(r[col], n[col]);
+	break;
+    case VI_NDVI:
+	for (col = 0; col < ncols; col++) {
+	    if (r[col] + n[col] < 0.001)
+		Rast_set_d_null_value(&out[col], 1);
+	    else
+		out[col] = nd_vi(r[col], n[col]);
+	}
+	break;
+    case VI_PVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = p_vi(r[col], n[col]);
+	break;
+    case VI_SAVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = sa_vi(r[col], n[col]);
+	break;
+    case VI_SR:
+	for (col = 0; col < ncols; col++)
+	    out[col] = s_r(r[col], n[col]);
+	break;
+    case VI_VARI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = va_ri(r[col], g[col], b[col]);
+	break;
+    case VI_WDVI:
+	for (col = 0; col < ncols; col++)
+	    out[col] = wd_vi(r[col], n[col]);
+	break;
+    }
+}
+
+/* compute the indices for the rows first to last - 1 of a block */
+static void process_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    int i, k, b, col;
+
+    for (i = first; i < last; i++) {
+	for (k = 0; k < blk->nvi; k++)
+	    compute_vi(blk, blk->vi[k], i, blk->out[k][i]);
+
+	/* a null in any of the given bands gives a null */
+	for (b = 0; b < NUM_BANDS; b++) {
+	    const DCELL *in;
+
+	    if (!blk->band[b])
+		continue;
+	    in = blk->band[b][i];
+	    for (col = 0; col < blk->ncols; col++)
+		if (Rast_is_d_null_value(&in[col]))
+		    for (k = 0; k < blk->nvi; k++)
+			Rast_set_d_null_value(&blk->out[k][i][col], 1);
+	}
+    }
+}
+
 int main(int argc, char *argv[])
 {
     int nrows, ncols;
-    int row, col;
-    char *viflag;		/*Switch for particular index */
+    int row, i, k, b;
     char *desc;
     struct GModule *module;
     struct {
         struct Option *viname, *red, *nir, *green, *blue, *chan5,
-            *chan7, *sl_slope, *sl_int, *sl_red, *bits, *output;
+            *chan7, *sl_slope, *sl_int, *sl_red, *bits, *output, *nprocs;
     } opt;
     struct History history;	/*metadata */
     struct Colors colors;	/*Color rules */
 
-    char *result;		/*output raster name */
-    int infd_redchan, infd_nirchan, infd_greenchan;
-    int infd_bluechan, infd_chan5chan, infd_chan7chan;
-    int outfd;
-    char *bluechan, *greenchan, *redchan, *nirchan, *chan5chan, *chan7chan;
-    DCELL *inrast_redchan, *inrast_nirchan, *inrast_greenchan;
-    DCELL *inrast_bluechan, *inrast_chan5chan, *inrast_chan7chan;
-    DCELL *outrast;
-    RASTER_MAP_TYPE data_type_redchan;
-    RASTER_MAP_TYPE data_type_nirchan, data_type_greenchan;
-    RASTER_MAP_TYPE data_type_bluechan;
-    RASTER_MAP_TYPE data_type_chan5chan, data_type_chan7chan;
-    DCELL msavip1, msavip2, msavip3, dnbits;
+    const char *names[NUM_BANDS];
+    int infd[NUM_BANDS];
+    RASTER_MAP_TYPE data_type[NUM_BANDS];
+    int nvi, *vi, *outfd, given;
+    int nprocs, nblock;
+    struct block blk;
+    DCELL scale;
     CELL val1, val2;
 
     G_gisinit(argv[0]);
@@ -102,12 +267,15 @@ int main(int argc, char *argv[])
 	_("Name of input red channel surface reflectance map");
     opt.red->description = _("Range: [0.0;1.0]");
 
-    opt.output = G_define_standard_option(G_OPT_R_OUTPUT);
+    opt.output = G_define_standard_option(G_OPT_R_OUTPUTS);
+    opt.output->description =
+	_("Name for output raster map(s), one for each vegetation index");
 
     opt.viname = G_define_option();
     opt.viname->key = "viname";
     opt.viname->type = TYPE_STRING;
     opt.viname->required = YES;
+    opt.viname->multiple = YES;
     opt.viname->description = _("Type of vegetation index");
     desc = NULL;
     G_asprintf(&desc,
@@ -204,358 +372,164 @@ int main(int argc, char *argv[])
     opt.bits->options = "7,8,10,16";
     opt.bits->answer = "8";
 
+    opt.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
-    viflag = opt.viname->answer;
-    redchan = opt.red->answer;
-    nirchan = opt.nir->answer;
-    greenchan = opt.green->answer;
-    bluechan = opt.blue->answer;
-    chan5chan = opt.chan5->answer;
-    chan7chan = opt.chan7->answer;
-    if(opt.sl_slope->answer)
-        msavip1 = atof(opt.sl_slope->answer);
-    if(opt.sl_int->answer)
-        msavip2 = atof(opt.sl_int->answer);
-    if(opt.sl_red->answer)
-        msavip3 = atof(opt.sl_red->answer);
-    if(opt.bits->answer)
-        dnbits = atof(opt.bits->answer);
-    result = opt.output->answer;
-    G_verbose_message(_("Calculating %s..."), viflag);
-
-    if (!strcasecmp(viflag, "sr") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("sr index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "ndvi") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("ndvi index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "ipvi") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("ipvi index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "dvi") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("dvi index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "pvi") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("pvi index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "wdvi") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("wdvi index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "savi") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("savi index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "msavi") && (!(opt.red->answer) || !(opt.nir->answer) || 
-                                          !(opt.sl_slope->answer) || !(opt.sl_int->answer) || 
-                                          !(opt.sl_red->answer)) )
-	G_fatal_error(_("msavi index requires red and nir maps, and 3 parameters related to soil line"));
-
-    if (!strcasecmp(viflag, "msavi2") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("msavi2 index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "gemi") && (!(opt.red->answer) || !(opt.nir->answer)) )
-	G_fatal_error(_("gemi index requires red and nir maps"));
-
-    if (!strcasecmp(viflag, "arvi") && (!(opt.red->answer) || !(opt.nir->answer)
-                || !(opt.blue->answer)) )
-	G_fatal_error(_("arvi index requires blue, red and nir maps"));
-
-    if (!strcasecmp(viflag, "evi") && (!(opt.red->answer) || !(opt.nir->answer)
-                || !(opt.blue->answer)) )
-	G_fatal_error(_("evi index requires blue, red and nir maps"));
-
-	if (!strcasecmp(viflag, "evi2") && (!(opt.red->answer) || !(opt.nir->answer) ) )
-	G_fatal_error(_("evi2 index requires red and nir maps"));
-	
-    if (!strcasecmp(viflag, "vari") && (!(opt.red->answer) || !(opt.green->answer)
-                || !(opt.blue->answer)) )
-	G_fatal_error(_("vari index requires blue, green and red maps"));
-
-    if (!strcasecmp(viflag, "gari") && (!(opt.red->answer) || !(opt.nir->answer)
-                || !(opt.green->answer) || !(opt.blue->answer)) )
-	G_fatal_error(_("gari index requires blue, green, red and nir maps"));
-
-    if (!strcasecmp(viflag, "gvi") && (!(opt.red->answer) || !(opt.nir->answer)
-                || !(opt.green->answer) || !(opt.blue->answer)
-                || !(opt.chan5->answer) || !(opt.chan7->answer)) )
-	G_fatal_error(_("gvi index requires blue, green, red, nir, chan5 and chan7 maps"));
-
-    infd_redchan = Rast_open_old(redchan, "");
-    data_type_redchan = Rast_map_type(redchan, "");
-    inrast_redchan = Rast_allocate_buf(data_type_redchan);
-
-    if (nirchan) {
-        infd_nirchan = Rast_open_old(nirchan, "");
-        data_type_nirchan = Rast_map_type(nirchan, "");
-        inrast_nirchan = Rast_allocate_buf(data_type_nirchan);
-    }
-
-    if (greenchan) {
-        infd_greenchan = Rast_open_old(greenchan, "");
-        data_type_greenchan = Rast_map_type(greenchan, "");
-        inrast_greenchan = Rast_allocate_buf(data_type_greenchan);
-    }
-
-    if (bluechan) {
-        infd_bluechan = Rast_open_old(bluechan, "");
-        data_type_bluechan = Rast_map_type(bluechan, "");
-        inrast_bluechan = Rast_allocate_buf(data_type_bluechan);
+    names[BAND_RED] = opt.red->answer;
+    names[BAND_NIR] = opt.nir->answer;
+    names[BAND_GREEN] = opt.green->answer;
+    names[BAND_BLUE] = opt.blue->answer;
+    names[BAND_CHAN5] = opt.chan5->answer;
+    names[BAND_CHAN7] = opt.chan7->answer;
+    given = 0;
+    for (b = 0; b < NUM_BANDS; b++)
+	if (names[b])
+	    given |= 1 << b;
+
+    for (nvi = 0; opt.viname->answers[nvi]; nvi++) ;
+    for (i = 0; opt.output->answers[i]; i++) ;
+    if (i != nvi)
+	G_fatal_error(_("The number of output maps (%d) differs from the "
+			"number of vegetation indices (%d)"), i, nvi);
+
+    vi = G_malloc(nvi * sizeof(int));
+    for (k = 0; k < nvi; k++) {
+	const char *name = opt.viname->answers[k];
+
+	for (i = 0; i < NUM_VI; i++)
+	    if (!strcasecmp(name, vis[i].name))
+		break;
+	vi[k] = i;
+
+	if ((vis[i].bands & given) != vis[i].bands)
+	    G_fatal_error(_("%s index requires %s maps"), vis[i].name,
+			  vis[i].band_names);
+	if (i == VI_MSAVI && (!opt.sl_slope->answer || !opt.sl_int->answer ||
+			      !opt.sl_red->answer))
+	    G_fatal_error(_("msavi index requires red and nir maps, and 3 parameters related to soil line"));
+	G_check_input_output_name(names[BAND_RED], opt.output->answers[k],
+				  G_FATAL_EXIT);
     }
 
-    if (chan5chan) {
-        infd_chan5chan = Rast_open_old(chan5chan, "");
-        data_type_chan5chan = Rast_map_type(chan5chan, "");
-        inrast_chan5chan = Rast_allocate_buf(data_type_chan5chan);
-    }
+    if (opt.sl_slope->answer)
+	blk.msavip[0] = atof(opt.sl_slope->answer);
+    if (opt.sl_int->answer)
+	blk.msavip[1] = atof(opt.sl_int->answer);
+    if (opt.sl_red->answer)
+	blk.msavip[2] = atof(opt.sl_red->answer);
+    /* digital numbers are scaled to [0;1] */
+    scale = 1.0;
+    if (opt.bits->answer)
+	scale = 1.0 / (pow(2, atof(opt.bits->answer)) - 1);
 
-    if (chan7chan) {
-        infd_chan7chan = Rast_open_old(chan7chan, "");
-        data_type_chan7chan = Rast_map_type(chan7chan, "");
-        inrast_chan7chan = Rast_allocate_buf(data_type_chan7chan);
-    }
+    nprocs = G_set_nprocs(opt.nprocs);
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
 
     nrows = Rast_window_rows();
     ncols = Rast_window_cols();
 
+    blk.ncols = ncols;
+    for (b = 0; b < NUM_BANDS; b++) {
+	blk.band[b] = NULL;
+	if (!names[b])
+	    continue;
+	infd[b] = Rast_open_old(names[b], "");
+	data_type[b] = Rast_map_type(names[b], "");
+	blk.band[b] = G_malloc(nblock * sizeof(DCELL *));
+	for (i = 0; i < nblock; i++)
+	    blk.band[b][i] = Rast_allocate_d_buf();
+    }
+
     /* Create New raster files */
-    outfd = Rast_open_new(result, DCELL_TYPE);
-    outrast = Rast_allocate_d_buf();
-
-    /* Process pixels */
-    for (row = 0; row < nrows; row++)
-    {
-	DCELL d_bluechan;
-	DCELL d_greenchan;
-	DCELL d_redchan;
-	DCELL d_nirchan;
-	DCELL d_chan5chan;
-	DCELL d_chan7chan;
+    blk.nvi = nvi;
+    blk.vi = vi;
+    blk.out = G_malloc(nvi * sizeof(DCELL **));
+    outfd = G_malloc(nvi * sizeof(int));
+    for (k = 0; k < nvi; k++) {
+	G_verbose_message(_("Calculating %s..."), vis[vi[k]].name);
+	outfd[k] = Rast_open_new(opt.output->answers[k], DCELL_TYPE);
+	blk.out[k] = G_malloc(nblock * sizeof(DCELL *));
+	for (i = 0; i < nblock; i++)
+	    blk.out[k][i] = Rast_allocate_d_buf();
+    }
+
+    /* Process pixels, the rows of a block are read once for all the
+       indices and processed in parallel */
+    for (row = 0; row < nrows; row += nblock) {
+	int n = nrows - row < nblock ? nrows - row : nblock;
 
 	G_percent(row, nrows, 2);
 
 	/* read input maps */
-	Rast_get_row(infd_redchan,inrast_redchan,row,data_type_redchan);
-	if (nirchan) {
-	    Rast_get_row(infd_nirchan,inrast_nirchan,row,data_type_nirchan);
-	}
-	if (bluechan) {
-	    Rast_get_row(infd_bluechan,inrast_bluechan,row,data_type_bluechan);
-	}
-	if (greenchan) {
-	    Rast_get_row(infd_greenchan,inrast_greenchan,row,data_type_greenchan);
-	}
-	if (chan5chan) {
-	    Rast_get_row(infd_chan5chan,inrast_chan5chan,row,data_type_chan5chan);
-	}
-	if (chan7chan) {
-	    Rast_get_row(infd_chan7chan,inrast_chan7chan,row,data_type_chan7chan);
-	}
-	/* process the data */
-	for (col = 0; col < ncols; col++)
-	{
-	    switch(data_type_redchan){
-		    case CELL_TYPE:
-			d_redchan   = (double) ((CELL *) inrast_redchan)[col];
-			if(opt.bits->answer)
-				d_redchan *= 1.0/(pow(2,dnbits)-1);	
-			break;
-		    case FCELL_TYPE:
-			d_redchan   = (double) ((FCELL *) inrast_redchan)[col];
-			break;
-		    case DCELL_TYPE:
-			d_redchan   = ((DCELL *) inrast_redchan)[col];
-			break;
-	    }
-	    if (nirchan) {
-		switch(data_type_nirchan){
-		    case CELL_TYPE:
-			d_nirchan   = (double) ((CELL *) inrast_nirchan)[col];
-			if(opt.bits->answer)
-				d_nirchan *= 1.0/(pow(2,dnbits)-1);	
-			break;
-		    case FCELL_TYPE:
-			d_nirchan   = (double) ((FCELL *) inrast_nirchan)[col];
-			break;
-		    case DCELL_TYPE:
-			d_nirchan   = ((DCELL *) inrast_nirchan)[col];
-			break;
-		}
+	for (b = 0; b < NUM_BANDS; b++) {
+	    if (!names[b])
+		continue;
+	    for (i = 0; i < n; i++) {
+		DCELL *in = blk.band[b][i];
+		int col;
+
+		Rast_get_d_row(infd[b], in, row + i);
+		if (data_type[b] != CELL_TYPE || scale == 1.0)
+		    continue;
+		for (col = 0; col < ncols; col++)
+		    if (!Rast_is_d_null_value(&in[col]))
+			in[col] *= scale;
 	    }
-	    if (greenchan) {
-		switch(data_type_greenchan){
-		    case CELL_TYPE:
-			d_greenchan   = (double) ((CELL *) inrast_greenchan)[col];
-			if(opt.bits->answer)
-				d_greenchan *= 1.0/(pow(2,dnbits)-1);	
-			break;
-		    case FCELL_TYPE:
-			d_greenchan   = (double) ((FCELL *) inrast_greenchan)[col];
-			break;
-		    case DCELL_TYPE:
-			d_greenchan   = ((DCELL *) inrast_greenchan)[col];
-			break;
-		}
-	    }
-	    if (bluechan) {
-		switch(data_type_bluechan){
-		    case CELL_TYPE:
-			d_bluechan   = (double) ((CELL *) inrast_bluechan)[col];
-			if(opt.bits->answer)
-				d_bluechan *= 1.0/(pow(2,dnbits)-1);	
-			break;
-		    case FCELL_TYPE:
-			d_bluechan   = (double) ((FCELL *) inrast_bluechan)[col];
-			break;
-		    case DCELL_TYPE:
-			d_bluechan   = ((DCELL *) inrast_bluechan)[col];
-			break;
-		}
-	    }
-	    if (chan5chan) {
-		switch(data_type_chan5chan){
-		    case CELL_TYPE:
-			d_chan5chan   = (double) ((CELL *) inrast_chan5chan)[col];
-			if(opt.bits->answer)
-				d_chan5chan *= 1.0/(pow(2,dnbits)-1);	
-			break;
-		    case FCELL_TYPE:
-			d_chan5chan   = (double) ((FCELL *) inrast_chan5chan)[col];
-			break;
-		    case DCELL_TYPE:
-			d_chan5chan   = ((DCELL *) inrast_chan5chan)[col];
-			break;
-		}
-	    }
-	    if (chan7chan) {
-		switch(data_type_chan7chan){
-		    case CELL_TYPE:
-			d_chan7chan   = (double) ((CELL *) inrast_chan7chan)[col];
-			if(opt.bits->answer)
-				d_chan7chan *= 1.0/(pow(2,dnbits)-1);	
-			break;
-		    case FCELL_TYPE:
-			d_chan7chan   = (double) ((FCELL *) inrast_chan7chan)[col];
-			break;
-		    case DCELL_TYPE:
-			d_chan7chan   = ((DCELL *) inrast_chan7chan)[col];
-			break;
-		}
-	    }
-
-	    if (Rast_is_d_null_value(&d_redchan) ||
-		((nirchan) && Rast_is_d_null_value(&d_nirchan)) ||
-		((greenchan) && Rast_is_d_null_value(&d_greenchan)) ||
-		((bluechan) && Rast_is_d_null_value(&d_bluechan)) ||
-		((chan5chan) && Rast_is_d_null_value(&d_chan5chan)) ||
-		((chan7chan) && Rast_is_d_null_value(&d_chan7chan))) {
-		Rast_set_d_null_value(&outrast[col], 1);
-	    }
-	    else {
-		/* calculate simple_ratio        */
-		if (!strcasecmp(viflag, "sr"))
-		    outrast[col] = s_r(d_redchan, d_nirchan);
-
-		/* calculate ndvi                    */
-		if (!strcasecmp(viflag, "ndvi")) {
-		    if (d_redchan + d_nirchan < 0.001)
-			Rast_set_d_null_value(&outrast[col], 1);
-		    else
-			outrast[col] = nd_vi(d_redchan, d_nirchan);
-		}
-
-		if (!strcasecmp(viflag, "ipvi"))
-		    outrast[col] = ip_vi(d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "dvi"))
-		    outrast[col] = d_vi(d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "evi"))
-		    outrast[col] = e_vi(d_bluechan, d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "evi2"))
-		    outrast[col] = e_vi2(d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "pvi"))
-		    outrast[col] = p_vi(d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "wdvi"))
-		    outrast[col] = wd_vi(d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "savi"))
-		    outrast[col] = sa_vi(d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "msavi"))
-		    outrast[col] = msa_vi(d_redchan, d_nirchan, msavip1, msavip2, msavip3);
-
-		if (!strcasecmp(viflag, "msavi2"))
-		    outrast[col] = msa_vi2(d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "gemi"))
-		    outrast[col] = ge_mi(d_redchan, d_nirchan);
-
-		if (!strcasecmp(viflag, "arvi"))
-		    outrast[col] = ar_vi(d_redchan, d_nirchan, d_bluechan);
-
-		if (!strcasecmp(viflag, "gvi"))
-		    outrast[col] = g_vi(d_bluechan, d_greenchan, d_redchan, d_nirchan, d_chan5chan, d_chan7chan);
+	}
 
-		if (!strcasecmp(viflag, "gari"))
-		    outrast[col] = ga_ri(d_redchan, d_nirchan, d_bluechan, d_greenchan);
+	/* process the data */
+	G_parallel_for(0, n, BLOCK_ROWS, process_rows, &blk);
 
-		if (!strcasecmp(viflag, "vari"))
-		    outrast[col] = va_ri(d_redchan, d_greenchan, d_bluechan);
-	    }
-	}
-	Rast_put_d_row(outfd, outrast);
+	for (k = 0; k < nvi; k++)
+	    for (i = 0; i < n; i++)
+		Rast_put_d_row(outfd[k], blk.out[k][i]);
     }
     G_percent(1, 1, 1);
-      
-    G_free(inrast_redchan);
-    Rast_close(infd_redchan);
-    if (nirchan) {
-    	G_free(inrast_nirchan);
-    	Rast_close(infd_nirchan);
-    }
-    if (greenchan) {
-	G_free(inrast_greenchan);
-	Rast_close(infd_greenchan);
-    }
-    if (bluechan) {
-	G_free(inrast_bluechan);
-	Rast_close(infd_bluechan);
-    }
-    if (chan5chan) {
-	G_free(inrast_chan5chan);
-	Rast_close(infd_chan5chan);
-    }
-    if (chan7chan) {
-	G_free(inrast_chan7chan);
-	Rast_close(infd_chan7chan);
+
+    for (b = 0; b < NUM_BANDS; b++) {
+	if (!names[b])
+	    continue;
+	for (i = 0; i < nblock; i++)
+	    G_free(blk.band[b][i]);
+	G_free(blk.band[b]);
+	Rast_close(infd[b]);
     }
 
-    G_free(outrast);
-    Rast_close(outfd);
-
-    if (!strcasecmp(viflag, "ndvi")) {
- 	/* apply predefined NDVI color table */
-	const char *style = "ndvi";
-	if (G_find_color_rule("ndvi")) {
-	   Rast_make_fp_colors(&colors, style, -1.0, 1.0);
-	} else
-	   G_fatal_error(_("Unknown color request '%s'"), style);
-    } else {
-	/* Color from -1.0 to +1.0 in grey */
-	Rast_init_colors(&colors);
-	val1 = -1;
-	val2 = 1;
-	Rast_add_c_color_rule(&val1, 0, 0, 0, &val2, 255, 255, 255, &colors);
+    for (k = 0; k < nvi; k++) {
+	const char *result = opt.output->answers[k];
+
+	for (i = 0; i < nblock; i++)
+	    G_free(blk.out[k][i]);
+	G_free(blk.out[k]);
+	Rast_close(outfd[k]);
+
+	if (vi[k] == VI_NDVI) {
+	    /* apply predefined NDVI color table */
+	    const char *style = "ndvi";
+	    if (G_find_color_rule("ndvi")) {
+		Rast_make_fp_colors(&colors, style, -1.0, 1.0);
+	    } else
+		G_fatal_error(_("Unknown color request '%s'"), style);
+	} else {
+	    /* Color from -1.0 to +1.0 in grey */
+	    Rast_init_colors(&colors);
+	    val1 = -1;
+	    val2 = 1;
+	    Rast_add_c_color_rule(&val1, 0, 0, 0, &val2, 255, 255, 255, &colors);
+	}
+	Rast_write_colors(result, G_mapset(), &colors);
+	Rast_free_colors(&colors);
+
+	Rast_short_history(result, "raster", &history);
+	Rast_command_history(&history);
+	Rast_write_history(result, &history);
     }
-    Rast_write_colors(result, G_mapset(), &colors);
 
-    Rast_short_history(result, "raster", &history);
-    Rast_command_history(&history);
-    Rast_write_history(result, &history);
+    G_free(blk.out);
+    G_free(outfd);
+    G_free(vi);
 
     exit(EXIT_SUCCESS);
 }
@@ -32,6 +32,8 @@ class TestReport(TestCase):
         cls.runModule("g.remove", flags='f', type="raster", name="evi2")
         cls.runModule("g.remove", flags='f', type="raster", name="gari")
         cls.runModule("g.remove", flags='f', type="raster", name="gemi")
+        cls.runModule("g.remove", flags='f', type="raster",
+                      name="multi_dvi,multi_ipvi")
         cls.del_temp_region()
 
     def test_vinameipvi(self):
@@ -93,6 +95,17 @@ class TestReport(TestCase):
         self.assertRasterMinMax(map=map_output, refmin=-221.69, refmax=0.97,
                                 msg="gemi in degrees must be between -221.69 and 0.97")
 
+    def test_multiple(self):
+        """Testing several indices at once"""
+        self.assertModule('i.vi', red=self.red, nir=self.nir,
+                          viname='dvi,ipvi', output='multi_dvi,multi_ipvi',
+                          nprocs=2)
+        self.assertRasterMinMax(map='multi_dvi', refmin=-0.33, refmax=0.56,
+                                msg="dvi must be between -0.33 and 0.56")
+        self.assertRasterMinMax(map='multi_ipvi', refmin=0.0454545454545,
+                                refmax=0.906666666667,
+                                msg="ipvi must be between 0.0454545454545 and 0.906666666667")
+
 if __name__ == '__main__':
     from grass.gunittest.main import test
     test()
@@ -9,6 +9,7 @@
 #define BM_FLAT      0
 #define BM_NOTSPARSE 0
 #define BM_SPARSE    1
+#define BM_COMPRESSED 2
 
 #ifndef GRASS_LINKM_H
 #include <grass/linkm.h>
@@ -33,6 +33,9 @@ typedef struct func_desc
 #define SET_NULL_F(x) (Rast_set_f_null_value((x),1))
 #define SET_NULL_D(x) (Rast_set_d_null_value((x),1))
 
+/* for selecting NULL without a call, so that loops can be vectorized */
+#define NULL_C ((CELL) 0x80000000)
+
 extern volatile int floating_point_exception;
 extern volatile int floating_point_exception_occurred;
 
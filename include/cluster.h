@@ -4,6 +4,10 @@
 #include <grass/gis.h>
 #include <grass/imagery.h>
 
+/* methods for the initial class means */
+#define I_CLUSTER_MEANS_STDDEV   0	/* equally spaced within +- stddev */
+#define I_CLUSTER_MEANS_KMEANSPP 1	/* k-means++ seeding */
+
 struct Cluster
 {
     int nbands;                 /* number of bands */
@@ -22,6 +26,7 @@ struct Cluster
     double **sumdiff;		/* change in sum */
     double **sum2;		/* sum of squares per band per class */
     double **mean;		/* initial class means */
+    int init_means;		/* method for the initial class means */
     struct Signature S;		/* final signature(s) */
 
     int nclasses;               /* number of classes */
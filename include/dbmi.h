@@ -43,12 +43,14 @@
 #define DB_PROC_OPEN_UPDATE_CURSOR	207
 #define DB_PROC_UPDATE			208
 #define DB_PROC_ROWS			209
+#define DB_PROC_FETCH_BLOCK		210
 #define DB_PROC_BIND_UPDATE		220
 #define DB_PROC_BIND_INSERT		221
 
 #define DB_PROC_EXECUTE_IMMEDIATE	301
 #define DB_PROC_BEGIN_TRANSACTION	302
 #define DB_PROC_COMMIT_TRANSACTION	303
+#define DB_PROC_UPDATE_VALUES		304
 
 #define DB_PROC_CREATE_TABLE		401
 #define DB_PROC_DESCRIBE_TABLE		402
@@ -289,6 +291,29 @@ typedef struct
     dbCatVal *value;
 } dbCatValArray;
 
+/* column of a block of rows */
+typedef struct
+{
+    int ctype;			/* C type of values DB_C_TYPE_INT, _DOUBLE
+				   or _STRING (also for dates and times) */
+    char *isNull;		/* null flags of the rows */
+    int *i;			/* integer values of the rows */
+    double *d;			/* double values of the rows */
+    int *offset;		/* offsets of the row strings in buf */
+    char *buf;			/* NUL terminated strings of the rows */
+    int buf_len;		/* used size of buf */
+    int buf_alloc;		/* allocated size of buf */
+} dbColumnBlock;
+
+/* block of rows fetched from a cursor, stored by column */
+typedef struct
+{
+    int nrows;			/* number of rows in the block */
+    int alloc;			/* number of rows allocated in the columns */
+    int ncols;			/* number of columns */
+    dbColumnBlock *columns;
+} dbBlock;
+
 /* parameters of connection */
 typedef struct _db_connection
 {
@@ -21,4 +21,19 @@ int BM_dump_map_sparse(struct BM *);
 int BM_dump_map_row_sparse(struct BM *, int);
 int BM_file_write_sparse(FILE *, struct BM *);
 
+/* compressed.c */
+struct BM *BM_create_compressed(int, int);
+int BM_destroy_compressed(struct BM *);
+int BM_set_compressed(struct BM *, int, int, int);
+int BM_get_compressed(struct BM *, int, int);
+size_t BM_get_map_size_compressed(struct BM *);
+int BM_compact(struct BM *);
+int BM_or(struct BM *, struct BM *);
+int BM_and(struct BM *, struct BM *);
+int BM_andnot(struct BM *, struct BM *);
+size_t BM_count(struct BM *);
+int BM_next_set(struct BM *, int *, int *);
+int BM_file_write_compressed(FILE *, struct BM *);
+int BM_file_read_compressed(FILE *, struct BM *);
+
 #endif /*  GRASS_BITMAPDEFS_H  */
@@ -22,6 +22,7 @@ int I_cluster_exec_free(struct Cluster *);
 
 /* c_means.c */
 int I_cluster_means(struct Cluster *);
+int I_cluster_means_kmeanspp(struct Cluster *);
 
 /* c_merge.c */
 int I_cluster_merge(struct Cluster *);
@@ -7,6 +7,7 @@ int db_add_column(dbDriver *, dbString *, dbColumn *);
 void db__add_cursor_to_driver_state(dbCursor *);
 int db_alloc_cursor_column_flags(dbCursor *);
 int db_alloc_cursor_table(dbCursor *, int);
+int db_alloc_block(dbBlock *, int, int);
 int db_append_table_column(dbTable * , dbColumn *);
 dbDirent *db_alloc_dirent_array(int);
 dbHandle *db_alloc_handle_array(int);
@@ -50,6 +51,8 @@ int db_convert_Cstring_to_value_datetime(const char *, int,
 int db_convert_column_default_value_to_string(dbColumn *,
 					      dbString *);
 int db_convert_column_value_to_string(dbColumn *, dbString *);
+int db_convert_block_value_to_string(const dbBlock *, int, int,
+				     dbString *);
 int db_convert_value_datetime_into_string(dbValue *, int,
 					  dbString *);
 int db_convert_value_to_string(dbValue *, int,
@@ -100,6 +103,7 @@ int db_d_execute_immediate(void);
 int db_d_begin_transaction(void);
 int db_d_commit_transaction(void);
 int db_d_fetch(void);
+int db_d_fetch_block(void);
 int db_d_find_database(void);
 int db_d_get_num_rows(void);
 int db_d_grant_on_table(void);
@@ -116,8 +120,13 @@ int db_d_open_database(void);
 int db_d_open_insert_cursor(void);
 int db_d_open_select_cursor(void);
 int db_d_open_update_cursor(void);
+int db_d_start_in_process(const char *);
+int db_d_call_in_process(void);
+void db_d_stop_in_process(void);
 void db_double_quote_string(dbString *);
 int db_driver(int, char **);
+int db__start_in_process_driver(dbDriver *);
+int db__stop_in_process_driver(dbDriver *);
 
 int db_driver_mkdir(const char *, int, int);
 int db_drop_column(dbDriver *, dbString *,
@@ -127,6 +136,7 @@ int db_drop_index(dbDriver *, dbString *);
 int db_drop_table(dbDriver *, dbString *);
 void db_drop_token(dbToken);
 int db_d_update(void);
+int db_d_update_values(void);
 int db_d_version(void);
 int db_enlarge_string(dbString *, int);
 void db_error(const char *);
@@ -134,11 +144,13 @@ int db_execute_immediate(dbDriver *, dbString *);
 int db_begin_transaction(dbDriver *);
 int db_commit_transaction(dbDriver *);
 int db_fetch(dbCursor *, int, int *);
+int db_fetch_block(dbCursor *, int, dbBlock *);
 int db_find_database(dbDriver *, dbHandle *, int *);
 dbAddress db_find_token(dbToken);
 void db_free(void *);
 void db_free_column(dbColumn *);
 void db_free_cursor(dbCursor *);
+void db_free_block(dbBlock *);
 void db_free_cursor_column_flags(dbCursor *);
 void db_free_dbmscap(dbDbmscap *);
 void db_free_dirent_array(dbDirent *, int);
@@ -153,6 +165,7 @@ int db_get_column(dbDriver *, const char *, const char *,
 		  dbColumn **);
 dbValue *db_get_column_default_value(dbColumn *);
 const char *db_get_column_description(dbColumn *);
+const char *db_get_block_string(const dbBlock *, int, int);
 int db_get_column_host_type(dbColumn *);
 int db_get_column_length(dbColumn *);
 const char *db_get_column_name(dbColumn *);
@@ -206,6 +219,7 @@ int db_grant_on_table(dbDriver *, const char *, int,
 		      int);
 int db_has_dbms(void);
 void db_init_column(dbColumn *);
+void db_init_block(dbBlock *);
 void db_init_cursor(dbCursor *);
 void db__init_driver_state(void);
 void db_init_handle(dbHandle *);
@@ -265,6 +279,7 @@ int db__recv_short_array(short **, int *);
 int db__recv_string(dbString *);
 int db__recv_string_array(dbString **, int *);
 int db__recv_table_data(dbTable *);
+int db__recv_block(dbBlock *);
 int db__recv_table_definition(dbTable **);
 int db__recv_token(dbToken *);
 int db__recv_value(dbValue *, int);
@@ -292,6 +307,7 @@ int db__send_string(dbString *);
 int db__send_string_array(dbString *, int);
 int db__send_success(void);
 int db__send_table_data(dbTable *);
+int db__send_block(dbBlock *);
 int db__send_table_definition(dbTable *);
 int db__send_token(dbToken *);
 int db__send_value(dbValue *, int);
@@ -340,7 +356,10 @@ int db_set_index_table_name(dbIndex *, const char *);
 int db_set_index_type_non_unique(dbIndex *);
 int db_set_index_type_unique(dbIndex *);
 void db__set_protocol_fds(FILE *, FILE *);
+void db__set_protocol_in_process(int (*)(void));
+int db__protocol_in_process(void);
 int db_set_string(dbString *, const char *);
+int db_set_block_string(dbColumnBlock *, int, const char *);
 int db_set_string_no_copy(dbString *, char *);
 int db_set_table_column(dbTable *, int, dbColumn *);
 void db_set_table_delete_priv_granted(dbTable *);
@@ -404,6 +423,9 @@ void db_unset_cursor_mode(dbCursor *);
 void db_unset_cursor_mode_insensitive(dbCursor *);
 void db_unset_cursor_mode_scroll(dbCursor *);
 int db_update(dbCursor *);
+int db_update_values(dbDriver *, const char *, const char *, int,
+		     dbString *, const int *, int, const int *, dbValue *,
+		     int *);
 int db_gversion(dbDriver *, dbString *,
 		dbString *);
 const char *db_whoami(void);
@@ -141,6 +141,16 @@ void G_begin_zone_area_on_sphere(double, double);
 double G_darea0_on_sphere(double);
 double G_area_for_zone_on_sphere(double, double);
 
+/* arena.c */
+struct G_arena *G_arena_create(size_t);
+void *G_arena_alloc(struct G_arena *, size_t);
+void *G_arena_calloc(struct G_arena *, size_t, size_t);
+void G_arena_mark(struct G_arena *, struct G_arena_mark *);
+void G_arena_release(struct G_arena *, const struct G_arena_mark *);
+void G_arena_reset(struct G_arena *);
+void G_arena_destroy(struct G_arena *);
+size_t G_arena_used(const struct G_arena *);
+
 /* ascii_chk.c */
 void G_ascii_check(char *);
 
@@ -201,6 +211,10 @@ int G_read_compressed(int, int, unsigned char *, int, int);
 int G_compress_bound(int, int);
 int G_compress(unsigned char *, int, unsigned char *, int, int);
 int G_expand(unsigned char *, int, unsigned char *, int, int);
+int G_set_compressor_level(int, int);
+int G_compress_benchmark(int, unsigned char **, const int *, int, double,
+			 struct G_compress_stats *);
+int G_compressor_select(unsigned char **, const int *, int, double);
 
 /* compress.c : no compression */
 int
@@ -291,6 +305,12 @@ double G_distance_point_to_line_segment(double, double, double, double,
 /* done_msg.c */
 void G_done_msg(const char *, ...) __attribute__ ((format(printf, 1, 2)));
 
+/* element_index.c */
+int G_element_index_enabled(void);
+char **G_element_index(const char *, const char *, int *);
+int G_element_index_find(const char *, const char *, const char *);
+void G_element_index_changed(const char *, const char *);
+
 /* endian.c */
 int G_is_little_endian(void);
 
@@ -493,6 +513,7 @@ double G_drand48(void);
 void G_set_ls_filter(int (*)(const char *, void *), void *);
 void G_set_ls_exclude_filter(int (*)(const char *, void *), void *);
 char **G_ls2(const char *, int *);
+char **G_ls_element(const char *, const char *, int *);
 void G_ls(const char *, FILE *);
 void G_ls_format(char **, int, int, FILE *);
 
@@ -630,6 +651,13 @@ FILE *G_popen_write(struct Popen *, const char *, const char **);
 FILE *G_popen_read(struct Popen *, const char *, const char **);
 void G_popen_close(struct Popen *);
 
+/* perf.c */
+int G_perf_enabled(void);
+void G_perf_count(int *, const char *, long long);
+double G_perf_start(void);
+void G_perf_stop(int *, const char *, double);
+void G_perf_report(void);
+
 /* plot.c */
 void G_setup_plot(double, double, double, double, int (*)(int, int),
 		  int (*)(int, int));
@@ -844,10 +872,19 @@ double G_adjust_easting(double, const struct Cell_head *);
 void G__init_window(void);
 
 /* worker.c */
+struct G_task_group;
+struct G_task_group *G_task_group_create(void);
+void G_task_submit(struct G_task_group *, void (*)(void *), void *);
+void G_task_group_wait(struct G_task_group *);
+void G_task_group_destroy(struct G_task_group *);
+int G_num_workers(void);
+void G_parallel_for(int, int, int, void (*)(int, int, void *), void *);
 void G_begin_execute(void (*func)(void *), void *, void **, int);
 void G_end_execute(void **);
 void G_init_workers(void);
 void G_finish_workers(void);
+int G_num_procs(void);
+int G_set_nprocs(const struct Option *);
 
 /* wr_cellhd.c */
 void G__write_Cell_head(FILE *, const struct Cell_head *, int);
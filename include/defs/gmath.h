@@ -20,6 +20,12 @@ void G_free_imatrix(int **);
 /* fft.c */
 extern int fft(int, double *[2], int, int, int);
 extern int fft2(int, double (*)[2], int, int, int);
+extern int G_math_fft_threads(int);
+extern int G_math_fft2_r2c(double (*)[2], int, int);
+extern int G_math_fft2_c2r(double (*)[2], int, int);
+extern int G_math_fft_rows(int, double (*)[2], int, int);
+extern int G_math_fft_rows_r2c(double (*)[2], int, int);
+extern int G_math_fft_rows_c2r(double (*)[2], int, int);
 
 /* gauss.c */
 extern double G_math_rand_gauss(double);
@@ -90,6 +96,15 @@ extern G_math_spvector **G_math_sband_matrix_to_Asp(double **, int, int, double)
 extern void G_math_print_spmatrix(G_math_spvector **, int);
 extern void G_math_Ax_sparse(G_math_spvector **, double *, double *, int );
 
+/* compressed sparse row matrices */
+extern G_math_csr *G_math_alloc_csr(int, int);
+extern void G_math_free_csr(G_math_csr *);
+extern G_math_csr *G_math_Asp_to_csr(G_math_spvector **, int);
+extern G_math_csr *G_math_A_to_csr(double **, int);
+extern void G_math_Ax_csr(G_math_csr *, double *, double *);
+extern G_math_csr *G_math_csr_ichol(G_math_csr *);
+extern void G_math_csr_ichol_solve(G_math_csr *, double *, double *);
+
 /*Symmetric band matrix handling */
 extern double **G_math_matrix_to_sband_matrix(double **, int, int);
 extern double **G_math_sband_matrix_to_matrix(double **, int, int);
@@ -112,6 +127,7 @@ extern int G_math_solver_sparse_gs(G_math_spvector **, double *, double *, int ,
 extern int G_math_solver_sparse_pcg(G_math_spvector **, double *, double *, int , int , double , int );
 extern int G_math_solver_sparse_cg(G_math_spvector **, double *, double *, int , int , double );
 extern int G_math_solver_sparse_bicgstab(G_math_spvector **, double *, double *, int , int , double );
+extern int G_math_solver_sparse_multigrid(G_math_spvector **, double *, double *, int , int , double );
 
 /* solver algoithms and helper functions*/
 extern void G_math_gauss_elimination(double **, double *, int );
@@ -63,6 +63,8 @@ typedef struct
     int *walk_length;		/*number of stops with "walking connection" for each stop */
     int **walk_stops;		/*list of stops within walking distance for each stop */
     int **walk_times;		/*walking times between stops as given above */
+    void *cache;		/*mapped cache file the arrays point into or NULL */
+    size_t cache_size;
 } neta_timetable;
 
 typedef struct
@@ -85,5 +87,40 @@ int NetA_timetable_shortest_path(neta_timetable * timetable, int from_stop,
 int NetA_timetable_get_route_time(neta_timetable * timetable, int stop,
 				  int route);
 void NetA_timetable_result_release(neta_timetable_result * result);
+void NetA_timetable_release(neta_timetable * timetable);
+
+/*timetable_cache.c */
+int NetA_timetable_save(const neta_timetable * timetable,
+			const int *route_ids, const int *stop_ids,
+			const char *signature, const char *file);
+int NetA_timetable_load(const char *file, const char *signature,
+			neta_timetable * timetable, int **route_ids,
+			int **stop_ids);
+
+/*csa.c */
+
+/*Elementary connection of a route between two consecutive stops */
+typedef struct
+{
+    int dep_stop, arr_stop;
+    int dep_time, arr_time;
+    int route;
+} neta_connection;
+
+/*All connections of a timetable sorted by departure time */
+typedef struct
+{
+    int count;
+    neta_connection *conn;
+} neta_connections;
+
+int NetA_timetable_connections(const neta_timetable * timetable,
+			       neta_connections * connections);
+void NetA_connections_release(neta_connections * connections);
+int NetA_timetable_connection_scan(const neta_timetable * timetable,
+				   const neta_connections * connections,
+				   int from_stop, int to_stop,
+				   int start_time, int min_change,
+				   neta_timetable_result * result);
 
 #endif
@@ -539,6 +539,12 @@ void gsd_bgnlist(int, int);
 void gsd_endlist(void);
 void gsd_calllist(int);
 void gsd_deletelist(GLuint, int);
+int gsd_genlist(void);
+void gsd_newlist(int, int);
+void gsd_execlist(int);
+void gsd_freelist(int);
+void gsd_drawtriangles(int, const unsigned int *, const float *,
+		       const float *, const unsigned char *);
 void gsd_calllists(int);
 void gsd_getwindow(int *, int *, double *, double *);
 int gsd_writeView(unsigned char **, unsigned int, unsigned int);
@@ -546,6 +552,7 @@ int gsd_writeView(unsigned char **, unsigned int, unsigned int);
 /* gsd_surf.c */
 int gsd_surf(geosurf *);
 int gsd_surf_map(geosurf *);
+void gsd_surf_free_cache(geosurf *);
 int gsd_surf_const(geosurf *, float);
 int gsd_surf_func(geosurf *, int (*)());
 int gsd_triangulated_wall(int, int, geosurf *, geosurf *, Point3 *, Point3 *,
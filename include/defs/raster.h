@@ -89,6 +89,15 @@ int Rast_next_cell_stat(CELL *, long *, struct Cell_stats *);
 void Rast_get_stats_for_null_value(long *, const struct Cell_stats *);
 void Rast_free_cell_stats(struct Cell_stats *);
 
+/* cell_table.c */
+void Rast_init_cell_table(struct Cell_table *, int, size_t, size_t);
+void *Rast_add_cell_table_key(struct Cell_table *, const CELL *);
+void *Rast_find_cell_table_key(const struct Cell_table *, const CELL *);
+int Rast_next_cell_table_entry(const struct Cell_table *, size_t *,
+			       const CELL **, void **);
+size_t Rast_cell_table_bytes(const struct Cell_table *);
+void Rast_free_cell_table(struct Cell_table *);
+
 /* cell_title.c */
 char *Rast_get_cell_title(const char *, const char *);
 
@@ -171,6 +180,7 @@ void Rast__lookup_colors(const void *, unsigned char *, unsigned char *,
 			 int, int, RASTER_MAP_TYPE);
 void Rast__interpolate_color_rule(DCELL, unsigned char *, unsigned char *,
 				  unsigned char *, const struct _Color_Rule_ *);
+int Rast__color_fp_bin(const struct _Color_Info_ *, DCELL);
 
 /* color_org.c */
 void Rast__organize_colors(struct Colors *);
@@ -268,7 +278,10 @@ void Rast_abs_log_colors(struct Colors *, struct Colors *, int);
 int Rast__check_format(int);
 int Rast__read_row_ptrs(int);
 int Rast__read_null_row_ptrs(int, int);
+int Rast__read_tile_index(int);
+int Rast__write_tile_index(int);
 int Rast__write_row_ptrs(int);
+int Rast__write_overview_row_ptrs(int, int, off_t *);
 int Rast__write_null_row_ptrs(int, int);
 
 /* fpreclass.c */
@@ -328,8 +341,46 @@ void Rast_get_row(int, void *, int, RASTER_MAP_TYPE);
 void Rast_get_c_row(int, CELL *, int);
 void Rast_get_f_row(int, FCELL *, int);
 void Rast_get_d_row(int, DCELL *, int);
+void Rast_get_rows(int, void *, int, int, RASTER_MAP_TYPE);
 void Rast_get_null_value_row(int, char *, int);
 int Rast__read_null_bits(int, int, unsigned char *);
+int Rast__read_null_bits_row(int, int, unsigned char *);
+int Rast__read_mask_row(CELL *, int);
+int Rast__expand_row(const unsigned char *, size_t, int, int, int, int,
+		     unsigned char *, int *);
+
+/* maskcache.c */
+void Rast__apply_mask(char *, int);
+void Rast__release_mask_cache(void);
+
+/* mmap.c */
+void Rast_set_mmap(int, int);
+const unsigned char *Rast__mmap_data(int, off_t, size_t);
+void Rast__close_mmap(int);
+
+/* rowcache.c */
+void Rast_set_row_cache(int, int);
+int Rast__get_cached_row(int, int, int *);
+void Rast__put_cached_row(int, int, const unsigned char *, int);
+void Rast__close_row_cache(int);
+
+/* tile.c */
+void Rast_set_tile_size(int);
+int Rast_get_tile_size(int, int *, int *);
+void Rast_get_tile(int, int, int, void *, RASTER_MAP_TYPE);
+int Rast__read_tile_format(int, const char *, const char *);
+off_t *Rast__tile_index(int, int *);
+void Rast__read_tile_row(int, int, unsigned char *, int *);
+void Rast__init_tiles_write(int);
+void Rast__put_tile_row(int, int, const unsigned char *);
+void Rast__close_tiles_write(int);
+void Rast__remove_tile_format(const char *);
+void Rast__close_tiles(int);
+
+/* readahead.c */
+void Rast_set_read_ahead(int, int);
+int Rast__read_ahead(int, int, unsigned char *, int *);
+void Rast__close_read_ahead(int);
 
 /* get_row_colr.c */
 void Rast_get_row_colors(int, int, struct Colors *,
@@ -436,8 +487,36 @@ void Rast_insert_d_null_values(DCELL *, char *, int);
 int Rast__check_null_bit(const unsigned char *, int, int);
 void Rast__convert_01_flags(const char *, unsigned char *, int);
 void Rast__convert_flags_01(char *, const unsigned char *, int);
+void Rast__unpack_null_bits(char *, const unsigned char *, int, int);
 void Rast__init_null_bits(unsigned char *, int);
 
+/* flowcache.c */
+void Rast_set_flowcache(int);
+struct R_flowcache *Rast_flowcache_open_old(const char *, const char *,
+					    const char *);
+struct R_flowcache *Rast_flowcache_open_new(const char *, const char *,
+					    const char *);
+void Rast_flowcache_get_row(struct R_flowcache *, signed char *, DCELL *,
+			    int);
+void Rast_flowcache_put_row(struct R_flowcache *, const signed char *,
+			    const DCELL *);
+void Rast_flowcache_close(struct R_flowcache *);
+int Rast_remove_flowcache(const char *);
+
+/* overview.c */
+void Rast_set_overviews(int);
+int Rast__open_overview(int, const char *, const char *);
+int Rast_build_overviews(const char *);
+int Rast_remove_overviews(const char *);
+
+/* rowstats.c */
+void Rast__update_row_stats(int, int, const void *, const char *,
+			    RASTER_MAP_TYPE);
+void Rast__write_row_stats(int);
+void Rast__close_row_stats(int);
+int Rast_get_row_stats(int, int, int *, DCELL *, DCELL *);
+int Rast_remove_row_stats(const char *);
+
 /* open.c */
 int Rast_open_old(const char *, const char *);
 int Rast__open_old(const char *, const char *);
@@ -466,7 +545,10 @@ void Rast_put_row(int, const void *, RASTER_MAP_TYPE);
 void Rast_put_c_row(int, const CELL *);
 void Rast_put_f_row(int, const FCELL *);
 void Rast_put_d_row(int, const DCELL *);
+void Rast_put_rows(int, const void *, int, RASTER_MAP_TYPE);
 void Rast__write_null_bits(int, const unsigned char *);
+void Rast_set_write_behind(int, int);
+void Rast__close_write_behind(int);
 
 /* put_title.c */
 int Rast_put_cell_title(const char *, const char *);
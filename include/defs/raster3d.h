@@ -48,8 +48,10 @@ void Rast3d_filename(char *, const char *, const char *, const char *);
 /* fpcompress.c */
 void Rast3d_fpcompress_print_binary(char *, int);
 void Rast3d_fpcompress_dissect_xdr_double(unsigned char *);
-int Rast3d_fpcompress_write_xdr_nums(int, char *, int, int, char *, int);
-int Rast3d_fpcompress_read_xdr_nums(int, char *, int, int, int, char *, int);
+int Rast3d_fpcompress_write_xdr_nums(int, char *, int, int, char *, int, int);
+int Rast3d_fpcompress_read_xdr_nums(int, char *, int, int, int, char *, int,
+				    int);
+int Rast3d__fpcompress_decode_xdr_nums(char *, int, int, int, char *, int);
 
 /* alloc.c */
 void *Rast3d_malloc(int);
@@ -76,6 +78,8 @@ int Rast3d_write_colors(const char *, const char *, struct Colors *);
 /* defaults.c */
 void Rast3d_set_compression_mode(int, int);
 void Rast3d_get_compression_mode(int *, int *);
+void Rast3d_set_compressor(int);
+int Rast3d_get_compressor(void);
 void Rast3d_set_cache_size(int);
 int Rast3d_get_cache_size(void);
 void Rast3d_set_cache_limit(int);
@@ -198,6 +202,12 @@ void Rast3d_range_update_from_tile(RASTER3D_Map *, const void *, int, int, int,
 int Rast3d_read_range(const char *, const char *, struct FPRange *);
 int Rast3d_range_load(RASTER3D_Map *);
 void Rast3d_range_min_max(RASTER3D_Map *, double *, double *);
+
+/* readahead.c */
+void Rast3d_set_read_ahead(RASTER3D_Map *, int);
+void Rast3d__init_read_ahead(RASTER3D_Map *);
+int Rast3d__read_ahead(RASTER3D_Map *, int, void *, int);
+void Rast3d__close_read_ahead(RASTER3D_Map *);
 int Rast3d_range_write(RASTER3D_Map *);
 int Rast3d_range_init(RASTER3D_Map *);
 
@@ -336,6 +346,8 @@ void Rast3d_set_null_tile_type(RASTER3D_Map *, void *, int);
 void Rast3d_set_null_tile(RASTER3D_Map *, void *);
 
 /* tileread.c */
+void Rast3d__xdr_tile2tile(const RASTER3D_Map *, const void *, void *, int, int,
+			   int, int, int, int, int, int);
 int Rast3d_read_tile(RASTER3D_Map *, int, void *, int);
 int Rast3d_read_tile_float(RASTER3D_Map *, int, void *);
 int Rast3d_read_tile_double(RASTER3D_Map *, int, void *);
@@ -9,5 +9,9 @@ int Rowio_put(ROWIO *, const void *, int);
 void Rowio_release(ROWIO *);
 int Rowio_setup(ROWIO *, int, int, int, int (*)(int, void *, int, int),
 		int (*)(int, const void *, int, int));
+void **Rowio_window_get(ROWIO_WINDOW *, int);
+void Rowio_window_release(ROWIO_WINDOW *);
+int Rowio_window_setup(ROWIO_WINDOW *, int, int, int, int, int,
+		       int (*)(int, void *, int, int), void (*)(void *, int));
 
 #endif
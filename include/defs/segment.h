@@ -12,5 +12,6 @@ int Segment_init(SEGMENT *, int, int);
 int Segment_put(SEGMENT *, const void *, off_t, off_t);
 int Segment_put_row(const SEGMENT *, const void *, off_t);
 int Segment_release(SEGMENT *);
+int Segment_set_shared(SEGMENT *, int);
 
 #endif /* GRASS_SEGMENTDEFS_H */
@@ -50,7 +50,38 @@ extern stat_func_w w_var;
 extern stat_func_w w_skew;
 extern stat_func_w w_kurt;
 
+extern int compact_cell(DCELL *, int);
 extern int sort_cell(DCELL *, int);
 extern int sort_cell_w(DCELL(*)[2], int);
+extern void select_cell(DCELL *, int, int);
+
+struct stat_order;
+
+extern struct stat_order *stat_order_create(int, int);
+extern void stat_order_setup(struct stat_order *, DCELL **, int, int);
+extern void stat_order_add(struct stat_order *, int, int);
+extern void stat_order_remove(struct stat_order *, int, int);
+extern int stat_order_count(const struct stat_order *);
+extern void stat_order_median(const struct stat_order *, DCELL *);
+extern void stat_order_quant(const struct stat_order *, double, DCELL *);
+extern void stat_order_mode(const struct stat_order *, DCELL *);
+extern void stat_order_destroy(struct stat_order *);
+
+struct stat_multi;
+
+extern struct stat_multi *stat_multi_create(int, stat_func **,
+					    const double *);
+extern void stat_multi_compute(const struct stat_multi *, DCELL *, int,
+			       DCELL *, DCELL *);
+extern void stat_multi_destroy(struct stat_multi *);
+
+struct stat_tdigest;
+
+extern struct stat_tdigest *stat_tdigest_create(int);
+extern void stat_tdigest_add(struct stat_tdigest *, DCELL);
+extern void stat_tdigest_merge(struct stat_tdigest *, struct stat_tdigest *);
+extern double stat_tdigest_count(const struct stat_tdigest *);
+extern DCELL stat_tdigest_quantile(struct stat_tdigest *, double);
+extern void stat_tdigest_destroy(struct stat_tdigest *);
 
 #endif
@@ -22,6 +22,7 @@ int Vect_copy_pnts_to_xyz(const struct line_pnts *, double *, double *, double *
                           int *);
 void Vect_reset_line(struct line_pnts *);
 void Vect_destroy_line_struct(struct line_pnts *);
+void Vect_free_feature_buffers(void);
 int Vect_point_on_line(const struct line_pnts *, double, double *, double *,
                        double *, double *, double *);
 int Vect_line_segment(const struct line_pnts *, double, double, struct line_pnts *);
@@ -48,6 +49,10 @@ void Vect_area_buffer2(const struct Map_info *, int, double, double,
                        double, int, int, double,
                        struct line_pnts **,
                        struct line_pnts ***, int *);
+void Vect_polygon_buffer2(struct line_pnts *, struct line_pnts **, int,
+                          double, double, double, int, int, double,
+                          struct line_pnts **,
+                          struct line_pnts ***, int *);
 void Vect_point_buffer2(double, double, double, double,
                         double, int, double,
                         struct line_pnts **);
@@ -109,6 +114,10 @@ struct field_info *Vect_get_field2(const struct Map_info *, const char *);
 int Vect_get_field_number(const struct Map_info *, const char *);
 void Vect_set_db_updated(struct Map_info *);
 const char *Vect_get_column_names(const struct Map_info *, int);
+#ifdef GRASS_DBMI_H
+int Vect_select_cat_values(dbDriver *, const struct field_info *,
+                           const char *, const char *, dbCatValArray *);
+#endif
 const char *Vect_get_column_types(const struct Map_info *, int);
 const char *Vect_get_column_names_types(const struct Map_info *, int);
 
@@ -406,6 +415,8 @@ int Vect_net_shortest_path(struct Map_info *, int, int, struct ilist *,
 int Vect_net_ttb_shortest_path(struct Map_info *, int, int, int, int, int,
                              struct ilist *, double *);
 dglGraph_s *Vect_net_get_graph(struct Map_info *);
+int Vect_net_ch_build(struct Map_info *, int);
+void Vect_net_ch_release(struct Map_info *);
 int Vect_net_get_line_cost(const struct Map_info *, int, int, double *);
 int Vect_net_get_node_cost(const struct Map_info *, int, double *);
 int Vect_net_nearest_nodes(struct Map_info *, double, double, double, int,
@@ -599,6 +610,25 @@ int Vect_isle_find_area(struct Map_info *, int, const struct bound_box *);
 int Vect_attach_isle(struct Map_info *, int, const struct bound_box *);
 int Vect_attach_isles(struct Map_info *, const struct bound_box *);
 int Vect_attach_centroids(struct Map_info *, const struct bound_box *);
+int Vect_begin_topo_batch(struct Map_info *);
+int Vect_end_topo_batch(struct Map_info *);
+
+    /* Readers for several threads */
+struct Map_reader;
+struct Map_reader *Vect_new_reader(struct Map_info *);
+void Vect_destroy_reader(struct Map_reader *);
+int Vect_reader_read_line(struct Map_reader *, struct line_pnts *,
+                          struct line_cats *, int);
+int Vect_reader_select_lines_by_box(struct Map_reader *,
+                                    const struct bound_box *, int,
+                                    struct boxlist *);
+int Vect_reader_select_areas_by_box(struct Map_reader *,
+                                    const struct bound_box *,
+                                    struct boxlist *);
+int Vect_reader_get_area_points(struct Map_reader *, int,
+                                struct line_pnts *);
+int Vect_reader_get_isle_points(struct Map_reader *, int,
+                                struct line_pnts *);
 
     /* GEOS support */
 #ifdef HAVE_GEOS
@@ -607,6 +637,11 @@ GEOSGeometry *Vect_line_to_geos(const struct line_pnts*, int, int);
 GEOSGeometry *Vect_read_area_geos(struct Map_info *, int);
 GEOSCoordSequence *Vect_get_area_points_geos(struct Map_info *, int);
 GEOSCoordSequence *Vect_get_isle_points_geos(struct Map_info *, int);
+struct geos_cache;
+struct geos_cache *Vect_new_geos_cache(struct Map_info *, int);
+void Vect_destroy_geos_cache(struct geos_cache *);
+const GEOSPreparedGeometry *Vect_geos_cache_line(struct geos_cache *, int);
+const GEOSPreparedGeometry *Vect_geos_cache_area(struct geos_cache *, int);
 char *Vect_line_to_wkt(const struct line_pnts *, int, int);
 unsigned char *Vect_line_to_wkb(const struct line_pnts *,
                                 int, int, size_t *);
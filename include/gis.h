@@ -291,6 +291,7 @@ typedef enum
     G_OPT_M_DIR,                /*!< directory input */    
     G_OPT_M_REGION,             /*!< saved region */
     G_OPT_M_NULL_VALUE,         /*!< null value string */
+    G_OPT_M_NPROCS,             /*!< number of threads for parallel computing */
     
     G_OPT_STDS_INPUT,           /*!< old input space time dataset of type strds, str3ds or stvds */
     G_OPT_STDS_INPUTS,          /*!< old input space time datasets */
@@ -643,6 +644,11 @@ struct _Color_Info_
 	struct _Color_Rule_ **rules;
 	int nalloc;
 	int active;
+	/* first interval which may contain a value of each of nbins
+	   equal bins over [vals[0], vals[nalloc-1]] */
+	int *bins;
+	int nbins;
+	DCELL bin_scale;
     } fp_lookup;
 
     DCELL min, max;
@@ -688,6 +694,30 @@ struct ilist
     int alloc_values;
 };
 
+/*!
+  \brief Region allocator (see G_arena_create())
+*/
+struct G_arena;
+
+/*!
+  \brief Position in a region allocator (see G_arena_mark())
+*/
+struct G_arena_mark
+{
+    void *block;
+    size_t used;
+};
+
+/*!
+  \brief Results of a compressor benchmark (see G_compress_benchmark())
+*/
+struct G_compress_stats
+{
+    double ratio;		/* uncompressed / stored size */
+    double compress_rate;	/* MB of uncompressed data per second */
+    double expand_rate;		/* MB of uncompressed data per second */
+};
+
 /*============================== Prototypes ================================*/
 
 /* Since there are so many prototypes for the gis library they are stored */
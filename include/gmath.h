@@ -41,12 +41,14 @@
 #define G_MATH_SOLVER_ITERATIVE_CG "cg"
 #define G_MATH_SOLVER_ITERATIVE_PCG "pcg"
 #define G_MATH_SOLVER_ITERATIVE_BICGSTAB "bicgstab"
+#define G_MATH_SOLVER_ITERATIVE_MULTIGRID "multigrid"
 
 /*preconditioner */
 #define G_MATH_DIAGONAL_PRECONDITION 1
 #define G_MATH_ROWSCALE_ABSSUMNORM_PRECONDITION 2
 #define G_MATH_ROWSCALE_EUKLIDNORM_PRECONDITION 3
 #define G_MATH_ROWSCALE_MAXNORM_PRECONDITION 4
+#define G_MATH_ICHOL_PRECONDITION 5
 
 /*!
  * \brief The row vector of the sparse matrix
@@ -58,6 +60,18 @@ typedef struct
     unsigned int *index;	/*the index number */
 } G_math_spvector;
 
+/*!
+ * \brief The compressed sparse row matrix
+ * */
+typedef struct
+{
+    int rows;			/*Number of rows */
+    int nnz;			/*Number of entries */
+    int *row_ptr;		/*Start of the rows in index and values, rows + 1 entries */
+    unsigned int *index;	/*the column index numbers */
+    double *values;		/*The non null values of the rows */
+} G_math_csr;
+
 #include <grass/defs/gmath.h>
 
 #endif /* GRASS_GMATH_H */
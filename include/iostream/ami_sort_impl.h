@@ -114,13 +114,36 @@ size_t makeRun_Block(AMI_STREAM<T> *instream, T* data,
 }
 
 
+/* ---------------------------------------------------------------------- */
+/* a block of a run, sorted by a libgis worker thread (see
+   G_begin_execute()) while the next block is read. The worker must not
+   allocate memory: the counters of MM_manager are not thread-safe. The
+   compare function of Compare must not modify shared state. */
+template<class T, class Compare>
+struct SortBlockTask {
+  T *data;
+  size_t n;
+  Compare *cmp;
+  void *worker;
+};
+
+template<class T, class Compare>
+static void sortBlock(void *closure) {
+  SortBlockTask<T,Compare> *task = (SortBlockTask<T,Compare> *)closure;
+
+  quicksort(task->data, task->n, *task->cmp);
+}
+
+
+
 /* ---------------------------------------------------------------------- */
 /* data is allocated; read run_size elements from stream into data and
    sort them using quicksort; instead of reading the whole chunk at
    once, it reads it in blocks, sorts each block and then merges the
    blocks together. Note: it is not in place! it allocates another
    array of same size as data, writes the sorted run into it and
-   deteles data, and replaces data with outdata */
+   deteles data, and replaces data with outdata. The blocks are sorted
+   on the worker threads, overlapped with reading the following blocks */
 template<class T, class Compare>
 void makeRun(AMI_STREAM<T> *instream, T* &data, 
 	     int run_size, Compare *cmp) {
@@ -142,13 +165,28 @@ void makeRun(AMI_STREAM<T> *instream, T* &data,
   queue<MEM_STREAM<T> *> *blockList;
   MEM_STREAM<T>* str;
   blockList  = new  queue<MEM_STREAM<T> *>(nblocks);
+  SortBlockTask<T,Compare> *tasks = new SortBlockTask<T,Compare>[nblocks];
   for (unsigned int i=0; i < nblocks; i++) {
+    AMI_err err;
+    off_t n = 0;
+
     crt_block_size = (i == nblocks-1) ? last_block_size: block_size;
-    makeRun_Block(instream, &(data[i*block_size]), crt_block_size, cmp);
+    err = instream->read_array(&(data[i*block_size]), crt_block_size, &n);
+    assert(err == AMI_ERROR_NO_ERROR || err == AMI_ERROR_END_OF_STREAM);
+
+    tasks[i].data = &(data[i*block_size]);
+    tasks[i].n = n;
+    tasks[i].cmp = cmp;
+    tasks[i].worker = NULL;
+    G_begin_execute(sortBlock<T,Compare>, &tasks[i], &tasks[i].worker, 0);
+
     str = new MEM_STREAM<T>( &(data[i*block_size]), crt_block_size);
     blockList->enqueue(str);
   }
   assert(blockList->length() == nblocks);
+  for (unsigned int i=0; i < nblocks; i++)
+    G_end_execute(&tasks[i].worker);
+  delete [] tasks;
   
   //now data consists of sorted blocks: merge them 
   ReplacementHeapBlock<T,Compare> rheap(blockList);
@@ -206,6 +244,9 @@ runFormation(AMI_STREAM<T> *instream, Compare *cmp) {
   //rewind file
   instream->seek(0); //should check error xxx
 
+  //the blocks of a run are sorted in parallel
+  G_init_workers();
+
   //estimate run_size, last_run_size and nb_runs
   initializeRunFormation(instream, run_size, last_run_size, nb_runs);
 
@@ -289,13 +330,34 @@ runFormation(AMI_STREAM<T> *instream, Compare *cmp) {
 //Compare, must have a member function called "compare" which is used
 //for sorting the input stream.  
 
+//the merged elements are collected in two buffers: while a worker
+//thread writes one of them to the output stream, the merge fills the
+//other one.
+
+
+/* a buffer of merged elements written by a libgis worker thread */
+template<class T>
+struct MergeWriteTask {
+  AMI_STREAM<T> *str;
+  T *data;
+  size_t n;
+  void *worker;
+};
+
+template<class T>
+static void writeBlock(void *closure) {
+  MergeWriteTask<T> *task = (MergeWriteTask<T> *)closure;
+
+  task->str->write_array(task->data, task->n);
+}
+
 
 template<class T, class Compare>
 AMI_STREAM<T>* 
 singleMerge(queue<char*>* streamList, Compare *cmp)
 {
   AMI_STREAM<T>* mergedStr;
-  size_t mm_avail, blocksize;
+  size_t mm_avail, blocksize, bufsize;
   unsigned int arity, max_arity; 
   T elt;
 
@@ -305,6 +367,15 @@ singleMerge(queue<char*>* streamList, Compare *cmp)
 
   //estimate max possible merge arity with available memory (approx M/B)
   mm_avail = MM_manager.memory_available();
+
+  //keep room for the two output buffers, unless memory is very short
+  G_init_workers();
+  bufsize = STREAM_BUFFER_SIZE / sizeof(T);
+  if (bufsize < 1)
+    bufsize = 1;
+  if (G_num_workers() == 0 || mm_avail < 8 * bufsize * sizeof(T))
+    bufsize = 0;
+  mm_avail -= 2 * bufsize * sizeof(T);
   //blocksize = getpagesize();
   //should use AMI function, but there's no stream at this point
   //now use static mtd -RW 5/05
@@ -328,14 +399,38 @@ singleMerge(queue<char*>* streamList, Compare *cmp)
   ReplacementHeap<T,Compare> rheap(arity, streamList);
   SDEBUG rheap.print(cerr);
 
-  int i = 0;
-  while (!rheap.empty()) {
-    //mergedStr->write_item( rheap.extract_min() );
-    //xxx should check error here
-    elt = rheap.extract_min();
-    mergedStr->write_item(elt);
-    //SDEBUG cerr << "smerge: written " << elt << endl;
-    i++;
+  if (bufsize == 0) {
+    while (!rheap.empty()) {
+      //xxx should check error here
+      elt = rheap.extract_min();
+      mergedStr->write_item(elt);
+    }
+  } else {
+    MergeWriteTask<T> task[2];
+    int crt = 0;
+
+    for (int k = 0; k < 2; k++) {
+      task[k].str = mergedStr;
+      task[k].data = new T[bufsize];
+      task[k].n = 0;
+      task[k].worker = NULL;
+    }
+
+    while (!rheap.empty()) {
+      task[crt].data[task[crt].n++] = rheap.extract_min();
+      if (task[crt].n == bufsize || rheap.empty()) {
+	//the writes are in order: the other buffer is written first
+	G_end_execute(&task[1 - crt].worker);
+	G_begin_execute(writeBlock<T>, &task[crt], &task[crt].worker, 0);
+	crt = 1 - crt;
+	task[crt].n = 0;
+      }
+    }
+
+    for (int k = 0; k < 2; k++) {
+      G_end_execute(&task[k].worker);
+      delete [] task[k].data;
+    }
   }
   
   SDEBUG cout << "..done\n";
@@ -49,6 +49,7 @@
 #include <errno.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 using std::cout;
@@ -77,6 +78,11 @@ extern "C" {
 // All streams will be names STREAM_*****
 #define BASE_NAME "STREAM"
 
+// The name of the environment variable which sets the size (in MB) of
+// the memory-mapped window streams are read through; unset or 0 to
+// read through the stdio buffer
+#define STREAM_MMAP "GRASS_STREAM_MMAP"
+
 #define STREAM_BUFFER_SIZE (1<<18)
 
 
@@ -147,6 +153,22 @@ protected:
   char* buf;
   int eof_reached;
 
+  //memory-mapped read window, see STREAM_MMAP; while map_active is
+  //set, map_pos is the (byte) position of the stream and the position
+  //of fp is stale
+  size_t map_size;	//window size, 0 if reading through fp
+  char *map_base;
+  off_t map_off;	//file offset of map_base
+  size_t map_len;
+  off_t map_pos;
+  int map_active;
+
+  void map_init();
+  int map_window(off_t pos, size_t len);
+  off_t map_tell();
+  void map_sync();
+  void map_release();
+
  public:
   static unsigned int get_block_length()  {
     return STREAM_BUFFER_SIZE;
@@ -250,6 +272,7 @@ AMI_STREAM<T>::AMI_STREAM() {
          << strerror(errno) << endl;
     exit(1);
   }
+  map_init();
   
   // By default, all streams are deleted at destruction time.
   per = PERSIST_DELETE;
@@ -295,6 +318,7 @@ AMI_STREAM<T>::AMI_STREAM(const char *path_name, AMI_stream_type st) {
          << strerror(errno) << endl;
     exit(1);
   }
+  map_init();
 
   eof_reached = 0;
 
@@ -479,7 +503,12 @@ AMI_err AMI_STREAM<T>::seek(off_t offset) {
     seek_offset = offset * sizeof(T);
   }
 
-  G_fseek(fp, seek_offset, SEEK_SET);
+  if (map_active) {
+    //keep reading through the window
+    map_pos = seek_offset;
+  } else {
+    G_fseek(fp, seek_offset, SEEK_SET);
+  }
   
   return AMI_ERROR_NO_ERROR;
 }
@@ -518,6 +547,7 @@ AMI_STREAM<T>::~AMI_STREAM(void)  {
   
   DEBUG_DELETE cerr << "~AMI_STREAM: " << path << "(" << this << ")\n";
   assert(fp);
+  map_release();
   fclose(fp);
   delete buf;
   
@@ -544,8 +574,28 @@ AMI_err AMI_STREAM<T>::read_item(T **elt)  {
 
   assert(fp);
 
+  if (map_size) {
+    off_t pos = map_tell();
+
+    //if we go past substream range
+    if ((logical_eos >= 0) && pos >= (off_t)sizeof(T) * logical_eos)
+      return AMI_ERROR_END_OF_STREAM;
+
+    switch (map_window(pos, sizeof(T))) {
+    case 1:
+      read_tmp = *(const T *)(map_base + (pos - map_off));
+      map_pos = pos + sizeof(T);
+      *elt = &read_tmp;
+      return AMI_ERROR_NO_ERROR;
+    case 0:
+      eof_reached = 1;
+      return AMI_ERROR_END_OF_STREAM;
+    }
+    //the window could not be mapped: read through fp
+  }
+
   //if we go past substream range
-  if ((logical_eos >= 0) && G_ftell(fp) >= sizeof(T) * logical_eos) {
+  if ((logical_eos >= 0) && G_ftell(fp) >= (off_t)sizeof(T) * logical_eos) {
     return AMI_ERROR_END_OF_STREAM;
   
   } else {
@@ -572,19 +622,55 @@ AMI_err AMI_STREAM<T>::read_item(T **elt)  {
 template<class T>
 AMI_err AMI_STREAM<T>::read_array(T *data, off_t len, off_t *lenp) {
   size_t nobj;
+  off_t nmapped = 0;
   assert(fp);
   
+  if (map_size) {
+    off_t pos = map_tell();
+    int ok = 1;
+
+    //if we go past substream range
+    if ((logical_eos >= 0) && pos >= (off_t)sizeof(T) * logical_eos) {
+      eof_reached = 1;
+      return AMI_ERROR_END_OF_STREAM;
+    }
+
+    while (nmapped < len && (ok = map_window(pos, sizeof(T))) == 1) {
+      off_t n = (map_off + (off_t)map_len - pos) / (off_t)sizeof(T);
+      const T *src = (const T *)(map_base + (pos - map_off));
+
+      if (n > len - nmapped)
+	n = len - nmapped;
+      std::copy(src, src + n, data + nmapped);
+      nmapped += n;
+      pos += n * sizeof(T);
+      map_pos = pos;
+    }
+
+    if (ok >= 0) {
+      if(lenp) *lenp = nmapped;
+      if (nmapped < len) {
+	eof_reached = 1;
+	return AMI_ERROR_END_OF_STREAM;
+      }
+      return AMI_ERROR_NO_ERROR;
+    }
+    //the window could not be mapped: read the rest through fp
+    data += nmapped;
+    len -= nmapped;
+  }
+
   //if we go past substream range
-  if ((logical_eos >= 0) && G_ftell(fp) >= sizeof(T) * logical_eos) {
+  if ((logical_eos >= 0) && G_ftell(fp) >= (off_t)sizeof(T) * logical_eos) {
 	eof_reached = 1;
     return AMI_ERROR_END_OF_STREAM;
     
   } else {
     nobj = fread((void*)data, sizeof(T), len, fp);
 
-    if (nobj < len) {		/* some kind of error */
+    if ((off_t)nobj < len) {		/* some kind of error */
       if(feof(fp)) {
-	if(lenp) *lenp = nobj;
+	if(lenp) *lenp = nmapped + nobj;
 	eof_reached = 1;
 	return AMI_ERROR_END_OF_STREAM;
       } else {
@@ -593,7 +679,7 @@ AMI_err AMI_STREAM<T>::read_array(T *data, off_t len, off_t *lenp) {
 	return AMI_ERROR_IO_ERROR;
       }
     }
-    if(lenp) *lenp = nobj;
+    if(lenp) *lenp = nmapped + nobj;
     return AMI_ERROR_NO_ERROR; 
   }
 }
@@ -606,8 +692,9 @@ template<class T>
 AMI_err AMI_STREAM<T>::write_item(const T &elt) {
 
   assert(fp);
+  map_sync();
   //if we go past substream range
-  if ((logical_eos >= 0) && G_ftell(fp) >= sizeof(T) * logical_eos) {
+  if ((logical_eos >= 0) && G_ftell(fp) >= (off_t)sizeof(T) * logical_eos) {
     return AMI_ERROR_END_OF_STREAM;
   
   } else {
@@ -632,13 +719,14 @@ AMI_err AMI_STREAM<T>::write_array(const T *data, off_t len) {
   size_t nobj;
 
   assert(fp);
+  map_sync();
   //if we go past substream range
-  if ((logical_eos >= 0) && G_ftell(fp) >= sizeof(T) * logical_eos) {
+  if ((logical_eos >= 0) && G_ftell(fp) >= (off_t)sizeof(T) * logical_eos) {
     return AMI_ERROR_END_OF_STREAM;
     
   } else {
     nobj = fwrite(data, sizeof(T), len, fp);
-    if (nobj  < len) {
+    if ((off_t)nobj < len) {
       cerr << "ERROR: AMI_STREAM::write_array failed.\n";
       if (path && *path)
 	perror(path);
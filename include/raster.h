@@ -204,6 +204,18 @@ struct Cell_stats
     int curoffset;
 };
 
+struct Cell_table
+{
+    int nkeys;			/* categories per key */
+    size_t value_size;		/* bytes of the value of a key */
+    size_t size;		/* number of slots, a power of 2 */
+    size_t used;		/* number of keys */
+    CELL *keys;			/* nkeys categories for each slot */
+    unsigned char *values;	/* value_size bytes for each slot */
+    unsigned char *full;	/* non-zero for slots holding a key */
+    size_t last;		/* slot of the previous key added */
+};
+
 struct Histogram
 {
     int num;
@@ -250,6 +262,7 @@ struct FP_stats {
 
 struct GDAL_link;
 struct R_vrt;
+struct R_flowcache;
 
 /*** prototypes ***/
 #include <grass/defs/raster.h>
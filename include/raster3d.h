@@ -114,6 +114,7 @@ typedef struct RASTER3D_Map
     int useLzw;			/* RASTER3D_USE_LZW or RASTER3D_NO_LZW !!! only kept for backward compatibility */
     int useRle;			/* RASTER3D_USE_RLE or RASTER3D_NO_RLE !!! only kept for backward compatibility */
     int useXdr;			/* RASTER3D_USE_XDR or RASTER3D_NO_XDR !!! only kept for backward compatibility */
+    int compressor;		/* compressor number of compressed tiles, see G_compressor_name() */
 
     /* pointer to first tile in file */
     int offset;
@@ -183,6 +184,9 @@ typedef struct RASTER3D_Map
 
     int useMask;		/* 1 if mask is used; 0 otherwise */
 
+    /* tiles read ahead by worker threads; NULL if not used */
+    void *readahead;
+
 } RASTER3D_Map;
 
 /*---------------------------------------------------------------------------*/
@@ -82,12 +82,16 @@ struct RB_NODE
     struct RB_NODE *link[2];        /* link to children: link[0] for smaller, link[1] for larger */
 };
  
+struct btree2_pool;
+
 struct RB_TREE
 {
     struct RB_NODE *root;           /* root node */
     size_t datasize;                /* item size */
     size_t count;                   /* number of items in tree. */
     rb_compare_fn *rb_compare;      /* function to compare data */
+    struct btree2_pool *node_pool;  /* memory for nodes */
+    struct btree2_pool *data_pool;  /* memory for data items */
 };
 
 struct RB_TRAV
@@ -20,6 +20,19 @@ typedef struct
     } *rcb;
 } ROWIO;
 
+typedef struct
+{
+    int fd;			/* file descriptor for reading */
+    int nrows;			/* number of rows in the file */
+    int size;			/* number of rows in the window */
+    int len;			/* length of row data */
+    int pad;			/* padding before and after row data */
+    int row;			/* current row, -1 if none */
+    void **rows;		/* row buffers, current row at size / 2 */
+    int (*getrow) (int, void *, int, int);	/* routine to do the row reads */
+    void (*fill) (void *, int);	/* routine to fill padding and edge rows */
+} ROWIO_WINDOW;
+
 #include <grass/defs/rowio.h>
 
 #endif
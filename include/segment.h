@@ -11,6 +11,16 @@
 #include <sys/types.h>
 #endif
 
+struct segcmp;
+struct segaio;
+struct segshare;
+struct segpolicy;
+
+/* replacement policies */
+#define SEGMENT_LRU   0
+#define SEGMENT_CLOCK 1
+#define SEGMENT_2Q    2
+
 struct aq {			/* age queue */
     int cur;			/* segment number */
     struct aq *younger, *older;	/* pointer to next younger and next older */
@@ -60,6 +70,18 @@ typedef struct
     int offset;			/* offset of data past header */
 
     char *cache;		/* all in memory cache */
+    int cache_mapped;		/* cache is an anonymous mapping */
+
+    int compressor;		/* 0: segments are not compressed */
+    struct segcmp *cmp;		/* compressed segments, see compress.c */
+    struct segaio *aio;		/* background I/O, see async.c */
+    struct segshare *share;	/* concurrent access, see shared.c */
+
+    int policy;			/* replacement policy, see policy.c */
+    struct segpolicy *pol;	/* state of policy other than LRU */
+    off_t nhits;		/* accesses to segments in memory */
+    off_t nmisses;		/* segments paged in */
+    off_t ndirty;		/* dirty segments paged out to make room */
 } SEGMENT;
 
 #include <grass/defs/segment.h>
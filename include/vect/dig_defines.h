@@ -24,6 +24,8 @@
 #define GV_CIDX_ELEMENT "cidx"
 /*! \brief External format (OGR), feature index */
 #define GV_FIDX_ELEMENT "fidx"
+/*! \brief Contraction hierarchy of network graph */
+#define GV_NETCH_ELEMENT "net_ch"
 /*! \brief Color table */
 #define GV_COLR_ELEMENT "colr"
 /*! \brief Name of directory for alternative color tables */
@@ -62,6 +62,7 @@ size_t dig_fread(void *ptr, size_t size, size_t nmemb, struct gvfile * file);
 size_t dig_fwrite(const void *ptr, size_t size, size_t nmemb, struct gvfile * file);
 void dig_file_init(struct gvfile * file);
 int dig_file_load(struct gvfile * file);
+int dig_file_map(struct gvfile * file);
 void dig_file_free(struct gvfile * file);
 
 /* frmt.c */
@@ -206,6 +207,8 @@ int dig_select_nodes(struct Plus_head *, const struct bound_box *, struct ilist
 int dig_select_lines(struct Plus_head *, const struct bound_box *, struct boxlist *);
 int dig_select_areas(struct Plus_head *, const struct bound_box *, struct boxlist *);
 int dig_select_isles(struct Plus_head *, const struct bound_box *, struct boxlist *);
+int dig_select_lines_r(struct Plus_head *, const struct bound_box *, struct boxlist *);
+int dig_select_areas_r(struct Plus_head *, const struct bound_box *, struct boxlist *);
 int dig_find_node(struct Plus_head *, double, double, double);
 int dig_find_line_box(struct Plus_head *, int, struct bound_box *);
 int dig_find_area_box(struct Plus_head *, int, struct bound_box *);
@@ -218,6 +221,7 @@ int dig_Wr_spidx(struct gvfile *, struct Plus_head *);
 int dig_Rd_spidx(struct gvfile *, struct Plus_head *);
 
 int dig_dump_spidx(FILE *, const struct Plus_head *);
+int dig_spidx_reentrant(const struct Plus_head *);
 
 int rtree_search(struct RTree *, struct RTree_Rect *, 
                  SearchHitCallback , void *, struct Plus_head *);
@@ -124,6 +124,7 @@ struct gvfile
 
       - 0 - not loaded
       - 1 - loaded
+      - 2 - mapped read-only, see dig_file_map()
     */
     int loaded;
 };
@@ -662,9 +663,14 @@ struct Format_info_pg
     */
     PGconn   *conn;
     PGresult *res;
+    /*!
+      \brief Prefetched page of records (select cursor)
+    */
+    PGresult *res_next;
 #else
     void     *conn;
     void     *res;
+    void     *res_next;
 #endif
     /*!
       \brief Open cursor
@@ -705,6 +711,17 @@ struct Format_info_pg
       topology is also maintained in DB
     */
     int      topo_geo_only;
+
+    /*!
+      \brief Columns of the COPY in progress (simple features
+      access), NULL if none
+
+      Features are loaded into the feature table by COPY, the rows
+      are collected in a buffer (copy_len bytes used of copy_alloc)
+    */
+    char    *copy_columns;
+    char    *copy_buf;
+    size_t   copy_len, copy_alloc;
 };
 
 /*!
@@ -1212,6 +1229,33 @@ struct Plus_head
 	*/
 	int n_upnodes;
     } uplist;
+
+    /*!
+      \brief Batch of topology updates
+
+      See Vect_begin_topo_batch() for details.
+    */
+    struct {
+	/*!
+	  \brief Indicates if a batch is open
+	*/
+	int active;
+	/*!
+	  \brief Boxes of the areas and isles changed in the batch
+
+	  Isles and centroids in these boxes are reattached by
+	  Vect_end_topo_batch()
+	*/
+	struct bound_box *boxes;
+	/*!
+	  \brief Number of boxes
+	*/
+	int n_boxes;
+	/*!
+	  \brief Allocated array of boxes
+	*/
+	int alloc_boxes;
+    } batch;
 };
 
 /*!
@@ -1248,6 +1292,10 @@ struct Graph_info {
       \brief Edge and node costs multiplicator
     */
     int cost_multip;
+    /*!
+      \brief Contraction hierarchy of the graph (see Vect_net_ch_build())
+    */
+    struct net_ch *ch;
 };
 
 /*! \brief
@@ -13,7 +13,8 @@
  **
  **   BM_set_mode (mode, size)          Specify Mode and data size in bits.
  **                                     Affects all further calls to BM_create()
- **                                     Mode can be BM_FLAT or BM_SPARSE
+ **                                     Mode can be BM_FLAT, BM_SPARSE or
+ **                                     BM_COMPRESSED
  **                                     Size can only be 1 currently.
  **
  **   BM_destroy (map)                  Destroy bitmap and free memory
@@ -63,6 +64,8 @@ struct BM *BM_create(int x, int y)
 
     if (Mode == BM_SPARSE)
 	return BM_create_sparse(x, y);
+    if (Mode == BM_COMPRESSED)
+	return BM_create_compressed(x, y);
 
     if (NULL == (map = (struct BM *)malloc(sizeof(struct BM))))
 	return (NULL);
@@ -89,6 +92,8 @@ struct BM *BM_create(int x, int y)
  */
 int BM_destroy(struct BM *map)
 {
+    if (map->sparse == BM_COMPRESSED)
+	return BM_destroy_compressed(map);
     if (map->sparse)
 	return BM_destroy_sparse(map);
 
@@ -116,6 +121,11 @@ int BM_destroy(struct BM *map)
  **             but can save several orders of magnitude of memory on large
  **             bitmaps since size of FLAT bitmap is O(M*N)
  **
+ **  BM_COMPRESSED  Blocks of 64K cells kept as sorted arrays, bitsets
+ **             or runs, whichever is smaller.  Fast access, memory in
+ **             proportion to the set cells (or runs of them), and set
+ **             operations on whole blocks.
+ **
  **  
  **  Returns 0  or negative on error;
  **   If error it will print a warning message to stderr and continue
@@ -126,7 +136,7 @@ int BM_destroy(struct BM *map)
  * \brief
  *
  * Specify the type of data structure to use for bitmap.
- * 'mode' can be either BM_FLAT or BM_SPARSE:
+ * 'mode' can be BM_FLAT, BM_SPARSE or BM_COMPRESSED:
  *
  * BM_FLAT is a basic packed bitmap - eight values stored per byte
  * thus creating a 1:8 compression over using char arrays and a
@@ -137,6 +147,11 @@ int BM_destroy(struct BM *map)
  * for writing, but can save several orders of magnitude of memory on
  * large bitmaps.
  *
+ * BM_COMPRESSED keeps each block of 65536 cells as a sorted array, a
+ * bitset or a list of runs, whichever is smaller, and nothing for empty
+ * blocks. Access is nearly as fast as for BM_FLAT while the memory
+ * follows the number of set cells. See <b>BM_create_compressed()</b>.
+ *
  * NOTE: At this time 'size' must be passed a value of 1
  *
  * returns 0 on success or -1 on error
@@ -153,7 +168,9 @@ int BM_set_mode(int mode, int size)
     switch (mode) {
     case BM_FLAT:
     case BM_SPARSE:
+    case BM_COMPRESSED:
 	Mode = mode;
+	break;
     default:
 	fprintf(stderr, "BM_set_mode:  Unknown mode: %d\n", mode);
 	ret--;
@@ -191,6 +208,8 @@ int BM_set(struct BM *map, int x, int y, int val)
     if (x < 0 || x >= map->cols || y < 0 || y >= map->rows)
 	return 0;
 
+    if (map->sparse == BM_COMPRESSED)
+	return BM_set_compressed(map, x, y, val);
     if (map->sparse)
 	return BM_set_sparse(map, x, y, val);
 
@@ -224,6 +243,8 @@ int BM_get(struct BM *map, int x, int y)
     if (x < 0 || x >= map->cols || y < 0 || y >= map->rows)
 	return -1;
 
+    if (map->sparse == BM_COMPRESSED)
+	return BM_get_compressed(map, x, y);
     if (map->sparse)
 	return BM_get_sparse(map, x, y);
 
@@ -244,6 +265,8 @@ int BM_get(struct BM *map, int x, int y)
 
 size_t BM_get_map_size(struct BM *map)
 {
+    if (map->sparse == BM_COMPRESSED)
+	return BM_get_map_size_compressed(map);
     if (map->sparse)
 	return BM_get_map_size_sparse(map);
 
@@ -271,6 +294,8 @@ int BM_file_write(FILE * fp, struct BM *map)
     char c;
     int i;
 
+    if (map->sparse == BM_COMPRESSED)
+	return BM_file_write_compressed(fp, map);
     if (map->sparse)
 	return BM_file_write_sparse(fp, map);
 
@@ -340,6 +365,11 @@ struct BM *BM_file_read(FILE * fp)
 
     if (map->sparse == BM_SPARSE)
 	goto readsparse;
+    if (map->sparse == BM_COMPRESSED) {
+	if (BM_file_read_compressed(fp, map) < 0)
+	    return NULL;
+	return map;
+    }
 
     if (NULL == (map->data = (unsigned char *)malloc(map->bytes * map->rows)))
 	return (NULL);
@@ -0,0 +1,1044 @@
+/*
+ **  Bitmap library - compressed bitmaps
+ **
+ **  The cells of the bitmap are numbered row by row and cut into blocks
+ **  of 65536 cells. Each block holding a set cell has a container in one
+ **  of three forms, whichever is smaller for its contents:
+ **
+ **   array    sorted list of the set cells of the block (up to 4096)
+ **   bitset   8 KiB with one bit per cell
+ **   runs     sorted list of the first and last cell of each run of set
+ **            cells
+ **
+ **  Empty blocks take no memory besides a pointer, so that bitmaps of
+ **  huge but sparse rasters (masks, null cells, visited cells) stay
+ **  small, and set operations work on whole words or skip whole blocks.
+ **
+ **   BM_create_compressed (x, y)       Create compressed bitmap
+ **
+ **   BM_compact (map)                  Convert containers to their
+ **                                     smallest form
+ **
+ **   BM_or (map, other)                map = map OR other
+ **   BM_and (map, other)               map = map AND other
+ **   BM_andnot (map, other)            map = map AND NOT other
+ **
+ **   BM_count (map)                    Number of set cells
+ **
+ **   BM_next_set (map, &x, &y)         Next set cell in row order
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <grass/linkm.h>
+#include <grass/bitmap.h>
+
+
+#define BLOCK_BITS   16
+#define BLOCK_CELLS  (1 << BLOCK_BITS)
+#define BLOCK_MASK   (BLOCK_CELLS - 1)
+#define BITSET_WORDS (BLOCK_CELLS / 64)
+#define ARRAY_MAX    4096	/* array of 8 KiB, the size of a bitset */
+#define RUNS_MAX     2048	/* runs of 8 KiB */
+
+#define C_ARRAY  0
+#define C_BITSET 1
+#define C_RUNS   2
+
+struct BMcontainer
+{
+    int type;
+    int card;			/* number of set cells */
+    int n;			/* values of an array, runs */
+    int alloc;			/* values or runs allocated */
+    unsigned short *values;	/* array values, first and last of runs */
+    uint64_t *bits;
+};
+
+struct BMcompressed
+{
+    size_t nblocks;
+    struct BMcontainer **blocks;
+};
+
+#define BM_blocks(map) ((struct BMcompressed *)(map)->data)
+
+
+static int popcount(uint64_t w)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(w);
+#else
+    int n = 0;
+
+    while (w) {
+	w &= w - 1;
+	n++;
+    }
+    return n;
+#endif
+}
+
+static int lowest_bit(uint64_t w)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    int n = 0;
+
+    while (!(w & 1)) {
+	w >>= 1;
+	n++;
+    }
+    return n;
+#endif
+}
+
+/* first index of values[0..n) not less than v */
+static int lower_bound(const unsigned short *values, int n, int stride,
+		       unsigned v)
+{
+    int lo = 0, hi = n;
+
+    while (lo < hi) {
+	int mid = (lo + hi) / 2;
+
+	if (values[mid * stride] < v)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    return lo;
+}
+
+/* index of the run holding v or of the first run after it */
+static int find_run(const struct BMcontainer *c, unsigned v)
+{
+    int i = lower_bound(c->values, c->n, 2, v + 1);	/* first start > v */
+
+    if (i > 0 && c->values[2 * i - 1] >= v)
+	return i - 1;
+
+    return i;
+}
+
+static int reserve(struct BMcontainer *c, int n, int per_item)
+{
+    unsigned short *values;
+    int alloc;
+
+    if (n <= c->alloc)
+	return 0;
+
+    alloc = c->alloc ? 2 * c->alloc : 4;
+    while (alloc < n)
+	alloc *= 2;
+    values = realloc(c->values, (size_t) alloc * per_item *
+		     sizeof(unsigned short));
+    if (values == NULL)
+	return -1;
+    c->values = values;
+    c->alloc = alloc;
+
+    return 0;
+}
+
+static void free_container(struct BMcontainer *c)
+{
+    free(c->values);
+    free(c->bits);
+    free(c);
+}
+
+/* expand a container into a zeroed bitset */
+static void container_to_bits(const struct BMcontainer *c, uint64_t * bits)
+{
+    int i;
+    unsigned v;
+
+    switch (c->type) {
+    case C_BITSET:
+	memcpy(bits, c->bits, BITSET_WORDS * sizeof(uint64_t));
+	break;
+    case C_ARRAY:
+	for (i = 0; i < c->n; i++) {
+	    v = c->values[i];
+	    bits[v >> 6] |= (uint64_t) 1 << (v & 63);
+	}
+	break;
+    case C_RUNS:
+	for (i = 0; i < c->n; i++)
+	    for (v = c->values[2 * i]; v <= c->values[2 * i + 1]; v++)
+		bits[v >> 6] |= (uint64_t) 1 << (v & 63);
+	break;
+    }
+}
+
+/* container in its smallest form for a bitset, NULL if it is empty */
+static struct BMcontainer *container_from_bits(const uint64_t * bits)
+{
+    struct BMcontainer *c;
+    uint64_t prev = 0;
+    int i, card = 0, runs = 0;
+
+    for (i = 0; i < BITSET_WORDS; i++) {
+	uint64_t w = bits[i];
+
+	card += popcount(w);
+	/* a run starts at each set bit after a clear one */
+	runs += popcount(w & ~((w << 1) | (prev >> 63)));
+	prev = w;
+    }
+    if (card == 0)
+	return NULL;
+
+    if (NULL == (c = calloc(1, sizeof(struct BMcontainer))))
+	return NULL;
+    c->card = card;
+
+    if (4 * runs < 2 * card && runs <= RUNS_MAX) {
+	int in_run = 0;
+
+	c->type = C_RUNS;
+	if (reserve(c, runs, 2) < 0) {
+	    free_container(c);
+	    return NULL;
+	}
+	for (i = 0; i < BLOCK_CELLS; i++) {
+	    int set = (bits[i >> 6] >> (i & 63)) & 1;
+
+	    if (set && !in_run)
+		c->values[2 * c->n] = i;
+	    else if (!set && in_run)
+		c->values[2 * c->n++ + 1] = i - 1;
+	    in_run = set;
+	}
+	if (in_run)
+	    c->values[2 * c->n++ + 1] = BLOCK_CELLS - 1;
+    }
+    else if (card <= ARRAY_MAX) {
+	c->type = C_ARRAY;
+	if (reserve(c, card, 1) < 0) {
+	    free_container(c);
+	    return NULL;
+	}
+	for (i = 0; i < BITSET_WORDS; i++) {
+	    uint64_t w = bits[i];
+
+	    while (w) {
+		c->values[c->n++] = i * 64 + lowest_bit(w);
+		w &= w - 1;
+	    }
+	}
+    }
+    else {
+	c->type = C_BITSET;
+	if (NULL == (c->bits = malloc(BITSET_WORDS * sizeof(uint64_t)))) {
+	    free_container(c);
+	    return NULL;
+	}
+	memcpy(c->bits, bits, BITSET_WORDS * sizeof(uint64_t));
+    }
+
+    return c;
+}
+
+/* turn an array or runs container into a bitset */
+static int make_bitset(struct BMcontainer *c)
+{
+    uint64_t *bits = calloc(BITSET_WORDS, sizeof(uint64_t));
+
+    if (bits == NULL)
+	return -1;
+    container_to_bits(c, bits);
+    free(c->values);
+    c->values = NULL;
+    c->n = c->alloc = 0;
+    c->bits = bits;
+    c->type = C_BITSET;
+
+    return 0;
+}
+
+static int container_get(const struct BMcontainer *c, unsigned v)
+{
+    int i;
+
+    switch (c->type) {
+    case C_BITSET:
+	return (c->bits[v >> 6] >> (v & 63)) & 1;
+    case C_ARRAY:
+	i = lower_bound(c->values, c->n, 1, v);
+	return i < c->n && c->values[i] == v;
+    default:
+	i = find_run(c, v);
+	return i < c->n && c->values[2 * i] <= v;
+    }
+}
+
+/* set v, return 1 if it was clear, -1 on error */
+static int container_set(struct BMcontainer *c, unsigned v)
+{
+    unsigned short *r;
+    int i;
+
+    switch (c->type) {
+    case C_BITSET:
+	if ((c->bits[v >> 6] >> (v & 63)) & 1)
+	    return 0;
+	c->bits[v >> 6] |= (uint64_t) 1 << (v & 63);
+	break;
+
+    case C_ARRAY:
+	i = lower_bound(c->values, c->n, 1, v);
+	if (i < c->n && c->values[i] == v)
+	    return 0;
+	if (c->n == ARRAY_MAX) {
+	    if (make_bitset(c) < 0)
+		return -1;
+	    return container_set(c, v);
+	}
+	if (reserve(c, c->n + 1, 1) < 0)
+	    return -1;
+	memmove(&c->values[i + 1], &c->values[i],
+		(c->n - i) * sizeof(unsigned short));
+	c->values[i] = v;
+	c->n++;
+	break;
+
+    default:
+	i = find_run(c, v);
+	r = c->values;
+	if (i < c->n && r[2 * i] <= v)
+	    return 0;
+	/* run i is the first one after v */
+	if (i > 0 && r[2 * i - 1] + 1 == v) {
+	    if (i < c->n && r[2 * i] == v + 1) {
+		/* v joins two runs */
+		r[2 * i - 1] = r[2 * i + 1];
+		memmove(&r[2 * i], &r[2 * i + 2],
+			2 * (c->n - i - 1) * sizeof(unsigned short));
+		c->n--;
+	    }
+	    else
+		r[2 * i - 1] = v;
+	}
+	else if (i < c->n && r[2 * i] == v + 1)
+	    r[2 * i] = v;
+	else {
+	    if (c->n == RUNS_MAX) {
+		if (make_bitset(c) < 0)
+		    return -1;
+		return container_set(c, v);
+	    }
+	    if (reserve(c, c->n + 1, 2) < 0)
+		return -1;
+	    r = c->values;
+	    memmove(&r[2 * i + 2], &r[2 * i],
+		    2 * (c->n - i) * sizeof(unsigned short));
+	    r[2 * i] = r[2 * i + 1] = v;
+	    c->n++;
+	}
+	break;
+    }
+
+    c->card++;
+
+    return 1;
+}
+
+/* clear v, return 1 if it was set, -1 on error */
+static int container_clear(struct BMcontainer *c, unsigned v)
+{
+    unsigned short *r;
+    int i;
+
+    switch (c->type) {
+    case C_BITSET:
+	if (!((c->bits[v >> 6] >> (v & 63)) & 1))
+	    return 0;
+	c->bits[v >> 6] &= ~((uint64_t) 1 << (v & 63));
+	break;
+
+    case C_ARRAY:
+	i = lower_bound(c->values, c->n, 1, v);
+	if (i == c->n || c->values[i] != v)
+	    return 0;
+	memmove(&c->values[i], &c->values[i + 1],
+		(c->n - i - 1) * sizeof(unsigned short));
+	c->n--;
+	break;
+
+    default:
+	i = find_run(c, v);
+	r = c->values;
+	if (i == c->n || r[2 * i] > v)
+	    return 0;
+	if (r[2 * i] == v && r[2 * i + 1] == v) {
+	    memmove(&r[2 * i], &r[2 * i + 2],
+		    2 * (c->n - i - 1) * sizeof(unsigned short));
+	    c->n--;
+	}
+	else if (r[2 * i] == v)
+	    r[2 * i]++;
+	else if (r[2 * i + 1] == v)
+	    r[2 * i + 1]--;
+	else {
+	    /* split the run */
+	    if (c->n == RUNS_MAX) {
+		if (make_bitset(c) < 0)
+		    return -1;
+		return container_clear(c, v);
+	    }
+	    if (reserve(c, c->n + 1, 2) < 0)
+		return -1;
+	    r = c->values;
+	    memmove(&r[2 * i + 2], &r[2 * i],
+		    2 * (c->n - i) * sizeof(unsigned short));
+	    r[2 * i + 1] = v - 1;
+	    r[2 * i + 2] = v + 1;
+	    c->n++;
+	}
+	break;
+    }
+
+    c->card--;
+
+    return 1;
+}
+
+/* first set value >= v, -1 if none */
+static int container_next(const struct BMcontainer *c, unsigned v)
+{
+    int i;
+
+    switch (c->type) {
+    case C_BITSET:
+	{
+	    uint64_t w = c->bits[v >> 6] & (~(uint64_t) 0 << (v & 63));
+
+	    for (i = v >> 6;;) {
+		if (w)
+		    return i * 64 + lowest_bit(w);
+		if (++i == BITSET_WORDS)
+		    return -1;
+		w = c->bits[i];
+	    }
+	}
+    case C_ARRAY:
+	i = lower_bound(c->values, c->n, 1, v);
+	return i < c->n ? c->values[i] : -1;
+    default:
+	i = find_run(c, v);
+	if (i == c->n)
+	    return -1;
+	return c->values[2 * i] > v ? c->values[2 * i] : (int)v;
+    }
+}
+
+static size_t container_size(const struct BMcontainer *c)
+{
+    size_t size = sizeof(struct BMcontainer);
+
+    if (c->type == C_BITSET)
+	size += BITSET_WORDS * sizeof(uint64_t);
+    else
+	size += (size_t) c->alloc * (c->type == C_RUNS ? 2 : 1) *
+	    sizeof(unsigned short);
+
+    return size;
+}
+
+
+/*!
+ * \brief
+ *
+ * Create a compressed bitmap of dimension 'x'/'y'
+ *
+ * Set cells are kept per block of 65536 cells in the smallest of a
+ * sorted array, a bitset or a list of runs; empty blocks take no
+ * memory.
+ *
+ * Returns bitmap structure or NULL on error
+ *
+ *  \param x
+ *  \param y
+ *  \return struct BM
+ */
+
+struct BM *BM_create_compressed(int x, int y)
+{
+    struct BM *map;
+    struct BMcompressed *cm;
+
+    if (NULL == (map = (struct BM *)malloc(sizeof(struct BM))))
+	return (NULL);
+    if (NULL == (cm = (struct BMcompressed *)
+		 malloc(sizeof(struct BMcompressed)))) {
+	free(map);
+	return (NULL);
+    }
+
+    cm->nblocks = ((size_t) x * y + BLOCK_MASK) >> BLOCK_BITS;
+    if (NULL == (cm->blocks = (struct BMcontainer **)
+		 calloc(cm->nblocks ? cm->nblocks : 1,
+			sizeof(struct BMcontainer *)))) {
+	free(cm);
+	free(map);
+	return (NULL);
+    }
+
+    map->bytes = (x + 7) / 8;
+    map->rows = y;
+    map->cols = x;
+    map->data = (unsigned char *)cm;
+    map->sparse = BM_COMPRESSED;
+    map->token = NULL;
+
+    return map;
+}
+
+
+/*!
+ * \brief
+ *
+ * Destroy compressed bitmap and free all associated memory
+ *
+ * Returns 0
+ *
+ *  \param map
+ *  \return int
+ */
+
+int BM_destroy_compressed(struct BM *map)
+{
+    struct BMcompressed *cm = BM_blocks(map);
+    size_t i;
+
+    for (i = 0; i < cm->nblocks; i++)
+	if (cm->blocks[i])
+	    free_container(cm->blocks[i]);
+    free(cm->blocks);
+    free(cm);
+    free(map);
+
+    return 0;
+}
+
+
+/*!
+ * \brief
+ *
+ * Set compressed bitmap value to 'val' at location 'x'/'y'
+ *
+ * Returns 0 or -1 if out of memory
+ *
+ *  \param map
+ *  \param x
+ *  \param y
+ *  \param val
+ *  \return int
+ */
+
+int BM_set_compressed(struct BM *map, int x, int y, int val)
+{
+    struct BMcompressed *cm = BM_blocks(map);
+    size_t cell = (size_t) y * map->cols + x;
+    struct BMcontainer **c = &cm->blocks[cell >> BLOCK_BITS];
+    int ret;
+
+    if (!val) {
+	if (*c == NULL)
+	    return 0;
+	ret = container_clear(*c, cell & BLOCK_MASK);
+	if ((*c)->card == 0) {
+	    free_container(*c);
+	    *c = NULL;
+	}
+	else if ((*c)->type == C_BITSET && (*c)->card < ARRAY_MAX / 2) {
+	    /* back to an array once clearly smaller */
+	    struct BMcontainer *smaller = container_from_bits((*c)->bits);
+
+	    if (smaller) {
+		free_container(*c);
+		*c = smaller;
+	    }
+	}
+	return ret < 0 ? -1 : 0;
+    }
+
+    if (*c == NULL) {
+	if (NULL == (*c = calloc(1, sizeof(struct BMcontainer))))
+	    return -1;
+	(*c)->type = C_ARRAY;
+    }
+
+    return container_set(*c, cell & BLOCK_MASK) < 0 ? -1 : 0;
+}
+
+
+/*!
+ * \brief
+ *
+ * Returns compressed bitmap value at location 'x'/'y'
+ *
+ *  \param map
+ *  \param x
+ *  \param y
+ *  \return int
+ */
+
+int BM_get_compressed(struct BM *map, int x, int y)
+{
+    struct BMcompressed *cm = BM_blocks(map);
+    size_t cell = (size_t) y * map->cols + x;
+    const struct BMcontainer *c = cm->blocks[cell >> BLOCK_BITS];
+
+    if (c == NULL)
+	return 0;
+
+    return container_get(c, cell & BLOCK_MASK);
+}
+
+
+/*!
+ * \brief
+ *
+ * Returns size of compressed bitmap in bytes
+ *
+ *  \param map
+ *  \return size_t
+ */
+
+size_t BM_get_map_size_compressed(struct BM *map)
+{
+    struct BMcompressed *cm = BM_blocks(map);
+    size_t i, size;
+
+    size = sizeof(struct BMcompressed) +
+	cm->nblocks * sizeof(struct BMcontainer *);
+    for (i = 0; i < cm->nblocks; i++)
+	if (cm->blocks[i])
+	    size += container_size(cm->blocks[i]);
+
+    return size;
+}
+
+
+/*!
+ * \brief
+ *
+ * Convert the blocks of a compressed bitmap to their smallest form
+ *
+ * Blocks are converted while cells are set, but turned into runs only
+ * here; call it after a bitmap was filled with long runs of set cells.
+ * Other bitmaps are left alone.
+ *
+ * Returns 0 or -1 if out of memory
+ *
+ *  \param map
+ *  \return int
+ */
+
+int BM_compact(struct BM *map)
+{
+    struct BMcompressed *cm;
+    uint64_t bits[BITSET_WORDS];
+    size_t i;
+
+    if (map->sparse != BM_COMPRESSED)
+	return 0;
+
+    cm = BM_blocks(map);
+    for (i = 0; i < cm->nblocks; i++) {
+	struct BMcontainer *c = cm->blocks[i];
+
+	if (c == NULL)
+	    continue;
+	memset(bits, 0, sizeof(bits));
+	container_to_bits(c, bits);
+	if (NULL == (cm->blocks[i] = container_from_bits(bits))) {
+	    cm->blocks[i] = c;
+	    return -1;
+	}
+	free_container(c);
+    }
+
+    return 0;
+}
+
+
+#define OP_OR     0
+#define OP_AND    1
+#define OP_ANDNOT 2
+
+/* map = map op other on cells */
+static void combine_cells(struct BM *map, struct BM *other, int op)
+{
+    int x, y, a, b;
+
+    for (y = 0; y < map->rows; y++)
+	for (x = 0; x < map->cols; x++) {
+	    a = BM_get(map, x, y);
+	    b = BM_get(other, x, y);
+	    if (op == OP_OR)
+		a = a || b;
+	    else if (op == OP_AND)
+		a = a && b;
+	    else
+		a = a && !b;
+	    BM_set(map, x, y, a);
+	}
+}
+
+static int combine(struct BM *map, struct BM *other, int op)
+{
+    struct BMcompressed *a, *b;
+    uint64_t abits[BITSET_WORDS], bbits[BITSET_WORDS];
+    size_t i;
+    int j;
+
+    if (map->rows != other->rows || map->cols != other->cols)
+	return -1;
+
+    if (map->sparse != BM_COMPRESSED || other->sparse != BM_COMPRESSED) {
+	combine_cells(map, other, op);
+	return 0;
+    }
+
+    a = BM_blocks(map);
+    b = BM_blocks(other);
+    for (i = 0; i < a->nblocks; i++) {
+	struct BMcontainer *ca = a->blocks[i], *cb = b->blocks[i];
+
+	/* blocks decided by one side */
+	if (cb == NULL) {
+	    if (op == OP_AND && ca) {
+		free_container(ca);
+		a->blocks[i] = NULL;
+	    }
+	    continue;
+	}
+	if (ca == NULL && op != OP_OR)
+	    continue;
+
+	memset(abits, 0, sizeof(abits));
+	memset(bbits, 0, sizeof(bbits));
+	if (ca)
+	    container_to_bits(ca, abits);
+	container_to_bits(cb, bbits);
+
+	if (op == OP_OR)
+	    for (j = 0; j < BITSET_WORDS; j++)
+		abits[j] |= bbits[j];
+	else if (op == OP_AND)
+	    for (j = 0; j < BITSET_WORDS; j++)
+		abits[j] &= bbits[j];
+	else
+	    for (j = 0; j < BITSET_WORDS; j++)
+		abits[j] &= ~bbits[j];
+
+	a->blocks[i] = container_from_bits(abits);
+	if (ca)
+	    free_container(ca);
+    }
+
+    return 0;
+}
+
+
+/*!
+ * \brief
+ *
+ * Set the cells of 'map' which are set in 'other' (map = map OR other)
+ *
+ * Works on whole blocks if both bitmaps are compressed, cell by cell
+ * otherwise.
+ *
+ * Returns 0 or -1 if the dimensions differ
+ *
+ *  \param map
+ *  \param other
+ *  \return int
+ */
+
+int BM_or(struct BM *map, struct BM *other)
+{
+    return combine(map, other, OP_OR);
+}
+
+
+/*!
+ * \brief
+ *
+ * Clear the cells of 'map' which are clear in 'other'
+ * (map = map AND other)
+ *
+ * Returns 0 or -1 if the dimensions differ
+ *
+ *  \param map
+ *  \param other
+ *  \return int
+ */
+
+int BM_and(struct BM *map, struct BM *other)
+{
+    return combine(map, other, OP_AND);
+}
+
+
+/*!
+ * \brief
+ *
+ * Clear the cells of 'map' which are set in 'other'
+ * (map = map AND NOT other)
+ *
+ * Returns 0 or -1 if the dimensions differ
+ *
+ *  \param map
+ *  \param other
+ *  \return int
+ */
+
+int BM_andnot(struct BM *map, struct BM *other)
+{
+    return combine(map, other, OP_ANDNOT);
+}
+
+
+/*!
+ * \brief
+ *
+ * Returns the number of set cells of a bitmap
+ *
+ *  \param map
+ *  \return size_t
+ */
+
+size_t BM_count(struct BM *map)
+{
+    size_t i, n = 0;
+    int x, y;
+
+    if (map->sparse == BM_COMPRESSED) {
+	struct BMcompressed *cm = BM_blocks(map);
+
+	for (i = 0; i < cm->nblocks; i++)
+	    if (cm->blocks[i])
+		n += cm->blocks[i]->card;
+	return n;
+    }
+
+    for (y = 0; y < map->rows; y++)
+	for (x = 0; x < map->cols; x++)
+	    if (BM_get(map, x, y) == 1)
+		n++;
+
+    return n;
+}
+
+
+/*!
+ * \brief
+ *
+ * Find the next set cell
+ *
+ * Searches the cells from 'x'/'y' on in row order, 'x' may be equal to
+ * the number of columns. All set cells are visited by
+ *
+ *   for (x = y = 0; BM_next_set(map, &x, &y); x++)
+ *
+ * Compressed bitmaps skip empty blocks at once.
+ *
+ * Returns 1 and the cell in 'x'/'y', or 0 if there is no set cell left
+ *
+ *  \param map
+ *  \param[in,out] x
+ *  \param[in,out] y
+ *  \return int
+ */
+
+int BM_next_set(struct BM *map, int *x, int *y)
+{
+    size_t cell, ncells = (size_t) map->rows * map->cols;
+
+    if (*y < 0 || *x < 0)
+	*x = *y = 0;
+    cell = (size_t) * y * map->cols + *x;
+
+    if (map->sparse == BM_COMPRESSED) {
+	struct BMcompressed *cm = BM_blocks(map);
+	size_t i;
+
+	for (i = cell >> BLOCK_BITS; i < cm->nblocks; i++) {
+	    const struct BMcontainer *c = cm->blocks[i];
+	    int v;
+
+	    if (c == NULL)
+		continue;
+	    v = container_next(c, i == cell >> BLOCK_BITS ?
+			       cell & BLOCK_MASK : 0);
+	    if (v >= 0) {
+		cell = (i << BLOCK_BITS) + v;
+		*y = cell / map->cols;
+		*x = cell % map->cols;
+		return 1;
+	    }
+	}
+	return 0;
+    }
+
+    for (; cell < ncells; cell++)
+	if (BM_get(map, cell % map->cols, cell / map->cols) == 1) {
+	    *y = cell / map->cols;
+	    *x = cell % map->cols;
+	    return 1;
+	}
+
+    return 0;
+}
+
+
+/*!
+ * \brief
+ *
+ * Write compressed bitmap out to disk file 'fp'.
+ * NOTE: 'fp' must already be opened and later closed by user
+ *
+ * Returns 0 on success or -1 on error
+ *
+ *  \param fp
+ *  \param map
+ *  \return int
+ */
+
+int BM_file_write_compressed(FILE * fp, struct BM *map)
+{
+    struct BMcompressed *cm = BM_blocks(map);
+    size_t i, count;
+    char c;
+
+    c = BM_MAGIC;
+    fwrite(&c, sizeof(char), sizeof(char), fp);
+
+    fwrite(BM_TEXT, BM_TEXT_LEN, sizeof(char), fp);
+
+    c = BM_COMPRESSED;
+    fwrite(&c, sizeof(char), sizeof(char), fp);
+
+    fwrite(&(map->rows), sizeof(map->rows), sizeof(char), fp);
+
+    fwrite(&(map->cols), sizeof(map->cols), sizeof(char), fp);
+
+    count = 0;
+    for (i = 0; i < cm->nblocks; i++)
+	if (cm->blocks[i])
+	    count++;
+    fwrite(&count, sizeof(count), sizeof(char), fp);
+
+    for (i = 0; i < cm->nblocks; i++) {
+	const struct BMcontainer *b = cm->blocks[i];
+	size_t n;
+
+	if (b == NULL)
+	    continue;
+
+	fwrite(&i, sizeof(i), sizeof(char), fp);
+	c = b->type;
+	fwrite(&c, sizeof(char), sizeof(char), fp);
+	fwrite(&(b->card), sizeof(b->card), sizeof(char), fp);
+	fwrite(&(b->n), sizeof(b->n), sizeof(char), fp);
+
+	if (b->type == C_BITSET)
+	    n = fwrite(b->bits, sizeof(uint64_t), BITSET_WORDS, fp) !=
+		BITSET_WORDS;
+	else {
+	    size_t len = (size_t) b->n * (b->type == C_RUNS ? 2 : 1);
+
+	    n = fwrite(b->values, sizeof(unsigned short), len, fp) != len;
+	}
+	if (n)
+	    return -1;
+    }
+    fflush(fp);
+
+    return 0;
+}
+
+
+/*!
+ * \brief
+ *
+ * Read the blocks of a compressed bitmap
+ *
+ * Called by <b>BM_file_read()</b> after the header was read into 'map'.
+ *
+ * Returns 0 on success or -1 on error
+ *
+ *  \param fp
+ *  \param map
+ *  \return int
+ */
+
+int BM_file_read_compressed(FILE * fp, struct BM *map)
+{
+    struct BM *tmp;
+    struct BMcompressed *cm;
+    size_t i, count;
+
+    if (NULL == (tmp = BM_create_compressed(map->cols, map->rows)))
+	return -1;
+    cm = BM_blocks(tmp);
+    /* the structure is kept, the temporary map is not */
+    map->data = tmp->data;
+    map->token = NULL;
+    free(tmp);
+
+    if (fread(&count, sizeof(count), 1, fp) != 1)
+	return -1;
+
+    for (i = 0; i < count; i++) {
+	struct BMcontainer *b;
+	size_t key, len;
+	char c;
+
+	if (fread(&key, sizeof(key), 1, fp) != 1 || key >= cm->nblocks ||
+	    cm->blocks[key] != NULL || fread(&c, sizeof(c), 1, fp) != 1)
+	    return -1;
+
+	if (NULL == (b = calloc(1, sizeof(struct BMcontainer))))
+	    return -1;
+	cm->blocks[key] = b;
+	b->type = c;
+	if (fread(&(b->card), sizeof(b->card), 1, fp) != 1 ||
+	    fread(&(b->n), sizeof(b->n), 1, fp) != 1)
+	    return -1;
+
+	switch (b->type) {
+	case C_BITSET:
+	    b->n = 0;
+	    if (NULL == (b->bits = malloc(BITSET_WORDS * sizeof(uint64_t))) ||
+		fread(b->bits, sizeof(uint64_t), BITSET_WORDS, fp) !=
+		BITSET_WORDS)
+		return -1;
+	    break;
+	case C_ARRAY:
+	case C_RUNS:
+	    len = b->type == C_RUNS ? 2 : 1;
+	    if (b->n < 1 || b->n > (b->type == C_RUNS ? RUNS_MAX : ARRAY_MAX))
+		return -1;
+	    if (reserve(b, b->n, len) < 0 ||
+		fread(b->values, sizeof(unsigned short), b->n * len, fp) !=
+		b->n * len)
+		return -1;
+	    break;
+	default:
+	    return -1;
+	}
+    }
+
+    return 0;
+}
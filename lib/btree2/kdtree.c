@@ -19,6 +19,7 @@
 #include <grass/gis.h>
 #include <grass/glocale.h>
 #include "kdtree.h"
+#include "pool.h"
 
 #ifdef MAX
 #undef MAX
@@ -27,6 +28,14 @@
 
 #define KD_BTOL 7
 
+/* nodes are followed by their coordinates in the pool of the tree */
+#define KD_NODE_SIZE \
+    ((sizeof(struct kdnode) + sizeof(double) - 1) / sizeof(double) * sizeof(double))
+#define KD_COORDS(n) ((double *)((char *)(n) + KD_NODE_SIZE))
+
+/* points per task of kdtree_create_bulk() */
+#define KD_BULK_TASK 16384
+
 #ifdef KD_DEBUG
 #undef KD_DEBUG
 #endif
@@ -34,6 +43,9 @@
 static int rcalls = 0;
 static int rcallsmax = 0;
 
+/* dimensions compared by cmp_dup() */
+static int kd_sort_dims;
+
 static struct kdnode *kdtree_insert2(struct kdtree *, struct kdnode *,
                                      struct kdnode *, int, int);
 static int kdtree_replace(struct kdtree *, struct kdnode *);
@@ -65,9 +77,9 @@ static int cmpc(struct kdnode *a, struct kdnode *b, struct kdtree *t)
 
 static struct kdnode *kdtree_newnode(struct kdtree *t)
 {
-    struct kdnode *n = G_malloc(sizeof(struct kdnode));
+    struct kdnode *n = btree2_pool_alloc(t->pool);
     
-    n->c = G_malloc(t->ndims * sizeof(double));
+    n->c = KD_COORDS(n);
     n->dim = 0;
     n->depth = 0;
     n->balance = 0;
@@ -78,10 +90,9 @@ static struct kdnode *kdtree_newnode(struct kdtree *t)
     return n;
 }
 
-static void kdtree_free_node(struct kdnode *n)
+static void kdtree_free_node(struct kdtree *t, struct kdnode *n)
 {
-    G_free(n->c);
-    G_free(n);
+    btree2_pool_free(t->pool, n);
 }
 
 static void kdtree_update_node(struct kdtree *t, struct kdnode *n)
@@ -135,36 +146,206 @@ struct kdtree *kdtree_create(char ndims, int *btol)
 
     t->count = 0;
     t->root = NULL;
+    t->pool = btree2_pool_create(KD_NODE_SIZE + t->csize);
 
     return t;
 }
 
-/* clear the tree, removing all entries */
-void kdtree_clear(struct kdtree *t)
+/* kdtree_create_bulk(): the tree is built by median partitioning of
+ * an array of nodes, the median of a range in the split dimension
+ * becomes the root of the subtree of the range */
+
+struct kdbulk
 {
-    struct kdnode *it;
-    struct kdnode *save = t->root;
+    struct kdtree *t;
+    struct kdnode **a;
+    struct G_task_group *g;	/* NULL to build in this thread */
+};
 
-    /*
-    Rotate away the left links so that
-    we can treat this like the destruction
-    of a linked list
-    */
-    while((it = save) != NULL) {
-	if (it->child[0] == NULL) {
-	    /* No left links, just kill the node and move on */
-	    save = it->child[1];
-	    kdtree_free_node(it);
-	    it = NULL;
+struct kdbulk_task
+{
+    struct kdbulk *b;
+    int lo, hi;
+    int dim;
+    struct kdnode **link;
+};
+
+static struct kdnode *kdtree_build(struct kdbulk *, int, int, int);
+
+/* order of points with the same coordinates before sorting */
+static int cmp_dup(const void *pa, const void *pb)
+{
+    struct kdnode *a = *(struct kdnode **)pa;
+    struct kdnode *b = *(struct kdnode **)pb;
+    int i;
+
+    for (i = 0; i < kd_sort_dims; i++) {
+	if (a->c[i] < b->c[i])
+	    return -1;
+	if (a->c[i] > b->c[i])
+	    return 1;
+    }
+
+    return (a < b ? -1 : a > b);
+}
+
+/* move the k-th smallest node of a[lo, hi) in dimension p to a[k],
+ * smaller nodes before, larger ones after it */
+static void kdtree_select(struct kdnode **a, int lo, int hi, int k, int p)
+{
+    struct kdnode *pv, *tmp;
+    int i, j, mid;
+
+    while (hi - lo > 1) {
+	/* median of three as pivot */
+	mid = lo + (hi - lo) / 2;
+	if (cmp(a[mid], a[lo], p) < 0) {
+	    tmp = a[mid]; a[mid] = a[lo]; a[lo] = tmp;
 	}
-	else {
-	    /* Rotate away the left link and check again */
-	    save = it->child[0];
-	    it->child[0] = save->child[1];
-	    save->child[1] = it;
+	if (cmp(a[hi - 1], a[lo], p) < 0) {
+	    tmp = a[hi - 1]; a[hi - 1] = a[lo]; a[lo] = tmp;
+	}
+	if (cmp(a[hi - 1], a[mid], p) < 0) {
+	    tmp = a[hi - 1]; a[hi - 1] = a[mid]; a[mid] = tmp;
+	}
+	pv = a[mid];
+
+	i = lo;
+	j = hi - 1;
+	while (i <= j) {
+	    while (cmp(a[i], pv, p) < 0)
+		i++;
+	    while (cmp(a[j], pv, p) > 0)
+		j--;
+	    if (i <= j) {
+		tmp = a[i]; a[i] = a[j]; a[j] = tmp;
+		i++;
+		j--;
+	    }
+	}
+
+	if (k <= j)
+	    hi = j + 1;
+	else if (k >= i)
+	    lo = i;
+	else
+	    return;
+    }
+}
+
+static void kdtree_build_task(void *closure)
+{
+    struct kdbulk_task *task = closure;
+
+    *task->link = kdtree_build(task->b, task->lo, task->hi, task->dim);
+    G_free(task);
+}
+
+static struct kdnode *kdtree_build(struct kdbulk *b, int lo, int hi, int dim)
+{
+    struct kdnode *n;
+    int m, size, depth;
+
+    if (lo >= hi)
+	return NULL;
+
+    m = lo + (hi - lo) / 2;
+    kdtree_select(b->a, lo, hi, m, dim);
+
+    /* the larger subtree has (hi - lo) / 2 nodes,
+     * the depth of a subtree of size nodes is log2(size) */
+    depth = 0;
+    for (size = hi - lo; size > 1; size >>= 1)
+	depth++;
+
+    n = b->a[m];
+    n->dim = dim;
+    n->depth = depth;
+    n->balance = 0;
+
+    if (b->g && m - lo >= KD_BULK_TASK) {
+	struct kdbulk_task *task = G_malloc(sizeof(struct kdbulk_task));
+
+	task->b = b;
+	task->lo = lo;
+	task->hi = m;
+	task->dim = b->t->nextdim[dim];
+	task->link = &n->child[0];
+	G_task_submit(b->g, kdtree_build_task, task);
+    }
+    else
+	n->child[0] = kdtree_build(b, lo, m, b->t->nextdim[dim]);
+    n->child[1] = kdtree_build(b, m + 1, hi, b->t->nextdim[dim]);
+
+    return n;
+}
+
+/* create a balanced k-d tree with ndims dimensions from n points,
+ * optionally set balancing tolerance */
+struct kdtree *kdtree_create_bulk(char ndims, int *btol, const double *c,
+                                  const int *uid, int n, int dc)
+{
+    struct kdtree *t;
+    struct kdbulk b;
+    char *nodes;
+    size_t item_size;
+    int i, count;
+
+    t = kdtree_create(ndims, btol);
+    if (n <= 0)
+	return t;
+
+    /* all nodes in one block */
+    nodes = btree2_pool_alloc_array(t->pool, n);
+    item_size = btree2_pool_item_size(t->pool);
+    b.t = t;
+    b.a = G_malloc(n * sizeof(struct kdnode *));
+    for (i = 0; i < n; i++) {
+	struct kdnode *nd = (struct kdnode *)(nodes + i * item_size);
+
+	nd->c = KD_COORDS(nd);
+	memcpy(nd->c, c + (size_t)i * t->ndims, t->csize);
+	nd->uid = uid ? uid[i] : i;
+	nd->child[0] = nd->child[1] = NULL;
+	b.a[i] = nd;
+    }
+
+    count = n;
+    if (!dc) {
+	/* keep the first of points with the same coordinates */
+	kd_sort_dims = t->ndims;
+	qsort(b.a, n, sizeof(struct kdnode *), cmp_dup);
+	count = 1;
+	for (i = 1; i < n; i++) {
+	    if (cmpc(b.a[i], b.a[count - 1], t))
+		b.a[count++] = b.a[i];
+	    else
+		kdtree_free_node(t, b.a[i]);
 	}
+	G_debug(1, "kdtree_create_bulk(): %d duplicates", n - count);
     }
+
+    b.g = NULL;
+    if (count >= 2 * KD_BULK_TASK && G_num_workers() > 0)
+	b.g = G_task_group_create();
+
+    t->root = kdtree_build(&b, 0, count, 0);
+    t->count = count;
+
+    if (b.g)
+	G_task_group_destroy(b.g);
+    G_free(b.a);
+
+    return t;
+}
+
+/* clear the tree, removing all entries */
+void kdtree_clear(struct kdtree *t)
+{
+    /* all nodes are in the pool */
+    btree2_pool_clear(t->pool);
     t->root = NULL;
+    t->count = 0;
 }
 
 /* destroy the tree */
@@ -172,6 +353,7 @@ void kdtree_destroy(struct kdtree *t)
 {
     /* remove all entries */
     kdtree_clear(t);
+    btree2_pool_destroy(t->pool);
     G_free(t->nextdim);
 
     G_free(t);
@@ -240,8 +422,9 @@ int kdtree_remove(struct kdtree *t, double *c, int uid)
     }
 
     if (s[top].n->depth == 0) {
-	kdtree_free_node(s[top].n);
+	kdtree_free_node(t, s[top].n);
 	s[top].n = NULL;
+	t->count--;
 	if (top) {
 	    top--;
 	    n = s[top].n;
@@ -735,6 +918,99 @@ int kdtree_dnn(struct kdtree *t, double *c, int **puid, double **pd,
     return found;
 }
 
+/* find all nearest neighbors within distance like kdtree_dnn(), 
+ * but only the uids are stored, unsorted
+ * results are stored in *puid of size *palloc which is enlarged as 
+ * needed, the same buffer can be used for several searches 
+ * the calling fn must free the memory
+ * optionally an uid to be skipped can be given */
+int kdtree_dnn_uids(struct kdtree *t, double *c, int **puid, int *palloc,
+                    double maxdist, int *skip)
+{
+    int i, found;
+    double diff, dist;
+    struct kdnode sn, *n;
+    struct kdstack {
+	struct kdnode *n;
+	int dir;
+	char v;
+    } s[256];
+    int dir;
+    int top;
+    double maxdistsq;
+
+    if (!t->root)
+	return 0;
+
+    sn.c = c;
+    sn.uid = (int)0x80000000;
+    if (skip)
+	sn.uid = *skip;
+
+    found = 0;
+    maxdistsq = maxdist * maxdist;
+
+    /* go down */
+    top = 0;
+    s[top].n = t->root;
+    while (s[top].n) {
+	n = s[top].n;
+	dir = cmp(&sn, n, n->dim) > 0;
+	s[top].dir = dir;
+	s[top].v = 0;
+	top++;
+	s[top].n = n->child[dir];
+    }
+    
+    /* go back up */
+    while (top) {
+	top--;
+	
+	if (!s[top].v) {
+	    s[top].v = 1;
+	    n = s[top].n;
+
+	    if (n->uid != sn.uid) {
+		dist = 0;
+		i = t->ndims - 1;
+		do {
+		    diff = sn.c[i] - n->c[i];
+		    dist += diff * diff;
+		    
+		} while (i-- && dist <= maxdistsq);
+
+		if (dist <= maxdistsq) {
+		    if (found >= *palloc) {
+			*palloc = found + 10 + found / 2;
+			*puid = G_realloc(*puid, *palloc * sizeof(int));
+		    }
+		    (*puid)[found++] = n->uid;
+		}
+	    }
+
+	    /* look on the other side ? */
+	    dir = s[top].dir;
+
+	    diff = fabs(sn.c[(int)n->dim] - n->c[(int)n->dim]);
+	    if (diff <= maxdist) {
+		/* go down the other side */
+		top++;
+		s[top].n = n->child[!dir];
+		while (s[top].n) {
+		    n = s[top].n;
+		    dir = cmp(&sn, n, n->dim) > 0;
+		    s[top].dir = dir;
+		    s[top].v = 0;
+		    top++;
+		    s[top].n = n->child[dir];
+		}
+	    }
+	}
+    }
+
+    return found;
+}
+
 /* find all nearest neighbors within range aka box search
  * the range is specified with min and max for each dimension as
  * (min1, min2, ..., minn, max1, max2, ..., maxn)
@@ -1084,7 +1360,7 @@ static int kdtree_replace(struct kdtree *t, struct kdnode *r)
     if (n->child[dir] != rn) {
 	G_fatal_error("Last replacement disappeared");
     }
-    kdtree_free_node(rn);
+    kdtree_free_node(t, rn);
     n->child[dir] = NULL;
     t->count--;
 
@@ -1164,7 +1440,7 @@ static int kdtree_balance(struct kdtree *t, struct kdnode *r, int bmode)
 #ifdef KD_DEBUG
     if (!cmp(r, or, r->dim)) {
 	G_warning("kdtree_balance: replacement failed");
-	kdtree_free_node(or);
+	kdtree_free_node(t, or);
 	
 	return 0;
     }
@@ -1229,7 +1505,7 @@ static struct kdnode *kdtree_insert2(struct kdtree *t, struct kdnode *r,
 	if (!cmpc(nnew, n, t) && (!dc || nnew->uid == n->uid)) {
 
 	    G_debug(1, "KD node exists already, nothing to do");
-	    kdtree_free_node(nnew);
+	    kdtree_free_node(t, nnew);
 
 	    if (!balance) {
 		rcalls--;
@@ -37,6 +37,10 @@
  *
  *     kdtree_insert(...);
  *
+ * Or create a balanced tree from all points at once:
+ *
+ *     kdtree_create_bulk(...);
+ *
  * Optionally optimize the tree:
  * 
  *     kdtree_optimize(...);
@@ -74,6 +78,8 @@ struct kdnode
     struct kdnode *child[2];    /*!< link to children: `[0]` for smaller, `[1]` for larger */
 };
 
+struct btree2_pool;
+
 /*!
  * \brief k-d tree
  */
@@ -85,6 +91,7 @@ struct kdtree
     int btol;                   /*!< balancing tolerance */
     size_t count;               /*!< number of items in the tree */
     struct kdnode *root;        /*!< tree root */
+    struct btree2_pool *pool;   /*!< memory for nodes */
 };
 
 /*!
@@ -104,6 +111,20 @@ struct kdtree *kdtree_create(char ndims,        /*!< number of dimensions */
                              int *btol  /*!< optional balancing tolerance */
     );
 
+/*! create a balanced k-d tree from n points
+ * the coordinates of point i are c[i * ndims] to c[i * ndims + ndims - 1],
+ * its uid is uid[i], or i if uid is NULL
+ * with dc == 0 only the first of points with the same coordinates
+ * is added, as with kdtree_insert(), otherwise the uids must be unique
+ * large trees are built by the worker threads (see G_set_nprocs()) */
+struct kdtree *kdtree_create_bulk(char ndims,   /*!< number of dimensions */
+                                  int *btol,    /*!< optional balancing tolerance */
+                                  const double *c,      /*!< coordinates */
+                                  const int *uid,       /*!< optional unique ids */
+                                  int n,        /*!< number of points */
+                                  int dc        /*!< allow duplicate coordinates */
+    );
+
 /*! destroy a tree */
 void kdtree_destroy(struct kdtree *t);
 
@@ -149,6 +170,20 @@ int kdtree_dnn(struct kdtree *t,        /*!< k-d tree */
                int *skip        /*!< unique id to skip */
     );
 
+/*! find all nearest neighbors within distance like kdtree_dnn(),
+ * but only the uids are stored, unsorted
+ * results are stored in *puid of size *palloc which is enlarged as
+ * needed, the same buffer can be used for several searches
+ * the calling fn must free the memory
+ * optionally an uid to be skipped can be given */
+int kdtree_dnn_uids(struct kdtree *t,   /*!< k-d tree */
+                    double *c,  /*!< coordinates */
+                    int **puid, /*!< unique ids of the neighbors */
+                    int *palloc,        /*!< allocated size of *puid */
+                    double maxdist,     /*!< radius to search around the given coordinates */
+                    int *skip   /*!< unique id to skip */
+    );
+
 /*! find all nearest neighbors within range aka box search
  * the range is specified with min and max for each dimension as
  * (min1, min2, ..., minn, max1, max2, ..., maxn)
@@ -0,0 +1,148 @@
+/*!
+ * \file pool.c
+ *
+ * \brief Pooled allocation of tree nodes
+ *
+ * Every tree takes its nodes, all of the same size, from its own pool.
+ * A pool gets memory from the system in slabs of many nodes and keeps
+ * freed nodes in a free list, so that inserting and removing items
+ * does not call malloc() and free() for each node, nodes of a tree
+ * are close together in memory, and clearing a tree only frees the
+ * slabs. A pool is not thread-safe, like the trees.
+ *
+ * (C) 2019 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdlib.h>
+#include <grass/gis.h>
+#include "pool.h"
+
+/* alignment of the items, enough for any basic type */
+union align
+{
+    long l;
+    double d;
+    void *p;
+};
+
+#define ALIGN sizeof(union align)
+#define ROUND(n) (((n) + ALIGN - 1) / ALIGN * ALIGN)
+
+#define FIRST_SLAB 64		/* items in the first slab */
+#define MAX_SLAB 8192		/* items in the largest slabs */
+
+struct slab
+{
+    struct slab *next;
+};
+
+#define HEADER ROUND(sizeof(struct slab))
+
+struct btree2_pool
+{
+    size_t item_size;
+    size_t slab_items;		/* items in the next slab */
+    struct slab *slabs;
+    char *next;			/* unused items of the last slab */
+    size_t left;
+    void *free;			/* freed items, linked through their first bytes */
+};
+
+/* create a pool of items of the given size */
+struct btree2_pool *btree2_pool_create(size_t item_size)
+{
+    struct btree2_pool *pool = G_malloc(sizeof(struct btree2_pool));
+
+    if (item_size < sizeof(void *))
+	item_size = sizeof(void *);
+    pool->item_size = ROUND(item_size);
+    pool->slab_items = FIRST_SLAB;
+    pool->slabs = NULL;
+    pool->next = NULL;
+    pool->left = 0;
+    pool->free = NULL;
+
+    return pool;
+}
+
+/* a new slab of n items */
+static char *add_slab(struct btree2_pool *pool, size_t n)
+{
+    struct slab *s = G_malloc(HEADER + n * pool->item_size);
+
+    s->next = pool->slabs;
+    pool->slabs = s;
+
+    return (char *)s + HEADER;
+}
+
+/* get one item */
+void *btree2_pool_alloc(struct btree2_pool *pool)
+{
+    void *p;
+
+    if (pool->free) {
+	p = pool->free;
+	pool->free = *(void **)p;
+
+	return p;
+    }
+
+    if (pool->left == 0) {
+	pool->next = add_slab(pool, pool->slab_items);
+	pool->left = pool->slab_items;
+	if (pool->slab_items < MAX_SLAB)
+	    pool->slab_items *= 2;
+    }
+
+    p = pool->next;
+    pool->next += pool->item_size;
+    pool->left--;
+
+    return p;
+}
+
+/* get n contiguous items, item i at i * btree2_pool_item_size();
+ * they can be given back one by one with btree2_pool_free() */
+void *btree2_pool_alloc_array(struct btree2_pool *pool, size_t n)
+{
+    return add_slab(pool, n > 0 ? n : 1);
+}
+
+/* give an item back to the pool */
+void btree2_pool_free(struct btree2_pool *pool, void *p)
+{
+    *(void **)p = pool->free;
+    pool->free = p;
+}
+
+/* give all items back, freeing the memory of the pool */
+void btree2_pool_clear(struct btree2_pool *pool)
+{
+    struct slab *s, *next;
+
+    for (s = pool->slabs; s; s = next) {
+	next = s->next;
+	G_free(s);
+    }
+    pool->slab_items = FIRST_SLAB;
+    pool->slabs = NULL;
+    pool->next = NULL;
+    pool->left = 0;
+    pool->free = NULL;
+}
+
+void btree2_pool_destroy(struct btree2_pool *pool)
+{
+    btree2_pool_clear(pool);
+    G_free(pool);
+}
+
+/* size of the items including padding */
+size_t btree2_pool_item_size(const struct btree2_pool *pool)
+{
+    return pool->item_size;
+}
@@ -0,0 +1,25 @@
+/*!
+ * \file pool.h
+ *
+ * \brief Pooled allocation of tree nodes (internal, see pool.c)
+ *
+ * (C) 2019 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#ifndef BTREE2_POOL_H
+#define BTREE2_POOL_H
+
+#include <stddef.h>
+
+struct btree2_pool *btree2_pool_create(size_t);
+void *btree2_pool_alloc(struct btree2_pool *);
+void *btree2_pool_alloc_array(struct btree2_pool *, size_t);
+void btree2_pool_free(struct btree2_pool *, void *);
+void btree2_pool_clear(struct btree2_pool *);
+void btree2_pool_destroy(struct btree2_pool *);
+size_t btree2_pool_item_size(const struct btree2_pool *);
+
+#endif
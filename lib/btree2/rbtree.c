@@ -24,6 +24,8 @@
  *
  * Red Black Trees are used to maintain a data structure with
  * search, insertion and deletion in O(log N) time
+ *
+ * nodes and data items are taken from pools of the tree, see pool.c
  */
 
 #include <assert.h>
@@ -32,6 +34,7 @@
 #include <grass/gis.h>
 #include <grass/glocale.h>
 #include <grass/rbtree.h>
+#include "pool.h"
 
 /* internal functions */
 static struct RB_NODE *rbtree_single(struct RB_NODE *, int);
@@ -40,7 +43,7 @@ static void *rbtree_first(struct RB_TRAV *);
 static void *rbtree_last(struct RB_TRAV *trav);
 static void *rbtree_next(struct RB_TRAV *);
 static void *rbtree_previous(struct RB_TRAV *);
-static struct RB_NODE *rbtree_make_node(size_t, void *);
+static struct RB_NODE *rbtree_make_node(struct RB_TREE *, void *);
 static int is_red(struct RB_NODE *);
 
 
@@ -62,6 +65,8 @@ struct RB_TREE *rbtree_create(rb_compare_fn *compare, size_t rb_datasize)
     tree->rb_compare = compare;
     tree->count = 0;
     tree->root = NULL;
+    tree->node_pool = btree2_pool_create(sizeof(struct RB_NODE));
+    tree->data_pool = btree2_pool_create(rb_datasize);
 
     return tree;
 }
@@ -77,7 +82,7 @@ int rbtree_insert(struct RB_TREE *tree, void *data)
 
     if (tree->root == NULL) {
 	/* create a new root node for tree */
-	tree->root = rbtree_make_node(tree->datasize, data);
+	tree->root = rbtree_make_node(tree, data);
 	if (tree->root == NULL)
 	    return 0;
     }
@@ -96,7 +101,7 @@ int rbtree_insert(struct RB_TREE *tree, void *data)
 	for (;;) {
 	    if (q == NULL) {
 		/* Insert new node at the bottom */
-		p->link[dir] = q = rbtree_make_node(tree->datasize, data);
+		p->link[dir] = q = rbtree_make_node(tree, data);
 		if (q == NULL)
 		    return 0;
 	    }
@@ -218,10 +223,10 @@ int rbtree_remove(struct RB_TREE *tree, const void *data)
 
     /* Replace and remove if found */
     if (f != NULL) {
-	free(f->data);
+	btree2_pool_free(tree->data_pool, f->data);
 	f->data = q->data;
 	p->link[p->link[1] == q] = q->link[q->link[0] == NULL];
-	free(q);
+	btree2_pool_free(tree->node_pool, q);
 	q = NULL;
 	tree->count--;
 	removed = 1;
@@ -489,31 +494,11 @@ void *rbtree_previous(struct RB_TRAV *trav)
 /* clear the tree, removing all entries */
 void rbtree_clear(struct RB_TREE *tree)
 {
-    struct RB_NODE *it;
-    struct RB_NODE *save = tree->root;
-
-    /*
-    Rotate away the left links so that
-    we can treat this like the destruction
-    of a linked list
-    */
-    while((it = save) != NULL) {
-	if (it->link[0] == NULL) {
-	    /* No left links, just kill the node and move on */
-	    save = it->link[1];
-	    free(it->data);
-	    it->data = NULL;
-	    free(it);
-	    it = NULL;
-	}
-	else {
-	    /* Rotate away the left link and check again */
-	    save = it->link[0];
-	    it->link[0] = save->link[1];
-	    save->link[1] = it;
-	}
-    }
+    /* all nodes and items are in the pools */
+    btree2_pool_clear(tree->node_pool);
+    btree2_pool_clear(tree->data_pool);
     tree->root = NULL;
+    tree->count = 0;
 }
 
 /* destroy the tree */
@@ -521,6 +506,8 @@ void rbtree_destroy(struct RB_TREE *tree)
 {
     /* remove all entries */
     rbtree_clear(tree);
+    btree2_pool_destroy(tree->node_pool);
+    btree2_pool_destroy(tree->data_pool);
 
     free(tree);
     tree = NULL;
@@ -586,18 +573,12 @@ int rbtree_debug(struct RB_TREE *tree, struct RB_NODE *root)
  *******************************************************/
 
 /* add a new node to the tree */
-static struct RB_NODE *rbtree_make_node(size_t datasize, void *data)
+static struct RB_NODE *rbtree_make_node(struct RB_TREE *tree, void *data)
 {
-    struct RB_NODE *new_node = (struct RB_NODE *)malloc(sizeof(*new_node));
-
-    if (new_node == NULL)
-	G_fatal_error("RB Search Tree: Out of memory!");
-
-    new_node->data = malloc(datasize);
-    if (new_node->data == NULL)
-	G_fatal_error("RB Search Tree: Out of memory!");
+    struct RB_NODE *new_node = btree2_pool_alloc(tree->node_pool);
 
-    memcpy(new_node->data, data, datasize);
+    new_node->data = btree2_pool_alloc(tree->data_pool);
+    memcpy(new_node->data, data, tree->datasize);
     new_node->red = 1;		/* 1 is red, 0 is black */
     new_node->link[0] = NULL;
     new_node->link[1] = NULL;
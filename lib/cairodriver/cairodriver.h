@@ -95,6 +95,7 @@ extern void Cairo_begin_raster(int, int[2][2], double[2][2]);
 extern int Cairo_raster(int, int,
 			const unsigned char *, const unsigned char *,
 			const unsigned char *, const unsigned char *);
+extern int Cairo_raster_columns(int, unsigned char *);
 extern void Cairo_end_raster(void);
 extern void Cairo_Begin(void);
 extern void Cairo_Move(double, double);
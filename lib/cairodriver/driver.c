@@ -37,6 +37,7 @@ const struct driver *Cairo_Driver(void)
     drv.Set_window = Cairo_Set_window;
     drv.Begin_raster = Cairo_begin_raster;
     drv.Raster = Cairo_raster;
+    drv.Raster_columns = Cairo_raster_columns;
     drv.End_raster = Cairo_end_raster;
     drv.Begin = Cairo_Begin;
     drv.Move = Cairo_Move;
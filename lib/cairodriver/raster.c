@@ -12,6 +12,7 @@
   \author Glynn Clements  
 */
 
+#include <string.h>
 #include <math.h>
 
 #include "cairodriver.h"
@@ -174,6 +175,35 @@ int Cairo_raster(int n, int row,
     return next_row(row, d_y1);
 }
 
+/*!
+  \brief Get the cells of a raster row which are drawn
+
+  Only the cells sampled for the visible pixel columns are drawn, the
+  caller may skip the color lookup of the others.
+
+  \param n number of cells
+  \param[out] used set to 1 for the cells which are drawn, 0 otherwise
+
+  \return 1
+*/
+int Cairo_raster_columns(int n, unsigned char *used)
+{
+    int x0 = MAX(0        - dst_l, 0);
+    int x1 = MIN(ca.width - dst_l, dst_w);
+    int x;
+
+    memset(used, 0, n);
+
+    for (x = x0; x < x1; x++) {
+	int j = trans[x];
+
+	if (j >= 0 && j < n)
+	    used[j] = 1;
+    }
+
+    return 1;
+}
+
 /*!
   \brief Finish drawing raster
 */
@@ -13,6 +13,7 @@ abs(x)
 
 int f_abs(int argc, const int *argt, void **args)
 {
+    int n = columns;
     int i;
 
     if (argc < 1)
@@ -29,12 +30,11 @@ int f_abs(int argc, const int *argt, void **args)
 	    CELL *res = args[0];
 	    CELL *arg1 = args[1];
 
-	    for (i = 0; i < columns; i++)
-		if (IS_NULL_C(&arg1[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg1[i] < 0 ? -arg1[i]
-			: arg1[i];
+	    for (i = 0; i < n; i++) {
+		CELL x = arg1[i];
+
+		res[i] = IS_NULL_C(&x) ? NULL_C : x < 0 ? -x : x;
+	    }
 	    return 0;
 	}
     case FCELL_TYPE:
@@ -42,11 +42,9 @@ int f_abs(int argc, const int *argt, void **args)
 	    FCELL *res = args[0];
 	    FCELL *arg1 = args[1];
 
-	    for (i = 0; i < columns; i++)
-		if (IS_NULL_F(&arg1[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = (FCELL) fabs(arg1[i]);
+	    /* the absolute value of NaN is NaN, i.e. NULL */
+	    for (i = 0; i < n; i++)
+		res[i] = (FCELL) fabs(arg1[i]);
 	    return 0;
 	}
     case DCELL_TYPE:
@@ -54,11 +52,8 @@ int f_abs(int argc, const int *argt, void **args)
 	    DCELL *res = args[0];
 	    DCELL *arg1 = args[1];
 
-	    for (i = 0; i < columns; i++)
-		if (IS_NULL_D(&arg1[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = fabs(arg1[i]);
+	    for (i = 0; i < n; i++)
+		res[i] = fabs(arg1[i]);
 	    return 0;
 	}
     default:
@@ -10,6 +10,7 @@ eq(a,b) = a == b
 int f_eq(int argc, const int *argt, void **args)
 {
     CELL *res = args[0];
+    int n = columns;
     int i;
 
     if (argc < 2)
@@ -30,11 +31,10 @@ int f_eq(int argc, const int *argt, void **args)
 	    CELL *arg1 = args[1];
 	    CELL *arg2 = args[2];
 
-	    for (i = 0; i < columns; i++) {
-		if (IS_NULL_C(&arg1[i]) || IS_NULL_C(&arg2[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg1[i] == arg2[i];
+	    for (i = 0; i < n; i++) {
+		CELL x = arg1[i], y = arg2[i];
+
+		res[i] = IS_NULL_C(&x) | IS_NULL_C(&y) ? NULL_C : x == y;
 	    }
 	    return 0;
 	}
@@ -43,11 +43,11 @@ int f_eq(int argc, const int *argt, void **args)
 	    FCELL *arg1 = args[1];
 	    FCELL *arg2 = args[2];
 
-	    for (i = 0; i < columns; i++) {
-		if (IS_NULL_F(&arg1[i]) || IS_NULL_F(&arg2[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg1[i] == arg2[i];
+	    for (i = 0; i < n; i++) {
+		FCELL x = arg1[i], y = arg2[i];
+		FCELL r = x == y;
+
+		res[i] = IS_NULL_F(&x) | IS_NULL_F(&y) ? NULL_C : (CELL) r;
 	    }
 	    return 0;
 	}
@@ -56,11 +56,11 @@ int f_eq(int argc, const int *argt, void **args)
 	    DCELL *arg1 = args[1];
 	    DCELL *arg2 = args[2];
 
-	    for (i = 0; i < columns; i++) {
-		if (IS_NULL_D(&arg1[i]) || IS_NULL_D(&arg2[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg1[i] == arg2[i];
+	    for (i = 0; i < n; i++) {
+		DCELL x = arg1[i], y = arg2[i];
+		DCELL r = x == y;
+
+		res[i] = IS_NULL_D(&x) | IS_NULL_D(&y) ? NULL_C : (CELL) r;
 	    }
 	    return 0;
 	}
@@ -10,6 +10,11 @@
  if(a,b,c,d)  d,c,b  b if a is positive, c if a is zero, d if a is negative
 ********************************************************************/
 
+/*
+ * the branches are selected cell by cell, without jumps; NULL
+ * arguments are copied and a NULL (NaN) condition is returned as is
+ */
+
 static int f_if_i(int argc, const int *argt, void **args)
 {
     CELL *res = args[0];
@@ -17,71 +22,43 @@ static int f_if_i(int argc, const int *argt, void **args)
     CELL *arg2 = (argc >= 2) ? args[2] : NULL;
     CELL *arg3 = (argc >= 3) ? args[3] : NULL;
     CELL *arg4 = (argc >= 4) ? args[4] : NULL;
+    int n = columns;
     int i;
 
     switch (argc) {
     case 0:
 	return E_ARG_LO;
     case 1:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_C(&res[i]);
-	    else
-		res[i] = arg1[i] != 0.0 ? 1 : 0;
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    DCELL r = c != 0.0;
+
+	    res[i] = IS_NULL_D(&c) ? NULL_C : (CELL) r;
+	}
 	break;
     case 2:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_C(&res[i]);
-	    else if (arg1[i] == 0.0)
-		res[i] = 0;
-	    else {
-		if (IS_NULL_C(&arg2[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    CELL x = arg2[i];
+
+	    res[i] = IS_NULL_D(&c) ? NULL_C : c == 0.0 ? 0 : x;
+	}
 	break;
     case 3:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_C(&res[i]);
-	    else if (arg1[i] == 0.0) {
-		if (IS_NULL_C(&arg3[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg3[i];
-	    }
-	    else {
-		if (IS_NULL_C(&arg2[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    CELL x = arg2[i], y = arg3[i];
+
+	    res[i] = IS_NULL_D(&c) ? NULL_C : c == 0.0 ? y : x;
+	}
 	break;
     case 4:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_C(&res[i]);
-	    else if (arg1[i] == 0.0) {
-		if (IS_NULL_C(&arg3[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg3[i];
-	    }
-	    else if (arg1[i] > 0.0) {
-		if (IS_NULL_C(&arg2[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
-	    else {		/* (arg1[i] < 0.0) */
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    CELL x = arg2[i], y = arg3[i], z = arg4[i];
 
-		if (IS_NULL_C(&arg4[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg4[i];
-	    }
+	    res[i] = IS_NULL_D(&c) ? NULL_C : c == 0.0 ? y : c > 0.0 ? x : z;
+	}
 	break;
     default:
 	return E_ARG_HI;
@@ -97,6 +74,7 @@ static int f_if_f(int argc, const int *argt, void **args)
     FCELL *arg2 = (argc >= 2) ? args[2] : NULL;
     FCELL *arg3 = (argc >= 3) ? args[3] : NULL;
     FCELL *arg4 = (argc >= 4) ? args[4] : NULL;
+    int n = columns;
     int i;
 
     switch (argc) {
@@ -105,58 +83,28 @@ static int f_if_f(int argc, const int *argt, void **args)
     case 1:
 	return E_ARG_TYPE;
     case 2:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_F(&res[i]);
-	    else if (arg1[i] == 0.0)
-		res[i] = 0.0;
-	    else {
-		if (IS_NULL_F(&arg2[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    FCELL x = arg2[i];
+
+	    res[i] = IS_NULL_D(&c) ? (FCELL) c : c == 0.0 ? 0.0f : x;
+	}
 	break;
     case 3:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_F(&res[i]);
-	    else if (arg1[i] == 0.0) {
-		if (IS_NULL_F(&arg3[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = arg3[i];
-	    }
-	    else {
-		if (IS_NULL_F(&arg2[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    FCELL x = arg2[i], y = arg3[i];
+
+	    res[i] = IS_NULL_D(&c) ? (FCELL) c : c == 0.0 ? y : x;
+	}
 	break;
     case 4:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_F(&res[i]);
-	    else if (arg1[i] == 0.0) {
-		if (IS_NULL_F(&arg3[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = arg3[i];
-	    }
-	    else if (arg1[i] > 0.0) {
-		if (IS_NULL_F(&arg2[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
-	    else {		/* (arg1[i] < 0.0) */
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    FCELL x = arg2[i], y = arg3[i], z = arg4[i];
 
-		if (IS_NULL_F(&arg4[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = arg4[i];
-	    }
+	    res[i] = IS_NULL_D(&c) ? (FCELL) c : c == 0.0 ? y : c > 0.0 ? x : z;
+	}
 	break;
     default:
 	return E_ARG_HI;
@@ -172,6 +120,7 @@ static int f_if_d(int argc, const int *argt, void **args)
     DCELL *arg2 = (argc >= 2) ? args[2] : NULL;
     DCELL *arg3 = (argc >= 3) ? args[3] : NULL;
     DCELL *arg4 = (argc >= 4) ? args[4] : NULL;
+    int n = columns;
     int i;
 
     switch (argc) {
@@ -180,58 +129,28 @@ static int f_if_d(int argc, const int *argt, void **args)
     case 1:
 	return E_ARG_TYPE;
     case 2:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_D(&res[i]);
-	    else if (arg1[i] == 0.0)
-		res[i] = 0.0;
-	    else {
-		if (IS_NULL_D(&arg2[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    DCELL x = arg2[i];
+
+	    res[i] = IS_NULL_D(&c) ? c : c == 0.0 ? 0.0 : x;
+	}
 	break;
     case 3:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_D(&res[i]);
-	    else if (arg1[i] == 0.0) {
-		if (IS_NULL_D(&arg3[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = arg3[i];
-	    }
-	    else {
-		if (IS_NULL_D(&arg2[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    DCELL x = arg2[i], y = arg3[i];
+
+	    res[i] = IS_NULL_D(&c) ? c : c == 0.0 ? y : x;
+	}
 	break;
     case 4:
-	for (i = 0; i < columns; i++)
-	    if (IS_NULL_D(&arg1[i]))
-		SET_NULL_D(&res[i]);
-	    else if (arg1[i] == 0.0) {
-		if (IS_NULL_D(&arg3[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = arg3[i];
-	    }
-	    else if (arg1[i] > 0.0) {
-		if (IS_NULL_D(&arg2[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = arg2[i];
-	    }
-	    else {		/* (arg1[i] < 0.0) */
+	for (i = 0; i < n; i++) {
+	    DCELL c = arg1[i];
+	    DCELL x = arg2[i], y = arg3[i], z = arg4[i];
 
-		if (IS_NULL_D(&arg4[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = arg4[i];
-	    }
+	    res[i] = IS_NULL_D(&c) ? c : c == 0.0 ? y : c > 0.0 ? x : z;
+	}
 	break;
     default:
 	return E_ARG_HI;
@@ -11,6 +11,7 @@ max(x0,x1,...,xn) returns maximum value
 
 int f_max(int argc, const int *argt, void **args)
 {
+    int n = columns;
     int i, j;
 
     if (argc < 1)
@@ -26,22 +27,15 @@ int f_max(int argc, const int *argt, void **args)
 	    CELL *res = args[0];
 	    CELL **argz = (CELL **) args;
 
-	    for (i = 0; i < columns; i++) {
-		int nul = 0;
-		CELL max;
+	    for (i = 0; i < n; i++)
+		res[i] = argz[1][i];
+	    for (j = 2; j <= argc; j++)
+		for (i = 0; i < n; i++) {
+		    CELL x = res[i], y = argz[j][i];
 
-		for (j = 1; j <= argc; j++)
-		    if (IS_NULL_C(&argz[j][i]))
-			nul = 1;
-		    else if (j == 1)
-			max = argz[j][i];
-		    else if (max < argz[j][i])
-			max = argz[j][i];
-		if (nul)
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = max;
-	    }
+		    res[i] = IS_NULL_C(&x) | IS_NULL_C(&y) ? NULL_C
+			: y > x ? y : x;
+		}
 	    return 0;
 	}
     case FCELL_TYPE:
@@ -49,23 +43,15 @@ int f_max(int argc, const int *argt, void **args)
 	    FCELL *res = args[0];
 	    FCELL **argz = (FCELL **) args;
 
-	    for (i = 0; i < columns; i++) {
-		int nul = 0;
-		FCELL max;
-
-		for (j = 1; j <= argc; j++)
-		    if (IS_NULL_F(&argz[j][i]))
-			nul = 1;
-		    else if (j == 1)
-			max = argz[j][i];
-		    else if (max < argz[j][i])
-			max = argz[j][i];
-		if (nul)
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = max;
-	    }
+	    for (i = 0; i < n; i++)
+		res[i] = argz[1][i];
+	    for (j = 2; j <= argc; j++)
+		for (i = 0; i < n; i++) {
+		    FCELL x = res[i], y = argz[j][i];
 
+		    /* a NULL (NaN) x is kept, as y > x is false */
+		    res[i] = IS_NULL_F(&y) ? y : y > x ? y : x;
+		}
 	    return 0;
 	}
     case DCELL_TYPE:
@@ -73,23 +59,15 @@ int f_max(int argc, const int *argt, void **args)
 	    DCELL *res = args[0];
 	    DCELL **argz = (DCELL **) args;
 
-	    for (i = 0; i < columns; i++) {
-		int nul = 0;
-		DCELL max;
-
-		for (j = 1; j <= argc; j++)
-		    if (IS_NULL_D(&argz[j][i]))
-			nul = 1;
-		    else if (j == 1)
-			max = argz[j][i];
-		    else if (max < argz[j][i])
-			max = argz[j][i];
-		if (nul)
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = max;
-	    }
+	    for (i = 0; i < n; i++)
+		res[i] = argz[1][i];
+	    for (j = 2; j <= argc; j++)
+		for (i = 0; i < n; i++) {
+		    DCELL x = res[i], y = argz[j][i];
 
+		    /* a NULL (NaN) x is kept, as y > x is false */
+		    res[i] = IS_NULL_D(&y) ? y : y > x ? y : x;
+		}
 	    return 0;
 	}
     default:
@@ -52,8 +52,7 @@ static double mode(double *value, int argc)
 
 int f_mode(int argc, const int *argt, void **args)
 {
-    static double *value;
-    static int value_size;
+    double *value;
     int size = argc * sizeof(double);
     int i, j;
 
@@ -64,10 +63,7 @@ int f_mode(int argc, const int *argt, void **args)
 	if (argt[i] != argt[0])
 	    return E_ARG_TYPE;
 
-    if (size > value_size) {
-	value_size = size;
-	value = G_realloc(value, value_size);
-    }
+    value = G_alloca(size);
 
     switch (argt[argc]) {
     case CELL_TYPE:
@@ -90,6 +86,7 @@ int f_mode(int argc, const int *argt, void **args)
 		else
 		    res[i] = (CELL) mode(value, argc);
 	    }
+	    G_freea(value);
 	    return 0;
 	}
     case FCELL_TYPE:
@@ -112,6 +109,7 @@ int f_mode(int argc, const int *argt, void **args)
 		else
 		    res[i] = (FCELL) mode(value, argc);
 	    }
+	    G_freea(value);
 	    return 0;
 	}
     case DCELL_TYPE:
@@ -134,9 +132,11 @@ int f_mode(int argc, const int *argt, void **args)
 		else
 		    res[i] = (DCELL) mode(value, argc);
 	    }
+	    G_freea(value);
 	    return 0;
 	}
     default:
+	G_freea(value);
 	return E_INV_TYPE;
     }
 }
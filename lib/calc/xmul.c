@@ -9,6 +9,7 @@ mul(a,b) = a * b
 
 int f_mul(int argc, const int *argt, void **args)
 {
+    int n = columns;
     int i, j;
 
     if (argc < 1)
@@ -24,7 +25,16 @@ int f_mul(int argc, const int *argt, void **args)
 	    CELL *res = args[0];
 	    CELL **argz = (CELL **) args;
 
-	    for (i = 0; i < columns; i++) {
+	    if (argc == 2) {
+		for (i = 0; i < n; i++) {
+		    CELL x = argz[1][i], y = argz[2][i];
+
+		    res[i] = IS_NULL_C(&x) | IS_NULL_C(&y) ? NULL_C : x * y;
+		}
+		return 0;
+	    }
+
+	    for (i = 0; i < n; i++) {
 		res[i] = 1;
 		for (j = 1; j <= argc; j++) {
 		    if (IS_NULL_C(&argz[j][i])) {
@@ -41,16 +51,12 @@ int f_mul(int argc, const int *argt, void **args)
 	    FCELL *res = args[0];
 	    FCELL **argz = (FCELL **) args;
 
-	    for (i = 0; i < columns; i++) {
-		res[i] = 1;
-		for (j = 1; j <= argc; j++) {
-		    if (IS_NULL_F(&argz[j][i])) {
-			SET_NULL_F(&res[i]);
-			break;
-		    }
+	    /* NULL is NaN, which the arithmetic propagates */
+	    for (i = 0; i < n; i++)
+		res[i] = argz[1][i];
+	    for (j = 2; j <= argc; j++)
+		for (i = 0; i < n; i++)
 		    res[i] *= argz[j][i];
-		}
-	    }
 	    return 0;
 	}
     case DCELL_TYPE:
@@ -58,16 +64,12 @@ int f_mul(int argc, const int *argt, void **args)
 	    DCELL *res = args[0];
 	    DCELL **argz = (DCELL **) args;
 
-	    for (i = 0; i < columns; i++) {
-		res[i] = 1;
-		for (j = 1; j <= argc; j++) {
-		    if (IS_NULL_D(&argz[j][i])) {
-			SET_NULL_D(&res[i]);
-			break;
-		    }
+	    /* NULL is NaN, which the arithmetic propagates */
+	    for (i = 0; i < n; i++)
+		res[i] = argz[1][i];
+	    for (j = 2; j <= argc; j++)
+		for (i = 0; i < n; i++)
 		    res[i] *= argz[j][i];
-		}
-	    }
 	    return 0;
 	}
     default:
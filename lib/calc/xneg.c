@@ -9,6 +9,7 @@ neg(x) = -x
 
 int f_neg(int argc, const int *argt, void **args)
 {
+    int n = columns;
     int i;
 
     if (argc < 1)
@@ -25,11 +26,11 @@ int f_neg(int argc, const int *argt, void **args)
 	    CELL *res = args[0];
 	    CELL *arg1 = args[1];
 
-	    for (i = 0; i < columns; i++)
-		if (IS_NULL_C(&arg1[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = -arg1[i];
+	    for (i = 0; i < n; i++) {
+		CELL x = arg1[i];
+
+		res[i] = IS_NULL_C(&x) ? NULL_C : -x;
+	    }
 	    return 0;
 	}
     case FCELL_TYPE:
@@ -37,11 +38,9 @@ int f_neg(int argc, const int *argt, void **args)
 	    FCELL *res = args[0];
 	    FCELL *arg1 = args[1];
 
-	    for (i = 0; i < columns; i++)
-		if (IS_NULL_F(&arg1[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = -arg1[i];
+	    /* -NaN is NaN, i.e. NULL */
+	    for (i = 0; i < n; i++)
+		res[i] = -arg1[i];
 	    return 0;
 	}
     case DCELL_TYPE:
@@ -49,11 +48,9 @@ int f_neg(int argc, const int *argt, void **args)
 	    DCELL *res = args[0];
 	    DCELL *arg1 = args[1];
 
-	    for (i = 0; i < columns; i++)
-		if (IS_NULL_D(&arg1[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = -arg1[i];
+	    /* -NaN is NaN, i.e. NULL */
+	    for (i = 0; i < n; i++)
+		res[i] = -arg1[i];
 	    return 0;
 	}
     default:
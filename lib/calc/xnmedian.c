@@ -45,8 +45,7 @@ static int dcmp(const void *aa, const void *bb)
 
 int f_nmedian(int argc, const int *argt, void **args)
 {
-    static void *array;
-    static int alloc;
+    void *array;
     int size = argc * Rast_cell_size(argt[0]);
     int i, j;
 
@@ -57,10 +56,7 @@ int f_nmedian(int argc, const int *argt, void **args)
 	if (argt[i] != argt[0])
 	    return E_ARG_TYPE;
 
-    if (size > alloc) {
-	alloc = size;
-	array = G_realloc(array, size);
-    }
+    array = G_alloca(size);
 
     switch (argt[0]) {
     case CELL_TYPE:
@@ -95,6 +91,7 @@ int f_nmedian(int argc, const int *argt, void **args)
 		}
 	    }
 
+	    G_freea(array);
 	    return 0;
 	}
     case FCELL_TYPE:
@@ -129,6 +126,7 @@ int f_nmedian(int argc, const int *argt, void **args)
 		}
 	    }
 
+	    G_freea(array);
 	    return 0;
 	}
     case DCELL_TYPE:
@@ -163,9 +161,11 @@ int f_nmedian(int argc, const int *argt, void **args)
 		}
 	    }
 
+	    G_freea(array);
 	    return 0;
 	}
     default:
+	G_freea(array);
 	return E_INV_TYPE;
     }
 }
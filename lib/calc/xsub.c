@@ -9,6 +9,7 @@ sub(a,b) = a - b
 
 int f_sub(int argc, const int *argt, void **args)
 {
+    int n = columns;
     int i;
 
     if (argc < 2)
@@ -26,11 +27,10 @@ int f_sub(int argc, const int *argt, void **args)
 	    CELL *arg1 = args[1];
 	    CELL *arg2 = args[2];
 
-	    for (i = 0; i < columns; i++) {
-		if (IS_NULL_C(&arg1[i]) || IS_NULL_C(&arg2[i]))
-		    SET_NULL_C(&res[i]);
-		else
-		    res[i] = arg1[i] - arg2[i];
+	    for (i = 0; i < n; i++) {
+		CELL x = arg1[i], y = arg2[i];
+
+		res[i] = IS_NULL_C(&x) | IS_NULL_C(&y) ? NULL_C : x - y;
 	    }
 	    return 0;
 	}
@@ -40,12 +40,9 @@ int f_sub(int argc, const int *argt, void **args)
 	    FCELL *arg1 = args[1];
 	    FCELL *arg2 = args[2];
 
-	    for (i = 0; i < columns; i++) {
-		if (IS_NULL_F(&arg1[i]) || IS_NULL_F(&arg2[i]))
-		    SET_NULL_F(&res[i]);
-		else
-		    res[i] = arg1[i] - arg2[i];
-	    }
+	    /* NULL is NaN, which the difference propagates */
+	    for (i = 0; i < n; i++)
+		res[i] = arg1[i] - arg2[i];
 	    return 0;
 	}
     case DCELL_TYPE:
@@ -54,12 +51,9 @@ int f_sub(int argc, const int *argt, void **args)
 	    DCELL *arg1 = args[1];
 	    DCELL *arg2 = args[2];
 
-	    for (i = 0; i < columns; i++) {
-		if (IS_NULL_D(&arg1[i]) || IS_NULL_D(&arg2[i]))
-		    SET_NULL_D(&res[i]);
-		else
-		    res[i] = arg1[i] - arg2[i];
-	    }
+	    /* NULL is NaN, which the difference propagates */
+	    for (i = 0; i < n; i++)
+		res[i] = arg1[i] - arg2[i];
 	    return 0;
 	}
     default:
@@ -14,9 +14,73 @@
 #include <math.h>
 #include <grass/cluster.h>
 
+/* the class counts and sums of the points of a thread */
+struct part
+{
+    int *count;
+    double **sum;
+    double *d;			/* distances to the classes */
+};
+
+struct assign
+{
+    struct Cluster *C;
+    int *interrupted;
+    int chunk;
+    struct part *part;
+};
+
+/* assign the points first to last - 1; the points and means are shared
+ * and only read, each point's class is written by one thread, the
+ * counts and sums go to the part of the thread */
+static void assign_points(int first, int last, void *closure)
+{
+    const struct assign *a = closure;
+    struct Cluster *C = a->C;
+    struct part *part = &a->part[first / a->chunk];
+    double *d = part->d;
+    double q, dmin;
+    int p, c, class, band;
+
+    for (p = first; p < last; p++) {
+	if (*a->interrupted)
+	    return;
+
+	/* squared distances to all classes, band by band */
+	for (c = 0; c < C->nclasses; c++)
+	    d[c] = 0.0;
+	for (band = 0; band < C->nbands; band++) {
+	    const double x = C->points[band][p];
+	    const double *mean = C->mean[band];
+
+	    for (c = 0; c < C->nclasses; c++) {
+		q = x - mean[c];
+		d[c] += q * q;
+	    }
+	}
+
+	dmin = d[0];
+	class = 0;
+	for (c = 1; c < C->nclasses; c++) {
+	    if (d[c] < dmin) {
+		class = c;
+		dmin = d[c];
+	    }
+	}
+	C->class[p] = class;
+	part->count[class]++;
+	for (band = 0; band < C->nbands; band++)
+	    part->sum[band][class] += C->points[band][p];
+    }
+}
+
 /*!
   \brief Assign cluster
 
+  Each point is assigned to the class with the nearest mean. The points
+  are processed in parallel, the class sums of each thread are added in
+  the order of the threads.
+
   \param C pointer to Cluster structure
   \param interrupted ?
   
@@ -25,37 +89,39 @@
 */
 int I_cluster_assign(struct Cluster *C, int *interrupted)
 {
-    int p, c;
-    int class, band;
-    double d, q;
-    double dmin;
+    int c, t, band;
+    int nthreads = G_num_workers() + 1;
+    struct assign a;
 
     G_debug(3, "I_cluster_assign(npoints=%d,nclasses=%d,nbands=%d)",
 	    C->npoints, C->nclasses, C->nbands);
-    
-    for (p = 0; p < C->npoints; p++) {
-	if (*interrupted)
-	    return -1;
 
-	dmin = HUGE_VAL;
-	class = 0;
+    a.C = C;
+    a.interrupted = interrupted;
+    a.chunk = (C->npoints + nthreads - 1) / nthreads;
+    a.part = (struct part *)G_malloc(nthreads * sizeof(struct part));
+    for (t = 0; t < nthreads; t++) {
+	a.part[t].count = (int *)G_calloc(C->nclasses, sizeof(int));
+	a.part[t].sum = I_alloc_double2(C->nbands, C->nclasses);
+	a.part[t].d = (double *)G_malloc(C->nclasses * sizeof(double));
+    }
+
+    G_parallel_for(0, C->npoints, a.chunk, assign_points, &a);
+
+    for (t = 0; t < nthreads; t++) {
 	for (c = 0; c < C->nclasses; c++) {
-	    d = 0.0;
-	    for (band = 0; band < C->nbands; band++) {
-		q = C->points[band][p];
-		q -= C->mean[band][c];
-		d += q * q;
-	    }
-	    if (c == 0 || d < dmin) {
-		class = c;
-		dmin = d;
-	    }
+	    C->count[c] += a.part[t].count[c];
+	    for (band = 0; band < C->nbands; band++)
+		C->sum[band][c] += a.part[t].sum[band][c];
 	}
-	C->class[p] = class;
-	C->count[class]++;
-	for (band = 0; band < C->nbands; band++)
-	    C->sum[band][class] += C->points[band][p];
+	G_free(a.part[t].count);
+	I_free_double2(a.part[t].sum);
+	G_free(a.part[t].d);
     }
+    G_free(a.part);
+
+    if (*interrupted)
+	return -1;
 
     return 0;
 }
@@ -34,6 +34,7 @@ int I_cluster_clear(struct Cluster *C)
     C->sum2 = NULL;
     C->mean = NULL;
     C->nbands = 0;
+    C->init_means = I_CLUSTER_MEANS_STDDEV;
     I_init_signatures(&C->S, 0);
 
     return 0;
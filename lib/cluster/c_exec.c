@@ -69,7 +69,10 @@ int I_cluster_exec(struct Cluster *C, int maxclass, int iterations,
 
 
     /* generate class means */
-    I_cluster_means(C);
+    if (C->init_means == I_CLUSTER_MEANS_KMEANSPP)
+	I_cluster_means_kmeanspp(C);
+    else
+	I_cluster_means(C);
     if (checkpoint)
 	(*checkpoint) (C, 1);
 
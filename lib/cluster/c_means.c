@@ -46,3 +46,101 @@ int I_cluster_means(struct Cluster *C)
 
     return 0;
 }
+
+struct nearest
+{
+    const struct Cluster *C;
+    double *d2;			/* squared distances to the nearest mean */
+    int class;			/* the new mean */
+};
+
+/* update the distances of the points first to last - 1 with the new
+ * mean; the points and means are shared and only read, each distance
+ * is written by one thread */
+static void update_distances(int first, int last, void *closure)
+{
+    const struct nearest *u = closure;
+    const struct Cluster *C = u->C;
+    double d, q;
+    int p, band;
+
+    for (p = first; p < last; p++) {
+	d = 0.0;
+	for (band = 0; band < C->nbands; band++) {
+	    q = C->points[band][p] - C->mean[band][u->class];
+	    d += q * q;
+	}
+	if (d < u->d2[p])
+	    u->d2[p] = d;
+    }
+}
+
+/*!
+  \brief Calculate initial means with k-means++ seeding
+
+  The first mean is a randomly chosen point, each further mean is a
+  point chosen with a probability proportional to its squared distance
+  to the nearest mean chosen so far. The random number generator is
+  initialized with a fixed seed, thus the means are reproducible.
+
+  \param C pointer to Cluster structure
+
+  \return 0
+*/
+int I_cluster_means_kmeanspp(struct Cluster *C)
+{
+    int band;
+    int class;
+    int p, pick;
+    double *d2;
+    double total, r;
+    struct nearest u;
+
+    G_debug(3, "I_cluster_means_kmeanspp(nbands=%d,nclasses=%d)",
+	    C->nbands, C->nclasses);
+
+    G_srand48(1);
+
+    d2 = (double *)G_malloc(C->npoints * sizeof(double));
+    for (p = 0; p < C->npoints; p++)
+	d2[p] = HUGE_VAL;
+    u.C = C;
+    u.d2 = d2;
+
+    pick = (int)(G_drand48() * C->npoints);
+    if (pick >= C->npoints)
+	pick = C->npoints - 1;
+
+    for (class = 0; class < C->nclasses; class++) {
+	for (band = 0; band < C->nbands; band++)
+	    C->mean[band][class] = C->points[band][pick];
+
+	if (class == C->nclasses - 1)
+	    break;
+
+	/* update the distances to the nearest mean */
+	u.class = class;
+	G_parallel_for(0, C->npoints, 0, update_distances, &u);
+
+	/* summed serially, the means do not depend on the number of threads */
+	total = 0.0;
+	for (p = 0; p < C->npoints; p++)
+	    total += d2[p];
+
+	/* all points coincide with a mean, keep the last one */
+	if (total <= 0.0)
+	    continue;
+
+	r = G_drand48() * total;
+	for (p = 0; p < C->npoints - 1; p++) {
+	    r -= d2[p];
+	    if (r < 0.0)
+		break;
+	}
+	pick = p;
+    }
+
+    G_free(d2);
+
+    return 0;
+}
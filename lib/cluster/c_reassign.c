@@ -14,74 +14,148 @@
 #include <math.h>
 #include <grass/cluster.h>
 
-/*!
-  \brief ?
-
-  \param C pointer to Cluster structure
-  \param interrupted
-
-  \return number of changes
-*/
-int I_cluster_reassign(struct Cluster *C, int *interrupted)
+/* the changes of the class counts and sums of a thread */
+struct part
 {
-    double min, d, z;
-    double q;
-    int c, np;
-    int old;
-    int p, band, class;
+    int *count;
+    double **sum;
+    double *d;			/* distances to the classes */
     int changes;
-    int first;
+};
 
-    changes = 0;
-    for (c = 0; c < C->nclasses; c++) {
-	C->countdiff[c] = 0;
-	for (band = 0; band < C->nbands; band++)
-	    C->sumdiff[band][c] = 0;
-    }
+struct reassign
+{
+    struct Cluster *C;
+    int *interrupted;
+    const double *np;		/* class counts before the pass */
+    int chunk;
+    struct part *part;
+};
+
+/* reassign the points first to last - 1; the points, sums and counts
+ * of the classes are shared and only read, each point's class is
+ * written by one thread, the changes go to the part of the thread */
+static void reassign_points(int first, int last, void *closure)
+{
+    const struct reassign *a = closure;
+    struct Cluster *C = a->C;
+    const double *np = a->np;
+    struct part *part = &a->part[first / a->chunk];
+    double *d = part->d;
+    double min, z, q;
+    int p, c, band, old, class, found;
 
-    min = HUGE_VAL;
-    class = 0;
-    for (p = 0; p < C->npoints; p++) {
-	if (*interrupted)
-	    return 0;
+    for (p = first; p < last; p++) {
+	if (*a->interrupted)
+	    return;
 	if (C->class[p] < 0)	/* point to be ignored */
 	    continue;
 
 	/* find minimum distance to center of all classes */
-	first = 1;
+	for (c = 0; c < C->nclasses; c++)
+	    d[c] = 0.0;
+	for (band = 0; band < C->nbands; band++) {
+	    const double x = C->points[band][p];
+	    const double *sum = C->sum[band];
+
+	    for (c = 0; c < C->nclasses; c++) {
+		z = x * np[c] - sum[c];
+		d[c] += z * z;
+	    }
+	}
+
+	found = 0;
+	min = HUGE_VAL;
+	class = 0;
 	for (c = 0; c < C->nclasses; c++) {
-	    d = 0;
-	    np = C->count[c];
-	    if (np == 0)
+	    if (np[c] == 0)
 		continue;
-	    for (band = 0; band < C->nbands; band++) {
-		z = C->points[band][p] * np - C->sum[band][c];
-		d += z * z;
-	    }
-	    d /= (np * np);
+	    d[c] /= (np[c] * np[c]);
 
-	    if (first || (d < min)) {
+	    if (!found || (d[c] < min)) {
 		class = c;
-		min = d;
-		first = 0;
+		min = d[c];
+		found = 1;
 	    }
 	}
 
 	if (C->class[p] != class) {
 	    old = C->class[p];
 	    C->class[p] = class;
-	    changes++;
+	    part->changes++;
 
-	    C->countdiff[class]++;
-	    C->countdiff[old]--;
+	    part->count[class]++;
+	    part->count[old]--;
 
 	    for (band = 0; band < C->nbands; band++) {
 		q = C->points[band][p];
-		C->sumdiff[band][class] += q;
-		C->sumdiff[band][old] -= q;
+		part->sum[band][class] += q;
+		part->sum[band][old] -= q;
 	    }
 	}
     }
+}
+
+/*!
+  \brief Reassign points to the class with the nearest mean
+
+  The points are processed in parallel, the changes of the class sums
+  of each thread are added in the order of the threads.
+
+  \param C pointer to Cluster structure
+  \param interrupted
+
+  \return number of changes
+*/
+int I_cluster_reassign(struct Cluster *C, int *interrupted)
+{
+    int c, t, band;
+    int changes;
+    int nthreads = G_num_workers() + 1;
+    double *np;
+    struct reassign a;
+
+    changes = 0;
+    for (c = 0; c < C->nclasses; c++) {
+	C->countdiff[c] = 0;
+	for (band = 0; band < C->nbands; band++)
+	    C->sumdiff[band][c] = 0;
+    }
+
+    np = (double *)G_malloc(C->nclasses * sizeof(double));
+    for (c = 0; c < C->nclasses; c++)
+	np[c] = C->count[c];
+
+    a.C = C;
+    a.interrupted = interrupted;
+    a.np = np;
+    a.chunk = (C->npoints + nthreads - 1) / nthreads;
+    a.part = (struct part *)G_malloc(nthreads * sizeof(struct part));
+    for (t = 0; t < nthreads; t++) {
+	a.part[t].count = (int *)G_calloc(C->nclasses, sizeof(int));
+	a.part[t].sum = I_alloc_double2(C->nbands, C->nclasses);
+	a.part[t].d = (double *)G_malloc(C->nclasses * sizeof(double));
+	a.part[t].changes = 0;
+    }
+
+    G_parallel_for(0, C->npoints, a.chunk, reassign_points, &a);
+
+    for (t = 0; t < nthreads; t++) {
+	changes += a.part[t].changes;
+	for (c = 0; c < C->nclasses; c++) {
+	    C->countdiff[c] += a.part[t].count[c];
+	    for (band = 0; band < C->nbands; band++)
+		C->sumdiff[band][c] += a.part[t].sum[band][c];
+	}
+	G_free(a.part[t].count);
+	I_free_double2(a.part[t].sum);
+	G_free(a.part[t].d);
+    }
+    G_free(a.part);
+    G_free(np);
+
+    if (*interrupted)
+	return 0;
 
     if (changes) {
 	for (c = 0; c < C->nclasses; c++) {
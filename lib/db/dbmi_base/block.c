@@ -0,0 +1,176 @@
+/*!
+  \file lib/db/dbmi_base/block.c
+
+  \brief DBMI Library (base) - blocks of rows stored by column
+
+  (C) 2020 by the GRASS Development Team
+
+  This program is free software under the GNU General Public License
+  (>=v2). Read the file COPYING that comes with GRASS for details.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/dbmi.h>
+
+/*!
+  \brief Initialize dbBlock
+
+  \param block pointer to dbBlock to be initialized
+*/
+void db_init_block(dbBlock * block)
+{
+    db_zero((void *)block, sizeof(dbBlock));
+}
+
+/*!
+  \brief Free allocated dbBlock
+
+  \param block pointer to dbBlock
+*/
+void db_free_block(dbBlock * block)
+{
+    int col;
+
+    for (col = 0; col < block->ncols; col++) {
+	dbColumnBlock *column = &block->columns[col];
+
+	db_free(column->isNull);
+	db_free(column->i);
+	db_free(column->d);
+	db_free(column->offset);
+	db_free(column->buf);
+    }
+    db_free(block->columns);
+    db_init_block(block);
+}
+
+/*!
+  \brief Allocate columns and rows of dbBlock
+
+  The block keeps allocated memory for more rows and the types of
+  the columns if the number of columns does not change.
+
+  \param block pointer to dbBlock
+  \param ncols number of columns
+  \param nrows number of rows
+
+  \return DB_OK on success
+  \return DB_MEMORY_ERR on error
+*/
+int db_alloc_block(dbBlock * block, int ncols, int nrows)
+{
+    int col;
+
+    if (ncols != block->ncols) {
+	db_free_block(block);
+	block->columns = (dbColumnBlock *) db_calloc(ncols,
+						     sizeof(dbColumnBlock));
+	if (block->columns == NULL && ncols > 0)
+	    return DB_MEMORY_ERR;
+	block->ncols = ncols;
+    }
+
+    if (nrows > block->alloc) {
+	for (col = 0; col < ncols; col++) {
+	    dbColumnBlock *column = &block->columns[col];
+
+	    column->isNull = db_realloc(column->isNull, nrows);
+	    column->i = db_realloc(column->i, nrows * sizeof(int));
+	    column->d = db_realloc(column->d, nrows * sizeof(double));
+	    column->offset = db_realloc(column->offset, nrows * sizeof(int));
+	    if (!column->isNull || !column->i || !column->d || !column->offset)
+		return DB_MEMORY_ERR;
+	}
+	block->alloc = nrows;
+    }
+    block->nrows = 0;
+    for (col = 0; col < ncols; col++)
+	block->columns[col].buf_len = 0;
+
+    return DB_OK;
+}
+
+/*!
+  \brief Append string of a row to a column of dbBlock
+
+  \param column pointer to dbColumnBlock
+  \param row row index
+  \param s string (NULL for empty string)
+
+  \return DB_OK on success
+  \return DB_MEMORY_ERR on error
+*/
+int db_set_block_string(dbColumnBlock * column, int row, const char *s)
+{
+    int len;
+
+    if (s == NULL)
+	s = "";
+    len = strlen(s) + 1;
+
+    if (column->buf_len + len > column->buf_alloc) {
+	column->buf_alloc = 2 * (column->buf_len + len);
+	column->buf = db_realloc(column->buf, column->buf_alloc);
+	if (column->buf == NULL)
+	    return DB_MEMORY_ERR;
+    }
+    memcpy(column->buf + column->buf_len, s, len);
+    column->offset[row] = column->buf_len;
+    column->buf_len += len;
+
+    return DB_OK;
+}
+
+/*!
+  \brief Get string of a row in a column of dbBlock
+
+  \param block pointer to dbBlock
+  \param col column index
+  \param row row index
+
+  \return pointer to string (empty for null values)
+*/
+const char *db_get_block_string(const dbBlock * block, int col, int row)
+{
+    const dbColumnBlock *column = &block->columns[col];
+
+    return column->buf + column->offset[row];
+}
+
+/*!
+  \brief Convert value of a row in a column of dbBlock to string
+
+  Numbers are formatted as by db_convert_value_to_string().
+
+  \param block pointer to dbBlock
+  \param col column index
+  \param row row index
+  \param[out] string pointer to dbString
+
+  \return DB_OK on success
+*/
+int db_convert_block_value_to_string(const dbBlock * block, int col, int row,
+				     dbString * string)
+{
+    const dbColumnBlock *column = &block->columns[col];
+    char buf[64];
+
+    if (column->isNull[row])
+	return db_set_string(string, "");
+
+    switch (column->ctype) {
+    case DB_C_TYPE_INT:
+	sprintf(buf, "%d", column->i[row]);
+	break;
+    case DB_C_TYPE_DOUBLE:
+	sprintf(buf, "%.15g", column->d[row]);
+	G_trim_decimal(buf);
+	break;
+    default:
+	return db_set_string(string, db_get_block_string(block, col, row));
+    }
+
+    return db_set_string(string, buf);
+}
@@ -32,6 +32,9 @@ extern int db__driver_get_num_rows(dbCursor *);
 extern int db__driver_begin_transaction(void);
 extern int db__driver_commit_transaction(void);
 extern int db__driver_update(dbCursor *);
+extern int db__driver_update_values(dbString *, dbString *, int, dbString *,
+				    const int *, int, const int *, dbValue *,
+				    int *);
 
 #ifdef	DB_DRIVER_C
 int (*db_driver_add_column) (dbString *, dbColumn *) = db__driver_add_column;
@@ -65,6 +68,10 @@ int (*db_driver_get_num_rows) (dbCursor *) = db__driver_get_num_rows;
 int (*db_driver_begin_transaction) (void) = db__driver_begin_transaction;
 int (*db_driver_commit_transaction) (void) = db__driver_commit_transaction;
 int (*db_driver_update) (dbCursor *) = db__driver_update;
+/* optional, if NULL db_update_values() runs one statement per row */
+int (*db_driver_update_values) (dbString *, dbString *, int, dbString *,
+				const int *, int, const int *, dbValue *,
+				int *) = NULL;
 #else
 extern int (*db_driver_add_column) (dbString *, dbColumn *);
 extern int (*db_driver_bind_update) (dbCursor *);
@@ -97,6 +104,9 @@ extern int (*db_driver_get_num_rows) (dbCursor *);
 extern int (*db_driver_begin_transaction) (void);
 extern int (*db_driver_commit_transaction) (void);
 extern int (*db_driver_update) (dbCursor *);
+extern int (*db_driver_update_values) (dbString *, dbString *, int,
+				       dbString *, const int *, int,
+				       const int *, dbValue *, int *);
 #endif
 
 #endif
@@ -38,6 +38,10 @@
 	{if(db__send_int(x)!=DB_OK) DB_RETURN_ERR}
 #define DB_RECV_INT(x) \
 	{if(db__recv_int(x)!=DB_OK) DB_RETURN_ERR}
+#define DB_SEND_INT_ARRAY(x,n) \
+	{if(db__send_int_array(x,n)!=DB_OK) DB_RETURN_ERR}
+#define DB_RECV_INT_ARRAY(x,n) \
+	{if(db__recv_int_array(x,n)!=DB_OK) DB_RETURN_ERR}
 
 #define DB_SEND_FLOAT(x) \
 	{if(db__send_float(x)!=DB_OK) DB_RETURN_ERR}
@@ -69,6 +73,11 @@
 #define DB_RECV_TABLE_DATA(x) \
 	{if(db__recv_table_data(x)!=DB_OK) DB_RETURN_ERR}
 
+#define DB_SEND_BLOCK(x) \
+	{if(db__send_block(x)!=DB_OK) DB_RETURN_ERR}
+#define DB_RECV_BLOCK(x) \
+	{if(db__recv_block(x)!=DB_OK) DB_RETURN_ERR}
+
 #define DB_SEND_TABLE_PRIV(x) \
 	{if(db__send_table_priv(x)!=DB_OK) DB_RETURN_ERR}
 #define DB_RECV_TABLE_PRIV(x) \
@@ -12,6 +12,7 @@
   \author Doxygenized by Martin Landa <landa.martin gmail.com> (2011)
 */
 
+#include <string.h>
 #include "xdr.h"
 
 #ifdef __MINGW32__
@@ -28,6 +29,56 @@
 
 static FILE *_send, *_recv;
 
+/* Requests to a driver running in the address space of the client and
+ * the replies of that driver are kept in memory buffers. The driver
+ * runs a procedure when the client asks for the first reply. */
+#define PROTOCOL_PIPE   0
+#define PROTOCOL_CLIENT 1
+#define PROTOCOL_DRIVER 2
+
+struct channel
+{
+    char *buf;
+    size_t len, pos, alloc;
+};
+
+static int _protocol = PROTOCOL_PIPE;
+static int (*_call) (void);
+static struct channel _request, _reply;
+
+static int channel_write(struct channel *ch, const void *buf, size_t size)
+{
+    if (ch->len + size > ch->alloc) {
+	ch->alloc = 2 * (ch->len + size);
+	ch->buf = db_realloc(ch->buf, ch->alloc);
+	if (ch->buf == NULL)
+	    return 0;
+    }
+    memcpy(ch->buf + ch->len, buf, size);
+    ch->len += size;
+
+    return 1;
+}
+
+static int channel_read(struct channel *ch, void *buf, size_t size)
+{
+    if (ch->pos + size > ch->len)
+	return 0;
+    memcpy(buf, ch->buf + ch->pos, size);
+    ch->pos += size;
+
+    return 1;
+}
+
+static void call_driver(void)
+{
+    _reply.len = _reply.pos = 0;
+    _protocol = PROTOCOL_DRIVER;
+    (*_call) ();
+    _protocol = PROTOCOL_CLIENT;
+    _request.len = _request.pos = 0;
+}
+
 #if USE_READN
 
 static ssize_t readn(int fd, void *buf, size_t count)
@@ -76,6 +127,37 @@ void db__set_protocol_fds(FILE * send, FILE * recv)
 {
     _send = send;
     _recv = recv;
+    _protocol = send == NULL && recv == NULL && _call ?
+	PROTOCOL_CLIENT : PROTOCOL_PIPE;
+}
+
+/*!
+  \brief Register a driver running in the address space of the client
+
+  The procedures of the driver are called through the memory buffers
+  selected by db__set_protocol_fds(NULL, NULL).
+
+  \param call function running the next requested procedure of the
+  driver, NULL to unregister the driver
+*/
+void db__set_protocol_in_process(int (*call) (void))
+{
+    _call = call;
+    _request.len = _request.pos = 0;
+    _reply.len = _reply.pos = 0;
+    if (!call)
+	_protocol = PROTOCOL_PIPE;
+}
+
+/*!
+  \brief Check if the client talks to a driver in its address space
+
+  \return 1 if the current driver runs in process
+  \return 0 otherwise
+*/
+int db__protocol_in_process(void)
+{
+    return _protocol == PROTOCOL_CLIENT;
 }
 
 /*!
@@ -88,6 +170,15 @@ void db__set_protocol_fds(FILE * send, FILE * recv)
 */
 int db__send(const void *buf, size_t size)
 {
+    if (_protocol == PROTOCOL_CLIENT) {
+	/* a new request, drop what is left of the last reply */
+	if (_request.len == 0)
+	    _reply.len = _reply.pos = 0;
+	return channel_write(&_request, buf, size);
+    }
+    if (_protocol == PROTOCOL_DRIVER)
+	return channel_write(&_reply, buf, size);
+
 #if USE_STDIO
     return fwrite(buf, 1, size, _send) == size;
 #elif USE_READN
@@ -99,6 +190,14 @@ int db__send(const void *buf, size_t size)
 
 int db__recv(void *buf, size_t size)
 {
+    if (_protocol == PROTOCOL_CLIENT) {
+	if (_reply.pos == _reply.len && _request.len > 0)
+	    call_driver();
+	return channel_read(&_reply, buf, size);
+    }
+    if (_protocol == PROTOCOL_DRIVER)
+	return channel_read(&_request, buf, size);
+
 #if USE_STDIO
 #ifdef USE_BUFFERED_IO
     fflush(_send);
@@ -0,0 +1,133 @@
+/*!
+  \file lib/db/dbmi_base/xdrblock.c
+
+  \brief DBMI Library (base) - external data representation (block of rows)
+
+  (C) 2020 by the GRASS Development Team
+
+  This program is free software under the GNU General Public License
+  (>=v2). Read the file COPYING that comes with GRASS for details.
+*/
+
+#include "xdr.h"
+#include "macros.h"
+
+static int send_array(const void *buf, size_t size)
+{
+    if (size > 0 && !db__send(buf, size)) {
+	db_protocol_error();
+	return DB_PROTOCOL_ERR;
+    }
+
+    return DB_OK;
+}
+
+static int recv_array(void *buf, size_t size)
+{
+    if (size > 0 && !db__recv(buf, size)) {
+	db_protocol_error();
+	return DB_PROTOCOL_ERR;
+    }
+
+    return DB_OK;
+}
+
+/*!
+  \brief Send block of rows
+
+  Each column is sent as one array of null flags and one array of
+  values, strings as array of offsets and one buffer.
+
+  \param block pointer to dbBlock
+
+  \return DB_OK on success
+*/
+int db__send_block(dbBlock * block)
+{
+    int col, nrows;
+
+    nrows = block->nrows;
+    DB_SEND_INT(block->ncols);
+    DB_SEND_INT(nrows);
+
+    for (col = 0; col < block->ncols; col++) {
+	dbColumnBlock *column = &block->columns[col];
+
+	DB_SEND_INT(column->ctype);
+	if (send_array(column->isNull, nrows) != DB_OK)
+	    return DB_PROTOCOL_ERR;
+
+	switch (column->ctype) {
+	case DB_C_TYPE_INT:
+	    if (send_array(column->i, nrows * sizeof(int)) != DB_OK)
+		return DB_PROTOCOL_ERR;
+	    break;
+	case DB_C_TYPE_DOUBLE:
+	    if (send_array(column->d, nrows * sizeof(double)) != DB_OK)
+		return DB_PROTOCOL_ERR;
+	    break;
+	default:
+	    DB_SEND_INT(column->buf_len);
+	    if (send_array(column->offset, nrows * sizeof(int)) != DB_OK ||
+		send_array(column->buf, column->buf_len) != DB_OK)
+		return DB_PROTOCOL_ERR;
+	    break;
+	}
+    }
+
+    return DB_OK;
+}
+
+/*!
+  \brief Receive block of rows
+
+  The memory of the block is reused and extended as needed.
+
+  \param[in,out] block pointer to dbBlock
+
+  \return DB_OK on success
+*/
+int db__recv_block(dbBlock * block)
+{
+    int col, ncols, nrows, len;
+
+    DB_RECV_INT(&ncols);
+    DB_RECV_INT(&nrows);
+    if (db_alloc_block(block, ncols, nrows) != DB_OK)
+	return DB_MEMORY_ERR;
+    block->nrows = nrows;
+
+    for (col = 0; col < ncols; col++) {
+	dbColumnBlock *column = &block->columns[col];
+
+	DB_RECV_INT(&column->ctype);
+	if (recv_array(column->isNull, nrows) != DB_OK)
+	    return DB_PROTOCOL_ERR;
+
+	switch (column->ctype) {
+	case DB_C_TYPE_INT:
+	    if (recv_array(column->i, nrows * sizeof(int)) != DB_OK)
+		return DB_PROTOCOL_ERR;
+	    break;
+	case DB_C_TYPE_DOUBLE:
+	    if (recv_array(column->d, nrows * sizeof(double)) != DB_OK)
+		return DB_PROTOCOL_ERR;
+	    break;
+	default:
+	    DB_RECV_INT(&len);
+	    if (len > column->buf_alloc) {
+		column->buf = db_realloc(column->buf, len);
+		if (column->buf == NULL)
+		    return DB_MEMORY_ERR;
+		column->buf_alloc = len;
+	    }
+	    column->buf_len = len;
+	    if (recv_array(column->offset, nrows * sizeof(int)) != DB_OK ||
+		recv_array(column->buf, len) != DB_OK)
+		return DB_PROTOCOL_ERR;
+	    break;
+	}
+    }
+
+    return DB_OK;
+}
@@ -0,0 +1,55 @@
+/*!
+ * \file db/dbmi_client/c_fetch_block.c
+ * 
+ * \brief DBMI Library (client) - fetch blocks of rows
+ *
+ * (C) 2020 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public
+ * License (>=v2). Read the file COPYING that comes with GRASS
+ * for details.
+ */
+
+#include <grass/dbmi.h>
+#include "macros.h"
+
+/*!
+  \brief Fetch next rows from open cursor by column
+
+  Up to <i>nrows</i> rows are fetched in one call and stored by column
+  in <i>block</i>, in the order of the columns of the cursor table.
+  Integer and double columns are stored as arrays of values, all other
+  columns as strings. Fetching continues after the last row fetched with
+  db_fetch().
+
+  \param cursor pointer to dbCursor
+  \param nrows maximum number of rows to be fetched
+  \param[in,out] block pointer to initialized dbBlock (block->nrows is
+  0 if there is no more data to be fetched)
+
+  \return DB_OK on success
+  \return DB_FAILED on failure
+ */
+int db_fetch_block(dbCursor * cursor, int nrows, dbBlock * block)
+{
+    int ret_code;
+
+    /* start the procedure call */
+    db__set_protocol_fds(cursor->driver->send, cursor->driver->recv);
+    DB_START_PROCEDURE_CALL(DB_PROC_FETCH_BLOCK);
+
+    /* send the argument(s) to the procedure */
+    DB_SEND_TOKEN(&cursor->token);
+    DB_SEND_INT(nrows);
+
+    /* get the return code for the procedure call */
+    DB_RECV_RETURN_CODE(&ret_code);
+
+    if (ret_code != DB_OK)
+	return ret_code;	/* ret_code SHOULD == DB_FAILED */
+
+    /* get the results */
+    DB_RECV_BLOCK(block);
+
+    return DB_OK;
+}
@@ -0,0 +1,79 @@
+/*!
+ * \file db/dbmi_client/c_update_values.c
+ * 
+ * \brief DBMI Library (client) - update many rows in one call
+ *
+ * (C) 2020 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public
+ * License (>=v2). Read the file COPYING that comes with GRASS
+ * for details.
+ */
+
+#include <grass/dbmi.h>
+#include "macros.h"
+
+/*!
+  \brief Update columns of many rows in one call
+
+  Runs for each row <i>i</i> the statement
+
+  <tt>update table set columns[0] = values[i * ncols], ... where key = keys[i]</tt>
+
+  All rows are sent to the driver in one message. Drivers which
+  support it (e.g. SQLite) run a prepared statement, the other drivers
+  run one statement per row. The C types of the columns may be
+  DB_C_TYPE_INT, DB_C_TYPE_DOUBLE or DB_C_TYPE_STRING, null values are
+  written as NULL.
+
+  \param driver db driver
+  \param table table name
+  \param key name of the key column (integer)
+  \param ncols number of columns to update
+  \param columns names of the columns to update
+  \param ctypes C types of the columns
+  \param nrows number of rows
+  \param keys key values of the rows
+  \param values nrows * ncols values, row by row
+  \param[out] nupdated number of rows updated without error
+
+  \return DB_OK on success
+  \return DB_FAILED on failure
+ */
+int db_update_values(dbDriver * driver, const char *table, const char *key,
+		     int ncols, dbString * columns, const int *ctypes,
+		     int nrows, const int *keys, dbValue * values,
+		     int *nupdated)
+{
+    int ret_code, i, j;
+
+    *nupdated = 0;
+
+    /* start the procedure call */
+    db__set_protocol_fds(driver->send, driver->recv);
+    DB_START_PROCEDURE_CALL(DB_PROC_UPDATE_VALUES);
+
+    /* send the argument(s) to the procedure */
+    DB_SEND_C_STRING(table);
+    DB_SEND_C_STRING(key);
+    DB_SEND_STRING_ARRAY(columns, ncols);
+    DB_SEND_INT_ARRAY(ctypes, ncols);
+    DB_SEND_INT_ARRAY(keys, nrows);
+    for (i = 0; i < nrows; i++) {
+	for (j = 0; j < ncols; j++) {
+	    if (db__send_value(&values[i * ncols + j], ctypes[j]) != DB_OK)
+		return db_get_error_code();
+	}
+    }
+
+    /* get the return code for the procedure call */
+    DB_RECV_RETURN_CODE(&ret_code);
+
+    if (ret_code != DB_OK)
+	return ret_code;	/* ret_code SHOULD == DB_FAILED */
+
+    /* get the results */
+    DB_RECV_INT(nupdated);
+
+    return DB_OK;
+}
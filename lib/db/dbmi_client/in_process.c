@@ -0,0 +1,148 @@
+/*!
+ * \file db/dbmi_client/in_process.c
+ *
+ * \brief DBMI Library (client) - driver in the address space of the client
+ *
+ * (C) 2020 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public
+ * License (>=v2). Read the file COPYING that comes with GRASS
+ * for details.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <grass/gis.h>
+#include <grass/dbmi.h>
+
+#if defined(__unix) && !defined(__unix__)
+# define __unix__ __unix
+#endif
+
+#ifdef __unix__
+#include <dlfcn.h>
+
+#ifndef SHLIB_SUFFIX
+#define SHLIB_SUFFIX ".so"
+#endif
+
+/* the procedures run on shared driver state and sqlite handles,
+   only one driver can be loaded at a time */
+static void *module_h;
+static int (*call_f) (void);
+static void (*stop_f) (void);
+
+static void *get_symbol(const char *name)
+{
+    void *sym = dlsym(module_h, name);
+
+    if (!sym)
+	G_debug(1, "db__start_in_process_driver(): no symbol <%s>", name);
+
+    return sym;
+}
+
+static void unload(void)
+{
+    dlclose(module_h);
+    module_h = NULL;
+    call_f = NULL;
+    stop_f = NULL;
+}
+#endif
+
+/*!
+  \brief Start a driver in the address space of the client
+
+  The driver is loaded from the module next to the driver program
+  (e.g. driver/db/sqlite.so for driver/db/sqlite) if the variable
+  GRASS_DB_IN_PROCESS is set. The driver must not be started when
+  another in-process driver is running.
+
+  \param driver driver with the dbmscap entry
+
+  \return DB_OK if the driver runs in process
+  \return DB_FAILED if the driver failed to start
+  \return -1 if the driver must be run as a separate process
+*/
+int db__start_in_process_driver(dbDriver * driver)
+{
+#ifdef __unix__
+    char path[GPATH_MAX];
+    void (*init_f) (void);
+    int (*start_f) (const char *);
+    int stat;
+
+    if (!getenv("GRASS_DB_IN_PROCESS") || module_h)
+	return -1;
+
+    snprintf(path, sizeof(path), "%s%s", driver->dbmscap.startup,
+	     SHLIB_SUFFIX);
+    if (access(path, R_OK) != 0)
+	return -1;
+
+    module_h = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!module_h) {
+	G_debug(1, "db__start_in_process_driver(): %s", dlerror());
+	return -1;
+    }
+
+    init_f = (void (*)(void))get_symbol("db_driver_module_init");
+    start_f = (int (*)(const char *))get_symbol("db_d_start_in_process");
+    call_f = (int (*)(void))get_symbol("db_d_call_in_process");
+    stop_f = (void (*)(void))get_symbol("db_d_stop_in_process");
+    if (!init_f || !start_f || !call_f || !stop_f) {
+	unload();
+	return -1;
+    }
+
+    G_debug(2, "db__start_in_process_driver(): %s", path);
+
+    (*init_f) ();
+    driver->send = driver->recv = NULL;
+    driver->pid = 0;
+    db__set_protocol_in_process(call_f);
+    db__set_protocol_fds(NULL, NULL);
+
+    stat = (*start_f) (driver->dbmscap.driverName);
+    if (stat != DB_OK) {
+	db__set_protocol_in_process(NULL);
+	unload();
+	return DB_FAILED;
+    }
+
+    return DB_OK;
+#else
+    return -1;
+#endif
+}
+
+/*!
+  \brief Stop a driver started by db__start_in_process_driver()
+
+  \param driver driver
+
+  \return 0 on success
+  \return -1 if the driver does not run in process
+*/
+int db__stop_in_process_driver(dbDriver * driver)
+{
+#ifdef __unix__
+    if (!module_h || driver->send || driver->recv)
+	return -1;
+
+    (*stop_f) ();
+    db__set_protocol_in_process(NULL);
+    /* the module is kept loaded, libraries used by the driver may
+       have registered handlers */
+    call_f = NULL;
+    stop_f = NULL;
+    module_h = NULL;
+
+    return 0;
+#else
+    return -1;
+#endif
+}
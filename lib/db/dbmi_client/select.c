@@ -18,6 +18,9 @@
 #include <grass/dbmi.h>
 #include <grass/glocale.h>
 
+/* number of rows fetched at once */
+#define FETCH_ROWS 4096
+
 static int cmp(const void *pa, const void *pb)
 {
     int *p1 = (int *)pa;
@@ -349,8 +352,53 @@ int db_select_CatValArray(dbDriver * driver, const char *tab, const char *key,
     }
     cvarr->ctype = type;
 
-    /* fetch the data */
-    for (i = 0; i < nrows; i++) {
+    /* fetch the data by blocks of rows, dates and times are fetched
+       by row to keep dbDateTime values */
+    i = 0;
+    if (type != DB_C_TYPE_DATETIME) {
+	dbBlock block;
+	int row, vcol = ncols - 1;
+
+	db_init_block(&block);
+	for (i = 0; i < nrows; i += block.nrows) {
+	    if (db_fetch_block(&cursor, nrows - i < FETCH_ROWS ?
+			       nrows - i : FETCH_ROWS, &block) != DB_OK) {
+		db_free_block(&block);
+		return (-1);
+	    }
+	    if (block.nrows == 0)
+		break;
+
+	    for (row = 0; row < block.nrows; row++) {
+		dbCatVal *catval = &cvarr->value[i + row];
+
+		catval->cat = block.columns[0].i[row];
+		catval->isNull = block.columns[vcol].isNull[row];
+		switch (type) {
+		case (DB_C_TYPE_INT):
+		    catval->val.i = block.columns[vcol].i[row];
+		    break;
+
+		case (DB_C_TYPE_DOUBLE):
+		    catval->val.d = block.columns[vcol].d[row];
+		    break;
+
+		default:
+		    catval->val.s = (dbString *) malloc(sizeof(dbString));
+		    db_init_string(catval->val.s);
+
+		    if (!catval->isNull)
+			db_set_string(catval->val.s,
+				      db_get_block_string(&block, vcol, row));
+		    break;
+		}
+	    }
+	}
+	db_free_block(&block);
+	nrows = i;
+    }
+
+    for (; i < nrows; i++) {
 	if (db_fetch(&cursor, DB_NEXT, &more) != DB_OK)
 	    return (-1);
 
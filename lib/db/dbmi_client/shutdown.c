@@ -37,6 +37,13 @@ int db_shutdown_driver(dbDriver * driver)
 {
     int status;
 
+    /* a driver in the address space of this process is only stopped */
+    if (db__stop_in_process_driver(driver) == 0) {
+	db_unset_error_handler_driver(driver);
+	db_free(driver);
+	return 0;
+    }
+
     db__set_protocol_fds(driver->send, driver->recv);
     DB_START_PROCEDURE_CALL(DB_PROC_SHUTDOWN_DRIVER);
 
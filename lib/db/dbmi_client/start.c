@@ -127,6 +127,15 @@ dbDriver *db_start_driver(const char *name)
     /* free the dbmscap list */
     db_free_dbmscap(list);
 
+    /* run the driver in the address space of this process if enabled */
+    stat = db__start_in_process_driver(driver);
+    if (stat == DB_OK)
+	return driver;
+    if (stat == DB_FAILED) {
+	db_free(driver);
+	return (dbDriver *) NULL;
+    }
+
     /* run the driver as a child process and create pipes to its stdin, stdout */
 
 #ifdef __MINGW32__
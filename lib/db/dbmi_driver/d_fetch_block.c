@@ -0,0 +1,122 @@
+/*!
+ * \file db/dbmi_driver/d_fetch_block.c
+ * 
+ * \brief DBMI Library (driver) - fetch blocks of rows
+ *
+ * (C) 2020 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public
+ * License (>=v2). Read the file COPYING that comes with GRASS
+ * for details.
+ */
+
+#include <grass/dbmi.h>
+#include "macros.h"
+#include "dbstubs.h"
+
+/* block of the last call, kept for the next one */
+static dbBlock block;
+
+static int fill_row(dbTable * table, int row)
+{
+    int col;
+    dbString str;
+
+    db_init_string(&str);
+    for (col = 0; col < block.ncols; col++) {
+	dbColumnBlock *column = &block.columns[col];
+	dbColumn *dbcol = db_get_table_column(table, col);
+	dbValue *value = db_get_column_value(dbcol);
+	int isnull = db_test_value_isnull(value);
+
+	column->isNull[row] = isnull;
+	switch (column->ctype) {
+	case DB_C_TYPE_INT:
+	    column->i[row] = isnull ? 0 : db_get_value_int(value);
+	    break;
+	case DB_C_TYPE_DOUBLE:
+	    column->d[row] = isnull ? 0.0 : db_get_value_double(value);
+	    break;
+	default:
+	    if (isnull)
+		db_set_string(&str, "");
+	    else
+		db_convert_column_value_to_string(dbcol, &str);
+	    if (db_set_block_string(column, row, db_get_string(&str)) != DB_OK) {
+		db_free_string(&str);
+		return DB_MEMORY_ERR;
+	    }
+	    break;
+	}
+    }
+    db_free_string(&str);
+
+    return DB_OK;
+}
+
+/*!
+  \brief Fetch block of rows
+
+  Rows are fetched one by one with the fetch function of the driver and
+  sent by column.
+
+  \return DB_OK on success
+  \return DB_FAILED on failure
+ */
+int db_d_fetch_block(void)
+{
+    dbToken token;
+    dbCursor *cursor;
+    dbTable *table;
+    int nrows, ncols, col, more;
+
+    /* get the arg(s) */
+    DB_RECV_TOKEN(&token);
+    DB_RECV_INT(&nrows);
+    cursor = (dbCursor *) db_find_token(token);
+    if (cursor == NULL || !db_test_cursor_type_fetch(cursor)) {
+	db_error("not a fetchable cursor");
+	DB_SEND_FAILURE();
+	return DB_FAILED;
+    }
+    if (nrows < 0)
+	nrows = 0;
+
+    table = db_get_cursor_table(cursor);
+    ncols = db_get_table_number_of_columns(table);
+    if (db_alloc_block(&block, ncols, nrows) != DB_OK) {
+	DB_SEND_FAILURE();
+	return DB_OK;
+    }
+    for (col = 0; col < ncols; col++) {
+	int ctype =
+	    db_sqltype_to_Ctype(db_get_column_sqltype
+				(db_get_table_column(table, col)));
+
+	block.columns[col].ctype = ctype == DB_C_TYPE_INT ||
+	    ctype == DB_C_TYPE_DOUBLE ? ctype : DB_C_TYPE_STRING;
+    }
+
+    /* call the procedure */
+    while (block.nrows < nrows) {
+	if (db_driver_fetch(cursor, DB_NEXT, &more) != DB_OK) {
+	    DB_SEND_FAILURE();
+	    return DB_OK;
+	}
+	if (!more)
+	    break;
+	if (fill_row(table, block.nrows) != DB_OK) {
+	    DB_SEND_FAILURE();
+	    return DB_OK;
+	}
+	block.nrows++;
+    }
+
+    /* send the return code */
+    DB_SEND_SUCCESS();
+
+    /* results */
+    DB_SEND_BLOCK(&block);
+
+    return DB_OK;
+}
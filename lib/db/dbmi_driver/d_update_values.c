@@ -0,0 +1,146 @@
+/*!
+ * \file db/dbmi_driver/d_update_values.c
+ * 
+ * \brief DBMI Library (driver) - update many rows in one call
+ *
+ * (C) 2020 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public
+ * License (>=v2). Read the file COPYING that comes with GRASS
+ * for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <grass/dbmi.h>
+#include <grass/glocale.h>
+#include "macros.h"
+#include "dbstubs.h"
+
+/* one statement per row for drivers without db_driver_update_values */
+static int update_rows(dbString * table, dbString * key, int ncols,
+		       dbString * columns, const int *ctypes, int nrows,
+		       const int *keys, dbValue * values, int *nupdated)
+{
+    int i, j;
+    char buf[64];
+    dbString sql, str;
+
+    db_init_string(&sql);
+    db_init_string(&str);
+
+    for (i = 0; i < nrows; i++) {
+	db_set_string(&sql, "update ");
+	db_append_string(&sql, db_get_string(table));
+	db_append_string(&sql, " set ");
+	for (j = 0; j < ncols; j++) {
+	    dbValue *value = &values[i * ncols + j];
+
+	    if (j > 0)
+		db_append_string(&sql, ", ");
+	    db_append_string(&sql, db_get_string(&columns[j]));
+	    db_append_string(&sql, " = ");
+	    if (value->isNull) {
+		db_append_string(&sql, "NULL");
+		continue;
+	    }
+	    switch (ctypes[j]) {
+	    case DB_C_TYPE_INT:
+		sprintf(buf, "%d", value->i);
+		db_append_string(&sql, buf);
+		break;
+	    case DB_C_TYPE_DOUBLE:
+		sprintf(buf, "%.17g", value->d);
+		db_append_string(&sql, buf);
+		break;
+	    default:
+		db_set_string(&str, db_get_string(&value->s));
+		db_double_quote_string(&str);
+		db_append_string(&sql, "'");
+		db_append_string(&sql, db_get_string(&str));
+		db_append_string(&sql, "'");
+		break;
+	    }
+	}
+	sprintf(buf, " where %s = %d", db_get_string(key), keys[i]);
+	db_append_string(&sql, buf);
+
+	if (db_driver_execute_immediate(&sql) == DB_OK)
+	    (*nupdated)++;
+    }
+
+    db_free_string(&sql);
+    db_free_string(&str);
+
+    return DB_OK;
+}
+
+/*!
+  \brief Update columns of many rows in one call
+
+  \return DB_OK on success
+  \return DB_FAILED on failure
+ */
+int db_d_update_values(void)
+{
+    dbString table, key, *columns;
+    dbValue *values;
+    int *ctypes, *keys;
+    int ncols, nctypes, nrows, nupdated, stat, i;
+
+    /* get the arg(s) */
+    db_init_string(&table);
+    db_init_string(&key);
+    DB_RECV_STRING(&table);
+    DB_RECV_STRING(&key);
+    DB_RECV_STRING_ARRAY(&columns, &ncols);
+    DB_RECV_INT_ARRAY(&ctypes, &nctypes);
+    DB_RECV_INT_ARRAY(&keys, &nrows);
+    values = (dbValue *) db_calloc(nrows * ncols + 1, sizeof(dbValue));
+    for (i = 0; i < nrows * ncols; i++) {
+	if (db__recv_value(&values[i], ctypes[i % ncols]) != DB_OK)
+	    return db_get_error_code();
+    }
+
+    /* call the procedure */
+    nupdated = 0;
+    for (i = 0; i < ncols; i++) {
+	if (ctypes[i] != DB_C_TYPE_INT && ctypes[i] != DB_C_TYPE_DOUBLE &&
+	    ctypes[i] != DB_C_TYPE_STRING)
+	    break;
+    }
+    if (nctypes != ncols || i < ncols) {
+	db_d_append_error(_("Unsupported column type"));
+	db_d_report_error();
+	stat = DB_FAILED;
+    }
+    else if (db_driver_update_values)
+	stat = db_driver_update_values(&table, &key, ncols, columns, ctypes,
+				       nrows, keys, values, &nupdated);
+    else
+	stat = update_rows(&table, &key, ncols, columns, ctypes, nrows, keys,
+			   values, &nupdated);
+
+    for (i = 0; i < nrows * ncols; i++) {
+	if (ctypes[i % ncols] == DB_C_TYPE_STRING)
+	    db_free_string(&values[i].s);
+    }
+    db_free(values);
+    db_free(keys);
+    db_free(ctypes);
+    db_free_string_array(columns, ncols);
+    db_free_string(&table);
+    db_free_string(&key);
+
+    /* send the return code */
+    if (stat != DB_OK) {
+	DB_SEND_FAILURE();
+	return DB_OK;
+    }
+    DB_SEND_SUCCESS();
+
+    /* send the results */
+    DB_SEND_INT(nupdated);
+
+    return DB_OK;
+}
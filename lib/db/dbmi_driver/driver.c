@@ -28,6 +28,17 @@
 
 extern char *getenv();
 
+static int find_procedure(int procnum)
+{
+    int i;
+
+    for (i = 0; procedure[i].routine; i++)
+	if (procedure[i].procnum == procnum)
+	    break;
+
+    return i;
+}
+
 /*!
   \brief Get driver (?)
 
@@ -146,9 +157,7 @@ int db_driver(int argc, char *argv[])
 	db_clear_error();
 
 	/* find this procedure */
-	for (i = 0; procedure[i].routine; i++)
-	    if (procedure[i].procnum == procnum)
-		break;
+	i = find_procedure(procnum);
 
 	/* if found, call it */
 	if (procedure[i].routine) {
@@ -166,3 +175,65 @@ int db_driver(int argc, char *argv[])
 
     exit(stat == DB_OK ? 0 : 1);
 }
+
+/*!
+  \brief Start the driver in the address space of the client
+
+  The driver must be linked as a module loaded by the client, its
+  functions must be assigned (init_dbdriver()) before.
+
+  \param name driver name
+
+  \return DB_OK on success
+  \return DB_FAILED on failure
+ */
+int db_d_start_in_process(const char *name)
+{
+    char *argv[2];
+
+    argv[0] = (char *)name;
+    argv[1] = NULL;
+
+    db__init_driver_state();
+
+    return db_driver_init(1, argv);
+}
+
+/*!
+  \brief Run the next procedure requested from a driver started by
+  db_d_start_in_process()
+
+  The procedure is not acknowledged, an unknown procedure is reported
+  as failure.
+
+  \return DB_OK on success
+  \return DB_FAILED or DB_PROTOCOL_ERR on failure
+ */
+int db_d_call_in_process(void)
+{
+    int procnum;
+    int i;
+
+    if (db__recv_procnum(&procnum) != DB_OK) {
+	db_protocol_error();
+	return DB_PROTOCOL_ERR;
+    }
+    db_clear_error();
+
+    i = find_procedure(procnum);
+    if (!procedure[i].routine) {
+	db_noproc_error(procnum);
+	db__send_failure();
+	return DB_FAILED;
+    }
+
+    return (*procedure[i].routine) ();
+}
+
+/*!
+  \brief Stop a driver started by db_d_start_in_process()
+ */
+void db_d_stop_in_process(void)
+{
+    db_driver_finish();
+}
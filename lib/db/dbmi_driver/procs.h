@@ -14,6 +14,7 @@ extern int db_d_execute_immediate();
 extern int db_d_begin_transaction();
 extern int db_d_commit_transaction();
 extern int db_d_fetch();
+extern int db_d_fetch_block();
 extern int db_d_get_num_rows();
 extern int db_d_find_database();
 extern int db_d_grant_on_table();
@@ -27,6 +28,7 @@ extern int db_d_open_insert_cursor();
 extern int db_d_open_select_cursor();
 extern int db_d_open_update_cursor();
 extern int db_d_update();
+extern int db_d_update_values();
 extern int db_d_version();
 
 static struct
@@ -36,6 +38,7 @@ static struct
 } procedure[] = {
     {
     DB_PROC_FETCH, db_d_fetch}, {
+    DB_PROC_FETCH_BLOCK, db_d_fetch_block}, {
     DB_PROC_ROWS, db_d_get_num_rows}, {
     DB_PROC_UPDATE, db_d_update}, {
     DB_PROC_INSERT, db_d_insert}, {
@@ -43,6 +46,7 @@ static struct
     DB_PROC_EXECUTE_IMMEDIATE, db_d_execute_immediate}, {
     DB_PROC_BEGIN_TRANSACTION, db_d_begin_transaction}, {
     DB_PROC_COMMIT_TRANSACTION, db_d_commit_transaction}, {
+    DB_PROC_UPDATE_VALUES, db_d_update_values}, {
     DB_PROC_OPEN_SELECT_CURSOR, db_d_open_select_cursor}, {
     DB_PROC_OPEN_UPDATE_CURSOR, db_d_open_update_cursor}, {
     DB_PROC_BIND_UPDATE, db_d_bind_update}, {
@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -25,6 +26,13 @@ extern int D__overlay_mode;
 static int src[2][2];
 static double dst[2][2];
 
+/* cells of a row drawn by the driver, if far fewer than all of them
+   (the map is displayed zoomed out) */
+static int nused;
+static int *used_cols;
+static void *packed;
+static unsigned char *p_red, *p_grn, *p_blu, *p_set;
+
 static int draw_cell(int, const void *, struct Colors *, RASTER_MAP_TYPE);
 
 /*!
@@ -107,6 +115,60 @@ int D_draw_c_raster(int A_row, const CELL * carray, struct Colors *colors)
     return draw_cell(A_row, carray, colors, CELL_TYPE);
 }
 
+/* Rast_lookup_colors() for the cells drawn by the driver only */
+static void lookup_colors(const void *array, unsigned char *red,
+			  unsigned char *grn, unsigned char *blu,
+			  unsigned char *set, int ncols,
+			  struct Colors *colors, RASTER_MAP_TYPE data_type)
+{
+    size_t size = Rast_cell_size(data_type);
+    int i;
+
+    if (!nused) {
+	Rast_lookup_colors(array, red, grn, blu, set, ncols, colors,
+			   data_type);
+	return;
+    }
+
+    for (i = 0; i < nused; i++)
+	memcpy((char *)packed + i * size,
+	       (const char *)array + used_cols[i] * size, size);
+
+    Rast_lookup_colors(packed, p_red, p_grn, p_blu, p_set, nused, colors,
+		       data_type);
+
+    for (i = 0; i < nused; i++) {
+	int j = used_cols[i];
+
+	red[j] = p_red[i];
+	grn[j] = p_grn[i];
+	blu[j] = p_blu[i];
+	set[j] = p_set[i];
+    }
+}
+
+/* null flags of the cells drawn by the driver */
+static void set_nulls(const void *array, unsigned char *set, int ncols,
+		      RASTER_MAP_TYPE data_type)
+{
+    size_t size = Rast_cell_size(data_type);
+    int i;
+
+    if (!nused) {
+	for (i = 0; i < ncols; i++)
+	    set[i] = Rast_is_null_value((const char *)array + i * size,
+					data_type);
+	return;
+    }
+
+    for (i = 0; i < nused; i++) {
+	int j = used_cols[i];
+
+	set[j] = Rast_is_null_value((const char *)array + j * size,
+				    data_type);
+    }
+}
+
 static int draw_cell(int A_row,
 		     const void *array,
 		     struct Colors *colors, RASTER_MAP_TYPE data_type)
@@ -115,7 +177,6 @@ static int draw_cell(int A_row,
     static int nalloc;
 
     int ncols = src[0][1] - src[0][0];
-    int i;
 
     if (nalloc < ncols) {
 	nalloc = ncols;
@@ -125,14 +186,10 @@ static int draw_cell(int A_row,
 	set = G_realloc(set, nalloc);
     }
 
-    Rast_lookup_colors(array, red, grn, blu, set, ncols, colors,
-			   data_type);
+    lookup_colors(array, red, grn, blu, set, ncols, colors, data_type);
 
     if (D__overlay_mode)
-	for (i = 0; i < ncols; i++) {
-	    set[i] = Rast_is_null_value(array, data_type);
-	    array = G_incr_void_ptr(array, Rast_cell_size(data_type));
-	}
+	set_nulls(array, set, ncols, data_type);
 
     A_row =
 	COM_raster(ncols, A_row, red, grn, blu, D__overlay_mode ? set : NULL);
@@ -151,10 +208,38 @@ static int draw_cell(int A_row,
 */
 void D_raster_draw_begin(void)
 {
+    unsigned char *used;
+    int ncols, i;
+
     /* Set up the screen for drawing map */
     D_get_a(src);
     D_get_d(dst);
     COM_begin_raster(D__overlay_mode, src, dst);
+
+    /* look up the colors of the cells the driver samples only */
+    nused = 0;
+    ncols = src[0][1] - src[0][0];
+    used = G_malloc(ncols);
+    if (COM_raster_columns(ncols, used)) {
+	int n = 0;
+
+	for (i = 0; i < ncols; i++)
+	    n += used[i] != 0;
+
+	if (n < ncols / 2) {
+	    used_cols = G_realloc(used_cols, (n + 1) * sizeof(int));
+	    for (i = 0; i < ncols; i++)
+		if (used[i])
+		    used_cols[nused++] = i;
+
+	    packed = G_realloc(packed, (n + 1) * sizeof(DCELL));
+	    p_red = G_realloc(p_red, n + 1);
+	    p_grn = G_realloc(p_grn, n + 1);
+	    p_blu = G_realloc(p_blu, n + 1);
+	    p_set = G_realloc(p_set, n + 1);
+	}
+    }
+    G_free(used);
 }
 
 /*!
@@ -200,22 +285,24 @@ int D_draw_raster_RGB(int A_row,
     }
 
     /* convert cell values to bytes */
-    Rast_lookup_colors(r_raster, r_buf, n_buf, n_buf, n_buf, ncols,
-			   r_colors, r_type);
-    Rast_lookup_colors(g_raster, n_buf, g_buf, n_buf, n_buf, ncols,
-			   g_colors, g_type);
-    Rast_lookup_colors(b_raster, n_buf, n_buf, b_buf, n_buf, ncols,
-			   b_colors, b_type);
+    lookup_colors(r_raster, r_buf, n_buf, n_buf, n_buf, ncols,
+		  r_colors, r_type);
+    lookup_colors(g_raster, n_buf, g_buf, n_buf, n_buf, ncols,
+		  g_colors, g_type);
+    lookup_colors(b_raster, n_buf, n_buf, b_buf, n_buf, ncols,
+		  b_colors, b_type);
 
     if (D__overlay_mode)
-	for (i = 0; i < ncols; i++) {
-	    n_buf[i] = (Rast_is_null_value(r_raster, r_type) ||
-			Rast_is_null_value(g_raster, g_type) ||
-			Rast_is_null_value(b_raster, b_type));
-
-	    r_raster = G_incr_void_ptr(r_raster, r_size);
-	    g_raster = G_incr_void_ptr(g_raster, g_size);
-	    b_raster = G_incr_void_ptr(b_raster, b_size);
+	for (i = 0; i < (nused ? nused : ncols); i++) {
+	    int j = nused ? used_cols[i] : i;
+
+	    n_buf[j] =
+		(Rast_is_null_value((const char *)r_raster + j * r_size,
+				    r_type) ||
+		 Rast_is_null_value((const char *)g_raster + j * g_size,
+				    g_type) ||
+		 Rast_is_null_value((const char *)b_raster + j * b_size,
+				    b_type));
 	}
 
     A_row = COM_raster(ncols, A_row, r_buf, g_buf, b_buf,
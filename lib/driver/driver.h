@@ -36,6 +36,7 @@ struct driver
 		  const unsigned char *,
 		  const unsigned char *,
 		  const unsigned char *);
+    int (*Raster_columns)(int, unsigned char *);
     void (*End_raster)(void);
     void (*Begin)(void);
     void (*Move)(double, double);
@@ -96,6 +97,7 @@ extern void COM_begin_raster(int, int[2][2], double[2][2]);
 extern int COM_raster(int, int, const unsigned char *,
 		      const unsigned char *, const unsigned char *,
 		      const unsigned char *);
+extern int COM_raster_columns(int, unsigned char *);
 extern void COM_end_raster(void);
 
 /* set_window.c */
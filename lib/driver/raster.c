@@ -26,6 +26,15 @@ int COM_raster(int n, int row,
     return -1;
 }
 
+/* which cells of a row the driver draws, 0 if all of them */
+int COM_raster_columns(int n, unsigned char *used)
+{
+    if (driver->Raster_columns)
+	return (*driver->Raster_columns) (n, used);
+
+    return 0;
+}
+
 void COM_end_raster(void)
 {
     if (driver->End_raster)
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <grass/gis.h>
 #include "viz.h"
 
@@ -22,8 +23,8 @@ static unsigned char Buffer[10000];	/* buffer for outputting data to file */
  *       lower routine that writes out compressed data.
  */
 
-int write_cube(Cube_data * Cube,	/* array of poly info  by threshold */
-	       int cur_x, file_info * headfax)
+static int pack_cube(Cube_data * Cube, file_info * headfax,
+		     unsigned char *Buffer)
 {
     register int i, j;
     register int size;		/* final size of data written */
@@ -80,8 +81,63 @@ int write_cube(Cube_data * Cube,	/* array of poly info  by threshold */
 	Buffer[2] = size & 0xff;
     }
 
+    return offset3;
+}
+
+int write_cube(Cube_data * Cube,	/* array of poly info  by threshold */
+	       int cur_x, file_info * headfax)
+{
+    int size;
+
+    size = pack_cube(Cube, headfax, Buffer);
+
     /*fprintf(stderr,"before write_cube_buffer\n"); */
-    write_cube_buffer(Buffer, offset3, cur_x, headfax);	/* write it out to file */
+    write_cube_buffer(Buffer, size, cur_x, headfax);	/* write it out to file */
+
+    return 0;
+}
+
+/*
+ **  Same as write_cube(), but the data are appended to a memory buffer
+ **  instead of the display file, so that rows can be written by several
+ **  threads and the buffers output in order afterwards. Runs of empty
+ **  cubes end with each row, as in the file.
+ */
+static void append(cube_buffer * out, const unsigned char *data, int size)
+{
+    if (out->size + size > out->alloc) {
+	out->alloc = 2 * out->alloc + size + 1024;
+	out->data = G_realloc(out->data, out->alloc);
+    }
+    memcpy(out->data + out->size, data, size);
+    out->size += size;
+}
+
+int write_cube_mem(Cube_data * Cube, int cur_x, file_info * headfax,
+		   cube_buffer * out)
+{
+    unsigned char buf[sizeof(Buffer)];
+    unsigned char junk;
+    int size;
+
+    size = pack_cube(Cube, headfax, buf);
+
+    if (!buf[0]) {
+	out->num_zero++;
+	if (out->num_zero == 126 || cur_x == headfax->xdim - 2) {
+	    junk = 0x80 | out->num_zero;
+	    append(out, &junk, 1);
+	    out->num_zero = 0;
+	}
+    }
+    else {
+	if (out->num_zero) {
+	    junk = 0x80 | out->num_zero;
+	    append(out, &junk, 1);
+	    out->num_zero = 0;
+	}
+	append(out, buf, size);
+    }
 
     return 0;
 }
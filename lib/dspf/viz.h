@@ -78,9 +78,17 @@ typedef struct
     int polys[30];
 } CELL_ENTRY;			/* for writing out in condensed format */
 
+typedef struct
+{
+    unsigned char *data;	/* display file data of one or more rows */
+    int size, alloc;
+    int num_zero;		/* pending run of empty cubes */
+} cube_buffer;
+
 /* cube_io.c */
 int write_cube(Cube_data *, int, file_info *);
 int write_cube_buffer(unsigned char *, int, int, file_info *);
+int write_cube_mem(Cube_data *, int, file_info *, cube_buffer *);
 int read_cube(Cube_data *, file_info *);
 int my_fread(char *, int, int, FILE *);
 int my_fread(char *, int, int, FILE *);
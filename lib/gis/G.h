@@ -7,6 +7,7 @@ struct G__			/*  Structure of library globals */
     int window_set;		/* Flag: window set?                    */
     int little_endian;          /* Flag denoting little-endian architecture */
     int compression_level;	/* zlib compression level               */
+    int zstd_level;		/* zstd compression level               */
 };
 
 extern struct G__ G__;		/* allocated in gisinit */
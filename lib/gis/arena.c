@@ -0,0 +1,252 @@
+/*!
+ * \file lib/gis/arena.c
+ *
+ * \brief GIS Library - Region allocator.
+ *
+ * An arena hands out memory from large blocks by advancing a pointer;
+ * individual allocations are never freed. Instead, everything
+ * allocated after a mark is released at once with G_arena_release(),
+ * or everything with G_arena_reset(). Released blocks are kept for
+ * reuse, so that a loop which allocates the temporaries of each
+ * iteration from an arena and releases them at the end of the
+ * iteration does not call malloc() once the arena is large enough.
+ *
+ * An arena must not be used by several threads at the same time; give
+ * each thread its own arena.
+ *
+ * (C) 2019 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/glocale.h>
+
+#define DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/* alignment of every allocation, enough for any basic type */
+union align
+{
+    long l;
+    double d;
+    void *p;
+    long double ld;
+};
+
+#define ALIGN sizeof(union align)
+#define ROUND(n) (((n) + ALIGN - 1) / ALIGN * ALIGN)
+
+struct block
+{
+    struct block *next;
+    size_t size;		/* bytes available for allocations */
+    size_t used;
+};
+
+#define HEADER ROUND(sizeof(struct block))
+#define DATA(b) ((char *)(b) + HEADER)
+
+struct G_arena
+{
+    size_t block_size;
+    struct block *head;		/* block in use, then the full ones */
+    struct block *spare;	/* released blocks of block_size */
+    size_t used;		/* bytes handed out in the full blocks */
+};
+
+/*!
+ * \brief Create a region allocator
+ *
+ * \param block_size size of the blocks of memory obtained from the
+ * system, 0 for the default (64 KiB); larger allocations get a block
+ * of their own
+ *
+ * \return pointer to the new arena
+ */
+struct G_arena *G_arena_create(size_t block_size)
+{
+    struct G_arena *arena = G_malloc(sizeof(struct G_arena));
+
+    arena->block_size = block_size > 0 ? ROUND(block_size) :
+	DEFAULT_BLOCK_SIZE;
+    arena->head = NULL;
+    arena->spare = NULL;
+    arena->used = 0;
+
+    return arena;
+}
+
+static struct block *new_block(struct G_arena *arena, size_t n)
+{
+    struct block *b;
+
+    if (n <= arena->block_size && arena->spare) {
+	b = arena->spare;
+	arena->spare = b->next;
+    }
+    else {
+	size_t size = n > arena->block_size ? n : arena->block_size;
+
+	b = G_malloc(HEADER + size);
+	b->size = size;
+    }
+
+    b->used = 0;
+    if (arena->head)
+	arena->used += arena->head->used;
+    b->next = arena->head;
+    arena->head = b;
+
+    return b;
+}
+
+/* give a block back, keeping it if it has the standard size */
+static void drop_block(struct G_arena *arena, struct block *b)
+{
+    if (b->size == arena->block_size) {
+	b->next = arena->spare;
+	arena->spare = b;
+    }
+    else
+	G_free(b);
+}
+
+/*!
+ * \brief Allocate memory from an arena
+ *
+ * The memory is suitably aligned for any type. It stays valid until
+ * it is released by G_arena_release() with an earlier mark,
+ * G_arena_reset() or G_arena_destroy(). Calls G_fatal_error() when
+ * out of memory.
+ *
+ * \param arena pointer to the arena
+ * \param n number of bytes
+ *
+ * \return pointer to the memory
+ */
+void *G_arena_alloc(struct G_arena *arena, size_t n)
+{
+    struct block *b = arena->head;
+    void *p;
+
+    n = ROUND(n > 0 ? n : 1);
+
+    if (!b || b->size - b->used < n)
+	b = new_block(arena, n);
+
+    p = DATA(b) + b->used;
+    b->used += n;
+
+    return p;
+}
+
+/*!
+ * \brief Allocate zeroed memory for an array from an arena
+ *
+ * \param arena pointer to the arena
+ * \param m number of elements
+ * \param n size of an element
+ *
+ * \return pointer to the memory
+ */
+void *G_arena_calloc(struct G_arena *arena, size_t m, size_t n)
+{
+    void *p;
+
+    if (n > 0 && m > (size_t)-1 / n)
+	G_fatal_error(_("G_arena_calloc(): %lu elements of %lu bytes are too many"),
+		      (unsigned long)m, (unsigned long)n);
+
+    p = G_arena_alloc(arena, m * n);
+    memset(p, 0, m * n);
+
+    return p;
+}
+
+/*!
+ * \brief Remember the current position of an arena
+ *
+ * \param arena pointer to the arena
+ * \param[out] mark position to pass to G_arena_release()
+ */
+void G_arena_mark(struct G_arena *arena, struct G_arena_mark *mark)
+{
+    mark->block = arena->head;
+    mark->used = arena->head ? arena->head->used : 0;
+}
+
+/*!
+ * \brief Release the memory allocated since a mark
+ *
+ * Marks are released in the reverse order they were taken; releasing
+ * a mark invalidates the marks taken after it.
+ *
+ * \param arena pointer to the arena
+ * \param mark position from G_arena_mark()
+ */
+void G_arena_release(struct G_arena *arena, const struct G_arena_mark *mark)
+{
+    while (arena->head && arena->head != mark->block) {
+	struct block *b = arena->head;
+
+	arena->head = b->next;
+	if (arena->head)
+	    arena->used -= arena->head->used;
+	drop_block(arena, b);
+    }
+
+    if (arena->head)
+	arena->head->used = mark->used;
+}
+
+/*!
+ * \brief Release all memory allocated from an arena
+ *
+ * The blocks of the arena are kept for further allocations.
+ *
+ * \param arena pointer to the arena
+ */
+void G_arena_reset(struct G_arena *arena)
+{
+    struct G_arena_mark start;
+
+    start.block = NULL;
+    start.used = 0;
+    G_arena_release(arena, &start);
+}
+
+/*!
+ * \brief Free an arena and all memory allocated from it
+ *
+ * \param arena pointer to the arena
+ */
+void G_arena_destroy(struct G_arena *arena)
+{
+    struct block *b, *next;
+
+    if (!arena)
+	return;
+
+    G_arena_reset(arena);
+    for (b = arena->spare; b; b = next) {
+	next = b->next;
+	G_free(b);
+    }
+    G_free(arena);
+}
+
+/*!
+ * \brief Number of bytes currently allocated from an arena
+ *
+ * Includes the padding of the allocations.
+ *
+ * \param arena pointer to the arena
+ *
+ * \return bytes in use
+ */
+size_t G_arena_used(const struct G_arena *arena)
+{
+    return arena->used + (arena->head ? arena->head->used : 0);
+}
@@ -69,6 +69,8 @@
 #include <grass/gis.h>
 #include <grass/glocale.h>
 
+#include "G.h"
+
 
 int
 G_zstd_compress_bound(int src_sz)
@@ -128,7 +130,8 @@ G_zstd_compress(unsigned char *src, int src_sz, unsigned char *dst,
 	buf_sz = dst_sz;
 
     /* Do single pass compression */
-    err = ZSTD_compress((char *)buf, buf_sz, (char *)src, src_sz, 3);
+    err = ZSTD_compress((char *)buf, buf_sz, (char *)src, src_sz,
+			G__.zstd_level);
 
     if (err <= 0 || ZSTD_isError(err)) {
 	G_warning(_("ZSTD compression error %d: %s"),
@@ -86,9 +86,11 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/time.h>
 #include <grass/gis.h>
 #include <grass/glocale.h>
 
+#include "G.h"
 #include "compress.h"
 
 #define G_COMPRESSED_NO (unsigned char)'0'
@@ -450,5 +452,166 @@ int G_write_uncompressed(int fd, const unsigned char *src, int nbytes)
 
 }				/* G_write_uncompressed() */
 
+/* set the compression level of a compressor
+ * (the defaults come from GRASS_ZLIB_LEVEL and GRASS_ZSTD_LEVEL)
+ * return the previous level
+ * return -1 if the compressor has no adjustable level */
+int G_set_compressor_level(int number, int level)
+{
+    int old;
+
+    switch (number) {
+    case 2:
+	old = G__.compression_level;
+	if (level >= -1 && level <= 9)
+	    G__.compression_level = level;
+	return old;
+    case 5:
+	old = G__.zstd_level;
+	if (level >= 1 && level <= 19)
+	    G__.zstd_level = level;
+	return old;
+    default:
+	return -1;
+    }
+}
+
+static double elapsed(const struct timeval *t0)
+{
+    struct timeval t1;
+
+    gettimeofday(&t1, NULL);
+
+    return (t1.tv_sec - t0->tv_sec) + (t1.tv_usec - t0->tv_usec) / 1e6;
+}
+
+/* benchmark a compressor on a set of buffers, e.g. rows of a raster map
+ * each buffer is compressed and expanded separately like a row, the
+ * buffers are processed repeatedly for at least min_time seconds
+ * buffers which don't shrink are counted as stored uncompressed
+ * return 0 on success
+ * return -1 if the compressor is not available or fails,
+ * or if the expanded data differ from the buffers */
+int G_compress_benchmark(int number, unsigned char **bufs, const int *sizes,
+			 int nbufs, double min_time,
+			 struct G_compress_stats *stats)
+{
+    unsigned char **cbufs, *ebuf;
+    int *csizes;
+    double total, stored, t = 0;
+    struct timeval t0;
+    int i, passes, max_size, err;
+
+    if (G_check_compressor(number) != 1 || nbufs <= 0)
+	return -1;
+
+    cbufs = G_malloc(nbufs * sizeof(unsigned char *));
+    csizes = G_malloc(nbufs * sizeof(int));
+    max_size = 0;
+    total = 0;
+    for (i = 0; i < nbufs; i++) {
+	cbufs[i] = G_malloc(G_compress_bound(sizes[i], number));
+	if (max_size < sizes[i])
+	    max_size = sizes[i];
+	total += sizes[i];
+    }
+    ebuf = G_malloc(max_size > 0 ? max_size : 1);
+    err = 0;
+
+    /* compression */
+    passes = 0;
+    gettimeofday(&t0, NULL);
+    do {
+	for (i = 0; i < nbufs && !err; i++) {
+	    csizes[i] = G_compress(bufs[i], sizes[i], cbufs[i],
+				   G_compress_bound(sizes[i], number), number);
+	    if (csizes[i] < 0)
+		err = -1;
+	}
+	passes++;
+    } while (!err && (t = elapsed(&t0)) < min_time);
+
+    stats->compress_rate = err ? 0 : total * passes / (t > 0 ? t : 1e-6) / 1e6;
+
+    stored = 0;
+    for (i = 0; i < nbufs; i++) {
+	/* one flag byte per buffer as in G_write_compressed() */
+	if (csizes[i] <= 0 || csizes[i] >= sizes[i])
+	    csizes[i] = 0;
+	stored += (csizes[i] > 0 ? csizes[i] : sizes[i]) + 1;
+    }
+    stats->ratio = stored > 0 ? total / stored : 1;
+
+    /* expansion, checked on the first pass */
+    passes = 0;
+    gettimeofday(&t0, NULL);
+    while (!err) {
+	for (i = 0; i < nbufs && !err; i++) {
+	    if (csizes[i] == 0) {
+		memcpy(ebuf, bufs[i], sizes[i]);
+		continue;
+	    }
+	    if (G_expand(cbufs[i], csizes[i], ebuf, sizes[i], number) !=
+		sizes[i] || (passes == 0 &&
+			     memcmp(ebuf, bufs[i], sizes[i]) != 0))
+		err = -1;
+	}
+	passes++;
+	if ((t = elapsed(&t0)) >= min_time)
+	    break;
+    }
+
+    stats->expand_rate = err ? 0 : total * passes / (t > 0 ? t : 1e-6) / 1e6;
+
+    for (i = 0; i < nbufs; i++)
+	G_free(cbufs[i]);
+    G_free(cbufs);
+    G_free(csizes);
+    G_free(ebuf);
+
+    return err;
+}
+
+/* choose a compressor for data similar to a set of sample buffers
+ * among the available compressors, the one with the highest ratio
+ * which compresses at least target MB per second is chosen, if none
+ * is fast enough the fastest one
+ * return compressor number, the default compressor if none works */
+int G_compressor_select(unsigned char **bufs, const int *sizes, int nbufs,
+			double target)
+{
+    struct G_compress_stats stats;
+    int i, best, fastest;
+    double best_ratio, best_rate;
+
+    best = fastest = -1;
+    best_ratio = best_rate = 0;
+
+    for (i = 1; i < n_compressors; i++) {
+	if (G_compress_benchmark(i, bufs, sizes, nbufs, 0.005, &stats) < 0)
+	    continue;
+
+	G_debug(2, "G_compressor_select(): %s ratio %.2f, %.1f MB/s",
+		compressor[i].name, stats.ratio, stats.compress_rate);
+
+	if (stats.compress_rate >= target && stats.ratio > best_ratio) {
+	    best = i;
+	    best_ratio = stats.ratio;
+	}
+	if (stats.compress_rate > best_rate) {
+	    fastest = i;
+	    best_rate = stats.compress_rate;
+	}
+    }
+
+    if (best < 0)
+	best = fastest;
+    if (best < 0)
+	best = G_default_compressor();
+
+    G_debug(1, "Selected %s compression", compressor[best].name);
+
+    return best;
+}
 
 /* vim: set softtabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,318 @@
+/*!
+  \file lib/gis/element_index.c
+
+  \brief GIS library - Index of the files of mapset elements
+
+  When GRASS_ELEMENT_INDEX is set to 1, the names of the files of a
+  database element (e.g. "cell" or "vector") in a mapset are read once
+  per process and kept in memory, so that G_find_file() and listings
+  need no further file system accesses for that element. The names are
+  also stored in the .index directory of the current mapset together
+  with the modification time of the element directory, and used by
+  later processes as long as the directory is not modified.
+
+  Changes done by other processes while a module runs are not seen by
+  the module, changes done by the module itself through the library
+  are.
+
+  (C) 2019 by the GRASS Development Team
+
+  This program is free software under the GNU General Public License
+  (>=v2). Read the file COPYING that comes with GRASS for details.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <grass/gis.h>
+
+#define INDEX_ELEMENT ".index"
+#define INDEX_HEADER "GRASS element index 1"
+
+struct index {
+    char *element;
+    char *mapset;
+    char **names;
+    int count;
+};
+
+static struct state {
+    int initialized;
+    int enabled;
+    struct index *list;
+    int count;
+    int alloc;
+} state;
+
+static struct state *st = &state;
+
+static int cmp_names(const void *aa, const void *bb)
+{
+    char *const *a = (char *const *)aa;
+    char *const *b = (char *const *)bb;
+
+    return strcmp(*a, *b);
+}
+
+static char **scan_dir(const char *dir, int *count)
+{
+    struct dirent *dp;
+    DIR *dfd;
+    char **names = NULL;
+    int n = 0, alloc = 0;
+
+    *count = 0;
+    if ((dfd = opendir(dir)) == NULL)
+	return NULL;
+
+    while ((dp = readdir(dfd)) != NULL) {
+	if (dp->d_name[0] == '.')
+	    continue;
+	if (n >= alloc) {
+	    alloc = alloc ? 2 * alloc : 64;
+	    names = G_realloc(names, alloc * sizeof(char *));
+	}
+	names[n++] = G_store(dp->d_name);
+    }
+    closedir(dfd);
+
+    qsort(names, n, sizeof(char *), cmp_names);
+
+    *count = n;
+    return names;
+}
+
+static int read_index(const char *file, long mtime, char ***names,
+		      int *count)
+{
+    FILE *fp;
+    char buf[GPATH_MAX];
+    long file_mtime;
+    int n, i;
+
+    if (!(fp = fopen(file, "r")))
+	return 0;
+
+    if (!G_getl2(buf, sizeof(buf), fp) || strcmp(buf, INDEX_HEADER) != 0 ||
+	!G_getl2(buf, sizeof(buf), fp) ||
+	sscanf(buf, "%ld %d", &file_mtime, &n) != 2 ||
+	file_mtime != mtime || n < 0) {
+	fclose(fp);
+	return 0;
+    }
+
+    *names = n > 0 ? G_malloc(n * sizeof(char *)) : NULL;
+    for (i = 0; i < n && G_getl2(buf, sizeof(buf), fp); i++)
+	(*names)[i] = G_store(buf);
+    fclose(fp);
+
+    /* truncated index */
+    if (i < n) {
+	while (i > 0)
+	    G_free((*names)[--i]);
+	G_free(*names);
+	return 0;
+    }
+
+    *count = n;
+    return 1;
+}
+
+static void write_index(const char *file, long mtime, char **names,
+			int count)
+{
+    char tmp[GPATH_MAX];
+    FILE *fp;
+    int i, ok;
+
+    /* a directory modified in the last seconds could be modified again
+       without a change of its modification time */
+    if (time(NULL) - mtime < 2)
+	return;
+
+    G_make_mapset_element(INDEX_ELEMENT);
+    sprintf(tmp, "%s.%d", file, getpid());
+    if (!(fp = fopen(tmp, "w")))
+	return;
+
+    fprintf(fp, "%s\n%ld %d\n", INDEX_HEADER, mtime, count);
+    for (i = 0; i < count; i++)
+	fprintf(fp, "%s\n", names[i]);
+    ok = !ferror(fp);
+
+    if (fclose(fp) != 0 || !ok || G_rename_file(tmp, file) != 0)
+	remove(tmp);
+}
+
+static void load_index(struct index *idx)
+{
+    char dir[GPATH_MAX], file[GPATH_MAX];
+    struct stat info;
+
+    idx->names = NULL;
+    idx->count = 0;
+
+    G_file_name(dir, idx->element, "", idx->mapset);
+    if (G_stat(dir, &info) != 0 || !S_ISDIR(info.st_mode))
+	return;
+
+    G_file_name(file, INDEX_ELEMENT, idx->element, idx->mapset);
+    if (read_index(file, (long)info.st_mtime, &idx->names, &idx->count))
+	return;
+
+    idx->names = scan_dir(dir, &idx->count);
+
+    /* only the current mapset can be written to */
+    if (strcmp(idx->mapset, G_mapset()) == 0)
+	write_index(file, (long)info.st_mtime, idx->names, idx->count);
+}
+
+static struct index *get_index(const char *element, const char *mapset)
+{
+    struct index *idx;
+    int i;
+
+    if (!G_element_index_enabled())
+	return NULL;
+
+    /* only top-level elements are indexed */
+    if (!element || !*element || strchr(element, '/') ||
+	!mapset || !*mapset)
+	return NULL;
+
+    for (i = 0; i < st->count; i++) {
+	idx = &st->list[i];
+	if (strcmp(idx->element, element) == 0 &&
+	    strcmp(idx->mapset, mapset) == 0)
+	    return idx;
+    }
+
+    if (st->count >= st->alloc) {
+	st->alloc += 16;
+	st->list = G_realloc(st->list, st->alloc * sizeof(struct index));
+    }
+    idx = &st->list[st->count++];
+    idx->element = G_store(element);
+    idx->mapset = G_store(mapset);
+    load_index(idx);
+
+    return idx;
+}
+
+/*!
+  \brief Check if the element index is enabled
+
+  The index is enabled by setting GRASS_ELEMENT_INDEX to 1.
+
+  \return 1 if enabled
+  \return 0 otherwise
+*/
+int G_element_index_enabled(void)
+{
+    if (G_is_initialized(&st->initialized))
+	return st->enabled;
+
+    {
+	const char *p = getenv("GRASS_ELEMENT_INDEX");
+
+	st->enabled = p && atoi(p) > 0;
+    }
+
+    G_initialize_done(&st->initialized);
+    return st->enabled;
+}
+
+/*!
+  \brief Get the names of the files of an element in a mapset
+
+  The list is sorted alphabetically and owned by the library, it must
+  not be modified or freed.
+
+  \param element element name (e.g. "cell")
+  \param mapset mapset name
+  \param[out] count number of names
+
+  \return list of names (may be NULL if count is 0)
+  \return NULL and count -1 if the index is not enabled
+*/
+char **G_element_index(const char *element, const char *mapset, int *count)
+{
+    struct index *idx = get_index(element, mapset);
+
+    if (!idx) {
+	*count = -1;
+	return NULL;
+    }
+
+    *count = idx->count;
+    return idx->names;
+}
+
+/*!
+  \brief Look up a file of an element in a mapset in the index
+
+  \param element element name (e.g. "cell")
+  \param name file name
+  \param mapset mapset name
+
+  \return 1 if the file exists
+  \return 0 if it does not exist
+  \return -1 if the index is not enabled for the element
+*/
+int G_element_index_find(const char *element, const char *name,
+			 const char *mapset)
+{
+    struct index *idx = get_index(element, mapset);
+
+    if (!idx)
+	return -1;
+
+    return idx->count > 0 &&
+	bsearch(&name, idx->names, idx->count, sizeof(char *),
+		cmp_names) != NULL;
+}
+
+/*!
+  \brief Discard the index of an element after a change
+
+  Called by the library after files of the element were created,
+  renamed or removed. The index is read again when needed.
+
+  \param element element name, only the part before the first '/' is
+  used (e.g. "vector" for "vector/roads")
+  \param mapset mapset name
+*/
+void G_element_index_changed(const char *element, const char *mapset)
+{
+    char top[GPATH_MAX];
+    int i;
+
+    if (!st->count || !element || !mapset)
+	return;
+
+    strncpy(top, element, sizeof(top) - 1);
+    top[sizeof(top) - 1] = '\0';
+    top[strcspn(top, "/")] = '\0';
+
+    for (i = 0; i < st->count; i++) {
+	struct index *idx = &st->list[i];
+
+	if (strcmp(idx->element, top) != 0 ||
+	    strcmp(idx->mapset, mapset) != 0)
+	    continue;
+
+	while (idx->count > 0)
+	    G_free(idx->names[--idx->count]);
+	G_free(idx->names);
+	G_free(idx->element);
+	G_free(idx->mapset);
+	st->list[i] = st->list[--st->count];
+	return;
+    }
+}
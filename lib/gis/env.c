@@ -17,9 +17,12 @@
 #include <stdlib.h>
 #include <unistd.h>		/* for sleep() */
 #include <string.h>
+#include <sys/stat.h>
 #include <grass/gis.h>
 #include <grass/glocale.h>
 
+#include "gis_local_proto.h"
+
 struct bind {
     int loc;
     char *name;
@@ -48,6 +51,8 @@ static int unset_env(const char *, int);
 static const char *get_env(const char *, int);
 static void write_env(int);
 static void parse_env(FILE *, int);
+static void parse_line(char *, int);
+static int read_env_cache(void);
 static void force_read_env(int);
 static FILE *open_env(const char *, int);
 
@@ -117,22 +122,80 @@ void G__read_gisrc_env(void)
 static void parse_env(FILE *fd, int loc)
 {    
     char buf[200];
+
+    while (G_getl2(buf, sizeof buf, fd))
+	parse_line(buf, loc);
+}
+
+static void parse_line(char *buf, int loc)
+{
     char *name;
     char *value;
 
-    while (G_getl2(buf, sizeof buf, fd)) {
-	    for (name = value = buf; *value; value++)
-		if (*value == ':')
-		    break;
-	    if (*value == 0)
-		continue;
-
-	    *value++ = 0;
-	    G_strip(name);
-	    G_strip(value);
-	    if (*name && *value)
-		set_env(name, value, loc);
-	}
+    for (name = value = buf; *value; value++)
+	if (*value == ':')
+	    break;
+    if (*value == 0)
+	return;
+
+    *value++ = 0;
+    G_strip(name);
+    G_strip(value);
+    if (*name && *value)
+	set_env(name, value, loc);
+}
+
+/*!
+ * \brief Read the GISRC variables from GRASS_GISRC_CACHE
+ *
+ * The cache is a copy of the GISRC file passed by the parent process,
+ * preceded by a line with the modification time and the size of the
+ * file and a line with its path. It is used only if the file still
+ * has that modification time and size, which costs a stat() instead
+ * of reading the file.
+ *
+ * \return 1 if the variables were read from the cache
+ * \return 0 if there is no valid cache
+ */
+static int read_env_cache(void)
+{
+    const char *cache = getenv("GRASS_GISRC_CACHE");
+    const char *path, *end;
+    long mtime, size;
+    int n;
+    struct stat info;
+    char *buf, *line, *next;
+
+    if (!cache || !*cache)
+	return 0;
+    if (!st->gisrc)
+	st->gisrc = getenv("GISRC");
+    if (!st->gisrc)
+	return 0;
+
+    if (sscanf(cache, "%ld %ld%n", &mtime, &size, &n) != 2 ||
+	cache[n] != '\n')
+	return 0;
+    path = cache + n + 1;
+    if (!(end = strchr(path, '\n')))
+	return 0;
+    if (strlen(st->gisrc) != (size_t) (end - path) ||
+	strncmp(path, st->gisrc, end - path) != 0)
+	return 0;
+
+    if (G_stat(st->gisrc, &info) != 0 ||
+	(long)info.st_mtime != mtime || (long)info.st_size != size)
+	return 0;
+
+    buf = G_store(end + 1);
+    for (line = buf; line; line = next) {
+	if ((next = strchr(line, '\n')))
+	    *next++ = 0;
+	parse_line(line, G_VAR_GISRC);
+    }
+    G_free(buf);
+
+    return 1;
 }
 
 static int read_env(int loc)
@@ -146,9 +209,11 @@ static int read_env(int loc)
     if (G_is_initialized(&st->init[loc]))
 	return 1;
 
-    if ((fd = open_env("r", loc))) {
-        parse_env(fd, loc);
-        fclose(fd);
+    if (loc == G_VAR_MAPSET || !read_env_cache()) {
+	if ((fd = open_env("r", loc))) {
+	    parse_env(fd, loc);
+	    fclose(fd);
+	}
     }
 
     G_initialize_done(&st->init[loc]);
@@ -316,9 +381,13 @@ static FILE *open_env(const char *mode, int loc)
     else if (loc == G_VAR_MAPSET) {
 	/* Warning: G_VAR_GISRC must be previously read -> */
 	/* TODO: better place ? */
+	char *location;
+
 	read_env(G_VAR_GISRC);
 
-	sprintf(buf, "%s/%s/VAR", G_location_path(), G_mapset());
+	location = G__location_path();
+	sprintf(buf, "%s/%s/VAR", location, G_mapset());
+	G_free(location);
     }
 
     return fopen(buf, mode);
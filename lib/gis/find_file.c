@@ -103,11 +103,17 @@ static const char *find_file(int misc, const char *dir,
 	const char *pelement = find_element(misc, dir, element);
 
 	for (n = 0; (pmapset = G_get_mapset_name(n)); n++) {
+	    int found = -1;
+
 	    if (misc && element == pelement)
 		G_file_name_misc(path, dir, pelement, pname, pmapset);
-	    else
+	    else {
+		found = G_element_index_find(pelement, pname, pmapset);
 		G_file_name(path, pelement, pname, pmapset);
-	    if (access(path, 0) == 0) {
+	    }
+	    if (found < 0)
+		found = access(path, 0) == 0;
+	    if (found) {
 		if (!pselmapset)
 		    pselmapset = pmapset;
 		else if (element == pelement)
@@ -117,11 +123,17 @@ static const char *find_file(int misc, const char *dir,
 	    }
 	}
 	if (cnt > 0) {
+	    int found = -1;
+
 	    if (misc)
 		G_file_name_misc(path, dir, element, pname, pselmapset);
-	    else
+	    else {
+		found = G_element_index_find(element, name, pselmapset);
 		G_file_name(path, element, name, pselmapset);
-	    if (access(path, 0) == 0) {
+	    }
+	    if (found < 0)
+		found = access(path, 0) == 0;
+	    if (found) {
 		/* If the same name exists in more mapsets and print a warning */
 		if (cnt > 1 && element == pelement)
 		    G_important_message(_("Using <%s@%s>..."),
@@ -138,12 +150,18 @@ static const char *find_file(int misc, const char *dir,
      * permanent storage via G_store().
      */
     else {
+	int found = -1;
+
 	if (misc)
 	    G_file_name_misc(path, dir, element, pname, pmapset);
-	else
+	else {
+	    found = G_element_index_find(element, pname, pmapset);
 	    G_file_name(path, element, pname, pmapset);
+	}
 	    
-	if (access(path, 0) == 0)
+	if (found < 0)
+	    found = access(path, 0) == 0;
+	if (found)
 	    return G_store(pmapset);
     }
     
@@ -55,8 +55,8 @@ void G__gisinit(const char *version, const char *pgm)
 			"You need to rebuild GRASS GIS or untangle multiple installations."),
                         version, GIS_H_VERSION);
 
-    /* Make sure location and mapset are set */
-    G_location_path();
+    /* Make sure location and mapset are set, the location is checked
+       only if the mapset is not found to save a file system access */
     mapset = G_mapset();
     switch (G_mapset_permissions(mapset)) {
     case 1:
@@ -107,7 +107,7 @@ void G__check_gisinit(void)
 
 static int gisinit(void)
 {
-    char *zlib;
+    char *zlib, *zstd;
 
 #ifdef __MINGW32__
     _fmode = O_BINARY;
@@ -127,6 +127,12 @@ static int gisinit(void)
     if (G__.compression_level < -1 || G__.compression_level > 9)
 	G__.compression_level = 1;
 
+    zstd = getenv("GRASS_ZSTD_LEVEL");
+    /* Valid zstd compression levels 1 - 19, 3 is the zstd default */
+    G__.zstd_level = (zstd && *zstd && isdigit(*zstd)) ? atoi(zstd) : 3;
+    if (G__.zstd_level < 1 || G__.zstd_level > 19)
+	G__.zstd_level = 3;
+
     initialized = 1;
 
     setlocale(LC_NUMERIC, "C");
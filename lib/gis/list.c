@@ -97,7 +97,6 @@ void G_list_element(const char *element,
 static int list_element(FILE *out, const char *element, const char *desc, const char *mapset,
 			int (*lister)(const char *, const char *, const char *))
 {
-    char path[GPATH_MAX];
     int count = 0;
     char **list;
     int i;
@@ -110,23 +109,13 @@ static int list_element(FILE *out, const char *element, const char *desc, const
 
 
     /*
-     * get the full name of the GIS directory within the mapset
-     * and list its contents (if it exists)
+     * list the contents of the GIS directory within the mapset
+     * (if it exists)
      *
-     * if lister() routine is given, the ls command must give 1 name
-     */
-    G_file_name(path, element, "", mapset);
-    if (access(path, 0) != 0) {
-	fprintf(out, "\n");
-	return count;
-    }
-
-    /*
      * if a title so that we can call lister() with the names
      * otherwise the ls must be forced into columnar form.
      */
-
-    list = G_ls2(path, &count);
+    list = G_ls_element(element, mapset, &count);
 
     if (count > 0) {
 	fprintf(out, _("%s files available in mapset <%s>:\n"), desc, mapset);
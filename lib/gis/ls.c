@@ -92,12 +92,21 @@ void G_set_ls_exclude_filter(ls_filter_func *func, void *closure)
  * \return          Pointer to array of strings containing the listing
  **/
 
+static int filter_name(const char *name)
+{
+    if (st->ls_filter && !(*st->ls_filter)(name, st->ls_closure))
+	return 0;
+    if (st->ls_ex_filter && (*st->ls_ex_filter)(name, st->ls_ex_closure))
+	return 0;
+    return 1;
+}
+
 char **G_ls2(const char *dir, int *num_files)
 {
     struct dirent *dp;
     DIR *dfd;
     char **dir_listing = NULL;
-    int n = 0;
+    int n = 0, alloc = 0;
 
     if ((dfd = opendir(dir)) == NULL)
 	G_fatal_error(_("Unable to open directory %s"), dir);
@@ -105,11 +114,12 @@ char **G_ls2(const char *dir, int *num_files)
     while ((dp = readdir(dfd)) != NULL) {
 	if (dp->d_name[0] == '.')	/* Don't list hidden files */
 	    continue;
-	if (st->ls_filter && !(*st->ls_filter)(dp->d_name, st->ls_closure))
+	if (!filter_name(dp->d_name))
 	    continue;
-	if (st->ls_ex_filter && (*st->ls_ex_filter)(dp->d_name, st->ls_ex_closure))
-	    continue;
-	dir_listing = (char **)G_realloc(dir_listing, (1 + n) * sizeof(char *));
+	if (n >= alloc) {
+	    alloc = alloc ? 2 * alloc : 64;
+	    dir_listing = (char **)G_realloc(dir_listing, alloc * sizeof(char *));
+	}
 	dir_listing[n] = G_store(dp->d_name);
 	n++;
     }
@@ -122,6 +132,48 @@ char **G_ls2(const char *dir, int *num_files)
     return dir_listing;
 }
 
+/**
+ * \brief Stores a sorted listing of a database element in an array
+ *
+ * Like G_ls2() for the directory of <i>element</i> in <i>mapset</i>,
+ * but the names are taken from the element index if it is enabled
+ * (see G_element_index()). The filters set with G_set_ls_filter() and
+ * G_set_ls_exclude_filter() are applied.
+ *
+ * \param element   Element name (e.g. "cell")
+ * \param mapset    Mapset name
+ * \param num_files Pointer to an integer in which the total number of
+ *                  files listed will be stored
+ *
+ * \return          Pointer to array of strings containing the listing,
+ *                  NULL if the element does not exist
+ **/
+
+char **G_ls_element(const char *element, const char *mapset, int *num_files)
+{
+    char path[GPATH_MAX];
+    char **names, **list;
+    int count, i, n;
+
+    names = G_element_index(element, mapset, &count);
+    if (count < 0) {
+	G_file_name(path, element, "", mapset);
+	if (access(path, 0) != 0) {
+	    *num_files = 0;
+	    return NULL;
+	}
+	return G_ls2(path, num_files);
+    }
+
+    list = count > 0 ? G_malloc(count * sizeof(char *)) : NULL;
+    for (i = n = 0; i < count; i++)
+	if (filter_name(names[i]))
+	    list[n++] = G_store(names[i]);
+
+    *num_files = n;
+    return list;
+}
+
 /**
  * \brief Prints a directory listing to a stream, in prettified column format
  * 
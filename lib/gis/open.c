@@ -116,6 +116,8 @@ static int G__open(const char *element,
             else
                 G_make_mapset_element(element);
 	    close(open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666));
+	    if (!is_tmp)
+		G_element_index_changed(element, mapset);
 	}
 
 	if ((fd = open(path, mode)) < 0)
@@ -13,6 +13,8 @@
   \author Luca Delucchi added Aug 2011 G_OPT_M_DIR
 */
 
+#include <stdlib.h>
+
 #include <grass/gis.h>
 #include <grass/glocale.h>
 
@@ -108,6 +110,7 @@
    - G_OPT_M_COLR
    - G_OPT_M_REGION
    - G_OPT_M_NULL_VALUE
+   - G_OPT_M_NPROCS
 
   - temporal GIS framework
    - G_OPT_STDS_INPUT
@@ -441,7 +444,7 @@ struct Option *G_define_standard_option(int opt)
         Opt->required = NO;
         Opt->multiple = NO;
         Opt->answer = "default";
-        Opt->options = "default,zip,none";
+        Opt->options = "default,zip,lz4,bzip2,zstd,none";
         Opt->description =
             _("The compression method used in the output raster3d map");
 	break;
@@ -737,6 +740,18 @@ struct Option *G_define_standard_option(int opt)
         Opt->description = _("Name of saved region");
         break;
 
+    case G_OPT_M_NPROCS:
+        Opt->key = "nprocs";
+        Opt->type = TYPE_INTEGER;
+        Opt->required = NO;
+        Opt->multiple = NO;
+        /* the default can be set for all modules */
+        Opt->answer = getenv("GRASS_NPROCS") ? getenv("GRASS_NPROCS") : "1";
+        Opt->label = _("Number of threads for parallel computing");
+        Opt->description = _("0: use all available cores, "
+                             "a negative value: all cores except that number");
+        break;
+
     /* Spatio-temporal modules of the temporal GIS framework */
     case G_OPT_STDS_INPUT:
 	Opt->key = "input";
@@ -0,0 +1,235 @@
+/*!
+ * \file lib/gis/perf.c
+ *
+ * \brief GIS Library - Performance counters and timers.
+ *
+ * Named counters and timers updated in the hot paths of the libraries,
+ * reported when the module exits if the environment variable
+ * GRASS_PERF_REPORT is set. Each call site caches the slot of its
+ * counter in a static int (initially 0), so when reporting is disabled
+ * an update costs a single comparison after the first call.
+ *
+ * \code
+ * static int rows_read;
+ *
+ * G_perf_count(&rows_read, "raster.rows_read", 1);
+ *
+ * static int expand;
+ * double t0 = G_perf_start();
+ * ...
+ * G_perf_stop(&expand, "raster.expand", t0);
+ * \endcode
+ *
+ * (C) 2019 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <grass/config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <grass/gis.h>
+
+#define MAX_PERF 64
+
+struct perf_slot
+{
+    char *name;
+    int timer;
+    long long value;		/* count, or microseconds of a timer */
+    long long calls;		/* timed calls */
+};
+
+static struct perf_slot slots[MAX_PERF + 1];	/* slot 0 unused */
+static int nslots;
+static int enabled = -1;	/* -1 until GRASS_PERF_REPORT is checked */
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t perf_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* counters may be updated by worker threads */
+#if defined(__GNUC__)
+#define PERF_ADD(p, n) __sync_fetch_and_add((p), (n))
+#elif defined(HAVE_PTHREAD_H)
+#define PERF_ADD(p, n) \
+    do { \
+	pthread_mutex_lock(&perf_mutex); \
+	*(p) += (n); \
+	pthread_mutex_unlock(&perf_mutex); \
+    } while (0)
+#else
+#define PERF_ADD(p, n) (*(p) += (n))
+#endif
+
+/*!
+ * \brief Check whether performance reporting is enabled
+ *
+ * \return 1 if GRASS_PERF_REPORT is set
+ * \return 0 otherwise
+ */
+int G_perf_enabled(void)
+{
+    const char *p;
+
+    if (enabled >= 0)
+	return enabled;
+
+    p = getenv("GRASS_PERF_REPORT");
+    enabled = p && *p && strcmp(p, "0") != 0;
+
+    return enabled;
+}
+
+/* slot of a counter or timer, -1 if disabled or out of slots */
+static int get_slot(int *id, const char *name, int timer)
+{
+    int i;
+
+    if (*id)
+	return *id;
+
+    if (!G_perf_enabled()) {
+	*id = -1;
+	return -1;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&perf_mutex);
+#endif
+
+    for (i = 1; i <= nslots; i++)
+	if (strcmp(slots[i].name, name) == 0)
+	    break;
+
+    if (i > nslots) {
+	if (nslots < MAX_PERF) {
+	    if (nslots == 0)
+		atexit(G_perf_report);
+	    i = ++nslots;
+	    slots[i].name = G_store(name);
+	    slots[i].timer = timer;
+	}
+	else
+	    i = -1;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&perf_mutex);
+#endif
+
+    *id = i;
+
+    return i;
+}
+
+/*!
+ * \brief Add to a performance counter
+ *
+ * \param id slot of the counter cached by the caller, initially 0
+ * \param name counter name, e.g. "raster.rows_read"
+ * \param n amount to add
+ */
+void G_perf_count(int *id, const char *name, long long n)
+{
+    int i = *id;
+
+    if (i < 0)
+	return;
+    if (i == 0 && (i = get_slot(id, name, 0)) < 0)
+	return;
+
+    PERF_ADD(&slots[i].value, n);
+}
+
+/*!
+ * \brief Start timing
+ *
+ * \return start time for G_perf_stop(), 0 if reporting is disabled
+ */
+double G_perf_start(void)
+{
+    struct timeval tv;
+
+    if (!enabled || (enabled < 0 && !G_perf_enabled()))
+	return 0;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/*!
+ * \brief Stop timing and add the elapsed time to a timer
+ *
+ * \param id slot of the timer cached by the caller, initially 0
+ * \param name timer name, e.g. "raster.expand"
+ * \param start time returned by G_perf_start()
+ */
+void G_perf_stop(int *id, const char *name, double start)
+{
+    struct timeval tv;
+    int i = *id;
+
+    if (i < 0 || start == 0)
+	return;
+    if (i == 0 && (i = get_slot(id, name, 1)) < 0)
+	return;
+
+    gettimeofday(&tv, NULL);
+
+    PERF_ADD(&slots[i].value,
+	     (long long)((tv.tv_sec + tv.tv_usec / 1e6 - start) * 1e6));
+    PERF_ADD(&slots[i].calls, 1);
+}
+
+/*!
+ * \brief Print the performance counters and timers
+ *
+ * Called automatically when the module exits. The report is written
+ * to stderr as a table, or as JSON if GRASS_PERF_REPORT is "json".
+ */
+void G_perf_report(void)
+{
+    const char *p = getenv("GRASS_PERF_REPORT");
+    const char *pgm = G_program_name();
+    int json = p && G_strcasecmp(p, "json") == 0;
+    int i, n;
+
+    if (!nslots)
+	return;
+
+    if (json) {
+	fprintf(stderr, "{\"module\": \"%s\", \"counters\": {",
+		pgm ? pgm : "");
+	for (i = 1, n = 0; i <= nslots; i++)
+	    if (!slots[i].timer)
+		fprintf(stderr, "%s\"%s\": %lld", n++ ? ", " : "",
+			slots[i].name, slots[i].value);
+	fprintf(stderr, "}, \"timers\": {");
+	for (i = 1, n = 0; i <= nslots; i++)
+	    if (slots[i].timer)
+		fprintf(stderr,
+			"%s\"%s\": {\"calls\": %lld, \"seconds\": %.6f}",
+			n++ ? ", " : "", slots[i].name, slots[i].calls,
+			slots[i].value / 1e6);
+	fprintf(stderr, "}}\n");
+	return;
+    }
+
+    fprintf(stderr, "Performance report of %s:\n", pgm ? pgm : "");
+    for (i = 1; i <= nslots; i++) {
+	if (slots[i].timer)
+	    fprintf(stderr, "  %-32s %14.6f s in %lld calls\n",
+		    slots[i].name, slots[i].value / 1e6, slots[i].calls);
+	else
+	    fprintf(stderr, "  %-32s %14lld\n", slots[i].name,
+		    slots[i].value);
+    }
+}
@@ -94,8 +94,11 @@ static int G__remove(int misc, const char *dir, const char *element,
     if (access(path, 0) != 0)
 	return 0;
 
-    if (G_recursive_remove(path) == 0)
+    if (G_recursive_remove(path) == 0) {
+	if (!misc)
+	    G_element_index_changed(element, mapset);
 	return 1;
+    }
 
     return -1;
 }
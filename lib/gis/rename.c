@@ -89,5 +89,9 @@ int G_rename(const char *element, const char *oldname, const char *newname)
     G_file_name(to, element, newname, mapset);
 
     /* return result of rename */
-    return G_rename_file(from, to) == 0 ? 1 : -1;
+    if (G_rename_file(from, to) != 0)
+	return -1;
+
+    G_element_index_changed(element, mapset);
+    return 1;
 }
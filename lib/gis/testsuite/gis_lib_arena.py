@@ -0,0 +1,59 @@
+"""Test of gis library region allocator
+
+@author GRASS Development Team
+"""
+
+import ctypes
+
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+import grass.lib.gis as libgis
+
+
+class ArenaTestCase(TestCase):
+    """Test C functions G_arena_*() from gis library"""
+
+    def setUp(self):
+        self.arena = libgis.G_arena_create(1024)
+
+    def tearDown(self):
+        libgis.G_arena_destroy(self.arena)
+
+    def test_alignment(self):
+        """Allocations are aligned for doubles"""
+        for size in (1, 3, 7, 24):
+            ptr = libgis.G_arena_alloc(self.arena, size)
+            address = ctypes.cast(ptr, ctypes.c_void_p).value
+            self.assertEqual(address % ctypes.sizeof(ctypes.c_double), 0)
+
+    def test_calloc(self):
+        """Memory from G_arena_calloc() is zeroed"""
+        ptr = libgis.G_arena_calloc(self.arena, 100, ctypes.sizeof(ctypes.c_int))
+        values = ctypes.cast(ptr, ctypes.POINTER(ctypes.c_int))
+        self.assertEqual(sum(values[i] for i in range(100)), 0)
+
+    def test_mark_release(self):
+        """Releasing a mark gives back what was allocated after it"""
+        libgis.G_arena_alloc(self.arena, 100)
+        used = libgis.G_arena_used(self.arena)
+        mark = libgis.struct_G_arena_mark()
+        libgis.G_arena_mark(self.arena, ctypes.byref(mark))
+        for i in range(100):
+            libgis.G_arena_alloc(self.arena, 64)
+        # larger than a block
+        libgis.G_arena_alloc(self.arena, 5000)
+        self.assertGreater(libgis.G_arena_used(self.arena), used + 5000)
+        libgis.G_arena_release(self.arena, ctypes.byref(mark))
+        self.assertEqual(libgis.G_arena_used(self.arena), used)
+
+    def test_reset(self):
+        """Nothing is in use after a reset"""
+        for i in range(50):
+            libgis.G_arena_alloc(self.arena, 100)
+        libgis.G_arena_reset(self.arena)
+        self.assertEqual(libgis.G_arena_used(self.arena), 0)
+
+
+if __name__ == '__main__':
+    test()
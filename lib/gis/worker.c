@@ -3,6 +3,14 @@
  *
  * \brief GIS Library - Worker functions.
  *
+ * A pool of worker threads shared by all users in a process. Each
+ * worker has its own deque of tasks: tasks submitted by a worker are
+ * pushed to and popped from the bottom of its deque, idle workers
+ * steal from the top of the deques of other workers. Tasks are
+ * collected in task groups which can be waited for; a thread waiting
+ * for a group executes pending tasks meanwhile, so tasks can submit
+ * and wait for subtasks.
+ *
  * (C) 2008-2014 by the GRASS Development Team
  *
  * This program is free software under the GNU General Public License
@@ -13,149 +21,477 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <grass/gis.h>
 #include <grass/glocale.h>
 
+#define DEFAULT_WORKERS 0
+
+/* number of workers requested by G_set_nprocs(), -1 if not set */
+static int requested_workers = -1;
+
+static int nprocs_limit(void)
+{
+    const char *p = getenv("GRASS_NPROCS");
+    int n = p ? atoi(p) : 0;
+
+    return n > 0 ? n : 0;
+}
+
+/* size of the pool: G_set_nprocs(), then WORKERS and GRASS_NPROCS */
+static int pool_size(void)
+{
+    const char *p = getenv("WORKERS");
+
+    if (requested_workers >= 0)
+	return requested_workers;
+    if (p)
+	return atoi(p) > 0 ? atoi(p) : 0;
+    if (nprocs_limit() > 0)
+	return nprocs_limit() - 1;
+
+    return DEFAULT_WORKERS;
+}
+
 #ifdef HAVE_PTHREAD_H
 
 /****************************************************************************/
 
 #include <pthread.h>
+#include <sched.h>
 
-#define DEFAULT_WORKERS 0
-
-struct worker {
+struct task {
     void (*func)(void *);
     void *closure;
-    void **ref;
-    pthread_t thread;
+    struct G_task_group *group;
+};
+
+struct G_task_group {
+    int pending;
+    pthread_mutex_t mutex;
     pthread_cond_t cond;
+};
+
+/* circular buffer of tasks, the owner works at the bottom */
+struct deque {
+    struct task **tasks;
+    int size;
+    int top;
+    int count;
     pthread_mutex_t mutex;
-    int cancel;
+};
+
+struct worker {
+    int index;
+    pthread_t thread;
 };
 
 static int num_workers;
+static int init_count;
+static int pool_running;
 static struct worker *workers;
+/* one deque per worker plus one for tasks of other threads */
+static struct deque *deques;
+static int num_deques;
+
+static int pending_tasks;
+static int active_tasks;	/* tasks being executed */
+static int cancel;
 static pthread_cond_t worker_cond;
 static pthread_mutex_t worker_mutex;
 
+static pthread_key_t self_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /****************************************************************************/
 
-static void *worker(void *arg)
+static void make_key(void)
 {
-    struct worker *w = arg;
+    pthread_key_create(&self_key, NULL);
+}
 
-    while (!w->cancel) {
-	pthread_mutex_lock(&w->mutex);
-	while (!w->func)
-	    pthread_cond_wait(&w->cond, &w->mutex);
+/* deque index of the calling thread */
+static int self_index(void)
+{
+    struct worker *w = pthread_getspecific(self_key);
 
-	(*w->func)(w->closure);
+    return w ? w->index : num_workers;
+}
 
-	w->func = NULL;
-	w->closure = NULL;
-	*w->ref = NULL;
-	pthread_mutex_unlock(&w->mutex);
-	pthread_cond_signal(&w->cond);
-	pthread_cond_signal(&worker_cond);
+static void push_bottom(struct deque *d, struct task *t)
+{
+    pthread_mutex_lock(&d->mutex);
+    if (d->count == d->size) {
+	int new_size = d->size ? d->size * 2 : 64;
+	struct task **tasks = G_malloc(new_size * sizeof(struct task *));
+	int i;
+
+	for (i = 0; i < d->count; i++)
+	    tasks[i] = d->tasks[(d->top + i) % d->size];
+	G_free(d->tasks);
+	d->tasks = tasks;
+	d->size = new_size;
+	d->top = 0;
     }
-
-    return NULL;
+    d->tasks[(d->top + d->count) % d->size] = t;
+    d->count++;
+    pthread_mutex_unlock(&d->mutex);
 }
 
-static struct worker *get_worker(void)
+static struct task *pop_bottom(struct deque *d)
 {
-    int i;
+    struct task *t = NULL;
 
-    for (i = 0; i < num_workers; i++) {
-	struct worker *w = &workers[i];
-	if (!w->func)
-	    return w;
+    pthread_mutex_lock(&d->mutex);
+    if (d->count > 0) {
+	d->count--;
+	t = d->tasks[(d->top + d->count) % d->size];
     }
+    pthread_mutex_unlock(&d->mutex);
 
-    return NULL;
+    return t;
 }
 
-void G_begin_execute(void (*func)(void *), void *closure, void **ref, int force)
+static struct task *steal_top(struct deque *d)
 {
-    struct worker *w;
- 
-    if (*ref)
-	G_fatal_error(_("Task already has a worker"));
+    struct task *t = NULL;
 
-    pthread_mutex_lock(&worker_mutex);
+    pthread_mutex_lock(&d->mutex);
+    if (d->count > 0) {
+	t = d->tasks[d->top];
+	d->top = (d->top + 1) % d->size;
+	d->count--;
+    }
+    pthread_mutex_unlock(&d->mutex);
 
-    while (w = get_worker(), force && num_workers > 0 && !w)
-	pthread_cond_wait(&worker_cond, &worker_mutex);
-    *ref = w;
+    return t;
+}
 
-    if (!w) {
+static struct task *take_task(int self)
+{
+    struct task *t = pop_bottom(&deques[self]);
+    int i;
+
+    for (i = 1; !t && i < num_deques; i++)
+	t = steal_top(&deques[(self + i) % num_deques]);
+
+    if (t) {
+	pthread_mutex_lock(&worker_mutex);
+	pending_tasks--;
+	active_tasks++;
 	pthread_mutex_unlock(&worker_mutex);
-	(*func)(closure);
-	return;
     }
 
-    pthread_mutex_lock(&w->mutex);
-    w->func = func;
-    w->closure = closure;
-    w->ref = ref;
-    pthread_cond_signal(&w->cond);
-    pthread_mutex_unlock(&w->mutex);
+    return t;
+}
+
+static void run_task(struct task *t)
+{
+    struct G_task_group *g = t->group;
 
+    (*t->func)(t->closure);
+    G_free(t);
+
+    pthread_mutex_lock(&worker_mutex);
+    active_tasks--;
     pthread_mutex_unlock(&worker_mutex);
+
+    pthread_mutex_lock(&g->mutex);
+    if (--g->pending == 0)
+	pthread_cond_broadcast(&g->cond);
+    pthread_mutex_unlock(&g->mutex);
 }
 
-void G_end_execute(void **ref)
+static void *worker(void *arg)
 {
-    struct worker *w = *ref;
+    struct worker *w = arg;
 
-    if (!w)
-	return;
+    pthread_setspecific(self_key, w);
 
-    pthread_mutex_lock(&w->mutex);
-    while (*ref)
-	pthread_cond_wait(&w->cond, &w->mutex);
-    pthread_mutex_unlock(&w->mutex);
+    for (;;) {
+	struct task *t;
+
+	pthread_mutex_lock(&worker_mutex);
+	while (!cancel && pending_tasks == 0)
+	    pthread_cond_wait(&worker_cond, &worker_mutex);
+	if (cancel) {
+	    pthread_mutex_unlock(&worker_mutex);
+	    break;
+	}
+	pthread_mutex_unlock(&worker_mutex);
+
+	t = take_task(w->index);
+	if (t)
+	    run_task(t);
+	else
+	    /* a task is being taken by another thread */
+	    sched_yield();
+    }
+
+    return NULL;
 }
 
-void G_init_workers(void)
+static void start_pool(void)
 {
-    const char *p = getenv("WORKERS");
     int i;
 
+    pthread_once(&key_once, make_key);
+
+    num_workers = pool_size();
+
     pthread_mutex_init(&worker_mutex, NULL);
     pthread_cond_init(&worker_cond, NULL);
+    pending_tasks = 0;
+    active_tasks = 0;
+    cancel = 0;
 
-    num_workers = p ? atoi(p) : DEFAULT_WORKERS;
-    workers = G_calloc(num_workers, sizeof(struct worker));
+    num_deques = num_workers + 1;
+    deques = G_calloc(num_deques, sizeof(struct deque));
+    for (i = 0; i < num_deques; i++)
+	pthread_mutex_init(&deques[i].mutex, NULL);
 
+    workers = G_calloc(num_workers, sizeof(struct worker));
     for (i = 0; i < num_workers; i++) {
 	struct worker *w = &workers[i];
-	pthread_mutex_init(&w->mutex, NULL);
-	pthread_cond_init(&w->cond, NULL);
+	w->index = i;
 	pthread_create(&w->thread, NULL, worker, w);
     }
+
+    pool_running = 1;
 }
 
-void G_finish_workers(void)
+static void stop_pool(void)
 {
     int i;
 
-    for (i = 0; i < num_workers; i++) {
-	struct worker *w = &workers[i];
-	w->cancel = 1;
-	pthread_cancel(w->thread);
-    }
+    pthread_mutex_lock(&worker_mutex);
+    cancel = 1;
+    pthread_cond_broadcast(&worker_cond);
+    pthread_mutex_unlock(&worker_mutex);
 
-    for (i = 0; i < num_workers; i++) {
-	struct worker *w = &workers[i];
-	pthread_join(w->thread, NULL);
-	pthread_mutex_destroy(&w->mutex);
-	pthread_cond_destroy(&w->cond);
+    for (i = 0; i < num_workers; i++)
+	pthread_join(workers[i].thread, NULL);
+
+    for (i = 0; i < num_deques; i++) {
+	pthread_mutex_destroy(&deques[i].mutex);
+	G_free(deques[i].tasks);
     }
 
     pthread_mutex_destroy(&worker_mutex);
     pthread_cond_destroy(&worker_cond);
+
+    G_free(deques);
+    G_free(workers);
+    deques = NULL;
+    workers = NULL;
+    num_deques = 0;
+    num_workers = 0;
+    pool_running = 0;
+}
+
+/* the pool is started on first use if G_init_workers() wasn't called */
+static void ensure_pool(void)
+{
+    if (pool_running)
+	return;
+
+    pthread_mutex_lock(&init_mutex);
+    if (!pool_running)
+	start_pool();
+    pthread_mutex_unlock(&init_mutex);
+}
+
+/****************************************************************************/
+
+/*!
+ * \brief Create a task group
+ *
+ * \return pointer to new task group
+ */
+struct G_task_group *G_task_group_create(void)
+{
+    struct G_task_group *g = G_malloc(sizeof(struct G_task_group));
+
+    ensure_pool();
+
+    g->pending = 0;
+    pthread_mutex_init(&g->mutex, NULL);
+    pthread_cond_init(&g->cond, NULL);
+
+    return g;
+}
+
+/*!
+ * \brief Submit a task to the worker pool
+ *
+ * The function <i>func</i> is called with <i>closure</i> by one of
+ * the workers or by a thread waiting for a task group. Without
+ * workers the task is executed immediately.
+ *
+ * \param g task group
+ * \param func task function
+ * \param closure argument of the task function
+ */
+void G_task_submit(struct G_task_group *g, void (*func)(void *), void *closure)
+{
+    struct task *t;
+
+    if (num_workers == 0) {
+	(*func)(closure);
+	return;
+    }
+
+    t = G_malloc(sizeof(struct task));
+    t->func = func;
+    t->closure = closure;
+    t->group = g;
+
+    pthread_mutex_lock(&g->mutex);
+    g->pending++;
+    pthread_mutex_unlock(&g->mutex);
+
+    push_bottom(&deques[self_index()], t);
+
+    pthread_mutex_lock(&worker_mutex);
+    pending_tasks++;
+    pthread_cond_signal(&worker_cond);
+    pthread_mutex_unlock(&worker_mutex);
+}
+
+/*!
+ * \brief Wait until all tasks of a task group are completed
+ *
+ * The calling thread executes pending tasks while waiting.
+ *
+ * \param g task group
+ */
+void G_task_group_wait(struct G_task_group *g)
+{
+    int self = self_index();
+
+    for (;;) {
+	struct task *t;
+
+	pthread_mutex_lock(&g->mutex);
+	if (g->pending == 0) {
+	    pthread_mutex_unlock(&g->mutex);
+	    return;
+	}
+	pthread_mutex_unlock(&g->mutex);
+
+	t = take_task(self);
+	if (t) {
+	    run_task(t);
+	    continue;
+	}
+
+	/* the remaining tasks are being executed by other threads */
+	pthread_mutex_lock(&g->mutex);
+	if (g->pending > 0)
+	    pthread_cond_wait(&g->cond, &g->mutex);
+	pthread_mutex_unlock(&g->mutex);
+    }
+}
+
+/*!
+ * \brief Wait for and destroy a task group
+ *
+ * \param g task group
+ */
+void G_task_group_destroy(struct G_task_group *g)
+{
+    G_task_group_wait(g);
+
+    pthread_mutex_destroy(&g->mutex);
+    pthread_cond_destroy(&g->cond);
+    G_free(g);
+}
+
+/*!
+ * \brief Get the number of worker threads
+ *
+ * \return number of workers, 0 if tasks are executed by the caller
+ */
+int G_num_workers(void)
+{
+    ensure_pool();
+
+    return num_workers;
+}
+
+/****************************************************************************/
+
+void G_begin_execute(void (*func)(void *), void *closure, void **ref, int force)
+{
+    struct G_task_group *g;
+
+    if (*ref)
+	G_fatal_error(_("Task already has a worker"));
+
+    ensure_pool();
+
+    if (num_workers == 0) {
+	(*func)(closure);
+	return;
+    }
+
+    /* the task is queued in any case, force is kept for compatibility */
+    g = G_task_group_create();
+    G_task_submit(g, func, closure);
+    *ref = g;
+}
+
+void G_end_execute(void **ref)
+{
+    struct G_task_group *g = *ref;
+
+    if (!g)
+	return;
+
+    G_task_group_destroy(g);
+    *ref = NULL;
+}
+
+void G_init_workers(void)
+{
+    /* the worker pool is shared by all users (e.g. r.mapcalc and the
+       raster read-ahead), only the first call creates it */
+    pthread_mutex_lock(&init_mutex);
+    if (init_count++ == 0 && !pool_running)
+	start_pool();
+    pthread_mutex_unlock(&init_mutex);
+}
+
+void G_finish_workers(void)
+{
+    pthread_mutex_lock(&init_mutex);
+    if (init_count > 0 && --init_count == 0 && pool_running)
+	stop_pool();
+    pthread_mutex_unlock(&init_mutex);
+}
+
+/* the pool is only restarted while no task is queued or executed (e.g.
+ * by the read-ahead of a map already open); new tasks must not be
+ * submitted by other threads meanwhile */
+static void resize_pool(void)
+{
+    pthread_mutex_lock(&init_mutex);
+    if (pool_running && num_workers != requested_workers) {
+	int busy;
+
+	pthread_mutex_lock(&worker_mutex);
+	busy = pending_tasks + active_tasks;
+	pthread_mutex_unlock(&worker_mutex);
+
+	if (busy > 0)
+	    G_debug(1, "Worker pool busy, keeping %d workers", num_workers);
+	else {
+	    stop_pool();
+	    start_pool();
+	}
+    }
+    pthread_mutex_unlock(&init_mutex);
 }
 
 /****************************************************************************/
@@ -164,6 +500,35 @@ void G_finish_workers(void)
 
 /****************************************************************************/
 
+/* without threads, tasks are executed immediately by the caller */
+struct G_task_group {
+    int dummy;
+};
+
+struct G_task_group *G_task_group_create(void)
+{
+    return G_malloc(sizeof(struct G_task_group));
+}
+
+void G_task_submit(struct G_task_group *g, void (*func)(void *), void *closure)
+{
+    (*func)(closure);
+}
+
+void G_task_group_wait(struct G_task_group *g)
+{
+}
+
+void G_task_group_destroy(struct G_task_group *g)
+{
+    G_free(g);
+}
+
+int G_num_workers(void)
+{
+    return 0;
+}
+
 void G_begin_execute(void (*func)(void *), void *closure, void **ref, int force)
 {
     (*func)(closure);
@@ -181,7 +546,141 @@ void G_finish_workers(void)
 {
 }
 
+static void resize_pool(void)
+{
+}
+
 /****************************************************************************/
 
 #endif
 
+/*!
+ * \brief Get the number of processors available
+ *
+ * \return number of online processors, at least 1
+ */
+int G_num_procs(void)
+{
+    long n = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return n > 0 ? (int)n : 1;
+}
+
+/*!
+ * \brief Set the number of threads from a standard nprocs option
+ *
+ * Interprets the answer of a G_OPT_M_NPROCS option: 0 means all
+ * available cores, a negative value all cores except that number.
+ * The result is limited by the environment variable GRASS_NPROCS and
+ * sets the size of the libgis worker pool (the calling thread counts
+ * as one of the threads); a running pool is only resized while it has
+ * no queued or executing tasks. The value can also be passed to
+ * omp_set_num_threads() by modules using OpenMP.
+ *
+ * \param opt nprocs option
+ *
+ * \return number of threads to be used, at least 1
+ */
+int G_set_nprocs(const struct Option *opt)
+{
+    int ncpus = G_num_procs();
+    int limit = nprocs_limit();
+    int n = 1;
+
+    if (opt && opt->answer)
+	n = atoi(opt->answer);
+
+    if (n <= 0)
+	n += ncpus;
+    if (n < 1) {
+	G_warning(_("<%s=%s> leaves no processor to use, using 1 thread"),
+		  opt->key, opt->answer);
+	n = 1;
+    }
+    if (limit > 0 && n > limit) {
+	G_verbose_message(_("Number of threads limited to %d by GRASS_NPROCS"),
+			  limit);
+	n = limit;
+    }
+
+    requested_workers = n - 1;
+    resize_pool();
+
+    G_debug(1, "G_set_nprocs(): %d threads", n);
+
+    return n;
+}
+
+/****************************************************************************/
+
+struct range_task {
+    void (*func)(int, int, void *);
+    void *closure;
+    int first, last;
+};
+
+static void run_range(void *p)
+{
+    struct range_task *r = p;
+
+    (*r->func)(r->first, r->last, r->closure);
+}
+
+/*!
+ * \brief Execute a function for ranges of an index in parallel
+ *
+ * The range [<i>start</i>, <i>end</i>) (typically rows) is split
+ * into chunks of <i>chunk</i> elements, <i>func</i> is called for
+ * each chunk with its first and last (exclusive) index. With
+ * <i>chunk</i> &lt;= 0 a chunk size is chosen from the number of
+ * workers. Returns when all chunks are processed.
+ *
+ * \param start first index
+ * \param end index after the last one
+ * \param chunk number of indices per call
+ * \param func function called for each chunk
+ * \param closure argument passed to func
+ */
+void G_parallel_for(int start, int end, int chunk,
+		    void (*func)(int, int, void *), void *closure)
+{
+    struct G_task_group *g;
+    struct range_task *ranges;
+    int nchunks, i;
+
+    if (end <= start)
+	return;
+
+    if (chunk <= 0) {
+	/* a few chunks per thread for load balancing */
+	int nthreads = G_num_workers() + 1;
+
+	chunk = (end - start + 4 * nthreads - 1) / (4 * nthreads);
+    }
+
+    nchunks = (end - start + chunk - 1) / chunk;
+    if (nchunks == 1 || G_num_workers() == 0) {
+	(*func)(start, end, closure);
+	return;
+    }
+
+    ranges = G_malloc(nchunks * sizeof(struct range_task));
+    g = G_task_group_create();
+
+    for (i = 0; i < nchunks; i++) {
+	struct range_task *r = &ranges[i];
+
+	r->func = func;
+	r->closure = closure;
+	r->first = start + i * chunk;
+	r->last = r->first + chunk < end ? r->first + chunk : end;
+	G_task_submit(g, run_range, r);
+    }
+
+    G_task_group_destroy(g);
+    G_free(ranges);
+}
@@ -148,4 +148,206 @@ int fft(int i_sign, double *DATA[2], int NN, int dimc, int dimr)
     return 0;
 }
 
+/**
+ * \fn int G_math_fft_threads(int nthreads)
+ *
+ * \brief Set the number of threads of the Fourier transforms.
+ *
+ * The number of threads is used by all transforms planned afterwards.
+ * Threads are only available if GRASS is built with the FFTW3 threads
+ * library.
+ *
+ * \param[in] nthreads number of threads
+ * \return int number of threads used
+ */
+
+int G_math_fft_threads(int nthreads)
+{
+#ifdef HAVE_FFTW3_THREADS
+    static int initialized = 0;
+
+    if (!initialized) {
+	if (!fftw_init_threads())
+	    return 1;
+	initialized = 1;
+    }
+    if (nthreads < 1)
+	nthreads = 1;
+    fftw_plan_with_nthreads(nthreads);
+
+    return nthreads;
+#else
+    return 1;
+#endif
+}
+
+#ifdef HAVE_FFTW3_H
+
+/**
+ * \fn int G_math_fft2_r2c(double (*data)[2], int dimc, int dimr)
+ *
+ * \brief Forward Fast Fourier Transform of a real two-dimensional array.
+ *
+ * The transform is done in place. On input the rows of the real array
+ * are stored in data with a row length of 2 * (dimc / 2 + 1) doubles.
+ * On output data holds the dimc / 2 + 1 non-redundant complex columns
+ * of each row, the other columns are given by the Hermitian symmetry
+ * F[r][c] = conj(F[(dimr - r) % dimr][dimc - c]). The result is
+ * normalized like the result of fft2(). Only available with FFTW3.
+ *
+ * \param[in,out] data Pointer to the padded real input and complex result
+ * \param[in] dimc Value of image column dimension
+ * \param[in] dimr Value of image row dimension
+ * \return int always returns 0
+ */
+
+int G_math_fft2_r2c(double (*data)[2], int dimc, int dimr)
+{
+    fftw_plan plan;
+    double norm;
+    size_t i, n;
+
+    norm = 1.0 / sqrt((double)dimc * dimr);
+    n = (size_t)dimr * (dimc / 2 + 1);
+
+    plan = fftw_plan_dft_r2c_2d(dimr, dimc, (double *)data, data,
+				FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+
+    for (i = 0; i < n; i++) {
+	data[i][0] *= norm;
+	data[i][1] *= norm;
+    }
+
+    return 0;
+}
+
+/**
+ * \fn int G_math_fft2_c2r(double (*data)[2], int dimc, int dimr)
+ *
+ * \brief Inverse Fast Fourier Transform of a Hermitian two-dimensional
+ * array.
+ *
+ * The inverse of G_math_fft2_r2c(): data holds the dimc / 2 + 1
+ * non-redundant complex columns of each row, on output the rows of the
+ * real result are stored with a row length of 2 * (dimc / 2 + 1)
+ * doubles. The result is normalized like the result of fft2(). Only
+ * available with FFTW3.
+ *
+ * \param[in,out] data Pointer to the complex input and padded real result
+ * \param[in] dimc Value of image column dimension
+ * \param[in] dimr Value of image row dimension
+ * \return int always returns 0
+ */
+
+int G_math_fft2_c2r(double (*data)[2], int dimc, int dimr)
+{
+    fftw_plan plan;
+    double norm, *out;
+    int i, j;
+
+    norm = 1.0 / sqrt((double)dimc * dimr);
+
+    plan = fftw_plan_dft_c2r_2d(dimr, dimc, data, (double *)data,
+				FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+
+    for (i = 0; i < dimr; i++) {
+	out = (double *)data + (size_t)i * 2 * (dimc / 2 + 1);
+	for (j = 0; j < dimc; j++)
+	    out[j] *= norm;
+    }
+
+    return 0;
+}
+
+/**
+ * \fn int G_math_fft_rows(int i_sign, double (*data)[2], int n, int howmany)
+ *
+ * \brief One-dimensional Fast Fourier Transforms of contiguous rows.
+ *
+ * Transforms howmany consecutive complex sequences of length n in place.
+ * The result is not normalized. Only available with FFTW3.
+ *
+ * \param[in] i_sign Direction of transform -1 is normal, +1 is inverse
+ * \param[in,out] data Pointer to the complex sequences
+ * \param[in] n Length of the sequences
+ * \param[in] howmany Number of sequences
+ * \return int always returns 0
+ */
+
+int G_math_fft_rows(int i_sign, double (*data)[2], int n, int howmany)
+{
+    fftw_plan plan;
+
+    plan = fftw_plan_many_dft(1, &n, howmany, data, NULL, 1, n,
+			      data, NULL, 1, n,
+			      (i_sign < 0) ? FFTW_FORWARD : FFTW_BACKWARD,
+			      FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+
+    return 0;
+}
+
+/**
+ * \fn int G_math_fft_rows_r2c(double (*data)[2], int n, int howmany)
+ *
+ * \brief One-dimensional forward Fast Fourier Transforms of real rows.
+ *
+ * Transforms howmany real sequences of length n in place, with the
+ * layout of G_math_fft2_r2c(). The result is not normalized. Only
+ * available with FFTW3.
+ *
+ * \param[in,out] data Pointer to the padded real input and complex result
+ * \param[in] n Length of the sequences
+ * \param[in] howmany Number of sequences
+ * \return int always returns 0
+ */
+
+int G_math_fft_rows_r2c(double (*data)[2], int n, int howmany)
+{
+    fftw_plan plan;
+
+    plan = fftw_plan_many_dft_r2c(1, &n, howmany,
+				  (double *)data, NULL, 1, 2 * (n / 2 + 1),
+				  data, NULL, 1, n / 2 + 1, FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+
+    return 0;
+}
+
+/**
+ * \fn int G_math_fft_rows_c2r(double (*data)[2], int n, int howmany)
+ *
+ * \brief One-dimensional inverse Fast Fourier Transforms of Hermitian rows.
+ *
+ * The inverse of G_math_fft_rows_r2c(). The result is not normalized.
+ * Only available with FFTW3.
+ *
+ * \param[in,out] data Pointer to the complex input and padded real result
+ * \param[in] n Length of the sequences
+ * \param[in] howmany Number of sequences
+ * \return int always returns 0
+ */
+
+int G_math_fft_rows_c2r(double (*data)[2], int n, int howmany)
+{
+    fftw_plan plan;
+
+    plan = fftw_plan_many_dft_c2r(1, &n, howmany,
+				  data, NULL, 1, n / 2 + 1,
+				  (double *)data, NULL, 1, 2 * (n / 2 + 1),
+				  FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+
+    return 0;
+}
+
+#endif /* HAVE_FFTW3_H */
+
 #endif /* HAVE_FFT */
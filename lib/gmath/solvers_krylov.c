@@ -31,6 +31,8 @@ static int solver_pcg(double **A, G_math_spvector ** Asp, double *x,
 		      double *b, int rows, int maxit, double err, int prec, int has_band, int bandwidth);
 static int solver_cg(double **A, G_math_spvector ** Asp, double *x, double *b,
 		     int rows, int maxit, double err, int has_band, int bandwidth);
+static void precondition(G_math_spvector ** M, G_math_csr * L, double *r,
+			 double *z, int rows);
 static int solver_bicgstab(double **A, G_math_spvector ** Asp, double *x,
 			   double *b, int rows, int maxit, double err);
 
@@ -115,7 +117,7 @@ int G_math_solver_pcg_sband(double **A, double *x, double *b, int rows, int band
  * \param rows (int)
  * \param maxit (int) -- the maximum number of iterations
  * \param err (double) -- defines the error break criteria
- * \param prec (int) -- the preconditioner which should be used 1,2 or 3
+ * \param prec (int) -- the preconditioner which should be used 1,2,3 or 5 (G_MATH_ICHOL_PRECONDITION)
  * \return (int) -- 1 - success, 2 - not finished but success, 0 - matrix singular, -1 - could not solve the les
  * 
  * */
@@ -145,7 +147,9 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
 
     int error_break;
 
-    G_math_spvector **M;
+    G_math_spvector **M = NULL;
+
+    G_math_csr *Acsr = NULL, *L = NULL;
 
     r = G_alloc_vector(rows);
     p = G_alloc_vector(rows);
@@ -154,8 +158,25 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
 
     error_break = 0;
 
-    /*compute the preconditioning matrix, this is a sparse matrix */
-    M = create_diag_precond_matrix(A, Asp, rows, prec);
+    if (Asp)
+	Acsr = G_math_Asp_to_csr(Asp, rows);
+
+    /*compute the preconditioning matrix, the incomplete Cholesky factor
+     * or a sparse diagonal matrix */
+    if (prec == G_MATH_ICHOL_PRECONDITION && !has_band) {
+	if (Acsr)
+	    L = G_math_csr_ichol(Acsr);
+	else {
+	    G_math_csr *Atmp = G_math_A_to_csr(A, rows);
+
+	    L = G_math_csr_ichol(Atmp);
+	    G_math_free_csr(Atmp);
+	}
+	if (!L)
+	    G_warning(_("Incomplete Cholesky factorization failed, using the diagonal preconditioner"));
+    }
+    if (!L)
+	M = create_diag_precond_matrix(A, Asp, rows, prec);
 
     /*
      * residual calculation 
@@ -163,7 +184,7 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
 #pragma omp parallel
     {
 	if (Asp)
-	    G_math_Ax_sparse(Asp, x, v, rows);
+	    G_math_Ax_csr(Acsr, x, v);
 	else if(has_band)
 	    G_math_Ax_sband(A, x, v, rows, bandwidth);
 	else
@@ -171,7 +192,7 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
 
 	G_math_d_ax_by(b, v, r, 1.0, -1.0, rows);
 	/*performe the preconditioning */
-	G_math_Ax_sparse(M, r, p, rows);
+	precondition(M, L, r, p, rows);
 
 	/* scalar product */
 #pragma omp for schedule (static) private(i) reduction(+:s)
@@ -190,7 +211,7 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
 #pragma omp parallel default(shared)
 	{
 	    if (Asp)
-		G_math_Ax_sparse(Asp, p, v, rows);
+		G_math_Ax_csr(Acsr, p, v);
 	    else if(has_band)
 		G_math_Ax_sband(A, p, v, rows, bandwidth);
 	    else
@@ -216,7 +237,7 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
 
 	    if (m % 50 == 1) {
 		if (Asp)
-		    G_math_Ax_sparse(Asp, x, v, rows);
+		    G_math_Ax_csr(Acsr, x, v);
 		else if(has_band)
 		    G_math_Ax_sband(A, x, v, rows, bandwidth);
 		else
@@ -229,7 +250,7 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
 	    }
 
 	    /*performe the preconditioning */
-	    G_math_Ax_sparse(M, r, z, rows);
+	    precondition(M, L, r, z, rows);
 
 
 	    /* scalar product */
@@ -259,9 +280,9 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
 	}
 
 	if (Asp != NULL)
-	    G_message(_("Sparse PCG -- iteration %i error  %g\n"), m, a0);
+	    G_verbose_message(_("Sparse PCG -- iteration %i error  %g\n"), m, a0);
 	else
-	    G_message(_("PCG -- iteration %i error  %g\n"), m, a0);
+	    G_verbose_message(_("PCG -- iteration %i error  %g\n"), m, a0);
 
 	if (error_break == 1) {
 	    finished = -1;
@@ -279,7 +300,10 @@ int solver_pcg(double **A, G_math_spvector ** Asp, double *x, double *b,
     G_free(p);
     G_free(v);
     G_free(z);
-    G_math_free_spmatrix(M, rows);
+    if (M)
+	G_math_free_spmatrix(M, rows);
+    G_math_free_csr(L);
+    G_math_free_csr(Acsr);
 
     return finished;
 }
@@ -387,18 +411,23 @@ int solver_cg(double **A, G_math_spvector ** Asp, double *x, double *b,
 
     int error_break;
 
+    G_math_csr *Acsr = NULL;
+
     r = G_alloc_vector(rows);
     p = G_alloc_vector(rows);
     v = G_alloc_vector(rows);
 
     error_break = 0;
+
+    if (Asp)
+	Acsr = G_math_Asp_to_csr(Asp, rows);
     /*
      * residual calculation 
      */
 #pragma omp parallel
     {
 	if (Asp)
-	    G_math_Ax_sparse(Asp, x, v, rows);
+	    G_math_Ax_csr(Acsr, x, v);
 	else if(has_band)
 	    G_math_Ax_sband(A, x, v, rows, bandwidth);
 	else
@@ -424,7 +453,7 @@ int solver_cg(double **A, G_math_spvector ** Asp, double *x, double *b,
 #pragma omp parallel default(shared)
 	{
 	    if (Asp)
-		G_math_Ax_sparse(Asp, p, v, rows);
+		G_math_Ax_csr(Acsr, p, v);
 	    else if(has_band)
 		G_math_Ax_sband(A, p, v, rows, bandwidth);
 	    else
@@ -448,7 +477,7 @@ int solver_cg(double **A, G_math_spvector ** Asp, double *x, double *b,
 
 	    if (m % 50 == 1) {
 		if (Asp)
-		    G_math_Ax_sparse(Asp, x, v, rows);
+		    G_math_Ax_csr(Acsr, x, v);
 		else if(has_band)
 		    G_math_Ax_sband(A, x, v, rows, bandwidth);
 		else
@@ -487,9 +516,9 @@ int solver_cg(double **A, G_math_spvector ** Asp, double *x, double *b,
 	}
 
 	if (Asp != NULL)
-	    G_message(_("Sparse CG -- iteration %i error  %g\n"), m, a0);
+	    G_verbose_message(_("Sparse CG -- iteration %i error  %g\n"), m, a0);
 	else
-	    G_message(_("CG -- iteration %i error  %g\n"), m, a0);
+	    G_verbose_message(_("CG -- iteration %i error  %g\n"), m, a0);
 
 	if (error_break == 1) {
 	    finished = -1;
@@ -505,6 +534,7 @@ int solver_cg(double **A, G_math_spvector ** Asp, double *x, double *b,
     G_free(r);
     G_free(p);
     G_free(v);
+    G_math_free_csr(Acsr);
 
     return finished;
 }
@@ -591,6 +621,8 @@ int solver_bicgstab(double **A, G_math_spvector ** Asp, double *x, double *b,
 
     int error_break;
 
+    G_math_csr *Acsr = NULL;
+
     r = G_alloc_vector(rows);
     r0 = G_alloc_vector(rows);
     p = G_alloc_vector(rows);
@@ -600,10 +632,13 @@ int solver_bicgstab(double **A, G_math_spvector ** Asp, double *x, double *b,
 
     error_break = 0;
 
+    if (Asp)
+	Acsr = G_math_Asp_to_csr(Asp, rows);
+
 #pragma omp parallel
     {
 	if (Asp)
-	    G_math_Ax_sparse(Asp, x, v, rows);
+	    G_math_Ax_csr(Acsr, x, v);
 	else
 	    G_math_d_Ax(A, x, v, rows, rows);
 
@@ -622,7 +657,7 @@ int solver_bicgstab(double **A, G_math_spvector ** Asp, double *x, double *b,
 #pragma omp parallel default(shared)
 	{
 	    if (Asp)
-		G_math_Ax_sparse(Asp, p, v, rows);
+		G_math_Ax_csr(Acsr, p, v);
 	    else
 		G_math_d_Ax(A, p, v, rows, rows);
 
@@ -654,7 +689,7 @@ int solver_bicgstab(double **A, G_math_spvector ** Asp, double *x, double *b,
 
 	    G_math_d_ax_by(r, v, s, 1.0, -1.0 * alpha, rows);
 	    if (Asp)
-		G_math_Ax_sparse(Asp, s, t, rows);
+		G_math_Ax_csr(Acsr, s, t);
 	    else
 		G_math_d_Ax(A, s, t, rows, rows);
 
@@ -692,10 +727,10 @@ int solver_bicgstab(double **A, G_math_spvector ** Asp, double *x, double *b,
 
 
 	if (Asp != NULL)
-	    G_message(_("Sparse BiCGStab -- iteration %i error  %g\n"), m,
+	    G_verbose_message(_("Sparse BiCGStab -- iteration %i error  %g\n"), m,
 		      error);
 	else
-	    G_message(_("BiCGStab -- iteration %i error  %g\n"), m, error);
+	    G_verbose_message(_("BiCGStab -- iteration %i error  %g\n"), m, error);
 
 	if (error_break == 1) {
 	    finished = -1;
@@ -714,11 +749,25 @@ int solver_bicgstab(double **A, G_math_spvector ** Asp, double *x, double *b,
     G_free(v);
     G_free(s);
     G_free(t);
+    G_math_free_csr(Acsr);
 
     return finished;
 }
 
 
+/* apply the preconditioner within a parallel region, z = M r */
+void precondition(G_math_spvector ** M, G_math_csr * L, double *r, double *z,
+		  int rows)
+{
+    if (L) {
+#pragma omp single
+	G_math_csr_ichol_solve(L, r, z);
+    }
+    else
+	G_math_Ax_sparse(M, r, z, rows);
+}
+
+
 /*!
  * \brief Compute a diagonal preconditioning matrix for krylov space solver
  *
@@ -0,0 +1,455 @@
+/*****************************************************************************
+*
+* MODULE:       Grass numerical math interface
+* AUTHOR(S):    GRASS Development Team
+*
+* PURPOSE:      multigrid preconditioned conjugate gradients solver
+* 		part of the gmath library
+*
+* COPYRIGHT:    (C) 2020 by the GRASS Development Team
+*
+*               This program is free software under the GNU General Public
+*               License (>=v2). Read the file COPYING that comes with GRASS
+*               for details.
+*
+*****************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/gmath.h>
+#include <grass/glocale.h>
+
+#define MG_MAX_LEVELS 25	/* maximum number of grid levels */
+#define MG_COARSE_ROWS 400	/* rows of the directly solved level */
+#define MG_SMOOTH_STEPS 2	/* pre- and post-smoothing steps */
+#define MG_JACOBI_WEIGHT 0.6	/* weight of the Jacobi smoother */
+
+/* one level of the grid hierarchy */
+struct mg_level
+{
+    G_math_csr *A;		/* the matrix of the level */
+    double *dinv;		/* weighted inverse of the diagonal */
+    int rows;
+    int coarse_rows;		/* rows of the next coarser level */
+    int *agg;			/* coarse row of each row */
+    int *member_ptr;		/* rows of each coarse row in member */
+    int *member;
+    double *r, *z, *t;		/* right hand side, correction, temporary */
+};
+
+struct mg_hierarchy
+{
+    int levels;
+    struct mg_level level[MG_MAX_LEVELS];
+    double **Ac;		/* Cholesky factor of the coarsest level */
+};
+
+/* group the rows into aggregates of neighbouring rows, returns the
+   number of aggregates */
+static int aggregate(G_math_csr * A, int *agg)
+{
+    int i, j, k, n = 0;
+
+    for (i = 0; i < A->rows; i++)
+	agg[i] = -1;
+
+    /* aggregates of rows with all neighbours free */
+    for (i = 0; i < A->rows; i++) {
+	int free_row = 1;
+
+	if (agg[i] >= 0)
+	    continue;
+	for (j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+	    if (agg[A->index[j]] >= 0) {
+		free_row = 0;
+		break;
+	    }
+	if (!free_row)
+	    continue;
+	for (j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+	    agg[A->index[j]] = n;
+	agg[i] = n++;
+    }
+
+    /* the left rows join the aggregate of the strongest neighbour */
+    for (i = 0; i < A->rows; i++) {
+	double max = 0;
+
+	if (agg[i] >= 0)
+	    continue;
+	k = -1;
+	for (j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) {
+	    int col = A->index[j];
+
+	    if (col != i && agg[col] >= 0 && fabs(A->values[j]) > max) {
+		max = fabs(A->values[j]);
+		k = agg[col];
+	    }
+	}
+	agg[i] = k >= 0 ? k : n++;
+    }
+
+    return n;
+}
+
+/* compute the coarse matrix P^T A P of piecewise constant prolongation */
+static G_math_csr *galerkin(struct mg_level *l)
+{
+    G_math_csr *A = l->A, *Ac;
+    int I, i, j, k, nnz;
+    int *pos;
+
+    l->member_ptr = G_calloc(l->coarse_rows + 1, sizeof(int));
+    l->member = G_malloc(l->rows * sizeof(int));
+    for (i = 0; i < l->rows; i++)
+	l->member_ptr[l->agg[i] + 1]++;
+    for (I = 0; I < l->coarse_rows; I++)
+	l->member_ptr[I + 1] += l->member_ptr[I];
+    pos = G_malloc(l->coarse_rows * sizeof(int));
+    memcpy(pos, l->member_ptr, l->coarse_rows * sizeof(int));
+    for (i = 0; i < l->rows; i++)
+	l->member[pos[l->agg[i]]++] = i;
+
+    /* the coarse matrix has not more entries than the fine one */
+    Ac = G_math_alloc_csr(l->coarse_rows, A->nnz);
+    for (I = 0; I < l->coarse_rows; I++)
+	pos[I] = -1;
+    nnz = 0;
+    for (I = 0; I < l->coarse_rows; I++) {
+	int start = nnz;
+
+	for (k = l->member_ptr[I]; k < l->member_ptr[I + 1]; k++) {
+	    i = l->member[k];
+	    for (j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) {
+		int J = l->agg[A->index[j]];
+
+		if (pos[J] < start) {
+		    pos[J] = nnz;
+		    Ac->index[nnz] = J;
+		    Ac->values[nnz] = 0;
+		    nnz++;
+		}
+		Ac->values[pos[J]] += A->values[j];
+	    }
+	}
+	Ac->row_ptr[I + 1] = nnz;
+    }
+    G_free(pos);
+
+    Ac->nnz = nnz;
+    Ac->index = G_realloc(Ac->index, (nnz > 0 ? nnz : 1) *
+			  sizeof(unsigned int));
+    Ac->values = G_realloc(Ac->values, (nnz > 0 ? nnz : 1) *
+			   sizeof(double));
+
+    return Ac;
+}
+
+static void init_level(struct mg_level *l, G_math_csr * A)
+{
+    int i, j;
+
+    l->A = A;
+    l->rows = A->rows;
+    l->coarse_rows = 0;
+    l->agg = NULL;
+    l->member_ptr = l->member = NULL;
+    l->dinv = G_alloc_vector(l->rows);
+    l->r = G_alloc_vector(l->rows);
+    l->z = G_alloc_vector(l->rows);
+    l->t = G_alloc_vector(l->rows);
+
+    for (i = 0; i < l->rows; i++)
+	for (j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+	    if (A->index[j] == i && A->values[j] != 0)
+		l->dinv[i] = MG_JACOBI_WEIGHT / A->values[j];
+}
+
+/* set up the levels of the hierarchy, the matrix of the first level
+   is owned by the caller */
+static struct mg_hierarchy *create_hierarchy(G_math_csr * A)
+{
+    struct mg_hierarchy *h;
+    struct mg_level *l;
+    int i, j;
+
+    h = G_calloc(1, sizeof(struct mg_hierarchy));
+    init_level(&h->level[0], A);
+    h->levels = 1;
+
+    while (h->levels < MG_MAX_LEVELS) {
+	l = &h->level[h->levels - 1];
+	if (l->rows <= MG_COARSE_ROWS)
+	    break;
+	l->agg = G_malloc(l->rows * sizeof(int));
+	l->coarse_rows = aggregate(l->A, l->agg);
+	if (l->coarse_rows * 10 > l->rows * 9) {
+	    /* no sufficient coarsening */
+	    G_free(l->agg);
+	    l->agg = NULL;
+	    l->coarse_rows = 0;
+	    break;
+	}
+	init_level(&h->level[h->levels], galerkin(l));
+	G_debug(3, "create_hierarchy(): level %i with %i rows", h->levels,
+		h->level[h->levels].rows);
+	h->levels++;
+    }
+
+    /* the coarsest level is solved by Cholesky decomposition */
+    l = &h->level[h->levels - 1];
+    if (l->rows <= MG_COARSE_ROWS) {
+	h->Ac = G_alloc_matrix(l->rows, l->rows);
+	for (i = 0; i < l->rows; i++)
+	    for (j = l->A->row_ptr[i]; j < l->A->row_ptr[i + 1]; j++)
+		h->Ac[i][l->A->index[j]] = l->A->values[j];
+	if (G_math_cholesky_decomposition(h->Ac, l->rows, 0) != 1) {
+	    G_free_matrix(h->Ac);
+	    h->Ac = NULL;
+	}
+    }
+
+    return h;
+}
+
+static void free_hierarchy(struct mg_hierarchy *h)
+{
+    int k;
+
+    for (k = 0; k < h->levels; k++) {
+	struct mg_level *l = &h->level[k];
+
+	if (k > 0)
+	    G_math_free_csr(l->A);
+	G_free(l->dinv);
+	G_free(l->r);
+	G_free(l->z);
+	G_free(l->t);
+	if (l->agg) {
+	    G_free(l->agg);
+	    G_free(l->member_ptr);
+	    G_free(l->member);
+	}
+    }
+    if (h->Ac)
+	G_free_matrix(h->Ac);
+    G_free(h);
+}
+
+/* weighted Jacobi steps z += w D^-1 (r - A z) */
+static void smooth(struct mg_level *l, int steps)
+{
+    int i, s;
+
+    for (s = 0; s < steps; s++) {
+	G_math_Ax_csr(l->A, l->z, l->t);
+#pragma omp for schedule (static)
+	for (i = 0; i < l->rows; i++)
+	    l->z[i] += l->dinv[i] * (l->r[i] - l->t[i]);
+    }
+}
+
+/* V-cycle z = M r at level k, called by all threads of a parallel region */
+static void vcycle(struct mg_hierarchy *h, int k)
+{
+    struct mg_level *l = &h->level[k];
+    struct mg_level *c;
+    int i, I, j;
+
+    if (k == h->levels - 1) {
+	if (h->Ac) {
+#pragma omp single
+	    {
+		G_math_forward_substitution(h->Ac, l->t, l->r, l->rows);
+		G_math_backward_substitution(h->Ac, l->z, l->t, l->rows);
+	    }
+	}
+	else {
+#pragma omp for schedule (static)
+	    for (i = 0; i < l->rows; i++)
+		l->z[i] = l->dinv[i] * l->r[i];
+	    smooth(l, 4 * MG_SMOOTH_STEPS);
+	}
+	return;
+    }
+
+    c = &h->level[k + 1];
+
+#pragma omp for schedule (static)
+    for (i = 0; i < l->rows; i++)
+	l->z[i] = l->dinv[i] * l->r[i];
+    smooth(l, MG_SMOOTH_STEPS - 1);
+
+    /* restriction of the residual */
+    G_math_Ax_csr(l->A, l->z, l->t);
+#pragma omp for schedule (static) private(j)
+    for (I = 0; I < c->rows; I++) {
+	double sum = 0;
+
+	for (j = l->member_ptr[I]; j < l->member_ptr[I + 1]; j++)
+	    sum += l->r[l->member[j]] - l->t[l->member[j]];
+	c->r[I] = sum;
+    }
+
+    vcycle(h, k + 1);
+
+    /* prolongation of the correction */
+#pragma omp for schedule (static)
+    for (i = 0; i < l->rows; i++)
+	l->z[i] += c->z[l->agg[i]];
+
+    smooth(l, MG_SMOOTH_STEPS);
+}
+
+/*!
+ * \brief The multigrid preconditioned conjugate gradients solver for
+ * sparse symmetric positive definite matrices
+ *
+ * The preconditioner is one V-cycle of an aggregation multigrid
+ * hierarchy built from the matrix. Neighbouring rows of the matrix
+ * graph are merged into the rows of the coarser levels and the coarse
+ * matrices are the Galerkin products. Weighted Jacobi steps smooth the
+ * error on each level, the coarsest level is solved directly. For the
+ * stencil systems of regular grids the number of iterations grows
+ * only slowly with the grid size.
+ *
+ * This solver solves the linear equation system:
+ *  A x = b
+ *
+ * The parameter <i>maxit</i> specifies the maximum number of iterations. If the maximum is reached, the
+ * solver will abort the calculation and writes the current result into the vector x.
+ * The parameter <i>err</i> defines the error break criteria for the solver.
+ *
+ * \param Asp (G_math_spvector **) -- the sparse matrix
+ * \param x (double *) -- the value vector
+ * \param b (double *) -- the right hand side
+ * \param rows (int)
+ * \param maxit (int) -- the maximum number of iterations
+ * \param err (double) -- defines the error break criteria
+ * \return (int) -- 1 - success, 2 - not finished but success, -1 - could not solve the les
+ *
+ * */
+int G_math_solver_sparse_multigrid(G_math_spvector ** Asp, double *x,
+				   double *b, int rows, int maxit, double err)
+{
+    struct mg_hierarchy *h;
+    struct mg_level *l;
+    G_math_csr *A;
+    double *r, *p, *v;
+    double s = 0.0, a0 = 0, a1 = 0, mygamma = 0, tmp = 0;
+    int m, i;
+    int finished = 2;
+    int error_break = 0;
+
+    A = G_math_Asp_to_csr(Asp, rows);
+    h = create_hierarchy(A);
+    l = &h->level[0];
+    G_verbose_message(_("Multigrid with %i levels"), h->levels);
+
+    /* the residual is kept in the first level right hand side and the
+       preconditioned residual in its correction */
+    r = l->r;
+    p = G_alloc_vector(rows);
+    v = G_alloc_vector(rows);
+
+#pragma omp parallel
+    {
+	G_math_Ax_csr(A, x, v);
+	G_math_d_ax_by(b, v, r, 1.0, -1.0, rows);
+	vcycle(h, 0);
+	G_math_d_copy(l->z, p, rows);
+
+	/* scalar product */
+#pragma omp for schedule (static) private(i) reduction(+:s)
+	for (i = 0; i < rows; i++) {
+	    s += p[i] * r[i];
+	}
+    }
+
+    a0 = s;
+    s = 0.0;
+
+    /* ******************* */
+    /* start the iteration */
+    /* ******************* */
+    for (m = 0; m < maxit; m++) {
+#pragma omp parallel default(shared)
+	{
+	    G_math_Ax_csr(A, p, v);
+
+	    /* scalar product */
+#pragma omp for schedule (static) private(i) reduction(+:s)
+	    for (i = 0; i < rows; i++) {
+		s += v[i] * p[i];
+	    }
+
+	    /* barrier */
+#pragma omp single
+	    {
+		tmp = s;
+		mygamma = a0 / tmp;
+		s = 0.0;
+	    }
+
+	    G_math_d_ax_by(p, x, x, mygamma, 1.0, rows);
+
+	    if (m % 50 == 1) {
+		G_math_Ax_csr(A, x, v);
+		G_math_d_ax_by(b, v, r, 1.0, -1.0, rows);
+	    }
+	    else {
+		G_math_d_ax_by(r, v, r, 1.0, -1.0 * mygamma, rows);
+	    }
+
+	    /*performe the preconditioning */
+	    vcycle(h, 0);
+
+	    /* scalar product */
+#pragma omp for schedule (static) private(i) reduction(+:s)
+	    for (i = 0; i < rows; i++) {
+		s += l->z[i] * r[i];
+	    }
+
+	    /* barrier */
+#pragma omp single
+	    {
+		a1 = s;
+		tmp = a1 / a0;
+		a0 = a1;
+		s = 0.0;
+
+		if (a1 < 0 || a1 == 0 || a1 > 0) {
+		    ;
+		}
+		else {
+		    G_warning(_
+			      ("Unable to solve the linear equation system"));
+		    error_break = 1;
+		}
+	    }
+	    G_math_d_ax_by(p, l->z, p, tmp, 1.0, rows);
+	}
+
+	G_verbose_message(_("Multigrid PCG -- iteration %i error  %g\n"), m,
+			  a0);
+
+	if (error_break == 1) {
+	    finished = -1;
+	    break;
+	}
+
+	if (a0 < err) {
+	    finished = 1;
+	    break;
+	}
+    }
+
+    G_free(p);
+    G_free(v);
+    free_hierarchy(h);
+    G_math_free_csr(A);
+
+    return finished;
+}
@@ -0,0 +1,309 @@
+/*****************************************************************************
+*
+* MODULE:       Grass numerical math interface
+* AUTHOR(S):    GRASS Development Team
+*
+* PURPOSE:      compressed sparse row matrices and the incomplete
+* 		Cholesky preconditioner, part of the gmath library
+*
+* COPYRIGHT:    (C) 2020 by the GRASS Development Team
+*
+*               This program is free software under the GNU General Public
+*               License (>=v2). Read the file COPYING that comes with GRASS
+*               for details.
+*
+*****************************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include <grass/gmath.h>
+#include <grass/gis.h>
+
+/*!
+ * \brief Allocate memory for a compressed sparse row matrix
+ *
+ * The row pointers are set to zero, the index and values arrays can
+ * hold nnz entries.
+ *
+ * \param rows int
+ * \param nnz int -- number of non null entries
+ * \return G_math_csr *
+ *
+ * */
+G_math_csr *G_math_alloc_csr(int rows, int nnz)
+{
+    G_math_csr *csr;
+
+    G_debug(4, "Allocate memory for a csr matrix with %i rows and %i entries\n",
+	    rows, nnz);
+
+    csr = (G_math_csr *) G_calloc(1, sizeof(G_math_csr));
+    csr->rows = rows;
+    csr->nnz = nnz;
+    csr->row_ptr = (int *)G_calloc(rows + 1, sizeof(int));
+    csr->index = (unsigned int *)G_calloc(nnz > 0 ? nnz : 1,
+					  sizeof(unsigned int));
+    csr->values = (double *)G_calloc(nnz > 0 ? nnz : 1, sizeof(double));
+
+    return csr;
+}
+
+/*!
+ * \brief Release the memory of a compressed sparse row matrix
+ *
+ * \param csr G_math_csr *
+ * \return void
+ *
+ * */
+void G_math_free_csr(G_math_csr * csr)
+{
+    if (csr == NULL)
+	return;
+
+    G_free(csr->row_ptr);
+    G_free(csr->index);
+    G_free(csr->values);
+    G_free(csr);
+}
+
+/* sort the entries of each row by column */
+static void sort_rows(G_math_csr * csr)
+{
+    int i, j, k;
+
+#pragma omp parallel for schedule (static) private(i, j, k)
+    for (i = 0; i < csr->rows; i++) {
+	for (j = csr->row_ptr[i] + 1; j < csr->row_ptr[i + 1]; j++) {
+	    unsigned int col = csr->index[j];
+	    double val = csr->values[j];
+
+	    for (k = j - 1; k >= csr->row_ptr[i] && csr->index[k] > col; k--) {
+		csr->index[k + 1] = csr->index[k];
+		csr->values[k + 1] = csr->values[k];
+	    }
+	    csr->index[k + 1] = col;
+	    csr->values[k + 1] = val;
+	}
+    }
+}
+
+/*!
+ * \brief Convert a sparse matrix into a compressed sparse row matrix
+ *
+ * The rows are stored contiguous with the entries sorted by column.
+ *
+ * \param Asp (G_math_spvector **)
+ * \param rows (int)
+ * \return (G_math_csr *)
+ *
+ * */
+G_math_csr *G_math_Asp_to_csr(G_math_spvector ** Asp, int rows)
+{
+    G_math_csr *csr;
+    int i, j, nnz;
+
+    nnz = 0;
+    for (i = 0; i < rows; i++)
+	nnz += Asp[i]->cols;
+
+    csr = G_math_alloc_csr(rows, nnz);
+    for (i = 0; i < rows; i++)
+	csr->row_ptr[i + 1] = csr->row_ptr[i] + Asp[i]->cols;
+
+#pragma omp parallel for schedule (static) private(i, j)
+    for (i = 0; i < rows; i++) {
+	int start = csr->row_ptr[i];
+
+	for (j = 0; j < Asp[i]->cols; j++) {
+	    csr->index[start + j] = Asp[i]->index[j];
+	    csr->values[start + j] = Asp[i]->values[j];
+	}
+    }
+    sort_rows(csr);
+
+    return csr;
+}
+
+/*!
+ * \brief Convert a quadratic matrix into a compressed sparse row matrix
+ *
+ * All non null entries are stored.
+ *
+ * \param A (double **)
+ * \param rows (int)
+ * \return (G_math_csr *)
+ *
+ * */
+G_math_csr *G_math_A_to_csr(double **A, int rows)
+{
+    G_math_csr *csr;
+    int i, j, nnz;
+
+    nnz = 0;
+    for (i = 0; i < rows; i++)
+	for (j = 0; j < rows; j++)
+	    if (A[i][j] != 0.0)
+		nnz++;
+
+    csr = G_math_alloc_csr(rows, nnz);
+    nnz = 0;
+    for (i = 0; i < rows; i++) {
+	for (j = 0; j < rows; j++) {
+	    if (A[i][j] != 0.0) {
+		csr->index[nnz] = j;
+		csr->values[nnz] = A[i][j];
+		nnz++;
+	    }
+	}
+	csr->row_ptr[i + 1] = nnz;
+    }
+
+    return csr;
+}
+
+/*!
+ * \brief Compute the matrix - vector product of a compressed sparse
+ * row matrix and a vector
+ *
+ * This function is multi-threaded with OpenMP and can be called
+ * within a parallel OpenMP region.
+ *
+ * \param csr (G_math_csr *)
+ * \param x (double *)
+ * \param y (double *) -- the result y = A x
+ * \return (void)
+ *
+ * */
+void G_math_Ax_csr(G_math_csr * csr, double *x, double *y)
+{
+    int i, j;
+    const int *row_ptr = csr->row_ptr;
+    const unsigned int *index = csr->index;
+    const double *values = csr->values;
+    double tmp;
+
+#pragma omp for schedule (static) private(i, j, tmp)
+    for (i = 0; i < csr->rows; i++) {
+	tmp = 0;
+	for (j = row_ptr[i]; j < row_ptr[i + 1]; j++)
+	    tmp += values[j] * x[index[j]];
+	y[i] = tmp;
+    }
+    return;
+}
+
+/*!
+ * \brief Compute the incomplete Cholesky factorization IC(0) of a
+ * symmetric positive definite compressed sparse row matrix
+ *
+ * The lower triangular factor L with A ~ L L^T has the non null
+ * pattern of the lower part of A. The entries of the rows of A must be
+ * sorted by column (see G_math_Asp_to_csr()).
+ *
+ * \param csr (G_math_csr *) -- the symmetric matrix
+ * \return (G_math_csr *) -- the factor L with the diagonal as last
+ * entry of each row, NULL if the factorization breaks down
+ *
+ * */
+G_math_csr *G_math_csr_ichol(G_math_csr * csr)
+{
+    G_math_csr *L;
+    int i, j, k, a, b, nnz;
+    double sum;
+
+    nnz = 0;
+    for (i = 0; i < csr->rows; i++)
+	for (j = csr->row_ptr[i]; j < csr->row_ptr[i + 1]; j++)
+	    if (csr->index[j] <= i)
+		nnz++;
+
+    L = G_math_alloc_csr(csr->rows, nnz);
+    nnz = 0;
+    for (i = 0; i < csr->rows; i++) {
+	for (j = csr->row_ptr[i]; j < csr->row_ptr[i + 1]; j++) {
+	    if (csr->index[j] <= i) {
+		L->index[nnz] = csr->index[j];
+		L->values[nnz] = csr->values[j];
+		nnz++;
+	    }
+	}
+	L->row_ptr[i + 1] = nnz;
+    }
+
+    for (i = 0; i < L->rows; i++) {
+	int last = L->row_ptr[i + 1] - 1;
+
+	if (last < L->row_ptr[i] || L->index[last] != i) {
+	    G_debug(3, "G_math_csr_ichol(): no diagonal entry in row %i", i);
+	    G_math_free_csr(L);
+	    return NULL;
+	}
+
+	for (j = L->row_ptr[i]; j < last; j++) {
+	    k = L->index[j];
+
+	    /* sum of L[i][c] * L[k][c] for c < k */
+	    sum = 0;
+	    a = L->row_ptr[i];
+	    b = L->row_ptr[k];
+	    while (a < j && b < L->row_ptr[k + 1] - 1) {
+		if (L->index[a] == L->index[b])
+		    sum += L->values[a++] * L->values[b++];
+		else if (L->index[a] < L->index[b])
+		    a++;
+		else
+		    b++;
+	    }
+	    L->values[j] =
+		(L->values[j] - sum) / L->values[L->row_ptr[k + 1] - 1];
+	}
+
+	sum = L->values[last];
+	for (j = L->row_ptr[i]; j < last; j++)
+	    sum -= L->values[j] * L->values[j];
+	if (!(sum > 0)) {
+	    G_debug(3, "G_math_csr_ichol(): break down in row %i", i);
+	    G_math_free_csr(L);
+	    return NULL;
+	}
+	L->values[last] = sqrt(sum);
+    }
+
+    return L;
+}
+
+/*!
+ * \brief Apply the incomplete Cholesky preconditioner
+ *
+ * Solves L L^T z = r by forward and backward substitution. The
+ * substitutions are sequential, in a parallel OpenMP region the
+ * function must be called by a single thread.
+ *
+ * \param L (G_math_csr *) -- the factor computed by G_math_csr_ichol()
+ * \param r (double *)
+ * \param z (double *) -- the result
+ * \return (void)
+ *
+ * */
+void G_math_csr_ichol_solve(G_math_csr * L, double *r, double *z)
+{
+    int i, j, last;
+    double tmp;
+
+    for (i = 0; i < L->rows; i++) {
+	last = L->row_ptr[i + 1] - 1;
+	tmp = r[i];
+	for (j = L->row_ptr[i]; j < last; j++)
+	    tmp -= L->values[j] * z[L->index[j]];
+	z[i] = tmp / L->values[last];
+    }
+
+    for (i = L->rows - 1; i >= 0; i--) {
+	last = L->row_ptr[i + 1] - 1;
+	z[i] /= L->values[last];
+	tmp = z[i];
+	for (j = L->row_ptr[i]; j < last; j++)
+	    z[L->index[j]] -= L->values[j] * tmp;
+    }
+    return;
+}
@@ -77,6 +77,8 @@ int test_matrix_conversion(void)
 	double **F;
 	G_math_spvector **Asp;
 	G_math_spvector **Asp2;
+	G_math_csr *csr;
+	double *x, *y, *z;
 
 	A = G_alloc_matrix(5,5);
 	F = G_alloc_matrix(5,5);
@@ -162,6 +164,35 @@ int test_matrix_conversion(void)
         Asp2 = G_math_sband_matrix_to_Asp(D, 5, 4, 0.0);
 	G_math_print_spmatrix(Asp2, 5);
 
+	G_message("\t * Test sparse matrix to csr matrix conversion\n");
+
+	csr = G_math_Asp_to_csr(Asp, 5);
+	x = G_alloc_vector(5);
+	y = G_alloc_vector(5);
+	z = G_alloc_vector(5);
+	for(i = 0; i < 5; i++)
+	   x[i] = i + 1;
+
+	G_math_Ax_sparse(Asp, x, y, 5);
+	G_math_Ax_csr(csr, x, z);
+	for(i = 0; i < 5; i++)
+	   if (y[i] != z[i]) {
+		G_warning("Error in csr matrix conversion");
+		sum++;
+		break;
+	   }
+	for(i = 0; i < 5; i++)
+	   for(j = csr->row_ptr[i] + 1; j < csr->row_ptr[i + 1]; j++)
+	      if (csr->index[j - 1] >= csr->index[j]) {
+		G_warning("Error in csr matrix conversion, unsorted row %i", i);
+		sum++;
+	      }
+
+	G_math_free_csr(csr);
+	G_free_vector(x);
+	G_free_vector(y);
+	G_free_vector(z);
+
 	return sum;
 }
 
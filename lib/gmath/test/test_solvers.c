@@ -259,6 +259,52 @@ int test_solvers(void)
 	G_math_free_les(les);
 	G_math_free_les(sples);
 
+	G_message("\t * testing pcg solver with symmetric matrix and incomplete Cholesky preconditioner\n");
+
+	les = create_normal_symmetric_les(TEST_NUM_ROWS);
+	sples = create_sparse_symmetric_les(TEST_NUM_ROWS);
+
+	G_math_solver_pcg(les->A, les->x, les->b, les->rows, 250, 0.1e-9,
+			G_MATH_ICHOL_PRECONDITION);
+	G_math_d_asum_norm(les->x, &val, les->rows);
+	if ((val - (double)les->rows) > EPSILON_ITER)
+	{
+		G_warning("Error in G_math_solver_pcg abs %2.20f != %i", val, les->rows);
+		sum++;
+	}
+	G_math_print_les(les);
+
+	G_math_solver_sparse_pcg(sples->Asp, sples->x, sples->b, les->rows, 250,
+			0.1e-9, G_MATH_ICHOL_PRECONDITION);
+	G_math_d_asum_norm(sples->x, &val, sples->rows);
+	if ((val - (double)sples->rows) > EPSILON_ITER)
+	{
+		G_warning("Error in G_math_solver_sparse_pcg abs %2.20f != %i", val,
+				sples->rows);
+		sum++;
+	}
+	G_math_print_les(sples);
+
+	G_math_free_les(les);
+	G_math_free_les(sples);
+
+	G_message("\t * testing multigrid solver with symmetric matrix\n");
+
+	sples = create_sparse_symmetric_les(TEST_NUM_ROWS);
+
+	G_math_solver_sparse_multigrid(sples->Asp, sples->x, sples->b,
+			sples->rows, 250, 0.1e-9);
+	G_math_d_asum_norm(sples->x, &val, sples->rows);
+	if ((val - (double)sples->rows) > EPSILON_ITER)
+	{
+		G_warning("Error in G_math_solver_sparse_multigrid abs %2.20f != %i",
+				val, sples->rows);
+		sum++;
+	}
+	G_math_print_les(sples);
+
+	G_math_free_les(sples);
+
 	G_message("\t * testing cg solver with symmetric matrix\n");
 
 	les = create_normal_symmetric_les(TEST_NUM_ROWS);
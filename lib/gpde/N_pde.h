@@ -25,6 +25,7 @@
 
 #define N_NORMAL_LES 0
 #define N_SPARSE_LES 1
+#define N_STENCIL_LES 2
 /*!
  * Boundary conditions for cells
  */
@@ -60,12 +61,37 @@
 /* *************** LINEARE EQUATION SYSTEM PART ****************** */
 /* *************************************************************** */
 
+/*!
+ * \brief The stencil operator of a matrix-free linear equation system
+ *
+ * Instead of a matrix the coefficients of the star of each row
+ * are stored. The neighbours of a row are located with the row
+ * numbers of the grid cells, that are -1 for cells which are not part
+ * of the linear equation system. Coefficients of missing neighbours are zero.
+ * */
+typedef struct
+{
+    int type;			/*the star type N_5_POINT_STAR, N_7_POINT_STAR or N_9_POINT_STAR */
+    int points;			/*number of coefficients of each row, the center first */
+    int les_rows;		/*number of rows of the les */
+    int offset[9];		/*grid cell offsets of the neighbours */
+    int cols, rows, depths;	/*the size of the grid */
+    int *cell;			/*the row number of each grid cell */
+    int *index;			/*the grid cell of each row */
+    double *values;		/*the coefficients, points per row */
+} N_les_stencil;
+
+extern N_les_stencil *N_alloc_les_stencil(int cols, int rows, int depths,
+					  int les_rows, int type);
+extern void N_free_les_stencil(N_les_stencil * stencil);
+extern void N_les_stencil_Ax(N_les_stencil * stencil, double *x, double *y);
+
 /*!
  * \brief The linear equation system (les) structure 
  *
  * This structure manages the Ax = b system.
- * It manages regular quadratic matrices or
- * sparse matrices. The vector b and x are normal one dimensional 
+ * It manages regular quadratic matrices,
+ * sparse matrices or matrix-free stencil operators. The vector b and x are normal one dimensional 
  * memory structures of type double. Also the number of rows
  * and the matrix type are stored in this structure.
  * */
@@ -75,10 +101,11 @@ typedef struct
     double *b;			/*the right side of Ax = b */
     double **A;			/*the normal quadratic matrix */
     G_math_spvector **Asp;	/*the sparse matrix */
+    N_les_stencil *stencil;	/*the stencil operator of a matrix-free les */
     int rows;			/*number of rows */
     int cols;			/*number of cols */
     int quad;			/*is the matrix quadratic (1-quadratic, 0 not) */
-    int type;			/*the type of the les, normal == 0, sparse == 1 */
+    int type;			/*the type of the les, normal == 0, sparse == 1, stencil == 2 */
 } N_les;
 
 extern N_les *N_alloc_les_param(int cols, int rows, int type, int param);
@@ -92,6 +119,8 @@ extern N_les *N_alloc_nquad_les_Ax(int cols, int rows, int type);
 extern N_les *N_alloc_nquad_les_Ax_b(int cols, int rows, int type);
 extern void N_print_les(N_les * les);
 extern void N_free_les(N_les * les);
+extern int N_solver_stencil_cg(N_les * les, int maxit, double err);
+extern int N_solver_stencil_pcg(N_les * les, int maxit, double err);
 
 /* *************************************************************** */
 /* *************** GEOMETRY INFORMATION ************************** */
@@ -152,7 +152,8 @@ N_les *N_alloc_les_Ax_b(int rows, int type)
  * \brief Allocate memory for a quadratic or not quadratic linear equation system
  *
  * The type of the linear equation system must be N_NORMAL_LES for
- * a regular quadratic matrix or N_SPARSE_LES for a sparse matrix
+ * a regular quadratic matrix, N_SPARSE_LES for a sparse matrix or
+ * N_STENCIL_LES for a matrix-free stencil operator
  *
  * <p>
  * In case of N_NORMAL_LES
@@ -165,6 +166,12 @@ N_les *N_alloc_les_Ax_b(int rows, int type)
  * a vector of size row will be allocated, ready to hold additional allocated sparse vectors.
  * each sparse vector may have a different size.
  *
+ * <p>
+ * In case of N_STENCIL_LES
+ *
+ * no matrix will be allocated, the stencil operator is created by the
+ * assemble functions.
+ *
  * Parameter parts defines which parts of the les should be allocated.
  * The number of columns and rows defines if the matrix is quadratic.
  *
@@ -185,6 +192,10 @@ N_les *N_alloc_les_param(int cols, int rows, int type, int parts)
 	G_debug(2,
 		"Allocate memory for a sparse linear equation system with %i rows\n",
 		rows);
+    else if (type == N_STENCIL_LES)
+	G_debug(2,
+		"Allocate memory for a matrix-free linear equation system with %i rows\n",
+		rows);
     else
 	G_debug(2,
 		"Allocate memory for a regular linear equation system with %i rows\n",
@@ -207,6 +218,7 @@ N_les *N_alloc_les_param(int cols, int rows, int type, int parts)
 
     les->A = NULL;
     les->Asp = NULL;
+    les->stencil = NULL;
     les->rows = rows;
     les->cols = cols;
     if (rows == cols)
@@ -218,6 +230,10 @@ N_les *N_alloc_les_param(int cols, int rows, int type, int parts)
 	les->Asp = G_math_alloc_spmatrix(rows);
 	les->type = N_SPARSE_LES;
     }
+    else if (type == N_STENCIL_LES) {
+	/*the stencil operator is created by the assemble functions */
+	les->type = N_STENCIL_LES;
+    }
     else {
 	les->A = G_alloc_matrix(rows, cols);
 	les->type = N_NORMAL_LES;
@@ -275,6 +291,28 @@ void N_print_les(N_les * les)
 	    fprintf(stdout, "\n");
 	}
     }
+    else if (les->type == N_STENCIL_LES) {
+	N_les_stencil *st = les->stencil;
+
+	for (i = 0; i < les->rows; i++) {
+	    for (j = 0; j < les->cols; j++) {
+		double val = (j == i) ? st->values[i * st->points] : 0.0;
+
+		for (k = 1; k < st->points; k++) {
+		    if (st->values[i * st->points + k] != 0.0 &&
+			st->cell[st->index[i] + st->offset[k]] == j)
+			val = st->values[i * st->points + k];
+		}
+		fprintf(stdout, "%4.5f ", val);
+	    }
+	    if (les->x)
+		fprintf(stdout, "  *  %4.5f", les->x[i]);
+	    if (les->b)
+		fprintf(stdout, " =  %4.5f ", les->b[i]);
+
+	    fprintf(stdout, "\n");
+	}
+    }
     else {
 
 	for (i = 0; i < les->rows; i++) {
@@ -305,6 +343,8 @@ void N_free_les(N_les * les)
 {
     if (les->type == N_SPARSE_LES)
 	G_debug(2, "Releasing memory of a sparse linear equation system\n");
+    else if (les->type == N_STENCIL_LES)
+	G_debug(2, "Releasing memory of a matrix-free linear equation system\n");
     else
 	G_debug(2, "Releasing memory of a regular linear equation system\n");
 
@@ -321,6 +361,12 @@ void N_free_les(N_les * les)
 		G_math_free_spmatrix(les->Asp, les->rows);
 	    }
 	}
+	else if (les->type == N_STENCIL_LES) {
+
+	    if (les->stencil) {
+		N_free_les_stencil(les->stencil);
+	    }
+	}
 	else {
 
 	    if (les->A) {
@@ -35,6 +35,22 @@ static int make_les_entry_3d(int i, int j, int k, int offset_i, int offset_j,
 			     N_array_3d * start_val, double entry,
 			     int cell_type);
 
+static void make_stencil_row_2d(int i, int j, int count, N_les * les,
+				N_data_star * items, N_geom_data * geom,
+				N_array_2d * status, N_array_2d * start_val,
+				int cell_type);
+
+static void make_stencil_row_3d(int i, int j, int k, int count, N_les * les,
+				N_data_star * items, N_geom_data * geom,
+				N_array_3d * status, N_array_3d * start_val,
+				int cell_type);
+
+static void stencil_integrate_dirichlet(N_les_stencil * stencil,
+					const char *dirichlet);
+
+static void set_stencil_cells(N_les_stencil * stencil, int **index_ij,
+			      int count, int dim);
+
 /* *************************************************************** * 
  * ********************** N_alloc_5star ************************** * 
  * *************************************************************** */
@@ -648,6 +664,16 @@ N_les *N_assemble_les_2d_param(int les_type, N_geom_data * geom,
 	}
     }
 
+    /*the star type of the matrix-free les is given by the callback */
+    if (les_type == N_STENCIL_LES) {
+	N_data_star *items = call->callback(data, geom, index_ij[0][0], index_ij[0][1]);
+
+	les->stencil = N_alloc_les_stencil(geom->cols, geom->rows, 1,
+					   cell_type_count, items->type);
+	set_stencil_cells(les->stencil, index_ij, cell_type_count, 2);
+	G_free(items);
+    }
+
     G_debug(2, "N_assemble_les_2d: starting the parallel assemble loop");
 
     /* Assemble the matrix in parallel */
@@ -672,6 +698,14 @@ N_les *N_assemble_les_2d_param(int les_type, N_geom_data * geom,
 	/* the entry in the vector b */
 	les->b[count] = items->V;
 
+	/* the matrix-free les stores only the star coefficients */
+	if (les_type == N_STENCIL_LES) {
+	    make_stencil_row_2d(i, j, count, les, items, geom, status,
+				start_val, cell_type);
+	    G_free(items);
+	    continue;
+	}
+
 	/* pos describes the position in the sparse vector.
 	 * the first entry is always the diagonal entry of the matrix*/
 	pos = 0;
@@ -823,6 +857,8 @@ int N_les_integrate_dirichlet_2d(N_les * les, N_geom_data * geom,
 	/*perform the matrix vector product and */
 	if (les->type == N_SPARSE_LES)
 	    G_math_Ax_sparse(les->Asp, dvect1, dvect2, les->rows);
+	else if (les->type == N_STENCIL_LES)
+	    N_les_stencil_Ax(les->stencil, dvect1, dvect2);
 	else
 	    G_math_d_Ax(les->A, dvect1, dvect2, les->rows, les->cols);
 #pragma omp for schedule (static) private(i)
@@ -830,6 +866,27 @@ int N_les_integrate_dirichlet_2d(N_les * les, N_geom_data * geom,
 	    les->b[i] = les->b[i] - dvect2[i];
     }
 
+    /*the stencil of the matrix-free les is modified in the same way */
+    if (les->type == N_STENCIL_LES) {
+	char *dirichlet = (char *)G_calloc(les->rows, sizeof(char));
+
+	for (y = 0; y < rows; y++) {
+	    for (x = 0; x < cols; x++) {
+		stat = N_get_array_2d_c_value(status, x, y);
+		count = les->stencil->cell[y * cols + x];
+		if (count >= 0 && stat > N_CELL_ACTIVE &&
+		    stat < N_MAX_CELL_STATE)
+		    dirichlet[count] = 1;
+	    }
+	}
+	stencil_integrate_dirichlet(les->stencil, dirichlet);
+
+	G_free(dirichlet);
+	G_free(dvect1);
+	G_free(dvect2);
+	return 0;
+    }
+
     /*now set the Dirichlet cell rows and cols to zero and the 
      * diagonal entry to 1*/
     count = 0;
@@ -1112,6 +1169,16 @@ N_les *N_assemble_les_3d_param(int les_type, N_geom_data * geom,
 	}
     }
 
+    /*the star type of the matrix-free les is given by the callback */
+    if (les_type == N_STENCIL_LES) {
+	N_data_star *items = call->callback(data, geom, index_ij[0][0], index_ij[0][1], index_ij[0][2]);
+
+	les->stencil = N_alloc_les_stencil(geom->cols, geom->rows, geom->depths,
+					   cell_type_count, items->type);
+	set_stencil_cells(les->stencil, index_ij, cell_type_count, 3);
+	G_free(items);
+    }
+
     G_debug(2, "N_assemble_les_3d: starting the parallel assemble loop");
 
 #pragma omp parallel for private(i, j, k, pos, count) schedule(static)
@@ -1135,6 +1202,14 @@ N_les *N_assemble_les_3d_param(int les_type, N_geom_data * geom,
 	/* the entry in the vector b */
 	les->b[count] = items->V;
 
+	/* the matrix-free les stores only the star coefficients */
+	if (les_type == N_STENCIL_LES) {
+	    make_stencil_row_3d(i, j, k, count, les, items, geom, status,
+				start_val, cell_type);
+	    G_free(items);
+	    continue;
+	}
+
 	/* pos describes the position in the sparse vector.
 	 * the first entry is always the diagonal entry of the matrix*/
 	pos = 0;
@@ -1280,6 +1355,8 @@ int N_les_integrate_dirichlet_3d(N_les * les, N_geom_data * geom,
 	/*perform the matrix vector product and */
 	if (les->type == N_SPARSE_LES)
 	    G_math_Ax_sparse(les->Asp, dvect1, dvect2, les->rows);
+	else if (les->type == N_STENCIL_LES)
+	    N_les_stencil_Ax(les->stencil, dvect1, dvect2);
 	else
 	    G_math_d_Ax(les->A, dvect1, dvect2, les->rows, les->cols);
 #pragma omp for schedule (static) private(i)
@@ -1287,6 +1364,29 @@ int N_les_integrate_dirichlet_3d(N_les * les, N_geom_data * geom,
 	    les->b[i] = les->b[i] - dvect2[i];
     }
 
+    /*the stencil of the matrix-free les is modified in the same way */
+    if (les->type == N_STENCIL_LES) {
+	char *dirichlet = (char *)G_calloc(les->rows, sizeof(char));
+
+	for (z = 0; z < depths; z++) {
+	    for (y = 0; y < rows; y++) {
+		for (x = 0; x < cols; x++) {
+		    stat = (int)N_get_array_3d_d_value(status, x, y, z);
+		    count = les->stencil->cell[(z * rows + y) * cols + x];
+		    if (count >= 0 && stat > N_CELL_ACTIVE &&
+			stat < N_MAX_CELL_STATE)
+			dirichlet[count] = 1;
+		}
+	    }
+	}
+	stencil_integrate_dirichlet(les->stencil, dirichlet);
+
+	G_free(dirichlet);
+	G_free(dvect1);
+	G_free(dvect2);
+	return 0;
+    }
+
     /*now set the Dirichlet cell rows and cols to zero and the 
      * diagonal entry to 1*/
     count = 0;
@@ -1395,3 +1495,152 @@ int make_les_entry_3d(int i, int j, int k, int offset_i, int offset_j,
 
     return pos;
 }
+
+/* **************************************************************** */
+/* **** number the cells of a matrix-free les ********************* */
+/* **************************************************************** */
+void set_stencil_cells(N_les_stencil * stencil, int **index_ij, int count,
+		       int dim)
+{
+    int n, c;
+
+    for (n = 0; n < count; n++) {
+	c = index_ij[n][1] * stencil->cols + index_ij[n][0];
+	if (dim == 3)
+	    c += index_ij[n][2] * stencil->cols * stencil->rows;
+	stencil->cell[c] = n;
+	stencil->index[n] = c;
+    }
+}
+
+/* **************************************************************** */
+/* **** make a row of a matrix-free les (2d) ********************** */
+/* **************************************************************** */
+void make_stencil_row_2d(int i, int j, int count, N_les * les,
+			 N_data_star * items, N_geom_data * geom,
+			 N_array_2d * status, N_array_2d * start_val,
+			 int cell_type)
+{
+    /* the neighbours in the order of the stencil offsets */
+    static const int di[8] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+    static const int dj[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+    N_les_stencil *st = les->stencil;
+    double *v = st->values + (size_t)count * st->points;
+    double entry[8];
+    int n, ni, nj, stat;
+
+    entry[0] = items->W;
+    entry[1] = items->E;
+    entry[2] = items->N;
+    entry[3] = items->S;
+    if (items->type == N_9_POINT_STAR) {
+	entry[4] = items->NW;
+	entry[5] = items->NE;
+	entry[6] = items->SW;
+	entry[7] = items->SE;
+    }
+    else
+	entry[4] = entry[5] = entry[6] = entry[7] = 0.0;
+
+    v[0] = items->C;
+    for (n = 1; n < st->points; n++) {
+	ni = i + di[n - 1];
+	nj = j + dj[n - 1];
+	v[n] = 0.0;
+
+	if (ni < 0 || nj < 0 || ni >= geom->cols || nj >= geom->rows)
+	    continue;
+
+	if (st->cell[nj * geom->cols + ni] >= 0) {
+	    v[n] = entry[n - 1];
+	}
+	else if (cell_type == N_CELL_ACTIVE) {
+	    /* dirichlet or transmission cells must be handled like this */
+	    stat = N_get_array_2d_c_value(status, ni, nj);
+	    if (stat > N_CELL_ACTIVE && stat < N_MAX_CELL_STATE)
+		les->b[count] -=
+		    N_get_array_2d_d_value(start_val, ni, nj) * entry[n - 1];
+	}
+    }
+}
+
+/* **************************************************************** */
+/* **** make a row of a matrix-free les (3d) ********************** */
+/* **************************************************************** */
+void make_stencil_row_3d(int i, int j, int k, int count, N_les * les,
+			 N_data_star * items, N_geom_data * geom,
+			 N_array_3d * status, N_array_3d * start_val,
+			 int cell_type)
+{
+    /* the neighbours in the order of the stencil offsets */
+    static const int di[6] = { -1, 1, 0, 0, 0, 0 };
+    static const int dj[6] = { 0, 0, -1, 1, 0, 0 };
+    static const int dk[6] = { 0, 0, 0, 0, 1, -1 };
+    N_les_stencil *st = les->stencil;
+    double *v = st->values + (size_t)count * st->points;
+    double entry[6];
+    int n, ni, nj, nk, stat;
+
+    entry[0] = items->W;
+    entry[1] = items->E;
+    entry[2] = items->N;
+    entry[3] = items->S;
+    if (items->type == N_7_POINT_STAR || items->type == N_27_POINT_STAR) {
+	entry[4] = items->T;
+	entry[5] = items->B;
+    }
+    else
+	entry[4] = entry[5] = 0.0;
+
+    v[0] = items->C;
+    for (n = 1; n < st->points; n++) {
+	ni = i + di[n - 1];
+	nj = j + dj[n - 1];
+	nk = k + dk[n - 1];
+	v[n] = 0.0;
+
+	if (ni < 0 || nj < 0 || nk < 0 || ni >= geom->cols ||
+	    nj >= geom->rows || nk >= geom->depths)
+	    continue;
+
+	if (st->cell[(nk * geom->rows + nj) * geom->cols + ni] >= 0) {
+	    v[n] = entry[n - 1];
+	}
+	else if (cell_type == N_CELL_ACTIVE) {
+	    /* dirichlet or transmission cells must be handled like this */
+	    stat = (int)N_get_array_3d_d_value(status, ni, nj, nk);
+	    if (stat > N_CELL_ACTIVE && stat < N_MAX_CELL_STATE)
+		les->b[count] -=
+		    N_get_array_3d_d_value(start_val, ni, nj, nk) *
+		    entry[n - 1];
+	}
+    }
+}
+
+/* **************************************************************** */
+/* **** integrate dirichlet cells into a matrix-free les ********** */
+/* **************************************************************** */
+void stencil_integrate_dirichlet(N_les_stencil * stencil,
+				 const char *dirichlet)
+{
+    int i, n;
+
+#pragma omp parallel for private(i, n) schedule(static)
+    for (i = 0; i < stencil->les_rows; i++) {
+	double *v = stencil->values + (size_t)i * stencil->points;
+	int c = stencil->index[i];
+
+	if (dirichlet[i]) {
+	    /*set the row to zero and the diagonal entry to 1 */
+	    v[0] = 1.0;
+	    for (n = 1; n < stencil->points; n++)
+		v[n] = 0.0;
+	    continue;
+	}
+	/*set the cols of dirichlet cells to zero */
+	for (n = 1; n < stencil->points; n++)
+	    if (v[n] != 0.0 &&
+		dirichlet[stencil->cell[c + stencil->offset[n]]])
+		v[n] = 0.0;
+    }
+}
@@ -0,0 +1,309 @@
+/*****************************************************************************
+*
+* MODULE:       Grass PDE Numerical Library
+* AUTHOR(S):    GRASS Development Team
+*
+* PURPOSE:      matrix-free stencil operators of linear equation systems
+* 		part of the gpde library
+*
+* COPYRIGHT:    (C) 2020 by the GRASS Development Team
+*
+*               This program is free software under the GNU General Public
+*               License (>=v2). Read the file COPYING that comes with GRASS
+*               for details.
+*
+*****************************************************************************/
+
+#include <grass/N_pde.h>
+#include <grass/gmath.h>
+#include <grass/glocale.h>
+
+static int solver_stencil(N_les * les, int maxit, double err, int prec);
+
+/*!
+ * \brief Allocate the stencil operator of a matrix-free linear equation system
+ *
+ * The row numbers of all grid cells are set to -1. The assemble functions
+ * set the row numbers of the cells which are part of the les, the grid
+ * cell of each row and the coefficients.
+ *
+ * A N_27_POINT_STAR is handled like a N_7_POINT_STAR, as done by
+ * #N_assemble_les_3d_param.
+ *
+ * \param cols int -- columns of the grid
+ * \param rows int -- rows of the grid
+ * \param depths int -- depths of the grid, 1 for 2d grids
+ * \param les_rows int -- number of rows of the les
+ * \param type int -- the star type N_5_POINT_STAR, N_7_POINT_STAR or N_9_POINT_STAR
+ * \return N_les_stencil *
+ * */
+N_les_stencil *N_alloc_les_stencil(int cols, int rows, int depths,
+				   int les_rows, int type)
+{
+    N_les_stencil *st;
+    size_t i, cells = (size_t)cols * rows * depths;
+
+    G_debug(2,
+	    "N_alloc_les_stencil: stencil operator with %i rows for %lu cells",
+	    les_rows, (unsigned long)cells);
+
+    st = (N_les_stencil *) G_calloc(1, sizeof(N_les_stencil));
+    st->cols = cols;
+    st->rows = rows;
+    st->depths = depths;
+    st->les_rows = les_rows;
+
+    if (type == N_27_POINT_STAR)
+	type = N_7_POINT_STAR;
+    st->type = type;
+
+    /* the neighbours in the order west, east, north, south followed
+     * by top and bottom or the diagonal neighbours */
+    st->offset[0] = 0;
+    st->offset[1] = -1;
+    st->offset[2] = 1;
+    st->offset[3] = -cols;
+    st->offset[4] = cols;
+    st->points = 5;
+
+    if (type == N_7_POINT_STAR) {
+	st->offset[5] = cols * rows;
+	st->offset[6] = -cols * rows;
+	st->points = 7;
+    }
+    else if (type == N_9_POINT_STAR) {
+	st->offset[5] = -cols - 1;
+	st->offset[6] = -cols + 1;
+	st->offset[7] = cols - 1;
+	st->offset[8] = cols + 1;
+	st->points = 9;
+    }
+
+    st->cell = (int *)G_malloc(cells * sizeof(int));
+    for (i = 0; i < cells; i++)
+	st->cell[i] = -1;
+    st->index = (int *)G_calloc(les_rows, sizeof(int));
+    st->values =
+	(double *)G_calloc((size_t)les_rows * st->points, sizeof(double));
+
+    return st;
+}
+
+/*!
+ * \brief Release the memory of a stencil operator
+ *
+ * \param stencil N_les_stencil *
+ * \return void
+ * */
+void N_free_les_stencil(N_les_stencil * stencil)
+{
+    if (stencil == NULL)
+	return;
+
+    G_free(stencil->cell);
+    G_free(stencil->index);
+    G_free(stencil->values);
+    G_free(stencil);
+}
+
+/*!
+ * \brief Apply the stencil operator to a vector, y = A x
+ *
+ * This function is multi-threaded with OpenMP and can be called
+ * within a parallel OpenMP region.
+ *
+ * \param stencil N_les_stencil *
+ * \param x double *
+ * \param y double * -- the result
+ * \return void
+ * */
+void N_les_stencil_Ax(N_les_stencil * stencil, double *x, double *y)
+{
+    int i, k;
+    const int points = stencil->points;
+    const int *offset = stencil->offset;
+    const int *cell = stencil->cell;
+    double tmp;
+
+#pragma omp for schedule (static) private(i, k, tmp)
+    for (i = 0; i < stencil->les_rows; i++) {
+	const double *v = stencil->values + (size_t)i * points;
+	const int c = stencil->index[i];
+
+	tmp = v[0] * x[i];
+	for (k = 1; k < points; k++)
+	    if (v[k] != 0.0)
+		tmp += v[k] * x[cell[c + offset[k]]];
+	y[i] = tmp;
+    }
+}
+
+/*!
+ * \brief The iterative conjugate gradients solver for matrix-free linear
+ * equation systems
+ *
+ * The les must be created with type N_STENCIL_LES and must be symmetric
+ * positive definite. The result is written into les->x.
+ *
+ * \param les N_les *
+ * \param maxit int -- the maximum number of iterations
+ * \param err double -- defines the error break criteria
+ * \return int -- 1 - success, 2 - not finished but success, -1 - could not solve the les
+ * */
+int N_solver_stencil_cg(N_les * les, int maxit, double err)
+{
+    return solver_stencil(les, maxit, err, 0);
+}
+
+/*!
+ * \brief The iterative conjugate gradients solver with diagonal
+ * preconditioning for matrix-free linear equation systems
+ *
+ * The les must be created with type N_STENCIL_LES and must be symmetric
+ * positive definite. The result is written into les->x.
+ *
+ * \param les N_les *
+ * \param maxit int -- the maximum number of iterations
+ * \param err double -- defines the error break criteria
+ * \return int -- 1 - success, 2 - not finished but success, -1 - could not solve the les
+ * */
+int N_solver_stencil_pcg(N_les * les, int maxit, double err)
+{
+    return solver_stencil(les, maxit, err, G_MATH_DIAGONAL_PRECONDITION);
+}
+
+int solver_stencil(N_les * les, int maxit, double err, int prec)
+{
+    N_les_stencil *st = les->stencil;
+    double *x = les->x, *b = les->b;
+    double *r, *z, *p, *v, *dinv = NULL;
+    double s = 0.0, a0 = 0, a1 = 0, mygamma = 0, tmp = 0;
+    int m, i, rows;
+    int finished = 2;
+    int error_break = 0;
+
+    if (les->type != N_STENCIL_LES || st == NULL) {
+	G_warning(_("The linear equation system has no stencil operator"));
+	return -1;
+    }
+
+    rows = les->rows;
+    r = G_alloc_vector(rows);
+    p = G_alloc_vector(rows);
+    v = G_alloc_vector(rows);
+    z = prec ? G_alloc_vector(rows) : r;
+
+    if (prec) {
+	dinv = G_alloc_vector(rows);
+	for (i = 0; i < rows; i++) {
+	    tmp = st->values[(size_t)i * st->points];
+	    dinv[i] = tmp != 0.0 ? 1.0 / tmp : 1.0;
+	}
+    }
+
+    /*
+     * residual calculation
+     */
+#pragma omp parallel
+    {
+	N_les_stencil_Ax(st, x, v);
+	G_math_d_ax_by(b, v, r, 1.0, -1.0, rows);
+
+#pragma omp for schedule (static) private(i) reduction(+:s)
+	for (i = 0; i < rows; i++) {
+	    p[i] = prec ? dinv[i] * r[i] : r[i];
+	    s += p[i] * r[i];
+	}
+    }
+
+    a0 = s;
+    s = 0.0;
+
+    /* ******************* */
+    /* start the iteration */
+    /* ******************* */
+    for (m = 0; m < maxit; m++) {
+#pragma omp parallel default(shared)
+	{
+	    N_les_stencil_Ax(st, p, v);
+
+	    /* scalar product */
+#pragma omp for schedule (static) private(i) reduction(+:s)
+	    for (i = 0; i < rows; i++) {
+		s += v[i] * p[i];
+	    }
+
+	    /* barrier */
+#pragma omp single
+	    {
+		tmp = s;
+		mygamma = a0 / tmp;
+		s = 0.0;
+	    }
+
+	    G_math_d_ax_by(p, x, x, mygamma, 1.0, rows);
+
+	    if (m % 50 == 1) {
+		N_les_stencil_Ax(st, x, v);
+		G_math_d_ax_by(b, v, r, 1.0, -1.0, rows);
+	    }
+	    else {
+		G_math_d_ax_by(r, v, r, 1.0, -1.0 * mygamma, rows);
+	    }
+
+	    /*performe the preconditioning and the scalar product */
+#pragma omp for schedule (static) private(i) reduction(+:s)
+	    for (i = 0; i < rows; i++) {
+		if (prec)
+		    z[i] = dinv[i] * r[i];
+		s += z[i] * r[i];
+	    }
+
+	    /* barrier */
+#pragma omp single
+	    {
+		a1 = s;
+		tmp = a1 / a0;
+		a0 = a1;
+		s = 0.0;
+
+		if (a1 < 0 || a1 == 0 || a1 > 0) {
+		    ;
+		}
+		else {
+		    G_warning(_
+			      ("Unable to solve the linear equation system"));
+		    error_break = 1;
+		}
+	    }
+	    G_math_d_ax_by(p, z, p, tmp, 1.0, rows);
+	}
+
+	if (prec)
+	    G_verbose_message(_("Stencil PCG -- iteration %i error  %g\n"), m,
+			      a0);
+	else
+	    G_verbose_message(_("Stencil CG -- iteration %i error  %g\n"), m,
+			      a0);
+
+	if (error_break == 1) {
+	    finished = -1;
+	    break;
+	}
+
+	if (a0 < err) {
+	    finished = 1;
+	    break;
+	}
+    }
+
+    G_free(r);
+    G_free(p);
+    G_free(v);
+    if (prec) {
+	G_free(z);
+	G_free(dinv);
+    }
+
+    return finished;
+}
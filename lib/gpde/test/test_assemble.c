@@ -20,16 +20,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <grass/N_pde.h>
 #include "test_gpde_lib.h"
 
+#define EPSILON 0.000000001
+
 /* prototypes */
 static int test_matrix_assemble_2d(void);
 static int test_matrix_assemble_3d(void);
+static int test_stencil_assemble_2d(void);
+static int test_stencil_assemble_3d(void);
 static N_array_2d *create_status_array_2d(void);
 static N_array_3d *create_status_array_3d(void);
 static N_array_2d *create_value_array_2d(void);
 static N_array_3d *create_value_array_3d(void);
+static int compare_stencil_les(N_les * les, N_les * sles);
 
 /* *************************************************************** */
 /* Performe the les assmbling tests ****************************** */
@@ -46,6 +52,12 @@ int unit_test_assemble(void)
     G_message("\t 2. testing 3d assembling");
     sum += test_matrix_assemble_3d();
 
+    G_message("\t 3. testing 2d assembling of matrix-free les");
+    sum += test_stencil_assemble_2d();
+
+    G_message("\t 4. testing 3d assembling of matrix-free les");
+    sum += test_stencil_assemble_3d();
+
     if (sum > 0)
 	G_warning("\n-- Assembling unit tests failure --");
     else
@@ -271,3 +283,135 @@ int test_matrix_assemble_2d(void)
 
     return 0;
 }
+
+/* *************************************************************** */
+/* Compare a sparse and a matrix-free les ************************ */
+/* *************************************************************** */
+int compare_stencil_les(N_les * les, N_les * sles)
+{
+    int i, sum = 0;
+    double *x, *y1, *y2;
+
+    if (les->rows != sles->rows) {
+	G_warning("Error in the matrix-free les, %i rows != %i rows",
+		  sles->rows, les->rows);
+	return 1;
+    }
+
+    x = G_alloc_vector(les->rows);
+    y1 = G_alloc_vector(les->rows);
+    y2 = G_alloc_vector(les->rows);
+
+    for (i = 0; i < les->rows; i++)
+	x[i] = (double)(i % 7) + 1.0;
+
+    G_math_Ax_sparse(les->Asp, x, y1, les->rows);
+    N_les_stencil_Ax(sles->stencil, x, y2);
+
+    for (i = 0; i < les->rows; i++) {
+	if (fabs(y1[i] - y2[i]) > EPSILON || fabs(les->b[i] - sles->b[i]) > EPSILON) {
+	    G_warning("Error in the matrix-free les at row %i: %g != %g",
+		      i, y2[i], y1[i]);
+	    sum++;
+	    break;
+	}
+    }
+
+    G_free(x);
+    G_free(y1);
+    G_free(y2);
+
+    return sum;
+}
+
+/* *************************************************************** */
+/* Test the matrix-free assembling with 3d array data ************ */
+/* *************************************************************** */
+int test_stencil_assemble_3d(void)
+{
+    N_geom_data *geom;
+    N_les *les, *sles;
+    N_les_callback_3d *call;
+    N_array_3d *status;
+    N_array_3d *start_val;
+    int sum = 0;
+
+    call = N_alloc_les_callback_3d();
+    status = create_status_array_3d();
+    start_val = create_value_array_3d();
+
+    geom = N_alloc_geom_data();
+    geom->dx = 1;
+    geom->dy = 1;
+    geom->dz = 1;
+    geom->Az = 1;
+    geom->depths = TEST_N_NUM_DEPTHS;
+    geom->rows = TEST_N_NUM_ROWS;
+    geom->cols = TEST_N_NUM_COLS;
+
+    les = N_assemble_les_3d(N_SPARSE_LES, geom, status, start_val, NULL, call);
+    sles = N_assemble_les_3d(N_STENCIL_LES, geom, status, start_val, NULL, call);
+    sum += compare_stencil_les(les, sles);
+    N_free_les(les);
+    N_free_les(sles);
+
+    les = N_assemble_les_3d_dirichlet(N_SPARSE_LES, geom, status, start_val, NULL, call);
+    N_les_integrate_dirichlet_3d(les, geom, status, start_val);
+    sles = N_assemble_les_3d_dirichlet(N_STENCIL_LES, geom, status, start_val, NULL, call);
+    N_les_integrate_dirichlet_3d(sles, geom, status, start_val);
+    sum += compare_stencil_les(les, sles);
+    N_free_les(les);
+    N_free_les(sles);
+
+    N_free_array_3d(status);
+    N_free_array_3d(start_val);
+    G_free(geom);
+    G_free(call);
+
+    return sum;
+}
+
+/* *************************************************************** */
+/* Test the matrix-free assembling with 2d array data ************ */
+/* *************************************************************** */
+int test_stencil_assemble_2d(void)
+{
+    N_geom_data *geom;
+    N_les *les, *sles;
+    N_les_callback_2d *call;
+    N_array_2d *status;
+    N_array_2d *start_val;
+    int sum = 0;
+
+    call = N_alloc_les_callback_2d();
+    status = create_status_array_2d();
+    start_val = create_value_array_2d();
+
+    geom = N_alloc_geom_data();
+    geom->dx = 1;
+    geom->dy = 1;
+    geom->Az = 1;
+    geom->rows = TEST_N_NUM_ROWS;
+    geom->cols = TEST_N_NUM_COLS;
+
+    les = N_assemble_les_2d(N_SPARSE_LES, geom, status, start_val, NULL, call);
+    sles = N_assemble_les_2d(N_STENCIL_LES, geom, status, start_val, NULL, call);
+    sum += compare_stencil_les(les, sles);
+    N_free_les(les);
+    N_free_les(sles);
+
+    les = N_assemble_les_2d_dirichlet(N_SPARSE_LES, geom, status, start_val, NULL, call);
+    N_les_integrate_dirichlet_2d(les, geom, status, start_val);
+    sles = N_assemble_les_2d_dirichlet(N_STENCIL_LES, geom, status, start_val, NULL, call);
+    N_les_integrate_dirichlet_2d(sles, geom, status, start_val);
+    sum += compare_stencil_les(les, sles);
+    N_free_les(les);
+    N_free_les(sles);
+
+    N_free_array_2d(status);
+    N_free_array_2d(start_val);
+    G_free(geom);
+    G_free(call);
+
+    return sum;
+}
@@ -214,6 +214,21 @@ int test_gwflow_3d(void)
     N_print_les(les);
     N_free_les(les);
 
+     /*CG matrix-free*/ les =
+	N_assemble_les_3d(N_STENCIL_LES, geom, data->status, data->phead_start,
+			  (void *)data, call);
+    N_solver_stencil_cg(les, 100, 0.1e-8);
+    N_print_les(les);
+    N_free_les(les);
+
+     /*PCG matrix-free*/ les =
+	N_assemble_les_3d_dirichlet(N_STENCIL_LES, geom, data->status, data->phead_start,
+			  (void *)data, call);
+    N_les_integrate_dirichlet_3d(les, geom, data->status, data->phead_start);
+    N_solver_stencil_pcg(les, 100, 0.1e-8);
+    N_print_les(les);
+    N_free_les(les);
+
 
      /*CG*/ les =
 	N_assemble_les_3d(N_NORMAL_LES, geom, data->status, data->phead_start,
@@ -406,6 +421,21 @@ int test_gwflow_2d(void)
     N_print_les(les);
     N_free_les(les);
 
+     /*CG matrix-free*/ les =
+	N_assemble_les_2d(N_STENCIL_LES, geom, data->status, data->phead_start,
+			  (void *)data, call);
+    N_solver_stencil_cg(les, 100, 0.1e-8);
+    N_print_les(les);
+    N_free_les(les);
+
+     /*PCG matrix-free*/ les =
+	N_assemble_les_2d_dirichlet(N_STENCIL_LES, geom, data->status, data->phead_start,
+			  (void *)data, call);
+    N_les_integrate_dirichlet_2d(les, geom, data->status, data->phead_start);
+    N_solver_stencil_pcg(les, 100, 0.1e-8);
+    N_print_les(les);
+    N_free_les(les);
+
 
      /*CG*/ les =
 	N_assemble_les_2d(N_NORMAL_LES, geom, data->status, data->phead_start,
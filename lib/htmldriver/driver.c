@@ -35,6 +35,7 @@ const struct driver *HTML_Driver(void)
     drv.Set_window = NULL;
     drv.Begin_raster = NULL;
     drv.Raster = NULL;
+    drv.Raster_columns = NULL;
     drv.End_raster = NULL;
     drv.Begin = HTML_Begin;
     drv.Move = HTML_Move;
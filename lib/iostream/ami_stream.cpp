@@ -42,6 +42,9 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
 
 extern "C" {
 #include <grass/gis.h>
@@ -175,3 +178,141 @@ open_stream(char* pathname, AMI_stream_type st) {
   return fp;
 }
 
+
+
+/**********************************************************************/
+/* set up the memory-mapped read window from STREAM_MMAP */
+void
+UntypedStream::map_init() {
+  char *p = getenv(STREAM_MMAP);
+
+  map_size = 0;
+  map_base = NULL;
+  map_off = 0;
+  map_len = 0;
+  map_pos = 0;
+  map_active = 0;
+
+#ifndef __MINGW32__
+  if (p && atoi(p) > 0) {
+    size_t pagesize = getpagesize();
+
+    map_size = (size_t)atoi(p) << 20;
+    //whole pages, at least as large as the stdio buffer
+    if (map_size < STREAM_BUFFER_SIZE)
+      map_size = STREAM_BUFFER_SIZE;
+    map_size = (map_size + pagesize - 1) / pagesize * pagesize;
+  }
+#endif
+}
+
+
+/**********************************************************************/
+/* current (byte) position in the stream */
+off_t
+UntypedStream::map_tell() {
+  return map_active ? map_pos : G_ftell(fp);
+}
+
+
+/**********************************************************************/
+/* map a window of the file which holds the len bytes at pos; returns
+   1 on success, 0 if the file ends before pos+len and -1 if the file
+   cannot be mapped, in which case mapping is disabled for the stream
+   and the position of fp is set to pos */
+int
+UntypedStream::map_window(off_t pos, size_t len) {
+#ifndef __MINGW32__
+  struct stat st;
+  int fd = fileno(fp);
+  size_t pagesize = getpagesize();
+  off_t off;
+  size_t n;
+  void *ptr;
+
+  if (!map_active) {
+    //buffered writes must be in the file
+    fflush(fp);
+    map_active = 1;
+  }
+  map_pos = pos;
+
+  if (map_base && pos >= map_off && pos + len <= map_off + map_len)
+    return 1;
+
+  if (fstat(fd, &st) == -1) {
+    perror("AMI_STREAM: fstat failed ");
+    map_sync();
+    map_release();
+    map_size = 0;
+    return -1;
+  }
+  if (pos + (off_t)len > st.st_size)
+    return 0;
+
+  map_release();
+  map_active = 1;
+
+  off = pos / pagesize * pagesize;
+  n = map_size;
+  if (n < pos + len - off)
+    n = pos + len - off;
+  if ((off_t)n > st.st_size - off)
+    n = st.st_size - off;
+
+  ptr = mmap(NULL, n, PROT_READ, MAP_SHARED, fd, off);
+  if (ptr == MAP_FAILED) {
+    cerr << "AMI_STREAM: mmap of " << path << " failed: "
+         << strerror(errno) << ", reading through stdio" << endl;
+    map_sync();
+    map_size = 0;
+    return -1;
+  }
+
+  //streams are read sequentially: read this window and the next one
+  //ahead
+#ifdef MADV_SEQUENTIAL
+  madvise(ptr, n, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+  madvise(ptr, n, MADV_WILLNEED);
+#endif
+#ifdef POSIX_FADV_WILLNEED
+  if (off + (off_t)n < st.st_size)
+    posix_fadvise(fd, off + n, map_size, POSIX_FADV_WILLNEED);
+#endif
+
+  map_base = (char *)ptr;
+  map_off = off;
+  map_len = n;
+
+  return 1;
+#else
+  return -1;
+#endif
+}
+
+
+/**********************************************************************/
+/* hand the position back to fp before it is used */
+void
+UntypedStream::map_sync() {
+  if (map_active) {
+    G_fseek(fp, map_pos, SEEK_SET);
+    map_active = 0;
+  }
+}
+
+
+/**********************************************************************/
+/* unmap the read window; the position is not changed */
+void
+UntypedStream::map_release() {
+#ifndef __MINGW32__
+  if (map_base)
+    munmap(map_base, map_len);
+#endif
+  map_base = NULL;
+  map_off = 0;
+  map_len = 0;
+}
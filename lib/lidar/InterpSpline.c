@@ -461,6 +461,69 @@ void nCorrectGrad(double **N, double lambda, int xNum, int yNum,
     return;
 }
 
+/*----------------------------------------------------------------------------*/
+/* Normal system solution - the band matrix N is solved by Cholesky
+   decomposition or copied into a sparse matrix and solved by the
+   preconditioned conjugate gradients of the gmath library */
+
+void normalSolve(double **N, double *parVect, double *TN, int parNum,
+		 int BW, int solver, int maxit, double err)
+{
+    int i, j, n;
+    G_math_spvector **Asp;
+    int *cols;
+
+    if (solver != P_CG) {
+	G_math_solver_cholesky_sband(N, parVect, TN, parNum, BW);
+	return;
+    }
+
+    /* the band holds the upper part of the rows, the sparse rows hold
+       the whole symmetric rows */
+    cols = G_calloc(parNum, sizeof(int));
+    for (i = 0; i < parNum; i++) {
+	for (j = 0; j < BW && i + j < parNum; j++) {
+	    if (N[i][j] != 0.0) {
+		cols[i]++;
+		if (j > 0)
+		    cols[i + j]++;
+	    }
+	}
+    }
+    Asp = G_math_alloc_spmatrix(parNum);
+    for (i = 0; i < parNum; i++) {
+	G_math_spvector *v = G_math_alloc_spvector(cols[i]);
+
+	v->cols = 0;
+	G_math_add_spvector(Asp, v, i);
+    }
+    for (i = 0; i < parNum; i++) {
+	for (j = 0; j < BW && i + j < parNum; j++) {
+	    if (N[i][j] != 0.0) {
+		n = Asp[i]->cols++;
+		Asp[i]->index[n] = i + j;
+		Asp[i]->values[n] = N[i][j];
+		if (j > 0) {
+		    n = Asp[i + j]->cols++;
+		    Asp[i + j]->index[n] = i;
+		    Asp[i + j]->values[n] = N[i][j];
+		}
+	    }
+	}
+    }
+    G_free(cols);
+
+    for (i = 0; i < parNum; i++)
+	parVect[i] = 0.0;
+    if (G_math_solver_sparse_pcg(Asp, parVect, TN, parNum, maxit, err,
+				 G_MATH_DIAGONAL_PRECONDITION) < 0)
+	G_warning(_("Unable to solve the normal system"));
+
+    G_math_free_spmatrix(Asp, parNum);
+
+    return;
+}
+
 /*----------------------------------------------------------------------------*/
 /* Observations estimation */
 
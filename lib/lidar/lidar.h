@@ -62,6 +62,9 @@
     /* INTERPOLATOR */
 #define P_BILINEAR 		1
 #define P_BICUBIC 		0
+
+#define P_CHOLESKY 		0
+#define P_CG	 		1
     /* Boolean definitions */
 #define TRUE 			1
 #define FALSE 			0
@@ -187,6 +190,9 @@ void nCorrectLapl(double **N,	/* Normal Matrix () */
 void nCorrectGrad(double **N, double lambda, int xNum, int yNum,
 		  double deltaX, double deltaY);
 
+void normalSolve(double **N, double *parVect, double *TN, int parNum,
+		 int BW, int solver, int maxit, double err);
+
 void obsEstimateBicubic(double **obsV,	/*  */
 			double *obsE,	/*  */
 			double *parV,	/*  */
@@ -500,6 +500,7 @@ int gs_free_surf(geosurf * fs)
 	    }
 	    else {
 		gs_free_unshared_buffs(fs);
+		gsd_surf_free_cache(fs);
 
 		if (fs->curmask) {
 		    G_free(fs->curmask);
@@ -526,6 +527,7 @@ int gs_free_surf(geosurf * fs)
 
 	if (found) {
 	    gs_free_unshared_buffs(fs);
+	    gsd_surf_free_cache(fs);
 
 	    if (fs->curmask) {
 		G_free(fs->curmask);
@@ -1168,6 +1168,88 @@ void gsd_deletelist(GLuint listno, int range)
     }
 }
 
+/*!
+   \brief Create a display list
+
+   Unlike gsd_makelist() the number of such lists is not limited.
+
+   \return list id
+   \return 0 on failure
+ */
+int gsd_genlist(void)
+{
+    return glGenLists(1);
+}
+
+/*!
+   \brief Start a display list created by gsd_genlist()
+
+   The list is ended by gsd_endlist().
+
+   \param list list id
+   \param do_draw also draw the commands
+ */
+void gsd_newlist(int list, int do_draw)
+{
+    glNewList(list, do_draw ? GL_COMPILE_AND_EXECUTE : GL_COMPILE);
+
+    return;
+}
+
+/*!
+   \brief Draw a display list created by gsd_genlist()
+
+   \param list list id
+ */
+void gsd_execlist(int list)
+{
+    glCallList(list);
+
+    return;
+}
+
+/*!
+   \brief Delete a display list created by gsd_genlist()
+
+   \param list list id
+ */
+void gsd_freelist(int list)
+{
+    glDeleteLists(list, 1);
+
+    return;
+}
+
+/*!
+   \brief Draw lit triangles from vertex arrays
+
+   \param nindex number of indices, 3 for each triangle
+   \param index vertex indices
+   \param pts vertices (x, y, z)
+   \param norms normals (x, y, z)
+   \param colors colors (r, g, b, a)
+ */
+void gsd_drawtriangles(int nindex, const unsigned int *index,
+		       const float *pts, const float *norms,
+		       const unsigned char *colors)
+{
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    glVertexPointer(3, GL_FLOAT, 0, pts);
+    glNormalPointer(GL_FLOAT, 0, norms);
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors);
+
+    glDrawElements(GL_TRIANGLES, nindex, GL_UNSIGNED_INT, index);
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    return;
+}
+
 /*!
    \brief ADD
 
@@ -17,6 +17,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <grass/gis.h>
 #include <grass/glocale.h>
@@ -55,6 +56,29 @@
 static int transpoint_is_masked(geosurf *, Point3);
 static int get_point_below(Point3 **, geosurf **, int, int, int, int *);
 
+/*!
+   \brief Surface drawn from a display list
+
+   The triangles of the surface are put in vertex arrays and compiled
+   into a display list, which is drawn until the surface or its
+   attributes change.
+ */
+typedef struct
+{
+    int gsurf_id;
+    int list;			/* display list, 0 if none */
+    int x_mod, y_mod;
+    float z_exag;
+    long wire_color;
+    IFLAG att_src[MAX_ATTS];
+    int hdata[MAX_ATTS];
+    float constant[MAX_ATTS];
+    int *lookup[MAX_ATTS];
+} surf_cache;
+
+static surf_cache *Cache;
+static int Num_cache;
+
 static int FCmode;
 
 
@@ -86,6 +110,10 @@ int gsd_surf(geosurf * surf)
 
     desc = ATT_TOPO;
 
+    /* the cached drawing is built again with new normals or mask */
+    if (surf->norm_needupdate || surf->mask_needupdate)
+	gsd_surf_free_cache(surf);
+
     /* won't recalculate if update not needed, but may want to check
        to see if lights are on */
     gs_calc_normals(surf);
@@ -2046,6 +2074,236 @@ int gsd_norm_arrows(geosurf * surf)
 }
 
 
+/*!
+   \brief Free the cached drawing of a surface
+
+   \param surf surface (geosurf)
+ */
+void gsd_surf_free_cache(geosurf * surf)
+{
+    int i;
+
+    for (i = 0; i < Num_cache; i++) {
+	if (Cache[i].gsurf_id == surf->gsurf_id) {
+	    if (Cache[i].list)
+		gsd_freelist(Cache[i].list);
+	    Cache[i] = Cache[--Num_cache];
+	    return;
+	}
+    }
+}
+
+/*!
+   \brief Get the cached drawing of a surface
+
+   \param surf surface (geosurf)
+
+   \return cache entry, with no list if the surface changed
+ */
+static surf_cache *get_surf_cache(geosurf * surf)
+{
+    surf_cache *c = NULL;
+    int i, a, same;
+
+    for (i = 0; i < Num_cache; i++)
+	if (Cache[i].gsurf_id == surf->gsurf_id)
+	    c = &Cache[i];
+
+    if (!c) {
+	Cache = G_realloc(Cache, (Num_cache + 1) * sizeof(surf_cache));
+	c = &Cache[Num_cache++];
+	c->gsurf_id = surf->gsurf_id;
+	c->list = 0;
+    }
+
+    same = (c->x_mod == surf->x_mod && c->y_mod == surf->y_mod &&
+	    c->z_exag == surf->z_exag && c->wire_color == surf->wire_color);
+    for (a = 0; a < MAX_ATTS; a++)
+	same = same && c->att_src[a] == surf->att[a].att_src &&
+	    c->hdata[a] == surf->att[a].hdata &&
+	    c->constant[a] == surf->att[a].constant &&
+	    c->lookup[a] == surf->att[a].lookup;
+
+    if (!same && c->list) {
+	gsd_freelist(c->list);
+	c->list = 0;
+    }
+
+    c->x_mod = surf->x_mod;
+    c->y_mod = surf->y_mod;
+    c->z_exag = surf->z_exag;
+    c->wire_color = surf->wire_color;
+    for (a = 0; a < MAX_ATTS; a++) {
+	c->att_src[a] = surf->att[a].att_src;
+	c->hdata[a] = surf->att[a].hdata;
+	c->constant[a] = surf->att[a].constant;
+	c->lookup[a] = surf->att[a].lookup;
+    }
+
+    return c;
+}
+
+/*!
+   \brief Vertex arrays of a surface
+ */
+typedef struct
+{
+    int *vert;			/* vertex of each view cell, -1: not yet, -2: masked */
+    int xcnt;
+    float *pts, *norms;
+    unsigned char *colors;
+    int npts, nalloc;
+    unsigned int *index;
+    int nindex, nindex_alloc;
+} surf_arrays;
+
+/*!
+   \brief Get vertex of a view cell, adding it to the arrays
+
+   Vertices are computed as in gsd_surf_map().
+
+   \return vertex index
+   \return -1 if masked
+ */
+static int surf_vertex(geosurf * surf, surf_arrays * sa, int row, int col,
+		       typbuff * buff, typbuff * cobuff, gsurf_att * coloratt,
+		       typbuff * trbuff, gsurf_att * tratt, int curcolor,
+		       unsigned int ktrans)
+{
+    int *v = &sa->vert[row * (sa->xcnt + 1) + col];
+    long offset;
+    float z, ttr, n[3];
+    unsigned int c;
+
+    if (*v != -1)
+	return *v >= 0 ? *v : -1;
+
+    offset = (long)row * surf->y_mod * surf->cols + col * surf->x_mod;
+    if (!GET_MAPATT(buff, offset, z)) {
+	*v = -2;
+	return -1;
+    }
+
+    if (sa->npts == sa->nalloc) {
+	sa->nalloc = sa->nalloc ? 2 * sa->nalloc : 1024;
+	sa->pts = G_realloc(sa->pts, sa->nalloc * 3 * sizeof(float));
+	sa->norms = G_realloc(sa->norms, sa->nalloc * 3 * sizeof(float));
+	sa->colors = G_realloc(sa->colors, sa->nalloc * 4);
+    }
+
+    FNORM(surf->norms[offset], n);
+
+    if (cobuff)
+	curcolor = gs_mapcolor(cobuff, coloratt, offset);
+
+    if (trbuff) {
+	GET_MAPATT(trbuff, offset, ttr);
+	ktrans = (char)SCALE_ATT(tratt, ttr, 0, 255);
+	ktrans = (char)(255 - ktrans) << 24;
+    }
+
+    c = ktrans | curcolor;
+
+    sa->pts[3 * sa->npts + X] = col * surf->x_mod * surf->xres;
+    sa->pts[3 * sa->npts + Y] =
+	(surf->rows - 1) * surf->yres - row * surf->y_mod * surf->yres;
+    sa->pts[3 * sa->npts + Z] = z * surf->z_exag;
+    sa->norms[3 * sa->npts + X] = n[X];
+    sa->norms[3 * sa->npts + Y] = n[Y];
+    sa->norms[3 * sa->npts + Z] = n[Z];
+    sa->colors[4 * sa->npts + 0] = c & 0xff;
+    sa->colors[4 * sa->npts + 1] = (c >> 8) & 0xff;
+    sa->colors[4 * sa->npts + 2] = (c >> 16) & 0xff;
+    sa->colors[4 * sa->npts + 3] = (c >> 24) & 0xff;
+
+    return *v = sa->npts++;
+}
+
+/*!
+   \brief Draw surface from the cached display list
+
+   The same triangle fans as in gsd_surf_map() are drawn, except that
+   all of them are drawn regardless of the current view, and material
+   changes per vertex are not supported.
+
+   \return 1 if drawn
+   \return 0 if the list could not be created
+ */
+static int gsd_surf_map_cached(geosurf * surf, typbuff * buff,
+			       typbuff * cobuff, gsurf_att * coloratt,
+			       typbuff * trbuff, gsurf_att * tratt,
+			       int curcolor, unsigned int ktrans)
+{
+    surf_cache *c = get_surf_cache(surf);
+    surf_arrays sa;
+    int xcnt, ycnt, row, col, ii, i, prev;
+    int fan[10];
+    static const int drow[10] = { 0, -1, -1, -1, 0, 1, 1, 1, 0, -1 };
+    static const int dcol[10] = { 0, -1, 0, 1, 1, 1, 0, -1, -1, -1 };
+
+    if (c->list) {
+	gsd_execlist(c->list);
+	return 1;
+    }
+
+    if (!(c->list = gsd_genlist()))
+	return 0;
+
+    xcnt = VCOLS(surf);
+    ycnt = VROWS(surf);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.xcnt = xcnt;
+    sa.vert = G_malloc((size_t) (ycnt + 1) * (xcnt + 1) * sizeof(int));
+    for (i = 0; i < (ycnt + 1) * (xcnt + 1); i++)
+	sa.vert[i] = -1;
+
+    for (row = 1; row < ycnt; row += 2) {
+	for (col = 1; col < xcnt; col += 2) {
+	    /* fan center, then the corners around it */
+	    for (ii = 0; ii < 10; ii++)
+		fan[ii] = surf_vertex(surf, &sa, row + drow[ii],
+				      col + dcol[ii], buff, cobuff, coloratt,
+				      trbuff, tratt, curcolor, ktrans);
+	    if (fan[0] < 0)
+		continue;	/* masked */
+
+	    for (ii = 1, prev = -1; ii < 10; ii++) {
+		if (fan[ii] < 0)
+		    continue;
+		if (prev >= 0) {
+		    if (sa.nindex + 3 > sa.nindex_alloc) {
+			sa.nindex_alloc =
+			    sa.nindex_alloc ? 2 * sa.nindex_alloc : 3072;
+			sa.index = G_realloc(sa.index, sa.nindex_alloc *
+					     sizeof(unsigned int));
+		    }
+		    sa.index[sa.nindex++] = fan[0];
+		    sa.index[sa.nindex++] = prev;
+		    sa.index[sa.nindex++] = fan[ii];
+		}
+		prev = fan[ii];
+	    }
+	}
+    }
+
+    G_debug(3, "gsd_surf_map_cached(): id=%d, %d vertices, %d triangles",
+	    surf->gsurf_id, sa.npts, sa.nindex / 3);
+
+    gsd_newlist(c->list, 1);
+    if (sa.nindex)
+	gsd_drawtriangles(sa.nindex, sa.index, sa.pts, sa.norms, sa.colors);
+    gsd_endlist();
+
+    G_free(sa.vert);
+    G_free(sa.pts);
+    G_free(sa.norms);
+    G_free(sa.colors);
+    G_free(sa.index);
+
+    return 1;
+}
+
 /*!
    \brief Draw surface using triangle fan instead of strip
 
@@ -2208,6 +2466,18 @@ int gsd_surf_map(geosurf * surf)
 
     check_material = (check_shin || check_emis || (kem && check_color));
 
+    /* draw from the cached display list unless materials vary */
+    if (!check_material &&
+	gsd_surf_map_cached(surf, buff, check_color ? cobuff : NULL, coloratt,
+			    check_transp ? trbuff : NULL, tratt, curcolor,
+			    ktrans)) {
+	gsd_popmatrix();
+	gsd_blend(0);
+	gsd_zwritemask(0xffffffff);
+
+	return (0);
+    }
+
     /* would also be good to check if colormap == surfmap, to increase speed */
     /* will also need to set check_transp, check_shine, etc & fix material */
     cnt = 0;
@@ -17,7 +17,12 @@
  */
 
 #include <math.h>
+#include <string.h>
 
+#include <grass/config.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 #include <grass/gis.h>
 #include <grass/ogsf.h>
 
@@ -29,6 +34,12 @@
  */
 #define BUFFER_SIZE 1000000
 
+/*!
+   \brief volume file modes holding the whole volume in memory (see gvl_file.c)
+ */
+#define MODE_FULL 2
+#define MODE_PRELOAD 3
+
 /* USEFUL MACROS */
 
 /* interp. */
@@ -73,6 +84,11 @@ int mc33_process_cube(int c_ndx, float *v);
 int Rows, Cols, Depths;
 double ResX, ResY, ResZ;
 
+#ifdef HAVE_PTHREAD_H
+/* color tables are not safe for concurrent lookups */
+static pthread_mutex_t color_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 /************************************************************************/
 /* ISOSURFACES */
 
@@ -472,8 +488,14 @@ void iso_calc_cube(geovol_isosurf * isosurf, int x, int y, int z,
 		tv = LINTERP(d, val[ATT_COLOR][v1], val[ATT_COLOR][v2]);
 	    }
 
+#ifdef HAVE_PTHREAD_H
+	    pthread_mutex_lock(&color_mutex);
+#endif
 	    c = Gvl_get_color_for_value(isosurf->att[ATT_COLOR].att_data,
 					&tv);
+#ifdef HAVE_PTHREAD_H
+	    pthread_mutex_unlock(&color_mutex);
+#endif
 
 	    WRITE(c & RED_MASK);
 	    WRITE((c & GRN_MASK) >> 8);
@@ -575,6 +597,120 @@ void iso_calc_cube(geovol_isosurf * isosurf, int x, int y, int z,
     }
 }
 
+/*!
+   \brief Check if an isosurface can be computed by parts in parallel
+
+   That is when all of it is computed anew, without reading the old
+   data, and all volumes read are held in memory.
+
+   \param isosurf
+
+   \return 1 if it can
+   \return 0 otherwise
+ */
+static int iso_can_split(geovol_isosurf * isosurf)
+{
+    int a, mode;
+
+    if (!isosurf->att[ATT_TOPO].changed)
+	return 0;
+
+    for (a = 1; a < MAX_ATTS; a++) {
+	if (isosurf->att[a].att_src != MAP_ATT)
+	    continue;
+
+	if (a == ATT_TOPO || a == ATT_MASK || isosurf->att[a].changed) {
+	    /* volume read by iso_calc_cube() */
+	    mode = gvl_file_get_volfile(isosurf->att[a].hfile)->mode;
+	    if (mode != MODE_FULL && mode != MODE_PRELOAD)
+		return 0;
+	}
+	else
+	    /* attribute copied from the old data */
+	    return 0;
+    }
+
+    return 1;
+}
+
+typedef struct
+{
+    geovol_isosurf *isosurf;
+    data_buffer *parts;
+    int nparts;
+} iso_job;
+
+/*!
+   \brief Compute parts of an isosurface, each a range of cube layers
+
+   \param first,last range of parts
+   \param closure iso_job
+ */
+static void iso_calc_parts(int first, int last, void *closure)
+{
+    iso_job *job = closure;
+    int p, x, y, z, z0, z1;
+
+    for (p = first; p < last; p++) {
+	data_buffer *dbuff = &job->parts[p];
+
+	z0 = (long)p * (Depths - 1) / job->nparts;
+	z1 = (long)(p + 1) * (Depths - 1) / job->nparts;
+
+	for (z = z0; z < z1; z++)
+	    for (y = 0; y < Rows - 1; y++)
+		for (x = 0; x < Cols - 1; x++)
+		    iso_calc_cube(job->isosurf, x, y, z, dbuff);
+
+	/* close the run of empty cubes, the next part starts a new one */
+	if (dbuff->num_zero != 0) {
+	    WRITE(dbuff->num_zero);
+	    dbuff->num_zero = 0;
+	}
+    }
+}
+
+/*!
+   \brief Compute an isosurface in parallel
+
+   The cube layers are split into parts computed by the worker
+   threads, whose data are concatenated.
+
+   \param isosurf
+   \param[out] dbuff output data buffer
+ */
+static void iso_calc_parallel(geovol_isosurf * isosurf, data_buffer * dbuff)
+{
+    iso_job job;
+    int p, size;
+
+    job.isosurf = isosurf;
+    job.nparts = 4 * (G_num_workers() + 1);
+    if (job.nparts > Depths - 1)
+	job.nparts = Depths - 1;
+    if (job.nparts < 1)
+	return;
+    job.parts = G_calloc(job.nparts, sizeof(data_buffer));
+
+    G_parallel_for(0, job.nparts, 1, iso_calc_parts, &job);
+
+    for (p = size = 0; p < job.nparts; p++)
+	size += job.parts[p].ndx_new;
+
+    dbuff->new = size ? G_malloc(size) : NULL;
+    dbuff->ndx_new = 0;
+    dbuff->num_zero = 0;
+    for (p = 0; p < job.nparts; p++) {
+	if (job.parts[p].ndx_new)
+	    memcpy(dbuff->new + dbuff->ndx_new, job.parts[p].new,
+		   job.parts[p].ndx_new);
+	dbuff->ndx_new += job.parts[p].ndx_new;
+	G_free(job.parts[p].new);
+    }
+
+    G_free(job.parts);
+}
+
 /*!
    \brief Fill data structure with computed isosurfaces polygons
 
@@ -657,18 +793,20 @@ int gvl_isosurf_calc(geovol * gvol)
 
 	/* calc isosurface - marching cubes - start */
 
-	for (z = 0; z < Depths - 1; z++) {
-	    for (y = 0; y < Rows - 1; y++) {
-		for (x = 0; x < Cols - 1; x++) {
-		    for (i = 0; i < gvol->n_isosurfs; i++) {
-			/* recalculate only changed isosurfaces */
-			if (need_update[i]) {
-			    iso_calc_cube(gvol->isosurf[i], x, y, z,
-					  &dbuff[i]);
-			}
-		    }
-		}
+	for (i = 0; i < gvol->n_isosurfs; i++) {
+	    /* recalculate only changed isosurfaces */
+	    if (!need_update[i])
+		continue;
+
+	    if (iso_can_split(gvol->isosurf[i])) {
+		iso_calc_parallel(gvol->isosurf[i], &dbuff[i]);
+		continue;
 	    }
+
+	    for (z = 0; z < Depths - 1; z++)
+		for (y = 0; y < Rows - 1; y++)
+		    for (x = 0; x < Cols - 1; x++)
+			iso_calc_cube(gvol->isosurf[i], x, y, z, &dbuff[i]);
 	}
 
     }
@@ -817,10 +955,10 @@ void gvl_align_data(int pos, unsigned char **data)
  */
 float slice_get_value(geovol * gvl, int x, int y, int z)
 {
-    static double d;
-    static geovol_file *vf;
-    static int type;
-    static float value;
+    double d;
+    geovol_file *vf;
+    int type;
+    float value;
 
     if (x < 0 || y < 0 || z < 0 || (x > gvl->cols - 1) || (y > gvl->rows - 1)
 	|| (z > gvl->depths - 1))
@@ -845,35 +983,35 @@ float slice_get_value(geovol * gvl, int x, int y, int z)
     return value;
 }
 
-/*!
-   \brief Calculate slices
+typedef struct
+{
+    geovol *gvl;
+    geovol_slice *slice;
+    float *x, *y;		/* position of each slice column */
+    float *z;			/* position of each slice row */
+    int rows;
+    float *values;		/* values of the columns, row by row */
+} slice_job;
 
-   \param gvl pointer to geovol struct
-   \param ndx_slc
-   \param colors
+/*!
+   \brief Get the values of a range of slice columns
 
-   \return 1
+   \param first,last range of columns
+   \param closure slice_job
  */
-int slice_calc(geovol * gvl, int ndx_slc, void *colors)
+static void slice_calc_cols(int first, int last, void *closure)
 {
-    int cols, rows, c, r;
-    int i, j, k, pos, color;
+    slice_job *job = closure;
+    geovol *gvl = job->gvl;
+    geovol_slice *slice = job->slice;
+    int c, r, i, j, k;
     int *p_x, *p_y, *p_z;
     float *p_ex, *p_ey, *p_ez;
     float value, v[8];
-    float x, y, z, ei, ej, ek, stepx, stepy, stepz;
-    float f_cols, f_rows, distxy, distz, modxy, modx, mody, modz;
-
-    geovol_slice *slice;
-    geovol_file *vf;
+    float ei, ej, ek;
 
-    slice = gvl->slice[ndx_slc];
-
-    /* set mods, pointer to x, y, z step value */
+    /* set pointer to x, y, z step value */
     if (slice->dir == X) {
-	modx = ResY;
-	mody = ResZ;
-	modz = ResX;
 	p_x = &k;
 	p_y = &i;
 	p_z = &j;
@@ -882,9 +1020,6 @@ int slice_calc(geovol * gvl, int ndx_slc, void *colors)
 	p_ez = &ej;
     }
     else if (slice->dir == Y) {
-	modx = ResX;
-	mody = ResZ;
-	modz = ResY;
 	p_x = &i;
 	p_y = &k;
 	p_z = &j;
@@ -893,9 +1028,6 @@ int slice_calc(geovol * gvl, int ndx_slc, void *colors)
 	p_ez = &ej;
     }
     else {
-	modx = ResX;
-	mody = ResY;
-	modz = ResZ;
 	p_x = &i;
 	p_y = &j;
 	p_z = &k;
@@ -904,64 +1036,23 @@ int slice_calc(geovol * gvl, int ndx_slc, void *colors)
 	p_ez = &ek;
     }
 
-    /* distance between slice def. points */
-    distxy = DISTANCE_2(slice->x2, slice->y2, slice->x1, slice->y1);
-    distz = fabsf(slice->z2 - slice->z1);
-
-    /* distance between slice def points is zero - nothing to do */
-    if (distxy == 0. || distz == 0.) {
-	return (1);
-    }
-
-    /* start reading volume file */
-    vf = gvl_file_get_volfile(gvl->hfile);
-    gvl_file_set_mode(vf, 3);
-    gvl_file_start_read(vf);
-
-    /* set xy resolution */
-    modxy =
-	DISTANCE_2((slice->x2 - slice->x1) / distxy * modx,
-		   (slice->y2 - slice->y1) / distxy * mody, 0., 0.);
-
-    /* cols/rows of slice */
-    f_cols = distxy / modxy;
-    cols = f_cols > (int)f_cols ? (int)f_cols + 1 : (int)f_cols;
-
-    f_rows = distz / modz;
-    rows = f_rows > (int)f_rows ? (int)f_rows + 1 : (int)f_rows;
-
-    /* set x,y initially to first slice point */
-    x = slice->x1;
-    y = slice->y1;
-
-    /* set x,y step */
-    stepx = (slice->x2 - slice->x1) / f_cols;
-    stepy = (slice->y2 - slice->y1) / f_cols;
-    stepz = (slice->z2 - slice->z1) / f_rows;
-
-    /* set position in slice data */
-    pos = 0;
-
     /* loop in slice cols */
-    for (c = 0; c < cols + 1; c++) {
+    for (c = first; c < last; c++) {
 
 	/* convert x, y to integer - index in grid */
-	i = (int)x;
-	j = (int)y;
+	i = (int)job->x[c];
+	j = (int)job->y[c];
 
 	/* distance between index and real position */
-	ei = x - (float)i;
-	ej = y - (float)j;
-
-	/* set z to slice z1 point */
-	z = slice->z1;
+	ei = job->x[c] - (float)i;
+	ej = job->y[c] - (float)j;
 
 	/* loop in slice rows */
-	for (r = 0; r < rows + 1; r++) {
+	for (r = 0; r < job->rows + 1; r++) {
 
 	    /* distance between index and real position */
-	    k = (int)z;
-	    ek = z - (float)k;
+	    k = (int)job->z[r];
+	    ek = job->z[r] - (float)k;
 
 	    /* get interpolated value */
 	    if (slice->mode == SLICE_MODE_INTERP_YES) {
@@ -992,22 +1083,99 @@ int slice_calc(geovol * gvl, int ndx_slc, void *colors)
 		value = slice_get_value(gvl, *p_x, *p_y, *p_z);
 	    }
 
-	    /* translate value to color */
-	    color = Gvl_get_color_for_value(colors, &value);
+	    job->values[(size_t)c * (job->rows + 1) + r] = value;
+	}
+    }
+}
 
-	    /* write color to slice data */
-	    gvl_write_char(pos++, &(slice->data), color & RED_MASK);
-	    gvl_write_char(pos++, &(slice->data), (color & GRN_MASK) >> 8);
-	    gvl_write_char(pos++, &(slice->data), (color & BLU_MASK) >> 16);
+/*!
+   \brief Calculate slices
 
-	    /* step in z */
-	    if (r + 1 > f_rows) {
-		z += stepz * (f_rows - (float)r);
-	    }
-	    else {
-		z += stepz;
-	    }
-	}
+   The values of the slice columns are computed in parallel when the
+   volume is held in memory, then translated to colors.
+
+   \param gvl pointer to geovol struct
+   \param ndx_slc
+   \param colors
+
+   \return 1
+ */
+int slice_calc(geovol * gvl, int ndx_slc, void *colors)
+{
+    int cols, rows, c, r;
+    int pos, color, mode;
+    float x, y, z, stepx, stepy, stepz;
+    float f_cols, f_rows, distxy, distz, modxy, modx, mody, modz;
+
+    geovol_slice *slice;
+    geovol_file *vf;
+    slice_job job;
+
+    slice = gvl->slice[ndx_slc];
+
+    /* set mods */
+    if (slice->dir == X) {
+	modx = ResY;
+	mody = ResZ;
+	modz = ResX;
+    }
+    else if (slice->dir == Y) {
+	modx = ResX;
+	mody = ResZ;
+	modz = ResY;
+    }
+    else {
+	modx = ResX;
+	mody = ResY;
+	modz = ResZ;
+    }
+
+    /* distance between slice def. points */
+    distxy = DISTANCE_2(slice->x2, slice->y2, slice->x1, slice->y1);
+    distz = fabsf(slice->z2 - slice->z1);
+
+    /* distance between slice def points is zero - nothing to do */
+    if (distxy == 0. || distz == 0.) {
+	return (1);
+    }
+
+    /* start reading volume file */
+    vf = gvl_file_get_volfile(gvl->hfile);
+    gvl_file_set_mode(vf, 3);
+    gvl_file_start_read(vf);
+
+    /* set xy resolution */
+    modxy =
+	DISTANCE_2((slice->x2 - slice->x1) / distxy * modx,
+		   (slice->y2 - slice->y1) / distxy * mody, 0., 0.);
+
+    /* cols/rows of slice */
+    f_cols = distxy / modxy;
+    cols = f_cols > (int)f_cols ? (int)f_cols + 1 : (int)f_cols;
+
+    f_rows = distz / modz;
+    rows = f_rows > (int)f_rows ? (int)f_rows + 1 : (int)f_rows;
+
+    /* set x,y step */
+    stepx = (slice->x2 - slice->x1) / f_cols;
+    stepy = (slice->y2 - slice->y1) / f_cols;
+    stepz = (slice->z2 - slice->z1) / f_rows;
+
+    job.gvl = gvl;
+    job.slice = slice;
+    job.rows = rows;
+    job.x = G_malloc((cols + 1) * sizeof(float));
+    job.y = G_malloc((cols + 1) * sizeof(float));
+    job.z = G_malloc((rows + 1) * sizeof(float));
+    job.values = G_malloc((size_t)(cols + 1) * (rows + 1) * sizeof(float));
+
+    /* set x,y initially to first slice point */
+    x = slice->x1;
+    y = slice->y1;
+
+    for (c = 0; c < cols + 1; c++) {
+	job.x[c] = x;
+	job.y[c] = y;
 
 	/* step in x,y */
 	if (c + 1 > f_cols) {
@@ -1020,10 +1188,55 @@ int slice_calc(geovol * gvl, int ndx_slc, void *colors)
 	}
     }
 
+    /* set z to slice z1 point */
+    z = slice->z1;
+
+    for (r = 0; r < rows + 1; r++) {
+	job.z[r] = z;
+
+	/* step in z */
+	if (r + 1 > f_rows) {
+	    z += stepz * (f_rows - (float)r);
+	}
+	else {
+	    z += stepz;
+	}
+    }
+
+    /* the volume is only read concurrently when it is in memory */
+    mode = vf->mode;
+    if (mode == MODE_FULL || mode == MODE_PRELOAD)
+	G_parallel_for(0, cols + 1, 0, slice_calc_cols, &job);
+    else
+	slice_calc_cols(0, cols + 1, &job);
+
     /* end reading volume file */
     gvl_file_end_read(vf);
+
+    /* set position in slice data */
+    pos = 0;
+
+    for (c = 0; c < cols + 1; c++) {
+	for (r = 0; r < rows + 1; r++) {
+	    /* translate value to color */
+	    color = Gvl_get_color_for_value(colors,
+					    &job.values[(size_t)c *
+							(rows + 1) + r]);
+
+	    /* write color to slice data */
+	    gvl_write_char(pos++, &(slice->data), color & RED_MASK);
+	    gvl_write_char(pos++, &(slice->data), (color & GRN_MASK) >> 8);
+	    gvl_write_char(pos++, &(slice->data), (color & BLU_MASK) >> 16);
+	}
+    }
+
     gvl_align_data(pos, &(slice->data));
 
+    G_free(job.x);
+    G_free(job.y);
+    G_free(job.z);
+    G_free(job.values);
+
     return (1);
 }
 
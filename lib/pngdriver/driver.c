@@ -36,6 +36,7 @@ const struct driver *PNG_Driver(void)
     drv.Set_window = PNG_Set_window;
     drv.Begin_raster = PNG_begin_raster;
     drv.Raster = PNG_raster;
+    drv.Raster_columns = PNG_raster_columns;
     drv.End_raster = NULL;
     drv.Begin = PNG_Begin;
     drv.Move = PNG_Move;
@@ -82,6 +82,7 @@ extern void PNG_begin_raster(int, int[2][2], double[2][2]);
 extern int PNG_raster(int, int, const unsigned char *,
 		      const unsigned char *, const unsigned char *,
 		      const unsigned char *);
+extern int PNG_raster_columns(int, unsigned char *);
 extern void PNG_Begin(void);
 extern void PNG_Move(double, double);
 extern void PNG_Cont(double, double);
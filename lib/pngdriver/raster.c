@@ -145,3 +145,32 @@ int PNG_raster(int n, int row,
 
     return next_row(row, d_y1);
 }
+
+/*!
+  \brief Get the cells of a raster row which are drawn
+
+  Only the cells sampled for the visible pixel columns are drawn, the
+  caller may skip the color lookup of the others.
+
+  \param n number of cells
+  \param[out] used set to 1 for the cells which are drawn, 0 otherwise
+
+  \return 1
+*/
+int PNG_raster_columns(int n, unsigned char *used)
+{
+    int x0 = max(png.clip_left - dst[0][0], 0);
+    int x1 = min(png.clip_rite - dst[0][0], ncols);
+    int x;
+
+    memset(used, 0, n);
+
+    for (x = x0; x < x1; x++) {
+	int j = trans[x];
+
+	if (j >= 0 && j < n)
+	    used[j] = 1;
+    }
+
+    return 1;
+}
@@ -37,6 +37,7 @@ const struct driver *PS_Driver(void)
     drv.Set_window = PS_Set_window;
     drv.Begin_raster = PS_begin_raster;
     drv.Raster = PS_raster;
+    drv.Raster_columns = NULL;
     drv.End_raster = PS_end_raster;
     drv.Begin = PS_Begin;
     drv.Move = PS_Move;
@@ -0,0 +1,13 @@
+# -*- coding: utf-8 -*-
+"""GRASS Python benchmarking framework
+
+Runs a standard set of benchmarks of the core libraries and of the most
+used modules on synthetic data, measures the time and the peak memory
+of each run and writes the results as JSON, which can be compared with
+the results of an earlier run to detect regressions.
+
+Copyright (C) 2019 by the GRASS Development Team
+This program is free software under the GNU General Public
+License (>=v2). Read the file COPYING that comes with GRASS GIS
+for details.
+"""
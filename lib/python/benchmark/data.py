@@ -0,0 +1,55 @@
+# -*- coding: utf-8 -*-
+"""Synthetic data for the benchmarks
+
+The data are created in the current mapset with names starting with
+``bench_``. The region is set to a square of the given number of
+cells of size 1, so a projected or XY location has to be used.
+
+Copyright (C) 2019 by the GRASS Development Team
+This program is free software under the GNU General Public
+License (>=v2). Read the file COPYING that comes with GRASS GIS
+for details.
+"""
+
+import grass.script.core as gcore
+
+PREFIX = 'bench_'
+
+ELEVATION = PREFIX + 'elevation'
+COST = PREFIX + 'cost'
+POINTS = PREFIX + 'points'
+AREAS = PREFIX + 'areas'
+
+SEED = 1
+
+
+def set_region(size):
+    """Set the region to size x size cells of size 1"""
+    gcore.run_command('g.region', n=size, s=0, e=size, w=0, res=1,
+                      quiet=True)
+
+
+def create_data(size, points):
+    """Create the input maps of the benchmarks
+
+    :param size: number of rows and columns of raster maps
+    :param points: number of random points
+    """
+    set_region(size)
+    # a repeatable natural looking surface
+    gcore.run_command('r.surf.fractal', output=ELEVATION, seed=SEED,
+                      overwrite=True, quiet=True)
+    gcore.run_command('r.mapcalc', expression='%s = abs(%s) + 1' %
+                      (COST, ELEVATION), overwrite=True, quiet=True)
+    # random points with an attribute table, their Voronoi areas
+    gcore.run_command('v.random', output=POINTS, npoints=points,
+                      seed=SEED, zmin=0, zmax=1000, column='z',
+                      overwrite=True, quiet=True)
+    gcore.run_command('v.voronoi', input=POINTS, output=AREAS,
+                      overwrite=True, quiet=True)
+
+
+def remove_data():
+    """Remove the input maps and outputs of the benchmarks"""
+    gcore.run_command('g.remove', flags='f', type='raster,vector',
+                      pattern=PREFIX + '*', quiet=True)
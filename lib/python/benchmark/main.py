@@ -0,0 +1,88 @@
+# -*- coding: utf-8 -*-
+"""GRASS Python benchmarking framework module for running from command line
+
+Runs the standard benchmark suite in the current mapset, which should
+be in a projected or XY location::
+
+    python -m grass.benchmark.main --output results.json
+    python -m grass.benchmark.main --baseline results.json
+
+The exit status is 1 if a benchmark regressed against the baseline.
+
+Copyright (C) 2019 by the GRASS Development Team
+This program is free software under the GNU General Public
+License (>=v2). Read the file COPYING that comes with GRASS GIS
+for details.
+"""
+
+from __future__ import print_function
+
+import sys
+import json
+import argparse
+
+import grass.script.core as gcore
+
+from .suite import run_suite
+from .runner import compare
+
+
+def print_summary(name, summary):
+    if 'error' in summary:
+        print("%-32s failed" % name)
+        return
+    memory = summary['memory_peak']
+    print("%-32s %10.3f s %12s kB" % (name, summary['time_median'],
+                                     memory if memory is not None else '-'))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Run the GRASS benchmark suite')
+    parser.add_argument('--size', type=int, default=1000,
+                        help='rows and columns of the raster maps')
+    parser.add_argument('--points', type=int, default=10000,
+                        help='number of random points')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='runs of each benchmark')
+    parser.add_argument('--select', default='*',
+                        help='shell pattern of the benchmarks to run')
+    parser.add_argument('--output',
+                        help='JSON file to write the results to')
+    parser.add_argument('--baseline',
+                        help='JSON file with results to compare with')
+    parser.add_argument('--tolerance', type=float, default=0.1,
+                        help='allowed relative growth of time and memory')
+    parser.add_argument('--keep', action='store_true',
+                        help='keep the data and outputs')
+    args = parser.parse_args()
+
+    results = run_suite(size=args.size, points=args.points,
+                        repeat=args.repeat, pattern=args.select,
+                        keep=args.keep, progress=print_summary)
+
+    if args.output:
+        with open(args.output, 'w') as output:
+            json.dump({'version': gcore.version(),
+                       'size': args.size, 'points': args.points,
+                       'repeat': args.repeat, 'results': results},
+                      output, indent=2, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as baseline:
+            old = json.load(baseline)
+        if old.get('size') != args.size or old.get('points') != args.points:
+            gcore.warning("The baseline was run with different data sizes")
+        regressions = compare(results, old.get('results', {}),
+                              args.tolerance)
+        for name, key, before, after in regressions:
+            print("Regression in %s: %s %s -> %s" % (name, key, before,
+                                                     after))
+        if regressions:
+            return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
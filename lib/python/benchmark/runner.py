@@ -0,0 +1,150 @@
+# -*- coding: utf-8 -*-
+"""Running modules with time and peak memory measurement
+
+Copyright (C) 2019 by the GRASS Development Team
+This program is free software under the GNU General Public
+License (>=v2). Read the file COPYING that comes with GRASS GIS
+for details.
+"""
+
+import os
+import sys
+import json
+import time
+import tempfile
+import subprocess
+
+import grass.script.core as gcore
+
+
+def _peak_memory(rusage):
+    """Peak resident set size in kB from resource usage"""
+    # ru_maxrss is in bytes on macOS, in kilobytes elsewhere
+    if sys.platform == 'darwin':
+        return rusage.ru_maxrss // 1024
+    return rusage.ru_maxrss
+
+
+def parse_perf_report(text):
+    """Get the performance report of a module from its error output
+
+    The report is printed by the GRASS libraries when the environment
+    variable GRASS_PERF_REPORT is set to json.
+
+    :returns: dictionary with counters and timers, empty if there is
+              no report
+    """
+    for line in reversed(text.splitlines()):
+        if line.startswith('{"module"'):
+            try:
+                return json.loads(line)
+            except ValueError:
+                break
+    return {}
+
+
+def run_module(module, env=None, **kwargs):
+    """Run a module once and measure it
+
+    The module is run with the performance report of the libraries
+    enabled. Its standard output is discarded.
+
+    :param module: module name
+    :param env: environment variables added for the run
+    :param kwargs: module parameters as for
+                   :func:`grass.script.core.run_command`
+    :returns: dictionary with keys returncode, time (wall clock time in
+              seconds), memory (peak resident set size in kB, None if
+              not available), perf (library counters) and stderr
+    """
+    cmd = gcore.make_command(module, **kwargs)
+    run_env = os.environ.copy()
+    run_env['GRASS_PERF_REPORT'] = 'json'
+    if env:
+        run_env.update(env)
+
+    errfile = tempfile.TemporaryFile()
+    devnull = open(os.devnull, 'w')
+    start = time.time()
+    process = subprocess.Popen(cmd, env=run_env, stdout=devnull,
+                               stderr=errfile)
+    memory = None
+    if hasattr(os, 'wait4'):
+        # resource usage of this process only
+        pid, status, rusage = os.wait4(process.pid, 0)
+        process.returncode = (os.WEXITSTATUS(status)
+                              if os.WIFEXITED(status) else -1)
+        memory = _peak_memory(rusage)
+    else:
+        process.wait()
+    elapsed = time.time() - start
+    devnull.close()
+
+    errfile.seek(0)
+    stderr = errfile.read().decode('utf-8', 'replace')
+    errfile.close()
+
+    return {'returncode': process.returncode, 'time': elapsed,
+            'memory': memory, 'perf': parse_perf_report(stderr),
+            'stderr': stderr}
+
+
+def median(values):
+    """Median of a non-empty list of numbers"""
+    values = sorted(values)
+    n = len(values)
+    if n % 2:
+        return values[n // 2]
+    return (values[n // 2 - 1] + values[n // 2]) / 2.
+
+
+def summarize(runs):
+    """Summarize the runs of a benchmark
+
+    :param runs: list of results of :func:`run_module`
+    :returns: dictionary with the minimum, median and mean time, the
+              largest peak memory and the library counters of the
+              last run, or with the error output if a run failed
+    """
+    failed = [run for run in runs if run['returncode'] != 0]
+    if failed:
+        return {'error': failed[0]['stderr'].strip()}
+
+    times = [run['time'] for run in runs]
+    memory = [run['memory'] for run in runs if run['memory'] is not None]
+    return {'runs': len(runs),
+            'time_min': min(times),
+            'time_median': median(times),
+            'time_mean': sum(times) / len(times),
+            'memory_peak': max(memory) if memory else None,
+            'perf': runs[-1]['perf']}
+
+
+def compare(results, baseline, tolerance=0.1):
+    """Compare benchmark results with a baseline
+
+    A benchmark regressed if its median time or its peak memory grew by
+    more than the tolerance, or if it fails now and did not fail in the
+    baseline. Benchmarks missing in either of the results are ignored.
+
+    :param results: benchmark results by name as written by
+                    :func:`grass.benchmark.suite.run_suite`
+    :param baseline: earlier results of the same form
+    :param tolerance: allowed relative growth
+    :returns: list of (name, quantity, baseline value, new value) of
+              the regressions
+    """
+    regressions = []
+    for name in sorted(results):
+        new = results[name]
+        old = baseline.get(name)
+        if old is None or 'error' in old:
+            continue
+        if 'error' in new:
+            regressions.append((name, 'error', None, new['error']))
+            continue
+        for key in ('time_median', 'memory_peak'):
+            if old.get(key) and new.get(key) and \
+                    new[key] > old[key] * (1 + tolerance):
+                regressions.append((name, key, old[key], new[key]))
+    return regressions
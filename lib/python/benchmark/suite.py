@@ -0,0 +1,119 @@
+# -*- coding: utf-8 -*-
+"""Standard benchmark suite
+
+Each benchmark runs a module on the synthetic data, which exercises a
+part of the libraries: raster row reading and writing with each
+compressor, the segment library, the spatial index, topology building
+and the database interface, and some of the most used modules.
+
+Copyright (C) 2019 by the GRASS Development Team
+This program is free software under the GNU General Public
+License (>=v2). Read the file COPYING that comes with GRASS GIS
+for details.
+"""
+
+import fnmatch
+
+from .data import PREFIX, ELEVATION, COST, POINTS, AREAS
+from .data import create_data, remove_data, set_region
+from .runner import run_module, summarize
+
+COMPRESSORS = ('RLE', 'ZLIB', 'LZ4', 'BZIP2', 'ZSTD')
+
+
+class Benchmark(object):
+    """A module run with given parameters and environment"""
+
+    def __init__(self, name, module, env=None, **kwargs):
+        self.name = name
+        self.module = module
+        self.env = env
+        self.kwargs = kwargs
+
+    def run(self):
+        return run_module(self.module, env=self.env, overwrite=True,
+                          **self.kwargs)
+
+
+def benchmarks(size):
+    """List of the standard benchmarks
+
+    :param size: number of rows and columns of the raster maps
+    """
+    center = '%d,%d' % (size // 2, size // 2)
+    result = []
+
+    # Rast_put_row() and Rast_get_row() with each compressor, the maps
+    # read are those written before
+    for name in COMPRESSORS:
+        suffix = name.lower()
+        copy = PREFIX + 'copy_' + suffix
+        result.append(Benchmark('raster.put_row.' + suffix, 'r.mapcalc',
+                                env={'GRASS_COMPRESSOR': name},
+                                expression='%s = %s' % (copy, ELEVATION)))
+        result.append(Benchmark('raster.get_row.' + suffix, 'r.univar',
+                                map=copy))
+
+    result += [
+        Benchmark('r.mapcalc', 'r.mapcalc',
+                  expression='%smapcalc = sin(%s) * 100 + sqrt(%s)' %
+                  (PREFIX, ELEVATION, COST)),
+        Benchmark('r.neighbors', 'r.neighbors', input=ELEVATION,
+                  output=PREFIX + 'neighbors', size=5, method='average'),
+        Benchmark('r.watershed', 'r.watershed', elevation=ELEVATION,
+                  accumulation=PREFIX + 'accumulation',
+                  drainage=PREFIX + 'drainage', threshold=1000),
+        # Segment_get() through the segmented mode with little memory
+        Benchmark('segment.r.watershed', 'r.watershed', flags='m',
+                  memory=10, elevation=ELEVATION,
+                  accumulation=PREFIX + 'accumulation_seg',
+                  threshold=1000),
+        Benchmark('r.cost', 'r.cost', input=COST,
+                  output=PREFIX + 'cumcost', start_coordinates=center,
+                  memory=10),
+        # Vect_build(), including the spatial index (R-tree)
+        Benchmark('vector.build', 'v.build', map=AREAS),
+        # spatial index queries
+        Benchmark('v.select', 'v.select', ainput=POINTS, binput=AREAS,
+                  output=PREFIX + 'select', operator='overlap'),
+        # dbmi fetch of all rows of a table
+        Benchmark('db.fetch', 'db.select',
+                  sql='SELECT * FROM %s' % POINTS),
+    ]
+
+    return result
+
+
+def run_suite(size=1000, points=10000, repeat=3, pattern='*',
+              keep=False, progress=None):
+    """Create the data and run the benchmarks
+
+    :param size: number of rows and columns of the raster maps
+    :param points: number of random points
+    :param repeat: number of runs of each benchmark
+    :param pattern: shell pattern of the names of the benchmarks to run
+    :param keep: keep the data and outputs
+    :param progress: function called with each benchmark name and summary
+    :returns: dictionary of benchmark summaries by name
+    """
+    results = {}
+    create_data(size, points)
+    try:
+        for bench in benchmarks(size):
+            if not fnmatch.fnmatch(bench.name, pattern):
+                continue
+            set_region(size)
+            runs = []
+            for unused in range(repeat):
+                run = bench.run()
+                runs.append(run)
+                if run['returncode'] != 0:
+                    break
+            results[bench.name] = summarize(runs)
+            if progress:
+                progress(bench.name, results[bench.name])
+    finally:
+        if not keep:
+            remove_data()
+
+    return results
@@ -0,0 +1,82 @@
+# -*- coding: utf-8 -*-
+
+"""
+Tests of the benchmark result handling
+
+@brief Test of GRASS Python benchmarking framework
+
+(C) 2019 by the GRASS Development Team
+This program is free software under the GNU General Public
+License (>=v2). Read the file COPYING that comes with GRASS
+for details.
+"""
+
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+from grass.benchmark.runner import (median, summarize, compare,
+                                    parse_perf_report, run_module)
+
+
+def make_run(time, memory=1000, returncode=0):
+    return {'returncode': returncode, 'time': time, 'memory': memory,
+            'perf': {}, 'stderr': 'ERROR: failed\n' if returncode else ''}
+
+
+class TestSummary(TestCase):
+
+    def test_median(self):
+        self.assertEqual(median([3, 1, 2]), 2)
+        self.assertEqual(median([4, 1, 2, 3]), 2.5)
+
+    def test_summarize(self):
+        summary = summarize([make_run(2, 100), make_run(1, 300),
+                             make_run(3, 200)])
+        self.assertEqual(summary['runs'], 3)
+        self.assertEqual(summary['time_min'], 1)
+        self.assertEqual(summary['time_median'], 2)
+        self.assertEqual(summary['memory_peak'], 300)
+
+    def test_summarize_failure(self):
+        summary = summarize([make_run(1), make_run(1, returncode=1)])
+        self.assertIn('error', summary)
+
+    def test_perf_report(self):
+        text = ('Reading...\n{"module": "r.univar", "counters": '
+                '{"raster.rows_read": 10}, "timers": {}}\n')
+        report = parse_perf_report(text)
+        self.assertEqual(report['counters']['raster.rows_read'], 10)
+        self.assertEqual(parse_perf_report('no report\n'), {})
+
+
+class TestCompare(TestCase):
+
+    baseline = {'a': {'time_median': 1.0, 'memory_peak': 1000},
+                'b': {'time_median': 1.0, 'memory_peak': 1000},
+                'c': {'error': 'failed'}}
+
+    def test_no_regression(self):
+        results = {'a': {'time_median': 1.05, 'memory_peak': 1000},
+                   'b': {'time_median': 0.5, 'memory_peak': 900},
+                   'c': {'error': 'failed'},
+                   'd': {'time_median': 5.0, 'memory_peak': 1000}}
+        self.assertEqual(compare(results, self.baseline, 0.1), [])
+
+    def test_regression(self):
+        results = {'a': {'time_median': 1.5, 'memory_peak': 1000},
+                   'b': {'error': 'failed'}}
+        regressions = compare(results, self.baseline, 0.1)
+        self.assertEqual([(r[0], r[1]) for r in regressions],
+                         [('a', 'time_median'), ('b', 'error')])
+
+
+class TestRunModule(TestCase):
+
+    def test_run(self):
+        run = run_module('g.region', flags='p')
+        self.assertEqual(run['returncode'], 0)
+        self.assertGreater(run['time'], 0)
+
+
+if __name__ == '__main__':
+    test()
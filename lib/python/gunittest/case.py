@@ -798,6 +798,26 @@ class TestCase(unittest.TestCase):
         finally:
             call_module('g.remove', flags='f', type='raster', name=diff)
 
+    def assertRastersEqual(self, actual, reference, msg=None):
+        """Test that `actual` raster has the same values and the same null
+        cells as `reference` raster
+
+        Unlike `assertRastersNoDifference()`, a cell which is null in only
+        one of the two rasters is a difference.
+
+        This method should not be used to test r.mapcalc.
+        """
+        diff = self._get_unique_name('assertRastersEqual_' + actual
+                                     + '_' + reference)
+        expression = ('"{d}" = if(isnull("{a}") != isnull("{r}"), 1, '
+                      'if(isnull("{a}"), 0, "{a}" - "{r}"))').format(
+                          d=diff, a=actual, r=reference)
+        call_module('r.mapcalc', stdin=expression.encode("utf-8"))
+        try:
+            self.assertRasterMinMax(diff, refmin=0, refmax=0, msg=msg)
+        finally:
+            call_module('g.remove', flags='f', type='raster', name=diff)
+
     def assertRasters3dNoDifference(self, actual, reference,
                                     precision, statistics=None, msg=None):
         """Test that `actual` raster is not different from `reference` raster
@@ -227,6 +227,22 @@ class TestRasterMapAssertions(TestCase):
                           statistics=dict(mean=0),
                           msg="The difference of different maps should have huge mean")
 
+    def test_assertRastersEqual(self):
+        """Test that assertRastersEqual compares nulls both ways"""
+        nulls = 'test_assertRastersEqual_nulls'
+        self.runModule('r.mapcalc', expression='{n} = if(elevation > 100, '
+                       'null(), elevation)'.format(n=nulls))
+        try:
+            self.assertRastersEqual(actual='elevation', reference='elevation')
+            self.assertRaises(self.failureException,
+                              self.assertRastersEqual,
+                              actual=nulls, reference='elevation')
+            self.assertRaises(self.failureException,
+                              self.assertRastersEqual,
+                              actual='elevation', reference=nulls)
+        finally:
+            self.runModule('g.remove', flags='f', type='raster', name=nulls)
+
 
 class TestMapExistsAssertions(TestCase):
     # pylint: disable=R0904
@@ -3,7 +3,6 @@ from __future__ import (nested_scopes, generators, division, absolute_import,
                         with_statement, print_function, unicode_literals)
 import os
 import sys
-import multiprocessing as mltp
 import subprocess as sub
 import shutil as sht
 
@@ -16,6 +15,15 @@ from grass.pygrass.utils import get_mapset_raster, findmaps
 
 from grass.pygrass.modules.grid.split import split_region_tiles
 from grass.pygrass.modules.grid.patch import rpatch_map
+from grass.pygrass.modules.grid.scheduler import LocalScheduler
+
+# overlap in cells needed by modules computing from neighbouring cells,
+# a function of the module or a number
+NEIGHBOURHOOD_OVERLAP = {
+    'r.neighbors': lambda mod: (mod.inputs.size.value or 3) // 2,
+    'r.slope.aspect': 1,
+    'r.relief': 1,
+}
 
 
 def select(parms, ptype):
@@ -329,6 +337,48 @@ def get_cmd(cmdd):
     return cmd
 
 
+def get_overlap(module):
+    """Return the overlap in cells needed by a module, 0 for modules
+    computing each cell from the same cell of the inputs.
+
+    :param module: a Module instance
+    :type module: Module object
+
+    >>> get_overlap(Module('r.neighbors', input='ele', output='avg',
+    ...                    size=7, run_=False))
+    3
+    >>> get_overlap(Module('r.slope.aspect', elevation='ele', slope='slp',
+    ...                    run_=False))
+    1
+    """
+    overlap = NEIGHBOURHOOD_OVERLAP.get(module.name, 0)
+    return overlap(module) if callable(overlap) else overlap
+
+
+def crop_outputs(core, rasters, env, shell):
+    """Crop the raster outputs of a tile to the tile without the overlap.
+
+    :param core: a dict with the region parameters of the tile
+                 without the overlap
+    :type core: dict
+    :param rasters: the names of the raster outputs
+    :type rasters: list of str
+    :param env: the environment of the tile mapset
+    :type env: dict
+    :param shell: run the commands through the shell
+    :type shell: bool
+    """
+    lcmd = ['g.region', ]
+    lcmd.extend(["%s=%s" % (k, v) for k, v in core.items()])
+    sub.Popen(lcmd, shell=shell, env=env).wait()
+    for rast in rasters:
+        tmp = rast + '__core'
+        sub.Popen(['r.mapcalc', 'expression=%s = %s' % (tmp, rast), '--o'],
+                  shell=shell, env=env).wait()
+        sub.Popen(['g.rename', 'raster=%s,%s' % (tmp, rast)],
+                  shell=shell, env=env).wait()
+
+
 def cmd_exe(args):
     """Create a mapset, and execute a cmd inside.
 
@@ -348,9 +398,11 @@ def cmd_exe(args):
     - cmd (dict): a dictionary with all the parameter of a GRASS module.
     - groups (list): a list of strings with the groups that we want to copy in
       the mapset.
+    - crop (tuple): None, or the region parameters of the tile without the
+      overlap and the raster outputs to crop to it.
 
     """
-    bbox, mapnames, gisrc_src, gisrc_dst, cmd, groups = args
+    bbox, mapnames, gisrc_src, gisrc_dst, cmd, groups, crop = args
     src, dst = get_mapset(gisrc_src, gisrc_dst)
     env = os.environ.copy()
     env['GISRC'] = gisrc_dst
@@ -372,6 +424,8 @@ def cmd_exe(args):
         copy_groups(groups, gisrc_src, gisrc_dst)
     # run the grass command
     sub.Popen(get_cmd(cmd), shell=shell, env=env).wait()
+    if crop:
+        crop_outputs(crop[0], crop[1], env, shell)
     # remove temp GISRC
     os.remove(gisrc_dst)
 
@@ -386,10 +440,22 @@ class GridModule(object):
     :type width: int
     :param height: height of the tile, in pixel.
     :type height: int
-    :param overlap: overlap between tiles, in pixel.
+    :param overlap: overlap between tiles, in pixel. By default the overlap
+                    needed by the neighbourhood of the command, see
+                    get_overlap().
     :type overlap: int
     :param processes: number of threads, default value is equal to the number
                       of processor available.
+    :param scheduler: runs the tile jobs, a LocalScheduler with processes
+                      by default; see the scheduler module for running the
+                      jobs on other nodes
+    :type scheduler: LocalScheduler, SSHScheduler, QueueScheduler or
+                     MPIScheduler object
+    :param vrt: if True the outputs are virtual rasters (r.buildvrt) of
+                the outputs of the tiles, cropped to the tiles without the
+                overlap, instead of patching them; the tile mapsets are
+                then not removed
+    :type vrt: bool
     :param split: if True use r.tile to split all the inputs.
     :type split: bool
     :param mapset_prefix: if specified created mapsets start with this prefix
@@ -405,18 +471,34 @@ class GridModule(object):
     ...                  elevation='elevation',
     ...                  slope='slope', aspect='aspect', overwrite=True)
     >>> grd.run()
+
+    Run r.neighbors on four hosts, with two jobs on each host::
+
+        >>> from grass.pygrass.modules.grid.scheduler import SSHScheduler
+        >>> grd = GridModule('r.neighbors', width=2000, height=2000,
+        ...                  scheduler=SSHScheduler(['n1', 'n2', 'n3', 'n4'],
+        ...                                         slots=2),
+        ...                  vrt=True, input='elevation', output='avg',
+        ...                  size=9, overwrite=True)  # doctest: +SKIP
+        >>> grd.run()  # doctest: +SKIP
     """
-    def __init__(self, cmd, width=None, height=None, overlap=0, processes=None,
-                 split=False, debug=False, region=None, move=None, log=False,
-                 start_row=0, start_col=0, out_prefix='', mapset_prefix=None,
+    def __init__(self, cmd, width=None, height=None, overlap=None,
+                 processes=None, split=False, debug=False, region=None,
+                 move=None, log=False, start_row=0, start_col=0,
+                 out_prefix='', mapset_prefix=None, scheduler=None, vrt=False,
                  *args, **kargs):
         kargs['run_'] = False
         self.mset = Mapset()
         self.module = Module(cmd, *args, **kargs)
         self.width = width
         self.height = height
+        if overlap is None:
+            overlap = get_overlap(self.module)
         self.overlap = overlap
         self.processes = processes
+        self.scheduler = (scheduler if scheduler
+                          else LocalScheduler(processes))
+        self.vrt = vrt
         self.region = region if region else Region()
         self.start_row = start_row
         self.start_col = start_col
@@ -498,6 +580,11 @@ class GridModule(object):
             ldst, gdst = self.mset.location, self.mset.gisdbase
         cmd = self.module.get_dict()
         groups = [g for g in select(self.module.inputs, 'group')]
+        crop_rasters = None
+        if self.vrt and self.overlap:
+            cores = split_region_tiles(region=self.region,
+                                       width=self.width, height=self.height)
+            crop_rasters = [r for r in select(self.module.outputs, 'raster')]
         for row, box_row in enumerate(self.bboxes):
             for col, box in enumerate(box_row):
                 inms = None
@@ -512,12 +599,19 @@ class GridModule(object):
                 bbox = dict([(k[0], str(v)) for k, v in box.items()[:-2]])
                 bbox['nsres'] = '%f' % reg.nsres
                 bbox['ewres'] = '%f' % reg.ewres
+                crop = None
+                if crop_rasters:
+                    core = dict([(k[0], str(v))
+                                 for k, v in cores[row][col].items()[:-2]])
+                    core['nsres'] = bbox['nsres']
+                    core['ewres'] = bbox['ewres']
+                    crop = (core, crop_rasters)
                 new_mset = self.msetstr % (self.start_row + row,
                                            self.start_col + col),
                 works.append((bbox, inms,
                               self.gisrc_src,
                               write_gisrc(gdst, ldst, new_mset),
-                              cmd, groups))
+                              cmd, groups, crop))
         return works
 
     def define_mapset_inputs(self):
@@ -545,13 +639,7 @@ class GridModule(object):
             for wrk in self.get_works():
                 cmd_exe(wrk)
         else:
-            pool = mltp.Pool(processes=self.processes)
-            result = pool.map_async(cmd_exe, self.get_works())
-            result.wait()
-            pool.close()
-            pool.join()
-            if not result.successful():
-                raise RuntimeError(_("Execution of subprocesses was not successful"))
+            self.scheduler.run(self.get_works())
 
         if patch:
             if self.move:
@@ -583,7 +671,9 @@ class GridModule(object):
                     fil.close()
 
         if clean:
-            self.clean_location()
+            # the virtual rasters refer to the maps of the tile mapsets
+            if not (patch and self.vrt and not self.move):
+                self.clean_location()
             self.rm_tiles()
             if self.n_mset:
                 gisdbase, location = os.path.split(self.move)
@@ -596,6 +686,9 @@ class GridModule(object):
 
     def patch(self):
         """Patch the final results."""
+        if self.vrt:
+            self.build_vrt()
+            return
         bboxes = split_region_tiles(width=self.width, height=self.height)
         loc = Location()
         mset = loc[self.mset.name]
@@ -608,6 +701,20 @@ class GridModule(object):
                            self.module.flags.overwrite,
                            self.start_row, self.start_col, self.out_prefix)
 
+    def build_vrt(self):
+        """Build virtual rasters of the outputs of the tiles."""
+        buildvrt = Module('r.buildvrt')
+        msets = [self.msetstr % (self.start_row + row, self.start_col + col)
+                 for row, box_row in enumerate(self.bboxes)
+                 for col in range(len(box_row))]
+        for otmap in self.module.outputs:
+            otm = self.module.outputs[otmap]
+            if otm.typedesc == 'raster' and otm.value:
+                buildvrt(input=['%s@%s' % (otm.value, mset)
+                                for mset in msets],
+                         output=self.out_prefix + otm.value,
+                         overwrite=self.module.flags.overwrite)
+
     def rm_tiles(self):
         """Remove all the tiles."""
         # if split, remove tiles
@@ -0,0 +1,295 @@
+# -*- coding: utf-8 -*-
+"""
+Schedulers running the tile jobs of a GridModule.
+
+The LocalScheduler runs the jobs in processes on this host. The other
+schedulers run them on other nodes: SSHScheduler on a list of hosts,
+QueueScheduler through the submit command of a job queue (e.g. Slurm)
+and MPIScheduler on the workers of an MPI job. They require that the
+GRASS database is on a file system shared by all nodes and that GRASS
+is installed under the same path on all of them. Each job is written
+to a file in a directory of the shared file system and run there by::
+
+    python -m grass.pygrass.modules.grid.scheduler JOBFILE
+"""
+from __future__ import (nested_scopes, generators, division, absolute_import,
+                        with_statement, print_function, unicode_literals)
+import os
+import sys
+import json
+import shutil as sht
+import threading
+import multiprocessing as mltp
+import subprocess as sub
+
+try:
+    from queue import Queue, Empty
+except ImportError:
+    from Queue import Queue, Empty
+
+try:
+    from shlex import quote
+except ImportError:
+    from pipes import quote
+
+
+# variables needed to start python with GRASS on a node
+START_VARS = ('GISBASE', 'PATH', 'LD_LIBRARY_PATH', 'DYLD_LIBRARY_PATH',
+              'PYTHONPATH')
+
+
+def job_environment():
+    """Return the environment variables passed to the jobs on other nodes:
+    the variables of START_VARS, GIS_LOCK and the GRASS_* variables."""
+    return dict((k, v) for k, v in os.environ.items()
+                if k in START_VARS or k == 'GIS_LOCK' or
+                k.startswith('GRASS_'))
+
+
+def run_job(jobfile):
+    """Run the tile job saved in a job file.
+
+    :param jobfile: path of the job file written by a scheduler
+    :type jobfile: str
+    :returns: the job file
+    """
+    from grass.pygrass.modules.grid.grid import cmd_exe
+
+    with open(jobfile, 'r') as fil:
+        job = json.load(fil)
+    os.environ.update(job['env'])
+    cmd_exe(tuple(job['work']))
+    return jobfile
+
+
+class LocalScheduler(object):
+    """Run the tile jobs in processes on this host.
+
+    :param processes: number of processes, default value is equal to the
+                      number of processors available.
+    :type processes: int
+    """
+    def __init__(self, processes=None):
+        self.processes = processes
+
+    def run(self, works):
+        """Run the jobs and wait for them.
+
+        :param works: the parameters of cmd_exe for each tile
+        :type works: list of tuples
+        """
+        from grass.pygrass.modules.grid.grid import cmd_exe
+
+        pool = mltp.Pool(processes=self.processes)
+        result = pool.map_async(cmd_exe, works)
+        result.wait()
+        pool.close()
+        pool.join()
+        if not result.successful():
+            raise RuntimeError(_("Execution of subprocesses was not successful"))
+
+
+class SharedScheduler(object):
+    """Base class of the schedulers running the tile jobs on other nodes.
+
+    The GISRC files of the jobs and the job files are written to a
+    directory in jobdir, which must be visible under the same path on all
+    nodes, and removed after the run. By default jobdir is the temporary
+    directory of the location of the tile mapsets.
+
+    :param jobdir: directory on the shared file system for the job files
+    :type jobdir: str
+    """
+    def __init__(self, jobdir=None):
+        self.jobdir = jobdir
+        self.rundir = None
+
+    def write_jobs(self, works):
+        """Write a job file for each tile job and return the paths."""
+        from grass.pygrass.modules.grid.grid import read_gisrc
+
+        jobdir = self.jobdir
+        if not jobdir:
+            mset, loc, gisdbase = read_gisrc(works[0][3])
+            jobdir = os.path.join(gisdbase, loc, '.tmp')
+        self.rundir = os.path.join(jobdir, 'grid_%d' % os.getpid())
+        if not os.path.isdir(self.rundir):
+            os.makedirs(self.rundir)
+
+        env = job_environment()
+        gisrc_src = os.path.join(self.rundir, 'gisrc_src')
+        sht.copy(works[0][2], gisrc_src)
+        jobs = []
+        for i, work in enumerate(works):
+            work = list(work)
+            # GISRC files are temporary files of this host
+            gisrc_dst = os.path.join(self.rundir, 'gisrc_%d' % i)
+            sht.move(work[3], gisrc_dst)
+            work[2], work[3] = gisrc_src, gisrc_dst
+            jobfile = os.path.join(self.rundir, 'job_%d.json' % i)
+            with open(jobfile, 'w') as fil:
+                json.dump(dict(work=work, env=env), fil)
+            jobs.append(jobfile)
+        return jobs
+
+    def clean(self):
+        """Remove the job files of the run."""
+        if self.rundir and os.path.isdir(self.rundir):
+            sht.rmtree(self.rundir)
+        self.rundir = None
+
+    def run(self, works):
+        """Run the jobs and wait for them.
+
+        :param works: the parameters of cmd_exe for each tile
+        :type works: list of tuples
+        """
+        jobs = self.write_jobs(works)
+        try:
+            failed = self.run_jobs(jobs)
+        finally:
+            self.clean()
+        if failed:
+            raise RuntimeError(_("Execution of %d tile jobs was not "
+                                 "successful") % failed)
+
+    def run_jobs(self, jobs):
+        """Run the job files, return the number of failed jobs."""
+        raise NotImplementedError
+
+
+class CommandScheduler(SharedScheduler):
+    """Base class of the schedulers starting each job with a command.
+
+    A job is started by a launcher, the beginning of a command line
+    (e.g. ``['ssh', 'node1']``), followed by the shell command running
+    the job as a single argument. The command waits for the job.
+    Each launcher runs one job at a time.
+
+    :param python: the python interpreter on the nodes
+    :type python: str
+    :param jobdir: directory on the shared file system for the job files
+    :type jobdir: str
+    """
+    def __init__(self, python=None, jobdir=None):
+        super(CommandScheduler, self).__init__(jobdir)
+        self.python = python if python else sys.executable
+
+    def launchers(self):
+        """Return the list of launchers."""
+        raise NotImplementedError
+
+    def job_command(self, jobfile):
+        """Return the shell command running a job file."""
+        cmd = ['env', ]
+        cmd.extend(['%s=%s' % (k, os.environ[k])
+                    for k in START_VARS if k in os.environ])
+        cmd.extend([self.python, '-m', __name__, jobfile])
+        return ' '.join(quote(c) for c in cmd)
+
+    def run_jobs(self, jobs):
+        pending = Queue()
+        for job in jobs:
+            pending.put(job)
+        failed = []
+
+        def launch(launcher):
+            while True:
+                try:
+                    job = pending.get_nowait()
+                except Empty:
+                    return
+                if sub.call(launcher + [self.job_command(job)]) != 0:
+                    failed.append(job)
+
+        threads = [threading.Thread(target=launch, args=(launcher, ))
+                   for launcher in self.launchers()]
+        for thr in threads:
+            thr.start()
+        for thr in threads:
+            thr.join()
+        return len(failed)
+
+
+class SSHScheduler(CommandScheduler):
+    """Run the tile jobs on other hosts with ssh.
+
+    :param hosts: the hosts, each host is used by slots jobs at a time
+    :type hosts: list of str
+    :param slots: number of jobs on a host at a time
+    :type slots: int
+    :param ssh: the ssh command with its options
+    :type ssh: list of str
+
+    >>> sched = SSHScheduler(['node1', 'node2'], slots=2)
+    >>> sched.launchers()
+    [['ssh', 'node1'], ['ssh', 'node1'], ['ssh', 'node2'], ['ssh', 'node2']]
+    """
+    def __init__(self, hosts, slots=1, ssh=('ssh', ), python=None,
+                 jobdir=None):
+        super(SSHScheduler, self).__init__(python, jobdir)
+        self.hosts = hosts
+        self.slots = slots
+        self.ssh = list(ssh)
+
+    def launchers(self):
+        return [self.ssh + [host] for host in self.hosts
+                for slot in range(self.slots)]
+
+
+class QueueScheduler(CommandScheduler):
+    """Submit the tile jobs to a job queue.
+
+    The submit command must wait for the job to end and return its exit
+    status, e.g. ``['sbatch', '--wait', '--wrap']`` for Slurm or
+    ``['qsub', '-sync', 'y', '-b', 'y', 'sh', '-c']`` for Grid Engine.
+
+    :param submit: the submit command with its options
+    :type submit: list of str
+    :param max_jobs: number of jobs in the queue at a time
+    :type max_jobs: int
+
+    >>> sched = QueueScheduler(['sbatch', '--wait', '--wrap'], max_jobs=2)
+    >>> sched.launchers()
+    [['sbatch', '--wait', '--wrap'], ['sbatch', '--wait', '--wrap']]
+    """
+    def __init__(self, submit, max_jobs=16, python=None, jobdir=None):
+        super(QueueScheduler, self).__init__(python, jobdir)
+        self.submit = list(submit)
+        self.max_jobs = max_jobs
+
+    def launchers(self):
+        return [self.submit for i in range(self.max_jobs)]
+
+
+class MPIScheduler(SharedScheduler):
+    """Run the tile jobs on the workers of an MPI job with mpi4py.
+
+    The script using the GridModule is started with e.g.
+    ``mpiexec -n 17 python -m mpi4py.futures script.py``, the workers
+    must be started with the GRASS environment (e.g. ``mpiexec -x``
+    with Open MPI).
+
+    :param max_workers: number of workers, by default all workers
+    :type max_workers: int
+    :param jobdir: directory on the shared file system for the job files
+    :type jobdir: str
+    """
+    def __init__(self, max_workers=None, jobdir=None):
+        super(MPIScheduler, self).__init__(jobdir)
+        self.max_workers = max_workers
+
+    def run_jobs(self, jobs):
+        from mpi4py.futures import MPIPoolExecutor
+
+        failed = 0
+        with MPIPoolExecutor(max_workers=self.max_workers) as executor:
+            futures = [executor.submit(run_job, job) for job in jobs]
+            for future in futures:
+                if future.exception() is not None:
+                    failed += 1
+        return failed
+
+
+if __name__ == '__main__':
+    run_job(sys.argv[1])
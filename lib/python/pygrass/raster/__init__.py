@@ -171,6 +171,108 @@ class RasterRow(RasterAbstractBase):
         """
         libraster.Rast_put_row(self._fd, row.p, self._gtype)
 
+    def _block_pointer(self, array, shape):
+        """Return a pointer to the data of a NumPy array used as a block
+        of rows or a tile, checking its shape, type and layout."""
+        if not isinstance(array, np.ndarray):
+            raise TypeError(_("A NumPy array is required"))
+        if array.shape != shape:
+            str_err = _("Array shape {0} does not match {1}")
+            raise ValueError(str_err.format(array.shape, shape))
+        if array.dtype != RTYPE[self.mtype]['numpy']:
+            str_err = _("Array type {0} does not match the {1} map")
+            raise TypeError(str_err.format(array.dtype, self.mtype))
+        if not array.flags['C_CONTIGUOUS']:
+            raise ValueError(_("The array must be C contiguous"))
+        return array.ctypes.data_as(
+            ctypes.POINTER(RTYPE[self.mtype]['ctypes']))
+
+    @must_be_open
+    def get_rows(self, row=0, nrows=None, array=None):
+        """Read a block of rows into a NumPy array with a single call of
+        the `Rast_get_rows` C function, without copies nor Python work per
+        row (the GIL is released while reading).
+
+        :param row: the first row to read
+        :type row: int
+        :param nrows: the number of rows, the remaining rows if None
+        :type nrows: int
+        :param array: a C contiguous array of shape (nrows, cols) and of
+                      the type of the map which is filled in place
+        :type array: numpy.ndarray
+
+        >>> elev = RasterRow(test_raster_name)
+        >>> elev.open()
+        >>> elev.get_rows(1, 2)
+        array([[12, 22, 32, 42],
+               [13, 23, 33, 43]], dtype=int32)
+        >>> elev.close()
+
+        """
+        if nrows is None:
+            nrows = self._rows - row
+        if row < 0 or nrows < 0 or row + nrows > self._rows:
+            raise IndexError(_("Rows {0} to {1} out of range").format(
+                row, row + nrows - 1))
+        if array is None:
+            array = np.empty((nrows, self._cols), RTYPE[self.mtype]['numpy'])
+        pointer = self._block_pointer(array, (nrows, self._cols))
+        libraster.Rast_get_rows(self._fd, pointer, row, nrows, self._gtype)
+        return array
+
+    @must_be_open
+    def put_rows(self, array):
+        """Write the rows of a NumPy array of shape (nrows, cols)
+        sequentially with a single call of the `Rast_put_rows` C function.
+        Arrays of another type or layout are converted first.
+
+        :param array: the rows to write
+        :type array: numpy.ndarray
+        """
+        array = np.ascontiguousarray(array, RTYPE[self.mtype]['numpy'])
+        if array.ndim != 2:
+            raise ValueError(_("A two dimensional array is required"))
+        pointer = self._block_pointer(array, (array.shape[0], self._cols))
+        libraster.Rast_put_rows(self._fd, pointer, array.shape[0],
+                                self._gtype)
+
+    @must_be_open
+    def tile_size(self):
+        """Return the (rows, cols) of the tiles of a map stored in tiles,
+        None for maps stored in rows."""
+        rows, cols = ctypes.c_int(), ctypes.c_int()
+        if not libraster.Rast_get_tile_size(self._fd, ctypes.byref(rows),
+                                            ctypes.byref(cols)):
+            return None
+        return rows.value, cols.value
+
+    @must_be_open
+    def get_tile(self, tile_row, tile_col, array=None):
+        """Read a tile of a map stored in tiles into a NumPy array with
+        the `Rast_get_tile` C function. Tiles are read in the resolution
+        and extent of the map, not of the current region.
+
+        :param tile_row: the row of the tile
+        :type tile_row: int
+        :param tile_col: the column of the tile
+        :type tile_col: int
+        :param array: a C contiguous array of the shape of the tiles and
+                      of the type of the map which is filled in place,
+                      cells of the edge tiles outside of the map are
+                      left unchanged
+        :type array: numpy.ndarray
+        """
+        size = self.tile_size()
+        if size is None:
+            raise TypeError(_("Raster map <{0}> is not stored in "
+                              "tiles").format(self))
+        if array is None:
+            array = np.empty(size, RTYPE[self.mtype]['numpy'])
+        pointer = self._block_pointer(array, size)
+        libraster.Rast_get_tile(self._fd, tile_row, tile_col, pointer,
+                                self._gtype)
+        return array
+
     def open(self, mode=None, mtype=None, overwrite=None):
         """Open the raster if exist or created a new one.
 
@@ -617,7 +719,7 @@ def raster2numpy(rastname, mapset=''):
     :parar str mapset: the name of mapset containig raster map
     """
     with RasterRow(rastname, mapset=mapset, mode='r') as rast:
-        return np.array(rast)
+        return rast.get_rows()
 
 
 def raster2numpy_img(rastname, region, color="ARGB", array=None):
@@ -700,10 +802,7 @@ def numpy2raster(array, mtype, rastname, overwrite=False):
         msg = "Region and array are different: %r != %r"
         raise TypeError(msg % ((reg.rows, reg.cols), array.shape))
     with RasterRow(rastname, mode='w', mtype=mtype, overwrite=overwrite) as new:
-        newrow = Buffer((array.shape[1],), mtype=mtype)
-        for row in array:
-            newrow[:] = row[:]
-            new.put_row(newrow)
+        new.put_rows(array)
 
 if __name__ == "__main__":
 
@@ -4,6 +4,10 @@ Created on Thu Jul 30 18:27:22 2015
 
 @author: lucadelu
 """
+import os
+
+import numpy as np
+
 from grass.gunittest.case import TestCase
 from grass.gunittest.main import test
 from numpy.random import random
@@ -53,5 +57,41 @@ class NumpyTestCase(TestCase):
         numpy2raster(ran, 'FCELL', self.name, True)
         self.assertTrue(check_raster(self.name))
 
+    def test_get_rows(self):
+        with RasterRow(self.name) as rast:
+            block = rast.get_rows(10, 5)
+            self.assertEqual(block.shape, (5, 60))
+            for i in range(5):
+                self.assertTrue((block[i] == rast.get_row(10 + i)).all())
+            array = np.zeros((40, 60), block.dtype)
+            self.assertIs(rast.get_rows(array=array), array)
+            self.assertTrue((array[10:15] == block).all())
+            self.assertRaises(IndexError, rast.get_rows, 38, 5)
+            self.assertRaises(ValueError, rast.get_rows, 0, 2,
+                              np.zeros((2, 59), block.dtype))
+
+    def test_put_rows(self):
+        name = self.name + '_rows'
+        ran = random([40, 60])
+        with RasterRow(name, mode='w', mtype='DCELL',
+                       overwrite=True) as new:
+            new.put_rows(ran[:25])
+            new.put_rows(ran[25:])
+        self.assertTrue(np.allclose(raster2numpy(name), ran))
+        self.runModule("g.remove", flags='f', type='raster', name=name)
+
+    def test_get_tile(self):
+        name = self.name + '_tiles'
+        expected = raster2numpy(self.name)
+        os.environ['GRASS_RASTER_TILE_SIZE'] = '16'
+        self.runModule("r.mapcalc", expression="%s = %s" % (name, self.name),
+                       overwrite=True)
+        del os.environ['GRASS_RASTER_TILE_SIZE']
+        with RasterRow(name) as rast:
+            self.assertEqual(rast.tile_size(), (16, 16))
+            tile = rast.get_tile(1, 2)
+            self.assertTrue((tile == expected[16:32, 32:48]).all())
+        self.runModule("g.remove", flags='f', type='raster', name=name)
+
 if __name__ == '__main__':
     test()
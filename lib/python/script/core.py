@@ -21,6 +21,7 @@ from __future__ import absolute_import, print_function
 
 import os
 import sys
+import time
 import atexit
 import subprocess
 import shutil
@@ -79,6 +80,43 @@ _popen_args = ["bufsize", "executable", "stdin", "stdout", "stderr",
                "preexec_fn", "close_fds", "cwd", "env",
                "universal_newlines", "startupinfo", "creationflags"]
 
+_gisrc_cache = {}
+
+
+def _gisrc_env_cache(env):
+    """Get the value of GRASS_GISRC_CACHE for the GISRC file of env
+
+    Modules started with this variable take the GISRC variables from it
+    instead of reading the file if the file has still the same
+    modification time and size. A file modified in the last two seconds
+    is not cached because it could be modified again without a change
+    of its modification time.
+
+    :param env: environment of the module
+    :returns: the value or None
+    """
+    path = env.get('GISRC')
+    if not path:
+        return None
+    try:
+        info = os.stat(path)
+    except OSError:
+        return None
+    if time.time() - info.st_mtime < 2:
+        return None
+    key = (int(info.st_mtime), info.st_size)
+    cached = _gisrc_cache.get(path)
+    if cached and cached[0] == key:
+        return cached[1]
+    try:
+        with open(path) as gisrc:
+            content = gisrc.read()
+    except (IOError, OSError):
+        return None
+    value = '%d %d\n%s\n%s' % (key[0], key[1], path, content)
+    _gisrc_cache[path] = (key, value)
+    return value
+
 
 def _make_val(val):
     """Convert value to unicode"""
@@ -378,6 +416,12 @@ def start_command(prog, flags="", overwrite=False, quiet=False,
 
     args = make_command(prog, flags, overwrite, quiet, verbose, **options)
 
+    env = popts.get('env') or os.environ
+    cache = _gisrc_env_cache(env)
+    if cache:
+        popts['env'] = dict(env)
+        popts['env']['GRASS_GISRC_CACHE'] = cache
+
     if debug_level() > 0:
         sys.stderr.write("D1/{}: {}.start_command(): {}\n".format(
             debug_level(), __name__,
@@ -2188,6 +2188,177 @@ class AbstractSpaceTimeDataset(AbstractDataset):
 
         return True
 
+    def register_maps(self, maps, dbif=None, chunk_size=100):
+        """Register a list of maps in the space time dataset.
+
+            This method performs the checks of register_map() for each map,
+            but the registered maps are selected once and the SQL
+            statements are executed in transactions of chunk_size maps.
+            The maps must contain the content of the temporal database,
+            as after select(), insert() or update_all(). The space time
+            dataset is not updated, update_from_registered_maps() must
+            be called afterwards.
+
+            Maps that are already registered are skipped with a warning.
+
+            This method raises a FatalError exception in case of a fatal error
+
+           :param maps: A list of AbstractMapDataset objects that should be
+                        registered
+           :param dbif: The database interface to be used
+           :param chunk_size: The number of maps registered in a single
+                              transaction
+           :return: The number of registered maps
+        """
+
+        if get_enable_mapset_check() is True and \
+           self.get_mapset() != get_current_mapset():
+            self.msgr.fatal(_("Unable to register map in dataset <%(ds)s> of "
+                              "type %(type)s. The mapset of the dataset does "
+                              "not match the current mapset") %
+                            {"ds": self.get_id(), "type": self.get_type()})
+
+        dbif, connected = init_dbif(dbif)
+
+        stds_id = self.base.get_id()
+        stds_mapset = self.base.get_mapset()
+        stds_register_table = self.get_map_register()
+        stds_ttype = self.get_temporal_type()
+
+        # Select the ids of all registered maps at once
+        registered = set()
+        if stds_register_table is not None:
+            dbif.execute("SELECT id FROM " + stds_register_table,
+                         mapset=self.base.mapset)
+            rows = dbif.fetchall(mapset=self.base.mapset)
+            if rows:
+                registered = set(row[0] for row in rows)
+
+        if dbif.get_dbmi().paramstyle == "qmark":
+            sql = "INSERT INTO " + stds_register_table + \
+                " (id) " + "VALUES (?);\n"
+        else:
+            sql = "INSERT INTO " + stds_register_table + \
+                " (id) " + "VALUES (%s);\n"
+
+        statement = ""
+        count = 0
+        num_maps = len(maps)
+
+        for map in maps:
+            if count % 50 == 0:
+                self.msgr.percent(count, num_maps, 1)
+
+            map_id = map.base.get_id()
+
+            if not map.check_for_correct_time():
+                dbif.close()
+                if map.get_layer():
+                    self.msgr.fatal(_("Map <%(id)s> with layer %(l)s has "
+                                      "invalid time") % {'id': map.get_map_id(),
+                                                         'l': map.get_layer()})
+                else:
+                    self.msgr.fatal(_("Map <%s> has invalid time") %
+                                    (map.get_map_id()))
+
+            # Check temporal types
+            if stds_ttype != map.get_temporal_type():
+                dbif.close()
+                if map.get_layer():
+                    self.msgr.fatal(_("Temporal type of space time dataset "
+                                      "<%(id)s> and map <%(map)s> with layer "
+                                      "%(l)s are different") %
+                                    {'id': self.get_id(),
+                                     'map': map.get_map_id(),
+                                     'l': map.get_layer()})
+                else:
+                    self.msgr.fatal(_("Temporal type of space time dataset "
+                                      "<%(id)s> and map <%(map)s> are "
+                                      "different") % {'id': self.get_id(),
+                                                      'map': map.get_map_id()})
+
+            map_rel_time_unit = map.get_relative_time_unit()
+
+            # In case no map has been registered yet, set the
+            # relative time unit from the first map
+            if (self.metadata.get_number_of_maps() is None or
+                self.metadata.get_number_of_maps() == 0) and \
+               self.map_counter == 0 and self.is_time_relative():
+
+                self.set_relative_time_unit(map_rel_time_unit)
+                statement += \
+                    self.relative_time.get_update_all_statement_mogrified(dbif)
+
+            # Check the relative time unit
+            if self.is_time_relative() and \
+               self.get_relative_time_unit() != map_rel_time_unit:
+                dbif.close()
+                if map.get_layer():
+                    self.msgr.fatal(_("Relative time units of space time "
+                                      "dataset <%(id)s> and map <%(map)s> "
+                                      "with layer %(l)s are different") %
+                                    {'id': self.get_id(),
+                                     'map': map.get_map_id(),
+                                     'l': map.get_layer()})
+                else:
+                    self.msgr.fatal(_("Relative time units of space time "
+                                      "dataset <%(id)s> and map <%(map)s> "
+                                      "are different") %
+                                    {'id': self.get_id(),
+                                     'map': map.get_map_id()})
+
+            if get_enable_mapset_check() is True and \
+               stds_mapset != map.base.get_mapset():
+                dbif.close()
+                self.msgr.fatal(_("Only maps from the same mapset can be "
+                                  "registered"))
+
+            # Check if map is already registered
+            if map_id in registered:
+                if map.get_layer() is not None:
+                    self.msgr.warning(_("Map <%(map)s> with layer %(l)s is "
+                                        "already registered.") %
+                                      {'map': map.get_map_id(),
+                                       'l': map.get_layer()})
+                else:
+                    self.msgr.warning(_("Map <%s> is already registered.") %
+                                      (map.get_map_id()))
+                continue
+
+            # Register the stds in the map stds register table column,
+            # the register of the map object is up to date
+            datasets = map.stds_register.get_registered_stds()
+            if datasets is not None and datasets.find("@") >= 0:
+                datasets = datasets.split(",")
+            else:
+                datasets = []
+            if stds_id not in datasets:
+                datasets.append(stds_id)
+                map.stds_register.set_registered_stds(",".join(datasets))
+                statement += \
+                    map.stds_register.get_update_statement_mogrified(dbif=dbif)
+
+            # Now put the map name in the stds map register table
+            statement += dbif.mogrify_sql_statement((sql, (map_id,)))
+
+            registered.add(map_id)
+            self.map_counter += 1
+            count += 1
+
+            if count % chunk_size == 0:
+                dbif.execute_transaction(statement)
+                statement = ""
+
+        if statement:
+            dbif.execute_transaction(statement)
+
+        self.msgr.percent(num_maps, num_maps, 1)
+
+        if connected:
+            dbif.close()
+
+        return count
+
     def unregister_map(self, map, dbif=None, execute=True):
         """Unregister a map from the space time dataset.
 
@@ -12,11 +12,17 @@ for details.
 """
 
 from grass.exceptions import FatalError
+import os
 import sys
+import sqlite3
 from multiprocessing import Process, Lock, Pipe
 import logging
 from ctypes import *
 from datetime import datetime
+try:
+    import cPickle as pickle
+except ImportError:
+    import pickle
 import grass.lib.gis as libgis
 import grass.lib.raster as libraster
 import grass.lib.vector as libvector
@@ -963,6 +969,144 @@ def c_library_server(lock, conn):
         functions[data[0]](lock, conn, data)
         lock.release()
 
+class MetadataCache(object):
+    """Persistent cache of the map metadata read by the C-library server
+
+       The results of the requests for a map (existence, info and time
+       stamp) are stored in the SQLite database tgis/c_library_cache.db
+       of the current mapset, so that they are shared by all temporal
+       modules. An entry is valid as long as the files of the map in the
+       spatial database have the same modification times and sizes as
+       when it was stored. Maps of a search path (mapset not set) are not
+       cached.
+
+       The cache is disabled with the environment variable
+       GRASS_TGIS_METADATA_CACHE=0.
+    """
+
+    # Map files read by the server, relative to the mapset directory,
+    # all files of a directory are used
+    map_files = {RPCDefs.TYPE_RASTER: ("cellhd/%s", "cell/%s", "fcell/%s",
+                                       "cell_misc/%s/"),
+                 RPCDefs.TYPE_RASTER3D: ("grid3/%s/",),
+                 RPCDefs.TYPE_VECTOR: ("vector/%s/",)}
+
+    # Number of stored entries written in a single transaction
+    commit_interval = 100
+
+    def __init__(self):
+        self.conn = None
+        self.location = None
+        self.pending = 0
+        self.enabled = os.getenv("GRASS_TGIS_METADATA_CACHE") not in \
+            ("0", "False")
+
+    def _connect(self):
+        """Open the cache database, disable the cache on failure"""
+        try:
+            gisenv = {}
+            with open(os.environ["GISRC"]) as gisrc:
+                for line in gisrc:
+                    key, sep, value = line.partition(":")
+                    gisenv[key.strip()] = value.strip()
+            self.location = os.path.join(gisenv["GISDBASE"],
+                                         gisenv["LOCATION_NAME"])
+            path = os.path.join(self.location, gisenv["MAPSET"], "tgis")
+            if not os.path.isdir(path):
+                os.makedirs(path)
+            self.conn = sqlite3.connect(os.path.join(path,
+                                                     "c_library_cache.db"),
+                                        timeout=10,
+                                        check_same_thread=False)
+            self.conn.execute("PRAGMA synchronous = OFF")
+            self.conn.execute("CREATE TABLE IF NOT EXISTS cache ("
+                              "key TEXT PRIMARY KEY, stamp TEXT, value BLOB)")
+            self.conn.commit()
+        except (KeyError, IOError, OSError, sqlite3.Error):
+            self.enabled = False
+            self.conn = None
+
+    def stamp(self, type, name, mapset):
+        """Return the modification times and sizes of the map files as
+           string, None if the map can not be cached
+        """
+        if not self.enabled or not name or not mapset:
+            return None
+        if self.conn is None:
+            self._connect()
+            if not self.enabled:
+                return None
+
+        mapset_path = os.path.join(self.location, decode(mapset))
+        stamp = []
+        for pattern in self.map_files[type]:
+            path = os.path.join(mapset_path, pattern % decode(name))
+            if path.endswith(os.sep):
+                try:
+                    files = sorted(os.listdir(path))
+                except OSError:
+                    continue
+                paths = [os.path.join(path, file) for file in files]
+            else:
+                paths = [path]
+            for path in paths:
+                try:
+                    st = os.stat(path)
+                except OSError:
+                    continue
+                mtime = getattr(st, "st_mtime_ns", st.st_mtime)
+                stamp.append("%s:%r:%i" % (os.path.basename(path), mtime,
+                                           st.st_size))
+
+        # The map does not exist, or is not stored in this location
+        if not stamp:
+            return None
+
+        return "|".join(stamp)
+
+    def get(self, key, stamp):
+        """Return a tuple (True, value) for a valid entry, else (False, None)
+        """
+        try:
+            row = self.conn.execute("SELECT stamp, value FROM cache "
+                                    "WHERE key = ?", (key,)).fetchone()
+        except sqlite3.Error:
+            return False, None
+        if row is None or row[0] != stamp:
+            return False, None
+        return True, pickle.loads(bytes(row[1]))
+
+    def put(self, key, stamp, value):
+        """Store the value of a request"""
+        try:
+            value = sqlite3.Binary(pickle.dumps(value))
+            self.conn.execute("INSERT OR REPLACE INTO cache VALUES (?, ?, ?)",
+                              (key, stamp, value))
+            self.pending += 1
+            if self.pending >= self.commit_interval:
+                self.commit()
+        except sqlite3.Error:
+            pass
+
+    def commit(self):
+        """Write the stored entries to the database"""
+        if self.conn is not None and self.pending:
+            try:
+                self.conn.commit()
+            except sqlite3.Error:
+                pass
+            self.pending = 0
+
+    def close(self):
+        """Write the stored entries and close the database"""
+        if self.conn is not None:
+            self.commit()
+            self.conn.close()
+            self.conn = None
+
+###############################################################################
+
+
 class CLibrariesInterface(RPCServerBase):
     """Fast and exit-safe interface to GRASS C-libraries functions
 
@@ -1144,6 +1288,40 @@ class CLibrariesInterface(RPCServerBase):
     """
     def __init__(self):
         RPCServerBase.__init__(self)
+        self.metadata_cache = MetadataCache()
+
+    def stop(self):
+        """Write the metadata cache, stop the check thread, the libgis server
+           and close the pipe
+        """
+        self.metadata_cache.close()
+        RPCServerBase.stop(self)
+
+    def _cached_request(self, message, caller):
+        """Send a request about a map to the server, or answer it from
+           the metadata cache
+
+           :param message: The message [function, type, name, mapset, layer]
+           :param caller: The name of the calling method
+           :returns: The answer of the server
+        """
+        function, type, name, mapset, layer = message
+        stamp = self.metadata_cache.stamp(type, name, mapset)
+        if stamp is not None:
+            key = "%i|%i|%s|%s|%s" % (function, type, decode(name),
+                                      decode(mapset), layer)
+            found, value = self.metadata_cache.get(key, stamp)
+            if found:
+                return value
+
+        self.check_server()
+        self.client_conn.send(message)
+        value = self.safe_receive(caller)
+
+        if stamp is not None and value is not None:
+            self.metadata_cache.put(key, stamp, value)
+
+        return value
 
     def start_server(self):
         self.client_conn, self.server_conn = Pipe(True)
@@ -1160,10 +1338,9 @@ class CLibrariesInterface(RPCServerBase):
            :param mapset: The mapset of the map
            :returns: True if exists, False if not
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.MAP_EXISTS, RPCDefs.TYPE_RASTER,
-                               name, mapset, None])
-        return self.safe_receive("raster_map_exists")
+        return self._cached_request(
+            [RPCDefs.MAP_EXISTS, RPCDefs.TYPE_RASTER, name, mapset, None],
+            "raster_map_exists")
 
     def read_raster_info(self, name, mapset):
         """Read the raster map info from the file system and store the content
@@ -1174,10 +1351,9 @@ class CLibrariesInterface(RPCServerBase):
            :returns: The key value pairs of the map specific metadata,
                      or None in case of an error
         """
-        self.check_server()
-        self.client_conn.send([RPCDefs.READ_MAP_INFO, RPCDefs.TYPE_RASTER,
-                               name, mapset, None])
-        return self.safe_receive("read_raster_info")
+        return self._cached_request(
+            [RPCDefs.READ_MAP_INFO, RPCDefs.TYPE_RASTER, name, mapset, None],
+            "read_raster_info")
 
     def read_raster_full_info(self, name, mapset):
         """Read raster info, history and cats using PyGRASS RasterRow
@@ -1202,10 +1378,9 @@ class CLibrariesInterface(RPCServerBase):
            :param mapset: The mapset of the map
            :returns: True if exists, False if not
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.HAS_TIMESTAMP, RPCDefs.TYPE_RASTER,
-                               name, mapset, None])
-        return self.safe_receive("has_raster_timestamp")
+        return self._cached_request(
+            [RPCDefs.HAS_TIMESTAMP, RPCDefs.TYPE_RASTER, name, mapset, None],
+            "has_raster_timestamp")
 
     def remove_raster_timestamp(self, name, mapset):
         """Remove a file based raster timestamp
@@ -1239,10 +1414,9 @@ class CLibrariesInterface(RPCServerBase):
            :param mapset: The mapset of the map
            :returns: The return value of G_read_raster_timestamp
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.READ_TIMESTAMP, RPCDefs.TYPE_RASTER,
-                               name, mapset, None])
-        return self.safe_receive("read_raster_timestamp")
+        return self._cached_request(
+            [RPCDefs.READ_TIMESTAMP, RPCDefs.TYPE_RASTER, name, mapset, None],
+            "read_raster_timestamp")
 
     def write_raster_timestamp(self, name, mapset, timestring):
         """Write a file based raster timestamp
@@ -1270,10 +1444,9 @@ class CLibrariesInterface(RPCServerBase):
            :param mapset: The mapset of the map
            :returns: True if exists, False if not
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.MAP_EXISTS, RPCDefs.TYPE_RASTER3D,
-                               name, mapset, None])
-        return self.safe_receive("raster3d_map_exists")
+        return self._cached_request(
+            [RPCDefs.MAP_EXISTS, RPCDefs.TYPE_RASTER3D, name, mapset, None],
+            "raster3d_map_exists")
 
     def read_raster3d_info(self, name, mapset):
         """Read the 3D raster map info from the file system and store the content
@@ -1284,10 +1457,9 @@ class CLibrariesInterface(RPCServerBase):
            :returns: The key value pairs of the map specific metadata,
                      or None in case of an error
         """
-        self.check_server()
-        self.client_conn.send([RPCDefs.READ_MAP_INFO, RPCDefs.TYPE_RASTER3D,
-                               name, mapset, None])
-        return self.safe_receive("read_raster3d_info")
+        return self._cached_request(
+            [RPCDefs.READ_MAP_INFO, RPCDefs.TYPE_RASTER3D, name, mapset, None],
+            "read_raster3d_info")
 
     def has_raster3d_timestamp(self, name, mapset):
         """Check if a file based 3D raster timestamp exists
@@ -1296,10 +1468,9 @@ class CLibrariesInterface(RPCServerBase):
            :param mapset: The mapset of the map
            :returns: True if exists, False if not
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.HAS_TIMESTAMP, RPCDefs.TYPE_RASTER3D,
-                               name, mapset, None])
-        return self.safe_receive("has_raster3d_timestamp")
+        return self._cached_request(
+            [RPCDefs.HAS_TIMESTAMP, RPCDefs.TYPE_RASTER3D, name, mapset, None],
+            "has_raster3d_timestamp")
 
     def remove_raster3d_timestamp(self, name, mapset):
         """Remove a file based 3D raster timestamp
@@ -1333,10 +1504,9 @@ class CLibrariesInterface(RPCServerBase):
            :param mapset: The mapset of the map
            :returns: The return value of G_read_raster3d_timestamp
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.READ_TIMESTAMP, RPCDefs.TYPE_RASTER3D,
-                               name, mapset, None])
-        return self.safe_receive("read_raster3d_timestamp")
+        return self._cached_request(
+            [RPCDefs.READ_TIMESTAMP, RPCDefs.TYPE_RASTER3D, name, mapset, None],
+            "read_raster3d_timestamp")
 
     def write_raster3d_timestamp(self, name, mapset, timestring):
         """Write a file based 3D raster timestamp
@@ -1364,10 +1534,9 @@ class CLibrariesInterface(RPCServerBase):
            :param mapset: The mapset of the map
            :returns: True if exists, False if not
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.MAP_EXISTS, RPCDefs.TYPE_VECTOR,
-                               name, mapset, None])
-        return self.safe_receive("vector_map_exists")
+        return self._cached_request(
+            [RPCDefs.MAP_EXISTS, RPCDefs.TYPE_VECTOR, name, mapset, None],
+            "vector_map_exists")
 
     def read_vector_info(self, name, mapset):
         """Read the vector map info from the file system and store the content
@@ -1378,10 +1547,9 @@ class CLibrariesInterface(RPCServerBase):
            :returns: The key value pairs of the map specific metadata,
                      or None in case of an error
         """
-        self.check_server()
-        self.client_conn.send([RPCDefs.READ_MAP_INFO, RPCDefs.TYPE_VECTOR,
-                               name, mapset, None])
-        return self.safe_receive("read_vector_info")
+        return self._cached_request(
+            [RPCDefs.READ_MAP_INFO, RPCDefs.TYPE_VECTOR, name, mapset, None],
+            "read_vector_info")
 
     def read_vector_full_info(self, name, mapset):
         """Read vector info using PyGRASS VectorTopo
@@ -1406,10 +1574,9 @@ class CLibrariesInterface(RPCServerBase):
            :param layer: The layer of the vector map
            :returns: True if exists, False if not
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.HAS_TIMESTAMP, RPCDefs.TYPE_VECTOR,
-                               name, mapset, layer])
-        return self.safe_receive("has_vector_timestamp")
+        return self._cached_request(
+            [RPCDefs.HAS_TIMESTAMP, RPCDefs.TYPE_VECTOR, name, mapset, layer],
+            "has_vector_timestamp")
 
     def remove_vector_timestamp(self, name, mapset, layer=None):
         """Remove a file based vector timestamp
@@ -1445,10 +1612,9 @@ class CLibrariesInterface(RPCServerBase):
            :param layer: The layer of the vector map
            :returns: The return value ofG_read_vector_timestamp and the timestamps
        """
-        self.check_server()
-        self.client_conn.send([RPCDefs.READ_TIMESTAMP, RPCDefs.TYPE_VECTOR,
-                               name, mapset, layer])
-        return self.safe_receive("read_vector_timestamp")
+        return self._cached_request(
+            [RPCDefs.READ_TIMESTAMP, RPCDefs.TYPE_VECTOR, name, mapset, layer],
+            "read_vector_timestamp")
 
     def write_vector_timestamp(self, name, mapset, timestring, layer=None):
         """Write a file based vector timestamp
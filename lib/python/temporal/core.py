@@ -503,6 +503,8 @@ def init(raise_fatal_error=False):
 
         - GRASS_TGIS_PROFILE (True, False, 1, 0)
         - GRASS_TGIS_RAISE_ON_ERROR (True, False, 1, 0)
+        - GRASS_TGIS_METADATA_CACHE (True, False, 1, 0), the map metadata
+          cache of the C-library interface is enabled by default
 
         ..warning::
 
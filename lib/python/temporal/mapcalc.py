@@ -17,6 +17,10 @@ from .core import SQLDatabaseInterfaceConnection, get_current_mapset, get_tgis_m
 from .open_stds import open_new_stds, open_old_stds, check_new_stds
 from .datetime_math import time_delta_to_relative_time
 
+# The number of time steps evaluated by a single r.mapcalc process, all
+# output maps of a batch are open at the same time
+_MAPCALC_BATCH_SIZE = 32
+
 ############################################################################
 
 
@@ -193,6 +197,7 @@ def dataset_mapcalculator(inputs, output, type, expression, base, method,
         # Parallel processing
         proc_list = []
         proc_count = 0
+        expr_list = []
 
         # For all samples
         for i in range(num):
@@ -256,11 +261,17 @@ def dataset_mapcalculator(inputs, output, type, expression, base, method,
 
             msgr.verbose(_("Apply mapcalc expression: \"%s\"") % expr)
 
-            # Start the parallel r.mapcalc computation
+            # The raster expressions are evaluated in batches by a single
+            # r.mapcalc process
             if type == "raster":
-                proc_list.append(Process(target=_run_mapcalc2d, args=(expr,)))
-            else:
-                proc_list.append(Process(target=_run_mapcalc3d, args=(expr,)))
+                expr_list.append(expr)
+                if len(expr_list) == _MAPCALC_BATCH_SIZE:
+                    _run_mapcalc2d_batch(expr_list, nprocs, dbif)
+                    expr_list = []
+                continue
+
+            # Start the parallel r3.mapcalc computation
+            proc_list.append(Process(target=_run_mapcalc3d, args=(expr,)))
             proc_list[proc_count].start()
             proc_count += 1
 
@@ -278,6 +289,9 @@ def dataset_mapcalculator(inputs, output, type, expression, base, method,
                 # Empty process list
                 proc_list = []
 
+        if expr_list:
+            _run_mapcalc2d_batch(expr_list, nprocs, dbif)
+
         # Register the new maps in the output space time dataset
         msgr.message(_("Starting map registration in temporal database..."))
 
@@ -292,6 +306,8 @@ def dataset_mapcalculator(inputs, output, type, expression, base, method,
 
         # Insert maps in the temporal database and in the new space time
         # dataset
+        statement = ""
+        register_list = []
         for new_map in map_list:
 
             count += 1
@@ -308,9 +324,12 @@ def dataset_mapcalculator(inputs, output, type, expression, base, method,
                     continue
 
             # Insert map in temporal database
-            new_map.insert(dbif)
+            statement += new_map.insert(dbif, execute=False)
+            register_list.append(new_map)
 
-            new_sp.register_map(new_map, dbif)
+        if statement:
+            dbif.execute_transaction(statement)
+        new_sp.register_maps(register_list, dbif)
 
         # Update the spatio-temporal extent and the metadata table entries
         new_sp.update_from_registered_maps(dbif)
@@ -340,13 +359,19 @@ def dataset_mapcalculator(inputs, output, type, expression, base, method,
 
 ###############################################################################
 
-def _run_mapcalc2d(expr):
-    """Helper function to run r.mapcalc in parallel"""
+def _run_mapcalc2d_batch(expr_list, nprocs, dbif):
+    """Helper function to run the expressions of several time steps in
+       a single r.mapcalc process, that evaluates them in one pass over
+       the rows using nprocs threads"""
     try:
-        gscript.run_command("r.mapcalc", expression=expr,
-                            overwrite=gscript.overwrite(), quiet=True)
+        gscript.write_command("r.mapcalc", flags="b", file="-",
+                              stdin="\n\n".join(expr_list) + "\n",
+                              nprocs=nprocs, overwrite=gscript.overwrite(),
+                              quiet=True)
     except CalledModuleError:
-        exit(1)
+        dbif.close()
+        get_tgis_message_interface().fatal(
+            _("Error while mapcalc computation"))
 
 ###############################################################################
 
@@ -17,20 +17,26 @@ for details.
 :authors: Soeren Gebbert
 """
 from datetime import datetime
+import os
+import threading
 import grass.script as gscript
 from .core import get_tgis_message_interface, init_dbif, get_current_mapset
+from .c_libraries_interface import CLibrariesInterface
 from .open_stds import open_old_stds
 from .abstract_map_dataset import AbstractMapDataset
 from .factory import dataset_factory
 from .datetime_math import check_datetime_string, increment_datetime_by_string, string_to_datetime
 
+# Less maps are not worth starting another C-library server process
+_MIN_MAPS_PER_PROCESS = 20
+
 ###############################################################################
 
 
 def register_maps_in_space_time_dataset(
     type, name, maps=None, file=None, start=None,
     end=None, unit=None, increment=None, dbif=None,
-    interval=False, fs="|", update_cmd_list=True):
+    interval=False, fs="|", update_cmd_list=True, nprocs=None):
     """Use this method to register maps in space time datasets.
 
        Additionally a start time string and an increment string can be
@@ -63,11 +69,20 @@ def register_maps_in_space_time_dataset(
        :param fs: Field separator used in input file
        :param update_cmd_list: If is True, the command that was invoking this
                                process will be written to the process history
+       :param nprocs: The number of processes used to read the metadata of
+                      the maps from the spatial database, by default
+                      the value of GRASS_NPROCS or 1
     """
     start_time_in_file = False
     end_time_in_file = False
     msgr = get_tgis_message_interface()
 
+    if nprocs is None:
+        try:
+            nprocs = int(os.environ.get("GRASS_NPROCS", 1))
+        except ValueError:
+            nprocs = 1
+
     # Make sure the arguments are of type string
     if start != "" and start is not None:
         start = str(start)
@@ -178,12 +193,14 @@ def register_maps_in_space_time_dataset(
 
     num_maps = len(maplist)
     map_object_list = []
-    statement = ""
     # Store the ids of datasets that must be updated
     datatsets_to_modify = {}
 
     msgr.message(_("Gathering map information..."))
 
+    # First pass: query the temporal database and check the time options,
+    # the map metadata is read from the spatial database afterwards
+    entries = []
     for count in range(len(maplist)):
         if count % 50 == 0:
             msgr.percent(count, num_maps, 1)
@@ -191,35 +208,18 @@ def register_maps_in_space_time_dataset(
         # Get a new instance of the map type
         map = dataset_factory(type, maplist[count]["id"])
 
-        if map.map_exists() is not True:
-            msgr.fatal(_("Unable to update %(t)s map <%(id)s>. "
-                         "The map does not exist.") % {'t': map.get_type(),
-                                                       'id': map.get_map_id()})
-
         # Use the time data from file
         if "start" in maplist[count]:
             start = maplist[count]["start"]
         if "end" in maplist[count]:
             end = maplist[count]["end"]
 
-        is_in_db = False
+        entry = {"map": map, "start": start, "end": end, "count": count,
+                 "is_in_db": False, "skip": False}
+        entries.append(entry)
 
         # Put the map into the database
         if not map.is_in_db(dbif):
-            # Break in case no valid time is provided
-            if (start == "" or start is None) and not map.has_grass_timestamp():
-                dbif.close()
-                if map.get_layer():
-                    msgr.fatal(_("Unable to register %(t)s map <%(id)s> with "
-                                 "layer %(l)s. The map has timestamp and "
-                                 "the start time is not set.") % {
-                               't': map.get_type(), 'id': map.get_map_id(),
-                               'l': map.get_layer()})
-                else:
-                    msgr.fatal(_("Unable to register %(t)s map <%(id)s>. The"
-                                 " map has no timestamp and the start time "
-                                 "is not set.") % {'t': map.get_type(),
-                                                   'id': map.get_map_id()})
             if start != "" and start is not None:
                 # We need to check if the time is absolute and the unit was specified
                 time_object = check_datetime_string(start)
@@ -236,7 +236,10 @@ def register_maps_in_space_time_dataset(
                     map.set_time_to_absolute()
 
         else:
-            is_in_db = True
+            entry["is_in_db"] = True
+            # Select information from temporal database
+            map.select(dbif)
+
             # Check the overwrite flag
             if not gscript.overwrite():
                 if map.get_layer():
@@ -252,15 +255,10 @@ def register_maps_in_space_time_dataset(
                                    "<%(id)s>. Overwrite flag is not set.") %
                                  {'t': map.get_type(), 'id': map.get_map_id()})
 
-                # Simple registration is allowed
-                if name:
-                    map_object_list.append(map)
-                # Jump to next map
+                # Simple registration is allowed, jump to next map
+                entry["skip"] = True
                 continue
 
-            # Select information from temporal database
-            map.select(dbif)
-
             # Save the datasets that must be updated
             datasets = map.get_registered_stds(dbif)
             if datasets is not None:
@@ -282,15 +280,43 @@ def register_maps_in_space_time_dataset(
                                    {'t': map.get_type(),
                                     'id': map.get_map_id()})
 
-        # Load the data from the grass file database
-        map.load()
+    # Second pass: load the metadata and time stamps of the maps
+    _load_maps(entries, nprocs)
+
+    for entry in entries:
+        map = entry["map"]
+        if entry["error"] == "missing":
+            dbif.close()
+            msgr.fatal(_("Unable to update %(t)s map <%(id)s>. "
+                         "The map does not exist.") % {'t': map.get_type(),
+                                                       'id': map.get_map_id()})
+        if entry["error"] == "no_timestamp":
+            # Break in case no valid time is provided
+            dbif.close()
+            if map.get_layer():
+                msgr.fatal(_("Unable to register %(t)s map <%(id)s> with "
+                             "layer %(l)s. The map has timestamp and "
+                             "the start time is not set.") % {
+                           't': map.get_type(), 'id': map.get_map_id(),
+                           'l': map.get_layer()})
+            else:
+                msgr.fatal(_("Unable to register %(t)s map <%(id)s>. The"
+                             " map has no timestamp and the start time "
+                             "is not set.") % {'t': map.get_type(),
+                                               'id': map.get_map_id()})
+
+    # Third pass: assign the time and write the maps in chunked transactions
+    statement = ""
+    chunk = 0
+    for entry in entries:
+        map = entry["map"]
+        start = entry["start"]
+        count = entry["count"]
 
-        # Try to read an existing time stamp from the grass spatial database
-        # in case this map wasn't already registered in the temporal database
-        # Read the spatial database time stamp only, if no time stamp was provided for this map
-        # as method argument or in the input file
-        if not is_in_db and not start:
-            map.read_timestamp_from_grass()
+        if entry["skip"]:
+            if name:
+                map_object_list.append(map)
+            continue
 
         # Set the valid time
         if start:
@@ -299,24 +325,23 @@ def register_maps_in_space_time_dataset(
             if start_time_in_file:
                 count = 1
             assign_valid_time_to_map(ttype=map.get_temporal_type(),
-                                     map=map, start=start, end=end, unit=unit,
-                                     increment=increment, mult=count,
-                                     interval=interval)
+                                     map=map, start=start, end=entry["end"],
+                                     unit=unit, increment=increment,
+                                     mult=count, interval=interval)
 
-        if is_in_db:
+        if entry["is_in_db"]:
             #  Gather the SQL update statement
             statement += map.update_all(dbif=dbif, execute=False)
         else:
             #  Gather the SQL insert statement
             statement += map.insert(dbif=dbif, execute=False)
+        chunk += 1
 
         # Sqlite3 performance is better for huge datasets when committing in
         # small chunks
-        if dbif.get_dbmi().__name__ == "sqlite3":
-            if count % 100 == 0:
-                if statement is not None and statement != "":
-                    dbif.execute_transaction(statement)
-                    statement = ""
+        if chunk % _transaction_size(dbif) == 0:
+            dbif.execute_transaction(statement)
+            statement = ""
 
         # Store the maps in a list to register in a space time dataset
         if name:
@@ -328,16 +353,12 @@ def register_maps_in_space_time_dataset(
         msgr.message(_("Registering maps in the temporal database..."))
         dbif.execute_transaction(statement)
 
-    # Finally Register the maps in the space time dataset
+    # Finally Register the maps in the space time dataset, the extent and
+    # granularity of the dataset are computed once below
     if name and map_object_list:
-        count = 0
-        num_maps = len(map_object_list)
         msgr.message(_("Registering maps in the space time dataset..."))
-        for map in map_object_list:
-            if count % 50 == 0:
-                msgr.percent(count, num_maps, 1)
-            sp.register_map(map=map, dbif=dbif)
-            count += 1
+        sp.register_maps(map_object_list, dbif=dbif,
+                         chunk_size=_transaction_size(dbif))
 
     # Update the space time tables
     if name and map_object_list:
@@ -364,6 +385,104 @@ def register_maps_in_space_time_dataset(
     msgr.percent(num_maps, num_maps, 1)
 
 
+###############################################################################
+
+
+def _transaction_size(dbif):
+    """Return the number of maps written in a single transaction"""
+    # Sqlite3 performance is better for huge datasets when committing in
+    # small chunks
+    if dbif.get_dbmi().__name__ == "sqlite3":
+        return 100
+    return 1000
+
+
+def _load_map_entry(entry):
+    """Read the metadata and time stamp of a map from the spatial database
+
+       The result is stored in the "error" key of the entry, None on
+       success, "missing" if the map does not exist and "no_timestamp"
+       if neither a start time nor a time stamp is available.
+    """
+    map = entry["map"]
+    entry["error"] = None
+
+    if map.map_exists() is not True:
+        entry["error"] = "missing"
+        return
+
+    if entry["skip"]:
+        return
+
+    start = entry["start"]
+    if not entry["is_in_db"] and (start == "" or start is None) and \
+       not map.has_grass_timestamp():
+        entry["error"] = "no_timestamp"
+        return
+
+    # Load the data from the grass file database
+    map.load()
+
+    # Try to read an existing time stamp from the grass spatial database
+    # in case this map wasn't already registered in the temporal database
+    # Read the spatial database time stamp only, if no time stamp was
+    # provided for this map as method argument or in the input file
+    if not entry["is_in_db"] and not start:
+        map.read_timestamp_from_grass()
+
+
+def _load_maps(entries, nprocs=1):
+    """Load the metadata of the maps of the registration entries
+
+       The C-library interface serves a single request at a time, hence
+       with nprocs > 1 the maps are distributed over threads that each
+       own an interface with its own server process.
+
+       :param entries: The list of registration entries
+       :param nprocs: The number of server processes to be used
+    """
+    msgr = get_tgis_message_interface()
+    num_maps = len(entries)
+    nprocs = max(1, min(int(nprocs), num_maps // _MIN_MAPS_PER_PROCESS))
+
+    if nprocs == 1:
+        for count in range(num_maps):
+            if count % 50 == 0:
+                msgr.percent(count, num_maps, 1)
+            _load_map_entry(entries[count])
+        return
+
+    def worker(part, ciface):
+        for entry in part:
+            default_ciface = entry["map"].ciface
+            entry["map"].ciface = ciface
+            try:
+                _load_map_entry(entry)
+            finally:
+                # Time stamps are written later by the default interface
+                entry["map"].ciface = default_ciface
+
+    msgr.verbose(_("Reading the map metadata with %i processes") % nprocs)
+    interfaces = [CLibrariesInterface() for i in range(nprocs)]
+    threads = [threading.Thread(target=worker,
+                                args=(entries[i::nprocs], interfaces[i]))
+               for i in range(nprocs)]
+    try:
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+    finally:
+        for ciface in interfaces:
+            ciface.stop()
+
+    for entry in entries:
+        if "error" not in entry:
+            msgr.fatal(_("Unable to read the metadata of %(t)s map <%(id)s>")
+                       % {'t': entry["map"].get_type(),
+                          'id': entry["map"].get_map_id()})
+
+
 ###############################################################################
 
 def assign_valid_time_to_map(ttype, map, start, end, unit, increment=None,
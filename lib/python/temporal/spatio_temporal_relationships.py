@@ -544,25 +544,41 @@ class SpatioTemporalTopologyBuilder(object):
 
         list_ = gis.G_new_ilist()
 
+        # Maps of both lists are only related once, in case of identical
+        # lists the pair (i, j) gives the same relations as (j, i)
+        seen = None
+        if not identical and set(map(id, mapsA)) & set(map(id, mapsB)):
+            seen = set()
+
         for j in range(len(mapsB)):
 
             rect = self._map_to_rect(tree, mapsB[j], spatial)
             vector.RTreeSearch2(tree, rect, list_)
             rtree.RTreeFreeRect(rect)
 
+            B = mapsB[j]
+
             for k in range(list_.contents.n_values):
                 i = list_.contents.value[k] - 1
 
-                # Get the temporal relationship
-                relation = mapsB[j].temporal_relation(mapsA[i])
+                if identical and i > j:
+                    continue
 
                 A = mapsA[i]
-                B = mapsB[j]
-                set_temoral_relationship(A, B, relation)
+
+                if seen is not None:
+                    pair = (min(id(A), id(B)), max(id(A), id(B)))
+                    if pair in seen:
+                        continue
+                    seen.add(pair)
+
+                # Get the temporal relationship
+                relation = B.temporal_relation(A)
+                set_temoral_relationship(A, B, relation, unique=True)
 
                 if spatial is not None:
-                    relation = mapsB[j].spatial_relation(mapsA[i])
-                    set_spatial_relationship(A, B, relation)
+                    relation = B.spatial_relation(A)
+                    set_spatial_relationship(A, B, relation, unique=True)
 
         self._build_internal_iteratable(mapsA, spatial)
         if not identical and mapsB is not None:
@@ -585,183 +601,78 @@ class SpatioTemporalTopologyBuilder(object):
         return len(self._store)
 
     def __contains__(self, _map):
-        return _map in self._store.values()
+        return self._store.get(_map.get_id()) is _map
 
 ###############################################################################
 
 
-def set_temoral_relationship(A, B, relation):
-    if relation == "equal" or relation == "equals":
-        if A != B:
-            if not B.get_equal() or \
-            (B.get_equal() and \
-            A not in B.get_equal()):
-                B.append_equal(A)
-            if not A.get_equal() or \
-            (A.get_equal() and \
-            B not in A.get_equal()):
-                A.append_equal(B)
-    elif relation == "follows":
-        if not B.get_follows() or \
-            (B.get_follows() and \
-            A not in B.get_follows()):
-            B.append_follows(A)
-        if not A.get_precedes() or \
-            (A.get_precedes() and
-            B not in A.get_precedes()):
-            A.append_precedes(B)
-    elif relation == "precedes":
-        if not B.get_precedes() or \
-            (B.get_precedes() and \
-            A not in B.get_precedes()):
-            B.append_precedes(A)
-        if not A.get_follows() or \
-            (A.get_follows() and \
-            B not in A.get_follows()):
-            A.append_follows(B)
-    elif relation == "during" or relation == "starts" or \
-            relation == "finishes":
-        if not B.get_during() or \
-            (B.get_during() and \
-            A not in B.get_during()):
-            B.append_during(A)
-        if not A.get_contains() or \
-            (A.get_contains() and \
-            B not in A.get_contains()):
-            A.append_contains(B)
-        if relation == "starts":
-            if not B.get_starts() or \
-            (B.get_starts() and \
-            A not in B.get_starts()):
-                B.append_starts(A)
-            if not A.get_started() or \
-            (A.get_started() and \
-            B not in A.get_started()):
-                A.append_started(B)
-        if relation == "finishes":
-            if not B.get_finishes() or \
-            (B.get_finishes() and \
-            A not in B.get_finishes()):
-                B.append_finishes(A)
-            if not A.get_finished() or \
-            (A.get_finished() and \
-            B not in A.get_finished()):
-                A.append_finished(B)
-    elif relation == "contains" or relation == "started" or \
-            relation == "finished":
-        if not B.get_contains() or \
-            (B.get_contains() and \
-            A not in B.get_contains()):
-            B.append_contains(A)
-        if not A.get_during() or \
-            (A.get_during() and \
-            B not in A.get_during()):
-            A.append_during(B)
-        if relation == "started":
-            if not B.get_started() or \
-            (B.get_started() and \
-            A not in B.get_started()):
-                B.append_started(A)
-            if not A.get_starts() or \
-            (A.get_starts() and \
-            B not in A.get_starts()):
-                A.append_starts(B)
-        if relation == "finished":
-            if not B.get_finished() or \
-            (B.get_finished() and \
-            A not in B.get_finished()):
-                B.append_finished(A)
-            if not A.get_finishes() or \
-            (A.get_finishes() and \
-            B not in A.get_finishes()):
-                A.append_finishes(B)
-    elif relation == "overlaps":
-        if not B.get_overlaps() or \
-            (B.get_overlaps() and \
-            A not in B.get_overlaps()):
-            B.append_overlaps(A)
-        if not A.get_overlapped() or \
-            (A.get_overlapped() and \
-            B not in A.get_overlapped()):
-            A.append_overlapped(B)
-    elif relation == "overlapped":
-        if not B.get_overlapped() or \
-            (B.get_overlapped() and \
-            A not in B.get_overlapped()):
-            B.append_overlapped(A)
-        if not A.get_overlaps() or \
-            (A.get_overlaps() and \
-            B not in A.get_overlaps()):
-            A.append_overlaps(B)
+# The relations appended to B and A for the relation of B to A
+_temporal_relationships = {
+    "equal": (("equal", "equal"),),
+    "equals": (("equal", "equal"),),
+    "follows": (("follows", "precedes"),),
+    "precedes": (("precedes", "follows"),),
+    "during": (("during", "contains"),),
+    "starts": (("during", "contains"), ("starts", "started")),
+    "finishes": (("during", "contains"), ("finishes", "finished")),
+    "contains": (("contains", "during"),),
+    "started": (("contains", "during"), ("started", "starts")),
+    "finished": (("contains", "during"), ("finished", "finishes")),
+    "overlaps": (("overlaps", "overlapped"),),
+    "overlapped": (("overlapped", "overlaps"),)}
+
+_spatial_relationships = {
+    "equivalent": (("equivalent", "equivalent"),),
+    "overlap": (("overlap", "overlap"),),
+    "meet": (("meet", "meet"),),
+    "contain": (("contain", "in"),),
+    "in": (("in", "contain"),),
+    "cover": (("cover", "covered"),),
+    "covered": (("covered", "cover"),)}
+
+
+def _append_relationships(A, B, pairs, unique):
+    """Append A to the relations of B and B to the relations of A
+
+       :param pairs: The names of the relations of B and A
+       :param unique: If True the pair A, B is known to be new, otherwise
+                      existing entries are not appended again
+    """
+    for relB, relA in pairs:
+        for map_, rel, other in ((B, relB, A), (A, relA, B)):
+            if not unique:
+                entries = getattr(map_, "get_" + rel)()
+                if entries and other in entries:
+                    continue
+            getattr(map_, "append_" + rel)(other)
+
+
+def set_temoral_relationship(A, B, relation, unique=False):
+    """Set the temporal relation of map B to map A in both maps
+
+       :param relation: The temporal relation of B to A
+       :param unique: If True the relations of A and B were not set before,
+                      this avoids the search for existing entries
+    """
+    if (relation == "equal" or relation == "equals") and A == B:
+        return
+    if relation in _temporal_relationships:
+        _append_relationships(A, B, _temporal_relationships[relation], unique)
 
 ###############################################################################
 
-def set_spatial_relationship(A, B, relation):
-
-    if relation == "equivalent":
-        if A != B:
-            if not B.get_equivalent() or \
-            (B.get_equivalent() and \
-            A not in B.get_equivalent()):
-                B.append_equivalent(A)
-            if not A.get_equivalent() or \
-            (A.get_equivalent() and \
-            B not in A.get_equivalent()):
-                A.append_equivalent(B)
-    elif relation == "overlap":
-        if not B.get_overlap() or \
-            (B.get_overlap() and \
-            A not in B.get_overlap()):
-            B.append_overlap(A)
-        if not A.get_overlap() or \
-            (A.get_overlap() and
-            B not in A.get_overlap()):
-            A.append_overlap(B)
-    elif relation == "meet":
-        if not B.get_meet() or \
-            (B.get_meet() and \
-            A not in B.get_meet()):
-            B.append_meet(A)
-        if not A.get_meet() or \
-            (A.get_meet() and
-            B not in A.get_meet()):
-            A.append_meet(B)
-    elif relation == "contain":
-        if not B.get_contain() or \
-            (B.get_contain() and \
-            A not in B.get_contain()):
-            B.append_contain(A)
-        if not A.get_in() or \
-            (A.get_in() and \
-            B not in A.get_in()):
-            A.append_in(B)
-    elif relation == "in":
-        if not B.get_in() or \
-            (B.get_in() and \
-            A not in B.get_in()):
-            B.append_in(A)
-        if not A.get_contain() or \
-            (A.get_contain() and \
-            B not in A.get_contain()):
-            A.append_contain(B)
-    elif relation == "cover":
-        if not B.get_cover() or \
-            (B.get_cover() and \
-            A not in B.get_cover()):
-            B.append_cover(A)
-        if not A.get_covered() or \
-            (A.get_covered() and \
-            B not in A.get_covered()):
-            A.append_covered(B)
-    elif relation == "covered":
-        if not B.get_covered() or \
-            (B.get_covered() and \
-            A not in B.get_covered()):
-            B.append_covered(A)
-        if not A.get_cover() or \
-            (A.get_cover() and \
-            B not in A.get_cover()):
-            A.append_cover(B)
+
+def set_spatial_relationship(A, B, relation, unique=False):
+    """Set the spatial relation of map B to map A in both maps
+
+       :param relation: The spatial relation of B to A
+       :param unique: If True the relations of A and B were not set before,
+                      this avoids the search for existing entries
+    """
+    if relation == "equivalent" and A == B:
+        return
+    if relation in _spatial_relationships:
+        _append_relationships(A, B, _spatial_relationships[relation], unique)
 
 ###############################################################################
 
@@ -389,6 +389,40 @@ class TestRasterRegisterFunctions(TestCase):
         self.assertEqual(unit, "seconds")
 
 
+    def test_absolute_time_strds_nprocs(self):
+        """Test the registration of many maps with absolute time in a
+           space time raster dataset using several processes
+        """
+        names = ["register_map_many_%i" % i for i in range(50)]
+        for name in names:
+            self.runModule("r.mapcalc", overwrite=True, quiet=True,
+                           expression="%s = 1" % name)
+
+        tgis.register_maps_in_space_time_dataset(type="raster", name=self.strds_abs.get_name(),
+                 maps=",".join(names), start="2001-01-01", increment="1 day",
+                 interval=True, nprocs=3)
+
+        map = tgis.RasterDataset(names[49] + "@" + tgis.get_current_mapset())
+        map.select()
+        start, end = map.get_absolute_time()
+        self.assertEqual(start, datetime.datetime(2001, 2, 19))
+        self.assertEqual(end, datetime.datetime(2001, 2, 20))
+        self.assertEqual(map.metadata.get_min(), 1)
+
+        self.strds_abs.select()
+        start, end = self.strds_abs.get_absolute_time()
+        self.assertEqual(start, datetime.datetime(2001, 1, 1))
+        self.assertEqual(end, datetime.datetime(2001, 2, 20))
+        self.assertEqual(self.strds_abs.check_temporal_topology(), True)
+        self.assertEqual(self.strds_abs.get_granularity(), u'1 day')
+        self.assertEqual(self.strds_abs.metadata.get_number_of_maps(), 50)
+
+        self.runModule("t.unregister", type="raster", maps=",".join(names),
+                       quiet=True)
+        self.runModule("g.remove", flags='f', type="raster", name=",".join(names),
+                       quiet=True)
+
+
 class TestVectorRegisterFunctions(TestCase):
 
     @classmethod
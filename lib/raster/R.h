@@ -28,12 +28,18 @@ struct GDAL_link
     GDALRasterBandH band;
     GDALDataType type;
 #endif
+    int block_rows;		/* rows of a GDAL block of the band */
+    unsigned char *strip;	/* rows read at once, see gdal.c */
+    size_t strip_size;
+    int strip_row, strip_rows;
 };
 
 #ifdef HAVE_GDAL
 extern CPLErr Rast_gdal_raster_IO(GDALRasterBandH, GDALRWFlag,
 				  int, int, int, int,
 				  void *, int, int, GDALDataType, int, int);
+extern const unsigned char *Rast__gdal_read_row(struct GDAL_link *, int,
+						int, int, int);
 #endif
 
 struct tileinfo		/* Information for tiles */
@@ -41,16 +47,31 @@ struct tileinfo		/* Information for tiles */
     char *name;			/* Name of open file            */
     char *mapset;		/* Mapset of open file          */
     struct Cell_head cellhd;	/* Cell header                  */
-    struct ilist *clist;	/* columns inside current region */
+    struct ilist *clist;	/* column ranges inside current region,
+				   pairs of first and last + 1 */
+    int row0, row1;		/* window rows the tile may cover */
+    int fd;			/* open while its rows are read, or -1 */
+    void *buf;			/* row read by a worker */
 };
 
 struct R_vrt
 {
     int tilecount;
     struct tileinfo *tileinfo;
-    struct ilist *tlist;
+    struct ilist *tlist;	/* tiles inside current region */
+    int nbands;
+    struct ilist **bands;	/* tiles by band of window rows */
+    struct ilist *open;		/* tiles with an open descriptor */
 };
 
+struct R_readahead;		/* see readahead.c */
+struct R_mmap;			/* see mmap.c */
+struct R_tiles;			/* see tile.c */
+struct R_writebehind;		/* see put_row.c */
+struct R_maskcache;		/* see maskcache.c */
+struct R_rowstats;		/* see rowstats.c */
+struct R_rowcache;		/* see rowcache.c */
+
 struct fileinfo			/* Information for opened cell files */
 {
     int open_mode;		/* see defines below            */
@@ -63,11 +84,14 @@ struct fileinfo			/* Information for opened cell files */
     int reclass_flag;		/* Automatic reclass flag       */
     off_t *row_ptr;		/* File row addresses           */
     COLUMN_MAPPING *col_map;	/* Data to window col mapping   */
+    COLUMN_MAPPING col_contig;	/* col_map[0] if window cols map to
+				   consecutive data cols, else 0 */
     double C1, C2;		/* Data to window row constants */
     int cur_row;		/* Current data row in memory   */
     int null_cur_row;		/* Current null row in memory   */
     int cur_nbytes;		/* nbytes per cell for current row */
     unsigned char *data;	/* Decompressed data buffer     */
+    const unsigned char *cur_data;	/* Current row (data or mmap) */
     int null_fd;		/* Null bitmap fd               */
     unsigned char *null_bits;	/* Null bitmap buffer           */
     int nbytes;			/* bytes per cell               */
@@ -83,6 +107,14 @@ struct fileinfo			/* Information for opened cell files */
     int data_fd;		/* Raster data fd               */
     off_t *null_row_ptr;	/* Null file row addresses      */
     struct R_vrt *vrt;
+    struct R_readahead *readahead;	/* Rows decompressed ahead  */
+    struct R_writebehind *writebehind;	/* Rows pending compression */
+    struct R_mmap *mmap;	/* Memory mapped data file      */
+    struct R_rowcache *row_cache;	/* Session cache of rows */
+    struct R_tiles *tiles;	/* Tile layout of data file     */
+    int overview;		/* Overview level in use, 0: none */
+    struct R_rowstats *rowstats;	/* Per-row statistics           */
+    int rowstats_read;		/* rowstats of old map looked up */
 };
 
 struct R__			/*  Structure of library globals */
@@ -90,10 +122,20 @@ struct R__			/*  Structure of library globals */
     RASTER_MAP_TYPE fp_type;	/* type for writing floating maps */
     int mask_fd;		/* File descriptor for automatic mask   */
     int auto_mask;		/* Flag denoting automatic masking      */
+    struct R_maskcache *mask_cache;	/* Rows of the MASK as bits */
     int want_histogram;
     int nbytes;
     int compression_type;
+    int compress_auto;		/* choose compressor from first rows */
+    double compress_target;	/* MB/s for choosing the compressor */
     int compress_nulls;
+    int read_ahead;		/* default rows to read ahead   */
+    int write_behind;		/* default rows to write behind */
+    int use_mmap;		/* map data files of old maps   */
+    int row_cache_mb;		/* max. size of cached maps, 0: off */
+    int tile_size;		/* tile size for new maps, 0: rows */
+    int use_overviews;		/* read overviews in coarse regions */
+    int use_flowcache;		/* read and write flow derivatives */
     int window_set;		/* Flag: window set?                    */
     int split_window;           /* Separate windows for input and output */
     struct Cell_head rd_window;	/* Window used for input        */
@@ -46,6 +46,8 @@ int Rast__check_for_auto_masking(void)
     if (R__.auto_mask < -1)
 	return R__.auto_mask;
 
+    Rast__release_mask_cache();
+
     /* if(R__.mask_fd > 0) G_free (R__.mask_buf); */
 
     /* look for the existence of the MASK file */
@@ -93,6 +95,7 @@ void Rast_suppress_masking(void)
 	/* G_free (R__.mask_buf); */
 	R__.mask_fd = -1;
     }
+    Rast__release_mask_cache();
     R__.auto_mask = -2;
 }
 
@@ -0,0 +1,219 @@
+/*!
+ * \file lib/raster/cell_table.c
+ *
+ * \brief Raster Library - Hash table of combinations of categories
+ *
+ * A Cell_table holds a value for each key, a combination of the
+ * categories of several maps (e.g. the cells counted by r.stats or the
+ * results of r.cross). It is a hash table with open addressing, which
+ * modules counting on several threads use with one table per thread.
+ *
+ * (C) 2019 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+
+#define MIN_SIZE 1024
+
+static size_t hash_key(const CELL * key, int nkeys)
+{
+    unsigned int h = 2166136261U;
+    int i;
+
+    for (i = 0; i < nkeys; i++) {
+	h ^= (unsigned int)key[i];
+	h *= 16777619U;
+    }
+    h ^= h >> 15;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+
+    return h;
+}
+
+static void alloc_slots(struct Cell_table *t, size_t size)
+{
+    t->size = size;
+    t->used = 0;
+    t->keys = G_malloc(size * t->nkeys * sizeof(CELL));
+    t->values = G_calloc(size, t->value_size);
+    t->full = G_calloc(size, 1);
+    t->last = size;
+}
+
+static void free_slots(struct Cell_table *t)
+{
+    G_free(t->keys);
+    G_free(t->values);
+    G_free(t->full);
+}
+
+/* find the slot of key, or the empty slot for it */
+static size_t find_slot(const struct Cell_table *t, const CELL * key)
+{
+    size_t mask = t->size - 1;
+    size_t i;
+
+    for (i = hash_key(key, t->nkeys) & mask;; i = (i + 1) & mask)
+	if (!t->full[i] ||
+	    memcmp(&t->keys[i * t->nkeys], key, t->nkeys * sizeof(CELL)) == 0)
+	    return i;
+}
+
+static void grow_table(struct Cell_table *t)
+{
+    struct Cell_table old = *t;
+    size_t i;
+
+    alloc_slots(t, 2 * old.size);
+    t->used = old.used;
+
+    for (i = 0; i < old.size; i++) {
+	size_t j;
+
+	if (!old.full[i])
+	    continue;
+	j = find_slot(t, &old.keys[i * old.nkeys]);
+	memcpy(&t->keys[j * t->nkeys], &old.keys[i * old.nkeys],
+	       t->nkeys * sizeof(CELL));
+	memcpy(&t->values[j * t->value_size], &old.values[i * old.value_size],
+	       t->value_size);
+	t->full[j] = 1;
+    }
+
+    free_slots(&old);
+}
+
+/*!
+ * \brief Initialize a Cell_table
+ *
+ * \param t pointer to Cell_table structure
+ * \param nkeys number of categories of a key
+ * \param value_size bytes of the value of a key, may be 0
+ * \param size expected number of keys, 0 if unknown
+ */
+void Rast_init_cell_table(struct Cell_table *t, int nkeys, size_t value_size,
+			  size_t size)
+{
+    size_t n;
+
+    /* at most half of the slots are used */
+    for (n = MIN_SIZE; n < 2 * size; n *= 2) ;
+
+    t->nkeys = nkeys;
+    t->value_size = value_size;
+    alloc_slots(t, n);
+}
+
+/*!
+ * \brief Add a key to a Cell_table
+ *
+ * The value of a new key is set to zero bytes. The value is moved
+ * when further keys are added.
+ *
+ * \param t pointer to Cell_table structure
+ * \param key nkeys categories
+ *
+ * \return pointer to the value of the key
+ */
+void *Rast_add_cell_table_key(struct Cell_table *t, const CELL * key)
+{
+    size_t i;
+
+    /* cells of the same combination are often next to each other */
+    if (t->last < t->size &&
+	memcmp(&t->keys[t->last * t->nkeys], key,
+	       t->nkeys * sizeof(CELL)) == 0)
+	return &t->values[t->last * t->value_size];
+
+    if (2 * (t->used + 1) > t->size)
+	grow_table(t);
+
+    i = find_slot(t, key);
+    if (!t->full[i]) {
+	memcpy(&t->keys[i * t->nkeys], key, t->nkeys * sizeof(CELL));
+	t->full[i] = 1;
+	t->used++;
+    }
+    t->last = i;
+
+    return &t->values[i * t->value_size];
+}
+
+/*!
+ * \brief Find a key in a Cell_table
+ *
+ * Safe to call from several threads as long as no keys are added.
+ *
+ * \param t pointer to Cell_table structure
+ * \param key nkeys categories
+ *
+ * \return pointer to the value of the key
+ * \return NULL if the key is not in the table
+ */
+void *Rast_find_cell_table_key(const struct Cell_table *t, const CELL * key)
+{
+    size_t i = find_slot(t, key);
+
+    return t->full[i] ? &t->values[i * t->value_size] : NULL;
+}
+
+/*!
+ * \brief Get the next key of a Cell_table
+ *
+ * The keys are returned in no particular order. Set <i>slot</i> to 0
+ * before the first call.
+ *
+ * \param t pointer to Cell_table structure
+ * \param[in,out] slot slot of the next key
+ * \param[out] key nkeys categories
+ * \param[out] value value of the key
+ *
+ * \return 1 if a key was found
+ * \return 0 after the last key
+ */
+int Rast_next_cell_table_entry(const struct Cell_table *t, size_t * slot,
+			       const CELL ** key, void **value)
+{
+    size_t i;
+
+    for (i = *slot; i < t->size; i++)
+	if (t->full[i]) {
+	    *key = &t->keys[i * t->nkeys];
+	    *value = &t->values[i * t->value_size];
+	    *slot = i + 1;
+	    return 1;
+	}
+
+    *slot = t->size;
+
+    return 0;
+}
+
+/*!
+ * \brief Memory used by a Cell_table
+ *
+ * \param t pointer to Cell_table structure
+ *
+ * \return bytes of the slots
+ */
+size_t Rast_cell_table_bytes(const struct Cell_table *t)
+{
+    return t->size * (t->nkeys * sizeof(CELL) + t->value_size + 1);
+}
+
+/*!
+ * \brief Free a Cell_table
+ *
+ * \param t pointer to Cell_table structure
+ */
+void Rast_free_cell_table(struct Cell_table *t)
+{
+    free_slots(t);
+}
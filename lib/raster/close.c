@@ -177,6 +177,12 @@ static int close_old(int fd)
        This is obsolete since now the mask_bus is always allocated
      */
 
+    Rast__close_read_ahead(fd);
+    Rast__close_mmap(fd);
+    Rast__close_row_cache(fd);
+    Rast__close_tiles(fd);
+    Rast__close_row_stats(fd);
+
     if (fcb->gdal)
 	Rast_close_gdal_link(fcb->gdal);
     if (fcb->vrt)
@@ -395,6 +401,9 @@ static int close_new(int fd, int ok)
 	    fcb->data = NULL;
 	}
 
+	/* write rows still pending compression */
+	Rast__close_write_behind(fd);
+
 	if (fcb->null_row_ptr) {			/* compressed nulls */
 	    fcb->null_row_ptr[fcb->cellhd.rows] = lseek(fcb->null_fd, 0L, SEEK_CUR);
 	    Rast__write_null_row_ptrs(fd, fcb->null_fd);
@@ -435,7 +444,14 @@ static int close_new(int fd, int ok)
 	    remove(path); /* again ? */
 	}			/* null_cur_row > 0 */
 
-	if (fcb->open_mode == OPEN_NEW_COMPRESSED) {	/* auto compression */
+	Rast__remove_tile_format(fcb->name);
+	Rast_remove_overviews(fcb->name);
+	Rast_remove_flowcache(fcb->name);
+	Rast__write_row_stats(fd);
+
+	if (fcb->tiles)
+	    Rast__close_tiles_write(fd);
+	else if (fcb->open_mode == OPEN_NEW_COMPRESSED) {	/* auto compression */
 	    fcb->row_ptr[fcb->cellhd.rows] = lseek(fcb->data_fd, 0L, SEEK_CUR);
 	    Rast__write_row_ptrs(fd);
 	}
@@ -466,6 +482,10 @@ static int close_new(int fd, int ok)
     }				/* ok */
     /* NOW CLOSE THE FILE DESCRIPTOR */
 
+    Rast__close_write_behind(fd);
+    Rast__close_tiles(fd);
+    Rast__close_row_stats(fd);
+
     sync_and_close(fcb->data_fd,
                    (fcb->map_type == CELL_TYPE ? "cell" : "fcell"),
 		   fcb->name);
@@ -504,6 +524,8 @@ static int close_new(int fd, int ok)
 	else {
 	    remove(fcb->temp_name);
 	}
+	G_element_index_changed("cell", fcb->mapset);
+	G_element_index_changed(CELL_DIR, fcb->mapset);
     }
 
     if (fcb->temp_name != NULL) {
@@ -560,6 +582,12 @@ void Rast__close_null(int fd)
 
     G_free(fcb->null_temp_name);
 
+    /* the overviews, flow derivatives and row statistics have the
+       old nulls */
+    Rast_remove_overviews(fcb->name);
+    Rast_remove_flowcache(fcb->name);
+    Rast_remove_row_stats(fcb->name);
+
     G_free(fcb->name);
     G_free(fcb->mapset);
 
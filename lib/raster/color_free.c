@@ -81,6 +81,7 @@ void Rast__color_free_fp_lookup(struct _Color_Info_ *cp)
     if (cp->fp_lookup.active) {
 	G_free(cp->fp_lookup.vals);
 	G_free(cp->fp_lookup.rules);
+	G_free(cp->fp_lookup.bins);
 	cp->fp_lookup.active = 0;
 	cp->fp_lookup.nalloc = 0;
     }
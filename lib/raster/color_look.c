@@ -178,6 +178,92 @@ static int less(double x, double y)
 	return 0;
 }
 
+/*!
+ * \brief Bin of the fp lookup index (internal use only)
+ *
+ * \param cp pointer to _Color_Info structure with an active fp lookup
+ * index
+ * \param val value within the range of the fp lookup table
+ *
+ * \return bin number
+ */
+int Rast__color_fp_bin(const struct _Color_Info_ *cp, DCELL val)
+{
+    DCELL b = (val - cp->fp_lookup.vals[0]) * cp->fp_lookup.bin_scale;
+
+    if (b < 0)
+	return 0;
+    if (b >= cp->fp_lookup.nbins)
+	return cp->fp_lookup.nbins - 1;
+
+    return (int)b;
+}
+
+/* binary search of the interval containing val */
+static struct _Color_Rule_ *fp_search_rule(const struct _Color_Info_ *cp,
+					   DCELL val)
+{
+    int max_ind, min_ind, try;
+    int (*lower)();
+
+    try = (cp->fp_lookup.nalloc - 1) / 2;
+    min_ind = 0;
+    max_ind = cp->fp_lookup.nalloc - 2;
+    while (1) {
+	/* when the rule for the interval is NULL, we exclude the end points.
+	   when it exists, we include the end-points */
+	if (cp->fp_lookup.rules[try])
+	    lower = less;
+	else
+	    lower = less_or_equal;
+
+	if (lower(cp->fp_lookup.vals[try + 1], val)) {	/* recurse to the second half */
+	    min_ind = try + 1;
+	    /* must be still < nalloc-1, since number is within the range */
+	    try = (max_ind + min_ind) / 2;
+	    if (min_ind > max_ind)
+		return NULL;
+	    continue;
+	}
+	if (lower(val, cp->fp_lookup.vals[try])) {	/* recurse to the second half */
+	    max_ind = try - 1;
+	    /* must be still >= 0, since number is within the range */
+	    try = (max_ind + min_ind) / 2;
+	    if (max_ind < min_ind)
+		return NULL;
+	    continue;
+	}
+	return cp->fp_lookup.rules[try];
+    }
+}
+
+/* rule of the interval containing val: values strictly inside an
+   interval are found through the bin index, values outside of the
+   table have no rule, and only values on the end points of the
+   intervals (which may belong to two rules) need the binary search */
+static struct _Color_Rule_ *fp_find_rule(const struct _Color_Info_ *cp,
+					 DCELL val)
+{
+    const DCELL *vals = cp->fp_lookup.vals;
+    int last = cp->fp_lookup.nalloc - 2;
+    int i;
+
+    if (val < vals[0] || val > vals[last + 1])
+	return NULL;
+
+    if (cp->fp_lookup.nbins == 0)
+	return fp_search_rule(cp, val);
+
+    i = cp->fp_lookup.bins[Rast__color_fp_bin(cp, val)];
+    while (i < last && vals[i + 1] < val)
+	i++;
+
+    if (vals[i] < val && val < vals[i + 1])
+	return cp->fp_lookup.rules[i];
+
+    return fp_search_rule(cp, val);
+}
+
 /*!
  * \brief Lookup an array of colors
  *
@@ -205,8 +291,7 @@ void Rast__lookup_colors(const void *raster, unsigned char *red,
     int invert;
     int found, r, g, b;
     int cell_type;
-    int lookup, max_ind, min_ind, try;
-    int (*lower)();
+    int lookup;
     size_t size = Rast_cell_size(data_type);
 
     if (mod)
@@ -328,48 +413,8 @@ void Rast__lookup_colors(const void *raster, unsigned char *red,
 	    continue;
 
 	/* if floating point lookup table is active, look up in there */
-	if (cp->fp_lookup.active) {
-	    try = (cp->fp_lookup.nalloc - 1) / 2;
-	    min_ind = 0;
-	    max_ind = cp->fp_lookup.nalloc - 2;
-	    while (1) {
-		/* when the rule for the interval is NULL, we exclude the end points.
-		   when it exists, we include the end-points */
-		if (cp->fp_lookup.rules[try])
-		    lower = less;
-		else
-		    lower = less_or_equal;
-		/* DEBUG
-		   fprintf (stderr, "%d %d %d %lf %lf %lf\n", min_ind, try, max_ind,
-		   cp->fp_lookup.vals[try-1],
-		   val,
-		   cp->fp_lookup.vals[try]);
-		 */
-
-		if (lower(cp->fp_lookup.vals[try + 1], val)) {	/* recurse to the second half */
-		    min_ind = try + 1;
-		    /* must be still < nalloc-1, since number is within the range */
-		    try = (max_ind + min_ind) / 2;
-		    if (min_ind > max_ind) {
-			rule = NULL;
-			break;
-		    }
-		    continue;
-		}
-		if (lower(val, cp->fp_lookup.vals[try])) {	/* recurse to the second half */
-		    max_ind = try - 1;
-		    /* must be still >= 0, since number is within the range */
-		    try = (max_ind + min_ind) / 2;
-		    if (max_ind < min_ind) {
-			rule = NULL;
-			break;
-		    }
-		    continue;
-		}
-		rule = cp->fp_lookup.rules[try];
-		break;
-	    }
-	}
+	if (cp->fp_lookup.active)
+	    rule = fp_find_rule(cp, val);
 	else {
 	    /* find the [low:high] rule that applies */
 	    for (rule = cp->rules; rule; rule = rule->next) {
@@ -1,12 +1,19 @@
 #include <stdlib.h>
+#include <math.h>
 
 #include <grass/gis.h>
 #include <grass/raster.h>
 
 #define LOOKUP_COLORS 2048
 
+/* bins of the fp lookup index per interval, see GRASS_COLOR_LUT_BINS */
+#define BINS_PER_INTERVAL 4
+#define MIN_BINS 1024
+#define MAX_BINS (1 << 20)
+
 static void organize_lookup(struct Colors *, int);
 static int organize_fp_lookup(struct Colors *, int);
+static void organize_fp_bins(struct _Color_Info_ *);
 static int double_comp(const void *, const void *);
 
 void Rast__organize_colors(struct Colors *colors)
@@ -88,11 +95,63 @@ static int organize_fp_lookup(struct Colors *colors, int mod)
 	 */
 	cp->fp_lookup.rules[i] = rule;
     }
+
+    organize_fp_bins(cp);
+
     cp->fp_lookup.active = 1;
 
     return 0;
 }
 
+/* Index of the fp lookup table: the value range is divided into equal
+   bins, and for each bin the first interval not ending below it is
+   stored, so that Rast__lookup_colors() finds the interval of most
+   values with a few comparisons instead of a binary search. The
+   number of bins can be set with GRASS_COLOR_LUT_BINS, 0 disables
+   the index. */
+static void organize_fp_bins(struct _Color_Info_ *cp)
+{
+    const DCELL *vals = cp->fp_lookup.vals;
+    int nvals = cp->fp_lookup.nalloc;
+    DCELL range;
+    const char *env;
+    int nbins, i, b;
+
+    cp->fp_lookup.bins = NULL;
+    cp->fp_lookup.nbins = 0;
+    cp->fp_lookup.bin_scale = 0;
+
+    if (nvals < 3)
+	return;
+
+    range = vals[nvals - 1] - vals[0];
+    if (!(range > 0) || !isfinite(range))
+	return;
+
+    env = getenv("GRASS_COLOR_LUT_BINS");
+    if (env && *env)
+	nbins = atoi(env);
+    else {
+	nbins = BINS_PER_INTERVAL * (nvals - 1);
+	if (nbins < MIN_BINS)
+	    nbins = MIN_BINS;
+    }
+    if (nbins > MAX_BINS)
+	nbins = MAX_BINS;
+    if (nbins <= 0)
+	return;
+
+    cp->fp_lookup.nbins = nbins;
+    cp->fp_lookup.bin_scale = nbins / range;
+    cp->fp_lookup.bins = G_malloc(nbins * sizeof(int));
+
+    for (b = i = 0; b < nbins; b++) {
+	while (i < nvals - 2 && Rast__color_fp_bin(cp, vals[i + 1]) < b)
+	    i++;
+	cp->fp_lookup.bins[b] = i;
+    }
+}
+
 static void organize_lookup(struct Colors *colors, int mod)
 {
     int i, n;
@@ -0,0 +1,453 @@
+/*!
+   \file lib/raster/flowcache.c
+
+   \brief Raster library - Cache of flow derivatives of elevation maps
+
+   Hydrological modules compute the same flow directions and flow
+   accumulation of an elevation map again and again. A module can store
+   what it computed in cell_misc/name of the elevation map and reuse it
+   in a later run instead of computing it anew.
+
+   An entry of the cache is a data file with one record per row: the
+   flow directions (one signed char per cell, in the encoding of the
+   module) followed by the flow accumulation (one DCELL per cell, null
+   where the elevation is null). The data file is in native byte order
+   and is not meant to be copied to other machines. Its metadata
+   (flowcache_id_meta) record the method, the region and a stamp of the
+   elevation map. The method is a string given by the module which must
+   contain everything that changes the results: module, algorithm and
+   options. An entry is only used for the same method, the same region
+   and an unmodified elevation map; a map with a MASK is never cached.
+   The ids of all entries are listed in cell_misc/name/flowcache.
+
+   Caching is disabled by default; it is enabled with the environment
+   variable GRASS_FLOWCACHE=1 or Rast_set_flowcache(1). Entries can only
+   be written for maps in the current mapset. They are removed when the
+   map is rewritten or its null file is replaced.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define FLOWCACHE_FILE "flowcache"
+#define FLOWCACHE_FORMAT 1
+#define NULL_FILE   "null"
+#define NULLC_FILE  "nullcmpr"
+
+struct R_flowcache
+{
+    char *name;			/* elevation map */
+    char *method;
+    char *temp_name;		/* data file being written */
+    FILE *fp;
+    int rows, cols;
+    int cur_row;		/* next row to write */
+    off_t row_size;
+};
+
+/* id of an entry: hash of the method string */
+static unsigned int method_id(const char *method)
+{
+    unsigned int h = 5381;
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)method; *p; p++)
+	h = h * 33 + *p;
+
+    return h;
+}
+
+static void data_name(char *element, unsigned int id)
+{
+    sprintf(element, "%s_%08x", FLOWCACHE_FILE, id);
+}
+
+static void meta_name(char *element, unsigned int id)
+{
+    sprintf(element, "%s_%08x_meta", FLOWCACHE_FILE, id);
+}
+
+/* modification time and size of the data and null file of a map */
+static void map_stamp(const char *name, const char *mapset, char *stamp)
+{
+    char path[GPATH_MAX];
+    struct stat st_data, st_null;
+
+    memset(&st_data, 0, sizeof(st_data));
+    memset(&st_null, 0, sizeof(st_null));
+
+    G_file_name(path, "fcell", name, mapset);
+    if (stat(path, &st_data) != 0) {
+	G_file_name(path, "cell", name, mapset);
+	stat(path, &st_data);
+    }
+    G_file_name_misc(path, "cell_misc", NULLC_FILE, name, mapset);
+    if (stat(path, &st_null) != 0) {
+	G_file_name_misc(path, "cell_misc", NULL_FILE, name, mapset);
+	stat(path, &st_null);
+    }
+
+    sprintf(stamp, "%ld %ld %ld %ld",
+	    (long)st_data.st_mtime, (long)st_data.st_size,
+	    (long)st_null.st_mtime, (long)st_null.st_size);
+}
+
+/* the metadata of an entry for the current region */
+static struct Key_Value *make_meta(const char *name, const char *mapset,
+				   const char *method)
+{
+    struct Key_Value *keys = G_create_key_value();
+    struct Cell_head window;
+    char buf[GPATH_MAX];
+
+    Rast_get_window(&window);
+
+    sprintf(buf, "%d", FLOWCACHE_FORMAT);
+    G_set_key_value("format", buf, keys);
+    G_set_key_value("byteorder", G_is_little_endian() ? "little" : "big",
+		    keys);
+    G_set_key_value("method", method, keys);
+    sprintf(buf, "%d %d", window.rows, window.cols);
+    G_set_key_value("size", buf, keys);
+    sprintf(buf, "%.17g %.17g %.17g %.17g",
+	    window.north, window.south, window.east, window.west);
+    G_set_key_value("region", buf, keys);
+    map_stamp(name, mapset, buf);
+    G_set_key_value("stamp", buf, keys);
+
+    return keys;
+}
+
+static int same_meta(const struct Key_Value *a, const struct Key_Value *b)
+{
+    const char *fields[] = { "format", "byteorder", "method", "size",
+	"region", "stamp", NULL
+    };
+    const char *va, *vb;
+    int i;
+
+    for (i = 0; fields[i]; i++) {
+	va = G_find_key_value(fields[i], a);
+	vb = G_find_key_value(fields[i], b);
+	if (!va || !vb || strcmp(va, vb) != 0)
+	    return 0;
+    }
+
+    return 1;
+}
+
+static int can_cache(void)
+{
+    Rast__init();
+
+    return R__.use_flowcache && Rast_maskfd() < 0;
+}
+
+/*!
+   \brief Enable or disable the flow derivative cache
+
+   The default is given by the environment variable GRASS_FLOWCACHE
+   (disabled unless set to a value other than 0).
+
+   \param enable 1 to read and write cache entries, 0 to disable
+ */
+void Rast_set_flowcache(int enable)
+{
+    Rast__init();
+
+    R__.use_flowcache = enable;
+}
+
+/*!
+   \brief Open the cached flow derivatives of an elevation map
+
+   The entry must have been written with the same method in the same
+   region, and the map must not have been modified since.
+
+   \param name elevation map
+   \param mapset mapset of the map
+   \param method method string of the module
+
+   \return cache handle to read rows with Rast_flowcache_get_row()
+   \return NULL if there is no matching entry or caching is disabled
+ */
+struct R_flowcache *Rast_flowcache_open_old(const char *name,
+					    const char *mapset,
+					    const char *method)
+{
+    struct R_flowcache *fc;
+    struct Key_Value *keys, *want;
+    char element[GNAME_MAX], path[GPATH_MAX];
+    unsigned int id;
+    FILE *fp;
+    int ok;
+
+    if (!can_cache())
+	return NULL;
+
+    id = method_id(method);
+    meta_name(element, id);
+    if (!G_find_file2_misc("cell_misc", element, name, mapset))
+	return NULL;
+
+    G_file_name_misc(path, "cell_misc", element, name, mapset);
+    keys = G_read_key_value_file(path);
+    want = make_meta(name, mapset, method);
+    ok = same_meta(keys, want);
+    G_free_key_value(keys);
+    G_free_key_value(want);
+    if (!ok) {
+	G_verbose_message(_("Cached flow derivatives of <%s> are out of date"),
+			  G_fully_qualified_name(name, mapset));
+	return NULL;
+    }
+
+    data_name(element, id);
+    G_file_name_misc(path, "cell_misc", element, name, mapset);
+    if (!(fp = fopen(path, "rb")))
+	return NULL;
+
+    fc = G_calloc(1, sizeof(struct R_flowcache));
+    fc->name = G_store(name);
+    fc->method = G_store(method);
+    fc->fp = fp;
+    fc->rows = Rast_window_rows();
+    fc->cols = Rast_window_cols();
+    fc->row_size = (off_t)fc->cols * (sizeof(signed char) + sizeof(DCELL));
+
+    G_fseek(fp, 0, SEEK_END);
+    if (G_ftell(fp) != fc->row_size * fc->rows) {
+	G_warning(_("Cached flow derivatives of <%s> are incomplete"),
+		  G_fully_qualified_name(name, mapset));
+	Rast_flowcache_close(fc);
+	return NULL;
+    }
+
+    G_verbose_message(_("Using cached flow derivatives of <%s>"),
+		      G_fully_qualified_name(name, mapset));
+
+    return fc;
+}
+
+/*!
+   \brief Start a new cache entry for the flow derivatives of an
+   elevation map
+
+   Rows are written in order with Rast_flowcache_put_row(), the entry
+   replaces any entry of the same method when Rast_flowcache_close() is
+   called after the last row.
+
+   \param name elevation map
+   \param mapset mapset of the map
+   \param method method string of the module
+
+   \return cache handle
+   \return NULL if the map is not in the current mapset or caching is
+   disabled
+ */
+struct R_flowcache *Rast_flowcache_open_new(const char *name,
+					    const char *mapset,
+					    const char *method)
+{
+    struct R_flowcache *fc;
+    FILE *fp;
+    char *temp_name;
+
+    if (!can_cache())
+	return NULL;
+
+    if (strcmp(mapset, G_mapset()) != 0) {
+	G_verbose_message(_("Flow derivatives of <%s> are not cached, "
+			    "the map is not in the current mapset"),
+			  G_fully_qualified_name(name, mapset));
+	return NULL;
+    }
+
+    temp_name = G_tempfile();
+    if (!(fp = fopen(temp_name, "wb"))) {
+	G_warning(_("Unable to create cache file for flow derivatives"));
+	G_free(temp_name);
+	return NULL;
+    }
+
+    fc = G_calloc(1, sizeof(struct R_flowcache));
+    fc->name = G_store(name);
+    fc->method = G_store(method);
+    fc->temp_name = temp_name;
+    fc->fp = fp;
+    fc->rows = Rast_window_rows();
+    fc->cols = Rast_window_cols();
+    fc->row_size = (off_t)fc->cols * (sizeof(signed char) + sizeof(DCELL));
+
+    return fc;
+}
+
+/*!
+   \brief Read a row of cached flow derivatives
+
+   \param fc cache handle from Rast_flowcache_open_old()
+   \param[out] dir flow directions of the row, may be NULL
+   \param[out] acc flow accumulation of the row, may be NULL
+   \param row row number in the current region
+ */
+void Rast_flowcache_get_row(struct R_flowcache *fc, signed char *dir,
+			    DCELL *acc, int row)
+{
+    size_t dir_size = fc->cols * sizeof(signed char);
+
+    G_fseek(fc->fp, fc->row_size * row, SEEK_SET);
+    if (dir) {
+	if (fread(dir, 1, dir_size, fc->fp) != dir_size)
+	    G_fatal_error(_("Unable to read cached flow derivatives of <%s>"),
+			  fc->name);
+    }
+    else
+	G_fseek(fc->fp, dir_size, SEEK_CUR);
+    if (acc && fread(acc, sizeof(DCELL), fc->cols, fc->fp) != fc->cols)
+	G_fatal_error(_("Unable to read cached flow derivatives of <%s>"),
+		      fc->name);
+}
+
+/*!
+   \brief Write the next row of flow derivatives
+
+   \param fc cache handle from Rast_flowcache_open_new()
+   \param dir flow directions of the row
+   \param acc flow accumulation of the row
+ */
+void Rast_flowcache_put_row(struct R_flowcache *fc, const signed char *dir,
+			    const DCELL *acc)
+{
+    if (fwrite(dir, sizeof(signed char), fc->cols, fc->fp) != fc->cols ||
+	fwrite(acc, sizeof(DCELL), fc->cols, fc->fp) != fc->cols)
+	G_fatal_error(_("Unable to write cached flow derivatives of <%s>"),
+		      fc->name);
+    fc->cur_row++;
+}
+
+/*!
+   \brief Close a cache handle
+
+   A new entry is stored in cell_misc of the elevation map if all rows
+   have been written, otherwise it is discarded.
+
+   \param fc cache handle
+ */
+void Rast_flowcache_close(struct R_flowcache *fc)
+{
+    char element[GNAME_MAX], path[GPATH_MAX], buf[GNAME_MAX];
+    struct Key_Value *keys, *index;
+    const char *ids;
+    unsigned int id;
+    int complete;
+
+    id = method_id(fc->method);
+    complete = fclose(fc->fp) == 0 && fc->cur_row == fc->rows;
+
+    if (fc->temp_name) {
+	if (complete) {
+	    G__make_mapset_element_misc("cell_misc", fc->name);
+
+	    data_name(element, id);
+	    G_file_name_misc(path, "cell_misc", element, fc->name,
+			     G_mapset());
+	    if (G_rename_file(fc->temp_name, path) != 0) {
+		G_warning(_("Unable to store cached flow derivatives of <%s>"),
+			  fc->name);
+		complete = 0;
+	    }
+	}
+	if (complete) {
+	    keys = make_meta(fc->name, G_mapset(), fc->method);
+	    meta_name(element, id);
+	    G_file_name_misc(path, "cell_misc", element, fc->name,
+			     G_mapset());
+	    G_write_key_value_file(path, keys);
+	    G_free_key_value(keys);
+
+	    /* add the id to the list of entries */
+	    sprintf(buf, "%08x", id);
+	    G_file_name_misc(path, "cell_misc", FLOWCACHE_FILE, fc->name,
+			     G_mapset());
+	    index = access(path, 0) == 0 ? G_read_key_value_file(path) :
+		G_create_key_value();
+	    ids = G_find_key_value("entries", index);
+	    if (!ids || !*ids)
+		G_set_key_value("entries", buf, index);
+	    else if (!strstr(ids, buf)) {
+		char *list = G_malloc(strlen(ids) + strlen(buf) + 2);
+
+		sprintf(list, "%s %s", ids, buf);
+		G_set_key_value("entries", list, index);
+		G_free(list);
+	    }
+	    G_write_key_value_file(path, index);
+	    G_free_key_value(index);
+	}
+	else
+	    remove(fc->temp_name);
+	G_free(fc->temp_name);
+    }
+
+    G_free(fc->name);
+    G_free(fc->method);
+    G_free(fc);
+}
+
+/*!
+   \brief Remove all cached flow derivatives of a map in the current
+   mapset
+
+   Called when the map is rewritten or its null file is replaced.
+
+   \param name map name
+
+   \return number of entries removed
+ */
+int Rast_remove_flowcache(const char *name)
+{
+    char path[GPATH_MAX], element[GNAME_MAX];
+    struct Key_Value *index;
+    const char *ids;
+    char **tokens;
+    unsigned int id;
+    int i, n = 0;
+
+    if (!G_find_file2_misc("cell_misc", FLOWCACHE_FILE, name, G_mapset()))
+	return 0;
+
+    G_file_name_misc(path, "cell_misc", FLOWCACHE_FILE, name, G_mapset());
+    index = G_read_key_value_file(path);
+    if ((ids = G_find_key_value("entries", index))) {
+	tokens = G_tokenize(ids, " ");
+	for (i = 0; tokens[i]; i++) {
+	    if (sscanf(tokens[i], "%x", &id) != 1)
+		continue;
+	    data_name(element, id);
+	    G_remove_misc("cell_misc", element, name);
+	    meta_name(element, id);
+	    G_remove_misc("cell_misc", element, name);
+	    n++;
+	}
+	G_free_tokens(tokens);
+    }
+    G_free_key_value(index);
+    G_remove_misc("cell_misc", FLOWCACHE_FILE, name);
+
+    return n;
+}
@@ -84,6 +84,10 @@ int Rast__check_format(int fd)
     if (!fcb->cellhd.compressed)
 	return 1;
 
+    /* tiled maps start with the tile index instead */
+    if (fcb->tiles)
+	return Rast__read_tile_index(fd);
+
     /* allocate space to hold the row address array */
     fcb->row_ptr = G_calloc(fcb->cellhd.rows + 1, sizeof(off_t));
 
@@ -167,6 +171,21 @@ int Rast__read_row_ptrs(int fd)
     return 1;
 }
 
+int Rast__read_tile_index(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int ntiles;
+    off_t *index = Rast__tile_index(fd, &ntiles);
+
+    if (read_row_ptrs(ntiles, 0, index, fcb->data_fd) < 0) {
+	G_warning(_("Fail of initial read of tiled file [%s in %s]"),
+		  fcb->name, fcb->mapset);
+	return -1;
+    }
+
+    return 1;
+}
+
 int Rast__read_null_row_ptrs(int fd, int null_fd)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
@@ -219,6 +238,20 @@ int Rast__write_row_ptrs(int fd)
     return write_row_ptrs(nrows, fcb->row_ptr, fcb->data_fd);
 }
 
+int Rast__write_tile_index(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int ntiles;
+    off_t *index = Rast__tile_index(fd, &ntiles);
+
+    return write_row_ptrs(ntiles, index, fcb->data_fd) ? 1 : -1;
+}
+
+int Rast__write_overview_row_ptrs(int data_fd, int nrows, off_t *row_ptr)
+{
+    return write_row_ptrs(nrows, row_ptr, data_fd);
+}
+
 int Rast__write_null_row_ptrs(int fd, int null_fd)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
@@ -23,6 +23,10 @@
 
 #include "R.h"
 
+/* rows read at once from GDAL links, see Rast__gdal_read_row() */
+#define GDAL_STRIP_ROWS 16
+#define MAX_GDAL_STRIP_BYTES (32 << 20)
+
 #ifndef HAVE_GDAL
 #undef GDAL_LINK
 #endif
@@ -66,6 +70,7 @@ static CPLErr CPL_STDCALL(*pGDALSetGeoTransform) (GDALDatasetH, double *);
 static CPLErr CPL_STDCALL(*pGDALSetProjection) (GDALDatasetH, const char *);
 static const char *CPL_STDCALL(*pGDALGetDriverShortName) (GDALDriverH);
 static GDALDriverH CPL_STDCALL(*pGDALGetDatasetDriver) (GDALDatasetH);
+static void CPL_STDCALL(*pGDALGetBlockSize) (GDALRasterBandH, int *, int *);
 
 #if GDAL_DYNAMIC
 # if defined(__unix) && !defined(__unix__)
@@ -166,6 +171,7 @@ static void init_gdal(void)
     pGDALSetProjection = get_symbol("_GDALSetProjection@8");
     pGDALGetDriverShortName = get_symbol("_GDALGetDriverShortName@4");
     pGDALGetDatasetDriver = get_symbol("_GDALGetDatasetDriver@4");
+    pGDALGetBlockSize = get_symbol("_GDALGetBlockSize@12");
 #else
     pGDALAllRegister = get_symbol("GDALAllRegister");
     pGDALOpen = get_symbol("GDALOpen");
@@ -181,6 +187,7 @@ static void init_gdal(void)
     pGDALSetProjection = get_symbol("GDALSetProjection");
     pGDALGetDriverShortName = get_symbol("GDALGetDriverShortName");
     pGDALGetDatasetDriver = get_symbol("GDALGetDatasetDriver");
+    pGDALGetBlockSize = get_symbol("GDALGetBlockSize");
 #endif
 }
 
@@ -202,6 +209,7 @@ static void init_gdal(void)
     pGDALSetProjection = &GDALSetProjection;
     pGDALGetDriverShortName = &GDALGetDriverShortName;
     pGDALGetDatasetDriver = &GDALGetDatasetDriver;
+    pGDALGetBlockSize = &GDALGetBlockSize;
 }
 
 #endif /* GDAL_DYNAMIC */
@@ -243,6 +251,7 @@ struct GDAL_link *Rast_get_gdal_link(const char *name, const char *mapset)
     GDALRasterBandH band;
     GDALDataType type;
     RASTER_MAP_TYPE req_type;
+    int bx;
 #endif
     const char *filename;
     int band_num;
@@ -343,7 +352,10 @@ struct GDAL_link *Rast_get_gdal_link(const char *name, const char *mapset)
     gdal->data = data;
     gdal->band = band;
     gdal->type = type;
+    (*pGDALGetBlockSize) (band, &bx, &gdal->block_rows);
 #endif
+    if (gdal->block_rows < 1)
+	gdal->block_rows = 1;
 
     return gdal;
 }
@@ -578,6 +590,7 @@ void Rast_close_gdal_link(struct GDAL_link *gdal)
 #ifdef GDAL_LINK
     (*pGDALClose) (gdal->data);
 #endif
+    G_free(gdal->strip);
     G_free(gdal->filename);
     G_free(gdal);
 }
@@ -636,4 +649,59 @@ CPLErr Rast_gdal_raster_IO(GDALRasterBandH band, GDALRWFlag rw_flag,
 			     buffer, buf_x_size, buf_y_size, buf_type,
 			     pixel_size, line_size);
 }
+
+/*!
+  \brief Read a row of a GDAL link (internal use only)
+
+  Rows are read in strips of whole GDAL blocks of the band, at least
+  GDAL_STRIP_ROWS rows, so that each tile of a tiled file is decoded
+  once rather than for each of its rows, and the rows of a strip are
+  requested at once (which lets GDAL decode the tiles in parallel
+  where the driver supports it, see GDAL_NUM_THREADS).
+
+  \param gdal GDAL link
+  \param row row of the file
+  \param cols,rows size of the file
+  \param nbytes bytes per cell of the band's data type
+
+  \return pointer to the row, valid until the next call
+  \return NULL on error
+*/
+const unsigned char *Rast__gdal_read_row(struct GDAL_link *gdal, int row,
+					 int cols, int rows, int nbytes)
+{
+    size_t row_size = (size_t) cols * nbytes;
+
+    if (row < gdal->strip_row || row >= gdal->strip_row + gdal->strip_rows) {
+	int n = gdal->block_rows;
+	int start;
+
+	if (n < GDAL_STRIP_ROWS)
+	    n = (GDAL_STRIP_ROWS + n - 1) / n * n;
+	if (n * row_size > MAX_GDAL_STRIP_BYTES)
+	    n = MAX_GDAL_STRIP_BYTES / row_size;
+	if (n < 1)
+	    n = 1;
+
+	if (n * row_size > gdal->strip_size) {
+	    gdal->strip_size = n * row_size;
+	    gdal->strip = G_realloc(gdal->strip, gdal->strip_size);
+	}
+
+	start = row - row % n;
+	if (start + n > rows)
+	    n = rows - start;
+
+	gdal->strip_rows = 0;
+	if ((*pGDALRasterIO) (gdal->band, GF_Read, 0, start, cols, n,
+			      gdal->strip, cols, n, gdal->type, 0,
+			      0) != CE_None)
+	    return NULL;
+
+	gdal->strip_row = start;
+	gdal->strip_rows = n;
+    }
+
+    return gdal->strip + (row - gdal->strip_row) * row_size;
+}
 #endif
@@ -22,6 +22,12 @@
 
 #include "R.h"
 
+/* cells converted at a time by transfer_contig() */
+#define CONVERT_CHUNK 256
+
+/* performance counters, see G_perf_count() */
+static int perf_rows, perf_bytes, perf_expand;
+
 static void embed_nulls(int, void *, int, RASTER_MAP_TYPE, int, int);
 
 static int compute_window_row(int fd, int row, int *cellRow)
@@ -89,6 +95,7 @@ static void read_data_fp_compressed(int fd, int row, unsigned char *data_buf,
     off_t t2 = fcb->row_ptr[row + 1];
     size_t readamount = t2 - t1;
     size_t bufsize = fcb->cellhd.cols * fcb->nbytes;
+    double t0;
     int ret;
 
     if (lseek(fcb->data_fd, t1, SEEK_SET) < 0)
@@ -97,8 +104,11 @@ static void read_data_fp_compressed(int fd, int row, unsigned char *data_buf,
 
     *nbytes = fcb->nbytes;
 
+    t0 = G_perf_start();
     ret = G_read_compressed(fcb->data_fd, readamount, data_buf,
 			    bufsize, fcb->cellhd.compressed);
+    G_perf_stop(&perf_expand, "raster.expand", t0);
+    G_perf_count(&perf_bytes, "raster.bytes_expanded", bufsize);
     if (ret <= 0)
 	G_fatal_error(_("Error uncompressing fp raster data for row %d of <%s>: error code %d"),
 		      row, fcb->name, ret);
@@ -123,6 +133,91 @@ static void rle_decompress(unsigned char *dst, const unsigned char *src,
     }
 }
 
+static int expand_row(const unsigned char *cmp, size_t readamount,
+		      int compressed, int is_fp, int map_nbytes, int cols,
+		      unsigned char *data_buf, int *nbytes)
+{
+    size_t bufsize;
+    int n;
+
+    if (is_fp) {
+	/* same as G_read_compressed(): flag byte, then the data */
+	bufsize = (size_t) cols * map_nbytes;
+	*nbytes = map_nbytes;
+
+	if (readamount < 1)
+	    return -1;
+	if (*cmp == '0') {
+	    memcpy(data_buf, cmp + 1,
+		   readamount - 1 < bufsize ? readamount - 1 : bufsize);
+	    return 1;
+	}
+	if (*cmp != '1' ||
+	    G_expand((unsigned char *)cmp + 1, readamount - 1, data_buf,
+		     bufsize, compressed) <= 0)
+	    return -1;
+
+	return 1;
+    }
+
+    if (compressed > 0) {
+	/* one byte is nbyte count */
+	n = *nbytes = *cmp++;
+	readamount--;
+    }
+    else
+	/* pre 3.0 compression */
+	n = *nbytes = map_nbytes;
+
+    bufsize = (size_t) n * cols;
+    if (compressed < 0 || readamount < bufsize) {
+	if (compressed == 1)
+	    rle_decompress(data_buf, cmp, n, readamount);
+	else if (G_expand((unsigned char *)cmp, readamount, data_buf, bufsize,
+			  compressed) != bufsize)
+	    return -1;
+    }
+    else
+	memcpy(data_buf, cmp, bufsize);
+
+    return 1;
+}
+
+/*!
+   \brief Decompress a row of a raster data file (internal use only)
+
+   Does not use the library state, so it may be called by worker
+   threads.
+
+   \param cmp row as stored in the data file
+   \param readamount size of the stored row
+   \param compressed compressor of the map (see struct Cell_head)
+   \param is_fp non-zero for floating-point maps
+   \param map_nbytes bytes per cell in the file
+   \param cols number of columns
+   \param[out] data_buf buffer for the decompressed row
+   \param[out] nbytes bytes per cell of the decompressed row
+
+   \return 1 on success
+   \return -1 on invalid compressed data
+ */
+int Rast__expand_row(const unsigned char *cmp, size_t readamount,
+		     int compressed, int is_fp, int map_nbytes, int cols,
+		     unsigned char *data_buf, int *nbytes)
+{
+    double t0 = G_perf_start();
+    int ret;
+
+    ret = expand_row(cmp, readamount, compressed, is_fp, map_nbytes, cols,
+		     data_buf, nbytes);
+
+    G_perf_stop(&perf_expand, "raster.expand", t0);
+    G_perf_count(&perf_bytes, "raster.bytes_expanded",
+		 (long long)cols * *nbytes);
+
+    return ret;
+}
+
 static void read_data_compressed(int fd, int row, unsigned char *data_buf,
 				 int *nbytes)
 {
@@ -130,9 +225,8 @@ static void read_data_compressed(int fd, int row, unsigned char *data_buf,
     off_t t1 = fcb->row_ptr[row];
     off_t t2 = fcb->row_ptr[row + 1];
     ssize_t readamount = t2 - t1;
-    size_t bufsize;
-    unsigned char *cmp, *cmp2;
-    int n;
+    unsigned char *cmp;
+    int ret;
 
     if (lseek(fcb->data_fd, t1, SEEK_SET) < 0)
 	G_fatal_error(_("Error seeking raster data file for row %d of <%s>: %s"),
@@ -146,34 +240,14 @@ static void read_data_compressed(int fd, int row, unsigned char *data_buf,
 		      row, fcb->name, strerror(errno));
     }
 
-    /* save cmp for free below */
-    cmp2 = cmp;
-
     /* Now decompress the row */
-    if (fcb->cellhd.compressed > 0) {
-	/* one byte is nbyte count */
-	n = *nbytes = *cmp++;
-	readamount--;
-    }
-    else
-	/* pre 3.0 compression */
-	n = *nbytes = fcb->nbytes;
+    ret = Rast__expand_row(cmp, readamount, fcb->cellhd.compressed, 0,
+			   fcb->nbytes, fcb->cellhd.cols, data_buf, nbytes);
+    G_free(cmp);
 
-    bufsize = n * fcb->cellhd.cols;
-    if (fcb->cellhd.compressed < 0 || readamount < bufsize) {
-	if (fcb->cellhd.compressed == 1)
-	    rle_decompress(data_buf, cmp, n, readamount);
-	else {
-	    if (G_expand(cmp, readamount, data_buf, bufsize,
-		     fcb->cellhd.compressed) != bufsize)
-	    G_fatal_error(_("Error uncompressing raster data for row %d of <%s>"),
-			  row, fcb->name);
-	}
-    }
-    else
-	memcpy(data_buf, cmp, readamount);
-
-    G_free(cmp2);
+    if (ret < 0)
+	G_fatal_error(_("Error uncompressing raster data for row %d of <%s>"),
+		      row, fcb->name);
 }
 
 static void read_data_uncompressed(int fd, int row, unsigned char *data_buf,
@@ -198,41 +272,72 @@ static void read_data_gdal(int fd, int row, unsigned char *data_buf,
 			   int *nbytes)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    unsigned char *buf;
-    CPLErr err;
+    const unsigned char *buf;
+    int i;
 
     *nbytes = fcb->nbytes;
 
     if (fcb->gdal->vflip)
 	row = fcb->cellhd.rows - 1 - row;
 
-    buf = fcb->gdal->hflip ? G_malloc(fcb->cellhd.cols * fcb->cur_nbytes)
-	: data_buf;
+    buf = Rast__gdal_read_row(fcb->gdal, row, fcb->cellhd.cols,
+			      fcb->cellhd.rows, fcb->nbytes);
+    if (!buf)
+	G_fatal_error(_("Error reading raster data via GDAL for row %d of <%s>"),
+		      row, fcb->name);
 
-    err =
-	Rast_gdal_raster_IO(fcb->gdal->band, GF_Read, 0, row,
-			    fcb->cellhd.cols, 1, buf, fcb->cellhd.cols, 1,
-			    fcb->gdal->type, 0, 0);
+    /* no copy, the row is converted straight from the strip */
+    if (!fcb->gdal->hflip) {
+	fcb->cur_data = buf;
+	return;
+    }
 
-    if (fcb->gdal->hflip) {
-	int i;
+    for (i = 0; i < fcb->cellhd.cols; i++)
+	memcpy(data_buf + i * fcb->nbytes,
+	       buf + (fcb->cellhd.cols - 1 - i) * fcb->nbytes, fcb->nbytes);
+}
+#endif
 
-	for (i = 0; i < fcb->cellhd.cols; i++)
-	    memcpy(data_buf + i * fcb->cur_nbytes,
-		   buf + (fcb->cellhd.cols - 1 - i) * fcb->cur_nbytes,
-		   fcb->cur_nbytes);
-	G_free(buf);
+/* row from the memory mapped data file, returns 0 if not available */
+static int read_data_mmap(int fd, int row, unsigned char *data_buf,
+			  int *nbytes)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    const unsigned char *p;
+    size_t size;
+
+    if (!fcb->cellhd.compressed) {
+	size = (size_t) fcb->cellhd.cols * fcb->nbytes;
+	p = Rast__mmap_data(fd, (off_t) row * size, size);
+	if (!p)
+	    return 0;
+
+	/* no copy, the row is converted straight from the mapping */
+	*nbytes = fcb->nbytes;
+	fcb->cur_data = p;
+	return 1;
     }
 
-    if (err != CE_None)
-	G_fatal_error(_("Error reading raster data via GDAL for row %d of <%s>"),
+    size = fcb->row_ptr[row + 1] - fcb->row_ptr[row];
+    p = Rast__mmap_data(fd, fcb->row_ptr[row], size);
+    if (!p)
+	return 0;
+
+    if (Rast__expand_row(p, size, fcb->cellhd.compressed,
+			 fcb->map_type != CELL_TYPE, fcb->nbytes,
+			 fcb->cellhd.cols, data_buf, nbytes) < 0)
+	G_fatal_error(_("Error uncompressing raster data for row %d of <%s>"),
 		      row, fcb->name);
+
+    return 1;
 }
-#endif
 
-static void read_data(int fd, int row, unsigned char *data_buf, int *nbytes)
+static void read_data_file(int fd, int row, int *nbytes)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
+    unsigned char *data_buf = fcb->data;
+
+    fcb->cur_data = data_buf;
 
 #ifdef HAVE_GDAL
     if (fcb->gdal) {
@@ -241,6 +346,20 @@ static void read_data(int fd, int row, unsigned char *data_buf, int *nbytes)
     }
 #endif
 
+    if (fcb->tiles) {
+	Rast__read_tile_row(fd, row, data_buf, nbytes);
+	return;
+    }
+
+    if (fcb->readahead && Rast__read_ahead(fd, row, data_buf, nbytes)) {
+	/* the read-ahead swaps buffers */
+	fcb->cur_data = fcb->data;
+	return;
+    }
+
+    if (fcb->mmap && read_data_mmap(fd, row, data_buf, nbytes))
+	return;
+
     if (!fcb->cellhd.compressed)
 	read_data_uncompressed(fd, row, data_buf, nbytes);
     else if (fcb->map_type == CELL_TYPE)
@@ -249,16 +368,119 @@ static void read_data(int fd, int row, unsigned char *data_buf, int *nbytes)
 	read_data_fp_compressed(fd, row, data_buf, nbytes);
 }
 
+static void read_data(int fd, int row, int *nbytes)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+
+    G_perf_count(&perf_rows, "raster.rows_read", 1);
+
+    /* decompressed by an earlier module of the session */
+    if (fcb->row_cache && Rast__get_cached_row(fd, row, nbytes))
+	return;
+
+    read_data_file(fd, row, nbytes);
+
+    if (fcb->row_cache)
+	Rast__put_cached_row(fd, row, fcb->cur_data, *nbytes);
+}
+
 /* copy cell file data to user buffer translated by window column mapping */
+/*
+   Decoding of n consecutive cells of a row. The per cell functions
+   (G_xdr_get_float() etc.) are not inlined and test the byte order
+   for each cell; these loops do the test once, so that the compiler
+   can vectorize them.
+ */
+static void decode_int(CELL * c, const unsigned char *d, int nbytes, int n)
+{
+    int i;
+
+    switch (nbytes) {
+    case 1:
+	for (i = 0; i < n; i++)
+	    c[i] = d[i];
+	break;
+    case 2:
+	for (i = 0; i < n; i++, d += 2)
+	    c[i] = (d[0] << 8) | d[1];
+	break;
+    case 4:
+	/* sign bit in first byte */
+	for (i = 0; i < n; i++, d += 4) {
+	    CELL v = ((d[0] & 0x7f) << 24) | (d[1] << 16) | (d[2] << 8) | d[3];
+
+	    c[i] = (d[0] & 0x80) ? -v : v;
+	}
+	break;
+    default:
+	for (i = 0; i < n; i++) {
+	    CELL v = 0;
+	    int j;
+
+	    for (j = 0; j < nbytes; j++)
+		v = (v << 8) + *d++;
+	    c[i] = v;
+	}
+	break;
+    }
+}
+
+static void decode_float(FCELL * f, const unsigned char *src, int n)
+{
+    unsigned char *dst = (unsigned char *)f;
+    int i;
+
+    if (!G_is_little_endian()) {
+	memcpy(f, src, (size_t) n * XDR_FLOAT_NBYTES);
+	return;
+    }
+
+    for (i = 0; i < n; i++, dst += 4, src += 4) {
+	dst[0] = src[3];
+	dst[1] = src[2];
+	dst[2] = src[1];
+	dst[3] = src[0];
+    }
+}
+
+static void decode_double(DCELL * d, const unsigned char *src, int n)
+{
+    unsigned char *dst = (unsigned char *)d;
+    int i;
+
+    if (!G_is_little_endian()) {
+	memcpy(d, src, (size_t) n * XDR_DOUBLE_NBYTES);
+	return;
+    }
+
+    for (i = 0; i < n; i++, dst += 8, src += 8) {
+	dst[0] = src[7];
+	dst[1] = src[6];
+	dst[2] = src[5];
+	dst[3] = src[4];
+	dst[4] = src[3];
+	dst[5] = src[2];
+	dst[6] = src[1];
+	dst[7] = src[0];
+    }
+}
+
 static void cell_values_int(int fd, const unsigned char *data,
 			    const COLUMN_MAPPING * cmap, int nbytes,
 			    void *cell, int n)
 {
+    struct fileinfo *fcb = &R__.fileinfo[fd];
     CELL *c = cell;
     COLUMN_MAPPING cmapold = 0;
     int big = (size_t) nbytes >= sizeof(CELL);
     int i;
 
+    if (fcb->col_contig) {
+	decode_int(c, data + (size_t) (fcb->col_contig - 1) * nbytes,
+		   nbytes, n);
+	return;
+    }
+
     for (i = 0; i < n; i++) {
 	const unsigned char *d;
 	int neg;
@@ -300,10 +522,15 @@ static void cell_values_float(int fd, const unsigned char *data,
 			      void *cell, int n)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    const float *work_buf = (const float *) fcb->data;
+    const float *work_buf = (const float *) data;
     FCELL *c = cell;
     int i;
 
+    if (fcb->col_contig) {
+	decode_float(c, data + (size_t) (fcb->col_contig - 1) * nbytes, n);
+	return;
+    }
+
     for (i = 0; i < n; i++) {
 	if (!cmap[i]) {
 	    c[i] = 0;
@@ -319,10 +546,15 @@ static void cell_values_double(int fd, const unsigned char *data,
 			       void *cell, int n)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    const double *work_buf = (const double *) fcb->data;
+    const double *work_buf = (const double *) data;
     DCELL *c = cell;
     int i;
 
+    if (fcb->col_contig) {
+	decode_double(c, data + (size_t) (fcb->col_contig - 1) * nbytes, n);
+	return;
+    }
+
     for (i = 0; i < n; i++) {
 	if (!cmap[i]) {
 	    c[i] = 0;
@@ -431,7 +663,7 @@ static void gdal_values_double(int fd, const double *data,
 }
 #endif
 
-/* transfer_to_cell_XY takes bytes from fcb->data, converts these bytes with
+/* transfer_to_cell_XY takes bytes from fcb->cur_data, converts these bytes with
    the appropriate procedure (e.g. XDR or byte reordering) into type X 
    values which are put into array work_buf.  
    finally the values in work_buf are converted into 
@@ -452,16 +684,75 @@ static void transfer_to_cell_XX(int fd, void *cell)
 
 #ifdef HAVE_GDAL
     if (fcb->gdal)
-	(gdal_values_type[fcb->map_type]) (fd, fcb->data, fcb->col_map,
+	(gdal_values_type[fcb->map_type]) (fd, fcb->cur_data, fcb->col_map,
 					   fcb->cur_nbytes, cell,
 					   R__.rd_window.cols);
     else
 #endif
-	(cell_values_type[fcb->map_type]) (fd, fcb->data, fcb->col_map,
+	(cell_values_type[fcb->map_type]) (fd, fcb->cur_data, fcb->col_map,
 					   fcb->cur_nbytes, cell,
 					   R__.rd_window.cols);
 }
 
+/*
+   Conversion between two types for a window mapping to consecutive
+   columns: decodes and converts in chunks instead of decoding the row
+   into a work buffer first. Returns 0 if the window is not mapped to
+   consecutive columns.
+ */
+static int transfer_contig(int fd, void *cell, RASTER_MAP_TYPE data_type)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int n = R__.rd_window.cols;
+    int nbytes = fcb->cur_nbytes;
+    const unsigned char *data;
+    union
+    {
+	CELL c[CONVERT_CHUNK];
+	FCELL f[CONVERT_CHUNK];
+	DCELL d[CONVERT_CHUNK];
+    } tmp;
+    int i, j, m;
+
+    if (fcb->gdal || !fcb->col_contig)
+	return 0;
+
+    data = fcb->cur_data + (size_t) (fcb->col_contig - 1) * nbytes;
+
+    for (i = 0; i < n; i += m) {
+	FCELL *f = (FCELL *) cell + i;
+	DCELL *d = (DCELL *) cell + i;
+
+	m = n - i < CONVERT_CHUNK ? n - i : CONVERT_CHUNK;
+
+	switch (fcb->map_type) {
+	case CELL_TYPE:
+	    decode_int(tmp.c, data, nbytes, m);
+	    if (data_type == FCELL_TYPE)
+		for (j = 0; j < m; j++)
+		    f[j] = tmp.c[j];
+	    else
+		for (j = 0; j < m; j++)
+		    d[j] = tmp.c[j];
+	    break;
+	case FCELL_TYPE:
+	    decode_float(tmp.f, data, m);
+	    for (j = 0; j < m; j++)
+		d[j] = tmp.f[j];
+	    break;
+	case DCELL_TYPE:
+	    decode_double(tmp.d, data, m);
+	    for (j = 0; j < m; j++)
+		f[j] = tmp.d[j];
+	    break;
+	}
+
+	data += (size_t) m * nbytes;
+    }
+
+    return 1;
+}
+
 static void transfer_to_cell_fi(int fd, void *cell)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
@@ -494,9 +785,14 @@ static void transfer_to_cell_di(int fd, void *cell)
 
 static void transfer_to_cell_if(int fd, void *cell)
 {
-    CELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
+    CELL *work_buf;
     int i;
 
+    if (transfer_contig(fd, cell, FCELL_TYPE))
+	return;
+
+    work_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
+
     transfer_to_cell_XX(fd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
@@ -507,9 +803,14 @@ static void transfer_to_cell_if(int fd, void *cell)
 
 static void transfer_to_cell_df(int fd, void *cell)
 {
-    DCELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(DCELL));
+    DCELL *work_buf;
     int i;
 
+    if (transfer_contig(fd, cell, FCELL_TYPE))
+	return;
+
+    work_buf = G_malloc(R__.rd_window.cols * sizeof(DCELL));
+
     transfer_to_cell_XX(fd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
@@ -520,9 +821,14 @@ static void transfer_to_cell_df(int fd, void *cell)
 
 static void transfer_to_cell_id(int fd, void *cell)
 {
-    CELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
+    CELL *work_buf;
     int i;
 
+    if (transfer_contig(fd, cell, DCELL_TYPE))
+	return;
+
+    work_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
+
     transfer_to_cell_XX(fd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
@@ -533,9 +839,14 @@ static void transfer_to_cell_id(int fd, void *cell)
 
 static void transfer_to_cell_fd(int fd, void *cell)
 {
-    FCELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(FCELL));
+    FCELL *work_buf;
     int i;
 
+    if (transfer_contig(fd, cell, DCELL_TYPE))
+	return;
+
+    work_buf = G_malloc(R__.rd_window.cols * sizeof(FCELL));
+
     transfer_to_cell_XX(fd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
@@ -577,7 +888,7 @@ static int get_map_row_nomask(int fd, void *rast, int row,
     /* read cell file row if not in memory */
     if (r != fcb->cur_row) {
 	fcb->cur_row = r;
-	read_data(fd, fcb->cur_row, fcb->data, &fcb->cur_nbytes);
+	read_data(fd, fcb->cur_row, &fcb->cur_nbytes);
     }
 
     (transfer_to_cell_FtypeOtype[fcb->map_type][data_type]) (fd, rast);
@@ -615,6 +926,9 @@ static void get_map_row(int fd, void *rast, int row, RASTER_MAP_TYPE data_type,
 
     get_map_row_no_reclass(fd, buf, row, type, null_is_zero, with_mask);
 
+    /* reading a virtual raster may open its tiles */
+    fcb = &R__.fileinfo[fd];
+
     if (!fcb->reclass_flag)
 	return;
 
@@ -822,6 +1136,33 @@ void Rast_get_d_row(int fd, DCELL * buf, int row)
     Rast_get_row(fd, buf, row, DCELL_TYPE);
 }
 
+/*!
+ * \brief Read a block of consecutive raster rows
+ *
+ * Reads <em>nrows</em> rows starting at <em>row</em> like
+ * Rast_get_row() into <em>buf</em>, which holds the rows one after
+ * the other (nrows * Rast_window_cols() cells of <em>data_type</em>).
+ * One call per block instead of per row matters for language bindings
+ * such as pygrass, where each call is expensive.
+ *
+ * \param fd file descriptor for the opened raster map
+ * \param buf buffer for the rows to be placed into
+ * \param row first data row desired
+ * \param nrows number of rows
+ * \param data_type data type
+ *
+ * \return void
+ */
+void Rast_get_rows(int fd, void *buf, int row, int nrows,
+		   RASTER_MAP_TYPE data_type)
+{
+    size_t size = (size_t) R__.rd_window.cols * Rast_cell_size(data_type);
+    int i;
+
+    for (i = 0; i < nrows; i++)
+	Rast_get_row(fd, (unsigned char *)buf + i * size, row + i, data_type);
+}
+
 static int read_null_bits_compressed(int null_fd, unsigned char *flags,
 				     int row, size_t size, int fd)
 {
@@ -865,17 +1206,33 @@ static int read_null_bits_compressed(int null_fd, unsigned char *flags,
 int Rast__read_null_bits(int fd, int row, unsigned char *flags)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    int null_fd = fcb->null_fd;
-    int cols = fcb->cellhd.cols;
-    off_t offset;
-    ssize_t size;
     int R;
 
     if (compute_window_row(fd, row, &R) <= 0) {
-	Rast__init_null_bits(flags, cols);
+	Rast__init_null_bits(flags, fcb->cellhd.cols);
 	return 1;
     }
 
+    return Rast__read_null_bits_row(fd, R, flags);
+}
+
+/*!
+   \brief Read the null bits of a cell file row (internal use only)
+
+   \param fd file descriptor
+   \param R cell file row
+   \param[out] flags null bits
+
+   \return 1 on success, 0 if the map has no null file
+ */
+int Rast__read_null_bits_row(int fd, int R, unsigned char *flags)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int null_fd = fcb->null_fd;
+    int cols = fcb->cellhd.cols;
+    off_t offset;
+    ssize_t size;
+
     if (null_fd < 0)
 	return 0;
 
@@ -942,6 +1299,12 @@ static void get_null_value_row_nomask(int fd, char *flags, int row)
     }
 
     /* copy null row to flags row translated by window column mapping */
+    if (fcb->col_contig) {
+	Rast__unpack_null_bits(flags, fcb->null_bits, fcb->col_contig - 1,
+			       R__.rd_window.cols);
+	return;
+    }
+
     for (j = 0; j < R__.rd_window.cols; j++) {
 	if (!fcb->col_map[j])
 	    flags[j] = 1;
@@ -981,31 +1344,35 @@ static void get_null_value_row_gdal(int fd, char *flags, int row)
 
 /*--------------------------------------------------------------------------*/
 
-static void embed_mask(char *flags, int row)
-{
-    CELL *mask_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
-    int i;
+/*!
+   \brief Read a row of the MASK (internal use only)
 
-    if (R__.auto_mask <= 0) {
-	G_free(mask_buf);
-	return;
-    }
+   Reclassed masks are resolved, see maskcache.c for the cached rows.
 
-    if (get_map_row_nomask(R__.mask_fd, mask_buf, row, CELL_TYPE) < 0) {
-	G_free(mask_buf);
-	return;
-    }
+   \param buf buffer for a row of the input window
+   \param row row of the input window
+
+   \return 1 on success, 0 if the row couldn't be read
+ */
+int Rast__read_mask_row(CELL *buf, int row)
+{
+    if (get_map_row_nomask(R__.mask_fd, buf, row, CELL_TYPE) < 0)
+	return 0;
 
     if (R__.fileinfo[R__.mask_fd].reclass_flag) {
-	embed_nulls(R__.mask_fd, mask_buf, row, CELL_TYPE, 0, 0);
-	do_reclass_int(R__.mask_fd, mask_buf, 1);
+	embed_nulls(R__.mask_fd, buf, row, CELL_TYPE, 0, 0);
+	do_reclass_int(R__.mask_fd, buf, 1);
     }
 
-    for (i = 0; i < R__.rd_window.cols; i++)
-	if (mask_buf[i] == 0 || Rast_is_c_null_value(&mask_buf[i]))
-	    flags[i] = 1;
+    return 1;
+}
+
+static void embed_mask(char *flags, int row)
+{
+    if (R__.auto_mask <= 0)
+	return;
 
-    G_free(mask_buf);
+    Rast__apply_mask(flags, row);
 }
 
 static void get_null_value_row(int fd, char *flags, int row, int with_mask)
@@ -1027,7 +1394,7 @@ static void embed_nulls(int fd, void *buf, int row, RASTER_MAP_TYPE map_type,
 			int null_is_zero, int with_mask)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    size_t size = Rast_cell_size(map_type);
+    int cols = R__.rd_window.cols;
     char *null_buf;
     int i;
 
@@ -1041,15 +1408,42 @@ static void embed_nulls(int fd, void *buf, int row, RASTER_MAP_TYPE map_type,
 
     get_null_value_row(fd, null_buf, row, with_mask);
 
-    for (i = 0; i < R__.rd_window.cols; i++) {
-	/* also check for nulls which might be already embedded by quant
-	   rules in case of fp map. */
-	if (null_buf[i] || Rast_is_null_value(buf, map_type)) {
-	    /* G__set_[f/d]_null_value() sets it to 0 is the embedded mode
-	       is not set and calls G_set_[f/d]_null_value() otherwise */
-	    Rast__set_null_value(buf, 1, null_is_zero, map_type);
+    /* also check for nulls which might be already embedded by quant
+       rules in case of fp map. Nulls become 0 if null_is_zero is set.
+       One loop per type, so that the compiler can vectorize them. */
+    switch (map_type) {
+    case CELL_TYPE:{
+	    CELL *c = buf;
+	    CELL null, v;
+
+	    Rast_set_c_null_value(&null, 1);
+	    v = null_is_zero ? 0 : null;
+	    for (i = 0; i < cols; i++)
+		c[i] = (null_buf[i] || c[i] == null) ? v : c[i];
+	    break;
+	}
+    case FCELL_TYPE:{
+	    FCELL *f = buf;
+	    FCELL v = 0;
+
+	    if (!null_is_zero)
+		Rast_set_f_null_value(&v, 1);
+	    for (i = 0; i < cols; i++)
+		if (null_buf[i] || f[i] != f[i])
+		    f[i] = v;
+	    break;
+	}
+    case DCELL_TYPE:{
+	    DCELL *d = buf;
+	    DCELL v = 0;
+
+	    if (!null_is_zero)
+		Rast_set_d_null_value(&v, 1);
+	    for (i = 0; i < cols; i++)
+		if (null_buf[i] || d[i] != d[i])
+		    d[i] = v;
+	    break;
 	}
-	buf = G_incr_void_ptr(buf, size);
     }
 
     G_free(null_buf);
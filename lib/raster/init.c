@@ -77,7 +77,9 @@ void Rast__error_handler(void *p)
 
 static int init(void)
 {
-    char *zlib, *nulls, *cname;
+    char *zlib, *nulls, *cname, *ahead, *behind, *mapped, *rowcache;
+    char *tiles, *ovr;
+    char *flow;
 
     Rast__init_window();
 
@@ -100,8 +102,15 @@ static int init(void)
      * 2: ZLIB (DEFLATE)
      * 3: LZ4
      * 4: BZIP2
-     * 5: ZSTD */
-    if (cname && *cname) {
+     * 5: ZSTD
+     * AUTO: chosen for each new map from its first rows */
+    if (cname && G_strcasecmp(cname, "AUTO") == 0) {
+	char *target = getenv("GRASS_COMPRESSOR_TARGET");
+
+	R__.compress_auto = 1;
+	R__.compress_target = (target && *target) ? atof(target) : 100;
+    }
+    else if (cname && *cname) {
 	/* ask gislib */
 	R__.compression_type = G_compressor_number(cname);
 	if (R__.compression_type < 1) {
@@ -129,6 +138,36 @@ static int init(void)
     nulls = getenv("GRASS_COMPRESS_NULLS");
     R__.compress_nulls = (nulls && atoi(nulls) == 0) ? 0 : 1;
 
+    /* number of rows to read ahead for compressed maps, 0: disabled */
+    ahead = getenv("GRASS_RASTER_READAHEAD");
+    R__.read_ahead = (ahead && *ahead) ? atoi(ahead) : 0;
+
+    /* number of rows compressed in the background, 0: disabled */
+    behind = getenv("GRASS_RASTER_WRITEBEHIND");
+    R__.write_behind = (behind && *behind) ? atoi(behind) : 0;
+
+    /* memory mapped data files for reading */
+    mapped = getenv("GRASS_RASTER_MMAP");
+    R__.use_mmap = (mapped && *mapped) ? atoi(mapped) : 0;
+
+    /* session cache of decompressed rows, size limit in MB, 0: off */
+    rowcache = getenv("GRASS_RASTER_ROW_CACHE");
+    R__.row_cache_mb = (rowcache && *rowcache) ? atoi(rowcache) : 0;
+
+    /* tile size of new compressed maps, 0: row layout */
+    tiles = getenv("GRASS_RASTER_TILE_SIZE");
+    R__.tile_size = (tiles && *tiles) ? atoi(tiles) : 0;
+    if (R__.tile_size < 0)
+	R__.tile_size = 0;
+
+    /* overviews for coarse regions, enabled unless set to 0 */
+    ovr = getenv("GRASS_RASTER_OVERVIEWS");
+    R__.use_overviews = (ovr && *ovr) ? atoi(ovr) : 1;
+
+    /* cached flow derivatives of elevation maps, disabled unless set */
+    flow = getenv("GRASS_FLOWCACHE");
+    R__.use_flowcache = (flow && *flow) ? atoi(flow) : 0;
+
     G_add_error_handler(Rast__error_handler, NULL);
 
     initialized = 1;
@@ -0,0 +1,180 @@
+/*!
+   \file lib/raster/maskcache.c
+
+   \brief Raster library - Cache of MASK rows
+
+   Each row of the MASK is read and decompressed once for all maps
+   read with masking, and kept as packed bits (one bit per column of
+   the input window, set for masked out cells). The whole MASK is held
+   in memory when it is small enough, otherwise a number of recently
+   used rows. The bits are merged into null flags a word at a time.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#include <grass/config.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <grass/raster.h>
+
+#include "R.h"
+
+/* the whole MASK is cached up to this size */
+#define MAX_MASK_BYTES (16 << 20)
+/* rows cached at least, e.g. for neighborhoods */
+#define MIN_MASK_ROWS 64
+
+struct R_maskcache
+{
+    int rows, cols;		/* input window of the cached rows */
+    int nslots;			/* row r is cached in slot r % nslots */
+    int row_bytes;
+    int *row;			/* row of each slot, -1 if unused */
+    unsigned char *bits;
+};
+
+/* 8 null flags for each byte of mask bits, first column in the
+   most significant bit as in the null files */
+static uint64_t expand[256];
+static int expand_ready;
+
+#ifdef HAVE_PTHREAD_H
+/* several threads may read different maps at the same time */
+static pthread_mutex_t mask_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void init_expand(void)
+{
+    int b, k;
+
+    for (b = 0; b < 256; b++) {
+	unsigned char flags[8];
+
+	for (k = 0; k < 8; k++)
+	    flags[k] = (b >> (7 - k)) & 1;
+	memcpy(&expand[b], flags, 8);
+    }
+
+    expand_ready = 1;
+}
+
+static struct R_maskcache *get_cache(void)
+{
+    struct R_maskcache *c = R__.mask_cache;
+    int rows = R__.rd_window.rows;
+    int cols = R__.rd_window.cols;
+    int i;
+
+    if (c && c->rows == rows && c->cols == cols)
+	return c;
+
+    Rast__release_mask_cache();
+
+    c = G_malloc(sizeof(struct R_maskcache));
+    c->rows = rows;
+    c->cols = cols;
+    c->row_bytes = (cols + 7) / 8;
+    c->nslots = MAX_MASK_BYTES / c->row_bytes;
+    if (c->nslots < MIN_MASK_ROWS)
+	c->nslots = MIN_MASK_ROWS;
+    if (c->nslots > rows)
+	c->nslots = rows;
+    c->row = G_malloc(c->nslots * sizeof(int));
+    for (i = 0; i < c->nslots; i++)
+	c->row[i] = -1;
+    c->bits = G_malloc((size_t) c->nslots * c->row_bytes);
+
+    if (!expand_ready)
+	init_expand();
+
+    R__.mask_cache = c;
+
+    return c;
+}
+
+static void fill_row(struct R_maskcache *c, unsigned char *bits, int row)
+{
+    CELL *mask_buf = G_malloc(c->cols * sizeof(CELL));
+    CELL null;
+    int i;
+
+    memset(bits, 0, c->row_bytes);
+
+    /* rows which can't be read are not masked */
+    if (Rast__read_mask_row(mask_buf, row)) {
+	Rast_set_c_null_value(&null, 1);
+	for (i = 0; i < c->cols; i++)
+	    bits[i >> 3] |=
+		((mask_buf[i] == 0) | (mask_buf[i] == null)) << (7 - (i & 7));
+    }
+
+    G_free(mask_buf);
+}
+
+/*!
+   \brief Set the null flags of masked out cells (internal use only)
+
+   \param flags null flags of a row of the input window
+   \param row row of the input window
+ */
+void Rast__apply_mask(char *flags, int row)
+{
+    struct R_maskcache *c;
+    unsigned char *bits;
+    int slot, i;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&mask_mutex);
+#endif
+
+    c = get_cache();
+    slot = row % c->nslots;
+    bits = c->bits + (size_t) slot * c->row_bytes;
+
+    if (c->row[slot] != row) {
+	fill_row(c, bits, row);
+	c->row[slot] = row;
+    }
+
+    for (i = 0; i + 8 <= c->cols; i += 8) {
+	uint64_t f;
+
+	if (!bits[i >> 3])
+	    continue;
+	memcpy(&f, flags + i, 8);
+	f |= expand[bits[i >> 3]];
+	memcpy(flags + i, &f, 8);
+    }
+    for (; i < c->cols; i++)
+	flags[i] |= (bits[i >> 3] >> (7 - (i & 7))) & 1;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&mask_mutex);
+#endif
+}
+
+/*!
+   \brief Discard the cached MASK rows (internal use only)
+
+   Called whenever the MASK is opened, closed or suppressed.
+ */
+void Rast__release_mask_cache(void)
+{
+    struct R_maskcache *c = R__.mask_cache;
+
+    if (!c)
+	return;
+
+    G_free(c->row);
+    G_free(c->bits);
+    G_free(c);
+
+    R__.mask_cache = NULL;
+}
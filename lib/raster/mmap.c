@@ -0,0 +1,151 @@
+/*!
+   \file lib/raster/mmap.c
+
+   \brief Raster library - Memory mapped raster data files
+
+   The data file of a native raster map open for reading can be
+   mapped into memory. Rows of uncompressed maps are then converted
+   straight from the mapping, compressed rows are decompressed from
+   it, without a system call per row.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __MINGW32__
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+struct R_mmap
+{
+    unsigned char *base;
+    size_t size;
+#ifdef __MINGW32__
+    HANDLE handle;
+#endif
+};
+
+/*!
+   \brief Use a memory mapping of the data file of a raster map
+
+   Applies to native raster maps open for reading. If the data file
+   can't be mapped (e.g. not enough address space), rows are read as
+   usual. The default for all maps can be set with the environment
+   variable GRASS_RASTER_MMAP.
+
+   \param fd file descriptor of raster map open for reading
+   \param enable non-zero to map the data file, 0 to unmap it
+ */
+void Rast_set_mmap(int fd, int enable)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_mmap *m;
+    struct stat st;
+    void *ptr;
+
+    if (fcb->open_mode != OPEN_OLD)
+	G_fatal_error(_("Raster map <%s> is not open for reading"),
+		      fcb->name);
+
+    Rast__close_mmap(fd);
+
+    if (!enable || fcb->gdal || fcb->vrt || fcb->data_fd < 0)
+	return;
+
+    if (fstat(fcb->data_fd, &st) < 0 || st.st_size <= 0 ||
+	(off_t) (size_t) st.st_size != st.st_size) {
+	G_debug(1, "Rast_set_mmap(): <%s> can't be mapped", fcb->name);
+	return;
+    }
+
+    m = G_malloc(sizeof(struct R_mmap));
+    m->size = st.st_size;
+
+#ifdef __MINGW32__
+    m->handle = CreateFileMapping((HANDLE) _get_osfhandle(fcb->data_fd),
+				  NULL, PAGE_READONLY, 0, 0, NULL);
+    ptr = m->handle ? MapViewOfFile(m->handle, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!ptr) {
+	if (m->handle)
+	    CloseHandle(m->handle);
+	G_free(m);
+	G_debug(1, "Rast_set_mmap(): mapping <%s> failed", fcb->name);
+	return;
+    }
+#else
+    ptr = mmap(NULL, m->size, PROT_READ, MAP_SHARED, fcb->data_fd, (off_t) 0);
+    if (ptr == MAP_FAILED) {
+	G_free(m);
+	G_debug(1, "Rast_set_mmap(): mapping <%s> failed", fcb->name);
+	return;
+    }
+#endif
+
+    m->base = ptr;
+    fcb->mmap = m;
+
+    G_debug(2, "Rast_set_mmap(): <%s> %lu bytes", fcb->name,
+	    (unsigned long) m->size);
+}
+
+/*!
+   \brief Get a part of the mapped data file
+
+   \param fd file descriptor
+   \param offset offset in the data file
+   \param size number of bytes
+
+   \return pointer to the data
+   \return NULL if the data file is not mapped or too short
+ */
+const unsigned char *Rast__mmap_data(int fd, off_t offset, size_t size)
+{
+    struct R_mmap *m = R__.fileinfo[fd].mmap;
+
+    if (!m || offset < 0 || (size_t) offset > m->size ||
+	size > m->size - (size_t) offset)
+	return NULL;
+
+    return m->base + offset;
+}
+
+/*!
+   \brief Unmap the data file of a raster map
+
+   \param fd file descriptor
+ */
+void Rast__close_mmap(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_mmap *m = fcb->mmap;
+
+    if (!m)
+	return;
+
+#ifdef __MINGW32__
+    UnmapViewOfFile(m->base);
+    CloseHandle(m->handle);
+#else
+    munmap(m->base, m->size);
+#endif
+
+    G_free(m);
+    fcb->mmap = NULL;
+    /* the current row may point into the mapping */
+    fcb->cur_row = -1;
+    fcb->cur_data = fcb->data;
+}
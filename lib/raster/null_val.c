@@ -36,34 +36,42 @@ static void EmbedGivenNulls(void *, char *, RASTER_MAP_TYPE, int);
 void EmbedGivenNulls(void *cell, char *nulls, RASTER_MAP_TYPE map_type,
 		     int ncols)
 {
-    CELL *c;
-    FCELL *f;
-    DCELL *d;
-    int i;
-
-    c = (CELL *) cell;
-    f = (FCELL *) cell;
-    d = (DCELL *) cell;
-
-    for (i = 0; i < ncols; i++) {
-	if (nulls[i]) {
-	    switch (map_type) {
-	    case CELL_TYPE:
-		Rast_set_c_null_value((CELL *) (c + i), 1);
-		break;
-
-	    case FCELL_TYPE:
-		Rast_set_f_null_value((FCELL *) (f + i), 1);
-		break;
-
-	    case DCELL_TYPE:
-		Rast_set_d_null_value((DCELL *) (d + i), 1);
-		break;
-
-	    default:
-		G_warning(_("EmbedGivenNulls: wrong data type"));
-	    }
+    /* one loop per type: the compiler can vectorize the selects */
+    switch (map_type) {
+    case CELL_TYPE:{
+	    CELL *c = cell;
+	    CELL null;
+	    int i;
+
+	    Rast_set_c_null_value(&null, 1);
+	    for (i = 0; i < ncols; i++)
+		c[i] = nulls[i] ? null : c[i];
+	    break;
+	}
+    case FCELL_TYPE:{
+	    FCELL *f = cell;
+	    FCELL null;
+	    int i;
+
+	    Rast_set_f_null_value(&null, 1);
+	    for (i = 0; i < ncols; i++)
+		if (nulls[i])
+		    f[i] = null;
+	    break;
+	}
+    case DCELL_TYPE:{
+	    DCELL *d = cell;
+	    DCELL null;
+	    int i;
+
+	    Rast_set_d_null_value(&null, 1);
+	    for (i = 0; i < ncols; i++)
+		if (nulls[i])
+		    d[i] = null;
+	    break;
 	}
+    default:
+	G_warning(_("EmbedGivenNulls: wrong data type"));
     }
 }
 
@@ -423,29 +431,19 @@ int G__set_flags_from_01_random(const char *zero_ones, unsigned char *flags,
 void Rast__convert_01_flags(const char *zero_ones, unsigned char *flags,
 			    int n)
 {
-    unsigned char *v;
-    int count;
-    int size;
+    const unsigned char *z = (const unsigned char *)zero_ones;
     int i, k;
 
-    /* pad the flags with 0's to make size multiple of 8 */
-    v = flags;
-    size = Rast__null_bitstream_size(n);
-    count = 0;
-
-    for (i = 0; i < size; i++) {
-	*v = 0;
-	k = 8;
-
-	while (k-- > 0) {
-	    if (count < n) {
-		*v = *v | ((unsigned char)zero_ones[count] << k);
-	    }
-
-	    count++;
-	}
+    /* whole bytes without branches */
+    for (i = 0; i + 8 <= n; i += 8, z += 8)
+	*flags++ = (z[0] << 7) | (z[1] << 6) | (z[2] << 5) | (z[3] << 4) |
+	    (z[4] << 3) | (z[5] << 2) | (z[6] << 1) | z[7];
 
-	v++;
+    /* pad the flags with 0's to make size multiple of 8 */
+    if (i < n) {
+	*flags = 0;
+	for (k = 7; i < n; i++, k--)
+	    *flags |= *z++ << k;
     }
 }
 
@@ -461,27 +459,52 @@ void Rast__convert_01_flags(const char *zero_ones, unsigned char *flags,
 void Rast__convert_flags_01(char *zero_ones, const unsigned char *flags,
 			    int n)
 {
-    const unsigned char *v;
-    int count;
-    int size;
-    int i, k;
+    Rast__unpack_null_bits(zero_ones, flags, 0, n);
+}
 
-    count = 0;
-    v = flags;
-    size = Rast__null_bitstream_size(n);
+/*!
+   \brief Unpack a range of a null bitmap into an array of 0/1
 
-    for (i = 0; i < size; i++) {
-	k = 8;
+   Note: Only for internal use.
 
-	while (k-- > 0) {
-	    if (count < n) {
-		zero_ones[count] = ((*v & ((unsigned char)1 << k)) != 0);
-		count++;
-	    }
-	}
+   Sets <i>zero_ones</i>[i] to bit <i>first</i> + i of <i>flags</i> for
+   i = 0 ... <i>n</i> - 1. Whole bytes are unpacked without branches.
 
+   \param[out] zero_ones array of n flags
+   \param flags null bitmap
+   \param first index of first bit
+   \param n number of bits
+ */
+void Rast__unpack_null_bits(char *zero_ones, const unsigned char *flags,
+			    int first, int n)
+{
+    const unsigned char *v = flags + first / 8;
+    int k = first % 8;
+    int i = 0;
+
+    /* up to the next byte boundary */
+    if (k) {
+	for (; i < n && k < 8; i++, k++)
+	    zero_ones[i] = (*v >> (7 - k)) & 1;
 	v++;
     }
+
+    for (; i + 8 <= n; i += 8, v++) {
+	unsigned char b = *v;
+	char *z = zero_ones + i;
+
+	z[0] = (b >> 7) & 1;
+	z[1] = (b >> 6) & 1;
+	z[2] = (b >> 5) & 1;
+	z[3] = (b >> 4) & 1;
+	z[4] = (b >> 3) & 1;
+	z[5] = (b >> 2) & 1;
+	z[6] = (b >> 1) & 1;
+	z[7] = b & 1;
+    }
+
+    for (k = 0; i < n; i++, k++)
+	zero_ones[i] = (*v >> (7 - k)) & 1;
 }
 
 /*!
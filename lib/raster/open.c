@@ -321,6 +321,10 @@ int Rast__open_old(const char *name, const char *mapset)
     fcb->gdal = gdal;
     fcb->vrt = vrt;
     if (!gdal && !vrt) {
+	/* overviews are stored in rows */
+	if (!Rast__open_overview(fd, r_name, r_mapset))
+	    Rast__read_tile_format(fd, r_name, r_mapset);
+
 	/* check for compressed data format, making initial reads if necessary */
 	if (Rast__check_format(fd) < 0) {
 	    close(cell_fd);	/* warning issued by check_format() */
@@ -341,6 +345,8 @@ int Rast__open_old(const char *name, const char *mapset)
 
     /* for reading fcb->data is allocated to be fcb->cellhd.cols * fcb->nbytes 
        (= XDR_FLOAT/DOUBLE_NBYTES) */
+    if (fcb->overview && MAP_TYPE == CELL_TYPE)
+	MAP_NBYTES = fcb->cellhd.format + 1;
     fcb->data = (unsigned char *)G_calloc(fcb->cellhd.cols, MAP_NBYTES);
 
     /* initialize/read in quant rules for float point maps */
@@ -360,8 +366,10 @@ int Rast__open_old(const char *name, const char *mapset)
     fcb->null_row_ptr = NULL;
 
     if (!gdal && !vrt) {
-	/* First, check for compressed null file */
-	fcb->null_fd = G_open_old_misc("cell_misc", NULL_FILE, r_name, r_mapset);
+	/* First, check for compressed null file
+	   (the null file of an overview is already open) */
+	if (!fcb->overview)
+	    fcb->null_fd = G_open_old_misc("cell_misc", NULL_FILE, r_name, r_mapset);
 	if (fcb->null_fd < 0) {
 	    fcb->null_fd = G_open_old_misc("cell_misc", NULLC_FILE, r_name, r_mapset);
 	    if (fcb->null_fd >= 0) {
@@ -375,6 +383,13 @@ int Rast__open_old(const char *name, const char *mapset)
 	    }
 	}
 	fcb->null_file_exists = fcb->null_fd >= 0;
+
+	if (R__.read_ahead > 0)
+	    Rast_set_read_ahead(fd, R__.read_ahead);
+	if (R__.use_mmap)
+	    Rast_set_mmap(fd, 1);
+	if (R__.row_cache_mb > 0)
+	    Rast_set_row_cache(fd, 1);
     }
 
     return fd;
@@ -745,6 +760,12 @@ static int open_raster_new(const char *name, int open_mode,
     fcb->open_mode = open_mode;
     fcb->io_error = 0;
 
+    if (R__.tile_size > 0)
+	Rast__init_tiles_write(fd);
+
+    if (R__.write_behind > 0 || R__.compress_auto)
+	Rast_set_write_behind(fd, R__.write_behind);
+
     return fd;
 }
 
@@ -0,0 +1,466 @@
+/*!
+   \file lib/raster/overview.c
+
+   \brief Raster library - Overviews of native raster maps
+
+   An overview of level k is a copy of a raster map resampled (nearest
+   neighbor) to k times its resolution. The overview keeps the north
+   west corner of the map and covers ceil(rows / k) x ceil(cols / k)
+   cells, so the south and east edges may extend beyond the map.
+   Levels are powers of 2. Each level is stored in cell_misc/name as
+   a compressed data file (overview_k) in the format of compressed
+   rows and an uncompressed null file (overview_k_null). The levels
+   and the compressor are recorded in cell_misc/name/overview.
+
+   When a map is opened for reading and the resolution of the current
+   region is at least k times coarser than the map in both directions,
+   the data and null file of the largest such level replace those of
+   the map. For regions aligned with the map at exactly k times its
+   resolution, reading the overview gives the same values as reading
+   the map; for other coarse regions the values are sampled from the
+   overview cells and may differ from a read of the map itself.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <errno.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define OVERVIEW_FILE "overview"
+#define MAX_LEVELS 30
+/* smallest overview built by Rast_build_overviews() */
+#define MIN_OVERVIEW_SIZE 256
+/* tolerance comparing resolutions */
+#define EPSILON 1.0e-6
+
+static void data_name(char *name, int level)
+{
+    sprintf(name, "%s_%d", OVERVIEW_FILE, level);
+}
+
+static void null_name(char *name, int level)
+{
+    sprintf(name, "%s_%d_null", OVERVIEW_FILE, level);
+}
+
+/* geometry of overview level (cell header of the data file) */
+static void overview_window(const struct Cell_head *cellhd, int level,
+			    int compressor, RASTER_MAP_TYPE map_type,
+			    struct Cell_head *ovr)
+{
+    *ovr = *cellhd;
+    ovr->rows = (cellhd->rows + level - 1) / level;
+    ovr->cols = (cellhd->cols + level - 1) / level;
+    ovr->ns_res = cellhd->ns_res * level;
+    ovr->ew_res = cellhd->ew_res * level;
+    ovr->south = ovr->north - ovr->rows * ovr->ns_res;
+    ovr->east = ovr->west + ovr->cols * ovr->ew_res;
+    ovr->compressed = compressor;
+    ovr->format = map_type == CELL_TYPE ? sizeof(CELL) - 1 : -1;
+}
+
+static int read_levels(const char *name, const char *mapset, int *levels,
+		       int *compressor)
+{
+    char path[GPATH_MAX];
+    struct Key_Value *keys;
+    const char *str;
+    char **tokens;
+    int i, n = 0;
+
+    G_file_name_misc(path, "cell_misc", OVERVIEW_FILE, name, mapset);
+    if (access(path, 0) != 0)
+	return 0;
+
+    keys = G_read_key_value_file(path);
+    *compressor = (str = G_find_key_value("compressor", keys)) ?
+	atoi(str) : 0;
+
+    if ((str = G_find_key_value("levels", keys))) {
+	tokens = G_tokenize(str, " ");
+	for (i = 0; tokens[i] && n < MAX_LEVELS; i++)
+	    if ((levels[n] = atoi(tokens[i])) >= 2)
+		n++;
+	G_free_tokens(tokens);
+    }
+    G_free_key_value(keys);
+
+    if (*compressor < 2 || !G_check_compressor(*compressor)) {
+	G_warning(_("Invalid or unsupported overview compressor in '%s'"),
+		  path);
+	return 0;
+    }
+
+    return n;
+}
+
+/*!
+   \brief Enable or disable the use of overviews
+
+   Applies to raster maps opened afterwards. Modules which need the
+   values of the map itself in coarse regions can disable overviews. The
+   default is given by the environment variable GRASS_RASTER_OVERVIEWS
+   (enabled unless set to 0).
+
+   \param enable 1 to use overviews, 0 to read the maps only
+ */
+void Rast_set_overviews(int enable)
+{
+    Rast__init();
+
+    R__.use_overviews = enable;
+}
+
+/*!
+   \brief Replace the data file of a map being opened by an overview
+   (internal use only)
+
+   Called by Rast__open_old() before the format of the data file is
+   checked. Selects the largest overview level which is not finer than
+   the current region, and makes the overview data and null file the
+   files of the map: the cell header in the file descriptor is changed
+   to the geometry of the overview.
+
+   \param fd file descriptor
+   \param name name of the map with the data file
+   \param mapset mapset
+
+   \return overview level in use, 0 for none
+ */
+int Rast__open_overview(int fd, const char *name, const char *mapset)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int levels[MAX_LEVELS];
+    int nlevels, compressor;
+    double ratio, ew_ratio;
+    char element[GNAME_MAX];
+    int i, level, data_fd, null_fd;
+
+    if (!R__.use_overviews)
+	return 0;
+
+    ratio = R__.rd_window.ns_res / fcb->cellhd.ns_res;
+    ew_ratio = R__.rd_window.ew_res / fcb->cellhd.ew_res;
+    if (ew_ratio < ratio)
+	ratio = ew_ratio;
+    if (ratio < 2 * (1 - EPSILON))
+	return 0;
+
+    nlevels = read_levels(name, mapset, levels, &compressor);
+
+    level = 0;
+    for (i = 0; i < nlevels; i++)
+	if (levels[i] > level && levels[i] <= ratio * (1 + EPSILON))
+	    level = levels[i];
+    if (!level)
+	return 0;
+
+    data_name(element, level);
+    data_fd = G_open_old_misc("cell_misc", element, name, mapset);
+    null_name(element, level);
+    null_fd = G_open_old_misc("cell_misc", element, name, mapset);
+    if (data_fd < 0 || null_fd < 0) {
+	G_warning(_("Unable to open overview level %d of raster map <%s@%s>"),
+		  level, name, mapset);
+	if (data_fd >= 0)
+	    close(data_fd);
+	if (null_fd >= 0)
+	    close(null_fd);
+	return 0;
+    }
+
+    overview_window(&fcb->cellhd, level, compressor, fcb->map_type,
+		    &fcb->cellhd);
+
+    close(fcb->data_fd);
+    fcb->data_fd = data_fd;
+    fcb->null_fd = null_fd;
+    fcb->overview = level;
+
+    G_debug(2, "Rast__open_overview(): <%s@%s> level %d", name, mapset,
+	    level);
+
+    return level;
+}
+
+static void write_fully(int fd, const void *buf, size_t size,
+			const char *name)
+{
+    const unsigned char *p = buf;
+
+    while (size > 0) {
+	ssize_t n = write(fd, p, size);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    G_fatal_error(_("Error writing overview of raster map <%s>: %s"),
+			  name, strerror(errno));
+	p += n;
+	size -= n;
+    }
+}
+
+/* one row in the format of compressed rows, see Rast__expand_row() */
+static void encode_row(const void *rast, RASTER_MAP_TYPE map_type, int cols,
+		       int compressor, unsigned char *raw, unsigned char *cmp,
+		       int *len, const unsigned char **out)
+{
+    int nbytes = map_type == CELL_TYPE ? sizeof(CELL) :
+	map_type == FCELL_TYPE ? XDR_FLOAT_NBYTES : XDR_DOUBLE_NBYTES;
+    int size = cols * nbytes;
+    int i, n;
+
+    for (i = 0; i < cols; i++) {
+	unsigned char *wk = raw + 1 + i * nbytes;
+
+	if (map_type == CELL_TYPE) {
+	    CELL v = ((const CELL *)rast)[i];
+	    int neg = 0;
+	    int k;
+
+	    if (Rast_is_c_null_value(&v))
+		v = 0;
+	    if (v < 0) {
+		neg = 1;
+		v = -v;
+	    }
+	    for (k = nbytes - 1; k >= 0; k--) {
+		wk[k] = v & 0xff;
+		v >>= 8;
+	    }
+	    if (neg)
+		wk[0] |= 0x80;
+	}
+	else if (map_type == FCELL_TYPE) {
+	    FCELL f = ((const FCELL *)rast)[i];
+
+	    if (Rast_is_f_null_value(&f))
+		f = 0.;
+	    G_xdr_put_float(wk, &f);
+	}
+	else {
+	    DCELL d = ((const DCELL *)rast)[i];
+
+	    if (Rast_is_d_null_value(&d))
+		d = 0.;
+	    G_xdr_put_double(wk, &d);
+	}
+    }
+
+    /* leading byte: bytes per cell for CELL, compression flag for FP */
+    n = G_compress(raw + 1, size, cmp + 1, size, compressor);
+    if (n > 0 && n < size) {
+	cmp[0] = map_type == CELL_TYPE ? nbytes : '1';
+	*out = cmp;
+	*len = n + 1;
+    }
+    else {
+	raw[0] = map_type == CELL_TYPE ? nbytes : '0';
+	*out = raw;
+	*len = size + 1;
+    }
+}
+
+static void write_level(const char *name, RASTER_MAP_TYPE map_type,
+			const struct Cell_head *ovr, int level)
+{
+    char element[GNAME_MAX];
+    int fd, data_fd, null_fd;
+    int row, col;
+    off_t *row_ptr;
+    void *rast;
+    char *zero_ones;
+    unsigned char *null_bits, *raw, *cmp;
+    size_t cellsize = Rast_cell_size(map_type);
+    size_t size = (size_t) ovr->cols * sizeof(DCELL) + 1;
+
+    data_name(element, level);
+    data_fd = G_open_new_misc("cell_misc", element, name);
+    null_name(element, level);
+    null_fd = G_open_new_misc("cell_misc", element, name);
+    if (data_fd < 0 || null_fd < 0)
+	G_fatal_error(_("Unable to create overview of raster map <%s>"),
+		      name);
+
+    /* the region is the geometry of the overview */
+    fd = Rast__open_old(name, G_mapset());
+
+    row_ptr = G_calloc(ovr->rows + 1, sizeof(off_t));
+    Rast__write_overview_row_ptrs(data_fd, ovr->rows, row_ptr);
+
+    rast = G_malloc(ovr->cols * cellsize);
+    zero_ones = G_malloc(ovr->cols);
+    null_bits = Rast__allocate_null_bits(ovr->cols);
+    raw = G_malloc(size);
+    cmp = G_malloc(size);
+
+    for (row = 0; row < ovr->rows; row++) {
+	const unsigned char *out;
+	int len;
+	void *p;
+
+	G_percent(row, ovr->rows, 2);
+
+	Rast_get_row_nomask(fd, rast, row, map_type);
+
+	for (col = 0, p = rast; col < ovr->cols; col++) {
+	    zero_ones[col] = Rast_is_null_value(p, map_type);
+	    p = G_incr_void_ptr(p, cellsize);
+	}
+	Rast__convert_01_flags(zero_ones, null_bits, ovr->cols);
+	write_fully(null_fd, null_bits, Rast__null_bitstream_size(ovr->cols),
+		    name);
+
+	row_ptr[row] = lseek(data_fd, 0L, SEEK_CUR);
+	encode_row(rast, map_type, ovr->cols, ovr->compressed, raw, cmp,
+		   &len, &out);
+	write_fully(data_fd, out, len, name);
+    }
+    G_percent(row, ovr->rows, 2);
+
+    row_ptr[ovr->rows] = lseek(data_fd, 0L, SEEK_CUR);
+    if (!Rast__write_overview_row_ptrs(data_fd, ovr->rows, row_ptr))
+	G_fatal_error(_("Error writing overview of raster map <%s>: %s"),
+		      name, strerror(errno));
+
+    Rast_close(fd);
+    close(data_fd);
+    close(null_fd);
+
+    G_free(row_ptr);
+    G_free(rast);
+    G_free(zero_ones);
+    G_free(null_bits);
+    G_free(raw);
+    G_free(cmp);
+}
+
+/*!
+   \brief Build the overviews of a raster map
+
+   Removes existing overviews of the map and builds the levels 2, 4,
+   8, ... down to a size of about 256 x 256 cells. The map must be a
+   native raster map in the current mapset and not a reclass. The
+   overviews are compressed with the compressor of new raster maps
+   (see GRASS_COMPRESSOR). The map must not be open.
+
+   \param name map name
+
+   \return number of overview levels built
+ */
+int Rast_build_overviews(const char *name)
+{
+    struct Cell_head cellhd, window, ovr;
+    RASTER_MAP_TYPE map_type;
+    char rname[GNAME_MAX], rmapset[GMAPSET_MAX];
+    int level, nlevels, size, compressor, use_overviews;
+    struct Key_Value *keys;
+    char path[GPATH_MAX], buf[32], levels[MAX_LEVELS * 12];
+
+    Rast__init();
+
+    if (!G_find_raster2(name, G_mapset()))
+	G_fatal_error(_("Raster map <%s> not found in current mapset"), name);
+    if (Rast_is_reclass(name, G_mapset(), rname, rmapset) > 0)
+	G_fatal_error(_("Raster map <%s> is a reclass of <%s@%s>, "
+			"build the overviews of the base map"),
+		      name, rname, rmapset);
+    if (G_find_file2_misc("cell_misc", "gdal", name, G_mapset()) ||
+	G_find_file2_misc("cell_misc", "vrt", name, G_mapset()))
+	G_fatal_error(_("Overviews are supported for native raster maps only"));
+
+    Rast_remove_overviews(name);
+
+    Rast_get_cellhd(name, G_mapset(), &cellhd);
+    map_type = Rast_map_type(name, G_mapset());
+
+    /* RLE is not supported for compressed FP rows */
+    compressor = R__.compression_type;
+    if (compressor < 2)
+	compressor = 2;
+
+    /* read the map itself at the resolution of each level */
+    window = R__.rd_window;
+    use_overviews = R__.use_overviews;
+    R__.use_overviews = 0;
+
+    size = cellhd.rows > cellhd.cols ? cellhd.rows : cellhd.cols;
+    levels[0] = '\0';
+    nlevels = 0;
+    for (level = 2; size / level >= MIN_OVERVIEW_SIZE &&
+	 nlevels < MAX_LEVELS; level *= 2) {
+	G_verbose_message(_("Building overview level %d..."), level);
+
+	overview_window(&cellhd, level, compressor, map_type, &ovr);
+	/* not Rast_set_window(): the edges may be outside of the
+	   valid range of lat/lon regions */
+	R__.rd_window = ovr;
+
+	write_level(name, map_type, &ovr, level);
+
+	sprintf(buf, nlevels ? " %d" : "%d", level);
+	strcat(levels, buf);
+	nlevels++;
+    }
+
+    R__.rd_window = window;
+    R__.use_overviews = use_overviews;
+
+    if (nlevels) {
+	keys = G_create_key_value();
+	G_set_key_value("levels", levels, keys);
+	sprintf(buf, "%d", compressor);
+	G_set_key_value("compressor", buf, keys);
+	G_file_name_misc(path, "cell_misc", OVERVIEW_FILE, name, G_mapset());
+	G_write_key_value_file(path, keys);
+	G_free_key_value(keys);
+    }
+
+    return nlevels;
+}
+
+/*!
+   \brief Remove the overviews of a raster map
+
+   Called when the data or null file of a map in the current mapset
+   is replaced.
+
+   \param name map name
+
+   \return number of overview levels removed
+ */
+int Rast_remove_overviews(const char *name)
+{
+    int levels[MAX_LEVELS];
+    int i, nlevels, compressor;
+    char element[GNAME_MAX];
+
+    if (!G_find_file2_misc("cell_misc", OVERVIEW_FILE, name, G_mapset()))
+	return 0;
+
+    nlevels = read_levels(name, G_mapset(), levels, &compressor);
+
+    for (i = 0; i < nlevels; i++) {
+	data_name(element, levels[i]);
+	G_remove_misc("cell_misc", element, name);
+	null_name(element, levels[i]);
+	G_remove_misc("cell_misc", element, name);
+    }
+    G_remove_misc("cell_misc", OVERVIEW_FILE, name);
+
+    return nlevels;
+}
@@ -29,7 +29,44 @@
 
 #include "R.h"
 
+#define MAX_WRITE_BEHIND 256
+/* rows sampled for GRASS_COMPRESSOR=AUTO */
+#define AUTO_SAMPLE_ROWS 16
+
+/* first byte of a compressed fp row, see lib/gis/compress.c */
+#define COMPRESSED_NO  '0'
+#define COMPRESSED_YES '1'
+
+struct wb_slot
+{
+    int row;			/* data row */
+    int is_fp;
+    int compressor;
+    int n;			/* number of cells */
+    int len;			/* bytes per cell before trimming */
+    int nbytes;			/* bytes per cell after trimming (CELL) */
+    unsigned char *work_buf;	/* converted data */
+    unsigned char *cmp_buf;	/* compressed data */
+    size_t cmp_size;
+    const unsigned char *out;	/* what to write: work_buf or cmp_buf */
+    ssize_t nwrite;
+    void *worker;		/* G_begin_execute() reference */
+};
+
+struct R_writebehind
+{
+    int nslots;
+    int head;			/* oldest pending row */
+    int count;			/* number of pending rows */
+    int sample;			/* rows to queue before choosing the
+				   compressor, 0 once chosen */
+    struct wb_slot *slots;
+};
+
 static void put_raster_row(int, const void *, RASTER_MAP_TYPE, int);
+static void queue_int_row(int, char *, const CELL *, int, int, int);
+static void queue_fp_row(int, char *, const void *, int, int,
+			 RASTER_MAP_TYPE);
 
 /*!
    \brief Writes the next row for cell/fcell/dcell file
@@ -112,6 +149,31 @@ void Rast_put_d_row(int fd, const DCELL * buf)
     Rast_put_row(fd, buf, DCELL_TYPE);
 }
 
+/*!
+   \brief Writes the next rows from one buffer
+
+   Writes <i>nrows</i> rows held one after the other in <i>buf</i>
+   like Rast_put_row() does for each of them. See Rast_get_rows().
+
+   \param fd file descriptor where data is to be written
+   \param buf buffer holding nrows rows of data
+   \param nrows number of rows
+   \param data_type raster map type (CELL_TYPE, FCELL_TYPE, DCELL_TYPE)
+
+   \return void
+ */
+void Rast_put_rows(int fd, const void *buf, int nrows,
+		   RASTER_MAP_TYPE data_type)
+{
+    size_t size = (size_t) R__.fileinfo[fd].cellhd.cols *
+	Rast_cell_size(data_type);
+    int i;
+
+    for (i = 0; i < nrows; i++)
+	put_raster_row(fd, (const unsigned char *)buf + i * size, data_type,
+		       0);
+}
+
 static void write_data(int fd, int row, unsigned char *buf, int n)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
@@ -194,8 +256,23 @@ static void put_fp_data(int fd, char *null_buf, const void *rast,
     if (n <= 0)
 	return;
 
+    if (compressed && fcb->writebehind) {
+	queue_fp_row(fd, null_buf, rast, row, n, data_type);
+	return;
+    }
+
     work_buf = G_malloc(size + 1);
 
+    if (fcb->tiles) {
+	if (data_type == FCELL_TYPE)
+	    convert_float(work_buf, size, null_buf, rast, row, n);
+	else
+	    convert_double(work_buf, size, null_buf, rast, row, n);
+	Rast__put_tile_row(fd, row, work_buf);
+	G_free(work_buf);
+	return;
+    }
+
     if (compressed)
 	set_file_pointer(fd, row);
 
@@ -325,6 +402,342 @@ static int rle_compress(unsigned char *dst, unsigned char *src, int n,
     return (nwrite >= total) ? 0 : nwrite;
 }
 
+/* write-behind: the rows are converted on the calling thread (this
+ * also fills the null row), compressed on the libgis workers and
+ * written in row order when the queue is drained */
+
+static void wb_compress_int(struct wb_slot *s)
+{
+    unsigned char *wk = s->work_buf + 1;
+    int n = s->n;
+    int nbytes = count_bytes(wk, n, s->len);
+    ssize_t nwrite;
+    int total, cmax;
+
+    /* first trim away zero high bytes */
+    if (nbytes < s->len)
+	trim_bytes(wk, n, s->len, s->len - nbytes);
+
+    total = nbytes * n;
+    /* get upper bound of compressed size */
+    if (s->compressor == 1)
+	cmax = total;
+    else
+	cmax = G_compress_bound(total, s->compressor);
+    if (s->cmp_size < (size_t) cmax + 1) {
+	s->cmp_size = cmax + 1;
+	s->cmp_buf = G_realloc(s->cmp_buf, s->cmp_size);
+    }
+
+    s->nbytes = nbytes;
+    s->cmp_buf[0] = s->work_buf[0] = nbytes;
+
+    /* then compress the data */
+    if (s->compressor == 1)
+	nwrite = rle_compress(s->cmp_buf + 1, wk, n, nbytes);
+    else
+	nwrite = G_compress(wk, total, s->cmp_buf + 1, cmax, s->compressor);
+
+    if (nwrite >= total)
+	nwrite = 0;
+
+    if (nwrite > 0) {
+	s->out = s->cmp_buf;
+	s->nwrite = nwrite + 1;
+    }
+    else {
+	s->out = s->work_buf;
+	s->nwrite = total + 1;
+    }
+}
+
+static void wb_compress_fp(struct wb_slot *s)
+{
+    /* converted data start at work_buf + 8 for alignment, the
+     * byte before is the flag for uncompressed rows */
+    unsigned char *src = s->work_buf + 8;
+    int size = s->len * s->n;
+    int cmax = G_compress_bound(size, s->compressor);
+    int err;
+
+    if (s->cmp_size < (size_t) cmax + 1) {
+	s->cmp_size = cmax + 1;
+	s->cmp_buf = G_realloc(s->cmp_buf, s->cmp_size);
+    }
+
+    /* same as G_write_compressed() */
+    err = G_compress(src, size, s->cmp_buf + 1, cmax, s->compressor);
+
+    if (err > 0 && err < size) {
+	s->cmp_buf[0] = COMPRESSED_YES;
+	s->out = s->cmp_buf;
+	s->nwrite = err + 1;
+    }
+    else {
+	src[-1] = COMPRESSED_NO;
+	s->out = src - 1;
+	s->nwrite = size + 1;
+    }
+}
+
+/* runs on a worker thread: must not touch R__ nor call G_fatal_error() */
+static void wb_compress(void *closure)
+{
+    struct wb_slot *s = closure;
+
+    if (s->is_fp)
+	wb_compress_fp(s);
+    else
+	wb_compress_int(s);
+}
+
+/* GRASS_COMPRESSOR=AUTO: the rows queued so far are the sample, they
+ * are compressed once the compressor is chosen */
+static void wb_choose_compressor(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_writebehind *wb = fcb->writebehind;
+    unsigned char **bufs;
+    int *sizes;
+    int i, number;
+
+    wb->sample = 0;
+
+    if (wb->count == 0)
+	return;
+
+    bufs = G_malloc(wb->count * sizeof(unsigned char *));
+    sizes = G_malloc(wb->count * sizeof(int));
+
+    for (i = 0; i < wb->count; i++) {
+	struct wb_slot *s = &wb->slots[(wb->head + i) % wb->nslots];
+
+	if (s->is_fp) {
+	    bufs[i] = s->work_buf + 8;
+	    sizes[i] = s->len * s->n;
+	}
+	else {
+	    /* trimmed as in wb_compress_int() */
+	    int nbytes = count_bytes(s->work_buf + 1, s->n, s->len);
+
+	    bufs[i] = G_malloc(s->len * s->n);
+	    memcpy(bufs[i], s->work_buf + 1, s->len * s->n);
+	    if (nbytes < s->len)
+		trim_bytes(bufs[i], s->n, s->len, s->len - nbytes);
+	    sizes[i] = nbytes * s->n;
+	}
+    }
+
+    number = G_compressor_select(bufs, sizes, wb->count,
+				 R__.compress_target);
+    G_verbose_message(_("Using %s compression for <%s>"),
+		      G_compressor_name(number), fcb->name);
+
+    fcb->cellhd.compressed = number;
+
+    for (i = 0; i < wb->count; i++) {
+	struct wb_slot *s = &wb->slots[(wb->head + i) % wb->nslots];
+
+	if (!s->is_fp)
+	    G_free(bufs[i]);
+	s->compressor = number;
+	G_begin_execute(wb_compress, s, &s->worker, 0);
+    }
+
+    G_free(bufs);
+    G_free(sizes);
+}
+
+static void wb_write_oldest(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_writebehind *wb = fcb->writebehind;
+    struct wb_slot *s;
+
+    if (wb->sample)
+	wb_choose_compressor(fd);
+
+    s = &wb->slots[wb->head];
+
+    G_end_execute(&s->worker);
+
+    set_file_pointer(fd, s->row);
+
+    if (!s->is_fp && fcb->nbytes < s->nbytes)
+	fcb->nbytes = s->nbytes;
+
+    if (write(fcb->data_fd, s->out, s->nwrite) != s->nwrite)
+	G_fatal_error(_("Error writing compressed data for row %d of <%s>: %s"),
+		      s->row, fcb->name, strerror(errno));
+
+    wb->head = (wb->head + 1) % wb->nslots;
+    wb->count--;
+}
+
+static struct wb_slot *wb_next_slot(int fd, int row)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_writebehind *wb = fcb->writebehind;
+    struct wb_slot *s;
+
+    /* bounded memory: wait for the oldest row if the queue is full */
+    if (wb->count == wb->nslots)
+	wb_write_oldest(fd);
+
+    s = &wb->slots[(wb->head + wb->count) % wb->nslots];
+    s->row = row;
+    s->compressor = fcb->cellhd.compressed;
+
+    return s;
+}
+
+static void wb_submit(int fd, struct wb_slot *s)
+{
+    struct R_writebehind *wb = R__.fileinfo[fd].writebehind;
+
+    wb->count++;
+
+    if (!wb->sample)
+	G_begin_execute(wb_compress, s, &s->worker, 0);
+    else if (wb->count >= wb->sample)
+	wb_choose_compressor(fd);
+}
+
+static void queue_int_row(int fd, char *null_buf, const CELL * cell,
+			  int row, int n, int zeros_r_nulls)
+{
+    struct wb_slot *s = wb_next_slot(fd, row);
+
+    s->is_fp = 0;
+    s->n = n;
+    s->len = sizeof(CELL);
+
+    convert_int(s->work_buf + 1, null_buf, cell, n, s->len, zeros_r_nulls);
+
+    wb_submit(fd, s);
+}
+
+static void queue_fp_row(int fd, char *null_buf, const void *rast,
+			 int row, int n, RASTER_MAP_TYPE data_type)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct wb_slot *s = wb_next_slot(fd, row);
+    int size = fcb->nbytes * fcb->cellhd.cols;
+
+    s->is_fp = 1;
+    s->n = n;
+    s->len = fcb->nbytes;
+
+    if (data_type == FCELL_TYPE)
+	convert_float((float *)(s->work_buf + 8), size, null_buf, rast, row, n);
+    else
+	convert_double((double *)(s->work_buf + 8), size, null_buf, rast, row, n);
+
+    wb_submit(fd, s);
+}
+
+/*!
+   \brief Set write-behind depth for a raster map open for writing
+
+   Up to <i>nrows</i> rows written with Rast_put_row() are compressed
+   by worker threads while the caller computes the next rows; the
+   compressed rows are written to the file in row order. Write-behind
+   applies only to compressed native raster maps; for other maps and
+   for <i>nrows</i> = 0 it is disabled. The rows are processed on the
+   libgis workers (see G_init_workers()), the default can be set with
+   the environment variable GRASS_RASTER_WRITEBEHIND.
+
+   With GRASS_COMPRESSOR=AUTO the first rows of a new map are queued
+   until the compressor is chosen from them (see
+   G_compressor_select()), so write-behind is then used with at least
+   that many rows.
+
+   \param fd file descriptor of raster map open for writing
+   \param nrows maximum number of rows pending compression
+ */
+void Rast_set_write_behind(int fd, int nrows)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_writebehind *wb;
+    size_t bufsize;
+    int sample;
+    int i;
+
+    if (fcb->open_mode != OPEN_NEW_COMPRESSED &&
+	fcb->open_mode != OPEN_NEW_UNCOMPRESSED)
+	G_fatal_error(_("Raster map <%s> is not open for writing"),
+		      fcb->name);
+
+    Rast__close_write_behind(fd);
+
+    /* the compressor is chosen before the first row is written */
+    sample = (R__.compress_auto && fcb->cur_row == 0) ? AUTO_SAMPLE_ROWS : 0;
+    if (sample > fcb->cellhd.rows)
+	sample = fcb->cellhd.rows;
+
+    if ((nrows <= 0 && sample <= 0) || fcb->gdal || fcb->tiles ||
+	fcb->open_mode != OPEN_NEW_COMPRESSED)
+	return;
+
+    if (nrows > MAX_WRITE_BEHIND)
+	nrows = MAX_WRITE_BEHIND;
+    if (nrows < sample)
+	nrows = sample;
+
+    G_init_workers();
+
+    /* large enough for CELL and XDR double plus flag byte/alignment */
+    bufsize = (size_t) fcb->cellhd.cols * XDR_DOUBLE_NBYTES + 8;
+
+    wb = G_malloc(sizeof(struct R_writebehind));
+    wb->nslots = nrows;
+    wb->head = 0;
+    wb->count = 0;
+    wb->sample = sample;
+    wb->slots = G_calloc(nrows, sizeof(struct wb_slot));
+    for (i = 0; i < nrows; i++) {
+	wb->slots[i].work_buf = G_malloc(bufsize);
+	wb->slots[i].cmp_buf = NULL;
+	wb->slots[i].cmp_size = 0;
+	wb->slots[i].worker = NULL;
+    }
+
+    fcb->writebehind = wb;
+
+    G_debug(2, "Rast_set_write_behind(): <%s> %d rows", fcb->name, nrows);
+}
+
+/*!
+   \brief Write all pending rows and stop write-behind
+
+   \param fd file descriptor
+ */
+void Rast__close_write_behind(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_writebehind *wb = fcb->writebehind;
+    int i;
+
+    if (!wb)
+	return;
+
+    while (wb->count > 0)
+	wb_write_oldest(fd);
+
+    for (i = 0; i < wb->nslots; i++) {
+	G_free(wb->slots[i].work_buf);
+	if (wb->slots[i].cmp_buf)
+	    G_free(wb->slots[i].cmp_buf);
+    }
+    G_free(wb->slots);
+    G_free(wb);
+
+    fcb->writebehind = NULL;
+
+    /* matches G_init_workers() in Rast_set_write_behind() */
+    G_finish_workers();
+}
+
 static void put_data(int fd, char *null_buf, const CELL * cell,
 		     int row, int n, int zeros_r_nulls)
 {
@@ -340,9 +753,22 @@ static void put_data(int fd, char *null_buf, const CELL * cell,
     if (n <= 0)
 	return;
 
+    if (compressed && fcb->writebehind) {
+	queue_int_row(fd, null_buf, cell, row, n, zeros_r_nulls);
+	return;
+    }
+
     work_buf = G_malloc(fcb->cellhd.cols * sizeof(CELL) + 1);
     wk = work_buf;
 
+    if (fcb->tiles) {
+	/* tiles keep all bytes of a cell */
+	convert_int(work_buf, null_buf, cell, n, sizeof(CELL), zeros_r_nulls);
+	Rast__put_tile_row(fd, row, work_buf);
+	G_free(work_buf);
+	return;
+    }
+
     if (compressed)
 	set_file_pointer(fd, row);
 
@@ -718,6 +1144,9 @@ static void put_raster_row(int fd, const void *buf, RASTER_MAP_TYPE data_type,
 	Rast_row_update_fp_range(buf, fcb->cellhd.cols, &fcb->fp_range,
 				 data_type);
 
+    if (!fcb->gdal)
+	Rast__update_row_stats(fd, fcb->cur_row, buf, null_buf, data_type);
+
     fcb->cur_row++;
 
     /* write the null row for the data row */
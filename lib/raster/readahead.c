@@ -0,0 +1,319 @@
+/*!
+   \file lib/raster/readahead.c
+
+   \brief Raster library - Read-ahead of compressed raster rows
+
+   Rows of a compressed raster map which is read sequentially are
+   fetched and decompressed by the libgis worker threads (see
+   G_begin_execute()) ahead of time, while the caller still consumes
+   the rows in order.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <errno.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define MAX_READ_AHEAD 256
+
+struct ra_slot
+{
+    int row;			/* cell file row, -1 if slot is unused */
+    int status;			/* 1: ok, 0: read error, -1: expand error */
+    int nbytes;			/* bytes per cell of decompressed row */
+    int data_fd;
+    off_t offset;		/* file offset of the row (row_ptr) */
+    size_t readamount;		/* compressed size of the row */
+    int compressed;		/* compressor, see Cell_head */
+    int is_fp;			/* fp map with compressor flag byte */
+    int map_nbytes;		/* bytes per cell in the file */
+    int cols;
+    unsigned char *data;	/* decompressed row */
+    void *worker;		/* G_begin_execute() reference */
+};
+
+struct R_readahead
+{
+    int nslots;
+    int last_row;
+    int stride;
+    struct ra_slot *slots;
+};
+
+static int read_fully(int fd, void *buf, size_t size, off_t offset)
+{
+    unsigned char *p = buf;
+
+    /* pread() doesn't touch the file offset shared with the caller */
+    while (size > 0) {
+	ssize_t n = pread(fd, p, size, offset);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    return 0;
+	p += n;
+	size -= n;
+	offset += n;
+    }
+
+    return 1;
+}
+
+/* runs on a worker thread: must not touch R__ nor call G_fatal_error() */
+static void expand_slot(void *closure)
+{
+    struct ra_slot *s = closure;
+    unsigned char *cmp = G_malloc(s->readamount);
+
+    if (!read_fully(s->data_fd, cmp, s->readamount, s->offset))
+	s->status = 0;
+    else if (Rast__expand_row(cmp, s->readamount, s->compressed, s->is_fp,
+			      s->map_nbytes, s->cols, s->data,
+			      &s->nbytes) < 0)
+	s->status = -1;
+    else
+	s->status = 1;
+
+    G_free(cmp);
+}
+
+static struct ra_slot *find_slot(struct R_readahead *ra, int row)
+{
+    int i;
+
+    for (i = 0; i < ra->nslots; i++)
+	if (ra->slots[i].row == row)
+	    return &ra->slots[i];
+
+    return NULL;
+}
+
+/* is row one of the rows to be read ahead after cur */
+static int is_wanted(const struct R_readahead *ra, int cur, int row)
+{
+    int k;
+
+    if ((row - cur) % ra->stride != 0)
+	return 0;
+
+    k = (row - cur) / ra->stride;
+
+    return k >= 1 && k <= ra->nslots;
+}
+
+static struct ra_slot *free_slot(struct R_readahead *ra, int cur)
+{
+    int i;
+
+    for (i = 0; i < ra->nslots; i++)
+	if (ra->slots[i].row < 0)
+	    return &ra->slots[i];
+
+    /* recycle a slot holding a row which is no longer ahead */
+    for (i = 0; i < ra->nslots; i++) {
+	struct ra_slot *s = &ra->slots[i];
+
+	if (!is_wanted(ra, cur, s->row)) {
+	    G_end_execute(&s->worker);
+	    s->row = -1;
+	    return s;
+	}
+    }
+
+    return NULL;
+}
+
+static void schedule(int fd, int cur)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_readahead *ra = fcb->readahead;
+    int k;
+
+    for (k = 1; k <= ra->nslots; k++) {
+	int row = cur + k * ra->stride;
+	struct ra_slot *s;
+
+	if (row < 0 || row >= fcb->cellhd.rows)
+	    break;
+
+	if (find_slot(ra, row))
+	    continue;
+
+	s = free_slot(ra, cur);
+	if (!s)
+	    break;
+
+	s->row = row;
+	s->status = 1;
+	s->data_fd = fcb->data_fd;
+	s->offset = fcb->row_ptr[row];
+	s->readamount = fcb->row_ptr[row + 1] - fcb->row_ptr[row];
+	s->compressed = fcb->cellhd.compressed;
+	s->is_fp = fcb->map_type != CELL_TYPE;
+	s->map_nbytes = fcb->nbytes;
+	s->cols = fcb->cellhd.cols;
+
+	G_begin_execute(expand_slot, s, &s->worker, 0);
+    }
+}
+
+static void drain(struct R_readahead *ra)
+{
+    int i;
+
+    for (i = 0; i < ra->nslots; i++) {
+	G_end_execute(&ra->slots[i].worker);
+	ra->slots[i].row = -1;
+    }
+}
+
+/*!
+   \brief Set read-ahead depth for a raster map open for reading
+
+   The next <i>nrows</i> rows (following the direction and step of
+   the previous reads) are read and decompressed by worker threads
+   while the caller processes the current one. Read-ahead applies
+   only to compressed native raster maps; for other maps and for
+   <i>nrows</i> = 0 it is disabled. The rows are processed on the
+   libgis workers (see G_init_workers()), the default can be set
+   with the environment variable GRASS_RASTER_READAHEAD.
+
+   \param fd file descriptor of raster map open for reading
+   \param nrows number of rows to read ahead
+ */
+void Rast_set_read_ahead(int fd, int nrows)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_readahead *ra;
+    size_t bufsize;
+    int i;
+
+    if (fcb->open_mode != OPEN_OLD)
+	G_fatal_error(_("Raster map <%s> is not open for reading"),
+		      fcb->name);
+
+    Rast__close_read_ahead(fd);
+
+    if (nrows <= 0 || fcb->gdal || fcb->vrt || fcb->tiles ||
+	!fcb->cellhd.compressed)
+	return;
+
+#ifdef __MINGW32__
+    G_debug(1, "Raster read-ahead not supported on this platform");
+    return;
+#endif
+
+    if (nrows > MAX_READ_AHEAD)
+	nrows = MAX_READ_AHEAD;
+    if (nrows > fcb->cellhd.rows)
+	nrows = fcb->cellhd.rows;
+
+    G_init_workers();
+
+    bufsize = (size_t) fcb->cellhd.cols * fcb->nbytes;
+
+    ra = G_malloc(sizeof(struct R_readahead));
+    ra->nslots = nrows;
+    ra->last_row = -1;
+    ra->stride = 1;
+    ra->slots = G_calloc(nrows, sizeof(struct ra_slot));
+    for (i = 0; i < nrows; i++) {
+	ra->slots[i].row = -1;
+	ra->slots[i].worker = NULL;
+	ra->slots[i].data = G_malloc(bufsize);
+    }
+
+    fcb->readahead = ra;
+
+    G_debug(2, "Rast_set_read_ahead(): <%s> %d rows", fcb->name, nrows);
+}
+
+/*!
+   \brief Get a row from the read-ahead pipeline
+
+   Called by read_data() in get_row.c with a cell file row. Schedules
+   the rows following <i>row</i> for decompression.
+
+   \param fd file descriptor
+   \param row cell file row
+   \param data_buf buffer for the decompressed row (fcb->data)
+   \param[out] nbytes bytes per cell of the decompressed row
+
+   \return 1 if row was served from the pipeline
+   \return 0 if row must be read by the caller
+ */
+int Rast__read_ahead(int fd, int row, unsigned char *data_buf, int *nbytes)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_readahead *ra = fcb->readahead;
+    struct ra_slot *s;
+
+    if (ra->last_row >= 0 && row != ra->last_row)
+	ra->stride = row - ra->last_row;
+    ra->last_row = row;
+
+    s = find_slot(ra, row);
+    if (s) {
+	G_end_execute(&s->worker);
+	s->row = -1;
+
+	if (s->status == 0)
+	    G_fatal_error(_("Error reading raster data for row %d of <%s>"),
+			  row, fcb->name);
+	if (s->status < 0)
+	    G_fatal_error(_("Error uncompressing raster data for row %d of <%s>"),
+			  row, fcb->name);
+
+	*nbytes = s->nbytes;
+	if (data_buf == fcb->data) {
+	    /* both buffers have the same size, swap instead of copy */
+	    fcb->data = s->data;
+	    s->data = data_buf;
+	}
+	else
+	    memcpy(data_buf, s->data, (size_t) fcb->cellhd.cols * s->nbytes);
+    }
+
+    schedule(fd, row);
+
+    return s != NULL;
+}
+
+/*!
+   \brief Stop read-ahead for a raster map and free its buffers
+
+   \param fd file descriptor
+ */
+void Rast__close_read_ahead(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_readahead *ra = fcb->readahead;
+    int i;
+
+    if (!ra)
+	return;
+
+    drain(ra);
+
+    for (i = 0; i < ra->nslots; i++)
+	G_free(ra->slots[i].data);
+    G_free(ra->slots);
+    G_free(ra);
+
+    fcb->readahead = NULL;
+
+    /* matches G_init_workers() in Rast_set_read_ahead() */
+    G_finish_workers();
+}
@@ -0,0 +1,324 @@
+/*!
+   \file lib/raster/rowcache.c
+
+   \brief Raster library - Session cache of decompressed raster rows
+
+   Modules run one after the other in a session often read the same
+   compressed maps again (e.g. r.slope.aspect, r.mapcalc and r.univar
+   on one elevation map), each decompressing all rows anew. With the
+   row cache, the decompressed rows of a map are kept in a file in the
+   temporary directory of the current mapset, which is mapped into
+   memory by every module reading the map. A row is decompressed by
+   the first module which reads it and then used by the later modules
+   straight from the mapping, i.e. from the page cache shared by all
+   processes, without copying.
+
+   The cache of a map is identified by the name and mapset of the map
+   and the modification time, size and inode of its data file; it is
+   recreated when the map has been changed. Since rows of the data
+   file are cached, the cache is independent of the region. The files
+   are named after the session (GIS_LOCK) and removed with the other
+   temporary files of the session.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define ROWCACHE_MAGIC "GRROWC1"
+#define BYTE_ORDER_MARK 0x01020304
+/* the status bytes and the rows start at page boundaries */
+#define ROWCACHE_ALIGN 4096
+
+struct rc_header
+{
+    char magic[8];
+    int byte_order;
+    int rows, cols, nbytes, compressed, map_type;
+    int64_t mtime, size, inode;	/* of the data file */
+    char name[GNAME_MAX];
+    char mapset[GMAPSET_MAX];
+};
+
+struct R_rowcache
+{
+    int fd;			/* cache file */
+    const unsigned char *base;	/* mapping of the cache file */
+    size_t size;
+    off_t status_offset;	/* one byte per row, bytes per cell or 0 */
+    off_t rows_offset;
+    size_t row_size;		/* bytes of a row with all cell bytes */
+    int failed;			/* rows can't be added (e.g. disk full) */
+};
+
+static int perf_hits;
+
+#ifndef __MINGW32__
+static off_t align(off_t offset)
+{
+    return (offset + ROWCACHE_ALIGN - 1) / ROWCACHE_ALIGN * ROWCACHE_ALIGN;
+}
+
+static unsigned int hash_name(const char *name, const char *mapset)
+{
+    unsigned int h = 5381;
+    const char *p;
+
+    for (p = name; *p; p++)
+	h = h * 33 + (unsigned char)*p;
+    h = h * 33 + '@';
+    for (p = mapset; *p; p++)
+	h = h * 33 + (unsigned char)*p;
+
+    /* file names of the form pid.n are removed by clean_temp */
+    return h & 0x7fffffff;
+}
+
+/* open the cache file if it has the header, else create it */
+static int open_cache_file(const char *path, const struct rc_header *header,
+			   size_t size)
+{
+    struct rc_header old;
+    struct stat st;
+    char tmp[GPATH_MAX];
+    int fd;
+
+    fd = open(path, O_RDWR);
+    if (fd >= 0) {
+	if (pread(fd, &old, sizeof(old), 0) == sizeof(old) &&
+	    memcmp(&old, header, sizeof(old)) == 0 &&
+	    fstat(fd, &st) == 0 && (size_t) st.st_size == size)
+	    return fd;
+	/* another map of the same hash or the map has been changed,
+	   modules still using the old file keep their mapping */
+	close(fd);
+    }
+
+    /* created under another name, so that no module opens it
+       before it is complete */
+    sprintf(tmp, "%s.%d", path, getpid());
+    fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+	return -1;
+
+    if (pwrite(fd, header, sizeof(*header), 0) != sizeof(*header) ||
+	ftruncate(fd, (off_t) size) != 0 || rename(tmp, path) != 0) {
+	close(fd);
+	unlink(tmp);
+	return -1;
+    }
+
+    return fd;
+}
+#endif
+
+/*!
+   \brief Use the session cache of decompressed rows for a raster map
+
+   Applies to compressed native raster maps open for reading. Rows
+   found in the cache are used without reading and decompressing
+   them; the other rows are added to the cache when they are read.
+   Maps whose decompressed rows would take more than the size given
+   by the environment variable GRASS_RASTER_ROW_CACHE (in MB) are not
+   cached. The default for all maps is set by this variable as well.
+
+   \param fd file descriptor of raster map open for reading
+   \param enable non-zero to use the cache, 0 to stop using it
+ */
+void Rast_set_row_cache(int fd, int enable)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+#ifndef __MINGW32__
+    struct R_rowcache *c;
+    struct rc_header header;
+    struct stat st;
+    char element[GPATH_MAX], name[GNAME_MAX], path[GPATH_MAX];
+    const char *lock;
+    off_t status_offset, rows_offset;
+    size_t row_size, size;
+    int cfd;
+    void *ptr;
+#endif
+
+    if (fcb->open_mode != OPEN_OLD)
+	G_fatal_error(_("Raster map <%s> is not open for reading"),
+		      fcb->name);
+
+    Rast__close_row_cache(fd);
+
+    if (!enable || fcb->gdal || fcb->vrt || fcb->tiles || fcb->overview ||
+	fcb->data_fd < 0 || !fcb->cellhd.compressed)
+	return;
+
+#ifdef __MINGW32__
+    G_debug(1, "Rast_set_row_cache(): not supported");
+#else
+    /* the files belong to the session */
+    lock = getenv("GIS_LOCK");
+    if (!lock || atoi(lock) <= 0 || fstat(fcb->data_fd, &st) != 0)
+	return;
+
+    row_size = (size_t) fcb->cellhd.cols * fcb->nbytes;
+    status_offset = align(sizeof(struct rc_header));
+    rows_offset = align(status_offset + fcb->cellhd.rows);
+    size = rows_offset + row_size * fcb->cellhd.rows;
+    if (R__.row_cache_mb <= 0 || size > (size_t) R__.row_cache_mb << 20) {
+	G_debug(1, "Rast_set_row_cache(): <%s> too large to be cached",
+		fcb->name);
+	return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, ROWCACHE_MAGIC);
+    header.byte_order = BYTE_ORDER_MARK;
+    header.rows = fcb->cellhd.rows;
+    header.cols = fcb->cellhd.cols;
+    header.nbytes = fcb->nbytes;
+    header.compressed = fcb->cellhd.compressed;
+    header.map_type = fcb->map_type;
+    header.mtime = st.st_mtime;
+    header.size = st.st_size;
+    header.inode = st.st_ino;
+    strncpy(header.name, fcb->name, sizeof(header.name) - 1);
+    strncpy(header.mapset, fcb->mapset, sizeof(header.mapset) - 1);
+
+    G_temp_element(element);
+    sprintf(name, "%d.%u", atoi(lock), hash_name(fcb->name, fcb->mapset));
+    G_file_name(path, element, name, G_mapset());
+
+    cfd = open_cache_file(path, &header, size);
+    if (cfd < 0) {
+	G_debug(1, "Rast_set_row_cache(): unable to open <%s>", path);
+	return;
+    }
+
+    ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, cfd, (off_t) 0);
+    if (ptr == MAP_FAILED) {
+	close(cfd);
+	G_debug(1, "Rast_set_row_cache(): mapping <%s> failed", path);
+	return;
+    }
+
+    c = G_malloc(sizeof(struct R_rowcache));
+    c->fd = cfd;
+    c->base = ptr;
+    c->size = size;
+    c->status_offset = status_offset;
+    c->rows_offset = rows_offset;
+    c->row_size = row_size;
+    c->failed = 0;
+    fcb->row_cache = c;
+
+    G_debug(2, "Rast_set_row_cache(): <%s@%s> in <%s>", fcb->name,
+	    fcb->mapset, path);
+#endif
+}
+
+/*!
+   \brief Get a row from the row cache
+
+   On success the current row of the map points into the cache.
+
+   \param fd file descriptor
+   \param row row of the data file
+   \param[out] nbytes bytes per cell of the row
+
+   \return 1 if the row was found
+   \return 0 if the row is not cached yet
+ */
+int Rast__get_cached_row(int fd, int row, int *nbytes)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_rowcache *c = fcb->row_cache;
+    int n = c->base[c->status_offset + row];
+
+    if (!n)
+	return 0;
+
+    G_perf_count(&perf_hits, "raster.row_cache_hits", 1);
+
+    *nbytes = n;
+    fcb->cur_data = c->base + c->rows_offset + (size_t) row * c->row_size;
+
+    return 1;
+}
+
+/*!
+   \brief Add a decompressed row to the row cache
+
+   The row is written before its status byte, so that other modules
+   never see a row which is not complete. Modules adding the same row
+   at the same time write the same bytes.
+
+   \param fd file descriptor
+   \param row row of the data file
+   \param data decompressed row
+   \param nbytes bytes per cell of the row
+ */
+void Rast__put_cached_row(int fd, int row, const unsigned char *data,
+			  int nbytes)
+{
+#ifndef __MINGW32__
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_rowcache *c = fcb->row_cache;
+    size_t size = (size_t) fcb->cellhd.cols * nbytes;
+    unsigned char status = nbytes;
+
+    if (c->failed)
+	return;
+
+    if (pwrite(c->fd, data, size,
+	       c->rows_offset + (off_t) row * c->row_size) != (ssize_t) size ||
+	pwrite(c->fd, &status, 1, c->status_offset + row) != 1) {
+	G_debug(1, "Rast__put_cached_row(): unable to add rows of <%s>",
+		fcb->name);
+	c->failed = 1;
+    }
+#endif
+}
+
+/*!
+   \brief Stop using the row cache for a raster map
+
+   The cache file is kept for the other modules of the session.
+
+   \param fd file descriptor
+ */
+void Rast__close_row_cache(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_rowcache *c = fcb->row_cache;
+
+    if (!c)
+	return;
+
+#ifndef __MINGW32__
+    munmap((void *)c->base, c->size);
+    close(c->fd);
+#endif
+
+    G_free(c);
+    fcb->row_cache = NULL;
+    /* the current row may point into the mapping */
+    fcb->cur_row = -1;
+    fcb->cur_data = fcb->data;
+}
@@ -0,0 +1,307 @@
+/*!
+   \file lib/raster/rowstats.c
+
+   \brief Raster library - Per-row statistics of native raster maps
+
+   When a new native raster map is closed, the number of non-null
+   cells and the range of the non-null values of every row are written
+   to cell_misc/name/rowstats. Modules can query them for the rows of
+   the current region with Rast_get_row_stats() and skip rows without
+   data, or prune work by value, without reading the rows.
+
+   The file has one record per row of the map: the count as a 4 byte
+   integer followed by the minimum and the maximum as XDR doubles. The
+   statistics are always those of the whole map row, so for a region
+   with fewer columns than the map the count is an upper bound and the
+   range covers the range of the region. A count of 0 means that the
+   row is entirely NULL. The file is removed when the null file of the
+   map is replaced.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define ROWSTATS_FILE "rowstats"
+#define RECORD_SIZE (4 + 2 * XDR_DOUBLE_NBYTES)
+
+struct R_rowstats
+{
+    int rows;
+    int *count;			/* non-null cells per row */
+    DCELL *min, *max;		/* range of non-null cells per row */
+};
+
+static struct R_rowstats *alloc_stats(int rows)
+{
+    struct R_rowstats *rs = G_malloc(sizeof(struct R_rowstats));
+
+    rs->rows = rows;
+    rs->count = G_calloc(rows, sizeof(int));
+    rs->min = G_calloc(rows, sizeof(DCELL));
+    rs->max = G_calloc(rows, sizeof(DCELL));
+
+    return rs;
+}
+
+static void free_stats(struct R_rowstats *rs)
+{
+    G_free(rs->count);
+    G_free(rs->min);
+    G_free(rs->max);
+    G_free(rs);
+}
+
+/* statistics of an old map, NULL if there are none */
+static struct R_rowstats *read_stats(const char *name, const char *mapset,
+				     int rows)
+{
+    struct R_rowstats *rs;
+    unsigned char *buf;
+    FILE *fp;
+    int row;
+
+    if (!G_find_file2_misc("cell_misc", ROWSTATS_FILE, name, mapset))
+	return NULL;
+    fp = G_fopen_old_misc("cell_misc", ROWSTATS_FILE, name, mapset);
+    if (!fp)
+	return NULL;
+
+    buf = G_malloc((size_t) rows * RECORD_SIZE);
+    if (fread(buf, RECORD_SIZE, rows, fp) != (size_t) rows ||
+	fgetc(fp) != EOF) {
+	G_warning(_("Invalid row statistics of raster map <%s@%s>"),
+		  name, mapset);
+	G_free(buf);
+	fclose(fp);
+	return NULL;
+    }
+    fclose(fp);
+
+    rs = alloc_stats(rows);
+    for (row = 0; row < rows; row++) {
+	const unsigned char *p = buf + (size_t) row * RECORD_SIZE;
+
+	G_xdr_get_int(&rs->count[row], p);
+	G_xdr_get_double(&rs->min[row], p + 4);
+	G_xdr_get_double(&rs->max[row], p + 4 + XDR_DOUBLE_NBYTES);
+    }
+    G_free(buf);
+
+    return rs;
+}
+
+/*!
+   \brief Add a row written to a new map to its statistics
+
+   Called by Rast_put_row() for native maps.
+
+   \param fd file descriptor of map open for writing
+   \param row row of the map
+   \param buf row as written by the caller
+   \param null_buf null flags of the row (1 for null cells)
+   \param data_type type of buf
+ */
+void Rast__update_row_stats(int fd, int row, const void *buf,
+			    const char *null_buf, RASTER_MAP_TYPE data_type)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_rowstats *rs;
+    size_t size = Rast_cell_size(data_type);
+    const unsigned char *p = buf;
+    int col, count;
+    DCELL min, max;
+
+    if (row < 0 || row >= fcb->cellhd.rows)
+	return;
+
+    if (!fcb->rowstats)
+	fcb->rowstats = alloc_stats(fcb->cellhd.rows);
+    rs = fcb->rowstats;
+
+    count = 0;
+    min = max = 0;
+    for (col = 0; col < fcb->cellhd.cols; col++, p += size) {
+	DCELL v;
+
+	if (null_buf[col])
+	    continue;
+	v = Rast_get_d_value(p, data_type);
+	if (count++ == 0)
+	    min = max = v;
+	else if (v < min)
+	    min = v;
+	else if (v > max)
+	    max = v;
+    }
+
+    rs->count[row] = count;
+    rs->min[row] = min;
+    rs->max[row] = max;
+}
+
+/*!
+   \brief Write the statistics of a new map
+
+   Called by Rast_close() for native maps, after all rows were written.
+
+   \param fd file descriptor of map open for writing
+ */
+void Rast__write_row_stats(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_rowstats *rs = fcb->rowstats;
+    unsigned char *buf;
+    FILE *fp;
+    int row;
+
+    Rast_remove_row_stats(fcb->name);
+
+    if (!rs)
+	return;
+
+    buf = G_malloc((size_t) rs->rows * RECORD_SIZE);
+    for (row = 0; row < rs->rows; row++) {
+	unsigned char *p = buf + (size_t) row * RECORD_SIZE;
+
+	G_xdr_put_int(p, &rs->count[row]);
+	G_xdr_put_double(p + 4, &rs->min[row]);
+	G_xdr_put_double(p + 4 + XDR_DOUBLE_NBYTES, &rs->max[row]);
+    }
+
+    fp = G_fopen_new_misc("cell_misc", ROWSTATS_FILE, fcb->name);
+    if (!fp ||
+	fwrite(buf, RECORD_SIZE, rs->rows, fp) != (size_t) rs->rows) {
+	G_warning(_("Unable to write row statistics of raster map <%s>"),
+		  fcb->name);
+	if (fp)
+	    fclose(fp);
+	Rast_remove_row_stats(fcb->name);
+    }
+    else if (fclose(fp) != 0) {
+	G_warning(_("Unable to write row statistics of raster map <%s>"),
+		  fcb->name);
+	Rast_remove_row_stats(fcb->name);
+    }
+
+    G_free(buf);
+}
+
+/*!
+   \brief Free the statistics of a map
+
+   \param fd file descriptor of map
+ */
+void Rast__close_row_stats(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+
+    if (fcb->rowstats)
+	free_stats(fcb->rowstats);
+    fcb->rowstats = NULL;
+    fcb->rowstats_read = 0;
+}
+
+/*!
+   \brief Get the statistics of a row of the current region
+
+   The statistics are those of the map row read for window row
+   <i>row</i>: the number of non-null cells and the range of their
+   values (as DCELL, before quantization of floating-point maps read as
+   CELL). They are not known for reclassed maps, GDAL links, virtual
+   rasters, maps read from overviews and maps written before row
+   statistics existed. A MASK is not taken into account, it can only
+   make more cells null.
+
+   If the window does not have the columns of the map, the count is an
+   upper bound of the non-null cells in the window row; a count of 0
+   means that the window row is entirely null. Window rows outside the
+   map have a count of 0.
+
+   \param fd file descriptor of map open for reading
+   \param row window row
+   \param[out] count number of non-null cells in the map row
+   \param[out] min minimum of the non-null cells (NULL if count is 0)
+   \param[out] max maximum of the non-null cells (NULL if count is 0)
+
+   \return 1 if the statistics are known
+   \return 0 otherwise
+ */
+int Rast_get_row_stats(int fd, int row, int *count, DCELL *min, DCELL *max)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    double f;
+    int r;
+
+    if (fcb->open_mode != OPEN_OLD)
+	G_fatal_error(_("Raster map <%s> is not open for reading"),
+		      fcb->name);
+
+    if (fcb->reclass_flag || fcb->gdal || fcb->vrt || fcb->overview)
+	return 0;
+
+    if (!fcb->rowstats_read) {
+	fcb->rowstats = read_stats(fcb->name, fcb->mapset, fcb->cellhd.rows);
+	fcb->rowstats_read = 1;
+    }
+    if (!fcb->rowstats)
+	return 0;
+
+    if (row < 0 || row >= R__.rd_window.rows)
+	G_fatal_error(_("Reading raster map <%s@%s> request for row %d is outside region"),
+		      fcb->name, fcb->mapset, row);
+
+    /* window row to map row, as in Rast_get_row() */
+    f = row * fcb->C1 + fcb->C2;
+    r = (int)f;
+    if (f < r)
+	r--;
+
+    if (r < 0 || r >= fcb->cellhd.rows || fcb->rowstats->count[r] == 0) {
+	if (count)
+	    *count = 0;
+	if (min)
+	    Rast_set_d_null_value(min, 1);
+	if (max)
+	    Rast_set_d_null_value(max, 1);
+	return 1;
+    }
+
+    if (count)
+	*count = fcb->rowstats->count[r];
+    if (min)
+	*min = fcb->rowstats->min[r];
+    if (max)
+	*max = fcb->rowstats->max[r];
+
+    return 1;
+}
+
+/*!
+   \brief Remove the row statistics of a raster map
+
+   Called when the data or null file of a map in the current mapset
+   is replaced.
+
+   \param name map name
+
+   \return 1 if statistics were removed, 0 otherwise
+ */
+int Rast_remove_row_stats(const char *name)
+{
+    if (!G_find_file2_misc("cell_misc", ROWSTATS_FILE, name, G_mapset()))
+	return 0;
+
+    return G_remove_misc("cell_misc", ROWSTATS_FILE, name) > 0;
+}
@@ -139,6 +139,7 @@ static void update_window_mappings(void)
 	/* G_free (R__.mask_buf); */
 	R__.mask_fd = -1;
 	R__.auto_mask = -1;	/* turn off masking */
+	Rast__release_mask_cache();
     }
 
     /* now for each possible open cell file, recreate the window mapping */
@@ -0,0 +1,282 @@
+/****************************************************************************
+ *
+ * MODULE:       test.raster.compress
+ *
+ * AUTHOR(S):    GRASS Development Team
+ *
+ * PURPOSE:      Benchmark of the compressors of lib/gis on the rows of
+ *               raster maps, converted as written by Rast_put_row()
+ *
+ * COPYRIGHT:    (C) 2019 by the GRASS Development Team
+ *
+ *               This program is free software under the GNU General Public
+ *               License (>=v2). Read the file COPYING that comes with GRASS
+ *               for details.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+/* sizes of the XDR encoded cells of FCELL and DCELL maps */
+#define XDR_FLOAT_NBYTES 4
+#define XDR_DOUBLE_NBYTES 8
+
+struct sample
+{
+    int nrows;
+    unsigned char **bufs;
+    int *sizes;
+};
+
+/* CELL rows as in put_row.c: sign and magnitude, most significant byte
+ * first, zero high bytes trimmed per row */
+static int convert_c_row(unsigned char *dst, const CELL * cell, int n)
+{
+    int nbytes = 1, i, k;
+
+    for (i = 0; i < n; i++) {
+	CELL v = Rast_is_c_null_value(&cell[i]) ? 0 : cell[i];
+	unsigned int u = v < 0 ? -(unsigned int)v : (unsigned int)v;
+	int len;
+
+	if (v < 0)
+	    u |= 0x80000000u;
+	for (len = 4; len > 1 && !(u >> (8 * (len - 1))); len--) ;
+	if (nbytes < len)
+	    nbytes = len;
+    }
+
+    for (i = 0; i < n; i++) {
+	CELL v = Rast_is_c_null_value(&cell[i]) ? 0 : cell[i];
+	unsigned int u = v < 0 ? -(unsigned int)v : (unsigned int)v;
+
+	if (v < 0)
+	    u |= 0x80000000u;
+	for (k = 0; k < nbytes; k++)
+	    *dst++ = (u >> (8 * (nbytes - 1 - k))) & 0xff;
+    }
+
+    return nbytes * n;
+}
+
+static int convert_fp_row(unsigned char *dst, const DCELL * cell, int n,
+			  RASTER_MAP_TYPE map_type)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+	DCELL d = Rast_is_d_null_value(&cell[i]) ? 0 : cell[i];
+
+	if (map_type == FCELL_TYPE) {
+	    float f = d;
+
+	    G_xdr_put_float(dst + i * XDR_FLOAT_NBYTES, &f);
+	}
+	else
+	    G_xdr_put_double(dst + i * XDR_DOUBLE_NBYTES, &d);
+    }
+
+    return n * (map_type == FCELL_TYPE ? XDR_FLOAT_NBYTES : XDR_DOUBLE_NBYTES);
+}
+
+/* reads up to max_rows rows spread over the map */
+static RASTER_MAP_TYPE read_sample(const char *name, int max_rows,
+				   struct sample *s)
+{
+    RASTER_MAP_TYPE map_type;
+    struct Cell_head cellhd;
+    void *buf;
+    int fd, i, row;
+
+    Rast_get_cellhd(name, "", &cellhd);
+    Rast_set_window(&cellhd);
+
+    fd = Rast_open_old(name, "");
+    map_type = Rast_get_map_type(fd);
+
+    s->nrows = (max_rows > 0 && max_rows < cellhd.rows) ?
+	max_rows : cellhd.rows;
+    s->bufs = G_malloc(s->nrows * sizeof(unsigned char *));
+    s->sizes = G_malloc(s->nrows * sizeof(int));
+    buf = Rast_allocate_buf(map_type == CELL_TYPE ? CELL_TYPE : DCELL_TYPE);
+
+    for (i = 0; i < s->nrows; i++) {
+	row = (int)((double)i * cellhd.rows / s->nrows);
+	s->bufs[i] = G_malloc((size_t) cellhd.cols * XDR_DOUBLE_NBYTES);
+
+	if (map_type == CELL_TYPE) {
+	    Rast_get_c_row_nomask(fd, buf, row);
+	    s->sizes[i] = convert_c_row(s->bufs[i], buf, cellhd.cols);
+	}
+	else {
+	    Rast_get_d_row_nomask(fd, buf, row);
+	    s->sizes[i] = convert_fp_row(s->bufs[i], buf, cellhd.cols,
+					 map_type);
+	}
+    }
+
+    G_free(buf);
+    Rast_close(fd);
+
+    return map_type;
+}
+
+static void free_sample(struct sample *s)
+{
+    int i;
+
+    for (i = 0; i < s->nrows; i++)
+	G_free(s->bufs[i]);
+    G_free(s->bufs);
+    G_free(s->sizes);
+}
+
+static void report(const char *name, RASTER_MAP_TYPE map_type, int number,
+		   const char *level, struct sample *s, double min_time)
+{
+    struct G_compress_stats stats;
+
+    if (G_compress_benchmark(number, s->bufs, s->sizes, s->nrows, min_time,
+			     &stats) < 0) {
+	G_warning(_("Compressor %s failed on <%s>"),
+		  G_compressor_name(number), name);
+	return;
+    }
+
+    fprintf(stdout, "%s|%s|%s|%s|%.3f|%.1f|%.1f\n", name,
+	    map_type == CELL_TYPE ? "CELL" :
+	    map_type == FCELL_TYPE ? "FCELL" : "DCELL",
+	    G_compressor_name(number), level, stats.ratio,
+	    stats.compress_rate, stats.expand_rate);
+}
+
+int main(int argc, char *argv[])
+{
+    struct GModule *module;
+    struct Option *maps, *methods, *zlib_levels, *zstd_levels, *rows,
+	*mintime, *target;
+    double min_time;
+    int i, j, k, max_rows;
+
+    G_gisinit(argv[0]);
+
+    module = G_define_module();
+    G_add_keyword(_("raster"));
+    G_add_keyword(_("compression"));
+    G_add_keyword(_("benchmark"));
+    module->description =
+	_("Benchmarks compressors on the rows of raster maps.");
+
+    maps = G_define_standard_option(G_OPT_R_MAPS);
+
+    methods = G_define_option();
+    methods->key = "method";
+    methods->type = TYPE_STRING;
+    methods->required = NO;
+    methods->multiple = YES;
+    methods->options = "RLE,ZLIB,LZ4,BZIP2,ZSTD";
+    methods->answer = "RLE,ZLIB,LZ4,BZIP2,ZSTD";
+    methods->description = _("Compressors to benchmark");
+
+    zlib_levels = G_define_option();
+    zlib_levels->key = "zlib_level";
+    zlib_levels->type = TYPE_INTEGER;
+    zlib_levels->required = NO;
+    zlib_levels->multiple = YES;
+    zlib_levels->options = "1-9";
+    zlib_levels->answer = "1,6,9";
+    zlib_levels->description = _("Compression levels of ZLIB");
+
+    zstd_levels = G_define_option();
+    zstd_levels->key = "zstd_level";
+    zstd_levels->type = TYPE_INTEGER;
+    zstd_levels->required = NO;
+    zstd_levels->multiple = YES;
+    zstd_levels->options = "1-19";
+    zstd_levels->answer = "1,3,9,19";
+    zstd_levels->description = _("Compression levels of ZSTD");
+
+    rows = G_define_option();
+    rows->key = "rows";
+    rows->type = TYPE_INTEGER;
+    rows->required = NO;
+    rows->answer = "0";
+    rows->description =
+	_("Number of rows sampled from each map, 0 for all rows");
+
+    mintime = G_define_option();
+    mintime->key = "time";
+    mintime->type = TYPE_DOUBLE;
+    mintime->required = NO;
+    mintime->answer = "0.5";
+    mintime->description =
+	_("Minimum time in seconds of each measurement");
+
+    target = G_define_option();
+    target->key = "target";
+    target->type = TYPE_DOUBLE;
+    target->required = NO;
+    target->description =
+	_("Also report the compressor chosen for this throughput "
+	  "in MB/s as with GRASS_COMPRESSOR=AUTO");
+
+    if (G_parser(argc, argv))
+	exit(EXIT_FAILURE);
+
+    max_rows = atoi(rows->answer);
+    min_time = atof(mintime->answer);
+
+    fprintf(stdout, "map|type|method|level|ratio|compress|expand\n");
+
+    for (i = 0; maps->answers[i]; i++) {
+	struct sample s;
+	RASTER_MAP_TYPE map_type;
+
+	map_type = read_sample(maps->answers[i], max_rows, &s);
+
+	for (j = 0; methods->answers[j]; j++) {
+	    int number = G_compressor_number(methods->answers[j]);
+	    char **levels = NULL;
+
+	    if (G_check_compressor(number) != 1) {
+		G_warning(_("Compressor %s is not available"),
+			  methods->answers[j]);
+		continue;
+	    }
+
+	    if (number == 2)
+		levels = zlib_levels->answers;
+	    else if (number == 5)
+		levels = zstd_levels->answers;
+
+	    if (!levels) {
+		report(maps->answers[i], map_type, number, "-", &s, min_time);
+		continue;
+	    }
+
+	    for (k = 0; levels[k]; k++) {
+		int old = G_set_compressor_level(number, atoi(levels[k]));
+
+		report(maps->answers[i], map_type, number, levels[k], &s,
+		       min_time);
+		G_set_compressor_level(number, old);
+	    }
+	}
+
+	if (target->answer)
+	    G_message(_("<%s>: %s for %s MB/s"), maps->answers[i],
+		      G_compressor_name(G_compressor_select
+					(s.bufs, s.sizes, s.nrows,
+					 atof(target->answer))),
+		      target->answer);
+
+	free_sample(&s);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,74 @@
+"""Test of raster maps written with GRASS_COMPRESSOR=AUTO
+
+@copyright 2019 by the GRASS Development Team
+
+@license This program is free software under the
+GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+import os
+
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+
+class CompressAutoTestCase(TestCase):
+    """Compare maps written with a chosen compressor with default maps"""
+
+    to_remove = []
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule('g.region', n=50, s=0, e=70, w=0, res=1)
+        cls.runModule('r.mapcalc', seed=1,
+                      expression='ref_d = if(rand(0, 10) < 1, null(), '
+                                 'rand(-1000.0, 1000.0))')
+        cls.runModule('r.mapcalc',
+                      expression='ref_c = if(isnull(ref_d), null(), '
+                                 'int(row() * 10 + col() / 7))')
+        cls.to_remove.extend(['ref_d', 'ref_c'])
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule('g.remove', flags='f', type='raster',
+                      name=','.join(cls.to_remove))
+        for name in ('GRASS_COMPRESSOR', 'GRASS_COMPRESSOR_TARGET'):
+            os.environ.pop(name, None)
+
+    def write_auto(self, name, ref, target):
+        os.environ['GRASS_COMPRESSOR'] = 'AUTO'
+        os.environ['GRASS_COMPRESSOR_TARGET'] = str(target)
+        self.assertModule('r.mapcalc',
+                          expression='{n} = {r}'.format(n=name, r=ref))
+        del os.environ['GRASS_COMPRESSOR']
+        del os.environ['GRASS_COMPRESSOR_TARGET']
+        self.to_remove.append(name)
+
+    def test_cell(self):
+        """Test CELL maps for a low and a high throughput target"""
+        self.write_auto('auto_c_slow', 'ref_c', 1)
+        self.write_auto('auto_c_fast', 'ref_c', 1000000)
+        self.assertRastersEqual('auto_c_slow', 'ref_c')
+        self.assertRastersEqual('auto_c_fast', 'ref_c')
+
+    def test_dcell(self):
+        """Test DCELL maps for a low and a high throughput target"""
+        self.write_auto('auto_d_slow', 'ref_d', 1)
+        self.write_auto('auto_d_fast', 'ref_d', 1000000)
+        self.assertRastersEqual('auto_d_slow', 'ref_d')
+        self.assertRastersEqual('auto_d_fast', 'ref_d')
+
+    def test_fcell(self):
+        """Test FCELL map"""
+        self.write_auto('auto_f', 'float(ref_d)', 100)
+        self.assertModule('r.mapcalc', expression='ref_f = float(ref_d)')
+        self.to_remove.append('ref_f')
+        self.assertRastersEqual('auto_f', 'ref_f')
+
+
+if __name__ == '__main__':
+    test()
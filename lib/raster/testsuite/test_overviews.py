@@ -0,0 +1,95 @@
+"""Test of raster overviews
+
+@copyright 2019 by the GRASS Development Team
+
+@license This program is free software under the
+GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+import os
+
+import grass.script as gs
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+
+def overview_file(name):
+    env = gs.gisenv()
+    return os.path.join(env['GISDBASE'], env['LOCATION_NAME'],
+                        env['MAPSET'], 'cell_misc', name, 'overview')
+
+
+class OverviewsTestCase(TestCase):
+    """Compare reads of overviews with reads of the maps"""
+
+    to_remove = []
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule('g.region', n=1024, s=0, e=1100, w=0, res=1)
+        cls.runModule('r.mapcalc', seed=1,
+                      expression='ovr_d = if(rand(0, 10) < 1, null(), '
+                                 'rand(-1000.0, 1000.0))')
+        cls.runModule('r.mapcalc',
+                      expression='ovr_c = if(isnull(ovr_d), null(), '
+                                 'int(ovr_d * 1000))')
+        cls.to_remove.extend(['ovr_d', 'ovr_c'])
+        for name in cls.to_remove:
+            cls.runModule('r.support', flags='o', map=name)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule('g.remove', flags='f', type='raster',
+                      name=','.join(cls.to_remove))
+
+    def tearDown(self):
+        os.environ.pop('GRASS_RASTER_OVERVIEWS', None)
+        self.runModule('g.region', n=1024, s=0, e=1100, w=0, res=1)
+
+    def assert_same_as_map(self, name):
+        """Read name in the current region with and without overviews"""
+        self.assertModule('r.mapcalc', overwrite=True,
+                          expression='ovr_read = ' + name)
+        os.environ['GRASS_RASTER_OVERVIEWS'] = '0'
+        self.assertModule('r.mapcalc', overwrite=True,
+                          expression='map_read = ' + name)
+        del os.environ['GRASS_RASTER_OVERVIEWS']
+        self.to_remove.extend(['ovr_read', 'map_read'])
+        self.assertRastersEqual('ovr_read', 'map_read')
+
+    def test_built(self):
+        """Test that the overviews are recorded"""
+        self.assertFileExists(overview_file('ovr_d'))
+
+    def test_aligned_levels(self):
+        """Test regions aligned with the overview levels"""
+        for res in (2, 4):
+            self.runModule('g.region', n=1024, s=0, e=1100, w=0, res=res)
+            self.assert_same_as_map('ovr_d')
+            self.assert_same_as_map('ovr_c')
+
+    def test_coarse_region(self):
+        """Test that a coarse region reads consistent values"""
+        self.runModule('g.region', n=1024, s=0, e=1100, w=0, res=7)
+        self.assertModule('r.mapcalc', overwrite=True,
+                          expression='ovr_read = ovr_c')
+        self.to_remove.append('ovr_read')
+        self.assertRasterMinMax('ovr_read', refmin=-1000000, refmax=1000000)
+
+    def test_removed_on_overwrite(self):
+        """Test that overwriting a map removes its overviews"""
+        self.assertModule('r.mapcalc', expression='ovr_tmp = ovr_c')
+        self.to_remove.append('ovr_tmp')
+        self.assertModule('r.support', flags='o', map='ovr_tmp')
+        self.assertFileExists(overview_file('ovr_tmp'))
+        self.assertModule('r.mapcalc', overwrite=True,
+                          expression='ovr_tmp = 1')
+        self.assertFalse(os.path.exists(overview_file('ovr_tmp')))
+
+
+if __name__ == '__main__':
+    test()
@@ -0,0 +1,75 @@
+"""Test of per-row statistics of raster maps
+
+@copyright 2019 by the GRASS Development Team
+
+@license This program is free software under the
+GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+import os
+
+import grass.script as gs
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+
+def rowstats_file(name):
+    env = gs.gisenv()
+    return os.path.join(env['GISDBASE'], env['LOCATION_NAME'],
+                        env['MAPSET'], 'cell_misc', name, 'rowstats')
+
+
+class RowStatsTestCase(TestCase):
+    """Test that the row statistics are written and used"""
+
+    to_remove = []
+    rows = 100
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule('g.region', n=cls.rows, s=0, e=120, w=0, res=1)
+        # data in every fourth row only
+        cls.runModule('r.mapcalc',
+                      expression='rowstats_sparse = if(row() % 4 == 1, '
+                                 'col() * 1.5, null())')
+        cls.to_remove.append('rowstats_sparse')
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule('g.remove', flags='f', type='raster',
+                      name=','.join(cls.to_remove))
+        cls.runModule('g.remove', flags='f', type='vector',
+                      name='rowstats_random')
+
+    def test_written(self):
+        """Test that one record per row is written"""
+        path = rowstats_file('rowstats_sparse')
+        self.assertFileExists(path)
+        self.assertEqual(os.path.getsize(path), self.rows * 20)
+
+    def test_removed_on_null_change(self):
+        """Test that replacing the null file removes the statistics"""
+        self.assertModule('r.mapcalc', expression='rowstats_tmp = 1')
+        self.to_remove.append('rowstats_tmp')
+        self.assertFileExists(rowstats_file('rowstats_tmp'))
+        self.assertModule('r.null', map='rowstats_tmp', flags='c')
+        self.assertFalse(os.path.exists(rowstats_file('rowstats_tmp')))
+
+    def test_sampling_skips_empty_rows(self):
+        """Test that sampling a sparse map selects only data cells"""
+        self.assertModule('r.random', input='rowstats_sparse', npoints=50,
+                          vector='rowstats_random', seed=1)
+        self.assertVectorFitsTopoInfo(vector='rowstats_random',
+                                      reference=dict(points=50))
+        self.assertModule('r.random', input='rowstats_sparse', npoints='10%',
+                          vector='rowstats_random', seed=1, overwrite=True)
+        self.assertVectorFitsTopoInfo(vector='rowstats_random',
+                                      reference=dict(points=300))
+
+
+if __name__ == '__main__':
+    test()
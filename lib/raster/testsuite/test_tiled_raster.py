@@ -0,0 +1,74 @@
+"""Test of raster maps stored in tiles
+
+@copyright 2019 by the GRASS Development Team
+
+@license This program is free software under the
+GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+import os
+
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+
+class TiledRasterTestCase(TestCase):
+    """Compare maps written in tiles with maps written in rows"""
+
+    to_remove = []
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        # tiles of 16 cells with partial edge tiles
+        cls.runModule('g.region', n=50, s=0, e=70, w=0, res=1)
+        cls.runModule('r.mapcalc', seed=1,
+                      expression='rows_d = if(rand(0, 10) < 1, null(), '
+                                 'rand(-1000.0, 1000.0))')
+        cls.runModule('r.mapcalc',
+                      expression='rows_c = if(isnull(rows_d), null(), '
+                                 'int(rows_d * 1000))')
+        cls.to_remove.extend(['rows_d', 'rows_c'])
+
+        os.environ['GRASS_RASTER_TILE_SIZE'] = '16'
+        for name in ('c', 'd'):
+            cls.runModule('r.mapcalc',
+                          expression='tiles_{n} = rows_{n}'.format(n=name))
+            cls.to_remove.append('tiles_' + name)
+        cls.runModule('r.mapcalc', expression='tiles_f = float(rows_d)')
+        cls.to_remove.append('tiles_f')
+        del os.environ['GRASS_RASTER_TILE_SIZE']
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule('g.remove', flags='f', type='raster',
+                      name=','.join(cls.to_remove))
+
+    def test_cell(self):
+        """Test tiled CELL map in the full region"""
+        self.assertRastersEqual('tiles_c', 'rows_c')
+
+    def test_dcell(self):
+        """Test tiled DCELL map in the full region"""
+        self.assertRastersEqual('tiles_d', 'rows_d')
+
+    def test_fcell(self):
+        """Test tiled FCELL map"""
+        self.assertModule('r.mapcalc', expression='rows_f = float(rows_d)')
+        self.to_remove.append('rows_f')
+        self.assertRastersEqual('tiles_f', 'rows_f')
+
+    def test_window(self):
+        """Test reading a window crossing tile boundaries"""
+        self.runModule('g.region', n=40, s=13, e=55, w=9, res=1)
+        self.assertRastersEqual('tiles_d', 'rows_d')
+        self.runModule('g.region', n=50, s=0, e=70, w=0, res=3)
+        self.assertRastersEqual('tiles_c', 'rows_c')
+        self.runModule('g.region', n=50, s=0, e=70, w=0, res=1)
+
+
+if __name__ == '__main__':
+    test()
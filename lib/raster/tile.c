@@ -0,0 +1,525 @@
+/*!
+   \file lib/raster/tile.c
+
+   \brief Raster library - Tiled raster data files
+
+   A tiled raster map stores its data as compressed tiles of
+   tile_rows x tile_cols cells instead of compressed rows. The data
+   file starts with an index of tile offsets in the same format as the
+   row address array of compressed maps (see format.c), ordered by
+   tile row, then tile column. Each tile is stored like a compressed
+   floating point row: a flag byte ('1' compressed, '0' not), then the
+   cells row by row in the same byte format as in rows (XDR for
+   floating point maps, 4 byte big-endian for CELL maps). Edge tiles
+   are not padded. The tile size is recorded in cell_misc/name/tile.
+
+   Reading a row decompresses only the tiles covered by the columns
+   of the current region, so reading a window costs in proportion to
+   its size rather than to the width of the map. The null file keeps
+   its row layout.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <errno.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define TILE_FILE "tile"
+#define MAX_TILE_SIZE 4096
+
+struct R_tiles
+{
+    int rows, cols;		/* tile size */
+    int ntr, ntc;		/* number of tile rows and columns */
+    off_t *index;		/* ntr * ntc + 1 tile offsets */
+    int cur_tr;			/* tile row in cache, -1 if none */
+    unsigned char **cache;	/* decompressed tiles of cur_tr */
+    unsigned char *buf;		/* writing: rows of the current tile row */
+};
+
+static struct R_tiles *alloc_tiles(int rows, int cols, int tile_rows,
+				   int tile_cols)
+{
+    struct R_tiles *t = G_calloc(1, sizeof(struct R_tiles));
+
+    t->rows = tile_rows;
+    t->cols = tile_cols;
+    t->ntr = (rows + tile_rows - 1) / tile_rows;
+    t->ntc = (cols + tile_cols - 1) / tile_cols;
+    t->index = G_calloc((size_t) t->ntr * t->ntc + 1, sizeof(off_t));
+    t->cur_tr = -1;
+    t->cache = G_calloc(t->ntc, sizeof(unsigned char *));
+
+    return t;
+}
+
+/* size of tile (tr, tc), edge tiles are smaller */
+static void tile_extent(const struct fileinfo *fcb, int tr, int tc,
+			int *th, int *tw)
+{
+    const struct R_tiles *t = fcb->tiles;
+
+    *th = fcb->cellhd.rows - tr * t->rows;
+    if (*th > t->rows)
+	*th = t->rows;
+    *tw = fcb->cellhd.cols - tc * t->cols;
+    if (*tw > t->cols)
+	*tw = t->cols;
+}
+
+/*!
+   \brief Set the tile size for new raster maps
+
+   New compressed raster maps are written in tiles of
+   <i>size</i> x <i>size</i> cells, 0 selects the row layout. The
+   default is given by the environment variable
+   GRASS_RASTER_TILE_SIZE.
+
+   \param size tile size in cells, 0 for no tiles
+ */
+void Rast_set_tile_size(int size)
+{
+    Rast__init();
+
+    if (size < 0 || size > MAX_TILE_SIZE)
+	G_fatal_error(_("Invalid tile size %d, allowed 0-%d"),
+		      size, MAX_TILE_SIZE);
+
+    R__.tile_size = size;
+}
+
+/*!
+   \brief Get the tile size of a raster map
+
+   \param fd file descriptor
+   \param[out] rows tile rows
+   \param[out] cols tile columns
+
+   \return 1 if the map is tiled
+   \return 0 if the map uses the row layout (rows, cols unchanged)
+ */
+int Rast_get_tile_size(int fd, int *rows, int *cols)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+
+    if (!fcb->tiles)
+	return 0;
+
+    *rows = fcb->tiles->rows;
+    *cols = fcb->tiles->cols;
+
+    return 1;
+}
+
+/*!
+   \brief Read the tile size of a raster map being opened (internal use only)
+
+   \param fd file descriptor
+   \param name name of the map with the data file
+   \param mapset mapset
+
+   \return 1 if the map is tiled, 0 otherwise
+ */
+int Rast__read_tile_format(int fd, const char *name, const char *mapset)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    char path[GPATH_MAX];
+    struct Key_Value *keys;
+    const char *str;
+    int tile_rows = 0, tile_cols = 0;
+
+    G_file_name_misc(path, "cell_misc", TILE_FILE, name, mapset);
+    if (access(path, 0) != 0)
+	return 0;
+
+    keys = G_read_key_value_file(path);
+    if ((str = G_find_key_value("rows", keys)))
+	tile_rows = atoi(str);
+    if ((str = G_find_key_value("cols", keys)))
+	tile_cols = atoi(str);
+    G_free_key_value(keys);
+
+    if (tile_rows <= 0 || tile_cols <= 0 || !fcb->cellhd.compressed)
+	G_fatal_error(_("Invalid tile format in '%s'"), path);
+
+    fcb->tiles = alloc_tiles(fcb->cellhd.rows, fcb->cellhd.cols,
+			     tile_rows, tile_cols);
+
+    return 1;
+}
+
+/*!
+   \brief Get the tile index of a tiled map (internal use only)
+
+   \param fd file descriptor
+   \param[out] ntiles number of tiles
+
+   \return tile offsets (ntiles + 1 entries)
+ */
+off_t *Rast__tile_index(int fd, int *ntiles)
+{
+    struct R_tiles *t = R__.fileinfo[fd].tiles;
+
+    *ntiles = t->ntr * t->ntc;
+
+    return t->index;
+}
+
+static unsigned char *get_tile(int fd, int tr, int tc)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *t = fcb->tiles;
+    int i = tr * t->ntc + tc;
+    off_t offset = t->index[i];
+    ssize_t readamount = t->index[i + 1] - offset;
+    unsigned char *cmp;
+    int th, tw, nbytes;
+
+    if (tr != t->cur_tr) {
+	int j;
+
+	for (j = 0; j < t->ntc; j++) {
+	    G_free(t->cache[j]);
+	    t->cache[j] = NULL;
+	}
+	t->cur_tr = tr;
+    }
+
+    if (t->cache[tc])
+	return t->cache[tc];
+
+    tile_extent(fcb, tr, tc, &th, &tw);
+
+    if (readamount <= 0 || lseek(fcb->data_fd, offset, SEEK_SET) < 0)
+	G_fatal_error(_("Error reading raster data for tile %d,%d of <%s>"),
+		      tr, tc, fcb->name);
+
+    cmp = G_malloc(readamount);
+    if (read(fcb->data_fd, cmp, readamount) != readamount) {
+	G_free(cmp);
+	G_fatal_error(_("Error reading raster data for tile %d,%d of <%s>: %s"),
+		      tr, tc, fcb->name, strerror(errno));
+    }
+
+    t->cache[tc] = G_malloc((size_t) th * tw * fcb->nbytes);
+
+    if (Rast__expand_row(cmp, readamount, fcb->cellhd.compressed, 1,
+			 fcb->nbytes, th * tw, t->cache[tc], &nbytes) < 0)
+	G_fatal_error(_("Error uncompressing raster data for tile %d,%d of <%s>"),
+		      tr, tc, fcb->name);
+
+    G_free(cmp);
+
+    return t->cache[tc];
+}
+
+/*!
+   \brief Read a row of a tiled map (internal use only)
+
+   Only the tiles covering the columns of the current region are
+   read; other columns of <i>data_buf</i> are undefined.
+
+   \param fd file descriptor
+   \param row cell file row
+   \param[out] data_buf row buffer (cellhd.cols * nbytes)
+   \param[out] nbytes bytes per cell
+ */
+void Rast__read_tile_row(int fd, int row, unsigned char *data_buf, int *nbytes)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *t = fcb->tiles;
+    int tr = row / t->rows;
+    int cmin = fcb->cellhd.cols, cmax = -1;
+    int i, tc;
+
+    *nbytes = fcb->nbytes;
+
+    /* file columns used by the window */
+    for (i = 0; i < R__.rd_window.cols; i++) {
+	int c = fcb->col_map[i] - 1;
+
+	if (c < 0)
+	    continue;
+	if (c < cmin)
+	    cmin = c;
+	if (c > cmax)
+	    cmax = c;
+    }
+
+    if (cmax < 0)
+	return;
+
+    for (tc = cmin / t->cols; tc <= cmax / t->cols; tc++) {
+	const unsigned char *tile = get_tile(fd, tr, tc);
+	int th, tw;
+	size_t size;
+
+	tile_extent(fcb, tr, tc, &th, &tw);
+	size = (size_t) tw * fcb->nbytes;
+
+	memcpy(data_buf + (size_t) tc * t->cols * fcb->nbytes,
+	       tile + (row - tr * t->rows) * size, size);
+    }
+}
+
+/*!
+   \brief Read a tile of a tiled map
+
+   Reads the cells of a tile at the resolution of the map, independent
+   of the current region. The tile is returned row by row with a row
+   stride of the tile width given by Rast_get_tile_size(); edge tiles
+   fill only part of <i>buf</i>. Null cells are set to null.
+
+   \param fd file descriptor
+   \param tile_row tile row (0 at the north edge)
+   \param tile_col tile column (0 at the west edge)
+   \param[out] buf buffer for tile_rows * tile_cols cells of <i>data_type</i>
+   \param data_type type of the cells in buf
+ */
+void Rast_get_tile(int fd, int tile_row, int tile_col, void *buf,
+		   RASTER_MAP_TYPE data_type)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *t = fcb->tiles;
+    unsigned char *null_bits;
+    const unsigned char *tile;
+    size_t cell_size = Rast_cell_size(data_type);
+    int th, tw, r, c;
+
+    if (fcb->open_mode != OPEN_OLD)
+	G_fatal_error(_("Raster map <%s> is not open for reading"),
+		      fcb->name);
+    if (!t)
+	G_fatal_error(_("Raster map <%s> is not tiled"), fcb->name);
+    if (tile_row < 0 || tile_row >= t->ntr ||
+	tile_col < 0 || tile_col >= t->ntc)
+	G_fatal_error(_("Tile %d,%d is outside of raster map <%s>"),
+		      tile_row, tile_col, fcb->name);
+
+    tile = get_tile(fd, tile_row, tile_col);
+    tile_extent(fcb, tile_row, tile_col, &th, &tw);
+
+    null_bits = Rast__allocate_null_bits(fcb->cellhd.cols);
+
+    for (r = 0; r < th; r++) {
+	int row = tile_row * t->rows + r;
+	const unsigned char *src = tile + (size_t) r * tw * fcb->nbytes;
+	unsigned char *dst = (unsigned char *)buf + (size_t) r * t->cols * cell_size;
+	int have_nulls = Rast__read_null_bits_row(fd, row, null_bits);
+
+	for (c = 0; c < tw; c++, src += fcb->nbytes, dst += cell_size) {
+	    int col = tile_col * t->cols + c;
+
+	    if (have_nulls && Rast__check_null_bit(null_bits, col,
+						   fcb->cellhd.cols)) {
+		Rast_set_null_value(dst, 1, data_type);
+		continue;
+	    }
+
+	    if (fcb->map_type == CELL_TYPE) {
+		CELL v = ((src[0] & 0x7f) << 24) | (src[1] << 16) |
+		    (src[2] << 8) | src[3];
+
+		Rast_set_c_value(dst, src[0] & 0x80 ? -v : v, data_type);
+	    }
+	    else if (fcb->map_type == FCELL_TYPE) {
+		FCELL f;
+
+		G_xdr_get_float(&f, src);
+		Rast_set_d_value(dst, f, data_type);
+	    }
+	    else {
+		DCELL d;
+
+		G_xdr_get_double(&d, src);
+		Rast_set_d_value(dst, d, data_type);
+	    }
+	}
+    }
+
+    G_free(null_bits);
+}
+
+/*!
+   \brief Set up a new raster map for writing tiles (internal use only)
+
+   Called by open_raster_new() when a tile size is set. The tile index
+   replaces the row address array at the start of the data file.
+
+   \param fd file descriptor
+ */
+void Rast__init_tiles_write(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int size = R__.tile_size;
+
+    if (size <= 0 || fcb->open_mode != OPEN_NEW_COMPRESSED || fcb->gdal)
+	return;
+
+    fcb->tiles = alloc_tiles(fcb->cellhd.rows, fcb->cellhd.cols, size, size);
+    fcb->tiles->buf = G_malloc((size_t) size * fcb->cellhd.cols *
+			       (fcb->map_type == CELL_TYPE ?
+				sizeof(CELL) : fcb->nbytes));
+
+    /* tiles store CELL values with a fixed number of bytes */
+    if (fcb->map_type == CELL_TYPE)
+	fcb->nbytes = sizeof(CELL);
+    /* tiles are compressed like fp rows, which do not use RLE */
+    if (fcb->cellhd.compressed == 1)
+	fcb->cellhd.compressed = 2;
+
+    if (ftruncate(fcb->data_fd, 0) < 0 || Rast__write_tile_index(fd) < 0)
+	G_fatal_error(_("Error writing tile index of <%s>"), fcb->name);
+}
+
+static void write_tile(int fd, int tr, int tc)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *t = fcb->tiles;
+    int nbytes = fcb->nbytes;
+    unsigned char *tile, *cmp;
+    size_t size;
+    int th, tw, r, cmax, nwrite;
+
+    tile_extent(fcb, tr, tc, &th, &tw);
+    size = (size_t) th * tw * nbytes;
+
+    /* gather the part of the buffered rows, after the flag byte */
+    tile = G_malloc(size + 1);
+    for (r = 0; r < th; r++)
+	memcpy(tile + 1 + (size_t) r * tw * nbytes,
+	       t->buf + ((size_t) r * fcb->cellhd.cols + (size_t) tc * t->cols) * nbytes,
+	       (size_t) tw * nbytes);
+
+    cmax = G_compress_bound(size, fcb->cellhd.compressed);
+    cmp = G_malloc(cmax + 1);
+    nwrite = G_compress(tile + 1, size, cmp + 1, cmax, fcb->cellhd.compressed);
+
+    t->index[tr * t->ntc + tc] = lseek(fcb->data_fd, 0L, SEEK_CUR);
+
+    if (nwrite > 0 && (size_t) nwrite < size) {
+	cmp[0] = '1';
+	nwrite++;
+	if (write(fcb->data_fd, cmp, nwrite) != nwrite)
+	    G_fatal_error(_("Error writing compressed data for tile %d,%d of <%s>: %s"),
+			  tr, tc, fcb->name, strerror(errno));
+    }
+    else {
+	tile[0] = '0';
+	if (write(fcb->data_fd, tile, size + 1) != (ssize_t) size + 1)
+	    G_fatal_error(_("Error writing compressed data for tile %d,%d of <%s>: %s"),
+			  tr, tc, fcb->name, strerror(errno));
+    }
+
+    G_free(cmp);
+    G_free(tile);
+}
+
+/*!
+   \brief Buffer a row of a tiled map (internal use only)
+
+   Rows are collected until a row of tiles is complete, then its tiles
+   are compressed and written.
+
+   \param fd file descriptor
+   \param row row number
+   \param data row in file format (cellhd.cols * nbytes)
+ */
+void Rast__put_tile_row(int fd, int row, const unsigned char *data)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *t = fcb->tiles;
+    size_t size = (size_t) fcb->cellhd.cols * fcb->nbytes;
+    int tr = row / t->rows;
+    int tc;
+
+    memcpy(t->buf + (row - tr * t->rows) * size, data, size);
+
+    if ((row + 1) % t->rows != 0 && row != fcb->cellhd.rows - 1)
+	return;
+
+    for (tc = 0; tc < t->ntc; tc++)
+	write_tile(fd, tr, tc);
+}
+
+/*!
+   \brief Finish writing a tiled map (internal use only)
+
+   Writes the tile index and cell_misc/name/tile.
+
+   \param fd file descriptor
+ */
+void Rast__close_tiles_write(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *t = fcb->tiles;
+    struct Key_Value *keys;
+    char path[GPATH_MAX];
+    char buf[32];
+
+    t->index[t->ntr * t->ntc] = lseek(fcb->data_fd, 0L, SEEK_CUR);
+    if (Rast__write_tile_index(fd) < 0)
+	G_fatal_error(_("Error writing tile index of <%s>"), fcb->name);
+
+    keys = G_create_key_value();
+    sprintf(buf, "%d", t->rows);
+    G_set_key_value("rows", buf, keys);
+    sprintf(buf, "%d", t->cols);
+    G_set_key_value("cols", buf, keys);
+
+    G__make_mapset_element_misc("cell_misc", fcb->name);
+    G_file_name_misc(path, "cell_misc", TILE_FILE, fcb->name, fcb->mapset);
+    G_write_key_value_file(path, keys);
+
+    G_free_key_value(keys);
+}
+
+/*!
+   \brief Remove the tile format file of a map (internal use only)
+
+   \param name map name in the current mapset
+ */
+void Rast__remove_tile_format(const char *name)
+{
+    char path[GPATH_MAX];
+
+    G_file_name_misc(path, "cell_misc", TILE_FILE, name, G_mapset());
+    remove(path);
+}
+
+/*!
+   \brief Free the tile buffers of a map (internal use only)
+
+   \param fd file descriptor
+ */
+void Rast__close_tiles(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *t = fcb->tiles;
+    int i;
+
+    if (!t)
+	return;
+
+    for (i = 0; i < t->ntc; i++)
+	G_free(t->cache[i]);
+    G_free(t->cache);
+    G_free(t->index);
+    G_free(t->buf);
+    G_free(t);
+
+    fcb->tiles = NULL;
+}
@@ -2,6 +2,10 @@
   \file lib/raster/vrt.c
   
   \brief Raster Library - virtual GRASS raster maps.
+
+  The tiles of a row are read concurrently by the worker pool and
+  merged in the order of the sorted tiles. A tile is kept open as long
+  as the rows read intersect it.
   
   (C) 2010 by the GRASS Development Team
   
@@ -18,6 +22,17 @@
 
 #include "R.h"
 
+/* rows of the window per band of the tile index */
+#define VRT_BAND_ROWS 64
+
+struct vrt_read
+{
+    int fd;
+    void *buf;
+    int row;
+    RASTER_MAP_TYPE data_type;
+};
+
 int cmp_wnd(const void *a, const void *b)
 {
     struct Cell_head *cellhda = &((struct tileinfo *) a)->cellhd;
@@ -52,6 +67,7 @@ struct R_vrt *Rast_get_vrt(const char *vname, const char *vmapset)
     struct R_vrt *vrt;
     struct Cell_head *rd_window = &R__.rd_window;
     struct ilist *tlist;
+    int i;
 
     tilecount = 0;
     ti = NULL;
@@ -63,7 +79,6 @@ struct R_vrt *Rast_get_vrt(const char *vname, const char *vmapset)
     if (!fp)
 	return NULL;
 
-    tlist = G_new_ilist();
     talloc = 0;
     while (1) {
 	char buf[GNAME_MAX];
@@ -112,12 +127,12 @@ struct R_vrt *Rast_get_vrt(const char *vname, const char *vmapset)
 	    p->cellhd.west < rd_window->east && 
 	    p->cellhd.east >= rd_window->west) {
 	    
-	    int col;
+	    int col, inside, was_inside;
 	    double east;
 	    
-	    G_ilist_add(tlist, tilecount);
-	    
+	    /* runs of columns with their centers inside the tile */
 	    p->clist = G_new_ilist();
+	    was_inside = 0;
 	    for (col = 0; col < rd_window->cols; col++) {
 		east = rd_window->west + rd_window->ew_res * (col + 0.5);
 		
@@ -127,10 +142,26 @@ struct R_vrt *Rast_get_vrt(const char *vname, const char *vmapset)
 		    while (east < p->cellhd.west)
 			east += 360;
 		}
-		if (east >= p->cellhd.west && east < p->cellhd.east)
+		inside = east >= p->cellhd.west && east < p->cellhd.east;
+		if (inside != was_inside)
 		    G_ilist_add(p->clist, col);
+		was_inside = inside;
 	    }
+	    if (was_inside)
+		G_ilist_add(p->clist, rd_window->cols);
+
+	    /* rows possibly covered, checked exactly for each row */
+	    p->row0 = (int)((rd_window->north - p->cellhd.north) /
+			    rd_window->ns_res) - 1;
+	    p->row1 = (int)((rd_window->north - p->cellhd.south) /
+			    rd_window->ns_res) + 1;
+	    if (p->row0 < 0)
+		p->row0 = 0;
+	    if (p->row1 > rd_window->rows - 1)
+		p->row1 = rd_window->rows - 1;
 	}
+	p->fd = -1;
+	p->buf = NULL;
 	tilecount++;
     }
 
@@ -138,11 +169,33 @@ struct R_vrt *Rast_get_vrt(const char *vname, const char *vmapset)
 	qsort(ti, tilecount, sizeof(struct tileinfo), cmp_wnd);
 
     fclose(fp);
+
+    /* indices of the sorted tiles, the tiles of each row are merged
+       in this order */
+    tlist = G_new_ilist();
+    for (i = 0; i < tilecount; i++) {
+	if (ti[i].clist)
+	    G_ilist_add(tlist, i);
+    }
     
     vrt = G_calloc(1, sizeof(struct R_vrt));
     vrt->tilecount = tilecount;
     vrt->tileinfo = ti;
     vrt->tlist = tlist;
+    vrt->open = G_new_ilist();
+
+    vrt->nbands = (rd_window->rows + VRT_BAND_ROWS - 1) / VRT_BAND_ROWS;
+    vrt->bands = G_malloc(vrt->nbands * sizeof(struct ilist *));
+    for (i = 0; i < vrt->nbands; i++)
+	vrt->bands[i] = G_new_ilist();
+    for (i = 0; i < tlist->n_values; i++) {
+	struct tileinfo *p = &ti[tlist->value[i]];
+	int band;
+
+	for (band = p->row0 / VRT_BAND_ROWS;
+	     band <= p->row1 / VRT_BAND_ROWS; band++)
+	    G_ilist_add(vrt->bands[band], tlist->value[i]);
+    }
 
     return vrt;
 }
@@ -160,75 +213,151 @@ void Rast_close_vrt(struct R_vrt *vrt)
 	G_free(p->mapset);
 	if (p->clist)
 	    G_free_ilist(p->clist);
+	if (p->fd >= 0)
+	    Rast_unopen(p->fd);
+	if (p->buf)
+	    G_free(p->buf);
     }
+    for (i = 0; i < vrt->nbands; i++)
+	G_free_ilist(vrt->bands[i]);
+    G_free(vrt->bands);
     G_free(vrt->tileinfo);
     G_free_ilist(vrt->tlist);
+    G_free_ilist(vrt->open);
     G_free(vrt);
 }
 
+static int tile_in_row(const struct tileinfo *p, double rown, double rows)
+{
+    return p->cellhd.north > rows && p->cellhd.south <= rown;
+}
+
+static void read_tile(void *closure)
+{
+    struct vrt_read *r = closure;
+
+    Rast_set_null_value(r->buf, R__.rd_window.cols, r->data_type);
+    Rast_get_row_nomask(r->fd, r->buf, r->row, r->data_type);
+}
+
+/* copy the non-null cells of a tile row inside the column ranges */
+static void merge_tile(void *buf, const struct tileinfo *p,
+		       RASTER_MAP_TYPE data_type)
+{
+    int i, col;
+
+    for (i = 0; i + 1 < p->clist->n_values; i += 2) {
+	int first = p->clist->value[i];
+	int last = p->clist->value[i + 1];
+
+	switch (data_type) {
+	case CELL_TYPE:{
+		CELL *dst = buf;
+		const CELL *src = p->buf;
+
+		for (col = first; col < last; col++)
+		    if (!Rast_is_c_null_value(&src[col]))
+			dst[col] = src[col];
+	    }
+	    break;
+	case FCELL_TYPE:{
+		FCELL *dst = buf;
+		const FCELL *src = p->buf;
+
+		for (col = first; col < last; col++)
+		    if (!Rast_is_f_null_value(&src[col]))
+			dst[col] = src[col];
+	    }
+	    break;
+	case DCELL_TYPE:{
+		DCELL *dst = buf;
+		const DCELL *src = p->buf;
+
+		for (col = first; col < last; col++)
+		    if (!Rast_is_d_null_value(&src[col]))
+			dst[col] = src[col];
+	    }
+	    break;
+	default:
+	    break;
+	}
+    }
+}
+
 /* must only be called by get_map_row_nomask() 
  * move to get_row.c as read_data_vrt() ? */
 int Rast_get_vrt_row(int fd, void *buf, int row, RASTER_MAP_TYPE data_type)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
-    struct R_vrt *vrt = fcb->vrt;
+    struct R_vrt *vrt = R__.fileinfo[fd].vrt;
     struct tileinfo *ti = vrt->tileinfo;
     struct Cell_head *rd_window = &R__.rd_window;
+    struct ilist *band = vrt->bands[row / VRT_BAND_ROWS];
+    struct vrt_read *reads;
     double rown, rows;
-    int i, j;
-    int have_tile;
-    void *tmpbuf;
-    size_t size = Rast_cell_size(data_type);
+    int i, n;
 
     rown = rd_window->north - rd_window->ns_res * row;
     rows = rd_window->north - rd_window->ns_res * (row + 1);
 
     Rast_set_null_value(buf, rd_window->cols, data_type);
-    tmpbuf = Rast_allocate_input_buf(data_type);
-    have_tile = 0;
-
-    for (i = 0; i < vrt->tlist->n_values; i++) {
-	struct tileinfo *p = &ti[vrt->tlist->value[i]];
-
-	if (p->cellhd.north > rows && p->cellhd.south <= rown) {
-	    int tfd;
-	    void *p1, *p2;
-
-	    /* recurse into get_map_row(), collect data for all tiles 
-	     * a mask is applied to the collected data 
-	     * after this function returns */
-	    Rast_set_null_value(tmpbuf, rd_window->cols, data_type);
-	    tfd = Rast_open_old(p->name, p->mapset);
-	    Rast_get_row_nomask(tfd, tmpbuf, row, data_type);
-	    Rast_unopen(tfd);
-	    
-	    p1 = buf;
-	    p2 = tmpbuf;
-	    /* restrict to start and end col ? */
-	    for (j = 0; j < p->clist->n_values; j++) {
-		p1 = (unsigned char *)buf + size * p->clist->value[j];
-		p2 = (unsigned char *)tmpbuf + size * p->clist->value[j];
-		
-		if (!Rast_is_null_value(p2, data_type)) {
-		    switch (data_type) {
-		    case CELL_TYPE:
-			*(CELL *) p1 = *(CELL *) p2;
-			break;
-		    case FCELL_TYPE:
-			*(FCELL *) p1 = *(FCELL *) p2;
-			break;
-		    case DCELL_TYPE:
-			*(DCELL *) p1 = *(DCELL *) p2;
-			break;
-		    default:
-			break;
-		    }
-		}
-	    }
-	    have_tile = 1;
+
+    /* close the tiles left behind before opening new ones */
+    for (i = n = 0; i < vrt->open->n_values; i++) {
+	struct tileinfo *p = &ti[vrt->open->value[i]];
+
+	if (tile_in_row(p, rown, rows)) {
+	    vrt->open->value[n++] = vrt->open->value[i];
+	    continue;
 	}
+	Rast_unopen(p->fd);
+	p->fd = -1;
+	G_free(p->buf);
+	p->buf = NULL;
     }
-    G_free(tmpbuf);
+    vrt->open->n_values = n;
+
+    /* tiles are opened here, R__.fileinfo may move while doing so */
+    reads = G_malloc(band->n_values * sizeof(struct vrt_read));
+    for (i = n = 0; i < band->n_values; i++) {
+	struct tileinfo *p = &ti[band->value[i]];
+
+	if (!tile_in_row(p, rown, rows))
+	    continue;
+
+	if (p->fd < 0) {
+	    p->fd = Rast_open_old(p->name, p->mapset);
+	    p->buf = Rast_allocate_input_buf(DCELL_TYPE);
+	    G_ilist_add(vrt->open, band->value[i]);
+	}
+
+	reads[n].fd = p->fd;
+	reads[n].buf = p->buf;
+	reads[n].row = row;
+	reads[n].data_type = data_type;
+	n++;
+    }
+
+    /* recurse into get_map_row(), collect data for all tiles 
+     * a mask is applied to the collected data 
+     * after this function returns */
+    if (n > 1) {
+	struct G_task_group *g = G_task_group_create();
+
+	for (i = 0; i < n; i++)
+	    G_task_submit(g, read_tile, &reads[i]);
+	G_task_group_destroy(g);
+    }
+    else if (n == 1)
+	read_tile(&reads[0]);
+
+    for (i = 0; i < band->n_values; i++) {
+	struct tileinfo *p = &ti[band->value[i]];
+
+	if (tile_in_row(p, rown, rows))
+	    merge_tile(buf, p, data_type);
+    }
+
+    G_free(reads);
 
-    return have_tile;
+    return n > 0;
 }
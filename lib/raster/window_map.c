@@ -104,6 +104,12 @@ void Rast__create_window_mapping(int fd)
 	}
     }
 
+    /* same resolution and aligned: window columns are data columns */
+    fcb->col_contig = fcb->col_map[0];
+    for (i = 1; i < R__.rd_window.cols && fcb->col_contig; i++)
+	if (fcb->col_map[i] != fcb->col_contig + i)
+	    fcb->col_contig = 0;
+
     G_debug(3, "create window mapping (%d columns)", R__.rd_window.cols);
     /*  for (i = 0; i < R__.rd_window.cols; i++)
        fprintf(stderr, "%s%ld", i % 15 ? " " : "\n", (long)fcb->col_map[i]);
@@ -126,6 +126,8 @@ static int close_old(RASTER3D_Map * map)
 
 static int close_cell_old(RASTER3D_Map * map)
 {
+    Rast3d__close_read_ahead(map);
+
     if (!close_old(map) != 0) {
 	G_warning(_("Unable to close 3D raster map <%s>"), map->fileName);
 	return 0;
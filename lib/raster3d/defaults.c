@@ -8,6 +8,7 @@
 #define RASTER3D_NO_DEFAULT -10
 
 #define RASTER3D_COMPRESSION_DEFAULT RASTER3D_COMPRESSION
+#define RASTER3D_COMPRESSOR_DEFAULT 2	/* ZLIB, readable by older versions */
 #define RASTER3D_PRECISION_DEFAULT RASTER3D_MAX_PRECISION
 #define RASTER3D_CACHE_SIZE_DEFAULT 1000
 #define RASTER3D_CACHE_SIZE_MAX_DEFAULT 16777216
@@ -41,6 +42,12 @@
 */
 #define RASTER3D_COMPRESSION_ENV_VAR_NO "RASTER3D_NO_COMPRESSION"
 
+/*!
+\brief Name of the environmental variable specifying the compression
+       method (ZLIB, LZ4, BZIP2 or ZSTD) of tiles of new maps.
+*/
+#define RASTER3D_COMPRESSOR_ENV_VAR "RASTER3D_COMPRESSOR"
+
 #define RASTER3D_PRECISION_ENV_VAR "RASTER3D_PRECISION"
 #define RASTER3D_PRECISION_ENV_VAR_MAX "RASTER3D_MAX_PRECISION"
 
@@ -63,6 +70,7 @@
 
 int g3d_version = RASTER3D_MAP_VERSION;
 int g3d_do_compression = RASTER3D_NO_DEFAULT;
+int g3d_compressor = RASTER3D_NO_DEFAULT;
 int g3d_precision = RASTER3D_NO_DEFAULT;
 int g3d_cache_default = RASTER3D_NO_DEFAULT;
 int g3d_cache_max = RASTER3D_NO_DEFAULT;
@@ -136,6 +144,48 @@ Rast3d_get_compression_mode(int *doCompress, int *precision)
 /*---------------------------------------------------------------------------*/
 
 
+/*!
+ * \brief set compression method
+ *
+ * Sets the method used to compress the tiles of new maps if compression
+ * is enabled; <em>compressor</em> is a compressor number of the GIS
+ * library other than 0 (see G_compressor_number()). The precision set
+ * with Rast3d_set_compression_mode() is applied before the tiles are
+ * compressed with this method. Maps compressed with other methods than
+ * ZLIB can't be read by GRASS versions before 7.9.
+ *
+ * Calls Rast3d_fatal_error() if the compressor is not available.
+ *
+ * \param compressor compressor number
+ */
+
+void Rast3d_set_compressor(int compressor)
+{
+    if (compressor == 0 || G_check_compressor(compressor) != 1)
+	Rast3d_fatal_error("Rast3d_set_compressor: compressor not available.");
+
+    g3d_compressor = compressor;
+}
+
+/*---------------------------------------------------------------------------*/
+
+
+/*!
+ * \brief get compression method
+ *
+ * \return compressor number used for new maps
+ *
+ * \see Rast3d_set_compressor, RASTER3D_COMPRESSOR_ENV_VAR
+ */
+
+int Rast3d_get_compressor(void)
+{
+    return g3d_compressor;
+}
+
+/*---------------------------------------------------------------------------*/
+
+
 /*!
  * \brief set cache size
  *
@@ -326,6 +376,20 @@ void Rast3d_init_defaults(void)
 	}
     }
 
+    if (g3d_compressor == RASTER3D_NO_DEFAULT) {
+	value = getenv(RASTER3D_COMPRESSOR_ENV_VAR);
+	if (value == NULL || *value == 0) {
+	    g3d_compressor = RASTER3D_COMPRESSOR_DEFAULT;
+	}
+	else {
+	    g3d_compressor = G_compressor_number((char *)value);
+	    if (g3d_compressor < 1 || G_check_compressor(g3d_compressor) != 1) {
+		Rast3d_fatal_error
+		    ("Rast3d_init_defaults: compressor environment variable has invalid value");
+	    }
+	}
+    }
+
     if (g3d_precision == RASTER3D_NO_DEFAULT) {
 	if (NULL != getenv(RASTER3D_PRECISION_ENV_VAR_MAX)) {
 	    g3d_precision = RASTER3D_MAX_PRECISION;
@@ -688,7 +688,7 @@ G_fpcompress_rearrangeDecodeDoubles(unsigned char *src, int size,
 
 int
 Rast3d_fpcompress_write_xdr_nums(int fd, char *src, int nofNum, int precision,
-			  char *compressBuf, int isFloat)
+			  char *compressBuf, int isFloat, int compressor)
 {
     int status;
     int nBytes;
@@ -704,7 +704,8 @@ Rast3d_fpcompress_write_xdr_nums(int fd, char *src, int nofNum, int precision,
 					    &nBytes, &offsetMantissa);
 
 	*compressBuf = 0;
-	status = G_write_compressed(fd, (unsigned char *)compressBuf, nBytes + 1, 2);
+	status = G_write_compressed(fd, (unsigned char *)compressBuf, nBytes + 1,
+				    compressor);
 
     if (status < 0) {
 	Rast3d_error("Rast3d_fpcompress_write_xdr_nums: write error");
@@ -716,31 +717,26 @@ Rast3d_fpcompress_write_xdr_nums(int fd, char *src, int nofNum, int precision,
 
 /*--------------------------------------------------------------------------*/
 
+/* decode nread bytes of an expanded tile in compressBuf into the xdr
+   representation at dst; reentrant */
 int
-Rast3d_fpcompress_read_xdr_nums(int fd, char *dst, int nofNum, int fileBytes,
-			 int precision, char *compressBuf, int isFloat)
+Rast3d__fpcompress_decode_xdr_nums(char *dst, int nofNum, int nread,
+				   int precision, char *compressBuf,
+				   int isFloat)
 {
-    int status;
+    int status = nread;
     int lengthEncode, lengthDecode;
     int nBytes;
     char *src, *dest, *srcStop;
     nBytes = (isFloat ? XDR_FLOAT_LENGTH : XDR_DOUBLE_LENGTH);
 
-    status = G_read_compressed(fd, fileBytes, (unsigned char *)compressBuf,
-			 nofNum * nBytes + 1, 2);
-
-    if (status < 0) {
-	Rast3d_error("Rast3d_fpcompress_read_xdr_nums: read error");
-	return 0;
-    }
-
     /* This code is kept for backward compatibility */
     if (*compressBuf++ == 1) {
 	status--;
 	Rast3d_rle_decode(compressBuf, dst, nofNum * nBytes, 1,
 		     &lengthEncode, &lengthDecode);
 	if (*dst == ALL_NULL_CODE)
-	    Rast3d_fatal_error("Rast3d_fpcompress_read_xdr_nums: wrong code");
+	    return 0;
 
 	if (status == nofNum * nBytes)
 	    status -= lengthDecode - lengthEncode;
@@ -767,3 +763,29 @@ Rast3d_fpcompress_read_xdr_nums(int fd, char *dst, int nofNum, int fileBytes,
 
     return 1;
 }
+
+/*--------------------------------------------------------------------------*/
+
+int
+Rast3d_fpcompress_read_xdr_nums(int fd, char *dst, int nofNum, int fileBytes,
+			 int precision, char *compressBuf, int isFloat,
+			 int compressor)
+{
+    int status;
+    int nBytes;
+    nBytes = (isFloat ? XDR_FLOAT_LENGTH : XDR_DOUBLE_LENGTH);
+
+    status = G_read_compressed(fd, fileBytes, (unsigned char *)compressBuf,
+			 nofNum * nBytes + 1, compressor);
+
+    if (status < 0) {
+	Rast3d_error("Rast3d_fpcompress_read_xdr_nums: read error");
+	return 0;
+    }
+
+    if (!Rast3d__fpcompress_decode_xdr_nums(dst, nofNum, status, precision,
+					    compressBuf, isFloat))
+	Rast3d_fatal_error("Rast3d_fpcompress_read_xdr_nums: wrong code");
+
+    return 1;
+}
@@ -87,6 +87,9 @@ Rast3d_get_block_nocache(RASTER3D_Map * map, int x0, int y0, int z0, int nx, int
  * Copies the cells contained in the block (cube) with vertices 
  * <em>(x0, y0, z0)</em> and <em>(x0 + nx - 1, y0 + ny - 1, z0 + nz - 1)</em>
  * into <em>block</em>. The cell-values in <em>block</em> are of <em>type</em>.
+ * Cells outside of the region of the map are set to null.
+ * The block is copied tile by tile, every tile is fetched once and the
+ * rows of a tile inside the block are copied as a whole.
  * The source code can be found in <em>getblock.c</em>.
  *
  *  \param map
@@ -105,33 +108,62 @@ void
 Rast3d_get_block(RASTER3D_Map * map, int x0, int y0, int z0, int nx, int ny, int nz,
 	     void *block, int type)
 {
-    int x, y, z, nNull, x1, y1, z1, length;
+    int xa, ya, za, xb, yb, zb;
+    int tileX0, tileY0, tileZ0, tileX1, tileY1, tileZ1, dummy;
+    int tx, ty, tz, x, y, z, xs, xe, ys, ye, zs, ze;
+    int tileIndex;
+    void *tile;
 
-    if (!map->useCache) {
-	Rast3d_get_block_nocache(map, x0, y0, z0, nx, ny, nz, block, type);
+    if (nx <= 0 || ny <= 0 || nz <= 0)
+	return;
+
+    /* the part of the block inside the region */
+    xa = RASTER3D_MAX(x0, 0);
+    ya = RASTER3D_MAX(y0, 0);
+    za = RASTER3D_MAX(z0, 0);
+    xb = RASTER3D_MIN(x0 + nx, map->region.cols);
+    yb = RASTER3D_MIN(y0 + ny, map->region.rows);
+    zb = RASTER3D_MIN(z0 + nz, map->region.depths);
+
+    if (xa != x0 || ya != y0 || za != z0 ||
+	xb != x0 + nx || yb != y0 + ny || zb != z0 + nz)
+	Rast3d_set_null_value(block, nx * ny * nz, type);
+
+    if (xa >= xb || ya >= yb || za >= zb)
 	return;
-    }
 
-    x1 = RASTER3D_MIN(x0 + nx, map->region.cols);
-    y1 = RASTER3D_MIN(y0 + ny, map->region.rows);
-    z1 = RASTER3D_MIN(z0 + nz, map->region.depths);
+    Rast3d_coord2tile_coord(map, xa, ya, za, &tileX0, &tileY0, &tileZ0,
+			    &dummy, &dummy, &dummy);
+    Rast3d_coord2tile_coord(map, xb - 1, yb - 1, zb - 1,
+			    &tileX1, &tileY1, &tileZ1, &dummy, &dummy, &dummy);
 
-    length = Rast3d_length(type);
+    /* each tile is fetched once, its rows are copied as a whole */
+    for (tz = tileZ0; tz <= tileZ1; tz++) {
+	zs = RASTER3D_MAX(za, tz * map->tileZ);
+	ze = RASTER3D_MIN(zb, (tz + 1) * map->tileZ);
+	for (ty = tileY0; ty <= tileY1; ty++) {
+	    ys = RASTER3D_MAX(ya, ty * map->tileY);
+	    ye = RASTER3D_MIN(yb, (ty + 1) * map->tileY);
+	    for (tx = tileX0; tx <= tileX1; tx++) {
+		xs = RASTER3D_MAX(xa, tx * map->tileX);
+		xe = RASTER3D_MIN(xb, (tx + 1) * map->tileX);
 
-    for (z = z0; z < z1; z++) {
-	for (y = y0; y < y1; y++) {
-	    for (x = x0; x < x1; x++) {
-		Rast3d_get_value_region(map, x, y, z, block, type);
-		block = G_incr_void_ptr(block, length);
+		tileIndex = Rast3d_tile2tile_index(map, tx, ty, tz);
+		tile = Rast3d_get_tile_ptr(map, tileIndex);
+		if (tile == NULL)
+		    Rast3d_fatal_error
+			("Rast3d_get_block: error in Rast3d_get_tile_ptr");
+
+		x = xs - tx * map->tileX;
+		for (z = zs; z < ze; z++)
+		    for (y = ys; y < ye; y++)
+			Rast3d_copy_values(tile,
+					   (z - tz * map->tileZ) * map->tileXY +
+					   (y - ty * map->tileY) * map->tileX + x,
+					   map->typeIntern, block,
+					   (z - z0) * nx * ny + (y - y0) * nx +
+					   (xs - x0), type, xe - xs);
 	    }
-	    nNull = x0 + nx - x;
-	    Rast3d_set_null_value(block, nNull, type);
-	    block = G_incr_void_ptr(block, length * nNull);
 	}
-	nNull = (y0 + ny - y) * nx;
-	Rast3d_set_null_value(block, nNull, type);
-	block = G_incr_void_ptr(block, length * nNull);
     }
-    nNull = (z0 + nz - z) * ny * nx;
-    Rast3d_set_null_value(block, nNull, type);
 }
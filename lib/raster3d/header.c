@@ -29,6 +29,10 @@ int xdrLength;
 #define RASTER3D_HEADER_UNIT "Units"
 #define RASTER3D_HEADER_VERTICAL_UNIT "VerticalUnits"
 #define RASTER3D_HEADER_VERSION "Version"
+#define RASTER3D_HEADER_COMPRESSOR "Compressor"
+
+/* compressor of maps without RASTER3D_HEADER_COMPRESSOR */
+#define RASTER3D_LEGACY_COMPRESSOR 2	/* ZLIB */
 
 /*---------------------------------------------------------------------------*/
 
@@ -130,6 +134,7 @@ Rast3d_read_header(RASTER3D_Map * map, int *proj, int *zone, double *north,
 {
     struct Key_Value *headerKeys;
     char path[GPATH_MAX];
+    const char *compressor;
 
     Rast3d_filename(path, RASTER3D_HEADER_ELEMENT, map->fileName, map->mapset);
     if (access(path, R_OK) != 0) {
@@ -152,6 +157,18 @@ Rast3d_read_header(RASTER3D_Map * map, int *proj, int *zone, double *north,
 	return 0;
     }
 
+    map->compressor = RASTER3D_LEGACY_COMPRESSOR;
+    compressor = G_find_key_value(RASTER3D_HEADER_COMPRESSOR, headerKeys);
+    if (compressor) {
+	map->compressor = G_compressor_number((char *)compressor);
+	if (map->compressor < 1 || G_check_compressor(map->compressor) != 1) {
+	    Rast3d_error("Rast3d_read_header: compressor <%s> of file %s not available",
+		      compressor, path);
+	    G_free_key_value(headerKeys);
+	    return 0;
+	}
+    }
+
     G_free_key_value(headerKeys);
     return 1;
 }
@@ -186,6 +203,12 @@ Rast3d_write_header(RASTER3D_Map * map, int proj, int zone, double north, double
 	return 0;
     }
 
+    /* omitted for ZLIB so that older versions can read the map */
+    if (compression != RASTER3D_NO_COMPRESSION &&
+	map->compressor != RASTER3D_LEGACY_COMPRESSOR)
+	G_set_key_value(RASTER3D_HEADER_COMPRESSOR,
+			G_compressor_name(map->compressor), headerKeys);
+
     Rast3d_filename(path, RASTER3D_HEADER_ELEMENT, map->fileName, map->mapset);
     Rast3d_make_mapset_map_directory(map->fileName);
     G_write_key_value_file(path, headerKeys);
@@ -318,6 +341,7 @@ Rast3d_fill_header(RASTER3D_Map * map, int operation, int compression, int useRl
     map->version = version;
 
     map->operation = operation;
+    map->readahead = NULL;
 
     map->unit = G_store(unit);
     map->vertical_unit = vertical_unit;
@@ -177,6 +177,8 @@ void *Rast3d_open_cell_old(const char *name, const char *mapset,
     Rast3d_adjust_region(&(map->window));
     Rast3d_get_nearest_neighbor_fun_ptr(&(map->resampleFun));
 
+    Rast3d__init_read_ahead(map);
+
     return map;
 }
 
@@ -229,6 +231,8 @@ void *Rast3d_open_cell_new(const char *name, int typeIntern, int cache,
 	return (void *)NULL;
     }
 
+    map->compressor = g3d_compressor;
+
     if (G_unqualified_name(name, G_mapset(), xname, xmapset) < 0) {
 	G_warning(_("map <%s> is not in the current mapset"), name);
 	return (void *)NULL;
@@ -90,10 +90,21 @@ int Rast3d_get_standard3d_params(int *useTypeDefault, int *type,
 
 
 	if (strcmp(param->compression->answer, "default") != 0) {
- 		if (strcmp(param->compression->answer, "zip") == 0)
-			*doCompression = RASTER3D_COMPRESSION;
-		else
+		if (strcmp(param->compression->answer, "none") == 0)
 			*doCompression = RASTER3D_NO_COMPRESSION;
+		else {
+			int compressor = strcmp(param->compression->answer, "zip") == 0 ?
+			    G_compressor_number("ZLIB") :
+			    G_compressor_number(param->compression->answer);
+
+			if (compressor < 1 || G_check_compressor(compressor) != 1) {
+			    Rast3d_error(_("Rast3d_get_standard3d_params: compression method <%s> not available"),
+					 param->compression->answer);
+			    return 0;
+			}
+			*doCompression = RASTER3D_COMPRESSION;
+			Rast3d_set_compressor(compressor);
+		}
 	} else {
 		*useCompressionDefault = 1;
 	}
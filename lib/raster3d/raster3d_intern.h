@@ -46,6 +46,7 @@ extern int xdrLength;		/* in bytes */
 
 extern int g3d_version; /* RASTER3D_MAP_VERSION */
 extern int g3d_do_compression;	/* RASTER3D_NO_COMPRESSION or RASTER3D_COMPRESSION */
+extern int g3d_compressor;	/* compressor number, see G_compressor_name() */
 extern int g3d_precision;	/* RASTER3D_ALLOW_PRECISION or RASTER3D_NO_PRECISION */
 extern int g3d_cache_default;	/* in number of tiles; 0 ==> no cache */
 extern int g3d_cache_max;	/* in bytes */
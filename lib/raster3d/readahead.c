@@ -0,0 +1,404 @@
+/*!
+   \file lib/raster3d/readahead.c
+
+   \brief 3D Raster Library - Read-ahead of tiles
+
+   Tiles following the current traversal direction (along x, y or z, as
+   given by the index difference of the last two tiles read) are read
+   and decompressed by the libgis worker threads (see
+   G_begin_execute()) while the caller works on the current tile. The
+   cache itself and the mask stay on the calling thread, a tile read
+   ahead is copied into its cache element when it is requested.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <errno.h>
+
+#include <grass/raster3d.h>
+#include "raster3d_intern.h"
+
+#define MAX_READ_AHEAD 64
+
+#define COMPRESSED_NO (unsigned char)'0'	/* see G_read_compressed() */
+#define COMPRESSED_YES (unsigned char)'1'
+#define RLE_STATUS_BYTES 2
+#define XDR_MISUSE_BYTES 10
+
+struct ra_tile
+{
+    int tile;			/* tile index, -1 if slot is unused */
+    int status;			/* 1: ok, 0: read error, -1: decode error */
+    RASTER3D_Map *map;
+    off_t offset;		/* file offset of the tile */
+    size_t nbytes;		/* bytes of the tile in the file */
+    int nofNum, rows, cols, depths, xRedundant, yRedundant, zRedundant;
+    char *xdr;			/* file representation of the tile */
+    char *cmp;			/* expanded compressed tile */
+    void *data;			/* decoded tile of map->typeIntern */
+    void *worker;		/* G_begin_execute() reference */
+};
+
+struct R3_readahead
+{
+    int ntiles;
+    int last_tile;
+    int stride;
+    struct ra_tile *slots;
+};
+
+static int read_fully(int fd, void *buf, size_t size, off_t offset)
+{
+    unsigned char *p = buf;
+
+    /* pread() doesn't touch the file offset shared with the caller */
+    while (size > 0) {
+	ssize_t n = pread(fd, p, size, offset);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    return 0;
+	p += n;
+	size -= n;
+	offset += n;
+    }
+
+    return 1;
+}
+
+/* G_read_compressed() on a buffer, returns number of bytes or -1 */
+static int expand(unsigned char *b, int nread, unsigned char *dst,
+		  int nbytes, int compressor)
+{
+    int i;
+
+    if (b[0] == COMPRESSED_NO) {
+	for (i = 0; i < nread - 1 && i < nbytes; i++)
+	    dst[i] = b[i + 1];
+	return nread - 1;
+    }
+    if (b[0] != COMPRESSED_YES)
+	return -1;
+
+    return G_expand(b + 1, nread - 1, dst, nbytes, compressor);
+}
+
+/* runs on a worker thread: must not call Rast3d_error() or
+   G_fatal_error() nor touch the cache */
+static void decode_tile(void *closure)
+{
+    struct ra_tile *s = closure;
+    RASTER3D_Map *map = s->map;
+    int isFloat = (map->type == FCELL_TYPE);
+
+    s->status = 1;
+
+    if (map->compression == RASTER3D_NO_COMPRESSION) {
+	if (!read_fully(map->data_fd, s->xdr, s->nbytes, s->offset)) {
+	    s->status = 0;
+	    return;
+	}
+    }
+    else {
+	unsigned char *b = G_malloc(s->nbytes);
+	int n;
+
+	if (!read_fully(map->data_fd, b, s->nbytes, s->offset)) {
+	    G_free(b);
+	    s->status = 0;
+	    return;
+	}
+
+	n = expand(b, s->nbytes, (unsigned char *)s->cmp,
+		   s->nofNum * map->numLengthExtern + 1, map->compressor);
+	G_free(b);
+
+	if (n < 0 ||
+	    !Rast3d__fpcompress_decode_xdr_nums(s->xdr, s->nofNum, n,
+						map->precision, s->cmp,
+						isFloat)) {
+	    s->status = -1;
+	    return;
+	}
+    }
+
+    Rast3d__xdr_tile2tile(map, s->xdr, s->data, s->rows, s->cols, s->depths,
+			  s->xRedundant, s->yRedundant, s->zRedundant,
+			  s->nofNum, map->typeIntern);
+}
+
+static struct ra_tile *find_slot(struct R3_readahead *ra, int tile)
+{
+    int i;
+
+    for (i = 0; i < ra->ntiles; i++)
+	if (ra->slots[i].tile == tile)
+	    return &ra->slots[i];
+
+    return NULL;
+}
+
+/* is tile one of the tiles to be read ahead after cur */
+static int is_wanted(const struct R3_readahead *ra, int cur, int tile)
+{
+    int k;
+
+    if ((tile - cur) % ra->stride != 0)
+	return 0;
+
+    k = (tile - cur) / ra->stride;
+
+    return k >= 1 && k <= ra->ntiles;
+}
+
+static struct ra_tile *free_slot(struct R3_readahead *ra, int cur)
+{
+    int i;
+
+    for (i = 0; i < ra->ntiles; i++)
+	if (ra->slots[i].tile < 0)
+	    return &ra->slots[i];
+
+    /* recycle a slot holding a tile which is no longer ahead */
+    for (i = 0; i < ra->ntiles; i++) {
+	struct ra_tile *s = &ra->slots[i];
+
+	if (!is_wanted(ra, cur, s->tile)) {
+	    G_end_execute(&s->worker);
+	    s->tile = -1;
+	    return s;
+	}
+    }
+
+    return NULL;
+}
+
+/* is tile in the cache of map */
+static int is_cached(RASTER3D_Map * map, int tile)
+{
+    RASTER3D_cache *c = map->cache;
+
+    if (!map->useCache)
+	return tile == map->currentIndex;
+
+    return Rast3d_cache_hash_name2index(c->hash, tile) >= 0;
+}
+
+static void schedule(RASTER3D_Map * map, int cur)
+{
+    struct R3_readahead *ra = map->readahead;
+    int k;
+
+    for (k = 1; k <= ra->ntiles; k++) {
+	int tile = cur + k * ra->stride;
+	struct ra_tile *s;
+
+	if (tile < 0 || tile >= map->nTiles)
+	    break;
+
+	/* tiles which are not stored are null tiles, nothing to read */
+	if (map->index[tile] < 0 || find_slot(ra, tile) ||
+	    is_cached(map, tile))
+	    continue;
+
+	s = free_slot(ra, cur);
+	if (!s)
+	    break;
+
+	s->tile = tile;
+	s->status = 1;
+	s->offset = map->index[tile];
+	s->nofNum = Rast3d_compute_clipped_tile_dimensions(map, tile,
+							  &s->rows, &s->cols,
+							  &s->depths,
+							  &s->xRedundant,
+							  &s->yRedundant,
+							  &s->zRedundant);
+	if (map->compression == RASTER3D_NO_COMPRESSION)
+	    s->nbytes = RASTER3D_MIN((size_t) s->nofNum * map->numLengthExtern,
+				     (size_t) (map->fileEndPtr - s->offset));
+	else
+	    s->nbytes = map->tileLength[tile];
+
+	G_begin_execute(decode_tile, s, &s->worker, 0);
+    }
+}
+
+static void drain(struct R3_readahead *ra)
+{
+    int i;
+
+    for (i = 0; i < ra->ntiles; i++) {
+	G_end_execute(&ra->slots[i].worker);
+	ra->slots[i].tile = -1;
+    }
+}
+
+/*!
+   \brief Set read-ahead depth for a 3D raster map open for reading
+
+   The next <i>ntiles</i> tiles (following the direction of the
+   previous tile reads) are read and decompressed by worker threads
+   while the caller processes the current tile. For <i>ntiles</i> = 0
+   read-ahead is disabled. The tiles are processed on the libgis
+   workers (see G_init_workers()), the default can be set with the
+   environment variable GRASS_RASTER3D_READAHEAD.
+
+   \param map 3D raster map open for reading
+   \param ntiles number of tiles to read ahead
+ */
+void Rast3d_set_read_ahead(RASTER3D_Map * map, int ntiles)
+{
+    struct R3_readahead *ra;
+    size_t xdrsize, cmpsize, datasize;
+    int i;
+
+    if (map->operation != RASTER3D_READ_DATA)
+	Rast3d_fatal_error("Rast3d_set_read_ahead: map not open for reading");
+
+    Rast3d__close_read_ahead(map);
+
+    if (ntiles <= 0)
+	return;
+
+#ifdef __MINGW32__
+    G_debug(1, "3D raster read-ahead not supported on this platform");
+    return;
+#endif
+
+    if (ntiles > MAX_READ_AHEAD)
+	ntiles = MAX_READ_AHEAD;
+    if (ntiles > map->nTiles)
+	ntiles = map->nTiles;
+
+    G_init_workers();
+
+    /* same sizes as the global xdr and tmpCompress arrays */
+    datasize = (size_t) map->tileSize * map->numLengthIntern;
+    xdrsize = (size_t) map->tileSize *
+	RASTER3D_MAX(map->numLengthExtern, map->numLengthIntern) +
+	XDR_MISUSE_BYTES;
+    cmpsize = map->compression == RASTER3D_NO_COMPRESSION ? 0 :
+	(size_t) map->tileSize *
+	RASTER3D_MAX(map->numLengthIntern, map->numLengthExtern) +
+	RLE_STATUS_BYTES;
+
+    ra = G_malloc(sizeof(struct R3_readahead));
+    ra->ntiles = ntiles;
+    ra->last_tile = -1;
+    ra->stride = 1;
+    ra->slots = G_calloc(ntiles, sizeof(struct ra_tile));
+    for (i = 0; i < ntiles; i++) {
+	struct ra_tile *s = &ra->slots[i];
+
+	s->tile = -1;
+	s->map = map;
+	s->worker = NULL;
+	s->xdr = G_malloc(xdrsize);
+	s->cmp = cmpsize ? G_malloc(cmpsize) : NULL;
+	s->data = G_malloc(datasize);
+    }
+
+    map->readahead = ra;
+
+    G_debug(2, "Rast3d_set_read_ahead(): <%s> %d tiles", map->fileName,
+	    ntiles);
+}
+
+/*!
+   \brief Set read-ahead from the environment
+
+   Called by Rast3d_open_cell_old().
+
+   \param map 3D raster map open for reading
+ */
+void Rast3d__init_read_ahead(RASTER3D_Map * map)
+{
+    char *ahead = getenv("GRASS_RASTER3D_READAHEAD");
+
+    map->readahead = NULL;
+
+    if (ahead && *ahead)
+	Rast3d_set_read_ahead(map, atoi(ahead));
+}
+
+/*!
+   \brief Get a tile from the read-ahead pipeline
+
+   Called by Rast3d_read_tile(). Schedules the tiles following
+   <i>tileIndex</i> for decompression. The mask is not applied.
+
+   \param map 3D raster map
+   \param tileIndex tile index
+   \param tile buffer for the tile
+   \param type type of the values in <i>tile</i>
+
+   \return 1 if the tile was served from the pipeline
+   \return 0 if the tile must be read by the caller
+ */
+int Rast3d__read_ahead(RASTER3D_Map * map, int tileIndex, void *tile,
+		       int type)
+{
+    struct R3_readahead *ra = map->readahead;
+    struct ra_tile *s;
+    int ok = 0;
+
+    if (ra->last_tile >= 0 && tileIndex != ra->last_tile)
+	ra->stride = tileIndex - ra->last_tile;
+    ra->last_tile = tileIndex;
+
+    s = find_slot(ra, tileIndex);
+    if (s) {
+	G_end_execute(&s->worker);
+	s->tile = -1;
+
+	/* on errors the caller reads the tile again and reports them */
+	if (s->status == 1) {
+	    if (type == map->typeIntern)
+		memcpy(tile, s->data,
+		       (size_t) map->tileSize * map->numLengthIntern);
+	    else
+		Rast3d_copy_values(s->data, 0, map->typeIntern, tile, 0, type,
+				   map->tileSize);
+	    ok = 1;
+	}
+    }
+
+    schedule(map, tileIndex);
+
+    return ok;
+}
+
+/*!
+   \brief Stop read-ahead for a 3D raster map and free its buffers
+
+   \param map 3D raster map
+ */
+void Rast3d__close_read_ahead(RASTER3D_Map * map)
+{
+    struct R3_readahead *ra = map->readahead;
+    int i;
+
+    if (!ra)
+	return;
+
+    drain(ra);
+
+    for (i = 0; i < ra->ntiles; i++) {
+	G_free(ra->slots[i].xdr);
+	G_free(ra->slots[i].cmp);
+	G_free(ra->slots[i].data);
+    }
+    G_free(ra->slots);
+    G_free(ra);
+
+    map->readahead = NULL;
+}
@@ -2,6 +2,8 @@
 
 @author Soeren Gebbert
 """
+import os
+
 from grass.gunittest.case import TestCase
 
 class Raster3dLibraryTest(TestCase):
@@ -32,6 +34,26 @@ class Raster3dLibraryTest(TestCase):
         self.assertModule("test.raster3d.lib",  flags="l",  unit="large",  depths=91,  rows=89,  cols=87,  tile_size=512)
         self.assertModule("test.raster3d.lib",  flags="l",  unit="large",  depths=91,  rows=89,  cols=87,  tile_size=1024)
         self.assertModule("test.raster3d.lib",  flags="l",  unit="large",  depths=91,  rows=89,  cols=87,  tile_size=32768)
+    def test_large_compressor(self):
+        """Test tiles compressed with LZ4 (always available)"""
+        os.environ["RASTER3D_COMPRESSOR"] = "LZ4"
+        try:
+            self.assertModule("test.raster3d.lib",  flags="l",  unit="large",  depths=91,  rows=89,  cols=87,  tile_size=8)
+            self.assertModule("test.raster3d.lib",  flags="l",  unit="large",  depths=91,  rows=89,  cols=87,  tile_size=512)
+        finally:
+            del os.environ["RASTER3D_COMPRESSOR"]
+
+    def test_large_read_ahead(self):
+        """Test reading with tiles decompressed by worker threads"""
+        os.environ["GRASS_RASTER3D_READAHEAD"] = "8"
+        os.environ["WORKERS"] = "2"
+        try:
+            self.assertModule("test.raster3d.lib",  unit="large",  depths=91,  rows=89,  cols=87,  tile_size=8)
+            self.assertModule("test.raster3d.lib",  flags="l",  unit="large",  depths=91,  rows=89,  cols=87,  tile_size=8)
+            self.assertModule("test.raster3d.lib",  flags="l",  unit="large",  depths=91,  rows=89,  cols=87,  tile_size=512)
+        finally:
+            del os.environ["GRASS_RASTER3D_READAHEAD"]
+            del os.environ["WORKERS"]
 
 if __name__ == '__main__':
     from grass.gunittest.main import test
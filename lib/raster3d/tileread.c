@@ -6,24 +6,67 @@
 #include <grass/raster.h>
 #include "raster3d_intern.h"
 
-static int
-Rast3d_xdrTile2tile(RASTER3D_Map * map, void *tile, int rows, int cols, int depths,
-		 int xRedundant, int yRedundant, int zRedundant, int nofNum,
-		 int type)
+/* convert nofNum values at *src from the file format, advancing *src;
+   reentrant, used by the read-ahead workers */
+static void copy_from_xdr(const RASTER3D_Map * map, const void **src,
+			  int nofNum, void *dst, int dstType)
 {
-    int y, z, xLength, yLength, length;
+    int isFloat = (map->type == FCELL_TYPE);
+    int externLength = Rast3d_extern_length(map->type);
+    int eltLength = Rast3d_length(dstType);
+    const char *p = *src;
+    int i;
+
+    if (map->useXdr == RASTER3D_NO_XDR) {
+	Rast3d_copy_values(p, 0, map->type, dst, 0, dstType, nofNum);
+	*src = p + nofNum * externLength;
+	return;
+    }
 
-    if (!Rast3d_init_copy_from_xdr(map, type)) {
-	Rast3d_error("Rast3d_xdrTile2tile: error in Rast3d_init_copy_from_xdr");
-	return 0;
+    for (i = 0; i < nofNum; i++, dst = G_incr_void_ptr(dst, eltLength),
+	 p += externLength) {
+	if (Rast3d_is_xdr_null_num(p, isFloat)) {
+	    Rast3d_set_null_value(dst, 1, dstType);
+	    continue;
+	}
+
+	if (isFloat) {
+	    float f;
+
+	    G_xdr_get_float(&f, p);
+	    if (dstType == FCELL_TYPE)
+		*((float *)dst) = f;
+	    else
+		*((double *)dst) = (double)f;
+	}
+	else {
+	    double d;
+
+	    G_xdr_get_double(&d, p);
+	    if (dstType == DCELL_TYPE)
+		*((double *)dst) = d;
+	    else
+		*((float *)dst) = (float)d;
+	}
     }
 
+    *src = p;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/* convert the file representation of a tile at src into tile of type,
+   filling the redundant part with nulls */
+void
+Rast3d__xdr_tile2tile(const RASTER3D_Map * map, const void *src, void *tile,
+		      int rows, int cols, int depths, int xRedundant,
+		      int yRedundant, int zRedundant, int nofNum, int type)
+{
+    int y, z, xLength, yLength, length;
+
     if (nofNum == map->tileSize) {
-	if (!Rast3d_copy_from_xdr(map->tileSize, tile)) {
-	    Rast3d_error("Rast3d_xdrTile2tile: error in Rast3d_copy_from_xdr");
-	    return 0;
-	}
-	return 1;
+	copy_from_xdr(map, &src, map->tileSize, tile, type);
+	return;
     }
 
     length = Rast3d_length(type);
@@ -33,10 +76,7 @@ Rast3d_xdrTile2tile(RASTER3D_Map * map, void *tile, int rows, int cols, int dept
     if (xRedundant) {
 	for (z = 0; z < depths; z++) {
 	    for (y = 0; y < rows; y++) {
-		if (!Rast3d_copy_from_xdr(cols, tile)) {
-		    Rast3d_error("Rast3d_xdrTile2tile: error in Rast3d_copy_from_xdr");
-		    return 0;
-		}
+		copy_from_xdr(map, &src, cols, tile, type);
 		tile = G_incr_void_ptr(tile, cols * length);
 		Rast3d_set_null_value(tile, xRedundant, type);
 		tile = G_incr_void_ptr(tile, xLength);
@@ -47,41 +87,33 @@ Rast3d_xdrTile2tile(RASTER3D_Map * map, void *tile, int rows, int cols, int dept
 	    }
 	}
 	if (!zRedundant)
-	    return 1;
+	    return;
 
 	Rast3d_set_null_value(tile, map->tileXY * zRedundant, type);
-	return 1;
+	return;
     }
 
     if (yRedundant) {
 	for (z = 0; z < depths; z++) {
-	    if (!Rast3d_copy_from_xdr(map->tileX * rows, tile)) {
-		Rast3d_error("Rast3d_xdrTile2tile: error in Rast3d_copy_from_xdr");
-		return 0;
-	    }
+	    copy_from_xdr(map, &src, map->tileX * rows, tile, type);
 	    tile = G_incr_void_ptr(tile, map->tileX * rows * length);
 	    Rast3d_set_null_value(tile, map->tileX * yRedundant, type);
 	    tile = G_incr_void_ptr(tile, yLength);
 	}
 	if (!zRedundant)
-	    return 1;
+	    return;
 
 	Rast3d_set_null_value(tile, map->tileXY * zRedundant, type);
-	return 1;
+	return;
     }
 
-    if (!Rast3d_copy_from_xdr(map->tileXY * depths, tile)) {
-	Rast3d_error("Rast3d_xdrTile2tile: error in Rast3d_copy_from_xdr");
-	return 0;
-    }
+    copy_from_xdr(map, &src, map->tileXY * depths, tile, type);
 
     if (!zRedundant)
-	return 1;
+	return;
 
     tile = G_incr_void_ptr(tile, map->tileXY * depths * length);
     Rast3d_set_null_value(tile, map->tileXY * zRedundant, type);
-
-    return 1;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -108,7 +140,7 @@ static int Rast3d_readTileCompressed(RASTER3D_Map * map, int tileIndex, int nofN
     if (!Rast3d_fpcompress_read_xdr_nums(map->data_fd, xdr, nofNum,
 				  map->tileLength[tileIndex],
 				  map->precision, tmpCompress,
-				  map->type == FCELL_TYPE)) {
+				  map->type == FCELL_TYPE, map->compressor)) {
 	Rast3d_error
 	    ("Rast3d_readTileCompressed: error in Rast3d_fpcompress_read_xdr_nums");
 	return 0;
@@ -154,6 +186,10 @@ int Rast3d_read_tile(RASTER3D_Map * map, int tileIndex, void *tile, int type)
 	return 1;
     }
 
+    /* decoded ahead of time by a worker */
+    if (map->readahead && Rast3d__read_ahead(map, tileIndex, tile, type))
+	goto mask;
+
     nofNum = Rast3d_compute_clipped_tile_dimensions(map, tileIndex,
 					      &rows, &cols, &depths,
 					      &xRedundant, &yRedundant,
@@ -175,12 +211,10 @@ int Rast3d_read_tile(RASTER3D_Map * map, int tileIndex, void *tile, int type)
 	return 0;
     }
 
-    if (!Rast3d_xdrTile2tile(map, tile, rows, cols, depths,
-			  xRedundant, yRedundant, zRedundant, nofNum, type)) {
-	Rast3d_error("Rast3d_read_tile: error in Rast3d_xdrTile2tile");
-	return 0;
-    }
+    Rast3d__xdr_tile2tile(map, xdr, tile, rows, cols, depths,
+			  xRedundant, yRedundant, zRedundant, nofNum, type);
 
+  mask:
     if (Rast3d_mask_is_off(map))
 	return 1;
 
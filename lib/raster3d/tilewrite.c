@@ -84,7 +84,8 @@ static int Rast3d_writeTileUncompressed(RASTER3D_Map * map, int nofNum)
 static int Rast3d_writeTileCompressed(RASTER3D_Map * map, int nofNum)
 {
     if (!Rast3d_fpcompress_write_xdr_nums(map->data_fd, xdr, nofNum, map->precision,
-				   tmpCompress, map->type == FCELL_TYPE)) {
+				   tmpCompress, map->type == FCELL_TYPE,
+				   map->compressor)) {
 	Rast3d_error
 	    ("Rast3d_writeTileCompressed: error in Rast3d_fpcompress_write_xdr_nums");
 	return 0;
@@ -0,0 +1,179 @@
+/*!
+  \file rowio/window.c
+
+  \brief RowIO library - Sliding window of rows
+
+  A window holds the rows around a current row for moving window
+  (neighborhood) operations. When the current row advances by one,
+  the buffers of the window are rotated and only the new last row is
+  read, no row data are copied; advancing by several rows reads only
+  the rows which are new in the window. Each row buffer has padding before and
+  after the row data, and rows outside of the file are filled, so that
+  neighborhoods at the edges need no special cases.
+
+  (C) 2019 by the GRASS Development Team
+
+  This program is free software under the GNU General Public License
+  (>=v2).  Read the file COPYING that comes with GRASS for details.
+*/
+
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/glocale.h>
+#include <grass/rowio.h>
+
+static int read_row(ROWIO_WINDOW *, int, int);
+
+/*!
+  \brief Set up a sliding window of rows
+
+  The window holds <i>size</i> rows: the current row and
+  <i>size</i>/2 rows before it, the remaining rows after it (for an
+  odd <i>size</i>, the current row is in the middle). Each row buffer has
+  <i>pad</i> bytes before and after the <i>len</i> bytes of row data.
+  The padding and rows outside of 0 to <i>nrows</i>-1 are filled by
+  <i>fill</i> (e.g. with null values), or with zeros if <i>fill</i>
+  is NULL.
+
+  The function <i>getrow</i> is called as for Rowio_setup(), with a
+  pointer to the row data part of a buffer.
+
+  \param W pointer to ROWIO_WINDOW structure
+  \param fd file descriptor passed to getrow
+  \param nrows number of rows in the file
+  \param size number of rows in the window
+  \param len length of row data in bytes
+  \param pad padding before and after the row data in bytes
+  \param getrow routine to read a row
+  \param fill routine to fill a buffer (buffer, length in bytes) or NULL
+
+  \return 1 on success
+  \return -1 on error
+*/
+int Rowio_window_setup(ROWIO_WINDOW * W, int fd, int nrows, int size,
+		       int len, int pad,
+		       int (*getrow) (int, void *, int, int),
+		       void (*fill) (void *, int))
+{
+    int i;
+
+    if (size < 1 || len < 0 || pad < 0) {
+	G_warning(_("Invalid row window"));
+	return -1;
+    }
+
+    W->fd = fd;
+    W->nrows = nrows;
+    W->size = size;
+    W->len = len;
+    W->pad = pad;
+    W->row = -1;
+    W->getrow = getrow;
+    W->fill = fill;
+
+    W->rows = G_malloc(size * sizeof(void *));
+    for (i = 0; i < size; i++) {
+	char *buf = G_malloc(len + 2 * pad);
+
+	if (fill) {
+	    (*fill) (buf, pad);
+	    (*fill) (buf + pad + len, pad);
+	}
+	else
+	    memset(buf, 0, len + 2 * pad);
+	W->rows[i] = buf;
+    }
+
+    return 1;
+}
+
+/*!
+  \brief Move the window to a row
+
+  Returns the buffers of the rows <i>row</i> - <i>size</i>/2 to
+  <i>row</i> - <i>size</i>/2 + <i>size</i> - 1, the buffer of the current row is at
+  index <i>size</i>/2. The row data in each buffer start after the
+  <i>pad</i> bytes of padding. The buffers belong to the window and
+  are valid until the next call.
+
+  Stepping forward by less than <i>size</i> rows reads only the new
+  rows (one row when stepping to the next row); for any other row, all
+  rows of the window are read.
+
+  \param W pointer to ROWIO_WINDOW structure
+  \param row current row
+
+  \return array of <i>size</i> row buffers
+  \return NULL on error
+*/
+void **Rowio_window_get(ROWIO_WINDOW * W, int row)
+{
+    int half = W->size / 2;
+    int step = row - W->row;
+    int i;
+
+    if (row == W->row)
+	return W->rows;
+
+    if (W->row >= 0 && step > 0 && step < W->size) {
+	/* rotate: the buffers of the first rows get the new last rows */
+	int j;
+
+	for (j = 0; j < step; j++) {
+	    void *first = W->rows[0];
+
+	    for (i = 1; i < W->size; i++)
+		W->rows[i - 1] = W->rows[i];
+	    W->rows[W->size - 1] = first;
+	}
+
+	W->row = row;
+	for (i = W->size - step; i < W->size; i++)
+	    if (!read_row(W, i, row - half + i)) {
+		W->row = -1;
+		return NULL;
+	    }
+
+	return W->rows;
+    }
+
+    W->row = row;
+    for (i = 0; i < W->size; i++)
+	if (!read_row(W, i, row - half + i)) {
+	    W->row = -1;
+	    return NULL;
+	}
+
+    return W->rows;
+}
+
+/*!
+  \brief Release memory of a row window
+
+  \param W pointer to ROWIO_WINDOW structure
+*/
+void Rowio_window_release(ROWIO_WINDOW * W)
+{
+    int i;
+
+    for (i = 0; i < W->size; i++)
+	G_free(W->rows[i]);
+    G_free(W->rows);
+    W->rows = NULL;
+    W->row = -1;
+}
+
+static int read_row(ROWIO_WINDOW * W, int i, int row)
+{
+    char *data = (char *)W->rows[i] + W->pad;
+
+    if (row >= 0 && row < W->nrows)
+	return (*W->getrow) (W->fd, data, row, W->len) != 0;
+
+    if (W->fill)
+	(*W->fill) (data, W->len);
+    else
+	memset(data, 0, W->len);
+
+    return 1;
+}
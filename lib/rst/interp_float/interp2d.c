@@ -88,6 +88,10 @@ int IL_grid_calc_2d(struct interp_params *params,
     struct triple *points;
     static double *w2 = NULL;
     static double *w = NULL;
+#if defined(_OPENMP)
+    /* segments are computed by several threads */
+#pragma omp threadprivate(w2, w)
+#endif
     int cond1, cond2;
     double r;
     double stepix, stepiy, xx, xg, yg, xx2;
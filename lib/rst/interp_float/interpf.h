@@ -104,6 +104,15 @@ struct interp_params
     const char *wheresql;	/**< SQL statement to select input points */
 };
 
+/* output of segments computed by one thread */
+struct IL_thread_output
+{
+    struct interp_params params;	/**< copy with rows of the thread */
+    double zmin, zmax;		/**< min and max interp. z-values */
+    double gmin, gmax;		/**< min and max interp. slope values */
+    double c1min, c1max, c2min, c2max;	/**< min and max interp. curvatures */
+};
+
 /* distance.c */
 double IL_dist_square(double *, double *, int);
 
@@ -173,6 +182,14 @@ int IL_resample_interp_segments_2d(struct interp_params *, struct BM *,
 				   double *, double *, double *, off_t,
 				   double *, int, int, int, int, int, double,
 				   double, double, double, int);
+int IL_resample_interp_segments_2d_parallel(struct interp_params *,
+					    struct BM *, double, double,
+					    double *, double *, double *,
+					    double *, double *, double *,
+					    double *, double *, double *,
+					    off_t, double *, int, int, int,
+					    int, int, double, double, double,
+					    double, int, int);
 /* secpar2d.c */
 int IL_secpar_loop_2d(struct interp_params *, int, int, int, struct BM *,
 		      double *, double *, double *, double *, double *,
@@ -190,6 +207,10 @@ int IL_interp_segments_2d_parallel(struct interp_params *, struct tree_info *,
 				   double *, double *, double *, double *, double *,
 				   double *, double *, double *, double *, int, off_t,
 				   double, int);
+struct IL_thread_output *IL_thread_outputs_new(struct interp_params *, int);
+void IL_thread_outputs_merge(struct IL_thread_output *, int, double *,
+			     double *, double *, double *, double *,
+			     double *, double *, double *);
 /* vinput2d.c */
 int IL_vector_input_data_2d(struct interp_params *, struct Map_info *, int,
 			    char *, char *, struct tree_info *, double *,
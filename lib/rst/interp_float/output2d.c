@@ -29,6 +29,18 @@
 
 #define MULT 100000
 
+/* the rows are compressed by the workers while the next rows are
+ * read from the temporary files */
+static int open_output(const char *name, int nprocs)
+{
+    int fd = Rast_open_new(name, FCELL_TYPE);
+
+    if (nprocs > 1)
+	Rast_set_write_behind(fd, nprocs);
+
+    return fd;
+}
+
 static void do_history(const char *name, int vect, const char *input,
 		       const struct interp_params *params)
 {
@@ -82,6 +94,7 @@ int IL_output_2d(struct interp_params *params,
     int cond1, cond2;
     FCELL dat1, dat2;
     CELL val1, val2;
+    int nprocs = G_num_workers() + 1;	/* threads set by the module */
     
     cond2 = ((params->pcurv != NULL) || (params->tcurv != NULL)
 	     || (params->mcurv != NULL));
@@ -95,22 +108,22 @@ int IL_output_2d(struct interp_params *params,
      * G_set_embedded_null_value_mode(1);
      */
     if (params->elev)
-	cf1 = Rast_open_new(params->elev, FCELL_TYPE);
+	cf1 = open_output(params->elev, nprocs);
 
     if (params->slope)
-	cf2 = Rast_open_new(params->slope, FCELL_TYPE);
+	cf2 = open_output(params->slope, nprocs);
 
     if (params->aspect)
-	cf3 = Rast_open_new(params->aspect, FCELL_TYPE);
+	cf3 = open_output(params->aspect, nprocs);
 
     if (params->pcurv)
-	cf4 = Rast_open_new(params->pcurv, FCELL_TYPE);
+	cf4 = open_output(params->pcurv, nprocs);
 
     if (params->tcurv)
-	cf5 = Rast_open_new(params->tcurv, FCELL_TYPE);
+	cf5 = open_output(params->tcurv, nprocs);
 
     if (params->mcurv)
-	cf6 = Rast_open_new(params->mcurv, FCELL_TYPE);
+	cf6 = open_output(params->mcurv, nprocs);
 
     nrows = cellhd->rows;
     if (nrows != params->nsizr) {
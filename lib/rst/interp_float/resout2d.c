@@ -25,6 +25,18 @@
 
 /* output cell maps for elevation, aspect, slope and curvatures */
 
+/* the rows are compressed by the workers while the next rows are
+ * read from the temporary files */
+static int open_output(const char *name, int nprocs)
+{
+    int fd = Rast_open_fp_new(name);
+
+    if (nprocs > 1)
+	Rast_set_write_behind(fd, nprocs);
+
+    return fd;
+}
+
 static void do_history(const char *name, const char *input,
 		       const struct interp_params *params)
 {
@@ -68,6 +80,7 @@ int IL_resample_output_2d(struct interp_params *params, double zmin, double zmax
     const char *maps;
     int cond1, cond2;
     CELL val1, val2;
+    int nprocs = G_num_workers() + 1;	/* threads set by the module */
     
     cond2 = ((params->pcurv != NULL) ||
 	     (params->tcurv != NULL) || (params->mcurv != NULL));
@@ -81,22 +94,22 @@ int IL_resample_output_2d(struct interp_params *params, double zmin, double zmax
     cell1 = Rast_allocate_f_output_buf();
 
     if (params->elev)
-	cf1 = Rast_open_fp_new(params->elev);
+	cf1 = open_output(params->elev, nprocs);
 
     if (params->slope)
-	cf2 = Rast_open_fp_new(params->slope);
+	cf2 = open_output(params->slope, nprocs);
 
     if (params->aspect)
-	cf3 = Rast_open_fp_new(params->aspect);
+	cf3 = open_output(params->aspect, nprocs);
 
     if (params->pcurv)
-	cf4 = Rast_open_fp_new(params->pcurv);
+	cf4 = open_output(params->pcurv, nprocs);
 
     if (params->tcurv)
-	cf5 = Rast_open_fp_new(params->tcurv);
+	cf5 = open_output(params->tcurv, nprocs);
 
     if (params->mcurv)
-	cf6 = Rast_open_fp_new(params->mcurv);
+	cf6 = open_output(params->mcurv, nprocs);
 
     nrows = outhd->rows;
     if (nrows != params->nsizr) {
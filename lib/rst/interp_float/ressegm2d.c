@@ -21,6 +21,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -32,6 +35,19 @@ static int input_data(struct interp_params *,
 		      double, double, double);
 static int write_zeros(struct interp_params *, struct quaddata *, off_t);
 
+/* output columns of a segment and input columns used for it */
+struct segment_cols
+{
+    int ngstc, nszc;		/* first and last output col */
+    int first_col, last_col;	/* first and last input col */
+};
+
+static int interp_segment(struct IL_thread_output *, struct BM *, double,
+			  double, double *, off_t, double,
+			  const struct fcell_triple *, int, int, int, int, int,
+			  const struct segment_cols *, double, double,
+			  double **, int *, double *, int *);
+
 int IL_resample_interp_segments_2d(struct interp_params *params, struct BM *bitmask,	/* bitmask */
 				   double zmin, double zmax,	/* min and max input z-values */
 				   double *zminac, double *zmaxac,	/* min and max interp. z-values */
@@ -50,30 +66,57 @@ int IL_resample_interp_segments_2d(struct interp_params *params, struct BM *bitm
 				   double inp_ns_res,
 				   double inp_ew_res, int dtens)
 {
+    return IL_resample_interp_segments_2d_parallel(params, bitmask, zmin, zmax,
+						   zminac, zmaxac, gmin, gmax,
+						   c1min, c1max, c2min, c2max,
+						   ertot, offset1, dnorm,
+						   overlap, inp_rows, inp_cols,
+						   fdsmooth, fdinp, ns_res,
+						   ew_res, inp_ns_res,
+						   inp_ew_res, dtens, 1);
+}
+
+/*
+ * Same as IL_resample_interp_segments_2d(). The segments of one row of
+ * segments are computed by threads, the input rows of the segment row
+ * are read before.
+ */
+int IL_resample_interp_segments_2d_parallel(struct interp_params *params, struct BM *bitmask,	/* bitmask */
+				   double zmin, double zmax,	/* min and max input z-values */
+				   double *zminac, double *zmaxac,	/* min and max interp. z-values */
+				   double *gmin, double *gmax,	/* min and max inperp. slope val. */
+				   double *c1min, double *c1max, double *c2min, double *c2max,	/* min and max interp. curv. val. */
+				   double *ertot,	/* total interplating func. error */
+				   off_t offset1,	/* offset for temp file writing */
+				   double *dnorm,
+				   int overlap,
+				   int inp_rows,
+				   int inp_cols,
+				   int fdsmooth,
+				   int fdinp,
+				   double ns_res,
+				   double ew_res,
+				   double inp_ns_res,
+				   double inp_ew_res, int dtens, int threads)
+{
 
-    int i, j, k, l, m, m1, i1;	/* loop coounters */
+    int i, j, k, m1;	/* loop coounters */
     int cursegm = 0;
-    int new_comp = 0;
-    int n_rows, n_cols, inp_r, inp_c;
+    int n_rows, n_cols, inp_r;
     double x_or, y_or, xm, ym;
-    static int first = 1, new_first = 1;
-    double **matrix = NULL, **new_matrix = NULL, *b = NULL;
-    int *indx = NULL, *new_indx = NULL;
+    double **matrix = NULL, *b = NULL;
+    int *indx = NULL;
     static struct fcell_triple *in_points = NULL;	/* input points */
     int inp_check_rows, inp_check_cols,	/* total input rows/cols */
       out_check_rows, out_check_cols;	/* total output rows/cols */
     int first_row, last_row;	/* first and last input row of segment */
-    int first_col, last_col;	/* first and last input col of segment */
     int num, prev;
     int div;			/* number of divides */
     int rem_out_row, rem_out_col;	/* output rows/cols remainders */
     int inp_seg_r, inp_seg_c,	/* # of input rows/cols in segment */
       out_seg_r, out_seg_c;	/* # of output rows/cols in segment */
-    int ngstc, nszc		/* first and last output col of the
+    int ngstr, nszr;		/* first and last output row of the
 				 * segment */
-     , ngstr, nszr;		/* first and last output row of the
-				 * segment */
-    int index;			/* index for input data */
     int c, r;
     int overlap1;
     int p_size;
@@ -81,6 +124,11 @@ int IL_resample_interp_segments_2d(struct interp_params *params, struct BM *bitm
     double xmax, xmin, ymax, ymin;
     int totsegm;		/* total number of segments */
     int total_points = 0;
+    struct segment_cols *seg_cols;	/* columns of the segments */
+    struct IL_thread_output *out;	/* output of the threads */
+    double ***t_matrix, **t_b;	/* system of each thread */
+    int **t_indx;
+    int failed;
     struct triple triple;	/* contains garbage */
 
 
@@ -241,15 +289,71 @@ int IL_resample_interp_segments_2d(struct interp_params *params, struct BM *bitm
 
     totsegm = div * div;
 
-    /* set up a segment */
-    for (i = 1; i <= div; i++) {	/* input and output rows */
+    /* the columns are the same in each row of segments */
+    seg_cols = (struct segment_cols *)G_malloc(sizeof(struct segment_cols) *
+					       div);
+    for (j = 1; j <= div; j++) {	/* input and output cols */
+	struct segment_cols *sc = &seg_cols[j - 1];
+
+	if (j <= div - rem_out_col)
+	    n_cols = out_seg_c;
+	else
+	    n_cols = out_seg_c + 1;
+
+	sc->ngstc = out_check_cols + 1;	/* first output col of the segment */
+	sc->nszc = sc->ngstc + n_cols - 1;	/* last output col of the segment */
+	x_or = (sc->ngstc - 1) * ew_res;	/* x origin of the segment */
+
+	sc->first_col = (int)(x_or / inp_ew_res) + 1;
+	if (sc->first_col > overlap1) {
+	    sc->first_col -= overlap1;	/* middle */
+	    sc->last_col = sc->first_col + inp_seg_c + overlap1 * 2 - 1;
+	    if (sc->last_col > inp_cols) {
+		sc->first_col -= (sc->last_col - inp_cols);	/* right */
+		sc->last_col = inp_cols;
+	    }
+	}
+	else {
+	    sc->first_col = 1;	/* left */
+	    sc->last_col = sc->first_col + inp_seg_c + overlap1 * 2 - 1;
+	}
+	if ((sc->last_col > inp_cols) || (sc->first_col < 1)) {
+	    fprintf(stderr, "Column overlap too large!\n");
+	    G_free(seg_cols);
+	    return -1;
+	}
+	out_check_cols += n_cols;
+	inp_check_cols += inp_seg_c;
+    }
+
+    if (threads < 1)
+	threads = 1;
+    if (threads > div)
+	threads = div;
+    t_matrix = (double ***)G_malloc(sizeof(double **) * threads);
+    t_indx = (int **)G_malloc(sizeof(int *) * threads);
+    t_b = (double **)G_malloc(sizeof(double *) * threads);
+    for (k = 0; k < threads; k++) {
+	if (!(t_matrix[k] = G_alloc_matrix(params->KMAX2 + 1,
+					   params->KMAX2 + 1)) ||
+	    !(t_indx[k] = G_alloc_ivector(params->KMAX2 + 1)) ||
+	    !(t_b[k] = G_alloc_vector(params->KMAX2 + 2))) {
+	    fprintf(stderr, "Cannot allocate memory for matrix\n");
+	    return -1;
+	}
+    }
+
+    /* the segments of a row of segments are computed by the threads into
+     * their own rows, writing of the rows is serialized */
+    out = IL_thread_outputs_new(params, threads);
+    failed = 0;
+
+    for (i = 1; i <= div && !failed; i++) {	/* input and output rows */
 	if (i <= div - rem_out_row)
 	    n_rows = out_seg_r;
 	else
 	    n_rows = out_seg_r + 1;
 	inp_r = inp_seg_r;
-	out_check_cols = 0;
-	inp_check_cols = 0;
 	ngstr = out_check_rows + 1;	/* first output row of the segment */
 	nszr = ngstr + n_rows - 1;	/* last output row of the segment */
 	y_or = (ngstr - 1) * ns_res;	/* y origin of the segment */
@@ -272,217 +376,155 @@ int IL_resample_interp_segments_2d(struct interp_params *params, struct BM *bitm
 	}
 	if ((last_row > inp_rows) || (first_row < 1)) {
 	    fprintf(stderr, "Row overlap too large!\n");
-	    return -1;
+	    failed = 1;
+	    break;
 	}
 	input_data(params, first_row, last_row, in_points, fdsmooth, fdinp,
 		   inp_rows, inp_cols, zmin, inp_ns_res, inp_ew_res);
 
-	for (j = 1; j <= div; j++) {	/* input and output cols */
-	    if (j <= div - rem_out_col)
-		n_cols = out_seg_c;
-	    else
-		n_cols = out_seg_c + 1;
-	    inp_c = inp_seg_c;
-
-	    ngstc = out_check_cols + 1;	/* first output col of the segment */
-	    nszc = ngstc + n_cols - 1;	/* last output col of the segment */
-	    x_or = (ngstc - 1) * ew_res;	/* x origin of the segment */
-
-	    first_col = (int)(x_or / inp_ew_res) + 1;
-	    if (first_col > overlap1) {
-		first_col -= overlap1;	/* middle */
-		last_col = first_col + inp_seg_c + overlap1 * 2 - 1;
-		if (last_col > inp_cols) {
-		    first_col -= (last_col - inp_cols);	/* right */
-		    last_col = inp_cols;
-		}
+#pragma omp parallel for schedule(dynamic) num_threads(threads) reduction(+:total_points)
+	for (j = 0; j < div; j++) {
+	    int tid = 0;
+	    int points, stop;
+
+#if defined(_OPENMP)
+	    tid = omp_get_thread_num();
+#endif
+#pragma omp atomic read
+	    stop = failed;
+	    if (stop)
+		continue;
+
+	    if (interp_segment(&out[tid], bitmask, zmin,
+			       zmax, ertot, offset1, *dnorm, in_points,
+			       inp_cols, first_row, last_row, ngstr, nszr,
+			       &seg_cols[j], ns_res, ew_res, t_matrix[tid],
+			       t_indx[tid], t_b[tid], &points) < 0) {
+#pragma omp atomic write
+		failed = 1;
 	    }
-	    else {
-		first_col = 1;	/* left */
-		last_col = first_col + inp_seg_c + overlap1 * 2 - 1;
-	    }
-	    if ((last_col > inp_cols) || (first_col < 1)) {
-		fprintf(stderr, "Column overlap too large!\n");
-		return -1;
-	    }
-	    m = 0;
-	    /* Getting points for interpolation (translated) */
-
-	    xm = nszc * ew_res;
-	    ym = nszr * ns_res;
-	    data = (struct quaddata *)quad_data_new(x_or, y_or, xm, ym,
-						    nszr - ngstr + 1,
-						    nszc - ngstc + 1, 0,
-						    params->KMAX2);
-	    new_comp = 0;
-
-	    for (k = 0; k <= last_row - first_row; k++) {
-		for (l = first_col - 1; l < last_col; l++) {
-		    index = k * inp_cols + l;
-		    if (!Rast_is_f_null_value(&(in_points[index].z))) {
-			/* if the point is inside the segment (not overlapping) */
-			if ((in_points[index].x - x_or >= 0) &&
-			    (in_points[index].y - y_or >= 0) &&
-			    ((nszc - 1) * ew_res - in_points[index].x >= 0) &&
-			    ((nszr - 1) * ns_res - in_points[index].y >= 0))
-			    total_points += 1;
-			data->points[m].x =
-			    (in_points[index].x - x_or) / (*dnorm);
-			data->points[m].y =
-			    (in_points[index].y - y_or) / (*dnorm);
-			/*            data->points[m].z = (double) (in_points[index].z) / (*dnorm); */
-			data->points[m].z = (double)(in_points[index].z);
-			data->points[m].sm = in_points[index].smooth;
-			m++;
-		    }
-		    else
-			new_comp = 1;
-
-		    /*          fprintf(stderr,"%f,%f,%f
-		       zmin=%f\n",in_points[index].x,in_points[index].y,in_points[index].z,zmin);
-		     */
-		}
-	    }
-	    /*      fprintf (stdout,"m,index:%di,%d\n",m,index); */
-	    if (m <= params->KMAX2)
-		data->n_points = m;
-	    else
-		data->n_points = params->KMAX2;
-	    out_check_cols += n_cols;
-	    inp_check_cols += inp_c;
-	    cursegm = (i - 1) * div + j - 1;
+	    total_points += points;
 
+#pragma omp atomic
+	    cursegm++;
 	    /* show before to catch 0% */
-	    if (totsegm != 0) {
+	    if (totsegm != 0 && tid == 0)
 		G_percent(cursegm, totsegm, 1);
-	    }
-	    if (m == 0) {
-		/*
-		 * fprintf(stderr,"Warning: segment with zero points encountered,
-		 * insrease overlap\n");
-		 */
-		write_zeros(params, data, offset1);
-	    }
-	    else {
-		if (new_comp) {
-		    if (new_first) {
-			new_first = 0;
-			if (!b) {
-			    if (!(b = G_alloc_vector(params->KMAX2 + 2))) {
-				fprintf(stderr,
-					"Cannot allocate memory for b\n");
-				return -1;
-			    }
-			}
-			if (!(new_indx = G_alloc_ivector(params->KMAX2 + 1))) {
-			    fprintf(stderr,
-				    "Cannot allocate memory for new_indx\n");
-			    return -1;
-			}
-			if (!
-			    (new_matrix =
-			     G_alloc_matrix(params->KMAX2 + 1,
-					    params->KMAX2 + 1))) {
-			    fprintf(stderr,
-				    "Cannot allocate memory for new_matrix\n");
-			    return -1;
-			}
-		    }		/*new_first */
-		    if (params->
-			matrix_create(params, data->points, data->n_points,
-				      new_matrix, new_indx) < 0)
-			return -1;
-
-		    for (i1 = 0; i1 < m; i1++) {
-			b[i1 + 1] = data->points[i1].z;
-		    }
-		    b[0] = 0.;
-		    G_lubksb(new_matrix, data->n_points + 1, new_indx, b);
-
-		    params->check_points(params, data, b, ertot, zmin,
-					 *dnorm, triple);
-
-		    if (params->grid_calc(params, data, bitmask,
-					  zmin, zmax, zminac, zmaxac, gmin,
-					  gmax, c1min, c1max, c2min, c2max,
-					  ertot, b, offset1, *dnorm) < 0) {
-
-			fprintf(stderr, "interpolate() failed\n");
-			return -1;
-		    }
-		}		/*new_comp */
-		else {
-		    if (first) {
-			first = 0;
-			if (!b) {
-			    if (!(b = G_alloc_vector(params->KMAX2 + 2))) {
-				fprintf(stderr,
-					"Cannot allocate memory for b\n");
-				return -1;
-			    }
-			}
-			if (!(indx = G_alloc_ivector(params->KMAX2 + 1))) {
-			    fprintf(stderr,
-				    "Cannot allocate memory for indx\n");
-			    return -1;
-			}
-			if (!
-			    (matrix =
-			     G_alloc_matrix(params->KMAX2 + 1,
-					    params->KMAX2 + 1))) {
-			    fprintf(stderr,
-				    "Cannot allocate memory for matrix\n");
-			    return -1;
-			}
-		    }		/* first */
-		    if (params->
-			matrix_create(params, data->points, data->n_points,
-				      matrix, indx) < 0)
-			return -1;
-		    /*        } here it was bug */
-		    for (i1 = 0; i1 < m; i1++)
-			b[i1 + 1] = data->points[i1].z;
-		    b[0] = 0.;
-		    G_lubksb(matrix, data->n_points + 1, indx, b);
-
-		    params->check_points(params, data, b, ertot, zmin,
-					 *dnorm, triple);
-
-		    if (params->grid_calc(params, data, bitmask,
-					  zmin, zmax, zminac, zmaxac, gmin,
-					  gmax, c1min, c1max, c2min, c2max,
-					  ertot, b, offset1, *dnorm) < 0) {
-
-			fprintf(stderr, "interpolate() failed\n");
-			return -1;
-		    }
-		}
-	    }
-	    if (data) {
-		G_free(data->points);
-		G_free(data);
-	    }
-	    /*
-	     * cursegm++;
-	     */
 	}
 
 	inp_check_rows += inp_r;
 	out_check_rows += n_rows;
     }
 
+    IL_thread_outputs_merge(out, threads, zminac, zmaxac, gmin, gmax,
+			    c1min, c1max, c2min, c2max);
+    for (k = 0; k < threads; k++) {
+	G_free_matrix(t_matrix[k]);
+	G_free_ivector(t_indx[k]);
+	G_free_vector(t_b[k]);
+    }
+    G_free(t_matrix);
+    G_free(t_indx);
+    G_free(t_b);
+    G_free(seg_cols);
+
+    if (failed)
+	return -1;
+
     /* run one last time after the loop is done to catch 100% */
     if (totsegm != 0)
 	G_percent(1, 1, 1);	/* cursegm doesn't get to totsegm so we force 100% */
 
-    /*
-     * if (b) G_free_vector(b); if (indx) G_free_ivector(indx); if (matrix)
-     * G_free_matrix(matrix);
-     */
     fprintf(stderr, "dnorm in ressegm after grid before out2= %f \n", *dnorm);
     return total_points;
 }
 
+/* interpolation of one segment from the input rows of its row of segments */
+
+static int interp_segment(struct IL_thread_output *mm,
+			  struct BM *bitmask,
+			  double zmin, double zmax,
+			  double *ertot, off_t offset1, double dnorm,
+			  const struct fcell_triple *in_points,
+			  int inp_cols, int first_row, int last_row,
+			  int ngstr, int nszr,
+			  const struct segment_cols *sc,
+			  double ns_res, double ew_res,
+			  double **matrix, int *indx, double *b,
+			  int *points)
+{
+    struct interp_params *params = &mm->params;
+    int k, l, m, i1, index;
+    double x_or, y_or, xm, ym;
+    struct quaddata *data;
+    struct triple triple;	/* contains garbage */
+    int ret = 1;
+
+    x_or = (sc->ngstc - 1) * ew_res;	/* x origin of the segment */
+    y_or = (ngstr - 1) * ns_res;	/* y origin of the segment */
+    xm = sc->nszc * ew_res;
+    ym = nszr * ns_res;
+    data = (struct quaddata *)quad_data_new(x_or, y_or, xm, ym,
+					    nszr - ngstr + 1,
+					    sc->nszc - sc->ngstc + 1, 0,
+					    params->KMAX2);
+
+    /* Getting points for interpolation (translated) */
+    m = 0;
+    *points = 0;
+    for (k = 0; k <= last_row - first_row; k++) {
+	for (l = sc->first_col - 1; l < sc->last_col; l++) {
+	    index = k * inp_cols + l;
+	    if (!Rast_is_f_null_value(&(in_points[index].z))) {
+		/* if the point is inside the segment (not overlapping) */
+		if ((in_points[index].x - x_or >= 0) &&
+		    (in_points[index].y - y_or >= 0) &&
+		    ((sc->nszc - 1) * ew_res - in_points[index].x >= 0) &&
+		    ((nszr - 1) * ns_res - in_points[index].y >= 0))
+		    *points += 1;
+		data->points[m].x = (in_points[index].x - x_or) / dnorm;
+		data->points[m].y = (in_points[index].y - y_or) / dnorm;
+		data->points[m].z = (double)(in_points[index].z);
+		data->points[m].sm = in_points[index].smooth;
+		m++;
+	    }
+	}
+    }
+    if (m <= params->KMAX2)
+	data->n_points = m;
+    else
+	data->n_points = params->KMAX2;
+
+    if (m == 0) {
+	if (write_zeros(params, data, offset1) < 0)
+	    ret = -1;
+    }
+    else if (params->matrix_create(params, data->points, data->n_points,
+				   matrix, indx) < 0)
+	ret = -1;
+    else {
+	for (i1 = 0; i1 < data->n_points; i1++)
+	    b[i1 + 1] = data->points[i1].z;
+	b[0] = 0.;
+	G_lubksb(matrix, data->n_points + 1, indx, b);
+
+	params->check_points(params, data, b, ertot, zmin, dnorm, triple);
+
+	if (params->grid_calc(params, data, bitmask,
+			      zmin, zmax, &mm->zmin, &mm->zmax, &mm->gmin,
+			      &mm->gmax, &mm->c1min, &mm->c1max, &mm->c2min,
+			      &mm->c2max, ertot, b, offset1, dnorm) < 0) {
+	    fprintf(stderr, "interpolate() failed\n");
+	    ret = -1;
+	}
+    }
+
+    G_free(data->points);
+    G_free(data);
+
+    return ret;
+}
+
 /* input of data for interpolation and smoothing parameters */
 
 static int input_data(struct interp_params *params,
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
 #if defined(_OPENMP)
 #include <omp.h>
 #endif
@@ -30,6 +31,146 @@
 
 static int cut_tree(struct multtree *, struct multtree **, int *);
 
+/* output functions of the caller, called by one thread at a time */
+static wr_temp_fn *caller_wr_temp;
+static check_points_fn *caller_check_points;
+
+static int wr_temp_locked(struct interp_params *params, int ngstc, int nszc,
+                          off_t offset2)
+{
+    int ret;
+
+#pragma omp critical (rst_output)
+    ret = caller_wr_temp(params, ngstc, nszc, offset2);
+
+    return ret;
+}
+
+static int check_points_locked(struct interp_params *params,
+                               struct quaddata *data, double *b,
+                               double *ertot, double zmin, double dnorm,
+                               struct triple skip_point)
+{
+    int ret;
+
+#pragma omp critical (rst_output)
+    ret = caller_check_points(params, data, b, ertot, zmin, dnorm,
+                              skip_point);
+
+    return ret;
+}
+
+static DCELL *alloc_row(const DCELL *row, int cols)
+{
+    return row ? G_alloc_vector(cols + 1) : NULL;
+}
+
+/*!
+ * \brief Create the output state of segments computed by threads
+ *
+ * Each thread gets a copy of the parameters with its own output rows,
+ * writing of the rows and of the values at points is serialized. The
+ * minima and maxima of each thread are merged by
+ * IL_thread_outputs_merge().
+ *
+ * \param params interpolation parameters
+ * \param threads number of threads
+ *
+ * \return array of states for the threads
+ */
+struct IL_thread_output *IL_thread_outputs_new(struct interp_params *params,
+                                               int threads)
+{
+    struct IL_thread_output *out;
+    int i;
+
+    caller_wr_temp = params->wr_temp;
+    caller_check_points = params->check_points;
+    out = G_malloc(sizeof(struct IL_thread_output) * threads);
+    for (i = 0; i < threads; i++) {
+        struct interp_params *p = &out[i].params;
+
+        *p = *params;
+        p->az = alloc_row(params->az, params->nsizc);
+        p->adx = alloc_row(params->adx, params->nsizc);
+        p->ady = alloc_row(params->ady, params->nsizc);
+        p->adxx = alloc_row(params->adxx, params->nsizc);
+        p->adyy = alloc_row(params->adyy, params->nsizc);
+        p->adxy = alloc_row(params->adxy, params->nsizc);
+        p->wr_temp = wr_temp_locked;
+        p->check_points = check_points_locked;
+
+        out[i].zmin = out[i].gmin = out[i].c1min = out[i].c2min = DBL_MAX;
+        out[i].zmax = out[i].gmax = out[i].c1max = out[i].c2max = -DBL_MAX;
+    }
+
+    return out;
+}
+
+/*!
+ * \brief Merge minima and maxima of threads and free their state
+ *
+ * \param out states created by IL_thread_outputs_new()
+ * \param threads number of threads
+ * \param[out] zminac,zmaxac min and max interp. z-values
+ * \param[out] gmin,gmax min and max interp. slope values
+ * \param[out] c1min,c1max,c2min,c2max min and max interp. curvatures
+ */
+void IL_thread_outputs_merge(struct IL_thread_output *out, int threads,
+                             double *zminac, double *zmaxac,
+                             double *gmin, double *gmax,
+                             double *c1min, double *c1max,
+                             double *c2min, double *c2max)
+{
+    int i, first_z, first_g;
+
+    first_z = first_g = 1;
+    for (i = 0; i < threads; i++) {
+        struct interp_params *p = &out[i].params;
+        struct IL_thread_output *m = &out[i];
+
+        if (m->zmin <= m->zmax) {
+            if (first_z) {
+                first_z = 0;
+                *zminac = m->zmin;
+                *zmaxac = m->zmax;
+            }
+            *zminac = amin1(*zminac, m->zmin);
+            *zmaxac = amax1(*zmaxac, m->zmax);
+        }
+        if (m->gmin <= m->gmax) {
+            if (first_g) {
+                first_g = 0;
+                *gmin = m->gmin;
+                *gmax = m->gmax;
+                *c1min = m->c1min;
+                *c1max = m->c1max;
+                *c2min = m->c2min;
+                *c2max = m->c2max;
+            }
+            *gmin = amin1(*gmin, m->gmin);
+            *gmax = amax1(*gmax, m->gmax);
+            *c1min = amin1(*c1min, m->c1min);
+            *c1max = amax1(*c1max, m->c1max);
+            *c2min = amin1(*c2min, m->c2min);
+            *c2max = amax1(*c2max, m->c2max);
+        }
+
+        G_free_vector(p->az);
+        if (p->adx)
+            G_free_vector(p->adx);
+        if (p->ady)
+            G_free_vector(p->ady);
+        if (p->adxx)
+            G_free_vector(p->adxx);
+        if (p->adyy)
+            G_free_vector(p->adyy);
+        if (p->adxy)
+            G_free_vector(p->adxy);
+    }
+    G_free(out);
+}
+
 
 /*!
  * See documentation for IL_interp_segments_2d.
@@ -61,6 +202,7 @@ int IL_interp_segments_2d_parallel(struct interp_params *params, struct tree_inf
     double **A = NULL;
     struct quaddata **data_local;
     struct multtree **all_leafs;
+    struct IL_thread_output *out;
 
     all_leafs =
         (struct multtree **)G_malloc(sizeof(struct multtree *) * totsegm);
@@ -103,11 +245,16 @@ int IL_interp_segments_2d_parallel(struct interp_params *params, struct tree_inf
         }
     }
 
+    /* The grid of each segment is computed by its thread into its own
+     * rows, only writing of the rows and of the values at points is
+     * serialized. The minima and maxima are merged at the end. */
+    out = IL_thread_outputs_new(params, threads);
+
     smseg = smallest_segment(tree, 4);
     cut_tree(tree, all_leafs, &i);
 
     G_message(_("Starting parallel work"));
-#pragma omp parallel firstprivate(tid, i, j, zmin, zmax, tree, totsegm, offset1, dnorm, smseg, ertot, params, info, all_leafs, bitmask, b, indx, matrix, data_local, A) shared(cursegm, threads, some_thread_failed, zminac, zmaxac, gmin, gmax, c1min, c1max, c2min, c2max)  default(none)
+#pragma omp parallel firstprivate(tid, i, j, zmin, zmax, tree, totsegm, offset1, dnorm, smseg, ertot, params, out, info, all_leafs, bitmask, b, indx, matrix, data_local, A) shared(cursegm, threads, some_thread_failed)  default(none)
     {
 #pragma omp for schedule(dynamic)
         for (i_cnt = 0; i_cnt < totsegm; i_cnt++) {
@@ -361,8 +508,10 @@ int IL_interp_segments_2d_parallel(struct interp_params *params, struct tree_inf
                         G_lubksb(matrix[tid], data_local[tid]->n_points + 1,
                                  indx[tid], b[tid]);
                         /* put here condition to skip error if not needed */
-                        params->check_points(params, data_local[tid], b[tid],
-                                             ertot, zmin, dnorm, skip_point);
+                        out[tid].params.check_points(&out[tid].params,
+                                                       data_local[tid], b[tid],
+                                                       ertot, zmin, dnorm,
+                                                       skip_point);
                     }
                     else if (segtest == 1) {
                         for (i = 0; i < data_local[tid]->n_points - 1; i++) {
@@ -371,8 +520,10 @@ int IL_interp_segments_2d_parallel(struct interp_params *params, struct tree_inf
                         b[tid][0] = 0.;
                         G_lubksb(matrix[tid], data_local[tid]->n_points,
                                  indx[tid], b[tid]);
-                        params->check_points(params, data_local[tid], b[tid],
-                                             ertot, zmin, dnorm, skip_point);
+                        out[tid].params.check_points(&out[tid].params,
+                                                       data_local[tid], b[tid],
+                                                       ertot, zmin, dnorm,
+                                                       skip_point);
                     }
                 }               /*end of cv loop */
 
@@ -384,15 +535,14 @@ int IL_interp_segments_2d_parallel(struct interp_params *params, struct tree_inf
                         (params->Tmp_fd_xx != NULL) ||
                         (params->Tmp_fd_yy != NULL) ||
                         (params->Tmp_fd_xy != NULL)) {
-#pragma omp critical
-                        {
-                            if (params->grid_calc
-                                (params, data_local[tid], bitmask, zmin, zmax,
-                                 zminac, zmaxac, gmin, gmax, c1min, c1max,
-                                 c2min, c2max, ertot, b[tid], offset1,
-                                 dnorm) < 0) {
-                                some_thread_failed = -1;
-                            }
+                        struct IL_thread_output *m = &out[tid];
+
+                        if (params->grid_calc
+                            (&m->params, data_local[tid], bitmask,
+                             zmin, zmax, &m->zmin, &m->zmax, &m->gmin,
+                             &m->gmax, &m->c1min, &m->c1max, &m->c2min,
+                             &m->c2max, ertot, b[tid], offset1, dnorm) < 0) {
+                            some_thread_failed = -1;
                         }
                     }
                 }
@@ -412,12 +562,17 @@ int IL_interp_segments_2d_parallel(struct interp_params *params, struct tree_inf
                    G_free_ivector(indx);
                    G_free_vector(b);
                  */
+                if (params->cv)
+                    G_free(point);
                 G_free(data_local[tid]->points);
                 G_free(data_local[tid]);
             }
         }
     }                           /* All threads join master thread and terminate */
 
+    IL_thread_outputs_merge(out, threads, zminac, zmaxac, gmin, gmax,
+                            c1min, c1max, c2min, c2max);
+
     for (i_cnt = 0; i_cnt < threads; i_cnt++) {
         G_free(matrix[i_cnt]);
         G_free(indx[i_cnt]);
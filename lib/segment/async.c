@@ -0,0 +1,341 @@
+/**
+ * \file lib/segment/async.c
+ *
+ * \brief Segment background I/O routines.
+ *
+ * With background I/O, the libgis worker threads (see G_begin_execute())
+ * write dirty segments back before they are evicted and read segments
+ * ahead when consecutive page-ins follow a direction, e.g. row-major
+ * scans or a front moving across the matrix. A slot with pending I/O is
+ * waited for before it is accessed or reused.
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ * \author GRASS GIS Development Team
+ *
+ * \date 2019
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <grass/gis.h>
+#include "local_proto.h"
+
+/* maximum number of segments read or written ahead */
+#define MAX_DEPTH 64
+
+struct segio			/* pending I/O of a slot */
+{
+    SEGMENT *SEG;
+    int slot;
+    int write;			/* 1: write back, 0: read ahead */
+    int status;			/* 1: ok, 0: I/O error */
+    int err;			/* errno of failed I/O */
+    int prefetched;		/* read ahead, not yet accessed */
+    void *worker;		/* G_begin_execute() reference */
+};
+
+struct segaio
+{
+    int depth;			/* segments to read or write ahead */
+    int n_total_segs;
+    int last_n;			/* last segment paged in */
+    int stride;			/* distance of the last two page-ins */
+    struct segio *io;		/* one per slot */
+};
+
+/* runs on a worker thread: must not call G_warning() or G_fatal_error() */
+static void do_io(void *closure)
+{
+    struct segio *io = closure;
+    SEGMENT *SEG = io->SEG;
+    char *buf = SEG->scb[io->slot].buf;
+    off_t offset = (off_t) SEG->scb[io->slot].n * SEG->size + SEG->offset;
+    size_t size = SEG->size;
+
+    io->status = 1;
+    io->err = 0;
+
+    /* pread() and pwrite() leave the file offset of the caller alone */
+    while (size > 0) {
+	ssize_t n = io->write ? pwrite(SEG->fd, buf, size, offset)
+	    : pread(SEG->fd, buf, size, offset);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n == 0 && !io->write && size == (size_t) SEG->size) {
+	    /* not written yet, see seg_pagein() */
+	    memset(buf, 0, size);
+	    return;
+	}
+	if (n <= 0) {
+	    io->status = 0;
+	    io->err = n < 0 ? errno : 0;
+	    return;
+	}
+	buf += n;
+	size -= n;
+	offset += n;
+    }
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Enable background I/O if the environment variable
+ * GRASS_SEGMENT_PREFETCH is set to the number of segments to read and
+ * write ahead. Not used for compressed segments.
+ *
+ * \param[in,out] SEG segment
+ * \return 1 if background I/O is enabled
+ * \return 0 otherwise
+ */
+
+int seg_setup_async(SEGMENT * SEG)
+{
+    struct segaio *aio;
+    char *p = getenv("GRASS_SEGMENT_PREFETCH");
+    int depth = (p && *p) ? atoi(p) : 0;
+    int i;
+
+    SEG->aio = NULL;
+
+    if (depth <= 0 || SEG->compressor)
+	return 0;
+
+#ifdef __MINGW32__
+    G_debug(1, "Segment background I/O not supported on this platform");
+    return 0;
+#endif
+
+    /* keep the youngest half of the slots for the caller */
+    if (depth > SEG->nseg / 2)
+	depth = SEG->nseg / 2;
+    if (depth > MAX_DEPTH)
+	depth = MAX_DEPTH;
+    if (depth < 1)
+	return 0;
+
+    G_init_workers();
+    if (G_num_workers() == 0)
+	return 0;
+
+    aio = G_malloc(sizeof(struct segaio));
+    aio->depth = depth;
+    aio->n_total_segs =
+	SEG->spr * ((SEG->nrows + SEG->srows - 1) / SEG->srows);
+    aio->last_n = -1;
+    aio->stride = 0;
+    aio->io = G_calloc(SEG->nseg, sizeof(struct segio));
+    for (i = 0; i < SEG->nseg; i++) {
+	aio->io[i].SEG = SEG;
+	aio->io[i].slot = i;
+	aio->io[i].status = 1;
+    }
+
+    SEG->aio = aio;
+
+    G_debug(1, "Segment setup: background I/O, %d segments ahead", depth);
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Wait for pending I/O of slot <b>i</b>. A segment which could not be
+ * read ahead is dropped from the slot, so that seg_pagein() reads it
+ * again and reports the error.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] i slot
+ * \return 1 if successful
+ * \return -1 if the segment could not be written
+ */
+
+int seg_wait_async(SEGMENT * SEG, int i)
+{
+    struct segio *io;
+
+    if (!SEG->aio)
+	return 1;
+
+    io = &SEG->aio->io[i];
+    G_end_execute(&io->worker);
+
+    if (io->status)
+	return 1;
+
+    io->status = 1;
+
+    if (!io->write) {
+	/* forget the segment */
+	SEG->load_idx[SEG->scb[i].n] = -1;
+	SEG->scb[i].n = -1;
+	io->prefetched = 0;
+	return 1;
+    }
+
+    SEG->scb[i].dirty = 1;
+    if (io->err)
+	G_warning("Segment pageout: %s", strerror(io->err));
+    else
+	G_warning("Segment pageout: insufficient disk space?");
+
+    return -1;
+}
+
+/* can slot i be handed to a worker */
+static int is_idle(const SEGMENT * SEG, int i)
+{
+    return i != SEG->cur && !SEG->aio->io[i].worker;
+}
+
+static void start_io(SEGMENT * SEG, int i, int write)
+{
+    struct segio *io = &SEG->aio->io[i];
+
+    io->write = write;
+    if (write)
+	/* the slot can't be changed before it is waited for */
+	SEG->scb[i].dirty = 0;
+    G_begin_execute(do_io, io, &io->worker, 0);
+}
+
+/* write back the dirty segments which are evicted next */
+static void write_behind(SEGMENT * SEG)
+{
+    int slots[MAX_DEPTH];
+    int k, m;
+
+    if (SEG->nfreeslots)
+	return;
+
+    m = seg_policy_next(SEG, slots, SEG->aio->depth);
+    for (k = 0; k < m; k++) {
+	int i = slots[k];
+
+	if (SEG->scb[i].n >= 0 && SEG->scb[i].dirty && is_idle(SEG, i))
+	    start_io(SEG, i, 1);
+    }
+}
+
+/* get a slot to read segment n ahead, -1 if none is available */
+static int prefetch_slot(SEGMENT * SEG)
+{
+    int cur;
+
+    if (SEG->nfreeslots)
+	return SEG->freeslot[--SEG->nfreeslots];
+
+    /* the next segment to be replaced, if it doesn't need to be written */
+    if (seg_policy_next(SEG, &cur, 1) < 1)
+	return -1;
+    if (SEG->scb[cur].dirty || !is_idle(SEG, cur) ||
+	SEG->aio->io[cur].prefetched)
+	return -1;
+
+    seg_policy_victim(SEG);
+    if (SEG->scb[cur].n >= 0)
+	SEG->load_idx[SEG->scb[cur].n] = -1;
+
+    return cur;
+}
+
+static void read_ahead(SEGMENT * SEG, int n)
+{
+    struct segaio *aio = SEG->aio;
+    int k;
+
+    for (k = 1; k <= aio->depth; k++) {
+	int m = n + k * aio->stride;
+	int cur;
+
+	if (m < 0 || m >= aio->n_total_segs)
+	    break;
+	if (SEG->load_idx[m] >= 0)
+	    continue;
+	if ((cur = prefetch_slot(SEG)) < 0)
+	    break;
+
+	SEG->scb[cur].n = m;
+	SEG->scb[cur].dirty = 0;
+	SEG->load_idx[m] = cur;
+
+	seg_policy_insert(SEG, cur);
+
+	aio->io[cur].prefetched = 1;
+	start_io(SEG, cur, 0);
+    }
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Called by seg_pagein() when segment <b>n</b> was read into slot
+ * <b>i</b> or segment <b>n</b> is accessed the first time after it was
+ * read ahead. Starts background I/O.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] i slot
+ * \param[in] n segment number
+ */
+
+void seg_schedule_async(SEGMENT * SEG, int i, int n)
+{
+    struct segaio *aio = SEG->aio;
+    int stride;
+
+    aio->io[i].prefetched = 0;
+
+    write_behind(SEG);
+
+    /* read ahead if the last two page-ins were the same distance apart */
+    stride = aio->last_n >= 0 ? n - aio->last_n : 0;
+    aio->last_n = n;
+    if (stride != 0 && stride == aio->stride)
+	read_ahead(SEG, n);
+    aio->stride = stride;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Test if segment in slot <b>i</b> was read ahead and not yet accessed.
+ *
+ * \param[in] SEG segment
+ * \param[in] i slot
+ * \return 1 if the segment was read ahead
+ * \return 0 otherwise
+ */
+
+int seg_is_prefetched(const SEGMENT * SEG, int i)
+{
+    return SEG->aio && SEG->aio->io[i].prefetched;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Wait for all pending I/O and free the memory used for background I/O.
+ *
+ * \param[in,out] SEG segment
+ */
+
+void seg_release_async(SEGMENT * SEG)
+{
+    int i;
+
+    if (!SEG->aio)
+	return;
+
+    for (i = 0; i < SEG->nseg; i++)
+	seg_wait_async(SEG, i);
+
+    G_free(SEG->aio->io);
+    G_free(SEG->aio);
+    SEG->aio = NULL;
+}
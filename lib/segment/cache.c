@@ -0,0 +1,94 @@
+/**
+ * \file lib/segment/cache.c
+ *
+ * \brief Segment memory cache allocation.
+ *
+ * If all segments fit into memory, Segment_open() keeps the data in
+ * one array. On systems with mmap(), the array is an anonymous mapping
+ * which is backed by swap space and can use transparent huge pages,
+ * otherwise it is allocated with G_malloc().
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ * \author GRASS GIS Development Team
+ *
+ * \date 2019
+ */
+
+#include <grass/config.h>
+#include <sys/types.h>
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
+#include <grass/gis.h>
+#include "local_proto.h"
+
+#if defined(MAP_ANONYMOUS) && !defined(MAP_ANON)
+#define MAP_ANON MAP_ANONYMOUS
+#endif
+
+/**
+ * \brief Internal use only
+ *
+ * Allocate the memory cache for <b>SEG->nrows</b> by <b>SEG->ncols</b>
+ * values of <b>SEG->len</b> bytes. The memory is not initialized.
+ *
+ * \param[in,out] SEG segment
+ * \return 1 if successful
+ * \return -1 if unable to allocate memory
+ */
+
+int seg_alloc_cache(SEGMENT * SEG)
+{
+    size_t size = (size_t) SEG->nrows * SEG->ncols * SEG->len;
+
+    SEG->cache_mapped = 0;
+
+#ifdef MAP_ANON
+    {
+	void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANON, -1, 0);
+
+	if (ptr != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+	    /* fewer TLB misses for random access */
+	    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+	    SEG->cache = ptr;
+	    SEG->cache_mapped = 1;
+
+	    return 1;
+	}
+	G_debug(1, "Segment cache: mmap() failed, using malloc()");
+    }
+#endif
+
+    SEG->cache = G_malloc(size);
+
+    return SEG->cache ? 1 : -1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Free the memory cache.
+ *
+ * \param[in,out] SEG segment
+ */
+
+void seg_free_cache(SEGMENT * SEG)
+{
+#ifdef MAP_ANON
+    if (SEG->cache_mapped) {
+	munmap(SEG->cache,
+	       (size_t) SEG->nrows * SEG->ncols * SEG->len);
+	SEG->cache = NULL;
+	SEG->cache_mapped = 0;
+	return;
+    }
+#endif
+
+    G_free(SEG->cache);
+    SEG->cache = NULL;
+}
@@ -36,7 +36,7 @@ int Segment_close(SEGMENT *SEG)
 	return -1;
 
     if (SEG->cache) {
-	G_free(SEG->cache);
+	seg_free_cache(SEG);
     }
     else {
 	Segment_release(SEG);
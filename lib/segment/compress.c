@@ -0,0 +1,264 @@
+/**
+ * \file lib/segment/compress.c
+ *
+ * \brief Segment compression routines.
+ *
+ * With compression, each segment is compressed when it is paged out and
+ * stored at its previous location if it still fits there. Otherwise it
+ * goes to a free extent of the same size class or to the end of the
+ * segment file. A table in memory keeps the location and size of every
+ * segment. Segments which have never been written read as zeros.
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ * \author GRASS GIS Development Team
+ *
+ * \date 2019
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <grass/gis.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+/* extents are allocated in multiples of 1/NCLASS of the segment size */
+#define NCLASS 16
+
+struct spg			/* location of a segment in the file */
+{
+    off_t offset;		/* file offset */
+    int len;			/* stored size, 0 if never written */
+    int cap;			/* size class of the extent at offset */
+};
+
+struct segcmp
+{
+    struct spg *spg;		/* one per segment */
+    int unit;			/* extent size of class 1 */
+    off_t fend;			/* end of data in segment file */
+    unsigned char *cbuf;	/* compression buffer */
+    struct			/* free extents per size class */
+    {
+	off_t *offset;
+	int n, alloc;
+    } free[NCLASS + 1];
+};
+
+/**
+ * \brief Internal use only
+ *
+ * Get the compressor for segment files from the environment variable
+ * GRASS_SEGMENT_COMPRESSOR.
+ *
+ * \return compressor number, 0 if segments are not compressed
+ */
+
+int seg_compressor(void)
+{
+    char *name = getenv("GRASS_SEGMENT_COMPRESSOR");
+    int compressor;
+
+    if (!name || !*name)
+	return 0;
+
+    compressor = G_compressor_number(name);
+    if (compressor < 0) {
+	G_warning(_("Unknown compression method <%s> for segment files"),
+		  name);
+	return 0;
+    }
+    if (compressor > 0 && G_check_compressor(compressor) != 1) {
+	G_warning(_("This GRASS version does not support %s compression"),
+		  name);
+	return 0;
+    }
+
+    return compressor;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Enable compression of segments. The segment file must not contain
+ * any segments yet.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] compressor compressor number, see G_compress()
+ * \return 1 if successful
+ * \return -2 if unable to allocate memory
+ */
+
+int seg_setup_compression(SEGMENT * SEG, int compressor)
+{
+    struct segcmp *cmp;
+    int n_total_segs;
+
+    n_total_segs = SEG->spr * ((SEG->nrows + SEG->srows - 1) / SEG->srows);
+
+    cmp = G_calloc(1, sizeof(struct segcmp));
+    cmp->spg = G_calloc(n_total_segs, sizeof(struct spg));
+    cmp->cbuf = G_malloc(SEG->size);
+    if (!cmp->spg || !cmp->cbuf)
+	return -2;
+
+    cmp->unit = (SEG->size + NCLASS - 1) / NCLASS;
+    cmp->fend = SEG->offset;
+
+    SEG->cmp = cmp;
+    SEG->compressor = compressor;
+
+    G_debug(1, "Segment setup: %s compression", G_compressor_name(compressor));
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Read and expand segment <b>n</b> into the buffer of slot <b>i</b>.
+ *
+ * \param[in] SEG segment
+ * \param[in] i slot
+ * \param[in] n segment number
+ * \return 1 if successful
+ * \return -1 if unable to seek, read or expand the segment
+ */
+
+int seg_read_compressed(SEGMENT * SEG, int i, int n)
+{
+    struct segcmp *cmp = SEG->cmp;
+    struct spg *pg = &cmp->spg[n];
+    char *buf = SEG->scb[i].buf;
+    unsigned char *src;
+
+    if (pg->len == 0) {
+	/* never written */
+	memset(buf, 0, SEG->size);
+	return 1;
+    }
+
+    src = pg->len == SEG->size ? (unsigned char *)buf : cmp->cbuf;
+
+    if (lseek(SEG->fd, pg->offset, SEEK_SET) == (off_t) -1 ||
+	read(SEG->fd, src, pg->len) != pg->len) {
+	G_warning("Segment pagein: %s", strerror(errno));
+	return -1;
+    }
+
+    /* stored as is if it didn't compress */
+    if (src != (unsigned char *)buf &&
+	G_expand(src, pg->len, (unsigned char *)buf, SEG->size,
+		 SEG->compressor) != SEG->size) {
+	G_warning("Segment pagein: unable to expand segment %d", n);
+	return -1;
+    }
+
+    return 1;
+}
+
+/* get an extent of size class c */
+static off_t get_extent(struct segcmp *cmp, int c)
+{
+    off_t offset;
+
+    if (cmp->free[c].n > 0)
+	return cmp->free[c].offset[--cmp->free[c].n];
+
+    offset = cmp->fend;
+    cmp->fend += (off_t) c * cmp->unit;
+
+    return offset;
+}
+
+/* return an extent of size class c to the free list */
+static void put_extent(struct segcmp *cmp, int c, off_t offset)
+{
+    if (cmp->free[c].n == cmp->free[c].alloc) {
+	cmp->free[c].alloc = cmp->free[c].alloc ? 2 * cmp->free[c].alloc : 64;
+	cmp->free[c].offset = G_realloc(cmp->free[c].offset,
+					cmp->free[c].alloc * sizeof(off_t));
+    }
+    cmp->free[c].offset[cmp->free[c].n++] = offset;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Compress the buffer of slot <b>i</b> and write it to the segment file.
+ *
+ * \param[in] SEG segment
+ * \param[in] i slot
+ * \return 1 if successful
+ * \return -1 on error
+ */
+
+int seg_write_compressed(SEGMENT * SEG, int i)
+{
+    struct segcmp *cmp = SEG->cmp;
+    struct spg *pg = &cmp->spg[SEG->scb[i].n];
+    unsigned char *src;
+    int len, c;
+
+    len = G_compress((unsigned char *)SEG->scb[i].buf, SEG->size,
+		     cmp->cbuf, SEG->size, SEG->compressor);
+    if (len > 0 && len < SEG->size)
+	src = cmp->cbuf;
+    else {
+	src = (unsigned char *)SEG->scb[i].buf;
+	len = SEG->size;
+    }
+
+    /* keep the location if the segment still fits */
+    c = (len + cmp->unit - 1) / cmp->unit;
+    if (c > pg->cap) {
+	if (pg->cap)
+	    put_extent(cmp, pg->cap, pg->offset);
+	pg->offset = get_extent(cmp, c);
+	pg->cap = c;
+    }
+
+    errno = 0;
+    if (lseek(SEG->fd, pg->offset, SEEK_SET) == (off_t) -1 ||
+	write(SEG->fd, src, len) != len) {
+	int err = errno;
+
+	if (err)
+	    G_warning("Segment pageout: %s", strerror(err));
+	else
+	    G_warning("Segment pageout: insufficient disk space?");
+	return -1;
+    }
+    pg->len = len;
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Free the memory used for compression.
+ *
+ * \param[in,out] SEG segment
+ */
+
+void seg_release_compression(SEGMENT * SEG)
+{
+    struct segcmp *cmp = SEG->cmp;
+    int c;
+
+    if (!cmp)
+	return;
+
+    for (c = 0; c <= NCLASS; c++)
+	G_free(cmp->free[c].offset);
+    G_free(cmp->spg);
+    G_free(cmp->cbuf);
+    G_free(cmp);
+
+    SEG->cmp = NULL;
+    SEG->compressor = 0;
+}
@@ -33,10 +33,14 @@ int Segment_flush(SEGMENT * SEG)
 {
     int i;
 
-    if (SEG->scb) {
-	for (i = 0; i < SEG->nseg; i++)
+    if (SEG->share)
+	seg_flush_shared(SEG);
+    else if (SEG->scb) {
+	for (i = 0; i < SEG->nseg; i++) {
+	    seg_wait_async(SEG, i);
 	    if (SEG->scb[i].n >= 0 && SEG->scb[i].dirty)
 		seg_pageout(SEG, i);
+	}
     }
 
     return 0;
@@ -22,7 +22,6 @@
 #include "local_proto.h"
 
 
-static int seg_format(int, off_t, off_t, int, int, int, int);
 static int write_int(int, int);
 static int write_off_t(int, off_t);
 static int zero_fill(int, off_t);
@@ -105,8 +104,20 @@ int Segment_format_nofill(int fd, off_t nrows, off_t ncols, int srows, int scols
 }
 
 
-static int seg_format(int fd, off_t nrows, off_t ncols,
-		      int srows, int scols, int len, int fill)
+/**
+ * \brief Internal use only
+ *
+ * Write the header of a segment file and prepare the data part:
+ * <b>fill</b> = 1 writes zeros, 0 only extends the file, -1 writes
+ * the header only (compressed segments are appended when paged out).
+ *
+ * \return 1 of successful
+ * \return -1 if unable to seek or write <b>fd</b>
+ * \return -3 if illegal parameters are passed
+ */
+
+int seg_format(int fd, off_t nrows, off_t ncols,
+	       int srows, int scols, int len, int fill)
 {
     off_t nbytes;
     int spr, size;
@@ -162,6 +173,9 @@ static int seg_format(int fd, off_t nrows, off_t ncols,
     nbytes = spr * ((nrows + srows - 1) / srows);
     nbytes *= size;
 
+    if (fill < 0)
+	return 1;
+
     if (!fill) {
 	/* only seek and write a zero byte to the end */ 
 	if (seek_only(fd, nbytes) < 0)
@@ -41,12 +41,27 @@ int Segment_get(SEGMENT * SEG, void *buf, off_t row, off_t col)
     int index, n, i;
 
     if (SEG->cache) {
-	memcpy(buf, SEG->cache + ((size_t)row * SEG->ncols + col) * SEG->len, SEG->len);
+	const char *p = SEG->cache + ((size_t)row * SEG->ncols + col) * SEG->len;
+
+	/* constant sizes are copied inline */
+	switch (SEG->len) {
+	case 4:
+	    memcpy(buf, p, 4);
+	    break;
+	case 8:
+	    memcpy(buf, p, 8);
+	    break;
+	default:
+	    memcpy(buf, p, SEG->len);
+	    break;
+	}
 	
 	return 1;
     }
 
-    SEG->address(SEG, row, col, &n, &index);
+    SEG_ADDRESS(SEG, row, col, &n, &index);
+    if (SEG->share)
+	return seg_copy_shared(SEG, buf, n, index, SEG->len, 0);
     if ((i = seg_pagein(SEG, n)) < 0)
 	return -1;
 
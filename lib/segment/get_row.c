@@ -57,6 +57,32 @@ int Segment_get_row(const SEGMENT * SEG, void *buf, off_t row)
     scols = SEG->scols;
     size = scols * SEG->len;
 
+    /* compressed segments can only be read whole, with background I/O
+     * the segments are read ahead if a band of segments fits in memory */
+    if (SEG->compressor || SEG->share ||
+	(SEG->aio && SEG->nseg >= 2 * SEG->spr)) {
+	SEGMENT *S = (SEGMENT *) SEG;
+	int i;
+
+	for (col = 0; col < SEG->ncols; col += scols) {
+	    if (col >= ncols)
+		size = SEG->spill * SEG->len;
+	    SEG->address(SEG, row, col, &n, &index);
+	    if (SEG->share) {
+		if (seg_copy_shared(SEG, buf, n, index, size, 0) < 0)
+		    return -1;
+	    }
+	    else {
+		if ((i = seg_pagein(S, n)) < 0)
+		    return -1;
+		memcpy(buf, &SEG->scb[i].buf[index], size);
+	    }
+	    buf = ((char *)buf) + size;
+	}
+
+	return 1;
+    }
+
     for (col = 0; col < ncols; col += scols) {
 	SEG->address(SEG, row, col, &n, &index);
 	SEG->seek(SEG, n, index);
@@ -5,17 +5,65 @@
 
 /* internal functions */
 
+/* seg_address() without a function call for the fast seek case */
+#define SEG_ADDRESS(SEG, row, col, n, index)				\
+    do {								\
+	if ((SEG)->fast_seek) {						\
+	    *(n) = ((row) >> (SEG)->srowbits) * (SEG)->spr +		\
+		((col) >> (SEG)->scolbits);				\
+	    *(index) = (((((row) & ((SEG)->srows - 1)) << (SEG)->scolbits) \
+			 + ((col) & ((SEG)->scols - 1))) << (SEG)->lenbits); \
+	}								\
+	else								\
+	    (SEG)->address((SEG), (row), (col), (n), (index));		\
+    } while (0)
+
 /* address.c */
 int seg_address(const SEGMENT *, off_t, off_t, int *, int *);
 int seg_address_fast(const SEGMENT *, off_t, off_t, int *, int *);
 int seg_address_slow(const SEGMENT *, off_t, off_t, int *, int *);
 
+/* async.c */
+int seg_setup_async(SEGMENT *);
+int seg_wait_async(SEGMENT *, int);
+void seg_schedule_async(SEGMENT *, int, int);
+int seg_is_prefetched(const SEGMENT *, int);
+void seg_release_async(SEGMENT *);
+
+/* cache.c */
+int seg_alloc_cache(SEGMENT *);
+void seg_free_cache(SEGMENT *);
+
+/* compress.c */
+int seg_compressor(void);
+int seg_setup_compression(SEGMENT *, int);
+int seg_read_compressed(SEGMENT *, int, int);
+int seg_write_compressed(SEGMENT *, int);
+void seg_release_compression(SEGMENT *);
+
+/* format.c */
+int seg_format(int, off_t, off_t, int, int, int, int);
+
 /* pagein.c */
 int seg_pagein(SEGMENT *, int);
 
 /* pageout.c */
 int seg_pageout(SEGMENT *, int);
 
+/* shared.c */
+int seg_copy_shared(const SEGMENT *, void *, int, int, int, int);
+void seg_flush_shared(SEGMENT *);
+void seg_release_shared(SEGMENT *);
+
+/* policy.c */
+int seg_policy(void);
+int seg_setup_policy(SEGMENT *);
+void seg_release_policy(SEGMENT *);
+void seg_policy_hit(SEGMENT *, int);
+void seg_policy_insert(SEGMENT *, int);
+int seg_policy_next(const SEGMENT *, int *, int);
+int seg_policy_victim(SEGMENT *);
+
 /* seek.c */
 int seg_seek(const SEGMENT *, int, int);
 int seg_seek_fast(const SEGMENT *, int, int);
@@ -23,6 +71,7 @@ int seg_seek_slow(const SEGMENT *, int, int);
 
 /* setup.c */
 int seg_setup(SEGMENT *);
+int seg_setup_slots(SEGMENT *);
 
 #endif /* Segment_LOCAL_H */
 
@@ -26,6 +26,14 @@
  *
  * <b>Note:</b> The file with name fname will be created anew.
  *
+ * If the environment variable GRASS_SEGMENT_COMPRESSOR is set to a
+ * compression method (e.g. LZ4 or ZSTD, see G_compressor_number()),
+ * segments are compressed in the segment file.
+ *
+ * If the environment variable GRASS_SEGMENT_PREFETCH is set to a number
+ * of segments, segments are written back and read ahead by the libgis
+ * worker threads while the caller accesses other segments.
+ *
  * \param[in,out] SEG segment
  * \param[in] fname file name
  * \param[in] nrows number of non-segmented rows
@@ -49,6 +57,7 @@ Segment_open(SEGMENT *SEG, char *fname, off_t nrows, off_t ncols,
 {
     int ret;
     int nseg_total;
+    int compressor;
 
     nseg_total = ((nrows + srows - 1) / srows) * 
                  ((ncols + scols - 1) / scols);
@@ -60,7 +69,10 @@ Segment_open(SEGMENT *SEG, char *fname, off_t nrows, off_t ncols,
 	SEG->ncols = ncols;
 	SEG->len = len;
 	SEG->nseg = nseg;
-	SEG->cache = G_malloc(sizeof(char) * SEG->nrows * SEG->ncols * SEG->len);
+	if (seg_alloc_cache(SEG) < 0) {
+	    G_warning(_("Out of memory"));
+	    return -6;
+	}
 	SEG->scb = NULL;
 	SEG->open = 1;
 	
@@ -82,12 +94,15 @@ Segment_open(SEGMENT *SEG, char *fname, off_t nrows, off_t ncols,
     SEG->fname = G_store(fname);
     SEG->fd = -1;
 
+    /* compressed segments are written on demand */
+    compressor = seg_compressor();
+
     if (-1 == (SEG->fd = creat(SEG->fname, 0666))) {
 	G_warning(_("Unable to create segment file"));
 	return -1;
     }
-    if (0 > (ret = Segment_format_nofill(SEG->fd, nrows, ncols, srows,
-							scols, len))) {
+    if (0 > (ret = seg_format(SEG->fd, nrows, ncols, srows, scols, len,
+                              compressor ? -1 : 0))) {
 	close(SEG->fd);
 	unlink(SEG->fname);
 	if (ret == -1) {
@@ -119,6 +134,14 @@ Segment_open(SEGMENT *SEG, char *fname, off_t nrows, off_t ncols,
 	    return -6;
 	}
     }
+    if (compressor && seg_setup_compression(SEG, compressor) < 0) {
+	Segment_release(SEG);
+	close(SEG->fd);
+	unlink(SEG->fname);
+	G_warning(_("Out of memory"));
+	return -6;
+    }
+    seg_setup_async(SEG);
 
     return 1;
 }
@@ -40,36 +40,39 @@ int seg_pagein(SEGMENT * SEG, int n)
     int read_result;
 
     /* is n the current segment? */
-    if (n == SEG->scb[SEG->cur].n)
+    if (n == SEG->scb[SEG->cur].n) {
+	SEG->nhits++;
 	return SEG->cur;
+    }
 
     /* segment n is in memory ? */
 
+    if (SEG->load_idx[n] >= 0 &&
+	seg_wait_async(SEG, SEG->load_idx[n]) < 0)
+	return -1;
+
     if (SEG->load_idx[n] >= 0) {
 	cur = SEG->load_idx[n];
+	SEG->nhits++;
+	seg_policy_hit(SEG, cur);
 
-	if (SEG->scb[cur].age != SEG->youngest) {
-	    /* splice out */
-	    SEG->scb[cur].age->younger->older = SEG->scb[cur].age->older;
-	    SEG->scb[cur].age->older->younger = SEG->scb[cur].age->younger;
-	    /* splice in */
-	    SEG->scb[cur].age->younger = SEG->youngest->younger;
-	    SEG->scb[cur].age->older = SEG->youngest;
-	    SEG->scb[cur].age->older->younger = SEG->scb[cur].age;
-	    SEG->scb[cur].age->younger->older = SEG->scb[cur].age;
-	    /* make it youngest */
-	    SEG->youngest = SEG->scb[cur].age;
-	}
+	SEG->cur = cur;
+	if (seg_is_prefetched(SEG, cur))
+	    seg_schedule_async(SEG, cur, n);
 
-	return SEG->cur = cur;
+	return cur;
     }
 
+    SEG->nmisses++;
+
     /* find a slot to use to hold segment */
     if (!SEG->nfreeslots) {
-	/* use oldest segment */
-	SEG->oldest = SEG->oldest->younger;
-	cur = SEG->oldest->cur;
-	SEG->oldest->cur = -1;
+	/* replace a segment, see policy.c */
+	cur = seg_policy_victim(SEG);
+
+	/* wait for background I/O of the slot */
+	if (seg_wait_async(SEG, cur) < 0)
+	    return -1;
 
 	/* unload segment */
 	if (SEG->scb[cur].n >= 0) {
@@ -77,6 +80,7 @@ int seg_pagein(SEGMENT * SEG, int n)
 
 	    /* write it out if dirty */
 	    if (SEG->scb[cur].dirty) {
+		SEG->ndirty++;
 		if (seg_pageout(SEG, cur) < 0)
 		    return -1;
 	    }
@@ -90,9 +94,16 @@ int seg_pagein(SEGMENT * SEG, int n)
     /* read in the segment */
     SEG->scb[cur].n = n;
     SEG->scb[cur].dirty = 0;
-    SEG->seek(SEG, SEG->scb[cur].n, 0);
 
-    read_result = read(SEG->fd, SEG->scb[cur].buf, SEG->size);
+    if (SEG->compressor) {
+	if (seg_read_compressed(SEG, cur, n) < 0)
+	    return -1;
+	read_result = SEG->size;
+    }
+    else {
+	SEG->seek(SEG, SEG->scb[cur].n, 0);
+	read_result = read(SEG->fd, SEG->scb[cur].buf, SEG->size);
+    }
 
     if (read_result == 0) {
 	/* this can happen if the file was not zero-filled,
@@ -118,10 +129,11 @@ int seg_pagein(SEGMENT * SEG, int n)
     /* add loaded segment to index */
     SEG->load_idx[n] = cur;
 
-    /* make it youngest segment */
-    SEG->youngest = SEG->youngest->younger;
-    SEG->scb[cur].age = SEG->youngest;
-    SEG->youngest->cur = cur;
+    seg_policy_insert(SEG, cur);
+
+    SEG->cur = cur;
+    if (SEG->aio)
+	seg_schedule_async(SEG, cur, n);
 
-    return SEG->cur = cur;
+    return cur;
 }
@@ -36,6 +36,13 @@
 
 int seg_pageout(SEGMENT * SEG, int i)
 {
+    if (SEG->compressor) {
+	if (seg_write_compressed(SEG, i) < 0)
+	    return -1;
+	SEG->scb[i].dirty = 0;
+	return 1;
+    }
+
     SEG->seek(SEG, SEG->scb[i].n, 0);
     errno = 0;
     if (write(SEG->fd, SEG->scb[i].buf, SEG->size) != SEG->size) {
@@ -0,0 +1,404 @@
+/**
+ * \file lib/segment/policy.c
+ *
+ * \brief Segment replacement policies.
+ *
+ * The policy decides which segment in memory is replaced when another
+ * segment is paged in:
+ *
+ *  - LRU: the least recently used segment (default). A hit moves the
+ *    segment to the young end of the age queue.
+ *  - CLOCK: the slots form a circle with a reference bit each; the hand
+ *    clears reference bits until it finds a slot without one. A hit
+ *    only sets the reference bit.
+ *  - 2Q: segments which are paged in go to a FIFO queue; a segment
+ *    which is paged in again shortly after it left the FIFO goes to an
+ *    LRU queue, so that segments used once by a scan don't push out
+ *    segments which are used repeatedly.
+ *
+ * The policy is set with the environment variable GRASS_SEGMENT_POLICY.
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ * \author GRASS GIS Development Team
+ *
+ * \date 2019
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+/* 2Q queues */
+#define Q_NONE 0
+#define Q_IN   1		/* FIFO of segments paged in once */
+#define Q_MAIN 2		/* LRU of segments paged in again */
+
+struct segpolicy
+{
+    /* CLOCK */
+    char *ref;			/* reference bit per slot */
+    int hand;
+
+    /* 2Q, lists of slots: head is youngest, tail is oldest */
+    int *prev, *next;
+    char *queue;		/* Q_* of each slot */
+    int head[3], tail[3], len[3];
+    int kin;			/* target length of the FIFO queue */
+    int *ghost;			/* ring of segments which left the FIFO */
+    int kout, nghost, ghost_pos;
+    unsigned char *is_ghost;	/* per segment: in ghost ring */
+};
+
+/**
+ * \brief Internal use only
+ *
+ * Get the replacement policy from the environment variable
+ * GRASS_SEGMENT_POLICY.
+ *
+ * \return SEGMENT_LRU, SEGMENT_CLOCK or SEGMENT_2Q
+ */
+
+int seg_policy(void)
+{
+    char *name = getenv("GRASS_SEGMENT_POLICY");
+
+    if (!name || !*name || G_strcasecmp(name, "LRU") == 0)
+	return SEGMENT_LRU;
+    if (G_strcasecmp(name, "CLOCK") == 0)
+	return SEGMENT_CLOCK;
+    if (G_strcasecmp(name, "2Q") == 0)
+	return SEGMENT_2Q;
+
+    G_warning(_("Unknown segment replacement policy <%s>, using LRU"),
+	      name);
+
+    return SEGMENT_LRU;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Allocate the state of the replacement policy <b>SEG->policy</b>.
+ * Called by seg_setup_slots().
+ *
+ * \param[in,out] SEG segment
+ * \return 1 if successful
+ * \return -2 if unable to allocate memory
+ */
+
+int seg_setup_policy(SEGMENT * SEG)
+{
+    struct segpolicy *pol;
+    int n_total_segs;
+    int i;
+
+    SEG->pol = NULL;
+    if (SEG->policy == SEGMENT_LRU)
+	return 1;
+
+    pol = G_calloc(1, sizeof(struct segpolicy));
+    if (!pol)
+	return -2;
+
+    if (SEG->policy == SEGMENT_CLOCK) {
+	pol->ref = G_calloc(SEG->nseg, 1);
+	pol->hand = 0;
+	SEG->pol = pol;
+	return pol->ref ? 1 : -2;
+    }
+
+    /* 2Q with the recommended queue sizes: 1/4 for the FIFO, ghost
+     * entries for 1/2 of the slots */
+    n_total_segs = SEG->spr * ((SEG->nrows + SEG->srows - 1) / SEG->srows);
+
+    pol->prev = G_malloc(SEG->nseg * sizeof(int));
+    pol->next = G_malloc(SEG->nseg * sizeof(int));
+    pol->queue = G_calloc(SEG->nseg, 1);
+    for (i = 0; i < 3; i++) {
+	pol->head[i] = pol->tail[i] = -1;
+	pol->len[i] = 0;
+    }
+    pol->kin = SEG->nseg / 4 > 0 ? SEG->nseg / 4 : 1;
+    pol->kout = SEG->nseg / 2 > 0 ? SEG->nseg / 2 : 1;
+    pol->ghost = G_malloc(pol->kout * sizeof(int));
+    pol->nghost = pol->ghost_pos = 0;
+    pol->is_ghost = G_calloc(n_total_segs, 1);
+    SEG->pol = pol;
+
+    if (!pol->prev || !pol->next || !pol->queue || !pol->ghost ||
+	!pol->is_ghost)
+	return -2;
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Free the state of the replacement policy.
+ *
+ * \param[in,out] SEG segment
+ */
+
+void seg_release_policy(SEGMENT * SEG)
+{
+    struct segpolicy *pol = SEG->pol;
+
+    if (!pol)
+	return;
+
+    G_free(pol->ref);
+    G_free(pol->prev);
+    G_free(pol->next);
+    G_free(pol->queue);
+    G_free(pol->ghost);
+    G_free(pol->is_ghost);
+    G_free(pol);
+    SEG->pol = NULL;
+}
+
+/* 2Q list operations */
+
+static void unlink_slot(struct segpolicy *pol, int i)
+{
+    int q = pol->queue[i];
+
+    if (pol->prev[i] >= 0)
+	pol->next[pol->prev[i]] = pol->next[i];
+    else
+	pol->head[q] = pol->next[i];
+    if (pol->next[i] >= 0)
+	pol->prev[pol->next[i]] = pol->prev[i];
+    else
+	pol->tail[q] = pol->prev[i];
+
+    pol->len[q]--;
+    pol->queue[i] = Q_NONE;
+}
+
+static void push_slot(struct segpolicy *pol, int q, int i)
+{
+    pol->prev[i] = -1;
+    pol->next[i] = pol->head[q];
+    if (pol->head[q] >= 0)
+	pol->prev[pol->head[q]] = i;
+    else
+	pol->tail[q] = i;
+    pol->head[q] = i;
+
+    pol->len[q]++;
+    pol->queue[i] = q;
+}
+
+static void add_ghost(struct segpolicy *pol, int n)
+{
+    if (n < 0)
+	return;
+
+    if (pol->nghost == pol->kout) {
+	/* forget the oldest ghost */
+	int old = pol->ghost[pol->ghost_pos];
+
+	if (pol->is_ghost[old] > 0)
+	    pol->is_ghost[old]--;
+    }
+    else
+	pol->nghost++;
+
+    pol->ghost[pol->ghost_pos] = n;
+    pol->ghost_pos = (pol->ghost_pos + 1) % pol->kout;
+    pol->is_ghost[n]++;
+}
+
+/* 2Q: queue which gives the next victim */
+static int victim_queue(const struct segpolicy *pol)
+{
+    if (pol->len[Q_IN] > pol->kin || pol->len[Q_MAIN] == 0)
+	return Q_IN;
+
+    return Q_MAIN;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Record a hit on the segment in slot <b>i</b>.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] i slot
+ */
+
+void seg_policy_hit(SEGMENT * SEG, int i)
+{
+    struct segpolicy *pol = SEG->pol;
+
+    switch (SEG->policy) {
+    case SEGMENT_CLOCK:
+	pol->ref[i] = 1;
+	break;
+    case SEGMENT_2Q:
+	/* FIFO: hits don't change the order */
+	if (pol->queue[i] == Q_MAIN && pol->head[Q_MAIN] != i) {
+	    unlink_slot(pol, i);
+	    push_slot(pol, Q_MAIN, i);
+	}
+	break;
+    default:
+	if (SEG->scb[i].age != SEG->youngest) {
+	    /* splice out */
+	    SEG->scb[i].age->younger->older = SEG->scb[i].age->older;
+	    SEG->scb[i].age->older->younger = SEG->scb[i].age->younger;
+	    /* splice in */
+	    SEG->scb[i].age->younger = SEG->youngest->younger;
+	    SEG->scb[i].age->older = SEG->youngest;
+	    SEG->scb[i].age->older->younger = SEG->scb[i].age;
+	    SEG->scb[i].age->younger->older = SEG->scb[i].age;
+	    /* make it youngest */
+	    SEG->youngest = SEG->scb[i].age;
+	}
+	break;
+    }
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Add slot <b>i</b> holding the newly paged in segment
+ * <b>SEG->scb[i].n</b>.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] i slot
+ */
+
+void seg_policy_insert(SEGMENT * SEG, int i)
+{
+    struct segpolicy *pol = SEG->pol;
+    int n = SEG->scb[i].n;
+
+    switch (SEG->policy) {
+    case SEGMENT_CLOCK:
+	pol->ref[i] = 1;
+	break;
+    case SEGMENT_2Q:
+	if (n >= 0 && pol->is_ghost[n])
+	    /* seen recently */
+	    push_slot(pol, Q_MAIN, i);
+	else
+	    push_slot(pol, Q_IN, i);
+	break;
+    default:
+	/* make it youngest segment */
+	SEG->youngest = SEG->youngest->younger;
+	SEG->scb[i].age = SEG->youngest;
+	SEG->youngest->cur = i;
+	break;
+    }
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Get up to <b>k</b> slots in the order in which they would be
+ * replaced, without changing the state of the policy. Only used when
+ * all slots are occupied.
+ *
+ * \param[in] SEG segment
+ * \param[out] slots slots
+ * \param[in] k maximum number of slots
+ * \return number of slots
+ */
+
+int seg_policy_next(const SEGMENT * SEG, int *slots, int k)
+{
+    const struct segpolicy *pol = SEG->pol;
+    int m = 0;
+
+    switch (SEG->policy) {
+    case SEGMENT_CLOCK:{
+	    int j, i = pol->hand;
+
+	    /* slots without reference bit first, as the hand moves */
+	    for (j = 0; j < SEG->nseg && m < k; j++, i = (i + 1) % SEG->nseg)
+		if (!pol->ref[i])
+		    slots[m++] = i;
+	    if (m == 0 && k > 0)
+		slots[m++] = pol->hand;
+	}
+	break;
+    case SEGMENT_2Q:{
+	    int q = victim_queue(pol);
+	    int i;
+
+	    for (i = pol->tail[q]; i >= 0 && m < k; i = pol->prev[i])
+		slots[m++] = i;
+	    q = q == Q_IN ? Q_MAIN : Q_IN;
+	    for (i = pol->tail[q]; i >= 0 && m < k; i = pol->prev[i])
+		slots[m++] = i;
+	}
+	break;
+    default:{
+	    struct aq *age;
+
+	    for (age = SEG->oldest->younger;
+		 m < k && age != SEG->oldest; age = age->younger) {
+		if (age->cur >= 0)
+		    slots[m++] = age->cur;
+		if (age == SEG->youngest)
+		    break;
+	    }
+	}
+	break;
+    }
+
+    return m;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Remove the slot which is replaced next and return it. Only used when
+ * all slots are occupied. The first slot returned by seg_policy_next()
+ * is the slot which is removed.
+ *
+ * \param[in,out] SEG segment
+ * \return slot
+ */
+
+int seg_policy_victim(SEGMENT * SEG)
+{
+    struct segpolicy *pol = SEG->pol;
+    int cur;
+
+    switch (SEG->policy) {
+    case SEGMENT_CLOCK:
+	/* advance to the next slot without reference bit */
+	while (pol->ref[pol->hand]) {
+	    pol->ref[pol->hand] = 0;
+	    pol->hand = (pol->hand + 1) % SEG->nseg;
+	}
+	cur = pol->hand;
+	pol->hand = (pol->hand + 1) % SEG->nseg;
+	break;
+    case SEGMENT_2Q:{
+	    int q = victim_queue(pol);
+
+	    cur = pol->tail[q];
+	    unlink_slot(pol, cur);
+	    if (q == Q_IN)
+		add_ghost(pol, SEG->scb[cur].n);
+	}
+	break;
+    default:
+	/* use oldest segment */
+	SEG->oldest = SEG->oldest->younger;
+	cur = SEG->oldest->cur;
+	SEG->oldest->cur = -1;
+	break;
+    }
+
+    return cur;
+}
@@ -47,12 +47,32 @@ int Segment_put(SEGMENT * SEG, const void *buf, off_t row, off_t col)
     int index, n, i;
 
     if (SEG->cache) {
-	memcpy(SEG->cache + ((size_t)row * SEG->ncols + col) * SEG->len, buf, SEG->len);
+	char *p = SEG->cache + ((size_t)row * SEG->ncols + col) * SEG->len;
+
+	/* constant sizes are copied inline */
+	switch (SEG->len) {
+	case 4:
+	    memcpy(p, buf, 4);
+	    break;
+	case 8:
+	    memcpy(p, buf, 8);
+	    break;
+	default:
+	    memcpy(p, buf, SEG->len);
+	    break;
+	}
 	
 	return 1;
     }
 
-    SEG->address(SEG, row, col, &n, &index);
+    SEG_ADDRESS(SEG, row, col, &n, &index);
+    if (SEG->share) {
+	if (seg_copy_shared(SEG, (void *)buf, n, index, SEG->len, 1) < 0) {
+	    G_warning("segment lib: put: pagein failed");
+	    return -1;
+	}
+	return 1;
+    }
     if ((i = seg_pagein(SEG, n)) < 0) {
 	G_warning("segment lib: put: pagein failed");
 	return -1;
@@ -59,6 +59,49 @@ int Segment_put_row(const SEGMENT * SEG, const void *buf, off_t row)
     ncols = SEG->ncols - SEG->spill;
     scols = SEG->scols;
     size = scols * SEG->len;
+
+    /* compressed segments can only be written whole, shared segments
+     * are written through the shards */
+    if (SEG->compressor || SEG->share) {
+	SEGMENT *S = (SEGMENT *) SEG;
+	int i;
+
+	for (col = 0; col < SEG->ncols; col += scols) {
+	    if (col >= ncols)
+		size = SEG->spill * SEG->len;
+	    SEG->address(SEG, row, col, &n, &index);
+	    if (SEG->share) {
+		if (seg_copy_shared(SEG, (void *)buf, n, index, size, 1) < 0)
+		    return -1;
+	    }
+	    else {
+		if ((i = seg_pagein(S, n)) < 0)
+		    return -1;
+		memcpy(&SEG->scb[i].buf[index], buf, size);
+		S->scb[i].dirty = 1;
+	    }
+	    buf = ((const char *)buf) + size;
+	}
+
+	return 1;
+    }
+    if (SEG->nfreeslots < SEG->nseg) {
+	/* update segments in memory, they would be stale otherwise */
+	SEGMENT *S = (SEGMENT *) SEG;
+	const char *p = buf;
+	int i;
+
+	for (col = 0; col < SEG->ncols; col += scols) {
+	    SEG->address(SEG, row, col, &n, &index);
+	    if ((i = SEG->load_idx[n]) >= 0 && seg_wait_async(S, i) < 0)
+		return -1;
+	    if ((i = SEG->load_idx[n]) >= 0)
+		memcpy(&SEG->scb[i].buf[index], p,
+		       col < ncols ? size : SEG->spill * SEG->len);
+	    p += size;
+	}
+    }
+
     /*      printf("Segment_put_row ncols: %d, scols %d, size: %d, col %d, row: %d,  SEG->fd: %d\n",ncols,scols,size,col,row, SEG->fd); */
 
     for (col = 0; col < ncols; col += scols) {
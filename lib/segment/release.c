@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 #include <grass/gis.h>
+#include <grass/glocale.h>
 #include "local_proto.h"
 
 
@@ -35,18 +36,37 @@
 
 int Segment_release(SEGMENT * SEG)
 {
+    static int perf_hits, perf_misses;
     int i;
 
     if (SEG->open != 1)
 	return -1;
 
-    for (i = 0; i < SEG->nseg; i++)
-	G_free(SEG->scb[i].buf);
-    G_free(SEG->scb);
+    seg_release_async(SEG);
+    seg_release_shared(SEG);
+
+    G_perf_count(&perf_hits, "segment.hits", SEG->nhits);
+    G_perf_count(&perf_misses, "segment.misses", SEG->nmisses);
+
+    if (SEG->nhits + SEG->nmisses > 0)
+	G_verbose_message(_("Segment cache: %" PRI_OFF_T " hits, %" PRI_OFF_T
+			    " misses (%.1f%%), %" PRI_OFF_T
+			    " dirty segments written on replacement"),
+			  SEG->nhits, SEG->nmisses,
+			  100. * SEG->nmisses / (SEG->nhits + SEG->nmisses),
+			  SEG->ndirty);
+
+    if (SEG->scb) {
+	for (i = 0; i < SEG->nseg; i++)
+	    G_free(SEG->scb[i].buf);
+	G_free(SEG->scb);
+    }
 
     G_free(SEG->freeslot);
     G_free(SEG->agequeue);
     G_free(SEG->load_idx);
+    seg_release_policy(SEG);
+    seg_release_compression(SEG);
 
     SEG->open = 0;
 
@@ -40,6 +40,13 @@ int seg_setup(SEGMENT * SEG)
 
     SEG->open = 0;
     SEG->cache = NULL;
+    SEG->compressor = 0;
+    SEG->cmp = NULL;
+    SEG->aio = NULL;
+    SEG->share = NULL;
+    SEG->policy = seg_policy();
+    SEG->pol = NULL;
+    SEG->nhits = SEG->nmisses = SEG->ndirty = 0;
 
     if (SEG->nrows <= 0 || SEG->ncols <= 0
 	|| SEG->srows <= 0 || SEG->scols <= 0
@@ -106,6 +113,43 @@ int seg_setup(SEGMENT * SEG)
 	SEG->nseg = n_total_segs;
     }
 
+    SEG->srowscols = SEG->srows * SEG->scols;
+    SEG->size = SEG->srowscols * SEG->len;
+
+    if (seg_setup_slots(SEG) < 0)
+	return -2;
+
+    SEG->open = 1;
+
+    /* index for each segment, same like cache of r.proj */
+
+    /* alternative using less memory: RB Tree */
+    /* SEG->loaded = rbtree_create(cmp, sizeof(SEGID)); */
+    /* SEG->loaded = NULL; */
+
+    SEG->load_idx = G_malloc(n_total_segs * sizeof(int));
+
+    for (i = 0; i < n_total_segs; i++)
+	SEG->load_idx[i] = -1;
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Allocate the <b>nseg</b> slots of a segment and their age queue.
+ * <b>SEG</b> must have the segment size set.
+ *
+ * \param[in,out] SEG segment
+ * \return 1 if successful
+ * \return -2 if unable to allocate memory
+ */
+
+int seg_setup_slots(SEGMENT * SEG)
+{
+    int i;
+
     if ((SEG->scb =
 	 (struct scb *)G_malloc(SEG->nseg *
 					sizeof(struct scb))) == NULL)
@@ -118,9 +162,6 @@ int seg_setup(SEGMENT * SEG)
 	 (struct aq *)G_malloc((SEG->nseg + 1) * sizeof(struct aq))) == NULL)
 	return -2;
 
-    SEG->srowscols = SEG->srows * SEG->scols;
-    SEG->size = SEG->srowscols * SEG->len;
-
     for (i = 0; i < SEG->nseg; i++) {
 	if ((SEG->scb[i].buf = G_malloc(SEG->size)) == NULL)
 	    return -2;
@@ -147,18 +188,6 @@ int seg_setup(SEGMENT * SEG)
 
     SEG->nfreeslots = SEG->nseg;
     SEG->cur = 0;
-    SEG->open = 1;
 
-    /* index for each segment, same like cache of r.proj */
-
-    /* alternative using less memory: RB Tree */
-    /* SEG->loaded = rbtree_create(cmp, sizeof(SEGID)); */
-    /* SEG->loaded = NULL; */
-
-    SEG->load_idx = G_malloc(n_total_segs * sizeof(int));
-
-    for (i = 0; i < n_total_segs; i++)
-	SEG->load_idx[i] = -1;
-
-    return 1;
+    return seg_setup_policy(SEG);
 }
@@ -0,0 +1,264 @@
+/**
+ * \file lib/segment/shared.c
+ *
+ * \brief Segment routines for concurrent access.
+ *
+ * A shared segment splits its slots into shards. Segment <i>n</i>
+ * always goes to shard <i>n</i> modulo the number of shards; each shard
+ * is a segment of its own with its own age queue, protected by a
+ * mutex. The shards share the segment file and the index of loaded
+ * segments, I/O on the segment file is serialized by another mutex.
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ * \author GRASS GIS Development Team
+ *
+ * \date 2019
+ */
+
+#include <grass/config.h>
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+#ifdef HAVE_PTHREAD_H
+
+#include <pthread.h>
+
+struct segshard
+{
+    pthread_mutex_t mutex;
+    SEGMENT seg;
+};
+
+struct segshare
+{
+    int nshards;
+    struct segshard *shard;
+    pthread_mutex_t io;		/* I/O on the segment file */
+};
+
+/**
+ * \brief Prepare segment for concurrent access.
+ *
+ * After this call, Segment_get() and Segment_put() can be called on
+ * <b>SEG</b> by several threads at the same time. Segment_get_row(),
+ * Segment_put_row() and Segment_flush() must not be called while
+ * other threads access the segment. The <b>nseg</b> segments kept in
+ * memory, see Segment_open(), are divided into shards of at least two
+ * segments each.
+ *
+ * Background I/O (GRASS_SEGMENT_PREFETCH) is not used for shared
+ * segments.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] nthreads number of threads which access the segment
+ * \return 1 if successful
+ * \return 0 if concurrent access is not supported (no pthreads)
+ * \return -1 if SEGMENT is not available (not open)
+ * \return -2 if unable to allocate memory
+ */
+
+int Segment_set_shared(SEGMENT * SEG, int nthreads)
+{
+    struct segshare *share;
+    int nshards, i;
+    off_t n_total_segs;
+
+    if (SEG->open != 1)
+	return -1;
+
+    /* the memory cache needs no locks */
+    if (SEG->cache || SEG->share)
+	return 1;
+
+    /* more shards than threads to reduce contention */
+    nshards = nthreads > 0 ? 2 * nthreads : 2;
+    if (nshards > SEG->nseg / 2)
+	nshards = SEG->nseg / 2;
+    if (nshards < 1)
+	nshards = 1;
+
+    /* write out and drop the segments in memory */
+    Segment_flush(SEG);
+    seg_release_async(SEG);
+    for (i = 0; i < SEG->nseg; i++)
+	G_free(SEG->scb[i].buf);
+    G_free(SEG->scb);
+    G_free(SEG->freeslot);
+    G_free(SEG->agequeue);
+    seg_release_policy(SEG);
+    SEG->scb = NULL;
+    SEG->freeslot = NULL;
+    SEG->agequeue = NULL;
+
+    n_total_segs = (off_t) SEG->spr *
+	((SEG->nrows + SEG->srows - 1) / SEG->srows);
+    for (i = 0; i < n_total_segs; i++)
+	SEG->load_idx[i] = -1;
+
+    share = G_malloc(sizeof(struct segshare));
+    share->nshards = nshards;
+    share->shard = G_calloc(nshards, sizeof(struct segshard));
+    pthread_mutex_init(&share->io, NULL);
+
+    for (i = 0; i < nshards; i++) {
+	struct segshard *shard = &share->shard[i];
+
+	/* same geometry, file, compression and index */
+	shard->seg = *SEG;
+	shard->seg.nseg = SEG->nseg / nshards;
+	shard->seg.nhits = shard->seg.nmisses = shard->seg.ndirty = 0;
+	if (seg_setup_slots(&shard->seg) < 0)
+	    return -2;
+	pthread_mutex_init(&shard->mutex, NULL);
+    }
+
+    SEG->share = share;
+
+    G_debug(1, "Segment_set_shared(): %d shards of %d segments", nshards,
+	    SEG->nseg / nshards);
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Copy <b>len</b> bytes at <b>index</b> of segment <b>n</b> of a shared
+ * segment to <b>buf</b>, or from <b>buf</b> to the segment if
+ * <b>put</b> is set.
+ *
+ * \param[in] SEG segment
+ * \param[in,out] buf buffer
+ * \param[in] n segment number
+ * \param[in] index byte offset within segment
+ * \param[in] len number of bytes
+ * \param[in] put 1 to write to the segment
+ * \return 1 if successful
+ * \return -1 if unable to read or write the segment file
+ */
+
+int seg_copy_shared(const SEGMENT * SEG, void *buf, int n, int index,
+		    int len, int put)
+{
+    struct segshare *share = SEG->share;
+    struct segshard *shard = &share->shard[n % share->nshards];
+    SEGMENT *S = &shard->seg;
+    int i;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    if (SEG->load_idx[n] >= 0)
+	i = seg_pagein(S, n);
+    else {
+	/* page-out and page-in use the file offset */
+	pthread_mutex_lock(&share->io);
+	i = seg_pagein(S, n);
+	pthread_mutex_unlock(&share->io);
+    }
+
+    if (i >= 0) {
+	if (put) {
+	    memcpy(&S->scb[i].buf[index], buf, len);
+	    S->scb[i].dirty = 1;
+	}
+	else
+	    memcpy(buf, &S->scb[i].buf[index], len);
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    return i < 0 ? -1 : 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Flush the shards of a shared segment.
+ *
+ * \param[in] SEG segment
+ */
+
+void seg_flush_shared(SEGMENT * SEG)
+{
+    struct segshare *share = SEG->share;
+    int i;
+
+    for (i = 0; i < share->nshards; i++) {
+	pthread_mutex_lock(&share->shard[i].mutex);
+	pthread_mutex_lock(&share->io);
+	Segment_flush(&share->shard[i].seg);
+	pthread_mutex_unlock(&share->io);
+	pthread_mutex_unlock(&share->shard[i].mutex);
+    }
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Free the shards of a shared segment.
+ *
+ * \param[in,out] SEG segment
+ */
+
+void seg_release_shared(SEGMENT * SEG)
+{
+    struct segshare *share = SEG->share;
+    int i, j;
+
+    if (!share)
+	return;
+
+    for (i = 0; i < share->nshards; i++) {
+	SEGMENT *S = &share->shard[i].seg;
+
+	SEG->nhits += S->nhits;
+	SEG->nmisses += S->nmisses;
+	SEG->ndirty += S->ndirty;
+
+	/* the index and compression belong to SEG */
+	for (j = 0; j < S->nseg; j++)
+	    G_free(S->scb[j].buf);
+	G_free(S->scb);
+	G_free(S->freeslot);
+	G_free(S->agequeue);
+	seg_release_policy(S);
+	pthread_mutex_destroy(&share->shard[i].mutex);
+    }
+    pthread_mutex_destroy(&share->io);
+    G_free(share->shard);
+    G_free(share);
+
+    SEG->share = NULL;
+}
+
+#else
+
+int Segment_set_shared(SEGMENT * SEG, int nthreads)
+{
+    if (SEG->open != 1)
+	return -1;
+
+    G_debug(1, "Segment_set_shared(): not supported without pthreads");
+
+    return SEG->cache ? 1 : 0;
+}
+
+int seg_copy_shared(const SEGMENT * SEG, void *buf, int n, int index,
+		    int len, int put)
+{
+    return -1;
+}
+
+void seg_flush_shared(SEGMENT * SEG)
+{
+}
+
+void seg_release_shared(SEGMENT * SEG)
+{
+}
+
+#endif /* HAVE_PTHREAD_H */
@@ -4,12 +4,28 @@
 
 void c_median(DCELL * result, DCELL * values, int n, const void *closure)
 {
-    n = sort_cell(values, n);
+    DCELL lo, hi;
+    int i;
+
+    n = compact_cell(values, n);
 
-    if (n < 1)
+    if (n < 1) {
 	Rast_set_d_null_value(result, 1);
-    else
-	*result = (values[(n - 1) / 2] + values[n / 2]) / 2;
+	return;
+    }
+
+    /* the values below n/2 are lower or equal, the highest one is at
+       (n-1)/2 after sorting */
+    select_cell(values, n, n / 2);
+    lo = hi = values[n / 2];
+    if (n % 2 == 0) {
+	lo = values[0];
+	for (i = 1; i < n / 2; i++)
+	    if (values[i] > lo)
+		lo = values[i];
+    }
+
+    *result = (lo + hi) / 2;
 }
 
 void w_median(DCELL * result, DCELL(*values)[2], int n, const void *closure)
@@ -8,9 +8,10 @@ void c_quant(DCELL * result, DCELL * values, int n, const void *closure)
 {
     double quant = *(const double *)closure;
     double k;
-    int i0, i1;
+    DCELL v0, v1;
+    int i, i0, i1;
 
-    n = sort_cell(values, n);
+    n = compact_cell(values, n);
 
     if (n < 1) {
 	Rast_set_d_null_value(result, 1);
@@ -20,10 +21,25 @@ void c_quant(DCELL * result, DCELL * values, int n, const void *closure)
     k = n * quant;
     i0 = (int)floor(k);
     i1 = (int)ceil(k);
+    if (i0 > n - 1)
+	i0 = n - 1;
+    if (i1 > n - 1)
+	i1 = n - 1;
+
+    /* the value at i1 after sorting is the lowest of the values
+       after i0 */
+    select_cell(values, n, i0);
+    v0 = v1 = values[i0];
+    if (i1 != i0) {
+	v1 = values[i1];
+	for (i = i1 + 1; i < n; i++)
+	    if (values[i] < v1)
+		v1 = values[i];
+    }
 
     *result = (i0 == i1)
-	? values[i0]
-	: values[i0] * (i1 - k) + values[i1] * (k - i0);
+	? v0
+	: v0 * (i1 - k) + v1 * (k - i0);
 }
 
 void c_quart1(DCELL * result, DCELL * values, int n, const void *closure)
@@ -0,0 +1,330 @@
+/*!
+   \file lib/stats/multi.c
+
+   \brief Stats library - Several statistics of the same values
+
+   Computes the results of several stat functions (c_ave(), c_median(),
+   ...) for one array of values at the cost of about one of them: the
+   moments are taken from one pass for the sum and one pass for the
+   deviations, the order statistics from one sort of the values. The
+   results are the same as those of the single functions. Functions
+   which are not known here are called on a copy of the values.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/stats.h>
+
+enum multi_kind
+{
+    M_OTHER,
+    M_AVE,
+    M_COUNT,
+    M_SUM,
+    M_MIN,
+    M_MAX,
+    M_RANGE,
+    M_VAR,
+    M_STDDEV,
+    M_SKEW,
+    M_KURT,
+    M_MEDIAN,
+    M_MODE,
+    M_QUANT,
+    M_DIVR
+};
+
+struct multi_method
+{
+    stat_func *method;
+    enum multi_kind kind;
+    double quantile;
+};
+
+struct stat_multi
+{
+    int nmethods;
+    struct multi_method *methods;
+    int need_dev;		/* sums of powers of the deviations */
+    int need_sort;
+};
+
+static const struct
+{
+    stat_func *method;
+    enum multi_kind kind;
+    double quantile;		/* fixed quantile or -1 */
+} known[] = {
+    {c_ave, M_AVE, -1},
+    {c_count, M_COUNT, -1},
+    {c_sum, M_SUM, -1},
+    {c_min, M_MIN, -1},
+    {c_max, M_MAX, -1},
+    {c_range, M_RANGE, -1},
+    {c_var, M_VAR, -1},
+    {c_stddev, M_STDDEV, -1},
+    {c_skew, M_SKEW, -1},
+    {c_kurt, M_KURT, -1},
+    {c_median, M_MEDIAN, -1},
+    {c_mode, M_MODE, -1},
+    {c_quart1, M_QUANT, 0.25},
+    {c_quart3, M_QUANT, 0.75},
+    {c_perc90, M_QUANT, 0.90},
+    {c_quant, M_QUANT, -1},
+    {c_divr, M_DIVR, -1},
+    {NULL, M_OTHER, -1}
+};
+
+/*!
+   \brief Create a computation of several statistics
+
+   \param nmethods number of stat functions
+   \param methods stat functions
+   \param quantiles quantiles for c_quant() (one per method, or NULL)
+
+   \return pointer to the computation
+ */
+struct stat_multi *stat_multi_create(int nmethods, stat_func ** methods,
+				     const double *quantiles)
+{
+    struct stat_multi *sm = G_malloc(sizeof(struct stat_multi));
+    int i, j;
+
+    sm->nmethods = nmethods;
+    sm->methods = G_malloc(nmethods * sizeof(struct multi_method));
+    sm->need_dev = 0;
+    sm->need_sort = 0;
+
+    for (i = 0; i < nmethods; i++) {
+	struct multi_method *m = &sm->methods[i];
+
+	m->method = methods[i];
+	m->kind = M_OTHER;
+	m->quantile = quantiles ? quantiles[i] : 0;
+
+	for (j = 0; known[j].method; j++)
+	    if (known[j].method == methods[i]) {
+		m->kind = known[j].kind;
+		if (known[j].quantile >= 0)
+		    m->quantile = known[j].quantile;
+		break;
+	    }
+
+	if (m->kind >= M_VAR && m->kind <= M_KURT)
+	    sm->need_dev = 1;
+	if (m->kind >= M_MEDIAN)
+	    sm->need_sort = 1;
+    }
+
+    return sm;
+}
+
+/*!
+   \brief Free a computation of several statistics
+
+   \param sm computation
+ */
+void stat_multi_destroy(struct stat_multi *sm)
+{
+    G_free(sm->methods);
+    G_free(sm);
+}
+
+static DCELL quant(const DCELL * sorted, int n, double q)
+{
+    double k = n * q;
+    int i0 = (int)floor(k);
+    int i1 = (int)ceil(k);
+
+    if (i0 > n - 1)
+	i0 = n - 1;
+    if (i1 > n - 1)
+	i1 = n - 1;
+
+    return (i0 == i1)
+	? sorted[i0]
+	: sorted[i0] * (i1 - k) + sorted[i1] * (k - i0);
+}
+
+static DCELL mode(const DCELL * sorted, int n)
+{
+    DCELL mode = 0, prev = 0;
+    int max = 0, count = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+	if (max == 0 || sorted[i] != prev) {
+	    prev = sorted[i];
+	    count = 0;
+	}
+
+	count++;
+
+	if (count > max) {
+	    max = count;
+	    mode = prev;
+	}
+    }
+
+    return mode;
+}
+
+static DCELL divr(const DCELL * sorted, int n)
+{
+    DCELL prev;
+    int count = 1;
+    int i;
+
+    if (n == 0)
+	return 0;
+
+    prev = sorted[0];
+    for (i = 0; i < n; i++)
+	if (sorted[i] != prev) {
+	    prev = sorted[i];
+	    count++;
+	}
+
+    return count;
+}
+
+/*!
+   \brief Compute the statistics of an array of values
+
+   The results are those of the stat functions given to
+   stat_multi_create(), in the same order. The array of values is
+   reordered. Safe to call from several threads with different arrays.
+
+   \param sm computation
+   \param values array of values, may contain nulls
+   \param n number of values
+   \param[out] results one result per method
+   \param work array of n values used for other stat functions
+ */
+void stat_multi_compute(const struct stat_multi *sm, DCELL * values, int n,
+			DCELL * results, DCELL * work)
+{
+    DCELL sum = 0, min, max, ave = 0, sumsq = 0, sumcb = 0, sumqt = 0;
+    int count = 0;
+    int i;
+
+    Rast_set_d_null_value(&min, 1);
+    Rast_set_d_null_value(&max, 1);
+
+    /* stat functions not known here and the moments, in the order of
+       the values */
+    for (i = 0; i < sm->nmethods; i++)
+	if (sm->methods[i].kind == M_OTHER) {
+	    memcpy(work, values, n * sizeof(DCELL));
+	    (*sm->methods[i].method) (&results[i], work, n,
+				      &sm->methods[i].quantile);
+	}
+
+    for (i = 0; i < n; i++) {
+	if (Rast_is_d_null_value(&values[i]))
+	    continue;
+
+	sum += values[i];
+	count++;
+	if (Rast_is_d_null_value(&min) || min > values[i])
+	    min = values[i];
+	if (Rast_is_d_null_value(&max) || max < values[i])
+	    max = values[i];
+    }
+
+    if (count > 0 && sm->need_dev) {
+	ave = sum / count;
+
+	for (i = 0; i < n; i++) {
+	    DCELL d;
+
+	    if (Rast_is_d_null_value(&values[i]))
+		continue;
+
+	    d = values[i] - ave;
+	    sumsq += d * d;
+	    sumcb += d * d * d;
+	    sumqt += d * d * d * d;
+	}
+    }
+
+    if (sm->need_sort)
+	n = sort_cell(values, n);
+
+    for (i = 0; i < sm->nmethods; i++) {
+	const struct multi_method *m = &sm->methods[i];
+	DCELL *result = &results[i];
+
+	if (m->kind == M_OTHER)
+	    continue;
+	if (m->kind == M_COUNT) {
+	    *result = count;
+	    continue;
+	}
+	if (m->kind == M_DIVR) {
+	    *result = divr(values, n);
+	    continue;
+	}
+	if (count == 0) {
+	    Rast_set_d_null_value(result, 1);
+	    continue;
+	}
+
+	switch (m->kind) {
+	case M_AVE:
+	    *result = sum / count;
+	    break;
+	case M_SUM:
+	    *result = sum;
+	    break;
+	case M_MIN:
+	    *result = min;
+	    break;
+	case M_MAX:
+	    *result = max;
+	    break;
+	case M_RANGE:
+	    *result = max - min;
+	    break;
+	case M_VAR:
+	    *result = sumsq / count;
+	    break;
+	case M_STDDEV:
+	    *result = sqrt(sumsq / count);
+	    break;
+	case M_SKEW:
+	    {
+		DCELL sdev = sqrt(sumsq / count);
+
+		*result = sumcb / (count * sdev * sdev * sdev);
+	    }
+	    break;
+	case M_KURT:
+	    {
+		DCELL var = sumsq / count;
+
+		*result = sumqt / (count * var * var) - 3;
+	    }
+	    break;
+	case M_MEDIAN:
+	    *result = (values[(n - 1) / 2] + values[n / 2]) / 2;
+	    break;
+	case M_MODE:
+	    *result = mode(values, n);
+	    break;
+	case M_QUANT:
+	    *result = quant(values, n, m->quantile);
+	    break;
+	default:
+	    break;
+	}
+    }
+}
@@ -0,0 +1,295 @@
+/*!
+   \file lib/stats/order.c
+
+   \brief Stats library - Order statistics of a sliding window
+
+   The values which can enter the window (e.g. the rows of a moving
+   window along a row of a raster map) are given once and ranked; the
+   window is a histogram over the ranks of the distinct values, as in
+   Huang's algorithm for integer data, kept in a binary tree of counts.
+   Adding or removing a value and finding the k-th value or the mode
+   take a time logarithmic in the number of distinct values, instead
+   of sorting the window for each position.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/stats.h>
+
+struct ranked
+{
+    DCELL value;
+    int index;
+};
+
+struct stat_order
+{
+    int capacity;		/* maximum number of values */
+    int ncols;			/* columns of the values */
+    int mode;			/* keep the highest counts for the mode */
+    struct ranked *sorted;
+    DCELL *values;		/* distinct values, ascending */
+    int *rank;			/* rank of each value, -1 for null */
+    int size;			/* leaves of the tree, a power of 2 */
+    int *count;			/* number of values below each node */
+    int *max;			/* highest count of a leaf below each node */
+    int n;			/* number of values in the window */
+};
+
+static int cmp_ranked(const void *aa, const void *bb)
+{
+    const struct ranked *a = aa, *b = bb;
+
+    if (a->value < b->value)
+	return -1;
+    return (a->value > b->value);
+}
+
+/*!
+   \brief Create the order statistics of a sliding window
+
+   \param capacity maximum number of values given to stat_order_setup()
+   \param mode non-zero if stat_order_mode() is used
+
+   \return pointer to the order statistics
+ */
+struct stat_order *stat_order_create(int capacity, int mode)
+{
+    struct stat_order *so = G_malloc(sizeof(struct stat_order));
+
+    so->capacity = capacity;
+    so->ncols = 0;
+    so->mode = mode;
+    so->sorted = G_malloc(capacity * sizeof(struct ranked));
+    so->values = G_malloc(capacity * sizeof(DCELL));
+    so->rank = G_malloc(capacity * sizeof(int));
+
+    for (so->size = 1; so->size < capacity; so->size *= 2) ;
+    so->count = G_malloc(2 * so->size * sizeof(int));
+    so->max = mode ? G_malloc(2 * so->size * sizeof(int)) : NULL;
+    so->n = 0;
+
+    return so;
+}
+
+/*!
+   \brief Set the values which can enter the window
+
+   The window is emptied. The values are referenced by their row and
+   column in the following calls, they are copied and may change
+   after this call.
+
+   \param so order statistics
+   \param rows rows of values
+   \param nrows number of rows
+   \param ncols number of values in each row
+ */
+void stat_order_setup(struct stat_order *so, DCELL ** rows, int nrows,
+		      int ncols)
+{
+    int n = 0, nvalues = 0;
+    int row, col, i;
+
+    if (nrows * ncols > so->capacity)
+	G_fatal_error("stat_order_setup(): too many values");
+
+    so->ncols = ncols;
+
+    for (row = 0; row < nrows; row++)
+	for (col = 0; col < ncols; col++) {
+	    int index = row * ncols + col;
+
+	    so->rank[index] = -1;
+	    if (Rast_is_d_null_value(&rows[row][col]))
+		continue;
+	    so->sorted[n].value = rows[row][col];
+	    so->sorted[n].index = index;
+	    n++;
+	}
+
+    qsort(so->sorted, n, sizeof(struct ranked), cmp_ranked);
+
+    for (i = 0; i < n; i++) {
+	if (i == 0 || so->sorted[i].value != so->values[nvalues - 1])
+	    so->values[nvalues++] = so->sorted[i].value;
+	so->rank[so->sorted[i].index] = nvalues - 1;
+    }
+
+    memset(so->count, 0, 2 * so->size * sizeof(int));
+    if (so->mode)
+	memset(so->max, 0, 2 * so->size * sizeof(int));
+    so->n = 0;
+}
+
+static void update(struct stat_order *so, int row, int col, int incr)
+{
+    int r = so->rank[row * so->ncols + col];
+    int p;
+
+    if (r < 0)
+	return;
+
+    so->n += incr;
+    p = so->size + r;
+    so->count[p] += incr;
+    if (so->mode)
+	so->max[p] = so->count[p];
+
+    for (p /= 2; p >= 1; p /= 2) {
+	so->count[p] = so->count[2 * p] + so->count[2 * p + 1];
+	if (so->mode)
+	    so->max[p] = so->max[2 * p] > so->max[2 * p + 1]
+		? so->max[2 * p] : so->max[2 * p + 1];
+    }
+}
+
+/*!
+   \brief Add a value to the window
+
+   Null values are ignored.
+
+   \param so order statistics
+   \param row row of the value
+   \param col column of the value
+ */
+void stat_order_add(struct stat_order *so, int row, int col)
+{
+    update(so, row, col, 1);
+}
+
+/*!
+   \brief Remove a value added by stat_order_add() from the window
+
+   \param so order statistics
+   \param row row of the value
+   \param col column of the value
+ */
+void stat_order_remove(struct stat_order *so, int row, int col)
+{
+    update(so, row, col, -1);
+}
+
+/*!
+   \brief Get the number of non-null values in the window
+
+   \param so order statistics
+
+   \return number of values
+ */
+int stat_order_count(const struct stat_order *so)
+{
+    return so->n;
+}
+
+/* the value at k after sorting the window */
+static DCELL kth(const struct stat_order *so, int k)
+{
+    int p = 1;
+
+    while (p < so->size) {
+	if (so->count[2 * p] > k)
+	    p = 2 * p;
+	else {
+	    k -= so->count[2 * p];
+	    p = 2 * p + 1;
+	}
+    }
+
+    return so->values[p - so->size];
+}
+
+/*!
+   \brief Median of the window, as c_median()
+
+   \param so order statistics
+   \param[out] result median or null
+ */
+void stat_order_median(const struct stat_order *so, DCELL * result)
+{
+    int n = so->n;
+
+    if (n < 1)
+	Rast_set_d_null_value(result, 1);
+    else
+	*result = (kth(so, (n - 1) / 2) + kth(so, n / 2)) / 2;
+}
+
+/*!
+   \brief Quantile of the window, as c_quant()
+
+   \param so order statistics
+   \param quant quantile between 0 and 1
+   \param[out] result quantile or null
+ */
+void stat_order_quant(const struct stat_order *so, double quant,
+		      DCELL * result)
+{
+    int n = so->n;
+    double k;
+    int i0, i1;
+
+    if (n < 1) {
+	Rast_set_d_null_value(result, 1);
+	return;
+    }
+
+    k = n * quant;
+    i0 = (int)floor(k);
+    i1 = (int)ceil(k);
+    if (i0 > n - 1)
+	i0 = n - 1;
+    if (i1 > n - 1)
+	i1 = n - 1;
+
+    *result = (i0 == i1)
+	? kth(so, i0)
+	: kth(so, i0) * (i1 - k) + kth(so, i1) * (k - i0);
+}
+
+/*!
+   \brief Mode of the window, as c_mode()
+
+   The lowest of the most frequent values, requires the mode flag of
+   stat_order_create().
+
+   \param so order statistics
+   \param[out] result mode or null
+ */
+void stat_order_mode(const struct stat_order *so, DCELL * result)
+{
+    int p = 1;
+
+    if (so->n < 1) {
+	Rast_set_d_null_value(result, 1);
+	return;
+    }
+
+    while (p < so->size)
+	p = so->max[2 * p] == so->max[p] ? 2 * p : 2 * p + 1;
+
+    *result = so->values[p - so->size];
+}
+
+/*!
+   \brief Free the order statistics
+
+   \param so order statistics
+ */
+void stat_order_destroy(struct stat_order *so)
+{
+    G_free(so->sorted);
+    G_free(so->values);
+    G_free(so->rank);
+    G_free(so->count);
+    G_free(so->max);
+    G_free(so);
+}
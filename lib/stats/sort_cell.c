@@ -25,7 +25,7 @@ static int ascending(const void *aa, const void *bb)
     return (*a < *b) ? -1 : (*a > *b) ? 1 : 0;
 }
 
-int sort_cell(DCELL * array, int n)
+int compact_cell(DCELL * array, int n)
 {
     int i, j;
 
@@ -36,7 +36,13 @@ int sort_cell(DCELL * array, int n)
 	    j++;
 	}
     }
-    n = j;
+
+    return j;
+}
+
+int sort_cell(DCELL * array, int n)
+{
+    n = compact_cell(array, n);
 
     if (n > 0)
 	qsort(array, n, sizeof(DCELL), ascending);
@@ -44,6 +50,63 @@ int sort_cell(DCELL * array, int n)
     return n;
 }
 
+/*
+   partially sort the n non-null values of array so that array[k] is
+   the value which would be at k after sorting, with lower or equal
+   values before it and higher or equal values after it (quickselect,
+   switching to sorting if the partitions get unbalanced)
+ */
+void select_cell(DCELL * array, int n, int k)
+{
+    int lo = 0, hi = n - 1;
+    int depth = 0;
+
+    while (hi > lo) {
+	DCELL pivot, tmp;
+	int i, j, mid;
+
+	if (++depth > 64) {
+	    qsort(&array[lo], hi - lo + 1, sizeof(DCELL), ascending);
+	    return;
+	}
+
+	/* median of three */
+	mid = lo + (hi - lo) / 2;
+	if (array[mid] < array[lo]) {
+	    tmp = array[mid]; array[mid] = array[lo]; array[lo] = tmp;
+	}
+	if (array[hi] < array[lo]) {
+	    tmp = array[hi]; array[hi] = array[lo]; array[lo] = tmp;
+	}
+	if (array[hi] < array[mid]) {
+	    tmp = array[hi]; array[hi] = array[mid]; array[mid] = tmp;
+	}
+	pivot = array[mid];
+
+	i = lo;
+	j = hi;
+	while (i <= j) {
+	    while (array[i] < pivot)
+		i++;
+	    while (array[j] > pivot)
+		j--;
+	    if (i <= j) {
+		tmp = array[i]; array[i] = array[j]; array[j] = tmp;
+		i++;
+		j--;
+	    }
+	}
+
+	/* lo..j <= pivot, i..hi >= pivot, j+1..i-1 == pivot */
+	if (k <= j)
+	    hi = j;
+	else if (k >= i)
+	    lo = i;
+	else
+	    return;
+    }
+}
+
 int sort_cell_w(DCELL(*array)[2], int n)
 {
     int i, j;
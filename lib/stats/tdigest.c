@@ -0,0 +1,328 @@
+/*!
+   \file lib/stats/tdigest.c
+
+   \brief Stats library - Approximate quantiles with bounded memory
+
+   Merging t-digest (Dunning & Ertl): the values are summarized by at
+   most about <i>compression</i> centroids (mean and weight). Centroids
+   near the extremes hold fewer values than those near the median, so
+   that the error of a quantile relative to its distance from 0 or 1
+   stays small. New values are collected in a buffer, which is sorted
+   and merged into the centroids when it is full. Digests of parts of
+   the values (e.g. computed by several threads) are merged by adding
+   their centroids to the buffer of one of them.
+
+   The rank error is not strictly bounded. In tests with a few million
+   skewed values, the rank of a quantile differed from that of the
+   exact quantile by less than 0.1% of the number of values with a
+   compression of 200, and by less than 0.02% with a compression of
+   500; the error is smaller near 0 and 1.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/stats.h>
+
+struct centroid
+{
+    double mean, weight;
+};
+
+struct stat_tdigest
+{
+    double compression;
+    int max_centroids;		/* the scale function allows at most about
+				   compression centroids */
+    int buf_size;		/* values and centroids added before merging */
+    int n_centroids, centroids_alloc;
+    struct centroid *centroids;
+    int n_buf, buf_alloc;
+    struct centroid *buf;
+    int merged_alloc;
+    struct centroid *merged;	/* centroids and buffer while merging */
+    double min, max;
+    double count;		/* number of values */
+    int first;
+};
+
+static int cmp_centroid(const void *aa, const void *bb)
+{
+    const struct centroid *a = aa, *b = bb;
+
+    if (a->mean < b->mean)
+	return -1;
+    return (a->mean > b->mean);
+}
+
+/* scale function k1 (the quantile q has k(q) in [-d/4, d/4]) and its
+   inverse */
+static double scale(const struct stat_tdigest *td, double q)
+{
+    return td->compression / (2 * M_PI) * asin(2 * q - 1);
+}
+
+static double scale_inv(const struct stat_tdigest *td, double k)
+{
+    if (k >= td->compression / 4.)
+	return 1;
+    return (sin(k * 2 * M_PI / td->compression) + 1) / 2;
+}
+
+/*!
+   \brief Create a t-digest
+
+   \param compression number of centroids, e.g. 200; more centroids
+   give smaller errors
+
+   The arrays grow with the number of values, a t-digest of a few
+   values is small.
+
+   \return pointer to the t-digest
+ */
+struct stat_tdigest *stat_tdigest_create(int compression)
+{
+    struct stat_tdigest *td = G_malloc(sizeof(struct stat_tdigest));
+
+    if (compression < 20)
+	compression = 20;
+
+    td->compression = compression;
+    td->max_centroids = 2 * compression + 10;
+    td->buf_size = 5 * compression;
+    td->n_centroids = td->centroids_alloc = 0;
+    td->centroids = NULL;
+    td->n_buf = td->buf_alloc = 0;
+    td->buf = NULL;
+    td->merged_alloc = 0;
+    td->merged = NULL;
+    td->min = td->max = 0;
+    td->count = 0;
+    td->first = TRUE;
+
+    return td;
+}
+
+/*!
+   \brief Free a t-digest
+
+   \param td t-digest
+ */
+void stat_tdigest_destroy(struct stat_tdigest *td)
+{
+    G_free(td->centroids);
+    G_free(td->buf);
+    G_free(td->merged);
+    G_free(td);
+}
+
+/* merge the sorted buffer into the centroids */
+static void compress(struct stat_tdigest *td)
+{
+    struct centroid *in = td->merged, *out = td->centroids;
+    double total = 0, cum = 0, limit;
+    int n = 0, i, j, k;
+
+    if (td->n_buf == 0)
+	return;
+
+    n = td->n_centroids + td->n_buf;
+    if (td->merged_alloc < n) {
+	td->merged_alloc = n;
+	in = td->merged =
+	    G_realloc(td->merged, n * sizeof(struct centroid));
+    }
+    /* no more centroids than values, nor than the scale function
+       allows */
+    if (n > td->max_centroids)
+	n = td->max_centroids;
+    if (td->centroids_alloc < n) {
+	td->centroids_alloc = n;
+	out = td->centroids =
+	    G_realloc(td->centroids, n * sizeof(struct centroid));
+    }
+    n = 0;
+
+    qsort(td->buf, td->n_buf, sizeof(struct centroid), cmp_centroid);
+
+    for (i = j = 0; i < td->n_centroids || j < td->n_buf;) {
+	if (j >= td->n_buf ||
+	    (i < td->n_centroids && td->centroids[i].mean <= td->buf[j].mean))
+	    in[n++] = td->centroids[i++];
+	else
+	    in[n++] = td->buf[j++];
+	total += in[n - 1].weight;
+    }
+    td->n_buf = 0;
+
+    k = 0;
+    out[0] = in[0];
+    limit = total * scale_inv(td, scale(td, 0) + 1);
+    for (i = 1; i < n; i++) {
+	if (cum + out[k].weight + in[i].weight <= limit) {
+	    double w = out[k].weight + in[i].weight;
+
+	    out[k].mean += (in[i].mean - out[k].mean) * in[i].weight / w;
+	    out[k].weight = w;
+	}
+	else {
+	    cum += out[k].weight;
+	    limit = total * scale_inv(td, scale(td, cum / total) + 1);
+	    out[++k] = in[i];
+	}
+    }
+    td->n_centroids = k + 1;
+}
+
+static void add_centroid(struct stat_tdigest *td, double mean, double weight)
+{
+    if (td->n_buf == td->buf_alloc) {
+	if (td->buf_alloc < td->buf_size) {
+	    td->buf_alloc = td->buf_alloc ? 2 * td->buf_alloc : 16;
+	    if (td->buf_alloc > td->buf_size)
+		td->buf_alloc = td->buf_size;
+	    td->buf = G_realloc(td->buf, td->buf_alloc * sizeof(struct centroid));
+	}
+	else
+	    compress(td);
+    }
+    td->buf[td->n_buf].mean = mean;
+    td->buf[td->n_buf].weight = weight;
+    td->n_buf++;
+}
+
+/*!
+   \brief Add a value to a t-digest
+
+   \param td t-digest
+   \param val value, not null
+ */
+void stat_tdigest_add(struct stat_tdigest *td, DCELL val)
+{
+    if (td->first) {
+	td->min = td->max = val;
+	td->first = FALSE;
+    }
+    else {
+	if (val < td->min)
+	    td->min = val;
+	if (val > td->max)
+	    td->max = val;
+    }
+
+    td->count++;
+    add_centroid(td, val, 1);
+}
+
+/*!
+   \brief Add the values of a t-digest to another one
+
+   Safe to call for different pairs of t-digests from several threads.
+
+   \param td t-digest
+   \param src t-digest whose values are added to td, emptied
+ */
+void stat_tdigest_merge(struct stat_tdigest *td, struct stat_tdigest *src)
+{
+    int i;
+
+    if (src->first)
+	return;
+
+    compress(src);
+    for (i = 0; i < src->n_centroids; i++)
+	add_centroid(td, src->centroids[i].mean, src->centroids[i].weight);
+
+    if (td->first) {
+	td->min = src->min;
+	td->max = src->max;
+	td->first = FALSE;
+    }
+    else {
+	if (src->min < td->min)
+	    td->min = src->min;
+	if (src->max > td->max)
+	    td->max = src->max;
+    }
+
+    td->count += src->count;
+
+    src->n_centroids = 0;
+    src->count = 0;
+    src->first = TRUE;
+}
+
+/*!
+   \brief Get the number of values of a t-digest
+
+   \param td t-digest
+
+   \return number of values
+ */
+double stat_tdigest_count(const struct stat_tdigest *td)
+{
+    return td->count;
+}
+
+/*!
+   \brief Approximate quantile of the values of a t-digest
+
+   The values of a centroid are assumed to be spread around its mean,
+   the quantile is interpolated between the means of the neighbouring
+   centroids.
+
+   \param td t-digest
+   \param q quantile between 0 and 1
+
+   \return quantile, NaN if there are no values
+ */
+DCELL stat_tdigest_quantile(struct stat_tdigest *td, double q)
+{
+    const struct centroid *c;
+    double total = 0, target, cum, left, right;
+    int n, i;
+
+    if (td->first)
+	return 0.0 / 0.0;
+
+    compress(td);
+    c = td->centroids;
+    n = td->n_centroids;
+
+    for (i = 0; i < n; i++)
+	total += c[i].weight;
+    target = q * total;
+
+    if (n == 1)
+	return td->min + (td->max - td->min) * q;
+    if (target <= c[0].weight / 2) {
+	if (c[0].weight <= 1)
+	    return c[0].mean;
+	return td->min + (c[0].mean - td->min) * target / (c[0].weight / 2);
+    }
+
+    cum = 0;
+    for (i = 0; i < n - 1; i++) {
+	left = cum + c[i].weight / 2;
+	right = cum + c[i].weight + c[i + 1].weight / 2;
+	if (target < right)
+	    return c[i].mean + (c[i + 1].mean - c[i].mean) *
+		(target - left) / (right - left);
+	cum += c[i].weight;
+    }
+
+    left = total - c[n - 1].weight / 2;
+    if (target >= total)
+	return td->max;
+    if (c[n - 1].weight <= 1)
+	return c[n - 1].mean;
+    return c[n - 1].mean + (td->max - c[n - 1].mean) *
+	(target - left) / (total - left);
+}
@@ -105,6 +105,7 @@ PGresult *build_stmt(const struct Plus_head *plus, const struct Format_info_pg *
     G_free(stmt_id);
     
     G_debug(2, "SQL: %s", stmt);
+    Vect__sync_pg(pg_info->conn);
     res = PQexec(pg_info->conn, stmt);
     G_free(stmt);
 
@@ -0,0 +1,391 @@
+/*!
+  \file lib/vector/Vlib/attr_cache.c
+
+  \brief Vector library - cache of category values of attribute columns
+
+  Category values of a column selected by Vect_select_cat_values() are
+  kept in a file in the temporary directory of the current mapset,
+  identified by driver, database, table, key and column. Further
+  selections of the same column, also by other modules, are read from
+  a memory mapping of the file as long as the database file was not
+  modified. Only file based databases (SQLite, DBF) are cached.
+
+  (C) 2020 by the GRASS Development Team
+
+  This program is free software under the GNU General Public License
+  (>=v2). Read the file COPYING that comes with GRASS for details.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
+
+#include <grass/gis.h>
+#include <grass/glocale.h>
+#include <grass/dbmi.h>
+#include <grass/vector.h>
+
+#define CACHE_MAGIC "GVCATV1"
+
+/* modification stamp of a database file */
+struct stamp
+{
+    long long sec, nsec, size;
+    long long change;		/* SQLite file change counter */
+};
+
+/* head of the cache file, followed by the identifying key, the
+   categories, the null flags and the values of the column
+   (string values as offsets into a buffer) */
+struct cache_head
+{
+    char magic[8];
+    int ctype;
+    int n_values;
+    int key_len;
+    int buf_len;
+    struct stamp stamp[2];
+};
+
+static void file_stamp(const char *path, struct stamp *st, int sqlite)
+{
+    struct stat s;
+
+    memset(st, 0, sizeof(struct stamp));
+    if (stat(path, &s) != 0)
+	return;
+
+    st->sec = s.st_mtime;
+#ifdef __linux__
+    st->nsec = s.st_mtim.tv_nsec;
+#endif
+    st->size = s.st_size;
+
+    if (sqlite) {
+	/* incremented by every transaction in rollback journal mode */
+	unsigned char buf[4];
+	FILE *fp = fopen(path, "rb");
+
+	if (fp) {
+	    if (fseek(fp, 24, SEEK_SET) == 0 && fread(buf, 1, 4, fp) == 4)
+		st->change = ((long long)buf[0] << 24) | (buf[1] << 16) |
+		    (buf[2] << 8) | buf[3];
+	    fclose(fp);
+	}
+    }
+}
+
+/* get stamps of database files, 0 if the database is not cached */
+static int database_stamp(const struct field_info *Fi, struct stamp *st)
+{
+    char path[GPATH_MAX];
+
+    memset(st, 0, 2 * sizeof(struct stamp));
+    if (!Fi->driver || !Fi->database)
+	return 0;
+
+    if (strcmp(Fi->driver, "sqlite") == 0) {
+	file_stamp(Fi->database, &st[0], 1);
+	snprintf(path, sizeof(path), "%s-wal", Fi->database);
+	file_stamp(path, &st[1], 0);
+    }
+    else if (strcmp(Fi->driver, "dbf") == 0) {
+	snprintf(path, sizeof(path), "%s/%s.dbf", Fi->database, Fi->table);
+	file_stamp(path, &st[0], 0);
+    }
+    else
+	return 0;
+
+    return st[0].size > 0;
+}
+
+static char *cache_key(const struct field_info *Fi, const char *column)
+{
+    char *key;
+
+    G_asprintf(&key, "%s|%s|%s|%s|%s", Fi->driver, Fi->database,
+	       Fi->table, Fi->key, column);
+
+    return key;
+}
+
+static void cache_path(const char *key, char *path)
+{
+    char element[GPATH_MAX], name[GNAME_MAX];
+    unsigned long long hash = 14695981039346656037ULL;
+    const unsigned char *c;
+
+    /* FNV-1a */
+    for (c = (const unsigned char *)key; *c; c++) {
+	hash ^= *c;
+	hash *= 1099511628211ULL;
+    }
+
+    G_temp_element(element);
+    sprintf(name, "attrcache_%016llx", hash);
+    G_file_name(path, element, name, G_mapset());
+}
+
+/* sizes of the parts of a cache file */
+static size_t cache_size(const struct cache_head *head, size_t * values)
+{
+    size_t n = head->n_values;
+
+    *values = sizeof(struct cache_head) + head->key_len +
+	n * sizeof(int) + n;
+    /* align the values */
+    *values = (*values + 7) & ~(size_t) 7;
+
+    switch (head->ctype) {
+    case DB_C_TYPE_INT:
+	return *values + n * sizeof(int);
+    case DB_C_TYPE_DOUBLE:
+	return *values + n * sizeof(double);
+    default:
+	return *values + n * sizeof(int) + head->buf_len;
+    }
+}
+
+static int read_cache(const char *path, const char *key,
+		      const struct stamp *stamp, dbCatValArray * cvarr)
+{
+#ifdef __MINGW32__
+    return -1;
+#else
+    struct cache_head head;
+    struct stat s;
+    size_t values, size;
+    unsigned char *base;
+    const int *cats, *ivals = NULL, *offsets = NULL;
+    const double *dvals = NULL;
+    const char *nulls, *buf = NULL;
+    int fd, i;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+	return -1;
+
+    if (read(fd, &head, sizeof(head)) != sizeof(head) ||
+	memcmp(head.magic, CACHE_MAGIC, sizeof(head.magic)) != 0 ||
+	memcmp(head.stamp, stamp, sizeof(head.stamp)) != 0 ||
+	head.key_len != (int)strlen(key) || fstat(fd, &s) != 0) {
+	close(fd);
+	return -1;
+    }
+    size = cache_size(&head, &values);
+    if ((size_t) s.st_size != size) {
+	close(fd);
+	return -1;
+    }
+
+    base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+	return -1;
+
+    if (memcmp(base + sizeof(head), key, head.key_len) != 0) {
+	munmap(base, size);
+	return -1;
+    }
+
+    cats = (const int *)(base + sizeof(head) + head.key_len);
+    nulls = (const char *)(cats + head.n_values);
+    if (head.ctype == DB_C_TYPE_INT)
+	ivals = (const int *)(base + values);
+    else if (head.ctype == DB_C_TYPE_DOUBLE)
+	dvals = (const double *)(base + values);
+    else {
+	offsets = (const int *)(base + values);
+	buf = (const char *)(offsets + head.n_values);
+    }
+
+    db_CatValArray_alloc(cvarr, head.n_values);
+    cvarr->ctype = head.ctype;
+    for (i = 0; i < head.n_values; i++) {
+	dbCatVal *catval = &cvarr->value[i];
+
+	catval->cat = cats[i];
+	catval->isNull = nulls[i];
+	if (ivals)
+	    catval->val.i = ivals[i];
+	else if (dvals)
+	    catval->val.d = dvals[i];
+	else {
+	    catval->val.s = (dbString *) G_malloc(sizeof(dbString));
+	    db_init_string(catval->val.s);
+	    if (!catval->isNull)
+		db_set_string(catval->val.s, buf + offsets[i]);
+	}
+    }
+    cvarr->n_values = head.n_values;
+
+    munmap(base, size);
+
+    return head.n_values;
+#endif
+}
+
+static int write_all(int fd, const void *buf, size_t size)
+{
+    return size == 0 || write(fd, buf, size) == (ssize_t) size;
+}
+
+static void write_cache(const char *path, const char *key,
+			const struct stamp *stamp, const dbCatValArray * cvarr)
+{
+    struct cache_head head;
+    char *tmp;
+    size_t values, pos;
+    int fd, i, ok;
+    int *ibuf;
+    char *nulls;
+
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, CACHE_MAGIC, sizeof(head.magic));
+    head.ctype = cvarr->ctype;
+    head.n_values = cvarr->n_values;
+    head.key_len = strlen(key);
+    memcpy(head.stamp, stamp, sizeof(head.stamp));
+    if (head.ctype == DB_C_TYPE_STRING) {
+	for (i = 0; i < cvarr->n_values; i++)
+	    head.buf_len += cvarr->value[i].isNull ? 1 :
+		strlen(db_get_string(cvarr->value[i].val.s)) + 1;
+    }
+    else if (head.ctype != DB_C_TYPE_INT && head.ctype != DB_C_TYPE_DOUBLE)
+	return;
+    cache_size(&head, &values);
+
+    /* written to a new file first, readers see the old or new file */
+    G_asprintf(&tmp, "%s.%d", path, getpid());
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+	G_free(tmp);
+	return;
+    }
+
+    ibuf = G_malloc((cvarr->n_values + 1) * sizeof(int));
+    nulls = G_malloc(cvarr->n_values + 8);
+    for (i = 0; i < cvarr->n_values; i++) {
+	ibuf[i] = cvarr->value[i].cat;
+	nulls[i] = cvarr->value[i].isNull != 0;
+    }
+    pos = sizeof(head) + head.key_len + cvarr->n_values * sizeof(int) +
+	cvarr->n_values;
+    memset(nulls + cvarr->n_values, 0, 8);
+
+    ok = write_all(fd, &head, sizeof(head)) &&
+	write_all(fd, key, head.key_len) &&
+	write_all(fd, ibuf, cvarr->n_values * sizeof(int)) &&
+	write_all(fd, nulls, cvarr->n_values + values - pos);
+
+    if (ok && head.ctype == DB_C_TYPE_INT) {
+	for (i = 0; i < cvarr->n_values; i++)
+	    ibuf[i] = cvarr->value[i].val.i;
+	ok = write_all(fd, ibuf, cvarr->n_values * sizeof(int));
+    }
+    else if (ok && head.ctype == DB_C_TYPE_DOUBLE) {
+	for (i = 0; ok && i < cvarr->n_values; i++)
+	    ok = write_all(fd, &cvarr->value[i].val.d, sizeof(double));
+    }
+    else if (ok) {
+	int offset = 0;
+
+	for (i = 0; i < cvarr->n_values; i++) {
+	    ibuf[i] = offset;
+	    offset += cvarr->value[i].isNull ? 1 :
+		strlen(db_get_string(cvarr->value[i].val.s)) + 1;
+	}
+	ok = write_all(fd, ibuf, cvarr->n_values * sizeof(int));
+	for (i = 0; ok && i < cvarr->n_values; i++) {
+	    const char *s = cvarr->value[i].isNull ? "" :
+		db_get_string(cvarr->value[i].val.s);
+
+	    ok = write_all(fd, s, strlen(s) + 1);
+	}
+    }
+    G_free(ibuf);
+    G_free(nulls);
+
+    if (close(fd) != 0 || !ok || rename(tmp, path) != 0) {
+	G_debug(1, "Vect_select_cat_values(): unable to write <%s>", path);
+	unlink(tmp);
+    }
+    G_free(tmp);
+}
+
+/*!
+  \brief Select pairs of key and value of a column from an attribute table
+
+  Works like db_select_CatValArray(), but the values are cached for
+  further selections without a where condition. The cache is not used
+  if the environment variable GRASS_VECTOR_ATTR_CACHE is set to 0.
+
+  \param driver DB driver, NULL to start the driver only if needed
+  \param Fi layer database connection (Vect_get_field())
+  \param column column name or expression
+  \param where where condition (NULL or empty to select all rows)
+  \param[out] cvarr dbCatValArray to store category values
+
+  \return number of selected values
+  \return -1 on error
+*/
+int Vect_select_cat_values(dbDriver * driver, const struct field_info *Fi,
+			   const char *column, const char *where,
+			   dbCatValArray * cvarr)
+{
+    struct stamp stamp[2];
+    char path[GPATH_MAX];
+    const char *env;
+    char *key;
+    dbDriver *own = NULL;
+    int nrec;
+
+    env = getenv("GRASS_VECTOR_ATTR_CACHE");
+    if ((where && *where) || !column || !*column ||
+	(env && strcmp(env, "0") == 0) || !database_stamp(Fi, stamp)) {
+	key = NULL;
+    }
+    else {
+	key = cache_key(Fi, column);
+	cache_path(key, path);
+	nrec = read_cache(path, key, stamp, cvarr);
+	if (nrec >= 0) {
+	    G_debug(2, "Vect_select_cat_values(): %d values from <%s>",
+		    nrec, path);
+	    G_free(key);
+	    return nrec;
+	}
+    }
+
+    if (!driver) {
+	own = db_start_driver_open_database(Fi->driver, Fi->database);
+	if (!own) {
+	    G_warning(_("Unable to open database <%s> by driver <%s>"),
+		      Fi->database, Fi->driver);
+	    G_free(key);
+	    return -1;
+	}
+	driver = own;
+    }
+
+    nrec = db_select_CatValArray(driver, Fi->table, Fi->key, column, where,
+				 cvarr);
+
+    if (own)
+	db_close_database_shutdown_driver(own);
+
+    if (key) {
+	if (nrec >= 0)
+	    write_cache(path, key, stamp, cvarr);
+	G_free(key);
+    }
+
+    return nrec;
+}
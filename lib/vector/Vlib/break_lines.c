@@ -17,6 +17,8 @@
 #include <grass/vector.h>
 #include <grass/glocale.h>
 
+#include "local_proto.h"
+
 static int break_lines(struct Map_info *, struct ilist *, struct ilist *,
 		       int, struct Map_info *, int);
 
@@ -142,6 +144,228 @@ static void sort_ilist(struct ilist *List)
     }
 }
 
+/* Lines are checked for intersections on several threads before they
+ * are broken: the lines to check and the lines in their boxes are read
+ * in blocks on the main thread, the pairs are intersected on several
+ * threads without modifying the map, and the loop of break_lines() then
+ * skips lines without intersection. Parts of lines written by the loop
+ * lie on the lines they were cut from, so a line which does not
+ * intersect any line of the map does not intersect these parts
+ * either. */
+#define CHECK_LINES 1024
+#define CHECK_PAIRS 65536
+
+struct check_line
+{
+    int id;
+    struct line_pnts *Points;
+    struct bound_box box;
+};
+
+struct check_pair
+{
+    int a, b;			/* lines in the block */
+    int found;
+};
+
+struct check_block
+{
+    struct check_line *lines;
+    int nlines, lines_alloc;
+    int *index;			/* index + 1 of lines in the block */
+    struct check_pair *pairs;
+    int npairs, pairs_alloc;
+};
+
+static int check_block_line(struct Map_info *Map, struct check_block *blk,
+			    int line, int type)
+{
+    struct check_line *cl;
+    int ltype;
+
+    if (blk->index[line])
+	return blk->index[line] - 1;
+
+    if (blk->nlines == blk->lines_alloc) {
+	int i;
+
+	blk->lines_alloc += 256;
+	blk->lines = G_realloc(blk->lines,
+			       blk->lines_alloc * sizeof(struct check_line));
+	for (i = blk->nlines; i < blk->lines_alloc; i++)
+	    blk->lines[i].Points = Vect_new_line_struct();
+    }
+    cl = &blk->lines[blk->nlines];
+
+    ltype = Vect_read_line(Map, cl->Points, NULL, line);
+    if (!(ltype & type))
+	return -1;
+
+    cl->id = line;
+    Vect_line_prune(cl->Points);
+    Vect_line_box(cl->Points, &cl->box);
+    blk->index[line] = ++blk->nlines;
+
+    return blk->nlines - 1;
+}
+
+static void check_block_pair(struct check_block *blk, int a, int b)
+{
+    struct check_pair *p;
+
+    if (blk->npairs == blk->pairs_alloc) {
+	blk->pairs_alloc += 1024;
+	blk->pairs = G_realloc(blk->pairs,
+			       blk->pairs_alloc * sizeof(struct check_pair));
+    }
+    p = &blk->pairs[blk->npairs++];
+    p->a = a;
+    p->b = b;
+    p->found = 0;
+}
+
+static void check_pairs(int first, int last, void *closure)
+{
+    struct check_block *blk = closure;
+    int i, k;
+
+    for (i = first; i < last; i++) {
+	struct check_pair *p = &blk->pairs[i];
+	struct check_line *a = &blk->lines[p->a];
+	struct check_line *b = &blk->lines[p->b];
+	struct line_pnts **AXLines = NULL, **BXLines = NULL;
+	int naxlines = 0, nbxlines = 0;
+
+	/* left to the loop of break_lines() */
+	if (a->Points->n_points < 2 || b->Points->n_points < 2) {
+	    p->found = 1;
+	    continue;
+	}
+
+	Vect_line_intersection2(a->Points, p->a != p->b ? b->Points : NULL,
+				&a->box, &b->box, &AXLines, &BXLines,
+				&naxlines, &nbxlines, 0);
+
+	p->found = naxlines > 0 || nbxlines > 0;
+
+	for (k = 0; k < naxlines; k++)
+	    Vect_destroy_line_struct(AXLines[k]);
+	if (AXLines)
+	    G_free(AXLines);
+	for (k = 0; k < nbxlines; k++)
+	    Vect_destroy_line_struct(BXLines[k]);
+	if (BXLines)
+	    G_free(BXLines);
+
+	/* collapsed loop, see break_lines() */
+	if (!p->found && p->a == p->b && a->Points->n_points >= 3 &&
+	    a->Points->n_points % 2) {
+	    const struct line_pnts *Points = a->Points;
+	    int centre = Points->n_points / 2;
+
+	    p->found = Points->x[centre - 1] == Points->x[centre + 1] &&
+		Points->y[centre - 1] == Points->y[centre + 1] &&
+		Points->z[centre - 1] == Points->z[centre + 1];
+	}
+    }
+}
+
+static void flush_check_block(struct check_block *blk, char *broken)
+{
+    int i;
+
+    G_parallel_for(0, blk->npairs, 0, check_pairs, blk);
+
+    for (i = 0; i < blk->npairs; i++) {
+	const struct check_pair *p = &blk->pairs[i];
+
+	if (p->found) {
+	    broken[blk->lines[p->a].id] = 1;
+	    broken[blk->lines[p->b].id] = 1;
+	}
+    }
+
+    for (i = 0; i < blk->nlines; i++)
+	blk->index[blk->lines[i].id] = 0;
+    blk->nlines = blk->npairs = 0;
+}
+
+/* flag the lines of the list which intersect lines of the map,
+ * returns the flags by line id or NULL if not checked */
+static char *check_lines(struct Map_info *Map, const struct ilist *List_check,
+			 int type)
+{
+    struct check_block blk;
+    struct boxlist *List;
+    char *broken, *in_list;
+    int nlines, ncheck, iline, i;
+
+#ifndef HAVE_THREAD_LOCAL
+    return NULL;
+#endif
+    if (G_num_workers() == 0)
+	return NULL;
+
+    nlines = Vect_get_num_lines(Map);
+    ncheck = List_check ? List_check->n_values : nlines;
+
+    G_verbose_message(_("Checking for intersections..."));
+
+    broken = G_calloc(nlines + 1, 1);
+    in_list = G_calloc(nlines + 1, 1);
+    for (iline = 0; iline < ncheck; iline++)
+	in_list[List_check ? List_check->value[iline] : iline + 1] = 1;
+
+    G_zero(&blk, sizeof(struct check_block));
+    blk.index = G_calloc(nlines + 1, sizeof(int));
+    List = Vect_new_boxlist(0);
+
+    for (iline = 0; iline < ncheck; iline++) {
+	int aline = List_check ? List_check->value[iline] : iline + 1;
+	int a, b;
+
+	G_percent(iline, ncheck, 1);
+
+	if (!Vect_line_alive(Map, aline))
+	    continue;
+
+	a = check_block_line(Map, &blk, aline, type);
+	if (a < 0)
+	    continue;
+
+	/* self-intersections */
+	check_block_pair(&blk, a, a);
+
+	Vect_select_lines_by_box(Map, &blk.lines[a].box, type, List);
+	for (i = 0; i < List->n_values; i++) {
+	    int bline = List->id[i];
+
+	    /* each pair of lines of the list once */
+	    if (bline == aline || (in_list[bline] && bline < aline))
+		continue;
+
+	    b = check_block_line(Map, &blk, bline, type);
+	    if (b >= 0)
+		check_block_pair(&blk, a, b);
+	}
+
+	if (blk.nlines >= CHECK_LINES || blk.npairs >= CHECK_PAIRS)
+	    flush_check_block(&blk, broken);
+    }
+    flush_check_block(&blk, broken);
+    G_percent(ncheck, ncheck, 1);
+
+    for (i = 0; i < blk.lines_alloc; i++)
+	Vect_destroy_line_struct(blk.lines[i].Points);
+    G_free(blk.lines);
+    G_free(blk.pairs);
+    G_free(blk.index);
+    G_free(in_list);
+    Vect_destroy_boxlist(List);
+
+    return broken;
+}
+
 int break_lines(struct Map_info *Map, struct ilist *List_break,
                 struct ilist *List_ref, int type,
                 struct Map_info *Err, int check)
@@ -162,6 +386,8 @@ int break_lines(struct Map_info *Map, struct ilist *List_break,
     int node, anode1, anode2, bnode1, bnode2;
     double nodex, nodey;
     int a_is_ref, b_is_ref, break_a, break_b;
+    int nlines_map;
+    char *broken;
 
     type &= GV_LINES;
     if (!type)
@@ -195,7 +421,9 @@ int break_lines(struct Map_info *Map, struct ilist *List_break,
 	nlines_org = nlines;
     }
     G_debug(3, "nlines =  %d", nlines);
-    
+
+    nlines_map = Vect_get_num_lines(Map);
+    broken = check_lines(Map, List_ref ? List_ref : List_break, type);
 
     /* TODO:
      * 1. It seems that lines/boundaries are not broken at intersections
@@ -237,6 +465,10 @@ int break_lines(struct Map_info *Map, struct ilist *List_break,
 	if (!Vect_line_alive(Map, aline))
 	    continue;
 
+	/* no intersection with the lines of the map */
+	if (broken && aline <= nlines_map && !broken[aline])
+	    continue;
+
 	a_is_ref = 0;
 	break_a = 1;
 	if (List_ref) {
@@ -580,6 +812,7 @@ int break_lines(struct Map_info *Map, struct ilist *List_break,
     Vect_destroy_cats_struct(BCats);
     Vect_destroy_cats_struct(Cats);
     Vect_destroy_boxlist(List);
+    G_free(broken);
 
     return nbreaks;
 }
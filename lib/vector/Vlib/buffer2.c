@@ -1072,52 +1072,80 @@ void Vect_area_buffer2(const struct Map_info *Map, int area, double da, double d
 		       struct line_pnts **oPoints,
 		       struct line_pnts ***iPoints, int *inner_count)
 {
-    struct line_pnts *tPoints, *outer;
+    struct line_pnts *outer;
     struct line_pnts **isles;
-    int isles_count = 0, n_isles;
+    int n_isles;
     int i, isle;
-    int more = 8;
-    int isles_allocated = 0;
 
     G_debug(2, "Vect_area_buffer()");
 
     /* initializations */
-    tPoints = Vect_new_line_struct();
     n_isles = Vect_get_area_num_isles(Map, area);
-    isles_allocated = n_isles;
-    isles = G_malloc(isles_allocated * sizeof(struct line_pnts *));
+    isles = G_malloc(n_isles * sizeof(struct line_pnts *));
 
     /* outer contour */
     outer = Vect_new_line_struct();
     Vect_get_area_points(Map, area, outer);
-    /* does not work with zero length line segments */
-    Vect_line_prune(outer);
 
     /* inner contours */
     for (i = 0; i < n_isles; i++) {
 	isle = Vect_get_area_isle(Map, area, i);
-	Vect_get_isle_points(Map, isle, tPoints);
+	isles[i] = Vect_new_line_struct();
+	Vect_get_isle_points(Map, isle, isles[i]);
+    }
+
+    Vect_polygon_buffer2(outer, isles, n_isles, da, db, dalpha, round, caps,
+			 tol, oPoints, iPoints, inner_count);
+
+    Vect_destroy_line_struct(outer);
+    destroy_lines_array(isles, n_isles);
+
+    return;
+}
+
+/*!
+   \brief Creates buffer around polygon.
+
+   As Vect_area_buffer2() for the rings of an area read by the caller.
+   The rings are pruned. Does not use any map, thread-safe with
+   different rings.
+
+   \param outer outer ring
+   \param isles inner rings
+   \param n_isles number of inner rings
+   \param da distance along major axis
+   \param db distance along minor axis
+   \param dalpha angle between 0x and major axis
+   \param round make corners round
+   \param caps add caps at line ends
+   \param tol maximum distance between theoretical arc and output segments
+   \param[out] oPoints output polygon outer border (ccw order)
+   \param[out] iPoints array of output polygon's holes (cw order)
+   \param[out] inner_count number of holes
+ */
+void Vect_polygon_buffer2(struct line_pnts *outer, struct line_pnts **isles,
+			  int n_isles, double da, double db, double dalpha,
+			  int round, int caps, double tol,
+			  struct line_pnts **oPoints,
+			  struct line_pnts ***iPoints, int *inner_count)
+{
+    int i;
+
+    G_debug(2, "Vect_polygon_buffer2()");
 
+    /* does not work with zero length line segments */
+    Vect_line_prune(outer);
+    for (i = 0; i < n_isles; i++) {
 	/* Check if the isle is big enough */
 	/*
-	   if (Vect_line_length(tPoints) < 2*PI*max)
+	   if (Vect_line_length(isles[i]) < 2*PI*max)
 	   continue;
 	 */
-	/* does not work with zero length line segments */
-	Vect_line_prune(tPoints);
-	add_line_to_array(tPoints, &isles, &isles_count, &isles_allocated,
-			  more);
-	tPoints = Vect_new_line_struct();
+	Vect_line_prune(isles[i]);
     }
 
-    buffer_lines(outer, isles, isles_count, 0, da, db, dalpha, round, caps,
+    buffer_lines(outer, isles, n_isles, 0, da, db, dalpha, round, caps,
 		 tol, oPoints, iPoints, inner_count);
-
-    Vect_destroy_line_struct(tPoints);
-    Vect_destroy_line_struct(outer);
-    destroy_lines_array(isles, isles_count);
-
-    return;
 }
 
 /*!
@@ -565,6 +565,210 @@ int Vect_attach_centroids(struct Map_info *Map, const struct bound_box * box)
     return 0;
 }
 
+/*!
+   \brief Add box to the batch of topology updates (internal use only)
+
+   \param plus pointer to Plus_head structure
+   \param box box of changed areas/isles or of a new centroid
+ */
+void Vect__add_topo_batch_box(struct Plus_head *plus,
+			      const struct bound_box *box)
+{
+    if (plus->batch.n_boxes == plus->batch.alloc_boxes) {
+	plus->batch.alloc_boxes += 1000;
+	plus->batch.boxes = G_realloc(plus->batch.boxes,
+				      plus->batch.alloc_boxes *
+				      sizeof(struct bound_box));
+    }
+    plus->batch.boxes[plus->batch.n_boxes++] = *box;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    int ai = *(const int *)a;
+    int bi = *(const int *)b;
+
+    return (ai > bi) - (ai < bi);
+}
+
+/* sorted ids of the isles (type 0) or centroids in the boxes of the
+   batch, returns the number of ids */
+static int select_batch(struct Map_info *Map, int type, int **ids)
+{
+    struct Plus_head *plus = &(Map->plus);
+    struct boxlist *List;
+    int i, j, n, alloc;
+
+    List = Vect_new_boxlist(FALSE);
+    n = alloc = 0;
+    *ids = NULL;
+
+    for (i = 0; i < plus->batch.n_boxes; i++) {
+	if (type)
+	    Vect_select_lines_by_box(Map, &(plus->batch.boxes[i]), type, List);
+	else
+	    Vect_select_isles_by_box(Map, &(plus->batch.boxes[i]), List);
+
+	if (n + List->n_values > alloc) {
+	    alloc = n + List->n_values + 1000;
+	    *ids = G_realloc(*ids, alloc * sizeof(int));
+	}
+	for (j = 0; j < List->n_values; j++)
+	    (*ids)[n++] = List->id[j];
+    }
+    Vect_destroy_boxlist(List);
+
+    if (n == 0)
+	return 0;
+
+    /* boxes of the batch overlap */
+    qsort(*ids, n, sizeof(int), cmp_int);
+    for (i = j = 1; i < n; i++) {
+	if ((*ids)[i] != (*ids)[j - 1])
+	    (*ids)[j++] = (*ids)[i];
+    }
+
+    return j;
+}
+
+/*!
+   \brief Begin a batch of topology updates
+
+   Features written, rewritten or deleted on level 2 during a batch
+   update the topology as usual, but isles and centroids are not
+   reattached after each feature. Vect_end_topo_batch() reattaches
+   them once, only around the areas and isles changed by the batch.
+   Appending a few features to a large map is then much faster than
+   Vect_build().
+
+   Areas must not be queried during a batch (e.g. Vect_find_area()),
+   their isles and centroids are not up to date.
+
+   The category index is updated during the batch if it is up to date.
+
+   \param Map vector map opened on level 2 for update
+
+   \return 1 batch begun
+   \return 0 areas are not built (nothing to do)
+ */
+int Vect_begin_topo_batch(struct Map_info *Map)
+{
+    struct Plus_head *plus = &(Map->plus);
+
+    G_debug(1, "Vect_begin_topo_batch(): name = '%s'", Map->name);
+
+    if (Map->format != GV_FORMAT_NATIVE || Vect_level(Map) < 2 ||
+	plus->built < GV_BUILD_AREAS)
+	return 0;
+
+    if (plus->cidx_up_to_date)
+	plus->update_cidx = TRUE;
+
+    plus->batch.active = TRUE;
+    plus->batch.n_boxes = 0;
+
+    return 1;
+}
+
+/*!
+   \brief End a batch of topology updates
+
+   Reattaches isles and centroids in the boxes of the areas and isles
+   changed since Vect_begin_topo_batch(). If the topology and category
+   index are complete, the support files are written by Vect_close()
+   without Vect_build().
+
+   \param Map vector map
+
+   \return 1 topology and category index are up to date
+   \return 0 no batch was begun or the topology must be built
+ */
+int Vect_end_topo_batch(struct Map_info *Map)
+{
+    int i, n, isle, area, centr;
+    int *ids;
+    struct bound_box box;
+    struct Plus_head *plus = &(Map->plus);
+    struct P_isle *Isle;
+    struct P_area *Area;
+    struct P_topo_c *topo;
+
+    if (!plus->batch.active)
+	return 0;
+
+    G_debug(1, "Vect_end_topo_batch(): name = '%s' boxes = %d", Map->name,
+	    plus->batch.n_boxes);
+
+    plus->batch.active = FALSE;
+
+    /* all isles in the boxes are detached and attached again, unlike
+       Vect_attach_isles() which keeps isles of areas inside the box:
+       these areas may have been built by the batch */
+    if (plus->built >= GV_BUILD_ATTACH_ISLES) {
+	n = select_batch(Map, 0, &ids);
+	for (i = 0; i < n; i++) {
+	    isle = ids[i];
+	    Isle = plus->Isle[isle];
+	    if (Isle->area > 0) {
+		dig_area_del_isle(plus, Isle->area, isle);
+		Isle->area = 0;
+	    }
+	}
+	for (i = 0; i < n; i++) {
+	    Vect_get_isle_box(Map, ids[i], &box);
+	    Vect_attach_isle(Map, ids[i], &box);
+	}
+	G_free(ids);
+    }
+
+    /* centroids are attached in the order of their ids, as by
+       Vect_build(), the first centroid in an area is not a duplicate */
+    if (plus->built >= GV_BUILD_CENTROIDS) {
+	n = select_batch(Map, GV_CENTROID, &ids);
+	for (i = 0; i < n; i++) {
+	    centr = ids[i];
+	    topo = (struct P_topo_c *)plus->Line[centr]->topo;
+	    if (topo->area > 0) {
+		if (plus->update_cidx)
+		    V2__delete_area_cats_from_cidx_nat(Map, topo->area);
+		plus->Area[topo->area]->centroid = 0;
+	    }
+	    topo->area = 0;
+	}
+	for (i = 0; i < n; i++) {
+	    centr = ids[i];
+	    topo = (struct P_topo_c *)plus->Line[centr]->topo;
+	    Vect_get_line_box(Map, centr, &box);
+	    area = Vect_find_area(Map, box.E, box.N);
+	    G_debug(3, "\tcentroid %d is in area %d", centr, area);
+	    if (area < 1)
+		continue;
+
+	    Area = plus->Area[area];
+	    if (Area->centroid == 0) {
+		Area->centroid = centr;
+		topo->area = area;
+		if (plus->update_cidx)
+		    V2__add_area_cats_to_cidx_nat(Map, area);
+	    }
+	    else {
+		topo->area = -area;
+	    }
+	}
+	G_free(ids);
+    }
+
+    plus->batch.n_boxes = 0;
+
+    /* the topology was kept up to date, no need for Vect_build() */
+    if (plus->built == GV_BUILD_ALL && plus->cidx_up_to_date) {
+	Map->support_updated = TRUE;
+	return 1;
+    }
+
+    return 0;
+}
+
 /*!
    \brief Build topology for vector map
 
@@ -851,6 +1055,9 @@ int Vect_build_partial(struct Map_info *Map, int build)
 
     G_debug(3, "Vect_build(): build = %d", build);
 
+    /* finish a batch of topology updates */
+    Vect_end_topo_batch(Map);
+
     /* If topology is already build (map on > level 2), set level to 1
      * so that lines will be read by V1_read_ (all lines) */
     Map->level = LEVEL_1; /* may be not needed, because V1_read is used
@@ -1281,6 +1488,7 @@ int Vect_save_sidx(struct Map_info *Map)
 	Map->plus.Spidx_new = FALSE;
     }
 
+    dig_file_free(&(Map->plus.spidx_fp));
     fclose(Map->plus.spidx_fp.file);
 
     Map->plus.Spidx_built = FALSE;
@@ -70,7 +70,10 @@ int Vect_build_nat(struct Map_info *Map, int build)
 	 *  with the same coordinates doesn't exist yet.
 	 */
 
-	/* register lines, create nodes */
+	/* register lines, create nodes; the spatial index of the
+	   lines is not searched meanwhile and is bulk-loaded at the
+	   end, the nodes are searched for each new line */
+	RTreeBulkBegin(plus->Line_spidx);
 	Vect_rewind(Map);
 	G_message(_("Registering primitives..."));
 	i = 0;
@@ -83,6 +86,7 @@ int Vect_build_nat(struct Map_info *Map, int build)
                are skipped by V1_read_next_line() */
 	    if (type == -1) {
 		G_warning(_("Unable to read vector map"));
+		RTreeBulkEnd(plus->Line_spidx);
 		return 0;
 	    }
 	    else if (type == -2) {
@@ -114,6 +118,7 @@ int Vect_build_nat(struct Map_info *Map, int build)
 	    }
 	}
 	G_progress(1, 1);
+	RTreeBulkEnd(plus->Line_spidx);
 
 	G_verbose_message(n_("One primitive registered", "%d primitives registered", plus->n_lines), plus->n_lines);
 	G_verbose_message(n_("One vertex registered", "%jd vertices registered", npoints), npoints);
@@ -129,6 +134,9 @@ int Vect_build_nat(struct Map_info *Map, int build)
 	/* Go through all bundaries and try to build area for both sides */
 	if (plus->n_blines > 0) {
 	    counter = 1;
+	    /* areas and isles are searched only from the next step on */
+	    RTreeBulkBegin(plus->Area_spidx);
+	    RTreeBulkBegin(plus->Isle_spidx);
 	    G_important_message(_("Building areas..."));
 	    G_percent(0, plus->n_blines, 1);
 	    for (line = 1; line <= plus->n_lines; line++) {
@@ -153,6 +161,8 @@ int Vect_build_nat(struct Map_info *Map, int build)
 		    Vect_build_line_area(Map, line, side);
 		}
 	    }
+	    RTreeBulkEnd(plus->Area_spidx);
+	    RTreeBulkEnd(plus->Isle_spidx);
 	    G_verbose_message(n_("One area built", "%d areas built", plus->n_areas), plus->n_areas);
 	    G_verbose_message(n_("One isle built", "%d isles built", plus->n_isles), plus->n_isles);
 	}
@@ -315,7 +315,6 @@ int add_geometry_pg(struct Plus_head *plus,
 void build_pg(struct Map_info *Map, int build)
 {
     int iFeature, ipart, fid, nrecords, npoints;
-    char *wkb_data;
     
     struct Format_info_pg *pg_info;
     
@@ -339,18 +338,17 @@ void build_pg(struct Map_info *Map, int build)
     G_message(_("Registering primitives..."));
     for (iFeature = 0; iFeature < nrecords; iFeature++) {
 	/* get feature id */
-	fid  = atoi(PQgetvalue(pg_info->res, iFeature, 1));
+	fid  = Vect__get_int_pg(pg_info->res, iFeature, 1);
         if (fid < 1)
             continue; /* PostGIS Topology: skip features with negative
                        * fid (isles, universal face, ...) */
 
-	wkb_data = PQgetvalue(pg_info->res, iFeature, 0);
-	
 	G_progress(iFeature + 1, 1e4);
 
 	/* cache feature (lines) */
-	if (SF_NONE == Vect__cache_feature_pg(wkb_data, FALSE, FALSE,
-                                              &(pg_info->cache), &fparts)) {
+	if (SF_NONE == Vect__cache_feature_res_pg(pg_info->res, iFeature, 0,
+                                                  FALSE, FALSE,
+                                                  &(pg_info->cache), &fparts)) {
 	    G_warning(_("Feature %d without geometry skipped"),
 		      iFeature + 1);
 	    continue;
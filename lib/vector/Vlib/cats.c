@@ -22,6 +22,8 @@
 #include <grass/dbmi.h>
 #include <grass/glocale.h>
 
+#include "local_proto.h"
+
 static int cmp(const void *pa, const void *pb);
 static struct line_cats *Vect__new_cats_struct(void);
 
@@ -59,6 +61,9 @@ static struct line_cats *Vect__new_cats_struct()
 {
     struct line_cats *p;
 
+    if ((p = Vect__recycled_cats()))
+	return p;
+
     p = (struct line_cats *)G_malloc(sizeof(struct line_cats));
 
     /* n_cats MUST be initialized to zero */
@@ -80,7 +85,9 @@ static struct line_cats *Vect__new_cats_struct()
 void Vect_destroy_cats_struct(struct line_cats *p)
 {
     if (p) {			/* probably a moot test */
-	if (p->n_cats) {
+	if (Vect__recycle_cats(p))
+	    return;
+	if (p->alloc_cats) {
 	    G_free((void *)p->field);
 	    G_free((void *)p->cat);
 	}
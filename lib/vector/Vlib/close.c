@@ -81,6 +81,9 @@ int Vect_close(struct Map_info *Map)
     G_debug(1, "Vect_close(): name = %s, mapset = %s, format = %d, level = %d, is_tmp = %d",
 	    Map->name, Map->mapset, Map->format, Map->level, Map->temporary);
 
+    /* finish a batch of topology updates */
+    Vect_end_topo_batch(Map);
+
     if (Map->temporary &&
         (Map->fInfo.ogr.dsn || Map->fInfo.pg.conninfo)) {
         /* transfer features for external output format */
@@ -207,6 +210,7 @@ int Vect_close(struct Map_info *Map)
 	Map->plus.built == GV_BUILD_ALL) {
 
         G_debug(1, "spatial index file closed");
+	dig_file_free(&(Map->plus.spidx_fp));
 	fclose(Map->plus.spidx_fp.file);
     }
 
@@ -45,6 +45,8 @@ int V1_close_pg(struct Map_info *Map)
 
     pg_info = &(Map->fInfo.pg);
     if (Map->mode == GV_MODE_WRITE || Map->mode == GV_MODE_RW) {
+        /* finish loading features */
+        Vect__end_copy_pg(pg_info->conn);
         /* write header */
         Vect__write_head(Map);
         /* write frmt file for created PG-link */
@@ -70,6 +72,10 @@ int V1_close_pg(struct Map_info *Map)
         G_free(pg_info->cursor_name);
         pg_info->cursor_name = NULL;
     }
+    if (pg_info->res_next) {
+        PQclear(pg_info->res_next);
+        pg_info->res_next = NULL;
+    }
 
     PQfinish(pg_info->conn);
 
@@ -518,4 +518,218 @@ GEOSCoordSequence *read_polygon_points(struct Map_info *Map, int n_lines, int *l
 
     return pseq_shell;
 }
+
+/* prepared geometries of features of a map, most recently used first */
+struct geos_cache_entry
+{
+    int key;			/* 2 * id + 1 for areas */
+    GEOSGeometry *geom;
+    const GEOSPreparedGeometry *prep;
+    int prev, next;		/* LRU list */
+    int hnext;			/* hash chain */
+};
+
+struct geos_cache
+{
+    struct Map_info *Map;
+    struct geos_cache_entry *entries;
+    int size, n;
+    int head, tail;
+    int *buckets;
+    unsigned int mask;
+    long hits, misses;
+};
+
+/*!
+   \brief Create a cache of prepared geometries of vector features
+
+   Predicates of prepared geometries (GEOSPreparedIntersects(),
+   GEOSPreparedContains(), ...) are much faster than the plain
+   predicates when the same feature is tested against many others. The
+   cache keeps the geometries of the last <i>size</i> features asked
+   for with Vect_geos_cache_line() and Vect_geos_cache_area().
+
+   The cache uses the GEOS global context initialized with initGEOS()
+   and is not thread-safe.
+
+   \param Map pointer to Map_info structure
+   \param size maximum number of geometries kept (<= 0 for 64)
+
+   \return pointer to the new cache
+ */
+struct geos_cache *Vect_new_geos_cache(struct Map_info *Map, int size)
+{
+    struct geos_cache *cache;
+    unsigned int nbuckets;
+    int i;
+
+    if (size <= 0)
+        size = 64;
+
+    cache = G_malloc(sizeof(struct geos_cache));
+    cache->Map = Map;
+    cache->size = size;
+    cache->n = 0;
+    cache->head = cache->tail = -1;
+    cache->hits = cache->misses = 0;
+    cache->entries = G_malloc(size * sizeof(struct geos_cache_entry));
+
+    for (nbuckets = 16; nbuckets < 2 * (unsigned int)size; nbuckets <<= 1)
+        ;
+    cache->mask = nbuckets - 1;
+    cache->buckets = G_malloc(nbuckets * sizeof(int));
+    for (i = 0; i < (int)nbuckets; i++)
+        cache->buckets[i] = -1;
+
+    return cache;
+}
+
+/*!
+   \brief Destroy a cache of prepared geometries
+
+   The geometries returned by the cache become invalid.
+
+   \param cache pointer to the cache
+ */
+void Vect_destroy_geos_cache(struct geos_cache *cache)
+{
+    int i;
+
+    G_debug(1, "Vect_destroy_geos_cache(): %ld hits, %ld misses",
+            cache->hits, cache->misses);
+
+    for (i = 0; i < cache->n; i++) {
+        GEOSPreparedGeom_destroy(cache->entries[i].prep);
+        GEOSGeom_destroy(cache->entries[i].geom);
+    }
+    G_free(cache->entries);
+    G_free(cache->buckets);
+    G_free(cache);
+}
+
+static unsigned int cache_hash(const struct geos_cache *cache, int key)
+{
+    return ((unsigned int)key * 2654435761u) & cache->mask;
+}
+
+static void cache_unlink(struct geos_cache *cache, int i)
+{
+    struct geos_cache_entry *e = &cache->entries[i];
+
+    if (e->prev >= 0)
+        cache->entries[e->prev].next = e->next;
+    else
+        cache->head = e->next;
+    if (e->next >= 0)
+        cache->entries[e->next].prev = e->prev;
+    else
+        cache->tail = e->prev;
+}
+
+static void cache_push(struct geos_cache *cache, int i)
+{
+    struct geos_cache_entry *e = &cache->entries[i];
+
+    e->prev = -1;
+    e->next = cache->head;
+    if (cache->head >= 0)
+        cache->entries[cache->head].prev = i;
+    cache->head = i;
+    if (cache->tail < 0)
+        cache->tail = i;
+}
+
+/* remove the least recently used entry, returns its index */
+static int cache_evict(struct geos_cache *cache)
+{
+    int i = cache->tail;
+    struct geos_cache_entry *e = &cache->entries[i];
+    int *link = &cache->buckets[cache_hash(cache, e->key)];
+
+    while (*link != i)
+        link = &cache->entries[*link].hnext;
+    *link = e->hnext;
+
+    cache_unlink(cache, i);
+    GEOSPreparedGeom_destroy(e->prep);
+    GEOSGeom_destroy(e->geom);
+
+    return i;
+}
+
+static const GEOSPreparedGeometry *cache_get(struct geos_cache *cache,
+                                             int id, int area)
+{
+    int key = 2 * id + (area ? 1 : 0);
+    unsigned int h = cache_hash(cache, key);
+    struct geos_cache_entry *e;
+    GEOSGeometry *geom;
+    int i;
+
+    for (i = cache->buckets[h]; i >= 0; i = cache->entries[i].hnext) {
+        if (cache->entries[i].key == key) {
+            cache->hits++;
+            if (cache->head != i) {
+                cache_unlink(cache, i);
+                cache_push(cache, i);
+            }
+            return cache->entries[i].prep;
+        }
+    }
+
+    cache->misses++;
+    geom = area ? Vect_read_area_geos(cache->Map, id)
+        : Vect_read_line_geos(cache->Map, id, NULL);
+    if (!geom)
+        return NULL;
+
+    i = cache->n < cache->size ? cache->n++ : cache_evict(cache);
+    e = &cache->entries[i];
+    e->key = key;
+    e->geom = geom;
+    e->prep = GEOSPrepare(geom);
+    e->hnext = cache->buckets[h];
+    cache->buckets[h] = i;
+    cache_push(cache, i);
+
+    return e->prep;
+}
+
+/*!
+   \brief Get the prepared geometry of a vector feature
+
+   The geometry is read with Vect_read_line_geos() if it is not in the
+   cache and is owned by the cache: it must not be destroyed and is
+   valid until the feature is evicted by one of the next <i>size</i> - 1
+   features asked for or until the cache is destroyed.
+
+   \param cache pointer to the cache
+   \param line feature id
+
+   \return pointer to GEOSPreparedGeometry instance
+   \return NULL on error
+ */
+const GEOSPreparedGeometry *Vect_geos_cache_line(struct geos_cache *cache,
+                                                 int line)
+{
+    return cache_get(cache, line, 0);
+}
+
+/*!
+   \brief Get the prepared geometry of a vector area (polygon)
+
+   As Vect_geos_cache_line(), the geometry is read with
+   Vect_read_area_geos().
+
+   \param cache pointer to the cache
+   \param area area id
+
+   \return pointer to GEOSPreparedGeometry instance
+   \return NULL on error
+ */
+const GEOSPreparedGeometry *Vect_geos_cache_area(struct geos_cache *cache,
+                                                 int area)
+{
+    return cache_get(cache, area, 1);
+}
 #endif /* HAVE_GEOS */
@@ -21,6 +21,10 @@
 #include <grass/vector.h>
 #include <grass/glocale.h>
 
+#ifdef HAVE_POSTGRES
+#include "pg_local_proto.h"
+#endif
+
 /*!
    \brief Get datasource name (relevant only for non-native formats)
 
@@ -182,6 +186,7 @@ const char *Vect_get_finfo_geometry_type(const struct Map_info *Map)
                 pg_info->schema_name, pg_info->table_name);
         G_debug(2, "SQL: %s", stmt);
         
+        Vect__sync_pg(pg_info->conn);
         res = PQexec(pg_info->conn, stmt);
         if (!res || PQresultStatus(res) != PGRES_TUPLES_OK ||
             PQntuples(res) != 1) {
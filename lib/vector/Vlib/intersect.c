@@ -72,6 +72,8 @@
 #include <grass/vector.h>
 #include <grass/glocale.h>
 
+#include "local_proto.h"
+
 /* function prototypes */
 static int cmp_cross(const void *pa, const void *pb);
 static void add_cross(int asegment, double adistance, int bsegment,
@@ -588,7 +590,7 @@ static int ident(double x1, double y1, double x2, double y2, double thresh)
 #endif
 
 /* shared by Vect_line_intersection, Vect_line_check_intersection, cross_seg, find_cross */
-static struct line_pnts *APnts, *BPnts;
+static THREAD_LOCAL struct line_pnts *APnts, *BPnts;
 
 /* break segments (called by rtree search) */
 static int cross_seg(int id, const struct RTree_Rect *rect, void *arg)
@@ -1212,9 +1214,10 @@ Vect_line_intersection(struct line_pnts *APoints,
     return 1;
 }
 
-static struct line_pnts *APnts, *BPnts, *IPnts;
+/* shared by Vect_line_check_intersection, find_cross */
+static THREAD_LOCAL struct line_pnts *IPnts;
 
-static int cross_found;		/* set by find_cross() */
+static THREAD_LOCAL int cross_found;	/* set by find_cross() */
 
 /* break segments (called by rtree search) */
 static int find_cross(int id, const struct RTree_Rect *rect, void *arg)
@@ -1268,6 +1271,8 @@ static int find_cross(int id, const struct RTree_Rect *rect, void *arg)
  * \param BPoints second input line 
  * \param with_z 3D, not supported (only if one or both are points)!
  *
+ * Thread-safe when compiled with thread local storage.
+ *
  * \return 0 no intersection 
  * \return 1 intersection found
  */
@@ -1278,13 +1283,10 @@ Vect_line_check_intersection(struct line_pnts *APoints,
     int i;
     double dist, rethresh;
     struct RTree *MyRTree;
-    static struct RTree_Rect rect;
-    static int rect_init = 0;
+    struct RTree_Rect rect;
+    RectReal boundary[6];
 
-    if (!rect_init) {
-	rect.boundary = G_malloc(6 * sizeof(RectReal));
-	rect_init = 6;
-    }
+    rect.boundary = boundary;
 
     rethresh = 0.000001;	/* TODO */
     APnts = APoints;
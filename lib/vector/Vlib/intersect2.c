@@ -74,6 +74,8 @@
 #include <grass/rbtree.h>
 #include <grass/glocale.h>
 
+#include "local_proto.h"
+
 /* function prototypes */
 static int cmp_cross(const void *pa, const void *pb);
 static void add_cross(int asegment, double adistance, int bsegment,
@@ -88,7 +90,8 @@ static int ident(double x1, double y1, double x2, double y2, double thresh);
 static int snap_cross(int asegment, double *adistance, int bsegment,
 		      double *bdistance, double *xc, double *yc);
 static int cross_seg(int i, int j, int b);
-static int find_cross(int i, int j, int b);
+static int find_cross(struct line_pnts *, struct line_pnts *, int, int, int,
+		      struct line_pnts *);
 
 
 typedef struct
@@ -99,13 +102,13 @@ typedef struct
 } CROSS;
 
 /* Current line in arrays is for some functions like cmp() set by: */
-static int current;
-static int second;		/* line which is not current */
+static THREAD_LOCAL int current;
+static THREAD_LOCAL int second;		/* line which is not current */
 
-static int a_cross = 0;
-static int n_cross;
-static CROSS *cross = NULL;
-static int *use_cross = NULL;
+static THREAD_LOCAL int a_cross = 0;
+static THREAD_LOCAL int n_cross;
+static THREAD_LOCAL CROSS *cross = NULL;
+static THREAD_LOCAL int *use_cross = NULL;
 
 static double rethresh = 0.000001;	/* TODO */
 
@@ -198,8 +201,8 @@ static int ident(double x1, double y1, double x2, double y2, double thresh)
 }
 #endif
 
-/* shared by Vect_line_intersection, Vect_line_check_intersection, cross_seg, find_cross */
-static struct line_pnts *APnts, *BPnts, *ABPnts[2], *IPnts;
+/* shared by Vect_line_intersection, cross_seg */
+static THREAD_LOCAL struct line_pnts *APnts, *BPnts;
 
 /* Snap breaks to nearest vertices within RE threshold */
 /* Calculate distances along segments */
@@ -356,6 +359,7 @@ static int cross_seg(int i, int j, int b)
 
 struct qitem
 {
+    const struct line_pnts *Pnts;	/* line of the segment */
     int l;	/* line 0 - A line , 1 - B line */
     int s;	/* segment index */
     int p;	/* point index */
@@ -375,13 +379,13 @@ static int cmp_q_x(struct qitem *a, struct qitem *b)
 {
     double x1, y1, z1, x2, y2, z2;
 
-    x1 = ABPnts[a->l]->x[a->p];
-    y1 = ABPnts[a->l]->y[a->p];
-    z1 = ABPnts[a->l]->z[a->p];
+    x1 = a->Pnts->x[a->p];
+    y1 = a->Pnts->y[a->p];
+    z1 = a->Pnts->z[a->p];
 
-    x2 = ABPnts[b->l]->x[b->p];
-    y2 = ABPnts[b->l]->y[b->p];
-    z2 = ABPnts[b->l]->z[b->p];
+    x2 = b->Pnts->x[b->p];
+    y2 = b->Pnts->y[b->p];
+    z2 = b->Pnts->z[b->p];
 
     if (x1 < x2)
 	return 1;
@@ -516,13 +520,13 @@ static int cmp_t_y(const void *aa, const void *bb)
     struct qitem *a = (struct qitem *) aa;
     struct qitem *b = (struct qitem *) bb;
 
-    x1 = ABPnts[a->l]->x[a->p];
-    y1 = ABPnts[a->l]->y[a->p];
-    z1 = ABPnts[a->l]->z[a->p];
+    x1 = a->Pnts->x[a->p];
+    y1 = a->Pnts->y[a->p];
+    z1 = a->Pnts->z[a->p];
 
-    x2 = ABPnts[b->l]->x[b->p];
-    y2 = ABPnts[b->l]->y[b->p];
-    z2 = ABPnts[b->l]->z[b->p];
+    x2 = b->Pnts->x[b->p];
+    y2 = b->Pnts->y[b->p];
+    z2 = b->Pnts->z[b->p];
 
     if (y1 < y2)
 	return -1;
@@ -557,6 +561,7 @@ static int boq_load(struct boq *q, struct line_pnts *Pnts,
     struct qitem qi;
 
     /* load Pnts to queue */
+    qi.Pnts = Pnts;
     qi.l = l;
     loaded = 0;
 
@@ -676,6 +681,9 @@ static int boq_load(struct boq *q, struct line_pnts *Pnts,
  * \param[out] nblines number of new lines (BLines)
  * \param with_z 3D, not supported!
  *
+ * Thread-safe with different output arrays when compiled with thread
+ * local storage.
+ *
  * \return 0 no intersection 
  * \return 1 intersection found
  */
@@ -720,9 +728,6 @@ Vect_line_intersection2(struct line_pnts *APoints,
 	same = 1;
     }
 
-    ABPnts[0] = APnts;
-    ABPnts[1] = BPnts;
-
     *nalines = 0;
     *nblines = 0;
 
@@ -1198,10 +1203,9 @@ Vect_line_intersection2(struct line_pnts *APoints,
     return 1;
 }
 
-static int cross_found;		/* set by find_cross() */
-
-/* find segment intersection, used by Vect_line_check_intersection2 */
-static int find_cross(int i, int j, int b)
+/* find segment intersection, used by line_check_intersection2 */
+static int find_cross(struct line_pnts *APnts, struct line_pnts *BPnts,
+		      int i, int j, int b, struct line_pnts *IPnts)
 {
     double x1, y1, z1, x2, y2, z2;
     double y1min, y1max, y2min, y2max;
@@ -1247,9 +1251,6 @@ static int find_cross(int i, int j, int b)
 					&x1, &y1, &z1, &x2, &y2, &z2, 0);
     }
 
-    if (!IPnts)
-	IPnts = Vect_new_line_struct();
-
     /* add ALL (including end points and duplicates), clean later */
     switch (ret) {
     case 0:
@@ -1272,22 +1273,11 @@ static int find_cross(int i, int j, int b)
     return ret;
 }
 
-/*!
- * \brief Check if 2 lines intersect.
- *
- * Points (Points->n_points == 1) are also supported.
- *
- * \param APoints first input line 
- * \param BPoints second input line 
- * \param with_z 3D, not supported (only if one or both are points)!
- *
- * \return 0 no intersection 
- * \return 1 intersection
- * \return 2 end points only
- */
-int
-Vect_line_check_intersection2(struct line_pnts *APoints,
-			      struct line_pnts *BPoints, int with_z)
+/* check if 2 lines intersect, the intersection points found are added
+ * to IPnts; safe to call from several threads */
+static int line_check_intersection2(struct line_pnts *APnts,
+				    struct line_pnts *BPnts,
+				    struct line_pnts *IPnts, int with_z)
 {
     double dist;
     struct bound_box ABox, BBox, abbox;
@@ -1298,33 +1288,26 @@ Vect_line_check_intersection2(struct line_pnts *APoints,
     int ret, intersect;
     double xa1, ya1, xa2, ya2, xb1, yb1, xb2, yb2, xi, yi;
 
-    APnts = APoints;
-    BPnts = BPoints;
-
-    ABPnts[0] = APnts;
-    ABPnts[1] = BPnts;
 
     /* TODO: 3D, RE (representation error) threshold, GV_POINTS (line x point) */
 
-    if (!IPnts)
-	IPnts = Vect_new_line_struct();
     Vect_reset_line(IPnts);
 
     /* If one or both are point (Points->n_points == 1) */
-    if (APoints->n_points == 1 && BPoints->n_points == 1) {
-	if (APoints->x[0] == BPoints->x[0] && APoints->y[0] == BPoints->y[0]) {
+    if (APnts->n_points == 1 && BPnts->n_points == 1) {
+	if (APnts->x[0] == BPnts->x[0] && APnts->y[0] == BPnts->y[0]) {
 	    if (!with_z) {
 		if (0 >
-		    Vect_copy_xyz_to_pnts(IPnts, &APoints->x[0],
-					  &APoints->y[0], NULL, 1))
+		    Vect_copy_xyz_to_pnts(IPnts, &APnts->x[0],
+					  &APnts->y[0], NULL, 1))
 		    G_warning(_("Error while adding point to array. Out of memory"));
 		return 1;
 	    }
 	    else {
-		if (APoints->z[0] == BPoints->z[0]) {
+		if (APnts->z[0] == BPnts->z[0]) {
 		    if (0 >
-			Vect_copy_xyz_to_pnts(IPnts, &APoints->x[0],
-					      &APoints->y[0], &APoints->z[0],
+			Vect_copy_xyz_to_pnts(IPnts, &APnts->x[0],
+					      &APnts->y[0], &APnts->z[0],
 					      1))
 			G_warning(_("Error while adding point to array. Out of memory"));
 		    return 1;
@@ -1338,15 +1321,15 @@ Vect_line_check_intersection2(struct line_pnts *APoints,
 	}
     }
 
-    if (APoints->n_points == 1) {
-	Vect_line_distance(BPoints, APoints->x[0], APoints->y[0],
-			   APoints->z[0], with_z, NULL, NULL, NULL, &dist,
+    if (APnts->n_points == 1) {
+	Vect_line_distance(BPnts, APnts->x[0], APnts->y[0],
+			   APnts->z[0], with_z, NULL, NULL, NULL, &dist,
 			   NULL, NULL);
 
-	if (dist <= d_ulp(APoints->x[0], APoints->y[0])) {
+	if (dist <= d_ulp(APnts->x[0], APnts->y[0])) {
 	    if (0 >
-		Vect_copy_xyz_to_pnts(IPnts, &APoints->x[0], &APoints->y[0],
-				      &APoints->z[0], 1))
+		Vect_copy_xyz_to_pnts(IPnts, &APnts->x[0], &APnts->y[0],
+				      &APnts->z[0], 1))
 		G_warning(_("Error while adding point to array. Out of memory"));
 	    return 1;
 	}
@@ -1355,15 +1338,15 @@ Vect_line_check_intersection2(struct line_pnts *APoints,
 	}
     }
 
-    if (BPoints->n_points == 1) {
-	Vect_line_distance(APoints, BPoints->x[0], BPoints->y[0],
-			   BPoints->z[0], with_z, NULL, NULL, NULL, &dist,
+    if (BPnts->n_points == 1) {
+	Vect_line_distance(APnts, BPnts->x[0], BPnts->y[0],
+			   BPnts->z[0], with_z, NULL, NULL, NULL, &dist,
 			   NULL, NULL);
 
-	if (dist <= d_ulp(BPoints->x[0], BPoints->y[0])) {
+	if (dist <= d_ulp(BPnts->x[0], BPnts->y[0])) {
 	    if (0 >
-		Vect_copy_xyz_to_pnts(IPnts, &BPoints->x[0], &BPoints->y[0],
-				      &BPoints->z[0], 1))
+		Vect_copy_xyz_to_pnts(IPnts, &BPnts->x[0], &BPnts->y[0],
+				      &BPnts->z[0], 1))
 		G_warning(_("Error while adding point to array. Out of memory"));
 	    return 1;
 	}
@@ -1373,8 +1356,8 @@ Vect_line_check_intersection2(struct line_pnts *APoints,
 
     /* Take each segment from A and find if intersects any segment from B. */
 
-    dig_line_box(APoints, &ABox);
-    dig_line_box(BPoints, &BBox);
+    dig_line_box(APnts, &ABox);
+    dig_line_box(BPnts, &BBox);
     if (!with_z) {
 	ABox.T = BBox.T = PORT_DOUBLE_MAX;
 	ABox.B = BBox.B = -PORT_DOUBLE_MAX;
@@ -1449,7 +1432,7 @@ Vect_line_check_intersection2(struct line_pnts *APoints,
 		/* test for intersection of s with all segments in T */
 		rbtree_init_trav(&bo_t_trav, bo_tb);
 		while ((found = rbtree_traverse(&bo_t_trav))) {
-		    ret = find_cross(qi.s, found->s, 0);
+		    ret = find_cross(APnts, BPnts, qi.s, found->s, 0, IPnts);
 
 		    if (ret > 0) {
 			if (ret != 1) {
@@ -1487,7 +1470,7 @@ Vect_line_check_intersection2(struct line_pnts *APoints,
 		/* test for intersection of s with all segments in T */
 		rbtree_init_trav(&bo_t_trav, bo_ta);
 		while ((found = rbtree_traverse(&bo_t_trav))) {
-		    ret = find_cross(found->s, qi.s, 1);
+		    ret = find_cross(APnts, BPnts, found->s, qi.s, 1, IPnts);
 
 		    if (ret > 0) {
 			if (ret != 1) {
@@ -1551,6 +1534,33 @@ Vect_line_check_intersection2(struct line_pnts *APoints,
     return intersect;
 }
 
+/*!
+ * \brief Check if 2 lines intersect.
+ *
+ * Points (Points->n_points == 1) are also supported. Safe to call
+ * from several threads with different lines.
+ *
+ * \param APoints first input line 
+ * \param BPoints second input line 
+ * \param with_z 3D, not supported (only if one or both are points)!
+ *
+ * \return 0 no intersection 
+ * \return 1 intersection
+ * \return 2 end points only
+ */
+int
+Vect_line_check_intersection2(struct line_pnts *APoints,
+			      struct line_pnts *BPoints, int with_z)
+{
+    struct line_pnts *IPoints = Vect_new_line_struct();
+    int ret;
+
+    ret = line_check_intersection2(APoints, BPoints, IPoints, with_z);
+    Vect_destroy_line_struct(IPoints);
+
+    return ret;
+}
+
 /*!
  * \brief Get 2 lines intersection points.
  * 
@@ -1569,10 +1579,5 @@ Vect_line_get_intersections2(struct line_pnts *APoints,
 			     struct line_pnts *BPoints,
 			     struct line_pnts *IPoints, int with_z)
 {
-    int ret;
-
-    IPnts = IPoints;
-    ret = Vect_line_check_intersection2(APoints, BPoints, with_z);
-
-    return ret;
+    return line_check_intersection2(APoints, BPoints, IPoints, with_z);
 }
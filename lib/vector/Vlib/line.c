@@ -18,6 +18,8 @@
 #include <grass/vector.h>
 #include <grass/glocale.h>
 
+#include "local_proto.h"
+
 /*!
   \brief Creates and initializes a struct line_pnts (internal use only)
 
@@ -36,7 +38,9 @@ struct line_pnts *Vect__new_line_struct(void);
   lines in memory are needed at the same time, then simply 3 line_pnts
   structures have to be used.
   
-  To free allocated memory call Vect_destroy_line_struct().
+  To free allocated memory call Vect_destroy_line_struct(). The
+  structure may come with the arrays of a structure destroyed before
+  by the same thread (see Vect_free_feature_buffers()).
 
   Calls G_fatal_error() on error.
 
@@ -56,6 +60,9 @@ struct line_pnts *Vect__new_line_struct()
 {
     struct line_pnts *p;
 
+    if ((p = Vect__recycled_line()))
+	return p;
+
     p = (struct line_pnts *)malloc(sizeof(struct line_pnts));
 
     /* alloc_points MUST be initialized to zero */
@@ -77,6 +84,8 @@ struct line_pnts *Vect__new_line_struct()
 void Vect_destroy_line_struct(struct line_pnts *p)
 {
     if (p) {			/* probably a moot test */
+	if (Vect__recycle_line(p))
+	    return;
 	if (p->alloc_points) {
 	    G_free((char *)p->x);
 	    G_free((char *)p->y);
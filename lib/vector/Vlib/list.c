@@ -20,6 +20,8 @@
 #include <stdlib.h>
 #include <grass/vector.h>
 
+#include "local_proto.h"
+
 /**
  * \brief Creates and initializes a struct ilist.
  *
@@ -226,6 +228,9 @@ struct boxlist *Vect_new_boxlist(int have_boxes)
 {
     struct boxlist *p;
 
+    if ((p = Vect__recycled_boxlist(have_boxes)))
+	return p;
+
     p = (struct boxlist *)G_malloc(sizeof(struct boxlist));
 
     if (p) {
@@ -265,6 +270,8 @@ int Vect_reset_boxlist(struct boxlist *list)
 void Vect_destroy_boxlist(struct boxlist *list)
 {
     if (list) {			/* probably a moot test */
+	if (Vect__recycle_boxlist(list))
+	    return;
 	if (list->alloc_values) {
 	    G_free((void *)list->id);
 	    if (list->box)
@@ -15,6 +15,16 @@
 #define TEMPORARY_MAP_ENV      1
 #define TEMPORARY_MAP          2
 
+/* the state of Vect_line_intersection2() is per thread, so that lines
+   can be intersected by several threads at the same time, see
+   break_lines.c */
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#define HAVE_THREAD_LOCAL 1
+#else
+#define THREAD_LOCAL
+#endif
+
 /* Internal vector library subroutines which are not part of public
    API*/
 
@@ -22,6 +32,9 @@
 int Vect__get_area_points(const struct Map_info *, const plus_t *, int, struct line_pnts *);
 int Vect__get_area_points_nat(const struct Map_info *, const plus_t *, int, struct line_pnts *);
 
+/* build.c */
+void Vect__add_topo_batch_box(struct Plus_head *, const struct bound_box *);
+
 /* close.c */
 void Vect__free_cache(struct Format_info_cache *);
 void Vect__free_offset(struct Format_info_offset *);
@@ -32,18 +45,37 @@ int Vect__copy_areas(const struct Map_info *, int, struct Map_info *);
 /* map.c */
 int Vect__delete(const char *, int);
 
+/* net_ch.c */
+int Vect__net_ch_shortest_path(struct Map_info *, int, int, dglSPReport_s **,
+                               dglInt32_t *);
+void Vect__net_ch_free_report(dglSPReport_s *);
+
 /* open.c */
 int Vect__open_old(struct Map_info *, const char *, const char *,
                    const char *, int, int, int);
 char *Vect__get_path(char *, const struct Map_info *);
 char *Vect__get_element_path(char *, const struct Map_info *, const char *);
 
+/* recycle.c */
+struct line_pnts *Vect__recycled_line(void);
+int Vect__recycle_line(struct line_pnts *);
+struct line_cats *Vect__recycled_cats(void);
+int Vect__recycle_cats(struct line_cats *);
+struct boxlist *Vect__recycled_boxlist(int);
+int Vect__recycle_boxlist(struct boxlist *);
+
+/* read_nat.c */
+int Vect__read_line_nat(struct Map_info *, struct gvfile *,
+                        struct line_pnts *, struct line_cats *, off_t);
+
 /* write_nat.c */
 int V2__add_line_to_topo_nat(struct Map_info *, off_t, int,
                              const struct line_pnts *, const struct line_cats *, int,
                              int (*external_routine) (const struct Map_info *, int));
 int V2__delete_line_from_topo_nat(struct Map_info *, int, int,
                                   const struct line_pnts *, const struct line_cats *);
+void V2__delete_area_cats_from_cidx_nat(struct Map_info *, int);
+void V2__add_area_cats_to_cidx_nat(struct Map_info *, int);
 
 /* write_sfa.c */
 off_t V2__write_area_sfa(struct Map_info *, const struct line_pnts **, int,
@@ -530,6 +530,7 @@ int Vect__delete(const char *map, int is_tmp)
 		  tmp, strerror(errno));
         return -1;
     }
+    G_element_index_changed(GV_DIRECTORY, mapset);
 
     return 0;
 }
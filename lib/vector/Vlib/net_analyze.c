@@ -18,6 +18,8 @@
 #include <grass/vector.h>
 #include <grass/glocale.h>
 
+#include "local_proto.h"
+
 static int From_node;		/* from node set in SP and used by clipper for first arc */
 
 static int clipper(dglGraph_s * pgraph,
@@ -140,7 +142,7 @@ static int find_shortest_path(struct Map_info *Map, int from, int to,
 			      struct ilist *List, double *cost, int UseTtb,
 			      int tucfield)
 {
-    int *pclip, cArc, nRet;
+    int *pclip, cArc, nRet, in_ch;
     dglSPReport_s *pSPReport;
     dglInt32_t nDistance;
     int use_cache = 1;		/* set to 0 to disable dglib cache */
@@ -160,9 +162,15 @@ static int find_shortest_path(struct Map_info *Map, int from, int to,
 	return 0;
     }
 
-    From_node = from;
-    pclip = NULL;
-    if (List != NULL) {
+    /* search the contraction hierarchy if there is one, the graph
+       if from or to are not in the hierarchy */
+    in_ch = Map->dgraph.ch != NULL &&
+	(nRet = Vect__net_ch_shortest_path(Map, from, to,
+					   List != NULL ? &pSPReport : NULL,
+					   &nDistance)) >= 0;
+    if (!in_ch && List != NULL) {
+	From_node = from;
+	pclip = NULL;
 	if (use_cache) {
 	    nRet =
 		dglShortestPath(&(Map->dgraph.graph_s), &pSPReport,
@@ -176,7 +184,9 @@ static int find_shortest_path(struct Map_info *Map, int from, int to,
 				pclip, NULL);
 	}
     }
-    else {
+    else if (!in_ch) {
+	From_node = from;
+	pclip = NULL;
 	if (use_cache) {
 	    nRet =
 		dglShortestDistance(&(Map->dgraph.graph_s), &nDistance,
@@ -220,7 +230,10 @@ static int find_shortest_path(struct Map_info *Map, int from, int to,
 
     if (List != NULL) {
 	cArc = pSPReport->cArc;
-	dglFreeSPReport(&(Map->dgraph.graph_s), pSPReport);
+	if (in_ch)
+	    Vect__net_ch_free_report(pSPReport);
+	else
+	    dglFreeSPReport(&(Map->dgraph.graph_s), pSPReport);
     }
     else
 	cArc = 0;
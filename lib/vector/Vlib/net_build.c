@@ -101,6 +101,8 @@ Vect_net_ttb_build_graph(struct Map_info *Map,
     G_message(_("Building graph..."));
 
     Map->dgraph.line_type = ltype;
+    /* the hierarchy is that of the previous graph */
+    Vect_net_ch_release(Map);
 
     Points = Vect_new_line_struct();
     Cats = Vect_new_cats_struct();
@@ -727,6 +729,8 @@ Vect_net_build_graph(struct Map_info *Map,
     G_message(_("Building graph..."));
 
     Map->dgraph.line_type = ltype;
+    /* the hierarchy is that of the previous graph */
+    Vect_net_ch_release(Map);
 
     Points = Vect_new_line_struct();
     Cats = Vect_new_cats_struct();
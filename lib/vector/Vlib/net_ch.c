@@ -0,0 +1,962 @@
+/*!
+   \file lib/vector/Vlib/net_ch.c
+
+   \brief Vector library - contraction hierarchy of the network graph
+
+   Higher level functions for reading/writing/manipulating vectors.
+
+   The nodes of the flattened graph built by Vect_net_build_graph() or
+   Vect_net_ttb_build_graph() are contracted one after the other. When
+   a node is contracted, shortcut arcs are added between its remaining
+   neighbours for each path through the node which is the only shortest
+   one, so that shortest path costs between the remaining nodes do not
+   change. The order of contraction is the rank of the node. A query is
+   then a bidirectional Dijkstra search from both ends which only
+   follows arcs to nodes of higher rank; it settles a few hundred nodes
+   instead of a large part of the network.
+
+   Node costs are added to the arcs leaving the node and closed nodes
+   are never passed through, so that the costs are the same as those of
+   the clipper in net_analyze.c.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <grass/vector.h>
+#include <grass/glocale.h>
+
+#include "local_proto.h"
+
+#define CH_INF   0x3fffffffffffffffLL
+#define CH_MAGIC "GVCH"
+#define CH_VERSION 1
+#define CH_BYTE_ORDER 0x01020304
+
+/* maximum number of nodes settled by a witness search, when the
+   shortcuts are only counted and when they are added */
+#define SIMULATE_SETTLED 20
+#define WITNESS_SETTLED 500
+
+struct ch_arc
+{
+    int from, to;		/* node indices */
+    long long cost;		/* edge cost plus cost of the from node */
+    int child[2];		/* arcs of a shortcut, -1 for an edge */
+    int edge;			/* edge in the out edgeset of from, -1 for a shortcut */
+};
+
+struct ch_heap_item
+{
+    long long key;
+    int node;
+};
+
+struct ch_heap
+{
+    int n, alloc;
+    struct ch_heap_item *items;
+};
+
+struct ch_list
+{
+    int n, alloc;
+    int *arcs;
+};
+
+struct net_ch
+{
+    int n_nodes;
+    dglInt32_t *ids;		/* sorted node ids */
+    long long *ncost;		/* cost of leaving the node */
+    char *closed;		/* node can not be passed through */
+    int *edge_first;		/* first out edge of the node in edges */
+    dglInt32_t **edges;		/* out edges of all nodes */
+    unsigned int checksum;	/* of the graph */
+
+    int *rank;
+    int n_arcs, alloc_arcs;
+    struct ch_arc *arcs;
+    int *up_first, *up;		/* arcs to nodes of higher rank, by from */
+    int *down_first, *down;	/* arcs from nodes of higher rank, by to */
+
+    /* query workspace */
+    long long *dist[2];
+    int *pred[2];
+    int *touched, n_touched;
+    struct ch_heap heap[2];
+    int *stack, alloc_stack;
+};
+
+/* state of the contraction */
+struct ch_build
+{
+    struct ch_list *out, *in;
+    char *contracted;
+    int *deleted;		/* contracted neighbours */
+    long long *wdist;		/* witness search */
+    int *wtouched, n_wtouched;
+    struct ch_heap wheap;
+};
+
+static void heap_push(struct ch_heap *heap, long long key, int node)
+{
+    int i, j;
+
+    if (heap->n == heap->alloc) {
+	heap->alloc = heap->alloc ? 2 * heap->alloc : 64;
+	heap->items = G_realloc(heap->items,
+				heap->alloc * sizeof(struct ch_heap_item));
+    }
+    i = heap->n++;
+    while (i > 0) {
+	j = (i - 1) / 2;
+	if (heap->items[j].key <= key)
+	    break;
+	heap->items[i] = heap->items[j];
+	i = j;
+    }
+    heap->items[i].key = key;
+    heap->items[i].node = node;
+}
+
+static int heap_pop(struct ch_heap *heap, long long *key, int *node)
+{
+    int i, j;
+    struct ch_heap_item last;
+
+    if (heap->n == 0)
+	return 0;
+
+    *key = heap->items[0].key;
+    *node = heap->items[0].node;
+
+    last = heap->items[--heap->n];
+    i = 0;
+    while ((j = 2 * i + 1) < heap->n) {
+	if (j + 1 < heap->n && heap->items[j + 1].key < heap->items[j].key)
+	    j++;
+	if (last.key <= heap->items[j].key)
+	    break;
+	heap->items[i] = heap->items[j];
+	i = j;
+    }
+    heap->items[i] = last;
+
+    return 1;
+}
+
+static void list_append(struct ch_list *list, int arc)
+{
+    if (list->n == list->alloc) {
+	list->alloc = list->alloc ? 2 * list->alloc : 4;
+	list->arcs = G_realloc(list->arcs, list->alloc * sizeof(int));
+    }
+    list->arcs[list->n++] = arc;
+}
+
+static int cmp_id(const void *pa, const void *pb)
+{
+    dglInt32_t a = *(const dglInt32_t *)pa;
+    dglInt32_t b = *(const dglInt32_t *)pb;
+
+    return (a > b) - (a < b);
+}
+
+static int node_index(const struct net_ch *ch, dglInt32_t id)
+{
+    dglInt32_t *p;
+
+    p = bsearch(&id, ch->ids, ch->n_nodes, sizeof(dglInt32_t), cmp_id);
+
+    return p ? (int)(p - ch->ids) : -1;
+}
+
+static unsigned int hash_int(unsigned int hash, dglInt32_t value)
+{
+    int i;
+
+    /* FNV-1a */
+    for (i = 0; i < 4; i++) {
+	hash ^= (value >> (8 * i)) & 0xff;
+	hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/* read nodes, node costs and out edges of the graph */
+static struct net_ch *read_graph(dglGraph_s * gr)
+{
+    struct net_ch *ch;
+    dglNodeTraverser_s nt;
+    dglEdgesetTraverser_s et;
+    dglInt32_t *node, *edge, cost;
+    int i, n, n_edges, alloc, have_node_costs;
+    unsigned int hash;
+
+    ch = G_calloc(1, sizeof(struct net_ch));
+    ch->n_nodes = dglGet_NodeCount(gr);
+    ch->ids = G_malloc((ch->n_nodes + 1) * sizeof(dglInt32_t));
+
+    n = 0;
+    dglNode_T_Initialize(&nt, gr);
+    for (node = dglNode_T_First(&nt); node && n < ch->n_nodes;
+	 node = dglNode_T_Next(&nt))
+	ch->ids[n++] = dglNodeGet_Id(gr, node);
+    dglNode_T_Release(&nt);
+    ch->n_nodes = n;
+    qsort(ch->ids, n, sizeof(dglInt32_t), cmp_id);
+
+    ch->ncost = G_malloc((n + 1) * sizeof(long long));
+    ch->closed = G_malloc(n + 1);
+    ch->edge_first = G_malloc((n + 1) * sizeof(int));
+
+    have_node_costs = dglGet_NodeAttrSize(gr) > 0;
+    hash = hash_int(2166136261U, n);
+
+    n_edges = alloc = 0;
+    for (i = 0; i < n; i++) {
+	node = dglGetNode(gr, ch->ids[i]);
+	cost = 0;
+	if (have_node_costs)
+	    memcpy(&cost, dglNodeGet_Attr(gr, node), sizeof(cost));
+	ch->closed[i] = cost == -1;
+	ch->ncost[i] = cost > 0 ? cost : 0;
+	hash = hash_int(hash_int(hash, ch->ids[i]), cost);
+
+	ch->edge_first[i] = n_edges;
+	dglEdgeset_T_Initialize(&et, gr, dglNodeGet_OutEdgeset(gr, node));
+	for (edge = dglEdgeset_T_First(&et); edge;
+	     edge = dglEdgeset_T_Next(&et)) {
+	    if (n_edges == alloc) {
+		alloc = alloc ? 2 * alloc : 1024;
+		ch->edges = G_realloc(ch->edges, alloc * sizeof(dglInt32_t *));
+	    }
+	    ch->edges[n_edges++] = edge;
+	    hash = hash_int(hash, dglNodeGet_Id(gr, dglEdgeGet_Tail(gr, edge)));
+	    hash = hash_int(hash, dglEdgeGet_Cost(gr, edge));
+	    hash = hash_int(hash, dglEdgeGet_Id(gr, edge));
+	}
+	dglEdgeset_T_Release(&et);
+    }
+    ch->edge_first[n] = n_edges;
+    ch->checksum = hash;
+
+    return ch;
+}
+
+/* add an arc or lower the cost of an existing one from to */
+static void add_arc(struct net_ch *ch, struct ch_build *b, int from, int to,
+		    long long cost, int child0, int child1, int edge)
+{
+    int i, a;
+    struct ch_arc *arc;
+
+    for (i = 0; i < b->out[from].n; i++) {
+	a = b->out[from].arcs[i];
+	if (ch->arcs[a].to == to) {
+	    arc = &ch->arcs[a];
+	    if (cost < arc->cost) {
+		arc->cost = cost;
+		arc->child[0] = child0;
+		arc->child[1] = child1;
+		arc->edge = edge;
+	    }
+	    return;
+	}
+    }
+
+    if (ch->n_arcs == ch->alloc_arcs) {
+	ch->alloc_arcs = ch->alloc_arcs ? 2 * ch->alloc_arcs : 1024;
+	ch->arcs = G_realloc(ch->arcs, ch->alloc_arcs * sizeof(struct ch_arc));
+    }
+    a = ch->n_arcs++;
+    arc = &ch->arcs[a];
+    arc->from = from;
+    arc->to = to;
+    arc->cost = cost;
+    arc->child[0] = child0;
+    arc->child[1] = child1;
+    arc->edge = edge;
+
+    list_append(&b->out[from], a);
+    list_append(&b->in[to], a);
+}
+
+/* costs of paths from start not through skip, up to max */
+static void witness_search(struct net_ch *ch, struct ch_build *b,
+			   int start, int skip, long long max, int limit)
+{
+    int i, a, x, y, settled;
+    long long key, d;
+
+    b->wdist[start] = 0;
+    b->wtouched[b->n_wtouched++] = start;
+    b->wheap.n = 0;
+    heap_push(&b->wheap, 0, start);
+    settled = 0;
+
+    while (heap_pop(&b->wheap, &key, &x)) {
+	if (key > b->wdist[x])
+	    continue;
+	if (key > max || ++settled > limit)
+	    break;
+	/* closed nodes can only be left at the start */
+	if (x != start && ch->closed[x])
+	    continue;
+	for (i = 0; i < b->out[x].n; i++) {
+	    a = b->out[x].arcs[i];
+	    y = ch->arcs[a].to;
+	    if (y == skip || b->contracted[y])
+		continue;
+	    d = key + ch->arcs[a].cost;
+	    if (d < b->wdist[y]) {
+		if (b->wdist[y] == CH_INF)
+		    b->wtouched[b->n_wtouched++] = y;
+		b->wdist[y] = d;
+		heap_push(&b->wheap, d, y);
+	    }
+	}
+    }
+}
+
+static void witness_reset(struct ch_build *b)
+{
+    while (b->n_wtouched > 0)
+	b->wdist[b->wtouched[--b->n_wtouched]] = CH_INF;
+}
+
+/* count, and add if requested, shortcuts needed to contract node v */
+static int contract_node(struct net_ch *ch, struct ch_build *b, int v,
+			 int add)
+{
+    int i, j, a, o, u, w, n_targets, n_shortcuts;
+    long long max, cost;
+
+    /* no shortest path goes through a closed node */
+    if (ch->closed[v])
+	return 0;
+
+    n_shortcuts = 0;
+    for (i = 0; i < b->in[v].n; i++) {
+	a = b->in[v].arcs[i];
+	u = ch->arcs[a].from;
+	if (b->contracted[u])
+	    continue;
+
+	max = 0;
+	n_targets = 0;
+	for (j = 0; j < b->out[v].n; j++) {
+	    o = b->out[v].arcs[j];
+	    w = ch->arcs[o].to;
+	    if (w == u || b->contracted[w])
+		continue;
+	    cost = ch->arcs[a].cost + ch->arcs[o].cost;
+	    if (cost > max)
+		max = cost;
+	    n_targets++;
+	}
+	if (n_targets == 0)
+	    continue;
+
+	witness_search(ch, b, u, v, max,
+		       add ? WITNESS_SETTLED : SIMULATE_SETTLED);
+
+	for (j = 0; j < b->out[v].n; j++) {
+	    o = b->out[v].arcs[j];
+	    w = ch->arcs[o].to;
+	    if (w == u || b->contracted[w])
+		continue;
+	    cost = ch->arcs[a].cost + ch->arcs[o].cost;
+	    if (b->wdist[w] > cost) {
+		n_shortcuts++;
+		if (add)
+		    add_arc(ch, b, u, w, cost, a, o, -1);
+	    }
+	}
+	witness_reset(b);
+    }
+
+    return n_shortcuts;
+}
+
+static long long node_priority(struct net_ch *ch, struct ch_build *b, int v)
+{
+    int i, degree;
+
+    degree = 0;
+    for (i = 0; i < b->in[v].n; i++) {
+	if (!b->contracted[ch->arcs[b->in[v].arcs[i]].from])
+	    degree++;
+    }
+    for (i = 0; i < b->out[v].n; i++) {
+	if (!b->contracted[ch->arcs[b->out[v].arcs[i]].to])
+	    degree++;
+    }
+
+    /* edge difference plus contracted neighbours spreads the
+       contraction evenly over the network */
+    return 2 * ((long long)contract_node(ch, b, v, 0) - degree) +
+	b->deleted[v];
+}
+
+/* sort arcs into the upward and downward search graphs */
+static void make_search_graphs(struct net_ch *ch)
+{
+    int i, a, n;
+    struct ch_arc *arc;
+
+    n = ch->n_nodes;
+    ch->up_first = G_calloc(n + 1, sizeof(int));
+    ch->down_first = G_calloc(n + 1, sizeof(int));
+    ch->up = G_malloc((ch->n_arcs + 1) * sizeof(int));
+    ch->down = G_malloc((ch->n_arcs + 1) * sizeof(int));
+
+    for (a = 0; a < ch->n_arcs; a++) {
+	arc = &ch->arcs[a];
+	if (ch->rank[arc->from] < ch->rank[arc->to])
+	    ch->up_first[arc->from + 1]++;
+	else
+	    ch->down_first[arc->to + 1]++;
+    }
+    for (i = 0; i < n; i++) {
+	ch->up_first[i + 1] += ch->up_first[i];
+	ch->down_first[i + 1] += ch->down_first[i];
+    }
+    for (a = 0; a < ch->n_arcs; a++) {
+	arc = &ch->arcs[a];
+	if (ch->rank[arc->from] < ch->rank[arc->to])
+	    ch->up[ch->up_first[arc->from]++] = a;
+	else
+	    ch->down[ch->down_first[arc->to]++] = a;
+    }
+    for (i = n; i > 0; i--) {
+	ch->up_first[i] = ch->up_first[i - 1];
+	ch->down_first[i] = ch->down_first[i - 1];
+    }
+    ch->up_first[0] = ch->down_first[0] = 0;
+
+    ch->dist[0] = G_malloc((n + 1) * sizeof(long long));
+    ch->dist[1] = G_malloc((n + 1) * sizeof(long long));
+    ch->pred[0] = G_malloc((n + 1) * sizeof(int));
+    ch->pred[1] = G_malloc((n + 1) * sizeof(int));
+    ch->touched = G_malloc((n + 1) * sizeof(int));
+    for (i = 0; i < n; i++)
+	ch->dist[0][i] = ch->dist[1][i] = CH_INF;
+}
+
+static void contract(struct net_ch *ch, dglGraph_s * gr)
+{
+    struct ch_build b;
+    int i, j, k, n, v, w, rank;
+    long long key, *prio;
+
+    n = ch->n_nodes;
+    prio = G_malloc((n + 1) * sizeof(long long));
+    b.out = G_calloc(n + 1, sizeof(struct ch_list));
+    b.in = G_calloc(n + 1, sizeof(struct ch_list));
+    b.contracted = G_calloc(n + 1, 1);
+    b.deleted = G_calloc(n + 1, sizeof(int));
+    b.wdist = G_malloc((n + 1) * sizeof(long long));
+    b.wtouched = G_malloc((n + 1) * sizeof(int));
+    b.n_wtouched = 0;
+    b.wheap.n = b.wheap.alloc = 0;
+    b.wheap.items = NULL;
+    for (i = 0; i < n; i++)
+	b.wdist[i] = CH_INF;
+
+    /* edges of the graph, parallel edges are reduced to the cheapest */
+    for (i = 0; i < n; i++) {
+	for (k = ch->edge_first[i]; k < ch->edge_first[i + 1]; k++) {
+	    w = node_index(ch, dglNodeGet_Id(gr,
+					     dglEdgeGet_Tail(gr,
+							     ch->edges[k])));
+	    if (w < 0 || w == i)
+		continue;
+	    add_arc(ch, &b, i, w,
+		    dglEdgeGet_Cost(gr, ch->edges[k]) + ch->ncost[i],
+		    -1, -1, k - ch->edge_first[i]);
+	}
+    }
+
+    G_message(_("Contracting %d network nodes..."), n);
+
+    ch->rank = G_malloc((n + 1) * sizeof(int));
+    {
+	struct ch_heap queue = { 0, 0, NULL };
+
+	for (v = 0; v < n; v++) {
+	    prio[v] = node_priority(ch, &b, v);
+	    heap_push(&queue, prio[v], v);
+	}
+
+	rank = 0;
+	while (heap_pop(&queue, &key, &v)) {
+	    if (b.contracted[v] || key != prio[v])
+		continue;
+	    /* lazy update */
+	    prio[v] = node_priority(ch, &b, v);
+	    if (queue.n > 0 && prio[v] > queue.items[0].key) {
+		heap_push(&queue, prio[v], v);
+		continue;
+	    }
+	    G_percent(rank, n, 2);
+
+	    contract_node(ch, &b, v, 1);
+	    b.contracted[v] = 1;
+	    ch->rank[v] = rank++;
+
+	    for (j = 0; j < b.in[v].n; j++)
+		b.deleted[ch->arcs[b.in[v].arcs[j]].from]++;
+	    for (j = 0; j < b.out[v].n; j++)
+		b.deleted[ch->arcs[b.out[v].arcs[j]].to]++;
+	}
+	G_percent(1, 1, 1);
+	G_free(queue.items);
+    }
+
+    for (i = 0; i < n; i++) {
+	G_free(b.out[i].arcs);
+	G_free(b.in[i].arcs);
+    }
+    G_free(b.out);
+    G_free(b.in);
+    G_free(b.contracted);
+    G_free(b.deleted);
+    G_free(b.wdist);
+    G_free(b.wtouched);
+    G_free(b.wheap.items);
+    G_free(prio);
+
+    G_verbose_message(_("%d shortcuts added to %d network arcs"),
+		      ch->n_arcs - ch->edge_first[n], ch->edge_first[n]);
+}
+
+static int ch_write(const struct net_ch *ch, struct Map_info *Map)
+{
+    char path[GPATH_MAX];
+    FILE *fp;
+    int a, header[6];
+    const struct ch_arc *arc;
+
+    Vect__get_path(path, Map);
+    fp = G_fopen_new(path, GV_NETCH_ELEMENT);
+    if (fp == NULL) {
+	G_warning(_("Unable to create contraction hierarchy file for vector map <%s>"),
+		  Vect_get_name(Map));
+	return 1;
+    }
+
+    header[0] = CH_VERSION;
+    header[1] = CH_BYTE_ORDER;
+    header[2] = (int)ch->checksum;
+    header[3] = ch->n_nodes;
+    header[4] = ch->edge_first[ch->n_nodes];
+    header[5] = ch->n_arcs;
+
+    fwrite(CH_MAGIC, 4, 1, fp);
+    fwrite(header, sizeof(int), 6, fp);
+    fwrite(ch->rank, sizeof(int), ch->n_nodes, fp);
+    for (a = 0; a < ch->n_arcs; a++) {
+	arc = &ch->arcs[a];
+	fwrite(&arc->from, sizeof(int), 1, fp);
+	fwrite(&arc->to, sizeof(int), 1, fp);
+	fwrite(&arc->cost, sizeof(long long), 1, fp);
+	fwrite(arc->child, sizeof(int), 2, fp);
+	fwrite(&arc->edge, sizeof(int), 1, fp);
+    }
+
+    if (fclose(fp) != 0) {
+	G_warning(_("Error writing out contraction hierarchy file"));
+	return 1;
+    }
+
+    return 0;
+}
+
+/* read the hierarchy, 1 if there is none for this graph */
+static int ch_read(struct net_ch *ch, struct Map_info *Map)
+{
+    char path[GPATH_MAX], file_path[GPATH_MAX], magic[4];
+    FILE *fp;
+    int i, ok, header[6];
+    struct ch_arc *arc;
+
+    Vect__get_path(path, Map);
+    Vect__get_element_path(file_path, Map, GV_NETCH_ELEMENT);
+    if (access(file_path, F_OK) != 0)
+	return 1;
+
+    fp = G_fopen_old(path, GV_NETCH_ELEMENT, Map->mapset);
+    if (fp == NULL)
+	return 1;
+
+    /* the hierarchy of another graph is not used */
+    if (fread(magic, 4, 1, fp) != 1 || memcmp(magic, CH_MAGIC, 4) != 0 ||
+	fread(header, sizeof(int), 6, fp) != 6 ||
+	header[0] != CH_VERSION || header[1] != CH_BYTE_ORDER ||
+	(unsigned int)header[2] != ch->checksum ||
+	header[3] != ch->n_nodes || header[4] != ch->edge_first[ch->n_nodes]
+	|| header[5] < header[4]) {
+	G_debug(1, "Contraction hierarchy of <%s> does not match the graph",
+		Vect_get_full_name(Map));
+	fclose(fp);
+	return 1;
+    }
+
+    ch->n_arcs = ch->alloc_arcs = header[5];
+    ch->arcs = G_malloc((ch->n_arcs + 1) * sizeof(struct ch_arc));
+    ch->rank = G_malloc((ch->n_nodes + 1) * sizeof(int));
+
+    ok = fread(ch->rank, sizeof(int), ch->n_nodes, fp) ==
+	(size_t)ch->n_nodes;
+    for (i = 0; ok && i < ch->n_arcs; i++) {
+	arc = &ch->arcs[i];
+	ok = fread(&arc->from, sizeof(int), 1, fp) == 1 &&
+	    fread(&arc->to, sizeof(int), 1, fp) == 1 &&
+	    fread(&arc->cost, sizeof(long long), 1, fp) == 1 &&
+	    fread(arc->child, sizeof(int), 2, fp) == 2 &&
+	    fread(&arc->edge, sizeof(int), 1, fp) == 1;
+	ok = ok && arc->from >= 0 && arc->from < ch->n_nodes &&
+	    arc->to >= 0 && arc->to < ch->n_nodes &&
+	    (arc->edge >= 0 ?
+	     arc->edge < ch->edge_first[arc->from + 1] -
+	     ch->edge_first[arc->from] :
+	     arc->child[0] >= 0 && arc->child[0] < i &&
+	     arc->child[1] >= 0 && arc->child[1] < i);
+    }
+    fclose(fp);
+
+    if (!ok) {
+	G_warning(_("Unable to read contraction hierarchy file of vector map <%s>"),
+		  Vect_get_full_name(Map));
+	G_free(ch->arcs);
+	G_free(ch->rank);
+	ch->arcs = NULL;
+	ch->rank = NULL;
+	ch->n_arcs = ch->alloc_arcs = 0;
+	return 1;
+    }
+
+    return 0;
+}
+
+static void ch_free(struct net_ch *ch)
+{
+    G_free(ch->ids);
+    G_free(ch->ncost);
+    G_free(ch->closed);
+    G_free(ch->edge_first);
+    G_free(ch->edges);
+    G_free(ch->rank);
+    G_free(ch->arcs);
+    G_free(ch->up_first);
+    G_free(ch->up);
+    G_free(ch->down_first);
+    G_free(ch->down);
+    G_free(ch->dist[0]);
+    G_free(ch->dist[1]);
+    G_free(ch->pred[0]);
+    G_free(ch->pred[1]);
+    G_free(ch->touched);
+    G_free(ch->heap[0].items);
+    G_free(ch->heap[1].items);
+    G_free(ch->stack);
+    G_free(ch);
+}
+
+/*!
+   \brief Build contraction hierarchy of the network graph
+
+   Shortest paths and costs found by Vect_net_shortest_path(),
+   Vect_net_ttb_shortest_path() and the functions searching paths
+   between coordinates are then searched in the hierarchy. The costs
+   are the same as without the hierarchy; of several paths with equal
+   costs, another one may be returned.
+
+   The hierarchy is read from the vector map directory if it was saved
+   there for the same graph (the same arcs, costs and node costs).
+   Otherwise it is built, which takes about as long as some thousands
+   of shortest path searches, and saved if <i>save</i> is set and the
+   map is in the current mapset.
+
+   The hierarchy is not used after Vect_net_build_graph() or
+   Vect_net_ttb_build_graph() is called again. Searches in the
+   hierarchy are not thread-safe, like the search cache of DGLib.
+
+   Graphs of version 3 are not supported.
+
+   \param Map vector map with built graph (see Vect_net_build_graph()
+   and Vect_net_ttb_build_graph())
+   \param save save the hierarchy in the vector map directory
+
+   \return 0 on success
+   \return -1 on error
+ */
+int Vect_net_ch_build(struct Map_info *Map, int save)
+{
+    struct net_ch *ch;
+    dglGraph_s *gr;
+
+    gr = &(Map->dgraph.graph_s);
+    if (!(gr->Flags & DGL_GS_FLAT)) {
+	G_warning(_("Network graph is not built"));
+	return -1;
+    }
+
+    /* edges of version 3 can be undirected */
+    if (gr->Version > 2) {
+	G_warning(_("Contraction hierarchy is not supported for graph version %d"),
+		  gr->Version);
+	return -1;
+    }
+
+    Vect_net_ch_release(Map);
+
+    ch = read_graph(gr);
+
+    if (ch_read(ch, Map) == 0) {
+	G_verbose_message(_("Contraction hierarchy read from vector map <%s>"),
+			  Vect_get_full_name(Map));
+    }
+    else {
+	contract(ch, gr);
+	if (save && strcmp(Map->mapset, G_mapset()) == 0 &&
+	    ch_write(ch, Map) == 0)
+	    G_verbose_message(_("Contraction hierarchy saved in vector map <%s>"),
+			      Vect_get_full_name(Map));
+    }
+    make_search_graphs(ch);
+
+    Map->dgraph.ch = ch;
+
+    return 0;
+}
+
+/*!
+   \brief Free contraction hierarchy of the network graph
+
+   Shortest paths are then searched in the graph again.
+
+   \param Map vector map
+ */
+void Vect_net_ch_release(struct Map_info *Map)
+{
+    if (Map->dgraph.ch) {
+	ch_free(Map->dgraph.ch);
+	Map->dgraph.ch = NULL;
+    }
+}
+
+static void set_dist(struct net_ch *ch, int dir, int node, long long d,
+		     int pred)
+{
+    if (ch->dist[0][node] == CH_INF && ch->dist[1][node] == CH_INF)
+	ch->touched[ch->n_touched++] = node;
+    ch->dist[dir][node] = d;
+    ch->pred[dir][node] = pred;
+}
+
+static void stack_push(struct net_ch *ch, int *n, int a)
+{
+    if (*n == ch->alloc_stack) {
+	ch->alloc_stack = ch->alloc_stack ? 2 * ch->alloc_stack : 64;
+	ch->stack = G_realloc(ch->stack, ch->alloc_stack * sizeof(int));
+    }
+    ch->stack[(*n)++] = a;
+}
+
+/* append the edges of arc a to report */
+static void unpack_arc(struct net_ch *ch, int a,
+		       dglSPReport_s * report, int *alloc, long long *dist)
+{
+    int n;
+    struct ch_arc *arc;
+    dglSPArc_s *sparc;
+
+    n = 0;
+    stack_push(ch, &n, a);
+    while (n > 0) {
+	arc = &ch->arcs[ch->stack[--n]];
+	if (arc->edge < 0) {
+	    stack_push(ch, &n, arc->child[1]);
+	    stack_push(ch, &n, arc->child[0]);
+	    continue;
+	}
+	if (report->cArc == *alloc) {
+	    *alloc = *alloc ? 2 * *alloc : 64;
+	    report->pArc = G_realloc(report->pArc, *alloc * sizeof(dglSPArc_s));
+	}
+	*dist += arc->cost;
+	sparc = &report->pArc[report->cArc++];
+	sparc->nFrom = ch->ids[arc->from];
+	sparc->nTo = ch->ids[arc->to];
+	sparc->pnEdge = ch->edges[ch->edge_first[arc->from] + arc->edge];
+	sparc->nDistance = (dglInt32_t) * dist;
+    }
+}
+
+/*!
+   \brief Find shortest path in the contraction hierarchy
+
+   The edges of the report point to the graph, free the report with
+   Vect__net_ch_free_report().
+
+   \param Map vector map with contraction hierarchy
+   \param from from node id
+   \param to to node id, not from
+   \param[out] report shortest path (or NULL)
+   \param[out] distance costs of the path
+
+   \return 1 path found
+   \return 0 destination unreachable
+   \return -1 from or to is not a node of the graph
+ */
+int Vect__net_ch_shortest_path(struct Map_info *Map, int from, int to,
+			       dglSPReport_s ** report,
+			       dglInt32_t * distance)
+{
+    struct net_ch *ch = Map->dgraph.ch;
+    int s, t, x, y, i, a, dir, meet, alloc, n_path, *path;
+    long long key, d, best;
+
+    s = node_index(ch, from);
+    t = node_index(ch, to);
+    if (s < 0 || t < 0)
+	return -1;
+
+    ch->n_touched = 0;
+    ch->heap[0].n = ch->heap[1].n = 0;
+    set_dist(ch, 0, s, 0, -1);
+    heap_push(&ch->heap[0], 0, s);
+    set_dist(ch, 1, t, 0, -1);
+    heap_push(&ch->heap[1], 0, t);
+
+    best = CH_INF;
+    meet = -1;
+    dir = 1;
+    while (ch->heap[0].n > 0 || ch->heap[1].n > 0) {
+	/* alternate the directions */
+	if (ch->heap[1 - dir].n > 0)
+	    dir = 1 - dir;
+	heap_pop(&ch->heap[dir], &key, &x);
+	if (key > ch->dist[dir][x])
+	    continue;
+	if (key >= best) {
+	    /* nothing shorter in this direction */
+	    ch->heap[dir].n = 0;
+	    continue;
+	}
+	d = ch->dist[1 - dir][x];
+	if (d != CH_INF && key + d < best) {
+	    best = key + d;
+	    meet = x;
+	}
+
+	if (dir == 0) {
+	    /* closed nodes can only be left at the start */
+	    if (x != s && ch->closed[x])
+		continue;
+	    /* stall on demand: x is reached cheaper from a node of
+	       higher rank, nothing is found from x */
+	    for (i = ch->down_first[x]; i < ch->down_first[x + 1]; i++) {
+		a = ch->down[i];
+		y = ch->arcs[a].from;
+		if (ch->dist[0][y] != CH_INF && (y == s || !ch->closed[y]) &&
+		    ch->dist[0][y] + ch->arcs[a].cost < key)
+		    break;
+	    }
+	    if (i < ch->down_first[x + 1])
+		continue;
+	    for (i = ch->up_first[x]; i < ch->up_first[x + 1]; i++) {
+		a = ch->up[i];
+		y = ch->arcs[a].to;
+		d = key + ch->arcs[a].cost;
+		if (d < ch->dist[0][y]) {
+		    set_dist(ch, 0, y, d, a);
+		    heap_push(&ch->heap[0], d, y);
+		}
+	    }
+	}
+	else {
+	    if (x != t && ch->closed[x])
+		continue;
+	    for (i = ch->up_first[x]; i < ch->up_first[x + 1]; i++) {
+		a = ch->up[i];
+		y = ch->arcs[a].to;
+		if (ch->dist[1][y] != CH_INF &&
+		    ch->dist[1][y] + ch->arcs[a].cost < key)
+		    break;
+	    }
+	    if (i < ch->up_first[x + 1])
+		continue;
+	    for (i = ch->down_first[x]; i < ch->down_first[x + 1]; i++) {
+		a = ch->down[i];
+		y = ch->arcs[a].from;
+		if (y != s && ch->closed[y])
+		    continue;
+		d = key + ch->arcs[a].cost;
+		if (d < ch->dist[1][y]) {
+		    set_dist(ch, 1, y, d, a);
+		    heap_push(&ch->heap[1], d, y);
+		}
+	    }
+	}
+    }
+
+    if (meet >= 0) {
+	/* the start is left without its node costs */
+	*distance = (dglInt32_t) (best - ch->ncost[s]);
+
+	if (report) {
+	    *report = G_calloc(1, sizeof(dglSPReport_s));
+	    (*report)->nStartNode = from;
+	    (*report)->nDestinationNode = to;
+	    (*report)->nDistance = *distance;
+
+	    path = G_malloc((2 * ch->n_touched + 1) * sizeof(int));
+	    n_path = 0;
+	    for (x = meet; ch->pred[0][x] >= 0;
+		 x = ch->arcs[ch->pred[0][x]].from)
+		path[n_path++] = ch->pred[0][x];
+	    for (i = 0; i < n_path / 2; i++) {
+		a = path[i];
+		path[i] = path[n_path - 1 - i];
+		path[n_path - 1 - i] = a;
+	    }
+	    for (x = meet; ch->pred[1][x] >= 0;
+		 x = ch->arcs[ch->pred[1][x]].to)
+		path[n_path++] = ch->pred[1][x];
+
+	    alloc = 0;
+	    d = -ch->ncost[s];
+	    for (i = 0; i < n_path; i++)
+		unpack_arc(ch, path[i], *report, &alloc, &d);
+	    G_free(path);
+	}
+    }
+
+    for (i = 0; i < ch->n_touched; i++) {
+	x = ch->touched[i];
+	ch->dist[0][x] = ch->dist[1][x] = CH_INF;
+    }
+
+    return meet >= 0;
+}
+
+/*!
+   \brief Free shortest path report of Vect__net_ch_shortest_path()
+
+   \param report shortest path
+ */
+void Vect__net_ch_free_report(dglSPReport_s * report)
+{
+    G_free(report->pArc);
+    G_free(report);
+}
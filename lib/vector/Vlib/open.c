@@ -1250,6 +1250,14 @@ int Vect_open_sidx(struct Map_info *Map, int mode)
             fclose(Plus->spidx_fp.file);
             return -1;
         }
+
+        /* file based indices are searched in the mapped sidx file */
+        if (mode == 0) {
+            const char *mmap_env = getenv("GRASS_VECTOR_MMAP");
+
+            if (!mmap_env || atoi(mmap_env) != 0)
+                dig_file_map(&(Plus->spidx_fp));
+        }
     }
 
     if (mode) {
@@ -14,6 +14,7 @@
   \author Update to GRASS 5.7 Radim Blazek and David D. Gray.
  */
 
+#include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -76,9 +77,17 @@ int V1_open_old_nat(struct Map_info *Map, int update)
     dig_init_portable(&(Map->head.port), Map->head.port.byte_order);
 
     /* load to memory */
-    if (!update)
+    if (!update) {
+	const char *mmap_env = getenv("GRASS_VECTOR_MMAP");
+
 	dig_file_load(&(Map->dig_fp)); /* has currently no effect, file never loaded */
 
+	/* features are then read from the mapping: native byte order
+	   coordinates are copied from it straight into line_pnts */
+	if (!mmap_env || atoi(mmap_env) != 0)
+	    dig_file_map(&(Map->dig_fp));
+    }
+
     return 0;
 }
 
@@ -68,12 +68,19 @@ int Vect__clean_grass_db_topo(struct Format_info_pg *);
 SF_FeatureType Vect__cache_feature_pg(const char *, int, int,
                                       struct Format_info_cache *,
                                       struct feat_parts *);
+SF_FeatureType Vect__cache_feature_res_pg(const PGresult *, int, int, int, int,
+                                          struct Format_info_cache *,
+                                          struct feat_parts *);
 int Vect__open_cursor_next_line_pg(struct Format_info_pg *, int, int);
 int Vect__open_cursor_line_pg(struct Format_info_pg *, int, int);
 int Vect__close_cursor_pg(struct Format_info_pg *);
 int Vect__select_line_pg(struct Format_info_pg *, int, int);
+int Vect__fetch_cursor_pg(struct Format_info_pg *, int);
+void Vect__sync_pg(PGconn *);
+int Vect__get_int_pg(const PGresult *, int, int);
 int Vect__execute_pg(PGconn *, const char *);
 int Vect__execute_get_value_pg(PGconn *, const char *);
+int Vect__end_copy_pg(PGconn *);
 void Vect__reallocate_cache(struct Format_info_cache *, int, int);
 
 /* write_pg.c */
@@ -20,6 +20,8 @@
 #include <grass/linkm.h>
 #include <grass/glocale.h>
 
+#include "local_proto.h"
+
 struct Slink
 {
     struct Slink *next;
@@ -458,8 +460,9 @@ int Vect_get_point_in_poly_isl(const struct line_pnts *Points,
 			       const struct line_pnts **IPoints, int n_isles,
 			       double *att_x, double *att_y)
 {
-    static struct line_pnts *Intersects;
-    static int first_time = 1;
+    /* per thread, points in polygons may be searched by several threads */
+    static THREAD_LOCAL struct line_pnts *Intersects;
+    static THREAD_LOCAL int first_time = 1;
     double cent_x, cent_y;
     register int i, j;
     double max, hi_x, lo_x, hi_y, lo_y;
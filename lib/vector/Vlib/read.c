@@ -19,6 +19,9 @@
 #include <grass/vector.h>
 #include <grass/glocale.h>
 
+/* performance counter, see G_perf_count() */
+static int perf_features;
+
 static int read_dummy()
 {
     G_warning("Vect_read_line() %s",
@@ -132,6 +135,7 @@ int Vect_read_next_line(const struct Map_info *Map,
     
     ret = (*Read_next_line_array[Map->format][Map->level]) (Map, line_p,
 							    line_c);
+    G_perf_count(&perf_features, "vector.features_read", 1);
     if (ret == -1)
         G_warning(_("Unable to read feature %d from vector map <%s>"),
                   Map->next_line, Vect_get_full_name(Map));
@@ -175,6 +179,7 @@ int Vect_read_line(const struct Map_info *Map,
     }
     
     ret = (*Read_line_array[Map->format]) (Map, line_p, line_c, line);
+    G_perf_count(&perf_features, "vector.features_read", 1);
 
     if (ret == -1)
 	G_warning(_("Unable to read feature %d from vector map <%s>"),
@@ -19,6 +19,8 @@
 #include <grass/vector.h>
 #include <grass/glocale.h>
 
+#include "local_proto.h"
+
 static int read_line_nat(struct Map_info *,
 			 struct line_pnts *, struct line_cats *, off_t);
 
@@ -248,6 +250,32 @@ int V2_read_next_line_nat(struct Map_info *Map,
 */
 int read_line_nat(struct Map_info *Map,
 		  struct line_pnts *p, struct line_cats *c, off_t offset)
+{
+    Map->head.last_offset = offset;
+
+    return Vect__read_line_nat(Map, &(Map->dig_fp), p, c, offset);
+}
+
+/*!  
+  \brief Read line from coor file at given position (internal use only)
+
+  The coor file is read with the file position of <i>fp</i>, which is
+  the coor file of the map or of a reader, see Vect_new_reader().
+  
+  \param Map vector map layer
+  \param fp coor file
+  \param[out] p container used to store line points within
+  \param[out] c container used to store line categories within
+  \param offset given offset
+  
+  \return line type ( > 0 )
+  \return 0 dead line
+  \return -1 out of memory
+  \return -2 end of file
+*/
+int Vect__read_line_nat(struct Map_info *Map, struct gvfile *fp,
+			struct line_pnts *p, struct line_cats *c,
+			off_t offset)
 {
     register int i, dead = 0;
     int n_points;
@@ -259,14 +287,12 @@ int read_line_nat(struct Map_info *Map,
 
     G_debug(3, "Vect__Read_line_nat: offset = %lu", (unsigned long) offset);
 
-    Map->head.last_offset = offset;
-
     /* reads must set in_head, but writes use default */
     dig_set_cur_port(&(Map->head.port));
 
-    dig_fseek(&(Map->dig_fp), offset, 0);
+    dig_fseek(fp, offset, 0);
 
-    if (0 >= dig__fread_port_C(&rhead, 1, &(Map->dig_fp)))
+    if (0 >= dig__fread_port_C(&rhead, 1, fp))
 	return (-2);
 
     if (!(rhead & 0x01))	/* dead line */
@@ -287,11 +313,11 @@ int read_line_nat(struct Map_info *Map,
 
     if (do_cats) {
 	if (Map->head.coor_version.minor == 1) {	/* coor format 5.1 */
-	    if (0 >= dig__fread_port_I(&n_cats, 1, &(Map->dig_fp)))
+	    if (0 >= dig__fread_port_I(&n_cats, 1, fp))
 		return (-2);
 	}
 	else {			/* coor format 5.0 */
-	    if (0 >= dig__fread_port_C(&nc, 1, &(Map->dig_fp)))
+	    if (0 >= dig__fread_port_C(&nc, 1, fp))
 		return (-2);
 	    n_cats = (int)nc;
 	}
@@ -305,17 +331,17 @@ int read_line_nat(struct Map_info *Map,
 
 		if (Map->head.coor_version.minor == 1) {	/* coor format 5.1 */
 		    if (0 >=
-			dig__fread_port_I(c->field, n_cats, &(Map->dig_fp)))
+			dig__fread_port_I(c->field, n_cats, fp))
 			return (-2);
 		}
 		else {		/* coor format 5.0 */
 		    for (i = 0; i < n_cats; i++) {
-			if (0 >= dig__fread_port_S(&field, 1, &(Map->dig_fp)))
+			if (0 >= dig__fread_port_S(&field, 1, fp))
 			    return (-2);
 			c->field[i] = (int)field;
 		    }
 		}
-		if (0 >= dig__fread_port_I(c->cat, n_cats, &(Map->dig_fp)))
+		if (0 >= dig__fread_port_I(c->cat, n_cats, fp))
 		    return (-2);
 
 	    }
@@ -328,7 +354,7 @@ int read_line_nat(struct Map_info *Map,
 		size = (off_t) (PORT_SHORT + PORT_INT) * n_cats;
 	    }
 
-	    dig_fseek(&(Map->dig_fp), size, SEEK_CUR);
+	    dig_fseek(fp, size, SEEK_CUR);
 	}
     }
 
@@ -336,7 +362,7 @@ int read_line_nat(struct Map_info *Map,
 	n_points = 1;
     }
     else {
-	if (0 >= dig__fread_port_I(&n_points, 1, &(Map->dig_fp)))
+	if (0 >= dig__fread_port_I(&n_points, 1, fp))
 	    return (-2);
     }
 
@@ -347,13 +373,13 @@ int read_line_nat(struct Map_info *Map,
 	    return (-1);
 
 	p->n_points = n_points;
-	if (0 >= dig__fread_port_D(p->x, n_points, &(Map->dig_fp)))
+	if (0 >= dig__fread_port_D(p->x, n_points, fp))
 	    return (-2);
-	if (0 >= dig__fread_port_D(p->y, n_points, &(Map->dig_fp)))
+	if (0 >= dig__fread_port_D(p->y, n_points, fp))
 	    return (-2);
 
 	if (Map->head.with_z) {
-	    if (0 >= dig__fread_port_D(p->z, n_points, &(Map->dig_fp)))
+	    if (0 >= dig__fread_port_D(p->z, n_points, fp))
 		return (-2);
 	}
 	else {
@@ -367,10 +393,10 @@ int read_line_nat(struct Map_info *Map,
 	else
 	    size = (off_t) n_points * 2 * PORT_DOUBLE;
 
-	dig_fseek(&(Map->dig_fp), size, SEEK_CUR);
+	dig_fseek(fp, size, SEEK_CUR);
     }
 
-    G_debug(3, "    off = %lu", (unsigned long) dig_ftell(&(Map->dig_fp)));
+    G_debug(3, "    off = %lu", (unsigned long) dig_ftell(fp));
 
     if (dead)
 	return 0;
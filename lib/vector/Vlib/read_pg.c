@@ -39,10 +39,18 @@
 static unsigned char *wkb_data;
 static unsigned int wkb_data_length;
 
+/* cursor with a page of features being prefetched */
+static struct Format_info_pg *fetch_pg_info;
+
 static int read_next_line_pg(struct Map_info *,
                              struct line_pnts *, struct line_cats *, int);
 SF_FeatureType get_feature(struct Map_info *, int, int);
 static unsigned char *hex_to_wkb(const char *, int *);
+static SF_FeatureType cache_feature(unsigned char *, int, int, int,
+                                    struct Format_info_cache *,
+                                    struct feat_parts *);
+static int fetch_page(struct Format_info_pg *, int);
+static int get_fetch_size(void);
 static int point_from_wkb(const unsigned char *, int, int, int,
                           struct line_pnts *);
 static int linestring_from_wkb(const unsigned char *, int, int, int,
@@ -399,7 +407,7 @@ int V2_read_line_pg(struct Map_info *Map, struct line_pnts *line_p,
                 
                 if (!PQgetisnull(pg_info->res, 0, col_idx))
                     cat = pg_info->cache.lines_cats[cache_idx] =
-                        atoi(PQgetvalue(pg_info->res, 0, col_idx)); 
+                        Vect__get_int_pg(pg_info->res, 0, col_idx);
                 else
                     pg_info->cache.lines_cats[cache_idx] = -1; /* no cat */   
             }
@@ -534,7 +542,7 @@ int read_next_line_pg(struct Map_info *Map,
                 
                     if (!PQgetisnull(pg_info->res, pg_info->cache.lines_next-1, col_idx))
                         cat = pg_info->cache.lines_cats[Map->next_line-1] =
-                        atoi(PQgetvalue(pg_info->res, pg_info->cache.lines_next-1, col_idx)); 
+                        Vect__get_int_pg(pg_info->res, pg_info->cache.lines_next-1, col_idx);
                     else
                         pg_info->cache.lines_cats[Map->next_line-1] = -1; /* no cat */ 
                 }
@@ -565,7 +573,6 @@ SF_FeatureType get_feature(struct Map_info *Map, int fid, int type)
 {
     int seq_type;
     int force_type; /* force type (GV_BOUNDARY or GV_CENTROID) for topo access only */
-    char *data;
     
     struct Format_info_pg *pg_info;
 
@@ -607,20 +614,12 @@ SF_FeatureType get_feature(struct Map_info *Map, int fid, int type)
     }
 
     /* do we need to fetch more records ? */
-    if (PQntuples(pg_info->res) == CURSOR_PAGE &&
-        PQntuples(pg_info->res) == pg_info->next_line) {
-        char stmt[DB_SQL_MAX];
-
-        PQclear(pg_info->res);
-
-        sprintf(stmt, "FETCH %d in %s", CURSOR_PAGE, pg_info->cursor_name);
-        G_debug(3, "SQL: %s", stmt);
-        pg_info->res = PQexec(pg_info->conn, stmt);
-        if (!pg_info->res || PQresultStatus(pg_info->res) != PGRES_TUPLES_OK) {
-            error_tuples(pg_info);
+    if (PQntuples(pg_info->res) == pg_info->next_line &&
+        (pg_info->res_next || fetch_pg_info == pg_info ||
+         PQntuples(pg_info->res) ==
+         (fid < 1 ? get_fetch_size() : CURSOR_PAGE))) {
+        if (fetch_page(pg_info, fid < 1) != 0)
             return -1;
-        }
-        pg_info->next_line = 0;
     }
 
     G_debug(3, "get_feature(): next_line = %d", pg_info->next_line);
@@ -637,7 +636,7 @@ SF_FeatureType get_feature(struct Map_info *Map, int fid, int type)
     if (pg_info->toposchema_name) {
         if (fid < 0) {
             /* sequatial access */
-            seq_type = atoi(PQgetvalue(pg_info->res, pg_info->next_line, 2));
+            seq_type = Vect__get_int_pg(pg_info->res, pg_info->next_line, 2);
             if (seq_type == GV_BOUNDARY ||
                 (seq_type == GV_LINE && pg_info->feature_type == SF_POLYGON))
                 force_type = GV_BOUNDARY;
@@ -654,8 +653,8 @@ SF_FeatureType get_feature(struct Map_info *Map, int fid, int type)
             else {
                 int left_face, right_face;
                 
-                left_face  = atoi(PQgetvalue(pg_info->res, pg_info->next_line, 1));
-                right_face = atoi(PQgetvalue(pg_info->res, pg_info->next_line, 2));
+                left_face  = Vect__get_int_pg(pg_info->res, pg_info->next_line, 1);
+                right_face = Vect__get_int_pg(pg_info->res, pg_info->next_line, 2);
                 
                 if (type == GV_LINE &&
                     (left_face != 0 || right_face != 0)) 
@@ -664,13 +663,11 @@ SF_FeatureType get_feature(struct Map_info *Map, int fid, int type)
         }
     }
 
-    /* get geometry data */
-    data = (char *)PQgetvalue(pg_info->res, pg_info->next_line, 0);
-    
     /* load feature to the cache */
-    pg_info->cache.sf_type = Vect__cache_feature_pg(data,
-                                                    FALSE, force_type,
-                                                    &(pg_info->cache), NULL);
+    pg_info->cache.sf_type = Vect__cache_feature_res_pg(pg_info->res,
+                                                        pg_info->next_line, 0,
+                                                        FALSE, force_type,
+                                                        &(pg_info->cache), NULL);
     
     /* cache also categories (only for PostGIS Topology) */
     if (pg_info->toposchema_name) {
@@ -679,7 +676,7 @@ SF_FeatureType get_feature(struct Map_info *Map, int fid, int type)
         col_idx = fid < 0 ? 3 : 2; /* TODO: dermine col_idx for random access */
             
         if (!PQgetisnull(pg_info->res, pg_info->next_line, col_idx))
-            cat = atoi(PQgetvalue(pg_info->res, pg_info->next_line, col_idx)); 
+            cat = Vect__get_int_pg(pg_info->res, pg_info->next_line, col_idx);
         else
             cat = -1; /* no cat */
         pg_info->cache.lines_cats[pg_info->cache.lines_next] = cat;
@@ -690,7 +687,7 @@ SF_FeatureType get_feature(struct Map_info *Map, int fid, int type)
     /* set feature id */
     if (fid < 0) {
         pg_info->cache.fid =
-            atoi(PQgetvalue(pg_info->res, pg_info->next_line, 1)); 
+            Vect__get_int_pg(pg_info->res, pg_info->next_line, 1);
         pg_info->next_line++;
     }
     else {
@@ -742,9 +739,6 @@ unsigned char *hex_to_wkb(const char *hex_data, int *nbytes)
 /*!
    \brief Read geometry from HEX data
 
-   This code is inspired by OGRGeometryFactory::createFromWkb() from
-   GDAL/OGR library.
-
    \param data HEX data
    \param skip_polygon skip polygons (level 1)
    \param force_type force GV_BOUNDARY or GV_CENTROID (used for PostGIS topology only)
@@ -759,8 +753,79 @@ SF_FeatureType Vect__cache_feature_pg(const char *data, int skip_polygon,
                                       struct Format_info_cache *cache,
                                       struct feat_parts * fparts)
 {
-    int ret, byte_order, nbytes, is3D;
+    int nbytes;
     unsigned char *wkb_data;
+
+    wkb_data = hex_to_wkb(data, &nbytes);
+
+    return cache_feature(wkb_data, nbytes, skip_polygon, force_type,
+                         cache, fparts);
+}
+
+/*!
+   \brief Read geometry from query result
+
+   The geometry is given either as HEX data (text format) or as
+   EWKB (binary format, see Vect__fetch_cursor_pg()).
+
+   \param res query result
+   \param row row number
+   \param col column number
+   \param skip_polygon skip polygons (level 1)
+   \param force_type force GV_BOUNDARY or GV_CENTROID (used for PostGIS topology only)
+   \param[out] cache lines cache
+   \param[out] fparts used for building pseudo-topology (or NULL)
+
+   \return simple feature type
+   \return SF_GEOMETRY on error
+ */
+SF_FeatureType Vect__cache_feature_res_pg(const PGresult *res, int row,
+                                          int col, int skip_polygon,
+                                          int force_type,
+                                          struct Format_info_cache *cache,
+                                          struct feat_parts * fparts)
+{
+    int nbytes;
+
+    if (PQfformat(res, col) == 0)
+        return Vect__cache_feature_pg(PQgetvalue(res, row, col),
+                                      skip_polygon, force_type, cache, fparts);
+
+    /* copy, the SRID is removed in place */
+    nbytes = PQgetlength(res, row, col);
+    if ((unsigned int)nbytes + 1 > wkb_data_length) {
+        wkb_data_length = nbytes + 1;
+        wkb_data = G_realloc(wkb_data, wkb_data_length);
+    }
+    memcpy(wkb_data, PQgetvalue(res, row, col), nbytes);
+    wkb_data[nbytes] = 0;
+
+    return cache_feature(wkb_data, nbytes, skip_polygon, force_type,
+                         cache, fparts);
+}
+
+/*!
+   \brief Read geometry from WKB data
+
+   This code is inspired by OGRGeometryFactory::createFromWkb() from
+   GDAL/OGR library.
+
+   \param wkb_data WKB data (SRID is removed in place)
+   \param nbytes number of bytes
+   \param skip_polygon skip polygons (level 1)
+   \param force_type force GV_BOUNDARY or GV_CENTROID (used for PostGIS topology only)
+   \param[out] cache lines cache
+   \param[out] fparts used for building pseudo-topology (or NULL)
+
+   \return simple feature type
+   \return SF_GEOMETRY on error
+ */
+SF_FeatureType cache_feature(unsigned char *wkb_data, int nbytes,
+                             int skip_polygon, int force_type,
+                             struct Format_info_cache *cache,
+                             struct feat_parts * fparts)
+{
+    int ret, byte_order, is3D;
     unsigned int wkb_flags;
     SF_FeatureType ftype;
 
@@ -778,7 +843,6 @@ SF_FeatureType Vect__cache_feature_pg(const char *data, int skip_polygon,
         fparts->n_parts = 0;
 
     wkb_flags = 0;
-    wkb_data = hex_to_wkb(data, &nbytes);
 
     if (nbytes < 5) {
         /* G_free(wkb_data); */
@@ -1304,21 +1368,188 @@ int Vect__open_cursor_next_line_pg(struct Format_info_pg *pg_info, int fetch_all
         return -1;
     }
 
+    /* fetch records from select cursor */
+    return Vect__fetch_cursor_pg(pg_info, fetch_all);
+}
+
+/*!
+  \brief Fetch records from select cursor (internal use only)
+
+  The records are transferred in binary format, ie. geometry as EWKB
+  and integers in network byte order (see Vect__get_int_pg()). Unless
+  all records are fetched, the next page of records is requested
+  immediately, so that the server and the network prepare it while
+  the current page is read.
+
+  The number of records in a page is given by GRASS_VECTOR_PGFETCH
+  environment variable (default CURSOR_PAGE).
+
+  \param pg_info pointer to Format_info_pg struct
+  \param fetch_all TRUE to fetch all records
+
+  \return 0 on success
+  \return -1 on failure
+*/
+int Vect__fetch_cursor_pg(struct Format_info_pg *pg_info, int fetch_all)
+{
+    char stmt[DB_SQL_MAX];
+
+    if (pg_info->res) {
+        PQclear(pg_info->res);
+        pg_info->res = NULL;
+    }
+
     if (fetch_all)
         sprintf(stmt, "FETCH ALL in %s", pg_info->cursor_name);
     else
-        sprintf(stmt, "FETCH %d in %s", CURSOR_PAGE, pg_info->cursor_name);
+        sprintf(stmt, "FETCH %d in %s", get_fetch_size(),
+                pg_info->cursor_name);
     G_debug(3, "SQL: %s", stmt);
-    pg_info->res = PQexec(pg_info->conn, stmt); /* fetch records from select cursor */
+    Vect__sync_pg(pg_info->conn);
+    if (pg_info->res_next) {
+        /* prefetched page */
+        pg_info->res = pg_info->res_next;
+        pg_info->res_next = NULL;
+    }
+    else
+        pg_info->res = PQexecParams(pg_info->conn, stmt, 0, NULL, NULL,
+                                    NULL, NULL, 1);
     if (!pg_info->res || PQresultStatus(pg_info->res) != PGRES_TUPLES_OK) {
         error_tuples(pg_info);
         return -1;
     }
     pg_info->next_line = 0;
 
+    /* prefetch next page */
+    if (!fetch_all && PQntuples(pg_info->res) == get_fetch_size() &&
+        PQsendQueryParams(pg_info->conn, stmt, 0, NULL, NULL,
+                          NULL, NULL, 1))
+        fetch_pg_info = pg_info;
+
     return 0;
 }
 
+/*!
+  \brief Fetch next page of records from select cursor
+
+  \param pg_info pointer to Format_info_pg struct
+  \param sequential TRUE for cursor opened by
+  Vect__open_cursor_next_line_pg() otherwise by
+  Vect__open_cursor_line_pg()
+
+  \return 0 on success
+  \return -1 on failure
+*/
+int fetch_page(struct Format_info_pg *pg_info, int sequential)
+{
+    char stmt[DB_SQL_MAX];
+
+    if (sequential)
+        return Vect__fetch_cursor_pg(pg_info, FALSE);
+
+    PQclear(pg_info->res);
+
+    sprintf(stmt, "FETCH %d in %s", CURSOR_PAGE, pg_info->cursor_name);
+    G_debug(3, "SQL: %s", stmt);
+    Vect__sync_pg(pg_info->conn);
+    pg_info->res = PQexec(pg_info->conn, stmt);
+    if (!pg_info->res || PQresultStatus(pg_info->res) != PGRES_TUPLES_OK) {
+        error_tuples(pg_info);
+        return -1;
+    }
+    pg_info->next_line = 0;
+
+    return 0;
+}
+
+/*!
+  \brief Get number of records fetched at once from select cursor
+
+  \return number of records
+*/
+int get_fetch_size(void)
+{
+    static int fetch_size;
+
+    if (!fetch_size) {
+        const char *env = getenv("GRASS_VECTOR_PGFETCH");
+
+        fetch_size = env ? atoi(env) : 0;
+        if (fetch_size < 1)
+            fetch_size = CURSOR_PAGE;
+        G_debug(1, "GRASS_VECTOR_PGFETCH: %d", fetch_size);
+    }
+
+    return fetch_size;
+}
+
+/*!
+  \brief Finish asynchronous work on connection (internal use only)
+
+  A page of records being prefetched (see Vect__fetch_cursor_pg()) is
+  received and kept for later, COPY in progress is ended (see
+  Vect__end_copy_pg()). Must be called before any statement is
+  executed on the connection.
+
+  \param conn pointer to PGconn
+*/
+void Vect__sync_pg(PGconn *conn)
+{
+    struct Format_info_pg *pg_info;
+    PGresult *res;
+
+    pg_info = fetch_pg_info;
+    if (pg_info && pg_info->conn == conn) {
+        fetch_pg_info = NULL;
+        while ((res = PQgetResult(conn))) {
+            if (!pg_info->res_next)
+                pg_info->res_next = res;
+            else
+                PQclear(res);
+        }
+    }
+
+    Vect__end_copy_pg(conn);
+}
+
+/*!
+  \brief Get integer value from query result (internal use only)
+
+  Handles both text and binary format (integer columns of 2, 4 or 8
+  bytes).
+
+  \param res query result
+  \param row row number
+  \param col column number
+
+  \return value (0 for NULL)
+*/
+int Vect__get_int_pg(const PGresult *res, int row, int col)
+{
+    const unsigned char *v;
+
+    if (PQfformat(res, col) == 0)
+        return atoi(PQgetvalue(res, row, col));
+
+    if (PQgetisnull(res, row, col))
+        return 0;
+
+    v = (const unsigned char *)PQgetvalue(res, row, col);
+    switch (PQgetlength(res, row, col)) {
+    case 2:
+        return (short)((v[0] << 8) | v[1]);
+    case 4:
+        return (int)(((unsigned int)v[0] << 24) | (v[1] << 16) |
+                     (v[2] << 8) | v[3]);
+    case 8:
+        return (int)(((unsigned int)v[4] << 24) | (v[5] << 16) |
+                     (v[6] << 8) | v[7]);
+    default:
+        G_warning(_("Unsupported integer value in column %d"), col);
+        return 0;
+    }
+}
+
 /*!
   \brief Open select cursor for random access (internal use only)
 
@@ -1388,6 +1619,7 @@ int Vect__open_cursor_line_pg(struct Format_info_pg *pg_info, int fid, int type)
     pg_info->next_line = 0;
 
     sprintf(stmt, "FETCH ALL in %s", pg_info->cursor_name);
+    Vect__sync_pg(pg_info->conn);
     pg_info->res = PQexec(pg_info->conn, stmt);
     if (!pg_info->res || PQresultStatus(pg_info->res) != PGRES_TUPLES_OK) {
         error_tuples(pg_info);
@@ -1412,6 +1644,12 @@ int Vect__close_cursor_pg(struct Format_info_pg *pg_info)
         pg_info->res = NULL;
     }
     
+    Vect__sync_pg(pg_info->conn);
+    if (pg_info->res_next) {
+        PQclear(pg_info->res_next);
+        pg_info->res_next = NULL;
+    }
+    
     if (pg_info->cursor_name) {
         char stmt[DB_SQL_MAX];
         
@@ -1491,6 +1729,7 @@ int Vect__select_line_pg(struct Format_info_pg *pg_info, int fid, int type)
     
     pg_info->next_line = 0;
     
+    Vect__sync_pg(pg_info->conn);
     pg_info->res = PQexec(pg_info->conn, stmt);
     if (!pg_info->res || PQresultStatus(pg_info->res) != PGRES_TUPLES_OK) {
         error_tuples(pg_info);
@@ -1518,6 +1757,7 @@ int Vect__execute_pg(PGconn * conn, const char *stmt)
     result = NULL;
 
     G_debug(3, "Vect__execute_pg(): %s", stmt);
+    Vect__sync_pg(conn);
     result = PQexec(conn, stmt);
     if (!result || PQresultStatus(result) != PGRES_COMMAND_OK) {
         size_t stmt_len;
@@ -1553,6 +1793,7 @@ int Vect__execute_get_value_pg(PGconn *conn, const char *stmt)
     result = NULL;
 
     G_debug(3, "Vect__execute_get_value_pg(): %s", stmt);
+    Vect__sync_pg(conn);
     result = PQexec(conn, stmt);
     if (!result || PQresultStatus(result) != PGRES_TUPLES_OK ||
         PQntuples(result) != 1) {
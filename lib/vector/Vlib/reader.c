@@ -0,0 +1,276 @@
+/*!
+   \file lib/vector/Vlib/reader.c
+
+   \brief Vector library - readers for several threads
+
+   Higher level functions for reading/writing/manipulating vectors.
+
+   A reader keeps its own position in the coor file and its own
+   buffers, so that several threads can read the features of one map
+   and search its spatial index at the same time, each thread with its
+   own reader. The topology, the spatial index and the map must not be
+   modified while readers are used.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdlib.h>
+#include <grass/vector.h>
+#include <grass/glocale.h>
+
+#include "local_proto.h"
+
+struct Map_reader
+{
+    struct Map_info *Map;
+    struct gvfile fp;		/* coor file with own position */
+    int own_file;		/* fp.file was opened for the reader */
+    struct line_pnts *Points;	/* boundaries of areas and isles */
+    struct boxlist *List;	/* lines of all types */
+};
+
+/*!
+   \brief Create a reader for a vector map
+
+   The map must be a native vector map open on level 2 with a spatial
+   index which can be searched by several threads (see
+   dig_spidx_reentrant()). The reader must be created and destroyed on
+   the main thread, the functions Vect_reader_*() may be called by any
+   single thread for a given reader.
+
+   \param Map vector map open on level 2
+
+   \return pointer to new reader
+   \return NULL if features cannot be read by several threads
+ */
+struct Map_reader *Vect_new_reader(struct Map_info *Map)
+{
+    struct Map_reader *R;
+
+    G_debug(2, "Vect_new_reader(): name = '%s'", Map->name);
+
+    if (Map->format != GV_FORMAT_NATIVE || Vect_level(Map) < 2 ||
+	!dig_spidx_reentrant(&(Map->plus))) {
+	G_debug(1, "Vector map <%s> cannot be read by several threads",
+		Vect_get_full_name(Map));
+	return NULL;
+    }
+
+    R = G_malloc(sizeof(struct Map_reader));
+    R->Map = Map;
+    R->fp = Map->dig_fp;
+    R->own_file = FALSE;
+
+    if (!Map->dig_fp.loaded) {
+	/* the file position of a FILE cannot be shared */
+	char path[GPATH_MAX];
+
+	if (Map->mode == GV_MODE_RW)
+	    dig_fflush(&(Map->dig_fp));
+
+	Vect__get_path(path, Map);
+	dig_file_init(&(R->fp));
+	R->fp.file = G_fopen_old(path, GV_COOR_ELEMENT, Map->mapset);
+	if (R->fp.file == NULL) {
+	    G_warning(_("Unable to open coor file for vector map <%s>"),
+		      Vect_get_full_name(Map));
+	    G_free(R);
+	    return NULL;
+	}
+	R->own_file = TRUE;
+    }
+
+    R->Points = Vect_new_line_struct();
+    R->List = Vect_new_boxlist(TRUE);
+
+    return R;
+}
+
+/*!
+   \brief Destroy a reader
+
+   \param R pointer to reader
+ */
+void Vect_destroy_reader(struct Map_reader *R)
+{
+    if (!R)
+	return;
+
+    if (R->own_file)
+	fclose(R->fp.file);
+    Vect_destroy_line_struct(R->Points);
+    Vect_destroy_boxlist(R->List);
+    G_free(R);
+}
+
+/*!
+   \brief Read vector feature with a reader
+
+   Same as Vect_read_line(), but an invalid feature id is reported by
+   the return value: the function does not print messages.
+
+   \param R pointer to reader
+   \param[out] Points container used to store line points within (or NULL)
+   \param[out] Cats container used to store line categories within (or NULL)
+   \param line feature id
+
+   \return feature type (GV_POINT, GV_LINE, ...)
+   \return 0 dead feature
+   \return -1 on error (e.g. invalid feature id)
+ */
+int Vect_reader_read_line(struct Map_reader *R, struct line_pnts *Points,
+			  struct line_cats *Cats, int line)
+{
+    struct Map_info *Map = R->Map;
+    struct P_line *Line;
+    int ret;
+
+    if (line < 1 || line > Map->plus.n_lines)
+	return -1;
+
+    Line = Map->plus.Line[line];
+    if (Line == NULL)
+	return 0;
+
+    ret = Vect__read_line_nat(Map, &(R->fp), Points, Cats, Line->offset);
+
+    return ret == -2 ? -1 : ret;
+}
+
+/*!
+   \brief Select lines with bounding boxes by box with a reader
+
+   Same as Vect_select_lines_by_box().
+
+   \param R pointer to reader
+   \param Box bounding box
+   \param type line type
+   \param[out] list output list, must be initialized
+
+   \return number of lines
+ */
+int Vect_reader_select_lines_by_box(struct Map_reader *R,
+				    const struct bound_box *Box, int type,
+				    struct boxlist *list)
+{
+    struct Plus_head *plus = &(R->Map->plus);
+    int i, line, nlines;
+
+    Vect_reset_boxlist(list);
+
+    nlines = dig_select_lines_r(plus, Box, R->List);
+
+    /* Remove lines of not requested types */
+    for (i = 0; i < nlines; i++) {
+	line = R->List->id[i];
+	if (plus->Line[line] == NULL || !(plus->Line[line]->type & type))
+	    continue;
+	dig_boxlist_add(list, line, &R->List->box[i]);
+    }
+
+    return list->n_values;
+}
+
+/*!
+   \brief Select areas with bounding boxes by box with a reader
+
+   Same as Vect_select_areas_by_box().
+
+   \param R pointer to reader
+   \param Box bounding box
+   \param[out] list output list, must be initialized
+
+   \return number of areas
+ */
+int Vect_reader_select_areas_by_box(struct Map_reader *R,
+				    const struct bound_box *Box,
+				    struct boxlist *list)
+{
+    Vect_reset_boxlist(list);
+
+    return dig_select_areas_r(&(R->Map->plus), Box, list);
+}
+
+/* points of the boundaries of an area or isle */
+static int get_ring_points(struct Map_reader *R, const plus_t *lines,
+			   int n_lines, struct line_pnts *BPoints)
+{
+    int i, line, aline, dir;
+
+    Vect_reset_line(BPoints);
+    for (i = 0; i < n_lines; i++) {
+	line = lines[i];
+	aline = abs(line);
+
+	if (0 > Vect_reader_read_line(R, R->Points, NULL, aline))
+	    return -1;
+
+	dir = line > 0 ? GV_FORWARD : GV_BACKWARD;
+	Vect_append_points(BPoints, R->Points, dir);
+	BPoints->n_points--;	/* skip last point, avoids duplicates */
+    }
+    BPoints->n_points++;	/* close polygon */
+
+    return BPoints->n_points;
+}
+
+/*!
+   \brief Get points of the outer ring of an area with a reader
+
+   Same as Vect_get_area_points(), without messages.
+
+   \param R pointer to reader
+   \param area area id
+   \param[out] BPoints points array
+
+   \return number of points
+   \return -1 on error (e.g. dead area)
+ */
+int Vect_reader_get_area_points(struct Map_reader *R, int area,
+				struct line_pnts *BPoints)
+{
+    const struct Plus_head *Plus = &(R->Map->plus);
+    const struct P_area *Area;
+
+    Vect_reset_line(BPoints);
+
+    if (area < 1 || area > Plus->n_areas)
+	return -1;
+    Area = Plus->Area[area];
+    if (Area == NULL)
+	return -1;
+
+    return get_ring_points(R, Area->lines, Area->n_lines, BPoints);
+}
+
+/*!
+   \brief Get points of an isle with a reader
+
+   Same as Vect_get_isle_points(), without messages.
+
+   \param R pointer to reader
+   \param isle isle id
+   \param[out] BPoints points array
+
+   \return number of points
+   \return -1 on error (e.g. dead isle)
+ */
+int Vect_reader_get_isle_points(struct Map_reader *R, int isle,
+				struct line_pnts *BPoints)
+{
+    const struct Plus_head *Plus = &(R->Map->plus);
+    const struct P_isle *Isle;
+
+    Vect_reset_line(BPoints);
+
+    if (isle < 1 || isle > Plus->n_isles)
+	return -1;
+    Isle = Plus->Isle[isle];
+    if (Isle == NULL)
+	return -1;
+
+    return get_ring_points(R, Isle->lines, Isle->n_lines, BPoints);
+}
@@ -0,0 +1,207 @@
+/*!
+   \file lib/vector/Vlib/recycle.c
+
+   \brief Vector library - recycling of feature buffers
+
+   Modules and the library create and destroy line_pnts, line_cats and
+   boxlist structures for every feature they process. Destroyed
+   structures of moderate capacity are kept in small per-thread caches
+   and handed out again, with their arrays, by the next
+   Vect_new_line_struct(), Vect_new_cats_struct() or Vect_new_boxlist()
+   of the same thread, so that such loops do not call malloc() and
+   free() for each feature. Without thread-local storage nothing is
+   cached.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <grass/vector.h>
+#include "local_proto.h"
+
+/* structures kept per thread and kind */
+#define CACHE_SIZE 16
+
+/* largest arrays worth keeping; bigger ones are freed */
+#define MAX_POINTS 1024
+#define MAX_CATS   64
+#define MAX_VALUES 4000
+
+#ifdef HAVE_THREAD_LOCAL
+struct cache
+{
+    void *item[CACHE_SIZE];
+    int n;
+};
+
+static THREAD_LOCAL struct cache lines, cats, boxlists[2];
+
+static void *get(struct cache *c)
+{
+    return c->n > 0 ? c->item[--c->n] : NULL;
+}
+
+static int put(struct cache *c, void *p)
+{
+    if (c->n == CACHE_SIZE)
+	return 0;
+    c->item[c->n++] = p;
+
+    return 1;
+}
+#endif
+
+/*!
+   \brief Get a recycled line_pnts structure (internal use only)
+
+   \return structure without points, with its arrays, or NULL
+ */
+struct line_pnts *Vect__recycled_line(void)
+{
+#ifdef HAVE_THREAD_LOCAL
+    struct line_pnts *p = get(&lines);
+
+    if (p)
+	p->n_points = 0;
+
+    return p;
+#else
+    return NULL;
+#endif
+}
+
+/*!
+   \brief Keep a line_pnts structure for reuse (internal use only)
+
+   \return 1 if the structure was kept, 0 if it must be freed
+ */
+int Vect__recycle_line(struct line_pnts *p)
+{
+#ifdef HAVE_THREAD_LOCAL
+    if (p->alloc_points <= MAX_POINTS)
+	return put(&lines, p);
+#endif
+    return 0;
+}
+
+/*!
+   \brief Get a recycled line_cats structure (internal use only)
+
+   \return structure without categories, with its arrays, or NULL
+ */
+struct line_cats *Vect__recycled_cats(void)
+{
+#ifdef HAVE_THREAD_LOCAL
+    struct line_cats *p = get(&cats);
+
+    if (p)
+	p->n_cats = 0;
+
+    return p;
+#else
+    return NULL;
+#endif
+}
+
+/*!
+   \brief Keep a line_cats structure for reuse (internal use only)
+
+   \return 1 if the structure was kept, 0 if it must be freed
+ */
+int Vect__recycle_cats(struct line_cats *p)
+{
+#ifdef HAVE_THREAD_LOCAL
+    if (p->alloc_cats <= MAX_CATS)
+	return put(&cats, p);
+#endif
+    return 0;
+}
+
+/*!
+   \brief Get a recycled boxlist structure (internal use only)
+
+   \param have_boxes 0 for a list of ids only
+
+   \return empty list, with its arrays, or NULL
+ */
+struct boxlist *Vect__recycled_boxlist(int have_boxes)
+{
+#ifdef HAVE_THREAD_LOCAL
+    struct boxlist *p = get(&boxlists[have_boxes != 0]);
+
+    if (p)
+	p->n_values = 0;
+
+    return p;
+#else
+    return NULL;
+#endif
+}
+
+/*!
+   \brief Keep a boxlist structure for reuse (internal use only)
+
+   \return 1 if the structure was kept, 0 if it must be freed
+ */
+int Vect__recycle_boxlist(struct boxlist *p)
+{
+#ifdef HAVE_THREAD_LOCAL
+    /* lists with boxes have the box array of the same size */
+    if (p->alloc_values <= MAX_VALUES &&
+	(!p->have_boxes || p->alloc_values == 0 || p->box))
+	return put(&boxlists[p->have_boxes != 0], p);
+#endif
+    return 0;
+}
+
+/*!
+   \brief Free the feature buffers kept for reuse by the calling thread
+
+   Destroyed line_pnts, line_cats and boxlist structures are kept per
+   thread to be reused by the next new structure. A thread which does
+   not create such structures any more, e.g. before it exits, can give
+   the memory back with this function.
+ */
+void Vect_free_feature_buffers(void)
+{
+#ifdef HAVE_THREAD_LOCAL
+    void *p;
+    int i;
+
+    while ((p = get(&lines))) {
+	struct line_pnts *Points = p;
+
+	if (Points->alloc_points) {
+	    G_free(Points->x);
+	    G_free(Points->y);
+	    G_free(Points->z);
+	}
+	G_free(Points);
+    }
+
+    while ((p = get(&cats))) {
+	struct line_cats *Cats = p;
+
+	if (Cats->alloc_cats) {
+	    G_free(Cats->field);
+	    G_free(Cats->cat);
+	}
+	G_free(Cats);
+    }
+
+    for (i = 0; i < 2; i++) {
+	while ((p = get(&boxlists[i]))) {
+	    struct boxlist *list = p;
+
+	    if (list->alloc_values) {
+		G_free(list->id);
+		if (list->box)
+		    G_free(list->box);
+	    }
+	    G_free(list);
+	}
+    }
+#endif
+}
@@ -16,6 +16,8 @@
 #include <stdlib.h>
 #include <grass/vector.h>
 
+/* performance counter, see G_perf_count() */
+static int perf_queries;
 
 /*!
    \brief Select lines with bounding boxes by box.
@@ -39,6 +41,8 @@ Vect_select_lines_by_box(struct Map_info *Map, const struct bound_box *Box,
     struct P_line *Line;
     static struct boxlist *LocList = NULL;
 
+    G_perf_count(&perf_queries, "vector.index_queries", 1);
+
     G_debug(3, "Vect_select_lines_by_box()");
     G_debug(3, "  Box(N,S,E,W,T,B): %e, %e, %e, %e, %e, %e", Box->N, Box->S,
 	    Box->E, Box->W, Box->T, Box->B);
@@ -128,6 +132,8 @@ Vect_select_areas_by_box(struct Map_info *Map, const struct bound_box * Box,
     int i;
     static int debug_level = -1;
 
+    G_perf_count(&perf_queries, "vector.index_queries", 1);
+
     if (debug_level == -1) {
 	const char *dstr = G_getenv_nofatal("DEBUG");
 
@@ -175,6 +181,8 @@ Vect_select_isles_by_box(struct Map_info *Map, const struct bound_box * Box,
     G_debug(3, "Box(N,S,E,W,T,B): %e, %e, %e, %e, %e, %e", Box->N, Box->S,
 	    Box->E, Box->W, Box->T, Box->B);
 
+    G_perf_count(&perf_queries, "vector.index_queries", 1);
+
     dig_select_isles(&(Map->plus), Box, list);
     G_debug(3, "  %d isles selected", list->n_values);
 
@@ -196,6 +204,8 @@ Vect_select_nodes_by_box(struct Map_info *Map, const struct bound_box * Box,
 {
     struct Plus_head *plus;
 
+    G_perf_count(&perf_queries, "vector.index_queries", 1);
+
     G_debug(3, "Vect_select_nodes_by_box()");
     G_debug(3, "Box(N,S,E,W,T,B): %e, %e, %e, %e, %e, %e", Box->N, Box->S,
 	    Box->E, Box->W, Box->T, Box->B);
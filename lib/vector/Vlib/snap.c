@@ -176,6 +176,432 @@ Vect_snap_lines_list(struct Map_info *Map, const struct ilist *List_lines,
 	Vect_snap_lines_list_kdtree(Map, List_lines, thresh, Err);
 }
 
+/* With several threads, the points and lines are processed in blocks:
+ * the kd-tree queries of a block run on several threads and the
+ * results are applied in order on the main thread, so that the lines
+ * are snapped as by one thread. */
+#define SNAP_BLOCK 4096
+
+/* points in threshold of a point */
+struct snap_query
+{
+    int point;
+    int *uid;
+    double *d;
+    int n;
+};
+
+/* a line to snap */
+struct snap_line
+{
+    int line, ltype;
+    struct line_pnts *Points, *NPoints;
+    struct line_cats *Cats;
+    int changed;		/* 1 changed, 0 not changed, -1 error */
+    int nsnapped, ncreated;
+};
+
+struct snap_block
+{
+    struct kdtree *KDTree;
+    XPNT *XPnts;
+    double thresh;
+    struct snap_query *q;
+    struct snap_line *lines;
+    int n, alloc;
+};
+
+/* make point an anchor and assign it to the points found in threshold,
+ * returns the number of points newly assigned */
+static int assign_anchor(XPNT *XPnts, int point, const int *kduid,
+			 int kd_found, double thresh2)
+{
+    int i, ntosnap = 0;
+
+    XPnts[point].anchor = 0;	/* make it anchor */
+
+    for (i = 0; i < kd_found; i++) {
+	int pointb;
+	double dx, dy, dist2;
+
+	pointb = kduid[i];
+	if (pointb == point)
+	    continue;
+
+	dx = XPnts[pointb].x - XPnts[point].x;
+	dy = XPnts[pointb].y - XPnts[point].y;
+	dist2 = dx * dx + dy * dy;
+
+	if (dist2 > thresh2) /* outside threshold */
+	    continue;
+	    
+	/* doesn't have an anchor yet */
+	if (XPnts[pointb].anchor == -1) {
+	    XPnts[pointb].anchor = point;
+	    ntosnap++;
+	}
+	else if (XPnts[pointb].anchor > 0) {   /* check distance to previously assigned anchor */
+	    double dist2_a;
+
+	    dx = XPnts[XPnts[pointb].anchor].x - XPnts[pointb].x;
+	    dy = XPnts[XPnts[pointb].anchor].y - XPnts[pointb].y;
+	    dist2_a = dx * dx + dy * dy;
+
+	    /* replace old anchor */
+	    if (dist2 < dist2_a) {
+		XPnts[pointb].anchor = point;
+	    }
+	}
+    }
+
+    return ntosnap;
+}
+
+/* snap the vertices of Points to their anchors and the segments to the
+ * anchors in threshold, the snapped line is written to NPoints
+ * returns 1 if the line was changed, 0 if not, -1 on error */
+static int snap_line(struct kdtree *KDTree, const XPNT *XPnts, double thresh,
+		     struct line_pnts *Points, struct line_pnts *NPoints,
+		     int **Index, int *aindex, NEW **New, int *anew,
+		     int *nsnapped, int *ncreated)
+{
+    int v, spoint, anchor, kd_found, nnew;
+    int *kduid;
+    int changed = 0;
+    double c[2], kddist, thresh2;
+
+    thresh2 = thresh * thresh;
+
+    if (Points->n_points >= *aindex) {
+	*aindex = Points->n_points;
+	*Index = (int *)G_realloc(*Index, *aindex * sizeof(int));
+    }
+
+    /* Snap all vertices */
+    G_debug(3, "Snap all vertices");
+    for (v = 0; v < Points->n_points; v++) {
+	/* Box */
+	c[0] = Points->x[v];
+	c[1] = Points->y[v];
+
+	/* Find point ( should always find one point ) */
+	spoint = -1;
+	kdtree_knn(KDTree, c, &spoint, &kddist, 1, NULL);
+	if (spoint == -1)
+	    return -1;
+
+	anchor = XPnts[spoint].anchor;
+
+	if (anchor > 0) {	/* to be snapped */
+	    Points->x[v] = XPnts[anchor].x;
+	    Points->y[v] = XPnts[anchor].y;
+	    (*nsnapped)++;
+	    changed = 1;
+	    (*Index)[v] = anchor;	/* point on new location */
+	}
+	else {
+	    (*Index)[v] = spoint;	/* old point */
+	}
+    }
+
+    /* New points */
+    Vect_reset_line(NPoints);
+
+    /* Snap all segments to anchors in threshold */
+    G_debug(3, "Snap all segments");
+    for (v = 0; v < Points->n_points - 1; v++) {
+	int i;
+	double x1, x2, y1, y2, xmin, xmax, ymin, ymax;
+	double rc[4];
+
+	G_debug(3, "  segment = %d end anchors : %d  %d", v, (*Index)[v],
+		(*Index)[v + 1]);
+
+	x1 = Points->x[v];
+	x2 = Points->x[v + 1];
+	y1 = Points->y[v];
+	y2 = Points->y[v + 1];
+
+	Vect_append_point(NPoints, Points->x[v], Points->y[v],
+			  Points->z[v]);
+
+	/* Box */
+	if (x1 <= x2) {
+	    xmin = x1;
+	    xmax = x2;
+	}
+	else {
+	    xmin = x2;
+	    xmax = x1;
+	}
+	if (y1 <= y2) {
+	    ymin = y1;
+	    ymax = y2;
+	}
+	else {
+	    ymin = y2;
+	    ymax = y1;
+	}
+
+	/* Find points */
+	G_debug(3, "  search anchors for segment %g,%g to %g,%g", x1, y1, x2, y2);
+	/* distance search: circle around midpoint encompassing 
+	 *                  endpoints
+	 * box search: box encompassing endpoints, 
+	 *             smaller than corresponding circle */
+	rc[0] = xmin - thresh * 2;
+	rc[1] = ymin - thresh * 2;
+	rc[2] = xmax + thresh * 2;
+	rc[3] = ymax + thresh * 2;
+	
+	kd_found = kdtree_rnn(KDTree, rc, &kduid, NULL);
+
+	G_debug(3, "  %d points in box", kd_found);
+
+	/* Snap to anchor in threshold different from end points */
+	nnew = 0;
+	for (i = 0; i < kd_found; i++) {
+	    double dist2, along;
+	    int status;
+
+	    spoint = kduid[i];
+	    G_debug(4, "    spoint = %d anchor = %d", spoint,
+		    XPnts[spoint].anchor);
+
+	    if (spoint == (*Index)[v] || spoint == (*Index)[v + 1])
+		continue;	/* end point */
+	    if (XPnts[spoint].anchor > 0)
+		continue;	/* point is not anchor */
+
+	    /* Check the distance */
+	    dist2 =
+		dig_distance2_point_to_line(XPnts[spoint].x,
+					    XPnts[spoint].y, 0, x1, y1, 0,
+					    x2, y2, 0, 0, NULL, NULL,
+					    NULL, &along, &status);
+
+	    G_debug(4, "      distance = %lf", sqrt(dist2));
+
+	    if (status == 0 && dist2 <= thresh2) {
+		G_debug(4, "      anchor in thresh, along = %lf", along);
+
+		if (nnew == *anew) {
+		    *anew += 100;
+		    *New = (NEW *) G_realloc(*New, *anew * sizeof(NEW));
+		}
+		(*New)[nnew].anchor = spoint;
+		(*New)[nnew].along = along;
+		nnew++;
+	    }
+	}
+	if (kd_found) {
+	    G_free(kduid);
+	}
+	G_debug(3, "  nnew = %d", nnew);
+	/* insert new vertices */
+	if (nnew > 0) {
+	    /* sort by distance along the segment */
+	    qsort(*New, sizeof(char) * nnew, sizeof(NEW), sort_new);
+
+	    for (i = 0; i < nnew; i++) {
+		anchor = (*New)[i].anchor;
+		/* Vect_line_insert_point ( Points, ++v, XPnts[anchor].x, XPnts[anchor].y, 0); */
+		Vect_append_point(NPoints, XPnts[anchor].x,
+				  XPnts[anchor].y, 0);
+		(*ncreated)++;
+	    }
+	    changed = 1;
+	}
+    }
+
+    /* append end point */
+    v = Points->n_points - 1;
+    Vect_append_point(NPoints, Points->x[v], Points->y[v], Points->z[v]);
+
+    return changed;
+}
+
+/* radius queries of a block of points */
+static void query_points(int first, int last, void *closure)
+{
+    struct snap_block *blk = closure;
+    int i;
+    double c[2];
+
+    for (i = first; i < last; i++) {
+	struct snap_query *q = &blk->q[i];
+
+	c[0] = blk->XPnts[q->point].x;
+	c[1] = blk->XPnts[q->point].y;
+	q->n = kdtree_dnn(blk->KDTree, c, &q->uid, &q->d, blk->thresh,
+			  &q->point);
+    }
+}
+
+/* snapping of a block of lines */
+static void snap_lines(int first, int last, void *closure)
+{
+    struct snap_block *blk = closure;
+    int i, aindex = 0, anew = 0;
+    int *Index = NULL;
+    NEW *New = NULL;
+
+    for (i = first; i < last; i++) {
+	struct snap_line *l = &blk->lines[i];
+
+	l->nsnapped = l->ncreated = 0;
+	l->changed = snap_line(blk->KDTree, blk->XPnts, blk->thresh,
+			       l->Points, l->NPoints, &Index, &aindex,
+			       &New, &anew, &l->nsnapped, &l->ncreated);
+    }
+
+    G_free(Index);
+    G_free(New);
+}
+
+/* rewrite a snapped line */
+static void rewrite_line(struct Map_info *Map, int line, int ltype,
+			 const struct line_pnts *Points,
+			 struct line_pnts *NPoints,
+			 const struct line_cats *Cats, struct Map_info *Err)
+{
+    Vect_line_prune(NPoints);	/* remove duplicates */
+    if (NPoints->n_points > 1 || !(ltype & GV_LINES)) {
+	Vect_rewrite_line(Map, line, ltype, NPoints, Cats);
+    }
+    else {
+	Vect_delete_line(Map, line);
+    }
+    if (Err) {
+	Vect_write_line(Err, ltype, Points, Cats);
+    }
+}
+
+/* assign anchor vertices with several threads, returns the number of
+ * anchors */
+static int assign_anchors_block(struct kdtree *KDTree, XPNT *XPnts,
+				int npoints, double thresh, int *ntosnap)
+{
+    struct snap_block blk;
+    int point, first, i, nanchors = 0;
+
+    G_zero(&blk, sizeof(struct snap_block));
+    blk.KDTree = KDTree;
+    blk.XPnts = XPnts;
+    blk.thresh = thresh;
+    blk.q = G_malloc(SNAP_BLOCK * sizeof(struct snap_query));
+
+    for (first = 1; first <= npoints; first += SNAP_BLOCK) {
+	G_percent(first, npoints, 4);
+
+	/* points which were not assigned by previous blocks */
+	blk.n = 0;
+	for (point = first; point < first + SNAP_BLOCK && point <= npoints;
+	     point++) {
+	    if (XPnts[point].anchor == -1)
+		blk.q[blk.n++].point = point;
+	}
+
+	G_parallel_for(0, blk.n, 0, query_points, &blk);
+
+	for (i = 0; i < blk.n; i++) {
+	    struct snap_query *q = &blk.q[i];
+
+	    /* may have been assigned by a previous point of the block */
+	    if (XPnts[q->point].anchor == -1) {
+		*ntosnap += assign_anchor(XPnts, q->point, q->uid, q->n,
+					  thresh * thresh);
+		nanchors++;
+	    }
+	    if (q->n) {
+		G_free(q->d);
+		G_free(q->uid);
+	    }
+	}
+    }
+    G_percent(1, 1, 1);
+
+    G_free(blk.q);
+
+    return nanchors;
+}
+
+/* snap the lines of a block with several threads and rewrite them */
+static void flush_line_block(struct snap_block *blk, struct Map_info *Map,
+			     struct Map_info *Err, int *nsnapped,
+			     int *ncreated)
+{
+    int i;
+
+    G_parallel_for(0, blk->n, 0, snap_lines, blk);
+
+    for (i = 0; i < blk->n; i++) {
+	struct snap_line *l = &blk->lines[i];
+
+	if (l->changed < 0)
+	    G_fatal_error("Point not in KD Tree");
+
+	*nsnapped += l->nsnapped;
+	*ncreated += l->ncreated;
+	if (l->changed)
+	    rewrite_line(Map, l->line, l->ltype, l->Points, l->NPoints,
+			 l->Cats, Err);
+    }
+    blk->n = 0;
+}
+
+/* snap lines with several threads */
+static void snap_lines_block(struct Map_info *Map,
+			     const struct ilist *List_lines,
+			     struct kdtree *KDTree, XPNT *XPnts,
+			     double thresh, struct Map_info *Err,
+			     int *nsnapped, int *ncreated)
+{
+    struct snap_block blk;
+    int i, line_idx;
+
+    G_zero(&blk, sizeof(struct snap_block));
+    blk.KDTree = KDTree;
+    blk.XPnts = XPnts;
+    blk.thresh = thresh;
+    blk.alloc = SNAP_BLOCK;
+    blk.lines = G_malloc(blk.alloc * sizeof(struct snap_line));
+    for (i = 0; i < blk.alloc; i++) {
+	blk.lines[i].Points = Vect_new_line_struct();
+	blk.lines[i].NPoints = Vect_new_line_struct();
+	blk.lines[i].Cats = Vect_new_cats_struct();
+    }
+
+    for (line_idx = 0; line_idx < List_lines->n_values; line_idx++) {
+	struct snap_line *l;
+	int line;
+
+	G_percent(line_idx, List_lines->n_values, 2);
+
+	line = List_lines->value[line_idx];
+
+	G_debug(3, "line =  %d", line);
+	if (!Vect_line_alive(Map, line))
+	    continue;
+
+	l = &blk.lines[blk.n++];
+	l->line = line;
+	l->ltype = Vect_read_line(Map, l->Points, l->Cats, line);
+
+	if (blk.n == blk.alloc)
+	    flush_line_block(&blk, Map, Err, nsnapped, ncreated);
+    }
+    flush_line_block(&blk, Map, Err, nsnapped, ncreated);
+    G_percent(line_idx, List_lines->n_values, 2); /* finish it */
+
+    for (i = 0; i < blk.alloc; i++) {
+	Vect_destroy_line_struct(blk.lines[i].Points);
+	Vect_destroy_line_struct(blk.lines[i].NPoints);
+	Vect_destroy_cats_struct(blk.lines[i].Cats);
+    }
+    G_free(blk.lines);
+}
+
 static void
 Vect_snap_lines_list_kdtree(struct Map_info *Map, const struct ilist *List_lines,
 		     double thresh, struct Map_info *Err)
@@ -191,8 +617,7 @@ Vect_snap_lines_list_kdtree(struct Map_info *Map, const struct ilist *List_lines
     int apoints, npoints, nvertices;	/* number of allocated points, registered points, vertices */
     XPNT *XPnts;		/* Array of points */
     NEW *New = NULL;		/* Array of new points */
-    int anew = 0, nnew;		/* allocated new points , number of new points */
-    struct ilist *List;
+    int anew = 0;		/* allocated new points */
     int *Index = NULL;		/* indexes of anchors for vertices */
     int aindex = 0;		/* allocated Index */
 
@@ -208,7 +633,6 @@ Vect_snap_lines_list_kdtree(struct Map_info *Map, const struct ilist *List_lines
     Points = Vect_new_line_struct();
     NPoints = Vect_new_line_struct();
     Cats = Vect_new_cats_struct();
-    List = Vect_new_list();
 
     KDTree = kdtree_create(2, NULL);
 
@@ -262,70 +686,42 @@ Vect_snap_lines_list_kdtree(struct Map_info *Map, const struct ilist *List_lines
 
     npoints = point - 1;
 
+    /* the tree is searched once or more for each point and vertex */
+    kdtree_optimize(KDTree, 2);
+
     /* Go through all registered points and if not yet marked mark it as anchor and assign this anchor
      * to all not yet marked points in threshold */
 
     G_important_message(_("Snap vertices Pass 2: assign anchor vertices"));
 
     nanchors = ntosnap = 0;
-    for (point = 1; point <= npoints; point++) {
-	int i;
+    if (G_num_workers() > 0)
+	nanchors = assign_anchors_block(KDTree, XPnts, npoints, thresh,
+					&ntosnap);
+    else {
+	for (point = 1; point <= npoints; point++) {
+	    G_percent(point, npoints, 4);
 
-	G_percent(point, npoints, 4);
-
-	G_debug(3, "  point = %d", point);
-
-	if (XPnts[point].anchor >= 0)
-	    continue;
+	    G_debug(3, "  point = %d", point);
 
-	XPnts[point].anchor = 0;	/* make it anchor */
-	nanchors++;
-
-	/* Find points in threshold */
-	c[0] = XPnts[point].x;
-	c[1] = XPnts[point].y;
-
-	Vect_reset_list(List);
-	kd_found = kdtree_dnn(KDTree, c, &kduid, &kdd, thresh, &point);
-	G_debug(4, "  %d points in threshold box", kd_found);
-
-	for (i = 0; i < kd_found; i++) {
-	    int pointb;
-	    double dx, dy, dist2;
-
-	    pointb = kduid[i];
-	    if (pointb == point)
+	    if (XPnts[point].anchor >= 0)
 		continue;
 
-	    dx = XPnts[pointb].x - XPnts[point].x;
-	    dy = XPnts[pointb].y - XPnts[point].y;
-	    dist2 = dx * dx + dy * dy;
+	    /* Find points in threshold */
+	    c[0] = XPnts[point].x;
+	    c[1] = XPnts[point].y;
 
-	    if (dist2 > thresh2) /* outside threshold */
-		continue;
-		
-	    /* doesn't have an anchor yet */
-	    if (XPnts[pointb].anchor == -1) {
-		XPnts[pointb].anchor = point;
-		ntosnap++;
-	    }
-	    else if (XPnts[pointb].anchor > 0) {   /* check distance to previously assigned anchor */
-		double dist2_a;
+	    kd_found = kdtree_dnn(KDTree, c, &kduid, &kdd, thresh, &point);
+	    G_debug(4, "  %d points in threshold box", kd_found);
 
-		dx = XPnts[XPnts[pointb].anchor].x - XPnts[pointb].x;
-		dy = XPnts[XPnts[pointb].anchor].y - XPnts[pointb].y;
-		dist2_a = dx * dx + dy * dy;
+	    ntosnap += assign_anchor(XPnts, point, kduid, kd_found, thresh2);
+	    nanchors++;
 
-		/* replace old anchor */
-		if (dist2 < dist2_a) {
-		    XPnts[pointb].anchor = point;
-		}
+	    if (kd_found) {
+		G_free(kdd);
+		G_free(kduid);
 	    }
 	}
-	if (kd_found) {
-	    G_free(kdd);
-	    G_free(kduid);
-	}
     }
 
     /* Go through all lines and: 
@@ -336,184 +732,34 @@ Vect_snap_lines_list_kdtree(struct Map_info *Map, const struct ilist *List_lines
 
     G_important_message(_("Snap vertices Pass 3: snap to assigned points"));
 
-    for (line_idx = 0; line_idx < List_lines->n_values; line_idx++) {
-	int v, spoint, anchor;
-	int changed = 0;
-	double kddist;
-
-	G_percent(line_idx, List_lines->n_values, 2);
-
-	line = List_lines->value[line_idx];
+    if (G_num_workers() > 0)
+	snap_lines_block(Map, List_lines, KDTree, XPnts, thresh, Err,
+			 &nsnapped, &ncreated);
+    else {
+	for (line_idx = 0; line_idx < List_lines->n_values; line_idx++) {
+	    int changed;
 
-	G_debug(3, "line =  %d", line);
-	if (!Vect_line_alive(Map, line))
-	    continue;
+	    G_percent(line_idx, List_lines->n_values, 2);
 
-	ltype = Vect_read_line(Map, Points, Cats, line);
+	    line = List_lines->value[line_idx];
 
-	if (Points->n_points >= aindex) {
-	    aindex = Points->n_points;
-	    Index = (int *)G_realloc(Index, aindex * sizeof(int));
-	}
-
-	/* Snap all vertices */
-	G_debug(3, "Snap all vertices");
-	for (v = 0; v < Points->n_points; v++) {
-	    /* Box */
-	    c[0] = Points->x[v];
-	    c[1] = Points->y[v];
+	    G_debug(3, "line =  %d", line);
+	    if (!Vect_line_alive(Map, line))
+		continue;
 
-	    /* Find point ( should always find one point ) */
-	    Vect_reset_list(List);
+	    ltype = Vect_read_line(Map, Points, Cats, line);
 
-	    spoint = -1;
-	    kdtree_knn(KDTree, c, &spoint, &kddist, 1, NULL);
-	    if (spoint == -1)
+	    changed = snap_line(KDTree, XPnts, thresh, Points, NPoints,
+				&Index, &aindex, &New, &anew, &nsnapped,
+				&ncreated);
+	    if (changed < 0)
 		G_fatal_error("Point not in KD Tree");
 
-	    anchor = XPnts[spoint].anchor;
-
-	    if (anchor > 0) {	/* to be snapped */
-		Points->x[v] = XPnts[anchor].x;
-		Points->y[v] = XPnts[anchor].y;
-		nsnapped++;
-		changed = 1;
-		Index[v] = anchor;	/* point on new location */
-	    }
-	    else {
-		Index[v] = spoint;	/* old point */
-	    }
-	}
-
-	/* New points */
-	Vect_reset_line(NPoints);
-
-	/* Snap all segments to anchors in threshold */
-	G_debug(3, "Snap all segments");
-	for (v = 0; v < Points->n_points - 1; v++) {
-	    int i;
-	    double x1, x2, y1, y2, xmin, xmax, ymin, ymax;
-	    double rc[4];
-
-	    G_debug(3, "  segment = %d end anchors : %d  %d", v, Index[v],
-		    Index[v + 1]);
-
-	    x1 = Points->x[v];
-	    x2 = Points->x[v + 1];
-	    y1 = Points->y[v];
-	    y2 = Points->y[v + 1];
-
-	    Vect_append_point(NPoints, Points->x[v], Points->y[v],
-			      Points->z[v]);
-
-	    /* Box */
-	    if (x1 <= x2) {
-		xmin = x1;
-		xmax = x2;
-	    }
-	    else {
-		xmin = x2;
-		xmax = x1;
-	    }
-	    if (y1 <= y2) {
-		ymin = y1;
-		ymax = y2;
-	    }
-	    else {
-		ymin = y2;
-		ymax = y1;
-	    }
-
-	    /* Find points */
-	    Vect_reset_list(List);
-	    G_debug(3, "  search anchors for segment %g,%g to %g,%g", x1, y1, x2, y2);
-	    /* distance search: circle around midpoint encompassing 
-	     *                  endpoints
-	     * box search: box encompassing endpoints, 
-	     *             smaller than corresponding circle */
-	    rc[0] = xmin - thresh * 2;
-	    rc[1] = ymin - thresh * 2;
-	    rc[2] = xmax + thresh * 2;
-	    rc[3] = ymax + thresh * 2;
-	    
-	    kd_found = kdtree_rnn(KDTree, rc, &kduid, NULL);
-
-	    G_debug(3, "  %d points in box", kd_found);
-
-	    /* Snap to anchor in threshold different from end points */
-	    nnew = 0;
-	    for (i = 0; i < kd_found; i++) {
-		double dist2, along;
-		int status;
-
-		spoint = kduid[i];
-		G_debug(4, "    spoint = %d anchor = %d", spoint,
-			XPnts[spoint].anchor);
-
-		if (spoint == Index[v] || spoint == Index[v + 1])
-		    continue;	/* end point */
-		if (XPnts[spoint].anchor > 0)
-		    continue;	/* point is not anchor */
-
-		/* Check the distance */
-		dist2 =
-		    dig_distance2_point_to_line(XPnts[spoint].x,
-						XPnts[spoint].y, 0, x1, y1, 0,
-						x2, y2, 0, 0, NULL, NULL,
-						NULL, &along, &status);
-
-		G_debug(4, "      distance = %lf", sqrt(dist2));
-
-		if (status == 0 && dist2 <= thresh2) {
-		    G_debug(4, "      anchor in thresh, along = %lf", along);
-
-		    if (nnew == anew) {
-			anew += 100;
-			New = (NEW *) G_realloc(New, anew * sizeof(NEW));
-		    }
-		    New[nnew].anchor = spoint;
-		    New[nnew].along = along;
-		    nnew++;
-		}
-	    }
-	    if (kd_found) {
-		G_free(kduid);
-	    }
-	    G_debug(3, "  nnew = %d", nnew);
-	    /* insert new vertices */
-	    if (nnew > 0) {
-		/* sort by distance along the segment */
-		qsort(New, sizeof(char) * nnew, sizeof(NEW), sort_new);
-
-		for (i = 0; i < nnew; i++) {
-		    anchor = New[i].anchor;
-		    /* Vect_line_insert_point ( Points, ++v, XPnts[anchor].x, XPnts[anchor].y, 0); */
-		    Vect_append_point(NPoints, XPnts[anchor].x,
-				      XPnts[anchor].y, 0);
-		    ncreated++;
-		}
-		changed = 1;
-	    }
-	}
-
-	/* append end point */
-	v = Points->n_points - 1;
-	Vect_append_point(NPoints, Points->x[v], Points->y[v], Points->z[v]);
-
-	if (changed) {		/* rewrite the line */
-	    Vect_line_prune(NPoints);	/* remove duplicates */
-	    if (NPoints->n_points > 1 || !(ltype & GV_LINES)) {
-		Vect_rewrite_line(Map, line, ltype, NPoints, Cats);
-	    }
-	    else {
-		Vect_delete_line(Map, line);
-	    }
-	    if (Err) {
-		Vect_write_line(Err, ltype, Points, Cats);
-	    }
-	}
-    }				/* for each line */
-    G_percent(line_idx, List_lines->n_values, 2); /* finish it */
+	    if (changed)	/* rewrite the line */
+		rewrite_line(Map, line, ltype, Points, NPoints, Cats, Err);
+	}			/* for each line */
+	G_percent(line_idx, List_lines->n_values, 2); /* finish it */
+    }
 
     Vect_destroy_line_struct(Points);
     Vect_destroy_line_struct(NPoints);
@@ -26,8 +26,6 @@
 
 static off_t V1__write_line_nat(struct Map_info *, off_t, int,
 				  const struct line_pnts *, const struct line_cats *);
-static void V2__delete_area_cats_from_cidx_nat(struct Map_info *, int);
-static void V2__add_area_cats_to_cidx_nat(struct Map_info *, int);
 
 /*!
   \brief Writes feature to 'coor' file at level 1 (internal use only)
@@ -799,7 +797,11 @@ int V2__delete_line_from_topo_nat(struct Map_info *Map, int line, int type,
 	}
 	/* reattach all centroids/isles in deleted areas + new area.
 	 *  because isles are selected by box it covers also possible new isle created above */
-	if (!first) {		/* i.e. old area/isle was deleted or new one created */
+	if (!first && plus->batch.active) {
+	    /* reattached at the end of the batch */
+	    Vect__add_topo_batch_box(plus, &abox);
+	}
+	else if (!first) {	/* i.e. old area/isle was deleted or new one created */
 	    /* reattach isles */
 	    if (plus->built >= GV_BUILD_ATTACH_ISLES)
 		Vect_attach_isles(Map, &abox);
@@ -1009,7 +1011,11 @@ int V2__add_line_to_topo_nat(struct Map_info *Map, off_t offset, int type,
 	/* Reattach all centroids/isles in deleted areas + new area.
 	 * Because isles are selected by box it covers also possible
 	 * new isle created above */
-	if (!first) { /* i.e. old area/isle was deleted or new one created */
+	if (!first && plus->batch.active) {
+	    /* reattached at the end of the batch */
+	    Vect__add_topo_batch_box(plus, &abox);
+	}
+	else if (!first) { /* i.e. old area/isle was deleted or new one created */
 	    /* Reattach isles */
 	    if (plus->built >= GV_BUILD_ATTACH_ISLES)
 		Vect_attach_isles(Map, &abox);
@@ -1032,7 +1038,12 @@ int V2__add_line_to_topo_nat(struct Map_info *Map, off_t offset, int type,
     if (plus->built >= GV_BUILD_CENTROIDS) {
 	struct P_topo_c *topo;
 
-	if (type == GV_CENTROID) {
+	if (type == GV_CENTROID && plus->batch.active) {
+	    /* attached at the end of the batch */
+	    dig_line_box(points, &box);
+	    Vect__add_topo_batch_box(plus, &box);
+	}
+	else if (type == GV_CENTROID) {
 	    sel_area = Vect_find_area(Map, points->x[0], points->y[0]);
 	    G_debug(3, "  new centroid %d is in area %d", line, sel_area);
 	    if (sel_area > 0) {
@@ -38,6 +38,12 @@
 */
 #define USE_TOPO_STMT 0
 
+/*! Size of the buffer of rows loaded by COPY (simple features) */
+#define COPY_BUF_SIZE 65536
+
+/* feature table with a COPY in progress */
+static struct Format_info_pg *copy_pg_info;
+
 static int create_table(struct Format_info_pg *);
 static int check_schema(const struct Format_info_pg *);
 static int create_topo_schema(struct Format_info_pg *, int);
@@ -59,7 +65,10 @@ static char *line_to_wkb(struct Format_info_pg *, const struct line_pnts **,
                          int, int, int);
 static int write_feature(struct Map_info *, int, int,
                          const struct line_pnts **, int, int);
+static int get_attributes(const struct Format_info_pg *, int, int,
+                          dbString *, dbString *);
 static char *build_insert_stmt(const struct Format_info_pg *, const char *, int, int);
+static int copy_feature(struct Format_info_pg *, const char *, int);
 static int insert_topo_element(struct Map_info *, int, int, const char *);
 static int type_to_topogeom(const struct Format_info_pg *);
 static int update_next_edge(struct Map_info*, int, int);
@@ -1862,6 +1871,8 @@ char *line_to_wkb(struct Format_info_pg *pg_info,
    \param nparts number of parts (rings for polygon)
    \param cat category number (-1 for no category)
 
+   Simple features are loaded by COPY, see copy_feature().
+
    \return topo_id for PostGIS Topology 
    \return 0 for simple features access
    \return -1 on error
@@ -1920,8 +1931,16 @@ int write_feature(struct Map_info *Map, int line, int type,
         }
     }
 
+    if (!pg_info->toposchema_name) {
+        /* simple feature geometry + attributes */
+        int ret = copy_feature(pg_info, geom_data, cat);
+
+        G_free(geom_data);
+        return ret;
+    }
+
     /* build INSERT statement
-       simple feature geometry + attributes
+       topology element + attributes
     */
     stmt = build_insert_stmt(pg_info, geom_data, topo_id, cat);
 
@@ -1941,6 +1960,197 @@ int write_feature(struct Map_info *Map, int line, int type,
     return pg_info->toposchema_name ? topo_id : 0;
 }
 
+/*!
+   \brief Get attributes of a feature
+
+   The names of the columns (quoted) and the values are separated by
+   commas. The values are written as SQL literals or, for COPY, in
+   the text format of COPY (separated by tabs).
+
+   \param pg_info pointer to Format_info_pg structure
+   \param cat category number
+   \param copy TRUE for the text format of COPY
+   \param[out] columns column names
+   \param[out] values column values
+
+   \return 1 on success
+   \return 0 no attributes found
+ */
+int get_attributes(const struct Format_info_pg *pg_info, int cat, int copy,
+                   dbString *columns, dbString *values)
+{
+    int col, ncol, more;
+    int sqltype, ctype, is_fid;
+    char buf[DB_SQL_MAX], buf_tmp[DB_SQL_MAX];
+    const char *colname, *sep;
+
+    dbString dbstmt;
+    dbCursor cursor;
+    dbTable *table;
+    dbColumn *column;
+    dbValue *value;
+
+    struct field_info *Fi;
+
+    Fi = pg_info->fi;
+    sep = copy ? "\t" : ",";
+
+    db_init_string(&dbstmt);
+    db_set_string(columns, "");
+    db_set_string(values, "");
+
+    /* read & set attributes */
+    sprintf(buf, "SELECT * FROM %s WHERE %s = %d", Fi->table, Fi->key,
+            cat);
+    G_debug(4, "SQL: %s", buf);
+    db_set_string(&dbstmt, buf);
+
+    /* select data */
+    if (db_open_select_cursor(pg_info->dbdriver, &dbstmt,
+                              &cursor, DB_SEQUENTIAL) != DB_OK) {
+        G_warning(_("Unable to select attributes for category %d"), cat);
+        db_free_string(&dbstmt);
+        return 0;
+    }
+
+    if (db_fetch(&cursor, DB_NEXT, &more) != DB_OK) {
+        G_warning(_("Unable to fetch data from table <%s>"),
+                  Fi->table);
+        more = 0;
+    }
+    else if (!more) {
+        G_warning(_("No database record for category %d, "
+                    "no attributes will be written"), cat);
+    }
+    if (!more) {
+        db_close_cursor(&cursor);
+        db_free_string(&dbstmt);
+        return 0;
+    }
+
+    table = db_get_cursor_table(&cursor);
+    ncol = db_get_table_number_of_columns(table);
+
+    for (col = 0; col < ncol; col++) {
+        column = db_get_table_column(table, col);
+        colname = db_get_column_name(column);
+
+        /* -> values */
+        value = db_get_column_value(column);
+        /* for debug only */
+        db_convert_column_value_to_string(column, &dbstmt);
+        G_debug(3, "col %d : val = %s", col,
+                db_get_string(&dbstmt));
+
+        sqltype = db_get_column_sqltype(column);
+        ctype = db_sqltype_to_Ctype(sqltype);
+
+        is_fid = strcmp(pg_info->fid_column, colname) == 0;
+
+        /* check fid column (must be integer) */
+        if (is_fid == TRUE &&
+            ctype != DB_C_TYPE_INT) {
+            G_warning(_("FID column must be integer, column <%s> ignored!"),
+                      colname);
+            continue;
+        }
+
+        /* -> columns */
+        if (*db_get_string(columns)) {
+            db_append_string(columns, ",");
+            db_append_string(values, sep);
+        }
+        sprintf(buf_tmp, "\"%s\"", colname);
+        db_append_string(columns, buf_tmp);
+
+        /* prevent writing NULL values */
+        if (!db_test_value_isnull(value)) {
+            switch (ctype) {
+            case DB_C_TYPE_INT:
+                sprintf(buf_tmp, "%d", db_get_value_int(value));
+                db_append_string(values, buf_tmp);
+                break;
+            case DB_C_TYPE_DOUBLE:
+                sprintf(buf_tmp, "%.14f",
+                        db_get_value_double(value));
+                db_append_string(values, buf_tmp);
+                break;
+            case DB_C_TYPE_STRING:
+            case DB_C_TYPE_DATETIME: {
+                const char *str;
+                char *value_tmp;
+
+                if (ctype == DB_C_TYPE_DATETIME) {
+                    db_convert_column_value_to_string(column, &dbstmt);
+                    str = db_get_string(&dbstmt);
+                }
+                else
+                    str = db_get_value_string(value);
+
+                if (copy) {
+                    /* backslashes and separators are escaped */
+                    const char *c;
+                    char *v;
+
+                    value_tmp = v = G_malloc(2 * strlen(str) + 1);
+                    for (c = str; *c; c++) {
+                        switch (*c) {
+                        case '\\':
+                            *v++ = '\\';
+                            *v++ = '\\';
+                            break;
+                        case '\t':
+                            *v++ = '\\';
+                            *v++ = 't';
+                            break;
+                        case '\n':
+                            *v++ = '\\';
+                            *v++ = 'n';
+                            break;
+                        case '\r':
+                            *v++ = '\\';
+                            *v++ = 'r';
+                            break;
+                        default:
+                            *v++ = *c;
+                            break;
+                        }
+                    }
+                    *v = '\0';
+                    db_append_string(values, value_tmp);
+                }
+                else if (ctype == DB_C_TYPE_STRING) {
+                    value_tmp = G_str_replace(str, "'", "''");
+                    db_append_string(values, "'");
+                    db_append_string(values, value_tmp);
+                    db_append_string(values, "'");
+                }
+                else {
+                    value_tmp = G_store(str);
+                    db_append_string(values, value_tmp);
+                }
+                G_free(value_tmp);
+                break;
+            }
+            default:
+                G_warning(_("Unsupported column type %d"), ctype);
+                db_append_string(values, copy ? "\\N" : "NULL");
+                break;
+            }
+        }
+        else {
+            if (is_fid == TRUE)
+                G_warning(_("Invalid value for FID column: NULL"));
+            db_append_string(values, copy ? "\\N" : "NULL");
+        }
+    }
+
+    db_close_cursor(&cursor);
+    db_free_string(&dbstmt);
+
+    return 1;
+}
+
 /*!
    \brief Build INSERT statement to add new feature to the feature
    table
@@ -1961,7 +2171,7 @@ char *build_insert_stmt(const struct Format_info_pg *pg_info,
 {
     int topogeom_type;
     
-    char *stmt, buf[DB_SQL_MAX];
+    char *stmt;
 
     struct field_info *Fi;
     
@@ -1977,136 +2187,38 @@ char *build_insert_stmt(const struct Format_info_pg *pg_info,
     stmt = NULL;
     if (Fi && cat > -1) {
         /* write attributes (simple features and topology elements) */
-        int col, ncol, more;
-        int sqltype, ctype, is_fid;
-        char buf_val[DB_SQL_MAX], buf_tmp[DB_SQL_MAX];
-
-        const char *colname;
+        dbString columns, values;
 
-        dbString dbstmt;
-        dbCursor cursor;
-        dbTable *table;
-        dbColumn *column;
-        dbValue *value;
+        db_init_string(&columns);
+        db_init_string(&values);
 
-        db_init_string(&dbstmt);
-        buf_val[0] = '\0';
-
-        /* read & set attributes */
-        sprintf(buf, "SELECT * FROM %s WHERE %s = %d", Fi->table, Fi->key,
-                cat);
-        G_debug(4, "SQL: %s", buf);
-        db_set_string(&dbstmt, buf);
-        
-        /* prepare INSERT statement */
-        sprintf(buf, "INSERT INTO \"%s\".\"%s\" (",
-                pg_info->schema_name, pg_info->table_name);
-        
-        /* select data */
-        if (db_open_select_cursor(pg_info->dbdriver, &dbstmt,
-                                  &cursor, DB_SEQUENTIAL) != DB_OK) {
-            G_warning(_("Unable to select attributes for category %d"), cat);
-        }
-        else {
-            if (db_fetch(&cursor, DB_NEXT, &more) != DB_OK) {
-                G_warning(_("Unable to fetch data from table <%s>"),
-                          Fi->table);
-            }
+        if (get_attributes(pg_info, cat, FALSE, &columns, &values)) {
+            const char *sep = *db_get_string(&columns) ? "," : "";
 
-            if (!more) {
-                G_warning(_("No database record for category %d, "
-                            "no attributes will be written"), cat);
+            if (!pg_info->toposchema_name) {
+                /* simple feature access */
+                G_asprintf(&stmt, "INSERT INTO \"%s\".\"%s\" (%s%s%s) "
+                           "VALUES (%s%s'%s'::GEOMETRY)",
+                           pg_info->schema_name, pg_info->table_name,
+                           db_get_string(&columns), sep,
+                           pg_info->geom_column, db_get_string(&values),
+                           sep, geom_data);
             }
             else {
-                table = db_get_cursor_table(&cursor);
-                ncol = db_get_table_number_of_columns(table);
-
-                for (col = 0; col < ncol; col++) {
-                    column = db_get_table_column(table, col);
-                    colname = db_get_column_name(column);
-
-		    /* -> values */
-                    value = db_get_column_value(column);
-                    /* for debug only */
-                    db_convert_column_value_to_string(column, &dbstmt);
-                    G_debug(3, "col %d : val = %s", col,
-                            db_get_string(&dbstmt));
-
-                    sqltype = db_get_column_sqltype(column);
-                    ctype = db_sqltype_to_Ctype(sqltype);
-
-		    is_fid = strcmp(pg_info->fid_column, colname) == 0;
-		    
-		    /* check fid column (must be integer) */
-                    if (is_fid == TRUE &&
-			ctype != DB_C_TYPE_INT) {
-			G_warning(_("FID column must be integer, column <%s> ignored!"),
-				  colname);
-                        continue;
-		    }
-
-                    /* -> columns */
-                    sprintf(buf_tmp, "\"%s\"", colname);
-                    strcat(buf, buf_tmp);
-                    if (col < ncol - 1)
-                        strcat(buf, ",");
-		    
-                    /* prevent writing NULL values */
-                    if (!db_test_value_isnull(value)) {
-                        switch (ctype) {
-                        case DB_C_TYPE_INT:
-                            sprintf(buf_tmp, "%d", db_get_value_int(value));
-                            break;
-                        case DB_C_TYPE_DOUBLE:
-                            sprintf(buf_tmp, "%.14f",
-                                    db_get_value_double(value));
-                            break;
-                        case DB_C_TYPE_STRING: {
-                            char *value_tmp;
-                            value_tmp = G_str_replace(db_get_value_string(value), "'", "''");
-                            sprintf(buf_tmp, "'%s'", value_tmp);
-                            G_free(value_tmp);
-                            break;
-                        }
-                        case DB_C_TYPE_DATETIME:
-                            db_convert_column_value_to_string(column,
-                                                              &dbstmt);
-                            sprintf(buf_tmp, "%s", db_get_string(&dbstmt));
-                            break;
-                        default:
-                            G_warning(_("Unsupported column type %d"), ctype);
-                            sprintf(buf_tmp, "NULL");
-                            break;
-                        }
-                    }
-                    else {
-			if (is_fid == TRUE)
-			    G_warning(_("Invalid value for FID column: NULL"));
-                        sprintf(buf_tmp, "NULL");
-                    }
-                    strcat(buf_val, buf_tmp);
-                    if (col < ncol - 1)
-                        strcat(buf_val, ",");
-                }
-                
-                if (!pg_info->toposchema_name) {
-                    /* simple feature access */
-                    G_asprintf(&stmt, "%s,%s) VALUES (%s,'%s'::GEOMETRY)",
-                               buf, pg_info->geom_column, buf_val, geom_data);
-                }
-                else {
-                    /* PostGIS topology access, write geometry in
-                     * topology schema, skip geometry at this point */
-		    if (buf[strlen(buf)-1] == ',') { /* last column skipped */
-			buf[strlen(buf)-1] = '\0';
-			buf_val[strlen(buf_val)-1] = '\0';
-		    }
-                    G_asprintf(&stmt, "%s, %s) VALUES (%s, '(%d, 1, %d, %d)'::topology.TopoGeometry)",
-                               buf, pg_info->topogeom_column, buf_val,
-                               pg_info->toposchema_id, topo_id, topogeom_type);
-                }
+                /* PostGIS topology access, write geometry in
+                 * topology schema, skip geometry at this point */
+                G_asprintf(&stmt, "INSERT INTO \"%s\".\"%s\" (%s%s %s) "
+                           "VALUES (%s%s '(%d, 1, %d, %d)'::topology.TopoGeometry)",
+                           pg_info->schema_name, pg_info->table_name,
+                           db_get_string(&columns), sep,
+                           pg_info->topogeom_column, db_get_string(&values),
+                           sep, pg_info->toposchema_id, topo_id,
+                           topogeom_type);
             }
         }
+
+        db_free_string(&columns);
+        db_free_string(&values);
     }
     else {
         /* no attributes */
@@ -2143,6 +2255,160 @@ char *build_insert_stmt(const struct Format_info_pg *pg_info,
     return stmt;
 }
 
+/*!
+   \brief Load simple feature into the feature table by COPY
+
+   The rows are collected in a buffer and sent to the server when the
+   buffer is full. The COPY is ended by Vect__end_copy_pg(), which is
+   called before any other statement is executed on the connection,
+   or when the columns change. Like with INSERT, features without
+   attributes (if attributes are written) are skipped.
+
+   \param pg_info pointer to Format_info_pg structure
+   \param geom_data geometry data (hex EWKB)
+   \param cat category number (or -1 for no category)
+
+   \return 0 on success
+   \return -1 on error
+ */
+int copy_feature(struct Format_info_pg *pg_info, const char *geom_data,
+                 int cat)
+{
+    dbString columns, row;
+    char buf[DB_SQL_MAX];
+    size_t len;
+    int ret;
+
+    db_init_string(&columns);
+    db_init_string(&row);
+
+    if (pg_info->fi && cat > -1) {
+        if (!get_attributes(pg_info, cat, TRUE, &columns, &row)) {
+            db_free_string(&columns);
+            db_free_string(&row);
+            return 0;
+        }
+    }
+    else if (cat > 0) {
+        sprintf(buf, "%d", cat);
+        db_set_string(&columns, GV_KEY_COLUMN);
+        db_set_string(&row, buf);
+    }
+    if (*db_get_string(&columns)) {
+        db_append_string(&columns, ",");
+        db_append_string(&row, "\t");
+    }
+    db_append_string(&columns, pg_info->geom_column);
+    db_append_string(&row, geom_data);
+    db_append_string(&row, "\n");
+
+    ret = 0;
+    if (pg_info->copy_columns &&
+        strcmp(pg_info->copy_columns, db_get_string(&columns)) != 0)
+        ret = Vect__end_copy_pg(pg_info->conn);
+
+    if (ret == 0 && !pg_info->copy_columns) {
+        char *stmt;
+        PGresult *res;
+
+        /* only one COPY at a time */
+        if (copy_pg_info)
+            ret = Vect__end_copy_pg(copy_pg_info->conn);
+        Vect__sync_pg(pg_info->conn);
+
+        G_asprintf(&stmt, "COPY \"%s\".\"%s\" (%s) FROM STDIN",
+                   pg_info->schema_name, pg_info->table_name,
+                   db_get_string(&columns));
+        G_debug(3, "SQL: %s", stmt);
+        res = PQexec(pg_info->conn, stmt);
+        if (!res || PQresultStatus(res) != PGRES_COPY_IN) {
+            G_warning(_("Execution failed: %s\nReason: %s"), stmt,
+                      PQerrorMessage(pg_info->conn));
+            ret = -1;
+        }
+        else {
+            pg_info->copy_columns = G_store(db_get_string(&columns));
+            copy_pg_info = pg_info;
+        }
+        PQclear(res);
+        G_free(stmt);
+    }
+
+    if (ret == 0) {
+        len = strlen(db_get_string(&row));
+        if (pg_info->copy_len + len > pg_info->copy_alloc) {
+            pg_info->copy_alloc = pg_info->copy_len + len + COPY_BUF_SIZE;
+            pg_info->copy_buf = G_realloc(pg_info->copy_buf,
+                                          pg_info->copy_alloc);
+        }
+        memcpy(pg_info->copy_buf + pg_info->copy_len, db_get_string(&row),
+               len);
+        pg_info->copy_len += len;
+
+        if (pg_info->copy_len >= COPY_BUF_SIZE) {
+            if (PQputCopyData(pg_info->conn, pg_info->copy_buf,
+                              pg_info->copy_len) != 1) {
+                G_warning(_("Unable to copy features into <%s>\nReason: %s"),
+                          pg_info->table_name, PQerrorMessage(pg_info->conn));
+                ret = -1;
+            }
+            pg_info->copy_len = 0;
+        }
+    }
+
+    db_free_string(&columns);
+    db_free_string(&row);
+
+    return ret;
+}
+
+/*!
+   \brief End COPY of simple features in progress on connection
+   (internal use only)
+
+   The buffered rows are sent to the server. Must be called before
+   any other statement is executed on the connection.
+
+   \param conn pointer to PGconn
+
+   \return 0 on success (or no COPY in progress)
+   \return -1 on error
+ */
+int Vect__end_copy_pg(PGconn *conn)
+{
+    struct Format_info_pg *pg_info;
+    PGresult *res;
+    int ret;
+
+    pg_info = copy_pg_info;
+    if (!pg_info || pg_info->conn != conn)
+        return 0;
+
+    copy_pg_info = NULL;
+    ret = 0;
+    if (pg_info->copy_len > 0 &&
+        PQputCopyData(conn, pg_info->copy_buf, pg_info->copy_len) != 1)
+        ret = -1;
+    if (PQputCopyEnd(conn, ret == 0 ? NULL : "write error") != 1)
+        ret = -1;
+    while ((res = PQgetResult(conn))) {
+        if (PQresultStatus(res) != PGRES_COMMAND_OK)
+            ret = -1;
+        PQclear(res);
+    }
+    if (ret == -1)
+        G_warning(_("Unable to copy features into <%s>\nReason: %s"),
+                  pg_info->table_name, PQerrorMessage(conn));
+
+    G_free(pg_info->copy_columns);
+    pg_info->copy_columns = NULL;
+    G_free(pg_info->copy_buf);
+    pg_info->copy_buf = NULL;
+    pg_info->copy_len = pg_info->copy_alloc = 0;
+
+    return ret;
+}
+
 /*!
   \brief Insert topological element into 'node' or 'edge' table
 
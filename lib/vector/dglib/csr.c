@@ -0,0 +1,188 @@
+/* LIBDGL -- a Directed Graph Library implementation
+ * Copyright (C) 2002 Roberto Micarelli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * best view with tabstop=4
+ */
+
+/*
+ * Compressed Sparse Row export of a flat graph: the edges departing
+ * from each node are stored contiguously, so that the algorithms can
+ * run over plain arrays instead of the node and edge buffers.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DGL_V2 1
+
+#include "type.h"
+#include "tree.h"
+#include "graph.h"
+#include "graph_v2.h"
+#include "helpers.h"
+
+static int cmp_id(const void *pa, const void *pb)
+{
+    dglInt64_t a = *(const dglInt64_t *)pa;
+    dglInt64_t b = *(const dglInt64_t *)pb;
+
+    return (a > b) - (a < b);
+}
+
+/*
+ * visit the edges departing from pnNode: if pCSR->pnTarget is NULL only
+ * count them, otherwise store them from pCSR->pnOffset[iNode] on
+ */
+static int csr_node_edges(dglGraph_s * pgraph, dglCSR_s * pCSR,
+			  dglInt32_t * pnNode, dglInt64_t iNode,
+			  dglInt64_t * pcEdge)
+{
+    dglEdgesetTraverser_s et;
+    dglInt32_t *pnEdgeset, *pnEdge, *pnOther;
+    dglInt64_t iEdge;
+    int iWay;
+
+    iEdge = pCSR->pnTarget ? pCSR->pnOffset[iNode] : 0;
+    for (iWay = 0; iWay < (pgraph->Version == 3 ? 2 : 1); iWay++) {
+	pnEdgeset = iWay == 0 ? dglNodeGet_OutEdgeset(pgraph, pnNode) :
+	    dglNodeGet_InEdgeset(pgraph, pnNode);
+	if (pnEdgeset == NULL)
+	    continue;
+	if (dglEdgeset_T_Initialize(&et, pgraph, pnEdgeset) < 0)
+	    return -pgraph->iErrno;
+	for (pnEdge = dglEdgeset_T_First(&et); pnEdge;
+	     pnEdge = dglEdgeset_T_Next(&et)) {
+	    if (iWay == 1 && (DGL_EDGE_STATUS_v2(pnEdge) & DGL_ES_DIRECTED))
+		continue;
+	    if (pCSR->pnTarget) {
+		pnOther = iWay == 0 ? dglEdgeGet_Tail(pgraph, pnEdge) :
+		    dglEdgeGet_Head(pgraph, pnEdge);
+		pCSR->pnTarget[iEdge] =
+		    dglCSRNodeIndex(pCSR, dglNodeGet_Id(pgraph, pnOther));
+		pCSR->pnCost[iEdge] = dglEdgeGet_Cost(pgraph, pnEdge);
+		pCSR->pnEdgeId[iEdge] = dglEdgeGet_Id(pgraph, pnEdge);
+	    }
+	    iEdge++;
+	}
+	dglEdgeset_T_Release(&et);
+    }
+
+    *pcEdge = iEdge;
+    return 0;
+}
+
+/*
+ * build the compressed sparse row arrays of a flat graph
+ * returns 0 on success, a negative error code on failure
+ */
+int dglCSRExport(dglGraph_s * pgraph, dglCSR_s * pCSR)
+{
+    dglNodeTraverser_s nt;
+    dglInt32_t *pnNode;
+    dglInt64_t i, cEdge;
+    int nret;
+
+    memset(pCSR, 0, sizeof(dglCSR_s));
+
+    if (!(pgraph->Flags & DGL_GS_FLAT)) {
+	pgraph->iErrno = DGL_ERR_BadOnTreeGraph;
+	return -pgraph->iErrno;
+    }
+
+    /* node ids, the flat node buffer is usually sorted already */
+    pCSR->pnNodeId = malloc((pgraph->cNode + 1) * sizeof(dglInt64_t));
+    pCSR->pnOffset = malloc((pgraph->cNode + 1) * sizeof(dglInt64_t));
+    if (pCSR->pnNodeId == NULL || pCSR->pnOffset == NULL)
+	goto csr_nomem;
+    if (dglNode_T_Initialize(&nt, pgraph) < 0) {
+	nret = -pgraph->iErrno;
+	goto csr_error;
+    }
+    for (pnNode = dglNode_T_First(&nt); pnNode && pCSR->cNode < pgraph->cNode;
+	 pnNode = dglNode_T_Next(&nt))
+	pCSR->pnNodeId[pCSR->cNode++] = dglNodeGet_Id(pgraph, pnNode);
+    dglNode_T_Release(&nt);
+    for (i = 1; i < pCSR->cNode; i++) {
+	if (pCSR->pnNodeId[i - 1] > pCSR->pnNodeId[i]) {
+	    qsort(pCSR->pnNodeId, pCSR->cNode, sizeof(dglInt64_t), cmp_id);
+	    break;
+	}
+    }
+
+    /* count the edges of each node, then store them */
+    pCSR->pnOffset[0] = 0;
+    for (i = 0; i < pCSR->cNode; i++) {
+	pnNode = dglGetNode(pgraph, pCSR->pnNodeId[i]);
+	if ((nret = csr_node_edges(pgraph, pCSR, pnNode, i, &cEdge)) < 0)
+	    goto csr_error;
+	pCSR->pnOffset[i + 1] = pCSR->pnOffset[i] + cEdge;
+    }
+    pCSR->cEdge = pCSR->pnOffset[pCSR->cNode];
+
+    pCSR->pnTarget = malloc((pCSR->cEdge + 1) * sizeof(dglInt64_t));
+    pCSR->pnCost = malloc((pCSR->cEdge + 1) * sizeof(dglInt64_t));
+    pCSR->pnEdgeId = malloc((pCSR->cEdge + 1) * sizeof(dglInt64_t));
+    if (pCSR->pnTarget == NULL || pCSR->pnCost == NULL ||
+	pCSR->pnEdgeId == NULL)
+	goto csr_nomem;
+    for (i = 0; i < pCSR->cNode; i++) {
+	pnNode = dglGetNode(pgraph, pCSR->pnNodeId[i]);
+	if ((nret = csr_node_edges(pgraph, pCSR, pnNode, i, &cEdge)) < 0)
+	    goto csr_error;
+    }
+
+    pgraph->iErrno = 0;
+    return 0;
+
+  csr_nomem:
+    pgraph->iErrno = DGL_ERR_MemoryExhausted;
+    nret = -pgraph->iErrno;
+  csr_error:
+    dglCSRRelease(pCSR);
+    return nret;
+}
+
+void dglCSRRelease(dglCSR_s * pCSR)
+{
+    free(pCSR->pnNodeId);
+    free(pCSR->pnOffset);
+    free(pCSR->pnTarget);
+    free(pCSR->pnCost);
+    free(pCSR->pnEdgeId);
+    memset(pCSR, 0, sizeof(dglCSR_s));
+}
+
+/*
+ * number of the node with id nNodeId, -1 if there is no such node
+ */
+dglInt64_t dglCSRNodeIndex(dglCSR_s * pCSR, dglInt64_t nNodeId)
+{
+    dglInt64_t lo = 0, hi = pCSR->cNode - 1, mid;
+
+    while (lo <= hi) {
+	mid = lo + (hi - lo) / 2;
+	if (pCSR->pnNodeId[mid] < nNodeId)
+	    lo = mid + 1;
+	else if (pCSR->pnNodeId[mid] > nNodeId)
+	    hi = mid - 1;
+	else
+	    return mid;
+    }
+    return -1;
+}
@@ -274,6 +274,26 @@ typedef struct
     dglEdgePrioritizer_s *pEdgePrioritizer;
 } dglEdgeTraverser_s;
 
+/*
+ * Compressed Sparse Row export of a flat graph
+ *
+ * The nodes are numbered 0 .. cNode-1 in ascending order of their ids.
+ * The edges departing from node i are pnTarget[pnOffset[i] .. pnOffset[i+1]-1]
+ * (node numbers) with costs in pnCost and ids in pnEdgeId. In a version 3
+ * graph the undirected edges arriving at a node are stored as departing
+ * edges as well, like the shortest path search follows them.
+ */
+typedef struct
+{
+    dglInt64_t cNode;
+    dglInt64_t cEdge;
+    dglInt64_t *pnNodeId;	/* cNode */
+    dglInt64_t *pnOffset;	/* cNode + 1 */
+    dglInt64_t *pnTarget;	/* cEdge */
+    dglInt64_t *pnCost;		/* cEdge */
+    dglInt64_t *pnEdgeId;	/* cEdge */
+} dglCSR_s;
+
 
 /*
  * Error codes returned by dglError
@@ -510,4 +530,12 @@ void dglEdge_T_Release(dglEdgeTraverser_s * pTraverser);
 dglInt32_t *dglEdge_T_First(dglEdgeTraverser_s * pTraverser);
 dglInt32_t *dglEdge_T_Next(dglEdgeTraverser_s * pTraverser);
 
+
+/*
+ * compressed sparse row export
+ */
+int dglCSRExport(dglGraph_s * pGraph, dglCSR_s * pCSR);
+void dglCSRRelease(dglCSR_s * pCSR);
+dglInt64_t dglCSRNodeIndex(dglCSR_s * pCSR, dglInt64_t nNodeId);
+
 #endif
@@ -23,6 +23,12 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef __MINGW32__
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
 #include <grass/vector.h>
 #include <grass/glocale.h>
 
@@ -258,15 +264,94 @@ int dig_file_load(struct gvfile * file)
     return 0;
 }
 
+/*!
+  \brief Map opened struct gvfile read-only into memory.
+
+  The file is then read from the mapping as if loaded by
+  dig_file_load(), without copying it. The file must not be written.
+
+  Warning: position in file is set to the beginning.
+
+  \param file pointer to struct gvfile structure
+
+  \return 1 mapped
+  \return 0 not mapped (the file is read as usual)
+*/
+int dig_file_map(struct gvfile * file)
+{
+    struct stat sbuf;
+    size_t size;
+    void *ptr;
+
+    G_debug(2, "dig_file_map ()");
+
+    if (file->file == NULL || file->loaded)
+	return 0;
+
+    if (fstat(fileno(file->file), &sbuf) < 0 || sbuf.st_size <= 0 ||
+	(off_t) (size_t) sbuf.st_size != sbuf.st_size)
+	return 0;
+    size = sbuf.st_size;
+
+#ifdef __MINGW32__
+    {
+	HANDLE handle =
+	    CreateFileMapping((HANDLE) _get_osfhandle(fileno(file->file)),
+			      NULL, PAGE_READONLY, 0, 0, NULL);
+
+	ptr = handle ? MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0) : NULL;
+	/* the view keeps the mapping */
+	if (handle)
+	    CloseHandle(handle);
+	if (!ptr) {
+	    G_debug(2, "  mapping failed");
+	    return 0;
+	}
+    }
+#else
+    ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(file->file),
+	       (off_t) 0);
+    if (ptr == MAP_FAILED) {
+	G_debug(2, "  mapping failed");
+	return 0;
+    }
+#endif
+
+    file->start = ptr;
+    file->alloc = 0;
+    file->size = size;
+    file->current = file->start;
+    file->end = file->start + size;
+
+    file->loaded = 2;
+    G_debug(2, "  file was mapped to the memory, size = %lu",
+	    (long unsigned int) size);
+
+    return 1;
+}
+
 /*!
   \brief Free struct gvfile.
 
+  Frees the memory of a file loaded by dig_file_load() or unmaps a file
+  mapped by dig_file_map().
+
   \param file pointer to struct gvfile structure
 */
 void dig_file_free(struct gvfile * file)
 {
-    if (file->loaded) {
+    if (file->loaded == 2) {
+#ifdef __MINGW32__
+	UnmapViewOfFile(file->start);
+#else
+	munmap(file->start, (size_t) file->size);
+#endif
+    }
+    else if (file->loaded)
 	G_free(file->start);
+
+    if (file->loaded) {
+	file->start = file->current = file->end = NULL;
 	file->loaded = 0;
 	file->alloc = 0;
     }
@@ -181,6 +181,11 @@ void dig_free_plus(struct Plus_head *Plus)
 
     dig_spidx_free(Plus);
     dig_cidx_free(Plus);
+
+    G_free(Plus->batch.boxes);
+    Plus->batch.boxes = NULL;
+    Plus->batch.n_boxes = Plus->batch.alloc_boxes = 0;
+    Plus->batch.active = 0;
 }
 
 /*!
@@ -42,10 +42,18 @@ extern unsigned char lng_cnvrt[sizeof(long)];
 extern unsigned char int_cnvrt[sizeof(int)];
 extern unsigned char shrt_cnvrt[sizeof(short)];
 
-struct Port_info *Cur_Head;
-
-static char *buffer = NULL;
-static int buf_alloced = 0;
+/* the current port and the conversion buffer are per thread, so that
+   several threads can read features, see Vect_new_reader() */
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif
+
+THREAD_LOCAL struct Port_info *Cur_Head;
+
+static THREAD_LOCAL char *buffer = NULL;
+static THREAD_LOCAL int buf_alloced = 0;
 
 static int buf_alloc(int needed)
 {
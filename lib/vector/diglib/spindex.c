@@ -778,6 +778,71 @@ int dig_select_lines(struct Plus_head *Plus, const struct bound_box *box,
     return (list->n_values);
 }
 
+/* select items of a spatial index by box, the rectangle is not shared */
+static int select_r(struct Plus_head *Plus, struct RTree *t,
+		    const struct bound_box *box, struct boxlist *list)
+{
+    struct RTree_Rect rect;
+    RectReal boundary[6];
+
+    list->n_values = 0;
+
+    rect.boundary = boundary;
+    rect.boundary[0] = box->W;
+    rect.boundary[1] = box->S;
+    rect.boundary[2] = box->B;
+    rect.boundary[3] = box->E;
+    rect.boundary[4] = box->N;
+    rect.boundary[5] = box->T;
+
+    if (Plus->Spidx_new)
+	RTreeSearch(t, &rect, (void *)_add_item_with_box, list);
+    else
+	rtree_search(t, &rect, (void *)_add_item_with_box, list, Plus);
+
+    return (list->n_values);
+}
+
+/*!
+   \brief Select lines with boxes by box (reentrant version)
+
+   Same as dig_select_lines(), but several threads may search the
+   spatial index at the same time if dig_spidx_reentrant() is true.
+
+   \param Plus pointer to Plus_head structure
+   \param box bounding box
+   \param[out] list boxlist of selected lines
+
+   \return number of selected lines
+ */
+int dig_select_lines_r(struct Plus_head *Plus, const struct bound_box *box,
+		       struct boxlist *list)
+{
+    G_debug(3, "dig_select_lines_r()");
+
+    return select_r(Plus, Plus->Line_spidx, box, list);
+}
+
+/*!
+   \brief Select areas with boxes by box (reentrant version)
+
+   Same as dig_select_areas(), but several threads may search the
+   spatial index at the same time if dig_spidx_reentrant() is true.
+
+   \param Plus pointer to Plus_head structure
+   \param box bounding box
+   \param[out] list boxlist of selected areas
+
+   \return number of selected areas
+ */
+int dig_select_areas_r(struct Plus_head *Plus, const struct bound_box *box,
+		       struct boxlist *list)
+{
+    G_debug(3, "dig_select_areas_r()");
+
+    return select_r(Plus, Plus->Area_spidx, box, list);
+}
+
 /*!
    \brief Find box for line
 
@@ -29,6 +29,23 @@
 #define NUMSIDES 6
 #endif
 
+/* nodes are written to slots of a multiple of SIDX_NODE_ALIGN bytes,
+ * each tree starts at a multiple of SIDX_NODE_ALIGN: nodes of a memory
+ * mapped sidx file do not straddle pages */
+#define SIDX_NODE_ALIGN 512
+#define SIDX_NODE_SLOT(size) \
+    (((size) + SIDX_NODE_ALIGN - 1) / SIDX_NODE_ALIGN * SIDX_NODE_ALIGN)
+
+/* write zeros up to the next multiple of SIDX_NODE_ALIGN */
+static void sidx_pad(struct gvfile *fp)
+{
+    static const char zero[SIDX_NODE_ALIGN];
+    int pad = (int)(dig_ftell(fp) % SIDX_NODE_ALIGN);
+
+    if (pad)
+	dig_fwrite(zero, 1, SIDX_NODE_ALIGN - pad, fp);
+}
+
 /* TODO: merge these two */
 struct spidxstack
 {
@@ -65,11 +82,15 @@ int dig_Wr_spidx_head(struct gvfile * fp, struct Plus_head *ptr)
 
     /* use ptr->off_t_size = 4 if possible */
     if (sizeof(off_t) > 4) {
+	size_t slot = SIDX_NODE_SLOT(2 * PORT_INT + MAXCARD *
+				     (8 + NUMSIDES * PORT_DOUBLE));
+
 	size = 145;	/* max header size, see below */
-	size += ptr->Node_spidx->n_nodes * ptr->Node_spidx->nodesize;
-	size += ptr->Line_spidx->n_nodes * ptr->Line_spidx->nodesize;
-	size += ptr->Area_spidx->n_nodes * ptr->Area_spidx->nodesize;
-	size += ptr->Isle_spidx->n_nodes * ptr->Isle_spidx->nodesize;
+	size += 4 * SIDX_NODE_ALIGN;	/* alignment of the trees */
+	size += ptr->Node_spidx->n_nodes * slot;
+	size += ptr->Line_spidx->n_nodes * slot;
+	size += ptr->Area_spidx->n_nodes * slot;
+	size += ptr->Isle_spidx->n_nodes * slot;
 
 	if (size < PORT_INT_MAX)
 	    ptr->spidx_port.off_t_size = 4;
@@ -703,9 +724,11 @@ static off_t rtree_write_from_memory(struct gvfile *fp, off_t startpos,
 
     /* should be foolproof */
     sidx_nodesize =
-	(int)(2 * PORT_INT + t->nodecard * (off_t_size + NUMSIDES * PORT_DOUBLE));
+	(int)SIDX_NODE_SLOT(2 * PORT_INT + t->nodecard *
+			    (off_t_size + NUMSIDES * PORT_DOUBLE));
     sidx_leafsize =
-	(int)(2 * PORT_INT + t->leafcard * (off_t_size + NUMSIDES * PORT_DOUBLE));
+	(int)SIDX_NODE_SLOT(2 * PORT_INT + t->leafcard *
+			    (off_t_size + NUMSIDES * PORT_DOUBLE));
 
     /* stack size of t->rootlevel + 1 would be enough because of
      * depth-first post-order traversal:
@@ -764,6 +787,7 @@ static off_t rtree_write_from_memory(struct gvfile *fp, off_t startpos,
 		    s[top].pos[j] = (off_t) s[top].sn->branch[j].child.id;
 		dig__fwrite_port_O(&(s[top].pos[j]), 1, fp, off_t_size);
 	    }
+	    sidx_pad(fp);
 
 	    top--;
 	    /* update corresponding child position of parent node
@@ -822,9 +846,11 @@ static off_t rtree_write_from_file(struct gvfile *fp, off_t startpos,
 
     /* should be foolproof */
     sidx_nodesize =
-	(int)(2 * PORT_INT + t->nodecard * (off_t_size + NUMSIDES * PORT_DOUBLE));
+	(int)SIDX_NODE_SLOT(2 * PORT_INT + t->nodecard *
+			    (off_t_size + NUMSIDES * PORT_DOUBLE));
     sidx_leafsize =
-	(int)(2 * PORT_INT + t->leafcard * (off_t_size + NUMSIDES * PORT_DOUBLE));
+	(int)SIDX_NODE_SLOT(2 * PORT_INT + t->leafcard *
+			    (off_t_size + NUMSIDES * PORT_DOUBLE));
 
     /* stack size of t->rootlevel + 1 would be enough because of
      * depth-first post-order traversal:
@@ -881,6 +907,7 @@ static off_t rtree_write_from_file(struct gvfile *fp, off_t startpos,
 		    s[top].pos[j] = (off_t) s[top].sn.branch[j].child.id;
 		dig__fwrite_port_O(&(s[top].pos[j]), 1, fp, off_t_size);
 	    }
+	    sidx_pad(fp);
 
 	    top--;
 	    /* update corresponding child position of parent node
@@ -1186,21 +1213,25 @@ int dig_Wr_spidx(struct gvfile *fp, struct Plus_head *Plus)
     dig_Wr_spidx_head(fp, Plus);
 
     /* Nodes */
+    sidx_pad(fp);
     Plus->Node_spidx_offset =
 	rtree_write_to_sidx(fp, dig_ftell(fp), Plus->Node_spidx,
 			    Plus->spidx_port.off_t_size);
 
     /* Lines */
+    sidx_pad(fp);
     Plus->Line_spidx_offset =
 	rtree_write_to_sidx(fp, dig_ftell(fp), Plus->Line_spidx,
 			    Plus->spidx_port.off_t_size);
 
     /* Areas */
+    sidx_pad(fp);
     Plus->Area_spidx_offset =
 	rtree_write_to_sidx(fp, dig_ftell(fp), Plus->Area_spidx,
 			    Plus->spidx_port.off_t_size);
 
     /* Isles */
+    sidx_pad(fp);
     Plus->Isle_spidx_offset =
 	rtree_write_to_sidx(fp, dig_ftell(fp), Plus->Isle_spidx,
 			    Plus->spidx_port.off_t_size);
@@ -1381,6 +1412,120 @@ static struct RTree_Node *rtree_get_node(off_t nodepos, int level,
 }
 
 
+/* the nodes of a memory mapped sidx file in native byte order can be
+ * used in place */
+static int rtree_mapped(const struct Plus_head *Plus)
+{
+    const struct Port_info *port = &(Plus->spidx_port);
+
+    return Plus->spidx_fp.loaded == 2 && port->dbl_quick &&
+	port->int_quick && port->off_t_quick &&
+	(port->off_t_size == 4 ||
+	 (port->off_t_size == 8 && sizeof(off_t) == 8));
+}
+
+/*!
+   \brief Check if the spatial index can be searched by several threads
+
+   Spatial indices in memory and memory mapped sidx files in native
+   byte order are searched without shared buffers by
+   dig_select_lines_r() and dig_select_areas_r().
+
+   \param Plus pointer to Plus_head structure
+
+   \return 1 if the spatial index can be searched by several threads
+   \return 0 otherwise
+ */
+int dig_spidx_reentrant(const struct Plus_head *Plus)
+{
+    if (Plus->Spidx_new)
+	return Plus->Line_spidx->fd < 0 &&
+	    !Plus->Line_spidx->bulk.active && !Plus->Area_spidx->bulk.active;
+
+    return rtree_mapped(Plus);
+}
+
+/* search the nodes of a memory mapped sidx file without copying them,
+ * rectangles of branches not aligned for doubles are copied */
+static int rtree_search_mapped(struct RTree *t, struct RTree_Rect *r,
+			       SearchHitCallback shcb, void *cbarg,
+			       struct Plus_head *Plus)
+{
+    const char *start = Plus->spidx_fp.start;
+    off_t size = Plus->spidx_fp.size;
+    int off_t_size = Plus->spidx_port.off_t_size;
+    int branchsize = NUMSIDES * PORT_DOUBLE + off_t_size;
+    int hitCount = 0;
+    int i, maxcard, level;
+    struct
+    {
+	off_t pos;
+	int branch_id;
+    } s[MAXLEVEL];
+    int top = 0;
+    RectReal boundary[NUMSIDES];
+    struct RTree_Rect rect;
+
+    s[top].pos = t->rootpos;
+    s[top].branch_id = 0;
+
+    while (top >= 0) {
+	const char *node = start + s[top].pos;
+
+	if (s[top].pos <= 0 ||
+	    s[top].pos + 2 * PORT_INT + MAXCARD * branchsize > size)
+	    G_fatal_error(_("Spatial index file is corrupted, "
+			    "please rebuild topology"));
+
+	memcpy(&level, node + PORT_INT, sizeof(int));
+	maxcard = level ? t->nodecard : t->leafcard;
+
+	for (i = s[top].branch_id; i < maxcard; i++) {
+	    const char *branch = node + 2 * PORT_INT + i * branchsize;
+	    off_t child;
+
+	    if (off_t_size == 4) {
+		int id;
+
+		memcpy(&id, branch + NUMSIDES * PORT_DOUBLE, sizeof(int));
+		child = id;
+	    }
+	    else
+		memcpy(&child, branch + NUMSIDES * PORT_DOUBLE, sizeof(off_t));
+
+	    if (level > 0 ? child <= 0 : child == 0)
+		continue;
+
+	    if (((size_t)branch & (sizeof(RectReal) - 1)) == 0)
+		rect.boundary = (RectReal *)branch;
+	    else {
+		memcpy(boundary, branch, sizeof(boundary));
+		rect.boundary = boundary;
+	    }
+	    if (!RTreeOverlap(r, &rect, t))
+		continue;
+
+	    if (level > 0) {
+		/* continue with this child */
+		s[top++].branch_id = i + 1;
+		s[top].pos = child;
+		s[top].branch_id = 0;
+		break;
+	    }
+
+	    hitCount++;
+	    if (shcb && !shcb((int)child, &rect, cbarg))
+		/* callback wants to terminate search early */
+		return hitCount;
+	}
+	if (i == maxcard)
+	    /* nothing else found, go back up */
+	    top--;
+    }
+
+    return hitCount;
+}
+
 /*!
    \brief Search spatial index file
    Can't use regular RTreeSearch() here because sidx must be read
@@ -1410,6 +1555,9 @@ int rtree_search(struct RTree *t, struct RTree_Rect *r,
     /* stack size of t->rootlevel + 1 is enough because of depth first search */
     /* only one node per level on stack at any given time */
 
+    if (rtree_mapped(Plus))
+	return rtree_search_mapped(t, r, shcb, cbarg, Plus);
+
     dig_set_cur_port(&(Plus->spidx_port));
 
     /* add root node position to stack */
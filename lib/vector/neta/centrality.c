@@ -110,12 +110,125 @@ int NetA_eigenvector_centrality(dglGraph_s * graph, int iterations,
     return 0;
 }
 
+/* state of one thread of NetA_betweenness_closeness(), indexed by
+   the node numbers of the compressed sparse rows */
+struct bc_state
+{
+    dglInt64_t *dst;
+    dglInt32_t *stack, *cnt, *delta;
+    struct ilist **prev;
+    double *betweenness;	/* contributions of the sources of the thread */
+};
+
+struct bc_block
+{
+    dglCSR_s *csr;
+    int last;			/* after the last source of the block */
+    struct Counter next;	/* next source of the block */
+    double *closeness;
+};
+
+struct bc_task
+{
+    struct bc_block *block;
+    struct bc_state *state;
+};
+
+/* shortest paths from node s with Brandes algorithm */
+static void bc_source(struct bc_block *block, struct bc_state *st, int s)
+{
+    dglCSR_s *csr = block->csr;
+    int i, j, nnodes = csr->cNode, stack_size;
+    dglInt64_t *dst = st->dst, k;
+    dglInt32_t *stack = st->stack, *cnt = st->cnt, *delta = st->delta;
+    struct ilist **prev = st->prev;
+    dglHeap_s heap;
+    dglHeapData_u heap_data;
+    dglHeapNode_s heap_node;
+
+    stack_size = 0;
+    for (i = 0; i < nnodes; i++) {
+	Vect_reset_list(prev[i]);
+	cnt[i] = 0;
+	dst[i] = -1;
+    }
+    dst[s] = 0;
+    cnt[s] = 1;
+    dglHeapInit(&heap);
+    heap_data.ul = s;
+    dglHeapInsertMin(&heap, 0, ' ', heap_data);
+    while (1) {
+	dglInt64_t dist;
+	int v;
+
+	if (!dglHeapExtractMin(&heap, &heap_node))
+	    break;
+	v = heap_node.value.ul;
+	dist = heap_node.key;
+	if (dst[v] < dist)
+	    continue;
+	stack[stack_size++] = v;
+
+	for (k = csr->pnOffset[v]; k < csr->pnOffset[v + 1]; k++) {
+	    int to = csr->pnTarget[k];
+	    dglInt64_t d = csr->pnCost[k];
+
+	    if (dst[to] == -1 || dst[to] > dist + d) {
+		dst[to] = dist + d;
+		Vect_reset_list(prev[to]);
+		heap_data.ul = to;
+		dglHeapInsertMin(&heap, dist + d, ' ', heap_data);
+	    }
+	    if (dst[to] == dist + d) {
+		cnt[to] += cnt[v];
+		Vect_list_append(prev[to], v);
+	    }
+	}
+    }
+    dglHeapFree(&heap, NULL);
+    for (i = 0; i < nnodes; i++)
+	delta[i] = 0;
+    for (i = stack_size - 1; i >= 0; i--) {
+	int w = stack[i];
+
+	if (block->closeness)
+	    block->closeness[csr->pnNodeId[s]] += dst[w];
+
+	for (j = 0; j < prev[w]->n_values; j++) {
+	    int v = prev[w]->value[j];
+
+	    delta[v] += (cnt[v] / (double)cnt[w]) * (1.0 + delta[w]);
+	}
+	if (w != s && st->betweenness)
+	    st->betweenness[w] += delta[w];
+
+    }
+    if (block->closeness)
+	block->closeness[csr->pnNodeId[s]] /= (double)stack_size;
+}
+
+static void bc_run(void *p)
+{
+    struct bc_task *task = p;
+    int i;
+
+    while ((i = G_counter_next(&task->block->next)) < task->block->last)
+	bc_source(task->block, task->state, i);
+}
+
 /*!
    \brief Computes betweenness and closeness centrality measure using Brandes algorithm. 
 
    Edge costs must be nonnegative. If some edge costs are negative then
    the behaviour of this method is undefined.
 
+   The searches run on the compressed sparse rows of the graph (see
+   dglCSRExport()). The sources are distributed over the threads of
+   the worker pool (see G_set_nprocs()), each thread with its own
+   search state and betweenness values which are summed up at the
+   end. The contributions of the sources are whole numbers, so the
+   results do not depend on the number of threads.
+
    \param graph input graph
    \param[out] betweenness betweeness values
    \param[out] closeness cloneness values
@@ -126,123 +239,89 @@ int NetA_eigenvector_centrality(dglGraph_s * graph, int iterations,
 int NetA_betweenness_closeness(dglGraph_s * graph, double *betweenness,
 			       double *closeness)
 {
-    int i, j, nnodes, stack_size, count;
-    dglInt32_t *dst, *node, *stack, *cnt, *delta;
-    dglNodeTraverser_s nt;
-    dglEdgesetTraverser_s et;
-    dglHeap_s heap;
-    struct ilist **prev;
-
-    nnodes = dglGet_NodeCount(graph);
-
-    dst = (dglInt32_t *) G_calloc(nnodes + 1, sizeof(dglInt32_t));
-    prev = (struct ilist **)G_calloc(nnodes + 1, sizeof(struct ilist *));
-    stack = (dglInt32_t *) G_calloc(nnodes, sizeof(dglInt32_t));
-    cnt = (dglInt32_t *) G_calloc(nnodes + 1, sizeof(dglInt32_t));
-    delta = (dglInt32_t *) G_calloc(nnodes + 1, sizeof(dglInt32_t));
-
-    if (!dst || !prev || !stack || !cnt || !delta) {
-	G_fatal_error(_("Out of memory"));
+    int i, k, nnodes, nthreads, block_size;
+    dglCSR_s csr;
+    struct bc_block block;
+    struct bc_state *states;
+    struct bc_task *tasks;
+    struct G_task_group *group;
+
+    if (dglCSRExport(graph, &csr) < 0) {
+	G_warning(_("Unable to export the graph: %s"), dglStrerror(graph));
 	return -1;
     }
+    nnodes = csr.cNode;
+    nthreads = G_num_workers() + 1;
+
+    states = G_calloc(nthreads, sizeof(struct bc_state));
+    tasks = G_calloc(nthreads, sizeof(struct bc_task));
+    for (k = 0; k < nthreads; k++) {
+	struct bc_state *st = &states[k];
+
+	st->dst = (dglInt64_t *) G_calloc(nnodes + 1, sizeof(dglInt64_t));
+	st->prev =
+	    (struct ilist **)G_calloc(nnodes + 1, sizeof(struct ilist *));
+	st->stack = (dglInt32_t *) G_calloc(nnodes + 1, sizeof(dglInt32_t));
+	st->cnt = (dglInt32_t *) G_calloc(nnodes + 1, sizeof(dglInt32_t));
+	st->delta = (dglInt32_t *) G_calloc(nnodes + 1, sizeof(dglInt32_t));
+	if (betweenness)
+	    st->betweenness = (double *)G_calloc(nnodes + 1, sizeof(double));
 
+	if (!st->dst || !st->prev || !st->stack || !st->cnt || !st->delta) {
+	    G_fatal_error(_("Out of memory"));
+	    return -1;
+	}
+	for (i = 0; i < nnodes; i++)
+	    st->prev[i] = Vect_new_list();
+
+	tasks[k].block = &block;
+	tasks[k].state = st;
+    }
 
-    for (i = 1; i <= nnodes; i++) {
-	prev[i] = Vect_new_list();
+    for (i = 1; i <= dglGet_NodeCount(graph); i++) {
 	if (closeness)
 	    closeness[i] = 0;
 	if (betweenness)
 	    betweenness[i] = 0;
     }
 
-    count = 0;
-    G_percent_reset();
-    dglNode_T_Initialize(&nt, graph);
-    for (node = dglNode_T_First(&nt); node; node = dglNode_T_Next(&nt)) {
-	G_percent(count++, nnodes, 1);
-	dglInt32_t s = dglNodeGet_Id(graph, node);
-	dglHeapData_u heap_data;
-	dglHeapNode_s heap_node;
-
-	stack_size = 0;
-	for (i = 1; i <= nnodes; i++)
-	    Vect_reset_list(prev[i]);
-	for (i = 1; i <= nnodes; i++) {
-	    cnt[i] = 0;
-	    dst[i] = -1;
-	}
-	dst[s] = 0;
-	cnt[s] = 1;
-	dglHeapInit(&heap);
-	heap_data.ul = s;
-	dglHeapInsertMin(&heap, 0, ' ', heap_data);
-	while (1) {
-	    dglInt32_t v, dist;
-
-	    if (!dglHeapExtractMin(&heap, &heap_node))
-		break;
-	    v = heap_node.value.ul;
-	    dist = heap_node.key;
-	    if (dst[v] < dist)
-		continue;
-	    stack[stack_size++] = v;
-
-	    dglInt32_t *edge;
-
-	    dglEdgeset_T_Initialize(&et, graph,
-				    dglNodeGet_OutEdgeset(graph,
-							  dglGetNode(graph,
-								     v)));
-	    for (edge = dglEdgeset_T_First(&et); edge;
-		 edge = dglEdgeset_T_Next(&et)) {
-		dglInt32_t *to = dglEdgeGet_Tail(graph, edge);
-		dglInt32_t to_id = dglNodeGet_Id(graph, to);
-		dglInt32_t d = dglEdgeGet_Cost(graph, edge);
-
-		if (dst[to_id] == -1 || dst[to_id] > dist + d) {
-		    dst[to_id] = dist + d;
-		    Vect_reset_list(prev[to_id]);
-		    heap_data.ul = to_id;
-		    dglHeapInsertMin(&heap, dist + d, ' ', heap_data);
-		}
-		if (dst[to_id] == dist + d) {
-		    cnt[to_id] += cnt[v];
-		    Vect_list_append(prev[to_id], v);
-		}
-	    }
-
-	    dglEdgeset_T_Release(&et);
-	}
-	dglHeapFree(&heap, NULL);
-	for (i = 1; i <= nnodes; i++)
-	    delta[i] = 0;
-	for (i = stack_size - 1; i >= 0; i--) {
-	    dglInt32_t w = stack[i];
-
-	    if (closeness)
-		closeness[s] += dst[w];
+    block.csr = &csr;
+    block.closeness = closeness;
 
-	    for (j = 0; j < prev[w]->n_values; j++) {
-		dglInt32_t v = prev[w]->value[j];
+    /* blocks of sources between progress reports */
+    block_size = 16 * nthreads;
+    G_percent_reset();
+    for (i = 0; i < nnodes; i += block_size) {
+	G_percent(i, nnodes, 1);
+	G_init_counter(&block.next, i);
+	block.last = i + block_size < nnodes ? i + block_size : nnodes;
+
+	group = G_task_group_create();
+	for (k = 0; k < nthreads; k++)
+	    G_task_submit(group, bc_run, &tasks[k]);
+	G_task_group_destroy(group);
+    }
+    G_percent(1, 1, 1);
 
-		delta[v] += (cnt[v] / (double)cnt[w]) * (1.0 + delta[w]);
-	    }
-	    if (w != s && betweenness)
-		betweenness[w] += delta[w];
+    for (k = 0; k < nthreads; k++) {
+	struct bc_state *st = &states[k];
 
+	if (betweenness) {
+	    for (i = 0; i < nnodes; i++)
+		betweenness[csr.pnNodeId[i]] += st->betweenness[i];
+	    G_free(st->betweenness);
 	}
-	if (closeness)
-	    closeness[s] /= (double)stack_size;
+	for (i = 0; i < nnodes; i++)
+	    Vect_destroy_list(st->prev[i]);
+	G_free(st->delta);
+	G_free(st->cnt);
+	G_free(st->stack);
+	G_free(st->prev);
+	G_free(st->dst);
     }
-    dglNode_T_Release(&nt);
-
-    for (i = 1; i <= nnodes; i++)
-	Vect_destroy_list(prev[i]);
-    G_free(delta);
-    G_free(cnt);
-    G_free(stack);
-    G_free(prev);
-    G_free(dst);
+    G_free(states);
+    G_free(tasks);
+    dglCSRRelease(&csr);
 
     return 0;
 };
@@ -0,0 +1,242 @@
+/*!
+   \file vector/neta/csa.c
+
+   \brief Network Analysis library - connection scan
+
+   Earliest arrival times over a timetable with the Connection Scan
+   Algorithm: the elementary connections of all routes, sorted by
+   departure time, are scanned once from the start time on, instead
+   of running a time-dependent Dijkstra over the stops. One scan gives
+   the earliest arrival at every stop.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2). Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <grass/gis.h>
+#include <grass/vector.h>
+#include <grass/dbmi.h>
+#include <grass/glocale.h>
+#include <grass/dgl/graph.h>
+#include <grass/neta.h>
+
+static int cmp_connection(const void *pa, const void *pb)
+{
+    const neta_connection *a = pa, *b = pb;
+
+    if (a->dep_time != b->dep_time)
+	return a->dep_time < b->dep_time ? -1 : 1;
+    if (a->arr_time != b->arr_time)
+	return a->arr_time < b->arr_time ? -1 : 1;
+    /* consecutive connections of a route in route order */
+    if (a->route != b->route)
+	return a->route < b->route ? -1 : 1;
+
+    return 0;
+}
+
+/*!
+   \brief Build the sorted connections of a timetable
+
+   \param timetable pointer to neta_timetable structure
+   \param[out] connections pointer to neta_connections structure
+
+   \return number of connections
+ */
+int NetA_timetable_connections(const neta_timetable * timetable,
+			       neta_connections * connections)
+{
+    int i, j, n;
+
+    n = 0;
+    for (i = 0; i < timetable->routes; i++)
+	if (timetable->route_length[i] > 1)
+	    n += timetable->route_length[i] - 1;
+
+    connections->conn = (neta_connection *) G_calloc(n > 0 ? n : 1,
+						     sizeof(neta_connection));
+    connections->count = n;
+
+    n = 0;
+    for (i = 0; i < timetable->routes; i++) {
+	for (j = 1; j < timetable->route_length[i]; j++) {
+	    neta_connection *c = &connections->conn[n++];
+
+	    c->dep_stop = timetable->route_stops[i][j - 1];
+	    c->arr_stop = timetable->route_stops[i][j];
+	    c->dep_time = timetable->route_times[i][j - 1];
+	    c->arr_time = timetable->route_times[i][j];
+	    c->route = i;
+	}
+    }
+
+    qsort(connections->conn, n, sizeof(neta_connection), cmp_connection);
+
+    return n;
+}
+
+/*!
+   \brief Free neta_connections structure
+
+   \param connections pointer to neta_connections structure
+ */
+void NetA_connections_release(neta_connections * connections)
+{
+    G_free(connections->conn);
+    connections->conn = NULL;
+    connections->count = 0;
+}
+
+/* first connection departing at or after time */
+static int first_connection(const neta_connections * connections, int time)
+{
+    int lo = 0, hi = connections->count;
+
+    while (lo < hi) {
+	int mid = lo + (hi - lo) / 2;
+
+	if (connections->conn[mid].dep_time < time)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    return lo;
+}
+
+/* arrival at stop at time from prev_stop by route (-2 walking);
+ * reached marks the stops with a time, as start_time - min_change
+ * may be -1 */
+static int arrive(neta_timetable_result * result, char *reached, int stop,
+		  int time, int prev_stop, int route)
+{
+    if (reached[stop] && result->dst[0][stop] <= time)
+	return 0;
+
+    reached[stop] = 1;
+    result->dst[0][stop] = time;
+    result->prev_stop[0][stop] = prev_stop;
+    result->prev_route[0][stop] = route;
+
+    return 1;
+}
+
+/* follow the walking connections from stop, and from the stops
+ * reached earlier by walking */
+static void walk(const neta_timetable * timetable,
+		 neta_timetable_result * result, char *reached, int stop,
+		 struct ilist *stack)
+{
+    int i;
+
+    Vect_reset_list(stack);
+    Vect_list_append(stack, stop);
+    while (stack->n_values > 0) {
+	stop = stack->value[--stack->n_values];
+	for (i = 0; i < timetable->walk_length[stop]; i++) {
+	    int to = timetable->walk_stops[stop][i];
+
+	    if (arrive(result, reached, to,
+		       result->dst[0][stop] + timetable->walk_times[stop][i],
+		       stop, -2))
+		Vect_list_append(stack, to);
+	}
+    }
+}
+
+/*!
+   \brief Computes the earliest arrival times by connection scan
+
+   Computes the earliest arrival time at to_stop, or at all stops if
+   to_stop is -1, from from_stop starting at start_time. As for
+   NetA_timetable_shortest_path(), a route can be boarded min_change
+   after the arrival at a stop, the start stop counts as reached at
+   start_time - min_change. The number of changes is not limited.
+
+   The result has a single row; prev_stop is the stop where the route
+   (or the walk, route -2) leading to a stop was boarded, so that the
+   path can be followed back as for NetA_timetable_shortest_path().
+
+   \param timetable pointer to neta_timetable structure
+   \param connections connections from NetA_timetable_connections()
+   \param from_stop 'from' stop
+   \param to_stop 'to' stop or -1
+   \param start_time start timestamp
+   \param min_change minimal time needed to change routes
+   \param[out] result pointer to neta_timetable_result
+
+   \return earliest arrival at to_stop, or start_time if to_stop is -1
+   \return -1 if to_stop can't be reached
+ */
+int NetA_timetable_connection_scan(const neta_timetable * timetable,
+				   const neta_connections * connections,
+				   int from_stop, int to_stop,
+				   int start_time, int min_change,
+				   neta_timetable_result * result)
+{
+    int i, stops = timetable->stops;
+    int *boarded;		/* stop where each route was boarded or -1 */
+    char *reached;
+    struct ilist *stack;
+
+    result->rows = 1;
+    result->routes = 0;
+    result->dst = (int **)G_malloc(sizeof(int *));
+    result->prev_stop = (int **)G_malloc(sizeof(int *));
+    result->prev_route = (int **)G_malloc(sizeof(int *));
+    result->prev_conn = (int **)G_malloc(sizeof(int *));
+    result->dst[0] = (int *)G_malloc(stops * sizeof(int));
+    result->prev_stop[0] = (int *)G_malloc(stops * sizeof(int));
+    result->prev_route[0] = (int *)G_malloc(stops * sizeof(int));
+    result->prev_conn[0] = (int *)G_calloc(stops, sizeof(int));
+
+    for (i = 0; i < stops; i++)
+	result->dst[0][i] = result->prev_stop[0][i] =
+	    result->prev_route[0][i] = -1;
+
+    boarded = (int *)G_malloc(timetable->routes * sizeof(int));
+    for (i = 0; i < timetable->routes; i++)
+	boarded[i] = -1;
+
+    reached = (char *)G_calloc(stops, 1);
+    stack = Vect_new_list();
+
+    /* boarding at the start stop is possible from start_time on */
+    result->dst[0][from_stop] = start_time - min_change;
+    reached[from_stop] = 1;
+    walk(timetable, result, reached, from_stop, stack);
+
+    for (i = first_connection(connections, start_time);
+	 i < connections->count; i++) {
+	const neta_connection *c = &connections->conn[i];
+
+	/* nothing departing later arrives earlier */
+	if (to_stop != -1 && reached[to_stop] &&
+	    c->dep_time >= result->dst[0][to_stop])
+	    break;
+
+	if (boarded[c->route] == -1) {
+	    if (!reached[c->dep_stop] ||
+		result->dst[0][c->dep_stop] + min_change > c->dep_time)
+		continue;
+	    boarded[c->route] = c->dep_stop;
+	}
+
+	if (arrive(result, reached, c->arr_stop, c->arr_time,
+		   boarded[c->route], c->route))
+	    walk(timetable, result, reached, c->arr_stop, stack);
+    }
+
+    G_free(boarded);
+    G_free(reached);
+    Vect_destroy_list(stack);
+
+    if (to_stop == -1)
+	return start_time;
+
+    return result->dst[0][to_stop];
+}
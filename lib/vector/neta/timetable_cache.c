@@ -0,0 +1,267 @@
+/*!
+   \file vector/neta/timetable_cache.c
+
+   \brief Network Analysis library - timetable cache files
+
+   A timetable read from the database can be saved to a binary file
+   which is mapped into memory by later runs instead of querying the
+   database again. The file holds the ids and the flat arrays of the
+   timetable in native byte order; only the per route and per stop
+   pointers are rebuilt when it is loaded.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2). Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
+#include <grass/gis.h>
+#include <grass/vector.h>
+#include <grass/dbmi.h>
+#include <grass/glocale.h>
+#include <grass/dgl/graph.h>
+#include <grass/neta.h>
+
+#define CACHE_MAGIC "NETATT1"
+#define BYTE_ORDER_MARK 0x01020304
+#define SIGNATURE_LEN 1024
+
+struct cache_header
+{
+    char magic[8];
+    int byte_order;
+    int routes, stops;
+    int route_entries, stop_entries, walk_entries;
+    char signature[SIGNATURE_LEN];
+};
+
+static int sum(const int *length, int n)
+{
+    int i, total = 0;
+
+    for (i = 0; i < n; i++)
+	total += length[i];
+
+    return total;
+}
+
+static int write_ints(FILE * fp, const int *values, int n)
+{
+    return n == 0 || fwrite(values, sizeof(int), n, fp) == (size_t) n;
+}
+
+static int write_rows(FILE * fp, int **rows, const int *length, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	if (!write_ints(fp, rows[i], length[i]))
+	    return 0;
+
+    return 1;
+}
+
+/*!
+   \brief Save a timetable to a cache file
+
+   \param timetable pointer to neta_timetable structure
+   \param route_ids list of route ids
+   \param stop_ids list of stop ids
+   \param signature text identifying the source of the timetable,
+   checked by NetA_timetable_load()
+   \param file name of the cache file
+
+   \return 0 on success
+   \return -1 on failure
+ */
+int NetA_timetable_save(const neta_timetable * timetable,
+			const int *route_ids, const int *stop_ids,
+			const char *signature, const char *file)
+{
+    struct cache_header header;
+    FILE *fp;
+    int ok;
+
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, CACHE_MAGIC);
+    header.byte_order = BYTE_ORDER_MARK;
+    header.routes = timetable->routes;
+    header.stops = timetable->stops;
+    header.route_entries = sum(timetable->route_length, timetable->routes);
+    header.stop_entries = sum(timetable->stop_length, timetable->stops);
+    header.walk_entries = sum(timetable->walk_length, timetable->stops);
+    strncpy(header.signature, signature, SIGNATURE_LEN - 1);
+
+    fp = fopen(file, "wb");
+    if (!fp) {
+	G_warning(_("Unable to create timetable cache <%s>"), file);
+	return -1;
+    }
+
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+	write_ints(fp, route_ids, timetable->routes) &&
+	write_ints(fp, stop_ids, timetable->stops) &&
+	write_ints(fp, timetable->route_length, timetable->routes) &&
+	write_ints(fp, timetable->stop_length, timetable->stops) &&
+	write_ints(fp, timetable->walk_length, timetable->stops) &&
+	write_rows(fp, timetable->route_stops, timetable->route_length,
+		   timetable->routes) &&
+	write_rows(fp, timetable->route_times, timetable->route_length,
+		   timetable->routes) &&
+	write_rows(fp, timetable->stop_routes, timetable->stop_length,
+		   timetable->stops) &&
+	write_rows(fp, timetable->stop_times, timetable->stop_length,
+		   timetable->stops) &&
+	write_rows(fp, timetable->walk_stops, timetable->walk_length,
+		   timetable->stops) &&
+	write_rows(fp, timetable->walk_times, timetable->walk_length,
+		   timetable->stops);
+
+    if (fclose(fp) != 0)
+	ok = 0;
+    if (!ok) {
+	G_warning(_("Unable to write timetable cache <%s>"), file);
+	unlink(file);
+	return -1;
+    }
+
+    return 0;
+}
+
+/* point rows into the flat array data */
+static int **split_rows(int *data, const int *length, int n)
+{
+    int **rows = (int **)G_calloc(n, sizeof(int *));
+    int i;
+
+    for (i = 0; i < n; i++) {
+	rows[i] = data;
+	data += length[i];
+    }
+
+    return rows;
+}
+
+/*!
+   \brief Load a timetable from a cache file
+
+   The file is mapped into memory; the arrays of the timetable and the
+   ids point into the mapping and must not be modified. Release the
+   timetable with NetA_timetable_release().
+
+   \param file name of the cache file
+   \param signature text the file was saved with
+   \param[out] timetable pointer to neta_timetable structure
+   \param[out] route_ids list of route ids
+   \param[out] stop_ids list of stop ids
+
+   \return 0 on success
+   \return 1 if the file does not exist, is invalid or has another
+   signature
+ */
+int NetA_timetable_load(const char *file, const char *signature,
+			neta_timetable * timetable, int **route_ids,
+			int **stop_ids)
+{
+    struct cache_header header;
+    struct stat st;
+    size_t size;
+    char *base;
+    int *data;
+    int fd;
+
+    fd = open(file, O_RDONLY);
+    if (fd < 0)
+	return 1;
+
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(header) ||
+	read(fd, &header, sizeof(header)) != sizeof(header) ||
+	strcmp(header.magic, CACHE_MAGIC) != 0 ||
+	header.byte_order != BYTE_ORDER_MARK) {
+	G_debug(1, "NetA_timetable_load(): <%s> is not a timetable cache",
+		file);
+	close(fd);
+	return 1;
+    }
+
+    header.signature[SIGNATURE_LEN - 1] = '\0';
+    if (strcmp(header.signature, signature) != 0) {
+	G_debug(1, "NetA_timetable_load(): <%s> is for <%s>", file,
+		header.signature);
+	close(fd);
+	return 1;
+    }
+
+    size = sizeof(header) + sizeof(int) *
+	((size_t) 3 * header.stops + 2 * header.routes +
+	 2 * ((size_t) header.route_entries + header.stop_entries +
+	      header.walk_entries));
+    if ((size_t) st.st_size != size) {
+	G_debug(1, "NetA_timetable_load(): <%s> is truncated", file);
+	close(fd);
+	return 1;
+    }
+
+#ifdef __MINGW32__
+    base = G_malloc(size);
+    if (lseek(fd, 0, SEEK_SET) != 0 || read(fd, base, size) != size) {
+	G_free(base);
+	close(fd);
+	return 1;
+    }
+#else
+    base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+	close(fd);
+	return 1;
+    }
+#endif
+    close(fd);
+
+    timetable->cache = base;
+    timetable->cache_size = size;
+    timetable->routes = header.routes;
+    timetable->stops = header.stops;
+
+    data = (int *)(base + sizeof(header));
+    *route_ids = data;
+    data += header.routes;
+    *stop_ids = data;
+    data += header.stops;
+    timetable->route_length = data;
+    data += header.routes;
+    timetable->stop_length = data;
+    data += header.stops;
+    timetable->walk_length = data;
+    data += header.stops;
+
+    timetable->route_stops =
+	split_rows(data, timetable->route_length, header.routes);
+    data += header.route_entries;
+    timetable->route_times =
+	split_rows(data, timetable->route_length, header.routes);
+    data += header.route_entries;
+    timetable->stop_routes =
+	split_rows(data, timetable->stop_length, header.stops);
+    data += header.stop_entries;
+    timetable->stop_times =
+	split_rows(data, timetable->stop_length, header.stops);
+    data += header.stop_entries;
+    timetable->walk_stops =
+	split_rows(data, timetable->walk_length, header.stops);
+    data += header.walk_entries;
+    timetable->walk_times =
+	split_rows(data, timetable->walk_length, header.stops);
+
+    return 0;
+}
@@ -15,6 +15,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
 #include <grass/gis.h>
 #include <grass/vector.h>
 #include <grass/dbmi.h>
@@ -127,6 +130,9 @@ int NetA_init_timetable_from_db(struct Map_info *In, int route_layer,
     dbDriver *driver;
     struct field_info *Fi;
 
+    timetable->cache = NULL;
+    timetable->cache_size = 0;
+
     Fi = Vect_get_field(In, route_layer);
     driver = db_start_driver_open_database(Fi->driver, Fi->database);
     if (driver == NULL)
@@ -555,8 +561,55 @@ void NetA_timetable_result_release(neta_timetable_result * result)
 	G_free(result->dst[i]);
 	G_free(result->prev_stop[i]);
 	G_free(result->prev_route[i]);
+	G_free(result->prev_conn[i]);
     }
     G_free(result->dst);
     G_free(result->prev_stop);
     G_free(result->prev_route);
+    G_free(result->prev_conn);
+}
+
+/*!
+   \brief Free neta_timetable structure
+
+   Frees the arrays of a timetable read by NetA_init_timetable_from_db()
+   or unmaps the cache file of a timetable loaded by
+   NetA_timetable_load(). The route and stop ids of a loaded timetable
+   are invalid afterwards.
+
+   \param timetable pointer to neta_timetable structure
+ */
+void NetA_timetable_release(neta_timetable * timetable)
+{
+    int i;
+
+    if (timetable->cache) {
+#ifdef __MINGW32__
+	G_free(timetable->cache);
+#else
+	munmap(timetable->cache, timetable->cache_size);
+#endif
+	timetable->cache = NULL;
+    }
+    else {
+	for (i = 0; i < timetable->routes; i++) {
+	    G_free(timetable->route_stops[i]);
+	    G_free(timetable->route_times[i]);
+	}
+	for (i = 0; i < timetable->stops; i++) {
+	    G_free(timetable->stop_routes[i]);
+	    G_free(timetable->stop_times[i]);
+	    G_free(timetable->walk_stops[i]);
+	    G_free(timetable->walk_times[i]);
+	}
+	G_free(timetable->route_length);
+	G_free(timetable->stop_length);
+	G_free(timetable->walk_length);
+    }
+    G_free(timetable->route_stops);
+    G_free(timetable->route_times);
+    G_free(timetable->stop_routes);
+    G_free(timetable->stop_times);
+    G_free(timetable->walk_stops);
+    G_free(timetable->walk_times);
 }
@@ -0,0 +1,421 @@
+/*!
+   \file lib/vector/rtree/bulk.c
+
+   \brief R-Tree library - Bulk loading
+
+   Rectangles inserted between RTreeBulkBegin() and RTreeBulkEnd() are
+   collected and added to the tree in one go. An empty tree is packed
+   with Sort-Tile-Recursive (STR): the rectangles are sorted by the x
+   coordinate of their centers, cut into about sqrt(number of leaves)
+   vertical slices, each slice is sorted by the y coordinate, and runs
+   of full leaves are taken from the slices. The upper levels are built
+   the same way from the covers of the nodes below. This avoids the
+   node splits and forced reinsertions of one-by-one insertion, and the
+   nodes overlap less. The sorts run on the libgis worker threads.
+
+   (C) 2019 by the GRASS Development Team
+
+   This program is free software under the
+   GNU General Public License (>=v2).
+   Read the file COPYING that comes with GRASS
+   for details.
+
+   \author Markus Metz - file-based and memory-based R*-tree
+ */
+
+/* STR reference:
+ * Leutenegger, S. T.; Lopez, M. A.; Edgington, J. (1997).
+ * "STR: A Simple and Efficient Algorithm for R-Tree Packing".
+ * Proceedings of the 13th International Conference on Data
+ * Engineering. pp. 497.
+ * DOI:10.1109/ICDE.1997.582015
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <assert.h>
+#include <grass/gis.h>
+#include "index.h"
+
+/* entry of a level to be packed: center of its rectangle */
+struct entry
+{
+    RectReal x, y;
+    int i;			/* index of the rectangle */
+};
+
+/* branches of one level of the tree */
+struct level
+{
+    int n;
+    RectReal *boundary;		/* nsides_alloc per branch */
+    union RTree_Child *child;
+};
+
+struct sort_job
+{
+    struct entry *e, *tmp;
+    int n;
+    int nchunks;		/* initial sorted runs */
+    int width;			/* runs merged in this round */
+    int nnodes, per_slice;	/* nodes of the level and of a slice */
+};
+
+static int cmp_x(const void *aa, const void *bb)
+{
+    const struct entry *a = aa, *b = bb;
+
+    if (a->x != b->x)
+	return a->x < b->x ? -1 : 1;
+    if (a->y != b->y)
+	return a->y < b->y ? -1 : 1;
+    return (a->i > b->i) - (a->i < b->i);
+}
+
+static int cmp_y(const void *aa, const void *bb)
+{
+    const struct entry *a = aa, *b = bb;
+
+    if (a->y != b->y)
+	return a->y < b->y ? -1 : 1;
+    if (a->x != b->x)
+	return a->x < b->x ? -1 : 1;
+    return (a->i > b->i) - (a->i < b->i);
+}
+
+/* first entry of node j: the entries are spread evenly over the nodes,
+   so that all nodes are at least half full */
+static int node_start(int j, int n, int nnodes)
+{
+    return (int)((grass_int64)j * n / nnodes);
+}
+
+static int chunk_start(int c, const struct sort_job *job)
+{
+    if (c >= job->nchunks)
+	return job->n;
+    return (int)((grass_int64)c * job->n / job->nchunks);
+}
+
+static void sort_chunks(int first, int last, void *closure)
+{
+    const struct sort_job *job = closure;
+    int c;
+
+    for (c = first; c < last; c++) {
+	int start = chunk_start(c, job);
+
+	qsort(job->e + start, chunk_start(c + 1, job) - start,
+	      sizeof(struct entry), cmp_x);
+    }
+}
+
+/* merge pairs of runs of job->width chunks from e to tmp */
+static void merge_runs(int first, int last, void *closure)
+{
+    const struct sort_job *job = closure;
+    int p;
+
+    for (p = first; p < last; p++) {
+	int lo = chunk_start(2 * p * job->width, job);
+	int mid = chunk_start((2 * p + 1) * job->width, job);
+	int hi = chunk_start((2 * p + 2) * job->width, job);
+	int i = lo, j = mid, k = lo;
+
+	while (i < mid && j < hi) {
+	    if (cmp_x(&job->e[j], &job->e[i]) < 0)
+		job->tmp[k++] = job->e[j++];
+	    else
+		job->tmp[k++] = job->e[i++];
+	}
+	while (i < mid)
+	    job->tmp[k++] = job->e[i++];
+	while (j < hi)
+	    job->tmp[k++] = job->e[j++];
+    }
+}
+
+static void sort_slices(int first, int last, void *closure)
+{
+    const struct sort_job *job = closure;
+    int s;
+
+    for (s = first; s < last; s++) {
+	int j0 = s * job->per_slice;
+	int j1 = j0 + job->per_slice;
+	int start;
+
+	if (j1 > job->nnodes)
+	    j1 = job->nnodes;
+	start = node_start(j0, job->n, job->nnodes);
+
+	qsort(job->e + start, node_start(j1, job->n, job->nnodes) - start,
+	      sizeof(struct entry), cmp_y);
+    }
+}
+
+/* sort the entries by x on all workers: sorted chunks, then rounds of
+   merging pairs of runs */
+static struct entry *sort_x(struct entry *e, struct entry *tmp, int n)
+{
+    struct sort_job job;
+    int nruns;
+
+    job.e = e;
+    job.tmp = tmp;
+    job.n = n;
+    job.nchunks = G_num_workers() > 1 ? 2 * G_num_workers() : 1;
+    if (job.nchunks > n / 1000 + 1)
+	job.nchunks = n / 1000 + 1;
+
+    G_parallel_for(0, job.nchunks, 1, sort_chunks, &job);
+
+    for (job.width = 1; job.width < job.nchunks; job.width *= 2) {
+	struct entry *swap;
+
+	nruns = (job.nchunks + job.width - 1) / job.width;
+	G_parallel_for(0, (nruns + 1) / 2, 1, merge_runs, &job);
+	swap = job.e;
+	job.e = job.tmp;
+	job.tmp = swap;
+    }
+
+    return job.e;
+}
+
+/* build the nodes of one level from the branches of the level below,
+   return the branches of the new nodes */
+static struct level pack_level(struct RTree *t, struct level *in,
+			       int level, int *nnodes_total)
+{
+    int card = level ? t->nodecard : t->leafcard;
+    int nsides = t->nsides_alloc, ndims = t->ndims_alloc;
+    int nnodes = (in->n + card - 1) / card;
+    struct entry *e, *tmp, *sorted;
+    struct RTree_Node *n = NULL;
+    struct level out;
+    int i, j;
+
+    e = malloc(in->n * sizeof(struct entry));
+    tmp = malloc(in->n * sizeof(struct entry));
+    assert(e && tmp);
+
+    for (i = 0; i < in->n; i++) {
+	const RectReal *b = &in->boundary[(size_t)i * nsides];
+
+	e[i].x = (b[0] + b[ndims]) / 2;
+	e[i].y = (b[1] + b[ndims + 1]) / 2;
+	e[i].i = i;
+    }
+
+    sorted = e;
+    if (nnodes > 1) {
+	struct sort_job job;
+	int nslices = (int)ceil(sqrt((double)nnodes));
+
+	sorted = sort_x(e, tmp, in->n);
+
+	job.e = sorted;
+	job.n = in->n;
+	job.nnodes = nnodes;
+	job.per_slice = (nnodes + nslices - 1) / nslices;
+	nslices = (nnodes + job.per_slice - 1) / job.per_slice;
+	G_parallel_for(0, nslices, 1, sort_slices, &job);
+    }
+
+    out.n = nnodes;
+    out.boundary = malloc((size_t)nnodes * nsides * sizeof(RectReal));
+    out.child = malloc(nnodes * sizeof(union RTree_Child));
+    assert(out.boundary && out.child);
+
+    if (t->fd > -1)
+	n = RTreeAllocNode(t, level);
+
+    for (j = 0; j < nnodes; j++) {
+	int start = node_start(j, in->n, nnodes);
+	int end = node_start(j + 1, in->n, nnodes);
+	struct RTree_Rect cover;
+
+	if (t->fd > -1)
+	    RTreeInitNode(t, n, NODETYPE(level, t->fd));
+	else
+	    n = RTreeAllocNode(t, level);
+	n->level = level;
+
+	for (i = start; i < end; i++) {
+	    int k = sorted[i].i;
+
+	    memcpy(n->branch[i - start].rect.boundary,
+		   &in->boundary[(size_t)k * nsides], t->rectsize);
+	    n->branch[i - start].child = in->child[k];
+	}
+	n->count = end - start;
+
+	cover.boundary = &out.boundary[(size_t)j * nsides];
+	RTreeNodeCover(n, &cover, t);
+
+	if (t->fd > -1) {
+	    /* the root keeps its position */
+	    if (nnodes == 1) {
+		lseek(t->fd, t->rootpos, SEEK_SET);
+		out.child[j].pos = t->rootpos;
+	    }
+	    else
+		out.child[j].pos = RTreeGetNodePos(t);
+	    RTreeWriteNode(n, t);
+	}
+	else
+	    out.child[j].ptr = n;
+    }
+
+    if (t->fd > -1)
+	RTreeFreeNode(n);
+
+    free(e);
+    free(tmp);
+
+    *nnodes_total += nnodes;
+
+    return out;
+}
+
+/* build a packed tree from the pending rectangles, the tree is empty */
+static void pack_tree(struct RTree *t)
+{
+    struct level in, out;
+    int level = 0, nnodes = 0;
+    int i;
+
+    in.n = t->bulk.n;
+    in.boundary = t->bulk.boundary;
+    in.child = malloc(in.n * sizeof(union RTree_Child));
+    assert(in.child);
+    for (i = 0; i < in.n; i++) {
+	memset(&in.child[i], 0, sizeof(union RTree_Child));
+	in.child[i].id = t->bulk.id[i];
+    }
+
+    while (1) {
+	out = pack_level(t, &in, level, &nnodes);
+	if (level > 0)
+	    free(in.boundary);
+	free(in.child);
+	in = out;
+	if (out.n == 1)
+	    break;
+	level++;
+	assert(level < MAXLEVEL);
+    }
+
+    if (t->fd > -1) {
+	int j;
+
+	/* the buffered nodes are outdated */
+	for (i = 0; i < MAXLEVEL; i++) {
+	    for (j = 0; j < NODE_BUFFER_SIZE; j++) {
+		t->nb[i][j].dirty = 0;
+		t->nb[i][j].pos = -1;
+		t->used[i][j] = j;
+	    }
+	}
+    }
+    else {
+	RTreeDestroyNode(t->root, t->root->level ? t->nodecard : t->leafcard);
+	t->root = out.child[0].ptr;
+    }
+
+    free(out.boundary);
+    free(out.child);
+
+    t->rootlevel = level;
+    t->n_nodes = nnodes;
+    t->n_leafs = t->bulk.n;
+}
+
+/* add the pending rectangles to the tree */
+static void load_pending(struct RTree *t)
+{
+    if (t->bulk.n == 0)
+	return;
+
+    G_debug(2, "RTree: loading %d rectangles", t->bulk.n);
+
+    if (t->n_leafs == 0)
+	pack_tree(t);
+    else {
+	struct RTree_Rect r;
+	union RTree_Child child;
+	int i;
+
+	/* a tree which is not empty keeps its shape */
+	for (i = 0; i < t->bulk.n; i++) {
+	    r.boundary = &t->bulk.boundary[(size_t)i * t->nsides_alloc];
+	    memset(&child, 0, sizeof(union RTree_Child));
+	    child.id = t->bulk.id[i];
+	    t->n_leafs++;
+	    t->insert_rect(&r, child, 0, t);
+	}
+    }
+
+    t->bulk.n = 0;
+}
+
+/*!
+  \brief Start collecting rectangles for bulk loading
+
+  RTreeInsertRect() keeps the rectangles until RTreeBulkEnd() is
+  called, which adds them in one go. If the tree is empty, it is packed
+  with the Sort-Tile-Recursive algorithm. Searches and deletions in the
+  meantime first add the rectangles collected so far.
+
+  \param t pointer to RTree structure
+*/
+void RTreeBulkBegin(struct RTree *t)
+{
+    t->bulk.active = 1;
+}
+
+/*!
+  \brief Add the rectangles collected since RTreeBulkBegin()
+
+  Must be called before the tree is written to a file.
+
+  \param t pointer to RTree structure
+*/
+void RTreeBulkEnd(struct RTree *t)
+{
+    load_pending(t);
+
+    free(t->bulk.id);
+    free(t->bulk.boundary);
+    t->bulk.id = NULL;
+    t->bulk.boundary = NULL;
+    t->bulk.alloc = 0;
+    t->bulk.active = 0;
+}
+
+/* collect a rectangle, called by RTreeInsertRect() */
+void RTreeBulkAdd(struct RTree_Rect *r, int tid, struct RTree *t)
+{
+    if (t->bulk.n >= t->bulk.alloc) {
+	t->bulk.alloc = t->bulk.alloc ? 2 * t->bulk.alloc : 1024;
+	t->bulk.id = realloc(t->bulk.id, t->bulk.alloc * sizeof(int));
+	t->bulk.boundary = realloc(t->bulk.boundary,
+				   (size_t)t->bulk.alloc * t->rectsize);
+	assert(t->bulk.id && t->bulk.boundary);
+    }
+
+    t->bulk.id[t->bulk.n] = tid;
+    memcpy(&t->bulk.boundary[(size_t)t->bulk.n * t->nsides_alloc],
+	   r->boundary, t->rectsize);
+    t->bulk.n++;
+}
+
+/* add the rectangles collected so far, called before searches */
+void RTreeBulkFlush(struct RTree *t)
+{
+    if (t->bulk.active)
+	load_pending(t);
+}
@@ -185,6 +185,12 @@ struct RTree *RTreeCreateTree(int fd, off_t rootpos, int ndims)
     new_rtree->orect.boundary = RTreeAllocBoundary(new_rtree);
     new_rtree->center_n = (RectReal *)malloc(new_rtree->ndims_alloc * sizeof(RectReal));
 
+    new_rtree->bulk.active = 0;
+    new_rtree->bulk.n = 0;
+    new_rtree->bulk.alloc = 0;
+    new_rtree->bulk.id = NULL;
+    new_rtree->bulk.boundary = NULL;
+
     return new_rtree;
 }
 
@@ -265,6 +271,8 @@ void RTreeDestroyTree(struct RTree *t)
     RTreeFreeBoundary(&(t->upperrect));
     RTreeFreeBoundary(&(t->orect));
     free(t->center_n);
+    free(t->bulk.id);
+    free(t->bulk.boundary);
 
     free(t);
     
@@ -300,6 +308,8 @@ int RTreeSearch(struct RTree *t, struct RTree_Rect *r,
 {
     assert(r && t);
 
+    RTreeBulkFlush(t);
+
     return t->search_rect(t, r, shcb, cbarg);
 }
 
@@ -317,6 +327,11 @@ int RTreeInsertRect(struct RTree_Rect *r, int tid, struct RTree *t)
     union RTree_Child newchild;
 
     assert(r && t && tid > 0);
+
+    if (t->bulk.active) {
+	RTreeBulkAdd(r, tid, t);
+	return 0;
+    }
     
     t->n_leafs++;
     newchild.id = tid;
@@ -345,6 +360,8 @@ int RTreeDeleteRect(struct RTree_Rect *r, int tid, struct RTree *t)
     
     assert(r && t && tid > 0);
 
+    RTreeBulkFlush(t);
+
     child.id = tid;
 
     return t->delete_rect(r, child, t);
@@ -58,6 +58,10 @@ void RTreeFreeListNode(struct RTree_ListNode *);
 void RTreeReInsertNode(struct RTree_Node *, struct RTree_ListNode **);
 void RTreeFreeListBranch(struct RTree_ListBranch *);
 
+/* bulk.c */
+void RTreeBulkAdd(struct RTree_Rect *, int, struct RTree *);
+void RTreeBulkFlush(struct RTree *);
+
 /* indexm.c */
 int RTreeSearchM(struct RTree *, struct RTree_Rect *,
                  SearchHitCallback *, void *);
@@ -30,6 +30,8 @@ int RTreeValidChildM(union RTree_Child *child)
  * Search in an index tree for all data retangles that
  * overlap the argument rectangle.
  * Return the number of qualifying data rects.
+ * The stack is not shared, the tree can be searched by several
+ * threads at the same time.
  */
 int RTreeSearchM(struct RTree *t, struct RTree_Rect *r,
                  SearchHitCallback *shcb, void *cbarg)
@@ -38,7 +40,7 @@ int RTreeSearchM(struct RTree *t, struct RTree_Rect *r,
     int hitCount = 0, notfound;
     int i;
     int top = 0;
-    struct nstack *s = t->ns;
+    struct nstack s[MAXLEVEL];
 
     /* stack size of t->rootlevel + 1 is enough because of depth first search */
     /* only one node per level on stack at any given time */
@@ -190,6 +190,15 @@ struct RTree
     RectReal *center_n;
 
     off_t rootpos;         /* root node position in file */
+
+    /* rectangles collected for bulk loading */
+    struct _bulk {
+        int active;         /* RTreeInsertRect() collects rectangles */
+        int n;              /* number of collected rectangles */
+        int alloc;          /* number of allocated rectangles */
+        int *id;            /* data ids */
+        RectReal *boundary; /* nsides_alloc values per rectangle */
+    } bulk;
 };
 
 /* RTree main functions */
@@ -215,6 +224,10 @@ int RTreeOverlap(struct RTree_Rect *, struct RTree_Rect *, struct RTree *);
 int RTreeContained(struct RTree_Rect *, struct RTree_Rect *, struct RTree *);
 int RTreeContains(struct RTree_Rect *, struct RTree_Rect *, struct RTree *);
 
+/* RTree bulk loading */
+void RTreeBulkBegin(struct RTree *);
+void RTreeBulkEnd(struct RTree *);
+
 /* RTree node management */
 struct RTree_Node *RTreeAllocNode(struct RTree *, int);
 void RTreeInitNode(struct RTree *, struct RTree_Node *, int);
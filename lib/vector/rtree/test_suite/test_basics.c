@@ -28,6 +28,7 @@ static int test_basics_1d(void);
 static int test_basics_2d(void);
 static int test_basics_3d(void);
 static int test_basics_4d(void);
+static int test_bulk_2d(void);
 
 /* ************************************************************************* */
 /* Performe the solver unit tests ****************************************** */
@@ -43,6 +44,7 @@ int unit_test_basics(void)
         sum += test_basics_2d();
         sum += test_basics_3d();
         sum += test_basics_4d();
+        sum += test_bulk_2d();
 
 	if (sum > 0)
             G_warning(_("\n-- Basic rtree unit tests failure --"));
@@ -203,3 +205,48 @@ int test_basics_4d(void)
     return sum;
 }
 
+
+
+/* *************************************************************** */
+/* *************************************************************** */
+/* *************************************************************** */
+
+int test_bulk_2d(void)
+{
+    int sum = 0, num1, num2, i;
+    
+    struct RTree* tree1 = RTreeCreateTree(-1, 0, 2);
+    struct RTree* tree2 = RTreeCreateTree(-1, 0, 2);
+    
+    struct RTree_Rect* rect = RTreeAllocRect(tree1);
+
+    /* the same rectangles inserted one by one and bulk-loaded */
+    RTreeBulkBegin(tree2);
+    for(i = 0; i < 1000; i++) {
+        RTreeSetRect2D(rect, tree1, (i % 37), (i % 37) + 2,
+                       (i % 101), (i % 101) + 3);
+        RTreeInsertRect(rect, i + 1, tree1);
+        RTreeInsertRect(rect, i + 1, tree2);
+    }
+    RTreeBulkEnd(tree2);
+
+    if(tree2->n_leafs != 1000)
+        sum++;
+
+    for(i = 0; i < 100; i++) {
+        RTreeSetRect2D(rect, tree1, i % 40, i % 40 + 5, i, i + 5);
+
+        num1 = RTreeSearch(tree1, rect, NULL, NULL);
+        num2 = RTreeSearch(tree2, rect, NULL, NULL);
+        printf("Found %i and %i neighbors\n", num1, num2);
+
+        if(num1 != num2)
+            sum++;
+    }
+
+    RTreeFreeRect(rect);
+    RTreeDestroyTree(tree1);
+    RTreeDestroyTree(tree2);
+    
+    return sum;
+}
@@ -28,21 +28,332 @@
 #include "local_proto.h"
 
 #define INCR 1024
+#define BLOCK_ROWS 16
+
+/* provisional clump labels of the rows labelled by one thread */
+struct labels
+{
+    CELL *index;		/* label of the parent clump, 0 is unused */
+    CELL n, nalloc;
+    CELL offset;		/* global label = offset + label */
+};
+
+/* input and labels of a block of rows,
+ * row 0 is the last row of the previous block */
+struct block
+{
+    int ncols;
+    int diag;
+    CELL **cin;			/* CELL input for clump() */
+    DCELL ***din;		/* DCELL input of all bands for clump_n() */
+    int nin;
+    DCELL *rng;
+    double thresh2;
+    CELL **clump;		/* clump labels */
+    int chunk;			/* rows per thread */
+    struct labels *labels;	/* per thread */
+};
+
+/* final clump IDs of a block of initial clump labels */
+struct renumber
+{
+    CELL *buf;
+    int ncols;
+    const CELL *clumpid;
+    int nulls;			/* set clump ID 0 to NULL */
+};
 
 int print_time(time_t *);
 
+static double get_diff2(DCELL **a, int acol, DCELL **b, int bcol, DCELL *rng, int n)
+{
+    int i;
+    double diff, diff2;
+
+    diff2 = 0;
+    for (i = 0; i < n; i++) {
+	if (Rast_is_d_null_value(&b[i][bcol]))
+	    return 2;
+	diff = a[i][acol] - b[i][bcol];
+	/* normalize with the band's range */
+	if (rng[i])
+	    diff /= rng[i];
+	diff2 += diff * diff;
+    }
+    /* normalize difference to the range [0, 1] */
+    diff2 /= n;
+    
+    return diff2;
+}
+
+static int is_null(const struct block *blk, int row, int col)
+{
+    int i;
+
+    if (!blk->din)
+	return Rast_is_c_null_value(&blk->cin[row][col]);
+
+    for (i = 0; i < blk->nin; i++) {
+	if (Rast_is_d_null_value(&blk->din[row][i][col]))
+	    return 1;
+    }
+
+    return 0;
+}
+
+/* whether cell b belongs to the clump of cell a, a is not NULL */
+static int similar(const struct block *blk, int arow, int acol,
+		   int brow, int bcol)
+{
+    if (!blk->din)
+	return blk->cin[arow][acol] == blk->cin[brow][bcol];
+
+    return get_diff2(blk->din[arow], acol, blk->din[brow], bcol,
+		     blk->rng, blk->nin) <= blk->thresh2;
+}
+
+static CELL find_root(CELL *index, CELL label)
+{
+    while (index[label] != label) {
+	index[label] = index[index[label]];
+	label = index[label];
+    }
+
+    return label;
+}
+
+/* the merged clump keeps the smaller of the two labels */
+static void merge(CELL *index, CELL a, CELL b)
+{
+    a = find_root(index, a);
+    b = find_root(index, b);
+
+    if (a < b)
+	index[b] = a;
+    else
+	index[a] = b;
+}
+
+/* runs on a worker thread, labels the rows first + 1 to last of a block
+ * independently of the row above, see merge_rows() */
+static void label_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct labels *lb = &blk->labels[first / blk->chunk];
+    int d = blk->diag ? 1 : 0;
+    int row, col, c;
+
+    lb->n = 0;
+    for (row = first + 1; row <= last; row++) {
+	CELL *cur = blk->clump[row];
+	CELL *prev = blk->clump[row - 1];
+
+	for (col = 1; col <= blk->ncols; col++) {
+	    CELL label = 0;
+
+	    if (is_null(blk, row, col)) {	/* don't clump NULL data */
+		cur[col] = 0;
+		continue;
+	    }
+
+	    /* same clump as to the left */
+	    if (similar(blk, row, col, row, col - 1))
+		label = cur[col - 1];
+
+	    /* check above (diagonal: and above left and above right),
+	     * clumps touching other clumps are merged */
+	    for (c = col - d; row > first + 1 && c <= col + d; c++) {
+		if (!similar(blk, row, col, row - 1, c))
+		    continue;
+		if (label == 0)
+		    label = prev[c];
+		else
+		    merge(lb->index, label, prev[c]);
+	    }
+
+	    if (label == 0) {
+		/* start a new clump */
+		label = ++lb->n;
+		if (label >= lb->nalloc) {
+		    lb->nalloc += INCR;
+		    lb->index =
+			(CELL *) G_realloc(lb->index,
+					   lb->nalloc * sizeof(CELL));
+		}
+		lb->index[label] = label;
+	    }
+	    cur[col] = label;
+	}
+    }
+}
+
+/* runs on a worker thread, converts the labels of the rows
+ * first + 1 to last to global labels */
+static void offset_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    CELL offset = blk->labels[first / blk->chunk].offset;
+    int row, col;
+
+    for (row = first + 1; row <= last; row++) {
+	CELL *cur = blk->clump[row];
+
+	for (col = 1; col <= blk->ncols; col++) {
+	    if (cur[col])
+		cur[col] += offset;
+	}
+    }
+}
+
+/* merges the clumps of a row with the touching clumps in the row above */
+static void merge_rows(const struct block *blk, CELL *index, int row)
+{
+    CELL *cur = blk->clump[row];
+    CELL *prev = blk->clump[row - 1];
+    int d = blk->diag ? 1 : 0;
+    int col, c;
+
+    for (col = 1; col <= blk->ncols; col++) {
+	if (cur[col] == 0)
+	    continue;
+	for (c = col - d; c <= col + d; c++) {
+	    if (prev[c] && similar(blk, row, col, row - 1, c))
+		merge(index, cur[col], prev[c]);
+	}
+    }
+}
+
+/* creates initial clump labels, which are written to the temp file */
+static CELL label_clumps(struct block *blk, int *in_fd, int nprocs,
+			 int cfd, CELL **index_p)
+{
+    int nrows, ncols, row, nblock;
+    int i, t;
+    CELL *index = *index_p;
+    CELL label;
+    int nalloc;
+    int csize;
+
+    nrows = Rast_window_rows();
+    ncols = Rast_window_cols();
+    csize = ncols * sizeof(CELL);
+
+    nblock = nprocs * BLOCK_ROWS;
+    nalloc = INCR;
+    label = 0;
+
+    blk->ncols = ncols;
+    blk->chunk = BLOCK_ROWS;
+    blk->labels = G_calloc(nprocs, sizeof(struct labels));
+    blk->clump = (CELL **) G_malloc((nblock + 1) * sizeof(CELL *));
+    for (i = 0; i <= nblock; i++)
+	blk->clump[i] = (CELL *) G_calloc(ncols + 2, sizeof(CELL));
+
+    for (row = 0; row < nrows; row += nblock) {
+	int n = nrows - row < nblock ? nrows - row : nblock;
+	CELL *temp_clump;
+
+	G_percent(row, nrows, 2);
+
+	for (i = 1; i <= n; i++) {
+	    if (blk->din) {
+		for (t = 0; t < blk->nin; t++)
+		    Rast_get_d_row(in_fd[t], blk->din[i][t] + 1, row + i - 1);
+	    }
+	    else
+		Rast_get_c_row(*in_fd, blk->cin[i] + 1, row + i - 1);
+	}
+
+	/* the rows of a thread are labelled independently ... */
+	G_parallel_for(0, n, blk->chunk, label_rows, blk);
+
+	for (t = 0; t * blk->chunk < n; t++) {
+	    struct labels *lb = &blk->labels[t];
+
+	    if (label + lb->n >= nalloc) {
+		nalloc = label + lb->n + INCR;
+		index = (CELL *) G_realloc(index, nalloc * sizeof(CELL));
+	    }
+	    lb->offset = label;
+	    for (i = 1; i <= lb->n; i++)
+		index[label + i] = label + lb->index[i];
+	    label += lb->n;
+	}
+	G_parallel_for(0, n, blk->chunk, offset_rows, blk);
+
+	/* ... and merged with the clumps above them */
+	for (t = 0; t * blk->chunk < n; t++)
+	    merge_rows(blk, index, t * blk->chunk + 1);
+
+	/* write initial clump IDs */
+	for (i = 1; i <= n; i++) {
+	    if (write(cfd, blk->clump[i] + 1, csize) != csize)
+		G_fatal_error(_("Unable to write to temp file"));
+	}
+
+	/* the last row becomes the row above the next block */
+	temp_clump = blk->clump[0];
+	blk->clump[0] = blk->clump[n];
+	blk->clump[n] = temp_clump;
+	if (blk->din) {
+	    DCELL **temp_in = blk->din[0];
+
+	    blk->din[0] = blk->din[n];
+	    blk->din[n] = temp_in;
+	}
+	else {
+	    CELL *temp_in = blk->cin[0];
+
+	    blk->cin[0] = blk->cin[n];
+	    blk->cin[n] = temp_in;
+	}
+    }
+    G_percent(1, 1, 1);
+
+    for (i = 0; i <= nblock; i++)
+	G_free(blk->clump[i]);
+    G_free(blk->clump);
+    for (i = 0; i < nprocs; i++)
+	G_free(blk->labels[i].index);
+    G_free(blk->labels);
+
+    *index_p = index;
+
+    return label;
+}
+
+/* the threads only read clumpid, the final clump of each label, which
+ * is complete before the first block; each replaces the labels of the
+ * rows it was given in place, no state is kept between rows */
+static void renumber_rows(int first, int last, void *closure)
+{
+    const struct renumber *rb = closure;
+    int row, col;
+
+    for (row = first; row < last; row++) {
+	CELL *temp_clump = rb->buf + (size_t)row * rb->ncols;
+
+	for (col = 0; col < rb->ncols; col++) {
+	    *temp_clump = rb->clumpid[*temp_clump];
+	    if (rb->nulls && *temp_clump == 0)
+		Rast_set_c_null_value(temp_clump, 1);
+	    temp_clump++;
+	}
+    }
+}
+
 static CELL do_renumber(int *in_fd, DCELL *rng, int nin,
                         int diag, int minsize, 
-			int cfd, CELL label, CELL *index, int out_fd)
+			int cfd, CELL label, CELL *index, int out_fd,
+			int nprocs)
 {
-    int row, col, nrows, ncols;
-    int n;
-    CELL OLD, NEW;
-    CELL *temp_cell, *temp_clump;
-    CELL *cur_clump, *out_cell;
+    int row, nrows, ncols;
+    int i, nblock;
+    CELL n;
     CELL *clumpid;
     CELL cat;
     int csize;
+    struct renumber rb;
 
     nrows = Rast_window_rows();
     ncols = Rast_window_cols();
@@ -59,21 +370,14 @@ static CELL do_renumber(int *in_fd, DCELL *rng, int nin,
     G_percent(0, label, 1);
     for (n = 1; n <= label; n++) {
 	G_percent(n, label, 1);
-	OLD = n;
-	NEW = index[n];
-	if (OLD != NEW) {
-	    clumpid[n] = 0;
-	    /* find valid clump ID */
-	    while (OLD != NEW) {
-		OLD = NEW;
-		NEW = index[OLD];
-	    }
-	    index[n] = NEW;
-	}
-	else
-	    /* set final clump id */
+	/* the label of a clump is the label of its first cell,
+	 * clumps are numbered in the order of their first cells */
+	if (index[n] == n)
 	    clumpid[n] = ++cat;
+	else
+	    clumpid[n] = clumpid[index[n]];
     }
+    G_free(index);
 
     /****************************************************
      *                      PASS 2                      *
@@ -82,293 +386,113 @@ static CELL do_renumber(int *in_fd, DCELL *rng, int nin,
 
     G_message(_("Pass 2 of 2..."));
 
-    if (minsize > 1) {
-	int do_write;
-	off_t coffset;
-	CELL new_clump;
-
-	cur_clump = Rast_allocate_c_buf();
-
-	for (row = 0; row < nrows; row++) {
-
-	    G_percent(row, nrows, 2);
-
-	    coffset = (off_t)row * csize;
-	    lseek(cfd, coffset, SEEK_SET);
-	    if (read(cfd, cur_clump, csize) != csize)
-		G_fatal_error(_("Unable to read from temp file"));
-
-	    temp_clump = cur_clump;
-
-	    do_write = 0;
-	    for (col = 0; col < ncols; col++) {
-		new_clump = clumpid[index[*temp_clump]];
-		if (*temp_clump != new_clump) {
-		    *temp_clump = new_clump;
-		    do_write = 1;
-		}
-		temp_clump++;
-	    }
-	    if (do_write) {
-		lseek(cfd, coffset, SEEK_SET);
-		if (write(cfd, cur_clump, csize) != csize)
-		    G_fatal_error(_("Unable to write to temp file"));
-	    }
-	}
-	G_percent(1, 1, 1);
-
-	G_free(cur_clump);
-	G_free(index);
-	G_free(clumpid);
-
-	G_message(_("%d initial clumps"), cat);
-
-	return merge_small_clumps(in_fd, nin, rng,
-                        diag, minsize, &cat, 
-			cfd, out_fd);
-    }
-
-    if (out_fd < 0) {
+    if (minsize <= 1 && out_fd < 0) {
 	fprintf(stdout, "clumps=%d\n", cat);
+	G_free(clumpid);
 	
 	return cat;
     }
 
+    nblock = nprocs * BLOCK_ROWS;
+    rb.buf = (CELL *) G_malloc((size_t)nblock * csize);
+    rb.ncols = ncols;
+    rb.clumpid = clumpid;
+    /* the temp file keeps 0 for NULL */
+    rb.nulls = minsize <= 1;
+
     /* the input raster is no longer needed, 
      * using instead the temp file with initial clump labels */
 
     /* rewind temp file */
     lseek(cfd, 0, SEEK_SET);
 
-    cur_clump = Rast_allocate_c_buf();
-    out_cell = Rast_allocate_c_buf();
-
-    for (row = 0; row < nrows; row++) {
+    for (row = 0; row < nrows; row += nblock) {
+	int nr = nrows - row < nblock ? nrows - row : nblock;
+	size_t bsize = (size_t)nr * csize;
 
 	G_percent(row, nrows, 2);
 
-	if (read(cfd, cur_clump, csize) != csize)
+	if (read(cfd, rb.buf, bsize) != (ssize_t)bsize)
 	    G_fatal_error(_("Unable to read from temp file"));
 
-	temp_clump = cur_clump;
-	temp_cell = out_cell;
+	G_parallel_for(0, nr, BLOCK_ROWS, renumber_rows, &rb);
 
-	for (col = 0; col < ncols; col++) {
-	    *temp_cell = clumpid[index[*temp_clump]];
-	    if (*temp_cell == 0) {
-		Rast_set_c_null_value(temp_cell, 1);
-	    }
-	    temp_clump++;
-	    temp_cell++;
+	if (minsize > 1) {
+	    lseek(cfd, (off_t)row * csize, SEEK_SET);
+	    if (write(cfd, rb.buf, bsize) != (ssize_t)bsize)
+		G_fatal_error(_("Unable to write to temp file"));
+	}
+	else {
+	    for (i = 0; i < nr; i++)
+		Rast_put_row(out_fd, rb.buf + (size_t)i * ncols, CELL_TYPE);
 	}
-	Rast_put_row(out_fd, out_cell, CELL_TYPE);
     }
     G_percent(1, 1, 1);
 
-    G_free(cur_clump);
-    G_free(out_cell);
-    G_free(index);
+    G_free(rb.buf);
     G_free(clumpid);
 
+    if (minsize > 1) {
+	G_message(_("%d initial clumps"), cat);
+
+	return merge_small_clumps(in_fd, nin, rng,
+                        diag, minsize, &cat, 
+			cfd, out_fd);
+    }
+
     return cat;
 }
 
-CELL clump(int *in_fd, int out_fd, int diag, int minsize)
+CELL clump(int *in_fd, int out_fd, int diag, int minsize, int nprocs)
 {
-    register int col;
-    register int n;
-    CELL NEW, OLD;
-    CELL *temp_cell, *temp_clump;
-    CELL *prev_in, *cur_in;
-    CELL *prev_clump, *cur_clump;
-    CELL X, LEFT;
+    int i, nblock;
     CELL *index;
     CELL label;
-    int nrows, ncols;
-    int row;
-    int len;
-    int nalloc;
+    int ncols;
     time_t cur_time;
     char *cname;
-    int cfd, csize;
+    int cfd;
+    struct block blk;
 
-    nrows = Rast_window_rows();
     ncols = Rast_window_cols();
+    nblock = nprocs * BLOCK_ROWS;
 
     /* allocate clump index */
-    nalloc = INCR;
-    index = (CELL *) G_malloc(nalloc * sizeof(CELL));
+    index = (CELL *) G_malloc(INCR * sizeof(CELL));
     index[0] = 0;
 
-    /* allocate CELL buffers two columns larger than current window */
-    len = (ncols + 2) * sizeof(CELL);
-    prev_in = (CELL *) G_malloc(len);
-    cur_in = (CELL *) G_malloc(len);
-    prev_clump = (CELL *) G_malloc(len);
-    cur_clump = (CELL *) G_malloc(len);
+    /* allocate CELL buffers two columns larger than current window,
+     * left and right edge and a fake previous row are NULL */
+    G_zero(&blk, sizeof(blk));
+    blk.diag = diag;
+    blk.cin = (CELL **) G_malloc((nblock + 1) * sizeof(CELL *));
+    for (i = 0; i <= nblock; i++) {
+	blk.cin[i] = (CELL *) G_malloc((ncols + 2) * sizeof(CELL));
+	Rast_set_c_null_value(blk.cin[i], ncols + 2);
+    }
 
     /* temp file for initial clump IDs */
     cname = G_tempfile();
     if ((cfd = open(cname, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0)
 	G_fatal_error(_("Unable to open temp file"));
-    csize = ncols * sizeof(CELL);
 
     time(&cur_time);
 
-    /* fake a previous row which is all NULL */
-    Rast_set_c_null_value(prev_in, ncols + 2);
-
-    /* set left and right edge to NULL */
-    Rast_set_c_null_value(&cur_in[0], 1);
-    Rast_set_c_null_value(&cur_in[ncols + 1], 1);
-
-    /* initialize clump labels */
-    G_zero(cur_clump, len);
-    G_zero(prev_clump, len);
-    label = 0;
-
     /****************************************************
      *                      PASS 1                      *
      * pass thru the input, create initial clump labels *
      ****************************************************/
 
     G_message(_("Pass 1 of 2..."));
-    for (row = 0; row < nrows; row++) {
-	Rast_get_c_row(*in_fd, cur_in + 1, row);
-
-	G_percent(row, nrows, 2);
-	Rast_set_c_null_value(&X, 1);
-	for (col = 1; col <= ncols; col++) {
-	    LEFT = X;
-	    X = cur_in[col];
-	    if (Rast_is_c_null_value(&X)) {	/* don't clump NULL data */
-		cur_clump[col] = 0;
-		continue;
-	    }
-
-	    /*
-	     * if the cell value is different to the left and above
-	     * (diagonal: and above left and above right)
-	     * then we must start a new clump
-	     *
-	     * this new clump may eventually collide with another
-	     * clump and will have to be merged
-	     */
-
-	    /* try to connect the current cell to an existing clump */
-	    OLD = NEW = 0;
-	    /* same clump as to the left */
-	    if (X == LEFT) {
-		OLD = cur_clump[col] = cur_clump[col - 1];
-	    }
-
-	    if (diag) {
-		/* check above right, center, left, in that order */
-		n = 2;
-		temp_clump = prev_clump + col + 1;
-		temp_cell = prev_in + col + 1;
-		do {
-		    if (X == *temp_cell) {
-			cur_clump[col] = *temp_clump;
-			if (OLD == 0) {
-			    OLD = *temp_clump;
-			}
-			else {
-			    NEW = *temp_clump;
-			    break;
-			}
-		    }
-		    temp_cell--;
-		    temp_clump--;
-		} while (n-- > 0);
-	    }
-	    else {
-		/* check above */
-		if (X == prev_in[col]) {
-		    temp_clump = prev_clump + col;
-		    cur_clump[col] = *temp_clump;
-		    if (OLD == 0) {
-			OLD = *temp_clump;
-			}
-		    else {
-			NEW = *temp_clump;
-		    }
-		}
-	    }
-
-	    if (NEW == 0 || OLD == NEW) {	/* ok */
-		if (OLD == 0) {
-		    /* start a new clump */
-		    label++;
-		    cur_clump[col] = label;
-		    if (label >= nalloc) {
-			nalloc += INCR;
-			index =
-			    (CELL *) G_realloc(index,
-					       nalloc * sizeof(CELL));
-		    }
-		    index[label] = label;
-		}
-		continue;
-	    }
-
-	    /* conflict! preserve NEW clump ID and change OLD clump ID.
-	     * Must go back to the left in the current row and to the right
-	     * in the previous row to change all the clump values as well.
-	     */
-
-	    /* left of the current row from 1 to col - 1 */
-	    temp_clump = cur_clump;
-	    n = col - 1;
-	    while (n-- > 0) {
-		temp_clump++;	/* skip left edge */
-		if (*temp_clump == OLD)
-		    *temp_clump = NEW;
-	    }
-
-	    /* right of previous row from col + 1 to ncols */
-	    temp_clump = prev_clump + col;
-	    n = ncols - col;
-	    while (n-- > 0) {
-		temp_clump++;	/* skip col */
-		if (*temp_clump == OLD)
-		    *temp_clump = NEW;
-	    }
-
-	    /* modify the OLD index */
-	    index[OLD] = NEW;
-	}
-
-	/* write initial clump IDs */
-	/* this works also with writing out cur_clump, but only 
-	 * prev_clump is complete and will not change any more */
-	if (row > 0) {
-	    if (write(cfd, prev_clump + 1, csize) != csize)
-		G_fatal_error(_("Unable to write to temp file"));
-	}
-
-	/* switch the buffers so that the current buffer becomes the previous */
-	temp_cell = cur_in;
-	cur_in = prev_in;
-	prev_in = temp_cell;
-
-	temp_clump = cur_clump;
-	cur_clump = prev_clump;
-	prev_clump = temp_clump;
-    }
-    /* write last row with initial clump IDs */
-    if (write(cfd, prev_clump + 1, csize) != csize)
-	G_fatal_error(_("Unable to write to temp file"));
-    G_percent(1, 1, 1);
+    label = label_clumps(&blk, in_fd, nprocs, cfd, &index);
 
     /* free */
-    G_free(prev_clump);
-    G_free(cur_clump);
+    for (i = 0; i <= nblock; i++)
+	G_free(blk.cin[i]);
+    G_free(blk.cin);
 
-    G_free(prev_in);
-    G_free(cur_in);
-
-    do_renumber(in_fd, NULL, 1, diag, minsize, cfd, label, index, out_fd);
+    do_renumber(in_fd, NULL, 1, diag, minsize, cfd, label, index, out_fd,
+		nprocs);
 
     close(cfd);
     unlink(cname);
@@ -378,68 +502,28 @@ CELL clump(int *in_fd, int out_fd, int diag, int minsize)
     return 0;
 }
 
-static double get_diff2(DCELL **a, int acol, DCELL **b, int bcol, DCELL *rng, int n)
-{
-    int i;
-    double diff, diff2;
-
-    diff2 = 0;
-    for (i = 0; i < n; i++) {
-	if (Rast_is_d_null_value(&b[i][bcol]))
-	    return 2;
-	diff = a[i][acol] - b[i][bcol];
-	/* normalize with the band's range */
-	if (rng[i])
-	    diff /= rng[i];
-	diff2 += diff * diff;
-    }
-    /* normalize difference to the range [0, 1] */
-    diff2 /= n;
-    
-    return diff2;
-}
-
 CELL clump_n(int *in_fd, char **inname, int nin, double threshold,
-             int out_fd, int diag, int minsize)
+             int out_fd, int diag, int minsize, int nprocs)
 {
-    register int col;
-    register int i, n;
-    /* input */
-    DCELL **prev_in, **cur_in, **temp_in;
-    int bcol;
+    int i, j, nblock;
     DCELL *rng, maxdiff;
-    double thresh2;
-    /* output */
-    CELL OLD, NEW;
-    CELL *temp_clump;
-    CELL *prev_clump, *cur_clump;
     CELL *index;
     CELL label;
-    int nrows, ncols;
-    int row;
-    int isnull;
-    int len;
-    int nalloc;
+    int ncols;
     time_t cur_time;
     char *cname;
-    int cfd, csize;
+    int cfd;
+    struct block blk;
 
     G_message(_("%d-band clumping with threshold %g"), nin, threshold);
 
-    nrows = Rast_window_rows();
     ncols = Rast_window_cols();
-
-    thresh2 = threshold * threshold;
+    nblock = nprocs * BLOCK_ROWS;
 
     /* allocate clump index */
-    nalloc = INCR;
-    index = (CELL *) G_malloc(nalloc * sizeof(CELL));
+    index = (CELL *) G_malloc(INCR * sizeof(CELL));
     index[0] = 0;
 
-    /* allocate DCELL buffers two columns larger than current window */
-    len = (ncols + 2) * sizeof(DCELL);
-    prev_in = (DCELL **) G_malloc(sizeof(DCELL *) * nin);
-    cur_in = (DCELL **) G_malloc(sizeof(DCELL *) * nin);
     rng = G_malloc(sizeof(DCELL) * nin);
 
     maxdiff = 0;
@@ -453,227 +537,50 @@ CELL clump_n(int *in_fd, char **inname, int nin, double threshold,
 	Rast_get_fp_range_min_max(&fp_range, &min, &max);
 	rng[i] = max - min;
 	maxdiff += rng[i] * rng[i];
-
-	prev_in[i] = (DCELL *) G_malloc(len);
-	cur_in[i] = (DCELL *) G_malloc(len);
-
-	/* fake a previous row which is all NULL */
-	Rast_set_d_null_value(prev_in[i], ncols + 2);
-
-	/* set left and right edge to NULL */
-	Rast_set_d_null_value(&cur_in[i][0], 1);
-	Rast_set_d_null_value(&cur_in[i][ncols + 1], 1);
     }
     G_debug(1, "maximum possible difference: %g", maxdiff);
 
-    /* allocate CELL buffers two columns larger than current window */
-    len = (ncols + 2) * sizeof(CELL);
-    prev_clump = (CELL *) G_malloc(len);
-    cur_clump = (CELL *) G_malloc(len);
+    /* allocate DCELL buffers two columns larger than current window,
+     * left and right edge and a fake previous row are NULL */
+    G_zero(&blk, sizeof(blk));
+    blk.diag = diag;
+    blk.nin = nin;
+    blk.rng = rng;
+    blk.thresh2 = threshold * threshold;
+    blk.din = (DCELL ***) G_malloc((nblock + 1) * sizeof(DCELL **));
+    for (i = 0; i <= nblock; i++) {
+	blk.din[i] = (DCELL **) G_malloc(nin * sizeof(DCELL *));
+	for (j = 0; j < nin; j++) {
+	    blk.din[i][j] = (DCELL *) G_malloc((ncols + 2) * sizeof(DCELL));
+	    Rast_set_d_null_value(blk.din[i][j], ncols + 2);
+	}
+    }
 
     /* temp file for initial clump IDs */
     cname = G_tempfile();
     if ((cfd = open(cname, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0)
 	G_fatal_error(_("Unable to open temp file"));
-    csize = ncols * sizeof(CELL);
 
     time(&cur_time);
 
-    /* initialize clump labels */
-    G_zero(cur_clump, len);
-    G_zero(prev_clump, len);
-    label = 0;
-
     /****************************************************
      *                      PASS 1                      *
      * pass thru the input, create initial clump labels *
      ****************************************************/
 
     G_message(_("Pass 1 of 2..."));
-    for (row = 0; row < nrows; row++) {
-	G_percent(row, nrows, 2);
-	for (i = 0; i < nin; i++) {
-	    Rast_get_d_row(in_fd[i], cur_in[i] + 1, row);
-	}
-
-	for (col = 1; col <= ncols; col++) {
-	    isnull = 0;
-	    for (i = 0; i < nin; i++) {
-		if (Rast_is_d_null_value(&cur_in[i][col])) {	/* don't clump NULL data */
-		    cur_clump[col] = 0;
-		    isnull = 1;
-		    break;
-		}
-	    }
-	    if (isnull)
-		continue;
-
-	    /*
-	     * if the cell values are different to the left and above
-	     * (diagonal: and above left and above right)
-	     * then we must start a new clump
-	     *
-	     * this new clump may eventually collide with another
-	     * clump and will have to be merged
-	     */
-
-	    /* try to connect the current cell to an existing clump */
-	    OLD = NEW = 0;
-	    /* same clump as to the left */
-	    if (get_diff2(cur_in, col, cur_in, col - 1, rng, nin) <= thresh2) {
-		OLD = cur_clump[col] = cur_clump[col - 1];
-	    }
-
-	    if (diag) {
-		/* check above right, center, left, in that order */
-		temp_clump = prev_clump + col + 1;
-		bcol = col + 1;
-		do {
-		    if (get_diff2(cur_in, col, prev_in, bcol, rng, nin) <= thresh2) {
-			cur_clump[col] = *temp_clump;
-			if (OLD == 0) {
-			    OLD = *temp_clump;
-			}
-			else {
-			    NEW = *temp_clump;
-
-			    /* threshold > 0 and diagonal requires a bit of extra work
-			     * because of bridge cells:
-			     * A similar to B, B similar to C, but A not similar to C
-			     * -> B is bridge cell */
-			    if (NEW != OLD) {
-				CELL *temp_clump2;
-
-				/* conflict! preserve NEW clump ID and change OLD clump ID.
-				 * Must go back to the left in the current row and to the right
-				 * in the previous row to change all the clump values as well.
-				 */
-
-				/* left of the current row from 1 to col - 1 */
-				temp_clump2 = cur_clump;
-				n = col - 1;
-				while (n-- > 0) {
-				    temp_clump2++;	/* skip left edge */
-				    if (*temp_clump2 == OLD)
-					*temp_clump2 = NEW;
-				}
-
-				/* right of previous row from col - 1 to ncols */
-				temp_clump2 = prev_clump + col - 1;
-				n = ncols - col + 2;
-				while (n-- > 0) {
-				    if (*temp_clump2 == OLD)
-					*temp_clump2 = NEW;
-				    temp_clump2++;
-				}
-
-				/* modify the OLD index */
-				index[OLD] = NEW;
-
-				OLD = NEW;
-				NEW = 0;
-			    }
-			}
-		    }
-		    temp_clump--;
-		} while (bcol-- > col - 1);
-	    }
-	    else {
-		/* check above */
-		if (get_diff2(cur_in, col, prev_in, col, rng, nin) <= thresh2) {
-		    temp_clump = prev_clump + col;
-		    cur_clump[col] = *temp_clump;
-		    if (OLD == 0) {
-			OLD = *temp_clump;
-			}
-		    else {
-			NEW = *temp_clump;
-			if (NEW != OLD) {
-
-			    /* conflict! preserve NEW clump ID and change OLD clump ID.
-			     * Must go back to the left in the current row and to the right
-			     * in the previous row to change all the clump values as well.
-			     */
-
-			    /* left of the current row from 1 to col - 1 */
-			    temp_clump = cur_clump;
-			    n = col - 1;
-			    while (n-- > 0) {
-				temp_clump++;	/* skip left edge */
-				if (*temp_clump == OLD)
-				    *temp_clump = NEW;
-			    }
-
-			    /* right of previous row from col + 1 to ncols */
-			    temp_clump = prev_clump + col;
-			    n = ncols - col;
-			    while (n-- > 0) {
-				temp_clump++;	/* skip col */
-				if (*temp_clump == OLD)
-				    *temp_clump = NEW;
-			    }
-
-			    /* modify the OLD index */
-			    index[OLD] = NEW;
-
-			    OLD = NEW;
-			    NEW = 0;
-			}
-		    }
-		}
-	    }
-
-	    if (NEW == 0 || OLD == NEW) {	/* ok */
-		if (OLD == 0) {
-		    /* start a new clump */
-		    label++;
-		    cur_clump[col] = label;
-		    if (label >= nalloc) {
-			nalloc += INCR;
-			index =
-			    (CELL *) G_realloc(index,
-					       nalloc * sizeof(CELL));
-		    }
-		    index[label] = label;
-		}
-	    }
-	    /* else the relabelling above failed */
-	}
-
-	/* write initial clump IDs */
-	/* this works also with writing out cur_clump, but only 
-	 * prev_clump is complete and will not change any more */
-	if (row > 0) {
-	    if (write(cfd, prev_clump + 1, csize) != csize)
-		G_fatal_error(_("Unable to write to temp file"));
-	}
-
-	/* switch the buffers so that the current buffer becomes the previous */
-	temp_in = cur_in;
-	cur_in = prev_in;
-	prev_in = temp_in;
-
-	temp_clump = cur_clump;
-	cur_clump = prev_clump;
-	prev_clump = temp_clump;
-    }
-    /* write last row with initial clump IDs */
-    if (write(cfd, prev_clump + 1, csize) != csize)
-	G_fatal_error(_("Unable to write to temp file"));
-    G_percent(1, 1, 1);
+    label = label_clumps(&blk, in_fd, nprocs, cfd, &index);
 
     /* free */
-    G_free(prev_clump);
-    G_free(cur_clump);
-
-    for (i = 0; i < nin; i++) {
-	G_free(prev_in[i]);
-	G_free(cur_in[i]);
+    for (i = 0; i <= nblock; i++) {
+	for (j = 0; j < nin; j++)
+	    G_free(blk.din[i][j]);
+	G_free(blk.din[i]);
     }
-    G_free(prev_in);
-    G_free(cur_in);
+    G_free(blk.din);
 
-    do_renumber(in_fd, rng, nin, diag, minsize, cfd, label, index, out_fd);
+    do_renumber(in_fd, rng, nin, diag, minsize, cfd, label, index, out_fd,
+		nprocs);
 
     close(cfd);
     unlink(cname);
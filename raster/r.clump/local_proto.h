@@ -20,8 +20,8 @@
 #define __LOCAL_PROTO_H__
 
 /* clump.c */
-CELL clump(int *, int, int, int);
-CELL clump_n(int *, char **, int, double, int, int, int);
+CELL clump(int *, int, int, int, int);
+CELL clump_n(int *, char **, int, double, int, int, int, int);
 
 /* minsize.c */
 int merge_small_clumps(int *in_fd, int nin, DCELL *rng,
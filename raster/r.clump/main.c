@@ -37,6 +37,7 @@ int main(int argc, char *argv[])
     int i, n;
     double threshold;
     int minsize;
+    int nprocs;
     char title[512];
     char name[GNAME_MAX];
     char *OUTPUT;
@@ -47,6 +48,7 @@ int main(int argc, char *argv[])
     struct Option *opt_thresh;
     struct Option *opt_minsize;
     struct Option *opt_title;
+    struct Option *opt_nprocs;
     struct Flag *flag_diag;
     struct Flag *flag_print;
 
@@ -90,6 +92,8 @@ int main(int argc, char *argv[])
     opt_minsize->label = _("Minimum clump size in cells");
     opt_minsize->description = _("Clumps smaller than minsize will be merged to form larger clumps");
 
+    opt_nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag_diag = G_define_flag();
     flag_diag->key = 'd';
     flag_diag->label = _("Clump also diagonal cells");
@@ -124,6 +128,8 @@ int main(int argc, char *argv[])
 
     minsize = atoi(opt_minsize->answer);
 
+    nprocs = G_set_nprocs(opt_nprocs);
+
     n = 0;
     while (opt_in->answers[n])
 	n++;
@@ -144,10 +150,10 @@ int main(int argc, char *argv[])
     }
 
     if (n == 1 && threshold == 0)
-	clump(in_fd, out_fd, flag_diag->answer, minsize);
+	clump(in_fd, out_fd, flag_diag->answer, minsize, nprocs);
     else
 	clump_n(in_fd, opt_in->answers, n, threshold, out_fd,
-	        flag_diag->answer, minsize);
+	        flag_diag->answer, minsize, nprocs);
 
     for (i = 0; i < n; i++)
 	Rast_close(in_fd[i]);
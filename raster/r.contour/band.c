@@ -0,0 +1,551 @@
+
+/****************************************************************************
+ *
+ * MODULE:       r.contour
+ *
+ * PURPOSE:      Traces the contours of maps which do not fit into memory
+ *               in bands of rows.
+ *
+ * COPYRIGHT:    (C) 2019 by the GRASS Development Team
+ *
+ *               This program is free software under the GNU General Public
+ *               License (>=v2). Read the file COPYING that comes with GRASS
+ *               for details.
+ *
+ ***************************************************************************/
+
+/* The rows are read once, a band at a time. Each cell gives the pieces
+   of the contours crossing it, with the same choice at saddle cells as
+   the tracing in cont.c. The pieces are joined with those ending on the
+   edges shared with the cell above and the cell to the left, so only
+   the pieces which are still open on the last row of the band are kept
+   in memory. A line is finished when both its ends are closed by the
+   border of the region, by nulls, or by meeting each other.
+
+   The levels are traced in parallel, the finished lines are written after
+   each band in the order of the levels. Unlike in cont.c, lines passing
+   through the same saddle cell are never split there. */
+
+#include <stdlib.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/vector.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+#define BAND_ROWS 64
+
+/* positions of open ends */
+#define CLOSED 0
+#define TOP 1			/* edge above the current cell row */
+#define BOTTOM 2		/* edge below the current cell row */
+#define LEFT 3			/* edge left of the current cell */
+#define RIGHT 4			/* edge right of the current cell */
+
+struct piece
+{
+    struct line_pnts *head;	/* points before the first one, reversed */
+    struct line_pnts *tail;	/* points from the first one on */
+    int where[2];		/* position of the head and the tail end */
+    int col[2];
+};
+
+struct end
+{
+    int col;
+    struct piece *p;		/* NULL if the end was used */
+    int side;			/* 0 for the head, 1 for the tail */
+};
+
+struct ends
+{
+    struct end *e;
+    int count, alloc;
+};
+
+struct level
+{
+    double z;
+    struct ends top, bottom;	/* open ends on the horizontal edges */
+    int next;			/* next end of top to be used */
+    struct end left, right;
+    struct contour_lines lines;
+};
+
+struct band
+{
+    struct level *levels;
+    DCELL **rows;
+    int row;			/* first cell row of the band */
+    int count;			/* number of cell rows */
+    struct Cell_head *Cell;
+    int n_cut;
+};
+
+static int npoints(const struct piece *p)
+{
+    return p->head->n_points + p->tail->n_points;
+}
+
+/* append a point to the head or the tail, skipping duplicates */
+static void add_point(struct piece *p, int side, double x, double y,
+		      double z)
+{
+    struct line_pnts *Points;
+    int n;
+
+    if (side) {
+	Points = p->tail;
+	if (Points->n_points > 0)
+	    n = Points->n_points - 1;
+	else {
+	    Points = p->head;
+	    n = 0;
+	}
+    }
+    else {
+	Points = p->head;
+	if (Points->n_points > 0)
+	    n = Points->n_points - 1;
+	else {
+	    Points = p->tail;
+	    n = 0;
+	}
+    }
+
+    if (Points->n_points > 0 && Points->x[n] == x && Points->y[n] == y)
+	return;
+
+    Vect_append_point(side ? p->tail : p->head, x, y, z);
+}
+
+static void finish(struct level *lv, struct piece *p, int n_cut)
+{
+    struct line_pnts *Points = p->head;
+
+    Vect_line_reverse(Points);
+    Vect_append_points(Points, p->tail, GV_FORWARD);
+
+    if ((n_cut <= 0) || ((Points->n_points) >= n_cut))
+	save_line(&lv->lines, Points);
+
+    Vect_destroy_line_struct(p->head);
+    Vect_destroy_line_struct(p->tail);
+    G_free(p);
+}
+
+static struct end *find_end(struct level *lv, int where, int col)
+{
+    struct ends *ends;
+    int lo, hi;
+
+    switch (where) {
+    case LEFT:
+	return &lv->left;
+    case RIGHT:
+	return &lv->right;
+    case TOP:
+	ends = &lv->top;
+	break;
+    case BOTTOM:
+	ends = &lv->bottom;
+	break;
+    default:
+	return NULL;
+    }
+
+    /* the ends are sorted by column */
+    lo = 0;
+    hi = ends->count - 1;
+    while (lo <= hi) {
+	int mid = (lo + hi) / 2;
+
+	if (ends->e[mid].col == col)
+	    return &ends->e[mid];
+	if (ends->e[mid].col < col)
+	    lo = mid + 1;
+	else
+	    hi = mid - 1;
+    }
+
+    G_fatal_error(_("Open end of contour line not found"));
+    return NULL;
+}
+
+static void close_end(struct level *lv, struct end *e, int n_cut)
+{
+    struct piece *p = e->p;
+
+    p->where[e->side] = CLOSED;
+    e->p = NULL;
+    if (p->where[0] == CLOSED && p->where[1] == CLOSED)
+	finish(lv, p, n_cut);
+}
+
+/* the crossing of the level with an edge of a cell */
+static void edge_point(const DCELL * z, int edge, double level, int r,
+		       int c, const struct Cell_head *Cell, double *x,
+		       double *y)
+{
+    double ratio, px, py;
+
+    /* along the rows and down the columns, whichever cell it belongs to */
+    switch (edge) {
+    case 0:
+	ratio = (level - z[0]) / (z[1] - z[0]);
+	px = c + ratio;
+	py = r;
+	break;
+    case 1:
+	ratio = (level - z[1]) / (z[2] - z[1]);
+	px = c + 1;
+	py = r + ratio;
+	break;
+    case 2:
+	ratio = (level - z[3]) / (z[2] - z[3]);
+	px = c + ratio;
+	py = r + 1;
+	break;
+    default:
+	ratio = (level - z[0]) / (z[3] - z[0]);
+	px = c;
+	py = r + ratio;
+	break;
+    }
+
+    *y = Cell->north - (py + .5) * Cell->ns_res;
+    *x = Cell->west + (px + .5) * Cell->ew_res;
+}
+
+/* register a new end of a piece on an edge, or close it on the border */
+static void set_end(struct level *lv, struct piece *p, int side, int edge,
+		    int r, int c, const struct Cell_head *Cell, int n_cut)
+{
+    struct end *e;
+
+    if (edge == 1 && c < Cell->cols - 2) {
+	e = &lv->right;
+	p->where[side] = RIGHT;
+    }
+    else if (edge == 2 && r < Cell->rows - 2) {
+	struct ends *ends = &lv->bottom;
+
+	if (ends->count >= ends->alloc) {
+	    ends->alloc = ends->alloc ? 2 * ends->alloc : 64;
+	    ends->e = G_realloc(ends->e, ends->alloc * sizeof(struct end));
+	}
+	e = &ends->e[ends->count++];
+	p->where[side] = BOTTOM;
+    }
+    else {
+	/* region border, or an edge without a piece on the other side */
+	p->where[side] = CLOSED;
+	if (p->where[1 - side] == CLOSED)
+	    finish(lv, p, n_cut);
+	return;
+    }
+
+    e->col = p->col[side] = c;
+    e->p = p;
+    e->side = side;
+}
+
+/* the open end on an edge shared with a cell already traced */
+static struct end *old_end(struct level *lv, int edge, int c)
+{
+    struct end *e = NULL;
+
+    if (edge == 0 && lv->next < lv->top.count &&
+	lv->top.e[lv->next].col == c)
+	e = &lv->top.e[lv->next];
+    else if (edge == 3)
+	e = &lv->left;
+
+    return e && e->p ? e : NULL;
+}
+
+/* join two ends meeting in a cell */
+static void join(struct level *lv, struct end *e1, struct end *e2, int n_cut)
+{
+    struct piece *p1 = e1->p, *p2 = e2->p, *p;
+    int s1 = e1->side, s2 = e2->side, s, i, other;
+    struct line_pnts *Points;
+
+    e1->p = e2->p = NULL;
+
+    if (p1 == p2) {
+	/* closed line, repeat the first point */
+	Points = p1->head->n_points ? p1->head : p1->tail;
+	i = p1->head->n_points ? Points->n_points - 1 : 0;
+	Vect_append_point(p1->tail, Points->x[i], Points->y[i], Points->z[i]);
+	p1->where[0] = p1->where[1] = CLOSED;
+	finish(lv, p1, n_cut);
+	return;
+    }
+
+    /* copy the smaller piece */
+    if (npoints(p2) > npoints(p1)) {
+	p = p1;
+	p1 = p2;
+	p2 = p;
+	s = s1;
+	s1 = s2;
+	s2 = s;
+    }
+
+    /* points of p2 from the joined end on */
+    if (s2 == 0) {
+	Points = p2->head;
+	for (i = Points->n_points - 1; i >= 0; i--)
+	    add_point(p1, s1, Points->x[i], Points->y[i], Points->z[i]);
+	Points = p2->tail;
+	for (i = 0; i < Points->n_points; i++)
+	    add_point(p1, s1, Points->x[i], Points->y[i], Points->z[i]);
+    }
+    else {
+	Points = p2->tail;
+	for (i = Points->n_points - 1; i >= 0; i--)
+	    add_point(p1, s1, Points->x[i], Points->y[i], Points->z[i]);
+	Points = p2->head;
+	for (i = 0; i < Points->n_points; i++)
+	    add_point(p1, s1, Points->x[i], Points->y[i], Points->z[i]);
+    }
+
+    /* the other end of p2 becomes the joined end of p1 */
+    other = 1 - s2;
+    p1->where[s1] = p2->where[other];
+    p1->col[s1] = p2->col[other];
+    if (p2->where[other] != CLOSED) {
+	struct end *e = find_end(lv, p2->where[other], p2->col[other]);
+
+	e->p = p1;
+	e->side = s1;
+    }
+
+    Vect_destroy_line_struct(p2->head);
+    Vect_destroy_line_struct(p2->tail);
+    G_free(p2);
+
+    if (p1->where[0] == CLOSED && p1->where[1] == CLOSED)
+	finish(lv, p1, n_cut);
+}
+
+/* add the piece of a contour between two edges of a cell */
+static void connect(struct level *lv, const DCELL * z, int a, int b, int r,
+		    int c, const struct Cell_head *Cell, int n_cut)
+{
+    struct end *ea = old_end(lv, a, c), *eb = old_end(lv, b, c), *e;
+    struct piece *p;
+    double x, y;
+    int side;
+
+    if (ea && eb) {
+	join(lv, ea, eb, n_cut);
+	return;
+    }
+
+    if (ea || eb) {
+	/* extend a piece */
+	e = ea ? ea : eb;
+	p = e->p;
+	side = e->side;
+	e->p = NULL;
+	edge_point(z, ea ? b : a, lv->z, r, c, Cell, &x, &y);
+	add_point(p, side, x, y, lv->z);
+	set_end(lv, p, side, ea ? b : a, r, c, Cell, n_cut);
+	return;
+    }
+
+    /* start a new piece */
+    p = G_malloc(sizeof(struct piece));
+    p->head = Vect_new_line_struct();
+    p->tail = Vect_new_line_struct();
+    p->where[0] = p->where[1] = TOP;
+    edge_point(z, a, lv->z, r, c, Cell, &x, &y);
+    add_point(p, 1, x, y, lv->z);
+    edge_point(z, b, lv->z, r, c, Cell, &x, &y);
+    add_point(p, 1, x, y, lv->z);
+    set_end(lv, p, 0, a, r, c, Cell, n_cut);
+    set_end(lv, p, 1, b, r, c, Cell, n_cut);
+}
+
+static void trace_row(struct level *lv, const DCELL * above,
+		      const DCELL * below, int r, const struct Cell_head *Cell,
+		      int n_cut)
+{
+    double level = lv->z;
+    int ncol = Cell->cols;
+    struct ends tmp;
+    int c, i, n;
+
+    lv->next = 0;
+    lv->left.p = lv->right.p = NULL;
+
+    for (c = 0; c < ncol - 1; c++) {
+	DCELL z[4];
+	int cross[4];
+
+	/* ends above which were not used */
+	while (lv->next < lv->top.count && lv->top.e[lv->next].col < c) {
+	    if (lv->top.e[lv->next].p)
+		close_end(lv, &lv->top.e[lv->next], n_cut);
+	    lv->next++;
+	}
+
+	z[0] = above[c];
+	z[1] = above[c + 1];
+	z[2] = below[c + 1];
+	z[3] = below[c];
+
+	n = 0;
+	for (i = 0; i < 4; i++) {
+	    cross[i] = checkedge(z[i], z[(i + 1) % 4], level);
+	    n += cross[i];
+	}
+
+	if (n == 2) {
+	    int a = -1, b = -1;
+
+	    for (i = 0; i < 4; i++)
+		if (cross[i]) {
+		    if (a < 0)
+			a = i;
+		    else
+			b = i;
+		}
+	    connect(lv, z, a, b, r, c, Cell, n_cut);
+	}
+	else if (n == 4) {
+	    double mid = (z[0] + z[1] + z[2] + z[3]) / 4;
+
+	    /* separate the corners on the other side than the middle */
+	    if (checkedge(mid, z[0], level)) {
+		connect(lv, z, 3, 0, r, c, Cell, n_cut);
+		connect(lv, z, 1, 2, r, c, Cell, n_cut);
+	    }
+	    else {
+		connect(lv, z, 0, 1, r, c, Cell, n_cut);
+		connect(lv, z, 2, 3, r, c, Cell, n_cut);
+	    }
+	}
+	else if (n == 1)
+	    lv->lines.ncrossing++;
+
+	/* ends above and to the left which were not used */
+	if (lv->next < lv->top.count && lv->top.e[lv->next].col == c) {
+	    if (lv->top.e[lv->next].p)
+		close_end(lv, &lv->top.e[lv->next], n_cut);
+	    lv->next++;
+	}
+	if (lv->left.p)
+	    close_end(lv, &lv->left, n_cut);
+
+	/* the right edge is the left edge of the next cell */
+	lv->left = lv->right;
+	lv->right.p = NULL;
+	if (lv->left.p)
+	    lv->left.p->where[lv->left.side] = LEFT;
+    }
+
+    while (lv->next < lv->top.count) {
+	if (lv->top.e[lv->next].p)
+	    close_end(lv, &lv->top.e[lv->next], n_cut);
+	lv->next++;
+    }
+
+    /* the edges below are the edges above the next row */
+    tmp = lv->top;
+    lv->top = lv->bottom;
+    lv->bottom = tmp;
+    lv->bottom.count = 0;
+    for (i = 0; i < lv->top.count; i++) {
+	struct end *e = &lv->top.e[i];
+
+	if (e->p)
+	    e->p->where[e->side] = TOP;
+    }
+}
+
+static void trace_band(int first, int last, void *closure)
+{
+    struct band *b = closure;
+    int n, i;
+
+    for (n = first; n < last; n++)
+	for (i = 0; i < b->count; i++)
+	    trace_row(&b->levels[n], b->rows[i], b->rows[i + 1],
+		      b->row + i, b->Cell, b->n_cut);
+}
+
+void contour_bands(int fd, double levels[], int nlevels,
+		   struct Map_info *Map, struct Cell_head Cell, int n_cut)
+{
+    int nrow = Cell.rows, ncol = Cell.cols;
+    struct band b;
+    struct level *lv;
+    double *sorted;
+    DCELL *tmp;
+    int ncrossing;
+    int n, i, row;
+
+    G_message(n_("Writing vector contour (one level) in bands of rows...",
+		 "Writing vector contours (total levels %d) in bands of rows...",
+		 nlevels), nlevels);
+
+    sorted = sort_levels(levels, nlevels);
+
+    lv = (struct level *)G_calloc(nlevels, sizeof(struct level));
+    for (n = 0; n < nlevels; n++)
+	lv[n].z = levels[n];
+
+    b.levels = lv;
+    b.Cell = &Cell;
+    b.n_cut = n_cut;
+    b.rows = (DCELL **) G_malloc((BAND_ROWS + 1) * sizeof(DCELL *));
+    for (i = 0; i <= BAND_ROWS; i++)
+	b.rows[i] = Rast_allocate_d_buf();
+
+    Rast_get_d_row(fd, b.rows[0], 0);
+    displace_row(b.rows[0], ncol, sorted, nlevels);
+
+    for (row = 0; row < nrow - 1; row += BAND_ROWS) {
+	b.row = row;
+	b.count = nrow - 1 - row < BAND_ROWS ? nrow - 1 - row : BAND_ROWS;
+
+	for (i = 1; i <= b.count; i++) {
+	    Rast_get_d_row(fd, b.rows[i], row + i);
+	    displace_row(b.rows[i], ncol, sorted, nlevels);
+	}
+
+	G_parallel_for(0, nlevels, 0, trace_band, &b);
+
+	for (n = 0; n < nlevels; n++)
+	    write_lines(Map, &lv[n].lines, n + 1);
+
+	/* the last row of the band is the first of the next one */
+	tmp = b.rows[0];
+	b.rows[0] = b.rows[b.count];
+	b.rows[b.count] = tmp;
+
+	G_percent(row + b.count, nrow - 1, 2);
+    }
+
+    ncrossing = 0;
+    for (n = 0; n < nlevels; n++) {
+	ncrossing += lv[n].lines.ncrossing;
+	G_free(lv[n].top.e);
+	G_free(lv[n].bottom.e);
+	G_free(lv[n].lines.lines);
+    }
+
+    if (ncrossing > 0) {
+	G_warning(n_("%d crossing found",
+		     "%d crossings found", ncrossing), ncrossing);
+    }
+
+    for (i = 0; i <= BAND_ROWS; i++)
+	G_free(b.rows[i]);
+    G_free(b.rows);
+    G_free(lv);
+    G_free(sorted);
+}
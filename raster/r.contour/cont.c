@@ -47,168 +47,209 @@ static void getpoint(struct cell *curr, double,
 		     struct Cell_head, struct line_pnts *);
 
 
-void contour(double levels[],
-	     int nlevels,
-	     struct Map_info Map,
-	     DCELL ** z, struct Cell_head Cell, int n_cut)
+struct trace
+{
+    double *levels;
+    int first;			/* first level of the chunk */
+    DCELL **z;
+    struct Cell_head Cell;
+    int n_cut;
+    char ***hit;		/* hit array of each level of the chunk */
+    struct contour_lines *lines;	/* lines of each level of the chunk */
+};
+
+static void trace_level(double level, DCELL ** z, struct Cell_head Cell,
+			int n_cut, char **hit, struct contour_lines *lines)
 {
     int nrow, ncol;		/* number of rows and columns in current region */
     int startrow, startcol;	/* start row and col of current line */
-    int n, i, j;		/* loop counters */
-    double level;		/* current contour level */
-    char **hit;			/* array of flags--1 if Cell has been hit;  */
-
-    /*  0 if Cell is still to be checked */
+    int i, j;			/* loop counters */
     struct line_pnts *Points;
-    struct line_cats *Cats;
     int outside;		/* 1 if line is exiting region; 0 otherwise */
     struct cell current;
     int p1, p2;			/* indexes to end points of cell edges */
 
-    int ncrossing;		/* number of found crossing */
-
     Points = Vect_new_line_struct();
-    Cats = Vect_new_cats_struct();
 
     nrow = Cell.rows;
     ncol = Cell.cols;
 
-    hit = (char **)G_malloc((nrow - 1) * sizeof(char *));
-    for (i = 0; i < nrow - 1; i++)
-	hit[i] = (char *)G_malloc((ncol - 1) * sizeof(char));
-
-    ncrossing = 0;
-
-    G_message(n_("Writing vector contour (one level)...", 
-        "Writing vector contours (total levels %d)...", nlevels), nlevels);
-
-    for (n = 0; n < nlevels; n++) {
-	level = levels[n];
-	G_percent(n+1, nlevels, 2);	/* print progress */
-
-	/* initialize hit array */
-	for (i = 0; i < nrow - 1; i++) {
-	    for (j = 0; j < ncol - 1; j++) {
-		hit[i][j] = 0;
-	    }
+    /* initialize hit array */
+    for (i = 0; i < nrow - 1; i++) {
+	for (j = 0; j < ncol - 1; j++) {
+	    hit[i][j] = 0;
 	}
+    }
 
-	/* check each cell of top and bottom borders  */
-	for (startrow = 0; startrow < nrow; startrow += (nrow - 2)) {
-	    for (startcol = 0; startcol <= ncol - 2; startcol++) {
+    /* check each cell of top and bottom borders  */
+    for (startrow = 0; startrow < nrow; startrow += (nrow - 2)) {
+	for (startcol = 0; startcol <= ncol - 2; startcol++) {
 
-		/* look for starting point of new line */
-		if (!hit[startrow][startcol]) {
-		    current.r = startrow;
-		    current.c = startcol;
-		    outside = getnewcell(&current, nrow, ncol, z);
+	    /* look for starting point of new line */
+	    if (!hit[startrow][startcol]) {
+		current.r = startrow;
+		current.c = startcol;
+		outside = getnewcell(&current, nrow, ncol, z);
 
-		    /* is this top or bottom? */
-		    if (startrow == 0)	/* top */
-			current.edge = 0;
-		    else	/* bottom edge */
-			current.edge = 2;
-		    p1 = current.edge;
-		    p2 = current.edge + 1;
-
-		    if (checkedge(current.z[p1], current.z[p2], level)) {
-			getpoint(&current, level, Cell, Points);
-			/* while not off an edge, follow line */
-			while (!outside && !hit[current.r][current.c]) {
-			    hit[current.r][current.c] |=
-				findcrossing(&current, level, Cell, Points,
-					     &ncrossing);
-			    newedge(&current);
-			    outside = getnewcell(&current, nrow, ncol, z);
-			}
-			if ((n_cut <= 0) || ((Points->n_points) >= n_cut)) {
-			    Vect_reset_cats(Cats);
-			    Vect_cat_set(Cats, 1, n + 1);
-			    Vect_write_line(&Map, GV_LINE, Points, Cats);
-			}
-			Vect_reset_line(Points);
-		    }		/* if checkedge */
-		}		/* if ! hit */
-	    }			/* for columns */
+		/* is this top or bottom? */
+		if (startrow == 0)	/* top */
+		    current.edge = 0;
+		else		/* bottom edge */
+		    current.edge = 2;
+		p1 = current.edge;
+		p2 = current.edge + 1;
+
+		if (checkedge(current.z[p1], current.z[p2], level)) {
+		    getpoint(&current, level, Cell, Points);
+		    /* while not off an edge, follow line */
+		    while (!outside && !hit[current.r][current.c]) {
+			hit[current.r][current.c] |=
+			    findcrossing(&current, level, Cell, Points,
+					 &lines->ncrossing);
+			newedge(&current);
+			outside = getnewcell(&current, nrow, ncol, z);
+		    }
+		    if ((n_cut <= 0) || ((Points->n_points) >= n_cut))
+			save_line(lines, Points);
+		    Vect_reset_line(Points);
+		}		/* if checkedge */
+	    }			/* if ! hit */
+	}			/* for columns */
+    }				/* for rows */
+
+    /* check right and left borders (each row of first and last column) */
+    for (startcol = 0; startcol < ncol; startcol += (ncol - 2)) {
+	for (startrow = 0; startrow <= nrow - 2; startrow++) {
+	    /* look for starting point of new line */
+	    if (!hit[startrow][startcol]) {
+		current.r = startrow;
+		current.c = startcol;
+		outside = getnewcell(&current, nrow, ncol, z);
+
+		/* is this left or right edge? */
+		if (startcol == 0)	/* left */
+		    current.edge = 3;
+		else		/* right edge */
+		    current.edge = 1;
+		p1 = current.edge;
+		p2 = (current.edge + 1) % 4;
+		if (checkedge(current.z[p1], current.z[p2], level)) {
+		    getpoint(&current, level, Cell, Points);
+		    /* while not off an edge, follow line */
+		    while (!outside && !hit[current.r][current.c]) {
+			hit[current.r][current.c] |=
+			    findcrossing(&current, level, Cell, Points,
+					 &lines->ncrossing);
+			newedge(&current);
+			outside = getnewcell(&current, nrow, ncol, z);
+		    }
+		    if ((n_cut <= 0) || ((Points->n_points) >= n_cut))
+			save_line(lines, Points);
+		    Vect_reset_line(Points);
+		}		/* if checkedge */
+	    }			/* if ! hit */
 	}			/* for rows */
-
-	/* check right and left borders (each row of first and last column) */
-	for (startcol = 0; startcol < ncol; startcol += (ncol - 2)) {
-	    for (startrow = 0; startrow <= nrow - 2; startrow++) {
-		/* look for starting point of new line */
-		if (!hit[startrow][startcol]) {
-		    current.r = startrow;
-		    current.c = startcol;
+    }				/* for columns */
+
+    /* check each interior Cell */
+    for (startrow = 1; startrow <= nrow - 3; startrow++) {
+	for (startcol = 1; startcol <= ncol - 3; startcol++) {
+	    /* look for starting point of new line */
+	    if (!hit[startrow][startcol]) {
+		current.r = startrow;
+		current.c = startcol;
+		current.edge = 0;
+		outside = getnewcell(&current, nrow, ncol, z);
+		if (!outside &&
+		    checkedge(current.z[0], current.z[1], level)) {
+		    getpoint(&current, level, Cell, Points);
+		    hit[current.r][current.c] |=
+			findcrossing(&current, level, Cell, Points,
+				     &lines->ncrossing);
+		    newedge(&current);
 		    outside = getnewcell(&current, nrow, ncol, z);
 
-		    /* is this left or right edge? */
-		    if (startcol == 0)	/* left */
-			current.edge = 3;
-		    else	/* right edge */
-			current.edge = 1;
-		    p1 = current.edge;
-		    p2 = (current.edge + 1) % 4;
-		    if (checkedge(current.z[p1], current.z[p2], level)) {
-			getpoint(&current, level, Cell, Points);
-			/* while not off an edge, follow line */
-			while (!outside && !hit[current.r][current.c]) {
-			    hit[current.r][current.c] |=
-				findcrossing(&current, level, Cell, Points,
-					     &ncrossing);
-			    newedge(&current);
-			    outside = getnewcell(&current, nrow, ncol, z);
-			}
-			if ((n_cut <= 0) || ((Points->n_points) >= n_cut)) {
-			    Vect_reset_cats(Cats);
-			    Vect_cat_set(Cats, 1, n + 1);
-			    Vect_write_line(&Map, GV_LINE, Points, Cats);
-			}
-			Vect_reset_line(Points);
-		    }		/* if checkedge */
-		}		/* if ! hit */
-	    }			/* for rows */
-	}			/* for columns */
-
-	/* check each interior Cell */
-	for (startrow = 1; startrow <= nrow - 3; startrow++) {
-	    for (startcol = 1; startcol <= ncol - 3; startcol++) {
-		/* look for starting point of new line */
-		if (!hit[startrow][startcol]) {
-		    current.r = startrow;
-		    current.c = startcol;
-		    current.edge = 0;
-		    outside = getnewcell(&current, nrow, ncol, z);
-		    if (!outside &&
-			checkedge(current.z[0], current.z[1], level)) {
-			getpoint(&current, level, Cell, Points);
+		    /* while not back to starting point, follow line */
+		    while (!outside && !hit[current.r][current.c] &&
+			   ((current.edge != 0) ||
+			    ((current.r != startrow) ||
+			     (current.c != startcol)))) {
 			hit[current.r][current.c] |=
 			    findcrossing(&current, level, Cell, Points,
-					 &ncrossing);
+					 &lines->ncrossing);
 			newedge(&current);
 			outside = getnewcell(&current, nrow, ncol, z);
+		    }
+		    if ((n_cut <= 0) || ((Points->n_points) >= n_cut))
+			save_line(lines, Points);
+		    Vect_reset_line(Points);
+		}		/* if checkedge */
+	    }			/* if ! hit */
+	}			/* for rows */
+    }				/* for columns */
 
-			/* while not back to starting point, follow line */
-			while (!outside && !hit[current.r][current.c] &&
-			       ((current.edge != 0) ||
-				((current.r != startrow) ||
-				 (current.c != startcol)))) {
-			    hit[current.r][current.c] |=
-				findcrossing(&current, level, Cell, Points,
-					     &ncrossing);
-			    newedge(&current);
-			    outside = getnewcell(&current, nrow, ncol, z);
-			}
-			if ((n_cut <= 0) || ((Points->n_points) >= n_cut)) {
-			    Vect_reset_cats(Cats);
-			    Vect_cat_set(Cats, 1, n + 1);
-			    Vect_write_line(&Map, GV_LINE, Points, Cats);
-			}
-			Vect_reset_line(Points);
-		    }		/* if checkedge */
-		}		/* if ! hit */
-	    }			/* for rows */
-	}			/* for columns */
-    }				/* for levels */
+    Vect_destroy_line_struct(Points);
+}
+
+static void trace_levels(int first, int last, void *closure)
+{
+    struct trace *t = closure;
+    int n;
+
+    /* a call gets one level of the chunk, or all without threads */
+    for (n = first; n < last; n++)
+	trace_level(t->levels[t->first + n], t->z, t->Cell, t->n_cut,
+		    t->hit[first], &t->lines[n]);
+}
+
+/* Each level is traced by one thread with its own hit array, the lines
+   are kept until all levels before it are written, so that the output
+   does not depend on the number of threads. */
+void contour(double levels[],
+	     int nlevels,
+	     struct Map_info *Map,
+	     DCELL ** z, struct Cell_head Cell, int n_cut)
+{
+    int nrow, ncol;		/* number of rows and columns in current region */
+    int n, i, k;		/* loop counters */
+    struct trace t;
+    int ncrossing;		/* number of found crossing */
+
+    nrow = Cell.rows;
+    ncol = Cell.cols;
+
+    t.levels = levels;
+    t.z = z;
+    t.Cell = Cell;
+    t.n_cut = n_cut;
+    t.hit = (char ***)G_malloc(nprocs * sizeof(char **));
+    t.lines = (struct contour_lines *)G_calloc(nprocs,
+						sizeof(struct contour_lines));
+    for (k = 0; k < nprocs; k++) {
+	/* array of flags--1 if Cell has been hit; 0 if Cell is still to be checked */
+	t.hit[k] = (char **)G_malloc((nrow - 1) * sizeof(char *));
+	for (i = 0; i < nrow - 1; i++)
+	    t.hit[k][i] = (char *)G_malloc((ncol - 1) * sizeof(char));
+    }
+
+    ncrossing = 0;
+
+    G_message(n_("Writing vector contour (one level)...", 
+        "Writing vector contours (total levels %d)...", nlevels), nlevels);
+
+    for (n = 0; n < nlevels; n += nprocs) {
+	int count = nlevels - n < nprocs ? nlevels - n : nprocs;
+
+	t.first = n;
+	G_parallel_for(0, count, 1, trace_levels, &t);
+
+	for (k = 0; k < count; k++) {
+	    write_lines(Map, &t.lines[k], n + k + 1);
+	    ncrossing += t.lines[k].ncrossing;
+	    t.lines[k].ncrossing = 0;
+	    G_percent(n + k + 1, nlevels, 2);	/* print progress */
+	}
+    }
 
     if (ncrossing > 0) {
 	G_warning(n_("%d crossing found", 
@@ -216,7 +257,46 @@ void contour(double levels[],
         ncrossing), ncrossing);
     }
 
-    Vect_destroy_line_struct(Points);
+    for (k = 0; k < nprocs; k++) {
+	for (i = 0; i < nrow - 1; i++)
+	    G_free(t.hit[k][i]);
+	G_free(t.hit[k]);
+	G_free(t.lines[k].lines);
+    }
+    G_free(t.hit);
+    G_free(t.lines);
+}
+
+/* keep a copy of a line */
+void save_line(struct contour_lines *lines, const struct line_pnts *Points)
+{
+    struct line_pnts *copy;
+
+    if (lines->count >= lines->alloc) {
+	lines->alloc = lines->alloc ? 2 * lines->alloc : 64;
+	lines->lines = G_realloc(lines->lines,
+				 lines->alloc * sizeof(struct line_pnts *));
+    }
+    copy = Vect_new_line_struct();
+    Vect_append_points(copy, Points, GV_FORWARD);
+    lines->lines[lines->count++] = copy;
+}
+
+/* write the kept lines of a level and free them */
+void write_lines(struct Map_info *Map, struct contour_lines *lines, int cat)
+{
+    struct line_cats *Cats;
+    int i;
+
+    Cats = Vect_new_cats_struct();
+    Vect_cat_set(Cats, 1, cat);
+
+    for (i = 0; i < lines->count; i++) {
+	Vect_write_line(Map, GV_LINE, lines->lines[i], Cats);
+	Vect_destroy_line_struct(lines->lines[i]);
+    }
+    lines->count = 0;
+
     Vect_destroy_cats_struct(Cats);
 }
 
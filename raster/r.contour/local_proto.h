@@ -20,14 +20,33 @@
 #ifndef __LOCAL_PROTO_H__
 #define __LOCAL_PROTO_H__
 
+/* lines of a level waiting to be written */
+struct contour_lines
+{
+    struct line_pnts **lines;
+    int count, alloc;
+    int ncrossing;		/* cells with a single crossing */
+};
+
+extern int nprocs;
+
+/* band.c */
+void contour_bands(int, double *, int, struct Map_info *, struct Cell_head,
+		   int);
+
 /* cont.c */
-void contour(double *, int, struct Map_info, DCELL **, struct Cell_head, int);
+void contour(double *, int, struct Map_info *, DCELL **, struct Cell_head,
+	     int);
 int checkedge(DCELL, DCELL, double);
+void save_line(struct contour_lines *, const struct line_pnts *);
+void write_lines(struct Map_info *, struct contour_lines *, int);
 
 /* main.c */
 DCELL **get_z_array(int, int, int);
 double *getlevels(struct Option *, struct Option *, struct Option *,
 		  struct Option *, struct FPRange *, int *);
 void displaceMatrix(DCELL **, int, int, double *, int);
+double *sort_levels(const double *, int);
+void displace_row(DCELL *, int, const double *, int);
 
 #endif /* __LOCAL_PROTO_H__ */
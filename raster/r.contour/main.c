@@ -51,6 +51,8 @@
 #include <grass/glocale.h>
 #include "local_proto.h"
 
+int nprocs;
+
 int main(int argc, char *argv[])
 {
     struct GModule *module;
@@ -61,6 +63,8 @@ int main(int argc, char *argv[])
     struct Option *max;
     struct Option *step;
     struct Option *cut;
+    struct Option *memory;
+    struct Option *threads;
     struct Flag *notable;
 
     int i;
@@ -74,6 +78,7 @@ int main(int argc, char *argv[])
     double *lev;
     int nlevels;
     int n_cut;
+    int mem;
 
     /* Attributes */
     struct field_info *Fi;
@@ -131,6 +136,18 @@ int main(int argc, char *argv[])
     cut->description =
 	_("Minimum number of points for a contour line (0 -> no limit)");
 
+    memory = G_define_option();
+    memory->key = "memory";
+    memory->type = TYPE_INTEGER;
+    memory->key_desc = "value";
+    memory->required = NO;
+    memory->answer = "300";
+    memory->label = _("Maximum memory to be used for the raster map in MB");
+    memory->description =
+	_("Larger maps are traced in bands of rows, 0 for no limit");
+
+    threads = G_define_standard_option(G_OPT_M_NPROCS);
+
     notable = G_define_standard_flag(G_FLG_V_TABLE);
 
     if (G_parser(argc, argv))
@@ -142,6 +159,8 @@ int main(int argc, char *argv[])
     }
 
     name = map->answer;
+    mem = atoi(memory->answer);
+    nprocs = G_set_nprocs(threads);
 
     fd = Rast_open_old(name, "");
 
@@ -194,11 +213,19 @@ int main(int argc, char *argv[])
                           Fi->table);
     }
 
-    z_array = get_z_array(fd, Wind.rows, Wind.cols);
     lev = getlevels(levels, max, min, step, &range, &nlevels);
-    displaceMatrix(z_array, Wind.rows, Wind.cols, lev, nlevels);
     n_cut = atoi(cut->answer);
-    contour(lev, nlevels, Map, z_array, Wind, n_cut);
+
+    /* the map and a hit array for each thread */
+    if (mem > 0 && (double)Wind.rows * Wind.cols *
+	(sizeof(DCELL) + nprocs) / 1048576. > mem)
+	contour_bands(fd, lev, nlevels, &Map, Wind, n_cut);
+    else {
+	z_array = get_z_array(fd, Wind.rows, Wind.cols);
+	displaceMatrix(z_array, Wind.rows, Wind.cols, lev, nlevels);
+	contour(lev, nlevels, &Map, z_array, Wind, n_cut);
+    }
+    Rast_close(fd);
 
     G_message(_("Writing attributes..."));
     /* Write levels */
@@ -343,22 +370,51 @@ double *getlevels(struct Option *levels,
 /********************************************************************/
 void displaceMatrix(DCELL ** z, int nrow, int ncol, double *lev, int nlevels)
 {
-    int i, j, k;
-    double *currRow;
-    double currVal;
+    int i;
+    double *sorted;
 
     G_message(_("Displacing data..."));
 
+    sorted = sort_levels(lev, nlevels);
+
     for (i = 0; i < nrow; i++) {
-	currRow = z[i];
-	for (j = 0; j < ncol; j++) {
-	    currVal = currRow[j];
-	    for (k = 0; k < nlevels; k++)
-		if (currVal == lev[k]) {
-		    currRow[j] = currVal + currVal * DBL_EPSILON;
-		    break;
-		}
-	}
+	displace_row(z[i], ncol, sorted, nlevels);
 	G_percent(i + 1, nrow, 2);
     }
+
+    G_free(sorted);
+}
+
+static int cmp_levels(const void *a, const void *b)
+{
+    double la = *(const double *)a, lb = *(const double *)b;
+
+    return la < lb ? -1 : la > lb;
+}
+
+/* sorted copy of the levels for displace_row() */
+double *sort_levels(const double *lev, int nlevels)
+{
+    double *sorted = (double *)G_malloc((nlevels + 1) * sizeof(double));
+    int k;
+
+    for (k = 0; k < nlevels; k++)
+	sorted[k] = lev[k];
+    qsort(sorted, nlevels, sizeof(double), cmp_levels);
+
+    return sorted;
+}
+
+void displace_row(DCELL * row, int ncol, const double *sorted, int nlevels)
+{
+    int j;
+
+    for (j = 0; j < ncol; j++) {
+	double currVal = row[j];
+
+	if (Rast_is_d_null_value(&currVal))
+	    continue;
+	if (bsearch(&currVal, sorted, nlevels, sizeof(double), cmp_levels))
+	    row[j] = currVal + currVal * DBL_EPSILON;
+    }
 }
@@ -0,0 +1,256 @@
+/****************************************************************************
+ *
+ * MODULE:       r.cost
+ *
+ * AUTHOR(S):    GRASS Development Team
+ *
+ * PURPOSE:      Cumulative cost surfaces for a batch of start point
+ *               categories
+ *
+ * COPYRIGHT:    (C) 2019 by the GRASS Development Team
+ *
+ *               This program is free software under the GNU General Public
+ *               License (>=v2). Read the file COPYING that comes with GRASS
+ *               for details.
+ *
+ ***************************************************************************/
+
+/* All start points with the same category are the start of one
+ * cumulative cost surface, written to <output>_<category>. The input
+ * costs are read into the cost segment once and shared by all
+ * surfaces; each surface is computed by the Dijkstra search of main.c
+ * on a worker thread with its own heap and its own array of cumulative
+ * costs. As many surfaces as threads are computed at the same time,
+ * the main thread writes them in the order of the categories.
+ */
+
+#include <stdlib.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/segment.h>
+#include <grass/glocale.h>
+#include "cost.h"
+#include "stash.h"
+#include "flag.h"
+#include "delta.h"
+
+struct batch_job
+{
+    int cat;
+    int npoints;
+    struct start_pt **points;
+    const struct delta_solver *ds;
+    DCELL *cost_out;
+    void *worker;
+};
+
+static int cmp_cat(const void *a, const void *b)
+{
+    const struct start_pt *pa = *(const struct start_pt **)a;
+    const struct start_pt *pb = *(const struct start_pt **)b;
+
+    return (pa->value > pb->value) - (pa->value < pb->value);
+}
+
+/* the Dijkstra search of main.c without directions, nearest start
+ * point and stop points; runs on a worker thread */
+static void run_job(void *closure)
+{
+    struct batch_job *job = closure;
+    const struct delta_solver *ds = job->ds;
+    struct cost_heap heap;
+    struct cost *pres_cell;
+    struct neighbor nbr[16];
+    FLAG *visited;
+    int row, i;
+
+    for (row = 0; row < ds->nrows; row++)
+	Rast_set_d_null_value(job->cost_out + (size_t)row * ds->ncols,
+			      ds->ncols);
+
+    cost_heap_init(&heap);
+    for (i = 0; i < job->npoints; i++) {
+	row = job->points[i]->row;
+	job->cost_out[(size_t)row * ds->ncols + job->points[i]->col] = 0.0;
+	cost_heap_insert(&heap, 0.0, row, job->points[i]->col);
+    }
+
+    visited = flag_create(ds->nrows, ds->ncols);
+
+    while ((pres_cell = cost_heap_get_lowest(&heap)) != NULL) {
+	double old_min_cost;
+	struct cc costs;
+	int n;
+
+	/* If we have surpassed the user specified maximum cost, then quit */
+	if (ds->maxcost && ((double)ds->maxcost < pres_cell->min_cost))
+	    break;
+
+	/* If I've already been updated, skip me */
+	old_min_cost = job->cost_out[(size_t)pres_cell->row * ds->ncols +
+				     pres_cell->col];
+	if (!Rast_is_d_null_value(&old_min_cost) &&
+	    pres_cell->min_cost > old_min_cost)
+	    continue;
+	if (FLAG_GET(visited, pres_cell->row, pres_cell->col))
+	    continue;
+	FLAG_SET(visited, pres_cell->row, pres_cell->col);
+
+	Segment_get(ds->cost_seg, &costs, pres_cell->row, pres_cell->col);
+	n = get_neighbors(ds, pres_cell->row, pres_cell->col,
+			  pres_cell->min_cost, costs.cost_in, nbr);
+
+	for (i = 0; i < n; i++) {
+	    DCELL *out = &job->cost_out[(size_t)nbr[i].row * ds->ncols +
+					nbr[i].col];
+
+	    /* add to list or update with lower costs */
+	    if (Rast_is_d_null_value(out) || *out > nbr[i].min_cost) {
+		*out = nbr[i].min_cost;
+		cost_heap_insert(&heap, nbr[i].min_cost, nbr[i].row,
+				 nbr[i].col);
+	    }
+	}
+    }
+
+    flag_destroy(visited);
+    cost_heap_free(&heap);
+}
+
+static void write_job(struct batch_job *job, const char *basename,
+		      FLAG *nulls)
+{
+    const struct delta_solver *ds = job->ds;
+    char name[GNAME_MAX];
+    struct History history;
+    DCELL *cell, peak = 0.0;
+    int fd, row, col;
+
+    sprintf(name, "%s_%d", basename, job->cat);
+    G_verbose_message(_("Writing output raster map <%s>..."), name);
+
+    fd = Rast_open_new(name, DCELL_TYPE);
+    cell = Rast_allocate_d_buf();
+    for (row = 0; row < ds->nrows; row++) {
+	const DCELL *out = job->cost_out + (size_t)row * ds->ncols;
+
+	for (col = 0; col < ds->ncols; col++) {
+	    if ((nulls && FLAG_GET(nulls, row, col)) ||
+		Rast_is_d_null_value(&out[col]))
+		Rast_set_d_null_value(&cell[col], 1);
+	    else {
+		cell[col] = out[col];
+		if (cell[col] > peak)
+		    peak = cell[col];
+	    }
+	}
+	Rast_put_d_row(fd, cell);
+    }
+    G_free(cell);
+    Rast_close(fd);
+
+    Rast_short_history(name, "raster", &history);
+    Rast_command_history(&history);
+    Rast_write_history(name, &history);
+
+    G_verbose_message(_("Peak cost value of <%s>: %g"), name, peak);
+}
+
+/*!
+ * \brief Compute one cumulative cost surface per start point category
+ *
+ * \param ds cost segment, with the input costs, and search parameters
+ * \param head start points, the category is in value
+ * \param nprocs number of surfaces computed at the same time
+ * \param basename output maps are named basename_category
+ * \param keep_nulls keep null cells of the input map cost_fd
+ * \param cost_fd input map
+ */
+void batch_cost(struct delta_solver *ds, struct start_pt *head, int nprocs,
+		const char *basename, int keep_nulls, int cost_fd)
+{
+    struct start_pt **points, *pt;
+    struct batch_job *jobs;
+    FLAG *nulls = NULL;
+    int npoints, njobs, nslots, i, j;
+
+    /* group the start points by category */
+    for (npoints = 0, pt = head; pt; pt = pt->next)
+	npoints++;
+    points = G_malloc(npoints * sizeof(struct start_pt *));
+    for (i = 0, pt = head; pt; pt = pt->next) {
+	if (pt->row < 0 || pt->row >= ds->nrows ||
+	    pt->col < 0 || pt->col >= ds->ncols)
+	    G_fatal_error(_("Specified starting location outside database window"));
+	points[i++] = pt;
+    }
+    qsort(points, npoints, sizeof(struct start_pt *), cmp_cat);
+
+    jobs = G_calloc(npoints, sizeof(struct batch_job));
+    for (i = njobs = 0; i < npoints; njobs++) {
+	struct batch_job *job = &jobs[njobs];
+	char name[GNAME_MAX];
+
+	job->cat = points[i]->value;
+	job->points = &points[i];
+	job->ds = ds;
+	while (i < npoints && points[i]->value == job->cat) {
+	    job->npoints++;
+	    i++;
+	}
+
+	sprintf(name, "%s_%d", basename, job->cat);
+	if (G_legal_filename(name) < 0)
+	    G_fatal_error(_("<%s> is an illegal file name"), name);
+	if (G_find_raster2(name, G_mapset()) && !G_get_overwrite())
+	    G_fatal_error(_("Raster map <%s> already exists"), name);
+    }
+
+    G_message(_("Computing %d cumulative cost surfaces..."), njobs);
+
+    if (keep_nulls) {
+	RASTER_MAP_TYPE data_type = Rast_get_map_type(cost_fd);
+	void *cell = Rast_allocate_buf(data_type);
+	int row, col;
+
+	nulls = flag_create(ds->nrows, ds->ncols);
+	for (row = 0; row < ds->nrows; row++) {
+	    void *ptr = cell;
+
+	    Rast_get_row(cost_fd, cell, row, data_type);
+	    for (col = 0; col < ds->ncols; col++) {
+		if (Rast_is_null_value(ptr, data_type))
+		    FLAG_SET(nulls, row, col);
+		ptr = G_incr_void_ptr(ptr, Rast_cell_size(data_type));
+	    }
+	}
+	G_free(cell);
+    }
+
+    G_init_workers();
+    if (Segment_set_shared(ds->cost_seg, nprocs) < 0)
+	G_fatal_error(_("Unable to prepare temporary files for threads"));
+
+    nslots = nprocs < njobs ? nprocs : njobs;
+    for (j = 0; j < njobs + nslots; j++) {
+	/* write the surface started nslots jobs ago */
+	if (j >= nslots) {
+	    struct batch_job *job = &jobs[j - nslots];
+
+	    G_end_execute(&job->worker);
+	    write_job(job, basename, nulls);
+	    G_free(job->cost_out);
+	    G_percent(j - nslots + 1, njobs, 1);
+	}
+	if (j < njobs) {
+	    jobs[j].cost_out = G_malloc((size_t)ds->nrows * ds->ncols *
+					sizeof(DCELL));
+	    G_begin_execute(run_job, &jobs[j], &jobs[j].worker, 0);
+	}
+    }
+
+    if (nulls)
+	flag_destroy(nulls);
+    G_free(jobs);
+    G_free(points);
+}
@@ -20,8 +20,22 @@ struct cost
     int col;
 };
 
+struct cost_heap
+{
+    long next_point;
+    long heap_size;
+    long heap_alloced;
+    struct cost *heap;
+    struct cost lowest;		/* returned by get_lowest(), not moved by
+				   realloc in insert() */
+};
+
 /* heap.c */
-struct cost *insert(double, int, int);
+int cost_heap_init(struct cost_heap *);
+int cost_heap_free(struct cost_heap *);
+int cost_heap_insert(struct cost_heap *, double, int, int);
+struct cost *cost_heap_get_lowest(struct cost_heap *);
+int insert(double, int, int);
 struct cost *get_lowest(void);
 int delete(struct cost *);
 int init_heap(void);
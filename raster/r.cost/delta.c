@@ -0,0 +1,458 @@
+/****************************************************************************
+ *
+ * MODULE:       r.cost
+ *
+ * AUTHOR(S):    GRASS Development Team
+ *
+ * PURPOSE:      Parallel delta-stepping solver for the cumulative cost
+ *
+ * COPYRIGHT:    (C) 2019 by the GRASS Development Team
+ *
+ *               This program is free software under the GNU General Public
+ *               License (>=v2). Read the file COPYING that comes with GRASS
+ *               for details.
+ *
+ ***************************************************************************/
+
+/* Delta-stepping replaces the single min heap of the Dijkstra search
+ * by buckets of width delta of tentative costs. All cells in the bucket
+ * with the lowest costs are processed at the same time; cells whose
+ * costs decrease below the end of the bucket go back into the bucket,
+ * which is processed again until it is empty.
+ *
+ * The rows are distributed in blocks over stripes, one per thread, and
+ * each stripe has its own buckets. A round has two phases separated by
+ * waiting for all threads:
+ *
+ * 1) each stripe takes the cells of the current bucket and computes the
+ *    costs of their neighbors, reading only, and sends the lower costs
+ *    to the stripe owning the neighbor
+ *
+ * 2) each stripe applies the costs sent to it in the order of the
+ *    sending stripes and puts the updated cells into its buckets
+ *
+ * Cells are written only by their own stripe, and costs are combined
+ * in a fixed order, so the result doesn't depend on the scheduling of
+ * the threads. Final costs are the same as those of the Dijkstra search,
+ * the direction and the nearest start point can differ where two paths
+ * have equal costs.
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/segment.h>
+#include <grass/glocale.h>
+#include "cost.h"
+#include "delta.h"
+
+#define NBUCKETS 1024		/* buckets kept in a ring, the rest overflows */
+#define BLOCK_ROWS 4		/* rows of a stripe block */
+
+struct dentry			/* cell in a bucket */
+{
+    double cost;
+    int row, col;
+};
+
+struct dreq			/* new cost of a cell sent to its stripe */
+{
+    double cost, nearest;
+    int row, col;
+    FCELL dir;
+};
+
+struct elist
+{
+    struct dentry *e;
+    size_t n, nalloc;
+};
+
+struct rlist
+{
+    struct dreq *r;
+    size_t n, nalloc;
+};
+
+struct stripe
+{
+    struct elist ring[NBUCKETS];
+    struct elist overflow;
+    long long overflow_min;	/* lowest bucket in overflow */
+    struct elist frontier;	/* cells processed in phase 1 */
+    struct rlist *out;		/* requests for each stripe */
+    long nprocessed;
+    size_t nsent;
+};
+
+/* neighbors in the order of the Dijkstra search in main.c */
+static const int nbr_row[16] =
+    { 0, 0, -1, 1, -1, -1, 1, 1, -2, -2, 2, 2, -1, -1, 1, 1 };
+static const int nbr_col[16] =
+    { -1, 1, 0, 0, -1, 1, 1, -1, -1, 1, 1, -1, -2, 2, 2, -2 };
+static const FCELL nbr_dir[16] =
+    { 360.0, 180.0, 270.0, 90.0, 315.0, 225.0, 135.0, 45.0,
+    292.5, 247.5, 112.5, 67.5, 337.5, 202.5, 157.5, 22.5
+};
+
+/* the two neighbors crossed by a Knight's move */
+static const int knight_via[8][2] = {
+    {2, 4}, {2, 5}, {3, 6}, {3, 7}, {0, 4}, {1, 5}, {1, 6}, {0, 7}
+};
+
+static struct delta_solver *ds;
+static struct stripe *stripes;
+static int nstripes;
+static long long cur;		/* current bucket */
+
+static int owner(int row)
+{
+    return (row / BLOCK_ROWS) % nstripes;
+}
+
+static long long bucket_of(double cost)
+{
+    double b = cost / ds->delta;
+
+    return b < (double)(LLONG_MAX / 2) ? (long long)b : LLONG_MAX / 2;
+}
+
+static void add_entry(struct elist *l, double cost, int row, int col)
+{
+    if (l->n == l->nalloc) {
+	l->nalloc = l->nalloc ? 2 * l->nalloc : 256;
+	l->e = G_realloc(l->e, l->nalloc * sizeof(struct dentry));
+    }
+    l->e[l->n].cost = cost;
+    l->e[l->n].row = row;
+    l->e[l->n].col = col;
+    l->n++;
+}
+
+/* put a cell into the bucket of its cost, which is not below cur */
+static void push(struct stripe *st, double cost, int row, int col)
+{
+    long long b = bucket_of(cost);
+
+    if (b < cur + NBUCKETS)
+	add_entry(&st->ring[b % NBUCKETS], cost, row, col);
+    else {
+	add_entry(&st->overflow, cost, row, col);
+	if (b < st->overflow_min)
+	    st->overflow_min = b;
+    }
+}
+
+/* move cells from the overflow into the ring once they fit */
+static void redistribute(struct stripe *st)
+{
+    struct elist *l = &st->overflow;
+    size_t i, j;
+
+    if (st->overflow_min >= cur + NBUCKETS)
+	return;
+
+    st->overflow_min = LLONG_MAX;
+    for (i = j = 0; i < l->n; i++) {
+	long long b = bucket_of(l->e[i].cost);
+
+	if (b < cur + NBUCKETS)
+	    add_entry(&st->ring[b % NBUCKETS], l->e[i].cost, l->e[i].row,
+		      l->e[i].col);
+	else {
+	    l->e[j++] = l->e[i];
+	    if (b < st->overflow_min)
+		st->overflow_min = b;
+	}
+    }
+    l->n = j;
+}
+
+static void send(struct stripe *st, double cost, double nearest, int row,
+		 int col, FCELL dir)
+{
+    struct rlist *l = &st->out[owner(row)];
+
+    if (l->n == l->nalloc) {
+	l->nalloc = l->nalloc ? 2 * l->nalloc : 256;
+	l->r = G_realloc(l->r, l->nalloc * sizeof(struct dreq));
+    }
+    l->r[l->n].cost = cost;
+    l->r[l->n].nearest = nearest;
+    l->r[l->n].row = row;
+    l->r[l->n].col = col;
+    l->r[l->n].dir = dir;
+    l->n++;
+    st->nsent++;
+}
+
+/*!
+ * \brief Compute the costs of the neighbors of a cell as in main.c
+ *
+ * \param p cost segment and parameters
+ * \param row row of the cell
+ * \param col column of the cell
+ * \param cost cumulative cost of the cell
+ * \param my_cost input cost of the cell
+ * \param nbr neighbors whose costs could be calculated, at most 16
+ *
+ * \return number of neighbors in nbr
+ */
+int get_neighbors(const struct delta_solver *p, int row, int col,
+		  double cost, double my_cost, struct neighbor *nbr)
+{
+    double nbr_cost[8];
+    int i, n = 0;
+
+    for (i = 0; i < 8; i++)
+	Rast_set_d_null_value(&nbr_cost[i], 1);
+
+    for (i = 0; i < p->total_reviewed; i++) {
+	struct neighbor *nb = &nbr[n];
+	double fcost, fac;
+
+	nb->row = row + nbr_row[i];
+	nb->col = col + nbr_col[i];
+
+	if (nb->row < 0 || nb->row >= p->nrows)
+	    continue;
+	if (nb->col < 0 || nb->col >= p->ncols)
+	    continue;
+
+	Segment_get(p->cost_seg, &nb->costs, nb->row, nb->col);
+
+	if (i < 8) {
+	    nbr_cost[i] = nb->costs.cost_in;
+	    fcost = (double)(nb->costs.cost_in + my_cost);
+	    fac = i < 2 ? p->EW_fac : i < 4 ? p->NS_fac : p->DIAG_fac;
+	}
+	else {
+	    fcost = (double)(nbr_cost[knight_via[i - 8][0]] +
+			     nbr_cost[knight_via[i - 8][1]] +
+			     nb->costs.cost_in + my_cost);
+	    fac = i < 12 ? p->V_DIAG_fac : p->H_DIAG_fac;
+	}
+	nb->min_cost = cost + fcost * fac;
+
+	/* skip if costs could not be calculated */
+	if (Rast_is_d_null_value(&nb->min_cost))
+	    continue;
+
+	nb->dir = nbr_dir[i];
+	n++;
+    }
+
+    return n;
+}
+
+static void relax(struct stripe *st, const struct dentry *e,
+		  const struct cc *costs)
+{
+    struct neighbor nbr[16];
+    int i, n;
+
+    n = get_neighbors(ds, e->row, e->col, e->cost, costs->cost_in, nbr);
+    for (i = 0; i < n; i++) {
+	/* only lower costs are sent, the owner checks again */
+	if (!Rast_is_d_null_value(&nbr[i].costs.cost_out) &&
+	    !(nbr[i].costs.cost_out > nbr[i].min_cost))
+	    continue;
+
+	send(st, nbr[i].min_cost, costs->nearest, nbr[i].row, nbr[i].col,
+	     nbr[i].dir);
+    }
+}
+
+/* phase 1: process the cells of the current bucket */
+static void process_bucket(void *closure)
+{
+    struct stripe *st = closure;
+    struct elist tmp;
+    size_t i;
+
+    st->nprocessed = 0;
+    st->nsent = 0;
+
+    redistribute(st);
+
+    /* new cells of this bucket go into the empty array */
+    tmp = st->ring[cur % NBUCKETS];
+    st->ring[cur % NBUCKETS] = st->frontier;
+    st->frontier = tmp;
+
+    for (i = 0; i < st->frontier.n; i++) {
+	const struct dentry *e = &st->frontier.e[i];
+	struct cc costs;
+
+	/* If we have surpassed the user specified maximum cost, skip */
+	if (ds->maxcost && ((double)ds->maxcost < e->cost))
+	    continue;
+
+	/* If I've already been updated, skip me */
+	Segment_get(ds->cost_seg, &costs, e->row, e->col);
+	if (e->cost > costs.cost_out)
+	    continue;
+
+	st->nprocessed++;
+	relax(st, e, &costs);
+    }
+    st->frontier.n = 0;
+}
+
+/* phase 2: apply the costs sent to a stripe */
+static void apply_requests(void *closure)
+{
+    struct stripe *st = closure;
+    int id = st - stripes;
+    int s;
+
+    for (s = 0; s < nstripes; s++) {
+	struct rlist *l = &stripes[s].out[id];
+	size_t i;
+
+	for (i = 0; i < l->n; i++) {
+	    const struct dreq *r = &l->r[i];
+	    struct cc costs;
+
+	    Segment_get(ds->cost_seg, &costs, r->row, r->col);
+	    if (!Rast_is_d_null_value(&costs.cost_out) &&
+		!(costs.cost_out > r->cost))
+		continue;
+
+	    costs.cost_out = r->cost;
+	    costs.nearest = r->nearest;
+	    Segment_put(ds->cost_seg, &costs, r->row, r->col);
+	    if (ds->dir_seg)
+		Segment_put(ds->dir_seg, &r->dir, r->row, r->col);
+
+	    push(st, r->cost, r->row, r->col);
+	}
+	l->n = 0;
+    }
+}
+
+static void run_phase(void (*func) (void *))
+{
+    struct G_task_group *g = G_task_group_create();
+    int s;
+
+    for (s = 0; s < nstripes; s++)
+	G_task_submit(g, func, &stripes[s]);
+    G_task_group_wait(g);
+    G_task_group_destroy(g);
+}
+
+/* lowest non-empty bucket, -1 if all are empty */
+static long long next_bucket(void)
+{
+    long long b, best = LLONG_MAX;
+    int s;
+
+    for (s = 0; s < nstripes; s++)
+	if (stripes[s].overflow_min < best)
+	    best = stripes[s].overflow_min;
+
+    for (b = cur; b < cur + NBUCKETS && b < best; b++)
+	for (s = 0; s < nstripes; s++)
+	    if (stripes[s].ring[b % NBUCKETS].n)
+		return b;
+
+    return best == LLONG_MAX ? -1 : best;
+}
+
+/*!
+ * \brief Compute cumulative costs with nthreads threads
+ *
+ * The start points are taken from the heap, which is left empty.
+ * Bitmask encoded directions, the solver map and stop points are
+ * not supported.
+ *
+ * \param solver cost segment and parameters
+ * \param nthreads number of stripes processed in parallel
+ */
+void delta_stepping(struct delta_solver *solver, int nthreads)
+{
+    struct cost *pres_cell;
+    long long last_bucket;
+    long n_processed = 0;
+    int s;
+
+    ds = solver;
+    nstripes = nthreads;
+    if (nstripes > (ds->nrows + BLOCK_ROWS - 1) / BLOCK_ROWS)
+	nstripes = (ds->nrows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    if (nstripes < 1)
+	nstripes = 1;
+
+    if (!(ds->delta > 0))
+	ds->delta = 1;
+
+    G_verbose_message(_("Delta-stepping with %d threads, bucket width %g"),
+		      nstripes, ds->delta);
+
+    G_init_workers();
+    if (Segment_set_shared(ds->cost_seg, nstripes) < 0 ||
+	(ds->dir_seg && Segment_set_shared(ds->dir_seg, nstripes) < 0))
+	G_fatal_error(_("Unable to prepare temporary files for threads"));
+
+    stripes = G_calloc(nstripes, sizeof(struct stripe));
+    for (s = 0; s < nstripes; s++) {
+	stripes[s].overflow_min = LLONG_MAX;
+	stripes[s].out = G_calloc(nstripes, sizeof(struct rlist));
+    }
+
+    /* start points */
+    pres_cell = get_lowest();
+    if (pres_cell)
+	cur = bucket_of(pres_cell->min_cost);
+    while (pres_cell != NULL) {
+	push(&stripes[owner(pres_cell->row)], pres_cell->min_cost,
+	     pres_cell->row, pres_cell->col);
+	delete(pres_cell);
+	pres_cell = get_lowest();
+    }
+
+    last_bucket = ds->maxcost ? bucket_of((double)ds->maxcost) : LLONG_MAX;
+
+    while ((cur = next_bucket()) >= 0 && cur <= last_bucket) {
+	/* until no cell falls back into the current bucket */
+	for (;;) {
+	    size_t nsent = 0;
+
+	    run_phase(process_bucket);
+	    for (s = 0; s < nstripes; s++) {
+		n_processed += stripes[s].nprocessed;
+		nsent += stripes[s].nsent;
+	    }
+	    G_percent(n_processed < ds->total_cells ?
+		      n_processed : ds->total_cells, ds->total_cells, 1);
+
+	    if (!nsent)
+		break;
+
+	    run_phase(apply_requests);
+
+	    for (s = 0; s < nstripes; s++)
+		if (stripes[s].ring[cur % NBUCKETS].n)
+		    break;
+	    if (s == nstripes)
+		break;
+	}
+    }
+
+    for (s = 0; s < nstripes; s++) {
+	struct stripe *st = &stripes[s];
+	int i;
+
+	for (i = 0; i < NBUCKETS; i++)
+	    G_free(st->ring[i].e);
+	G_free(st->overflow.e);
+	G_free(st->frontier.e);
+	for (i = 0; i < nstripes; i++)
+	    G_free(st->out[i].r);
+	G_free(st->out);
+    }
+    G_free(stripes);
+    stripes = NULL;
+}
@@ -0,0 +1,54 @@
+/***************************************************************/
+/*                                                             */
+/*       delta.h     in    ~/src/Gcost                         */
+/*                                                             */
+/*       This header file declares the cell structure of the   */
+/*       cost segment, the search parameters and the parallel  */
+/*       searches (delta-stepping and batch of start points).  */
+/*                                                             */
+/***************************************************************/
+
+#ifndef __DELTA_H__
+#define __DELTA_H__
+
+#include <grass/segment.h>
+
+struct start_pt;
+
+/* cell of the cost segment */
+struct cc
+{
+    double cost_in, cost_out, nearest;
+};
+
+struct delta_solver
+{
+    SEGMENT *cost_seg;		/* struct cc */
+    SEGMENT *dir_seg;		/* FCELL directions, NULL if not needed */
+    int nrows, ncols;
+    int total_reviewed;		/* 8 or 16 (Knight's move) neighbors */
+    double EW_fac, NS_fac, DIAG_fac, V_DIAG_fac, H_DIAG_fac;
+    int maxcost;		/* 0: no maximum cumulative cost */
+    double delta;		/* cost range of a bucket */
+    long total_cells;		/* for progress */
+};
+
+/* neighbor of a cell, see get_neighbors() */
+struct neighbor
+{
+    int row, col;
+    double min_cost;		/* cumulative cost through the cell */
+    FCELL dir;			/* movement direction */
+    struct cc costs;		/* cost segment of the neighbor */
+};
+
+/* delta.c */
+int get_neighbors(const struct delta_solver *, int, int, double, double,
+		  struct neighbor *);
+void delta_stepping(struct delta_solver *, int);
+
+/* batch.c */
+void batch_cost(struct delta_solver *, struct start_pt *, int,
+		const char *, int, int);
+
+#endif /* __DELTA_H__ */
@@ -28,14 +28,23 @@
  * A min-heap approach is used.  Components are
  * sorted first by distance then by the order in which they were added.
  *
+ * The heap is a 4-ary heap, its points are stored by value in one
+ * array: comparisons during sifting read neighbouring array elements
+ * instead of following pointers to individually allocated points, and
+ * inserting or removing a point allocates no memory.
+ *
  * insert ()
  *   inserts a new row-col with its distance value into the heap
  *
  * delete()
- *   deletes a row-col entry in the heap
+ *   releases the point returned by get_lowest(), nothing to do
  *
  * get_lowest()
- *   retrieves the entry with the smallest distance value
+ *   retrieves the entry with the smallest distance value, the point
+ *   returned is valid until the next call
+ *
+ * The cost_heap_*() functions do the same on a heap of the caller,
+ * e.g. one heap per thread.
  */
 
 
@@ -44,40 +53,36 @@
 #include <grass/glocale.h>
 #include "cost.h"
 
-#define GET_PARENT(c) (((c) - 2) / 3 + 1)
-#define GET_CHILD(p) (((p) * 3) - 1)
+/* the root is at index 1 */
+#define GET_PARENT(c) (((c) + 2) >> 2)
+#define GET_CHILD(p) (((p) << 2) - 2)
 
-static long next_point = 0;
-static long heap_size = 0;
-static long heap_alloced = 0;
-static struct cost **heap_index, *free_point;
+static struct cost_heap main_heap;
 
-int init_heap(void)
+int cost_heap_init(struct cost_heap *h)
 {
-    next_point = 0;
-    heap_size = 0;
-    heap_alloced = 1000;
-    heap_index = (struct cost **) G_malloc(heap_alloced * sizeof(struct cost *));
+    h->next_point = 0;
+    h->heap_size = 0;
+    h->heap_alloced = 1024;
+    h->heap = (struct cost *) G_malloc(h->heap_alloced * sizeof(struct cost));
 
-    free_point = NULL;
-    
     return 0;
 }
 
-int free_heap(void)
+int cost_heap_free(struct cost_heap *h)
 {
-    if (heap_alloced)
-	G_free(heap_index);
+    if (h->heap_alloced)
+	G_free(h->heap);
 
-    if (free_point)
-	G_free(free_point);
+    h->heap = NULL;
+    h->heap_alloced = 0;
 
     return 0;
 }
 
 /* compare two costs
  * return 1 if a < b else 0 */
-int cmp_costs(struct cost *a, struct cost *b)
+static int cmp_costs(const struct cost *a, const struct cost *b)
 {
     if (a->min_cost < b->min_cost)
 	return 1;
@@ -89,7 +94,8 @@ int cmp_costs(struct cost *a, struct cost *b)
     return 0;
 }
 
-long sift_up(long start, struct cost * child_pnt)
+/* move the hole at start up until pnt can be put there */
+static long sift_up(struct cost *heap, long start, const struct cost *pnt)
 {
     register long parent, child;
 
@@ -99,9 +105,9 @@ long sift_up(long start, struct cost * child_pnt)
 	parent = GET_PARENT(child);
 
 	/* child is smaller */
-	if (cmp_costs(child_pnt, heap_index[parent])) {
+	if (cmp_costs(pnt, &heap[parent])) {
 	    /* push parent point down */
-	    heap_index[child] = heap_index[parent];
+	    heap[child] = heap[parent];
 	    child = parent;
 	}
 	else
@@ -110,59 +116,47 @@ long sift_up(long start, struct cost * child_pnt)
     }
 
     /* put point in new slot */
-    if (child < start) {
-	heap_index[child] = child_pnt;
-    }
+    heap[child] = *pnt;
 
     return child;
 }
 
-struct cost *insert(double min_cost, int row, int col)
+int cost_heap_insert(struct cost_heap *h, double min_cost, int row, int col)
 {
-    struct cost *new_cell;
-
-    if (free_point) {
-	new_cell = free_point;
-	free_point = NULL;
-    }
-    else
-	new_cell = (struct cost *)(G_malloc(sizeof(struct cost)));
-
-    new_cell->min_cost = min_cost;
-    new_cell->age = next_point;
-    new_cell->row = row;
-    new_cell->col = col;
-
-    next_point++;
-    heap_size++;
-    if (heap_size >= heap_alloced) {
-	heap_alloced += 1000;
-	heap_index = (struct cost **) G_realloc((void *)heap_index, heap_alloced * sizeof(struct cost *));
+    struct cost new_cell;
+
+    new_cell.min_cost = min_cost;
+    new_cell.age = h->next_point;
+    new_cell.row = row;
+    new_cell.col = col;
+
+    h->next_point++;
+    h->heap_size++;
+    if (h->heap_size >= h->heap_alloced) {
+	/* grow geometrically, the points are moved by realloc */
+	h->heap_alloced *= 2;
+	h->heap = (struct cost *) G_realloc((void *)h->heap, h->heap_alloced * sizeof(struct cost));
     }
 
-    heap_index[heap_size] = new_cell;
-    sift_up(heap_size, new_cell);
+    sift_up(h->heap, h->heap_size, &new_cell);
 
-    return (new_cell);
+    return 0;
 }
 
-struct cost *get_lowest(void)
+struct cost *cost_heap_get_lowest(struct cost_heap *h)
 {
-    struct cost *next_cell;
+    struct cost *heap = h->heap;
     register long parent, child, childr, i;
 
-    if (heap_size == 0)
+    if (h->heap_size == 0)
 	return NULL;
 	
-    next_cell = heap_index[1];
-    heap_index[0] = next_cell;
+    h->lowest = heap[1];
 
-    if (heap_size == 1) {
-	heap_size--;
+    if (h->heap_size == 1) {
+	h->heap_size--;
 
-	heap_index[1] = NULL;
-
-	return next_cell;
+	return &h->lowest;
     }
 
     /* start with root */
@@ -170,14 +164,14 @@ struct cost *get_lowest(void)
 
     /* sift down: move hole back towards bottom of heap */
 
-    while ((child = GET_CHILD(parent)) <= heap_size) {
+    while ((child = GET_CHILD(parent)) <= h->heap_size) {
 	/* select smallest child */
-	if (child < heap_size) {
+	if (child < h->heap_size) {
 	    childr = child + 1;
-	    i = child + 3;
-	    while (childr < i && childr <= heap_size) {
+	    i = child + 4;
+	    while (childr < i && childr <= h->heap_size) {
 		/* get smallest child */
-		if (cmp_costs(heap_index[childr], heap_index[child])) {
+		if (cmp_costs(&heap[childr], &heap[child])) {
 		    child = childr;
 		}
 		childr++;
@@ -185,30 +179,44 @@ struct cost *get_lowest(void)
 	}
 
 	/* move hole down */
-	heap_index[parent] = heap_index[child];
+	heap[parent] = heap[child];
 	parent = child;
     }
 
     /* hole is in lowest layer, move to heap end */
-    if (parent < heap_size) {
-	heap_index[parent] = heap_index[heap_size];
-
-	/* sift up last swapped point, only necessary if hole moved to heap end */
-	sift_up(parent, heap_index[parent]);
+    if (parent < h->heap_size) {
+	/* sift up last point, only necessary if hole moved to heap end */
+	sift_up(heap, parent, &heap[h->heap_size]);
     }
 
     /* the actual drop */
-    heap_size--;
+    h->heap_size--;
 
-    return next_cell;
+    return &h->lowest;
 }
 
-int delete(struct cost *delete_cell)
+int init_heap(void)
 {
-    if (free_point)
-	G_free(delete_cell);
-    else
-	free_point = delete_cell;
+    return cost_heap_init(&main_heap);
+}
 
+int free_heap(void)
+{
+    return cost_heap_free(&main_heap);
+}
+
+int insert(double min_cost, int row, int col)
+{
+    return cost_heap_insert(&main_heap, min_cost, row, col);
+}
+
+struct cost *get_lowest(void)
+{
+    return cost_heap_get_lowest(&main_heap);
+}
+
+int delete(struct cost *delete_cell)
+{
+    /* the points are owned by the heap */
     return 0;
 }
@@ -77,6 +77,7 @@
 #include "cost.h"
 #include "stash.h"
 #include "flag.h"
+#include "delta.h"
 
 #define SEGCOLSIZE 	64
 
@@ -134,16 +135,15 @@ int main(int argc, char *argv[])
     long n_processed = 0;
     long total_cells;
     struct GModule *module;
-    struct Flag *flag2, *flag3, *flag4, *flag5, *flag6;
+    struct Flag *flag2, *flag3, *flag4, *flag5, *flag6, *flag7;
     struct Option *opt1, *opt2, *opt3, *opt4, *opt5, *opt6, *opt7, *opt8;
-    struct Option *opt9, *opt10, *opt11, *opt12, *opt_solve;
+    struct Option *opt9, *opt10, *opt11, *opt12, *opt_solve, *opt_nprocs;
     struct cost *pres_cell;
     struct start_pt *head_start_pt = NULL;
     struct start_pt *next_start_pt;
-    struct cc {
-	double cost_in, cost_out, nearest;
-    } costs;
+    struct cc costs;
     FLAG *visited;
+    struct delta_solver ds;
 
     void *ptr2;
     RASTER_MAP_TYPE data_type,			 	/* input cost type */
@@ -156,6 +156,9 @@ int main(int argc, char *argv[])
     double disk_mb, mem_mb, pq_mb;
     int dir_bin;
     DCELL mysolvedir[2], solvedir[2];
+    int nprocs;
+    double sum_cost = 0.0;
+    long n_cost = 0;
 
     G_gisinit(argv[0]);
 
@@ -258,6 +261,8 @@ int main(int argc, char *argv[])
     opt10->answer = "300";
     opt10->description = _("Maximum memory to be used in MB");
 
+    opt_nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag2 = G_define_flag();
     flag2->key = 'k';
     flag2->description =
@@ -282,10 +287,23 @@ int main(int argc, char *argv[])
     flag6->description = _("Create bitmask encoded directions");
     flag6->guisection = _("Optional outputs");
 
+    flag7 = G_define_flag();
+    flag7->key = 's';
+    flag7->label =
+	_("Create a separate cost surface for each start point category");
+    flag7->description =
+	_("Output maps are named <output>_<category>");
+    flag7->guisection = _("Start");
+
+    G_option_requires(flag7, opt7, NULL);
+    G_option_excludes(flag7, opt3, opt9, opt11, opt12, opt4, opt8, NULL);
+
     /* Parse options */
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    nprocs = G_set_nprocs(opt_nprocs);
+
     /* If no outdir is specified, set flag to skip all dir */
     if (opt11->answer != NULL)
 	dir = 1;
@@ -564,6 +582,10 @@ int main(int argc, char *argv[])
 		}
 		costs.cost_in = p;
 		Segment_put(&cost_seg, &costs, row, col);
+		if (!Rast_is_d_null_value(&p)) {
+		    sum_cost += p;
+		    n_cost++;
+		}
 		ptr2 = G_incr_void_ptr(ptr2, dsize);
 	    }
 	}
@@ -650,6 +672,35 @@ int main(int argc, char *argv[])
 	Vect_close(&In);
     }
 
+    /* parameters of the searches in delta.c and batch.c */
+    ds.cost_seg = &cost_seg;
+    ds.dir_seg = dir == 1 ? &dir_seg : NULL;
+    ds.nrows = nrows;
+    ds.ncols = ncols;
+    ds.total_reviewed = total_reviewed;
+    ds.EW_fac = EW_fac;
+    ds.NS_fac = NS_fac;
+    ds.DIAG_fac = DIAG_fac;
+    ds.V_DIAG_fac = V_DIAG_fac;
+    ds.H_DIAG_fac = H_DIAG_fac;
+    ds.maxcost = maxcost;
+    /* about the cost of a step to a neighbor */
+    ds.delta = n_cost ? 2 * sum_cost / n_cost *
+	(EW_fac < NS_fac ? EW_fac : NS_fac) : 1.0;
+    ds.total_cells = total_cells;
+
+    /* one surface per start point category, the input costs are shared */
+    if (flag7->answer) {
+	batch_cost(&ds, head_start_pt, nprocs, cum_cost_layer, keep_nulls,
+		   cost_fd);
+
+	free_heap();
+	Segment_close(&cost_seg);
+	Rast_close(cost_fd);
+
+	exit(EXIT_SUCCESS);
+    }
+
     /* read vector with stop points */
     if (opt8->answer) {
 	struct Map_info In;
@@ -812,9 +863,20 @@ int main(int argc, char *argv[])
     n_processed = 0;
     visited = flag_create(nrows, ncols);
 
+    if (nprocs > 1 && (dir_bin || have_solver || stop_pnts)) {
+	G_warning(_("Bitmask encoded directions, solver and stop points "
+		    "need the sequential search, ignoring %s=%d"),
+		  "nprocs", nprocs);
+	nprocs = 1;
+    }
+
+    if (nprocs > 1)
+	/* parallel search, takes all start points from the heap and
+	 * leaves it empty for the loop below */
+	delta_stepping(&ds, nprocs);
+
     pres_cell = get_lowest();
     while (pres_cell != NULL) {
-	struct cost *ct;
 	double N, NE, E, SE, S, SW, W, NW;
 	double NNE, ENE, ESE, SSE, SSW, WSW, WNW, NNW;
 
@@ -1194,12 +1256,8 @@ int main(int argc, char *argv[])
 	if (stop_pnts && time_to_stop(pres_cell->row, pres_cell->col))
 	    break;
 
-	ct = pres_cell;
 	delete(pres_cell);
 	pres_cell = get_lowest();
-
-	if (ct == pres_cell)
-	    G_warning(_("Error, ct == pres_cell"));
     }
     G_percent(1, 1, 1);
 
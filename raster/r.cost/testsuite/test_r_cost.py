@@ -0,0 +1,94 @@
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+
+class TestCostParallel(TestCase):
+    """Compare the parallel search with the sequential search"""
+
+    cost = 'test_r_cost_cost'
+    serial = 'test_r_cost_serial'
+    parallel = 'test_r_cost_parallel'
+    to_remove = [cost, serial, parallel]
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule('g.region', raster='elevation', res=50)
+        cls.runModule('r.mapcalc',
+                      expression='%s = if(elevation > 140, null(), '
+                      'elevation - 50 + 0.1 * rand(0, 100))' % cls.cost,
+                      seed=1)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule('g.remove', flags='f', type='raster',
+                      name=','.join(cls.to_remove))
+
+    def run_cost(self, output, nprocs, **kwargs):
+        self.assertModule('r.cost', input=self.cost, output=output,
+                          start_coordinates=(637500, 221750,
+                                             642000, 218000),
+                          nprocs=nprocs, overwrite=True, **kwargs)
+
+    def test_costs(self):
+        """Cumulative costs are the same"""
+        self.run_cost(self.serial, 1)
+        self.run_cost(self.parallel, 4)
+        self.assertRastersNoDifference(actual=self.parallel,
+                                       reference=self.serial, precision=0)
+
+    def test_costs_knight(self):
+        """Cumulative costs with Knight's move and maximum cost"""
+        self.run_cost(self.serial, 1, flags='k', max_cost=5000)
+        self.run_cost(self.parallel, 4, flags='k', max_cost=5000)
+        self.assertRastersNoDifference(actual=self.parallel,
+                                       reference=self.serial, precision=0)
+
+
+class TestCostBatch(TestCase):
+    """Compare the surfaces of the -s flag with single runs"""
+
+    cost = 'test_r_cost_batch_cost'
+    points = 'test_r_cost_batch_points'
+    batch = 'test_r_cost_batch'
+    single = 'test_r_cost_single'
+    to_remove = [cost, single, batch + '_1', batch + '_2']
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule('g.region', raster='elevation', res=50)
+        cls.runModule('r.mapcalc',
+                      expression='%s = if(elevation > 140, null(), '
+                      'elevation - 50)' % cls.cost)
+        cls.runModule('v.in.ascii', input='-', output=cls.points,
+                      separator='comma', cat=3,
+                      stdin_='637500,221750,1\n642000,218000,2\n'
+                      '634000,224000,2\n')
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule('g.remove', flags='f', type='raster',
+                      name=','.join(cls.to_remove))
+        cls.runModule('g.remove', flags='f', type='vector',
+                      name=cls.points)
+
+    def test_surfaces(self):
+        """Each surface is the same as a run with its start points"""
+        self.assertModule('r.cost', input=self.cost,
+                          start_points=self.points, output=self.batch,
+                          flags='s', nprocs=2)
+        for cat, coords in ((1, (637500, 221750)),
+                            (2, (642000, 218000, 634000, 224000))):
+            self.assertModule('r.cost', input=self.cost,
+                              output=self.single, start_coordinates=coords,
+                              overwrite=True)
+            self.assertRastersNoDifference(actual='%s_%d' % (self.batch, cat),
+                                           reference=self.single,
+                                           precision=1e-6)
+
+
+if __name__ == '__main__':
+    test()
@@ -17,96 +17,123 @@
  ***************************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
 #include <grass/glocale.h>
 #include <grass/raster.h>
-#include <grass/btree.h>
 #include "glob.h"
 #include "local_proto.h"
 
-static int compare(const void *aa, const void *bb)
+struct block *alloc_block(int nblock)
 {
-    const CELL *a = aa;
-    const CELL *b = bb;
-    int i;
-
-    for (i = 0; i < nfiles; i++) {
-	if (a[i] > b[i])
-	    return 1;
-	if (a[i] < b[i])
-	    return -1;
+    struct block *blk = G_malloc(sizeof(struct block));
+    int i, j;
+
+    /* allocate i/o buffers for each row of a block and raster map */
+    blk->cell = (CELL ***) G_calloc(nblock, sizeof(CELL **));
+    for (j = 0; j < nblock; j++) {
+	blk->cell[j] = (CELL **) G_calloc(nfiles, sizeof(CELL *));
+	for (i = 0; i < nfiles; i++)
+	    blk->cell[j][i] = Rast_allocate_c_buf();
     }
 
-    return 0;
+    return blk;
+}
+
+void read_block(int fd[], struct block *blk, int row)
+{
+    int i, j;
+
+    for (j = 0; j < blk->nrows; j++)
+	for (i = 0; i < nfiles; i++)
+	    Rast_get_c_row(fd[i], blk->cell[j][i], row + j);
+}
+
+void free_block(struct block *blk, int nblock)
+{
+    int i, j;
+
+    for (j = 0; j < nblock; j++) {
+	for (i = 0; i < nfiles; i++)
+	    G_free(blk->cell[j][i]);
+	G_free(blk->cell[j]);
+    }
+    G_free(blk->cell);
+    G_free(blk);
 }
 
-CELL cross(int fd[], int non_zero, int primary, int outfd)
+/* a cell gets no category if it is NULL in all maps, or with
+ * non_zero in any map */
+int skip_cell(CELL * cat, int non_zero)
 {
-    BTREE btree;
-    CELL *cell[NFILES];
-    CELL *result_cell;
-    CELL cat[NFILES];
-    int row, col, i;
-    int zero;
-    CELL result;
-    int keysize = nfiles * sizeof(CELL);
-    void *ptr;
-
-    /* allocate i/o buffers for each raster map */
+    int i, nulls = 0;
 
     for (i = 0; i < nfiles; i++)
-	cell[i] = Rast_allocate_c_buf();
-    result_cell = cell[0];
+	if (Rast_is_c_null_value(&cat[i]))
+	    nulls++;
 
-    /* initialize the reclass table */
-    result = 0;
+    return nulls == nfiles || (non_zero && nulls > 0);
+}
 
-    /* here we go */
-    btree_create(&btree, compare, 1);
-    G_message(_("%s: STEP 1 ... "), G_program_name());
-    for (row = 0; row < nrows; row++) {
-	G_percent(row, nrows, 5);
+static void collect_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct Cell_table *t = &blk->tables[first / blk->chunk];
+    CELL cat[NFILES], prev[NFILES];
+    int row, col, i, have_prev = 0;
 
-	/* read the primary file first, even if not first in the list */
-	Rast_get_c_row(fd[primary], cell[0], row);
+    for (row = first; row < last; row++) {
+	CELL **cell = blk->cell[row];
 
-	/* read the others */
-	col = 1;
-	for (i = 0; i < nfiles; i++)
-	    if (i != primary)
-		Rast_get_c_row(fd[i], cell[col++], row);
 	for (col = 0; col < ncols; col++) {
-	    zero = 1;
-	    for (i = 0; i < nfiles; i++) {
+	    for (i = 0; i < nfiles; i++)
 		cat[i] = cell[i][col];
-		if (!Rast_is_c_null_value(&cat[i]))
-		    zero = 0;
-		else if (non_zero) {
-		    zero = 1;
-		    break;
-		}
-	    }
-	    if (zero) {
-		Rast_set_c_null_value(&result_cell[col], 1);
+	    if (skip_cell(cat, blk->non_zero))
+		continue;
+
+	    /* cells of the same combination are often next to each other */
+	    if (have_prev && memcmp(cat, prev, nfiles * sizeof(CELL)) == 0)
 		continue;
-	    }
-
-	    /* search for this value in the tree */
-	    if (btree_find(&btree, cat, &ptr))
-		result_cell[col] = *(CELL*)ptr;
-	    else {
-		btree_update(&btree, cat, keysize, &result, sizeof(CELL));
-		store_reclass(result, primary, cat);
-		result_cell[col] = result;
-		result++;
-	    }
+
+	    Rast_add_cell_table_key(t, cat);
+	    memcpy(prev, cat, nfiles * sizeof(CELL));
+	    have_prev = 1;
 	}
-	Rast_put_row(outfd, result_cell, CELL_TYPE);
+    }
+}
+
+/* collect the combinations of categories of the maps into combos,
+ * returns their number */
+CELL cross(int fd[], int non_zero, int nprocs)
+{
+    struct block *blk;
+    struct Cell_table *tables;
+    CELL ncombos;
+    int nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    int row, i;
+
+    blk = alloc_block(nblock);
+    blk->non_zero = non_zero;
+    blk->tables = tables = G_malloc(nprocs * sizeof(struct Cell_table));
+    for (i = 0; i < nprocs; i++)
+	Rast_init_cell_table(&tables[i], nfiles, 0, 0);
+
+    /* here we go */
+    G_message(_("%s: STEP 1 ... "), G_program_name());
+    for (row = 0; row < nrows; row += nblock) {
+	G_percent(row, nrows, 5);
+
+	blk->nrows = nrows - row < nblock ? nrows - row : nblock;
+	read_block(fd, blk, row);
+
+	blk->chunk = (blk->nrows + nprocs - 1) / nprocs;
+	G_parallel_for(0, blk->nrows, blk->chunk, collect_rows, blk);
     }
     G_percent(nrows, nrows, 5);
 
-    /* free some memory */
-    btree_free(&btree);
-    for (i = 0; i < nfiles; i++)
-	G_free(cell[i]);
-    return result;
+    free_block(blk, nblock);
+
+    ncombos = sort_tables(tables, nprocs);
+    G_free(tables);
+
+    return ncombos;
 }
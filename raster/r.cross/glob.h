@@ -23,6 +23,7 @@
 #include <grass/raster.h>
 
 #define NFILES 30		/* maximum number of layers */
+#define BLOCK_ROWS 16		/* rows per thread in a block of rows */
 
 extern int nfiles;
 extern int nrows;
@@ -30,13 +31,16 @@ extern int ncols;
 extern const char *names[NFILES];
 extern struct Categories labels[NFILES];
 
-typedef struct
+/* rows of all maps, read at once and processed on several threads */
+struct block
 {
-    CELL *cat;
-    CELL result;
-} RECLASS;
-
-extern RECLASS *reclass;
-extern CELL *table;
+    CELL ***cell;		/* by row of the block and map */
+    int nrows;			/* rows of the block */
+    int chunk;			/* rows per thread */
+    int non_zero;
+    struct Cell_table *tables;
+};
+
+extern CELL *combos;		/* nfiles categories for each result */
 
 #endif /* __R_CROSS_GLOB_H__ */
@@ -23,15 +23,19 @@
 int set_cat(CELL, CELL *, struct Categories *);
 
 /* cross.c */
-CELL cross(int[], int, int, int);
+struct block *alloc_block(int);
+void read_block(int[], struct block *, int);
+void free_block(struct block *, int);
+int skip_cell(CELL *, int);
+CELL cross(int[], int, int);
 
 /* main.c */
 int main(int, char *[]);
 
 /* renumber.c */
-int renumber(int, int);
+int renumber(int[], int, int, CELL, int);
 
 /* store.c */
-int store_reclass(CELL, int, CELL *);
+CELL sort_tables(struct Cell_table *, int);
 
 #endif /* __R_CROSS_LOCAL_PROTO_H__ */
@@ -29,10 +29,7 @@ int nrows;
 int ncols;
 const char *names[NFILES];
 struct Categories labels[NFILES];
-RECLASS *reclass;
-CELL *table;
-
-static int cmp(const void *, const void *);
+CELL *combos;
 
 
 int main(int argc, char *argv[])
@@ -45,15 +42,14 @@ int main(int argc, char *argv[])
     const char *mapset;
     int non_zero;
     CELL ncats;
-    int primary;
+    int nprocs;
     struct Categories pcats;
     struct Colors pcolr;
     char buf[1024];
-    CELL result;
     struct GModule *module;
     struct
     {
-	struct Option *input, *output;
+	struct Option *input, *output, *nprocs;
     } parm;
     struct
     {
@@ -82,6 +78,8 @@ int main(int argc, char *argv[])
 
     parm.output = G_define_standard_option(G_OPT_R_OUTPUT);
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     /* Define the different flags */
 
     flag.z = G_define_flag();
@@ -96,6 +94,7 @@ int main(int argc, char *argv[])
 
     nfiles = 0;
     non_zero = flag.z->answer;
+    nprocs = G_set_nprocs(parm.nprocs);
 
     for (nfiles = 0; (name = parm.input->answers[nfiles]); nfiles++) {
 	if (nfiles >= NFILES)
@@ -105,12 +104,13 @@ int main(int argc, char *argv[])
 	    G_fatal_error(_("Raster map <%s> not found"), name);
 	names[nfiles] = name;
 	fd[nfiles] = Rast_open_old(name, mapset);
+	if (nprocs > 1)
+	    Rast_set_read_ahead(fd[nfiles], nprocs * BLOCK_ROWS);
     }
 
     if (nfiles <= 1)
 	G_fatal_error(_("Must specify 2 or more input maps"));
     output = parm.output->answer;
-    outfd = Rast_open_c_new(output);
 
     sprintf(buf, "Cross of %s", names[0]);
     for (i = 1; i < nfiles - 1; i++) {
@@ -121,67 +121,47 @@ int main(int argc, char *argv[])
     strcat(buf, names[i]);
     Rast_init_cats(buf, &pcats);
 
-    /* first step is cross product, but un-ordered */
-    primary = 0;
-    result = cross(fd, non_zero, primary, outfd);
+    /* first step is the set of combinations, sorted by categories */
+    ncats = cross(fd, non_zero, nprocs);
 
     /* print message STEP mesage */
     G_message(_("%s: STEP 2 ..."), G_program_name());
 
-    /* now close all files */
-    for (i = 0; i < nfiles; i++)
-	Rast_close(fd[i]);
-    Rast_close(outfd);
-
-    if (result <= 0)
-	exit(0);
-
-    /* build the renumbering/reclass and the new cats file */
-    qsort(reclass, result, sizeof(RECLASS), cmp);
-    table = (CELL *) G_calloc(result, sizeof(CELL));
+    /* build the new cats file */
     for (i = 0; i < nfiles; i++) {
 	mapset = G_find_raster2(names[i], "");
 	Rast_read_cats(names[i], mapset, &labels[i]);
     }
 
-    for (ncats = 0; ncats < result; ncats++) {
-	table[reclass[ncats].result] = ncats;
-	set_cat(ncats, reclass[ncats].cat, &pcats);
-    }
+    for (i = 0; i < ncats; i++)
+	set_cat(i, &combos[i * nfiles], &pcats);
 
     for (i = 0; i < nfiles; i++)
 	Rast_free_cats(&labels[i]);
 
-    /* reopen the output cell for reading and for writing */
-    fd[0] = Rast_open_old(output, G_mapset());
+    /* the cells are read again, and numbered by their combination */
     outfd = Rast_open_c_new(output);
+    if (nprocs > 1) {
+	for (i = 0; i < nfiles; i++)
+	    Rast_set_read_ahead(fd[i], nprocs * BLOCK_ROWS);
+	Rast_set_write_behind(outfd, nprocs * BLOCK_ROWS);
+    }
 
-    renumber(fd[0], outfd);
+    renumber(fd, outfd, non_zero, ncats, nprocs);
+
+    for (i = 0; i < nfiles; i++)
+	Rast_close(fd[i]);
+    G_free(combos);
 
     G_message(_("Creating support files for <%s>..."), output);
-    Rast_close(fd[0]);
     Rast_close(outfd);
     Rast_write_cats(output, &pcats);
     Rast_free_cats(&pcats);
-    if (result > 0) {
-	Rast_make_random_colors(&pcolr, (CELL) 1, result);
+    if (ncats > 0) {
+	Rast_make_random_colors(&pcolr, (CELL) 1, ncats);
 	Rast_write_colors(output, G_mapset(), &pcolr);
     }
 
-    G_message(_("%d categories"), result);
+    G_message(_("%d categories"), ncats);
     exit(EXIT_SUCCESS);
 }
-
-static int cmp(const void *aa, const void *bb)
-{
-    const RECLASS *a = aa, *b = bb;
-    int i;
-
-    for (i = 0; i < (nfiles + 2); i++) {
-	if (a->cat[i] < b->cat[i])
-	    return -1;
-	if (a->cat[i] > b->cat[i])
-	    return 1;
-    }
-    return 0;
-}
@@ -17,33 +17,87 @@
  ***************************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
 #include "glob.h"
 #include "local_proto.h"
 #include <grass/raster.h>
 #include <grass/glocale.h>
 
+struct lookup
+{
+    struct block *blk;
+    const struct Cell_table *t;	/* category of each combination */
+};
 
-int renumber(int in, int out)
+static void renumber_rows(int first, int last, void *closure)
 {
-    CELL *cell, *c;
-    int row, col;
+    const struct lookup *l = closure;
+    CELL cat[NFILES], prev[NFILES], result = 0;
+    int row, col, i, have_prev = 0;
+
+    for (row = first; row < last; row++) {
+	CELL **cell = l->blk->cell[row];
+
+	for (col = 0; col < ncols; col++) {
+	    for (i = 0; i < nfiles; i++)
+		cat[i] = cell[i][col];
 
-    cell = Rast_allocate_c_buf();
+	    /* the result overwrites the first map */
+	    if (skip_cell(cat, l->blk->non_zero)) {
+		Rast_set_c_null_value(&cell[0][col], 1);
+		continue;
+	    }
+
+	    if (!have_prev || memcmp(cat, prev, nfiles * sizeof(CELL)) != 0) {
+		const CELL *r = Rast_find_cell_table_key(l->t, cat);
+
+		if (r)
+		    result = *r;
+		else
+		    Rast_set_c_null_value(&result, 1);
+		memcpy(prev, cat, nfiles * sizeof(CELL));
+		have_prev = 1;
+	    }
+	    cell[0][col] = result;
+	}
+    }
+}
+
+/* write the category of the combination of each cell */
+int renumber(int fd[], int out, int non_zero, CELL ncombos, int nprocs)
+{
+    struct lookup l;
+    struct Cell_table t;
+    int nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    CELL result;
+    int row, j;
+
+    Rast_init_cell_table(&t, nfiles, sizeof(CELL), ncombos);
+    for (result = 0; result < ncombos; result++)
+	*(CELL *) Rast_add_cell_table_key(&t, &combos[result * nfiles]) =
+	    result;
+
+    l.blk = alloc_block(nblock);
+    l.blk->non_zero = non_zero;
+    l.t = &t;
 
     G_message(_("%s: STEP 3 ... "), G_program_name());
-    for (row = 0; row < nrows; row++) {
+    for (row = 0; row < nrows; row += nblock) {
 	G_percent(row, nrows, 5);
-	Rast_get_c_row(in, c = cell, row);
-	col = ncols;
-	while (col-- > 0) {
-	    if (!Rast_is_c_null_value(c))
-		*c = table[*c];
-	    c++;
-	}
-	Rast_put_row(out, cell, CELL_TYPE);
+
+	l.blk->nrows = nrows - row < nblock ? nrows - row : nblock;
+	read_block(fd, l.blk, row);
+
+	l.blk->chunk = (l.blk->nrows + nprocs - 1) / nprocs;
+	G_parallel_for(0, l.blk->nrows, l.blk->chunk, renumber_rows, &l);
+
+	for (j = 0; j < l.blk->nrows; j++)
+	    Rast_put_row(out, l.blk->cell[j][0], CELL_TYPE);
     }
-    G_percent(row, nrows, 10);
-    G_free(cell);
+    G_percent(nrows, nrows, 5);
+
+    free_block(l.blk, nblock);
+    Rast_free_cell_table(&t);
 
     return 0;
 }
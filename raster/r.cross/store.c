@@ -16,26 +16,68 @@
  *
  ***************************************************************************/
 
+#include <stdlib.h>
+#include <string.h>
 #include "glob.h"
+#include "local_proto.h"
 
+/* Each thread collects the combinations of its rows in its own table.
+ * The tables are merged by sorting their keys, the position of a
+ * combination in the sorted list is its category in the result. */
 
-int store_reclass(CELL result, int primary, CELL * cat)
+static int compare(const void *aa, const void *bb)
 {
+    const CELL *a = aa;
+    const CELL *b = bb;
     int i;
-    CELL *rcats;
-
-    reclass = (RECLASS *) G_realloc(reclass, (result + 1) * sizeof(RECLASS));
-    reclass[result].result = result;
-    reclass[result].cat = rcats = (CELL *) G_malloc(nfiles * sizeof(CELL));
-
-    /*
-     * the primary file may not have been the first on the command line
-     * enforce the results in the order that the files were specified
-     */
-    for (i = 0; i < primary; i++)
-	rcats[i] = cat[i + 1];
-    rcats[i] = cat[0];
-    for (i = primary + 1; i < nfiles; i++)
-	rcats[i] = cat[i];
-    return (0);
+
+    for (i = 0; i < nfiles; i++) {
+	if (a[i] > b[i])
+	    return 1;
+	if (a[i] < b[i])
+	    return -1;
+    }
+
+    return 0;
+}
+
+/* merge the combinations of the tables into combos, sorted by the
+ * categories of the maps in the order they were specified; the tables
+ * are freed */
+CELL sort_tables(struct Cell_table *tables, int ntables)
+{
+    size_t n = 0, i;
+    CELL ncombos;
+    int k;
+
+    for (k = 0; k < ntables; k++)
+	n += tables[k].used;
+
+    combos = G_malloc((n > 0 ? n : 1) * nfiles * sizeof(CELL));
+    for (k = 0, n = 0; k < ntables; k++) {
+	const CELL *key;
+	void *value;
+	size_t slot = 0;
+
+	while (Rast_next_cell_table_entry(&tables[k], &slot, &key, &value)) {
+	    memcpy(&combos[n * nfiles], key, nfiles * sizeof(CELL));
+	    n++;
+	}
+	Rast_free_cell_table(&tables[k]);
+    }
+
+    qsort(combos, n, nfiles * sizeof(CELL), compare);
+
+    /* the same combination may be found by several threads */
+    for (i = 0, ncombos = 0; i < n; i++) {
+	if (ncombos > 0 &&
+	    compare(&combos[(ncombos - 1) * nfiles], &combos[i * nfiles]) == 0)
+	    continue;
+	if ((size_t)ncombos != i)
+	    memcpy(&combos[ncombos * nfiles], &combos[i * nfiles],
+		   nfiles * sizeof(CELL));
+	ncombos++;
+    }
+
+    return ncombos;
 }
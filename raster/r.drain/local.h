@@ -3,8 +3,23 @@ struct metrics
     double ew_res, ns_res, diag_res;
 };
 
+/* cells of a drainage path in downstream order, also used for the list
+ * of start cells */
+struct drain_path
+{
+    int n, alloc;
+    int *row, *col;
+    int looped;			/* stopped in a circle of directions */
+};
+
 void filldir(int, int, int, struct band3 *, struct metrics *);
 void resolve(int, int, struct band3 *);
 int dopolys(int, int, int, int);
 void wtrshed(int, int, int, int, int);
 void ppupdate(int, int, int, int, struct band3 *, struct band3 *);
+
+/* trace.c */
+unsigned char *load_drain_steps(int, int, int);
+unsigned char *load_cost_steps(const char *, int, int);
+void trace_paths(const unsigned char *, int, int, const struct drain_path *,
+		 struct drain_path *);
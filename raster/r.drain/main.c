@@ -49,58 +49,94 @@
 #include "tinf.h"
 #include "local.h"
 
-/* should probably be updated to a pointer array & malloc/realloc as needed */
-#define POINTS_INCREMENT 1024
+static void add_start(struct drain_path *starts, int row, int col)
+{
+    if (starts->n == starts->alloc) {
+	starts->alloc = starts->alloc ? 2 * starts->alloc : 1024;
+	starts->row = G_realloc(starts->row, starts->alloc * sizeof(int));
+	starts->col = G_realloc(starts->col, starts->alloc * sizeof(int));
+    }
+    starts->row[starts->n] = row;
+    starts->col[starts->n] = col;
+    starts->n++;
+}
 
-/* define a data structure to hold the point data */
-struct point
+/* read start points from a file of east north pairs, "-" for stdin */
+static int read_start_file(const char *name, struct drain_path *starts,
+			   struct Cell_head *window)
 {
-    int row;
-    int col;
-    struct point *next;
-    double value;
-};
+    FILE *fp;
+    char buf[1024], ebuf[256], nbuf[256];
+    double east, north;
+    int line, row, col, n = 0;
+    char *p;
+
+    if (strcmp(name, "-") == 0)
+	fp = stdin;
+    else if (NULL == (fp = fopen(name, "r")))
+	G_fatal_error(_("Unable to open file <%s>"), name);
+
+    for (line = 1; G_getl2(buf, sizeof(buf), fp); line++) {
+	for (p = buf; *p; p++)
+	    if (*p == ',' || *p == '|' || *p == ';')
+		*p = ' ';
+	G_strip(buf);
+	if (*buf == '\0' || *buf == '#')
+	    continue;
+	if (sscanf(buf, "%255s %255s", ebuf, nbuf) != 2 ||
+	    !G_scan_easting(ebuf, &east, G_projection()) ||
+	    !G_scan_northing(nbuf, &north, G_projection()))
+	    G_fatal_error(_("Invalid coordinates in line %d of <%s>: %s"),
+			  line, name, buf);
+
+	col = (int)Rast_easting_to_col(east, window);
+	row = (int)Rast_northing_to_row(north, window);
+	if (row < 0 || row >= window->rows || col < 0 || col >= window->cols)
+	    continue;
+	add_start(starts, row, col);
+	n++;
+    }
+
+    if (fp != stdin)
+	fclose(fp);
+
+    return n;
+}
 
 int main(int argc, char **argv)
 {
 
-    int fe, fd, dir_fd;
-    int i, have_points = 0;
+    int fe, fd;
+    int i, j, k;
     int new_id;
     int nrows, ncols;
-    int *points_row = NULL, *points_col = NULL, npoints;
-    int increment_count;
-    int cell_open(), cell_open_new();
-    int map_id, dir_id;
     char map_name[GNAME_MAX], new_map_name[GNAME_MAX], dir_name[GNAME_MAX];
-    char *tempfile1, *tempfile2, *tempfile3;
+    char *tempfile1, *tempfile2;
     struct History history;
 
     struct Cell_head window;
-    struct Option *opt1, *opt2, *coordopt, *vpointopt, *opt3, *opt4;
+    struct Option *opt1, *opt2, *coordopt, *vpointopt, *fileopt, *opt3,
+	*opt4, *nprocs_opt;
     struct Flag *flag1, *flag2, *flag3, *flag4;
     struct GModule *module;
-    int in_type;
+    int in_type, out_type;
     void *in_buf;
-    void *dir_buf;
-    CELL *out_buf;
+    void *out_buf;
     struct band3 bnd, bndC;
     struct metrics *m = NULL;
 
-    struct point *list;
-    struct point *thispoint;
-    int ival, start_row, start_col, mode;
-    off_t bsz;
+    struct drain_path starts, *paths;
+    unsigned char *step;
+    size_t ncells, *row_start, *by_row, *first;
+    int *path_col;
+    double *value, val;
+    int map_id, start_row, start_col, mode, nlooped;
     int costmode = 0;
-    double east, north, val;
-    struct point *drain(int, struct point *, int, int);
-    struct point *drain_cost(int, struct point *, int, int);
-    int bsort(int, struct point *);
+    double east, north;
 
     struct line_pnts *Points;
     struct line_cats *Cats;
     struct Map_info vout;
-    int cat;
     double x, y;
 
     G_gisinit(argv[0]);
@@ -146,6 +182,16 @@ int main(int argc, char **argv)
     vpointopt->description = NULL;
     vpointopt->guisection = _("Start");
 
+    fileopt = G_define_standard_option(G_OPT_F_INPUT);
+    fileopt->key = "start_file";
+    fileopt->required = NO;
+    fileopt->label =
+	_("Name of input file with coordinates of starting points (E N)");
+    fileopt->description = _("\"-\" reads from stdin");
+    fileopt->guisection = _("Start");
+
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag1 = G_define_flag();
     flag1->key = 'c';
     flag1->description = _("Copy input cell values on output");
@@ -170,6 +216,7 @@ int main(int argc, char **argv)
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
 
     strcpy(map_name, opt1->answer);
     strcpy(new_map_name, opt2->answer);
@@ -225,13 +272,9 @@ int main(int argc, char **argv)
     nrows = Rast_window_rows();
     ncols = Rast_window_cols();
 
-    /* calculate true cell resolution */
-    m = (struct metrics *)G_malloc(nrows * sizeof(struct metrics));    
-    points_row = (int*)G_calloc(POINTS_INCREMENT, sizeof(int));
-    points_col = (int*)G_calloc(POINTS_INCREMENT, sizeof(int));
-    
-    increment_count = 1;
-    npoints = 0;
+    starts.n = starts.alloc = 0;
+    starts.row = starts.col = NULL;
+
     if (coordopt->answer) {
 	for (i = 0; coordopt->answers[i] != NULL; i += 2) {
 	    G_scan_easting(coordopt->answers[i], &east, G_projection());
@@ -239,29 +282,20 @@ int main(int argc, char **argv)
 	    start_col = (int)Rast_easting_to_col(east, &window);
 	    start_row = (int)Rast_northing_to_row(north, &window);
 
-	    if (start_row < 0 || start_row > nrows ||
-		start_col < 0 || start_col > ncols) {
+	    if (start_row < 0 || start_row >= nrows ||
+		start_col < 0 || start_col >= ncols) {
 		G_warning(_("Starting point %d is outside the current region"),
-			  i + 1);
+			  i / 2 + 1);
 		continue;
 	    }
-	    points_row[npoints] = start_row;
-	    points_col[npoints] = start_col;
-	    npoints++;
-	    if (npoints == POINTS_INCREMENT * increment_count)
-	    {
-		increment_count++;
-		points_row = (int*)G_realloc(points_row, POINTS_INCREMENT * increment_count * sizeof(int));
-		points_col = (int*)G_realloc(points_col, POINTS_INCREMENT * increment_count * sizeof(int));
-	    }
-	    have_points = 1;
+	    add_start(&starts, start_row, start_col);
 	}
     }
     if (vpointopt->answers) {
 	for (i = 0; vpointopt->answers[i] != NULL; i++) {
 	    struct Map_info In;
 	    struct bound_box box;
-	    int type;
+	    int type, n = 0;
 
 	    Points = Vect_new_line_struct();
 	    Cats = Vect_new_cats_struct();
@@ -296,26 +330,17 @@ int main(int argc, char **argv)
 		start_col = (int)Rast_easting_to_col(Points->x[0], &window);
 		start_row = (int)Rast_northing_to_row(Points->y[0], &window);
 
-		/* effectively just a duplicate check to G_site_in_region() ??? */
-		if (start_row < 0 || start_row > nrows || start_col < 0 ||
-		    start_col > ncols)
+		/* points on the north and east edges of the box */
+		if (start_row < 0 || start_row >= nrows || start_col < 0 ||
+		    start_col >= ncols)
 		    continue;
 
-		points_row[npoints] = start_row;
-		points_col[npoints] = start_col;
-		npoints++;
-		if (npoints == POINTS_INCREMENT * increment_count)
-		{
-		    increment_count++;
-		    points_row = (int*)G_realloc(points_row, POINTS_INCREMENT * increment_count * sizeof(int));
-		    points_col = (int*)G_realloc(points_col, POINTS_INCREMENT * increment_count * sizeof(int));
-		}
-		have_points = 1;
+		add_start(&starts, start_row, start_col);
+		n++;
 	    }
 	    Vect_close(&In);
 
-	    /* only catches maps out of range until something is found, not after */
-	    if (!have_points) {
+	    if (n == 0) {
 		G_warning(_("Starting vector map <%s> contains no points in the current region"),
 			  vpointopt->answers[i]);
 	    }
@@ -323,82 +348,70 @@ int main(int argc, char **argv)
 	    Vect_destroy_cats_struct(Cats);
 	}
     }
-    if (have_points == 0)
+    if (fileopt->answer) {
+	if (read_start_file(fileopt->answer, &starts, &window) == 0)
+	    G_warning(_("File <%s> contains no points in the current region"),
+		      fileopt->answer);
+    }
+    if (starts.n == 0)
 	G_fatal_error(_("No start/stop point(s) specified"));
 
-    /* determine the drainage paths */
-
-    /* allocate storage for the first point */
-    thispoint = (struct point *)G_malloc(sizeof(struct point));
-    list = thispoint;
-    thispoint->next = NULL;
-
-    G_begin_distance_calculations();
-    {
-	double e1, n1, e2, n2;
-
-	e1 = window.east;
-	n1 = window.north;
-	e2 = e1 + window.ew_res;
-	n2 = n1 - window.ns_res;
-	for (i = 0; i < nrows; i++) {
-	    m[i].ew_res = G_distance(e1, n1, e2, n1);
-	    m[i].ns_res = G_distance(e1, n1, e1, n2);
-	    m[i].diag_res = G_distance(e1, n1, e2, n2);
+    /* the flow directions, once for all paths */
+    if (costmode == 1) {
+	G_message(_("Reading movement directions..."));
+	step = load_cost_steps(dir_name, nrows, ncols);
+    }
+    else {
+	/* calculate true cell resolution */
+	m = (struct metrics *)G_malloc(nrows * sizeof(struct metrics));
+	G_begin_distance_calculations();
+	{
+	    double e1, n1, e2, n2;
+
+	    e1 = window.east;
+	    n1 = window.north;
 	    e2 = e1 + window.ew_res;
 	    n2 = n1 - window.ns_res;
+	    for (i = 0; i < nrows; i++) {
+		m[i].ew_res = G_distance(e1, n1, e2, n1);
+		m[i].ns_res = G_distance(e1, n1, e1, n2);
+		m[i].diag_res = G_distance(e1, n1, e2, n2);
+		e2 = e1 + window.ew_res;
+		n2 = n1 - window.ns_res;
+	    }
 	}
-    }
-
-    /* buffers for internal use */
-    bndC.ns = ncols;
-    bndC.sz = sizeof(CELL) * ncols;
-    bndC.b[0] = G_calloc(ncols, sizeof(CELL));
-    bndC.b[1] = G_calloc(ncols, sizeof(CELL));
-    bndC.b[2] = G_calloc(ncols, sizeof(CELL));
 
-    /* buffers for external use */
-    bnd.ns = ncols;
-    bnd.sz = ncols * bpe();
-    bnd.b[0] = G_calloc(ncols, bpe());
-    bnd.b[1] = G_calloc(ncols, bpe());
-    bnd.b[2] = G_calloc(ncols, bpe());
+	/* buffers for internal use */
+	bndC.ns = ncols;
+	bndC.sz = sizeof(CELL) * ncols;
+	bndC.b[0] = G_calloc(ncols, sizeof(CELL));
+	bndC.b[1] = G_calloc(ncols, sizeof(CELL));
+	bndC.b[2] = G_calloc(ncols, sizeof(CELL));
 
-    /* an input buffer */
-    in_buf = get_buf();
+	/* buffers for external use */
+	bnd.ns = ncols;
+	bnd.sz = ncols * bpe();
+	bnd.b[0] = G_calloc(ncols, bpe());
+	bnd.b[1] = G_calloc(ncols, bpe());
+	bnd.b[2] = G_calloc(ncols, bpe());
 
-    /* open the original map and get its file id  */
-    map_id = Rast_open_old(map_name, "");
+	in_buf = get_buf();
 
-    /* get some temp files */
-    tempfile1 = G_tempfile();
-    tempfile2 = G_tempfile();
+	/* get some temp files */
+	tempfile1 = G_tempfile();
+	tempfile2 = G_tempfile();
 
-    fe = open(tempfile1, O_RDWR | O_CREAT, 0666);
-    fd = open(tempfile2, O_RDWR | O_CREAT, 0666);
-
-    /* transfer the input map to a temp file */
-    for (i = 0; i < nrows; i++) {
-	get_row(map_id, in_buf, i);
-	write(fe, in_buf, bnd.sz);
-    }
-    Rast_close(map_id);
-
-    if (costmode == 1) {
-	dir_buf = Rast_allocate_d_buf();
-	dir_id = Rast_open_old(dir_name, "");
-	tempfile3 = G_tempfile();
-	dir_fd = open(tempfile3, O_RDWR | O_CREAT, 0666);
+	fe = open(tempfile1, O_RDWR | O_CREAT, 0666);
+	fd = open(tempfile2, O_RDWR | O_CREAT, 0666);
 
+	/* transfer the input map to a temp file */
+	map_id = Rast_open_old(map_name, "");
 	for (i = 0; i < nrows; i++) {
-	    Rast_get_d_row(dir_id, dir_buf, i);
-	    write(dir_fd, dir_buf, ncols * sizeof(DCELL));
+	    get_row(map_id, in_buf, i);
+	    write(fe, in_buf, bnd.sz);
 	}
-	Rast_close(dir_id);
-    }
+	Rast_close(map_id);
 
-    /* only necessary for non-dir drain */
-    if (costmode == 0) {
 	G_message(_("Calculating flow directions..."));
 
 	/* fill one-cell pits and take a first stab at flow directions */
@@ -406,167 +419,162 @@ int main(int argc, char **argv)
 
 	/* determine flow directions for more ambiguous cases */
 	resolve(fd, nrows, &bndC);
-    }
 
-    /* free the buffers already used */
-    G_free(bndC.b[0]);
-    G_free(bndC.b[1]);
-    G_free(bndC.b[2]);
+	step = load_drain_steps(fd, nrows, ncols);
 
-    G_free(bnd.b[0]);
-    G_free(bnd.b[1]);
-    G_free(bnd.b[2]);
+	close(fe);
+	close(fd);
+	unlink(tempfile1);
+	unlink(tempfile2);
 
-    /* determine the drainage paths */
+	G_free(bndC.b[0]);
+	G_free(bndC.b[1]);
+	G_free(bndC.b[2]);
 
-    /* repeat for each starting point */
-    for (i = 0; i < npoints; i++) {
-	/* use the flow directions to determine the drainage path
-	 * results are compiled as a linked list of points in downstream order */
-	thispoint->row = points_row[i];
-	thispoint->col = points_col[i];
-	thispoint->next = NULL;
-	/* drain algorithm selection (dir or non-dir) */
-	if (costmode == 0) {
-	    thispoint = drain(fd, thispoint, nrows, ncols);
-	}
-	if (costmode == 1) {
-	    thispoint = drain_cost(dir_fd, thispoint, nrows, ncols);
-	}
+	G_free(bnd.b[0]);
+	G_free(bnd.b[1]);
+	G_free(bnd.b[2]);
+
+	G_free(in_buf);
+	G_free(m);
     }
 
-    /* do the output */
+    /* determine the drainage paths */
+    G_message(n_("Tracing %d drainage path...",
+		 "Tracing %d drainage paths...", starts.n), starts.n);
+    paths = G_calloc(starts.n, sizeof(struct drain_path));
+    trace_paths(step, nrows, ncols, &starts, paths);
+    G_free(step);
+
+    nlooped = 0;
+    for (i = 0; i < starts.n; i++)
+	nlooped += paths[i].looped;
+    if (nlooped > 0)
+	G_warning(n_("%d path ran into a circle of directions",
+		     "%d paths ran into a circle of directions", nlooped),
+		  nlooped);
+
+    /* the cells of all paths in path order, value[first[i] + j] is the
+     * value of the j-th cell of path i */
+    first = G_malloc((starts.n + 1) * sizeof(size_t));
+    ncells = 0;
+    for (i = 0; i < starts.n; i++) {
+	first[i] = ncells;
+	ncells += paths[i].n;
+    }
+    first[starts.n] = ncells;
+    value = G_malloc(ncells * sizeof(double));
+    path_col = G_malloc(ncells * sizeof(int));
+    for (i = 0; i < starts.n; i++)
+	memcpy(&path_col[first[i]], paths[i].col, paths[i].n * sizeof(int));
+
+    /* cells by row, in path order within a row so that later paths
+     * overwrite earlier ones */
+    row_start = G_calloc(nrows + 1, sizeof(size_t));
+    for (i = 0; i < starts.n; i++)
+	for (j = 0; j < paths[i].n; j++)
+	    row_start[paths[i].row[j] + 1]++;
+    for (i = 0; i < nrows; i++)
+	row_start[i + 1] += row_start[i];
+    by_row = G_malloc(ncells * sizeof(size_t));
+    {
+	size_t *next = G_malloc(nrows * sizeof(size_t));
 
-    if (mode == 0 || mode == 3) {
+	memcpy(next, row_start, nrows * sizeof(size_t));
+	for (i = 0; i < starts.n; i++)
+	    for (j = 0; j < paths[i].n; j++)
+		by_row[next[paths[i].row[j]]++] = first[i] + j;
+	G_free(next);
+    }
 
-	/* Output will be a cell map */
-	/* open a new file and allocate an output buffer */
-	new_id = Rast_open_c_new(new_map_name);
-	out_buf = Rast_allocate_c_buf();
+    /* values along the paths */
+    if (mode == 0 || mode == 3) {
+	for (i = 0; i < starts.n; i++)
+	    for (j = 0; j < paths[i].n; j++)
+		/* mode 3 numbers each cell downstream */
+		value[first[i] + j] = mode == 3 ? j + 1 : 1;
+    }
+    else {
+	/* read the rows holding path cells once */
+	in_buf = get_buf();
+	map_id = Rast_open_old(map_name, "");
+	for (i = 0; i < nrows; i++) {
+	    size_t c;
 
-	/* mark each cell */
-	thispoint = list;
-	while (thispoint->next != NULL) {
-	    thispoint->value = 1;
-	    thispoint = thispoint->next;
+	    if (row_start[i] == row_start[i + 1])
+		continue;
+	    get_row(map_id, in_buf, i);
+	    for (c = row_start[i]; c < row_start[i + 1]; c++)
+		memcpy(&value[by_row[c]],
+		       (char *)in_buf + bpe() * path_col[by_row[c]], bpe());
 	}
+	Rast_close(map_id);
+	G_free(in_buf);
 
-	if (mode == 3) {
-	    /* number each cell downstream */
-	    thispoint = list;
-	    ival = 0;
-	    while (thispoint->next != NULL) {
-		if (thispoint->row == INT_MAX) {
-		    ival = 0;
-		    thispoint = thispoint->next;
-		    continue;
+	if (mode == 2) {
+	    /* accumulate the input map values downstream */
+	    for (i = 0; i < starts.n; i++) {
+		val = 0.;
+		for (j = 0; j < paths[i].n; j++) {
+		    sum(&value[first[i] + j], &val);
+		    memcpy(&val, &value[first[i] + j], bpe());
 		}
-		thispoint->value += ival;
-		ival = thispoint->value;
-		thispoint = thispoint->next;
 	    }
 	}
+    }
 
-	/* build the output map */
+    /* build the output map */
+    if (mode == 0 || mode == 3) {
+	/* Output will be a cell map */
+	out_type = CELL_TYPE;
+	new_id = Rast_open_c_new(new_map_name);
 	G_message(_("Writing output raster map..."));
-	for (i = 0; i < nrows; i++) {
-	    G_percent(i, nrows, 2);
-	    Rast_set_c_null_value(out_buf, ncols);
-	    thispoint = list;
-	    while (thispoint->next != NULL) {
-		if (thispoint->row == i)
-		    out_buf[thispoint->col] = (int)thispoint->value;
-		thispoint = thispoint->next;
-	    }
-	    Rast_put_c_row(new_id, out_buf);
-	}
-	G_percent(1, 1, 1);
     }
-    else {			/* mode = 1 or 2 */
+    else {
 	/* Output will be of the same type as input */
-	/* open a new file and allocate an output buffer */
+	out_type = in_type;
 	new_id = Rast_open_new(new_map_name, in_type);
-	out_buf = get_buf();
-	bsz = ncols * bpe();
-
-	/* loop through each point in the list and store the map values */
-	thispoint = list;
-	while (thispoint->next != NULL) {
-	    if (thispoint->row == INT_MAX) {
-		thispoint = thispoint->next;
-		continue;
-	    }
-	    lseek(fe, (off_t) thispoint->row * bsz, SEEK_SET);
-	    read(fe, in_buf, bsz);
-	    memcpy(&thispoint->value, (char *)in_buf + bpe() * thispoint->col,
-		   bpe());
-	    thispoint = thispoint->next;
-	}
-
-	if (mode == 2) {
-	    /* accumulate the input map values downstream */
-	    thispoint = list;
-	    val = 0.;
-	    while (thispoint->next != NULL) {
-		if (thispoint->row == INT_MAX) {
-		    val = 0.;
-		    thispoint = thispoint->next;
-		    continue;
-		}
-		sum(&thispoint->value, &val);
-		memcpy(&val, &thispoint->value, bpe());
-		thispoint = thispoint->next;
-	    }
-	}
-
-	/* build the output map */
-	G_message(_("Writing raster map <%s>..."),
-		  new_map_name);
-	for (i = 0; i < nrows; i++) {
-	    G_percent(i, nrows, 2);
-	    set_null_value(out_buf, ncols);
-	    thispoint = list;
-	    while (thispoint->next != NULL) {
-		if (thispoint->row == i)
-		    memcpy((char *)out_buf + bpe() * thispoint->col,
-			   &(thispoint->value), bpe());
-		thispoint = thispoint->next;
-	    }
-	    put_row(new_id, out_buf);
+	G_message(_("Writing raster map <%s>..."), new_map_name);
+    }
+    out_buf = Rast_allocate_buf(out_type);
+    for (i = 0; i < nrows; i++) {
+	size_t c;
+
+	G_percent(i, nrows, 2);
+	Rast_set_null_value(out_buf, ncols, out_type);
+	for (c = row_start[i]; c < row_start[i + 1]; c++) {
+	    size_t cell = by_row[c];
+
+	    k = path_col[cell];
+	    if (mode == 0 || mode == 3)
+		((CELL *) out_buf)[k] = (CELL) value[cell];
+	    else
+		memcpy((char *)out_buf + bpe() * k, &value[cell], bpe());
 	}
-	G_percent(1, 1, 1);
+	Rast_put_row(new_id, out_buf, out_type);
     }
+    G_percent(1, 1, 1);
 
-    /* Output a vector path */
+    /* Output the vector paths, one line per start point */
     if (opt4->answer) {
+	G_message(_("Writing vector map <%s>..."), opt4->answer);
 	Points = Vect_new_line_struct();
 	Cats = Vect_new_cats_struct();
-	/* Need to modify for multiple paths */
-	thispoint = list;
-	i = 1;
-	while (thispoint->next != NULL) {
-	    if (thispoint->row == INT_MAX) {
-		thispoint = thispoint->next;
-		Vect_cat_set(Cats, 1, i);
-		Vect_write_line(&vout, GV_LINE, Points, Cats);
-		Vect_reset_line(Points);
-		Vect_reset_cats(Cats);
-		i++;
-		continue;
+	for (i = 0; i < starts.n; i++) {
+	    Vect_reset_line(Points);
+	    Vect_reset_cats(Cats);
+	    for (j = 0; j < paths[i].n; j++) {
+		x = window.west + ((double)paths[i].col[j] + 0.5) *
+		    window.ew_res;
+		y = window.north - ((double)paths[i].row[j] + 0.5) *
+		    window.ns_res;
+		Vect_append_point(Points, x, y, 0.0);
 	    }
-	    if (Vect_cat_get(Cats, 1, &cat) == 0) {
-		Vect_cat_set(Cats, 1, i);
-	    }
-	    /* Need to convert row and col to coordinates 
-	     *      y = cell_head.north - ((double) p->row + 0.5) * cell_head.ns_res;
-	     *  x = cell_head.west + ((double) p->col + 0.5) * cell_head.ew_res;
-	     */
-
-	    x = window.west + ((double)thispoint->col + 0.5) * window.ew_res;
-	    y = window.north - ((double)thispoint->row + 0.5) * window.ns_res;
-	    Vect_append_point(Points, x, y, 0.0);
-	    thispoint = thispoint->next;
-	}			/* End while */
+	    Vect_cat_set(Cats, 1, i + 1);
+	    Vect_write_line(&vout, GV_LINE, Points, Cats);
+	}
+	Vect_destroy_line_struct(Points);
+	Vect_destroy_cats_struct(Cats);
 	Vect_build(&vout);
 	Vect_close(&vout);
     }
@@ -580,213 +588,19 @@ int main(int argc, char **argv)
     Rast_command_history(&history);
     Rast_write_history(new_map_name, &history);
 
-    close(fe);
-    close(fd);
-
-    unlink(tempfile1);
-    unlink(tempfile2);
-    G_free(in_buf);
     G_free(out_buf);
-    if(points_row)
-	G_free(points_row);
-    if(points_col)
-	G_free(points_col);
-
-    if (costmode == 1) {
-	close(dir_fd);
-	unlink(tempfile3);
-	G_free(dir_buf);
+    for (i = 0; i < starts.n; i++) {
+	G_free(paths[i].row);
+	G_free(paths[i].col);
     }
-    
-    exit(EXIT_SUCCESS);
-}
-
-struct point *drain(int fd, struct point *list, int nrow, int ncol)
-{
-    int go = 1, next_row, next_col;
-    CELL direction;
-    CELL *dir;
-
-    dir = Rast_allocate_c_buf();
-    next_row = list->row;
-    next_col = list->col;
-
-    /* begin loop */
-    while (go) {
-
-	/* find flow direction at this point */
-	lseek(fd, (off_t) list->row * ncol * sizeof(CELL), SEEK_SET);
-	read(fd, dir, ncol * sizeof(CELL));
-	direction = *(dir + list->col);
-	go = 0;
-
-	/* identify next downstream cell */
-	if (direction > 0 && direction < 256) {
-
-	    if (direction == 1 || direction == 2 || direction == 4)
-		next_col += 1;
-	    else if (direction == 16 || direction == 32 || direction == 64)
-		next_col -= 1;
-
-	    if (direction == 64 || direction == 128 || direction == 1)
-		next_row -= 1;
-	    else if (direction == 4 || direction == 8 || direction == 16)
-		next_row += 1;
-
-	    if (next_col >= 0 && next_col < ncol
-		&& next_row >= 0 && next_row < nrow) {
-		/* allocate and fill the next point structure */
-		list->next = (struct point *)G_malloc(sizeof(struct point));
-		list = list->next;
-		list->row = next_row;
-		list->col = next_col;
-		go = 1;
-	    }
-	}
-    }				/* end while */
-
-    /* allocate and fill the end-of-path flag */
-    list->next = (struct point *)G_malloc(sizeof(struct point));
-    list = list->next;
-    list->row = INT_MAX;
+    G_free(paths);
+    G_free(starts.row);
+    G_free(starts.col);
+    G_free(first);
+    G_free(value);
+    G_free(path_col);
+    G_free(row_start);
+    G_free(by_row);
 
-    /* return a pointer to an empty structure */
-    list->next = (struct point *)G_malloc(sizeof(struct point));
-    list = list->next;
-    list->next = NULL;
-
-    G_free(dir);
-
-    return list;
-}
-
-struct point *drain_cost(int dir_fd, struct point *list, int nrow, int ncol)
-{
-    /*
-     * The idea is that each cell of the direction surface has a value representing
-     * the direction towards the next cell in the path. The direction is read from 
-     * the input raster, and a simple case/switch is used to determine which cell to
-     * read next. This is repeated via a while loop until a null direction is found.
-     */
-
-    int neighbour, next_row, next_col, go = 1;
-    DCELL direction;
-    DCELL *dir_buf;
-
-    dir_buf = Rast_allocate_d_buf();
-
-    next_row = list->row;
-    next_col = list->col;
-
-    while (go) {
-	go = 0;
-	/* Directional algorithm
-	 * 1) read cell direction               
-	 * 2) shift to cell in that direction           
-	 */
-	/* find the direction recorded at row,col */
-	lseek(dir_fd, (off_t) list->row * ncol * sizeof(DCELL), SEEK_SET);
-	read(dir_fd, dir_buf, ncol * sizeof(DCELL));
-	direction = *(dir_buf + list->col);
-	neighbour = direction * 10;
-	if (G_verbose() > 2)
-	    G_message(_("direction read: %lf, neighbour found: %i"),
-		      direction, neighbour);
-	switch (neighbour) {
-	case 225: /* ENE */
-	    next_row = list->row - 1;
-	    next_col = list->col + 2;
-	    break;
-	case 450: /* NE */
-	    next_row = list->row - 1;
-	    next_col = list->col + 1;
-	    break;
-	case 675: /* NNE */
-	    next_row = list->row - 2;
-	    next_col = list->col + 1;
-	    break;
-	case 900: /* N */
-	    next_row = list->row - 1;
-	    next_col = list->col;
-	    break;
-	case 1125: /* NNW */
-	    next_row = list->row - 2;
-	    next_col = list->col - 1;
-	    break;
-	case 1350: /* NW */
-	    next_col = list->col - 1;
-	    next_row = list->row - 1;
-	    break;
-	case 1575: /* WNW */
-	    next_col = list->col - 2;
-	    next_row = list->row - 1;
-	    break;
-	case 1800: /* W*/
-	    next_row = list->row;
-	    next_col = list->col - 1;
-	    break;
-	case 2025: /* WSW */
-	    next_row = list->row + 1;
-	    next_col = list->col - 2;
-	    break;
-	case 2250: /* SW */
-	    next_row = list->row + 1;
-	    next_col = list->col - 1;
-	    break;
-	case 2475: /* SSW */
-	    next_row = list->row + 2;
-	    next_col = list->col - 1;
-	    break;
-	case 2700: /* S */
-	    next_row = list->row + 1;
-	    next_col = list->col;
-	    break;
-	case 2925: /* SSE */
-	    next_row = list->row + 2;
-	    next_col = list->col + 1;
-	    break;
-	case 3150: /* SE */
-	    next_row = list->row + 1;
-	    next_col = list->col + 1;
-	    break;
-	case 3375: /* ESE */
-	    next_row = list->row + 1;
-	    next_col = list->col + 2;
-	    break;
-	case 3600: /* E */
-	    next_row = list->row;
-	    next_col = list->col + 1;
-	    break;
-	    /* default:
-	       break;
-	       Should probably add something here for the possibility of a non-direction map
-	       G_fatal_error(_("Invalid direction given (possibly not a direction map)")); */
-	}			/* end switch/case */
-
-	if (next_col >= 0 && next_col < ncol && next_row >= 0 &&
-	    next_row < nrow) {
-	    list->next = (struct point *)G_malloc(sizeof(struct point));
-	    list = list->next;
-	    list->row = next_row;
-	    list->col = next_col;
-	    next_row = -1;
-	    next_col = -1;
-	    go = 1;
-	}
-
-    }				/* end while */
-
-    /* allocate and fill the end-of-path flag */
-    list->next = (struct point *)G_malloc(sizeof(struct point));
-    list = list->next;
-    list->row = INT_MAX;
-
-    /* return a pointer to an empty structure */
-    list->next = (struct point *)G_malloc(sizeof(struct point));
-    list = list->next;
-    list->next = NULL;
-
-    G_free(dir_buf);
-
-    return list;
+    exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,206 @@
+#include <grass/config.h>
+#include <unistd.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+#include "tinf.h"
+#include "local.h"
+
+/* The flow directions are kept in memory as one step code per cell:
+ * 0 ends the path, 1 - 8 are the moves to the eight neighbours and
+ * 9 - 16 the knight's moves of cost surface directions. */
+
+static const int step_row[17] = {
+    0,
+    -1, 0, 1, 1, 1, 0, -1, -1,	/* NE E SE S SW W NW N */
+    -1, -2, -2, -1, 1, 2, 2, 1	/* ENE NNE NNW WNW WSW SSW SSE ESE */
+};
+
+static const int step_col[17] = {
+    0,
+    1, 1, 1, 0, -1, -1, -1, 0,
+    2, 1, -1, -2, -2, -1, 1, 2
+};
+
+/* step code of a resolved flow direction of filldir() and resolve() */
+static unsigned char drain_step(CELL direction)
+{
+    switch (direction) {
+    case 1:
+	return 1;
+    case 2:
+	return 2;
+    case 4:
+	return 3;
+    case 8:
+	return 4;
+    case 16:
+	return 5;
+    case 32:
+	return 6;
+    case 64:
+	return 7;
+    case 128:
+	return 8;
+    default:			/* pits, flats and nulls */
+	return 0;
+    }
+}
+
+/* step code of a movement direction in degrees CCW from east */
+static unsigned char cost_step(DCELL direction)
+{
+    if (Rast_is_d_null_value(&direction))
+	return 0;
+
+    switch ((int)(direction * 10)) {
+    case 225:			/* ENE */
+	return 9;
+    case 450:			/* NE */
+	return 1;
+    case 675:			/* NNE */
+	return 10;
+    case 900:			/* N */
+	return 8;
+    case 1125:			/* NNW */
+	return 11;
+    case 1350:			/* NW */
+	return 7;
+    case 1575:			/* WNW */
+	return 12;
+    case 1800:			/* W */
+	return 6;
+    case 2025:			/* WSW */
+	return 13;
+    case 2250:			/* SW */
+	return 5;
+    case 2475:			/* SSW */
+	return 14;
+    case 2700:			/* S */
+	return 4;
+    case 2925:			/* SSE */
+	return 15;
+    case 3150:			/* SE */
+	return 3;
+    case 3375:			/* ESE */
+	return 16;
+    case 3600:			/* E */
+	return 2;
+    default:
+	return 0;
+    }
+}
+
+/* load the flow directions written by resolve() to fd */
+unsigned char *load_drain_steps(int fd, int nrows, int ncols)
+{
+    unsigned char *step;
+    CELL *dir;
+    int row, col;
+
+    step = G_malloc((size_t)nrows * ncols);
+    dir = G_malloc(ncols * sizeof(CELL));
+
+    lseek(fd, 0, SEEK_SET);
+    for (row = 0; row < nrows; row++) {
+	if (read(fd, dir, ncols * sizeof(CELL)) != ncols * sizeof(CELL))
+	    G_fatal_error(_("Unable to read flow directions"));
+	for (col = 0; col < ncols; col++)
+	    step[(size_t)row * ncols + col] = drain_step(dir[col]);
+    }
+
+    G_free(dir);
+
+    return step;
+}
+
+/* load a movement direction map of r.cost or r.walk */
+unsigned char *load_cost_steps(const char *name, int nrows, int ncols)
+{
+    unsigned char *step;
+    DCELL *dir;
+    int fd, row, col;
+
+    step = G_malloc((size_t)nrows * ncols);
+    dir = Rast_allocate_d_buf();
+
+    fd = Rast_open_old(name, "");
+    for (row = 0; row < nrows; row++) {
+	G_percent(row, nrows, 2);
+	Rast_get_d_row(fd, dir, row);
+	for (col = 0; col < ncols; col++)
+	    step[(size_t)row * ncols + col] = cost_step(dir[col]);
+    }
+    G_percent(1, 1, 1);
+    Rast_close(fd);
+
+    G_free(dir);
+
+    return step;
+}
+
+struct tracing
+{
+    const unsigned char *step;
+    int nrows, ncols;
+    const struct drain_path *starts;
+    struct drain_path *paths;
+};
+
+static void add_cell(struct drain_path *path, int row, int col)
+{
+    if (path->n == path->alloc) {
+	path->alloc = path->alloc ? 2 * path->alloc : 64;
+	path->row = G_realloc(path->row, path->alloc * sizeof(int));
+	path->col = G_realloc(path->col, path->alloc * sizeof(int));
+    }
+    path->row[path->n] = row;
+    path->col[path->n] = col;
+    path->n++;
+}
+
+static void trace(int first, int last, void *closure)
+{
+    struct tracing *t = closure;
+    size_t ncells = (size_t)t->nrows * t->ncols;
+    int i;
+
+    for (i = first; i < last; i++) {
+	struct drain_path *path = &t->paths[i];
+	int row = t->starts->row[i], col = t->starts->col[i];
+
+	add_cell(path, row, col);
+	while (1) {
+	    int code = t->step[(size_t)row * t->ncols + col];
+
+	    if (code == 0)
+		break;
+	    row += step_row[code];
+	    col += step_col[code];
+	    if (row < 0 || row >= t->nrows || col < 0 || col >= t->ncols)
+		break;
+	    if ((size_t)path->n > ncells) {
+		/* directions running in a circle */
+		path->looped = 1;
+		break;
+	    }
+	    add_cell(path, row, col);
+	}
+    }
+}
+
+/* trace the paths from all start cells on the worker threads,
+ * paths[i] is the path from the i-th start cell */
+void trace_paths(const unsigned char *step, int nrows, int ncols,
+		 const struct drain_path *starts, struct drain_path *paths)
+{
+    struct tracing t;
+
+    t.step = step;
+    t.nrows = nrows;
+    t.ncols = ncols;
+    t.starts = starts;
+    t.paths = paths;
+
+    G_parallel_for(0, starts->n, 16, trace, &t);
+}
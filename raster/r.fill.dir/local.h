@@ -3,3 +3,4 @@ void resolve(int, int, struct band3 *);
 int dopolys(int, int, int, int);
 void wtrshed(int, int, int, int, int);
 void ppupdate(int, int, int, int, struct band3 *, struct band3 *);
+void pflood(int, int, int, int, int, int, int, int);
@@ -72,8 +72,9 @@ int main(int argc, char **argv)
 
     struct Cell_head window;
     struct GModule *module;
-    struct Option *opt1, *opt2, *opt3, *opt4, *opt5;
-    struct Flag *flag1;
+    struct Option *opt1, *opt2, *opt3, *opt4, *opt5, *opt6;
+    struct Flag *flag1, *flag2;
+    int nprocs;
     int in_type;
     size_t bufsz;
     void *in_buf;
@@ -121,7 +122,17 @@ int main(int argc, char **argv)
     flag1 = G_define_flag();
     flag1->key = 'f';
     flag1->description = _("Find unresolved areas only");
-    
+
+    flag2 = G_define_flag();
+    flag2->key = 'p';
+    flag2->label = _("Fill all depressions in one pass with priority-flood");
+    flag2->description = _("Flat areas drain to the nearest outlet");
+
+    opt6 = G_define_standard_option(G_OPT_M_NPROCS);
+    opt6->description = _("Number of threads for parallel computing with -p flag");
+
+    G_option_exclusive(flag1, flag2, NULL);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
@@ -146,6 +157,8 @@ int main(int argc, char **argv)
     
     G_debug(1, "output type (1=AGNPS, 2=ANSWERS, 3=GRASS): %d", type);
 
+    nprocs = G_set_nprocs(opt6);
+
     if (type == 3)
 	G_verbose_message(_("Direction map is D8 resolution, i.e. 45 degrees"));
     
@@ -189,26 +202,32 @@ int main(int argc, char **argv)
     fd = open(tempfile2, O_RDWR | O_CREAT, 0666);	/* dirn */
     fm = open(tempfile3, O_RDWR | O_CREAT, 0666);	/* problems */
 
-    G_message(_("Reading input elevation raster map..."));
-    for (i = 0; i < nrows; i++) {
+    if (flag2->answer) {
+	/* fill all depressions and find the final directions */
+	pflood(map_id, in_type, fe, fd, fm, nrows, ncols, nprocs);
+	Rast_close(map_id);
+    }
+    else {
+	G_message(_("Reading input elevation raster map..."));
+	for (i = 0; i < nrows; i++) {
 	G_percent(i, nrows, 2);
 	get_row(map_id, in_buf, i);
 	write(fe, in_buf, bnd.sz);
-    }
-    G_percent(1, 1, 1);
-    Rast_close(map_id);
+	}
+	G_percent(1, 1, 1);
+	Rast_close(map_id);
 
-    /* fill single-cell holes and take a first stab at flow directions */
-    G_message(_("Filling sinks..."));
-    filldir(fe, fd, nrows, &bnd);
+	/* fill single-cell holes and take a first stab at flow directions */
+	G_message(_("Filling sinks..."));
+	filldir(fe, fd, nrows, &bnd);
 
-    /* determine flow directions for ambiguous cases */
-    G_message(_("Determining flow directions for ambiguous cases..."));
-    resolve(fd, nrows, &bndC);
+	/* determine flow directions for ambiguous cases */
+	G_message(_("Determining flow directions for ambiguous cases..."));
+	resolve(fd, nrows, &bndC);
 
-    /* mark and count the sinks in each internally drained basin */
-    nbasins = dopolys(fd, fm, nrows, ncols);
-    if (!flag1->answer) {
+	/* mark and count the sinks in each internally drained basin */
+	nbasins = dopolys(fd, fm, nrows, ncols);
+	if (!flag1->answer) {
 	/* determine the watershed for each sink */
 	wtrshed(fm, fd, nrows, ncols, 4);
 
@@ -220,6 +239,7 @@ int main(int argc, char **argv)
 	filldir(fe, fd, nrows, &bnd);
 	resolve(fd, nrows, &bndC);
 	nbasins = dopolys(fd, fm, nrows, ncols);
+	}
     }
 
     G_free(bndC.b[0]);
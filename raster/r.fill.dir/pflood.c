@@ -0,0 +1,610 @@
+/* priority-flood depression filling
+ *
+ * Barnes, R., Lehman, C., Mulla, D. 2014. Priority-flood: An optimal
+ * depression-filling and watershed-labeling algorithm for digital
+ * elevation models. Computers & Geosciences 62: 117-127.
+ *
+ * Barnes, R. 2016. Parallel priority-flood depression filling for
+ * trillion cell digital elevation models on desktops or clusters.
+ * Computers & Geosciences 96: 56-68.
+ *
+ * All cells at the edge of the map or next to NULL cells drain out of
+ * the map. Cells are taken from a min-heap ordered by elevation, cells
+ * not higher than the current cell are raised to it and taken from a
+ * plain queue first. With more than one thread, the map is split into
+ * strips of rows which are flooded independently, the edge rows of a
+ * strip draining out of the strip. Each cell of a strip is labelled
+ * with the edge cell it drains to, and the lowest spill elevations
+ * between labels give a graph which is flooded from the map edge to
+ * find the final water level of each label. */
+
+#include <stddef.h>
+#include <unistd.h>
+#include <float.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+#include "tinf.h"
+#include "local.h"
+
+#define OCEAN 1			/* label of cells draining out of the map */
+#define STRIPS_PER_THREAD 4
+
+#undef MAX
+#define MAX(a, b)	((a) > (b) ? (a) : (b))
+
+/* neighbors in the order of check() in filldir.c,
+ * the opposite of neighbor k is neighbor 7 - k */
+static const int nbr_row[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+static const int nbr_col[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+static const CELL nbr_dir[8] = { 64, 128, 1, 32, 2, 16, 8, 4 };
+static const double nbr_dist[8] = {
+    1.4142136, 1., 1.4142136, 1., 1., 1.4142136, 1., 1.4142136
+};
+
+struct heap_cell
+{
+    DCELL z;
+    size_t i;
+};
+
+struct heap
+{
+    struct heap_cell *c;
+    size_t n, nalloc;
+};
+
+struct queue
+{
+    size_t *i;
+    size_t head, tail, nalloc;
+};
+
+struct edge
+{
+    int a, b;
+    DCELL z;			/* spill elevation between labels a and b */
+};
+
+struct strip
+{
+    int first, last;		/* rows first to last - 1 */
+    int nlabels;
+    int offset;			/* global label = offset + label */
+    struct edge *edges;
+    size_t nedges, nalloc;
+};
+
+struct flood
+{
+    int nrows, ncols;
+    DCELL *z;
+    char *closed;
+    int *label;			/* NULL with only one strip */
+    DCELL *level;		/* water level of each label */
+    CELL *dir;
+    struct strip *strips;
+    int chunk;			/* rows per thread for directions */
+};
+
+static void heap_push(struct heap *h, DCELL z, size_t i)
+{
+    size_t k, p;
+
+    if (h->n == h->nalloc) {
+	h->nalloc = h->nalloc ? 2 * h->nalloc : 1024;
+	h->c = G_realloc(h->c, h->nalloc * sizeof(struct heap_cell));
+    }
+
+    /* sift up */
+    for (k = h->n++; k > 0; k = p) {
+	p = (k - 1) / 2;
+	if (h->c[p].z <= z)
+	    break;
+	h->c[k] = h->c[p];
+    }
+    h->c[k].z = z;
+    h->c[k].i = i;
+}
+
+static struct heap_cell heap_pop(struct heap *h)
+{
+    struct heap_cell top = h->c[0], last = h->c[--h->n];
+    size_t k, c;
+
+    /* sift down */
+    for (k = 0; (c = 2 * k + 1) < h->n; k = c) {
+	if (c + 1 < h->n && h->c[c + 1].z < h->c[c].z)
+	    c++;
+	if (last.z <= h->c[c].z)
+	    break;
+	h->c[k] = h->c[c];
+    }
+    h->c[k] = last;
+
+    return top;
+}
+
+static void queue_push(struct queue *q, size_t i)
+{
+    if (q->tail == q->nalloc) {
+	q->nalloc = q->nalloc ? 2 * q->nalloc : 1024;
+	q->i = G_realloc(q->i, q->nalloc * sizeof(size_t));
+    }
+    q->i[q->tail++] = i;
+}
+
+static size_t queue_pop(struct queue *q)
+{
+    size_t i = q->i[q->head++];
+
+    /* the queue is drained before the heap is used again */
+    if (q->head == q->tail)
+	q->head = q->tail = 0;
+
+    return i;
+}
+
+static void add_edge(struct strip *st, int a, int b, DCELL z)
+{
+    if (st->nedges == st->nalloc) {
+	st->nalloc = st->nalloc ? 2 * st->nalloc : 256;
+	st->edges = G_realloc(st->edges, st->nalloc * sizeof(struct edge));
+    }
+    st->edges[st->nedges].a = a;
+    st->edges[st->nedges].b = b;
+    st->edges[st->nedges].z = z;
+    st->nedges++;
+}
+
+/* whether the cell drains out of the map */
+static int is_outlet(const struct flood *fl, int row, int col)
+{
+    int k;
+
+    if (row == 0 || row == fl->nrows - 1 || col == 0 || col == fl->ncols - 1)
+	return 1;
+
+    for (k = 0; k < 8; k++) {
+	size_t n = (size_t)(row + nbr_row[k]) * fl->ncols + col + nbr_col[k];
+
+	if (Rast_is_d_null_value(&fl->z[n]))
+	    return 1;
+    }
+
+    return 0;
+}
+
+static void flood_strip(const struct flood *fl, struct strip *st)
+{
+    struct heap heap;
+    struct queue pit;
+    int row, col, k;
+
+    G_zero(&heap, sizeof(heap));
+    G_zero(&pit, sizeof(pit));
+
+    for (row = st->first; row < st->last; row++) {
+	int edge_row = row == st->first || row == st->last - 1;
+
+	for (col = 0; col < fl->ncols; col++) {
+	    size_t i = (size_t)row * fl->ncols + col;
+
+	    if (Rast_is_d_null_value(&fl->z[i]))
+		continue;
+
+	    if (is_outlet(fl, row, col)) {
+		if (fl->label)
+		    fl->label[i] = OCEAN;
+	    }
+	    else if (fl->label && edge_row)
+		/* labelled when taken from the heap */
+		fl->label[i] = 0;
+	    else
+		continue;
+
+	    fl->closed[i] = 1;
+	    heap_push(&heap, fl->z[i], i);
+	}
+    }
+
+    while (pit.head < pit.tail || heap.n > 0) {
+	size_t i;
+	DCELL z;
+
+	if (pit.head < pit.tail)
+	    i = queue_pop(&pit);
+	else
+	    i = heap_pop(&heap).i;
+
+	z = fl->z[i];
+	row = i / fl->ncols;
+	col = i % fl->ncols;
+
+	if (fl->label && fl->label[i] == 0)
+	    fl->label[i] = OCEAN + ++st->nlabels;
+
+	for (k = 0; k < 8; k++) {
+	    int r = row + nbr_row[k], c = col + nbr_col[k];
+	    size_t n;
+
+	    if (r < st->first || r >= st->last || c < 0 || c >= fl->ncols)
+		continue;
+
+	    n = (size_t)r * fl->ncols + c;
+	    if (Rast_is_d_null_value(&fl->z[n]))
+		continue;
+
+	    if (fl->closed[n]) {
+		if (fl->label && fl->label[n] && fl->label[n] != fl->label[i])
+		    add_edge(st, fl->label[i], fl->label[n],
+			     MAX(z, fl->z[n]));
+		continue;
+	    }
+
+	    fl->closed[n] = 1;
+	    if (fl->label)
+		fl->label[n] = fl->label[i];
+
+	    if (fl->z[n] <= z) {
+		fl->z[n] = z;
+		queue_push(&pit, n);
+	    }
+	    else
+		heap_push(&heap, fl->z[n], n);
+	}
+    }
+
+    G_free(heap.c);
+    G_free(pit.i);
+}
+
+/* runs on a worker thread for the strips first to last - 1 */
+static void flood_strips(int first, int last, void *closure)
+{
+    const struct flood *fl = closure;
+    int s;
+
+    for (s = first; s < last; s++)
+	flood_strip(fl, &fl->strips[s]);
+}
+
+static int global_label(const struct strip *st, int label)
+{
+    return label == OCEAN ? OCEAN : st->offset + label - OCEAN;
+}
+
+/* runs on a worker thread, converts the labels of the strips
+ * first to last - 1 to global labels */
+static void offset_strips(int first, int last, void *closure)
+{
+    const struct flood *fl = closure;
+    int s;
+    size_t i, e;
+
+    for (s = first; s < last; s++) {
+	struct strip *st = &fl->strips[s];
+
+	for (i = (size_t)st->first * fl->ncols;
+	     i < (size_t)st->last * fl->ncols; i++) {
+	    if (!Rast_is_d_null_value(&fl->z[i]))
+		fl->label[i] = global_label(st, fl->label[i]);
+	}
+	for (e = 0; e < st->nedges; e++) {
+	    st->edges[e].a = global_label(st, st->edges[e].a);
+	    st->edges[e].b = global_label(st, st->edges[e].b);
+	}
+    }
+}
+
+/* runs on a worker thread, raises the cells of the strips first to
+ * last - 1 to the water level of their label */
+static void raise_strips(int first, int last, void *closure)
+{
+    const struct flood *fl = closure;
+    size_t i;
+
+    for (i = (size_t)fl->strips[first].first * fl->ncols;
+	 i < (size_t)fl->strips[last - 1].last * fl->ncols; i++) {
+	DCELL level;
+
+	if (Rast_is_d_null_value(&fl->z[i]))
+	    continue;
+	level = fl->level[fl->label[i]];
+	if (level > fl->z[i])
+	    fl->z[i] = level;
+    }
+}
+
+/* water levels of all labels from the spill elevations between labels */
+static void spill_levels(struct flood *fl, int nstrips, int nlabels)
+{
+    struct heap heap;
+    struct edge *e;
+    size_t *first, nedges, k;
+    int *to;
+    DCELL *spill;
+    int s, col, d;
+
+    /* spill elevations across the edges of the strips,
+     * the edge rows of a strip are not raised by flood_strip() */
+    for (s = 0; s < nstrips - 1; s++) {
+	struct strip *st = &fl->strips[s];
+	size_t a = (size_t)(st->last - 1) * fl->ncols;
+	size_t b = a + fl->ncols;
+
+	for (col = 0; col < fl->ncols; col++) {
+	    if (Rast_is_d_null_value(&fl->z[a + col]))
+		continue;
+	    for (d = -1; d <= 1; d++) {
+		if (col + d < 0 || col + d >= fl->ncols ||
+		    Rast_is_d_null_value(&fl->z[b + col + d]) ||
+		    fl->label[a + col] == fl->label[b + col + d])
+		    continue;
+		add_edge(st, fl->label[a + col], fl->label[b + col + d],
+			 MAX(fl->z[a + col], fl->z[b + col + d]));
+	    }
+	}
+    }
+
+    /* adjacency lists of the labels */
+    first = G_calloc(nlabels + 2, sizeof(size_t));
+    nedges = 0;
+    for (s = 0; s < nstrips; s++) {
+	struct strip *st = &fl->strips[s];
+
+	for (k = 0; k < st->nedges; k++) {
+	    first[st->edges[k].a + 1]++;
+	    first[st->edges[k].b + 1]++;
+	}
+	nedges += st->nedges;
+    }
+    for (s = 1; s <= nlabels + 1; s++)
+	first[s] += first[s - 1];
+    to = G_malloc(2 * nedges * sizeof(int));
+    spill = G_malloc(2 * nedges * sizeof(DCELL));
+    for (s = 0; s < nstrips; s++) {
+	struct strip *st = &fl->strips[s];
+
+	for (k = 0, e = st->edges; k < st->nedges; k++, e++) {
+	    to[first[e->a]] = e->b;
+	    spill[first[e->a]++] = e->z;
+	    to[first[e->b]] = e->a;
+	    spill[first[e->b]++] = e->z;
+	}
+	G_free(st->edges);
+    }
+    for (s = nlabels + 1; s > 0; s--)
+	first[s] = first[s - 1];
+    first[0] = 0;
+
+    /* flood the graph from the map edge */
+    fl->level = G_malloc((nlabels + 1) * sizeof(DCELL));
+    for (s = 0; s <= nlabels; s++)
+	fl->level[s] = DBL_MAX;
+    fl->level[OCEAN] = -DBL_MAX;
+
+    G_zero(&heap, sizeof(heap));
+    heap_push(&heap, fl->level[OCEAN], OCEAN);
+    while (heap.n > 0) {
+	struct heap_cell top = heap_pop(&heap);
+	int a = top.i;
+
+	if (top.z > fl->level[a])
+	    continue;		/* outdated */
+
+	for (k = first[a]; k < first[a + 1]; k++) {
+	    DCELL level = MAX(fl->level[a], spill[k]);
+
+	    if (level < fl->level[to[k]]) {
+		fl->level[to[k]] = level;
+		heap_push(&heap, level, to[k]);
+	    }
+	}
+    }
+
+    G_free(heap.c);
+    G_free(first);
+    G_free(to);
+    G_free(spill);
+}
+
+/* runs on a worker thread, steepest descent flow directions of the
+ * rows first to last - 1, 0 for flat cells */
+static void direction_rows(int first, int last, void *closure)
+{
+    const struct flood *fl = closure;
+    int nrows = fl->nrows, ncols = fl->ncols;
+    int row, col, k;
+
+    for (row = first; row < last; row++) {
+	for (col = 0; col < ncols; col++) {
+	    size_t i = (size_t)row * ncols + col;
+	    CELL *dir = &fl->dir[i];
+	    double curslope;
+
+	    if (Rast_is_d_null_value(&fl->z[i])) {
+		Rast_set_c_null_value(dir, 1);
+		continue;
+	    }
+
+	    /* on outer rows and columns the flow direction is always
+	     * directly out of the map */
+	    if (row == 0) {
+		*dir = 128;
+		continue;
+	    }
+	    if (row == nrows - 1) {
+		*dir = 8;
+		continue;
+	    }
+	    if (col == 0) {
+		*dir = 32;
+		continue;
+	    }
+	    if (col == ncols - 1) {
+		*dir = 2;
+		continue;
+	    }
+
+	    *dir = 0;
+	    curslope = -HUGE_VAL;
+	    for (k = 0; k < 8; k++) {
+		size_t n = i + (ptrdiff_t)nbr_row[k] * ncols + nbr_col[k];
+		double newslope;
+
+		/* always discharge to a null boundary */
+		if (Rast_is_d_null_value(&fl->z[n])) {
+		    curslope = DBL_MAX;
+		    *dir = nbr_dir[k];
+		    continue;
+		}
+		newslope = (fl->z[i] - fl->z[n]) / nbr_dist[k];
+		if (newslope > curslope) {
+		    curslope = newslope;
+		    *dir = nbr_dir[k];
+		}
+	    }
+	    if (curslope <= 0.)
+		*dir = 0;
+	}
+    }
+}
+
+/* flat cells flow to the nearest cell of the flat
+ * which already has a flow direction */
+static void resolve_flats(const struct flood *fl)
+{
+    struct queue flat;
+    int row, col, k;
+    size_t i;
+
+    G_zero(&flat, sizeof(flat));
+
+    for (row = 1; row < fl->nrows - 1; row++) {
+	for (col = 1; col < fl->ncols - 1; col++) {
+	    i = (size_t)row * fl->ncols + col;
+	    if (fl->dir[i] != 0)
+		continue;
+	    for (k = 0; k < 8; k++) {
+		size_t n = i + (ptrdiff_t)nbr_row[k] * fl->ncols + nbr_col[k];
+
+		if (fl->dir[n] > 0 && fl->z[n] == fl->z[i]) {
+		    fl->dir[i] = nbr_dir[k];
+		    queue_push(&flat, i);
+		    break;
+		}
+	    }
+	}
+    }
+
+    while (flat.head < flat.tail) {
+	i = flat.i[flat.head++];
+
+	for (k = 0; k < 8; k++) {
+	    size_t n = i + (ptrdiff_t)nbr_row[k] * fl->ncols + nbr_col[k];
+
+	    /* outer rows and columns always have a flow direction */
+	    if (fl->dir[n] == 0 && fl->z[n] == fl->z[i]) {
+		fl->dir[n] = nbr_dir[7 - k];
+		queue_push(&flat, n);
+	    }
+	}
+    }
+
+    G_free(flat.i);
+}
+
+/* fills all depressions of the input map, the filled elevations,
+ * the flow directions and an empty map of problem areas are written
+ * to the temp files for the output maps */
+void pflood(int map_id, int in_type, int fe, int fd, int fm,
+	    int nrows, int ncols, int nprocs)
+{
+    struct flood fl;
+    int nstrips, nlabels;
+    int row, col, s;
+    void *buf, *ptr;
+    size_t cellsz = Rast_cell_size(in_type);
+
+    G_zero(&fl, sizeof(fl));
+    fl.nrows = nrows;
+    fl.ncols = ncols;
+    fl.z = G_malloc((size_t)nrows * ncols * sizeof(DCELL));
+    fl.closed = G_calloc((size_t)nrows * ncols, 1);
+
+    G_message(_("Reading input elevation raster map..."));
+    for (row = 0; row < nrows; row++) {
+	G_percent(row, nrows, 2);
+	Rast_get_d_row(map_id, fl.z + (size_t)row * ncols, row);
+    }
+    G_percent(1, 1, 1);
+
+    nstrips = 1;
+    if (nprocs > 1) {
+	nstrips = nprocs * STRIPS_PER_THREAD;
+	if (nstrips > nrows)
+	    nstrips = nrows;
+    }
+    fl.strips = G_calloc(nstrips, sizeof(struct strip));
+    for (s = 0; s < nstrips; s++) {
+	fl.strips[s].first = (long long)s * nrows / nstrips;
+	fl.strips[s].last = (long long)(s + 1) * nrows / nstrips;
+    }
+    if (nstrips > 1)
+	fl.label = G_malloc((size_t)nrows * ncols * sizeof(int));
+
+    G_message(_("Filling depressions..."));
+    G_parallel_for(0, nstrips, 1, flood_strips, &fl);
+    G_free(fl.closed);
+
+    if (nstrips > 1) {
+	nlabels = OCEAN;
+	for (s = 0; s < nstrips; s++) {
+	    fl.strips[s].offset = nlabels;
+	    nlabels += fl.strips[s].nlabels;
+	}
+	G_debug(1, "%d labels in %d strips", nlabels, nstrips);
+
+	G_parallel_for(0, nstrips, 1, offset_strips, &fl);
+	spill_levels(&fl, nstrips, nlabels);
+	G_parallel_for(0, nstrips, STRIPS_PER_THREAD, raise_strips, &fl);
+
+	G_free(fl.level);
+	G_free(fl.label);
+    }
+    G_free(fl.strips);
+
+    G_message(_("Determining flow directions..."));
+    fl.dir = G_malloc((size_t)nrows * ncols * sizeof(CELL));
+    fl.chunk = (nrows + nprocs - 1) / nprocs;
+    G_parallel_for(0, nrows, fl.chunk, direction_rows, &fl);
+    resolve_flats(&fl);
+
+    buf = Rast_allocate_buf(in_type);
+    lseek(fe, 0, SEEK_SET);
+    lseek(fd, 0, SEEK_SET);
+    for (row = 0; row < nrows; row++) {
+	const DCELL *z = fl.z + (size_t)row * ncols;
+
+	for (col = 0, ptr = buf; col < ncols;
+	     col++, ptr = G_incr_void_ptr(ptr, cellsz)) {
+	    if (Rast_is_d_null_value(&z[col]))
+		Rast_set_null_value(ptr, 1, in_type);
+	    else
+		Rast_set_d_value(ptr, z[col], in_type);
+	}
+	write(fe, buf, ncols * cellsz);
+	write(fd, fl.dir + (size_t)row * ncols, ncols * sizeof(CELL));
+    }
+    G_free(buf);
+    G_free(fl.z);
+
+    /* no unresolved areas remain */
+    lseek(fm, 0, SEEK_SET);
+    for (col = 0; col < ncols; col++)
+	fl.dir[col] = -1;
+    for (row = 0; row < nrows; row++)
+	write(fm, fl.dir, ncols * sizeof(CELL));
+    G_free(fl.dir);
+}
@@ -219,11 +219,12 @@ int shape(PATTERN * pattern, int pattern_size, float *azimuth,
     int i;
     double avg_x = 0, avg_y = 0;
     double avg_x_y = 0;
-    double avg_x_square;
+    double avg_x_square = 0;
     double rx, ry;
     double sine, cosine;
     double result;
-    double rxmin, rxmax, rymin, rymax;
+    double rxmin = HUGE_VAL, rxmax = -HUGE_VAL;
+    double rymin = HUGE_VAL, rymax = -HUGE_VAL;
 
     for (i = 0; i < 8; ++i) {
 	avg_y += pattern->y[i];
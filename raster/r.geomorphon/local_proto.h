@@ -60,6 +60,9 @@ typedef struct
     char elevname[150];
     RASTER_MAP_TYPE raster_type;
     FCELL **elev;
+    int band_size;		/* number of allocated rows in elev */
+    int first_row;		/* map row stored in elev[0] */
+    int num_rows;		/* number of valid rows in elev */
     int fd;			/* file descriptor */
 } MAPS;
 
@@ -93,6 +96,13 @@ typedef struct
     double x[8], y[8];		/* cartesian coordinates of geomorphon */
 } PATTERN;
 
+typedef struct
+{				/* distances along lines of sight for one row */
+    int num_steps[8];
+    int size[8];
+    double *distance[8];
+} RAYS;
+
 typedef enum
 {
     ZERO,			/* zero cats do not accept zero category */
@@ -145,6 +155,10 @@ GLOBAL unsigned int global_ternary_codes[6562];
 
 /* memory */
 int open_map(MAPS * rast);
+int init_buffers(MAPS * rast);
+int init_band(MAPS * rast, int size);
+int read_band(MAPS * rast, int first, int last);
+int buffer_start(int row);
 int create_maps(void);
 int shift_buffers(int row);
 int get_cell(int col, float *buf_row, void *buf, RASTER_MAP_TYPE raster_type);
@@ -152,8 +166,14 @@ int free_map(FCELL ** map, int n);
 int write_form_cat_colors(char *raster, CATCOLORS * ccolors);
 int write_contrast_colors(char *);
 
+/* pattern */
+int init_rays(RAYS * rays);
+int free_rays(RAYS * rays);
+int calc_rays(RAYS * rays, int row);
+int calc_pattern(PATTERN * pattern, FCELL ** elev, int cur_row, int col,
+		 RAYS * rays, double search_dist, double flat_dist);
+
 /* geom */
-int calc_pattern(PATTERN * pattern, int row, int cur_row, int col);
 unsigned int ternary_rotate(unsigned int value);
 int determine_form(int num_plus, int num_minus);
 int determine_binary(int *pattern, int sign);
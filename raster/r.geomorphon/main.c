@@ -27,6 +27,165 @@ typedef enum
     o_range, o_variance, o_elongation, o_azimuth, o_extend, o_width, io_size
 } outputs;
 
+/* the rows of a band and the parameters to calculate them */
+struct band
+{
+    struct Option **opt_output;
+    IO *rasters;		/* output row buffers of the band */
+    size_t *cell_size;
+    RAYS *rays;			/* lines of sight of the rows */
+    int band_start;
+    int extended;
+    double search_dist, flat_dist, small_search_dist;
+    double area_of_octagon, max_resolution;
+};
+
+/* calculate the rows first to last - 1 of a band; the elevation band
+ * and the rays are shared and only read, each row of the output
+ * buffers is written by one thread */
+static void calc_rows(int first, int last, void *closure)
+{
+    const struct band *b = closure;
+    struct Option **opt_output = b->opt_output;
+    int row, i;
+
+    for (row = first; row < last; ++row) {
+	PATTERN *pattern;
+	PATTERN patterns[2];
+	RAYS *rays = &b->rays[row - b->band_start];
+	void *buffers[io_size];
+	void *pointer_buf;
+	FCELL **elev;
+	int cur_row, col, pattern_size;
+
+	/* same rows the moving buffer would have for this row */
+	elev = &elevation.elev[buffer_start(row) - elevation.first_row];
+	cur_row = row - buffer_start(row);
+	for (i = 1; i < io_size; ++i)
+	    if (opt_output[i]->answer)
+		buffers[i] = (char *)b->rasters[i].buffer +
+		    (size_t) (row - b->band_start) * ncols *
+		    b->cell_size[i];
+
+	for (col = 0; col < ncols; ++col) {
+	    /* on borders forms ussualy are innatural. */
+	    if (row < (skip_cells + 1) ||
+		row > nrows - (skip_cells + 2) ||
+		col < (skip_cells + 1) ||
+		col > ncols - (skip_cells + 2) ||
+		Rast_is_f_null_value(&elev[cur_row][col])) {
+		/* set outputs to NULL and do nothing if source value is null   or border */
+		for (i = 1; i < io_size; ++i)
+		    if (opt_output[i]->answer) {
+			pointer_buf = buffers[i];
+			switch (b->rasters[i].out_data_type) {
+			case CELL_TYPE:
+			    Rast_set_c_null_value(&((CELL *)
+						    pointer_buf)[col],
+						  1);
+			    break;
+			case FCELL_TYPE:
+			    Rast_set_f_null_value(&((FCELL *)
+						    pointer_buf)[col],
+						  1);
+			    break;
+			case DCELL_TYPE:
+			    Rast_set_d_null_value(&((DCELL *)
+						    pointer_buf)[col],
+						  1);
+			    break;
+			default:
+			    G_fatal_error(_("Unknown output data type"));
+			}
+		    }
+		continue;
+	    }		/* end null value */
+	    {
+		int cur_form, small_form;
+
+		pattern_size =
+		    calc_pattern(&patterns[0], elev, cur_row, col,
+				 rays, b->search_dist, b->flat_dist);
+		pattern = &patterns[0];
+		cur_form =
+		    determine_form(pattern->num_negatives,
+				   pattern->num_positives);
+
+		/* correction of forms */
+		if (b->extended && b->search_dist > 10 * b->max_resolution) {
+		    /* 1) remove extensive innatural forms: ridges, peaks, shoulders and footslopes */
+		    if ((cur_form == 4 || cur_form == 8 ||
+			 cur_form == 2 || cur_form == 3)) {
+			pattern_size =
+			    calc_pattern(&patterns[1], elev, cur_row,
+					 col, rays, b->small_search_dist,
+					 0);
+			pattern = &patterns[1];
+			small_form =
+			    determine_form(pattern->num_negatives,
+					   pattern->num_positives);
+			if (cur_form == 4 || cur_form == 8)
+			    cur_form =
+				(small_form == 1) ? 1 : cur_form;
+			if (cur_form == 2 || cur_form == 3)
+			    cur_form = small_form;
+		    }
+		    /* 3) Depressions */
+
+		}	/* end of correction */
+		pattern = &patterns[0];
+		if (opt_output[o_forms]->answer)
+		    ((CELL *) buffers[o_forms])[col] = cur_form;
+	    }
+
+	    if (opt_output[o_ternary]->answer)
+		((CELL *) buffers[o_ternary])[col] =
+		    determine_ternary(pattern->pattern);
+	    if (opt_output[o_positive]->answer)
+		((CELL *) buffers[o_positive])[col] =
+		    rotate(pattern->positives);
+	    if (opt_output[o_negative]->answer)
+		((CELL *) buffers[o_negative])[col] =
+		    rotate(pattern->negatives);
+	    if (opt_output[o_intensity]->answer)
+		((FCELL *) buffers[o_intensity])[col] =
+		    intensity(pattern->elevation, pattern_size);
+	    if (opt_output[o_exposition]->answer)
+		((FCELL *) buffers[o_exposition])[col] =
+		    exposition(pattern->elevation);
+	    if (opt_output[o_range]->answer)
+		((FCELL *) buffers[o_range])[col] =
+		    range(pattern->elevation);
+	    if (opt_output[o_variance]->answer)
+		((FCELL *) buffers[o_variance])[col] =
+		    variance(pattern->elevation, pattern_size);
+
+	    /*                       used only for next four shape functions */
+	    if (opt_output[o_elongation]->answer ||
+		opt_output[o_azimuth]->answer ||
+		opt_output[o_extend]->answer ||
+		opt_output[o_width]->answer) {
+		float azimuth, elongation, width;
+
+		radial2cartesian(pattern);
+		shape(pattern, pattern_size, &azimuth, &elongation,
+		      &width);
+		if (opt_output[o_azimuth]->answer)
+		    ((FCELL *) buffers[o_azimuth])[col] = azimuth;
+		if (opt_output[o_elongation]->answer)
+		    ((FCELL *) buffers[o_elongation])[col] =
+			elongation;
+		if (opt_output[o_width]->answer)
+		    ((FCELL *) buffers[o_width])[col] = width;
+	    }
+	    if (opt_output[o_extend]->answer)
+		((FCELL *) buffers[o_extend])[col] =
+		    extends(pattern, pattern_size) / b->area_of_octagon;
+
+	}		/* end for col */
+    }
+}
+
 int main(int argc, char **argv)
 {
     IO rasters[] = {		/* rasters stores output buffers */
@@ -83,7 +242,7 @@ int main(int argc, char **argv)
 	*par_skip_radius,
 	*par_flat_threshold,
 	*par_flat_distance,
-	*par_multi_prefix, *par_multi_step, *par_multi_start;
+	*par_multi_prefix, *par_multi_step, *par_multi_start, *par_nprocs;
     struct Flag *flag_units, *flag_extended;
 
     struct History history;
@@ -91,7 +250,7 @@ int main(int argc, char **argv)
     int i;
     int meters = 0, multires = 0, extended = 0;	/* flags */
     int row, cur_row, col;
-    int pattern_size;
+    int threads;
     double max_resolution;
     char prefix[20];
 
@@ -171,6 +330,8 @@ int main(int argc, char **argv)
 	    _("Distance where serch will start in multiple mode (zero to omit)");
 	par_multi_start->guisection = _("Multires");
 
+	par_nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
 	flag_units = G_define_flag();
 	flag_units->key = 'm';
 	flag_units->description =
@@ -184,6 +345,9 @@ int main(int argc, char **argv)
 	    exit(EXIT_FAILURE);
     }
 
+    threads = G_set_nprocs(par_nprocs);
+    G_verbose_message(_("Number of threads <%d>"), threads);
+
     {				/* calculate parameters */
 	int num_outputs = 0;
 	double search_radius, skip_radius, start_radius, step_radius;
@@ -228,6 +392,8 @@ int main(int argc, char **argv)
 	row_radius_size =
 	    meters ? ceil(search_radius / ns_resolution) : search_radius;
 	row_buffer_size = row_radius_size * 2 + 1;
+	if (nrows < row_buffer_size + 1)
+	    G_fatal_error(_("Search radius is too large for the number of rows in the region"));
 	search_distance =
 	    (meters) ? search_radius : ns_resolution * search_cells;
 
@@ -308,167 +474,80 @@ int main(int argc, char **argv)
     open_map(&elevation);
 
     if (!multires) {
-	PATTERN *pattern;
-	PATTERN patterns[4];
-	void *pointer_buf;
 	double search_dist = search_distance;
-	double skip_dist = skip_distance;
 	double flat_dist = flat_distance;
+	double small_search_dist =
+	    (search_dist / 2. < 4 * max_resolution) ? 4 * max_resolution :
+	    search_dist / 2.;
 	double area_of_octagon =
 	    4 * (search_distance * search_distance) * sin(DEGREE2RAD(45.));
 
+	int band_rows, band_start, band_end, first, last;
+	size_t cell_size[io_size];
+	RAYS *band_rays;
+	struct band bd;
+
 	cell_step = 1;
+	/* rows are calculated in bands, every thread takes whole rows */
+	band_rows = MIN(nrows, 16 * threads);
+	init_band(&elevation, band_rows + row_buffer_size);
+	band_rays = G_malloc(band_rows * sizeof(RAYS));
+	for (row = 0; row < band_rows; ++row)
+	    init_rays(&band_rays[row]);
+
 	/* prepare outputs */
 	for (i = 1; i < io_size; ++i)
 	    if (opt_output[i]->answer) {
 		rasters[i].fd =
 		    Rast_open_new(opt_output[i]->answer,
 				  rasters[i].out_data_type);
+		cell_size[i] = Rast_cell_size(rasters[i].out_data_type);
 		rasters[i].buffer =
-		    Rast_allocate_buf(rasters[i].out_data_type);
+		    G_malloc((size_t) band_rows * ncols * cell_size[i]);
 	    }
 
-	/* main loop */
-	for (row = 0; row < nrows; ++row) {
-	    G_percent(row, nrows, 2);
-	    cur_row = (row < row_radius_size) ? row :
-		((row >=
-		  nrows - row_radius_size - 1) ? row_buffer_size - (nrows -
-								    row -
-								    1) :
-		 row_radius_size);
-
-	    if (row > (row_radius_size) &&
-		row < nrows - (row_radius_size + 1))
-		shift_buffers(row);
-	    for (col = 0; col < ncols; ++col) {
-		/* on borders forms ussualy are innatural. */
-		if (row < (skip_cells + 1) || row > nrows - (skip_cells + 2)
-		    || col < (skip_cells + 1) ||
-		    col > ncols - (skip_cells + 2) ||
-		    Rast_is_f_null_value(&elevation.elev[cur_row][col])) {
-		    /* set outputs to NULL and do nothing if source value is null   or border */
-		    for (i = 1; i < io_size; ++i)
-			if (opt_output[i]->answer) {
-			    pointer_buf = rasters[i].buffer;
-			    switch (rasters[i].out_data_type) {
-			    case CELL_TYPE:
-				Rast_set_c_null_value(&((CELL *) pointer_buf)
-						      [col], 1);
-				break;
-			    case FCELL_TYPE:
-				Rast_set_f_null_value(&((FCELL *) pointer_buf)
-						      [col], 1);
-				break;
-			    case DCELL_TYPE:
-				Rast_set_d_null_value(&((DCELL *) pointer_buf)
-						      [col], 1);
-				break;
-			    default:
-				G_fatal_error(_("Unknown output data type"));
-			    }
-			}
-		    continue;
-		}		/* end null value */
-		{
-		    int cur_form, small_form;
-
-		    search_distance = search_dist;
-		    skip_distance = skip_dist;
-		    flat_distance = flat_dist;
-		    pattern_size =
-			calc_pattern(&patterns[0], row, cur_row, col);
-		    pattern = &patterns[0];
-		    cur_form =
-			determine_form(pattern->num_negatives,
-				       pattern->num_positives);
-
-		    /* correction of forms */
-		    if (extended && search_distance > 10 * max_resolution) {
-			/* 1) remove extensive innatural forms: ridges, peaks, shoulders and footslopes */
-			if ((cur_form == 4 || cur_form == 8 || cur_form == 2
-			     || cur_form == 3)) {
-			    search_distance =
-				(search_dist / 2. <
-				 4 * max_resolution) ? 4 *
-				max_resolution : search_dist / 2.;
-			    skip_distance = 0;
-			    flat_distance = 0;
-			    pattern_size =
-				calc_pattern(&patterns[1], row, cur_row, col);
-			    pattern = &patterns[1];
-			    small_form =
-				determine_form(pattern->num_negatives,
-					       pattern->num_positives);
-			    if (cur_form == 4 || cur_form == 8)
-				cur_form = (small_form == 1) ? 1 : cur_form;
-			    if (cur_form == 2 || cur_form == 3)
-				cur_form = small_form;
-			}
-			/* 3) Depressions */
-
-		    }		/* end of correction */
-		    pattern = &patterns[0];
-		    if (opt_output[o_forms]->answer)
-			((CELL *) rasters[o_forms].buffer)[col] = cur_form;
-		}
-
-		if (opt_output[o_ternary]->answer)
-		    ((CELL *) rasters[o_ternary].buffer)[col] =
-			determine_ternary(pattern->pattern);
-		if (opt_output[o_positive]->answer)
-		    ((CELL *) rasters[o_positive].buffer)[col] =
-			rotate(pattern->positives);
-		if (opt_output[o_negative]->answer)
-		    ((CELL *) rasters[o_negative].buffer)[col] =
-			rotate(pattern->negatives);
-		if (opt_output[o_intensity]->answer)
-		    ((FCELL *) rasters[o_intensity].buffer)[col] =
-			intensity(pattern->elevation, pattern_size);
-		if (opt_output[o_exposition]->answer)
-		    ((FCELL *) rasters[o_exposition].buffer)[col] =
-			exposition(pattern->elevation);
-		if (opt_output[o_range]->answer)
-		    ((FCELL *) rasters[o_range].buffer)[col] =
-			range(pattern->elevation);
-		if (opt_output[o_variance]->answer)
-		    ((FCELL *) rasters[o_variance].buffer)[col] =
-			variance(pattern->elevation, pattern_size);
-
-		/*                       used only for next four shape functions */
-		if (opt_output[o_elongation]->answer ||
-		    opt_output[o_azimuth]->answer ||
-		    opt_output[o_extend]->answer ||
-		    opt_output[o_width]->answer) {
-		    float azimuth, elongation, width;
-
-		    radial2cartesian(pattern);
-		    shape(pattern, pattern_size, &azimuth, &elongation,
-			  &width);
-		    if (opt_output[o_azimuth]->answer)
-			((FCELL *) rasters[o_azimuth].buffer)[col] = azimuth;
-		    if (opt_output[o_elongation]->answer)
-			((FCELL *) rasters[o_elongation].buffer)[col] =
-			    elongation;
-		    if (opt_output[o_width]->answer)
-			((FCELL *) rasters[o_width].buffer)[col] = width;
-		}
-		if (opt_output[o_extend]->answer)
-		    ((FCELL *) rasters[o_extend].buffer)[col] =
-			extends(pattern, pattern_size) / area_of_octagon;
+	bd.opt_output = opt_output;
+	bd.rasters = rasters;
+	bd.cell_size = cell_size;
+	bd.rays = band_rays;
+	bd.extended = extended;
+	bd.search_dist = search_dist;
+	bd.flat_dist = flat_dist;
+	bd.small_search_dist = small_search_dist;
+	bd.area_of_octagon = area_of_octagon;
+	bd.max_resolution = max_resolution;
 
-	    }			/* end for col */
-
-	    /* write existing outputs */
-	    for (i = 1; i < io_size; ++i)
-		if (opt_output[i]->answer)
-		    Rast_put_row(rasters[i].fd, rasters[i].buffer,
-				 rasters[i].out_data_type);
+	/* main loop */
+	for (band_start = 0; band_start < nrows; band_start += band_rows) {
+	    G_percent(band_start, nrows, 2);
+	    band_end = MIN(nrows, band_start + band_rows);
+	    first = buffer_start(band_start);
+	    last = buffer_start(band_end - 1) + row_buffer_size - 1;
+	    read_band(&elevation, first, MIN(last, nrows - 1));
+	    /* G_distance() is not reentrant, rays are prepared here */
+	    for (row = band_start; row < band_end; ++row)
+		calc_rays(&band_rays[row - band_start], row);
+
+	    bd.band_start = band_start;
+	    G_parallel_for(band_start, band_end, 1, calc_rows, &bd);
+
+	    /* write existing outputs in row order */
+	    for (row = band_start; row < band_end; ++row)
+		for (i = 1; i < io_size; ++i)
+		    if (opt_output[i]->answer)
+			Rast_put_row(rasters[i].fd,
+				     (char *)rasters[i].buffer +
+				     (size_t) (row - band_start) * ncols *
+				     cell_size[i],
+				     rasters[i].out_data_type);
 	}
-	G_percent(row, nrows, 2);	/* end main loop */
+	G_percent(nrows, nrows, 2);	/* end main loop */
 
 	/* finish and close */
-	free_map(elevation.elev, row_buffer_size + 1);
+	free_map(elevation.elev, elevation.band_size);
+	for (row = 0; row < band_rows; ++row)
+	    free_rays(&band_rays[row]);
+	G_free(band_rays);
 	for (i = 1; i < io_size; ++i)
 	    if (opt_output[i]->answer) {
 		G_free(rasters[i].buffer);
@@ -493,9 +572,12 @@ int main(int argc, char **argv)
 
     if (multires) {
 	PATTERN *multi_patterns;
+	RAYS rays;
 	MULTI multiple_output[5];	/* ten form maps + all forms */
 	char *postfixes[] = { "scale_300", "scale_100", "scale_50", "scale_20" "scale_10" };	/* in pixels */
 	num_of_steps = 5;
+	init_buffers(&elevation);
+	init_rays(&rays);
 	multi_patterns = G_malloc(num_of_steps * sizeof(PATTERN));
 	/* prepare outputs */
 	for (i = 0; i < 5; ++i) {
@@ -530,7 +612,9 @@ int main(int argc, char **argv)
 		    continue;
 		}
 		cell_step = 10;
-		calc_pattern(&multi_patterns[0], row, cur_row, col);
+		calc_rays(&rays, row);
+		calc_pattern(&multi_patterns[0], elevation.elev, cur_row, col,
+			     &rays, search_distance, flat_distance);
 	    }
 
 	    for (i = 0; i < num_of_steps; ++i)
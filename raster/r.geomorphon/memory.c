@@ -3,10 +3,8 @@
 int open_map(MAPS * rast)
 {
 
-    int row, col;
     char *mapset;
     struct Cell_head cellhd;
-    void *tmp_buf;
 
     mapset = (char *)G_find_raster2(rast->elevname, "");
 
@@ -21,6 +19,19 @@ int open_map(MAPS * rast)
 	G_warning(_("Region resolution shoudn't be lesser than map %s resolution. Run g.region raster=%s to set proper resolution"),
 		  rast->elevname, rast->elevname);
 
+    rast->elev = NULL;
+    rast->band_size = 0;
+    rast->first_row = 0;
+    rast->num_rows = 0;
+    return 0;
+}
+
+int init_buffers(MAPS * rast)
+{
+    /* moving buffer of row_buffer_size + 1 rows used with shift_buffers() */
+    int row, col;
+    void *tmp_buf;
+
     tmp_buf = Rast_allocate_buf(rast->raster_type);
     rast->elev = (FCELL **) G_malloc((row_buffer_size + 1) * sizeof(FCELL *));
 
@@ -30,11 +41,77 @@ int open_map(MAPS * rast)
 	for (col = 0; col < ncols; ++col)
 	    get_cell(col, rast->elev[row], tmp_buf, rast->raster_type);
     }				/* end elev */
+    rast->band_size = rast->num_rows = row_buffer_size + 1;
 
     G_free(tmp_buf);
     return 0;
 }
 
+int init_band(MAPS * rast, int size)
+{
+    /* band of at most size rows, filled by read_band() */
+    int row;
+
+    rast->elev = (FCELL **) G_malloc(size * sizeof(FCELL *));
+    for (row = 0; row < size; ++row)
+	rast->elev[row] = Rast_allocate_buf(FCELL_TYPE);
+    rast->band_size = size;
+    rast->first_row = 0;
+    rast->num_rows = 0;
+    return 0;
+}
+
+int buffer_start(int row)
+{
+    /* first map row of the row_buffer_size rows visible from row */
+    int start = row - row_radius_size;
+
+    if (start > nrows - row_buffer_size - 1)
+	start = nrows - row_buffer_size - 1;
+    if (start < 0)
+	start = 0;
+    return start;
+}
+
+int read_band(MAPS * rast, int first, int last)
+{
+    /* make rows first..last available as rast->elev[row - first],
+     * rows already in the band are kept and only new ones are read */
+    int row, col, i, keep;
+    void *tmp_buf;
+    FCELL **old;
+
+    keep = rast->first_row + rast->num_rows - first;
+    if (first < rast->first_row || keep < 0)
+	keep = 0;
+    if (keep > last - first + 1)
+	keep = last - first + 1;
+    if (keep > 0 && first > rast->first_row) {
+	/* rotate row pointers so the kept rows move to the start */
+	int shift = first - rast->first_row;
+
+	old = G_malloc(rast->band_size * sizeof(FCELL *));
+	for (i = 0; i < rast->band_size; ++i)
+	    old[i] = rast->elev[(i + shift) % rast->band_size];
+	for (i = 0; i < rast->band_size; ++i)
+	    rast->elev[i] = old[i];
+	G_free(old);
+    }
+
+    tmp_buf = Rast_allocate_buf(rast->raster_type);
+    for (row = first + keep; row <= last; ++row) {
+	Rast_get_row(rast->fd, tmp_buf, row, rast->raster_type);
+	for (col = 0; col < ncols; ++col)
+	    get_cell(col, rast->elev[row - first], tmp_buf,
+		     rast->raster_type);
+    }
+    G_free(tmp_buf);
+
+    rast->first_row = first;
+    rast->num_rows = last - first + 1;
+    return 0;
+}
+
 int get_cell(int col, float *buf_row, void *buf, RASTER_MAP_TYPE raster_type)
 {
 
@@ -7,21 +7,79 @@
 static int nextr[8] = { -1, -1, -1, 0, 1, 1, 1, 0 };
 static int nextc[8] = { 1, 0, -1, -1, -1, 0, 1, 1 };
 
-int calc_pattern(PATTERN * pattern, int row, int cur_row, int col)
+int init_rays(RAYS * rays)
+{
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+	rays->num_steps[i] = 0;
+	rays->size[i] = search_cells + 2;
+	rays->distance[i] = G_malloc(rays->size[i] * sizeof(double));
+    }
+    return 0;
+}
+
+int free_rays(RAYS * rays)
+{
+    int i;
+
+    for (i = 0; i < 8; ++i)
+	G_free(rays->distance[i]);
+    return 0;
+}
+
+int calc_rays(RAYS * rays, int row)
+{
+    /* distances along the eight lines of sight depend only on the row,
+     * so they are calculated once per row and shared by all its cells */
+    int i, j, k;
+    double cur_northing, cur_easting, target_northing, target_easting;
+    double cur_distance;
+
+    cur_northing = Rast_row_to_northing(row + 0.5, &window);
+    cur_easting = Rast_col_to_easting(0.5, &window);
+
+    for (i = 0; i < 8; ++i) {
+	k = 0;
+	j = skip_cells + 1;
+	for (;;) {
+	    target_northing =
+		Rast_row_to_northing(row + j * nextr[i] + 0.5, &window);
+	    target_easting =
+		Rast_col_to_easting(j * nextc[i] + 0.5, &window);
+	    cur_distance =
+		G_distance(cur_easting, cur_northing, target_easting,
+			   target_northing);
+	    if (cur_distance >= search_distance)
+		break;
+	    /* LL rows near the poles need more steps than search cells */
+	    if (k == rays->size[i]) {
+		rays->size[i] *= 2;
+		rays->distance[i] =
+		    G_realloc(rays->distance[i],
+			      rays->size[i] * sizeof(double));
+	    }
+	    rays->distance[i][k++] = cur_distance;
+	    j += cell_step;
+	}
+	rays->num_steps[i] = k;
+    }
+    return 0;
+}
+
+int calc_pattern(PATTERN * pattern, FCELL ** elev, int cur_row, int col,
+		 RAYS * rays, double search_dist, double flat_dist)
 {
     /* calculate parameters of geomorphons and store it in the struct pattern */
-    int i, j, pattern_size = 0;
-    double zenith_angle, nadir_angle, angle;
+    int i, j, k, pattern_size = 0;
+    double zenith_angle, nadir_angle;
+    double zenith_slope, nadir_slope, slope;
     double nadir_threshold, zenith_threshold;
     double zenith_height, nadir_height, zenith_distance, nadir_distance;
-    double cur_northing, cur_easting, target_northing, target_easting;
     double cur_distance;
     double center_height, height;
 
-    /* use distance calculation */
-    cur_northing = Rast_row_to_northing(row + 0.5, &window);
-    cur_easting = Rast_col_to_easting(col + 0.5, &window);
-    center_height = elevation.elev[cur_row][col];
+    center_height = elev[cur_row][col];
     pattern->num_positives = 0;
     pattern->num_negatives = 0;
     pattern->positives = 0;
@@ -40,50 +98,45 @@ int calc_pattern(PATTERN * pattern, int row, int cur_row, int col)
 	    cur_row + j * nextr[i] > row_buffer_size - 1 ||
 	    col + j * nextc[i] < 0 || col + j * nextc[i] > ncols - 1)
 	    continue;		/* border: current cell is on the end of DEM */
-	if (Rast_is_f_null_value
-	    (&elevation.elev[cur_row + nextr[i]][col + nextc[i]]))
+	if (Rast_is_f_null_value(&elev[cur_row + nextr[i]][col + nextc[i]]))
 	    continue;		/* border: next value is null, line-of-sight does not exists */
 	pattern_size++;		/* line-of-sight exists, continue calculate visibility */
 
-	target_northing =
-	    Rast_row_to_northing(row + j * nextr[i] + 0.5, &window);
-	target_easting =
-	    Rast_col_to_easting(col + j * nextc[i] + 0.5, &window);
-	cur_distance =
-	    G_distance(cur_easting, cur_northing, target_easting,
-		       target_northing);
-
-	while (cur_distance < search_distance) {
+	/* atan2() is monotonic in height/distance, angles are calculated
+	 * only for the final zenith and nadir points */
+	zenith_slope = -HUGE_VAL;
+	nadir_slope = HUGE_VAL;
+	zenith_height = nadir_height = 0.;
+	zenith_distance = nadir_distance = 0.;
+	for (k = 0; k < rays->num_steps[i]; ++k) {
+	    cur_distance = rays->distance[i][k];
+	    if (cur_distance >= search_dist)
+		break;
 	    if (cur_row + j * nextr[i] < 0 ||
 		cur_row + j * nextr[i] > row_buffer_size - 1 ||
 		col + j * nextc[i] < 0 || col + j * nextc[i] > ncols - 1)
 		break;		/* reached end of DEM (cols) or buffer (rows) */
 
-	    height =
-		elevation.elev[cur_row + j * nextr[i]][col + j * nextc[i]] -
+	    height = elev[cur_row + j * nextr[i]][col + j * nextc[i]] -
 		center_height;
-	    angle = atan2(height, cur_distance);
+	    slope = height / cur_distance;
 
-	    if (angle > zenith_angle) {
-		zenith_angle = angle;
+	    if (slope > zenith_slope) {
+		zenith_slope = slope;
 		zenith_height = height;
 		zenith_distance = cur_distance;
 	    }
-	    if (angle < nadir_angle) {
-		nadir_angle = angle;
+	    if (slope < nadir_slope) {
+		nadir_slope = slope;
 		nadir_height = height;
 		nadir_distance = cur_distance;
 	    }
 	    j += cell_step;
-	    /*             j++; */ /* go to next cell */
-	    target_northing =
-		Rast_row_to_northing(row + j * nextr[i] + 0.5, &window);
-	    target_easting =
-		Rast_col_to_easting(col + j * nextc[i] + 0.5, &window);
-	    cur_distance =
-		G_distance(cur_easting, cur_northing, target_easting,
-			   target_northing);
 	}			/* end line of sight */
+	if (zenith_slope > -HUGE_VAL)
+	    zenith_angle = atan2(zenith_height, zenith_distance);
+	if (nadir_slope < HUGE_VAL)
+	    nadir_angle = atan2(nadir_height, nadir_distance);
 
 	/* original paper version */
 	/*      zenith_angle=PI2-zenith_angle;
@@ -104,14 +157,14 @@ int calc_pattern(PATTERN * pattern, int row, int cur_row, int col)
 	   patterns->distance[i]=search_distance;
 	   }
 	 */
-	/* this is used to lower flat threshold if distance exceed flat_distance parameter */
-	zenith_threshold = (flat_distance > 0 &&
-			    flat_distance <
+	/* this is used to lower flat threshold if distance exceed flat_dist parameter */
+	zenith_threshold = (flat_dist > 0 &&
+			    flat_dist <
 			    zenith_distance) ? atan2(flat_threshold_height,
 						     zenith_distance) :
 	    flat_threshold;
-	nadir_threshold = (flat_distance > 0 &&
-			   flat_distance <
+	nadir_threshold = (flat_dist > 0 &&
+			   flat_dist <
 			   nadir_distance) ? atan2(flat_threshold_height,
 						   nadir_distance) :
 	    flat_threshold;
@@ -137,7 +190,7 @@ int calc_pattern(PATTERN * pattern, int row, int cur_row, int col)
 	    }
 	}
 	else {
-	    pattern->distance[i] = search_distance;
+	    pattern->distance[i] = search_dist;
 	}
 
     }				/* end for */
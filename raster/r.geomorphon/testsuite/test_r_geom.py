@@ -62,6 +62,22 @@ class TestClipling(TestCase):
         category = read_command('r.category', map=self.outele)
         self.assertEqual(first=ele_out, second=category)
 
+    def test_nprocs(self):
+        """Threaded computation gives the same results as one thread"""
+        outputs = ('forms', 'ternary', 'intensity')
+        ref = {out: '{}_ref_{}'.format(self.outele, out) for out in outputs}
+        thr = {out: '{}_thr_{}'.format(self.outele, out) for out in outputs}
+        self.runModule('r.geomorphon', elevation=self.inele, search=20,
+                       flags='e', nprocs=1, **ref)
+        self.runModule('r.geomorphon', elevation=self.inele, search=20,
+                       flags='e', nprocs=4, **thr)
+        for out in outputs:
+            self.assertRastersNoDifference(actual=thr[out],
+                                           reference=ref[out],
+                                           precision=0)
+        self.runModule('g.remove', flags='f', type='raster',
+                       name=list(ref.values()) + list(thr.values()))
+
     def test_sint(self):
         self.runModule('r.geomorphon', elevation=self.insint,
                        forms=self.outsint, search=10)
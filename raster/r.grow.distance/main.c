@@ -119,140 +119,263 @@ static void check(int row, int col, int dx, int dy)
     new_y_row[col] = y;
 }
 
-int main(int argc, char **argv)
+/* exact Euclidean distance transform (Felzenszwalb and Huttenlocher),
+ * first along the columns, then along the rows */
+
+#define BLOCK_ROWS 8
+
+struct envelope
 {
-    struct GModule *module;
-    struct
-    {
-	struct Option *in, *dist, *val, *met;
-    } opt;
-    struct
-    {
-	struct Flag *m, *n;
-    } flag;
-    const char *in_name;
-    const char *dist_name;
-    const char *val_name;
-    int in_fd;
-    int dist_fd, val_fd;
-    char *temp_name;
-    int temp_fd;
+    int *v;			/* columns of the parabolas of the lower envelope */
+    double *z;			/* boundaries between the parabolas */
+    double *h;			/* squared column distance in cell widths */
+};
+
+struct exact
+{
+    int *near;			/* row of the nearest feature in the column, -1 for none */
+    DCELL *val;			/* value of that feature, NULL if not needed */
+    DCELL **dist_rows, **val_rows;	/* output rows of a block */
+    int row0;			/* first row of the block */
+    int euclidean;
+    double scale;
+    int chunk;			/* rows per thread */
+    struct envelope *env;	/* per thread */
+};
+
+/* runs on a worker thread for the columns first to last - 1 */
+static void column_pass(int first, int last, void *closure)
+{
+    const struct exact *ex = closure;
     int row, col;
-    struct Colors colors;
-    struct History hist;
-    DCELL *out_row;
-    double scale = 1.0;
-    int invert;
 
-    G_gisinit(argv[0]);
+    /* nearest feature above ... */
+    for (row = 1; row < nrows; row++) {
+	int *cur = ex->near + (size_t)row * ncols;
+	const int *prev = cur - ncols;
+
+	for (col = first; col < last; col++) {
+	    if (cur[col] >= 0 || prev[col] < 0)
+		continue;
+	    cur[col] = prev[col];
+	    if (ex->val)
+		ex->val[(size_t)row * ncols + col] =
+		    ex->val[(size_t)(row - 1) * ncols + col];
+	}
+    }
 
-    module = G_define_module();
-    G_add_keyword(_("raster"));
-    G_add_keyword(_("distance"));
-    G_add_keyword(_("proximity"));
-    module->description =
-	_("Generates a raster map containing distances to nearest raster features.");
+    /* ... or below */
+    for (row = nrows - 2; row >= 0; row--) {
+	int *cur = ex->near + (size_t)row * ncols;
+	const int *next = cur + ncols;
+
+	for (col = first; col < last; col++) {
+	    if (next[col] < 0)
+		continue;
+	    if (cur[col] >= 0 && row - cur[col] <= next[col] - row)
+		continue;
+	    cur[col] = next[col];
+	    if (ex->val)
+		ex->val[(size_t)row * ncols + col] =
+		    ex->val[(size_t)(row + 1) * ncols + col];
+	}
+    }
+}
 
-    opt.in = G_define_standard_option(G_OPT_R_INPUT);
+/* the threads read the nearest feature row of each column, found by
+ * the column pass for the whole map, and write the distances and values
+ * of the rows they were given; the lower envelope of the parabolas of a
+ * row is built in the envelope of the thread */
+static void row_pass(int first, int last, void *closure)
+{
+    const struct exact *ex = closure;
+    const struct envelope *env = &ex->env[first / ex->chunk];
+    int *v = env->v;
+    double *z = env->z, *h = env->h;
+    int i, k, j, p, q;
+
+    for (i = first; i < last; i++) {
+	int row = ex->row0 + i;
+	const int *near = ex->near + (size_t)row * ncols;
+	DCELL *dist = ex->dist_rows ? ex->dist_rows[i] : NULL;
+	DCELL *val = ex->val_rows ? ex->val_rows[i] : NULL;
+
+	/* lower envelope of the parabolas of the columns with features */
+	k = -1;
+	for (q = 0; q < ncols; q++) {
+	    double dy, s;
+
+	    if (near[q] < 0)
+		continue;
+
+	    dy = yres * (row - near[q]);
+	    h[q] = dy * dy / (xres * xres);
+
+	    if (k < 0) {
+		k = 0;
+		v[0] = q;
+		z[0] = -HUGE_VAL;
+		continue;
+	    }
 
-    opt.dist = G_define_standard_option(G_OPT_R_OUTPUT);
-    opt.dist->key = "distance";
-    opt.dist->required = NO;
-    opt.dist->description = _("Name for distance output raster map");
-    opt.dist->guisection = _("Output");
+	    for (;;) {
+		int r = v[k];
 
-    opt.val = G_define_standard_option(G_OPT_R_OUTPUT);
-    opt.val->key = "value";
-    opt.val->required = NO;
-    opt.val->description = _("Name for value output raster map");
-    opt.val->guisection = _("Output");
+		s = (h[q] - h[r]) / (2.0 * (q - r)) + (q + r) / 2.0;
+		if (s > z[k])
+		    break;
+		k--;
+	    }
+	    k++;
+	    v[k] = q;
+	    z[k] = s;
+	}
 
-    opt.met = G_define_option();
-    opt.met->key = "metric";
-    opt.met->type = TYPE_STRING;
-    opt.met->required = NO;
-    opt.met->description = _("Metric");
-    opt.met->options = "euclidean,squared,maximum,manhattan,geodesic";
-    opt.met->answer = "euclidean";
+	if (k < 0) {
+	    /* no features */
+	    if (dist)
+		Rast_set_d_null_value(dist, ncols);
+	    if (val)
+		Rast_set_d_null_value(val, ncols);
+	    continue;
+	}
+	z[k + 1] = HUGE_VAL;
 
-    flag.m = G_define_flag();
-    flag.m->key = 'm';
-    flag.m->description = _("Output distances in meters instead of map units");
+	for (p = 0, j = 0; p < ncols; p++) {
+	    while (z[j + 1] < p)
+		j++;
+	    q = v[j];
 
-    flag.n = G_define_flag();
-    flag.n->key = 'n';
-    flag.n->description = _("Calculate distance to nearest NULL cell");
+	    if (dist) {
+		double d = distance_euclidean_squared(xres * (p - q),
+						      yres * (row - near[q]));
 
-    if (G_parser(argc, argv))
-	exit(EXIT_FAILURE);
+		if (ex->euclidean)
+		    d = sqrt(d);
+		dist[p] = d * ex->scale;
+	    }
+	    if (val)
+		val[p] = ex->val[(size_t)row * ncols + q];
+	}
+    }
+}
 
-    in_name = opt.in->answer;
-    dist_name = opt.dist->answer;
-    val_name = opt.val->answer;
+static void exact_distance(const char *in_name, int in_fd,
+			   const char *dist_name, int dist_fd,
+			   const char *val_name, int val_fd,
+			   int invert, int euclidean, double scale, int nprocs)
+{
+    struct exact ex;
+    DCELL *in_row;
+    int nblock;
+    int row, col, i;
 
-    if ((invert = flag.n->answer)) {
-	if (!dist_name)
-	    G_fatal_error(_("Distance output is required for distance to NULL cells"));
-	if (val_name) {
-	    G_warning(_("Value output is meaningless for distance to NULL cells"));
-	    val_name = NULL;
+    G_zero(&ex, sizeof(ex));
+    ex.euclidean = euclidean;
+    ex.scale = scale;
+
+    ex.near = G_malloc((size_t)nrows * ncols * sizeof(int));
+    if (val_name)
+	ex.val = G_malloc((size_t)nrows * ncols * sizeof(DCELL));
+
+    in_row = Rast_allocate_d_buf();
+
+    G_message(_("Reading raster map <%s>..."), in_name);
+    for (row = 0; row < nrows; row++) {
+	int *near = ex.near + (size_t)row * ncols;
+
+	G_percent(row, nrows, 2);
+
+	Rast_get_d_row(in_fd, in_row, row);
+
+	for (col = 0; col < ncols; col++) {
+	    if (Rast_is_d_null_value(&in_row[col]) == invert) {
+		near[col] = row;
+		if (ex.val)
+		    ex.val[(size_t)row * ncols + col] = in_row[col];
+	    }
+	    else
+		near[col] = -1;
 	}
     }
 
-    if (!dist_name && !val_name)
-	G_fatal_error(_("At least one of distance= and value= must be given"));
-
-    G_get_window(&window);
+    G_percent(row, nrows, 2);
 
-    if (strcmp(opt.met->answer, "euclidean") == 0)
-	distance = &distance_euclidean_squared;
-    else if (strcmp(opt.met->answer, "squared") == 0)
-	distance = &distance_euclidean_squared;
-    else if (strcmp(opt.met->answer, "maximum") == 0)
-	distance = &distance_maximum;
-    else if (strcmp(opt.met->answer, "manhattan") == 0)
-	distance = &distance_manhattan;
-    else if (strcmp(opt.met->answer, "geodesic") == 0) {
-	double a, e2;
-	if (window.proj != PROJECTION_LL)
-	    G_fatal_error(_("metric=geodesic is only valid for lat/lon"));
-	distance = NULL;
-	G_get_ellipsoid_parameters(&a, &e2);
-	G_begin_geodesic_distance(a, e2);
+    Rast_close(in_fd);
+    G_free(in_row);
+
+    G_message(_("Computing distances..."));
+    G_parallel_for(0, ncols, (ncols + nprocs - 1) / nprocs, column_pass, &ex);
+
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    ex.chunk = (nblock + nprocs - 1) / nprocs;
+    ex.env = G_malloc(nprocs * sizeof(struct envelope));
+    for (i = 0; i < nprocs; i++) {
+	ex.env[i].v = G_malloc(ncols * sizeof(int));
+	ex.env[i].z = G_malloc((ncols + 1) * sizeof(double));
+	ex.env[i].h = G_malloc(ncols * sizeof(double));
+    }
+    if (dist_name) {
+	ex.dist_rows = G_malloc(nblock * sizeof(DCELL *));
+	for (i = 0; i < nblock; i++)
+	    ex.dist_rows[i] = Rast_allocate_d_buf();
+    }
+    if (val_name) {
+	ex.val_rows = G_malloc(nblock * sizeof(DCELL *));
+	for (i = 0; i < nblock; i++)
+	    ex.val_rows[i] = Rast_allocate_d_buf();
     }
-    else
-	G_fatal_error(_("Unknown metric: '%s'"), opt.met->answer);
 
-    if (flag.m->answer) {
-	if (window.proj == PROJECTION_LL && 
-	    strcmp(opt.met->answer, "geodesic") != 0) {
-	    G_fatal_error(_("Output distance in meters for lat/lon is only possible with '%s=%s'"),
-	                  opt.met->key, "geodesic");
-	}
+    G_message(_("Writing output raster maps..."));
+    for (row = 0; row < nrows; row += nblock) {
+	int n = nrows - row < nblock ? nrows - row : nblock;
 
-	scale = G_database_units_to_meters_factor();
-	if (strcmp(opt.met->answer, "squared") == 0)
-	    scale *= scale;
+	G_percent(row, nrows, 2);
+
+	ex.row0 = row;
+	G_parallel_for(0, n, ex.chunk, row_pass, &ex);
+
+	for (i = 0; i < n; i++) {
+	    if (dist_name)
+		Rast_put_d_row(dist_fd, ex.dist_rows[i]);
+	    if (val_name)
+		Rast_put_d_row(val_fd, ex.val_rows[i]);
+	}
     }
 
-    in_fd = Rast_open_old(in_name, "");
+    G_percent(row, nrows, 2);
 
-    if (dist_name)
-	dist_fd = Rast_open_new(dist_name, DCELL_TYPE);
+    for (i = 0; i < nprocs; i++) {
+	G_free(ex.env[i].v);
+	G_free(ex.env[i].z);
+	G_free(ex.env[i].h);
+    }
+    G_free(ex.env);
+    for (i = 0; dist_name && i < nblock; i++)
+	G_free(ex.dist_rows[i]);
+    for (i = 0; val_name && i < nblock; i++)
+	G_free(ex.val_rows[i]);
+    G_free(ex.dist_rows);
+    G_free(ex.val_rows);
+    G_free(ex.near);
+    G_free(ex.val);
+}
 
-    if (val_name)
-	val_fd = Rast_open_new(val_name, DCELL_TYPE);
+static void propagate(const char *in_name, int in_fd,
+		      const char *dist_name, int dist_fd,
+		      const char *val_name, int val_fd,
+		      int invert, int euclidean, double scale)
+{
+    char *temp_name;
+    int temp_fd;
+    int row, col;
+    DCELL *out_row;
 
     temp_name = G_tempfile();
     temp_fd = open(temp_name, O_RDWR | O_CREAT | O_EXCL, 0700);
     if (temp_fd < 0)
 	G_fatal_error(_("Unable to create temporary file <%s>"), temp_name);
 
-    nrows = window.rows;
-    ncols = window.cols;
-    xres = window.ew_res;
-    yres = window.ns_res;
-
     in_row = Rast_allocate_d_buf();
 
     old_val_row = Rast_allocate_d_buf();
@@ -265,7 +388,7 @@ int main(int argc, char **argv)
 
     dist_row = Rast_allocate_d_buf();
 
-    if (dist_name && strcmp(opt.met->answer, "euclidean") == 0)
+    if (dist_name && euclidean)
 	out_row = Rast_allocate_d_buf();
     else
 	out_row = dist_row;
@@ -273,7 +396,7 @@ int main(int argc, char **argv)
     Rast_set_c_null_value(old_x_row, ncols);
     Rast_set_c_null_value(old_y_row, ncols);
 
-    G_message(_("Reading raster map <%s>..."), opt.in->answer);
+    G_message(_("Reading raster map <%s>..."), in_name);
     for (row = 0; row < nrows; row++) {
 	int irow = nrows - 1 - row;
 
@@ -371,6 +494,155 @@ int main(int argc, char **argv)
 
     close(temp_fd);
     remove(temp_name);
+}
+
+int main(int argc, char **argv)
+{
+    struct GModule *module;
+    struct
+    {
+	struct Option *in, *dist, *val, *met, *nprocs;
+    } opt;
+    struct
+    {
+	struct Flag *m, *n, *e;
+    } flag;
+    const char *in_name;
+    const char *dist_name;
+    const char *val_name;
+    int in_fd;
+    int dist_fd, val_fd;
+    struct Colors colors;
+    struct History hist;
+    double scale = 1.0;
+    int invert, euclidean;
+    int nprocs;
+
+    G_gisinit(argv[0]);
+
+    module = G_define_module();
+    G_add_keyword(_("raster"));
+    G_add_keyword(_("distance"));
+    G_add_keyword(_("proximity"));
+    module->description =
+	_("Generates a raster map containing distances to nearest raster features.");
+
+    opt.in = G_define_standard_option(G_OPT_R_INPUT);
+
+    opt.dist = G_define_standard_option(G_OPT_R_OUTPUT);
+    opt.dist->key = "distance";
+    opt.dist->required = NO;
+    opt.dist->description = _("Name for distance output raster map");
+    opt.dist->guisection = _("Output");
+
+    opt.val = G_define_standard_option(G_OPT_R_OUTPUT);
+    opt.val->key = "value";
+    opt.val->required = NO;
+    opt.val->description = _("Name for value output raster map");
+    opt.val->guisection = _("Output");
+
+    opt.met = G_define_option();
+    opt.met->key = "metric";
+    opt.met->type = TYPE_STRING;
+    opt.met->required = NO;
+    opt.met->description = _("Metric");
+    opt.met->options = "euclidean,squared,maximum,manhattan,geodesic";
+    opt.met->answer = "euclidean";
+
+    opt.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
+    flag.m = G_define_flag();
+    flag.m->key = 'm';
+    flag.m->description = _("Output distances in meters instead of map units");
+
+    flag.n = G_define_flag();
+    flag.n->key = 'n';
+    flag.n->description = _("Calculate distance to nearest NULL cell");
+
+    flag.e = G_define_flag();
+    flag.e->key = 'e';
+    flag.e->label = _("Use exact Euclidean distance transform");
+    flag.e->description = _("Only for metric=euclidean and metric=squared");
+
+    if (G_parser(argc, argv))
+	exit(EXIT_FAILURE);
+
+    in_name = opt.in->answer;
+    dist_name = opt.dist->answer;
+    val_name = opt.val->answer;
+
+    if ((invert = flag.n->answer)) {
+	if (!dist_name)
+	    G_fatal_error(_("Distance output is required for distance to NULL cells"));
+	if (val_name) {
+	    G_warning(_("Value output is meaningless for distance to NULL cells"));
+	    val_name = NULL;
+	}
+    }
+
+    if (!dist_name && !val_name)
+	G_fatal_error(_("At least one of distance= and value= must be given"));
+
+    G_get_window(&window);
+
+    if (strcmp(opt.met->answer, "euclidean") == 0)
+	distance = &distance_euclidean_squared;
+    else if (strcmp(opt.met->answer, "squared") == 0)
+	distance = &distance_euclidean_squared;
+    else if (strcmp(opt.met->answer, "maximum") == 0)
+	distance = &distance_maximum;
+    else if (strcmp(opt.met->answer, "manhattan") == 0)
+	distance = &distance_manhattan;
+    else if (strcmp(opt.met->answer, "geodesic") == 0) {
+	double a, e2;
+	if (window.proj != PROJECTION_LL)
+	    G_fatal_error(_("metric=geodesic is only valid for lat/lon"));
+	distance = NULL;
+	G_get_ellipsoid_parameters(&a, &e2);
+	G_begin_geodesic_distance(a, e2);
+    }
+    else
+	G_fatal_error(_("Unknown metric: '%s'"), opt.met->answer);
+
+    euclidean = strcmp(opt.met->answer, "euclidean") == 0;
+    if (flag.e->answer && !euclidean &&
+	strcmp(opt.met->answer, "squared") != 0)
+	G_fatal_error(_("The -%c flag requires %s=euclidean or %s=squared"),
+		      flag.e->key, opt.met->key, opt.met->key);
+
+    nprocs = G_set_nprocs(opt.nprocs);
+
+    if (flag.m->answer) {
+	if (window.proj == PROJECTION_LL && 
+	    strcmp(opt.met->answer, "geodesic") != 0) {
+	    G_fatal_error(_("Output distance in meters for lat/lon is only possible with '%s=%s'"),
+	                  opt.met->key, "geodesic");
+	}
+
+	scale = G_database_units_to_meters_factor();
+	if (strcmp(opt.met->answer, "squared") == 0)
+	    scale *= scale;
+    }
+
+    in_fd = Rast_open_old(in_name, "");
+
+    if (dist_name)
+	dist_fd = Rast_open_new(dist_name, DCELL_TYPE);
+
+    if (val_name)
+	val_fd = Rast_open_new(val_name, DCELL_TYPE);
+
+    nrows = window.rows;
+    ncols = window.cols;
+    xres = window.ew_res;
+    yres = window.ns_res;
+
+    if (flag.e->answer)
+	exact_distance(in_name, in_fd, dist_name, dist_fd, val_name, val_fd,
+		       invert, euclidean, scale, nprocs);
+    else
+	propagate(in_name, in_fd, dist_name, dist_fd, val_name, val_fd,
+		  invert, euclidean, scale);
 
     if (dist_name)
 	Rast_close(dist_fd);
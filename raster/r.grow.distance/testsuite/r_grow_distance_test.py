@@ -47,6 +47,15 @@ class TestGrowDistance(TestCase):
         self.assertRasterMinMax(self.distance, 0, 5322,
                                 msg='distance output not in range')
 
+    def test_grow_exact(self):
+        """Test the exact Euclidean distance transform"""
+        self.assertModule('r.grow.distance', input=self.lakes,
+                          distance=self.distance, flags='e', nprocs=2)
+        self.assertRasterExists(self.distance,
+                                msg='distance output was not created')
+        self.assertRasterMinMax(self.distance, 0, 5322,
+                                msg='distance output not in range')
+
 
 if __name__ == '__main__':
     test()
@@ -35,6 +35,7 @@ typedef struct
 	*river_head, *river_bed, *river_leak, *drain_bed, *drain_leak,
         *dt, *maxit, *innerit, *error, *solver;
     struct Flag *full_les;
+    struct Flag *stencil_les;
 } paramType;
 
 paramType param;		/*Parameters */
@@ -168,7 +169,7 @@ void set_params(void)
     param.innerit->answer = "25";
     param.error = N_define_standard_option(N_OPT_ITERATION_ERROR);
     param.solver = N_define_standard_option(N_OPT_SOLVER_SYMM);
-    param.solver->options = "cg,pcg,cholesky";
+    param.solver->options = "cg,pcg,multigrid,cholesky";
 
     param.full_les = G_define_flag();
     param.full_les->key = 'f';
@@ -176,6 +177,14 @@ void set_params(void)
     param.full_les->description = _("Allocate a full quadratic linear equation system,"
 				    " default is a sparse linear equation system.");
 
+    param.stencil_les = G_define_flag();
+    param.stencil_les->key = 's';
+    param.stencil_les->guisection = "Solver";
+    param.stencil_les->description = _("Use a matrix-free linear equation system to save memory,"
+				       " only the cg and pcg solvers are supported.");
+
+    G_option_exclusive(param.full_les, param.stencil_les, NULL);
+
 }
 
 /* ************************************************************************* */
@@ -263,6 +272,16 @@ int main(int argc, char *argv[])
 	G_fatal_error(_("The cholesky solver dos not work with sparse matrices. "
 			"You may choose a full filled quadratic matrix, flag -f."));
 
+    if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_MULTIGRID) == 0 && param.full_les->answer)
+	G_fatal_error(_("The multigrid solver works only with sparse matrices. "
+			"Remove flag -f."));
+
+    if (param.stencil_les->answer &&
+        strcmp(solver, G_MATH_SOLVER_ITERATIVE_CG) != 0 &&
+        strcmp(solver, G_MATH_SOLVER_ITERATIVE_PCG) != 0)
+	G_fatal_error(_("The matrix-free linear equation system works only "
+			"with the cg and pcg solvers."));
+
 
     /*get the current region */
     G_get_set_window(&region);
@@ -517,7 +536,9 @@ N_les *create_solve_les(N_geom_data * geom, N_gwflow_data2d * data,
     N_les *les;
 
     /*assemble the linear equation system */
-    if (!param.full_les->answer)
+    if (param.stencil_les->answer)
+        les = N_assemble_les_2d_dirichlet(N_STENCIL_LES, geom, data->status, data->phead, (void *)data, call);
+    else if (!param.full_les->answer)
         les = N_assemble_les_2d_dirichlet(N_SPARSE_LES, geom, data->status, data->phead, (void *)data, call);
     else
         les = N_assemble_les_2d_dirichlet(N_NORMAL_LES, geom, data->status, data->phead, (void *)data, call);
@@ -541,6 +562,16 @@ N_les *create_solve_les(N_geom_data * geom, N_gwflow_data2d * data,
 
         if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_PCG) == 0)
             G_math_solver_sparse_pcg(les->Asp, les->x, les->b, les->rows, maxit, error, G_MATH_DIAGONAL_PRECONDITION);
+
+        if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_MULTIGRID) == 0)
+            G_math_solver_sparse_multigrid(les->Asp, les->x, les->b, les->rows, maxit, error);
+    }
+    else if (les && les->type == N_STENCIL_LES) {
+        if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_CG) == 0)
+            N_solver_stencil_cg(les, maxit, error);
+
+        if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_PCG) == 0)
+            N_solver_stencil_pcg(les, maxit, error);
     }
     if (les == NULL)
         G_fatal_error(_("Unable to create and solve the linear equation system"));
@@ -38,6 +38,10 @@ Joint Research Centre of the European Commission, based on bits of the r.sun mod
 #include <grass/gprojects.h>
 #include <grass/glocale.h>
 
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 #define WHOLE_RASTER 1
 #define SINGLE_POINT 0
 #define RAD      (180. / M_PI)
@@ -69,7 +73,6 @@ const char *elevin;
 const char *horizon = NULL;
 const char *mapset = NULL;
 const char *per;
-char *shad_filename;
 char *outfile;
 
 struct Cell_head cellhd;
@@ -80,36 +83,50 @@ struct Cell_head new_cellhd;
 double bufferZone = 0., ebufferZone = 0., wbufferZone = 0.,
        nbufferZone = 0., sbufferZone = 0.;
 
+/* state of the search along one direction from one cell */
+struct ray
+{
+    int ip, jp, ip100, jp100;
+    double xg0, yg0, xx0, yy0;
+    double sinangle, cosangle, stepsinangle, stepcosangle;
+    double distsinangle, distcosangle;
+    double length, maxlength, tanh0;
+    double z_orig, zp;
+    double coslatsq;
+};
+
 int INPUT(void);
-int OUTGR(int numrows, int numcols);
+int OUTGR(int nmaps, const int *fd, const float *buf, int numrows,
+	  int numcols);
 double amax1(double, double);
 double amin1(double, double);
 int min(int, int);
 int max(int, int);
-void com_par(double angle);
+void com_par(struct ray *r, double angle);
 int is_shadow(void);
-double horizon_height(void);
-void calculate_shadow();
-double calculate_shadow_onedirection(double shadow_angle);
+double horizon_height(struct ray *r);
+void calculate_shadow(struct ray *r);
+double calculate_shadow_onedirection(struct ray *r, double shadow_angle);
 
-int new_point();
-double searching();
-int test_low_res();
+int new_point(struct ray *r);
+double searching(struct ray *r);
+int test_low_res(struct ray *r);
 
 /*void where_is_point();
    void cube(int, int);
  */
 
+void calculate_cell(int j, int i, int ndir, const double *angles,
+		    float *out, size_t stride);
 void calculate(double xcoord, double ycoord, int buffer_e, int buffer_w,
 	       int buffer_s, int buffer_n);
 
 
-int ip, jp, ip100, jp100;
 int n, m, m100, n100;
 int degreeOutput, compassOutput = FALSE;
-float **z, **z100, **horizon_raster;
-double stepx, stepy, stepxhalf, stepyhalf, stepxy, xp, yp, op, dp, xg0, xx0,
-    yg0, yy0, deltx, delty;
+float **z, **z100;
+double stepx, stepy, stepxhalf, stepyhalf, stepxy, xp, yp, op, dp,
+    deltx, delty;
 double invstepx, invstepy, distxy;
 double offsetx, offsety;
 double single_direction;
@@ -118,14 +135,12 @@ double single_direction;
 double xmin, xmax, ymin, ymax, zmax = 0.;
 int d, day, tien = 0;
 
-double length, maxlength = BIG, zmult = 1.0, dist;
+double zmult = 1.0, dist;
 double fixedMaxLength = BIG, step = 0.0, start = 0.0, end = 0.0;
 char *tt, *lt;
-double z_orig, zp;
-double h0, tanh0, angle;
-double stepsinangle, stepcosangle, sinangle, cosangle, distsinangle,
-    distcosangle;
+double h0;
 double TOLER;
+int memory_mb = 300;
 const char *str_step;
 
 int mode;
@@ -139,15 +154,15 @@ void setMode(int val)
 }
 
 int ll_correction = FALSE;
-double coslatsq;
 
 
 /* why not use G_distance() here which switches to geodesic/great
   circle distance as needed? */
-double distance(double x1, double x2, double y1, double y2)
+double distance(const struct ray *r, double x1, double x2, double y1,
+		double y2)
 {
     if (ll_correction) {
-	return DEGREEINMETERS * sqrt(coslatsq * (x1 - x2) * (x1 - x2)
+	return DEGREEINMETERS * sqrt(r->coslatsq * (x1 - x2) * (x1 - x2)
 				     + (y1 - y2) * (y1 - y2));
     }
     else {
@@ -159,13 +174,15 @@ double distance(double x1, double x2, double y1, double y2)
 int main(int argc, char *argv[])
 {
     double xcoord, ycoord;
+    int threads;
 
     struct GModule *module;
     struct
     {
 	struct Option *elevin, *dist, *coord, *direction, *horizon, 
                       *step, *start, *end, *bufferzone, *e_buff, *w_buff, 
-                      *n_buff, *s_buff, *maxdistance, *output;
+                      *n_buff, *s_buff, *maxdistance, *output, *memory,
+                      *nprocs;
     } parm;
 
     struct
@@ -303,6 +320,17 @@ int main(int argc, char *argv[])
         _("Name of file for output (use output=- for stdout)");
     parm.output->guisection = _("Point mode");
 
+    parm.memory = G_define_option();
+    parm.memory->key = "memory";
+    parm.memory->type = TYPE_INTEGER;
+    parm.memory->required = NO;
+    parm.memory->answer = "300";
+    parm.memory->description =
+	_("Maximum memory to be used for the buffered output rows (in MB)");
+    parm.memory->guisection = _("Raster mode");
+
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.degreeOutput = G_define_flag();
     flag.degreeOutput->key = 'd';
     flag.degreeOutput->description =
@@ -317,6 +345,18 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    threads = G_set_nprocs(parm.nprocs);
+#if defined(_OPENMP)
+    omp_set_num_threads(threads);
+#else
+    threads = 1;
+#endif
+    G_verbose_message(_("Number of threads <%d>"), threads);
+
+    if (sscanf(parm.memory->answer, "%d", &memory_mb) != 1 || memory_mb <= 0)
+	G_fatal_error(_("Invalid value for %s: %s"), parm.memory->key,
+		      parm.memory->answer);
+
     G_get_set_window(&cellhd);
 
     stepx = cellhd.ew_res;
@@ -638,43 +678,30 @@ int INPUT(void)
 
 
 
-int OUTGR(int numrows, int numcols)
+/* write a block of rows, each holding one row of every output map */
+int OUTGR(int nmaps, const int *fd, const float *buf, int numrows,
+	  int numcols)
 {
-    FCELL *cell1 = NULL;
-
-    int fd1 = 0;
-    int i, iarc, j;
-
-    Rast_set_window(&cellhd);
-
-    if (horizon != NULL) {
-	cell1 = Rast_allocate_f_buf();
-	fd1 = Rast_open_fp_new(shad_filename);
-    }
-
-    if (numrows != Rast_window_rows())
-	G_fatal_error(_("OOPS: rows changed from %d to %d"), numrows,
-		      Rast_window_rows());
-
-    if (numcols != Rast_window_cols())
-	G_fatal_error(_("OOPS: cols changed from %d to %d"), numcols,
-		      Rast_window_cols());
+    FCELL *cell1;
+    const float *row;
+    int i, j, k;
 
-    for (iarc = 0; iarc < numrows; iarc++) {
-	i = numrows - iarc - 1;
+    cell1 = Rast_allocate_f_buf();
 
-	if (horizon != NULL) {
+    for (i = 0; i < numrows; i++) {
+	for (k = 0; k < nmaps; k++) {
+	    row = buf + ((size_t)i * nmaps + k) * numcols;
 	    for (j = 0; j < numcols; j++) {
-		if (horizon_raster[i][j] == UNDEFZ)
+		if (row[j] == UNDEFZ)
 		    Rast_set_f_null_value(cell1 + j, 1);
 		else
-		    cell1[j] = (FCELL) horizon_raster[i][j];
+		    cell1[j] = (FCELL) row[j];
 	    }
-	    Rast_put_f_row(fd1, cell1);
+	    Rast_put_f_row(fd[k], cell1);
 	}
     }				/* End loop over rows. */
 
-    Rast_close(fd1);
+    G_free(cell1);
 
     return 1;
 }
@@ -745,56 +772,56 @@ int max(arg1, arg2)
 
 /**********************************************************/
 
-void com_par(double angle)
+void com_par(struct ray *r, double angle)
 {
-    sinangle = sin(angle);
-    if (fabs(sinangle) < 0.0000001) {
-	sinangle = 0.;
+    r->sinangle = sin(angle);
+    if (fabs(r->sinangle) < 0.0000001) {
+	r->sinangle = 0.;
     }
-    cosangle = cos(angle);
-    if (fabs(cosangle) < 0.0000001) {
-	cosangle = 0.;
+    r->cosangle = cos(angle);
+    if (fabs(r->cosangle) < 0.0000001) {
+	r->cosangle = 0.;
     }
-    distsinangle = 32000;
-    distcosangle = 32000;
+    r->distsinangle = 32000;
+    r->distcosangle = 32000;
 
-    if (sinangle != 0.) {
-	distsinangle = 100. / (distxy * sinangle);
+    if (r->sinangle != 0.) {
+	r->distsinangle = 100. / (distxy * r->sinangle);
     }
-    if (cosangle != 0.) {
-	distcosangle = 100. / (distxy * cosangle);
+    if (r->cosangle != 0.) {
+	r->distcosangle = 100. / (distxy * r->cosangle);
     }
 
-    stepsinangle = stepxy * sinangle;
-    stepcosangle = stepxy * cosangle;
+    r->stepsinangle = stepxy * r->sinangle;
+    r->stepcosangle = stepxy * r->cosangle;
 }
 
-double horizon_height(void)
+double horizon_height(struct ray *r)
 {
     double height;
 
-    tanh0 = -1.0 / 0.0;  /* -inf */
-    length = 0;
+    r->tanh0 = -1.0 / 0.0;  /* -inf */
+    r->length = 0;
 
-    height = searching();
+    height = searching(r);
 
-    xx0 = xg0;
-    yy0 = yg0;
+    r->xx0 = r->xg0;
+    r->yy0 = r->yg0;
 
     return height;
 }
 
 
-double calculate_shadow_onedirection(double shadow_angle)
+double calculate_shadow_onedirection(struct ray *r, double shadow_angle)
 {
-    shadow_angle = horizon_height();
+    shadow_angle = horizon_height(r);
 
     return shadow_angle;
 }
 
 
 
-void calculate_shadow()
+void calculate_shadow(struct ray *r)
 {
     double dfr_rad;
 
@@ -820,23 +847,23 @@ void calculate_shadow()
 
     dfr_rad = step * deg2rad;
 
-    xp = xmin + xx0;
-    yp = ymin + yy0;
+    xp = xmin + r->xx0;
+    yp = ymin + r->yy0;
 
     angle = (single_direction * deg2rad) + pihalf;
 
-    maxlength = fixedMaxLength;
+    r->maxlength = fixedMaxLength;
     fprintf(fp, "azimuth,horizon_height\n");
 
     for (i = 0; i < printCount; i++) {
 
-	ip = jp = 0;
+	r->ip = r->jp = 0;
 
 
-	sx = xx0 * invstepx;
-	sy = yy0 * invstepy;
-	ip100 = floor(sx / 100.);
-	jp100 = floor(sy / 100.);
+	sx = r->xx0 * invstepx;
+	sy = r->yy0 * invstepy;
+	r->ip100 = floor(sx / 100.);
+	r->jp100 = floor(sy / 100.);
 
 
 	if ((G_projection() != PROJECTION_LL)) {
@@ -871,10 +898,10 @@ void calculate_shadow()
 
 	delt_dist = sqrt(delt_east * delt_east + delt_nor * delt_nor);
 
-	stepsinangle = stepxy * delt_nor / delt_dist;
-	stepcosangle = stepxy * delt_east / delt_dist;
+	r->stepsinangle = stepxy * delt_nor / delt_dist;
+	r->stepcosangle = stepxy * delt_east / delt_dist;
 
-	shadow_angle = horizon_height();
+	shadow_angle = horizon_height(r);
 
 	if (degreeOutput) {
 	    shadow_angle *= rad2deg;
@@ -908,19 +935,21 @@ void calculate_shadow()
 /*////////////////////////////////////////////////////////////////////// */
 
 
-int new_point()
+int new_point(struct ray *r)
 {
     int iold, jold;
     int succes = 1, succes2 = 1;
     double sx, sy;
     double dx, dy;
+    double xx0 = r->xx0, yy0 = r->yy0;
+    int ip, jp;
 
-    iold = ip;
-    jold = jp;
+    iold = r->ip;
+    jold = r->jp;
 
     while (succes) {
-	yy0 += stepsinangle;
-	xx0 += stepcosangle;
+	yy0 += r->stepsinangle;
+	xx0 += r->stepcosangle;
 
 
 	/* offset 0.5 cell size to get the right cell i, j */
@@ -930,83 +959,94 @@ int new_point()
 	jp = (int)sy;
 
 	/* test outside of raster */
-	if ((ip < 0) || (ip >= n) || (jp < 0) || (jp >= m))
+	if ((ip < 0) || (ip >= n) || (jp < 0) || (jp >= m)) {
+	    r->xx0 = xx0;
+	    r->yy0 = yy0;
+	    r->ip = ip;
+	    r->jp = jp;
 	    return (3);
+	}
 
 	if ((ip != iold) || (jp != jold)) {
 	    dx = (double)ip *stepx;
 	    dy = (double)jp *stepy;
 
-	    length = distance(xg0, dx, yg0, dy);  /* dist from orig. grid point to the current grid point */
-	    succes2 = test_low_res();
+	    r->xx0 = xx0;
+	    r->yy0 = yy0;
+	    r->ip = ip;
+	    r->jp = jp;
+	    r->length = distance(r, r->xg0, dx, r->yg0, dy);  /* dist from orig. grid point to the current grid point */
+	    succes2 = test_low_res(r);
 	    if (succes2 == 1) {
-		zp = z[jp][ip];
+		r->zp = z[jp][ip];
 		return (1);
 	    }
+	    xx0 = r->xx0;
+	    yy0 = r->yy0;
 	}
     }
     return -1;
 }
 
 
-int test_low_res()
+int test_low_res(struct ray *r)
 {
     int iold100, jold100;
     double sx, sy;
     int delx, dely, mindel;
     double zp100, z2, curvature_diff;
 
-    iold100 = ip100;
-    jold100 = jp100;
-    ip100 = floor(ip / 100.);
-    jp100 = floor(jp / 100.);
+    iold100 = r->ip100;
+    jold100 = r->jp100;
+    r->ip100 = floor(r->ip / 100.);
+    r->jp100 = floor(r->jp / 100.);
     /*test the new position with low resolution */
-    if ((ip100 != iold100) || (jp100 != jold100)) {
-	G_debug(2,"ip:%d jp:%d iold100:%d jold100:%d\n",ip,jp, iold100,jold100);
+    if ((r->ip100 != iold100) || (r->jp100 != jold100)) {
+	G_debug(2,"ip:%d jp:%d iold100:%d jold100:%d\n",r->ip,r->jp, iold100,jold100);
 	/*  replace with approximate version
 	   curvature_diff = EARTHRADIUS*(1.-cos(length/EARTHRADIUS));
 	 */
-	curvature_diff = 0.5 * length * length * invEarth;
-	z2 = z_orig + curvature_diff + length * tanh0;
-	zp100 = z100[jp100][ip100];
-	G_debug(2,"ip:%d jp:%d z2:%lf zp100:%lf \n",ip,jp,z2,zp100);
+	curvature_diff = 0.5 * r->length * r->length * invEarth;
+	z2 = r->z_orig + curvature_diff + r->length * r->tanh0;
+	zp100 = z100[r->jp100][r->ip100];
+	G_debug(2,"ip:%d jp:%d z2:%lf zp100:%lf \n",r->ip,r->jp,z2,zp100);
 
 	if (zp100 <= z2)
 	    /*skip to the next lowres cell */
 	{
 	    delx = 32000;
 	    dely = 32000;
-	    if (cosangle > 0.) {
-		sx = xx0 * invstepx + offsetx;
+	    if (r->cosangle > 0.) {
+		sx = r->xx0 * invstepx + offsetx;
 		delx =
 		    floor(fabs
-			  ((ceil(sx / 100.) - (sx / 100.)) * distcosangle));
+			  ((ceil(sx / 100.) - (sx / 100.)) * r->distcosangle));
 	    }
-	    if (cosangle < 0.) {
-		sx = xx0 * invstepx + offsetx;
+	    if (r->cosangle < 0.) {
+		sx = r->xx0 * invstepx + offsetx;
 		delx =
 		    floor(fabs
-			  ((floor(sx / 100.) - (sx / 100.)) * distcosangle));
+			  ((floor(sx / 100.) - (sx / 100.)) * r->distcosangle));
 	    }
-	    if (sinangle > 0.) {
-		sy = yy0 * invstepy + offsety;
+	    if (r->sinangle > 0.) {
+		sy = r->yy0 * invstepy + offsety;
 		dely =
 		    floor(fabs
-			  ((ceil(sy / 100.) - (sy / 100.)) * distsinangle));
+			  ((ceil(sy / 100.) - (sy / 100.)) * r->distsinangle));
 	    }
-	    else if (sinangle < 0.) {
-		sy = yy0 * invstepy + offsety;
+	    else if (r->sinangle < 0.) {
+		sy = r->yy0 * invstepy + offsety;
 		dely =
 		    floor(fabs
-			  ((floor(jp / 100.) - (sy / 100.)) * distsinangle));
+			  ((floor(r->jp / 100.) - (sy / 100.)) * r->distsinangle));
 	    }
 
 	    mindel = min(delx, dely);
-	    G_debug(2,"%d %d %d %lf %lf\n",ip, jp, mindel,xg0, yg0);
+	    G_debug(2,"%d %d %d %lf %lf\n",r->ip, r->jp, mindel,r->xg0, r->yg0);
 
-	    yy0 = yy0 + (mindel * stepsinangle);
-	    xx0 = xx0 + (mindel * stepcosangle);
-	    G_debug(2,"  %lf %lf\n",xx0,yy0);
+	    r->yy0 = r->yy0 + (mindel * r->stepsinangle);
+	    r->xx0 = r->xx0 + (mindel * r->stepcosangle);
+	    G_debug(2,"  %lf %lf\n",r->xx0,r->yy0);
 
 	    return (3);
 	}
@@ -1020,29 +1060,29 @@ int test_low_res()
 }
 
 
-double searching()
+double searching(struct ray *r)
 {
     double z2;
     double curvature_diff;
     int succes = 1;
 
-    if (zp == UNDEFZ)
+    if (r->zp == UNDEFZ)
 	return 0;
 
     while (1) {
-	succes = new_point();
+	succes = new_point(r);
 
 	if (succes != 1) {
 	    break;
 	}
 
 	/* curvature_diff = EARTHRADIUS*(1.-cos(length/EARTHRADIUS)); */
-	curvature_diff = 0.5 * length * length * invEarth;
+	curvature_diff = 0.5 * r->length * r->length * invEarth;
 
-	z2 = z_orig + curvature_diff + length * tanh0;
+	z2 = r->z_orig + curvature_diff + r->length * r->tanh0;
 
-	if (z2 < zp) {
-	    tanh0 = (zp - z_orig - curvature_diff) / length;
+	if (z2 < r->zp) {
+	    r->tanh0 = (r->zp - r->z_orig - curvature_diff) / r->length;
 	}
 
 
@@ -1050,43 +1090,141 @@ double searching()
 	    break;
 	}
 
-	if (length >= maxlength) {
+	if (r->length >= r->maxlength) {
 	    break;
 	}
 
     }
 
-    return atan(tanh0);
+    return atan(r->tanh0);
 }
 
 
 
 /*////////////////////////////////////////////////////////////////////// */
 
-void calculate(double xcoord, double ycoord, int buffer_e, int buffer_w,
-	       int buffer_s, int buffer_n)
+/* horizon heights of one cell in all directions, direction k
+   is stored in out[k * stride] */
+void calculate_cell(int j, int i, int ndir, const double *angles,
+		    float *out, size_t stride)
 {
-    int i, j, l, k = 0;
-    size_t decimals;
-
-    int xindex, yindex;
+    struct ray r;
+    int k;
     double shadow_angle;
     double coslat;
-
-    double latitude, longitude;
     double xp, yp;
+    double latitude, longitude, lat0, lon0;
     double inputAngle;
     double delt_lat, delt_lon;
     double delt_east, delt_nor;
     double delt_dist;
 
+    r.xg0 = r.xx0 = (double)i * stepx;
+    xp = xmin + r.xx0;
+    r.yg0 = r.yy0 = (double)j * stepy;
+    yp = ymin + r.yy0;
+
+    r.coslatsq = 0.;
+    if (ll_correction) {
+	coslat = cos(deg2rad * yp);
+	r.coslatsq = coslat * coslat;
+    }
+
+    r.z_orig = z[j][i];
+    if (r.z_orig == UNDEFZ) {
+	for (k = 0; k < ndir; k++)
+	    out[k * stride] = 0.;
+	return;
+    }
+    r.maxlength = (zmax - r.z_orig) / TANMINANGLE;
+    r.maxlength =
+	(r.maxlength < fixedMaxLength) ? r.maxlength : fixedMaxLength;
+
+    /* the position of the cell does not depend on the direction */
+    lon0 = xp;
+    lat0 = yp;
+
+    if (GPJ_transform(&iproj, &oproj, &tproj, PJ_FWD,
+		      &lon0, &lat0, NULL) < 0)
+	G_fatal_error(_("Error in %s"), "GPJ_transform()");
+
+    lat0 *= deg2rad;
+    lon0 *= deg2rad;
+
+    G_debug(4, "**************new line %d %d\n", i, j);
+
+    for (k = 0; k < ndir; k++) {
+	inputAngle = angles[k] + pihalf;
+	inputAngle = (inputAngle >= twopi) ? inputAngle - twopi : inputAngle;
+
+	delt_lat = -0.0001 * cos(inputAngle);  /* Arbitrary small distance in latitude */
+	delt_lon = 0.0001 * sin(inputAngle) / cos(lat0);
+
+	latitude = (lat0 + delt_lat) * rad2deg;
+	longitude = (lon0 + delt_lon) * rad2deg;
+
+	if (!ll_correction) {
+	    if (GPJ_transform(&iproj, &oproj, &tproj, PJ_INV,
+			      &longitude, &latitude, NULL) < 0)
+		G_fatal_error(_("Error in %s"), "GPJ_transform()");
+	}
+
+	delt_east = longitude - xp;
+	delt_nor = latitude - yp;
+
+	delt_dist = sqrt(delt_east * delt_east + delt_nor * delt_nor);
+
+	r.sinangle = delt_nor / delt_dist;
+	if (fabs(r.sinangle) < 0.0000001) {
+	    r.sinangle = 0.;
+	}
+	r.cosangle = delt_east / delt_dist;
+	if (fabs(r.cosangle) < 0.0000001) {
+	    r.cosangle = 0.;
+	}
+	r.distsinangle = 32000;
+	r.distcosangle = 32000;
+
+	if (r.sinangle != 0.) {
+	    r.distsinangle = 100. / (distxy * r.sinangle);
+	}
+	if (r.cosangle != 0.) {
+	    r.distcosangle = 100. / (distxy * r.cosangle);
+	}
+
+	r.stepsinangle = stepxy * r.sinangle;
+	r.stepcosangle = stepxy * r.cosangle;
+
+	r.ip = r.jp = 0;
+	r.ip100 = floor(i / 100.);
+	r.jp100 = floor(j / 100.);
+	r.zp = r.z_orig;
+
+	shadow_angle = horizon_height(&r);
+
+	if (degreeOutput) {
+	    shadow_angle *= rad2deg;
+	}
+
+	out[k * stride] = shadow_angle;
+    }
+}
+
+
+void calculate(double xcoord, double ycoord, int buffer_e, int buffer_w,
+	       int buffer_s, int buffer_n)
+{
+    int k = 0;
+    size_t decimals;
+
+    int xindex, yindex;
+    double coslat;
+
     char msg_buff[256];
 
-    int hor_row_start = buffer_s;
     int hor_row_end = m - buffer_n;
 
     int hor_col_start = buffer_w;
-    int hor_col_end = n - buffer_e;
 
     int hor_numrows = m - (buffer_s + buffer_n);
     int hor_numcols = n - (buffer_e + buffer_w);
@@ -1104,6 +1242,9 @@ void calculate(double xcoord, double ycoord, int buffer_e, int buffer_w,
 
     if (isMode() == SINGLE_POINT) {
 	/* Calculate the horizon for one single point */
+	struct ray r;
+
+	G_zero(&r, sizeof(r));
 
 	/* 
 	   xg0 = xx0 = (double)xcoord * stepx;
@@ -1113,46 +1254,35 @@ void calculate(double xcoord, double ycoord, int buffer_e, int buffer_w,
 	   xg0 = xx0 = xindex*stepx -0.5*stepx;
 	   yg0 = yy0 = yindex*stepy -0.5*stepy;
 	 */
-	xg0 = xx0 = xindex * stepx;
-	yg0 = yy0 = yindex * stepy;
+	r.xg0 = r.xx0 = xindex * stepx;
+	r.yg0 = r.yy0 = yindex * stepy;
 
 
 	if (ll_correction) {
-	    coslat = cos(deg2rad * (ymin + yy0));
-	    coslatsq = coslat * coslat;
+	    coslat = cos(deg2rad * (ymin + r.yy0));
+	    r.coslatsq = coslat * coslat;
 	}
 
-	z_orig = zp = z[yindex][xindex];
-	G_debug(1, "yindex: %d, xindex %d, z_orig %.2f", yindex, xindex, z_orig);
+	r.z_orig = r.zp = z[yindex][xindex];
+	G_debug(1, "yindex: %d, xindex %d, z_orig %.2f", yindex, xindex,
+		r.z_orig);
 
-	calculate_shadow();
+	calculate_shadow(&r);
         fclose(fp);
 
     }
     else {
-
-	/****************************************************************/
-	/*  The loop over raster points starts here!                    */
-	/****************************************************************/
-
-	if (horizon != NULL) {
-	    horizon_raster = (float **)G_malloc(sizeof(float *) * (hor_numrows));
-	    for (l = 0; l < hor_numrows; l++) {
-		horizon_raster[l] =
-		    (float *)G_malloc(sizeof(float) * (hor_numcols));
-	    }
-
-	    for (j = 0; j < hor_numrows; j++) {
-		for (i = 0; i < hor_numcols; i++)
-		    horizon_raster[j][i] = 0.;
-	    }
-	}
+	double *angles;
+	char **names;
+	int *fd;
+	float *buf;
+	size_t block_rows, row_size;
+	int row0, nrows;
 
 	/* definition of horizon angle in loop */
 	if (step == 0.0) {
 	    dfr_rad = 0;
 	    arrayNumInt = 1;
-	    sprintf(shad_filename, "%s", horizon);
 	}
 	else {
 	    dfr_rad = step * deg2rad;
@@ -1161,149 +1291,91 @@ void calculate(double xcoord, double ycoord, int buffer_e, int buffer_w,
 
         decimals = G_get_num_decimals(str_step);
 
-	for (k = 0; k < arrayNumInt; k++) {
-	   struct History history; 
+	angles = (double *)G_malloc(sizeof(double) * arrayNumInt);
+	names = (char **)G_malloc(sizeof(char *) * arrayNumInt);
+	fd = (int *)G_malloc(sizeof(int) * arrayNumInt);
 
-	    angle = (start + single_direction) * deg2rad + (dfr_rad * k);
-            angle_deg = angle * rad2deg + 0.0001;
+	/* all maps are written in one pass over the elevation model */
+	Rast_set_window(&cellhd);
+
+	if (hor_numrows != Rast_window_rows())
+	    G_fatal_error(_("OOPS: rows changed from %d to %d"), hor_numrows,
+			  Rast_window_rows());
+
+	if (hor_numcols != Rast_window_cols())
+	    G_fatal_error(_("OOPS: cols changed from %d to %d"), hor_numcols,
+			  Rast_window_cols());
+
+	for (k = 0; k < arrayNumInt; k++) {
+	    angles[k] = (start + single_direction) * deg2rad + (dfr_rad * k);
+            angle_deg = angles[k] * rad2deg + 0.0001;
 
             if (step != 0.0)
-                 shad_filename = G_generate_basename(horizon, angle_deg, 3, decimals);
-
-	    /*              
-	       com_par(angle);
-	     */
-	    G_message(_("Calculating map %01d of %01d (angle %.2f, raster map <%s>)"),
-		     (k + 1), arrayNumInt, angle_deg, shad_filename);
-
-	    for (j = hor_row_start; j < hor_row_end; j++) {
-		G_percent(j - hor_row_start, hor_numrows - 1, 2);
-		shadow_angle = 15 * deg2rad;
-		for (i = hor_col_start; i < hor_col_end; i++) {
-		    ip100 = floor(i / 100.);
-		    jp100 = floor(j / 100.);
-		    ip = jp = 0;
-		    xg0 = xx0 = (double)i *stepx;
-
-		    xp = xmin + xx0;
-		    yg0 = yy0 = (double)j *stepy;
-
-		    yp = ymin + yy0;
-		    length = 0;
-		    if (ll_correction) {
-			coslat = cos(deg2rad * yp);
-			coslatsq = coslat * coslat;
-		    }
-
-		    longitude = xp;
-		    latitude = yp;
-
-		    if (GPJ_transform(&iproj, &oproj, &tproj, PJ_FWD,
-				      &longitude, &latitude, NULL) < 0)
-			G_fatal_error(_("Error in %s"), "GPJ_transform()");
-
-		    latitude *= deg2rad;
-		    longitude *= deg2rad;
-
-		    inputAngle = angle + pihalf;
-		    inputAngle =
-			(inputAngle >=
-			 twopi) ? inputAngle - twopi : inputAngle;
-
-
-		    delt_lat = -0.0001 * cos(inputAngle);  /* Arbitrary small distance in latitude */
-		    delt_lon = 0.0001 * sin(inputAngle) / cos(latitude);
-
-		    latitude = (latitude + delt_lat) * rad2deg;
-		    longitude = (longitude + delt_lon) * rad2deg;
-
-		    if ((G_projection() != PROJECTION_LL)) {
-			if (GPJ_transform(&iproj, &oproj, &tproj, PJ_INV,
-					  &longitude, &latitude, NULL) < 0)
-			    G_fatal_error(_("Error in %s"), "GPJ_transform()");
-		    }
-
-		    delt_east = longitude - xp;
-		    delt_nor = latitude - yp;
-
-		    delt_dist =
-			sqrt(delt_east * delt_east + delt_nor * delt_nor);
-
-		    sinangle = delt_nor / delt_dist;
-		    if (fabs(sinangle) < 0.0000001) {
-			sinangle = 0.;
-		    }
-		    cosangle = delt_east / delt_dist;
-		    if (fabs(cosangle) < 0.0000001) {
-			cosangle = 0.;
-		    }
-		    distsinangle = 32000;
-		    distcosangle = 32000;
-
-		    if (sinangle != 0.) {
-			distsinangle = 100. / (distxy * sinangle);
-		    }
-		    if (cosangle != 0.) {
-			distcosangle = 100. / (distxy * cosangle);
-		    }
-
-		    stepsinangle = stepxy * sinangle;
-		    stepcosangle = stepxy * cosangle;
-
-
-		    z_orig = zp = z[j][i];
-		    maxlength = (zmax - z_orig) / TANMINANGLE;
-		    maxlength =
-			(maxlength < fixedMaxLength) ? maxlength : fixedMaxLength;
-
-		    if (z_orig != UNDEFZ) {
-
-			G_debug(4,"**************new line %d %d\n", i, j);
-			shadow_angle = horizon_height();
-
-			if (degreeOutput) {
-			    shadow_angle *= rad2deg;
-			}
-
-			/*
-			   if((j==1400)&&(i==1400))
-			   {
-			   G_debug(1, "coordinates=%f,%f, raster no. %d, horizon=%f\n",
-			   xp, yp, k, shadow_angle);
-			   }
-			 */
-			horizon_raster[j - buffer_s][i - buffer_w] =
-			    shadow_angle;
-
-		    }	/* undefs */
-		}
-	    }
+                 names[k] = G_generate_basename(horizon, angle_deg, 3, decimals);
+	    else
+		names[k] = G_store(horizon);
 
-        G_debug(1, "OUTGR() starts...");
-	    OUTGR(cellhd.rows, cellhd.cols);
+	    G_verbose_message(_("Map %01d of %01d (angle %.2f, raster map <%s>)"),
+			      (k + 1), arrayNumInt, angle_deg, names[k]);
+	    fd[k] = Rast_open_fp_new(names[k]);
+	}
 
-	    /* empty array */
-	    for (j = 0; j < hor_numrows; j++) {
-		for (i = 0; i < hor_numcols; i++)
-		    horizon_raster[j][i] = 0.;
+	/* rows of all maps are buffered together within the memory limit */
+	row_size = sizeof(float) * arrayNumInt * hor_numcols;
+	block_rows = (size_t)memory_mb * 1024 * 1024 / row_size;
+	if (block_rows < 1)
+	    block_rows = 1;
+	if (block_rows > (size_t)hor_numrows)
+	    block_rows = hor_numrows;
+	buf = (float *)G_malloc(row_size * block_rows);
+	G_debug(1, "%lu rows of %d maps buffered", (unsigned long)block_rows,
+		arrayNumInt);
+
+	G_message(_("Calculating %d horizon raster maps..."), arrayNumInt);
+
+	for (row0 = 0; row0 < hor_numrows; row0 += nrows) {
+	    long cell, ncells;
+
+	    nrows = min(block_rows, hor_numrows - row0);
+	    ncells = (long)nrows * hor_numcols;
+	    G_percent(row0, hor_numrows, 2);
+
+	    /* output rows start in the north, z starts in the south */
+#pragma omp parallel for schedule(dynamic, 16)
+	    for (cell = 0; cell < ncells; cell++) {
+		int l = cell / hor_numcols;
+		int i = cell % hor_numcols;
+
+		calculate_cell(hor_row_end - 1 - (row0 + l),
+			       hor_col_start + i, arrayNumInt, angles,
+			       buf + (size_t)l * arrayNumInt * hor_numcols + i,
+			       hor_numcols);
 	    }
 
-	    /* return back the buffered region */
-	    if (bufferZone > 0.)
-		Rast_set_window(&new_cellhd);
+	    G_debug(1, "OUTGR() starts...");
+	    OUTGR(arrayNumInt, fd, buf, nrows, hor_numcols);
+	}
+	G_percent(1, 1, 1);
+
+	G_free(buf);
+
+	for (k = 0; k < arrayNumInt; k++) {
+	    struct History history; 
+
+	    Rast_close(fd[k]);
 
 	    /* write metadata */
-	    Rast_short_history(shad_filename, "raster", &history);
+	    Rast_short_history(names[k], "raster", &history);
 
 	    sprintf(msg_buff,
 		    "Angular height of terrain horizon, map %01d of %01d",
 		    (k + 1), arrayNumInt);
-	    Rast_put_cell_title(shad_filename, msg_buff);
+	    Rast_put_cell_title(names[k], msg_buff);
 
 	    if (degreeOutput)
-		Rast_write_units(shad_filename, "degrees");
+		Rast_write_units(names[k], "degrees");
 	    else
-		Rast_write_units(shad_filename, "radians");
+		Rast_write_units(names[k], "radians");
 
 	    Rast_command_history(&history);
 
@@ -1313,10 +1385,14 @@ void calculate(double xcoord, double ycoord, int buffer_e, int buffer_w,
 	    Rast_append_format_history(
 		&history,
 		"Horizon view from azimuth angle %.2f degrees CCW from East",
-		angle * rad2deg);
+		angles[k] * rad2deg);
 
-	    Rast_write_history(shad_filename, &history);
-            G_free(shad_filename);
+	    Rast_write_history(names[k], &history);
+            G_free(names[k]);
 	}
+
+	G_free(names);
+	G_free(fd);
+	G_free(angles);
     }
 }
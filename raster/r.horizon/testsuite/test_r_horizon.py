@@ -127,6 +127,20 @@ class TestHorizon(TestCase):
         stdout = module_list.outputs.stdout.strip()
         self.assertMultiLineEqual(first="test_horizon_output_from_elevation_090_000\ntest_horizon_output_from_elevation_105_512", second=stdout)
 
+    def test_raster_mode_threads(self):
+        """Test that threads and small row blocks give the same maps"""
+        module = SimpleModule('r.horizon', elevation='elevation',
+                              output=self.horizon_output, start=10, end=190, step=90)
+        self.assertModule(module)
+        module = SimpleModule('r.horizon', elevation='elevation',
+                              output=self.horizon_output + '_threads', start=10, end=190, step=90,
+                              nprocs=4, memory=1)
+        self.assertModule(module)
+        for angle in ('010', '100'):
+            self.assertRastersNoDifference(self.horizon_output + '_' + angle,
+                                           self.horizon_output + '_threads_' + angle,
+                                           precision=0)
+
 
 if __name__ == '__main__':
     test()
@@ -2,3 +2,11 @@
 int gethead(FILE *, struct Cell_head *, RASTER_MAP_TYPE *, DCELL *, char **);
 int getgrdhead(FILE *, struct Cell_head *);
 int file_scan(FILE *);
+
+/* parse.c */
+struct ascii_reader;
+struct ascii_reader *ascii_reader_open(FILE *, int, RASTER_MAP_TYPE, DCELL,
+				       const char *);
+int ascii_reader_get_rows(struct ascii_reader *, void *, int);
+int ascii_reader_pending(const struct ascii_reader *);
+void ascii_reader_close(struct ascii_reader *);
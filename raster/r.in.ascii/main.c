@@ -44,15 +44,14 @@ int main(int argc, char *argv[])
     int cf, direction, sz;
     struct Cell_head cellhd;
     struct History history;
-    void *rast, *rast_ptr;
-    int row, col;
+    void *rast;
+    int row;
     int nrows, ncols;
-    double x;
-    char y[128];
+    struct ascii_reader *reader;
     struct GModule *module;
     struct
     {
-	struct Option *input, *output, *title, *mult, *nv, *type;
+	struct Option *input, *output, *title, *mult, *nv, *type, *nprocs;
     } parm;
     struct
     {
@@ -103,6 +102,8 @@ int main(int argc, char *argv[])
     parm.nv->label = _("String representing NULL value data cell");
     parm.nv->guisection = _("NULL data");
     
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.s = G_define_flag();
     flag.s->key = 's';
     flag.s->description =
@@ -114,10 +115,7 @@ int main(int argc, char *argv[])
     input = parm.input->answer;
     output = parm.output->answer;
 
-    temp = G_tempfile();
-    ft = fopen(temp, "w+");
-    if (ft == NULL)
-	G_fatal_error(_("Unable to open temporary file <%s>"), temp);
+    G_set_nprocs(parm.nprocs);
 
     if ((title = parm.title->answer))
 	G_strip(title);
@@ -191,55 +189,50 @@ int main(int argc, char *argv[])
 		      Rast_window_cols());
 
 
-    rast_ptr = Rast_allocate_buf(data_type);
-    rast = rast_ptr;
+    rast = Rast_allocate_buf(data_type);
     cf = Rast_open_new(output, data_type);
+
+    /* rows in surfer files are written in reverse order from a
+       temporary file */
+    ft = NULL;
+    temp = NULL;
+    if (direction < 0) {
+	temp = G_tempfile();
+	ft = fopen(temp, "w+");
+	if (ft == NULL)
+	    G_fatal_error(_("Unable to open temporary file <%s>"), temp);
+    }
+
+    reader = ascii_reader_open(fd, ncols, data_type, mult, null_val_str);
     for (row = 0; row < nrows; row++) {
 	G_percent(row, nrows, 2);
-	for (col = 0; col < ncols; col++) {
-	    if (fscanf(fd, "%s", y) != 1) {
-		Rast_unopen(cf);
-		G_fatal_error(_("Data conversion failed at row %d, col %d"),
-			      row + 1, col + 1);
-	    }
-	    if (strcmp(y, null_val_str)) {
-		x = atof(y);
-		if ((float)x == GS_BLANK) {
-		    Rast_set_null_value(rast_ptr, 1, data_type);
-		}
-		else {
-		    Rast_set_d_value(rast_ptr,
-					 (DCELL) (x * mult), data_type);
-		}
-	    }
-	    else {
-		Rast_set_null_value(rast_ptr, 1, data_type);
-	    }
-	    rast_ptr = G_incr_void_ptr(rast_ptr, Rast_cell_size(data_type));
+	if (ascii_reader_get_rows(reader, rast, 1) != 1) {
+	    Rast_unopen(cf);
+	    G_fatal_error(_("Data conversion failed at row %d, col %d"),
+			  row + 1, ascii_reader_pending(reader) + 1);
 	}
-	fwrite(rast, Rast_cell_size(data_type), ncols, ft);
-	rast_ptr = rast;
+	if (ft)
+	    fwrite(rast, Rast_cell_size(data_type), ncols, ft);
+	else
+	    Rast_put_row(cf, rast, data_type);
     }
+    ascii_reader_close(reader);
     G_percent(nrows, nrows, 2);
     G_debug(1, "Creating support files for %s", output);
 
-    sz = 0;
-    if (direction < 0) {
+    if (ft) {
 	sz = -ncols * Rast_cell_size(data_type);
 	G_fseek(ft, sz, SEEK_END);
 	sz *= 2;
-    }
-    else {
-	G_fseek(ft, 0L, SEEK_SET);
-    }
 
-    for (row = 0; row < nrows; row += 1) {
-	fread(rast, Rast_cell_size(data_type), ncols, ft);
-	Rast_put_row(cf, rast, data_type);
-	G_fseek(ft, sz, SEEK_CUR);
+	for (row = 0; row < nrows; row += 1) {
+	    fread(rast, Rast_cell_size(data_type), ncols, ft);
+	    Rast_put_row(cf, rast, data_type);
+	    G_fseek(ft, sz, SEEK_CUR);
+	}
+	fclose(ft);
+	unlink(temp);
     }
-    fclose(ft);
-    unlink(temp);
 
     Rast_close(cf);
 
@@ -0,0 +1,337 @@
+#include <stdlib.h>
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+/* The data part of the file is read in blocks of text. A block ends
+ * after the last complete value it holds and is cut into parts at
+ * white space; the values of each part are counted and then converted
+ * by the worker threads, each into its place in the cell buffer, so
+ * that the cells come out in file order whatever the line breaks are.
+ * Complete rows are handed to the caller, the cells of an incomplete
+ * row are kept for the next block.
+ */
+
+#define BLOCK_SIZE (16 << 20)
+#define PARTS_PER_WORKER 4
+
+struct part
+{
+    const char *start, *end;
+    size_t first;		/* index of the first value in the block */
+    size_t count;
+};
+
+struct ascii_reader
+{
+    FILE *fp;
+    int eof;
+    char *text;
+    size_t len, alloc;		/* text held, text buffer size */
+    size_t done;		/* text converted */
+
+    int ncols;
+    RASTER_MAP_TYPE type;
+    size_t cell_size;
+    DCELL mult;
+    const char *null_val_str;
+    size_t null_len;
+
+    char *cells;
+    size_t first;		/* first cell not handed out */
+    size_t ncells, alloc_cells;	/* cells converted, buffer size */
+
+    int nparts;
+    struct part *parts;
+};
+
+extern const float GS_BLANK;
+
+static const double powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' ||
+	c == '\v' || c == '\f';
+}
+
+/* Decimal number of token [s, e). Values with up to 15 significant
+ * digits and small exponents are exact in double precision and are
+ * converted here; anything else goes to atof(), which also gives the
+ * value of a leading number of malformed tokens. */
+static double parse_number(const char *s, const char *e)
+{
+    const char *p = s;
+    unsigned long long m = 0;
+    int neg = 0, digits = 0, exp = 0, eneg = 0, eval = 0;
+    char tmp[128];
+    size_t len;
+
+    if (p < e && (*p == '-' || *p == '+'))
+	neg = *p++ == '-';
+    for (; p < e && *p >= '0' && *p <= '9'; p++, digits++)
+	m = m * 10 + (*p - '0');
+    if (p < e && *p == '.') {
+	for (p++; p < e && *p >= '0' && *p <= '9'; p++, digits++, exp--)
+	    m = m * 10 + (*p - '0');
+    }
+    if (digits > 0 && p < e && (*p == 'e' || *p == 'E')) {
+	const char *q = p + 1;
+
+	if (q < e && (*q == '-' || *q == '+'))
+	    eneg = *q++ == '-';
+	if (q < e && *q >= '0' && *q <= '9') {
+	    for (; q < e && *q >= '0' && *q <= '9' && eval < 1000; q++)
+		eval = eval * 10 + (*q - '0');
+	    p = q;
+	}
+    }
+
+    if (p == e && digits > 0 && digits <= 15) {
+	exp += eneg ? -eval : eval;
+	if (exp >= -22 && exp <= 22) {
+	    double x = exp < 0 ? (double)m / powers[-exp] :
+		(double)m * powers[exp];
+
+	    return neg ? -x : x;
+	}
+    }
+
+    len = e - s;
+    if (len >= sizeof(tmp))
+	len = sizeof(tmp) - 1;
+    memcpy(tmp, s, len);
+    tmp[len] = '\0';
+
+    return atof(tmp);
+}
+
+static void count_part(int first, int last, void *closure)
+{
+    struct ascii_reader *r = closure;
+    int i;
+
+    for (i = first; i < last; i++) {
+	struct part *part = &r->parts[i];
+	const char *p = part->start;
+	size_t n = 0;
+
+	while (p < part->end) {
+	    while (p < part->end && is_space(*p))
+		p++;
+	    if (p == part->end)
+		break;
+	    n++;
+	    while (p < part->end && !is_space(*p))
+		p++;
+	}
+	part->count = n;
+    }
+}
+
+static void convert_part(int first, int last, void *closure)
+{
+    struct ascii_reader *r = closure;
+    int i;
+
+    for (i = first; i < last; i++) {
+	struct part *part = &r->parts[i];
+	const char *p = part->start, *s;
+	void *cell = r->cells + (r->ncells + part->first) * r->cell_size;
+
+	while (p < part->end) {
+	    double x;
+
+	    while (p < part->end && is_space(*p))
+		p++;
+	    if (p == part->end)
+		break;
+	    s = p;
+	    while (p < part->end && !is_space(*p))
+		p++;
+
+	    if ((size_t)(p - s) == r->null_len &&
+		memcmp(s, r->null_val_str, r->null_len) == 0)
+		Rast_set_null_value(cell, 1, r->type);
+	    else {
+		x = parse_number(s, p);
+		if ((float)x == GS_BLANK)
+		    Rast_set_null_value(cell, 1, r->type);
+		else
+		    Rast_set_d_value(cell, (DCELL) (x * r->mult), r->type);
+	    }
+	    cell = G_incr_void_ptr(cell, r->cell_size);
+	}
+    }
+}
+
+/* read more text, return the end of the complete values */
+static size_t fill(struct ascii_reader *r)
+{
+    size_t n, end;
+
+    /* keep the incomplete value at the end */
+    if (r->done > 0) {
+	memmove(r->text, r->text + r->done, r->len - r->done);
+	r->len -= r->done;
+	r->done = 0;
+    }
+
+    while (1) {
+	if (r->len == r->alloc) {
+	    r->alloc *= 2;
+	    r->text = G_realloc(r->text, r->alloc);
+	}
+	n = r->eof ? 0 : fread(r->text + r->len, 1, r->alloc - r->len, r->fp);
+	r->len += n;
+	if (n == 0)
+	    r->eof = 1;
+
+	if (r->eof)
+	    return r->len;
+
+	for (end = r->len; end > 0 && !is_space(r->text[end - 1]); end--) ;
+	if (end > 0)
+	    return end;
+	/* a single value fills the buffer */
+    }
+}
+
+/*!
+  \brief Start reading the values of an ASCII grid
+
+  \param fp file positioned at the first value
+  \param ncols number of columns
+  \param type cell type of the output
+  \param mult multiplier
+  \param null_val_str string of null cells
+
+  \return reader
+ */
+struct ascii_reader *ascii_reader_open(FILE *fp, int ncols,
+				       RASTER_MAP_TYPE type, DCELL mult,
+				       const char *null_val_str)
+{
+    struct ascii_reader *r = G_calloc(1, sizeof(struct ascii_reader));
+
+    r->fp = fp;
+    r->alloc = BLOCK_SIZE;
+    r->text = G_malloc(r->alloc);
+    r->ncols = ncols;
+    r->type = type;
+    r->cell_size = Rast_cell_size(type);
+    r->mult = mult;
+    r->null_val_str = null_val_str;
+    r->null_len = strlen(null_val_str);
+    r->nparts = PARTS_PER_WORKER * (G_num_workers() + 1);
+    r->parts = G_malloc(r->nparts * sizeof(struct part));
+
+    return r;
+}
+
+/*!
+  \brief Read the next rows
+
+  \param r reader
+  \param[out] rast buffer for nrows rows of cells
+  \param nrows maximum number of rows to read
+
+  \return number of rows read, less than nrows only at the end of the
+  file
+ */
+int ascii_reader_get_rows(struct ascii_reader *r, void *rast, int nrows)
+{
+    size_t row_size = r->ncols * r->cell_size;
+    int got = 0;
+
+    while (got < nrows) {
+	size_t end, total, step;
+	const char *p;
+	int n, i;
+
+	/* complete rows already converted */
+	n = (r->ncells - r->first) / r->ncols;
+	if (n > nrows - got)
+	    n = nrows - got;
+	if (n > 0) {
+	    memcpy((char *)rast + got * row_size,
+		   r->cells + r->first * r->cell_size, n * row_size);
+	    r->first += (size_t)n * r->ncols;
+	    got += n;
+	    continue;
+	}
+
+	if (r->eof && r->done == r->len)
+	    break;
+
+	/* keep the cells of the incomplete row */
+	r->ncells -= r->first;
+	if (r->ncells > 0)
+	    memmove(r->cells, r->cells + r->first * r->cell_size,
+		    r->ncells * r->cell_size);
+	r->first = 0;
+
+	/* convert the next block of text */
+	end = fill(r);
+	p = r->text;
+	step = end / r->nparts + 1;
+	for (i = 0; i < r->nparts; i++) {
+	    const char *q = r->text + (i + 1) * step;
+
+	    if (q >= r->text + end || i == r->nparts - 1)
+		q = r->text + end;
+	    else if (q < p)
+		q = p;
+	    else
+		while (q < r->text + end && !is_space(*q))
+		    q++;
+	    r->parts[i].start = p;
+	    r->parts[i].end = q;
+	    p = q;
+	}
+
+	G_parallel_for(0, r->nparts, 1, count_part, r);
+
+	total = 0;
+	for (i = 0; i < r->nparts; i++) {
+	    r->parts[i].first = total;
+	    total += r->parts[i].count;
+	}
+	if (r->ncells + total > r->alloc_cells) {
+	    r->alloc_cells = r->ncells + total;
+	    r->cells = G_realloc(r->cells, r->alloc_cells * r->cell_size);
+	}
+
+	G_parallel_for(0, r->nparts, 1, convert_part, r);
+
+	r->ncells += total;
+	r->done = end;
+    }
+
+    return got;
+}
+
+/*!
+  \brief Number of values of the incomplete row
+
+  \param r reader
+
+  \return values read after the last complete row
+ */
+int ascii_reader_pending(const struct ascii_reader *r)
+{
+    return (r->ncells - r->first) % r->ncols;
+}
+
+void ascii_reader_close(struct ascii_reader *r)
+{
+    G_free(r->text);
+    G_free(r->cells);
+    G_free(r->parts);
+    G_free(r);
+}
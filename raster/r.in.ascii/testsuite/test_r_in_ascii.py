@@ -69,6 +69,19 @@ null:                      -9999
 1@ 2@ 3@ 4@ 5@ 6@ 7@ 8@ 9@ 10@ 11@ 12@ 13@ 14@ 15
 1@ 2@ 3@ 4@ 5@ 6@ 7@ 8@ 9@ 10@ 11@ 12@ 13@ 14@ 15 """
 
+INPUT_WRAPPED="""north: 3
+south: 0
+east: 4
+west: 0
+rows: 3
+cols: 4
+null: *
+
+1.5 -2.25e1 * 4
+0.125 6
+7 8 9.75E-1 10 1e2 12
+"""
+
 class SimpleCsvTestCase(TestCase):
     ascii_test = 'ascii'
 
@@ -114,5 +127,16 @@ class SimpleCsvTestCase(TestCase):
         self.assertRasterMinMax(map=self.ascii_test, refmin=1, refmax=15,
 	                        msg="ascii_test in degrees must be between 1 and 15")
 
+    def test_rows_over_lines(self):
+        """Test rows split over lines, exponents and null values"""
+        self.assertModule('r.in.ascii', input='-', output=self.ascii_test,
+                          type='DCELL', nprocs=2, stdin_=INPUT_WRAPPED)
+        self.runModule('g.region', raster=self.ascii_test)
+        self.assertRasterFitsUnivar(raster=self.ascii_test,
+                                    reference=dict(n=11, null_cells=1,
+                                                   min=-22.5, max=100,
+                                                   sum=127.1),
+                                    precision=1e-6)
+
 if __name__ == '__main__':
     test()
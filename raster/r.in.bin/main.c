@@ -15,10 +15,15 @@
  *****************************************************************************/
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
+#include <sys/types.h>
 #include <sys/stat.h>
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/glocale.h>
@@ -30,12 +35,20 @@ enum fliphv {
     FLIP_V = 2,
 };
 
-static void swap_2(void *p)
+/* rows converted at once, by the worker threads */
+#define BLOCK_BYTES (8 << 20)
+
+struct block
 {
-    unsigned char *q = p;
-    unsigned char t;
-    t = q[0]; q[0] = q[1]; q[1] = t;
-}
+    const unsigned char *map;	/* mapped input file or NULL */
+    unsigned char *in_buf;	/* input rows */
+    DCELL *out_buf;		/* output rows */
+    int nrows, ncols;		/* of the map */
+    int row, block_rows;	/* first row and rows of the block */
+    off_t band_off;
+    int is_fp, is_signed, bytes, swap_flag, flip;
+    double null_val;
+};
 
 static void swap_4(void *p)
 {
@@ -110,87 +123,124 @@ static void get_gmt_header(const struct GRD_HEADER *header, struct Cell_head *re
     region->ns_res = header->y_inc;
 }
 
-static void convert_cell(
-    DCELL *out_cell, unsigned char *in_cell,
-    int is_fp, int is_signed, int bytes, int swap_flag)
+/* copy n cells of the input to dst, swapping the bytes if requested;
+ * the loops are simple enough for the compiler to vectorize */
+static void copy_cells(unsigned char *dst, const unsigned char *src, int n,
+		       int bytes, int swap_flag)
 {
-    if (swap_flag) {
-	switch (bytes) {
-	case 1:				break;
-	case 2:	swap_2(in_cell);	break;
-	case 4:	swap_4(in_cell);	break;
-	case 8:	swap_8(in_cell);	break;
+    int i;
+
+    if (!swap_flag || bytes == 1) {
+	if (dst != src)
+	    memcpy(dst, src, (size_t)n * bytes);
+	return;
+    }
+
+    switch (bytes) {
+    case 2:
+	for (i = 0; i < n; i++) {
+	    uint16_t v;
+
+	    memcpy(&v, src + 2 * i, 2);
+	    v = (uint16_t)((v >> 8) | (v << 8));
+	    memcpy(dst + 2 * i, &v, 2);
 	}
+	break;
+    case 4:
+	for (i = 0; i < n; i++) {
+	    uint32_t v;
+
+	    memcpy(&v, src + 4 * i, 4);
+	    v = (v >> 24) | ((v >> 8) & 0xff00) |
+		((v << 8) & 0xff0000) | (v << 24);
+	    memcpy(dst + 4 * i, &v, 4);
+	}
+	break;
+    case 8:
+	for (i = 0; i < n; i++) {
+	    uint64_t v;
+
+	    memcpy(&v, src + 8 * i, 8);
+	    v = (v >> 56) | ((v >> 40) & 0xff00) |
+		((v >> 24) & 0xff0000) | ((v >> 8) & 0xff000000) |
+		((v << 8) & 0xff00000000ULL) |
+		((v << 24) & 0xff0000000000ULL) |
+		((v << 40) & 0xff000000000000ULL) | (v << 56);
+	    memcpy(dst + 8 * i, &v, 8);
+	}
+	break;
     }
+}
+
+/* one conversion loop per input type */
+#define CONVERT(TYPE)						\
+    do {							\
+	const TYPE *in = (const TYPE *)in_buf;			\
+								\
+	for (i = 0; i < ncols; i++) {				\
+	    DCELL x = (DCELL) in[i];				\
+								\
+	    i2 = (flip & FLIP_H) ? ncols - i - 1 : i;		\
+	    if (x == null_val)					\
+		Rast_set_d_null_value(&raster[i2], 1);		\
+	    else						\
+		raster[i2] = x;					\
+	}							\
+    } while (0)
+
+static void convert_row(
+    DCELL *raster, unsigned char *in_buf, int ncols,
+    int is_fp, int is_signed, int bytes, double null_val, int flip)
+{
+    int i, i2;
 
     if (is_fp) {
-	switch (bytes) {
-	case 4:
-	    *out_cell = (DCELL) *(float *) in_cell;
-	    break;
-	case 8:
-	    *out_cell = (DCELL) *(double *) in_cell;
-	    break;
-	}
+	if (bytes == 4)
+	    CONVERT(float);
+	else
+	    CONVERT(double);
     }
     else if (is_signed) {
 	switch (bytes) {
-	case 1:
-	    *out_cell = (DCELL) *(signed char *) in_cell;
-	    break;
-	case 2:
-	    *out_cell = (DCELL) *(short *) in_cell;
-	    break;
-	case 4:
-	    *out_cell = (DCELL) *(int *) in_cell;
-	    break;
-#ifdef HAVE_LONG_LONG_INT
-	case 8:
-	    *out_cell = (DCELL) *(long long *) in_cell;
-	    break;
-#endif
+	case 1: CONVERT(signed char); break;
+	case 2: CONVERT(int16_t); break;
+	case 4: CONVERT(int32_t); break;
+	case 8: CONVERT(int64_t); break;
 	}
     }
     else {
 	switch (bytes) {
-	case 1:
-	    *out_cell = (DCELL) *(unsigned char *) in_cell;
-	    break;
-	case 2:
-	    *out_cell = (DCELL) *(unsigned short *) in_cell;
-	    break;
-	case 4:
-	    *out_cell = (DCELL) *(unsigned int *) in_cell;
-	    break;
-#ifdef HAVE_LONG_LONG_INT
-	case 8:
-	    *out_cell = (DCELL) *(unsigned long long *) in_cell;
-	    break;
-#endif
+	case 1: CONVERT(unsigned char); break;
+	case 2: CONVERT(uint16_t); break;
+	case 4: CONVERT(uint32_t); break;
+	case 8: CONVERT(uint64_t); break;
 	}
     }
 }
 
-static void convert_row(
-    DCELL *raster, unsigned char *in_buf, int ncols,
-    int is_fp, int is_signed, int bytes, int swap_flag,
-    double null_val, int flip)
+/* input row of the file for output row */
+static off_t row_offset(const struct block *b, int row)
 {
-    unsigned char *ptr = in_buf;
-    int i, i2;
+    if (b->flip & FLIP_V)
+	row = b->nrows - row - 1;
 
-    for (i = 0; i < ncols; i++) {
-	DCELL x;
+    return (off_t)row * b->ncols * b->bytes + b->band_off;
+}
 
-	convert_cell(&x, ptr, is_fp, is_signed, bytes, swap_flag);
-	i2 = i;
-	if (flip & FLIP_H)
-	    i2 = ncols - i - 1;
-	if (x == null_val)
-	    Rast_set_d_null_value(&raster[i2], 1);
-	else
-	    raster[i2] = x;
-	ptr += bytes;
+static void convert_rows(int first, int last, void *closure)
+{
+    struct block *b = closure;
+    size_t in_size = (size_t)b->ncols * b->bytes;
+    int i;
+
+    for (i = first; i < last; i++) {
+	unsigned char *in = b->in_buf + i * in_size;
+	const unsigned char *src = b->map ?
+	    b->map + row_offset(b, b->row + i) : in;
+
+	copy_cells(in, src, b->ncols, b->bytes, b->swap_flag);
+	convert_row(b->out_buf + (size_t)i * b->ncols, in, b->ncols,
+		    b->is_fp, b->is_signed, b->bytes, b->null_val, b->flip);
     }
 }
 
@@ -214,6 +264,7 @@ int main(int argc, char *argv[])
 	struct Option *rows;
 	struct Option *cols;
 	struct Option *flip;
+	struct Option *nprocs;
     } parm;
     struct
     {
@@ -239,8 +290,8 @@ int main(int argc, char *argv[])
     struct Cell_head cellhd;
     int nrows, ncols;
     int grass_nrows, grass_ncols;
-    unsigned char *in_buf;
-    DCELL *out_buf;
+    struct block blk;
+    void *map;
     RASTER_MAP_TYPE map_type;
     int fd;
     FILE *fp;
@@ -397,10 +448,13 @@ int main(int argc, char *argv[])
     parm.flip->descriptions = desc;
     parm.flip->guisection = _("Settings");
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
 
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(parm.nprocs);
+
     input = parm.input->answer;
     outpre = parm.output->answer;
     title = parm.title->answer;
@@ -577,17 +631,38 @@ int main(int argc, char *argv[])
 	G_fatal_error(_("Bytes do not match file size"));
     }
 
-    in_buf = G_malloc(ncols * bytes);
-    out_buf = Rast_allocate_d_buf();
-
     map_type = is_fp ? (bytes > 4 ? DCELL_TYPE : FCELL_TYPE) : CELL_TYPE;
 
-    in_buf = G_malloc(ncols * bytes);
-    out_buf = Rast_allocate_d_buf();
+    /* rows are taken straight from a mapping of the file if possible */
+    map = NULL;
+#ifndef __MINGW32__
+    if ((size_t)file_size == file_size) {
+	map = mmap(NULL, (size_t)file_size, PROT_READ, MAP_SHARED,
+		   fileno(fp), (off_t) 0);
+	if (map == MAP_FAILED)
+	    map = NULL;
+	else
+	    madvise(map, (size_t)file_size, MADV_SEQUENTIAL);
+    }
+#endif
+    G_debug(1, "Input file %s", map ? "mapped" : "read");
+
+    blk.map = map;
+    blk.nrows = nrows;
+    blk.ncols = ncols;
+    blk.is_fp = is_fp;
+    blk.is_signed = is_signed;
+    blk.bytes = bytes;
+    blk.swap_flag = swap_flag;
+    blk.flip = flip;
+    blk.null_val = null_val;
+
+    i = BLOCK_BYTES / ((size_t)ncols * (bytes + sizeof(DCELL)));
+    blk.block_rows = i < 1 ? 1 : i > nrows ? nrows : i;
+    blk.in_buf = G_malloc((size_t)blk.block_rows * ncols * bytes);
+    blk.out_buf = G_malloc((size_t)blk.block_rows * ncols * sizeof(DCELL));
 
     bsize = log10(nbands) + 1;
-    if (!flag.gmt_hd->answer && hbytes > 0)
-	G_fseek(fp, hbytes, SEEK_SET);
 
     for (band = 1; band <= nbands; band++) {
 	
@@ -601,22 +676,31 @@ int main(int argc, char *argv[])
 	fd = Rast_open_new(output, map_type);
 	
 	band_off = (off_t)nrows * ncols * bytes * (band - 1) + hbytes;
+	blk.band_off = band_off;
+
+	for (row = 0; row < grass_nrows; row += blk.block_rows) {
+	    int n = grass_nrows - row;
+
+	    if (n > blk.block_rows)
+		n = blk.block_rows;
+	    blk.row = row;
 
-	for (row = 0; row < grass_nrows; row++) {
 	    G_percent(row, nrows, 2);
 
-	    if (flip & FLIP_V) {
-		G_fseek(fp, (off_t) (grass_nrows - row - 1) * ncols * bytes + band_off,
-			SEEK_SET);
+	    if (!map) {
+		for (i = 0; i < n; i++) {
+		    if (i == 0 || (flip & FLIP_V))
+			G_fseek(fp, row_offset(&blk, row + i), SEEK_SET);
+		    if (fread(blk.in_buf + (size_t)i * ncols * bytes, bytes,
+			      ncols, fp) != ncols)
+			G_fatal_error(_("Error reading data"));
+		}
 	    }
 
-	    if (fread(in_buf, bytes, ncols, fp) != ncols)
-		G_fatal_error(_("Error reading data"));
-
-	    convert_row(out_buf, in_buf, ncols, is_fp, is_signed,
-			bytes, swap_flag, null_val, flip);
+	    G_parallel_for(0, n, 1, convert_rows, &blk);
 
-	    Rast_put_d_row(fd, out_buf);
+	    for (i = 0; i < n; i++)
+		Rast_put_d_row(fd, blk.out_buf + (size_t)i * ncols);
 	}
 
 	G_percent(row, nrows, 2);	/* finish it off */
@@ -633,6 +717,13 @@ int main(int argc, char *argv[])
 	Rast_write_history(output, &history);
     }
 
+#ifndef __MINGW32__
+    if (map)
+	munmap(map, (size_t)file_size);
+#endif
+    G_free(blk.in_buf);
+    G_free(blk.out_buf);
+
     fclose(fp);
 
     return EXIT_SUCCESS;
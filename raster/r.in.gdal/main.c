@@ -49,6 +49,7 @@ static void SetupReprojector(const char *pszSrcWKT, const char *pszDstLoc,
 static int dump_rat(GDALRasterBandH hBand, char *outrat, int nBand);
 static void error_handler_ds(void *p);
 static int l1bdriver;
+static int nprocs;
 
 static GDALDatasetH opends(char *dsname, const char **doo, GDALDriverH *hDriver)
 {
@@ -111,7 +112,7 @@ int main(int argc, char *argv[])
     {
 	struct Option *input, *output, *target, *title, *outloc, *band,
 	              *memory, *offset, *num_digits, *map_names_file,
-	              *rat, *cfg, *doo;
+	              *rat, *cfg, *doo, *nprocs;
     } parm;
     struct Flag *flag_o, *flag_e, *flag_k, *flag_f, *flag_l, *flag_c, *flag_p,
         *flag_j, *flag_a, *flag_r;
@@ -226,6 +227,8 @@ int main(int argc, char *argv[])
     parm.doo->label = _("GDAL dataset open options");
     parm.doo->description = _("Comma-separated list of key=value pairs");
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag_o = G_define_flag();
     flag_o->key = 'o';
     flag_o->label =
@@ -416,6 +419,15 @@ int main(int argc, char *argv[])
 	G_free_tokens(tokens);
     }
 
+    /* decompression of blocks by GDAL's own threads, unless configured */
+    nprocs = G_set_nprocs(parm.nprocs);
+    if (nprocs > 1 && !CPLGetConfigOption("GDAL_NUM_THREADS", NULL)) {
+	char num_threads[32];
+
+	sprintf(num_threads, "%d", nprocs);
+	CPLSetConfigOption("GDAL_NUM_THREADS", num_threads);
+    }
+
     /* GDAL dataset open options */
     doo = NULL;
     if (parm.doo->answer) {
@@ -1115,6 +1127,8 @@ static void ImportBand(GDALRasterBandH hBand, const char *output,
     void *cell, *cellReal, *cellImg;
     void *cell_gdal;
     void *bufComplex;
+    int block_cols, chunk_rows;
+    size_t row_size;
     double dfNoData;
     char outputReal[GNAME_MAX], outputImg[GNAME_MAX];
     char *nullFlags = NULL;
@@ -1223,11 +1237,26 @@ static void ImportBand(GDALRasterBandH hBand, const char *output,
 	if (group_ref != NULL)
 	    I_add_file_to_group_ref((char *)output, G_mapset(), group_ref);
 
-	cell_gdal = G_malloc(Rast_cell_size(data_type) * ncols_gdal);
+	/* source rows are read by whole blocks, at most as many as fit
+	 * into the GDAL block cache */
+	GDALGetBlockSize(hBand, &block_cols, &chunk_rows);
+	row_size = (size_t)Rast_cell_size(data_type) * ncols_gdal;
+	while (chunk_rows > 1 &&
+	       (GIntBig)(chunk_rows * row_size) > GDALGetCacheMax64())
+	    chunk_rows /= 2;
+	if (chunk_rows < 1)
+	    chunk_rows = 1;
+	G_debug(1, "rows read at once: %d", chunk_rows);
+
+	cell_gdal = G_malloc(row_size * chunk_rows);
 	if (use_cell_gdal)
 	    cell = (char *)cell_gdal + Rast_cell_size(data_type) * col_offset;
 	else
 	    cell = Rast_allocate_buf(data_type);
+
+	/* rows are converted and compressed by the libgis workers */
+	if (nprocs > 1)
+	    Rast_set_write_behind(cf, chunk_rows);
     }
 
     /* -------------------------------------------------------------------- */
@@ -1289,154 +1318,97 @@ static void ImportBand(GDALRasterBandH hBand, const char *output,
 	    Rast_put_row(cfI, cellImg, data_type);
 	}
     }				/* end of complex */
-    else if (l1bdriver) {		/* AVHRR */
-	/* AVHRR - read from south to north to match GCPs */
-	/* AVHRR - as for other formats, read from north to south to match GCPs 
-	 * MM 2013 with gdal 1.10 */
-	for (row = 0; row < nrows; row++) {
+    else {
+	/* default, AVHRR included: as for other formats, read from north
+	 * to south to match GCPs - MM 2013 with gdal 1.10 */
+	int i, nchunk;
+
+	for (row = 0; row < nrows; row += nchunk) {
 	    if (rowmap[row] < 0)
 		G_fatal_error(_("Invalid row"));
 
 	    G_percent(row, nrows, 2);
 
-	    GDALRasterIO(hBand, GF_Read, 0, rowmap[row], ncols_gdal, 1,
-			 cell_gdal, ncols_gdal, 1, eGDT, 0, 0);
-
-	    if (nullFlags != NULL) {
-		memset(nullFlags, 0, ncols);
-
-		if (eGDT == GDT_Int32) {
-		    for (indx = 0; indx < ncols; indx++) {
-			if (colmap[indx] < 0)
-			    nullFlags[indx] = 1;
-			else if (bNoDataEnabled && 
-			         ((CELL *) cell_gdal)[colmap[indx]] == (GInt32) dfNoData) {
-			    nullFlags[indx] = 1;
+	    /* consecutive source rows up to the end of the source block */
+	    nchunk = 1;
+	    while (nchunk < chunk_rows && row + nchunk < nrows &&
+		   rowmap[row + nchunk] == rowmap[row] + nchunk &&
+		   rowmap[row + nchunk] % chunk_rows != 0)
+		nchunk++;
+
+	    GDALRasterIO(hBand, GF_Read, 0, rowmap[row], ncols_gdal, nchunk,
+			 cell_gdal, ncols_gdal, nchunk, eGDT, 0, 0);
+
+	    for (i = 0; i < nchunk; i++) {
+		void *row_gdal = G_incr_void_ptr(cell_gdal, i * row_size);
+
+		if (use_cell_gdal)
+		    cell = G_incr_void_ptr(row_gdal,
+					   Rast_cell_size(data_type) *
+					   col_offset);
+
+		if (nullFlags != NULL) {
+		    memset(nullFlags, 0, ncols);
+
+		    if (eGDT == GDT_Int32) {
+			for (indx = 0; indx < ncols; indx++) {
+			    if (colmap[indx] < 0)
+				nullFlags[indx] = 1;
+			    else if (bNoDataEnabled && 
+				     ((CELL *) row_gdal)[colmap[indx]] == (GInt32) dfNoData) {
+				nullFlags[indx] = 1;
+			    }
+			    else
+				((CELL *)cell)[indx] = ((CELL *)row_gdal)[colmap[indx]];
 			}
-			else
-			    ((CELL *)cell)[indx] = ((CELL *)cell_gdal)[colmap[indx]];
 		    }
-		}
-		else if (eGDT == GDT_Float32) {
-		    for (indx = 0; indx < ncols; indx++) {
-			if (colmap[indx] < 0)
-			    nullFlags[indx] = 1;
-			else if (bNoDataEnabled && 
-			         ((FCELL *)cell_gdal)[colmap[indx]] == (float)dfNoData) {
-			    nullFlags[indx] = 1;
+		    else if (eGDT == GDT_Float32) {
+			for (indx = 0; indx < ncols; indx++) {
+			    if (colmap[indx] < 0)
+				nullFlags[indx] = 1;
+			    else if (bNoDataEnabled && 
+				     ((FCELL *)row_gdal)[colmap[indx]] == (float)dfNoData) {
+				nullFlags[indx] = 1;
+			    }
+			    else
+				((FCELL *)cell)[indx] = ((FCELL *)row_gdal)[colmap[indx]];
 			}
-			else
-			    ((FCELL *)cell)[indx] = ((FCELL *)cell_gdal)[colmap[indx]];
 		    }
-		}
-		else if (eGDT == GDT_Float64) {
-		    for (indx = 0; indx < ncols; indx++) {
-			if (colmap[indx] < 0)
-			    nullFlags[indx] = 1;
-			else if (bNoDataEnabled && 
-			         ((DCELL *)cell_gdal)[colmap[indx]] == dfNoData) {
-			    nullFlags[indx] = 1;
+		    else if (eGDT == GDT_Float64) {
+			for (indx = 0; indx < ncols; indx++) {
+			    if (colmap[indx] < 0)
+				nullFlags[indx] = 1;
+			    else if (bNoDataEnabled && 
+				     ((DCELL *)row_gdal)[colmap[indx]] == dfNoData) {
+				nullFlags[indx] = 1;
+			    }
+			    else
+				((DCELL *)cell)[indx] = ((DCELL *)row_gdal)[colmap[indx]];
 			}
-			else
-			    ((DCELL *)cell)[indx] = ((DCELL *)cell_gdal)[colmap[indx]];
 		    }
-		}
 
-		Rast_insert_null_values(cell, nullFlags, ncols, data_type);
-	    }
-	    else if (map_cols) {
-		if (eGDT == GDT_Int32) {
-		    for (indx = 0; indx < ncols; indx++) {
-			((CELL *)cell)[indx] = ((CELL *)cell_gdal)[colmap[indx]];
-		    }
-		}
-		else if (eGDT == GDT_Float32) {
-		    for (indx = 0; indx < ncols; indx++) {
-			((FCELL *)cell)[indx] = ((FCELL *)cell_gdal)[colmap[indx]];
-		    }
-		}
-		else if (eGDT == GDT_Float64) {
-		    for (indx = 0; indx < ncols; indx++) {
-			((DCELL *)cell)[indx] = ((DCELL *)cell_gdal)[colmap[indx]];
-		    }
+		    Rast_insert_null_values(cell, nullFlags, ncols, data_type);
 		}
-	    }
-
-	    Rast_put_row(cf, cell, data_type);
-	}
-    }				/* end AVHRR */
-    else {
-	/* default */
-	for (row = 0; row < nrows; row++) {
-	    if (rowmap[row] < 0)
-		G_fatal_error(_("Invalid row"));
-
-	    G_percent(row, nrows, 2);
-
-	    GDALRasterIO(hBand, GF_Read, 0, rowmap[row], ncols_gdal, 1,
-			 cell_gdal, ncols_gdal, 1, eGDT, 0, 0);
-
-	    if (nullFlags != NULL) {
-		memset(nullFlags, 0, ncols);
-
-		if (eGDT == GDT_Int32) {
-		    for (indx = 0; indx < ncols; indx++) {
-			if (colmap[indx] < 0)
-			    nullFlags[indx] = 1;
-			else if (bNoDataEnabled && 
-			         ((CELL *) cell_gdal)[colmap[indx]] == (GInt32) dfNoData) {
-			    nullFlags[indx] = 1;
+		else if (map_cols) {
+		    if (eGDT == GDT_Int32) {
+			for (indx = 0; indx < ncols; indx++) {
+			    ((CELL *)cell)[indx] = ((CELL *)row_gdal)[colmap[indx]];
 			}
-			else
-			    ((CELL *)cell)[indx] = ((CELL *)cell_gdal)[colmap[indx]];
 		    }
-		}
-		else if (eGDT == GDT_Float32) {
-		    for (indx = 0; indx < ncols; indx++) {
-			if (colmap[indx] < 0)
-			    nullFlags[indx] = 1;
-			else if (bNoDataEnabled && 
-			         ((FCELL *)cell_gdal)[colmap[indx]] == (float)dfNoData) {
-			    nullFlags[indx] = 1;
+		    else if (eGDT == GDT_Float32) {
+			for (indx = 0; indx < ncols; indx++) {
+			    ((FCELL *)cell)[indx] = ((FCELL *)row_gdal)[colmap[indx]];
 			}
-			else
-			    ((FCELL *)cell)[indx] = ((FCELL *)cell_gdal)[colmap[indx]];
 		    }
-		}
-		else if (eGDT == GDT_Float64) {
-		    for (indx = 0; indx < ncols; indx++) {
-			if (colmap[indx] < 0)
-			    nullFlags[indx] = 1;
-			else if (bNoDataEnabled && 
-			         ((DCELL *)cell_gdal)[colmap[indx]] == dfNoData) {
-			    nullFlags[indx] = 1;
+		    else if (eGDT == GDT_Float64) {
+			for (indx = 0; indx < ncols; indx++) {
+			    ((DCELL *)cell)[indx] = ((DCELL *)row_gdal)[colmap[indx]];
 			}
-			else
-			    ((DCELL *)cell)[indx] = ((DCELL *)cell_gdal)[colmap[indx]];
 		    }
 		}
 
-		Rast_insert_null_values(cell, nullFlags, ncols, data_type);
-	    }
-	    else if (map_cols) {
-		if (eGDT == GDT_Int32) {
-		    for (indx = 0; indx < ncols; indx++) {
-			((CELL *)cell)[indx] = ((CELL *)cell_gdal)[colmap[indx]];
-		    }
-		}
-		else if (eGDT == GDT_Float32) {
-		    for (indx = 0; indx < ncols; indx++) {
-			((FCELL *)cell)[indx] = ((FCELL *)cell_gdal)[colmap[indx]];
-		    }
-		}
-		else if (eGDT == GDT_Float64) {
-		    for (indx = 0; indx < ncols; indx++) {
-			((DCELL *)cell)[indx] = ((DCELL *)cell_gdal)[colmap[indx]];
-		    }
-		}
+		Rast_put_row(cf, cell, data_type);
 	    }
-
-	    Rast_put_row(cf, cell, data_type);
 	}
     }
     G_percent(1, 1, 1);
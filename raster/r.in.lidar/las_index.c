@@ -0,0 +1,310 @@
+/*
+ * r.in.lidar spatial index of LAS files
+ *
+ * Copyright 2020 by the GRASS Development Team
+ *
+ * This program is free software licensed under the GPL (>=v2).
+ * Read the COPYING file that comes with GRASS for details.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <grass/gis.h>
+#include <grass/glocale.h>
+
+#include "las_index.h"
+
+#define INDEX_MAGIC "GRASS LAS index 1\n"
+
+/* header of the index file, native byte order */
+struct index_header
+{
+    char magic[sizeof(INDEX_MAGIC)];
+    int one;                    /* byte order check */
+    long long size;             /* of the LAS file */
+    long long mtime;
+    unsigned long long num_points;
+    unsigned int block_points;
+    unsigned int num_blocks;
+};
+
+static void set_header(struct index_header *header, const struct stat *st,
+                       const struct LasIndex *index)
+{
+    memset(header, 0, sizeof(struct index_header));
+    strcpy(header->magic, INDEX_MAGIC);
+    header->one = 1;
+    header->size = st->st_size;
+    header->mtime = st->st_mtime;
+    header->num_points = index->num_points;
+    header->block_points = index->block_points;
+    header->num_blocks = index->num_blocks;
+}
+
+/* read index of file if it is up to date
+ * returns 1 on success, 0 if there is no usable index */
+int las_index_read(const char *file, unsigned long num_points,
+                   struct LasIndex *index)
+{
+    char path[GPATH_MAX];
+    struct stat st;
+    struct index_header header, stored;
+    size_t n;
+    FILE *fp;
+
+    if (stat(file, &st) != 0)
+        return 0;
+    snprintf(path, sizeof(path), "%s.lidx", file);
+    fp = fopen(path, "rb");
+    if (!fp)
+        return 0;
+
+    if (fread(&stored, sizeof(struct index_header), 1, fp) != 1) {
+        fclose(fp);
+        return 0;
+    }
+    index->num_points = num_points;
+    index->block_points = stored.block_points;
+    index->num_blocks = stored.num_blocks;
+    set_header(&header, &st, index);
+    if (memcmp(&header, &stored, sizeof(struct index_header)) != 0 ||
+        index->block_points == 0 ||
+        index->num_blocks !=
+        (num_points + index->block_points - 1) / index->block_points) {
+        G_debug(1, "Index <%s> is out of date", path);
+        fclose(fp);
+        return 0;
+    }
+
+    n = (size_t) 4 * index->num_blocks;
+    index->bounds = G_malloc(n * sizeof(double));
+    if (fread(index->bounds, sizeof(double), n, fp) != n) {
+        G_free(index->bounds);
+        index->bounds = NULL;
+        fclose(fp);
+        return 0;
+    }
+    fclose(fp);
+
+    G_debug(1, "Index <%s>: %u blocks", path, index->num_blocks);
+
+    return 1;
+}
+
+static int write_index(const char *file, const struct LasIndex *index)
+{
+    char path[GPATH_MAX], tmp[GPATH_MAX + 16];
+    struct stat st;
+    struct index_header header;
+    size_t n = (size_t) 4 * index->num_blocks;
+    FILE *fp;
+
+    if (stat(file, &st) != 0)
+        return 0;
+    snprintf(path, sizeof(path), "%s.lidx", file);
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, getpid());
+    fp = fopen(tmp, "wb");
+    if (!fp)
+        return 0;
+
+    set_header(&header, &st, index);
+    if (fwrite(&header, sizeof(struct index_header), 1, fp) != 1 ||
+        fwrite(index->bounds, sizeof(double), n, fp) != n) {
+        fclose(fp);
+        remove(tmp);
+        return 0;
+    }
+    if (fclose(fp) != 0 || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* scan all points of file to build the index
+ * the index is written next to the file if write is set
+ * returns 1 on success, 0 if the file cannot be read */
+int las_index_build(const char *file, struct LasIndex *index, int write)
+{
+    LASReaderH reader;
+    LASHeaderH header;
+    LASPointH point;
+    unsigned long i;
+    double *b;
+
+    reader = LASReader_Create(file);
+    if (reader == NULL)
+        return 0;
+    header = LASReader_GetHeader(reader);
+    if (header == NULL) {
+        LASReader_Destroy(reader);
+        return 0;
+    }
+
+    G_verbose_message(_("Building spatial index of <%s>..."), file);
+
+    index->num_points = LASHeader_GetPointRecordsCount(header);
+    index->block_points = LAS_INDEX_BLOCK_POINTS;
+    index->num_blocks = (index->num_points + index->block_points - 1) /
+        index->block_points;
+    index->bounds =
+        G_malloc((size_t) 4 * (index->num_blocks + 1) * sizeof(double));
+    LASHeader_Destroy(header);
+
+    b = index->bounds;
+    i = 0;
+    while ((point = LASReader_GetNextPoint(reader)) != NULL) {
+        double x = LASPoint_GetX(point);
+        double y = LASPoint_GetY(point);
+
+        if (i / index->block_points >= index->num_blocks)
+            break;              /* more points than in the header */
+        b = &index->bounds[4 * (i / index->block_points)];
+        if (i % index->block_points == 0) {
+            b[0] = b[1] = x;
+            b[2] = b[3] = y;
+        }
+        else {
+            if (x < b[0])
+                b[0] = x;
+            if (x > b[1])
+                b[1] = x;
+            if (y < b[2])
+                b[2] = y;
+            if (y > b[3])
+                b[3] = y;
+        }
+        i++;
+    }
+    LASReader_Destroy(reader);
+
+    if (i != index->num_points) {
+        G_warning(_("Number of points in <%s> differs from its header, "
+                    "spatial index not used"), file);
+        las_index_free(index);
+        return 0;
+    }
+
+    if (write && !write_index(file, index))
+        G_warning(_("Unable to write spatial index of <%s>"), file);
+
+    return 1;
+}
+
+/* get index of file from its index file or by scanning it if build
+ * is set, returns 1 if there is an index */
+int las_index_get(const char *file, int build, struct LasIndex *index)
+{
+    LASReaderH reader;
+    LASHeaderH header;
+    unsigned long num_points;
+
+    index->bounds = NULL;
+    index->num_blocks = 0;
+
+    reader = LASReader_Create(file);
+    if (reader == NULL)
+        return 0;
+    header = LASReader_GetHeader(reader);
+    if (header == NULL) {
+        LASReader_Destroy(reader);
+        return 0;
+    }
+    num_points = LASHeader_GetPointRecordsCount(header);
+    LASHeader_Destroy(header);
+    LASReader_Destroy(reader);
+
+    if (las_index_read(file, num_points, index))
+        return 1;
+    if (build)
+        return las_index_build(file, index, TRUE);
+
+    return 0;
+}
+
+void las_index_free(struct LasIndex *index)
+{
+    G_free(index->bounds);
+    index->bounds = NULL;
+    index->num_blocks = 0;
+}
+
+static int block_intersects(const double *b, double west, double east,
+                            double south, double north)
+{
+    return !(b[1] < west || b[0] > east || b[3] < south || b[2] > north);
+}
+
+/* test if any block of the index is in the box (boundaries included) */
+int las_index_intersects(const struct LasIndex *index, double west,
+                         double east, double south, double north)
+{
+    unsigned int i;
+
+    for (i = 0; i < index->num_blocks; i++)
+        if (block_intersects(&index->bounds[4 * i], west, east, south, north))
+            return 1;
+
+    return 0;
+}
+
+/* index can be NULL to read all points */
+void las_index_reader_init(struct LasIndexReader *reader,
+                           LASReaderH las_reader,
+                           const struct LasIndex *index, double west,
+                           double east, double south, double north)
+{
+    reader->reader = las_reader;
+    reader->index = index && index->bounds ? index : NULL;
+    reader->west = west;
+    reader->east = east;
+    reader->south = south;
+    reader->north = north;
+    reader->block = 0;
+    reader->next = 0;
+    reader->left = 0;
+    reader->skipped = 0;
+}
+
+/* get next point of the blocks intersecting the box,
+ * points of other blocks are skipped without decoding them */
+LASPointH las_index_next_point(struct LasIndexReader *reader)
+{
+    const struct LasIndex *index = reader->index;
+
+    if (!index)
+        return LASReader_GetNextPoint(reader->reader);
+
+    while (reader->left == 0) {
+        unsigned int block = reader->block;
+        unsigned long first;
+        unsigned int n;
+
+        if (block >= index->num_blocks)
+            return NULL;
+        reader->block++;
+
+        first = (unsigned long)block * index->block_points;
+        n = index->num_points - first < index->block_points ?
+            index->num_points - first : index->block_points;
+        if (!block_intersects(&index->bounds[4 * block], reader->west,
+                              reader->east, reader->south, reader->north)) {
+            reader->skipped += n;
+            continue;
+        }
+        if (block != reader->next &&
+            LASReader_Seek(reader->reader, first) != LE_None)
+            G_fatal_error(_("Unable to seek to point %lu"), first);
+        reader->next = block + 1;
+        reader->left = n;
+    }
+    reader->left--;
+
+    return LASReader_GetNextPoint(reader->reader);
+}
@@ -0,0 +1,57 @@
+/*
+ * r.in.lidar spatial index of LAS files
+ *
+ * Copyright 2020 by the GRASS Development Team
+ *
+ * This program is free software licensed under the GPL (>=v2).
+ * Read the COPYING file that comes with GRASS for details.
+ *
+ */
+
+#ifndef __LAS_INDEX_H__
+#define __LAS_INDEX_H__
+
+#include <liblas/capi/liblas.h>
+
+/* number of consecutive points in one block of the index */
+#define LAS_INDEX_BLOCK_POINTS 65536
+
+/* extents of blocks of consecutive points of a LAS file
+ *
+ * The index is stored next to the LAS file with the extension
+ * .lidx added to its name. */
+struct LasIndex
+{
+    unsigned long num_points;
+    unsigned int block_points;
+    unsigned int num_blocks;
+    double *bounds;             /* west, east, south, north of each block */
+};
+
+/* reads the points of the blocks intersecting a box */
+struct LasIndexReader
+{
+    LASReaderH reader;
+    const struct LasIndex *index;       /* NULL to read all points */
+    double west, east, south, north;
+    unsigned int block;         /* next block to check */
+    unsigned int next;          /* block following the current position */
+    unsigned int left;          /* points left in the current block */
+    unsigned long skipped;      /* points in blocks outside of the box */
+};
+
+int las_index_read(const char *file, unsigned long num_points,
+                   struct LasIndex *index);
+int las_index_build(const char *file, struct LasIndex *index, int write);
+int las_index_get(const char *file, int build, struct LasIndex *index);
+void las_index_free(struct LasIndex *index);
+int las_index_intersects(const struct LasIndex *index, double west,
+                         double east, double south, double north);
+
+void las_index_reader_init(struct LasIndexReader *reader,
+                           LASReaderH las_reader,
+                           const struct LasIndex *index, double west,
+                           double east, double south, double north);
+LASPointH las_index_next_point(struct LasIndexReader *reader);
+
+#endif /* __LAS_INDEX_H__ */
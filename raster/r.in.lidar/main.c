@@ -34,6 +34,12 @@
 #include "rast_segment.h"
 #include "point_binning.h"
 #include "filters.h"
+#include "las_index.h"
+
+/* points read before they are binned */
+#define BLOCK_POINTS 262144
+/* output rows computed at once by each thread */
+#define BLOCK_ROWS 16
 
 
 int main(int argc, char *argv[])
@@ -51,7 +57,7 @@ int main(int argc, char *argv[])
     SEGMENT base_segment;
     struct PointBinning point_binning;
     void *base_array;
-    void *raster_row;
+
     struct Cell_head region;
     struct Cell_head input_region;
     int rows, last_rows, row0, cols;		/* scan box size */
@@ -73,6 +79,11 @@ int main(int argc, char *argv[])
     double res = 0.0;
 
     struct BinIndex bin_index_nodes;
+    struct BinBlock bin_block;
+    struct LasIndex *las_indexes;
+    struct LasIndexReader index_reader;
+    void **raster_rows;
+    int nrows_block;
     bin_index_nodes.num_nodes = 0;
     bin_index_nodes.max_nodes = 0;
     bin_index_nodes.nodes = 0;
@@ -83,12 +94,12 @@ int main(int argc, char *argv[])
     struct Option *zrange_opt, *zscale_opt;
     struct Option *irange_opt, *iscale_opt;
     struct Option *trim_opt, *pth_opt, *res_opt;
-    struct Option *file_list_opt;
+    struct Option *file_list_opt, *nprocs_opt;
     struct Flag *print_flag, *scan_flag, *shell_style, *over_flag, *extents_flag;
     struct Flag *intens_flag, *intens_import_flag;
     struct Flag *set_region_flag;
     struct Flag *base_rast_res_flag;
-    struct Flag *only_valid_flag;
+    struct Flag *only_valid_flag, *index_flag;
 
     /* LAS */
     LASReaderH LAS_reader;
@@ -271,6 +282,8 @@ int main(int argc, char *argv[])
                                "If not specified, all points are imported.");
     class_opt->guisection = _("Selection");
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     print_flag = G_define_flag();
     print_flag->key = 'p';
     print_flag->description =
@@ -340,6 +353,14 @@ int main(int argc, char *argv[])
           " filtered out");
     only_valid_flag->guisection = _("Selection");
 
+    index_flag = G_define_flag();
+    index_flag->key = 'x';
+    index_flag->label = _("Create spatial index of input files");
+    index_flag->description =
+        _("Write index files (.lidx) next to the input files to read only"
+          " the parts of the files in the region later");
+    index_flag->guisection = _("Input");
+
     G_option_required(input_opt, file_list_opt, NULL);
     G_option_exclusive(input_opt, file_list_opt, NULL);
     G_option_required(output_opt, print_flag, scan_flag, shell_style, NULL);
@@ -349,6 +370,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
+
     int only_valid = FALSE;
     n_invalid = 0;
     if (only_valid_flag->answer)
@@ -607,8 +630,16 @@ int main(int argc, char *argv[])
     /* open output map */
     out_fd = Rast_open_new(outmap, rtype);
 
-    /* allocate memory for a single row of output data */
-    raster_row = Rast_allocate_output_buf(rtype);
+    /* allocate memory for blocks of rows of output data */
+    nrows_block = BLOCK_ROWS * (G_num_workers() + 1);
+    raster_rows = G_malloc(nrows_block * sizeof(void *));
+    for (row = 0; row < nrows_block; row++)
+        raster_rows[row] = Rast_allocate_output_buf(rtype);
+
+    /* spatial indexes are used for all passes */
+    las_indexes = G_calloc(infiles.num_items, sizeof(struct LasIndex));
+    for (i = 0; i < infiles.num_items; i++)
+        las_index_get(infiles.items[i], index_flag->answer, &las_indexes[i]);
 
     G_message(_("Reading data..."));
 
@@ -636,21 +667,37 @@ int main(int argc, char *argv[])
 	G_debug(2, "pass=%d/%d  rows=%d", pass, npasses, rows);
 
         point_binning_allocate(&point_binning, rows, cols, rtype);
+        bin_block_init(&bin_block, BLOCK_POINTS, rows);
 
 	line = 0;
 	count = 0;
 	counter = 0;
 	G_percent_reset();
 
+        /* box of the current pass */
+        double pass_north = region.north - row0 * region.ns_res;
+        double pass_south = pass_north - rows * region.ns_res;
+
         /* loop of input files */
         for (i = 0; i < infiles.num_items; i++) {
             infile = infiles.items[i];
+            /* files without points in the box are not opened */
+            if (las_indexes[i].bounds &&
+                !las_index_intersects(&las_indexes[i], region.west,
+                                      region.east, pass_south, pass_north)) {
+                G_debug(2, "skipping file <%s>", infile);
+                line += las_indexes[i].num_points;
+                continue;
+            }
             /* we already know file is there, so just do basic checks */
             LAS_reader = LASReader_Create(infile);
             if (LAS_reader == NULL)
                 G_fatal_error(_("Unable to open file <%s>"), infile);
+            las_index_reader_init(&index_reader, LAS_reader, &las_indexes[i],
+                                  region.west, region.east, pass_south,
+                                  pass_north);
 
-            while ((LAS_point = LASReader_GetNextPoint(LAS_reader)) != NULL) {
+            while ((LAS_point = las_index_next_point(&index_reader)) != NULL) {
                 line++;
                 counter++;
 
@@ -744,12 +791,26 @@ int main(int argc, char *argv[])
                 count++;
                 /*          G_debug(5, "x: %f, y: %f, z: %f", x, y, z); */
 
-                update_value(&point_binning, &bin_index_nodes, cols,
-                             arr_row, arr_col, rtype, x, y, z);
+                struct BinPoint *bin_point =
+                    &bin_block.points[bin_block.num_points++];
+
+                bin_point->row = arr_row;
+                bin_point->col = arr_col;
+                bin_point->x = x;
+                bin_point->y = y;
+                bin_point->z = z;
+                if (bin_block.num_points == bin_block.max_points)
+                    update_values(&point_binning, &bin_index_nodes,
+                                  &bin_block, cols, rtype);
             }                        /* while !EOF of one input file */
+            /* points not read are counted as well */
+            line += index_reader.skipped;
             /* close input LAS file */
             LASReader_Destroy(LAS_reader);
         }           /* end of loop for all input files files */
+        update_values(&point_binning, &bin_index_nodes, &bin_block, cols,
+                      rtype);
+        bin_block_free(&bin_block);
 
 	G_percent(1, 1, 1);	/* flush */
 	G_debug(2, "pass %d finished, %lu coordinates in box", pass, count);
@@ -758,27 +819,36 @@ int main(int argc, char *argv[])
 
 	/* calc stats and output */
 	G_message(_("Writing output raster map..."));
-	for (row = 0; row < rows; row++) {
+	for (row = 0; row < rows; row += nrows_block) {
+            int nrows = rows - row < nrows_block ? rows - row : nrows_block;
+            int i;
+
             /* potentially vector writing can be independent on the binning */
-            write_values(&point_binning, &bin_index_nodes, raster_row, row,
-                         cols, rtype, NULL);
+            write_values_rows(&point_binning, &bin_index_nodes, raster_rows,
+                              row, nrows, cols, rtype);
 
             G_percent(row, rows, 10);
 
-	    /* write out line of raster data */
-            Rast_put_row(out_fd, raster_row, rtype);
+	    /* write out lines of raster data */
+            for (i = 0; i < nrows; i++)
+                Rast_put_row(out_fd, raster_rows[i], rtype);
 	}
 
 	/* free memory */
 	point_binning_free(&point_binning, &bin_index_nodes);
     }				/* passes loop */
+    for (i = 0; i < infiles.num_items; i++)
+        las_index_free(&las_indexes[i]);
+    G_free(las_indexes);
     if (base_array)
         Rast_close(base_raster);
     if (use_segment)
         Segment_close(&base_segment);
 
     G_percent(1, 1, 1);		/* flush */
-    G_free(raster_row);
+    for (row = 0; row < nrows_block; row++)
+        G_free(raster_rows[row]);
+    G_free(raster_rows);
 
     G_message(_("%lu points found in input file(s)"), line_total);
 
@@ -843,3 +843,151 @@ void update_value(struct PointBinning *point_binning,
                            rtype, y, n);
     }
 }
+
+/* bands per thread, to balance unevenly distributed points */
+#define BANDS_PER_THREAD 4
+
+void bin_block_init(struct BinBlock *block, int max_points, int rows)
+{
+    int nthreads = G_num_workers() + 1;
+
+    block->num_points = 0;
+    block->max_points = max_points;
+    block->points = G_malloc((size_t) max_points * sizeof(struct BinPoint));
+    block->sorted = NULL;
+    block->num_bands = 1;
+    block->band_rows = rows > 0 ? rows : 1;
+    if (nthreads > 1 && rows > 1) {
+        block->num_bands = BANDS_PER_THREAD * nthreads;
+        if (block->num_bands > rows)
+            block->num_bands = rows;
+        block->band_rows = (rows + block->num_bands - 1) / block->num_bands;
+        block->num_bands = (rows + block->band_rows - 1) / block->band_rows;
+        block->sorted =
+            G_malloc((size_t) max_points * sizeof(struct BinPoint));
+    }
+    block->band_start = G_calloc(block->num_bands + 1, sizeof(int));
+}
+
+void bin_block_free(struct BinBlock *block)
+{
+    G_free(block->points);
+    G_free(block->sorted);
+    G_free(block->band_start);
+    block->points = block->sorted = NULL;
+    block->band_start = NULL;
+    block->num_points = block->max_points = 0;
+}
+
+struct bin_bands
+{
+    struct PointBinning *point_binning;
+    struct BinBlock *block;
+    int cols;
+    RASTER_MAP_TYPE rtype;
+};
+
+static void bin_bands(int first, int last, void *closure)
+{
+    const struct bin_bands *b = closure;
+    const struct BinBlock *block = b->block;
+    int band, i;
+
+    for (band = first; band < last; band++) {
+        for (i = block->band_start[band]; i < block->band_start[band + 1];
+             i++) {
+            const struct BinPoint *p = &block->sorted[i];
+
+            update_value(b->point_binning, NULL, b->cols, p->row, p->col,
+                         b->rtype, p->x, p->y, p->z);
+        }
+    }
+}
+
+/* bin all points of the block and empty it
+ *
+ * The points are grouped by bands of rows keeping their order, so
+ * that each cell is updated by one thread in the order of input
+ * and the result does not depend on the number of threads. The
+ * linked lists of the index methods share one node array and are
+ * always updated by the calling thread. */
+void update_values(struct PointBinning *point_binning,
+                   struct BinIndex *bin_index_nodes, struct BinBlock *block,
+                   int cols, RASTER_MAP_TYPE rtype)
+{
+    struct bin_bands b;
+    int *start = block->band_start;
+    int i;
+
+    if (block->num_bands == 1 || point_binning->bin_index) {
+        for (i = 0; i < block->num_points; i++) {
+            const struct BinPoint *p = &block->points[i];
+
+            update_value(point_binning, bin_index_nodes, cols, p->row,
+                         p->col, rtype, p->x, p->y, p->z);
+        }
+        block->num_points = 0;
+        return;
+    }
+
+    /* counting sort by band */
+    memset(start, 0, (block->num_bands + 1) * sizeof(int));
+    for (i = 0; i < block->num_points; i++)
+        start[block->points[i].row / block->band_rows + 1]++;
+    for (i = 0; i < block->num_bands; i++)
+        start[i + 1] += start[i];
+    for (i = 0; i < block->num_points; i++) {
+        const struct BinPoint *p = &block->points[i];
+
+        block->sorted[start[p->row / block->band_rows]++] = *p;
+    }
+    /* start of each band again */
+    for (i = block->num_bands; i > 0; i--)
+        start[i] = start[i - 1];
+    start[0] = 0;
+
+    b.point_binning = point_binning;
+    b.block = block;
+    b.cols = cols;
+    b.rtype = rtype;
+    G_parallel_for(0, block->num_bands, 1, bin_bands, &b);
+
+    block->num_points = 0;
+}
+
+struct write_rows
+{
+    struct PointBinning *point_binning;
+    struct BinIndex *bin_index_nodes;
+    void **raster_rows;
+    int row;
+    int cols;
+    RASTER_MAP_TYPE rtype;
+};
+
+static void write_rows(int first, int last, void *closure)
+{
+    const struct write_rows *w = closure;
+    int i;
+
+    for (i = first; i < last; i++)
+        write_values(w->point_binning, w->bin_index_nodes,
+                     w->raster_rows[i], w->row + i, w->cols, w->rtype, NULL);
+}
+
+/* compute the output values of nrows rows starting at row by
+ * several threads, vector output is not supported */
+void write_values_rows(struct PointBinning *point_binning,
+                       struct BinIndex *bin_index_nodes, void **raster_rows,
+                       int row, int nrows, int cols, RASTER_MAP_TYPE rtype)
+{
+    struct write_rows w;
+
+    w.point_binning = point_binning;
+    w.bin_index_nodes = bin_index_nodes;
+    w.raster_rows = raster_rows;
+    w.row = row;
+    w.cols = cols;
+    w.rtype = rtype;
+    G_parallel_for(0, nrows, 0, write_rows, &w);
+}
@@ -115,5 +115,37 @@ void update_value(struct PointBinning *point_binning,
                   int arr_col, RASTER_MAP_TYPE rtype, double x, double y,
                   double z);
 
+/* point in the current array box, waiting to be binned */
+struct BinPoint
+{
+    int row;
+    int col;
+    double x;
+    double y;
+    double z;
+};
+
+/* block of points binned by several threads, each thread
+ * updates the cells of its own band of rows */
+struct BinBlock
+{
+    int num_points;
+    int max_points;
+    struct BinPoint *points;    /* in input order */
+    struct BinPoint *sorted;    /* grouped by band */
+    int num_bands;
+    int band_rows;
+    int *band_start;
+};
+
+void bin_block_init(struct BinBlock *block, int max_points, int rows);
+void bin_block_free(struct BinBlock *block);
+void update_values(struct PointBinning *point_binning,
+                   struct BinIndex *bin_index_nodes, struct BinBlock *block,
+                   int cols, RASTER_MAP_TYPE rtype);
+void write_values_rows(struct PointBinning *point_binning,
+                       struct BinIndex *bin_index_nodes, void **raster_rows,
+                       int row, int nrows, int cols, RASTER_MAP_TYPE rtype);
+
 
 #endif /* __POINT_BINNING_H__ */
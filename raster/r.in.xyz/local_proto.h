@@ -48,5 +48,30 @@ int update_max(void *, int, int, int, RASTER_MAP_TYPE, double);
 int update_sum(void *, int, int, int, RASTER_MAP_TYPE, double);
 int update_sumsq(void *, int, int, int, RASTER_MAP_TYPE, double);
 
+/* point waiting to be binned into the n, min, max, sum and sumsq arrays */
+struct bin_point
+{
+    int row, col;
+    double z;
+};
+
+/* block of points binned by several threads, each thread updates
+ * the cells of its own bands of rows */
+struct bin_block
+{
+    void *n_array, *min_array, *max_array, *sum_array, *sumsq_array;
+    int cols;
+    RASTER_MAP_TYPE rtype;
+    int num_points, max_points;
+    struct bin_point *points;	/* in input order */
+    struct bin_point *sorted;	/* grouped by band */
+    int num_bands, band_rows;
+    int *band_start;
+};
+
+void bin_block_init(struct bin_block *, int, int, int, RASTER_MAP_TYPE);
+void bin_block_free(struct bin_block *);
+void bin_block_flush(struct bin_block *);
+
 
 #endif /* __LOCAL_PROTO_H__ */
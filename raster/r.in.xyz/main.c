@@ -26,6 +26,9 @@
 #include <grass/glocale.h>
 #include "local_proto.h"
 
+/* points read before they are binned */
+#define BLOCK_POINTS 262144
+
 struct node
 {
     int next;
@@ -114,6 +117,7 @@ int main(int argc, char *argv[])
     char title[64];
     void *n_array, *min_array, *max_array, *sum_array, *sumsq_array,
 	*index_array;
+    struct bin_block block;
     void *raster_row, *ptr;
     struct Cell_head region;
     int rows, last_rows, row0, cols;		/* scan box size */
@@ -148,7 +152,7 @@ int main(int argc, char *argv[])
 	*type_opt;
     struct Option *method_opt, *xcol_opt, *ycol_opt, *zcol_opt, *zrange_opt,
 	*zscale_opt, *vcol_opt, *vrange_opt, *vscale_opt, *skip_opt;
-    struct Option *trim_opt, *pth_opt;
+    struct Option *trim_opt, *pth_opt, *nprocs_opt;
     struct Flag *scan_flag, *shell_style, *skipline;
 
 
@@ -323,6 +327,8 @@ int main(int argc, char *argv[])
 	_("Discard <trim> percent of the smallest and <trim> percent of the largest observations");
     trim_opt->guisection = _("Statistic");
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     scan_flag = G_define_flag();
     scan_flag->key = 's';
     scan_flag->description = _("Scan data file for extent then exit");
@@ -347,6 +353,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
+
 
     /* parse input values */
     infile = input_opt->answer;
@@ -694,6 +702,13 @@ int main(int argc, char *argv[])
 	    blank_array(index_array, rows, cols, CELL_TYPE, -1);	/* fill with NULLs */
 	}
 
+	block.n_array = bin_n ? n_array : NULL;
+	block.min_array = bin_min ? min_array : NULL;
+	block.max_array = bin_max ? max_array : NULL;
+	block.sum_array = bin_sum ? sum_array : NULL;
+	block.sumsq_array = bin_sumsq ? sumsq_array : NULL;
+	bin_block_init(&block, BLOCK_POINTS, rows, cols, rtype);
+
 	line = 0;
 	count = 0;
 	G_percent_reset();
@@ -796,16 +811,15 @@ int main(int argc, char *argv[])
 	    /* G_debug(5, "x: %f, y: %f, z: %f", x, y, z); */
 	    G_free_tokens(tokens);
 
-	    if (bin_n)
-		update_n(n_array, cols, arr_row, arr_col);
-	    if (bin_min)
-		update_min(min_array, cols, arr_row, arr_col, rtype, z);
-	    if (bin_max)
-		update_max(max_array, cols, arr_row, arr_col, rtype, z);
-	    if (bin_sum)
-		update_sum(sum_array, cols, arr_row, arr_col, rtype, z);
-	    if (bin_sumsq)
-		update_sumsq(sumsq_array, cols, arr_row, arr_col, rtype, z);
+	    if (bin_n || bin_min || bin_max || bin_sum || bin_sumsq) {
+		struct bin_point *p = &block.points[block.num_points++];
+
+		p->row = arr_row;
+		p->col = arr_col;
+		p->z = z;
+		if (block.num_points == block.max_points)
+		    bin_block_flush(&block);
+	    }
 	    if (bin_index) {
 		ptr = index_array;
 		ptr =
@@ -828,6 +842,8 @@ int main(int argc, char *argv[])
 		}
 	    }
 	}			/* while !EOF */
+	bin_block_flush(&block);
+	bin_block_free(&block);
 
 	G_percent(1, 1, 1);	/* flush */
 	G_debug(2, "pass %d finished, %lu coordinates in box", pass, count);
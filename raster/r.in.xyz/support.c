@@ -8,6 +8,7 @@
  *
  */
 
+#include <string.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include "local_proto.h"
@@ -128,3 +129,110 @@ int update_sumsq(void *array, int cols, int row, int col,
 
     return 0;
 }
+
+
+/* bands per thread, to balance unevenly distributed points */
+#define BANDS_PER_THREAD 4
+
+/* the arrays must be set by the caller, NULL for those not binned */
+void bin_block_init(struct bin_block *block, int max_points, int rows,
+		    int cols, RASTER_MAP_TYPE rtype)
+{
+    int nthreads = G_num_workers() + 1;
+
+    block->cols = cols;
+    block->rtype = rtype;
+    block->num_points = 0;
+    block->max_points = max_points;
+    block->points = G_malloc((size_t)max_points * sizeof(struct bin_point));
+    block->sorted = NULL;
+    block->num_bands = 1;
+    block->band_rows = rows > 0 ? rows : 1;
+    if (nthreads > 1 && rows > 1) {
+	block->num_bands = BANDS_PER_THREAD * nthreads;
+	if (block->num_bands > rows)
+	    block->num_bands = rows;
+	block->band_rows = (rows + block->num_bands - 1) / block->num_bands;
+	block->num_bands = (rows + block->band_rows - 1) / block->band_rows;
+	block->sorted =
+	    G_malloc((size_t)max_points * sizeof(struct bin_point));
+    }
+    block->band_start = G_calloc(block->num_bands + 1, sizeof(int));
+}
+
+void bin_block_free(struct bin_block *block)
+{
+    G_free(block->points);
+    G_free(block->sorted);
+    G_free(block->band_start);
+    block->points = block->sorted = NULL;
+    block->band_start = NULL;
+    block->num_points = block->max_points = 0;
+}
+
+static void bin_point(const struct bin_block *block,
+		      const struct bin_point *p)
+{
+    int cols = block->cols;
+    RASTER_MAP_TYPE rtype = block->rtype;
+
+    if (block->n_array)
+	update_n(block->n_array, cols, p->row, p->col);
+    if (block->min_array)
+	update_min(block->min_array, cols, p->row, p->col, rtype, p->z);
+    if (block->max_array)
+	update_max(block->max_array, cols, p->row, p->col, rtype, p->z);
+    if (block->sum_array)
+	update_sum(block->sum_array, cols, p->row, p->col, rtype, p->z);
+    if (block->sumsq_array)
+	update_sumsq(block->sumsq_array, cols, p->row, p->col, rtype, p->z);
+}
+
+static void bin_bands(int first, int last, void *closure)
+{
+    const struct bin_block *block = closure;
+    int band, i;
+
+    for (band = first; band < last; band++)
+	for (i = block->band_start[band]; i < block->band_start[band + 1];
+	     i++)
+	    bin_point(block, &block->sorted[i]);
+}
+
+/* bin all points of the block and empty it
+ *
+ * The points are grouped by bands of rows keeping their order, so
+ * each cell is updated by one thread in the order of input and the
+ * result does not depend on the number of threads. */
+void bin_block_flush(struct bin_block *block)
+{
+    int *start = block->band_start;
+    int i;
+
+    if (block->num_bands == 1) {
+	for (i = 0; i < block->num_points; i++)
+	    bin_point(block, &block->points[i]);
+	block->num_points = 0;
+	return;
+    }
+
+    /* counting sort by band */
+    memset(start, 0, (block->num_bands + 1) * sizeof(int));
+    for (i = 0; i < block->num_points; i++)
+	start[block->points[i].row / block->band_rows + 1]++;
+    for (i = 0; i < block->num_bands; i++)
+	start[i + 1] += start[i];
+    for (i = 0; i < block->num_points; i++) {
+	const struct bin_point *p = &block->points[i];
+
+	block->sorted[start[p->row / block->band_rows]++] = *p;
+    }
+    /* start of each band again */
+    for (i = block->num_bands; i > 0; i--)
+	start[i] = start[i - 1];
+    start[0] = 0;
+
+    G_parallel_for(0, block->num_bands, 1, bin_bands, block);
+
+    block->num_points = 0;
+}
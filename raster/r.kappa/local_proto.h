@@ -17,7 +17,7 @@ void prn_error_mat(int out_cols, int hdr);
 void prn2csv_error_mat(int out_cols, int hdr);
 
 /* stats.c */
-int stats(void);
+int stats(int);
 
 /* sum.c */
 long count_sum(int *ns, int n1);
@@ -37,7 +37,6 @@ const char *title;
 long *matr;
 long *rlst;
 int ncat;
-const char *stats_file;
 
 LAYER *layers;
 int nlayers;
@@ -54,7 +53,7 @@ int main(int argc, char **argv)
     struct GModule *module;
     struct
     {
-	struct Option *map, *ref, *output, *titles;
+	struct Option *map, *ref, *output, *titles, *nprocs;
     } parms;
 
     struct
@@ -97,6 +96,8 @@ int main(int argc, char **argv)
     parms.titles->answer = "ACCURACY ASSESSMENT";
     parms.titles->guisection = _("Output settings");
 
+    parms.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flags.w = G_define_flag();
     flags.w->key = 'w';
     flags.w->label = _("Wide report");
@@ -127,8 +128,8 @@ int main(int argc, char **argv)
 
     title = parms.titles->answer;
 
-    /* run r.stats to obtain statistics of map layers */
-    stats();
+    /* count the cells of each pair of categories of the map layers */
+    stats(G_set_nprocs(parms.nprocs));
 
     if(flags.m->answer)
     {
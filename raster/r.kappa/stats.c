@@ -1,89 +1,166 @@
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
 #include <grass/gis.h>
-#include <grass/spawn.h>
+#include <grass/raster.h>
 #include "kappa.h"
 #include <grass/glocale.h>
 #include "local_proto.h"
 
+/* the cells are counted by their pair of categories (reference,
+ * classification) in hash tables (Cell_table), one table for each
+ * thread. The tables are merged into the sorted list of counts used
+ * by the reports. FP maps are read as integer maps, using their quant
+ * rules, and cells NULL in either map are not counted. */
 
-static void die(void)
+#define BLOCK_ROWS 16		/* rows per thread in a block of rows */
+
+struct block
+{
+    CELL **cell[2];		/* by row of the block, for both maps */
+    int ncols;
+    int chunk;			/* rows per thread */
+    struct Cell_table *tables;	/* count (long) of each pair */
+};
+
+static void table_add(struct Cell_table *t, const CELL *key, long count)
 {
-    unlink(stats_file);
-    G_fatal_error(_("Problem reading r.stats output"));
+    *(long *)Rast_add_cell_table_key(t, key) += count;
 }
 
+static void count_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct Cell_table *t = &blk->tables[first / blk->chunk];
+    int row, col;
+
+    for (row = first; row < last; row++) {
+	const CELL *ref = blk->cell[0][row];
+	const CELL *class = blk->cell[1][row];
+	CELL key[2];
+	long run = 0;
+
+	/* cells of the same pair are often next to each other */
+	for (col = 0; col < blk->ncols; col++) {
+	    if (Rast_is_c_null_value(&ref[col]) ||
+		Rast_is_c_null_value(&class[col]))
+		continue;
+	    if (run > 0 && ref[col] == key[0] && class[col] == key[1]) {
+		run++;
+		continue;
+	    }
+	    if (run > 0)
+		table_add(t, key, run);
+	    key[0] = ref[col];
+	    key[1] = class[col];
+	    run = 1;
+	}
+	if (run > 0)
+	    table_add(t, key, run);
+    }
+}
 
-int stats(void)
+static int compare_stats(const void *aa, const void *bb)
 {
-    char buf[1024];
-    char mname[GNAME_MAX], rname[GMAPSET_MAX];
-    const char *mmapset, *rmapset;
-    int i, nl;
-    size_t ns;
-    FILE *fd;
-    char **tokens;
-    const char *argv[9];
-    int argc = 0;
+    const GSTATS *a = aa, *b = bb;
+    int nl;
+
+    for (nl = 0; nl < nlayers; nl++) {
+	if (a->cats[nl] < b->cats[nl])
+	    return -1;
+	if (a->cats[nl] > b->cats[nl])
+	    return 1;
+    }
 
-    strcpy(mname, maps[0]);
-    mmapset = G_find_raster2(mname, "");
-    if (mmapset == NULL)
-	G_fatal_error(_("Raster map <%s> not found"), maps[0]);
+    return 0;
+}
 
-    strcpy(rname, maps[1]);
-    rmapset = G_find_raster2(rname, "");
-    if (rmapset == NULL)
-	G_fatal_error(_("Raster map <%s> not found"), maps[1]);
+/* merge the tables into Gstats, sorted by categories */
+static void collect_stats(struct Cell_table *tables, int ntables)
+{
+    size_t n = 0, i;
+    int k;
+
+    for (k = 0; k < ntables; k++)
+	n += tables[k].used;
+
+    Gstats = (GSTATS *) G_malloc((n > 0 ? n : 1) * sizeof(GSTATS));
+    for (k = 0, n = 0; k < ntables; k++) {
+	const CELL *key;
+	void *count;
+	size_t slot = 0;
+
+	while (Rast_next_cell_table_entry(&tables[k], &slot, &key, &count)) {
+	    Gstats[n].cats = (long *)G_calloc(nlayers, sizeof(long));
+	    Gstats[n].cats[0] = key[0];
+	    Gstats[n].cats[1] = key[1];
+	    Gstats[n].count = *(long *)count;
+	    n++;
+	}
+    }
 
-    stats_file = G_tempfile();
+    qsort(Gstats, n, sizeof(GSTATS), compare_stats);
 
-    argv[argc++] = "r.stats";
+    /* the same pair may be counted by several threads */
+    for (i = 0, nstats = 0; i < n; i++) {
+	if (nstats > 0 && compare_stats(&Gstats[nstats - 1], &Gstats[i]) == 0) {
+	    Gstats[nstats - 1].count += Gstats[i].count;
+	    G_free(Gstats[i].cats);
+	}
+	else
+	    Gstats[nstats++] = Gstats[i];
+    }
+}
 
-    argv[argc++] = "-cin";
+int stats(int nprocs)
+{
+    struct block blk;
+    int nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    int fd[2];
+    int nrows, row, i, j;
+
+    nrows = Rast_window_rows();
+    blk.ncols = Rast_window_cols();
+
+    for (i = 0; i < 2; i++) {
+	fd[i] = Rast_open_old(layers[i].name, layers[i].mapset);
+	if (nprocs > 1)
+	    Rast_set_read_ahead(fd[i], nblock);
+
+	blk.cell[i] = (CELL **) G_malloc(nblock * sizeof(CELL *));
+	for (j = 0; j < nblock; j++)
+	    blk.cell[i][j] = Rast_allocate_c_buf();
+    }
 
-    argv[argc++] = "separator=:";
+    blk.tables = G_malloc(nprocs * sizeof(struct Cell_table));
+    for (i = 0; i < nprocs; i++)
+	Rast_init_cell_table(&blk.tables[i], 2, sizeof(long), 0);
 
-    sprintf(buf, "input=%s,%s",
-	    G_fully_qualified_name(mname, mmapset),
-	    G_fully_qualified_name(rname, rmapset));
-    argv[argc++] = buf;
+    for (row = 0; row < nrows; row += nblock) {
+	int n = nrows - row < nblock ? nrows - row : nblock;
 
-    argv[argc++] = SF_REDIRECT_FILE;
-    argv[argc++] = SF_STDOUT;
-    argv[argc++] = SF_MODE_OUT;
-    argv[argc++] = stats_file;
+	G_percent(row, nrows, 2);
 
-    argv[argc++] = NULL;
+	for (j = 0; j < n; j++)
+	    for (i = 0; i < 2; i++)
+		Rast_get_c_row(fd[i], blk.cell[i][j], row + j);
 
-    if (G_vspawn_ex(argv[0], argv) != 0) {
-	remove(stats_file);
-	G_fatal_error("error running r.stats");
+	blk.chunk = (n + nprocs - 1) / nprocs;
+	G_parallel_for(0, n, blk.chunk, count_rows, &blk);
     }
+    G_percent(nrows, nrows, 2);
 
-    fd = fopen(stats_file, "r");
-    if (fd == NULL) {
-	unlink(stats_file);
-	sprintf(buf, "Unable to open result file <%s>\n", stats_file);
-    }
+    collect_stats(blk.tables, nprocs);
 
-    while (G_getl(buf, sizeof buf, fd)) {
-	tokens = G_tokenize(buf, ":");
-	i = 0;
-	ns = nstats++;
-	Gstats = (GSTATS *) G_realloc(Gstats, nstats * sizeof(GSTATS));
-	Gstats[ns].cats = (long *)G_calloc(nlayers, sizeof(long));
-	for (nl = 0; nl < nlayers; nl++) {
-	    if (sscanf(tokens[i++], "%ld", &Gstats[ns].cats[nl]) != 1)
-		die();
-	}
-	if (sscanf(tokens[i++], "%ld", &Gstats[ns].count) != 1)
-	    die();
-	G_free_tokens(tokens);
+    for (i = 0; i < nprocs; i++)
+	Rast_free_cell_table(&blk.tables[i]);
+    G_free(blk.tables);
+
+    for (i = 0; i < 2; i++) {
+	for (j = 0; j < nblock; j++)
+	    G_free(blk.cell[i][j]);
+	G_free(blk.cell[i]);
+	Rast_close(fd[i]);
     }
-    fclose(fd);
-    unlink(stats_file);
 
     return 0;
 }
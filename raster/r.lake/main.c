@@ -23,7 +23,6 @@
  *
  *  BUGS:        - Lake (seed) map cannot be negative!
  *               - Negative output (-n) maps cannot be used as input.
- *               - Code is not large file safe (i.e. array with whole map).
  *
  *****************************************************************************/
 
@@ -37,15 +36,112 @@
 
 #include <grass/gis.h>
 #include <grass/raster.h>
+#include <grass/bitmap.h>
 #include <grass/glocale.h>
 
-/* Saves map file from 2d array. NULL must be 0. Also meanwhile calculates area and volume. */
-void save_map(FCELL ** out, int out_fd, int rows, int cols, int flag,
+/* list of cells, as row * cols + col */
+struct cell_list
+{
+    size_t *cells;
+    size_t n, alloc;
+};
+
+/* lake flooded from the seeds at rising water levels */
+struct flood
+{
+    int rows, cols;
+    FCELL **terrain;
+    struct BM *wet;		/* cells under water */
+    struct BM *shore;		/* dry cells next to the water */
+    struct cell_list queue;	/* flooded cells to spread from */
+    struct cell_list shore_cells;	/* checked again at higher levels */
+};
+
+static void add_cell(struct cell_list *list, size_t cell)
+{
+    if (list->n == list->alloc) {
+	list->alloc = list->alloc ? 2 * list->alloc : 1024;
+	list->cells = G_realloc(list->cells, list->alloc * sizeof(size_t));
+    }
+    list->cells[list->n++] = cell;
+}
+
+/* Floods a cell if it is below the water level, remembers it as shore
+ * otherwise. Returns 1 if the cell got flooded. */
+static int visit_cell(struct flood *f, int row, int col, FCELL water_level)
+{
+    FCELL elev = f->terrain[row][col];
+
+    if (BM_get(f->wet, col, row))
+	return 0;
+
+    if (elev < water_level) {
+	BM_set(f->wet, col, row, 1);
+	add_cell(&f->queue, (size_t)row * f->cols + col);
+	return 1;
+    }
+
+    /* NULL terrain is never flooded */
+    if (!Rast_is_f_null_value(&elev) && !BM_get(f->shore, col, row)) {
+	BM_set(f->shore, col, row, 1);
+	add_cell(&f->shore_cells, (size_t)row * f->cols + col);
+    }
+
+    return 0;
+}
+
+/* Raises the water to the given level, which must not be lower than
+ * the previous one. Each cell enters the queue once for all levels. */
+static void flood_to_level(struct flood *f, FCELL water_level)
+{
+    size_t i, n, next;
+    int row, col, i_row, i_col;
+
+    /* shore cells below the new level are flooded first */
+    n = 0;
+    for (i = 0; i < f->shore_cells.n; i++) {
+	size_t cell = f->shore_cells.cells[i];
+
+	row = cell / f->cols;
+	col = cell % f->cols;
+	if (BM_get(f->wet, col, row))
+	    continue;
+	if (f->terrain[row][col] < water_level) {
+	    BM_set(f->wet, col, row, 1);
+	    add_cell(&f->queue, cell);
+	}
+	else
+	    f->shore_cells.cells[n++] = cell;
+    }
+    f->shore_cells.n = n;
+
+    /* breadth-first search in the 3x3 neighbourhood */
+    for (next = 0; next < f->queue.n; next++) {
+	size_t cell = f->queue.cells[next];
+
+	row = cell / f->cols;
+	col = cell % f->cols;
+	for (i_row = row - 1; i_row <= row + 1; i_row++) {
+	    if (i_row < 0 || i_row >= f->rows)
+		continue;
+	    for (i_col = col - 1; i_col <= col + 1; i_col++) {
+		if (i_col < 0 || i_col >= f->cols)
+		    continue;
+		visit_cell(f, i_row, i_col, water_level);
+	    }
+	}
+    }
+    f->queue.n = 0;
+}
+
+/* Saves lake map at given water level. Also meanwhile calculates area and volume. */
+void save_map(struct flood *f, FCELL water_level, int out_fd, int flag,
 	      FCELL * min_depth, FCELL * max_depth, double *area,
 	      double *volume)
 {
     int row, col;
     double cellsize = -1;
+    FCELL *out;
 
     G_debug(1, "Saving new map");
 
@@ -54,89 +150,55 @@ void save_map(FCELL ** out, int out_fd, int rows, int cols, int flag,
     }
     G_debug(1, "Cell area: %f", cellsize);
 
-    for (row = 0; row < rows; row++) {
+    out = Rast_allocate_f_buf();
+
+    for (row = 0; row < f->rows; row++) {
 	if (cellsize == -1)	/* Get LatLon current rows cell size */
 	    cellsize = G_area_of_cell_at_row(row);
-	for (col = 0; col < cols; col++) {
-	    if (flag == 1)	/* Create negative map */
-		out[row][col] = 0 - out[row][col];
-	    if (out[row][col] == 0) {
-		Rast_set_f_null_value(&out[row][col], 1);
-	    }
-	    if (out[row][col] > 0 || out[row][col] < 0) {
-		G_debug(5, "volume %f += cellsize %f  * value %f [%d,%d]",
-			*volume, cellsize, out[row][col], row, col);
-		*area += cellsize;
-		*volume += cellsize * out[row][col];
+	for (col = 0; col < f->cols; col++) {
+	    if (!BM_get(f->wet, col, row)) {
+		Rast_set_f_null_value(&out[col], 1);
+		continue;
 	    }
+	    out[col] = water_level - f->terrain[row][col];
+	    if (flag == 1)	/* Create negative map */
+		out[col] = 0 - out[col];
+	    G_debug(5, "volume %f += cellsize %f  * value %f [%d,%d]",
+		    *volume, cellsize, out[col], row, col);
+	    *area += cellsize;
+	    *volume += cellsize * out[col];
 
 	    /* Get min/max depth. Can be useful ;) */
-	    if (out[row][col] > *max_depth)
-		*max_depth = out[row][col];
-	    if (out[row][col] < *min_depth)
-		*min_depth = out[row][col];
+	    if (out[col] > *max_depth)
+		*max_depth = out[col];
+	    if (out[col] < *min_depth)
+		*min_depth = out[col];
 	}
-	Rast_put_f_row(out_fd, out[row]);
-	G_percent(row + 1, rows, 5);
+	Rast_put_f_row(out_fd, out);
+	G_percent(row + 1, f->rows, 5);
     }
-}
-
-/* Check water presence in sliding window */
-short is_near_water(FCELL window[][3])
-{
-    int i, j;
-
-    /* If center is under water */
-    if (window[1][1] > 0)
-	return 1;
 
-    for (i = 0; i < 3; i++) {
-	for (j = 0; j < 3; j++) {
-	    if (window[i][j] > 0)
-		return 1;
-	}
-    }
-    return 0;
+    G_free(out);
 }
 
-/* Loads values into window around central cell */
-void load_window_values(FCELL ** in_rows, FCELL window[][3],
-			int rows, int cols, int row, int col)
+static int cmp_level(const void *a, const void *b)
 {
-    int i, j;
-
-    rows -= 1;			/* Row'n'Col count starts from 0! */
-    cols -= 1;
+    const FCELL *la = *(const FCELL * const *)a;
+    const FCELL *lb = *(const FCELL * const *)b;
 
-    for (i = -1; i < 2; i++) {
-	if (row + i < 0 || row + i > rows) {	/* First or last line... */
-	    window[i + 1][0] = 0;
-	    window[i + 1][1] = 0;
-	    window[i + 1][2] = 0;
-	    continue;
-	}
-	else {
-	    for (j = -1; j < 2; j++) {
-		if (col + j < 0 || col + j > cols - 1) {	/* First or last column... */
-		    window[i + 1][j + 1] = 0;
-		    continue;
-		}
-		else {		/* All normal cases... */
-		    window[i + 1][j + 1] = in_rows[row + i][col + j];
-		}
-	    }
-	}
-    }
+    return (*la > *lb) - (*la < *lb);
 }
 
 int main(int argc, char *argv[])
 {
     char *terrainmap, *seedmap, *lakemap;
-    int rows, cols, in_terran_fd, out_fd, lake_fd, row, col, pases, pass;
-    int lastcount, curcount, start_col = 0, start_row = 0;
-    double east, north, area = 0, volume = 0;
-    FCELL **in_terran, **out_water, water_level, max_depth = 0, min_depth = 0;
-    FCELL water_window[3][3];
+    int rows, cols, in_terran_fd, out_fd, row, col;
+    int start_col = 0, start_row = 0, nlevels, i;
+    double east, north, area, volume;
+    FCELL *water_levels, **sorted_levels, water_level, max_depth, min_depth;
+    FCELL *seed_row;
+    struct flood flood;
+    struct cell_list seeds;
     struct Option *tmap_opt, *smap_opt, *wlvl_opt, *lake_opt, *sdxy_opt;
     struct Flag *negative_flag, *overwrite_flag;
     struct GModule *module;
@@ -157,9 +219,13 @@ int main(int argc, char *argv[])
 
     wlvl_opt = G_define_option();
     wlvl_opt->key = "water_level";
-    wlvl_opt->description = _("Water level");
+    wlvl_opt->label = _("Water level");
+    wlvl_opt->description =
+	_("With several levels, one lake map is created for each, "
+	  "named lake.1, lake.2, ...");
     wlvl_opt->type = TYPE_DOUBLE;
     wlvl_opt->required = YES;
+    wlvl_opt->multiple = YES;
 
     lake_opt = G_define_standard_option(G_OPT_R_OUTPUT);
     lake_opt->key = "lake";
@@ -212,14 +278,23 @@ int main(int argc, char *argv[])
     if (!lake_opt->answer && !overwrite_flag->answer)
 	G_fatal_error(_("Output lake map or overwrite flag must be set!"));
 
+    for (nlevels = 0; wlvl_opt->answers[nlevels]; nlevels++) ;
+
+    if (nlevels > 1 && overwrite_flag->answer)
+	G_fatal_error(_("Several water levels cannot be used with overwrite flag"));
+
     terrainmap = tmap_opt->answer;
     seedmap = smap_opt->answer;
-    sscanf(wlvl_opt->answer, "%f", &water_level);
     lakemap = lake_opt->answer;
 
-    /* If lakemap is set, write to it, else is set overwrite flag and we should write to seedmap. */
-    if (lakemap)
-	lake_fd = Rast_open_new(lakemap, 1);
+    /* The lakes are flooded from the lowest level up. */
+    water_levels = G_malloc(nlevels * sizeof(FCELL));
+    sorted_levels = G_malloc(nlevels * sizeof(FCELL *));
+    for (i = 0; i < nlevels; i++) {
+	sscanf(wlvl_opt->answers[i], "%f", &water_levels[i]);
+	sorted_levels[i] = &water_levels[i];
+    }
+    qsort(sorted_levels, nlevels, sizeof(FCELL *), cmp_level);
 
     rows = Rast_window_rows();
     cols = Rast_window_cols();
@@ -235,8 +310,8 @@ int main(int argc, char *argv[])
 	start_col = (int)Rast_easting_to_col(east, &window);
 	start_row = (int)Rast_northing_to_row(north, &window);
 
-	if (start_row < 0 || start_row > rows ||
-	    start_col < 0 || start_col > cols)
+	if (start_row < 0 || start_row >= rows ||
+	    start_col < 0 || start_col >= cols)
 	    G_fatal_error(_("Seed point outside the current region"));
     }
 
@@ -247,136 +322,114 @@ int main(int argc, char *argv[])
     if (smap_opt->answer)
 	out_fd = Rast_open_old(seedmap, "");
 
-    /* Pointers to rows. Row = ptr to 'col' size array. */
-    in_terran = (FCELL **) G_malloc(rows * sizeof(FCELL *));
-    out_water = (FCELL **) G_malloc(rows * sizeof(FCELL *));
-    if (in_terran == NULL || out_water == NULL)
-	G_fatal_error(_("G_malloc: out of memory"));
-
+    flood.rows = rows;
+    flood.cols = cols;
+    flood.terrain = (FCELL **) G_malloc(rows * sizeof(FCELL *));
+    flood.wet = BM_create_compressed(cols, rows);
+    flood.shore = BM_create_compressed(cols, rows);
+    flood.queue.cells = NULL;
+    flood.queue.n = flood.queue.alloc = 0;
+    flood.shore_cells = flood.queue;
+    seeds = flood.queue;
+    seed_row = Rast_allocate_f_buf();
 
     G_debug(1, "Loading maps...");
-    /* foo_rows[row] == array with data (2d array). */
+    /* terrain[row] == array with data (2d array). */
     for (row = 0; row < rows; row++) {
-	in_terran[row] = (FCELL *) G_malloc(cols * sizeof(FCELL));
-	out_water[row] = (FCELL *) G_calloc(cols, sizeof(FCELL));
+	flood.terrain[row] = (FCELL *) G_malloc(cols * sizeof(FCELL));
 
 	/* In newly created space load data from file. */
-	Rast_get_f_row(in_terran_fd, in_terran[row], row);
-
-	if (smap_opt->answer)
-	    Rast_get_f_row(out_fd, out_water[row], row);
+	Rast_get_f_row(in_terran_fd, flood.terrain[row], row);
+
+	/* Seed cells are those > 0 */
+	if (smap_opt->answer) {
+	    Rast_get_f_row(out_fd, seed_row, row);
+	    for (col = 0; col < cols; col++)
+		if (seed_row[col] > 0)
+		    add_cell(&seeds, (size_t)row * cols + col);
+	}
 
 	G_percent(row + 1, rows, 5);
     }
+    G_free(seed_row);
 
     /* Set seed point */
-    if (sdxy_opt->answer)
+    if (sdxy_opt->answer) {
 	/* Check is water level higher than seed point */
-	if (in_terran[start_row][start_col] >= water_level)
+	if (flood.terrain[start_row][start_col] >= *sorted_levels[0])
 	    G_fatal_error(_("Given water level at seed point is below earth surface. "
 			   "Increase water level or move seed point."));
-    out_water[start_row][start_col] = 1;
+	add_cell(&seeds, (size_t)start_row * cols + start_col);
+    }
 
     /* Close seed map for reading. */
     if (smap_opt->answer)
 	Rast_close(out_fd);
 
-    /* Open output map for writing. */
-    if (lakemap)
-	out_fd = lake_fd;
-    else
-	out_fd = Rast_open_new(seedmap, 1);
-
-    /* More pases are renudant. Real pases count is controlled by altered cell count. */
-    pases = (int)(rows * cols) / 2;
-
-    G_debug(1,
-	    "Starting lake filling at level of %8.4f in %d passes. Percent done:",
-	    water_level, pases);
-
-    lastcount = 0;
-
-    for (pass = 0; pass < pases; pass++) {
-	G_debug(3, "Pass: %d", pass);
-	curcount = 0;
-	/* Move from left upper corner to right lower corner. */
-	for (row = 0; row < rows; row++) {
-	    for (col = 0; col < cols; col++) {
-		/* Loading water data into window. */
-		load_window_values(out_water, water_window, rows, cols, row,
-				   col);
-
-		/* Cheking presence of water. */
-		if (is_near_water(water_window) == 1) {
-		    if (in_terran[row][col] < water_level) {
-			out_water[row][col] =
-			    water_level - in_terran[row][col];
-			curcount++;
-		    }
-		    else {
-			out_water[row][col] = 0;	/* Cell is higher than water level -> NULL. */
-		    }
-		}
-	    }
-	}
-	if (curcount == lastcount)
-	    break;		/* We done. */
-	lastcount = curcount;
-	curcount = 0;
-	/* Move backwards - from lower right corner to upper left corner. */
-	for (row = rows - 1; row >= 0; row--) {
-	    for (col = cols - 1; col >= 0; col--) {
-		load_window_values(out_water, water_window, rows, cols, row,
-				   col);
-
-		if (is_near_water(water_window) == 1) {
-		    if (in_terran[row][col] < water_level) {
-			out_water[row][col] =
-			    water_level - in_terran[row][col];
-			curcount++;
-		    }
-		    else {
-			out_water[row][col] = 0;
-		    }
-		}
-	    }
+    /* Seeds below the first level start the lake, the others are
+     * flooded like shore cells once the water is high enough. */
+    for (i = 0; i < seeds.n; i++)
+	visit_cell(&flood, seeds.cells[i] / cols, seeds.cells[i] % cols,
+		   *sorted_levels[0]);
+    G_free(seeds.cells);
+
+    for (i = 0; i < nlevels; i++) {
+	char name[GNAME_MAX];
+	const char *outmap;
+	int level = sorted_levels[i] - water_levels;
+
+	water_level = *sorted_levels[i];
+
+	G_debug(1, "Filling lake at level of %8.4f", water_level);
+	flood_to_level(&flood, water_level);
+
+	/* Open output map for writing. */
+	if (!lakemap)
+	    outmap = seedmap;
+	else if (nlevels == 1)
+	    outmap = lakemap;
+	else {
+	    sprintf(name, "%s.%d", lakemap, level + 1);
+	    outmap = name;
 	}
-	G_percent(pass + 1, pases, 10);
-	if (curcount == lastcount)
-	    break;		/* We done. */
-	lastcount = curcount;
-    }				/*pases */
+	out_fd = Rast_open_new(outmap, 1);
 
-    G_percent(pases, pases, 10);	/* Show 100%. */
+	if (nlevels > 1)
+	    G_message(_("Water level %f: lake <%s>"), water_level, outmap);
 
-    save_map(out_water, out_fd, rows, cols, negative_flag->answer, &min_depth,
-	     &max_depth, &area, &volume);
+	area = volume = 0;
+	max_depth = min_depth = 0;
+	save_map(&flood, water_level, out_fd, negative_flag->answer,
+		 &min_depth, &max_depth, &area, &volume);
 
-    G_message(_("Lake depth from %f to %f (specified water level is taken as zero)"), min_depth, max_depth);
-    G_message(_("Lake area %f square meters"), area);
-    G_message(_("Lake volume %f cubic meters"), volume);
-    G_important_message(_("Volume is correct only if lake depth (terrain raster map) is in meters"));
+	G_message(_("Lake depth from %f to %f (specified water level is taken as zero)"), min_depth, max_depth);
+	G_message(_("Lake area %f square meters"), area);
+	G_message(_("Lake volume %f cubic meters"), volume);
 
-    /* Close all files. Lake map gets written only now. */
-    Rast_close(in_terran_fd);
-    Rast_close(out_fd);
+	/* Lake map gets written only now. */
+	Rast_close(out_fd);
 
-    /* Add blue color gradient from light bank to dark depth */
-    Rast_init_colors(&colr);
-    if (negative_flag->answer == 1) {
-	Rast_add_f_color_rule(&max_depth, 0, 240, 255,
+	/* Add blue color gradient from light bank to dark depth */
+	Rast_init_colors(&colr);
+	if (negative_flag->answer == 1) {
+	    Rast_add_f_color_rule(&max_depth, 0, 240, 255,
 				  &min_depth, 0, 50, 170, &colr);
-    }
-    else {
-	Rast_add_f_color_rule(&min_depth, 0, 240, 255,
+	}
+	else {
+	    Rast_add_f_color_rule(&min_depth, 0, 240, 255,
 				  &max_depth, 0, 50, 170, &colr);
-    }
+	}
 
-    Rast_write_colors(lakemap, G_mapset(), &colr);
+	Rast_write_colors(outmap, G_mapset(), &colr);
+	Rast_free_colors(&colr);
 
-    Rast_short_history(lakemap, "raster", &history);
-    Rast_command_history(&history);
-    Rast_write_history(lakemap, &history);
+	Rast_short_history(outmap, "raster", &history);
+	Rast_command_history(&history);
+	Rast_write_history(outmap, &history);
+    }
+    G_important_message(_("Volume is correct only if lake depth (terrain raster map) is in meters"));
+
+    Rast_close(in_terran_fd);
 
     return EXIT_SUCCESS;
 }
@@ -43,7 +43,7 @@ int calculateF(int fd, struct area_entry *ad, Coppie * cc, long totCoppie,
 
 int main(int argc, char *argv[])
 {
-    struct Option *raster, *conf, *path, *output;
+    struct Option *raster, *conf, *path, *output, *nprocs;
     struct GModule *module;
     char **par = NULL;
 
@@ -73,9 +73,13 @@ int main(int argc, char *argv[])
     output = G_define_standard_option(G_OPT_R_OUTPUT);
 
 
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs);
+
     if (path->answer == NULL)
 	par = NULL;
     else
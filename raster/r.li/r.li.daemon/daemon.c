@@ -35,9 +35,24 @@
 #include <grass/glocale.h>
 #include "daemon.h"
 
+static int calculate_index(char *file, rli_func *f, rli_count_func *cf,
+			   char **parameters, char *raster, char *output);
+
 int calculateIndex(char *file, rli_func *f,
 		   char **parameters, char *raster, char *output)
 {
+    return calculate_index(file, f, NULL, parameters, raster, output);
+}
+
+int calculateCountIndex(char *file, rli_func *f, rli_count_func *cf,
+			char **parameters, char *raster, char *output)
+{
+    return calculate_index(file, f, cf, parameters, raster, output);
+}
+
+static int calculate_index(char *file, rli_func *f, rli_count_func *cf,
+			   char **parameters, char *raster, char *output)
+{
 
     char pathSetup[GPATH_MAX], out[GPATH_MAX], parsed;
     char *random_access_name;
@@ -124,6 +139,12 @@ int calculateIndex(char *file, rli_func *f,
        ------------------analysis loop----------------------
        ####################################################### */
 
+    /* moving windows without mask are computed by rows in parallel */
+    if (parsed == MVWIN && g->maskname == NULL) {
+	if (!worker_mv_window(g, cf, random_access))
+	    G_fatal_error(_("Unable to compute the moving window"));
+    }
+    else
     /*body */
     while (next_Area(parsed, l, g, &m) != 0) {
 	worker_process(&doneJob, &m);
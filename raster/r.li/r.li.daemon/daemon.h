@@ -94,6 +94,21 @@ struct fcell_memory_entry
  */
 typedef struct fcell_memory_entry *fcell_manager;
 
+/**
+ * \brief rows of the raster map in memory, shared by all threads
+ * \member first first row in the tile
+ * \member nrows number of rows in the tile
+ * \member buf row buffers of the map type, buf[row - first]
+ * \member cls class of each cell or -1 for NULL, only for count indices
+ */
+struct rli_tile
+{
+    int first;
+    int nrows;
+    void **buf;
+    int **cls;
+};
+
  /**
   * \brief fields of an area descriptor
   * \member x column offset = start of sample area
@@ -102,6 +117,7 @@ typedef struct fcell_memory_entry *fcell_manager;
   * \member cl sample area length in columns
   * \member rc number of rows in the cache
   * \member mask file descriptor of mask raster file (-1 if there is no mask)
+  * \member tile rows in memory shared by all threads or NULL
  */
 struct area_entry
 {
@@ -117,6 +133,7 @@ struct area_entry
     fcell_manager fm;
     char *raster;
     char *mask_name;
+    struct rli_tile *tile;
 };
 
 /**
@@ -130,6 +147,21 @@ struct area_entry
  */
 typedef int rli_func(int fd, char **par, struct area_entry *ad, double *result);
 
+/**
+ * \brief function prototype for indices computed only from the number
+ * of cells of each class in the sample area
+ * \param counts number of cells of the classes with cells in the area,
+ * in ascending order of the class values
+ * \param n number of classes with cells in the area
+ * \param area number of non-NULL cells in the area, can be 0
+ * \param par optional parameters
+ * \param result pointer to store the result
+ * \return RLI_ERRORE error occurs in calculating index
+ * \return RLI_OK  otherwise
+ */
+typedef int rli_count_func(const long *counts, int n, long area, char **par,
+			   double *result);
+
 
 /**
  * \brief applies the f index once for every
@@ -150,6 +182,24 @@ typedef int rli_func(int fd, char **par, struct area_entry *ad, double *result);
 int calculateIndex(char *file, rli_func *f,
 		   char **parameters, char *raster, char *output);
 
+/**
+ * \brief like calculateIndex, with a function computing the index from
+ * the class counts
+ *
+ * Moving windows without mask are processed with cf, the class counts
+ * are updated incrementally from one window to the next one. Other
+ * sample areas are processed with f.
+ *
+ * \param file name of setup file
+ * \param f the function that defines the index
+ * \param cf the same index computed from the class counts
+ * \param raster the raster file to analyze
+ * \return 1 error occurs in calculating index
+ * \return 0 otherwise
+ */
+int calculateCountIndex(char *file, rli_func *f, rli_count_func *cf,
+			char **parameters, char *raster, char *output);
+
 /**
  * \description parses the setup file and populates the list of areas
  * to analyze
@@ -219,6 +269,21 @@ void worker_init(char *raster, rli_func *f,
 void worker_process(msg * ret, msg * m);
 void worker_end(void);
 
+/**
+ * \brief computes the index for all moving windows of g
+ *
+ * The rows of the windows are processed in blocks by the worker
+ * threads, the raster rows of a block are read once into a shared
+ * tile. The results are written to the random access file as done by
+ * raster_Output.
+ *
+ * \param g the moving window generator, no mask
+ * \param cf function computing the index from class counts or NULL
+ * \param random_access the random access file of the results
+ * \return 0 on error, 1 otherwise
+ */
+int worker_mv_window(struct g_area *g, rli_count_func *cf, int random_access);
+
  /**
   * \brief adapts the mask at current raster file
   * \param mask name of mask raster file
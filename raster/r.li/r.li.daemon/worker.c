@@ -21,6 +21,8 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <errno.h>
+#include <string.h>
+#include <unistd.h>
 #include <math.h>
 
 #ifdef __MINGW32__
@@ -34,10 +36,15 @@
 #include <grass/glocale.h>
 #include "daemon.h"
 #include "defs.h"
+#include "avlDefs.h"
+#include "avl.h"
 
 
 #define CACHESIZE 4194304
 
+/* rows of moving windows per thread in a block of rows */
+#define BLOCK_ROWS 8
+
 static int fd, aid;
 static int erease_mask = 0, data_type = 0;
 static int cache_rows, used = 0;
@@ -102,6 +109,7 @@ void worker_init(char *r, rli_func *f, char **p)
 	} break;
     }
     ad->data_type = data_type;
+    ad->tile = NULL;
     ad->rc = cache_rows;
     ad->cm = cm;
     ad->fm = fm;
@@ -210,6 +218,342 @@ void worker_process(msg * ret, msg * m)
     }
 }
 
+/* classes of the cell values for the count indices */
+static avl_tree class_tree;	/* class of each value */
+static double *class_value;	/* value of each class */
+static int nclasses, class_alloc;
+
+/* work buffers of a thread */
+struct mv_scratch
+{
+    struct area_entry ad;	/* area descriptor with the shared tile */
+    long *count;		/* number of cells of each class */
+    int *active;		/* classes with cells, by ascending value */
+    long *tot;			/* number of cells of the active classes */
+    int nactive;
+    long area;			/* number of non-NULL cells */
+    int nalloc;
+};
+
+struct mv_block
+{
+    struct g_area *g;
+    rli_count_func *cf;
+    struct rli_tile *tile;
+    int first;			/* first row of windows in the block */
+    double *result;		/* results of the windows of the block */
+    int chunk;			/* rows per thread */
+    struct mv_scratch *scratch;	/* per thread */
+};
+
+static int get_class(const void *p)
+{
+    generic_cell uc;
+    avl_node *node;
+
+    uc.t = data_type;
+    switch (data_type) {
+    case CELL_TYPE:
+	uc.val.c = *(const CELL *)p;
+	break;
+    case FCELL_TYPE:
+	uc.val.fc = *(const FCELL *)p;
+	break;
+    case DCELL_TYPE:
+	uc.val.dc = *(const DCELL *)p;
+	break;
+    }
+
+    if (class_tree && (node = avl_find(class_tree, uc)) != NULL)
+	return (int)node->counter;
+
+    if (nclasses >= class_alloc) {
+	class_alloc = class_alloc ? 2 * class_alloc : 256;
+	class_value = G_realloc(class_value, class_alloc * sizeof(double));
+    }
+    class_value[nclasses] = Rast_get_d_value(p, data_type);
+
+    if (class_tree == NULL)
+	class_tree = avl_make(uc, nclasses);
+    else if (avl_add(&class_tree, uc, nclasses) != AVL_ADD)
+	G_fatal_error("avl_add error");
+
+    return nclasses++;
+}
+
+/* reads the rows first to first + nrows - 1 into the tile, rows
+ * already in the tile are kept */
+static void load_tile(struct rli_tile *t, int first, int nrows, int classes)
+{
+    void **buf = G_malloc(nrows * sizeof(void *));
+    int **cls = G_malloc(nrows * sizeof(int *));
+    int *keep = G_calloc(t->nrows, sizeof(int));
+    int i, j, k, row;
+
+    for (i = 0; i < nrows; i++) {
+	row = first + i;
+	buf[i] = NULL;
+	cls[i] = NULL;
+	if (row >= t->first && row < t->first + t->nrows) {
+	    buf[i] = t->buf[row - t->first];
+	    cls[i] = t->cls[row - t->first];
+	    keep[row - t->first] = 1;
+	}
+    }
+
+    for (i = 0, k = 0; i < nrows; i++) {
+	const void *p;
+
+	if (buf[i])
+	    continue;
+
+	/* reuse a buffer of a row no longer needed */
+	while (k < t->nrows && keep[k])
+	    k++;
+	if (k < t->nrows) {
+	    buf[i] = t->buf[k];
+	    cls[i] = t->cls[k];
+	    k++;
+	}
+	else {
+	    buf[i] = Rast_allocate_buf(data_type);
+	    cls[i] = classes ? G_malloc(hd.cols * sizeof(int)) : NULL;
+	}
+
+	Rast_get_row(fd, buf[i], first + i, data_type);
+
+	if (classes) {
+	    p = buf[i];
+	    for (j = 0; j < hd.cols; j++) {
+		cls[i][j] = Rast_is_null_value(p, data_type) ? -1 : get_class(p);
+		p = G_incr_void_ptr(p, Rast_cell_size(data_type));
+	    }
+	}
+    }
+
+    /* release the buffers of the rows which are not reused */
+    for (; k < t->nrows; k++) {
+	if (!keep[k]) {
+	    G_free(t->buf[k]);
+	    if (t->cls[k])
+		G_free(t->cls[k]);
+	}
+    }
+
+    G_free(t->buf);
+    G_free(t->cls);
+    G_free(keep);
+    t->buf = buf;
+    t->cls = cls;
+    t->first = first;
+    t->nrows = nrows;
+}
+
+static void add_cell(struct mv_scratch *s, int c)
+{
+    int lo, hi, mid;
+
+    if (c < 0)
+	return;
+    s->area++;
+    if (s->count[c]++ > 0)
+	return;
+
+    /* insert into the active classes, ordered by value */
+    lo = 0;
+    hi = s->nactive;
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (class_value[s->active[mid]] < class_value[c])
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    memmove(s->active + lo + 1, s->active + lo,
+	    (s->nactive - lo) * sizeof(int));
+    s->active[lo] = c;
+    s->nactive++;
+}
+
+static void remove_cell(struct mv_scratch *s, int c)
+{
+    int i;
+
+    if (c < 0)
+	return;
+    s->area--;
+    if (--s->count[c] > 0)
+	return;
+
+    for (i = 0; s->active[i] != c; i++) ;
+    memmove(s->active + i, s->active + i + 1,
+	    (s->nactive - i - 1) * sizeof(int));
+    s->nactive--;
+}
+
+/* one row of moving windows, the class counts are updated by the
+ * columns leaving and entering the window */
+static void mv_count_row(const struct mv_block *blk, struct mv_scratch *s,
+			 int row, double *res)
+{
+    const struct g_area *g = blk->g;
+    int **cls = blk->tile->cls + (g->y + row - blk->tile->first);
+    int i, j, col;
+
+    for (i = 0; i < s->nactive; i++)
+	s->count[s->active[i]] = 0;
+    s->nactive = 0;
+    s->area = 0;
+
+    for (i = 0; i < g->rl; i++)
+	for (j = 0; j < g->cl; j++)
+	    add_cell(s, cls[i][g->x + j]);
+
+    for (col = 0; col < g->cols; col++) {
+	if (col > 0) {
+	    for (i = 0; i < g->rl; i++) {
+		remove_cell(s, cls[i][g->x + col - 1]);
+		add_cell(s, cls[i][g->x + col + g->cl - 1]);
+	    }
+	}
+
+	for (i = 0; i < s->nactive; i++)
+	    s->tot[i] = s->count[s->active[i]];
+	if ((*blk->cf) (s->tot, s->nactive, s->area, parameters,
+			&res[col]) != RLI_OK)
+	    res[col] = 0.0;
+    }
+}
+
+/* one row of moving windows, the index is computed for each window */
+static void mv_row(const struct mv_block *blk, struct mv_scratch *s,
+		   int row, double *res)
+{
+    const struct g_area *g = blk->g;
+    struct area_entry *a = &s->ad;
+    int col;
+
+    a->y = g->y + row;
+    a->rl = g->rl;
+    a->cl = g->cl;
+    for (col = 0; col < g->cols; col++) {
+	a->x = g->x + col;
+	/* like not written areas of the random access file */
+	if (func(fd, parameters, a, &res[col]) != RLI_OK)
+	    res[col] = 0.0;
+    }
+}
+
+/* the threads share the tile with the rows and class numbers of the
+ * windows of the block and write the results of their rows to
+ * blk->result; the class counts of a window and the area descriptor
+ * passed to the index function are private to each thread */
+static void mv_rows(int first, int last, void *closure)
+{
+    const struct mv_block *blk = closure;
+    struct mv_scratch *s = &blk->scratch[first / blk->chunk];
+    int i;
+
+    for (i = first; i < last; i++) {
+	double *res = blk->result + (size_t)i * blk->g->cols;
+
+	if (blk->cf)
+	    mv_count_row(blk, s, blk->first + i, res);
+	else
+	    mv_row(blk, s, blk->first + i, res);
+    }
+}
+
+int worker_mv_window(struct g_area *g, rli_count_func *cf, int random_access)
+{
+    struct rli_tile tile;
+    struct mv_block blk;
+    int nprocs, nblock;
+    int i, row;
+    size_t size;
+    off_t offset;
+
+    if (g->cl > g->cols || g->rl > g->rows)
+	return 1;
+
+    nprocs = G_num_workers() + 1;
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    G_debug(1, "worker_mv_window(): %d threads, %d rows per block",
+	    nprocs, nblock);
+
+    tile.first = 0;
+    tile.nrows = 0;
+    tile.buf = NULL;
+    tile.cls = NULL;
+
+    blk.g = g;
+    blk.cf = cf;
+    blk.tile = &tile;
+    blk.result = G_malloc((size_t)nblock * g->cols * sizeof(double));
+    blk.chunk = (nblock + nprocs - 1) / nprocs;
+    blk.scratch = G_calloc(nprocs, sizeof(struct mv_scratch));
+    for (i = 0; i < nprocs; i++) {
+	struct mv_scratch *s = &blk.scratch[i];
+
+	s->ad = *ad;
+	s->ad.raster = raster;
+	s->ad.mask = -1;
+	s->ad.tile = &tile;
+    }
+
+    for (row = 0; row < g->rows; row += nblock) {
+	int n = g->rows - row < nblock ? g->rows - row : nblock;
+
+	G_percent(row, g->rows, 2);
+
+	/* all rows of the windows of the block */
+	load_tile(&tile, g->y + row, n + g->rl - 1, cf != NULL);
+
+	for (i = 0; cf && i < nprocs; i++) {
+	    struct mv_scratch *s = &blk.scratch[i];
+
+	    if (s->nalloc < nclasses) {
+		s->count = G_realloc(s->count, nclasses * sizeof(long));
+		memset(s->count + s->nalloc, 0,
+		       (nclasses - s->nalloc) * sizeof(long));
+		s->active = G_realloc(s->active, nclasses * sizeof(int));
+		s->tot = G_realloc(s->tot, nclasses * sizeof(long));
+		s->nalloc = nclasses;
+	    }
+	}
+
+	/* the rows of a block are independent */
+	blk.first = row;
+	G_parallel_for(0, n, blk.chunk, mv_rows, &blk);
+
+	size = (size_t)n * g->cols * sizeof(double);
+	offset = (off_t)row * g->cols * sizeof(double);
+	if (lseek(random_access, offset, SEEK_SET) != offset ||
+	    write(random_access, blk.result, size) != size) {
+	    G_warning(_("Unable to write to random access file"));
+	    return 0;
+	}
+    }
+    G_percent(1, 1, 1);
+
+    for (i = 0; i < tile.nrows; i++) {
+	G_free(tile.buf[i]);
+	if (tile.cls[i])
+	    G_free(tile.cls[i]);
+    }
+    G_free(tile.buf);
+    G_free(tile.cls);
+    for (i = 0; i < nprocs; i++) {
+	G_free(blk.scratch[i].count);
+	G_free(blk.scratch[i].active);
+	G_free(blk.scratch[i].tot);
+    }
+    G_free(blk.scratch);
+    G_free(blk.result);
+
+    return 1;
+}
+
 void worker_end(void)
 {
     /* close raster map */
@@ -259,6 +603,10 @@ CELL *RLI_get_cell_raster_row(int fd, int row, struct area_entry *ad)
 {
     int hash;
 
+    if (ad->tile && row >= ad->tile->first &&
+	row < ad->tile->first + ad->tile->nrows)
+	return ad->tile->buf[row - ad->tile->first];
+
     hash = row % ad->rc;
     if (ad->cm->contents[hash] == row)
 	return ad->cm->cache[hash];
@@ -274,6 +622,10 @@ DCELL *RLI_get_dcell_raster_row(int fd, int row, struct area_entry *ad)
 {
     int hash;
 
+    if (ad->tile && row >= ad->tile->first &&
+	row < ad->tile->first + ad->tile->nrows)
+	return ad->tile->buf[row - ad->tile->first];
+
     hash = row % ad->rc;
     if (ad->dm->contents[hash] == row)
 	return ad->dm->cache[hash];
@@ -289,6 +641,10 @@ FCELL *RLI_get_fcell_raster_row(int fd, int row, struct area_entry *ad)
 {
     int hash;
 
+    if (ad->tile && row >= ad->tile->first &&
+	row < ad->tile->first + ad->tile->nrows)
+	return ad->tile->buf[row - ad->tile->first];
+
     hash = row % ad->rc;
     if (ad->fm->contents[hash] == row)
 	return ad->fm->cache[hash];
@@ -36,7 +36,7 @@ static int brdr = 1;
 
 int main(int argc, char *argv[])
 {
-    struct Option *raster, *conf, *output, *class;
+    struct Option *raster, *conf, *output, *class, *nprocs;
     struct Flag *flag_brdr;
     struct GModule *module;
     char **par = NULL;
@@ -74,9 +74,13 @@ int main(int argc, char *argv[])
     flag_brdr->description = _("Exclude border edges");
 
 
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs);
+
     if (class->answer == NULL)
 	par = NULL;
     else
@@ -43,7 +43,7 @@ int calculateF(int fd, struct area_entry *ad, double *result);
 
 int main(int argc, char *argv[])
 {
-    struct Option *raster, *conf, *output;
+    struct Option *raster, *conf, *output, *nprocs;
     struct GModule *module;
 
     G_gisinit(argv[0]);
@@ -64,8 +64,12 @@ int main(int argc, char *argv[])
 
     output = G_define_standard_option(G_OPT_R_OUTPUT);
 
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
+
+    G_set_nprocs(nprocs);
     return calculateIndex(conf->answer, patchAreaDistributionCV, NULL,
 			  raster->answer, output->answer);
 }
@@ -27,13 +27,14 @@
 #include "../r.li.daemon/avl.h"
 
 rli_func richness;
+rli_count_func richness_counts;
 int calculate(int fd, struct area_entry *ad, double *result);
 int calculateD(int fd, struct area_entry *ad, double *result);
 int calculateF(int fd, struct area_entry *ad, double *result);
 
 int main(int argc, char *argv[])
 {
-    struct Option *raster, *conf, *output;
+    struct Option *raster, *conf, *output, *nprocs;
     struct GModule *module;
 
     G_gisinit(argv[0]);
@@ -55,11 +56,15 @@ int main(int argc, char *argv[])
 
     output = G_define_standard_option(G_OPT_R_OUTPUT);
 
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
-    return calculateIndex(conf->answer, richness, NULL, raster->answer,
-			  output->answer);
+    G_set_nprocs(nprocs);
+
+    return calculateCountIndex(conf->answer, richness, richness_counts, NULL,
+			       raster->answer, output->answer);
 }
 
 int richness(int fd, char **par, struct area_entry *ad, double *result)
@@ -100,6 +105,16 @@ int richness(int fd, char **par, struct area_entry *ad, double *result)
 }
 
 
+/* richness is the number of classes */
+int richness_counts(const long *counts, int n, long area, char **par,
+		    double *result)
+{
+    *result = n;
+
+    return RLI_OK;
+}
+
+
 int calculate(int fd, struct area_entry *ad, double *result)
 {
     CELL *buf;
@@ -30,13 +30,14 @@
 /* template for dominance, renyi, pielou, simpson */
 
 rli_func shannon;
+rli_count_func shannon_counts;
 int calculate(int fd, struct area_entry *ad, double *result);
 int calculateD(int fd, struct area_entry *ad, double *result);
 int calculateF(int fd, struct area_entry *ad, double *result);
 
 int main(int argc, char *argv[])
 {
-    struct Option *raster, *conf, *output;
+    struct Option *raster, *conf, *output, *nprocs;
     struct GModule *module;
 
     G_gisinit(argv[0]);
@@ -58,11 +59,15 @@ int main(int argc, char *argv[])
 
     output = G_define_standard_option(G_OPT_R_OUTPUT);
 
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
-    return calculateIndex(conf->answer, shannon, NULL, raster->answer,
-			  output->answer);
+    G_set_nprocs(nprocs);
+
+    return calculateCountIndex(conf->answer, shannon, shannon_counts, NULL,
+			       raster->answer, output->answer);
 }
 
 
@@ -104,6 +109,29 @@ int shannon(int fd, char **par, struct area_entry *ad, double *result)
 }
 
 
+/* Shannon's index from the number of cells of each class */
+int shannon_counts(const long *counts, int n, long area, char **par,
+		   double *result)
+{
+    int i;
+    double t, perc, shannon = 0;
+
+    if (area == 0) {
+	Rast_set_d_null_value(result, 1);
+	return RLI_OK;
+    }
+
+    for (i = 0; i < n; i++) {
+	t = counts[i];
+	perc = t / area;
+	shannon += perc * log(perc);
+    }
+    *result = -shannon;
+
+    return RLI_OK;
+}
+
+
 int calculate(int fd, struct area_entry *ad, double *result)
 {
     CELL *buf;
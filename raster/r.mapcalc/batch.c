@@ -0,0 +1,264 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <grass/gis.h>
+#include <grass/calc.h>
+#include <grass/glocale.h>
+
+#include "mapcalc.h"
+#include "globals.h"
+
+/****************************************************************************/
+
+/* Batch mode (-b): the input is a sequence of jobs, each one or more
+ * expressions terminated by an empty line or "end". Consecutive jobs
+ * which do not read or write a map written by another job are
+ * evaluated together in a single pass over the rows, so they share the
+ * process, the opened input maps, the row caches and the worker pool.
+ * A job which depends on an earlier one starts a new pass. */
+
+struct pass
+{
+    expr_list *head, *tail;	/* expressions of all jobs */
+    char **outputs, **inputs;	/* map names of the current mapset */
+    int num_outputs, num_inputs;
+    int max_outputs, max_inputs;
+    int jobs;
+};
+
+/****************************************************************************/
+
+static int is_separator(const char *line)
+{
+    char buf[16];
+
+    if (sscanf(line, "%15s", buf) != 1)
+	return 1;
+
+    return (strcmp(buf, "end") == 0 || strcmp(buf, "exit") == 0) &&
+	sscanf(line, "%*s%15s", buf) != 1;
+}
+
+/* returns the text of the next job, NULL at the end of the input */
+static char *read_job(FILE *fp)
+{
+    char line[4096];
+    char *text = NULL;
+    size_t len = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+	size_t n = strlen(line);
+
+	if (is_separator(line)) {
+	    if (text)
+		break;
+	    continue;
+	}
+
+	text = G_realloc(text, len + n + 1);
+	memcpy(text + len, line, n + 1);
+	len += n;
+    }
+
+    return text;
+}
+
+/****************************************************************************/
+
+/* base name of a map of the current mapset, NULL for other mapsets */
+static char *local_name(const char *name)
+{
+    char xname[GNAME_MAX], xmapset[GMAPSET_MAX];
+
+    if (!G_name_is_fully_qualified(name, xname, xmapset))
+	return G_store(name);
+
+    return strcmp(xmapset, G_mapset()) == 0 ? G_store(xname) : NULL;
+}
+
+static int find_name(char **names, int count, const char *name)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+	if (strcmp(names[i], name) == 0)
+	    return 1;
+    return 0;
+}
+
+static void add_name(char ***names, int *count, int *max, char *name)
+{
+    if (!name || find_name(*names, *count, name))
+	return;
+
+    if (*count >= *max) {
+	*max += 16;
+	*names = G_realloc(*names, *max * sizeof(char *));
+    }
+
+    (*names)[(*count)++] = name;
+}
+
+static void collect_inputs(const expression *e, struct pass *p)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_map:
+	add_name(&p->inputs, &p->num_inputs, &p->max_inputs,
+		 local_name(e->data.map.name));
+	break;
+    case expr_type_function:
+	for (i = 1; i <= e->data.func.argc; i++)
+	    collect_inputs(e->data.func.args[i], p);
+	break;
+    case expr_type_binding:
+	collect_inputs(e->data.bind.val, p);
+	break;
+    }
+}
+
+/* whether the job has to wait for the jobs of the pass to finish */
+static int depends(const expr_list *job, const struct pass *p)
+{
+    struct pass q;
+    const expr_list *l;
+    int i, result = 0;
+
+    memset(&q, 0, sizeof(q));
+    for (l = job; l; l = l->next)
+	collect_inputs(l->exp, &q);
+
+    for (i = 0; i < q.num_inputs && !result; i++)
+	result = find_name(p->outputs, p->num_outputs, q.inputs[i]);
+
+    for (l = job; l && !result; l = l->next)
+	if (l->exp->type == expr_type_binding)
+	    result = find_name(p->outputs, p->num_outputs,
+			       l->exp->data.bind.var) ||
+		find_name(p->inputs, p->num_inputs, l->exp->data.bind.var);
+
+    for (i = 0; i < q.num_inputs; i++)
+	G_free(q.inputs[i]);
+    G_free(q.inputs);
+
+    return result;
+}
+
+static void add_job(expr_list *job, struct pass *p)
+{
+    expr_list *l;
+
+    for (l = job; l; l = l->next) {
+	collect_inputs(l->exp, p);
+	if (l->exp->type == expr_type_binding)
+	    add_name(&p->outputs, &p->num_outputs, &p->max_outputs,
+		     G_store(l->exp->data.bind.var));
+    }
+
+    if (p->tail)
+	p->tail->next = job;
+    else
+	p->head = job;
+    for (p->tail = job; p->tail->next; p->tail = p->tail->next) ;
+
+    p->jobs++;
+}
+
+static void flush(struct pass *p)
+{
+    int i;
+
+    if (!p->head)
+	return;
+
+    G_verbose_message(n_("Evaluating %d job", "Evaluating %d jobs", p->jobs),
+		      p->jobs);
+
+    execute(optimize(p->head));
+
+    /* inputs opened before their map was overwritten are stale */
+    for (i = 0; i < p->num_outputs; i++)
+	forget_map(p->outputs[i]);
+
+    for (i = 0; i < p->num_outputs; i++)
+	G_free(p->outputs[i]);
+    for (i = 0; i < p->num_inputs; i++)
+	G_free(p->inputs[i]);
+
+    p->head = p->tail = NULL;
+    p->num_outputs = p->num_inputs = 0;
+    p->jobs = 0;
+}
+
+static expr_list *parse_job(const char *text)
+{
+    clear_variables();
+    return parse_string(text);
+}
+
+static int existing_output(const expr_list *job)
+{
+    const expr_list *l;
+
+    if (overwrite_flag)
+	return 0;
+
+    for (l = job; l; l = l->next)
+	if (l->exp->type == expr_type_binding &&
+	    check_output_map(l->exp->data.bind.var)) {
+	    G_warning(_("output map <%s> exists. To overwrite, "
+			"use the --overwrite flag"), l->exp->data.bind.var);
+	    return 1;
+	}
+
+    return 0;
+}
+
+/****************************************************************************/
+
+/* returns the number of jobs which failed */
+int run_batch(FILE *fp)
+{
+    struct pass pass;
+    char *text;
+    int num = 0, failed = 0;
+
+    memset(&pass, 0, sizeof(pass));
+
+    /* one worker pool for all passes */
+    G_init_workers();
+
+    while ((text = read_job(fp))) {
+	expr_list *job = parse_job(text);
+
+	num++;
+
+	/* a job using maps of pending jobs is parsed again once they
+	   are written, the map types may change */
+	if (pass.head && (!job || depends(job, &pass))) {
+	    flush(&pass);
+	    job = parse_job(text);
+	}
+
+	if (!job || existing_output(job)) {
+	    G_warning(_("Skipping job %d"), num);
+	    failed++;
+	}
+	else
+	    add_job(job, &pass);
+
+	G_free(text);
+    }
+
+    flush(&pass);
+
+    G_finish_workers();
+
+    G_free(pass.outputs);
+    G_free(pass.inputs);
+
+    return failed;
+}
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include "expression.h"
@@ -7,90 +8,20 @@
 
 void column_shift(void *buf, int res_type, int col)
 {
-    CELL *ibuf = buf;
-    FCELL *fbuf = buf;
-    DCELL *dbuf = buf;
-    int i;
-
-    /* if column offset, copy cell to itself shifting by col */
-    if (col > 0) {
-	switch (res_type) {
-	case CELL_TYPE:
-	    for (i = 0; i < columns - col; i++) {
-		if (IS_NULL_C(&ibuf[i + col]))
-		    SET_NULL_C(&ibuf[i]);
-		else
-		    ibuf[i] = ibuf[i + col];
-	    }
-
-	    for (; i < columns; i++)
-		SET_NULL_C(&ibuf[i]);
-	    break;
-
-	case FCELL_TYPE:
-	    for (i = 0; i < columns - col; i++) {
-		if (IS_NULL_F(&fbuf[i + col]))
-		    SET_NULL_F(&fbuf[i]);
-		else
-		    fbuf[i] = fbuf[i + col];
-	    }
-
-	    for (; i < columns; i++)
-		SET_NULL_F(&fbuf[i]);
-	    break;
-
-	case DCELL_TYPE:
-	    for (i = 0; i < columns - col; i++) {
-		if (IS_NULL_D(&dbuf[i + col]))
-		    SET_NULL_D(&dbuf[i]);
-		else
-		    dbuf[i] = dbuf[i + col];
-	    }
-
-	    for (; i < columns; i++)
-		SET_NULL_D(&dbuf[i]);
-	    break;
-	}
+    size_t size = Rast_cell_size(res_type);
+    char *p = buf;
+
+    /* nulls are copied bit for bit, so the shift is a plain move
+       followed by null fill of the vacated cells */
+    if (col >= columns || col <= -columns)
+	Rast_set_null_value(buf, columns, res_type);
+    else if (col > 0) {
+	memmove(p, p + col * size, (columns - col) * size);
+	Rast_set_null_value(p + (columns - col) * size, col, res_type);
     }
     else if (col < 0) {
 	col = -col;
-
-	switch (res_type) {
-	case CELL_TYPE:
-	    for (i = columns - 1; i >= col; i--) {
-		if (IS_NULL_C(&ibuf[i - col]))
-		    SET_NULL_C(&ibuf[i]);
-		else
-		    ibuf[i] = ibuf[i - col];
-	    }
-
-	    for (; i >= 0; i--)
-		SET_NULL_C(&ibuf[i]);
-	    break;
-
-	case FCELL_TYPE:
-	    for (i = columns - 1; i >= col; i--) {
-		if (IS_NULL_F(&fbuf[i - col]))
-		    SET_NULL_F(&fbuf[i]);
-		else
-		    fbuf[i] = fbuf[i - col];
-	    }
-
-	    for (; i >= 0; i--)
-		SET_NULL_F(&fbuf[i]);
-	    break;
-
-	case DCELL_TYPE:
-	    for (i = columns - 1; i >= col; i--) {
-		if (IS_NULL_D(&dbuf[i - col]))
-		    SET_NULL_D(&dbuf[i]);
-		else
-		    dbuf[i] = dbuf[i - col];
-	    }
-
-	    for (; i >= 0; i--)
-		SET_NULL_D(&dbuf[i]);
-	    break;
-	}
+	memmove(p + col * size, p, (columns - col) * size);
+	Rast_set_null_value(p, col, res_type);
     }
 }
@@ -1,4 +1,5 @@
 
+#include <grass/config.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
@@ -13,9 +14,14 @@
 
 /****************************************************************************/
 
-int current_depth, current_row;
+THREAD_LOCAL int current_depth, current_row;
+THREAD_LOCAL int current_block;
 int depths, rows;
 
+/* maximum memory for the output rows of a batch of blocks */
+#define MAX_BLOCK_BYTES (64 << 20)
+#define MAX_BLOCK_ROWS 64
+
 /* Local variables for map management */
 static expression **map_list = NULL;
 static int num_maps = 0;
@@ -23,6 +29,8 @@ static int max_maps = 0;
 
 /****************************************************************************/
 
+static int block_mode;
+
 static void extract_maps(expression *e);
 static void initialize(expression *e);
 static void evaluate(expression *e);
@@ -99,12 +107,53 @@ static void initialize_map(expression * e)
                                e->data.map.row, e->data.map.col);
 }
 
+/* whether evaluating e does more than computing its value */
+static int has_effects(const expression * e)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+	if (e->data.func.func == f_rand)
+	    return 1;
+	for (i = 1; i <= e->data.func.argc; i++)
+	    if (has_effects(e->data.func.args[i]))
+		return 1;
+	return 0;
+    case expr_type_binding:
+	return 1;
+    default:
+	return 0;
+    }
+}
+
 static void initialize_function(expression * e)
 {
     int i;
 
     allocate_buf(e);
 
+    /* branches of if() which no cell of a row selects are not evaluated
+     * for that row, unless they define variables or use rand() */
+    e->data.func.lazy = e->data.func.func == f_if && e->data.func.argc >= 2;
+    for (i = 2; e->data.func.lazy && i <= e->data.func.argc; i++)
+	if (has_effects(e->data.func.args[i]))
+	    e->data.func.lazy = 0;
+
+    /* the operators below e are fused into e, only the subexpressions
+     * which are not get buffers */
+    if (!e->kernel)
+        e->kernel = compile_kernel(e);
+    if (e->kernel) {
+        expression **leaves;
+        int n;
+
+        leaves = kernel_leaves(e->kernel, &n);
+        for (i = 0; i < n; i++)
+            initialize(leaves[i]);
+        return;
+    }
+
     e->data.func.argv = G_malloc((e->data.func.argc + 1) * sizeof(void *));
     e->data.func.argv[0] = e->buf;
 
@@ -148,11 +197,23 @@ static void initialize(expression * e)
 
 static void do_evaluate(void *p)
 {
-    evaluate((struct expression *) p);
+    struct expression *e = p;
+    int row = current_row, depth = current_depth;
+
+    /* the task may run on any thread, e.g. one waiting for other tasks */
+    current_row = e->row;
+    current_depth = e->depth;
+
+    evaluate(e);
+
+    current_row = row;
+    current_depth = depth;
 }
 
 static void begin_evaluate(struct expression *e)
 {
+    e->row = current_row;
+    e->depth = current_depth;
     G_begin_execute(do_evaluate, e, &e->worker, 0);
 }
 
@@ -204,12 +265,81 @@ static void evaluate_map(expression * e)
                 e->data.map.col, e->buf, e->res_type);
 }
 
+static void evaluate_fused(expression * e)
+{
+    expression **leaves;
+    int i, n;
+
+    leaves = kernel_leaves(e->kernel, &n);
+
+    if (n > 1 && !block_mode) {
+	for (i = 0; i < n; i++)
+	    begin_evaluate(leaves[i]);
+
+	for (i = 0; i < n; i++)
+	    end_evaluate(leaves[i]);
+    }
+    else
+	for (i = 0; i < n; i++)
+	    evaluate(leaves[i]);
+
+    evaluate_kernel(e->kernel, e->buf, e->res_type);
+}
+
+/* evaluates the condition of if() and the branches it selects in this row */
+static void evaluate_if_args(expression * e)
+{
+    int argc = e->data.func.argc;
+    expression *args[3];
+    const DCELL *cond;
+    int used[5] = { 0 };
+    int i, n;
+
+    evaluate(e->data.func.args[1]);
+    cond = e->data.func.args[1]->buf;
+
+    for (i = 0; i < columns; i++) {
+	DCELL c = cond[i];
+
+	if (IS_NULL_D(&c))
+	    continue;
+	if (c == 0.0)
+	    used[3] = 1;
+	else if (c > 0.0 || argc < 4)
+	    used[2] = 1;
+	else
+	    used[4] = 1;
+    }
+
+    for (i = 2, n = 0; i <= argc; i++)
+	if (used[i])
+	    args[n++] = e->data.func.args[i];
+
+    if (n > 1 && !block_mode) {
+	for (i = 0; i < n; i++)
+	    begin_evaluate(args[i]);
+
+	for (i = 0; i < n; i++)
+	    end_evaluate(args[i]);
+    }
+    else
+	for (i = 0; i < n; i++)
+	    evaluate(args[i]);
+}
+
 static void evaluate_function(expression * e)
 {
     int i;
     int res;
 
-    if (e->data.func.argc > 1 && e->data.func.func != f_eval) {
+    if (e->kernel) {
+	evaluate_fused(e);
+	return;
+    }
+
+    if (e->data.func.lazy)
+	evaluate_if_args(e);
+    else if (e->data.func.argc > 1 && e->data.func.func != f_eval && !block_mode) {
 	for (i = 1; i <= e->data.func.argc; i++)
 	    begin_evaluate(e->data.func.args[i]);
 
@@ -286,6 +416,247 @@ static void evaluate(expression * e)
 
 /****************************************************************************/
 
+/* Evaluation in blocks of rows: the blocks are evaluated as tasks of
+ * the libgis worker pool, each with its own copy of the expressions
+ * (buffers) and its own handles of the input maps (see
+ * setup_map_blocks()). The output rows
+ * of a batch of blocks are kept in memory and written in row order. */
+
+struct block
+{
+    int id;
+    expr_list *ee;		/* this block's copy of the expressions */
+    int row0, nrows;
+    void **out;			/* output rows for each binding */
+};
+
+/* top-level bindings except shared subexpressions, see optimize.c */
+static int is_output(const expression *e)
+{
+    return e->type == expr_type_binding && !e->data.bind.temp;
+}
+
+static int uses_rand(const expression *e)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+	if (strcmp(e->data.func.name, "rand") == 0)
+	    return 1;
+	for (i = 1; i <= e->data.func.argc; i++)
+	    if (uses_rand(e->data.func.args[i]))
+		return 1;
+	return 0;
+    case expr_type_binding:
+	return uses_rand(e->data.bind.val);
+    default:
+	return 0;
+    }
+}
+
+/* bindings of the original expressions and their copies */
+struct remap
+{
+    const expression **from;
+    expression **to;
+    int n, alloc;
+};
+
+static expression *copy_expression(const expression *e, struct remap *m)
+{
+    expression *c = G_malloc(sizeof(expression));
+    int i;
+
+    *c = *e;
+    c->buf = NULL;
+    c->worker = NULL;
+    c->kernel = NULL;
+
+    switch (e->type) {
+    case expr_type_variable:
+	for (i = 0; i < m->n; i++)
+	    if (e->data.var.bind == m->from[i])
+		c->data.var.bind = m->to[i];
+	break;
+    case expr_type_function:
+	c->data.func.args =
+	    G_malloc((e->data.func.argc + 1) * sizeof(expression *));
+	c->data.func.args[0] = NULL;
+	for (i = 1; i <= e->data.func.argc; i++)
+	    c->data.func.args[i] = copy_expression(e->data.func.args[i], m);
+	c->data.func.argv = NULL;
+	break;
+    case expr_type_binding:
+	c->data.bind.val = copy_expression(e->data.bind.val, m);
+	c->data.bind.fd = -1;
+	/* nested bindings too, e.g. a = (t = x * 2) + t */
+	if (m->n == m->alloc) {
+	    m->alloc = m->alloc ? 2 * m->alloc : 16;
+	    m->from = G_realloc(m->from, m->alloc * sizeof(expression *));
+	    m->to = G_realloc(m->to, m->alloc * sizeof(expression *));
+	}
+	m->from[m->n] = e;
+	m->to[m->n] = c;
+	m->n++;
+	break;
+    }
+
+    return c;
+}
+
+/* copy and initialize the expressions for another block */
+static expr_list *copy_expressions(expr_list *ee)
+{
+    struct remap m = { NULL, NULL, 0, 0 };
+    expr_list *head = NULL, **tail = &head;
+    expr_list *l;
+
+    for (l = ee; l; l = l->next) {
+	*tail = list(copy_expression(l->exp, &m), NULL);
+	tail = &(*tail)->next;
+    }
+
+    for (l = head; l; l = l->next)
+	initialize(l->exp);
+
+    G_free(m.from);
+    G_free(m.to);
+
+    return head;
+}
+
+static void evaluate_block(void *p)
+{
+    struct block *b = p;
+    int r;
+
+    current_block = b->id;
+    current_depth = 0;
+
+    for (r = 0; r < b->nrows; r++) {
+	expr_list *l;
+	int k = 0;
+
+	current_row = b->row0 + r;
+
+	for (l = b->ee; l; l = l->next) {
+	    expression *e = l->exp;
+	    size_t size = columns * Rast_cell_size(e->res_type);
+
+	    evaluate(e);
+
+	    if (!is_output(e))
+		continue;
+
+	    memcpy((char *)b->out[k++] + r * size, e->buf, size);
+	}
+    }
+}
+
+static void execute_blocks(expr_list *ee, int nblocks, int verbose)
+{
+    struct block *blocks = G_calloc(nblocks, sizeof(struct block));
+    struct G_task_group *group;
+    int nout = 0;
+    size_t row_bytes = 0;
+    int block_rows;
+    int row0, i, k;
+    expr_list *l;
+
+    for (l = ee; l; l = l->next) {
+	expression *e = l->exp;
+
+	if (!is_output(e))
+	    continue;
+	nout++;
+	row_bytes += columns * Rast_cell_size(e->res_type);
+    }
+
+    block_rows = (rows + nblocks - 1) / nblocks;
+    if (block_rows > MAX_BLOCK_ROWS)
+	block_rows = MAX_BLOCK_ROWS;
+    if (row_bytes > 0 && (size_t) block_rows * nblocks * row_bytes > MAX_BLOCK_BYTES)
+	block_rows = MAX_BLOCK_BYTES / (row_bytes * nblocks);
+    if (block_rows < 1)
+	block_rows = 1;
+
+    G_debug(1, "Evaluating %d blocks of %d rows in parallel",
+	    nblocks, block_rows);
+
+    for (i = 0; i < nblocks; i++) {
+	struct block *b = &blocks[i];
+
+	b->id = i;
+	b->ee = i == 0 ? ee : copy_expressions(ee);
+	b->out = G_malloc((nout + 1) * sizeof(void *));
+
+	for (l = ee, k = 0; l; l = l->next) {
+	    expression *e = l->exp;
+
+	    if (!is_output(e))
+		continue;
+	    b->out[k++] = G_malloc((size_t) block_rows * columns *
+				   Rast_cell_size(e->res_type));
+	}
+    }
+
+    current_depth = 0;
+
+    for (row0 = 0; row0 < rows; row0 += nblocks * block_rows) {
+	if (verbose)
+	    G_percent(row0, rows, 2);
+
+	for (i = 0; i < nblocks; i++) {
+	    struct block *b = &blocks[i];
+
+	    b->row0 = row0 + i * block_rows;
+	    b->nrows = rows - b->row0;
+	    if (b->nrows > block_rows)
+		b->nrows = block_rows;
+	    if (b->nrows < 0)
+		b->nrows = 0;
+	}
+
+	group = G_task_group_create();
+	for (i = 0; i < nblocks; i++)
+	    if (blocks[i].nrows > 0)
+		G_task_submit(group, evaluate_block, &blocks[i]);
+	G_task_group_destroy(group);
+
+	/* write the output rows in order */
+	for (i = 0; i < nblocks; i++) {
+	    struct block *b = &blocks[i];
+	    int r;
+
+	    for (r = 0; r < b->nrows; r++) {
+		for (l = ee, k = 0; l; l = l->next) {
+		    expression *e = l->exp;
+		    size_t size = columns * Rast_cell_size(e->res_type);
+
+		    if (!is_output(e))
+			continue;
+
+		    put_map_row(e->data.bind.fd, (char *)b->out[k++] + r * size,
+				e->res_type);
+		}
+	    }
+	}
+    }
+
+    current_block = 0;
+    current_row = rows;
+
+    for (i = 0; i < nblocks; i++) {
+	for (k = 0; k < nout; k++)
+	    G_free(blocks[i].out[k]);
+	G_free(blocks[i].out);
+    }
+    G_free(blocks);
+}
+
+/****************************************************************************/
+
 static expr_list *exprs;
 
 /****************************************************************************/
@@ -296,10 +667,9 @@ static void error_handler(void *p)
 
     for (l = exprs; l; l = l->next) {
         expression *e = l->exp;
-        int fd = e->data.bind.fd;
 
-        if (fd >= 0)
-            unopen_output_map(fd);
+        if (is_output(e) && e->data.bind.fd >= 0)
+            unopen_output_map(e->data.bind.fd);
     }
 }
 
@@ -308,6 +678,7 @@ void execute(expr_list * ee)
     int verbose = isatty(2);
     expr_list *l;
     int count, n;
+    int nblocks;
 
     exprs = ee;
     G_add_error_handler(error_handler, NULL);
@@ -320,7 +691,7 @@ void execute(expr_list * ee)
             G_fatal_error("internal error: execute: invalid type: %d",
                   e->type);
 
-        if (e->type != expr_type_binding)
+        if (!is_output(e))
             continue;
 
         var = e->data.bind.var;
@@ -352,7 +723,7 @@ void execute(expr_list * ee)
 
         initialize(e);
 
-        if (e->type != expr_type_binding)
+        if (!is_output(e))
             continue;
 
         var = e->data.bind.var;
@@ -367,6 +738,30 @@ void execute(expr_list * ee)
 
     G_init_workers();
 
+    /* only 2D maps are evaluated in blocks of rows */
+    nblocks = depths == 1 ? nprocs : 1;
+    if (nblocks > rows)
+        nblocks = rows;
+    if (nblocks > 1) {
+        for (l = ee; l; l = l->next)
+            if (uses_rand(l->exp)) {
+                G_warning(_("rand() is evaluated sequentially "
+                            "for reproducible results, ignoring %s=%d"),
+                          "nprocs", nprocs);
+                nblocks = 1;
+                break;
+            }
+    }
+    if (nblocks > 1)
+        nblocks = setup_map_blocks(nblocks);
+
+    block_mode = 0;
+    if (nblocks > 1) {
+        block_mode = 1;
+        execute_blocks(ee, nblocks, verbose);
+        n = count;
+    }
+    else
     for (current_depth = 0; current_depth < depths; current_depth++) {
         for (current_row = 0; current_row < rows; current_row++) {
             if (verbose)
@@ -378,7 +773,7 @@ void execute(expr_list * ee)
 
             evaluate(e);
 
-            if (e->type != expr_type_binding)
+            if (!is_output(e))
                 continue;
 
             fd = e->data.bind.fd;
@@ -400,7 +795,7 @@ void execute(expr_list * ee)
         expression *val;
         int fd;
 
-        if (e->type != expr_type_binding)
+        if (!is_output(e))
             continue;
 
         var = e->data.bind.var;
@@ -419,9 +814,11 @@ void execute(expr_list * ee)
             copy_history(var, val->data.map.idx);
         }
         else
-        create_history(var, val);
+        create_history(var, e);
     }
 
+    release_maps();
+    G_remove_error_handler(error_handler, NULL);
     G_unset_error_routine();
 }
 
@@ -441,7 +838,7 @@ void describe_maps(FILE *fp, expr_list *ee)
 
         initialize(e);
 
-        if (e->type != expr_type_binding)
+        if (!is_output(e))
             continue;
 
         var = e->data.bind.var;
@@ -48,6 +48,7 @@ static expression *allocate(int type, int res_type)
     e->res_type = res_type;
     e->buf = NULL;
     e->worker = NULL;
+    e->kernel = NULL;
     return e;
 }
 
@@ -130,6 +131,12 @@ void define_variable(expression * e)
     variables = list(e, variables);
 }
 
+/* variables are local to a job in batch mode */
+void clear_variables(void)
+{
+    variables = NULL;
+}
+
 char *composite(const char *name, const char *mapset)
 {
     char *buf = G_malloc(strlen(name) + strlen(mapset) + 2);
@@ -235,6 +242,17 @@ expression *binding(const char *var, expression * val)
     e->data.bind.var = var;
     e->data.bind.val = val;
     e->data.bind.fd = -1;
+    e->data.bind.temp = 0;
+    e->data.bind.text = NULL;
+    return e;
+}
+
+expression *bound_variable(expression * bind)
+{
+    expression *e = allocate(expr_type_variable, bind->res_type);
+
+    e->data.var.name = bind->data.bind.var;
+    e->data.var.bind = bind;
     return e;
 }
 
@@ -298,6 +316,7 @@ expression *operator(const char *name, const char *oper, int prec,
     e->data.func.args = args;
     e->data.func.argt = argt;
     e->data.func.argv = NULL;
+    e->data.func.lazy = 0;
     return e;
 }
 
@@ -5,6 +5,7 @@
 #include <grass/calc.h>
 
 struct expr_list;
+struct kernel;
 
 typedef enum expr_t
 {
@@ -45,6 +46,7 @@ typedef struct expr_data_func
     struct expression **args;
     int *argt;
     void **argv;
+    int lazy;			/* if(): unselected branches are skipped */
 } expr_data_func;
 
 typedef struct expr_data_bind
@@ -52,6 +54,8 @@ typedef struct expr_data_bind
     const char *var;
     struct expression *val;
     int fd;
+    int temp;			/* shared subexpression, not an output map */
+    const char *text;		/* value as written, for the history */
 } expr_data_bind;
 
 typedef struct expression
@@ -68,6 +72,8 @@ typedef struct expression
 	expr_data_bind bind;
     } data;
     void *worker;
+    int row, depth;		/* row and depth for worker */
+    struct kernel *kernel;	/* fused operators below, see kernel.c */
 } expression;
 
 typedef struct expr_list
@@ -78,6 +84,7 @@ typedef struct expr_list
 
 extern int list_length(expr_list * l);
 extern void define_variable(expression * e);
+extern void clear_variables(void);
 extern char *composite(const char *name, const char *mapset);
 extern expr_list *list(expression * exp, expr_list * next);
 extern expr_list *singleton(expression * e1);
@@ -93,6 +100,7 @@ extern expression *operator(const char *name, const char *oper, int prec,
 			    expr_list * args);
 extern expression *function(const char *name, expr_list * args);
 extern expression *binding(const char *var, expression * val);
+extern expression *bound_variable(expression * bind);
 
 extern func_desc local_func_descs[];
 
@@ -2,12 +2,23 @@
 #ifndef __GLOBALS_H_
 #define __GLOBALS_H_
 
+/* the row being evaluated is per thread when the region is evaluated
+   in blocks of rows by several threads, see evaluate.c */
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#define HAVE_THREAD_LOCAL 1
+#else
+#define THREAD_LOCAL
+#endif
+
 extern int overwrite_flag;
 extern long seed_value;
 extern long seeded;
 extern int region_approach;
+extern int nprocs;
 
-extern int current_depth, current_row;
+extern THREAD_LOCAL int current_depth, current_row;
+extern THREAD_LOCAL int current_block;
 extern int depths, rows, columns;
 
 #endif /* __GLOBALS_H_ */
@@ -0,0 +1,514 @@
+
+#include <stdlib.h>
+#include <math.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/calc.h>
+
+#include "mapcalc.h"
+#include "func_proto.h"
+
+/****************************************************************************/
+
+/* Fused evaluation of arithmetic subexpressions: instead of a pass over
+ * a row buffer per operator, a tree of operators is compiled into a
+ * program which is run on tiles of TILE cells, keeping all
+ * intermediate results in registers of the size of a tile. Registers
+ * hold doubles, NULL is NaN; CELL and FCELL values are exact in a
+ * double and FCELL results are rounded to float after each operation,
+ * so the results are the same as those of the lib/calc functions. */
+
+#define TILE 256
+
+enum op_code
+{
+    OP_CONST,
+    OP_LOAD,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_NEG,
+    OP_GT,
+    OP_GE,
+    OP_LT,
+    OP_LE,
+    OP_EQ,
+    OP_NE,
+    OP_AND,
+    OP_OR,
+    OP_NOT,
+    OP_IF,
+    OP_ISNULL,
+    OP_FLOAT,
+    OP_DOUBLE
+};
+
+struct op
+{
+    int code;
+    int res_type;
+    int argc;
+    int *args;			/* registers of the arguments */
+    double val;			/* OP_CONST */
+    expression *leaf;		/* OP_LOAD */
+};
+
+struct kernel
+{
+    int nops;
+    struct op *ops;		/* the result of op i is in register i */
+    double *regs;
+    int nleaves;
+    expression **leaves;
+};
+
+/****************************************************************************/
+
+static const struct
+{
+    func_t *func;
+    int code;
+} fused_funcs[] = {
+    {f_add, OP_ADD},
+    {f_sub, OP_SUB},
+    {f_mul, OP_MUL},
+    {f_div, OP_DIV},
+    {f_neg, OP_NEG},
+    {f_gt, OP_GT},
+    {f_ge, OP_GE},
+    {f_lt, OP_LT},
+    {f_le, OP_LE},
+    {f_eq, OP_EQ},
+    {f_ne, OP_NE},
+    {f_and, OP_AND},
+    {f_or, OP_OR},
+    {f_not, OP_NOT},
+    {f_if, OP_IF},
+    {f_isnull, OP_ISNULL},
+    {f_float, OP_FLOAT},
+    {f_double, OP_DOUBLE},
+    {NULL, 0}
+};
+
+static int fused_code(const expression *e);
+
+/* whether e calls a function which is not fused */
+static int is_costly(const expression *e)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+	if (fused_code(e) < 0)
+	    return e->data.func.argc > 0;
+	for (i = 1; i <= e->data.func.argc; i++)
+	    if (is_costly(e->data.func.args[i]))
+		return 1;
+	return 0;
+    case expr_type_binding:
+	return 1;
+    default:
+	return 0;
+    }
+}
+
+/* the op code of a function which can be fused, -1 otherwise */
+static int fused_code(const expression *e)
+{
+    int i;
+
+    if (e->type != expr_type_function)
+	return -1;
+
+    for (i = 0; fused_funcs[i].func; i++)
+	if (e->data.func.func == fused_funcs[i].func)
+	    break;
+    if (!fused_funcs[i].func)
+	return -1;
+
+    switch (fused_funcs[i].code) {
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MUL:
+    case OP_DIV:
+    case OP_NEG:
+	/* integer arithmetic overflows and truncates */
+	if (e->res_type == CELL_TYPE)
+	    return -1;
+	break;
+    case OP_IF:
+	if (e->data.func.argc < 1 || e->data.func.argc > 4 ||
+	    (e->data.func.argc == 1 && e->res_type != CELL_TYPE))
+	    return -1;
+	/* costly branches are only evaluated for the rows which use
+	   them, see evaluate_if_args() */
+	for (i = 2; i <= e->data.func.argc; i++)
+	    if (is_costly(e->data.func.args[i]))
+		return -1;
+	break;
+    }
+
+    return fused_funcs[i].code;
+}
+
+/****************************************************************************/
+
+static int add_op(struct kernel *k, int code, int res_type, int argc)
+{
+    struct op *op;
+
+    k->ops = G_realloc(k->ops, (k->nops + 1) * sizeof(struct op));
+    op = &k->ops[k->nops];
+    op->code = code;
+    op->res_type = res_type;
+    op->argc = argc;
+    op->args = argc > 0 ? G_malloc(argc * sizeof(int)) : NULL;
+    op->val = 0;
+    op->leaf = NULL;
+
+    return k->nops++;
+}
+
+/* emit the program of e, returns the register of the result */
+static int compile(struct kernel *k, expression *e)
+{
+    int code = fused_code(e);
+    int i, reg;
+
+    if (code < 0) {
+	if (e->type == expr_type_constant) {
+	    reg = add_op(k, OP_CONST, e->res_type, 0);
+	    switch (e->res_type) {
+	    case CELL_TYPE:
+		k->ops[reg].val = e->data.con.ival;
+		break;
+	    case FCELL_TYPE:
+		k->ops[reg].val = (FCELL) e->data.con.fval;
+		break;
+	    default:
+		k->ops[reg].val = e->data.con.fval;
+		break;
+	    }
+	    return reg;
+	}
+
+	/* anything else is evaluated into its own buffer */
+	reg = add_op(k, OP_LOAD, e->res_type, 0);
+	k->ops[reg].leaf = e;
+	k->leaves = G_realloc(k->leaves,
+			      (k->nleaves + 1) * sizeof(expression *));
+	k->leaves[k->nleaves++] = e;
+	return reg;
+    }
+
+    {
+	int argc = e->data.func.argc;
+	int *args = G_malloc(argc * sizeof(int));
+
+	for (i = 1; i <= argc; i++)
+	    args[i - 1] = compile(k, e->data.func.args[i]);
+
+	reg = add_op(k, code, e->res_type, argc);
+	for (i = 0; i < argc; i++)
+	    k->ops[reg].args[i] = args[i];
+	G_free(args);
+    }
+
+    return reg;
+}
+
+/*
+ * compile e and the operators below it into a kernel; NULL if e is
+ * not an operator which can be fused or none of its arguments is one,
+ * so that nothing would be saved
+ */
+struct kernel *compile_kernel(expression *e)
+{
+    struct kernel *k;
+    int i;
+
+    if (fused_code(e) < 0)
+	return NULL;
+
+    for (i = 1; i <= e->data.func.argc; i++)
+	if (fused_code(e->data.func.args[i]) >= 0)
+	    break;
+    if (i > e->data.func.argc)
+	return NULL;
+
+    k = G_calloc(1, sizeof(struct kernel));
+    compile(k, e);
+    k->regs = G_malloc((size_t) k->nops * TILE * sizeof(double));
+
+    G_debug(3, "Fused %s into a kernel of %d operations",
+	    e->data.func.name, k->nops);
+
+    return k;
+}
+
+/* the subexpressions which are evaluated into their own buffers */
+expression **kernel_leaves(struct kernel *k, int *nleaves)
+{
+    *nleaves = k->nleaves;
+
+    return k->leaves;
+}
+
+void free_kernel(struct kernel *k)
+{
+    int i;
+
+    for (i = 0; i < k->nops; i++)
+	G_free(k->ops[i].args);
+    G_free(k->ops);
+    G_free(k->regs);
+    G_free(k->leaves);
+    G_free(k);
+}
+
+/****************************************************************************/
+
+static void load(double *r, const void *buf, int type, int col0, int n)
+{
+    int i;
+
+    switch (type) {
+    case CELL_TYPE:
+	{
+	    const CELL *c = (const CELL *)buf + col0;
+
+	    for (i = 0; i < n; i++)
+		r[i] = IS_NULL_C(&c[i]) ? NAN : c[i];
+	}
+	break;
+    case FCELL_TYPE:
+	{
+	    const FCELL *f = (const FCELL *)buf + col0;
+
+	    for (i = 0; i < n; i++)
+		r[i] = f[i];
+	}
+	break;
+    default:
+	{
+	    const DCELL *d = (const DCELL *)buf + col0;
+
+	    for (i = 0; i < n; i++)
+		r[i] = d[i];
+	}
+	break;
+    }
+}
+
+static void store(void *buf, const double *r, int type, int col0, int n)
+{
+    int i;
+
+    switch (type) {
+    case CELL_TYPE:
+	{
+	    CELL *c = (CELL *) buf + col0;
+
+	    for (i = 0; i < n; i++)
+		if (isnan(r[i]))
+		    SET_NULL_C(&c[i]);
+		else
+		    c[i] = (CELL) r[i];
+	}
+	break;
+    case FCELL_TYPE:
+	{
+	    FCELL *f = (FCELL *) buf + col0;
+
+	    for (i = 0; i < n; i++)
+		if (isnan(r[i]))
+		    SET_NULL_F(&f[i]);
+		else
+		    f[i] = (FCELL) r[i];
+	}
+	break;
+    default:
+	{
+	    DCELL *d = (DCELL *) buf + col0;
+
+	    for (i = 0; i < n; i++)
+		if (isnan(r[i]))
+		    SET_NULL_D(&d[i]);
+		else
+		    d[i] = r[i];
+	}
+	break;
+    }
+}
+
+/* round the results of an FCELL operation to float */
+static void round_float(double *r, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	r[i] = (FCELL) r[i];
+}
+
+/* comparison of two registers: NULL if one of them is NULL */
+#define COMPARE(OP)						\
+    for (i = 0; i < n; i++)					\
+	r[i] = isnan(a[0][i]) || isnan(a[1][i]) ? NAN :		\
+	    (a[0][i] OP a[1][i])
+
+static void run_op(struct kernel *k, const struct op *op, double *r,
+		   int col0, int n)
+{
+    const double *a[4];
+    int i, j;
+
+    for (j = 0; j < op->argc && j < 4; j++)
+	a[j] = k->regs + (size_t) op->args[j] * TILE;
+
+    switch (op->code) {
+    case OP_CONST:
+	for (i = 0; i < n; i++)
+	    r[i] = op->val;
+	break;
+    case OP_LOAD:
+	load(r, op->leaf->buf, op->leaf->res_type, col0, n);
+	break;
+
+	/* NaN propagates through the arithmetic like NULL */
+    case OP_ADD:
+	for (i = 0; i < n; i++)
+	    r[i] = 0;
+	for (j = 0; j < op->argc; j++) {
+	    const double *b = k->regs + (size_t) op->args[j] * TILE;
+
+	    for (i = 0; i < n; i++)
+		r[i] += b[i];
+	    if (op->res_type == FCELL_TYPE)
+		round_float(r, n);
+	}
+	return;
+    case OP_MUL:
+	for (i = 0; i < n; i++)
+	    r[i] = 1;
+	for (j = 0; j < op->argc; j++) {
+	    const double *b = k->regs + (size_t) op->args[j] * TILE;
+
+	    for (i = 0; i < n; i++)
+		r[i] *= b[i];
+	    if (op->res_type == FCELL_TYPE)
+		round_float(r, n);
+	}
+	return;
+    case OP_SUB:
+	for (i = 0; i < n; i++)
+	    r[i] = a[0][i] - a[1][i];
+	break;
+    case OP_DIV:
+	for (i = 0; i < n; i++) {
+	    if (isnan(a[0][i]) || isnan(a[1][i]) || a[1][i] == 0.0)
+		r[i] = NAN;
+	    else {
+		floating_point_exception = 0;
+		r[i] = a[0][i] / a[1][i];
+		if (floating_point_exception)
+		    r[i] = NAN;
+	    }
+	}
+	break;
+    case OP_NEG:
+	for (i = 0; i < n; i++)
+	    r[i] = -a[0][i];
+	break;
+
+    case OP_GT:
+	COMPARE(>);
+	break;
+    case OP_GE:
+	COMPARE(>=);
+	break;
+    case OP_LT:
+	COMPARE(<);
+	break;
+    case OP_LE:
+	COMPARE(<=);
+	break;
+    case OP_EQ:
+	COMPARE(==);
+	break;
+    case OP_NE:
+	COMPARE(!=);
+	break;
+
+    case OP_AND:
+    case OP_OR:
+	for (i = 0; i < n; i++) {
+	    r[i] = op->code == OP_AND;
+	    for (j = 0; j < op->argc; j++) {
+		double b = k->regs[(size_t) op->args[j] * TILE + i];
+
+		if (isnan(b)) {
+		    r[i] = NAN;
+		    break;
+		}
+		if (op->code == OP_AND ? b == 0 : b != 0)
+		    r[i] = op->code == OP_OR;
+	    }
+	}
+	break;
+    case OP_NOT:
+	for (i = 0; i < n; i++)
+	    r[i] = isnan(a[0][i]) ? NAN : !a[0][i];
+	break;
+
+    case OP_IF:
+	for (i = 0; i < n; i++) {
+	    double c = a[0][i];
+
+	    if (isnan(c))
+		r[i] = NAN;
+	    else if (op->argc == 1)
+		r[i] = c != 0.0 ? 1 : 0;
+	    else if (c == 0.0)
+		r[i] = op->argc >= 3 ? a[2][i] : 0;
+	    else if (c > 0.0 || op->argc < 4)
+		r[i] = a[1][i];
+	    else
+		r[i] = a[3][i];
+	}
+	break;
+    case OP_ISNULL:
+	for (i = 0; i < n; i++)
+	    r[i] = isnan(a[0][i]) ? 1 : 0;
+	break;
+
+    case OP_FLOAT:
+	for (i = 0; i < n; i++)
+	    r[i] = a[0][i];
+	break;
+    case OP_DOUBLE:
+	for (i = 0; i < n; i++)
+	    r[i] = a[0][i];
+	break;
+    }
+
+    if (op->res_type == FCELL_TYPE)
+	round_float(r, n);
+}
+
+/* evaluate the kernel into buf, the leaves must have been evaluated */
+void evaluate_kernel(struct kernel *k, void *buf, int res_type)
+{
+    int col0, j;
+
+    for (col0 = 0; col0 < columns; col0 += TILE) {
+	int n = columns - col0 < TILE ? columns - col0 : TILE;
+
+	for (j = 0; j < k->nops; j++)
+	    run_op(k, &k->ops[j], k->regs + (size_t) j * TILE, col0, n);
+
+	store(buf, k->regs + (size_t) (k->nops - 1) * TILE, res_type,
+	      col0, n);
+    }
+}
@@ -29,6 +29,7 @@ int overwrite_flag;
 long seed_value;
 long seeded;
 int region_approach;
+int nprocs;
 
 /****************************************************************************/
 
@@ -60,8 +61,8 @@ static expr_list *parse_file(const char *filename)
 int main(int argc, char **argv)
 {
     struct GModule *module;
-    struct Option *expr, *file, *seed, *region;
-    struct Flag *random, *describe;
+    struct Option *expr, *file, *seed, *region, *procs;
+    struct Flag *random, *describe, *batch;
     int all_ok;
 
     G_gisinit(argv[0]);
@@ -104,6 +105,8 @@ int main(int argc, char **argv)
     seed->required = NO;
     seed->description = _("Seed for rand() function");
 
+    procs = G_define_standard_option(G_OPT_M_NPROCS);
+
     random = G_define_flag();
     random->key = 's';
     random->description = _("Generate random seed (result is non-deterministic)");
@@ -112,6 +115,12 @@ int main(int argc, char **argv)
     describe->key = 'l';
     describe->description = _("List input and output maps");
 
+    batch = G_define_flag();
+    batch->key = 'b';
+    batch->description =
+        _("Batch mode: evaluate the jobs of the input, separated by "
+          "empty lines, in as few passes as possible");
+
     if (argc == 1)
     {
         char **p = G_malloc(3 * sizeof(char *));
@@ -135,16 +144,25 @@ int main(int argc, char **argv)
         G_fatal_error(_("%s= and -%c are mutually exclusive"),
                         seed->key, random->key);
 
-    if (expr->answer)
+    if (batch->answer && (expr->answer || describe->answer))
+        G_fatal_error(_("-%c is not compatible with %s= and -%c"),
+                        batch->key, expr->key, describe->key);
+
+    if (batch->answer)
+        result = NULL;
+    else if (expr->answer)
         result = parse_string(expr->answer);
     else if (file->answer)
         result = parse_file(file->answer);
     else
         result = parse_stream(stdin);
 
-    if (!result)
+    if (!result && !batch->answer)
         G_fatal_error(_("parse error"));
 
+    if (result)
+        result = optimize(result);
+
     if (seed->answer) {
         seed_value = atol(seed->answer);
         G_srand48(seed_value);
@@ -158,6 +176,8 @@ int main(int argc, char **argv)
         G_debug(3, "Generated random seed (-s): %ld", seed_value);
     }
 
+    nprocs = G_set_nprocs(procs);
+
     /* Set the global variable of the region setup approach */ 
     region_approach = 1;
 
@@ -175,12 +195,27 @@ int main(int argc, char **argv)
         return EXIT_SUCCESS;
     }
 
+    all_ok = 1;
+
     pre_exec();
-    execute(result);
+    if (batch->answer) {
+        FILE *fp = stdin;
+
+        if (file->answer && strcmp(file->answer, "-") != 0) {
+            fp = fopen(file->answer, "r");
+            if (!fp)
+                G_fatal_error(_("Unable to open input file <%s>"),
+                              file->answer);
+        }
+        if (run_batch(fp) > 0)
+            all_ok = 0;
+        if (fp != stdin)
+            fclose(fp);
+    }
+    else
+        execute(result);
     post_exec();
 
-    all_ok = 1;
-
     if (floating_point_exception_occurred) {
         G_warning(_("Floating point error(s) occurred in the calculation"));
         all_ok = 0;
@@ -45,13 +45,23 @@ struct sub_cache
     void **buf;
 };
 
+/* rows are padded with pad null cells on either side, so that a
+   reference shifted by up to pad columns is a plain copy */
 struct row_cache
 {
     int fd;
     int nrows;
+    int pad;
     struct sub_cache *sub[3];
 };
 
+/* map handle of a block of rows evaluated by its own thread */
+struct map_block
+{
+    int fd;
+    struct row_cache cache;
+};
+
 struct map
 {
     const char *name;
@@ -60,11 +70,13 @@ struct map
     int have_colors;
     int use_rowio;
     int min_row, max_row;
+    int min_col, max_col;
     int fd;
     struct Categories cats;
     struct Colors colors;
     BTREE btree;
     struct row_cache cache;
+    struct map_block *blocks;	/* handles of blocks 1..num_blocks-1 */
 #ifdef HAVE_PTHREAD_H
     pthread_mutex_t mutex;
 #endif
@@ -75,7 +87,6 @@ struct map
 static struct map *maps;
 static int num_maps;
 static int max_maps;
-static int masking;
 
 static int min_row = INT_MAX;
 static int max_row = -INT_MAX;
@@ -84,44 +95,47 @@ static int max_col = -INT_MAX;
 
 static int max_rows_in_memory = 8;
 
+static int num_blocks = 1;
+static int maps_ready;
+
 #ifdef HAVE_PTHREAD_H
 static pthread_mutex_t cats_mutex;
-static pthread_mutex_t mask_mutex;
 #endif
 
 /****************************************************************************/
 
+/* the MASK is shared by all maps, libraster serializes its reads */
 static void read_row(int fd, void *buf, int row, int res_type)
 {
-#ifdef HAVE_PTHREAD_H
-    if (masking)
-	pthread_mutex_lock(&mask_mutex);
-#endif
     Rast_get_row(fd, buf, row, res_type);
-#ifdef HAVE_PTHREAD_H
-    if (masking)
-	pthread_mutex_unlock(&mask_mutex);
-#endif
 }
 
 static void cache_sub_init(struct row_cache *cache, int data_type)
 {
     struct sub_cache *sub = G_malloc(sizeof(struct sub_cache));
+    size_t size = Rast_cell_size(data_type);
     int i;
 
     sub->row = -cache->nrows;
     sub->valid = G_calloc(cache->nrows, 1);
     sub->buf = G_malloc(cache->nrows * sizeof(void *));
-    for (i = 0; i < cache->nrows; i++)
-	sub->buf[i] = Rast_allocate_buf(data_type);
+    for (i = 0; i < cache->nrows; i++) {
+	char *p = G_malloc((columns + 2 * cache->pad + 1) * size);
+
+	Rast_set_null_value(p, cache->pad, data_type);
+	Rast_set_null_value(p + (cache->pad + columns) * size, cache->pad,
+			    data_type);
+	sub->buf[i] = p + cache->pad * size;
+    }
 
     cache->sub[data_type] = sub;
 }
 
-static void cache_setup(struct row_cache *cache, int fd, int nrows)
+static void cache_setup(struct row_cache *cache, int fd, int nrows, int pad)
 {
     cache->fd = fd;
     cache->nrows = nrows;
+    cache->pad = pad;
     cache->sub[CELL_TYPE] = NULL;
     cache->sub[FCELL_TYPE] = NULL;
     cache->sub[DCELL_TYPE] = NULL;
@@ -139,7 +153,7 @@ static void cache_release(struct row_cache *cache)
 	    continue;
 
 	for (i = 0; i < cache->nrows; i++)
-	    G_free(sub->buf[i]);
+	    G_free((char *)sub->buf[i] - cache->pad * Rast_cell_size(t));
 
 	G_free(sub->buf);
 	G_free(sub->valid);
@@ -207,10 +221,18 @@ static void *cache_get_raw(struct row_cache *cache, int row, int data_type)
     return sub->buf[i];
 }
 
-static void cache_get(struct row_cache *cache, void *buf, int row, int res_type)
+static void cache_get(struct row_cache *cache, void *buf, int row, int col,
+		      int res_type)
 {
-    void *p = cache_get_raw(cache, row, res_type);
-    memcpy(buf, p, columns * Rast_cell_size(res_type));
+    size_t size = Rast_cell_size(res_type);
+    char *p = cache_get_raw(cache, row, res_type);
+
+    if (col >= columns || col <= -columns) {
+	Rast_set_null_value(buf, columns, res_type);
+	return;
+    }
+
+    memcpy(buf, p + col * size, columns * size);
 }
 
 /****************************************************************************/
@@ -384,16 +406,30 @@ static void translate_from_cats(struct map *m, CELL * cell, DCELL * xcell,
 #endif
 }
 
+static int map_pad(const struct map *m)
+{
+    int pad = m->max_col > -m->min_col ? m->max_col : -m->min_col;
+
+    /* offsets beyond the row width only yield nulls */
+    return pad < columns ? pad : columns;
+}
+
 static void setup_map(struct map *m)
 {
     int nrows = m->max_row - m->min_row + 1;
+    int pad = map_pad(m);
+
+    if (m->fd < 0)
+	return;
 
 #ifdef HAVE_PTHREAD_H
     pthread_mutex_init(&m->mutex, NULL);
 #endif
 
-    if (nrows > 1 && nrows <= max_rows_in_memory) {
-	cache_setup(&m->cache, m->fd, nrows);
+    /* rows of neighbourhood references are read once and shared,
+       column offsets are taken from the padded cached row */
+    if ((nrows > 1 || pad > 0) && nrows <= max_rows_in_memory) {
+	cache_setup(&m->cache, m->fd, nrows, pad);
 	m->use_rowio = 1;
     }
     else
@@ -430,8 +466,20 @@ static void read_map(struct map *m, void *buf, int res_type, int row, int col)
 	return;
     }
 
-    if (m->use_rowio)
-	cache_get(&m->cache, buf, row, res_type);
+    if (current_block > 0) {
+	struct map_block *b = &m->blocks[current_block];
+
+	if (m->use_rowio) {
+	    cache_get(&b->cache, buf, row, col, res_type);
+	    return;
+	}
+
+	read_row(b->fd, buf, row, res_type);
+    }
+    else if (m->use_rowio) {
+	cache_get(&m->cache, buf, row, col, res_type);
+	return;
+    }
     else
 	read_row(m->fd, buf, row, res_type);
 
@@ -439,17 +487,42 @@ static void read_map(struct map *m, void *buf, int res_type, int row, int col)
 	column_shift(buf, res_type, col);
 }
 
-static void close_map(struct map *m)
+/* releases what setup_map() and setup_map_blocks() set up */
+static void release_map(struct map *m)
 {
     if (m->fd < 0)
 	return;
 
-    Rast_close(m->fd);
-
 #ifdef HAVE_PTHREAD_H
     pthread_mutex_destroy(&m->mutex);
 #endif
 
+    if (m->blocks) {
+	int i;
+
+	for (i = 1; i < num_blocks; i++) {
+	    Rast_close(m->blocks[i].fd);
+	    if (m->use_rowio)
+		cache_release(&m->blocks[i].cache);
+	}
+	G_free(m->blocks);
+	m->blocks = NULL;
+    }
+
+    if (m->use_rowio) {
+	cache_release(&m->cache);
+	m->use_rowio = 0;
+    }
+}
+
+static void close_map(struct map *m)
+{
+    if (m->fd < 0)
+	return;
+
+    Rast_close(m->fd);
+    m->fd = -1;
+
     if (m->have_cats) {
 	btree_free(&m->btree);
 	Rast_free_cats(&m->cats);
@@ -460,11 +533,6 @@ static void close_map(struct map *m)
 	Rast_free_colors(&m->colors);
 	m->have_colors = 0;
     }
-
-    if (m->use_rowio) {
-	cache_release(&m->cache);
-	m->use_rowio = 0;
-    }
 }
 
 /****************************************************************************/
@@ -540,6 +608,9 @@ int open_map(const char *name, int mod, int row, int col)
     for (i = 0; i < num_maps; i++) {
 	m = &maps[i];
 
+	if (m->fd < 0)
+	    continue;
+
 	if (strcmp(m->name, name) != 0 || strcmp(m->mapset, mapset) != 0)
 	    continue;
 
@@ -547,6 +618,10 @@ int open_map(const char *name, int mod, int row, int col)
 	    m->min_row = row;
 	if (row > m->max_row)
 	    m->max_row = row;
+	if (col < m->min_col)
+	    m->min_col = col;
+	if (col > m->max_col)
+	    m->max_col = col;
 
 	if (use_cats && !m->have_cats)
 	    init_cats(m);
@@ -572,7 +647,10 @@ int open_map(const char *name, int mod, int row, int col)
     m->use_rowio = 0;
     m->min_row = row;
     m->max_row = row;
+    m->min_col = col;
+    m->max_col = col;
     m->fd = -1;
+    m->blocks = NULL;
 
     if (use_cats)
 	init_cats(m);
@@ -588,25 +666,65 @@ void setup_maps(void)
 {
     int i;
 
+    release_maps();
+    maps_ready = 1;
+
 #ifdef HAVE_PTHREAD_H
     pthread_mutex_init(&cats_mutex, NULL);
-    pthread_mutex_init(&mask_mutex, NULL);
-    masking = Rast_maskfd() >= 0;
 #endif
 
     for (i = 0; i < num_maps; i++)
 	setup_map(&maps[i]);
 }
 
+/* open a separate handle of each map for each block of rows, block 0
+   uses the handles opened by open_map()
+   returns the number of blocks which can be evaluated concurrently */
+int setup_map_blocks(int nblocks)
+{
+    int i, j;
+
+#ifndef HAVE_THREAD_LOCAL
+    nblocks = 1;
+#endif
+    if (nblocks <= 1)
+	return 1;
+
+    for (i = 0; i < num_maps; i++) {
+	struct map *m = &maps[i];
+	int nrows = m->max_row - m->min_row + 1;
+
+	if (m->fd < 0)
+	    continue;
+
+	m->blocks = G_calloc(nblocks, sizeof(struct map_block));
+	for (j = 1; j < nblocks; j++) {
+	    struct map_block *b = &m->blocks[j];
+
+	    b->fd = Rast_open_old(m->name, m->mapset);
+	    if (m->use_rowio)
+		cache_setup(&b->cache, b->fd, nrows, map_pad(m));
+	}
+    }
+
+    num_blocks = nblocks;
+
+    return nblocks;
+}
+
 void get_map_row(int idx, int mod, int depth, int row, int col, void *buf,
 		 int res_type)
 {
     CELL *ibuf;
     DCELL *fbuf;
     struct map *m = &maps[idx];
+    /* with separate handles per block only category and color
+       lookups are shared between threads */
+    int lock = num_blocks <= 1 || mod != 'M';
 
 #ifdef HAVE_PTHREAD_H
-    pthread_mutex_lock(&m->mutex);
+    if (lock)
+	pthread_mutex_lock(&m->mutex);
 #endif
 
     switch (mod) {
@@ -636,25 +754,63 @@ void get_map_row(int idx, int mod, int depth, int row, int col, void *buf,
     }
 
 #ifdef HAVE_PTHREAD_H
-    pthread_mutex_unlock(&m->mutex);
+    if (lock)
+	pthread_mutex_unlock(&m->mutex);
 #endif
 }
 
-void close_maps(void)
+/* releases the row caches and block handles of a run, the maps stay
+   open for later runs (see batch.c) */
+void release_maps(void)
 {
     int i;
 
+    if (!maps_ready)
+	return;
+
     for (i = 0; i < num_maps; i++)
-	close_map(&maps[i]);
+	release_map(&maps[i]);
 
-    num_maps = 0;
+    num_blocks = 1;
+    maps_ready = 0;
 
 #ifdef HAVE_PTHREAD_H
     pthread_mutex_destroy(&cats_mutex);
-    pthread_mutex_destroy(&mask_mutex);
 #endif
 }
 
+void close_maps(void)
+{
+    int i;
+
+    release_maps();
+
+    for (i = 0; i < num_maps; i++)
+	close_map(&maps[i]);
+
+    num_maps = 0;
+}
+
+/* closes the input map <name> of the current mapset after it has been
+   overwritten, later references open it again */
+void forget_map(const char *name)
+{
+    char xname[GNAME_MAX], xmapset[GMAPSET_MAX];
+    int i;
+
+    for (i = 0; i < num_maps; i++) {
+	struct map *m = &maps[i];
+	const char *base = m->name;
+
+	if (m->fd < 0 || strcmp(m->mapset, G_mapset()) != 0)
+	    continue;
+	if (G_name_is_fully_qualified(m->name, xname, xmapset))
+	    base = xname;
+	if (strcmp(base, name) == 0)
+	    close_map(m);
+    }
+}
+
 void list_maps(FILE *fp, const char *sep)
 {
     int i;
@@ -734,7 +890,8 @@ void create_history(const char *dst, expression * e)
     int RECORD_LEN = 80;
     int WIDTH = RECORD_LEN - 12;
     struct History hist;
-    char *expr = format_expression(e);
+    char *expr = e->data.bind.text ? G_store(e->data.bind.text)
+	: format_expression(e->data.bind.val);
     char *p = expr;
     int len = strlen(expr);
     int i;
@@ -372,6 +372,7 @@ static void close_map(map * m)
     if (!Rast3d_close(m->handle))
 	G_fatal_error(_("Unable to close raster map <%s@%s>"),
 		      m->name, m->mapset);
+    m->handle = NULL;
 
     if (m->have_cats) {
 	btree_free(&m->btree);
@@ -473,6 +474,9 @@ int open_map(const char *name, int mod, int row, int col)
     for (i = 0; i < num_maps; i++) {
 	m = &maps[i];
 
+	if (!m->handle)
+	    continue;
+
 	if (strcmp(m->name, name) != 0 || strcmp(m->mapset, mapset) != 0)
 	    continue;
 
@@ -534,6 +538,12 @@ void setup_maps(void)
 	setup_map(&maps[i]);
 }
 
+int setup_map_blocks(int nblocks)
+{
+    /* the raster3d library is not thread safe, see above */
+    return 1;
+}
+
 void get_map_row(int idx, int mod, int depth, int row, int col, void *buf,
 		 int res_type)
 {
@@ -568,6 +578,10 @@ void get_map_row(int idx, int mod, int depth, int row, int col, void *buf,
     }
 }
 
+void release_maps(void)
+{
+}
+
 void close_maps(void)
 {
     int i;
@@ -578,6 +592,26 @@ void close_maps(void)
     num_maps = 0;
 }
 
+/* closes the input map <name> of the current mapset after it has been
+   overwritten, later references open it again */
+void forget_map(const char *name)
+{
+    char xname[GNAME_MAX], xmapset[GMAPSET_MAX];
+    int i;
+
+    for (i = 0; i < num_maps; i++) {
+	map *m = &maps[i];
+	const char *base = m->name;
+
+	if (!m->handle || strcmp(m->mapset, G_mapset()) != 0)
+	    continue;
+	if (G_name_is_fully_qualified(m->name, xname, xmapset))
+	    base = xname;
+	if (strcmp(base, name) == 0)
+	    close_map(m);
+    }
+}
+
 void list_maps(FILE *fp, const char *sep)
 {
     int i;
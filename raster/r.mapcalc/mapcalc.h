@@ -40,6 +40,21 @@ extern char *format_expression(const expression *);
 extern void execute(expr_list *);
 extern void describe_maps(FILE *, expr_list *);
 
+/* batch.c */
+
+extern int run_batch(FILE *);
+
+/* optimize.c */
+
+extern expr_list *optimize(expr_list *);
+
+/* kernel.c */
+
+extern struct kernel *compile_kernel(expression *);
+extern expression **kernel_leaves(struct kernel *, int *);
+extern void evaluate_kernel(struct kernel *, void *, int);
+extern void free_kernel(struct kernel *);
+
 /* map.c/map3.c */
 
 extern void setup_region(void);
@@ -47,9 +62,12 @@ extern void setup_region(void);
 extern int map_type(const char *name, int mod);
 extern int open_map(const char *name, int mod, int row, int col);
 extern void setup_maps(void);
+extern int setup_map_blocks(int nblocks);
 extern void get_map_row(int idx, int mod, int depth, int row, int col,
 			void *buf, int res_type);
+extern void release_maps(void);
 extern void close_maps(void);
+extern void forget_map(const char *name);
 extern void list_maps(FILE *, const char *);
 
 extern int check_output_map(const char *name);
@@ -0,0 +1,649 @@
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/calc.h>
+
+#include "mapcalc.h"
+#include "func_proto.h"
+
+/****************************************************************************
+ * Rewrites the parsed expressions before they are evaluated:
+ *
+ * - calls of library functions with constant arguments are replaced by
+ *   their result,
+ * - eval() arguments and top-level expressions whose value is never used
+ *   are dropped, as are bindings which are never referenced,
+ * - subexpressions which occur more than once, in one expression or in
+ *   several expressions of a script, are evaluated only once into a
+ *   temporary binding which shares its buffer with all uses.
+ *
+ * rand() is never folded, dropped or shared.
+ ****************************************************************************/
+
+static int is_local_func(func_t * func)
+{
+    int i;
+
+    for (i = 0; local_func_descs[i].name; i++)
+	if (local_func_descs[i].func == func)
+	    return 1;
+    return 0;
+}
+
+/****************************************************************************/
+
+/* constant folding */
+
+static expression *fold(expression * e)
+{
+    union
+    {
+	CELL c;
+	FCELL f;
+	DCELL d;
+    } *vals;
+    void **argv;
+    int argc, i, ok, save;
+    expression *c;
+
+    switch (e->type) {
+    case expr_type_binding:
+	e->data.bind.val = fold(e->data.bind.val);
+	return e;
+    case expr_type_function:
+	break;
+    default:
+	return e;
+    }
+
+    argc = e->data.func.argc;
+    for (i = 1; i <= argc; i++)
+	e->data.func.args[i] = fold(e->data.func.args[i]);
+
+    if (argc < 1 || e->data.func.func == f_rand ||
+	is_local_func(e->data.func.func))
+	return e;
+
+    for (i = 1; i <= argc; i++)
+	if (e->data.func.args[i]->type != expr_type_constant)
+	    return e;
+
+    vals = G_malloc((argc + 1) * sizeof(*vals));
+    argv = G_malloc((argc + 1) * sizeof(void *));
+
+    for (i = 0; i <= argc; i++)
+	argv[i] = &vals[i];
+
+    for (i = 1; i <= argc; i++) {
+	const expression *a = e->data.func.args[i];
+
+	switch (a->res_type) {
+	case CELL_TYPE:
+	    vals[i].c = a->data.con.ival;
+	    break;
+	case FCELL_TYPE:
+	    vals[i].f = a->data.con.fval;
+	    break;
+	case DCELL_TYPE:
+	    vals[i].d = a->data.con.fval;
+	    break;
+	}
+    }
+
+    /* evaluate a single cell */
+    save = columns;
+    columns = 1;
+    ok = (*e->data.func.func) (argc, e->data.func.argt, argv) == 0 &&
+	!Rast_is_null_value(&vals[0], e->res_type);
+    columns = save;
+
+    if (!ok)
+	c = e;			/* leave errors and nulls to the evaluation */
+    else if (e->res_type == CELL_TYPE)
+	c = constant_int(vals[0].c);
+    else if (e->res_type == FCELL_TYPE)
+	c = constant_float(vals[0].f);
+    else
+	c = constant_double(vals[0].d);
+
+    G_free(vals);
+    G_free(argv);
+
+    return c;
+}
+
+/****************************************************************************/
+
+/* dead code elimination */
+
+static expression **referenced;
+static int num_referenced, max_referenced;
+
+static void find_references(const expression * e)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_variable:
+	if (num_referenced >= max_referenced) {
+	    max_referenced += 100;
+	    referenced = G_realloc(referenced,
+				   max_referenced * sizeof(expression *));
+	}
+	referenced[num_referenced++] = e->data.var.bind;
+	break;
+    case expr_type_function:
+	for (i = 1; i <= e->data.func.argc; i++)
+	    find_references(e->data.func.args[i]);
+	break;
+    case expr_type_binding:
+	find_references(e->data.bind.val);
+	break;
+    }
+}
+
+static int is_referenced(const expression * e)
+{
+    int i;
+
+    for (i = 0; i < num_referenced; i++)
+	if (referenced[i] == e)
+	    return 1;
+    return 0;
+}
+
+/* whether evaluating e matters beyond its value */
+static int has_effect(const expression * e)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+	if (e->data.func.func == f_rand)
+	    return 1;
+	for (i = 1; i <= e->data.func.argc; i++)
+	    if (has_effect(e->data.func.args[i]))
+		return 1;
+	return 0;
+    case expr_type_binding:
+	return is_referenced(e) || has_effect(e->data.bind.val);
+    default:
+	return 0;
+    }
+}
+
+static int changed;
+
+static expression *prune(expression * e)
+{
+    int argc, i, j;
+
+    switch (e->type) {
+    case expr_type_binding:
+	e->data.bind.val = prune(e->data.bind.val);
+	if (is_referenced(e))
+	    return e;
+	changed = 1;
+	return e->data.bind.val;
+    case expr_type_function:
+	break;
+    default:
+	return e;
+    }
+
+    argc = e->data.func.argc;
+
+    if (e->data.func.func == f_eval) {
+	for (i = j = 1; i <= argc; i++) {
+	    if (i < argc && !has_effect(e->data.func.args[i])) {
+		changed = 1;
+		continue;
+	    }
+	    e->data.func.args[j] = e->data.func.args[i];
+	    e->data.func.argt[j] = e->data.func.argt[i];
+	    j++;
+	}
+	argc = e->data.func.argc = j - 1;
+    }
+
+    for (i = 1; i <= argc; i++)
+	e->data.func.args[i] = prune(e->data.func.args[i]);
+
+    if (e->data.func.func == f_eval && argc == 1)
+	return e->data.func.args[1];
+
+    return e;
+}
+
+static expr_list *eliminate(expr_list * ee)
+{
+    do {
+	expr_list *l, **prev;
+
+	changed = 0;
+
+	num_referenced = 0;
+	for (l = ee; l; l = l->next)
+	    find_references(l->exp);
+
+	for (prev = &ee; (l = *prev);) {
+	    expression *e = l->exp;
+
+	    if (e->type == expr_type_binding)
+		/* output maps are always used */
+		e->data.bind.val = prune(e->data.bind.val);
+	    else if (!has_effect(e)) {
+		*prev = l->next;
+		changed = 1;
+		continue;
+	    }
+	    else
+		l->exp = prune(e);
+
+	    prev = &l->next;
+	}
+    } while (changed);
+
+    G_free(referenced);
+    referenced = NULL;
+    num_referenced = max_referenced = 0;
+
+    return ee;
+}
+
+/****************************************************************************/
+
+/* common subexpression elimination */
+
+struct node
+{
+    expression *e;
+    unsigned int hash;
+    int refs;			/* number of parents */
+    int first;			/* first top-level expression using it */
+    int visited;
+    expression *def;		/* binding holding its value */
+    struct node *next;		/* with the same hash */
+    struct node *next_ptr;	/* with the same address hash */
+    struct node *next_all;
+};
+
+#define NBUCKETS 4096
+#define PTR_HASH(e) ((unsigned int)((size_t) (e) / sizeof(expression)) % NBUCKETS)
+
+static struct node **buckets, **ptr_buckets;
+static struct node *nodes;
+static int num_temps;
+static expr_list *top;		/* top-level expressions */
+
+static int is_top(const expression * e)
+{
+    expr_list *l;
+
+    for (l = top; l; l = l->next)
+	if (l->exp == e)
+	    return 1;
+    return 0;
+}
+
+static struct node *find_node(const expression * e)
+{
+    struct node *n;
+
+    for (n = ptr_buckets[PTR_HASH(e)]; n; n = n->next_ptr)
+	if (n->e == e)
+	    return n;
+    return NULL;
+}
+
+static unsigned int hash_string(const char *s)
+{
+    unsigned int h = 0;
+
+    while (*s)
+	h = h * 31 + (unsigned char)*s++;
+    return h;
+}
+
+static unsigned int hash_arg(const expression * e)
+{
+    union
+    {
+	double d;
+	unsigned int u[2];
+    } u;
+    struct node *n;
+
+    switch (e->type) {
+    case expr_type_constant:
+	if (e->res_type == CELL_TYPE)
+	    return (unsigned int)e->data.con.ival;
+	u.d = e->data.con.fval;
+	return u.u[0] ^ u.u[1];
+    case expr_type_variable:
+	return (unsigned int)(size_t) e->data.var.bind;
+    default:
+	n = find_node(e);
+	return n ? n->hash : (unsigned int)(size_t) e;
+    }
+}
+
+static unsigned int hash_expr(const expression * e)
+{
+    unsigned int h = e->type * 7 + e->res_type;
+    int i;
+
+    if (e->type == expr_type_map)
+	return h * 31 + hash_string(e->data.map.name) +
+	    e->data.map.mod * 17 + e->data.map.row * 131 +
+	    e->data.map.col * 1031 + e->data.map.depth * 10007;
+
+    h = h * 31 + (unsigned int)(size_t) e->data.func.func;
+    for (i = 1; i <= e->data.func.argc; i++)
+	h = h * 31 + hash_arg(e->data.func.args[i]);
+    return h;
+}
+
+static int same_arg(const expression * a, const expression * b)
+{
+    if (a == b)
+	return 1;
+    if (a->type != b->type || a->res_type != b->res_type)
+	return 0;
+
+    switch (a->type) {
+    case expr_type_constant:
+	return a->res_type == CELL_TYPE
+	    ? a->data.con.ival == b->data.con.ival
+	    : a->data.con.fval == b->data.con.fval;
+    case expr_type_variable:
+	return a->data.var.bind == b->data.var.bind;
+    default:
+	/* shared subexpressions are the same node */
+	return 0;
+    }
+}
+
+static int same_expr(const expression * a, const expression * b)
+{
+    int i;
+
+    if (a->type != b->type || a->res_type != b->res_type)
+	return 0;
+
+    if (a->type == expr_type_map)
+	return strcmp(a->data.map.name, b->data.map.name) == 0 &&
+	    a->data.map.mod == b->data.map.mod &&
+	    a->data.map.row == b->data.map.row &&
+	    a->data.map.col == b->data.map.col &&
+	    a->data.map.depth == b->data.map.depth;
+
+    if (a->data.func.func != b->data.func.func ||
+	a->data.func.argc != b->data.func.argc)
+	return 0;
+    for (i = 1; i <= a->data.func.argc; i++)
+	if (!same_arg(a->data.func.args[i], b->data.func.args[i]))
+	    return 0;
+    return 1;
+}
+
+/* returns the shared node equal to e, registering e if there is none */
+static expression *share(expression * e)
+{
+    unsigned int h = hash_expr(e);
+    struct node *n;
+
+    for (n = buckets[h % NBUCKETS]; n; n = n->next)
+	if (n->hash == h && same_expr(n->e, e))
+	    return n->e;
+
+    n = G_malloc(sizeof(struct node));
+    n->e = e;
+    n->hash = h;
+    n->refs = 0;
+    n->first = -1;
+    n->visited = 0;
+    n->def = NULL;
+    n->next = buckets[h % NBUCKETS];
+    buckets[h % NBUCKETS] = n;
+    n->next_ptr = ptr_buckets[PTR_HASH(e)];
+    ptr_buckets[PTR_HASH(e)] = n;
+    n->next_all = nodes;
+    nodes = n;
+
+    return e;
+}
+
+/*
+ * replaces subexpressions by the first equal one; *pure is set if e can be
+ * shared at all, i.e. it has no bindings, rand() or variables bound inside
+ * an expression
+ */
+static expression *unify(expression * e, int *pure)
+{
+    int i, p;
+
+    switch (e->type) {
+    case expr_type_constant:
+	*pure = 1;
+	return e;
+    case expr_type_variable:
+	*pure = is_top(e->data.var.bind);
+	return e;
+    case expr_type_map:
+	*pure = 1;
+	return share(e);
+    case expr_type_binding:
+	e->data.bind.val = unify(e->data.bind.val, &p);
+	*pure = 0;
+	return e;
+    }
+
+    *pure = e->data.func.func != f_rand;
+    for (i = 1; i <= e->data.func.argc; i++) {
+	e->data.func.args[i] = unify(e->data.func.args[i], &p);
+	if (!p)
+	    *pure = 0;
+    }
+
+    return *pure && e->data.func.argc > 0 ? share(e) : e;
+}
+
+static void count_uses(expression * e, int k);
+
+static void count_use(expression * e, int k)
+{
+    struct node *n = find_node(e);
+
+    if (!n) {
+	count_uses(e, k);
+	return;
+    }
+
+    if (n->refs++ == 0) {
+	n->first = k;
+	count_uses(e, k);
+    }
+}
+
+static void count_uses(expression * e, int k)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+	for (i = 1; i <= e->data.func.argc; i++)
+	    count_use(e->data.func.args[i], k);
+	break;
+    case expr_type_binding:
+	count_use(e->data.bind.val, k);
+	break;
+    }
+}
+
+struct temp
+{
+    expression *e;
+    int before;			/* index of the top-level expression */
+};
+
+static struct temp *temps;
+static int max_temps;
+
+/* creates the bindings for shared nodes, innermost first */
+static void define_shared(expression * e, expr_list ** ee)
+{
+    struct node *n = find_node(e);
+    expr_list *l;
+    char name[32];
+    int i;
+
+    if (n) {
+	if (n->visited)
+	    return;
+	n->visited = 1;
+    }
+
+    switch (e->type) {
+    case expr_type_function:
+	for (i = 1; i <= e->data.func.argc; i++)
+	    define_shared(e->data.func.args[i], ee);
+	break;
+    case expr_type_binding:
+	define_shared(e->data.bind.val, ee);
+	break;
+    }
+
+    if (!n || n->refs < 2)
+	return;
+
+    /* an output binding computing it before any other use can be reused */
+    for (i = 0, l = *ee; i < n->first; i++)
+	l = l->next;
+    if (l->exp->type == expr_type_binding && l->exp->data.bind.val == e) {
+	n->def = l->exp;
+	return;
+    }
+
+    sprintf(name, "$%d", num_temps + 1);
+    n->def = binding(G_store(name), e);
+    n->def->data.bind.temp = 1;
+
+    if (num_temps >= max_temps) {
+	max_temps += 100;
+	temps = G_realloc(temps, max_temps * sizeof(struct temp));
+    }
+    temps[num_temps].e = n->def;
+    temps[num_temps].before = n->first;
+    num_temps++;
+}
+
+static expression *use_shared(expression * e, const expression * parent);
+
+static void replace_shared(expression * e)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+	for (i = 1; i <= e->data.func.argc; i++)
+	    e->data.func.args[i] = use_shared(e->data.func.args[i], e);
+	break;
+    case expr_type_binding:
+	e->data.bind.val = use_shared(e->data.bind.val, e);
+	break;
+    }
+}
+
+static expression *use_shared(expression * e, const expression * parent)
+{
+    struct node *n = find_node(e);
+
+    if (n && n->def && n->def != parent)
+	return bound_variable(n->def);
+
+    replace_shared(e);
+    return e;
+}
+
+static expr_list *share_common(expr_list * ee)
+{
+    expr_list *head = NULL, **tail = &head;
+    expr_list *l;
+    int i, k, p;
+
+    buckets = G_calloc(NBUCKETS, sizeof(struct node *));
+    ptr_buckets = G_calloc(NBUCKETS, sizeof(struct node *));
+    top = ee;
+
+    for (l = ee; l; l = l->next) {
+	expression *e = l->exp;
+
+	/* outputs copying a map keep its categories, colors and history */
+	if (e->type == expr_type_binding &&
+	    e->data.bind.val->type == expr_type_map)
+	    continue;
+	l->exp = unify(e, &p);
+    }
+
+    for (l = ee, k = 0; l; l = l->next, k++)
+	count_uses(l->exp, k);
+
+    for (l = ee; l; l = l->next)
+	define_shared(l->exp, &ee);
+
+    for (i = 0; i < num_temps; i++)
+	replace_shared(temps[i].e);
+    for (l = ee; l; l = l->next)
+	replace_shared(l->exp);
+
+    G_debug(1, "%d common subexpressions", num_temps);
+
+    for (l = ee, k = 0, i = 0; l; l = l->next, k++) {
+	for (; i < num_temps && temps[i].before == k; i++) {
+	    *tail = list(temps[i].e, NULL);
+	    tail = &(*tail)->next;
+	}
+	*tail = list(l->exp, NULL);
+	tail = &(*tail)->next;
+    }
+
+    while (nodes) {
+	struct node *n = nodes;
+
+	nodes = n->next_all;
+	G_free(n);
+    }
+    G_free(buckets);
+    G_free(ptr_buckets);
+    G_free(temps);
+    buckets = ptr_buckets = NULL;
+    temps = NULL;
+    num_temps = max_temps = 0;
+
+    return head;
+}
+
+/****************************************************************************/
+
+expr_list *optimize(expr_list * ee)
+{
+    expr_list *l;
+
+    /* the history records the expressions as written */
+    for (l = ee; l; l = l->next)
+	if (l->exp->type == expr_type_binding)
+	    l->exp->data.bind.text = format_expression(l->exp->data.bind.val);
+
+    for (l = ee; l; l = l->next)
+	l->exp = fold(l->exp);
+
+    ee = eliminate(ee);
+
+    return share_common(ee);
+}
+
+/****************************************************************************/
@@ -60,6 +60,13 @@ cols: 10
 """
 
 
+def diff_expression(diff, a, b):
+    """Expression of a map which is 0 where maps a and b are equal,
+    also where both are null, and not 0 or null elsewhere"""
+    return ('{diff} = if(isnull({a}) != isnull({b}), 1, '
+            'if(isnull({a}), 0, {a} - {b}))'.format(diff=diff, a=a, b=b))
+
+
 class TestRandFunction(TestCase):
 
     # TODO: replace by unified handing of maps
@@ -227,6 +234,105 @@ class TestBasicOperations(TestCase):
         self.to_remove.append('nrows_ncols_sum')
         self.assertRasterMinMax('nrows_ncols_sum', refmin=20, refmax=20)
 
+    def test_nprocs_same_result(self):
+        """Test that evaluation in blocks of rows gives the same result"""
+        self.runModule('r.mapcalc', flags='s', seed=1,
+                       expression='np = rand(1.0, 200)')
+        self.to_remove.append('np')
+        expression = 'np_{n} = np[-1,0] + np[1,1] - row() * col() + area()'
+        self.assertModule('r.mapcalc', nprocs=1,
+                          expression=expression.format(n=1))
+        self.to_remove.append('np_1')
+        self.assertModule('r.mapcalc', nprocs=4,
+                          expression=expression.format(n=4))
+        self.to_remove.append('np_4')
+        self.assertModule('r.mapcalc',
+                          expression=diff_expression('diff_np', 'np_1', 'np_4'))
+        self.to_remove.append('diff_np')
+        self.assertRasterMinMax('diff_np', refmin=0, refmax=0)
+
+    def test_nprocs_nested_binding(self):
+        """Test that nested bindings are evaluated per block of rows"""
+        self.runModule('r.mapcalc', flags='s', seed=1,
+                       expression='nb = if(row() == 3, null(), rand(1.0, 200))')
+        self.to_remove.append('nb')
+        expression = 'nb_{n} = (t = nb * 2) + t'
+        self.assertModule('r.mapcalc', nprocs=1,
+                          expression=expression.format(n=1))
+        self.to_remove.append('nb_1')
+        self.assertModule('r.mapcalc', nprocs=4,
+                          expression=expression.format(n=4))
+        self.to_remove.append('nb_4')
+        self.assertModule('r.mapcalc',
+                          expression=diff_expression('diff_nb', 'nb_1', 'nb_4'))
+        self.to_remove.append('diff_nb')
+        self.assertRasterMinMax('diff_nb', refmin=0, refmax=0)
+
+    def test_fused_same_result(self):
+        """Test that a fused expression gives the same result as its steps"""
+        self.runModule('r.mapcalc', flags='s', seed=1,
+                       expression='fu = if(row() == 3, null(), rand(1.0, 200))')
+        self.to_remove.append('fu')
+        steps = ['fu_sub = fu - 50', 'fu_add = fu + 50', 'fu_div = fu_sub / fu_add',
+                 'fu_mul = fu_div * 2', 'fu_neg = -fu_div', 'fu_gt = fu > 100',
+                 'fu_ref = if(fu_gt, fu_mul, fu_neg)']
+        for step in steps:
+            self.assertModule('r.mapcalc', expression=step)
+            self.to_remove.append(step.split(' ')[0])
+        self.assertModule('r.mapcalc',
+            expression='fu_fused = if(fu > 100, (fu - 50) / (fu + 50) * 2, '
+                       '-((fu - 50) / (fu + 50)))')
+        self.to_remove.append('fu_fused')
+        self.assertModule('r.mapcalc', expression=diff_expression(
+            'diff_fu', 'fu_ref', 'fu_fused'))
+        self.to_remove.append('diff_fu')
+        self.assertRasterMinMax('diff_fu', refmin=0, refmax=0)
+
+    def test_shared_subexpressions(self):
+        """Test that repeated subexpressions of a script give the same result"""
+        self.runModule('r.mapcalc', flags='s', seed=1,
+                       expression='cs = if(row() == 3, null(), rand(1.0, 200))')
+        self.to_remove.append('cs')
+        self.assertModule('r.mapcalc',
+            expression='cs_ref = (cs - 50) / (cs + 50) * (2 * 3)')
+        self.to_remove.append('cs_ref')
+        self.assertModule('r.mapcalc', expression='cs_a = (cs - 50) / (cs + 50)\n'
+                          'cs_b = eval(t = cs + 1, (cs - 50) / (cs + 50) * 6)\n'
+                          'cs_c = cs_a + (cs - 50) / (cs + 50)')
+        self.to_remove.extend(['cs_a', 'cs_b', 'cs_c'])
+        self.assertModule('r.mapcalc', expression=diff_expression(
+            'diff_cs', 'cs_ref', 'cs_b'))
+        self.to_remove.append('diff_cs')
+        self.assertRasterMinMax('diff_cs', refmin=0, refmax=0)
+        self.assertModule('r.mapcalc', expression=diff_expression(
+            'diff_cs_c', 'cs_c', '(2 * cs_a)'))
+        self.to_remove.append('diff_cs_c')
+        self.assertRasterMinMax('diff_cs_c', refmin=0, refmax=0)
+
+    def test_if_unused_branches(self):
+        """Test if() with branches which some rows do not use"""
+        self.assertModule('r.mapcalc',
+            expression='lz = if(row() <= 2, sqrt(row() * 100.0), '
+                       'if(col() - 1, -1, log(col())))')
+        self.to_remove.append('lz')
+        self.assertRasterFitsUnivar('lz', reference=dict(
+            n=100, min=-1, max=14.142136, mean=1.694214), precision=1e-6)
+
+    def test_batch(self):
+        """Test batch mode with independent and dependent jobs"""
+        self.assertModule('r.mapcalc', flags='b', file='-', stdin_=(
+            'bt_a = row()\n'
+            '\n'
+            'bt_x = col()\n'
+            'bt_b = bt_x * 10\n'
+            'end\n'
+            'bt_c = bt_a + bt_b\n'))
+        self.to_remove.extend(['bt_a', 'bt_x', 'bt_b', 'bt_c'])
+        self.assertRasterFitsUnivar('bt_c', reference=dict(
+            n=100, min=11, max=110, mean=60.5), precision=1e-6)
+        self.assertModuleFail('r.mapcalc', flags='b', file='-',
+                              stdin_='bt_a = 1\n')
+
 
 class TestRegionOperations(TestCase):
 
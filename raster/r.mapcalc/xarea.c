@@ -13,8 +13,8 @@ int f_area(int argc, const int *argt, void **args)
 {
     DCELL *res = args[0];
     int i;
-    static int row = -1;
-    static double cell_area = 0;
+    static THREAD_LOCAL int row = -1;
+    static THREAD_LOCAL double cell_area = 0;
 
     if (argc > 0)
 	return E_ARG_HI;
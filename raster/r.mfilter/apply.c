@@ -1,3 +1,4 @@
+#include <math.h>
 #include <grass/raster.h>
 #include "filter.h"
 
@@ -49,3 +50,56 @@ DCELL apply_filter(FILTER * filter, DCELL ** input)
 
     return v;
 }
+
+/**************************************************************
+ * separable_filter: check if the filter matrix is the outer
+ *   product of a column and a row vector, and store them
+ *
+ *  filter:    filter to be checked
+ *
+ *  returns 1 if the matrix is separable, 0 otherwise
+ **************************************************************/
+int separable_filter(FILTER * filter)
+{
+    int size = filter->size;
+    double **matrix = filter->matrix;
+    double max = 0;
+    double *u, *v;
+    int r, c, r0 = 0, c0 = 0;
+
+    filter->u = filter->v = NULL;
+
+    /* a separate divisor matrix would need to be separable too */
+    if (filter->divisor == 0 && filter->dmatrix != matrix)
+	return 0;
+
+    for (r = 0; r < size; r++)
+	for (c = 0; c < size; c++)
+	    if (fabs(matrix[r][c]) > max) {
+		max = fabs(matrix[r][c]);
+		r0 = r;
+		c0 = c;
+	    }
+    if (max == 0)
+	return 0;
+
+    u = (double *)G_malloc(size * sizeof(double));
+    v = (double *)G_malloc(size * sizeof(double));
+    for (r = 0; r < size; r++)
+	u[r] = matrix[r][c0];
+    for (c = 0; c < size; c++)
+	v[c] = matrix[r0][c] / matrix[r0][c0];
+
+    for (r = 0; r < size; r++)
+	for (c = 0; c < size; c++)
+	    if (fabs(u[r] * v[c] - matrix[r][c]) > 1e-12 * max) {
+		G_free(u);
+		G_free(v);
+		return 0;
+	    }
+
+    filter->u = u;
+    filter->v = v;
+
+    return 1;
+}
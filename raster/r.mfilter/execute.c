@@ -4,7 +4,50 @@
 #include "glob.h"
 #include "filter.h"
 
-int execute_filter(ROWIO * r, int out, FILTER * filter, DCELL * cell)
+/* Parallel filters are applied to bands of rows, the output rows of a
+ * band are shared among nprocs threads. The ROWIO buffers hold all the
+ * input rows needed by a band.
+ *
+ * A separable matrix (the outer product of a column vector u and a row
+ * vector v) is applied as sums of v along each input row followed by
+ * sums of u down the columns, 2 * size products per cell instead of
+ * size * size. Large matrices which are not separable are applied in
+ * the frequency domain if FFTW is available. In both cases the nulls
+ * of the windows are counted separately and enter the sums as 0, the
+ * results are those of the direct sums up to rounding.
+ *
+ * Sequential filters use the already filtered values of the previous
+ * cells, so they are applied cell by cell.
+ */
+
+#define BAND_ROWS 16
+#define SEPARABLE_SIZE 5	/* smallest separable matrix summed in two passes */
+#define FOURIER_SIZE 15		/* smallest matrix applied in frequency domain */
+
+#define DIRECT 0
+#define SEPARABLE 1
+#define FOURIER 2
+
+struct band
+{
+    FILTER *filter;
+    int method;
+    DCELL **in;			/* input rows, rows + size - 1 */
+    DCELL **out;		/* output rows */
+    DCELL **box;		/* window of each thread */
+    char *nulls;		/* input row has nulls */
+    int **hnull;		/* nulls in each row of the windows */
+    double **hsum;		/* sums of v along each row of the windows */
+    double **hmsum;		/* same over the non-null cells */
+    double msum;		/* sum of the divisor matrix */
+    double vsum;		/* sum of v */
+    double *fsum, *fmsum;	/* window sums from the frequency domain */
+    int fstride;
+    int chunk;
+};
+
+static int execute_sequential(ROWIO * r, int out, FILTER * filter,
+			      DCELL * cell)
 {
     int i;
     int count;
@@ -119,3 +162,307 @@ int execute_filter(ROWIO * r, int out, FILTER * filter, DCELL * cell)
 
     return 0;
 }
+
+static int filter_method(FILTER * filter)
+{
+    if (filter->u && filter->size >= SEPARABLE_SIZE)
+	return SEPARABLE;
+#ifdef HAVE_FFTW3_H
+    if (filter->size >= FOURIER_SIZE &&
+	(filter->divisor != 0 || filter->dmatrix == filter->matrix))
+	return FOURIER;
+#endif
+    return DIRECT;
+}
+
+static int band_rows(FILTER * filter)
+{
+    int rows = nprocs * BAND_ROWS;
+
+    /* the transform of a band should not be mostly edges */
+    if (filter_method(filter) == FOURIER && rows < 4 * filter->size)
+	rows = 4 * filter->size;
+
+    return rows;
+}
+
+/* number of rows the ROWIO has to hold */
+int filter_buffer_rows(FILTER * filter)
+{
+    if (filter->type == SEQUENTIAL)
+	return filter->size;
+
+    return band_rows(filter) + filter->size - 1;
+}
+
+static void horizontal_rows(int first, int last, void *closure)
+{
+    struct band *b = closure;
+    FILTER *filter = b->filter;
+    int size = filter->size;
+    int ccount = ncols - (size - 1);
+    int row, col, k, n;
+
+    for (row = first; row < last; row++) {
+	const DCELL *x = b->in[row];
+	int *hn = b->hnull[row];
+
+	n = 0;
+	for (k = 0; k < size - 1; k++)
+	    n += Rast_is_d_null_value(&x[k]);
+	b->nulls[row] = 0;
+	for (col = 0; col < ccount; col++) {
+	    n += Rast_is_d_null_value(&x[col + size - 1]);
+	    hn[col] = n;
+	    if (n)
+		b->nulls[row] = 1;
+	    n -= Rast_is_d_null_value(&x[col]);
+	}
+
+	if (b->method != SEPARABLE)
+	    continue;
+
+	for (col = 0; col < ccount; col++) {
+	    const DCELL *xc = x + col;
+	    double sum = 0, msum = 0;
+
+	    if (!hn[col]) {
+		for (k = 0; k < size; k++)
+		    sum += filter->v[k] * xc[k];
+		msum = b->vsum;
+	    }
+	    else {
+		for (k = 0; k < size; k++) {
+		    if (Rast_is_d_null_value(&xc[k]))
+			continue;
+		    sum += filter->v[k] * xc[k];
+		    msum += filter->v[k];
+		}
+	    }
+	    b->hsum[row][col] = sum;
+	    if (b->hmsum)
+		b->hmsum[row][col] = msum;
+	}
+    }
+}
+
+static void filter_rows(int first, int last, void *closure)
+{
+    struct band *b = closure;
+    FILTER *filter = b->filter;
+    int size = filter->size;
+    int mid = size / 2;
+    int ccount = ncols - (size - 1);
+    DCELL **box = b->box + (first / b->chunk) * size;
+    int row, col, k;
+
+    for (row = first; row < last; row++) {
+	const DCELL *center = b->in[row + mid];
+	DCELL *out = b->out[row];
+	int nulls = 0;
+
+	/* copy border */
+	for (col = 0; col < mid; col++)
+	    out[col] = center[col];
+	for (col = ncols - mid; col < ncols; col++)
+	    out[col] = center[col];
+
+	if (b->method != DIRECT)
+	    for (k = 0; k < size; k++)
+		if (b->nulls[row + k])
+		    nulls = 1;
+
+	for (col = 0; col < ccount; col++) {
+	    DCELL *cp = &out[col + mid];
+	    double sum, msum;
+	    int n = 0;
+
+	    if (null_only && !Rast_is_d_null_value(&center[col + mid])) {
+		*cp = center[col + mid];
+		continue;
+	    }
+
+	    if (b->method == DIRECT) {
+		for (k = 0; k < size; k++)
+		    box[k] = b->in[row + k] + col;
+		*cp = apply_filter(filter, box);
+		continue;
+	    }
+
+	    if (nulls)
+		for (k = 0; k < size; k++)
+		    n += b->hnull[row + k][col];
+	    if (n == size * size || (n && filter->divisor != 0)) {
+		Rast_set_d_null_value(cp, 1);
+		continue;
+	    }
+
+	    if (b->method == SEPARABLE) {
+		sum = 0;
+		for (k = 0; k < size; k++)
+		    sum += filter->u[k] * b->hsum[row + k][col];
+	    }
+	    else
+		sum = b->fsum[(size_t)row * b->fstride + col];
+
+	    if (filter->divisor != 0)
+		*cp = sum / filter->divisor;
+	    else {
+		if (!n)
+		    msum = b->msum;
+		else if (b->method == SEPARABLE) {
+		    msum = 0;
+		    for (k = 0; k < size; k++)
+			msum += filter->u[k] * b->hmsum[row + k][col];
+		}
+		else
+		    msum = b->fmsum[(size_t)row * b->fstride + col];
+		*cp = sum / msum;
+	    }
+	}
+    }
+}
+
+static double **alloc_rows(int rows, int cols, size_t elsize)
+{
+    double **p = G_malloc(rows * sizeof(double *));
+    int i;
+
+    for (i = 0; i < rows; i++)
+	p[i] = G_malloc(cols * elsize);
+
+    return p;
+}
+
+static void free_rows(void *rows, int n)
+{
+    void **p = rows;
+    int i;
+
+    if (!p)
+	return;
+    for (i = 0; i < n; i++)
+	G_free(p[i]);
+    G_free(p);
+}
+
+int execute_filter(ROWIO * r, int out, FILTER * filter, DCELL * cell)
+{
+    struct band b;
+    int size, mid, nband, nin;
+    int row, rcount, n, i, c;
+    DCELL *cp;
+#ifdef HAVE_FFTW3_H
+    struct fourier *fourier = NULL;
+#endif
+
+    if (filter->type == SEQUENTIAL)
+	return execute_sequential(r, out, filter, cell);
+
+    size = filter->size;
+    mid = size / 2;
+    nband = band_rows(filter);
+    nin = nband + size - 1;
+
+    b.filter = filter;
+    b.method = filter_method(filter);
+    b.in = G_malloc(nin * sizeof(DCELL *));
+    b.out = (DCELL **) alloc_rows(nband, ncols, sizeof(DCELL));
+    b.chunk = (nband + nprocs - 1) / nprocs;
+    b.box = G_malloc(nprocs * size * sizeof(DCELL *));
+    b.nulls = G_malloc(nin);
+    b.hnull = NULL;
+    b.hsum = b.hmsum = NULL;
+    if (b.method != DIRECT)
+	b.hnull = (int **)alloc_rows(nin, ncols, sizeof(int));
+    if (b.method == SEPARABLE) {
+	b.hsum = alloc_rows(nin, ncols, sizeof(double));
+	if (filter->divisor == 0)
+	    b.hmsum = alloc_rows(nin, ncols, sizeof(double));
+    }
+
+    /* the divisor of windows without nulls, summed like apply_filter() */
+    b.msum = 0;
+    if (filter->divisor == 0) {
+	for (i = 0; i < size; i++)
+	    for (c = 0; c < size; c++)
+		b.msum += filter->dmatrix[i][c];
+    }
+    b.vsum = 0;
+    if (b.method == SEPARABLE)
+	for (c = 0; c < size; c++)
+	    b.vsum += filter->v[c];
+
+#ifdef HAVE_FFTW3_H
+    if (b.method == FOURIER)
+	fourier = fourier_init(filter, nin, ncols);
+#endif
+
+    G_debug(3, "filter method %d, %d rows per band", b.method, nband);
+
+    direction = 1;
+    rcount = nrows - (size - 1);
+
+    /* rewind output */
+    lseek(out, 0L, 0);
+
+    /* copy border rows to output */
+    for (row = 0; row < mid; row++) {
+	cp = (DCELL *) Rowio_get(r, row);
+	write(out, cp, buflen);
+    }
+
+    for (row = 0; row < rcount; row += nband) {
+	G_percent(row, rcount, 2);
+	n = rcount - row < nband ? rcount - row : nband;
+
+	/* get the input rows of the band */
+	for (i = 0; i < n + size - 1; i++)
+	    b.in[i] = (DCELL *) Rowio_get(r, row + i);
+
+	if (b.method != DIRECT)
+	    G_parallel_for(0, n + size - 1,
+			   (n + size - 1 + nprocs - 1) / nprocs,
+			   horizontal_rows, &b);
+
+#ifdef HAVE_FFTW3_H
+	if (b.method == FOURIER) {
+	    int with_mask = 0;
+
+	    if (filter->divisor == 0)
+		for (i = 0; i < n + size - 1; i++)
+		    if (b.nulls[i])
+			with_mask = 1;
+	    fourier_filter(fourier, b.in, n + size - 1, with_mask,
+			   &b.fsum, &b.fmsum, &b.fstride);
+	}
+#endif
+
+	G_parallel_for(0, n, b.chunk, filter_rows, &b);
+
+	/* write rows */
+	for (i = 0; i < n; i++)
+	    write(out, b.out[i], buflen);
+    }
+    G_percent(rcount, rcount, 2);
+
+    /* copy border rows to output */
+    for (row = nrows - mid; row < nrows; row++) {
+	cp = (DCELL *) Rowio_get(r, row);
+	write(out, cp, buflen);
+    }
+
+#ifdef HAVE_FFTW3_H
+    if (fourier)
+	fourier_free(fourier);
+#endif
+    G_free(b.in);
+    free_rows(b.out, nband);
+    G_free(b.box);
+    G_free(b.nulls);
+    free_rows(b.hnull, nin);
+    free_rows(b.hsum, nin);
+    free_rows(b.hmsum, nin);
+
+    return 0;
+}
@@ -9,6 +9,8 @@ typedef struct
     double divisor;		/* filter scale factor */
     int type;			/* sequential or parallel */
     int start;			/* starting corner */
+    double *u, *v;		/* column and row factors of a separable
+				   matrix, NULL if not separable */
 } FILTER;
 
 #define PARALLEL 1
@@ -20,6 +22,7 @@ typedef struct
 
 /* apply.c */
 DCELL apply_filter(FILTER *, DCELL **);
+int separable_filter(FILTER *);
 
 /* getfilt.c */
 FILTER *get_filter(char *, int *, char *);
@@ -28,4 +31,12 @@ FILTER *get_filter(char *, int *, char *);
 int perform_filter(const char *, const char *, FILTER *, int, int);
 
 /* execute.c */
+int filter_buffer_rows(FILTER *);
 int execute_filter(ROWIO *, int, FILTER *, DCELL *);
+
+/* fourier.c */
+struct fourier;
+struct fourier *fourier_init(FILTER *, int, int);
+void fourier_filter(struct fourier *, DCELL **, int, int, double **,
+		    double **, int *);
+void fourier_free(struct fourier *);
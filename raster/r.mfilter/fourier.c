@@ -0,0 +1,175 @@
+#include <math.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/gmath.h>
+#include "glob.h"
+#include "filter.h"
+
+#ifdef HAVE_FFTW3_H
+
+/* The rows of a band are filtered at once as a circular convolution
+ * with the mirrored filter matrix. The transforms are at least as large
+ * as the band, so the values of the windows inside the band are not
+ * affected by the wrap around, only the (unused) ones at the edges.
+ */
+
+struct fourier
+{
+    int size;
+    int dimr, dimc;		/* size of the transforms */
+    int stride;			/* doubles per row of the real data */
+    double (*kernel)[2];	/* transformed filter matrix */
+    double (*data)[2];		/* band with nulls set to 0 */
+    double (*mask)[2];		/* 1 for non-null cells of the band */
+};
+
+/* transforms of sizes with small prime factors are the fastest */
+static int transform_size(int n)
+{
+    for (;; n++) {
+	int m = n;
+
+	while (m % 2 == 0)
+	    m /= 2;
+	while (m % 3 == 0)
+	    m /= 3;
+	while (m % 5 == 0)
+	    m /= 5;
+	while (m % 7 == 0)
+	    m /= 7;
+	if (m == 1)
+	    return n;
+    }
+}
+
+static void multiply(struct fourier *f, double (*data)[2])
+{
+    size_t i, n = (size_t)f->dimr * (f->dimc / 2 + 1);
+
+    for (i = 0; i < n; i++) {
+	double *k = f->kernel[i];
+	double re = data[i][0] * k[0] - data[i][1] * k[1];
+	double im = data[i][0] * k[1] + data[i][1] * k[0];
+
+	data[i][0] = re;
+	data[i][1] = im;
+    }
+}
+
+/**************************************************************
+ * fourier_init: prepare the filtering of bands in the frequency
+ *   domain
+ *
+ *  filter:    filter to be applied
+ *  rows:      number of input rows of a band
+ *  cols:      number of columns
+ **************************************************************/
+struct fourier *fourier_init(FILTER * filter, int rows, int cols)
+{
+    struct fourier *f = G_malloc(sizeof(struct fourier));
+    int size = filter->size;
+    size_t i, n;
+    double norm, *k;
+    int r, c;
+
+    G_math_fft_threads(nprocs);
+
+    f->size = size;
+    f->dimr = transform_size(rows);
+    f->dimc = transform_size(cols);
+    f->stride = 2 * (f->dimc / 2 + 1);
+    n = (size_t)f->dimr * (f->dimc / 2 + 1);
+
+    f->kernel = G_calloc(n, sizeof(*f->kernel));
+    f->data = G_malloc(n * sizeof(*f->data));
+    f->mask = NULL;
+
+    k = (double *)f->kernel;
+    for (r = 0; r < size; r++)
+	for (c = 0; c < size; c++)
+	    k[(size_t)(size - 1 - r) * f->stride + size - 1 - c] =
+		filter->matrix[r][c];
+
+    G_math_fft2_r2c(f->kernel, f->dimc, f->dimr);
+
+    /* undo the normalization of one forward and the inverse transform */
+    norm = sqrt((double)f->dimc * f->dimr);
+    for (i = 0; i < n; i++) {
+	f->kernel[i][0] *= norm;
+	f->kernel[i][1] *= norm;
+    }
+
+    return f;
+}
+
+/**************************************************************
+ * fourier_filter: filter a band
+ *
+ *  f:         prepared filter
+ *  in:        input rows of the band
+ *  rows:      number of input rows
+ *  with_mask: also sum the matrix over the non-null cells
+ *  sum:       set to the sum of the window starting at row 0 and
+ *             column 0 of the band, the sum of the window at row r
+ *             and column c is sum[r * stride + c]
+ *  msum:      likewise for the matrix over the non-null cells
+ *  stride:    set to the row stride of sum and msum
+ **************************************************************/
+void fourier_filter(struct fourier *f, DCELL ** in, int rows, int with_mask,
+		    double **sum, double **msum, int *stride)
+{
+    size_t offset = (size_t)(f->size - 1) * f->stride + f->size - 1;
+    double *data = (double *)f->data;
+    double *mask;
+    int r, c;
+
+    if (with_mask && !f->mask)
+	f->mask = G_malloc((size_t)f->dimr * (f->dimc / 2 + 1) *
+			   sizeof(*f->mask));
+    mask = with_mask ? (double *)f->mask : NULL;
+
+    for (r = 0; r < f->dimr; r++) {
+	double *d = data + (size_t)r * f->stride;
+	double *m = mask ? mask + (size_t)r * f->stride : NULL;
+
+	for (c = 0; c < f->dimc; c++) {
+	    if (r >= rows || c >= ncols || Rast_is_d_null_value(&in[r][c])) {
+		d[c] = 0;
+		if (m)
+		    m[c] = 0;
+	    }
+	    else {
+		d[c] = in[r][c];
+		if (m)
+		    m[c] = 1;
+	    }
+	}
+    }
+
+    G_math_fft2_r2c(f->data, f->dimc, f->dimr);
+    multiply(f, f->data);
+    G_math_fft2_c2r(f->data, f->dimc, f->dimr);
+    *sum = data + offset;
+
+    if (mask) {
+	G_math_fft2_r2c(f->mask, f->dimc, f->dimr);
+	multiply(f, f->mask);
+	G_math_fft2_c2r(f->mask, f->dimc, f->dimr);
+	*msum = mask + offset;
+    }
+    else
+	*msum = NULL;
+
+    *stride = f->stride;
+}
+
+void fourier_free(struct fourier *f)
+{
+    G_free(f->kernel);
+    G_free(f->data);
+    if (f->mask)
+	G_free(f->mask);
+    G_free(f);
+}
+
+#endif /* HAVE_FFTW3_H */
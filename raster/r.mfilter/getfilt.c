@@ -58,6 +58,7 @@ FILTER *get_filter(char *name, int *nfilters, char *title)
 	    f->dmatrix = NULL;
 	    f->type = PARALLEL;
 	    f->start = UL;
+	    f->u = f->v = NULL;
 	    have_divisor = 0;
 	    have_type = 0;
 	    have_start = 0;
@@ -157,6 +158,11 @@ FILTER *get_filter(char *name, int *nfilters, char *title)
 	G_fatal_error(_("Illegal filter file format"));
     }
 
+    for (n = 0; n < count; n++) {
+	if (separable_filter(&filter[n]))
+	    G_verbose_message(_("Filter %d is separable"), n + 1);
+    }
+
     *nfilters = count;
     return filter;
 }
@@ -4,3 +4,4 @@ extern int buflen;
 extern int direction;
 extern int null_only;
 extern int preserve_edges;
+extern int nprocs;
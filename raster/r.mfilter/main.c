@@ -30,6 +30,7 @@ int buflen;
 int direction;
 int null_only;
 int preserve_edges;
+int nprocs;
 
 int main(int argc, char **argv)
 {
@@ -49,6 +50,7 @@ int main(int argc, char **argv)
     struct Option *opt3;
     struct Option *opt4;
     struct Option *opt5;
+    struct Option *opt6;
 
     G_gisinit(argv[0]);
 
@@ -85,6 +87,8 @@ int main(int argc, char **argv)
     opt5->required = NO;
     opt5->description = _("Output raster map title");
 
+    opt6 = G_define_standard_option(G_OPT_M_NPROCS);
+
     /* Define the different flags */
 
     /* this isn't implemented at all 
@@ -105,6 +109,7 @@ int main(int argc, char **argv)
        preserve_edges = flag3->answer;
      */
     null_only = flag2->answer;
+    nprocs = G_set_nprocs(opt6);
 
     sscanf(opt4->answer, "%d", &repeat);
     out_name = opt2->answer;
@@ -60,7 +60,7 @@ int perform_filter(const char *in_name, const char *out_name,
 		out = fd;
 	    }
 
-	    Rowio_setup(&r, in, filter[n].size, buflen,
+	    Rowio_setup(&r, in, filter_buffer_rows(&filter[n]), buflen,
 			count ? getrow : getmaprow, NULL);
 
 	    execute_filter(&r, out, &filter[n], cell);
@@ -0,0 +1,402 @@
+#include <string.h>
+#include <math.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/stats.h>
+#include "ncb.h"
+#include "box.h"
+
+/*
+   statistics of square neighborhoods without weights
+
+   for a row, the values of the ncb.nsize rows of the window are first
+   reduced to one count, sum, minimum and maximum per column; these
+   loops run along the rows and are vectorized by the compiler. The
+   results of the ncb.nsize columns of each neighborhood are then
+   combined with the van Herk/Gil-Werman algorithm: the columns are
+   split into blocks of ncb.nsize columns, each neighborhood covers the
+   end of one block and the start of the next one, so that its result
+   is combined from one suffix and one prefix of the blocks. This takes
+   three operations per cell for any size of the neighborhood, and, as
+   no values are subtracted from running sums, sums are as exact as
+   summing the values of each neighborhood.
+
+   the variance is computed from the sums of the deviations from the
+   average of the center row, which keeps the sum of squares small.
+
+   medians, modes and quantiles are taken from the order statistics of
+   lib/stats: the values of the window rows are ranked once per row,
+   when the neighborhood moves to the next column, the values of the
+   column it leaves are removed and those of the new column are added.
+ */
+
+static enum box_method box_method(stat_func *method, double *quantile)
+{
+    if (method == c_median)
+	return BOX_MEDIAN;
+    if (method == c_mode)
+	return BOX_MODE;
+    if (method == c_quart1) {
+	*quantile = 0.25;
+	return BOX_QUANT;
+    }
+    if (method == c_quart3) {
+	*quantile = 0.75;
+	return BOX_QUANT;
+    }
+    if (method == c_perc90) {
+	*quantile = 0.90;
+	return BOX_QUANT;
+    }
+    if (method == c_quant)
+	return BOX_QUANT;
+    if (method == c_ave)
+	return BOX_AVE;
+    if (method == c_sum)
+	return BOX_SUM;
+    if (method == c_count)
+	return BOX_COUNT;
+    if (method == c_var)
+	return BOX_VAR;
+    if (method == c_stddev)
+	return BOX_STDDEV;
+    if (method == c_min)
+	return BOX_MIN;
+    if (method == c_max)
+	return BOX_MAX;
+    if (method == c_range)
+	return BOX_RANGE;
+
+    return BOX_NONE;
+}
+
+/*!
+   \brief Add a method to the box filters
+
+   \param b box filters
+   \param fn stat function
+   \param quantile quantile for c_quant()
+
+   \return index of the result for box_result()
+   \return -1 if the method has no box filter
+ */
+int box_add(struct box *b, stat_func *fn, double quantile)
+{
+    enum box_method method = box_method(fn, &quantile);
+    struct box_request *req;
+
+    if (method == BOX_NONE)
+	return -1;
+
+    b->req = G_realloc(b->req, (b->nreq + 1) * sizeof(struct box_request));
+    req = &b->req[b->nreq];
+    req->method = method;
+    req->quantile = quantile;
+    req->result = NULL;
+
+    switch (method) {
+    case BOX_AVE:
+    case BOX_SUM:
+	b->need_sum = 1;
+	break;
+    case BOX_VAR:
+    case BOX_STDDEV:
+	b->need_var = 1;
+	break;
+    case BOX_MIN:
+    case BOX_MAX:
+    case BOX_RANGE:
+	b->need_minmax = 1;
+	break;
+    case BOX_MODE:
+	b->need_mode = 1;
+	/* fall through */
+    case BOX_MEDIAN:
+    case BOX_QUANT:
+	b->need_order = 1;
+	break;
+    default:
+	break;
+    }
+
+    return b->nreq++;
+}
+
+static DCELL *alloc(int need, int len)
+{
+    return need ? G_malloc(len * sizeof(DCELL)) : NULL;
+}
+
+/* allocate the buffers of a copy of the box filters for a thread */
+void box_allocate(struct box *b, int ncols)
+{
+    const struct box_request *req = b->req;
+    int i;
+
+    b->req = G_malloc(b->nreq * sizeof(struct box_request));
+    for (i = 0; i < b->nreq; i++) {
+	b->req[i] = req[i];
+	b->req[i].result = b->req[i].method >= BOX_MEDIAN
+	    ? G_malloc(ncols * sizeof(DCELL)) : NULL;
+    }
+
+    b->ncols = ncols;
+    b->len = ncols + 2 * ncb.dist;
+    b->shift = 0;
+
+    b->col_cnt = alloc(1, b->len);
+    b->col_sum = alloc(b->need_sum, b->len);
+    b->col_dsum = alloc(b->need_var, b->len);
+    b->col_dsq = alloc(b->need_var, b->len);
+    b->col_min = alloc(b->need_minmax, b->len);
+    b->col_max = alloc(b->need_minmax, b->len);
+
+    b->cnt = alloc(1, ncols);
+    b->sum = alloc(b->need_sum, ncols);
+    b->dsum = alloc(b->need_var, ncols);
+    b->dsq = alloc(b->need_var, ncols);
+    b->min = alloc(b->need_minmax, ncols);
+    b->max = alloc(b->need_minmax, ncols);
+
+    b->pre = alloc(1, b->len);
+    b->suf = alloc(1, b->len);
+
+    b->order = b->need_order
+	? stat_order_create(ncb.nsize * b->len, b->need_mode) : NULL;
+}
+
+void box_free(struct box *b)
+{
+    int i;
+
+    for (i = 0; i < b->nreq; i++)
+	G_free(b->req[i].result);
+    G_free(b->req);
+    if (b->order)
+	stat_order_destroy(b->order);
+    G_free(b->col_cnt);
+    G_free(b->col_sum);
+    G_free(b->col_dsum);
+    G_free(b->col_dsq);
+    G_free(b->col_min);
+    G_free(b->col_max);
+    G_free(b->cnt);
+    G_free(b->sum);
+    G_free(b->dsum);
+    G_free(b->dsq);
+    G_free(b->min);
+    G_free(b->max);
+    G_free(b->pre);
+    G_free(b->suf);
+}
+
+#define OP_SUM(a, b) ((a) + (b))
+#define OP_MIN(a, b) ((b) < (a) ? (b) : (a))
+#define OP_MAX(a, b) ((b) > (a) ? (b) : (a))
+
+/* van Herk/Gil-Werman: combine the ncb.nsize columns from col */
+#define SLIDE(name, OP)							\
+static void name(const struct box *b, const DCELL *in, DCELL *out)	\
+{									\
+    int k = ncb.nsize;							\
+    DCELL *pre = b->pre, *suf = b->suf;					\
+    int i;								\
+									\
+    for (i = 0; i < b->len; i++)					\
+	pre[i] = i % k == 0 ? in[i] : OP(pre[i - 1], in[i]);		\
+    for (i = b->len - 1; i >= 0; i--)					\
+	suf[i] = (i % k == k - 1 || i == b->len - 1)			\
+	    ? in[i] : OP(suf[i + 1], in[i]);				\
+									\
+    for (i = 0; i < b->ncols; i++)					\
+	out[i] = i % k == 0						\
+	    ? pre[i + k - 1] : OP(suf[i], pre[i + k - 1]);		\
+}
+
+SLIDE(slide_sum, OP_SUM)
+SLIDE(slide_min, OP_MIN)
+SLIDE(slide_max, OP_MAX)
+
+/* columns of the window: null values are NaN, comparisons with NaN
+   are false */
+static void column_stats(struct box *b, DCELL **buf)
+{
+    int row, i;
+
+    for (i = 0; i < b->len; i++)
+	b->col_cnt[i] = 0;
+    if (b->need_sum)
+	for (i = 0; i < b->len; i++)
+	    b->col_sum[i] = 0;
+    if (b->need_var)
+	for (i = 0; i < b->len; i++)
+	    b->col_dsum[i] = b->col_dsq[i] = 0;
+    if (b->need_minmax)
+	for (i = 0; i < b->len; i++) {
+	    b->col_min[i] = HUGE_VAL;
+	    b->col_max[i] = -HUGE_VAL;
+	}
+
+    for (row = 0; row < ncb.nsize; row++) {
+	const DCELL *in = buf[row];
+
+	for (i = 0; i < b->len; i++)
+	    b->col_cnt[i] += in[i] == in[i];
+	if (b->need_sum)
+	    for (i = 0; i < b->len; i++)
+		b->col_sum[i] += in[i] == in[i] ? in[i] : 0;
+	if (b->need_var)
+	    for (i = 0; i < b->len; i++) {
+		DCELL d = in[i] == in[i] ? in[i] - b->shift : 0;
+
+		b->col_dsum[i] += d;
+		b->col_dsq[i] += d * d;
+	    }
+	if (b->need_minmax)
+	    for (i = 0; i < b->len; i++) {
+		b->col_min[i] = OP_MIN(b->col_min[i], in[i]);
+		b->col_max[i] = OP_MAX(b->col_max[i], in[i]);
+	    }
+    }
+}
+
+static void order_stats(struct box *b, DCELL **buf)
+{
+    int row, col, i;
+
+    stat_order_setup(b->order, buf, ncb.nsize, b->len);
+
+    for (col = 0; col < ncb.nsize - 1; col++)
+	for (row = 0; row < ncb.nsize; row++)
+	    stat_order_add(b->order, row, col);
+
+    for (col = 0; col < b->ncols; col++) {
+	for (row = 0; row < ncb.nsize; row++)
+	    stat_order_add(b->order, row, col + ncb.nsize - 1);
+
+	for (i = 0; i < b->nreq; i++) {
+	    struct box_request *req = &b->req[i];
+
+	    switch (req->method) {
+	    case BOX_MEDIAN:
+		stat_order_median(b->order, &req->result[col]);
+		break;
+	    case BOX_MODE:
+		stat_order_mode(b->order, &req->result[col]);
+		break;
+	    case BOX_QUANT:
+		stat_order_quant(b->order, req->quantile, &req->result[col]);
+		break;
+	    default:
+		break;
+	    }
+	}
+
+	for (row = 0; row < ncb.nsize; row++)
+	    stat_order_remove(b->order, row, col);
+    }
+}
+
+/*!
+   \brief Compute the box filters of a row
+
+   \param b box filters
+   \param buf ncb.nsize rows of the window around the row
+ */
+void box_row(struct box *b, DCELL **buf)
+{
+    if (b->need_var) {
+	const DCELL *center = buf[ncb.dist] + ncb.dist;
+	DCELL sum = 0;
+	int count = 0;
+	int i;
+
+	for (i = 0; i < b->ncols; i++)
+	    if (!Rast_is_d_null_value(&center[i])) {
+		sum += center[i];
+		count++;
+	    }
+	b->shift = count ? sum / count : 0;
+    }
+
+    column_stats(b, buf);
+
+    slide_sum(b, b->col_cnt, b->cnt);
+    if (b->need_sum)
+	slide_sum(b, b->col_sum, b->sum);
+    if (b->need_var) {
+	slide_sum(b, b->col_dsum, b->dsum);
+	slide_sum(b, b->col_dsq, b->dsq);
+    }
+    if (b->need_minmax) {
+	slide_min(b, b->col_min, b->min);
+	slide_max(b, b->col_max, b->max);
+    }
+
+    if (b->need_order)
+	order_stats(b, buf);
+}
+
+/*!
+   \brief Get the result of a method for the row of box_row()
+
+   Null values are set as by the corresponding c_*() function.
+
+   \param b box filters
+   \param index index returned by box_add()
+   \param[out] result ncols results
+ */
+void box_result(const struct box *b, int index, DCELL *result)
+{
+    enum box_method method = b->req[index].method;
+    int i;
+
+    if (b->req[index].result) {
+	memcpy(result, b->req[index].result, b->ncols * sizeof(DCELL));
+	return;
+    }
+
+    for (i = 0; i < b->ncols; i++) {
+	DCELL n = b->cnt[i];
+
+	if (method == BOX_COUNT) {
+	    result[i] = n;
+	    continue;
+	}
+	if (n == 0) {
+	    Rast_set_d_null_value(&result[i], 1);
+	    continue;
+	}
+
+	switch (method) {
+	case BOX_AVE:
+	    result[i] = b->sum[i] / n;
+	    break;
+	case BOX_SUM:
+	    result[i] = b->sum[i];
+	    break;
+	case BOX_VAR:
+	case BOX_STDDEV:
+	    {
+		DCELL ave = b->dsum[i] / n;
+		DCELL var = b->dsq[i] / n - ave * ave;
+
+		if (var < 0)
+		    var = 0;
+		result[i] = method == BOX_VAR ? var : sqrt(var);
+	    }
+	    break;
+	case BOX_MIN:
+	    result[i] = b->min[i];
+	    break;
+	case BOX_MAX:
+	    result[i] = b->max[i];
+	    break;
+	case BOX_RANGE:
+	    result[i] = b->max[i] - b->min[i];
+	    break;
+	default:
+	    break;
+	}
+    }
+}
@@ -0,0 +1,51 @@
+#include <grass/raster.h>
+#include <grass/stats.h>
+
+/* methods computed by box filters */
+enum box_method
+{
+    BOX_NONE = -1,
+    BOX_AVE,
+    BOX_SUM,
+    BOX_COUNT,
+    BOX_VAR,
+    BOX_STDDEV,
+    BOX_MIN,
+    BOX_MAX,
+    BOX_RANGE,
+    BOX_MEDIAN,
+    BOX_MODE,
+    BOX_QUANT
+};
+
+struct box_request
+{
+    enum box_method method;
+    double quantile;		/* for BOX_QUANT */
+    DCELL *result;		/* results by column of order statistics */
+};
+
+struct box			/* statistics of square neighborhoods */
+{
+    int nreq;
+    struct box_request *req;
+    int need_sum;		/* sums for average and sum */
+    int need_var;		/* sums of deviations for variance */
+    int need_minmax;		/* minimum and maximum */
+    int need_order;		/* median, mode and quantiles */
+    int need_mode;
+    int ncols;
+    int len;			/* ncols + 2 * ncb.dist */
+    DCELL shift;		/* reference value of the deviations */
+    DCELL *col_cnt, *col_sum, *col_dsum, *col_dsq, *col_min, *col_max;
+    DCELL *cnt, *sum, *dsum, *dsq, *min, *max;	/* results by column */
+    DCELL *pre, *suf;		/* partial results within blocks */
+    struct stat_order *order;	/* sliding window of values */
+};
+
+/* box.c */
+extern int box_add(struct box *, stat_func *, double);
+extern void box_allocate(struct box *, int);
+extern void box_free(struct box *);
+extern void box_row(struct box *, DCELL **);
+extern void box_result(const struct box *, int, DCELL *);
@@ -1,42 +1,51 @@
 #include <grass/gis.h>
 #include <grass/raster.h>
+#include <grass/rowio.h>
+#include <grass/glocale.h>
 #include "ncb.h"
+#include "local_proto.h"
 
 /*
-   allocate the i/o bufs
+   the i/o bufs are the rows of a rowio window around a block of
+   ncb.nblock rows: the neighborhoods of the i-th row of the block are
+   in the bufs i to i + ncb.nsize - 1
 
-   the i/o bufs will be rotated by the read operation so that the
-   last row read will be in the last i/o buf
+   stepping to the next block rotates the bufs so that the new last rows
+   are read into the bufs of the first rows; each buf has ncb.dist null
+   cells on both sides, rows outside of the region are null
 
  */
 
-int allocate_bufs(void)
+static int get_row(int fd, void *buf, int row, int len)
 {
-    int i;
-    int bufsize;
+    Rast_get_d_row(fd, buf, row);
 
-    bufsize = (Rast_window_cols() + 2 * ncb.dist) * sizeof(DCELL);
-
-    ncb.buf = (DCELL **) G_malloc(ncb.nsize * sizeof(DCELL *));
-    for (i = 0; i < ncb.nsize; i++) {
-	ncb.buf[i] = (DCELL *) G_malloc(bufsize);
-	Rast_set_d_null_value(ncb.buf[i], Rast_window_cols() + 2 * ncb.dist);
-    }
-
-    return 0;
+    return 1;
 }
 
-int rotate_bufs(void)
+static void set_null(void *buf, int len)
 {
-    DCELL *temp;
-    int i;
-
-    temp = ncb.buf[0];
+    Rast_set_d_null_value(buf, len / sizeof(DCELL));
+}
 
-    for (i = 1; i < ncb.nsize; i++)
-	ncb.buf[i - 1] = ncb.buf[i];
+void allocate_bufs(int fd, int nrows, int ncols)
+{
+    if (Rowio_window_setup(&ncb.win, fd, nrows, ncb.nsize + ncb.nblock - 1,
+			   ncols * sizeof(DCELL), ncb.dist * sizeof(DCELL),
+			   get_row, set_null) < 0)
+	G_fatal_error(_("Unable to allocate row buffers"));
+}
 
-    ncb.buf[ncb.nsize - 1] = temp;
+/* read the block of rows starting at row */
+void readcell(int row)
+{
+    ncb.buf = (DCELL **) Rowio_window_get(&ncb.win,
+					   row - ncb.dist + ncb.win.size / 2);
+    if (!ncb.buf)
+	G_fatal_error(_("Unable to read row %d"), row);
+}
 
-    return 0;
+void release_bufs(void)
+{
+    Rowio_window_release(&ncb.win);
 }
@@ -1,15 +1,13 @@
 /* bufs.c */
-extern int allocate_bufs(void);
-extern int rotate_bufs(void);
+extern void allocate_bufs(int, int, int);
+extern void readcell(int);
+extern void release_bufs(void);
 
 /* gather */
 extern void circle_mask(void);
 extern void weights_mask(void);
-extern int gather(DCELL *, int);
-extern int gather_w(DCELL *, DCELL(*)[2], int);
-
-/* readcell.c */
-extern int readcell(int, int, int, int);
+extern int gather(DCELL **, DCELL *, int);
+extern int gather_w(DCELL **, DCELL *, DCELL(*)[2], int);
 
 /* divr_cats.c */
 extern int divr_cats(void);
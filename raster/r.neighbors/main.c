@@ -26,8 +26,12 @@
 #include <grass/glocale.h>
 #include <grass/stats.h>
 #include "ncb.h"
+#include "box.h"
 #include "local_proto.h"
 
+/* rows per thread in a block of rows */
+#define BLOCK_ROWS 8
+
 typedef int (*ifunc) (void);
 
 struct menu
@@ -89,6 +93,30 @@ struct output
     ifunc cat_names;
     int map_type;
     double quantile;
+    int box;			/* index of the box filter result or -1 */
+};
+
+/* work buffers of a thread */
+struct scratch
+{
+    DCELL *values;		/* list of neighborhood values */
+    DCELL *values_tmp;		/* list of neighborhood values */
+    DCELL(*values_w)[2];	/* list of neighborhood values and weights */
+    DCELL(*values_w_tmp)[2];	/* list of neighborhood values and weights */
+    struct box box;
+};
+
+struct block
+{
+    struct output *outputs;
+    int num_outputs;
+    int ncols;
+    int weights;
+    int gather;			/* some output needs the neighborhood values */
+    int use_box;		/* some output uses the box filters */
+    char **selection;		/* null flags of the selection map or NULL */
+    int chunk;			/* rows per thread */
+    struct scratch *scratch;	/* per thread */
 };
 
 static int find_method(const char *method_name)
@@ -104,6 +132,81 @@ static int find_method(const char *method_name)
     return -1;
 }
 
+static void process_row(const struct block *blk, struct scratch *s, int i)
+{
+    DCELL **buf = ncb.buf + i;
+    const char *selection = blk->selection ? blk->selection[i] : NULL;
+    size_t offset = (size_t)i * blk->ncols;
+    int col, j, n;
+
+    if (blk->use_box) {
+	box_row(&s->box, buf);
+	for (j = 0; j < blk->num_outputs; j++) {
+	    struct output *out = &blk->outputs[j];
+
+	    if (out->box >= 0)
+		box_result(&s->box, out->box, out->buf + offset);
+	}
+    }
+
+    for (col = 0; blk->gather && col < blk->ncols; col++) {
+
+	if (selection && selection[col])
+	    continue;
+
+	if (blk->weights)
+	    n = gather_w(buf, s->values, s->values_w, col);
+	else
+	    n = gather(buf, s->values, col);
+
+	for (j = 0; j < blk->num_outputs; j++) {
+	    struct output *out = &blk->outputs[j];
+	    DCELL *rp = &out->buf[offset + col];
+
+	    if (out->box >= 0)
+		continue;
+
+	    if (n == 0) {
+		Rast_set_d_null_value(rp, 1);
+	    }
+	    else {
+		if (out->method_fn_w) {
+		    memcpy(s->values_w_tmp, s->values_w, n * 2 * sizeof(DCELL));
+		    (*out->method_fn_w)(rp, s->values_w_tmp, n, &out->quantile);
+		}
+		else {
+		    memcpy(s->values_tmp, s->values, n * sizeof(DCELL));
+		    (*out->method_fn)(rp, s->values_tmp, n, &out->quantile);
+		}
+	    }
+	}
+    }
+
+    for (col = 0; selection && col < blk->ncols; col++) {
+	if (selection[col]) {
+	    /* ncb.buf length is region row length + 2 * ncb.dist (eq. floor(neighborhood/2))
+	     * Thus original data start is shifted by ncb.dist! */
+	    for (j = 0; j < blk->num_outputs; j++)
+		blk->outputs[j].buf[offset + col] =
+		    buf[ncb.dist][col + ncb.dist];
+	}
+    }
+}
+
+/* the threads read the neighborhood rows in ncb.buf, shared by all of
+ * them, and write the rows of the block they were given to the buffers
+ * of the outputs; the neighborhood values, weights and box sums of a
+ * thread are in its own scratch */
+static void process_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct scratch *s = &blk->scratch[first / blk->chunk];
+    int i;
+
+    for (i = first; i < last; i++)
+	process_row(blk, s, i);
+}
+
 static RASTER_MAP_TYPE output_type(RASTER_MAP_TYPE input_type, int weighted, int mode)
 {
     switch (mode) {
@@ -131,11 +234,11 @@ int main(int argc, char *argv[])
     int num_outputs;
     struct output *outputs = NULL;
     int copycolr, weights, have_weights_mask;
-    char *selection;
+    char **selection;
     RASTER_MAP_TYPE map_type;
-    int row, col;
-    int readrow;
+    int row;
     int nrows, ncols;
+    int nprocs;
     int i, n;
     struct Colors colr;
     struct Cell_head cellhd;
@@ -150,16 +253,14 @@ int main(int argc, char *argv[])
 	struct Option *weight;
 	struct Option *gauss;
 	struct Option *quantile;
+	struct Option *nprocs;
     } parm;
     struct
     {
 	struct Flag *align, *circle;
     } flag;
-
-    DCELL *values;		/* list of neighborhood values */
-    DCELL *values_tmp;		/* list of neighborhood values */
-    DCELL(*values_w)[2];	/* list of neighborhood values and weights */
-    DCELL(*values_w_tmp)[2];	/* list of neighborhood values and weights */
+    struct block blk;
+    struct box box;
 
     G_gisinit(argv[0]);
 
@@ -239,6 +340,8 @@ int main(int argc, char *argv[])
     parm.quantile->description = _("Quantile to calculate for method=quantile");
     parm.quantile->options = "0.0-1.0";
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.align = G_define_flag();
     flag.align->key = 'a';
     flag.align->description = _("Do not align output with the input");
@@ -258,6 +361,9 @@ int main(int argc, char *argv[])
 	G_fatal_error(_("Neighborhood size must be odd"));
     ncb.dist = ncb.nsize / 2;
 
+    nprocs = G_set_nprocs(parm.nprocs);
+    ncb.nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+
     if (parm.weight->answer && flag.circle->answer)
 	G_fatal_error(_("-%c and %s= are mutually exclusive"),
 			flag.circle->key, parm.weight->key);
@@ -310,6 +416,9 @@ int main(int argc, char *argv[])
     
     copycolr = 0;
     have_weights_mask = 0;
+    G_zero(&box, sizeof(box));
+    blk.gather = 0;
+    blk.use_box = 0;
 
     for (i = 0; i < num_outputs; i++) {
 	struct output *out = &outputs[i];
@@ -346,6 +455,17 @@ int main(int argc, char *argv[])
 	    out->method_fn = menu[method].method;
 	    out->method_fn_w = NULL;
 	}
+	/* square neighborhoods without weights: box filters */
+	out->box = -1;
+	if (!weights && !flag.circle->answer)
+	    out->box = box_add(&box, out->method_fn,
+			       parm.quantile->answer &&
+			       parm.quantile->answers[i]
+			       ? atof(parm.quantile->answers[i]) : 0);
+	if (out->box >= 0)
+	    blk.use_box = 1;
+	else
+	    blk.gather = 1;
 	out->copycolr = menu[method].copycolr;
 	out->cat_names = menu[method].cat_names;
 	if (out->copycolr)
@@ -353,7 +473,7 @@ int main(int argc, char *argv[])
 	out->quantile = (parm.quantile->answer && parm.quantile->answers[i])
 	    ? atof(parm.quantile->answers[i])
 	    : 0;
-	out->buf = Rast_allocate_d_buf();
+	out->buf = G_malloc((size_t)ncb.nblock * ncols * sizeof(DCELL));
 	out->fd = Rast_open_new(output_name, otype);
 	/* TODO: method=mode should propagate its type */
 
@@ -374,18 +494,15 @@ int main(int argc, char *argv[])
     }
 
     /* allocate the cell buffers */
-    allocate_bufs();
-
-    /* initialize the cell bufs with 'dist' rows of the old cellfile */
-    readrow = 0;
-    for (row = 0; row < ncb.dist; row++)
-	readcell(in_fd, readrow++, nrows, ncols);
+    allocate_bufs(in_fd, nrows, ncols);
 
     /* open the selection raster map */
     if (parm.selection->answer) {
 	G_message(_("Opening selection map <%s>"), parm.selection->answer);
 	selection_fd = Rast_open_old(parm.selection->answer, "");
-        selection = Rast_allocate_null_buf();
+        selection = G_malloc(ncb.nblock * sizeof(char *));
+	for (i = 0; i < ncb.nblock; i++)
+	    selection[i] = Rast_allocate_null_buf();
     } else {
         selection_fd = -1;
         selection = NULL;
@@ -394,67 +511,53 @@ int main(int argc, char *argv[])
     if (flag.circle->answer)
 	circle_mask();
 
-    values_w = NULL;
-    values_w_tmp = NULL;
-    if (weights) {
-	values_w =
-	    (DCELL(*)[2]) G_malloc(ncb.nsize * ncb.nsize * 2 * sizeof(DCELL));
-	values_w_tmp =
-	    (DCELL(*)[2]) G_malloc(ncb.nsize * ncb.nsize * 2 * sizeof(DCELL));
+    blk.outputs = outputs;
+    blk.num_outputs = num_outputs;
+    blk.ncols = ncols;
+    blk.weights = weights;
+    blk.selection = selection;
+    blk.chunk = (ncb.nblock + nprocs - 1) / nprocs;
+    blk.scratch = G_calloc(nprocs, sizeof(struct scratch));
+    for (i = 0; i < nprocs; i++) {
+	struct scratch *s = &blk.scratch[i];
+
+	if (weights) {
+	    s->values_w =
+		(DCELL(*)[2]) G_malloc(ncb.nsize * ncb.nsize * 2 * sizeof(DCELL));
+	    s->values_w_tmp =
+		(DCELL(*)[2]) G_malloc(ncb.nsize * ncb.nsize * 2 * sizeof(DCELL));
+	}
+	s->values = (DCELL *) G_malloc(ncb.nsize * ncb.nsize * sizeof(DCELL));
+	s->values_tmp = (DCELL *) G_malloc(ncb.nsize * ncb.nsize * sizeof(DCELL));
+	if (blk.use_box) {
+	    s->box = box;
+	    box_allocate(&s->box, ncols);
+	}
     }
-    values = (DCELL *) G_malloc(ncb.nsize * ncb.nsize * sizeof(DCELL));
-    values_tmp = (DCELL *) G_malloc(ncb.nsize * ncb.nsize * sizeof(DCELL));
 
-    for (row = 0; row < nrows; row++) {
+    for (row = 0; row < nrows; row += ncb.nblock) {
+	int nblock = nrows - row < ncb.nblock ? nrows - row : ncb.nblock;
+
 	G_percent(row, nrows, 2);
-	readcell(in_fd, readrow++, nrows, ncols);
+	readcell(row);
 
 	if (selection)
-            Rast_get_null_value_row(selection_fd, selection, row);
+	    for (i = 0; i < nblock; i++)
+		Rast_get_null_value_row(selection_fd, selection[i], row + i);
 
-	for (col = 0; col < ncols; col++) {
-
-            if (selection && selection[col]) {
-                /* ncb.buf length is region row length + 2 * ncb.dist (eq. floor(neighborhood/2))
-                 * Thus original data start is shifted by ncb.dist! */
-		for (i = 0; i < num_outputs; i++)
-		    outputs[i].buf[col] = ncb.buf[ncb.dist][col + ncb.dist];
-		continue;
-	    }
-
-	    if (weights)
-		n = gather_w(values, values_w, col);
-	    else
-		n = gather(values, col);
+	/* the rows of a block are independent */
+	G_parallel_for(0, nblock, blk.chunk, process_rows, &blk);
 
+	for (n = 0; n < nblock; n++)
 	    for (i = 0; i < num_outputs; i++) {
 		struct output *out = &outputs[i];
-		DCELL *rp = &out->buf[col];
 
-		if (n == 0) {
-		    Rast_set_d_null_value(rp, 1);
-		}
-		else {
-		    if (out->method_fn_w) {
-			memcpy(values_w_tmp, values_w, n * 2 * sizeof(DCELL));
-			(*out->method_fn_w)(rp, values_w_tmp, n, &out->quantile);
-		    }
-		    else {
-			memcpy(values_tmp, values, n * sizeof(DCELL));
-			(*out->method_fn)(rp, values_tmp, n, &out->quantile);
-		    }
-		}
+		Rast_put_d_row(out->fd, out->buf + (size_t)n * ncols);
 	    }
-	}
-
-	for (i = 0; i < num_outputs; i++) {
-	    struct output *out = &outputs[i];
-
-	    Rast_put_d_row(out->fd, out->buf);
-	}
     }
-    G_percent(row, nrows, 2);
+    G_percent(nrows, nrows, 2);
 
+    release_bufs();
     Rast_close(in_fd);
 
     if (selection)
@@ -1,8 +1,11 @@
 #include <grass/raster.h>
+#include <grass/rowio.h>
 
 struct ncb			/* neighborhood control block */
 {
-    DCELL **buf;		/* for reading raster map */
+    ROWIO_WINDOW win;		/* rows around the current block of rows */
+    DCELL **buf;		/* rows of win, padded by dist cells */
+    int nblock;			/* number of rows in a block */
     int *value;			/* neighborhood values */
     int nsize;			/* size of the neighborhood */
     int dist;			/* nsize/2 */
@@ -207,6 +207,48 @@ int exact_checks(GDALDataType export_datatype,
     return ret;
 }
 
+/* replace the nulls of a row by the nodata value
+ * returns the number of nulls
+ * */
+static int replace_nulls(void *buf, int cols, RASTER_MAP_TYPE maptype,
+			 double nodataval)
+{
+    int col, n_nulls = 0;
+
+    if (maptype == FCELL_TYPE) {
+	FCELL *fbuf = buf, fnullval = (FCELL) nodataval;
+
+	for (col = 0; col < cols; col++) {
+	    if (Rast_is_f_null_value(&fbuf[col])) {
+		fbuf[col] = fnullval;
+		n_nulls++;
+	    }
+	}
+    }
+    else if (maptype == DCELL_TYPE) {
+	DCELL *dbuf = buf, dnullval = (DCELL) nodataval;
+
+	for (col = 0; col < cols; col++) {
+	    if (Rast_is_d_null_value(&dbuf[col])) {
+		dbuf[col] = dnullval;
+		n_nulls++;
+	    }
+	}
+    }
+    else {
+	CELL *cbuf = buf, inullval = (CELL) nodataval;
+
+	for (col = 0; col < cols; col++) {
+	    if (Rast_is_c_null_value(&cbuf[col])) {
+		cbuf[col] = inullval;
+		n_nulls++;
+	    }
+	}
+    }
+
+    return n_nulls;
+}
+
 /* actual raster band export
  * returns 0 on success
  * -1 on raster data read/write error
@@ -215,7 +257,7 @@ int export_band(GDALDatasetH hMEMDS, int band,
 		const char *name, const char *mapset,
 		struct Cell_head *cellhead, RASTER_MAP_TYPE maptype,
 		double nodataval, int suppress_main_colortable, 
-		int no_metadata, int writenodata)
+		int no_metadata, int writenodata, int nprocs)
 {
     struct Colors sGrassColors;
     GDALColorTableH hCT;
@@ -357,111 +399,65 @@ int export_band(GDALDatasetH hMEMDS, int band,
 	}
     }
 
+    /* Rows written at once: the block height of the band, at most as
+     * many as fit into the GDAL block cache */
+    size_t row_size = (size_t)cols * Rast_cell_size(maptype);
+    int block_cols, nblock;
+
+    GDALGetBlockSize(hBand, &block_cols, &nblock);
+    while (nblock > 1 && (GIntBig)(nblock * row_size) > GDALGetCacheMax64())
+	nblock /= 2;
+    if (nblock < 1)
+	nblock = 1;
+    G_debug(1, "rows written at once: %d", nblock);
+
     /* Create GRASS raster buffer */
-    void *bufer = Rast_allocate_buf(maptype);
+    void *bufer = G_malloc(row_size * nblock);
 
-    if (bufer == NULL) {
-	G_warning(_("Unable to allocate buffer for reading raster map"));
-	return -1;
-    }
+    /* the rows of the next block are decompressed while this one is
+     * written */
+    if (nprocs > 1)
+	Rast_set_read_ahead(fd, nblock);
 
     /* the following routine must be kept identical to exact_checks */
 
     /* Copy data form GRASS raster to GDAL raster */
-    int row, col;
+    int row, i, n;
     int n_nulls = 0;
 
     /* Better use selected GDAL datatype instead of 
      * the best match with GRASS raster map types ? */
 
-    if (maptype == FCELL_TYPE) {
-
-	/* Source datatype understandable by GDAL */
-	GDALDataType datatype = GDT_Float32;
-	FCELL fnullval = (FCELL) nodataval;
-
-	G_debug(1, "FCELL nodata val: %f", fnullval);
-
-	for (row = 0; row < rows; row++) {
-
-	    Rast_get_row(fd, bufer, row, maptype);
-	    for (col = 0; col < cols; col++) {
-		if (Rast_is_f_null_value(&((FCELL *) bufer)[col])) {
-		    ((FCELL *) bufer)[col] = fnullval;
-		    if (n_nulls == 0) {
-			GDALSetRasterNoDataValue(hBand, nodataval);
-		    }
-		    n_nulls++;
-		}
-	    }
-
-	    if (GDALRasterIO
-		(hBand, GF_Write, 0, row, cols, 1, bufer, cols, 1, datatype,
-		 0, 0) >= CE_Failure) {
-		G_warning(_("Unable to write GDAL raster file"));
-		return -1;
-	    }
-	    G_percent(row + 1, rows, 2);
-	}
-    }
-    else if (maptype == DCELL_TYPE) {
+    /* Source datatype understandable by GDAL */
+    GDALDataType datatype = maptype == FCELL_TYPE ? GDT_Float32 :
+	maptype == DCELL_TYPE ? GDT_Float64 : GDT_Int32;
 
-	GDALDataType datatype = GDT_Float64;
-	DCELL dnullval = (DCELL) nodataval;
+    G_debug(1, "nodata val: %f", nodataval);
 
-	G_debug(1, "DCELL nodata val: %f", dnullval);
+    for (row = 0; row < rows; row += n) {
+	n = rows - row < nblock ? rows - row : nblock;
 
-	for (row = 0; row < rows; row++) {
-
-	    Rast_get_row(fd, bufer, row, maptype);
-	    for (col = 0; col < cols; col++) {
-		if (Rast_is_d_null_value(&((DCELL *) bufer)[col])) {
-		    ((DCELL *) bufer)[col] = dnullval;
-		    if (n_nulls == 0) {
-			GDALSetRasterNoDataValue(hBand, nodataval);
-		    }
-		    n_nulls++;
-		}
-	    }
+	for (i = 0; i < n; i++) {
+	    void *rowbuf = G_incr_void_ptr(bufer, i * row_size);
+	    int nulls;
 
-	    if (GDALRasterIO
-		(hBand, GF_Write, 0, row, cols, 1, bufer, cols, 1, datatype,
-		 0, 0) >= CE_Failure) {
-		G_warning(_("Unable to write GDAL raster file"));
-		return -1;
-	    }
-	    G_percent(row + 1, rows, 2);
+	    Rast_get_row(fd, rowbuf, row + i, maptype);
+	    nulls = replace_nulls(rowbuf, cols, maptype, nodataval);
+	    if (nulls && n_nulls == 0)
+		GDALSetRasterNoDataValue(hBand, nodataval);
+	    n_nulls += nulls;
 	}
-    }
-    else {
-
-	GDALDataType datatype = GDT_Int32;
-	CELL inullval = (CELL) nodataval;
-
-	G_debug(1, "CELL nodata val: %d", inullval);
-
-	for (row = 0; row < rows; row++) {
-
-	    Rast_get_row(fd, bufer, row, maptype);
-	    for (col = 0; col < cols; col++) {
-		if (Rast_is_c_null_value(&((CELL *) bufer)[col])) {
-		    ((CELL *) bufer)[col] = inullval;
-		    if (n_nulls == 0) {
-			GDALSetRasterNoDataValue(hBand, nodataval);
-		    }
-		    n_nulls++;
-		}
-	    }
 
-	    if (GDALRasterIO
-		(hBand, GF_Write, 0, row, cols, 1, bufer, cols, 1, datatype,
-		 0, 0) >= CE_Failure) {
-		G_warning(_("Unable to write GDAL raster file"));
-		return -1;
-	    }
-	    G_percent(row + 1, rows, 2);
+	if (GDALRasterIO
+	    (hBand, GF_Write, 0, row, cols, n, bufer, cols, n, datatype,
+	     0, 0) >= CE_Failure) {
+	    G_warning(_("Unable to write GDAL raster file"));
+	    return -1;
 	}
+	G_percent(row + n, rows, 2);
     }
+    if (nprocs > 1)
+	Rast_set_read_ahead(fd, 0);
     if (writenodata && n_nulls == 0)
 	GDALSetRasterNoDataValue(hBand, nodataval);
 
@@ -112,13 +112,32 @@ static void AttachMetadata(GDALDatasetH hDS, char **papszMetadataOptions)
 }
 
 
+/* does the driver know the creation option name ? */
+static int HasCreationOption(GDALDriverH hDriver, const char *name)
+{
+    const char *pszList =
+	GDALGetMetadataItem(hDriver, GDAL_DMD_CREATIONOPTIONLIST, NULL);
+    char *pszName;
+    int found;
+
+    if (!pszList)
+	return 0;
+
+    G_asprintf(&pszName, "name='%s'", name);
+    found = strstr(pszList, pszName) != NULL;
+    G_free(pszName);
+
+    return found;
+}
+
+
 int main(int argc, char *argv[])
 {
 
     struct GModule *module;
     struct Flag *flag_l, *flag_c, *flag_m, *flag_f, *flag_t;
     struct Option *input, *format, *type, *output, *createopt, *metaopt,
-	          *nodataopt, *overviewopt;
+	          *nodataopt, *overviewopt, *nprocsopt;
 
     struct Cell_head cellhead;
     struct Ref ref;
@@ -251,6 +270,8 @@ int main(int argc, char *argv[])
     overviewopt->required = NO;
     overviewopt->guisection = _("Creation");
 
+    nprocsopt = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
@@ -564,6 +585,44 @@ int main(int argc, char *argv[])
 	}
     }
 
+    /* Options of the target driver: blocks are compressed by GDAL's own
+     * threads, the COG driver builds the overviews while it writes the
+     * dataset */
+    char **papszDstOptions = CSLDuplicate(papszOptions);
+    int nprocs = G_set_nprocs(nprocsopt);
+
+    if (nprocs > 1 && HasCreationOption(hDriver, "NUM_THREADS") &&
+	!CSLFetchNameValue(papszDstOptions, "NUM_THREADS")) {
+	char szThreads[32];
+
+	sprintf(szThreads, "%d", nprocs);
+	papszDstOptions =
+	    CSLSetNameValue(papszDstOptions, "NUM_THREADS", szThreads);
+    }
+
+    if (overviewopt->answer) {
+	n_overviews = atoi(overviewopt->answer);
+	if (n_overviews < 0 || n_overviews > 5) {
+	    G_warning(_("Number of overviews must be between 0 and 5"));
+	    n_overviews = 0;
+	}
+    }
+    if (n_overviews && hMEMDriver &&
+	HasCreationOption(hDriver, "OVERVIEW_COUNT")) {
+	char szCount[32];
+
+	if (!CSLFetchNameValue(papszDstOptions, "OVERVIEW_COUNT")) {
+	    sprintf(szCount, "%d", n_overviews);
+	    papszDstOptions =
+		CSLSetNameValue(papszDstOptions, "OVERVIEW_COUNT", szCount);
+	}
+	if (!CSLFetchNameValue(papszDstOptions, "OVERVIEW_RESAMPLING"))
+	    papszDstOptions =
+		CSLSetNameValue(papszDstOptions, "OVERVIEW_RESAMPLING",
+				"NEAREST");
+	n_overviews = 0;
+    }
+
     GDALDatasetH hCurrDS = NULL, hMEMDS = NULL, hDstDS = NULL;
 
     if (hMEMDriver) {
@@ -578,7 +637,7 @@ int main(int argc, char *argv[])
     else {
 	hDstDS =
 	    GDALCreate(hDriver, output->answer, cellhead.cols, cellhead.rows,
-		       ref.nfiles, datatype, papszOptions);
+		       ref.nfiles, datatype, papszDstOptions);
 	if (hDstDS == NULL)
 	    G_fatal_error(_("Unable to create <%s> dataset using <%s> driver"),
 			  output->answer, format->answer);
@@ -643,7 +702,8 @@ int main(int argc, char *argv[])
 	retval = export_band
 	    (hCurrDS, band + 1, ref.file[band].name,
 	     ref.file[band].mapset, &cellhead, maptype, nodataval,
-	     flag_c->answer, flag_m->answer, (nodataopt->answer != NULL));
+	     flag_c->answer, flag_m->answer, (nodataopt->answer != NULL),
+	     nprocs);
 
 	/* read/write error */
 	if (retval == -1) {
@@ -656,14 +716,18 @@ int main(int argc, char *argv[])
 	}
     }
 
-    /* overviews */
-    if (overviewopt->answer) {
-	n_overviews = atoi(overviewopt->answer);
-	if (n_overviews < 0 || n_overviews > 5) {
-	    G_warning(_("Number of overviews must be between 0 and 5"));
-	    n_overviews = 0;
-	}
+    /* Finally create user requested raster format from memory raster 
+     * if in-memory driver was used */
+    if (hMEMDS) {
+	hDstDS =
+	    GDALCreateCopy(hDriver, output->answer, hMEMDS, FALSE,
+			   papszDstOptions, NULL, NULL);
+	if (hDstDS == NULL)
+	    G_fatal_error(_("Unable to create raster map <%s> using driver <%s>"),
+			  output->answer, format->answer);
     }
+
+    /* overviews */
     if (n_overviews) {
 	int i, oi, *ol;
 
@@ -681,23 +745,13 @@ int main(int argc, char *argv[])
 	}
     }
 
-    /* Finally create user requested raster format from memory raster 
-     * if in-memory driver was used */
-    if (hMEMDS) {
-	hDstDS =
-	    GDALCreateCopy(hDriver, output->answer, hMEMDS, FALSE,
-			   papszOptions, NULL, NULL);
-	if (hDstDS == NULL)
-	    G_fatal_error(_("Unable to create raster map <%s> using driver <%s>"),
-			  output->answer, format->answer);
-    }
-
     GDALClose(hDstDS);
 
     if (hMEMDS)
 	GDALClose(hMEMDS);
 
     CSLDestroy(papszOptions);
+    CSLDestroy(papszDstOptions);
 
     G_done_msg("File <%s> created.", output->answer);
     exit(EXIT_SUCCESS);
@@ -32,7 +32,8 @@ void interface(int argc, char **argv)
      *win_size,			/* Size of side of local window.        */
      *parameter,		/* Morphometric parameter to calculate. */
      *expon,			/* Inverse distance exponent for weight. */
-     *vert_sc;			/* Vertical scaling factor.             */
+     *vert_sc,			/* Vertical scaling factor.             */
+     *threads;			/* Number of threads.                   */
 
     struct Flag *constr;	/* Forces quadratic through the central */
 
@@ -68,6 +69,7 @@ void interface(int argc, char **argv)
     parameter = G_define_option();
     expon = G_define_option();
     vert_sc = G_define_option();
+    threads = G_define_standard_option(G_OPT_M_NPROCS);
 
     constr = G_define_flag();
 
@@ -136,6 +138,7 @@ void interface(int argc, char **argv)
     sscanf(vert_sc->answer, "%lf", &zscale);
     sscanf(tol1_val->answer, "%lf", &slope_tol);
     sscanf(tol2_val->answer, "%lf", &curve_tol);
+    nprocs = G_set_nprocs(threads);
 
     if ((exponent < 0.0) || (exponent > 4.0))
 	exponent = 0.0;
@@ -87,7 +87,8 @@ extern int
   fd_in,			/* File descriptor for input and        */
   fd_out,			/* output raster files.                 */
   wsize,			/* Size of local processing window.     */
-  mparam;			/* Morphometric parameter to calculate. */
+  mparam,			/* Morphometric parameter to calculate. */
+  nprocs;			/* Number of threads.                   */
 
 
 extern double
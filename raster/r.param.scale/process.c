@@ -1,4 +1,3 @@
-
 /*****************************************************************************/
 
 /***                                                                       ***/
@@ -13,6 +12,20 @@
 
 /*****************************************************************************/
 
+/* The normal equations depend only on the window size and weights, so they
+ * are factored once and every cell only needs the observed vector and a
+ * back substitution. The output rows are processed in blocks, each block
+ * is shared among nprocs threads.
+ *
+ * Without distance weighting (exponent=0) the observed vector of a cell
+ * is a set of separable filters of the window: sum(z x^a) along each row
+ * of the window, then sum(. y^b) down the columns. The horizontal sums
+ * are computed once per input row and reused by all windows covering it,
+ * which brings the cost per cell from size*size down to about 4*size.
+ * Values relative to the central cell are obtained by subtracting
+ * centre * sum(x^a y^b). Nulls propagate through the sums as NaN.
+ * With weighting the window is not separable and is summed directly. */
+
 #include <stdlib.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -21,6 +34,168 @@
 #include "param.h"
 #include "nrutil.h"
 
+#define BLOCK_ROWS 8
+
+struct scratch
+{
+    DCELL *window;		/* Local window relative to centre.     */
+    double *sum[6];		/* Vertical sums of one output row.     */
+};
+
+struct block
+{
+    int ncols;
+    int separable;
+    DCELL **in;			/* Input rows of the block plus edges.  */
+    double **hsum[3];		/* Horizontal sums of z x^a per row.    */
+    void **out;			/* Output rows of the block.            */
+    double **normal;		/* LU decomposed normal equations.      */
+    int *index;
+    double *weight;		/* Weighting matrix.                    */
+    double moment[6];		/* Observed vector of a window of ones. */
+    double *coord;		/* Local coordinate of each window row  */
+    double *coord2;		/* or column, and its square.           */
+    int chunk;
+    struct scratch *scratch;
+};
+
+static void horizontal_rows(int first, int last, void *closure)
+{
+    struct block *b = closure;
+    int edge = EDGE, ncols = b->ncols;
+    int row, col, k;
+
+    for (row = first; row < last; row++) {
+	const DCELL *z = b->in[row];
+	double *h0 = b->hsum[0][row];
+	double *h1 = b->hsum[1][row];
+	double *h2 = b->hsum[2][row];
+
+	for (col = edge; col < ncols - edge; col++)
+	    h0[col] = h1[col] = h2[col] = 0.0;
+
+	for (k = 0; k < wsize; k++) {
+	    double x = b->coord[k], xx = b->coord2[k];
+	    const DCELL *zk = z + k - edge;
+
+	    for (col = edge; col < ncols - edge; col++) {
+		h0[col] += zk[col];
+		h1[col] += zk[col] * x;
+		h2[col] += zk[col] * xx;
+	    }
+	}
+    }
+}
+
+/* Observed vectors of all cells of one output row from the horizontal
+ * sums of the wsize input rows starting at top. */
+static void vertical_sums(const struct block *b, struct scratch *s, int top)
+{
+    int edge = EDGE, ncols = b->ncols;
+    int col, k, j;
+
+    for (j = 0; j < 6; j++)
+	for (col = edge; col < ncols - edge; col++)
+	    s->sum[j][col] = 0.0;
+
+    for (k = 0; k < wsize; k++) {
+	const double *h0 = b->hsum[0][top + k];
+	const double *h1 = b->hsum[1][top + k];
+	const double *h2 = b->hsum[2][top + k];
+	double y = b->coord[k], yy = b->coord2[k];
+
+	for (col = edge; col < ncols - edge; col++) {
+	    s->sum[0][col] += h2[col];
+	    s->sum[1][col] += h0[col] * yy;
+	    s->sum[2][col] += h1[col] * y;
+	    s->sum[3][col] += h1[col];
+	    s->sum[4][col] += h0[col] * y;
+	    s->sum[5][col] += h0[col];
+	}
+    }
+}
+
+static int window_obs(const struct block *b, struct scratch *s, int top,
+		      int col, DCELL centre, double *obs)
+{
+    int edge = EDGE;
+    int wind_row, wind_col, j;
+
+    if (b->separable) {
+	/* any null in the window made the sums NaN */
+	if (isnan(s->sum[5][col]))
+	    return -1;
+	for (j = 0; j < 6; j++)
+	    obs[j] = s->sum[j][col] - centre * b->moment[j];
+	if (constrained)
+	    obs[5] = 0.0;
+	return 0;
+    }
+
+    for (wind_row = 0; wind_row < wsize; wind_row++) {
+	const DCELL *window_cell = b->in[top + wind_row] + col - edge;
+
+	for (wind_col = 0; wind_col < wsize; wind_col++) {
+	    /* Test for no data and propagate */
+	    if (Rast_is_d_null_value(&window_cell[wind_col]))
+		return -1;
+	    /* Express all window values relative   */
+	    /* to the central elevation.            */
+	    s->window[wind_row * wsize + wind_col] =
+		window_cell[wind_col] - centre;
+	}
+    }
+
+    find_obs(s->window, obs, b->weight);
+
+    return 0;
+}
+
+static void process_rows(int first, int last, void *closure)
+{
+    struct block *b = closure;
+    struct scratch *s = &b->scratch[first / b->chunk];
+    int edge = EDGE, ncols = b->ncols;
+    int row, col;
+    double obs[6];
+
+    for (row = first; row < last; row++) {
+	DCELL *row_out = b->out[row];
+	CELL *featrow_out = b->out[row];
+
+	if (mparam != FEATURE)
+	    Rast_set_d_null_value(row_out, ncols);
+	else
+	    Rast_set_c_null_value(featrow_out, ncols);
+
+	if (b->separable)
+	    vertical_sums(b, s, row);
+
+	for (col = edge; col < ncols - edge; col++) {
+	    /* Find central z value */
+	    DCELL centre = b->in[row + edge][col];
+
+	    /* Test for no data and propagate */
+	    if (Rast_is_d_null_value(&centre))
+		continue;
+
+	    if (window_obs(b, s, row, col, centre, obs) < 0)
+		continue;
+
+	    /*--- Use LU back substitution to solve normal equations. ---*/
+	    G_lubksb(b->normal, constrained ? 5 : 6, b->index, obs);
+
+	    /*--- Calculate terrain parameter based on quad. coefficients. ---*/
+	    if (mparam == FEATURE)
+		featrow_out[col] = (CELL) feature(obs);
+	    else {
+		row_out[col] = param(mparam, obs);
+		if (mparam == ELEV)
+		    row_out[col] += centre;	/* Add central elevation back */
+	    }
+	}
+    }
+}
 
 void process(void)
 {
@@ -30,33 +205,21 @@ void process(void)
 
     /*--------------------------------------------------------------------------*/
 
-
-    DCELL *row_in,		/* Buffer large enough to hold `wsize'  */
-     *row_out = NULL,		/* raster rows. When GRASS reads in a   */
-	/* raster row, each element is of type  */
-	/* DCELL        */
-	*window_ptr,		/* Stores local terrain window.         */
-	centre,			/* Elevation of central cell in window. */
-	*window_cell;		/* Stores last read cell in window. */
-
-    CELL *featrow_out = NULL;	/* store features in CELL */
-
     struct Cell_head region;	/* Structure to hold region information */
 
+    struct block blk;		/* Rows, sums and matrices of a block.  */
+
     int nrows,			/* Will store the current number of     */
       ncols,			/* rows and columns in the raster.      */
-      row, col,			/* Counts through each row and column   */
-	/* of the input raster.                 */
-      wind_row,			/* Counts through each row and column   */
-      wind_col,			/* of the local neighbourhood window.   */
-     *index_ptr;		/* Row permutation vector for LU decomp. */
+      row,			/* First output row of the block.       */
+      nblock,			/* Number of output rows in a block.    */
+      nbuf,			/* Number of input rows in a block.     */
+      nsum,			/* Rows with valid horizontal sums.     */
+      n, i, j, k;
 
-    double **normal_ptr,	/* Cross-products matrix.               */
-     *obs_ptr,			/* Observed vector.                     */
-      temp;			/* Unused */
+    RASTER_MAP_TYPE out_type = mparam != FEATURE ? DCELL_TYPE : CELL_TYPE;
 
-    double *weight_ptr;		/* Weighting matrix for observed values. */
-    int found_null;             /* If null was found among window cells  */
+    double temp;		/* Unused */
 
     /*--------------------------------------------------------------------------*/
     /*                     GET RASTER AND WINDOW DETAILS                        */
@@ -84,27 +247,54 @@ void process(void)
 
     /*--------------------------------------------------------------------------*/
 
-    row_in = (DCELL *) G_malloc(ncols * sizeof(DCELL) * wsize);
-    /* Reserve `wsize' rows of memory.      */
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    nbuf = nblock + wsize - 1;
 
-    if (mparam != FEATURE) {
-	row_out = Rast_allocate_buf(DCELL_TYPE);	/* Initialise output row buffer.     */
-	Rast_set_d_null_value(row_out, ncols);
-    }
-    else {
-	featrow_out = Rast_allocate_buf(CELL_TYPE);	/* Initialise output row buffer.  */
-	Rast_set_c_null_value(featrow_out, ncols);
+    blk.ncols = ncols;
+    blk.separable = exponent == 0.0;
+    blk.chunk = (nblock + nprocs - 1) / nprocs;
+
+    blk.in = G_malloc(nbuf * sizeof(DCELL *));
+    for (i = 0; i < nbuf; i++)
+	blk.in[i] = Rast_allocate_d_buf();
+
+    for (j = 0; j < 3; j++) {
+	blk.hsum[j] = NULL;
+	if (!blk.separable)
+	    continue;
+	blk.hsum[j] = G_malloc(nbuf * sizeof(double *));
+	for (i = 0; i < nbuf; i++)
+	    blk.hsum[j][i] = G_malloc(ncols * sizeof(double));
     }
 
-    window_ptr = (DCELL *) G_malloc(SQR(wsize) * sizeof(DCELL));
-    /* Reserve enough memory for local wind. */
+    blk.out = G_malloc(nblock * sizeof(void *));
+    for (i = 0; i < nblock; i++)
+	blk.out[i] = Rast_allocate_buf(out_type);
+
+    blk.scratch = G_malloc(nprocs * sizeof(struct scratch));
+    for (i = 0; i < nprocs; i++) {
+	blk.scratch[i].window = NULL;
+	for (j = 0; j < 6; j++)
+	    blk.scratch[i].sum[j] = NULL;
+	if (blk.separable)
+	    for (j = 0; j < 6; j++)
+		blk.scratch[i].sum[j] = G_malloc(ncols * sizeof(double));
+	else
+	    blk.scratch[i].window = G_malloc(SQR(wsize) * sizeof(DCELL));
+    }
 
-    weight_ptr = (double *)G_malloc(SQR(wsize) * sizeof(double));
+    blk.weight = (double *)G_malloc(SQR(wsize) * sizeof(double));
     /* Reserve enough memory weights matrix. */
 
-    normal_ptr = dmatrix(0, 5, 0, 5);	/* Allocate memory for 6*6 matrix       */
-    index_ptr = ivector(0, 5);	/* and for 1D vector holding indices    */
-    obs_ptr = dvector(0, 5);	/* and for 1D vector holding observed z */
+    blk.normal = dmatrix(0, 5, 0, 5);	/* Allocate memory for 6*6 matrix       */
+    blk.index = ivector(0, 5);	/* and for 1D vector holding indices    */
+
+    blk.coord = G_malloc(wsize * sizeof(double));
+    blk.coord2 = G_malloc(wsize * sizeof(double));
+    for (k = 0; k < wsize; k++) {
+	blk.coord[k] = resoln * (k - EDGE);
+	blk.coord2[k] = blk.coord[k] * blk.coord[k];
+    }
 
 
     /* ---------------------------------------------------------------- */
@@ -113,157 +303,110 @@ void process(void)
 
     /*--- Calculate weighting matrix. ---*/
 
-    find_weight(weight_ptr);
+    find_weight(blk.weight);
 
-    /* Initial coefficients need only be found once since they are 
-       constant for any given window size. The only element that 
+    /* Initial coefficients need only be found once since they are
+       constant for any given window size. The only element that
        changes is the observed vector (RHS of normal equations). */
 
     /*--- Find normal equations in matrix form. ---*/
 
-    find_normal(normal_ptr, weight_ptr);
+    find_normal(blk.normal, blk.weight);
+
+    /* The observed vector of a window of ones is the last column of
+       the normal matrix, needed to remove the central elevation. */
+
+    for (j = 0; j < 6; j++)
+	blk.moment[j] = blk.normal[j][5];
 
 
     /*--- Apply LU decomposition to normal equations. ---*/
 
     if (constrained) {
-	G_ludcmp(normal_ptr, 5, index_ptr, &temp);
-	/* To constrain the quadtratic 
-	   through the central cell, ignore 
+	G_ludcmp(blk.normal, 5, blk.index, &temp);
+	/* To constrain the quadtratic
+	   through the central cell, ignore
 	   the calculations involving the
-	   coefficient f. Since these are 
+	   coefficient f. Since these are
 	   all in the last row and column of
 	   the matrix, simply redimension.   */
-	/* disp_matrix(normal_ptr,obs_ptr,obs_ptr,5);
-	 */
     }
 
     else {
-	G_ludcmp(normal_ptr, 6, index_ptr, &temp);
-	/* disp_matrix(normal_ptr,obs_ptr,obs_ptr,6);
-	 */
+	G_ludcmp(blk.normal, 6, blk.index, &temp);
     }
 
 
     /*--------------------------------------------------------------------------*/
-    /*          PROCESS INPUT RASTER AND WRITE OUT RASTER LINE BY LINE          */
+    /*          PROCESS INPUT RASTER AND WRITE OUT RASTER BLOCK BY BLOCK        */
 
     /*--------------------------------------------------------------------------*/
 
     if (mparam != FEATURE)
-	for (wind_row = 0; wind_row < EDGE; wind_row++)
-	    Rast_put_row(fd_out, row_out, DCELL_TYPE);	/* Write out the edge cells as NULL.    */
+	Rast_set_d_null_value(blk.out[0], ncols);
     else
-	for (wind_row = 0; wind_row < EDGE; wind_row++)
-	    Rast_put_row(fd_out, featrow_out, CELL_TYPE);	/* Write out the edge cells as NULL.    */
-
-    for (wind_row = 0; wind_row < wsize - 1; wind_row++)
-	Rast_get_row(fd_in, row_in + (wind_row * ncols), wind_row,
-			 DCELL_TYPE);
-    /* Read in enough of the first rows to  */
-    /* allow window to be examined.         */
+	Rast_set_c_null_value(blk.out[0], ncols);
 
-    for (row = EDGE; row < (nrows - EDGE); row++) {
-	G_percent(row + 1, nrows - EDGE, 2);
+    if (nrows < wsize) {
+	/* no complete window, everything is edge */
+	for (row = 0; row < nrows; row++)
+	    Rast_put_row(fd_out, blk.out[0], out_type);
+    }
+    else {
+	for (row = 0; row < EDGE; row++)
+	    Rast_put_row(fd_out, blk.out[0], out_type);	/* Write out the edge cells as NULL.    */
 
-	Rast_get_row(fd_in, row_in + ((wsize - 1) * ncols), row + EDGE,
-			 DCELL_TYPE);
+	for (i = 0; i < wsize - 1; i++)
+	    Rast_get_row(fd_in, blk.in[i], i, DCELL_TYPE);
+	/* Read in enough of the first rows to  */
+	/* allow window to be examined.         */
+    }
 
-	for (col = EDGE; col < (ncols - EDGE); col++) {
-	    /* Find central z value */
-	    centre = *(row_in + EDGE * ncols + col);
-	    /* Test for no data and propagate */
-	    if (Rast_is_d_null_value(&centre)) {
-		if (mparam == FEATURE)
-		    Rast_set_c_null_value(featrow_out + col, 1);
-		else {
-		    Rast_set_d_null_value(row_out + col, 1);
-		}
-		continue;
-	    }
-	    found_null = FALSE;
-	    for (wind_row = 0; wind_row < wsize; wind_row++) {
-		if (found_null)
-		    break;
-		for (wind_col = 0; wind_col < wsize; wind_col++) {
-
-		    /* Express all window values relative   */
-		    /* to the central elevation.            */
-		    window_cell = row_in + (wind_row * ncols) + col + wind_col - EDGE;
-		    /* Test for no data and propagate */
-		    if (Rast_is_d_null_value(window_cell)) {
-			if (mparam == FEATURE)
-			    Rast_set_c_null_value(featrow_out + col, 1);
-			else {
-			    Rast_set_d_null_value(row_out + col, 1);
-			}
-			found_null = TRUE;
-			break;
-		    }
-		    *(window_ptr + (wind_row * wsize) + wind_col) =
-			*(window_cell) - centre;
-		}
-	    }
+    nsum = 0;
+    for (row = EDGE; row < nrows - EDGE; row += n) {
+	G_percent(row - EDGE, nrows - 2 * EDGE, 2);
 
-	    if (found_null)
-		continue;
+	n = nrows - EDGE - row;
+	if (n > nblock)
+	    n = nblock;
 
-	    /*--- Use LU back substitution to solve normal equations. ---*/
-	    find_obs(window_ptr, obs_ptr, weight_ptr);
+	/* buffer row i holds input row row - EDGE + i */
+	for (i = wsize - 1; i < n + wsize - 1; i++)
+	    Rast_get_row(fd_in, blk.in[i], row - EDGE + i, DCELL_TYPE);
 
-	    /*      disp_wind(window_ptr); 
-	       disp_matrix(normal_ptr,obs_ptr,obs_ptr,6);
-	     */
+	if (blk.separable)
+	    G_parallel_for(nsum, n + wsize - 1, blk.chunk, horizontal_rows,
+			   &blk);
 
-	    if (constrained) {
-		G_lubksb(normal_ptr, 5, index_ptr, obs_ptr);
-		/*
-		   disp_matrix(normal_ptr,obs_ptr,obs_ptr,5);
-		 */
-	    }
+	G_parallel_for(0, n, blk.chunk, process_rows, &blk);
 
-	    else {
-		G_lubksb(normal_ptr, 6, index_ptr, obs_ptr);
-		/*      
-		   disp_matrix(normal_ptr,obs_ptr,obs_ptr,6);
-		 */
+	for (i = 0; i < n; i++)
+	    Rast_put_row(fd_out, blk.out[i], out_type);
 
-	    }
+	/* Move the rows shared with the next block to the front. */
+	for (i = 0; i < wsize - 1; i++) {
+	    DCELL *tmp = blk.in[i];
 
-	    /*--- Calculate terrain parameter based on quad. coefficients. ---*/
-	    if (mparam == FEATURE)
-		*(featrow_out + col) = (CELL) feature(obs_ptr);
-	    else
-		*(row_out + col) = param(mparam, obs_ptr);
+	    blk.in[i] = blk.in[i + n];
+	    blk.in[i + n] = tmp;
+	    for (j = 0; j < 3 && blk.separable; j++) {
+		double *htmp = blk.hsum[j][i];
 
-	    if (mparam == ELEV)
-		*(row_out + col) += centre;	/* Add central elevation back */
+		blk.hsum[j][i] = blk.hsum[j][i + n];
+		blk.hsum[j][i + n] = htmp;
+	    }
 	}
-
-	if (mparam != FEATURE)
-	    Rast_put_row(fd_out, row_out, DCELL_TYPE);	/* Write the row buffer to the output   */
-	/* raster.                              */
-	else			/* write FEATURE to CELL */
-	    Rast_put_row(fd_out, featrow_out, CELL_TYPE);	/* Write the row buffer to the output       */
-	/* raster.                              */
-
-	/* 'Shuffle' rows down one, and read in */
-	/*  one new row.                        */
-	for (wind_row = 0; wind_row < wsize - 1; wind_row++)
-	    for (col = 0; col < ncols; col++)
-		*(row_in + (wind_row * ncols) + col) =
-		    *(row_in + ((wind_row + 1) * ncols) + col);
+	nsum = wsize - 1;
     }
+    G_percent(1, 1, 1);
 
-    if (mparam != FEATURE)
-	Rast_set_d_null_value(row_out, ncols);
-    else
-	Rast_set_c_null_value(featrow_out, ncols);
-    for (wind_row = 0; wind_row < EDGE; wind_row++) {
+    if (nrows >= wsize) {
 	if (mparam != FEATURE)
-	    Rast_put_row(fd_out, row_out, DCELL_TYPE);	/* Write out the edge cells as NULL. */
+	    Rast_set_d_null_value(blk.out[0], ncols);
 	else
-	    Rast_put_row(fd_out, featrow_out, CELL_TYPE);	/* Write out the edge cells as NULL. */
+	    Rast_set_c_null_value(blk.out[0], ncols);
+	for (row = 0; row < EDGE; row++)
+	    Rast_put_row(fd_out, blk.out[0], out_type);	/* Write out the edge cells as NULL. */
     }
 
     /*--------------------------------------------------------------------------*/
@@ -271,14 +414,27 @@ void process(void)
 
     /*--------------------------------------------------------------------------*/
 
-    G_free(row_in);
-    if (mparam != FEATURE)
-	G_free(row_out);
-    else
-	G_free(featrow_out);
+    for (i = 0; i < nbuf; i++)
+	G_free(blk.in[i]);
+    G_free(blk.in);
+    for (j = 0; j < 3 && blk.separable; j++) {
+	for (i = 0; i < nbuf; i++)
+	    G_free(blk.hsum[j][i]);
+	G_free(blk.hsum[j]);
+    }
+    for (i = 0; i < nblock; i++)
+	G_free(blk.out[i]);
+    G_free(blk.out);
+    for (i = 0; i < nprocs; i++) {
+	G_free(blk.scratch[i].window);
+	for (j = 0; j < 6; j++)
+	    G_free(blk.scratch[i].sum[j]);
+    }
+    G_free(blk.scratch);
+    G_free(blk.coord);
+    G_free(blk.coord2);
 
-    G_free(window_ptr);
-    free_dmatrix(normal_ptr, 0, 5, 0, 5);
-    free_dvector(obs_ptr, 0, 5);
-    free_ivector(index_ptr, 0, 5);
+    G_free(blk.weight);
+    free_dmatrix(blk.normal, 0, 5, 0, 5);
+    free_ivector(blk.index, 0, 5);
 }
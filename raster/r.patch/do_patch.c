@@ -1,12 +1,11 @@
+#include <string.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
+#include "local_proto.h"
 /*
  * patch in non-zero data over zero data
  * keep track of the categories which are patched in
  * for later use in constructing the new category and color files
- *
- * returns: 1 the result still contains nulls
- *          0 the result contains no zero nulls
  */
 
 int is_zero_value(void *rast, RASTER_MAP_TYPE data_type)
@@ -18,46 +17,154 @@ int is_zero_value(void *rast, RASTER_MAP_TYPE data_type)
 	Rast_get_d_value(rast, data_type) != 0.0 ? 0 : 1;
 }
 
+/* skip the cells from col to last which are null (null = 1) or not
+   null (null = 0) */
+static int skip_cells(const void *buf, int col, int last,
+		      RASTER_MAP_TYPE type, int null)
+{
+    switch (type) {
+    case CELL_TYPE:{
+	    const CELL *c = buf;
+
+	    while (col <= last && Rast_is_c_null_value(&c[col]) == null)
+		col++;
+	    break;
+	}
+    case FCELL_TYPE:{
+	    const FCELL *f = buf;
+
+	    while (col <= last && Rast_is_f_null_value(&f[col]) == null)
+		col++;
+	    break;
+	}
+    default:{
+	    const DCELL *d = buf;
+
+	    while (col <= last && Rast_is_d_null_value(&d[col]) == null)
+		col++;
+	    break;
+	}
+    }
+
+    return col;
+}
 
-int do_patch(void *result, void *patch,
-	     struct Cell_stats *statf, int ncols,
-             RASTER_MAP_TYPE out_type, size_t out_cell_size, int use_zero)
+/* last column from col down to first which is null */
+static int last_null(const void *buf, int first, int col,
+		     RASTER_MAP_TYPE type)
 {
-    int more;
+    switch (type) {
+    case CELL_TYPE:{
+	    const CELL *c = buf;
 
-    more = 0;
-    while (ncols-- > 0) {
-	if (use_zero) {		/* use 0 for transparency instead of NULL */
+	    while (col >= first && !Rast_is_c_null_value(&c[col]))
+		col--;
+	    break;
+	}
+    case FCELL_TYPE:{
+	    const FCELL *f = buf;
+
+	    while (col >= first && !Rast_is_f_null_value(&f[col]))
+		col--;
+	    break;
+	}
+    default:{
+	    const DCELL *d = buf;
+
+	    while (col >= first && !Rast_is_d_null_value(&d[col]))
+		col--;
+	    break;
+	}
+    }
+
+    return col;
+}
+
+/*
+ * patch the columns first to last of the result
+ *
+ * Without use_zero, every run of nulls of the result is replaced by
+ * the same run of the patch as a whole, since copying nulls over nulls
+ * doesn't change anything.
+ */
+void do_patch(void *result, void *patch,
+	      struct Cell_stats *statf, int first, int last,
+	      RASTER_MAP_TYPE out_type, size_t out_cell_size, int use_zero)
+{
+    int col, start;
+
+    if (use_zero) {		/* use 0 for transparency instead of NULL */
+	result = G_incr_void_ptr(result, first * out_cell_size);
+	patch = G_incr_void_ptr(patch, first * out_cell_size);
+	for (col = first; col <= last; col++) {
 	    if (is_zero_value(result, out_type) ||
 		Rast_is_null_value(result, out_type)) {
-		/* Don't patch hole with a null, just mark as more */
-		if (Rast_is_null_value(patch, out_type))
-		    more = 1;
-		else {
-		    /* Mark that there is more to be done if we patch with 0 */
-		    if (is_zero_value(patch, out_type))
-			more = 1;
+		/* Don't patch hole with a null */
+		if (!Rast_is_null_value(patch, out_type)) {
 		    Rast_raster_cpy(result, patch, 1, out_type);
 		    if (out_type == CELL_TYPE)
 			Rast_update_cell_stats((CELL *) result, 1, statf);
 		}
 	    }			/* ZERO support */
+	    result = G_incr_void_ptr(result, out_cell_size);
+	    patch = G_incr_void_ptr(patch, out_cell_size);
 	}
+	return;
+    }
 
-	else {			/* use NULL for transparency instead of 0 */
+    /* use NULL for transparency instead of 0 */
+    for (col = first; col <= last;) {
+	col = skip_cells(result, col, last, out_type, 0);
+	start = col;
+	col = skip_cells(result, col, last, out_type, 1);
+	if (col == start)
+	    continue;
 
-	    if (Rast_is_null_value(result, out_type)) {
-		if (Rast_is_null_value(patch, out_type))
-		    more = 1;
-		else {
-		    Rast_raster_cpy(result, patch, 1, out_type);
-		    if (out_type == CELL_TYPE)
-			Rast_update_cell_stats((CELL *) result, 1, statf);
-		}
-	    }			/* NULL support */
+	memcpy(G_incr_void_ptr(result, start * out_cell_size),
+	       G_incr_void_ptr(patch, start * out_cell_size),
+	       (col - start) * out_cell_size);
+	/* nulls are not reported by the cell stats */
+	if (out_type == CELL_TYPE)
+	    Rast_update_cell_stats((CELL *) result + start, col - start,
+				   statf);
+    }
+}
+
+/*
+ * narrow the columns first to last of the result to those from the
+ * first to the last hole (null or, with use_zero, zero cell)
+ *
+ * returns: 1 the result still contains holes
+ *          0 the result contains no holes
+ */
+int find_holes(void *result, int *first, int *last,
+	       RASTER_MAP_TYPE out_type, size_t out_cell_size, int use_zero)
+{
+    int col;
+
+    if (use_zero) {
+	for (col = *first; col <= *last; col++) {
+	    void *cell = G_incr_void_ptr(result, col * out_cell_size);
+
+	    if (is_zero_value(cell, out_type) ||
+		Rast_is_null_value(cell, out_type))
+		break;
+	}
+	*first = col;
+	for (col = *last; col > *first; col--) {
+	    void *cell = G_incr_void_ptr(result, col * out_cell_size);
+
+	    if (is_zero_value(cell, out_type) ||
+		Rast_is_null_value(cell, out_type))
+		break;
 	}
-        result = G_incr_void_ptr(result, out_cell_size);
-        patch = G_incr_void_ptr(patch, out_cell_size);
+	*last = col;
     }
-    return more;
+    else {
+	*first = skip_cells(result, *first, *last, out_type, 0);
+	if (*first <= *last)
+	    *last = last_null(result, *first, *last, out_type);
+    }
+
+    return *first <= *last;
 }
@@ -1,6 +1,8 @@
 /* do_patch.c */
-int do_patch(void *result, void *, struct Cell_stats *, int, RASTER_MAP_TYPE,
-             size_t, int);
+int is_zero_value(void *, RASTER_MAP_TYPE);
+void do_patch(void *, void *, struct Cell_stats *, int, int,
+	      RASTER_MAP_TYPE, size_t, int);
+int find_holes(void *, int *, int *, RASTER_MAP_TYPE, size_t, int);
 /* support.c */
 int support(char **, struct Cell_stats *, int, struct Categories *,
 	    int *, struct Colors *, int *, RASTER_MAP_TYPE);
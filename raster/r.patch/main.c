@@ -19,14 +19,70 @@
  *****************************************************************************/
 #include <stdlib.h>
 #include <unistd.h>
+#include <math.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/glocale.h>
 #include "local_proto.h"
 
+/* the input maps are opened only while the current row intersects
+   them, so that mosaics of many tiles don't need all tiles open */
+struct input
+{
+    const char *name;
+    int fd;			/* -1 if not open */
+    int row_first, row_last;	/* rows and columns of the region */
+    int col_first, col_last;	/* intersecting the map */
+};
+
+static struct input *inputs;
+
+static int cmp_first_row(const void *aa, const void *bb)
+{
+    int a = *(const int *)aa;
+    int b = *(const int *)bb;
+
+    if (inputs[a].row_first != inputs[b].row_first)
+	return inputs[a].row_first < inputs[b].row_first ? -1 : 1;
+
+    return a - b;
+}
+
+static void get_extent(struct input *in, const struct Cell_head *cellhd,
+		       const struct Cell_head *window)
+{
+    int nrows = window->rows, ncols = window->cols;
+
+    in->row_first = (int)floor((window->north - cellhd->north) /
+			       window->ns_res);
+    in->row_last = (int)ceil((window->north - cellhd->south) /
+			     window->ns_res) - 1;
+    if (in->row_first < 0)
+	in->row_first = 0;
+    if (in->row_last > nrows - 1)
+	in->row_last = nrows - 1;
+
+    /* maps can wrap around the globe */
+    if (window->proj == PROJECTION_LL) {
+	in->col_first = 0;
+	in->col_last = ncols - 1;
+	return;
+    }
+
+    in->col_first = (int)floor((cellhd->west - window->west) /
+			       window->ew_res);
+    in->col_last = (int)ceil((cellhd->east - window->west) /
+			     window->ew_res) - 1;
+    if (in->col_first < 0)
+	in->col_first = 0;
+    if (in->col_last > ncols - 1)
+	in->col_last = ncols - 1;
+    if (in->col_first > in->col_last)
+	in->row_last = -1;
+}
+
 int main(int argc, char *argv[])
 {
-    int *infd;
     struct Categories cats;
     struct Cell_stats *statf;
     struct Colors colr;
@@ -39,18 +95,20 @@ int main(int argc, char *argv[])
     void *presult, *patch;
     int nfiles;
     char *rname;
-    int i;
+    int i, j, next, nactive;
+    int *order, *active;
     int row, nrows, ncols;
+    int nprocs;
     int use_zero, no_support;
     char *new_name;
     char **names;
     char **ptr;
     struct Cell_head window;
-    struct Cell_head *cellhd;
+    struct Cell_head cellhd;
 
     struct GModule *module;
     struct Flag *zeroflag, *nosupportflag;
-    struct Option *opt1, *opt2;
+    struct Option *opt1, *opt2, *opt3;
 
     G_gisinit(argv[0]);
 
@@ -75,6 +133,8 @@ int main(int argc, char *argv[])
     opt2 = G_define_standard_option(G_OPT_R_OUTPUT);
     opt2->description = _("Name for resultant raster map");
 
+    opt3 = G_define_standard_option(G_OPT_M_NPROCS);
+
     /* Define the different flags */
 
     zeroflag = G_define_flag();
@@ -92,6 +152,7 @@ int main(int argc, char *argv[])
 
     use_zero = (zeroflag->answer);
     no_support = (nosupportflag->answer);
+    nprocs = G_set_nprocs(opt3);
 
     names = opt1->answers;
 
@@ -102,19 +163,19 @@ int main(int argc, char *argv[])
     if (nfiles < 2)
 	G_fatal_error(_("The minimum number of input raster maps is two"));
 
-    infd = G_malloc(nfiles * sizeof(int));
+    inputs = G_malloc(nfiles * sizeof(struct input));
+    order = G_malloc(nfiles * sizeof(int));
+    active = G_malloc(nfiles * sizeof(int));
     statf = G_malloc(nfiles * sizeof(struct Cell_stats));
-    cellhd = G_malloc(nfiles * sizeof(struct Cell_head));
+
+    Rast_get_window(&window);
+    nrows = Rast_window_rows();
+    ncols = Rast_window_cols();
 
     for (i = 0; i < nfiles; i++) {
 	const char *name = names[i];
-	int fd;
-
-	fd = Rast_open_old(name, "");
 
-	infd[i] = fd;
-
-	map_type = Rast_get_map_type(fd);
+	map_type = Rast_map_type(name, "");
 	if (map_type == FCELL_TYPE && out_type == CELL_TYPE)
 	    out_type = FCELL_TYPE;
 	else if (map_type == DCELL_TYPE)
@@ -122,8 +183,13 @@ int main(int argc, char *argv[])
 
 	Rast_init_cell_stats(&statf[i]);
 
-	Rast_get_cellhd(name, "", &cellhd[i]);
+	Rast_get_cellhd(name, "", &cellhd);
+	inputs[i].name = name;
+	inputs[i].fd = -1;
+	get_extent(&inputs[i], &cellhd, &window);
+	order[i] = i;
     }
+    qsort(order, nfiles, sizeof(int), cmp_first_row);
 
     out_cell_size = Rast_cell_size(out_type);
 
@@ -133,34 +199,59 @@ int main(int argc, char *argv[])
     presult = Rast_allocate_buf(out_type);
     patch = Rast_allocate_buf(out_type);
 
-    Rast_get_window(&window);
-    nrows = Rast_window_rows();
-    ncols = Rast_window_cols();
-
     G_verbose_message(_("Percent complete..."));
+    next = nactive = 0;
     for (row = 0; row < nrows; row++) {
-	double north_edge, south_edge;
+	int first, last;
 
 	G_percent(row, nrows, 2);
-	Rast_get_row(infd[0], presult, row, out_type);
-
-	north_edge = Rast_row_to_northing(row, &window);
-	south_edge = north_edge - window.ns_res;
-
-	if (out_type == CELL_TYPE)
-	    Rast_update_cell_stats((CELL *) presult, ncols, &statf[0]);
-	for (i = 1; i < nfiles; i++) {
-	    /* check if raster i overlaps with the current row */
-	    if (south_edge >= cellhd[i].north ||
-		north_edge <= cellhd[i].south ||
-		window.west >= cellhd[i].east ||
-		window.east <= cellhd[i].west)
+
+	/* keep the maps intersecting the row in the order of priority */
+	for (i = j = 0; i < nactive; i++) {
+	    struct input *in = &inputs[active[i]];
+
+	    if (in->row_last >= row)
+		active[j++] = active[i];
+	    else if (in->fd >= 0) {
+		Rast_close(in->fd);
+		in->fd = -1;
+	    }
+	}
+	nactive = j;
+	while (next < nfiles && inputs[order[next]].row_first <= row) {
+	    int k = order[next++];
+
+	    if (inputs[k].row_last < row)
+		continue;
+	    for (j = nactive++; j > 0 && active[j - 1] > k; j--)
+		active[j] = active[j - 1];
+	    active[j] = k;
+	}
+
+	Rast_set_null_value(presult, ncols, out_type);
+	first = 0;
+	last = ncols - 1;
+
+	for (j = 0; j < nactive; j++) {
+	    struct input *in = &inputs[active[j]];
+
+	    /* the map doesn't cover any of the remaining holes */
+	    if (in->col_last < first || in->col_first > last)
 		continue;
 
-	    Rast_get_row(infd[i], patch, row, out_type);
-	    if (!do_patch
-                (presult, patch, &statf[i], ncols, out_type, out_cell_size,
-                 use_zero))
+	    if (in->fd < 0) {
+		in->fd = Rast_open_old(in->name, "");
+		if (nprocs > 1)
+		    Rast_set_read_ahead(in->fd, 2);
+	    }
+
+	    Rast_get_row(in->fd, patch, row, out_type);
+	    do_patch(presult, patch, &statf[active[j]],
+		     in->col_first > first ? in->col_first : first,
+		     in->col_last < last ? in->col_last : last,
+		     out_type, out_cell_size, use_zero);
+	    if (!find_holes(presult, &first, &last, out_type, out_cell_size,
+			    use_zero))
 		break;
 	}
 	Rast_put_row(outfd, presult, out_type);
@@ -169,8 +260,9 @@ int main(int argc, char *argv[])
 
     G_free(patch);
     G_free(presult);
-    for (i = 0; i < nfiles; i++)
-	Rast_close(infd[i]);
+    for (i = 0; i < nactive; i++)
+	if (inputs[active[i]].fd >= 0)
+	    Rast_close(inputs[active[i]].fd);
 
     if(!no_support) {
         /* 
@@ -0,0 +1,152 @@
+/*
+ * approx.c - transformation of the cell centers of a whole output row
+ *
+ * The cell centers of one output row are projected to the input
+ * location either exactly, with one call of GPJ_transform_array() for
+ * the whole row, or approximately: the row is split recursively until
+ * linear interpolation between the end points of a segment differs
+ * from the exact transformation of its middle point by no more than
+ * the given threshold (in input cells), like GDAL's approximating
+ * transformer does.
+ */
+
+#include <math.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/gprojects.h>
+#include <grass/glocale.h>
+#include "r.proj.h"
+
+struct row_info
+{
+    const struct pj_info *iproj, *oproj, *tproj;
+    double x0, dx, y;
+    double threshold;
+    const struct Cell_head *incellhd;
+    double *xs, *ys;
+};
+
+static int transform_point(const struct row_info *r, int col)
+{
+    r->xs[col] = r->x0 + col * r->dx;
+    r->ys[col] = r->y;
+
+    if (GPJ_transform(r->iproj, r->oproj, r->tproj, PJ_INV,
+		      &r->xs[col], &r->ys[col], NULL) < 0) {
+	G_warning(_("Error in %s"), "GPJ_transform()");
+	Rast_set_d_null_value(&r->xs[col], 1);
+	Rast_set_d_null_value(&r->ys[col], 1);
+	return -1;
+    }
+
+    return 0;
+}
+
+static void transform_exact(const struct row_info *r, int first, int last)
+{
+    int col;
+
+    for (col = first; col <= last; col++)
+	transform_point(r, col);
+}
+
+static void transform_segment(const struct row_info *r, int a, int b)
+{
+    /* a and b are already transformed and valid */
+    int col, m = (a + b) / 2;
+    double t, err_x, err_y;
+
+    if (b - a < 2)
+	return;
+
+    if (transform_point(r, m) < 0) {
+	transform_exact(r, a + 1, m - 1);
+	transform_exact(r, m + 1, b - 1);
+	return;
+    }
+
+    t = (double)(m - a) / (b - a);
+    err_x = fabs(r->xs[a] + t * (r->xs[b] - r->xs[a]) - r->xs[m]) /
+	r->incellhd->ew_res;
+    err_y = fabs(r->ys[a] + t * (r->ys[b] - r->ys[a]) - r->ys[m]) /
+	r->incellhd->ns_res;
+
+    if (err_x <= r->threshold && err_y <= r->threshold) {
+	for (col = a + 1; col < b; col++) {
+	    if (col == m)
+		continue;
+	    t = (double)(col - a) / (b - a);
+	    r->xs[col] = r->xs[a] + t * (r->xs[b] - r->xs[a]);
+	    r->ys[col] = r->ys[a] + t * (r->ys[b] - r->ys[a]);
+	}
+	return;
+    }
+
+    transform_segment(r, a, m);
+    transform_segment(r, m, b);
+}
+
+/*!
+ * \brief Project the cell centers of one output row to input indices
+ *
+ * \param x0 easting of the center of the first cell
+ * \param dx east-west resolution of the output region
+ * \param y northing of the row
+ * \param n number of cells
+ * \param threshold maximum error in input cells, 0 for exact
+ * \param incellhd input region
+ * \param[out] col_idx column index in input matrix, NULL on failure
+ * \param[out] row_idx row index in input matrix, NULL on failure
+ *
+ * \return 0
+ */
+int transform_row(const struct pj_info *iproj, const struct pj_info *oproj,
+		  const struct pj_info *tproj, double x0, double dx,
+		  double y, int n, double threshold,
+		  const struct Cell_head *incellhd,
+		  double *col_idx, double *row_idx)
+{
+    struct row_info r;
+    int col;
+
+    r.iproj = iproj;
+    r.oproj = oproj;
+    r.tproj = tproj;
+    r.x0 = x0;
+    r.dx = dx;
+    r.y = y;
+    r.threshold = threshold;
+    r.incellhd = incellhd;
+    r.xs = col_idx;
+    r.ys = row_idx;
+
+    if (threshold > 0) {
+	int first = transform_point(&r, 0);
+	int last = n > 1 ? transform_point(&r, n - 1) : first;
+
+	if (first < 0 || last < 0)
+	    transform_exact(&r, 1, n - 2);
+	else
+	    transform_segment(&r, 0, n - 1);
+    }
+    else {
+	for (col = 0; col < n; col++) {
+	    col_idx[col] = x0 + col * dx;
+	    row_idx[col] = y;
+	}
+	/* on failure the row is repeated point by point as before */
+	if (GPJ_transform_array(iproj, oproj, tproj, PJ_INV,
+				col_idx, row_idx, NULL, n) < 0)
+	    transform_exact(&r, 0, n - 1);
+    }
+
+    /* convert to row/column indices of input matrix */
+    for (col = 0; col < n; col++) {
+	if (Rast_is_d_null_value(&col_idx[col]))
+	    continue;
+	col_idx[col] = (col_idx[col] - incellhd->west) / incellhd->ew_res;
+	row_idx[col] = (incellhd->north - row_idx[col]) / incellhd->ns_res;
+    }
+
+    return 0;
+}
@@ -76,9 +76,51 @@ struct menu menu[] = {
     {NULL, NULL, NULL}
 };
 
+/* the output rows of a band */
+struct band
+{
+    struct cache **caches;	/* per thread views of the input map */
+    func interpolate;
+    void *obuffer;
+    int cell_type;
+    size_t cell_size;
+    const double *col_idx, *row_idx;
+    struct Cell_head *incellhd;
+    int cols;
+    int band_start;
+    int chunk;			/* rows of a thread */
+};
+
 static char *make_ipol_list(void);
 static char *make_ipol_desc(void);
 
+/* resample the rows first to last - 1 of a band; the input indices are
+ * shared and only read, each thread reads the input map through its own
+ * cache and writes its own rows of the output buffer */
+static void resample_rows(int first, int last, void *closure)
+{
+    const struct band *bd = closure;
+    struct cache *cache = bd->caches[(first - bd->band_start) / bd->chunk];
+    int row, col;
+
+    for (row = first; row < last; row++) {
+	size_t offset = (size_t) (row - bd->band_start) * bd->cols;
+
+	for (col = 0; col < bd->cols; col++) {
+	    void *obufptr =
+		(void *)((unsigned char *)bd->obuffer +
+			 (offset + col) * bd->cell_size);
+
+	    if (Rast_is_d_null_value(&bd->col_idx[offset + col]))
+		Rast_set_null_value(obufptr, 1, bd->cell_type);
+	    else
+		bd->interpolate(cache, obufptr, bd->cell_type,
+				bd->col_idx[offset + col],
+				bd->row_idx[offset + col], bd->incellhd);
+	}
+    }
+}
+
 int main(int argc, char **argv)
 {
     char *mapname,		/* ptr to name of output layer  */
@@ -95,11 +137,19 @@ int main(int argc, char **argv)
       irows, icols,		/* original rows, cols          */
       orows, ocols, have_colors,	/* Input map has a colour table */
       overwrite,		/* Overwrite                    */
-      curr_proj;		/* output projection (see gis.h) */
+      curr_proj,		/* output projection (see gis.h) */
+      threads,			/* number of threads            */
+      band_rows,		/* number of rows in one band   */
+      band_start, band_end;	/* first and last + 1 band row  */
 
-    void *obuffer;		/* buffer that holds one output row     */
+    void *obuffer;		/* buffer that holds a band of output rows */
+    double *col_idx,		/* input column indices of a band */
+     *row_idx;			/* input row indices of a band  */
+    double threshold;		/* error of approximate transformation */
 
     struct cache *ibuffer;	/* buffer that holds the input map      */
+    struct cache **caches;	/* per thread views of ibuffer  */
+    struct band bd;		/* band resampled by the threads */
     func interpolate;		/* interpolation routine        */
 
     double xcoord2,		/* temporary x coordinates      */
@@ -133,7 +183,9 @@ int main(int argc, char **argv)
      *indbase,			/* name of input database       */
      *interpol,			/* interpolation method         */
      *memory,			/* amount of memory for cache   */
-     *res;			/* resolution of target map     */
+     *res,			/* resolution of target map     */
+     *error,			/* approximation threshold      */
+     *nprocs;			/* number of threads            */
 #ifdef HAVE_PROJ_H
     struct Option *pipeline;	/* name of custom PROJ pipeline */
 #endif
@@ -201,6 +253,19 @@ int main(int argc, char **argv)
     res->description = _("Resolution of output raster map");
     res->guisection = _("Target");
 
+    error = G_define_option();
+    error->key = "error";
+    error->type = TYPE_DOUBLE;
+    error->required = NO;
+    error->answer = "0";
+    error->label =
+	_("Error threshold for approximate transformation (in input cells)");
+    error->description =
+	_("Zero transforms every cell exactly");
+    error->guisection = _("Target");
+
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
 #ifdef HAVE_PROJ_H
     pipeline = G_define_option();
     pipeline->key = "pipeline";
@@ -238,6 +303,11 @@ int main(int argc, char **argv)
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    threads = G_set_nprocs(nprocs);
+
+    threshold = atof(error->answer);
+    if (threshold < 0)
+	G_fatal_error(_("<%s> must be zero or positive"), error->key);
 
     /* get the method */
     for (method = 0; (ipolname = menu[method].name); method++)
@@ -494,74 +564,87 @@ int main(int argc, char **argv)
     Rast_set_input_window(&incellhd);
     fdi = Rast_open_old(inmap->answer, setname);
     cell_type = Rast_get_map_type(fdi);
-    ibuffer = readcell(fdi, memory->answer);
+    ibuffer = readcell(fdi, memory->answer, threads);
     Rast_close(fdi);
 
     G_switch_env();
     Rast_set_output_window(&outcellhd);
 
-    if (strcmp(interpol->answer, "nearest") == 0) {
+    /* output rows are processed in bands, the cell centers of a band
+     * are projected first and then interpolated by all threads */
+    band_rows = 16 * threads;
+    if (band_rows > outcellhd.rows)
+	band_rows = outcellhd.rows;
+
+    if (strcmp(interpol->answer, "nearest") == 0)
 	fdo = Rast_open_new(mapname, cell_type);
-	obuffer = (CELL *) Rast_allocate_output_buf(cell_type);
-    }
     else {
 	fdo = Rast_open_fp_new(mapname);
 	cell_type = FCELL_TYPE;
-	obuffer = (FCELL *) Rast_allocate_output_buf(cell_type);
     }
 
     cell_size = Rast_cell_size(cell_type);
+    obuffer = G_malloc((size_t) band_rows * outcellhd.cols * cell_size);
+    col_idx = G_malloc((size_t) band_rows * outcellhd.cols * sizeof(double));
+    row_idx = G_malloc((size_t) band_rows * outcellhd.cols * sizeof(double));
+
+    caches = G_malloc(threads * sizeof(struct cache *));
+    caches[0] = ibuffer;
+    for (col = 1; col < threads; col++)
+	caches[col] = clone_cache(ibuffer, col);
+
+    bd.caches = caches;
+    bd.interpolate = interpolate;
+    bd.obuffer = obuffer;
+    bd.cell_type = cell_type;
+    bd.cell_size = cell_size;
+    bd.col_idx = col_idx;
+    bd.row_idx = row_idx;
+    bd.incellhd = &incellhd;
+    bd.cols = outcellhd.cols;
 
     xcoord2 = outcellhd.west + (outcellhd.ew_res / 2);
     ycoord2 = outcellhd.north - (outcellhd.ns_res / 2);
 
     G_important_message(_("Projecting..."));
-    for (row = 0; row < outcellhd.rows; row++) {
-	/* obufptr = obuffer */;
-
-        G_percent(row, outcellhd.rows - 1, 2);
-
-#if 0
-	/* parallelization does not always work,
-	 * segfaults in the interpolation functions 
-	 * can happen */
-        #pragma omp parallel for schedule (static)
-#endif
-
-	for (col = 0; col < outcellhd.cols; col++) {
-	    void *obufptr = (void *)((const unsigned char *)obuffer + col * cell_size);
-
-	    double xcoord1 = xcoord2 + (col) * outcellhd.ew_res;
-	    double ycoord1 = ycoord2;
-
-	    /* project coordinates in output matrix to       */
-	    /* coordinates in input matrix                   */
-	    if (GPJ_transform(&iproj, &oproj, &tproj, PJ_INV,
-			      &xcoord1, &ycoord1, NULL) < 0) {
-		G_warning(_("Error in %s"), "GPJ_transform()");
-		Rast_set_null_value(obufptr, 1, cell_type);
-	    }
-	    else {
-		/* convert to row/column indices of input matrix */
-
-		/* column index in input matrix */
-		double col_idx = (xcoord1 - incellhd.west) / incellhd.ew_res;
-		/* row index in input matrix    */
-		double row_idx = (incellhd.north - ycoord1) / incellhd.ns_res;
-
-		/* and resample data point               */
-		interpolate(ibuffer, obufptr, cell_type,
-			    col_idx, row_idx, &incellhd);
-	    }
-
-	    /* obufptr = G_incr_void_ptr(obufptr, cell_size); */
+    for (band_start = 0; band_start < outcellhd.rows;
+	 band_start += band_rows) {
+	band_end = band_start + band_rows;
+	if (band_end > outcellhd.rows)
+	    band_end = outcellhd.rows;
+
+	G_percent(band_start, outcellhd.rows, 2);
+
+	/* project coordinates in output matrix to       */
+	/* coordinates in input matrix                   */
+	for (row = band_start; row < band_end; row++) {
+	    size_t offset = (size_t) (row - band_start) * outcellhd.cols;
+
+	    transform_row(&iproj, &oproj, &tproj, xcoord2, outcellhd.ew_res,
+			  ycoord2, outcellhd.cols, threshold, &incellhd,
+			  &col_idx[offset], &row_idx[offset]);
+	    ycoord2 -= outcellhd.ns_res;
 	}
 
-	Rast_put_row(fdo, obuffer, cell_type);
+	/* and resample data points               */
+	bd.band_start = band_start;
+	bd.chunk = (band_end - band_start + threads - 1) / threads;
+	G_parallel_for(band_start, band_end, bd.chunk, resample_rows, &bd);
 
-	xcoord2 = outcellhd.west + (outcellhd.ew_res / 2);
-	ycoord2 -= outcellhd.ns_res;
+	for (row = band_start; row < band_end; row++)
+	    Rast_put_row(fdo, (unsigned char *)obuffer +
+			 (size_t) (row - band_start) * outcellhd.cols *
+			 cell_size, cell_type);
     }
+    G_percent(1, 1, 1);
+
+    for (col = 1; col < threads; col++)
+	if (caches[col] != ibuffer)
+	    release_cache(caches[col]);
+    G_free(caches);
+    G_free(obuffer);
+    G_free(col_idx);
+    G_free(row_idx);
 
     Rast_close(fdo);
     release_cache(ibuffer);
@@ -19,10 +19,13 @@ struct cache
     int fd;
     char *fname;
     int stride;
-    int nblocks;
+    int ngrid;			/* number of blocks in the map */
+    int nblocks;		/* number of blocks kept in memory */
     block **grid;
     block *blocks;
     int *refs;
+    unsigned int seed;		/* state of block replacement */
+    int owner;			/* removes the temporary file */
 };
 
 typedef void (*func) (struct cache *, void *, int, double, double,
@@ -41,10 +44,16 @@ extern void bordwalk(const struct Cell_head *, struct Cell_head *,
 extern void bordwalk_edge(const struct Cell_head *, struct Cell_head *,
 		          const struct pj_info *, const struct pj_info *,
 			  const struct pj_info *, int);
-extern struct cache *readcell(int, const char *);
+extern struct cache *readcell(int, const char *, int);
+extern struct cache *clone_cache(struct cache *, unsigned int);
 extern block *get_block(struct cache *, int);
 extern void release_cache(struct cache *);
 
+/* approx.c */
+extern int transform_row(const struct pj_info *, const struct pj_info *,
+			 const struct pj_info *, double, double, double, int,
+			 double, const struct Cell_head *, double *, double *);
+
 /* declare resampling methods */
 /* bilinear.c */
 extern void p_bilinear(struct cache *, void *, int, double, double,
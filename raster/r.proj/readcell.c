@@ -15,7 +15,7 @@
 #include <grass/glocale.h>
 #include "r.proj.h"
 
-struct cache *readcell(int fdi, const char *size)
+struct cache *readcell(int fdi, const char *size, int nthreads)
 {
     FCELL *tmpbuf;
     struct cache *c;
@@ -24,10 +24,9 @@ struct cache *readcell(int fdi, const char *size)
     int row;
     int nx, ny;
     int nblocks;
+    int partial;
     int i;
 
-    G_srand48(0);
-
     nrows = Rast_input_window_rows();
     ncols = Rast_input_window_cols();
 
@@ -39,17 +38,29 @@ struct cache *readcell(int fdi, const char *size)
     else
 	nblocks = (nx + ny) * 2;	/* guess */
 
-    if (nblocks > nx * ny)
+    if (nblocks >= nx * ny) {
 	nblocks = nx * ny;
+	partial = 0;
+    }
+    else {
+	partial = 1;
+	/* every thread gets its own share of the cache, see clone_cache() */
+	nblocks /= nthreads;
+	if (nblocks < 1)
+	    nblocks = 1;
+    }
 
     c = G_malloc(sizeof(struct cache));
     c->stride = nx;
+    c->ngrid = nx * ny;
     c->nblocks = nblocks;
+    c->seed = 0;
+    c->owner = 1;
     c->grid = (block **) G_calloc(nx * ny, sizeof(block *));
     c->blocks = (block *) G_malloc(nblocks * sizeof(block));
     c->refs = (int *)G_calloc(nblocks, sizeof(int));
 
-    if (nblocks < nx * ny) {
+    if (partial) {
 	/* Temporary file must be created in output location */
 	G_switch_env();
 	c->fname = G_tempfile();
@@ -62,7 +73,8 @@ struct cache *readcell(int fdi, const char *size)
 	c->fd = -1;
 	c->fname = NULL;
     }
-    G_verbose_message("%.2f percent are kept in memory", 100.0 * nblocks / (nx * ny));
+    G_verbose_message("%.2f percent are kept in memory",
+		      100.0 * nblocks * (partial ? nthreads : 1) / (nx * ny));
 
     G_important_message(_("Allocating memory and reading input raster map..."));
     
@@ -116,14 +128,20 @@ struct cache *readcell(int fdi, const char *size)
 block *get_block(struct cache * c, int idx)
 {
     int fd;
-    int replace = G_lrand48() % c->nblocks;
-    block *p = &c->blocks[replace];
-    int ref = c->refs[replace];
+    int replace;
+    block *p;
+    int ref;
     off_t offset = (off_t) idx * sizeof(FCELL) << L2BSIZE;
 
     if (c->fname == NULL)
 	G_fatal_error(_("Internal error: cache miss on fully-cached map"));
 
+    /* random replacement with a per cache generator (thread safe) */
+    c->seed = c->seed * 1103515245 + 12345;
+    replace = (c->seed >> 16) % c->nblocks;
+    p = &c->blocks[replace];
+    ref = c->refs[replace];
+
     fd = open(c->fname, O_RDONLY, 0600);
     if (fd < 0)
 	G_fatal_error(_("Unable to open temporary file"));
@@ -145,11 +163,35 @@ block *get_block(struct cache * c, int idx)
     return p;
 }
 
+struct cache *clone_cache(struct cache *c, unsigned int seed)
+{
+    /* A fully cached map is read-only and can be shared by all threads.
+     * Otherwise the clone has its own blocks on the same temporary file. */
+    struct cache *n;
+    int i;
+
+    if (c->fname == NULL)
+	return c;
+
+    n = G_malloc(sizeof(struct cache));
+    *n = *c;
+    n->seed = seed;
+    n->owner = 0;
+    n->grid = (block **) G_calloc(c->ngrid, sizeof(block *));
+    n->blocks = (block *) G_malloc(c->nblocks * sizeof(block));
+    n->refs = (int *)G_calloc(c->nblocks, sizeof(int));
+    for (i = 0; i < n->nblocks; i++)
+	n->refs[i] = -1;
+
+    return n;
+}
+
 void release_cache(struct cache *c)
 {
     G_free(c->grid);
     G_free(c->blocks);
     G_free(c->refs);
-    remove(c->fname);
+    if (c->owner && c->fname)
+	remove(c->fname);
     G_free(c);
 }
@@ -16,8 +16,11 @@
 #include <math.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
+#include <grass/stats.h>
 #include <grass/glocale.h>
 
+#define BLOCK_ROWS 16
+
 /* TODO: replace long with either size_t or a guaranteed 64 bit integer */
 struct bin
 {
@@ -245,17 +248,116 @@ static void compute_quantiles(int recode)
 	printf("%f:%f:%i\n", prev_v, max, num_quants + 1);
 }
 
+/* a block of rows added to the digests of several threads */
+struct block
+{
+    DCELL **rows;
+    int chunk;			/* rows per thread */
+    struct stat_tdigest **digests;	/* by thread */
+};
+
+static void digest_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct stat_tdigest *td = blk->digests[first / blk->chunk];
+    int row, col;
+
+    for (row = first; row < last; row++) {
+	const DCELL *inbuf = blk->rows[row];
+
+	for (col = 0; col < cols; col++)
+	    if (!Rast_is_d_null_value(&inbuf[col]))
+		stat_tdigest_add(td, inbuf[col]);
+    }
+}
+
+/* one pass: approximate quantiles from t-digests of the row bands
+   read by each thread */
+static void approx_quantiles(int infile, int nprocs, int compression,
+			     int recode)
+{
+    int nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    struct block blk;
+    int row, i;
+
+    G_message(_("Computing approximate quantiles"));
+
+    blk.rows = G_malloc(nblock * sizeof(DCELL *));
+    for (i = 0; i < nblock; i++)
+	blk.rows[i] = Rast_allocate_d_buf();
+    blk.digests = G_malloc(nprocs * sizeof(struct stat_tdigest *));
+    for (i = 0; i < nprocs; i++)
+	blk.digests[i] = stat_tdigest_create(compression);
+
+    if (nprocs > 1)
+	Rast_set_read_ahead(infile, nblock);
+
+    for (row = 0; row < rows; row += nblock) {
+	int n = rows - row < nblock ? rows - row : nblock;
+
+	for (i = 0; i < n; i++)
+	    Rast_get_d_row(infile, blk.rows[i], row + i);
+
+	blk.chunk = (n + nprocs - 1) / nprocs;
+	G_parallel_for(0, n, blk.chunk, digest_rows, &blk);
+
+	G_percent(row, rows, 2);
+    }
+    G_percent(rows, rows, 2);
+
+    if (nprocs > 1)
+	Rast_set_read_ahead(infile, 0);
+
+    for (i = 1; i < nprocs; i++) {
+	stat_tdigest_merge(blk.digests[0], blk.digests[i]);
+	stat_tdigest_destroy(blk.digests[i]);
+    }
+
+    total = (unsigned long)stat_tdigest_count(blk.digests[0]);
+    G_debug(1, "Number of values: %lu", total);
+
+    if (total > 0) {
+	double prev_v = min = stat_tdigest_quantile(blk.digests[0], 0);
+	int quant;
+
+	max = stat_tdigest_quantile(blk.digests[0], 1);
+
+	for (quant = 0; quant < num_quants; quant++) {
+	    double v = stat_tdigest_quantile(blk.digests[0], quants[quant]);
+
+	    if (recode)
+		fprintf(stdout, "%f:%f:%i\n", prev_v, v, quant + 1);
+	    else
+		fprintf(stdout, "%d:%f:%f\n", quant, 100 * quants[quant], v);
+
+	    prev_v = v;
+	}
+
+	if (recode)
+	    printf("%f:%f:%i\n", prev_v, max, num_quants + 1);
+    }
+    else
+	G_warning(_("No non-null values"));
+
+    stat_tdigest_destroy(blk.digests[0]);
+    for (i = 0; i < nblock; i++)
+	G_free(blk.rows[i]);
+    G_free(blk.rows);
+    G_free(blk.digests);
+}
+
 int main(int argc, char *argv[])
 {
     struct GModule *module;
     struct
     {
-	struct Option *input, *quant, *perc, *slots, *file;
+	struct Option *input, *quant, *perc, *slots, *file, *nprocs,
+	    *compression;
     } opt;
     struct {
-	struct Flag *r;
+	struct Flag *r, *a;
     } flag;
-    int recode;
+    int recode, nprocs;
     int infile;
     struct FPRange range;
 
@@ -301,10 +403,27 @@ int main(int argc, char *argv[])
     flag.r = G_define_flag();
     flag.r->key = 'r';
     flag.r->description = _("Generate recode rules based on quantile-defined intervals");
+
+    opt.compression = G_define_option();
+    opt.compression->key = "compression";
+    opt.compression->type = TYPE_INTEGER;
+    opt.compression->required = NO;
+    opt.compression->description =
+	_("Number of centroids of the approximate quantiles (-a)");
+    opt.compression->answer = "500";
+
+    opt.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
+    flag.a = G_define_flag();
+    flag.a->key = 'a';
+    flag.a->description =
+	_("Compute approximate quantiles in one pass with bounded memory");
  
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    nprocs = G_set_nprocs(opt.nprocs);
+
     num_slots = atoi(opt.slots->answer);
     recode = flag.r->answer;
 
@@ -338,6 +457,16 @@ int main(int argc, char *argv[])
 
     infile = Rast_open_old(opt.input->answer, "");
 
+    rows = Rast_window_rows();
+    cols = Rast_window_cols();
+
+    if (flag.a->answer) {
+	approx_quantiles(infile, nprocs, atoi(opt.compression->answer),
+			 recode);
+	Rast_close(infile);
+	return (EXIT_SUCCESS);
+    }
+
     Rast_read_fp_range(opt.input->answer, "", &range);
     Rast_get_fp_range_min_max(&range, &min, &max);
 
@@ -346,9 +475,6 @@ int main(int argc, char *argv[])
 
     slot_size = (max - min) / num_slots;
 
-    rows = Rast_window_rows();
-    cols = Rast_window_cols();
-
     get_slot_counts(infile);
 
     bins = G_calloc(num_quants, sizeof(struct bin));
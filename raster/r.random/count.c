@@ -1,7 +1,6 @@
 #include <limits.h>
 #include <float.h>
 #include <math.h>
-#include <unistd.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/glocale.h>
@@ -12,13 +11,12 @@ static void set_min(struct RASTER_MAP_PTR *, int, struct RASTER_MAP_PTR *);
 static void set_max(struct RASTER_MAP_PTR *, int, struct RASTER_MAP_PTR *);
 
 
-/* get_stats() Find out the number of cells total, number of nulls
- * the min value, the max value and the create the null replacement
- * value.
+/* init_state() Open the input maps, allocate the row buffers and
+ * the strata, and reset the statistics.
  */
-void get_stats(struct rr_state *theState)
+void init_state(struct rr_state *theState)
 {
-    int nrows, ncols, row, col;
+    int nrows, ncols;
 
     theState->fd_old = Rast_open_old(theState->inraster, "");
     if (theState->docover == 1)
@@ -52,6 +50,32 @@ void get_stats(struct rr_state *theState)
 	theState->cmax.data.v =
 	    (void *)G_malloc(Rast_cell_size(theState->cmax.type));
     }
+
+    /* one stratum per category of the zoning map */
+    theState->nstrata = 1;
+    theState->zmin = 0;
+    theState->zones = NULL;
+    if (theState->dozones == 1) {
+	struct Range zone_range;
+	CELL min, max;
+
+	theState->fd_zones = Rast_open_old(theState->inzones, "");
+	if (Rast_get_map_type(theState->fd_zones) != CELL_TYPE)
+	    G_fatal_error(_("Zoning raster must be of type CELL"));
+	if (Rast_read_range(theState->inzones, "", &zone_range) == -1)
+	    G_fatal_error(_("Can not read range for zoning raster"));
+	Rast_get_range_min_max(&zone_range, &min, &max);
+	if (Rast_is_c_null_value(&min) || Rast_is_c_null_value(&max))
+	    G_fatal_error(_("Zoning raster <%s> contains only NULL cells"),
+			  theState->inzones);
+
+	theState->zones = Rast_allocate_c_buf();
+	theState->zmin = min;
+	theState->nstrata = max - min + 1;
+    }
+    theState->scount = G_calloc(theState->nstrata, sizeof(gcell_count));
+    theState->starget = G_calloc(theState->nstrata, sizeof(gcell_count));
+
     nrows = Rast_window_rows();
     ncols = Rast_window_cols();
 
@@ -65,64 +89,122 @@ void get_stats(struct rr_state *theState)
 	set_min(NULL, 0, &theState->cmin);
 	set_max(NULL, 0, &theState->cmax);
     }
+}				/* init_state() */
+
+
+/* count_row() Add the current row buffers to the statistics: nulls,
+ * min, max and the candidate cells of each stratum.
+ */
+void count_row(struct rr_state *theState, int ncols)
+{
+    int col, s;
+
+    for (col = 0; col < ncols; col++) {
+	if (is_null_value(theState->buf, col)) {
+	    theState->nNulls++;
+	}
+	else {
+	    set_min(&theState->buf, col, &theState->min);
+	    set_max(&theState->buf, col, &theState->max);
+	}
+	if (theState->docover == 1) {
+	    if (is_null_value(theState->cover, col)) {
+		theState->cnNulls++;
+	    }
+	    else {
+		set_min(&theState->cover, col, &theState->cmin);
+		set_max(&theState->cover, col, &theState->cmax);
+	    }
+	}
+	if ((s = get_stratum(theState, col)) >= 0)
+	    theState->scount[s]++;
+    }
+}				/* count_row() */
+
+
+/* empty_row() Tell if a row of the input map has no candidates
+ * according to its row statistics, so it needs not be read.
+ */
+int empty_row(struct rr_state *theState, int row)
+{
+    int count;
+
+    if (theState->use_nulls)
+	return 0;
+    if (!Rast_get_row_stats(theState->fd_old, row, &count, NULL, NULL))
+	return 0;
+
+    return count == 0;
+}				/* empty_row() */
+
+
+/* get_stats() Find out the number of cells total, number of nulls
+ * the min value, the max value and the create the null replacement
+ * value.
+ */
+void get_stats(struct rr_state *theState)
+{
+    int nrows, ncols, row;
+
+    nrows = Rast_window_rows();
+    ncols = Rast_window_cols();
+
     G_message(_("Collecting Stats..."));
     for (row = 0; row < nrows; row++) {
+	G_percent(row, nrows, 2);
+
+	if (empty_row(theState, row)) {
+	    theState->nNulls += ncols;
+	    continue;
+	}
+
 	Rast_get_row(theState->fd_old, theState->buf.data.v,
 		     row, theState->buf.type);
 	if (theState->docover == 1)
 	    Rast_get_row(theState->fd_cold, theState->cover.data.v,
 			 row, theState->cover.type);
+	if (theState->dozones == 1)
+	    Rast_get_c_row(theState->fd_zones, theState->zones, row);
 
-	for (col = 0; col < ncols; col++) {
-	    if (is_null_value(theState->buf, col)) {
-		theState->nNulls++;
-	    }
-	    else {
-		set_min(&theState->buf, col, &theState->min);
-		set_max(&theState->buf, col, &theState->max);
-	    }
-	    if (theState->docover == 1) {
-		if (is_null_value(theState->cover, col)) {
-		    theState->cnNulls++;
-		}
-		else {
-		    set_min(&theState->cover, col, &theState->cmin);
-		    set_max(&theState->cover, col, &theState->cmax);
-		}
-	    }
-	}
-
-	G_percent(row, nrows, 2);
+	count_row(theState, ncols);
     }
 
     G_percent(1, 1, 1);
 
-    /* rewind the in raster map descriptor for later use */
-    lseek(theState->fd_old, 0, SEEK_SET);
-    if (theState->docover == 1)
-	lseek(theState->fd_cold, 0, SEEK_SET);
+    set_null_values(theState);
+}				/* get_stats() */
+
 
-    /* Set the NULL value replacement */
+/* set_null_values() Set the NULL value replacement from the minimum */
+void set_null_values(struct rr_state *theState)
+{
     switch (theState->nulls.type) {
     case CELL_TYPE:
 	*theState->nulls.data.c = *theState->min.data.c - 1;
-	if (theState->docover == 1)
-	    *theState->cnulls.data.c = *theState->cmin.data.c - 1;
 	break;
     case FCELL_TYPE:
 	*theState->nulls.data.f = floor(*theState->min.data.f - 1);
-	if (theState->docover == 1)
-	    *theState->cnulls.data.f = floor(*theState->cmin.data.f - 1);
 	break;
     case DCELL_TYPE:
 	*theState->nulls.data.d = floor(*theState->min.data.d - 1);
-	if (theState->docover == 1)
-	    *theState->cnulls.data.d = floor(*theState->cmin.data.d - 1);
 	break;
     default:			/* Huh? */
 	G_fatal_error(_("Programmer error in get_stats/switch"));
     }
-}				/* get_stats() */
+    if (theState->docover == 1) {
+	switch (theState->cnulls.type) {
+	case CELL_TYPE:
+	    *theState->cnulls.data.c = *theState->cmin.data.c - 1;
+	    break;
+	case FCELL_TYPE:
+	    *theState->cnulls.data.f = floor(*theState->cmin.data.f - 1);
+	    break;
+	case DCELL_TYPE:
+	    *theState->cnulls.data.d = floor(*theState->cmin.data.d - 1);
+	    break;
+	}
+    }
+}				/* set_null_values() */
 
 
 static void set_min(struct RASTER_MAP_PTR *from, int col,
@@ -2,6 +2,8 @@
 #define __LOCAL_PHOTO_H__
 
 #include <grass/raster.h>
+#include <grass/dbmi.h>
+#include <grass/vector.h>
 
 /* raster_ptr.c: From Huidae Cho ... */
 union RASTER_PTR
@@ -31,22 +33,51 @@ typedef unsigned long gcell_count;
 /* Put all the state information into a struct */
 struct rr_state
 {
-    char *inraster, *inrcover, *outraster, *outvector;
-    int use_nulls, docover, fd_old, fd_cold, fd_new;
+    char *inraster, *inrcover, *inzones, *outraster, *outvector;
+    int use_nulls, docover, dozones, fd_old, fd_cold, fd_zones, fd_new;
     gcell_count nCells, nNulls, nRand, cnCells, cnNulls;
     struct RASTER_MAP_PTR nulls, cnulls, buf, cover, min, max, cmin, cmax;
+    CELL *zones, zmin;
+    /* strata: one per zone category, or a single one without zones */
+    int nstrata;
+    gcell_count *scount;	/* candidate cells per stratum */
+    gcell_count *starget;	/* points to allocate per stratum */
     FILE *fsites;
     int z_geometry;
     int notopol;
+
+    /* output state, see output.c */
+    struct Cell_head window;
+    struct Map_info Out;
+    struct field_info *fi;
+    dbDriver *driver;
+    dbString sql;
+    struct line_pnts *Points;
+    struct line_cats *Cats;
+    int cat;
 };
 
 
 /* count.c */
+void init_state(struct rr_state *);
+void count_row(struct rr_state *, int);
+int empty_row(struct rr_state *, int);
+void set_null_values(struct rr_state *);
 void get_stats(struct rr_state *);
 
+/* output.c */
+void open_outputs(struct rr_state *);
+void write_point(struct rr_state *, int, int, double, double, int, int);
+void close_outputs(struct rr_state *);
+
 /* random.c */
+int get_stratum(struct rr_state *, int);
+double cell_as_dbl(struct RASTER_MAP_PTR *, int);
 int execute_random(struct rr_state *);
 
+/* sample.c */
+int sample_random(struct rr_state *);
+
 /* support.c */
 int make_support(struct rr_state *, int, double);
 
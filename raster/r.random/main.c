@@ -35,11 +35,12 @@ int main(int argc, char *argv[])
     gcell_count count;
     struct rr_state myState;
     long seed_value;
+    int s;
 
     struct GModule *module;
     struct
     {
-	struct Option *input, *cover, *raster, *sites, *npoints, *seed;
+	struct Option *input, *cover, *zones, *raster, *sites, *npoints, *seed;
     } parm;
     struct
     {
@@ -67,12 +68,20 @@ int main(int argc, char *argv[])
     parm.cover->required = NO;
     parm.cover->description = _("Name of cover raster map");
 
+    parm.zones = G_define_standard_option(G_OPT_R_MAP);
+    parm.zones->key = "zones";
+    parm.zones->required = NO;
+    parm.zones->description =
+	_("Raster map used for stratified sampling, must be of type CELL");
+    parm.zones->guisection = _("Zones");
+
     parm.npoints = G_define_option();
     parm.npoints->key = "npoints";
     parm.npoints->key_desc = "number[%]";
     parm.npoints->type = TYPE_STRING;
     parm.npoints->required = YES;
-    parm.npoints->description = _("The number of points to allocate");
+    parm.npoints->description =
+	_("The number of points to allocate (per zone if zones are given)");
 
     parm.raster = G_define_standard_option(G_OPT_R_OUTPUT);
     parm.raster->required = NO;
@@ -119,15 +128,25 @@ int main(int argc, char *argv[])
 	myState.docover = FALSE;
 	myState.inrcover = NULL;
     }
+    if (parm.zones->answer) {
+	myState.dozones = TRUE;
+	myState.inzones = parm.zones->answer;
+    }
+    else {
+	myState.dozones = FALSE;
+	myState.inzones = NULL;
+    }
     myState.outraster = parm.raster->answer;
     myState.outvector = parm.sites->answer;
     myState.z_geometry = flag.z_geometry->answer;
     myState.notopol = flag.notopol_flag->answer;
 
-    /* If they only want info we ignore the rest */
-    get_stats(&myState);
+    init_state(&myState);
 
+    /* If they only want info we ignore the rest */
     if (flag.info->answer) {
+	get_stats(&myState);
+
 #ifdef HAVE_LONG_LONG_INT
 	G_message("Raster:      %s\n"
 		  "Cover:       %s\n"
@@ -171,36 +190,6 @@ int main(int argc, char *argv[])
 	}
     }
 
-    count = (myState.use_nulls) ? myState.nCells :
-	myState.nCells - myState.nNulls;
-
-    if (percent)
-	myState.nRand = (gcell_count)(count * percentage / 100.0 + .5);
-    else {
-	if (targets > count) {
-#ifdef HAVE_LONG_LONG_INT
-	    if (myState.use_nulls)
-		G_fatal_error(_("There aren't [%llu] cells in the current region"),
-			      targets);
-	    else
-		G_fatal_error(_("There aren't [%llu] non-NULL cells in the current region"),
-			      targets);
-#else
-	    if (myState.use_nulls)
-		G_fatal_error(_("There aren't [%lu] cells in the current region"),
-			      targets);
-	    else
-		G_fatal_error(_("There aren't [%lu] non-NULL cells in the current region"),
-			      targets);
-#endif
-	}
-
-	if (targets <= 0)
-	    G_fatal_error(_("There are no valid locations in the current region"));
-
-	myState.nRand = targets;
-    }
-
     if (parm.seed->answer) {
         seed_value = atol(parm.seed->answer);
         G_srand48(seed_value);
@@ -211,7 +200,29 @@ int main(int argc, char *argv[])
         G_debug(3, "Generated random seed (-s): %ld", seed_value);
     }
 
-    execute_random(&myState);
+    if (percent) {
+	/* the percentage needs the number of candidates first */
+	get_stats(&myState);
+
+	myState.nRand = 0;
+	for (s = 0; s < myState.nstrata; s++) {
+	    count = myState.scount[s];
+	    myState.starget[s] =
+		(gcell_count)(count * percentage / 100.0 + .5);
+	    myState.nRand += myState.starget[s];
+	}
+	if (myState.nRand == 0)
+	    G_fatal_error(_("There are no valid locations in the current region"));
+
+	execute_random(&myState);
+    }
+    else {
+	/* reservoir sampling, one pass */
+	for (s = 0; s < myState.nstrata; s++)
+	    myState.starget[s] = targets;
+
+	sample_random(&myState);
+    }
 
     if (myState.outraster)
 	make_support(&myState, percent, percentage);
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/dbmi.h>
+#include <grass/vector.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+
+/* open_outputs() Create the output raster map and the output vector
+ * map with its attribute table.
+ */
+void open_outputs(struct rr_state *theState)
+{
+    RASTER_MAP_TYPE type;
+    dbTable *table;
+    dbColumn *column;
+    int ncolumns, i;
+
+    G_get_window(&theState->window);
+
+    if (theState->outraster != NULL) {
+	if (theState->docover == TRUE)
+	    type = theState->cover.type;
+	else
+	    type = theState->buf.type;
+	theState->fd_new = Rast_open_new(theState->outraster, type);
+    }
+
+    theState->cat = 1;
+    if (!theState->outvector)
+	return;
+
+    if (Vect_open_new(&theState->Out, theState->outvector,
+		      theState->z_geometry) < 0)
+	G_fatal_error(_("Unable to create vector map <%s>"),
+		      theState->outvector);
+    Vect_hist_command(&theState->Out);
+
+    theState->fi = Vect_default_field_info(&theState->Out, 1, NULL,
+					   GV_1TABLE);
+
+    theState->driver =
+	db_start_driver_open_database(theState->fi->driver,
+				      Vect_subst_var(theState->fi->database,
+						     &theState->Out));
+    if (!theState->driver)
+	G_fatal_error(_("Unable to open database <%s> by driver <%s>"),
+		      Vect_subst_var(theState->fi->database, &theState->Out),
+		      theState->fi->driver);
+    db_set_error_handler_driver(theState->driver);
+
+    Vect_map_add_dblink(&theState->Out, 1, NULL, theState->fi->table,
+			GV_KEY_COLUMN, theState->fi->database,
+			theState->fi->driver);
+
+    ncolumns = 2;
+    if (theState->docover == TRUE)
+	ncolumns++;
+    if (theState->dozones == TRUE)
+	ncolumns++;
+    table = db_alloc_table(ncolumns);
+    db_set_table_name(table, theState->fi->table);
+
+    column = db_get_table_column(table, 0);
+    db_set_column_name(column, GV_KEY_COLUMN);
+    db_set_column_sqltype(column, DB_SQL_TYPE_INTEGER);
+
+    column = db_get_table_column(table, 1);
+    db_set_column_name(column, "value");
+    db_set_column_sqltype(column, DB_SQL_TYPE_DOUBLE_PRECISION);
+
+    i = 2;
+    if (theState->docover == TRUE) {
+	column = db_get_table_column(table, i++);
+	db_set_column_name(column, "covervalue");
+	db_set_column_sqltype(column, DB_SQL_TYPE_DOUBLE_PRECISION);
+    }
+    if (theState->dozones == TRUE) {
+	column = db_get_table_column(table, i++);
+	db_set_column_name(column, "zone");
+	db_set_column_sqltype(column, DB_SQL_TYPE_INTEGER);
+    }
+    if (db_create_table(theState->driver, table) != DB_OK)
+	G_warning(_("Cannot create new table"));
+
+    db_begin_transaction(theState->driver);
+
+    theState->Points = Vect_new_line_struct();
+    theState->Cats = Vect_new_cats_struct();
+    db_init_string(&theState->sql);
+}				/* open_outputs() */
+
+
+/* write_point() Write the point at the center of cell (row, col) and
+ * its attributes to the output vector map.
+ */
+void write_point(struct rr_state *theState, int row, int col,
+		 double val, double coverval, int cover_null, int stratum)
+{
+    struct Cell_head *window = &theState->window;
+    double x, y;
+    char buf[500], *p;
+
+    if (!theState->outvector)
+	return;
+
+    Vect_reset_line(theState->Points);
+    Vect_reset_cats(theState->Cats);
+
+    x = window->west + (col + .5) * window->ew_res;
+    y = window->north - (row + .5) * window->ns_res;
+
+    if (theState->z_geometry)
+	Vect_append_point(theState->Points, x, y, val);
+    else
+	Vect_append_point(theState->Points, x, y, 0.0);
+    Vect_cat_set(theState->Cats, 1, theState->cat);
+
+    Vect_write_line(&theState->Out, GV_POINT, theState->Points,
+		    theState->Cats);
+
+    p = buf + sprintf(buf, "insert into %s values ( %d, %f",
+		      theState->fi->table, theState->cat, val);
+    if (theState->docover == 1) {
+	if (cover_null)
+	    p += sprintf(p, ", NULL");
+	else
+	    p += sprintf(p, ", %f", coverval);
+    }
+    if (theState->dozones == 1)
+	p += sprintf(p, ", %d", theState->zmin + stratum);
+    sprintf(p, " )");
+    db_set_string(&theState->sql, buf);
+
+    if (db_execute_immediate(theState->driver, &theState->sql) != DB_OK)
+	G_fatal_error(_("Cannot insert new record: %s"),
+		      db_get_string(&theState->sql));
+
+    theState->cat++;
+}				/* write_point() */
+
+
+/* close_outputs() Finish the attribute table and close the output maps */
+void close_outputs(struct rr_state *theState)
+{
+    if (theState->outvector) {
+	db_commit_transaction(theState->driver);
+	if (db_create_index2(theState->driver, theState->fi->table,
+			     GV_KEY_COLUMN) != DB_OK)
+	    G_warning(_("Unable to create index"));
+	if (db_grant_on_table
+	    (theState->driver, theState->fi->table, DB_PRIV_SELECT,
+	     DB_GROUP | DB_PUBLIC) != DB_OK) {
+	    G_fatal_error(_("Unable to grant privileges on table <%s>"),
+			  theState->fi->table);
+	}
+	db_close_database_shutdown_driver(theState->driver);
+	if (theState->notopol != 1)
+	    Vect_build(&theState->Out);
+	Vect_close(&theState->Out);
+    }
+    if (theState->outraster)
+	Rast_close(theState->fd_new);
+}				/* close_outputs() */
@@ -0,0 +1,280 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+/* One pass reservoir sampling (Li's algorithm L). Every stratum keeps
+ * up to starget cells; once it is full, the index of the next cell to
+ * take is drawn directly, so that the random number generator is not
+ * called for every candidate cell. The statistics get_stats() would
+ * collect are gathered during the same pass. Rows without data
+ * according to the row statistics of the input map are not read.
+ */
+
+struct sample
+{
+    int row, col, stratum;
+    DCELL val, cval;
+};
+
+struct reservoir
+{
+    gcell_count n;		/* candidates seen */
+    gcell_count next;		/* index of the next candidate to take */
+    gcell_count size;		/* samples held */
+    gcell_count alloc;
+    double w;
+    struct sample *s;
+};
+
+
+static double random_open(void)
+{
+    double u;
+
+    /* (0, 1), log(u) must be finite */
+    do
+	u = G_drand48();
+    while (u == 0.0);
+
+    return u;
+}
+
+
+static void next_skip(struct reservoir *r, gcell_count ncells)
+{
+    double skip = floor(log(random_open()) / log(1.0 - r->w));
+
+    r->next = skip >= (double)(ncells - r->n) ? ncells : r->n + skip;
+}
+
+
+static void set_sample(struct rr_state *theState, struct sample *smp,
+		       int row, int col, int stratum)
+{
+    smp->row = row;
+    smp->col = col;
+    smp->stratum = stratum;
+    if (is_null_value(theState->buf, col))
+	Rast_set_d_null_value(&smp->val, 1);
+    else
+	smp->val = cell_as_dbl(&theState->buf, col);
+    if (theState->docover == TRUE) {
+	if (is_null_value(theState->cover, col))
+	    Rast_set_d_null_value(&smp->cval, 1);
+	else
+	    smp->cval = cell_as_dbl(&theState->cover, col);
+    }
+    else
+	smp->cval = 0.0;
+}
+
+
+static void add_candidate(struct rr_state *theState, struct reservoir *r,
+			  gcell_count k, int row, int col, int stratum)
+{
+    if (r->size < k) {
+	if (r->size == r->alloc) {
+	    r->alloc = r->alloc ? 2 * r->alloc : 64;
+	    if (r->alloc > k)
+		r->alloc = k;
+	    r->s = G_realloc(r->s, r->alloc * sizeof(struct sample));
+	}
+	set_sample(theState, &r->s[r->size++], row, col, stratum);
+	r->n++;
+	if (r->size == k) {
+	    r->w = exp(log(random_open()) / k);
+	    next_skip(r, theState->nCells);
+	}
+	return;
+    }
+
+    if (r->n == r->next) {
+	set_sample(theState, &r->s[(gcell_count)(G_drand48() * k)],
+		   row, col, stratum);
+	r->w *= exp(log(random_open()) / k);
+	r->n++;
+	next_skip(r, theState->nCells);
+	return;
+    }
+
+    r->n++;
+}
+
+
+static int cmp_sample(const void *a, const void *b)
+{
+    const struct sample *sa = a, *sb = b;
+
+    if (sa->row != sb->row)
+	return sa->row < sb->row ? -1 : 1;
+    if (sa->col != sb->col)
+	return sa->col < sb->col ? -1 : 1;
+
+    return 0;
+}
+
+
+/* sample_random() Draw the points of every stratum in a single pass
+ * over the input maps, then write them in row order.
+ */
+int sample_random(struct rr_state *theState)
+{
+    struct reservoir *res;
+    struct sample *samples;
+    gcell_count nsamples, i, short_strata;
+    int nrows, ncols, row, col, s;
+    RASTER_MAP_TYPE type;
+    void *outbuf = NULL;
+    size_t size;
+
+    nrows = Rast_window_rows();
+    ncols = Rast_window_cols();
+
+    res = G_calloc(theState->nstrata, sizeof(struct reservoir));
+
+    G_message(_("Sampling cells..."));
+    for (row = 0; row < nrows; row++) {
+	G_percent(row, nrows, 2);
+
+	if (empty_row(theState, row)) {
+	    theState->nNulls += ncols;
+	    continue;
+	}
+
+	Rast_get_row(theState->fd_old, theState->buf.data.v,
+		     row, theState->buf.type);
+	if (theState->docover == TRUE)
+	    Rast_get_row(theState->fd_cold, theState->cover.data.v,
+			 row, theState->cover.type);
+	if (theState->dozones == TRUE)
+	    Rast_get_c_row(theState->fd_zones, theState->zones, row);
+
+	count_row(theState, ncols);
+
+	for (col = 0; col < ncols; col++) {
+	    if ((s = get_stratum(theState, col)) < 0)
+		continue;
+	    add_candidate(theState, &res[s], theState->starget[s],
+			  row, col, s);
+	}
+    }
+    G_percent(1, 1, 1);
+
+    set_null_values(theState);
+
+    Rast_close(theState->fd_old);
+    if (theState->docover == TRUE)
+	Rast_close(theState->fd_cold);
+    if (theState->dozones == TRUE)
+	Rast_close(theState->fd_zones);
+
+    /* collect the strata in row order */
+    nsamples = 0;
+    short_strata = 0;
+    for (s = 0; s < theState->nstrata; s++) {
+	nsamples += res[s].size;
+	if (res[s].n > 0 && res[s].size < theState->starget[s])
+	    short_strata++;
+    }
+
+    if (theState->dozones != TRUE && nsamples < theState->starget[0]) {
+#ifdef HAVE_LONG_LONG_INT
+	if (theState->use_nulls)
+	    G_fatal_error(_("There aren't [%llu] cells in the current region"),
+			  theState->starget[0]);
+	else
+	    G_fatal_error(_("There aren't [%llu] non-NULL cells in the current region"),
+			  theState->starget[0]);
+#else
+	if (theState->use_nulls)
+	    G_fatal_error(_("There aren't [%lu] cells in the current region"),
+			  theState->starget[0]);
+	else
+	    G_fatal_error(_("There aren't [%lu] non-NULL cells in the current region"),
+			  theState->starget[0]);
+#endif
+    }
+    if (nsamples == 0)
+	G_fatal_error(_("There are no valid locations in the current region"));
+    if (short_strata > 0)
+#ifdef HAVE_LONG_LONG_INT
+	G_warning(_("%llu zones have fewer candidate cells than requested, "
+		    "all of their cells are selected"), short_strata);
+#else
+	G_warning(_("%lu zones have fewer candidate cells than requested, "
+		    "all of their cells are selected"), short_strata);
+#endif
+
+    samples = G_malloc(nsamples * sizeof(struct sample));
+    for (i = 0, s = 0; s < theState->nstrata; s++) {
+	if (res[s].size == 0)
+	    continue;
+	memcpy(samples + i, res[s].s, res[s].size * sizeof(struct sample));
+	i += res[s].size;
+	G_free(res[s].s);
+    }
+    G_free(res);
+    qsort(samples, nsamples, sizeof(struct sample), cmp_sample);
+
+    theState->nRand = nsamples;
+
+    open_outputs(theState);
+
+    if (theState->outvector && theState->outraster)
+	G_message(_("Writing raster map <%s> and vector map <%s> ..."),
+		  theState->outraster, theState->outvector);
+    else if (theState->outraster)
+	G_message(_("Writing raster map <%s> ..."), theState->outraster);
+    else if (theState->outvector)
+	G_message(_("Writing vector map <%s> ..."), theState->outvector);
+
+    type = theState->docover == TRUE ? theState->cover.type :
+	theState->buf.type;
+    size = Rast_cell_size(type);
+    if (theState->outraster)
+	outbuf = Rast_allocate_buf(type);
+
+    for (row = 0, i = 0; row < nrows; row++) {
+	if (theState->outraster)
+	    Rast_set_null_value(outbuf, ncols, type);
+
+	for (; i < nsamples && samples[i].row == row; i++) {
+	    struct sample *smp = &samples[i];
+	    int cover_null = 0;
+
+	    if (Rast_is_d_null_value(&smp->val))
+		smp->val = cell_as_dbl(&theState->nulls, 0);
+	    if (theState->docover == TRUE) {
+		cover_null = Rast_is_d_null_value(&smp->cval);
+		if (cover_null)
+		    smp->cval = cell_as_dbl(&theState->cnulls, 0);
+	    }
+
+	    if (theState->outraster)
+		Rast_set_d_value(G_incr_void_ptr(outbuf, smp->col * size),
+				 theState->docover == TRUE ?
+				 smp->cval : smp->val, type);
+
+	    write_point(theState, row, smp->col, smp->val, smp->cval,
+			cover_null, smp->stratum);
+	}
+
+	if (theState->outraster)
+	    Rast_put_row(theState->fd_new, outbuf, type);
+
+	G_percent(row, nrows, 2);
+    }
+    G_percent(1, 1, 1);
+
+    if (outbuf)
+	G_free(outbuf);
+    G_free(samples);
+
+    close_outputs(theState);
+
+    return 0;
+}				/* sample_random() */
@@ -11,6 +11,7 @@ Licence:    This program is free software under the GNU General Public
 
 from grass.gunittest.case import TestCase
 from grass.gunittest.main import test
+from grass.script import read_command
 
 
 class TestRasterTile(TestCase):
@@ -39,6 +40,7 @@ class TestRasterTile(TestCase):
         cls.runModule('g.remove', type='vector', flags='f', name=cls.vector + '_without_topology')
         cls.runModule('g.remove', type='vector', flags='f', name=cls.vector + '_3D')
         cls.runModule('g.remove', type='vector', flags='f', name=cls.vector + '_cover_landcover_1m')
+        cls.runModule('g.remove', type='vector', flags='f', name=cls.vector + '_zones')
 
     def test_random_raster(self):
         """Testing r.random  runs successfully"""
@@ -112,6 +114,15 @@ class TestRasterTile(TestCase):
         topology = dict(points=20, primitives=20)
         self.assertVectorFitsTopoInfo(vector=self.vector+'_cover_landcover_1m', reference=topology)
 
+    def test_vector_random_zones(self):
+        """Testing r.random draws npoints in every zone"""
+        self.assertModule('r.random', input=self.input, npoints=self.npoints, zones=self.input,
+                          vector=self.vector + '_zones', seed=1)
+        self.assertVectorExists(self.vector + '_zones', msg="landcover_1m_vector_random_zones was not created")
+        nzones = len(read_command('r.stats', flags='n', input=self.input).splitlines())
+        topology = dict(points=nzones * 20, primitives=nzones * 20)
+        self.assertVectorFitsTopoInfo(vector=self.vector + '_zones', reference=topology)
+
 
 if __name__ == '__main__':
     test()
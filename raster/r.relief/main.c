@@ -58,13 +58,129 @@
 #include <grass/raster.h>
 #include <grass/glocale.h>
 
+#define BLOCK_ROWS 8
+
+/* work buffers of a thread */
+struct scratch
+{
+    double *dx, *dy;
+};
+
+struct block
+{
+    DCELL **elev;		/* elevation rows of the block and its halo */
+    double *H, *V;		/* weighted runs of the rows of the block */
+    void **out;			/* output rows */
+    int out_type;
+    int ncols;			/* number of computed cells of a row */
+    int offset;			/* output column of the first computed cell */
+    double altitude, azimuth;
+    int chunk;			/* rows per thread */
+    struct scratch *scratch;	/* per thread */
+};
+
+/* computes the shaded relief of the row i of a block */
+static void process_row(const struct block *blk, struct scratch *s, int i)
+{
+    const DCELL *c1 = blk->elev[i], *c2 = c1 + 1, *c3 = c1 + 2;
+    const DCELL *c4 = blk->elev[i + 1], *c5 = c4 + 1, *c6 = c4 + 2;
+    const DCELL *c7 = blk->elev[i + 2], *c8 = c7 + 1, *c9 = c7 + 2;
+    double H = blk->H[i], V = blk->V[i];
+    double altitude = blk->altitude, azimuth = blk->azimuth;
+    double degrees_to_radians = M_PI / 180.0;
+    double *dx = s->dx, *dy = s->dy;
+    int ncols = blk->ncols;
+    size_t out_size = Rast_cell_size(blk->out_type);
+    void *out_ptr;
+    int col;
+
+    /* slope, the loops have no branches so that compilers can vectorize
+     * them; null neighbours make dx or dy null */
+    for (col = 0; col < ncols; col++)
+	dx[col] = (c1[col] + 2 * c4[col] + c7[col] -
+		   c3[col] - 2 * c6[col] - c9[col]) / H;
+    for (col = 0; col < ncols; col++)
+	dy[col] = (c1[col] + 2 * c2[col] + c3[col] -
+		   c7[col] - 2 * c8[col] - c9[col]) / V;
+
+    out_ptr = G_incr_void_ptr(blk->out[i], blk->offset * out_size);
+
+    for (col = 0; col < ncols; col++) {
+	double key, slp_in_rad, aspect, cang;
+
+	if (Rast_is_d_null_value(&c5[col]) ||
+	    Rast_is_d_null_value(&dx[col]) || Rast_is_d_null_value(&dy[col])) {
+
+	    Rast_set_null_value(out_ptr, 1, blk->out_type);
+	    out_ptr = G_incr_void_ptr(out_ptr, out_size);
+
+	    continue;
+	}			/* no data */
+
+	key = dx[col] * dx[col] + dy[col] * dy[col];
+
+	slp_in_rad = M_PI / 2. - atan(sqrt(key));
+
+	/* aspect */
+	aspect = atan2(dy[col], dx[col]);
+
+	if (aspect != aspect)
+	    aspect = degrees_to_radians;
+	if (dx[col] != 0 || dy[col] != 0) {
+	    if (aspect == 0)
+		aspect = 2 * M_PI;
+	}
+
+#if 0
+	/* the original script was rounding aspect. Why? */
+	aspect *= radians_to_degrees;
+	if (aspect < 0)
+	    aspect = (int)(aspect - 0.5);
+	else
+	    aspect = (int)(aspect + 0.5);
+	aspect *= degrees_to_radians;
+#endif
+
+	/* shaded relief */
+	cang = sin(altitude) * sin(slp_in_rad) + 
+	       cos(altitude) * cos(slp_in_rad) * cos(azimuth - aspect);
+
+	Rast_set_d_value(out_ptr, (DCELL) 255 * cang, blk->out_type);
+
+	out_ptr = G_incr_void_ptr(out_ptr, out_size);
+    }				/* column for loop */
+}
+
+/* the threads share the elevation rows of the block and its halo and
+ * each writes the shaded relief of the rows it was given; dx and dy of
+ * a row are in the scratch of the thread */
+static void process_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct scratch *s = &blk->scratch[first / blk->chunk];
+    int i;
+
+    for (i = first; i < last; i++)
+	process_row(blk, s, i);
+}
+
+static void read_row(int fd, DCELL *buf, int row, int Wrap)
+{
+    if (Wrap) {
+	Rast_get_d_row_nomask(fd, buf + 1, row);
+	buf[0] = buf[Rast_window_cols() - 1];
+	buf[Rast_window_cols() + 1] = buf[2];
+    }
+    else
+	Rast_get_d_row_nomask(fd, buf, row);
+}
+
 int main(int argc, char *argv[])
 {
     int in_fd;
     int out_fd;
-    DCELL *elev_cell[3], *temp;
-    DCELL *out_rast, *out_ptr = NULL;
-    DCELL *c1, *c2, *c3, *c4, *c5, *c6, *c7, *c8, *c9;
+    DCELL *temp;
+    DCELL *out_rast;
     int Wrap;			/* global wraparound */
     struct Cell_head window;
     struct History hist;
@@ -73,21 +189,18 @@ int main(int argc, char *argv[])
     const char *elev_name;
     const char *sr_name;
     int out_type = CELL_TYPE;
-    size_t out_size;
     const char *units;
     char buf[GNAME_MAX];
     int nrows, row;
-    int ncols, col;
+    int ncols;
+    int i, nprocs, nblock;
+    struct block blk;
 
     double zmult, scale, altitude, azimuth;
     double north, east, south, west, ns_med;
 
     double degrees_to_radians, radians_to_degrees;
     double H, V;
-    double dx;			/* partial derivative in ew direction */
-    double dy;			/* partial derivative in ns direction */
-    double key;
-    double slp_in_rad, aspect, cang;
 
     struct FPRange range;
     DCELL min, max;
@@ -96,7 +209,7 @@ int main(int argc, char *argv[])
     struct
     {
 	struct Option *elevation, *relief, *altitude, *azimuth, *zmult,
-	    *scale, *units;
+	    *scale, *units, *nprocs;
     } parm;
     char *desc;
 
@@ -164,6 +277,8 @@ int main(int argc, char *argv[])
 	       _("survey feet"));
     parm.units->descriptions = desc;
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
 
     degrees_to_radians = M_PI / 180.0;
     radians_to_degrees = 180. / M_PI;
@@ -176,6 +291,9 @@ int main(int argc, char *argv[])
 
     G_check_input_output_name(elev_name, sr_name, G_FATAL_EXIT);
 
+    nprocs = G_set_nprocs(parm.nprocs);
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+
     if (sscanf(parm.altitude->answer, "%lf", &altitude) != 1 || altitude < 0.0) {
 	G_fatal_error(_("%s=%s - must be a non-negative number"),
 		      parm.altitude->key, parm.altitude->answer);
@@ -263,160 +381,86 @@ int main(int argc, char *argv[])
 
     /* open the elevation file for reading */
     in_fd = Rast_open_old(elev_name, "");
-    elev_cell[0] = (DCELL *) G_calloc(ncols + 1, sizeof(DCELL));
-    Rast_set_d_null_value(elev_cell[0], ncols);
-    elev_cell[1] = (DCELL *) G_calloc(ncols, sizeof(DCELL));
-    Rast_set_d_null_value(elev_cell[1], ncols);
-    elev_cell[2] = (DCELL *) G_calloc(ncols, sizeof(DCELL));
-    Rast_set_d_null_value(elev_cell[2], ncols);
+    blk.elev = (DCELL **) G_malloc((nblock + 2) * sizeof(DCELL *));
+    for (i = 0; i < nblock + 2; i++) {
+	blk.elev[i] = (DCELL *) G_calloc(ncols + 1, sizeof(DCELL));
+	Rast_set_d_null_value(blk.elev[i], ncols);
+    }
 
     out_fd = Rast_open_new(sr_name, out_type);
     out_rast = Rast_allocate_buf(out_type);
     Rast_set_null_value(out_rast, Rast_window_cols(), out_type);
     Rast_put_row(out_fd, out_rast, out_type);
-    out_size = Rast_cell_size(out_type);
 
-    if (Wrap) {
-	Rast_get_d_row_nomask(in_fd, elev_cell[1] + 1, 0);
-	elev_cell[1][0] = elev_cell[1][Rast_window_cols() - 1];
-	elev_cell[1][Rast_window_cols() + 1] = elev_cell[1][2];
+    blk.out = G_malloc(nblock * sizeof(void *));
+    for (i = 0; i < nblock; i++) {
+	blk.out[i] = Rast_allocate_buf(out_type);
+	Rast_set_null_value(blk.out[i], Rast_window_cols(), out_type);
     }
-    else
-	Rast_get_d_row_nomask(in_fd, elev_cell[1], 0);
 
-    if (Wrap) {
-	Rast_get_d_row_nomask(in_fd, elev_cell[2] + 1, 1);
-	elev_cell[2][0] = elev_cell[2][Rast_window_cols() - 1];
-	elev_cell[2][Rast_window_cols() + 1] = elev_cell[2][2];
+    /* the first and last cells of a row stay null unless wrapping */
+    blk.ncols = ncols - 2;
+    blk.offset = Wrap ? 0 : 1;
+    blk.out_type = out_type;
+    blk.altitude = altitude;
+    blk.azimuth = azimuth;
+    blk.H = (double *) G_malloc(nblock * sizeof(double));
+    blk.V = (double *) G_malloc(nblock * sizeof(double));
+    blk.chunk = (nblock + nprocs - 1) / nprocs;
+    blk.scratch = G_calloc(nprocs, sizeof(struct scratch));
+    for (i = 0; i < nprocs; i++) {
+	blk.scratch[i].dx = (double *) G_malloc(ncols * sizeof(double));
+	blk.scratch[i].dy = (double *) G_malloc(ncols * sizeof(double));
     }
-    else
-	Rast_get_d_row_nomask(in_fd, elev_cell[2], 1);
+
+    read_row(in_fd, blk.elev[0], 0, Wrap);
+    read_row(in_fd, blk.elev[1], 1, Wrap);
 
     G_verbose_message(_("Percent complete..."));
 
-    for (row = 2; row < nrows; row++) {
-	/*  if projection is Lat/Lon, recalculate  V and H   */
-	if (G_projection() == PROJECTION_LL) {
-	    north = Rast_row_to_northing((row - 2 + 0.5), &window);
-	    ns_med = Rast_row_to_northing((row - 1 + 0.5), &window);
-	    south = Rast_row_to_northing((row + 0.5), &window);
-	    east = Rast_col_to_easting(2.5, &window);
-	    west = Rast_col_to_easting(0.5, &window);
-	    V = G_distance(east, north, east, south) * 4 * scale / zmult;
-	    H = G_distance(east, ns_med, west, ns_med) * 4 * scale / zmult;
-	    /*        ____________________________
-	       |c1      |c2      |c3      |
-	       |        |        |        |
-	       |        |  north |        |        
-	       |        |        |        |
-	       |________|________|________|          
-	       |c4      |c5      |c6      |
-	       |        |        |        |
-	       |  east  | ns_med |  west  |
-	       |        |        |        |
-	       |________|________|________|
-	       |c7      |c8      |c9      |
-	       |        |        |        |
-	       |        |  south |        |
-	       |        |        |        |
-	       |________|________|________|
-	     */
-	}
+    /* the rows 1 to nrows - 2 are computed block by block */
+    for (row = 1; row < nrows - 1; row += nblock) {
+	int n = nrows - 1 - row < nblock ? nrows - 1 - row : nblock;
 
 	G_percent(row, nrows, 2);
-	temp = elev_cell[0];
-	elev_cell[0] = elev_cell[1];
-	elev_cell[1] = elev_cell[2];
-	elev_cell[2] = temp;
-
-	if (Wrap) {
-	    Rast_get_d_row_nomask(in_fd, elev_cell[2] + 1, row);
-	    elev_cell[2][0] = elev_cell[2][Rast_window_cols() - 1];
-	    elev_cell[2][Rast_window_cols() + 1] = elev_cell[2][2];
-	}
-	else
-	    Rast_get_d_row_nomask(in_fd, elev_cell[2], row);
-
-	c1 = elev_cell[0];
-	c2 = c1 + 1;
-	c3 = c1 + 2;
-	c4 = elev_cell[1];
-	c5 = c4 + 1;
-	c6 = c4 + 2;
-	c7 = elev_cell[2];
-	c8 = c7 + 1;
-	c9 = c7 + 2;
-
-	if (Wrap)
-	    out_ptr = out_rast;
-	else
-	    out_ptr = G_incr_void_ptr(out_rast, out_size);
-
-	/*skip first cell of the row */
-
-	for (col = ncols - 2; col-- > 0;
-	     c1++, c2++, c3++, c4++, c5++, c6++, c7++, c8++, c9++) {
-	    /*  DEBUG:
-	       fprintf(stdout, "\n%.0f %.0f %.0f\n%.0f %.0f %.0f\n%.0f %.0f %.0f\n",
-	       *c1, *c2, *c3, *c4, *c5, *c6, *c7, *c8, *c9);
-	     */
-
-	    if (Rast_is_d_null_value(c1) || Rast_is_d_null_value(c2) ||
-		Rast_is_d_null_value(c3) || Rast_is_d_null_value(c4) ||
-		Rast_is_d_null_value(c5) || Rast_is_d_null_value(c6) ||
-		Rast_is_d_null_value(c7) || Rast_is_d_null_value(c8) ||
-		Rast_is_d_null_value(c9)) {
-
-		Rast_set_null_value(out_ptr, 1, out_type);
-		out_ptr = G_incr_void_ptr(out_ptr, out_size);
 
-		continue;
-	    }			/* no data */
-
-	    /* shaded relief */
-	    /* slope */
-	    dx = (*c1 + 2 * *c4 + *c7 - *c3 - 2 * *c6 - *c9) / H;
-	    dy = (*c1 + 2 * *c2 + *c3 - *c7 - 2 * *c8 - *c9) / V;
-
-	    key = dx * dx + dy * dy;
-
-	    slp_in_rad = M_PI / 2. - atan(sqrt(key));
-
-	    /* aspect */
-	    aspect = atan2(dy, dx);
-
-	    if (aspect != aspect)
-		aspect = degrees_to_radians;
-	    if (dx != 0 || dy != 0) {
-		if (aspect == 0)
-		    aspect = 2 * M_PI;
+	for (i = 0; i < n; i++) {
+	    read_row(in_fd, blk.elev[i + 2], row + i + 1, Wrap);
+
+	    /*  if projection is Lat/Lon, recalculate  V and H   */
+	    if (G_projection() == PROJECTION_LL) {
+		north = Rast_row_to_northing((row + i - 1 + 0.5), &window);
+		ns_med = Rast_row_to_northing((row + i + 0.5), &window);
+		south = Rast_row_to_northing((row + i + 1 + 0.5), &window);
+		east = Rast_col_to_easting(2.5, &window);
+		west = Rast_col_to_easting(0.5, &window);
+		blk.V[i] = G_distance(east, north, east, south) * 4 *
+		    scale / zmult;
+		blk.H[i] = G_distance(east, ns_med, west, ns_med) * 4 *
+		    scale / zmult;
 	    }
+	    else {
+		blk.V[i] = V;
+		blk.H[i] = H;
+	    }
+	}
 
-#if 0
-	    /* the original script was rounding aspect. Why? */
-	    aspect *= radians_to_degrees;
-	    if (aspect < 0)
-		aspect = (int)(aspect - 0.5);
-	    else
-		aspect = (int)(aspect + 0.5);
-	    aspect *= degrees_to_radians;
-#endif
-
-	    /* shaded relief */
-	    cang = sin(altitude) * sin(slp_in_rad) + 
-	           cos(altitude) * cos(slp_in_rad) * cos(azimuth - aspect);
-
-	    Rast_set_d_value(out_ptr, (DCELL) 255 * cang, out_type);
-
-	    out_ptr = G_incr_void_ptr(out_ptr, out_size);
-
-	}			/* column for loop */
+	/* the rows of a block are independent */
+	G_parallel_for(0, n, blk.chunk, process_rows, &blk);
 
-	Rast_put_row(out_fd, out_rast, out_type);
+	for (i = 0; i < n; i++)
+	    Rast_put_row(out_fd, blk.out[i], out_type);
 
-    }				/* row loop */
+	/* the last two rows are the first ones of the next block */
+	temp = blk.elev[0];
+	blk.elev[0] = blk.elev[n];
+	blk.elev[n] = temp;
+	temp = blk.elev[1];
+	blk.elev[1] = blk.elev[n + 1];
+	blk.elev[n + 1] = temp;
+    }
 
-    G_percent(row, nrows, 2);
+    G_percent(nrows, nrows, 2);
 
     Rast_close(in_fd);
 
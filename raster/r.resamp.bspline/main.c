@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <math.h>
 #include "bspline.h"
+#include <grass/N_pde.h>
 
 #define SEGSIZE 	64
 
@@ -40,7 +41,7 @@ int main(int argc, char *argv[])
 
     char title[64];
 
-    int dim_vect, nparameters, BW;
+    int dim_vect, nparameters, BW, solver_type;
     double *TN, *Q, *parVect;	/* Interpolating and least-square vectors */
     double **N, **obsVect;	/* Interpolation and least-square matrix */
 
@@ -61,7 +62,8 @@ int main(int argc, char *argv[])
 
     struct GModule *module;
     struct Option *in_opt, *out_opt, *grid_opt, *stepE_opt, *stepN_opt,
-		  *lambda_f_opt, *method_opt, *mask_opt, *memory_opt;
+		  *lambda_f_opt, *method_opt, *mask_opt, *memory_opt,
+		  *solver, *error, *iter;
     struct Flag *null_flag, *cross_corr_flag;
 
     struct Reg_dimens dims;
@@ -133,6 +135,14 @@ int main(int argc, char *argv[])
     lambda_f_opt->answer = "0.01";
     lambda_f_opt->guisection = _("Settings");
 
+    solver = N_define_standard_option(N_OPT_SOLVER_SYMM);
+    solver->options = "cholesky,cg";
+    solver->answer = "cholesky";
+
+    iter = N_define_standard_option(N_OPT_MAX_ITERATIONS);
+
+    error = N_define_standard_option(N_OPT_ITERATION_ERROR);
+
     null_flag = G_define_flag();
     null_flag->key = 'n';
     null_flag->label = _("Only interpolate null cells in input raster map");
@@ -162,6 +172,11 @@ int main(int argc, char *argv[])
     else
 	interp_method = P_BICUBIC;
 
+    if (G_strncasecmp(solver->answer, "cg", 2) == 0)
+	solver_type = P_CG;
+    else
+	solver_type = P_CHOLESKY;
+
     lambda = atof(lambda_f_opt->answer);
 
     /* Setting regions and boxes */
@@ -674,7 +689,8 @@ int main(int argc, char *argv[])
 		    nCorrectGrad(N, lambda, nsplx, nsply, stepE, stepN);
 		}
 
-		G_math_solver_cholesky_sband(N, parVect, TN, nparameters, BW);
+		normalSolve(N, parVect, TN, nparameters, BW, solver_type,
+			    atoi(iter->answer), atof(error->answer));
 
 		G_free_matrix(N);
 		G_free_vector(TN);
@@ -24,50 +24,276 @@
 #include <grass/raster.h>
 #include <grass/glocale.h>
 
+#define BLOCK_ROWS 8
+
 static int neighbors;
-static DCELL *bufs[5];
-static int cur_row;
 
-static void read_rows(int infile, int row)
+struct block
 {
-    int end_row = cur_row + neighbors;
-    int first_row = row;
-    int last_row = row + neighbors;
-    int offset = first_row - cur_row;
-    int keep = end_row - first_row;
-    int i;
+    DCELL **pool;		/* distinct input rows of the block, sorted */
+    int *pool_row;		/* input row number of each pool entry */
+    int npool;			/* number of valid pool entries */
+    DCELL **new_pool;		/* work space of load_rows() */
+    int *new_pool_row;
+    int cap;			/* number of pool buffers */
+    int *first;			/* pool entry of the first row of each output row */
+    double *v;			/* row fraction of each output row */
+    DCELL **out;		/* output rows */
+    int ncols;
+    const int *col_first;	/* first input column of each output column */
+    const double *col_u;	/* column fraction of each output column */
+    int chunk;			/* rows per thread */
+};
+
+/* first input row or column of the neighborhood of the coordinate f and
+ * the fraction of f relative to the central one */
+static int map_coord(double f, double *frac)
+{
+    int base;
+
+    switch (neighbors) {
+    case 1:			/* nearest */
+	base = (int)floor(f + 0.5);
+	*frac = 0;
+	return base;
+    case 2:			/* bilinear */
+	base = (int)floor(f);
+	*frac = f - base;
+	return base;
+    case 4:			/* bicubic */
+	base = (int)floor(f);
+	*frac = f - base;
+	return base - 1;
+    default:			/* lanczos */
+	base = (int)floor(f + 0.5);
+	*frac = f - base;
+	return base - 2;
+    }
+}
+
+/* Makes the pool hold the input rows needed by the output rows of a
+ * block, reusing the rows of the previous block. The rows of an output
+ * row are consecutive in the pool. */
+static void load_rows(struct block *blk, int infile, const int *row_first,
+		      int n)
+{
+    DCELL **tmp;
+    int *tmp_row;
+    int m, i, j, k, p;
+
+    m = 0;
+    j = 0;
+    for (i = 0; i < n; i++) {
+	for (k = 0; k < neighbors; k++) {
+	    int r = row_first[i] + k;
+
+	    if (m > 0 && blk->new_pool_row[m - 1] >= r)
+		continue;
+
+	    while (j < blk->npool && blk->pool_row[j] < r)
+		j++;
+
+	    if (j < blk->npool && blk->pool_row[j] == r) {
+		blk->new_pool[m] = blk->pool[j];
+		blk->pool[j] = NULL;
+	    }
+	    else
+		blk->new_pool[m] = NULL;
+	    blk->new_pool_row[m++] = r;
+	}
+    }
+
+    /* read the missing rows into the buffers which are not reused */
+    p = 0;
+    for (i = 0; i < m; i++) {
+	if (blk->new_pool[i])
+	    continue;
+	while (!blk->pool[p])
+	    p++;
+	blk->new_pool[i] = blk->pool[p];
+	blk->pool[p] = NULL;
+	Rast_get_d_row(infile, blk->new_pool[i], blk->new_pool_row[i]);
+    }
+    for (i = m; i < blk->cap; i++) {
+	while (!blk->pool[p])
+	    p++;
+	blk->new_pool[i] = blk->pool[p];
+	blk->pool[p] = NULL;
+    }
+
+    tmp = blk->pool;
+    blk->pool = blk->new_pool;
+    blk->new_pool = tmp;
+    tmp_row = blk->pool_row;
+    blk->pool_row = blk->new_pool_row;
+    blk->new_pool_row = tmp_row;
+    blk->npool = m;
+
+    p = 0;
+    for (i = 0; i < n; i++) {
+	while (blk->pool_row[p] < row_first[i])
+	    p++;
+	blk->first[i] = p;
+    }
+}
+
+/* interpolates the output row i of a block */
+static void process_row(const struct block *blk, int i)
+{
+    DCELL **bufs = blk->pool + blk->first[i];
+    DCELL *outbuf = blk->out[i];
+    double v = blk->v[i];
+    int col;
 
-    if (end_row >= last_row)
-	return;
+    switch (neighbors) {
+    case 1:			/* nearest */
+	for (col = 0; col < blk->ncols; col++) {
+	    int mapcol0 = blk->col_first[col];
 
-    if (keep > 0 && offset > 0)
-	for (i = 0; i < keep; i++) {
-	    DCELL *tmp = bufs[i];
+	    double c = bufs[0][mapcol0];
 
-	    bufs[i] = bufs[i + offset];
-	    bufs[i + offset] = tmp;
+	    if (Rast_is_d_null_value(&c)) {
+		Rast_set_d_null_value(&outbuf[col], 1);
+	    }
+	    else {
+		outbuf[col] = c;
+	    }
 	}
+	break;
 
-    if (keep < 0)
-	keep = 0;
+    case 2:			/* bilinear */
+	for (col = 0; col < blk->ncols; col++) {
+	    int mapcol0 = blk->col_first[col];
+	    int mapcol1 = mapcol0 + 1;
+	    double u = blk->col_u[col];
+
+	    double c00 = bufs[0][mapcol0];
+	    double c01 = bufs[0][mapcol1];
+	    double c10 = bufs[1][mapcol0];
+	    double c11 = bufs[1][mapcol1];
+
+	    if (Rast_is_d_null_value(&c00) ||
+		Rast_is_d_null_value(&c01) ||
+		Rast_is_d_null_value(&c10) || Rast_is_d_null_value(&c11)) {
+		Rast_set_d_null_value(&outbuf[col], 1);
+	    }
+	    else {
+		outbuf[col] = Rast_interp_bilinear(u, v, c00, c01, c10, c11);
+	    }
+	}
+	break;
+
+    case 4:			/* bicubic */
+	for (col = 0; col < blk->ncols; col++) {
+	    int mapcol0 = blk->col_first[col];
+	    int mapcol1 = mapcol0 + 1;
+	    int mapcol2 = mapcol0 + 2;
+	    int mapcol3 = mapcol0 + 3;
+	    double u = blk->col_u[col];
+
+	    double c00 = bufs[0][mapcol0];
+	    double c01 = bufs[0][mapcol1];
+	    double c02 = bufs[0][mapcol2];
+	    double c03 = bufs[0][mapcol3];
+
+	    double c10 = bufs[1][mapcol0];
+	    double c11 = bufs[1][mapcol1];
+	    double c12 = bufs[1][mapcol2];
+	    double c13 = bufs[1][mapcol3];
+
+	    double c20 = bufs[2][mapcol0];
+	    double c21 = bufs[2][mapcol1];
+	    double c22 = bufs[2][mapcol2];
+	    double c23 = bufs[2][mapcol3];
+
+	    double c30 = bufs[3][mapcol0];
+	    double c31 = bufs[3][mapcol1];
+	    double c32 = bufs[3][mapcol2];
+	    double c33 = bufs[3][mapcol3];
+
+	    if (Rast_is_d_null_value(&c00) ||
+		Rast_is_d_null_value(&c01) ||
+		Rast_is_d_null_value(&c02) ||
+		Rast_is_d_null_value(&c03) ||
+		Rast_is_d_null_value(&c10) ||
+		Rast_is_d_null_value(&c11) ||
+		Rast_is_d_null_value(&c12) ||
+		Rast_is_d_null_value(&c13) ||
+		Rast_is_d_null_value(&c20) ||
+		Rast_is_d_null_value(&c21) ||
+		Rast_is_d_null_value(&c22) ||
+		Rast_is_d_null_value(&c23) ||
+		Rast_is_d_null_value(&c30) ||
+		Rast_is_d_null_value(&c31) ||
+		Rast_is_d_null_value(&c32) || Rast_is_d_null_value(&c33)) {
+		Rast_set_d_null_value(&outbuf[col], 1);
+	    }
+	    else {
+		outbuf[col] = Rast_interp_bicubic(u, v,
+						  c00, c01, c02, c03,
+						  c10, c11, c12, c13,
+						  c20, c21, c22, c23,
+						  c30, c31, c32, c33);
+	    }
+	}
+	break;
 
-    for (i = keep; i < neighbors; i++)
-	Rast_get_d_row(infile, bufs[i], first_row + i);
+    case 5:			/* lanczos */
+	for (col = 0; col < blk->ncols; col++) {
+	    int mapcol0 = blk->col_first[col];
+	    int mapcol4 = mapcol0 + 4;
+	    double u = blk->col_u[col];
+	    double c[25];
+	    int ci = 0, i, j, do_lanczos = 1;
+
+	    for (i = 0; i < 5; i++) {
+		for (j = mapcol0; j <= mapcol4; j++) {
+		    c[ci] = bufs[i][j];
+		    if (Rast_is_d_null_value(&(c[ci]))) {
+			Rast_set_d_null_value(&outbuf[col], 1);
+			do_lanczos = 0;
+			break;
+		    }
+		    ci++;
+		}
+		if (!do_lanczos)
+		    break;
+	    }
 
-    cur_row = first_row;
+	    if (do_lanczos) {
+		outbuf[col] = Rast_interp_lanczos(u, v, c);
+	    }
+	}
+	break;
+    }
+}
+
+/* the threads share the pool of input rows, loaded once for the block
+ * even where output rows use the same input rows, and the column
+ * weights; each writes only the output rows it was given and needs no
+ * buffers of its own */
+static void process_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    int i;
+
+    for (i = first; i < last; i++)
+	process_row(blk, i);
 }
 
 int main(int argc, char *argv[])
 {
     struct GModule *module;
-    struct Option *rastin, *rastout, *method;
+    struct Option *rastin, *rastout, *method, *nprocs;
     struct History history;
     char title[64];
     char buf_nsres[100], buf_ewres[100];
     struct Colors colors;
     int infile, outfile;
-    DCELL *outbuf;
-    int row, col;
+    int row, col, i, n, nthreads, nblock;
+    int *row_first, *col_first;
+    double *row_v, *col_u;
+    struct block blk;
     struct Cell_head dst_w, src_w;
 
     G_gisinit(argv[0]);
@@ -86,7 +312,9 @@ int main(int argc, char *argv[])
     method->options = "nearest,bilinear,bicubic,lanczos";
     method->answer = "bilinear";
     method->guisection = _("Method");
-    
+
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
@@ -101,6 +329,9 @@ int main(int argc, char *argv[])
     else
 	G_fatal_error(_("Invalid method: %s"), method->answer);
 
+    nthreads = G_set_nprocs(nprocs);
+    nblock = nthreads > 1 ? nthreads * BLOCK_ROWS : 1;
+
     G_get_set_window(&dst_w);
 
     /* set window to old map */
@@ -144,11 +375,34 @@ int main(int argc, char *argv[])
 
     Rast_set_input_window(&src_w);
 
-    /* allocate buffers for input rows */
-    for (row = 0; row < neighbors; row++)
-	bufs[row] = Rast_allocate_d_input_buf();
+    /* input rows and columns of the output rows and columns */
+    row_first = G_malloc(dst_w.rows * sizeof(int));
+    row_v = G_malloc(dst_w.rows * sizeof(double));
+    for (row = 0; row < dst_w.rows; row++) {
+	double north = Rast_row_to_northing(row + 0.5, &dst_w);
+	double maprow_f = Rast_northing_to_row(north, &src_w) - 0.5;
+
+	row_first[row] = map_coord(maprow_f, &row_v[row]);
+    }
+
+    col_first = G_malloc(dst_w.cols * sizeof(int));
+    col_u = G_malloc(dst_w.cols * sizeof(double));
+    for (col = 0; col < dst_w.cols; col++) {
+	double east = Rast_col_to_easting(col + 0.5, &dst_w);
+	double mapcol_f = Rast_easting_to_col(east, &src_w) - 0.5;
+
+	col_first[col] = map_coord(mapcol_f, &col_u[col]);
+    }
 
-    cur_row = -100;
+    /* allocate buffers for input rows */
+    blk.cap = nblock * neighbors;
+    blk.pool = G_malloc(blk.cap * sizeof(DCELL *));
+    blk.new_pool = G_malloc(blk.cap * sizeof(DCELL *));
+    blk.pool_row = G_malloc(blk.cap * sizeof(int));
+    blk.new_pool_row = G_malloc(blk.cap * sizeof(int));
+    for (i = 0; i < blk.cap; i++)
+	blk.pool[i] = Rast_allocate_d_input_buf();
+    blk.npool = 0;
 
     /* open old map */
     infile = Rast_open_old(rastin->answer, "");
@@ -156,193 +410,31 @@ int main(int argc, char *argv[])
     /* reset window to current region */
     Rast_set_output_window(&dst_w);
 
-    outbuf = Rast_allocate_d_output_buf();
+    blk.out = G_malloc(nblock * sizeof(DCELL *));
+    for (i = 0; i < nblock; i++)
+	blk.out[i] = Rast_allocate_d_output_buf();
+    blk.first = G_malloc(nblock * sizeof(int));
+    blk.ncols = dst_w.cols;
+    blk.col_first = col_first;
+    blk.col_u = col_u;
+    blk.chunk = (nblock + nthreads - 1) / nthreads;
 
     /* open new map */
     outfile = Rast_open_new(rastout->answer, DCELL_TYPE);
 
-    switch (neighbors) {
-    case 1:			/* nearest */
-	for (row = 0; row < dst_w.rows; row++) {
-	    double north = Rast_row_to_northing(row + 0.5, &dst_w);
-	    double maprow_f = Rast_northing_to_row(north, &src_w) - 0.5;
-	    int maprow0 = (int)floor(maprow_f + 0.5);
+    for (row = 0; row < dst_w.rows; row += n) {
+	n = dst_w.rows - row < nblock ? dst_w.rows - row : nblock;
 
-	    G_percent(row, dst_w.rows, 2);
+	G_percent(row, dst_w.rows, 2);
 
-	    read_rows(infile, maprow0);
+	load_rows(&blk, infile, row_first + row, n);
+	blk.v = row_v + row;
 
-	    for (col = 0; col < dst_w.cols; col++) {
-		double east = Rast_col_to_easting(col + 0.5, &dst_w);
-		double mapcol_f = Rast_easting_to_col(east, &src_w) - 0.5;
-		int mapcol0 = (int)floor(mapcol_f + 0.5);
+	/* the rows of a block are independent */
+	G_parallel_for(0, n, blk.chunk, process_rows, &blk);
 
-		double c = bufs[0][mapcol0];
-
-		if (Rast_is_d_null_value(&c)) {
-		    Rast_set_d_null_value(&outbuf[col], 1);
-		}
-		else {
-		    outbuf[col] = c;
-		}
-	    }
-
-	    Rast_put_d_row(outfile, outbuf);
-	}
-	break;
-
-    case 2:			/* bilinear */
-	for (row = 0; row < dst_w.rows; row++) {
-	    double north = Rast_row_to_northing(row + 0.5, &dst_w);
-	    double maprow_f = Rast_northing_to_row(north, &src_w) - 0.5;
-	    int maprow0 = (int)floor(maprow_f);
-	    double v = maprow_f - maprow0;
-
-	    G_percent(row, dst_w.rows, 2);
-
-	    read_rows(infile, maprow0);
-
-	    for (col = 0; col < dst_w.cols; col++) {
-		double east = Rast_col_to_easting(col + 0.5, &dst_w);
-		double mapcol_f = Rast_easting_to_col(east, &src_w) - 0.5;
-		int mapcol0 = (int)floor(mapcol_f);
-		int mapcol1 = mapcol0 + 1;
-		double u = mapcol_f - mapcol0;
-
-		double c00 = bufs[0][mapcol0];
-		double c01 = bufs[0][mapcol1];
-		double c10 = bufs[1][mapcol0];
-		double c11 = bufs[1][mapcol1];
-
-		if (Rast_is_d_null_value(&c00) ||
-		    Rast_is_d_null_value(&c01) ||
-		    Rast_is_d_null_value(&c10) || Rast_is_d_null_value(&c11)) {
-		    Rast_set_d_null_value(&outbuf[col], 1);
-		}
-		else {
-		    outbuf[col] = Rast_interp_bilinear(u, v, c00, c01, c10, c11);
-		}
-	    }
-
-	    Rast_put_d_row(outfile, outbuf);
-	}
-	break;
-
-    case 4:			/* bicubic */
-	for (row = 0; row < dst_w.rows; row++) {
-	    double north = Rast_row_to_northing(row + 0.5, &dst_w);
-	    double maprow_f = Rast_northing_to_row(north, &src_w) - 0.5;
-	    int maprow1 = (int)floor(maprow_f);
-	    int maprow0 = maprow1 - 1;
-	    double v = maprow_f - maprow1;
-
-	    G_percent(row, dst_w.rows, 2);
-
-	    read_rows(infile, maprow0);
-
-	    for (col = 0; col < dst_w.cols; col++) {
-		double east = Rast_col_to_easting(col + 0.5, &dst_w);
-		double mapcol_f = Rast_easting_to_col(east, &src_w) - 0.5;
-		int mapcol1 = (int)floor(mapcol_f);
-		int mapcol0 = mapcol1 - 1;
-		int mapcol2 = mapcol1 + 1;
-		int mapcol3 = mapcol1 + 2;
-		double u = mapcol_f - mapcol1;
-
-		double c00 = bufs[0][mapcol0];
-		double c01 = bufs[0][mapcol1];
-		double c02 = bufs[0][mapcol2];
-		double c03 = bufs[0][mapcol3];
-
-		double c10 = bufs[1][mapcol0];
-		double c11 = bufs[1][mapcol1];
-		double c12 = bufs[1][mapcol2];
-		double c13 = bufs[1][mapcol3];
-
-		double c20 = bufs[2][mapcol0];
-		double c21 = bufs[2][mapcol1];
-		double c22 = bufs[2][mapcol2];
-		double c23 = bufs[2][mapcol3];
-
-		double c30 = bufs[3][mapcol0];
-		double c31 = bufs[3][mapcol1];
-		double c32 = bufs[3][mapcol2];
-		double c33 = bufs[3][mapcol3];
-
-		if (Rast_is_d_null_value(&c00) ||
-		    Rast_is_d_null_value(&c01) ||
-		    Rast_is_d_null_value(&c02) ||
-		    Rast_is_d_null_value(&c03) ||
-		    Rast_is_d_null_value(&c10) ||
-		    Rast_is_d_null_value(&c11) ||
-		    Rast_is_d_null_value(&c12) ||
-		    Rast_is_d_null_value(&c13) ||
-		    Rast_is_d_null_value(&c20) ||
-		    Rast_is_d_null_value(&c21) ||
-		    Rast_is_d_null_value(&c22) ||
-		    Rast_is_d_null_value(&c23) ||
-		    Rast_is_d_null_value(&c30) ||
-		    Rast_is_d_null_value(&c31) ||
-		    Rast_is_d_null_value(&c32) || Rast_is_d_null_value(&c33)) {
-		    Rast_set_d_null_value(&outbuf[col], 1);
-		}
-		else {
-		    outbuf[col] = Rast_interp_bicubic(u, v,
-						   c00, c01, c02, c03,
-						   c10, c11, c12, c13,
-						   c20, c21, c22, c23,
-						   c30, c31, c32, c33);
-		}
-	    }
-
-	    Rast_put_d_row(outfile, outbuf);
-	}
-	break;
-
-    case 5:			/* lanczos */
-	for (row = 0; row < dst_w.rows; row++) {
-	    double north = Rast_row_to_northing(row + 0.5, &dst_w);
-	    double maprow_f = Rast_northing_to_row(north, &src_w) - 0.5;
-	    int maprow1 = (int)floor(maprow_f + 0.5);
-	    int maprow0 = maprow1 - 2;
-	    double v = maprow_f - maprow1;
-
-	    G_percent(row, dst_w.rows, 2);
-
-	    read_rows(infile, maprow0);
-
-	    for (col = 0; col < dst_w.cols; col++) {
-		double east = Rast_col_to_easting(col + 0.5, &dst_w);
-		double mapcol_f = Rast_easting_to_col(east, &src_w) - 0.5;
-		int mapcol2 = (int)floor(mapcol_f + 0.5);
-		int mapcol0 = mapcol2 - 2;
-		int mapcol4 = mapcol2 + 2;
-		double u = mapcol_f - mapcol2;
-		double c[25];
-		int ci = 0, i, j, do_lanczos = 1;
-
-		for (i = 0; i < 5; i++) {
-		    for (j = mapcol0; j <= mapcol4; j++) {
-			c[ci] = bufs[i][j];
-			if (Rast_is_d_null_value(&(c[ci]))) {
-			    Rast_set_d_null_value(&outbuf[col], 1);
-			    do_lanczos = 0;
-			    break;
-			}
-			ci++;
-		    }
-		    if (!do_lanczos)
-			break;
-		}
-
-		if (do_lanczos) {
-		    outbuf[col] = Rast_interp_lanczos(u, v, c);
-		}
-	    }
-
-	    Rast_put_d_row(outfile, outbuf);
-	}
-	break;
+	for (i = 0; i < n; i++)
+	    Rast_put_d_row(outfile, blk.out[i]);
     }
 
     G_percent(dst_w.rows, dst_w.rows, 2);
@@ -30,6 +30,9 @@
  */
 
 
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
@@ -128,13 +131,14 @@ int main(int argc, char *argv[])
     struct FPRange range;
     DCELL cellmin, cellmax;
     FCELL *cellrow, fcellmin;
+    int threads;
 
     struct GModule *module;
     struct
     {
 	struct Option *input, *elev, *slope, *aspect, *pcurv, *tcurv, *mcurv,
 	    *smooth, *maskmap, *zmult, *fi, *segmax, *npmin, *res_ew, *res_ns,
-	    *overlap, *theta, *scalex;
+	    *overlap, *theta, *scalex, *threads;
     } parm;
     struct
     {
@@ -253,6 +257,9 @@ int main(int argc, char *argv[])
     parm.scalex->description = _("Anisotropy scaling factor");
     parm.scalex->guisection = _("Anisotropy");
 
+    parm.threads = G_define_standard_option(G_OPT_M_NPROCS);
+    parm.threads->guisection = _("Settings");
+
     flag.cprght = G_define_flag();
     flag.cprght->key = 't';
     flag.cprght->description = _("Use dnorm independent tension");
@@ -266,6 +273,15 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    threads = G_set_nprocs(parm.threads);
+#if defined(_OPENMP)
+    omp_set_num_threads(threads);
+#else
+    if (threads > 1)
+	G_warning(_("GRASS GIS is not compiled with OpenMP support, parallel computation is disabled."));
+    threads = 1;
+#endif
+
     G_get_set_window(&winhd);
 
     inp_ew_res = winhd.ew_res;
@@ -479,12 +495,14 @@ int main(int argc, char *argv[])
 
 
     NPOINT =
-	IL_resample_interp_segments_2d(&params, bitmask, zmin, zmax, &zminac,
-				       &zmaxac, &gmin, &gmax, &c1min, &c1max,
-				       &c2min, &c2max, &ertot, nsizc, &dnorm,
-				       overlap, inp_rows, inp_cols, fdsmooth,
-				       fdinp, ns_res, ew_res, inp_ns_res,
-				       inp_ew_res, dtens);
+	IL_resample_interp_segments_2d_parallel(&params, bitmask, zmin, zmax,
+						&zminac, &zmaxac, &gmin, &gmax,
+						&c1min, &c1max, &c2min, &c2max,
+						&ertot, nsizc, &dnorm, overlap,
+						inp_rows, inp_cols, fdsmooth,
+						fdinp, ns_res, ew_res,
+						inp_ns_res, inp_ew_res, dtens,
+						threads);
 
 
     G_message(_("dnorm in mainc after grid before out1= %f"), dnorm);
@@ -76,6 +76,17 @@ static int find_method(const char *name)
     return -1;
 }
 
+/* methods computed by accumulating the input rows in order */
+enum
+{
+    FAST_NONE,
+    FAST_AVE,
+    FAST_SUM,
+    FAST_COUNT,
+    FAST_MIN,
+    FAST_MAX
+};
+
 static int nulls;
 static int infile, outfile;
 static struct Cell_head dst_w, src_w;
@@ -86,25 +97,178 @@ static const void *closure;
 static int row_scale, col_scale;
 static double quantile;
 
-static void resamp_unweighted(void)
+static int fast;		/* FAST_* kind of the method */
+static int chunk;		/* output columns per thread */
+static void **values;		/* value buffer of each thread */
+static DCELL *acc_sum, *acc_count, *acc_ext;	/* per output column */
+static char *acc_null;
+static int *col_map_u;		/* input column edges of output columns */
+static double *col_map_w;
+
+/* input rows of the output row being computed */
+struct row_job
 {
-    stat_func *method_fn;
-    DCELL *values;
-    int *col_map, *row_map;
-    int row, col;
+    int maprow0, maprow1;
+    double y0, y1;		/* exact edges, weighted only */
+};
+
+static int find_fast(void)
+{
+    stat_func *fn = menu[method].method;
+
+    if (fn == c_ave)
+	return FAST_AVE;
+    if (fn == c_sum)
+	return FAST_SUM;
+    if (fn == c_count)
+	return FAST_COUNT;
+    if (fn == c_min)
+	return FAST_MIN;
+    if (fn == c_max)
+	return FAST_MAX;
+
+    return FAST_NONE;
+}
+
+static void acc_init(int first, int last)
+{
+    int col;
+
+    for (col = first; col < last; col++) {
+	acc_sum[col] = 0.0;
+	acc_count[col] = 0.0;
+	Rast_set_d_null_value(&acc_ext[col], 1);
+	acc_null[col] = 0;
+    }
+}
+
+/* same order of summation and tests as the lib/stats functions */
+static void acc_add(int col, DCELL v, DCELL w)
+{
+    switch (fast) {
+    case FAST_MIN:
+	if (Rast_is_d_null_value(&acc_ext[col]) || acc_ext[col] > v)
+	    acc_ext[col] = v;
+	break;
+    case FAST_MAX:
+	if (Rast_is_d_null_value(&acc_ext[col]) || acc_ext[col] < v)
+	    acc_ext[col] = v;
+	break;
+    default:
+	acc_sum[col] += v * w;
+	acc_count[col] += w;
+	break;
+    }
+}
+
+static void acc_result(int first, int last)
+{
+    int col;
+
+    for (col = first; col < last; col++) {
+	DCELL *dst = &outbuf[col];
+
+	if (acc_null[col] && nulls) {
+	    Rast_set_d_null_value(dst, 1);
+	    continue;
+	}
+
+	switch (fast) {
+	case FAST_AVE:
+	    if (acc_count[col] == 0)
+		Rast_set_d_null_value(dst, 1);
+	    else
+		*dst = acc_sum[col] / acc_count[col];
+	    break;
+	case FAST_SUM:
+	    if (acc_count[col] == 0)
+		Rast_set_d_null_value(dst, 1);
+	    else
+		*dst = acc_sum[col];
+	    break;
+	case FAST_COUNT:
+	    *dst = acc_count[col];
+	    break;
+	default:
+	    *dst = acc_ext[col];
+	    break;
+	}
+    }
+}
+
+/* computes the output columns first to last - 1 of a row */
+static void unweighted_cols(int first, int last, void *p)
+{
+    const struct row_job *job = p;
+    int maprow0 = job->maprow0;
+    int maprow1 = job->maprow1;
+    int col, i, j;
+
+    if (fast) {
+	/* stream through the input rows without gathering the values */
+	acc_init(first, last);
+
+	for (i = maprow0; i < maprow1; i++) {
+	    const DCELL *src = bufs[i - maprow0];
+
+	    for (col = first; col < last; col++) {
+		int mapcol0 = col_map_u[col + 0];
+		int mapcol1 = col_map_u[col + 1];
+
+		for (j = mapcol0; j < mapcol1; j++) {
+		    if (Rast_is_d_null_value(&src[j]))
+			acc_null[col] = 1;
+		    else
+			acc_add(col, src[j], 1.0);
+		}
+	    }
+	}
+
+	acc_result(first, last);
+	return;
+    }
+
+    for (col = first; col < last; col++) {
+	stat_func *method_fn = menu[method].method;
+	DCELL *vals = values[first / chunk];
+	int mapcol0 = col_map_u[col + 0];
+	int mapcol1 = col_map_u[col + 1];
+	int null = 0;
+	int n = 0;
+
+	for (i = maprow0; i < maprow1; i++)
+	    for (j = mapcol0; j < mapcol1; j++) {
+		DCELL *src = &bufs[i - maprow0][j];
+		DCELL *dst = &vals[n++];
+
+		if (Rast_is_d_null_value(src)) {
+		    Rast_set_d_null_value(dst, 1);
+		    null = 1;
+		}
+		else
+		    *dst = *src;
+	    }
 
-    method_fn = menu[method].method;
+	if (null && nulls)
+	    Rast_set_d_null_value(&outbuf[col], 1);
+	else
+	    (*method_fn) (&outbuf[col], vals, n, closure);
+    }
+}
 
-    values = G_malloc(row_scale * col_scale * sizeof(DCELL));
+static void resamp_unweighted(void)
+{
+    int *row_map;
+    int row, col;
 
-    col_map = G_malloc((dst_w.cols + 1) * sizeof(int));
+    col_map_u = G_malloc((dst_w.cols + 1) * sizeof(int));
     row_map = G_malloc((dst_w.rows + 1) * sizeof(int));
 
     for (col = 0; col <= dst_w.cols; col++) {
 	double x = Rast_col_to_easting(col, &dst_w);
 
 	/* col_map[col] = (int)floor(Rast_easting_to_col(x, &src_w) + 0.5); */
-	col_map[col] = (int)floor((x - src_w.west) / src_w.ew_res + 0.5);
+	col_map_u[col] = (int)floor((x - src_w.west) / src_w.ew_res + 0.5);
     }
 
     for (row = 0; row <= dst_w.rows; row++) {
@@ -114,66 +278,126 @@ static void resamp_unweighted(void)
     }
 
     for (row = 0; row < dst_w.rows; row++) {
-	int maprow0 = row_map[row + 0];
-	int maprow1 = row_map[row + 1];
-	int count = maprow1 - maprow0;
+	struct row_job job;
+	int count;
 	int i;
 
+	job.maprow0 = row_map[row + 0];
+	job.maprow1 = row_map[row + 1];
+	count = job.maprow1 - job.maprow0;
+
 	G_percent(row, dst_w.rows, 4);
 
 	for (i = 0; i < count; i++)
-	    Rast_get_d_row(infile, bufs[i], maprow0 + i);
+	    Rast_get_d_row(infile, bufs[i], job.maprow0 + i);
 
-	for (col = 0; col < dst_w.cols; col++) {
-	    int mapcol0 = col_map[col + 0];
-	    int mapcol1 = col_map[col + 1];
-	    int null = 0;
-	    int n = 0;
-	    int i, j;
+	/* the output columns are independent */
+	G_parallel_for(0, dst_w.cols, chunk, unweighted_cols, &job);
+
+	Rast_put_d_row(outfile, outbuf);
+    }
+
+    G_free(col_map_u);
+    G_free(row_map);
+}
+
+/* computes the output columns first to last - 1 of a row */
+static void weighted_cols(int first, int last, void *p)
+{
+    const struct row_job *job = p;
+    double y0 = job->y0;
+    double y1 = job->y1;
+    int maprow0 = job->maprow0;
+    int maprow1 = job->maprow1;
+    int col, i, j;
+
+    if (fast) {
+	/* stream through the input rows without gathering the values */
+	acc_init(first, last);
+
+	for (i = maprow0; i < maprow1; i++) {
+	    const DCELL *src = bufs[i - maprow0];
+	    double ky = (i == maprow0) ? 1 - (y0 - maprow0)
+		: (i == maprow1 - 1) ? 1 - (maprow1 - y1)
+		: 1;
+
+	    for (col = first; col < last; col++) {
+		double x0 = col_map_w[col + 0];
+		double x1 = col_map_w[col + 1];
+		int mapcol0 = (int)floor(x0);
+		int mapcol1 = (int)ceil(x1);
 
-	    for (i = maprow0; i < maprow1; i++)
 		for (j = mapcol0; j < mapcol1; j++) {
-		    DCELL *src = &bufs[i - maprow0][j];
-		    DCELL *dst = &values[n++];
+		    double kx = (j == mapcol0) ? 1 - (x0 - mapcol0)
+			: (j == mapcol1 - 1) ? 1 - (mapcol1 - x1)
+			: 1;
 
-		    if (Rast_is_d_null_value(src)) {
-			Rast_set_d_null_value(dst, 1);
-			null = 1;
-		    }
+		    if (Rast_is_d_null_value(&src[j]))
+			acc_null[col] = 1;
 		    else
-			*dst = *src;
+			acc_add(col, src[j], kx * ky);
 		}
+	    }
+	}
 
-	    if (null && nulls)
-		Rast_set_d_null_value(&outbuf[col], 1);
-	    else
-		(*method_fn) (&outbuf[col], values, n, closure);
+	acc_result(first, last);
+	return;
+    }
+
+    for (col = first; col < last; col++) {
+	stat_func_w *method_fn = menu[method].method_w;
+	DCELL(*vals)[2] = values[first / chunk];
+	double x0 = col_map_w[col + 0];
+	double x1 = col_map_w[col + 1];
+	int mapcol0 = (int)floor(x0);
+	int mapcol1 = (int)ceil(x1);
+	int null = 0;
+	int n = 0;
+
+	for (i = maprow0; i < maprow1; i++) {
+	    double ky = (i == maprow0) ? 1 - (y0 - maprow0)
+		: (i == maprow1 - 1) ? 1 - (maprow1 - y1)
+		: 1;
+
+	    for (j = mapcol0; j < mapcol1; j++) {
+		double kx = (j == mapcol0) ? 1 - (x0 - mapcol0)
+		    : (j == mapcol1 - 1) ? 1 - (mapcol1 - x1)
+		    : 1;
+
+		DCELL *src = &bufs[i - maprow0][j];
+		DCELL *dst = &vals[n++][0];
+
+		if (Rast_is_d_null_value(src)) {
+		    Rast_set_d_null_value(&dst[0], 1);
+		    null = 1;
+		}
+		else {
+		    dst[0] = *src;
+		    dst[1] = kx * ky;
+		}
+	    }
 	}
 
-	Rast_put_d_row(outfile, outbuf);
+	if (null && nulls)
+	    Rast_set_d_null_value(&outbuf[col], 1);
+	else
+	    (*method_fn) (&outbuf[col], vals, n, closure);
     }
 }
 
 static void resamp_weighted(void)
 {
-    stat_func_w *method_fn;
-
-    DCELL(*values)[2];
-    double *col_map, *row_map;
+    double *row_map;
     int row, col;
 
-    method_fn = menu[method].method_w;
-
-    values = G_malloc(row_scale * col_scale * 2 * sizeof(DCELL));
-
-    col_map = G_malloc((dst_w.cols + 1) * sizeof(double));
+    col_map_w = G_malloc((dst_w.cols + 1) * sizeof(double));
     row_map = G_malloc((dst_w.rows + 1) * sizeof(double));
 
     for (col = 0; col <= dst_w.cols; col++) {
 	double x = Rast_col_to_easting(col, &dst_w);
 
 	/* col_map[col] = Rast_easting_to_col(x, &src_w); */
-	col_map[col] = (x - src_w.west) / src_w.ew_res;
+	col_map_w[col] = (x - src_w.west) / src_w.ew_res;
     }
 
     for (row = 0; row <= dst_w.rows; row++) {
@@ -183,59 +407,29 @@ static void resamp_weighted(void)
     }
 
     for (row = 0; row < dst_w.rows; row++) {
-	double y0 = row_map[row + 0];
-	double y1 = row_map[row + 1];
-	int maprow0 = (int)floor(y0);
-	int maprow1 = (int)ceil(y1);
-	int count = maprow1 - maprow0;
+	struct row_job job;
+	int count;
 	int i;
 
+	job.y0 = row_map[row + 0];
+	job.y1 = row_map[row + 1];
+	job.maprow0 = (int)floor(job.y0);
+	job.maprow1 = (int)ceil(job.y1);
+	count = job.maprow1 - job.maprow0;
+
 	G_percent(row, dst_w.rows, 4);
 
 	for (i = 0; i < count; i++)
-	    Rast_get_d_row(infile, bufs[i], maprow0 + i);
-
-	for (col = 0; col < dst_w.cols; col++) {
-	    double x0 = col_map[col + 0];
-	    double x1 = col_map[col + 1];
-	    int mapcol0 = (int)floor(x0);
-	    int mapcol1 = (int)ceil(x1);
-	    int null = 0;
-	    int n = 0;
-	    int i, j;
-
-	    for (i = maprow0; i < maprow1; i++) {
-		double ky = (i == maprow0) ? 1 - (y0 - maprow0)
-		    : (i == maprow1 - 1) ? 1 - (maprow1 - y1)
-		    : 1;
+	    Rast_get_d_row(infile, bufs[i], job.maprow0 + i);
 
-		for (j = mapcol0; j < mapcol1; j++) {
-		    double kx = (j == mapcol0) ? 1 - (x0 - mapcol0)
-			: (j == mapcol1 - 1) ? 1 - (mapcol1 - x1)
-			: 1;
-
-		    DCELL *src = &bufs[i - maprow0][j];
-		    DCELL *dst = &values[n++][0];
-
-		    if (Rast_is_d_null_value(src)) {
-			Rast_set_d_null_value(&dst[0], 1);
-			null = 1;
-		    }
-		    else {
-			dst[0] = *src;
-			dst[1] = kx * ky;
-		    }
-		}
-	    }
-
-	    if (null && nulls)
-		Rast_set_d_null_value(&outbuf[col], 1);
-	    else
-		(*method_fn) (&outbuf[col], values, n, closure);
-	}
+	/* the output columns are independent */
+	G_parallel_for(0, dst_w.cols, chunk, weighted_cols, &job);
 
 	Rast_put_d_row(outfile, outbuf);
     }
+
+    G_free(col_map_w);
+    G_free(row_map);
 }
 
 int main(int argc, char *argv[])
@@ -243,7 +437,7 @@ int main(int argc, char *argv[])
     struct GModule *module;
     struct
     {
-	struct Option *rastin, *rastout, *method, *quantile;
+	struct Option *rastin, *rastout, *method, *quantile, *nprocs;
     } parm;
     struct
     {
@@ -253,7 +447,7 @@ int main(int argc, char *argv[])
     char title[64];
     char buf_nsres[100], buf_ewres[100];
     struct Colors colors;
-    int row;
+    int row, i, nprocs;
 
     G_gisinit(argv[0]);
 
@@ -283,6 +477,8 @@ int main(int argc, char *argv[])
     parm.quantile->options = "0.0-1.0";
     parm.quantile->answer = "0.5";
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.nulls = G_define_flag();
     flag.nulls->key = 'n';
     flag.nulls->description = _("Propagate NULLs");
@@ -295,6 +491,7 @@ int main(int argc, char *argv[])
 	exit(EXIT_FAILURE);
 
     nulls = flag.nulls->answer;
+    nprocs = G_set_nprocs(parm.nprocs);
 
     method = find_method(parm.method->answer);
     if (method < 0)
@@ -359,6 +556,17 @@ int main(int argc, char *argv[])
     /* allocate output buffer */
     outbuf = Rast_allocate_d_output_buf();
 
+    /* the output columns of a row are split among the threads */
+    fast = find_fast();
+    chunk = (dst_w.cols + nprocs - 1) / nprocs;
+    values = G_malloc(nprocs * sizeof(void *));
+    for (i = 0; i < nprocs; i++)
+	values[i] = G_malloc(row_scale * col_scale * 2 * sizeof(DCELL));
+    acc_sum = G_malloc(dst_w.cols * sizeof(DCELL));
+    acc_count = G_malloc(dst_w.cols * sizeof(DCELL));
+    acc_ext = G_malloc(dst_w.cols * sizeof(DCELL));
+    acc_null = G_malloc(dst_w.cols);
+
     /* open new map */
     outfile = Rast_open_new(parm.rastout->answer, DCELL_TYPE);
 
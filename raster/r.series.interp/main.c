@@ -16,8 +16,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <limits.h>
 #include <math.h>
 
+#include <grass/config.h>
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/glocale.h>
@@ -26,6 +31,13 @@
 #define LINEAR_INTERPOLATION 1
 #define SPLINE_INTERPOLATION 2
 
+/* rows per thread in a band */
+#define BLOCK_ROWS 8
+/* cells of all row buffers of a band */
+#define BAND_CELLS (1 << 25)
+#define FDS_PER_MAP 2
+#define FDS_RESERVED 32
+
 struct map_store
 {
     const char *name;
@@ -33,14 +45,30 @@ struct map_store
     DCELL *buf;
     int fd;
     int has_run;
+    int left;			/* output: index of the left input of its interval */
+    DCELL **band;		/* rows of the current band */
+};
+
+/* outputs interpolated in one pass over the rows */
+struct group
+{
+    struct map_store **inp;	/* inputs of the intervals of the group */
+    int num_inputs;
+    int first_input;		/* index of inp[0] in all inputs */
+    struct map_store **outp;
+    int num_outputs;
+    int ncols;
+    int chunk;			/* rows per thread */
 };
 
 void selection_sort(struct map_store **array, int num); 
 static struct map_store *get_parameter_input(const char *type, char **map_names, char **positions, char *file, int *number_of_maps); 
 static void linear_interpolation(struct map_store **inp, int num_inputs, struct map_store **outp, int num_outputs);
-static void interpolate_row_linear(struct map_store *left, struct map_store *right, struct map_store *out, int ncols);
+static void interpolate_row_linear(const DCELL *u1, const DCELL *u2, DCELL *v, double left_pos, double right_pos, double pos, int ncols);
 static void start_interpolation(struct map_store *inputs, int num_inputs, struct map_store *outputs, int num_outputs, int interpol_method); 
 
+static int nthreads = 1;
+
 /* *************************************************************** */
 /* *************************************************************** */
 /* *************************************************************** */
@@ -50,7 +78,7 @@ int main(int argc, char *argv[])
     struct GModule *module;
     struct
     {
-	struct Option *input, *datapos, *infile, *output, *samplingpos, *outfile, *method;
+	struct Option *input, *datapos, *infile, *output, *samplingpos, *outfile, *method, *nprocs;
     } parm;
     int num_outputs;
     int num_inputs;
@@ -111,9 +139,13 @@ int main(int argc, char *argv[])
     parm.method->description = _("Interpolation method, currently only linear interpolation is supported");
     parm.method->multiple = NO;
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    nthreads = G_set_nprocs(parm.nprocs);
+
     if (parm.output->answer && parm.outfile->answer)
         G_fatal_error(_("%s= and %s= are mutually exclusive"),
 			parm.output->key, parm.outfile->key);
@@ -225,6 +257,8 @@ struct map_store *get_parameter_input(const char *type, char **map_names, char *
             p->fd = -1;
             p->buf = NULL;
             p->has_run = 0;
+            p->left = -1;
+            p->band = NULL;
             G_verbose_message(_("Preparing %s map <%s> at position %g"), type, p->name, p->pos);
 	}
 
@@ -259,6 +293,8 @@ struct map_store *get_parameter_input(const char *type, char **map_names, char *
             p->fd = -1;
             p->buf = NULL;
             p->has_run = 0;
+            p->left = -1;
+            p->band = NULL;
             G_verbose_message(_("Preparing %s map <%s> at position %g"), type, p->name, p->pos);
         }
     }
@@ -304,68 +340,205 @@ void start_interpolation(struct map_store *inputs, int num_inputs, struct map_st
 /* *************************************************************** */
 /* *************************************************************** */
 
+/* number of maps which can be kept open, after raising the soft limit
+   of open files to the hard limit */
+static int max_open_maps(void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+    struct rlimit lim;
+
+    if (getrlimit(RLIMIT_NOFILE, &lim) < 0)
+	return INT_MAX;
+
+    if (lim.rlim_cur != RLIM_INFINITY && lim.rlim_cur < lim.rlim_max) {
+	struct rlimit raised = lim;
+
+	raised.rlim_cur = lim.rlim_max;
+	if (setrlimit(RLIMIT_NOFILE, &raised) == 0)
+	    lim = raised;
+	G_debug(1, "Open file limit: %ld", (long)lim.rlim_cur);
+    }
+
+    if (lim.rlim_cur != RLIM_INFINITY && lim.rlim_cur < INT_MAX)
+	return ((int)lim.rlim_cur - FDS_RESERVED) / FDS_PER_MAP;
+#endif
+
+    return INT_MAX;
+}
+
+/* runs on a worker thread for the band rows first to last - 1 */
+static void interpolate_rows(int first, int last, void *closure)
+{
+    const struct group *g = closure;
+    int i, l;
+
+    for (l = 0; l < g->num_outputs; l++) {
+	struct map_store *out = g->outp[l];
+	struct map_store *left = g->inp[out->left - g->first_input];
+	struct map_store *right = g->inp[out->left - g->first_input + 1];
+
+	for (i = first; i < last; i++)
+	    interpolate_row_linear(left->band[i], right->band[i],
+				   out->band[i], left->pos, right->pos,
+				   out->pos, g->ncols);
+    }
+}
+
+/* Interpolate the outputs of a group in one pass over the rows: each
+ * input row is read once for all outputs next to it, and the rows of
+ * a band are interpolated on several threads */
+static void interpolate_group(struct group *g)
+{
+    struct History history;
+    int nrows = Rast_window_rows();
+    int ncols = Rast_window_cols();
+    int nmaps = g->num_inputs + g->num_outputs;
+    int nband, row, n, i, l;
+
+    /* rows of a band, limited by the size of the row buffers */
+    nband = nthreads > 1 ? nthreads * BLOCK_ROWS : 1;
+    if ((double)nband * nmaps * ncols > BAND_CELLS)
+	nband = BAND_CELLS / ((double)nmaps * ncols);
+    if (nband < 1)
+	nband = 1;
+    if (nband > nrows)
+	nband = nrows;
+    g->ncols = ncols;
+    g->chunk = (nband + nthreads - 1) / nthreads;
+
+    for (i = 0; i < g->num_inputs; i++) {
+	g->inp[i]->fd = Rast_open_old(g->inp[i]->name, "");
+	g->inp[i]->band = G_malloc(nband * sizeof(DCELL *));
+	for (row = 0; row < nband; row++)
+	    g->inp[i]->band[row] = Rast_allocate_d_buf();
+    }
+    for (l = 0; l < g->num_outputs; l++) {
+	struct map_store *out = g->outp[l];
+
+	G_verbose_message(_("Interpolate map <%s> at position %g in interval (%g;%g)"), 
+			  out->name, out->pos,
+			  g->inp[out->left - g->first_input]->pos,
+			  g->inp[out->left - g->first_input + 1]->pos);
+	out->fd = Rast_open_new(out->name, DCELL_TYPE);
+	out->band = G_malloc(nband * sizeof(DCELL *));
+	for (row = 0; row < nband; row++)
+	    out->band[row] = Rast_allocate_d_buf();
+    }
+
+    G_verbose_message(_("Percent complete..."));
+
+    for (row = 0; row < nrows; row += n) {
+	n = nrows - row < nband ? nrows - row : nband;
+
+	G_percent(row, nrows, 2);
+
+	for (i = 0; i < g->num_inputs; i++) {
+	    int r;
+
+	    for (r = 0; r < n; r++)
+		Rast_get_d_row(g->inp[i]->fd, g->inp[i]->band[r], row + r);
+	}
+
+	/* the rows of a band are independent */
+	G_parallel_for(0, n, g->chunk, interpolate_rows, g);
+
+	for (l = 0; l < g->num_outputs; l++) {
+	    int r;
+
+	    for (r = 0; r < n; r++)
+		Rast_put_d_row(g->outp[l]->fd, g->outp[l]->band[r]);
+	}
+    }
+
+    G_percent(row, nrows, 2);
+
+    for (i = 0; i < g->num_inputs; i++) {
+	Rast_close(g->inp[i]->fd);
+	for (row = 0; row < nband; row++)
+	    G_free(g->inp[i]->band[row]);
+	G_free(g->inp[i]->band);
+	g->inp[i]->band = NULL;
+    }
+    for (l = 0; l < g->num_outputs; l++) {
+	struct map_store *out = g->outp[l];
+
+	Rast_close(out->fd);
+	Rast_short_history(out->name, "raster", &history);
+	Rast_command_history(&history);
+	Rast_write_history(out->name, &history);
+
+	for (row = 0; row < nband; row++)
+	    G_free(out->band[row]);
+	G_free(out->band);
+	out->band = NULL;
+	out->has_run = 1;
+    }
+}
+
+/* *************************************************************** */
+/* *************************************************************** */
+/* *************************************************************** */
+
 void linear_interpolation(struct map_store **inp, int num_inputs, 
                           struct map_store **outp, int num_outputs)
 {
-   struct map_store *left;
-   struct map_store *right;
-   struct History history;
-   int interval, l, row;
-   int nrows = Rast_window_rows();
-   int ncols = Rast_window_cols();
-   int start = 0;
-
-   if(num_inputs < 2)
-       G_fatal_error(_("At least 2 input maps are required for linear interpolation")); 
-
-   /* Interpolate for each interval */
-   for(interval = 0; interval < num_inputs - 1; interval++) {
-
-       left = inp[interval];
-       right = inp[interval + 1];
-       left->fd = Rast_open_old(left->name, "");
-       right->fd = Rast_open_old(right->name, "");
-       left->buf = Rast_allocate_d_buf();
-       right->buf = Rast_allocate_d_buf();
-
-       for(l = start; l < num_outputs; l++) {
-           /* Check if the map is in the interval and process it */
-           if(outp[l]->pos >= left->pos && outp[l]->pos <= right->pos) {
-               outp[l]->fd = Rast_open_new(outp[l]->name, DCELL_TYPE);
-               outp[l]->buf = Rast_allocate_d_buf();
-
-               G_verbose_message(_("Interpolate map <%s> at position %g in interval (%g;%g)"), 
-                                outp[l]->name, outp[l]->pos, left->pos, right->pos);
-               G_verbose_message(_("Percent complete..."));
-
-               for (row = 0; row < nrows; row++) {
-                   G_percent(row, nrows, 2);
-
-                   Rast_get_d_row(left->fd, left->buf, row);
-                   Rast_get_d_row(right->fd, right->buf, row);
-
-                   interpolate_row_linear(left, right, outp[l], ncols);
-                   Rast_put_d_row(outp[l]->fd, outp[l]->buf);
-               }
-
-               G_percent(row, nrows, 2);
-
-               Rast_close(outp[l]->fd);
-               Rast_short_history(outp[l]->name, "raster", &history);
-               Rast_command_history(&history);
-               Rast_write_history(outp[l]->name, &history);
-
-               G_free(outp[l]->buf);
-               outp[l]->has_run = 1;
-           
-               start = l;
-           }
-       }
-       Rast_close(left->fd);
-       G_free(left->buf);
-       Rast_close(right->fd);
-       G_free(right->buf);
-   }
+    struct group g;
+    int max_open, interval, l, first;
+
+    if (num_inputs < 2)
+	G_fatal_error(_("At least 2 input maps are required for linear interpolation")); 
+
+    /* the interval of each output: the last one containing its position */
+    for (l = 0; l < num_outputs; l++) {
+	outp[l]->left = -1;
+	for (interval = 0; interval < num_inputs - 1; interval++)
+	    if (outp[l]->pos >= inp[interval]->pos &&
+		outp[l]->pos <= inp[interval + 1]->pos)
+		outp[l]->left = interval;
+    }
+
+    /* groups of consecutive outputs with the inputs of their intervals,
+       as many as the limit of open files allows */
+    max_open = max_open_maps();
+    if (max_open < 3)
+	max_open = 3;
+
+    g.outp = G_malloc(num_outputs * sizeof(struct map_store *));
+
+    for (first = 0; first < num_outputs; ) {
+	int first_input = -1, last_input = -1;
+
+	g.num_outputs = 0;
+	for (l = first; l < num_outputs; l++) {
+	    struct map_store *out = outp[l];
+
+	    if (out->left < 0)
+		continue;
+	    if (first_input < 0)
+		first_input = out->left;
+	    /* the outputs are sorted, so are their intervals */
+	    if (g.num_outputs > 0 &&
+		out->left + 2 - first_input + g.num_outputs + 1 > max_open)
+		break;
+	    last_input = out->left + 1;
+	    g.outp[g.num_outputs++] = out;
+	}
+	first = l;
+
+	if (g.num_outputs == 0)
+	    break;
+
+	g.inp = inp + first_input;
+	g.first_input = first_input;
+	g.num_inputs = last_input - first_input + 1;
+
+	G_debug(1, "Interpolating %d output maps from %d input maps",
+		g.num_outputs, g.num_inputs);
+
+	interpolate_group(&g);
+    }
+
+    G_free(g.outp);
 }
 
 /* *************************************************************** */
@@ -380,25 +553,19 @@ void linear_interpolation(struct map_store **inp, int num_inputs,
  * dist -> The distance between the position of u1 and u2
  *
  * */
-void interpolate_row_linear(struct map_store *left, struct map_store *right, struct map_store *out, int ncols)
+void interpolate_row_linear(const DCELL *u1, const DCELL *u2, DCELL *v,
+			    double left_pos, double right_pos, double pos,
+			    int ncols)
 {
-    DCELL v;
-    DCELL u1;
-    DCELL u2;
-    DCELL dist;
+    DCELL dist = fabs(right_pos - left_pos);
     int col;
 
     for (col = 0; col < ncols; col++) {
-        u1 = left->buf[col];
-        u2 = right->buf[col];
-        dist =  fabs(right->pos -  left->pos);
-
-        if(Rast_is_d_null_value(&u1) || Rast_is_d_null_value(&u2)) {
-            Rast_set_d_null_value(&v, 1);
+        if(Rast_is_d_null_value(&u1[col]) || Rast_is_d_null_value(&u2[col])) {
+            Rast_set_d_null_value(&v[col], 1);
         } else {
-            v = (1 - ((out->pos - left->pos)/dist)) * u1 + ((out->pos - left->pos)/dist) * u2;
+            v[col] = (1 - ((pos - left_pos)/dist)) * u1[col] + ((pos - left_pos)/dist) * u2[col];
         }
-        out->buf[col] = v;
     }
     return;
 }
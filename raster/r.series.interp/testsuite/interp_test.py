@@ -56,6 +56,14 @@ class InterpolationTest(TestCase):
         self.assertRasterMinMax(map="map_35",  refmin=35,  refmax=35)
 
 
+    def test_threads(self):
+        self.assertModule("r.series.interp", infile="data/infile_2.txt",
+            outfile="data/outfile_2.txt",  method="linear", nprocs=2)
+
+        self.assertRasterMinMax(map="map_12",  refmin=12,  refmax=12)
+        self.assertRasterMinMax(map="map_25",  refmin=25,  refmax=25)
+        self.assertRasterMinMax(map="map_35",  refmin=35,  refmax=35)
+
     def test_module_failure(self):
         """ We need tests to check the failure handling, as outputs, file and 
              sampling points  are not handled by the grass parser"""
@@ -16,7 +16,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <limits.h>
+#include <math.h>
 
+#include <grass/config.h>
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/glocale.h>
@@ -56,6 +62,41 @@ struct menu
     {NULL,     NULL,     0, NULL,         NULL}
 };
 
+/* file descriptors of an open raster map (cell and null file) and
+   descriptors kept free for other files */
+#define FDS_PER_MAP 2
+#define FDS_RESERVED 32
+
+/* methods computed column by column over all inputs of a row */
+enum simple_method
+{
+    S_NONE,
+    S_AVE,
+    S_COUNT,
+    S_SUM,
+    S_MIN,
+    S_MAX,
+    S_RANGE,
+    S_VAR,
+    S_STDDEV
+};
+
+static const struct
+{
+    stat_func *method;
+    enum simple_method simple;
+} simple_methods[] = {
+    {c_ave, S_AVE},
+    {c_count, S_COUNT},
+    {c_sum, S_SUM},
+    {c_min, S_MIN},
+    {c_max, S_MAX},
+    {c_range, S_RANGE},
+    {c_var, S_VAR},
+    {c_stddev, S_STDDEV},
+    {NULL, S_NONE}
+};
+
 struct input
 {
     const char *name;
@@ -72,6 +113,35 @@ struct output
     stat_func *method_fn;
     stat_func_w *method_fn_w;
     double quantile;
+    enum simple_method simple;
+    int multi;			/* index in the results of stat_multi */
+};
+
+/* work buffers of a thread */
+struct scratch
+{
+    DCELL *values, *values_tmp;
+    DCELL(*values_w)[2];	/* list of values and weights */
+    DCELL(*values_w_tmp)[2];	/* list of values and weights */
+    DCELL *results, *work;	/* for stat_multi_compute() */
+};
+
+struct row_data
+{
+    struct input *inputs;
+    int num_inputs;
+    struct output *outputs;
+    int num_outputs;
+    int have_weights;
+    int propagate_nulls;
+    int have_range;
+    double lo, hi;
+    int simple, general;	/* some outputs are simple, some are not */
+    int need_var;		/* a simple output needs deviations */
+    struct stat_multi *multi;	/* unweighted outputs which aren't simple */
+    DCELL *cnt, *nulls, *sum, *min, *max, *dsq;	/* by column */
+    int chunk;			/* columns per thread */
+    struct scratch *scratch;
 };
 
 static char *build_method_list(void)
@@ -106,12 +176,222 @@ static int find_method(const char *method_name)
     return -1;
 }
 
+static enum simple_method find_simple(stat_func *method_fn)
+{
+    int i;
+
+    for (i = 0; simple_methods[i].method; i++)
+	if (simple_methods[i].method == method_fn)
+	    return simple_methods[i].simple;
+
+    return S_NONE;
+}
+
+/* number of input maps which can be kept open, after raising the soft
+   limit of open files to the hard limit */
+static int max_open_inputs(void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+    struct rlimit lim;
+
+    if (getrlimit(RLIMIT_NOFILE, &lim) < 0)
+	return INT_MAX;
+
+    if (lim.rlim_cur != RLIM_INFINITY && lim.rlim_cur < lim.rlim_max) {
+	struct rlimit raised = lim;
+
+	raised.rlim_cur = lim.rlim_max;
+	if (setrlimit(RLIMIT_NOFILE, &raised) == 0)
+	    lim = raised;
+	G_debug(1, "Open file limit: %ld", (long)lim.rlim_cur);
+    }
+
+    if (lim.rlim_cur != RLIM_INFINITY && lim.rlim_cur < INT_MAX)
+	return ((int)lim.rlim_cur - FDS_RESERVED) / FDS_PER_MAP;
+#endif
+
+    return INT_MAX;
+}
+
+/* too many inputs to keep them open: close the open ones, the inputs
+   are opened for each row as with -z */
+static void keep_closed(struct input *inputs, int num_open, int max_open)
+{
+    int i;
+
+    G_warning(_("More than %d input raster maps exceed the open file limit, "
+		"files are not kept open (-%c)"), max_open, 'z');
+
+    for (i = 0; i < num_open; i++)
+	Rast_close(inputs[i].fd);
+}
+
+/* column by column over all inputs: counts, sums, extremes and the sums
+   of squared deviations, in the order of c_ave() and c_var() */
+static void simple_stats(const struct row_data *rd, int c0, int c1)
+{
+    int i, col;
+
+    for (col = c0; col < c1; col++) {
+	rd->cnt[col] = rd->nulls[col] = rd->sum[col] = rd->dsq[col] = 0;
+	rd->min[col] = HUGE_VAL;
+	rd->max[col] = -HUGE_VAL;
+    }
+
+    /* nulls are NaN, comparisons with NaN are false */
+    for (i = 0; i < rd->num_inputs; i++) {
+	const DCELL *in = rd->inputs[i].buf;
+
+	for (col = c0; col < c1; col++) {
+	    DCELL v = in[col];
+	    int ok = v >= rd->lo && v <= rd->hi;
+
+	    rd->cnt[col] += ok;
+	    rd->nulls[col] += !ok;
+	    rd->sum[col] += ok ? v : 0;
+	    rd->min[col] = ok && v < rd->min[col] ? v : rd->min[col];
+	    rd->max[col] = ok && v > rd->max[col] ? v : rd->max[col];
+	}
+    }
+
+    if (!rd->need_var)
+	return;
+
+    for (i = 0; i < rd->num_inputs; i++) {
+	const DCELL *in = rd->inputs[i].buf;
+
+	for (col = c0; col < c1; col++) {
+	    DCELL v = in[col];
+	    DCELL d = (v >= rd->lo && v <= rd->hi)
+		? v - rd->sum[col] / rd->cnt[col] : 0;
+
+	    rd->dsq[col] += d * d;
+	}
+    }
+}
+
+static void simple_result(const struct row_data *rd, enum simple_method m,
+			  DCELL *result, int col)
+{
+    DCELL n = rd->cnt[col];
+
+    if (rd->propagate_nulls && rd->nulls[col]) {
+	Rast_set_d_null_value(result, 1);
+	return;
+    }
+    if (m == S_COUNT) {
+	*result = n;
+	return;
+    }
+    if (n == 0) {
+	Rast_set_d_null_value(result, 1);
+	return;
+    }
+
+    switch (m) {
+    case S_AVE:
+	*result = rd->sum[col] / n;
+	break;
+    case S_SUM:
+	*result = rd->sum[col];
+	break;
+    case S_MIN:
+	*result = rd->min[col];
+	break;
+    case S_MAX:
+	*result = rd->max[col];
+	break;
+    case S_RANGE:
+	*result = rd->max[col] - rd->min[col];
+	break;
+    case S_VAR:
+	*result = rd->dsq[col] / n;
+	break;
+    case S_STDDEV:
+	*result = sqrt(rd->dsq[col] / n);
+	break;
+    default:
+	break;
+    }
+}
+
+/* runs on a worker thread for the columns c0 to c1 - 1 of a row */
+static void process_cols(int c0, int c1, void *closure)
+{
+    const struct row_data *rd = closure;
+    struct scratch *s = &rd->scratch[c0 / rd->chunk];
+    DCELL *values = s->values;
+    DCELL(*values_w)[2] = s->values_w;
+    int col, i;
+
+    if (rd->simple) {
+	simple_stats(rd, c0, c1);
+	for (i = 0; i < rd->num_outputs; i++) {
+	    struct output *out = &rd->outputs[i];
+
+	    if (out->simple == S_NONE)
+		continue;
+	    for (col = c0; col < c1; col++)
+		simple_result(rd, out->simple, &out->buf[col], col);
+	}
+    }
+
+    for (col = c0; rd->general && col < c1; col++) {
+	int null = 0;
+
+	for (i = 0; i < rd->num_inputs; i++) {
+	    DCELL v = rd->inputs[i].buf[col];
+
+	    if (Rast_is_d_null_value(&v))
+		null = 1;
+	    else if (rd->have_range && (v < rd->lo || v > rd->hi)) {
+		Rast_set_d_null_value(&v, 1);
+		null = 1;
+	    }
+	    values[i] = v;
+	    if (rd->have_weights) {
+		values_w[i][0] = v;
+		values_w[i][1] = rd->inputs[i].weight;
+	    }
+	}
+
+	if (rd->multi && !(null && rd->propagate_nulls)) {
+	    memcpy(s->values_tmp, values, rd->num_inputs * sizeof(DCELL));
+	    stat_multi_compute(rd->multi, s->values_tmp, rd->num_inputs,
+			       s->results, s->work);
+	}
+
+	for (i = 0; i < rd->num_outputs; i++) {
+	    struct output *out = &rd->outputs[i];
+
+	    if (out->simple != S_NONE)
+		continue;
+
+	    if (null && rd->propagate_nulls)
+		Rast_set_d_null_value(&out->buf[col], 1);
+	    else if (out->multi >= 0)
+		out->buf[col] = s->results[out->multi];
+	    else {
+		if (out->method_fn_w) {
+		    memcpy(s->values_w_tmp, values_w, rd->num_inputs * 2 * sizeof(DCELL));
+		    (*out->method_fn_w)(&out->buf[col], s->values_w_tmp, rd->num_inputs, &out->quantile);
+		}
+		else {
+		    memcpy(s->values_tmp, values, rd->num_inputs * sizeof(DCELL));
+		    (*out->method_fn)(&out->buf[col], s->values_tmp, rd->num_inputs, &out->quantile);
+		}
+	    }
+	}
+    }
+}
+
 int main(int argc, char *argv[])
 {
     struct GModule *module;
     struct
     {
 	struct Option *input, *file, *output, *method, *weights, *quantile, *range;
+	struct Option *nprocs;
     } parm;
     struct
     {
@@ -123,12 +403,11 @@ int main(int argc, char *argv[])
     int num_outputs;
     struct output *outputs = NULL;
     struct History history;
-    DCELL *values = NULL, *values_tmp = NULL;
-    DCELL(*values_w)[2];	/* list of values and weights */
-    DCELL(*values_w_tmp)[2];	/* list of values and weights */
+    struct row_data rd;
     int have_weights;
     int nrows, ncols;
-    int row, col;
+    int row;
+    int nprocs, lazy, max_open;
     double lo, hi;
     RASTER_MAP_TYPE intype, maptype;
 
@@ -191,9 +470,15 @@ int main(int argc, char *argv[])
     flag.lazy->key = 'z';
     flag.lazy->description = _("Do not keep files open");
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    nprocs = G_set_nprocs(parm.nprocs);
+    lazy = flag.lazy->answer;
+    max_open = lazy ? INT_MAX : max_open_inputs();
+
     lo = -1.0 / 0.0; /* -inf */
     hi = 1.0 / 0.0; /* inf */
     if (parm.range->answer) {
@@ -268,6 +553,10 @@ int main(int argc, char *argv[])
 
 	    p->name = G_store(name);
             p->weight = weight;
+	    if (!lazy && num_inputs > max_open) {
+		keep_closed(inputs, num_inputs - 1, max_open);
+		lazy = 1;
+	    }
 	    G_verbose_message(_("Reading raster map <%s> using weight %f..."), p->name, p->weight);
 	    p->fd = Rast_open_old(p->name, "");
 	    if (p->fd < 0)
@@ -279,7 +568,7 @@ int main(int argc, char *argv[])
 		if (intype != maptype)
 		    intype = DCELL_TYPE;
 	    }
-	    if (flag.lazy->answer)
+	    if (lazy)
 		Rast_close(p->fd);
 	    p->buf = Rast_allocate_d_buf();
 	}
@@ -328,6 +617,10 @@ int main(int argc, char *argv[])
 		    have_weights = 1;
             }
 
+	    if (!lazy && i >= max_open) {
+		keep_closed(inputs, i, max_open);
+		lazy = 1;
+	    }
 	    G_verbose_message(_("Reading raster map <%s> using weight %f..."), p->name, p->weight);
 	    p->fd = Rast_open_old(p->name, "");
 	    if (p->fd < 0)
@@ -339,7 +632,7 @@ int main(int argc, char *argv[])
 		if (intype != maptype)
 		    intype = DCELL_TYPE;
 	    }
-	    if (flag.lazy->answer)
+	    if (lazy)
 		Rast_close(p->fd);
 	    p->buf = Rast_allocate_d_buf();
     	}
@@ -391,6 +684,7 @@ int main(int argc, char *argv[])
 	out->quantile = (parm.quantile->answer && parm.quantile->answers[i])
 	    ? atof(parm.quantile->answers[i])
 	    : 0;
+	out->simple = out->method_fn ? find_simple(out->method_fn) : S_NONE;
 	out->buf = Rast_allocate_d_buf();
 	if (menu[method].outtype == -1)
 	    out->fd = Rast_open_new(output_name, intype);
@@ -398,18 +692,76 @@ int main(int argc, char *argv[])
 	    out->fd = Rast_open_new(output_name, menu[method].outtype);
     }
 
+    nrows = Rast_window_rows();
+    ncols = Rast_window_cols();
+
     /* initialise variables */
-    values = G_malloc(num_inputs * sizeof(DCELL));
-    values_tmp = G_malloc(num_inputs * sizeof(DCELL));
-    values_w = NULL;
-    values_w_tmp = NULL;
-    if (have_weights) {
-	values_w = (DCELL(*)[2]) G_malloc(num_inputs * 2 * sizeof(DCELL));
-	values_w_tmp = (DCELL(*)[2]) G_malloc(num_inputs * 2 * sizeof(DCELL));
+    rd.inputs = inputs;
+    rd.num_inputs = num_inputs;
+    rd.outputs = outputs;
+    rd.num_outputs = num_outputs;
+    rd.have_weights = have_weights;
+    rd.propagate_nulls = flag.nulls->answer;
+    rd.have_range = parm.range->answer != NULL;
+    rd.lo = lo;
+    rd.hi = hi;
+    rd.simple = rd.general = rd.need_var = 0;
+    rd.multi = NULL;
+    {
+	/* all other unweighted methods from one pass and one sort */
+	stat_func **methods = G_malloc(num_outputs * sizeof(stat_func *));
+	double *quantiles = G_malloc(num_outputs * sizeof(double));
+	int nmulti = 0;
+
+	for (i = 0; i < num_outputs; i++) {
+	    struct output *out = &outputs[i];
+
+	    out->multi = -1;
+	    if (out->simple == S_NONE)
+		rd.general = 1;
+	    else
+		rd.simple = 1;
+	    if (out->simple == S_VAR || out->simple == S_STDDEV)
+		rd.need_var = 1;
+	    if (out->simple == S_NONE && out->method_fn) {
+		methods[nmulti] = out->method_fn;
+		quantiles[nmulti] = out->quantile;
+		out->multi = nmulti++;
+	    }
+	}
+	if (nmulti > 0)
+	    rd.multi = stat_multi_create(nmulti, methods, quantiles);
+	G_free(methods);
+	G_free(quantiles);
+    }
+    if (rd.simple) {
+	rd.cnt = G_malloc(ncols * sizeof(DCELL));
+	rd.nulls = G_malloc(ncols * sizeof(DCELL));
+	rd.sum = G_malloc(ncols * sizeof(DCELL));
+	rd.min = G_malloc(ncols * sizeof(DCELL));
+	rd.max = G_malloc(ncols * sizeof(DCELL));
+	rd.dsq = G_malloc(ncols * sizeof(DCELL));
+    }
+    rd.chunk = (ncols + nprocs - 1) / nprocs;
+    rd.scratch = G_calloc(nprocs, sizeof(struct scratch));
+    for (i = 0; i < nprocs; i++) {
+	struct scratch *s = &rd.scratch[i];
+
+	s->values = G_malloc(num_inputs * sizeof(DCELL));
+	s->values_tmp = G_malloc(num_inputs * sizeof(DCELL));
+	s->results = G_malloc(num_outputs * sizeof(DCELL));
+	s->work = G_malloc(num_inputs * sizeof(DCELL));
+	if (have_weights) {
+	    s->values_w = (DCELL(*)[2]) G_malloc(num_inputs * 2 * sizeof(DCELL));
+	    s->values_w_tmp = (DCELL(*)[2]) G_malloc(num_inputs * 2 * sizeof(DCELL));
+	}
     }
 
-    nrows = Rast_window_rows();
-    ncols = Rast_window_cols();
+    /* the inputs are decompressed on the worker threads while the
+       rows of the other inputs are read */
+    if (nprocs > 1 && !lazy)
+	for (i = 0; i < num_inputs; i++)
+	    Rast_set_read_ahead(inputs[i].fd, 2);
 
     /* process the data */
     G_verbose_message(_("Percent complete..."));
@@ -417,7 +769,7 @@ int main(int argc, char *argv[])
     for (row = 0; row < nrows; row++) {
 	G_percent(row, nrows, 2);
 
-	if (flag.lazy->answer) {
+	if (lazy) {
 	    /* Open the files only on run time */
 	    for (i = 0; i < num_inputs; i++) {
 		inputs[i].fd = Rast_open_old(inputs[i].name, "");
@@ -430,42 +782,8 @@ int main(int argc, char *argv[])
 	        Rast_get_d_row(inputs[i].fd, inputs[i].buf, row);
 	}
 
-	for (col = 0; col < ncols; col++) {
-	    int null = 0;
-
-	    for (i = 0; i < num_inputs; i++) {
-		DCELL v = inputs[i].buf[col];
-
-		if (Rast_is_d_null_value(&v))
-		    null = 1;
-		else if (parm.range->answer && (v < lo || v > hi)) {
-		    Rast_set_d_null_value(&v, 1);
-		    null = 1;
-		}
-		values[i] = v;
-		if (have_weights) {
-		    values_w[i][0] = v;
-		    values_w[i][1] = inputs[i].weight;
-		}
-	    }
-
-	    for (i = 0; i < num_outputs; i++) {
-		struct output *out = &outputs[i];
-
-		if (null && flag.nulls->answer)
-		    Rast_set_d_null_value(&out->buf[col], 1);
-		else {
-		    if (out->method_fn_w) {
-			memcpy(values_w_tmp, values_w, num_inputs * 2 * sizeof(DCELL));
-			(*out->method_fn_w)(&out->buf[col], values_w_tmp, num_inputs, &out->quantile);
-		    }
-		    else {
-			memcpy(values_tmp, values, num_inputs * sizeof(DCELL));
-			(*out->method_fn)(&out->buf[col], values_tmp, num_inputs, &out->quantile);
-		    }
-		}
-	    }
-	}
+	/* the columns are independent */
+	G_parallel_for(0, ncols, rd.chunk, process_cols, &rd);
 
 	for (i = 0; i < num_outputs; i++)
 	    Rast_put_d_row(outputs[i].fd, outputs[i].buf);
@@ -485,7 +803,7 @@ int main(int argc, char *argv[])
     }
 
     /* Close input maps */
-    if (!flag.lazy->answer) {
+    if (!lazy) {
     	for (i = 0; i < num_inputs; i++)
 	    Rast_close(inputs[i].fd);
     }
@@ -314,13 +314,7 @@ int main(int argc, char *argv[])
         _("Automatically generates random seed for random number"
           " generator (use when you don't want to provide the seed option)");
 
-     parm.threads = G_define_option();
-     parm.threads->key = "nprocs";
-     parm.threads->type = TYPE_INTEGER;
-     parm.threads->answer = NUM_THREADS;
-     parm.threads->required = NO;
-     parm.threads->description =
-     _("Number of threads which will be used for parallel compute");
+     parm.threads = G_define_standard_option(G_OPT_M_NPROCS);
      parm.threads->guisection = _("Parameters");
 
     if (G_parser(argc, argv))
@@ -396,13 +390,7 @@ int main(int argc, char *argv[])
 
     G_debug(3, "Parsing rain parameters");
 
-    sscanf(parm.threads->answer, "%d", &threads);
-    if (threads < 1)
-    {
-      G_warning(_("<%d> is not valid number of threads. Number of threads will be set on <%d>"),
-      threads, abs(threads));
-      threads = abs(threads);
-    }
+    threads = G_set_nprocs(parm.threads);
 #if defined(_OPENMP)
     omp_set_num_threads(threads);
 #else
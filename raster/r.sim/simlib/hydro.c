@@ -21,6 +21,7 @@
 #include <grass/gis.h>
 #include <grass/bitmap.h>
 #include <grass/linkm.h>
+#include <grass/gmath.h>
 #include <grass/glocale.h>
 
 #include <grass/waterglobs.h>
@@ -83,7 +84,6 @@ float **zz, **cchez;
 double **v1, **v2, **slope;
 double **gama, **gammas, **si, **inf, **sigma;
 float **dc, **tau, **er, **ct, **trap;
-float **dif;
 
 /* suspected BUG below: fist array subscripts go from 1 to MAXW
  * correct: from 0 to MAXW - 1, e.g for (lw = 0; lw < MAXW; lw++) */
@@ -110,6 +110,42 @@ double infil_val;
 
 struct History history;	/* holds meta-data (title, comments,..) */
 
+/* weights added by one thread during a time step, merged into gama
+ * at the end of the step */
+struct walker_acc
+{
+    double **gama;		/* added weights */
+    int *cells;			/* cells with added weights, k * mx + l */
+    int ncells, nalloc;
+};
+
+static struct walker_acc *accs;
+static int naccs;
+
+static void walker_acc_add(struct walker_acc *acc, int cell)
+{
+    if (acc->ncells == acc->nalloc) {
+	acc->nalloc = acc->nalloc ? 2 * acc->nalloc : 1024;
+	acc->cells =
+	    (int *)G_realloc(acc->cells, acc->nalloc * sizeof(int));
+    }
+    acc->cells[acc->ncells++] = cell;
+}
+
+static void walker_acc_merge(struct walker_acc *acc)
+{
+    int i, k, l;
+
+    for (i = 0; i < acc->ncells; i++) {
+	k = acc->cells[i] / mx;
+	l = acc->cells[i] % mx;
+#pragma omp atomic
+	gama[k][l] += acc->gama[k][l];
+	acc->gama[k][l] = 0.;
+    }
+    acc->ncells = 0;
+}
+
 /* **************************************************** */
 /*       create walker representation of si */
 /* ******************************************************** */
@@ -129,12 +165,11 @@ void main_loop(void)
     int mitfac;
 /*  int mitfac, p; */
     double x, y;
-    double velx, vely, stxm, stym;
-    double factor, conn, gaux, gauy;
-    double d1, addac, decr;
+    double stxm, stym;
+    double factor, conn;
+    double d1, addac;
     double barea, sarea, walkwe;
     double gen, gen2, wei2, wei3, wei, weifac;
-    float eff;
 
     nblock = 1;
     icoub = 0;
@@ -152,6 +187,17 @@ void main_loop(void)
 
     G_debug(2, " maxwa, nblock %d %d", maxwa, nblock);
 
+#if defined(_OPENMP)
+    /* each thread has its own random numbers and water depth increments */
+    naccs = omp_get_max_threads();
+    if (naccs > 1) {
+	accs = (struct walker_acc *)G_calloc(naccs, sizeof(struct walker_acc));
+	for (i = 0; i < naccs; i++)
+	    accs[i].gama = G_alloc_matrix(my, mx);
+	simwe_rand_streams(naccs);
+    }
+#endif
+
     for (iblock = 1; iblock <= nblock; iblock++) {
 	++icoub;
 
@@ -267,18 +313,22 @@ void main_loop(void)
 	    nwalka = 0;
 	    nstack = 0;
 
-#pragma omp parallel firstprivate(l,lw,k,decr,d1,hhc,velx,vely,eff,gaux,gauy)//nwalka
+#pragma omp parallel
 {
-#if defined(_OPENMP)
-        int steps = (int)((((double)nwalk) / ((double) omp_get_num_threads())) + 0.5);
-        int tid = omp_get_thread_num();
-        int min_loop = tid * steps;
-        int max_loop = ((tid + 1) * steps) > nwalk ? nwalk : (tid + 1) * steps;
+	    struct walker_acc *acc = NULL;
+	    int lw, k, l;
+	    double decr, d1, hhc, difk, velx, vely, gaux, gauy;
+	    float eff;
 
-	    for (lw = min_loop; lw < max_loop; lw++) {
-#else
-        for (lw = 0; lw < nwalk; lw++) {
+#if defined(_OPENMP)
+	    if (accs)
+		acc = &accs[omp_get_thread_num()];
 #endif
+
+	    /* chunks of neighbouring walkers are dealt out round robin,
+	     * which keeps the assignment of walkers to threads fixed */
+#pragma omp for schedule(static, 4096) reduction(+:nwalka)
+	    for (lw = 0; lw < nwalk; lw++) {
 		if (w[lw][2] > EPS) {	/* check the walker weight */
 		    ++nwalka;
 		    l = (int)((w[lw][0] + stxm) / stepx) - mx - 1;
@@ -297,24 +347,43 @@ void main_loop(void)
 
 		    if (zz[k][l] != UNDEF) {
 			if (infil != NULL) {	/* infiltration part */
-			    if (inf[k][l] - si[k][l] > 0.) {
+			    double infk;
+
+#pragma omp atomic read
+			    infk = inf[k][l];
+
+			    if (infk - si[k][l] > 0.) {
 
 				decr = pow(addac * w[lw][2], 3. / 5.);	/* decreasing factor in m */
-				if (inf[k][l] > decr) {
-				    inf[k][l] -= decr;	/* decrease infilt. in cell and eliminate the walker */
-				    w[lw][2] = 0.;
+#pragma omp atomic capture
+				{
+				    infk = inf[k][l];
+				    inf[k][l] -= decr;	/* decrease infilt. in cell */
+				}
+				if (infk > decr) {
+				    w[lw][2] = 0.;	/* and eliminate the walker */
 				}
 				else {
-				    w[lw][2] -= pow(inf[k][l], 5. / 3.) / addac;	/* use just proportional part of the walker weight */
+				    if (infk > 0.)
+					w[lw][2] -= pow(infk, 5. / 3.) / addac;	/* use just proportional part of the walker weight */
+#pragma omp atomic write
 				    inf[k][l] = 0.;
 
 				}
 			    }
 			}
 
-			gama[k][l] += (addac * w[lw][2]);	/* add walker weigh to water depth or conc. */
-
-			d1 = gama[k][l] * conn;
+			/* add walker weigh to water depth or conc. */
+			if (acc == NULL) {
+			    gama[k][l] += (addac * w[lw][2]);
+			    d1 = gama[k][l] * conn;
+			}
+			else {
+			    if (acc->gama[k][l] == 0.)
+				walker_acc_add(acc, k * mx + l);
+			    acc->gama[k][l] += (addac * w[lw][2]);
+			    d1 = (gama[k][l] + acc->gama[k][l]) * conn;
+			}
 #if defined(_OPENMP)
 			gasdev_for_paralel(&gaux, &gauy);
 #else
@@ -324,12 +393,12 @@ void main_loop(void)
 			hhc = pow(d1, 3. / 5.);
 
 			if (hhc > hhmax && wdepth == NULL) {	/* increased diffusion if w.depth > hhmax */
-			    dif[k][l] = (halpha + 1) * deldif;
+			    difk = (halpha + 1) * deldif;
 			    velx = vavg[lw][0];
 			    vely = vavg[lw][1];
 			}
 			else {
-			    dif[k][l] = deldif;
+			    difk = deldif;
 			    velx = v1[k][l];
 			    vely = v2[k][l];
 			}
@@ -345,8 +414,8 @@ void main_loop(void)
 			    }
 			}
 
-			w[lw][0] += (velx + dif[k][l] * gaux);	/* move the walker */
-			w[lw][1] += (vely + dif[k][l] * gauy);
+			w[lw][0] += (velx + difk * gaux);	/* move the walker */
+			w[lw][1] += (vely + difk * gauy);
 
 			if (hhc > hhmax && wdepth == NULL) {
 			    vavg[lw][0] = hbeta * (vavg[lw][0] + v1[k][l]);
@@ -371,7 +440,11 @@ void main_loop(void)
 		    }
 		}
             } /* lw loop */
-            }
+
+	    /* merge the weights added by this thread */
+	    if (acc)
+		walker_acc_merge(acc);
+}
             /* Changes made by Soeren 8. Mar 2011 to replace the site walker output implementation */
             /* Save all walkers located within the computational region and with valid 
                z coordinates */
@@ -483,4 +556,14 @@ void main_loop(void)
     
     points.is_open = 0;
 
+    if (accs) {
+	for (i = 0; i < naccs; i++) {
+	    G_free_matrix(accs[i].gama);
+	    G_free(accs[i].cells);
+	}
+	G_free(accs);
+	accs = NULL;
+	simwe_rand_streams(0);
+    }
+
 }
@@ -244,7 +244,6 @@ void alloc_grids_water()
     gama = G_alloc_matrix(my, mx);
     if (err != NULL)
         gammas = G_alloc_matrix(my, mx);
-    dif = G_alloc_fmatrix(my, mx);
 }
 
 void alloc_grids_sediment()
@@ -256,7 +255,6 @@ void alloc_grids_sediment()
 
     /* memory allocation for output grids */
 
-    dif = G_alloc_fmatrix(my, mx);
     if (erdep != NULL || et != NULL)
         er = G_alloc_fmatrix(my, mx);
 }
@@ -9,8 +9,76 @@
 
 #include <grass/waterglobs.h>
 
+#if defined(_OPENMP)
+#include <omp.h>
+
+/* state of the 48-bit linear congruential generator of G_drand48(),
+ * one per thread and padded to not share cache lines */
+struct rand_stream
+{
+    unsigned short x[3];
+    char pad[64 - 3 * sizeof(unsigned short)];
+};
+
+static struct rand_stream *streams;
+static int nstreams;
+
+static double stream_rand(struct rand_stream *s)
+{
+    unsigned int a0x0 = 0xE66DU * s->x[0];
+    unsigned int a0x1 = 0xE66DU * s->x[1];
+    unsigned int a0x2 = 0xE66DU * s->x[2];
+    unsigned int a1x0 = 0xDEECU * s->x[0];
+    unsigned int a1x1 = 0xDEECU * s->x[1];
+    unsigned int a2x0 = 0x5U * s->x[0];
+
+    unsigned int y0 = (a0x0 & 0xFFFFU) + 0xBU;
+    unsigned int y1 = (a0x1 & 0xFFFFU) + (a1x0 & 0xFFFFU) + (a0x0 >> 16);
+    unsigned int y2 = (a0x2 & 0xFFFFU) + (a1x1 & 0xFFFFU) + (a2x0 & 0xFFFFU)
+	+ (a0x1 >> 16) + (a1x0 >> 16);
+
+    s->x[0] = (unsigned short)(y0 & 0xFFFFU);
+    y1 += y0 >> 16;
+    s->x[1] = (unsigned short)(y1 & 0xFFFFU);
+    y2 += y1 >> 16;
+    s->x[2] = (unsigned short)(y2 & 0xFFFFU);
+
+    return ((s->x[2] * 65536.0 + s->x[1]) * 65536.0 + s->x[0]) /
+	281474976710656.0;	/* 2^48 */
+}
+#endif
+
+/* Create one random number stream per thread, seeded from G_lrand48()
+ * so that the seed of the module still determines the results.
+ * With 0 streams simwe_rand() uses G_drand48() again. */
+void simwe_rand_streams(int n)
+{
+#if defined(_OPENMP)
+    int i;
+    long seed;
+
+    G_free(streams);
+    streams = NULL;
+    nstreams = n;
+    if (n <= 0)
+	return;
+
+    streams = (struct rand_stream *)G_calloc(n, sizeof(struct rand_stream));
+    for (i = 0; i < n; i++) {
+	seed = G_lrand48();
+	streams[i].x[2] = (unsigned short)((seed >> 16) & 0xFFFF);
+	streams[i].x[1] = (unsigned short)(seed & 0xFFFF);
+	streams[i].x[0] = 0x330E;
+    }
+#endif
+}
+
 double simwe_rand(void)
 {
+#if defined(_OPENMP)
+    if (nstreams > 0)
+	return stream_rand(&streams[omp_get_thread_num()]);
+#endif
     return G_drand48();
 }				/* ulec */
 
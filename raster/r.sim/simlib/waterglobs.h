@@ -60,6 +60,7 @@ extern struct _points points;
 extern void erod(double **);
 extern int output_et(void);
 extern double simwe_rand(void);
+extern void simwe_rand_streams(int);
 extern double gasdev(void);
 extern void gasdev_for_paralel(double *, double *);
 extern double amax1(double, double);
@@ -84,7 +85,6 @@ extern float **zz, **cchez;
 extern double **v1, **v2, **slope;
 extern double **gama, **gammas, **si, **inf, **sigma;
 extern float **dc, **tau, **er, **ct, **trap;
-extern float **dif;
 
 extern double vavg[MAXW][2], stack[MAXW][3], w[MAXW][3]; 
 extern int iflag[MAXW];
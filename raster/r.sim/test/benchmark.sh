@@ -0,0 +1,16 @@
+#!/bin/sh
+
+# scaling of r.sim.water with the number of threads
+# assumes full NC SPM
+
+g.region raster=elevation -p
+r.slope.aspect elevation=elevation dx=bench_dx dy=bench_dy --o
+
+for NPROCS in 1 2 4 8 16 ; do
+    echo "### nprocs=$NPROCS"
+    time r.sim.water elevation=elevation dx=bench_dx dy=bench_dy \
+        rain_value=50 infil_value=0 man_value=0.05 depth=bench_depth \
+        niterations=10 random_seed=1 nprocs=$NPROCS --o --q
+done
+
+g.remove -f type=raster name=bench_dx,bench_dy,bench_depth
@@ -73,6 +73,371 @@ static double aspect_cw_n(double aspect)
     return aspect;
 }
 
+#define BLOCK_ROWS 8
+
+/* outputs in the order they are written */
+enum
+{
+    O_ASPECT, O_SLOPE, O_PCURV, O_TCURV,
+    O_DX, O_DY, O_DXX, O_DYY, O_DXY,
+    NUM_OUTPUTS
+};
+
+/* work buffers and running ranges of a thread */
+struct scratch
+{
+    double *dx, *dy, *dxx, *dyy, *dxy;
+    double min_slp, max_slp, min_asp, max_asp;
+    double c1min, c1max, c2min, c2max;
+};
+
+struct block
+{
+    DCELL **elev;		/* elevation rows of the block and its halo */
+    double *H, *V;		/* weighted runs of the rows of the block */
+    void **out[NUM_OUTPUTS];	/* output rows, NULL if not requested */
+    RASTER_MAP_TYPE data_type;
+    int ncols;			/* number of computed cells of a row */
+    int offset;			/* output column of the first computed cell */
+    int compute_at_edges;
+    int deg;
+    int north;			/* aspect clockwise from north */
+    double min_slope;
+    const double *answer;
+    int chunk;			/* rows per thread */
+    struct scratch *scratch;	/* per thread */
+};
+
+/* first and second order partial derivatives of a whole row
+ *
+ * Each derivative has its own loop without branches so that compilers
+ * can vectorize them (e.g. GCC at -O3). Null neighbours make dx or dy
+ * null, see process_row(). */
+static void derivatives(const struct block *blk, struct scratch *s,
+			const DCELL *pc1, const DCELL *pc2, const DCELL *pc3,
+			double H, double V, int second)
+{
+    int ncols = blk->ncols;
+    double *dx = s->dx, *dy = s->dy;
+    double *dxx = s->dxx, *dyy = s->dyy, *dxy = s->dxy;
+    int col;
+
+    /* Horn's formula */
+    for (col = 0; col < ncols; col++) {
+	DCELL c1 = pc1[col], c3 = pc1[col + 2];
+	DCELL c4 = pc2[col], c6 = pc2[col + 2];
+	DCELL c7 = pc3[col], c9 = pc3[col + 2];
+
+	dx[col] = ((c1 + c4 + c4 + c7) - (c3 + c6 + c6 + c9)) / H;
+    }
+
+    for (col = 0; col < ncols; col++) {
+	DCELL c1 = pc1[col], c2 = pc1[col + 1], c3 = pc1[col + 2];
+	DCELL c7 = pc3[col], c8 = pc3[col + 1], c9 = pc3[col + 2];
+
+	dy[col] = ((c7 + c8 + c8 + c9) - (c1 + c2 + c2 + c3)) / V;
+    }
+
+    if (!second)
+	return;
+
+    for (col = 0; col < ncols; col++) {
+	DCELL c1 = pc1[col], c2 = pc1[col + 1], c3 = pc1[col + 2];
+	DCELL c4 = pc2[col], c5 = pc2[col + 1], c6 = pc2[col + 2];
+	DCELL c7 = pc3[col], c8 = pc3[col + 1], c9 = pc3[col + 2];
+	double s4 = c1 + c3 + c7 + c9 - c5 * 8.;
+	double s5 = c4 * 4. + c6 * 4. - c8 * 2. - c2 * 2.;
+
+	dxx[col] = -(s4 + s5) / ((3. / 32.) * H * H);
+    }
+
+    for (col = 0; col < ncols; col++) {
+	DCELL c1 = pc1[col], c2 = pc1[col + 1], c3 = pc1[col + 2];
+	DCELL c4 = pc2[col], c5 = pc2[col + 1], c6 = pc2[col + 2];
+	DCELL c7 = pc3[col], c8 = pc3[col + 1], c9 = pc3[col + 2];
+	double s4 = c1 + c3 + c7 + c9 - c5 * 8.;
+	double s6 = c8 * 4. + c2 * 4. - c4 * 2. - c6 * 2.;
+
+	dyy[col] = -(s4 + s6) / ((3. / 32.) * V * V);
+    }
+
+    for (col = 0; col < ncols; col++) {
+	DCELL c1 = pc1[col], c3 = pc1[col + 2];
+	DCELL c7 = pc3[col], c9 = pc3[col + 2];
+	double s3 = c7 - c9 + c3 - c1;
+
+	dxy[col] = -s3 / ((1. / 16.) * H * V);
+    }
+}
+
+/* derivatives of a cell with null neighbours for -e,
+ * pc1, pc2 and pc3 point to the first column of its window */
+static void edge_derivatives(const DCELL *pc1, const DCELL *pc2,
+			     const DCELL *pc3, double H, double V,
+			     double *dx, double *dy,
+			     double *dxx, double *dyy, double *dxy)
+{
+    DCELL c1 = pc1[0], c2 = pc1[1], c3 = pc1[2];
+    DCELL c4 = pc2[0], c5 = pc2[1], c6 = pc2[2];
+    DCELL c7 = pc3[0], c8 = pc3[1], c9 = pc3[2];
+    double s3, s4, s5, s6;
+
+    /* same method like ComputeVal in gdaldem_lib.cpp */
+    if (Rast_is_d_null_value(&c1))
+	c1 = c5;
+    if (Rast_is_d_null_value(&c2))
+	c2 = c5;
+    if (Rast_is_d_null_value(&c3))
+	c3 = c5;
+    if (Rast_is_d_null_value(&c4))
+	c4 = c5;
+    if (Rast_is_d_null_value(&c6))
+	c6 = c5;
+    if (Rast_is_d_null_value(&c7))
+	c7 = c5;
+    if (Rast_is_d_null_value(&c8))
+	c8 = c5;
+    if (Rast_is_d_null_value(&c9))
+	c9 = c5;
+
+    *dx = ((c1 + c4 + c4 + c7) - (c3 + c6 + c6 + c9)) / H;
+    *dy = ((c7 + c8 + c8 + c9) - (c1 + c2 + c2 + c3)) / V;
+
+    s4 = c1 + c3 + c7 + c9 - c5 * 8.;
+    s5 = c4 * 4. + c6 * 4. - c8 * 2. - c2 * 2.;
+    s6 = c8 * 4. + c2 * 4. - c4 * 2. - c6 * 2.;
+    s3 = c7 - c9 + c3 - c1;
+
+    *dxx = -(s4 + s5) / ((3. / 32.) * H * H);
+    *dyy = -(s4 + s6) / ((3. / 32.) * V * V);
+    *dxy = -s3 / ((1. / 16.) * H * V);
+}
+
+static void *cell_ptr(const struct block *blk, int o, int i, int col)
+{
+    return G_incr_void_ptr(blk->out[o][i], (size_t)(blk->offset + col) *
+			   Rast_cell_size(blk->data_type));
+}
+
+/* stores a derivative or a curvature, scaled for CELL maps */
+static void put_value(const struct block *blk, int o, int i, int col,
+		      double value, double scik1)
+{
+    void *ptr;
+
+    if (!blk->out[o])
+	return;
+
+    ptr = cell_ptr(blk, o, i, col);
+    if (blk->data_type == CELL_TYPE)
+	*((CELL *) ptr) = (CELL) (scik1 * value);
+    else
+	Rast_set_d_value(ptr, (DCELL) value, blk->data_type);
+}
+
+/* computes the outputs of the row i of a block */
+static void process_row(const struct block *blk, struct scratch *s, int i)
+{
+    RASTER_MAP_TYPE data_type = blk->data_type;
+    double radians_to_degrees = 180.0 / M_PI;
+    double degrees_to_radians = M_PI / 180.0;
+    double scik1 = 100000.;
+    double gradmin = 0.001;
+    const DCELL *pc1 = blk->elev[i], *pc2 = blk->elev[i + 1];
+    const DCELL *pc3 = blk->elev[i + 2];
+    int curvatures = blk->out[O_PCURV] || blk->out[O_TCURV];
+    int second = curvatures || blk->out[O_DXX] || blk->out[O_DYY] ||
+	blk->out[O_DXY];
+    int col, o;
+
+    derivatives(blk, s, pc1, pc2, pc3, blk->H[i], blk->V[i], second);
+
+    for (col = 0; col < blk->ncols; col++) {
+	double dx = s->dx[col], dy = s->dy[col];
+	double dxx = 0., dyy = 0., dxy = 0.;
+	double key, slp_in_perc, slp_in_deg;
+	int low, hi, test = 0;
+	int null;
+
+	if (second) {
+	    dxx = s->dxx[col];
+	    dyy = s->dyy[col];
+	    dxy = s->dxy[col];
+	}
+
+	null = Rast_is_d_null_value(&pc2[col + 1]);
+	if (!null && (Rast_is_d_null_value(&dx) || Rast_is_d_null_value(&dy))) {
+	    /* some neighbour is null */
+	    if (blk->compute_at_edges)
+		edge_derivatives(pc1 + col, pc2 + col, pc3 + col,
+				 blk->H[i], blk->V[i],
+				 &dx, &dy, &dxx, &dyy, &dxy);
+	    else
+		null = 1;
+	}
+
+	if (null) {
+	    for (o = 0; o < NUM_OUTPUTS; o++)
+		if (blk->out[o])
+		    Rast_set_null_value(cell_ptr(blk, o, i, col), 1,
+					data_type);
+	    continue;
+	}			/* no data */
+
+	/* compute topographic parameters */
+	key = dx * dx + dy * dy;
+	slp_in_perc = 100 * sqrt(key);
+	slp_in_deg = atan(sqrt(key)) * radians_to_degrees;
+
+	/* now update min and max */
+	if (blk->deg) {
+	    if (s->min_slp > slp_in_deg)
+		s->min_slp = slp_in_deg;
+	    if (s->max_slp < slp_in_deg)
+		s->max_slp = slp_in_deg;
+	}
+	else {
+	    if (s->min_slp > slp_in_perc)
+		s->min_slp = slp_in_perc;
+	    if (s->max_slp < slp_in_perc)
+		s->max_slp = slp_in_perc;
+	}
+	if (slp_in_perc < blk->min_slope)
+	    slp_in_perc = 0.;
+
+	if (blk->deg && data_type == CELL_TYPE) {
+	    low = 0;
+	    hi = 90;
+	    test = 20;
+
+	    while (hi >= low) {
+		if (key >= blk->answer[test])
+		    low = test + 1;
+		else if (key < blk->answer[test - 1])
+		    hi = test - 1;
+		else
+		    break;
+		test = (low + hi) / 2;
+	    }
+	}
+	else if (data_type == CELL_TYPE)
+	    test = slp_in_perc + .5;
+
+	if (blk->out[O_SLOPE]) {
+	    void *slp_ptr = cell_ptr(blk, O_SLOPE, i, col);
+
+	    if (data_type == CELL_TYPE)
+		*((CELL *) slp_ptr) = (CELL) test;
+	    else if (blk->deg)
+		Rast_set_d_value(slp_ptr, (DCELL) slp_in_deg, data_type);
+	    else
+		Rast_set_d_value(slp_ptr, (DCELL) slp_in_perc, data_type);
+	}			/* computing slope */
+
+	if (blk->out[O_ASPECT]) {
+	    void *asp_ptr = cell_ptr(blk, O_ASPECT, i, col);
+	    double aspect, aspect_flat = 0.;
+
+	    if (slp_in_perc == 0.)
+		aspect = 0.;
+	    else if (dx == 0) {
+		if (dy > 0)
+		    aspect = 90.;
+		else
+		    aspect = 270.;
+	    }
+	    else {
+		aspect = (atan2(dy, dx) / degrees_to_radians);
+		if (aspect <= 0.)
+		    aspect = 360. + aspect;
+	    }
+
+	    if (blk->north) {
+		aspect_flat = -9999;
+		aspect = aspect_cw_n(aspect);
+	    }
+
+	    if (data_type == CELL_TYPE) {
+		if (aspect > 0 && aspect < 0.5)
+		    aspect = 360;
+		*((CELL *) asp_ptr) = (CELL) (aspect + .5);
+	    }
+	    else
+		Rast_set_d_value(asp_ptr, (DCELL) aspect, data_type);
+
+	    /* now update min and max */
+	    if (aspect > aspect_flat && s->min_asp > aspect)
+		s->min_asp = aspect;
+	    if (s->max_asp < aspect)
+		s->max_asp = aspect;
+	}			/* computing aspect */
+
+	put_value(blk, O_DX, i, col, dx, scik1);
+	put_value(blk, O_DY, i, col, dy, scik1);
+	put_value(blk, O_DXX, i, col, dxx, scik1);
+	put_value(blk, O_DYY, i, col, dyy, scik1);
+	put_value(blk, O_DXY, i, col, dxy, scik1);
+
+	/* compute curvature */
+	if (curvatures) {
+	    double grad2 = key;	/*dx2 + dy2 */
+	    double grad = sqrt(grad2);
+	    double pcurv, tcurv;
+
+	    if (grad <= gradmin) {
+		pcurv = 0.;
+		tcurv = 0.;
+	    }
+	    else {
+		double dnorm1 = sqrt(grad2 + 1.);
+		double dxy2 = 2. * dxy * dx * dy;
+		double dx2 = dx * dx;
+		double dy2 = dy * dy;
+
+		pcurv = (dxx * dx2 + dxy2 + dyy * dy2) /
+		    (grad2 * dnorm1 * dnorm1 * dnorm1);
+		tcurv = (dxx * dy2 - dxy2 + dyy * dx2) / (grad2 * dnorm1);
+		if (s->c1min > pcurv)
+		    s->c1min = pcurv;
+		if (s->c1max < pcurv)
+		    s->c1max = pcurv;
+		if (s->c2min > tcurv)
+		    s->c2min = tcurv;
+		if (s->c2max < tcurv)
+		    s->c2max = tcurv;
+	    }
+
+	    put_value(blk, O_PCURV, i, col, pcurv, scik1);
+	    put_value(blk, O_TCURV, i, col, tcurv, scik1);
+	}
+    }				/* column for loop */
+}
+
+/* the threads share the elevation rows of the block and its halo and
+ * each writes the output rows it was given; the derivatives of a row
+ * and the ranges of slope, aspect and curvatures are kept in the
+ * scratch of the thread and merged after the last block */
+static void process_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct scratch *s = &blk->scratch[first / blk->chunk];
+    int i;
+
+    for (i = first; i < last; i++)
+	process_row(blk, s, i);
+}
+
+static void read_row(int fd, DCELL *buf, int row, int Wrap)
+{
+    if (Wrap) {
+	Rast_get_d_row_nomask(fd, buf + 1, row);
+	buf[0] = buf[Rast_window_cols() - 1];
+	buf[Rast_window_cols() + 1] = buf[2];
+    }
+    else
+	Rast_get_d_row_nomask(fd, buf, row);
+}
+
 int main(int argc, char *argv[])
 {
     struct Categories cats;
@@ -86,22 +451,21 @@ int main(int argc, char *argv[])
     int dxx_fd;
     int dyy_fd;
     int dxy_fd;
-    DCELL *elev_cell[3], *temp;
-    DCELL *pc1, *pc2, *pc3;
-    DCELL c1, c2, c3, c4, c5, c6, c7, c8, c9;
+    DCELL *temp;
     DCELL tmp1, tmp2;
     FCELL dat1, dat2;
     CELL cat;
-    void *asp_raster, *asp_ptr = NULL;
-    void *slp_raster, *slp_ptr = NULL;
-    void *pcurv_raster, *pcurv_ptr = NULL;
-    void *tcurv_raster, *tcurv_ptr = NULL;
-    void *dx_raster, *dx_ptr = NULL;
-    void *dy_raster, *dy_ptr = NULL;
-    void *dxx_raster, *dxx_ptr = NULL;
-    void *dyy_raster, *dyy_ptr = NULL;
-    void *dxy_raster, *dxy_ptr = NULL;
-    int i;
+    void *asp_raster;
+    void *slp_raster;
+    void *pcurv_raster;
+    void *tcurv_raster;
+    void *dx_raster;
+    void *dy_raster;
+    void *dxx_raster;
+    void *dyy_raster;
+    void *dxy_raster;
+    int i, o;
+    int out_fd[NUM_OUTPUTS];
     RASTER_MAP_TYPE out_type, data_type;
     int Wrap;			/* global wraparound */
     struct Cell_head window, cellhd;
@@ -120,33 +484,21 @@ int main(int argc, char *argv[])
     const char *dxy_name;
     char buf[300];
     int nrows, row;
-    int ncols, col;
+    int ncols;
 
     double north, east, south, west, ns_med;
 
     double radians_to_degrees;
-    double degrees_to_radians;
     double H, V;
-    double dx;			/* partial derivative in ew direction */
-    double dy;			/* partial derivative in ns direction */
-    double dxx, dxy, dyy;
-    double s3, s4, s5, s6;
-    double pcurv, tcurv;
-    double scik1 = 100000.;
     double zfactor;
     double factor;
-    double aspect, min_asp = 360., max_asp = 0.;
-    double dnorm1, dx2, dy2, grad2, grad, dxy2;
-    double gradmin = 0.001;
+    double min_asp = 360., max_asp = 0.;
     double c1min = 0., c1max = 0., c2min = 0., c2max = 0.;
 
     double answer[92];
     double degrees;
     double tan_ans;
-    double key;
-    double slp_in_perc, slp_in_deg;
     double min_slp = 900., max_slp = 0., min_slope;
-    int low, hi, test = 0;
     int deg = 0;
     int perc = 0;
     char *slope_fmt;
@@ -155,13 +507,15 @@ int main(int argc, char *argv[])
     {
 	struct Option *elevation, *slope_fmt, *slope, *aspect, *pcurv, *tcurv,
 	    *zfactor, *min_slope, *out_precision,
-	    *dx, *dy, *dxx, *dyy, *dxy;
+	    *dx, *dy, *dxx, *dyy, *dxy, *nprocs;
     } parm;
     struct
     {
 	struct Flag *a, *n, *e;
     } flag;
     int compute_at_edges;
+    int nprocs, nblock;
+    struct block blk;
 
     G_gisinit(argv[0]);
 
@@ -273,6 +627,8 @@ int main(int argc, char *argv[])
     parm.min_slope->answer = "0.0";
     parm.min_slope->guisection = _("Settings");
 
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.a = G_define_flag();
     flag.a->key = 'a';
     flag.a->description =
@@ -298,10 +654,12 @@ int main(int argc, char *argv[])
 
 
     radians_to_degrees = 180.0 / M_PI;
-    degrees_to_radians = M_PI / 180.0;
 
     compute_at_edges = flag.e->answer;
 
+    nprocs = G_set_nprocs(parm.nprocs);
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+
     /* INC BY ONE
        answer[0] = 0.0;
        answer[91] = 15000.0;
@@ -448,12 +806,11 @@ int main(int argc, char *argv[])
 
     /* open the elevation file for reading */
     elevation_fd = Rast_open_old(elev_name, "");
-    elev_cell[0] = (DCELL *) G_calloc(ncols + 1, sizeof(DCELL));
-    Rast_set_d_null_value(elev_cell[0], ncols);
-    elev_cell[1] = (DCELL *) G_calloc(ncols + 1, sizeof(DCELL));
-    Rast_set_d_null_value(elev_cell[1], ncols);
-    elev_cell[2] = (DCELL *) G_calloc(ncols + 1, sizeof(DCELL));
-    Rast_set_d_null_value(elev_cell[2], ncols);
+    blk.elev = (DCELL **) G_malloc((nblock + 2) * sizeof(DCELL *));
+    for (i = 0; i < nblock + 2; i++) {
+	blk.elev[i] = (DCELL *) G_calloc(ncols + 1, sizeof(DCELL));
+	Rast_set_d_null_value(blk.elev[i], ncols);
+    }
 
     if (slope_name != NULL) {
 	slope_fd = Rast_open_new(slope_name, out_type);
@@ -558,466 +915,130 @@ int main(int argc, char *argv[])
 	&& dx_fd < 0 && dy_fd < 0 && dxx_fd < 0 && dyy_fd < 0 && dxy_fd < 0)
 	exit(EXIT_FAILURE);
 
-    if (Wrap) {
-	Rast_get_d_row_nomask(elevation_fd, elev_cell[1] + 1, 0);
-	elev_cell[1][0] = elev_cell[1][Rast_window_cols() - 1];
-	elev_cell[1][Rast_window_cols() + 1] = elev_cell[1][2];
+    out_fd[O_ASPECT] = aspect_fd;
+    out_fd[O_SLOPE] = slope_fd;
+    out_fd[O_PCURV] = pcurv_fd;
+    out_fd[O_TCURV] = tcurv_fd;
+    out_fd[O_DX] = dx_fd;
+    out_fd[O_DY] = dy_fd;
+    out_fd[O_DXX] = dxx_fd;
+    out_fd[O_DYY] = dyy_fd;
+    out_fd[O_DXY] = dxy_fd;
+
+    for (o = 0; o < NUM_OUTPUTS; o++) {
+	if (out_fd[o] < 0) {
+	    blk.out[o] = NULL;
+	    continue;
+	}
+	blk.out[o] = G_malloc(nblock * sizeof(void *));
+	for (i = 0; i < nblock; i++) {
+	    blk.out[o][i] = Rast_allocate_buf(data_type);
+	    Rast_set_null_value(blk.out[o][i], Rast_window_cols(), data_type);
+	}
     }
-    else
-	Rast_get_d_row_nomask(elevation_fd, elev_cell[1], 0);
 
-    if (Wrap) {
-	Rast_get_d_row_nomask(elevation_fd, elev_cell[2] + 1, 1);
-	elev_cell[2][0] = elev_cell[2][Rast_window_cols() - 1];
-	elev_cell[2][Rast_window_cols() + 1] = elev_cell[2][2];
+    /* the first and last cells of a row stay null unless wrapping */
+    blk.ncols = ncols - 2;
+    blk.offset = Wrap ? 0 : 1;
+    blk.data_type = data_type;
+    blk.compute_at_edges = compute_at_edges;
+    blk.deg = deg;
+    blk.north = flag.n->answer;
+    blk.min_slope = min_slope;
+    blk.answer = answer;
+    blk.H = (double *) G_malloc(nblock * sizeof(double));
+    blk.V = (double *) G_malloc(nblock * sizeof(double));
+    blk.chunk = (nblock + nprocs - 1) / nprocs;
+    blk.scratch = G_calloc(nprocs, sizeof(struct scratch));
+    for (i = 0; i < nprocs; i++) {
+	struct scratch *s = &blk.scratch[i];
+
+	s->dx = (double *) G_malloc(ncols * sizeof(double));
+	s->dy = (double *) G_malloc(ncols * sizeof(double));
+	s->dxx = (double *) G_malloc(ncols * sizeof(double));
+	s->dyy = (double *) G_malloc(ncols * sizeof(double));
+	s->dxy = (double *) G_malloc(ncols * sizeof(double));
+	s->min_slp = min_slp;
+	s->max_slp = max_slp;
+	s->min_asp = min_asp;
+	s->max_asp = max_asp;
+	s->c1min = c1min;
+	s->c1max = c1max;
+	s->c2min = c2min;
+	s->c2max = c2max;
     }
-    else
-	Rast_get_d_row_nomask(elevation_fd, elev_cell[2], 1);
+
+    read_row(elevation_fd, blk.elev[0], 0, Wrap);
+    read_row(elevation_fd, blk.elev[1], 1, Wrap);
 
     G_verbose_message(_("Percent complete..."));
 
-    for (row = 2; row < nrows; row++) {
-	/*  if projection is Lat/Lon, recalculate  V and H   */
-	if (G_projection() == PROJECTION_LL) {
-	    north = Rast_row_to_northing((row - 2 + 0.5), &window);
-	    ns_med = Rast_row_to_northing((row - 1 + 0.5), &window);
-	    south = Rast_row_to_northing((row + 0.5), &window);
-	    east = Rast_col_to_easting(2.5, &window);
-	    west = Rast_col_to_easting(0.5, &window);
-	    V = G_distance(east, north, east, south) * 4 / (factor * zfactor);
-	    H = G_distance(east, ns_med, west, ns_med) * 4 / (factor * zfactor);
-	    /*        ____________________________
-	       |c1      |c2      |c3      |
-	       |        |        |        |
-	       |        |  north |        |        
-	       |        |        |        |
-	       |________|________|________|          
-	       |c4      |c5      |c6      |
-	       |        |        |        |
-	       |  east  | ns_med |  west  |
-	       |        |        |        |
-	       |________|________|________|
-	       |c7      |c8      |c9      |
-	       |        |        |        |
-	       |        |  south |        |
-	       |        |        |        |
-	       |________|________|________|
-	     */
-	}
+    /* the rows 1 to nrows - 2 are computed block by block */
+    for (row = 1; row < nrows - 1; row += nblock) {
+	int n = nrows - 1 - row < nblock ? nrows - 1 - row : nblock;
 
 	G_percent(row, nrows, 2);
-	temp = elev_cell[0];
-	elev_cell[0] = elev_cell[1];
-	elev_cell[1] = elev_cell[2];
-	elev_cell[2] = temp;
-
-	if (Wrap) {
-	    Rast_get_d_row_nomask(elevation_fd, elev_cell[2] + 1, row);
-	    elev_cell[2][0] = elev_cell[2][Rast_window_cols() - 1];
-	    elev_cell[2][Rast_window_cols() + 1] = elev_cell[2][2];
-	}
-	else
-	    Rast_get_d_row_nomask(elevation_fd, elev_cell[2], row);
-
-	pc1 = elev_cell[0];
-	pc2 = elev_cell[1];
-	pc3 = elev_cell[2];
-
-	if (aspect_fd >= 0) {
-	    if (Wrap)
-		asp_ptr = asp_raster;
-	    else
-		asp_ptr =
-		    G_incr_void_ptr(asp_raster, Rast_cell_size(data_type));
-	}
-	if (slope_fd >= 0) {
-	    if (Wrap)
-		slp_ptr = slp_raster;
-	    else
-		slp_ptr =
-		    G_incr_void_ptr(slp_raster, Rast_cell_size(data_type));
-	}
-
-	if (pcurv_fd >= 0) {
-	    if (Wrap)
-		pcurv_ptr = pcurv_raster;
-	    else
-		pcurv_ptr =
-		    G_incr_void_ptr(pcurv_raster, Rast_cell_size(data_type));
-	}
-
-	if (tcurv_fd >= 0) {
-	    if (Wrap)
-		tcurv_ptr = tcurv_raster;
-	    else
-		tcurv_ptr =
-		    G_incr_void_ptr(tcurv_raster, Rast_cell_size(data_type));
-	}
-
-	if (dx_fd >= 0) {
-	    if (Wrap)
-		dx_ptr = dx_raster;
-	    else
-		dx_ptr = G_incr_void_ptr(dx_raster, Rast_cell_size(data_type));
-	}
-
-	if (dy_fd >= 0) {
-	    if (Wrap)
-		dy_ptr = dy_raster;
-	    else
-		dy_ptr = G_incr_void_ptr(dy_raster, Rast_cell_size(data_type));
-	}
-
-	if (dxx_fd >= 0) {
-	    if (Wrap)
-		dxx_ptr = dxx_raster;
-	    else
-		dxx_ptr =
-		    G_incr_void_ptr(dxx_raster, Rast_cell_size(data_type));
-	}
-
-	if (dyy_fd >= 0) {
-	    if (Wrap)
-		dyy_ptr = dyy_raster;
-	    else
-		dyy_ptr =
-		    G_incr_void_ptr(dyy_raster, Rast_cell_size(data_type));
-	}
-
-	if (dxy_fd >= 0) {
-	    if (Wrap)
-		dxy_ptr = dxy_raster;
-	    else
-		dxy_ptr =
-		    G_incr_void_ptr(dxy_raster, Rast_cell_size(data_type));
-	}
-
-
-	/*skip first cell of the row */
-
-	for (col = ncols - 2; col-- > 0; pc1++, pc2++, pc3++) {
-	    c1 = *pc1;
-	    c2 = *(pc1 + 1);
-	    c3 = *(pc1 + 2);
-	    c4 = *pc2;
-	    c5 = *(pc2 + 1);
-	    c6 = *(pc2 + 2);
-	    c7 = *pc3;
-	    c8 = *(pc3 + 1);
-	    c9 = *(pc3 + 2);
-	    /*  DEBUG:
-	       fprintf(stdout, "\n%.0f %.0f %.0f\n%.0f %.0f %.0f\n%.0f %.0f %.0f\n",
-	       c1, c2, c3, c4, c5, c6, c7, c8, c9);
-	     */
-
-	    if (Rast_is_d_null_value(&c5) || (!compute_at_edges && 
-	        (Rast_is_d_null_value(&c1) || Rast_is_d_null_value(&c2) ||
-		 Rast_is_d_null_value(&c3) || Rast_is_d_null_value(&c4) ||
-		 Rast_is_d_null_value(&c6) || Rast_is_d_null_value(&c7) ||
-		 Rast_is_d_null_value(&c8) || Rast_is_d_null_value(&c9)))) {
-		if (slope_fd > 0) {
-		    Rast_set_null_value(slp_ptr, 1, data_type);
-		    slp_ptr =
-			G_incr_void_ptr(slp_ptr, Rast_cell_size(data_type));
-		}
-		if (aspect_fd > 0) {
-		    Rast_set_null_value(asp_ptr, 1, data_type);
-		    asp_ptr =
-			G_incr_void_ptr(asp_ptr, Rast_cell_size(data_type));
-		}
-		if (pcurv_fd > 0) {
-		    Rast_set_null_value(pcurv_ptr, 1, data_type);
-		    pcurv_ptr =
-			G_incr_void_ptr(pcurv_ptr, Rast_cell_size(data_type));
-		}
-		if (tcurv_fd > 0) {
-		    Rast_set_null_value(tcurv_ptr, 1, data_type);
-		    tcurv_ptr =
-			G_incr_void_ptr(tcurv_ptr, Rast_cell_size(data_type));
-		}
-		if (dx_fd > 0) {
-		    Rast_set_null_value(dx_ptr, 1, data_type);
-		    dx_ptr =
-			G_incr_void_ptr(dx_ptr, Rast_cell_size(data_type));
-		}
-		if (dy_fd > 0) {
-		    Rast_set_null_value(dy_ptr, 1, data_type);
-		    dy_ptr =
-			G_incr_void_ptr(dy_ptr, Rast_cell_size(data_type));
-		}
-		if (dxx_fd > 0) {
-		    Rast_set_null_value(dxx_ptr, 1, data_type);
-		    dxx_ptr =
-			G_incr_void_ptr(dxx_ptr, Rast_cell_size(data_type));
-		}
-		if (dyy_fd > 0) {
-		    Rast_set_null_value(dyy_ptr, 1, data_type);
-		    dyy_ptr =
-			G_incr_void_ptr(dyy_ptr, Rast_cell_size(data_type));
-		}
-		if (dxy_fd > 0) {
-		    Rast_set_null_value(dxy_ptr, 1, data_type);
-		    dxy_ptr =
-			G_incr_void_ptr(dxy_ptr, Rast_cell_size(data_type));
-		}
-		continue;
-	    }			/* no data */
-
-	    if (compute_at_edges) {
-		/* same method like ComputeVal in gdaldem_lib.cpp */
-		if (Rast_is_d_null_value(&c1))
-		    c1 = c5;
-		if (Rast_is_d_null_value(&c2))
-		    c2 = c5;
-		if (Rast_is_d_null_value(&c3))
-		    c3 = c5;
-		if (Rast_is_d_null_value(&c4))
-		    c4 = c5;
-		if (Rast_is_d_null_value(&c6))
-		    c6 = c5;
-		if (Rast_is_d_null_value(&c7))
-		    c7 = c5;
-		if (Rast_is_d_null_value(&c8))
-		    c8 = c5;
-		if (Rast_is_d_null_value(&c9))
-		    c9 = c5;
-	    }
-
-	    dx = ((c1 + c4 + c4 + c7) - (c3 + c6 + c6 + c9)) / H;
-	    dy = ((c7 + c8 + c8 + c9) - (c1 + c2 + c2 + c3)) / V;
-
-	    /* compute topographic parameters */
-	    key = dx * dx + dy * dy;
-	    slp_in_perc = 100 * sqrt(key);
-	    slp_in_deg = atan(sqrt(key)) * radians_to_degrees;
-
-	    /* now update min and max */
-	    if (deg) {
-		if (min_slp > slp_in_deg)
-		    min_slp = slp_in_deg;
-		if (max_slp < slp_in_deg)
-		    max_slp = slp_in_deg;
-	    }
-	    else {
-		if (min_slp > slp_in_perc)
-		    min_slp = slp_in_perc;
-		if (max_slp < slp_in_perc)
-		    max_slp = slp_in_perc;
-	    }
-	    if (slp_in_perc < min_slope)
-		slp_in_perc = 0.;
-
-	    if (deg && out_type == CELL_TYPE) {
-		/* INC BY ONE
-		   low = 1;
-		   hi = 91;
-		 */
-		low = 0;
-		hi = 90;
-		test = 20;
-
-		while (hi >= low) {
-		    if (key >= answer[test])
-			low = test + 1;
-		    else if (key < answer[test - 1])
-			hi = test - 1;
-		    else
-			break;
-		    test = (low + hi) / 2;
-		}
-	    }
-	    else if (perc && out_type == CELL_TYPE)
-		/* INCR_BY_ONE */
-		/* test = slp_in_perc + 1.5; *//* All the slope categories are
-		   incremented by 1 */
-		test = slp_in_perc + .5;
-
-	    if (slope_fd > 0) {
-		if (data_type == CELL_TYPE)
-		    *((CELL *) slp_ptr) = (CELL) test;
-		else {
-		    if (deg)
-			Rast_set_d_value(slp_ptr,
-					     (DCELL) slp_in_deg, data_type);
-		    else
-			Rast_set_d_value(slp_ptr,
-					     (DCELL) slp_in_perc, data_type);
-		}
-		slp_ptr = G_incr_void_ptr(slp_ptr, Rast_cell_size(data_type));
-	    }			/* computing slope */
-
-	    if (aspect_fd > 0) {
-		double aspect_flat = 0.;
-
-		if (slp_in_perc == 0.)
-		    aspect = 0.;
-		else if (dx == 0) {
-		    if (dy > 0)
-			aspect = 90.;
-		    else
-			aspect = 270.;
-		}
-		else {
-		    aspect = (atan2(dy, dx) / degrees_to_radians);
-		    if (aspect <= 0.)
-			aspect = 360. + aspect;
-		}
-
-		if (flag.n->answer) {
-		    aspect_flat = -9999;
-		    aspect = aspect_cw_n(aspect);
-		}
-
-		if (out_type == CELL_TYPE) {
-		    if (aspect > 0 && aspect < 0.5)
-			aspect = 360;
-		    *((CELL *) asp_ptr) = (CELL) (aspect + .5);
-		}
-		else
-		    Rast_set_d_value(asp_ptr,
-					 (DCELL) aspect, data_type);
-
-		asp_ptr = G_incr_void_ptr(asp_ptr, Rast_cell_size(data_type));
-
-		/* now update min and max */
-		if (aspect > aspect_flat && min_asp > aspect)
-		    min_asp = aspect;
-		if (max_asp < aspect)
-		    max_asp = aspect;
-	    }			/* computing aspect */
-
-	    if (dx_fd > 0) {
-		if (out_type == CELL_TYPE)
-		    *((CELL *) dx_ptr) = (CELL) (scik1 * dx);
-		else
-		    Rast_set_d_value(dx_ptr, (DCELL) dx, data_type);
-		dx_ptr = G_incr_void_ptr(dx_ptr, Rast_cell_size(data_type));
-	    }
-
-	    if (dy_fd > 0) {
-		if (out_type == CELL_TYPE)
-		    *((CELL *) dy_ptr) = (CELL) (scik1 * dy);
-		else
-		    Rast_set_d_value(dy_ptr, (DCELL) dy, data_type);
-		dy_ptr = G_incr_void_ptr(dy_ptr, Rast_cell_size(data_type));
-	    }
-
-	    if (dxx_fd <= 0 && dxy_fd <= 0 && dyy_fd <= 0 &&
-		pcurv_fd <= 0 && tcurv_fd <= 0)
-		continue;
-
-	    /* compute second order derivatives */
-	    s4 = c1 + c3 + c7 + c9 - c5 * 8.;
-	    s5 = c4 * 4. + c6 * 4. - c8 * 2. - c2 * 2.;
-	    s6 = c8 * 4. + c2 * 4. - c4 * 2. - c6 * 2.;
-	    s3 = c7 - c9 + c3 - c1;
-
-	    dxx = -(s4 + s5) / ((3. / 32.) * H * H);
-	    dyy = -(s4 + s6) / ((3. / 32.) * V * V);
-	    dxy = -s3 / ((1. / 16.) * H * V);
-
-	    if (dxx_fd > 0) {
-		if (out_type == CELL_TYPE)
-		    *((CELL *) dxx_ptr) = (CELL) (scik1 * dxx);
-		else
-		    Rast_set_d_value(dxx_ptr, (DCELL) dxx, data_type);
-		dxx_ptr = G_incr_void_ptr(dxx_ptr, Rast_cell_size(data_type));
-	    }
 
-	    if (dyy_fd > 0) {
-		if (out_type == CELL_TYPE)
-		    *((CELL *) dyy_ptr) = (CELL) (scik1 * dyy);
-		else
-		    Rast_set_d_value(dyy_ptr, (DCELL) dyy, data_type);
-		dyy_ptr = G_incr_void_ptr(dyy_ptr, Rast_cell_size(data_type));
-	    }
-
-	    if (dxy_fd > 0) {
-		if (out_type == CELL_TYPE)
-		    *((CELL *) dxy_ptr) = (CELL) (scik1 * dxy);
-		else
-		    Rast_set_d_value(dxy_ptr, (DCELL) dxy, data_type);
-		dxy_ptr = G_incr_void_ptr(dxy_ptr, Rast_cell_size(data_type));
-	    }
-
-	    /* compute curvature */
-	    if (pcurv_fd <= 0 && tcurv_fd <= 0)
-		continue;
-
-	    grad2 = key;	/*dx2 + dy2 */
-	    grad = sqrt(grad2);
-	    if (grad <= gradmin) {
-		pcurv = 0.;
-		tcurv = 0.;
+	for (i = 0; i < n; i++) {
+	    read_row(elevation_fd, blk.elev[i + 2], row + i + 1, Wrap);
+
+	    /*  if projection is Lat/Lon, recalculate  V and H   */
+	    if (G_projection() == PROJECTION_LL) {
+		north = Rast_row_to_northing((row + i - 1 + 0.5), &window);
+		ns_med = Rast_row_to_northing((row + i + 0.5), &window);
+		south = Rast_row_to_northing((row + i + 1 + 0.5), &window);
+		east = Rast_col_to_easting(2.5, &window);
+		west = Rast_col_to_easting(0.5, &window);
+		blk.V[i] = G_distance(east, north, east, south) * 4 /
+		    (factor * zfactor);
+		blk.H[i] = G_distance(east, ns_med, west, ns_med) * 4 /
+		    (factor * zfactor);
 	    }
 	    else {
-		dnorm1 = sqrt(grad2 + 1.);
-		dxy2 = 2. * dxy * dx * dy;
-		dx2 = dx * dx;
-		dy2 = dy * dy;
-		pcurv = (dxx * dx2 + dxy2 + dyy * dy2) /
-		    (grad2 * dnorm1 * dnorm1 * dnorm1);
-		tcurv = (dxx * dy2 - dxy2 + dyy * dx2) / (grad2 * dnorm1);
-		if (c1min > pcurv)
-		    c1min = pcurv;
-		if (c1max < pcurv)
-		    c1max = pcurv;
-		if (c2min > tcurv)
-		    c2min = tcurv;
-		if (c2max < tcurv)
-		    c2max = tcurv;
-	    }
-
-	    if (pcurv_fd > 0) {
-		if (out_type == CELL_TYPE)
-		    *((CELL *) pcurv_ptr) = (CELL) (scik1 * pcurv);
-		else
-		    Rast_set_d_value(pcurv_ptr, (DCELL) pcurv, data_type);
-		pcurv_ptr =
-		    G_incr_void_ptr(pcurv_ptr, Rast_cell_size(data_type));
-	    }
-
-	    if (tcurv_fd > 0) {
-		if (out_type == CELL_TYPE)
-		    *((CELL *) tcurv_ptr) = (CELL) (scik1 * tcurv);
-		else
-		    Rast_set_d_value(tcurv_ptr, (DCELL) tcurv, data_type);
-		tcurv_ptr =
-		    G_incr_void_ptr(tcurv_ptr, Rast_cell_size(data_type));
+		blk.V[i] = V;
+		blk.H[i] = H;
 	    }
+	}
 
-	}			/* column for loop */
-
-	if (aspect_fd > 0)
-	    Rast_put_row(aspect_fd, asp_raster, data_type);
-
-	if (slope_fd > 0)
-	    Rast_put_row(slope_fd, slp_raster, data_type);
-
-	if (pcurv_fd > 0)
-	    Rast_put_row(pcurv_fd, pcurv_raster, data_type);
-
-	if (tcurv_fd > 0)
-	    Rast_put_row(tcurv_fd, tcurv_raster, data_type);
-
-	if (dx_fd > 0)
-	    Rast_put_row(dx_fd, dx_raster, data_type);
-
-	if (dy_fd > 0)
-	    Rast_put_row(dy_fd, dy_raster, data_type);
-
-	if (dxx_fd > 0)
-	    Rast_put_row(dxx_fd, dxx_raster, data_type);
-
-	if (dyy_fd > 0)
-	    Rast_put_row(dyy_fd, dyy_raster, data_type);
-
-	if (dxy_fd > 0)
-	    Rast_put_row(dxy_fd, dxy_raster, data_type);
-
-    }				/* row loop */
+	/* the rows of a block are independent */
+	G_parallel_for(0, n, blk.chunk, process_rows, &blk);
+
+	for (i = 0; i < n; i++)
+	    for (o = 0; o < NUM_OUTPUTS; o++)
+		if (blk.out[o])
+		    Rast_put_row(out_fd[o], blk.out[o][i], data_type);
+
+	/* the last two rows are the first ones of the next block */
+	temp = blk.elev[0];
+	blk.elev[0] = blk.elev[n];
+	blk.elev[n] = temp;
+	temp = blk.elev[1];
+	blk.elev[1] = blk.elev[n + 1];
+	blk.elev[n + 1] = temp;
+    }
 
-    G_percent(row, nrows, 2);
+    G_percent(nrows, nrows, 2);
+
+    for (i = 0; i < nprocs; i++) {
+	const struct scratch *s = &blk.scratch[i];
+
+	if (min_slp > s->min_slp)
+	    min_slp = s->min_slp;
+	if (max_slp < s->max_slp)
+	    max_slp = s->max_slp;
+	if (min_asp > s->min_asp)
+	    min_asp = s->min_asp;
+	if (max_asp < s->max_asp)
+	    max_asp = s->max_asp;
+	if (c1min > s->c1min)
+	    c1min = s->c1min;
+	if (c1max < s->c1max)
+	    c1max = s->c1max;
+	if (c2min > s->c2min)
+	    c2min = s->c2min;
+	if (c2max < s->c2max)
+	    c2max = s->c2max;
+    }
 
     Rast_close(elevation_fd);
     G_debug(1, "Creating support files...");
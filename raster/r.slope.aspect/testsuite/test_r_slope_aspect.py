@@ -120,6 +120,10 @@ class TestSlopeAspectAgainstItself(TestCase):
     t_slope = 'sa_together_slope'
     s_aspect = 'sa_separately_aspect'
     s_slope = 'sa_separately_slope'
+    p_aspect = 'sa_nprocs_aspect'
+    p_slope = 'sa_nprocs_slope'
+    p1_aspect = 'sa_nprocs1_aspect'
+    p1_slope = 'sa_nprocs1_slope'
 
     @classmethod
     def setUpClass(cls):
@@ -130,7 +134,8 @@ class TestSlopeAspectAgainstItself(TestCase):
     def tearDownClass(cls):
         cls.del_temp_region()
         call_module('g.remove', flags='f', type_='raster',
-                    name=[cls.t_aspect, cls.t_slope, cls.s_slope, cls.s_aspect])
+                    name=[cls.t_aspect, cls.t_slope, cls.s_slope, cls.s_aspect,
+                          cls.p_aspect, cls.p_slope, cls.p1_aspect, cls.p1_slope])
 
     def test_slope_aspect_together(self):
         """Slope and aspect computed separately and together should be the same
@@ -146,6 +151,18 @@ class TestSlopeAspectAgainstItself(TestCase):
         self.assertRastersNoDifference(actual=self.t_slope, reference=self.s_slope,
                                        precision=self.precision)
 
+    def test_nprocs(self):
+        """Results computed on several threads should be the same
+        """
+        self.assertModule('r.slope.aspect', elevation=self.elevation,
+                          slope=self.p_slope, aspect=self.p_aspect, nprocs=4)
+        self.assertModule('r.slope.aspect', elevation=self.elevation,
+                          slope=self.p1_slope, aspect=self.p1_aspect, nprocs=1)
+        self.assertRastersNoDifference(actual=self.p_aspect, reference=self.p1_aspect,
+                                       precision=0)
+        self.assertRastersNoDifference(actual=self.p_slope, reference=self.p1_slope,
+                                       precision=0)
+
 
 # TODO: implement this class
 class TestExtremes(TestCase):
@@ -14,4 +14,11 @@ struct costHa
     float min_cost, angle;
     int row, col;
 };
+
+/* position of each cell in the heap, 0 if the cell is not in the heap;
+ * lets replaceHa() find a cell without searching the heap */
+extern long *heap_index;
+extern int ncols;
+
+#define HEAP_INDEX(r, c)	heap_index[(long)(r) * ncols + (c)]
 #endif
@@ -3,8 +3,8 @@
  *
  *                 deleteHa.c (for spread)
  *  This routine is to delete a cell in a heap. 
- *  It 1) searches the cell backward and sequentially from 
- *        the heap (if not found, returns a error message), 
+ *  It 1) looks up the cell in the heap index
+ *        (if not found, returns a error message), 
  *     2) overwrites that cell and calls fixH routine to 
  *        restore a heap order.
  *
@@ -26,17 +26,14 @@ deleteHa(float old_min_cost, int row, int col,
 	printf("programming ERROR: can't delete a cell from an ampty list");
 	exit(1);
     }
-    /* search the old_cell from the heap */
-    for (i = 0; i <= *heap_len; i++) {
-	if (heap[i].min_cost == old_min_cost &&
-	    heap[i].row == row && heap[i].col == col)
-	    break;
-    }
-    if (i == 0) {
+    /* the position of the old_cell in the heap */
+    i = HEAP_INDEX(row, col);
+    if (i == 0 || heap[i].min_cost != old_min_cost) {
 	printf("programming ERROR: can't find the old_cell from the list");
 	exit(1);
     }
     /* overwrite that cell, fix the heap */
+    HEAP_INDEX(row, col) = 0;
     fixHa(i, heap, *heap_len);
     *heap_len = *heap_len - 1;
 
@@ -29,6 +29,7 @@ struct costHa *fixHa(long go_pos, struct costHa *heap, long heap_len)
 	    heap[vacant].angle = heap[smaller_child].angle;
 	    heap[vacant].row = heap[smaller_child].row;
 	    heap[vacant].col = heap[smaller_child].col;
+	    HEAP_INDEX(heap[vacant].row, heap[vacant].col) = vacant;
 	    vacant = smaller_child;
 	}
 	else
@@ -38,6 +39,8 @@ struct costHa *fixHa(long go_pos, struct costHa *heap, long heap_len)
     heap[vacant].angle = heap[heap_len].angle;
     heap[vacant].row = heap[heap_len].row;
     heap[vacant].col = heap[heap_len].col;
+    if (vacant != heap_len)
+	HEAP_INDEX(heap[vacant].row, heap[vacant].col) = vacant;
 
     return heap;
 }
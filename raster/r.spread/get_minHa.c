@@ -21,6 +21,7 @@ void get_minHa(struct costHa *heap, struct costHa *pres_cell, long heap_len)
     pres_cell->angle = heap[1].angle;
     pres_cell->row = heap[1].row;
     pres_cell->col = heap[1].col;
+    HEAP_INDEX(pres_cell->row, pres_cell->col) = 0;
     fixHa(1, heap, heap_len);
 
     return;
@@ -23,11 +23,13 @@ insertHa(float new_min_cost, float angle, int row, int col,
 	heap[vacant].angle = heap[vacant / 2].angle;
 	heap[vacant].row = heap[vacant / 2].row;
 	heap[vacant].col = heap[vacant / 2].col;
+	HEAP_INDEX(heap[vacant].row, heap[vacant].col) = vacant;
 	vacant = vacant / 2;
     }
     heap[vacant].min_cost = new_min_cost;
     heap[vacant].angle = angle;
     heap[vacant].row = row;
     heap[vacant].col = col;
+    HEAP_INDEX(row, col) = vacant;
     return;
 }
@@ -71,6 +71,7 @@ long heap_len;
 struct Cell_head window;
 
 struct costHa *heap;
+long *heap_index;
 
 
 int main(int argc, char *argv[])
@@ -550,6 +551,7 @@ int main(int argc, char *argv[])
     /*  Initialize the heap  */
     heap =
 	(struct costHa *)G_calloc(nrows * ncols + 1, sizeof(struct costHa));
+    heap_index = (long *)G_calloc(nrows * ncols + 1, sizeof(long));
     heap_len = 0;
 
     G_message(_("Reading %s..."), start_layer);
@@ -584,6 +586,8 @@ int main(int argc, char *argv[])
     G_free(map_base);
     G_free(map_out);
     G_free(map_visit);
+    G_free(heap);
+    G_free(heap_index);
     if (x_out)
 	G_free(map_x_out);
     if (y_out)
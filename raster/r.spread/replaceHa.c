@@ -2,9 +2,10 @@
 /***********************************************************
  *
  *                 replaceHa.c (for spread)
- *  This routine is to delete a cell in a heap. 
- *  It 1) searches the cell backward and sequentially from 
- *        the heap (if not found, returns a error message), 
+ *  This routine is to replace the cost of a cell in a heap.
+ *  It 1) looks up the position of the cell in the heap index
+ *        (if the cell is no longer in the heap, it is inserted
+ *        again),
  *     2) repalce that cell with the new min_cost and
  *        restore a heap order.
  *
@@ -23,16 +24,13 @@ replaceHa(float new_min_cost, float angle, int row, int col,
 
     G_debug(4, "in replaceHa()");
 
-    if (*heap_len < 1)
-	G_fatal_error("Programming ERROR: can't delete a cell from an empty list");
-
-    /* search the cell with row and col from the heap */
-    for (i = *heap_len; i >= 0; i--) {
-	if (heap[i].row == row && heap[i].col == col)
-	    break;
+    /* the position of the cell with row and col in the heap */
+    i = HEAP_INDEX(row, col);
+    if (i == 0) {
+	/* already taken from the heap, spread again from there */
+	insertHa(new_min_cost, angle, row, col, heap, heap_len);
+	return;
     }
-    if (i == 0)
-	G_fatal_error("Programming ERROR: can't find the old_cell from the list");
 
     /* replace this cell, fix the heap */
     /*take care upward */
@@ -43,6 +41,7 @@ replaceHa(float new_min_cost, float angle, int row, int col,
 	heap[i].angle = heap[i / 2].angle;
 	heap[i].row = heap[i / 2].row;
 	heap[i].col = heap[i / 2].col;
+	HEAP_INDEX(heap[i].row, heap[i].col) = i;
 	i = i / 2;
     }
 
@@ -65,6 +64,7 @@ replaceHa(float new_min_cost, float angle, int row, int col,
 	heap[i].angle = heap[smaller_child].angle;
 	heap[i].row = heap[smaller_child].row;
 	heap[i].col = heap[smaller_child].col;
+	HEAP_INDEX(heap[i].row, heap[i].col) = i;
 
 	i = smaller_child;
 	smaller_child = 2 * i;
@@ -79,6 +79,7 @@ replaceHa(float new_min_cost, float angle, int row, int col,
     heap[i].angle = angle;
     heap[i].row = row;
     heap[i].col = col;
+    HEAP_INDEX(row, col) = i;
 
     G_debug(4, "replaceHa() done");
 
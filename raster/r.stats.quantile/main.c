@@ -16,9 +16,12 @@
 #include <math.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
+#include <grass/stats.h>
 #include <grass/glocale.h>
 #include <grass/spawn.h>
 
+#define BLOCK_ROWS 16
+
 struct bin
 {
     unsigned long origin;
@@ -402,6 +405,149 @@ static void compute_quantiles(void)
     }
 }
 
+/* a block of rows added to the digests of several threads */
+struct block
+{
+    CELL **baserows;
+    DCELL **coverrows;
+    int chunk;			/* rows or categories per thread */
+    int compression;
+    struct stat_tdigest ***digests;	/* by thread and category, NULL
+					   for categories without values */
+    int nthreads;
+};
+
+static void digest_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct stat_tdigest **digests = blk->digests[first / blk->chunk];
+    int row, col;
+
+    for (row = first; row < last; row++) {
+	const CELL *basebuf = blk->baserows[row];
+	const DCELL *coverbuf = blk->coverrows[row];
+
+	for (col = 0; col < cols; col++) {
+	    struct stat_tdigest **td;
+
+	    if (Rast_is_c_null_value(&basebuf[col]))
+		continue;
+
+	    if (Rast_is_d_null_value(&coverbuf[col]))
+		continue;
+
+	    td = &digests[basebuf[col] - cmin];
+	    if (!*td)
+		*td = stat_tdigest_create(blk->compression);
+	    stat_tdigest_add(*td, coverbuf[col]);
+	}
+    }
+}
+
+/* merge the digests of the threads and compute the quantiles of the
+   categories from first to last */
+static void digest_quantiles(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    int cat, i, quant;
+
+    for (cat = first; cat < last; cat++) {
+	struct basecat *bc = &basecats[cat];
+	struct stat_tdigest *td = NULL;
+
+	for (i = 0; i < blk->nthreads; i++) {
+	    struct stat_tdigest *src = blk->digests[i][cat];
+
+	    if (!src)
+		continue;
+	    if (!td)
+		td = src;
+	    else {
+		stat_tdigest_merge(td, src);
+		stat_tdigest_destroy(src);
+	    }
+	}
+
+	if (!td)
+	    continue;
+
+	bc->total = (unsigned long)stat_tdigest_count(td);
+	bc->quants = G_malloc(num_quants * sizeof(DCELL));
+	for (quant = 0; quant < num_quants; quant++)
+	    bc->quants[quant] = stat_tdigest_quantile(td, quants[quant]);
+
+	stat_tdigest_destroy(td);
+    }
+}
+
+/* one pass: approximate quantiles from t-digests of the row bands
+   read by each thread */
+static void approx_quantiles(int basefile, int coverfile, int nprocs,
+			     int compression)
+{
+    int nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    struct block blk;
+    int row, i, cat;
+
+    G_message(_("Computing approximate quantiles"));
+
+    blk.baserows = G_malloc(nblock * sizeof(CELL *));
+    blk.coverrows = G_malloc(nblock * sizeof(DCELL *));
+    for (i = 0; i < nblock; i++) {
+	blk.baserows[i] = Rast_allocate_c_buf();
+	blk.coverrows[i] = Rast_allocate_d_buf();
+    }
+    blk.compression = compression;
+    blk.nthreads = nprocs;
+    blk.digests = G_malloc(nprocs * sizeof(struct stat_tdigest **));
+    for (i = 0; i < nprocs; i++)
+	blk.digests[i] = G_calloc(num_cats, sizeof(struct stat_tdigest *));
+
+    if (nprocs > 1) {
+	Rast_set_read_ahead(basefile, nblock);
+	Rast_set_read_ahead(coverfile, nblock);
+    }
+
+    for (row = 0; row < rows; row += nblock) {
+	int n = rows - row < nblock ? rows - row : nblock;
+
+	for (i = 0; i < n; i++) {
+	    Rast_get_c_row(basefile, blk.baserows[i], row + i);
+	    Rast_get_d_row(coverfile, blk.coverrows[i], row + i);
+	}
+
+	blk.chunk = (n + nprocs - 1) / nprocs;
+	G_parallel_for(0, n, blk.chunk, digest_rows, &blk);
+
+	G_percent(row, rows, 2);
+    }
+    G_percent(rows, rows, 2);
+
+    if (nprocs > 1) {
+	Rast_set_read_ahead(basefile, 0);
+	Rast_set_read_ahead(coverfile, 0);
+    }
+
+    blk.chunk = (num_cats + nprocs - 1) / nprocs;
+    G_parallel_for(0, num_cats, blk.chunk, digest_quantiles, &blk);
+
+    for (i = 0; i < nblock; i++) {
+	G_free(blk.baserows[i]);
+	G_free(blk.coverrows[i]);
+    }
+    G_free(blk.baserows);
+    G_free(blk.coverrows);
+    for (i = 0; i < nprocs; i++)
+	G_free(blk.digests[i]);
+    G_free(blk.digests);
+
+    for (cat = 0; cat < num_cats; cat++)
+	if (basecats[cat].total > 0)
+	    break;
+    if (cat == num_cats)
+	G_fatal_error(_("No cells found where both base and cover are not NULL"));
+}
+
 static void do_reclass(const char *basemap, char **outputs)
 {
     const char *tempfile = G_tempfile();
@@ -497,14 +643,14 @@ int main(int argc, char *argv[])
     struct
     {
 	struct Option *quant, *perc, *slots, *basemap, *covermap,
-	              *output, *file, *fs;
+	              *output, *file, *fs, *compression, *nprocs;
     } opt;
     struct {
-	struct Flag *r, *p, *t;
+	struct Flag *r, *p, *t, *a;
     } flag;
     const char *basemap, *covermap;
     char **outputs, *fs;
-    int reclass, print;
+    int reclass, print, nprocs;
     int cover_fd, base_fd;
     struct Range range;
     struct FPRange fprange;
@@ -573,9 +719,26 @@ int main(int argc, char *argv[])
     flag.t->description =
 	_("Print statistics in table format");
 
+    flag.a = G_define_flag();
+    flag.a->key = 'a';
+    flag.a->description =
+	_("Compute approximate quantiles in one pass with bounded memory");
+
+    opt.compression = G_define_option();
+    opt.compression->key = "compression";
+    opt.compression->type = TYPE_INTEGER;
+    opt.compression->required = NO;
+    opt.compression->description =
+	_("Number of centroids of the approximate quantiles (-a)");
+    opt.compression->answer = "500";
+
+    opt.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    nprocs = G_set_nprocs(opt.nprocs);
+
     basemap = opt.basemap->answer;
     covermap = opt.covermap->answer;
     outputs = opt.output->answers;
@@ -639,11 +802,16 @@ int main(int argc, char *argv[])
     rows = Rast_window_rows();
     cols = Rast_window_cols();
 
-    get_slot_counts(base_fd, cover_fd);
-    initialize_bins();
-    fill_bins(base_fd, cover_fd);
-    sort_bins();
-    compute_quantiles();
+    if (flag.a->answer)
+	approx_quantiles(base_fd, cover_fd, nprocs,
+			 atoi(opt.compression->answer));
+    else {
+	get_slot_counts(base_fd, cover_fd);
+	initialize_bins();
+	fill_bins(base_fd, cover_fd);
+	sort_bins();
+	compute_quantiles();
+    }
 
     if (print) {
 	/* get field separator */
@@ -70,304 +70,279 @@ struct menu menu[] = {
     {0, 0, 0}
 };
 
-int main(int argc, char **argv)
-{
-    static DCELL *count, *sum, *mean, *sumu, *sum2, *sum3, *sum4, *min, *max;
-    DCELL *result;
-    struct GModule *module;
-    struct {
-	struct Option *method, *basemap, *covermap, *output;
-    } opt;
-    struct {
-	struct Flag *c, *r;
-    } flag;
-    char methods[2048];
-    const char *basemap, *covermap, *output;
-    int usecats;
-    int reclass;
-    int base_fd, cover_fd;
-    struct Categories cats;
-    struct History history;
-    CELL *base_buf;
-    DCELL *cover_buf;
-    struct Range range;
-    CELL mincat, ncats;
-    int method;
-    int rows, cols;
-    int row, col, i;
-
-    G_gisinit(argv[0]);
-
-    module = G_define_module();
-    G_add_keyword(_("raster"));
-    G_add_keyword(_("statistics"));
-    G_add_keyword(_("zonal statistics"));
-    module->description =
-	_("Calculates category or object oriented statistics (accumulator-based statistics).");
-
-    opt.basemap = G_define_standard_option(G_OPT_R_BASE);
-
-    opt.covermap = G_define_standard_option(G_OPT_R_COVER);
-
-    opt.method = G_define_option();
-    opt.method->key = "method";
-    opt.method->type = TYPE_STRING;
-    opt.method->required = YES;
-    opt.method->description = _("Method of object-based statistic");
-
-    for (i = 0; menu[i].name; i++) {
-	if (i)
-	    strcat(methods, ",");
-	else
-	    *(methods) = 0;
-	strcat(methods, menu[i].name);
-    }
-    opt.method->options = G_store(methods);
-
-    for (i = 0; menu[i].name; i++) {
-	if (i)
-	    strcat(methods, ";");
-	else
-	    *(methods) = 0;
-	strcat(methods, menu[i].name);
-	strcat(methods, ";");
-	strcat(methods, menu[i].text);
-    }
-    opt.method->descriptions = G_store(methods);
-
-    opt.output = G_define_standard_option(G_OPT_R_OUTPUT);
-    opt.output->description = _("Resultant raster map");
-    opt.output->required = YES;
-
-    flag.c = G_define_flag();
-    flag.c->key = 'c';
-    flag.c->description =
-	_("Cover values extracted from the category labels of the cover map");
-
-    flag.r = G_define_flag();
-    flag.r->key = 'r';
-    flag.r->description =
-	_("Create reclass map with statistics as category labels");
-
-    if (G_parser(argc, argv))
-	exit(EXIT_FAILURE);
-
-    basemap = opt.basemap->answer;
-    covermap = opt.covermap->answer;
-    output = opt.output->answer;
-    usecats = flag.c->answer;
-    reclass = flag.r->answer;
-
-    for (i = 0; menu[i].name; i++)
-	if (strcmp(menu[i].name, opt.method->answer) == 0)
-	    break;
-
-    if (!menu[i].name) {
-	G_warning(_("<%s=%s> unknown %s"), opt.method->key, opt.method->answer,
-		  opt.method->key);
-	G_usage();
-	exit(EXIT_FAILURE);
-    }
-
-    method = menu[i].val;
-
-    base_fd = Rast_open_old(basemap, "");
-
-    cover_fd = Rast_open_old(covermap, "");
-
-    if (usecats && Rast_read_cats(covermap, "", &cats) < 0)
-	G_fatal_error(_("Unable to read category file of cover map <%s>"), covermap);
+/* rows per thread in a block of rows */
+#define BLOCK_ROWS 16
 
-    if (Rast_map_is_fp(basemap, "") != 0)
-	G_fatal_error(_("The base map must be an integer (CELL) map"));
-
-    if (Rast_read_range(basemap, "", &range) < 0)
-	G_fatal_error(_("Unable to read range of base map <%s>"), basemap);
+/* sums by category of one thread */
+struct acc
+{
+    DCELL *count, *sum, *sum2, *sum3, *sum4, *min, *max;	/* first pass */
+    DCELL *sumu, *dev2, *dev3, *dev4;	/* deviations from the mean */
+};
 
-    mincat = range.min;
-    ncats = range.max - range.min + 1;
+/* sums needed by the methods */
+static struct
+{
+    int count, sum, sum2, sum3, sum4, min, max;
+    int sumu, dev2, dev3, dev4;
+} need;
 
-    rows = Rast_window_rows();
-    cols = Rast_window_cols();
+/* a block of rows processed by several threads */
+struct block
+{
+    CELL **base;
+    DCELL **cover;
+    int cols;
+    CELL mincat, ncats;
+    int chunk;			/* rows per thread */
+    struct acc *acc;		/* by thread */
+    const DCELL *mean;		/* NULL in the first pass */
+};
 
+static void set_need(int method)
+{
     switch (method) {
     case COUNT:
-	count = G_calloc(ncats, sizeof(DCELL));
+	need.count = 1;
 	break;
     case SUM:
-	sum = G_calloc(ncats, sizeof(DCELL));
+	need.sum = 1;
 	break;
     case MIN:
-	min = G_malloc(ncats * sizeof(DCELL));
+	need.min = 1;
 	break;
     case MAX:
-	max = G_malloc(ncats * sizeof(DCELL));
+	need.max = 1;
 	break;
     case RANGE:
-	min = G_malloc(ncats * sizeof(DCELL));
-	max = G_malloc(ncats * sizeof(DCELL));
+	need.min = need.max = 1;
 	break;
     case AVERAGE:
+	need.count = need.sum = 1;
+	break;
     case ADEV:
-    case VARIANCE2:
-    case STDDEV2:
-    case SKEWNESS2:
-    case KURTOSIS2:
-	count = G_calloc(ncats, sizeof(DCELL));
-	sum = G_calloc(ncats, sizeof(DCELL));
+	need.count = need.sum = need.sumu = 1;
 	break;
+    case KURTOSIS1:
+	need.sum4 = 1;
+	/* fall through */
+    case SKEWNESS1:
+	need.sum3 = 1;
+	/* fall through */
     case VARIANCE1:
     case STDDEV1:
-	count = G_calloc(ncats, sizeof(DCELL));
-	sum = G_calloc(ncats, sizeof(DCELL));
-	sum2 = G_calloc(ncats, sizeof(DCELL));
+	need.count = need.sum = need.sum2 = 1;
 	break;
-    case SKEWNESS1:
-	count = G_calloc(ncats, sizeof(DCELL));
-	sum = G_calloc(ncats, sizeof(DCELL));
-	sum2 = G_calloc(ncats, sizeof(DCELL));
-	sum3 = G_calloc(ncats, sizeof(DCELL));
+    case KURTOSIS2:
+	need.dev4 = 1;
+	need.count = need.sum = need.dev2 = 1;
 	break;
-    case KURTOSIS1:
-	count = G_calloc(ncats, sizeof(DCELL));
-	sum = G_calloc(ncats, sizeof(DCELL));
-	sum2 = G_calloc(ncats, sizeof(DCELL));
-	sum4 = G_calloc(ncats, sizeof(DCELL));
+    case SKEWNESS2:
+	need.dev3 = 1;
+	/* fall through */
+    case VARIANCE2:
+    case STDDEV2:
+	need.count = need.sum = need.dev2 = 1;
 	break;
     }
+}
+
+static DCELL *alloc(int needed, int ncats, DCELL init)
+{
+    DCELL *p;
+    int i;
+
+    if (!needed)
+	return NULL;
+
+    p = G_malloc(ncats * sizeof(DCELL));
+    for (i = 0; i < ncats; i++)
+	p[i] = init;
+
+    return p;
+}
+
+static void init_acc(struct acc *a, int ncats)
+{
+    a->count = alloc(need.count, ncats, 0);
+    a->sum = alloc(need.sum, ncats, 0);
+    a->sum2 = alloc(need.sum2, ncats, 0);
+    a->sum3 = alloc(need.sum3, ncats, 0);
+    a->sum4 = alloc(need.sum4, ncats, 0);
+    a->min = alloc(need.min, ncats, 1e300);
+    a->max = alloc(need.max, ncats, -1e300);
+    a->sumu = alloc(need.sumu, ncats, 0);
+    a->dev2 = alloc(need.dev2, ncats, 0);
+    a->dev3 = alloc(need.dev3, ncats, 0);
+    a->dev4 = alloc(need.dev4, ncats, 0);
+}
+
+static void free_acc(struct acc *a)
+{
+    G_free(a->count);
+    G_free(a->sum);
+    G_free(a->sum2);
+    G_free(a->sum3);
+    G_free(a->sum4);
+    G_free(a->min);
+    G_free(a->max);
+    G_free(a->sumu);
+    G_free(a->dev2);
+    G_free(a->dev3);
+    G_free(a->dev4);
+}
+
+static void add_sums(DCELL *dst, const DCELL *src, int ncats)
+{
+    int i;
+
+    if (dst)
+	for (i = 0; i < ncats; i++)
+	    dst[i] += src[i];
+}
+
+/* add the sums of the first or second pass of b to a */
+static void merge_acc(struct acc *a, const struct acc *b, int ncats,
+		      int second)
+{
+    int i;
+
+    if (second) {
+	add_sums(a->sumu, b->sumu, ncats);
+	add_sums(a->dev2, b->dev2, ncats);
+	add_sums(a->dev3, b->dev3, ncats);
+	add_sums(a->dev4, b->dev4, ncats);
+	return;
+    }
 
-    if (min)
+    add_sums(a->count, b->count, ncats);
+    add_sums(a->sum, b->sum, ncats);
+    add_sums(a->sum2, b->sum2, ncats);
+    add_sums(a->sum3, b->sum3, ncats);
+    add_sums(a->sum4, b->sum4, ncats);
+    if (a->min)
 	for (i = 0; i < ncats; i++)
-	    min[i] = 1e300;
-    if (max)
+	    if (a->min[i] > b->min[i])
+		a->min[i] = b->min[i];
+    if (a->max)
 	for (i = 0; i < ncats; i++)
-	    max[i] = -1e300;
-
-    base_buf = Rast_allocate_c_buf();
-    cover_buf = Rast_allocate_d_buf();
+	    if (a->max[i] < b->max[i])
+		a->max[i] = b->max[i];
+}
 
-    G_message(_("First pass"));
+static void accumulate(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct acc *a = &blk->acc[first / blk->chunk];
+    int row, col;
 
-    for (row = 0; row < rows; row++) {
-	Rast_get_c_row(base_fd, base_buf, row);
-	Rast_get_d_row(cover_fd, cover_buf, row);
+    for (row = first; row < last; row++) {
+	const CELL *base = blk->base[row];
+	const DCELL *cover = blk->cover[row];
 
-	for (col = 0; col < cols; col++) {
+	for (col = 0; col < blk->cols; col++) {
 	    int n;
-	    DCELL v;
+	    DCELL v, d;
 
-	    if (Rast_is_c_null_value(&base_buf[col]))
+	    if (Rast_is_c_null_value(&base[col]))
 		continue;
-	    if (Rast_is_d_null_value(&cover_buf[col]))
+	    if (Rast_is_d_null_value(&cover[col]))
 		continue;
 
-	    n = base_buf[col] - mincat;
+	    n = base[col] - blk->mincat;
 
-	    if (n < 0 || n >= ncats)
+	    if (n < 0 || n >= blk->ncats)
 		continue;
 
-	    v = cover_buf[col];
-	    if (usecats)
-		sscanf(Rast_get_c_cat((CELL *) &v, &cats), "%lf", &v);
-
-	    if (count)
-		count[n]++;
-	    if (sum)
-		sum[n] += v;
-	    if (sum2)
-		sum2[n] += v * v;
-	    if (sum3)
-		sum3[n] += v * v * v;
-	    if (sum4)
-		sum4[n] += v * v * v * v;
-	    if (min && min[n] > v)
-		min[n] = v;
-	    if (max && max[n] < v)
-		max[n] = v;
-	}
+	    v = cover[col];
 
-	G_percent(row, rows, 2);
-    }
+	    if (blk->mean) {
+		d = v - blk->mean[n];
 
-    G_percent(row, rows, 2);
-
-    result = G_calloc(ncats, sizeof(DCELL));
+		if (a->sumu)
+		    a->sumu[n] += fabs(d);
+		if (a->dev2)
+		    a->dev2[n] += d * d;
+		if (a->dev3)
+		    a->dev3[n] += d * d * d;
+		if (a->dev4)
+		    a->dev4[n] += d * d * d * d;
+		continue;
+	    }
 
-    switch (method) {
-    case ADEV:
-    case VARIANCE2:
-    case STDDEV2:
-    case SKEWNESS2:
-    case KURTOSIS2:
-	mean = G_calloc(ncats, sizeof(DCELL));
-	for (i = 0; i < ncats; i++)
-	    mean[i] = sum[i] / count[i];
-	G_free(sum);
-	break;
+	    if (a->count)
+		a->count[n]++;
+	    if (a->sum)
+		a->sum[n] += v;
+	    if (a->sum2)
+		a->sum2[n] += v * v;
+	    if (a->sum3)
+		a->sum3[n] += v * v * v;
+	    if (a->sum4)
+		a->sum4[n] += v * v * v * v;
+	    if (a->min && a->min[n] > v)
+		a->min[n] = v;
+	    if (a->max && a->max[n] < v)
+		a->max[n] = v;
+	}
     }
+}
 
-    switch (method) {
-    case ADEV:
-	sumu = G_calloc(ncats, sizeof(DCELL));
-	break;
-    case VARIANCE2:
-    case STDDEV2:
-	sum2 = G_calloc(ncats, sizeof(DCELL));
-	break;
-    case SKEWNESS2:
-	sum2 = G_calloc(ncats, sizeof(DCELL));
-	sum3 = G_calloc(ncats, sizeof(DCELL));
-	break;
-    case KURTOSIS2:
-	sum2 = G_calloc(ncats, sizeof(DCELL));
-	sum4 = G_calloc(ncats, sizeof(DCELL));
-	break;
+/* read the maps in blocks of rows, the rows are accumulated on
+   several threads */
+static void do_pass(struct block *blk, int base_fd, int cover_fd,
+		    int nprocs, struct Categories *cats)
+{
+    int rows = Rast_window_rows();
+    int nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    int row, col, i;
+
+    if (nprocs > 1) {
+	Rast_set_read_ahead(base_fd, nblock);
+	Rast_set_read_ahead(cover_fd, nblock);
     }
 
-    if (mean) {
-	G_message(_("Second pass"));
+    for (row = 0; row < rows; row += nblock) {
+	int n = rows - row < nblock ? rows - row : nblock;
 
-	for (row = 0; row < rows; row++) {
-	    Rast_get_c_row(base_fd, base_buf, row);
-	    Rast_get_d_row(cover_fd, cover_buf, row);
-
-	    for (col = 0; col < cols; col++) {
-		int n;
-		DCELL v, d;
-
-		if (Rast_is_c_null_value(&base_buf[col]))
-		    continue;
-		if (Rast_is_d_null_value(&cover_buf[col]))
-		    continue;
-
-		n = base_buf[col] - mincat;
-
-		if (n < 0 || n >= ncats)
-		    continue;
-
-		v = cover_buf[col];
-		if (usecats)
-		    sscanf(Rast_get_c_cat((CELL *) &v, &cats), "%lf", &v);
-		d = v - mean[n];
-
-		if (sumu)
-		    sumu[n] += fabs(d);
-		if (sum2)
-		    sum2[n] += d * d;
-		if (sum3)
-		    sum3[n] += d * d * d;
-		if (sum4)
-		    sum4[n] += d * d * d * d;
-	    }
+	for (i = 0; i < n; i++) {
+	    Rast_get_c_row(base_fd, blk->base[i], row + i);
+	    Rast_get_d_row(cover_fd, blk->cover[i], row + i);
 
-	    G_percent(row, rows, 2);
+	    /* category labels are looked up here, not by the threads */
+	    if (cats)
+		for (col = 0; col < blk->cols; col++) {
+		    DCELL *v = &blk->cover[i][col];
+
+		    if (!Rast_is_d_null_value(v))
+			sscanf(Rast_get_d_cat(v, cats), "%lf", v);
+		}
 	}
 
+	blk->chunk = (n + nprocs - 1) / nprocs;
+	G_parallel_for(0, n, blk->chunk, accumulate, blk);
+
 	G_percent(row, rows, 2);
-	G_free(mean);
-	G_free(cover_buf);
     }
 
+    G_percent(rows, rows, 2);
+
+    if (nprocs > 1) {
+	Rast_set_read_ahead(base_fd, 0);
+	Rast_set_read_ahead(cover_fd, 0);
+    }
+
+    for (i = 1; i < nprocs; i++)
+	merge_acc(&blk->acc[0], &blk->acc[i], blk->ncats, blk->mean != NULL);
+}
+
+static void compute_result(int method, const struct acc *a, int ncats,
+			   DCELL *result)
+{
+    const DCELL *count = a->count, *sum = a->sum, *sum2 = a->sum2,
+	*sum3 = a->sum3, *sum4 = a->sum4, *min = a->min, *max = a->max;
+    int i;
+
     switch (method) {
     case COUNT:
 	for (i = 0; i < ncats; i++)
@@ -432,100 +407,293 @@ int main(int argc, char **argv)
 	break;
     case ADEV:
 	for (i = 0; i < ncats; i++)
-	    result[i] = sumu[i] / count[i];
+	    result[i] = a->sumu[i] / count[i];
 	break;
     case VARIANCE2:
 	for (i = 0; i < ncats; i++)
-	    result[i] = sum2[i] / (count[i] - 1);
+	    result[i] = a->dev2[i] / (count[i] - 1);
 	break;
     case STDDEV2:
 	for (i = 0; i < ncats; i++)
-	    result[i] = sqrt(sum2[i] / (count[i] - 1));
+	    result[i] = sqrt(a->dev2[i] / (count[i] - 1));
 	break;
     case SKEWNESS2:
 	for (i = 0; i < ncats; i++) {
 	    double n = count[i];
-	    double var = sum2[i] / (n - 1);
+	    double var = a->dev2[i] / (n - 1);
 	    double sdev = sqrt(var);
-	    result[i] = sum3[i] / (sdev * sdev * sdev) / n;
+	    result[i] = a->dev3[i] / (sdev * sdev * sdev) / n;
 	}
-	G_free(count);
-	G_free(sum2);
-	G_free(sum3);
 	break;
     case KURTOSIS2:
 	for (i = 0; i < ncats; i++) {
 	    double n = count[i];
-	    double var = sum2[i] / (n - 1);
-	    result[i] = sum4[i] / (var * var) / n - 3;
+	    double var = a->dev2[i] / (n - 1);
+	    result[i] = a->dev4[i] / (var * var) / n - 3;
 	}
-	G_free(count);
-	G_free(sum2);
-	G_free(sum4);
 	break;
     }
+}
 
-    if (reclass) {
-	const char *tempfile = G_tempfile();
-	char *input_arg = G_malloc(strlen(basemap) + 7);
-	char *output_arg = G_malloc(strlen(output) + 8);
-	char *rules_arg = G_malloc(strlen(tempfile) + 7);
-	FILE *fp;
+int main(int argc, char **argv)
+{
+    DCELL *mean = NULL;
+    DCELL **result;
+    struct GModule *module;
+    struct {
+	struct Option *method, *basemap, *covermap, *output, *nprocs;
+    } opt;
+    struct {
+	struct Flag *c, *r;
+    } flag;
+    char methods[2048];
+    const char *basemap, *covermap;
+    int usecats;
+    int reclass;
+    int base_fd, cover_fd;
+    struct Categories cats;
+    CELL *base_buf;
+    struct Range range;
+    CELL mincat, ncats;
+    int *method;
+    int nmethods, noutputs, nprocs;
+    struct block blk;
+    int rows, cols;
+    int row, col, i, k;
+
+    G_gisinit(argv[0]);
+
+    module = G_define_module();
+    G_add_keyword(_("raster"));
+    G_add_keyword(_("statistics"));
+    G_add_keyword(_("zonal statistics"));
+    module->description =
+	_("Calculates category or object oriented statistics (accumulator-based statistics).");
+
+    opt.basemap = G_define_standard_option(G_OPT_R_BASE);
 
-	G_message(_("Generating reclass map"));
+    opt.covermap = G_define_standard_option(G_OPT_R_COVER);
 
-	sprintf(input_arg, "input=%s", basemap);
-	sprintf(output_arg, "output=%s", output);
-	sprintf(rules_arg, "rules=%s", tempfile);
+    opt.method = G_define_option();
+    opt.method->key = "method";
+    opt.method->type = TYPE_STRING;
+    opt.method->required = YES;
+    opt.method->multiple = YES;
+    opt.method->description = _("Method of object-based statistic");
 
-	fp = fopen(tempfile, "w");
-	if (!fp)
-	    G_fatal_error(_("Unable to open temporary file"));
+    for (i = 0; menu[i].name; i++) {
+	if (i)
+	    strcat(methods, ",");
+	else
+	    *(methods) = 0;
+	strcat(methods, menu[i].name);
+    }
+    opt.method->options = G_store(methods);
 
+    for (i = 0; menu[i].name; i++) {
+	if (i)
+	    strcat(methods, ";");
+	else
+	    *(methods) = 0;
+	strcat(methods, menu[i].name);
+	strcat(methods, ";");
+	strcat(methods, menu[i].text);
+    }
+    opt.method->descriptions = G_store(methods);
+
+    opt.output = G_define_standard_option(G_OPT_R_OUTPUT);
+    opt.output->description = _("Resultant raster map for each method");
+    opt.output->required = YES;
+    opt.output->multiple = YES;
+
+    opt.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
+    flag.c = G_define_flag();
+    flag.c->key = 'c';
+    flag.c->description =
+	_("Cover values extracted from the category labels of the cover map");
+
+    flag.r = G_define_flag();
+    flag.r->key = 'r';
+    flag.r->description =
+	_("Create reclass map with statistics as category labels");
+
+    if (G_parser(argc, argv))
+	exit(EXIT_FAILURE);
+
+    basemap = opt.basemap->answer;
+    covermap = opt.covermap->answer;
+    usecats = flag.c->answer;
+    reclass = flag.r->answer;
+    nprocs = G_set_nprocs(opt.nprocs);
+
+    for (nmethods = 0; opt.method->answers[nmethods]; nmethods++) ;
+    for (noutputs = 0; opt.output->answers[noutputs]; noutputs++) ;
+    if (nmethods != noutputs)
+	G_fatal_error(_("The number of output maps (%d) must match the number of methods (%d)"),
+		      noutputs, nmethods);
+
+    method = G_malloc(nmethods * sizeof(int));
+    for (k = 0; k < nmethods; k++) {
+	for (i = 0; menu[i].name; i++)
+	    if (strcmp(menu[i].name, opt.method->answers[k]) == 0)
+		break;
+
+	if (!menu[i].name) {
+	    G_warning(_("<%s=%s> unknown %s"), opt.method->key,
+		      opt.method->answers[k], opt.method->key);
+	    G_usage();
+	    exit(EXIT_FAILURE);
+	}
+
+	method[k] = menu[i].val;
+	set_need(method[k]);
+    }
+
+    base_fd = Rast_open_old(basemap, "");
+
+    cover_fd = Rast_open_old(covermap, "");
+
+    if (usecats && Rast_read_cats(covermap, "", &cats) < 0)
+	G_fatal_error(_("Unable to read category file of cover map <%s>"), covermap);
+
+    if (Rast_map_is_fp(basemap, "") != 0)
+	G_fatal_error(_("The base map must be an integer (CELL) map"));
+
+    if (Rast_read_range(basemap, "", &range) < 0)
+	G_fatal_error(_("Unable to read range of base map <%s>"), basemap);
+
+    mincat = range.min;
+    ncats = range.max - range.min + 1;
+
+    rows = Rast_window_rows();
+    cols = Rast_window_cols();
+
+    blk.cols = cols;
+    blk.mincat = mincat;
+    blk.ncats = ncats;
+    blk.mean = NULL;
+    blk.acc = G_malloc(nprocs * sizeof(struct acc));
+    for (i = 0; i < nprocs; i++)
+	init_acc(&blk.acc[i], ncats);
+    blk.base = G_malloc(nprocs * BLOCK_ROWS * sizeof(CELL *));
+    blk.cover = G_malloc(nprocs * BLOCK_ROWS * sizeof(DCELL *));
+    for (i = 0; i < nprocs * BLOCK_ROWS; i++) {
+	blk.base[i] = Rast_allocate_c_buf();
+	blk.cover[i] = Rast_allocate_d_buf();
+    }
+
+    G_message(_("First pass"));
+
+    do_pass(&blk, base_fd, cover_fd, nprocs, usecats ? &cats : NULL);
+
+    if (need.sumu || need.dev2) {
+	mean = G_calloc(ncats, sizeof(DCELL));
 	for (i = 0; i < ncats; i++)
-	    fprintf(fp, "%d = %d %f\n", mincat + i, mincat + i, result[i]);
+	    mean[i] = blk.acc[0].sum[i] / blk.acc[0].count[i];
+	blk.mean = mean;
 
-	fclose(fp);
+	G_message(_("Second pass"));
+
+	do_pass(&blk, base_fd, cover_fd, nprocs, usecats ? &cats : NULL);
+
+	G_free(mean);
+    }
 
-	G_spawn("r.reclass", "r.reclass", input_arg, output_arg, rules_arg, NULL);
+    result = G_malloc(nmethods * sizeof(DCELL *));
+    for (k = 0; k < nmethods; k++) {
+	result[k] = G_calloc(ncats, sizeof(DCELL));
+	compute_result(method[k], &blk.acc[0], ncats, result[k]);
+    }
+
+    for (i = 0; i < nprocs; i++)
+	free_acc(&blk.acc[i]);
+    G_free(blk.acc);
+    for (i = 0; i < nprocs * BLOCK_ROWS; i++) {
+	G_free(blk.base[i]);
+	G_free(blk.cover[i]);
+    }
+    G_free(blk.base);
+    G_free(blk.cover);
+
+    base_buf = Rast_allocate_c_buf();
+
+    if (reclass) {
+	for (k = 0; k < nmethods; k++) {
+	    const char *output = opt.output->answers[k];
+	    const char *tempfile = G_tempfile();
+	    char *input_arg = G_malloc(strlen(basemap) + 7);
+	    char *output_arg = G_malloc(strlen(output) + 8);
+	    char *rules_arg = G_malloc(strlen(tempfile) + 7);
+	    FILE *fp;
+
+	    G_message(_("Generating reclass map <%s>"), output);
+
+	    sprintf(input_arg, "input=%s", basemap);
+	    sprintf(output_arg, "output=%s", output);
+	    sprintf(rules_arg, "rules=%s", tempfile);
+
+	    fp = fopen(tempfile, "w");
+	    if (!fp)
+		G_fatal_error(_("Unable to open temporary file"));
+
+	    for (i = 0; i < ncats; i++)
+		fprintf(fp, "%d = %d %f\n", mincat + i, mincat + i,
+			result[k][i]);
+
+	    fclose(fp);
+
+	    G_spawn("r.reclass", "r.reclass", input_arg, output_arg,
+		    rules_arg, NULL);
+	}
     }
     else {
-	int out_fd;
+	int *out_fd = G_malloc(nmethods * sizeof(int));
 	DCELL *out_buf;
 	struct Colors colors;
+	int have_colors;
 
-	G_message(_("Writing output map"));
+	G_message(_("Writing output maps"));
 
-	out_fd = Rast_open_fp_new(output);
+	for (k = 0; k < nmethods; k++)
+	    out_fd[k] = Rast_open_fp_new(opt.output->answers[k]);
 
 	out_buf = Rast_allocate_d_buf();
 
 	for (row = 0; row < rows; row++) {
 	    Rast_get_c_row(base_fd, base_buf, row);
 
-	    for (col = 0; col < cols; col++)
-		if (Rast_is_c_null_value(&base_buf[col]))
-		    Rast_set_d_null_value(&out_buf[col], 1);
-		else
-		    out_buf[col] = result[base_buf[col] - mincat];
+	    for (k = 0; k < nmethods; k++) {
+		for (col = 0; col < cols; col++)
+		    if (Rast_is_c_null_value(&base_buf[col]))
+			Rast_set_d_null_value(&out_buf[col], 1);
+		    else
+			out_buf[col] = result[k][base_buf[col] - mincat];
 
-	    Rast_put_d_row(out_fd, out_buf);
+		Rast_put_d_row(out_fd[k], out_buf);
+	    }
 
 	    G_percent(row, rows, 2);
 	}
 
 	G_percent(row, rows, 2);
 
-	Rast_close(out_fd);
+	have_colors = Rast_read_colors(covermap, "", &colors) > 0;
 
-	Rast_short_history(output, "raster", &history);
-	Rast_command_history(&history);
-	Rast_write_history(output, &history);
+	for (k = 0; k < nmethods; k++) {
+	    const char *output = opt.output->answers[k];
+	    struct History history;
 
-	if (Rast_read_colors(covermap, "", &colors) > 0)
-	    Rast_write_colors(output, G_mapset(), &colors);
+	    Rast_close(out_fd[k]);
+
+	    Rast_short_history(output, "raster", &history);
+	    Rast_command_history(&history);
+	    Rast_write_history(output, &history);
+
+	    if (have_colors)
+		Rast_write_colors(output, G_mapset(), &colors);
+	}
     }
 
     return 0;
 }
-
@@ -2,21 +2,60 @@
 #include <grass/glocale.h>
 #include "global.h"
 
+/* rows per thread in a block of rows */
+#define BLOCK_ROWS 16
+
+struct block
+{
+    CELL ***cell;		/* by row of the block and map */
+    double *area;		/* area of the cells of each row */
+    int chunk;			/* rows per thread */
+};
+
+static void count_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    int row, i;
+
+    for (row = first; row < last; row++) {
+	CELL **cell = blk->cell[row];
+
+	for (i = 0; i < nfiles; i++) {
+	    /* include max FP value in nsteps'th bin */
+	    if(is_fp[i])
+		fix_max_fp_val(cell[i], ncols);
+
+	    /* we can't compute hash on null values, so we change all
+	       nulls to max+1, set NULL_CELL to max+1, and later compare
+	       with NULL_CELL to chack for nulls */
+	    reset_null_vals(cell[i], ncols);
+	}
+
+	update_cell_stats(first / blk->chunk, cell, ncols, blk->area[row]);
+    }
+}
+
 int cell_stats(int fd[], int with_percents, int with_counts,
-	       int with_areas, int do_sort, int with_labels, char *fmt)
+	       int with_areas, int do_sort, int with_labels, char *fmt,
+	       int nprocs, size_t memory)
 {
-    CELL **cell;
-    int i;
+    struct block blk;
+    int nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    int i, j;
     int row;
     double unit_area;
     int planimetric = 0;
     int compute_areas;
     double G_area_of_cell_at_row();
 
-    /* allocate i/o buffers for each raster map */
-    cell = (CELL **) G_calloc(nfiles, sizeof(CELL *));
-    for (i = 0; i < nfiles; i++)
-	cell[i] = Rast_allocate_c_buf();
+    /* allocate i/o buffers for each row of a block and raster map */
+    blk.cell = (CELL ***) G_calloc(nblock, sizeof(CELL **));
+    for (j = 0; j < nblock; j++) {
+	blk.cell[j] = (CELL **) G_calloc(nfiles, sizeof(CELL *));
+	for (i = 0; i < nfiles; i++)
+	    blk.cell[j][i] = Rast_allocate_c_buf();
+    }
+    blk.area = G_calloc(nblock, sizeof(double));
 
     /* if we want area totals, set this up.
      * distinguish projections which are planimetric (all cells same size)
@@ -38,31 +77,33 @@ int cell_stats(int fd[], int with_percents, int with_counts,
     compute_areas = with_areas && !planimetric;
 
     /* here we go */
-    initialize_cell_stats(nfiles);
+    initialize_cell_stats(nfiles, nprocs, memory);
 
-    for (row = 0; row < nrows; row++) {
-	if (compute_areas)
-	    unit_area = G_area_of_cell_at_row(row);
+    if (nprocs > 1)
+	for (i = 0; i < nfiles; i++)
+	    Rast_set_read_ahead(fd[i], nblock);
 
-	G_percent(row, nrows, 2);
+    for (row = 0; row < nrows; row += nblock) {
+	int n = nrows - row < nblock ? nrows - row : nblock;
 
-	for (i = 0; i < nfiles; i++) {
-	    Rast_get_c_row(fd[i], cell[i], row);
+	G_percent(row, nrows, 2);
 
-	    /* include max FP value in nsteps'th bin */
-	    if(is_fp[i])
-		fix_max_fp_val(cell[i], ncols);
+	for (j = 0; j < n; j++) {
+	    if (compute_areas)
+		unit_area = G_area_of_cell_at_row(row + j);
+	    blk.area[j] = unit_area;
 
-	    /* we can't compute hash on null values, so we change all
-	       nulls to max+1, set NULL_CELL to max+1, and later compare
-	       with NULL_CELL to chack for nulls */
-	    reset_null_vals(cell[i], ncols);
+	    for (i = 0; i < nfiles; i++)
+		Rast_get_c_row(fd[i], blk.cell[j][i], row + j);
 	}
 
-	update_cell_stats(cell, ncols, unit_area);
+	blk.chunk = (n + nprocs - 1) / nprocs;
+	G_parallel_for(0, n, blk.chunk, count_rows, &blk);
+
+	check_cell_stats_memory();
     }
 
-    G_percent(row, nrows, 2);
+    G_percent(nrows, nrows, 2);
 
     sort_cell_stats(do_sort);
     print_cell_stats(fmt, with_percents, with_counts, with_areas, with_labels,
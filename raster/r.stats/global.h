@@ -19,18 +19,17 @@ extern char *fs;
 extern struct Categories *labels;
 
 /* cell_stats.c */
-int cell_stats(int[], int, int, int, int, int, char *);
+int cell_stats(int[], int, int, int, int, int, char *, int, size_t);
 
 /* raw_stats.c */
 int raw_stats(int[], int, int, int);
 
 /* stats.c */
-int initialize_cell_stats(int);
-int allocate_values(void);
-struct Node *NewNode(double);
+int initialize_cell_stats(int, int, size_t);
 void fix_max_fp_val(CELL *, int);
 void reset_null_vals(CELL *, int);
-int update_cell_stats(CELL **, int, double);
+int update_cell_stats(int, CELL **, int, double);
+int check_cell_stats_memory(void);
 int sort_cell_stats(int);
 int print_node_count(void);
 int print_cell_stats(char *, int, int, int, int, char *);
@@ -98,6 +98,9 @@ int main(int argc, char *argv[])
 				   explicit fp ranges in cats or when the map 
 				   is int, nsteps is ignored */
         struct Option *sort;    /* sort by cell counts */
+	struct Option *memory;	/* memory for the counts before using
+				   temporary files */
+	struct Option *nprocs;
     } option;
 
     G_gisinit(argv[0]);
@@ -150,6 +153,19 @@ int main(int argc, char *argv[])
                _("Sort by cell counts in descending order"));
     option.sort->guisection = _("Formatting");
 
+    option.memory = G_define_option();
+    option.memory->key = "memory";
+    option.memory->type = TYPE_INTEGER;
+    option.memory->key_desc = "value";
+    option.memory->required = NO;
+    option.memory->multiple = NO;
+    option.memory->answer = "300";
+    option.memory->label = _("Maximum memory to be used for the counts in MB");
+    option.memory->description =
+	_("Counts are written to temporary files beyond this size, 0 for no limit");
+
+    option.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     /* Define the different flags */
 
     flag.a = G_define_flag();
@@ -378,7 +394,8 @@ int main(int argc, char *argv[])
 	raw_stats(fd, with_coordinates, with_xy, with_labels);
     else
 	cell_stats(fd, with_percents, with_counts, with_areas, do_sort,
-                   with_labels, fmt);
+                   with_labels, fmt, G_set_nprocs(option.nprocs),
+		   (size_t)atoi(option.memory->answer) << 20);
 
     exit(EXIT_SUCCESS);
 }
@@ -1,90 +1,88 @@
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <grass/glocale.h>
 #include "global.h"
 
-/* hash definitions (these should be prime numbers) ************* */
-#define HASHSIZE 7307
-#define HASHMOD  89
+/* the combinations of categories of the maps are counted in hash
+ * tables (Cell_table), keyed on the categories of all maps, one table
+ * for each thread. The tables are merged at the end. When
+ * the tables need more memory than allowed, their counts are sorted
+ * and written to a temporary file, the files are merged when the
+ * results are printed. */
 
-static CELL *values;
-static struct Node *node_pool;
-static int node_pool_count;
-static CELL *value_pool;
-static int value_pool_count;
-
-#define NODE_INCR 32
-#define VALUE_INCR 32
+struct count
+{
+    long count;
+    double area;
+};
 
-static struct Node **sorted_list;
+struct table
+{
+    struct Cell_table counts;	/* struct count of each combination */
+    CELL *key;			/* categories of the current cell */
+    long cells, nulls;		/* cells, cells with nulls in all maps */
+};
 
 struct Node
 {
-    CELL *values;
-    struct Node *left;
-    struct Node *right;
-    struct Node *list;
+    const CELL *values;
     long count;
     double area;
 };
 
-static struct Node **hashtable;
-static struct Node *node_list = NULL;
-static int node_count = 0, total_count = 0;
-
-int initialize_cell_stats(int n)
+struct run			/* sorted counts in a temporary file */
 {
-    int i;
-
-    /* record nilfes first */
-    nfiles = n;
+    char *name;
+    FILE *fp;
+    CELL *values;
+    long count;
+    double area;
+    int eof;
+};
 
-    /* allocate a pool of value arrays */
-    value_pool_count = 0;
-    allocate_values();
+static struct table *tables;
+static int ntables;
+static size_t max_bytes;	/* memory for the tables, 0 for no limit */
 
-    /* set Node pool to empty */
-    node_pool_count = 0;
+static struct run *runs;
+static int nruns;
 
+static struct Node *sorted_list;
+static CELL *sorted_values;	/* values of sorted_list read from runs */
+static int node_count = 0;
+static long total_count = 0, null_count = 0;
 
-    /* empty the has table */
-    hashtable = (struct Node **)G_malloc(HASHSIZE * sizeof(struct Node *));
-    for (i = 0; i < HASHSIZE; i++)
-	hashtable[i] = NULL;
+static void table_add(struct table *t, const CELL *key, long count,
+		      double area)
+{
+    struct count *c = Rast_add_cell_table_key(&t->counts, key);
 
-    return 0;
+    c->count += count;
+    c->area += area;
 }
 
-int allocate_values(void)
+int initialize_cell_stats(int n, int nthreads, size_t memory)
 {
-    value_pool_count = VALUE_INCR;
-    value_pool = (CELL *) G_calloc(nfiles * value_pool_count, sizeof(CELL));
-    values = value_pool;
+    int i;
 
-    return 0;
-}
+    /* record nilfes first */
+    nfiles = n;
 
-struct Node *NewNode(double area)
-{
-    struct Node *node;
-
-    if (node_pool_count <= 0)
-	node_pool = (struct Node *)G_calloc(node_pool_count =
-					    NODE_INCR, sizeof(struct Node));
-    node = &node_pool[--node_pool_count];
-    node->count = 1;
-    node->area = area;
-    node->values = values;
-
-    if (--value_pool_count <= 0)
-	allocate_values();
-    else
-	values += nfiles;
+    ntables = nthreads;
+    tables = G_malloc(ntables * sizeof(struct table));
+    for (i = 0; i < ntables; i++) {
+	Rast_init_cell_table(&tables[i].counts, nfiles,
+			     sizeof(struct count), 0);
+	tables[i].key = G_malloc(nfiles * sizeof(CELL));
+	tables[i].cells = tables[i].nulls = 0;
+    }
 
-    node->left = node->right = NULL;
-    node->list = node_list;
-    node_list = node;
-    node_count++;
+    max_bytes = memory;
+    runs = NULL;
+    nruns = 0;
 
-    return node;
+    return 0;
 }
 
 
@@ -119,75 +117,36 @@ void reset_null_vals(CELL *cell, int ncols)
 }
 
 
-int update_cell_stats(CELL ** cell, int ncols, double area)
+/* count the cells of a row in the table of a thread, safe to call
+ * from several threads with different tables */
+int update_cell_stats(int thread, CELL ** cell, int ncols, double area)
 {
-    register int i;
-    register int hash;
-    register struct Node *q, *p = NULL;
-    register int dir = 0;
-
-    while (ncols-- > 0) {
-	/* copy this cell to an array, compute hash */
+    struct table *t = &tables[thread];
+    CELL *key = t->key;
+    int i, col;
 
-	hash = values[0] = cell[0][ncols];
+    for (col = 0; col < ncols; col++) {
+	int nulls = 0;
 
-	for (i = 1; i < nfiles; i++)
-	    hash = hash * HASHMOD + (values[i] = cell[i][ncols]);
-
-	if (hash < 0)
-	    hash = -hash;
+	for (i = 0; i < nfiles; i++) {
+	    key[i] = cell[i][col];
+	    nulls += key[i] == NULL_CELL;
+	}
 
-	hash %= HASHSIZE;
+	table_add(t, key, 1, area);
 
-	/* look it up and update/insert */
-	if ((q = hashtable[hash]) == NULL) {
-	    hashtable[hash] = NewNode(area);
-	}
-	else {
-	    while (1) {
-		for (i = 0; i < nfiles; i++) {
-		    if (values[i] < q->values[i]) {
-			dir = -1;
-			p = q->left;
-			break;
-		    }
-		    if (values[i] > q->values[i]) {
-			dir = 1;
-			p = q->right;
-			break;
-		    }
-		}
-
-		if (i == nfiles) {	/* match */
-		    q->count++;
-		    q->area += area;
-		    total_count++;
-		    break;
-		}
-		else if (p == NULL) {
-		    if (dir < 0)
-			q->left = NewNode(area);
-		    else
-			q->right = NewNode(area);
-		    break;
-		}
-		else
-		    q = p;
-	    }
-	}
+	t->cells++;
+	if (nulls == nfiles)
+	    t->nulls++;
     }
 
     return 0;
 }
 
-static int node_compare(const void *pp, const void *qq)
+static int cmp_values(const CELL *a, const CELL *b)
 {
-    struct Node *const *p = pp, *const *q = qq;
     register int i;
-    register const CELL *a, *b;
 
-    a = (*p)->values;
-    b = (*q)->values;
     for (i = nfiles; --i >= 0;) {
 	if (*a < *b)
 	    return -1;
@@ -199,13 +158,20 @@ static int node_compare(const void *pp, const void *qq)
     return 0;
 }
 
+static int node_compare(const void *pp, const void *qq)
+{
+    const struct Node *p = pp, *q = qq;
+
+    return cmp_values(p->values, q->values);
+}
+
 static int node_compare_count_asc(const void *pp, const void *qq)
 {
-    struct Node *const *p = pp, *const *q = qq;
+    const struct Node *p = pp, *q = qq;
     long a, b;
-    
-    a = (*p)->count;
-    b = (*q)->count;
+
+    a = p->count;
+    b = q->count;
 
     if (a < b)
 	return -1;
@@ -214,35 +180,228 @@ static int node_compare_count_asc(const void *pp, const void *qq)
 
 static int node_compare_count_desc(const void *pp, const void *qq)
 {
-    struct Node *const *p = pp, *const *q = qq;
+    const struct Node *p = pp, *q = qq;
     long a, b;
-    
-    a = (*p)->count;
-    b = (*q)->count;
+
+    a = p->count;
+    b = q->count;
 
     if (a > b)
 	return -1;
     return (a < b);
 }
 
+/* the counts of all tables, sorted by categories */
+static struct Node *collect_nodes(int *count)
+{
+    struct Node *nodes;
+    int n = 0, i, k;
+
+    for (k = 0; k < ntables; k++)
+	n += tables[k].counts.used;
+
+    nodes = G_malloc((n > 0 ? n : 1) * sizeof(struct Node));
+    for (k = 0, n = 0; k < ntables; k++) {
+	const CELL *key;
+	void *value;
+	size_t slot = 0;
+
+	while (Rast_next_cell_table_entry(&tables[k].counts, &slot, &key,
+					  &value)) {
+	    const struct count *c = value;
+
+	    nodes[n].values = key;
+	    nodes[n].count = c->count;
+	    nodes[n].area = c->area;
+	    n++;
+	}
+    }
+
+    qsort(nodes, n, sizeof(struct Node), node_compare);
+
+    /* the same combination may be counted by several threads */
+    for (i = 0, k = 0; i < n; i++) {
+	if (k > 0 && node_compare(&nodes[k - 1], &nodes[i]) == 0) {
+	    nodes[k - 1].count += nodes[i].count;
+	    nodes[k - 1].area += nodes[i].area;
+	}
+	else
+	    nodes[k++] = nodes[i];
+    }
+
+    *count = k;
+
+    return nodes;
+}
+
+/* write the counts of the tables to a temporary file, sorted by
+ * categories, and empty the tables */
+static void spill_tables(void)
+{
+    struct Node *nodes;
+    struct run *r;
+    int n, i;
+
+    nodes = collect_nodes(&n);
+
+    runs = G_realloc(runs, (nruns + 1) * sizeof(struct run));
+    r = &runs[nruns++];
+    r->name = G_tempfile();
+    r->fp = fopen(r->name, "w+b");
+    if (!r->fp)
+	G_fatal_error(_("Unable to open temporary file <%s>"), r->name);
+
+    G_debug(1, "r.stats: writing %d combinations to <%s>", n, r->name);
+
+    for (i = 0; i < n; i++)
+	if (fwrite(nodes[i].values, sizeof(CELL), nfiles, r->fp) != nfiles ||
+	    fwrite(&nodes[i].count, sizeof(long), 1, r->fp) != 1 ||
+	    fwrite(&nodes[i].area, sizeof(double), 1, r->fp) != 1)
+	    G_fatal_error(_("Unable to write to temporary file <%s>"),
+			  r->name);
+
+    G_free(nodes);
+
+    for (i = 0; i < ntables; i++) {
+	Rast_free_cell_table(&tables[i].counts);
+	Rast_init_cell_table(&tables[i].counts, nfiles,
+			     sizeof(struct count), 0);
+    }
+}
+
+/* called between blocks of rows */
+int check_cell_stats_memory(void)
+{
+    size_t bytes = 0;
+    int i;
+
+    if (max_bytes == 0)
+	return 0;
+
+    for (i = 0; i < ntables; i++)
+	bytes += Rast_cell_table_bytes(&tables[i].counts);
+
+    if (bytes > max_bytes)
+	spill_tables();
+
+    return 0;
+}
+
+static int read_run(struct run *r)
+{
+    r->eof = fread(r->values, sizeof(CELL), nfiles, r->fp) != nfiles ||
+	fread(&r->count, sizeof(long), 1, r->fp) != 1 ||
+	fread(&r->area, sizeof(double), 1, r->fp) != 1;
+
+    return !r->eof;
+}
+
+/* merge the runs, calling func for each combination in the order of
+ * the categories */
+static void merge_runs(void (*func) (const struct Node *, void *),
+		       void *closure)
+{
+    struct Node node;
+    CELL *values = G_malloc(nfiles * sizeof(CELL));
+    int i;
+
+    for (i = 0; i < nruns; i++) {
+	rewind(runs[i].fp);
+	runs[i].values = G_malloc(nfiles * sizeof(CELL));
+	read_run(&runs[i]);
+    }
+
+    for (;;) {
+	struct run *min = NULL;
+
+	for (i = 0; i < nruns; i++)
+	    if (!runs[i].eof &&
+		(!min || cmp_values(runs[i].values, min->values) < 0))
+		min = &runs[i];
+
+	if (!min)
+	    break;
+
+	memcpy(values, min->values, nfiles * sizeof(CELL));
+	node.values = values;
+	node.count = 0;
+	node.area = 0;
+
+	for (i = 0; i < nruns; i++)
+	    while (!runs[i].eof && cmp_values(runs[i].values, values) == 0) {
+		node.count += runs[i].count;
+		node.area += runs[i].area;
+		read_run(&runs[i]);
+	    }
+
+	(*func) (&node, closure);
+    }
+
+    for (i = 0; i < nruns; i++) {
+	G_free(runs[i].values);
+	fclose(runs[i].fp);
+	unlink(runs[i].name);
+	G_free(runs[i].name);
+    }
+    G_free(runs);
+    nruns = 0;
+
+    G_free(values);
+}
+
+static int streaming;		/* print while merging the runs */
+
+static void append_node(const struct Node *node, void *closure)
+{
+    static int n_alloc;
+
+    if (node_count >= n_alloc) {
+	n_alloc = n_alloc ? 2 * n_alloc : 1024;
+	sorted_list = G_realloc(sorted_list, n_alloc * sizeof(struct Node));
+	sorted_values =
+	    G_realloc(sorted_values, n_alloc * nfiles * sizeof(CELL));
+    }
+
+    sorted_list[node_count] = *node;
+    memcpy(&sorted_values[node_count * nfiles], node->values,
+	   nfiles * sizeof(CELL));
+    node_count++;
+}
+
 int sort_cell_stats(int do_sort)
 {
-    struct Node **q, *p;
+    int i;
+
+    for (i = 0; i < ntables; i++) {
+	total_count += tables[i].cells;
+	null_count += tables[i].nulls;
+    }
+
+    if (nruns > 0) {
+	spill_tables();
+	for (i = 0; i < ntables; i++)
+	    Rast_free_cell_table(&tables[i].counts);
+	ntables = 0;
+
+	if (do_sort == SORT_DEFAULT) {
+	    streaming = 1;
+	    return 0;
+	}
+
+	merge_runs(append_node, NULL);
+	for (i = 0; i < node_count; i++)
+	    sorted_list[i].values = &sorted_values[i * nfiles];
+    }
+    else
+	sorted_list = collect_nodes(&node_count);
 
     if (node_count <= 0)
 	return 0;
 
-    G_free(hashtable); /* make a bit more room */
-    sorted_list = (struct Node **)G_calloc(node_count, sizeof(struct Node *));
-    for (q = sorted_list, p = node_list; p; p = p->list)
-	*q++ = p;
-
-    if (do_sort == SORT_DEFAULT)
-        qsort(sorted_list, node_count, sizeof(struct Node *), node_compare);
-    else if (do_sort == SORT_ASC)
-        qsort(sorted_list, node_count, sizeof(struct Node *), node_compare_count_asc);
+    if (do_sort == SORT_ASC)
+        qsort(sorted_list, node_count, sizeof(struct Node), node_compare_count_asc);
     else if (do_sort == SORT_DESC)
-        qsort(sorted_list, node_count, sizeof(struct Node *), node_compare_count_desc);
+        qsort(sorted_list, node_count, sizeof(struct Node), node_compare_count_desc);
 
     return 0;
 }
@@ -254,20 +413,132 @@ int print_node_count(void)
     return 0;
 }
 
-int print_cell_stats(char *fmt, int with_percents, int with_counts,
-		 int with_areas, int with_labels, char *fs)
+struct print_opts
+{
+    char *fmt;
+    int with_percents, with_counts, with_areas, with_labels;
+    char *fs;
+};
+
+static void print_node(const struct Node *node, void *closure)
 {
-    int i, n, nulls_found;
-    struct Node *node;
+    const struct print_opts *o = closure;
+    char *fs = o->fs;
+    int i, nulls_found;
     CELL tmp_cell, null_cell;
     DCELL dLow, dHigh;
     char str1[50], str2[50];
 
+    Rast_set_c_null_value(&null_cell, 1);
+
+    if (no_nulls || no_nulls_all) {
+	nulls_found = 0;
+	for (i = 0; i < nfiles; i++)
+	    /*
+	       if (node->values[i] || (!raw_output && is_fp[i]))
+	       break;
+	     */
+	    if (node->values[i] == NULL_CELL)
+		nulls_found++;
+
+	if (nulls_found == nfiles)
+	    return;
+
+	if (no_nulls && nulls_found)
+	    return;
+    }
+
+    for (i = 0; i < nfiles; i++) {
+	if (node->values[i] == NULL_CELL) {
+	    fprintf(stdout, "%s%s", i ? fs : "", no_data_str);
+	    if (o->with_labels && !(raw_output && is_fp[i]))
+		fprintf(stdout, "%s%s", fs,
+			Rast_get_c_cat(&null_cell, &labels[i]));
+	}
+	else if (raw_output || !is_fp[i] || as_int) {
+	    fprintf(stdout, "%s%ld", i ? fs : "",
+		    (long)node->values[i]);
+	    if (o->with_labels && !is_fp[i])
+		fprintf(stdout, "%s%s", fs,
+			Rast_get_c_cat((CELL*) &(node->values[i]),
+				  &labels[i]));
+	}
+	else {		/* find out which floating point range to print */
+
+	    if (cat_ranges)
+		Rast_quant_get_ith_rule(&labels[i].q, node->values[i],
+				     &dLow, &dHigh, &tmp_cell,
+				     &tmp_cell);
+	    else {
+		dLow = (DMAX[i] - DMIN[i]) / nsteps *
+		    (double)(node->values[i] - 1) + DMIN[i];
+		dHigh = (DMAX[i] - DMIN[i]) / nsteps *
+		    (double)node->values[i] + DMIN[i];
+	    }
+	    if (averaged) {
+		/* print averaged values */
+		sprintf(str1, "%10f", (dLow + dHigh) / 2.0);
+		G_trim_decimal(str1);
+		G_strip(str1);
+		fprintf(stdout, "%s%s", i ? fs : "", str1);
+	    }
+	    else {
+		/* print intervals */
+		sprintf(str1, "%10f", dLow);
+		sprintf(str2, "%10f", dHigh);
+		G_trim_decimal(str1);
+		G_trim_decimal(str2);
+		G_strip(str1);
+		G_strip(str2);
+		fprintf(stdout, "%s%s-%s", i ? fs : "", str1, str2);
+	    }
+	    if (o->with_labels) {
+		if (cat_ranges)
+		    fprintf(stdout, "%s%s", fs,
+			    labels[i].labels[node->values[i]]);
+		else
+		    fprintf(stdout, "%sfrom %s to %s", fs,
+			    Rast_get_d_cat(&dLow, &labels[i]),
+			    Rast_get_d_cat(&dHigh, &labels[i]));
+	    }
+	}
+
+    }
+    if (o->with_areas) {
+	fprintf(stdout, "%s", fs);
+	fprintf(stdout, o->fmt, node->area);
+    }
+    if (o->with_counts)
+	fprintf(stdout, "%s%ld", fs, (long)node->count);
+    if (o->with_percents)
+	fprintf(stdout, "%s%.2f%%", fs,
+		(double)100 * node->count / total_count);
+    fprintf(stdout, "\n");
+}
+
+int print_cell_stats(char *fmt, int with_percents, int with_counts,
+		 int with_areas, int with_labels, char *fs)
+{
+    struct print_opts o;
+    int i, n;
+    CELL null_cell;
+
+    o.fmt = fmt;
+    o.with_percents = with_percents;
+    o.with_counts = with_counts;
+    o.with_areas = with_areas;
+    o.with_labels = with_labels;
+    o.fs = fs;
+
+    /* percents of the cells without the cells which are null in all
+       maps */
     if (no_nulls)
-	total_count -= sorted_list[node_count - 1]->count;
+	total_count -= null_count;
 
     Rast_set_c_null_value(&null_cell, 1);
-    if (node_count <= 0) {
+    if (streaming)
+	merge_runs(print_node, &o);
+    else if (node_count <= 0) {
 	fprintf(stdout, "0");
 	for (i = 1; i < nfiles; i++)
 	    fprintf(stdout, "%s%s", fs, no_data_str);
@@ -282,93 +553,8 @@ int print_cell_stats(char *fmt, int with_percents, int with_counts,
 	fprintf(stdout, "\n");
     }
     else {
-	for (n = 0; n < node_count; n++) {
-	    node = sorted_list[n];
-
-	    if (no_nulls || no_nulls_all) {
-		nulls_found = 0;
-		for (i = 0; i < nfiles; i++)
-		    /*
-		       if (node->values[i] || (!raw_output && is_fp[i]))
-		       break;
-		     */
-		    if (node->values[i] == NULL_CELL)
-			nulls_found++;
-
-		if (nulls_found == nfiles)
-		    continue;
-
-		if (no_nulls && nulls_found)
-		    continue;
-	    }
-
-	    for (i = 0; i < nfiles; i++) {
-		if (node->values[i] == NULL_CELL) {
-		    fprintf(stdout, "%s%s", i ? fs : "", no_data_str);
-		    if (with_labels && !(raw_output && is_fp[i]))
-			fprintf(stdout, "%s%s", fs,
-				Rast_get_c_cat(&null_cell, &labels[i]));
-		}
-		else if (raw_output || !is_fp[i] || as_int) {
-		    fprintf(stdout, "%s%ld", i ? fs : "",
-			    (long)node->values[i]);
-		    if (with_labels && !is_fp[i])
-			fprintf(stdout, "%s%s", fs,
-				Rast_get_c_cat((CELL*) &(node->values[i]),
-					  &labels[i]));
-		}
-		else {		/* find out which floating point range to print */
-
-		    if (cat_ranges)
-			Rast_quant_get_ith_rule(&labels[i].q, node->values[i],
-					     &dLow, &dHigh, &tmp_cell,
-					     &tmp_cell);
-		    else {
-			dLow = (DMAX[i] - DMIN[i]) / nsteps *
-			    (double)(node->values[i] - 1) + DMIN[i];
-			dHigh = (DMAX[i] - DMIN[i]) / nsteps *
-			    (double)node->values[i] + DMIN[i];
-		    }
-		    if (averaged) {
-			/* print averaged values */
-			sprintf(str1, "%10f", (dLow + dHigh) / 2.0);
-			G_trim_decimal(str1);
-			G_strip(str1);
-			fprintf(stdout, "%s%s", i ? fs : "", str1);
-		    }
-		    else {
-			/* print intervals */
-			sprintf(str1, "%10f", dLow);
-			sprintf(str2, "%10f", dHigh);
-			G_trim_decimal(str1);
-			G_trim_decimal(str2);
-			G_strip(str1);
-			G_strip(str2);
-			fprintf(stdout, "%s%s-%s", i ? fs : "", str1, str2);
-		    }
-		    if (with_labels) {
-			if (cat_ranges)
-			    fprintf(stdout, "%s%s", fs,
-				    labels[i].labels[node->values[i]]);
-			else
-			    fprintf(stdout, "%sfrom %s to %s", fs,
-				    Rast_get_d_cat(&dLow, &labels[i]),
-				    Rast_get_d_cat(&dHigh, &labels[i]));
-		    }
-		}
-
-	    }
-	    if (with_areas) {
-		fprintf(stdout, "%s", fs);
-		fprintf(stdout, fmt, node->area);
-	    }
-	    if (with_counts)
-		fprintf(stdout, "%s%ld", fs, (long)node->count);
-	    if (with_percents)
-		fprintf(stdout, "%s%.2f%%", fs,
-			(double)100 * node->count / total_count);
-	    fprintf(stdout, "\n");
-	}
+	for (n = 0; n < node_count; n++)
+	    print_node(&sorted_list[n], &o);
     }
 
     return 0;
@@ -0,0 +1,436 @@
+#include <stdlib.h>
+#include <math.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+/* Flow accumulation on several threads
+ *
+ * do_accum() visits the cells in the order of the A* search and pushes
+ * the flow of each cell to its downstream cells. Here, a cell pulls the
+ * flow of its upstream cells when all of them are done, in the order of
+ * the A* search. This gives exactly the results of do_accum() while
+ * cells of different branches of the flow network are processed at the
+ * same time.
+ *
+ * The region is split into stripes of rows, one per thread. Only the
+ * thread of a stripe modifies the cells of its stripe, a cell which
+ * becomes ready in another stripe is sent to that stripe and picked up
+ * in the next round. All data stay in segment files.
+ */
+
+/* node of the flow network */
+struct node
+{
+    GW_LARGE_INT rank;		/* index in astar_pts */
+    double sum_weight;		/* MFD: sum of weights */
+    double max_weight;		/* MFD: weight of the A* path if not set */
+    unsigned char down;		/* bit ct_dir: flow goes to this neighbour */
+    unsigned char count;	/* number of upstream cells not yet done */
+    char np_side;		/* direction of the A* path */
+    char mfd_cells;		/* MFD: number of downstream cells */
+    char bad_prop;		/* MFD: sum of weights is not 1 */
+};
+
+struct plist
+{
+    POINT *pnt;
+    int n, n_alloc;
+};
+
+struct stripe
+{
+    int first, last;		/* rows */
+    struct plist ready;		/* cells with all upstream cells done */
+    struct plist *out;		/* ready counts to decrement, by stripe */
+    GW_LARGE_INT done, bad_prop;
+};
+
+struct accum
+{
+    SSEG nodes;
+    int nstripes;
+    struct stripe *stripes;
+    double d8cut;
+    const double *dist_to_nbr;
+};
+
+static int asp_r[9] = { 0, -1, -1, -1, 0, 1, 1, 1, 0 };
+static int asp_c[9] = { 0, 1, 0, -1, -1, -1, 0, 1, 1 };
+/* opposite directions are pairs */
+static int nextdr[8] = { 1, -1, 0, 0, -1, 1, 1, -1 };
+static int nextdc[8] = { 0, 0, -1, 1, 1, -1, 1, -1 };
+
+static void plist_add(struct plist *l, int r, int c)
+{
+    if (l->n >= l->n_alloc) {
+	l->n_alloc += 1000;
+	l->pnt = (POINT *)G_realloc(l->pnt, l->n_alloc * sizeof(POINT));
+    }
+    l->pnt[l->n].r = r;
+    l->pnt[l->n].c = c;
+    l->n++;
+}
+
+static int owner(const struct accum *p, int r)
+{
+    return (GW_LARGE_INT)r * p->nstripes / nrows;
+}
+
+/* the weights of the first loop of do_accum(), a neighbour is worked
+ * if it comes earlier in the A* search */
+static void set_weights(struct accum *p, int r, int c,
+			struct node *nd)
+{
+    int dr, dc, r_nbr, c_nbr, ct_dir, edge, astar_not_set;
+    double weight[8], prop;
+    CELL_REC cr, cr_nbr;
+    struct node nd_nbr;
+
+    nd->down = 0;
+    nd->np_side = -1;
+    nd->mfd_cells = 0;
+    nd->bad_prop = 0;
+    nd->sum_weight = 0;
+    nd->max_weight = 0;
+
+    seg_get(&cells, (char *)&cr, r, c);
+    if (FLAG_GET(cr.flag, NULLFLAG) || cr.asp <= 0)
+	return;
+
+    dr = r + asp_r[(int)cr.asp];
+    dc = c + asp_c[(int)cr.asp];
+
+    astar_not_set = 1;
+    edge = 0;
+    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+	r_nbr = r + nextdr[ct_dir];
+	c_nbr = c + nextdc[ct_dir];
+	weight[ct_dir] = -1;
+
+	if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 && c_nbr < ncols) {
+	    seg_get(&cells, (char *)&cr_nbr, r_nbr, c_nbr);
+	    if ((edge = FLAG_GET(cr_nbr.flag, NULLFLAG)))
+		break;
+	    seg_get(&p->nodes, (char *)&nd_nbr, r_nbr, c_nbr);
+
+	    if (nd_nbr.rank > nd->rank && cr_nbr.ele <= cr.ele) {
+		if (cr_nbr.ele < cr.ele) {
+		    weight[ct_dir] =
+			mfd_pow((cr.ele -
+				 cr_nbr.ele) / p->dist_to_nbr[ct_dir]);
+		}
+		if (cr_nbr.ele == cr.ele) {
+		    weight[ct_dir] = mfd_pow(0.5 / p->dist_to_nbr[ct_dir]);
+		}
+		nd->sum_weight += weight[ct_dir];
+		nd->mfd_cells++;
+
+		if (weight[ct_dir] > nd->max_weight)
+		    nd->max_weight = weight[ct_dir];
+
+		if (dr == r_nbr && dc == c_nbr)
+		    astar_not_set = 0;
+	    }
+	    if (dr == r_nbr && dc == c_nbr)
+		nd->np_side = ct_dir;
+	}
+	else
+	    edge = 1;
+	if (edge)
+	    break;
+    }
+
+    /* do not distribute flow along edges, this causes artifacts */
+    if (edge)
+	return;
+
+    /* MFD, A * path not included, add to mfd_cells */
+    if (nd->mfd_cells > 0 && astar_not_set == 1) {
+	nd->mfd_cells++;
+	nd->sum_weight += nd->max_weight;
+	weight[(int)nd->np_side] = nd->max_weight;
+    }
+
+    if (nd->mfd_cells > 1) {
+	prop = 0.0;
+	for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+	    if (weight[ct_dir] > -0.5) {
+		prop += weight[ct_dir] / nd->sum_weight;
+		nd->down |= 1 << ct_dir;
+	    }
+	}
+	nd->bad_prop = fabs(prop - 1.0) > 5E-6f;
+    }
+    else
+	nd->down = 1 << nd->np_side;
+}
+
+/* downstream cells of a stripe */
+static void set_down(int first, int last, void *closure)
+{
+    struct accum *p = closure;
+    struct stripe *s = &p->stripes[first];
+    struct node nd;
+    int r, c;
+
+    for (r = s->first; r < s->last; r++) {
+	for (c = 0; c < ncols; c++) {
+	    seg_get(&p->nodes, (char *)&nd, r, c);
+	    if (nd.rank < 0)
+		continue;
+	    set_weights(p, r, c, &nd);
+	    seg_put(&p->nodes, (char *)&nd, r, c);
+	}
+    }
+}
+
+/* number of upstream cells of a stripe */
+static void set_count(int first, int last, void *closure)
+{
+    struct accum *p = closure;
+    struct stripe *s = &p->stripes[first];
+    struct node nd, nd_up;
+    int r, c, ur, uc, ct_dir;
+
+    for (r = s->first; r < s->last; r++) {
+	for (c = 0; c < ncols; c++) {
+	    seg_get(&p->nodes, (char *)&nd, r, c);
+	    if (nd.rank < 0)
+		continue;
+	    nd.count = 0;
+	    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+		ur = r + nextdr[ct_dir];
+		uc = c + nextdc[ct_dir];
+		if (ur < 0 || ur >= nrows || uc < 0 || uc >= ncols)
+		    continue;
+		seg_get(&p->nodes, (char *)&nd_up, ur, uc);
+		if (nd_up.rank >= 0 && (nd_up.down & (1 << (ct_dir ^ 1))))
+		    nd.count++;
+	    }
+	    seg_put(&p->nodes, (char *)&nd, r, c);
+	    if (nd.count == 0)
+		plist_add(&s->ready, r, c);
+	}
+    }
+}
+
+/* flow of upstream cells, then the cell itself */
+static void do_cell(struct accum *p, struct stripe *s, int r, int c)
+{
+    int ct_dir, dir, i, j, n, ur, uc;
+    int up_dir[8];
+    struct node nd, nd_up[8], tmp_nd;
+    CELL_REC cr, cr_up;
+    double weight;
+    DCELL value;
+
+    seg_get(&cells, (char *)&cr, r, c);
+
+    /* upstream cells in the order of the A* search */
+    n = 0;
+    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+	ur = r + nextdr[ct_dir];
+	uc = c + nextdc[ct_dir];
+	if (ur < 0 || ur >= nrows || uc < 0 || uc >= ncols)
+	    continue;
+	seg_get(&p->nodes, (char *)&tmp_nd, ur, uc);
+	if (tmp_nd.rank < 0 || !(tmp_nd.down & (1 << (ct_dir ^ 1))))
+	    continue;
+
+	for (i = n; i > 0 && nd_up[i - 1].rank > tmp_nd.rank; i--) {
+	    nd_up[i] = nd_up[i - 1];
+	    up_dir[i] = up_dir[i - 1];
+	}
+	nd_up[i] = tmp_nd;
+	up_dir[i] = ct_dir;
+	n++;
+    }
+
+    for (j = 0; j < n; j++) {
+	ur = r + nextdr[up_dir[j]];
+	uc = c + nextdc[up_dir[j]];
+	/* direction from the upstream cell to this cell */
+	dir = up_dir[j] ^ 1;
+	seg_get(&cells, (char *)&cr_up, ur, uc);
+	value = cr_up.wat;
+
+	/* use SFD (D8) if d8cut threshold exceeded */
+	if (nd_up[j].mfd_cells > 1 && fabs(value) <= p->d8cut) {
+	    if (cr.ele < cr_up.ele)
+		weight = mfd_pow((cr_up.ele - cr.ele) / p->dist_to_nbr[dir]);
+	    else if (cr.ele == cr_up.ele)
+		weight = mfd_pow(0.5 / p->dist_to_nbr[dir]);
+	    else
+		weight = nd_up[j].max_weight;
+	    weight = weight / nd_up[j].sum_weight;
+	    cr.wat += value * weight;
+	}
+	else if (dir == nd_up[j].np_side)
+	    cr.wat += value;
+    }
+
+    /* WORKEDFLAG has been set during A* Search
+     * reversed meaning here: 0 = done, 1 = not yet done */
+    FLAG_UNSET(cr.flag, WORKEDFLAG);
+    seg_put(&cells, (char *)&cr, r, c);
+
+    /* the cell is done, tell the downstream cells */
+    seg_get(&p->nodes, (char *)&nd, r, c);
+    if (nd.bad_prop && fabs(cr.wat) <= p->d8cut)
+	s->bad_prop++;
+    s->done++;
+
+    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+	if (!(nd.down & (1 << ct_dir)))
+	    continue;
+	plist_add(&s->out[owner(p, r + nextdr[ct_dir])],
+		  r + nextdr[ct_dir], c + nextdc[ct_dir]);
+    }
+}
+
+/* one less upstream cell to wait for */
+static void count_down(struct accum *p, struct stripe *s, int r, int c)
+{
+    struct node nd;
+
+    seg_get(&p->nodes, (char *)&nd, r, c);
+    nd.count--;
+    seg_put(&p->nodes, (char *)&nd, r, c);
+    if (nd.count == 0)
+	plist_add(&s->ready, r, c);
+}
+
+/* runs on a worker thread: process the ready cells of a stripe and the
+ * downstream cells in the same stripe which become ready */
+static void sweep(int first, int last, void *closure)
+{
+    struct accum *p = closure;
+    struct stripe *s = &p->stripes[first];
+    struct plist *own = &s->out[first];
+    int i, r, c;
+
+    while (s->ready.n > 0) {
+	s->ready.n--;
+	r = s->ready.pnt[s->ready.n].r;
+	c = s->ready.pnt[s->ready.n].c;
+	do_cell(p, s, r, c);
+
+	for (i = 0; i < own->n; i++)
+	    count_down(p, s, own->pnt[i].r, own->pnt[i].c);
+	own->n = 0;
+    }
+}
+
+/* runs on a worker thread: collect what the other stripes have sent */
+static void deliver(int first, int last, void *closure)
+{
+    struct accum *p = closure;
+    struct stripe *s = &p->stripes[first];
+    struct plist *in;
+    int i, j;
+
+    for (j = 0; j < p->nstripes; j++) {
+	in = &p->stripes[j].out[first];
+	for (i = 0; i < in->n; i++)
+	    count_down(p, s, in->pnt[i].r, in->pnt[i].c);
+	in->n = 0;
+    }
+}
+
+/*
+ * accumulate surface flow on several threads, same results as do_accum()
+ */
+int do_accum_par(double d8cut, const double *dist_to_nbr)
+{
+    struct accum p;
+    struct node nd;
+    struct stripe *s;
+    POINT astarpoint;
+    GW_LARGE_INT killer, done, bad_prop;
+    int i, j, r, c, nseg, busy;
+
+    p.nstripes = nprocs;
+    if (p.nstripes > nrows)
+	p.nstripes = nrows;
+    p.d8cut = d8cut;
+    p.dist_to_nbr = dist_to_nbr;
+
+    G_verbose_message(_("Accumulating flow with %d threads"), p.nstripes);
+
+    /* as much memory as for the cells */
+    nseg = cells.seg.nseg * sizeof(CELL_REC) / sizeof(struct node);
+    if (nseg < 2 * p.nstripes)
+	nseg = 2 * p.nstripes;
+    if (seg_open(&p.nodes, nrows, ncols, cells.seg.srows, cells.seg.scols,
+		 nseg, sizeof(struct node), 0) < 0)
+	G_fatal_error(_("Unable to create temporary file"));
+
+    G_init_workers();
+    if (Segment_set_shared(&cells.seg, p.nstripes) < 0 ||
+	Segment_set_shared(&p.nodes.seg, p.nstripes) < 0)
+	G_fatal_error(_("Unable to prepare temporary files for threads"));
+
+    p.stripes = G_calloc(p.nstripes, sizeof(struct stripe));
+    for (i = 0; i < p.nstripes; i++) {
+	s = &p.stripes[i];
+	s->first = (GW_LARGE_INT)i * nrows / p.nstripes;
+	s->last = (GW_LARGE_INT)(i + 1) * nrows / p.nstripes;
+	s->out = G_calloc(p.nstripes, sizeof(struct plist));
+    }
+
+    /* rank of each cell, -1 for cells not in the A* search */
+    nd.rank = -1;
+    nd.sum_weight = nd.max_weight = 0;
+    nd.down = nd.count = 0;
+    nd.np_side = -1;
+    nd.mfd_cells = nd.bad_prop = 0;
+    for (r = 0; r < nrows; r++) {
+	for (c = 0; c < ncols; c++)
+	    seg_put(&p.nodes, (char *)&nd, r, c);
+    }
+    for (killer = 0; killer < n_points; killer++) {
+	seg_get(&astar_pts, (char *)&astarpoint, 0, killer);
+	nd.rank = killer;
+	seg_put(&p.nodes, (char *)&nd, astarpoint.r, astarpoint.c);
+    }
+
+    G_parallel_for(0, p.nstripes, 1, set_down, &p);
+    G_parallel_for(0, p.nstripes, 1, set_count, &p);
+
+    /* sweep until no cell is left */
+    do {
+	G_parallel_for(0, p.nstripes, 1, sweep, &p);
+	G_parallel_for(0, p.nstripes, 1, deliver, &p);
+
+	busy = 0;
+	done = 0;
+	for (i = 0; i < p.nstripes; i++) {
+	    busy |= p.stripes[i].ready.n > 0;
+	    done += p.stripes[i].done;
+	}
+	G_percent(done, n_points, 1);
+    } while (busy);
+    G_percent(1, 1, 1);
+
+    bad_prop = 0;
+    for (i = 0; i < p.nstripes; i++) {
+	s = &p.stripes[i];
+	bad_prop += s->bad_prop;
+	for (j = 0; j < p.nstripes; j++)
+	    G_free(s->out[j].pnt);
+	G_free(s->out);
+	G_free(s->ready.pnt);
+    }
+    G_free(p.stripes);
+    seg_close(&p.nodes);
+
+    if (done != n_points)
+	G_fatal_error(_("Flow accumulation: %"PRI_OFF_T" of %"PRI_OFF_T" cells done"),
+		      done, n_points);
+    if (bad_prop)
+	G_warning(_("MFD: cumulative proportion of flow distribution not 1.0 for %"PRI_OFF_T" cells"),
+		  bad_prop);
+
+    return 1;
+}
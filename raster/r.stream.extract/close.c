@@ -9,7 +9,7 @@ int close_streamvect(char *stream_vect)
     int r, c, r_nbr, c_nbr, done;
     GW_LARGE_INT i;
     CELL stream_id, stream_nbr;
-    ASP_FLAG af;
+    CELL_REC cr;
     int next_node;
     struct sstack
     {
@@ -57,7 +57,8 @@ int close_streamvect(char *stream_vect)
 	G_percent(i, n_outlets, 2);
 	r = outlets[i].r;
 	c = outlets[i].c;
-	cseg_get(&stream, &stream_id, r, c);
+	seg_get(&cells, (char *)&cr, r, c);
+	stream_id = cr.stream;
 
 	if (!stream_id)
 	    continue;
@@ -118,7 +119,8 @@ int close_streamvect(char *stream_vect)
 		r_nbr = stream_node[stream_id].r;
 		c_nbr = stream_node[stream_id].c;
 
-		cseg_get(&stream, &stream_nbr, r_nbr, c_nbr);
+		seg_get(&cells, (char *)&cr, r_nbr, c_nbr);
+		stream_nbr = cr.stream;
 		if (stream_nbr <= 0)
                     G_fatal_error(_("Stream id %d not set, top is %d, parent is %d"),
                                   stream_id, top, nodestack[top - 1].stream_id);
@@ -134,12 +136,12 @@ int close_streamvect(char *stream_vect)
 
 		Vect_write_line(&Out, GV_POINT, Points, Cats);
 
-		seg_get(&aspflag, (char *)&af, r_nbr, c_nbr);
-		while (af.asp > 0) {
-		    r_nbr = r_nbr + asp_r[(int)af.asp];
-		    c_nbr = c_nbr + asp_c[(int)af.asp];
+		while (cr.asp > 0) {
+		    r_nbr = r_nbr + asp_r[(int)cr.asp];
+		    c_nbr = c_nbr + asp_c[(int)cr.asp];
 		    
-		    cseg_get(&stream, &stream_nbr, r_nbr, c_nbr);
+		    seg_get(&cells, (char *)&cr, r_nbr, c_nbr);
+		    stream_nbr = cr.stream;
 		    if (stream_nbr <= 0)
 			G_fatal_error(_("Stream id not set while tracing"));
 
@@ -149,7 +151,6 @@ int close_streamvect(char *stream_vect)
 			/* first point of parent stream */
 			break;
 		    }
-		    seg_get(&aspflag, (char *)&af, r_nbr, c_nbr);
 		}
 
 		Vect_write_line(&Out, GV_LINE, Points, Cats);
@@ -245,8 +246,7 @@ int close_maps(char *stream_rast, char *stream_vect, char *dir_rast)
     int stream_fd, dir_fd, r, c, i;
     CELL *cell_buf1, *cell_buf2;
     struct History history;
-    CELL stream_id;
-    ASP_FLAG af;
+    CELL_REC cr;
 
     /* cheating... */
     stream_fd = dir_fd = -1;
@@ -272,15 +272,14 @@ int close_maps(char *stream_rast, char *stream_vect, char *dir_rast)
 	    Rast_set_c_null_value(cell_buf2, ncols);	/* reset row to all NULL */
 
 	for (c = 0; c < ncols; c++) {
+	    seg_get(&cells, (char *)&cr, r, c);
 	    if (stream_rast) {
-		cseg_get(&stream, &stream_id, r, c);
-		if (stream_id)
-		    cell_buf1[c] = stream_id;
+		if (cr.stream)
+		    cell_buf1[c] = cr.stream;
 	    }
 	    if (dir_rast) {
-		seg_get(&aspflag, (char *)&af, r, c);
-		if (!FLAG_GET(af.flag, NULLFLAG)) {
-		    cell_buf2[c] = af.asp;
+		if (!FLAG_GET(cr.flag, NULLFLAG)) {
+		    cell_buf2[c] = cr.asp;
 		}
 	    }
 	    
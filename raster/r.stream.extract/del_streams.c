@@ -12,7 +12,7 @@ int seg_length(CELL stream_id, CELL *next_stream_id)
     CELL curr_stream;
     int asp_r[9] = { 0, -1, -1, -1, 0, 1, 1, 1, 0 };
     int asp_c[9] = { 0, 1, 0, -1, -1, -1, 0, 1, 1 };
-    ASP_FLAG af;
+    CELL_REC cr;
 
     r = stream_node[stream_id].r;
     c = stream_node[stream_id].c;
@@ -20,10 +20,10 @@ int seg_length(CELL stream_id, CELL *next_stream_id)
 	*next_stream_id = stream_id;
 
     /* get next downstream point */
-    seg_get(&aspflag, (char *)&af, r, c);
-    while (af.asp > 0) {
-	r_nbr = r + asp_r[(int)af.asp];
-	c_nbr = c + asp_c[(int)af.asp];
+    seg_get(&cells, (char *)&cr, r, c);
+    while (cr.asp > 0) {
+	r_nbr = r + asp_r[(int)cr.asp];
+	c_nbr = c + asp_c[(int)cr.asp];
 
 	/* user-defined depression */
 	if (r_nbr == r && c_nbr == c)
@@ -32,7 +32,8 @@ int seg_length(CELL stream_id, CELL *next_stream_id)
 	if (r_nbr < 0 || r_nbr >= nrows || c_nbr < 0 || c_nbr >= ncols)
 	    break;
 	/* next stream */
-	cseg_get(&stream, &curr_stream, r_nbr, c_nbr);
+	seg_get(&cells, (char *)&cr, r_nbr, c_nbr);
+	curr_stream = cr.stream;
 	if (next_stream_id)
 	    *next_stream_id = curr_stream;
 	if (curr_stream != stream_id)
@@ -40,7 +41,6 @@ int seg_length(CELL stream_id, CELL *next_stream_id)
 	slength++;
 	r = r_nbr;
 	c = c_nbr;
-	seg_get(&aspflag, (char *)&af, r, c);
     }
 
     return slength;
@@ -54,21 +54,22 @@ int update_stream_id(CELL stream_id, CELL new_stream_id)
     CELL curr_stream;
     int asp_r[9] = { 0, -1, -1, -1, 0, 1, 1, 1, 0 };
     int asp_c[9] = { 0, 1, 0, -1, -1, -1, 0, 1, 1 };
-    ASP_FLAG af;
+    CELL_REC cr;
 
     r = stream_node[stream_id].r;
     c = stream_node[stream_id].c;
-    cseg_get(&stream, &curr_stream, r, c);
+    seg_get(&cells, (char *)&cr, r, c);
+    curr_stream = cr.stream;
     if (curr_stream != stream_id)
 	G_fatal_error("Update downstream id: curr_stream != stream_id");
-    cseg_put(&stream, &new_stream, r, c);
+    cr.stream = new_stream;
+    seg_put(&cells, (char *)&cr, r, c);
     curr_stream = stream_id;
 
     /* get next downstream point */
-    seg_get(&aspflag, (char *)&af, r, c);
-    while (af.asp > 0) {
-	r_nbr = r + asp_r[(int)af.asp];
-	c_nbr = c + asp_c[(int)af.asp];
+    while (cr.asp > 0) {
+	r_nbr = r + asp_r[(int)cr.asp];
+	c_nbr = c + asp_c[(int)cr.asp];
 
 	/* user-defined depression */
 	if (r_nbr == r && c_nbr == c)
@@ -77,13 +78,14 @@ int update_stream_id(CELL stream_id, CELL new_stream_id)
 	if (r_nbr < 0 || r_nbr >= nrows || c_nbr < 0 || c_nbr >= ncols)
 	    break;
 	/* next stream */
-	cseg_get(&stream, &curr_stream, r_nbr, c_nbr);
+	seg_get(&cells, (char *)&cr, r_nbr, c_nbr);
+	curr_stream = cr.stream;
 	if (curr_stream != stream_id)
 	    break;
 	r = r_nbr;
 	c = c_nbr;
-	cseg_put(&stream, &new_stream, r, c);
-	seg_get(&aspflag, (char *)&af, r, c);
+	cr.stream = new_stream;
+	seg_put(&cells, (char *)&cr, r, c);
     }
     
     if (curr_stream <= 0)
@@ -126,6 +128,7 @@ int del_streams(int min_length)
     CELL curr_stream, stream_id;
     int other_trib, tmp_trib;
     int slength;
+    CELL_REC cr;
 
     G_message(n_("Deleting stream segments shorter than %d cell...",
                  "Deleting stream segments shorter than %d cells...", min_length),
@@ -143,7 +146,8 @@ int del_streams(int min_length)
 	    continue;
 
 	/* already deleted */
-	cseg_get(&stream, &curr_stream, stream_node[i].r, stream_node[i].c);
+	seg_get(&cells, (char *)&cr, stream_node[i].r, stream_node[i].c);
+	curr_stream = cr.stream;
 	if (curr_stream == 0)
 	    continue;
 
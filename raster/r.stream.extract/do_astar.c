@@ -17,8 +17,7 @@ int do_astar(void)
     int nextdr[8] = { 1, -1, 0, 0, -1, 1, 1, -1 };
     int nextdc[8] = { 0, 0, -1, 1, 1, -1, 1, -1 };
     CELL ele_val, ele_up, ele_nbr[8];
-    WAT_ALT wa;
-    ASP_FLAG af;
+    CELL_REC cr;
     char is_in_list, is_worked;
     HEAP_PNT heap_p;
     /* sides
@@ -86,17 +85,16 @@ int do_astar(void)
 	    if (r_nbr < 0 || r_nbr >= nrows || c_nbr < 0 || c_nbr >= ncols)
 		continue;
 
-	    seg_get(&aspflag, (char *)&af, r_nbr, c_nbr);
-	    is_in_list = FLAG_GET(af.flag, INLISTFLAG);
-	    is_worked = FLAG_GET(af.flag, WORKEDFLAG);
+	    seg_get(&cells, (char *)&cr, r_nbr, c_nbr);
+	    is_in_list = FLAG_GET(cr.flag, INLISTFLAG);
+	    is_worked = FLAG_GET(cr.flag, WORKEDFLAG);
 	    if (!is_worked) {
-		seg_get(&watalt, (char *)&wa, r_nbr, c_nbr);
-		ele_nbr[ct_dir] = wa.ele;
+		ele_nbr[ct_dir] = cr.ele;
 		slope[ct_dir] = get_slope(ele_val, ele_nbr[ct_dir],
 			                  dist_to_nbr[ct_dir]);
 	    }
 	    /* avoid diagonal flow direction bias */
-	    if (!is_in_list || (!is_worked && af.asp < 0)) {
+	    if (!is_in_list || (!is_worked && cr.asp < 0)) {
 		if (ct_dir > 3 && slope[ct_dir] > 0) {
 		    if (slope[nbr_ew[ct_dir]] >= 0) {
 			/* slope to ew nbr > slope to center */
@@ -118,27 +116,27 @@ int do_astar(void)
 	    if (!skip_diag) {
 		if (!is_in_list) {
 		    ele_up = ele_nbr[ct_dir];
-		    af.asp = drain[r_nbr - r + 1][c_nbr - c + 1];
+		    cr.asp = drain[r_nbr - r + 1][c_nbr - c + 1];
 		    heap_add(r_nbr, c_nbr, ele_up);
-		    FLAG_SET(af.flag, INLISTFLAG);
-		    seg_put(&aspflag, (char *)&af, r_nbr, c_nbr);
+		    FLAG_SET(cr.flag, INLISTFLAG);
+		    seg_put(&cells, (char *)&cr, r_nbr, c_nbr);
 		}
 		else if (!is_worked) {
-		    if (FLAG_GET(af.flag, EDGEFLAG)) {
+		    if (FLAG_GET(cr.flag, EDGEFLAG)) {
 			/* neighbour is edge in list, not yet worked */
-			if (af.asp < 0 && slope[ct_dir] > 0) {
+			if (cr.asp < 0 && slope[ct_dir] > 0) {
 			    /* adjust flow direction for edge cell */
-			    af.asp = drain[r_nbr - r + 1][c_nbr - c + 1];
-			    seg_put(&aspflag, (char *)&af, r_nbr, c_nbr);
+			    cr.asp = drain[r_nbr - r + 1][c_nbr - c + 1];
+			    seg_put(&cells, (char *)&cr, r_nbr, c_nbr);
 			}
 		    }
-		    else if (FLAG_GET(af.flag, DEPRFLAG)) {
+		    else if (FLAG_GET(cr.flag, DEPRFLAG)) {
 			G_debug(3, "real depression");
 			/* neighbour is inside real depression, not yet worked */
-			if (af.asp == 0 && ele_val <= ele_nbr[ct_dir]) {
-			    af.asp = drain[r_nbr - r + 1][c_nbr - c + 1];
-			    FLAG_UNSET(af.flag, DEPRFLAG);
-			    seg_put(&aspflag, (char *)&af, r_nbr, c_nbr);
+			if (cr.asp == 0 && ele_val <= ele_nbr[ct_dir]) {
+			    cr.asp = drain[r_nbr - r + 1][c_nbr - c + 1];
+			    FLAG_UNSET(cr.flag, DEPRFLAG);
+			    seg_put(&cells, (char *)&cr, r_nbr, c_nbr);
 			}
 		    }
 		}
@@ -147,9 +145,9 @@ int do_astar(void)
 	/* add astar points to sorted list for flow accumulation and stream extraction */
 	first_cum--;
 	seg_put(&astar_pts, (char *)&heap_p.pnt, 0, first_cum);
-	seg_get(&aspflag, (char *)&af, r, c);
-	FLAG_SET(af.flag, WORKEDFLAG);
-	seg_put(&aspflag, (char *)&af, r, c);
+	seg_get(&cells, (char *)&cr, r, c);
+	FLAG_SET(cr.flag, WORKEDFLAG);
+	seg_put(&cells, (char *)&cr, r, c);
     }    /* end A* search */
 
     G_percent(n_points, n_points, 1);	/* finish it */
@@ -0,0 +1,107 @@
+#include <string.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+/* flow accumulation of earlier runs, see lib/raster/flowcache.c */
+
+/* everything which changes flow accumulation,
+ * 0 if the inputs are not cacheable */
+static int flow_method(const char *ele, double d8cut, char *method,
+		       char *name, char *mapset)
+{
+    const char *ele_mapset;
+
+    if (have_depressions)
+	return 0;
+
+    ele_mapset = G_find_raster2(ele, "");
+    if (!ele_mapset)
+	return 0;
+    if (G_name_is_fully_qualified(ele, name, mapset) != 1) {
+	strcpy(name, ele);
+	strcpy(mapset, ele_mapset);
+    }
+
+    sprintf(method, "r.stream.extract convergence=%d d8cut=%.17g",
+	    c_fac, d8cut);
+
+    return 1;
+}
+
+/*
+ * replaces the initial flow accumulation by the cached one
+ * returns 0 if there is no matching cache entry
+ */
+int read_flowcache(const char *ele, double d8cut)
+{
+    struct R_flowcache *fc;
+    char method[GNAME_MAX * 2];
+    char name[GNAME_MAX], mapset[GMAPSET_MAX];
+    DCELL *acc_buf;
+    CELL_REC *crbuf;
+    int r, c;
+
+    if (!flow_method(ele, d8cut, method, name, mapset))
+	return 0;
+    if (!(fc = Rast_flowcache_open_old(name, mapset, method)))
+	return 0;
+
+    G_message(_("Reading cached flow accumulation..."));
+
+    acc_buf = G_malloc(ncols * sizeof(DCELL));
+    crbuf = G_malloc(ncols * sizeof(CELL_REC));
+    for (r = 0; r < nrows; r++) {
+	G_percent(r, nrows, 2);
+	Rast_flowcache_get_row(fc, NULL, acc_buf, r);
+	seg_get_row(&cells, (char *)crbuf, r);
+	for (c = 0; c < ncols; c++)
+	    crbuf[c].wat = acc_buf[c];
+	seg_put_row(&cells, (char *)crbuf, r);
+    }
+    G_percent(1, 1, 1);
+    Rast_flowcache_close(fc);
+
+    G_free(acc_buf);
+    G_free(crbuf);
+
+    return 1;
+}
+
+/*
+ * stores flow accumulation and A* drainage directions for later runs
+ */
+int write_flowcache(const char *ele, double d8cut)
+{
+    struct R_flowcache *fc;
+    char method[GNAME_MAX * 2];
+    char name[GNAME_MAX], mapset[GMAPSET_MAX];
+    signed char *dir_buf;
+    DCELL *acc_buf;
+    CELL_REC *crbuf;
+    int r, c;
+
+    if (!flow_method(ele, d8cut, method, name, mapset))
+	return 0;
+    if (!(fc = Rast_flowcache_open_new(name, mapset, method)))
+	return 0;
+
+    dir_buf = G_malloc(ncols * sizeof(signed char));
+    acc_buf = G_malloc(ncols * sizeof(DCELL));
+    crbuf = G_malloc(ncols * sizeof(CELL_REC));
+    for (r = 0; r < nrows; r++) {
+	seg_get_row(&cells, (char *)crbuf, r);
+	for (c = 0; c < ncols; c++) {
+	    dir_buf[c] = crbuf[c].asp;
+	    acc_buf[c] = crbuf[c].wat;
+	}
+	Rast_flowcache_put_row(fc, dir_buf, acc_buf);
+    }
+    Rast_flowcache_close(fc);
+
+    G_free(dir_buf);
+    G_free(acc_buf);
+    G_free(crbuf);
+
+    return 1;
+}
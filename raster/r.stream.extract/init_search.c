@@ -9,8 +9,7 @@ int init_search(int depr_fd)
     int nextdr[8] = { 1, -1, 0, 0, -1, 1, 1, -1 };
     int nextdc[8] = { 0, 0, -1, 1, 1, -1, 1, -1 };
     char asp_value, is_null;
-    WAT_ALT wa;
-    ASP_FLAG af, af_nbr;
+    CELL_REC cr, cr_nbr;
     GW_LARGE_INT n_depr_cells = 0;
 
     nxt_avail_pt = heap_size = 0;
@@ -31,8 +30,8 @@ int init_search(int depr_fd)
 
 	for (c = 0; c < ncols; c++) {
 
-	    seg_get(&aspflag, (char *)&af, r, c);
-	    is_null = FLAG_GET(af.flag, NULLFLAG);
+	    seg_get(&cells, (char *)&cr, r, c);
+	    is_null = FLAG_GET(cr.flag, NULLFLAG);
 
 	    if (is_null)
 		continue;
@@ -57,13 +56,12 @@ int init_search(int depr_fd)
 		else if (c == ncols - 1)
 		    asp_value = -8;
 
-		seg_get(&watalt, (char *)&wa, r, c);
-		ele_value = wa.ele;
+		ele_value = cr.ele;
 		heap_add(r, c, ele_value);
-		FLAG_SET(af.flag, INLISTFLAG);
-		FLAG_SET(af.flag, EDGEFLAG);
-		af.asp = asp_value;
-		seg_put(&aspflag, (char *)&af, r, c);
+		FLAG_SET(cr.flag, INLISTFLAG);
+		FLAG_SET(cr.flag, EDGEFLAG);
+		cr.asp = asp_value;
+		seg_put(&cells, (char *)&cr, r, c);
 		continue;
 	    }
 
@@ -73,18 +71,17 @@ int init_search(int depr_fd)
 		r_nbr = r + nextdr[ct_dir];
 		c_nbr = c + nextdc[ct_dir];
 
-		seg_get(&aspflag, (char *)&af_nbr, r_nbr, c_nbr);
-		is_null = FLAG_GET(af_nbr.flag, NULLFLAG);
+		seg_get(&cells, (char *)&cr_nbr, r_nbr, c_nbr);
+		is_null = FLAG_GET(cr_nbr.flag, NULLFLAG);
 
 		if (is_null) {
 		    asp_value = -1 * drain[r - r_nbr + 1][c - c_nbr + 1];
-		    seg_get(&watalt, (char *)&wa, r, c);
-		    ele_value = wa.ele;
+		    ele_value = cr.ele;
 		    heap_add(r, c, ele_value);
-		    FLAG_SET(af.flag, INLISTFLAG);
-		    FLAG_SET(af.flag, EDGEFLAG);
-		    af.asp = asp_value;
-		    seg_put(&aspflag, (char *)&af, r, c);
+		    FLAG_SET(cr.flag, INLISTFLAG);
+		    FLAG_SET(cr.flag, EDGEFLAG);
+		    cr.asp = asp_value;
+		    seg_put(&cells, (char *)&cr, r, c);
 
 		    break;
 		}
@@ -95,13 +92,12 @@ int init_search(int depr_fd)
 	    /* real depression ? */
 	    if (depr_fd >= 0) {
 		if (!Rast_is_c_null_value(&depr_buf[c]) && depr_buf[c] != 0) {
-		    seg_get(&watalt, (char *)&wa, r, c);
-		    ele_value = wa.ele;
+		    ele_value = cr.ele;
 		    heap_add(r, c, ele_value);
-		    FLAG_SET(af.flag, INLISTFLAG);
-		    FLAG_SET(af.flag, DEPRFLAG);
-		    af.asp = asp_value;
-		    seg_put(&aspflag, (char *)&af, r, c);
+		    FLAG_SET(cr.flag, INLISTFLAG);
+		    FLAG_SET(cr.flag, DEPRFLAG);
+		    cr.asp = asp_value;
+		    seg_put(&cells, (char *)&cr, r, c);
 		    n_depr_cells++;
 		}
 	    }
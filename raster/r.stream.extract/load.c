@@ -21,13 +21,11 @@ int load_maps(int ele_fd, int acc_fd)
 {
     int r, c;
     void *ele_buf, *ptr, *acc_buf = NULL, *acc_ptr = NULL;
-    CELL ele_value, *stream_id;
+    CELL ele_value;
     DCELL dvalue, acc_value;
     size_t ele_size, acc_size = 0;
     int ele_map_type, acc_map_type = 0;
-    WAT_ALT *wabuf;
-
-    ASP_FLAG *afbuf;
+    CELL_REC *crbuf;
 
     if (acc_fd < 0)
 	G_message(_("Loading elevation raster map..."));
@@ -59,9 +57,7 @@ int load_maps(int ele_fd, int acc_fd)
     if (ele_map_type == FCELL_TYPE || ele_map_type == DCELL_TYPE)
 	ele_scale = 1000;	/* should be enough to do the trick */
 
-    wabuf = G_malloc(ncols * sizeof(WAT_ALT));
-    afbuf = G_malloc(ncols * sizeof(ASP_FLAG));
-    stream_id = G_malloc(ncols * sizeof(CELL));
+    crbuf = G_malloc(ncols * sizeof(CELL_REC));
 
     G_debug(1, "start loading %d rows, %d cols", nrows, ncols);
     for (r = 0; r < nrows; r++) {
@@ -78,16 +74,16 @@ int load_maps(int ele_fd, int acc_fd)
 
 	for (c = 0; c < ncols; c++) {
 
-	    afbuf[c].flag = 0;
-	    afbuf[c].asp = 0;
-	    stream_id[c] = 0;
+	    crbuf[c].flag = 0;
+	    crbuf[c].asp = 0;
+	    crbuf[c].stream = 0;
 
 	    /* check for masked and NULL cells */
 	    if (Rast_is_null_value(ptr, ele_map_type)) {
-		FLAG_SET(afbuf[c].flag, NULLFLAG);
-		FLAG_SET(afbuf[c].flag, INLISTFLAG);
-		FLAG_SET(afbuf[c].flag, WORKEDFLAG);
-		FLAG_SET(afbuf[c].flag, WORKED2FLAG);
+		FLAG_SET(crbuf[c].flag, NULLFLAG);
+		FLAG_SET(crbuf[c].flag, INLISTFLAG);
+		FLAG_SET(crbuf[c].flag, WORKEDFLAG);
+		FLAG_SET(crbuf[c].flag, WORKED2FLAG);
 		Rast_set_c_null_value(&ele_value, 1);
 		/* flow accumulation */
 		if (acc_fd >= 0) {
@@ -100,10 +96,10 @@ int load_maps(int ele_fd, int acc_fd)
 		/* elevation is not NULL, but provided accumulation is NULL
 		 * this is ok after weighing or 
 		 * when analysing a selected upstream catchment area */
-		FLAG_SET(afbuf[c].flag, NULLFLAG);
-		FLAG_SET(afbuf[c].flag, INLISTFLAG);
-		FLAG_SET(afbuf[c].flag, WORKEDFLAG);
-		FLAG_SET(afbuf[c].flag, WORKED2FLAG);
+		FLAG_SET(crbuf[c].flag, NULLFLAG);
+		FLAG_SET(crbuf[c].flag, INLISTFLAG);
+		FLAG_SET(crbuf[c].flag, WORKEDFLAG);
+		FLAG_SET(crbuf[c].flag, WORKED2FLAG);
 		Rast_set_c_null_value(&ele_value, 1);
 		Rast_set_d_null_value(&acc_value, 1);
 	    }
@@ -144,23 +140,19 @@ int load_maps(int ele_fd, int acc_fd)
 		n_points++;
 	    }
 
-	    wabuf[c].wat = acc_value;
-	    wabuf[c].ele = ele_value;
+	    crbuf[c].wat = acc_value;
+	    crbuf[c].ele = ele_value;
 	    ptr = G_incr_void_ptr(ptr, ele_size);
 	    if (acc_fd >= 0)
 		acc_ptr = G_incr_void_ptr(acc_ptr, acc_size);
 	}
-	seg_put_row(&watalt, (char *) wabuf, r);
-	seg_put_row(&aspflag, (char *) afbuf, r);
-	cseg_put_row(&stream, stream_id, r);
+	seg_put_row(&cells, (char *) crbuf, r);
     }
     G_percent(nrows, nrows, 1);	/* finish it */
 
     Rast_close(ele_fd);
     G_free(ele_buf);
-    G_free(wabuf);
-    G_free(afbuf);
-    G_free(stream_id);
+    G_free(crbuf);
 
     if (acc_fd >= 0) {
 	Rast_close(acc_fd);
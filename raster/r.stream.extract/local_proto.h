@@ -21,16 +21,14 @@ HEAP_PNT {
    POINT pnt;
 };
 
-#define WAT_ALT    struct wat_altitude
-WAT_ALT {
-   CELL ele;
-   DCELL wat;
-};
-
-#define ASP_FLAG    struct aspect_flag
-ASP_FLAG {
-   char asp;
-   char flag;
+/* all data of a cell in one segment file */
+#define CELL_REC    struct cell_record
+CELL_REC {
+   DCELL wat;       /* flow accumulation */
+   CELL ele;        /* elevation */
+   CELL stream;     /* stream id */
+   char asp;        /* drainage direction */
+   char flag;       /* see flag.h */
 };
 
 struct snode
@@ -57,12 +55,11 @@ extern char sides;
 extern int c_fac;
 extern int ele_scale;
 extern int have_depressions;
+extern int nprocs;
 
 extern SSEG search_heap;
 extern SSEG astar_pts;
-extern SSEG watalt, aspflag;
-/* extern BSEG bitflags, asp; */
-extern CSEG stream;
+extern SSEG cells;
 
 /* load.c */
 int load_maps(int, int);
@@ -74,10 +71,18 @@ int init_search(int);
 int do_astar(void);
 GW_LARGE_INT heap_add(int, int, CELL);
 
+/* flowcache.c */
+int read_flowcache(const char *, double);
+int write_flowcache(const char *, double);
+
 /* streams.c */
+double mfd_pow(double);
 int do_accum(double);
 int extract_streams(double, double, int);
 
+/* accum_par.c */
+int do_accum_par(double, const double *);
+
 /* thin.c */
 int thin_streams(void);
 
@@ -34,12 +34,11 @@ char sides;
 int c_fac;
 int ele_scale;
 int have_depressions;
+int nprocs;
 
 SSEG search_heap;
 SSEG astar_pts;
-SSEG watalt, aspflag;
-/* BSEG bitflags, asp; */
-CSEG stream;
+SSEG cells;
 
 CELL *astar_order;
 
@@ -52,6 +51,7 @@ int main(int argc, char *argv[])
 	struct Option *mont_exp;
 	struct Option *min_stream_length;
 	struct Option *memory;
+	struct Option *nprocs;
     } input;
     struct
     {
@@ -60,7 +60,7 @@ int main(int argc, char *argv[])
 	struct Option *dir_rast;
     } output;
     struct GModule *module;
-    int ele_fd, acc_fd, depr_fd;
+    int ele_fd, acc_fd, depr_fd, internal_acc;
     double threshold, d8cut, mont_exp;
     int min_stream_length = 0, memory;
     int seg_cols, seg_rows;
@@ -140,6 +140,8 @@ int main(int argc, char *argv[])
     input.memory->label = _("Maximum memory to be used (in MB)");
     input.memory->description = _("Cache size for raster rows");
 
+    input.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     output.stream_rast = G_define_standard_option(G_OPT_R_OUTPUT);
     output.stream_rast->key = "stream_raster";
     output.stream_rast->description =
@@ -164,6 +166,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    nprocs = G_set_nprocs(input.nprocs);
+
     /***********************/
     /*    check options   */
     /***********************/
@@ -273,16 +277,9 @@ int main(int argc, char *argv[])
     seg2kb = seg_rows * seg_cols / 1024.;
 
     /* balance segment files */
-    /* elevation + accumulation: * 2 */
-    memory_divisor = sizeof(WAT_ALT) * 2;
-    disk_space = sizeof(WAT_ALT);
-    /* stream ids: / 2 */
-    memory_divisor += sizeof(int) / 2.;
-    disk_space += sizeof(int);
-
-    /* aspect and flags: * 2 */
-    memory_divisor += sizeof(ASP_FLAG) * 4;
-    disk_space += sizeof(ASP_FLAG);
+    /* accumulation, elevation, stream ids, aspect and flags: * 2 */
+    memory_divisor = sizeof(CELL_REC) * 2;
+    disk_space = sizeof(CELL_REC);
 
     /* astar_points: / 16 */
     /* ideally only a few but large segments */
@@ -322,22 +319,12 @@ int main(int argc, char *argv[])
 
     /* open segment files */
     G_verbose_message(_("Creating temporary files..."));
-    seg_open(&watalt, nrows, ncols, seg_rows, seg_cols, num_open_segs * 2,
-        sizeof(WAT_ALT), 1);
+    if (seg_open(&cells, nrows, ncols, seg_rows, seg_cols, num_open_segs * 2,
+		 sizeof(CELL_REC), 1) < 0)
+	G_fatal_error(_("Unable to create temporary file"));
     if (num_open_segs * 2 > num_seg_total)
 	heap_mem += (num_open_segs * 2 - num_seg_total) * seg2kb *
-	            sizeof(WAT_ALT) / 1024.;
-    cseg_open(&stream, seg_rows, seg_cols, num_open_segs / 2.);
-
-    seg_open(&aspflag, nrows, ncols, seg_rows, seg_cols, num_open_segs * 2,
-        sizeof(ASP_FLAG), 1);
-/*
-    bseg_open(&asp, seg_rows, seg_cols, num_open_segs);
-    bseg_open(&bitflags, seg_rows, seg_cols, num_open_segs * 4);
-*/
-
-    if (num_open_segs * 4 > num_seg_total)
-	heap_mem += (num_open_segs * 4 - num_seg_total) * seg2kb / 1024.;
+	            sizeof(CELL_REC) / 1024.;
 
     /* load maps */
     if (load_maps(ele_fd, acc_fd) < 0)
@@ -401,18 +388,20 @@ int main(int argc, char *argv[])
 	G_fatal_error(_("Unable to sort elevation raster map values"));
     seg_close(&search_heap);
 
-    if (acc_fd < 0) {
+    internal_acc = 0;
+    if (acc_fd < 0 && !read_flowcache(input.ele->answer, d8cut)) {
 	/* accumulate surface flow */
 	if (do_accum(d8cut) < 0)
 	    G_fatal_error(_("Unable to calculate flow accumulation"));
+	write_flowcache(input.ele->answer, d8cut);
+	internal_acc = 1;
     }
 
     /* extract streams */
-    if (extract_streams(threshold, mont_exp, acc_fd < 0) < 0)
+    if (extract_streams(threshold, mont_exp, internal_acc) < 0)
 	G_fatal_error(_("Unable to extract streams"));
 
     seg_close(&astar_pts);
-    seg_close(&watalt);
 
     /* thin streams */
     if (thin_streams() < 0)
@@ -429,8 +418,7 @@ int main(int argc, char *argv[])
 		   output.dir_rast->answer) < 0)
 	G_fatal_error(_("Unable to write output raster maps"));
 
-    cseg_close(&stream);
-    seg_close(&aspflag);
+    seg_close(&cells);
 
     exit(EXIT_SUCCESS);
 }
@@ -23,20 +23,19 @@ static int continue_stream(CELL stream_id, int r_max, int c_max,
     int asp_r[9] = { 0, -1, -1, -1, 0, 1, 1, 1, 0 };
     int asp_c[9] = { 0, 1, 0, -1, -1, -1, 0, 1, 1 };
     int stream_node_step = 1000;
-    ASP_FLAG af;
+    CELL_REC cr;
 
     G_debug(3, "continue stream");
     
-    cseg_get(&stream, &curr_stream, r_max, c_max);
+    seg_get(&cells, (char *)&cr, r_max, c_max);
+    curr_stream = cr.stream;
 
     if (curr_stream <= 0) {
 	/* no confluence, just continue */
 	G_debug(3, "no confluence, just continue stream");
-	curr_stream = stream_id;
-	cseg_put(&stream, &curr_stream, r_max, c_max);
-	seg_get(&aspflag, (char *)&af, r_max, c_max);
-	FLAG_SET(af.flag, STREAMFLAG);
-	seg_put(&aspflag, (char *)&af, r_max, c_max);
+	cr.stream = stream_id;
+	FLAG_SET(cr.flag, STREAMFLAG);
+	seg_put(&cells, (char *)&cr, r_max, c_max);
 	return 0;
     }
 
@@ -90,18 +89,19 @@ static int continue_stream(CELL stream_id, int r_max, int c_max,
 	c_nbr = c_max;
 	old_stream = curr_stream;
 	curr_stream = *stream_no;
-	cseg_put(&stream, &curr_stream, r_nbr, c_nbr);
-	seg_get(&aspflag, (char *)&af, r_nbr, c_nbr);
-
-	while (af.asp > 0) {
-	    r_nbr = r_nbr + asp_r[(int)af.asp];
-	    c_nbr = c_nbr + asp_c[(int)af.asp];
-	    cseg_get(&stream, &stream_nbr, r_nbr, c_nbr);
+	cr.stream = curr_stream;
+	seg_put(&cells, (char *)&cr, r_nbr, c_nbr);
+
+	while (cr.asp > 0) {
+	    r_nbr = r_nbr + asp_r[(int)cr.asp];
+	    c_nbr = c_nbr + asp_c[(int)cr.asp];
+	    seg_get(&cells, (char *)&cr, r_nbr, c_nbr);
+	    stream_nbr = cr.stream;
 	    if (stream_nbr != old_stream)
-		af.asp = -1;
+		cr.asp = -1;
 	    else {
-		cseg_put(&stream, &curr_stream, r_nbr, c_nbr);
-		seg_get(&aspflag, (char *)&af, r_nbr, c_nbr);
+		cr.stream = curr_stream;
+		seg_put(&cells, (char *)&cr, r_nbr, c_nbr);
 	    }
 	}
     }
@@ -137,8 +137,8 @@ static int continue_stream(CELL stream_id, int r_max, int c_max,
 int do_accum(double d8cut)
 {
     int r, c, dr, dc;
-    CELL ele_val, *ele_nbr;
-    DCELL value, *wat_nbr;
+    CELL ele_val;
+    DCELL value;
     struct Cell_head window;
     int mfd_cells, astar_not_set;
     double *dist_to_nbr, *weight, sum_weight, max_weight;
@@ -152,19 +152,15 @@ int do_accum(double d8cut)
     int nextdr[8] = { 1, -1, 0, 0, -1, 1, 1, -1 };
     int nextdc[8] = { 0, 0, -1, 1, 1, -1, 1, -1 };
     GW_LARGE_INT workedon, killer;
-    char *flag_nbr;
     POINT astarpoint;
-    WAT_ALT wa;
-    ASP_FLAG af, af_nbr;
+    CELL_REC cr, *cr_nbr;
 
     G_message(_("Calculating flow accumulation..."));
 
     /* distances to neighbours */
     dist_to_nbr = (double *)G_malloc(sides * sizeof(double));
     weight = (double *)G_malloc(sides * sizeof(double));
-    flag_nbr = (char *)G_malloc(sides * sizeof(char));
-    wat_nbr = (DCELL *)G_malloc(sides * sizeof(DCELL));
-    ele_nbr = (CELL *)G_malloc(sides * sizeof(CELL));
+    cr_nbr = (CELL_REC *)G_malloc(sides * sizeof(CELL_REC));
 
     G_get_set_window(&window);
 
@@ -181,6 +177,16 @@ int do_accum(double d8cut)
 	    dist_to_nbr[ct_dir] = sqrt(dx * dx + dy * dy);
     }
 
+    if (nprocs > 1) {
+	do_accum_par(d8cut, dist_to_nbr);
+
+	G_free(dist_to_nbr);
+	G_free(weight);
+	G_free(cr_nbr);
+
+	return 1;
+    }
+
     /* distribute and accumulate */
     for (killer = 0; killer < n_points; killer++) {
 
@@ -190,27 +196,21 @@ int do_accum(double d8cut)
 	r = astarpoint.r;
 	c = astarpoint.c;
 
-	seg_get(&aspflag, (char *)&af, r, c);
+	seg_get(&cells, (char *)&cr, r, c);
+
+	/* WORKEDFLAG has been set during A* Search
+	 * reversed meaning here: 0 = done, 1 = not yet done */
+	FLAG_UNSET(cr.flag, WORKEDFLAG);
+	seg_put(&cells, (char *)&cr, r, c);
 
 	/* do not distribute flow along edges or out of real depressions */
-	if (af.asp <= 0) {
-	    FLAG_UNSET(af.flag, WORKEDFLAG);
-	    seg_put(&aspflag, (char *)&af, r, c);
+	if (cr.asp <= 0)
 	    continue;
-	}
-
-	if (af.asp) {
-	    dr = r + asp_r[abs((int)af.asp)];
-	    dc = c + asp_c[abs((int)af.asp)];
-	}
 
-	seg_get(&watalt, (char *)&wa, r, c);
-	value = wa.wat;
+	dr = r + asp_r[abs((int)cr.asp)];
+	dc = c + asp_c[abs((int)cr.asp)];
 
-	/* WORKEDFLAG has been set during A* Search
-	 * reversed meaning here: 0 = done, 1 = not yet done */
-	FLAG_UNSET(af.flag, WORKEDFLAG);
-	seg_put(&aspflag, (char *)&af, r, c);
+	value = cr.wat;
 
 	/***************************************/
 	/*  get weights for flow distribution  */
@@ -221,7 +221,7 @@ int do_accum(double d8cut)
 	np_side = -1;
 	mfd_cells = 0;
 	astar_not_set = 1;
-	ele_val = wa.ele;
+	ele_val = cr.ele;
 	edge = 0;
 	/* this loop is needed to get the sum of weights */
 	for (ct_dir = 0; ct_dir < sides; ct_dir++) {
@@ -229,31 +229,25 @@ int do_accum(double d8cut)
 	    r_nbr = r + nextdr[ct_dir];
 	    c_nbr = c + nextdc[ct_dir];
 	    weight[ct_dir] = -1;
-	    wat_nbr[ct_dir] = 0;
-	    ele_nbr[ct_dir] = 0;
 
 	    /* check that neighbour is within region */
 	    if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 && c_nbr < ncols) {
 
-		seg_get(&aspflag, (char *)&af_nbr, r_nbr, c_nbr);
-		flag_nbr[ct_dir] = af_nbr.flag;
-		if ((edge = FLAG_GET(flag_nbr[ct_dir], NULLFLAG)))
+		seg_get(&cells, (char *)&cr_nbr[ct_dir], r_nbr, c_nbr);
+		if ((edge = FLAG_GET(cr_nbr[ct_dir].flag, NULLFLAG)))
 		    break;
-		seg_get(&watalt, (char *)&wa, r_nbr, c_nbr);
-		wat_nbr[ct_dir] = wa.wat;
-		ele_nbr[ct_dir] = wa.ele;
 
 		/* WORKEDFLAG has been set during A* Search
 		 * reversed meaning here: 0 = done, 1 = not yet done */
-		is_worked = FLAG_GET(flag_nbr[ct_dir], WORKEDFLAG) == 0;
+		is_worked = FLAG_GET(cr_nbr[ct_dir].flag, WORKEDFLAG) == 0;
 		if (is_worked == 0) {
-		    if (ele_nbr[ct_dir] <= ele_val) {
-			if (ele_nbr[ct_dir] < ele_val) {
+		    if (cr_nbr[ct_dir].ele <= ele_val) {
+			if (cr_nbr[ct_dir].ele < ele_val) {
 			    weight[ct_dir] =
 				mfd_pow((ele_val -
-					 ele_nbr[ct_dir]) / dist_to_nbr[ct_dir]);
+					 cr_nbr[ct_dir].ele) / dist_to_nbr[ct_dir]);
 			}
-			if (ele_nbr[ct_dir] == ele_val) {
+			if (cr_nbr[ct_dir].ele == ele_val) {
 			    weight[ct_dir] =
 				mfd_pow(0.5 / dist_to_nbr[ct_dir]);
 			}
@@ -315,16 +309,15 @@ int do_accum(double d8cut)
 		/* check that neighbour is within region */
 		if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 &&
 		    c_nbr < ncols && weight[ct_dir] > -0.5) {
-		    is_worked = FLAG_GET(flag_nbr[ct_dir], WORKEDFLAG) == 0;
+		    is_worked = FLAG_GET(cr_nbr[ct_dir].flag, WORKEDFLAG) == 0;
 		    if (is_worked == 0) {
 
 			weight[ct_dir] = weight[ct_dir] / sum_weight;
 			/* check everything sums up to 1.0 */
 			prop += weight[ct_dir];
 
-			wa.wat = wat_nbr[ct_dir] + value * weight[ct_dir];
-			wa.ele = ele_nbr[ct_dir];
-			seg_put(&watalt, (char *)&wa, r_nbr, c_nbr);
+			cr_nbr[ct_dir].wat += value * weight[ct_dir];
+			seg_put(&cells, (char *)&cr_nbr[ct_dir], r_nbr, c_nbr);
 		    }
 		    else if (ct_dir == np_side) {
 			/* check for consistency with A * path */
@@ -339,18 +332,15 @@ int do_accum(double d8cut)
 	}
 	/* get out of depression in SFD mode */
 	else {
-	    wa.wat = wat_nbr[np_side] + value;
-	    wa.ele = ele_nbr[np_side];
-	    seg_put(&watalt, (char *)&wa, dr, dc);
+	    cr_nbr[np_side].wat += value;
+	    seg_put(&cells, (char *)&cr_nbr[np_side], dr, dc);
 	}
     }
     G_percent(1, 1, 2);
 
     G_free(dist_to_nbr);
     G_free(weight);
-    G_free(wat_nbr);
-    G_free(ele_nbr);
-    G_free(flag_nbr);
+    G_free(cr_nbr);
 
     return 1;
 }
@@ -386,8 +376,7 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
     double slope, diag;
     char *flag_nbr;
     POINT astarpoint;
-    WAT_ALT wa;
-    ASP_FLAG af, af_nbr;
+    CELL_REC cr, cr_nbr;
 
     G_message(_("Extracting streams..."));
 
@@ -436,18 +425,18 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 	r = astarpoint.r;
 	c = astarpoint.c;
 
-	seg_get(&aspflag, (char *)&af, r, c);
+	seg_get(&cells, (char *)&cr, r, c);
 	/* internal acc: SET, external acc: UNSET */
 	if (internal_acc)
-	    FLAG_SET(af.flag, WORKEDFLAG);
+	    FLAG_SET(cr.flag, WORKEDFLAG);
 	else
-	    FLAG_UNSET(af.flag, WORKEDFLAG);
-	seg_put(&aspflag, (char *)&af, r, c);
+	    FLAG_UNSET(cr.flag, WORKEDFLAG);
+	seg_put(&cells, (char *)&cr, r, c);
 
 	/* do not distribute flow along edges */
-	if (af.asp <= 0) {
+	if (cr.asp <= 0) {
 	    G_debug(3, "edge");
-	    is_swale = FLAG_GET(af.flag, STREAMFLAG);
+	    is_swale = FLAG_GET(cr.flag, STREAMFLAG);
 	    if (is_swale) {
 		G_debug(2, "edge outlet");
 		/* add outlet point */
@@ -463,7 +452,7 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 		n_outlets++;
 	    }
 
-	    if (af.asp == 0) {
+	    if (cr.asp == 0) {
 		/* can only happen with real depressions */
 		if (!have_depressions)
 		    G_fatal_error(_("Bug in stream extraction"));
@@ -472,9 +461,9 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 	    continue;
 	}
 
-	if (af.asp) {
-	    dr = r + asp_r[abs((int)af.asp)];
-	    dc = c + asp_c[abs((int)af.asp)];
+	if (cr.asp) {
+	    dr = r + asp_r[abs((int)cr.asp)];
+	    dc = c + asp_c[abs((int)cr.asp)];
 	}
 	else {
 	    /* can only happen with real depressions,
@@ -486,8 +475,7 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 	r_nbr = r_max = dr;
 	c_nbr = c_max = dc;
 
-	seg_get(&watalt, (char *)&wa, r, c);
-	value = wa.wat;
+	value = cr.wat;
 
 	/**********************************/
 	/*  find main drainage direction  */
@@ -498,7 +486,7 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 	mfd_cells = 0;
 	stream_cells = 0;
 	swale_cells = 0;
-	ele_val = wa.ele;
+	ele_val = cr.ele;
 	edge = 0;
 	flat = 1;
 	/* find main drainage direction */
@@ -516,13 +504,12 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 		if (dr == r_nbr && dc == c_nbr)
 		    np_side = ct_dir;
 
-		seg_get(&aspflag, (char *)&af_nbr, r_nbr, c_nbr);
-		flag_nbr[ct_dir] = af_nbr.flag;
+		seg_get(&cells, (char *)&cr_nbr, r_nbr, c_nbr);
+		flag_nbr[ct_dir] = cr_nbr.flag;
 		if ((edge = FLAG_GET(flag_nbr[ct_dir], NULLFLAG)))
 		    break;
-		seg_get(&watalt, (char *)&wa, r_nbr, c_nbr);
-		wat_nbr[ct_dir] = wa.wat;
-		ele_nbr[ct_dir] = wa.ele;
+		wat_nbr[ct_dir] = cr_nbr.wat;
+		ele_nbr[ct_dir] = cr_nbr.ele;
 
 		/* check for swale cells */
 		is_swale = FLAG_GET(flag_nbr[ct_dir], STREAMFLAG);
@@ -567,7 +554,7 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 		break;
 	}
 
-	is_swale = FLAG_GET(af.flag, STREAMFLAG);
+	is_swale = FLAG_GET(cr.flag, STREAMFLAG);
 
 	/* do not continue streams along edges, these are artifacts */
 	if (edge) {
@@ -585,9 +572,9 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 		outlets[n_outlets].r = r;
 		outlets[n_outlets].c = c;
 		n_outlets++;
-		if (af.asp > 0) {
-		    af.asp = -1 * drain[r - r_nbr + 1][c - c_nbr + 1];
-		    seg_put(&aspflag, (char *)&af, r, c);
+		if (cr.asp > 0) {
+		    cr.asp = -1 * drain[r - r_nbr + 1][c - c_nbr + 1];
+		    seg_put(&cells, (char *)&cr, r, c);
 		}
 	    }
 	    continue;
@@ -615,8 +602,8 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 	/* update aspect */
 	/* r_max == r && c_max == c should not happen */
 	if ((r_max != dr || c_max != dc) && (r_max != r || c_max != c)) {
-	    af.asp = drain[r - r_max + 1][c - c_max + 1];
-	    seg_put(&aspflag, (char *)&af, r, c);
+	    cr.asp = drain[r - r_max + 1][c - c_max + 1];
+	    seg_put(&cells, (char *)&cr, r, c);
 	}
 
 	/**********************/
@@ -643,9 +630,9 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 	    swale_cells < 1 && !flat) {
 	    G_debug(2, "start new stream");
 	    is_swale = ++stream_no;
-	    cseg_put(&stream, &is_swale, r, c);
-	    FLAG_SET(af.flag, STREAMFLAG);
-	    seg_put(&aspflag, (char *)&af, r, c);
+	    cr.stream = is_swale;
+	    FLAG_SET(cr.flag, STREAMFLAG);
+	    seg_put(&cells, (char *)&cr, r, c);
 	    /* add stream node */
 	    if (stream_no >= n_alloc_nodes - 1) {
 		n_alloc_nodes += stream_node_step;
@@ -674,7 +661,7 @@ int extract_streams(double threshold, double mont_exp, int internal_acc)
 	/*********************/
 
 	if (is_swale > 0) {
-	    cseg_get(&stream, &is_swale, r, c);
+	    is_swale = cr.stream;
 	    if (r_max == r && c_max == c) {
 		/* can't continue stream, add outlet point
 		 * r_max == r && c_max == c should not happen */
@@ -7,48 +7,47 @@ int thin_seg(int stream_id)
 {
     int thinned = 0;
     int r, c, r_nbr, c_nbr, last_r, last_c;
-    CELL curr_stream, no_stream = 0;
+    CELL curr_stream;
     int asp_r[9] = { 0, -1, -1, -1, 0, 1, 1, 1, 0 };
     int asp_c[9] = { 0, 1, 0, -1, -1, -1, 0, 1, 1 };
-    ASP_FLAG af;
+    CELL_REC cr, cr_nbr;
 
     r = stream_node[stream_id].r;
     c = stream_node[stream_id].c;
 
-    cseg_get(&stream, &curr_stream, r, c);
-
-    seg_get(&aspflag, (char *)&af, r, c);
-    if (af.asp > 0) {
+    seg_get(&cells, (char *)&cr, r, c);
+    if (cr.asp > 0) {
 	/* get downstream point */
-	last_r = r + asp_r[(int)af.asp];
-	last_c = c + asp_c[(int)af.asp];
-	cseg_get(&stream, &curr_stream, last_r, last_c);
+	last_r = r + asp_r[(int)cr.asp];
+	last_c = c + asp_c[(int)cr.asp];
+	seg_get(&cells, (char *)&cr, last_r, last_c);
+	curr_stream = cr.stream;
 
 	if (curr_stream != stream_id)
 	    return thinned;
 
 	/* get next downstream point */
-	seg_get(&aspflag, (char *)&af, last_r, last_c);
-	while (af.asp > 0) {
-	    r_nbr = last_r + asp_r[(int)af.asp];
-	    c_nbr = last_c + asp_c[(int)af.asp];
+	while (cr.asp > 0) {
+	    r_nbr = last_r + asp_r[(int)cr.asp];
+	    c_nbr = last_c + asp_c[(int)cr.asp];
 
 	    if (r_nbr == last_r && c_nbr == last_c)
 		return thinned;
 	    if (r_nbr < 0 || r_nbr >= nrows || c_nbr < 0 || c_nbr >= ncols)
 		return thinned;
-	    cseg_get(&stream, &curr_stream, r_nbr, c_nbr);
+	    seg_get(&cells, (char *)&cr_nbr, r_nbr, c_nbr);
+	    curr_stream = cr_nbr.stream;
 	    if (curr_stream != stream_id)
 		return thinned;
 	    if (abs(r_nbr - r) < 2 && abs(c_nbr - c) < 2) {
 		/* eliminate last point */
-		cseg_put(&stream, &no_stream, last_r, last_c);
-		FLAG_UNSET(af.flag, STREAMFLAG);
-		seg_put(&aspflag, (char *)&af, last_r, last_c);
+		cr.stream = 0;
+		FLAG_UNSET(cr.flag, STREAMFLAG);
+		seg_put(&cells, (char *)&cr, last_r, last_c);
 		/* update start point */
-		seg_get(&aspflag, (char *)&af, r, c);
-		af.asp = drain[r - r_nbr + 1][c - c_nbr + 1];
-		seg_put(&aspflag, (char *)&af, r, c);
+		seg_get(&cells, (char *)&cr, r, c);
+		cr.asp = drain[r - r_nbr + 1][c - c_nbr + 1];
+		seg_put(&cells, (char *)&cr, r, c);
 
 		thinned = 1;
 	    }
@@ -59,7 +58,7 @@ int thin_seg(int stream_id)
 	    }
 	    last_r = r_nbr;
 	    last_c = c_nbr;
-	    seg_get(&aspflag, (char *)&af, last_r, last_c);
+	    seg_get(&cells, (char *)&cr, last_r, last_c);
 	}
     }
 
@@ -79,6 +78,7 @@ int thin_streams(void)
     int top = 0, stack_step = 1000;
     int n_trib_total;
     int n_thinned = 0;
+    CELL_REC cr;
 
     G_message(_("Thinning stream segments..."));
 
@@ -88,7 +88,8 @@ int thin_streams(void)
 	G_percent(i, n_outlets, 2);
 	r = outlets[i].r;
 	c = outlets[i].c;
-	cseg_get(&stream, &stream_id, r, c);
+	seg_get(&cells, (char *)&cr, r, c);
+	stream_id = cr.stream;
 
 	if (stream_id == 0)
 	    continue;
@@ -0,0 +1,388 @@
+/****************************************************************************
+ *
+ * MODULE:       r.sun
+ * AUTHOR(S):    GRASS Development Team
+ *
+ * PURPOSE:      horizon angles of all cells in memory, computed with the
+ *               algorithm of r.horizon
+ *
+ * COPYRIGHT:    (C) 2020 by the GRASS Development Team
+ *
+ *               This program is free software under the GNU General Public
+ *               License (>=v2). Read the file COPYING that comes with GRASS
+ *               for details.
+ *
+ *****************************************************************************/
+
+#include <math.h>
+
+#include <grass/gis.h>
+#include <grass/gmath.h>
+#include <grass/gprojects.h>
+#include <grass/glocale.h>
+#include "sunradstruct.h"
+#include "local_proto.h"
+#include "rsunglobals.h"
+
+#define BIG      1.e20
+#define SMALL    1.e-20
+#define DEGREEINMETERS 111120.	/* 1852m/nm * 60nm/degree = 111120 m/deg */
+#define TANMINANGLE 0.008727	/* tan of minimum horizon angle (0.5 deg) */
+
+#define AMAX1(arg1, arg2) ((arg1) >= (arg2) ? (arg1) : (arg2))
+#define AMIN1(arg1, arg2) ((arg1) <= (arg2) ? (arg1) : (arg2))
+
+extern struct pj_info tproj;
+
+static const double invEarth = 1. / EARTHRADIUS;
+
+/* the elevation model */
+struct horizon_grid
+{
+    float **z;			/* elevation, first row is south */
+    float **z100;		/* maximum elevation of 100 x 100 cells */
+    int rows, cols;
+    double stepx, stepy, invstepx, invstepy;
+    double stepxy, distxy;
+    double zmax;
+    int ll;
+};
+
+/* the search along one direction from one cell */
+struct horizon_ray
+{
+    double xg0, yg0, xx0, yy0;
+    double sinangle, cosangle, stepsinangle, stepcosangle;
+    double distsinangle, distcosangle;
+    double length, maxlength, tanh0;
+    double z_orig, zp;
+    double coslatsq;
+    int ip, jp, ip100, jp100;
+};
+
+static double distance(const struct horizon_grid *g,
+		       const struct horizon_ray *r,
+		       double x1, double x2, double y1, double y2)
+{
+    if (g->ll) {
+	return DEGREEINMETERS * sqrt(r->coslatsq * (x1 - x2) * (x1 - x2)
+				     + (y1 - y2) * (y1 - y2));
+    }
+    else {
+	return sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2));
+    }
+}
+
+static int test_low_res(const struct horizon_grid *g, struct horizon_ray *r)
+{
+    int iold100, jold100;
+    double sx, sy;
+    int delx, dely, mindel;
+    double zp100, z2, curvature_diff;
+
+    iold100 = r->ip100;
+    jold100 = r->jp100;
+    r->ip100 = floor(r->ip / 100.);
+    r->jp100 = floor(r->jp / 100.);
+    /*test the new position with low resolution */
+    if ((r->ip100 != iold100) || (r->jp100 != jold100)) {
+	curvature_diff = 0.5 * r->length * r->length * invEarth;
+	z2 = r->z_orig + curvature_diff + r->length * r->tanh0;
+	zp100 = g->z100[r->jp100][r->ip100];
+
+	if (zp100 <= z2)
+	    /*skip to the next lowres cell */
+	{
+	    delx = 32000;
+	    dely = 32000;
+	    if (r->cosangle > 0.) {
+		sx = r->xx0 * g->invstepx + 0.5;
+		delx =
+		    floor(fabs
+			  ((ceil(sx / 100.) - (sx / 100.)) * r->distcosangle));
+	    }
+	    if (r->cosangle < 0.) {
+		sx = r->xx0 * g->invstepx + 0.5;
+		delx =
+		    floor(fabs
+			  ((floor(sx / 100.) - (sx / 100.)) * r->distcosangle));
+	    }
+	    if (r->sinangle > 0.) {
+		sy = r->yy0 * g->invstepy + 0.5;
+		dely =
+		    floor(fabs
+			  ((ceil(sy / 100.) - (sy / 100.)) * r->distsinangle));
+	    }
+	    else if (r->sinangle < 0.) {
+		sy = r->yy0 * g->invstepy + 0.5;
+		dely =
+		    floor(fabs
+			  ((floor(r->jp / 100.) - (sy / 100.)) *
+			   r->distsinangle));
+	    }
+
+	    mindel = delx < dely ? delx : dely;
+
+	    r->yy0 = r->yy0 + (mindel * r->stepsinangle);
+	    r->xx0 = r->xx0 + (mindel * r->stepcosangle);
+
+	    return (3);
+	}
+	else {
+	    return (1);	/* change of low res array - new cell is reaching limit for high resolution processing */
+	}
+    }
+    else {
+	return (1);	/* no change of low res array */
+    }
+}
+
+static int new_point(const struct horizon_grid *g, struct horizon_ray *r)
+{
+    int iold, jold;
+    double sx, sy;
+    double dx, dy;
+
+    iold = r->ip;
+    jold = r->jp;
+
+    while (1) {
+	r->yy0 += r->stepsinangle;
+	r->xx0 += r->stepcosangle;
+
+	/* offset 0.5 cell size to get the right cell i, j */
+	sx = r->xx0 * g->invstepx + 0.5;
+	sy = r->yy0 * g->invstepy + 0.5;
+	r->ip = (int)sx;
+	r->jp = (int)sy;
+
+	/* test outside of raster */
+	if ((r->ip < 0) || (r->ip >= g->cols) || (r->jp < 0) ||
+	    (r->jp >= g->rows))
+	    return (3);
+
+	if ((r->ip != iold) || (r->jp != jold)) {
+	    dx = (double)r->ip * g->stepx;
+	    dy = (double)r->jp * g->stepy;
+
+	    /* dist from orig. grid point to the current grid point */
+	    r->length = distance(g, r, r->xg0, dx, r->yg0, dy);
+	    if (test_low_res(g, r) == 1) {
+		r->zp = g->z[r->jp][r->ip];
+		return (1);
+	    }
+	}
+    }
+}
+
+/* the horizon angle in radians, see searching() of r.horizon */
+static double horizon_height(const struct horizon_grid *g,
+			     struct horizon_ray *r)
+{
+    double z2;
+    double curvature_diff;
+
+    r->tanh0 = -1.0 / 0.0;	/* -inf */
+    r->length = 0;
+
+    if (r->zp == UNDEFZ)
+	return 0;
+
+    while (new_point(g, r) == 1) {
+	/* curvature_diff = EARTHRADIUS*(1.-cos(length/EARTHRADIUS)); */
+	curvature_diff = 0.5 * r->length * r->length * invEarth;
+
+	z2 = r->z_orig + curvature_diff + r->length * r->tanh0;
+
+	if (z2 < r->zp) {
+	    r->tanh0 = (r->zp - r->z_orig - curvature_diff) / r->length;
+	}
+
+	if (z2 >= g->zmax) {
+	    break;
+	}
+
+	if (r->length >= r->maxlength) {
+	    break;
+	}
+    }
+
+    return atan(r->tanh0);
+}
+
+/*!
+ * \brief Compute the horizon angles of all cells
+ *
+ * The angles are computed like r.horizon does for the directions 0,
+ * <i>step</i>, 2 <i>step</i>, ... degrees counterclockwise from east
+ * and stored like the horizon rasters read by INPUT_part(), with
+ * <i>ndir</i> values per cell.
+ *
+ * \param table horizon angles in units of 1 / SCALING_FACTOR radians
+ * \param z elevation, first row is south
+ * \param rows number of rows
+ * \param cols number of columns
+ * \param ndir number of directions
+ * \param step angle between directions in degrees
+ * \param zmax maximum elevation
+ * \param xmin west edge of the region
+ * \param ymin south edge of the region
+ * \param dist sampling distance step coefficient
+ * \param gridGeom grid geometry
+ */
+void horizon_table(unsigned char *table, float **z, int rows, int cols,
+		   int ndir, double step, double zmax, double xmin,
+		   double ymin, double dist, struct GridGeometry *gridGeom)
+{
+    struct horizon_grid g;
+    int rows100, cols100;
+    int i, j, k, l, kk, lmax, kmax;
+    double bmax;
+    int done = 0;
+
+    g.z = z;
+    g.rows = rows;
+    g.cols = cols;
+    g.stepx = gridGeom->stepx;
+    g.stepy = gridGeom->stepy;
+    g.invstepx = 1. / g.stepx;
+    g.invstepy = 1. / g.stepy;
+    g.stepxy = gridGeom->stepxy;
+    g.distxy = dist;
+    g.zmax = zmax;
+    g.ll = G_projection() == PROJECTION_LL;
+
+    /* create low resolution array 100 */
+    rows100 = ceil(rows / 100.);
+    cols100 = ceil(cols / 100.);
+    g.z100 = G_alloc_fmatrix(rows100, cols100);
+    for (i = 0; i < rows100; i++) {
+	lmax = (i + 1) * 100;
+	if (lmax > rows)
+	    lmax = rows;
+
+	for (j = 0; j < cols100; j++) {
+	    bmax = SMALL;
+	    kmax = (j + 1) * 100;
+	    if (kmax > cols)
+		kmax = cols;
+	    for (l = (i * 100); l < lmax; l++) {
+		for (kk = (j * 100); kk < kmax; kk++) {
+		    bmax = AMAX1(bmax, z[l][kk]);
+		}
+	    }
+	    g.z100[i][j] = bmax;
+	}
+    }
+
+    G_message(_("Calculating horizons in %d directions"), ndir);
+
+#pragma omp parallel for schedule(dynamic) private(i, k)
+    for (j = 0; j < rows; j++) {
+	struct horizon_ray r;
+	double xp, yp, latitude, longitude, lat0, lon0;
+	double inputAngle, delt_lat, delt_lon, delt_east, delt_nor, delt_dist;
+	double coslat;
+	float h;
+	unsigned char *cell;
+
+#pragma omp critical (horizon_percent)
+	G_percent(done++, rows, 2);
+
+	for (i = 0; i < cols; i++) {
+	    cell = table + ((size_t)j * cols + i) * ndir;
+
+	    r.xg0 = (double)i * g.stepx;
+	    r.yg0 = (double)j * g.stepy;
+	    xp = xmin + r.xg0;
+	    yp = ymin + r.yg0;
+
+	    r.coslatsq = 0.;
+	    if (g.ll) {
+		coslat = cos(deg2rad * yp);
+		r.coslatsq = coslat * coslat;
+	    }
+
+	    lon0 = xp;
+	    lat0 = yp;
+	    if (!g.ll) {
+		if (GPJ_transform(&iproj, &oproj, &tproj, PJ_FWD,
+				  &lon0, &lat0, NULL) < 0)
+		    G_fatal_error(_("Error in %s"), "GPJ_transform()");
+	    }
+	    lat0 *= deg2rad;
+	    lon0 *= deg2rad;
+
+	    r.z_orig = z[j][i];
+	    r.maxlength = (zmax - r.z_orig) / TANMINANGLE;
+	    r.maxlength = (r.maxlength < BIG) ? r.maxlength : BIG;
+
+	    for (k = 0; k < ndir; k++) {
+		double angle = deg2rad * step * k;
+
+		if (r.z_orig == UNDEFZ) {
+		    cell[k] = 0;
+		    continue;
+		}
+
+		inputAngle = angle + pihalf;
+		inputAngle =
+		    (inputAngle >= pi2) ? inputAngle - pi2 : inputAngle;
+
+		/* Arbitrary small distance in latitude */
+		delt_lat = -0.0001 * cos(inputAngle);
+		delt_lon = 0.0001 * sin(inputAngle) / cos(lat0);
+
+		latitude = (lat0 + delt_lat) * rad2deg;
+		longitude = (lon0 + delt_lon) * rad2deg;
+
+		if (!g.ll) {
+		    if (GPJ_transform(&iproj, &oproj, &tproj, PJ_INV,
+				      &longitude, &latitude, NULL) < 0)
+			G_fatal_error(_("Error in %s"), "GPJ_transform()");
+		}
+
+		delt_east = longitude - xp;
+		delt_nor = latitude - yp;
+
+		delt_dist = sqrt(delt_east * delt_east + delt_nor * delt_nor);
+
+		r.sinangle = delt_nor / delt_dist;
+		if (fabs(r.sinangle) < 0.0000001) {
+		    r.sinangle = 0.;
+		}
+		r.cosangle = delt_east / delt_dist;
+		if (fabs(r.cosangle) < 0.0000001) {
+		    r.cosangle = 0.;
+		}
+		r.distsinangle = 32000;
+		r.distcosangle = 32000;
+
+		if (r.sinangle != 0.) {
+		    r.distsinangle = 100. / (g.distxy * r.sinangle);
+		}
+		if (r.cosangle != 0.) {
+		    r.distcosangle = 100. / (g.distxy * r.cosangle);
+		}
+
+		r.stepsinangle = g.stepxy * r.sinangle;
+		r.stepcosangle = g.stepxy * r.cosangle;
+
+		r.xx0 = r.xg0;
+		r.yy0 = r.yg0;
+		r.ip = r.jp = 0;
+		r.ip100 = floor(i / 100.);
+		r.jp100 = floor(j / 100.);
+		r.zp = r.z_orig;
+
+		/* stored like the horizon rasters in INPUT_part() */
+		h = horizon_height(&g, &r);
+		cell[k] = (char)(rint(SCALING_FACTOR *
+				      AMIN1(h, 256 * invScale)));
+	    }
+	}
+    }
+    G_percent(1, 1, 1);
+
+    G_free_fmatrix(g.z100);
+}
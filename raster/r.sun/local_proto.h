@@ -46,6 +46,11 @@ void setAngularLossDenominator();
 
 void cube(int, int);
 
+/* horizon.c */
+void horizon_table(unsigned char *table, float **z, int rows, int cols,
+		   int ndir, double step, double zmax, double xmin,
+		   double ymin, double dist, struct GridGeometry *gridGeom);
+
 double com_sol_const(int no_of_day);
 
 
@@ -68,7 +68,6 @@ email: hofierka@geomodel.sk,marcel.suri@jrc.it,suri@geomodel.sk Thomas.Huld@jrc.
 #define DSKY      1.0
 #define DIST     "1.0"
 
-#define SCALING_FACTOR 150.
 const double invScale = 1. / SCALING_FACTOR;
 
 #define AMAX1(arg1, arg2) ((arg1) >= (arg2) ? (arg1) : (arg2))
@@ -223,6 +222,9 @@ int main(int argc, char *argv[])
     double singleLinke;
 
     int threads;
+    int *days, ndays, i, k;
+    char **base;
+    const char **outputs[6];
 
     struct GModule *module;
     struct
@@ -450,7 +452,11 @@ int main(int argc, char *argv[])
     parm.day->key = "day";
     parm.day->type = TYPE_INTEGER;
     parm.day->required = YES;
-    parm.day->description = _("No. of day of the year (1-365)");
+    parm.day->multiple = YES;
+    parm.day->label = _("No. of day of the year (1-365)");
+    parm.day->description =
+	_("For several days the output names are basenames "
+	  "completed by the day");
     parm.day->options = "1-365";
     parm.day->guisection = _("Time");
 
@@ -480,14 +486,7 @@ int main(int argc, char *argv[])
     parm.ltime->options = "0-24";
     parm.ltime->guisection = _("Time");
 
-    parm.threads = G_define_option();
-    parm.threads->key = "nprocs";
-    parm.threads->type = TYPE_INTEGER;
-    parm.threads->answer = "1";
-    parm.threads->options = "1-1000";
-    parm.threads->required = NO;
-    parm.threads->description =
-	_("Number of threads which will be used for parallel computing");
+    parm.threads = G_define_standard_option(G_OPT_M_NPROCS);
 
     /*
      * parm.startTime = G_define_option();
@@ -571,13 +570,7 @@ int main(int argc, char *argv[])
 
     civiltime = parm.civilTime->answer;
 
-    sscanf(parm.threads->answer, "%d", &threads);
-    if (threads < 1)
-    {
-      G_warning(_("<%d> is not valid number of threads. Number of threads will be set to <%d>"),
-      threads, abs(threads));
-      threads = abs(threads);
-    }
+    threads = G_set_nprocs(parm.threads);
 #if defined(_OPENMP)
     omp_set_num_threads(threads);
 #else
@@ -623,7 +616,16 @@ int main(int argc, char *argv[])
     if ((insol_time != NULL) && (incidout != NULL))
 	G_fatal_error(_("insol_time and incidout are incompatible options"));
 
-    sscanf(parm.day->answer, "%d", &day);
+    for (ndays = 0; parm.day->answers[ndays]; ndays++) ;
+    days = (int *)G_malloc(ndays * sizeof(int));
+    for (k = 0; k < ndays; k++)
+	sscanf(parm.day->answers[k], "%d", &days[k]);
+    day = days[0];
+
+    /* for several days the horizons are computed once and kept in memory
+       instead of shadowing every day by ray tracing */
+    if (ndays > 1 && useShadow() && horizon == NULL)
+	setUseHorizonData(TRUE);
 
     if (sscanf(parm.step->answer, "%lf", &step) != 1)
 	G_fatal_error(_("Error reading time step size"));
@@ -639,9 +641,12 @@ int main(int argc, char *argv[])
 	else
 	    G_fatal_error(_("The horizon step size must be greater than 0."));
     }
-    else if (useHorizonData()) {
+    else if (horizon != NULL) {
 	G_fatal_error(_("If you use the horizon option you must also set the 'horizonstep' parameter."));
     }
+    else if (useHorizonData()) {
+	G_fatal_error(_("For several days with shadowing the 'horizon_step' parameter must be set."));
+    }
 
     ttime = parm.ltime->answer;
     if (parm.ltime->answer != NULL) {
@@ -714,7 +719,7 @@ int main(int argc, char *argv[])
 
     if (parm.numPartitions->answer != NULL) {
 	sscanf(parm.numPartitions->answer, "%d", &numPartitions);
-	if (useShadow() && (!useHorizonData()) && (numPartitions != 1)) {
+	if (useShadow() && horizon == NULL && (numPartitions != 1)) {
 	    /* If you calculate shadows on the fly, the number of partitions
 	     * must be one.
 	     */
@@ -729,7 +734,7 @@ int main(int argc, char *argv[])
      * on the fly. If you calculate without shadow effects or if you have the
      * shadows pre-calculated, there is no problem. */
 
-    if (saveMemory && useShadow() && (!useHorizonData()))
+    if (saveMemory && useShadow() && horizon == NULL)
 	G_fatal_error(
 	    _("If you want to save memory and to use shadows, "
 	      "you must use pre-calculated horizons."));
@@ -737,6 +742,8 @@ int main(int argc, char *argv[])
     if (parm.declin->answer == NULL)
 	declination = com_declin(day);
     else {
+	if (ndays > 1)
+	    G_fatal_error(_("The declination can only be set for a single day"));
 	sscanf(parm.declin->answer, "%lf", &declin);
 	declination = -declin;
     }
@@ -810,10 +817,33 @@ int main(int argc, char *argv[])
     if ((G_projection() == PROJECTION_LL))
 	ll_correction = TRUE;
 
-    G_debug(3, "calculate() starts...");
-    calculate(singleSlope, singleAspect, singleAlbedo, singleLinke, gridGeom);
-    G_debug(3, "OUTGR() starts...");
-    OUTGR();
+    /* the output maps of a day */
+    outputs[0] = &incidout;
+    outputs[1] = &beam_rad;
+    outputs[2] = &insol_time;
+    outputs[3] = &diff_rad;
+    outputs[4] = &refl_rad;
+    outputs[5] = &glob_rad;
+    base = (char **)G_malloc(6 * sizeof(char *));
+    for (i = 0; i < 6; i++)
+	base[i] = *outputs[i] ? G_store(*outputs[i]) : NULL;
+
+    for (k = 0; k < ndays; k++) {
+	day = days[k];
+	if (ndays > 1) {
+	    G_message(_("Calculating day %d (%d of %d)"), day, k + 1, ndays);
+	    for (i = 0; i < 6; i++)
+		if (base[i])
+		    *outputs[i] = G_generate_basename(base[i], day, 3, 0);
+	    declination = com_declin(day);
+	}
+
+	G_debug(3, "calculate() starts...");
+	calculate(singleSlope, singleAspect, singleAlbedo, singleLinke,
+		  gridGeom);
+	G_debug(3, "OUTGR() starts...");
+	OUTGR();
+    }
 
     exit(EXIT_SUCCESS);
 }
@@ -950,7 +980,7 @@ int INPUT_part(int offset, double *zmax)
     if (useHorizonData()) {
 	if (horizonarray == NULL) {
 	    horizonarray =
-		(unsigned char *)G_calloc(arrayNumInt *
+		(unsigned char *)G_calloc((size_t)arrayNumInt *
 					  numRows * n, sizeof(char));
 
 	    horizonbuf = (FCELL **) G_calloc(arrayNumInt, sizeof(FCELL *) );
@@ -993,7 +1023,7 @@ int INPUT_part(int offset, double *zmax)
      * }
      */
 
-    if (useHorizonData()) {
+    if (horizon != NULL) {
 
 	for (i = 0; i < arrayNumInt; i++) {
 	    for (row = m - offset - 1; row >= finalRow; row--) {
@@ -1139,7 +1169,7 @@ int INPUT_part(int offset, double *zmax)
     }
 
 
-    if (useHorizonData()) {
+    if (horizon != NULL) {
 	for (i = 0; i < arrayNumInt; i++) {
 	    Rast_close(fd_shad[i]);
 	    G_free(horizonbuf[i]);
@@ -1691,7 +1721,8 @@ void calculate(double singleSlope, double singleAspect, double singleAlbedo,
     double dayRad;
     double latid_l, cos_u, cos_v, sin_u, sin_v;
     double sin_phi_l, tan_lam_l;
-    double zmax = 0;
+    static double zmax = 0;
+    static int input_done = 0;
     double longitTime = 0.;
     double locTimeOffset;
     double latitude, longitude;
@@ -1714,14 +1745,28 @@ void calculate(double singleSlope, double singleAspect, double singleAlbedo,
     sunGeom.cosdecl = cos(declination);
 
 
+    /* the ranges of a day for the history */
+    sunrise_min = 24.;
+    sunrise_max = 0.;
+    sunset_min = 24.;
+    sunset_max = 0.;
+    linke_max = 0.;
+    linke_min = 100.;
+    albedo_max = 0.;
+    albedo_min = 1.0;
+    lat_max = -90.;
+    lat_min = 90.;
+
     someRadiation = (beam_rad != NULL) || (insol_time != NULL) ||
 	(diff_rad != NULL) || (refl_rad != NULL) || (glob_rad != NULL);
 
 
     if (incidout != NULL) {
-	lumcl = (float **)G_calloc((m), sizeof(float *));
-	for (l = 0; l < m; l++) {
-	    lumcl[l] = (float *)G_calloc((n), sizeof(float *));
+	if (lumcl == NULL) {
+	    lumcl = (float **)G_calloc((m), sizeof(float *));
+	    for (l = 0; l < m; l++) {
+		lumcl[l] = (float *)G_calloc((n), sizeof(float *));
+	    }
 	}
 	for (j = 0; j < m; j++) {
 	    for (i = 0; i < n; i++)
@@ -1730,9 +1775,11 @@ void calculate(double singleSlope, double singleAspect, double singleAlbedo,
     }
 
     if (beam_rad != NULL) {
-	beam = (float **)G_calloc((m), sizeof(float *));
-	for (l = 0; l < m; l++) {
-	    beam[l] = (float *)G_calloc((n), sizeof(float *));
+	if (beam == NULL) {
+	    beam = (float **)G_calloc((m), sizeof(float *));
+	    for (l = 0; l < m; l++) {
+		beam[l] = (float *)G_calloc((n), sizeof(float *));
+	    }
 	}
 
 	for (j = 0; j < m; j++) {
@@ -1742,9 +1789,11 @@ void calculate(double singleSlope, double singleAspect, double singleAlbedo,
     }
 
     if (insol_time != NULL) {
-	insol = (float **)G_calloc((m), sizeof(float *));
-	for (l = 0; l < m; l++) {
-	    insol[l] = (float *)G_calloc((n), sizeof(float *));
+	if (insol == NULL) {
+	    insol = (float **)G_calloc((m), sizeof(float *));
+	    for (l = 0; l < m; l++) {
+		insol[l] = (float *)G_calloc((n), sizeof(float *));
+	    }
 	}
 
 	for (j = 0; j < m; j++) {
@@ -1754,9 +1803,11 @@ void calculate(double singleSlope, double singleAspect, double singleAlbedo,
     }
 
     if (diff_rad != NULL) {
-	diff = (float **)G_calloc((m), sizeof(float *));
-	for (l = 0; l < m; l++) {
-	    diff[l] = (float *)G_calloc((n), sizeof(float *));
+	if (diff == NULL) {
+	    diff = (float **)G_calloc((m), sizeof(float *));
+	    for (l = 0; l < m; l++) {
+		diff[l] = (float *)G_calloc((n), sizeof(float *));
+	    }
 	}
 
 	for (j = 0; j < m; j++) {
@@ -1766,9 +1817,11 @@ void calculate(double singleSlope, double singleAspect, double singleAlbedo,
     }
 
     if (refl_rad != NULL) {
-	refl = (float **)G_calloc((m), sizeof(float *));
-	for (l = 0; l < m; l++) {
-	    refl[l] = (float *)G_calloc((n), sizeof(float *));
+	if (refl == NULL) {
+	    refl = (float **)G_calloc((m), sizeof(float *));
+	    for (l = 0; l < m; l++) {
+		refl[l] = (float *)G_calloc((n), sizeof(float *));
+	    }
 	}
 
 	for (j = 0; j < m; j++) {
@@ -1778,9 +1831,11 @@ void calculate(double singleSlope, double singleAspect, double singleAlbedo,
     }
 
     if (glob_rad != NULL) {
-	globrad = (float **)G_calloc((m), sizeof(float *));
-	for (l = 0; l < m; l++) {
-	    globrad[l] = (float *)G_calloc((n), sizeof(float *));
+	if (globrad == NULL) {
+	    globrad = (float **)G_calloc((m), sizeof(float *));
+	    for (l = 0; l < m; l++) {
+		globrad[l] = (float *)G_calloc((n), sizeof(float *));
+	    }
 	}
 
 	for (j = 0; j < m; j++) {
@@ -1816,7 +1871,16 @@ void calculate(double singleSlope, double singleAspect, double singleAlbedo,
 	G_percent(j, m - 1, 2);
 
 	if (j % (numRows) == 0) {
-	    INPUT_part(j, &zmax);
+	    /* a single partition is kept for all days */
+	    if (numPartitions > 1 || !input_done) {
+		INPUT_part(j, &zmax);
+		input_done = 1;
+
+		if (useHorizonData() && horizon == NULL)
+		    horizon_table(horizonarray, z, m, n, arrayNumInt,
+				  horizonStep, zmax, xmin, ymin, dist,
+				  &gridGeom);
+	    }
 	    arrayOffset = 0;
 	    shadowoffset = 0;
 
@@ -34,6 +34,9 @@ email: hofierka@geomodel.sk,marcel.suri@jrc.it,suri@geomodel.sk
 /* internal undefined value for NULL */
 #define UNDEFZ   -9999.
 
+/* scaling of the horizon angles in horizonarray */
+#define SCALING_FACTOR 150.
+
 /* Constant for calculating angular loss */
 #define a_r 0.155
 
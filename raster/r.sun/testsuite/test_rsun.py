@@ -14,6 +14,7 @@ class TestRSunMode2(TestCase):
     glob_rad = 'glob_rad'
     insol_time = 'insol_time'
     glob_rad_threads = 'glob_rad_threads'
+    glob_rad_days = 'glob_rad_days'
 
     @classmethod
     def setUpClass(cls):
@@ -25,7 +26,8 @@ class TestRSunMode2(TestCase):
     def tearDownClass(cls):
         cls.del_temp_region()
         cls.runModule('g.remove', type=['raster'],
-                      name=[cls.slope, cls.aspect, cls.insol_time, cls.beam_rad, cls.glob_rad, cls.glob_rad_threads], flags='f')
+                      name=[cls.slope, cls.aspect, cls.insol_time, cls.beam_rad, cls.glob_rad, cls.glob_rad_threads,
+                            cls.glob_rad_days + '_172', cls.glob_rad_days + '_355'], flags='f')
 
     def setUp(self):
         self.rsun = SimpleModule('r.sun', elevation=self.elevation, slope=self.slope, aspect=self.aspect,
@@ -43,6 +45,15 @@ class TestRSunMode2(TestCase):
             # original version of r.sun without parallel processing
             return
 
+    def test_several_days(self):
+        self.rsun.flags['p'].value = True
+        self.assertModule(self.rsun)
+        rsun = SimpleModule('r.sun', elevation=self.elevation, slope=self.slope, aspect=self.aspect,
+                            day=[172, 355], glob_rad=self.glob_rad_days, flags='p', overwrite=True)
+        self.assertModule(rsun)
+        self.assertRasterExists(name=self.glob_rad_days + '_355')
+        self.assertRastersNoDifference(self.glob_rad, self.glob_rad_days + '_172', precision=1e-8)
+
     def test_run_outputs(self):
         self.assertModule(self.rsun)
         self.assertRasterExists(name=self.beam_rad)
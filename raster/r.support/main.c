@@ -42,7 +42,7 @@ int main(int argc, char *argv[])
     struct Option *datasrc1_opt, *datasrc2_opt, *datadesc_opt;
     struct Option *map_opt, *units_opt, *vdatum_opt;
     struct Option *load_opt, *save_opt;
-    struct Flag *stats_flag, *null_flag, *del_flag;
+    struct Flag *stats_flag, *null_flag, *del_flag, *ovr_flag;
     int is_reclass;		/* Is raster reclass? */
     const char *infile;
     struct History hist;
@@ -136,6 +136,10 @@ int main(int argc, char *argv[])
     del_flag->key = 'd';
     del_flag->description = _("Delete the null file");
 
+    ovr_flag = G_define_flag();
+    ovr_flag->key = 'o';
+    ovr_flag->description = _("Build overviews for coarse resolution reads");
+
     /* Parse command-line options */
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
@@ -308,9 +312,26 @@ int main(int argc, char *argv[])
 	unlink(path);
 	G_file_name_misc(path, "cell_misc", "nullcmpr", raster->answer, G_mapset());
 	unlink(path);
+	Rast_remove_overviews(raster->answer);
 
 	G_done_msg(_("Done."));
     }
 
+    /* overviews last, they copy the null file */
+    if (ovr_flag->answer) {
+	int nlevels;
+
+	if (is_reclass)
+	    G_fatal_error(_("[%s] is a reclass of another map. Exiting."),
+			  raster->answer);
+
+	G_message(_("Building overviews for [%s]..."), raster->answer);
+	nlevels = Rast_build_overviews(raster->answer);
+	if (nlevels == 0)
+	    G_important_message(_("Raster map is too small for overviews"));
+	else
+	    G_message(_("%d overview levels built"), nlevels);
+    }
+
     return EXIT_SUCCESS;
 }
@@ -12,6 +12,7 @@
  *
  *****************************************************************************/
 
+#include <grass/gmath.h>
 #include <grass/glocale.h>
 #include "frac.h"
 
@@ -31,6 +32,7 @@ int main(int argc, char *argv[])
     struct Option *rast_out;	/* Structure for output raster     */
     struct Option *frac_dim;	/* Fractal dimension of surface.   */
     struct Option *num_images;	/* Number of images to produce.    */
+    struct Option *seed;	/* Seed of the random generator.   */
 
     G_gisinit(argv[0]);		/* Link with GRASS interface.      */
 
@@ -57,6 +59,13 @@ int main(int argc, char *argv[])
     num_images->required = NO;
     num_images->answer = "0";
 
+    seed = G_define_option();
+    seed->key = "seed";
+    seed->type = TYPE_INTEGER;
+    seed->required = NO;
+    seed->description =
+	_("Seed for the random number generator, for repeatable surfaces");
+
     if (G_parser(argc, argv))	/* Performs the prompting for      */
 	exit(EXIT_FAILURE);	/* keyboard input.                 */
 
@@ -65,6 +74,11 @@ int main(int argc, char *argv[])
     H = 3.0 - H;
     Steps = atoi(num_images->answer) + 1;
 
+    if (seed->answer)
+	G_math_srand(atoi(seed->answer));
+    else
+	G_math_srand_auto();
+
     G_debug(1, "Steps %d", Steps);
 
     mapset_out = G_mapset();	/* Set output to current mapset.  */
@@ -0,0 +1,207 @@
+/****************************************************************/
+/*      Interpolation of projected regions with a k-d tree      */
+/*      search of the nearest data points; the rows are         */
+/*      interpolated in parallel in bands of rows               */
+
+#include <stdlib.h>
+#include <math.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/kdtree.h>
+#include <grass/glocale.h>
+#include "main.h"
+
+/* number of output rows interpolated at once */
+#define ROW_BAND 64
+
+/* nearest points of a thread */
+struct scratch
+{
+    int *uid;
+    double *dist;
+};
+
+/* the rows of a band */
+struct band
+{
+    struct kdtree *tree;
+    MELEMENT **data;		/* data point of each tree point */
+    CELL *cellbuf, *maskbuf;
+    int band;			/* first row of the band */
+    int ncols, npoints, nsearch, error_flag;
+    double ew, maxdist;
+    int chunk;			/* rows of a thread */
+    struct scratch *scratch;
+};
+
+/* the threads interpolate the rows first to last - 1 of a band; the
+ * data points and the search tree are shared and only read, each row
+ * of the band buffer is written by one thread, the nearest points of a
+ * thread are in its own scratch */
+static void interp_rows(int first, int last, void *closure)
+{
+    const struct band *bd = closure;
+    int *uid = bd->scratch[first / bd->chunk].uid;
+    double *dist = bd->scratch[first / bd->chunk].dist;
+    int row, col, n;
+
+    for (row = first; row < last; row++) {
+	CELL *out = bd->cellbuf + (size_t)row * bd->ncols;
+	CELL *m = bd->maskbuf ? bd->maskbuf + (size_t)row * bd->ncols : NULL;
+
+	for (col = 0; col < bd->ncols; col++) {
+	    double c[2], sum1, sum2;
+	    int found, start;
+
+	    /* don't interpolate outside of the mask */
+	    if (m && m[col] == 0) {
+		out[col] = 0;
+		continue;
+	    }
+
+	    c[0] = col * bd->ew;
+	    c[1] = bd->band + row;
+	    found = kdtree_knn(bd->tree, c, uid, dist, bd->nsearch, NULL);
+
+	    /* a data point in this cell is the closest point */
+	    start = 0;
+	    if (found > 0 && dist[0] == 0.0) {
+		if (!bd->error_flag) {
+		    /* no interpolation required */
+		    out[col] = bd->data[uid[0]]->value;
+		    continue;
+		}
+		/* ignore value and interpolate */
+		start = 1;
+	    }
+	    else if (found > bd->npoints)
+		found = bd->npoints;
+
+	    if (bd->maxdist > 0)
+		while (found > start &&
+		       dist[found - 1] > bd->maxdist * bd->maxdist)
+		    found--;
+
+	    if (found <= start) {
+		Rast_set_c_null_value(&out[col], 1);
+		continue;
+	    }
+
+	    /* calculate value to be set for the cell from the data
+	     * values of npoints closest neighboring points */
+	    sum1 = sum2 = 0.0;
+	    for (n = start; n < found; n++) {
+		sum1 += bd->data[uid[n]]->value / dist[n];
+		sum2 += 1.0 / dist[n];
+	    }
+
+	    out[col] = (CELL) (sum1 / sum2 + .5);
+
+	    if (bd->error_flag)	/* output interpolation error for this cell */
+		out[col] -= m[col];
+	}
+    }
+}
+
+int interpolate_kdtree(MELEMENT rowlist[], SHORT nrows, SHORT ncols,
+		       SHORT datarows, int npoints, double maxdist,
+		       const char *output, int out_fd, int maskfd,
+		       int error_flag)
+{
+    extern double ew2;
+    extern CELL *mask;
+
+    struct kdtree *tree;
+    MELEMENT *Rptr, *Mptr, **data;
+    double *coords;
+    CELL *cellbuf, *maskbuf = NULL;
+    double ew;
+    int n, ndata, nsearch, band, row;
+    int threads = G_num_workers() + 1;
+    struct band bd;
+
+    /* the coordinates are scaled to make the squared distance between
+     * two cells equal to the squared distance of the lookup tables */
+    ew = sqrt(ew2);
+
+    ndata = 0;
+    for (Rptr = rowlist; Rptr < rowlist + datarows; Rptr++)
+	for (Mptr = Rptr->next; Mptr; Mptr = Mptr->next)
+	    ndata++;
+
+    G_message(_("Building search tree..."));
+    data = (MELEMENT **) G_malloc((ndata > 0 ? ndata : 1) *
+				  sizeof(MELEMENT *));
+    coords = G_malloc(2 * (ndata > 0 ? ndata : 1) * sizeof(double));
+    n = 0;
+    for (Rptr = rowlist; Rptr < rowlist + datarows; Rptr++) {
+	for (Mptr = Rptr->next; Mptr; Mptr = Mptr->next) {
+	    coords[2 * n] = Mptr->x * ew;
+	    coords[2 * n + 1] = Mptr->y;
+	    data[n] = Mptr;
+	    n++;
+	}
+    }
+    tree = kdtree_create_bulk(2, NULL, coords, NULL, n, 1);
+    G_free(coords);
+
+    /* with -e the data point of the cell itself is searched as well
+     * and skipped when the cell is interpolated */
+    nsearch = npoints + (error_flag ? 1 : 0);
+
+    cellbuf = (CELL *) G_malloc((size_t)ROW_BAND * ncols * sizeof(CELL));
+    if (mask)
+	maskbuf = (CELL *) G_malloc((size_t)ROW_BAND * ncols * sizeof(CELL));
+
+    bd.tree = tree;
+    bd.data = data;
+    bd.cellbuf = cellbuf;
+    bd.maskbuf = maskbuf;
+    bd.ncols = ncols;
+    bd.npoints = npoints;
+    bd.nsearch = nsearch;
+    bd.error_flag = error_flag;
+    bd.ew = ew;
+    bd.maxdist = maxdist;
+    bd.scratch = G_malloc(threads * sizeof(struct scratch));
+    for (n = 0; n < threads; n++) {
+	bd.scratch[n].uid = (int *)G_malloc(nsearch * sizeof(int));
+	bd.scratch[n].dist = (double *)G_malloc(nsearch * sizeof(double));
+    }
+
+    G_message(n_("Interpolating raster map <%s> (%d row)...",
+		 "Interpolating raster map <%s> (%d rows)...", nrows),
+	      output, nrows);
+
+    for (band = 0; band < nrows; band += ROW_BAND) {
+	int rows_band = nrows - band < ROW_BAND ? nrows - band : ROW_BAND;
+
+	G_percent(band, nrows, 2);
+
+	if (maskbuf)
+	    for (row = 0; row < rows_band; row++)
+		Rast_get_c_row(maskfd, maskbuf + (size_t)row * ncols,
+			       band + row);
+
+	bd.band = band;
+	bd.chunk = (rows_band + threads - 1) / threads;
+	G_parallel_for(0, rows_band, bd.chunk, interp_rows, &bd);
+
+	for (row = 0; row < rows_band; row++)
+	    Rast_put_row(out_fd, cellbuf + (size_t)row * ncols, CELL_TYPE);
+    }
+    G_percent(1, 1, 1);
+
+    kdtree_destroy(tree);
+    G_free(data);
+    G_free(cellbuf);
+    if (maskbuf)
+	G_free(maskbuf);
+    for (n = 0; n < threads; n++) {
+	G_free(bd.scratch[n].uid);
+	G_free(bd.scratch[n].dist);
+    }
+    G_free(bd.scratch);
+
+    return 0;
+}
@@ -84,11 +84,12 @@ int main(int argc, char **argv)
     SHORT nrows, ncols;
     SHORT datarows;
     int npoints;
+    double maxdist;
     struct GModule *module;
     struct History history;
     struct
     {
-	struct Option *input, *output, *npoints;
+	struct Option *input, *output, *npoints, *radius, *threads;
     } parm;
     struct
     {
@@ -119,6 +120,16 @@ int main(int argc, char **argv)
     parm.npoints->description = _("Number of interpolation points");
     parm.npoints->answer = "12";
 
+    parm.radius = G_define_option();
+    parm.radius->key = "radius";
+    parm.radius->type = TYPE_DOUBLE;
+    parm.radius->required = NO;
+    parm.radius->label = _("Maximum distance of interpolation points");
+    parm.radius->description =
+	_("Cells without data points within this distance are set to NULL");
+
+    parm.threads = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.e = G_define_flag();
     flag.e->key = 'e';
     flag.e->description = _("Output is the interpolation error");
@@ -130,6 +141,14 @@ int main(int argc, char **argv)
 	G_fatal_error(_("Illegal value for '%s' (%s)"), parm.npoints->key,
 		      parm.npoints->answer);
 
+    maxdist = 0;
+    if (parm.radius->answer &&
+	(sscanf(parm.radius->answer, "%lf", &maxdist) != 1 || maxdist <= 0))
+	G_fatal_error(_("Illegal value for '%s' (%s)"), parm.radius->key,
+		      parm.radius->answer);
+
+    G_set_nprocs(parm.threads);
+
     npoints = n;
     error_flag = flag.e->answer;
     input = parm.input->answer;
@@ -146,6 +165,10 @@ int main(int argc, char **argv)
     /* initialize function pointers */
     lookup_and_function_ptrs(nrows, ncols);
 
+    if (ll && maxdist > 0)
+	G_fatal_error(_("Option '%s' is not supported for latitude-longitude locations"),
+		      parm.radius->key);
+
     /*  allocate buffers for row i/o                                */
     cell = Rast_allocate_c_buf();
     if ((maskfd = Rast_maskfd()) >= 0 || error_flag) {	/* apply mask to output */
@@ -173,8 +196,14 @@ int main(int argc, char **argv)
     /* open cell layer for writing output              */
     fd = Rast_open_c_new(output);
 
-    /* call the interpolation function                              */
-    interpolate(rowlist, nrows, ncols, datarows, npoints, fd, maskfd);
+    /* call the interpolation function, projected regions are searched
+     * with a k-d tree                                              */
+    if (ll)
+	interpolate(rowlist, nrows, ncols, datarows, npoints, fd, maskfd);
+    else
+	interpolate_kdtree(rowlist, nrows, ncols, datarows, npoints,
+			   maxdist / window.ns_res, output, fd, maskfd,
+			   error_flag);
 
     /* free allocated memory */
     free_row_lists(rowlist, nrows);
@@ -42,6 +42,10 @@ int LL_set_geodesic_distance(double *, int, int);
 double LL_geodesic_distance(double);
 int free_dist_params(void);
 
+/* kdsearch.c */
+int interpolate_kdtree(MELEMENT[], SHORT, SHORT, SHORT, int, double,
+		       const char *, int, int, int);
+
 /* ll.c */
 int extend_west(EW *);
 int extend_east(EW *);
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <new>
 
 #include <grass/iostream/ami.h>
 
@@ -61,6 +62,32 @@ typedef EMPQueueAdaptive<flowStructure, flowPriority> FLOW_DATASTR;
 #endif
 
 
+/* The sweep stream is processed in batches of SWEEP_BATCH points:
+   while the flow of a batch goes through the priority queue, a libgis
+   worker thread (see G_begin_execute()) reads the next batch and
+   computes its multiple flow direction weights, which don't depend on
+   the flow, and another one writes the output of the previous
+   batch. The workers must not allocate memory, the counters of
+   MM_manager are not thread-safe. */
+#define SWEEP_BATCH (1 << 12)
+
+struct sweepInBatch {
+  AMI_STREAM<sweepItem> *str;
+  sweepItem *items;
+  weightWindow *weights;
+  off_t len;			/* number of points to read */
+  off_t nread;			/* number of points read */
+  int trustdir;
+  void *worker;
+};
+
+struct sweepOutBatch {
+  AMI_STREAM<sweepOutput> *str;
+  sweepOutput *items;
+  off_t len;
+  void *worker;
+};
+
 /* defined in this module */
 void pushFlow(const sweepItem& swit, const flowValue &flow, 
 	      FLOW_DATASTR* flowpq, const weightWindow &weight);
@@ -155,6 +182,39 @@ initializePQ() {
   return flowpq;
 }
   
+/* ------------------------------------------------------------ */
+/* runs on a worker thread */
+static void
+readBatch(void *closure) {
+  sweepInBatch *b = (sweepInBatch *)closure;
+
+  b->nread = 0;
+  b->str->read_array(b->items, b->len, &b->nread);
+
+  for (off_t k = 0; k < b->nread; k++) {
+    const sweepItem &pt = b->items[k];
+
+    b->weights[k].compute(pt.getI(), pt.getJ(), pt.getElevWindow(),
+			  pt.getDir(), b->trustdir);
+  }
+}
+
+/* runs on a worker thread */
+static void
+writeBatch(void *closure) {
+  sweepOutBatch *b = (sweepOutBatch *)closure;
+
+  b->str->write_array(b->items, b->len);
+}
+
+/* start reading the next batch of at most SWEEP_BATCH points */
+static void
+startReadBatch(sweepInBatch *b, long remaining) {
+  b->len = remaining < SWEEP_BATCH ? remaining : SWEEP_BATCH;
+  G_begin_execute(readBatch, b, &b->worker, 0);
+}
+
+
 /***************************************************************/
 /* Read the points in order from the sweep stream and process them.
    If trustdir = 1 then trust and use the directions contained in the
@@ -181,10 +241,6 @@ sweep(AMI_STREAM<sweepItem> *sweepstr, const flowaccumulation_type D8CUT,
   if (stats)
     *stats << "sweeping\n";
   G_debug(1, "sweeping: ");
-  /* create and initialize flow data structure */
-  FLOW_DATASTR *flowpq;
-  flowpq = initializePQ();
-  
   /* create output stream */
   outstr = new AMI_STREAM<sweepOutput>();
   
@@ -193,6 +249,33 @@ sweep(AMI_STREAM<sweepItem> *sweepstr, const flowaccumulation_type D8CUT,
   sweepOutput output;
   nitems = sweepstr->stream_len();
 
+  /* batches, allocated before the flow data structure takes the
+     available memory */
+  G_init_workers();
+  sweepInBatch inbuf[2];
+  sweepOutBatch outbuf[2];
+  for (int b = 0; b < 2; b++) {
+    inbuf[b].str = sweepstr;
+    inbuf[b].items = new sweepItem[SWEEP_BATCH];
+    /* weightWindow has no default constructor */
+    inbuf[b].weights = (weightWindow *)new char[SWEEP_BATCH * sizeof(weightWindow)];
+    for (int l = 0; l < SWEEP_BATCH; l++)
+      new (&inbuf[b].weights[l]) weightWindow(region->ew_res, region->ns_res);
+    inbuf[b].len = inbuf[b].nread = 0;
+    inbuf[b].trustdir = trustdir;
+    inbuf[b].worker = NULL;
+    outbuf[b].str = outstr;
+    outbuf[b].items = new sweepOutput[SWEEP_BATCH];
+    outbuf[b].len = 0;
+    outbuf[b].worker = NULL;
+  }
+  int crtin = 0, crtout = 0;
+  long kbatch = 0;
+
+  /* create and initialize flow data structure */
+  FLOW_DATASTR *flowpq;
+  flowpq = initializePQ();
+
 #ifndef NDEBUG
   flowPriority prevprio = flowPriority(SHRT_MAX);	/* XXX      */
 #endif
@@ -200,15 +283,28 @@ sweep(AMI_STREAM<sweepItem> *sweepstr, const flowaccumulation_type D8CUT,
   ae = sweepstr->seek(0);
   assert(ae == AMI_ERROR_NO_ERROR);
   G_important_message(_("Sweeping..."));
+  if (nitems > 0)
+    startReadBatch(&inbuf[crtin], nitems);
   for (long k = 0; k < nitems; k++) {
     
     /* cout << k << endl; cout.flush(); */
     /* read next sweepItem = (prio, elevwin, topoRankwin, dir) */
-    ae = sweepstr->read_item(&crtpoint);
-    if (ae != AMI_ERROR_NO_ERROR) {
-      fprintf(stderr, "sweep: k=%ld: cannot read next item..\n", k);
-      exit(1);
+    if (k == 0 || k == kbatch + inbuf[crtin].len) {
+      if (k > 0) {
+	kbatch = k;
+	crtin = 1 - crtin;
+      }
+      G_end_execute(&inbuf[crtin].worker);
+      if (inbuf[crtin].nread != inbuf[crtin].len) {
+	fprintf(stderr, "sweep: k=%ld: cannot read next item..\n",
+		k + (long)inbuf[crtin].nread);
+	exit(1);
+      }
+      /* read the next batch while this one is swept */
+      if (k + inbuf[crtin].len < nitems)
+	startReadBatch(&inbuf[1 - crtin], nitems - k - inbuf[crtin].len);
     }
+    crtpoint = &inbuf[crtin].items[k - kbatch];
     /* cout << "k=" << k << " prio =" << crtpoint->getPriority() << "\n"; */
     /* nodata points should not be in sweep stream */
     assert(!is_nodata(crtpoint->getElev()));
@@ -245,9 +341,8 @@ sweep(AMI_STREAM<sweepItem> *sweepstr, const flowaccumulation_type D8CUT,
       weight.makeD8(crtpoint->getI(), crtpoint->getJ(), 
 		    crtpoint->getElevWindow(), crtpoint->getDir(), trustdir);
     } else {
-      /* consider multiple flow directions */
-      weight.compute(crtpoint->getI(), crtpoint->getJ(), 
-		     crtpoint->getElevWindow(), crtpoint->getDir(), trustdir);
+      /* consider multiple flow directions, computed by readBatch() */
+      weight = inbuf[crtin].weights[k - kbatch];
     }    
     
     
@@ -268,14 +363,28 @@ sweep(AMI_STREAM<sweepItem> *sweepstr, const flowaccumulation_type D8CUT,
 #endif        
 
     /* write output to sweep output stream */
-    ae = outstr->write_item(output);
-    assert(ae == AMI_ERROR_NO_ERROR);
+    outbuf[crtout].items[outbuf[crtout].len++] = output;
+    if (outbuf[crtout].len == SWEEP_BATCH || k == nitems - 1) {
+      /* the batches are written in order */
+      G_end_execute(&outbuf[1 - crtout].worker);
+      G_begin_execute(writeBatch, &outbuf[crtout], &outbuf[crtout].worker, 0);
+      crtout = 1 - crtout;
+      outbuf[crtout].len = 0;
+    }
     
     G_percent(k, nitems, 2);
   } /* for k  */
   
   G_percent(1, 1, 1); /* finish it */
 
+  for (int b = 0; b < 2; b++) {
+    G_end_execute(&inbuf[b].worker);
+    G_end_execute(&outbuf[b].worker);
+    delete [] inbuf[b].items;
+    delete [] (char *)inbuf[b].weights;
+    delete [] outbuf[b].items;
+  }
+
   if (stats)
     *stats << "sweeping done\n";
   char buf[1024];
@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -44,244 +45,255 @@
 #define F12 "Measure of Correlation-1 "
 #define F13 "Measure of Correlation-2 "
 
-#define PGM_MAXMAXVAL 255
-#define MAX_MATRIX_SIZE 512
+#include "h_measure.h"
+
+#define MAX_MATRIX_SIZE (PGM_MAXMAXVAL + 1)
 
 float **matrix(int nr, int nc);
 float *vector(int n);
-
-float f1_asm(void);
-float f2_contrast(void);
-float f3_corr(void);
-float f4_var(void);
-float f5_idm(void);
-float f6_savg(void);
-float f7_svar(void);
-float f8_sentropy(void);
-float f9_entropy(void);
-float f10_dvar(void);
-float f11_dentropy(void);
-float f12_icorr(void);
-float f13_icorr(void);
-
-static float **P_matrix = NULL;
-static float **P_matrix0 = NULL;
-static float **P_matrix45 = NULL;
-static float **P_matrix90 = NULL;
-static float **P_matrix135 = NULL;
-
-int tone[PGM_MAXMAXVAL + 1];
-static int Ng = 0;
-static float *px, *py;
-static float Pxpys[2 * PGM_MAXMAXVAL + 2];
-static float Pxpyd[2 * PGM_MAXMAXVAL + 2];
-
-
-void alloc_vars(int size)
+void MatrixDealloc(float **A, int N);
+
+float f1_asm(struct matvec *);
+float f2_contrast(struct matvec *);
+float f3_corr(struct matvec *);
+float f4_var(struct matvec *);
+float f5_idm(struct matvec *);
+float f6_savg(struct matvec *);
+float f7_svar(struct matvec *);
+float f8_sentropy(struct matvec *);
+float f9_entropy(struct matvec *);
+float f10_dvar(struct matvec *);
+float f11_dentropy(struct matvec *);
+float f12_icorr(struct matvec *);
+float f13_icorr(struct matvec *);
+
+/* offset of the second pixel of a pair for 0, 45, 90 and 135 degrees,
+ * in units of the distance */
+static const int drow[4] = { 0, 1, 1, 1 };
+static const int dcol[4] = { 1, -1, 0, 1 };
+
+struct matvec *alloc_vars(int size, int dist)
 {
+    struct matvec *mv = G_malloc(sizeof(struct matvec));
     int msize2;
 
+    mv->size = size;
+    mv->offset = size / 2;
+    mv->dist = dist;
+    mv->wrows = Rast_window_rows();
+    mv->wcols = Rast_window_cols();
+
     /* Allocate memory for gray-tone spatial dependence matrix */
-    P_matrix0 = matrix(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE + 1);
-    P_matrix45 = matrix(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE + 1);
-    P_matrix90 = matrix(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE + 1);
-    P_matrix135 = matrix(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE + 1);
+    mv->P_matrix0 = matrix(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE + 1);
+    mv->P_matrix45 = matrix(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE + 1);
+    mv->P_matrix90 = matrix(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE + 1);
+    mv->P_matrix135 = matrix(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE + 1);
+    mv->P_matrix = mv->P_matrix0;
 
     if (size * size < 256)
 	msize2 = size * size;
     else
 	msize2 = 256;
 
-    px = vector(msize2 + 1);
-    py = vector(msize2 + 1);
+    mv->px = vector(msize2 + 1);
+    mv->py = vector(msize2 + 1);
+
+    return mv;
+}
+
+void free_vars(struct matvec *mv)
+{
+    MatrixDealloc(mv->P_matrix0, MAX_MATRIX_SIZE + 1);
+    MatrixDealloc(mv->P_matrix45, MAX_MATRIX_SIZE + 1);
+    MatrixDealloc(mv->P_matrix90, MAX_MATRIX_SIZE + 1);
+    MatrixDealloc(mv->P_matrix135, MAX_MATRIX_SIZE + 1);
+    G_free(mv->px);
+    G_free(mv->py);
+    G_free(mv);
 }
 
-static int bsearch_gray(int *array, int n, int val)
+/* Add (sign = 1) or remove (sign = -1) the pairs of the given angle
+ * whose first pixel is in column pcol, for the window rows r0 to r1
+ * and columns c0 to c1 clipped to the image. Both pixels of a pair
+ * must be in the window and not NULL. */
+static void update_pairs(struct matvec *mv, int **grays, int angle,
+			 int pcol, int r0, int r1, int c0, int c1, int sign)
 {
-    int lo, hi, mid;
+    int dr = drow[angle] * mv->dist;
+    int qcol = pcol + dcol[angle] * mv->dist;
+    int (*count)[PGM_MAXMAXVAL + 1] = mv->count[angle];
+    int row, x, y;
+
+    if (pcol < c0 || pcol > c1 || qcol < c0 || qcol > c1)
+	return;
+
+    for (row = r0; row + dr <= r1; row++) {
+	x = grays[row][pcol];
+	y = grays[row + dr][qcol];
+	if (x < 0 || y < 0)
+	    continue;
+	count[x][y] += sign;
+	count[y][x] += sign;
+	mv->R[angle] += 2 * sign;
+    }
+}
 
-    lo = 0;
-    hi = n - 1;
+/* Add or remove the gray values of a column of the window */
+static void update_hist(struct matvec *mv, int **grays, int col,
+			int r0, int r1, int sign)
+{
+    int row;
 
-    while (lo <= hi) {
-	mid = (lo + hi) >> 1;
-	
-	if (array[mid] == val)
-	    return mid;
+    if (col < 0 || col >= mv->wcols)
+	return;
 
-	if (array[mid] > val)
-	    hi = mid - 1;
-	else
-	    lo = mid + 1;
+    for (row = r0; row <= r1; row++) {
+	if (grays[row][col] < 0)	/* No data pixel found */
+	    continue;
+	mv->hist[grays[row][col]] += sign;
+	mv->cnt += sign;
     }
+}
 
-    return -1;
+static void window_rows(const struct matvec *mv, int curr_row, int *r0,
+			int *r1)
+{
+    *r0 = curr_row - mv->offset;
+    if (*r0 < 0)
+	*r0 = 0;
+    *r1 = curr_row + mv->offset;
+    if (*r1 > mv->wrows - 1)
+	*r1 = mv->wrows - 1;
 }
 
-int set_vars(int **grays, int curr_row, int curr_col,
-                int size, int offset, int t_d, int with_nulls)
+static void window_cols(const struct matvec *mv, int curr_col, int *c0,
+			int *c1)
 {
-    int R0, R45, R90, R135, x, y;
-    int row, col, row2, col2, rows, cols;
-    int rowmin, rowmax, colmin, colmax, wrows, wcols, rowd, cold;
-    int itone, jtone;
-    int cnt;
-
-    rows = cols = size;
-    wrows = Rast_window_rows();
-    wcols = Rast_window_cols();
-
-    /* Determine the number of different gray scales (not maxval) */
-    for (row = 0; row <= PGM_MAXMAXVAL; row++)
-	tone[row] = -1;
-    cnt = 0;
-    rowmin = curr_row - offset;
-    if (rowmin < 0)
-	rowmin = 0;
-    rowmax = curr_row + offset;
-    if (rowmax > wrows - 1)
-	rowmax = wrows - 1;
-    colmin = curr_col - offset;
-    if (colmin < 0)
-	colmin = 0;
-    colmax = curr_col + offset;
-    if (colmax > wcols - 1)
-	colmax = wcols - 1;
-    for (row = rowmin; row <= rowmax; row++) {
-	for (col = colmin; col <= colmax; col++) {
-	    if (grays[row][col] < 0) {	/* No data pixel found */
-		continue;
-	    }
-	    if (grays[row][col] > PGM_MAXMAXVAL)
-		G_fatal_error(_("Too many categories (found: %i, max: %i). "
-				"Try to rescale or reclassify the map"),
-			      grays[row][col], PGM_MAXMAXVAL);
-	    tone[grays[row][col]] = grays[row][col];
-	    cnt++;
-	}
-    }
-    /* what is the minimum number of pixels 
-     * to get reasonable texture measurements ? 
-     * at the very least, any of R0, R45, R90, R135 must be > 1 */
-    if (cnt < size * size / 4 || (!with_nulls && cnt < size * size))
-	return 0;
+    *c0 = curr_col - mv->offset;
+    if (*c0 < 0)
+	*c0 = 0;
+    *c1 = curr_col + mv->offset;
+    if (*c1 > mv->wcols - 1)
+	*c1 = mv->wcols - 1;
+}
+
+/* Count the gray values and co-occurrences of the window centered on
+ * curr_row, curr_col from scratch */
+void start_window(struct matvec *mv, int **grays, int curr_row,
+		  int curr_col)
+{
+    int r0, r1, c0, c1, col, angle;
 
-    /* Collapse array, taking out all zero values */
-    Ng = 0;
-    for (row = 0; row <= PGM_MAXMAXVAL; row++) {
-	if (tone[row] != -1)
-	    tone[Ng++] = tone[row];
+    memset(mv->hist, 0, sizeof(mv->hist));
+    memset(mv->count, 0, sizeof(mv->count));
+    mv->cnt = 0;
+    for (angle = 0; angle < 4; angle++)
+	mv->R[angle] = 0;
+
+    window_rows(mv, curr_row, &r0, &r1);
+    window_cols(mv, curr_col, &c0, &c1);
+
+    for (col = c0; col <= c1; col++) {
+	update_hist(mv, grays, col, r0, r1, 1);
+	for (angle = 0; angle < 4; angle++)
+	    update_pairs(mv, grays, angle, col, r0, r1, c0, c1, 1);
     }
+}
 
-    /* Now array contains only the gray levels present (in ascending order) */
+/* Move the window from curr_col - 1 to curr_col: remove the pairs
+ * with a pixel in the leaving column and add those with a pixel in the
+ * entering column */
+void move_window(struct matvec *mv, int **grays, int curr_row,
+		 int curr_col)
+{
+    int r0, r1, c0, c1, angle, d;
+    int leave = curr_col - 1 - mv->offset;
+    int enter = curr_col + mv->offset;
+
+    window_rows(mv, curr_row, &r0, &r1);
+
+    window_cols(mv, curr_col - 1, &c0, &c1);
+    update_hist(mv, grays, leave, r0, r1, -1);
+    for (angle = 0; angle < 4; angle++) {
+	d = dcol[angle] * mv->dist;
+	/* the leaving column is the left one of the pair */
+	update_pairs(mv, grays, angle, d >= 0 ? leave : leave - d,
+		     r0, r1, c0, c1, -1);
+    }
 
-    for (row = 0; row < Ng; row++)
-	for (col = 0; col < Ng; col++) {
-	    P_matrix0[row][col] = P_matrix45[row][col] = 0;
-	    P_matrix90[row][col] = P_matrix135[row][col] = 0;
-	}
+    window_cols(mv, curr_col, &c0, &c1);
+    update_hist(mv, grays, enter, r0, r1, 1);
+    for (angle = 0; angle < 4; angle++) {
+	d = dcol[angle] * mv->dist;
+	/* the entering column is the right one of the pair */
+	update_pairs(mv, grays, angle, d > 0 ? enter - d : enter,
+		     r0, r1, c0, c1, 1);
+    }
+}
 
-    /* Find normalizing constants */
-    /* not correct in case of NULL cells: */
-    /*
-    R0 = 2 * rows * (cols - t_d);
-    R45 = 2 * (rows - t_d) * (cols - t_d);
-    R90 = 2 * (rows - t_d) * cols;
-    R135 = R45;
-    */
+int set_vars(struct matvec *mv, int with_nulls)
+{
+    int size = mv->size;
+    int itone, jtone, x, y;
+    float R0, R45, R90, R135;
 
-    /* count actual cooccurrences for each angle */
-    R0 = R45 = R90 = R135 = 0;
+    /* what is the minimum number of pixels 
+     * to get reasonable texture measurements ? 
+     * at the very least, any of R0, R45, R90, R135 must be > 1 */
+    if (mv->cnt < size * size / 4 || (!with_nulls && mv->cnt < size * size))
+	return 0;
 
-    /* Find gray-tone spatial dependence matrix */
-    for (row = 0; row < rows; row++) {
-	row2 = curr_row - offset + row;
-	if (row2 < 0 || row2 >= wrows)
-	    continue;
-	for (col = 0; col < cols; col++) {
-	    col2 = curr_col - offset + col;
-	    if (col2 < 0 || col2 >= wcols)
-		continue;
-	    if (grays[row2][col2] < 0)
-		continue;
-	    x = bsearch_gray(tone, Ng, grays[row2][col2]);
-	    rowd = row2;
-	    cold = col2 + t_d;
-	    if (col + t_d < cols && cold < wcols &&
-	        grays[rowd][cold] >= 0) {
-		y = bsearch_gray(tone, Ng, grays[rowd][cold]);
-		P_matrix0[x][y]++;
-		P_matrix0[y][x]++;
-		R0 += 2;
-	    }
-	    rowd = row2 + t_d;
-	    cold = col2;
-	    if (row + t_d < rows && rowd < wrows &&
-	        grays[rowd][cold] >= 0) {
-		y = bsearch_gray(tone, Ng, grays[rowd][cold]);
-		P_matrix90[x][y]++;
-		P_matrix90[y][x]++;
-		R90 += 2;
-	    }
-	    rowd = row2 + t_d;
-	    cold = col2 - t_d;
-	    if (row + t_d < rows && rowd < wrows &&
-	        col - t_d >= 0 && cold >= 0 &&
-	        grays[rowd][cold] >= 0) {
-		y = bsearch_gray(tone, Ng, grays[rowd][cold]);
-		P_matrix45[x][y]++;
-		P_matrix45[y][x]++;
-		R45 += 2;
-	    }
-	    rowd = row2 + t_d;
-	    cold = col2 + t_d;
-	    if (row + t_d < rows && rowd < wrows &&
-	        col + t_d < cols && cold < wcols &&
-	        grays[rowd][cold] >= 0) {
-		y = bsearch_gray(tone, Ng, grays[rowd][cold]);
-		P_matrix135[x][y]++;
-		P_matrix135[y][x]++;
-		R135 += 2;
-	    }
-	}
+    /* Determine the gray levels present (in ascending order) */
+    mv->Ng = 0;
+    for (x = 0; x <= PGM_MAXMAXVAL; x++) {
+	if (mv->hist[x] > 0)
+	    mv->tone[mv->Ng++] = x;
     }
-    /* Gray-tone spatial dependence matrices are complete */
 
     /* Normalize gray-tone spatial dependence matrix */
-    for (itone = 0; itone < Ng; itone++) {
-	for (jtone = 0; jtone < Ng; jtone++) {
-	    P_matrix0[itone][jtone] /= R0;
-	    P_matrix45[itone][jtone] /= R45;
-	    P_matrix90[itone][jtone] /= R90;
-	    P_matrix135[itone][jtone] /= R135;
+    R0 = mv->R[0];
+    R45 = mv->R[1];
+    R90 = mv->R[2];
+    R135 = mv->R[3];
+    for (itone = 0; itone < mv->Ng; itone++) {
+	x = mv->tone[itone];
+	for (jtone = 0; jtone < mv->Ng; jtone++) {
+	    y = mv->tone[jtone];
+	    mv->P_matrix0[itone][jtone] = mv->count[0][x][y] / R0;
+	    mv->P_matrix45[itone][jtone] = mv->count[1][x][y] / R45;
+	    mv->P_matrix90[itone][jtone] = mv->count[2][x][y] / R90;
+	    mv->P_matrix135[itone][jtone] = mv->count[3][x][y] / R135;
 	}
     }
 
     return 1;
 }
 
-int set_angle_vars(int angle, int have_px, int have_py,
+int set_angle_vars(struct matvec *mv, int angle, int have_px, int have_py,
                    int have_pxpys, int have_pxpyd)
 {
     int i, j;
+    int Ng = mv->Ng;
     float **P;
+    float *px = mv->px, *py = mv->py;
+    float *Pxpys = mv->Pxpys, *Pxpyd = mv->Pxpyd;
 
     switch (angle) {
 	case 0:
-	    P_matrix = P_matrix0;
+	    mv->P_matrix = mv->P_matrix0;
 	break;
 	case 1:
-	    P_matrix = P_matrix45;
+	    mv->P_matrix = mv->P_matrix45;
 	break;
 	case 2:
-	    P_matrix = P_matrix90;
+	    mv->P_matrix = mv->P_matrix90;
 	break;
 	case 3:
-	    P_matrix = P_matrix135;
+	    mv->P_matrix = mv->P_matrix135;
 	break;
     }
 
-    P = P_matrix;
+    P = mv->P_matrix;
 
     /*
      * px[i] is the (i-1)th entry in the marginal probability matrix obtained
@@ -326,72 +338,72 @@ int set_angle_vars(int angle, int have_px, int have_py,
     return 1;
 }
 
-float h_measure(int t_m)
+float h_measure(struct matvec *mv, int t_m)
 {
     switch (t_m) {
 	/* Angular Second Moment */
     case 1:
-	return (f1_asm());
+	return (f1_asm(mv));
 	break;
 
     /* Contrast */
     case 2:
-	return (f2_contrast());
+	return (f2_contrast(mv));
 	break;
 
     /* Correlation */
     case 3:
-	return (f3_corr());
+	return (f3_corr(mv));
 	break;
 
     /* Variance */
     case 4:
-	return (f4_var());
+	return (f4_var(mv));
 	break;
 
     /* Inverse Diff Moment */
     case 5:
-	return (f5_idm());
+	return (f5_idm(mv));
 	break;
 
     /* Sum Average */
     case 6:
-	return (f6_savg());
+	return (f6_savg(mv));
 	break;
 
     /* Sum Variance */
     case 7:
-	return (f7_svar());
+	return (f7_svar(mv));
 	break;
 
     /* Sum Entropy */
     case 8:
-	return (f8_sentropy());
+	return (f8_sentropy(mv));
 	break;
 
     /* Entropy */
     case 9:
-	return (f9_entropy());
+	return (f9_entropy(mv));
 	break;
 
     /* Difference Variance */
     case 10:
-	return (f10_dvar());
+	return (f10_dvar(mv));
 	break;
 
     /* Difference Entropy */
     case 11:
-	return (f11_dentropy());
+	return (f11_dentropy(mv));
 	break;
 
     /* Measure of Correlation-1 */
     case 12:
-	return (f12_icorr());
+	return (f12_icorr(mv));
 	break;
 
     /* Measure of Correlation-2 */
     case 13:
-	return (f13_icorr());
+	return (f13_icorr(mv));
 	break;
     }
 
@@ -415,19 +427,19 @@ void MatrixDealloc(float **A, int N)
  * gray-tone transitions. Hence the P matrix for such an image will have
  * fewer entries of large magnitude.
  */
-float f1_asm(void)
+float f1_asm(struct matvec *mv)
 {
     int i, j;
     float sum = 0;
-    float **P = P_matrix;
+    float **P = mv->P_matrix;
 
     /*
-    for (i = 0; i < Ng; i++)
-	for (j = 0; j < Ng; j++)
+    for (i = 0; i < mv->Ng; i++)
+	for (j = 0; j < mv->Ng; j++)
 	    sum += P[i][j] * P[i][j];
     */
 
-    for (i = 0; i < Ng; i++) {
+    for (i = 0; i < mv->Ng; i++) {
 	sum += P[i][i] * P[i][i];
 	for (j = 0; j < i; j++)
 	    sum += 2 * P[i][j] * P[i][j];
@@ -442,20 +454,20 @@ float f1_asm(void)
  * measure of the contrast or the amount of local variations present in an
  * image.
  */
-float f2_contrast(void)
+float f2_contrast(struct matvec *mv)
 {
     int i, j /*, n */;
     float /* sum,*/ bigsum = 0;
-    float **P = P_matrix;
+    float **P = mv->P_matrix;
 
     /* the three-loop version does not work 
      * when gray tones that do not occur in the current window 
      * have been removed in tone and P* */
     /*
-    for (n = 0; n < Ng; n++) {
+    for (n = 0; n < mv->Ng; n++) {
 	sum = 0;
-	for (i = 0; i < Ng; i++) {
-	    for (j = 0; j < Ng; j++) {
+	for (i = 0; i < mv->Ng; i++) {
+	    for (j = 0; j < mv->Ng; j++) {
 		if ((i - j) == n ||
 		    (j - i) == n) {
 		    sum += P[i][j];
@@ -467,9 +479,9 @@ float f2_contrast(void)
     */
 
     /* two-loop version */
-    for (i = 0; i < Ng; i++) {
+    for (i = 0; i < mv->Ng; i++) {
 	for (j = 0; j < i; j++) {
-	    bigsum += 2 * P[i][j] * (tone[i] - tone[j]) * (tone[i] - tone[j]);
+	    bigsum += 2 * P[i][j] * (mv->tone[i] - mv->tone[j]) * (mv->tone[i] - mv->tone[j]);
 	}
     }
 
@@ -481,12 +493,12 @@ float f2_contrast(void)
  * This correlation feature is a measure of gray-tone linear-dependencies
  * in the image.
  */
-float f3_corr(void)
+float f3_corr(struct matvec *mv)
 {
     int i, j;
     float sum_sqr = 0, tmp = 0;
     float mean = 0, stddev;
-    float **P = P_matrix;
+    float **P = mv->P_matrix;
 
     /* Now calculate the means and standard deviations of px and py */
 
@@ -495,12 +507,12 @@ float f3_corr(void)
     /*- further modified by James Darrell McCauley, 16 Aug 1991
      *     after realizing that meanx=meany and stddevx=stddevy
      */
-    for (i = 0; i < Ng; i++) {
-	mean += px[i] * tone[i];
-	sum_sqr += px[i] * tone[i] * tone[i];
+    for (i = 0; i < mv->Ng; i++) {
+	mean += mv->px[i] * mv->tone[i];
+	sum_sqr += mv->px[i] * mv->tone[i] * mv->tone[i];
 
-	for (j = 0; j < Ng; j++)
-	    tmp += tone[i] * tone[j] * P[i][j];
+	for (j = 0; j < mv->Ng; j++)
+	    tmp += mv->tone[i] * mv->tone[j] * P[i][j];
     }
     stddev = sqrt(sum_sqr - (mean * mean));
     
@@ -511,65 +523,65 @@ float f3_corr(void)
 }
 
 /* Sum of Squares: Variance */
-float f4_var(void)
+float f4_var(struct matvec *mv)
 {
     int i, j;
     float mean = 0, var = 0;
-    float **P = P_matrix;
+    float **P = mv->P_matrix;
 
     /*- Corrected by James Darrell McCauley, 16 Aug 1991
      *  calculates the mean intensity level instead of the mean of
      *  cooccurrence matrix elements
      */
-    for (i = 0; i < Ng; i++)
-	for (j = 0; j < Ng; j++)
-	    mean += tone[i] * P[i][j];
+    for (i = 0; i < mv->Ng; i++)
+	for (j = 0; j < mv->Ng; j++)
+	    mean += mv->tone[i] * P[i][j];
 
-    for (i = 0; i < Ng; i++)
-	for (j = 0; j < Ng; j++)
-	    var += (tone[i] - mean) * (tone[i] - mean) * P[i][j];
+    for (i = 0; i < mv->Ng; i++)
+	for (j = 0; j < mv->Ng; j++)
+	    var += (mv->tone[i] - mean) * (mv->tone[i] - mean) * P[i][j];
 
     return var;
 }
 
 /* Inverse Difference Moment */
-float f5_idm(void)
+float f5_idm(struct matvec *mv)
 {
     int i, j;
     float idm = 0;
-    float **P = P_matrix;
+    float **P = mv->P_matrix;
 
     /*
-    for (i = 0; i < Ng; i++)
-	for (j = 0; j < Ng; j++)
-	    idm += P[i][j] / (1 + (tone[i] - tone[j]) * (tone[i] - tone[j]));
+    for (i = 0; i < mv->Ng; i++)
+	for (j = 0; j < mv->Ng; j++)
+	    idm += P[i][j] / (1 + (mv->tone[i] - mv->tone[j]) * (mv->tone[i] - mv->tone[j]));
     */
 
-    for (i = 0; i < Ng; i++) {
+    for (i = 0; i < mv->Ng; i++) {
 	idm += P[i][i];
 	for (j = 0; j < i; j++)
-	    idm += 2 * P[i][j] / (1 + (tone[i] - tone[j]) * (tone[i] - tone[j]));
+	    idm += 2 * P[i][j] / (1 + (mv->tone[i] - mv->tone[j]) * (mv->tone[i] - mv->tone[j]));
     }
 
     return idm;
 }
 
 /* Sum Average */
-float f6_savg(void)
+float f6_savg(struct matvec *mv)
 {
     int i, j, k;
     float savg = 0;
-    float *P = Pxpys;
+    float *P = mv->Pxpys;
 
     /*
-    for (i = 0; i < 2 * Ng - 1; i++)
+    for (i = 0; i < 2 * mv->Ng - 1; i++)
 	savg += (i + 2) * Pxpys[i];
     */
 
-    for (i = 0; i < Ng; i++) {
-	for (j = 0; j < Ng; j++) {
+    for (i = 0; i < mv->Ng; i++) {
+	for (j = 0; j < mv->Ng; j++) {
 	    k = i + j;
-	    savg += (tone[i] + tone[j]) * P[k];
+	    savg += (mv->tone[i] + mv->tone[j]) * P[k];
 	}
     }
 
@@ -577,23 +589,23 @@ float f6_savg(void)
 }
 
 /* Sum Variance */
-float f7_svar(void)
+float f7_svar(struct matvec *mv)
 {
     int i, j, k;
     float var = 0;
-    float *P = Pxpys;
-    float savg = f6_savg();
+    float *P = mv->Pxpys;
+    float savg = f6_savg(mv);
     float tmp;
 
     /*
-    for (i = 0; i < 2 * Ng - 1; i++)
+    for (i = 0; i < 2 * mv->Ng - 1; i++)
 	var += (i + 2 - savg) * (i + 2 - savg) * Pxpys[i];
     */
 
-    for (i = 0; i < Ng; i++) {
-	for (j = 0; j < Ng; j++) {
+    for (i = 0; i < mv->Ng; i++) {
+	for (j = 0; j < mv->Ng; j++) {
 	    k = i + j;
-	    tmp = tone[i] + tone[j] - savg;
+	    tmp = mv->tone[i] + mv->tone[j] - savg;
 	    var += tmp * tmp * P[k];
 	}
     }
@@ -602,13 +614,13 @@ float f7_svar(void)
 }
 
 /* Sum Entropy */
-float f8_sentropy(void)
+float f8_sentropy(struct matvec *mv)
 {
     int i;
     float sentr = 0;
-    float *P = Pxpys;
+    float *P = mv->Pxpys;
 
-    for (i = 0; i < 2 * Ng - 1; i++) {
+    for (i = 0; i < 2 * mv->Ng - 1; i++) {
 	if (P[i] > 0)
 	    sentr -= P[i] * log2(P[i]);
     }
@@ -617,22 +629,22 @@ float f8_sentropy(void)
 }
 
 /* Entropy */
-float f9_entropy(void)
+float f9_entropy(struct matvec *mv)
 {
     int i, j;
     float entropy = 0;
-    float **P = P_matrix;
+    float **P = mv->P_matrix;
 
     /*
-    for (i = 0; i < Ng; i++) {
-	for (j = 0; j < Ng; j++) {
+    for (i = 0; i < mv->Ng; i++) {
+	for (j = 0; j < mv->Ng; j++) {
 	    if (P[i][j] > 0)
 		entropy += P[i][j] * log2(P[i][j]);
 	}
     }
     */
 
-    for (i = 0; i < Ng; i++) {
+    for (i = 0; i < mv->Ng; i++) {
 	if (P[i][i] > 0)
 	    entropy += P[i][i] * log2(P[i][i]);
 	for (j = 0; j < i; j++) {
@@ -645,20 +657,20 @@ float f9_entropy(void)
 }
 
 /* Difference Variance */
-float f10_dvar(void)
+float f10_dvar(struct matvec *mv)
 {
     int i, tmp;
     float sum = 0, sum_sqr = 0, var = 0;
-    float *P = Pxpyd;
+    float *P = mv->Pxpyd;
 
     /* Now calculate the variance of Pxpy (Px-y) */
-    for (i = 0; i < Ng; i++) {
+    for (i = 0; i < mv->Ng; i++) {
 	sum += P[i];
 	sum_sqr += P[i] * P[i];
     }
-    /* tmp = Ng * Ng; */
-    if (Ng > 1) {
-	tmp = (tone[Ng - 1] - tone[0]) * (tone[Ng - 1] - tone[0]);
+    /* tmp = mv->Ng * mv->Ng; */
+    if (mv->Ng > 1) {
+	tmp = (mv->tone[mv->Ng - 1] - mv->tone[0]) * (mv->tone[mv->Ng - 1] - mv->tone[0]);
 	var = ((tmp * sum_sqr) - (sum * sum)) / (tmp * tmp);
     }
 
@@ -666,13 +678,13 @@ float f10_dvar(void)
 }
 
 /* Difference Entropy */
-float f11_dentropy(void)
+float f11_dentropy(struct matvec *mv)
 {
     int i;
     float sum = 0;
-    float *P = Pxpyd;
+    float *P = mv->Pxpyd;
 
-    for (i = 0; i < Ng; i++) {
+    for (i = 0; i < mv->Ng; i++) {
 	if (P[i] > 0)
 	    sum += P[i] * log2(P[i]);
     }
@@ -681,25 +693,25 @@ float f11_dentropy(void)
 }
 
 /* Information Measures of Correlation */
-float f12_icorr(void)
+float f12_icorr(struct matvec *mv)
 {
     int i, j;
     float hx = 0, hy = 0, hxy = 0, hxy1 = 0;
-    float **P = P_matrix;
+    float **P = mv->P_matrix;
 
-    for (i = 0; i < Ng; i++) {
-	for (j = 0; j < Ng; j++) {
-	    if (px[i] * py[j] > 0)
-		hxy1 -= P[i][j] * log2(px[i] * py[j]);
+    for (i = 0; i < mv->Ng; i++) {
+	for (j = 0; j < mv->Ng; j++) {
+	    if (mv->px[i] * mv->py[j] > 0)
+		hxy1 -= P[i][j] * log2(mv->px[i] * mv->py[j]);
 	    if (P[i][j] > 0)
 		hxy -= P[i][j] * log2(P[i][j]);
 	}
 
     /* Calculate entropies of px and py - is this right? */
-	if (px[i] > 0)
-	    hx -= px[i] * log2(px[i]);
-	if (py[i] > 0)
-	    hy -= py[i] * log2(py[i]);
+	if (mv->px[i] > 0)
+	    hx -= mv->px[i] * log2(mv->px[i]);
+	if (mv->py[i] > 0)
+	    hy -= mv->py[i] * log2(mv->py[i]);
     }
 
     /* fprintf(stderr,"hxy1=%f\thxy=%f\thx=%f\thy=%f\n",hxy1,hxy,hx,hy); */
@@ -710,16 +722,16 @@ float f12_icorr(void)
 }
 
 /* Information Measures of Correlation */
-float f13_icorr(void)
+float f13_icorr(struct matvec *mv)
 {
     int i, j;
     float hxy = 0, hxy2 = 0;
-    float **P = P_matrix;
+    float **P = mv->P_matrix;
 
-    for (i = 0; i < Ng; i++) {
-	for (j = 0; j < Ng; j++) {
-	    if (px[i] * py[j] > 0)
-		hxy2 -= px[i] * py[j] * log2(px[i] * py[j]);
+    for (i = 0; i < mv->Ng; i++) {
+	for (j = 0; j < mv->Ng; j++) {
+	    if (mv->px[i] * mv->py[j] > 0)
+		hxy2 -= mv->px[i] * mv->py[j] * log2(mv->px[i] * mv->py[j]);
 	    if (P[i][j] > 0)
 		hxy -= P[i][j] * log2(P[i][j]);
 	}
@@ -23,9 +23,36 @@
  *
  *****************************************************************************/
 
-float h_measure(int);
-void alloc_vars(int);
-int set_vars(int **grays, int curr_rrow, int curr_col,
-                int size, int offset, int t_d, int with_nulls);
-int set_angle_vars(int angle, int have_px, int have_py,
+#define PGM_MAXMAXVAL 255
+
+/* state of the moving window, one per thread */
+struct matvec
+{
+    int size, offset, dist;	/* window size, half size and distance */
+    int wrows, wcols;		/* image size */
+    /* gray values in the window and their number, the co-occurrence
+     * counts of the gray values and their total for each angle,
+     * updated as the window moves along a row */
+    int hist[PGM_MAXMAXVAL + 1];
+    int cnt;
+    int count[4][PGM_MAXMAXVAL + 1][PGM_MAXMAXVAL + 1];
+    int R[4];
+    /* gray levels present in the window (in ascending order) and the
+     * normalized co-occurrence matrices in terms of these levels */
+    int tone[PGM_MAXMAXVAL + 1];
+    int Ng;
+    float **P_matrix0, **P_matrix45, **P_matrix90, **P_matrix135;
+    float **P_matrix;		/* matrix of the current angle */
+    float *px, *py;
+    float Pxpys[2 * PGM_MAXMAXVAL + 2];
+    float Pxpyd[2 * PGM_MAXMAXVAL + 2];
+};
+
+float h_measure(struct matvec *, int);
+struct matvec *alloc_vars(int size, int dist);
+void free_vars(struct matvec *);
+void start_window(struct matvec *, int **grays, int curr_row, int curr_col);
+void move_window(struct matvec *, int **grays, int curr_row, int curr_col);
+int set_vars(struct matvec *, int with_nulls);
+int set_angle_vars(struct matvec *, int angle, int have_px, int have_py,
                    int have_pxpys, int have_pxpyd);
@@ -30,6 +30,8 @@
 #include <grass/glocale.h>
 #include "h_measure.h"
 
+#define BLOCK_ROWS 4
+
 struct menu
 {
     char *name;			/* measure name */
@@ -57,6 +59,77 @@ static struct menu menu[] = {
     {NULL, NULL, NULL, 0, -1}
 };
 
+/* a block of output rows, computed by several threads */
+struct block
+{
+    int **data;			/* input image */
+    int row0;			/* first row of the block */
+    int first_col, last_col;
+    int with_nulls;
+    int n_measures;
+    int *measure;		/* index of each measure for h_measure() */
+    int separate;		/* output for each angle separately */
+    int have_px, have_py, have_pxpys, have_pxpyd;
+    FCELL ***out;		/* output rows of each row of the block */
+    int n_outputs, ncols;
+    int chunk;
+    struct matvec **mv;		/* window state of each thread */
+};
+
+static void texture_rows(int first, int last, void *closure)
+{
+    struct block *b = closure;
+    struct matvec *mv = b->mv[first / b->chunk];
+    int row, col, i, j;
+    FCELL measure;
+
+    for (row = first; row < last; row++) {
+	FCELL **fbuf = b->out[row];
+
+	for (i = 0; i < b->n_outputs; i++)
+	    Rast_set_f_null_value(fbuf[i], b->ncols);
+
+	/*process the data */
+	for (col = b->first_col; col < b->last_col; col++) {
+
+	    /* the co-occurrences are counted once per row and updated as
+	     * the window moves by one column */
+	    if (col == b->first_col)
+		start_window(mv, b->data, b->row0 + row, col);
+	    else
+		move_window(mv, b->data, b->row0 + row, col);
+
+	    if (!set_vars(mv, b->with_nulls))
+		continue;
+
+	    /* for all angles (0, 45, 90, 135) */
+	    for (i = 0; i < 4; i++) {
+		set_angle_vars(mv, i, b->have_px, b->have_py,
+			       b->have_pxpys, b->have_pxpyd);
+		/* for all requested textural measures */
+		for (j = 0; j < b->n_measures; j++) {
+
+		    measure = (FCELL) h_measure(mv, b->measure[j]);
+
+		    if (b->separate) {
+			/* output for each angle separately */
+			fbuf[j * 4 + i][col] = measure;
+		    }
+		    else {
+			/* use average over all angles for each measure */
+			if (i == 0)
+			    fbuf[j][col] = measure;
+			else if (i < 3)
+			    fbuf[j][col] += measure;
+			else 
+			    fbuf[j][col] = (fbuf[j][col] + measure) / 4.0;
+		    }
+		}
+	    }
+	}
+    }
+}
+
 static int find_measure(const char *measure_name)
 {
     int i;
@@ -75,16 +148,15 @@ int main(int argc, char *argv[])
     struct Cell_head cellhd;
     char *name, *result;
     char **mapname;
-    FCELL **fbuf;
+    FCELL *null_row;
     int n_measures, n_outputs, *measure_idx, overwrite;
     int nrows, ncols;
-    int row, col, first_row, last_row, first_col, last_col;
-    int i, j;
+    int row, first_row, last_row, first_col, last_col;
+    int i, j, n, nprocs, nblock;
     CELL **data;		/* Data structure containing image */
     DCELL *dcell_row;
     struct FPRange range;
     DCELL min, max, inscale;
-    FCELL measure;		/* Containing measure done */
     int dist, size;	/* dist = value of distance, size = s. of moving window */
     int offset;
     int have_px, have_py, have_pxpys, have_pxpyd;
@@ -92,8 +164,10 @@ int main(int argc, char *argv[])
     RASTER_MAP_TYPE out_data_type;
     struct GModule *module;
     struct Option *opt_input, *opt_output, *opt_size, *opt_dist, *opt_measure;
+    struct Option *opt_nprocs;
     struct Flag *flag_ind, *flag_all, *flag_null;
     struct History history;
+    struct block blk;
     char p[1024];
 
     G_gisinit(argv[0]);
@@ -146,6 +220,8 @@ int main(int argc, char *argv[])
     opt_measure->options = p;
     opt_measure->description = _("Textural measurement method");
 
+    opt_nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag_ind = G_define_flag();
     flag_ind->key = 's';
     flag_ind->label = _("Separate output for each angle (0, 45, 90, 135)");
@@ -176,6 +252,7 @@ int main(int argc, char *argv[])
 	G_fatal_error(_("The distance between two samples must be > 0"));
     if (dist >= size)
 	G_fatal_error(_("The distance between two samples must be smaller than the size of the moving window"));
+    nprocs = G_set_nprocs(opt_nprocs);
 
     n_measures = 0;
     if (flag_all->answer) {
@@ -236,11 +313,10 @@ int main(int argc, char *argv[])
 	n_outputs = n_measures * 4;
     }
 
-    fbuf = G_malloc(n_outputs * sizeof(FCELL *));
+    null_row = Rast_allocate_buf(out_data_type);
     mapname = G_malloc(n_outputs * sizeof(char *));
     for (i = 0; i < n_outputs; i++) {
 	mapname[i] = G_malloc(GNAME_MAX * sizeof(char));
-	fbuf[i] = Rast_allocate_buf(out_data_type);
     }
     
     overwrite = G_check_overwrite(argc, argv);
@@ -309,6 +385,10 @@ int main(int argc, char *argv[])
 	    }
 	    else
 		data[j][i] = (CELL)dcell_row[i];
+	    if (data[j][i] > PGM_MAXMAXVAL)
+		G_fatal_error(_("Too many categories (found: %i, max: %i). "
+				"Try to rescale or reclassify the map"),
+			      data[j][i], PGM_MAXMAXVAL);
 	}
     }
 
@@ -340,11 +420,11 @@ int main(int argc, char *argv[])
 	last_col = ncols;
     }
 
-    Rast_set_f_null_value(fbuf[0], ncols);
+    Rast_set_f_null_value(null_row, ncols);
 
     for (row = 0; row < first_row; row++) {
 	for (i = 0; i < n_outputs; i++) {
-	    Rast_put_row(outfd[i], fbuf[0], out_data_type);
+	    Rast_put_row(outfd[i], null_row, out_data_type);
 	}
     }
     if (n_measures > 1)
@@ -352,54 +432,68 @@ int main(int argc, char *argv[])
         "Calculating %d texture measures", n_measures), n_measures);
     else
 	G_message(_("Calculating %s..."), menu[measure_idx[0]].desc);
-    alloc_vars(size);
-    for (row = first_row; row < last_row; row++) {
-	G_percent(row, nrows, 2);
 
+    /* rows are computed in blocks, each block is shared among nprocs
+     * threads, each with its own window state */
+    nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    blk.data = data;
+    blk.first_col = first_col;
+    blk.last_col = last_col;
+    blk.with_nulls = flag_null->answer;
+    blk.n_measures = n_measures;
+    blk.measure = G_malloc(n_measures * sizeof(int));
+    for (j = 0; j < n_measures; j++)
+	blk.measure[j] = menu[measure_idx[j]].idx;
+    blk.separate = flag_ind->answer;
+    blk.have_px = have_px;
+    blk.have_py = have_py;
+    blk.have_pxpys = have_pxpys;
+    blk.have_pxpyd = have_pxpyd;
+    blk.n_outputs = n_outputs;
+    blk.ncols = ncols;
+    blk.chunk = (nblock + nprocs - 1) / nprocs;
+    blk.out = G_malloc(nblock * sizeof(FCELL **));
+    for (row = 0; row < nblock; row++) {
+	blk.out[row] = G_malloc(n_outputs * sizeof(FCELL *));
 	for (i = 0; i < n_outputs; i++)
-	    Rast_set_f_null_value(fbuf[i], ncols);
-
-	/*process the data */
-	for (col = first_col; col < last_col; col++) {
+	    blk.out[row][i] = Rast_allocate_buf(out_data_type);
+    }
+    blk.mv = G_malloc(nprocs * sizeof(struct matvec *));
+    for (i = 0; i < nprocs; i++)
+	blk.mv[i] = alloc_vars(size, dist);
 
-	    if (!set_vars(data, row, col, size, offset, dist, flag_null->answer)) {
-		for (i = 0; i < n_outputs; i++)
-		    Rast_set_f_null_value(&(fbuf[i][col]), 1);
-		continue;
-	    }
+    for (row = first_row; row < last_row; row += n) {
+	G_percent(row, nrows, 2);
 
-	    /* for all angles (0, 45, 90, 135) */
-	    for (i = 0; i < 4; i++) {
-		set_angle_vars(i, have_px, have_py, have_pxpys, have_pxpyd);
-		/* for all requested textural measures */
-		for (j = 0; j < n_measures; j++) {
+	n = last_row - row;
+	if (n > nblock)
+	    n = nblock;
 
-		    measure = (FCELL) h_measure(menu[measure_idx[j]].idx);
+	blk.row0 = row;
+	G_parallel_for(0, n, blk.chunk, texture_rows, &blk);
 
-		    if (flag_ind->answer) {
-			/* output for each angle separately */
-			fbuf[j * 4 + i][col] = measure;
-		    }
-		    else {
-			/* use average over all angles for each measure */
-			if (i == 0)
-			    fbuf[j][col] = measure;
-			else if (i < 3)
-			    fbuf[j][col] += measure;
-			else 
-			    fbuf[j][col] = (fbuf[j][col] + measure) / 4.0;
-		    }
-		}
+	for (j = 0; j < n; j++) {
+	    for (i = 0; i < n_outputs; i++) {
+		Rast_put_row(outfd[i], blk.out[j][i], out_data_type);
 	    }
 	}
-	for (i = 0; i < n_outputs; i++) {
-	    Rast_put_row(outfd[i], fbuf[i], out_data_type);
-	}
     }
-    Rast_set_f_null_value(fbuf[0], ncols);
+
+    for (i = 0; i < nprocs; i++)
+	free_vars(blk.mv[i]);
+    G_free(blk.mv);
+    for (row = 0; row < nblock; row++) {
+	for (i = 0; i < n_outputs; i++)
+	    G_free(blk.out[row][i]);
+	G_free(blk.out[row]);
+    }
+    G_free(blk.out);
+    G_free(blk.measure);
+
+    Rast_set_f_null_value(null_row, ncols);
     for (row = last_row; row < nrows; row++) {
 	for (i = 0; i < n_outputs; i++) {
-	    Rast_put_row(outfd[i], fbuf[0], out_data_type);
+	    Rast_put_row(outfd[i], null_row, out_data_type);
 	}
     }
     G_percent(nrows, nrows, 1);
@@ -410,10 +504,9 @@ int main(int argc, char *argv[])
 	Rast_short_history(mapname[i], "raster", &history);
 	Rast_command_history(&history);
 	Rast_write_history(mapname[i], &history);
-	G_free(fbuf[i]);
     }
 
-    G_free(fbuf);
+    G_free(null_row);
     G_free(data);
 
     exit(EXIT_SUCCESS);
@@ -12,6 +12,7 @@
  *
  *****************************************************************************/
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -19,13 +20,17 @@
 
 static struct
 {
-    struct Option *rastin, *rastout, *width, *height, *overlap;
+    struct Option *rastin, *rastout, *width, *height, *overlap, *vrt,
+	*nprocs;
 } parm;
 static struct Cell_head dst_w, src_w, ovl_w;
 static int xtiles, ytiles;
 static RASTER_MAP_TYPE map_type;
+static struct Colors colors;
+static struct Categories cats;
 
 static void write_support_files(int xtile, int ytile, int overlap);
+static void write_vrt(const char *output, int overlap);
 
 int main(int argc, char *argv[])
 {
@@ -33,7 +38,7 @@ int main(int argc, char *argv[])
     int infile;
     const char *mapset;
     size_t cell_size;
-    int ytile, xtile, y, overlap;
+    int ytile, xtile, y, overlap, nprocs;
     int *outfiles;
     void *inbuf;
 
@@ -75,9 +80,19 @@ int main(int argc, char *argv[])
     parm.overlap->multiple = NO;
     parm.overlap->description = _("Overlap of tiles");
 
+    parm.vrt = G_define_standard_option(G_OPT_R_OUTPUT);
+    parm.vrt->key = "vrt";
+    parm.vrt->required = NO;
+    parm.vrt->description =
+	_("Name for output virtual raster map of all tiles");
+
+    parm.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    nprocs = G_set_nprocs(parm.nprocs);
+
     G_get_set_window(&src_w);
     overlap = parm.overlap->answer ? atoi(parm.overlap->answer) : 0;
 
@@ -121,6 +136,19 @@ int main(int argc, char *argv[])
 
     inbuf = Rast_allocate_input_buf(map_type);
 
+    /* support files are the same for all tiles */
+    if (Rast_read_cats(parm.rastin->answer, "", &cats) < 0)
+	G_fatal_error(_("Unable to read cats for %s"),
+		      parm.rastin->answer);
+    if (Rast_read_colors(parm.rastin->answer, "", &colors) < 0)
+	G_fatal_error(_("Unable to read color table for %s"),
+		      parm.rastin->answer);
+    if (map_type != CELL_TYPE)
+	Rast_mark_colors_as_fp(&colors);
+
+    if (nprocs > 1)
+	Rast_set_read_ahead(infile, nprocs);
+
     outfiles = G_malloc(xtiles * sizeof(int));
 
     G_debug(1, "X: %d * %d, Y: %d * %d",
@@ -134,6 +162,10 @@ int main(int argc, char *argv[])
 	    char name[GNAME_MAX];
 	    sprintf(name, "%s-%03d-%03d", parm.rastout->answer, ytile, xtile);
 	    outfiles[xtile] = Rast_open_new(name, map_type);
+	    /* the rows of all tiles are compressed by the workers while
+	     * the next input rows are read */
+	    if (nprocs > 1)
+		Rast_set_write_behind(outfiles[xtile], nprocs);
 	}
 	
 	for (y = 0; y < ovl_w.rows; y++) {
@@ -141,6 +173,7 @@ int main(int argc, char *argv[])
 	    G_debug(1, "reading row: %d", row);
 	    Rast_get_row(infile, inbuf, row, map_type);
 	    
+	    /* the tiles are written directly from the input row */
 	    for (xtile = 0; xtile < xtiles; xtile++) {
 		int cells = xtile * dst_w.cols;
 		void *ptr = G_incr_void_ptr(inbuf, cells * cell_size);
@@ -154,8 +187,15 @@ int main(int argc, char *argv[])
 	}
     }
 
+    G_percent(ytiles, ytiles, 2);
+
+    if (nprocs > 1)
+	Rast_set_read_ahead(infile, 0);
     Rast_close(infile);
 
+    if (parm.vrt->answer)
+	write_vrt(parm.vrt->answer, overlap);
+
     return EXIT_SUCCESS;
 }
 
@@ -165,8 +205,6 @@ static void write_support_files(int xtile, int ytile, int overlap)
     struct Cell_head cellhd;
     char title[64];
     struct History history;
-    struct Colors colors;
-    struct Categories cats;
 
     sprintf(name, "%s-%03d-%03d", parm.rastout->answer, ytile, xtile);
 
@@ -183,9 +221,6 @@ static void write_support_files(int xtile, int ytile, int overlap)
     Rast_put_cellhd(name, &cellhd);
 
     /* copy cats from source map */
-    if (Rast_read_cats(parm.rastin->answer, "", &cats) < 0)
-	G_fatal_error(_("Unable to read cats for %s"),
-		      parm.rastin->answer);
     Rast_write_cats(name, &cats);
 
     /* record map metadata/history info */
@@ -199,11 +234,105 @@ static void write_support_files(int xtile, int ytile, int overlap)
     Rast_write_history(name, &history);
 
     /* copy color table from source map */
-    if (Rast_read_colors(parm.rastin->answer, "", &colors) < 0)
-	G_fatal_error(_("Unable to read color table for %s"),
-		      parm.rastin->answer);
-    if (map_type != CELL_TYPE)
-	Rast_mark_colors_as_fp(&colors);
     Rast_write_colors(name, G_mapset(), &colors);
 }
 
+/* link all tiles to a virtual raster map like r.buildvrt does */
+static void write_vrt(const char *output, int overlap)
+{
+    struct Cell_head cellhd;
+    struct History history;
+    struct Categories vcats;
+    struct FPRange fprange;
+    struct Key_Value *key_val;
+    struct Quant quant;
+    char name[GNAME_MAX], buf[1024];
+    int xtile, ytile;
+    FILE *fp;
+
+    G_message(_("Creating virtual raster map <%s>..."), output);
+
+    /* union of the tiles */
+    cellhd = src_w;
+    cellhd.rows = ytiles * dst_w.rows + 2 * overlap;
+    cellhd.cols = xtiles * dst_w.cols + 2 * overlap;
+    cellhd.south = cellhd.north - cellhd.rows * src_w.ns_res;
+    cellhd.east = cellhd.west + cellhd.cols * src_w.ew_res;
+    G_adjust_Cell_head(&cellhd, 1, 1);
+    cellhd.compressed = 0;
+    cellhd.format = map_type == CELL_TYPE ? 3 : -1;
+    Rast_put_cellhd(output, &cellhd);
+
+    /* empty cell and fcell files */
+    fp = G_fopen_new("cell", output);
+    if (!fp)
+	G_fatal_error(_("Unable to create cell/%s file"), output);
+    fclose(fp);
+    if (map_type != CELL_TYPE) {
+	fp = G_fopen_new("fcell", output);
+	if (!fp)
+	    G_fatal_error(_("Unable to create fcell/%s file"), output);
+	fclose(fp);
+    }
+
+    /* tiles from N to S and from W to E */
+    fp = G_fopen_new_misc("cell_misc", "vrt", output);
+    if (!fp)
+	G_fatal_error(_("Unable to create cell_misc/%s/vrt file"), output);
+    for (ytile = 0; ytile < ytiles; ytile++) {
+	for (xtile = 0; xtile < xtiles; xtile++) {
+	    sprintf(name, "%s-%03d-%03d", parm.rastout->answer, ytile, xtile);
+	    fprintf(fp, "%s@%s\n", name, G_mapset());
+	}
+    }
+    fclose(fp);
+
+    /* the tiles hold the values of the input map and nulls */
+    Rast_read_fp_range(parm.rastin->answer, "", &fprange);
+    if (map_type == CELL_TYPE) {
+	struct Range range;
+
+	Rast_init_range(&range);
+	if (!Rast_is_d_null_value(&fprange.min)) {
+	    Rast_update_range((CELL)fprange.min, &range);
+	    Rast_update_range((CELL)fprange.max, &range);
+	}
+	Rast_write_range(output, &range);
+    }
+    else {
+	Rast_write_fp_range(output, &fprange);
+
+	key_val = G_create_key_value();
+	G_set_key_value("type", map_type == FCELL_TYPE ? "float" : "double",
+			key_val);
+	G_set_key_value("byte_order", "xdr", key_val);
+	fp = G_fopen_new_misc("cell_misc", "f_format", output);
+	if (!fp)
+	    G_fatal_error(_("Unable to create cell_misc/%s/f_format file"),
+			  output);
+	if (G_fwrite_key_value(fp, key_val) < 0)
+	    G_fatal_error(_("Error writing cell_misc/%s/f_format file"),
+			  output);
+	fclose(fp);
+	G_free_key_value(key_val);
+
+	Rast_quant_init(&quant);
+	Rast_quant_round(&quant);
+	Rast_write_quant(output, G_mapset(), &quant);
+    }
+    G_remove_misc("cell_misc", "stats", output);
+
+    Rast_short_history(output, "virtual", &history);
+    Rast_command_history(&history);
+    Rast_format_history(&history, HIST_KEYWRD,
+			_("virtual raster generated by %s"),
+			G_program_name());
+    sprintf(buf, "%d raster maps", xtiles * ytiles);
+    Rast_set_history(&history, HIST_DATSRC_1, buf);
+    Rast_write_history(output, &history);
+
+    Rast_write_colors(output, G_mapset(), &colors);
+    Rast_init_cats(NULL, &vcats);
+    Rast_write_cats(output, &vcats);
+}
+
@@ -38,6 +38,9 @@ class TestRasterTile(TestCase):
         cls.runModule('g.remove', type='raster', flags='f', name=cls.output_prefix + 'overlap' + '-001-000')
         cls.runModule('g.remove', type='raster', flags='f', name=cls.output_prefix + 'overlap' + '-001-001')
 
+        cls.runModule('g.remove', type='raster', flags='f', name=cls.output_prefix + 'vrt')
+        cls.runModule('g.remove', type='raster', flags='f', pattern=cls.output_prefix + 'vrt-*')
+
     def test_raster_tile(self):
         """Testing r.tile runs successfully"""
         self.assertModule('r.tile', input=self.input, output=self.output_prefix, width=self.width, height=self.height)
@@ -59,6 +62,11 @@ class TestRasterTile(TestCase):
         self.assertRasterExists(self.output_prefix+'overlap'+'-001-001', msg="lakes_tile-001-001 does not exits")
 
 
+    def test_raster_tile_vrt(self):
+        """Testing r.tile with virtual raster of the tiles"""
+        self.assertModule('r.tile', input=self.input, output=self.output_prefix+'vrt', width=self.width, height=self.height, vrt=self.output_prefix+'vrt', nprocs=2)
+        self.assertRasterExists(self.output_prefix+'vrt', msg="virtual raster lakes_tilevrt does not exist")
+        self.assertRastersNoDifference(actual=self.output_prefix+'vrt', reference=self.input, precision=0)
 
 
 if __name__ == '__main__':
@@ -30,17 +30,20 @@
  * area.  The left end of this strip will be used as the position of the
  * label in the dlg label file.
  * 
- * Global variables:
+ * The state of the extraction is kept in a band structure (global.h), so
+ * that bands of rows can be traced on several threads.  A line crossing
+ * the seam between two bands ends there at a point marked as seam in
+ * both bands; the pieces are joined at these points when the bands are
+ * merged in order, and the areas on both sides of the seam are made
+ * equivalent.  The joined boundaries are the same as with one band.
+ *
+ * Band variables:
  *   v_list          pointer to allocated array of pointers to endpoints of
  *                   vertical lines currently under construction
  *   h_ptr           pointer to endpoint of horizontal line currently
  *                   under construction
  *   col, row        column and row of current position in file
- *   buffer[]        pointers to the two allocated areas which hold the
- *                   two rows currently being processed
- *   top, bottom     which row of buffer[] is "top" line from file and
- *                   which is "bottom"
- *   scan_length     length of a row from the data file
+ *   top, bottom     the two rows currently being processed
  *   tl, tr, bl, br  top left and right, bottom left and right elements
  *                   in current 2 by 2 data window; one-time calculation
  *                   prevents multiple indexing and indirection
@@ -55,17 +58,24 @@
  *                   mapping of all equivalent area numbers onto one
  *                   number from the class
  *   n_equiv         current length of e_list
+ *
+ * Global variables:
+ *   buffer[]        pointers to the two allocated areas which hold the
+ *                   two rows currently being processed with one band
+ *   top, bottom     which row of buffer[] is "top" line from file and
+ *                   which is "bottom"
+ *   scan_length     length of a row from the data file
  * 
  * Entry points:
  *   extract_areas   driver for boundary extraction, area labelling
  *                   algorithm
- *   alloc_bufs      allocate buffers for raster map data and storage of
- *                   information obtained in the extraction process (v_list,
- *                   a_list, e_list, buffer[0], buffer[1])
+ *   alloc_bufs      allocate buffers for raster map data (buffer[0],
+ *                   buffer[1])
  *
  ********************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -73,31 +83,63 @@
 #include <grass/dbmi.h>
 #include "global.h"
 
-static int col, row, top, bottom;
-static double tl, tr, bl, br;
-static struct COOR **v_list;
-static struct COOR *h_ptr;
+/* size of the bands traced on several threads */
+#define BAND_CELLS (1 << 20)
+#define BAND_MIN_ROWS 16
+
+static int top, bottom;
 static void *buffer[2];
 static int scan_length;
-static int n_areas, area_num, n_equiv, tl_area;
-static struct area_table *a_list, *a_list_new, *a_list_old;
-static struct equiv_table *e_list;
+
+/* bands of a block of rows */
+struct block
+{
+    struct band *bands;
+    int n_bands;
+    void **rows;		/* rows[i] is row first_row + i */
+    int first_row;
+};
+
+/* areas and pieces of the merged bands */
+static struct area_table *m_areas;
+static int *m_parent;
+static int m_n_areas, m_alloc_areas;
+static struct piece **seam_piece, **next_piece;	/* pieces at the last */
+static int *seam_end, *next_end;	/*   and the next seam, by column */
 
 /* function prototypes */
-static int update_list(int);
-static int end_vline();
-static int end_hline();
-static int start_vline();
-static int start_hline();
-static struct COOR *get_ptr();
-static int read_next();
-static int equiv_areas(int, int);
-static int map_area(int, int);
-static int add_to_list(int, int);
-static int assign_area(double, int);
-static int more_areas();
-static int update_width(struct area_table *, int);
-static int nabors(void);
+static int extract_band_areas(void);
+static void trace_bands(int, int, void *);
+static void read_band_row(void *, int);
+static void start_seam(struct band *, void *);
+static void end_seam(struct band *);
+static void merge_band(struct band *, struct band *);
+static int find_area(int);
+static void join_areas(int, int);
+static void join_pieces(struct piece *, int, struct piece *, int);
+static struct piece *find_piece(struct piece *);
+static void write_chain(struct piece *);
+static void free_piece(struct piece *);
+static void band_init(struct band *, int, int);
+static void band_free(struct band *);
+static void trace_row(struct band *, void *, void *);
+static int update_list(struct band *, int);
+static int end_vline(struct band *);
+static int end_hline(struct band *);
+static int start_vline(struct band *);
+static int start_hline(struct band *);
+static struct COOR *get_ptr(struct band *);
+static int release_ptr(struct band *, struct COOR *);
+static int read_next(void);
+static int equiv_areas(struct band *, int, int);
+static int map_area(struct band *, int, int);
+static int add_to_list(struct band *, int, int);
+static int assign_area(struct band *, double, int);
+static int more_areas(struct band *);
+static int more_equivs(struct band *);
+static int update_width(struct band *, struct area_table *, int);
+static int nabors(struct band *);
+static int differ(double, double);
 
 #define get_raster_value(ptr, col) \
 	Rast_get_d_value(G_incr_void_ptr(ptr, (col)*data_size), data_type)
@@ -106,59 +148,552 @@ static int nabors(void);
 
 int extract_areas(void)
 {
-    double nullVal;
-    int i;
+    struct band b;
 
-    row = col = top = 0;	/* get started for read of first */
-    bottom = 1;			/* line from raster map */
-    area_num = 0;
-    tl_area = 0;
-    n_alloced_ptrs = 0;
-
-    Rast_set_d_null_value(&nullVal, 1);
-    /* represents the "outside", the external null values */
-    assign_area(nullVal, 0);
+    row_length = cell_head.cols;
+    scan_length = row_length + 2;
 
     G_message(_("Extracting areas..."));
 
-    scan_length = read_next();
-    while (read_next()) {	/* read rest of file, one row at *//*   a time */
-	G_percent(row, n_rows + 1, 2);
-
-	for (col = 0; col < scan_length - 1; col++) {
-	    tl = get_raster_value(buffer[top], col);	/* top left in window */
-	    tr = get_raster_value(buffer[top], col + 1);	/* top right */
-	    bl = get_raster_value(buffer[bottom], col);	/* bottom left */
-	    br = get_raster_value(buffer[bottom], col + 1);	/* bottom right */
-	    update_list(nabors());
-	}
+    if (extract_band_areas())
+	return 0;
 
-	if (h_ptr != NULPTR)	/* if we have a loose end, */
-	    end_hline();	/*   tie it down */
+    /* one band, the lines are written while they are traced */
+    top = 0;			/* get started for read of first */
+    bottom = 1;			/* line from raster map */
+    band_init(&b, 0, n_rows + 1);
+    b.stream = 1;
 
-	row++;
+    scan_length = read_next();
+    while (read_next()) {	/* read rest of file, one row at *//*   a time */
+	G_percent(b.row, n_rows + 1, 2);
+	trace_row(&b, buffer[top], buffer[bottom]);
     }
     G_percent(1, 1, 1);
 
-    write_area(a_list, e_list, area_num, n_equiv);
+    write_area(b.a_list, b.e_list, b.area_num, b.n_equiv);
 
-    G_free(a_list);
-    for (i = 0; i < n_equiv; i++) {
-	if (e_list[i].ptr)
-	    G_free(e_list[i].ptr);
+    if (b.n_alloced_ptrs) {
+	/* should not happen */
+	G_warning("Memory leak: %d points are still in use", b.n_alloced_ptrs);
     }
-    G_free(e_list);
-    G_free(v_list);
+
+    band_free(&b);
     G_free(buffer[0]);
     G_free(buffer[1]);
 
-    if (n_alloced_ptrs) {
+    return 0;
+}				/* extract_areas */
+
+/* extract_band_areas - trace boundaries in bands of rows on several */
+/* threads; returns 0 if the map is traced as one band */
+
+static int extract_band_areas(void)
+{
+    struct block blk;
+    struct band prev;
+    int band_rows, max_bands, n_bands, i, r, r0, r1;
+    size_t row_size;
+
+    band_rows = BAND_CELLS / scan_length;
+    if (band_rows < BAND_MIN_ROWS)
+	band_rows = BAND_MIN_ROWS;
+
+    /* rows of windows are 0 to n_rows, row i is between cells of the */
+    /* rows i - 1 and i */
+    n_bands = (n_rows + band_rows) / band_rows;
+    if (G_num_workers() == 0 || n_bands < 2)
+	return 0;
+
+    G_debug(1, "%d bands of %d rows", n_bands, band_rows);
+
+    max_bands = 2 * (G_num_workers() + 1);
+    row_size = (size_t)scan_length * data_size;
+    blk.bands = G_calloc(max_bands, sizeof(struct band));
+    blk.rows = G_malloc((max_bands * band_rows + 1) * sizeof(void *));
+    blk.rows[0] = G_malloc((max_bands * band_rows + 1) * row_size);
+    for (i = 1; i < max_bands * band_rows + 1; i++)
+	blk.rows[i] = G_incr_void_ptr(blk.rows[i - 1], row_size);
+
+    m_areas = NULL;
+    m_parent = NULL;
+    m_n_areas = m_alloc_areas = 0;
+    seam_piece = G_calloc(scan_length, sizeof(struct piece *));
+    next_piece = G_calloc(scan_length, sizeof(struct piece *));
+    seam_end = G_calloc(scan_length, sizeof(int));
+    next_end = G_calloc(scan_length, sizeof(int));
+    prev.bottom_left = prev.bottom_right = NULL;
+    prev.area_offset = 0;
+
+    for (r0 = 0; r0 <= n_rows; r0 = r1) {
+	G_percent(r0, n_rows + 1, 2);
+
+	blk.n_bands = 0;
+	for (r1 = r0; r1 <= n_rows && blk.n_bands < max_bands;
+	     r1 += band_rows) {
+	    blk.bands[blk.n_bands].row0 = r1;
+	    blk.bands[blk.n_bands].row1 = r1 + band_rows;
+	    blk.n_bands++;
+	}
+	if (r1 > n_rows + 1)
+	    r1 = n_rows + 1;
+	blk.bands[blk.n_bands - 1].row1 = r1;
+
+	/* the rows of the windows of the block */
+	blk.first_row = r0 - 1;
+	for (r = r0 - 1; r < r1; r++)
+	    read_band_row(blk.rows[r - blk.first_row], r);
+
+	G_parallel_for(0, blk.n_bands, 1, trace_bands, &blk);
+
+	for (i = 0; i < blk.n_bands; i++) {
+	    merge_band(&blk.bands[i], &prev);
+	    G_free(prev.bottom_left);
+	    G_free(prev.bottom_right);
+	    prev = blk.bands[i];
+	}
+    }
+    G_percent(1, 1, 1);
+
+    for (i = 0; i < m_n_areas; i++)
+	m_parent[i] = find_area(i);
+    write_merged_areas(m_areas, m_parent, m_n_areas);
+
+    G_free(prev.bottom_left);
+    G_free(prev.bottom_right);
+    G_free(m_areas);
+    G_free(m_parent);
+    G_free(seam_piece);
+    G_free(next_piece);
+    G_free(seam_end);
+    G_free(next_end);
+    G_free(blk.rows[0]);
+    G_free(blk.rows);
+    G_free(blk.bands);
+
+    return 1;
+}
+
+/* trace_bands - trace the boundaries of bands of a block */
+
+static void trace_bands(int first, int last, void *closure)
+{
+    struct block *blk = closure;
+    int i, r;
+
+    for (i = first; i < last; i++) {
+	struct band *b = &blk->bands[i];
+	int row0 = b->row0, row1 = b->row1;
+
+	band_init(b, row0, row1);
+	if (row0 > 0)
+	    start_seam(b, blk->rows[row0 - 1 - blk->first_row]);
+	for (r = row0; r < row1; r++)
+	    trace_row(b, blk->rows[r - 1 - blk->first_row],
+		      blk->rows[r - blk->first_row]);
+	if (row1 <= n_rows)
+	    end_seam(b);
+    }
+}
+
+/* read_band_row - read a row with a null cell on both sides; rows */
+/* outside of the map are null */
+
+static void read_band_row(void *buf, int row)
+{
+    if (row < 0 || row >= n_rows) {
+	Rast_set_null_value(buf, scan_length, data_type);
+	return;
+    }
+
+    Rast_get_row(input_fd, G_incr_void_ptr(buf, data_size), row, data_type);
+    Rast_set_null_value(buf, 1, data_type);
+    Rast_set_null_value(G_incr_void_ptr(buf, (row_length + 1) * data_size),
+			1, data_type);
+}
+
+/* start_seam - continue the lines of the band above: lines start at */
+/* the seam where the cells of the row above differ, the cells between */
+/* them are new areas, which are joined to the areas of the band above */
+
+static void start_seam(struct band *b, void *row)
+{
+    struct COOR *seam_ptr, *new_ptr;
+    double v0, v1;
+    int c, left, right;
+
+    b->top_left = G_malloc(scan_length * sizeof(int));
+    b->top_right = G_malloc(scan_length * sizeof(int));
+
+    left = 0;			/* the null cell on the left is outside */
+    v0 = get_raster_value(row, 0);
+    for (c = 0; c < scan_length - 1; c++) {
+	v1 = get_raster_value(row, c + 1);
+	b->top_left[c] = b->top_right[c] = -1;
+	if (differ(v0, v1)) {
+	    assign_area(b, v1, 0);
+	    right = b->area_num - 1;
+
+	    b->col = c;
+	    seam_ptr = get_ptr(b);	/* end at the seam */
+	    new_ptr = get_ptr(b);	/* downward-growing point */
+	    seam_ptr->bptr = seam_ptr;
+	    seam_ptr->fptr = new_ptr;
+	    new_ptr->bptr = seam_ptr;
+	    seam_ptr->seam = SEAM_TOP;
+	    seam_ptr->left = new_ptr->left = right;
+	    seam_ptr->right = new_ptr->right = left;
+	    b->v_list[c] = new_ptr;
+	    b->top_left[c] = right;
+	    b->top_right[c] = left;
+	    left = right;
+	}
+	v0 = v1;
+    }
+    b->col = 0;
+}
+
+/* end_seam - end the lines which continue in the band below at the */
+/* seam */
+
+static void end_seam(struct band *b)
+{
+    struct COOR *ptr;
+    int c;
+
+    b->bottom_left = G_malloc(scan_length * sizeof(int));
+    b->bottom_right = G_malloc(scan_length * sizeof(int));
+
+    for (c = 0; c < scan_length - 1; c++) {
+	b->bottom_left[c] = b->bottom_right[c] = -1;
+	if ((ptr = b->v_list[c]) == NULPTR)
+	    continue;
+
+	b->bottom_left[c] = ptr->left;
+	b->bottom_right[c] = ptr->right;
+	ptr->row = b->row;
+	ptr->fptr = ptr;
+	ptr->seam = SEAM_BOTTOM;
+	write_boundary(b, ptr);
+	b->v_list[c] = NULPTR;
+    }
+}
+
+/* merge_band - add the areas of a band to the merged areas and join */
+/* its pieces to the pieces of the band above; boundaries are written */
+/* when all their pieces are joined */
+
+static void merge_band(struct band *b, struct band *prev)
+{
+    struct piece *pc, *q, **tmp_piece;
+    int *tmp_end;
+    int offset, i, c, e;
+
+    offset = m_n_areas;
+    if (m_n_areas + b->area_num > m_alloc_areas) {
+	m_alloc_areas = 2 * m_alloc_areas + b->area_num;
+	m_areas = G_realloc(m_areas, m_alloc_areas * sizeof(struct area_table));
+	m_parent = G_realloc(m_parent, m_alloc_areas * sizeof(int));
+    }
+    for (i = 0; i < b->area_num; i++) {
+	m_areas[offset + i] = b->a_list[i];
+	m_parent[offset + i] = offset + i;
+    }
+    m_n_areas += b->area_num;
+    b->area_offset = offset;
+
+    for (i = 0; i < b->area_num && i < b->n_equiv; i++) {
+	if (b->e_list[i].mapped)
+	    join_areas(offset + i, offset + b->e_list[i].where);
+    }
+
+    if (b->row0 > 0) {
+	join_areas(offset, 0);	/* outside */
+	for (c = 0; c < scan_length - 1; c++) {
+	    if (b->top_left[c] < 0)
+		continue;
+	    if (prev->bottom_left[c] < 0) {
+		/* should not happen */
+		G_warning("No line above the seam at row %d, col %d",
+			  b->row0, c);
+		continue;
+	    }
+	    join_areas(offset + b->top_left[c],
+		       prev->area_offset + prev->bottom_left[c]);
+	    join_areas(offset + b->top_right[c],
+		       prev->area_offset + prev->bottom_right[c]);
+	}
+    }
+
+    for (i = 0; i < b->n_pieces; i++) {
+	pc = b->pieces[i];
+	if (pc->open == 0) {	/* complete in the band */
+	    write_points(pc->rc, pc->n);
+	    free_piece(pc);
+	    continue;
+	}
+
+	for (e = 0; e < 2; e++) {
+	    c = pc->col[e];
+	    if (pc->seam[e] == SEAM_BOTTOM) {
+		next_piece[c] = pc;
+		next_end[c] = e;
+	    }
+	    else if (pc->seam[e] == SEAM_TOP) {
+		if ((q = seam_piece[c]) == NULL) {
+		    /* should not happen */
+		    G_warning("No piece above the seam at row %d, col %d",
+			      b->row0, c);
+		    continue;
+		}
+		seam_piece[c] = NULL;
+		join_pieces(pc, e, q, seam_end[c]);
+	    }
+	}
+	if (find_piece(pc)->open == 0)
+	    write_chain(pc);
+    }
+
+    tmp_piece = seam_piece;
+    seam_piece = next_piece;
+    next_piece = tmp_piece;
+    tmp_end = seam_end;
+    seam_end = next_end;
+    next_end = tmp_end;
+
+    if (b->n_alloced_ptrs) {
 	/* should not happen */
-	G_warning("Memory leak: %d points are still in use", n_alloced_ptrs);
+	G_warning("Memory leak: %d points are still in use",
+		  b->n_alloced_ptrs);
     }
 
-    return 0;
-}				/* extract_areas */
+    band_free(b);
+}
+
+/* find_area, join_areas - union of merged areas, the smallest area */
+/* number represents the joined areas */
+
+static int find_area(int a)
+{
+    while (m_parent[a] != a) {
+	m_parent[a] = m_parent[m_parent[a]];
+	a = m_parent[a];
+    }
+
+    return a;
+}
+
+static void join_areas(int a1, int a2)
+{
+    a1 = find_area(a1);
+    a2 = find_area(a2);
+    if (a1 < a2)
+	m_parent[a2] = a1;
+    else if (a2 < a1)
+	m_parent[a1] = a2;
+}
+
+/* find_piece, join_pieces - union of the pieces of a boundary, counting */
+/* the seam ends which are not joined yet */
+
+static struct piece *find_piece(struct piece *pc)
+{
+    while (pc->parent != pc) {
+	pc->parent = pc->parent->parent;
+	pc = pc->parent;
+    }
+
+    return pc;
+}
+
+static void join_pieces(struct piece *p1, int e1, struct piece *p2, int e2)
+{
+    struct piece *r1, *r2;
+
+    p1->link[e1] = p2;
+    p1->link_end[e1] = e2;
+    p2->link[e2] = p1;
+    p2->link_end[e2] = e1;
+
+    r1 = find_piece(p1);
+    r2 = find_piece(p2);
+    if (r1 == r2)
+	r1->open -= 2;
+    else {
+	r2->parent = r1;
+	r1->open += r2->open - 2;
+    }
+}
+
+/* write_chain - write the boundary made of joined pieces and free the */
+/* pieces */
+
+static void write_chain(struct piece *seed)
+{
+    static int *rc = NULL;
+    static int alloc = 0;
+    struct piece *pc, *start, *next;
+    int e, start_e, next_e, loop, n, i, j;
+
+    /* go to an end of the boundary, or around a loop */
+    loop = 0;
+    pc = seed;
+    e = 0;
+    while (pc->link[e]) {
+	next = pc->link[e];
+	e = 1 - pc->link_end[e];
+	pc = next;
+	if (pc == seed && e == 0) {
+	    loop = 1;
+	    break;
+	}
+    }
+    start = pc;
+    start_e = e;
+
+    /* collect the points from there */
+    n = 0;
+    do {
+	if (n + pc->n + 1 > alloc) {
+	    alloc = 2 * (n + pc->n + 1);
+	    rc = G_realloc(rc, 2 * alloc * sizeof(int));
+	}
+	for (i = 0; i < pc->n; i++, n++) {
+	    j = e == 0 ? i : pc->n - 1 - i;
+	    rc[2 * n] = pc->rc[2 * j];
+	    rc[2 * n + 1] = pc->rc[2 * j + 1];
+	}
+
+	next = pc->link[1 - e];
+	next_e = pc->link_end[1 - e];
+	if (pc != start)
+	    free_piece(pc);
+	pc = next;
+	e = next_e;
+    } while (pc && !(pc == start && e == start_e));
+    free_piece(start);
+
+    if (loop) {
+	/* start where the loop is closed by a single band: at the last */
+	/* corner in scan order, which stays sharp in smoothed output */
+	int k = 0;
+
+	for (i = 1; i < n; i++) {
+	    if (rc[2 * i] > rc[2 * k] ||
+		(rc[2 * i] == rc[2 * k] && rc[2 * i + 1] > rc[2 * k + 1]))
+		k = i;
+	}
+	if (2 * n + 1 > alloc) {
+	    alloc = 2 * n + 1;
+	    rc = G_realloc(rc, 2 * alloc * sizeof(int));
+	}
+	for (i = 0; i < k; i++) {
+	    rc[2 * (n + i)] = rc[2 * i];
+	    rc[2 * (n + i) + 1] = rc[2 * i + 1];
+	}
+	memmove(rc, rc + 2 * k, 2 * n * sizeof(int));
+
+	/* close the loop */
+	rc[2 * n] = rc[0];
+	rc[2 * n + 1] = rc[1];
+	n++;
+    }
+
+    write_points(rc, n);
+}
+
+static void free_piece(struct piece *pc)
+{
+    G_free(pc->rc);
+    G_free(pc);
+}
+
+/* band_init - initialize the state of a band */
+
+static void band_init(struct band *b, int row0, int row1)
+{
+    double nullVal;
+    int i;
+
+    b->row0 = row0;
+    b->row1 = row1;
+    b->row = row0;
+    b->col = 0;
+    b->top = b->bottom = NULL;
+    b->v_list = (struct COOR **)G_calloc(scan_length, sizeof(*b->v_list));
+    b->h_ptr = NULPTR;
+    b->n_areas = b->n_equiv = 500;	/* guess at number of areas, equivs */
+    b->a_list =
+	(struct area_table *)G_malloc(b->n_areas * sizeof(struct area_table));
+
+    for (i = 0; i < b->n_areas; i++) {
+	(b->a_list + i)->width = (b->a_list + i)->row = (b->a_list + i)->col = 0;
+	(b->a_list + i)->free = 1;
+    }
+    b->a_list_new = b->a_list_old = b->a_list;
+
+    b->e_list =
+	(struct equiv_table *)G_malloc(b->n_equiv * sizeof(struct equiv_table));
+    for (i = 0; i < b->n_equiv; i++) {
+	(b->e_list + i)->mapped = (b->e_list + i)->count = 0;
+	(b->e_list + i)->ptr = NULL;
+    }
+
+    b->area_num = 0;
+    b->tl_area = 0;
+    b->area_offset = 0;
+    b->direction = FORWARD;
+    b->n_alloced_ptrs = 0;
+    b->stream = 0;
+    b->pieces = NULL;
+    b->n_pieces = b->alloc_pieces = 0;
+    b->top_left = b->top_right = NULL;
+    b->bottom_left = b->bottom_right = NULL;
+
+    Rast_set_d_null_value(&nullVal, 1);
+    /* represents the "outside", the external null values */
+    assign_area(b, nullVal, 0);
+}
+
+/* band_free - free the state of a band, the areas at the bottom seam */
+/* are kept for the band below */
+
+static void band_free(struct band *b)
+{
+    int i;
+
+    G_free(b->a_list);
+    for (i = 0; i < b->n_equiv; i++) {
+	if (b->e_list[i].ptr)
+	    G_free(b->e_list[i].ptr);
+    }
+    G_free(b->e_list);
+    G_free(b->v_list);
+    G_free(b->pieces);
+    G_free(b->top_left);
+    G_free(b->top_right);
+}
+
+/* trace_row - process the windows between two rows */
+
+static void trace_row(struct band *b, void *top_row, void *bottom_row)
+{
+    b->top = top_row;
+    b->bottom = bottom_row;
+
+    for (b->col = 0; b->col < scan_length - 1; b->col++) {
+	b->tl = get_raster_value(top_row, b->col);	/* top left in window */
+	b->tr = get_raster_value(top_row, b->col + 1);	/* top right */
+	b->bl = get_raster_value(bottom_row, b->col);	/* bottom left */
+	b->br = get_raster_value(bottom_row, b->col + 1);	/* bottom right */
+	update_list(b, nabors(b));
+    }
+
+    if (b->h_ptr != NULPTR)	/* if we have a loose end, */
+	end_hline(b);		/*   tie it down */
+
+    b->row++;
+}
 
 /* update_list - maintains linked list of COOR structures which resprsent */
 /* bends in and endpoints of lines separating areas in input file; */
@@ -166,7 +701,7 @@ int extract_areas(void)
 /* for pictures of what each case in the switch represents, see comments */
 /* before nabors() */
 
-static int update_list(int i)
+static int update_list(struct band *b, int i)
 {
     struct COOR *new_ptr, *new_ptr1, *new_ptr2, *new_ptr3;
     double right, left;
@@ -175,15 +710,15 @@ static int update_list(int i)
     case 0:
 	/* Vertical line - Just update width information */
 	/* update_width(a_list + v_list[col]->left,0); */
-	tl_area = v_list[col]->left;
+	b->tl_area = b->v_list[b->col]->left;
 	break;
     case 1:
 	/* Bottom right corner - Point in middle of new line */
 	/* (growing) <- ptr2 -><- ptr1 -><- ptr3 -> (growing) */
 	/*            (?, col) (row, col) (row, ?) */
-	new_ptr1 = get_ptr();	/* corner point */
-	new_ptr2 = get_ptr();	/* downward-growing point */
-	new_ptr3 = get_ptr();	/* right-growing point */
+	new_ptr1 = get_ptr(b);	/* corner point */
+	new_ptr2 = get_ptr(b);	/* downward-growing point */
+	new_ptr3 = get_ptr(b);	/* right-growing point */
 	new_ptr1->bptr = new_ptr2;
 	new_ptr1->fptr = new_ptr3;
 	new_ptr2->bptr = new_ptr3->bptr = new_ptr1;
@@ -193,137 +728,137 @@ static int update_list(int i)
 	   assign_area(tl,1);
 	   } else {
 	 */
-	new_ptr1->left = new_ptr2->right = new_ptr3->left = tl_area;
-	new_ptr1->right = new_ptr2->left = new_ptr3->right = area_num;
+	new_ptr1->left = new_ptr2->right = new_ptr3->left = b->tl_area;
+	new_ptr1->right = new_ptr2->left = new_ptr3->right = b->area_num;
 
-	assign_area(br, 1);
-	update_width(a_list_old, 1);
-	v_list[col] = new_ptr2;
-	h_ptr = new_ptr3;
+	assign_area(b, b->br, 1);
+	update_width(b, b->a_list_old, 1);
+	b->v_list[b->col] = new_ptr2;
+	b->h_ptr = new_ptr3;
 	break;
     case 3:
 	/* Bottom left corner - Add point to line already under construction */
 	/* (fixed) -><- original h_ptr -><- new_ptr -> (growing) */
 	/*                (row, col)       (?, col) */
-	tl_area = h_ptr->left;
-	new_ptr = get_ptr();	/* downward-growing point */
-	h_ptr->col = col;
-	h_ptr->fptr = new_ptr;
-	new_ptr->bptr = h_ptr;
-	new_ptr->left = h_ptr->left;
-	new_ptr->right = h_ptr->right;
+	b->tl_area = b->h_ptr->left;
+	new_ptr = get_ptr(b);	/* downward-growing point */
+	b->h_ptr->col = b->col;
+	b->h_ptr->fptr = new_ptr;
+	new_ptr->bptr = b->h_ptr;
+	new_ptr->left = b->h_ptr->left;
+	new_ptr->right = b->h_ptr->right;
 
 	/* update_width(a_list + new_ptr->left,3); */
-	v_list[col] = new_ptr;
-	h_ptr = NULPTR;
+	b->v_list[b->col] = new_ptr;
+	b->h_ptr = NULPTR;
 	break;
     case 4:
 	/* Top left corner - Join two lines already under construction */
 	/* (fixed) -><- original v_list -><- (fixed) */
 	/*                 (row, col) */
-	tl_area = v_list[col]->left;
-	equiv_areas(h_ptr->left, v_list[col]->right);
-	equiv_areas(h_ptr->right, v_list[col]->left);
-	v_list[col]->row = row;	/* keep downward-growing point */
-	v_list[col]->fptr = h_ptr->bptr;	/*   and join it to predecessor */
-	h_ptr->bptr->fptr = v_list[col];	/*   of right-growing point */
-	free_ptr(h_ptr);		/* right-growing point disappears */
-	h_ptr = NULPTR;		/* turn loose of pointers */
-	write_boundary(v_list[col]);	/* try to write line */
-	v_list[col] = NULPTR;	/* turn loose of pointers */
+	b->tl_area = b->v_list[b->col]->left;
+	equiv_areas(b, b->h_ptr->left, b->v_list[b->col]->right);
+	equiv_areas(b, b->h_ptr->right, b->v_list[b->col]->left);
+	b->v_list[b->col]->row = b->row;	/* keep downward-growing point */
+	b->v_list[b->col]->fptr = b->h_ptr->bptr;	/*   and join it to predecessor */
+	b->h_ptr->bptr->fptr = b->v_list[b->col];	/*   of right-growing point */
+	release_ptr(b, b->h_ptr);		/* right-growing point disappears */
+	b->h_ptr = NULPTR;		/* turn loose of pointers */
+	write_boundary(b, b->v_list[b->col]);	/* try to write line */
+	b->v_list[b->col] = NULPTR;	/* turn loose of pointers */
 	break;
     case 5:
 	/* Top right corner - Add point to line already under construction */
 	/* (fixed) -><- original v_list -><- new_ptr -> (growing) */
 	/*                 (row, col)        (row, ?) */
-	new_ptr = get_ptr();	/* right-growing point */
-	v_list[col]->row = row;
-	new_ptr->bptr = v_list[col];
-	new_ptr->left = v_list[col]->left;
-	new_ptr->right = v_list[col]->right;
-	v_list[col]->fptr = new_ptr;
-	h_ptr = new_ptr;
-	v_list[col] = NULPTR;
+	new_ptr = get_ptr(b);	/* right-growing point */
+	b->v_list[b->col]->row = b->row;
+	new_ptr->bptr = b->v_list[b->col];
+	new_ptr->left = b->v_list[b->col]->left;
+	new_ptr->right = b->v_list[b->col]->right;
+	b->v_list[b->col]->fptr = new_ptr;
+	b->h_ptr = new_ptr;
+	b->v_list[b->col] = NULPTR;
 	break;
     case 6:
 	/* T upward - End one vertical and one horizontal line */
 	/*            Start horizontal line */
-	v_list[col]->node = h_ptr->node = 1;
-	left = v_list[col]->left;
-	right = h_ptr->right;
-	end_vline();
-	end_hline();
-	start_hline();
-	h_ptr->bptr->node = 1;	/* where we came from is a node */
-	h_ptr->left = h_ptr->bptr->left = left;
-	h_ptr->right = h_ptr->bptr->right = right;
+	b->v_list[b->col]->node = b->h_ptr->node = 1;
+	left = b->v_list[b->col]->left;
+	right = b->h_ptr->right;
+	end_vline(b);
+	end_hline(b);
+	start_hline(b);
+	b->h_ptr->bptr->node = 1;	/* where we came from is a node */
+	b->h_ptr->left = b->h_ptr->bptr->left = left;
+	b->h_ptr->right = b->h_ptr->bptr->right = right;
 	break;
     case 7:
 	/* T downward - End horizontal line */
 	/*              Start one vertical and one horizontal line */
-	h_ptr->node = 1;
-	right = h_ptr->right;
-	left = h_ptr->left;
-	end_hline();
-	start_hline();
-	start_vline();
-	h_ptr->bptr->node = v_list[col]->bptr->node = 1;
-	h_ptr->left = h_ptr->bptr->left = left;
-	h_ptr->right = h_ptr->bptr->right = v_list[col]->left =
-	    v_list[col]->bptr->left = area_num;
-	assign_area(br, 7);
-	update_width(a_list_old, 7);
-	v_list[col]->right = v_list[col]->bptr->right = right;
+	b->h_ptr->node = 1;
+	right = b->h_ptr->right;
+	left = b->h_ptr->left;
+	end_hline(b);
+	start_hline(b);
+	start_vline(b);
+	b->h_ptr->bptr->node = b->v_list[b->col]->bptr->node = 1;
+	b->h_ptr->left = b->h_ptr->bptr->left = left;
+	b->h_ptr->right = b->h_ptr->bptr->right = b->v_list[b->col]->left =
+	    b->v_list[b->col]->bptr->left = b->area_num;
+	assign_area(b, b->br, 7);
+	update_width(b, b->a_list_old, 7);
+	b->v_list[b->col]->right = b->v_list[b->col]->bptr->right = right;
 	break;
     case 8:
 	/* T left - End one vertical and one horizontal line */
 	/*          Start one vertical line */
-	tl_area = v_list[col]->left;
-	h_ptr->node = v_list[col]->node = 1;
-	right = h_ptr->right;
-	left = v_list[col]->left;
-	end_vline();
-	end_hline();
-	start_vline();
-	v_list[col]->bptr->node = 1;	/* where we came from is a node */
-	v_list[col]->left = v_list[col]->bptr->left = left;
-	v_list[col]->right = v_list[col]->bptr->right = right;
+	b->tl_area = b->v_list[b->col]->left;
+	b->h_ptr->node = b->v_list[b->col]->node = 1;
+	right = b->h_ptr->right;
+	left = b->v_list[b->col]->left;
+	end_vline(b);
+	end_hline(b);
+	start_vline(b);
+	b->v_list[b->col]->bptr->node = 1;	/* where we came from is a node */
+	b->v_list[b->col]->left = b->v_list[b->col]->bptr->left = left;
+	b->v_list[b->col]->right = b->v_list[b->col]->bptr->right = right;
 	/* update_width(a_list + v_list[col]->left,8); */
 	break;
     case 9:
 	/* T right - End one vertical line */
 	/*           Start one vertical and one horizontal line */
-	v_list[col]->node = 1;
-	right = v_list[col]->right;
-	left = v_list[col]->left;
-	end_vline();
-	start_vline();
-	start_hline();
-	v_list[col]->bptr->node = h_ptr->bptr->node = 1;
-	h_ptr->left = h_ptr->bptr->left = left;
-	h_ptr->right = h_ptr->bptr->right = v_list[col]->left =
-	    v_list[col]->bptr->left = area_num;
-	assign_area(br, 9);
-	update_width(a_list_old, 9);
-	v_list[col]->right = v_list[col]->bptr->right = right;
+	b->v_list[b->col]->node = 1;
+	right = b->v_list[b->col]->right;
+	left = b->v_list[b->col]->left;
+	end_vline(b);
+	start_vline(b);
+	start_hline(b);
+	b->v_list[b->col]->bptr->node = b->h_ptr->bptr->node = 1;
+	b->h_ptr->left = b->h_ptr->bptr->left = left;
+	b->h_ptr->right = b->h_ptr->bptr->right = b->v_list[b->col]->left =
+	    b->v_list[b->col]->bptr->left = b->area_num;
+	assign_area(b, b->br, 9);
+	update_width(b, b->a_list_old, 9);
+	b->v_list[b->col]->right = b->v_list[b->col]->bptr->right = right;
 	break;
     case 10:
 	/* Cross - End one vertical and one horizontal line */
 	/*         Start one vertical and one horizontal line */
-	v_list[col]->node = h_ptr->node = 1;
-	left = v_list[col]->left;
-	right = h_ptr->right;
-	end_vline();
-	end_hline();
-	start_vline();
-	start_hline();
-	v_list[col]->bptr->node = h_ptr->bptr->node = 1;
-	h_ptr->left = h_ptr->bptr->left = left;
-	v_list[col]->left = v_list[col]->bptr->left = h_ptr->right =
-	    h_ptr->bptr->right = area_num;
-	assign_area(br, 10);
-	update_width(a_list_old, 10);
-	v_list[col]->right = v_list[col]->bptr->right = right;
+	b->v_list[b->col]->node = b->h_ptr->node = 1;
+	left = b->v_list[b->col]->left;
+	right = b->h_ptr->right;
+	end_vline(b);
+	end_hline(b);
+	start_vline(b);
+	start_hline(b);
+	b->v_list[b->col]->bptr->node = b->h_ptr->bptr->node = 1;
+	b->h_ptr->left = b->h_ptr->bptr->left = left;
+	b->v_list[b->col]->left = b->v_list[b->col]->bptr->left = b->h_ptr->right =
+	    b->h_ptr->bptr->right = b->area_num;
+	assign_area(b, b->br, 10);
+	update_width(b, b->a_list_old, 10);
+	b->v_list[b->col]->right = b->v_list[b->col]->bptr->right = right;
 	break;
     }				/* switch */
 
@@ -333,22 +868,22 @@ static int update_list(int i)
 /* end_vline, end_hline - end vertical or horizontal line and try */
 /* to write it out */
 
-static int end_vline(void)
+static int end_vline(struct band *b)
 {
-    v_list[col]->row = row;
-    v_list[col]->fptr = v_list[col];
-    write_boundary(v_list[col]);
-    v_list[col] = NULPTR;
+    b->v_list[b->col]->row = b->row;
+    b->v_list[b->col]->fptr = b->v_list[b->col];
+    write_boundary(b, b->v_list[b->col]);
+    b->v_list[b->col] = NULPTR;
 
     return 0;
 }
 
-static int end_hline(void)
+static int end_hline(struct band *b)
 {
-    h_ptr->col = col;
-    h_ptr->fptr = h_ptr;
-    write_boundary(h_ptr);
-    h_ptr = NULPTR;
+    b->h_ptr->col = b->col;
+    b->h_ptr->fptr = b->h_ptr;
+    write_boundary(b, b->h_ptr);
+    b->h_ptr = NULPTR;
 
     return 0;
 }
@@ -356,51 +891,61 @@ static int end_hline(void)
 /* start_vline, start_hline - begin line in vertical or horizontal */
 /* direction */
 
-static int start_vline(void)
+static int start_vline(struct band *b)
 {
     struct COOR *new_ptr1, *new_ptr2;
 
-    new_ptr1 = get_ptr();
-    new_ptr2 = get_ptr();
+    new_ptr1 = get_ptr(b);
+    new_ptr2 = get_ptr(b);
     new_ptr1->fptr = new_ptr2;
     new_ptr2->bptr = new_ptr1->bptr = new_ptr1;
     new_ptr2->fptr = NULPTR;
-    v_list[col] = new_ptr2;
+    b->v_list[b->col] = new_ptr2;
 
     return 0;
 }
 
-static int start_hline(void)
+static int start_hline(struct band *b)
 {
     struct COOR *new_ptr1, *new_ptr2;
 
-    new_ptr1 = get_ptr();
-    new_ptr2 = get_ptr();
+    new_ptr1 = get_ptr(b);
+    new_ptr2 = get_ptr(b);
     new_ptr1->bptr = new_ptr2->bptr = new_ptr1;
     new_ptr1->fptr = new_ptr2;
     new_ptr2->fptr = NULPTR;
-    h_ptr = new_ptr2;
+    b->h_ptr = new_ptr2;
 
     return 0;
 }
 
 /* get_ptr - allocate storage for yet another COOR structure */
 
-static struct COOR *get_ptr(void)
+static struct COOR *get_ptr(struct band *b)
 {
-    static struct COOR *ptr;
+    struct COOR *ptr;
 
     ptr = (struct COOR *)G_malloc(sizeof(struct COOR));
-    ptr->row = row;
-    ptr->col = col;
+    ptr->row = b->row;
+    ptr->col = b->col;
     ptr->fptr = ptr->bptr = NULPTR;
     ptr->node = ptr->left = ptr->right = 0;
+    ptr->seam = 0;
     
-    n_alloced_ptrs++;
+    b->n_alloced_ptrs++;
 
     return (ptr);
 }
 
+/* release_ptr - free a COOR structure */
+
+static int release_ptr(struct band *b, struct COOR *ptr)
+{
+    G_free(ptr);
+
+    return (--b->n_alloced_ptrs);
+}
+
 /* nabors - check 2 x 2 matrix and return case from table below */
 
 /*    *--*--*      *--*--*      *--*--*      *--*--*    */
@@ -427,8 +972,9 @@ static struct COOR *get_ptr(void)
 /*                                                      */
 /*       8            9            10           11      */
 
-static int nabors(void)
+static int nabors(struct band *b)
 {
+    double tl = b->tl, tr = b->tr, bl = b->bl, br = b->br;
     int tl_null = Rast_is_d_null_value(&tl);
     int tr_null = Rast_is_d_null_value(&tr);
     int bl_null = Rast_is_d_null_value(&bl);
@@ -489,6 +1035,16 @@ static int nabors(void)
     return 0;
 }
 
+/* differ - check whether two cells belong to different areas */
+
+static int differ(double a, double b)
+{
+    int a_null = Rast_is_d_null_value(&a);
+    int b_null = Rast_is_d_null_value(&b);
+
+    return cmp(a, b);
+}
+
 /* read_next - read another line from input file */
 
 static int read_next(void)
@@ -503,31 +1059,12 @@ static int read_next(void)
 }
 
 /* alloc_bufs - allocate buffers we will need for storing raster map */
-/* data, pointers to extracted lines, area number information */
+/* data */
 
 int alloc_areas_bufs(int size)
 {
-    int i;
-
     buffer[0] = (void *)G_malloc(size * data_size);
     buffer[1] = (void *)G_malloc(size * data_size);
-    v_list = (struct COOR **)G_malloc(size * sizeof(*v_list));
-    n_areas = n_equiv = 500;	/* guess at number of areas, equivs */
-    a_list =
-	(struct area_table *)G_malloc(n_areas * sizeof(struct area_table));
-
-    for (i = 0; i < n_areas; i++) {
-	(a_list + i)->width = (a_list + i)->row = (a_list + i)->col = 0;
-	(a_list + i)->free = 1;
-    }
-    a_list_new = a_list_old = a_list;
-
-    e_list =
-	(struct equiv_table *)G_malloc(n_equiv * sizeof(struct equiv_table));
-    for (i = 0; i < n_equiv; i++) {
-	(e_list + i)->mapped = (e_list + i)->count = 0;
-	(e_list + i)->ptr = NULL;
-    }
 
     return 0;
 }
@@ -535,7 +1072,7 @@ int alloc_areas_bufs(int size)
 /* equiv_areas - force two areas to be equivalent and generate */
 /* mapping information */
 
-static int equiv_areas(int a1, int a2)
+static int equiv_areas(struct band *b, int a1, int a2)
 {
     int small, large, small_obj, large_obj;
 
@@ -553,36 +1090,36 @@ static int equiv_areas(int a1, int a2)
 	large = a1;
     }
 
-    while (large >= n_equiv)	/* make sure our equivalence tables */
-	more_equivs();		/*   are large enough */
+    while (large >= b->n_equiv)	/* make sure our equivalence tables */
+	more_equivs(b);		/*   are large enough */
 
-    if ((e_list + large)->mapped) {
-	if ((e_list + small)->mapped) {	/* small mapped, large mapped */
-	    large_obj = (e_list + large)->where;
-	    small_obj = (e_list + small)->where;
+    if ((b->e_list + large)->mapped) {
+	if ((b->e_list + small)->mapped) {	/* small mapped, large mapped */
+	    large_obj = (b->e_list + large)->where;
+	    small_obj = (b->e_list + small)->where;
 	    if (large_obj == small_obj)	/* both mapped to same place */
 		return (0);
 	    if (small_obj < large_obj)	/* map where large goes to where */
-		map_area(large_obj, small_obj);	/*   small goes */
+		map_area(b, large_obj, small_obj);	/*   small goes */
 	    else		/* map where small goes to where */
-		map_area(small_obj, large_obj);	/*   large goes */
+		map_area(b, small_obj, large_obj);	/*   large goes */
 	}
 	else {			/* small not mapped, large mapped */
 
-	    large_obj = (e_list + large)->where;
+	    large_obj = (b->e_list + large)->where;
 	    if (small == large_obj)	/* large already mapped to small */
 		return (0);
 	    if (small < large_obj)	/* map where large goes to small */
-		map_area(large_obj, small);
+		map_area(b, large_obj, small);
 	    else		/* map small to where large goes */
-		map_area(small, large_obj);
+		map_area(b, small, large_obj);
 	}
     }
     else {
-	if ((e_list + small)->mapped)	/* small mapped, large not mapped */
-	    map_area(large, (e_list + small)->where);
+	if ((b->e_list + small)->mapped)	/* small mapped, large not mapped */
+	    map_area(b, large, (b->e_list + small)->where);
 	else			/* small not mapped, large not mapped */
-	    map_area(large, small);
+	    map_area(b, large, small);
     }
 
     return (0);
@@ -600,26 +1137,26 @@ static int equiv_areas(int a1, int a2)
 /*     if count != 0 */
 /*       .ptr gives a pointer to the list of area numbers */
 
-static int map_area(int x, int y	/* map x to y */
+static int map_area(struct band *b, int x, int y	/* map x to y */
     )
 {
     int n, i, *p;
 
-    (e_list + x)->mapped = 1;
-    (e_list + x)->where = y;
+    (b->e_list + x)->mapped = 1;
+    (b->e_list + x)->where = y;
 
-    if ((a_list + x)->width > (a_list + y)->width) {
-	(a_list + y)->width = (a_list + x)->width;
-	(a_list + y)->row = (a_list + x)->row;
-	(a_list + y)->col = (a_list + x)->col;
+    if ((b->a_list + x)->width > (b->a_list + y)->width) {
+	(b->a_list + y)->width = (b->a_list + x)->width;
+	(b->a_list + y)->row = (b->a_list + x)->row;
+	(b->a_list + y)->col = (b->a_list + x)->col;
     }
 
-    if (add_to_list(x, y)) {	/* if x is not already in y's list */
-	n = (e_list + x)->count;
-	p = (e_list + x)->ptr;
+    if (add_to_list(b, x, y)) {	/* if x is not already in y's list */
+	n = (b->e_list + x)->count;
+	p = (b->e_list + x)->ptr;
 	for (i = 0; i < n; i++) {	/* map everything that is currently *//*   mapped onto x onto y; because */
-	    (e_list + *p)->where = y;	/*   of this reshuffle, only one */
-	    add_to_list(*p++, y);	/*   level of mapping is ever needed */
+	    (b->e_list + *p)->where = y;	/*   of this reshuffle, only one */
+	    add_to_list(b, *p++, y);	/*   level of mapping is ever needed */
 	}
     }
 
@@ -628,12 +1165,12 @@ static int map_area(int x, int y	/* map x to y */
 
 /* add_to_list - add another area number to an equivalence list */
 
-static int add_to_list(int x, int y)
+static int add_to_list(struct band *b, int x, int y)
 {
     int n, i;
     struct equiv_table *e_list_y;
 
-    e_list_y = e_list + y;
+    e_list_y = b->e_list + y;
     n = e_list_y->count;
     if (n == 0) {		/* first time through--start list */
 	e_list_y->length = 20;	/* initial guess at storage needed */
@@ -665,36 +1202,36 @@ static int add_to_list(int x, int y)
 /* assign_area - make current area number correspond to the passed */
 /* category number and allocate more space to store areas if necessary */
 
-static int assign_area(double cat, int kase)
+static int assign_area(struct band *b, double cat, int kase)
 {
-    a_list_new->free = 0;
-    a_list_new->cat = cat;
-    area_num++;
+    b->a_list_new->free = 0;
+    b->a_list_new->cat = cat;
+    b->area_num++;
 
-    if (area_num >= n_areas)
-	more_areas();
+    if (b->area_num >= b->n_areas)
+	more_areas(b);
 
-    a_list_old = a_list + area_num - 1;
-    a_list_new = a_list + area_num;
+    b->a_list_old = b->a_list + b->area_num - 1;
+    b->a_list_new = b->a_list + b->area_num;
 
     return 0;
 }
 
 /* more_areas - allocate larger space to store area correspondences */
 
-static int more_areas(void)
+static int more_areas(struct band *b)
 {
     int old_n, i;
 
-    old_n = n_areas;
-    n_areas += 250;
+    old_n = b->n_areas;
+    b->n_areas += 250;
 
-    a_list =
-	(struct area_table *)G_realloc(a_list,
-				       n_areas * sizeof(struct area_table));
-    for (i = old_n; i < n_areas; i++) {
-	(a_list + i)->width = -1;
-	(a_list + i)->free = 1;
+    b->a_list =
+	(struct area_table *)G_realloc(b->a_list,
+				       b->n_areas * sizeof(struct area_table));
+    for (i = old_n; i < b->n_areas; i++) {
+	(b->a_list + i)->width = -1;
+	(b->a_list + i)->free = 1;
     }
 
     return 0;
@@ -702,48 +1239,49 @@ static int more_areas(void)
 
 /* more_equivs - allocate more space to construct equivalence information */
 
-int more_equivs(void)
+static int more_equivs(struct band *b)
 {
     int old_n, i;
 
-    old_n = n_equiv;
-    n_equiv += 250;
+    old_n = b->n_equiv;
+    b->n_equiv += 250;
 
-    e_list =
-	(struct equiv_table *)G_realloc(e_list,
-					n_equiv * sizeof(struct equiv_table));
-    for (i = old_n; i < n_equiv; i++) {
-	(e_list + i)->mapped = (e_list + i)->count = 0;
-	(e_list + i)->ptr = NULL;
+    b->e_list =
+	(struct equiv_table *)G_realloc(b->e_list,
+					b->n_equiv * sizeof(struct equiv_table));
+    for (i = old_n; i < b->n_equiv; i++) {
+	(b->e_list + i)->mapped = (b->e_list + i)->count = 0;
+	(b->e_list + i)->ptr = NULL;
     }
 
     return 0;
 }
 
 /* update_width - update position of longest horizontal strip in an area */
-static int update_width(struct area_table *ptr, int kase)
+static int update_width(struct band *b, struct area_table *ptr,
+			int kase)
 {
     int w, j, a;
     struct equiv_table *ep;
 
-    a = (ptr - a_list);
-    for (j = col + 1, w = 0; j < scan_length &&
-	 get_raster_value(buffer[bottom], j) == br; j++, w++) ;
+    a = (ptr - b->a_list);
+    for (j = b->col + 1, w = 0; j < scan_length &&
+	 get_raster_value(b->bottom, j) == b->br; j++, w++) ;
 
     if (a == 0)
-	G_debug(1, "Area 0, %d \t%d \t%d \t%d \t%d", kase, row, col,
+	G_debug(1, "Area 0, %d \t%d \t%d \t%d \t%d", kase, b->row, b->col,
 		ptr->width, w);
 
-    if (a < n_equiv) {
-	ep = e_list + a;
+    if (a < b->n_equiv) {
+	ep = b->e_list + a;
 	if (ep->mapped)
-	    ptr = a_list + ep->where;
+	    ptr = b->a_list + ep->where;
     }
 
     if (w > ptr->width) {
 	ptr->width = w;
-	ptr->row = row;
-	ptr->col = col;
+	ptr->row = b->row;
+	ptr->col = b->col;
     }
 
     return 0;
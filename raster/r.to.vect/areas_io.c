@@ -25,72 +25,117 @@
 
 
 /* function prototypes */
-static int write_bnd(struct COOR *, struct COOR *, int);
-static int write_smooth_bnd(struct COOR *, struct COOR *, int);
+static void add_point(struct piece *, const struct COOR *);
+static int write_bnd(const int *, int);
+static int write_smooth_bnd(const int *, int);
+static int write_centroid(struct area_table *, int *, struct line_pnts *);
 
 
 /* write_line - attempt to write a line to output */
 /* just returns if line is not completed yet */
-int write_boundary(struct COOR *seed)
+/* the points of the line are written if the band streams its output, */
+/* otherwise they are kept as a piece of the band */
+int write_boundary(struct band *b, struct COOR *seed)
 {
+    static struct piece line;	/* only used by a streaming band */
     struct COOR *point, *line_begin, *line_end, *last;
-    int dir, line_type, n, n1;
+    struct piece *pc;
+    int dir, line_type, n, n1, i;
 
     point = seed;
     if ((dir = at_end(point))) {	/* already have one end of line */
 	line_begin = point;
-	line_end = find_end(point, dir, &line_type, &n);
+	line_end = find_end_dir(point, dir, &line_type, &n, &b->direction);
 	if (line_type == OPEN)
 	    return (-1);	/* unfinished line */
-	direction = dir;
+	b->direction = dir;
     }
     else {			/* in middle of a line */
-	line_end = find_end(point, FORWARD, &line_type, &n);
+	line_end = find_end_dir(point, FORWARD, &line_type, &n,
+				&b->direction);
 	if (line_type == OPEN)	/* line not finished */
 	    return (-1);
 
 	if (line_type == END) {	/* found one end at least *//* look for other one */
-	    line_begin = find_end(point, BACKWARD, &line_type, &n1);
+	    line_begin = find_end_dir(point, BACKWARD, &line_type, &n1,
+				      &b->direction);
 	    if (line_type == OPEN)	/* line not finished */
 		return (-1);
 	    if (line_type == LOOP) {	/* this should NEVER be the case */
 		return (-1);
 	    }
-	    direction = at_end(line_begin);	/* found both ends now; total length */
+	    b->direction = at_end(line_begin);	/* found both ends now; total length */
 	    n += n1;		/*   is sum of distances to each end */
 	}
 	else {
 	    /* line_type = LOOP by default */
 	    /* already have correct length */
 	    line_begin = line_end;	/* end and beginning are the same */
-	    direction = FORWARD;	/* direction is arbitrary */
+	    b->direction = FORWARD;	/* direction is arbitrary */
 	}
     }
-    dir = direction;
+    dir = b->direction;
 
-    if (smooth_flag == SMOOTH)
-	write_smooth_bnd(line_begin, line_end, n);
-    else
-	write_bnd(line_begin, line_end, n);
+    if (b->stream)
+	pc = &line;
+    else {
+	pc = G_calloc(1, sizeof(struct piece));
+	if (b->n_pieces == b->alloc_pieces) {
+	    b->alloc_pieces += 100;
+	    b->pieces = G_realloc(b->pieces,
+				  b->alloc_pieces * sizeof(struct piece *));
+	}
+	b->pieces[b->n_pieces++] = pc;
+    }
+    pc->n = 0;
+
+    /* collect the points, the points at seams are not kept */
+    point = line_begin;
+    if (line_begin->seam == 0)
+	add_point(pc, point);
+    for (i = 0; i < n; i++) {
+	last = point;
+
+	/* this should NEVER happen */
+	if ((point = move_dir(point, &b->direction)) == NULPTR)
+	    G_fatal_error(_("write_bnd:  line terminated unexpectedly\n"
+			    "previous (%d) point %d (%d,%d,%d) %p %p"),
+			  b->direction, i, last->row, last->col, last->node,
+			  (void *)last->fptr, (void *)last->bptr);
+
+	if (i < n - 1 || line_end->seam == 0)
+	    add_point(pc, point);
+    }
+
+    if (b->stream)
+	write_points(pc->rc, pc->n);
+    else {
+	pc->seam[0] = line_begin->seam;
+	pc->col[0] = line_begin->col;
+	pc->seam[1] = line_end->seam;
+	pc->col[1] = line_end->col;
+	pc->open = (pc->seam[0] != 0) + (pc->seam[1] != 0);
+	pc->parent = pc;
+    }
 
     /* now free all the pointers */
-    direction = dir;
+    b->direction = dir;
     point = line_begin;
     last = NULPTR;
     n1 = 0;
 
     /* skip first and last point */
-    while ((point = move(point)) == line_begin);
+    while ((point = move_dir(point, &b->direction)) == line_begin);
 
     while (point && point != line_end) {
 	last = point;
 	n1++;
-	point = move(point);
+	point = move_dir(point, &b->direction);
 
 	if (point == last) {
 	    /* should not happen */
 	    G_warning("loop during free ptrs, ptr %d of %d", n1, n);
-	    point = move(point);
+	    point = move_dir(point, &b->direction);
 	}
 
 	if (last->fptr != NULPTR)
@@ -107,7 +152,8 @@ int write_boundary(struct COOR *seed)
 	    if (last->bptr->bptr == last)
 		last->bptr->bptr = NULPTR;
 
-	free_ptr(last);
+	G_free(last);
+	b->n_alloced_ptrs--;
     }
 
     if (point != line_end) {
@@ -116,48 +162,55 @@ int write_boundary(struct COOR *seed)
     }
 
     /* free first and last point */
-    free_ptr(line_begin);
-    if (line_end != line_begin)
-	free_ptr(line_end);
+    G_free(line_begin);
+    b->n_alloced_ptrs--;
+    if (line_end != line_begin) {
+	G_free(line_end);
+	b->n_alloced_ptrs--;
+    }
 
     return (0);
 }
 
+static void add_point(struct piece *pc, const struct COOR *point)
+{
+    if (pc->n == pc->alloc) {
+	pc->alloc = pc->alloc ? 2 * pc->alloc : 16;
+	pc->rc = G_realloc(pc->rc, 2 * pc->alloc * sizeof(int));
+    }
+    pc->rc[2 * pc->n] = point->row;
+    pc->rc[2 * pc->n + 1] = point->col;
+    pc->n++;
+}
+
+/* write_points - write the rows and columns of a boundary */
+void write_points(const int *rc, int n)
+{
+    if (smooth_flag == SMOOTH)
+	write_smooth_bnd(rc, n);
+    else
+	write_bnd(rc, n);
+}
+
 
 /* write_bnd - actual writing part of write_line */
 /* writes binary and ASCII digit files and supplemental file */
-static int write_bnd(struct COOR *line_begin, struct COOR *line_end,	/* start and end point of line */
+static int write_bnd(const int *rc,	/* row, col of the points */
 		     int n	/* number of points to write */
     )
 {
     static struct line_pnts *points = NULL;
     double x;
     double y;
-    struct COOR *p, *last;
     int i;
 
     if (!points)
 	points = Vect_new_line_struct();
     Vect_reset_line(points);
 
-    p = line_begin;
-    y = cell_head.north - (double)p->row * cell_head.ns_res;
-    x = cell_head.west + (double)p->col * cell_head.ew_res;
-
-    Vect_append_point(points, x, y, 0.0);
-
     for (i = 0; i < n; i++) {
-	last = p;
-
-	/* this should NEVER happen */
-	if ((p = move(p)) == NULPTR)
-	    G_fatal_error(_("write_bnd:  line terminated unexpectedly\n"
-			    "previous (%d) point %d (%d,%d,%d) %p %p"),
-			  direction, i, last->row, last->col, last->node,
-			  (void *)last->fptr, (void *)last->bptr);
-
-	y = cell_head.north - p->row * cell_head.ns_res;
-	x = cell_head.west + p->col * cell_head.ew_res;
+	y = cell_head.north - (double)rc[2 * i] * cell_head.ns_res;
+	x = cell_head.west + (double)rc[2 * i + 1] * cell_head.ew_res;
 
 	Vect_append_point(points, x, y, 0.0);
     }
@@ -172,7 +225,7 @@ static int write_bnd(struct COOR *line_begin, struct COOR *line_end,	/* start an
 /* writes binary and ASCII digit files and supplemental file */
 #define SNAP_THRESH 0.00001
 
-static int write_smooth_bnd(struct COOR *line_begin, struct COOR *line_end,	/* start and end point of line */
+static int write_smooth_bnd(const int *rc,	/* row, col of the points */
 			    int n	/* number of points to write */
     )
 {
@@ -180,53 +233,41 @@ static int write_smooth_bnd(struct COOR *line_begin, struct COOR *line_end,	/* s
     double x, y;
     double dx, dy;
     int idx, idy;
-    struct COOR *p, *last;
     int i, total;
 
     if (!points)
 	points = Vect_new_line_struct();
     Vect_reset_line(points);
 
-    p = line_begin;
-    /* allocate the arrays and get the first point */
+    /* get the first point */
 
-    y = cell_head.north - (double)p->row * cell_head.ns_res;
-    x = cell_head.west + (double)p->col * cell_head.ew_res;
+    y = cell_head.north - (double)rc[0] * cell_head.ns_res;
+    x = cell_head.west + (double)rc[1] * cell_head.ew_res;
     Vect_append_point(points, x, y, 0.0);
 
     /* generate the list of smoothed points, may be duplicate points */
     total = 1;
-    for (i = 0; i < n; i++) {
+    for (i = 1; i < n; i++) {
 	if (i < 10)
-	    G_debug(3, " row: %d col: %d\n", p->row, p->col);
+	    G_debug(3, " row: %d col: %d\n", rc[2 * i - 2], rc[2 * i - 1]);
 
-	last = p;
-	if ((p = move(p)) == NULPTR) {	/* this should NEVER happen */
-	    G_debug(3, "write_smooth_bnd:  line terminated unexpectedly\n");
-	    G_debug(3, "  previous (%d) point %d (%d,%d,%d) %p %p\n",
-		    direction, i, last->row, last->col, last->node,
-		    (void *)last->fptr, (void *)last->bptr);
-
-	    exit(EXIT_FAILURE);
-	}
-
-	idy = (p->row - last->row);
-	idx = (p->col - last->col);
+	idy = (rc[2 * i] - rc[2 * i - 2]);
+	idx = (rc[2 * i + 1] - rc[2 * i - 1]);
 	dy = (idy > 0) ? 0.5 : ((idy < 0) ? -0.5 : 0.0);	/* dy = 0.0, 0.5, or -0.5 */
 	dx = (idx > 0) ? 0.5 : ((idx < 0) ? -0.5 : 0.0);	/* dx = 0.0, 0.5, or -0.5 */
-	y = cell_head.north - (last->row + dy) * cell_head.ns_res;
-	x = cell_head.west + (last->col + dx) * cell_head.ew_res;
+	y = cell_head.north - (rc[2 * i - 2] + dy) * cell_head.ns_res;
+	x = cell_head.west + (rc[2 * i - 1] + dx) * cell_head.ew_res;
 	total++;
 	Vect_append_point(points, x, y, 0.0);
 
-	y = cell_head.north - (p->row - dy) * cell_head.ns_res;
-	x = cell_head.west + (p->col - dx) * cell_head.ew_res;
+	y = cell_head.north - (rc[2 * i] - dy) * cell_head.ns_res;
+	x = cell_head.west + (rc[2 * i + 1] - dx) * cell_head.ew_res;
 	total++;
 	Vect_append_point(points, x, y, 0.0);
     }				/* end of for i */
 
-    y = cell_head.north - (double)p->row * cell_head.ns_res;
-    x = cell_head.west + (double)p->col * cell_head.ew_res;
+    y = cell_head.north - (double)rc[2 * n - 2] * cell_head.ns_res;
+    x = cell_head.west + (double)rc[2 * n - 1] * cell_head.ew_res;
     total++;
     Vect_append_point(points, x, y, 0.0);
 
@@ -249,11 +290,8 @@ int write_area(struct area_table *a_list,	/* list of areas */
     struct line_pnts *points = Vect_new_line_struct();
     int n, i;
     struct area_table *p;
-    char *temp_buf;
     int *equivs;
-    int cat;
     int catNum;
-    double x, y;
 
     equivs = NULL;
     total_areas = 0;
@@ -288,83 +326,139 @@ int write_area(struct area_table *a_list,	/* list of areas */
     for (i = 0, p = a_list; i < n_areas; i++, p++) {
 	G_percent(i, n_areas, 3);
 
-	if (equivs[i] == i && p->width > 0 && !Rast_is_d_null_value(&(p->cat))) {
-	    char buf[1000];
+	if (equivs[i] == i)
+	    write_centroid(p, &catNum, points);
+    }
+    G_percent(1, 1, 1);
 
-	    if (value_flag) {	/* raster value */
-		cat = (int)p->cat;
-	    }
-	    else {		/* sequence */
-		cat = catNum;
-		catNum++;
-	    }
+    if (equivs)
+	G_free(equivs);
+    Vect_destroy_line_struct(points);
+    
+    return 0;
+}
+
+/* write_merged_areas - write areas of the bands, root[] gives the */
+/* smallest area number of the areas joined to an area */
+int write_merged_areas(struct area_table *a_list,	/* list of areas */
+		       int *root,	/* joined areas */
+		       int n_areas	/* lengths of a_list, root */
+    )
+{
+    struct line_pnts *points = Vect_new_line_struct();
+    struct area_table *p, *r;
+    int i, catNum;
+
+    /* the label goes to the widest strip of the joined areas */
+    total_areas = 0;
+    for (i = 0, p = a_list; i < n_areas; i++, p++) {
+	if (root[i] == i) {
+	    total_areas++;
+	    continue;
+	}
+	r = a_list + root[i];
+	if (p->width > r->width) {
+	    r->width = p->width;
+	    r->row = p->row;
+	    r->col = p->col;
+	}
+    }
+
+    catNum = 1;
+
+    G_important_message(_("Writing areas..."));
+    for (i = 0, p = a_list; i < n_areas; i++, p++) {
+	G_percent(i, n_areas, 3);
 
-	    x = cell_head.west + (p->col +
-				  (p->width / 2.0)) * cell_head.ew_res;
-	    y = cell_head.north - (p->row + 0.5) * cell_head.ns_res;
+	if (root[i] == i)
+	    write_centroid(p, &catNum, points);
+    }
+    G_percent(1, 1, 1);
+
+    Vect_destroy_line_struct(points);
+
+    return 0;
+}
 
+/* write_centroid - write the centroid and the attributes of an area */
+static int write_centroid(struct area_table *p, int *catNum,
+			  struct line_pnts *points)
+{
+    char *temp_buf;
+    int cat;
+    double x, y;
+
+    if (p->width > 0 && !Rast_is_d_null_value(&(p->cat))) {
+	char buf[1000];
+
+	if (value_flag) {	/* raster value */
+	    cat = (int)p->cat;
+	}
+	else {		/* sequence */
+	    cat = *catNum;
+	    (*catNum)++;
+	}
+
+	x = cell_head.west + (p->col + (p->width / 2.0)) * cell_head.ew_res;
+	y = cell_head.north - (p->row + 0.5) * cell_head.ns_res;
+
+	switch (data_type) {
+	case CELL_TYPE:
+	    G_debug(3,
+		    "vector x = %.3f, y = %.3f, cat = %d; raster cat = %d",
+		    x, y, cat, (int)p->cat);
+	    break;
+	case FCELL_TYPE:
+	    G_debug(3,
+		    "vector x = %.3f, y = %.3f, cat = %d; raster cat = %f",
+		    x, y, cat, (float)p->cat);
+	    break;
+	case DCELL_TYPE:
+	    G_debug(3,
+		    "vector x = %.3f, y = %.3f, cat = %d; raster cat = %lf",
+		    x, y, cat, p->cat);
+	    break;
+	}
+
+	Vect_reset_line(points);
+	Vect_append_point(points, x, y, 0.0);
+
+	Vect_reset_cats(Cats);
+	Vect_cat_set(Cats, 1, cat);
+
+	Vect_write_line(&Map, GV_CENTROID, points, Cats);
+
+	if (driver != NULL && !value_flag) {
+	    sprintf(buf, "insert into %s values (%d, ", Fi->table, cat);
+	    db_set_string(&sql, buf);
 	    switch (data_type) {
 	    case CELL_TYPE:
-		G_debug(3,
-			"vector x = %.3f, y = %.3f, cat = %d; raster cat = %d",
-			x, y, cat, (int)p->cat);
+		sprintf(buf, "%d", (int)p->cat);
 		break;
 	    case FCELL_TYPE:
-		G_debug(3,
-			"vector x = %.3f, y = %.3f, cat = %d; raster cat = %f",
-			x, y, cat, (float)p->cat);
-		break;
 	    case DCELL_TYPE:
-		G_debug(3,
-			"vector x = %.3f, y = %.3f, cat = %d; raster cat = %lf",
-			x, y, cat, p->cat);
+		sprintf(buf, "%f", p->cat);
 		break;
 	    }
+	    db_append_string(&sql, buf);
 
-	    Vect_reset_line(points);
-	    Vect_append_point(points, x, y, 0.0);
-
-	    Vect_reset_cats(Cats);
-	    Vect_cat_set(Cats, 1, cat);
-
-	    Vect_write_line(&Map, GV_CENTROID, points, Cats);
-
-	    if (driver != NULL && !value_flag) {
-		sprintf(buf, "insert into %s values (%d, ", Fi->table, cat);
-		db_set_string(&sql, buf);
-		switch (data_type) {
-		case CELL_TYPE:
-		    sprintf(buf, "%d", (int)p->cat);
-		    break;
-		case FCELL_TYPE:
-		case DCELL_TYPE:
-		    sprintf(buf, "%f", p->cat);
-		    break;
-		}
-		db_append_string(&sql, buf);
-
-		if (has_cats) {
-		    temp_buf = Rast_get_d_cat(&p->cat, &RastCats);
+	    if (has_cats) {
+		temp_buf = Rast_get_d_cat(&p->cat, &RastCats);
 
-		    db_set_string(&label, temp_buf);
-		    db_double_quote_string(&label);
-		    sprintf(buf, ", '%s'", db_get_string(&label));
-		    db_append_string(&sql, buf);
-		}
+		db_set_string(&label, temp_buf);
+		db_double_quote_string(&label);
+		sprintf(buf, ", '%s'", db_get_string(&label));
+		db_append_string(&sql, buf);
+	    }
 
-		db_append_string(&sql, ")");
-		G_debug(3, "%s", db_get_string(&sql));
+	    db_append_string(&sql, ")");
+	    G_debug(3, "%s", db_get_string(&sql));
 
-		if (db_execute_immediate(driver, &sql) != DB_OK)
-		    G_fatal_error(_("Cannot insert new row: %s"),
-				  db_get_string(&sql));
-	    }
+	    if (db_execute_immediate(driver, &sql) != DB_OK)
+		G_fatal_error(_("Cannot insert new row: %s"),
+			      db_get_string(&sql));
 	}
     }
-    G_percent(1, 1, 1);
 
-    if (equivs)
-	G_free(equivs);
-    
     return 0;
 }
@@ -29,6 +29,9 @@
 #define SMOOTH 1
 #define NO_SMOOTH 0
 
+#define SEAM_TOP 1
+#define SEAM_BOTTOM 2
+
 #define CATNUM 0
 #define CATLABEL 1
 
@@ -62,6 +65,7 @@ struct COOR
     int val;			/* CELL value */
     double dval;		/* FCELL/DCELL value */
     double right, left;		/* areas to right and left of line */
+    int seam;			/* end of a line at the seam of a band */
 
 };
 
@@ -98,6 +102,44 @@ struct equiv_table
     int *ptr;			/*   and pointer to them */
 };
 
+/* piece - boundary traced in a band of rows; the points at the seams */
+/* of the band are not stored, pieces are joined there to boundaries */
+
+struct piece
+{
+    int *rc;			/* row, col of the points */
+    int n, alloc;		/* number of points, allocated points */
+    int seam[2];		/* first, last point at a seam (SEAM_*) */
+    int col[2];			/*   and its column */
+    struct piece *link[2];	/* pieces joined at the first, last point */
+    int link_end[2];		/*   and their ends */
+    struct piece *parent;	/* union of the joined pieces */
+    int open;			/*   and number of its unjoined seam ends */
+};
+
+/* band - state of the area extraction in a band of rows */
+
+struct band
+{
+    int row0, row1;		/* first row, row after the last one */
+    int row, col;		/* current position */
+    void *top, *bottom;		/* rows of the current 2 by 2 window */
+    double tl, tr, bl, br;	/* values in the window */
+    struct COOR **v_list;	/* vertical lines under construction */
+    struct COOR *h_ptr;		/* horizontal line under construction */
+    int n_areas, area_num, n_equiv, tl_area;
+    struct area_table *a_list, *a_list_new, *a_list_old;
+    struct equiv_table *e_list;
+    int area_offset;		/* number of the first area when merged */
+    int direction;		/* direction of move_dir() */
+    int n_alloced_ptrs;
+    int stream;			/* write the boundaries immediately */
+    struct piece **pieces;	/* otherwise pieces to be joined */
+    int n_pieces, alloc_pieces;
+    int *top_left, *top_right;	/* areas of lines at the top seam */
+    int *bottom_left, *bottom_right;	/*   and the bottom seam */
+};
+
 
 /* lines.c */
 int alloc_lines_bufs(int);
@@ -109,18 +151,21 @@ int write_line(struct COOR *);
 /* areas.c */
 int alloc_areas_bufs(int);
 int extract_areas(void);
-int more_equivs(void);
 
 /* areas_io.c */
-int write_boundary(struct COOR *);
+int write_boundary(struct band *, struct COOR *);
+void write_points(const int *, int);
 int write_area(struct area_table *, struct equiv_table *, int, int);
+int write_merged_areas(struct area_table *, int *, int);
 
 /* points.c */
 int extract_points(int);
 
 /* util.c */
 struct COOR *move(struct COOR *);
+struct COOR *move_dir(struct COOR *, int *);
 struct COOR *find_end(struct COOR *, int, int *, int *);
+struct COOR *find_end_dir(struct COOR *, int, int *, int *, int *);
 int at_end(struct COOR *);
 int read_row(void *);
 void insert_value(int, int, double);
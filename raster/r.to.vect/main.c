@@ -65,7 +65,7 @@ static int cmp_int(const void *a, const void *b)
 int main(int argc, char *argv[])
 {
     struct GModule *module;
-    struct Option *in_opt, *out_opt, *feature_opt, *column_name;
+    struct Option *in_opt, *out_opt, *feature_opt, *column_name, *nprocs_opt;
     struct Flag *smooth_flg, *value_flg, *z_flg, *no_topol, *notab_flg;
     int feature, notab_flag;
 
@@ -95,6 +95,8 @@ int main(int argc, char *argv[])
     column_name->description = _("Name must be SQL compliant");
     column_name->answer = "value";
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     smooth_flg = G_define_flag();
     smooth_flg->key = 's';
     smooth_flg->description = _("Smooth corners of area features");
@@ -122,6 +124,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
+
     feature = Vect_option_to_types(feature_opt);
     smooth_flag = (smooth_flg->answer) ? SMOOTH : NO_SMOOTH;
     value_flag = value_flg->answer;
@@ -54,6 +54,12 @@ class Testrr(TestCase):
         topology = dict(points=0, lines=0, areas=33)
         self.assertVectorFitsTopoInfo(self.output, topology)
 
+    def test_nprocs(self):
+        """Testing areas traced on several threads"""
+        self.assertModule('r.to.vect', input=self.input, output=self.output, type=self.area, flags='t', nprocs=4)
+        topology = dict(points=0, lines=0, areas=33)
+        self.assertVectorFitsTopoInfo(self.output, topology)
+
 
 if __name__ == '__main__':
     from grass.gunittest.main import test
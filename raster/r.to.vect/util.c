@@ -22,18 +22,26 @@ static int blank_line(void *buf);
 
 struct COOR *move(struct COOR *point)
 {
-    if (direction == FORWARD) {
+    return move_dir(point, &direction);
+}
+
+/* move_dir - move to next point in line, with the direction of the */
+/* caller */
+
+struct COOR *move_dir(struct COOR *point, int *dir)
+{
+    if (*dir == FORWARD) {
 	if (point->fptr == NULL)	/* at open end of line */
 	    return (NULL);
 	if (point->fptr->fptr == point)	/* direction change coming up */
-	    direction = BACKWARD;
+	    *dir = BACKWARD;
 	return (point->fptr);
     }
     else {
 	if (point->bptr == NULL)
 	    return (NULL);
 	if (point->bptr->bptr == point)
-	    direction = FORWARD;
+	    *dir = FORWARD;
 	return (point->bptr);
     }
 }
@@ -42,14 +50,22 @@ struct COOR *move(struct COOR *point)
 /* moving in a given direction */
 
 struct COOR *find_end(struct COOR *seed, int dir, int *result, int *n)
+{
+    return find_end_dir(seed, dir, result, n, &direction);
+}
+
+/* find_end_dir - find_end() with the direction of the caller */
+
+struct COOR *find_end_dir(struct COOR *seed, int dir, int *result, int *n,
+			  int *cur_dir)
 {
     struct COOR *start;
 
     start = seed;
-    direction = dir;
+    *cur_dir = dir;
     *result = *n = 0;
     while (!*result) {
-	seed = move(seed);
+	seed = move_dir(seed, cur_dir);
 	(*n)++;
 	if (seed == start)
 	    *result = LOOP;
@@ -1,11 +1,10 @@
 #include <grass/gis.h>
 #include <grass/raster.h>
 
-#define	cv(i,j)			cell[i][j]
-#define	av(i,j)			a[i][j]
-#define	atbv(i,j)		atb[i][j]
-#define	is_cv_null(i,j)		Rast_is_d_null_value(&cv(i,j))
-#define	is_atbv_null(i,j)	Rast_is_d_null_value(&atbv(i,j))
+#define	cv(i,j)			cell[(size_t)(i) * window.cols + (j)]
+#define	atbv(i,j)		atb[(size_t)(i) * window.cols + (j)]
+#define	is_cv_null(i,j)		Rast_is_f_null_value(&cv(i,j))
+#define	is_atbv_null(i,j)	Rast_is_f_null_value(&atbv(i,j))
 
 #define	ZERO			0.0000001
 
@@ -17,8 +16,8 @@
 
 GLOBAL char *input, *output;
 GLOBAL struct Cell_head window;
-GLOBAL DCELL **cell;
-GLOBAL DCELL **atb, **a;
+GLOBAL FCELL *cell;		/* elevation */
+GLOBAL FCELL *atb;		/* upslope area, then topographic index */
 
 void read_cells(void);
 void write_cells(void);
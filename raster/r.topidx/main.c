@@ -31,6 +31,7 @@ int main(int argc, char **argv)
     {
 	struct Option *input;
 	struct Option *output;
+	struct Option *nprocs;
     } params;
 
     G_gisinit(argv[0]);
@@ -49,6 +50,8 @@ int main(int argc, char **argv)
     params.output = G_define_standard_option(G_OPT_R_OUTPUT);
     params.output->description = _("Name for output topographic index raster map");
 
+    params.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
@@ -57,6 +60,8 @@ int main(int argc, char **argv)
 	G_fatal_error(_("Lat/Long location is not supported by %s. Please reproject map first."),
 		      G_program_name());
 
+    G_set_nprocs(params.nprocs);
+
     input = params.input->answer;
     output = params.output->answer;
 
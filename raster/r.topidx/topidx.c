@@ -4,270 +4,346 @@
 #include <grass/glocale.h>
 #include "global.h"
 
-int natb;
+/* The cells are processed in the order of the flow: a cell is ready
+ * once all neighbours draining into it are done, and then pulls its
+ * upslope area from them in one step. The cells which become ready
+ * together form a front; the cells of a front are processed by the
+ * worker threads, each of which writes only the cells of its part of
+ * the front, and the next front is collected the same way.
+ *
+ * While a cell waits, atb holds nothing; once it is done, atb holds
+ * C = upslope area / sum of the routes out of the cell, or the index
+ * itself for sinks and boundaries. The indices of the other cells are
+ * log(C), taken at the end. */
 
-void initialize(void)
+#define DONE	1		/* atb holds C */
+#define SINK	2		/* atb holds the index */
+#define FRESH	4		/* done in the current front */
+#define NONE	8		/* null elevation */
+
+#define PARTS_PER_WORKER 4
+#define MIN_PART 1024
+
+static const int nbr_row[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+static const int nbr_col[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+static const int nbr_diag[8] = { 1, 0, 1, 0, 0, 1, 0, 1 };
+
+static unsigned char *state;
+static size_t ncells, nnull;
+static double dx, dx1, dx2, cell_area;
+
+struct front
 {
-    int i, j;
+    size_t n, alloc;
+    size_t *cells;
+};
 
-    natb = 0;
-    for (i = 0; i < window.rows; i++) {
-	for (j = 0; j < window.cols; j++) {
-	    av(i, j) = window.ns_res * window.ew_res;
-	    if (is_cv_null(i, j)) {
-		natb++;
-		Rast_set_d_null_value(&atbv(i, j), 1);
-	    }
-	    else {
-		atbv(i, j) = -10.0;
+struct part
+{
+    size_t first, last;		/* cells of the front */
+    struct front next;		/* cells found for the next front */
+    int nsink;
+};
+
+static void add_cell(struct front *f, size_t c)
+{
+    if (f->n == f->alloc) {
+	f->alloc = f->alloc ? 2 * f->alloc : 1024;
+	f->cells = G_realloc(f->cells, f->alloc * sizeof(size_t));
+    }
+    f->cells[f->n++] = c;
+}
+
+/* neighbour k of cell i, j if it has an elevation, else -1 */
+static long neighbour(int i, int j, int k)
+{
+    int ni = i + nbr_row[k], nj = j + nbr_col[k];
+    size_t n;
+
+    if (ni < 0 || ni >= window.rows || nj < 0 || nj >= window.cols)
+	return -1;
+    n = (size_t)ni * window.cols + nj;
+    if (Rast_is_f_null_value(&cell[n]))
+	return -1;
+
+    return (long)n;
+}
+
+/* slope from a to b, routes follow slopes over ZERO */
+static double drop(size_t a, size_t b)
+{
+    return (double)cell[a] - cell[b];
+}
+
+static double tan_b(double d, int k)
+{
+    return d * (nbr_diag[k] ? dx2 : dx1);
+}
+
+static double route(double d, int k)
+{
+    return (nbr_diag[k] ? 0.354 : 0.5) * dx * tan_b(d, k);
+}
+
+/* 1 if all neighbours draining into cell c are done */
+static int is_ready(size_t c)
+{
+    int i = c / window.cols, j = c % window.cols, k;
+
+    for (k = 0; k < 8; k++) {
+	long n = neighbour(i, j, k);
+
+	if (n >= 0 && drop(n, c) > ZERO && !(state[n] & (DONE | SINK)))
+	    return 0;
+    }
+
+    return 1;
+}
+
+/* pull the upslope area of a ready cell and route it */
+static int process_cell(size_t c)
+{
+    int i = c / window.cols, j = c % window.cols, k, nslp;
+    double area = cell_area, sum = 0.0, sumtb = 0.0, d;
+
+    for (k = 0; k < 8; k++) {
+	long n = neighbour(i, j, k);
+
+	if (n < 0)
+	    continue;
+	d = drop(n, c);
+	if (d > ZERO)
+	    area += atb[n] * route(d, k);
+	else if (-d > ZERO)
+	    sum += route(-d, k);
+    }
+
+    if (sum > 0.0) {
+	atb[c] = area / sum;
+	state[c] = DONE | FRESH;
+	return 0;
+    }
+
+    /* sink or boundary node */
+    G_debug(1, "Sink or boundary node at %d, %d", i, j);
+    nslp = 0;
+    for (k = 0; k < 8; k++) {
+	long n = neighbour(i, j, k);
+
+	if (n < 0)
+	    continue;
+	sumtb += tan_b(drop(n, c), k);
+	nslp++;
+    }
+    if (nslp > 0 && (sumtb /= nslp) > ZERO)
+	atb[c] = log(area / (2 * dx * sumtb));
+    else
+	Rast_set_f_null_value(&atb[c], 1);
+    state[c] = SINK | FRESH;
+
+    return 1;
+}
+
+/* the neighbours of c which become ready with it; each is found only
+ * from the first of its upslope neighbours in the current front */
+static void find_ready(size_t c, struct front *next)
+{
+    int i = c / window.cols, j = c % window.cols, k, l;
+
+    for (k = 0; k < 8; k++) {
+	long m = neighbour(i, j, k);
+	int mi, mj, first = 1;
+
+	if (m < 0 || drop(c, m) <= ZERO || !is_ready(m))
+	    continue;
+
+	mi = m / window.cols;
+	mj = m % window.cols;
+	for (l = 0; l < 8; l++) {
+	    long n = neighbour(mi, mj, l);
+
+	    if (n == (long)c)
+		break;
+	    if (n >= 0 && (state[n] & FRESH) && drop(n, m) > ZERO) {
+		first = 0;
+		break;
 	    }
 	}
+	if (first)
+	    add_cell(next, m);
     }
 }
 
-void calculate_atanb(void)
+struct pass
 {
-    int i, j, k, snatb;
-    int iter, ncells, nroute, nslp;
-    double sum, route[9], tanB[9], dx, dx1, dx2, sumtb, C;
-    int nsink;
+    const struct front *front;
+    struct part *parts;
+};
+
+static void initial_front(int first, int last, void *closure)
+{
+    struct pass *p = closure;
+    int i, j;
+
+    for (; first < last; first++) {
+	struct part *part = &p->parts[first];
+
+	for (i = part->first; i < part->last; i++)
+	    for (j = 0; j < window.cols; j++) {
+		size_t c = (size_t)i * window.cols + j;
+
+		if (!(state[c] & NONE) && is_ready(c))
+		    add_cell(&part->next, c);
+	    }
+    }
+}
+
+static void process_front(int first, int last, void *closure)
+{
+    struct pass *p = closure;
+    size_t i;
+
+    for (; first < last; first++) {
+	struct part *part = &p->parts[first];
+
+	for (i = part->first; i < part->last; i++)
+	    part->nsink += process_cell(p->front->cells[i]);
+    }
+}
+
+static void next_front(int first, int last, void *closure)
+{
+    struct pass *p = closure;
+    size_t i;
+
+    for (; first < last; first++) {
+	struct part *part = &p->parts[first];
+
+	for (i = part->first; i < part->last; i++)
+	    find_ready(p->front->cells[i], &part->next);
+    }
+}
+
+static void clear_fresh(int first, int last, void *closure)
+{
+    struct pass *p = closure;
+    size_t i;
+
+    for (; first < last; first++) {
+	struct part *part = &p->parts[first];
+
+	for (i = part->first; i < part->last; i++)
+	    state[p->front->cells[i]] &= ~FRESH;
+    }
+}
+
+static void take_logs(int first, int last, void *closure)
+{
+    size_t c, end = (size_t)last * window.cols;
+
+    for (c = (size_t)first * window.cols; c < end; c++)
+	if (state[c] & DONE)
+	    atb[c] = log(atb[c]);
+	else if (state[c] & NONE)
+	    Rast_set_f_null_value(&atb[c], 1);
+}
+
+/* split n items into parts */
+static int split(struct part *parts, int maxparts, size_t n)
+{
+    int nparts = n / MIN_PART + 1, k;
+
+    if (nparts > maxparts)
+	nparts = maxparts;
+    for (k = 0; k < nparts; k++) {
+	parts[k].first = n * k / nparts;
+	parts[k].last = n * (k + 1) / nparts;
+	parts[k].next.n = 0;
+	parts[k].nsink = 0;
+    }
+
+    return nparts;
+}
+
+void initialize(void)
+{
+    size_t c;
+
+    ncells = (size_t)window.rows * window.cols;
+    state = G_calloc(ncells, 1);
+
+    nnull = 0;
+    for (c = 0; c < ncells; c++) {
+	if (Rast_is_f_null_value(&cell[c])) {
+	    state[c] = NONE;
+	    nnull++;
+	}
+    }
 
     dx = window.ew_res;
     dx1 = 1 / dx;
     dx2 = 1 / (1.414 * dx);
-    ncells = window.rows * window.cols;
-    snatb = natb;
+    cell_area = window.ns_res * window.ew_res;
+}
+
+void calculate_atanb(void)
+{
+    struct front front;
+    struct part *parts;
+    struct pass pass;
+    int maxparts, nparts, k;
+    size_t done, nsink;
 
     G_important_message(_("Calculating..."));
 
-    nsink = 0;
-    for (iter = 1; natb < ncells; iter++) {
-	/*
-	   for(i=0;i<80;i++)
-	   fprintf(stderr,"\b");
-	   fprintf(stderr,"Iteration: %d",iter);
-	 */
-	G_percent(natb - snatb, ncells - snatb, 1);
-	for (i = 0; i < window.rows; i++) {
-	    for (j = 0; j < window.cols; j++) {
-		/* skip null values */
-		if (is_cv_null(i, j))
-		    continue;
-
-		/* skip squares already done */
-		if (is_atbv_null(i, j) || atbv(i, j) >= ZERO)
-		    continue;
-
-		/* check the 8 possible flow directions for
-		 * upslope elements without an atb value
-		 */
-		if (i > 0) {
-		    if (j > 0 &&
-			(is_cv_null(i - 1, j - 1) ||
-			 cv(i - 1, j - 1) > cv(i, j)) &&
-			!is_atbv_null(i - 1, j - 1) &&
-			atbv(i - 1, j - 1) < ZERO)
-			continue;
-
-		    if ((is_cv_null(i - 1, j) ||
-			 cv(i - 1, j) > cv(i, j)) &&
-			!is_atbv_null(i - 1, j) && atbv(i - 1, j) < ZERO)
-			continue;
-
-		    if (j + 1 < window.cols &&
-			(is_cv_null(i - 1, j + 1) ||
-			 cv(i - 1, j + 1) > cv(i, j)) &&
-			!is_atbv_null(i - 1, j + 1) &&
-			atbv(i - 1, j + 1) < ZERO)
-			continue;
-		}
-		if (j > 0 &&
-		    (is_cv_null(i, j - 1) ||
-		     cv(i, j - 1) > cv(i, j)) &&
-		    !is_atbv_null(i, j - 1) && atbv(i, j - 1) < ZERO)
-		    continue;
-		if (j + 1 < window.cols &&
-		    (is_cv_null(i, j + 1) ||
-		     cv(i, j + 1) > cv(i, j)) &&
-		    !is_atbv_null(i, j + 1) && atbv(i, j + 1) < ZERO)
-		    continue;
-		if (i + 1 < window.rows) {
-		    if (j > 0 &&
-			(is_cv_null(i + 1, j - 1) ||
-			 cv(i + 1, j - 1) > cv(i, j)) &&
-			!is_atbv_null(i + 1, j - 1) &&
-			atbv(i + 1, j - 1) < ZERO)
-			continue;
-		    if ((is_cv_null(i + 1, j) ||
-			 cv(i + 1, j) > cv(i, j)) &&
-			!is_atbv_null(i + 1, j) && atbv(i + 1, j) < ZERO)
-			continue;
-		    if (j + 1 < window.cols &&
-			(is_cv_null(i + 1, j + 1) ||
-			 cv(i + 1, j + 1) > cv(i, j)) &&
-			!is_atbv_null(i + 1, j + 1) &&
-			atbv(i + 1, j + 1) < ZERO)
-			continue;
-		}
-		/* find the outflow directions and calculate 
-		 * the sum of weights
-		 */
-		sum = 0.0;
-		for (k = 0; k < 9; k++)
-		    route[k] = 0.0;
-		nroute = 0;
-		if (i > 0) {
-		    if (j > 0 &&
-			!is_cv_null(i - 1, j - 1) &&
-			cv(i, j) - cv(i - 1, j - 1) > ZERO) {
-			tanB[0] = (cv(i, j) - cv(i - 1, j - 1)) * dx2;
-			route[0] = 0.354 * dx * tanB[0];
-			sum += route[0];
-			nroute++;
-		    }
-		    if (!is_cv_null(i - 1, j) &&
-			cv(i, j) - cv(i - 1, j) > ZERO) {
-			tanB[1] = (cv(i, j) - cv(i - 1, j)) * dx1;
-			route[1] = 0.5 * dx * tanB[1];
-			sum += route[1];
-			nroute++;
-		    }
-		    if (j + 1 < window.cols &&
-			!is_cv_null(i - 1, j + 1) &&
-			cv(i, j) - cv(i - 1, j + 1) > ZERO) {
-			tanB[2] = (cv(i, j) - cv(i - 1, j + 1)) * dx2;
-			route[2] = 0.354 * dx * tanB[2];
-			sum += route[2];
-			nroute++;
-		    }
-		}
-		if (j > 0 &&
-		    !is_cv_null(i, j - 1) && cv(i, j) - cv(i, j - 1) > ZERO) {
-		    tanB[3] = (cv(i, j) - cv(i, j - 1)) * dx1;
-		    route[3] = 0.5 * dx * tanB[3];
-		    sum += route[3];
-		    nroute++;
-		}
-		if (j + 1 < window.cols) {
-		    if (!is_cv_null(i, j + 1) &&
-			cv(i, j) - cv(i, j + 1) > ZERO) {
-			tanB[5] = (cv(i, j) - cv(i, j + 1)) * dx1;
-			route[5] = 0.5 * dx * tanB[5];
-			sum += route[5];
-			nroute++;
-		    }
-		}
-		if (i + 1 < window.rows) {
-		    if (j > 0 &&
-			!is_cv_null(i + 1, j - 1) &&
-			cv(i, j) - cv(i + 1, j - 1) > ZERO) {
-			tanB[6] = (cv(i, j) - cv(i + 1, j - 1)) * dx2;
-			route[6] = 0.354 * dx * tanB[6];
-			sum += route[6];
-			nroute++;
-		    }
-		    if (!is_cv_null(i + 1, j) &&
-			cv(i, j) - cv(i + 1, j) > ZERO) {
-			tanB[7] = (cv(i, j) - cv(i + 1, j)) * dx1;
-			route[7] = 0.5 * dx * tanB[7];
-			sum += route[7];
-			nroute++;
-		    }
-		    if (j + 1 < window.cols &&
-			!is_cv_null(i + 1, j + 1) &&
-			cv(i, j) - cv(i + 1, j + 1) > ZERO) {
-			tanB[8] = (cv(i, j) - cv(i + 1, j + 1)) * dx2;
-			route[8] = 0.354 * dx * tanB[8];
-			sum += route[8];
-			nroute++;
-		    }
-		}
-
-		if (!nroute) {
-		    G_debug(1, "Sink or boundary node at %d, %d\n", i, j);
-		    nsink++;
-		    sumtb = 0.0;
-		    nslp = 0;
-		    if (i > 0) {
-			if (j > 0 && !is_cv_null(i - 1, j - 1)) {
-			    sumtb += (cv(i - 1, j - 1) - cv(i, j)) * dx2;
-			    nslp++;
-			}
-			if (!is_cv_null(i - 1, j)) {
-			    sumtb += (cv(i - 1, j) - cv(i, j)) * dx1;
-			    nslp++;
-			}
-			if (j + 1 < window.cols && !is_cv_null(i - 1, j + 1)) {
-			    sumtb += (cv(i - 1, j + 1) - cv(i, j)) * dx2;
-			    nslp++;
-			}
-		    }
-
-		    if (j > 0 && !is_cv_null(i, j - 1)) {
-			sumtb += (cv(i, j - 1) - cv(i, j)) * dx1;
-			nslp++;
-		    }
-		    if (j + 1 < window.cols && !is_cv_null(i, j + 1)) {
-			sumtb += (cv(i, j + 1) - cv(i, j)) * dx1;
-			nslp++;
-		    }
-		    if (i + 1 < window.rows) {
-			if (j > 0 && !is_cv_null(i + 1, j - 1)) {
-			    sumtb += (cv(i + 1, j - 1) - cv(i, j)) * dx2;
-			    nslp++;
-			}
-			if (!is_cv_null(i + 1, j)) {
-			    sumtb += (cv(i + 1, j) - cv(i, j)) * dx1;
-			    nslp++;
-			}
-			if (j + 1 < window.cols && !is_cv_null(i + 1, j + 1)) {
-			    sumtb += (cv(i + 1, j + 1) - cv(i, j)) * dx2;
-			    nslp++;
-			}
-		    }
-
-		    sumtb /= nslp;
-		    if (sumtb > ZERO) {
-			atbv(i, j) = log((av(i, j) / (2 * dx * sumtb)));
-		    }
-		    else {
-			Rast_set_d_null_value(&atbv(i, j), 1);
-		    }
-		    natb++;
-		    continue;
-		}
-
-		C = av(i, j) / sum;
-		atbv(i, j) = log(C);
-		natb++;
-
-		if (i > 0) {
-		    if (j > 0) {
-			av(i - 1, j - 1) += C * route[0];
-		    }
-		    av(i - 1, j) += C * route[1];
-		    if (j + 1 < window.cols) {
-			av(i - 1, j + 1) += C * route[2];
-		    }
-		}
-		if (j > 0) {
-		    av(i, j - 1) += C * route[3];
-		}
-		if (j + 1 < window.cols) {
-		    av(i, j + 1) += C * route[5];
-		}
-		if (i + 1 < window.rows) {
-		    if (j > 0) {
-			av(i + 1, j - 1) += C * route[6];
-		    }
-		    av(i + 1, j) += C * route[7];
-		    if (j + 1 < window.cols) {
-			av(i + 1, j + 1) += C * route[8];
-		    }
-		}
-	    }
-	}
+    maxparts = PARTS_PER_WORKER * (G_num_workers() + 1);
+    parts = G_calloc(maxparts, sizeof(struct part));
+    front.n = front.alloc = 0;
+    front.cells = NULL;
+    pass.front = &front;
+    pass.parts = parts;
+
+    /* cells without upslope neighbours, by rows */
+    nparts = maxparts < window.rows ? maxparts : window.rows;
+    for (k = 0; k < nparts; k++) {
+	parts[k].first = (size_t)window.rows * k / nparts;
+	parts[k].last = (size_t)window.rows * (k + 1) / nparts;
+	parts[k].next.n = 0;
+    }
+    G_parallel_for(0, nparts, 1, initial_front, &pass);
+
+    done = nsink = 0;
+    while (1) {
+	size_t i;
+
+	/* collect the front */
+	front.n = 0;
+	for (k = 0; k < nparts; k++)
+	    for (i = 0; i < parts[k].next.n; i++)
+		add_cell(&front, parts[k].next.cells[i]);
+	if (front.n == 0)
+	    break;
+
+	nparts = split(parts, maxparts, front.n);
+	G_parallel_for(0, nparts, 1, process_front, &pass);
+	G_parallel_for(0, nparts, 1, next_front, &pass);
+	G_parallel_for(0, nparts, 1, clear_fresh, &pass);
+
+	for (k = 0; k < nparts; k++)
+	    nsink += parts[k].nsink;
+	done += front.n;
+	G_percent(done, ncells - nnull, 1);
     }
-    G_percent(natb - snatb, ncells - snatb, 1);
-    G_important_message(_("Number of sinks or boundaries: %d"), nsink);
+    G_percent(1, 1, 1);
+
+    G_parallel_for(0, window.rows, 16, take_logs, NULL);
+
+    for (k = 0; k < maxparts; k++)
+	G_free(parts[k].next.cells);
+    G_free(parts);
+    G_free(front.cells);
+    G_free(state);
+
+    G_important_message(_("Number of sinks or boundaries: %lu"),
+			(unsigned long)nsink);
 }
@@ -22,13 +22,14 @@
 #include <grass/gis.h>
 #include <grass/raster3d.h>
 #include <grass/raster.h>
+#include <grass/stats.h>
 #include <grass/glocale.h>
 
 /*- Parameters and global variables -----------------------------------------*/
 typedef struct
 {
     double sum;
-    double sumsq;
+    double m2;			/* sum of squared deviations from the mean */
     double min;
     double max;
     unsigned int n_perc;
@@ -43,6 +44,7 @@ typedef struct
     void *nextp;
     size_t n_alloc;
     int first;
+    struct stat_tdigest *digest;	/* approximate percentiles or NULL */
 } univar_stat;
 
 typedef struct
@@ -56,7 +58,9 @@ typedef struct
 typedef struct
 {
     struct Option *inputfile, *zonefile, *percentile, *output_file, *separator;
+    struct Option *nprocs;	/* r.univar only */
     struct Flag *shell_style, *extended, *table, *use_rast_region;
+    struct Flag *approx;	/* r.univar only */
 } param_type;
 
 extern param_type param;
@@ -70,5 +74,8 @@ int print_stats(univar_stat * stats);
 int print_stats_table(univar_stat * stats);
 univar_stat *create_univar_stat_struct(int map_type, int n_perc);
 void free_univar_stat_struct(univar_stat * stats);
+void add_univar_value(univar_stat * stats, double val);
+void merge_univar_stat(univar_stat * stats, unsigned long n, double sum,
+		       double sum_abs, double min, double max, double m2);
 
 #endif
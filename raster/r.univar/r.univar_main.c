@@ -19,6 +19,9 @@
 #include <string.h>
 #include "globals.h"
 
+/* rows per thread in a block of rows */
+#define BLOCK_ROWS 16
+
 param_type param;
 zone_type zone_info;
 
@@ -52,6 +55,8 @@ void set_params()
 	_("Percentile to calculate (requires extended statistics flag)");
     param.percentile->guisection = _("Extended");
     
+    param.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     param.separator = G_define_standard_option(G_OPT_F_SEP);
     param.separator->guisection = _("Formatting");
 
@@ -66,6 +71,12 @@ void set_params()
     param.extended->description = _("Calculate extended statistics");
     param.extended->guisection = _("Extended");
 
+    param.approx = G_define_flag();
+    param.approx->key = 'a';
+    param.approx->description =
+	_("Approximate the percentiles with bounded memory (requires extended statistics flag)");
+    param.approx->guisection = _("Extended");
+
     param.table = G_define_flag();
     param.table->key = 't';
     param.table->description = _("Table output format instead of standard output format");
@@ -81,7 +92,7 @@ void set_params()
 static int open_raster(const char *infile);
 static univar_stat *univar_stat_with_percentiles(int map_type);
 static void process_raster(univar_stat * stats, int fd, int fdz,
-			   const struct Cell_head *region);
+			   const struct Cell_head *region, int nprocs);
 
 /* *************************************************************** */
 /* **** the main functions for r.univar ************************** */
@@ -94,7 +105,7 @@ int main(int argc, char *argv[])
     struct GModule *module;
     univar_stat *stats;
     char **p, *z;
-    int fd, fdz, cell_type, min, max;
+    int fd, fdz, cell_type, min, max, nprocs;
     struct Range zone_range;
     const char *mapset, *name;
 
@@ -116,9 +127,13 @@ int main(int argc, char *argv[])
     /* Define the different options */
     set_params();
 
+    G_option_requires(param.approx, param.extended, NULL);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    nprocs = G_set_nprocs(param.nprocs);
+
     if (param.zonefile->answer && param.use_rast_region->answer) {
     	G_fatal_error(_("zones option and region flag -r are mutually exclusive"));
     }
@@ -202,7 +217,7 @@ int main(int argc, char *argv[])
 	    }
 	}
 
-	process_raster(stats, fd, fdz, &region);
+	process_raster(stats, fd, fdz, &region, nprocs);
 
 	/* close input raster */
 	Rast_close(fd);
@@ -262,124 +277,219 @@ static univar_stat *univar_stat_with_percentiles(int map_type)
     return stats;
 }
 
-static void
-process_raster(univar_stat * stats, int fd, int fdz, const struct Cell_head *region)
+/* statistics of the cells of one zone read by one thread */
+struct partial
 {
-    /* use G_window_rows(), G_window_cols() here? */
-    const unsigned int rows = region->rows;
-    const unsigned int cols = region->cols;
-
-    const RASTER_MAP_TYPE map_type = Rast_get_map_type(fd);
+    unsigned long size, n;
+    double sum, sum_abs, min, max;
+    double shift, dsum, dsq;	/* sums of the deviations from shift */
+    void *values;		/* values for extended statistics */
+    size_t n_values, n_alloc;
+    struct stat_tdigest *digest;	/* approximate percentiles */
+};
+
+/* a block of rows processed by several threads */
+struct block
+{
+    RASTER_MAP_TYPE map_type;
+    unsigned int cols;
+    void **rows;
+    CELL **zrows;		/* NULL without zones */
+    int chunk;			/* rows per thread */
+    struct partial **partials;	/* by thread and zone */
+};
+
+static void process_rows(int first, int last, void *closure)
+{
+    const struct block *blk = closure;
+    struct partial *partials = blk->partials[first / blk->chunk];
+    const RASTER_MAP_TYPE map_type = blk->map_type;
     const size_t value_sz = Rast_cell_size(map_type);
-    unsigned int row;
-    void *raster_row;
-    CELL *zoneraster_row = NULL;
-    int n_zones = zone_info.n_zones;
-    
-    raster_row = Rast_allocate_buf(map_type);
-    if (n_zones)
-	zoneraster_row = Rast_allocate_c_buf();
+    const int extended = param.extended->answer && !param.approx->answer;
+    const int approx = param.extended->answer && param.approx->answer;
+    int row;
 
-    for (row = 0; row < rows; row++) {
-	void *ptr;
-	CELL *zptr = NULL;
+    for (row = first; row < last; row++) {
+	const void *ptr = blk->rows[row];
+	const CELL *zptr = blk->zrows ? blk->zrows[row] : NULL;
 	unsigned int col;
 
-	Rast_get_row(fd, raster_row, row, map_type);
-	if (n_zones) {
-	    Rast_get_c_row(fdz, zoneraster_row, row);
-	    zptr = zoneraster_row;
-	}
-
-	ptr = raster_row;
+	for (col = 0; col < blk->cols;
+	     col++, ptr = G_incr_void_ptr(ptr, value_sz)) {
+	    struct partial *part = partials;
+	    double val, d;
 
-	for (col = 0; col < cols; col++) {
-	    double val;
-	    int zone = 0;
-
-	    if (n_zones) {
+	    if (zptr) {
 		/* skip NULL cells in zone map */
-		if (Rast_is_c_null_value(zptr)) {
-		    ptr = G_incr_void_ptr(ptr, value_sz);
-		    zptr++;
+		if (Rast_is_c_null_value(&zptr[col]))
 		    continue;
-		}
-		zone = *zptr - zone_info.min;
+		part = &partials[zptr[col] - zone_info.min];
 	    }
 
 	    /* count all including NULL cells in input map */
-	    stats[zone].size++;
-	    
+	    part->size++;
+
 	    /* can't do stats with NULL cells in input map */
-	    if (Rast_is_null_value(ptr, map_type)) {
-		ptr = G_incr_void_ptr(ptr, value_sz);
-		if (n_zones)
-		    zptr++;
+	    if (Rast_is_null_value(ptr, map_type))
 		continue;
-	    }
 
-	    if (param.extended->answer) {
-		/* check allocated memory */
-		if (stats[zone].n >= stats[zone].n_alloc) {
-		    stats[zone].n_alloc += 1000;
-		    size_t msize;
-		    switch (map_type) {
-			case DCELL_TYPE:
-			    msize = stats[zone].n_alloc * sizeof(DCELL);
-			    stats[zone].dcell_array =
-				(DCELL *)G_realloc((void *)stats[zone].dcell_array, msize);
-			    stats[zone].nextp = (void *)&(stats[zone].dcell_array[stats[zone].n]);
-			    break;
-			case FCELL_TYPE:
-			    msize = stats[zone].n_alloc * sizeof(FCELL);
-			    stats[zone].fcell_array =
-				(FCELL *)G_realloc((void *)stats[zone].fcell_array, msize);
-			    stats[zone].nextp = (void *)&(stats[zone].fcell_array[stats[zone].n]);
-			    break;
-			case CELL_TYPE:
-			    msize = stats[zone].n_alloc * sizeof(CELL);
-			    stats[zone].cell_array =
-				(CELL *)G_realloc((void *)stats[zone].cell_array, msize);
-			    stats[zone].nextp = (void *)&(stats[zone].cell_array[stats[zone].n]);
-			    break;
-			default:
-			    break;
-		    }
+	    val = ((map_type == DCELL_TYPE) ? *((DCELL *) ptr)
+		   : (map_type == FCELL_TYPE) ? *((FCELL *) ptr)
+		   : *((CELL *) ptr));
+
+	    if (extended) {
+		if (part->n_values >= part->n_alloc) {
+		    part->n_alloc = part->n_alloc ? 2 * part->n_alloc : 1000;
+		    part->values =
+			G_realloc(part->values, part->n_alloc * value_sz);
 		}
-		/* put the value into stats->XXXcell_array */
-		memcpy(stats[zone].nextp, ptr, value_sz);
-		stats[zone].nextp = G_incr_void_ptr(stats[zone].nextp, value_sz);
+		memcpy(G_incr_void_ptr(part->values, part->n_values * value_sz),
+		       ptr, value_sz);
+		part->n_values++;
+	    }
+	    else if (approx) {
+		if (!part->digest)
+		    part->digest = stat_tdigest_create(200);
+		stat_tdigest_add(part->digest, val);
 	    }
 
-	    val = ((map_type == DCELL_TYPE) ? *((DCELL *) ptr)
-			  : (map_type == FCELL_TYPE) ? *((FCELL *) ptr)
-			  : *((CELL *) ptr));
+	    /* the deviations from the first value keep the sum of
+	       squares small, as for Welford's update, without a
+	       division per cell */
+	    if (part->n == 0)
+		part->shift = part->min = part->max = val;
+	    else {
+		if (val > part->max)
+		    part->max = val;
+		if (val < part->min)
+		    part->min = val;
+	    }
+	    d = val - part->shift;
+	    part->dsum += d;
+	    part->dsq += d * d;
+	    part->sum += val;
+	    part->sum_abs += fabs(val);
+	    part->n++;
+	}
+    }
+}
 
-	    stats[zone].sum += val;
-	    stats[zone].sumsq += val * val;
-	    stats[zone].sum_abs += fabs(val);
+/* add the statistics of a thread to those of the zones */
+static void merge_partials(univar_stat * stats, struct partial *partials,
+			   int n_zones, RASTER_MAP_TYPE map_type)
+{
+    const size_t value_sz = Rast_cell_size(map_type);
+    int z;
 
-	    if (stats[zone].first) {
-		stats[zone].max = val;
-		stats[zone].min = val;
-		stats[zone].first = FALSE;
-	    }
+    for (z = 0; z < n_zones; z++) {
+	struct partial *part = &partials[z];
+
+	stats[z].size += part->size;
+
+	if (part->n_values) {
+	    void **array = (map_type == DCELL_TYPE)
+		? (void **)&stats[z].dcell_array
+		: (map_type == FCELL_TYPE)
+		? (void **)&stats[z].fcell_array
+		: (void **)&stats[z].cell_array;
+
+	    *array = G_realloc(*array,
+			       (stats[z].n + part->n_values) * value_sz);
+	    memcpy(G_incr_void_ptr(*array, stats[z].n * value_sz),
+		   part->values, part->n_values * value_sz);
+	}
+	G_free(part->values);
+
+	if (part->digest) {
+	    if (!stats[z].digest)
+		stats[z].digest = part->digest;
 	    else {
-		if (val > stats[zone].max)
-		    stats[zone].max = val;
-		if (val < stats[zone].min)
-		    stats[zone].min = val;
+		stat_tdigest_merge(stats[z].digest, part->digest);
+		stat_tdigest_destroy(part->digest);
 	    }
+	}
+
+	if (part->n) {
+	    double m2 = part->dsq - part->dsum * part->dsum / part->n;
+
+	    merge_univar_stat(&stats[z], part->n, part->sum, part->sum_abs,
+			      part->min, part->max, m2 > 0 ? m2 : 0);
+	}
+    }
+}
+
+static void
+process_raster(univar_stat * stats, int fd, int fdz,
+	       const struct Cell_head *region, int nprocs)
+{
+    /* use G_window_rows(), G_window_cols() here? */
+    const unsigned int rows = region->rows;
+    const unsigned int cols = region->cols;
+    int n_zones = zone_info.n_zones;
+    int nblock = nprocs > 1 ? nprocs * BLOCK_ROWS : 1;
+    struct block blk;
+    unsigned int row;
+    int i;
+
+    if (n_zones == 0)
+	n_zones = 1;
+
+    blk.map_type = Rast_get_map_type(fd);
+    blk.cols = cols;
+    blk.rows = G_malloc(nblock * sizeof(void *));
+    blk.zrows = zone_info.n_zones ? G_malloc(nblock * sizeof(CELL *)) : NULL;
+    for (i = 0; i < nblock; i++) {
+	blk.rows[i] = Rast_allocate_buf(blk.map_type);
+	if (blk.zrows)
+	    blk.zrows[i] = Rast_allocate_c_buf();
+    }
+    blk.partials = G_malloc(nprocs * sizeof(struct partial *));
+    for (i = 0; i < nprocs; i++)
+	blk.partials[i] = G_calloc(n_zones, sizeof(struct partial));
+
+    /* decompress the rows of the next block while this one is
+       processed */
+    if (nprocs > 1) {
+	Rast_set_read_ahead(fd, nblock);
+	if (blk.zrows)
+	    Rast_set_read_ahead(fdz, nblock);
+    }
 
-	    ptr = G_incr_void_ptr(ptr, value_sz);
-	    if (n_zones)
-		zptr++;
-	    stats[zone].n++;
+    for (row = 0; row < rows; row += nblock) {
+	int n = rows - row < nblock ? rows - row : nblock;
+
+	for (i = 0; i < n; i++) {
+	    Rast_get_row(fd, blk.rows[i], row + i, blk.map_type);
+	    if (blk.zrows)
+		Rast_get_c_row(fdz, blk.zrows[i], row + i);
 	}
+
+	blk.chunk = (n + nprocs - 1) / nprocs;
+	G_parallel_for(0, n, blk.chunk, process_rows, &blk);
+
 	if (!(param.shell_style->answer))
 	    G_percent(row, rows, 2);
     }
     if (!(param.shell_style->answer))
 	G_percent(rows, rows, 2);	/* finish it off */
 
+    if (nprocs > 1) {
+	Rast_set_read_ahead(fd, 0);
+	if (blk.zrows)
+	    Rast_set_read_ahead(fdz, 0);
+    }
+
+    for (i = 0; i < nprocs; i++) {
+	merge_partials(stats, blk.partials[i], n_zones, blk.map_type);
+	G_free(blk.partials[i]);
+    }
+    G_free(blk.partials);
+
+    for (i = 0; i < nblock; i++) {
+	G_free(blk.rows[i]);
+	if (blk.zrows)
+	    G_free(blk.zrows[i]);
+    }
+    G_free(blk.rows);
+    G_free(blk.zrows);
 }
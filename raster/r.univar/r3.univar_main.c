@@ -249,22 +249,7 @@ int main(int argc, char *argv[])
 			    stats[zone].fcell_array[stats[zone].n] = val_f;
 			}
 
-			stats[zone].sum += val_f;
-			stats[zone].sumsq += (val_f * val_f);
-			stats[zone].sum_abs += fabs(val_f);
-
-			if (stats[zone].first) {
-			    stats[zone].max = val_f;
-			    stats[zone].min = val_f;
-			    stats[zone].first = FALSE;
-			}
-			else {
-			    if (val_f > stats[zone].max)
-				stats[zone].max = val_f;
-			    if (val_f < stats[zone].min)
-				stats[zone].min = val_f;
-			}
-			stats[zone].n++;
+			add_univar_value(&stats[zone], val_f);
 		    }
 		    stats[zone].size++;
 		}
@@ -283,22 +268,7 @@ int main(int argc, char *argv[])
 			    stats[zone].dcell_array[stats[zone].n] = val_d;
 			}
 
-			stats[zone].sum += val_d;
-			stats[zone].sumsq += val_d * val_d;
-			stats[zone].sum_abs += fabs(val_d);
-
-			if (stats[zone].first) {
-			    stats[zone].max = val_d;
-			    stats[zone].min = val_d;
-			    stats[zone].first = FALSE;
-			}
-			else {
-			    if (val_d > stats[zone].max)
-				stats[zone].max = val_d;
-			    if (val_d < stats[zone].min)
-				stats[zone].min = val_d;
-			}
-			stats[zone].n++;
+			add_univar_value(&stats[zone], val_d);
 		    }
 		    stats[zone].size++;
 		}
@@ -29,7 +29,7 @@ univar_stat *create_univar_stat_struct(int map_type, int n_perc)
 
     for (i = 0; i < n_zones; i++) {
 	stats[i].sum = 0.0;
-	stats[i].sumsq = 0.0;
+	stats[i].m2 = 0.0;
 	stats[i].min = 0.0 / 0.0;	/* set to nan as default */
 	stats[i].max = 0.0 / 0.0;	/* set to nan as default */
 	stats[i].n_perc = n_perc;
@@ -48,6 +48,7 @@ univar_stat *create_univar_stat_struct(int map_type, int n_perc)
 	stats[i].n_alloc = 0;
 
 	stats[i].first = TRUE;
+	stats[i].digest = NULL;
 
 	/* allocate memory for extended computation */
 	/* changed to on-demand block allocation */
@@ -91,6 +92,8 @@ void free_univar_stat_struct(univar_stat * stats)
 	    G_free(stats[i].fcell_array);
 	if (stats[i].cell_array)
 	    G_free(stats[i].cell_array);
+	if (stats[i].digest)
+	    stat_tdigest_destroy(stats[i].digest);
     }
 
     G_free(stats);
@@ -99,6 +102,86 @@ void free_univar_stat_struct(univar_stat * stats)
 }
 
 
+/* *************************************************************** */
+/* **** add a non-null value to univar_stat ********************** */
+/* *************************************************************** */
+void add_univar_value(univar_stat * stats, double val)
+{
+    /* Welford's update of the sum of squared deviations */
+    double delta = stats->n ? val - stats->sum / stats->n : 0.0;
+
+    stats->n++;
+    stats->sum += val;
+    stats->m2 += delta * (val - stats->sum / stats->n);
+    stats->sum_abs += fabs(val);
+
+    if (stats->first) {
+	stats->max = val;
+	stats->min = val;
+	stats->first = FALSE;
+    }
+    else {
+	if (val > stats->max)
+	    stats->max = val;
+	if (val < stats->min)
+	    stats->min = val;
+    }
+}
+
+
+/* *************************************************************** */
+/* **** merge the statistics of other values into univar_stat **** */
+/* *************************************************************** */
+void merge_univar_stat(univar_stat * stats, unsigned long n, double sum,
+		       double sum_abs, double min, double max, double m2)
+{
+    if (n == 0)
+	return;
+
+    /* Chan et al.: the deviations of both parts from the common mean */
+    if (stats->n) {
+	double delta = sum / n - stats->sum / stats->n;
+
+	stats->m2 += m2 + delta * delta * ((double)stats->n * n /
+					   (stats->n + n));
+    }
+    else
+	stats->m2 = m2;
+
+    stats->n += n;
+    stats->sum += sum;
+    stats->sum_abs += sum_abs;
+
+    if (stats->first) {
+	stats->max = max;
+	stats->min = min;
+	stats->first = FALSE;
+    }
+    else {
+	if (max > stats->max)
+	    stats->max = max;
+	if (min < stats->min)
+	    stats->min = min;
+    }
+}
+
+
+/* approximate quartiles and percentiles from the t-digest */
+static void approx_percentiles(univar_stat * stats, double *quartile_25,
+			       double *median, double *quartile_75,
+			       double *quartile_perc)
+{
+    unsigned int i;
+
+    *quartile_25 = stat_tdigest_quantile(stats->digest, 0.25);
+    *median = stat_tdigest_quantile(stats->digest, 0.5);
+    *quartile_75 = stat_tdigest_quantile(stats->digest, 0.75);
+    for (i = 0; i < stats->n_perc; i++)
+	quartile_perc[i] = stat_tdigest_quantile(stats->digest,
+					    1e-2 * stats->perc[i]);
+}
+
+
 /* *************************************************************** */
 /* **** compute and print univar statistics to stdout ************ */
 /* *************************************************************** */
@@ -121,7 +204,7 @@ int print_stats(univar_stat * stats)
 
 	/* all these calculations get promoted to doubles, so any DIV0 becomes nan */
 	mean = stats[z].sum / stats[z].n;
-	variance = (stats[z].sumsq - stats[z].sum * stats[z].sum / stats[z].n) / stats[z].n;
+	variance = stats[z].m2 / stats[z].n;
 	if (variance < GRASS_EPSILON)
 	    variance = 0.0;
 	stdev = sqrt(variance);
@@ -186,6 +269,10 @@ int print_stats(univar_stat * stats)
 		for (i = 0; i < stats[z].n_perc; i++)
 		    quartile_perc[i] = 0.0 / 0.0;
 	    }
+	    else if (stats[z].digest) {
+		approx_percentiles(&stats[z], &quartile_25, &median,
+				   &quartile_75, quartile_perc);
+	    }
 	    else {
 		for (i = 0; i < stats[z].n_perc; i++) {
 		    qpos_perc[i] = (int)(stats[z].n * 1e-2 * stats[z].perc[i] - 0.5);
@@ -371,7 +458,7 @@ int print_stats_table(univar_stat * stats)
 
 	/* all these calculations get promoted to doubles, so any DIV0 becomes nan */
 	mean = stats[z].sum / stats[z].n;
-	variance = (stats[z].sumsq - stats[z].sum * stats[z].sum / stats[z].n) / stats[z].n;
+	variance = stats[z].m2 / stats[z].n;
 	if (variance < GRASS_EPSILON)
 	    variance = 0.0;
 	stdev = sqrt(variance);
@@ -428,6 +515,10 @@ int print_stats_table(univar_stat * stats)
 		for (i = 0; i < stats[z].n_perc; i++)
 		    quartile_perc[i] = 0.0 / 0.0;
 	    }
+	    else if (stats[z].digest) {
+		approx_percentiles(&stats[z], &quartile_25, &median,
+				   &quartile_75, quartile_perc);
+	    }
 	    else {
 		for (i = 0; i < stats[z].n_perc; i++) {
 		    qpos_perc[i] = (int)(stats[z].n * 1e-2 * stats[z].perc[i] - 0.5);
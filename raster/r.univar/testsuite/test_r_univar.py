@@ -172,11 +172,56 @@ class TestRasterUnivar(TestCase):
                                   zones="zone_map",flags="g",
                                   reference=univar_string, precision=3, sep='=')
 
+    def test_nprocs_zone(self):
+        """
+        zones computed by several threads
+        :return:
+        """
+
+        univar_string="""zone=1;
+                        n=1710
+                        min=102
+                        max=209
+                        mean=155.5
+                        variance=704.916667
+                        sum=265905
+                        zone=2;
+                        n=6390
+                        min=121
+                        max=280
+                        mean=200.5
+                        sum=1281195"""
+
+        self.runModule("g.region", res=1)
+        self.assertModuleKeyValue(module="r.univar", map=["map_a"],
+                                  zones="zone_map", flags="g", nprocs=4,
+                                  reference=univar_string, precision=3, sep='=')
+
+    def test_approx_percentiles(self):
+        """
+        approximate percentiles with the -a flag
+        :return:
+        """
+
+        univar_string="""n=8100
+                        mean=191
+                        first_quartile=165
+                        median=191
+                        third_quartile=217
+                        percentile_90=241"""
+
+        self.runModule("g.region", res=1)
+        self.assertModuleKeyValue(module="r.univar", map=["map_a"],
+                                  flags="gea", nprocs=2,
+                                  reference=univar_string, precision=1, sep='=')
+
 class TestAccumulateFails(TestCase):
 
     def test_error_handling(self):
         # No vector map, no strds, no coordinates
         self.assertModuleFail("r.univar",  flags="r", map="map_a", zones="map_b")
+        # -a requires -e
+        self.assertModuleFail("r.univar",  flags="a", map="map_a")
 
 if __name__ == '__main__':
     from grass.gunittest.main import test
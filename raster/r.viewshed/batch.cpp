@@ -0,0 +1,558 @@
+/****************************************************************************
+ *
+ * MODULE:       r.viewshed
+ *
+ * AUTHOR(S):    GRASS Development Team
+ *
+ * PURPOSE: Cumulative viewshed of several viewpoints: the number of
+ * viewpoints from which each cell is visible. The elevation is read
+ * once and the viewsheds are computed in memory, several at the same
+ * time by the libgis worker threads. In projected locations the
+ * angles and the radial order of the events depend only on the offset
+ * of a cell to the viewpoint, they are computed and sorted once and
+ * shared by all viewpoints.
+ *
+ * COPYRIGHT: (C) 2019 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+extern "C"
+{
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+}
+
+#include "grass.h"
+#include "viewshed.h"
+#include "statusstructure.h"
+#include "rbbst.h"
+#include "batch.h"
+
+
+/* the events of all cells around a viewpoint at (nrad, crad) in
+   radial order. ring tells for each cell of the window of 2 nrad + 1
+   rows and wcols = 2 crad + 1 columns whether it is within the maximum
+   distance: 0 no, 1 yes, 2 too close to the limit to tell from the
+   offset alone */
+struct event_geometry
+{
+    int nrad, crad, wcols;
+    AEvent *events;
+    size_t nevents;
+    char *ring;
+};
+
+
+/* a viewshed computed by a worker thread; viewshed_in_memory() does
+   not print messages when the elevation grid is given */
+struct viewshed_task
+{
+    char *inputfname;
+    GridHeader *hd;
+    Viewpoint vp;
+    ViewOptions *viewOptions;
+    const G_SURFACE_T *elev;
+    const struct event_geometry *geom;
+    /* the result: visgrid without geom, else the visible cells of the
+       window around the viewpoint */
+    MemoryVisibilityGrid *visgrid;
+    char *vis;
+    void *worker;
+};
+
+
+/* ------------------------------------------------------------ */
+/* the window of the event geometry: as far as the maximum distance
+   and the grid go. 0 if the geometry can not be used */
+static int geometry_radius(GridHeader * hd, ViewOptions * viewOptions,
+			   int *nrad, int *crad)
+{
+    /* the offsets do not determine distances */
+    if (G_projection() == PROJECTION_LL)
+	return 0;
+
+    *nrad = hd->nrows - 1;
+    *crad = hd->ncols - 1;
+    if ((int)viewOptions->maxDist != INFINITY_DISTANCE) {
+	if (viewOptions->maxDist / hd->ns_res + 1 < *nrad)
+	    *nrad = (int)(viewOptions->maxDist / hd->ns_res) + 1;
+	if (viewOptions->maxDist / hd->ew_res + 1 < *crad)
+	    *crad = (int)(viewOptions->maxDist / hd->ew_res) + 1;
+    }
+
+    /* event rows and cols are relative to the window */
+    return 2 * *nrad <= maxDimension && 2 * *crad <= maxDimension;
+}
+
+
+/* ------------------------------------------------------------ */
+/* the events of all cells within the maximum distance of a viewpoint,
+   sorted radially. Angles are calculated from the offsets to the
+   viewpoint only, so they are the same for any viewpoint */
+static struct event_geometry *make_event_geometry(GridHeader * hd,
+						  ViewOptions * viewOptions,
+						  int nrad, int crad)
+{
+    struct event_geometry *g =
+	(struct event_geometry *)G_malloc(sizeof(struct event_geometry));
+    int infinite = (int)viewOptions->maxDist == INFINITY_DISTANCE;
+    double maxDist = viewOptions->maxDist;
+
+    /* is_point_outside_max_dist() works on coordinates */
+    double tol = 1e-9 * (maxDist + fabs(hd->window.north) +
+			 fabs(hd->window.east));
+
+    g->nrad = nrad;
+    g->crad = crad;
+    g->wcols = 2 * crad + 1;
+
+    size_t wcells = (size_t)(2 * nrad + 1) * g->wcols;
+
+    g->ring = (char *)G_malloc(wcells);
+    g->events = (AEvent *) G_malloc(wcells * 3 * sizeof(AEvent));
+    g->nevents = 0;
+
+    AEvent e;
+    double ax, ay;
+
+    e.elev[0] = e.elev[1] = e.elev[2] = 0;
+    for (int dr = -nrad; dr <= nrad; dr++) {
+	for (int dc = -crad; dc <= crad; dc++) {
+	    char *ring = &g->ring[(size_t)(dr + nrad) * g->wcols + dc + crad];
+
+	    if (infinite)
+		*ring = 1;
+	    else {
+		double dist = hypot(dc * hd->ew_res, dr * hd->ns_res);
+
+		if (dist < maxDist - tol)
+		    *ring = 1;
+		else if (dist > maxDist + tol)
+		    *ring = 0;
+		else
+		    *ring = 2;
+	    }
+	    if (!*ring || (dr == 0 && dc == 0))
+		continue;
+
+	    e.row = dr + nrad;
+	    e.col = dc + crad;
+
+	    e.eventType = ENTERING_EVENT;
+	    calculate_event_position(e, nrad, crad, &ay, &ax);
+	    e.angle = calculate_angle(ax, ay, crad, nrad);
+	    g->events[g->nevents++] = e;
+
+	    e.eventType = CENTER_EVENT;
+	    calculate_event_position(e, nrad, crad, &ay, &ax);
+	    e.angle = calculate_angle(ax, ay, crad, nrad);
+	    g->events[g->nevents++] = e;
+
+	    e.eventType = EXITING_EVENT;
+	    calculate_event_position(e, nrad, crad, &ay, &ax);
+	    e.angle = calculate_angle(ax, ay, crad, nrad);
+	    g->events[g->nevents++] = e;
+	}
+    }
+
+    RadialCompare cmpObj;
+
+    quicksort(g->events, g->nevents, cmpObj);
+
+    return g;
+}
+
+
+static void free_event_geometry(struct event_geometry *g)
+{
+    G_free(g->events);
+    G_free(g->ring);
+    G_free(g);
+}
+
+
+/* ------------------------------------------------------------ */
+/* is the cell at row, col within the maximum distance of vp */
+static int in_ring(const struct event_geometry *g, Viewpoint * vp,
+		   GridHeader * hd, ViewOptions * viewOptions,
+		   int row, int col)
+{
+    char ring = g->ring[(size_t)(row - vp->row + g->nrad) * g->wcols +
+			col - vp->col + g->crad];
+
+    if (ring == 2)
+	return !is_point_outside_max_dist(*vp, *hd, row, col,
+					  viewOptions->maxDist);
+
+    return ring;
+}
+
+
+/* ------------------------------------------------------------ */
+/* ENTER or EXIT elevation of the cell of e like
+   init_event_list_in_memory() */
+static surface_type event_elevation(AEvent e, char eventType,
+				    Viewpoint * vp, GridHeader * hd,
+				    ViewOptions * viewOptions,
+				    const G_SURFACE_T * elev)
+{
+    G_SURFACE_T *inrast[3];
+    surface_type h;
+    double ax, ay;
+
+    /* only rows within the grid are read */
+    for (int k = 0; k < 3; k++) {
+	int row = e.row - 1 + k;
+
+	inrast[k] = row >= 0 && row < hd->nrows ?
+	    (G_SURFACE_T *) elev + (size_t)row * hd->ncols : NULL;
+    }
+
+    e.eventType = eventType;
+    h = calculate_event_elevation(e, hd->nrows, hd->ncols, vp->row,
+				  vp->col, inrast, G_SURFACE_TYPE);
+    if (viewOptions->doCurv) {
+	calculate_event_position(e, vp->row, vp->col, &ay, &ax);
+	h = adjust_for_curvature(*vp, ay, ax, h, *viewOptions, hd);
+    }
+
+    return h;
+}
+
+
+/* ------------------------------------------------------------ */
+/* the sweep of viewshed_in_memory() over the shared event geometry:
+   the events of cells outside the grid or without elevation are
+   skipped, the remaining ones are already in radial order. Returns the
+   visible cells of the window around vp */
+static char *viewshed_geometry(GridHeader * hd, Viewpoint * vp,
+			       ViewOptions * viewOptions,
+			       const G_SURFACE_T * elev,
+			       const struct event_geometry *g)
+{
+    int nrows = hd->nrows, ncols = hd->ncols;
+    char *vis = (char *)G_calloc((size_t)(2 * g->nrad + 1) * g->wcols, 1);
+
+    /* the viewpoint */
+    surface_type vpelev =
+	adjust_for_curvature(*vp, vp->row, vp->col,
+			     elev[(size_t)vp->row * ncols + vp->col],
+			     *viewOptions, hd);
+
+    set_viewpoint_elev(vp, vpelev + viewOptions->obsElev);
+    if (viewOptions->tgtElev > 0)
+	vp->target_offset = viewOptions->tgtElev;
+    else
+	vp->target_offset = 0.;
+    vis[(size_t)g->nrad * g->wcols + g->crad] = 1;
+
+    /*Put cells that are initially on the sweepline into status structure */
+    StatusList *status_struct = create_status_struct();
+    StatusNode sn;
+    AEvent e;
+    double ax, ay;
+
+    for (int col = vp->col + 1; col <= vp->col + g->crad && col < ncols;
+	 col++) {
+	const G_SURFACE_T *h = &elev[(size_t)vp->row * ncols + col];
+
+	if (Rast_is_null_value(h, G_SURFACE_TYPE) ||
+	    !in_ring(g, vp, hd, viewOptions, vp->row, col))
+	    continue;
+
+	sn.col = e.col = col;
+	sn.row = e.row = vp->row;
+	e.elev[1] = adjust_for_curvature(*vp, e.row, e.col, *h,
+					 *viewOptions, hd);
+	e.elev[0] = event_elevation(e, ENTERING_EVENT, vp, hd, viewOptions,
+				    elev);
+	e.elev[2] = event_elevation(e, EXITING_EVENT, vp, hd, viewOptions,
+				    elev);
+
+	e.eventType = ENTERING_EVENT;
+	calculate_event_position(e, vp->row, vp->col, &ay, &ax);
+	sn.angle[0] = calculate_angle(ax, ay, vp->col, vp->row);
+	calculate_event_gradient(&sn, 0, ay, ax, e.elev[0], vp, *hd);
+
+	e.eventType = CENTER_EVENT;
+	calculate_event_position(e, vp->row, vp->col, &ay, &ax);
+	sn.angle[1] = calculate_angle(ax, ay, vp->col, vp->row);
+	calculate_dist_n_gradient(&sn, e.elev[1], vp, *hd);
+
+	e.eventType = EXITING_EVENT;
+	calculate_event_position(e, vp->row, vp->col, &ay, &ax);
+	sn.angle[2] = calculate_angle(ax, ay, vp->col, vp->row);
+	calculate_event_gradient(&sn, 2, ay, ax, e.elev[2], vp, *hd);
+
+	if (sn.angle[0] > sn.angle[1])
+	    sn.angle[0] -= 2 * M_PI;
+
+	insert_into_status_struct(sn, status_struct);
+    }
+
+    /*sweep the event list */
+    for (size_t i = 0; i < g->nevents; i++) {
+	const AEvent *ge = &g->events[i];
+	int row = vp->row + ge->row - g->nrad;
+	int col = vp->col + ge->col - g->crad;
+
+	if (row < 0 || row >= nrows || col < 0 || col >= ncols)
+	    continue;
+
+	const G_SURFACE_T *h = &elev[(size_t)row * ncols + col];
+
+	if (Rast_is_null_value(h, G_SURFACE_TYPE))
+	    continue;
+	if (g->ring[(size_t)ge->row * g->wcols + ge->col] == 2 &&
+	    is_point_outside_max_dist(*vp, *hd, row, col,
+				      viewOptions->maxDist))
+	    continue;
+
+	e = *ge;
+	e.row = row;
+	e.col = col;
+	e.elev[1] = adjust_for_curvature(*vp, row, col, *h, *viewOptions, hd);
+
+	sn.col = e.col;
+	sn.row = e.row;
+
+	/*calculate Distance to VP and Gradient */
+	calculate_dist_n_gradient(&sn, e.elev[1] + vp->target_offset, vp,
+				  *hd);
+
+	switch (e.eventType) {
+	case ENTERING_EVENT:
+	    /*insert node into structure */
+	    e.elev[0] = event_elevation(e, ENTERING_EVENT, vp, hd,
+					viewOptions, elev);
+	    e.elev[2] = event_elevation(e, EXITING_EVENT, vp, hd,
+					viewOptions, elev);
+
+	    calculate_event_position(e, vp->row, vp->col, &ay, &ax);
+	    sn.angle[0] = e.angle;
+	    calculate_event_gradient(&sn, 0, ay, ax, e.elev[0], vp, *hd);
+
+	    e.eventType = CENTER_EVENT;
+	    calculate_event_position(e, vp->row, vp->col, &ay, &ax);
+	    sn.angle[1] = calculate_angle(ax, ay, vp->col, vp->row);
+	    calculate_dist_n_gradient(&sn, e.elev[1], vp, *hd);
+
+	    e.eventType = EXITING_EVENT;
+	    calculate_event_position(e, vp->row, vp->col, &ay, &ax);
+	    sn.angle[2] = calculate_angle(ax, ay, vp->col, vp->row);
+	    calculate_event_gradient(&sn, 2, ay, ax, e.elev[2], vp, *hd);
+
+	    if (e.angle < M_PI) {
+		if (sn.angle[0] > sn.angle[1])
+		    sn.angle[0] -= 2 * M_PI;
+	    }
+	    else {
+		if (sn.angle[0] > sn.angle[1]) {
+		    sn.angle[1] += 2 * M_PI;
+		    sn.angle[2] += 2 * M_PI;
+		}
+	    }
+
+	    insert_into_status_struct(sn, status_struct);
+	    break;
+
+	case EXITING_EVENT:
+	    /*delete node out of status structure */
+	    delete_from_status_struct(status_struct, sn.dist2vp);
+	    break;
+
+	case CENTER_EVENT:
+	    /*calculate visibility */
+	    if (find_max_gradient_in_status_struct(status_struct, sn.dist2vp,
+						   e.angle, sn.gradient[1]) <=
+		sn.gradient[1])
+		vis[(size_t)ge->row * g->wcols + ge->col] = 1;
+	    break;
+	}
+    }
+
+    delete_status_structure(status_struct);
+
+    return vis;
+}
+
+
+static void compute_viewshed(void *closure)
+{
+    struct viewshed_task *t = (struct viewshed_task *)closure;
+
+    if (t->geom)
+	t->vis = viewshed_geometry(t->hd, &t->vp, t->viewOptions, t->elev,
+				   t->geom);
+    else
+	t->visgrid = viewshed_in_memory(t->inputfname, t->hd, &t->vp,
+					*t->viewOptions, t->elev);
+}
+
+
+/* wait for the viewshed of task t and add it to count */
+static void add_viewshed(struct viewshed_task *t, CELL * count)
+{
+    dimensionType i, j;
+    size_t k = 0;
+
+    G_end_execute(&t->worker);
+
+    if (t->vis) {
+	const struct event_geometry *g = t->geom;
+	int ncols = t->hd->ncols;
+
+	for (int row = t->vp.row - g->nrad; row <= t->vp.row + g->nrad;
+	     row++) {
+	    /* window index of col 0 */
+	    size_t k0 = (size_t)(row - t->vp.row + g->nrad) * g->wcols +
+		g->crad - t->vp.col;
+
+	    if (row < 0 || row >= t->hd->nrows)
+		continue;
+	    for (int col = MAX(t->vp.col - g->crad, 0);
+		 col <= t->vp.col + g->crad && col < ncols; col++)
+		if (t->vis[k0 + col])
+		    count[(size_t)row * ncols + col]++;
+	}
+	G_free(t->vis);
+	t->vis = NULL;
+    }
+
+    if (!t->visgrid)
+	return;
+
+    for (i = 0; i < t->hd->nrows; i++)
+	for (j = 0; j < t->hd->ncols; j++, k++)
+	    if (is_visible(t->visgrid->grid->grid_data[i][j]))
+		count[k]++;
+
+    free_inmem_visibilitygrid(t->visgrid);
+    t->visgrid = NULL;
+}
+
+
+/* ------------------------------------------------------------ */
+void cumulative_viewshed(char *inputfname, GridHeader * hd,
+			 Viewpoint * vps, int nvp, ViewOptions viewOptions,
+			 long long memSizeBytes, int skipNull)
+{
+    assert(inputfname && hd && vps);
+
+    size_t ncells = (size_t)hd->nrows * hd->ncols;
+    long long gridMemUsage = ncells * (sizeof(G_SURFACE_T) + sizeof(CELL));
+    long long viewshedMemUsage = get_viewshed_memory_usage(hd);
+
+    /* the shared event geometry if it fits: the viewsheds need only
+       the status structure and the window around the viewpoint */
+    struct event_geometry *geom = NULL;
+    int nrad, crad;
+
+    if (geometry_radius(hd, &viewOptions, &nrad, &crad)) {
+	long long wcells = (long long)(2 * nrad + 1) * (2 * crad + 1);
+	long long geomMemUsage = wcells * (3 * sizeof(AEvent) + 1);
+	long long taskMemUsage = wcells + get_active_str_size_bytes(hd);
+
+	if (gridMemUsage + geomMemUsage + taskMemUsage < memSizeBytes) {
+	    G_verbose_message(_("Sorting events of %lld cells around the "
+				"viewpoints..."), wcells);
+	    geom = make_event_geometry(hd, &viewOptions, nrad, crad);
+	    gridMemUsage += geomMemUsage;
+	    viewshedMemUsage = taskMemUsage;
+	}
+    }
+
+    /* concurrent viewsheds: one per thread, as far as memory allows */
+    int ntasks = 1;
+
+#ifdef HAVE_THREAD_LOCAL
+    G_init_workers();
+    ntasks = G_num_workers() + 1;
+#endif
+    if (ntasks > nvp)
+	ntasks = nvp;
+    if (memSizeBytes - gridMemUsage < ntasks * viewshedMemUsage)
+	ntasks = (memSizeBytes - gridMemUsage) / viewshedMemUsage;
+    if (ntasks < 1)
+	G_fatal_error(_("Not enough memory for the cumulative viewshed: "
+			"%d MB needed"),
+		      (int)((gridMemUsage + viewshedMemUsage) >> 20) + 1);
+
+    G_verbose_message(_("Computing %d viewsheds at a time"), ntasks);
+
+    /* the elevation is read once for all viewpoints */
+    G_SURFACE_T *elev = read_elevation_grid(inputfname);
+    CELL *count = (CELL *) G_calloc(ncells, sizeof(CELL));
+
+    struct viewshed_task *tasks =
+	(struct viewshed_task *)G_calloc(ntasks, sizeof(struct viewshed_task));
+
+    G_important_message(_("Computing %d viewsheds..."), nvp);
+    for (int v = 0, n = 0; v < nvp; v++) {
+	G_percent(v, nvp, 1);
+
+	if (Rast_is_null_value(&elev[(size_t)vps[v].row * hd->ncols +
+				     vps[v].col], G_SURFACE_TYPE)) {
+	    if (skipNull)
+		continue;
+	    G_warning(_("Viewpoint %d is NODATA"), v + 1);
+	}
+
+	struct viewshed_task *t = &tasks[n++ % ntasks];
+
+	/* the task of the viewpoint ntasks before */
+	add_viewshed(t, count);
+
+	t->inputfname = inputfname;
+	t->hd = hd;
+	t->vp = vps[v];
+	t->viewOptions = &viewOptions;
+	t->elev = elev;
+	t->geom = geom;
+	t->visgrid = NULL;
+	t->vis = NULL;
+	G_begin_execute(compute_viewshed, t, &t->worker, 0);
+    }
+    for (int v = 0; v < ntasks; v++)
+	add_viewshed(&tasks[v], count);
+    G_percent(1, 1, 1);
+
+    G_free(tasks);
+    if (geom)
+	free_event_geometry(geom);
+
+    /* write the output: the number of viewpoints each cell is visible
+       from, NULL where there is no elevation */
+    G_important_message(_("Writing output raster map..."));
+
+    int outfd = Rast_open_new(viewOptions.outputfname, CELL_TYPE);
+    CELL *outrast = Rast_allocate_c_buf();
+
+    for (dimensionType i = 0; i < hd->nrows; i++) {
+	size_t k = (size_t)i * hd->ncols;
+
+	G_percent(i, hd->nrows, 5);
+	for (dimensionType j = 0; j < hd->ncols; j++, k++) {
+	    if (Rast_is_null_value(&elev[k], G_SURFACE_TYPE))
+		Rast_set_c_null_value(&outrast[j], 1);
+	    else
+		outrast[j] = count[k];
+	}
+	Rast_put_c_row(outfd, outrast);
+    }
+    G_percent(1, 1, 1);
+
+    Rast_close(outfd);
+    G_free(outrast);
+    G_free(count);
+    G_free(elev);
+}
@@ -0,0 +1,41 @@
+/****************************************************************************
+ *
+ * MODULE:       r.viewshed
+ *
+ * AUTHOR(S):    GRASS Development Team
+ *
+ * PURPOSE: Cumulative viewshed of several viewpoints: the number of
+ * viewpoints from which each cell is visible. The elevation is read
+ * once and the viewsheds are computed in memory, several at the same
+ * time by the libgis worker threads. In projected locations the
+ * angles and the radial order of the events depend only on the offset
+ * of a cell to the viewpoint, they are computed and sorted once and
+ * shared by all viewpoints.
+ *
+ * COPYRIGHT: (C) 2019 by the GRASS Development Team
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ *****************************************************************************/
+
+
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include "visibility.h"
+#include "grid.h"
+
+
+/* ------------------------------------------------------------ */
+/* compute the viewsheds of the nvp viewpoints in vps on the grid
+   stored in the given file and write the number of viewpoints each
+   cell is visible from to viewOptions.outputfname; memSizeBytes limits
+   the number of viewsheds computed at the same time. Viewpoints without
+   elevation are skipped if skipNull is set */
+void cumulative_viewshed(char *inputfname, GridHeader * hd,
+			 Viewpoint * vps, int nvp, ViewOptions viewOptions,
+			 long long memSizeBytes, int skipNull);
+
+
+#endif
@@ -38,6 +38,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 extern "C"
 {
@@ -175,15 +176,19 @@ surface_type calculate_event_elevation(AEvent e, int nrows, int ncols,
    allocated and initialized with all the cells on the same row as the
    viewpoint. it returns the number of events. initialize and fill
    AEvent* with all the events for the map.  Used when solving in
-   memory, so the AEvent* should fit in memory.  */
+   memory, so the AEvent* should fit in memory.  If elev is not NULL,
+   the elevation is taken from elev instead of the raster, and no
+   messages are printed.  */
 size_t
 init_event_list_in_memory(AEvent * eventList, char *rastName,
 				Viewpoint * vp, GridHeader * hd,
 				ViewOptions viewOptions, surface_type ***data,
-				MemoryVisibilityGrid * visgrid)
+				MemoryVisibilityGrid * visgrid,
+				const G_SURFACE_T * elev)
 {
 
-    G_message(_("Computing events..."));
+    if (!elev)
+	G_message(_("Computing events..."));
     assert(eventList && vp && visgrid);
     //GRASS should be defined 
 
@@ -196,18 +201,20 @@ init_event_list_in_memory(AEvent * eventList, char *rastName,
     (*data)[1] = (*data)[0] + Rast_window_cols();
     (*data)[2] = (*data)[1] + Rast_window_cols();
 
-    /*get the mapset name */
-    const char *mapset;
+    /*open map */
+    int infd = -1;
 
-    mapset = G_find_raster(rastName, "");
-    if (mapset == NULL)
-	G_fatal_error(_("Raster map [%s] not found"), rastName);
+    if (!elev) {
+	/*get the mapset name */
+	const char *mapset;
 
-    /*open map */
-    int infd;
+	mapset = G_find_raster(rastName, "");
+	if (mapset == NULL)
+	    G_fatal_error(_("Raster map [%s] not found"), rastName);
 
-    if ((infd = Rast_open_old(rastName, mapset)) < 0)
-	G_fatal_error(_("Cannot open raster file [%s]"), rastName);
+	if ((infd = Rast_open_old(rastName, mapset)) < 0)
+	    G_fatal_error(_("Cannot open raster file [%s]"), rastName);
+    }
 
     /*get the data_type */
     RASTER_MAP_TYPE data_type;
@@ -244,7 +251,10 @@ init_event_list_in_memory(AEvent * eventList, char *rastName,
     AEvent e;
     
     /* read first row */
-    Rast_get_row(infd, inrast[2], 0, data_type);
+    if (elev)
+	memcpy(inrast[2], elev, ncols * sizeof(G_SURFACE_T));
+    else
+	Rast_get_row(infd, inrast[2], 0, data_type);
 
     e.angle = -1;
     for (i = 0; i < nrows; i++) {
@@ -255,12 +265,18 @@ init_event_list_in_memory(AEvent * eventList, char *rastName,
 	inrast[1] = inrast[2];
 	inrast[2] = tmprast;
 
-	if (i < nrows - 1)
-	    Rast_get_row(infd, inrast[2], i + 1, data_type);
+	if (i < nrows - 1) {
+	    if (elev)
+		memcpy(inrast[2], elev + (size_t)(i + 1) * ncols,
+		       ncols * sizeof(G_SURFACE_T));
+	    else
+		Rast_get_row(infd, inrast[2], i + 1, data_type);
+	}
 	else
 	    Rast_set_null_value(inrast[2], ncols, data_type);
 
-	G_percent(i, nrows, 2);
+	if (!elev)
+	    G_percent(i, nrows, 2);
 
 	/*fill event list with events from this row */
 	for (j = 0; j < Rast_window_cols(); j++) {
@@ -288,7 +304,7 @@ init_event_list_in_memory(AEvent * eventList, char *rastName,
 		    vp->target_offset = viewOptions.tgtElev;
 		else
 		    vp->target_offset = 0.;
-		if (isnull) {
+		if (isnull && !elev) {
 		    /*what to do when viewpoint is NODATA ? */
 		    G_warning(_("Viewpoint is NODATA."));
 		    G_message(_("Will assume its elevation is = %f"),
@@ -368,9 +384,10 @@ init_event_list_in_memory(AEvent * eventList, char *rastName,
 
 	}
     }
-    G_percent(nrows, nrows, 2);
-
-    Rast_close(infd);
+    if (!elev) {
+	G_percent(nrows, nrows, 2);
+	Rast_close(infd);
+    }
 
     G_free(inrast[0]);
     G_free(inrast[1]);
@@ -382,6 +399,40 @@ init_event_list_in_memory(AEvent * eventList, char *rastName,
 
 
 
+/*  ************************************************************ */
+/* read the raster into memory, rows after rows */
+G_SURFACE_T *read_elevation_grid(char *rastName)
+{
+    const char *mapset;
+    int infd, i;
+    int nrows = Rast_window_rows();
+    int ncols = Rast_window_cols();
+    G_SURFACE_T *elev;
+
+    mapset = G_find_raster(rastName, "");
+    if (mapset == NULL)
+	G_fatal_error(_("Raster map [%s] not found"), rastName);
+
+    if ((infd = Rast_open_old(rastName, mapset)) < 0)
+	G_fatal_error(_("Cannot open raster file [%s]"), rastName);
+
+    elev = (G_SURFACE_T *)G_malloc((size_t)nrows * ncols *
+				   sizeof(G_SURFACE_T));
+
+    G_message(_("Reading elevation..."));
+    for (i = 0; i < nrows; i++) {
+	G_percent(i, nrows, 2);
+	Rast_get_row(infd, elev + (size_t)i * ncols, i, G_SURFACE_TYPE);
+    }
+    G_percent(nrows, nrows, 2);
+
+    Rast_close(infd);
+
+    return elev;
+}
+
+
+
 
 
 /* ************************************************************ */
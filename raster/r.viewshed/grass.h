@@ -57,9 +57,9 @@ extern "C"
    curvature of the earth; otherwise return the passed height
    unchanged. 
  */
-float adjust_for_curvature(Viewpoint vp, double row,
-			   double col, float h,
-			   ViewOptions viewOptions);
+surface_type adjust_for_curvature(Viewpoint vp, double row,
+			   double col, surface_type h,
+			   ViewOptions viewOptions, GridHeader *hd);
 
 
 /* helper function to deal with GRASS writing to a row buffer */
@@ -84,12 +84,20 @@ surface_type calculate_event_elevation(AEvent e, int nrows, int ncols,
    allocated and initialized with all the cells on the same row as the
    viewpoint. it returns the number of events. initialize and fill
    AEvent* with all the events for the map.  Used when solving in
-   memory, so the AEvent* should fit in memory.  */
+   memory, so the AEvent* should fit in memory.  If elev is not NULL,
+   the elevation is taken from elev (see read_elevation_grid()) instead
+   of the raster, and no messages are printed; this can be called by
+   several threads at the same time.  */
 size_t
 init_event_list_in_memory(AEvent * eventList, char *rastName,
 				Viewpoint * vp, GridHeader * hd,
 				ViewOptions viewOptions, surface_type ***data,
-				MemoryVisibilityGrid * visgrid);
+				MemoryVisibilityGrid * visgrid,
+				const G_SURFACE_T * elev);
+
+
+/* read the raster into memory, rows after rows */
+G_SURFACE_T *read_elevation_grid(char *rastName);
 
 
 
@@ -46,6 +46,7 @@ extern "C"
 #include <grass/config.h>
 #include <grass/gis.h>
 #include <grass/glocale.h>
+#include <grass/vector.h>
 }
 #include "grass.h"
 #include <grass/iostream/ami.h>
@@ -56,6 +57,7 @@ extern "C"
 #include "rbbst.h"
 #include "statusstructure.h"
 #include "distribute.h"
+#include "batch.h"
 
 
 
@@ -93,9 +95,9 @@ void print_timings_internal(Rtimer sweepTime, Rtimer outputTime,
 void print_timings_external_memory(Rtimer totalTime, Rtimer viewshedTime,
 				   Rtimer outputTime, Rtimer sortOutputTime);
 
-void parse_args(int argc, char *argv[], int *vpRow, int *vpCol,
-		ViewOptions * viewOptions, long long *memSizeBytes,
-		Cell_head * window);
+void parse_args(int argc, char *argv[], int **vpRow, int **vpCol,
+		int *nvp, int *cumulative, ViewOptions * viewOptions,
+		long long *memSizeBytes, Cell_head * window);
 
 
 
@@ -133,12 +135,13 @@ int main(int argc, char *argv[])
        used.  The program uses this value to decied in which mode to
        run --- in internal memory, or external memory.  */
 
-    int vpRow, vpCol;
+    int *vpRow, *vpCol, nvp, cumulative;
 
     /* the coordinates of the viewpoint in the raster; right now the
        algorithm assumes that the viewpoint is inside the grid, though
        this is not necessary; some changes will be needed to make it
-       work with a viewpoint outside the terrain */
+       work with a viewpoint outside the terrain. With more than one
+       viewpoint, the cumulative viewshed is computed */
 
     ViewOptions viewOptions;
 
@@ -152,15 +155,15 @@ int main(int argc, char *argv[])
     viewOptions.doRefr = FALSE;
     viewOptions.refr_coef = 1.0/7.0;
 
-    parse_args(argc, argv, &vpRow, &vpCol, &viewOptions, &memSizeBytes,
-	       &region);
+    parse_args(argc, argv, &vpRow, &vpCol, &nvp, &cumulative, &viewOptions,
+	       &memSizeBytes, &region);
 
     /* set viewpoint with the coordinates specified by user. The
        height of the viewpoint is not known at this point---it will be
        set during the execution of the algorithm */
     Viewpoint vp;
 
-    set_viewpoint_coord(&vp, vpRow, vpCol);
+    set_viewpoint_coord(&vp, vpRow[0], vpCol[0]);
 
 
     /* ************************************************************ */
@@ -237,7 +240,25 @@ int main(int argc, char *argv[])
     /* ************************************************************ */
     /* compute viewshed in memory */
     /* ************************************************************ */
-    if (IN_MEMORY) {
+    if (cumulative) {
+	/*//////////////////////////////////////////////////// */
+	/*/cumulative viewshed of several viewpoints, in memory */
+	/*//////////////////////////////////////////////////// */
+	Viewpoint *vps = (Viewpoint *) G_malloc(nvp * sizeof(Viewpoint));
+
+	for (int i = 0; i < nvp; i++) {
+	    if (vpRow[i] < 0 || vpRow[i] >= hd->nrows ||
+		vpCol[i] < 0 || vpCol[i] >= hd->ncols)
+		G_fatal_error(_("Viewpoint %d outside of computational region"),
+			      i + 1);
+	    set_viewpoint_coord(&vps[i], vpRow[i], vpCol[i]);
+	}
+
+	cumulative_viewshed(viewOptions.inputfname, hd, vps, nvp,
+			    viewOptions, memSizeBytes, cumulative == 2);
+	G_free(vps);
+    }
+    else if (IN_MEMORY) {
 	/*//////////////////////////////////////////////////// */
 	/*/viewshed in internal  memory */
 	/*//////////////////////////////////////////////////// */
@@ -248,8 +269,8 @@ int main(int argc, char *argv[])
 
 	/*compute the viewshed and store it in visgrid */
 	rt_start(sweepTime);
-	visgrid =
-	    viewshed_in_memory(viewOptions.inputfname, hd, &vp, viewOptions);
+	visgrid = viewshed_in_memory(viewOptions.inputfname, hd, &vp,
+				     viewOptions, NULL);
 	rt_stop(sweepTime);
 
 	/* write the output */
@@ -430,12 +451,12 @@ int main(int argc, char *argv[])
 /* ------------------------------------------------------------ */
 /* parse arguments */
 void
-parse_args(int argc, char *argv[], int *vpRow, int *vpCol,
-	   ViewOptions * viewOptions, long long *memSizeBytes,
-	   Cell_head * window)
+parse_args(int argc, char *argv[], int **vpRow, int **vpCol,
+	   int *nvp, int *cumulative, ViewOptions * viewOptions,
+	   long long *memSizeBytes, Cell_head * window)
 {
 
-    assert(vpRow && vpCol && memSizeBytes && window);
+    assert(vpRow && vpCol && nvp && cumulative && memSizeBytes && window);
 
     /* the input */
     struct Option *inputOpt;
@@ -487,8 +508,35 @@ parse_args(int argc, char *argv[], int *vpRow, int *vpCol,
     struct Option *viewLocOpt;
 
     viewLocOpt = G_define_standard_option(G_OPT_M_COORDS);
-    viewLocOpt->required = YES;
+    viewLocOpt->required = NO;
+    viewLocOpt->multiple = YES;
     viewLocOpt->description = _("Coordinates of viewing position");
+    viewLocOpt->guisection = _("Viewpoints");
+
+    /* viewpoints from vector map */
+    struct Option *pointsOpt;
+
+    pointsOpt = G_define_standard_option(G_OPT_V_INPUT);
+    pointsOpt->key = "points";
+    pointsOpt->required = NO;
+    pointsOpt->label = _("Name of input vector map with viewing positions");
+    pointsOpt->description =
+	_("The output is the number of viewpoints each cell is visible from");
+    pointsOpt->guisection = _("Viewpoints");
+
+    /* regular grid of viewpoints */
+    struct Option *spacingOpt;
+
+    spacingOpt = G_define_option();
+    spacingOpt->key = "spacing";
+    spacingOpt->type = TYPE_DOUBLE;
+    spacingOpt->required = NO;
+    spacingOpt->key_desc = "value";
+    spacingOpt->label =
+	_("Distance between viewpoints on a regular grid in map units");
+    spacingOpt->description =
+	_("The output is the number of viewpoints each cell is visible from");
+    spacingOpt->guisection = _("Viewpoints");
 
     /* observer elevation */
     struct Option *obsElevOpt;
@@ -581,6 +629,8 @@ parse_args(int argc, char *argv[], int *vpRow, int *vpCol,
     streamdirOpt->description=
        _("Directory to hold temporary files (they can be large)");
 
+    G_option_required(viewLocOpt, pointsOpt, spacingOpt, NULL);
+
     /*fill the options and flags with G_parser */
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
@@ -638,10 +688,104 @@ parse_args(int argc, char *argv[], int *vpRow, int *vpCol,
 
     /*The algorithm runs with the viewpoint row and col, so we need to
         convert the lat-lon coordinates to row and column format */
-    *vpRow = (int)Rast_northing_to_row(atof(viewLocOpt->answers[1]), window);
-    *vpCol = (int)Rast_easting_to_col(atof(viewLocOpt->answers[0]), window);
-    G_debug(3, "viewpoint converted from current projection: (%.3f, %.3f)  to col, row (%d, %d)",
-        atof(viewLocOpt->answers[0]), atof(viewLocOpt->answers[1]), *vpCol, *vpRow);
+    int n = 0, nalloc = 0;
+
+    *vpRow = *vpCol = NULL;
+    for (int i = 0; viewLocOpt->answers && viewLocOpt->answers[i];
+	 i += 2) {
+	double east = atof(viewLocOpt->answers[i]);
+	double north = atof(viewLocOpt->answers[i + 1]);
+
+	if (n == nalloc) {
+	    nalloc += 100;
+	    *vpRow = (int *)G_realloc(*vpRow, nalloc * sizeof(int));
+	    *vpCol = (int *)G_realloc(*vpCol, nalloc * sizeof(int));
+	}
+	(*vpRow)[n] = (int)Rast_northing_to_row(north, window);
+	(*vpCol)[n] = (int)Rast_easting_to_col(east, window);
+	G_debug(3, "viewpoint converted from current projection: (%.3f, %.3f)  to col, row (%d, %d)",
+	    east, north, (*vpCol)[n], (*vpRow)[n]);
+	n++;
+    }
+
+    if (pointsOpt->answer) {
+	struct Map_info In;
+	struct line_pnts *Points = Vect_new_line_struct();
+	struct line_cats *Cats = Vect_new_cats_struct();
+	struct bound_box box;
+	int type;
+
+	Vect_set_open_level(1);	/* topology not required */
+	if (1 > Vect_open_old(&In, pointsOpt->answer, ""))
+	    G_fatal_error(_("Unable to open vector map <%s>"),
+			  pointsOpt->answer);
+
+	Vect_region_box(window, &box);
+	while ((type = Vect_read_next_line(&In, Points, Cats)) != -2) {
+	    if (type == -1)
+		G_fatal_error(_("Unable to read vector map <%s>"),
+			      Vect_get_full_name(&In));
+	    if (!(type & GV_POINTS) ||
+		!Vect_point_in_box(Points->x[0], Points->y[0], 0, &box))
+		continue;
+
+	    if (n == nalloc) {
+		nalloc += 100;
+		*vpRow = (int *)G_realloc(*vpRow, nalloc * sizeof(int));
+		*vpCol = (int *)G_realloc(*vpCol, nalloc * sizeof(int));
+	    }
+	    (*vpRow)[n] = (int)Rast_northing_to_row(Points->y[0], window);
+	    (*vpCol)[n] = (int)Rast_easting_to_col(Points->x[0], window);
+	    /* points on the south or east edge of the region */
+	    if ((*vpRow)[n] < window->rows && (*vpCol)[n] < window->cols)
+		n++;
+	}
+	Vect_close(&In);
+	Vect_destroy_line_struct(Points);
+	Vect_destroy_cats_struct(Cats);
+    }
+
+    if (spacingOpt->answer) {
+	double spacing = atof(spacingOpt->answer);
+	int rstep, cstep;
+
+	if (spacing <= 0)
+	    G_fatal_error(_("The spacing of viewpoints must be positive"));
+
+	/* every rstep-th row and cstep-th column, starting half a
+	   step from the edges */
+	rstep = MAX((int)(spacing / window->ns_res + 0.5), 1);
+	cstep = MAX((int)(spacing / window->ew_res + 0.5), 1);
+	for (int row = rstep / 2; row < window->rows; row += rstep) {
+	    for (int col = cstep / 2; col < window->cols; col += cstep) {
+		if (n == nalloc) {
+		    nalloc += 100 + nalloc;
+		    *vpRow = (int *)G_realloc(*vpRow, nalloc * sizeof(int));
+		    *vpCol = (int *)G_realloc(*vpCol, nalloc * sizeof(int));
+		}
+		(*vpRow)[n] = row;
+		(*vpCol)[n] = col;
+		n++;
+	    }
+	}
+    }
+
+    if (n == 0)
+	G_fatal_error(_("No viewpoints in the current region"));
+
+    *nvp = n;
+    /* viewpoints of the regular grid without elevation are skipped */
+    if (spacingOpt->answer)
+	*cumulative = 2;
+    else
+	*cumulative = n > 1 || pointsOpt->answer;
+    if (*cumulative) {
+	G_verbose_message(_("Cumulative viewshed of %d viewpoints"), n);
+	if (booleanOutput->answer || elevationFlag->answer)
+	    G_warning(_("The output of several viewpoints is the number "
+			"of viewpoints each cell is visible from, "
+			"flags -b and -e are ignored"));
+    }
 
     return;
 }
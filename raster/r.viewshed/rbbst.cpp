@@ -81,7 +81,7 @@ extern "C"
 
 
 
-TreeNode *NIL;
+THREAD_LOCAL TreeNode *NIL;
 
 #define EPSILON 0.0000001
 
@@ -154,7 +154,9 @@ double find_max_gradient_within_key(RBTree * rbt, double key, double angle, doub
    //Private below this line */
 void init_nil_node()
 {
-    NIL = (TreeNode *) G_malloc(sizeof(TreeNode));
+    /* one sentinel for all trees of a thread */
+    if (!NIL)
+	NIL = (TreeNode *) G_malloc(sizeof(TreeNode));
     NIL->color = RB_BLACK;
     NIL->value.angle[0] = 0;
     NIL->value.angle[1] = 0;
@@ -38,6 +38,8 @@
 #ifndef __RB_BINARY_SEARCH_TREE__
 #define __RB_BINARY_SEARCH_TREE__
 
+#include <grass/config.h>
+
 #define SMALLEST_GRADIENT (- 9999999999999999999999.0)
 /*this value is returned by findMaxValueWithinDist() is there is no
    key within that distance.  The largest double value is 1.7 E 308 */
@@ -47,6 +49,15 @@
 #define RB_RED (0)
 #define RB_BLACK (1)
 
+/* the NIL sentinel is per thread, so that viewsheds can be computed
+   by several threads at the same time, see batch.cpp */
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#define HAVE_THREAD_LOCAL 1
+#else
+#define THREAD_LOCAL
+#endif
+
 /*<===========================================>
    //public:
    //The value that's stored in the tree
@@ -119,6 +119,73 @@ class TestViewshedAgainstReference(TestCase):
                                        precision=self.precision)
         # TODO: add self.assertRasterFitsUnivar()
 
+    def test_cumulative_viewshed(self):
+        """Test the number of viewpoints against single viewsheds"""
+        viewshed = 'actual_cumulative_viewshed'
+        ref_viewshed = 'reference_cumulative_viewshed'
+        obs_elev = '1.72'
+        points = [(634720, 216180), (635500, 216700)]
+
+        for i, point in enumerate(points):
+            self.assertModule('r.viewshed', input=self.elevation,
+                              coordinates=point, output='%s_%d' % (viewshed, i),
+                              observer_elevation=obs_elev)
+            self.to_remove.append('%s_%d' % (viewshed, i))
+        self.runModule('r.mapcalc', expression='{r} = if(isnull({e}), null(), '
+                       '!isnull({v}_0) + !isnull({v}_1))'.format(
+                           r=ref_viewshed, e=self.elevation, v=viewshed))
+        self.to_remove.append(ref_viewshed)
+
+        self.assertModule('r.viewshed', input=self.elevation,
+                          coordinates=points[0] + points[1], output=viewshed,
+                          observer_elevation=obs_elev)
+        self.to_remove.append(viewshed)
+
+        self.assertRasterMinMax(map=viewshed, refmin=0, refmax=len(points),
+                                msg="Number of viewpoints must be between 0 and 2")
+        self.assertRastersNoDifference(actual=viewshed, reference=ref_viewshed,
+                                       precision=0)
+
+    def test_cumulative_viewshed_max_distance(self):
+        """Test the shared event geometry against single viewsheds"""
+        viewshed = 'actual_cumulative_viewshed_dist'
+        ref_viewshed = 'reference_cumulative_viewshed_dist'
+        obs_elev = '1.72'
+        max_dist = '500'
+        points = [(634720, 216180), (635500, 216700), (633735, 215525)]
+
+        for i, point in enumerate(points):
+            self.assertModule('r.viewshed', input=self.elevation,
+                              coordinates=point, output='%s_%d' % (viewshed, i),
+                              observer_elevation=obs_elev,
+                              max_distance=max_dist)
+            self.to_remove.append('%s_%d' % (viewshed, i))
+        self.runModule('r.mapcalc', expression='{r} = if(isnull({e}), null(), '
+                       '!isnull({v}_0) + !isnull({v}_1) + !isnull({v}_2))'.format(
+                           r=ref_viewshed, e=self.elevation, v=viewshed))
+        self.to_remove.append(ref_viewshed)
+
+        self.assertModule('r.viewshed', input=self.elevation,
+                          coordinates=points[0] + points[1] + points[2],
+                          output=viewshed, observer_elevation=obs_elev,
+                          max_distance=max_dist)
+        self.to_remove.append(viewshed)
+
+        self.assertRastersNoDifference(actual=viewshed, reference=ref_viewshed,
+                                       precision=0)
+
+    def test_viewshed_spacing(self):
+        """Test a regular grid of viewpoints"""
+        viewshed = 'actual_spacing_viewshed'
+
+        self.assertModule('r.viewshed', input=self.elevation, spacing=500,
+                          output=viewshed, max_distance=800)
+        self.to_remove.append(viewshed)
+
+        # 4 x 3 viewpoints in the 222 x 147 cells region
+        self.assertRasterMinMax(map=viewshed, refmin=0, refmax=12,
+                                msg="Number of viewpoints must be between 0 and 12")
+
 
 if __name__ == '__main__':
     test()
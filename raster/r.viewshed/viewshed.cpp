@@ -195,11 +195,13 @@ AEvent *allocate_eventlist(GridHeader * hd)
  */
 MemoryVisibilityGrid *viewshed_in_memory(char *inputfname, GridHeader * hd,
 					 Viewpoint * vp,
-					 ViewOptions viewOptions)
+					 ViewOptions viewOptions,
+					 const G_SURFACE_T * elev)
 {
 
     assert(inputfname && hd && vp);
-    G_verbose_message(_("Start sweeping."));
+    if (!elev)
+	G_verbose_message(_("Start sweeping."));
 
     /* ------------------------------ */
     /* create the visibility grid  */
@@ -229,7 +231,8 @@ MemoryVisibilityGrid *viewshed_in_memory(char *inputfname, GridHeader * hd,
     AEvent *eventList = allocate_eventlist(hd);
 
     nevents = init_event_list_in_memory(eventList, inputfname, vp, hd,
-					      viewOptions, &data, visgrid);
+					      viewOptions, &data, visgrid,
+					      elev);
 
     assert(data);
     rt_stop(initEventTime);
@@ -240,7 +243,8 @@ MemoryVisibilityGrid *viewshed_in_memory(char *inputfname, GridHeader * hd,
     Rtimer sortEventTime;
 
     rt_start(sortEventTime);
-    G_verbose_message(_("Sorting events..."));
+    if (!elev)
+	G_verbose_message(_("Sorting events..."));
     fflush(stdout);
 
     /*this is recursive and seg faults for large arrays
@@ -253,7 +257,8 @@ MemoryVisibilityGrid *viewshed_in_memory(char *inputfname, GridHeader * hd,
     RadialCompare cmpObj;
 
     quicksort(eventList, nevents, cmpObj);
-    G_verbose_message(_("Done."));
+    if (!elev)
+	G_verbose_message(_("Done."));
     fflush(stdout);
     rt_stop(sortEventTime);
 
@@ -322,13 +327,15 @@ MemoryVisibilityGrid *viewshed_in_memory(char *inputfname, GridHeader * hd,
     long nvis = 0;		/*number of visible cells */
     AEvent *e;
 
-    G_important_message(_("Computing visibility..."));
-    G_percent(0, 100, 2);
+    if (!elev) {
+	G_important_message(_("Computing visibility..."));
+	G_percent(0, 100, 2);
+    }
 
     for (size_t i = 0; i < nevents; i++) {
 
 	int perc = (int)(1000000 * i / nevents);
-	if (perc > 0 && perc < 1000000)
+	if (perc > 0 && perc < 1000000 && !elev)
 	    G_percent(perc, 1000000, 1);
 
 	/*get out one event at a time and process it according to its type */
@@ -422,20 +429,24 @@ MemoryVisibilityGrid *viewshed_in_memory(char *inputfname, GridHeader * hd,
 	}
     }
     rt_stop(sweepTime);
-    G_percent(1, 1, 1);
 
-    G_verbose_message(_("Sweeping done."));
-    G_verbose_message(_("Total cells %ld, visible cells %ld (%.1f percent)."),
-	   (long)visgrid->grid->hd->nrows * visgrid->grid->hd->ncols,
-	   nvis,
-	   (float)((float)nvis * 100 /
-		   (float)(visgrid->grid->hd->nrows *
-			   visgrid->grid->hd->ncols)));
+    if (!elev) {
+	G_percent(1, 1, 1);
 
-    print_viewshed_timings(initEventTime, sortEventTime, sweepTime);
+	G_verbose_message(_("Sweeping done."));
+	G_verbose_message(_("Total cells %ld, visible cells %ld (%.1f percent)."),
+	       (long)visgrid->grid->hd->nrows * visgrid->grid->hd->ncols,
+	       nvis,
+	       (float)((float)nvis * 100 /
+		       (float)(visgrid->grid->hd->nrows *
+			       visgrid->grid->hd->ncols)));
+
+	print_viewshed_timings(initEventTime, sortEventTime, sweepTime);
+    }
 
     /*cleanup */
     G_free(eventList);
+    delete_status_structure(status_struct);
 
     return visgrid;
 }
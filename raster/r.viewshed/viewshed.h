@@ -69,11 +69,16 @@ long long get_viewshed_memory_usage(GridHeader * hd);
    is set to INVISIBLE if it is visible, then x is set to the vertical
    angle wrt to viewpoint
 
+   If elev is not NULL, the elevation is taken from elev instead of the
+   input file and no messages are printed, so that several viewsheds can
+   be computed at the same time (see batch.cpp).
+
  */
 MemoryVisibilityGrid *viewshed_in_memory(char *inputfname,
 					 GridHeader * hd,
 					 Viewpoint * vp,
-					 ViewOptions viewOptions);
+					 ViewOptions viewOptions,
+					 const G_SURFACE_T * elev);
 
 
 
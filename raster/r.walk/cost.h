@@ -21,7 +21,7 @@ struct cost
 };
 
 /* heap.c */
-struct cost *insert(double, int, int);
+int insert(double, int, int);
 struct cost *get_lowest(void);
 int delete(struct cost *);
 int init_heap(void);
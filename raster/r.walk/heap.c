@@ -28,14 +28,20 @@
  * A min-heap approach is used.  Components are
  * sorted first by distance then by the order in which they were added.
  *
+ * The heap is a 4-ary heap, its points are stored by value in one
+ * array: comparisons during sifting read neighbouring array elements
+ * instead of following pointers to individually allocated points, and
+ * inserting or removing a point allocates no memory.
+ *
  * insert ()
  *   inserts a new row-col with its distance value into the heap
  *
  * delete()
- *   deletes a row-col entry in the heap
+ *   releases the point returned by get_lowest(), nothing to do
  *
  * get_lowest()
- *   retrieves the entry with the smallest distance value
+ *   retrieves the entry with the smallest distance value, the point
+ *   returned is valid until the next call
  */
 
 
@@ -44,40 +50,41 @@
 #include <grass/glocale.h>
 #include "cost.h"
 
-#define GET_PARENT(c) (((c) - 2) / 3 + 1)
-#define GET_CHILD(p) (((p) * 3) - 1)
+/* the root is at index 1 */
+#define GET_PARENT(c) (((c) + 2) >> 2)
+#define GET_CHILD(p) (((p) << 2) - 2)
 
 static long next_point = 0;
 static long heap_size = 0;
 static long heap_alloced = 0;
-static struct cost **heap_index, *free_point;
+static struct cost *heap;
+static struct cost lowest;	/* returned by get_lowest(), not moved by
+				   realloc in insert() */
 
 int init_heap(void)
 {
     next_point = 0;
     heap_size = 0;
-    heap_alloced = 1000;
-    heap_index = (struct cost **) G_malloc(heap_alloced * sizeof(struct cost *));
+    heap_alloced = 1024;
+    heap = (struct cost *) G_malloc(heap_alloced * sizeof(struct cost));
 
-    free_point = NULL;
-    
     return 0;
 }
 
 int free_heap(void)
 {
     if (heap_alloced)
-	G_free(heap_index);
+	G_free(heap);
 
-    if (free_point)
-	G_free(free_point);
+    heap = NULL;
+    heap_alloced = 0;
 
     return 0;
 }
 
 /* compare two costs
  * return 1 if a < b else 0 */
-int cmp_costs(struct cost *a, struct cost *b)
+static int cmp_costs(const struct cost *a, const struct cost *b)
 {
     if (a->min_cost < b->min_cost)
 	return 1;
@@ -89,7 +96,8 @@ int cmp_costs(struct cost *a, struct cost *b)
     return 0;
 }
 
-long sift_up(long start, struct cost * child_pnt)
+/* move the hole at start up until pnt can be put there */
+static long sift_up(long start, const struct cost *pnt)
 {
     register long parent, child;
 
@@ -99,9 +107,9 @@ long sift_up(long start, struct cost * child_pnt)
 	parent = GET_PARENT(child);
 
 	/* child is smaller */
-	if (cmp_costs(child_pnt, heap_index[parent])) {
+	if (cmp_costs(pnt, &heap[parent])) {
 	    /* push parent point down */
-	    heap_index[child] = heap_index[parent];
+	    heap[child] = heap[parent];
 	    child = parent;
 	}
 	else
@@ -110,59 +118,46 @@ long sift_up(long start, struct cost * child_pnt)
     }
 
     /* put point in new slot */
-    if (child < start) {
-	heap_index[child] = child_pnt;
-    }
+    heap[child] = *pnt;
 
     return child;
 }
 
-struct cost *insert(double min_cost, int row, int col)
+int insert(double min_cost, int row, int col)
 {
-    struct cost *new_cell;
-
-    if (free_point) {
-	new_cell = free_point;
-	free_point = NULL;
-    }
-    else
-	new_cell = (struct cost *)(G_malloc(sizeof(struct cost)));
+    struct cost new_cell;
 
-    new_cell->min_cost = min_cost;
-    new_cell->age = next_point;
-    new_cell->row = row;
-    new_cell->col = col;
+    new_cell.min_cost = min_cost;
+    new_cell.age = next_point;
+    new_cell.row = row;
+    new_cell.col = col;
 
     next_point++;
     heap_size++;
     if (heap_size >= heap_alloced) {
-	heap_alloced += 1000;
-	heap_index = (struct cost **) G_realloc((void *)heap_index, heap_alloced * sizeof(struct cost *));
+	/* grow geometrically, the points are moved by realloc */
+	heap_alloced *= 2;
+	heap = (struct cost *) G_realloc((void *)heap, heap_alloced * sizeof(struct cost));
     }
 
-    heap_index[heap_size] = new_cell;
-    sift_up(heap_size, new_cell);
+    sift_up(heap_size, &new_cell);
 
-    return (new_cell);
+    return 0;
 }
 
 struct cost *get_lowest(void)
 {
-    struct cost *next_cell;
     register long parent, child, childr, i;
 
     if (heap_size == 0)
 	return NULL;
 	
-    next_cell = heap_index[1];
-    heap_index[0] = next_cell;
+    lowest = heap[1];
 
     if (heap_size == 1) {
 	heap_size--;
 
-	heap_index[1] = NULL;
-
-	return next_cell;
+	return &lowest;
     }
 
     /* start with root */
@@ -174,10 +169,10 @@ struct cost *get_lowest(void)
 	/* select smallest child */
 	if (child < heap_size) {
 	    childr = child + 1;
-	    i = child + 3;
+	    i = child + 4;
 	    while (childr < i && childr <= heap_size) {
 		/* get smallest child */
-		if (cmp_costs(heap_index[childr], heap_index[child])) {
+		if (cmp_costs(&heap[childr], &heap[child])) {
 		    child = childr;
 		}
 		childr++;
@@ -185,30 +180,24 @@ struct cost *get_lowest(void)
 	}
 
 	/* move hole down */
-	heap_index[parent] = heap_index[child];
+	heap[parent] = heap[child];
 	parent = child;
     }
 
     /* hole is in lowest layer, move to heap end */
     if (parent < heap_size) {
-	heap_index[parent] = heap_index[heap_size];
-
-	/* sift up last swapped point, only necessary if hole moved to heap end */
-	sift_up(parent, heap_index[parent]);
+	/* sift up last point, only necessary if hole moved to heap end */
+	sift_up(parent, &heap[heap_size]);
     }
 
     /* the actual drop */
     heap_size--;
 
-    return next_cell;
+    return &lowest;
 }
 
 int delete(struct cost *delete_cell)
 {
-    if (free_point)
-	G_free(delete_cell);
-    else
-	free_point = delete_cell;
-
+    /* the points are owned by the heap */
     return 0;
 }
@@ -965,7 +965,6 @@ int main(int argc, char *argv[])
 
     pres_cell = get_lowest();
     while (pres_cell != NULL) {
-	struct cost *ct;
 	double N_dtm, NE_dtm, E_dtm, SE_dtm, S_dtm, SW_dtm, W_dtm, NW_dtm;
 	double NNE_dtm, ENE_dtm, ESE_dtm, SSE_dtm, SSW_dtm, WSW_dtm, WNW_dtm,
 	    NNW_dtm;
@@ -1564,12 +1563,8 @@ int main(int argc, char *argv[])
 	if (stop_pnts && time_to_stop(pres_cell->row, pres_cell->col))
 	    break;
 
-	ct = pres_cell;
 	delete(pres_cell);
 	pres_cell = get_lowest();
-
-	if (ct == pres_cell)
-	    G_warning(_("Error, ct == pres_cell"));
     }
     G_percent(1, 1, 1);
 
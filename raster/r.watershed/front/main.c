@@ -24,7 +24,7 @@
 
 static void write_hist(char *, char *, char *, int, int);
 
-static const char *new_argv[22];
+static const char *new_argv[26];
 static int new_argc;
 
 static void do_opt(const struct Option *opt)
@@ -61,6 +61,7 @@ int main(int argc, char *argv[])
     struct Option *opt17;
     struct Option *opt18;
     struct Option *opt19;
+    struct Option *opt_nprocs;
     struct Flag *flag_sfd;
     struct Flag *flag_flow;
     struct Flag *flag_seg;
@@ -215,6 +216,10 @@ int main(int argc, char *argv[])
     opt16->answer = "300";	/* 300MB default value, please keep r.terraflow in sync */
     opt16->description = _("Maximum memory to be used with -m flag (in MB)");
 
+    opt_nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+    opt_nprocs->description =
+	_("Number of threads for flow accumulation, not used with -m flag");
+
     flag_sfd = G_define_flag();
     flag_sfd->key = 's';
     flag_sfd->label = _("SFD (D8) flow (default is MFD)");
@@ -304,6 +309,8 @@ int main(int argc, char *argv[])
     do_opt(opt15);
     if (flag_seg->answer)
 	do_opt(opt16);
+    else
+	do_opt(opt_nprocs);
     new_argv[new_argc++] = NULL;
 
     G_debug(1, "Mode: %s", flag_seg->answer ? "Segmented" : "All in RAM");
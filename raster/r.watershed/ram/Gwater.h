@@ -51,6 +51,7 @@ extern int first_astar, first_cum, nxt_avail_pt, total_cells, do_points;
 extern int nrows, ncols;
 extern double half_res, diag, max_length, dep_slope;
 extern int bas_thres, tot_parts;
+extern int nprocs;
 extern CELL n_basins;
 extern OC_STACK *ocs;
 extern int ocs_alloced;
@@ -59,7 +60,8 @@ extern RAMSEG dis_seg, alt_seg, wat_seg, asp_seg, bas_seg, haf_seg;
 extern RAMSEG r_h_seg, dep_seg, rtn_seg;
 extern RAMSEG slp_seg, s_l_seg, s_g_seg, l_s_seg;
 extern int *astar_pts;
-extern CELL *dis, *alt, *asp, *bas, *haf, *r_h, *dep;
+extern CELL *dis, *alt, *bas, *haf, *r_h, *dep;
+extern signed char *asp;	/* drainage directions -8 to 8 */
 extern char *rtn;
 extern DCELL *wat, *sca, *tanb;
 extern int ril_fd;
@@ -104,10 +106,19 @@ double get_slope(int, int, int, int, CELL, CELL);
 int do_flatarea(int, CELL, CELL *, CELL *);
 
 /* do_cum.c */
+double get_dist(double *, double *);
+double get_slope_tci(CELL, CELL, double);
 int do_cum(void);
 int do_cum_mfd(void);
 double mfd_pow(double, int);
 
+/* do_cum_par.c */
+int do_cum_par(double *, double *, double, int);
+
+/* flowcache.c */
+int read_flowcache(void);
+int write_flowcache(void);
+
 /* find_pour.c */
 int find_pourpts(void);
 
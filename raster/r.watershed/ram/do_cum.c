@@ -125,6 +125,14 @@ int do_cum(void)
 	threshold = 60;
     else
 	threshold = bas_thres;
+
+    if (nprocs > 1) {
+	do_cum_par(dist_to_nbr, contour, cell_size, threshold);
+	G_free(astar_pts);
+
+	return 0;
+    }
+
     for (killer = 1; killer <= do_points; killer++) {
 	G_percent(killer, do_points, 1);
 	this_index = astar_pts[killer];
@@ -311,199 +319,203 @@ int do_cum_mfd(void)
     else
 	threshold = bas_thres;
 
-    for (killer = 1; killer <= do_points; killer++) {
-	G_percent(killer, do_points, 1);
-	this_index = astar_pts[killer];
-	seg_index_rc(alt_seg, this_index, &r, &c);
-	FLAG_SET(worked, r, c);
-	aspect = asp[this_index];
-	if (aspect) {
-	    dr = r + asp_r[ABS(aspect)];
-	    dc = c + asp_c[ABS(aspect)];
-	}
-	else
-	    dr = dc = -1;
-	if (dr >= 0 && dr < nrows && dc >= 0 && dc < ncols) {	/* if ((dr = astar_pts[killer].downr) > -1) { */
-	    value = wat[this_index];
-            /* apply retention to adjust flow accumulation */
-            if (rtn_flag)
-                value *= rtn[this_index] / 100.0;
-	    down_index = SEG_INDEX(wat_seg, dr, dc);
-
-	    /* get weights */
-	    max_weight = 0;
-	    sum_weight = 0;
-	    np_side = -1;
-	    mfd_cells = 0;
-	    astar_not_set = 1;
-	    ele = alt[this_index];
-	    is_null = 0;
-	    edge = 0;
-	    /* this loop is needed to get the sum of weights */
-	    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
-		/* get r, c (r_nbr, c_nbr) for neighbours */
-		r_nbr = r + nextdr[ct_dir];
-		c_nbr = c + nextdc[ct_dir];
-		weight[ct_dir] = -1;
-
-		if (dr == r_nbr && dc == c_nbr)
-		    np_side = ct_dir;
-
-		/* check that neighbour is within region */
-		if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 &&
-		    c_nbr < ncols) {
-
-		    nbr_index = SEG_INDEX(wat_seg, r_nbr, c_nbr);
-
-		    valued = wat[nbr_index];
-		    ele_nbr = alt[nbr_index];
-
-		    is_worked = FLAG_GET(worked, r_nbr, c_nbr);
-		    if (is_worked == 0) {
-			is_null = Rast_is_c_null_value(&ele_nbr);
-			edge = is_null;
-			if (!is_null && ele_nbr <= ele) {
-			    if (ele_nbr < ele) {
-				weight[ct_dir] =
-				    mfd_pow(((ele -
-					      ele_nbr) / dist_to_nbr[ct_dir]),
-					    c_fac);
-			    }
-			    if (ele_nbr == ele) {
-				weight[ct_dir] =
-				    mfd_pow((0.5 / dist_to_nbr[ct_dir]),
-					    c_fac);
-			    }
-			    sum_weight += weight[ct_dir];
-			    mfd_cells++;
-
-			    if (weight[ct_dir] > max_weight) {
-				max_weight = weight[ct_dir];
-			    }
-
-			    if (dr == r_nbr && dc == c_nbr) {
-				astar_not_set = 0;
-			    }
-			    if (value < 0 && valued > 0)
-				wat[nbr_index] = -valued;
-			}
-		    }
-		}
-		else
-		    edge = 1;
-		if (edge)
-		    break;
-	    }
-	    /* do not distribute flow along edges, this causes artifacts */
-	    if (edge) {
-		continue;
-	    }
-
-	    /* honour A * path 
-	     * mfd_cells == 0: fine, SFD along A * path
-	     * mfd_cells == 1 && astar_not_set == 0: fine, SFD along A * path
-	     * mfd_cells > 0 && astar_not_set == 1: A * path not included, add to mfd_cells
-	     */
-
-	    /* MFD, A * path not included, add to mfd_cells */
-	    if (mfd_cells > 0 && astar_not_set == 1) {
-		mfd_cells++;
-		sum_weight += max_weight;
-		weight[np_side] = max_weight;
+    if (nprocs > 1)
+	do_cum_par(dist_to_nbr, contour, cell_size, threshold);
+    else {
+	for (killer = 1; killer <= do_points; killer++) {
+	    G_percent(killer, do_points, 1);
+	    this_index = astar_pts[killer];
+	    seg_index_rc(alt_seg, this_index, &r, &c);
+	    FLAG_SET(worked, r, c);
+	    aspect = asp[this_index];
+	    if (aspect) {
+		dr = r + asp_r[ABS(aspect)];
+		dc = c + asp_c[ABS(aspect)];
 	    }
-
-	    /* set flow accumulation for neighbours */
-	    max_val = -1;
-	    tci_div = sum_contour = 0.;
-
-	    if (mfd_cells > 1) {
-		prop = 0.0;
+	    else
+		dr = dc = -1;
+	    if (dr >= 0 && dr < nrows && dc >= 0 && dc < ncols) {   /* if ((dr = astar_pts[killer].downr) > -1) { */
+		value = wat[this_index];
+		/* apply retention to adjust flow accumulation */
+		if (rtn_flag)
+		    value *= rtn[this_index] / 100.0;
+		down_index = SEG_INDEX(wat_seg, dr, dc);
+
+		/* get weights */
+		max_weight = 0;
+		sum_weight = 0;
+		np_side = -1;
+		mfd_cells = 0;
+		astar_not_set = 1;
+		ele = alt[this_index];
+		is_null = 0;
+		edge = 0;
+		/* this loop is needed to get the sum of weights */
 		for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+		    /* get r, c (r_nbr, c_nbr) for neighbours */
 		    r_nbr = r + nextdr[ct_dir];
 		    c_nbr = c + nextdc[ct_dir];
+		    weight[ct_dir] = -1;
+
+		    if (dr == r_nbr && dc == c_nbr)
+			np_side = ct_dir;
 
 		    /* check that neighbour is within region */
 		    if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 &&
-			c_nbr < ncols && weight[ct_dir] > -0.5) {
-			is_worked = FLAG_GET(worked, r_nbr, c_nbr);
-			if (is_worked == 0) {
+			c_nbr < ncols) {
 
-			    nbr_index = SEG_INDEX(wat_seg, r_nbr, c_nbr);
+			nbr_index = SEG_INDEX(wat_seg, r_nbr, c_nbr);
 
-			    weight[ct_dir] = weight[ct_dir] / sum_weight;
-			    /* check everything adds up to 1.0 */
-			    prop += weight[ct_dir];
+			valued = wat[nbr_index];
+			ele_nbr = alt[nbr_index];
 
-			    if (atanb_flag) {
-				sum_contour += contour[ct_dir];
-				tci_div += get_slope_tci(ele, alt[nbr_index],
-							 dist_to_nbr[ct_dir])
-				    * weight[ct_dir];
+			is_worked = FLAG_GET(worked, r_nbr, c_nbr);
+			if (is_worked == 0) {
+			    is_null = Rast_is_c_null_value(&ele_nbr);
+			    edge = is_null;
+			    if (!is_null && ele_nbr <= ele) {
+				if (ele_nbr < ele) {
+				    weight[ct_dir] =
+					mfd_pow(((ele -
+						  ele_nbr) / dist_to_nbr[ct_dir]),
+						c_fac);
+				}
+				if (ele_nbr == ele) {
+				    weight[ct_dir] =
+					mfd_pow((0.5 / dist_to_nbr[ct_dir]),
+						c_fac);
+				}
+				sum_weight += weight[ct_dir];
+				mfd_cells++;
+
+				if (weight[ct_dir] > max_weight) {
+				    max_weight = weight[ct_dir];
+				}
+
+				if (dr == r_nbr && dc == c_nbr) {
+				    astar_not_set = 0;
+				}
+				if (value < 0 && valued > 0)
+				    wat[nbr_index] = -valued;
 			    }
+			}
+		    }
+		    else
+			edge = 1;
+		    if (edge)
+			break;
+		}
+		/* do not distribute flow along edges, this causes artifacts */
+		if (edge) {
+		    continue;
+		}
+
+		/* honour A * path 
+		 * mfd_cells == 0: fine, SFD along A * path
+		 * mfd_cells == 1 && astar_not_set == 0: fine, SFD along A * path
+		 * mfd_cells > 0 && astar_not_set == 1: A * path not included, add to mfd_cells
+		 */
+
+		/* MFD, A * path not included, add to mfd_cells */
+		if (mfd_cells > 0 && astar_not_set == 1) {
+		    mfd_cells++;
+		    sum_weight += max_weight;
+		    weight[np_side] = max_weight;
+		}
 
-			    valued = wat[nbr_index];
-			    if (value > 0) {
-				if (valued > 0)
-				    valued += value * weight[ct_dir];
-				else
-				    valued -= value * weight[ct_dir];
+		/* set flow accumulation for neighbours */
+		max_val = -1;
+		tci_div = sum_contour = 0.;
+
+		if (mfd_cells > 1) {
+		    prop = 0.0;
+		    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+			r_nbr = r + nextdr[ct_dir];
+			c_nbr = c + nextdc[ct_dir];
+
+			/* check that neighbour is within region */
+			if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 &&
+			    c_nbr < ncols && weight[ct_dir] > -0.5) {
+			    is_worked = FLAG_GET(worked, r_nbr, c_nbr);
+			    if (is_worked == 0) {
+
+				nbr_index = SEG_INDEX(wat_seg, r_nbr, c_nbr);
+
+				weight[ct_dir] = weight[ct_dir] / sum_weight;
+				/* check everything adds up to 1.0 */
+				prop += weight[ct_dir];
+
+				if (atanb_flag) {
+				    sum_contour += contour[ct_dir];
+				    tci_div += get_slope_tci(ele, alt[nbr_index],
+							     dist_to_nbr[ct_dir])
+					* weight[ct_dir];
+				}
+
+				valued = wat[nbr_index];
+				if (value > 0) {
+				    if (valued > 0)
+					valued += value * weight[ct_dir];
+				    else
+					valued -= value * weight[ct_dir];
+				}
+				else {
+				    if (valued < 0)
+					valued += value * weight[ct_dir];
+				    else
+					valued = value * weight[ct_dir] - valued;
+				}
+				wat[nbr_index] = valued;
 			    }
-			    else {
-				if (valued < 0)
-				    valued += value * weight[ct_dir];
-				else
-				    valued = value * weight[ct_dir] - valued;
+			    else if (ct_dir == np_side) {
+				/* check for consistency with A * path */
+				workedon++;
 			    }
-			    wat[nbr_index] = valued;
-			}
-			else if (ct_dir == np_side) {
-			    /* check for consistency with A * path */
-			    workedon++;
 			}
 		    }
+		    if (ABS(prop - 1.0) > 5E-6f) {
+			G_warning(_("MFD: cumulative proportion of flow distribution not 1.0 but %f"),
+				  prop);
+		    }
 		}
-		if (ABS(prop - 1.0) > 5E-6f) {
-		    G_warning(_("MFD: cumulative proportion of flow distribution not 1.0 but %f"),
-			      prop);
-		}
-	    }
-	    /* SFD-like accumulation */
-	    else {
-		valued = wat[down_index];
-		if (value > 0) {
-		    if (valued > 0)
-			valued += value;
-		    else
-			valued -= value;
-		}
+		/* SFD-like accumulation */
 		else {
-		    if (valued < 0)
-			valued += value;
-		    else
-			valued = value - valued;
-		}
-		wat[down_index] = valued;
+		    valued = wat[down_index];
+		    if (value > 0) {
+			if (valued > 0)
+			    valued += value;
+			else
+			    valued -= value;
+		    }
+		    else {
+			if (valued < 0)
+			    valued += value;
+			else
+			    valued = value - valued;
+		    }
+		    wat[down_index] = valued;
 
+		    if (atanb_flag) {
+			sum_contour = contour[np_side];
+			tci_div = get_slope_tci(ele, alt[down_index],
+						dist_to_nbr[np_side]);
+		    }
+		}
+		/* topographic wetness index ln(a / tan(beta)) and
+		 * stream power index a * tan(beta) */
 		if (atanb_flag) {
-		    sum_contour = contour[np_side];
-		    tci_div = get_slope_tci(ele, alt[down_index],
-					    dist_to_nbr[np_side]);
+		    sca[this_index] = fabs(value) *
+			(cell_size / sum_contour);
+		    tanb[this_index] = tci_div;
 		}
 	    }
-	    /* topographic wetness index ln(a / tan(beta)) and
-	     * stream power index a * tan(beta) */
-	    if (atanb_flag) {
-		sca[this_index] = fabs(value) *
-		    (cell_size / sum_contour);
-		tanb[this_index] = tci_div;
-	    }
 	}
+	if (workedon)
+	    G_warning(n_
+		      ("MFD: A * path already processed when distributing flow: %d of %d cell",
+		       "MFD: A * path already processed when distributing flow: %d of %d cells",
+		       do_points), workedon, do_points);
     }
-    if (workedon)
-	G_warning(n_
-		  ("MFD: A * path already processed when distributing flow: %d of %d cell",
-		   "MFD: A * path already processed when distributing flow: %d of %d cells",
-		   do_points), workedon, do_points);
 
 
     G_message(_("SECTION 3b: Adjusting drainage directions."));
@@ -0,0 +1,564 @@
+#include <limits.h>
+#include "Gwater.h"
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+/* Flow accumulation on several threads
+ *
+ * The sequential accumulation of do_cum.c visits the cells in the order
+ * of the A* search and pushes the flow of each cell to its downstream
+ * cells. Here, a cell pulls the flow of its upstream cells when all of
+ * them are done, in the order of the A* search. This gives exactly the
+ * results of the sequential accumulation while cells of different
+ * branches of the flow network are processed at the same time. The
+ * thread which finishes the last upstream cell of a downstream cell
+ * continues with that cell.
+ *
+ * Additional memory: 6 bytes per cell
+ */
+
+/* the bits of a flag can be set by several threads */
+#define FLAG_SET_MT(flags,row,col) \
+	__atomic_fetch_or(&(flags)->array[(row)][(col)>>3], \
+			  (unsigned char)(1<<((col) & 7)), __ATOMIC_RELAXED)
+
+#define FLAG_GET_MT(flags,row,col) \
+	(__atomic_load_n(&(flags)->array[(row)][(col)>>3], __ATOMIC_RELAXED) \
+	 & (1<<((col) & 7)))
+
+struct cum
+{
+    int *rank;			/* index in astar_pts, INT_MAX if not there */
+    unsigned char *down;	/* bit ct_dir: flow goes to this neighbour */
+    unsigned char *count;	/* number of upstream cells not yet done */
+    int *sources;		/* cells without upstream cells */
+    int nsources;
+    double *dist_to_nbr, *contour, cell_size;
+    int threshold;
+    int bad_prop;		/* MFD: sum of weights is not 1 */
+};
+
+/* MFD weights of a cell, see do_cum_mfd() */
+struct mfd_cell
+{
+    int edge, mfd_cells, np_side;
+    int flip;			/* bit ct_dir: sign of neighbour can change */
+    double sum_weight, weight[8];
+};
+
+static int asp_r[9] = { 0, -1, -1, -1, 0, 1, 1, 1, 0 };
+static int asp_c[9] = { 0, 1, 0, -1, -1, -1, 0, 1, 1 };
+
+/* downstream cell of the A* search, 0 if there is none in the region */
+static int get_down(int this_index, int r, int c, int *dr, int *dc)
+{
+    CELL aspect = asp[this_index];
+
+    if (!aspect)
+	return 0;
+
+    *dr = r + asp_r[ABS(aspect)];
+    *dc = c + asp_c[ABS(aspect)];
+
+    return *dr >= 0 && *dr < nrows && *dc >= 0 && *dc < ncols;
+}
+
+static DCELL get_value(int this_index)
+{
+    DCELL value = wat[this_index];
+
+    /* apply retention to adjust flow accumulation */
+    if (rtn_flag)
+	value *= rtn[this_index] / 100.0;
+
+    return value;
+}
+
+/* add flow, a negative sign marks a likely underestimate */
+static DCELL add_flow(DCELL valued, DCELL value)
+{
+    if (value > 0) {
+	if (valued > 0)
+	    valued += value;
+	else
+	    valued -= value;
+    }
+    else {
+	if (valued < 0)
+	    valued += value;
+	else
+	    valued = value - valued;
+    }
+
+    return valued;
+}
+
+/* SFD: direction of the first neighbour outside the region or null,
+ * -1 if there is none */
+static int sfd_edge(int r, int c, int dr, int dc, int *np_side)
+{
+    int r_nbr, c_nbr, ct_dir;
+    CELL ele_nbr;
+
+    *np_side = -1;
+    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+	r_nbr = r + nextdr[ct_dir];
+	c_nbr = c + nextdc[ct_dir];
+
+	if (dr == r_nbr && dc == c_nbr)
+	    *np_side = ct_dir;
+
+	if (r_nbr < 0 || r_nbr >= nrows || c_nbr < 0 || c_nbr >= ncols)
+	    return ct_dir;
+	ele_nbr = alt[SEG_INDEX(alt_seg, r_nbr, c_nbr)];
+	if (Rast_is_c_null_value(&ele_nbr))
+	    return ct_dir;
+    }
+
+    return -1;
+}
+
+/* SFD: the part of a cell which does not modify its downstream cell */
+static void sfd_cell(struct cum *p, int this_index, int r, int c)
+{
+    int dr, dc, edge, np_side, down_index;
+    CELL aspect;
+    DCELL value;
+
+    if (!get_down(this_index, r, c, &dr, &dc))
+	return;
+
+    value = get_value(this_index);
+    if (fabs(value) >= p->threshold)
+	FLAG_SET_MT(swale, r, c);
+
+    edge = sfd_edge(r, c, dr, dc, &np_side);
+    if (edge >= 0) {
+	aspect = asp[this_index];
+	if (FLAG_GET_MT(swale, r, c) && aspect > 0)
+	    asp[this_index] = -1 * drain[1 - nextdr[edge]][1 - nextdc[edge]];
+	return;
+    }
+
+    /* topographic wetness index ln(a / tan(beta)) and
+     * stream power index a * tan(beta) */
+    if (atanb_flag) {
+	down_index = SEG_INDEX(wat_seg, dr, dc);
+	sca[this_index] = fabs(value) *
+	    (p->cell_size / p->contour[np_side]);
+	tanb[this_index] = get_slope_tci(alt[this_index], alt[down_index],
+					 p->dist_to_nbr[np_side]);
+    }
+}
+
+/* SFD: flow of upstream cell ur, uc into r, c */
+static void sfd_pull(struct cum *p, int r, int c, int ur, int uc)
+{
+    int this_index = SEG_INDEX(wat_seg, r, c);
+    int up_index = SEG_INDEX(wat_seg, ur, uc);
+    int np_side;
+    DCELL value, valued;
+
+    value = get_value(up_index);
+    valued = wat[this_index];
+
+    /* do not distribute flow along edges, this causes artifacts */
+    if (sfd_edge(ur, uc, r, c, &np_side) >= 0) {
+	if (valued > 0)
+	    wat[this_index] = -valued;
+	return;
+    }
+
+    valued = add_flow(valued, value);
+    wat[this_index] = valued;
+
+    if (FLAG_GET_MT(swale, ur, uc) || fabs(valued) >= p->threshold)
+	FLAG_SET_MT(swale, r, c);
+    else if (er_flag)
+	slope_length(ur, uc, r, c);
+}
+
+/* MFD: the weights of the first loop of do_cum_mfd(), a neighbour is
+ * worked if it comes earlier in the A* search */
+static void mfd_weights(const struct cum *p, int this_index, int r, int c,
+			int dr, int dc, struct mfd_cell *m)
+{
+    int r_nbr, c_nbr, ct_dir, nbr_index, astar_not_set, is_null;
+    CELL ele, ele_nbr;
+    double max_weight;
+
+    max_weight = 0;
+    m->sum_weight = 0;
+    m->np_side = -1;
+    m->mfd_cells = 0;
+    m->flip = 0;
+    m->edge = 0;
+    astar_not_set = 1;
+    ele = alt[this_index];
+
+    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+	r_nbr = r + nextdr[ct_dir];
+	c_nbr = c + nextdc[ct_dir];
+	m->weight[ct_dir] = -1;
+
+	if (dr == r_nbr && dc == c_nbr)
+	    m->np_side = ct_dir;
+
+	if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 && c_nbr < ncols) {
+	    nbr_index = SEG_INDEX(wat_seg, r_nbr, c_nbr);
+	    ele_nbr = alt[nbr_index];
+
+	    if (p->rank[nbr_index] > p->rank[this_index]) {
+		is_null = Rast_is_c_null_value(&ele_nbr);
+		m->edge = is_null;
+		if (!is_null && ele_nbr <= ele) {
+		    if (ele_nbr < ele) {
+			m->weight[ct_dir] =
+			    mfd_pow(((ele - ele_nbr) / p->dist_to_nbr[ct_dir]),
+				    c_fac);
+		    }
+		    if (ele_nbr == ele) {
+			m->weight[ct_dir] =
+			    mfd_pow((0.5 / p->dist_to_nbr[ct_dir]), c_fac);
+		    }
+		    m->sum_weight += m->weight[ct_dir];
+		    m->mfd_cells++;
+
+		    if (m->weight[ct_dir] > max_weight)
+			max_weight = m->weight[ct_dir];
+
+		    if (dr == r_nbr && dc == c_nbr)
+			astar_not_set = 0;
+		    m->flip |= 1 << ct_dir;
+		}
+	    }
+	}
+	else
+	    m->edge = 1;
+	if (m->edge)
+	    break;
+    }
+    if (m->edge)
+	return;
+
+    /* MFD, A * path not included, add to mfd_cells */
+    if (m->mfd_cells > 0 && astar_not_set == 1) {
+	m->mfd_cells++;
+	m->sum_weight += max_weight;
+	m->weight[m->np_side] = max_weight;
+    }
+}
+
+/* MFD: the part of a cell which does not modify its downstream cells */
+static void mfd_cell(struct cum *p, int this_index, int r, int c)
+{
+    int dr, dc, r_nbr, c_nbr, ct_dir, nbr_index;
+    struct mfd_cell m;
+    DCELL value, tci_div, sum_contour;
+    double prop, weight;
+    CELL ele;
+
+    if (!get_down(this_index, r, c, &dr, &dc))
+	return;
+
+    mfd_weights(p, this_index, r, c, dr, dc, &m);
+    if (m.edge)
+	return;
+
+    value = get_value(this_index);
+    ele = alt[this_index];
+    tci_div = sum_contour = 0.;
+
+    if (m.mfd_cells > 1) {
+	prop = 0.0;
+	for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+	    r_nbr = r + nextdr[ct_dir];
+	    c_nbr = c + nextdc[ct_dir];
+
+	    if (m.weight[ct_dir] > -0.5) {
+		nbr_index = SEG_INDEX(wat_seg, r_nbr, c_nbr);
+		weight = m.weight[ct_dir] / m.sum_weight;
+		prop += weight;
+
+		if (atanb_flag) {
+		    sum_contour += p->contour[ct_dir];
+		    tci_div += get_slope_tci(ele, alt[nbr_index],
+					     p->dist_to_nbr[ct_dir]) * weight;
+		}
+	    }
+	}
+	if (ABS(prop - 1.0) > 5E-6f)
+	    __atomic_add_fetch(&p->bad_prop, 1, __ATOMIC_RELAXED);
+    }
+    else if (atanb_flag) {
+	sum_contour = p->contour[m.np_side];
+	tci_div = get_slope_tci(ele, alt[SEG_INDEX(wat_seg, dr, dc)],
+				p->dist_to_nbr[m.np_side]);
+    }
+
+    /* topographic wetness index ln(a / tan(beta)) and
+     * stream power index a * tan(beta) */
+    if (atanb_flag) {
+	sca[this_index] = fabs(value) * (p->cell_size / sum_contour);
+	tanb[this_index] = tci_div;
+    }
+}
+
+/* MFD: downstream cells of a cell as bits of ct_dir */
+static int mfd_down(const struct cum *p, int this_index, int r, int c)
+{
+    int dr, dc, ct_dir, mask;
+    struct mfd_cell m;
+
+    if (!get_down(this_index, r, c, &dr, &dc))
+	return 0;
+
+    mfd_weights(p, this_index, r, c, dr, dc, &m);
+    mask = m.flip;
+    if (!m.edge) {
+	if (m.mfd_cells > 1) {
+	    for (ct_dir = 0; ct_dir < sides; ct_dir++)
+		if (m.weight[ct_dir] > -0.5)
+		    mask |= 1 << ct_dir;
+	}
+	else
+	    mask |= 1 << m.np_side;
+    }
+
+    return mask;
+}
+
+/* MFD: flow of upstream cell ur, uc in direction ct_dir into r, c */
+static void mfd_pull(struct cum *p, int r, int c, int ur, int uc,
+		     int ct_dir)
+{
+    int this_index = SEG_INDEX(wat_seg, r, c);
+    int up_index = SEG_INDEX(wat_seg, ur, uc);
+    int dr, dc;
+    struct mfd_cell m;
+    DCELL value, valued;
+
+    get_down(up_index, ur, uc, &dr, &dc);
+    mfd_weights(p, up_index, ur, uc, dr, dc, &m);
+
+    value = get_value(up_index);
+    valued = wat[this_index];
+
+    if ((m.flip & (1 << ct_dir)) && value < 0 && valued > 0) {
+	valued = -valued;
+	wat[this_index] = valued;
+    }
+    if (m.edge)
+	return;
+
+    if (m.mfd_cells > 1) {
+	if (m.weight[ct_dir] > -0.5)
+	    wat[this_index] =
+		add_flow(valued, value * (m.weight[ct_dir] / m.sum_weight));
+    }
+    else if (ct_dir == m.np_side)
+	wat[this_index] = add_flow(valued, value);
+}
+
+/* pull the flow of all upstream cells, then do the cell itself */
+static void do_cell(struct cum *p, int this_index, int r, int c)
+{
+    int ct_dir, i, j, n, ur, uc, up_index;
+    int up[8], up_dir[8];
+
+    /* upstream cells in the order of the A* search */
+    n = 0;
+    for (ct_dir = 0; ct_dir < 8; ct_dir++) {
+	ur = r + nextdr[ct_dir];
+	uc = c + nextdc[ct_dir];
+	if (ur < 0 || ur >= nrows || uc < 0 || uc >= ncols)
+	    continue;
+	up_index = SEG_INDEX(wat_seg, ur, uc);
+	/* opposite directions are pairs in nextdr, nextdc */
+	if (!(p->down[up_index] & (1 << (ct_dir ^ 1))))
+	    continue;
+
+	for (i = n; i > 0 && p->rank[up[i - 1]] > p->rank[up_index]; i--) {
+	    up[i] = up[i - 1];
+	    up_dir[i] = up_dir[i - 1];
+	}
+	up[i] = up_index;
+	up_dir[i] = ct_dir;
+	n++;
+    }
+
+    for (j = 0; j < n; j++) {
+	ur = r + nextdr[up_dir[j]];
+	uc = c + nextdc[up_dir[j]];
+	if (mfd)
+	    mfd_pull(p, r, c, ur, uc, up_dir[j] ^ 1);
+	else
+	    sfd_pull(p, r, c, ur, uc);
+    }
+
+    if (mfd)
+	mfd_cell(p, this_index, r, c);
+    else
+	sfd_cell(p, this_index, r, c);
+}
+
+/* downstream cells of rows first to last - 1 */
+static void set_down(int first, int last, void *closure)
+{
+    struct cum *p = closure;
+    int r, c, dr, dc, ct_dir, this_index, mask;
+
+    for (r = first; r < last; r++) {
+	for (c = 0; c < ncols; c++) {
+	    this_index = SEG_INDEX(wat_seg, r, c);
+	    mask = 0;
+	    if (p->rank[this_index] == INT_MAX)
+		;
+	    else if (mfd)
+		mask = mfd_down(p, this_index, r, c);
+	    else if (get_down(this_index, r, c, &dr, &dc)) {
+		for (ct_dir = 0; ct_dir < 8; ct_dir++) {
+		    if (dr == r + nextdr[ct_dir] && dc == c + nextdc[ct_dir])
+			mask = 1 << ct_dir;
+		}
+	    }
+	    /* null cells get no flow */
+	    for (ct_dir = 0; ct_dir < 8; ct_dir++) {
+		if (mask & (1 << ct_dir)) {
+		    int nbr_index = SEG_INDEX(wat_seg, r + nextdr[ct_dir],
+					      c + nextdc[ct_dir]);
+
+		    if (p->rank[nbr_index] == INT_MAX)
+			mask &= ~(1 << ct_dir);
+		}
+	    }
+	    p->down[this_index] = mask;
+	}
+    }
+}
+
+/* number of upstream cells of rows first to last - 1 */
+static void set_count(int first, int last, void *closure)
+{
+    struct cum *p = closure;
+    int r, c, ur, uc, ct_dir, this_index, n;
+
+    for (r = first; r < last; r++) {
+	for (c = 0; c < ncols; c++) {
+	    n = 0;
+	    for (ct_dir = 0; ct_dir < 8; ct_dir++) {
+		ur = r + nextdr[ct_dir];
+		uc = c + nextdc[ct_dir];
+		if (ur >= 0 && ur < nrows && uc >= 0 && uc < ncols &&
+		    (p->down[SEG_INDEX(wat_seg, ur, uc)] &
+		     (1 << (ct_dir ^ 1))))
+		    n++;
+	    }
+	    this_index = SEG_INDEX(wat_seg, r, c);
+	    p->count[this_index] = n;
+	}
+    }
+}
+
+/* runs on a worker thread: start at sources first to last - 1 and
+ * follow the flow as long as all upstream cells are done */
+static void accumulate(int first, int last, void *closure)
+{
+    struct cum *p = closure;
+    int *stack, nstack, stack_alloced;
+    int i, r, c, ct_dir, this_index, nbr_index;
+
+    stack_alloced = 64;
+    stack = G_malloc(stack_alloced * sizeof(int));
+
+    for (i = first; i < last; i++) {
+	stack[0] = p->sources[i];
+	nstack = 1;
+	while (nstack > 0) {
+	    this_index = stack[--nstack];
+	    seg_index_rc(wat_seg, this_index, &r, &c);
+	    do_cell(p, this_index, r, c);
+
+	    for (ct_dir = 0; ct_dir < 8; ct_dir++) {
+		if (!(p->down[this_index] & (1 << ct_dir)))
+		    continue;
+		nbr_index = SEG_INDEX(wat_seg, r + nextdr[ct_dir],
+				      c + nextdc[ct_dir]);
+		/* the last upstream cell continues with the downstream cell */
+		if (__atomic_sub_fetch(&p->count[nbr_index], 1,
+				       __ATOMIC_ACQ_REL) == 0) {
+		    if (nstack == stack_alloced) {
+			stack_alloced *= 2;
+			stack = G_realloc(stack, stack_alloced * sizeof(int));
+		    }
+		    stack[nstack++] = nbr_index;
+		}
+	    }
+	}
+    }
+
+    G_free(stack);
+}
+
+/*
+ * Accumulate flow on the worker threads: SFD like do_cum(), MFD like
+ * the first part (SECTION 3a) of do_cum_mfd()
+ */
+int do_cum_par(double *dist_to_nbr, double *contour, double cell_size,
+	       int threshold)
+{
+    struct cum p;
+    int size, killer, this_index, r, c;
+
+    G_verbose_message(_("Accumulating flow with %d threads"),
+		      G_num_workers() + 1);
+
+    size = size_array(&wat_seg, nrows, ncols);
+    p.rank = (int *)G_malloc(size * sizeof(int));
+    p.down = (unsigned char *)G_malloc(size);
+    p.count = (unsigned char *)G_malloc(size);
+    p.dist_to_nbr = dist_to_nbr;
+    p.contour = contour;
+    p.cell_size = cell_size;
+    p.threshold = threshold;
+    p.bad_prop = 0;
+
+    for (this_index = 0; this_index < size; this_index++)
+	p.rank[this_index] = INT_MAX;
+    for (killer = 1; killer <= do_points; killer++)
+	p.rank[astar_pts[killer]] = killer;
+
+    G_parallel_for(0, nrows, 0, set_down, &p);
+    G_parallel_for(0, nrows, 0, set_count, &p);
+
+    p.sources = (int *)G_malloc(do_points * sizeof(int));
+    p.nsources = 0;
+    for (killer = 1; killer <= do_points; killer++) {
+	this_index = astar_pts[killer];
+	if (p.count[this_index] == 0)
+	    p.sources[p.nsources++] = this_index;
+    }
+
+    G_parallel_for(0, p.nsources, 0, accumulate, &p);
+
+    if (p.bad_prop)
+	G_warning(n_("MFD: cumulative proportion of flow distribution not 1.0 for %d cell",
+		     "MFD: cumulative proportion of flow distribution not 1.0 for %d cells",
+		     p.bad_prop), p.bad_prop);
+
+    /* as left by the sequential accumulation */
+    if (mfd) {
+	for (killer = 1; killer <= do_points; killer++) {
+	    seg_index_rc(alt_seg, astar_pts[killer], &r, &c);
+	    FLAG_SET(worked, r, c);
+	}
+    }
+
+    G_free(p.sources);
+    G_free(p.count);
+    G_free(p.down);
+    G_free(p.rank);
+
+    return 0;
+}
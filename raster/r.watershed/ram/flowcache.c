@@ -0,0 +1,107 @@
+#include <string.h>
+#include "Gwater.h"
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+/* drainage directions and flow accumulation of earlier runs, see
+ * lib/raster/flowcache.c */
+
+/* everything which changes accumulation and drainage directions,
+ * 0 if the inputs are not cacheable */
+static int flow_method(char *method, char *name, char *mapset)
+{
+    const char *ele_mapset;
+
+    if (pit_flag || run_flag || rtn_flag || ob_flag)
+	return 0;
+
+    ele_mapset = G_find_raster2(ele_name, "");
+    if (!ele_mapset)
+	return 0;
+    if (G_name_is_fully_qualified(ele_name, name, mapset) != 1) {
+	strcpy(name, ele_name);
+	strcpy(mapset, ele_mapset);
+    }
+
+    sprintf(method, "r.watershed mfd=%d convergence=%d sides=%d flat=%d "
+	    "threshold=%d", mfd, mfd ? c_fac : 0, sides, flat_flag,
+	    bas_thres <= 0 ? 60 : bas_thres);
+
+    return 1;
+}
+
+/* read accumulation and drainage directions instead of calculating
+ * them, 0 if there is no matching cache entry */
+int read_flowcache(void)
+{
+    struct R_flowcache *fc;
+    char method[GNAME_MAX * 2];
+    char name[GNAME_MAX], mapset[GMAPSET_MAX];
+    signed char *dir_buf;
+    DCELL *acc_buf;
+    int r, c, this_index;
+
+    /* only accumulation and drainage are cached */
+    if (bas_thres > 0 || tci_flag || spi_flag || ls_flag || sg_flag)
+	return 0;
+
+    if (!flow_method(method, name, mapset))
+	return 0;
+    if (!(fc = Rast_flowcache_open_old(name, mapset, method)))
+	return 0;
+
+    G_message(_("SECTION 2-3 (of %1d): Reading cached accumulation and drainage directions."),
+	      tot_parts);
+
+    dir_buf = G_malloc(ncols * sizeof(signed char));
+    acc_buf = G_malloc(ncols * sizeof(DCELL));
+    for (r = 0; r < nrows; r++) {
+	G_percent(r, nrows, 2);
+	Rast_flowcache_get_row(fc, dir_buf, acc_buf, r);
+	for (c = 0; c < ncols; c++) {
+	    this_index = SEG_INDEX(wat_seg, r, c);
+	    wat[this_index] = acc_buf[c];
+	    asp[SEG_INDEX(asp_seg, r, c)] = dir_buf[c];
+	}
+    }
+    G_percent(1, 1, 1);
+    Rast_flowcache_close(fc);
+
+    G_free(dir_buf);
+    G_free(acc_buf);
+
+    return 1;
+}
+
+/* store accumulation and drainage directions for later runs */
+int write_flowcache(void)
+{
+    struct R_flowcache *fc;
+    char method[GNAME_MAX * 2];
+    char name[GNAME_MAX], mapset[GMAPSET_MAX];
+    signed char *dir_buf;
+    DCELL *acc_buf;
+    int r, c;
+
+    if (!flow_method(method, name, mapset))
+	return 0;
+    if (!(fc = Rast_flowcache_open_new(name, mapset, method)))
+	return 0;
+
+    dir_buf = G_malloc(ncols * sizeof(signed char));
+    acc_buf = G_malloc(ncols * sizeof(DCELL));
+    for (r = 0; r < nrows; r++) {
+	for (c = 0; c < ncols; c++) {
+	    acc_buf[c] = wat[SEG_INDEX(wat_seg, r, c)];
+	    dir_buf[c] = asp[SEG_INDEX(asp_seg, r, c)];
+	}
+	Rast_flowcache_put_row(fc, dir_buf, acc_buf);
+    }
+    Rast_flowcache_close(fc);
+
+    G_free(dir_buf);
+    G_free(acc_buf);
+
+    return 1;
+}
@@ -17,6 +17,7 @@ int init_vars(int argc, char *argv[])
     size_t ele_size;
     char MASK_flag;
     int seg_idx;
+    struct Option nprocs_opt;
 
     G_gisinit(argv[0]);
     /* input */
@@ -43,6 +44,8 @@ int init_vars(int argc, char *argv[])
     abs_acc = 0;
     flat_flag = 0;
     ele_scale = 1;
+    G_zero(&nprocs_opt, sizeof(nprocs_opt));
+    nprocs_opt.key = "nprocs";
 
     for (r = 1; r < argc; r++) {
 	if (sscanf(argv[r], "elevation=%s", ele_name) == 1)
@@ -93,6 +96,8 @@ int init_vars(int argc, char *argv[])
 		usage(argv[0]);
 	}
 	else if (sscanf(argv[r], "convergence=%d", &c_fac) == 1) ;
+	else if (strncmp(argv[r], "nprocs=", 7) == 0)
+	    nprocs_opt.answer = argv[r] + 7;
 	else if (strcmp(argv[r], "-s") == 0)
 	    mfd = 0;
 	else if (strcmp(argv[r], "-a") == 0)
@@ -105,6 +110,7 @@ int init_vars(int argc, char *argv[])
     if (mfd == 1 && (c_fac < 1 || c_fac > 10)) {
 	G_fatal_error("Convergence factor must be between 1 and 10.");
     }
+    nprocs = G_set_nprocs(&nprocs_opt);
     if ((ele_flag != 1)
 	||
 	((arm_flag == 1) &&
@@ -163,8 +169,7 @@ int init_vars(int argc, char *argv[])
 	atanb_flag = 1;
     }
 
-    asp =
-	(CELL *) G_malloc(size_array(&asp_seg, nrows, ncols) * sizeof(CELL));
+    asp = (signed char *)G_malloc(size_array(&asp_seg, nrows, ncols));
 
     if (er_flag) {
 	r_h =
@@ -30,6 +30,7 @@ int first_astar, first_cum, nxt_avail_pt, total_cells, do_points;
 int nrows, ncols;
 double half_res, diag, max_length, dep_slope;
 int bas_thres, tot_parts;
+int nprocs;
 CELL n_basins;
 OC_STACK *ocs;
 int ocs_alloced;
@@ -38,7 +39,8 @@ RAMSEG dis_seg, alt_seg, wat_seg, asp_seg, bas_seg, haf_seg;
 RAMSEG r_h_seg, dep_seg, rtn_seg;
 RAMSEG slp_seg, s_l_seg, s_g_seg, l_s_seg;
 int *astar_pts;
-CELL *dis, *alt, *asp, *bas, *haf, *r_h, *dep;
+CELL *dis, *alt, *bas, *haf, *r_h, *dep;
+signed char *asp;
 char *rtn;
 DCELL *wat, *sca, *tanb;
 int ril_fd;
@@ -71,12 +73,15 @@ FILE *fp;
 int main(int argc, char *argv[])
 {
     init_vars(argc, argv);
-    do_astar();
-    if (mfd) {
-	do_cum_mfd();
-    }
-    else {
-	do_cum();
+    if (!read_flowcache()) {
+	do_astar();
+	if (mfd) {
+	    do_cum_mfd();
+	}
+	else {
+	    do_cum();
+	}
+	write_flowcache();
     }
     if (sg_flag || ls_flag) {
 	sg_factor();
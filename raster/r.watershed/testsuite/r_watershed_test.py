@@ -28,6 +28,7 @@ class TestWatershed(TestCase):
     elevation = 'elevation'
     lengthslope_2 = 'test_lengthslope_2'
     stream_2 = 'test_stream_2'
+    accumulation_2 = 'test_accumulation_2'
 
     @classmethod
     def setUpClass(cls):
@@ -51,7 +52,7 @@ class TestWatershed(TestCase):
                              self.basin, self.stream,
                              self.halfbasin, self.slopelength,
                              self.slopesteepness, self.lengthslope_2,
-                             self.stream_2])
+                             self.stream_2, self.accumulation_2])
 
     def test_OutputCreated(self):
         """Test to see if the outputs are created"""
@@ -150,5 +151,23 @@ class TestWatershed(TestCase):
         self.assertRasterMinMax(self.basin, 0, 1000000,
                                 msg='A basin value is less than 0 or greater than 1000000')
 
+    def test_nprocs(self):
+        """Check that flow accumulation with threads gives the same results"""
+        for flags in ('', 's'):
+            self.assertModule('r.watershed', elevation=self.elevation,
+                              threshold='10000', flags=flags,
+                              accumulation=self.accumulation,
+                              stream=self.stream, overwrite=True)
+            self.assertModule('r.watershed', elevation=self.elevation,
+                              threshold='10000', flags=flags, nprocs=4,
+                              accumulation=self.accumulation_2,
+                              stream=self.stream_2, overwrite=True)
+            self.assertRastersNoDifference(actual=self.accumulation_2,
+                                           reference=self.accumulation,
+                                           precision=0)
+            self.assertRastersNoDifference(actual=self.stream_2,
+                                           reference=self.stream,
+                                           precision=0)
+
 if __name__ == '__main__':
     test()
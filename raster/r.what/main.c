@@ -36,9 +36,6 @@ struct order
     char north_buf[256];
     char east_buf[256];
     char lab_buf[256];
-    char clr_buf[NFILES][256];
-    CELL value[NFILES];
-    DCELL dvalue[NFILES];
 };
 
 static int oops(int, const char *, const char *);
@@ -83,12 +80,14 @@ int main(int argc, char *argv[])
     int done = FALSE;
     int point, point_cnt;
     struct order *cache;
+    CELL *value;		/* values of the maps by point */
+    DCELL *dvalue;
     int cur_row;
     int cache_hit = 0, cache_miss = 0;
     int cache_hit_tot = 0, cache_miss_tot = 0;
     int pass = 0;
     int cache_report = FALSE;
-    char tmp_buf[500], *null_str;
+    char tmp_buf[500], clr_buf[256], *null_str;
     int red, green, blue;
     struct GModule *module;
 
@@ -135,7 +134,7 @@ int main(int argc, char *argv[])
     opt.cache->required = NO;
     opt.cache->multiple = NO;
     opt.cache->description = _("Size of point cache");
-    opt.cache->answer = "500";
+    opt.cache->answer = "10000";
     opt.cache->guisection = _("Advanced");
 
     flg.header = G_define_flag();
@@ -192,8 +191,6 @@ int main(int argc, char *argv[])
     if (Cache_size < 1)
 	Cache_size = 1;
 
-    cache = (struct order *)G_malloc(sizeof(struct order) * Cache_size);
-
     /* check if flag v is used with a vector points map */
     if (flg.cat->answer && !opt.points->answers){
         G_fatal_error(_("Flag 'v' required option 'points'"));
@@ -217,6 +214,8 @@ int main(int argc, char *argv[])
 
 	strcpy(name, *ptr);
 	fd[nfiles] = Rast_open_old(name, "");
+	/* points are queried in random row order */
+	Rast_set_mmap(fd[nfiles], 1);
 
 	out_type[nfiles] = Rast_get_map_type(fd[nfiles]);
 	if (flg.cat_int->answer)
@@ -238,11 +237,16 @@ int main(int argc, char *argv[])
 	if (flg.cat_int->answer)
 	    out_type[i] = CELL_TYPE;
 
-	cell[i] = Rast_allocate_c_buf();
-	if (out_type[i] != CELL_TYPE)
+	if (out_type[i] == CELL_TYPE)
+	    cell[i] = Rast_allocate_c_buf();
+	else
 	    dcell[i] = Rast_allocate_d_buf();
     }
 
+    cache = (struct order *)G_malloc(sizeof(struct order) * Cache_size);
+    value = G_malloc(sizeof(CELL) * Cache_size * nfiles);
+    dvalue = G_malloc(sizeof(DCELL) * Cache_size * nfiles);
+
     /* open vector points map */
     if (opt.points->answer) {
         Vect_set_open_level(1); /* topology not required */
@@ -414,9 +418,9 @@ int main(int argc, char *argv[])
 		cache_miss++;
 		if (row_in_window)
 		    for (i = 0; i < nfiles; i++) {
-			Rast_get_c_row(fd[i], cell[i], cache[point].row);
-
-			if (out_type[i] != CELL_TYPE)
+			if (out_type[i] == CELL_TYPE)
+			    Rast_get_c_row(fd[i], cell[i], cache[point].row);
+			else
 			    Rast_get_d_row(fd[i], dcell[i], cache[point].row);
 		    }
 
@@ -426,29 +430,20 @@ int main(int argc, char *argv[])
 		cache_hit++;
 
 	    for (i = 0; i < nfiles; i++) {
-		if (in_window)
-		    cache[point].value[i] = cell[i][cache[point].col];
-		else
-		    Rast_set_c_null_value(&(cache[point].value[i]), 1);
+		size_t k = (size_t)cache[point].point * nfiles + i;
 
-		if (out_type[i] != CELL_TYPE) {
+		if (out_type[i] == CELL_TYPE) {
 		    if (in_window)
-			cache[point].dvalue[i] = dcell[i][cache[point].col];
+			value[k] = cell[i][cache[point].col];
 		    else
-			Rast_set_d_null_value(&(cache[point].dvalue[i]), 1);
+			Rast_set_c_null_value(&value[k], 1);
 		}
-		if (flg.color->answer) {
-		    if (out_type[i] == CELL_TYPE)
-			Rast_get_c_color(&(cache[point].value[i]),
-					     &red, &green, &blue, &ncolor[i]);
+		else {
+		    if (in_window)
+			dvalue[k] = dcell[i][cache[point].col];
 		    else
-			Rast_get_d_color(&(cache[point].dvalue[i]),
-					     &red, &green, &blue, &ncolor[i]);
-
-		    sprintf(cache[point].clr_buf[i], "%03d:%03d:%03d", red,
-			    green, blue);
+			Rast_set_d_null_value(&dvalue[k], 1);
 		}
-
 	    }
 	}			/* point loop */
 
@@ -470,8 +465,10 @@ int main(int argc, char *argv[])
 		    cache[point].north_buf, fs, cache[point].lab_buf);
 
 	    for (i = 0; i < nfiles; i++) {
+		size_t k = (size_t)point * nfiles + i;
+
 		if (out_type[i] == CELL_TYPE) {
-		    if (Rast_is_c_null_value(&cache[point].value[i])) {
+		    if (Rast_is_c_null_value(&value[k])) {
 			fprintf(stdout, "%s%s", fs, null_str);
 			if (flg.label->answer)
 			    fprintf(stdout, "%s", fs);
@@ -479,12 +476,15 @@ int main(int argc, char *argv[])
 			    fprintf(stdout, "%s", fs);
 			continue;
 		    }
-		    fprintf(stdout, "%s%ld", fs, (long)cache[point].value[i]);
-		    cache[point].dvalue[i] = cache[point].value[i];
+		    fprintf(stdout, "%s%ld", fs, (long)value[k]);
+		    dvalue[k] = value[k];
+		    if (flg.color->answer)
+			Rast_get_c_color(&value[k], &red, &green, &blue,
+					 &ncolor[i]);
 		}
 		else {		/* FCELL or DCELL */
 
-		    if (Rast_is_d_null_value(&cache[point].dvalue[i])) {
+		    if (Rast_is_d_null_value(&dvalue[k])) {
 			fprintf(stdout, "%s%s", fs, null_str);
 			if (flg.label->answer)
 			    fprintf(stdout, "%s", fs);
@@ -493,17 +493,22 @@ int main(int argc, char *argv[])
 			continue;
 		    }
 		    if (out_type[i] == FCELL_TYPE)
-			sprintf(tmp_buf, "%.7g", cache[point].dvalue[i]);
+			sprintf(tmp_buf, "%.7g", dvalue[k]);
 		    else /* DCELL */
-			sprintf(tmp_buf, "%.15g", cache[point].dvalue[i]);
+			sprintf(tmp_buf, "%.15g", dvalue[k]);
 		    G_trim_decimal(tmp_buf); /* not needed with %g? */
 		    fprintf(stdout, "%s%s", fs, tmp_buf);
+		    if (flg.color->answer)
+			Rast_get_d_color(&dvalue[k], &red, &green, &blue,
+					 &ncolor[i]);
 		}
 		if (flg.label->answer)
 		    fprintf(stdout, "%s%s", fs,
-			    Rast_get_d_cat(&(cache[point].dvalue[i]), &cats[i]));
-		if (flg.color->answer)
-		    fprintf(stdout, "%s%s", fs, cache[point].clr_buf[i]);
+			    Rast_get_d_cat(&dvalue[k], &cats[i]));
+		if (flg.color->answer) {
+		    sprintf(clr_buf, "%03d:%03d:%03d", red, green, blue);
+		    fprintf(stdout, "%s%s", fs, clr_buf);
+		}
 	    }
 	    fprintf(stdout, "\n");
 	}
@@ -554,7 +559,7 @@ static int oops(int line, const char *buf, const char *msg)
 
 
 /* *************************************************************** */
-/* for qsort,  order list by row ********************************* */
+/* for qsort,  order list by row and column ********************** */
 /* *************************************************************** */
 
 
@@ -562,9 +567,11 @@ static int by_row(const void *ii, const void *jj)
 {
     const struct order *i = ii, *j = jj;
 
-    if (i->row < j->row)
-	return -1;
-    return (i->row > j->row);
+    if (i->row != j->row)
+	return i->row < j->row ? -1 : 1;
+    if (i->col != j->col)
+	return i->col < j->col ? -1 : 1;
+    return 0;
 }
 
 
@@ -0,0 +1,120 @@
+/*!
+   \file field.c
+
+   \brief 3D raster maps held in memory
+
+   The maps needed for the integration are read once, so that flowlines
+   can be traced concurrently without going through the tile cache of
+   the maps, which is not thread-safe.
+
+   (C) 2014 by the GRASS Development Team
+
+   This program is free software under the GNU General Public
+   License (>=v2).  Read the file COPYING that comes with GRASS
+   for details.
+ */
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/raster3d.h>
+
+#include "r3flow_structs.h"
+#include "field.h"
+
+/*!
+   \brief Reads a 3D raster map into memory
+
+   The values are kept in the type of the map tiles (FCELL or DCELL).
+
+   \param[out] field field to fill
+   \param map 3D raster map open for reading
+   \param region current 3D region
+ */
+void field_load(struct Field *field, RASTER3D_Map * map,
+		RASTER3D_Region * region)
+{
+    int tile_x, tile_y, tile_z, z, nz;
+    size_t plane, length;
+
+    field->type = Rast3d_tile_type_map(map);
+    field->cols = region->cols;
+    field->rows = region->rows;
+    field->depths = region->depths;
+
+    plane = (size_t)field->cols * field->rows;
+    length = Rast3d_length(field->type);
+    field->data = G_malloc(plane * field->depths * length);
+
+    /* one layer of tiles at a time */
+    Rast3d_get_tile_dimensions_map(map, &tile_x, &tile_y, &tile_z);
+    for (z = 0; z < field->depths; z += tile_z) {
+	nz = field->depths - z < tile_z ? field->depths - z : tile_z;
+	Rast3d_get_block(map, 0, 0, z, field->cols, field->rows, nz,
+			 (char *)field->data + z * plane * length,
+			 field->type);
+    }
+}
+
+/*!
+   \brief Frees the values of a field
+
+   \param field field
+ */
+void field_free(struct Field *field)
+{
+    G_free(field->data);
+    field->data = NULL;
+}
+
+/*!
+   \brief Returns the value of a voxel
+
+   \param field field
+   \param x,y,z column, row and depth of the voxel
+
+   \return value, null if the voxel is null or outside of the region
+ */
+DCELL field_get_value(const struct Field *field, int x, int y, int z)
+{
+    size_t i;
+    DCELL value;
+
+    if (x < 0 || x >= field->cols || y < 0 || y >= field->rows ||
+	z < 0 || z >= field->depths) {
+	Rast_set_d_null_value(&value, 1);
+	return value;
+    }
+
+    i = ((size_t)z * field->rows + y) * field->cols + x;
+    if (field->type == FCELL_TYPE) {
+	const FCELL *cell = (const FCELL *)field->data + i;
+
+	if (Rast_is_f_null_value(cell))
+	    Rast_set_d_null_value(&value, 1);
+	else
+	    value = *cell;
+    }
+    else
+	value = ((const DCELL *)field->data)[i];
+
+    return value;
+}
+
+/*!
+   \brief Copies a block of voxels like Rast3d_get_block() does
+
+   \param field field
+   \param x0,y0,z0 first voxel of the block
+   \param nx,ny,nz size of the block
+   \param[out] block values, null outside of the region
+ */
+void field_get_block(const struct Field *field, int x0, int y0, int z0,
+		     int nx, int ny, int nz, DCELL * block)
+{
+    int x, y, z;
+
+    for (z = 0; z < nz; z++)
+	for (y = 0; y < ny; y++)
+	    for (x = 0; x < nx; x++)
+		*block++ = field_get_value(field, x0 + x, y0 + y, z0 + z);
+}
@@ -0,0 +1,15 @@
+#ifndef FIELD_H
+#define FIELD_H
+
+#include <grass/raster3d.h>
+
+#include "r3flow_structs.h"
+
+void field_load(struct Field *field, RASTER3D_Map * map,
+		RASTER3D_Region * region);
+void field_free(struct Field *field);
+DCELL field_get_value(const struct Field *field, int x, int y, int z);
+void field_get_block(const struct Field *field, int x0, int y0, int z0,
+		     int nx, int ny, int nz, DCELL * block);
+
+#endif // FIELD_H
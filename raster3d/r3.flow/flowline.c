@@ -20,19 +20,56 @@
 #include "integrate.h"
 #include "flowline.h"
 #include "voxel_traversal.h"
+#include "field.h"
 
-static void write_segment(struct Map_info *flowline_vec,
-			  struct line_pnts *points, struct line_cats *cats,
-			  const double *point, int *cat)
+/*!
+   \brief Initializes a flowline
+
+   \param flowline flowline
+ */
+void flowline_init(struct Flowline *flowline)
 {
-    Vect_append_point(points, point[0], point[1], point[2]);
+    flowline->points = Vect_new_line_struct();
+    flowline->n_segments = 0;
+    flowline->n_alloc = 0;
+    flowline->velocity = NULL;
+    flowline->scalar = NULL;
+    flowline->sampled = NULL;
+}
 
-    Vect_cat_set(cats, 1, *cat);
-    (*cat)++;
-    Vect_write_line(flowline_vec, GV_LINE, points, cats);
-    Vect_reset_line(points);
-    Vect_reset_cats(cats);
-    Vect_append_point(points, point[0], point[1], point[2]);
+/*!
+   \brief Frees a flowline
+
+   \param flowline flowline
+ */
+void flowline_free(struct Flowline *flowline)
+{
+    Vect_destroy_line_struct(flowline->points);
+    G_free(flowline->velocity);
+    G_free(flowline->scalar);
+    G_free(flowline->sampled);
+}
+
+static void add_segment(struct Flowline *flowline, const double *point,
+			double velocity, double scalar_value,
+			double sampled_map_value)
+{
+    int n = flowline->n_segments;
+
+    if (n >= flowline->n_alloc) {
+	flowline->n_alloc = flowline->n_alloc ? 2 * flowline->n_alloc : 64;
+	flowline->velocity = G_realloc(flowline->velocity,
+				       flowline->n_alloc * sizeof(double));
+	flowline->scalar = G_realloc(flowline->scalar,
+				     flowline->n_alloc * sizeof(double));
+	flowline->sampled = G_realloc(flowline->sampled,
+				      flowline->n_alloc * sizeof(double));
+    }
+    Vect_append_point(flowline->points, point[0], point[1], point[2]);
+    flowline->velocity[n] = velocity;
+    flowline->scalar[n] = scalar_value;
+    flowline->sampled[n] = sampled_map_value;
+    flowline->n_segments++;
 }
 
 static void write_segment_db(struct field_info *finfo, dbDriver * driver,
@@ -62,39 +99,49 @@ static void write_segment_db(struct field_info *finfo, dbDriver * driver,
     }
 }
 
-static double get_map_value(RASTER3D_Region * region, RASTER3D_Map *map,
-			    double north, double east, double top)
+static double get_map_value(RASTER3D_Region * region,
+			    const struct Field *field, double north,
+			    double east, double top)
 {
     int col, row, depth;
-    double val;
 
     Rast3d_location2coord(region, north, east, top, &col, &row, &depth);
-    Rast3d_get_value(map, col, row, depth, &val,
-		     DCELL_TYPE);
 
-    return val;
+    return field_get_value(field, col, row, depth);
+}
+
+static void add_flowacc(RASTER3D_Region * region, int *flowacc, int col,
+			int row, int depth)
+{
+    if (col < 0 || col >= region->cols || row < 0 || row >= region->rows ||
+	depth < 0 || depth >= region->depths)
+	return;
+
+    /* flowlines are traced concurrently */
+    __atomic_add_fetch(&flowacc[((size_t)depth * region->rows + row) *
+				region->cols + col], 1, __ATOMIC_RELAXED);
 }
 
 /*!
    \brief Computes flowline by integrating velocity field.
 
+   Only reads the shared data, several flowlines can be computed
+   concurrently.
+
    \param region pointer to current 3D region
    \param seed starting seed (point)
-   \param velocity_field pointer to array of 3 3D raster maps
+   \param gradient_info velocity field or scalar map
+   \param flowacc flow accumulation counts or NULL
+   \param sampled_field map sampled by the flowline or NULL
    \param integration pointer to integration struct
-   \param flowline_vec pointer to Map_info struct of flowline vector
-   \param cats pointer to line_cats struct of flowline vector
-   \param points pointer to line_pnts struct of flowline vector
-   \param[in,out] cat starting category of the newly created flow line
+   \param[out] flowline vertices and attributes of the flowline
    \param if_table TRUE if attribute table should be created and filled
  */
 void compute_flowline(RASTER3D_Region * region, const struct Seed *seed,
-		      struct Gradient_info *gradient_info,
-		      RASTER3D_Map * flowacc, RASTER3D_Map * sampled_map,
-		      struct Integration *integration,
-		      struct Map_info *flowline_vec, struct line_cats *cats,
-		      struct line_pnts *points, int *cat, int if_table,
-		      struct field_info *finfo, dbDriver * driver)
+		      const struct Gradient_info *gradient_info,
+		      int *flowacc, const struct Field *sampled_field,
+		      const struct Integration *integration,
+		      struct Flowline *flowline, int if_table)
 {
     int i, j, count;
     double delta_t;
@@ -107,11 +154,17 @@ void compute_flowline(RASTER3D_Region * region, const struct Seed *seed,
     int coor_diff;
     DCELL scalar_value;
     DCELL sampled_map_value;
-    FCELL value;
     int *trav_coords;
     int size, trav_count;
-    dbString sql;
     double velocity;
+    struct Gradient_info gradient;
+
+    /* private copy for the cached gradient */
+    gradient = *gradient_info;
+    gradient.initialized = FALSE;
+
+    Vect_reset_line(flowline->points);
+    flowline->n_segments = 0;
 
     point[0] = seed->x;
     point[1] = seed->y;
@@ -120,17 +173,16 @@ void compute_flowline(RASTER3D_Region * region, const struct Seed *seed,
     last_col = last_row = last_depth = -1;
 
     size = 5;
-    value = 0;
+    scalar_value = sampled_map_value = 0;
     trav_coords = G_malloc(3 * size * sizeof(int));
 
     if (seed->flowline) {
 	/* append first point */
-	Vect_append_point(points, seed->x, seed->y, seed->z);
-	db_init_string(&sql);
+	Vect_append_point(flowline->points, seed->x, seed->y, seed->z);
     }
     count = 1;
     while (count <= integration->limit) {
-	if (get_velocity(region, gradient_info, point[0], point[1], point[2],
+	if (get_velocity(region, &gradient, point[0], point[1], point[2],
 			 &vel_x, &vel_y, &vel_z) < 0)
 	    break;		/* outside region */
 	velocity_norm = norm(vel_x, vel_y, vel_z);
@@ -149,33 +201,31 @@ void compute_flowline(RASTER3D_Region * region, const struct Seed *seed,
 				 integration->cell_size);
 	delta_t *= (integration->actual_direction == FLOWDIR_UP ? 1 : -1);
 	if (rk45_integrate_next
-	    (region, gradient_info, point, new_point,
+	    (region, &gradient, point, new_point,
 	     &delta_t, &velocity, min_step, max_step,
 	     integration->max_error) < 0)
 	    break;
 
 	if (seed->flowline) {
 	    if (if_table) {
-		write_segment(flowline_vec, points, cats, new_point, cat);
-		if (gradient_info->compute_gradient)
-		    scalar_value = get_map_value(region, gradient_info->scalar_map,
+		if (gradient.compute_gradient)
+		    scalar_value = get_map_value(region, &gradient.scalar_field,
 						 point[1], point[0], point[2]);
-		if (sampled_map)
-		    sampled_map_value = get_map_value(region, sampled_map,
+		if (sampled_field)
+		    sampled_map_value = get_map_value(region, sampled_field,
 						      point[1], point[0], point[2]);
-		write_segment_db(finfo, driver, &sql, velocity, scalar_value,
-				 sampled_map_value, gradient_info->compute_gradient,
-				 sampled_map ? 1 : 0, *cat - 1);
+		/* segment from point to new_point */
+		add_segment(flowline, new_point, velocity, scalar_value,
+			    sampled_map_value);
 	    }
 	    else
-		Vect_append_point(points, point[0], point[1], point[2]);
+		Vect_append_point(flowline->points, point[0], point[1], point[2]);
 	}
 	if (seed->flowaccum) {
 	    Rast3d_location2coord(region, new_point[1], new_point[0],
 				  new_point[2], &col, &row, &depth);
 	    if (!(last_col == col && last_row == row && last_depth == depth)) {
-		value = Rast3d_get_float(flowacc, col, row, depth);
-		Rast3d_put_float(flowacc, col, row, depth, value + 1);
+		add_flowacc(region, flowacc, col, row, depth);
 		if (last_col >= 0) {
 		    coor_diff = (abs(last_col - col) + abs(last_row - row) +
 				 abs(last_depth - depth));
@@ -184,17 +234,11 @@ void compute_flowline(RASTER3D_Region * region, const struct Seed *seed,
 		    if (coor_diff > 1) {
 			traverse(region, point, new_point, &trav_coords, &size,
 				 &trav_count);
-			for (j = 0; j < trav_count; j++) {
-			    value =
-				Rast3d_get_float(flowacc,
-						 trav_coords[3 * j + 0],
-						 trav_coords[3 * j + 1],
-						 trav_coords[3 * j + 2]);
-			    Rast3d_put_float(flowacc, trav_coords[3 * j + 0],
-					     trav_coords[3 * j + 1],
-					     trav_coords[3 * j + 2],
-					     value + 1);
-			}
+			for (j = 0; j < trav_count; j++)
+			    add_flowacc(region, flowacc,
+					trav_coords[3 * j + 0],
+					trav_coords[3 * j + 1],
+					trav_coords[3 * j + 2]);
 		    }
 		}
 		last_col = col;
@@ -208,16 +252,59 @@ void compute_flowline(RASTER3D_Region * region, const struct Seed *seed,
 	count++;
 
     }
-    if (seed->flowline) {
-	if (points->n_points > 1) {
+    if (seed->flowline)
+	G_debug(1, "Flowline ended after %d steps", count - 1);
+    G_free(trav_coords);
+}
+
+/*!
+   \brief Writes a flowline to the vector map
+
+   Without attribute table, the flowline is written as one line,
+   otherwise each segment is written as a line with its own category
+   and attributes.
+
+   \param flowline_vec pointer to Map_info struct of flowline vector
+   \param cats pointer to line_cats struct of flowline vector
+   \param points pointer to line_pnts struct of flowline vector
+   \param flowline flowline computed by compute_flowline()
+   \param[in,out] cat starting category of the newly created flow line
+   \param if_table TRUE if attribute table should be created and filled
+ */
+void write_flowline(struct Map_info *flowline_vec, struct line_cats *cats,
+		    struct line_pnts *points, struct Flowline *flowline,
+		    int *cat, int if_table, struct field_info *finfo,
+		    dbDriver * driver, int write_scalar, int use_sampled_map)
+{
+    struct line_pnts *vertices = flowline->points;
+    dbString sql;
+    int i;
+
+    if (!if_table) {
+	if (vertices->n_points > 1) {
 	    Vect_cat_set(cats, 1, *cat);
 	    (*cat)++;
-	    Vect_write_line(flowline_vec, GV_LINE, points, cats);
-	    G_debug(1, "Flowline ended after %d steps", count - 1);
+	    Vect_write_line(flowline_vec, GV_LINE, vertices, cats);
+	    Vect_reset_cats(cats);
 	}
+	return;
+    }
+
+    db_init_string(&sql);
+    for (i = 0; i < flowline->n_segments; i++) {
 	Vect_reset_line(points);
+	Vect_append_point(points, vertices->x[i], vertices->y[i],
+			  vertices->z[i]);
+	Vect_append_point(points, vertices->x[i + 1], vertices->y[i + 1],
+			  vertices->z[i + 1]);
+	Vect_cat_set(cats, 1, *cat);
+	Vect_write_line(flowline_vec, GV_LINE, points, cats);
 	Vect_reset_cats(cats);
-	db_free_string(&sql);
+	write_segment_db(finfo, driver, &sql, flowline->velocity[i],
+			 flowline->scalar[i], flowline->sampled[i],
+			 write_scalar, use_sampled_map, *cat);
+	(*cat)++;
     }
-    G_free(trav_coords);
+    Vect_reset_line(points);
+    db_free_string(&sql);
 }
@@ -8,11 +8,26 @@
 
 static const double VELOCITY_EPSILON = 1e-8;
 
+/* flowline traced from one seed in one direction */
+struct Flowline
+{
+    struct line_pnts *points;	/* vertices */
+    int n_segments;		/* with attributes: segments and */
+    int n_alloc;
+    double *velocity;		/* their velocity, */
+    double *scalar;		/* input and */
+    double *sampled;		/* sampled map value */
+};
+
+void flowline_init(struct Flowline *flowline);
+void flowline_free(struct Flowline *flowline);
 void compute_flowline(RASTER3D_Region * region, const struct Seed *seed,
-		      struct Gradient_info *gradient_info,
-		      RASTER3D_Map * flowacc, RASTER3D_Map *sampled_map,
-		      struct Integration *integration,
-		      struct Map_info *flowline_vec, struct line_cats *cats,
-		      struct line_pnts *points, int *cat, int if_table,
-		      struct field_info *finfo, dbDriver *driver);
+		      const struct Gradient_info *gradient_info,
+		      int *flowacc, const struct Field *sampled_field,
+		      const struct Integration *integration,
+		      struct Flowline *flowline, int if_table);
+void write_flowline(struct Map_info *flowline_vec, struct line_cats *cats,
+		    struct line_pnts *points, struct Flowline *flowline,
+		    int *cat, int if_table, struct field_info *finfo,
+		    dbDriver * driver, int write_scalar, int use_sampled_map);
 #endif // FLOWLINE_H
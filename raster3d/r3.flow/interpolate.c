@@ -17,6 +17,7 @@
 
 #include "r3flow_structs.h"
 #include "interpolate.h"
+#include "field.h"
 
 /*!
    \brief Finds 8 nearest voxels from a point.
@@ -134,15 +135,15 @@ static void get_relative_coords_for_interp(RASTER3D_Region * region,
    \brief Interpolates velocity at a given point.
 
    \param region pointer to current 3D region
-   \param map pointer to array of 3 3D raster maps (velocity field)
+   \param fields pointer to array of 3 fields (velocity components)
    \param north,east,top geographic coordinates
    \param[out] vel_x,vel_y,vel_z interpolated velocity
 
    \return 0 success
    \return -1 out of region
  */
-int interpolate_velocity(RASTER3D_Region * region, RASTER3D_Map ** map,
-			 const double north, const double east,
+int interpolate_velocity(RASTER3D_Region * region,
+			 const struct Field *fields, const double north, const double east,
 			 const double top, double *vel_x, double *vel_y,
 			 double *vel_z)
 {
@@ -152,7 +153,6 @@ int interpolate_velocity(RASTER3D_Region * region, RASTER3D_Map ** map,
     double interpolated[3];
     int x[8], y[8], z[8];
     double rel_x, rel_y, rel_z;
-    int type;
 
     /* check if we are out of region, any array should work */
     if (!Rast3d_is_valid_location(region, north, east, top))
@@ -161,11 +161,10 @@ int interpolate_velocity(RASTER3D_Region * region, RASTER3D_Map ** map,
     find_nearest_voxels(region, north, east, top, x, y, z);
     /* get values of the nearest cells */
     for (i = 0; i < 3; i++) {
-	type = Rast3d_tile_type_map(map[i]);
 	for (j = 0; j < 8; j++) {
 
-	    Rast3d_get_value_region(map[i], x[j], y[j], z[j], &value, type);
-	    if (Rast_is_null_value(&value, type))
+	    value = field_get_value(&fields[i], x[j], y[j], z[j]);
+	    if (Rast_is_d_null_value(&value))
 		values[i * 8 + j] = 0;
 	    else
 		values[i * 8 + j] = value;
@@ -296,8 +295,8 @@ int get_gradient(RASTER3D_Region * region,
 	}
 
 	/* get the 4x4x4 block of the array */
-	Rast3d_get_block(gradient_info->scalar_map, minx, miny, minz,
-			 4, 4, 4, array.array, DCELL_TYPE);
+	field_get_block(&gradient_info->scalar_field, minx, miny, minz,
+			4, 4, 4, array.array);
 	Rast3d_gradient_double(&array, step, &grad_x, &grad_y, &grad_z);
 	grad_xyz[0] = &grad_x;
 	grad_xyz[1] = &grad_y;
@@ -5,7 +5,8 @@
 
 #include "r3flow_structs.h"
 
-int interpolate_velocity(RASTER3D_Region * region, RASTER3D_Map ** map,
+int interpolate_velocity(RASTER3D_Region * region,
+			 const struct Field *fields,
 			 const double north, const double east,
 			 const double top, double *vel_x, double *vel_y,
 			 double *vel_z);
@@ -24,6 +24,24 @@
 
 #include "r3flow_structs.h"
 #include "flowline.h"
+#include "field.h"
+
+/* number of seeds traced at once */
+#define SEED_BATCH 1024
+
+/* seeds traced concurrently, written in their order afterwards */
+struct batch
+{
+    RASTER3D_Region *region;
+    struct Gradient_info *gradient_info;
+    struct Integration *integration;
+    struct Field *sampled_field;
+    int *flowacc;
+    int if_table;
+    struct Seed seeds[SEED_BATCH];
+    struct Flowline flowlines[2 * SEED_BATCH];	/* up and down */
+    int n_seeds;
+};
 
 static void create_table(struct Map_info *flowline_vec,
 			 struct field_info **f_info, dbDriver ** driver,
@@ -101,6 +119,30 @@ static void check_vector_input_maps(struct Option *vector_opt,
 
 }
 
+static RASTER3D_Map *open_input_map(const char *name,
+				    RASTER3D_Region * region)
+{
+    RASTER3D_Map *map;
+
+    map = Rast3d_open_cell_old(name, G_find_raster3d(name, ""), region,
+			       RASTER3D_TILE_SAME_AS_FILE,
+			       RASTER3D_USE_CACHE_DEFAULT);
+    if (!map)
+	Rast3d_fatal_error(_("Unable to open 3D raster map <%s>"), name);
+
+    return map;
+}
+
+static void load_field(const char *name, RASTER3D_Region * region,
+		       struct Field *field)
+{
+    RASTER3D_Map *map;
+
+    map = open_input_map(name, region);
+    field_load(field, map, region);
+    Rast3d_close(map);
+}
+
 static void load_input_raster3d_maps(struct Option *scalar_opt,
 				     struct Option *vector_opt,
 				     struct Gradient_info *gradient_info,
@@ -109,55 +151,120 @@ static void load_input_raster3d_maps(struct Option *scalar_opt,
     int i;
 
     if (scalar_opt->answer) {
-	gradient_info->scalar_map =
-	    Rast3d_open_cell_old(scalar_opt->answer,
-				 G_find_raster3d(scalar_opt->answer, ""),
-				 region, RASTER3D_TILE_SAME_AS_FILE,
-				 RASTER3D_USE_CACHE_DEFAULT);
-	if (!gradient_info->scalar_map)
-	    Rast3d_fatal_error(_("Unable to open 3D raster map <%s>"),
-			       scalar_opt->answer);
+	load_field(scalar_opt->answer, region, &gradient_info->scalar_field);
 	gradient_info->compute_gradient = TRUE;
     }
     else {
-	for (i = 0; i < 3; i++) {
-	    gradient_info->velocity_maps[i] =
-		Rast3d_open_cell_old(vector_opt->answers[i],
-				     G_find_raster3d(vector_opt->answers[i],
-						     ""), region,
-				     RASTER3D_TILE_SAME_AS_FILE,
-				     RASTER3D_USE_CACHE_DEFAULT);
-
-	    if (!gradient_info->velocity_maps[i])
-		Rast3d_fatal_error(_("Unable to open 3D raster map <%s>"),
-				   vector_opt->answers[i]);
-	}
+	for (i = 0; i < 3; i++)
+	    load_field(vector_opt->answers[i], region,
+		       &gradient_info->velocity_fields[i]);
 	gradient_info->compute_gradient = FALSE;
     }
 }
 
-static void init_flowaccum(RASTER3D_Region * region, RASTER3D_Map * flowacc)
+/* trace the seeds first to last - 1 of a batch */
+static void trace_seeds(int first, int last, void *closure)
 {
-    int c, r, d;
+    struct batch *b = closure;
+    struct Integration integration = *b->integration;
+    int i;
 
-    for (d = 0; d < region->depths; d++)
-	for (r = 0; r < region->rows; r++)
-	    for (c = 0; c < region->cols; c++)
-		if (Rast3d_put_float(flowacc, c, r, d, 0) != 1)
-		    Rast3d_fatal_error(_("init_flowaccum: error in Rast3d_put_float"));
+    for (i = first; i < last; i++) {
+	if (integration.direction_type == FLOWDIR_UP ||
+	    integration.direction_type == FLOWDIR_BOTH) {
+	    integration.actual_direction = FLOWDIR_UP;
+	    compute_flowline(b->region, &b->seeds[i], b->gradient_info,
+			     b->flowacc, b->sampled_field, &integration,
+			     &b->flowlines[2 * i], b->if_table);
+	}
+	if (integration.direction_type == FLOWDIR_DOWN ||
+	    integration.direction_type == FLOWDIR_BOTH) {
+	    integration.actual_direction = FLOWDIR_DOWN;
+	    compute_flowline(b->region, &b->seeds[i], b->gradient_info,
+			     b->flowacc, b->sampled_field, &integration,
+			     &b->flowlines[2 * i + 1], b->if_table);
+	}
+    }
+}
+
+/* trace the seeds of a batch and write their flowlines */
+static void flush_batch(struct batch *b, struct Map_info *fl_map,
+			struct line_cats *fl_cats,
+			struct line_pnts *fl_points, int *cat,
+			struct field_info *finfo, dbDriver * driver)
+{
+    int i, d;
+
+    G_parallel_for(0, b->n_seeds, 8, trace_seeds, b);
+
+    for (i = 0; i < b->n_seeds; i++) {
+	if (!b->seeds[i].flowline)
+	    continue;
+	for (d = 0; d < 2; d++) {
+	    if ((d == 0 && b->integration->direction_type == FLOWDIR_DOWN) ||
+		(d == 1 && b->integration->direction_type == FLOWDIR_UP))
+		continue;
+	    write_flowline(fl_map, fl_cats, fl_points, &b->flowlines[2 * i + d],
+			   cat, b->if_table, finfo, driver,
+			   b->gradient_info->compute_gradient,
+			   b->sampled_field ? 1 : 0);
+	}
+    }
+    b->n_seeds = 0;
+}
+
+/* write the flow accumulation tile by tile */
+static void write_flowaccum(RASTER3D_Region * region, RASTER3D_Map * map,
+			    const int *flowacc)
+{
+    int tile_x, tile_y, tile_z, nx, ny, nz, tx, ty, tz, index;
+    int x, y, z, col, row, depth;
+    FCELL *tile;
+
+    Rast3d_get_tile_dimensions_map(map, &tile_x, &tile_y, &tile_z);
+    Rast3d_get_nof_tiles_map(map, &nx, &ny, &nz);
+    tile = G_malloc(sizeof(FCELL) * tile_x * tile_y * tile_z);
+
+    for (index = 0; index < nx * ny * nz; index++) {
+	Rast3d_tile_index2tile(map, index, &tx, &ty, &tz);
+	Rast3d_set_null_value(tile, tile_x * tile_y * tile_z, FCELL_TYPE);
+	for (z = 0; z < tile_z; z++) {
+	    depth = tz * tile_z + z;
+	    if (depth >= region->depths)
+		break;
+	    for (y = 0; y < tile_y; y++) {
+		row = ty * tile_y + y;
+		if (row >= region->rows)
+		    break;
+		for (x = 0; x < tile_x; x++) {
+		    col = tx * tile_x + x;
+		    if (col >= region->cols)
+			break;
+		    tile[(z * tile_y + y) * tile_x + x] =
+			flowacc[((size_t)depth * region->rows + row) *
+				region->cols + col];
+		}
+	    }
+	}
+	if (!Rast3d_write_tile_float(map, index, tile))
+	    Rast3d_fatal_error(_("Error writing tile %d"), index);
+    }
+    G_free(tile);
 }
 
 int main(int argc, char *argv[])
 {
     struct Option *vector_opt, *seed_opt, *flowlines_opt, *flowacc_opt, *sampled_opt,
 	*scalar_opt, *unit_opt, *step_opt, *limit_opt, *skip_opt, *dir_opt,
-	*error_opt;
+	*error_opt, *nprocs_opt;
     struct Flag *table_fl;
     struct GModule *module;
     RASTER3D_Region region;
-    RASTER3D_Map *flowacc, *sampled;
+    RASTER3D_Map *flowacc_map;
+    struct Field sampled;
     struct Integration integration;
-    struct Seed seed;
+    struct Seed *seed;
+    struct batch *batch;
     struct Gradient_info gradient_info;
     struct Map_info seed_Map;
     struct line_pnts *seed_points;
@@ -169,6 +276,7 @@ int main(int argc, char *argv[])
     dbDriver *driver;
     int cat;			/* cat of flowlines */
     int if_table;
+    int *flowacc;
     int i, r, c, d;
     char *desc;
     int n_seeds, seed_count, ltype;
@@ -289,6 +397,8 @@ int main(int argc, char *argv[])
     dir_opt->description = _("Compute flowlines upstream, "
 			     "downstream or in both direction.");
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     table_fl = G_define_flag();
     table_fl->key = 'a';
     table_fl->description = _("Create and fill attribute table");
@@ -303,6 +413,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
+
     driver = NULL;
     finfo = NULL;
 
@@ -363,30 +475,23 @@ int main(int argc, char *argv[])
 
 
     /* open new 3D raster map of flowacumulation */
+    flowacc = NULL;
     if (flowacc_opt->answer) {
-	flowacc = Rast3d_open_new_opt_tile_size(flowacc_opt->answer,
-						RASTER3D_USE_CACHE_DEFAULT,
-						&region, FCELL_TYPE, 32);
+	flowacc_map = Rast3d_open_new_opt_tile_size(flowacc_opt->answer,
+						    RASTER3D_NO_CACHE,
+						    &region, FCELL_TYPE, 32);
 
 
-	if (!flowacc)
+	if (!flowacc_map)
 	    Rast3d_fatal_error(_("Unable to open 3D raster map <%s>"),
 			       flowacc_opt->answer);
-	init_flowaccum(&region, flowacc);
+	flowacc = G_calloc((size_t)region.cols * region.rows * region.depths,
+			   sizeof(int));
     }
 
-    /* open 3D raster map used for sampling */
-    if (sampled_opt->answer) {
-	sampled = Rast3d_open_cell_old(sampled_opt->answer,
-				       G_find_raster3d(sampled_opt->answer, ""),
-				       &region, RASTER3D_TILE_SAME_AS_FILE,
-				       RASTER3D_USE_CACHE_DEFAULT);
-	if (!sampled)
-	    Rast3d_fatal_error(_("Unable to open 3D raster map <%s>"),
-			       sampled_opt->answer);
-    }
-    else
-	sampled = NULL;
+    /* read 3D raster map used for sampling */
+    if (sampled_opt->answer)
+	load_field(sampled_opt->answer, &region, &sampled);
 
     /* open new vector map of flowlines */
     if (flowlines_opt->answer) {
@@ -400,7 +505,8 @@ int main(int argc, char *argv[])
 
 	if (if_table) {
 	    create_table(&fl_map, &finfo, &driver,
-			 gradient_info.compute_gradient, sampled ? 1 : 0);
+			 gradient_info.compute_gradient,
+			 sampled_opt->answer ? 1 : 0);
 	}
     }
 
@@ -426,6 +532,17 @@ int main(int argc, char *argv[])
     }
     G_debug(1, "Number of seeds is %d", n_seeds);
 
+    batch = G_malloc(sizeof(struct batch));
+    batch->region = &region;
+    batch->gradient_info = &gradient_info;
+    batch->integration = &integration;
+    batch->sampled_field = sampled_opt->answer ? &sampled : NULL;
+    batch->flowacc = flowacc;
+    batch->if_table = if_table;
+    batch->n_seeds = 0;
+    for (i = 0; i < 2 * SEED_BATCH; i++)
+	flowline_init(&batch->flowlines[i]);
+
     seed_count = 0;
     cat = 1;
     if (seed_opt->answer) {
@@ -443,30 +560,24 @@ int main(int argc, char *argv[])
 	    else if (ltype == -2) {
 		break;
 	    }
-	    else if (ltype == GV_POINT) {
-		seed.x = seed_points->x[0];
-		seed.y = seed_points->y[0];
-		seed.z = seed_points->z[0];
-		seed.flowline = TRUE;
-		seed.flowaccum = FALSE;
-	    }
-	    G_percent(seed_count, n_seeds, 1);
-	    if (integration.direction_type == FLOWDIR_UP ||
-		integration.direction_type == FLOWDIR_BOTH) {
-		integration.actual_direction = FLOWDIR_UP;
-		compute_flowline(&region, &seed, &gradient_info, flowacc, sampled,
-				 &integration, &fl_map, fl_cats, fl_points,
-				 &cat, if_table, finfo, driver);
-	    }
-	    if (integration.direction_type == FLOWDIR_DOWN ||
-		integration.direction_type == FLOWDIR_BOTH) {
-		integration.actual_direction = FLOWDIR_DOWN;
-		compute_flowline(&region, &seed, &gradient_info, flowacc, sampled,
-				 &integration, &fl_map, fl_cats, fl_points,
-				 &cat, if_table, finfo, driver);
-	    }
+	    else if (ltype != GV_POINT)
+		continue;
+
+	    seed = &batch->seeds[batch->n_seeds++];
+	    seed->x = seed_points->x[0];
+	    seed->y = seed_points->y[0];
+	    seed->z = seed_points->z[0];
+	    seed->flowline = TRUE;
+	    seed->flowaccum = FALSE;
 	    seed_count++;
+
+	    if (batch->n_seeds == SEED_BATCH) {
+		G_percent(seed_count, n_seeds, 1);
+		flush_batch(batch, &fl_map, fl_cats, fl_points, &cat, finfo,
+			    driver);
+	    }
 	}
+	flush_batch(batch, &fl_map, fl_cats, fl_points, &cat, finfo, driver);
 
 	Vect_destroy_line_struct(seed_points);
 	Vect_destroy_cats_struct(seed_cats);
@@ -477,46 +588,40 @@ int main(int argc, char *argv[])
 	for (r = region.rows; r > 0; r--) {
 	    for (c = 0; c < region.cols; c++) {
 		for (d = 0; d < region.depths; d++) {
-		    seed.x =
+		    seed = &batch->seeds[batch->n_seeds];
+		    seed->x =
 			region.west + c * region.ew_res + region.ew_res / 2;
-		    seed.y =
+		    seed->y =
 			region.south + r * region.ns_res - region.ns_res / 2;
-		    seed.z =
+		    seed->z =
 			region.bottom + d * region.tb_res + region.tb_res / 2;
-		    seed.flowline = FALSE;
-		    seed.flowaccum = FALSE;
+		    seed->flowline = FALSE;
+		    seed->flowaccum = FALSE;
 		    if (flowacc_opt->answer)
-			seed.flowaccum = TRUE;
+			seed->flowaccum = TRUE;
 
 		    if (flowlines_opt->answer && !seed_opt->answer &&
 		       (c % skip[0] == 0) && (r % skip[1] == 0) && (d % skip[2] == 0))
-			seed.flowline = TRUE;
-
-		    if (seed.flowaccum || seed.flowline) {
-			G_percent(seed_count, n_seeds, 1);
-
-			if (integration.direction_type == FLOWDIR_UP ||
-			    integration.direction_type == FLOWDIR_BOTH) {
-			    integration.actual_direction = FLOWDIR_UP;
-			    compute_flowline(&region, &seed, &gradient_info,
-					     flowacc, sampled, &integration, &fl_map,
-					     fl_cats, fl_points, &cat,
-					     if_table, finfo, driver);
-			}
-			if (integration.direction_type == FLOWDIR_DOWN ||
-			    integration.direction_type == FLOWDIR_BOTH) {
-			    integration.actual_direction = FLOWDIR_DOWN;
-			    compute_flowline(&region, &seed, &gradient_info,
-					     flowacc, sampled, &integration, &fl_map,
-					     fl_cats, fl_points, &cat,
-					     if_table, finfo, driver);
-			}
+			seed->flowline = TRUE;
+
+		    if (seed->flowaccum || seed->flowline) {
+			batch->n_seeds++;
 			seed_count++;
+			if (batch->n_seeds == SEED_BATCH) {
+			    G_percent(seed_count, n_seeds, 1);
+			    flush_batch(batch, &fl_map, fl_cats, fl_points,
+					&cat, finfo, driver);
+			}
 		    }
 		}
 	    }
 	}
+	flush_batch(batch, &fl_map, fl_cats, fl_points, &cat, finfo, driver);
     }
+    for (i = 0; i < 2 * SEED_BATCH; i++)
+	flowline_free(&batch->flowlines[i]);
+    G_free(batch);
+
     G_percent(1, 1, 1);
     if (flowlines_opt->answer) {
 	if (if_table) {
@@ -529,8 +634,11 @@ int main(int argc, char *argv[])
 	Vect_close(&fl_map);
     }
 
-    if (flowacc_opt->answer)
-	Rast3d_close(flowacc);
+    if (flowacc_opt->answer) {
+	write_flowaccum(&region, flowacc_map, flowacc);
+	Rast3d_close(flowacc_map);
+	G_free(flowacc);
+    }
 
 
     return EXIT_SUCCESS;
@@ -27,11 +27,19 @@ struct Integration
     double min_step;
 };
 
+/* 3D raster map read into memory, see field.c */
+struct Field
+{
+    void *data;
+    int type;
+    int cols, rows, depths;
+};
+
 struct Gradient_info
 {
     int compute_gradient;
-    RASTER3D_Map *velocity_maps[3];
-    RASTER3D_Map *scalar_map;
+    struct Field velocity_fields[3];
+    struct Field scalar_field;
     double neighbors_values[24];
     int neighbors_pos[3];
     int initialized;
@@ -11,14 +11,15 @@
 #include "r3flow_structs.h"
 #include "flowline.h"
 #include "interpolate.h"
+#include "field.h"
 
 static void test_interpolation(RASTER3D_Region * region,
-			       RASTER3D_Map ** input_maps, double north,
+			       struct Field *input_fields, double north,
 			       double east, double top)
 {
     double interpolated[3];
 
-    if (interpolate_velocity(region, input_maps, north, east, top,
+    if (interpolate_velocity(region, input_fields, north, east, top,
 			     &interpolated[0], &interpolated[1],
 			     &interpolated[2]) < 0) {
 	fprintf(stdout, "return=-1\n");
@@ -35,7 +36,8 @@ int main(int argc, char *argv[])
     struct GModule *module;
     struct Option *test_opt, *coordinates_opt, *input_opt;
     RASTER3D_Region region;
-    RASTER3D_Map *input_3drasters[3];
+    RASTER3D_Map *input_3draster;
+    struct Field input_fields[3];
     double coordinates[3];
 
     G_gisinit(argv[0]);
@@ -72,15 +74,17 @@ int main(int argc, char *argv[])
 
 	if (input_opt->answers) {
 	    for (i = 0; i < 3; i++) {
-		input_3drasters[i] =
+		input_3draster =
 		    Rast3d_open_cell_old(input_opt->answers[i],
 					 G_find_raster3d(input_opt->
 							 answers[i], ""),
 					 &region, RASTER3D_TILE_SAME_AS_FILE,
 					 RASTER3D_USE_CACHE_DEFAULT);
-		if (input_3drasters[i] == NULL)
+		if (input_3draster == NULL)
 		    Rast3d_fatal_error(_("Unable to open 3D raster map <%s>"),
 				       input_opt->answers[i]);
+		field_load(&input_fields[i], input_3draster, &region);
+		Rast3d_close(input_3draster);
 	    }
 	}
 	else
@@ -96,7 +100,7 @@ int main(int argc, char *argv[])
 	}
 	else
 	    G_fatal_error("No coordinates for interpolation test");
-	test_interpolation(&region, input_3drasters, coordinates[1],
+	test_interpolation(&region, input_fields, coordinates[1],
 			   coordinates[0], coordinates[2]);
     }
 
@@ -33,6 +33,7 @@ typedef struct
 	*vector_x, *vector_y, *vector_z, *budget, *dt, *maxit, *error, *solver;
     struct Flag *mask;
     struct Flag *full_les;
+    struct Flag *stencil_les;
 } paramType;
 
 paramType param;		/*Parameters */
@@ -120,7 +121,7 @@ void set_params(void)
     param.maxit = N_define_standard_option(N_OPT_MAX_ITERATIONS);
     param.error = N_define_standard_option(N_OPT_ITERATION_ERROR);
     param.solver = N_define_standard_option(N_OPT_SOLVER_SYMM);
-    param.solver->options = "cg,pcg,cholesky";
+    param.solver->options = "cg,pcg,multigrid,cholesky";
 
     param.mask = G_define_flag();
     param.mask->key = 'm';
@@ -130,6 +131,13 @@ void set_params(void)
     param.full_les->key = 'f';
     param.full_les->description = _("Use a full filled quadratic linear equation system,"
             " default is a sparse linear equation system.");
+
+    param.stencil_les = G_define_flag();
+    param.stencil_les->key = 's';
+    param.stencil_les->description = _("Use a matrix-free linear equation system to save memory,"
+            " only the cg and pcg solvers are supported.");
+
+    G_option_exclusive(param.full_les, param.stencil_les, NULL);
 }
 
 /* ************************************************************************* */
@@ -180,6 +188,16 @@ int main(int argc, char *argv[])
 	G_fatal_error(_("The cholesky solver does not work with sparse matrices.\n"
                 "Consider to choose a full filled quadratic matrix with flag -f "));
 
+    if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_MULTIGRID) == 0 && param.full_les->answer)
+	G_fatal_error(_("The multigrid solver works only with sparse matrices.\n"
+                "Remove flag -f "));
+
+    if (param.stencil_les->answer &&
+	strcmp(solver, G_MATH_SOLVER_ITERATIVE_CG) != 0 &&
+	strcmp(solver, G_MATH_SOLVER_ITERATIVE_PCG) != 0)
+	G_fatal_error(_("The matrix-free linear equation system works only "
+                "with the cg and pcg solvers."));
+
 
 
     /*Set the defaults */
@@ -242,7 +260,12 @@ int main(int argc, char *argv[])
     }
 
     /*assemble the linear equation system */
-    if (!param.full_les->answer) {
+    if (param.stencil_les->answer) {
+	les =
+	    N_assemble_les_3d(N_STENCIL_LES, geom, data->status, data->phead,
+			      (void *)data, call);
+    }
+    else if (!param.full_les->answer) {
 	les =
 	    N_assemble_les_3d(N_SPARSE_LES, geom, data->status, data->phead,
 			      (void *)data, call);
@@ -273,6 +296,17 @@ int main(int argc, char *argv[])
 	if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_PCG) == 0)
 	    G_math_solver_sparse_pcg(les->Asp, les->x, les->b, les->rows,
 				     maxit, error, G_MATH_DIAGONAL_PRECONDITION);
+
+	if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_MULTIGRID) == 0)
+	    G_math_solver_sparse_multigrid(les->Asp, les->x, les->b,
+					   les->rows, maxit, error);
+    }
+    else if (les && les->type == N_STENCIL_LES) {
+	if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_CG) == 0)
+	    N_solver_stencil_cg(les, maxit, error);
+
+	if (strcmp(solver, G_MATH_SOLVER_ITERATIVE_PCG) == 0)
+	    N_solver_stencil_pcg(les, maxit, error);
     }
 
     if (les == NULL)
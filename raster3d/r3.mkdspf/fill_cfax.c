@@ -3,7 +3,7 @@
 
 
 /* place vertex data into CUBEFAX structure */
-void fill_cfax(Cube_data * Cube, int flag, int index, float
+void fill_cfax(Cube_data * Cube, int flag, int index, int NTHRESH, float
 	       TEMP_VERT[13][3], float TEMP_NORM[13][3])
 {
     int p;			/*loop variable */
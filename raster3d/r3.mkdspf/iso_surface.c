@@ -9,61 +9,120 @@
 
 #define XDIMYDIM (Headfax.xdim*Headfax.ydim)
 
-float TEMP_VERT[13][3];
-float TEMP_NORM[13][3];
-
-static float DATA[8];
+/* working data of the cubes of one level */
+struct iso_state
+{
+    float DATA[8];
+    float TEMP_VERT[13][3];
+    float TEMP_NORM[13][3];
+    Cube_data CUBE;
+};
+
+/* levels of the volume read for a batch of cube levels, level l is
+   kept in slot l % nslots */
+struct iso_batch
+{
+    float **slots;
+    int *level;			/* level in each slot, -1 if unused */
+    int nslots;
+    int z0;			/* first cube level of the batch */
+    cube_buffer *out;		/* display file data of each cube level */
+};
 
 
 /* function prototypes */
 static void percent(int z, int zloop);
-static void calc_cube_info(float *data[], int z1);
-static void xings_fnorm(int c_ndx, int t_ndx);
-static void calc_fnorm(int c_ndx);
-static void xings_grad(float *data[], int c_ndx, int x1, int y1,
-		       int z1, int t_ndx);
+static void calc_levels(int first, int last, void *closure);
+static void calc_cube_info(struct iso_state *s, float *data[], int z1,
+			   cube_buffer * out);
+static void xings_fnorm(struct iso_state *s, int c_ndx, int t_ndx);
+static void calc_fnorm(struct iso_state *s, int c_ndx);
+static void xings_grad(struct iso_state *s, float *data[], int c_ndx,
+		       int x1, int y1, int z1, int t_ndx);
 static void normalize(float n[3]);
 
 
+/* The cube levels are processed in batches: the levels of the volume
+ * needed by a batch are read first, then its cube levels are computed
+ * in parallel, each into its own buffer, and the buffers are written
+ * to the display file in order. */
 void viz_iso_surface(void *g3map, RASTER3D_Region * g3reg,
 		     cmndln_info * linefax, int quiet)
 {
-    float *data[4];		/* will hold 4 slices of xy data */
+    struct iso_batch b;
     int zloop;
-    int z;			/* looping variables */
-    int slice;
-    float *temp;
+    int nbatch;			/* cube levels per batch */
+    int z, z1, lev, i;
 
     zloop = Headfax.zdim - 1;	/*crop to permit use of gradients */
 
-    /* for gradient shading processing 4 slices of xy data at a time */
-
-    for (z = 0; z < zloop; z++) {	/*dpg */
-	if (!quiet)
-	    percent(z, zloop);
+    nbatch = 4 * (G_num_workers() + 1);
+    if (nbatch > zloop)
+	nbatch = zloop;
+
+    /* for gradient shading a cube level needs 4 levels of xy data */
+    b.nslots = nbatch + 3;
+    b.slots = G_malloc(b.nslots * sizeof(float *));
+    b.level = G_malloc(b.nslots * sizeof(int));
+    for (i = 0; i < b.nslots; i++) {
+	b.slots[i] = (float *)G_malloc(sizeof(float) * XDIMYDIM);
+	b.level[i] = -1;
+    }
+    b.out = G_calloc(nbatch, sizeof(cube_buffer));
+
+    for (z = 0; z < zloop; z = z1) {	/*dpg */
+	z1 = z + nbatch < zloop ? z + nbatch : zloop;
+
+	for (lev = z > 0 ? z - 1 : 0; lev <= z1 + 1 && lev < Headfax.zdim;
+	     lev++) {
+	    i = lev % b.nslots;
+	    if (b.level[i] == lev)
+		continue;
+	    /*read in data */
+	    r3read_level(g3map, g3reg, &Headfax, b.slots[i], lev);
+	    b.level[i] = lev;
+	}
 
-	if (!z) {		/* first time thru need to read in four slices of data */
-	    for (slice = 0; slice < 4; slice++) {
-		data[slice] = (float *)G_malloc(sizeof(float) * XDIMYDIM);
+	b.z0 = z;
+	G_parallel_for(z, z1, 1, calc_levels, &b);
 
-		if (slice)
-		    /*read in data */
-		    r3read_level(g3map, g3reg, &Headfax, data[slice],
-				 slice - 1);
-	    }
+	for (i = 0; i < z1 - z; i++) {
+	    if (!quiet)
+		percent(z + i, zloop);
+	    fwrite(b.out[i].data, 1, b.out[i].size, Headfax.dspfoutfp);
+	    b.out[i].size = 0;
 	}
-	else {
-	    temp = data[0];
-	    data[0] = data[1];
-	    data[1] = data[2];
-	    data[2] = data[3];
-	    data[3] = temp;
-	    if (z < zloop - 1)
-		r3read_level(g3map, g3reg, &Headfax, data[3], z + 2);
+    }
 
+    for (i = 0; i < b.nslots; i++)
+	G_free(b.slots[i]);
+    G_free(b.slots);
+    G_free(b.level);
+    for (i = 0; i < nbatch; i++)
+	G_free(b.out[i].data);
+    G_free(b.out);
+}
+
+
+static void calc_levels(int first, int last, void *closure)
+{
+    struct iso_batch *b = closure;
+    struct iso_state *s = G_malloc(sizeof(struct iso_state));
+    float *data[4];		/* 4 slices of xy data */
+    int z, slice, lev;
+
+    for (z = first; z < last; z++) {
+	for (slice = 0; slice < 4; slice++) {
+	    /* levels outside of the volume are not used */
+	    lev = z - 1 + slice;
+	    if (lev < 0 || lev >= Headfax.zdim)
+		lev = z;
+	    data[slice] = b->slots[lev % b->nslots];
 	}
-	calc_cube_info(data, z);
+	calc_cube_info(s, data, z, &b->out[z - b->z0]);
     }
+
+    G_free(s);
 }
 
 
@@ -84,7 +143,8 @@ static void percent(int z, int zloop)
 
 
 /************************ calc_cube_info  ************************************/
-static void calc_cube_info(float *data[], int z1)
+static void calc_cube_info(struct iso_state *s, float *data[], int z1,
+			   cube_buffer * out)
 {
     int x1, y1;
     int x2, y2;
@@ -95,9 +155,10 @@ static void calc_cube_info(float *data[], int z1)
     int a = 0;			/*keeps track of how many thresholds are contained in a cell */
     cmndln_info *linefax;
     cube_info *CUBEFAX;
+    float *DATA = s->DATA;
     int vnum;			/* index to loop through vertices of cube */
 
-    CUBEFAX = CUBE.data;	/* make old code fit new structure */
+    CUBEFAX = s->CUBE.data;	/* make old code fit new structure */
 
     linefax = &Headfax.linefax;
     xloop = (Headfax.xdim);
@@ -163,26 +224,25 @@ static void calc_cube_info(float *data[], int z1)
 		/*if (c_ndx > 0 && c_ndx < 254) this is the hole bug */
 		if (c_ndx > 0 && c_ndx < 255) {	/* -dpg */
 		    CUBEFAX[a].t_ndx = t_ndx;
-		    NTHRESH = a;
-		    a++;
 		    switch (linefax->litmodel) {
 		    case 1:
-			xings_fnorm(c_ndx, t_ndx);
+			xings_fnorm(s, c_ndx, t_ndx);
 			break;
 		    case 2:
 		    case 3:
-			xings_grad(data, c_ndx, x1, y1, z1, t_ndx);
+			xings_grad(s, data, c_ndx, x1, y1, z1, t_ndx);
 			break;
 		    }
-		    fill_cfax(&CUBE, linefax->litmodel, c_ndx,
-			      TEMP_VERT, TEMP_NORM);
+		    fill_cfax(&s->CUBE, linefax->litmodel, c_ndx, a,
+			      s->TEMP_VERT, s->TEMP_NORM);
+		    a++;
 		}
 	    }
 	    if (!a)
 		CUBEFAX[0].npoly = 0;	/* sets 'empty' flag */
 
-	    CUBE.n_thresh = a;
-	    write_cube(&CUBE, x1, &Headfax);
+	    s->CUBE.n_thresh = a;
+	    write_cube_mem(&s->CUBE, x1, &Headfax, out);
 	}
     }
 }
@@ -194,8 +254,10 @@ static void calc_cube_info(float *data[], int z1)
  **  Subroutine vertices are determined for the polygons that will be 
  **  saved in a display file as well as the normal to the polygon
  */
-static void xings_fnorm(int c_ndx, int t_ndx)
+static void xings_fnorm(struct iso_state *s, int c_ndx, int t_ndx)
 {
+    float *DATA = s->DATA;
+    float (*TEMP_VERT)[3] = s->TEMP_VERT;
     cmndln_info *linefax;
     register int i;		/* loop count variable incremented to to examine each edge */
 
@@ -288,14 +350,16 @@ static void xings_fnorm(int c_ndx, int t_ndx)
 		LINTERP(DATA[2], DATA[6], linefax->tvalue[t_ndx]);
 	}
     }
-    calc_fnorm(c_ndx);
+    calc_fnorm(s, c_ndx);
 }
 
 
 /*************************** calc_fnorm  ************************************/
 /* this routine calculates the normal to a polygon for flat shading */
-static void calc_fnorm(int c_ndx)
+static void calc_fnorm(struct iso_state *s, int c_ndx)
 {
+    float (*TEMP_VERT)[3] = s->TEMP_VERT;
+    float (*TEMP_NORM)[3] = s->TEMP_NORM;
     float x1, y1, z1, x2, y2, z2, x3, y3, z3;
     int i = 0;
     int inref;
@@ -348,9 +412,12 @@ static void calc_fnorm(int c_ndx)
  **  in lighting calculations.
  **  gradients are stored in temporary variables that are also written to display**  file. 
  */
-static void xings_grad(float *data[], int c_ndx, int x1, int y1, int z1,
-		       int t_ndx)
+static void xings_grad(struct iso_state *s, float *data[], int c_ndx,
+		       int x1, int y1, int z1, int t_ndx)
 {
+    float *DATA = s->DATA;
+    float (*TEMP_VERT)[3] = s->TEMP_VERT;
+    float (*TEMP_NORM)[3] = s->TEMP_NORM;
     cmndln_info *linefax;
     register int i;		/* loop count variable incremented to examine each edge */
 
@@ -5,7 +5,7 @@
 int viz_calc_tvals(cmndln_info * linefax, char **a_levels, char *a_min,
 		   char *a_max, char *a_step, char *a_tnum, int quiet);
 /* fill_fax.c */
-void fill_cfax(Cube_data * Cube, int flag, int index,
+void fill_cfax(Cube_data * Cube, int flag, int index, int NTHRESH,
 	       float TEMP_VERT[13][3], float TEMP_NORM[13][3]);
 /* iso_surface.c */
 void viz_iso_surface(void *g3map, RASTER3D_Region * g3reg,
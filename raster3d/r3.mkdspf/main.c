@@ -49,8 +49,6 @@
 #include <grass/glocale.h>
 
 file_info Headfax;	/* contains info about command line */
-Cube_data CUBE;		/* and the data for a single cube */
-int NTHRESH;
 
 int main(int argc, char *argv[])
 {
@@ -69,6 +67,7 @@ int main(int argc, char *argv[])
     struct Option *step;
     struct Option *tnum;
     struct Option *name;
+    struct Option *nprocs;
 
     struct Flag *shade;
     struct Flag *quiet;
@@ -127,6 +126,8 @@ int main(int argc, char *argv[])
     tnum->answer = "7";
     tnum->description = _("Number of isosurface threshold levels");
 
+    nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     quiet = G_define_flag();
     quiet->key = 'q';
     quiet->description = _("Suppress progress report & min/max information");
@@ -138,6 +139,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs);
+
     Rast3d_init_defaults();
 
     Rast3d_get_window(&g3reg);
@@ -1,5 +1,3 @@
 #include "viz.h"
 
 extern file_info Headfax;	/* contains info about command line */
-extern Cube_data CUBE;		/* and the data for a single cube */
-extern int NTHRESH;
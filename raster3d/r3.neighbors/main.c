@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <grass/raster3d.h>
 #include <grass/stats.h>
 #include <grass/gis.h>
@@ -33,31 +34,54 @@ int x_size, y_size, z_size;	/* The size of the moving window in x,
 				   y and z direction */
 int size;			/* The maximum size of the value buffer */
 
+/* methods computed from running sums instead of the gathered values */
+enum
+{
+    RUN_NONE,
+    RUN_AVE,
+    RUN_SUM,
+    RUN_COUNT,
+    RUN_VAR,
+    RUN_STDDEV
+};
+
 struct menu
 {
     stat_func *method;		/* routine to compute new value */
+    int running;		/* running sum variant of the method */
     char *name;			/* method name */
     char *text;			/* menu display - full description */
 } menu[] = {
     {
-    c_ave, "average", "average value"}, {
-    c_median, "median", "median value"}, {
-    c_mode, "mode", "most frequently occurring value"}, {
-    c_min, "minimum", "lowest value"}, {
-    c_max, "maximum", "highest value"}, {
-    c_range, "range", "range value"}, {
-    c_stddev, "stddev", "standard deviation"}, {
-    c_sum, "sum", "sum of values"}, {
-    c_count, "count", "count of non-NULL values"}, {
-    c_var, "variance", "statistical variance"}, {
-    c_divr, "diversity", "number of different values"}, {
-    c_intr, "interspersion", "number of values different than center value"},
-    {
-    c_quart1, "quart1", "first quartile"}, {
-    c_quart3, "quart3", "third quartile"}, {
-    c_perc90, "perc90", "ninetieth percentile"}, {
-    c_quant, "quantile", "arbitrary quantile"}, {
-    NULL, NULL, NULL}
+    c_ave, RUN_AVE, "average", "average value"}, {
+    c_median, RUN_NONE, "median", "median value"}, {
+    c_mode, RUN_NONE, "mode", "most frequently occurring value"}, {
+    c_min, RUN_NONE, "minimum", "lowest value"}, {
+    c_max, RUN_NONE, "maximum", "highest value"}, {
+    c_range, RUN_NONE, "range", "range value"}, {
+    c_stddev, RUN_STDDEV, "stddev", "standard deviation"}, {
+    c_sum, RUN_SUM, "sum", "sum of values"}, {
+    c_count, RUN_COUNT, "count", "count of non-NULL values"}, {
+    c_var, RUN_VAR, "variance", "statistical variance"}, {
+    c_divr, RUN_NONE, "diversity", "number of different values"}, {
+    c_intr, RUN_NONE, "interspersion",
+	    "number of values different than center value"}, {
+    c_quart1, RUN_NONE, "quart1", "first quartile"}, {
+    c_quart3, RUN_NONE, "quart3", "third quartile"}, {
+    c_perc90, RUN_NONE, "perc90", "ninetieth percentile"}, {
+    c_quant, RUN_NONE, "quantile", "arbitrary quantile"}, {
+    NULL, RUN_NONE, NULL, NULL}
+};
+
+/* a slab of depths: the input depths it needs and its output values */
+struct slab
+{
+    const DCELL *in;		/* input depths z0 - z_dist ... */
+    DCELL *out;			/* output depths z0 ... */
+    stat_func *method_fn;
+    int running;
+    double shift;		/* subtracted from the values for variance */
+    double quantile;
 };
 
 /* ************************************************************************* */
@@ -100,7 +124,7 @@ static int find_method(const char *method_name)
 
 typedef struct
 {
-    struct Option *input, *output, *window, *method, *quantile;
+    struct Option *input, *output, *window, *method, *quantile, *nprocs;
 } paramType;
 
 paramType param;
@@ -136,35 +160,32 @@ static void set_params()
     param.window->description =
 	_("The size of the window in x, y and z direction,"
 	  " values must be odd integer numbers, eg: 3,3,3");
+
+    param.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
 }
 
 /* ************************************************************************* */
 
-static int gather_values(RASTER3D_Map * map, DCELL * buff, int x,
-			 int y, int z)
+static int gather_values(const DCELL * in, DCELL * buff, int x, int y,
+			 int dz)
 {
     int i, j, k, l;
     DCELL value;
 
-    int start_z = z - z_dist;
+    /* depths outside of the region are null in the slab */
+    int start_z = dz;
     int start_y = y - y_dist;
     int start_x = x - x_dist;
     int end_z = start_z + z_size;
     int end_y = start_y + y_size;
     int end_x = start_x + x_size;
 
-    if (start_z < 0)
-	start_z = 0;
-
     if (start_y < 0)
 	start_y = 0;
 
     if (start_x < 0)
 	start_x = 0;
 
-    if (end_z > nz)
-	end_z = nz;
-
     if (end_y > ny)
 	end_y = ny;
 
@@ -175,8 +196,10 @@ static int gather_values(RASTER3D_Map * map, DCELL * buff, int x,
 
     for (i = start_z; i < end_z; i++) {
 	for (j = start_y; j < end_y; j++) {
+	    const DCELL *row = in + ((size_t)i * ny + j) * nx;
+
 	    for (k = start_x; k < end_x; k++) {
-		value = (DCELL) Rast3d_get_double(map, k, j, i);
+		value = row[k];
 
 		if (Rast_is_d_null_value(&value))
 		    continue;
@@ -191,15 +214,194 @@ static int gather_values(RASTER3D_Map * map, DCELL * buff, int x,
 
 /* ************************************************************************* */
 
+/*
+ * Running sums: the values of the window columns (y and z of the
+ * window) are summed up once per column, the windows of a row then
+ * differ only by the column entering and the column leaving them.
+ */
+static void running_row(const struct slab *s, int y, int dz, DCELL * out,
+			DCELL * csum, DCELL * csq, int *ccnt)
+{
+    int i, j, x;
+    int start_y = y - y_dist;
+    int end_y = start_y + y_size;
+    DCELL sum, sq;
+    int cnt;
+
+    if (start_y < 0)
+	start_y = 0;
+    if (end_y > ny)
+	end_y = ny;
+
+    for (x = 0; x < nx; x++) {
+	csum[x] = csq[x] = 0.0;
+	ccnt[x] = 0;
+    }
+
+    for (i = dz; i < dz + z_size; i++) {
+	for (j = start_y; j < end_y; j++) {
+	    const DCELL *row = s->in + ((size_t)i * ny + j) * nx;
+
+	    for (x = 0; x < nx; x++) {
+		DCELL d;
+
+		if (Rast_is_d_null_value(&row[x]))
+		    continue;
+
+		d = row[x] - s->shift;
+		csum[x] += d;
+		csq[x] += d * d;
+		ccnt[x]++;
+	    }
+	}
+    }
+
+    sum = sq = 0.0;
+    cnt = 0;
+    for (x = 0; x < x_size - x_dist - 1 && x < nx; x++) {
+	sum += csum[x];
+	sq += csq[x];
+	cnt += ccnt[x];
+    }
+
+    for (x = 0; x < nx; x++) {
+	int enter = x - x_dist + x_size - 1;
+	int leave = x - x_dist - 1;
+
+	if (enter < nx) {
+	    sum += csum[enter];
+	    sq += csq[enter];
+	    cnt += ccnt[enter];
+	}
+	if (leave >= 0) {
+	    sum -= csum[leave];
+	    sq -= csq[leave];
+	    cnt -= ccnt[leave];
+	}
+
+	if (cnt == 0) {
+	    Rast_set_d_null_value(&out[x], 1);
+	    continue;
+	}
+
+	switch (s->running) {
+	case RUN_AVE:
+	    out[x] = s->shift + sum / cnt;
+	    break;
+	case RUN_SUM:
+	    out[x] = sum + s->shift * cnt;
+	    break;
+	case RUN_COUNT:
+	    out[x] = cnt;
+	    break;
+	default:{
+		/* the shift keeps the difference well conditioned */
+		DCELL var = (sq - sum * sum / cnt) / cnt;
+
+		if (var < 0)
+		    var = 0;
+		out[x] = s->running == RUN_VAR ? var : sqrt(var);
+		break;
+	    }
+	}
+    }
+}
+
+/* ************************************************************************* */
+
+/* compute the output rows first to last - 1 of a slab, row = dz * ny + y */
+static void slab_rows(int first, int last, void *closure)
+{
+    const struct slab *s = closure;
+    DCELL *buff = NULL, *csum = NULL, *csq = NULL;
+    int *ccnt = NULL;
+    int r, x;
+
+    if (s->running != RUN_NONE) {
+	csum = G_malloc(nx * sizeof(DCELL));
+	csq = G_malloc(nx * sizeof(DCELL));
+	ccnt = G_malloc(nx * sizeof(int));
+    }
+    else
+	buff = G_malloc(size * sizeof(DCELL));
+
+    for (r = first; r < last; r++) {
+	int dz = r / ny;
+	int y = r % ny;
+	DCELL *out = s->out + (size_t)r * nx;
+
+	if (s->running != RUN_NONE) {
+	    running_row(s, y, dz, out, csum, csq, ccnt);
+	    continue;
+	}
+
+	for (x = 0; x < nx; x++) {
+	    /* Gather values in moving window */
+	    int num = gather_values(s->in, buff, x, y, dz);
+
+	    /* Compute the resulting value */
+	    if (num > 0)
+		(*s->method_fn) (&out[x], buff, num, &s->quantile);
+	    else
+		Rast_set_d_null_value(&out[x], 1);
+	}
+    }
+
+    if (buff)
+	G_free(buff);
+    if (csum) {
+	G_free(csum);
+	G_free(csq);
+	G_free(ccnt);
+    }
+}
+
+/* ************************************************************************* */
+
+/* write the layer of tiles tz from the output depths of a slab */
+static void write_tiles(RASTER3D_Map * map, const DCELL * out, int tz,
+			DCELL * tile)
+{
+    int tileX, tileY, tileZ, ntx, nty, ntz;
+    int tx, ty, x, y, z;
+
+    Rast3d_get_tile_dimensions_map(map, &tileX, &tileY, &tileZ);
+    Rast3d_get_nof_tiles_map(map, &ntx, &nty, &ntz);
+
+    for (ty = 0; ty < nty; ty++) {
+	for (tx = 0; tx < ntx; tx++) {
+	    int index = Rast3d_tile2tile_index(map, tx, ty, tz);
+
+	    Rast3d_set_null_value(tile, tileX * tileY * tileZ, DCELL_TYPE);
+	    for (z = 0; z < tileZ && tz * tileZ + z < nz; z++) {
+		for (y = 0; y < tileY && ty * tileY + y < ny; y++) {
+		    const DCELL *row =
+			out + ((size_t)z * ny + ty * tileY + y) * nx;
+
+		    for (x = 0; x < tileX && tx * tileX + x < nx; x++)
+			tile[(z * tileY + y) * tileX + x] = row[tx * tileX + x];
+		}
+	    }
+
+	    if (!Rast3d_write_tile_double(map, index, tile))
+		Rast3d_fatal_error(_("Error writing tile %d"), index);
+	}
+    }
+}
+
+/* ************************************************************************* */
+
 int main(int argc, char **argv)
 {
     RASTER3D_Map *input;
     RASTER3D_Map *output;
     RASTER3D_Region region;
     struct GModule *module;
-    stat_func *method_fn;
-    double quantile;
-    int x, y, z;
+    struct slab slab;
+    DCELL *in, *out, *tile;
+    double min, max;
+    int method, tileX, tileY, tileZ, ntx, nty, ntz, tz, nd, keep;
+    size_t plane;
 
     /* Initialize GRASS */
     G_gisinit(argv[0]);
@@ -225,6 +427,8 @@ int main(int argc, char **argv)
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(param.nprocs);
+
     if (NULL == G_find_raster3d(param.input->answer, ""))
 	Rast3d_fatal_error(_("3D raster map <%s> not found"),
 			   param.input->answer);
@@ -250,68 +454,86 @@ int main(int argc, char **argv)
     size = x_size * y_size * z_size;
 
     /* Set the computation method */
-    method_fn = menu[find_method(param.method->answer)].method;
+    method = find_method(param.method->answer);
+    slab.method_fn = menu[method].method;
+    slab.running = menu[method].running;
 
     if (param.quantile->answer)
-	quantile = atof(param.quantile->answer);
+	slab.quantile = atof(param.quantile->answer);
     else
-	quantile = 0.0;
+	slab.quantile = 0.0;
 
+    /* the input is read in layers of tiles */
     input = Rast3d_open_cell_old(param.input->answer,
 				 G_find_raster3d(param.input->answer, ""),
 				 &region, RASTER3D_TILE_SAME_AS_FILE,
-				 RASTER3D_USE_CACHE_DEFAULT);
+				 RASTER3D_USE_CACHE_XY);
 
     if (input == NULL)
 	Rast3d_fatal_error(_("Unable to open 3D raster map <%s>"),
 			   param.input->answer);
 
+    /* the output is written tile by tile */
     output =
 	Rast3d_open_new_opt_tile_size(param.output->answer,
-				      RASTER3D_USE_CACHE_X, &region,
+				      RASTER3D_NO_CACHE, &region,
 				      DCELL_TYPE, 32);
 
     if (output == NULL)
 	Rast3d_fatal_error(_("Unable to open 3D raster map <%s>"),
 			   param.output->answer);
 
-    Rast3d_min_unlocked(output, RASTER3D_USE_CACHE_X);
-    Rast3d_autolock_on(output);
-    Rast3d_unlock_all(output);
+    /* variances are summed up relative to the middle of the range */
+    slab.shift = 0.0;
+    if ((slab.running == RUN_VAR || slab.running == RUN_STDDEV) &&
+	Rast3d_range_load(input)) {
+	Rast3d_range_min_max(input, &min, &max);
+	if (!Rast_is_d_null_value(&min))
+	    slab.shift = (min + max) / 2;
+    }
 
-    DCELL *buff = NULL, value;
+    /* a slab is one layer of output tiles, the input depths around it
+       are kept in memory */
+    Rast3d_get_tile_dimensions_map(output, &tileX, &tileY, &tileZ);
+    Rast3d_get_nof_tiles_map(output, &ntx, &nty, &ntz);
+    nd = tileZ + 2 * z_dist;
+    keep = 2 * z_dist;
+    plane = (size_t)nx * ny;
+
+    in = G_malloc(nd * plane * sizeof(DCELL));
+    out = G_malloc(tileZ * plane * sizeof(DCELL));
+    tile = Rast3d_alloc_tiles_type(output, 1, DCELL_TYPE);
+    if (tile == NULL)
+	Rast3d_fatal_error(_("Unable to allocate buffer"));
 
-    buff = (DCELL *) calloc(size, sizeof(DCELL));
+    slab.in = in;
+    slab.out = out;
 
-    if (buff == NULL)
-	Rast3d_fatal_error(_("Unable to allocate buffer"));
+    for (tz = 0; tz < ntz; tz++) {
+	int z0 = tz * tileZ;
+	int depths = nz - z0 < tileZ ? nz - z0 : tileZ;
 
-    for (z = 0; z < nz; z++) {
-	G_percent(z, nz, 1);
-	for (y = 0; y < ny; y++) {
-	    for (x = 0; x < nx; x++) {
-		/* Gather values in moving window */
-		int num = gather_values(input, buff, x, y, z);
-
-		/* Compute the resulting value */
-		if (num > 0)
-		    (*method_fn) (&value, buff, num, &quantile);
-		else
-		    Rast_set_d_null_value(&value, 1);
-		/* Write the value */
-		Rast3d_put_double(output, x, y, z, value);
-	    }
+	G_percent(z0, nz, 1);
+
+	/* the depths shared with the previous slab are moved, not read */
+	if (tz > 0 && keep > 0) {
+	    memmove(in, in + tileZ * plane, keep * plane * sizeof(DCELL));
+	    Rast3d_get_block(input, 0, 0, z0 - z_dist + keep, nx, ny,
+			     nd - keep, in + keep * plane, DCELL_TYPE);
 	}
-    }
-    G_percent(z, nz, 1);
+	else
+	    Rast3d_get_block(input, 0, 0, z0 - z_dist, nx, ny, nd, in,
+			     DCELL_TYPE);
 
-    free(buff);
+	G_parallel_for(0, depths * ny, 0, slab_rows, &slab);
 
-    if (!Rast3d_flush_all_tiles(output))
-	G_fatal_error(_("Error flushing tiles"));
+	write_tiles(output, out, tz, tile);
+    }
+    G_percent(nz, nz, 1);
 
-    Rast3d_autolock_off(output);
-    Rast3d_unlock_all(output);
+    G_free(in);
+    G_free(out);
+    Rast3d_free_tiles(tile);
 
     Rast3d_close(input);
     Rast3d_close(output);
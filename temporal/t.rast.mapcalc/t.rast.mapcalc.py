@@ -57,7 +57,7 @@
 #%option
 #% key: nprocs
 #% type: integer
-#% description: Number of r.mapcalc processes to run in parallel
+#% description: Number of threads of r.mapcalc, or r3.mapcalc processes to run in parallel
 #% required: no
 #% multiple: no
 #% answer: 1
@@ -211,6 +211,8 @@ def main():
 
     # Register the maps in the database
     count = 0
+    statement = ""
+    register_list = []
     for map in new_maps:
         count += 1
 
@@ -226,8 +228,12 @@ def main():
                 continue
 
         # Insert map in temporal database
-        map.insert(dbif)
-        new_sp.register_map(map, dbif)
+        statement += map.insert(dbif, execute=False)
+        register_list.append(map)
+
+    if statement:
+        dbif.execute_transaction(statement)
+    new_sp.register_maps(register_list, dbif)
 
     # Update the spatio-temporal extent and the metadata table entries
     new_sp.update_from_registered_maps(dbif)
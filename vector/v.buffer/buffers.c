@@ -0,0 +1,292 @@
+/****************************************************************
+ *
+ * MODULE:       v.buffer
+ *
+ * PURPOSE:      Buffers of blocks of features on several threads
+ *
+ * COPYRIGHT:    (C) 2019 by the GRASS Development Team
+ *
+ *               This program is free software under the GNU General
+ *               Public License (>=v2). Read the file COPYING that
+ *               comes with GRASS for details.
+ *
+ **************************************************************/
+#include <grass/gis.h>
+#include <grass/vector.h>
+#include <grass/glocale.h>
+#include "local_proto.h"
+
+/* The features are read on the main thread and added to a block, the
+ * buffers of the block are computed on several threads and written in
+ * the order of the features, as if computed one by one: the output
+ * does not depend on the number of threads. */
+
+void buf_block_init(struct buf_block *blk, int straight, int nocaps,
+		    int use_geos)
+{
+    G_zero(blk, sizeof(struct buf_block));
+    blk->straight = straight;
+    blk->nocaps = nocaps;
+    blk->use_geos = use_geos;
+}
+
+static struct buf_job *new_job(struct buf_block *blk, int kind, int id,
+			       int ltype, const struct line_cats *CCats,
+			       double da, double db, double dalpha, double tol)
+{
+    struct buf_job *job;
+    int i;
+
+    if (blk->n == blk->alloc) {
+	blk->alloc += 64;
+	blk->jobs = G_realloc(blk->jobs, blk->alloc * sizeof(struct buf_job));
+	for (i = blk->n; i < blk->alloc; i++) {
+	    job = &blk->jobs[i];
+	    job->Points = Vect_new_line_struct();
+	    job->CCats = Vect_new_cats_struct();
+	    job->isles = NULL;
+	    job->nisles = job->isles_alloc = 0;
+	    job->bc = NULL;
+	    job->nbc = job->bc_alloc = 0;
+	}
+    }
+
+    job = &blk->jobs[blk->n++];
+    job->kind = kind;
+    job->id = id;
+    job->ltype = ltype;
+    Vect_reset_cats(job->CCats);
+    for (i = 0; i < CCats->n_cats; i++)
+	Vect_cat_set(job->CCats, CCats->field[i], CCats->cat[i]);
+    job->da = da;
+    job->db = db;
+    job->dalpha = dalpha;
+    job->tol = tol;
+    job->nisles = 0;
+    job->nbc = 0;
+    job->status = BUF_OK;
+    job->warning = 0;
+
+    return job;
+}
+
+/* add a buffer to the result of a job */
+struct buf_contours_pts *buf_job_new_contours(struct buf_job *job)
+{
+    struct buf_contours_pts *bc;
+
+    if (job->nbc == job->bc_alloc) {
+	job->bc_alloc += 4;
+	job->bc = G_realloc(job->bc,
+			    job->bc_alloc * sizeof(struct buf_contours_pts));
+    }
+    bc = &job->bc[job->nbc++];
+    bc->oPoints = Vect_new_line_struct();
+    bc->iPoints = NULL;
+    bc->inner_count = 0;
+
+    return bc;
+}
+
+/* add the buffer of a point or a line, Points is pruned */
+void buf_block_add_line(struct buf_block *blk, int kind, int line, int ltype,
+			const struct line_pnts *Points,
+			const struct line_cats *CCats, double da, double db,
+			double dalpha, double tol)
+{
+    struct buf_job *job = new_job(blk, kind, line, ltype, CCats, da, db,
+				  dalpha, tol);
+
+    Vect_reset_line(job->Points);
+    Vect_append_points(job->Points, Points, GV_FORWARD);
+}
+
+/* add the buffer of an area */
+void buf_block_add_area(struct buf_block *blk, struct Map_info *In,
+			int area, const struct line_cats *CCats, double da,
+			double db, double dalpha, double tol)
+{
+    struct buf_job *job = new_job(blk, BUF_AREA, area, GV_AREA, CCats, da,
+				  db, dalpha, tol);
+    int i, isle, nisles;
+
+    Vect_get_area_points(In, area, job->Points);
+
+    nisles = Vect_get_area_num_isles(In, area);
+    if (nisles > job->isles_alloc) {
+	job->isles = G_realloc(job->isles,
+			       nisles * sizeof(struct line_pnts *));
+	for (i = job->isles_alloc; i < nisles; i++)
+	    job->isles[i] = Vect_new_line_struct();
+	job->isles_alloc = nisles;
+    }
+    for (i = 0; i < nisles; i++) {
+	isle = Vect_get_area_isle(In, area, i);
+	if (isle < 1)
+	    continue;
+	Vect_get_isle_points(In, isle, job->isles[job->nisles++]);
+    }
+}
+
+static void buffer_jobs(int first, int last, void *closure)
+{
+    struct buf_block *blk = closure;
+    int i;
+
+#ifdef HAVE_GEOS
+    GEOSContextHandle_t handle = NULL;
+
+    if (blk->use_geos)
+	handle = initGEOS_r(NULL, NULL);
+#endif
+
+    for (i = first; i < last; i++) {
+	struct buf_job *job = &blk->jobs[i];
+	const struct line_pnts *Points = job->Points;
+	struct buf_contours_pts *bc;
+	double da = job->da;
+
+#ifdef HAVE_GEOS
+	if (blk->use_geos && job->kind != BUF_POINT) {
+	    geos_buffer(handle, job, blk->straight, blk->nocaps);
+	    continue;
+	}
+#endif
+	bc = buf_job_new_contours(job);
+
+	switch (job->kind) {
+	case BUF_POINT:
+	    if (blk->straight) {
+		Vect_append_point(bc->oPoints, Points->x[0] + da,
+				  Points->y[0] + da, 0);
+		Vect_append_point(bc->oPoints, Points->x[0] + da,
+				  Points->y[0] - da, 0);
+		Vect_append_point(bc->oPoints, Points->x[0] - da,
+				  Points->y[0] - da, 0);
+		Vect_append_point(bc->oPoints, Points->x[0] - da,
+				  Points->y[0] + da, 0);
+		Vect_append_point(bc->oPoints, bc->oPoints->x[0],
+				  bc->oPoints->y[0], bc->oPoints->z[0]);
+	    }
+	    else {
+		Vect_destroy_line_struct(bc->oPoints);
+		Vect_point_buffer2(Points->x[0], Points->y[0], da, job->db,
+				   job->dalpha, 1, job->tol, &(bc->oPoints));
+	    }
+	    break;
+	case BUF_LINE:
+	    Vect_destroy_line_struct(bc->oPoints);
+	    Vect_line_buffer2(Points, da, job->db, job->dalpha,
+			      !blk->straight, !blk->nocaps, job->tol,
+			      &(bc->oPoints), &(bc->iPoints),
+			      &(bc->inner_count));
+	    break;
+	case BUF_AREA:
+	    Vect_destroy_line_struct(bc->oPoints);
+	    Vect_polygon_buffer2(job->Points, job->isles, job->nisles, da,
+				 job->db, job->dalpha, !blk->straight,
+				 !blk->nocaps, job->tol, &(bc->oPoints),
+				 &(bc->iPoints), &(bc->inner_count));
+	    break;
+	}
+    }
+
+#ifdef HAVE_GEOS
+    if (handle)
+	finishGEOS_r(handle);
+#endif
+}
+
+static void job_errors(const struct buf_job *job)
+{
+    switch (job->status) {
+    case BUF_FAILED:
+	G_fatal_error(_("Buffering failed (feature %d)"), job->id);
+	break;
+    case BUF_CORRUPT:
+	G_fatal_error(_("Corrupt GEOS geometry"));
+	break;
+    case BUF_INVALID_COOR:
+	G_fatal_error(_("Invalid coordinate in the buffer of feature %d"),
+		      job->id);
+	break;
+    case BUF_UNKNOWN:
+	G_fatal_error(_("Unknown GEOS geometry type"));
+	break;
+    }
+
+    if (job->warning == BUF_INVALID)
+	G_warning(_("Invalid GEOS geometry!"));
+    else if (job->warning == BUF_EMPTY)
+	G_warning(_("No coordinates in GEOS geometry (can be ok for negative distance)!"));
+}
+
+/* compute the buffers of the block and write them */
+void buf_block_flush(struct buf_block *blk, struct Map_info *Out,
+		     struct Map_info *Buf, struct line_cats *BCats,
+		     struct spatial_index *si, struct buf_contours **arr_bc,
+		     int *buffers_count, int *arr_bc_alloc)
+{
+    struct bound_box bbox;
+    int i, j, k, line_id;
+
+    G_parallel_for(0, blk->n, 0, buffer_jobs, blk);
+
+    for (i = 0; i < blk->n; i++) {
+	struct buf_job *job = &blk->jobs[i];
+
+	job_errors(job);
+
+	for (k = 0; k < job->nbc; k++) {
+	    struct buf_contours_pts *bc = &job->bc[k];
+	    struct buf_contours *c;
+
+	    if (*buffers_count >= *arr_bc_alloc) {
+		*arr_bc_alloc += 100;
+		*arr_bc = G_realloc(*arr_bc,
+				    *arr_bc_alloc * sizeof(struct buf_contours));
+	    }
+	    c = &(*arr_bc)[*buffers_count];
+
+	    Vect_write_line(Out, GV_BOUNDARY, bc->oPoints, BCats);
+	    line_id = Vect_write_line(Buf, GV_BOUNDARY, bc->oPoints, job->CCats);
+	    Vect_destroy_line_struct(bc->oPoints);
+	    /* add buffer to spatial index */
+	    Vect_get_line_box(Buf, line_id, &bbox);
+	    Vect_spatial_index_add_item(si, *buffers_count, &bbox);
+	    c->outer = line_id;
+
+	    c->inner_count = bc->inner_count;
+	    c->inner = NULL;
+	    if (bc->inner_count > 0) {
+		c->inner = G_malloc(bc->inner_count * sizeof(int));
+		for (j = 0; j < bc->inner_count; j++) {
+		    Vect_write_line(Out, GV_BOUNDARY, bc->iPoints[j], BCats);
+		    line_id = Vect_write_line(Buf, GV_BOUNDARY, bc->iPoints[j], BCats);
+		    Vect_destroy_line_struct(bc->iPoints[j]);
+		    c->inner[j] = line_id;
+		}
+	    }
+	    if (bc->iPoints)
+		G_free(bc->iPoints);
+	    (*buffers_count)++;
+	}
+    }
+
+    blk->n = 0;
+}
+
+void buf_block_free(struct buf_block *blk)
+{
+    int i, j;
+
+    for (i = 0; i < blk->alloc; i++) {
+	Vect_destroy_line_struct(blk->jobs[i].Points);
+	Vect_destroy_cats_struct(blk->jobs[i].CCats);
+	for (j = 0; j < blk->jobs[i].isles_alloc; j++)
+	    Vect_destroy_line_struct(blk->jobs[i].isles[j]);
+	G_free(blk->jobs[i].isles);
+	G_free(blk->jobs[i].bc);
+    }
+    G_free(blk->jobs);
+}
@@ -6,153 +6,169 @@
 
 #ifdef HAVE_GEOS
 
-static int ring2pts(const GEOSGeometry *geom, struct line_pnts *Points)
+/* GEOS buffers are computed on several threads, each with its own GEOS
+ * context: the input geometry is built from the coordinates read on the
+ * main thread and the rings of the buffer are copied to line_pnts
+ * before the geometries are destroyed. Threads do not print, errors
+ * are reported by buf_block_flush(). */
+
+static int ring2pts(GEOSContextHandle_t handle, const GEOSGeometry *geom,
+		    struct line_pnts *Points, struct buf_job *job)
 {
     int i, ncoords;
     double x, y, z;
     const GEOSCoordSequence *seq = NULL;
 
-    G_debug(3, "ring2pts()");
-
     Vect_reset_line(Points);
     if (!geom) {
-	G_warning(_("Invalid GEOS geometry!"));
+	job->warning = BUF_INVALID;
 	return 0;
     }
     z = 0.0;
-    ncoords = GEOSGetNumCoordinates(geom);
+    ncoords = GEOSGetNumCoordinates_r(handle, geom);
     if (!ncoords) {
-	G_warning(_("No coordinates in GEOS geometry (can be ok for negative distance)!"));
+	job->warning = BUF_EMPTY;
 	return 0;
     }
-    seq = GEOSGeom_getCoordSeq(geom);
+    seq = GEOSGeom_getCoordSeq_r(handle, geom);
     for (i = 0; i < ncoords; i++) {
-	GEOSCoordSeq_getX(seq, i, &x);
-	GEOSCoordSeq_getY(seq, i, &y);
-	if (x != x || x > DBL_MAX || x < -DBL_MAX)
-	    G_fatal_error(_("Invalid x coordinate %f"), x);
-	if (y != y || y > DBL_MAX || y < -DBL_MAX)
-	    G_fatal_error(_("Invalid y coordinate %f"), y);
+	GEOSCoordSeq_getX_r(handle, seq, i, &x);
+	GEOSCoordSeq_getY_r(handle, seq, i, &y);
+	if (x != x || x > DBL_MAX || x < -DBL_MAX ||
+	    y != y || y > DBL_MAX || y < -DBL_MAX) {
+	    job->status = BUF_INVALID_COOR;
+	    return 0;
+	}
 	Vect_append_point(Points, x, y, z);
     }
 
     return 1;
 }
 
-static int geom2ring(GEOSGeometry *geom, struct Map_info *Out,
-                     struct Map_info *Buf,
-                     struct spatial_index *si,
-		     struct line_cats *Cats,
-		     struct buf_contours **arr_bc,
-		     int *buffers_count, int *arr_bc_alloc)
+static void geom2rings(GEOSContextHandle_t handle, const GEOSGeometry *geom,
+		       struct buf_job *job)
 {
-    int i, nrings, ngeoms, line_id;
-    const GEOSGeometry *geom2;
-    struct bound_box bbox;
-    static struct line_pnts *Points = NULL;
-    static struct line_cats *BCats = NULL;
-    struct buf_contours *p = *arr_bc;
-
-    G_debug(3, "geom2ring(): GEOS %s", GEOSGeomType(geom));
-
-    if (!Points)
-	Points = Vect_new_line_struct();
-    if (!BCats)
-	BCats = Vect_new_cats_struct();
-
-    if (GEOSGeomTypeId(geom) == GEOS_LINESTRING ||
-        GEOSGeomTypeId(geom) == GEOS_LINEARRING) {
-
-	if (!ring2pts(geom, Points))
-	    return 0;
+    int i, nrings, ngeoms, type;
+    struct buf_contours_pts *bc;
+
+    type = GEOSGeomTypeId_r(handle, geom);
+
+    if (type == GEOS_LINESTRING || type == GEOS_LINEARRING ||
+	type == GEOS_POLYGON) {
+	bc = buf_job_new_contours(job);
+	if (!ring2pts(handle, type == GEOS_POLYGON ?
+		      GEOSGetExteriorRing_r(handle, geom) : geom,
+		      bc->oPoints, job)) {
+	    job->nbc--;
+	    return;
+	}
+	if (type != GEOS_POLYGON)
+	    return;
 
-	Vect_write_line(Out, GV_BOUNDARY, Points, BCats);
-	line_id = Vect_write_line(Buf, GV_BOUNDARY, Points, Cats);
-	/* add buffer to spatial index */
-	Vect_get_line_box(Buf, line_id, &bbox);
-	Vect_spatial_index_add_item(si, *buffers_count, &bbox);
-	p[*buffers_count].outer = line_id;
-
-	p[*buffers_count].inner_count = 0;
-	*buffers_count += 1;
-	if (*buffers_count >= *arr_bc_alloc) {
-	    *arr_bc_alloc += 100;
-	    p = G_realloc(p, *arr_bc_alloc * sizeof(struct buf_contours));
-	    *arr_bc = p;
+	nrings = GEOSGetNumInteriorRings_r(handle, geom);
+	if (nrings > 0) {
+	    bc->iPoints = G_malloc(nrings * sizeof(struct line_pnts *));
+	    for (i = 0; i < nrings; i++) {
+		bc->iPoints[i] = Vect_new_line_struct();
+		bc->inner_count++;
+		if (!ring2pts(handle, GEOSGetInteriorRingN_r(handle, geom, i),
+			      bc->iPoints[i], job)) {
+		    if (job->status == BUF_OK)
+			job->status = BUF_CORRUPT;
+		    return;
+		}
+	    }
 	}
     }
-    else if (GEOSGeomTypeId(geom) == GEOS_POLYGON) {
-	geom2 = GEOSGetExteriorRing(geom);
-	if (!ring2pts(geom2, Points))
-	    return 0;
+    else if (type == GEOS_MULTILINESTRING || type == GEOS_MULTIPOLYGON ||
+	     type == GEOS_GEOMETRYCOLLECTION) {
+	ngeoms = GEOSGetNumGeometries_r(handle, geom);
+	for (i = 0; i < ngeoms && job->status == BUF_OK; i++)
+	    geom2rings(handle, GEOSGetGeometryN_r(handle, geom, i), job);
+    }
+    else
+	job->status = BUF_UNKNOWN;
+}
 
-	Vect_write_line(Out, GV_BOUNDARY, Points, BCats);
-	line_id = Vect_write_line(Buf, GV_BOUNDARY, Points, Cats);
-	/* add buffer to spatial index */
-	Vect_get_line_box(Buf, line_id, &bbox);
-	Vect_spatial_index_add_item(si, *buffers_count, &bbox);
-	p[*buffers_count].outer = line_id;
-	p[*buffers_count].inner_count = 0;
+static GEOSCoordSequence *pts2seq(GEOSContextHandle_t handle,
+				  const struct line_pnts *Points)
+{
+    GEOSCoordSequence *pseq;
+    int i;
 
-	nrings = GEOSGetNumInteriorRings(geom);
-	
-	if (nrings > 0) {
+    pseq = GEOSCoordSeq_create_r(handle, Points->n_points, 2);
+    for (i = 0; i < Points->n_points; i++) {
+	GEOSCoordSeq_setX_r(handle, pseq, i, Points->x[i]);
+	GEOSCoordSeq_setY_r(handle, pseq, i, Points->y[i]);
+    }
 
-	    p[*buffers_count].inner_count = nrings;
-	    p[*buffers_count].inner = G_malloc(nrings * sizeof(int));
+    return pseq;
+}
 
-	    for (i = 0; i < nrings; i++) {
-		geom2 = GEOSGetInteriorRingN(geom, i);
-		if (!ring2pts(geom2, Points)) {
-		    G_fatal_error(_("Corrupt GEOS geometry"));
-		}
-		Vect_write_line(Out, GV_BOUNDARY, Points, BCats);
-		line_id = Vect_write_line(Buf, GV_BOUNDARY, Points, BCats);
-		p[*buffers_count].inner[i] = line_id;
+/* geometry of a line or an area as from Vect_read_line_geos() and
+ * Vect_read_area_geos() */
+static GEOSGeometry *job2geom(GEOSContextHandle_t handle,
+			      const struct buf_job *job)
+{
+    GEOSGeometry *geom, *shell, **holes;
+    GEOSCoordSequence *pseq, *rseq;
+    int i, nholes;
+
+    if (job->kind == BUF_AREA) {
+	shell = GEOSGeom_createLinearRing_r(handle,
+					    pts2seq(handle, job->Points));
+	if (!shell)
+	    return NULL;
+
+	holes = G_malloc(job->nisles * sizeof(GEOSGeometry *));
+	for (i = nholes = 0; i < job->nisles; i++) {
+	    holes[nholes] =
+		GEOSGeom_createLinearRing_r(handle,
+					    pts2seq(handle, job->isles[i]));
+	    if (!holes[nholes]) {
+		for (i = 0; i < nholes; i++)
+		    GEOSGeom_destroy_r(handle, holes[i]);
+		G_free(holes);
+		GEOSGeom_destroy_r(handle, shell);
+		return NULL;
 	    }
+	    nholes++;
 	}
-	*buffers_count += 1;
-	if (*buffers_count >= *arr_bc_alloc) {
-	    *arr_bc_alloc += 100;
-	    p = G_realloc(p, *arr_bc_alloc * sizeof(struct buf_contours));
-	    *arr_bc = p;
-	}
+
+	geom = GEOSGeom_createPolygon_r(handle, shell, holes, nholes);
+	G_free(holes);
+
+	return geom;
     }
-    else if (GEOSGeomTypeId(geom) == GEOS_MULTILINESTRING ||
-             GEOSGeomTypeId(geom) == GEOS_MULTIPOLYGON ||
-	     GEOSGeomTypeId(geom) == GEOS_GEOMETRYCOLLECTION) {
 
-	G_debug(3, "GEOS %s", GEOSGeomType(geom));
+    pseq = pts2seq(handle, job->Points);
+    if (job->ltype & GV_LINE)
+	return GEOSGeom_createLineString_r(handle, pseq);
 
-	ngeoms = GEOSGetNumGeometries(geom);
-	for (i = 0; i < ngeoms; i++) {
-	    geom2 = GEOSGetGeometryN(geom, i);
-	    geom2ring((GEOSGeometry *)geom2, Out, Buf, si, Cats,
-	              arr_bc, buffers_count, arr_bc_alloc);
-	}
+    /* boundary */
+    rseq = GEOSCoordSeq_clone_r(handle, pseq);
+    geom = GEOSGeom_createLineString_r(handle, pseq);
+    if (geom && GEOSisRing_r(handle, geom) == 1) {
+	GEOSGeom_destroy_r(handle, geom);
+	return GEOSGeom_createLinearRing_r(handle, rseq);
     }
-    else
-	G_fatal_error(_("Unknown GEOS geometry type"));
+    GEOSCoordSeq_destroy_r(handle, rseq);
 
-    return 1;
+    return geom;
 }
 
-int geos_buffer(struct Map_info *In, struct Map_info *Out,
-                struct Map_info *Buf, int id, int type, double da,
-		struct spatial_index *si,
-		struct line_cats *Cats,
-		struct buf_contours **arr_bc,
-		int *buffers_count, int *arr_bc_alloc, int flat, int no_caps)
+/* buffer of a line or an area of a block */
+void geos_buffer(GEOSContextHandle_t handle, struct buf_job *job, int flat,
+		 int no_caps)
 {
     GEOSGeometry *IGeom = NULL;
     GEOSGeometry *OGeom = NULL;
-    
-    G_debug(3, "geos_buffer(): id=%d", id);
 
-    if (type == GV_AREA)
-	IGeom = Vect_read_area_geos(In, id);
-    else
-	IGeom = Vect_read_line_geos(In, id, &type);
+    IGeom = job2geom(handle, job);
+    if (!IGeom) {
+	job->status = BUF_FAILED;
+	return;
+    }
 
     /* GEOS code comment on the number of quadrant segments:
      * A value of 8 gives less than 2% max error in the buffer distance.
@@ -160,32 +176,28 @@ int geos_buffer(struct Map_info *In, struct Map_info *Out,
      * For a max error of < 0.1%, use QS = 18. */
 #ifdef GEOS_3_3
     if (flat || no_caps) {
-        GEOSBufferParams* geos_params = GEOSBufferParams_create();
-        GEOSBufferParams_setEndCapStyle(geos_params,
-                                        no_caps ? GEOSBUF_CAP_FLAT : GEOSBUF_CAP_SQUARE);
+        GEOSBufferParams* geos_params = GEOSBufferParams_create_r(handle);
+        GEOSBufferParams_setEndCapStyle_r(handle, geos_params,
+                                          no_caps ? GEOSBUF_CAP_FLAT : GEOSBUF_CAP_SQUARE);
 
-        OGeom = GEOSBufferWithParams(IGeom, geos_params, da);
-        GEOSBufferParams_destroy(geos_params);
+        OGeom = GEOSBufferWithParams_r(handle, IGeom, geos_params, job->da);
+        GEOSBufferParams_destroy_r(handle, geos_params);
     }
     else {
-        OGeom = GEOSBuffer(IGeom, da, 12);
+        OGeom = GEOSBuffer_r(handle, IGeom, job->da, 12);
     }
 #else
-    OGeom = GEOSBuffer(IGeom, da, 12);
+    OGeom = GEOSBuffer_r(handle, IGeom, job->da, 12);
 #endif
-    
-    if (!OGeom) {
-        G_fatal_error(_("Buffering failed (feature %d)"), id);
-    }
-    
-    geom2ring(OGeom, Out, Buf, si, Cats, arr_bc, buffers_count, arr_bc_alloc);
 
-    if (IGeom)
-	GEOSGeom_destroy(IGeom);
-    if (OGeom)
-	GEOSGeom_destroy(OGeom);
+    if (!OGeom)
+	job->status = BUF_FAILED;
+    else
+	geom2rings(handle, OGeom, job);
 
-    return 1;
+    GEOSGeom_destroy_r(handle, IGeom);
+    if (OGeom)
+	GEOSGeom_destroy_r(handle, OGeom);
 }
 
 #endif /* HAVE_GEOS */
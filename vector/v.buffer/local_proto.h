@@ -16,12 +16,59 @@ struct buf_contours_pts
     struct line_pnts **iPoints;
 };
 
+/* buffers.c */
+#define BUF_POINT 0
+#define BUF_LINE  1
+#define BUF_AREA  2
+
+/* features buffered at once */
+#define BUF_BLOCK_SIZE 1024
+
+struct buf_job
+{
+    int kind;			/* BUF_POINT, BUF_LINE or BUF_AREA */
+    int id, ltype;		/* feature id and type */
+    struct line_pnts *Points;	/* point, line or outer ring of the area */
+    struct line_pnts **isles;
+    int nisles, isles_alloc;
+    struct line_cats *CCats;
+    double da, db, dalpha, tol;
+    struct buf_contours_pts *bc;	/* the buffers */
+    int nbc, bc_alloc;
+    int status;			/* BUF_OK or error of GEOS buffering */
+    int warning;		/* 0 or BUF_EMPTY, BUF_INVALID */
+};
+
+struct buf_block
+{
+    struct buf_job *jobs;
+    int n, alloc;
+    int straight, nocaps, use_geos;
+};
+
+void buf_block_init(struct buf_block *, int, int, int);
+void buf_block_add_line(struct buf_block *, int, int, int,
+			const struct line_pnts *, const struct line_cats *,
+			double, double, double, double);
+void buf_block_add_area(struct buf_block *, struct Map_info *, int,
+			const struct line_cats *, double, double, double,
+			double);
+struct buf_contours_pts *buf_job_new_contours(struct buf_job *);
+void buf_block_flush(struct buf_block *, struct Map_info *,
+		     struct Map_info *, struct line_cats *,
+		     struct spatial_index *, struct buf_contours **, int *,
+		     int *);
+void buf_block_free(struct buf_block *);
+
+/* geos.c */
+#define BUF_OK           0
+#define BUF_FAILED       1	/* buffering failed */
+#define BUF_CORRUPT      2	/* invalid inner ring */
+#define BUF_INVALID_COOR 3	/* invalid coordinate */
+#define BUF_UNKNOWN      4	/* unknown geometry type */
+#define BUF_EMPTY        5	/* no coordinates in a ring */
+#define BUF_INVALID      6	/* invalid geometry */
+
 #ifdef HAVE_GEOS
-int geos_buffer(struct Map_info *, struct Map_info *,
-                struct Map_info *, int, int, double,
-		struct spatial_index *,
-		struct line_cats *,
-		struct buf_contours **,
-		int *, int *, int, int);
+void geos_buffer(GEOSContextHandle_t, struct buf_job *, int, int);
 #endif
-
@@ -190,7 +190,8 @@ int main(int argc, char *argv[])
 	          *angle_opt;
     struct Flag *straight_flag, *nocaps_flag, *cats_flag;
     struct Option *tol_opt, *bufcol_opt, *scale_opt, *field_opt,
-		  *where_opt, *cats_opt;
+		  *where_opt, *cats_opt, *nprocs_opt;
+    struct buf_block blk;
 
     struct cat_list *cat_list = NULL;
     int verbose, use_geos;
@@ -201,10 +202,8 @@ int main(int argc, char *argv[])
     int field;
     struct buf_contours *arr_bc;
     int arr_bc_alloc;
-    struct buf_contours_pts arr_bc_pts;
-    int line_id, buffers_count = 0;
+    int buffers_count = 0;
     struct spatial_index si;
-    struct bound_box bbox;
 
     /* Attributes if sizecol is used */
     int nrec, ctype;
@@ -304,6 +303,8 @@ int main(int argc, char *argv[])
     cats_flag->key = 't';
     cats_flag->description = _("Transfer categories and attributes");
     cats_flag->guisection = _("Attributes");
+
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
     
     G_gisinit(argv[0]);
     
@@ -311,6 +312,7 @@ int main(int argc, char *argv[])
 	exit(EXIT_FAILURE);
 
     verbose = G_verbose();
+    G_set_nprocs(nprocs_opt);
 #if !defined HAVE_GEOS
     use_geos = FALSE;
 #else
@@ -486,10 +488,10 @@ int main(int argc, char *argv[])
     arr_bc = G_calloc(arr_bc_alloc, sizeof(struct buf_contours));
 
     Vect_spatial_index_init(&si, 0);
+    buf_block_init(&blk, straight_flag->answer, nocaps_flag->answer,
+		   use_geos);
 
 #ifdef HAVE_GEOS
-    initGEOS(G_message, G_fatal_error);
-
     /* check required version for -s/-c flag */
 #ifndef GEOS_3_3
         G_warning(_("Flags -%c/%c ignored by this version, GEOS >= 3.3 is required"),
@@ -561,42 +563,15 @@ int main(int argc, char *argv[])
 			unit_tolerance);
 	    }
 
-#ifdef HAVE_GEOS
-	    if (use_geos)
-		geos_buffer(&In, &Out, &Buf, area, GV_AREA, da,
-			    &si, CCats, &arr_bc, &buffers_count, &arr_bc_alloc,
-                            straight_flag->answer, nocaps_flag->answer);
-#endif
-	    if (!use_geos) {
-		Vect_area_buffer2(&In, area, da, db, dalpha,
-				  !(straight_flag->answer),
-				  !(nocaps_flag->answer), unit_tolerance,
-				  &(arr_bc_pts.oPoints),
-				  &(arr_bc_pts.iPoints),
-				  &(arr_bc_pts.inner_count));
-		
-		Vect_write_line(&Out, GV_BOUNDARY, arr_bc_pts.oPoints, BCats);
-		line_id = Vect_write_line(&Buf, GV_BOUNDARY, arr_bc_pts.oPoints, CCats);
-		Vect_destroy_line_struct(arr_bc_pts.oPoints);
-		/* add buffer to spatial index */
-		Vect_get_line_box(&Buf, line_id, &bbox);
-		Vect_spatial_index_add_item(&si, buffers_count, &bbox);
-		arr_bc[buffers_count].outer = line_id;
-		
-		arr_bc[buffers_count].inner_count = arr_bc_pts.inner_count;
-		if (arr_bc_pts.inner_count > 0) {
-		    arr_bc[buffers_count].inner = G_malloc(arr_bc_pts.inner_count * sizeof(int));
-		    for (i = 0; i < arr_bc_pts.inner_count; i++) {
-			Vect_write_line(&Out, GV_BOUNDARY, arr_bc_pts.iPoints[i], BCats);
-			line_id = Vect_write_line(&Buf, GV_BOUNDARY, arr_bc_pts.iPoints[i], BCats);
-			Vect_destroy_line_struct(arr_bc_pts.iPoints[i]);
-			arr_bc[buffers_count].inner[i] = line_id;
-		    }
-		    G_free(arr_bc_pts.iPoints);
-		}
-		buffers_count++;
-	    } /* native buffer end */
+	    /* buffers are computed in blocks, see buffers.c */
+	    buf_block_add_area(&blk, &In, area, CCats, da, db, dalpha,
+			       unit_tolerance);
+	    if (blk.n >= BUF_BLOCK_SIZE)
+		buf_block_flush(&blk, &Out, &Buf, BCats, &si, &arr_bc,
+				&buffers_count, &arr_bc_alloc);
 	}
+	buf_block_flush(&blk, &Out, &Buf, BCats, &si, &arr_bc,
+			&buffers_count, &arr_bc_alloc);
     }
 
     /* Lines (and Points) */
@@ -673,75 +648,18 @@ int main(int argc, char *argv[])
 	    }
 	    
 	    Vect_line_prune(Points);
-	    if (ltype & GV_POINTS || Points->n_points == 1) {
-		if (straight_flag->answer) {
-			arr_bc_pts.oPoints = Vect_new_line_struct();
-		        Vect_append_point(arr_bc_pts.oPoints, Points->x[0] + da, Points->y[0] + da, 0);
-		        Vect_append_point(arr_bc_pts.oPoints, Points->x[0] + da, Points->y[0] - da, 0);
-		        Vect_append_point(arr_bc_pts.oPoints, Points->x[0] - da, Points->y[0] - da, 0);
-		        Vect_append_point(arr_bc_pts.oPoints, Points->x[0] - da, Points->y[0] + da, 0);
-  		        Vect_append_point(arr_bc_pts.oPoints, arr_bc_pts.oPoints->x[0], arr_bc_pts.oPoints->y[0], arr_bc_pts.oPoints->z[0]);
-		} else {
-			Vect_point_buffer2(Points->x[0], Points->y[0], da, db, dalpha,
-					   !(straight_flag->answer), unit_tolerance,
-					   &(arr_bc_pts.oPoints));
-		}
-
-		Vect_write_line(&Out, GV_BOUNDARY, arr_bc_pts.oPoints, BCats);
-		line_id = Vect_write_line(&Buf, GV_BOUNDARY, arr_bc_pts.oPoints, CCats);
-		Vect_destroy_line_struct(arr_bc_pts.oPoints);
-		/* add buffer to spatial index */
-		Vect_get_line_box(&Buf, line_id, &bbox);
-		Vect_spatial_index_add_item(&si, buffers_count, &bbox);
-		arr_bc[buffers_count].outer = line_id;
-		arr_bc[buffers_count].inner_count = 0;
-		arr_bc[buffers_count].inner = NULL;
-		buffers_count++;
-
-	    }
-	    else {
-#ifdef HAVE_GEOS
-		if (use_geos)
-		    geos_buffer(&In, &Out, &Buf, line, type, da,
-				&si, CCats, &arr_bc, &buffers_count, &arr_bc_alloc,
-                                straight_flag->answer, nocaps_flag->answer);
-#endif
-		if (!use_geos) {
-		    Vect_line_buffer2(Points, da, db, dalpha,
-				      !(straight_flag->answer),
-				      !(nocaps_flag->answer), unit_tolerance,
-				      &(arr_bc_pts.oPoints),
-				      &(arr_bc_pts.iPoints),
-				      &(arr_bc_pts.inner_count));
-		    
-		    Vect_write_line(&Out, GV_BOUNDARY, arr_bc_pts.oPoints, BCats);
-		    line_id = Vect_write_line(&Buf, GV_BOUNDARY, arr_bc_pts.oPoints, CCats);
-		    Vect_destroy_line_struct(arr_bc_pts.oPoints);
-		    /* add buffer to spatial index */
-		    Vect_get_line_box(&Buf, line_id, &bbox);
-		    Vect_spatial_index_add_item(&si, buffers_count, &bbox);
-		    arr_bc[buffers_count].outer = line_id;
-		    
-		    arr_bc[buffers_count].inner_count = arr_bc_pts.inner_count;
-		    if (arr_bc_pts.inner_count > 0) {
-			arr_bc[buffers_count].inner = G_malloc(arr_bc_pts.inner_count * sizeof(int));
-			for (i = 0; i < arr_bc_pts.inner_count; i++) {
-			    Vect_write_line(&Out, GV_BOUNDARY, arr_bc_pts.iPoints[i], BCats);
-			    line_id = Vect_write_line(&Buf, GV_BOUNDARY, arr_bc_pts.iPoints[i], BCats);
-			    Vect_destroy_line_struct(arr_bc_pts.iPoints[i]);
-			    arr_bc[buffers_count].inner[i] = line_id;
-			}
-			G_free(arr_bc_pts.iPoints);
-		    }
-		    buffers_count++;
-		} /* native buffer end */
-	    }
+	    buf_block_add_line(&blk,
+			       (ltype & GV_POINTS || Points->n_points == 1) ?
+			       BUF_POINT : BUF_LINE, line, ltype, Points,
+			       CCats, da, db, dalpha, unit_tolerance);
+	    if (blk.n >= BUF_BLOCK_SIZE)
+		buf_block_flush(&blk, &Out, &Buf, BCats, &si, &arr_bc,
+				&buffers_count, &arr_bc_alloc);
 	}
+	buf_block_flush(&blk, &Out, &Buf, BCats, &si, &arr_bc,
+			&buffers_count, &arr_bc_alloc);
     }
-
-#ifdef HAVE_GEOS
-    finishGEOS();
-#endif
+    buf_block_free(&blk);
 
     G_message(_("Cleaning buffers..."));
     
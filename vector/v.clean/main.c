@@ -34,7 +34,7 @@ int main(int argc, char *argv[])
     struct GModule *module;
     struct {
 	struct Option *in, *field, *out, *type, *tool, *thresh,
-	    *err;
+	    *err, *nprocs;
     } opt;
     struct {
 	struct Flag *no_build, *combine;
@@ -124,6 +124,8 @@ int main(int argc, char *argv[])
     opt.thresh->label = _("Threshold in map units, one value for each tool");
     opt.thresh->description = _("Default: 0.0[,0.0,...])");
 
+    opt.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.no_build = G_define_flag();
     flag.no_build->key = 'b';
     flag.no_build->description =
@@ -137,6 +139,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(opt.nprocs);
+
     otype = Vect_option_to_types(opt.type);
 
     Vect_check_input_output_name(opt.in->answer, opt.out->answer,
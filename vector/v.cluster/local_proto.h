@@ -0,0 +1,35 @@
+#ifndef __LOCAL_PROTO_H__
+#define __LOCAL_PROTO_H__
+
+#include <grass/kdtree.h>
+
+/* number of points searched at once by several threads */
+#define BATCH_PNTS 65536
+
+/* neighbors.c */
+struct nbr_pool;
+
+struct neighbors
+{
+    struct kdtree *kdt;
+    double (*c)[3];		/* coordinates of the points */
+    int *uid;			/* unique ids of the points */
+    int npoints;
+    int k;			/* number of nearest neighbors or */
+    double eps;			/* search radius if k is 0 */
+    int first, last;		/* points of the current batch */
+    int *found;			/* number of neighbors of the batch points */
+    size_t *offset;		/* radius search: start of their neighbors */
+    int *ki;			/* k nearest neighbors of the batch points */
+    double *kd;			/* and their squared distances */
+    int nchunks;		/* radius search: parts of a batch, */
+    struct nbr_pool *pools;	/* each with its own result buffer */
+};
+
+struct neighbors *neighbors_create(struct kdtree *, double (*)[3], int *,
+				   int, int, double);
+int neighbors_batch(struct neighbors *, int);
+int neighbors_get(struct neighbors *, int, int **, double **);
+void neighbors_destroy(struct neighbors *);
+
+#endif /* __LOCAL_PROTO_H__ */
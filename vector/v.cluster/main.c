@@ -23,7 +23,7 @@
 #include <grass/gis.h>
 #include <grass/vector.h>
 #include <grass/glocale.h>
-#include <grass/kdtree.h>
+#include "local_proto.h"
 
 #ifdef MAX
 #undef MAX
@@ -54,9 +54,95 @@ static struct cl_pnt *clp;
 static int *heapidx;
 static int heapsize;
 
+static double *sort_cd;
+
 int add_pt(int idx);
 int drop_pt(void);
 
+/* root of a cluster id, with path halving */
+static int find_root(int *idx, int id)
+{
+    while (idx[id] != id) {
+	idx[id] = idx[idx[id]];
+	id = idx[id];
+    }
+
+    return id;
+}
+
+/* compare points by core density, then by traversal order */
+static int cmp_cd(const void *a, const void *b)
+{
+    int ia = *(const int *)a;
+    int ib = *(const int *)b;
+
+    if (sort_cd[ia] < sort_cd[ib])
+	return -1;
+    if (sort_cd[ia] > sort_cd[ib])
+	return 1;
+
+    return (ia > ib) - (ia < ib);
+}
+
+/* estimate the maximum distance to neighbors from the distances
+ * to the minpnts nearest neighbors */
+static double estimate_eps(struct kdtree *kdt, double (*pc)[3], int *puid,
+			   int kdpnts, int minpnts)
+{
+    int i, last, n, kdfound;
+    double dist, mean, min, max, sum, sumsq, sd, eps;
+    double *kd;
+    int *ki;
+    struct neighbors *nb;
+
+    G_message(_("Estimating maximum distance ..."));
+    n = 0;
+    sum = sumsq = 0;
+    min = 1.0 / 0.0;
+    max = 0;
+    nb = neighbors_create(kdt, pc, puid, kdpnts, minpnts, 0);
+    for (i = 0; i < kdpnts;) {
+	last = neighbors_batch(nb, i);
+	for (; i < last; i++) {
+	    G_percent(i, kdpnts, 4);
+
+	    kdfound = neighbors_get(nb, i, &ki, &kd);
+	    if (kdfound) {
+		dist = sqrt(kd[kdfound - 1]);
+		sum += dist;
+		sumsq += dist * dist;
+		n++;
+		if (min > dist)
+		    min = dist;
+		if (max < dist)
+		    max = dist;
+	    }
+	}
+    }
+    G_percent(kdpnts, kdpnts, 4);
+    neighbors_destroy(nb);
+
+    if (!n)
+	G_fatal_error(_("No neighbors found"));
+
+    mean = sum / n;
+    sd = sqrt(sumsq / n - mean * mean);
+    eps = mean + 1.644854 * sd; /* 90% CI */
+    eps = mean + 2.575829 * sd; /* 99% CI */
+
+    if (eps > max)
+	eps = max;
+
+    G_message(_("Distance to the %d nearest neighbor:"), minpnts);
+    G_message(_("Min: %g, max: %g"), min, max);
+    G_message(_("Mean: %g"), mean);
+    G_message(_("Standard deviation: %g"), sd);
+
+    G_message(_("Estimated maximum distance: %g"), eps);
+
+    return eps;
+}
+
 int main(int argc, char *argv[])
 {
     struct Map_info In, Out;
@@ -65,7 +151,7 @@ int main(int argc, char *argv[])
     int i, j, type, cat, is3d;
     struct GModule *module;
     struct Option *input, *output, *lyr_opt;
-    struct Option *dist_opt, *min_opt, *method_opt;
+    struct Option *dist_opt, *min_opt, *method_opt, *nprocs_opt;
     struct Flag *flag_2d, *flag_topo, *flag_attr;
     int clayer;
     int npoints, nlines;
@@ -80,6 +166,11 @@ int main(int argc, char *argv[])
     int clmethod;
     double *kddist;
     int kdfound, *kduid;
+    double (*pc)[3];
+    int *puid, kdpnts;
+    double *bulk_c;
+    int *bulk_uid;
+    struct neighbors *nb;
 
     /* initialize GIS environment */
     /* reads grass env, stores program name to G_program_name() */
@@ -124,6 +215,8 @@ int main(int argc, char *argv[])
     method_opt->required = NO;
     method_opt->label = _("Clustering method");
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag_2d = G_define_flag();
     flag_2d->key = '2';
     flag_2d->label = _("Force 2D clustering");
@@ -137,6 +230,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
+
     Points = Vect_new_line_struct();
     Cats = Vect_new_cats_struct();
 
@@ -214,30 +309,49 @@ int main(int argc, char *argv[])
     Vect_hist_copy(&In, &Out);
     Vect_hist_command(&Out);
 
-    /* create k-d tree */
+    /* create k-d tree, balanced by building it from all points */
     G_message(_("Creating search index ..."));
-    kdt = kdtree_create(ndims, NULL);
     cid = G_malloc((nlines + 1) * sizeof(int));
     idx = G_malloc((nlines + 1) * sizeof(int));
+    bulk_c = G_malloc((size_t)npoints * ndims * sizeof(double));
+    bulk_uid = G_malloc(npoints * sizeof(int));
     Vect_rewind(&In);
     i = 0;
+    kdpnts = 0;
     cid[0] = 0;
     idx[0] = 0;
     while ((type = Vect_read_next_line(&In, Points, Cats)) > 0) {
 	G_percent(i++, nlines, 4);
 	cid[i] = 0;
 	if (type == GV_POINT) {
-	    
-	    c[0] = Points->x[0];
-	    c[1] = Points->y[0];
-	    c[2] = Points->z[0];
+	    double *bc = bulk_c + (size_t)kdpnts * ndims;
 
-	    kdtree_insert(kdt, c, i, 0);
+	    bc[0] = Points->x[0];
+	    bc[1] = Points->y[0];
+	    if (ndims > 2)
+		bc[2] = Points->z[0];
+	    bulk_uid[kdpnts++] = i;
 	}
     }
     G_percent(nlines, nlines, 4);
 
-    kdtree_optimize(kdt, 2);
+    kdt = kdtree_create_bulk(ndims, NULL, bulk_c, bulk_uid, kdpnts, 0);
+    G_free(bulk_c);
+    G_free(bulk_uid);
+
+    /* points in the order of the k-d tree traversal */
+    pc = G_malloc(npoints * sizeof(*pc));
+    puid = G_malloc(npoints * sizeof(int));
+    kdtree_init_trav(&trav, kdt);
+    c[2] = 0.0;
+    kdpnts = 0;
+    while (kdtree_traverse(&trav, c, &uid)) {
+	pc[kdpnts][0] = c[0];
+	pc[kdpnts][1] = c[1];
+	pc[kdpnts][2] = c[2];
+	puid[kdpnts] = uid;
+	kdpnts++;
+    }
 
     noutliers = nclusters = 0;
     if (clmethod == CL_DBSCAN) {
@@ -252,95 +366,32 @@ int main(int argc, char *argv[])
 	    if (eps <= 0)
 		G_fatal_error(_("Option %s must be a positive number"), dist_opt->key);
 	}
-	else {
-	    int n;
-	    double dist, mean, min, max, sum, sumsq, sd;
-	    double *kd;
-	    int *ki;
-
-	    /* estimate epsilon */
-	    G_message(_("Estimating maximum distance ..."));
-	    kdtree_init_trav(&trav, kdt);
-	    c[2] = 0.0;
-	    n = 0;
-	    sum = sumsq = 0;
-	    min = 1.0 / 0.0;
-	    max = 0;
-	    kd = G_malloc(minpnts * sizeof(double));
-	    ki = G_malloc(minpnts * sizeof(int));
-	    i = 0;
-	    while (kdtree_traverse(&trav, c, &uid)) {
-		G_percent(i++, npoints, 4);
-
-		kdfound = kdtree_knn(kdt, c, ki, kd, minpnts, &uid);
-		if (kdfound) {
-		    dist = sqrt(kd[kdfound - 1]);
-		    sum += dist;
-		    sumsq += dist * dist;
-		    n++;
-		    if (min > dist)
-			min = dist;
-		    if (max < dist)
-			max = dist;
-		}
-	    }
-	    G_percent(npoints, npoints, 4);
-
-	    G_free(kd);
-	    G_free(ki);
-
-	    if (!n)
-		G_fatal_error(_("No neighbors found"));
-	    
-	    mean = sum / n;
-	    sd = sqrt(sumsq / n - mean * mean);
-	    eps = mean + 1.644854 * sd; /* 90% CI */
-	    eps = mean + 2.575829 * sd; /* 99% CI */
-	    
-	    if (eps > max)
-		eps = max;
-
-	    G_message(_("Distance to the %d nearest neighbor:"), minpnts);
-	    G_message(_("Min: %g, max: %g"), min, max);
-	    G_message(_("Mean: %g"), mean);
-	    G_message(_("Standard deviation: %g"), sd);
-
-	    G_message(_("Estimated maximum distance: %g"), eps);
-	}
+	else
+	    eps = estimate_eps(kdt, pc, puid, kdpnts, minpnts);
 
 	/* create clusters */
 	G_message(_("Building clusters ..."));
 	nclusters = 0;
-	kdtree_init_trav(&trav, kdt);
-	c[2] = 0.0;
 	idx[0] = 0;
-	i = 0;
-	while (kdtree_traverse(&trav, c, &uid)) {
-	    G_percent(i++, npoints, 4);
+	nb = neighbors_create(kdt, pc, puid, kdpnts, 0, eps);
+	for (i = 0; i < kdpnts; i++) {
+	    G_percent(i, kdpnts, 4);
 
-	    /* radius search */
-	    /* TODO: use knn search */
-	    kdfound = kdtree_dnn(kdt, c, &kduid, &kddist, eps, &uid);
+	    /* radius search, by several threads for a batch of points */
+	    if (i == nb->last)
+		neighbors_batch(nb, i);
+	    uid = puid[i];
+	    kdfound = neighbors_get(nb, i, &kduid, &kddist);
 
 	    /* must have min neighbors within radius */
 	    if (kdfound >= minpnts) {
 
-		OLD = cid[uid];
-		NEW = idx[OLD];
-		while (OLD != NEW) {
-		    OLD = NEW;
-		    NEW = idx[OLD];
-		}
+		NEW = find_root(idx, cid[uid]);
 		cat = NEW;
 
 		/* find latest cluster */
 		for (j = 0; j < kdfound; j++) {
-		    OLD = cid[kduid[j]];
-		    NEW = idx[OLD];
-		    while (OLD != NEW) {
-			OLD = NEW;
-			NEW = idx[OLD];
-		    }
+		    NEW = find_root(idx, cid[kduid[j]]);
 		    if (cat < NEW) {
 			cat = NEW;
 		    }
@@ -359,12 +410,7 @@ int main(int argc, char *argv[])
 		/* set or update cluster ids */
 		if (cid[uid] != 0) {
 		    /* relabel */
-		    OLD = cid[uid];
-		    NEW = idx[OLD];
-		    while (OLD != NEW) {
-			OLD = NEW;
-			NEW = idx[OLD];
-		    }
+		    NEW = find_root(idx, cid[uid]);
 		    idx[NEW] = cat;
 		}
 		else {
@@ -374,12 +420,7 @@ int main(int argc, char *argv[])
 		for (j = 0; j < kdfound; j++) {
 		    if (cid[kduid[j]] != 0) {
 			/* relabel */
-			OLD = cid[kduid[j]];
-			NEW = idx[OLD];
-			while (OLD != NEW) {
-			    OLD = NEW;
-			    NEW = idx[OLD];
-			}
+			NEW = find_root(idx, cid[kduid[j]]);
 			idx[NEW] = cat;
 		    }
 		    else {
@@ -387,12 +428,9 @@ int main(int argc, char *argv[])
 		    }
 		}
 	    }
-	    if (kdfound) {
-		G_free(kddist);
-		G_free(kduid);
-	    }
 	}
-	G_percent(npoints, npoints, 4);
+	G_percent(kdpnts, kdpnts, 4);
+	neighbors_destroy(nb);
 
 	if (nclusters == 0) {
 	    G_message(_("No clusters found, adjust option %s"), dist_opt->key);
@@ -457,61 +495,8 @@ int main(int argc, char *argv[])
 	    if (eps <= 0)
 		G_fatal_error(_("Option %s must be a positive number"), dist_opt->key);
 	}
-	else {
-	    int n;
-	    double dist, mean, min, max, sum, sumsq, sd;
-	    double *kd;
-	    int *ki;
-
-	    /* estimate epsilon */
-	    G_message(_("Estimating maximum distance ..."));
-	    kdtree_init_trav(&trav, kdt);
-	    c[2] = 0.0;
-	    n = 0;
-	    sum = sumsq = 0;
-	    min = 1.0 / 0.0;
-	    max = 0;
-	    kd = G_malloc(minpnts * sizeof(double));
-	    ki = G_malloc(minpnts * sizeof(int));
-	    i = 0;
-	    while (kdtree_traverse(&trav, c, &uid)) {
-		G_percent(i++, npoints, 4);
-
-		kdfound = kdtree_knn(kdt, c, ki, kd, minpnts, &uid);
-		if (kdfound) {
-		    dist = sqrt(kd[kdfound - 1]);
-		    sum += dist;
-		    sumsq += dist * dist;
-		    n++;
-		    if (min > dist)
-			min = dist;
-		    if (max < dist)
-			max = dist;
-		}
-	    }
-	    G_percent(npoints, npoints, 4);
-
-	    G_free(kd);
-	    G_free(ki);
-
-	    if (!n)
-		G_fatal_error(_("No neighbors found"));
-	    
-	    mean = sum / n;
-	    sd = sqrt(sumsq / n - mean * mean);
-	    eps = mean + 1.644854 * sd; /* 90% CI */
-	    eps = mean + 2.575829 * sd; /* 99% CI */
-	    
-	    if (eps > max)
-		eps = max;
-
-	    G_message(_("Distance to the %d nearest neighbor:"), minpnts);
-	    G_message(_("Min: %g, max: %g"), min, max);
-	    G_message(_("Mean: %g"), mean);
-	    G_message(_("Standard deviation: %g"), sd);
-
-	    G_message(_("Estimated maximum distance: %g"), eps);
-	}
+	else
+	    eps = estimate_eps(kdt, pc, puid, kdpnts, minpnts);
 
 	/* create clusters */
 	G_message(_("Building clusters ..."));
@@ -519,36 +504,26 @@ int main(int argc, char *argv[])
 	for (i = 0; i <= nlines; i++)
 	    clcnt[i] = 0;
 	nclusters = 0;
-	kdtree_init_trav(&trav, kdt);
-	c[2] = 0.0;
 	idx[0] = 0;
-	i = 0;
-	while (kdtree_traverse(&trav, c, &uid)) {
-	    G_percent(i++, npoints, 4);
+	nb = neighbors_create(kdt, pc, puid, kdpnts, 0, eps);
+	for (i = 0; i < kdpnts; i++) {
+	    G_percent(i, kdpnts, 4);
 
-	    /* radius search */
-	    /* TODO: use knn search */
-	    kdfound = kdtree_dnn(kdt, c, &kduid, &kddist, eps, &uid);
+	    /* radius search, by several threads for a batch of points */
+	    if (i == nb->last)
+		neighbors_batch(nb, i);
+	    uid = puid[i];
+	    kdfound = neighbors_get(nb, i, &kduid, &kddist);
 	    
 	    /* any neighbor within radius */
 	    if (kdfound > 0) {
 
-		OLD = cid[uid];
-		NEW = idx[OLD];
-		while (OLD != NEW) {
-		    OLD = NEW;
-		    NEW = idx[OLD];
-		}
+		NEW = find_root(idx, cid[uid]);
 		cat = NEW;
 
 		/* find latest cluster */
 		for (j = 0; j < kdfound; j++) {
-		    OLD = cid[kduid[j]];
-		    NEW = idx[OLD];
-		    while (OLD != NEW) {
-			OLD = NEW;
-			NEW = idx[OLD];
-		    }
+		    NEW = find_root(idx, cid[kduid[j]]);
 		    if (cat < NEW) {
 			cat = NEW;
 		    }
@@ -568,12 +543,7 @@ int main(int argc, char *argv[])
 		/* set or update cluster ids */
 		if (cid[uid] != 0) {
 		    /* relabel */
-		    OLD = cid[uid];
-		    NEW = idx[OLD];
-		    while (OLD != NEW) {
-			OLD = NEW;
-			NEW = idx[OLD];
-		    }
+		    NEW = find_root(idx, cid[uid]);
 		    idx[NEW] = cat;
 		}
 		else {
@@ -583,12 +553,7 @@ int main(int argc, char *argv[])
 
 		for (j = 0; j < kdfound; j++) {
 		    if (cid[kduid[j]] != 0) {
-			OLD = cid[kduid[j]];
-			NEW = idx[OLD];
-			while (OLD != NEW) {
-			    OLD = NEW;
-			    NEW = idx[OLD];
-			}
+			NEW = find_root(idx, cid[kduid[j]]);
 			/* relabel */
 			idx[NEW] = cat;
 		    }
@@ -597,11 +562,10 @@ int main(int argc, char *argv[])
 			clcnt[cat]++;
 		    }
 		}
-		G_free(kddist);
-		G_free(kduid);
 	    }
 	}
-	G_percent(npoints, npoints, 4);
+	G_percent(kdpnts, kdpnts, 4);
+	neighbors_destroy(nb);
 
 	if (nclusters == 0) {
 	    G_message(_("No clusters found, adjust option %s"), dist_opt->key);
@@ -684,7 +648,7 @@ int main(int argc, char *argv[])
 
 	double *kd;
 	int *ki;
-	int k, kdpnts;
+	int k;
 	int *clidx;
 	int *olist, nout;
 	double newrd;
@@ -710,26 +674,20 @@ int main(int argc, char *argv[])
 
 	/* loading points */
 	G_message(_("Loading points ..."));
-	kdtree_init_trav(&trav, kdt);
-	c[2] = 0.0;
-	i = 0;
-	while (kdtree_traverse(&trav, c, &uid)) {
-	    G_percent(i, npoints, 4);
+	for (i = 0; i < kdpnts; i++) {
+	    G_percent(i, kdpnts, 4);
 	    
-	    clp[i].c[0] = c[0];
-	    clp[i].c[1] = c[1];
-	    clp[i].c[2] = c[2];
-	    clp[i].uid = uid;
+	    clp[i].c[0] = pc[i][0];
+	    clp[i].c[1] = pc[i][1];
+	    clp[i].c[2] = pc[i][2];
+	    clp[i].uid = puid[i];
 	    clp[i].cd = -1;
 	    clp[i].reach = -1;
 	    clp[i].prevpnt = -1;
-	    clidx[uid] = i;
+	    clidx[puid[i]] = i;
 	    olist[i] = -1;
-	    
-	    i++;
 	}
-	G_percent(npoints, npoints, 4);
-	kdpnts = i;
+	G_percent(kdpnts, kdpnts, 4);
 	G_debug(0, "%d points in k-d tree", kdpnts);
 
 	/* reachability network */
@@ -865,9 +823,6 @@ int main(int argc, char *argv[])
 	reachability = G_malloc((nlines + 1) * sizeof(double));
 	nextpnt = G_malloc((nlines + 1) * sizeof(int));
 
-	kd = G_malloc(minpnts * sizeof(double));
-	ki = G_malloc(minpnts * sizeof(int));
-
 	for (i = 0; i <= nlines; i++) {
 	    coredist[i] = -1;
 	    reachability[i] = -1;
@@ -878,14 +833,15 @@ int main(int argc, char *argv[])
 
 	/* reachability network */
 	G_message(_("Reachability network ..."));
-	kdtree_init_trav(&trav, kdt);
-	c[2] = 0.0;
-	i = 0;
-	while (kdtree_traverse(&trav, c, &uid)) {
-	    G_percent(i++, npoints, 4);
+	nb = neighbors_create(kdt, pc, puid, kdpnts, minpnts, 0);
+	for (i = 0; i < kdpnts; i++) {
+	    G_percent(i, kdpnts, 4);
 
-	    /* knn search */
-	    kdfound = kdtree_knn(kdt, c, ki, kd, minpnts, &uid);
+	    /* knn search, by several threads for a batch of points */
+	    if (i == nb->last)
+		neighbors_batch(nb, i);
+	    uid = puid[i];
+	    kdfound = neighbors_get(nb, i, &ki, &kd);
 	    if (kdfound < minpnts)
 		G_fatal_error(_("Not enough points found"));
 	    coredist[uid] = kd[minpnts - 1];
@@ -924,7 +880,8 @@ int main(int argc, char *argv[])
 		}
 	    }
 	}
-	G_percent(npoints, npoints, 4);
+	G_percent(kdpnts, kdpnts, 4);
+	neighbors_destroy(nb);
 
 	/* create clusters from reachability network */
 	G_message(_("Building clusters ..."));
@@ -954,12 +911,7 @@ int main(int argc, char *argv[])
 		    }
 		    else {
 			/* relabel */
-			OLD = cid[uid];
-			NEW = idx[OLD];
-			while (OLD != NEW) {
-			    OLD = NEW;
-			    NEW = idx[OLD];
-			}
+			NEW = find_root(idx, cid[uid]);
 			idx[NEW] = nclusters;
 			uid = nextpnt[uid];
 			uid = -1;
@@ -1032,7 +984,7 @@ int main(int argc, char *argv[])
 	double *kd;
 	int *ki;
 	double cd;
-	int k, kdcount;
+	int k, kdcount, *order;
 	struct ilist *CList;
 
 	clp = G_malloc((nlines + 1) * sizeof(struct cl_pnt));
@@ -1052,40 +1004,41 @@ int main(int argc, char *argv[])
 	    clidx[i] = -1;
 	}
 
-	/* core density */
+	/* core density, by several threads for a batch of points */
 	G_message(_("Core density ..."));
-	kdtree_init_trav(&trav, kdt);
-	c[2] = 0.0;
-	i = 0;
-	kdcount = 0;
-	uid = -1;
-	while (kdtree_traverse(&trav, c, &uid)) {
-	    G_percent(i++, npoints, 4);
+	sort_cd = G_malloc(kdpnts * sizeof(double));
+	order = G_malloc(kdpnts * sizeof(int));
+	nb = neighbors_create(kdt, pc, puid, kdpnts, minpnts, 0);
+	for (i = 0; i < kdpnts; i++) {
+	    G_percent(i, kdpnts, 4);
 
 	    /* knn search */
-	    kdfound = kdtree_knn(kdt, c, ki, kd, minpnts, &uid);
+	    if (i == nb->last)
+		neighbors_batch(nb, i);
+	    kdfound = neighbors_get(nb, i, &kduid, &kddist);
 	    if (kdfound < minpnts)
 		G_fatal_error(_("Not enough points found"));
 
-	    cd = kd[minpnts - 1];
-
-	    /* list insert */
-	    for (j = kdcount; j > 0; j--) {
-		if (clp[j - 1].cd <= cd)
-		    break;
-		clp[j] = clp[j - 1];
-		clidx[clp[j].uid] = j;
-	    }
-	    clp[j].uid = uid;
-	    clp[j].c[0] = c[0];
-	    clp[j].c[1] = c[1];
-	    clp[j].c[2] = c[2];
-	    clp[j].cd = cd;
+	    sort_cd[i] = kddist[minpnts - 1];
+	    order[i] = i;
+	}
+	G_percent(kdpnts, kdpnts, 4);
+	neighbors_destroy(nb);
+
+	/* sort ascending by core density */
+	qsort(order, kdpnts, sizeof(int), cmp_cd);
+	for (j = 0; j < kdpnts; j++) {
+	    i = order[j];
+	    clp[j].uid = puid[i];
+	    clp[j].c[0] = pc[i][0];
+	    clp[j].c[1] = pc[i][1];
+	    clp[j].c[2] = pc[i][2];
+	    clp[j].cd = sort_cd[i];
 	    clidx[clp[j].uid] = j;
-	    kdcount++;
-
 	}
-	G_percent(npoints, npoints, 4);
+	kdcount = kdpnts;
+	G_free(order);
+	G_free(sort_cd);
 
 	/* create clusters */
 	G_message(_("Building clusters ..."));
@@ -0,0 +1,187 @@
+/****************************************************************
+ *
+ * MODULE:     v.cluster
+ *
+ * PURPOSE:    Neighbor searches for batches of points by several
+ *             threads
+ *
+ * COPYRIGHT:  (C) 2015 by the GRASS Development Team
+ *
+ *             This program is free software under the
+ *             GNU General Public License (>=v2).
+ *             Read the file COPYING that comes with GRASS
+ *             for details.
+ *
+ ****************************************************************/
+
+#include <string.h>
+#include <grass/gis.h>
+#include "local_proto.h"
+
+/* number of parts of a batch */
+#define BATCH_CHUNKS 64
+#define CHUNK_PNTS (BATCH_PNTS / BATCH_CHUNKS)
+
+/* results of the radius searches for the points of a part of a batch,
+ * kept for the next batches */
+struct nbr_pool
+{
+    int *uid;			/* neighbors of the points */
+    size_t n, alloc;
+    int *buf;			/* search buffer */
+    int nbuf;
+};
+
+/* find the neighbors of the points of parts first to last - 1 of a 
+ * batch, each part with its own result buffer */
+static void search_chunks(int first, int last, void *closure)
+{
+    struct neighbors *nb = closure;
+    int ch, i, j, end;
+
+    for (ch = first; ch < last; ch++) {
+	struct nbr_pool *pool = nb->pools ? &nb->pools[ch] : NULL;
+
+	if (pool)
+	    pool->n = 0;
+	end = (ch + 1) * CHUNK_PNTS;
+	if (end > nb->last - nb->first)
+	    end = nb->last - nb->first;
+
+	for (i = ch * CHUNK_PNTS; i < end; i++) {
+	    j = nb->first + i;
+
+	    if (nb->k > 0) {
+		nb->found[i] = kdtree_knn(nb->kdt, nb->c[j],
+					  nb->ki + (size_t)i * nb->k,
+					  nb->kd + (size_t)i * nb->k, nb->k,
+					  &nb->uid[j]);
+		continue;
+	    }
+
+	    nb->found[i] = kdtree_dnn_uids(nb->kdt, nb->c[j], &pool->buf,
+					   &pool->nbuf, nb->eps, &nb->uid[j]);
+	    if (pool->n + nb->found[i] > pool->alloc) {
+		pool->alloc = pool->n + nb->found[i] + pool->alloc / 2;
+		pool->uid = G_realloc(pool->uid, pool->alloc * sizeof(int));
+	    }
+	    memcpy(pool->uid + pool->n, pool->buf,
+		   nb->found[i] * sizeof(int));
+	    nb->offset[i] = pool->n;
+	    pool->n += nb->found[i];
+	}
+    }
+}
+
+/*!
+ * \brief Prepare neighbor searches
+ *
+ * \param kdt search index of the points
+ * \param c coordinates of the points
+ * \param uid unique ids of the points
+ * \param npoints number of points
+ * \param k number of nearest neighbors to find, or 0 for
+ *          all neighbors within eps
+ * \param eps search radius
+ */
+struct neighbors *neighbors_create(struct kdtree *kdt, double (*c)[3],
+				   int *uid, int npoints, int k, double eps)
+{
+    struct neighbors *nb = G_malloc(sizeof(struct neighbors));
+
+    nb->kdt = kdt;
+    nb->c = c;
+    nb->uid = uid;
+    nb->npoints = npoints;
+    nb->k = k;
+    nb->eps = eps;
+    nb->first = nb->last = 0;
+    nb->found = G_malloc(BATCH_PNTS * sizeof(int));
+    nb->offset = NULL;
+    nb->ki = NULL;
+    nb->kd = NULL;
+    nb->pools = NULL;
+    nb->nchunks = BATCH_CHUNKS;
+
+    if (k > 0) {
+	nb->ki = G_malloc((size_t)BATCH_PNTS * k * sizeof(int));
+	nb->kd = G_malloc((size_t)BATCH_PNTS * k * sizeof(double));
+    }
+    else {
+	nb->offset = G_malloc(BATCH_PNTS * sizeof(size_t));
+	nb->pools = G_calloc(nb->nchunks, sizeof(struct nbr_pool));
+    }
+
+    return nb;
+}
+
+/*!
+ * \brief Find the neighbors of the next batch of points
+ *
+ * \param nb neighbor searches
+ * \param first first point of the batch
+ *
+ * \return first point after the batch
+ */
+int neighbors_batch(struct neighbors *nb, int first)
+{
+    int n;
+
+    nb->first = first;
+    nb->last = first + BATCH_PNTS;
+    if (nb->last > nb->npoints)
+	nb->last = nb->npoints;
+
+    n = nb->last - nb->first;
+    G_parallel_for(0, (n + CHUNK_PNTS - 1) / CHUNK_PNTS, 1, search_chunks,
+		   nb);
+
+    return nb->last;
+}
+
+/*!
+ * \brief Get the neighbors of a point of the current batch
+ *
+ * The k nearest neighbors are sorted by distance, the neighbors
+ * within the search radius are not sorted and come without distances.
+ *
+ * \param nb neighbor searches
+ * \param i point
+ * \param[out] uid unique ids of the neighbors
+ * \param[out] d squared distances to the neighbors or NULL
+ *
+ * \return number of neighbors
+ */
+int neighbors_get(struct neighbors *nb, int i, int **uid, double **d)
+{
+    i -= nb->first;
+
+    if (nb->k > 0) {
+	*uid = nb->ki + (size_t)i * nb->k;
+	*d = nb->kd + (size_t)i * nb->k;
+    }
+    else {
+	*uid = nb->pools[i / CHUNK_PNTS].uid + nb->offset[i];
+	*d = NULL;
+    }
+
+    return nb->found[i];
+}
+
+void neighbors_destroy(struct neighbors *nb)
+{
+    int i;
+
+    if (nb->pools) {
+	for (i = 0; i < nb->nchunks; i++) {
+	    G_free(nb->pools[i].uid);
+	    G_free(nb->pools[i].buf);
+	}
+	G_free(nb->pools);
+    }
+    G_free(nb->found);
+    G_free(nb->offset);
+    G_free(nb->ki);
+    G_free(nb->kd);
+    G_free(nb);
+}
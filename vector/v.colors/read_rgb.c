@@ -1,6 +1,6 @@
 #include <grass/gis.h>
-#include <grass/vector.h>
 #include <grass/dbmi.h>
+#include <grass/vector.h>
 #include <grass/raster.h>
 #include <grass/colors.h>
 #include <grass/glocale.h>
@@ -32,7 +32,7 @@ void rgb2colr(const struct Map_info *Map, int layer, const char *rgb_column,
 	G_fatal_error(_("Data type of RGB column <%s> must be char"),
 		      rgb_column);
     
-    if (0 > db_select_CatValArray(driver, fi->table, fi->key,
+    if (0 > Vect_select_cat_values(driver, fi,
 				  rgb_column, NULL, &cvarr))
 	G_warning(_("No RGB values found"));
 
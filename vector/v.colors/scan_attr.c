@@ -1,5 +1,5 @@
-#include <grass/vector.h>
 #include <grass/dbmi.h>
+#include <grass/vector.h>
 #include <grass/raster.h>
 #include <grass/glocale.h>
 
@@ -39,7 +39,7 @@ int scan_attr(const struct Map_info *Map, int layer, const char *column_name,
 
     is_fp = ctype == DB_C_TYPE_DOUBLE;
 
-    nrec = db_select_CatValArray(driver, fi->table, fi->key, column_name,
+    nrec = Vect_select_cat_values(driver, fi, column_name,
 				 NULL, &cvarr);
     if (nrec < 1) {
 	G_important_message(_("No data selected"));
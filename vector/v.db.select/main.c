@@ -29,6 +29,9 @@
 #include <grass/vector.h>
 #include <grass/dbmi.h>
 
+/* number of rows fetched at once */
+#define FETCH_ROWS 4096
+
 int main(int argc, char **argv)
 {
     struct GModule *module;
@@ -40,9 +43,9 @@ int main(int argc, char **argv)
     dbCursor cursor;
     dbTable *table;
     dbColumn *column;
-    dbValue *value;
+    dbBlock block;
     struct field_info *Fi;
-    int ncols, col, more;
+    int ncols, col, row;
     struct Map_info Map;
     char query[DB_SQL_MAX];
     struct ilist *list_lines;
@@ -223,91 +226,96 @@ int main(int argc, char **argv)
 
     init_box = 1;
 
-    /* fetch the data */
+    /* fetch the data by blocks of rows */
+    db_init_block(&block);
     while (1) {
-	if (db_fetch(&cursor, DB_NEXT, &more) != DB_OK)
+	if (db_fetch_block(&cursor, FETCH_ROWS, &block) != DB_OK)
 	    G_fatal_error(_("Unable to fetch data from table <%s>"),
 			  Fi->table);
 
-	if (!more)
+	if (block.nrows == 0)
 	    break;
 
-	cat = -1;
-	for (col = 0; col < ncols; col++) {
-	    column = db_get_table_column(table, col);
-	    value = db_get_column_value(column);
+	for (row = 0; row < block.nrows; row++) {
+	    cat = -1;
+	    for (col = 0; col < ncols; col++) {
+		column = db_get_table_column(table, col);
+
+		if (cat < 0 && strcmp(Fi->key, db_get_column_name(column)) == 0) {
+		    cat = block.columns[col].ctype == DB_C_TYPE_INT ?
+			block.columns[col].i[row] :
+			atoi(db_get_block_string(&block, col, row));
+		    if (r_flag->answer)
+			break;
+		}
 
-	    if (cat < 0 && strcmp(Fi->key, db_get_column_name(column)) == 0) {
-		cat = db_get_value_int(value);
 		if (r_flag->answer)
-		    break;
-	    }
-
-	    if (r_flag->answer)
-		continue;
+		    continue;
+
+		if (f_flag->answer) {
+		    Vect_cidx_find_all(&Map, field_number, ~GV_AREA, cat, list_lines);
+		    /* if no features are found for this category, don't print
+		     * anything. */
+		    if (list_lines->n_values == 0)
+			break;
+		}
 
-	    if (f_flag->answer) {
-		Vect_cidx_find_all(&Map, field_number, ~GV_AREA, cat, list_lines);
-		/* if no features are found for this category, don't print
-		 * anything. */
-		if (list_lines->n_values == 0)
-		    break;
-	    }
+		db_convert_block_value_to_string(&block, col, row, &value_string);
 
-	    db_convert_column_value_to_string(column, &value_string);
+		if (!c_flag->answer && v_flag->answer)
+		    fprintf(stdout, "%s%s", db_get_column_name(column), fs);
 
-	    if (!c_flag->answer && v_flag->answer)
-		fprintf(stdout, "%s%s", db_get_column_name(column), fs);
+		if (col && !v_flag->answer)
+		    fprintf(stdout, "%s", fs);
 
-	    if (col && !v_flag->answer)
-		fprintf(stdout, "%s", fs);
+		if (nv_opt->answer && block.columns[col].isNull[row])
+		    fprintf(stdout, "%s", nv_opt->answer);
+		else
+		    fprintf(stdout, "%s", db_get_string(&value_string));
 
-	    if (nv_opt->answer && db_test_value_isnull(value))
-		fprintf(stdout, "%s", nv_opt->answer);
-	    else
-		fprintf(stdout, "%s", db_get_string(&value_string));
+		if (v_flag->answer)
+		    fprintf(stdout, "\n");
+	    }
 
-	    if (v_flag->answer)
-		fprintf(stdout, "\n");
-	}
+	    if (f_flag->answer && col < ncols)
+		continue;
 
-	if (f_flag->answer && col < ncols)
-	    continue;
-
-	if (r_flag->answer) {
-	    /* get minimal region extent */
-	    Vect_cidx_find_all(&Map, field_number, ~GV_AREA, cat, list_lines);
-	    for (i = 0; i < list_lines->n_values; i++) {
-		line = list_lines->value[i];
-		if (Vect_get_line_type(&Map, line) == GV_CENTROID) {
-		    area = Vect_get_centroid_area(&Map, line);
-		    if (area > 0) {
-			if (!Vect_get_area_box(&Map, area, line_box))
-			    G_fatal_error(_("Unable to get bounding box of area %d"),
-					  area);
+	    if (r_flag->answer) {
+		/* get minimal region extent */
+		Vect_cidx_find_all(&Map, field_number, ~GV_AREA, cat, list_lines);
+		for (i = 0; i < list_lines->n_values; i++) {
+		    line = list_lines->value[i];
+		    if (Vect_get_line_type(&Map, line) == GV_CENTROID) {
+			area = Vect_get_centroid_area(&Map, line);
+			if (area > 0) {
+			    if (!Vect_get_area_box(&Map, area, line_box))
+				G_fatal_error(_("Unable to get bounding box of area %d"),
+					      area);
+			}
+		    }
+		    else {
+			if (!Vect_get_line_box(&Map, line, line_box))
+			    G_fatal_error(_("Unable to get bounding box of line %d"),
+					  line);
+		    }
+		    if (init_box) {
+			Vect_box_copy(min_box, line_box);
+			init_box = 0;
+		    }
+		    else {
+			Vect_box_extend(min_box, line_box);
 		    }
-		}
-		else {
-		    if (!Vect_get_line_box(&Map, line, line_box))
-			G_fatal_error(_("Unable to get bounding box of line %d"),
-				      line);
-		}
-		if (init_box) {
-		    Vect_box_copy(min_box, line_box);
-		    init_box = 0;
-		}
-		else {
-		    Vect_box_extend(min_box, line_box);
 		}
 	    }
-	}
-	else {
-	    if (!v_flag->answer)
-		fprintf(stdout, "\n");
-	    else if (vs)
-		fprintf(stdout, "%s\n", vs);
+	    else {
+		if (!v_flag->answer)
+		    fprintf(stdout, "\n");
+		else if (vs)
+		    fprintf(stdout, "%s\n", vs);
+	    }
 	}
     }
+    db_free_block(&block);
 
     if (r_flag->answer) {
 	fprintf(stdout, "n=%f\n", min_box->N);
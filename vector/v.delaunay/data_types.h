@@ -45,20 +45,33 @@
 #ifndef DATA_TYPES_H
 #define DATA_TYPES_H
 
+/* Vertices and edges refer to each other by their index in the sites
+   and edges arrays, which keeps the half-edge structure compact */
+
+#define NO_EDGE ((unsigned int)-1)
+
 struct vertex
 {
     double x, y, z;
-    struct edge *entry_pt;
+    unsigned int entry_pt;
 };
 
 struct edge
 {
-    struct vertex *org;
-    struct vertex *dest;
-    struct edge *onext;
-    struct edge *oprev;
-    struct edge *dnext;
-    struct edge *dprev;
+    unsigned int org;
+    unsigned int dest;
+    unsigned int onext;
+    unsigned int oprev;
+    unsigned int dnext;
+    unsigned int dprev;
+};
+
+/* free edges of a part of the triangulation, stored in the free list
+   from index base on */
+struct edge_pool
+{
+    unsigned int base;
+    unsigned int n_free;
 };
 
 #endif
@@ -1,5 +1,7 @@
 #ifdef MAIN
 struct vertex *sites;
+struct edge *edges;
 #else
 extern struct vertex *sites;
+extern struct edge *edges;
 #endif
@@ -44,22 +44,23 @@
 
 #include <stdlib.h>
 #include "data_types.h"
+#include "defs.h"
 #include "memory.h"
 #include "edge.h"
 
 /* 
  *  Construct an edge from vertices v1, v2 and add it to rings of edges e1, e2
  */
-struct edge *join(struct edge *e1, struct vertex *v1,
-		  struct edge *e2, struct vertex *v2, int side)
+unsigned int join(struct edge_pool *pool, unsigned int e1, unsigned int v1,
+		  unsigned int e2, unsigned int v2, int side)
 {
 
-    struct edge *new_edge;
+    unsigned int new_edge;
 
     /* v1, v2 - vertices to be joined.
        e1, e2 - edges to which v1, v2 belong to */
 
-    new_edge = create_edge(v1, v2);
+    new_edge = create_edge(pool, v1, v2);
 
     if (side == LEFT) {
 	if (ORG(e1) == v1)
@@ -81,19 +82,19 @@ struct edge *join(struct edge *e1, struct vertex *v1,
 /* 
  *  Remove an edge.
  */
-void delete_edge(struct edge *e)
+void delete_edge(struct edge_pool *pool, unsigned int e)
 {
-    struct vertex *u, *v;
+    unsigned int u, v;
 
     /* Save destination and origin. */
     u = ORG(e);
     v = DEST(e);
 
     /* Set entry points. */
-    if (u->entry_pt == e)
-	u->entry_pt = ONEXT(e);
-    if (v->entry_pt == e)
-	v->entry_pt = DNEXT(e);
+    if (sites[u].entry_pt == e)
+	sites[u].entry_pt = ONEXT(e);
+    if (sites[v].entry_pt == e)
+	sites[v].entry_pt = DNEXT(e);
 
     /* Four edge references need adjustment */
     if (ORG(ONEXT(e)) == u)
@@ -116,14 +117,14 @@ void delete_edge(struct edge *e)
     else
 	DNEXT(DPREV(e)) = DNEXT(e);
 
-    free_edge(e);
+    free_edge(pool, e);
 }
 
 
  /*  Add an edge to a ring of edges. */
-void splice(struct edge *a, struct edge *b, struct vertex *v)
+void splice(unsigned int a, unsigned int b, unsigned int v)
 {
-    struct edge *next;
+    unsigned int next;
 
     /* b must be the unnattached edge and a must be the previous 
        ccw edge to b. */
@@ -153,19 +154,20 @@ void splice(struct edge *a, struct edge *b, struct vertex *v)
 }
 
  /*  Create a new edge and initialize it */
-struct edge *create_edge(struct vertex *v1, struct vertex *v2)
+unsigned int create_edge(struct edge_pool *pool, unsigned int v1,
+			 unsigned int v2)
 {
-    struct edge *new_edge;
+    unsigned int new_edge;
 
-    new_edge = get_edge();
+    new_edge = get_edge(pool);
 
     DNEXT(new_edge) = DPREV(new_edge) = ONEXT(new_edge) = OPREV(new_edge) =
 	new_edge;
     ORG(new_edge) = v1;
     DEST(new_edge) = v2;
-    if (v1->entry_pt == NULL)
-	v1->entry_pt = new_edge;
-    if (v2->entry_pt == NULL)
-	v2->entry_pt = new_edge;
+    if (sites[v1].entry_pt == NO_EDGE)
+	sites[v1].entry_pt = new_edge;
+    if (sites[v2].entry_pt == NO_EDGE)
+	sites[v2].entry_pt = new_edge;
     return new_edge;
 }
@@ -45,12 +45,12 @@
 #ifndef EDGE_H
 #define EDGE_H
 
-#define ORG(e)   ((e)->org)
-#define DEST(e)  ((e)->dest)
-#define ONEXT(e) ((e)->onext)
-#define OPREV(e) ((e)->oprev)
-#define DNEXT(e) ((e)->dnext)
-#define DPREV(e) ((e)->dprev)
+#define ORG(e)   (edges[e].org)
+#define DEST(e)  (edges[e].dest)
+#define ONEXT(e) (edges[e].onext)
+#define OPREV(e) (edges[e].oprev)
+#define DNEXT(e) (edges[e].dnext)
+#define DPREV(e) (edges[e].dprev)
 
 #define OTHER_VERTEX(e,p) (ORG(e) == (p) ? DEST(e) : ORG(e))
 #define NEXT(e,p)         (ORG(e) == (p) ? ONEXT(e) : DNEXT(e))
@@ -61,10 +61,11 @@
 #define LEFT  0
 #define RIGHT 1
 
-struct edge *join(struct edge *e1, struct vertex *v1,
-		  struct edge *e2, struct vertex *v2, int side);
-void delete_edge(struct edge *e);
-void splice(struct edge *a, struct edge *b, struct vertex *v);
-struct edge *create_edge(struct vertex *v1, struct vertex *v2);
+unsigned int join(struct edge_pool *pool, unsigned int e1, unsigned int v1,
+		  unsigned int e2, unsigned int v2, int side);
+void delete_edge(struct edge_pool *pool, unsigned int e);
+void splice(unsigned int a, unsigned int b, unsigned int v);
+unsigned int create_edge(struct edge_pool *pool, unsigned int v1,
+			 unsigned int v2);
 
 #endif
@@ -43,57 +43,90 @@
  **************************************************************/
 
 #include <stddef.h>
-#include "defs.h"
+#include <grass/gis.h>
 #include "data_types.h"
+#include "defs.h"
 #include "memory.h"
 #include "geometry.h"
 #include "geom_primitives.h"
 #include "edge.h"
 
-static void find_lowest_cross_edge(struct edge *r_cw_l, struct vertex *s,
-				   struct edge *l_ccw_r, struct vertex *u,
-				   struct edge **l_lower,
-				   struct vertex **org_l_lower,
-				   struct edge **r_lower,
-				   struct vertex **org_r_lower);
+/* vertex by index */
+#define V(i) (&sites[i])
+
+/* minimum number of sites of the parts triangulated by separate threads */
+#define MIN_PART_SITES 1024
 
-static void merge(struct edge *r_cw_l, struct vertex *s,
-		  struct edge *l_ccw_r, struct vertex *u,
-		  struct edge **l_tangent);
+static void find_lowest_cross_edge(unsigned int r_cw_l, unsigned int s,
+				   unsigned int l_ccw_r, unsigned int u,
+				   unsigned int *l_lower,
+				   unsigned int *org_l_lower,
+				   unsigned int *r_lower,
+				   unsigned int *org_r_lower);
 
-void divide(unsigned int l, unsigned int r,
-	    struct edge **l_ccw, struct edge **r_cw)
+static void merge(struct edge_pool *pool,
+		  unsigned int r_cw_l, unsigned int s,
+		  unsigned int l_ccw_r, unsigned int u,
+		  unsigned int *l_tangent);
+
+/*
+ *  Merge the triangulations of the sites l to split and split + 1 to r
+ */
+static void merge_halves(struct edge_pool *pool, unsigned int l,
+			 unsigned int split, unsigned int r,
+			 unsigned int l_ccw_l, unsigned int r_cw_l,
+			 unsigned int l_ccw_r, unsigned int r_cw_r,
+			 unsigned int *l_ccw, unsigned int *r_cw)
+{
+    unsigned int l_tangent;
+
+    /* Merge the two triangulations */
+    merge(pool, r_cw_l, split, l_ccw_r, split + 1, &l_tangent);
+
+    /* The lower tangent added by merge may have invalidated 
+       l_ccw_l or r_cw_r. Update them if necessary. */
+    if (ORG(l_tangent) == l)
+	l_ccw_l = l_tangent;
+    if (DEST(l_tangent) == r)
+	r_cw_r = l_tangent;
+
+    /* Update leftmost ccw edge and rightmost cw edge */
+    *l_ccw = l_ccw_l;
+    *r_cw = r_cw_r;
+}
+
+void divide(struct edge_pool *pool, unsigned int l, unsigned int r,
+	    unsigned int *l_ccw, unsigned int *r_cw)
 {
 
     unsigned int n;
     unsigned int split;
-    struct edge *l_ccw_l, *r_cw_l, *l_ccw_r, *r_cw_r, *l_tangent;
-    struct edge *a, *b, *c;
+    unsigned int l_ccw_l, r_cw_l, l_ccw_r, r_cw_r;
+    unsigned int a, b, c;
     double c_p;
 
     n = r - l + 1;
     if (n == 2) {
 	/* Base case #1 - 2 sites in region. Construct an edge from 
 	   two sites in the region       */
-	*l_ccw = *r_cw = create_edge(&(sites[l]), &(sites[r]));
+	*l_ccw = *r_cw = create_edge(pool, l, r);
     }
     else if (n == 3) {
 	/* Base case #2 - 3 sites. Construct a triangle or two edges */
-	a = create_edge(&(sites[l]), &(sites[l + 1]));
-	b = create_edge(&(sites[l + 1]), &(sites[r]));
-	splice(a, b, &(sites[l + 1]));
-	c_p =
-	    CROSS_PRODUCT_3P(&(sites[l]), &(sites[l + 1]), &(sites[r]));
+	a = create_edge(pool, l, l + 1);
+	b = create_edge(pool, l + 1, r);
+	splice(a, b, l + 1);
+	c_p = CROSS_PRODUCT_3P(V(l), V(l + 1), V(r));
 
 	if (c_p > 0.0) {
 	    /* Create a triangle */
-	    c = join(a, &(sites[l]), b, &(sites[r]), RIGHT);
+	    c = join(pool, a, l, b, r, RIGHT);
 	    *l_ccw = a;
 	    *r_cw = b;
 	}
 	else if (c_p < 0.0) {
 	    /* Create a triangle */
-	    c = join(a, &(sites[l]), b, &(sites[r]), LEFT);
+	    c = join(pool, a, l, b, r, LEFT);
 	    *l_ccw = c;
 	    *r_cw = c;
 	}
@@ -111,38 +144,130 @@ void divide(unsigned int l, unsigned int r,
 	split = (l + r) / 2;
 
 	/* Divide into two halves */
-	divide(l, split, &l_ccw_l, &r_cw_l);
-	divide(split + 1, r, &l_ccw_r, &r_cw_r);
-
-	/* Merge the two triangulations */
-	merge(r_cw_l, &(sites[split]), l_ccw_r, &(sites[split + 1]),
-	      &l_tangent);
-
-	/* The lower tangent added by merge may have invalidated 
-	   l_ccw_l or r_cw_r. Update them if necessary. */
-	if (ORG(l_tangent) == &(sites[l]))
-	    l_ccw_l = l_tangent;
-	if (DEST(l_tangent) == &(sites[r]))
-	    r_cw_r = l_tangent;
-
-	/* Update leftmost ccw edge and rightmost cw edge */
-	*l_ccw = l_ccw_l;
-	*r_cw = r_cw_r;
+	divide(pool, l, split, &l_ccw_l, &r_cw_l);
+	divide(pool, split + 1, r, &l_ccw_r, &r_cw_r);
+
+	merge_halves(pool, l, split, r, l_ccw_l, r_cw_l, l_ccw_r, r_cw_r,
+		     l_ccw, r_cw);
+    }
+}
+
+/* a part of the triangulation, the nodes of the upper levels of the
+   recursion of divide() */
+struct part
+{
+    unsigned int l, r;
+    unsigned int l_ccw, r_cw;
+    struct edge_pool pool;
+};
+
+struct level
+{
+    struct part *parts;		/* parts of this level */
+    struct part *children;	/* parts of the next lower level */
+};
+
+static void divide_parts(int first, int last, void *closure)
+{
+    struct level *lev = closure;
+    int i;
+
+    for (i = first; i < last; i++) {
+	struct part *p = &lev->parts[i];
+
+	init_pool(&p->pool, p->l, p->r);
+	divide(&p->pool, p->l, p->r, &p->l_ccw, &p->r_cw);
+    }
+}
+
+static void merge_parts(int first, int last, void *closure)
+{
+    struct level *lev = closure;
+    int i;
+
+    for (i = first; i < last; i++) {
+	struct part *p = &lev->parts[i];
+	struct part *left = &lev->children[2 * i];
+	struct part *right = &lev->children[2 * i + 1];
+
+	join_pools(&left->pool, &right->pool);
+	p->pool = left->pool;
+	merge_halves(&p->pool, p->l, left->r, p->r,
+		     left->l_ccw, left->r_cw, right->l_ccw, right->r_cw,
+		     &p->l_ccw, &p->r_cw);
     }
 }
 
+/*
+ *  Triangulate the sorted sites 0 to n - 1. The parts of the upper 
+ *  levels of the recursion are built level by level, the parts of a 
+ *  level by several threads. The parts are the same as those of 
+ *  divide(), so the triangulation does not depend on the number of 
+ *  threads.
+ */
+void triangulate(unsigned int n, int nprocs, unsigned int *l_ccw,
+		 unsigned int *r_cw)
+{
+    struct part **levels;
+    struct level lev;
+    int depth, d, i;
+
+    depth = 0;
+    while (nprocs > 1 && (1 << depth) < 4 * nprocs &&
+	   n >> (depth + 1) >= MIN_PART_SITES)
+	depth++;
+
+    /* split the sites like divide() */
+    levels = G_malloc((depth + 1) * sizeof(struct part *));
+    for (d = 0; d <= depth; d++) {
+	levels[d] = G_malloc((1 << d) * sizeof(struct part));
+	for (i = 0; i < (1 << d); i++) {
+	    struct part *p = &levels[d][i];
+
+	    if (d == 0) {
+		p->l = 0;
+		p->r = n - 1;
+	    }
+	    else {
+		struct part *parent = &levels[d - 1][i / 2];
+		unsigned int split = (parent->l + parent->r) / 2;
+
+		p->l = i % 2 ? split + 1 : parent->l;
+		p->r = i % 2 ? parent->r : split;
+	    }
+	}
+    }
+
+    lev.parts = levels[depth];
+    lev.children = NULL;
+    G_parallel_for(0, 1 << depth, 1, divide_parts, &lev);
+
+    for (d = depth - 1; d >= 0; d--) {
+	lev.parts = levels[d];
+	lev.children = levels[d + 1];
+	G_parallel_for(0, 1 << d, 1, merge_parts, &lev);
+    }
+
+    *l_ccw = levels[0][0].l_ccw;
+    *r_cw = levels[0][0].r_cw;
+
+    for (d = 0; d <= depth; d++)
+	G_free(levels[d]);
+    G_free(levels);
+}
+
 /*
  *  Find the lowest cross edge of the two triangulations
  */
-static void find_lowest_cross_edge(struct edge *r_cw_l, struct vertex *s,
-				   struct edge *l_ccw_r, struct vertex *u,
-				   struct edge **l_lower,
-				   struct vertex **org_l_lower,
-				   struct edge **r_lower,
-				   struct vertex **org_r_lower)
+static void find_lowest_cross_edge(unsigned int r_cw_l, unsigned int s,
+				   unsigned int l_ccw_r, unsigned int u,
+				   unsigned int *l_lower,
+				   unsigned int *org_l_lower,
+				   unsigned int *r_lower,
+				   unsigned int *org_r_lower)
 {
-    struct edge *l, *r;
-    struct vertex *o_l, *o_r, *d_l, *d_r;
+    unsigned int l, r;
+    unsigned int o_l, o_r, d_l, d_r;
     unsigned char ready;
 
     l = r_cw_l;
@@ -155,13 +280,13 @@ static void find_lowest_cross_edge(struct edge *r_cw_l, struct vertex *s,
 
     while (ready == FALSE)
 	/* left_of */
-	if (LEFT_OF(o_l, d_l, o_r)) {
+	if (LEFT_OF(V(o_l), V(d_l), V(o_r))) {
 	    l = PREV(l, d_l);
 	    o_l = d_l;
 	    d_l = OTHER_VERTEX(l, o_l);
 	    /* right_of */
 	}
-	else if (RIGHT_OF(o_r, d_r, o_l)) {
+	else if (RIGHT_OF(V(o_r), V(d_r), V(o_l))) {
 	    r = NEXT(r, d_r);
 	    o_r = d_r;
 	    d_r = OTHER_VERTEX(r, o_r);
@@ -178,12 +303,13 @@ static void find_lowest_cross_edge(struct edge *r_cw_l, struct vertex *s,
 /* 
  *  The most time-expensive function, most of the work gets done here.
  */
-static void merge(struct edge *r_cw_l, struct vertex *s,
-		  struct edge *l_ccw_r, struct vertex *u,
-		  struct edge **l_tangent)
+static void merge(struct edge_pool *pool,
+		  unsigned int r_cw_l, unsigned int s,
+		  unsigned int l_ccw_r, unsigned int u,
+		  unsigned int *l_tangent)
 {
-    struct edge *base, *l_cand, *r_cand;
-    struct vertex *org_base, *dest_base;
+    unsigned int base, l_cand, r_cand;
+    unsigned int org_base, dest_base;
     double u_l_c_o_b, v_l_c_o_b, u_l_c_d_b, v_l_c_d_b;
     double u_r_c_o_b, v_r_c_o_b, u_r_c_d_b, v_r_c_d_b;
 
@@ -193,15 +319,15 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
     /* dot product */
     double d_p_l_cand, d_p_r_cand;
     unsigned char above_l_cand, above_r_cand, above_next, above_prev;
-    struct vertex *dest_l_cand, *dest_r_cand;
+    unsigned int dest_l_cand, dest_r_cand;
     double cot_l_cand, cot_r_cand;
-    struct edge *l_lower, *r_lower;
-    struct vertex *org_r_lower, *org_l_lower;
+    unsigned int l_lower, r_lower;
+    unsigned int org_r_lower, org_l_lower;
 
     /* Create first cross edge by joining lower common tangent */
     find_lowest_cross_edge(r_cw_l, s, l_ccw_r, u, &l_lower, &org_l_lower,
 			   &r_lower, &org_r_lower);
-    base = join(l_lower, org_l_lower, r_lower, org_r_lower, RIGHT);
+    base = join(pool, l_lower, org_l_lower, r_lower, org_r_lower, RIGHT);
     org_base = org_l_lower;
     dest_base = org_r_lower;
 
@@ -218,10 +344,10 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
 
 	/* Vectors used for above and modified IN_CIRCLE tests
 	   u/v left/right candidate origin/destination */
-	CREATE_VECTOR(dest_l_cand, org_base, u_l_c_o_b, v_l_c_o_b);
-	CREATE_VECTOR(dest_l_cand, dest_base, u_l_c_d_b, v_l_c_d_b);
-	CREATE_VECTOR(dest_r_cand, org_base, u_r_c_o_b, v_r_c_o_b);
-	CREATE_VECTOR(dest_r_cand, dest_base, u_r_c_d_b, v_r_c_d_b);
+	CREATE_VECTOR(V(dest_l_cand), V(org_base), u_l_c_o_b, v_l_c_o_b);
+	CREATE_VECTOR(V(dest_l_cand), V(dest_base), u_l_c_d_b, v_l_c_d_b);
+	CREATE_VECTOR(V(dest_r_cand), V(org_base), u_r_c_o_b, v_r_c_o_b);
+	CREATE_VECTOR(V(dest_r_cand), V(dest_base), u_r_c_d_b, v_r_c_d_b);
 
 	/* Above tests. */
 	c_p_l_cand =
@@ -241,8 +367,8 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
 	if (above_l_cand) {
 	    double u_n_o_b, v_n_o_b, u_n_d_b, v_n_d_b;
 	    double c_p_next, d_p_next, cot_next;
-	    struct edge *next;
-	    struct vertex *dest_next;
+	    unsigned int next;
+	    unsigned int dest_next;
 
 	    d_p_l_cand =
 		DOT_PRODUCT_2V(u_l_c_o_b, v_l_c_o_b, u_l_c_d_b, v_l_c_d_b);
@@ -251,8 +377,8 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
 	    while (TRUE) {
 		next = NEXT(l_cand, org_base);
 		dest_next = OTHER_VERTEX(next, org_base);
-		CREATE_VECTOR(dest_next, org_base, u_n_o_b, v_n_o_b);
-		CREATE_VECTOR(dest_next, dest_base, u_n_d_b, v_n_d_b);
+		CREATE_VECTOR(V(dest_next), V(org_base), u_n_o_b, v_n_o_b);
+		CREATE_VECTOR(V(dest_next), V(dest_base), u_n_d_b, v_n_d_b);
 		c_p_next =
 		    CROSS_PRODUCT_2V(u_n_o_b, v_n_o_b, u_n_d_b, v_n_d_b);
 		above_next = c_p_next > 0.0;
@@ -266,7 +392,7 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
 		if (cot_next > cot_l_cand)
 		    break;	/* Terminate loop. */
 
-		delete_edge(l_cand);
+		delete_edge(pool, l_cand);
 		l_cand = next;
 		cot_l_cand = cot_next;
 	    }
@@ -278,8 +404,8 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
 	if (above_r_cand) {
 	    double u_p_o_b, v_p_o_b, u_p_d_b, v_p_d_b;
 	    double c_p_prev, d_p_prev, cot_prev;
-	    struct edge *prev;
-	    struct vertex *dest_prev;
+	    unsigned int prev;
+	    unsigned int dest_prev;
 
 	    d_p_r_cand =
 		DOT_PRODUCT_2V(u_r_c_o_b, v_r_c_o_b, u_r_c_d_b, v_r_c_d_b);
@@ -288,8 +414,8 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
 	    while (TRUE) {
 		prev = PREV(r_cand, dest_base);
 		dest_prev = OTHER_VERTEX(prev, dest_base);
-		CREATE_VECTOR(dest_prev, org_base, u_p_o_b, v_p_o_b);
-		CREATE_VECTOR(dest_prev, dest_base, u_p_d_b, v_p_d_b);
+		CREATE_VECTOR(V(dest_prev), V(org_base), u_p_o_b, v_p_o_b);
+		CREATE_VECTOR(V(dest_prev), V(dest_base), u_p_d_b, v_p_d_b);
 		c_p_prev =
 		    CROSS_PRODUCT_2V(u_p_o_b, v_p_o_b, u_p_d_b, v_p_d_b);
 		above_prev = c_p_prev > 0.0;
@@ -303,7 +429,7 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
 		if (cot_prev > cot_r_cand)
 		    break;	/* Terminate. */
 
-		delete_edge(r_cand);
+		delete_edge(pool, r_cand);
 		r_cand = prev;
 		cot_r_cand = cot_prev;
 	    }
@@ -319,12 +445,12 @@ static void merge(struct edge *r_cw_l, struct vertex *s,
 	if (!above_l_cand ||
 	    (above_l_cand && above_r_cand && cot_r_cand < cot_l_cand)) {
 	    /* Connect to the right */
-	    base = join(base, org_base, r_cand, dest_r_cand, RIGHT);
+	    base = join(pool, base, org_base, r_cand, dest_r_cand, RIGHT);
 	    dest_base = dest_r_cand;
 	}
 	else {
 	    /* Connect to the left */
-	    base = join(l_cand, dest_l_cand, base, dest_base, RIGHT);
+	    base = join(pool, l_cand, dest_l_cand, base, dest_base, RIGHT);
 	    org_base = dest_l_cand;
 	}
     }
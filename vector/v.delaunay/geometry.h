@@ -1,6 +1,8 @@
 #ifndef GEOMETRY_H
 #define GEOMETRY_H
 
-void divide(unsigned int l, unsigned int r,
-	    struct edge **l_ccw, struct edge **r_cw);
+void divide(struct edge_pool *pool, unsigned int l, unsigned int r,
+	    unsigned int *l_ccw, unsigned int *r_cw);
+void triangulate(unsigned int n, int nprocs, unsigned int *l_ccw,
+		 unsigned int *r_cw);
 #endif
@@ -53,6 +53,7 @@
 #include "data_types.h"
 #include "memory.h"
 #include "edge.h"
+#include "geom_primitives.h"
 
 /* compare first according to x-coordinate, if equal then y-coordinate */
 int cmp(const void *a, const void *b)
@@ -77,10 +78,9 @@ int cmp(const void *a, const void *b)
 void output_edges(unsigned int n, int mode3d, int type,
 		  struct Map_info *Out)
 {
-    struct edge *e_start, *e;
+    unsigned int e_start, e;
     struct vertex *u, *v;
     unsigned int i;
-    double x1, y1, z1, x2, y2, z2;
 
     static struct line_pnts *Points = NULL;
     static struct line_cats *Cats = NULL;
@@ -96,88 +96,72 @@ void output_edges(unsigned int n, int mode3d, int type,
 	u = &(sites[i]);
 	e_start = e = u->entry_pt;
 	do {
-	    v = OTHER_VERTEX(e, u);
+	    v = &(sites[OTHER_VERTEX(e, i)]);
 	    if (cmp(u, v) == 1) {
-		x1 = u->x;
-		y1 = u->y;
-		z1 = u->z;
-		x2 = v->x;
-		y2 = v->y;
-		z2 = v->z;
-
 		Vect_reset_line(Points);
 
-		Vect_append_point(Points, x1, y1, z1);
-		Vect_append_point(Points, x2, y2, z2);
+		Vect_append_point(Points, u->x, u->y, u->z);
+		Vect_append_point(Points, v->x, v->y, v->z);
 		Vect_write_line(Out, type, Points, Cats);
 	    }
-	    e = NEXT(e, u);
+	    e = NEXT(e, i);
 	} while (!SAME_EDGE(e, e_start));
     }
     G_percent(1, 1, 1);
 }
 
-/* Print the ring of triangles about each vertex. */
-
-void output_triangles(unsigned int n,
-		      int mode3d, int type, struct Map_info *Out)
+/*
+ *  Write a centroid for each triangle. The triangles are found in the 
+ *  ring of triangles about each vertex, the centroid is the mean of 
+ *  the vertices of the triangle, which is on the plane of the triangle.
+ *  Returns the number of centroids written.
+ */
+int output_centroids(unsigned int n, struct Map_info *Out)
 {
-    struct edge *e_start, *e, *next;
-    struct vertex *u, *v, *w;
-    unsigned int i;
-    struct vertex *temp;
+    unsigned int e_start, e, next;
+    unsigned int i, v, w;
+    struct vertex *pu, *pv, *pw;
+    int cat;
 
     struct line_pnts *Points = Vect_new_line_struct();
     struct line_cats *Cats = Vect_new_cats_struct();
 
-    double x1, y1, z1, x2, y2, z2, x3, y3, z3;
-
+    G_message(_("Writing area centroids..."));
+    cat = 0;
     for (i = 0; i < n; i++) {
-	u = &(sites[i]);
-	e_start = e = u->entry_pt;
+	G_percent(i, n, 2);
+	pu = &(sites[i]);
+	e_start = e = pu->entry_pt;
 	do {
-	    v = OTHER_VERTEX(e, u);
-	    if (cmp(u, v) == 1) {
-		next = NEXT(e, u);
-		w = OTHER_VERTEX(next, u);
-		if (cmp(u, w) == 1)
-		    if (SAME_EDGE(NEXT(next, w), PREV(e, v))) {
-			/* Triangle. */
-			if (cmp(w, v) == 1) {
-			    temp = v;
-			    v = w;
-			    w = temp;
-			}
-			x1 = u->x;
-			y1 = u->y;
-			x2 = v->x;
-			y2 = v->y;
-			x3 = w->x;
-			y3 = w->y;
-			z1 = u->z;
-			z2 = v->z;
-			z3 = w->z;
-
-			Vect_reset_line(Points);
-			Vect_append_point(Points, x1, y1, z1);
-			Vect_append_point(Points, x2, y2, z2);
-			Vect_write_line(Out, type, Points, Cats);
-
-			Vect_reset_line(Points);
-			Vect_append_point(Points, x2, y2, z2);
-			Vect_append_point(Points, x3, y3, z3);
-			Vect_write_line(Out, type, Points, Cats);
-
-			Vect_reset_line(Points);
-			Vect_append_point(Points, x3, y3, z3);
-			Vect_append_point(Points, x1, y1, z1);
-			Vect_write_line(Out, type, Points, Cats);
-		    }
+	    v = OTHER_VERTEX(e, i);
+	    next = NEXT(e, i);
+	    w = OTHER_VERTEX(next, i);
+	    pv = &(sites[v]);
+	    pw = &(sites[w]);
+	    /* each triangle once, from its first vertex; the ring is ccw, 
+	       so only triangles turning left are faces of the 
+	       triangulation */
+	    if (cmp(pu, pv) == 1 && cmp(pu, pw) == 1 &&
+		SAME_EDGE(NEXT(next, w), PREV(e, v)) &&
+		CROSS_PRODUCT_3P(pu, pv, pw) > 0.0) {
+		Vect_reset_line(Points);
+		Vect_reset_cats(Cats);
+		Vect_append_point(Points, (pu->x + pv->x + pw->x) / 3.0,
+				  (pu->y + pv->y + pw->y) / 3.0,
+				  (pu->z + pv->z + pw->z) / 3.0);
+		Vect_cat_set(Cats, 1, ++cat);
+		Vect_write_line(Out, GV_CENTROID, Points, Cats);
 	    }
 	    /* Next edge around u. */
-	    e = NEXT(e, u);
+	    e = next;
 	} while (!SAME_EDGE(e, e_start));
     }
+    G_percent(1, 1, 1);
+
+    Vect_destroy_line_struct(Points);
+    Vect_destroy_cats_struct(Cats);
+
+    return cat;
 }
 
 void remove_duplicates(unsigned int *size)
@@ -237,7 +221,7 @@ int read_sites(int mode3d, int complete_map, struct Map_info* map_in,
 	    sites[nsites].z = 0.0;
 	}
 	/* Initialise entry edge vertices. */
-	sites[nsites].entry_pt = NULL;
+	sites[nsites].entry_pt = NO_EDGE;
 
 	nsites++;
 #if 0
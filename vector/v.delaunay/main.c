@@ -66,18 +66,16 @@ int main(int argc, char *argv[])
     struct bound_box Box;
     struct GModule *module;
     struct Flag *reg_flag, *line_flag;
-    struct Option *in_opt, *out_opt, *field_opt;
-
-    struct line_pnts *Points;
-    struct line_cats *Cats;
-    int nareas, area;
+    struct Option *in_opt, *out_opt, *field_opt, *nprocs_opt;
 
     int Type;
     int complete_map;
     int mode3d;
+    int nprocs;
     
     unsigned int n;
-    struct edge *l_cw, *r_ccw;
+    unsigned int l_cw, r_ccw;
+    int ncentroids;
 
     /* GRASS related manipulations */
     G_gisinit(argv[0]);
@@ -93,6 +91,8 @@ int main(int argc, char *argv[])
     field_opt->answer = "-1";
     out_opt = G_define_standard_option(G_OPT_V_OUTPUT);
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     reg_flag = G_define_flag();
     reg_flag->key = 'r';
     reg_flag->description = _("Use only points in current region");
@@ -112,9 +112,8 @@ int main(int argc, char *argv[])
 
     complete_map = reg_flag->answer ? 0 : 1;
 
-    Points = Vect_new_line_struct();
-    Cats = Vect_new_cats_struct();
-    
+    nprocs = G_set_nprocs(nprocs_opt);
+
     Vect_set_open_level(2);
     if (Vect_open_old2(&In, in_opt->answer, "", field_opt->answer) < 0)
 	G_fatal_error(_("Unable to open vector map <%s>"), in_opt->answer);
@@ -148,41 +147,19 @@ int main(int argc, char *argv[])
 	
     /* triangulate */
     G_verbose_message(_("Delaunay triangulation..."));
-    divide(0, n - 1, &l_cw, &r_ccw);
+    triangulate(n, nprocs, &l_cw, &r_ccw);
 
     output_edges(n, mode3d, Type, &Out);
 
-    free_memory();
-
+    /* the centroids are taken from the triangles, no areas need to be 
+       built for them */
     if (Type == GV_BOUNDARY) {
-	Vect_build_partial(&Out, GV_BUILD_AREAS);
-	nareas = Vect_get_num_areas(&Out);
-	G_debug(3, "nareas = %d", nareas);
-	/*  Assign centroid to each area */
-	G_message(_("Calculating area centroids..."));
-	for (area = 1; area <= nareas; area++) {
-	    double x, y, z, angle, slope;
-	    int ret;
-
-	    G_percent(area, nareas, 2);
-	    Vect_reset_line(Points);
-	    Vect_reset_cats(Cats);
-	    ret = Vect_get_point_in_area(&Out, area, &x, &y);
-	    if (ret < 0) {
-		G_warning(_("Unable to calculate area centroid"));
-		continue;
-	    }
-	    ret = Vect_tin_get_z(&Out, x, y, &z, &angle, &slope);
-	    G_debug(3, "area centroid z: %f", z);
-	    if (ret < 0) {
-		G_warning(_("Unable to calculate area centroid z coordinate"));
-		continue;
-	    }
-	    Vect_append_point(Points, x, y, z);
-	    Vect_cat_set(Cats, 1, area);
-	    Vect_write_line(&Out, GV_CENTROID, Points, Cats);
-	}
+	ncentroids = output_centroids(n, &Out);
+	G_debug(3, "ncentroids = %d", ncentroids);
     }
+
+    free_memory();
+
     Vect_build_partial(&Out, GV_BUILD_NONE); /* build topo from scratch */
     Vect_build(&Out);
     Vect_close(&Out);
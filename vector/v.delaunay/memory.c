@@ -43,38 +43,14 @@
  **************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
 #include <grass/gis.h>
 #include <grass/glocale.h>
-#include "defs.h"
 #include "data_types.h"
+#include "defs.h"
+#include "memory.h"
 
-static struct edge *edges;
-static struct edge **free_list_e;
-
-static unsigned int n_free_e;
-
-void alloc_memory(unsigned int n)
-{
-    struct edge *e;
-    int i;
-
-    /* Sites storage. */
-    sites = (struct vertex *)G_calloc(n, sizeof(struct vertex));
-    if (sites == NULL)
-	G_fatal_error(_("Not enough memory."));
-
-    /* Edges. Euler's formula - at most 3n edges on a set of n sites */
-    n_free_e = 3 * n;
-    edges = e = (struct edge *)G_calloc(n_free_e, sizeof(struct edge));
-    if (edges == NULL)
-	G_fatal_error(_("Not enough memory."));
-
-    free_list_e = (struct edge **)G_calloc(n_free_e, sizeof(struct edge *));
-    if (free_list_e == NULL)
-	G_fatal_error(_("Not enough memory."));
-    for (i = 0; i < n_free_e; i++, e++)
-	free_list_e[i] = e;
-}
+static unsigned int *free_list_e;
 
 void alloc_sites(unsigned int n)
 {
@@ -94,22 +70,43 @@ void realloc_sites(unsigned int n)
 
 void alloc_edges(unsigned int n)
 {
-    struct edge *e;
-    int i;
-
     /* Edges. Euler's formula - at most 3n edges on a set of n sites */
-    n_free_e = 3 * n;
-    edges = e = (struct edge *)G_calloc(n_free_e, sizeof(struct edge));
+    edges = (struct edge *)G_malloc((size_t)3 * n * sizeof(struct edge));
     if (edges == NULL)
 	G_fatal_error(_("Not enough memory."));
 
-    free_list_e = (struct edge **)G_calloc(n_free_e, sizeof(struct edge *));
+    free_list_e =
+	(unsigned int *)G_malloc((size_t)3 * n * sizeof(unsigned int));
     if (free_list_e == NULL)
 	G_fatal_error(_("Not enough memory."));
-    for (i = 0; i < n_free_e; i++, e++)
-	free_list_e[i] = e;
 }
 
+/* 
+ *  The triangulation of the sites l to r uses the edges 3 * l to
+ *  3 * r + 2, which is enough by Euler's formula. Parts of the
+ *  triangulation with separate pools can be built at the same time.
+ */
+void init_pool(struct edge_pool *pool, unsigned int l, unsigned int r)
+{
+    unsigned int i;
+
+    pool->base = 3 * l;
+    pool->n_free = 3 * (r - l + 1);
+    for (i = 0; i < pool->n_free; i++)
+	free_list_e[pool->base + i] = pool->base + i;
+}
+
+/* 
+ *  Add the free edges of the right pool to the left one, the right 
+ *  pool must be the one following the left pool.
+ */
+void join_pools(struct edge_pool *left, struct edge_pool *right)
+{
+    memmove(&free_list_e[left->base + left->n_free],
+	    &free_list_e[right->base], right->n_free * sizeof(unsigned int));
+    left->n_free += right->n_free;
+    right->n_free = 0;
+}
 
 void free_memory()
 {
@@ -118,14 +115,14 @@ void free_memory()
     G_free(free_list_e);
 }
 
-struct edge *get_edge()
+unsigned int get_edge(struct edge_pool *pool)
 {
-    if (n_free_e < 1)
+    if (pool->n_free < 1)
 	G_fatal_error(_("All allocated edges have been used."));
-    return (free_list_e[--n_free_e]);
+    return free_list_e[pool->base + --pool->n_free];
 }
 
-void free_edge(struct edge *e)
+void free_edge(struct edge_pool *pool, unsigned int e)
 {
-    free_list_e[n_free_e++] = e;
+    free_list_e[pool->base + pool->n_free++] = e;
 }
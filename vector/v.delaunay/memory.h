@@ -1,10 +1,11 @@
 #ifndef MEMORY_H
 #define MEMORY_H
-void alloc_memory(unsigned int n);
 void free_memory();
-struct edge *get_edge();
-void free_edge(struct edge *e);
 void alloc_sites(unsigned int n);
 void realloc_sites(unsigned int n);
 void alloc_edges(unsigned int n);
+void init_pool(struct edge_pool *pool, unsigned int l, unsigned int r);
+void join_pools(struct edge_pool *left, struct edge_pool *right);
+unsigned int get_edge(struct edge_pool *pool);
+void free_edge(struct edge_pool *pool, unsigned int e);
 #endif
@@ -38,6 +38,91 @@ int get_line_box(const struct line_pnts *Points,
     return 1;
 }
 
+void dist_buf_init(struct dist_buf *buf)
+{
+    buf->xPoints = Vect_new_line_struct();
+    buf->aPoints = Vect_new_line_struct();
+    buf->iPoints = NULL;
+    buf->ibox = NULL;
+    buf->isle_alloc = 0;
+}
+
+void dist_buf_free(struct dist_buf *buf)
+{
+    int i;
+
+    Vect_destroy_line_struct(buf->xPoints);
+    Vect_destroy_line_struct(buf->aPoints);
+    for (i = 0; i < buf->isle_alloc; i++)
+	Vect_destroy_line_struct(buf->iPoints[i]);
+    G_free(buf->iPoints);
+    G_free(buf->ibox);
+}
+
+/* features are read with the reader of the thread if any, else from
+ * the map on the main thread */
+int dist_read_line(const struct dist_map *dm, struct line_pnts *Points,
+		   struct line_cats *Cats, int line)
+{
+    if (dm->R)
+	return Vect_reader_read_line(dm->R, Points, Cats, line);
+
+    return Vect_read_line(dm->Map, Points, Cats, line);
+}
+
+int dist_get_area_points(const struct dist_map *dm, int area,
+			 struct line_pnts *Points)
+{
+    if (dm->R)
+	return Vect_reader_get_area_points(dm->R, area, Points);
+
+    return Vect_get_area_points(dm->Map, area, Points);
+}
+
+int dist_get_isle_points(const struct dist_map *dm, int isle,
+			 struct line_pnts *Points)
+{
+    if (dm->R)
+	return Vect_reader_get_isle_points(dm->R, isle, Points);
+
+    return Vect_get_isle_points(dm->Map, isle, Points);
+}
+
+/* categories of the centroid of an area as from Vect_get_area_cats() */
+int dist_get_area_cats(const struct dist_map *dm, int area,
+		       struct line_cats *Cats)
+{
+    int centroid;
+
+    Vect_reset_cats(Cats);
+    centroid = Vect_get_area_centroid(dm->Map, area);
+    if (centroid < 1)
+	return 1;
+
+    if (dist_read_line(dm, NULL, Cats, centroid) < 0)
+	return -1;
+
+    return 0;
+}
+
+int dist_select_lines(const struct dist_map *dm, const struct bound_box *box,
+		      int type, struct boxlist *list)
+{
+    if (dm->R)
+	return Vect_reader_select_lines_by_box(dm->R, box, type, list);
+
+    return Vect_select_lines_by_box(dm->Map, box, type, list);
+}
+
+int dist_select_areas(const struct dist_map *dm, const struct bound_box *box,
+		      struct boxlist *list)
+{
+    if (dm->R)
+	return Vect_reader_select_areas_by_box(dm->R, box, list);
+
+    return Vect_select_areas_by_box(dm->Map, box, list);
+}
+
 /* segment angle */
 double sangle(struct line_pnts *Points, int segment)
 {
@@ -60,7 +145,8 @@ double sangle(struct line_pnts *Points, int segment)
  * return 2 point to line
  * return 1 line to line
  */
-int line2line(struct line_pnts *FPoints, int ftype,
+int line2line(struct dist_buf *buf,
+              struct line_pnts *FPoints, int ftype,
               struct line_pnts *TPoints, int ttype,
 	      double *fx, double *fy, double *fz,
 	      double *falong, double *fangle,
@@ -72,11 +158,7 @@ int line2line(struct line_pnts *FPoints, int ftype,
     int i, fseg, tseg, tmp_seg;
     double tmp_dist, tmp_x, tmp_y, tmp_z, tmp_along;
     int ret = 1;
-    static struct line_pnts *iPoints = NULL;
-    
-    if (!iPoints) {
-	iPoints = Vect_new_line_struct();
-    }
+    struct line_pnts *iPoints = buf->xPoints;
 
     *dist = PORT_DOUBLE_MAX;
 
@@ -232,7 +314,7 @@ int line2line(struct line_pnts *FPoints, int ftype,
  * return 1 inside area 
  * return 2 inside isle of area 
  * return 3 outside area */
-int line2area(const struct Map_info *To,
+int line2area(const struct dist_map *To, struct dist_buf *buf,
 	      struct line_pnts *Points, int type,
 	      int area, const struct bound_box *abox,
 	      double *fx, double *fy, double *fz,
@@ -246,13 +328,9 @@ int line2area(const struct Map_info *To,
     double tmp_dist;
     int isle, nisles;
     int all_inside_outer, all_outside_outer, all_outside_inner;
-    static struct line_pnts *aPoints = NULL;
-    static struct line_pnts **iPoints = NULL;
-    static struct bound_box *ibox = NULL;
-    static int isle_alloc = 0;
-
-    if (!aPoints)
-	aPoints = Vect_new_line_struct();
+    struct line_pnts *aPoints = buf->aPoints;
+    struct line_pnts **iPoints;
+    struct bound_box *ibox;
 
     *dist = PORT_DOUBLE_MAX;
 
@@ -269,20 +347,29 @@ int line2area(const struct Map_info *To,
     *ty = Points->y[0];
     *tz = Points->z[0];
 
-    Vect_get_area_points(To, area, aPoints);
-    nisles = Vect_get_area_num_isles(To, area);
+    dist_get_area_points(To, area, aPoints);
+    nisles = Vect_get_area_num_isles(To->Map, area);
     
-    if (nisles > isle_alloc) {
-	iPoints = G_realloc(iPoints, nisles * sizeof(struct line_pnts *));
-	ibox = G_realloc(ibox, nisles * sizeof(struct bound_box));
-	for (i = isle_alloc; i < nisles; i++)
-	    iPoints[i] = Vect_new_line_struct();
-	isle_alloc = nisles;
+    if (nisles > buf->isle_alloc) {
+	buf->iPoints = G_realloc(buf->iPoints,
+				 nisles * sizeof(struct line_pnts *));
+	buf->ibox = G_realloc(buf->ibox, nisles * sizeof(struct bound_box));
+	for (i = buf->isle_alloc; i < nisles; i++)
+	    buf->iPoints[i] = Vect_new_line_struct();
+	buf->isle_alloc = nisles;
     }
+    iPoints = buf->iPoints;
+    ibox = buf->ibox;
     for (i = 0; i < nisles; i++) {
-	isle = Vect_get_area_isle(To, area, i);
-	Vect_get_isle_points(To, isle, iPoints[i]);
-	Vect_get_isle_box(To, isle, &ibox[i]);
+	isle = Vect_get_area_isle(To->Map, area, i);
+	dist_get_isle_points(To, isle, iPoints[i]);
+	/* the box of the isle boundaries as from Vect_get_isle_box(),
+	 * without a search of the spatial index */
+	get_line_box(iPoints[i], &ibox[i]);
+	if (!Vect_is_3d(To->Map)) {
+	    ibox[i].T = PORT_DOUBLE_MAX;
+	    ibox[i].B = -PORT_DOUBLE_MAX;
+	}
     }
 
     /* inside area ? */
@@ -313,7 +400,7 @@ int line2area(const struct Map_info *To,
 	    
 	    /* exactly on boundary */
 	    if (poly == 2) {
-		line2line(Points, type, aPoints, GV_BOUNDARY,
+		line2line(buf, Points, type, aPoints, GV_BOUNDARY,
 		          fx, fy, fz, falong, fangle,
 		          tx, ty, tz, talong, tangle,
 			  dist, with_z);
@@ -345,7 +432,7 @@ int line2area(const struct Map_info *To,
 
 			    /* pass all points of the line, 
 			     * this will catch an intersection */
-			    line2line(Points, type, iPoints[j], GV_BOUNDARY,
+			    line2line(buf, Points, type, iPoints[j], GV_BOUNDARY,
 				      &tmp_fx, &tmp_fy, &tmp_fz, &tmp_falong, &tmp_fangle,
 				      &tmp_tx, &tmp_ty, &tmp_tz, &tmp_talong, &tmp_tangle,
 				      &tmp_dist, with_z);
@@ -439,7 +526,7 @@ int line2area(const struct Map_info *To,
     /* if all line points are outside of the area,
      * intersection is still possible */
 
-    line2line(Points, type, aPoints, GV_BOUNDARY,
+    line2line(buf, Points, type, aPoints, GV_BOUNDARY,
 	      fx, fy, fz, falong, fangle,
 	      tx, ty, tz, talong, tangle,
 	      dist, with_z);
@@ -1,5 +1,6 @@
 #include <grass/vector.h>
 #include <grass/dbmi.h>
+#include <grass/kdtree.h>
 
 #ifndef _LOCAL_PROTO_
 #define _LOCAL_PROTO_
@@ -39,6 +40,37 @@ typedef struct
 } UPLOAD;
 
 
+/* map of a search, read with the reader of a thread or on the main
+ * thread if R is NULL */
+struct dist_map
+{
+    struct Map_info *Map;
+    struct Map_reader *R;
+};
+
+/* buffers of line2line() and line2area(), one set per thread */
+struct dist_buf
+{
+    struct line_pnts *xPoints;	/* intersections */
+    struct line_pnts *aPoints;	/* outer ring of area */
+    struct line_pnts **iPoints;	/* isles of area */
+    struct bound_box *ibox;
+    int isle_alloc;
+};
+
+/* parameters of the search of nearest features */
+struct near_search
+{
+    struct Map_info *From, *To;
+    int from_type, from_field, to_type, to_field;
+    int ntolines, ntoareas, nto;
+    int with_z, geodesic, do_all;
+    double min, max, max_map;
+    const double *max_step;
+    int n_max_steps;
+    struct kdtree *tpoints;	/* 'to' points or NULL */
+};
+
 typedef int dist_func(const struct line_pnts *, double, double, double, int,
                        double *, double *, double *, double *, double *,
                        double *);
@@ -52,7 +84,19 @@ int cmp_exist(const void *, const void *);
 /* distance.c */
 int get_line_box(const struct line_pnts *Points,
                  struct bound_box *box);
-int line2line(struct line_pnts *FPoints, int ftype,
+void dist_buf_init(struct dist_buf *);
+void dist_buf_free(struct dist_buf *);
+int dist_read_line(const struct dist_map *, struct line_pnts *,
+		   struct line_cats *, int);
+int dist_get_area_points(const struct dist_map *, int, struct line_pnts *);
+int dist_get_isle_points(const struct dist_map *, int, struct line_pnts *);
+int dist_get_area_cats(const struct dist_map *, int, struct line_cats *);
+int dist_select_lines(const struct dist_map *, const struct bound_box *,
+		      int, struct boxlist *);
+int dist_select_areas(const struct dist_map *, const struct bound_box *,
+		      struct boxlist *);
+int line2line(struct dist_buf *buf,
+              struct line_pnts *FPoints, int ftype,
               struct line_pnts *TPoints, int ttype,
 	      double *fx, double *fy, double *fz,
 	      double *falong, double *fangle,
@@ -60,7 +104,7 @@ int line2line(struct line_pnts *FPoints, int ftype,
 	      double *talong, double *tangle,
 	      double *dist,
 	      int with_z);
-int line2area(const struct Map_info *To,
+int line2area(const struct dist_map *To, struct dist_buf *buf,
 	      struct line_pnts *Points, int type,
 	      int area, const struct bound_box *abox,
 	      double *fx, double *fy, double *fz,
@@ -70,6 +114,10 @@ int line2area(const struct Map_info *To,
 	      double *dist,
 	      int with_z);
 
+/* nearest.c */
+struct kdtree *build_point_tree(struct Map_info *, int, int);
+int find_nearest(const struct near_search *, int, NEAR **, int *, int, int);
+
 /* print.c */
 int print_upload(NEAR *, UPLOAD *, int, dbCatValArray *, dbCatVal *, char *);
 
@@ -71,6 +71,7 @@ int main(int argc, char *argv[])
 	struct Option *out, *max, *min, *table;
 	struct Option *upload, *column, *to_column;
 	struct Option *sep;
+	struct Option *nprocs;
     } opt;
     struct {
 	struct Flag *print, *all;
@@ -90,17 +91,14 @@ int main(int argc, char *argv[])
     double max, min;
     double *max_step, max_map;
     int n_max_steps, curr_step;
-    struct line_pnts *FPoints, *TPoints;
-    struct line_cats *FCats, *TCats;
-    NEAR *Near, *near;
+    struct line_pnts *FPoints;
+    struct line_cats *FCats;
+    NEAR *Near;
     int anear;			/* allocated space, used only for do_all */
     UPLOAD *Upload;		/* zero terminated */
-    int ftype, ttype, fcat, nfcats, tcat, count, fline, tfeature;
+    int ftype, fcat, nfcats, count;
     int nfrom, nfromlines, nfromareas, nto, ntolines, ntoareas;
-    int tarea, area, isle, nisles, nlines;
-    double fx, fy, fz, falong, fangle, tx, ty, tz, talong, tangle, dist;
-    double tmp_fx, tmp_fy, tmp_fz, tmp_falong, tmp_fangle, tmp_dist;
-    double tmp_tx, tmp_ty, tmp_tz, tmp_talong, tmp_tangle;
+    int nlines;
     int geodesic;
     struct field_info *Fi, *toFi;
     dbString stmt, dbstr;
@@ -109,7 +107,7 @@ int main(int argc, char *argv[])
     char buf1[2000], buf2[2000], to_attr_sqltype[256];
     int update_ok, update_err, update_exist, update_notexist, update_dupl,
 	update_notfound, sqltype;
-    struct boxlist *lList, *aList;
+    struct near_search search;
     struct bound_box fbox, box;
     dbCatValArray cvarr;
     dbColumn *column;
@@ -238,6 +236,8 @@ int main(int argc, char *argv[])
     opt.sep = G_define_standard_option(G_OPT_F_SEP);
     opt.sep->label = _("Field separator for printing output to stdout");
 
+    opt.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.print = G_define_flag();
     flag.print->key = 'p';
     flag.print->label =
@@ -271,6 +271,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(opt.nprocs);
+
     geodesic = G_projection() == PROJECTION_LL;
     if (geodesic)
 	line_distance = Vect_line_geodesic_distance;
@@ -634,11 +636,7 @@ int main(int argc, char *argv[])
     }
 
     FPoints = Vect_new_line_struct();
-    TPoints = Vect_new_line_struct();
     FCats = Vect_new_cats_struct();
-    TCats = Vect_new_cats_struct();
-    lList = Vect_new_boxlist(1); /* line list */
-    aList = Vect_new_boxlist(1); /* area list */
 
     /* Allocate space ( may be more than needed (duplicate cats and elements
      * without cats) ) */
@@ -690,652 +688,47 @@ int main(int argc, char *argv[])
     }
 
     /* Go through all lines in 'from' and find nearest in 'to' for each */
-    /* Note: as from_type is restricted to GV_POINTS (for now) everything is
-     * simple */
-
-    /* suppress compiler warnings */
-    tx = ty = tz = fx = fy = fz = 0;
+    search.From = &From;
+    search.To = &To;
+    search.from_type = from_type;
+    search.from_field = from_field;
+    search.to_type = to_type;
+    search.to_field = to_field;
+    search.ntolines = ntolines;
+    search.ntoareas = ntoareas;
+    search.nto = nto;
+    search.with_z = with_z;
+    search.geodesic = geodesic;
+    search.do_all = do_all;
+    search.min = min;
+    search.max = max;
+    search.max_map = max_map;
+    search.max_step = max_step;
+    search.n_max_steps = n_max_steps;
+
+    /* nearest 'to' points of 'from' points without a minimum distance
+     * from a k-d tree instead of growing search boxes */
+    search.tpoints = NULL;
+    if (!do_all && !geodesic && min <= 0 && ntolines > 0 && ntoareas == 0 &&
+	!(to_type & GV_LINES) && (from_type & GV_POINTS))
+	search.tpoints = build_point_tree(&To, to_type, with_z);
 
     count = 0;			/* count of distances in 'do_all' mode */
     /* Find nearest features for 'from' lines */
     if (nfromlines) {
 	G_message(_("Finding nearest features..."));
-
-	near = NULL;
-	nlines = Vect_get_num_lines(&From);
-
-	G_percent(0, nlines, 4);
-	for (fline = 1; fline <= nlines; fline++) {
-	    int tmp_tcat;
-	    double tmp_min = (min < 0 ? 0 : min);
-	    double box_edge = 0;
-	    int done = FALSE;
-
-	    if (geodesic)
-		tmp_min = 0;
-
-	    curr_step = 0;
-
-	    G_debug(3, "fline = %d", fline);
-	    G_percent(fline, nlines, 4);
-	    ftype = Vect_get_line_type(&From, fline);
-	    if (!(ftype & from_type))
-		continue;
-
-	    Vect_read_line(&From, FPoints, FCats, fline);
-	    Vect_cat_get(FCats, from_field, &fcat);
-	    if (fcat < 0 && !do_all)
-		continue;
-
-	    get_line_box(FPoints, &fbox);
-
-	    if (!do_all) {
-		/* find near by 'from' cat */
-		near = (NEAR *) bsearch((void *)&fcat, Near, nfcats,
-				        sizeof(NEAR), cmp_near);
-	    }
-
-	    dist = PORT_DOUBLE_MAX; /* distance to nearest 'to' feature */
-
-	    while (!done) {
-		done = TRUE;
-
-		tfeature = 0;  /* id of nearest 'to' feature */
-
-		if (!do_all) {
-		    /* enlarge search box until we get a hit */
-		    /* the objective is to enlarge the search box
-		     * in the first iterations just a little bit
-		     * to keep the number of hits low */
-		    while (curr_step < n_max_steps) {
-			box_edge = max_step[curr_step];
-			curr_step++;
-
-			if (box_edge < tmp_min)
-			    continue;
-
-			box.E = fbox.E + box_edge;
-			box.W = fbox.W - box_edge;
-			box.N = fbox.N + box_edge;
-			box.S = fbox.S - box_edge;
-			box.T = PORT_DOUBLE_MAX;
-			box.B = -PORT_DOUBLE_MAX;
-
-			if (ntolines)
-			    Vect_select_lines_by_box(&To, &box, to_type, lList);
-			if (ntoareas)
-			    Vect_select_areas_by_box(&To, &box, aList);
-
-			if (lList->n_values > 0 || aList->n_values > 0)
-			    break;
-		    }
-		}
-		else {
-		    box.E = fbox.E + max_map;
-		    box.W = fbox.W - max_map;
-		    box.N = fbox.N + max_map;
-		    box.S = fbox.S - max_map;
-		    box.T = PORT_DOUBLE_MAX;
-		    box.B = -PORT_DOUBLE_MAX;
-
-		    if (ntolines)
-			Vect_select_lines_by_box(&To, &box, to_type, lList);
-		    if (ntoareas)
-			Vect_select_areas_by_box(&To, &box, aList);
-		}
-
-		for (i = 0; i < lList->n_values; i++) {
-		    ttype = Vect_read_line(&To, TPoints, TCats, lList->id[i]);
-
-		    line2line(FPoints, ftype, TPoints, ttype,
-		              &tmp_fx, &tmp_fy, &tmp_fz, &tmp_falong, &tmp_fangle,
-		              &tmp_tx, &tmp_ty, &tmp_tz, &tmp_talong, &tmp_tangle,
-			      &tmp_dist, with_z);
-
-		    if (tmp_dist > max || tmp_dist < min)
-			continue;	/* not in threshold */
-
-		    tmp_tcat = -1;
-		    /* TODO: all cats of given field ? */
-		    for (j = 0; j < TCats->n_cats; j++) {
-			if (TCats->field[j] == to_field) {
-			    if (tmp_tcat >= 0)
-				G_warning(_("More cats found in to_layer (line=%d)"),
-					  lList->id[i]);
-			    tmp_tcat = TCats->cat[j];
-			}
-		    }
-
-		    G_debug(4, "  tmp_dist = %f tmp_tcat = %d", tmp_dist,
-			    tmp_tcat);
-
-		    if (do_all) {
-			if (anear <= count) {
-			    anear += 10 + nto / 10;
-			    Near = (NEAR *) G_realloc(Near, anear * sizeof(NEAR));
-			    if (!Near)
-				G_fatal_error(_("Out of memory!"));
-			}
-			near = &(Near[count]);
-
-			/* store info about relation */
-			near->from_cat = fcat;
-			near->to_cat = tmp_tcat;	/* -1 is OK */
-			near->dist = tmp_dist;
-			near->from_x = tmp_fx;
-			near->from_y = tmp_fy;
-			near->from_z = tmp_fz;
-			near->from_along = tmp_falong;	/* 0 for points */
-			near->from_angle = tmp_fangle;
-			near->to_x = tmp_tx;
-			near->to_y = tmp_ty;
-			near->to_z = tmp_tz;
-			near->to_along = tmp_talong;	/* 0 for points */
-			near->to_angle = tmp_tangle;
-			near->count++;
-			count++;
-		    }
-		    else {
-			if (tfeature == 0 || (tmp_dist < dist)) {
-			    tfeature = lList->id[i];
-			    tcat = tmp_tcat;
-			    dist = tmp_dist;
-			    fx = tmp_fx;
-			    fy = tmp_fy;
-			    fz = tmp_fz;
-			    falong = tmp_falong;
-			    fangle = tmp_fangle;
-			    tx = tmp_tx;
-			    ty = tmp_ty;
-			    tz = tmp_tz;
-			    talong = tmp_talong;
-			    tangle = tmp_tangle;
-			}
-		    }
-		}
-
-		G_debug(3, "  %d areas in box", aList->n_values);
-
-		for (i = 0; i < aList->n_values; i++) {
-		    /* ignore isles OK ? */
-		    if (Vect_get_area_centroid(&To, aList->id[i]) == 0)
-			continue;
-
-		    line2area(&To, FPoints, ftype, aList->id[i], &aList->box[i],
-		              &tmp_fx, &tmp_fy, &tmp_fz, &tmp_falong, &tmp_fangle,
-		              &tmp_tx, &tmp_ty, &tmp_tz, &tmp_talong, &tmp_tangle,
-			      &tmp_dist, with_z);
-
-		    if (tmp_dist > max || tmp_dist < min)
-			continue;	/* not in threshold */
-
-		    /* TODO: more cats of the same field */
-		    Vect_get_area_cats(&To, aList->id[i], TCats);
-		    tmp_tcat = -1;
-
-		    /* TODO: all cats of given field ? */
-		    for (j = 0; j < TCats->n_cats; j++) {
-			if (TCats->field[j] == to_field) {
-			    if (tmp_tcat >= 0)
-				G_warning(_("More cats found in to_layer (area=%d)"),
-					  aList->id[i]);
-			    tmp_tcat = TCats->cat[j];
-			}
-		    }
-
-		    G_debug(4, "  tmp_dist = %f tmp_tcat = %d", tmp_dist,
-			    tmp_tcat);
-
-		    if (do_all) {
-			if (anear <= count) {
-			    anear += 10 + nto / 10;
-			    Near = (NEAR *) G_realloc(Near, anear * sizeof(NEAR));
-			    if (!Near)
-				G_fatal_error(_("Out of memory!"));
-			}
-			near = &(Near[count]);
-
-			/* store info about relation */
-			near->from_cat = fcat;
-			near->to_cat = tmp_tcat;	/* -1 is OK */
-			near->dist = tmp_dist;
-			near->from_x = tmp_fx;
-			near->from_y = tmp_fy;
-			near->from_z = tmp_fz;
-			near->from_along = tmp_falong;	/* 0 for points */
-			near->from_angle = tmp_fangle;
-			near->to_x = tmp_tx;
-			near->to_y = tmp_ty;
-			near->to_z = tmp_tz;
-			near->to_along = tmp_talong;	/* 0 for points */
-			near->to_angle = tmp_tangle;
-			near->count++;
-			count++;
-		    }
-		    else {
-			if (tfeature == 0 || (tmp_dist < dist)) {
-			    tfeature = aList->id[i];
-			    tcat = tmp_tcat;
-			    dist = tmp_dist;
-			    fx = tmp_fx;
-			    fy = tmp_fy;
-			    fz = tmp_fz;
-			    falong = tmp_falong;
-			    fangle = tmp_fangle;
-			    tx = tmp_tx;
-			    ty = tmp_ty;
-			    tz = tmp_tz;
-			    talong = tmp_talong;
-			    tangle = tmp_tangle;
-			}
-		    }
-		}
-
-		G_debug(4, "  dist = %f", dist);
-
-		if (!do_all && curr_step < n_max_steps) {
-		    double dist_map = dist;
-
-		    if (geodesic && tfeature > 0) {
-			double dx = fx - tx;
-			double dy = fy - ty;
-			double dz = fz - tz;
-
-			dist_map = sqrt(dx * dx + dy * dy + dz * dz);
-		    }
-		    /* enlarging the search box is possible */
-		    if (tfeature > 0 && dist_map > box_edge) {
-			/* line found but distance > search edge:
-			 * line bbox overlaps with search box, line itself is
-			 * outside search box */
-			done = FALSE;
-		    }
-		    else if (tfeature == 0) {
-			/* no line within max dist, but search box can still be
-			 * enlarged */
-			done = FALSE;
-		    }
-		}
-		if (done && !do_all && tfeature > 0) {
-
-		    G_debug(4, "  near->from_cat = %d near->count = %d",
-			    near->from_cat, near->count);
-		    /* store info about relation */
-		    if (near->count == 0 || near->dist > dist) {
-			near->to_cat = tcat;	/* -1 is OK */
-			near->dist = dist;
-			near->from_x = fx;
-			near->from_y = fy;
-			near->from_z = fz;
-			near->from_along = falong;	/* 0 for points */
-			near->from_angle = fangle;
-			near->to_x = tx;
-			near->to_y = ty;
-			near->to_z = tz;
-			near->to_along = talong;	/* 0 for points */
-			near->to_angle = tangle;
-		    }
-		    near->count++;
-		}
-	    } /* done searching 'to' */
-	} /* next from feature */
+	count = find_nearest(&search, FALSE, &Near, &anear, nfcats, count);
     }
 
     /* Find nearest features for 'from' areas */
-    /* the code is pretty much identical to the one for lines */
     if (nfromareas) {
-
-	near = NULL;
-
 	G_message(_("Finding nearest features for areas..."));
-	G_percent(0, nfromareas, 2);
-	for (area = 1; area <= nfromareas; area++) {
-	    int tmp_tcat;
-	    double tmp_min = (min < 0 ? 0 : min);
-	    double box_edge = 0;
-	    int done = FALSE;
-
-	    if (geodesic)
-		tmp_min = 0;
-
-	    curr_step = 0;
-
-	    G_debug(3, "farea = %d", area);
-	    G_percent(area, nfromareas, 2);
-
-	    if (Vect_get_area_cats(&From, area, FCats) == 1)
-		/* ignore isles OK ? */
-		continue;
-
-	    Vect_cat_get(FCats, from_field, &fcat);
-	    if (fcat < 0 && !do_all)
-		continue;
-
-	    Vect_get_area_box(&From, area, &fbox);
-	    Vect_reset_line(FPoints);
-
-	    if (!do_all) {
-		/* find near by 'from' cat */
-		near = (NEAR *) bsearch((void *)&fcat, Near, nfcats,
-				        sizeof(NEAR), cmp_near);
-	    }
-
-	    dist = PORT_DOUBLE_MAX; /* distance to nearest 'to' feature */
-
-	    while (!done) {
-		done = TRUE;
-
-		tfeature = 0;  /* id of nearest 'to' feature */
-
-		if (!do_all) {
-		    /* enlarge search box until we get a hit */
-		    /* the objective is to enlarge the search box
-		     * in the first iterations just a little bit
-		     * to keep the number of hits low */
-		    while (curr_step < n_max_steps) {
-			box_edge = max_step[curr_step];
-			curr_step++;
-
-			if (box_edge < tmp_min)
-			    continue;
-
-			box.E = fbox.E + box_edge;
-			box.W = fbox.W - box_edge;
-			box.N = fbox.N + box_edge;
-			box.S = fbox.S - box_edge;
-			box.T = PORT_DOUBLE_MAX;
-			box.B = -PORT_DOUBLE_MAX;
-
-			if (ntolines)
-			    Vect_select_lines_by_box(&To, &box, to_type, lList);
-			if (ntoareas)
-			    Vect_select_areas_by_box(&To, &box, aList);
-
-			if (lList->n_values > 0 || aList->n_values > 0)
-			    break;
-		    }
-		}
-		else {
-		    box.E = fbox.E + max_map;
-		    box.W = fbox.W - max_map;
-		    box.N = fbox.N + max_map;
-		    box.S = fbox.S - max_map;
-		    box.T = PORT_DOUBLE_MAX;
-		    box.B = -PORT_DOUBLE_MAX;
-
-		    if (ntolines)
-			Vect_select_lines_by_box(&To, &box, to_type, lList);
-		    if (ntoareas)
-			Vect_select_areas_by_box(&To, &box, aList);
-		}
-
-		G_debug(3, "  %d lines in box", lList->n_values);
-
-		for (i = 0; i < lList->n_values; i++) {
-		    ttype = Vect_read_line(&To, TPoints, TCats, lList->id[i]);
-
-		    /* area to line */
-		    line2area(&From, TPoints, ttype, area, &fbox,
-		              &tmp_tx, &tmp_ty, &tmp_tz, &tmp_talong, &tmp_tangle,
-		              &tmp_fx, &tmp_fy, &tmp_fz, &tmp_falong, &tmp_fangle,
-			      &tmp_dist, with_z);
-
-		    if (tmp_dist > max || tmp_dist < min)
-			continue;	/* not in threshold */
-
-		    tmp_tcat = -1;
-		    /* TODO: all cats of given field ? */
-		    for (j = 0; j < TCats->n_cats; j++) {
-			if (TCats->field[j] == to_field) {
-			    if (tmp_tcat >= 0)
-				G_warning(_("More cats found in to_layer (line=%d)"),
-					  lList->id[i]);
-			    tmp_tcat = TCats->cat[j];
-			}
-		    }
-
-		    G_debug(4, "  tmp_dist = %f tmp_tcat = %d", tmp_dist,
-			    tmp_tcat);
-
-		    if (do_all) {
-			if (anear <= count) {
-			    anear += 10 + nto / 10;
-			    Near = (NEAR *) G_realloc(Near, anear * sizeof(NEAR));
-			    if (!Near)
-				G_fatal_error(_("Out of memory!"));
-			}
-			near = &(Near[count]);
-
-			/* store info about relation */
-			near->from_cat = fcat;
-			near->to_cat = tmp_tcat;	/* -1 is OK */
-			near->dist = tmp_dist;
-			near->from_x = tmp_fx;
-			near->from_y = tmp_fy;
-			near->from_z = tmp_fz;
-			near->from_along = tmp_falong;	/* 0 for points */
-			near->from_angle = tmp_fangle;
-			near->to_x = tmp_tx;
-			near->to_y = tmp_ty;
-			near->to_z = tmp_tz;
-			near->to_along = tmp_talong;	/* 0 for points */
-			near->to_angle = tmp_tangle;
-			near->count++;
-			count++;
-		    }
-		    else {
-			if (tfeature == 0 || (tmp_dist < dist)) {
-			    tfeature = lList->id[i];
-			    tcat = tmp_tcat;
-			    dist = tmp_dist;
-			    fx = tmp_fx;
-			    fy = tmp_fy;
-			    fz = tmp_fz;
-			    falong = tmp_falong;
-			    fangle = tmp_fangle;
-			    tx = tmp_tx;
-			    ty = tmp_ty;
-			    tz = tmp_tz;
-			    talong = tmp_talong;
-			    tangle = tmp_tangle;
-			}
-		    }
-		}
-
-		G_debug(3, "  %d areas in box", aList->n_values);
-
-		/* For each area in box check the distance */
-		for (i = 0; i < aList->n_values; i++) {
-		    int poly;
-
-		    tarea = aList->id[i];
-		    G_debug(4, "%d: 'to' area id %d", i, tarea);
-
-		    /* ignore isles OK ? */
-		    if (Vect_get_area_centroid(&To, tarea) == 0)
-			continue;
-
-		    Vect_get_area_points(&To, tarea, TPoints);
-
-		    ttype = GV_BOUNDARY;
-
-		    /* Find the distance of the outer ring of 'to' area
-		     * to 'from' area */
-		    poly = line2area(&From, TPoints, ttype, area, &fbox,
-		              &tmp_tx, &tmp_ty, &tmp_tz, &tmp_talong, &tmp_tangle,
-		              &tmp_fx, &tmp_fy, &tmp_fz, &tmp_falong, &tmp_fangle,
-			      &tmp_dist, with_z);
-
-		    if (poly == 3) {
-			/* 'to' outer ring is outside 'from' area,
-			 * check if 'from' area is inside 'to' area */
-			poly = 0;
-			/* boxes must overlap */
-			if (Vect_box_overlap(&fbox, &aList->box[i])) {
-			    if (FPoints->n_points == 0)
-				Vect_get_area_points(&From, area, FPoints);
-			    for (j = 0; j < FPoints->n_points; j++) {
-				poly = Vect_point_in_poly(FPoints->x[j], FPoints->y[j], TPoints);
-				if (poly)
-				    break;
-			    }
-			}
-			if (poly) {
-			    /* 'from' area is (partially) inside 'to' area,
-			     * get distance to 'to' area */
-			    if (FPoints->n_points == 0)
-				Vect_get_area_points(&From, area, FPoints);
-			    poly = line2area(&To, FPoints, ttype, tarea, &aList->box[i],
-				      &tmp_fx, &tmp_fy, &tmp_fz, &tmp_falong, &tmp_fangle,
-				      &tmp_tx, &tmp_ty, &tmp_tz, &tmp_talong, &tmp_tangle,
-				      &tmp_dist, with_z);
-
-			    /* inside isle ? */
-			    poly = poly == 2;
-			}
-			if (poly == 1) {
-			    double tmp2_tx, tmp2_ty, tmp2_tz, tmp2_talong, tmp2_tangle;
-			    double tmp2_fx, tmp2_fy, tmp2_fz, tmp2_falong, tmp2_fangle;
-			    double tmp2_dist;
-
-			    /* 'from' area is (partially) inside 'to' area,
-			     * get distance to 'to' isles */
-			    nisles = Vect_get_area_num_isles(&To, tarea);
-			    for (j = 0; j < nisles; j++) {
-				isle = Vect_get_area_isle(&To, tarea, j);
-				Vect_get_isle_points(&To, isle, TPoints);
-
-				line2area(&From, TPoints, ttype, area, &fbox,
-					  &tmp2_tx, &tmp2_ty, &tmp2_tz, &tmp2_talong, &tmp2_tangle,
-					  &tmp2_fx, &tmp2_fy, &tmp2_fz, &tmp2_falong, &tmp2_fangle,
-					  &tmp2_dist, with_z);
-
-				if (tmp2_dist < tmp_dist) {
-				    tmp_dist = tmp2_dist;
-				    tmp_fx = tmp2_fx;
-				    tmp_fy = tmp2_fy;
-				    tmp_fz = tmp2_fz;
-				    tmp_falong = tmp2_falong;
-				    tmp_fangle = tmp2_fangle;
-				    tmp_tx = tmp2_tx;
-				    tmp_ty = tmp2_ty;
-				    tmp_tz = tmp2_tz;
-				    tmp_talong = tmp2_talong;
-				    tmp_tangle = tmp2_tangle;
-				}
-			    }
-			}
-		    }
-
-		    if (tmp_dist > max || tmp_dist < min)
-			continue;	/* not in threshold */
-		    Vect_get_area_cats(&To, tarea, TCats);
-		    tmp_tcat = -1;
-		    /* TODO: all cats of given field ? */
-		    for (j = 0; j < TCats->n_cats; j++) {
-			if (TCats->field[j] == to_field) {
-			    if (tmp_tcat >= 0)
-				G_warning(_("More cats found in to_layer (area=%d)"),
-					  tarea);
-			    tmp_tcat = TCats->cat[j];
-			}
-		    }
-
-		    G_debug(4, "  tmp_dist = %f tmp_tcat = %d", tmp_dist,
-			    tmp_tcat);
-
-		    if (do_all) {
-			if (anear <= count) {
-			    anear += 10 + nfrom / 10;
-			    Near = (NEAR *) G_realloc(Near, anear * sizeof(NEAR));
-			}
-			near = &(Near[count]);
-
-			/* store info about relation */
-			near->from_cat = fcat;
-			near->to_cat = tmp_tcat;	/* -1 is OK */
-			near->dist = tmp_dist;
-			near->from_x = tmp_fx;
-			near->from_y = tmp_fy;
-			near->from_z = tmp_fz;
-			near->from_along = tmp_falong;	/* 0 for points */
-			near->from_angle = tmp_fangle;
-			near->to_x = tmp_tx;
-			near->to_y = tmp_ty;
-			near->to_z = tmp_tz;
-			near->to_along = tmp_talong;	/* 0 for points */
-			near->to_angle = tmp_tangle;
-			near->count++;
-			count++;
-		    }
-		    else {
-			if (tfeature == 0 || tmp_dist < dist) {
-			    tfeature = tarea;
-			    tcat = tmp_tcat;
-			    dist = tmp_dist;
-			    fx = tmp_fx;
-			    fy = tmp_fy;
-			    fz = tmp_fz;
-			    falong = tmp_falong;
-			    fangle = tmp_fangle;
-			    tx = tmp_tx;
-			    ty = tmp_ty;
-			    tz = tmp_tz;
-			    talong = tmp_talong;
-			    tangle = tmp_tangle;
-			}
-		    }
-		}
-
-		if (!do_all && curr_step < n_max_steps) {
-		    double dist_map = dist;
-
-		    if (geodesic && tfeature > 0) {
-			double dx = fx - tx;
-			double dy = fy - ty;
-			double dz = fz - tz;
-
-			dist_map = sqrt(dx * dx + dy * dy + dz * dz);
-		    }
-		    /* enlarging the search box is possible */
-		    if (tfeature > 0 && dist_map > box_edge) {
-			/* area found but distance > search edge:
-			 * area bbox overlaps with search box, area itself is
-			 * outside search box */
-			done = FALSE;
-		    }
-		    else if (tfeature == 0) {
-			/* no area within max dist, but search box can still be
-			 * enlarged */
-			done = FALSE;
-		    }
-		}
-		if (done && !do_all && tfeature > 0) {
-
-		    G_debug(4, "near.from_cat = %d near.count = %d dist = %f",
-			    near->from_cat, near->count, near->dist);
-
-		    /* store info about relation */
-		    if (near->count == 0 || near->dist > dist) {
-			near->to_cat = tcat;	/* -1 is OK */
-			near->dist = dist;
-			near->from_x = fx;
-			near->from_y = fy;
-			near->from_z = fz;
-			near->from_along = falong;
-			near->from_angle = fangle;
-			near->to_x = tx;
-			near->to_y = ty;
-			near->to_z = tz;
-			near->to_along = talong;
-			near->to_angle = tangle;
-		    }
-		    near->count++;
-		}
-	    } /* done */
-	} /* next feature */
+	count = find_nearest(&search, TRUE, &Near, &anear, nfcats, count);
     }
 
+    if (search.tpoints)
+	kdtree_destroy(search.tpoints);
+
     G_debug(3, "count = %d", count);
 
     /* select 'to' attributes */
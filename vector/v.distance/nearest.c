@@ -0,0 +1,652 @@
+#include <stdlib.h>
+#include <math.h>
+#include <grass/gis.h>
+#include <grass/glocale.h>
+#include <grass/vector.h>
+#include "local_proto.h"
+
+/* The 'from' features are read for a block on the main thread, their
+ * nearest 'to' features are searched on several threads, each thread
+ * with its own readers of the maps, and the results are stored in the
+ * order of the features, as if searched one by one: the output does
+ * not depend on the number of threads. Geodesic distances are computed
+ * on the main thread. */
+#define NEAR_BLOCK 4096
+
+/* search for one 'from' line or area */
+struct near_job
+{
+    int id;			/* 'from' line or area */
+    int type;			/* type of line or GV_AREA */
+    int fcat;
+    struct line_pnts *Points;	/* line, outer ring of area if needed */
+    struct bound_box box;
+    NEAR *found;		/* nearest or, with -a, all in threshold */
+    int nfound, found_alloc;
+    struct ilist *warn;		/* 'to' lines (> 0), areas (< 0) with more cats */
+};
+
+struct near_block;
+
+/* state of one thread */
+struct near_lane
+{
+    struct near_block *blk;
+    int index;
+    struct dist_map from, to;
+    struct dist_buf buf;
+    struct line_pnts *TPoints;
+    struct line_cats *TCats;
+    struct boxlist *lList, *aList;
+};
+
+struct near_block
+{
+    const struct near_search *s;
+    struct near_job *jobs;
+    int n, alloc;
+    struct near_lane *lanes;
+    int nlanes;
+};
+
+/*!
+  \brief Build a k-d tree of the points of a map
+
+  \param Map map
+  \param type point types
+  \param with_z 3D tree
+
+  \return pointer to new tree, uids are line ids
+*/
+struct kdtree *build_point_tree(struct Map_info *Map, int type, int with_z)
+{
+    struct kdtree *t;
+    struct line_pnts *Points;
+    double c[3];
+    int line, nlines, ltype;
+
+    G_verbose_message(_("Building k-d tree of 'to' points..."));
+
+    t = kdtree_create(with_z ? 3 : 2, NULL);
+    Points = Vect_new_line_struct();
+
+    nlines = Vect_get_num_lines(Map);
+    for (line = 1; line <= nlines; line++) {
+	if (!(Vect_get_line_type(Map, line) & type))
+	    continue;
+
+	ltype = Vect_read_line(Map, Points, NULL, line);
+	if (!(ltype & GV_POINTS) || Points->n_points < 1)
+	    continue;
+
+	c[0] = Points->x[0];
+	c[1] = Points->y[0];
+	c[2] = Points->z[0];
+	/* of several points with the same coordinates the first is kept */
+	kdtree_insert(t, c, line, 0);
+    }
+    kdtree_optimize(t, 2);
+
+    Vect_destroy_line_struct(Points);
+
+    return t;
+}
+
+static struct near_job *next_job(struct near_block *blk)
+{
+    struct near_job *job;
+    int i;
+
+    if (blk->n == blk->alloc) {
+	blk->alloc += 256;
+	blk->jobs = G_realloc(blk->jobs, blk->alloc * sizeof(struct near_job));
+	for (i = blk->n; i < blk->alloc; i++) {
+	    job = &blk->jobs[i];
+	    job->Points = Vect_new_line_struct();
+	    job->found = NULL;
+	    job->found_alloc = 0;
+	    job->warn = G_new_ilist();
+	}
+    }
+
+    job = &blk->jobs[blk->n];
+    job->nfound = 0;
+    G_init_ilist(job->warn);
+
+    return job;
+}
+
+static void add_found(struct near_job *job, const NEAR *c)
+{
+    if (job->nfound == job->found_alloc) {
+	job->found_alloc += 16;
+	job->found = G_realloc(job->found, job->found_alloc * sizeof(NEAR));
+    }
+    job->found[job->nfound++] = *c;
+}
+
+/* category of a 'to' feature, more cats are reported later */
+static int get_to_cat(const struct line_cats *TCats, int to_field,
+		      struct near_job *job, int id)
+{
+    int j, tcat = -1;
+
+    /* TODO: all cats of given field ? */
+    for (j = 0; j < TCats->n_cats; j++) {
+	if (TCats->field[j] == to_field) {
+	    if (tcat >= 0)
+		G_ilist_add(job->warn, id);
+	    tcat = TCats->cat[j];
+	}
+    }
+
+    return tcat;
+}
+
+static void set_box(struct bound_box *box, const struct bound_box *fbox,
+		    double edge)
+{
+    box->E = fbox->E + edge;
+    box->W = fbox->W - edge;
+    box->N = fbox->N + edge;
+    box->S = fbox->S - edge;
+    box->T = PORT_DOUBLE_MAX;
+    box->B = -PORT_DOUBLE_MAX;
+}
+
+/* nearest 'to' point of a 'from' point from the k-d tree */
+static void search_point(struct near_lane *l, struct near_job *job)
+{
+    const struct near_search *s = l->blk->s;
+    double c[3], d;
+    int uid, ttype;
+    NEAR n;
+
+    c[0] = job->Points->x[0];
+    c[1] = job->Points->y[0];
+    c[2] = job->Points->z[0];
+    if (kdtree_knn(s->tpoints, c, &uid, &d, 1, NULL) < 1)
+	return;
+
+    ttype = dist_read_line(&l->to, l->TPoints, l->TCats, uid);
+    if (ttype < 1)
+	return;
+
+    line2line(&l->buf, job->Points, job->type, l->TPoints, ttype,
+	      &n.from_x, &n.from_y, &n.from_z, &n.from_along, &n.from_angle,
+	      &n.to_x, &n.to_y, &n.to_z, &n.to_along, &n.to_angle,
+	      &n.dist, s->with_z);
+
+    if (n.dist > s->max || n.dist < s->min)
+	return;			/* not in threshold */
+
+    n.to_cat = get_to_cat(l->TCats, s->to_field, job, uid);
+    add_found(job, &n);
+}
+
+/* distance of a 'from' area to a 'to' area in c */
+static void area2area(struct near_lane *l, struct near_job *job, int tarea,
+		      const struct bound_box *tbox, NEAR *c)
+{
+    const struct near_search *s = l->blk->s;
+    struct line_pnts *TPoints = l->TPoints;
+    int j, poly, isle, nisles;
+
+    dist_get_area_points(&l->to, tarea, TPoints);
+
+    /* Find the distance of the outer ring of 'to' area
+     * to 'from' area */
+    poly = line2area(&l->from, &l->buf, TPoints, GV_BOUNDARY, job->id,
+		     &job->box, &c->to_x, &c->to_y, &c->to_z, &c->to_along,
+		     &c->to_angle, &c->from_x, &c->from_y, &c->from_z,
+		     &c->from_along, &c->from_angle, &c->dist, s->with_z);
+
+    if (poly != 3)
+	return;
+
+    /* 'to' outer ring is outside 'from' area,
+     * check if 'from' area is inside 'to' area */
+    poly = 0;
+    /* boxes must overlap */
+    if (Vect_box_overlap(&job->box, tbox)) {
+	if (job->Points->n_points == 0)
+	    dist_get_area_points(&l->from, job->id, job->Points);
+	for (j = 0; j < job->Points->n_points; j++) {
+	    poly = Vect_point_in_poly(job->Points->x[j], job->Points->y[j],
+				      TPoints);
+	    if (poly)
+		break;
+	}
+    }
+    if (poly) {
+	/* 'from' area is (partially) inside 'to' area,
+	 * get distance to 'to' area */
+	poly = line2area(&l->to, &l->buf, job->Points, GV_BOUNDARY, tarea,
+			 tbox, &c->from_x, &c->from_y, &c->from_z,
+			 &c->from_along, &c->from_angle, &c->to_x, &c->to_y,
+			 &c->to_z, &c->to_along, &c->to_angle, &c->dist,
+			 s->with_z);
+
+	/* inside isle ? */
+	poly = poly == 2;
+    }
+    if (poly == 1) {
+	NEAR c2;
+
+	/* 'from' area is (partially) inside 'to' area,
+	 * get distance to 'to' isles */
+	nisles = Vect_get_area_num_isles(s->To, tarea);
+	for (j = 0; j < nisles; j++) {
+	    isle = Vect_get_area_isle(s->To, tarea, j);
+	    dist_get_isle_points(&l->to, isle, TPoints);
+
+	    line2area(&l->from, &l->buf, TPoints, GV_BOUNDARY, job->id,
+		      &job->box, &c2.to_x, &c2.to_y, &c2.to_z, &c2.to_along,
+		      &c2.to_angle, &c2.from_x, &c2.from_y, &c2.from_z,
+		      &c2.from_along, &c2.from_angle, &c2.dist, s->with_z);
+
+	    if (c2.dist < c->dist)
+		*c = c2;
+	}
+    }
+}
+
+/* nearest 'to' feature or all 'to' features in threshold of a job */
+static void search(struct near_lane *l, struct near_job *job)
+{
+    const struct near_search *s = l->blk->s;
+    struct boxlist *lList = l->lList, *aList = l->aList;
+    struct bound_box box;
+    double tmp_min = (s->min < 0 ? 0 : s->min);
+    double box_edge = 0;
+    int i, ttype, tfeature, curr_step, done;
+    NEAR c, best;
+
+    if (s->tpoints && (job->type & GV_POINTS)) {
+	search_point(l, job);
+	return;
+    }
+
+    if (s->geodesic)
+	tmp_min = 0;
+
+    curr_step = 0;
+    done = FALSE;
+    best.dist = PORT_DOUBLE_MAX;	/* distance to nearest 'to' feature */
+    Vect_reset_boxlist(lList);
+    Vect_reset_boxlist(aList);
+
+    while (!done) {
+	done = TRUE;
+
+	tfeature = 0;		/* id of nearest 'to' feature */
+
+	if (!s->do_all) {
+	    /* enlarge search box until we get a hit */
+	    /* the objective is to enlarge the search box
+	     * in the first iterations just a little bit
+	     * to keep the number of hits low */
+	    while (curr_step < s->n_max_steps) {
+		box_edge = s->max_step[curr_step];
+		curr_step++;
+
+		if (box_edge < tmp_min)
+		    continue;
+
+		set_box(&box, &job->box, box_edge);
+
+		if (s->ntolines)
+		    dist_select_lines(&l->to, &box, s->to_type, lList);
+		if (s->ntoareas)
+		    dist_select_areas(&l->to, &box, aList);
+
+		if (lList->n_values > 0 || aList->n_values > 0)
+		    break;
+	    }
+	}
+	else {
+	    set_box(&box, &job->box, s->max_map);
+
+	    if (s->ntolines)
+		dist_select_lines(&l->to, &box, s->to_type, lList);
+	    if (s->ntoareas)
+		dist_select_areas(&l->to, &box, aList);
+	}
+
+	for (i = 0; i < lList->n_values; i++) {
+	    int tline = lList->id[i];
+
+	    ttype = dist_read_line(&l->to, l->TPoints, l->TCats, tline);
+
+	    if (job->type == GV_AREA) {
+		/* area to line */
+		line2area(&l->from, &l->buf, l->TPoints, ttype, job->id,
+			  &job->box, &c.to_x, &c.to_y, &c.to_z, &c.to_along,
+			  &c.to_angle, &c.from_x, &c.from_y, &c.from_z,
+			  &c.from_along, &c.from_angle, &c.dist, s->with_z);
+	    }
+	    else {
+		line2line(&l->buf, job->Points, job->type, l->TPoints, ttype,
+			  &c.from_x, &c.from_y, &c.from_z, &c.from_along,
+			  &c.from_angle, &c.to_x, &c.to_y, &c.to_z,
+			  &c.to_along, &c.to_angle, &c.dist, s->with_z);
+	    }
+
+	    if (c.dist > s->max || c.dist < s->min)
+		continue;	/* not in threshold */
+
+	    c.to_cat = get_to_cat(l->TCats, s->to_field, job, tline);
+
+	    if (s->do_all)
+		add_found(job, &c);
+	    else if (tfeature == 0 || c.dist < best.dist) {
+		tfeature = tline;
+		best = c;
+	    }
+	}
+
+	for (i = 0; i < aList->n_values; i++) {
+	    int tarea = aList->id[i];
+
+	    /* ignore isles OK ? */
+	    if (Vect_get_area_centroid(s->To, tarea) == 0)
+		continue;
+
+	    if (job->type == GV_AREA)
+		area2area(l, job, tarea, &aList->box[i], &c);
+	    else {
+		line2area(&l->to, &l->buf, job->Points, job->type, tarea,
+			  &aList->box[i], &c.from_x, &c.from_y, &c.from_z,
+			  &c.from_along, &c.from_angle, &c.to_x, &c.to_y,
+			  &c.to_z, &c.to_along, &c.to_angle, &c.dist,
+			  s->with_z);
+	    }
+
+	    if (c.dist > s->max || c.dist < s->min)
+		continue;	/* not in threshold */
+
+	    /* TODO: more cats of the same field */
+	    dist_get_area_cats(&l->to, tarea, l->TCats);
+	    c.to_cat = get_to_cat(l->TCats, s->to_field, job, -tarea);
+
+	    if (s->do_all)
+		add_found(job, &c);
+	    else if (tfeature == 0 || c.dist < best.dist) {
+		tfeature = tarea;
+		best = c;
+	    }
+	}
+
+	if (!s->do_all && curr_step < s->n_max_steps) {
+	    double dist_map = best.dist;
+
+	    if (s->geodesic && tfeature > 0) {
+		double dx = best.from_x - best.to_x;
+		double dy = best.from_y - best.to_y;
+		double dz = best.from_z - best.to_z;
+
+		dist_map = sqrt(dx * dx + dy * dy + dz * dz);
+	    }
+	    /* enlarging the search box is possible */
+	    if (tfeature > 0 && dist_map > box_edge) {
+		/* feature found but distance > search edge:
+		 * feature bbox overlaps with search box, feature itself is
+		 * outside search box */
+		done = FALSE;
+	    }
+	    else if (tfeature == 0) {
+		/* no feature within max dist, but search box can still be
+		 * enlarged */
+		done = FALSE;
+	    }
+	}
+    }
+
+    if (!s->do_all && tfeature > 0)
+	add_found(job, &best);
+}
+
+static void search_lane(void *closure)
+{
+    struct near_lane *l = closure;
+    struct near_block *blk = l->blk;
+    int i;
+
+    for (i = l->index; i < blk->n; i += blk->nlanes)
+	search(l, &blk->jobs[i]);
+}
+
+static void init_lanes(struct near_block *blk)
+{
+    const struct near_search *s = blk->s;
+    int i, nlanes;
+
+    /* geodesic distances are not thread-safe */
+    nlanes = s->geodesic ? 0 : G_num_workers();
+
+    blk->lanes = G_calloc(nlanes > 0 ? nlanes : 1, sizeof(struct near_lane));
+    for (i = 0; i < nlanes; i++) {
+	blk->lanes[i].from.R = Vect_new_reader(s->From);
+	blk->lanes[i].to.R = Vect_new_reader(s->To);
+	if (!blk->lanes[i].from.R || !blk->lanes[i].to.R)
+	    break;
+    }
+    if (nlanes < 1 || i < nlanes) {
+	/* the spatial index cannot be searched by several threads:
+	 * one lane on the main thread */
+	for (i = 0; i < nlanes; i++) {
+	    Vect_destroy_reader(blk->lanes[i].from.R);
+	    Vect_destroy_reader(blk->lanes[i].to.R);
+	}
+	nlanes = 1;
+	G_zero(blk->lanes, sizeof(struct near_lane));
+    }
+    blk->nlanes = nlanes;
+
+    for (i = 0; i < nlanes; i++) {
+	struct near_lane *l = &blk->lanes[i];
+
+	l->blk = blk;
+	l->index = i;
+	l->from.Map = s->From;
+	l->to.Map = s->To;
+	dist_buf_init(&l->buf);
+	l->TPoints = Vect_new_line_struct();
+	l->TCats = Vect_new_cats_struct();
+	l->lList = Vect_new_boxlist(1);
+	l->aList = Vect_new_boxlist(1);
+    }
+    G_debug(1, "find_nearest(): %d threads", nlanes);
+}
+
+static void free_block(struct near_block *blk)
+{
+    int i;
+
+    for (i = 0; i < blk->nlanes; i++) {
+	struct near_lane *l = &blk->lanes[i];
+
+	Vect_destroy_reader(l->from.R);
+	Vect_destroy_reader(l->to.R);
+	dist_buf_free(&l->buf);
+	Vect_destroy_line_struct(l->TPoints);
+	Vect_destroy_cats_struct(l->TCats);
+	Vect_destroy_boxlist(l->lList);
+	Vect_destroy_boxlist(l->aList);
+    }
+    G_free(blk->lanes);
+
+    for (i = 0; i < blk->alloc; i++) {
+	Vect_destroy_line_struct(blk->jobs[i].Points);
+	G_free(blk->jobs[i].found);
+	G_free_ilist(blk->jobs[i].warn);
+    }
+    G_free(blk->jobs);
+}
+
+/* search the features of the block and store the results */
+static int flush_block(struct near_block *blk, NEAR **Near, int *anear,
+		       int nfcats, int count)
+{
+    const struct near_search *s = blk->s;
+    int i, j;
+
+    if (blk->nlanes > 1) {
+	struct G_task_group *g = G_task_group_create();
+
+	for (i = 0; i < blk->nlanes; i++)
+	    G_task_submit(g, search_lane, &blk->lanes[i]);
+	G_task_group_destroy(g);
+    }
+    else
+	search_lane(&blk->lanes[0]);
+
+    for (i = 0; i < blk->n; i++) {
+	struct near_job *job = &blk->jobs[i];
+	NEAR *near;
+
+	for (j = 0; j < job->warn->n_values; j++) {
+	    if (job->warn->value[j] > 0)
+		G_warning(_("More cats found in to_layer (line=%d)"),
+			  job->warn->value[j]);
+	    else
+		G_warning(_("More cats found in to_layer (area=%d)"),
+			  -job->warn->value[j]);
+	}
+
+	if (s->do_all) {
+	    for (j = 0; j < job->nfound; j++) {
+		if (*anear <= count) {
+		    *anear += 10 + s->nto / 10;
+		    *Near = (NEAR *) G_realloc(*Near, *anear * sizeof(NEAR));
+		}
+		near = &((*Near)[count]);
+
+		/* store info about relation */
+		*near = job->found[j];
+		near->from_cat = job->fcat;	/* to_cat -1 is OK */
+		near->count = 1;
+		count++;
+	    }
+	}
+	else if (job->nfound) {
+	    const NEAR *f = &job->found[0];
+
+	    /* find near by 'from' cat */
+	    near = (NEAR *) bsearch((void *)&job->fcat, *Near, nfcats,
+				    sizeof(NEAR), cmp_near);
+
+	    G_debug(4, "  near->from_cat = %d near->count = %d",
+		    near->from_cat, near->count);
+	    /* store info about relation */
+	    if (near->count == 0 || near->dist > f->dist) {
+		near->to_cat = f->to_cat;	/* -1 is OK */
+		near->dist = f->dist;
+		near->from_x = f->from_x;
+		near->from_y = f->from_y;
+		near->from_z = f->from_z;
+		near->from_along = f->from_along;	/* 0 for points */
+		near->from_angle = f->from_angle;
+		near->to_x = f->to_x;
+		near->to_y = f->to_y;
+		near->to_z = f->to_z;
+		near->to_along = f->to_along;	/* 0 for points */
+		near->to_angle = f->to_angle;
+	    }
+	    near->count++;
+	}
+    }
+    blk->n = 0;
+
+    return count;
+}
+
+/*!
+  \brief Find nearest 'to' features of 'from' lines or areas
+
+  \param s search parameters
+  \param areas search for 'from' areas instead of lines
+  \param[in,out] Near records of 'from' cats or, with -a, of pairs
+  \param[in,out] anear allocated records (-a)
+  \param nfcats number of records of 'from' cats
+  \param count number of records of pairs (-a)
+
+  \return number of records of pairs (-a)
+*/
+int find_nearest(const struct near_search *s, int areas, NEAR **Near,
+		 int *anear, int nfcats, int count)
+{
+    struct near_block blk;
+    struct near_job *job;
+    struct line_cats *FCats;
+    int i, n, fcat, ftype;
+
+    G_zero(&blk, sizeof(struct near_block));
+    blk.s = s;
+    init_lanes(&blk);
+
+    FCats = Vect_new_cats_struct();
+
+    if (!areas) {
+	n = Vect_get_num_lines(s->From);
+
+	G_percent(0, n, 4);
+	for (i = 1; i <= n; i++) {
+	    G_debug(3, "fline = %d", i);
+	    G_percent(i, n, 4);
+	    ftype = Vect_get_line_type(s->From, i);
+	    if (!(ftype & s->from_type))
+		continue;
+
+	    job = next_job(&blk);
+	    Vect_read_line(s->From, job->Points, FCats, i);
+	    Vect_cat_get(FCats, s->from_field, &fcat);
+	    if (fcat < 0 && !s->do_all)
+		continue;
+
+	    job->id = i;
+	    job->type = ftype;
+	    job->fcat = fcat;
+	    get_line_box(job->Points, &job->box);
+	    blk.n++;
+
+	    if (blk.n == NEAR_BLOCK)
+		count = flush_block(&blk, Near, anear, nfcats, count);
+	}
+    }
+    else {
+	n = Vect_get_num_areas(s->From);
+
+	G_percent(0, n, 2);
+	for (i = 1; i <= n; i++) {
+	    G_debug(3, "farea = %d", i);
+	    G_percent(i, n, 2);
+
+	    if (Vect_get_area_cats(s->From, i, FCats) == 1)
+		/* ignore isles OK ? */
+		continue;
+
+	    Vect_cat_get(FCats, s->from_field, &fcat);
+	    if (fcat < 0 && !s->do_all)
+		continue;
+
+	    job = next_job(&blk);
+	    job->id = i;
+	    job->type = GV_AREA;
+	    job->fcat = fcat;
+	    Vect_get_area_box(s->From, i, &job->box);
+	    /* outer ring is read if needed */
+	    Vect_reset_line(job->Points);
+	    blk.n++;
+
+	    if (blk.n == NEAR_BLOCK)
+		count = flush_block(&blk, Near, anear, nfcats, count);
+	}
+    }
+    count = flush_block(&blk, Near, anear, nfcats, count);
+
+    free_block(&blk);
+    Vect_destroy_cats_struct(FCats);
+
+    return count;
+}
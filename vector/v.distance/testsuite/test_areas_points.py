@@ -145,6 +145,15 @@ class TestPointsAndAreas(TestCase):
                             separator='pipe', flags='c')
         self.assertMultiLineEqual(table, table_ref)
 
+    def test_nprocs(self):
+        """Check that the output does not depend on the number of threads"""
+        for to in (self.areas, self.points_3d):
+            outputs = [call_module('v.distance', from_=self.points, to=to,
+                                   upload='cat,dist,to_x,to_y', flags='p',
+                                   separator='pipe', nprocs=nprocs)
+                       for nprocs in (1, 4)]
+            self.assertMultiLineEqual(outputs[0], outputs[1])
+
 
 if __name__ == '__main__':
     test()
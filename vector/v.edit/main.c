@@ -31,7 +31,7 @@ int main(int argc, char *argv[])
 
     int i;
     int move_first, snap, extend_parallel;
-    int ret, layer;
+    int ret, layer, topo_batch;
     double move_x, move_y, move_z, thresh[3];
 
     struct line_pnts *coord;
@@ -46,6 +46,7 @@ int main(int argc, char *argv[])
     nbgmaps = 0;
     coord = NULL;
     Clist = NULL;
+    topo_batch = FALSE;
 
     G_gisinit(argv[0]);
 
@@ -269,7 +270,11 @@ int main(int argc, char *argv[])
 	int num_lines;
 	num_lines = Vect_get_num_lines(&Map);
 	
+	/* isles and centroids are attached once for all new features */
+	topo_batch = Vect_begin_topo_batch(&Map);
 	ret = Vect_read_ascii(ascii, &Map);
+	if (topo_batch)
+	    topo_batch = Vect_end_topo_batch(&Map);
 	if (ret > 0) {
 	    int iline;
 	    struct ilist *List_added;
@@ -495,9 +500,10 @@ int main(int argc, char *argv[])
     
     Vect_hist_command(&Map);
 
-    /* build topology only if requested or if tool!=select */
+    /* build topology only if requested or if tool!=select, the
+       topology is kept up to date when adding features in a batch */
     if (action_mode != MODE_SELECT && action_mode != MODE_NONE &&
-		    params.topo->answer != 1) {
+		    params.topo->answer != 1 && !topo_batch) {
 	Vect_build_partial(&Map, GV_BUILD_NONE);
 	Vect_build(&Map);
     }
@@ -40,12 +40,104 @@
 #define NETWORK 100
 #define DISPLACEMENT 101
 
+/* number of lines simplified at once */
+#define BATCH_LINES 10000
+
+struct method_params
+{
+    int method, iterations, look_ahead, with_z;
+    double thresh, alpha, beta, reduction, slide, angle_thresh;
+};
+
+/* a line waiting to be generalized and written */
+struct staged_line
+{
+    int line, type;
+    int selected, loop_support;
+    struct line_pnts *APoints;	/* original points */
+    struct line_pnts *Points;	/* generalized points */
+    struct line_cats *Cats;
+};
+
+struct batch
+{
+    const struct method_params *params;
+    struct staged_line *lines;
+};
+
+static void generalize_line(struct line_pnts *Points, int loop_support,
+			    const struct method_params *p)
+{
+    int iter;
+
+    for (iter = 0; iter < p->iterations; iter++) {
+	switch (p->method) {
+	case DOUGLAS:
+	    douglas_peucker(Points, p->thresh, p->with_z);
+	    break;
+	case DOUGLAS_REDUCTION:
+	    douglas_peucker_reduction(Points, p->thresh, p->reduction,
+				      p->with_z);
+	    break;
+	case LANG:
+	    lang(Points, p->thresh, p->look_ahead, p->with_z);
+	    break;
+	case VERTEX_REDUCTION:
+	    vertex_reduction(Points, p->thresh, p->with_z);
+	    break;
+	case REUMANN:
+	    reumann_witkam(Points, p->thresh, p->with_z);
+	    break;
+	case BOYLE:
+	    boyle(Points, p->look_ahead, loop_support, p->with_z);
+	    break;
+	case SLIDING_AVERAGING:
+	    sliding_averaging(Points, p->slide, p->look_ahead, loop_support,
+			      p->with_z);
+	    break;
+	case DISTANCE_WEIGHTING:
+	    distance_weighting(Points, p->slide, p->look_ahead, loop_support,
+			       p->with_z);
+	    break;
+	case CHAIKEN:
+	    chaiken(Points, p->thresh, loop_support, p->with_z);
+	    break;
+	case HERMITE:
+	    hermite(Points, p->thresh, p->angle_thresh, loop_support,
+		    p->with_z);
+	    break;
+	case SNAKES:
+	    snakes(Points, p->alpha, p->beta, loop_support, p->with_z);
+	    break;
+	}
+    }
+}
+
+/* the methods only work on the points of the line, so the lines of a
+   batch are generalized by several threads */
+static void generalize_lines(int first, int last, void *closure)
+{
+    struct batch *b = closure;
+    int k;
+
+    for (k = first; k < last; k++) {
+	struct staged_line *s = &b->lines[k];
+
+	if (!s->selected)
+	    continue;
+
+	Vect_reset_line(s->Points);
+	Vect_append_points(s->Points, s->APoints, GV_FORWARD);
+	generalize_line(s->Points, s->loop_support, b->params);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     struct Map_info In, Out, Error;
     struct line_pnts *Points;
-    struct line_cats *Cats, *ACats;
-    int i, type, iter;
+    struct line_cats *ACats;
+    int i, type;
     struct GModule *module;	/* GRASS module for parsing arguments */
     struct Option *map_in, *map_out, *error_out, *thresh_opt, *method_opt,
 	*look_ahead_opt;
@@ -53,7 +145,7 @@ int main(int argc, char *argv[])
     struct Option *field_opt, *where_opt, *reduction_opt, *slide_opt;
     struct Option *angle_thresh_opt, *degree_thresh_opt,
 	*closeness_thresh_opt;
-    struct Option *betweeness_thresh_opt;
+    struct Option *betweeness_thresh_opt, *nprocs_opt;
     struct Flag *notab_flag, *loop_support_flag;
     int with_z;
     int total_input, total_output;	/* Number of points in the input/output map respectively */
@@ -61,7 +153,6 @@ int main(int argc, char *argv[])
     double degree_thresh, closeness_thresh, betweeness_thresh;
     int method;
     int look_ahead, iterations;
-    int loop_support;
     int layer;
     int n_lines;
     int simplification, mask_type;
@@ -240,6 +331,8 @@ int main(int argc, char *argv[])
     loop_support_flag->label = _("Disable loop support");
     loop_support_flag->description = _("Do not modify end points of lines forming a closed loop");
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     notab_flag = G_define_standard_flag(G_FLG_V_TABLE);
     notab_flag->description = _("Do not copy attributes");
     notab_flag->guisection = _("Attributes");
@@ -248,6 +341,8 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
+
     thresh = atof(thresh_opt->answer);
     look_ahead = atoi(look_ahead_opt->answer);
     alpha = atof(alpha_opt->answer);
@@ -315,8 +410,6 @@ int main(int argc, char *argv[])
     }
 
 
-    Points = Vect_new_line_struct();
-    Cats = Vect_new_cats_struct();
     ACats = Vect_new_cats_struct();
 
     Vect_check_input_output_name(map_in->answer, map_out->answer,
@@ -398,178 +491,225 @@ int main(int argc, char *argv[])
     if (method < NETWORK) {
 	/* modifies only lines of selected type, all other features are preserved */
 	int not_modified_boundaries = 0, n_oversimplified = 0;
-	struct line_pnts *APoints;  /* original Points */
+	struct Map_info *Src;
+	struct staged_line *staged;
+	struct method_params params;
+	struct batch batch;
+	int direct, n, k;
 
 	set_topo_debug();
 
-	Vect_copy_map_lines(&In, &Out);
-	Vect_build_partial(&Out, GV_BUILD_CENTROIDS);
+	/* Boundaries are checked one by one against the topology of the
+	 * output. Without boundaries to modify, the lines are read from
+	 * the input and all of them written once to the output, whose
+	 * topology is built at the end. */
+	direct = (!(mask_type & GV_BOUNDARY) ||
+		  Vect_get_num_primitives(&In, GV_BOUNDARY) == 0) &&
+	    Vect_maptype(&Out) == GV_FORMAT_NATIVE;
+
+	if (direct)
+	    Src = &In;
+	else {
+	    Vect_copy_map_lines(&In, &Out);
+	    Vect_build_partial(&Out, GV_BUILD_CENTROIDS);
+	    Src = &Out;
+	}
 
 	G_message("-----------------------------------------------------");
 	G_message(_("Generalization (%s)..."), method_opt->answer);
 	G_message(_("Using threshold: %g %s"), thresh, G_database_unit_name(1));
 	G_percent_reset();
 
-	APoints = Vect_new_line_struct();
-
-	n_lines = Vect_get_num_lines(&Out);
-	for (i = 1; i <= n_lines; i++) {
-	    int after = 0;
+	params.method = method;
+	params.iterations = iterations;
+	params.look_ahead = look_ahead;
+	params.with_z = with_z;
+	params.thresh = thresh;
+	params.alpha = alpha;
+	params.beta = beta;
+	params.reduction = reduction;
+	params.slide = slide;
+	params.angle_thresh = angle_thresh;
+
+	staged = G_malloc(BATCH_LINES * sizeof(struct staged_line));
+	for (k = 0; k < BATCH_LINES; k++) {
+	    staged[k].APoints = Vect_new_line_struct();
+	    staged[k].Points = Vect_new_line_struct();
+	    staged[k].Cats = Vect_new_cats_struct();
+	}
+	batch.params = &params;
+	batch.lines = staged;
 
-	    G_percent(i, n_lines, 1);
+	n_lines = Vect_get_num_lines(Src);
+	for (i = 1; i <= n_lines;) {
 
-	    type = Vect_read_line(&Out, APoints, Cats, i);
+	    /* read a batch of lines */
+	    for (n = 0; i <= n_lines && n < BATCH_LINES; i++) {
+		struct staged_line *s = &staged[n];
 
-	    if (!(type & GV_LINES) || !(mask_type & type))
-		continue;
+		G_percent(i, n_lines, 1);
 
-	    if (layer > 0) {
-		if ((type & GV_LINE) &&
-		    !Vect_cats_in_constraint(Cats, layer, cat_list))
+		if (direct && !Vect_line_alive(Src, i))
 		    continue;
-		else if ((type & GV_BOUNDARY)) {
-		    int do_line = 0;
-		    int left, right;
-		    
-		    do_line = Vect_cats_in_constraint(Cats, layer, cat_list);
-
-		    if (!do_line) {
-			
-			/* check if any of the centroids is selected */
-			Vect_get_line_areas(&Out, i, &left, &right);
-			if (left < 0)
-			    left = Vect_get_isle_area(&Out, abs(left));
-			if (right < 0)
-			    right = Vect_get_isle_area(&Out, abs(right));
-
-			if (left > 0) {
-			    Vect_get_area_cats(&Out, left, ACats);
-			    do_line = Vect_cats_in_constraint(ACats, layer, cat_list);
-			}
-			
-			if (!do_line && right > 0) {
-			    Vect_get_area_cats(&Out, right, ACats);
-			    do_line = Vect_cats_in_constraint(ACats, layer, cat_list);
+
+		type = Vect_read_line(Src, s->APoints, s->Cats, i);
+		s->line = i;
+		s->type = type;
+		s->selected = 0;
+
+		if (!(type & GV_LINES) || !(mask_type & type))
+		    goto next;
+
+		if (layer > 0) {
+		    if ((type & GV_LINE) &&
+			!Vect_cats_in_constraint(s->Cats, layer, cat_list))
+			goto next;
+		    else if ((type & GV_BOUNDARY)) {
+			int do_line = 0;
+			int left, right;
+
+			do_line = Vect_cats_in_constraint(s->Cats, layer, cat_list);
+
+			if (!do_line) {
+
+			    /* check if any of the centroids is selected */
+			    Vect_get_line_areas(Src, i, &left, &right);
+			    if (left < 0)
+				left = Vect_get_isle_area(Src, abs(left));
+			    if (right < 0)
+				right = Vect_get_isle_area(Src, abs(right));
+
+			    if (left > 0) {
+				Vect_get_area_cats(Src, left, ACats);
+				do_line = Vect_cats_in_constraint(ACats, layer, cat_list);
+			    }
+
+			    if (!do_line && right > 0) {
+				Vect_get_area_cats(Src, right, ACats);
+				do_line = Vect_cats_in_constraint(ACats, layer, cat_list);
+			    }
 			}
+			if (!do_line)
+			    goto next;
 		    }
-		    if (!do_line)
-			continue;
 		}
-	    }
 
-	    Vect_line_prune(APoints);
+		Vect_line_prune(s->APoints);
 
-	    if (APoints->n_points < 2)
-		/* Line of length zero, delete if boundary ? */
-		continue;
+		if (s->APoints->n_points < 2) {
+		    /* Line of length zero, delete if boundary ? */
+		    if (direct)
+			Vect_read_line(Src, s->APoints, NULL, i);
+		    goto next;
+		}
 
-	    total_input += APoints->n_points;
+		s->selected = 1;
 
-	    /* copy points */
-	    Vect_reset_line(Points);
-	    Vect_append_points(Points, APoints, GV_FORWARD);
-	    
-	    loop_support = 0;
-	    if (!loop_support_flag->answer) {
-		int n1, n2;
+		s->loop_support = 0;
+		if (!loop_support_flag->answer) {
+		    int n1, n2;
 
-		Vect_get_line_nodes(&Out, i, &n1, &n2);
-		if (n1 == n2) {
-		    if (Vect_get_node_n_lines(&Out, n1) == 2) {
-			if (abs(Vect_get_node_line(&Out, n1, 0)) == i &&
-			    abs(Vect_get_node_line(&Out, n1, 1)) == i)
-			    loop_support = 1;
+		    Vect_get_line_nodes(Src, i, &n1, &n2);
+		    if (n1 == n2) {
+			if (Vect_get_node_n_lines(Src, n1) == 2) {
+			    if (abs(Vect_get_node_line(Src, n1, 0)) == i &&
+				abs(Vect_get_node_line(Src, n1, 1)) == i)
+				s->loop_support = 1;
+			}
 		    }
 		}
+
+	      next:
+		/* lines not modified are already in a copied output */
+		if (s->selected || direct)
+		    n++;
 	    }
-		
-	    for (iter = 0; iter < iterations; iter++) {
-		switch (method) {
-		case DOUGLAS:
-		    douglas_peucker(Points, thresh, with_z);
-		    break;
-		case DOUGLAS_REDUCTION:
-		    douglas_peucker_reduction(Points, thresh, reduction,
-					      with_z);
-		    break;
-		case LANG:
-		    lang(Points, thresh, look_ahead, with_z);
-		    break;
-		case VERTEX_REDUCTION:
-		    vertex_reduction(Points, thresh, with_z);
-		    break;
-		case REUMANN:
-		    reumann_witkam(Points, thresh, with_z);
-		    break;
-		case BOYLE:
-		    boyle(Points, look_ahead, loop_support, with_z);
-		    break;
-		case SLIDING_AVERAGING:
-		    sliding_averaging(Points, slide, look_ahead, loop_support, with_z);
-		    break;
-		case DISTANCE_WEIGHTING:
-		    distance_weighting(Points, slide, look_ahead, loop_support, with_z);
-		    break;
-		case CHAIKEN:
-		    chaiken(Points, thresh, loop_support, with_z);
-		    break;
-		case HERMITE:
-		    hermite(Points, thresh, angle_thresh, loop_support, with_z);
-		    break;
-		case SNAKES:
-		    snakes(Points, alpha, beta, loop_support, with_z);
-		    break;
+
+	    G_parallel_for(0, n, 64, generalize_lines, &batch);
+
+	    /* write the batch in the order of the lines */
+	    for (k = 0; k < n; k++) {
+		struct staged_line *s = &staged[k];
+		struct line_pnts *APoints = s->APoints;
+		int after = 0, modified = 0;
+
+		type = s->type;
+		Points = s->Points;
+
+		if (!s->selected) {
+		    Vect_write_line(&Out, type, APoints, s->Cats);
+		    continue;
 		}
-	    }
 
-	    if (loop_support == 0) { 
-		/* safety check, BUG in method if not passed */
-		if (APoints->x[0] != Points->x[0] || 
-		    APoints->y[0] != Points->y[0] ||
-		    APoints->z[0] != Points->z[0])
-		    G_fatal_error(_("Method '%s' did not preserve first point"), method_opt->answer);
-		    
-		if (APoints->x[APoints->n_points - 1] != Points->x[Points->n_points - 1] || 
-		    APoints->y[APoints->n_points - 1] != Points->y[Points->n_points - 1] ||
-		    APoints->z[APoints->n_points - 1] != Points->z[Points->n_points - 1])
-		    G_fatal_error(_("Method '%s' did not preserve last point"), method_opt->answer);
-	    }
-	    else {
-		/* safety check, BUG in method if not passed */
-		if (Points->x[0] != Points->x[Points->n_points - 1] || 
-		    Points->y[0] != Points->y[Points->n_points - 1] ||
-		    Points->z[0] != Points->z[Points->n_points - 1])
-		    G_fatal_error(_("Method '%s' did not preserve loop"), method_opt->answer);
-	    }
+		total_input += APoints->n_points;
 
-	    Vect_line_prune(Points);
+		if (s->loop_support == 0) { 
+		    /* safety check, BUG in method if not passed */
+		    if (APoints->x[0] != Points->x[0] || 
+			APoints->y[0] != Points->y[0] ||
+			APoints->z[0] != Points->z[0])
+			G_fatal_error(_("Method '%s' did not preserve first point"), method_opt->answer);
 
-	    /* oversimplified line */
-	    if (Points->n_points < 2) {
-		after = APoints->n_points;
-		n_oversimplified++;
-                if (error_out->answer)
-		    Vect_write_line(&Error, GV_POINT, Points, Cats);
-	    }
-	    /* check for topology corruption */
-	    else if (type == GV_BOUNDARY) {
-		if (!check_topo(&Out, i, APoints, Points, Cats)) {
+		    if (APoints->x[APoints->n_points - 1] != Points->x[Points->n_points - 1] || 
+			APoints->y[APoints->n_points - 1] != Points->y[Points->n_points - 1] ||
+			APoints->z[APoints->n_points - 1] != Points->z[Points->n_points - 1])
+			G_fatal_error(_("Method '%s' did not preserve last point"), method_opt->answer);
+		}
+		else {
+		    /* safety check, BUG in method if not passed */
+		    if (Points->x[0] != Points->x[Points->n_points - 1] || 
+			Points->y[0] != Points->y[Points->n_points - 1] ||
+			Points->z[0] != Points->z[Points->n_points - 1])
+			G_fatal_error(_("Method '%s' did not preserve loop"), method_opt->answer);
+		}
+
+		Vect_line_prune(Points);
+
+		/* oversimplified line */
+		if (Points->n_points < 2) {
 		    after = APoints->n_points;
-		    not_modified_boundaries++;
-                    if (error_out->answer)
-		        Vect_write_line(&Error, type, Points, Cats);
+		    n_oversimplified++;
+		    if (error_out->answer)
+			Vect_write_line(&Error, GV_POINT, Points, s->Cats);
 		}
-		else
+		/* check for topology corruption */
+		else if (type == GV_BOUNDARY) {
+		    if (!check_topo(&Out, s->line, APoints, Points, s->Cats)) {
+			after = APoints->n_points;
+			not_modified_boundaries++;
+			if (error_out->answer)
+			    Vect_write_line(&Error, type, Points, s->Cats);
+		    }
+		    else
+			after = Points->n_points;
+		}
+		else {
+		    /* type == GV_LINE */
+		    if (direct)
+			Vect_write_line(&Out, type, Points, s->Cats);
+		    else
+			Vect_rewrite_line(&Out, s->line, type, Points, s->Cats);
 		    after = Points->n_points;
+		    modified = 1;
+		}
+
+		/* the original, not pruned line */
+		if (direct && !modified) {
+		    Vect_read_line(Src, APoints, NULL, s->line);
+		    Vect_write_line(&Out, type, APoints, s->Cats);
+		}
+
+		total_output += after;
 	    }
-	    else {
-		/* type == GV_LINE */
-		Vect_rewrite_line(&Out, i, type, Points, Cats);
-		after = Points->n_points;
-	    }
+	}
 
-	    total_output += after;
+	for (k = 0; k < BATCH_LINES; k++) {
+	    Vect_destroy_line_struct(staged[k].APoints);
+	    Vect_destroy_line_struct(staged[k].Points);
+	    Vect_destroy_cats_struct(staged[k].Cats);
 	}
+	G_free(staged);
+
 	if (not_modified_boundaries > 0)
 	    G_warning(_("%d boundaries were not modified because modification would damage topology"),
 		      not_modified_boundaries);
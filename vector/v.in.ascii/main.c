@@ -53,7 +53,7 @@ int main(int argc, char *argv[])
     struct GModule *module;
     struct Option *old, *new, *delim_opt, *tdelim_opt, *columns_opt, 
 	          *xcol_opt, *ycol_opt, *zcol_opt, *catcol_opt,
-		  *format_opt, *skip_opt;
+		  *format_opt, *skip_opt, *nprocs_opt;
     int xcol, ycol, zcol, catcol, format, skip_lines;
     struct Flag *zcoorf, *t_flag, *e_flag, *noheader_flag, *notopol_flag,
 	*region_flag, *ignore_flag;
@@ -170,6 +170,9 @@ int main(int argc, char *argv[])
 	_("Number of column used as category (points mode)");
     catcol_opt->description =
 	_("First column is 1. If 0, unique category is assigned to each row and written to new column 'cat'");
+
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+    nprocs_opt->guisection = _("Points");
     
     zcoorf = G_define_flag();
     zcoorf->key = 'z';
@@ -209,6 +212,7 @@ int main(int argc, char *argv[])
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
 
     if (format_opt->answer[0] == 'p')
 	format = GV_ASCII_FORMAT_POINT;
@@ -306,6 +306,135 @@ int points_analyse(FILE * ascii_in, FILE * ascii, char *fs, char *td,
 }
 
 
+/* number of rows read and parsed at once */
+#define BLOCK_ROWS 65536
+/* number of rows per insert statement for drivers accepting several */
+#define INSERT_ROWS 100
+
+struct point_row
+{
+    char *line;			/* row in the block buffer */
+    double x, y, z;
+    int cat;
+    char *values;		/* attribute values "( ... )" */
+};
+
+struct point_block
+{
+    struct point_row *rows;
+    int n, alloc;
+    int cat;			/* last automatic category before the block */
+    char *fs, *td;
+    int *coltype;
+    int xcol, ycol, zcol, catcol;
+    int ll, proj;
+    int attr;			/* create attribute values */
+};
+
+/* parse rows of the block, called in parallel */
+static void parse_rows(int first, int last, void *closure)
+{
+    struct point_block *blk = closure;
+    dbString sql, val;
+    char buf[64];
+    int r, i;
+
+    db_init_string(&sql);
+    db_init_string(&val);
+
+    for (r = first; r < last; r++) {
+	struct point_row *row = &blk->rows[r];
+	char **tokens;
+	int ntokens;		/* number of tokens */
+
+	tokens = G_tokenize2(row->line, blk->fs, blk->td);
+	ntokens = G_number_of_tokens(tokens);
+
+	G_chop(tokens[blk->xcol]);
+	G_chop(tokens[blk->ycol]);
+
+	if (blk->ll) {
+	    G_scan_easting(tokens[blk->xcol], &row->x, blk->proj);
+	    G_scan_northing(tokens[blk->ycol], &row->y, blk->proj);
+	}
+	else {
+	    row->x = atof(tokens[blk->xcol]);
+	    row->y = atof(tokens[blk->ycol]);
+	}
+
+	if (blk->zcol >= 0) {
+	    G_chop(tokens[blk->zcol]);
+	    row->z = atof(tokens[blk->zcol]);
+	}
+	else
+	    row->z = 0.0;
+
+	if (blk->catcol >= 0) {
+	    G_chop(tokens[blk->catcol]);
+	    row->cat = atof(tokens[blk->catcol]);
+	}
+	else
+	    row->cat = blk->cat + r + 1;
+
+	row->values = NULL;
+	if (blk->attr) {
+	    db_set_string(&sql, "( ");
+
+	    if (blk->catcol < 0) {
+		sprintf(buf, "%d, ", row->cat);
+		db_append_string(&sql, buf);
+	    }
+
+	    for (i = 0; i < ntokens; i++) {
+		G_chop(tokens[i]);
+		if (i > 0)
+		    db_append_string(&sql, ", ");
+
+		if (strlen(tokens[i]) > 0) {
+		    if (blk->coltype[i] == DB_C_TYPE_INT ||
+			blk->coltype[i] == DB_C_TYPE_DOUBLE) {
+			if (blk->ll && (i == blk->xcol || i == blk->ycol)) {
+			    sprintf(buf, "%.15g",
+				    i == blk->xcol ? row->x : row->y);
+			    db_append_string(&sql, buf);
+			}
+			else
+			    db_append_string(&sql, tokens[i]);
+		    }
+		    else {
+			db_set_string(&val, tokens[i]);
+			/* TODO: strip leading and trailing "quotes" from input string */
+			db_double_quote_string(&val);
+			db_append_string(&sql, "'");
+			db_append_string(&sql, db_get_string(&val));
+			db_append_string(&sql, "'");
+		    }
+		}
+		else {
+		    db_append_string(&sql, "null");
+		}
+	    }
+	    db_append_string(&sql, ")");
+	    row->values = G_store(db_get_string(&sql));
+	}
+
+	G_free_tokens(tokens);
+    }
+
+    db_free_string(&sql);
+    db_free_string(&val);
+}
+
+static void insert_values(dbDriver * driver, dbString * sql)
+{
+    G_debug(3, "%s", db_get_string(sql));
+
+    if (db_execute_immediate(driver, sql) != DB_OK) {
+	G_fatal_error(_("Unable to insert new record: %s"),
+		      db_get_string(sql));
+    }
+}
+
 /* Import points from ascii file.
  *
  * fs: field separator
@@ -313,18 +442,23 @@ int points_analyse(FILE * ascii_in, FILE * ascii, char *fs, char *td,
  *                            zcol and catcol may be 0 (do not use)
  * rowlen: maximum row length
  * Note: column types (both in header or coldef) must be supported by driver
+ *
+ * The rows are read by blocks split at line boundaries and parsed in
+ * parallel, points and attributes are written in the order of the rows.
  */
 int points_to_bin(FILE * ascii, int rowlen, struct Map_info *Map,
 		  dbDriver * driver, char *table, char *fs, char *td,
 		  int nrows, int *coltype, int xcol, int ycol, int zcol,
 		  int catcol, int skip_lines)
 {
-    char *buf, buf2[4000];
-    int cat = 0;
+    char *data, buf2[4000];
+    size_t alloc, len, n;
     int row = 0;
+    int r, insert_rows, ninsert;
+    struct point_block blk;
     struct line_pnts *Points;
     struct line_cats *Cats;
-    dbString sql, val;
+    dbString sql;
     struct Cell_head window;
 
     G_message(_("Importing points..."));
@@ -334,131 +468,135 @@ int points_to_bin(FILE * ascii, int rowlen, struct Map_info *Map,
     rewind(ascii);
     Points = Vect_new_line_struct();
     Cats = Vect_new_cats_struct();
-
-    /* actually last 2 characters won't be read */
-    buf = (char *)G_malloc(rowlen + 2);
     db_init_string(&sql);
-    db_init_string(&val);
 
     if (skip_lines > 0) {
 	sprintf(buf2, "HEADER: (%d lines)\n", skip_lines);
 	Vect_hist_write(Map, buf2);
     }
 
-    /* rowlen + 2 to read till the end of line on both UNIX and Windows */
-    while (G_getl2(buf, rowlen + 2, ascii) != 0) {
-	int i, len;
-	double x, y, z;
-	char **tokens;
-	int ntokens;		/* number of tokens */
+    blk.alloc = BLOCK_ROWS;
+    blk.rows = G_malloc(blk.alloc * sizeof(struct point_row));
+    blk.cat = 0;
+    blk.fs = fs;
+    blk.td = td;
+    blk.coltype = coltype;
+    blk.xcol = xcol;
+    blk.ycol = ycol;
+    blk.zcol = zcol;
+    blk.catcol = catcol;
+    blk.ll = G_projection() == PROJECTION_LL;
+    blk.proj = window.proj;
+    blk.attr = driver != NULL;
+
+    /* drivers with multi-row VALUES get several rows per statement */
+    insert_rows = 1;
+    if (driver) {
+	const char *name = driver->dbmscap.driverName;
+
+	if (strcmp(name, "sqlite") == 0 || strcmp(name, "pg") == 0 ||
+	    strcmp(name, "mysql") == 0)
+	    insert_rows = INSERT_ROWS;
+    }
+    ninsert = 0;
 
-	G_percent(row, nrows, 2);
-	row++;
+    /* the buffer holds at least two rows */
+    alloc = 16 << 20;
+    if (alloc < 2 * ((size_t) rowlen + 2))
+	alloc = 2 * ((size_t) rowlen + 2);
+    data = G_malloc(alloc + 1);
+    len = 0;
 
-	if (row <= skip_lines) {
-	    G_debug(4, "writing skip line %d to hist : %d chars", row,
-		    (int)strlen(buf));
-	    Vect_hist_write(Map, buf);
-	    Vect_hist_write(Map, "\n");
-	    continue;
-	}
+    do {
+	char *p, *end;
 
-	len = strlen(buf);
+	n = fread(data + len, 1, alloc - len, ascii);
+	len += n;
 	if (len == 0)
-	    continue;		/* should not happen */
-
-	G_debug(4, "row: %s", buf);
-
-	tokens = G_tokenize2(buf, fs, td);
-	ntokens = G_number_of_tokens(tokens);
-
-	G_chop(tokens[xcol]);
-	G_chop(tokens[ycol]);
+	    break;
+
+	/* split the buffer into rows */
+	blk.n = 0;
+	p = data;
+	while (p < data + len) {
+	    end = memchr(p, '\n', data + len - p);
+	    if (!end) {
+		if (n > 0)
+		    break;	/* continued in the next buffer */
+		end = data + len;	/* last row without newline */
+	    }
+	    *end = '\0';
+	    if (end > p && end[-1] == '\r')
+		end[-1] = '\0';
 
-	if ((G_projection() == PROJECTION_LL)) {
-	    G_scan_easting(tokens[xcol], &x, window.proj);
-	    G_scan_northing(tokens[ycol], &y, window.proj);
-	}
-	else {
-	    x = atof(tokens[xcol]);
-	    y = atof(tokens[ycol]);
-	}
-	G_debug(4, "x: %f, y: %f", x, y);
+	    row++;
+	    if (row <= skip_lines) {
+		G_debug(4, "writing skip line %d to hist : %d chars", row,
+			(int)strlen(p));
+		Vect_hist_write(Map, p);
+		Vect_hist_write(Map, "\n");
+	    }
+	    else if (*p) {
+		blk.rows[blk.n++].line = p;
+	    }
+	    p = end + 1;
 
-	if (zcol >= 0) {
-	    G_chop(tokens[zcol]);
-	    z = atof(tokens[zcol]);
+	    if (blk.n == blk.alloc)
+		break;
 	}
-	else
-	    z = 0.0;
 
-	if (catcol >= 0) {
-	    G_chop(tokens[catcol]);
-	    cat = atof(tokens[catcol]);
-	}
-	else
-	    cat++;
+	G_parallel_for(0, blk.n, 0, parse_rows, &blk);
 
-	Vect_reset_line(Points);
-	Vect_reset_cats(Cats);
+	for (r = 0; r < blk.n; r++) {
+	    struct point_row *prow = &blk.rows[r];
 
-	Vect_append_point(Points, x, y, z);
-	Vect_cat_set(Cats, 1, cat);
+	    G_percent(row - blk.n + r, nrows, 2);
 
-	Vect_write_line(Map, GV_POINT, Points, Cats);
+	    Vect_reset_line(Points);
+	    Vect_reset_cats(Cats);
 
-	/* Attributes */
-	if (driver) {
-	    sprintf(buf2, "insert into %s values ( ", table);
-	    db_set_string(&sql, buf2);
+	    Vect_append_point(Points, prow->x, prow->y, prow->z);
+	    Vect_cat_set(Cats, 1, prow->cat);
 
-	    if (catcol < 0) {
-		sprintf(buf2, "%d, ", cat);
-		db_append_string(&sql, buf2);
-	    }
+	    Vect_write_line(Map, GV_POINT, Points, Cats);
 
-	    for (i = 0; i < ntokens; i++) {
-		G_chop(tokens[i]);
-		if (i > 0)
+	    /* Attributes */
+	    if (driver) {
+		if (ninsert == 0) {
+		    sprintf(buf2, "insert into %s values ", table);
+		    db_set_string(&sql, buf2);
+		}
+		else
 		    db_append_string(&sql, ", ");
+		db_append_string(&sql, prow->values);
+		G_free(prow->values);
 
-		if (strlen(tokens[i]) > 0) {
-		    if (coltype[i] == DB_C_TYPE_INT ||
-			coltype[i] == DB_C_TYPE_DOUBLE) {
-			if (G_projection() == PROJECTION_LL &&
-			    (i == xcol || i == ycol)) {
-			    if (i == xcol)
-				sprintf(buf2, "%.15g", x);
-			    else
-				sprintf(buf2, "%.15g", y);
-			}
-			else
-			    sprintf(buf2, "%s", tokens[i]);
-		    }
-		    else {
-			db_set_string(&val, tokens[i]);
-			/* TODO: strip leading and trailing "quotes" from input string */
-			db_double_quote_string(&val);
-			sprintf(buf2, "'%s'", db_get_string(&val));
-		    }
+		if (++ninsert == insert_rows) {
+		    insert_values(driver, &sql);
+		    ninsert = 0;
 		}
-		else {
-		    sprintf(buf2, "null");
-		}
-		db_append_string(&sql, buf2);
 	    }
-	    db_append_string(&sql, ")");
-	    G_debug(3, "%s", db_get_string(&sql));
+	}
+	blk.cat += blk.n;
 
-	    if (db_execute_immediate(driver, &sql) != DB_OK) {
-		G_fatal_error(_("Unable to insert new record: %s"),
-			      db_get_string(&sql));
-	    }
+	/* keep the incomplete row */
+	if (p < data + len) {
+	    len = data + len - p;
+	    memmove(data, p, len);
 	}
+	else
+	    len = 0;
+    } while (n > 0 || len > 0);
 
-	G_free_tokens(tokens);
-    }
+    if (ninsert > 0)
+	insert_values(driver, &sql);
     G_percent(nrows, nrows, 2);
 
+    G_free(data);
+    G_free(blk.rows);
+    db_free_string(&sql);
+    Vect_destroy_line_struct(Points);
+    Vect_destroy_cats_struct(Cats);
+
     return 0;
 }
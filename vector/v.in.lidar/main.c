@@ -34,6 +34,7 @@
 #include "info.h"
 #include "vector_mask.h"
 #include "filters.h"
+#include "las_index.h"
 
 #ifndef MAX
 #  define MIN(a,b)      ((a<b) ? a : b)
@@ -85,7 +86,7 @@ int main(int argc, char *argv[])
     struct Flag *nocats_flag;
     struct Flag *over_flag, *extend_flag, *no_import_flag;
     struct Flag *invert_mask_flag;
-    struct Flag *only_valid_flag;
+    struct Flag *only_valid_flag, *index_flag;
     char buf[2000];
     struct Key_Value *loc_proj_info = NULL, *loc_proj_units = NULL;
     struct Key_Value *proj_info, *proj_units;
@@ -296,6 +297,14 @@ int main(int argc, char *argv[])
           " filtered out");
     only_valid_flag->guisection = _("Selection");
 
+    index_flag = G_define_flag();
+    index_flag->key = 'x';
+    index_flag->label = _("Create spatial index of input file");
+    index_flag->description =
+        _("Write index file (.lidx) next to the input file to read only"
+          " the parts of the file in the subregion later");
+    index_flag->guisection = _("Selection");
+
     extend_flag = G_define_flag();
     extend_flag->key = 'e';
     extend_flag->description =
@@ -610,7 +619,20 @@ int main(int argc, char *argv[])
 #else
     G_important_message(_("Scanning %lu points..."), n_features);
 #endif
-    while ((LAS_point = LASReader_GetNextPoint(LAS_reader)) != NULL) {
+    /* with a spatial index only blocks of points in the subregion are read */
+    struct LasIndex las_index;
+    struct LasIndexReader index_reader;
+    int have_index = FALSE;
+
+    if (index_flag->answer || spat_opt->answer || region_flag->answer)
+        have_index = las_index_get(in_opt->answer, index_flag->answer,
+                                   &las_index);
+    las_index_reader_init(&index_reader, LAS_reader,
+                          have_index && (spat_opt->answer ||
+                                         region_flag->answer) ?
+                          &las_index : NULL, xmin, xmax, ymin, ymax);
+
+    while ((LAS_point = las_index_next_point(&index_reader)) != NULL) {
 	double x, y, z;
 
 	G_percent(feature_count++, n_features, 1);	/* show something happens */
@@ -710,6 +732,9 @@ int main(int argc, char *argv[])
         points_imported++;
     }
     G_percent(n_features, n_features, 1);	/* finish it */
+    n_outside += index_reader.skipped;
+    if (have_index)
+        las_index_free(&las_index);
 
     if (!notab_flag->answer) {
 	db_commit_transaction(driver);
@@ -17,7 +17,9 @@
  **************************************************************/
 
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <math.h>
 #include <grass/gis.h>
 #include <grass/dbmi.h>
 #include <grass/vector.h>
@@ -25,8 +27,8 @@
 #include "ogr_api.h"
 #include "global.h"
 
-int split_line(struct Map_info *Map, int otype, struct line_pnts *Points,
-	       struct line_cats *Cats);
+int split_line(struct feature_lines *FL, int otype, struct line_pnts *Points,
+	       int with_cat);
 
 /* Add categories to centroids inside polygon */
 int
@@ -226,16 +228,120 @@ int poly_count(OGRGeometryH hGeom, int line2boundary)
     return 0;
 }
 
-/* Write geometry to output map */
+/* Initialize the lines of a feature */
+void init_lines(struct feature_lines *FL)
+{
+    FL->n = FL->alloc = 0;
+    FL->types = NULL;
+    FL->with_cat = NULL;
+    FL->Points = NULL;
+    FL->Work = Vect_new_line_struct();
+    FL->n_polygons = 0;
+    FL->warnings = NULL;
+    FL->n_warnings = FL->alloc_warnings = 0;
+}
+
+/* Remove the lines of a feature, keep the memory */
+void reset_lines(struct feature_lines *FL)
+{
+    int i;
+
+    for (i = 0; i < FL->n_warnings; i++)
+	G_free(FL->warnings[i]);
+    FL->n = 0;
+    FL->n_polygons = 0;
+    FL->n_warnings = 0;
+}
+
+void free_lines(struct feature_lines *FL)
+{
+    int i;
+
+    reset_lines(FL);
+    for (i = 0; i < FL->alloc; i++)
+	Vect_destroy_line_struct(FL->Points[i]);
+    G_free(FL->types);
+    G_free(FL->with_cat);
+    G_free(FL->Points);
+    G_free(FL->warnings);
+    Vect_destroy_line_struct(FL->Work);
+}
+
+/* Add a copy of a line to the lines of a feature */
+static void add_line(struct feature_lines *FL, int otype,
+		     const struct line_pnts *Points, int with_cat)
+{
+    if (FL->n == FL->alloc) {
+	int i;
+
+	FL->alloc = FL->alloc ? 2 * FL->alloc : 4;
+	FL->types = G_realloc(FL->types, FL->alloc * sizeof(int));
+	FL->with_cat = G_realloc(FL->with_cat, FL->alloc * sizeof(int));
+	FL->Points = G_realloc(FL->Points,
+			       FL->alloc * sizeof(struct line_pnts *));
+	for (i = FL->n; i < FL->alloc; i++)
+	    FL->Points[i] = Vect_new_line_struct();
+    }
+
+    FL->types[FL->n] = otype;
+    FL->with_cat[FL->n] = with_cat;
+    Vect_reset_line(FL->Points[FL->n]);
+    Vect_append_points(FL->Points[FL->n], Points, GV_FORWARD);
+    FL->n++;
+}
+
+/* Keep a warning, geom() may run on several threads */
+static void add_warning(struct feature_lines *FL, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (FL->n_warnings == FL->alloc_warnings) {
+	FL->alloc_warnings = FL->alloc_warnings ? 2 * FL->alloc_warnings : 2;
+	FL->warnings = G_realloc(FL->warnings,
+				 FL->alloc_warnings * sizeof(char *));
+    }
+
+    va_start(ap, fmt);
+    G_vasprintf(&FL->warnings[FL->n_warnings++], fmt, ap);
+    va_end(ap);
+}
+
+/* Write the lines of a feature to output map, print its warnings */
+int write_lines(struct Map_info *Map, int field, int cat,
+		struct feature_lines *FL)
+{
+    static struct line_cats *Cats = NULL, *BCats = NULL;
+    int i;
+
+    if (!Cats) {
+	Cats = Vect_new_cats_struct();
+	BCats = Vect_new_cats_struct();
+    }
+    Vect_reset_cats(Cats);
+    Vect_cat_set(Cats, field, cat);
+
+    for (i = 0; i < FL->n_warnings; i++)
+	G_warning("%s", FL->warnings[i]);
+
+    for (i = 0; i < FL->n; i++)
+	Vect_write_line(Map, FL->types[i], FL->Points[i],
+			FL->with_cat[i] ? Cats : BCats);
+    n_polygons += FL->n_polygons;
+
+    return FL->n;
+}
+
+/* Convert geometry to the lines of a feature */
+/* The lines are written by write_lines(): geom() does not access the
+ * output map, so that the geometries of several features can be
+ * converted on several threads */
 int
-geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
+geom(OGRGeometryH hGeom, struct feature_lines *FL, int cat,
      double min_area, int type, int mk_centr)
 {
     int i, valid_isles, j, np, nr, ret, otype;
-    static int first = 1;
-    static struct line_pnts *Points;
+    struct line_pnts *Points;
     struct line_pnts **IPoints;
-    static struct line_cats *BCats, *Cats;
     OGRwkbGeometryType eType;
     OGRGeometryH hRing;
     double x, y;
@@ -243,22 +349,14 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 
     G_debug(3, "geom() cat = %d", cat);
 
-    if (first) {
-	Points = Vect_new_line_struct();
-	BCats = Vect_new_cats_struct();
-	Cats = Vect_new_cats_struct();
-	first = 0;
-    }
+    Points = FL->Work;
     Vect_reset_line(Points);
-    Vect_reset_cats(Cats);
-    Vect_reset_cats(BCats);
-    Vect_cat_set(Cats, field, cat);
 
     eType = wkbFlatten(OGR_G_GetGeometryType(hGeom));
 
     if (eType == wkbPoint) {
 	if ((np = OGR_G_GetPointCount(hGeom)) == 0) {
-	    G_warning(_("Skipping empty geometry feature %d"), cat);
+	    add_warning(FL, _("Skipping empty geometry feature %d"), cat);
 	    return 0;
 	}
 
@@ -268,11 +366,11 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 	    otype = GV_CENTROID;
 	else
 	    otype = GV_POINT;
-	Vect_write_line(Map, otype, Points, Cats);
+	add_line(FL, otype, Points, 1);
     }
     else if (eType == wkbLineString) {
 	if ((np = OGR_G_GetPointCount(hGeom)) == 0) {
-	    G_warning(_("Skipping empty geometry feature %d"), cat);
+	    add_warning(FL, _("Skipping empty geometry feature %d"), cat);
 	    return 0;
 	}
 
@@ -287,9 +385,9 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 	    otype = GV_LINE;
 
 	if (split_distance > 0 && otype == GV_BOUNDARY)
-	    split_line(Map, otype, Points, Cats);
+	    split_line(FL, otype, Points, 1);
 	else
-	    Vect_write_line(Map, otype, Points, Cats);
+	    add_line(FL, otype, Points, 1);
     }
 
     else if (eType == wkbPolygon) {
@@ -301,7 +399,7 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 	/* Area */
 	hRing = OGR_G_GetGeometryRef(hGeom, 0);
 	if (hRing == NULL || (np = OGR_G_GetPointCount(hRing)) == 0) {
-            G_warning(_("Skipping empty geometry feature %d"), cat);
+            add_warning(FL, _("Skipping empty geometry feature %d"), cat);
 	    return 0;
 	}
 
@@ -317,8 +415,8 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 	/* Degenerate is not ignored because it may be useful to see where it is,
 	 * but may be eliminated by min_area option */
 	if (Points->n_points < 4)
-	    G_warning(_("Feature (cat %d): degenerated polygon (%d vertices)"),
-		      cat, Points->n_points);
+	    add_warning(FL, _("Feature (cat %d): degenerated polygon (%d vertices)"),
+			cat, Points->n_points);
 
 	size = G_area_of_polygon(Points->x, Points->y, Points->n_points);
 	if (size < min_area) {
@@ -326,7 +424,7 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 	    return 0;
 	}
 
-	n_polygons++;
+	FL->n_polygons++;
 
 	if (type & GV_LINE)
 	    otype = GV_LINE;
@@ -334,9 +432,9 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 	    otype = GV_BOUNDARY;
 
 	if (split_distance > 0 && otype == GV_BOUNDARY)
-	    split_line(Map, otype, Points, BCats);
+	    split_line(FL, otype, Points, 0);
 	else
-	    Vect_write_line(Map, otype, Points, BCats);
+	    add_line(FL, otype, Points, 0);
 
 	/* Isles */
 	IPoints =
@@ -349,7 +447,7 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 	    hRing = OGR_G_GetGeometryRef(hGeom, i);
 
 	    if ((np = OGR_G_GetPointCount(hRing)) == 0) {
-		G_warning(_("Skipping empty geometry feature %d"), cat);
+		add_warning(FL, _("Skipping empty geometry feature %d"), cat);
 	    }
 	    else {
 		IPoints[valid_isles] = Vect_new_line_struct();
@@ -363,8 +461,8 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 		Vect_line_prune(IPoints[valid_isles]);
 
 		if (IPoints[valid_isles]->n_points < 4)
-		    G_warning(_("Degenerate island (%d vertices)"),
-			      IPoints[i - 1]->n_points);
+		    add_warning(FL, _("Degenerate island (%d vertices)"),
+				IPoints[i - 1]->n_points);
 
 		size =
 		    G_area_of_polygon(IPoints[valid_isles]->x,
@@ -380,10 +478,9 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 		    else
 			otype = GV_BOUNDARY;
 		    if (split_distance > 0 && otype == GV_BOUNDARY)
-			split_line(Map, otype, IPoints[valid_isles], BCats);
+			split_line(FL, otype, IPoints[valid_isles], 0);
 		    else
-			Vect_write_line(Map, otype, IPoints[valid_isles],
-					BCats);
+			add_line(FL, otype, IPoints[valid_isles], 0);
 		}
 		valid_isles++;
 	    }
@@ -397,7 +494,7 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 		    Vect_get_point_in_poly_isl(Points, (const struct line_pnts **)IPoints,
 					       valid_isles, &x, &y);
 		if (ret == -1) {
-		    G_warning(_("Unable calculate centroid"));
+		    add_warning(FL, _("Unable calculate centroid"));
 		}
 		else {
 		    Vect_reset_line(Points);
@@ -406,7 +503,7 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 			otype = GV_POINT;
 		    else
 			otype = GV_CENTROID;
-		    Vect_write_line(Map, otype, Points, Cats);
+		    add_line(FL, otype, Points, 1);
 		}
 	    }
 	    else if (Points->n_points > 0) {
@@ -425,10 +522,10 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 		    otype = GV_POINT;
 		else
 		    otype = GV_CENTROID;
-		Vect_write_line(Map, otype, Points, Cats);
+		add_line(FL, otype, Points, 1);
 	    }
 	    else {		/* 0 points */
-		G_warning(_("No centroid written for polygon with 0 vertices"));
+		add_warning(FL, _("No centroid written for polygon with 0 vertices"));
 	    }
 	}
 
@@ -447,22 +544,23 @@ geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
 	for (i = 0; i < nr; i++) {
 	    hRing = OGR_G_GetGeometryRef(hGeom, i);
 
-	    ret = geom(hRing, Map, field, cat, min_area, type, mk_centr);
+	    ret = geom(hRing, FL, cat, min_area, type, mk_centr);
 	    if (ret == -1) {
-		G_warning(_("Unable to write part of geometry"));
+		add_warning(FL, _("Unable to write part of geometry"));
 	    }
 	}
     }
 
     else {
-	G_warning(_("Skipping unsupported geometry type '%s'"), OGR_G_GetGeometryName(hGeom));
+	add_warning(FL, _("Skipping unsupported geometry type '%s'"),
+		    OGR_G_GetGeometryName(hGeom));
     }
 
     return 0;
 }
 
-int split_line(struct Map_info *Map, int otype, struct line_pnts *Points,
-	       struct line_cats *Cats)
+int split_line(struct feature_lines *FL, int otype, struct line_pnts *Points,
+	       int with_cat)
 {
     int i;
     double dist = 0., seg_dist, dx, dy;
@@ -479,7 +577,7 @@ int split_line(struct Map_info *Map, int otype, struct line_pnts *Points,
 	
 	if (Points->n_points < 2)
 	    return 0;
-	Vect_write_line(Map, otype, Points, Cats);
+	add_line(FL, otype, Points, with_cat);
 	return 0;
     }
 
@@ -498,7 +596,7 @@ int split_line(struct Map_info *Map, int otype, struct line_pnts *Points,
 	seg_dist = sqrt(dx * dx + dy * dy);
 	dist += seg_dist;
 	if (dist > split_distance) {
-	    Vect_write_line(Map, otype, OutPoints, Cats);
+	    add_line(FL, otype, OutPoints, with_cat);
 	    Vect_reset_line(OutPoints);
 	    dist = seg_dist;
 	    Vect_append_point(OutPoints, Points->x[i - 1], Points->y[i - 1],
@@ -510,7 +608,7 @@ int split_line(struct Map_info *Map, int otype, struct line_pnts *Points,
     Vect_line_prune(OutPoints);
     
     if (OutPoints->n_points > 1)
-	Vect_write_line(Map, otype, OutPoints, Cats);
+	add_line(FL, otype, OutPoints, with_cat);
 
     Vect_destroy_line_struct(OutPoints);
 
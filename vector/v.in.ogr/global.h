@@ -23,6 +23,9 @@
 #ifndef __GLOBAL_H__
 #define __GLOBAL_H__
 
+#include <grass/gis.h>
+#include <grass/dbmi.h>
+#include <grass/vector.h>
 #include <gdal.h>
 #include <gdal_version.h>
 #include <ogr_api.h>
@@ -52,5 +55,65 @@ typedef struct
     int valid;
 } CENTR;
 
+/* lines of one feature made by geom(), written by write_lines() */
+struct feature_lines
+{
+    int n, alloc;
+    int *types;
+    int *with_cat;		/* line gets the category of the feature */
+    struct line_pnts **Points;
+    struct line_pnts *Work;	/* points of the geometry being converted */
+    int n_polygons;		/* added to n_polygons when written */
+    char **warnings;		/* printed when written */
+    int n_warnings, alloc_warnings;
+};
+
+/* geom.c */
+int geom(OGRGeometryH hGeom, struct feature_lines *FL, int cat,
+	 double min_area, int type, int mk_centr);
+void init_lines(struct feature_lines *FL);
+void reset_lines(struct feature_lines *FL);
+void free_lines(struct feature_lines *FL);
+int write_lines(struct Map_info *Map, int field, int cat,
+		struct feature_lines *FL);
+
+/* import.c */
+#define IMPORT_BLOCK_SIZE 1024	/* features of one block */
+
+struct import_feature
+{
+    OGRFeatureH Ogr_feature;
+    OGRFeatureDefnH Ogr_featuredefn;
+    OGRGeometryH *geoms;	/* geometries owned by the feature */
+    int n_geoms, alloc_geoms;
+    int cat;
+    int nogeom;			/* geometries lost by curve approximation */
+    struct feature_lines lines;
+    dbString sql;		/* insert statement */
+};
+
+struct import_block
+{
+    struct import_feature *features;
+    int n, alloc;
+    struct G_task_group *group;	/* conversion in progress */
+    void *chunks;		/* tasks of the conversion */
+    /* conversion settings */
+    int type, mk_centr;
+    double min_area;
+    const char *table;		/* NULL without attribute table */
+    int key_idx;
+};
+
+void import_block_init(struct import_block *, int, int, double);
+void import_block_set_layer(struct import_block *, const char *, int);
+int import_block_add(struct import_block *, OGRFeatureH, OGRFeatureDefnH,
+		     int, int *);
+void import_block_convert(struct import_block *);
+void import_block_wait(struct import_block *);
+int import_block_write(struct import_block *, struct Map_info *, int,
+		       dbDriver *, const char *);
+void import_block_free(struct import_block *);
+
 
 #endif /* __GLOBAL_H__ */
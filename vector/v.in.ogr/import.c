@@ -0,0 +1,371 @@
+
+/****************************************************************
+ *
+ * MODULE:       v.in.ogr
+ *
+ * PURPOSE:      Import OGR vectors in blocks of features
+ *
+ * COPYRIGHT:    (C) 2019 by the GRASS Development Team
+ *
+ *               This program is free software under the
+ *               GNU General Public License (>=v2).
+ *               Read the file COPYING that comes with GRASS
+ *               for details.
+ *
+ * Features are imported in three stages: the main thread reads the
+ * features of a block from the OGR layer, the geometries of the block
+ * are converted to lines and the insert statements are made on the
+ * worker threads, then the main thread writes the lines and inserts
+ * the attributes in the order of the features. Two blocks are used in
+ * turn, so that reading and writing overlap with the conversion of
+ * the other block and at most two blocks of features are kept in
+ * memory.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <grass/gis.h>
+#include <grass/dbmi.h>
+#include <grass/vector.h>
+#include <grass/glocale.h>
+#include <gdal_version.h>	/* needed for OFTDate */
+#include "global.h"
+
+/* features converted by one task */
+#define IMPORT_CHUNK 32
+
+struct import_chunk
+{
+    struct import_block *blk;
+    int first, last;
+};
+
+static void convert_chunk(void *);
+static void convert_feature(struct import_block *, struct import_feature *);
+static void make_insert(struct import_block *, struct import_feature *,
+			dbString *);
+
+/* Initialize a block of features */
+void import_block_init(struct import_block *blk, int type, int mk_centr,
+		       double min_area)
+{
+    blk->features = NULL;
+    blk->n = blk->alloc = 0;
+    blk->group = NULL;
+    blk->chunks = NULL;
+    blk->type = type;
+    blk->mk_centr = mk_centr;
+    blk->min_area = min_area;
+    blk->table = NULL;
+    blk->key_idx = -2;
+}
+
+/* Set the attribute table and the key column of the features to be
+ * added, table is NULL if no attributes are imported */
+void import_block_set_layer(struct import_block *blk, const char *table,
+			    int key_idx)
+{
+    blk->table = table;
+    blk->key_idx = key_idx;
+}
+
+/* Add a feature to the block, the block owns the feature afterwards;
+ * the category of the feature is cat, or taken from the key column or
+ * the FID if the feature has a geometry; returns the number of missing
+ * geometries */
+int import_block_add(struct import_block *blk, OGRFeatureH Ogr_feature,
+		     OGRFeatureDefnH Ogr_featuredefn, int igeom, int *cat)
+{
+    struct import_feature *f;
+    OGRGeometryH Ogr_geometry;
+    int i, nogeom;
+
+    if (blk->n == blk->alloc) {
+	blk->alloc = blk->alloc ? 2 * blk->alloc : IMPORT_BLOCK_SIZE;
+	blk->features = G_realloc(blk->features,
+				  blk->alloc * sizeof(struct import_feature));
+	for (i = blk->n; i < blk->alloc; i++) {
+	    f = &blk->features[i];
+	    f->geoms = NULL;
+	    f->alloc_geoms = 0;
+	    init_lines(&f->lines);
+	    db_init_string(&f->sql);
+	}
+    }
+
+    f = &blk->features[blk->n++];
+    f->Ogr_feature = Ogr_feature;
+    f->Ogr_featuredefn = Ogr_featuredefn;
+    f->n_geoms = 0;
+    f->nogeom = 0;
+
+    nogeom = 0;
+#if GDAL_VERSION_NUM >= 1110000
+    for (i = 0; i < OGR_FD_GetGeomFieldCount(Ogr_featuredefn); i++) {
+	if (igeom > -1 && i != igeom)
+	    continue;		/* use only geometry defined via param.geom */
+
+	Ogr_geometry = OGR_F_GetGeomFieldRef(Ogr_feature, i);
+#else
+	Ogr_geometry = OGR_F_GetGeometryRef(Ogr_feature);
+#endif
+	if (Ogr_geometry == NULL) {
+	    nogeom++;
+	}
+	else {
+	    if (blk->key_idx > -1)
+		*cat = OGR_F_GetFieldAsInteger(Ogr_feature, blk->key_idx);
+	    else if (blk->key_idx == -1)
+		*cat = OGR_F_GetFID(Ogr_feature);
+
+	    if (f->n_geoms == f->alloc_geoms) {
+		f->alloc_geoms = f->alloc_geoms ? 2 * f->alloc_geoms : 1;
+		f->geoms = G_realloc(f->geoms,
+				     f->alloc_geoms * sizeof(OGRGeometryH));
+	    }
+	    f->geoms[f->n_geoms++] = Ogr_geometry;
+	}
+#if GDAL_VERSION_NUM >= 1110000
+    }
+#endif
+    f->cat = *cat;
+
+    return nogeom;
+}
+
+/* Start the conversion of the features of a block on the worker
+ * threads, without workers the features are converted now */
+void import_block_convert(struct import_block *blk)
+{
+    struct import_chunk *chunks;
+    int i, n_chunks;
+
+    if (blk->n == 0)
+	return;
+
+    n_chunks = (blk->n + IMPORT_CHUNK - 1) / IMPORT_CHUNK;
+    chunks = G_malloc(n_chunks * sizeof(struct import_chunk));
+    blk->group = G_task_group_create();
+    for (i = 0; i < n_chunks; i++) {
+	chunks[i].blk = blk;
+	chunks[i].first = i * IMPORT_CHUNK;
+	chunks[i].last = (i + 1) * IMPORT_CHUNK;
+	if (chunks[i].last > blk->n)
+	    chunks[i].last = blk->n;
+	G_task_submit(blk->group, convert_chunk, &chunks[i]);
+    }
+    /* the chunks are freed when the conversion is done */
+    blk->chunks = chunks;
+}
+
+/* Wait for the conversion of a block */
+void import_block_wait(struct import_block *blk)
+{
+    if (!blk->group)
+	return;
+
+    G_task_group_destroy(blk->group);
+    blk->group = NULL;
+    G_free(blk->chunks);
+}
+
+/* Write the lines and insert the attributes of the converted features
+ * in their order, then remove the features from the block;
+ * returns the number of geometries which could not be converted */
+int import_block_write(struct import_block *blk, struct Map_info *Map,
+		       int field, dbDriver *driver, const char *layer_name)
+{
+    int i, nogeom;
+
+    nogeom = 0;
+    for (i = 0; i < blk->n; i++) {
+	struct import_feature *f = &blk->features[i];
+
+	write_lines(Map, field, f->cat, &f->lines);
+	nogeom += f->nogeom;
+
+	if (blk->table) {
+	    G_debug(3, "%s", db_get_string(&f->sql));
+
+	    if (db_execute_immediate(driver, &f->sql) != DB_OK) {
+		db_close_database(driver);
+		db_shutdown_driver(driver);
+		G_fatal_error(_("Cannot insert new row for input layer <%s>: %s"),
+			      layer_name, db_get_string(&f->sql));
+	    }
+	}
+
+	OGR_F_Destroy(f->Ogr_feature);
+	f->Ogr_feature = NULL;
+    }
+    blk->n = 0;
+
+    return nogeom;
+}
+
+void import_block_free(struct import_block *blk)
+{
+    int i;
+
+    import_block_wait(blk);
+    for (i = 0; i < blk->alloc; i++) {
+	struct import_feature *f = &blk->features[i];
+
+	if (i < blk->n)
+	    OGR_F_Destroy(f->Ogr_feature);
+	G_free(f->geoms);
+	free_lines(&f->lines);
+	db_free_string(&f->sql);
+    }
+    G_free(blk->features);
+    blk->features = NULL;
+    blk->n = blk->alloc = 0;
+}
+
+static void convert_chunk(void *closure)
+{
+    struct import_chunk *c = closure;
+    dbString strval;
+    int i;
+
+    db_init_string(&strval);
+    for (i = c->first; i < c->last; i++) {
+	convert_feature(c->blk, &c->blk->features[i]);
+	if (c->blk->table)
+	    make_insert(c->blk, &c->blk->features[i], &strval);
+    }
+    db_free_string(&strval);
+}
+
+/* Convert the geometries of a feature to lines */
+static void convert_feature(struct import_block *blk, struct import_feature *f)
+{
+    OGRGeometryH Ogr_geometry;
+    int i;
+
+    reset_lines(&f->lines);
+    for (i = 0; i < f->n_geoms; i++) {
+	Ogr_geometry = f->geoms[i];
+#if GDAL_VERSION_NUM >= 2000000
+	if (OGR_G_HasCurveGeometry(Ogr_geometry, 1)) {
+	    G_debug(2, "Approximating curves in a '%s'",
+		    OGR_G_GetGeometryName(Ogr_geometry));
+	}
+	Ogr_geometry = OGR_G_GetLinearGeometry(Ogr_geometry, 0, NULL);
+	if (Ogr_geometry == NULL) {
+	    f->nogeom++;
+	    continue;
+	}
+#endif
+	geom(Ogr_geometry, &f->lines, f->cat, blk->min_area, blk->type,
+	     blk->mk_centr);
+#if GDAL_VERSION_NUM >= 2000000
+	OGR_G_DestroyGeometry(Ogr_geometry);
+#endif
+    }
+}
+
+/* Make the statement inserting the attributes of a feature */
+static void make_insert(struct import_block *blk, struct import_feature *f,
+			dbString *strval)
+{
+    OGRFieldDefnH Ogr_field;
+    OGRFieldType Ogr_ftype;
+    char *sqlbuf;
+    size_t sqlbufsize;
+    int i, ncols;
+
+    sqlbuf = NULL;
+    sqlbufsize = 0;
+
+    G_rasprintf(&sqlbuf, &sqlbufsize, "insert into %s values ( %d",
+		blk->table, f->cat);
+    db_set_string(&f->sql, sqlbuf);
+
+    ncols = OGR_FD_GetFieldCount(f->Ogr_featuredefn);
+    for (i = 0; i < ncols; i++) {
+	const char *Ogr_fstring = NULL;
+
+	if (blk->key_idx > -1 && blk->key_idx == i)
+	    continue;		/* skip defined key (FID column) */
+
+	Ogr_field = OGR_FD_GetFieldDefn(f->Ogr_featuredefn, i);
+	Ogr_ftype = OGR_Fld_GetType(Ogr_field);
+	if (OGR_F_IsFieldSet(f->Ogr_feature, i))
+	    Ogr_fstring = OGR_F_GetFieldAsString(f->Ogr_feature, i);
+	if (Ogr_fstring && *Ogr_fstring) {
+	    if (Ogr_ftype == OFTInteger ||
+#if GDAL_VERSION_NUM >= 2000000
+		Ogr_ftype == OFTInteger64 ||
+#endif
+		Ogr_ftype == OFTReal) {
+		G_rasprintf(&sqlbuf, &sqlbufsize, ", %s", Ogr_fstring);
+	    }
+#if GDAL_VERSION_NUM >= 1320
+	    /* should we use OGR_F_GetFieldAsDateTime() here ? */
+	    else if (Ogr_ftype == OFTDate || Ogr_ftype == OFTTime
+		     || Ogr_ftype == OFTDateTime) {
+		char *newbuf;
+
+		db_set_string(strval, (char *)Ogr_fstring);
+		db_double_quote_string(strval);
+		G_rasprintf(&sqlbuf, &sqlbufsize, ", '%s'",
+			    db_get_string(strval));
+		newbuf = G_str_replace(sqlbuf, "/", "-");	/* fix 2001/10/21 to 2001-10-21 */
+		G_rasprintf(&sqlbuf, &sqlbufsize, "%s", newbuf);
+		G_free(newbuf);
+	    }
+#endif
+	    else if (Ogr_ftype == OFTString ||
+		     Ogr_ftype == OFTStringList ||
+		     Ogr_ftype == OFTIntegerList
+#if GDAL_VERSION_NUM >= 2000000
+		     || Ogr_ftype == OFTInteger64List
+#endif
+		) {
+		db_set_string(strval, (char *)Ogr_fstring);
+		db_double_quote_string(strval);
+		G_rasprintf(&sqlbuf, &sqlbufsize, ", '%s'",
+			    db_get_string(strval));
+	    }
+	    else {
+		/* column type not supported */
+		G_rasprintf(&sqlbuf, &sqlbufsize, "%c", '\0');
+	    }
+	}
+	else {
+	    /* G_warning (_("Column value not set" )); */
+	    if (Ogr_ftype == OFTInteger ||
+#if GDAL_VERSION_NUM >= 2000000
+		Ogr_ftype == OFTInteger64 ||
+#endif
+		Ogr_ftype == OFTReal) {
+		G_rasprintf(&sqlbuf, &sqlbufsize, ", NULL");
+	    }
+#if GDAL_VERSION_NUM >= 1320
+	    else if (Ogr_ftype == OFTDate ||
+		     Ogr_ftype == OFTTime || Ogr_ftype == OFTDateTime) {
+		G_rasprintf(&sqlbuf, &sqlbufsize, ", NULL");
+	    }
+#endif
+	    else if (Ogr_ftype == OFTString ||
+		     Ogr_ftype == OFTStringList ||
+		     Ogr_ftype == OFTIntegerList
+#if GDAL_VERSION_NUM >= 2000000
+		     || Ogr_ftype == OFTInteger64List
+#endif
+		) {
+		G_rasprintf(&sqlbuf, &sqlbufsize, ", NULL");
+	    }
+	    else {
+		/* column type not supported */
+		G_rasprintf(&sqlbuf, &sqlbufsize, "%c", '\0');
+	    }
+	}
+	db_append_string(&f->sql, sqlbuf);
+    }
+    db_append_string(&f->sql, " )");
+
+    G_free(sqlbuf);
+}
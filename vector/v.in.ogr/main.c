@@ -40,8 +40,6 @@ int n_polygons;
 int n_polygon_boundaries;
 double split_distance;
 
-int geom(OGRGeometryH hGeom, struct Map_info *Map, int field, int cat,
-	 double min_area, int type, int mk_centr);
 int centroid(OGRGeometryH hGeom, CENTR * Centr, struct spatial_index * Sindex,
 	     int field, int cat, double min_area, int type);
 int poly_count(OGRGeometryH hGeom, int line2boundary);
@@ -113,13 +111,13 @@ int main(int argc, char *argv[])
     struct GModule *module;
     struct _param {
 	struct Option *dsn, *out, *layer, *spat, *where,
-	    *min_area, *cfg, *doo;
+	    *min_area, *cfg, *doo, *nprocs;
         struct Option *snap, *type, *outloc, *cnames, *encoding, *key, *geom;
     } param;
     struct _flag {
 	struct Flag *list, *no_clean, *force2d, *notab,
 	    *region, *over, *extend, *formats, *tolower, *no_import,
-            *proj;
+            *proj, *valid;
     } flag;
 
     char *desc;
@@ -129,8 +127,6 @@ int main(int argc, char *argv[])
     int ncols = 0, type;
     double min_area, snap;
     char buf[DB_SQL_MAX], namebuf[1024];
-    char *sqlbuf;
-    size_t sqlbufsize;
     char *separator;
 
     struct Cell_head cellhd, cur_wind;
@@ -143,7 +139,7 @@ int main(int argc, char *argv[])
     /* Attributes */
     struct field_info *Fi = NULL;
     dbDriver *driver = NULL;
-    dbString sql, strval;
+    dbString sql;
     int with_z, input3d;
     const char **key_column;
     int *key_idx;
@@ -161,6 +157,7 @@ int main(int argc, char *argv[])
     OGRGeometryH Ogr_geometry, *poSpatialFilter;
     const char *attr_filter;
     struct OGR_iterator OGR_iter;
+    struct import_block blk[2], *prev, *curr;
 
     int OFTIntegerListlength;
 
@@ -331,6 +328,8 @@ int main(int argc, char *argv[])
     param.geom->description = _("If not given, all geometry columns from the input are used");
     param.geom->guisection = _("Selection");
 
+    param.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.formats = G_define_flag();
     flag.formats->key = 'f';
     flag.formats->description = _("List supported OGR formats and exit");
@@ -349,6 +348,15 @@ int main(int argc, char *argv[])
     flag.no_clean->description = _("Do not clean polygons (not recommended)");
     flag.no_clean->guisection = _("Output");
 
+    flag.valid = G_define_flag();
+    flag.valid->key = 'v';
+    flag.valid->label =
+	_("Assume that polygons are topologically valid");
+    flag.valid->description =
+	_("Polygons must not overlap and must share boundaries vertex by vertex; "
+	  "only shared boundaries are broken and duplicates removed when cleaning");
+    flag.valid->guisection = _("Output");
+
     flag.force2d = G_define_flag();
     flag.force2d->key = '2';
     flag.force2d->label = _("Force 2D output even if input is 3D");
@@ -402,9 +410,13 @@ int main(int argc, char *argv[])
      * in the module after the parser */
     overwrite = G_check_overwrite(argc, argv);
 
+    G_option_exclusive(flag.no_clean, flag.valid, NULL);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(param.nprocs);
+
 #if GDAL_VERSION_NUM >= 2000000
     GDALAllRegister();
 #else
@@ -801,7 +813,6 @@ int main(int argc, char *argv[])
     }
 
     db_init_string(&sql);
-    db_init_string(&strval);
 
     n_features = (GIntBig *)G_malloc(nlayers * sizeof(GIntBig));
 
@@ -1230,8 +1241,8 @@ int main(int argc, char *argv[])
     }
 
     /* import features */
-    sqlbuf = NULL;
-    sqlbufsize = 0;
+    for (i = 0; i < 2; i++)
+	import_block_init(&blk[i], type, flag.no_clean->answer, min_area);
     OGR_iterator_reset(&OGR_iter);
     for (layer = 0; layer < nlayers; layer++) {
 	layer_id = layers[layer];
@@ -1269,153 +1280,38 @@ int main(int argc, char *argv[])
             igeom = OGR_FD_GetGeomFieldIndex(Ogr_featuredefn, param.geom->answer);
 #endif
 
-	while ((Ogr_feature = ogr_getnextfeature(&OGR_iter, layer_id,
-	                                         layer_names[layer],
-						 poSpatialFilter[layer],
-						 attr_filter)) != NULL) {
-	    G_percent(feature_count++, n_features[layer], 1);	/* show something happens */
-
-            /* Geometry */
-            Ogr_featuredefn = OGR_iter.Ogr_featuredefn;
-#if GDAL_VERSION_NUM >= 1110000
-            for (i = 0; i < OGR_FD_GetGeomFieldCount(Ogr_featuredefn); i++) {
-                if (igeom > -1 && i != igeom)
-                    continue; /* use only geometry defined via param.geom */
-            
-                Ogr_geometry = OGR_F_GetGeomFieldRef(Ogr_feature, i);
-#else
-                Ogr_geometry = OGR_F_GetGeometryRef(Ogr_feature);
-#endif                
-#if GDAL_VERSION_NUM >= 2000000
-                if (Ogr_geometry != NULL) {
-		    if (OGR_G_HasCurveGeometry(Ogr_geometry, 1)) {
-			G_debug(2, "Approximating curves in a '%s'",
-			        OGR_G_GetGeometryName(Ogr_geometry));
-		    }
-		    Ogr_geometry = OGR_G_GetLinearGeometry(Ogr_geometry, 0, NULL);
-		}
-#endif
-                if (Ogr_geometry == NULL) {
-                    nogeom++;
-                }
-                else {
-                    if (key_idx[layer] > -1)
-                        cat = OGR_F_GetFieldAsInteger(Ogr_feature, key_idx[layer]);
-                    else if (key_idx[layer] == -1)
-                        cat = OGR_F_GetFID(Ogr_feature);
-
-                    geom(Ogr_geometry, Out, layer + 1, cat, min_area, type,
-                         flag.no_clean->answer);
-#if GDAL_VERSION_NUM >= 2000000
-		    OGR_G_DestroyGeometry(Ogr_geometry);
-#endif
-                }
-#if GDAL_VERSION_NUM >= 1110000              
-            }
-#endif
-	    /* Attributes */
-	    ncols = OGR_FD_GetFieldCount(Ogr_featuredefn);
-	    if (!flag.notab->answer) {
-		G_rasprintf(&sqlbuf, &sqlbufsize, "insert into %s values ( %d", Fi->table, cat);
-		db_set_string(&sql, sqlbuf);
-		for (i = 0; i < ncols; i++) {
-		    const char *Ogr_fstring = NULL;
-
-                    if (key_idx[layer] > -1 && key_idx[layer] == i)
-                        continue; /* skip defined key (FID column) */
-
-		    Ogr_field = OGR_FD_GetFieldDefn(Ogr_featuredefn, i);
-		    Ogr_ftype = OGR_Fld_GetType(Ogr_field);
-		    if (OGR_F_IsFieldSet(Ogr_feature, i))
-			Ogr_fstring = OGR_F_GetFieldAsString(Ogr_feature, i);
-		    if (Ogr_fstring && *Ogr_fstring) {
-			if (Ogr_ftype == OFTInteger ||
-#if GDAL_VERSION_NUM >= 2000000
-                            Ogr_ftype == OFTInteger64 ||
-#endif
-                            Ogr_ftype == OFTReal) {
-			    G_rasprintf(&sqlbuf, &sqlbufsize, ", %s", Ogr_fstring);
-			}
-#if GDAL_VERSION_NUM >= 1320
-			    /* should we use OGR_F_GetFieldAsDateTime() here ? */
-			else if (Ogr_ftype == OFTDate || Ogr_ftype == OFTTime
-				 || Ogr_ftype == OFTDateTime) {
-			    char *newbuf;
-
-			    db_set_string(&strval, (char *)Ogr_fstring);
-			    db_double_quote_string(&strval);
-			    G_rasprintf(&sqlbuf, &sqlbufsize, ", '%s'", db_get_string(&strval));
-			    newbuf = G_str_replace(sqlbuf, "/", "-");	/* fix 2001/10/21 to 2001-10-21 */
-			    G_rasprintf(&sqlbuf, &sqlbufsize, "%s", newbuf);
-			    G_free(newbuf);
-			}
-#endif
-			else if (Ogr_ftype == OFTString ||
-			         Ogr_ftype == OFTStringList ||
-				 Ogr_ftype == OFTIntegerList 
-#if GDAL_VERSION_NUM >= 2000000
-                                 || Ogr_ftype == OFTInteger64List
-#endif
-                                 ) {
-			    db_set_string(&strval, (char *)Ogr_fstring);
-			    db_double_quote_string(&strval);
-			    G_rasprintf(&sqlbuf, &sqlbufsize, ", '%s'", db_get_string(&strval));
-			}
-			else {
-			    /* column type not supported */
-			    G_rasprintf(&sqlbuf, &sqlbufsize, "%c", '\0');
-			}
-		    }
-		    else {
-			/* G_warning (_("Column value not set" )); */
-			if (Ogr_ftype == OFTInteger ||
-#if GDAL_VERSION_NUM >= 2000000
-                            Ogr_ftype == OFTInteger64 ||
-#endif
-                            Ogr_ftype == OFTReal) {
-			    G_rasprintf(&sqlbuf, &sqlbufsize, ", NULL");
-			}
-#if GDAL_VERSION_NUM >= 1320
-			else if (Ogr_ftype == OFTDate ||
-				 Ogr_ftype == OFTTime || 
-				 Ogr_ftype == OFTDateTime) {
-			    G_rasprintf(&sqlbuf, &sqlbufsize, ", NULL");
-			}
-#endif
-			else if (Ogr_ftype == OFTString ||
-			         Ogr_ftype == OFTStringList ||
-				 Ogr_ftype == OFTIntegerList
-#if GDAL_VERSION_NUM >= 2000000
-                                 || Ogr_ftype == OFTInteger64List
-#endif
-                                 ) {
-			    G_rasprintf(&sqlbuf, &sqlbufsize, ", NULL");
-			}
-			else {
-			    /* column type not supported */
-			    G_rasprintf(&sqlbuf, &sqlbufsize, "%c", '\0');
-			}
-		    }
-		    if (strlen(sqlbuf) >= DB_SQL_MAX) {
-			G_debug(1, "%s", sqlbuf);
-			G_debug(1, "Field %d is %ld long", i, strlen(sqlbuf));
-		    }
-		    db_append_string(&sql, sqlbuf);
-		}
-		db_append_string(&sql, " )");
-		G_debug(3, "%s", db_get_string(&sql));
+	/* read a block of features while the previous block is converted,
+	 * then write the previous block while this block is converted,
+	 * see import.c */
+	for (i = 0; i < 2; i++)
+	    import_block_set_layer(&blk[i], flag.notab->answer ? NULL : Fi->table,
+				   key_idx[layer]);
+	prev = NULL;
+	curr = &blk[0];
+	do {
+	    while (curr->n < IMPORT_BLOCK_SIZE &&
+		   (Ogr_feature = ogr_getnextfeature(&OGR_iter, layer_id,
+						     layer_names[layer],
+						     poSpatialFilter[layer],
+						     attr_filter)) != NULL) {
+		G_percent(feature_count++, n_features[layer], 1);	/* show something happens */
 
-		if (db_execute_immediate(driver, &sql) != DB_OK) {
-		    db_close_database(driver);
-		    db_shutdown_driver(driver);
-		    G_fatal_error(_("Cannot insert new row for input layer <%s>: %s"),
-				  layer_names[layer], db_get_string(&sql));
-		}
+		nogeom += import_block_add(curr, Ogr_feature,
+					   OGR_iter.Ogr_featuredefn, igeom,
+					   &cat);
+		cat++;
 	    }
 
-	    OGR_F_Destroy(Ogr_feature);
-	    cat++;
-	}
+	    if (prev)
+		import_block_wait(prev);
+	    import_block_convert(curr);
+	    if (prev)
+		nogeom += import_block_write(prev, Out, layer + 1, driver,
+					     layer_names[layer]);
+
+	    prev = curr;
+	    curr = curr == &blk[0] ? &blk[1] : &blk[0];
+	} while (prev->n > 0);
 	G_percent(1, 1, 1);	/* finish it */
 
 	if (!flag.notab->answer) {
@@ -1428,6 +1324,8 @@ int main(int argc, char *argv[])
 	              nogeom, nogeom == 1 ? _("feature") : _("features"),
 		      layer_names[layer]);
     }
+    for (i = 0; i < 2; i++)
+	import_block_free(&blk[i]);
 
     delete_table = Vect_maptype(&Map) != GV_FORMAT_NATIVE;
 
@@ -1523,51 +1421,57 @@ int main(int argc, char *argv[])
 	/* Vect_clean_small_angles_at_nodes() can change the geometry so that new intersections
 	 * are created. We must call Vect_break_lines(), Vect_remove_duplicates()
 	 * and Vect_clean_small_angles_at_nodes() until no more small angles are found */
-	do {
-	    G_message("%s", separator);
-	    G_message(_("Breaking boundaries..."));
-	    Vect_break_lines(&Tmp, GV_BOUNDARY, NULL);
-
-	    G_message("%s", separator);
-	    G_message(_("Removing duplicates..."));
-	    Vect_remove_duplicates(&Tmp, GV_BOUNDARY, NULL);
-
-	    G_message("%s", separator);
-	    G_message(_("Cleaning boundaries at nodes..."));
-	    nmodif =
-		Vect_clean_small_angles_at_nodes(&Tmp, GV_BOUNDARY, NULL);
-	} while (nmodif > 0);
+	/* valid polygons do not intersect, their boundaries are done */
+	if (!flag.valid->answer) {
+	    do {
+		G_message("%s", separator);
+		G_message(_("Breaking boundaries..."));
+		Vect_break_lines(&Tmp, GV_BOUNDARY, NULL);
+
+		G_message("%s", separator);
+		G_message(_("Removing duplicates..."));
+		Vect_remove_duplicates(&Tmp, GV_BOUNDARY, NULL);
+
+		G_message("%s", separator);
+		G_message(_("Cleaning boundaries at nodes..."));
+		nmodif =
+		    Vect_clean_small_angles_at_nodes(&Tmp, GV_BOUNDARY, NULL);
+	    } while (nmodif > 0);
+	}
 
 	/* merge boundaries */
 	G_message("%s", separator);
 	G_message(_("Merging boundaries..."));
 	Vect_merge_lines(&Tmp, GV_BOUNDARY, NULL, NULL);
 
-	G_message("%s", separator);
-	if (type & GV_BOUNDARY) {	/* that means lines were converted to boundaries */
-	    G_message(_("Changing boundary dangles to lines..."));
-	    Vect_chtype_dangles(&Tmp, -1.0, NULL);
-	}
-	else {
-	    G_message(_("Removing dangles..."));
-	    Vect_remove_dangles(&Tmp, GV_BOUNDARY, -1.0, NULL);
-	}
+	/* valid polygons have neither dangles nor bridges */
+	if (!flag.valid->answer) {
+	    G_message("%s", separator);
+	    if (type & GV_BOUNDARY) {	/* that means lines were converted to boundaries */
+		G_message(_("Changing boundary dangles to lines..."));
+		Vect_chtype_dangles(&Tmp, -1.0, NULL);
+	    }
+	    else {
+		G_message(_("Removing dangles..."));
+		Vect_remove_dangles(&Tmp, GV_BOUNDARY, -1.0, NULL);
+	    }
 
-	G_message("%s", separator);
-	Vect_build_partial(&Tmp, GV_BUILD_AREAS);
+	    G_message("%s", separator);
+	    Vect_build_partial(&Tmp, GV_BUILD_AREAS);
 
-	G_message("%s", separator);
-	if (type & GV_BOUNDARY) {
-	    G_message(_("Changing boundary bridges to lines..."));
-	    Vect_chtype_bridges(&Tmp, NULL, &nmodif, NULL);
-	    if (nmodif)
-		Vect_build_partial(&Tmp, GV_BUILD_NONE);
-	}
-	else {
-	    G_message(_("Removing bridges..."));
-	    Vect_remove_bridges(&Tmp, NULL, &nmodif, NULL);
-	    if (nmodif)
-		Vect_build_partial(&Tmp, GV_BUILD_NONE);
+	    G_message("%s", separator);
+	    if (type & GV_BOUNDARY) {
+		G_message(_("Changing boundary bridges to lines..."));
+		Vect_chtype_bridges(&Tmp, NULL, &nmodif, NULL);
+		if (nmodif)
+		    Vect_build_partial(&Tmp, GV_BUILD_NONE);
+	    }
+	    else {
+		G_message(_("Removing bridges..."));
+		Vect_remove_bridges(&Tmp, NULL, &nmodif, NULL);
+		if (nmodif)
+		    Vect_build_partial(&Tmp, GV_BUILD_NONE);
+	    }
 	}
 
 	/* Boundaries are hopefully clean, build areas */
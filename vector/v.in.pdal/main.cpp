@@ -23,6 +23,8 @@
 #include <pdal/filters/ReprojectionFilter.hpp>
 #include <pdal/filters/StreamCallbackFilter.hpp>
 
+#include <vector>
+
 extern "C"
 {
 #include <grass/gis.h>
@@ -72,35 +74,59 @@ static void check_layers_in_list_not_equal(struct Option **options,
     }
 }
 
-void pdal_point_to_grass(struct Map_info *output_vector,
-                         struct line_pnts *points, struct line_cats *cats,
-                         pdal::PointRef& point,
-                         struct GLidarLayers *layers, int cat,
-                         pdal::Dimension::Id dim_to_use_as_z)
+/* points accepted by the filters, written to the vector map
+ * together once the batch is full */
+struct PointBatch
 {
-    Vect_reset_line(points);
-    Vect_reset_cats(cats);
+    std::vector<double> x, y, z;
+    std::vector<int> id_cat, return_cat, class_cat, rgb_cat;
 
-    using namespace pdal::Dimension;
-    double x = point.getFieldAs<double>(Id::X);
-    double y = point.getFieldAs<double>(Id::Y);
-    double z = point.getFieldAs<double>(dim_to_use_as_z);
-
-    /* TODO: optimize for case with no layers, by adding
-     * and if to skip all the other ifs */
-    if (layers->id_layer) {
-        Vect_cat_set(cats, layers->id_layer, cat);
+    explicit PointBatch(size_t capacity)
+    {
+        x.reserve(capacity);
+        y.reserve(capacity);
+        z.reserve(capacity);
+        id_cat.reserve(capacity);
+        return_cat.reserve(capacity);
+        class_cat.reserve(capacity);
+        rgb_cat.reserve(capacity);
+    }
+
+    size_t size() const
+    {
+        return x.size();
     }
+
+    void clear()
+    {
+        x.clear();
+        y.clear();
+        z.clear();
+        id_cat.clear();
+        return_cat.clear();
+        class_cat.clear();
+        rgb_cat.clear();
+    }
+};
+
+void pdal_point_to_batch(PointBatch& batch, pdal::PointRef& point,
+                         struct GLidarLayers *layers, int cat,
+                         double x, double y, double z)
+{
+    using namespace pdal::Dimension;
+
+    batch.x.push_back(x);
+    batch.y.push_back(y);
+    batch.z.push_back(z);
+    if (layers->id_layer)
+        batch.id_cat.push_back(cat);
     if (layers->return_layer) {
         int return_n = point.getFieldAs<int>(Id::ReturnNumber);
         int n_returns = point.getFieldAs<int>(Id::NumberOfReturns);
-        int return_c = return_to_cat(return_n, n_returns);
-        Vect_cat_set(cats, layers->return_layer, return_c);
-    }
-    if (layers->class_layer) {
-        Vect_cat_set(cats, layers->class_layer,
-                     point.getFieldAs<int>(Id::Classification));
+        batch.return_cat.push_back(return_to_cat(return_n, n_returns));
     }
+    if (layers->class_layer)
+        batch.class_cat.push_back(point.getFieldAs<int>(Id::Classification));
     if (layers->rgb_layer) {
         int red = point.getFieldAs<int>(Id::Red);
         int green = point.getFieldAs<int>(Id::Green);
@@ -109,11 +135,29 @@ void pdal_point_to_grass(struct Map_info *output_vector,
         rgb = (rgb << 8) + green;
         rgb = (rgb << 8) + blue;
         rgb++;  /* cat 0 is not valid, add one */
-        Vect_cat_set(cats, layers->rgb_layer, rgb);
+        batch.rgb_cat.push_back(rgb);
     }
+}
 
-    Vect_append_point(points, x, y, z);
-    Vect_write_line(output_vector, GV_POINT, points, cats);
+void write_batch(struct Map_info *output_vector, struct line_pnts *points,
+                 struct line_cats *cats, struct GLidarLayers *layers,
+                 PointBatch& batch)
+{
+    for (size_t i = 0; i < batch.size(); i++) {
+        Vect_reset_line(points);
+        Vect_reset_cats(cats);
+        if (layers->id_layer)
+            Vect_cat_set(cats, layers->id_layer, batch.id_cat[i]);
+        if (layers->return_layer)
+            Vect_cat_set(cats, layers->return_layer, batch.return_cat[i]);
+        if (layers->class_layer)
+            Vect_cat_set(cats, layers->class_layer, batch.class_cat[i]);
+        if (layers->rgb_layer)
+            Vect_cat_set(cats, layers->rgb_layer, batch.rgb_cat[i]);
+        Vect_append_point(points, batch.x[i], batch.y[i], batch.z[i]);
+        Vect_write_line(output_vector, GV_POINT, points, cats);
+    }
+    batch.clear();
 }
 
 int main(int argc, char *argv[])
@@ -488,7 +532,14 @@ int main(int argc, char *argv[])
     // consumption, so using 10k in case it is faster for some cases
     pdal::point_count_t point_table_capacity = 10000;
     pdal::FixedPointTable point_table(point_table_capacity);
-    stream_filter.prepare(point_table);
+    // the ground and height filters need all points at once,
+    // the points are read into memory in that case
+    bool streamable = last_stage->pipelineStreamable();
+    pdal::PointTable full_point_table;
+    if (streamable)
+        stream_filter.prepare(point_table);
+    else
+        last_stage->prepare(full_point_table);
 
     // getting projection is possible only after prepare
     if (over_flag->answer) {
@@ -511,7 +562,8 @@ int main(int argc, char *argv[])
     G_important_message(_("Running PDAL algorithms..."));
 
     // get the layout to see the dimensions
-    pdal::PointLayoutPtr point_layout = point_table.layout();
+    pdal::PointLayoutPtr point_layout = streamable ?
+        point_table.layout() : full_point_table.layout();
 
     // TODO: test also z
     // TODO: the falses for filters should be perhaps fatal error
@@ -591,6 +643,9 @@ int main(int argc, char *argv[])
     int cat = 1;
     bool cat_max_reached = false;
 
+    // points are collected and written after each table of points
+    PointBatch batch(point_table_capacity);
+
     // define callback
     // Capture all values for reading by value, except for the ones
     // for writing which we capture by reference.
@@ -601,7 +656,7 @@ int main(int argc, char *argv[])
     auto cb = [=, &cat, &cat_max_reached,
                &n_outside, &zrange_filtered, &n_filtered,
                &n_class_filtered, &class_filter, &return_filter_struct,
-               &output_vector, &layers](pdal::PointRef& point) -> bool
+               &output_vector, &layers, &batch](pdal::PointRef& point) -> bool
     {
         // TODO: avoid duplication of reading the attributes here and when writing if needed
         double x = point.getFieldAs<double>(pdal::Dimension::Id::X);
@@ -639,8 +694,9 @@ int main(int argc, char *argv[])
                 return false;
             }
         }
-        pdal_point_to_grass(&output_vector, points, cats, point,
-                            &layers, cat, dim_to_use_as_z);
+        pdal_point_to_batch(batch, point, &layers, cat, x, y, z);
+        if (batch.size() >= point_table_capacity)
+            write_batch(&output_vector, points, cats, &layers, batch);
         if (layers.id_layer) {
             // we limit the count of imported points, so we don't
             // need to check if we reached GV_CAT_MAX
@@ -650,9 +706,23 @@ int main(int argc, char *argv[])
     };
 
     // set the callback and run the actual processing
-    stream_filter.setCallback(cb);
-    stream_filter.execute(point_table);
-    
+    if (streamable) {
+        stream_filter.setCallback(cb);
+        stream_filter.execute(point_table);
+    }
+    else {
+        G_verbose_message(_("Pipeline cannot be streamed,"
+                            " reading all points into memory"));
+        pdal::PointViewSet views = last_stage->execute(full_point_table);
+        for (pdal::PointViewPtr view : views) {
+            for (pdal::PointId idx = 0; idx < view->size(); idx++) {
+                pdal::PointRef point(*view, idx);
+                cb(point);
+            }
+        }
+    }
+    write_batch(&output_vector, points, cats, &layers, batch);
+
     // not building topology by default
     Vect_close(&output_vector);
 }
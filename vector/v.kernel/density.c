@@ -0,0 +1,520 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <grass/config.h>
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/gmath.h>
+#include <grass/vector.h>
+#include <grass/glocale.h>
+#include "global.h"
+
+/* rows of the output computed in parallel and written at once */
+#define BAND_ROWS 64
+/* smallest kernel diameter in cells for which the binned density is
+   computed in the frequency domain */
+#define FOURIER_SIZE 15
+
+struct point
+{
+    double x, y;
+    int row, col;		/* cell of the extended region */
+};
+
+/* The points are ordered by the cells of the region extended by the
+ * kernel radius on all sides, the points of a row of cells are found
+ * with the start index of the row. */
+struct grid
+{
+    struct Cell_head window;
+    int rrows, rcols;		/* kernel radius in rows and columns */
+    int rows, cols;		/* size of the extended region */
+    struct point *points;
+    size_t npoints;
+    size_t *row_start;
+    double sigma, term, dmax;
+};
+
+struct band
+{
+    struct grid *g;
+    int row0, nrows;
+    CELL *mask;
+    DCELL *out;
+    double *rowmax;
+    /* binned */
+    double *count;		/* counts of the cells of the band rows
+				   extended by the radius */
+    double *kernel;		/* weights of the offsets kernel_row and
+				   kernel_col within the radius */
+    int *kernel_row, *kernel_col, nkernel;
+};
+
+static int cmp_points(const void *a, const void *b)
+{
+    const struct point *p1 = a, *p2 = b;
+
+    if (p1->row != p2->row)
+	return p1->row < p2->row ? -1 : 1;
+    if (p1->col != p2->col)
+	return p1->col < p2->col ? -1 : 1;
+
+    return 0;
+}
+
+static void read_grid(struct Map_info *In, struct grid *g)
+{
+    struct Cell_head *w = &g->window;
+    struct line_pnts *Points = Vect_new_line_struct();
+    size_t alloc = 0, i;
+    int line, nlines, row;
+
+    g->rrows = (int)ceil(g->dmax / w->ns_res);
+    g->rcols = (int)ceil(g->dmax / w->ew_res);
+    g->rows = w->rows + 2 * g->rrows;
+    g->cols = w->cols + 2 * g->rcols;
+    g->points = NULL;
+    g->npoints = 0;
+
+    nlines = Vect_get_num_lines(In);
+    for (line = 1; line <= nlines; line++) {
+	double frow, fcol;
+
+	if (Vect_get_line_type(In, line) != GV_POINT)
+	    continue;
+	Vect_read_line(In, Points, NULL, line);
+
+	frow = floor((w->north - Points->y[0]) / w->ns_res) + g->rrows;
+	fcol = floor((Points->x[0] - w->west) / w->ew_res) + g->rcols;
+	/* farther than the radius from all cells */
+	if (frow < 0 || frow >= g->rows || fcol < 0 || fcol >= g->cols)
+	    continue;
+
+	if (g->npoints == alloc) {
+	    alloc = alloc ? 2 * alloc : 1024;
+	    g->points = G_realloc(g->points, alloc * sizeof(struct point));
+	}
+	g->points[g->npoints].x = Points->x[0];
+	g->points[g->npoints].y = Points->y[0];
+	g->points[g->npoints].row = (int)frow;
+	g->points[g->npoints].col = (int)fcol;
+	g->npoints++;
+    }
+    Vect_destroy_line_struct(Points);
+
+    qsort(g->points, g->npoints, sizeof(struct point), cmp_points);
+
+    g->row_start = G_calloc(g->rows + 1, sizeof(size_t));
+    for (i = 0; i < g->npoints; i++)
+	g->row_start[g->points[i].row + 1]++;
+    for (row = 0; row < g->rows; row++)
+	g->row_start[row + 1] += g->row_start[row];
+}
+
+/* sum the kernel over the points within the radius of each cell */
+static void exact_rows(int first, int last, void *closure)
+{
+    struct band *b = closure;
+    struct grid *g = b->g;
+    int nb = 2 * g->rrows + 1;
+    size_t *lo = G_malloc(nb * sizeof(size_t));
+    size_t *hi = G_malloc(nb * sizeof(size_t));
+    int row, col, k;
+
+    for (row = first; row < last; row++) {
+	int wrow = b->row0 + row;
+	DCELL *out = b->out + (size_t)row * g->window.cols;
+	CELL *mask = b->mask ? b->mask + (size_t)row * g->window.cols : NULL;
+	double north = Rast_row_to_northing(wrow + 0.5, &g->window);
+	double max = 0;
+
+	/* the rows of cells wrow - rrows to wrow + rrows, the columns
+	 * of the points are searched from the left as the cell moves */
+	for (k = 0; k < nb; k++)
+	    lo[k] = hi[k] = g->row_start[wrow + k];
+
+	for (col = 0; col < g->window.cols; col++) {
+	    double east, sum = 0;
+
+	    /* don't interpolate outside of the mask */
+	    if (mask && Rast_is_c_null_value(&mask[col])) {
+		Rast_set_d_null_value(&out[col], 1);
+		continue;
+	    }
+
+	    east = Rast_col_to_easting(col + 0.5, &g->window);
+
+	    for (k = 0; k < nb; k++) {
+		size_t end = g->row_start[wrow + k + 1], i;
+
+		while (lo[k] < end && g->points[lo[k]].col < col)
+		    lo[k]++;
+		if (hi[k] < lo[k])
+		    hi[k] = lo[k];
+		while (hi[k] < end && g->points[hi[k]].col <= col + 2 * g->rcols)
+		    hi[k]++;
+
+		for (i = lo[k]; i < hi[k]; i++) {
+		    double dx = g->points[i].x - east;
+		    double dy = g->points[i].y - north;
+		    double dist = sqrt(dx * dx + dy * dy);
+
+		    if (dist <= g->dmax)
+			sum += kernelFunction(g->term, g->sigma, dist);
+		}
+	    }
+
+	    out[col] = sum;
+	    if (sum > max)
+		max = sum;
+	}
+	b->rowmax[row] = max;
+    }
+
+    G_free(lo);
+    G_free(hi);
+}
+
+/* count the points of the cells of the rows needed by the band */
+static void count_points(struct band *b)
+{
+    struct grid *g = b->g;
+    int nrows = b->nrows + 2 * g->rrows;
+    size_t i;
+
+    memset(b->count, 0, (size_t)nrows * g->cols * sizeof(double));
+    for (i = g->row_start[b->row0]; i < g->row_start[b->row0 + nrows]; i++)
+	b->count[(size_t)(g->points[i].row - b->row0) * g->cols +
+		 g->points[i].col] += 1;
+}
+
+static void binned_rows(int first, int last, void *closure)
+{
+    struct band *b = closure;
+    struct grid *g = b->g;
+    int row, col, k;
+
+    for (row = first; row < last; row++) {
+	DCELL *out = b->out + (size_t)row * g->window.cols;
+	CELL *mask = b->mask ? b->mask + (size_t)row * g->window.cols : NULL;
+	double max = 0;
+
+	for (col = 0; col < g->window.cols; col++) {
+	    const double *count = b->count + (size_t)row * g->cols + col;
+	    double sum = 0;
+
+	    if (mask && Rast_is_c_null_value(&mask[col])) {
+		Rast_set_d_null_value(&out[col], 1);
+		continue;
+	    }
+
+	    for (k = 0; k < b->nkernel; k++) {
+		double n = count[(size_t)b->kernel_row[k] * g->cols +
+				 b->kernel_col[k]];
+
+		if (n)
+		    sum += n * b->kernel[k];
+	    }
+
+	    out[col] = sum;
+	    if (sum > max)
+		max = sum;
+	}
+	b->rowmax[row] = max;
+    }
+}
+
+#ifdef HAVE_FFTW3_H
+
+/* transforms of sizes with small prime factors are the fastest */
+static int transform_size(int n)
+{
+    for (;; n++) {
+	int m = n;
+
+	while (m % 2 == 0)
+	    m /= 2;
+	while (m % 3 == 0)
+	    m /= 3;
+	while (m % 5 == 0)
+	    m /= 5;
+	while (m % 7 == 0)
+	    m /= 7;
+	if (m == 1)
+	    return n;
+    }
+}
+
+struct fourier
+{
+    int rows;			/* rows of the band with the radius */
+    int dimr, dimc, stride;
+    double (*kernel)[2];
+    double (*data)[2];
+};
+
+static void fourier_init(struct fourier *f, struct band *b, int rows)
+{
+    struct grid *g = b->g;
+    size_t i, n;
+    double norm, *k;
+
+    f->rows = rows;
+    f->dimr = transform_size(rows);
+    f->dimc = transform_size(g->cols);
+    f->stride = 2 * (f->dimc / 2 + 1);
+    n = (size_t)f->dimr * (f->dimc / 2 + 1);
+
+    f->kernel = G_calloc(n, sizeof(*f->kernel));
+    f->data = G_malloc(n * sizeof(*f->data));
+
+    k = (double *)f->kernel;
+    for (i = 0; i < (size_t)b->nkernel; i++)
+	k[(size_t)b->kernel_row[i] * f->stride + b->kernel_col[i]] =
+	    b->kernel[i];
+
+    G_math_fft2_r2c(f->kernel, f->dimc, f->dimr);
+
+    /* undo the normalization of one forward and the inverse transform */
+    norm = sqrt((double)f->dimc * f->dimr);
+    for (i = 0; i < n; i++) {
+	f->kernel[i][0] *= norm;
+	f->kernel[i][1] *= norm;
+    }
+}
+
+static void fourier_free(struct fourier *f)
+{
+    G_free(f->kernel);
+    G_free(f->data);
+}
+
+/* The kernel is symmetric, so the circular convolution of the counts
+ * with the kernel gives the sum for the cell at row r and column c of
+ * the band at row r + 2 * rrows and column c + 2 * rcols. */
+static void fourier_band(struct fourier *f, struct band *b)
+{
+    struct grid *g = b->g;
+    double *data = (double *)f->data;
+    size_t i, n = (size_t)f->dimr * (f->dimc / 2 + 1);
+    int *colcnt = G_calloc(g->cols, sizeof(int));
+    int *colsum = G_malloc((g->cols + 1) * sizeof(int));
+    int row, col, r;
+
+    for (row = 0; row < f->dimr; row++) {
+	double *d = data + (size_t)row * f->stride;
+
+	if (row < f->rows)
+	    memcpy(d, b->count + (size_t)row * g->cols,
+		   g->cols * sizeof(double));
+	else
+	    memset(d, 0, g->cols * sizeof(double));
+	for (col = g->cols; col < f->stride; col++)
+	    d[col] = 0;
+    }
+
+    G_math_fft2_r2c(f->data, f->dimc, f->dimr);
+    for (i = 0; i < n; i++) {
+	double *k = f->kernel[i];
+	double re = f->data[i][0] * k[0] - f->data[i][1] * k[1];
+	double im = f->data[i][0] * k[1] + f->data[i][1] * k[0];
+
+	f->data[i][0] = re;
+	f->data[i][1] = im;
+    }
+    G_math_fft2_c2r(f->data, f->dimc, f->dimr);
+
+    for (row = 0; row < b->nrows; row++) {
+	DCELL *out = b->out + (size_t)row * g->window.cols;
+	CELL *mask = b->mask ? b->mask + (size_t)row * g->window.cols : NULL;
+	const double *sum = data + (size_t)(row + 2 * g->rrows) * f->stride +
+	    2 * g->rcols;
+	double max = 0;
+
+	/* cells without points in the box of the radius are set to 0,
+	 * the transforms leave rounding errors there */
+	if (row == 0) {
+	    for (r = 0; r < 2 * g->rrows; r++)
+		for (col = 0; col < g->cols; col++)
+		    colcnt[col] += b->count[(size_t)r * g->cols + col] > 0;
+	}
+	else
+	    for (col = 0; col < g->cols; col++)
+		colcnt[col] -= b->count[(size_t)(row - 1) * g->cols + col] > 0;
+	r = row + 2 * g->rrows;
+	colsum[0] = 0;
+	for (col = 0; col < g->cols; col++) {
+	    colcnt[col] += b->count[(size_t)r * g->cols + col] > 0;
+	    colsum[col + 1] = colsum[col] + colcnt[col];
+	}
+
+	for (col = 0; col < g->window.cols; col++) {
+	    int npoints = colsum[col + 2 * g->rcols + 1] - colsum[col];
+
+	    if (mask && Rast_is_c_null_value(&mask[col])) {
+		Rast_set_d_null_value(&out[col], 1);
+		continue;
+	    }
+	    out[col] = npoints > 0 && sum[col] > 0 ? sum[col] : 0;
+	    if (out[col] > max)
+		max = out[col];
+	}
+	b->rowmax[row] = max;
+    }
+
+    G_free(colcnt);
+    G_free(colsum);
+}
+
+#endif /* HAVE_FFTW3_H */
+
+/* weights of the offsets of cells within the radius */
+static void binned_kernel(struct band *b)
+{
+    struct grid *g = b->g;
+    int r, c, n = (2 * g->rrows + 1) * (2 * g->rcols + 1);
+
+    b->kernel = G_malloc(n * sizeof(double));
+    b->kernel_row = G_malloc(n * sizeof(int));
+    b->kernel_col = G_malloc(n * sizeof(int));
+    b->nkernel = 0;
+
+    for (r = 0; r <= 2 * g->rrows; r++) {
+	for (c = 0; c <= 2 * g->rcols; c++) {
+	    double dy = (r - g->rrows) * g->window.ns_res;
+	    double dx = (c - g->rcols) * g->window.ew_res;
+	    double dist = sqrt(dx * dx + dy * dy);
+
+	    if (dist > g->dmax)
+		continue;
+	    b->kernel[b->nkernel] = kernelFunction(g->term, g->sigma, dist);
+	    b->kernel_row[b->nkernel] = r;
+	    b->kernel_col[b->nkernel] = c;
+	    b->nkernel++;
+	}
+    }
+}
+
+/*!
+ * \brief Write the density of the points to a raster map
+ *
+ * The kernel is summed over the points within dmax of the cell
+ * centers. With binned, the points are counted by cell first and the
+ * kernel is applied to the counts, as if the points were at the
+ * centers of their cells.
+ *
+ * \return largest density (without multiplier)
+ */
+double density_raster(struct Map_info *In, int fdout, int maskfd,
+		      double sigma, double term, double dmax, double multip,
+		      int binned, int nprocs)
+{
+    struct grid g;
+    struct band b;
+    int row, band_rows, i;
+    double gausmax = 0;
+
+#ifdef HAVE_FFTW3_H
+    struct fourier f;
+    int fourier = 0;
+
+    f.kernel = NULL;
+#endif
+
+    G_get_window(&g.window);
+    g.sigma = sigma;
+    g.term = term;
+    g.dmax = dmax;
+
+    G_message(_("Reading points..."));
+    read_grid(In, &g);
+    G_verbose_message(_("%lu points within the radius of the region"),
+		      (unsigned long)g.npoints);
+
+    b.g = &g;
+    b.count = NULL;
+    b.kernel = NULL;
+    band_rows = BAND_ROWS;
+    if (binned) {
+	binned_kernel(&b);
+#ifdef HAVE_FFTW3_H
+	fourier = 2 * g.rrows + 1 >= FOURIER_SIZE ||
+	    2 * g.rcols + 1 >= FOURIER_SIZE;
+	if (fourier) {
+	    G_math_fft_threads(nprocs);
+	    /* the transforms also cover the radius above and below */
+	    if (band_rows < 2 * g.rrows)
+		band_rows = 2 * g.rrows;
+	}
+#endif
+	b.count = G_malloc((size_t)(band_rows + 2 * g.rrows) * g.cols *
+			   sizeof(double));
+    }
+
+    b.out = G_malloc((size_t)band_rows * g.window.cols * sizeof(DCELL));
+    b.mask = maskfd >= 0 ?
+	G_malloc((size_t)band_rows * g.window.cols * sizeof(CELL)) : NULL;
+    b.rowmax = G_malloc(band_rows * sizeof(double));
+
+    /* the rows of a band are computed in parallel and written in order */
+    for (b.row0 = 0; b.row0 < g.window.rows; b.row0 += band_rows) {
+	b.nrows = g.window.rows - b.row0 < band_rows ?
+	    g.window.rows - b.row0 : band_rows;
+
+	G_percent(b.row0, g.window.rows, 2);
+
+	if (b.mask)
+	    for (row = 0; row < b.nrows; row++)
+		Rast_get_c_row(maskfd, b.mask + (size_t)row * g.window.cols,
+			       b.row0 + row);
+
+	if (!binned)
+	    G_parallel_for(0, b.nrows, 1, exact_rows, &b);
+	else {
+	    count_points(&b);
+#ifdef HAVE_FFTW3_H
+	    if (fourier) {
+		if (!f.kernel || f.rows != b.nrows + 2 * g.rrows) {
+		    if (f.kernel)
+			fourier_free(&f);
+		    fourier_init(&f, &b, b.nrows + 2 * g.rrows);
+		}
+		fourier_band(&f, &b);
+	    }
+	    else
+#endif
+		G_parallel_for(0, b.nrows, 1, binned_rows, &b);
+	}
+
+	for (row = 0; row < b.nrows; row++) {
+	    DCELL *out = b.out + (size_t)row * g.window.cols;
+
+	    if (b.rowmax[row] > gausmax)
+		gausmax = b.rowmax[row];
+	    for (i = 0; i < g.window.cols; i++)
+		if (!Rast_is_d_null_value(&out[i]))
+		    out[i] *= multip;
+	    Rast_put_d_row(fdout, out);
+	}
+    }
+    G_percent(1, 1, 1);
+
+#ifdef HAVE_FFTW3_H
+    if (f.kernel)
+	fourier_free(&f);
+#endif
+    if (binned) {
+	G_free(b.count);
+	G_free(b.kernel);
+	G_free(b.kernel_row);
+	G_free(b.kernel_col);
+    }
+    G_free(b.out);
+    if (b.mask)
+	G_free(b.mask);
+    G_free(b.rowmax);
+    G_free(g.points);
+    G_free(g.row_start);
+
+    return gausmax;
+}
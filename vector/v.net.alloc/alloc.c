@@ -8,164 +8,216 @@
 #include <grass/glocale.h>
 #include "alloc.h"
 
-int alloc_from_centers_loop_tt(struct Map_info *Map, NODE *Nodes,
-                               CENTER *Centers, int ncenters,
-                               int tucfield)
+/* unique category of the point on node, returns 0 if there is none */
+static int node_ucat(struct Map_info *Map, int node, int tucfield,
+		     int *ucat, struct boxlist *List, struct line_cats *Cats)
 {
-    int center, line, nlines, i;
-    int node1;
-    int cat;
+    double x, y, z;
+    struct bound_box box;
+    int i;
+
+    Vect_get_node_coor(Map, node, &x, &y, &z);
+    box.E = box.W = x;
+    box.N = box.S = y;
+    box.T = box.B = z;
+    Vect_select_lines_by_box(Map, &box, GV_POINT, List);
+
+    for (i = 0; i < List->n_values; i++) {
+	if (!(Vect_read_line(Map, NULL, Cats, List->id[i]) & GV_POINT))
+	    continue;
+	if (Vect_cat_get(Cats, tucfield, ucat))
+	    return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Costs from (to) all centers in one pass over the turntable graph:
+ * the search starts from the virtual nodes of all centers at the same
+ * time, each node of the graph keeps the center from (to) which it was
+ * reached first. The costs are those of Vect_net_ttb_shortest_path()
+ * from (to) the center node plus the center node costs.
+ */
+static int alloc_centers_tt(struct Map_info *Map, NODE *Nodes,
+			    CENTER *Centers, int ncenters, int tucfield,
+			    int from_centers)
+{
+    dglGraph_s *graph = Vect_net_get_graph(Map);
+    dglCSR_s csr;
+    dglInt64_t *first, *target, *cost, *dist, *offset, j, k;
+    dglInt32_t *ncost;
+    int *center;
+    char *done, *seed;
+    int i, v, line, nlines, nnodes, ucat, cat;
+    double multip = Map->dgraph.cost_multip, n1cost;
+    dglHeap_s heap;
+    dglHeapData_u heap_data;
+    dglHeapNode_s heap_node;
+    struct boxlist *List;
     struct line_cats *Cats;
-    struct line_pnts *Points;
-    double cost, n1cost, n2cost;
-    int ret;
 
-    Cats = Vect_new_cats_struct();
-    Points = Vect_new_line_struct();
-    
     nlines = Vect_get_num_lines(Map);
-
     for (i = 2; i <= (nlines * 2 + 2); i++) {
 	Nodes[i].center = -1;/* NOTE: first two items of Nodes are not used */
 	Nodes[i].cost = -1;
 	Nodes[i].edge = 0;
     }
 
-    for (center = 0; center < ncenters; center++) {
-	G_percent(center, ncenters, 1);
-	node1 = Centers[center].node;
-	Vect_net_get_node_cost(Map, node1, &n1cost);
-	G_debug(2, "center = %d node = %d cat = %d", center, node1,
-		Centers[center].cat);
+    if (dglCSRExport(graph, &csr) < 0)
+	G_fatal_error(_("Unable to export the network graph: %s"),
+		      dglStrerror(graph));
+    nnodes = csr.cNode;
+
+    /* costs to the centers are searched backwards on the arriving edges */
+    first = csr.pnOffset;
+    target = csr.pnTarget;
+    cost = csr.pnCost;
+    if (!from_centers) {
+	first = G_calloc(nnodes + 2, sizeof(dglInt64_t));
+	target = G_malloc((csr.cEdge + 1) * sizeof(dglInt64_t));
+	cost = G_malloc((csr.cEdge + 1) * sizeof(dglInt64_t));
+	for (k = 0; k < csr.cEdge; k++)
+	    first[csr.pnTarget[k] + 2]++;
+	for (v = 2; v <= nnodes + 1; v++)
+	    first[v] += first[v - 1];
+	for (v = 0; v < nnodes; v++) {
+	    for (k = csr.pnOffset[v]; k < csr.pnOffset[v + 1]; k++) {
+		j = first[csr.pnTarget[k] + 1]++;
+		target[j] = v;
+		cost[j] = csr.pnCost[k];
+	    }
+	}
+    }
 
-	for (line = 1; line <= nlines; line++) {
-	    G_debug(5, "  node1 = %d line = %d", node1, line);
-	    Vect_net_get_node_cost(Map, line, &n2cost);
-	    /* closed, left it as not attached */
+    /* node costs as the shortest path clipper adds them */
+    ncost = G_calloc(nnodes + 1, sizeof(dglInt32_t));
+    if (dglGet_NodeAttrSize(graph) > 0) {
+	for (v = 0; v < nnodes; v++)
+	    memcpy(&ncost[v],
+		   dglNodeGet_Attr(graph, dglGetNode(graph, csr.pnNodeId[v])),
+		   sizeof(dglInt32_t));
+    }
 
-	    if (Vect_read_line(Map, Points, Cats, line) < 0)
-		continue;
-	    if (Vect_get_line_type(Map, line) != GV_LINE)
-		continue;
-	    if (!Vect_cat_get(Cats, tucfield, &cat))
-		continue;
+    dist = G_malloc((nnodes + 1) * sizeof(dglInt64_t));
+    center = G_malloc((nnodes + 1) * sizeof(int));
+    done = G_calloc(nnodes + 1, sizeof(char));
+    seed = G_calloc(nnodes + 1, sizeof(char));
+    offset = G_calloc(ncenters + 1, sizeof(dglInt64_t));
+    for (v = 0; v < nnodes; v++) {
+	dist[v] = -1;
+	center[v] = -1;
+    }
 
-	    for (i = 0; i < 2; i++) {
-		if (i == 1)
-		    cat *= -1;
-
-		ret =
-		    Vect_net_ttb_shortest_path(Map, node1, 0, cat, 1,
-					       tucfield, NULL,
-					       &cost);
-		if (ret == -1) {
-		    continue;
-		}		/* node unreachable */
-
-		/* We must add center node costs (not calculated by Vect_net_shortest_path() ), but
-		 *  only if center and node are not identical, because at the end node cost is add later */
-		if (ret != 1)
-		    cost += n1cost;
-
-		G_debug(5,
-			"Arc nodes: %d %d cost: %f (x old cent: %d old cost %f",
-			node1, line, cost, Nodes[line * 2 + i].center,
-			Nodes[line * 2 + i].cost);
-		if (Nodes[line * 2 + i].center == -1 ||
-		    Nodes[line * 2 + i].cost > cost) {
-		    Nodes[line * 2 + i].cost = cost;
-		    Nodes[line * 2 + i].center = center;
-		}
-	    }
-	}
+    /* start at the virtual nodes of the centers, with the center node
+     * costs so that the nearest center wins as with separate searches */
+    List = Vect_new_boxlist(0);
+    Cats = Vect_new_cats_struct();
+    dglHeapInit(&heap);
+    for (i = 0; i < ncenters; i++) {
+	if (!node_ucat(Map, Centers[i].node, tucfield, &ucat, List, Cats))
+	    G_fatal_error(_("Unable to find point with defined unique category for node <%d>."),
+			  Centers[i].node);
+	v = dglCSRNodeIndex(&csr, from_centers ? ucat * 2 : ucat * 2 + 1);
+	if (v < 0)
+	    continue;
+	Vect_net_get_node_cost(Map, Centers[i].node, &n1cost);
+	offset[i] = n1cost * multip;
+	if (center[v] != -1 && dist[v] <= offset[i])
+	    continue;
+	dist[v] = offset[i];
+	center[v] = i;
+	seed[v] = 1;
+	heap_data.ul = v;
+	dglHeapInsertMin(&heap, offset[i], ' ', heap_data);
     }
-    G_percent(1, 1, 1);
 
-    Vect_destroy_cats_struct(Cats);
-    Vect_destroy_line_struct(Points);
+    while (dglHeapExtractMin(&heap, &heap_node)) {
+	dglInt64_t d;
 
-    return 0;
-}
+	v = heap_node.value.ul;
+	if (done[v] || dist[v] < heap_node.key)
+	    continue;
+	done[v] = 1;
+	d = dist[v];
 
-int alloc_to_centers_loop_tt(struct Map_info *Map, NODE *Nodes,
-                               CENTER *Centers, int ncenters,
-                               int tucfield)
-{
-    int center, line, nlines, i;
-    int node1;
-    int cat;
-    struct line_cats *Cats;
-    struct line_pnts *Points;
-    double cost, n1cost, n2cost;
-    int ret;
+	/* add node costs and do not go through closed nodes, except
+	 * at the start, like the shortest path clipper */
+	if (!seed[v]) {
+	    if (ncost[v] == -1)
+		continue;
+	    d += ncost[v];
+	}
 
-    Cats = Vect_new_cats_struct();
-    Points = Vect_new_line_struct();
-    
-    nlines = Vect_get_num_lines(Map);
+	for (k = first[v]; k < first[v + 1]; k++) {
+	    int to = target[k];
+	    dglInt64_t nd = d + cost[k];
 
-    for (i = 2; i <= (nlines * 2 + 2); i++) {
-	Nodes[i].center = -1;/* NOTE: first two items of Nodes are not used */
-	Nodes[i].cost = -1;
-	Nodes[i].edge = 0;
+	    if (done[to])
+		continue;
+	    if (dist[to] < 0 || dist[to] > nd ||
+		(dist[to] == nd && center[to] > center[v])) {
+		dist[to] = nd;
+		center[to] = center[v];
+		heap_data.ul = to;
+		dglHeapInsertMin(&heap, nd, ' ', heap_data);
+	    }
+	}
     }
+    dglHeapFree(&heap, NULL);
 
+    /* costs of the lines in both directions */
     for (line = 1; line <= nlines; line++) {
-	G_debug(5, "  line = %d", line);
-	Vect_net_get_node_cost(Map, line, &n2cost);
-	/* closed, left it as not attached */
-
-	if (Vect_read_line(Map, Points, Cats, line) < 0)
-	    continue;
 	if (Vect_get_line_type(Map, line) != GV_LINE)
 	    continue;
+	if (Vect_read_line(Map, NULL, Cats, line) < 0)
+	    continue;
 	if (!Vect_cat_get(Cats, tucfield, &cat))
 	    continue;
 
-	for (center = 0; center < ncenters; center++) {
-	    G_percent(center, ncenters, 1);
-	    node1 = Centers[center].node;
-	    Vect_net_get_node_cost(Map, node1, &n1cost);
-	    G_debug(2, "center = %d node = %d cat = %d", center, node1,
-		    Centers[center].cat);
-
-	    for (i = 0; i < 2; i++) {
-		if (i == 1)
-		    cat *= -1;
-
-		ret =
-		    Vect_net_ttb_shortest_path(Map, cat, 1, node1, 0,
-					       tucfield, NULL,
-					       &cost);
-		if (ret == -1) {
-		    continue;
-		}		/* node unreachable */
-
-		/* We must add center node costs (not calculated by Vect_net_shortest_path() ), but
-		 *  only if center and node are not identical, because at the end node cost is add later */
-		if (ret != 1)
-		    cost += n1cost;
-
-		G_debug(5,
-			"Arc nodes: %d %d cost: %f (x old cent: %d old cost %f",
-			node1, line, cost, Nodes[line * 2 + i].center,
-			Nodes[line * 2 + i].cost);
-		if (Nodes[line * 2 + i].center == -1 ||
-		    Nodes[line * 2 + i].cost > cost) {
-		    Nodes[line * 2 + i].cost = cost;
-		    Nodes[line * 2 + i].center = center;
-		}
-	    }
+	for (i = 0; i < 2; i++) {
+	    v = dglCSRNodeIndex(&csr, cat * 2 + i);
+	    if (v < 0 || center[v] < 0)
+		continue;	/* node unreachable */
+	    Vect_net_get_node_cost(Map, Centers[center[v]].node, &n1cost);
+	    Nodes[line * 2 + i].cost =
+		(dist[v] - offset[center[v]]) / multip + n1cost;
+	    Nodes[line * 2 + i].center = center[v];
 	}
     }
-    G_percent(1, 1, 1);
 
+    Vect_destroy_boxlist(List);
     Vect_destroy_cats_struct(Cats);
-    Vect_destroy_line_struct(Points);
+    if (!from_centers) {
+	G_free(first);
+	G_free(target);
+	G_free(cost);
+    }
+    G_free(ncost);
+    G_free(dist);
+    G_free(center);
+    G_free(done);
+    G_free(seed);
+    G_free(offset);
+    dglCSRRelease(&csr);
 
     return 0;
 }
 
+int alloc_from_centers_loop_tt(struct Map_info *Map, NODE *Nodes,
+                               CENTER *Centers, int ncenters,
+                               int tucfield)
+{
+    return alloc_centers_tt(Map, Nodes, Centers, ncenters, tucfield, 1);
+}
+
+int alloc_to_centers_loop_tt(struct Map_info *Map, NODE *Nodes,
+                               CENTER *Centers, int ncenters,
+                               int tucfield)
+{
+    return alloc_centers_tt(Map, Nodes, Centers, ncenters, tucfield, 0);
+}
+
 int alloc_from_centers(dglGraph_s *graph, NODE *Nodes, CENTER *Centers, int ncenters)
 {
     int i, nnodes;
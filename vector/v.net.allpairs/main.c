@@ -29,22 +29,101 @@ struct _spnode {
     int cat, node;
 };
 
+/* search state of one thread */
+struct sp_state {
+    int *dst;
+    dglInt32_t **prev;
+};
+
+/* shortest paths from one node to all selected nodes */
+struct sp_source {
+    double *cost;		/* -1 if unreachable */
+    int *first;			/* first line of each path in lines */
+    struct ilist *lines;
+};
+
+struct sp_block {
+    struct Map_info *Map;
+    struct _spnode *spnode;
+    int nspnodes, nnodes;	/* selected nodes, nodes of the map */
+    int start, last;		/* sources of the block */
+    struct Counter next;
+    struct sp_source *sources;	/* one per source of the block */
+};
+
+struct sp_task {
+    struct sp_block *block;
+    struct sp_state *state;
+};
+
+static void search_source(struct sp_block *block, struct sp_state *st, int i)
+{
+    dglGraph_s *graph = &block->Map->dgraph.graph_s;
+    struct sp_source *src = &block->sources[i - block->start];
+    struct ilist *from;
+    int j, node;
+
+    for (node = 1; node <= block->nnodes; node++) {
+	st->dst[node] = -1;
+	st->prev[node] = NULL;
+    }
+    if (dglGetNode(graph, block->spnode[i].node)) {
+	from = Vect_new_list();
+	Vect_list_append(from, block->spnode[i].node);
+	NetA_distance_from_points(graph, from, st->dst, st->prev);
+	Vect_destroy_list(from);
+    }
+
+    Vect_reset_list(src->lines);
+    for (j = 0; j < block->nspnodes; j++) {
+	src->first[j] = src->lines->n_values;
+	node = block->spnode[j].node;
+	if (i == j || st->dst[node] < 0) {
+	    src->cost[j] = -1;
+	    continue;
+	}
+	src->cost[j] =
+	    (double)st->dst[node] / block->Map->dgraph.cost_multip;
+	while (st->prev[node]) {
+	    Vect_list_append(src->lines,
+			     dglEdgeGet_Id(graph, st->prev[node]));
+	    node = dglNodeGet_Id(graph,
+				 dglEdgeGet_Head(graph, st->prev[node]));
+	}
+    }
+    src->first[j] = src->lines->n_values;
+}
+
+static void search_sources(void *p)
+{
+    struct sp_task *task = p;
+    int i;
+
+    while ((i = G_counter_next(&task->block->next)) < task->block->last)
+	search_source(task->block, task->state, i);
+}
+
 int main(int argc, char *argv[])
 {
     struct Map_info In, Out;
     static struct line_pnts *Points, *aPoints;
     struct line_cats *Cats, **FCats, **BCats;
-    struct ilist *List;
     struct GModule *module;	/* GRASS module for parsing arguments */
     struct Option *map_in, *map_out;
     struct Option *cat_opt, *afield_opt, *nfield_opt, *where_opt, *abcol,
                   *afcol, *ncol;
+    struct Option *nprocs_opt;
     struct Flag *geo_f;
     int afield, nfield;
     int chcat, with_z;
     int mask_type;
     struct varray *varray;
     struct _spnode *spnode;
+    struct sp_block block;
+    struct sp_state *states;
+    struct sp_task *tasks;
+    struct G_task_group *group;
+    int nthreads, block_size;
     int i, j, k, geo, nnodes, line, nlines, cat;
     char buf[2000];
 
@@ -111,9 +190,13 @@ int main(int argc, char *argv[])
     geo_f->description =
 	_("Use geodesic calculation for longitude-latitude locations");
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     /* options and flags parser */
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
+
+    G_set_nprocs(nprocs_opt);
     /* TODO: make an option for this */
     mask_type = GV_LINE | GV_BOUNDARY;
 
@@ -240,56 +323,99 @@ int main(int argc, char *argv[])
 	Vect_copy_table(&In, &Out, nfield, nfield, NULL, GV_MTABLE);
 
     G_message(_("Collecting shortest paths..."));
+
+    /* the shortest paths from a block of nodes are searched on several
+     * threads and then written in the order of the nodes */
+    nthreads = G_num_workers() + 1;
+    block_size = 4 * nthreads;
+    block.Map = &In;
+    block.spnode = spnode;
+    block.nspnodes = nnodes;
+    block.nnodes = Vect_get_num_nodes(&In);
+    block.sources = G_malloc(block_size * sizeof(struct sp_source));
+    for (i = 0; i < block_size; i++) {
+	block.sources[i].cost = G_malloc(nnodes * sizeof(double));
+	block.sources[i].first = G_malloc((nnodes + 1) * sizeof(int));
+	block.sources[i].lines = Vect_new_list();
+    }
+    states = G_malloc(nthreads * sizeof(struct sp_state));
+    tasks = G_malloc(nthreads * sizeof(struct sp_task));
+    for (i = 0; i < nthreads; i++) {
+	states[i].dst = G_malloc((block.nnodes + 1) * sizeof(int));
+	states[i].prev =
+	    G_malloc((block.nnodes + 1) * sizeof(dglInt32_t *));
+	tasks[i].block = &block;
+	tasks[i].state = &states[i];
+    }
+
     G_percent_reset();
     cat = 1;
-    List = Vect_new_list();
-    for (i = 0; i < nnodes; i++) {
-	G_percent(i, nnodes, 1);
-
-	for (j = 0; j < nnodes; j++) {
-	    double cost;
-	    int ret;
-	    
-	    if (i == j)
-		continue;
-	    
-	    ret = Vect_net_shortest_path(&In, spnode[i].node,
-	                                 spnode[j].node, List, &cost);
-	    
-	    if (ret == -1) {
-		/* unreachable */
-		continue;
-	    }
-
-	    sprintf(buf, "insert into %s values (%d, %d, %d, %f)",
-		    Fi->table, cat, spnode[i].cat, spnode[j].cat, cost);
-	    db_set_string(&sql, buf);
-	    G_debug(3, "%s", db_get_string(&sql));
+    for (block.start = 0; block.start < nnodes;
+	 block.start += block_size) {
+	G_percent(block.start, nnodes, 1);
+
+	block.last = block.start + block_size;
+	if (block.last > nnodes)
+	    block.last = nnodes;
+	G_init_counter(&block.next, block.start);
+	group = G_task_group_create();
+	for (k = 0; k < nthreads; k++)
+	    G_task_submit(group, search_sources, &tasks[k]);
+	G_task_group_destroy(group);
+
+	for (i = block.start; i < block.last; i++) {
+	    struct sp_source *src = &block.sources[i - block.start];
+
+	    for (j = 0; j < nnodes; j++) {
+		if (src->cost[j] < 0) {
+		    /* unreachable */
+		    continue;
+		}
 
-	    if (db_execute_immediate(driver, &sql) != DB_OK) {
-		db_close_database_shutdown_driver(driver);
-		G_fatal_error(_("Cannot insert new record: %s"),
-			      db_get_string(&sql));
-	    }
+		sprintf(buf, "insert into %s values (%d, %d, %d, %f)",
+			Fi->table, cat, spnode[i].cat, spnode[j].cat,
+			src->cost[j]);
+		db_set_string(&sql, buf);
+		G_debug(3, "%s", db_get_string(&sql));
 
-	    for (k = 0; k < List->n_values; k++) {
-		line = List->value[k];
-		if (line > 0) {
-		    if (!FCats[line])
-			FCats[line] = Vect_new_cats_struct();
-		    Vect_cat_set(FCats[line], afield, cat);
+		if (db_execute_immediate(driver, &sql) != DB_OK) {
+		    db_close_database_shutdown_driver(driver);
+		    G_fatal_error(_("Cannot insert new record: %s"),
+				  db_get_string(&sql));
 		}
-		else {
-		    if (!BCats[abs(line)])
-			BCats[abs(line)] = Vect_new_cats_struct();
-		    Vect_cat_set(BCats[abs(line)], afield, cat);
+
+		for (k = src->first[j]; k < src->first[j + 1]; k++) {
+		    line = src->lines->value[k];
+		    if (line > 0) {
+			if (!FCats[line])
+			    FCats[line] = Vect_new_cats_struct();
+			Vect_cat_set(FCats[line], afield, cat);
+		    }
+		    else {
+			if (!BCats[abs(line)])
+			    BCats[abs(line)] = Vect_new_cats_struct();
+			Vect_cat_set(BCats[abs(line)], afield, cat);
+		    }
 		}
+		cat++;
 	    }
-	    cat++;
 	}
     }
     G_percent(1, 1, 1);
 
+    for (i = 0; i < nthreads; i++) {
+	G_free(states[i].dst);
+	G_free(states[i].prev);
+    }
+    G_free(states);
+    G_free(tasks);
+    for (i = 0; i < block_size; i++) {
+	G_free(block.sources[i].cost);
+	G_free(block.sources[i].first);
+	Vect_destroy_list(block.sources[i].lines);
+    }
+    G_free(block.sources);
+
     db_commit_transaction(driver);
     db_close_database_shutdown_driver(driver);
 
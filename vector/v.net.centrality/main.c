@@ -79,7 +79,7 @@ int main(int argc, char *argv[])
     struct Option *map_in, *map_out;
     struct Option *cat_opt, *where_opt, *afield_opt, *nfield_opt, *abcol,
                   *afcol, *ncol;
-    struct Option *iter_opt, *error_opt;
+    struct Option *iter_opt, *error_opt, *nprocs_opt;
     struct Flag *geo_f, *add_f;
     int chcat, with_z;
     int afield, nfield, mask_type;
@@ -182,6 +182,8 @@ int main(int argc, char *argv[])
     error_opt->description =
 	_("Cumulative error tolerance for eigenvector centrality");
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     geo_f = G_define_flag();
     geo_f->key = 'g';
     geo_f->description =
@@ -194,6 +196,8 @@ int main(int argc, char *argv[])
     /* options and flags parser */
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
+
+    G_set_nprocs(nprocs_opt);
     /* TODO: make an option for this */
     mask_type = GV_LINE | GV_BOUNDARY;
 
@@ -29,7 +29,7 @@ int main(int argc, char **argv)
     struct Option *input_opt, *output_opt, *afield_opt, *nfield_opt,
 	*tfield_opt, *tucfield_opt, *afcol, *abcol, *ncol, *type_opt;
     struct Option *max_dist, *file_opt;
-    struct Flag *geo_f, *segments_f, *turntable_f;
+    struct Flag *geo_f, *segments_f, *turntable_f, *ch_f;
     struct GModule *module;
     struct Map_info In, Out;
     int type, afield, nfield, tfield, tucfield, geo;
@@ -136,6 +136,12 @@ int main(int argc, char **argv)
     segments_f->description = _("Write output as original input segments, "
 				"not each path as one line.");
 
+    ch_f = G_define_flag();
+    ch_f->key = 'c';
+    ch_f->label = _("Search shortest paths in a contraction hierarchy");
+    ch_f->description =
+	_("The hierarchy is saved with the input map if it is in the current mapset");
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
@@ -177,6 +183,9 @@ int main(int argc, char **argv)
 	Vect_net_build_graph(&In, type, afield, nfield, afcol->answer,
 			     abcol->answer, ncol->answer, geo, 0);
 
+    if (ch_f->answer)
+	Vect_net_ch_build(&In, 1);
+
     path(&In, &Out, file_opt->answer, nfield, maxdist, segments_f->answer,
 	 tucfield, turntable_f->answer);
 
@@ -104,7 +104,7 @@ int main(int argc, char **argv)
     double **cost_cache;	/* pointer to array of pointers to arrays of cached costs */
     struct Option *map, *output, *afield_opt, *nfield_opt, *afcol, *abcol,
 	*seq, *type_opt, *term_opt, *tfield_opt, *tucfield_opt;
-    struct Flag *geo_f, *turntable_f;
+    struct Flag *geo_f, *turntable_f, *ch_f;
     struct GModule *module;
     struct Map_info Map, Out;
     struct ilist *TList;	/* list of terminal nodes */
@@ -207,6 +207,12 @@ int main(int argc, char **argv)
     geo_f->description =
 	_("Use geodesic calculation for longitude-latitude locations");
 
+    ch_f = G_define_flag();
+    ch_f->key = 'c';
+    ch_f->label = _("Search shortest paths in a contraction hierarchy");
+    ch_f->description =
+	_("The hierarchy is saved with the input map if it is in the current mapset");
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
@@ -323,6 +329,9 @@ int main(int argc, char **argv)
 	Vect_net_build_graph(&Map, type, afield, 0, afcol->answer,
 			     abcol->answer, NULL, geo, 0);
 
+    if (ch_f->answer)
+	Vect_net_ch_build(&Map, 1);
+
     /* Create sorted lists of costs */
     /* for a large number of cities this will become very slow, can not be fixed */
     G_message(_("Creating cost cache..."));
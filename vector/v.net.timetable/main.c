@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <grass/gis.h>
 #include <grass/vector.h>
 #include <grass/glocale.h>
@@ -26,6 +27,7 @@
 struct Map_info In, Out;
 neta_timetable_result result;
 neta_timetable timetable;
+neta_connections connections;
 
 struct segment
 {
@@ -239,14 +241,16 @@ int main(int argc, char *argv[])
 		  *afcol, *abcol, *ncol;  /* Input map: cost columns */
 	          	
     struct Option *route_id_opt, *stop_time_opt, *to_stop_opt, *walk_length_opt;
-    int with_z;
+    struct Option *method_opt, *cache_opt;
+    int with_z, csa, have_result;
+    int last_from, last_start, last_change;
     int tfield, mask_type, afield, nfield;
     int from_stop, to_stop, start_time, min_change, max_changes,
 	walking_change, ret;
     int *stop_pnt, i, nlines, point_counter, *route_pnt;
     int line_counter, index, j;
     struct segment *cur;
-    char buf[2000];
+    char buf[2000], signature[2000];
 
     /* Attribute table */
     dbDriver *point_driver, *line_driver;
@@ -333,6 +337,29 @@ int main(int argc, char *argv[])
     walk_length_opt->answer = "length";
     walk_length_opt->description = _("Name of column with walk lengths");
 
+    method_opt = G_define_option();
+    method_opt->key = "method";
+    method_opt->type = TYPE_STRING;
+    method_opt->required = NO;
+    method_opt->options = "dijkstra,csa";
+    method_opt->answer = "dijkstra";
+    method_opt->label = _("Routing method");
+    G_asprintf((char **)&method_opt->descriptions,
+	       "dijkstra;%s;csa;%s",
+	       _("Time-dependent Dijkstra, limits changes of routes"),
+	       _("Connection scan, earliest arrival with any number of changes"));
+
+    cache_opt = G_define_option();
+    cache_opt->key = "cache";
+    cache_opt->type = TYPE_STRING;
+    cache_opt->required = NO;
+    cache_opt->gisprompt = "new,file,file";
+    cache_opt->key_desc = "name";
+    cache_opt->label = _("Name of timetable cache file");
+    cache_opt->description =
+	_("Read the timetable from this file if it was written for the same "
+	  "input, else write it");
+
     /* options and flags parser */
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
@@ -374,11 +401,36 @@ int main(int argc, char *argv[])
     Vect_hist_copy(&In, &Out);
     Vect_hist_command(&Out);
 
-    if (NetA_init_timetable_from_db
-	(&In, tfield, atoi(walk_layer_opt->answer), route_id_opt->answer,
-	 stop_time_opt->answer, to_stop_opt->answer, walk_length_opt->answer,
-	 &timetable, &route_ids, &stop_ids) != 0)
-	G_fatal_error(_("Could not initialize the timetables"));
+    /* the cache is valid for the same map, layers and columns */
+    snprintf(signature, sizeof(signature), "%s %d %s %s %s %s %s",
+	     Vect_get_full_name(&In), tfield, walk_layer_opt->answer,
+	     route_id_opt->answer, stop_time_opt->answer,
+	     to_stop_opt->answer, walk_length_opt->answer);
+
+    if (cache_opt->answer &&
+	NetA_timetable_load(cache_opt->answer, signature, &timetable,
+			    &route_ids, &stop_ids) == 0) {
+	G_verbose_message(_("Timetable read from <%s>"), cache_opt->answer);
+    }
+    else {
+	if (NetA_init_timetable_from_db
+	    (&In, tfield, atoi(walk_layer_opt->answer), route_id_opt->answer,
+	     stop_time_opt->answer, to_stop_opt->answer,
+	     walk_length_opt->answer, &timetable, &route_ids,
+	     &stop_ids) != 0)
+	    G_fatal_error(_("Could not initialize the timetables"));
+	if (cache_opt->answer &&
+	    NetA_timetable_save(&timetable, route_ids, stop_ids, signature,
+				cache_opt->answer) == 0)
+	    G_verbose_message(_("Timetable written to <%s>"),
+			      cache_opt->answer);
+    }
+
+    csa = strcmp(method_opt->answer, "csa") == 0;
+    if (csa)
+	NetA_timetable_connections(&timetable, &connections);
+    have_result = 0;
+    last_from = last_start = last_change = -1;
 
     stop_x = (double *)G_calloc(timetable.stops, sizeof(double));
     stop_y = (double *)G_calloc(timetable.stops, sizeof(double));
@@ -506,17 +558,38 @@ int main(int argc, char *argv[])
 	    continue;
 	}
 
-	ret =
-	    NetA_timetable_shortest_path(&timetable, from_stop, to_stop,
-					 start_time, min_change, max_changes,
-					 walking_change, &result);
+	if (csa) {
+	    /* one scan answers all queries from the same stop and time */
+	    if (!have_result || from_stop != last_from ||
+		start_time != last_start || min_change != last_change) {
+		if (have_result)
+		    NetA_timetable_result_release(&result);
+		NetA_timetable_connection_scan(&timetable, &connections,
+					       from_stop, -1, start_time,
+					       min_change, &result);
+		have_result = 1;
+		last_from = from_stop;
+		last_start = start_time;
+		last_change = min_change;
+	    }
+	    ret = result.dst[0][to_stop];
+	}
+	else
+	    ret =
+		NetA_timetable_shortest_path(&timetable, from_stop, to_stop,
+					     start_time, min_change,
+					     max_changes, walking_change,
+					     &result);
 	if (ret == -1) {
 	    G_warning(_("No path between the stops"));
+	    if (!csa)
+		NetA_timetable_result_release(&result);
 	    continue;
 	}
 	head.next = NULL;
 	init_route(result.routes, to_stop);
-	NetA_timetable_result_release(&result);
+	if (!csa)
+	    NetA_timetable_result_release(&result);
 
 	Vect_reset_line(Points);
 	Vect_reset_line(Cur);
@@ -586,6 +659,11 @@ int main(int argc, char *argv[])
 	}
 	release_route(&head);
     }
+    if (have_result)
+	NetA_timetable_result_release(&result);
+    if (csa)
+	NetA_connections_release(&connections);
+
     db_commit_transaction(line_driver);
     db_commit_transaction(point_driver);
     db_close_database_shutdown_driver(line_driver);
@@ -600,6 +678,7 @@ int main(int argc, char *argv[])
     G_free(stop_y);
     G_free(stop_z);
     G_free(stop_node);
+    NetA_timetable_release(&timetable);
 
     exit(EXIT_SUCCESS);
 }
@@ -78,6 +78,8 @@ void parse_args(int argc, char **argv,
 	_("OGR layer creation option (format specific, NAME=VALUE)");
     options->lco->guisection = _("Creation");
 
+    options->nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flags->update = G_define_flag();
     flags->update->key = 'u';
     flags->update->description = _("Open an existing OGR datasource for update");
@@ -1,29 +1,220 @@
+#include <stdlib.h>
+#include <string.h>
 #include <grass/glocale.h>
 
 #include "local_proto.h"
 
-int mk_att(int cat, struct field_info *Fi, dbDriver *driver, int ncol,
-	   int *colctype, const char **colname, int doatt, int nocat,
-	   OGRFeatureH Ogr_feature, int *noatt)
+/* The attribute table is read with a single query before the export;
+ * mk_att() looks the rows up by category instead of opening a cursor
+ * for each feature. */
+
+struct att_value
 {
-    int j, ogrfieldnum;
-    int more;
+    int isnull;
+    union
+    {
+	int i;
+	double d;
+	size_t s;		/* offset in strings */
+    } v;
+};
+
+struct att_row
+{
+    int cat;
+    int row;
+};
+
+static struct
+{
+    int loaded;
+    int ncol;
+    int nrows, alloc_rows;
+    struct att_value *values;	/* nrows x ncol */
+    struct att_row *index;	/* sorted by category, nindex entries */
+    int nindex;
+    char *strings;
+    size_t nstrings, alloc_strings;
+
+    /* OGR field of each column for the last feature definition */
+    OGRFeatureDefnH defn;
+    int *fieldnum;
+} atts;
+
+static size_t add_string(const char *str)
+{
+    size_t len = strlen(str) + 1, offset = atts.nstrings;
+
+    if (atts.nstrings + len > atts.alloc_strings) {
+	atts.alloc_strings = 2 * atts.alloc_strings + len + 1024;
+	atts.strings = G_realloc(atts.strings, atts.alloc_strings);
+    }
+    memcpy(atts.strings + offset, str, len);
+    atts.nstrings += len;
+
+    return offset;
+}
+
+static int cmp_row(const void *pa, const void *pb)
+{
+    const struct att_row *a = pa, *b = pb;
+
+    if (a->cat != b->cat)
+	return a->cat < b->cat ? -1 : 1;
+    /* keep the first record of a category, as the query by cat did */
+    return (a->row > b->row) - (a->row < b->row);
+}
+
+/*!
+   \brief Read the whole attribute table into memory
+
+   \param Fi field info
+   \param driver open database driver
+   \param ncol number of columns
+   \param colctype C type of each column
+   \param keycol index of the key column
+
+   \return number of records read
+ */
+int load_attributes(struct field_info *Fi, dbDriver *driver, int ncol,
+		    int *colctype, int keycol)
+{
+    int i, j, more;
+    char buf[SQL_BUFFER_SIZE];
+    dbString dbstring;
+    dbCursor cursor;
     dbTable *Table;
-    static int first = 1;
-    static dbString dbstring;
     dbColumn *Column;
     dbValue *Value;
-    char buf[SQL_BUFFER_SIZE];
-    dbCursor cursor;
 
+    db_init_string(&dbstring);
+    sprintf(buf, "SELECT * FROM %s", Fi->table);
+    G_debug(2, "SQL: %s", buf);
+    db_set_string(&dbstring, buf);
+    if (db_open_select_cursor(driver, &dbstring, &cursor, DB_SEQUENTIAL) !=
+	DB_OK)
+	G_fatal_error(_("Unable to open select cursor: '%s'"), buf);
 
-    G_debug(2, "mk_att() cat = %d, doatt = %d", cat, doatt);
+    atts.ncol = ncol;
+    atts.nrows = 0;
+    atts.nindex = 0;
+    atts.nstrings = 0;
+
+    while (1) {
+	struct att_value *row;
 
-    /* init constants */
-    if (first) {
-	db_init_string(&dbstring);
-	first = 0;
+	if (db_fetch(&cursor, DB_NEXT, &more) != DB_OK)
+	    G_fatal_error(_("Unable to fetch data from table"));
+	if (!more)
+	    break;
+
+	if (atts.nrows == atts.alloc_rows) {
+	    atts.alloc_rows = atts.alloc_rows ? 2 * atts.alloc_rows : 1024;
+	    atts.values = G_realloc(atts.values, (size_t)atts.alloc_rows *
+				    ncol * sizeof(struct att_value));
+	    atts.index = G_realloc(atts.index, atts.alloc_rows *
+				   sizeof(struct att_row));
+	}
+	row = atts.values + (size_t)atts.nrows * ncol;
+
+	Table = db_get_cursor_table(&cursor);
+	for (j = 0; j < ncol; j++) {
+	    Column = db_get_table_column(Table, j);
+	    Value = db_get_column_value(Column);
+
+	    row[j].isnull = db_test_value_isnull(Value);
+	    if (row[j].isnull)
+		continue;
+
+	    switch (colctype[j]) {
+	    case DB_C_TYPE_INT:
+		row[j].v.i = db_get_value_int(Value);
+		break;
+	    case DB_C_TYPE_DOUBLE:
+		row[j].v.d = db_get_value_double(Value);
+		break;
+	    case DB_C_TYPE_STRING:
+		row[j].v.s = add_string(db_get_value_string(Value));
+		break;
+	    case DB_C_TYPE_DATETIME:
+		db_convert_column_value_to_string(Column, &dbstring);
+		row[j].v.s = add_string(db_get_string(&dbstring));
+		break;
+	    default:
+		row[j].isnull = 1;
+		break;
+	    }
+	}
+
+	/* records without key are never selected by category */
+	if (!row[keycol].isnull) {
+	    atts.index[atts.nindex].cat = colctype[keycol] == DB_C_TYPE_INT ?
+		row[keycol].v.i : (int)row[keycol].v.d;
+	    atts.index[atts.nindex].row = atts.nrows;
+	    atts.nindex++;
+	}
+	atts.nrows++;
     }
+    db_close_cursor(&cursor);
+    db_free_string(&dbstring);
+
+    qsort(atts.index, atts.nindex, sizeof(struct att_row), cmp_row);
+    for (i = j = 0; i < atts.nindex; i++) {
+	if (j > 0 && atts.index[j - 1].cat == atts.index[i].cat)
+	    continue;
+	atts.index[j++] = atts.index[i];
+    }
+    atts.nindex = j;
+
+    atts.loaded = 1;
+    G_debug(1, "%d records, %d categories read", atts.nrows, atts.nindex);
+
+    return atts.nrows;
+}
+
+/* record of category cat or NULL */
+static struct att_value *find_row(int cat)
+{
+    int lo = 0, hi = atts.nindex - 1;
+
+    while (lo <= hi) {
+	int mid = lo + (hi - lo) / 2;
+
+	if (atts.index[mid].cat == cat)
+	    return atts.values + (size_t)atts.index[mid].row * atts.ncol;
+	if (atts.index[mid].cat < cat)
+	    lo = mid + 1;
+	else
+	    hi = mid - 1;
+    }
+
+    return NULL;
+}
+
+/* OGR field numbers of the columns, looked up once per definition */
+static const int *field_numbers(OGRFeatureH Ogr_feature, int ncol,
+				const char **colname)
+{
+    OGRFeatureDefnH defn = OGR_F_GetDefnRef(Ogr_feature);
+    int j;
+
+    if (defn != atts.defn) {
+	atts.fieldnum = G_realloc(atts.fieldnum, ncol * sizeof(int));
+	for (j = 0; j < ncol; j++)
+	    atts.fieldnum[j] = OGR_FD_GetFieldIndex(defn, colname[j]);
+	atts.defn = defn;
+    }
+
+    return atts.fieldnum;
+}
+
+int mk_att(int cat, struct field_info *Fi, dbDriver *driver, int ncol,
+	   int *colctype, const char **colname, int doatt, int nocat,
+	   OGRFeatureH Ogr_feature, int *noatt)
+{
+    int j, ogrfieldnum;
+
+    G_debug(2, "mk_att() cat = %d, doatt = %d", cat, doatt);
 
     /* Attributes */
     /* Reset */
@@ -38,21 +229,10 @@ int mk_att(int cat, struct field_info *Fi, dbDriver *driver, int ncol,
     /* Read & set attributes */
     if (cat >= 0) {		/* Line with category */
 	if (doatt) {
-	    /* Fetch all attribute records for cat <cat> */ 
-	    /* opening and closing the cursor is slow, 
-	     * but the cursor really needs to be opened for each cat separately */
-	    sprintf(buf, "SELECT * FROM %s WHERE %s = %d", Fi->table, Fi->key, cat);
-	    G_debug(2, "SQL: %s", buf);
-	    db_set_string(&dbstring, buf);
-	    if (db_open_select_cursor (driver, &dbstring, &cursor, DB_SEQUENTIAL) != DB_OK) {
-		    G_fatal_error(_("Cannot select attributes for cat = %d"),
-		  cat);
-	    }
-
-	    if (db_fetch(&cursor, DB_NEXT, &more) != DB_OK)
-		G_fatal_error(_("Unable to fetch data from table"));
+	    /* Fetch the first attribute record for cat <cat> */
+	    struct att_value *row = find_row(cat);
 
-	    if (!more) {
+	    if (!row) {
 		/* G_warning ("No database record for cat = %d", cat); */
 		/* Set at least key column to category */
 		if (!nocat) {
@@ -67,21 +247,14 @@ int mk_att(int cat, struct field_info *Fi, dbDriver *driver, int ncol,
 		}
 	    }
 	    else {
-		Table = db_get_cursor_table(&cursor);
-		for (j = 0; j < ncol; j++) {
-		    Column = db_get_table_column(Table, j);
-		    Value = db_get_column_value(Column);
-		    db_convert_column_value_to_string(Column, &dbstring);	/* for debug only */
-		    G_debug(2, "col %d : val = %s", j,
-			    db_get_string(&dbstring));
-
-		    G_debug(2, "  colctype = %d", colctype[j]);
+		const int *fieldnum = field_numbers(Ogr_feature, ncol, colname);
 
+		for (j = 0; j < ncol; j++) {
+		    /* if this is 'cat', skip it if the '-s' flag was given */
 		    if (nocat && strcmp(Fi->key, colname[j]) == 0)
 			continue;
 
-		    ogrfieldnum = OGR_F_GetFieldIndex(Ogr_feature,
-						      colname[j]);
+		    ogrfieldnum = fieldnum[j];
 		    G_debug(2, "  column = %s -> fieldnum = %d",
 			    colname[j], ogrfieldnum);
 
@@ -91,55 +264,33 @@ int mk_att(int cat, struct field_info *Fi, dbDriver *driver, int ncol,
 			continue;
 		    }
 
-		    /* Reset */
-		    if ((nocat && strcmp(Fi->key, colname[j]) == 0) == 0) {
-			/* if this is 'cat', then execute the following only if the '-s' flag was NOT given*/
+		    /* prevent writing NULL values */
+		    if (row[j].isnull) {
 #if GDAL_VERSION_NUM >= 2020000
 			OGR_F_SetFieldNull(Ogr_feature, ogrfieldnum);
 #else
 			OGR_F_UnsetField(Ogr_feature, ogrfieldnum);
 #endif
+			continue;
 		    }
 
-		    /* prevent writing NULL values */
-		    if (!db_test_value_isnull(Value)) {
-			if ((nocat && strcmp(Fi->key, colname[j]) == 0) == 0) {
-			/* if this is 'cat', then execute the following only if the '-s' flag was NOT given*/
-
-			    switch (colctype[j]) {
-			    case DB_C_TYPE_INT:
-				OGR_F_SetFieldInteger(Ogr_feature,
-						      ogrfieldnum,
-						      db_get_value_int
-						      (Value));
-				break;
-			    case DB_C_TYPE_DOUBLE:
-				OGR_F_SetFieldDouble(Ogr_feature, ogrfieldnum,
-						     db_get_value_double
-						     (Value));
-				break;
-			    case DB_C_TYPE_STRING:
-				OGR_F_SetFieldString(Ogr_feature, ogrfieldnum,
-						     db_get_value_string
-						     (Value));
-				break;
-			    case DB_C_TYPE_DATETIME:
-				db_convert_column_value_to_string(Column,
-								  &dbstring);
-				OGR_F_SetFieldString(Ogr_feature, ogrfieldnum,
-						     db_get_string
-						     (&dbstring));
-				break;
-			    }
-			}
+		    switch (colctype[j]) {
+		    case DB_C_TYPE_INT:
+			OGR_F_SetFieldInteger(Ogr_feature, ogrfieldnum,
+					      row[j].v.i);
+			break;
+		    case DB_C_TYPE_DOUBLE:
+			OGR_F_SetFieldDouble(Ogr_feature, ogrfieldnum,
+					     row[j].v.d);
+			break;
+		    case DB_C_TYPE_STRING:
+		    case DB_C_TYPE_DATETIME:
+			OGR_F_SetFieldString(Ogr_feature, ogrfieldnum,
+					     atts.strings + row[j].v.s);
+			break;
 		    }
-#if GDAL_VERSION_NUM >= 2020000
-		    else
-			OGR_F_SetFieldNull(Ogr_feature, ogrfieldnum);
-#endif
 		}
 	    }
-	    db_close_cursor(&cursor);
 	}
 	else {			/* Use cat only */
 	    ogrfieldnum = OGR_F_GetFieldIndex(Ogr_feature, GV_KEY_COLUMN);
@@ -148,9 +299,5 @@ int mk_att(int cat, struct field_info *Fi, dbDriver *driver, int ncol,
     }
     /* else G_warning ("Line without cat of layer %d", field); */
 
-    /*
-    db_free_string(&dbstring);
-    */
-
     return 1;
 }
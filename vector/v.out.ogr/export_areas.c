@@ -66,18 +66,17 @@ int export_areas_single(struct Map_info *In, int field, int donocat,
                         const char **colname, int doatt, int nocat,
                         int *n_noatt, int *n_nocat, int outer_ring_ccw)
 {
-    int i;
     int cat, area, n_areas;
     int n_exported;
     
-    struct line_pnts *Points;
     struct line_cats *Cats;
+    struct export_batch *batch;
+    struct export_item *item;
 
-    OGRGeometryH Ogr_geometry;
-    OGRFeatureH Ogr_feature;
-
-    Points = Vect_new_line_struct();
-    Cats = Vect_new_cats_struct();
+    batch = batch_create(field, donocat, outer_ring_ccw,
+                         Ogr_featuredefn, Ogr_layer,
+                         Fi, driver, ncol, colctype, colname, doatt, nocat,
+                         n_noatt, n_nocat);
 
     n_exported = 0;
 
@@ -86,6 +85,8 @@ int export_areas_single(struct Map_info *In, int field, int donocat,
         G_percent(area, n_areas, 5);
         
         /* get area's category */
+        item = batch_next(batch);
+        Cats = item_cats(item);
         Vect_get_area_cats(In, area, Cats);
         cat = -1;
         if (Cats->n_cats > 0) {
@@ -98,43 +99,16 @@ int export_areas_single(struct Map_info *In, int field, int donocat,
                        * not labeled */
         }
 
-        /* create polygon from area */
-        Ogr_geometry = create_polygon(In, area, Points, outer_ring_ccw);
+        /* read the rings of the area, the polygon is built by
+         * batch_flush() */
+        read_area_rings(In, area, item);
+        item_set(item, ITEM_AREA, wkbPolygon, Vect_is_3d(In), cat);
 
-        
-        /* output one feature for each category */
-        for (i = -1; i < Cats->n_cats; i++) {
-            if (i == -1) {
-                if (cat >= 0)
-                    continue;	/* cat(s) exists */
-		(*n_nocat)++;
-            }
-            else {
-                if (Cats->field[i] == field)
-                    cat = Cats->cat[i];
-                else
-                    continue;
-            }
-            
-	    /* add feature */
-	    Ogr_feature = OGR_F_Create(Ogr_featuredefn);
-	    OGR_F_SetGeometry(Ogr_feature, Ogr_geometry);
-
-            mk_att(cat, Fi, driver, ncol, colctype, colname, doatt, nocat,
-                   Ogr_feature, n_noatt);
-            if (OGR_L_CreateFeature(Ogr_layer, Ogr_feature) != OGRERR_NONE ) {
-		G_warning(_("Failed to create OGR feature"));
-	    }
-	    else
-		n_exported++;
-
-	    OGR_F_Destroy(Ogr_feature);
-        }
-        OGR_G_DestroyGeometry(Ogr_geometry);
+        n_exported += batch_push(batch);
     }
+    n_exported += batch_flush(batch);
 
-    Vect_destroy_line_struct(Points);
-    Vect_destroy_cats_struct(Cats);
+    batch_destroy(batch);
 
     return n_exported;
 }
@@ -223,11 +197,7 @@ int export_areas_multi(struct Map_info *In, int field, int donocat,
             
             mk_att(cat, Fi, driver, ncol, colctype, colname, doatt, nocat,
                    Ogr_feature, n_noatt);
-            if (OGR_L_CreateFeature(Ogr_layer, Ogr_feature) != OGRERR_NONE ) {
-		G_warning(_("Failed to create OGR feature"));
-	    }
-	    else
-		n_exported++;
+            n_exported += write_feature(Ogr_layer, Ogr_feature);
 
             OGR_F_Destroy(Ogr_feature);
         }
@@ -274,11 +244,7 @@ int export_areas_multi(struct Map_info *In, int field, int donocat,
         
         mk_att(cat, Fi, driver, ncol, colctype, colname, doatt, nocat,
                Ogr_feature, n_noatt);
-	if (OGR_L_CreateFeature(Ogr_layer, Ogr_feature) != OGRERR_NONE ) {
-	    G_warning(_("Failed to create OGR feature"));
-	}
-	else
-	    n_exported++;
+        n_exported += write_feature(Ogr_layer, Ogr_feature);
 
         OGR_F_Destroy(Ogr_feature);
     }
@@ -298,71 +264,34 @@ int export_areas_multi(struct Map_info *In, int field, int donocat,
     return n_exported;
 }
 
+/* read the outer ring and the isles of an area into an export item */
+void read_area_rings(struct Map_info *In, int area, struct export_item *item)
+{
+    int k;
+
+    Vect_get_area_points(In, area, item_add_ring(item));
+    for (k = 0; k < Vect_get_area_num_isles(In, area); k++)
+        Vect_get_isle_points(In, Vect_get_area_isle(In, area, k),
+                             item_add_ring(item));
+}
+
 OGRGeometryH create_polygon(struct Map_info *In, int area,
                             struct line_pnts *Points, int outer_ring_ccw)
 {
-    int j, k;
-    OGRGeometryH Ogr_geometry, ring;
-    
-    Vect_get_area_points(In, area, Points);
+    int k;
+    OGRGeometryH Ogr_geometry;
     
     Ogr_geometry = OGR_G_CreateGeometry(wkbPolygon);
-    ring = OGR_G_CreateGeometry(wkbLinearRing);
     
     /* Area */
-    if (Vect_is_3d(In)) {
-	if (outer_ring_ccw) {
-	    for (j = Points->n_points - 1; j >= 0 ; j--)
-                OGR_G_AddPoint(ring, Points->x[j], Points->y[j],
-                               Points->z[j]);
-	}
-	else {
-	    for (j = 0; j < Points->n_points; j++)
-                OGR_G_AddPoint(ring, Points->x[j], Points->y[j],
-                               Points->z[j]);
-	}
-    }
-    else {
-	if (outer_ring_ccw) {
-	    for (j = Points->n_points - 1; j >= 0 ; j--)
-		OGR_G_AddPoint_2D(ring, Points->x[j], Points->y[j]);
-	}
-	else {
-	    for (j = 0; j < Points->n_points; j++)
-		OGR_G_AddPoint_2D(ring, Points->x[j], Points->y[j]);
-	}
-    }
-
-    OGR_G_AddGeometryDirectly(Ogr_geometry, ring);
+    Vect_get_area_points(In, area, Points);
+    add_ring(Ogr_geometry, Points, Vect_is_3d(In), outer_ring_ccw);
     
     /* Isles */
     for (k = 0; k < Vect_get_area_num_isles(In, area); k++) {
         Vect_get_isle_points(In, Vect_get_area_isle(In, area, k),
                              Points);
-        ring = OGR_G_CreateGeometry(wkbLinearRing);
-	if (Vect_is_3d(In)) {
-	    if (outer_ring_ccw) {
-		for (j = Points->n_points - 1; j >= 0 ; j--)
-		    OGR_G_AddPoint(ring, Points->x[j], Points->y[j],
-				   Points->z[j]);
-	    }
-	    else {
-		for (j = 0; j < Points->n_points; j++)
-		    OGR_G_AddPoint(ring, Points->x[j], Points->y[j],
-				   Points->z[j]);
-	    }
-	}
-	else {
-	    if (outer_ring_ccw) {
-		for (j = Points->n_points - 1; j >= 0 ; j--)
-		    OGR_G_AddPoint_2D(ring, Points->x[j], Points->y[j]);
-	    }
-	    else {
-		for (j = 0; j < Points->n_points; j++)
-		    OGR_G_AddPoint_2D(ring, Points->x[j], Points->y[j]);
-	    }
-	}
-        OGR_G_AddGeometryDirectly(Ogr_geometry, ring);
+        add_ring(Ogr_geometry, Points, Vect_is_3d(In), outer_ring_ccw);
     }
 
     return Ogr_geometry;
@@ -13,8 +13,6 @@ static int export_lines_multi(struct Map_info *, int, int, int, int,
                               const char **, int, int,
                               int *, int *);
 
-static void line_to_polygon(OGRGeometryH, const struct line_pnts *);
-
 static void add_part(OGRGeometryH, OGRwkbGeometryType,
                      int, struct line_pnts *);
 
@@ -48,17 +46,17 @@ int export_lines_single(struct Map_info *In, int field, int otype, int donocat,
                         const char **colname, int doatt, int nocat,
                         int *n_noatt, int *n_nocat)
 {
-    int i, j, n_exported, n_lines;
+    int i, n_exported, n_lines;
     int cat, type;
 
     struct line_pnts *Points;
     struct line_cats *Cats;
+    struct export_batch *batch;
+    struct export_item *item;
 
-    OGRGeometryH Ogr_geometry;
-    OGRFeatureH Ogr_feature;
-
-    Points = Vect_new_line_struct();
-    Cats = Vect_new_cats_struct();
+    batch = batch_create(field, donocat, 0, Ogr_featuredefn, Ogr_layer,
+                         Fi, driver, ncol, colctype, colname, doatt, nocat,
+                         n_noatt, n_nocat);
     
     n_exported = 0;
     n_lines = Vect_get_num_lines(In);
@@ -66,7 +64,10 @@ int export_lines_single(struct Map_info *In, int field, int otype, int donocat,
         
         G_percent(i, n_lines, 5);
         
-        /* read line */
+        /* read line into the next item of the batch */
+        item = batch_next(batch);
+        Points = item_add_ring(item);
+        Cats = item_cats(item);
         type = Vect_read_line(In, Points, Cats, i);
         G_debug(2, "line = %d type = %d", i, type);
         if (!(otype & type)) {
@@ -83,67 +84,22 @@ int export_lines_single(struct Map_info *In, int field, int otype, int donocat,
                        * not labeled */
         }
         
-        /* build simple features geometry */
+        /* the simple features geometry is built by batch_flush() */
         if ((type == GV_LINE && force_poly) || type == GV_FACE) {
             /* lines to polygons 
                faces to 2.5D polygons */
-            Ogr_geometry = OGR_G_CreateGeometry(wkbPolygon);
-            line_to_polygon(Ogr_geometry, Points);
+            item_set(item, ITEM_POLYGON, wkbPolygon, TRUE, cat);
         }
         else {
-            Ogr_geometry = OGR_G_CreateGeometry(get_wkbtype(type, otype));
-            if (OGR_G_GetGeometryType(Ogr_geometry) == wkbPoint) {
-                /* GV_POINTS -> wkbPoint */
-		if (Vect_is_3d(In))
-                    OGR_G_AddPoint(Ogr_geometry, Points->x[0], Points->y[0],
-                                   Points->z[0]);
-		else
-                    OGR_G_AddPoint_2D(Ogr_geometry, Points->x[0], Points->y[0]);
-            }
-            else { /* GV_LINES -> wkbLinestring */
-                for (j = 0; j < Points->n_points; j++) {
-                    if (Vect_is_3d(In))
-                        OGR_G_AddPoint(Ogr_geometry, Points->x[j], Points->y[j],
-                                       Points->z[j]);
-                    else
-                        OGR_G_AddPoint_2D(Ogr_geometry, Points->x[j], Points->y[j]);
-                }
-            }
+            item_set(item, ITEM_LINE, get_wkbtype(type, otype),
+                     Vect_is_3d(In), cat);
         }
 
-        /* output one feature for each category, export also features
-         * without category (cat = -1) */
-        for (j = -1; j < Cats->n_cats; j++) {
-            if (j == -1) {
-                if (cat >= 0)
-                    continue;	/* cat(s) exists */
-		(*n_nocat)++;
-            }
-            else {
-                if (Cats->field[j] == field)
-                    cat = Cats->cat[j];
-                else
-                    continue;
-            }
-            
-	    /* add feature */
-	    Ogr_feature = OGR_F_Create(Ogr_featuredefn);
-	    OGR_F_SetGeometry(Ogr_feature, Ogr_geometry);
-            mk_att(cat, Fi, driver, ncol, colctype, colname, doatt, nocat,
-                   Ogr_feature, n_noatt);
-            if (OGR_L_CreateFeature(Ogr_layer, Ogr_feature) != OGRERR_NONE ) {
-		G_warning(_("Failed to create OGR feature"));
-	    }
-	    else
-		n_exported++;
-
-	    OGR_F_Destroy(Ogr_feature);
-        }
-        OGR_G_DestroyGeometry(Ogr_geometry);
+        n_exported += batch_push(batch);
     }
+    n_exported += batch_flush(batch);
 
-    Vect_destroy_line_struct(Points);
-    Vect_destroy_cats_struct(Cats);
+    batch_destroy(batch);
     
     return n_exported;
 }
@@ -227,11 +183,7 @@ int export_lines_multi(struct Map_info *In, int field, int otype, int donocat, i
             
             mk_att(cat, Fi, driver, ncol, colctype, colname, doatt, nocat,
                    Ogr_feature, n_noatt);
-            if (OGR_L_CreateFeature(Ogr_layer, Ogr_feature) != OGRERR_NONE ) {
-		G_warning(_("Failed to create OGR feature"));
-	    }
-	    else
-		n_exported++;
+            n_exported += write_feature(Ogr_layer, Ogr_feature);
 
             OGR_F_Destroy(Ogr_feature);
         }
@@ -276,11 +228,7 @@ int export_lines_multi(struct Map_info *In, int field, int otype, int donocat, i
         
         mk_att(cat, Fi, driver, ncol, colctype, colname, doatt, nocat,
                Ogr_feature, n_noatt);
-	if (OGR_L_CreateFeature(Ogr_layer, Ogr_feature) != OGRERR_NONE ) {
-	    G_warning(_("Failed to create OGR feature"));
-	}
-	else
-	    n_exported++;
+        n_exported += write_feature(Ogr_layer, Ogr_feature);
 
         OGR_F_Destroy(Ogr_feature);
     }
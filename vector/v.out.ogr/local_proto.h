@@ -27,10 +27,16 @@ typedef OGRSFDriverH dr_t;
 /* some hard limits */
 #define SQL_BUFFER_SIZE 2000
 
+/* geometries of export items, see write.c */
+#define ITEM_POINT   0
+#define ITEM_LINE    1
+#define ITEM_POLYGON 2
+#define ITEM_AREA    3
+
 
 struct Options {
     struct Option *input, *dsn, *layer, *type, *format,
-	*field, *dsco, *lco, *otype;
+	*field, *dsco, *lco, *otype, *nprocs;
 };
 
 struct Flags {
@@ -38,11 +44,15 @@ struct Flags {
                 *force2d, *multi, *list;
 };
 
+struct export_batch;
+struct export_item;
+
 /* args.c */
 void parse_args(int, char **,
 		struct Options*, struct Flags *);
 
-/* attributes.c */
+/* attrb.c */
+int load_attributes(struct field_info *, dbDriver *, int, int *, int);
 int mk_att(int, struct field_info *, dbDriver *,
 	   int, int *, const char **, int, int,
 	   OGRFeatureH, int *);
@@ -62,6 +72,7 @@ OGRwkbGeometryType get_multi_wkbtype(OGRwkbGeometryType);
 OGRwkbGeometryType get_wkbtype(int, int);
 
 /* export_lines.c */
+void line_to_polygon(OGRGeometryH, const struct line_pnts *);
 int export_lines(struct Map_info *, int, int, int, int, int,
                  OGRFeatureDefnH, OGRLayerH,
                  struct field_info *, dbDriver *, int, int *, 
@@ -69,8 +80,25 @@ int export_lines(struct Map_info *, int, int, int, int, int,
                  int *, int *);
 
 /* export_areas.c */
+void read_area_rings(struct Map_info *, int, struct export_item *);
 int export_areas(struct Map_info *, int, int, int, 
                  OGRFeatureDefnH, OGRLayerH,
                  struct field_info *, dbDriver *, int, int *, 
                  const char **, int, int,
                  int *, int *, int);
+
+/* write.c */
+void begin_transaction(ds_t, OGRLayerH);
+void end_transaction(void);
+int write_feature(OGRLayerH, OGRFeatureH);
+struct export_batch *batch_create(int, int, int, OGRFeatureDefnH, OGRLayerH,
+				  struct field_info *, dbDriver *, int, int *,
+				  const char **, int, int, int *, int *);
+struct export_item *batch_next(struct export_batch *);
+struct line_pnts *item_add_ring(struct export_item *);
+struct line_cats *item_cats(struct export_item *);
+void item_set(struct export_item *, int, OGRwkbGeometryType, int, int);
+void add_ring(OGRGeometryH, const struct line_pnts *, int, int);
+int batch_push(struct export_batch *);
+int batch_flush(struct export_batch *);
+void batch_destroy(struct export_batch *);
@@ -93,6 +93,7 @@ int main(int argc, char *argv[])
     
     /* parse & read options */
     parse_args(argc, argv, &options, &flags);
+    G_set_nprocs(options.nprocs);
 
     if (flags.list->answer) {
 	list_formats();
@@ -763,6 +764,10 @@ int main(int argc, char *argv[])
 	    }
 	    if (keycol == -1)
 		G_fatal_error(_("Key column <%s> not found"), Fi->key);
+
+	    /* one query for the whole table instead of one per category */
+	    G_message(_("Reading attributes..."));
+	    load_attributes(Fi, Driver, ncol, colctype, keycol);
 	}
     }
     
@@ -770,8 +775,7 @@ int main(int argc, char *argv[])
 
     n_feat = n_nocat = n_noatt = 0;
 
-    if (OGR_L_TestCapability(Ogr_layer, OLCTransactions))
-	OGR_L_StartTransaction(Ogr_layer);
+    begin_transaction(hDS, Ogr_layer);
 
     /* export polygons oriented according to OGC simple features standard 1.2.1
      * outer rings are oriented counter-clockwise (CCW)
@@ -831,8 +835,7 @@ int main(int argc, char *argv[])
 	G_warning(_("Export of volumes not implemented yet. Skipping."));
     }
 
-    if (OGR_L_TestCapability(Ogr_layer, OLCTransactions))
-	OGR_L_CommitTransaction(Ogr_layer);
+    end_transaction();
 
     ds_close(hDS);
 
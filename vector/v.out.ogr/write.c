@@ -0,0 +1,340 @@
+#include <grass/glocale.h>
+
+#include "local_proto.h"
+
+/* Features are exported in batches: the geometries of a batch are read
+ * from the input map by the main thread, converted to OGR geometries
+ * by the worker threads and written in input order by the main thread
+ * together with their attributes. Features are written in transactions
+ * of TRANSACTION_SIZE features, on the datasource if the driver
+ * supports it, else on the layer. */
+
+#define BATCH_SIZE 4096
+#define TRANSACTION_SIZE 100000
+
+struct export_item
+{
+    int kind;
+    OGRwkbGeometryType wkbtype;
+    int is3d;
+    int nrings;			/* rings in use */
+    int alloc_rings;
+    struct line_pnts **rings;
+    struct line_cats *Cats;
+    int cat;			/* category in the layer or -1 */
+    OGRGeometryH geometry;
+};
+
+struct export_batch
+{
+    int n;
+    struct export_item items[BATCH_SIZE];
+
+    int field, donocat, outer_ring_ccw;
+
+    OGRFeatureDefnH Ogr_featuredefn;
+    OGRLayerH Ogr_layer;
+    struct field_info *Fi;
+    dbDriver *driver;
+    int ncol;
+    int *colctype;
+    const char **colname;
+    int doatt, nocat;
+    int *n_noatt, *n_nocat;
+};
+
+/* open transaction */
+static struct
+{
+    ds_t hDS;
+    OGRLayerH Ogr_layer;
+    int on_dataset, on_layer;
+    int count;
+} trans;
+
+/* start writing features to Ogr_layer of hDS */
+void begin_transaction(ds_t hDS, OGRLayerH Ogr_layer)
+{
+    trans.hDS = hDS;
+    trans.Ogr_layer = Ogr_layer;
+    trans.on_dataset = trans.on_layer = 0;
+    trans.count = 0;
+
+#if GDAL_VERSION_NUM >= 2020000
+    if (GDALDatasetTestCapability(hDS, ODsCTransactions) &&
+	GDALDatasetStartTransaction(hDS, FALSE) == OGRERR_NONE) {
+	trans.on_dataset = 1;
+	G_debug(1, "Using datasource transactions");
+	return;
+    }
+#endif
+    if (OGR_L_TestCapability(Ogr_layer, OLCTransactions) &&
+	OGR_L_StartTransaction(Ogr_layer) == OGRERR_NONE) {
+	trans.on_layer = 1;
+	G_debug(1, "Using layer transactions");
+    }
+}
+
+/* commit the open transaction */
+void end_transaction(void)
+{
+#if GDAL_VERSION_NUM >= 2020000
+    if (trans.on_dataset &&
+	GDALDatasetCommitTransaction(trans.hDS) != OGRERR_NONE)
+	G_fatal_error(_("Unable to commit transaction"));
+#endif
+    if (trans.on_layer &&
+	OGR_L_CommitTransaction(trans.Ogr_layer) != OGRERR_NONE)
+	G_fatal_error(_("Unable to commit transaction"));
+    trans.on_dataset = trans.on_layer = 0;
+}
+
+/* write a feature, return 1 if it was written */
+int write_feature(OGRLayerH Ogr_layer, OGRFeatureH Ogr_feature)
+{
+    if (OGR_L_CreateFeature(Ogr_layer, Ogr_feature) != OGRERR_NONE) {
+	G_warning(_("Failed to create OGR feature"));
+	return 0;
+    }
+
+    if ((trans.on_dataset || trans.on_layer) &&
+	++trans.count == TRANSACTION_SIZE) {
+	/* keep transactions of a bounded size */
+	G_debug(2, "Committing %d features", trans.count);
+	end_transaction();
+	begin_transaction(trans.hDS, trans.Ogr_layer);
+    }
+
+    return 1;
+}
+
+/* a new batch of features written with mk_att() attributes */
+struct export_batch *batch_create(int field, int donocat, int outer_ring_ccw,
+				  OGRFeatureDefnH Ogr_featuredefn,
+				  OGRLayerH Ogr_layer,
+				  struct field_info *Fi, dbDriver *driver,
+				  int ncol, int *colctype, const char **colname,
+				  int doatt, int nocat,
+				  int *n_noatt, int *n_nocat)
+{
+    struct export_batch *b = G_calloc(1, sizeof(struct export_batch));
+
+    b->field = field;
+    b->donocat = donocat;
+    b->outer_ring_ccw = outer_ring_ccw;
+    b->Ogr_featuredefn = Ogr_featuredefn;
+    b->Ogr_layer = Ogr_layer;
+    b->Fi = Fi;
+    b->driver = driver;
+    b->ncol = ncol;
+    b->colctype = colctype;
+    b->colname = colname;
+    b->doatt = doatt;
+    b->nocat = nocat;
+    b->n_noatt = n_noatt;
+    b->n_nocat = n_nocat;
+
+    return b;
+}
+
+/* the item to be filled next, without rings */
+struct export_item *batch_next(struct export_batch *b)
+{
+    struct export_item *item = &b->items[b->n];
+
+    if (!item->Cats)
+	item->Cats = Vect_new_cats_struct();
+    item->nrings = 0;
+    item->cat = -1;
+    item->geometry = NULL;
+
+    return item;
+}
+
+/* the next ring of an item */
+struct line_pnts *item_add_ring(struct export_item *item)
+{
+    if (item->nrings == item->alloc_rings) {
+	int i;
+
+	item->rings = G_realloc(item->rings, (item->alloc_rings + 4) *
+				sizeof(struct line_pnts *));
+	for (i = 0; i < 4; i++)
+	    item->rings[item->alloc_rings + i] = Vect_new_line_struct();
+	item->alloc_rings += 4;
+    }
+
+    return item->rings[item->nrings++];
+}
+
+struct line_cats *item_cats(struct export_item *item)
+{
+    return item->Cats;
+}
+
+/* set what kind of geometry the item is converted to
+ * ITEM_POINT, ITEM_LINE: wkbtype from get_wkbtype(), first ring
+ * ITEM_POLYGON: closed line or face as polygon, first ring
+ * ITEM_AREA: area, the first ring is the outer ring, the others isles */
+void item_set(struct export_item *item, int kind, OGRwkbGeometryType wkbtype,
+	      int is3d, int cat)
+{
+    item->kind = kind;
+    item->wkbtype = wkbtype;
+    item->is3d = is3d;
+    item->cat = cat;
+}
+
+static void add_points(OGRGeometryH geom, const struct line_pnts *Points,
+		       int is3d, int reverse)
+{
+    int j;
+
+    if (reverse) {
+	for (j = Points->n_points - 1; j >= 0; j--) {
+	    if (is3d)
+		OGR_G_AddPoint(geom, Points->x[j], Points->y[j],
+			       Points->z[j]);
+	    else
+		OGR_G_AddPoint_2D(geom, Points->x[j], Points->y[j]);
+	}
+    }
+    else {
+	for (j = 0; j < Points->n_points; j++) {
+	    if (is3d)
+		OGR_G_AddPoint(geom, Points->x[j], Points->y[j],
+			       Points->z[j]);
+	    else
+		OGR_G_AddPoint_2D(geom, Points->x[j], Points->y[j]);
+	}
+    }
+}
+
+/* add a ring of an area to a polygon, reversed if the outer ring
+ * must be counter-clockwise */
+void add_ring(OGRGeometryH Ogr_geometry, const struct line_pnts *Points,
+	      int is3d, int outer_ring_ccw)
+{
+    OGRGeometryH ring = OGR_G_CreateGeometry(wkbLinearRing);
+
+    add_points(ring, Points, is3d, outer_ring_ccw);
+    OGR_G_AddGeometryDirectly(Ogr_geometry, ring);
+}
+
+static OGRGeometryH item_geometry(struct export_batch *b,
+				  struct export_item *item)
+{
+    OGRGeometryH Ogr_geometry;
+    struct line_pnts *Points = item->rings[0];
+    int i;
+
+    switch (item->kind) {
+    case ITEM_AREA:
+	Ogr_geometry = OGR_G_CreateGeometry(wkbPolygon);
+	for (i = 0; i < item->nrings; i++)
+	    add_ring(Ogr_geometry, item->rings[i], item->is3d,
+		     b->outer_ring_ccw);
+	return Ogr_geometry;
+    case ITEM_POLYGON:
+	Ogr_geometry = OGR_G_CreateGeometry(wkbPolygon);
+	line_to_polygon(Ogr_geometry, Points);
+	return Ogr_geometry;
+    default:
+	Ogr_geometry = OGR_G_CreateGeometry(item->wkbtype);
+	if (OGR_G_GetGeometryType(Ogr_geometry) == wkbPoint) {
+	    /* GV_POINTS -> wkbPoint */
+	    if (item->is3d)
+		OGR_G_AddPoint(Ogr_geometry, Points->x[0], Points->y[0],
+			       Points->z[0]);
+	    else
+		OGR_G_AddPoint_2D(Ogr_geometry, Points->x[0], Points->y[0]);
+	}
+	else			/* GV_LINES -> wkbLinestring */
+	    add_points(Ogr_geometry, Points, item->is3d, 0);
+	return Ogr_geometry;
+    }
+}
+
+static void convert_items(int first, int last, void *closure)
+{
+    struct export_batch *b = closure;
+    int i;
+
+    for (i = first; i < last; i++)
+	b->items[i].geometry = item_geometry(b, &b->items[i]);
+}
+
+/* write the features of the batch, return the number of features written */
+int batch_flush(struct export_batch *b)
+{
+    int i, j, cat, n_exported;
+    OGRFeatureH Ogr_feature;
+
+    if (b->n == 0)
+	return 0;
+
+    G_parallel_for(0, b->n, 64, convert_items, b);
+
+    n_exported = 0;
+    for (i = 0; i < b->n; i++) {
+	struct export_item *item = &b->items[i];
+	struct line_cats *Cats = item->Cats;
+
+	/* output one feature for each category, export also features
+	 * without category (cat = -1) */
+	cat = item->cat;
+	for (j = -1; j < Cats->n_cats; j++) {
+	    if (j == -1) {
+		if (cat >= 0)
+		    continue;	/* cat(s) exists */
+		(*b->n_nocat)++;
+	    }
+	    else {
+		if (Cats->field[j] == b->field)
+		    cat = Cats->cat[j];
+		else
+		    continue;
+	    }
+
+	    /* add feature */
+	    Ogr_feature = OGR_F_Create(b->Ogr_featuredefn);
+	    OGR_F_SetGeometry(Ogr_feature, item->geometry);
+	    mk_att(cat, b->Fi, b->driver, b->ncol, b->colctype, b->colname,
+		   b->doatt, b->nocat, Ogr_feature, b->n_noatt);
+	    n_exported += write_feature(b->Ogr_layer, Ogr_feature);
+	    OGR_F_Destroy(Ogr_feature);
+	}
+	OGR_G_DestroyGeometry(item->geometry);
+	item->geometry = NULL;
+    }
+    b->n = 0;
+
+    return n_exported;
+}
+
+/* add the filled item to the batch,
+ * return the number of features written when the batch was full */
+int batch_push(struct export_batch *b)
+{
+    if (++b->n < BATCH_SIZE)
+	return 0;
+
+    return batch_flush(b);
+}
+
+void batch_destroy(struct export_batch *b)
+{
+    int i, j;
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+	struct export_item *item = &b->items[i];
+
+	for (j = 0; j < item->alloc_rings; j++)
+	    Vect_destroy_line_struct(item->rings[j]);
+	if (item->rings)
+	    G_free(item->rings);
+	if (item->Cats)
+	    Vect_destroy_cats_struct(item->Cats);
+    }
+    G_free(b);
+}
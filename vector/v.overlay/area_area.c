@@ -24,6 +24,115 @@ static int cmp_int(const void *a, const void *b)
     return (*(int *)a > *(int *)b);
 }
 
+/* The areas of an input map are read in blocks on the main thread, the
+ * new centroids in their boxes are tested on several threads and the
+ * categories are set in the order of the areas, as if tested one by one */
+#define BLOCK_AREAS 256
+
+struct qarea
+{
+    struct line_pnts *APoints, **IPoints;
+    int nisles, nisles_alloc;
+    struct line_cats *Cats;
+    int first, n;		/* candidate centroids of the area */
+};
+
+struct qblock
+{
+    const CENTR *Centr;
+    struct qarea areas[BLOCK_AREAS];
+    int nareas;
+    int *centr, *owner;		/* candidate centroids and their areas */
+    char *inside;
+    int ncentr, centr_alloc;
+};
+
+static void read_qarea(struct Map_info *In, int area, int centroid,
+		       struct qarea *qa)
+{
+    int isle, nisles;
+
+    Vect_read_line(In, NULL, qa->Cats, centroid);
+    Vect_get_area_points(In, area, qa->APoints);
+    nisles = Vect_get_area_num_isles(In, area);
+    if (nisles > qa->nisles_alloc) {
+	qa->IPoints = G_realloc(qa->IPoints,
+				(nisles + 10) * sizeof(struct line_pnts *));
+	for (isle = qa->nisles_alloc; isle < nisles + 10; isle++)
+	    qa->IPoints[isle] = Vect_new_line_struct();
+	qa->nisles_alloc = nisles + 10;
+    }
+    for (isle = 0; isle < nisles; isle++) {
+	int isle_id = Vect_get_area_isle(In, area, isle);
+
+	Vect_get_isle_points(In, isle_id, qa->IPoints[isle]);
+    }
+    qa->nisles = nisles;
+}
+
+static void test_centroids(int first, int last, void *closure)
+{
+    struct qblock *qb = closure;
+    int i, isle;
+
+    for (i = first; i < last; i++) {
+	const struct qarea *qa = &qb->areas[qb->owner[i]];
+	const CENTR *c = &qb->Centr[qb->centr[i]];
+	int centr_in_area;
+
+	centr_in_area = Vect_point_in_poly(c->x, c->y, qa->APoints);
+	if (centr_in_area == 1) {
+	    for (isle = 0; isle < qa->nisles; isle++) {
+		if (Vect_point_in_poly(c->x, c->y, qa->IPoints[isle]) > 0) {
+		    centr_in_area = 0;
+		    break;
+		}
+	    }
+	}
+	qb->inside[i] = centr_in_area > 0;
+    }
+}
+
+/* test the candidate centroids of a block and set their categories */
+static void flush_qblock(struct qblock *qb, CENTR *Centr, int input,
+			 int *field, ATTRIBUTES *attr)
+{
+    int a, i, j;
+
+    G_parallel_for(0, qb->ncentr, 0, test_centroids, qb);
+
+    for (a = 0; a < qb->nareas; a++) {
+	const struct qarea *qa = &qb->areas[a];
+	const struct line_cats *Cats = qa->Cats;
+
+	for (j = qa->first; j < qa->first + qa->n; j++) {
+	    int ocentr = qb->centr[j];
+
+	    if (!qb->inside[j])
+		continue;
+
+	    /* Add all cats with original field number */
+	    for (i = 0; i < Cats->n_cats; i++) {
+		if (Cats->field[i] == field[input]) {
+		    ATTR *at;
+
+		    Vect_cat_set(Centr[ocentr].cat[input], field[input],
+				 Cats->cat[i]);
+
+		    /* Mark as used */
+		    at = find_attr(&(attr[input]), Cats->cat[i]);
+		    if (!at)
+			G_fatal_error(_("Attribute not found"));
+
+		    at->used = 1;
+		}
+	    }
+	}
+    }
+
+    qb->nareas = qb->ncentr = 0;
+}
+
 int area_area(struct Map_info *In, int *field, struct Map_info *Tmp,
 	      struct Map_info *Out, struct field_info *Fi,
 	      dbDriver * driver, int operator, int *ofield,
@@ -41,8 +150,8 @@ int area_area(struct Map_info *In, int *field, struct Map_info *Tmp,
     struct bound_box box;
     struct spatial_index si;
     int ocentr, ncentr;
-    int isle, nisles_alloc;
-    struct line_pnts *APoints, **IPoints;
+    int i;
+    struct qblock qb;
     struct ilist *List;
 
     verbose = G_verbose();
@@ -202,11 +311,12 @@ int area_area(struct Map_info *In, int *field, struct Map_info *Tmp,
 	Centr[ocentr].cat[1] = Vect_new_cats_struct();
     }
 
-    nisles_alloc = 10;
-    IPoints = G_malloc(nisles_alloc * sizeof(struct line_pnts *));
-    for (isle = 0; isle < nisles_alloc; isle++)
-	IPoints[isle] = Vect_new_line_struct();
-    APoints = Vect_new_line_struct();
+    G_zero(&qb, sizeof(struct qblock));
+    qb.Centr = Centr;
+    for (i = 0; i < BLOCK_AREAS; i++) {
+	qb.areas[i].APoints = Vect_new_line_struct();
+	qb.areas[i].Cats = Vect_new_cats_struct();
+    }
 
     List = Vect_new_list();
 
@@ -223,70 +333,48 @@ int area_area(struct Map_info *In, int *field, struct Map_info *Tmp,
 
 	    in_centr = Vect_get_area_centroid(&(In[input]), area);
 	    if (in_centr > 0) {
-		int i, j;
-		int nisles;
-		
-
-		Vect_read_line(&(In[input]), NULL, Cats, in_centr);
-		Vect_get_area_points(&(In[input]), area, APoints);
-		nisles = Vect_get_area_num_isles(&(In[input]), area);
-		if (nisles > nisles_alloc) {
-		    IPoints = G_realloc(IPoints, (nisles + 10) * sizeof(struct line_pnts *));
-		    for (isle = nisles_alloc; isle < nisles + 10; isle++)
-			IPoints[isle] = Vect_new_line_struct();
-		    nisles_alloc = nisles + 10;
-		}
-		for (isle = 0; isle < nisles; isle++) {
-		    int isle_id = Vect_get_area_isle(&(In[input]), area, isle);
+		struct qarea *qa = &qb.areas[qb.nareas++];
+		int j;
 
-		    Vect_get_isle_points(&(In[input]), isle_id, IPoints[isle]);
-		}
+		read_qarea(&(In[input]), area, in_centr, qa);
 
-		Vect_line_box(APoints, &box);
+		Vect_line_box(qa->APoints, &box);
 		/* centroid's z is set to zero */
 		box.T = box.B = 0;
 
 		Vect_spatial_index_select(&si, &box, List);
+		if (qb.ncentr + List->n_values > qb.centr_alloc) {
+		    qb.centr_alloc = qb.ncentr + List->n_values + 1024;
+		    qb.centr = G_realloc(qb.centr, qb.centr_alloc * sizeof(int));
+		    qb.owner = G_realloc(qb.owner, qb.centr_alloc * sizeof(int));
+		    qb.inside = G_realloc(qb.inside, qb.centr_alloc);
+		}
+		qa->first = qb.ncentr;
+		qa->n = List->n_values;
 		for (j = 0; j < List->n_values; j++) {
-		    int centr_in_area;
-
-		    ocentr = List->value[j];
-		    centr_in_area = Vect_point_in_poly(Centr[ocentr].x,
-						       Centr[ocentr].y,
-						       APoints);
-		    if (centr_in_area == 1) {
-			for (isle = 0; isle < nisles; isle++) {
-			    if (Vect_point_in_poly(Centr[ocentr].x,
-						   Centr[ocentr].y,
-						   IPoints[isle]) > 0) {
-				centr_in_area = 0;
-				break;
-			    }
-			}
-		    }
-
-		    if (centr_in_area > 0) {
-			/* Add all cats with original field number */
-			for (i = 0; i < Cats->n_cats; i++) {
-			    if (Cats->field[i] == field[input]) {
-				ATTR *at;
-
-				Vect_cat_set(Centr[ocentr].cat[input], field[input],
-					     Cats->cat[i]);
-
-				/* Mark as used */
-				at = find_attr(&(attr[input]), Cats->cat[i]);
-				if (!at)
-				    G_fatal_error(_("Attribute not found"));
-
-				at->used = 1;
-			    }
-			}
-		    }
+		    qb.centr[qb.ncentr] = List->value[j];
+		    qb.owner[qb.ncentr] = qb.nareas - 1;
+		    qb.ncentr++;
 		}
+
+		if (qb.nareas == BLOCK_AREAS)
+		    flush_qblock(&qb, Centr, input, field, attr);
 	    }
 	}
+	flush_qblock(&qb, Centr, input, field, attr);
+    }
+    for (i = 0; i < BLOCK_AREAS; i++) {
+	int isle;
+
+	Vect_destroy_line_struct(qb.areas[i].APoints);
+	for (isle = 0; isle < qb.areas[i].nisles_alloc; isle++)
+	    Vect_destroy_line_struct(qb.areas[i].IPoints[isle]);
+	G_free(qb.areas[i].IPoints);
+	Vect_destroy_cats_struct(qb.areas[i].Cats);
     }
+    G_free(qb.centr);
+    G_free(qb.owner);
+    G_free(qb.inside);
     Vect_spatial_index_destroy(&si);
     nareas = Vect_get_num_areas(Tmp);
 
@@ -40,7 +40,7 @@ int main(int argc, char *argv[])
     double snap_thresh;
     struct GModule *module;
     struct Option *in_opt[2], *out_opt, *type_opt[2], *field_opt[2],
-	*ofield_opt, *operator_opt, *snap_opt;
+	*ofield_opt, *operator_opt, *snap_opt, *nprocs_opt;
     struct Flag *table_flag;
     struct Map_info In[2], Out, Tmp;
     struct line_pnts *Points, *Points2;
@@ -141,6 +141,8 @@ int main(int argc, char *argv[])
     snap_opt->type = TYPE_DOUBLE;
     snap_opt->answer = "1e-8";
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     table_flag = G_define_standard_flag(G_FLG_V_TABLE);
     table_flag->guisection = _("Attributes");
     
@@ -211,6 +213,8 @@ int main(int argc, char *argv[])
 
     snap_thresh = atof(snap_opt->answer);
 
+    G_set_nprocs(nprocs_opt);
+
     Points = Vect_new_line_struct();
     Points2 = Vect_new_line_struct();
     Cats = Vect_new_cats_struct();
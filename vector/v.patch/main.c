@@ -66,6 +66,7 @@ int main(int argc, char *argv[])
     int out_is_3d = WITHOUT_Z;
     char colnames[4096];
     double snap = -1;
+    int batch = FALSE, nboundaries = 0, topo_updated = FALSE;
 
     G_gisinit(argv[0]);
 
@@ -317,6 +318,12 @@ int main(int argc, char *argv[])
 	    G_warning(_("The output map is not 3D"));
 	}
 	maxcat = max_cat(&OutMap, 1);
+
+	/* update the topology of the output while appending */
+	if (!no_topo->answer && Vect_begin_topo_batch(&OutMap)) {
+	    batch = TRUE;
+	    nboundaries = Vect_get_num_primitives(&OutMap, GV_BOUNDARY);
+	}
     }
     else {
 	if (Vect_open_new(&OutMap, out_name, out_is_3d) < 0)
@@ -456,7 +463,16 @@ int main(int argc, char *argv[])
     Vect_set_map_name(&OutMap, "Output from v.patch");
     Vect_set_person(&OutMap, G_whoami());
 
-    if (!no_topo->answer) {
+    /* boundaries are cleaned below, other features were added to the
+       topology while appending */
+    if (batch && Vect_end_topo_batch(&OutMap)) {
+	if (Vect_get_num_primitives(&OutMap, GV_BOUNDARY) == nboundaries) {
+	    G_verbose_message(_("Topology updated while appending"));
+	    topo_updated = TRUE;
+	}
+    }
+
+    if (!no_topo->answer && !topo_updated) {
 	if (append->answer)
 	    Vect_build_partial(&OutMap, GV_BUILD_NONE);
 
@@ -94,6 +94,8 @@ void parse_options(struct GParm *parm, struct GFlag *flag)
     parm->relate->description = _("Intersection Matrix Pattern used for 'relate' operator");
 #endif
 
+    parm->nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag->table = G_define_standard_flag(G_FLG_V_TABLE);
     
     flag->cat = G_define_flag();
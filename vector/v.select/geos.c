@@ -7,117 +7,178 @@
 
 #ifdef HAVE_GEOS
 
-static int relate_geos(struct Map_info *, const GEOSGeometry *,
-		       int, int, const char *, int);
+/* GEOS contexts are used by one thread each, without messages: worker
+ * threads do not print */
+void geos_test_init(struct geos_test *gt)
+{
+    gt->handle = initGEOS_r(NULL, NULL);
+    gt->b = NULL;
+    gt->bgeom = NULL;
+    gt->bprep = NULL;
+}
+
+static void free_b(struct geos_test *gt)
+{
+    if (gt->bprep)
+	GEOSPreparedGeom_destroy_r(gt->handle, gt->bprep);
+    if (gt->bgeom)
+	GEOSGeom_destroy_r(gt->handle, gt->bgeom);
+    gt->b = NULL;
+    gt->bgeom = NULL;
+    gt->bprep = NULL;
+}
+
+void geos_test_free(struct geos_test *gt)
+{
+    free_b(gt);
+    finishGEOS_r(gt->handle);
+}
 
-int line_relate_geos(struct Map_info *AIn, const GEOSGeometry *BGeom,
-		     int aline, int operator, const char *relate)
+static GEOSCoordSequence *points_to_geos(GEOSContextHandle_t handle,
+					 const struct line_pnts *Points,
+					 int with_z)
 {
-    return relate_geos(AIn, BGeom, aline, operator, relate, 0);
+    GEOSCoordSequence *pseq;
+    int i;
+
+    pseq = GEOSCoordSeq_create_r(handle, Points->n_points, with_z ? 3 : 2);
+    for (i = 0; i < Points->n_points; i++) {
+	GEOSCoordSeq_setX_r(handle, pseq, i, Points->x[i]);
+	GEOSCoordSeq_setY_r(handle, pseq, i, Points->y[i]);
+	if (with_z)
+	    GEOSCoordSeq_setZ_r(handle, pseq, i, Points->z[i]);
+    }
+
+    return pseq;
 }
 
-int area_relate_geos(struct Map_info *AIn, const GEOSGeometry *BGeom,
-		     int aarea, int operator, const char *relate)
+/* geometry of a feature as from Vect_read_line_geos() and
+ * Vect_read_area_geos() */
+static GEOSGeometry *feature_to_geos(GEOSContextHandle_t handle,
+				     const struct feature *f)
 {
-    return relate_geos(AIn, BGeom, aarea, operator, relate, 1);
+    GEOSGeometry *geom, *shell, **holes;
+    GEOSCoordSequence *pseq, *rseq;
+    int i, nholes;
+
+    if (f->type == GV_AREA) {
+	shell = GEOSGeom_createLinearRing_r(handle,
+					    points_to_geos(handle, f->Points,
+							   f->with_z));
+	if (!shell)
+	    return NULL;
+
+	holes = G_malloc(f->nisles * sizeof(GEOSGeometry *));
+	nholes = 0;
+	for (i = 0; i < f->nisles; i++) {
+	    holes[nholes] =
+		GEOSGeom_createLinearRing_r(handle,
+					    points_to_geos(handle,
+							   f->Isles[i],
+							   f->with_z));
+	    if (holes[nholes])
+		nholes++;
+	}
+
+	geom = GEOSGeom_createPolygon_r(handle, shell, holes, nholes);
+	G_free(holes);
+
+	return geom;
+    }
+
+    if (f->Points->n_points == 0)
+	return NULL;
+
+    pseq = points_to_geos(handle, f->Points, f->with_z);
+
+    if (f->type & GV_POINTS)
+	return GEOSGeom_createPoint_r(handle, pseq);
+    if (f->type & GV_LINE)
+	return GEOSGeom_createLineString_r(handle, pseq);
+
+    /* boundary */
+    rseq = GEOSCoordSeq_clone_r(handle, pseq);
+    geom = GEOSGeom_createLineString_r(handle, pseq);
+    if (geom && GEOSisRing_r(handle, geom) == 1) {
+	GEOSGeom_destroy_r(handle, geom);
+	return GEOSGeom_createLinearRing_r(handle, rseq);
+    }
+    GEOSCoordSeq_destroy_r(handle, rseq);
+
+    return geom;
 }
 
-int relate_geos(struct Map_info *AIn, const GEOSGeometry *BGeom,
-		int afid, int operator, const char *relate, int area)
+/*
+ * Returns 1 if 'a operator b' is true, 0 otherwise
+ *
+ * The geometry of b is kept for the next call with the same feature of
+ * B and prepared for the predicates which have a prepared version.
+ */
+int relate_geos(struct geos_test *gt, const struct feature *a,
+		const struct feature *b, int operator, const char *relate)
 {
-    GEOSGeometry *AGeom = NULL;
+    GEOSContextHandle_t handle = gt->handle;
+    GEOSGeometry *AGeom;
     int found;
 
-    found = 0;
-    if (area)
-	AGeom = Vect_read_area_geos(AIn, afid);
-    else
-	AGeom = Vect_read_line_geos(AIn, afid, NULL);
+    if (gt->b != b) {
+	free_b(gt);
+	gt->b = b;
+	gt->bgeom = feature_to_geos(handle, b);
+	if (gt->bgeom && operator != OP_EQUALS && operator != OP_CROSSES &&
+	    operator != OP_RELATE)
+	    gt->bprep = GEOSPrepare_r(handle, gt->bgeom);
+    }
+    if (!gt->bgeom)
+	return 0;
 
+    AGeom = feature_to_geos(handle, a);
     if (!AGeom)
 	return 0;
 
-    /* 
-       if (!BGeom) {
-       if (area)
-       G_fatal_error(_("Unable to read area id %d from vector map <%s>"),
-       bfid, Vect_get_full_name(BIn));
-       else
-       G_fatal_error(_("Unable to read line id %d from vector map <%s>"),
-       bfid, Vect_get_full_name(BIn));
-       }
-     */
+    /* a prepared predicate of B, e.g. A within B is B contains A */
+    found = 0;
     switch (operator) {
-    case OP_EQUALS:{
-	    if (GEOSEquals(AGeom, BGeom)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
-    case OP_DISJOINT:{
-	    if (GEOSDisjoint(AGeom, BGeom)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
-    case OP_INTERSECTS:{
-	    if (GEOSIntersects(AGeom, BGeom)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
-    case OP_TOUCHES:{
-	    if (GEOSTouches(AGeom, BGeom)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
-    case OP_CROSSES:{
-	    if (GEOSCrosses(AGeom, BGeom)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
-    case OP_WITHIN:{
-	    if (GEOSWithin(AGeom, BGeom)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
-    case OP_CONTAINS:{
-	    if (GEOSContains(AGeom, BGeom)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
-    case OP_OVERLAPS:{
-	    if (GEOSOverlaps(AGeom, BGeom)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
-    case OP_RELATE:{
-	    if (GEOSRelatePattern(AGeom, BGeom, relate)) {
-		found = 1;
-		break;
-	    }
-	    break;
-	}
+    case OP_EQUALS:
+	found = GEOSEquals_r(handle, AGeom, gt->bgeom);
+	break;
+    case OP_DISJOINT:
+	found = gt->bprep ? GEOSPreparedDisjoint_r(handle, gt->bprep, AGeom)
+	    : GEOSDisjoint_r(handle, AGeom, gt->bgeom);
+	break;
+    case OP_INTERSECTS:
+	found = gt->bprep ? GEOSPreparedIntersects_r(handle, gt->bprep, AGeom)
+	    : GEOSIntersects_r(handle, AGeom, gt->bgeom);
+	break;
+    case OP_TOUCHES:
+	found = gt->bprep ? GEOSPreparedTouches_r(handle, gt->bprep, AGeom)
+	    : GEOSTouches_r(handle, AGeom, gt->bgeom);
+	break;
+    case OP_CROSSES:
+	found = GEOSCrosses_r(handle, AGeom, gt->bgeom);
+	break;
+    case OP_WITHIN:
+	found = gt->bprep ? GEOSPreparedContains_r(handle, gt->bprep, AGeom)
+	    : GEOSWithin_r(handle, AGeom, gt->bgeom);
+	break;
+    case OP_CONTAINS:
+	found = gt->bprep ? GEOSPreparedWithin_r(handle, gt->bprep, AGeom)
+	    : GEOSContains_r(handle, AGeom, gt->bgeom);
+	break;
+    case OP_OVERLAPS:
+	found = gt->bprep ? GEOSPreparedOverlaps_r(handle, gt->bprep, AGeom)
+	    : GEOSOverlaps_r(handle, AGeom, gt->bgeom);
+	break;
+    case OP_RELATE:
+	found = GEOSRelatePattern_r(handle, AGeom, gt->bgeom, relate);
+	break;
     default:
 	break;
     }
 
-    if (AGeom)
-	GEOSGeom_destroy(AGeom);
+    GEOSGeom_destroy_r(handle, AGeom);
 
-    return found;
+    /* an exception (2) counts as true as before */
+    return found != 0;
 }
 #endif /* HAVE_GEOS */
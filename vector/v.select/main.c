@@ -97,6 +97,9 @@ int main(int argc, char *argv[])
 	operator = OP_OVERLAP;
     }
 #endif    
+
+    G_set_nprocs(parm.nprocs);
+
     for (iopt = 0; iopt < 2; iopt++) {
 	itype[iopt] = Vect_option_to_types(parm.type[iopt]);
 
@@ -138,10 +141,6 @@ int main(int argc, char *argv[])
                  ALines, AAreas, nskipped);
 #endif
     
-#ifdef HAVE_GEOS
-    finishGEOS();
-#endif
-
     if (!flag.reverse->answer) {
 	G_free(AAreas);
 	AAreas = NULL;
@@ -86,3 +86,55 @@ int line_overlap_area(struct line_pnts *LPoints, struct line_pnts *OPoints,
     }
     return 0;
 }
+
+/* point in area with isles as Vect_point_in_area() */
+static int point_in_area(double x, double y, const struct feature *area)
+{
+    int i, poly;
+
+    poly = Vect_point_in_poly(x, y, area->Points);
+    if (poly == 0 || poly == 2)
+	return poly;
+
+    for (i = 0; i < area->nisles; i++)
+	if (Vect_point_in_poly(x, y, area->Isles[i]) >= 1)
+	    return 0;
+
+    return 1;
+}
+
+/* Returns 1 if feature a from map A overlaps feature b from map B,
+ *         0 otherwise
+ * Uses only the geometries of the features, safe to call from several
+ * threads */
+int feature_overlap(struct feature *a, struct feature *b)
+{
+    int i;
+
+    if (b->type != GV_AREA) {
+	if (a->type != GV_AREA)
+	    return Vect_line_check_intersection2(b->Points, a->Points, 0) != 0;
+
+	return line_overlap_area(b->Points, a->Points, a->Isles, a->nisles);
+    }
+
+    if (a->type != GV_AREA)
+	return line_overlap_area(a->Points, b->Points, b->Isles, b->nisles);
+
+    /* A inside B ? */
+    if (line_overlap_area(a->Centroid, b->Points, b->Isles, b->nisles))
+	return 1;
+
+    /* B inside A ? */
+    if (point_in_area(b->Centroid->x[0], b->Centroid->y[0], a))
+	return 1;
+
+    /* A overlaps B ? */
+    if (line_overlap_area(a->Points, b->Points, b->Isles, b->nisles))
+	return 1;
+    for (i = 0; i < a->nisles; i++)
+	if (line_overlap_area(a->Isles[i], b->Points, b->Isles, b->nisles))
+	    return 1;
+
+    return 0;
+}
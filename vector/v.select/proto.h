@@ -14,12 +14,33 @@
 
 struct GParm {
     struct Option *input[2], *output, *type[2], *field[2],
-	*operator, *relate;
+	*operator, *relate, *nprocs;
 };
 struct GFlag {
     struct Flag *table, *reverse, *cat;
 };
 
+/* geometry of a feature read for the tests */
+struct feature {
+    int id;			/* line or area id */
+    int type;			/* feature type, GV_AREA for areas */
+    int with_z;
+    struct line_pnts *Points;	/* line or outer ring of area */
+    struct line_pnts *Centroid;	/* centroid of area */
+    struct line_pnts **Isles;	/* inner rings of area */
+    int nisles, isles_alloc;
+};
+
+#ifdef HAVE_GEOS
+/* GEOS context of a thread and the geometry of the last feature of B */
+struct geos_test {
+    GEOSContextHandle_t handle;
+    const struct feature *b;
+    GEOSGeometry *bgeom;
+    const GEOSPreparedGeometry *bprep;
+};
+#endif
+
 /* args.c */
 void parse_options(struct GParm *, struct GFlag *);
 
@@ -29,10 +50,10 @@ void copy_tabs(struct Map_info *, struct Map_info *,
 
 #ifdef HAVE_GEOS
 /* geos.c */
-int line_relate_geos(struct Map_info *, const GEOSGeometry *,
-		     int, int, const char *);
-int area_relate_geos(struct Map_info *, const GEOSGeometry *,
-		     int, int, const char *);
+void geos_test_init(struct geos_test *);
+void geos_test_free(struct geos_test *);
+int relate_geos(struct geos_test *, const struct feature *,
+		const struct feature *, int, const char *);
 #endif
 
 /* select.c */
@@ -44,6 +65,7 @@ int select_lines(struct Map_info *, int, int,
 void add_aarea(struct Map_info *, int, int *, int *);
 int line_overlap_area(struct line_pnts *, struct line_pnts *,
                       struct line_pnts **, int);
+int feature_overlap(struct feature *, struct feature *);
 
 /* write.c */
 void write_lines(struct Map_info *, struct field_info *, int *, int *,
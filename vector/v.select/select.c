@@ -6,47 +6,298 @@
 
 #include "proto.h"
 
+/* The features of B and their candidates in A (from the spatial index)
+ * are read for a block of features of B on the main thread. The pairs
+ * of the block are then tested on several threads and the results are
+ * applied in the order of the pairs, as if tested one by one: the
+ * selection does not depend on the number of threads. */
+#define BLOCK_FEATURES 256
+#define BLOCK_PAIRS 65536
+
+struct pair
+{
+    int a, b;			/* features in the block */
+    int found;
+};
+
+struct block
+{
+    struct Map_info *aIn, *bIn;
+    int operator;
+    const char *relate;
+    struct feature *a, *b;
+    int na, nb, a_alloc, b_alloc;
+    struct pair *pairs;
+    int npairs, pairs_alloc;
+    int *aline_index, *aarea_index;	/* index + 1 of features of A in the block */
+    int bid, barea;		/* last feature of B */
+};
+
+static struct feature *new_feature(struct feature **features, int *n,
+				   int *alloc)
+{
+    struct feature *f;
+
+    if (*n == *alloc) {
+	int i;
+
+	*alloc += 64;
+	*features = G_realloc(*features, *alloc * sizeof(struct feature));
+	for (i = *n; i < *alloc; i++) {
+	    f = &(*features)[i];
+	    f->Points = Vect_new_line_struct();
+	    f->Centroid = Vect_new_line_struct();
+	    f->Isles = NULL;
+	    f->nisles = f->isles_alloc = 0;
+	}
+    }
+
+    f = &(*features)[(*n)++];
+    f->nisles = 0;
+
+    return f;
+}
+
+static void free_features(struct feature *features, int alloc)
+{
+    int i, j;
+
+    for (i = 0; i < alloc; i++) {
+	Vect_destroy_line_struct(features[i].Points);
+	Vect_destroy_line_struct(features[i].Centroid);
+	for (j = 0; j < features[i].isles_alloc; j++)
+	    Vect_destroy_line_struct(features[i].Isles[j]);
+	G_free(features[i].Isles);
+    }
+    G_free(features);
+}
+
+static void read_line(struct Map_info *Map, int line, struct feature *f)
+{
+    f->id = line;
+    f->with_z = Vect_is_3d(Map);
+    f->type = Vect_read_line(Map, f->Points, NULL, line);
+}
+
+static void read_area(struct Map_info *Map, int area, struct feature *f)
+{
+    int i, isle, nisles;
+
+    f->id = area;
+    f->with_z = Vect_is_3d(Map);
+    f->type = GV_AREA;
+    Vect_get_area_points(Map, area, f->Points);
+    Vect_read_line(Map, f->Centroid, NULL, Vect_get_area_centroid(Map, area));
+
+    nisles = Vect_get_area_num_isles(Map, area);
+    if (nisles > f->isles_alloc) {
+	f->Isles = G_realloc(f->Isles, nisles * sizeof(struct line_pnts *));
+	for (i = f->isles_alloc; i < nisles; i++)
+	    f->Isles[i] = Vect_new_line_struct();
+	f->isles_alloc = nisles;
+    }
+    for (i = 0; i < nisles; i++) {
+	isle = Vect_get_area_isle(Map, area, i);
+	if (isle < 1)
+	    continue;
+	Vect_get_isle_points(Map, isle, f->Isles[f->nisles++]);
+    }
+}
+
+/* add the test of a feature of A with the current feature of B */
+static void add_pair(struct block *blk, int bid, int barea, int aid,
+		     int aarea)
+{
+    int *index = aarea ? &blk->aarea_index[aid] : &blk->aline_index[aid];
+    struct pair *p;
+
+    if (blk->nb == 0 || blk->bid != bid || blk->barea != barea) {
+	struct feature *f = new_feature(&blk->b, &blk->nb, &blk->b_alloc);
+
+	if (barea)
+	    read_area(blk->bIn, bid, f);
+	else
+	    read_line(blk->bIn, bid, f);
+	blk->bid = bid;
+	blk->barea = barea;
+    }
+
+    if (*index == 0) {
+	struct feature *f = new_feature(&blk->a, &blk->na, &blk->a_alloc);
+
+	if (aarea)
+	    read_area(blk->aIn, aid, f);
+	else
+	    read_line(blk->aIn, aid, f);
+	*index = blk->na;
+    }
+
+    if (blk->npairs == blk->pairs_alloc) {
+	blk->pairs_alloc += 1024;
+	blk->pairs = G_realloc(blk->pairs,
+			       blk->pairs_alloc * sizeof(struct pair));
+    }
+    p = &blk->pairs[blk->npairs++];
+    p->a = *index - 1;
+    p->b = blk->nb - 1;
+    p->found = 0;
+}
+
+static void test_pairs(int first, int last, void *closure)
+{
+    struct block *blk = closure;
+    int i;
+
+#ifdef HAVE_GEOS
+    struct geos_test gt;
+
+    if (blk->operator != OP_OVERLAP)
+	geos_test_init(&gt);
+#endif
+
+    for (i = first; i < last; i++) {
+	struct pair *p = &blk->pairs[i];
+	struct feature *a = &blk->a[p->a];
+	struct feature *b = &blk->b[p->b];
+
+	if (blk->operator == OP_OVERLAP)
+	    p->found = feature_overlap(a, b);
+#ifdef HAVE_GEOS
+	else
+	    p->found = relate_geos(&gt, a, b, blk->operator, blk->relate);
+#endif
+    }
+
+#ifdef HAVE_GEOS
+    if (blk->operator != OP_OVERLAP)
+	geos_test_free(&gt);
+#endif
+}
+
+/* test the pairs of a block, returns the number of features found */
+static int flush_block(struct block *blk, int *ALines, int *AAreas)
+{
+    int i, nfound = 0;
+
+    G_parallel_for(0, blk->npairs, 0, test_pairs, blk);
+
+    for (i = 0; i < blk->npairs; i++) {
+	const struct pair *p = &blk->pairs[i];
+	const struct feature *a = &blk->a[p->a];
+
+	if (!p->found)
+	    continue;
+
+	if (a->type == GV_AREA) {
+	    if (AAreas[a->id] != 1) {
+		add_aarea(blk->aIn, a->id, ALines, AAreas);
+		nfound += 1;
+	    }
+	}
+	else if (ALines[a->id] != 1) {
+	    ALines[a->id] = 1;
+	    nfound += 1;
+	}
+    }
+
+    for (i = 0; i < blk->na; i++) {
+	if (blk->a[i].type == GV_AREA)
+	    blk->aarea_index[blk->a[i].id] = 0;
+	else
+	    blk->aline_index[blk->a[i].id] = 0;
+    }
+    blk->na = blk->nb = blk->npairs = 0;
+
+    return nfound;
+}
+
+/* candidates in A of a feature of B with box bbox */
+static void add_candidates(struct block *blk, int bid, int barea,
+			   const struct bound_box *bbox, int atype,
+			   int afield, int cat_flag, int *ALines, int *AAreas,
+			   struct boxlist *List, int *nskipped)
+{
+    struct Map_info *aIn = blk->aIn;
+    int ai, ltype;
+
+    /* x Lines in A */
+    if (atype & (GV_POINTS | GV_LINES)) {
+	Vect_select_lines_by_box(aIn, bbox, atype, List);
+	for (ai = 0; ai < List->n_values; ai++) {
+	    int aline = List->id[ai];
+
+	    G_debug(3, "  aline = %d", aline);
+
+	    if (ALines[aline] == 1)
+		continue;
+
+	    /* Check type */
+	    ltype = Vect_get_line_type(aIn, aline);
+	    if (!(ltype & atype))
+		continue;
+
+	    /* Check category */
+	    if (!cat_flag && Vect_get_line_cat(aIn, aline, afield) < 0) {
+		nskipped[0]++;
+		continue;
+	    }
+
+	    add_pair(blk, bid, barea, aline, 0);
+	}
+    }
+
+    /* x Areas in A */
+    if (atype & GV_AREA) {
+	Vect_select_areas_by_box(aIn, bbox, List);
+	for (ai = 0; ai < List->n_values; ai++) {
+	    int aarea = List->id[ai];
+
+	    G_debug(3, "  aarea = %d", aarea);
+
+	    if (AAreas[aarea] == 1)
+		continue;
+
+	    if (Vect_get_area_centroid(aIn, aarea) < 1)
+		continue;
+
+	    if (!cat_flag && Vect_get_area_cat(aIn, aarea, afield) < 0) {
+		nskipped[0]++;
+		continue;
+	    }
+
+	    add_pair(blk, bid, barea, aarea, 1);
+	}
+    }
+}
+
 int select_lines(struct Map_info *aIn, int atype, int afield,
                  struct Map_info *bIn, int btype, int bfield,
                  int cat_flag, int operator, const char *relate,
                  int *ALines, int *AAreas, int* nskipped)
 {
-    int i, ai;
     int nblines, bline, ltype;
     int nfound = 0;
-    
-    struct line_pnts *APoints, *BPoints;
-    struct line_pnts *OPoints, **IPoints;
-    int isle, nisles, isles_alloc;
-    struct ilist *BoundList;
     struct boxlist *List;
-
-#ifdef HAVE_GEOS
-    initGEOS(G_message, G_fatal_error);
-    GEOSGeometry *BGeom = NULL;
-#else
-    void *BGeom = NULL;
-#endif
+    struct block blk;
 
     nskipped[0] = nskipped[1] = 0;
-    APoints = Vect_new_line_struct();
-    BPoints = Vect_new_line_struct();
-    OPoints = Vect_new_line_struct();
-    isles_alloc = 10;
-    IPoints = G_malloc(isles_alloc * sizeof(struct line_pnts *));
-    for (i = 0; i < isles_alloc; i++)
-	IPoints[i] = Vect_new_line_struct();
-    nisles = 0;
-    
+
+    G_zero(&blk, sizeof(struct block));
+    blk.aIn = aIn;
+    blk.bIn = bIn;
+    blk.operator = operator;
+    blk.relate = relate;
+    blk.aline_index = G_calloc(Vect_get_num_lines(aIn) + 1, sizeof(int));
+    blk.aarea_index = G_calloc(Vect_get_num_areas(aIn) + 1, sizeof(int));
+
     List = Vect_new_boxlist(1);
-    BoundList = Vect_new_list();
 
     nblines = Vect_get_num_lines(bIn);
-    
+
     /* Lines in B */
     if (btype & (GV_POINTS | GV_LINES)) {
 	G_message(_("Processing features..."));
-	
+
 	G_percent(0, nblines, 2);
 	for (bline = 1; bline <= nblines; bline++) {
 	    struct bound_box bbox;
@@ -65,140 +316,24 @@ int select_lines(struct Map_info *aIn, int atype, int afield,
 		continue;
 	    }
 
-	    Vect_reset_line(BPoints);
-
 	    Vect_get_line_box(bIn, bline, &bbox);
 
 	    /* Check if this line overlaps any feature in A */
-	    /* x Lines in A */
-	    if (atype & (GV_POINTS | GV_LINES)) {
-		
-		/* Lines */
-		Vect_select_lines_by_box(aIn, &bbox, atype, List);
-		for (ai = 0; ai < List->n_values; ai++) {
-		    int aline;
-		    
-		    aline = List->id[ai];
-		    G_debug(3, "  aline = %d", aline);
-
-		    if (ALines[aline] == 1)
-			continue;
-
-		    /* Check type */
-		    ltype = Vect_get_line_type(aIn, aline);
-		    if (!(ltype & atype))
-			continue;
-
-		    /* Check category */
-		    if (!cat_flag &&
-			Vect_get_line_cat(aIn, aline, afield) < 0) {
-			nskipped[0]++;
-			continue;
-		    }
-		    
-		    if (operator != OP_OVERLAP) {
-#ifdef HAVE_GEOS
-			if (!BGeom)
-			    BGeom = Vect_read_line_geos(bIn, bline, &ltype);
-			if (!BGeom)
-			    G_fatal_error(_("Unable to read line id %d from vector map <%s>"),
-					  bline, Vect_get_full_name(bIn));
-
-			if (line_relate_geos(aIn, BGeom, aline,
-			                     operator, relate)) {
-			    ALines[aline] = 1;
-			    nfound += 1;
-			}
-#endif
-		    }
-		    else {
-			if (BPoints->n_points == 0)
-			    Vect_read_line(bIn, BPoints, NULL, bline);
-			Vect_read_line(aIn, APoints, NULL, aline);
-
-			if (Vect_line_check_intersection2(BPoints, APoints, 0)) {
-			    ALines[aline] = 1;
-			    nfound += 1;
-			}
-		    }
-		}
-	    }
-	    
-	    /* x Areas in A. */
-	    if (atype & GV_AREA) {
-		
-		Vect_select_areas_by_box(aIn, &bbox, List);
-		for (ai = 0; ai < List->n_values; ai++) {
-		    int aarea;
-		    
-		    aarea = List->id[ai];
-		    G_debug(3, "  aarea = %d", aarea);
-		    
-		    if (AAreas[aarea] == 1)
-			continue;
-		    
-		    if (Vect_get_area_centroid(aIn, aarea) < 1)
-			continue;
-
-		    if (!cat_flag &&
-		        Vect_get_area_cat(aIn, aarea, afield) < 0) {
-			nskipped[0]++;
-			continue;
-		    }
-
-		    if (operator != OP_OVERLAP) {
-#ifdef HAVE_GEOS
-			if (!BGeom)
-			    BGeom = Vect_read_line_geos(bIn, bline, &ltype);
-			if (!BGeom)
-			    G_fatal_error(_("Unable to read line id %d from vector map <%s>"),
-					  bline, Vect_get_full_name(bIn));
-
-			if (area_relate_geos(aIn, BGeom, aarea, 
-					     operator, relate)) {
-			    add_aarea(aIn, aarea, ALines, AAreas);
-			    nfound += 1;
-			}
-#endif
-		    }
-		    else {
-			if (BPoints->n_points == 0)
-			    Vect_read_line(bIn, BPoints, NULL, bline);
-			Vect_get_area_points(aIn, aarea, OPoints);
-			nisles = Vect_get_area_num_isles(aIn, aarea);
-			if (nisles >= isles_alloc) {
-			    IPoints = G_realloc(IPoints, (nisles + 10) * sizeof(struct line_pnts *));
-			    for (i = isles_alloc; i < nisles + 10; i++)
-				IPoints[i] = Vect_new_line_struct();
-			    isles_alloc = nisles + 10;
-			}
-			for (i = 0; i < nisles; i++) {
-			    isle = Vect_get_area_isle(aIn, aarea, i);
-			    Vect_get_isle_points(aIn, isle, IPoints[i]);
-			}
-
-			if (line_overlap_area(BPoints, OPoints, IPoints, nisles)) {
-			    add_aarea(aIn, aarea, ALines, AAreas);
-			    nfound += 1;
-			}
-		    }
-		}
-	    }
-#ifdef HAVE_GEOS
-	    if (BGeom != NULL) {
-		GEOSGeom_destroy(BGeom);
-		BGeom = NULL;
-	    }
-#endif
+	    add_candidates(&blk, bline, 0, &bbox, atype, afield, cat_flag,
+			   ALines, AAreas, List, nskipped);
+
+	    if (blk.nb >= BLOCK_FEATURES || blk.npairs >= BLOCK_PAIRS)
+		nfound += flush_block(&blk, ALines, AAreas);
 	}
+	nfound += flush_block(&blk, ALines, AAreas);
     }
-    
+
     /* Areas in B. */
     if (btype & GV_AREA) {
-	int barea, nbareas, bcentroid;
+	int barea, nbareas;
 
 	G_message(_("Processing areas..."));
-	
+
 	nbareas = Vect_get_num_areas(bIn);
 
 	G_percent(0, nbareas, 1);
@@ -207,7 +342,7 @@ int select_lines(struct Map_info *aIn, int atype, int afield,
 
 	    G_percent(barea, nbareas, 2);
 
-	    if ((bcentroid = Vect_get_area_centroid(bIn, barea)) < 1)
+	    if (Vect_get_area_centroid(bIn, barea) < 1)
 		continue;
 
 	    if (!cat_flag &&
@@ -216,201 +351,24 @@ int select_lines(struct Map_info *aIn, int atype, int afield,
 		continue;
 	    }
 
-	    Vect_reset_line(BPoints);
-
 	    Vect_get_area_box(bIn, barea, &bbox);
 	    bbox.T = PORT_DOUBLE_MAX;
 	    bbox.B = -PORT_DOUBLE_MAX;
 
-	    /* x Lines in A */
-	    if (atype & (GV_POINTS | GV_LINES)) {
-		Vect_select_lines_by_box(aIn, &bbox, atype, List);
-
-		for (ai = 0; ai < List->n_values; ai++) {
-		    int aline;
-
-		    aline = List->id[ai];
-		    if (ALines[aline] == 1)
-			continue;
-
-		    /* Check type */
-		    ltype = Vect_get_line_type(aIn, aline);
-		    if (!(ltype & atype))
-			continue;
-
-		    if (!cat_flag &&
-			Vect_get_line_cat(aIn, aline, afield) < 0) {
-			nskipped[0]++;
-			continue;
-		    }
-		    
-		    if (operator != OP_OVERLAP) {
-#ifdef HAVE_GEOS
-			if (!BGeom)
-			    BGeom = Vect_read_area_geos(bIn, barea);
-			if (!BGeom)
-			    G_fatal_error(_("Unable to read area id %d from vector map <%s>"),
-					  barea, Vect_get_full_name(bIn));
-			if (line_relate_geos(aIn, BGeom, aline,
-					     operator, relate)) {
-			    ALines[aline] = 1;
-			    nfound += 1;
-			}
-#endif
-		    }
-		    else {
-			if (BPoints->n_points == 0) {
-			    Vect_read_line(bIn, BPoints, NULL, bcentroid);
-			    Vect_get_area_points(bIn, barea, OPoints);
-			    nisles = Vect_get_area_num_isles(bIn, barea);
-			    if (nisles >= isles_alloc) {
-				IPoints = G_realloc(IPoints, (nisles + 10) * sizeof(struct line_pnts *));
-				for (i = isles_alloc; i < nisles + 10; i++)
-				    IPoints[i] = Vect_new_line_struct();
-				isles_alloc = nisles + 10;
-			    }
-			    for (i = 0; i < nisles; i++) {
-				isle = Vect_get_area_isle(bIn, barea, i);
-				Vect_get_isle_points(bIn, isle, IPoints[i]);
-			    }
-			}
-
-			Vect_read_line(aIn, APoints, NULL, aline);
-
-			if (line_overlap_area(APoints, OPoints, IPoints, nisles)) {
-			    ALines[aline] = 1;
-			    nfound += 1;
-			}
-		    }
-		}
-	    }
-
-	    /* x Areas in A */
-	    if (atype & GV_AREA) {
-
-		/* List of areas A */
-		Vect_select_areas_by_box(aIn, &bbox, List);
-
-		for (ai = 0; ai < List->n_values; ai++) {
-		    int found = 0;
-		    int aarea, acentroid;
-
-		    aarea = List->id[ai];
-		    G_debug(3, "  aarea = %d", aarea);
-		    
-		    if (AAreas[aarea] == 1)
-			continue;
-
-		    if ((acentroid = Vect_get_area_centroid(aIn, aarea)) < 1)
-			continue;
+	    add_candidates(&blk, barea, 1, &bbox, atype, afield, cat_flag,
+			   ALines, AAreas, List, nskipped);
 
-		    if (!cat_flag &&
-		        Vect_get_area_cat(aIn, aarea, afield) < 0) {
-			nskipped[0]++;
-			continue;
-		    }
-
-		    if (operator != OP_OVERLAP) {
-#ifdef HAVE_GEOS
-			if (!BGeom)
-			    BGeom = Vect_read_area_geos(bIn, barea);
-			if (!BGeom)
-			    G_fatal_error(_("Unable to read area id %d from vector map <%s>"),
-					  barea, Vect_get_full_name(bIn));
-			if (area_relate_geos(aIn, BGeom, aarea,
-					     operator, relate)) {
-			    found = 1;
-			}
-#endif
-		    }
-		    else {
-			if (BPoints->n_points == 0) {
-			    Vect_read_line(bIn, BPoints, NULL, bcentroid);
-			    Vect_get_area_points(bIn, barea, OPoints);
-			    nisles = Vect_get_area_num_isles(bIn, barea);
-			    if (nisles >= isles_alloc) {
-				IPoints = G_realloc(IPoints, (nisles + 10) * sizeof(struct line_pnts *));
-				for (i = isles_alloc; i < nisles + 10; i++)
-				    IPoints[i] = Vect_new_line_struct();
-				isles_alloc = nisles + 10;
-			    }
-			    for (i = 0; i < nisles; i++) {
-				isle = Vect_get_area_isle(bIn, barea, i);
-				Vect_get_isle_points(bIn, isle, IPoints[i]);
-			    }
-			}
-
-			/* A inside B ? */
-			Vect_read_line(aIn, APoints, NULL, acentroid);
-			if (line_overlap_area(APoints, OPoints, IPoints, nisles)) {
-			    found = 1;
-			}
-
-			/* B inside A ? */
-			if (!found) {
-			    struct bound_box abox;
-
-			    Vect_get_area_box(aIn, aarea, &abox);
-			    abox.T = PORT_DOUBLE_MAX;
-			    abox.B = -PORT_DOUBLE_MAX;
-
-			    if (Vect_point_in_area(BPoints->x[0], BPoints->y[0], aIn,
-						   aarea, &abox)) {
-				found = 1;
-			    }
-			}
-
-			/* A overlaps B ? */
-			if (!found) {
-			    Vect_get_area_boundaries(aIn, aarea, BoundList);
-			    for (i = 0; i < BoundList->n_values; i++) {
-				Vect_read_line(aIn, APoints, NULL, abs(BoundList->value[i]));
-				if (line_overlap_area(APoints, OPoints, IPoints, nisles)) {
-				    found = 1;
-				    break;
-				}
-			    }
-			}
-
-			if (!found) {
-			    int j, naisles;
-
-			    naisles = Vect_get_area_num_isles(aIn, aarea);
-			    for (j = 0; j < naisles; j++) {
-
-				isle = Vect_get_area_isle(aIn, aarea, j);
-
-				Vect_get_isle_boundaries(aIn, isle, BoundList);
-				for (i = 0; i < BoundList->n_values; i++) {
-				    Vect_read_line(aIn, APoints, NULL, abs(BoundList->value[i]));
-				    if (line_overlap_area(APoints, OPoints, IPoints, nisles)) {
-					found = 1;
-					break;
-				    }
-				}
-				if (found)
-				    break;
-			    }
-			}
-		    }
-		    if (found) {
-			add_aarea(aIn, aarea, ALines, AAreas);
-			nfound += 1;
-		    }
-		}
-	    }
-#ifdef HAVE_GEOS
-	    if (BGeom != NULL) {
-		GEOSGeom_destroy(BGeom);
-		BGeom = NULL;
-	    }
-#endif
+	    if (blk.nb >= BLOCK_FEATURES || blk.npairs >= BLOCK_PAIRS)
+		nfound += flush_block(&blk, ALines, AAreas);
 	}
+	nfound += flush_block(&blk, ALines, AAreas);
     }
 
-    Vect_destroy_line_struct(APoints);
-    Vect_destroy_line_struct(BPoints);
-    Vect_destroy_list(BoundList);
+    free_features(blk.a, blk.a_alloc);
+    free_features(blk.b, blk.b_alloc);
+    G_free(blk.pairs);
+    G_free(blk.aline_index);
+    G_free(blk.aarea_index);
     Vect_destroy_boxlist(List);
 
     return nfound;
@@ -49,7 +49,7 @@ int main(int argc, char *argv[])
     char table_name[GNAME_MAX], title[64];
     char xname[GNAME_MAX], xmapset[GMAPSET_MAX];
 
-    int dim_vect, nparameters, BW;
+    int dim_vect, nparameters, BW, solver_type;
     int *lineVect;		/* Vector restoring primitive's ID */
     double *TN, *Q, *parVect;	/* Interpolating and least-square vectors */
     double **N, **obsVect;	/* Interpolation and least-square matrix */
@@ -213,6 +213,11 @@ int main(int argc, char *argv[])
     else
 	bilin = P_BICUBIC;
 
+    if (G_strncasecmp(solver->answer, "cg", 2) == 0)
+	solver_type = P_CG;
+    else
+	solver_type = P_CHOLESKY;
+
     G_get_set_window(&original_reg);
     stepN = 4 * original_reg.ns_res;
     if (stepN_opt->answer)
@@ -787,10 +792,8 @@ int main(int argc, char *argv[])
 		    nCorrectGrad(N, lambda, nsplx, nsply, stepE, stepN);
 		}
 
-                if(G_strncasecmp(solver->answer, "cg", 2) == 0)
-                    G_math_solver_cg_sband(N, parVect, TN, nparameters, BW, atoi(iter->answer), atof(error->answer));
-		else
-		    G_math_solver_cholesky_sband(N, parVect, TN, nparameters, BW);
+		normalSolve(N, parVect, TN, nparameters, BW, solver_type,
+			    atoi(iter->answer), atof(error->answer));
 
 
 		G_free_matrix(N);
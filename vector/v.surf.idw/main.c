@@ -1,4 +1,3 @@
-
 /****************************************************************************
  *
  * MODULE:       v.surf.idw
@@ -10,7 +9,7 @@
  *               OGR support by Martin Landa <landa.martin gmail.com>
  * PURPOSE:      Surface interpolation from vector point data by Inverse
  *               Distance Squared Weighting
- * COPYRIGHT:    (C) 2003-2010 by the GRASS Development Team
+ * COPYRIGHT:    (C) 2003-2020 by the GRASS Development Team
  *
  *               This program is free software under the GNU General
  *               Public License (>=v2). Read the file COPYING that
@@ -21,31 +20,107 @@
 #include <math.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
+#include <grass/kdtree.h>
 #include <grass/glocale.h>
 #include "proto.h"
 
-int search_points = 12;
+/* number of output rows interpolated at once */
+#define ROW_BAND 64
 
 long npoints = 0;
-long **npoints_currcell;
-int nsearch;
-static int i;
+static long npoints_alloc = 0;
 
 struct Point
 {
     double north, east;
     double z;
+    int row, col;		/* cell of the point in the region */
 };
-struct list_Point
+static struct Point *points = NULL;
+static struct Cell_head window;
+
+/* neighbour search settings */
+static int nsearch;		/* number of neighbours, 0 for all within radius */
+static double maxdist;		/* radius, 0 for no limit */
+static double power;
+static struct kdtree *tree;
+
+/* search results of a thread */
+struct scratch
 {
-    double north, east;
-    double z;
-    double dist;
+    int *uid;
+    double *dist;
+};
+
+/* the rows of a band */
+struct band
+{
+    DCELL *dcell;
+    CELL *mask;
+    long *row_start;		/* first point of each region row */
+    int band;			/* region row of the first band row */
+    int chunk;			/* rows of a thread */
+    struct scratch *scratch;
 };
-struct Point ***points;
-struct Point *noidxpoints = NULL;
-struct list_Point *list;
-static struct Cell_head window;
+
+static int cmp_points(const void *, const void *);
+static int interp_cell(double, double, int *, double *, double *);
+
+/* the threads interpolate the rows first to last - 1 of a band; the
+ * points and the search tree are shared and only read, each row of the
+ * band buffer is written by one thread, the search results of a thread
+ * are in its own scratch */
+static void interp_rows(int first, int last, void *closure)
+{
+    const struct band *bd = closure;
+    struct scratch *sc = &bd->scratch[first / bd->chunk];
+    int row, col;
+
+    for (row = first; row < last; row++) {
+	DCELL *out = bd->dcell + (size_t)row * window.cols;
+	CELL *m = bd->mask ? bd->mask + (size_t)row * window.cols : NULL;
+	double north, east, value = 0.0;
+	long k = 0, kend = 0;
+
+	north = window.north - (bd->band + row + 0.5) * window.ns_res;
+	if (bd->row_start) {
+	    k = bd->row_start[bd->band + row];
+	    kend = bd->row_start[bd->band + row + 1];
+	}
+
+	for (col = 0; col < window.cols; col++) {
+	    east = window.west + (col + 0.5) * window.ew_res;
+
+	    /* don't interpolate outside of the mask */
+	    if (m && m[col] == 0) {
+		Rast_set_d_null_value(&out[col], 1);
+		continue;
+	    }
+
+	    /* If current cell contains nsearch or more points just
+	     * average all the points in this cell and don't look
+	     * in any others */
+	    if (bd->row_start) {
+		long n;
+		double sum = 0.0;
+
+		while (k < kend && points[k].col < col)
+		    k++;
+		for (n = k; n < kend && points[n].col == col; n++)
+		    sum += points[n].z;
+		if (nsearch > 0 && n - k >= nsearch) {
+		    out[col] = (DCELL) (sum / (n - k));
+		    continue;
+		}
+	    }
+
+	    if (interp_cell(north, east, sc->uid, sc->dist, &value))
+		out[col] = (DCELL) value;
+	    else
+		Rast_set_d_null_value(&out[col], 1);
+	}
+    }
+}
 
 int main(int argc, char *argv[])
 {
@@ -54,31 +129,19 @@ int main(int argc, char *argv[])
     DCELL *dcell;
     struct GModule *module;
     struct History history;
-    int row, col;
-    int searchrow, searchcolumn, pointsfound;
-    int *shortlistrows = NULL, *shortlistcolumns = NULL;
-    long ncells = 0;
-    double north, east;
-    double dist;
-    double sum1, sum2, interp_value;
-    int n;
-    double p;
+    int row, band, nrows_band;
+    long i, *row_start = NULL;
+    struct band bd;
+    int search_points, threads;
     struct
     {
-	struct Option *input, *npoints, *power, *output, *dfield, *col;
+	struct Option *input, *npoints, *power, *output, *dfield, *col,
+	    *radius, *threads;
     } parm;
     struct
     {
         struct Flag *noindex;
     } flag;
-    struct cell_list
-    {
-	int row, column;
-	struct cell_list *next;
-    };
-    struct cell_list **search_list = NULL, **search_list_start = NULL;
-    int max_radius, radius;
-    int searchallpoints = 0;
     char *tmpstr1, *tmpstr2;
 
     G_gisinit(argv[0]);
@@ -95,7 +158,7 @@ int main(int argc, char *argv[])
     parm.input = G_define_standard_option(G_OPT_V_INPUT);
 
     parm.dfield = G_define_standard_option(G_OPT_V_FIELD);
-    
+
     parm.col = G_define_standard_option(G_OPT_DB_COLUMN);
     parm.col->required = NO;
     parm.col->label = _("Name of attribute column with values to interpolate");
@@ -110,145 +173,105 @@ int main(int argc, char *argv[])
     parm.npoints->key_desc = "count";
     parm.npoints->type = TYPE_INTEGER;
     parm.npoints->required = NO;
-    parm.npoints->description = _("Number of interpolation points");
+    parm.npoints->label = _("Number of interpolation points");
+    parm.npoints->description = _("0 uses all points within the given radius");
     parm.npoints->answer = "12";
     parm.npoints->guisection = _("Settings");
 
+    parm.radius = G_define_option();
+    parm.radius->key = "radius";
+    parm.radius->type = TYPE_DOUBLE;
+    parm.radius->required = NO;
+    parm.radius->label = _("Maximum distance of interpolation points");
+    parm.radius->description =
+	_("Cells without points within this distance are set to NULL");
+    parm.radius->guisection = _("Settings");
+
     parm.power = G_define_option();
     parm.power->key = "power";
     parm.power->type = TYPE_DOUBLE;
     parm.power->answer = "2.0";
     parm.power->label = _("Power parameter");
-    parm.power->description = 
+    parm.power->description =
     	_("Greater values assign greater influence to closer points");
     parm.power->guisection = _("Settings");
 
+    parm.threads = G_define_standard_option(G_OPT_M_NPROCS);
+    parm.threads->guisection = _("Settings");
+
     flag.noindex = G_define_flag();
     flag.noindex->key = 'n';
     flag.noindex->label = _("Don't index points by raster cell");
-    flag.noindex->description = _("Slower but uses"
-				  " less memory and includes points from outside region"
-				  " in the interpolation");
+    flag.noindex->description = _("Includes points from outside region"
+				  " in the interpolation and does not average"
+				  " points falling into the same cell");
     flag.noindex->guisection = _("Settings");
 
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    maxdist = 0;
+    if (parm.radius->answer &&
+	(sscanf(parm.radius->answer, "%lf", &maxdist) != 1 || maxdist <= 0))
+	G_fatal_error(_("Illegal value for '%s' (%s)"), parm.radius->key,
+		      parm.radius->answer);
+
     if (sscanf(parm.npoints->answer, "%d", &search_points) != 1 ||
-	search_points < 1)
+	search_points < 0 || (search_points == 0 && maxdist == 0))
 	G_fatal_error(_("Illegal number (%s) of interpolation points"),
 		      parm.npoints->answer);
-    
-    list =
-	(struct list_Point *) G_calloc((size_t) search_points,
-				       sizeof(struct list_Point));
 
-    p = atof(parm.power->answer);
+    power = atof(parm.power->answer);
+
+    threads = G_set_nprocs(parm.threads);
 
     /* get the window, dimension arrays */
     G_get_window(&window);
 
-    if (!flag.noindex->answer) {
-	npoints_currcell = (long **)G_malloc(window.rows * sizeof(long *));
-	points =
-	    (struct Point ***)G_malloc(window.rows * sizeof(struct Point **));
-
-
-	for (row = 0; row < window.rows; row++) {
-	    npoints_currcell[row] =
-		(long *)G_malloc(window.cols * sizeof(long));
-	    points[row] =
-		(struct Point **)G_malloc(window.cols *
-					  sizeof(struct Point *));
-
-	    for (col = 0; col < window.cols; col++) {
-		npoints_currcell[row][col] = 0;
-		points[row][col] = NULL;
-	    }
-	}
-    }
-
     /* read the elevation points from the input sites file */
     read_sites(parm.input->answer, parm.dfield->answer,
 	       parm.col->answer, flag.noindex->answer);
-    
+
     if (npoints == 0)
 	G_fatal_error(_("No points found"));
+    if (npoints > 0x7fffffff)
+	G_fatal_error(_("Too many points (%ld)"), npoints);
     nsearch = npoints < search_points ? npoints : search_points;
 
     if (!flag.noindex->answer) {
-	/* Arbitrary point to switch between searching algorithms. Could do
-	 * with refinement PK */
-	if ((window.rows * window.cols) / npoints > 400) {
-	    /* Using old algorithm.... */
-	    searchallpoints = 1;
-	    ncells = 0;
-
-	    /* Make an array to contain the row and column indices that have
-	     * sites in them; later will just search through all these. */
-	    for (searchrow = 0; searchrow < window.rows; searchrow++)
-		for (searchcolumn = 0; searchcolumn < window.cols;
-		     searchcolumn++)
-		    if (npoints_currcell[searchrow][searchcolumn] > 0) {
-			shortlistrows = (int *)G_realloc(shortlistrows,
-							 (1 +
-							  ncells) *
-							 sizeof(int));
-			shortlistcolumns =
-			    (int *)G_realloc(shortlistcolumns,
-					     (1 + ncells) * sizeof(int));
-			shortlistrows[ncells] = searchrow;
-			shortlistcolumns[ncells] = searchcolumn;
-			ncells++;
-		    }
-	}
-	else {
-	    /* Fill look-up table of row and column offsets for
-	     * doing a circular region growing search looking for sites */
-	    /* Use units of column width */
-	    max_radius = (int)(0.5 + sqrt(window.cols * window.cols +
-					  (window.rows * window.ns_res /
-					   window.ew_res) * (window.rows *
-							     window.ns_res /
-							     window.ew_res)));
-
-	    search_list =
-		(struct cell_list **)G_malloc(max_radius *
-					      sizeof(struct cell_list *));
-	    search_list_start =
-		(struct cell_list **)G_malloc(max_radius *
-					      sizeof(struct cell_list *));
-
-	    for (radius = 0; radius < max_radius; radius++)
-		search_list[radius] = NULL;
-
-	    for (row = 0; row < window.rows; row++)
-		for (col = 0; col < window.cols; col++) {
-		    radius = (int)sqrt(col * col +
-				       (row * window.ns_res / window.ew_res) *
-				       (row * window.ns_res / window.ew_res));
-		    if (search_list[radius] == NULL)
-			search_list[radius] =
-			    search_list_start[radius] =
-			    G_malloc(sizeof(struct cell_list));
-		    else
-			search_list[radius] =
-			    search_list[radius]->next =
-			    G_malloc(sizeof(struct cell_list));
-
-		    search_list[radius]->row = row;
-		    search_list[radius]->column = col;
-		    search_list[radius]->next = NULL;
-		}
+	/* order the points by cell, the points of each row are
+	 * found with the start index of the row */
+	qsort(points, npoints, sizeof(struct Point), cmp_points);
+
+	row_start = (long *)G_calloc(window.rows + 1, sizeof(long));
+	for (i = 0; i < npoints; i++)
+	    row_start[points[i].row + 1]++;
+	for (row = 0; row < window.rows; row++)
+	    row_start[row + 1] += row_start[row];
+    }
+
+    /* index the points in a balanced k-d tree for the neighbour search */
+    G_message(_("Building search tree..."));
+    {
+	double *c = G_malloc(2 * npoints * sizeof(double));
+
+	for (i = 0; i < npoints; i++) {
+	    c[2 * i] = points[i].east;
+	    c[2 * i + 1] = points[i].north;
 	}
+	tree = kdtree_create_bulk(2, NULL, c, NULL, (int)npoints, 1);
+	G_free(c);
     }
 
     /* allocate buffers, etc. */
 
-    dcell = Rast_allocate_d_buf();
+    nrows_band = ROW_BAND;
+    dcell = (DCELL *) G_malloc((size_t)nrows_band * window.cols *
+			       sizeof(DCELL));
 
     if ((maskfd = Rast_maskfd()) >= 0)
-	mask = Rast_allocate_c_buf();
+	mask = (CELL *) G_malloc((size_t)nrows_band * window.cols *
+				 sizeof(CELL));
     else
 	mask = NULL;
 
@@ -265,155 +288,60 @@ int main(int argc, char *argv[])
     G_free(tmpstr1);
     G_free(tmpstr2);
 
-    north = window.north + window.ns_res / 2.0;
-    for (row = 0; row < window.rows; row++) {
-	G_percent(row, window.rows, 1);
-
-	if (mask)
-	    Rast_get_c_row(maskfd, mask, row);
+    bd.dcell = dcell;
+    bd.mask = mask;
+    bd.row_start = row_start;
+    bd.scratch = G_malloc(threads * sizeof(struct scratch));
+    for (i = 0; i < threads; i++) {
+	bd.scratch[i].uid = NULL;
+	bd.scratch[i].dist = NULL;
+	if (nsearch > 0) {
+	    bd.scratch[i].uid = (int *)G_malloc(nsearch * sizeof(int));
+	    bd.scratch[i].dist = (double *)G_malloc(nsearch * sizeof(double));
+	}
+    }
 
-	north -= window.ns_res;
-	east = window.west - window.ew_res / 2.0;
-	for (col = 0; col < window.cols; col++) {
-	    east += window.ew_res;
-	    /* don't interpolate outside of the mask */
-	    if (mask && mask[col] == 0) {
-		Rast_set_d_null_value(&dcell[col], 1);
-		continue;
-	    }
+    /* the rows of a band are interpolated in parallel and written in order */
+    for (band = 0; band < window.rows; band += nrows_band) {
+	int nrows = window.rows - band < nrows_band ?
+	    window.rows - band : nrows_band;
 
-	    /* If current cell contains more than nsearch points just average
-	     * all the points in this cell and don't look in any others */
+	G_percent(band, window.rows, 1);
 
-	    if (!(flag.noindex->answer) && npoints_currcell[row][col] >= nsearch) {
-		sum1 = 0.0;
-		for (i = 0; i < npoints_currcell[row][col]; i++)
-		    sum1 += points[row][col][i].z;
+	if (mask)
+	    for (row = 0; row < nrows; row++)
+		Rast_get_c_row(maskfd, mask + (size_t)row * window.cols,
+			       band + row);
 
-		interp_value = sum1 / npoints_currcell[row][col];
-	    }
-	    else {
-		if (flag.noindex->answer)
-		    calculate_distances_noindex(north, east);
-		else {
-		    pointsfound = 0;
-		    i = 0;
-
-		    if (searchallpoints == 1) {
-			/* If there aren't many sites just check them all to find
-			 * the nearest */
-			for (n = 0; n < ncells; n++)
-			    calculate_distances(shortlistrows[n],
-						shortlistcolumns[n], north,
-						east, &pointsfound);
-		    }
-		    else {
-			radius = 0;
-			while (pointsfound < nsearch) {
-			    /* Keep widening the search window until we find
-			     * enough points */
-			    search_list[radius] = search_list_start[radius];
-			    while (search_list[radius] != NULL) {
-				/* Always */
-				if (row <
-				    (window.rows - search_list[radius]->row)
-				    && col <
-				    (window.cols -
-				     search_list[radius]->column)) {
-				    searchrow =
-					row + search_list[radius]->row;
-				    searchcolumn =
-					col + search_list[radius]->column;
-				    calculate_distances(searchrow,
-							searchcolumn, north,
-							east, &pointsfound);
-				}
-
-				/* Only if at least one offset is not 0 */
-				if ((search_list[radius]->row > 0 ||
-				     search_list[radius]->column > 0) &&
-				    row >= search_list[radius]->row &&
-				    col >= search_list[radius]->column) {
-				    searchrow =
-					row - search_list[radius]->row;
-				    searchcolumn =
-					col - search_list[radius]->column;
-				    calculate_distances(searchrow,
-							searchcolumn, north,
-							east, &pointsfound);
-				}
-
-				/* Only if both offsets are not 0 */
-				if (search_list[radius]->row > 0 &&
-				    search_list[radius]->column > 0) {
-				    if (row <
-					(window.rows -
-					 search_list[radius]->row) &&
-					col >= search_list[radius]->column) {
-					searchrow =
-					    row + search_list[radius]->row;
-					searchcolumn =
-					    col - search_list[radius]->column;
-					calculate_distances(searchrow,
-							    searchcolumn,
-							    north, east,
-							    &pointsfound);
-				    }
-				    if (row >= search_list[radius]->row &&
-					col <
-					(window.cols -
-					 search_list[radius]->column)) {
-					searchrow =
-					    row - search_list[radius]->row;
-					searchcolumn =
-					    col + search_list[radius]->column;
-					calculate_distances(searchrow,
-							    searchcolumn,
-							    north, east,
-							    &pointsfound);
-				    }
-				}
-
-				search_list[radius] =
-				    search_list[radius]->next;
-			    }
-			    radius++;
-			}
-		    }
-		}
+	bd.band = band;
+	bd.chunk = (nrows + threads - 1) / threads;
+	G_parallel_for(0, nrows, bd.chunk, interp_rows, &bd);
 
-		/* interpolate */
-		sum1 = 0.0;
-		sum2 = 0.0;
-		for (n = 0; n < nsearch; n++) {
-		    if ((dist = sqrt(list[n].dist))) {
-			sum1 += list[n].z / pow(dist, p);
-			sum2 += 1.0 / pow(dist, p);
-		    }
-		    else {
-			/* If one site is dead on the centre of the cell, ignore
-			 * all the other sites and just use this value. 
-			 * (Unlikely when using floating point numbers?) */
-			sum1 = list[n].z;
-			sum2 = 1.0;
-			break;
-		    }
-		}
-		interp_value = sum1 / sum2;
-	    }
-	    dcell[col] = (DCELL) interp_value;
-	}
-	Rast_put_d_row(fd, dcell);
+	for (row = 0; row < nrows; row++)
+	    Rast_put_d_row(fd, dcell + (size_t)row * window.cols);
     }
     G_percent(1, 1, 1);
 
     Rast_close(fd);
 
+    kdtree_destroy(tree);
+    G_free(points);
+    if (row_start)
+	G_free(row_start);
+    G_free(dcell);
+    if (mask)
+	G_free(mask);
+    for (i = 0; i < threads; i++) {
+	G_free(bd.scratch[i].uid);
+	G_free(bd.scratch[i].dist);
+    }
+    G_free(bd.scratch);
+
     /* writing history file */
     Rast_short_history(parm.output->answer, "raster", &history);
     Rast_command_history(&history);
     Rast_write_history(parm.output->answer, &history);
-    
+
     G_done_msg(" ");
 
     exit(EXIT_SUCCESS);
@@ -426,120 +354,90 @@ void newpoint(double z, double east, double north, int noindex)
     row = (int)((window.north - north) / window.ns_res);
     column = (int)((east - window.west) / window.ew_res);
 
-    if (!noindex) {
-	if (row < 0 || row >= window.rows || column < 0 ||
-	    column >= window.cols) ;
-	else {			/* Ignore sites outside current region as can't be indexed */
-
-	    points[row][column] =
-		(struct Point *)G_realloc(points[row][column],
-					  (1 +
-					   npoints_currcell[row][column]) *
-					  sizeof(struct Point));
-	    points[row][column][npoints_currcell[row][column]].north = north;
-	    points[row][column][npoints_currcell[row][column]].east = east;
-	    points[row][column][npoints_currcell[row][column]].z = z;
-	    npoints_currcell[row][column]++;
-	    npoints++;
-	}
-    }
-    else {
-	noidxpoints = (struct Point *)G_realloc(noidxpoints,
-						(1 +
-						 npoints) *
-						sizeof(struct Point));
-	noidxpoints[npoints].north = north;
-	noidxpoints[npoints].east = east;
-	noidxpoints[npoints].z = z;
-	npoints++;
+    /* Ignore sites outside current region as they aren't indexed */
+    if (!noindex && (row < 0 || row >= window.rows || column < 0 ||
+		     column >= window.cols))
+	return;
+
+    if (npoints == npoints_alloc) {
+	npoints_alloc = npoints_alloc ? 2 * npoints_alloc : 1024;
+	points = (struct Point *)G_realloc(points, npoints_alloc *
+					   sizeof(struct Point));
     }
+    points[npoints].north = north;
+    points[npoints].east = east;
+    points[npoints].z = z;
+    points[npoints].row = row;
+    points[npoints].col = column;
+    npoints++;
 }
 
-void calculate_distances(int row, int column, double north,
-			 double east, int *pointsfound)
+static int cmp_points(const void *a, const void *b)
 {
-    int j, n;
-    static int max;
-    double dx, dy, dist;
-    static double maxdist;
-
-    /* Check distances and find the points to use in interpolation */
-    for (j = 0; j < npoints_currcell[row][column]; j++) {
-	/* fill list with first nsearch points */
-	if (i < nsearch) {
-	    dy = points[row][column][j].north - north;
-	    dx = points[row][column][j].east - east;
-	    list[i].dist = dy * dy + dx * dx;
-	    list[i].z = points[row][column][j].z;
-	    i++;
-
-	    /* find the maximum distance */
-	    if (i == nsearch) {
-		maxdist = list[max = 0].dist;
-		for (n = 1; n < nsearch; n++) {
-		    if (maxdist < list[n].dist)
-			maxdist = list[max = n].dist;
-		}
-	    }
-	}
-	else {
+    const struct Point *p1 = a, *p2 = b;
 
-	    /* go through rest of the points now */
-	    dy = points[row][column][j].north - north;
-	    dx = points[row][column][j].east - east;
-	    dist = dy * dy + dx * dx;
-
-	    if (dist < maxdist) {
-		/* replace the largest dist */
-		list[max].z = points[row][column][j].z;
-		list[max].dist = dist;
-		maxdist = list[max = 0].dist;
-		for (n = 1; n < nsearch; n++) {
-		    if (maxdist < list[n].dist)
-			maxdist = list[max = n].dist;
-		}
-	    }
+    if (p1->row != p2->row)
+	return p1->row < p2->row ? -1 : 1;
+    if (p1->col != p2->col)
+	return p1->col < p2->col ? -1 : 1;
 
-	}
-    }
-    *pointsfound += npoints_currcell[row][column];
+    return 0;
 }
 
-void calculate_distances_noindex(double north, double east)
+/* Interpolate the value at north, east from the nearest points. The
+ * buffers uid and dist hold nsearch entries. Returns the number of
+ * points used, the value is only set if points were found. */
+static int interp_cell(double north, double east, int *uid, double *dist,
+		       double *value)
 {
-    int n, max;
-    double dx, dy, dist;
-    double maxdist;
-
-    /* fill list with first nsearch points */
-    for (i = 0; i < nsearch; i++) {
-	dy = noidxpoints[i].north - north;
-	dx = noidxpoints[i].east - east;
-	list[i].dist = dy * dy + dx * dx;
-	list[i].z = noidxpoints[i].z;
+    double c[2], sum1, sum2, w;
+    int n, found;
+    int *puid = uid;
+    double *pdist = dist;
+
+    c[0] = east;
+    c[1] = north;
+
+    if (nsearch > 0) {
+	found = kdtree_knn(tree, c, uid, dist, nsearch, NULL);
+	/* the neighbours are sorted by distance */
+	if (maxdist > 0)
+	    while (found > 0 && dist[found - 1] > maxdist * maxdist)
+		found--;
     }
-    /* find the maximum distance */
-    maxdist = list[max = 0].dist;
-    for (n = 1; n < nsearch; n++) {
-	if (maxdist < list[n].dist)
-	    maxdist = list[max = n].dist;
+    else {
+	puid = NULL;
+	pdist = NULL;
+	found = kdtree_dnn(tree, c, &puid, &pdist, maxdist, NULL);
     }
-    /* go through rest of the points now */
-    for (; i < npoints; i++) {
-	dy = noidxpoints[i].north - north;
-	dx = noidxpoints[i].east - east;
-	dist = dy * dy + dx * dx;
-
-	if (dist < maxdist) {
-	    /* replace the largest dist */
-	    list[max].z = noidxpoints[i].z;
-	    list[max].dist = dist;
-	    maxdist = list[max = 0].dist;
-	    for (n = 1; n < nsearch; n++) {
-		if (maxdist < list[n].dist)
-		    maxdist = list[max = n].dist;
-	    }
+
+    /* interpolate */
+    sum1 = 0.0;
+    sum2 = 0.0;
+    for (n = 0; n < found; n++) {
+	if (pdist[n] > 0) {
+	    /* pdist is the squared distance */
+	    w = power == 2.0 ? 1.0 / pdist[n] : pow(pdist[n], -power / 2.0);
+	    sum1 += points[puid[n]].z * w;
+	    sum2 += w;
+	}
+	else {
+	    /* If one site is dead on the centre of the cell, ignore
+	     * all the other sites and just use this value.
+	     * (Unlikely when using floating point numbers?) */
+	    sum1 = points[puid[n]].z;
+	    sum2 = 1.0;
+	    break;
 	}
     }
 
+    if (nsearch == 0) {
+	G_free(puid);
+	G_free(pdist);
+    }
+
+    if (found > 0)
+	*value = sum1 / sum2;
+
+    return found;
 }
@@ -2,5 +2,3 @@
 void read_sites(const char *, const char *, const char *, int);
 
 void newpoint(double, double, double, int);
-void calculate_distances(int, int, double, double, int *);
-void calculate_distances_noindex(double, double);
@@ -254,13 +254,7 @@ int main(int argc, char *argv[])
 	_("Name for output vector map showing overlapping windows");
     parm.overfile->guisection = _("Outputs");
 
-    parm.threads = G_define_option();
-    parm.threads->key = "nprocs";
-    parm.threads->type = TYPE_INTEGER;
-    parm.threads->answer = NUM_THREADS;
-    parm.threads->required = NO;
-    parm.threads->description =
-	_("Number of threads for parallel computing");
+    parm.threads = G_define_standard_option(G_OPT_M_NPROCS);
     parm.threads->guisection = _("Parameters");
 
     parm.maskmap = G_define_standard_option(G_OPT_R_INPUT);
@@ -401,17 +395,7 @@ int main(int argc, char *argv[])
     treefile = parm.treefile->answer;
     overfile = parm.overfile->answer;
 
-    sscanf(parm.threads->answer, "%d", &threads);
-    if (threads < 1)
-    {
-      G_warning(_("<%d> is not valid number of threads. Number of threads will be set on <%d>"),
-      threads, abs(threads));
-      threads = abs(threads);
-    }
-    if (parm.devi->answer && threads > 1) {
-        G_warning(_("Parallel computation disabled when deviation output is required"));
-        threads = 1;
-    }
+    threads = G_set_nprocs(parm.threads);
 #if defined(_OPENMP)
     omp_set_num_threads(threads);
 #else
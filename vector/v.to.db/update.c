@@ -7,6 +7,136 @@
 
 static int srch();
 
+/* rows sent to the driver in one db_update_values() call */
+#define BATCH_SIZE 10000
+
+static struct
+{
+    int ncols, nrows;
+    dbString columns[4];
+    int ctypes[4];
+    int *keys;
+    dbValue *values;
+} batch;
+
+static void batch_init(void)
+{
+    int j;
+
+    batch.nrows = 0;
+    batch.ncols = 0;
+    switch (options.option) {
+    case O_COUNT:
+	batch.ctypes[batch.ncols++] = DB_C_TYPE_INT;
+	break;
+    case O_SIDES:
+	batch.ctypes[batch.ncols++] = DB_C_TYPE_INT;
+	batch.ctypes[batch.ncols++] = DB_C_TYPE_INT;
+	break;
+    case O_QUERY:
+	/* datetime values are sent as strings */
+	batch.ctypes[batch.ncols++] = vstat.qtype == DB_C_TYPE_DATETIME ?
+	    DB_C_TYPE_STRING : vstat.qtype;
+	break;
+    case O_COOR:
+    case O_START:
+    case O_END:
+	batch.ctypes[batch.ncols++] = DB_C_TYPE_DOUBLE;
+	batch.ctypes[batch.ncols++] = DB_C_TYPE_DOUBLE;
+	if (options.col[2])
+	    batch.ctypes[batch.ncols++] = DB_C_TYPE_DOUBLE;
+	break;
+    case O_BBOX:
+	for (j = 0; j < 4; j++)
+	    batch.ctypes[batch.ncols++] = DB_C_TYPE_DOUBLE;
+	break;
+    default:
+	batch.ctypes[batch.ncols++] = DB_C_TYPE_DOUBLE;
+	break;
+    }
+    for (j = 0; j < batch.ncols; j++) {
+	db_init_string(&batch.columns[j]);
+	db_set_string(&batch.columns[j], options.col[j]);
+    }
+    batch.keys = G_malloc(BATCH_SIZE * sizeof(int));
+    batch.values = G_calloc(BATCH_SIZE * batch.ncols, sizeof(dbValue));
+    for (j = 0; j < BATCH_SIZE * batch.ncols; j++)
+	db_init_string(&batch.values[j].s);
+}
+
+/* add the values of the updated columns of Values[i] */
+static void batch_add(int i)
+{
+    struct value *v = &Values[i];
+    dbValue *row = &batch.values[batch.nrows * batch.ncols];
+    int j;
+
+    batch.keys[batch.nrows++] = v->cat;
+    for (j = 0; j < batch.ncols; j++)
+	row[j].isNull = 0;
+
+    switch (options.option) {
+    case O_COUNT:
+	row[0].i = v->count1;
+	break;
+    case O_SIDES:
+	/* more areas or no boundary: null, no area/cat: -1 */
+	row[0].isNull = v->count1 != 1;
+	row[0].i = v->i1 >= 0 ? v->i1 : -1;
+	row[1].isNull = v->count2 != 1;
+	row[1].i = v->i2 >= 0 ? v->i2 : -1;
+	break;
+    case O_QUERY:
+	row[0].isNull = v->null;
+	if (batch.ctypes[0] == DB_C_TYPE_INT)
+	    row[0].i = v->i1;
+	else if (batch.ctypes[0] == DB_C_TYPE_DOUBLE)
+	    row[0].d = v->d1;
+	else
+	    db_set_string(&row[0].s, v->null ? "" : v->str1);
+	break;
+    default:
+	row[0].d = v->d1;
+	if (batch.ncols > 1)
+	    row[1].d = v->d2;
+	if (batch.ncols > 2)
+	    row[2].d = v->d3;
+	if (batch.ncols > 3)
+	    row[3].d = v->d4;
+	break;
+    }
+}
+
+static void batch_flush(dbDriver *driver, struct field_info *Fi)
+{
+    int nupdated;
+
+    if (batch.nrows == 0)
+	return;
+
+    if (db_update_values(driver, Fi->table, Fi->key, batch.ncols,
+			 batch.columns, batch.ctypes, batch.nrows, batch.keys,
+			 batch.values, &nupdated) != DB_OK) {
+	G_warning(_("Cannot update table <%s>"), Fi->table);
+	nupdated = 0;
+    }
+    vstat.update += nupdated;
+    vstat.error += batch.nrows - nupdated;
+    batch.nrows = 0;
+}
+
+static void batch_free(void)
+{
+    int j;
+
+    for (j = 0; j < batch.ncols; j++)
+	db_free_string(&batch.columns[j]);
+    for (j = 0; j < BATCH_SIZE * batch.ncols; j++)
+	db_free_string(&batch.values[j].s);
+    G_free(batch.values);
+    G_free(batch.keys);
+}
+
 int update(struct Map_info *Map)
 {
     int i, *catexst, *cex, upd, fcat;
@@ -51,6 +181,8 @@ int update(struct Map_info *Map)
     db_set_error_handler_driver(driver);
 
     db_begin_transaction(driver);
+    if (options.option != O_CAT && !options.sql)
+	batch_init();
 
     /* select existing categories (layer) to array (array is sorted) */
     vstat.select = db_select_int(driver, Fi->table, Fi->key, NULL, &catexst);
@@ -271,6 +403,12 @@ int update(struct Map_info *Map)
 	    if (options.sql) {
 		fprintf(stdout, "%s\n", db_get_string(&stmt));
 	    }
+	    else if (options.option != O_CAT) {
+		/* updates are sent to the driver in batches */
+		batch_add(i);
+		if (batch.nrows == BATCH_SIZE)
+		    batch_flush(driver, Fi);
+	    }
 	    else {
 		if (db_execute_immediate(driver, &stmt) == DB_OK) {
 		    vstat.update++;
@@ -285,6 +423,11 @@ int update(struct Map_info *Map)
     }
     G_percent(1, 1, 1);
 
+    if (options.option != O_CAT && !options.sql) {
+	batch_flush(driver, Fi);
+	batch_free();
+    }
+
     db_commit_transaction(driver);
 
     G_free(catexst);
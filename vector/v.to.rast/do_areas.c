@@ -16,6 +16,10 @@ static struct list
 
 static int nareas;
 
+/* areas plotted together */
+#define BLOCK_AREAS  1024
+#define BLOCK_POINTS (1 << 20)
+
 /* function prototypes */
 static int compare(const void *, const void *);
 
@@ -27,10 +31,15 @@ int do_areas(struct Map_info *Map, struct line_pnts *Points,
     int i;
     CELL cval, cat;
     DCELL dval;
+    struct poly_block blk;
 
     if (nareas <= 0)
 	return 0;
 
+    blk.polys = NULL;
+    blk.n = blk.alloc = 0;
+    blk.npoints = 0;
+
     G_important_message(_("Reading areas..."));
     for (i = 0; i < nareas; i++) {
 	/* Note: in old version (grass5.0) there was a check here if the current area 
@@ -77,12 +86,16 @@ int do_areas(struct Map_info *Map, struct line_pnts *Points,
 
 	if (Vect_get_area_points(Map, list[i].index, Points) <= 0) {
 	    G_warning(_("Get area %d failed"), list[i].index);
+	    free_polygons(&blk);
 	    return -1;
 	}
 
-	if (G_plot_polygon(Points->x, Points->y, Points->n_points) != 0)
-	    G_warning(_("Failed to plot polygon"));
+	add_polygon(&blk, Points);
+	if (blk.n >= BLOCK_AREAS || blk.npoints >= BLOCK_POINTS)
+	    plot_polygons(&blk);
     }
+    plot_polygons(&blk);
+    free_polygons(&blk);
     G_percent(1, 1, 1);
     
     return nareas;
@@ -21,6 +21,23 @@
 #define USE_Z     4
 #define USE_D     5
 
+/* areas plotted together */
+struct poly
+{
+    struct line_pnts *Points;
+    CELL cat;
+    DCELL dcat;
+    char isnull;
+    int failed;
+};
+
+struct poly_block
+{
+    struct poly *polys;
+    int n, alloc;
+    long npoints;
+};
+
 
 /* do_areas.c */
 int do_areas(struct Map_info *, struct line_pnts *, dbCatValArray *, int,
@@ -40,6 +57,9 @@ int begin_rasterization(int, int, int);
 int output_raster(int);
 int set_cat(CELL);
 int set_dcat(DCELL);
+void add_polygon(struct poly_block *, const struct line_pnts *);
+void plot_polygons(struct poly_block *);
+void free_polygons(struct poly_block *);
 
 /* support.c */
 int update_hist(const char *, const char *, long);
@@ -32,7 +32,7 @@ int main(int argc, char *argv[])
     struct GModule *module;
     struct Option *input, *output, *memory, *col, *use_opt, *val_opt,
 		  *field_opt, *type_opt, *where_opt, *cats_opt,
-	          *rgbcol_opt, *label_opt;
+	          *rgbcol_opt, *label_opt, *nprocs_opt;
     struct Flag *dense_flag;
     int cache_mb, use, value_type, type;
     double value;
@@ -122,9 +122,13 @@ int main(int argc, char *argv[])
     dense_flag->description = _("All cells touched by the line will be set, "
                                 "not only those on the render path");
 
+    nprocs_opt = G_define_standard_option(G_OPT_M_NPROCS);
+
     if (G_parser(argc, argv))
 	exit(EXIT_FAILURE);
 
+    G_set_nprocs(nprocs_opt);
+
     type = Vect_option_to_types(type_opt);
 
     cache_mb = atoi(memory->answer);
@@ -1,6 +1,8 @@
+#include <math.h>
 #include <grass/gis.h>
 #include <grass/raster.h>
 #include <grass/vector.h>
+#include <grass/glocale.h>
 #include "local.h"
 
 
@@ -31,6 +33,7 @@ static int dcell_dot(int, int);
 static int cont(int, int);
 static int move(int, int);
 static int (*dot) (int, int);
+static void fill_rows(int, int, void *);
 
 
 int begin_rasterization(int cache_mb, int f, int do_dense)
@@ -244,3 +247,257 @@ static int dcell_dot(int x, int y)
 
     return 0;
 }
+
+/* Areas are added to a block with the current value and plotted
+ * together. With workers and not in lat-long, the rows of the page
+ * are split in bands and each thread fills the polygons of the block
+ * in its band, in the order of the block, with the scan line algorithm
+ * of G_plot_polygon(): the cells are the same as if the polygons were
+ * plotted one by one. */
+void add_polygon(struct poly_block *blk, const struct line_pnts *Points)
+{
+    struct poly *p;
+
+    if (blk->n == blk->alloc) {
+	int i;
+
+	blk->alloc += 256;
+	blk->polys = G_realloc(blk->polys, blk->alloc * sizeof(struct poly));
+	for (i = blk->n; i < blk->alloc; i++)
+	    blk->polys[i].Points = Vect_new_line_struct();
+    }
+    p = &blk->polys[blk->n++];
+    Vect_reset_line(p->Points);
+    Vect_append_points(p->Points, Points, GV_FORWARD);
+    p->cat = cat;
+    p->dcat = dcat;
+    p->isnull = isnull;
+    p->failed = 0;
+    blk->npoints += Points->n_points;
+}
+
+void plot_polygons(struct poly_block *blk)
+{
+    int i;
+
+    if (blk->n == 0)
+	return;
+
+    if (G_num_workers() > 0 && page.proj != PROJECTION_LL)
+	G_parallel_for(0, page.rows, 0, fill_rows, blk);
+    else {
+	for (i = 0; i < blk->n; i++) {
+	    struct poly *p = &blk->polys[i];
+
+	    cat = p->cat;
+	    dcat = p->dcat;
+	    isnull = p->isnull;
+	    if (G_plot_polygon(p->Points->x, p->Points->y,
+			       p->Points->n_points) != 0)
+		p->failed = 1;
+	}
+    }
+
+    for (i = 0; i < blk->n; i++) {
+	if (blk->polys[i].failed)
+	    G_warning(_("Failed to plot polygon"));
+    }
+    blk->n = 0;
+    blk->npoints = 0;
+}
+
+void free_polygons(struct poly_block *blk)
+{
+    int i;
+
+    for (i = 0; i < blk->alloc; i++)
+	Vect_destroy_line_struct(blk->polys[i].Points);
+    G_free(blk->polys);
+}
+
+/* crossing of an edge with the center of a row */
+struct crossing
+{
+    double x;
+    int y;
+};
+
+struct crossings
+{
+    struct crossing *P;
+    int np, npalloc;
+};
+
+static int ifloor(double x)
+{
+    int i;
+
+    i = (int)x;
+    if (i > x)
+	i--;
+    return i;
+}
+
+static int iceil(double x)
+{
+    int i;
+
+    i = (int)x;
+    if (i < x)
+	i++;
+    return i;
+}
+
+/* as edge() of lib/gis/plot.c for the rows first to last - 1 */
+static void edge(struct crossings *c, double x0, double y0, double x1,
+		 double y1, int first, int last)
+{
+    double m, d;
+    double x;
+    int ystart, ystop;
+    int exp;
+
+    /* tolerance to avoid FPE */
+    d = GRASS_EPSILON;
+    if (y0 != y1) {
+	if (fabs(y0) > fabs(y1))
+	    d = fabs(y0);
+	else
+	    d = fabs(y1);
+
+	d = frexp(d, &exp);
+	exp -= 53;
+	d = ldexp(d, exp);
+    }
+
+    if (fabs(y0 - y1) < d)
+	return;
+
+    if (y0 < y1) {
+	ystart = iceil(y0);
+	ystop = ifloor(y1);
+	if (ystop == y1)
+	    ystop--;		/* if line stops at row center, don't include point */
+    }
+    else {
+	ystart = iceil(y1);
+	ystop = ifloor(y0);
+	if (ystop == y0)
+	    ystop--;		/* if line stops at row center, don't include point */
+    }
+
+    if (ystart > ystop)
+	return;			/* does not cross center line of row */
+
+    m = (x0 - x1) / (y0 - y1);
+    x = m * (ystart - y0) + x0;
+    while (ystart <= ystop) {
+	if (ystart >= first && ystart < last) {
+	    if (c->np >= c->npalloc) {
+		c->npalloc = c->npalloc > 0 ? c->npalloc * 2 : 32;
+		c->P = G_realloc(c->P, c->npalloc * sizeof(struct crossing));
+	    }
+	    c->P[c->np].x = x;
+	    c->P[c->np++].y = ystart;
+	}
+	ystart++;
+	x += m;
+    }
+}
+
+static int crossing_order(const void *aa, const void *bb)
+{
+    const struct crossing *a = aa, *b = bb;
+
+    if (a->y < b->y)
+	return (-1);
+    if (a->y > b->y)
+	return (1);
+
+    if (a->x < b->x)
+	return (-1);
+    if (a->x > b->x)
+	return (1);
+
+    return (0);
+}
+
+/* fill the polygons of a block in the rows first to last - 1 */
+static void fill_rows(int first, int last, void *closure)
+{
+    struct poly_block *blk = closure;
+    struct crossings c;
+    double left, right, top, bottom, xconv, yconv;
+    int i, j, k, x1, x2;
+
+    /* as G_setup_plot() in configure_plot() */
+    left = -0.5;
+    right = page.cols - 0.5;
+    top = -0.5;
+    bottom = page.rows - 0.5;
+    xconv = (right - left) / (page.east - page.west);
+    yconv = (bottom - top) / (page.north - page.south);
+
+#define X(e) (left + xconv * ((e) - page.west))
+#define Y(n) (top + yconv * (page.north - (n)))
+
+    c.P = NULL;
+    c.np = c.npalloc = 0;
+
+    for (i = 0; i < blk->n; i++) {
+	struct poly *p = &blk->polys[i];
+	const double *x = p->Points->x, *y = p->Points->y;
+	int n = p->Points->n_points;
+	double px0, py0, px1, py1;
+
+	if (n < 3) {
+	    p->failed = 1;
+	    continue;
+	}
+
+	/* traverse the perimeter */
+	c.np = 0;
+	px0 = X(x[n - 1]);
+	py0 = Y(y[n - 1]);
+	for (j = 0; j < n; j++) {
+	    px1 = X(x[j]);
+	    py1 = Y(y[j]);
+	    edge(&c, px0, py0, px1, py1, first, last);
+	    px0 = px1;
+	    py0 = py1;
+	}
+
+	/* sort the edge points by row and then by col */
+	qsort(c.P, c.np, sizeof(struct crossing), crossing_order);
+
+	/* plot */
+	for (j = 1; j < c.np; j += 2) {
+	    int row = c.P[j].y;
+
+	    if (row != c.P[j - 1].y) {
+		p->failed = 1;
+		break;
+	    }
+	    x1 = iceil(c.P[j - 1].x);
+	    x2 = ifloor(c.P[j].x);
+	    if (x1 < 0)
+		x1 = 0;
+	    if (x2 >= page.cols)
+		x2 = page.cols - 1;
+	    for (k = x1; k <= x2; k++) {
+		if (format == CELL_TYPE)
+		    raster.cell[row][k] = p->cat;
+		else
+		    raster.dcell[row][k] = p->dcat;
+		null_flags[row][k] = p->isnull;
+	    }
+	}
+	if (c.np & 1)
+	    p->failed = 1;
+    }
+
+#undef X
+#undef Y
+
+    G_free(c.P);
+}
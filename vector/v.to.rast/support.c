@@ -114,7 +114,7 @@ int update_dbcolors(const char *rast_name, const char *vector_map, int field,
     
     /* get number of records in attr_column */
     if ((nrec =
-	 db_select_CatValArray(Driver, Fi->table, Fi->key, attr_column, NULL,
+	 Vect_select_cat_values(Driver, Fi, attr_column, NULL,
 			       &cvarr)) == -1)
 	G_fatal_error(_("Unknown column <%s> in table <%s>"), attr_column,
 		      Fi->table);
@@ -289,7 +289,7 @@ int update_labels(const char *rast_name, const char *vector_map, int field,
 
 	    /* get number of records in label_column */
 	    if ((nrec =
-		 db_select_CatValArray(Driver, Fi->table, Fi->key,
+		 Vect_select_cat_values(Driver, Fi,
 				       attr_column, NULL, &cvarr)) == -1)
 		G_fatal_error(_("Unknown column <%s> in table <%s>"),
 			      attr_column, Fi->table);
@@ -528,7 +528,7 @@ int update_labels(const char *rast_name, const char *vector_map, int field,
 
 		/* get number of records in label_column */
 		if ((nrec =
-		     db_select_CatValArray(Driver, Fi->table, Fi->key,
+		     Vect_select_cat_values(Driver, Fi,
 					   label_column, NULL, &cvarr)) == -1)
 		    G_fatal_error(_("Unknown column <%s> in table <%s>"),
 				  label_column, Fi->table);
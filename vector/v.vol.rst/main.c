@@ -31,6 +31,9 @@
 #include <math.h>
 #include <string.h>
 #include <unistd.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -49,17 +52,14 @@
 double /* pargr */ xmin, xmax, ymin, ymax, zmin, zmax, wmin, wmax;
 double /* norm */ xmin0, xmax0, ymin0, ymax0, zmin0, zmax0, wmin0, wmax0,
     delt, dnorm;
-double /* MAT */ *A;
 double /* PRISP */ fi, rsm, fstar2, alphat, betat;
 
-double /* out */ *b, *w;
 double /* orig */ x0utm, y0utm, z0utm;
 double /* gcmax */ gmin, gmax, c1min, c1max, c2min, c2max, c3min, c3max;
 double /* gcmax */ a1min, a1max, a2min, a2max;
 float *zero_array1, *zero_array2, *zero_array3, *zero_array4, *zero_array5,
     *zero_array6, *zero_array7;
 int out_cond1, out_cond2;
-double xmn, xmx, ymn, ymx, zmn, zmx;
 double z_orig_in, tb_res_in;
 int cursegm;
 int totsegm;
@@ -89,7 +89,6 @@ double dmin, ertre;
 int nsizr, nsizc, nsizl, KMAX2, KMIN, KMAX, KMAXPOINTS;
 
 /* datgr */
-double *az, *adx, *ady, *adxx, *adyy, *adxy, *adz, *adxz, *adyz, *adzz;
 double ertot, ertre, zminac, zmaxac, wmult, zmult, zminacell, zmaxacell;
 struct octtree *root;
 
@@ -98,8 +97,7 @@ int NPOINT = 0;
 int OUTRANGE = 0;
 int NPT = 0;
 
-double DETERM;
-int NERROR, cond1, cond2;
+int cond1, cond2;
 char fncdsm[32];
 char filnam[10];
 
@@ -112,7 +110,7 @@ int fdcell, fdcout;
    x,y,z - input data
    npoint - number of input data
    fi - tension parameter
-   b - coef. of int. function
+   b - coef. of int. function (per thread, see struct segm_state)
    A - matrix of system of linear equations
    az- interpolated values z for output grid
    adx,ady, ... - estimation of derivatives for output grid
@@ -203,6 +201,7 @@ int main(int argc, char *argv[])
     int max1();
     int min1();
     int npmin;
+    int threads;
     int ii, i, n_rows, n_cols, n_levs;
     double x_orig, y_orig, z_orig;
     char dminchar[64];
@@ -219,7 +218,7 @@ int main(int argc, char *argv[])
 	struct Option *input, *colnum, *scol, *wheresql, *rescalex, *fi,
 	    *segmax, *dmin1, *npmin, *npmax, *wmult, *outz, *rsm, *maskmap, *zmult,
 	    *cvdev, *gradient, *aspect1, *aspect2, *ncurv, *gcurv, *mcurv,
-	    *cellinp, *cellout, *devi;
+	    *cellinp, *cellout, *devi, *threads;
     } parm;
 
     struct
@@ -404,6 +403,9 @@ int main(int argc, char *argv[])
     parm.mcurv->description = _("Name for output mean curvature 3D raster map");
     parm.mcurv->guisection = _("Outputs");
 
+    parm.threads = G_define_standard_option(G_OPT_M_NPROCS);
+    parm.threads->guisection = _("Settings");
+
     flag.cv = G_define_flag();
     flag.cv->key = 'c';
     flag.cv->description =
@@ -472,6 +474,14 @@ int main(int argc, char *argv[])
     if (rsm < 0.0)
 	G_fatal_error(_("Smoothing must be a positive value"));
 
+    threads = G_set_nprocs(parm.threads);
+#if defined(_OPENMP)
+    omp_set_num_threads(threads);
+#else
+    if (threads > 1)
+	G_warning(_("GRASS GIS is not compiled with OpenMP support, parallel computation is disabled."));
+#endif
+
     if (parm.scol->answer)
 	rsm = -1;		/* used in InterpLib to indicate variable smoothing */
 
@@ -504,36 +514,6 @@ int main(int argc, char *argv[])
     KMIN = npmin;
 
     /***************        KMAX2 = GRADPARAM1*npmax;***************/
-    az = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!az)
-	G_fatal_error(_("Not enough memory for %s"), "az");
-    adx = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!adx)
-	G_fatal_error(_("Not enough memory for %s"), "adx");
-    ady = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!ady)
-	G_fatal_error(_("Not enough memory for %s"), "ady");
-    adxx = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!adxx)
-	G_fatal_error(_("Not enough memory for %s"), "adxx");
-    adyy = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!adyy)
-	G_fatal_error(_("Not enough memory for %s"), "adyy");
-    adxy = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!adxy)
-	G_fatal_error(_("Not enough memory for %s"), "adxy");
-    adz = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!adz)
-	G_fatal_error(_("Not enough memory for %s"), "adz");
-    adxz = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!adxz)
-	G_fatal_error(_("Not enough memory for %s"), "adxz");
-    adyz = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!adyz)
-	G_fatal_error(_("Not enough memory for %s"), "adyz");
-    adzz = (double *)G_malloc(sizeof(double) * (n_cols + 1));
-    if (!adzz)
-	G_fatal_error(_("Not enough memory for %s"), "adzz");
 
 
     if ((data =
@@ -821,16 +801,6 @@ int main(int argc, char *argv[])
 	    if (fd4 != NULL)
 		fprintf(fd4, "max. error found = %f \n", ertot);
 	    G_free(root);
-	    G_free(az);
-	    G_free(adx);
-	    G_free(ady);
-	    G_free(adz);
-	    G_free(adxx);
-	    G_free(adyy);
-	    G_free(adxy);
-	    G_free(adxz);
-	    G_free(adyz);
-	    G_free(adzz);
 
 	    OUTGR();
 	    if ((cellinp != NULL)) {
@@ -1,6 +1,30 @@
 #ifndef __USER_H__
 #define __USER_H__
 
+#include <grass/gis.h>
+
+/* state of the thread interpolating a segment */
+struct segm_state
+{
+    struct quadruple *points;	/* points of the segment (KMAX2 + 1) */
+    struct point_3d *point;	/* copy of the points for cv */
+    double *A, *b, *w;		/* system of linear equations */
+    double *w2, *wz1, *wz2;
+    double *az, *adx, *ady, *adz, *adxx, *adyy, *adxy, *adxz, *adyz,
+	*adzz;			/* one row of the segment */
+    float *zero_array1, *zero_array2, *zero_array3, *zero_array4,
+	*zero_array5, *zero_array6, *zero_array7;
+    FCELL *zero_array_cell;
+    const FCELL *cross;		/* cross-section raster, all rows */
+    double xmn, xmx, ymn, ymx, zmn, zmx;	/* segment */
+    /* errors, minima and maxima of the segments of the thread */
+    double ertot;
+    int first_z, first_t;
+    double zminac, zmaxac, zminacell, zmaxacell;
+    double gmin, gmax, a1min, a1max, a2min, a2max;
+    double c1min, c1max, c2min, c2max, c3min, c3max;
+};
+
 int translate_oct();
 int interp_call();
 int INPUT();
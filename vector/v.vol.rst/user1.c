@@ -387,412 +387,131 @@ int INPUT(struct Map_info *In, char *column, char *scol, char *wheresql)
 }
 
 /*
- * OUTGR now writes 3d raster maps (mca 2/15/96)
+ * write_g3d - writes one 3d raster map from its temp file
+ *
+ * The temp file holds the levels bottom up, the rows of each level south
+ * to north. The map is written tile by tile, without the tile cache,
+ * since the whole volume is in memory anyway.
  */
-
-int OUTGR()
+static void write_g3d(const char *name, FILE *fd, float *data, int degrees)
 {
-    void *cf1, *cf2, *cf3, *cf4, *cf5, *cf6, *cf7;
-    int read_val;
-    FCELL *cell;
-    float *data;
-    int i, iarc, cnt;
+    RASTER3D_Map *map;
+    float *tile, value;
+    int tileX, tileY, tileZ, nx, ny, nz, tx, ty, tz, index;
+    int x, y, z, col, row, depth;
     int bmask = 1;
-    int x, y;
-    float value;
+    size_t ncells = (size_t)nsizr * nsizc * nsizl;
 
-    if ((cellinp != NULL) && (cellout != NULL)) {
-	cell = Rast_allocate_f_buf();
-
-	for (i = 0; i < nsizr; i++) {
-	    /* seek to the right row */
-	    G_fseek
-		(Tmp_fd_cell, ((off_t)(nsizr - 1 - i) * nsizc * sizeof(FCELL)),
-		 0);
-	    fread(cell, sizeof(FCELL), nsizc, Tmp_fd_cell);
-	    Rast_put_f_row(fdcout, cell);
-	}
+    map = Rast3d_open_new_opt_tile_size(name, RASTER3D_NO_CACHE,
+					&current_region, FCELL_TYPE, 32);
+    if (map == NULL) {
+	clean();
+	G_fatal_error(_("Unable to open %s for writing"), name);
     }
 
-  /*** Initialize output g3d region ***/
-    current_region.bottom = z_orig_in;
-    current_region.top = nsizl * tb_res_in + z_orig_in;
+    /* seek to the beginning */
+    G_fseek(fd, 0L, 0);
 
-    if (!(data = (float *)G_malloc(sizeof(float) * nsizr * nsizc * nsizl))) {
+    /* Read data in from temp file */
+    if (fread(data, sizeof(float), ncells, fd) != ncells) {
 	clean();
-	G_fatal_error(_("Out of memory"));
+	G_fatal_error(_("Unable to read data from temp file"));
     }
 
-  /*** Write elevation results ***/
-    if (outz != NULL) {
-
-	cf1 = Rast3d_open_new_opt_tile_size(outz, RASTER3D_USE_CACHE_DEFAULT, &current_region, FCELL_TYPE, 32); 
-	if (cf1 == NULL) {
-	    clean();
-	    G_fatal_error(_("Unable to open %s for writing"), outz);
-	}
-
-	/* seek to the beginning */
-	G_fseek(Tmp_fd_z, 0L, 0);
-
-	/* Read data in from temp file */
-	read_val =
-	    fread(data, sizeof(float), nsizr * nsizc * nsizl, Tmp_fd_z);
-	if (read_val < 0) {
-	    clean();
-	    G_fatal_error(_("Unable to read data from temp file"));
-	}
-
-	cnt = 0;
-	for (iarc = 0; iarc < nsizl; iarc++) {
-
-	    for (y = nsizr - 1; y >= 0; y--) {	/* changed by AV */
-		for (x = 0; x < nsizc; x++) {
+    Rast3d_get_tile_dimensions_map(map, &tileX, &tileY, &tileZ);
+    Rast3d_get_nof_tiles_map(map, &nx, &ny, &nz);
+    tile = G_malloc(sizeof(float) * tileX * tileY * tileZ);
+    Rast3d_set_null_value(tile, tileX * tileY * tileZ, FCELL_TYPE);
+
+    for (index = 0; index < nx * ny * nz; index++) {
+	Rast3d_tile_index2tile(map, index, &tx, &ty, &tz);
+	for (z = 0; z < tileZ; z++) {
+	    depth = tz * tileZ + z;
+	    if (depth >= nsizl)
+		break;
+	    for (y = 0; y < tileY; y++) {
+		row = ty * tileY + y;
+		if (row >= nsizr)
+		    break;
+		for (x = 0; x < tileX; x++) {
+		    col = tx * tileX + x;
+		    if (col >= nsizc)
+			break;
 		    if (maskmap != NULL)
-			bmask = BM_get(bitmask, x, nsizr - y - 1);
-		    else
-			bmask = 1;
-		    value = data[cnt];
+			bmask = BM_get(bitmask, col, nsizr - row - 1);
+		    value = data[((size_t)depth * nsizr + nsizr - 1 - row) *
+				 nsizc + col];
+		    if (degrees)
+			value = value * 180 / M_PI;
 		    if (!bmask)
 			Rast3d_set_null_value(&value, 1, FCELL_TYPE);
-		    if (Rast3d_put_float(cf1, x, y, iarc, value) == 0) {
-			clean();
-			G_fatal_error(
-				_("Error writing cell (%d,%d,%d) with value %f"),
-				x, y, iarc, value);
-		    }
-
-		    cnt++;
-
+		    tile[(z * tileY + y) * tileX + x] = value;
 		}
 	    }
 	}
-
-	/* Close the file */
-	if (Rast3d_close(cf1) == 0) {
-	    clean();
-	    G_fatal_error(_("Error closing output file %s"), outz);
-	} else
-            G_message(_("3D raster map <%s> created"), outz);
-    }
-
-  /*** Write out the gradient results ***/
-    if (gradient != NULL) {
-
-	cf2 = Rast3d_open_new_opt_tile_size(gradient, RASTER3D_USE_CACHE_DEFAULT, &current_region, FCELL_TYPE, 32); 
-	if (cf2 == NULL) {
+	if (!Rast3d_write_tile_float(map, index, tile)) {
 	    clean();
-	    G_fatal_error(_("Unable to open %s for writing"), gradient);
+	    G_fatal_error(_("Error writing tile %d of %s"), index, name);
 	}
-
-	/* seek to the beginning */
-	G_fseek(Tmp_fd_dx, 0L, 0);
-
-	/* Read data in from temp file */
-	read_val =
-	    fread(data, sizeof(float), nsizr * nsizc * nsizl, Tmp_fd_dx);
-	if (read_val < 0) {
-	    clean();
-	    G_fatal_error(_("Unable to read data from temp file"));
-	}
-
-	cnt = 0;
-	for (iarc = 0; iarc < nsizl; iarc++) {
-
-	    for (y = nsizr - 1; y >= 0; y--) {	/* changed by AV */
-		for (x = 0; x < nsizc; x++) {
-		    if (maskmap != NULL)
-			bmask = BM_get(bitmask, x, nsizr - y - 1);
-		    else
-			bmask = 1;
-		    value = data[cnt];
-		    if (!bmask)
-			Rast3d_set_null_value(&value, 1, FCELL_TYPE);
-		    if (Rast3d_put_float(cf2, x, y, iarc, value) == 0) {
-			clean();
-			G_fatal_error(
-				_("Error writing cell (%d,%d,%d) with value %f"),
-				x, y, iarc, value);
-		    }
-
-		    cnt++;
-
-		}
-	    }
-	}
-
-	/* Close the file */
-	if (Rast3d_close(cf2) == 0) {
-	    clean();
-	    G_fatal_error(_("Error closing output file %s"), gradient);
-	} else
-            G_message(_("3D raster map <%s> created"), gradient);
-    }
-
-  /*** Write out aspect1 results ***/
-    if (aspect1 != NULL) {
-
-	cf3 = Rast3d_open_new_opt_tile_size(aspect1, RASTER3D_USE_CACHE_DEFAULT, &current_region, FCELL_TYPE, 32); 
-	if (cf3 == NULL) {
-	    clean();
-	    G_fatal_error(_("Unable to open %s for writing"), aspect1);
-	}
-
-	/* seek to the beginning */
-	G_fseek(Tmp_fd_dy, 0L, 0);
-
-	/* Read data in from temp file */
-	read_val =
-	    fread(data, sizeof(float), nsizr * nsizc * nsizl, Tmp_fd_dy);
-	if (read_val < 0) {
-	    clean();
-	    G_fatal_error(_("Unable to read data from temp file"));
-	}
-
-	cnt = 0;
-	for (iarc = 0; iarc < nsizl; iarc++) {
-
-	    for (y = nsizr - 1; y >= 0; y--) {	/* changed by AV */
-		for (x = 0; x < nsizc; x++) {
-		    if (maskmap != NULL)
-			bmask = BM_get(bitmask, x, nsizr - y - 1);
-		    else
-			bmask = 1;
-		    value = data[cnt] * 180 / M_PI;
-		    if (!bmask)
-			Rast3d_set_null_value(&value, 1, FCELL_TYPE);
-		    if (Rast3d_put_float(cf3, x, y, iarc, value) == 0) {
-			clean();
-			G_fatal_error(
-				_("Error writing cell (%d,%d,%d) with value %f"),
-				x, y, iarc, value);
-		    }
-
-		    cnt++;
-
-		}
-	    }
-	}
-
-	/* Close the file */
-	if (Rast3d_close(cf3) == 0) {
-	    clean();
-	    G_fatal_error(_("Error closing output file %s"), aspect1);
-	} else
-            G_message(_("3D raster map <%s> created"), aspect1);
     }
+    G_free(tile);
 
-  /*** Write out aspect2 results ***/
-    if (aspect2 != NULL) {
-
-	cf4 = Rast3d_open_new_opt_tile_size(aspect2, RASTER3D_USE_CACHE_DEFAULT, &current_region, FCELL_TYPE, 32); 
-	if (cf4 == NULL) {
-	    clean();
-	    G_fatal_error(_("Unable to open %s for writing"), aspect2);
-	}
-
-	/* seek to the beginning */
-	G_fseek(Tmp_fd_dz, 0L, 0);
-
-	/* Read data in from temp file */
-	read_val =
-	    fread(data, sizeof(float), nsizr * nsizc * nsizl, Tmp_fd_dz);
-	if (read_val < 0) {
-	    clean();
-	    G_fatal_error(_("Unable to read data from temp file"));
-	}
-
-	cnt = 0;
-	for (iarc = 0; iarc < nsizl; iarc++) {
-
-	    for (y = nsizr - 1; y >= 0; y--) {	/* changed by AV */
-		for (x = 0; x < nsizc; x++) {
-		    if (maskmap != NULL)
-			bmask = BM_get(bitmask, x, nsizr - y - 1);
-		    else
-			bmask = 1;
-		    value = data[cnt] * 180 / M_PI;
-		    if (!bmask)
-			Rast3d_set_null_value(&value, 1, FCELL_TYPE);
-		    if (Rast3d_put_float(cf4, x, y, iarc, value) == 0) {
-			clean();
-			G_fatal_error(
-				_("Error writing cell (%d,%d,%d) with value %f"),
-				x, y, iarc, value);
-		    }
-
-		    cnt++;
-
-		}
-	    }
-	}
-
-	/* Close the file */
-	if (Rast3d_close(cf4) == 0) {
-	    clean();
-	    G_fatal_error(_("Error closing output file %s"), aspect2);
-	} else
-            G_message(_("3D raster map <%s> created"), aspect2);
+    /* Close the file */
+    if (Rast3d_close(map) == 0) {
+	clean();
+	G_fatal_error(_("Error closing output file %s"), name);
     }
+    else
+	G_message(_("3D raster map <%s> created"), name);
+}
 
-  /*** Write out ncurv results ***/
-    if (ncurv != NULL) {
-
-	cf5 = Rast3d_open_new_opt_tile_size(ncurv, RASTER3D_USE_CACHE_DEFAULT, &current_region, FCELL_TYPE, 32); 
-	if (cf5 == NULL) {
-	    clean();
-	    G_fatal_error(_("Unable to open %s for writing"), ncurv);
-	}
-
-	/* seek to the beginning */
-	G_fseek(Tmp_fd_xx, 0L, 0);
-
-	/* Read data in from temp file */
-	read_val =
-	    fread(data, sizeof(float), nsizr * nsizc * nsizl, Tmp_fd_xx);
-	if (read_val < 0) {
-	    clean();
-	    G_fatal_error(_("Unable to read data from temp file"));
-	}
-
-	cnt = 0;
-	for (iarc = 0; iarc < nsizl; iarc++) {
+/*
+ * OUTGR now writes 3d raster maps (mca 2/15/96)
+ */
 
-	    for (y = nsizr - 1; y >= 0; y--) {	/* changed by AV */
-		for (x = 0; x < nsizc; x++) {
-		    if (maskmap != NULL)
-			bmask = BM_get(bitmask, x, nsizr - y - 1);
-		    else
-			bmask = 1;
-		    value = data[cnt];
-		    if (!bmask)
-			Rast3d_set_null_value(&value, 1, FCELL_TYPE);
-		    if (Rast3d_put_float(cf5, x, y, iarc, value) == 0) {
-			clean();
-			G_fatal_error(
-				_("Error writing cell (%d,%d,%d) with value %f"),
-				x, y, iarc, value);
-		    }
+int OUTGR()
+{
+    FCELL *cell;
+    float *data;
+    int i;
 
-		    cnt++;
+    if ((cellinp != NULL) && (cellout != NULL)) {
+	cell = Rast_allocate_f_buf();
 
-		}
-	    }
+	for (i = 0; i < nsizr; i++) {
+	    /* seek to the right row */
+	    G_fseek
+		(Tmp_fd_cell, ((off_t)(nsizr - 1 - i) * nsizc * sizeof(FCELL)),
+		 0);
+	    fread(cell, sizeof(FCELL), nsizc, Tmp_fd_cell);
+	    Rast_put_f_row(fdcout, cell);
 	}
-
-	/* Close the file */
-	if (Rast3d_close(cf5) == 0) {
-	    clean();
-	    G_fatal_error(_("Error closing output file %s"), ncurv);
-	} else
-            G_message(_("3D raster map <%s> created"), ncurv);
     }
 
-  /*** Write out gcurv results ***/
-    if (gcurv != NULL) {
-
-	cf6 = Rast3d_open_new_opt_tile_size(gcurv, RASTER3D_USE_CACHE_DEFAULT, &current_region, FCELL_TYPE, 32); 
-	if (cf6 == NULL) {
-	    clean();
-	    G_fatal_error(_("Unable to open %s for writing"), gcurv);
-	}
-
-	/* seek to the beginning */
-	G_fseek(Tmp_fd_yy, 0L, 0);
-
-	/* Read data in from temp file */
-	read_val =
-	    fread(data, sizeof(float), nsizr * nsizc * nsizl, Tmp_fd_yy);
-	if (read_val < 0) {
-	    clean();
-	    G_fatal_error(_("Unable to read data from temp file"));
-	}
-
-	cnt = 0;
-	for (iarc = 0; iarc < nsizl; iarc++) {
-
-	    for (y = nsizr - 1; y >= 0; y--) {	/* changed by AV */
-		for (x = 0; x < nsizc; x++) {
-		    if (maskmap != NULL)
-			bmask = BM_get(bitmask, x, nsizr - y - 1);
-		    else
-			bmask = 1;
-		    value = data[cnt];
-		    if (!bmask)
-			Rast3d_set_null_value(&value, 1, FCELL_TYPE);
-		    if (Rast3d_put_float(cf6, x, y, iarc, value) == 0) {
-			clean();
-			G_fatal_error(
-				_("Error writing cell (%d,%d,%d) with value %f"),
-				x, y, iarc, value);
-		    }
-
-		    cnt++;
-
-		}
-	    }
-	}
+  /*** Initialize output g3d region ***/
+    current_region.bottom = z_orig_in;
+    current_region.top = nsizl * tb_res_in + z_orig_in;
 
-	/* Close the file */
-	if (Rast3d_close(cf6) == 0) {
-	    clean();
-	    G_fatal_error(_("Error closing output file %s"), gcurv);
-	} else
-            G_message(_("3D raster map <%s> created"), gcurv);
+    if (!(data = (float *)G_malloc(sizeof(float) * nsizr * nsizc * nsizl))) {
+	clean();
+	G_fatal_error(_("Out of memory"));
     }
 
-  /*** Write mcurv results ***/
-    if (mcurv != NULL) {
-
-	cf7 = Rast3d_open_new_opt_tile_size(mcurv, RASTER3D_USE_CACHE_DEFAULT, &current_region, FCELL_TYPE, 32); 
-	if (cf7 == NULL) {
-	    clean();
-	    G_fatal_error(_("Unable to open %s for writing"), mcurv);
-	}
-
-	/* seek to the beginning */
-	G_fseek(Tmp_fd_xy, 0L, 0);
-
-	/* Read data in from temp file */
-	read_val =
-	    fread(data, sizeof(float), nsizr * nsizc * nsizl, Tmp_fd_xy);
-	if (read_val < 0) {
-	    clean();
-	    G_fatal_error(_("Unable to read data from temp file"));
-	}
-
-	cnt = 0;
-	for (iarc = 0; iarc < nsizl; iarc++) {
-
-	    for (y = nsizr - 1; y >= 0; y--) {	/* changed by AV */
-		for (x = 0; x < nsizc; x++) {
-		    if (maskmap != NULL)
-			bmask = BM_get(bitmask, x, nsizr - y - 1);
-		    else
-			bmask = 1;
-		    value = data[cnt];
-		    if (!bmask)
-			Rast3d_set_null_value(&value, 1, FCELL_TYPE);
-		    if (Rast3d_put_float(cf7, x, y, iarc, value) == 0) {
-			clean();
-			G_fatal_error(
-				_("Error writing cell (%d,%d,%d) with value %f"),
-				x, y, iarc, value);
-		    }
-
-		    cnt++;
-
-		}
-	    }
-	}
-
-	/* Close the file */
-	if (Rast3d_close(cf7) == 0) {
-	    clean();
-	    G_fatal_error(_("Error closing output file %s"), mcurv);
-	} else
-            G_message(_("3D raster map <%s> created"), mcurv);
-    }
+  /*** Write the results ***/
+    if (outz != NULL)
+	write_g3d(outz, Tmp_fd_z, data, 0);
+    if (gradient != NULL)
+	write_g3d(gradient, Tmp_fd_dx, data, 0);
+    if (aspect1 != NULL)
+	write_g3d(aspect1, Tmp_fd_dy, data, 1);
+    if (aspect2 != NULL)
+	write_g3d(aspect2, Tmp_fd_dz, data, 1);
+    if (ncurv != NULL)
+	write_g3d(ncurv, Tmp_fd_xx, data, 0);
+    if (gcurv != NULL)
+	write_g3d(gcurv, Tmp_fd_yy, data, 0);
+    if (mcurv != NULL)
+	write_g3d(mcurv, Tmp_fd_xy, data, 0);
 
     G_free(data);
 
@@ -29,7 +29,11 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 #include <grass/gis.h>
+#include <grass/raster.h>
 #include <grass/glocale.h>
 
 #include "oct.h"
@@ -90,227 +94,402 @@ translate_oct(struct octtree *tree, double numberx, double numbery,
 
 
 
-int interp_call(struct octtree *root, struct octtree *tree)
+static int count_segments(struct octtree *tree, struct octtree **leafs)
 {
-    /*    double          xmn,xmx,ymn,ymx,zmn,zmx; */
-    double distx, disty, distz, distxp, distyp, distzp, temp1, temp2, temp3;
-    int i, npt, nptprev, MAXENC, k, j;
-    static struct quadruple *points = NULL;
-    struct point_3d skip_point;
-    struct point_3d *point = NULL;
-    int skip_index, segtest;
-    double xx, yy, zz, ww;
+    int k, n;
 
-    if (tree == NULL)
-	return -1;
-    if (tree->data == NULL)
-	return -1;
+    if (tree == NULL || tree->data == NULL)
+	return 0;
     if (((struct octdata *)(tree->data))->points == NULL) {
+	n = 0;
 	for (k = 0; k < NUMLEAFS; k++)
-	    if (!interp_call(root, tree->leafs[k]))
-		return 0;
-	return 1;
+	    n += count_segments(tree->leafs[k], leafs ? leafs + n : NULL);
+	return n;
     }
-    else {
+    if (leafs)
+	leafs[0] = tree;
 
-	if (!points) {
-	    if (!
-		(points =
-		 (struct quadruple *)G_malloc(sizeof(struct quadruple) *
-					      (KMAX2 + 1)))) {
-		clean();
-		G_fatal_error(_("Not enough memory for %s"), "points");
-	    }
-	}
+    return 1;
+}
 
-	/*           if(!(point=(struct point_3d*)G_malloc(sizeof(struct point_3d)*(KMAX2+1))))
-	   {clean(); G_fatal_error("Not enough memory for points");} */
-
-
-	distx = (((struct octdata *)(tree->data))->n_cols * ew_res) * 0.1;
-	disty = (((struct octdata *)(tree->data))->n_rows * ns_res) * 0.1;
-	distz = (((struct octdata *)(tree->data))->n_levs * tb_res) * 0.1;
-	distxp = 0;
-	distyp = 0;
-	distzp = 0;
-	xmn = ((struct octdata *)(tree->data))->x_orig;
-	xmx = ((struct octdata *)(tree->data))->x_orig +
-	    ((struct octdata *)(tree->data))->n_cols * ew_res;
-	ymn = ((struct octdata *)(tree->data))->y_orig;
-	ymx = ((struct octdata *)(tree->data))->y_orig +
-	    ((struct octdata *)(tree->data))->n_rows * ns_res;
-	zmn = ((struct octdata *)(tree->data))->z_orig;
-	zmx = ((struct octdata *)(tree->data))->z_orig +
-	    ((struct octdata *)(tree->data))->n_levs * tb_res;
-	i = 0;
-	MAXENC = 0;
-	npt = OT_region_data(root, xmn - distx, xmx + distx, ymn - disty,
-			     ymx + disty, zmn - distz, zmx + distz, points,
-			     KMAX2);
-	while ((npt < KMIN) || (npt > KMAX2)) {
-	    if (i >= 70) {
-		fprintf(stderr,
-			"Warning: taking too long to find points for interpolation--please change the region to area where your points are\n");
-		break;
-	    }
-	    i++;
-	    if (npt > KMAX2) {
-		MAXENC = 1;
-		nptprev = npt;
-		temp1 = distxp;
-		distxp = distx;
-		distx = distxp - fabs(distx - temp1) * 0.5;
-		temp2 = distyp;
-		distyp = disty;
-		disty = distyp - fabs(disty - temp2) * 0.5;
-		temp3 = distzp;
-		distzp = distz;
-		distz = distzp - fabs(distz - temp3) * 0.5;
-		/*              npt = OT_region_data (root,xmn-distx,xmx+distx,ymn-disty,
-		   ymx+disty,zmn-distz,zmx+distz,points, KMAX2); */
-	    }
-	    else {
-		nptprev = npt;
-		temp1 = distyp;
-		distyp = disty;
-		temp2 = distxp;
-		distxp = distx;
-		temp3 = distzp;
-		distzp = distz;
-		if (MAXENC) {
-		    disty = fabs(disty - temp1) * 0.5 + distyp;
-		    distx = fabs(distx - temp2) * 0.5 + distxp;
-		    distz = fabs(distz - temp3) * 0.5 + distzp;
-		}
-		else {
-		    distx += distx;
-		    disty += disty;
-		    distz += distz;
-		}
+static void *alloc_row(const char *name, int cond, size_t size)
+{
+    void *row;
 
-		/*`             npt = OT_region_data (root,xmn-distx,xmx+distx,ymn-disty,
-		   ymx+disty,zmn-distz,zmx+distz,points, KMAX2);
-		 */
-	    }			/* end of npt > KMAX2 else */
+    if (!cond)
+	return NULL;
+    if (!(row = G_calloc(nsizc + 1, size))) {
+	clean();
+	G_fatal_error(_("Not enough memory for %s"), name);
+    }
 
-	    npt = OT_region_data(root, xmn - distx, xmx + distx, ymn - disty,
-				 ymx + disty, zmn - distz, zmx + distz,
-				 points, KMAX2);
+    return row;
+}
 
-	}
-	/*fprintf(stderr,"got %d points for interpolation\n",npt); */
-	{
-	    static int first = 1;
+static void init_state(struct segm_state *s)
+{
+    int i;
+
+    G_zero(s, sizeof(struct segm_state));
+    if (!
+	(s->points =
+	 (struct quadruple *)G_malloc(sizeof(struct quadruple) *
+				      (KMAX2 + 1)))) {
+	clean();
+	G_fatal_error(_("Not enough memory for %s"), "points");
+    }
+    if (!
+	(s->point =
+	 (struct point_3d *)G_malloc(sizeof(struct point_3d) *
+				     (KMAX2 + 1)))) {
+	clean();
+	G_fatal_error(_("Not enough memory for %s"), "point");
+    }
+    if (!
+	(s->A =
+	 (double *)G_malloc(sizeof(double) *
+			    ((KMAX2 + 1) * (KMAX2 + 2) + 1)))) {
+	clean();
+	G_fatal_error(_("Cannot allocate A"));
+    }
+    if (!(s->b = (double *)G_malloc(sizeof(double) * (KMAX2 + 2)))) {
+	clean();
+	G_fatal_error(_("Cannot allocate b"));
+    }
+    s->w = G_malloc(sizeof(double) * (KMAX2 + 1));
+    s->w2 = G_malloc(sizeof(double) * (KMAX2 + 1));
+    s->wz1 = G_malloc(sizeof(double) * (KMAX2 + 1));
+    s->wz2 = G_malloc(sizeof(double) * (KMAX2 + 1));
+
+    s->az = alloc_row("az", 1, sizeof(double));
+    s->adx = alloc_row("adx", 1, sizeof(double));
+    s->ady = alloc_row("ady", 1, sizeof(double));
+    s->adz = alloc_row("adz", 1, sizeof(double));
+    s->adxx = alloc_row("adxx", 1, sizeof(double));
+    s->adyy = alloc_row("adyy", 1, sizeof(double));
+    s->adxy = alloc_row("adxy", 1, sizeof(double));
+    s->adxz = alloc_row("adxz", 1, sizeof(double));
+    s->adyz = alloc_row("adyz", 1, sizeof(double));
+    s->adzz = alloc_row("adzz", 1, sizeof(double));
+    s->zero_array1 = alloc_row("zero_array1", outz != NULL, sizeof(float));
+    s->zero_array2 = alloc_row("zero_array2", gradient != NULL, sizeof(float));
+    s->zero_array3 = alloc_row("zero_array3", aspect1 != NULL, sizeof(float));
+    s->zero_array4 = alloc_row("zero_array4", aspect2 != NULL, sizeof(float));
+    s->zero_array5 = alloc_row("zero_array5", ncurv != NULL, sizeof(float));
+    s->zero_array6 = alloc_row("zero_array6", gcurv != NULL, sizeof(float));
+    s->zero_array7 = alloc_row("zero_array7", mcurv != NULL, sizeof(float));
+    s->zero_array_cell = alloc_row("zero_array_cell",
+				   cellinp != NULL && cellout != NULL,
+				   sizeof(FCELL));
+    for (i = 0; i <= KMAX2; i++)
+	s->w[i] = s->w2[i] = s->wz1[i] = s->wz2[i] = 0.;
+
+    s->first_z = s->first_t = 1;
+}
 
-	    if (first) {
-		first = 0;
+static void free_state(struct segm_state *s)
+{
+    G_free(s->points);
+    G_free(s->point);
+    G_free(s->A);
+    G_free(s->b);
+    G_free(s->w);
+    G_free(s->w2);
+    G_free(s->wz1);
+    G_free(s->wz2);
+    G_free(s->az);
+    G_free(s->adx);
+    G_free(s->ady);
+    G_free(s->adz);
+    G_free(s->adxx);
+    G_free(s->adyy);
+    G_free(s->adxy);
+    G_free(s->adxz);
+    G_free(s->adyz);
+    G_free(s->adzz);
+    G_free(s->zero_array1);
+    G_free(s->zero_array2);
+    G_free(s->zero_array3);
+    G_free(s->zero_array4);
+    G_free(s->zero_array5);
+    G_free(s->zero_array6);
+    G_free(s->zero_array7);
+    G_free(s->zero_array_cell);
+}
 
-		if (!
-		    (A =
-		     (double *)G_malloc(sizeof(double) *
-					((KMAX2 + 1) * (KMAX2 + 2) + 1)))) {
-		    clean();
-		    G_fatal_error(_("Cannot allocate A"));
-		}
-		if (!(b = (double *)G_malloc(sizeof(double) * (KMAX2 + 2)))) {
-		    clean();
-		    G_fatal_error(_("Cannot allocate b"));
-		}
-		if (!(w = (double *)G_malloc(sizeof(double) * (KMAX2 + 1)))) {
-		    clean();
-		    G_fatal_error(_("Cannot allocate w"));
-		}
-	    }
+/* rows of the cross-section raster, read once for all the threads */
+static FCELL *read_cross_section(void)
+{
+    FCELL *cross;
+    int row, cols = Rast_window_cols();
+
+    cross = G_malloc(sizeof(FCELL) * (size_t)n_rows_in * cols);
+    for (row = 0; row < n_rows_in; row++)
+	Rast_get_f_row(fdcell, cross + (size_t)row * cols, row);
+
+    return cross;
+}
+
+/* merge the errors, minima and maxima of a thread */
+static void merge_state(const struct segm_state *s, int *first_z,
+			int *first_t)
+{
+    ertot = amax1(ertot, s->ertot);
+    if (!s->first_z) {
+	if (*first_z) {
+	    *first_z = 0;
+	    zminac = s->zminac;
+	    zmaxac = s->zmaxac;
+	    zminacell = s->zminacell;
+	    zmaxacell = s->zmaxacell;
+	}
+	zminac = amin1(zminac, s->zminac);
+	zmaxac = amax1(zmaxac, s->zmaxac);
+	zminacell = amin1(zminacell, s->zminacell);
+	zmaxacell = amax1(zmaxacell, s->zmaxacell);
+    }
+    if (!s->first_t) {
+	if (*first_t) {
+	    *first_t = 0;
+	    gmin = s->gmin;
+	    gmax = s->gmax;
+	    a1min = s->a1min;
+	    a1max = s->a1max;
+	    a2min = s->a2min;
+	    a2max = s->a2max;
+	    c1min = s->c1min;
+	    c1max = s->c1max;
+	    c2min = s->c2min;
+	    c2max = s->c2max;
+	    c3min = s->c3min;
+	    c3max = s->c3max;
 	}
+	gmin = amin1(gmin, s->gmin);
+	gmax = amax1(gmax, s->gmax);
+	a1min = amin1(a1min, s->a1min);
+	a1max = amax1(a1max, s->a1max);
+	a2min = amin1(a2min, s->a2min);
+	a2max = amax1(a2max, s->a2max);
+	c1min = amin1(c1min, s->c1min);
+	c1max = amax1(c1max, s->c1max);
+	c2min = amin1(c2min, s->c2min);
+	c2max = amax1(c2max, s->c2max);
+	c3min = amin1(c3min, s->c3min);
+	c3max = amax1(c3max, s->c3max);
+    }
+}
 
-	/*      if(!(points=(struct quadruple*)G_malloc(sizeof(struct quadruple)*(npt))))
-	   {clean(); G_fatal_error("Not enough memory for points");} */
-	if (!
-	    (point =
-	     (struct point_3d *)G_malloc(sizeof(struct point_3d) * (npt)))) {
-	    clean();
-	    G_fatal_error(_("Not enough memory for %s"), "point");
+/* interpolate one segment (leaf of the tree), return 0 on error */
+static int interp_segment(struct octtree *root, struct octtree *tree,
+			  struct segm_state *s)
+{
+    double distx, disty, distz, distxp, distyp, distzp, temp1, temp2, temp3;
+    int i, npt, nptprev, MAXENC, k, j;
+    struct quadruple *points = s->points;
+    struct point_3d skip_point;
+    struct point_3d *point = s->point;
+    int skip_index, segtest;
+    double xx, yy, zz, ww;
+    double xmn, xmx, ymn, ymx, zmn, zmx;
+
+    distx = (((struct octdata *)(tree->data))->n_cols * ew_res) * 0.1;
+    disty = (((struct octdata *)(tree->data))->n_rows * ns_res) * 0.1;
+    distz = (((struct octdata *)(tree->data))->n_levs * tb_res) * 0.1;
+    distxp = 0;
+    distyp = 0;
+    distzp = 0;
+    xmn = ((struct octdata *)(tree->data))->x_orig;
+    xmx = ((struct octdata *)(tree->data))->x_orig +
+	((struct octdata *)(tree->data))->n_cols * ew_res;
+    ymn = ((struct octdata *)(tree->data))->y_orig;
+    ymx = ((struct octdata *)(tree->data))->y_orig +
+	((struct octdata *)(tree->data))->n_rows * ns_res;
+    zmn = ((struct octdata *)(tree->data))->z_orig;
+    zmx = ((struct octdata *)(tree->data))->z_orig +
+	((struct octdata *)(tree->data))->n_levs * tb_res;
+    s->xmn = xmn;
+    s->xmx = xmx;
+    s->ymn = ymn;
+    s->ymx = ymx;
+    s->zmn = zmn;
+    s->zmx = zmx;
+    i = 0;
+    MAXENC = 0;
+    npt = OT_region_data(root, xmn - distx, xmx + distx, ymn - disty,
+			 ymx + disty, zmn - distz, zmx + distz, points,
+			 KMAX2);
+    while ((npt < KMIN) || (npt > KMAX2)) {
+	if (i >= 70) {
+	    G_warning(_("Taking too long to find points for interpolation - "
+			"please change the region to area where your points are"));
+	    break;
 	}
+	i++;
+	if (npt > KMAX2) {
+	    MAXENC = 1;
+	    nptprev = npt;
+	    temp1 = distxp;
+	    distxp = distx;
+	    distx = distxp - fabs(distx - temp1) * 0.5;
+	    temp2 = distyp;
+	    distyp = disty;
+	    disty = distyp - fabs(disty - temp2) * 0.5;
+	    temp3 = distzp;
+	    distzp = distz;
+	    distz = distzp - fabs(distz - temp3) * 0.5;
+	}
+	else {
+	    nptprev = npt;
+	    temp1 = distyp;
+	    distyp = disty;
+	    temp2 = distxp;
+	    distxp = distx;
+	    temp3 = distzp;
+	    distzp = distz;
+	    if (MAXENC) {
+		disty = fabs(disty - temp1) * 0.5 + distyp;
+		distx = fabs(distx - temp2) * 0.5 + distxp;
+		distz = fabs(distz - temp3) * 0.5 + distzp;
+	    }
+	    else {
+		distx += distx;
+		disty += disty;
+		distz += distz;
+	    }
+	}			/* end of npt > KMAX2 else */
 
-	/* cv stuff */
+	npt = OT_region_data(root, xmn - distx, xmx + distx, ymn - disty,
+			     ymx + disty, zmn - distz, zmx + distz,
+			     points, KMAX2);
+    }
 
-	if (cv) {
-	    for (i = 0; i < npt; i++) {
-		point[i].x = points[i].x;
-		point[i].y = points[i].y;
-		point[i].z = points[i].z;
-		point[i].w = points[i].w;
-	    }
+    /* cv stuff */
 
-	    for (skip_index = 0; skip_index < npt; skip_index++) {
-		segtest = 0;
-		j = 0;
-		xx = point[skip_index].x;
-		yy = point[skip_index].y;
-		zz = point[skip_index].z;
-		ww = point[skip_index].w;
-		if (xx >= xmn && xx <= xmx && yy >= ymn && yy <= ymx &&
-		    zz >= zmn && zz <= zmx) {
-		    segtest = 1;
-		    skip_point.x = point[skip_index].x;
-		    skip_point.y = point[skip_index].y;
-		    skip_point.z = point[skip_index].z;
-		    skip_point.w = point[skip_index].w;
-		    for (k = 0; k < npt; k++) {
-			if (k != skip_index) {
-			    points[j].x = point[k].x;
-			    points[j].y = point[k].y;
-			    points[j].z = point[k].z;
-			    points[j].w = point[k].w;
-			    j++;
-			}
-		    }
-		}		/* segment area test */
-
-		if (segtest == 1)
-		    if (!COGRR1
-			(xmn, ymn, zmn,
-			 ((struct octdata *)(tree->data))->n_rows,
-			 ((struct octdata *)(tree->data))->n_cols,
-			 ((struct octdata *)(tree->data))->n_levs, npt - 1,
-			 points, skip_point)) {
-			fprintf(stderr, "Error in COGRR!\n");
-			return 0;
-		    }
-	    }
+    if (cv) {
+	for (i = 0; i < npt; i++) {
+	    point[i].x = points[i].x;
+	    point[i].y = points[i].y;
+	    point[i].z = points[i].z;
+	    point[i].w = points[i].w;
 	}
 
+	for (skip_index = 0; skip_index < npt; skip_index++) {
+	    segtest = 0;
+	    j = 0;
+	    xx = point[skip_index].x;
+	    yy = point[skip_index].y;
+	    zz = point[skip_index].z;
+	    ww = point[skip_index].w;
+	    if (xx >= xmn && xx <= xmx && yy >= ymn && yy <= ymx &&
+		zz >= zmn && zz <= zmx) {
+		segtest = 1;
+		skip_point.x = point[skip_index].x;
+		skip_point.y = point[skip_index].y;
+		skip_point.z = point[skip_index].z;
+		skip_point.w = point[skip_index].w;
+		for (k = 0; k < npt; k++) {
+		    if (k != skip_index) {
+			points[j].x = point[k].x;
+			points[j].y = point[k].y;
+			points[j].z = point[k].z;
+			points[j].w = point[k].w;
+			j++;
+		    }
+		}
+	    }			/* segment area test */
+
+	    if (segtest == 1)
+		if (!COGRR1
+		    (s, xmn, ymn, zmn,
+		     ((struct octdata *)(tree->data))->n_rows,
+		     ((struct octdata *)(tree->data))->n_cols,
+		     ((struct octdata *)(tree->data))->n_levs, npt - 1,
+		     points, skip_point)) {
+		    G_warning(_("Error in COGRR!"));
+		    return 0;
+		}
+	}
+    }
+    else if (!COGRR1
+	     (s, xmn, ymn, zmn, ((struct octdata *)(tree->data))->n_rows,
+	      ((struct octdata *)(tree->data))->n_cols,
+	      ((struct octdata *)(tree->data))->n_levs, npt, points,
+	      skip_point)) {
+	G_warning(_("Error in COGRR!"));
+	return 0;
+    }
 
+    return 1;
+}
 
-	/* show before to catch 0% */
+/*
+   interp_call() - interpolates the segments (leaves of the tree)
 
-	/*fprintf(stderr,"total segments = %d, Current = %d, npoints = %d\n",totsegm,cursegm+1,npt); */
+   The segments are independent: each thread solves the system of its
+   segment with its own matrices. Writing of the rows into the temp
+   files and of the deviations is serialized, the errors, minima and
+   maxima of the threads are merged at the end.
+ */
+int interp_call(struct octtree *root, struct octtree *tree)
+{
+    struct octtree **leafs;
+    struct segm_state *states;
+    FCELL *cross = NULL;
+    int nsegm, threads, i, first_z, first_t, failed;
+
+    nsegm = count_segments(tree, NULL);
+    leafs = G_malloc(sizeof(struct octtree *) * (nsegm + 1));
+    count_segments(tree, leafs);
+
+#if defined(_OPENMP)
+    threads = omp_get_max_threads();
+#else
+    threads = 1;
+#endif
+    if (threads > nsegm)
+	threads = nsegm > 0 ? nsegm : 1;
+    if (cellinp != NULL && cellout != NULL)
+	cross = read_cross_section();
+    states = G_malloc(sizeof(struct segm_state) * threads);
+    for (i = 0; i < threads; i++) {
+	init_state(&states[i]);
+	states[i].cross = cross;
+    }
 
-	{
-	    G_percent(cursegm, totsegm, 1);
+    G_percent(0, totsegm, 1);
+    failed = 0;
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (i = 0; i < nsegm; i++) {
+	int tid = 0;
+
+#if defined(_OPENMP)
+	tid = omp_get_thread_num();
+#endif
+	if (failed)
+	    continue;
+	if (!interp_segment(root, leafs[i], &states[tid])) {
+#pragma omp atomic write
+	    failed = 1;
+	    continue;
 	}
 
-	if (!cv)
-	    if (!COGRR1
-		(xmn, ymn, zmn, ((struct octdata *)(tree->data))->n_rows,
-		 ((struct octdata *)(tree->data))->n_cols,
-		 ((struct octdata *)(tree->data))->n_levs, npt, points,
-		 skip_point)) {
-		fprintf(stderr, "Error in COGRR!\n");
-		return 0;
-	    }
-
-	/*      G_free (points); */
-
-	/* G_free (A); */
-	/* show after to catch 100% */
-	cursegm++;
-	if (totsegm != 0) {
-	    G_percent(cursegm, totsegm, 1);
+#pragma omp critical (vol_output)
+	{
+	    cursegm++;
+	    if (totsegm != 0)
+		G_percent(cursegm, totsegm, 1);
 	}
+    }
 
-	return 1;
+    first_z = first_t = 1;
+    for (i = 0; i < threads; i++) {
+	merge_state(&states[i], &first_z, &first_t);
+	free_state(&states[i]);
     }
+    G_free(states);
+    G_free(leafs);
+    G_free(cross);
 
-    return 1;
+    return !failed;
 }
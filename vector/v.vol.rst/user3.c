@@ -52,7 +52,7 @@
 #undef hz
 #endif
 
-int secpar_loop(int ngstc, int nszc, int i)
+int secpar_loop(struct segm_state *s, int ngstc, int nszc, int i)
 {
     double dnorm1, ro, dx2, dy2, dz2, grad1, grad2, slp, grad, oor1, oor2,
 	curn, curm, curg, dxy2, dxz2, dyz2;
@@ -60,7 +60,9 @@ int secpar_loop(int ngstc, int nszc, int i)
 	dm1, dm2, dm3, dm4, dm5, dm6, dnorm5;
     double gradmin;
     int bmask = 1;
-    static int first_t = 1;
+    double *adx = s->adx, *ady = s->ady, *adz = s->adz, *adxx = s->adxx,
+	*adyy = s->adyy, *adxy = s->adxy, *adxz = s->adxz, *adyz = s->adyz,
+	*adzz = s->adzz;
 
     ro = M_R2D;
     gradmin = 0.0;
@@ -156,48 +158,48 @@ int secpar_loop(int ngstc, int nszc, int i)
 	    curm = (dm1 + dm2 + dm3 + dm4 + dm5 + dm6) / (3. * (grad2 + 1.));
 	}
 	/*   temp = grad2 + 1.; */
-	if (first_t) {
-	    first_t = 0;
+	if (s->first_t) {
+	    s->first_t = 0;
 	    if (gradient != NULL)
-		gmax = gmin = slp;
+		s->gmax = s->gmin = slp;
 	    if (aspect1 != NULL)
-		a1max = a1min = oor1;
+		s->a1max = s->a1min = oor1;
 	    if (aspect2 != NULL)
-		a2max = a2min = oor2;
+		s->a2max = s->a2min = oor2;
 	    if (ncurv != NULL)
-		c1max = c1min = curn;
+		s->c1max = s->c1min = curn;
 	    if (gcurv != NULL)
-		c2max = c2min = curg;
+		s->c2max = s->c2min = curg;
 	    if (mcurv != NULL)
-		c3max = c3min = curm;
+		s->c3max = s->c3min = curm;
 	}
 
 	if (gradient != NULL) {
-	    gmin = amin1(gmin, slp);
-	    gmax = amax1(gmax, slp);
+	    s->gmin = amin1(s->gmin, slp);
+	    s->gmax = amax1(s->gmax, slp);
 	}
 	if (aspect1 != NULL) {
-	    a1min = amin1(a1min, oor1);
-	    a1max = amax1(a1max, oor1);
+	    s->a1min = amin1(s->a1min, oor1);
+	    s->a1max = amax1(s->a1max, oor1);
 	}
 	if (aspect2 != NULL) {
-	    a2min = amin1(a2min, oor2);
-	    a2max = amax1(a2max, oor2);
+	    s->a2min = amin1(s->a2min, oor2);
+	    s->a2max = amax1(s->a2max, oor2);
 	}
 	if (ncurv != NULL) {
-	    c1min = amin1(c1min, curn);
+	    s->c1min = amin1(s->c1min, curn);
 	    if (curn < 10.)
-		c1max = amax1(c1max, curn);
+		s->c1max = amax1(s->c1max, curn);
 	}
 	if (gcurv != NULL) {
-	    c2min = amin1(c2min, curg);
+	    s->c2min = amin1(s->c2min, curg);
 	    if (curg < 10.)
-		c2max = amax1(c2max, curg);
+		s->c2max = amax1(s->c2max, curg);
 	}
 	if (mcurv != NULL) {
-	    c3min = amin1(c3min, curm);
+	    s->c3min = amin1(s->c3min, curm);
 	    if (curn < 10.)
-		c3max = amax1(c3max, curm);
+		s->c3max = amax1(s->c3max, curm);
 	}
 
 	if (gradient != NULL)
@@ -223,8 +225,8 @@ int secpar_loop(int ngstc, int nszc, int i)
 
 
 int
-COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
-       int n_levs, int n_points, struct quadruple *points,
+COGRR1(struct segm_state *s, double x_or, double y_or, double z_or,
+       int n_rows, int n_cols, int n_levs, int n_points, struct quadruple *points,
        struct point_3d skip_point)
 
 /*C
@@ -233,9 +235,16 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
  */
 {
     int secpar_loop();
-    static double *w2 = NULL;
-    static double *wz2 = NULL;
-    static double *wz1 = NULL;
+    double *A = s->A, *b = s->b, *w = s->w;
+    double *w2 = s->w2, *wz1 = s->wz1, *wz2 = s->wz2;
+    double *az = s->az, *adx = s->adx, *ady = s->ady, *adz = s->adz,
+	*adxx = s->adxx, *adyy = s->adyy, *adxy = s->adxy, *adxz = s->adxz,
+	*adyz = s->adyz, *adzz = s->adzz;
+    float *zero_array1 = s->zero_array1, *zero_array2 = s->zero_array2,
+	*zero_array3 = s->zero_array3, *zero_array4 = s->zero_array4,
+	*zero_array5 = s->zero_array5, *zero_array6 = s->zero_array6,
+	*zero_array7 = s->zero_array7;
+    FCELL *zero_array_cell = s->zero_array_cell;
     double amaxa;
     double stepix, stepiy, stepiz, RO, xx, yy, zz, xg, yg, zg, xx2;
     double wm, dx, dy, dz, dxx, dyy, dxy, dxz, dyz, dzz, h, bmgd1,
@@ -245,11 +254,11 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
     int n1, k1, k2, k, i1, l, l1, n4, n5, m, i;
     int NGST, LSIZE, ngstc, nszc, ngstr, nszr, ngstl, nszl;
     int POINT();
-    int ind, ind1;
-    static int first_time_z = 1;
+    int ind, ind1, NERROR;
+    double DETERM;
     off_t offset, offset1, offset2;
     int bmask = 1;
-    static FCELL *cell = NULL;
+    const FCELL *cell = NULL;
 
     int cond1 = (gradient != NULL) || (aspect1 != NULL) || (aspect2 != NULL);
     int cond2 = (ncurv != NULL) || (gcurv != NULL) || (mcurv != NULL);
@@ -267,28 +276,6 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
     stepiy = ns_res / dnorm;
     stepiz = tb_res / dnorm;
 
-    if (!w2) {
-	if (!(w2 = (double *)G_malloc(sizeof(double) * (KMAX2 + 1)))) {
-	    clean();
-	    G_fatal_error(_("Not enough memory for %s"), "w2");
-	}
-    }
-    if (!wz2) {
-	if (!(wz2 = (double *)G_malloc(sizeof(double) * (KMAX2 + 1)))) {
-	    clean();
-	    G_fatal_error(_("Not enough memory for %s"), "wz2");
-	}
-    }
-    if (!wz1) {
-	if (!(wz1 = (double *)G_malloc(sizeof(double) * (KMAX2 + 1)))) {
-	    clean();
-	    G_fatal_error(_("Not enough memory for %s"), "wz1");
-	}
-    }
-
-    if (cell == NULL)
-	cell = Rast_allocate_f_buf();
-
     for (i = 1; i <= n_points; i++) {
 	points[i - 1].x = (points[i - 1].x - x_or) / dnorm;
 	points[i - 1].y = (points[i - 1].y - y_or) / dnorm;
@@ -377,7 +364,7 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
        SOLVING OF SYSTEM
      */
 
-    if (LINEQS(n1, n1, 1, &NERROR, &DETERM)) {
+    if (LINEQS(A, n1, n1, 1, &NERROR, &DETERM)) {
 
 	for (k = 1; k <= n_points; k++) {
 	    l = n4 + k;
@@ -385,7 +372,7 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
 	}
 	b[n_points + 1] = A[n4];
 
-	POINT(n_points, points, skip_point);
+	POINT(s, n_points, points, skip_point);
 	if (cv)
 	    return 1;
 	if (devi != NULL && sig1 == 1)
@@ -425,7 +412,7 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
 		    w2[m] = wm * wm;
 		}
 		if ((cellinp != NULL) && (cellout != NULL) && (i == ngstl))
-		    Rast_get_f_row(fdcell, cell, n_rows_in - k);
+		    cell = s->cross + (size_t)(n_rows_in - k) * Rast_window_cols();
 
 		for (l = ngstc; l <= nszc; l++) {
 		    LSIZE = LSIZE + 1;
@@ -496,24 +483,25 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
 			    (i == ngstl))
 			    wwcell = hcell + wmin;
 			az[l] = ww;
-			if (first_time_z) {
-			    first_time_z = 0;
-			    zmaxac = zminac = ww;
+			if (s->first_z) {
+			    s->first_z = 0;
+			    s->zmaxac = s->zminac = ww;
 			    if ((cellinp != NULL) && (cellout != NULL) &&
 				(i == ngstl))
-				zmaxacell = zminacell = wwcell;
+				s->zmaxacell = s->zminacell = wwcell;
 			}
-			zmaxac = amax1(ww, zmaxac);
-			zminac = amin1(ww, zminac);
+			s->zmaxac = amax1(ww, s->zmaxac);
+			s->zminac = amin1(ww, s->zminac);
 			if ((cellinp != NULL) && (cellout != NULL) &&
 			    (i == ngstl)) {
-			    zmaxacell = amax1(wwcell, zmaxacell);
-			    zminacell = amin1(wwcell, zminacell);
+			    s->zmaxacell = amax1(wwcell, s->zmaxacell);
+			    s->zminacell = amin1(wwcell, s->zminacell);
 			}
 			if ((ww > wmax + 0.1 * (wmax - wmin))
 			    || (ww < wmin - 0.1 * (wmax - wmin))) {
 			    static int once = 0;
 
+#pragma omp critical (vol_output)
 			    if (!once) {
 				once = 1;
 				fprintf(stderr, "WARNING:\n");
@@ -543,7 +531,7 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
 			(aspect2 != NULL)
 			|| (ncurv != NULL) || (gcurv != NULL) ||
 			(mcurv != NULL))
-			if (!(secpar_loop(ngstc, nszc, l))) {
+			if (!(secpar_loop(s, ngstc, nszc, l))) {
 			    clean();
 			    G_fatal_error(_("Secpar_loop failed"));
 			}
@@ -577,100 +565,102 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
 		ind1 = ngstc - 1;
 		offset2 = offset + ind;	/* rows*cols offset */
 
-		if ((cellinp != NULL) && (cellout != NULL) && (i == ngstl)) {
-		    G_fseek(Tmp_fd_cell, ((off_t)ind * sizeof(FCELL)), 0);
-		    if (!
-			(fwrite
-			 (zero_array_cell + ind1, sizeof(FCELL),
-			  nszc - ngstc + 1, Tmp_fd_cell))) {
-			clean();
-			G_fatal_error
-			    (_("Not enough disk space--cannot write files"));
+#pragma omp critical (vol_output)
+		{
+		    if ((cellinp != NULL) && (cellout != NULL) && (i == ngstl)) {
+			G_fseek(Tmp_fd_cell, ((off_t)ind * sizeof(FCELL)), 0);
+			if (!
+			    (fwrite
+			     (zero_array_cell + ind1, sizeof(FCELL),
+			      nszc - ngstc + 1, Tmp_fd_cell))) {
+			    clean();
+			    G_fatal_error
+				(_("Not enough disk space--cannot write files"));
+			}
 		    }
-		}
-		if (outz != NULL) {
-		    G_fseek(Tmp_fd_z, (off_t)(offset2 * sizeof(float)), 0);
-		    if (!
-			(fwrite
-			 (zero_array1 + ind1, sizeof(float), nszc - ngstc + 1,
-			  Tmp_fd_z))) {
-			clean();
-			G_fatal_error
-			    (_("Not enough disk space--cannot write files"));
+		    if (outz != NULL) {
+			G_fseek(Tmp_fd_z, (off_t)(offset2 * sizeof(float)), 0);
+			if (!
+			    (fwrite
+			     (zero_array1 + ind1, sizeof(float), nszc - ngstc + 1,
+			      Tmp_fd_z))) {
+			    clean();
+			    G_fatal_error
+				(_("Not enough disk space--cannot write files"));
+			}
 		    }
-		}
-		if (gradient != NULL) {
-		    G_fseek(Tmp_fd_dx, (off_t)(offset2 * sizeof(float)), 0);
-		    if (!
-			(fwrite
-			 (zero_array2 + ind1, sizeof(float), nszc - ngstc + 1,
-			  Tmp_fd_dx))) {
-			clean();
-			G_fatal_error
-			    (_("Not enough disk space--cannot write files"));
+		    if (gradient != NULL) {
+			G_fseek(Tmp_fd_dx, (off_t)(offset2 * sizeof(float)), 0);
+			if (!
+			    (fwrite
+			     (zero_array2 + ind1, sizeof(float), nszc - ngstc + 1,
+			      Tmp_fd_dx))) {
+			    clean();
+			    G_fatal_error
+				(_("Not enough disk space--cannot write files"));
+			}
 		    }
-		}
-		if (aspect1 != NULL) {
-		    G_fseek(Tmp_fd_dy, (off_t)(offset2 * sizeof(float)), 0);
-		    if (!
-			(fwrite
-			 (zero_array3 + ind1, sizeof(float), nszc - ngstc + 1,
-			  Tmp_fd_dy))) {
-			clean();
-			G_fatal_error
-			    (_("Not enough disk space--cannot write files"));
+		    if (aspect1 != NULL) {
+			G_fseek(Tmp_fd_dy, (off_t)(offset2 * sizeof(float)), 0);
+			if (!
+			    (fwrite
+			     (zero_array3 + ind1, sizeof(float), nszc - ngstc + 1,
+			      Tmp_fd_dy))) {
+			    clean();
+			    G_fatal_error
+				(_("Not enough disk space--cannot write files"));
+			}
 		    }
-		}
-		if (aspect2 != NULL) {
-		    G_fseek(Tmp_fd_dz, (off_t)(offset2 * sizeof(float)), 0);
-		    if (!
-			(fwrite
-			 (zero_array4 + ind1, sizeof(float), nszc - ngstc + 1,
-			  Tmp_fd_dz))) {
-			clean();
-			G_fatal_error
-			    (_("Not enough disk space--cannot write files"));
+		    if (aspect2 != NULL) {
+			G_fseek(Tmp_fd_dz, (off_t)(offset2 * sizeof(float)), 0);
+			if (!
+			    (fwrite
+			     (zero_array4 + ind1, sizeof(float), nszc - ngstc + 1,
+			      Tmp_fd_dz))) {
+			    clean();
+			    G_fatal_error
+				(_("Not enough disk space--cannot write files"));
+			}
 		    }
-		}
-		if (ncurv != NULL) {
-		    G_fseek(Tmp_fd_xx, (off_t)(offset2 * sizeof(float)), 0);
-		    if (!
-			(fwrite
-			 (zero_array5 + ind1, sizeof(float), nszc - ngstc + 1,
-			  Tmp_fd_xx))) {
-			clean();
-			G_fatal_error
-			    (_("Not enough disk space--cannot write files"));
+		    if (ncurv != NULL) {
+			G_fseek(Tmp_fd_xx, (off_t)(offset2 * sizeof(float)), 0);
+			if (!
+			    (fwrite
+			     (zero_array5 + ind1, sizeof(float), nszc - ngstc + 1,
+			      Tmp_fd_xx))) {
+			    clean();
+			    G_fatal_error
+				(_("Not enough disk space--cannot write files"));
+			}
 		    }
-		}
-		if (gcurv != NULL) {
-		    G_fseek(Tmp_fd_yy, (off_t)(offset2 * sizeof(float)), 0);
-		    if (!
-			(fwrite
-			 (zero_array6 + ind1, sizeof(float), nszc - ngstc + 1,
-			  Tmp_fd_yy))) {
-			clean();
-			G_fatal_error
-			    (_("Not enough disk space--cannot write files"));
+		    if (gcurv != NULL) {
+			G_fseek(Tmp_fd_yy, (off_t)(offset2 * sizeof(float)), 0);
+			if (!
+			    (fwrite
+			     (zero_array6 + ind1, sizeof(float), nszc - ngstc + 1,
+			      Tmp_fd_yy))) {
+			    clean();
+			    G_fatal_error
+				(_("Not enough disk space--cannot write files"));
+			}
 		    }
-		}
-		if (mcurv != NULL) {
-		    G_fseek(Tmp_fd_xy, (off_t)(offset2 * sizeof(float)), 0);
-		    if (!
-			(fwrite
-			 (zero_array7 + ind1, sizeof(float), nszc - ngstc + 1,
-			  Tmp_fd_xy))) {
-			clean();
-			G_fatal_error
-			    (_("Not enough disk space--cannot write files"));
+		    if (mcurv != NULL) {
+			G_fseek(Tmp_fd_xy, (off_t)(offset2 * sizeof(float)), 0);
+			if (!
+			    (fwrite
+			     (zero_array7 + ind1, sizeof(float), nszc - ngstc + 1,
+			      Tmp_fd_xy))) {
+			    clean();
+			    G_fatal_error
+				(_("Not enough disk space--cannot write files"));
+			}
 		    }
 		}
-
 	    }
 	}
     }				/* falls here if LINEQS() returns 0 */
     /*    total++; */
-    /*fprintf(stderr,"wminac=%lf,wmaxac=%lf\n",zminac,zmaxac); */
+    /*fprintf(stderr,"wminac=%lf,wmaxac=%lf\n",s->zminac,s->zmaxac); */
     return 1;
 
 }
@@ -678,7 +668,7 @@ COGRR1(double x_or, double y_or, double z_or, int n_rows, int n_cols,
 
 
 
-int POINT(int n_points, struct quadruple *points, struct point_3d skip_point)
+int POINT(struct segm_state *s, int n_points, struct quadruple *points, struct point_3d skip_point)
 
 /*
    c  interpolation check of z-values in given points
@@ -688,6 +678,9 @@ int POINT(int n_points, struct quadruple *points, struct point_3d skip_point)
     double errmax, h, xx, yy, r2, hz, zz, ww, err, xmm, ymm,
 	zmm, wmm, r, etar;
     int n1, mm, m, mmax, inside;
+    double *b = s->b;
+    double xmn = s->xmn, xmx = s->xmx, ymn = s->ymn, ymx = s->ymx,
+	zmn = s->zmn, zmx = s->zmx;
 
     errmax = .0;
     n1 = n_points + 1;
@@ -722,8 +715,10 @@ int POINT(int n_points, struct quadruple *points, struct point_3d skip_point)
 		inside = 1;
 	    else
 		inside = 0;
-	    if (devi != NULL && inside == 1)
+	    if (devi != NULL && inside == 1) {
+#pragma omp critical (vol_output)
 		point_save(xmm, ymm, zmm, err);
+	    }
 
 	    if (err < 0) {
 		err = -err;
@@ -734,7 +729,7 @@ int POINT(int n_points, struct quadruple *points, struct point_3d skip_point)
 	    }
 	}
 
-	ertot = amax1(errmax, ertot);
+	s->ertot = amax1(errmax, s->ertot);
 	if (errmax > ertre) {
 	    xmm = (points[mmax - 1].x * dnorm) +
 		((struct octdata *)(root->data))->x_orig;
@@ -784,8 +779,10 @@ int POINT(int n_points, struct quadruple *points, struct point_3d skip_point)
 	else
 	    inside = 0;
 
-	if (inside == 1)
+	if (inside == 1) {
+#pragma omp critical (vol_output)
 	    point_save(xmm, ymm, zmm, err);
+	}
 
     }				/* cv */
 
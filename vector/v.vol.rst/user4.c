@@ -277,9 +277,10 @@ void crs_full(double x, double fi, double *crs, double *crsd, double *crsdr2, do
 
 /*********solution of system of lin. equations*********/
 
-int LINEQS(int DIM1, int N1, int N2, int *NERROR, double *DETERM)
+int LINEQS(double *A, int DIM1, int N1, int N2, int *NERROR, double *DETERM)
 /*
    solution of linear equations
+   A ... the matrix, indexed from 1
    dim1 ... # of lines in matrix
    n1   ... # of columns
    n2   ... # of right hand side vectors to be solved
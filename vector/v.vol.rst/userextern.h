@@ -23,13 +23,11 @@ extern char *cvdev;
 
 extern double ns_res, ew_res, tb_res;
 extern struct BM *bitmask;
-extern double *az, *adx, *ady, *adz, *adxx, *adyy, *adxy, *adxz, *adyz, *adzz;
 extern double ertot, ertre, zminac, zmaxac, dmin, wmult, zmult, zminacell,
     zmaxacell;
 
 
-extern double DETERM;
-extern int NERROR, cond1, cond2;
+extern int cond1, cond2;
 
 extern FILE *fdinp, *fdzout, *fd4;
 extern int fdcell, fdcout;
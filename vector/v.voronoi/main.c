@@ -102,7 +102,7 @@ int main(int argc, char **argv)
     int i;
     int **cats, *ncats, nfields, *fields;
     struct {
-	struct Option *in, *out, *field, *smooth, *thin;
+	struct Option *in, *out, *field, *smooth, *thin, *nprocs;
     } opt;
     struct {
 	struct Flag *line, *table, *area, *skeleton;
@@ -116,6 +116,7 @@ int main(int argc, char **argv)
     int ncoor, acoor;
     int line, nlines, type, ctype;
     double thresh;
+    struct sweep sw;
 
     G_gisinit(argv[0]);
 
@@ -150,6 +151,8 @@ int main(int argc, char **argv)
     opt.thin->description = _("Applies only to skeleton extraction. "
                                 "Default = -1 will extract the center line.");
 
+    opt.nprocs = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag.area = G_define_flag();
     flag.area->key = 'a';
     flag.area->description =
@@ -182,6 +185,7 @@ int main(int argc, char **argv)
 	G_warning(_("Option '%s' is too small, set to %g"), opt.smooth->key, segf);
     }
     thresh = atof(opt.thin->answer);
+    G_set_nprocs(opt.nprocs);
     
     skeleton = flag.skeleton->answer;
     if (skeleton)
@@ -203,32 +207,38 @@ int main(int argc, char **argv)
     Box.T = 0.5;
     Box.B = -0.5;
 
-    freeinit(&sfl, sizeof(struct Site));
+    sweep_init(&sw);
+    sw.verbose = 1;
+    sw.output = write_ep;
 
-    G_message(_("Reading features..."));
-    if (in_area || skeleton)
-	readbounds();
-    else
-	readsites();
+    /* the areas of skeletons are read one batch at a time */
+    if (!skeleton) {
+	G_message(_("Reading features..."));
+	if (in_area)
+	    readbounds(&sw);
+	else
+	    readsites(&sw);
+    }
 
     if (Vect_open_new(&Out, opt.out->answer, 0) < 0)
 	G_fatal_error(_("Unable to create vector map <%s>"), opt.out->answer);
 
     Vect_hist_copy(&In, &Out);
     Vect_hist_command(&Out);
-    
-    siteidx = 0;
-    geominit();
-
-    plot = 0;
-    debug = 0;
-
-    G_message(n_("Voronoi triangulation for %d point...",
-                 "Voronoi triangulation for %d points...",
-                 nsites), nsites);
-    voronoi(nextone);
-    G_message(_("Writing edges..."));
-    vo_write();
+
+    if (skeleton) {
+	G_message(_("Extracting skeletons..."));
+	area_skeletons();
+    }
+    else {
+	G_message(n_("Voronoi triangulation for %d point...",
+		     "Voronoi triangulation for %d points...",
+		     sw.nsites), sw.nsites);
+	voronoi(&sw);
+	G_message(_("Writing edges..."));
+	vo_write(&sw);
+	sweep_free(&sw);
+    }
 
     verbose = G_verbose();
     G_set_verbose(0);
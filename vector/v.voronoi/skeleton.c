@@ -1,10 +1,414 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <grass/gis.h>
 #include <grass/vector.h>
 #include <grass/glocale.h>
+#include "sw_defs.h"
 #include "defs.h"
 
+/* number of areas read, processed by several threads and written at once */
+#define BATCH_AREAS 1024
+
+/* segments of the rings of an area, sorted into horizontal strips to
+   test points and skeleton segments against the rings */
+struct strips
+{
+    double ymin, dy;
+    int nstrips;
+    int nsegs;
+    double *seg;		/* x1, y1, x2, y2 of each segment */
+    int *start;			/* first index in list of each strip */
+    int *list;			/* segments of the strips */
+};
+
+struct area_skel
+{
+    int area;
+    struct line_pnts **Rings;	/* outer ring and isles */
+    int nrings, arings;
+    struct line_cats *Cats;
+    struct line_pnts *Points;	/* current edge */
+    struct line_pnts *Skel;	/* skeleton segments as pairs of points */
+    struct strips st;
+};
+
+struct skel_batch
+{
+    struct area_skel *areas;
+    double maxdist;
+};
+
+static int strip_of(const struct strips *st, double y)
+{
+    int s = (y - st->ymin) / st->dy;
+
+    if (s < 0)
+	return 0;
+    if (s >= st->nstrips)
+	return st->nstrips - 1;
+    return s;
+}
+
+static void build_strips(struct strips *st, struct line_pnts **Rings,
+			 int nrings)
+{
+    int r, i, k, n, s, s1, s2;
+    double ymax;
+
+    n = 0;
+    for (r = 0; r < nrings; r++)
+	n += Rings[r]->n_points > 1 ? Rings[r]->n_points - 1 : 0;
+
+    st->nsegs = n;
+    st->seg = G_realloc(st->seg, (n > 0 ? n : 1) * 4 * sizeof(double));
+
+    st->ymin = ymax = Rings[0]->y[0];
+    k = 0;
+    for (r = 0; r < nrings; r++) {
+	struct line_pnts *P = Rings[r];
+
+	for (i = 0; i < P->n_points - 1; i++, k++) {
+	    double *sg = st->seg + 4 * k;
+
+	    sg[0] = P->x[i];
+	    sg[1] = P->y[i];
+	    sg[2] = P->x[i + 1];
+	    sg[3] = P->y[i + 1];
+	    if (st->ymin > P->y[i])
+		st->ymin = P->y[i];
+	    if (ymax < P->y[i])
+		ymax = P->y[i];
+	}
+    }
+
+    st->nstrips = sqrt((double)n) + 1;
+    st->dy = (ymax - st->ymin) / st->nstrips;
+    if (!(st->dy > 0)) {
+	st->dy = 1;
+	st->nstrips = 1;
+    }
+
+    st->start = G_realloc(st->start, (st->nstrips + 1) * sizeof(int));
+    for (s = 0; s <= st->nstrips; s++)
+	st->start[s] = 0;
+
+    /* count, then fill the segments of each strip */
+    for (k = 0; k < n; k++) {
+	double *sg = st->seg + 4 * k;
+
+	s1 = strip_of(st, sg[1] < sg[3] ? sg[1] : sg[3]);
+	s2 = strip_of(st, sg[1] < sg[3] ? sg[3] : sg[1]);
+	for (s = s1; s <= s2; s++)
+	    st->start[s + 1]++;
+    }
+    for (s = 0; s < st->nstrips; s++)
+	st->start[s + 1] += st->start[s];
+
+    st->list = G_realloc(st->list, (st->start[st->nstrips] + 1) * sizeof(int));
+    for (k = 0; k < n; k++) {
+	double *sg = st->seg + 4 * k;
+
+	s1 = strip_of(st, sg[1] < sg[3] ? sg[1] : sg[3]);
+	s2 = strip_of(st, sg[1] < sg[3] ? sg[3] : sg[1]);
+	for (s = s1; s <= s2; s++)
+	    st->list[st->start[s]++] = k;
+    }
+    for (s = st->nstrips; s > 0; s--)
+	st->start[s] = st->start[s - 1];
+    st->start[0] = 0;
+}
+
+/* point inside the outer ring and outside the isles */
+static int point_in_rings(const struct strips *st, double x, double y)
+{
+    int s = strip_of(st, y), i, inside = 0;
+
+    for (i = st->start[s]; i < st->start[s + 1]; i++) {
+	const double *sg = st->seg + 4 * st->list[i];
+
+	if ((sg[1] > y) != (sg[3] > y) &&
+	    x < sg[0] + (y - sg[1]) * (sg[2] - sg[0]) / (sg[3] - sg[1]))
+	    inside = !inside;
+    }
+
+    return inside;
+}
+
+static double orient(double ax, double ay, double bx, double by,
+		     double cx, double cy)
+{
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+/* segments intersect or touch */
+static int segments_meet(const double *p, const double *q)
+{
+    double d1, d2, d3, d4;
+
+    if ((p[0] < p[2] ? p[2] : p[0]) < (q[0] < q[2] ? q[0] : q[2]) ||
+	(q[0] < q[2] ? q[2] : q[0]) < (p[0] < p[2] ? p[0] : p[2]) ||
+	(p[1] < p[3] ? p[3] : p[1]) < (q[1] < q[3] ? q[1] : q[3]) ||
+	(q[1] < q[3] ? q[3] : q[1]) < (p[1] < p[3] ? p[1] : p[3]))
+	return 0;
+
+    d1 = orient(q[0], q[1], q[2], q[3], p[0], p[1]);
+    d2 = orient(q[0], q[1], q[2], q[3], p[2], p[3]);
+    d3 = orient(p[0], p[1], p[2], p[3], q[0], q[1]);
+    d4 = orient(p[0], p[1], p[2], p[3], q[2], q[3]);
+
+    /* collinear segments with overlapping boxes */
+    if (d1 == 0 && d2 == 0)
+	return 1;
+
+    return ((d1 <= 0 && d2 >= 0) || (d1 >= 0 && d2 <= 0)) &&
+	((d3 <= 0 && d4 >= 0) || (d3 >= 0 && d4 <= 0));
+}
+
+static int segment_meets_rings(const struct strips *st, const double *p)
+{
+    int s, s1, s2, i;
+
+    s1 = strip_of(st, p[1] < p[3] ? p[1] : p[3]);
+    s2 = strip_of(st, p[1] < p[3] ? p[3] : p[1]);
+    for (s = s1; s <= s2; s++) {
+	for (i = st->start[s]; i < st->start[s + 1]; i++) {
+	    if (segments_meet(p, st->seg + 4 * st->list[i]))
+		return 1;
+	}
+    }
+
+    return 0;
+}
+
+/* keep the edges of the Voronoi diagram of an area inside the area */
+static int skeleton_edge(struct sweep *sw, struct Edge *e)
+{
+    struct area_skel *a = sw->data;
+    struct line_pnts *P = a->Points;
+    double seg[4];
+
+    if (!edge_points(e, P))
+	return 0;
+
+    seg[0] = P->x[0];
+    seg[1] = P->y[0];
+    seg[2] = P->x[1];
+    seg[3] = P->y[1];
+
+    if (!point_in_rings(&a->st, seg[0], seg[1]))
+	return 0;
+    if (segment_meets_rings(&a->st, seg))
+	return 0;
+
+    Vect_append_points(a->Skel, P, GV_FORWARD);
+
+    return 1;
+}
+
+static void add_ring_sites(struct sweep *sw, struct line_pnts *P,
+			   double maxdist, int id)
+{
+    int i, n;
+    double x, y, dx, dy, l, step, sdist;
+
+    for (i = 0; i < P->n_points - 1; i++) {
+	if (!Vect_point_in_box(P->x[i], P->y[i], 0.0, &Box))
+	    continue;
+
+	x = P->x[i];
+	y = P->y[i];
+	addsite(sw, x, y, 0., id);
+
+	/* densify */
+	if (maxdist > 0) {
+	    dx = P->x[i + 1] - x;
+	    dy = P->y[i + 1] - y;
+	    l = sqrt(dx * dx + dy * dy);
+
+	    if (l > maxdist) {
+		n = ceil(l / maxdist) + 0.5;
+		step = l / n;
+
+		while (--n) {
+		    sdist = (step * n) / l;
+		    addsite(sw, x + sdist * dx, y + sdist * dy, 0., id);
+		}
+	    }
+	}
+    }
+}
+
+static void area_skeleton(struct area_skel *a, double maxdist)
+{
+    struct sweep sw;
+    int r;
+
+    Vect_reset_line(a->Skel);
+
+    sweep_init(&sw);
+    for (r = 0; r < a->nrings; r++)
+	add_ring_sites(&sw, a->Rings[r], maxdist, a->area);
+
+    if (sw.nsites > 2) {
+	sortsites(&sw);
+	build_strips(&a->st, a->Rings, a->nrings);
+
+	sw.output = skeleton_edge;
+	sw.data = a;
+	voronoi(&sw);
+	vo_write(&sw);
+    }
+
+    sweep_free(&sw);
+}
+
+static void skeleton_areas(int first, int last, void *closure)
+{
+    struct skel_batch *b = closure;
+    int i;
+
+    for (i = first; i < last; i++)
+	area_skeleton(&b->areas[i], b->maxdist);
+}
+
+/* maximum distance of the sites along the boundaries */
+static double max_site_dist(void)
+{
+    struct line_pnts *Points;
+    int line, nlines, left, right, n;
+    double l;
+
+    Points = Vect_new_line_struct();
+
+    l = 0;
+    n = 0;
+    nlines = Vect_get_num_lines(&In);
+    for (line = 1; line <= nlines; line++) {
+	if (!Vect_line_alive(&In, line))
+	    continue;
+	if (!(Vect_get_line_type(&In, line) & GV_BOUNDARY))
+	    continue;
+
+	Vect_get_line_areas(&In, line, &left, &right);
+	if (left < 0)
+	    left = Vect_get_isle_area(&In, -left);
+	if (right < 0)
+	    right = Vect_get_isle_area(&In, -right);
+	if (!(left > 0 && Vect_get_area_centroid(&In, left) > 0) &&
+	    !(right > 0 && Vect_get_area_centroid(&In, right) > 0))
+	    continue;
+
+	Vect_read_line(&In, Points, NULL, line);
+	Vect_line_prune(Points);
+
+	l += Vect_line_length(Points);
+	n += Points->n_points;
+    }
+
+    Vect_destroy_line_struct(Points);
+
+    return n > 0 ? segf * l / n : 0;
+}
+
+/* Extract the skeletons of all areas with a centroid
+ *
+ * The skeleton of each area is taken from the Voronoi diagram of the
+ * points along its outer ring and isles only, so that the areas are
+ * independent and processed by several threads. The areas are written
+ * in the order of their ids.
+ */
+int area_skeletons(void)
+{
+    struct area_skel *areas;
+    struct skel_batch batch;
+    struct bound_box abox;
+    int area, nareas, n, i, r, nisles;
+
+    batch.maxdist = max_site_dist();
+    G_verbose_message("Maximum segment length: %g", batch.maxdist);
+
+    areas = G_calloc(BATCH_AREAS, sizeof(struct area_skel));
+    for (i = 0; i < BATCH_AREAS; i++) {
+	areas[i].Cats = Vect_new_cats_struct();
+	areas[i].Points = Vect_new_line_struct();
+	areas[i].Skel = Vect_new_line_struct();
+    }
+    batch.areas = areas;
+
+    nareas = Vect_get_num_areas(&In);
+    for (area = 1; area <= nareas;) {
+
+	/* read the rings of a batch of areas */
+	for (n = 0; area <= nareas && n < BATCH_AREAS; area++) {
+	    struct area_skel *a = &areas[n];
+
+	    G_percent(area, nareas, 2);
+
+	    if (!Vect_area_alive(&In, area) ||
+		Vect_get_area_centroid(&In, area) <= 0)
+		continue;
+
+	    Vect_get_area_box(&In, area, &abox);
+	    if (abox.E < Box.W || abox.W > Box.E ||
+		abox.N < Box.S || abox.S > Box.N)
+		continue;
+
+	    nisles = Vect_get_area_num_isles(&In, area);
+	    if (1 + nisles > a->arings) {
+		a->Rings = G_realloc(a->Rings,
+				     (1 + nisles) * sizeof(struct line_pnts *));
+		for (r = a->arings; r < 1 + nisles; r++)
+		    a->Rings[r] = Vect_new_line_struct();
+		a->arings = 1 + nisles;
+	    }
+	    a->nrings = 1 + nisles;
+
+	    a->area = area;
+	    Vect_get_area_points(&In, area, a->Rings[0]);
+	    Vect_line_prune(a->Rings[0]);
+	    for (r = 0; r < nisles; r++) {
+		Vect_get_isle_points(&In, Vect_get_area_isle(&In, area, r),
+				     a->Rings[r + 1]);
+		Vect_line_prune(a->Rings[r + 1]);
+	    }
+	    Vect_get_area_cats(&In, area, a->Cats);
+	    n++;
+	}
+
+	G_parallel_for(0, n, 1, skeleton_areas, &batch);
+
+	for (i = 0; i < n; i++) {
+	    struct area_skel *a = &areas[i];
+
+	    for (r = 0; r + 1 < a->Skel->n_points; r += 2) {
+		Vect_reset_line(a->Points);
+		Vect_append_point(a->Points, a->Skel->x[r], a->Skel->y[r], 0.0);
+		Vect_append_point(a->Points, a->Skel->x[r + 1],
+				  a->Skel->y[r + 1], 0.0);
+		Vect_write_line(&Out, GV_LINE, a->Points, a->Cats);
+	    }
+	}
+    }
+
+    for (i = 0; i < BATCH_AREAS; i++) {
+	struct area_skel *a = &areas[i];
+
+	for (r = 0; r < a->arings; r++)
+	    Vect_destroy_line_struct(a->Rings[r]);
+	G_free(a->Rings);
+	G_free(a->st.seg);
+	G_free(a->st.start);
+	G_free(a->st.list);
+	Vect_destroy_cats_struct(a->Cats);
+	Vect_destroy_line_struct(a->Points);
+	Vect_destroy_line_struct(a->Skel);
+    }
+    G_free(areas);
+
+    return 0;
+}
+
 static int next_dist(int line, int side, double mf)
 {
     double d, dist, nextdist, totaldist;
@@ -3,14 +3,21 @@
 #define le 0
 #define re 1
 
+struct line_pnts;
+
 struct Freenode
 {
     struct Freenode *nextfree;
 };
+
+/* nodes of one size, allocated in blocks which are released together */
 struct Freelist
 {
     struct Freenode *head;
     int nodesize;
+    int blocksize;		/* nodes per block */
+    void **blocks;
+    int nblocks, ablocks;
 };
 
 
@@ -46,25 +53,33 @@ struct Halfedge
     struct Halfedge *PQnext;
 };
 
-extern int sorted, plot, debug, mode3d;
-extern struct Site *sites;
-extern int nsites;
-extern int siteidx;
-extern int sqrt_nsites;
-extern int nvertices;
-extern struct Freelist sfl;
-extern struct Site *bottomsite;
-extern int nedges;
-extern struct Freelist efl;
-extern double xmin, xmax, ymin, ymax, deltax, deltay;
-extern struct Freelist hfl;
-extern struct Halfedge *ELleftend, *ELrightend;
-extern int ELhashsize;
-extern struct Halfedge **ELhash;
-extern int PQhashsize;
-extern struct Halfedge *PQhash;
-extern int PQcount;
-extern int PQmin;
+/* state of one sweep, independent sweeps can run in parallel */
+struct sweep
+{
+    struct Site *sites;		/* sorted input sites */
+    int nsites, asites;
+    int siteidx;
+    int sqrt_nsites;
+    int nvertices;
+    int nedges;
+    int mode3d;
+    int verbose;		/* report the progress */
+    struct Site *bottomsite;
+    double xmin, xmax, ymin, ymax, deltax, deltay;
+    struct Freelist sfl, efl, hfl;
+    struct Halfedge *ELleftend, *ELrightend;
+    int ELhashsize;
+    struct Halfedge **ELhash;
+    int PQhashsize;
+    struct Halfedge *PQhash;
+    int PQcount;
+    int PQmin;
+
+    /* called for each edge when both end points are known, and for the
+       remaining edges by vo_write() */
+    int (*output)(struct sweep *, struct Edge *);
+    void *data;			/* passed through to output */
+};
 
 /* clean_topo.c */
 int clean_topo(void);
@@ -72,60 +87,66 @@ int clean_topo(void);
 /* skeleton.c */
 int thin_skeleton(double);
 int tie_up(void);
+int area_skeletons(void);
 
 /* sw_edgelist.c */
-int ELinitialize(void);
-struct Halfedge *HEcreate(struct Edge *, int);
+int ELinitialize(struct sweep *);
+struct Halfedge *HEcreate(struct sweep *, struct Edge *, int);
 int ELinsert(struct Halfedge *, struct Halfedge *);
-struct Halfedge *ELgethash(int);
-struct Halfedge *ELleftbnd(struct Point *);
+struct Halfedge *ELgethash(struct sweep *, int);
+struct Halfedge *ELleftbnd(struct sweep *, struct Point *);
 int ELdelete(struct Halfedge *);
 struct Halfedge *ELright(struct Halfedge *);
 struct Halfedge *ELleft(struct Halfedge *);
-struct Site *leftreg(struct Halfedge *);
-struct Site *rightreg(struct Halfedge *);
+struct Site *leftreg(struct sweep *, struct Halfedge *);
+struct Site *rightreg(struct sweep *, struct Halfedge *);
 
 /* sw_geometry.c */
-int geominit(void);
-struct Edge *bisect(struct Site *, struct Site *);
-struct Site *intersect(struct Halfedge *, struct Halfedge *);
+int geominit(struct sweep *);
+struct Edge *bisect(struct sweep *, struct Site *, struct Site *);
+struct Site *intersect(struct sweep *, struct Halfedge *, struct Halfedge *);
 int right_of(struct Halfedge *, struct Point *);
-int endpoint(struct Edge *, int, struct Site *);
+int endpoint(struct sweep *, struct Edge *, int, struct Site *);
 double dist(struct Site *, struct Site *);
-int makevertex(struct Site *);
-int deref(struct Site *);
+int makevertex(struct sweep *, struct Site *);
+int deref(struct sweep *, struct Site *);
 int ref(struct Site *);
 double d_ulp(double);
 
 /* sw_heap.c */
-int PQinsert(struct Halfedge *, struct Site *, double);
-int PQdelete(struct Halfedge *);
-int PQbucket(struct Halfedge *);
-int PQempty(void);
-struct Point PQ_min(void);
-struct Halfedge *PQextractmin(void);
-int PQinitialize(void);
+int PQinsert(struct sweep *, struct Halfedge *, struct Site *, double);
+int PQdelete(struct sweep *, struct Halfedge *);
+int PQbucket(struct sweep *, struct Halfedge *);
+int PQempty(struct sweep *);
+struct Point PQ_min(struct sweep *);
+struct Halfedge *PQextractmin(struct sweep *);
+int PQinitialize(struct sweep *);
 
 /* sw_main.c */
 int scomp(const void *, const void *);
-struct Site *nextone(void);
-int readsites(void);
-int readbounds(void);
+struct Site *nextone(struct sweep *);
+int addsite(struct sweep *, double, double, double, int);
+void sortsites(struct sweep *);
+int readsites(struct sweep *);
+int readbounds(struct sweep *);
 
 /* sw_memory.c */
-int freeinit(struct Freelist *, int);
+int freeinit(struct Freelist *, int, int);
 char *getfree(struct Freelist *);
 int makefree(struct Freenode *, struct Freelist *);
-char *myalloc(unsigned);
+void freerelease(struct Freelist *);
+void sweep_init(struct sweep *);
+void sweep_free(struct sweep *);
 
 /* sw_voronoi.c */
-int voronoi(struct Site *(*)(void));
+int voronoi(struct sweep *);
 
 /* vo_extend.c */
 int extend_line(double, double, double, double, double, double, double,
 		double, double, double *, double *, int);
 
 /* vo_write.c */
-int vo_write(void);
-int write_ep(struct Edge *);
+int vo_write(struct sweep *);
+int edge_points(struct Edge *, struct line_pnts *);
+int write_ep(struct sweep *, struct Edge *);
 
@@ -2,35 +2,32 @@
 #include <grass/gis.h>
 #include "sw_defs.h"
 
-int ntry, totalsearch;
-
-int ELinitialize(void)
+int ELinitialize(struct sweep *sw)
 {
     int i;
 
-    freeinit(&hfl, sizeof(struct Halfedge));
-    ELhashsize = 2 * sqrt_nsites;
-    ELhash = (struct Halfedge **)G_malloc(ELhashsize * sizeof(struct Halfedge *));
-    for (i = 0; i < ELhashsize; i++)
-	ELhash[i] = (struct Halfedge *)NULL;
-    ELleftend = HEcreate((struct Edge *)NULL, 0);
-    ELrightend = HEcreate((struct Edge *)NULL, 0);
-    ELleftend->ELleft = (struct Halfedge *)NULL;
-    ELleftend->ELright = ELrightend;
-    ELrightend->ELleft = ELleftend;
-    ELrightend->ELright = (struct Halfedge *)NULL;
-    ELhash[0] = ELleftend;
-    ELhash[ELhashsize - 1] = ELrightend;
+    sw->ELhashsize = 2 * sw->sqrt_nsites;
+    sw->ELhash = (struct Halfedge **)G_malloc(sw->ELhashsize * sizeof(struct Halfedge *));
+    for (i = 0; i < sw->ELhashsize; i++)
+	sw->ELhash[i] = (struct Halfedge *)NULL;
+    sw->ELleftend = HEcreate(sw, (struct Edge *)NULL, 0);
+    sw->ELrightend = HEcreate(sw, (struct Edge *)NULL, 0);
+    sw->ELleftend->ELleft = (struct Halfedge *)NULL;
+    sw->ELleftend->ELright = sw->ELrightend;
+    sw->ELrightend->ELleft = sw->ELleftend;
+    sw->ELrightend->ELright = (struct Halfedge *)NULL;
+    sw->ELhash[0] = sw->ELleftend;
+    sw->ELhash[sw->ELhashsize - 1] = sw->ELrightend;
 
     return 0;
 }
 
 
-struct Halfedge *HEcreate(struct Edge *e, int pm)
+struct Halfedge *HEcreate(struct sweep *sw, struct Edge *e, int pm)
 {
     struct Halfedge *answer;
 
-    answer = (struct Halfedge *)getfree(&hfl);
+    answer = (struct Halfedge *)getfree(&sw->hfl);
     answer->ELedge = e;
     answer->ELpm = pm;
     answer->PQnext = (struct Halfedge *)NULL;
@@ -51,63 +48,61 @@ int ELinsert(struct Halfedge *lb, struct Halfedge *new)
 }
 
 /* Get entry from hash table, pruning any deleted nodes */
-struct Halfedge *ELgethash(int b)
+struct Halfedge *ELgethash(struct sweep *sw, int b)
 {
     struct Halfedge *he;
 
-    if (b < 0 || b >= ELhashsize)
+    if (b < 0 || b >= sw->ELhashsize)
 	return ((struct Halfedge *)NULL);
-    he = ELhash[b];
+    he = sw->ELhash[b];
     if (he == (struct Halfedge *)NULL || he->ELedge != (struct Edge *)DELETED)
 	return (he);
 
     /* Hash table points to deleted half edge.  Patch as necessary. */
-    ELhash[b] = (struct Halfedge *)NULL;
+    sw->ELhash[b] = (struct Halfedge *)NULL;
     if (--(he->ELrefcnt) == 0)
-	makefree((struct Freenode *)he, &hfl);
+	makefree((struct Freenode *)he, &sw->hfl);
     return ((struct Halfedge *)NULL);
 }
 
-struct Halfedge *ELleftbnd(struct Point *p)
+struct Halfedge *ELleftbnd(struct sweep *sw, struct Point *p)
 {
     int i, bucket;
     struct Halfedge *he;
 
     /* Use hash table to get close to desired halfedge */
-    bucket = (p->x - xmin) / deltax * ELhashsize;
+    bucket = (p->x - sw->xmin) / sw->deltax * sw->ELhashsize;
     if (bucket < 0)
 	bucket = 0;
-    if (bucket >= ELhashsize)
-	bucket = ELhashsize - 1;
-    he = ELgethash(bucket);
+    if (bucket >= sw->ELhashsize)
+	bucket = sw->ELhashsize - 1;
+    he = ELgethash(sw, bucket);
     if (he == (struct Halfedge *)NULL) {
 	for (i = 1; 1; i++) {
-	    if ((he = ELgethash(bucket - i)) != (struct Halfedge *)NULL)
+	    if ((he = ELgethash(sw, bucket - i)) != (struct Halfedge *)NULL)
 		break;
-	    if ((he = ELgethash(bucket + i)) != (struct Halfedge *)NULL)
+	    if ((he = ELgethash(sw, bucket + i)) != (struct Halfedge *)NULL)
 		break;
 	}
-	totalsearch += i;
     }
-    ntry++;
     /* Now search linear list of halfedges for the corect one */
-    if (he == ELleftend || (he != ELrightend && right_of(he, p))) {
+    if (he == sw->ELleftend || (he != sw->ELrightend && right_of(he, p))) {
 	do {
 	    he = he->ELright;
-	} while (he != ELrightend && right_of(he, p));
+	} while (he != sw->ELrightend && right_of(he, p));
 	he = he->ELleft;
     }
     else
 	do {
 	    he = he->ELleft;
-	} while (he != ELleftend && !right_of(he, p));
+	} while (he != sw->ELleftend && !right_of(he, p));
 
     /* Update hash table and reference counts */
-    if (bucket > 0 && bucket < ELhashsize - 1) {
-	if (ELhash[bucket] != (struct Halfedge *)NULL)
-	    ELhash[bucket]->ELrefcnt--;
-	ELhash[bucket] = he;
-	ELhash[bucket]->ELrefcnt++;
+    if (bucket > 0 && bucket < sw->ELhashsize - 1) {
+	if (sw->ELhash[bucket] != (struct Halfedge *)NULL)
+	    sw->ELhash[bucket]->ELrefcnt--;
+	sw->ELhash[bucket] = he;
+	sw->ELhash[bucket]->ELrefcnt++;
     }
     return (he);
 }
@@ -136,16 +131,16 @@ struct Halfedge *ELleft(struct Halfedge *he)
 }
 
 
-struct Site *leftreg(struct Halfedge *he)
+struct Site *leftreg(struct sweep *sw, struct Halfedge *he)
 {
     if (he->ELedge == (struct Edge *)NULL)
-	return (bottomsite);
+	return (sw->bottomsite);
     return (he->ELpm == le ? he->ELedge->reg[le] : he->ELedge->reg[re]);
 }
 
-struct Site *rightreg(struct Halfedge *he)
+struct Site *rightreg(struct sweep *sw, struct Halfedge *he)
 {
     if (he->ELedge == (struct Edge *)NULL)
-	return (bottomsite);
+	return (sw->bottomsite);
     return (he->ELpm == le ? he->ELedge->reg[re] : he->ELedge->reg[le]);
 }
@@ -3,28 +3,32 @@
 #include <grass/gis.h>
 #include "sw_defs.h"
 
-int geominit(void)
+int geominit(struct sweep *sw)
 {
     double sn;
 
-    freeinit(&efl, sizeof(struct Edge));
-    nvertices = 0;
-    nedges = 0;
-    sn = nsites + 4;
-    sqrt_nsites = sqrt(sn);
-    deltay = ymax - ymin;
-    deltax = xmax - xmin;
+    sw->nvertices = 0;
+    sw->nedges = 0;
+    sn = sw->nsites + 4;
+    sw->sqrt_nsites = sqrt(sn);
+    sw->deltay = sw->ymax - sw->ymin;
+    sw->deltax = sw->xmax - sw->xmin;
+
+    /* the nodes are allocated in blocks of sqrt(nsites) */
+    freeinit(&sw->sfl, sizeof(struct Site), sw->sqrt_nsites);
+    freeinit(&sw->efl, sizeof(struct Edge), sw->sqrt_nsites);
+    freeinit(&sw->hfl, sizeof(struct Halfedge), sw->sqrt_nsites);
 
     return 0;
 }
 
 
-struct Edge *bisect(struct Site *s1, struct Site *s2)
+struct Edge *bisect(struct sweep *sw, struct Site *s1, struct Site *s2)
 {
     double dx, dy, adx, ady;
     struct Edge *newedge;
 
-    newedge = (struct Edge *)getfree(&efl);
+    newedge = (struct Edge *)getfree(&sw->efl);
 
     newedge->reg[0] = s1;
     newedge->reg[1] = s2;
@@ -60,8 +64,8 @@ struct Edge *bisect(struct Site *s1, struct Site *s2)
 	newedge->c /= dy;
     }
 
-    newedge->edgenbr = nedges;
-    nedges++;
+    newedge->edgenbr = sw->nedges;
+    sw->nedges++;
     return (newedge);
 }
 
@@ -83,7 +87,7 @@ double d_ulp(double d)
     return d;
 }
 
-struct Site *intersect(struct Halfedge *el1, struct Halfedge *el2)
+struct Site *intersect(struct sweep *sw, struct Halfedge *el1, struct Halfedge *el2)
 {
     struct Edge *e1, *e2, *e;
     struct Halfedge *el;
@@ -132,7 +136,7 @@ struct Site *intersect(struct Halfedge *el1, struct Halfedge *el2)
 	(!right_of_site && el->ELpm == re))
 	return ((struct Site *)NULL);
 
-    v = (struct Site *)getfree(&sfl);
+    v = (struct Site *)getfree(&sw->sfl);
     v->refcnt = 0;
     v->coord.x = xint;
     v->coord.y = yint;
@@ -189,16 +193,16 @@ int right_of(struct Halfedge *el, struct Point *p)
 }
 
 
-int endpoint(struct Edge *e, int lr, struct Site *s)
+int endpoint(struct sweep *sw, struct Edge *e, int lr, struct Site *s)
 {
     e->ep[lr] = s;
     ref(s);
     if (e->ep[re - lr] == (struct Site *)NULL)
 	return -1;
-    write_ep(e);
-    deref(e->reg[le]);
-    deref(e->reg[re]);
-    makefree((struct Freenode *)e, &efl);
+    sw->output(sw, e);
+    deref(sw, e->reg[le]);
+    deref(sw, e->reg[re]);
+    makefree((struct Freenode *)e, &sw->efl);
 
     return 0;
 }
@@ -212,19 +216,19 @@ double dist(struct Site *s, struct Site *t)
     return (sqrt(dx * dx + dy * dy));
 }
 
-int makevertex(struct Site *v)
+int makevertex(struct sweep *sw, struct Site *v)
 {
     v->sitenbr = -1;
-    nvertices++;
+    sw->nvertices++;
     return 0;
 }
 
 
-int deref(struct Site *v)
+int deref(struct sweep *sw, struct Site *v)
 {
     v->refcnt--;
     if (v->refcnt == 0)
-	makefree((struct Freenode *)v, &sfl);
+	makefree((struct Freenode *)v, &sw->sfl);
     return 0;
 }
 
@@ -3,14 +3,14 @@
 #include "sw_defs.h"
 
 
-int PQinsert(struct Halfedge *he, struct Site *v, double offset)
+int PQinsert(struct sweep *sw, struct Halfedge *he, struct Site *v, double offset)
 {
     struct Halfedge *last, *next;
 
     he->vertex = v;
     ref(v);
     he->ystar = v->coord.y + offset;
-    last = &PQhash[PQbucket(he)];
+    last = &sw->PQhash[PQbucket(sw, he)];
     while ((next = last->PQnext) != (struct Halfedge *)NULL &&
 	   (he->ystar > next->ystar ||
 	    (he->ystar == next->ystar && v->coord.x > next->vertex->coord.x)))
@@ -19,82 +19,82 @@ int PQinsert(struct Halfedge *he, struct Site *v, double offset)
     }
     he->PQnext = last->PQnext;
     last->PQnext = he;
-    PQcount++;
+    sw->PQcount++;
     return 0;
 }
 
-int PQdelete(struct Halfedge *he)
+int PQdelete(struct sweep *sw, struct Halfedge *he)
 {
     struct Halfedge *last;
 
     if (he->vertex != (struct Site *)NULL) {
-	last = &PQhash[PQbucket(he)];
+	last = &sw->PQhash[PQbucket(sw, he)];
 	while (last->PQnext != he)
 	    last = last->PQnext;
 	last->PQnext = he->PQnext;
-	PQcount--;
-	deref(he->vertex);
+	sw->PQcount--;
+	deref(sw, he->vertex);
 	he->vertex = (struct Site *)NULL;
     }
     return 0;
 }
 
-int PQbucket(struct Halfedge *he)
+int PQbucket(struct sweep *sw, struct Halfedge *he)
 {
     int bucket;
 
-    bucket = (he->ystar - ymin) / deltay * PQhashsize;
+    bucket = (he->ystar - sw->ymin) / sw->deltay * sw->PQhashsize;
     if (bucket < 0)
 	bucket = 0;
-    if (bucket >= PQhashsize)
-	bucket = PQhashsize - 1;
-    if (bucket < PQmin)
-	PQmin = bucket;
+    if (bucket >= sw->PQhashsize)
+	bucket = sw->PQhashsize - 1;
+    if (bucket < sw->PQmin)
+	sw->PQmin = bucket;
     return (bucket);
 }
 
 
 
-int PQempty(void)
+int PQempty(struct sweep *sw)
 {
-    return (PQcount == 0);
+    return (sw->PQcount == 0);
 }
 
 
-struct Point PQ_min(void)
+struct Point PQ_min(struct sweep *sw)
 {
     struct Point answer;
 
-    while (PQhash[PQmin].PQnext == (struct Halfedge *)NULL) {
-	PQmin++;
+    while (sw->PQhash[sw->PQmin].PQnext == (struct Halfedge *)NULL) {
+	sw->PQmin++;
     }
-    answer.x = PQhash[PQmin].PQnext->vertex->coord.x;
-    answer.y = PQhash[PQmin].PQnext->ystar;
-    answer.z = PQhash[PQmin].PQnext->vertex->coord.z;
+    answer.x = sw->PQhash[sw->PQmin].PQnext->vertex->coord.x;
+    answer.y = sw->PQhash[sw->PQmin].PQnext->ystar;
+    answer.z = sw->PQhash[sw->PQmin].PQnext->vertex->coord.z;
     return (answer);
 }
 
-struct Halfedge *PQextractmin(void)
+struct Halfedge *PQextractmin(struct sweep *sw)
 {
     struct Halfedge *curr;
 
-    curr = PQhash[PQmin].PQnext;
-    PQhash[PQmin].PQnext = curr->PQnext;
-    PQcount--;
+    curr = sw->PQhash[sw->PQmin].PQnext;
+    sw->PQhash[sw->PQmin].PQnext = curr->PQnext;
+    sw->PQcount--;
     return (curr);
 }
 
 
-int PQinitialize(void)
+int PQinitialize(struct sweep *sw)
 {
     int i;
 
-    PQcount = 0;
-    PQmin = 0;
-    PQhashsize = 4 * sqrt_nsites;
-    PQhash = (struct Halfedge *)G_malloc(PQhashsize * sizeof(struct Halfedge));
-    for (i = 0; i < PQhashsize; i++)
-	PQhash[i].PQnext = (struct Halfedge *)NULL;
+    sw->PQcount = 0;
+    sw->PQmin = 0;
+    sw->PQhashsize = 4 * sw->sqrt_nsites;
+    sw->PQhash = (struct Halfedge *)G_malloc(sw->PQhashsize * sizeof(struct Halfedge));
+    for (i = 0; i < sw->PQhashsize; i++)
+	sw->PQhash[i].PQnext = (struct Halfedge *)NULL;
 
     return 0;
 }
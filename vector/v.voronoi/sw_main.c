@@ -8,26 +8,6 @@
 #include "sw_defs.h"
 #include "defs.h"
 
-int sorted, plot, debug, mode3d;
-struct Site *sites;
-int nsites;
-int siteidx;
-int sqrt_nsites;
-int nvertices;
-struct Freelist sfl;
-struct Site *bottomsite;
-int nedges;
-struct Freelist efl;
-double xmin, xmax, ymin, ymax, deltax, deltay;
-struct Freelist hfl;
-struct Halfedge *ELleftend, *ELrightend;
-int ELhashsize;
-struct Halfedge **ELhash;
-int PQhashsize;
-struct Halfedge *PQhash;
-int PQcount;
-int PQmin;
-
 struct Cell_head Window;
 struct bound_box Box;
 struct Map_info In, Out;
@@ -37,8 +17,6 @@ int in_area;
 int skeleton;
 double segf;
 
-int nsites_alloc;
-
 /* sort sites on y, then x, coord */
 int scomp(const void *v1, const void *v2)
 {
@@ -57,13 +35,13 @@ int scomp(const void *v1, const void *v2)
 }
 
 /* return a single in-storage site */
-struct Site *nextone(void)
+struct Site *nextone(struct sweep *sw)
 {
     struct Site *s;
 
-    if (siteidx < nsites) {
-	s = &sites[siteidx];
-	siteidx++;
+    if (sw->siteidx < sw->nsites) {
+	s = &sw->sites[sw->siteidx];
+	sw->siteidx++;
 	return (s);
     }
     else
@@ -71,80 +49,87 @@ struct Site *nextone(void)
 }
 
 /* removes duplicate sites that would break the voronoi alghoritm */
-void removeDuplicates()
+static void removeDuplicates(struct sweep *sw)
 {
     int i, j;
 
     i = j = 1;
-    while (i < nsites)
-	if (mode3d) {
-	    if (sites[i].coord.x == sites[i - 1].coord.x &&
-		sites[i].coord.y == sites[i - 1].coord.y &&
-		sites[i].coord.z == sites[i - 1].coord.z)
+    while (i < sw->nsites)
+	if (sw->mode3d) {
+	    if (sw->sites[i].coord.x == sw->sites[i - 1].coord.x &&
+		sw->sites[i].coord.y == sw->sites[i - 1].coord.y &&
+		sw->sites[i].coord.z == sw->sites[i - 1].coord.z)
 		i++;
 	    else {
 		if (i != j)
-		    sites[j] = sites[i];
+		    sw->sites[j] = sw->sites[i];
 		i++;
 		j++;;
 	    }
 	}
 	else {
-	    if (sites[i].coord.x == sites[i - 1].coord.x &&
-		sites[i].coord.y == sites[i - 1].coord.y)
+	    if (sw->sites[i].coord.x == sw->sites[i - 1].coord.x &&
+		sw->sites[i].coord.y == sw->sites[i - 1].coord.y)
 		i++;
 	    else {
 		if (i != j)
-		    sites[j] = sites[i];
+		    sw->sites[j] = sw->sites[i];
 		i++;
 		j++;;
 	    }
 	}
 
-    if (j != nsites) {
-	nsites = j;
-	sites = (struct Site *)G_realloc(sites, nsites * sizeof(struct Site));
+    if (j != sw->nsites) {
+	sw->nsites = j;
+	sw->sites = (struct Site *)G_realloc(sw->sites, sw->nsites * sizeof(struct Site));
     }
 
 }
 
-int addsite(double x, double y, double z, int id)
+int addsite(struct sweep *sw, double x, double y, double z, int id)
 {
-    if (nsites >= nsites_alloc) {
-	nsites_alloc += 100;
-	sites =
-	    (struct Site *)G_realloc(sites,
-				     (nsites_alloc) * sizeof(struct Site));
+    if (sw->nsites >= sw->asites) {
+	sw->asites = sw->asites < 100 ? 100 : 2 * sw->asites;
+	sw->sites =
+	    (struct Site *)G_realloc(sw->sites,
+				     (sw->asites) * sizeof(struct Site));
     }
-    sites[nsites].coord.x = x;
-    sites[nsites].coord.y = y;
-    sites[nsites].coord.z = z;
-
-    sites[nsites].sitenbr = id;
-    sites[nsites].refcnt = 0;
-
-    if (nsites > 0) {
-	if (xmin > sites[nsites].coord.x)
-	    xmin = sites[nsites].coord.x;
-	if (xmax < sites[nsites].coord.x)
-	    xmax = sites[nsites].coord.x;
-	if (ymin > sites[nsites].coord.y)
-	    ymin = sites[nsites].coord.y;
-	if (ymax < sites[nsites].coord.y)
-	    ymax = sites[nsites].coord.y;
+    sw->sites[sw->nsites].coord.x = x;
+    sw->sites[sw->nsites].coord.y = y;
+    sw->sites[sw->nsites].coord.z = z;
+
+    sw->sites[sw->nsites].sitenbr = id;
+    sw->sites[sw->nsites].refcnt = 0;
+
+    if (sw->nsites > 0) {
+	if (sw->xmin > sw->sites[sw->nsites].coord.x)
+	    sw->xmin = sw->sites[sw->nsites].coord.x;
+	if (sw->xmax < sw->sites[sw->nsites].coord.x)
+	    sw->xmax = sw->sites[sw->nsites].coord.x;
+	if (sw->ymin > sw->sites[sw->nsites].coord.y)
+	    sw->ymin = sw->sites[sw->nsites].coord.y;
+	if (sw->ymax < sw->sites[sw->nsites].coord.y)
+	    sw->ymax = sw->sites[sw->nsites].coord.y;
     }
     else {
-	xmin = xmax = sites[nsites].coord.x;
-	ymin = ymax = sites[nsites].coord.y;
+	sw->xmin = sw->xmax = sw->sites[sw->nsites].coord.x;
+	sw->ymin = sw->ymax = sw->sites[sw->nsites].coord.y;
     }
 
-    nsites++;
+    sw->nsites++;
 
-    return nsites;
+    return sw->nsites;
+}
+
+/* sort the sites on y, then x, and remove duplicates */
+void sortsites(struct sweep *sw)
+{
+    qsort(sw->sites, sw->nsites, sizeof(struct Site), scomp);
+    removeDuplicates(sw);
 }
 
 /* read all sites, sort, and compute xmin, xmax, ymin, ymax */
-int readsites(void)
+int readsites(struct sweep *sw)
 {
     int nlines, ltype;
     struct line_pnts *Points;
@@ -156,8 +141,9 @@ int readsites(void)
     
     nlines = Vect_get_num_primitives(&In, GV_POINTS);
 
-    nsites = 0;
-    sites = (struct Site *)G_malloc(nlines * sizeof(struct Site));
+    sw->nsites = 0;
+    sw->asites = nlines;
+    sw->sites = (struct Site *)G_malloc(sw->asites * sizeof(struct Site));
 
     Vect_set_constraint_type(&In, GV_POINTS);
     Vect_set_constraint_field(&In, Field);
@@ -174,32 +160,31 @@ int readsites(void)
 	if (!Vect_point_in_box(Points->x[0], Points->y[0], 0.0, &Box))
 	    continue;
 
-	if (mode3d) {
+	if (sw->mode3d) {
 	    G_debug(3, "Points->z[0]: %f", Points->z[0]);
 	    z = Points->z[0];
 	}
 
-	addsite(Points->x[0], Points->y[0], z, nsites);
+	addsite(sw, Points->x[0], Points->y[0], z, sw->nsites);
     }
 
-    if (nsites < 2) {
+    if (sw->nsites < 2) {
 	const char *name = Vect_get_full_name(&In);
 	Vect_close(&In);
 	G_fatal_error(n_("Found %d point/centroid in <%s>, but at least 2 are needed. "
 	                 "Are the current region extents covering at least parts of the input map?",
                          "Found %d points/centroids in <%s>, but at least 2 are needed. "
 			 "Are the current region extents covering at least parts of the input map?",
-                         nsites),
-	              nsites, name);
+                         sw->nsites),
+	              sw->nsites, name);
     }
 
-    if (nsites < nlines)
-	sites =
-	    (struct Site *)G_realloc(sites,
-				     (nsites) * sizeof(struct Site));
+    if (sw->nsites < nlines)
+	sw->sites =
+	    (struct Site *)G_realloc(sw->sites,
+				     (sw->nsites) * sizeof(struct Site));
 
-    qsort(sites, nsites, sizeof(struct Site), scomp);
-    removeDuplicates();
+    sortsites(sw);
 
     Vect_destroy_line_struct(Points);
     Vect_destroy_cats_struct(Cats);
@@ -236,7 +221,7 @@ int n_areas(int line, int *aid)
 }
 
 /* read all boundaries, sort, and compute xmin, xmax, ymin, ymax */
-int readbounds(void)
+int readbounds(struct sweep *sw)
 {
     int line, nlines, ltype, node, nnodes;
     struct line_pnts *Points;
@@ -253,9 +238,9 @@ int readbounds(void)
     
     nlines = Vect_get_num_lines(&In);
 
-    nsites = 0;
-    nsites_alloc = nlines * 2;
-    sites = (struct Site *)G_malloc(nsites_alloc * sizeof(struct Site));
+    sw->nsites = 0;
+    sw->asites = nlines * 2;
+    sw->sites = (struct Site *)G_malloc(sw->asites * sizeof(struct Site));
 
     Vect_set_constraint_type(&In, GV_BOUNDARY);
     Vect_set_constraint_field(&In, Field);
@@ -279,13 +264,13 @@ int readbounds(void)
 	Vect_line_prune(Points);
 	
 	l += Vect_line_length(Points);
-	nsites += Points->n_points;
+	sw->nsites += Points->n_points;
     }
-    if (nsites)
-	maxdist = segf * l / nsites;
+    if (sw->nsites)
+	maxdist = segf * l / sw->nsites;
     G_verbose_message("Maximum segment length: %g", maxdist);
     
-    nsites = 0;
+    sw->nsites = 0;
     z = 0.;
     z1 = 0;
     dz = 0;
@@ -305,11 +290,11 @@ int readbounds(void)
 	Vect_read_line(&In, Points, Cats, line);
 	Vect_line_prune(Points);
 
-	if (nsites + Points->n_points > nsites_alloc) {
-	    nsites_alloc = nsites + Points->n_points;
-	    sites =
-		(struct Site *)G_realloc(sites,
-					 (nsites_alloc) * sizeof(struct Site));
+	if (sw->nsites + Points->n_points > sw->asites) {
+	    sw->asites = sw->nsites + Points->n_points;
+	    sw->sites =
+		(struct Site *)G_realloc(sw->sites,
+					 (sw->asites) * sizeof(struct Site));
 	}
 
 	for (i = 0; i < Points->n_points; i++) {
@@ -318,19 +303,19 @@ int readbounds(void)
 
 	    x = Points->x[i];
 	    y = Points->y[i];
-	    if (mode3d) {
+	    if (sw->mode3d) {
 		G_debug(3, "Points->z[i]: %f", Points->z[i]);
 		z = Points->z[i];
 	    }
 
 	    if (i > 0 && i < Points->n_points - 1)
-		addsite(x, y, z, area_id);
+		addsite(sw, x, y, z, area_id);
 	    
 	    /* densify */
 	    if (maxdist > 0 && i < Points->n_points - 1) {
 		dx = Points->x[i + 1] - Points->x[i];
 		dy = Points->y[i + 1] - Points->y[i];
-		if (mode3d)
+		if (sw->mode3d)
 		    dz = Points->z[i + 1] - Points->z[i];
 		l = sqrt(dx * dx + dy * dy);
 		
@@ -342,10 +327,10 @@ int readbounds(void)
 			sdist = (step * n) / l;
 			x1 = x + sdist * dx;
 			y1 = y + sdist * dy;
-			if (mode3d)
+			if (sw->mode3d)
 			    z1 = z + sdist * dz;
 
-			addsite(x1, y1, z1, area_id);
+			addsite(sw, x1, y1, z1, area_id);
 		    }
 		}
 	    }
@@ -359,7 +344,7 @@ int readbounds(void)
     
     for (node = 1; node <= nnodes; node++) {
 	Vect_get_node_coor(&In, node, &x, &y, &z);
-	if (!mode3d)
+	if (!sw->mode3d)
 	    z = 0.;
 
 	if (!Vect_point_in_box(x, y, 0.0, &Box))
@@ -391,7 +376,7 @@ int readbounds(void)
 	if (arealist->n_values == 1) {
 	    
 	    area_id = arealist->value[0];
-	    addsite(x, y, z, area_id);
+	    addsite(sw, x, y, z, area_id);
 	}
 	else if (arealist->n_values > 1) {
 	    /* displacement */
@@ -458,24 +443,23 @@ int readbounds(void)
 		    y1 = y + sdist * dy;
 		    z1 = 0;
 
-		    addsite(x1, y1, z1, area_id);
+		    addsite(sw, x1, y1, z1, area_id);
 		}
 	    }
 	}
     }
 
-    if (nsites < 2) {
+    if (sw->nsites < 2) {
 	const char *name = Vect_get_full_name(&In);
 	Vect_close(&In);
 	G_fatal_error(n_("Found %d vertex in <%s>, but at least 2 are needed",
                          "Found %d vertices in <%s>, but at least 2 are needed",
-                         nsites),
-	              nsites, name);
+                         sw->nsites),
+	              sw->nsites, name);
     }
 
 
-    qsort(sites, nsites, sizeof(struct Site), scomp);
-    removeDuplicates();
+    sortsites(sw);
 
     Vect_destroy_line_struct(Points);
     Vect_destroy_cats_struct(Cats);
@@ -1,12 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <grass/gis.h>
 #include "sw_defs.h"
 
-int freeinit(struct Freelist *fl, int size)
+int freeinit(struct Freelist *fl, int size, int blocksize)
 {
     fl->head = (struct Freenode *)NULL;
     fl->nodesize = size;
+    fl->blocksize = blocksize > 0 ? blocksize : 1;
+    fl->blocks = NULL;
+    fl->nblocks = fl->ablocks = 0;
     return 0;
 }
 
@@ -16,8 +20,13 @@ char *getfree(struct Freelist *fl)
     struct Freenode *t;
 
     if (fl->head == (struct Freenode *)NULL) {
-	t = (struct Freenode *)G_malloc(sqrt_nsites * fl->nodesize);
-	for (i = 0; i < sqrt_nsites; i++)
+	t = (struct Freenode *)G_malloc((size_t)fl->blocksize * fl->nodesize);
+	if (fl->nblocks == fl->ablocks) {
+	    fl->ablocks = fl->ablocks ? 2 * fl->ablocks : 16;
+	    fl->blocks = G_realloc(fl->blocks, fl->ablocks * sizeof(void *));
+	}
+	fl->blocks[fl->nblocks++] = t;
+	for (i = 0; i < fl->blocksize; i++)
 	    makefree((struct Freenode *)((char *)t + i * fl->nodesize), fl);
     }
     t = fl->head;
@@ -31,3 +40,34 @@ int makefree(struct Freenode *curr, struct Freelist *fl)
     fl->head = curr;
     return 0;
 }
+
+/* release all nodes of the list at once */
+void freerelease(struct Freelist *fl)
+{
+    while (fl->nblocks > 0)
+	G_free(fl->blocks[--fl->nblocks]);
+    G_free(fl->blocks);
+    fl->blocks = NULL;
+    fl->ablocks = 0;
+    fl->head = (struct Freenode *)NULL;
+}
+
+void sweep_init(struct sweep *sw)
+{
+    memset(sw, 0, sizeof(struct sweep));
+}
+
+/* release all memory of a sweep */
+void sweep_free(struct sweep *sw)
+{
+    freerelease(&sw->sfl);
+    freerelease(&sw->efl);
+    freerelease(&sw->hfl);
+    if (sw->ELhash)
+	G_free(sw->ELhash);
+    if (sw->PQhash)
+	G_free(sw->PQhash);
+    if (sw->sites)
+	G_free(sw->sites);
+    sweep_init(sw);
+}
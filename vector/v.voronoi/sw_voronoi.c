@@ -2,12 +2,12 @@
 #include <grass/gis.h>
 #include "sw_defs.h"
 
-/* implicit parameters: nsites, sqrt_nsites, xmin, xmax, ymin, ymax,
-   deltax, deltay (can all be estimates).
+/* parameters of the sweep: sorted sites, nsites, xmin, xmax, ymin, ymax
+   (can all be estimates).
    Performance suffers if they are wrong; better to make nsites,
    deltax, and deltay too big than too small.  (?) */
 
-int voronoi(struct Site *(*nextsite) (void))
+int voronoi(struct sweep *sw)
 {
     struct Site *newsite, *bot, *top, *temp, *p;
     struct Site *v;
@@ -17,63 +17,66 @@ int voronoi(struct Site *(*nextsite) (void))
     struct Edge *e;
     int counter = 0;
 
-    PQinitialize();
-    bottomsite = (*nextsite) ();
-    ELinitialize();
+    sw->siteidx = 0;
+    geominit(sw);
+    PQinitialize(sw);
+    sw->bottomsite = nextone(sw);
+    ELinitialize(sw);
 
-    newsite = (*nextsite) ();
+    newsite = nextone(sw);
     while (1) {
-	if (!PQempty())
-	    newintstar = PQ_min();
+	if (!PQempty(sw))
+	    newintstar = PQ_min(sw);
 
 	if (newsite != (struct Site *)NULL && 
-	    (PQempty() || newsite->coord.y < newintstar.y || 
+	    (PQempty(sw) || newsite->coord.y < newintstar.y || 
 	    (newsite->coord.y == newintstar.y && 
 	    newsite->coord.x < newintstar.x))) {	/* new site is smallest */
 
-	    G_percent(counter++, nsites, 2);
+	    if (sw->verbose)
+		G_percent(counter++, sw->nsites, 2);
 
-	    lbnd = ELleftbnd(&(newsite->coord));
+	    lbnd = ELleftbnd(sw, &(newsite->coord));
 	    rbnd = ELright(lbnd);
-	    bot = rightreg(lbnd);
-	    e = bisect(bot, newsite);
-	    bisector = HEcreate(e, le);
+	    bot = rightreg(sw, lbnd);
+	    e = bisect(sw, bot, newsite);
+	    bisector = HEcreate(sw, e, le);
 	    ELinsert(lbnd, bisector);
-	    if ((p = intersect(lbnd, bisector)) != (struct Site *)NULL) {
-		PQdelete(lbnd);
-		PQinsert(lbnd, p, dist(p, newsite));
+	    if ((p = intersect(sw, lbnd, bisector)) != (struct Site *)NULL) {
+		PQdelete(sw, lbnd);
+		PQinsert(sw, lbnd, p, dist(p, newsite));
 	    }
 	    lbnd = bisector;
-	    bisector = HEcreate(e, re);
+	    bisector = HEcreate(sw, e, re);
 	    ELinsert(lbnd, bisector);
-	    if ((p = intersect(bisector, rbnd)) != (struct Site *)NULL) {
-		PQinsert(bisector, p, dist(p, newsite));
+	    if ((p = intersect(sw, bisector, rbnd)) != (struct Site *)NULL) {
+		PQinsert(sw, bisector, p, dist(p, newsite));
 	    }
 	    /* get next site, but ensure that it doesn't have the same
 	       coordinates as the previous. If so, step over to the following
 	       site. Andrea Aime 4/7/2001 */
 	    do
-		temp = (*nextsite) ();
+		temp = nextone(sw);
 	    while (temp != (struct Site *)NULL &&
 		   temp->coord.x == newsite->coord.x &&
 		   temp->coord.y == newsite->coord.y);
 	    newsite = temp;
 	}
-	else if (!PQempty()) {
+	else if (!PQempty(sw)) {
 	    /* intersection is smallest */
-	    lbnd = PQextractmin();
+	    lbnd = PQextractmin(sw);
 	    llbnd = ELleft(lbnd);
 	    rbnd = ELright(lbnd);
 	    rrbnd = ELright(rbnd);
-	    bot = leftreg(lbnd);
-	    top = rightreg(rbnd);
+	    bot = leftreg(sw, lbnd);
+	    top = rightreg(sw, rbnd);
 
 	    v = lbnd->vertex;
-	    makevertex(v);
-	    endpoint(lbnd->ELedge, lbnd->ELpm, v);
-	    endpoint(rbnd->ELedge, rbnd->ELpm, v);
+	    makevertex(sw, v);
+	    endpoint(sw, lbnd->ELedge, lbnd->ELpm, v);
+	    endpoint(sw, rbnd->ELedge, rbnd->ELpm, v);
 	    ELdelete(lbnd);
-	    PQdelete(rbnd);
+	    PQdelete(sw, rbnd);
 	    ELdelete(rbnd);
 	    pm = le;
 	    if (bot->coord.y > top->coord.y) {
@@ -82,24 +85,25 @@ int voronoi(struct Site *(*nextsite) (void))
 		top = temp;
 		pm = re;
 	    }
-	    e = bisect(bot, top);
-	    bisector = HEcreate(e, pm);
+	    e = bisect(sw, bot, top);
+	    bisector = HEcreate(sw, e, pm);
 	    ELinsert(llbnd, bisector);
-	    endpoint(e, re - pm, v);
-	    deref(v);
-	    if ((p = intersect(llbnd, bisector)) != (struct Site *)NULL) {
-		PQdelete(llbnd);
-		PQinsert(llbnd, p, dist(p, bot));
+	    endpoint(sw, e, re - pm, v);
+	    deref(sw, v);
+	    if ((p = intersect(sw, llbnd, bisector)) != (struct Site *)NULL) {
+		PQdelete(sw, llbnd);
+		PQinsert(sw, llbnd, p, dist(p, bot));
 	    }
-	    if ((p = intersect(bisector, rrbnd)) != (struct Site *)NULL) {
-		PQinsert(bisector, p, dist(p, bot));
+	    if ((p = intersect(sw, bisector, rrbnd)) != (struct Site *)NULL) {
+		PQinsert(sw, bisector, p, dist(p, bot));
 	    }
 	}
 	else
 	    break;
     }
 
-    G_percent(1, 1, 1);
+    if (sw->verbose)
+	G_percent(1, 1, 1);
 
     return 0;
 }
@@ -7,70 +7,24 @@
 #include "sw_defs.h"
 #include "defs.h"
 
-static int write_skeleton(struct line_pnts *Points)
-{
-    int i, area1, area2;
-    static struct line_pnts *APoints = NULL;
-    static struct line_cats *Cats = NULL;
-
-    if (!APoints) {
-	APoints = Vect_new_line_struct();
-	Cats = Vect_new_cats_struct();
-    }
-
-    if ((area1 = Vect_find_area(&In, Points->x[0], Points->y[0])) == 0)
-	return 0;
-    if ((area2 = Vect_find_area(&In, Points->x[1], Points->y[1])) == 0)
-	return 0;
-    if (area1 != area2)
-	return 0;
-
-    if (!Vect_get_area_centroid(&In, area1))
-	return 0;
-    Vect_get_area_points(&In, area1, APoints);
-    if (Vect_line_check_intersection(Points, APoints, 0))
-	return 0;
-
-    for (i = 0; i < Vect_get_area_num_isles(&In, area1); i++) {
-	Vect_get_isle_points(&In, Vect_get_area_isle(&In, area1, i), APoints);
-	if (Vect_line_check_intersection(Points, APoints, 0))
-	    return 0;
-    }
-
-    Vect_get_area_cats(&In, area1, Cats);
-    Vect_write_line(&Out, GV_LINE, Points, Cats);
-
-    return 1;
-}
-
-int vo_write(void)
+int vo_write(struct sweep *sw)
 {
     struct Halfedge *lbnd;
 
-    for (lbnd = ELright(ELleftend); lbnd != ELrightend; lbnd = ELright(lbnd)) {
-	write_ep(lbnd->ELedge);
+    for (lbnd = ELright(sw->ELleftend); lbnd != sw->ELrightend;
+	 lbnd = ELright(lbnd)) {
+	sw->output(sw, lbnd->ELedge);
     }
 
-    /* TODO: free memory */
-
     return 1;
 }
 
-
-int write_ep(struct Edge *e)
+/* get the part of an edge inside the current region,
+ * returns 0 if there is none */
+int edge_points(struct Edge *e, struct line_pnts *Points)
 {
-    static struct line_pnts *Points = NULL;
-    static struct line_cats *Cats = NULL;
     double x1, y1, x2, y2;
 
-    if (!Points) {
-	Points = Vect_new_line_struct();
-	Cats = Vect_new_cats_struct();
-    }
-
-    if (in_area && e->reg[le]->sitenbr == e->reg[re]->sitenbr)
-	return 0;
-
     if (e->ep[le] != NULL && e->ep[re] != NULL) {	/* both end defined */
 	x1 = e->ep[le]->coord.x;
 	y1 = e->ep[le]->coord.y;
@@ -85,14 +39,6 @@ int write_ep(struct Edge *e)
 	/* Don't write zero length */
 	if (x1 == x2 && y1 == y2)
 	    return 0;
-
-	Vect_reset_line(Points);
-	Vect_append_point(Points, x1, y1, 0.0);
-	Vect_append_point(Points, x2, y2, 0.0);
-	if (skeleton)
-	    write_skeleton(Points);
-	else
-	    Vect_write_line(&Out, Type, Points, Cats);
     }
     else {
 	int knownPointAtLeft = -1;
@@ -122,23 +68,39 @@ int write_ep(struct Edge *e)
 	    }
 	    knownPointAtLeft = 1;
 	}
-	if (extend_line(Box.S, Box.N, Box.W, Box.E,
-			e->a, e->b, e->c, x1, y1, &x2, &y2,
-			knownPointAtLeft)) {
+	if (!extend_line(Box.S, Box.N, Box.W, Box.E,
+			 e->a, e->b, e->c, x1, y1, &x2, &y2,
+			 knownPointAtLeft))
+	    return 0;
 
-	    /* Don't write zero length */
-	    if (x1 == x2 && y1 == y2)
-		return 0;
+	/* Don't write zero length */
+	if (x1 == x2 && y1 == y2)
+	    return 0;
+    }
 
-	    Vect_reset_line(Points);
-	    Vect_append_point(Points, x1, y1, 0.0);
-	    Vect_append_point(Points, x2, y2, 0.0);
-	    if (skeleton)
-		write_skeleton(Points);
-	    else
-		Vect_write_line(&Out, Type, Points, Cats);
-	}
+    Vect_reset_line(Points);
+    Vect_append_point(Points, x1, y1, 0.0);
+    Vect_append_point(Points, x2, y2, 0.0);
+
+    return 1;
+}
+
+/* write an edge of the Voronoi diagram of all sites to the output */
+int write_ep(struct sweep *sw, struct Edge *e)
+{
+    static struct line_pnts *Points = NULL;
+    static struct line_cats *Cats = NULL;
+
+    if (!Points) {
+	Points = Vect_new_line_struct();
+	Cats = Vect_new_cats_struct();
     }
 
+    if (in_area && e->reg[le]->sitenbr == e->reg[re]->sitenbr)
+	return 0;
+
+    if (edge_points(e, Points))
+	Vect_write_line(&Out, Type, Points, Cats);
+
     return 0;
 }
@@ -26,6 +26,28 @@
 #include <grass/glocale.h>
 #include "local_proto.h"
 
+/* rows sent to the driver in one db_update_values() call */
+#define BATCH_SIZE 10000
+
+static void update_batch(dbDriver *driver, struct field_info *Fi,
+			 dbString *column, int ctype, int *nrows, int *keys,
+			 dbValue *values, int *update_cnt, int *upderr_cnt)
+{
+    int nupdated;
+
+    if (*nrows == 0)
+	return;
+
+    if (db_update_values(driver, Fi->table, Fi->key, 1, column, &ctype,
+			 *nrows, keys, values, &nupdated) != DB_OK) {
+	G_warning(_("Cannot update table <%s>"), Fi->table);
+	nupdated = 0;
+    }
+    *update_cnt += nupdated;
+    *upderr_cnt += *nrows - nupdated;
+    *nrows = 0;
+}
+
 int main(int argc, char *argv[])
 {
     int i, j, type, field, cat, vtype, open_level;
@@ -61,9 +83,11 @@ int main(int argc, char *argv[])
 
     int *catexst, *cex;
     struct field_info *Fi;
-    dbString stmt;
+    dbString stmt, column;
     dbDriver *driver;
     int select, norec_cnt, update_cnt, upderr_cnt, col_type;
+    int ctype, nbatch, *keys;
+    dbValue *values;
 
     G_gisinit(argv[0]);
 
@@ -597,6 +621,9 @@ int main(int argc, char *argv[])
 	/* Update table from cache */
 	G_debug(1, "Updating db table");
 
+	/* the table is updated in the order of the key */
+	qsort(cache, point_cnt, sizeof(struct order), by_cat);
+
 	/* select existing categories to array (array is sorted) */
 	select = db_select_int(driver, Fi->table, Fi->key, NULL, &catexst);
 
@@ -604,6 +631,19 @@ int main(int argc, char *argv[])
 
 	norec_cnt = update_cnt = upderr_cnt = dupl_cnt = 0;
 
+	/* without a where condition the updates are sent to the driver
+	   in batches */
+	nbatch = 0;
+	keys = NULL;
+	values = NULL;
+	ctype = out_type == CELL_TYPE ? DB_C_TYPE_INT : DB_C_TYPE_DOUBLE;
+	if (!opt.where->answer) {
+	    db_init_string(&column);
+	    db_set_string(&column, opt.col->answer);
+	    keys = G_malloc(BATCH_SIZE * sizeof(int));
+	    values = G_calloc(BATCH_SIZE, sizeof(dbValue));
+	}
+
 	G_message("Update vector attributes...");
 	for (point = 0; point < point_cnt; point++) {
 	    if (cache[point].count > 1) {
@@ -625,6 +665,28 @@ int main(int argc, char *argv[])
 		continue;
 	    }
 
+	    if (values) {
+		dbValue *value = &values[nbatch];
+
+		keys[nbatch++] = cache[point].cat;
+		if (out_type == CELL_TYPE) {
+		    value->isNull = cache[point].count > 1 ||
+			Rast_is_c_null_value(&cache[point].value);
+		    value->i = cache[point].value;
+		}
+		else {
+		    value->isNull = cache[point].count > 1 ||
+			Rast_is_d_null_value(&cache[point].dvalue);
+		    /* same value as written to the statements */
+		    sprintf(buf, "%.*g", width, cache[point].dvalue);
+		    value->d = atof(buf);
+		}
+		if (nbatch == BATCH_SIZE)
+		    update_batch(driver, Fi, &column, ctype, &nbatch, keys,
+				 values, &update_cnt, &upderr_cnt);
+		continue;
+	    }
+
 	    sprintf(buf, "update %s set %s = ", Fi->table, opt.col->answer);
 
 	    db_set_string(&stmt, buf);
@@ -666,6 +728,14 @@ int main(int argc, char *argv[])
 	}
 	G_percent(1, 1, 1);
 
+	if (values) {
+	    update_batch(driver, Fi, &column, ctype, &nbatch, keys, values,
+			 &update_cnt, &upderr_cnt);
+	    G_free(keys);
+	    G_free(values);
+	    db_free_string(&column);
+	}
+
 	G_debug(1, "Committing DB transaction");
 	db_commit_transaction(driver);
 
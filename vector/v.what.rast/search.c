@@ -1,14 +1,17 @@
 #include "local_proto.h"
 
-/* for qsort, order list by row */
+/* for qsort, order list by row and column */
 int by_row(const void *ii, const void *jj)
 {
     const struct order *i = ii, *j = jj;
 
-    if (i->row < j->row)
+    if (i->row != j->row)
+	return i->row < j->row ? -1 : 1;
+
+    if (i->col < j->col)
 	return -1;
 
-    return (i->row > j->row);
+    return (i->col > j->col);
 }
 
 /* for qsort, order list by cat */